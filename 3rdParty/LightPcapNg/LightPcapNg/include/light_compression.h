@@ -48,10 +48,16 @@ struct light_file_t;
 //Init anything needed to keep state of your compression or configure your compression here
 void light_free_compression_context(_compression_t* context);
 _compression_t * light_get_compression_context(int compression_level);
+//Same as above, but frames are compressed by num_workers threads. Falls back to light_get_compression_context() if the
+//compression type doesn't support it or num_workers is 0
+_compression_t * light_get_parallel_compression_context(int compression_level, int num_workers);
 
 //Init anything needed to keep state of your decompression or configure your decompression here
 void light_free_decompression_context(_decompression_t* context);
 _decompression_t * light_get_decompression_context();
+//Same as above, but frames are decompressed ahead of reading by num_workers threads when the file allows it. Falls back to
+//light_get_decompression_context() if the compression type doesn't support it or num_workers is 0
+_decompression_t * light_get_parallel_decompression_context(int num_workers);
 
 //Return true if the file at file_path is a compressed file and should be decompressed
 int light_is_compressed_file(const char* file_path);
@@ -37,6 +37,8 @@ struct _decompression_t;
 extern struct _compression_t * (*get_compression_context_ptr)(int);
 extern void(*free_compression_context_ptr)(struct _compression_t*);
 extern struct _decompression_t * (*get_decompression_context_ptr)();
+extern struct _compression_t * (*get_parallel_compression_context_ptr)(int, int);
+extern struct _decompression_t * (*get_parallel_decompression_context_ptr)(int);
 extern void(*free_decompression_context_ptr)(struct _decompression_t*);
 extern int(*is_compressed_file)(const char*);
 extern size_t(*read_compressed)(struct light_file_t *, void *, size_t);
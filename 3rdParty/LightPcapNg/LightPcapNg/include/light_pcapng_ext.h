@@ -44,6 +44,8 @@ extern "C" {
 
 #define MAX_SUPPORTED_INTERFACE_BLOCKS 32
 
+#define LIGHT_DEFAULT_READ_BUFFER_SIZE (1024 * 1024)
+
 struct _light_pcapng_t;
 typedef struct _light_pcapng_t light_pcapng_t;
 
@@ -80,6 +82,12 @@ light_pcapng_t *light_pcapng_open_read(const char* file_path, light_boolean read
 //Set compression level to 0 to disable compression!
 light_pcapng_t *light_pcapng_open_write(const char* file_path, light_pcapng_file_info *file_info, int compression_level);
 
+//Same as light_pcapng_open_read() and light_pcapng_open_write(), with compressed files (de)compressed by num_workers threads.
+//Compressed files are written as a sequence of independent frames, which are compressed in parallel and can be decompressed in
+//parallel too. Other compressed files are decompressed as a stream. Set num_workers to 0 to (de)compress in the calling thread
+light_pcapng_t *light_pcapng_open_read_parallel(const char* file_path, light_boolean read_all_interfaces, int num_workers);
+light_pcapng_t *light_pcapng_open_write_parallel(const char* file_path, light_pcapng_file_info *file_info, int compression_level, int num_workers);
+
 light_pcapng_t *light_pcapng_open_append(const char* file_path);
 
 light_pcapng_file_info *light_create_default_file_info();
@@ -92,6 +100,21 @@ light_pcapng_file_info *light_pcang_get_file_info(light_pcapng_t *pcapng);
 
 int light_get_next_packet(light_pcapng_t *pcapng, light_packet_header *packet_header, const uint8_t **packet_data);
 
+//Same as light_get_next_packet(), without allocating and parsing a block per read. The file is read in chunks of read_buffer_size bytes
+//(blocks larger than that grow the buffer) and packet blocks are parsed in place: packet_data and the comment point into the read
+//buffer and are valid until the next read, seek or close. Blocks other than packet and interface blocks are skipped unparsed, and the
+//options of a packet block are scanned for a comment only if read_comment is set. Compressed files are read block by block. Don't mix
+//with light_get_next_packet() on the same file
+int light_get_next_packet_buffered(light_pcapng_t *pcapng, light_packet_header *packet_header, const uint8_t **packet_data, light_boolean read_comment);
+
+//Set the size of the chunks light_get_next_packet_buffered() reads the file in. The default is LIGHT_DEFAULT_READ_BUFFER_SIZE
+void light_pcapng_set_read_buffer_size(light_pcapng_t *pcapng, size_t read_buffer_size);
+
+//Move a file opened for reading to the block at file position pos, so the next packet read is the packet of this block or after it.
+//Interface blocks before pos which weren't read yet are read first. Returns 0 on success, or -1 if the file is compressed or the blocks
+//before pos can't be walked
+int light_pcapng_seek(light_pcapng_t *pcapng, long pos);
+
 void light_write_packet(light_pcapng_t *pcapng, const light_packet_header *packet_header, const uint8_t *packet_data);
 
 void light_pcapng_close(light_pcapng_t *pcapng);
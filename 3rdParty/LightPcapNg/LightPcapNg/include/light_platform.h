@@ -51,6 +51,9 @@ typedef long light_file_pos_t;
 
 light_file light_open(const char *file_name, const __read_mode_t mode);
 light_file light_open_compression(const char *file_name, const __read_mode_t mode, int compression_level);
+// Same as light_open() and light_open_compression(), with compressed files (de)compressed by num_workers threads
+light_file light_open_parallel(const char *file_name, const __read_mode_t mode, int num_workers);
+light_file light_open_compression_parallel(const char *file_name, const __read_mode_t mode, int compression_level, int num_workers);
 size_t light_read(light_file fd, void *buf, size_t count);
 size_t light_write(light_file fd, const void *buf, size_t count);
 size_t light_size(light_file fd);
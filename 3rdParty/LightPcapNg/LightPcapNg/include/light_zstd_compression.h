@@ -26,6 +26,7 @@
 #if defined(USE_Z_STD)
 
 #include <stdint.h>
+#include <pthread.h>
 #include <zstd.h>      // presumes zstd library is installed
 
 
@@ -34,6 +35,50 @@
 //so allocate 1700 bytes as the max input size we expect in a single shot
 #define COMPRESSION_BUFFER_IN_MAX_SIZE 1700
 
+//In parallel mode blocks are accumulated into frames of this size, which are compressed independently by the workers
+#define LIGHT_ZSTD_FRAME_SIZE (1024 * 1024)
+
+//The state of a frame in the ring of a worker pool
+enum zstd_frame_state_t
+{
+	LIGHT_ZSTD_FRAME_FREE,		//Owned by the caller, being filled
+	LIGHT_ZSTD_FRAME_QUEUED,	//Waiting for a worker
+	LIGHT_ZSTD_FRAME_BUSY,		//Being (de)compressed by a worker
+	LIGHT_ZSTD_FRAME_DONE		//Ready to be written to file / consumed by the caller
+};
+
+//A single frame (de)compressed by one worker. "in" always holds the data a worker reads and "out" the data it produces
+struct zstd_frame_job_t
+{
+	uint8_t* in;
+	size_t in_size;
+	size_t in_max_size;
+	uint8_t* out;
+	size_t out_size;
+	size_t out_max_size;
+	enum zstd_frame_state_t state;
+	int error;
+};
+
+//Worker threads (de)compressing a ring of 2 frames per worker, so the caller can fill/consume frames while the workers are busy.
+//Frames are submitted and collected by the caller in ring order, hence the output is always in the original order
+struct zstd_worker_pool_t
+{
+	struct zstd_frame_job_t* jobs;
+	size_t num_jobs;
+	size_t submit_job;		//The next frame the caller fills and submits
+	size_t collect_job;		//The next frame the caller writes / consumes
+	size_t next_job;		//The next queued frame a worker picks
+	pthread_t* threads;
+	int num_threads;
+	pthread_mutex_t mutex;
+	pthread_cond_t job_queued;
+	pthread_cond_t job_done;
+	int stop;
+	int compress;
+	int compression_level;
+};
+
 //This is the z-std compression type I would call it z-std type and realias 
 //2x but complier won't let me do that across bounds it seems
 //So I gave it a generic "light" name....
@@ -45,6 +90,10 @@ struct zstd_compression_t
 	size_t buffer_out_max_size;
 	int compression_level;
 	ZSTD_CCtx* cctx;
+	//Parallel mode, used when the context was created with workers
+	int num_workers;
+	int failed;
+	struct zstd_worker_pool_t pool;
 };
 
 struct zstd_decompression_t
@@ -57,6 +106,19 @@ struct zstd_decompression_t
 	int outputReady;
 	ZSTD_outBuffer output;
 	ZSTD_inBuffer input;
+	//Parallel mode, chosen on the first read when the context was created with workers and the first frame of the file
+	//records its decompressed size (which is the case for files compressed in parallel mode)
+	int num_workers;
+	int parallel;
+	int mode_chosen;
+	int input_done;
+	int failed;
+	size_t consumed;		//How much of the decompressed frame in the ring was already consumed
+	uint8_t* pending;		//Compressed input read ahead of the frame boundaries
+	size_t pending_pos;
+	size_t pending_size;
+	size_t pending_max_size;
+	struct zstd_worker_pool_t pool;
 };
 
 
@@ -66,9 +128,11 @@ typedef struct zstd_decompression_t _decompression_t;
 struct light_file_t;
 
 _compression_t * get_zstd_compression_context(int compression_level);
+_compression_t * get_zstd_parallel_compression_context(int compression_level, int num_workers);
 void free_zstd_compression_context(_compression_t* context);
 
 _decompression_t * get_zstd_decompression_context();
+_decompression_t * get_zstd_parallel_decompression_context(int num_workers);
 void free_zstd_decompression_context(_decompression_t* context);
 
 int is_zstd_compressed_file(const char* file_path);
@@ -42,6 +42,17 @@ _compression_t * light_get_compression_context(int compression_level)
 		return NULL;
 }
 
+_compression_t * light_get_parallel_compression_context(int compression_level, int num_workers)
+{
+	if (compression_level == 0)
+		return NULL;
+
+	if (num_workers > 0 && get_parallel_compression_context_ptr != NULL)
+		return get_parallel_compression_context_ptr(compression_level, num_workers);
+	else
+		return light_get_compression_context(compression_level);
+}
+
 void light_free_compression_context(_compression_t* context)
 {
 	if (!context)
@@ -61,6 +72,14 @@ _decompression_t * light_get_decompression_context()
 		return NULL;
 }
 
+_decompression_t * light_get_parallel_decompression_context(int num_workers)
+{
+	if (num_workers > 0 && get_parallel_decompression_context_ptr != NULL)
+		return get_parallel_decompression_context_ptr(num_workers);
+	else
+		return light_get_decompression_context();
+}
+
 void light_free_decompression_context(_decompression_t* context)
 {
 	if (!context)
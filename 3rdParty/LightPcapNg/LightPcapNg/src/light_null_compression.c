@@ -32,6 +32,8 @@
 struct _compression_t * (*get_compression_context_ptr)(int) = NULL;
 void(*free_compression_context_ptr)(struct _compression_t*) = NULL;
 struct _decompression_t * (*get_decompression_context_ptr)() = NULL;
+struct _compression_t * (*get_parallel_compression_context_ptr)(int, int) = NULL;
+struct _decompression_t * (*get_parallel_decompression_context_ptr)(int) = NULL;
 void(*free_decompression_context_ptr)(struct _decompression_t*) = NULL;
 int(*is_compressed_file)(const char*) = NULL;
 size_t(*read_compressed)(struct light_file_t *, void *, size_t) = NULL;
@@ -38,6 +38,17 @@ struct _light_pcapng_t
 	light_pcapng pcapng;
 	light_pcapng_file_info *file_info;
 	light_file file;
+	//All interface blocks before this file position were added to file_info. It's 0 until the file is seeked: when it's read
+	//sequentially only, every interface block is read once
+	light_file_pos_t interfaces_end;
+	//The buffer of light_get_next_packet_buffered(). Bytes before read_buffer_offset were consumed, and read_buffer_pos is the file
+	//position of the first byte of the buffer
+	uint8_t *read_buffer;
+	size_t read_buffer_size;
+	size_t read_buffer_len;
+	size_t read_buffer_offset;
+	light_file_pos_t read_buffer_pos;
+	size_t read_buffer_capacity;
 };
 
 static light_pcapng_file_info *__create_file_info(light_pcapng pcapng_head)
@@ -137,31 +148,50 @@ static double __power_of(int x, int y)
 	return res;
 }
 
-static void __append_interface_block_to_file_info(const light_pcapng interface_block, light_pcapng_file_info* info)
+//ts_resolution points to the value of the if_tsresol option, or is NULL if the interface block doesn't have one
+static void __append_interface_to_file_info(uint16_t link_type, const uint8_t* ts_resolution, light_pcapng_file_info* info)
 {
-	struct _light_interface_description_block* interface_desc_block;
-	light_option ts_resolution_option = NULL;
-
 	if (info->interface_block_count >= MAX_SUPPORTED_INTERFACE_BLOCKS)
 		return;
 
-	light_get_block_info(interface_block, LIGHT_INFO_BODY, &interface_desc_block, NULL);
-
-	ts_resolution_option = light_get_option(interface_block, LIGHT_OPTION_IF_TSRESOL);
-	if (ts_resolution_option == NULL)
+	if (ts_resolution == NULL)
 	{
 		info->timestamp_resolution[info->interface_block_count] = __power_of(10,-6);
 	}
 	else
 	{
-		uint8_t* raw_ts_data = (uint8_t*)light_get_option_data(ts_resolution_option);
-		if (*raw_ts_data < 128)
-			info->timestamp_resolution[info->interface_block_count] = __power_of(10, (-1)*(*raw_ts_data));
+		if (*ts_resolution < 128)
+			info->timestamp_resolution[info->interface_block_count] = __power_of(10, (-1)*(*ts_resolution));
 		else
-			info->timestamp_resolution[info->interface_block_count] = __power_of(2, (-1)*((*raw_ts_data)-128));
+			info->timestamp_resolution[info->interface_block_count] = __power_of(2, (-1)*((*ts_resolution)-128));
 	}
 
-	info->link_types[info->interface_block_count++] = interface_desc_block->link_type;
+	info->link_types[info->interface_block_count++] = link_type;
+}
+
+static void __append_interface_block_to_file_info(const light_pcapng interface_block, light_pcapng_file_info* info)
+{
+	struct _light_interface_description_block* interface_desc_block;
+	light_option ts_resolution_option = NULL;
+
+	light_get_block_info(interface_block, LIGHT_INFO_BODY, &interface_desc_block, NULL);
+
+	ts_resolution_option = light_get_option(interface_block, LIGHT_OPTION_IF_TSRESOL);
+	const uint8_t* raw_ts_data = ts_resolution_option != NULL ? (uint8_t*)light_get_option_data(ts_resolution_option) : NULL;
+
+	__append_interface_to_file_info(interface_desc_block->link_type, raw_ts_data, info);
+}
+
+//Tell whether the interface block just read wasn't added to file_info yet, which is the case if it's read for the second time
+//after seeking back
+static light_boolean __is_new_interface_block(const struct _light_pcapng_t* pcapng)
+{
+	if (pcapng->interfaces_end == 0)
+		return LIGHT_TRUE;
+
+	uint32_t block_length = 0;
+	light_get_block_info(pcapng->pcapng, LIGHT_INFO_LENGTH, &block_length, NULL);
+	return light_get_pos(pcapng->file) - (light_file_pos_t)block_length >= pcapng->interfaces_end ? LIGHT_TRUE : LIGHT_FALSE;
 }
 
 static light_boolean __is_open_for_write(const struct _light_pcapng_t* pcapng)
@@ -173,11 +203,16 @@ static light_boolean __is_open_for_write(const struct _light_pcapng_t* pcapng)
 }
 
 light_pcapng_t *light_pcapng_open_read(const char* file_path, light_boolean read_all_interfaces)
+{
+	return light_pcapng_open_read_parallel(file_path, read_all_interfaces, 0);
+}
+
+light_pcapng_t *light_pcapng_open_read_parallel(const char* file_path, light_boolean read_all_interfaces, int num_workers)
 {
 	DCHECK_NULLP(file_path, return NULL);
 
 	light_pcapng_t *pcapng = calloc(1, sizeof(struct _light_pcapng_t));
-	pcapng->file = light_open(file_path, LIGHT_OREAD);
+	pcapng->file = light_open_parallel(file_path, LIGHT_OREAD, num_workers);
 	DCHECK_ASSERT_EXP(pcapng->file != NULL, "could not open file", return NULL);
 	
 	//The first thing inside an NG capture is the section header block
@@ -205,7 +240,8 @@ light_pcapng_t *light_pcapng_open_read(const char* file_path, light_boolean read
 			light_pcapng_release(pcapng->pcapng);
 			return NULL;
 		}
-		//Ok got to end of file so reset back to bookmark
+		//Ok got to end of file so reset back to bookmark. All interfaces were read, so they aren't added again when read later
+		pcapng->interfaces_end = light_get_pos(pcapng->file);
 		light_set_pos(pcapng->file, currentPos);
 	}
 
@@ -216,13 +252,18 @@ light_pcapng_t *light_pcapng_open_read(const char* file_path, light_boolean read
 }
 
 light_pcapng_t *light_pcapng_open_write(const char* file_path, light_pcapng_file_info *file_info, int compression_level)
+{
+	return light_pcapng_open_write_parallel(file_path, file_info, compression_level, 0);
+}
+
+light_pcapng_t *light_pcapng_open_write_parallel(const char* file_path, light_pcapng_file_info *file_info, int compression_level, int num_workers)
 {
 	DCHECK_NULLP(file_info, return NULL);
 	DCHECK_NULLP(file_path, return NULL);
 
 	light_pcapng_t *pcapng = calloc(1, sizeof(struct _light_pcapng_t));
 
-	pcapng->file = light_open_compression(file_path, LIGHT_OWRITE, compression_level);
+	pcapng->file = light_open_compression_parallel(file_path, LIGHT_OWRITE, compression_level, num_workers);
 	pcapng->file_info = file_info;
 
 	DCHECK_ASSERT_EXP(pcapng->file != NULL, "could not open output file", return NULL);
@@ -381,7 +422,7 @@ int light_get_next_packet(light_pcapng_t *pcapng, light_packet_header *packet_he
 
 	while (pcapng->pcapng != NULL && type != LIGHT_ENHANCED_PACKET_BLOCK && type != LIGHT_SIMPLE_PACKET_BLOCK)
 	{
-		if (type == LIGHT_INTERFACE_BLOCK)
+		if (type == LIGHT_INTERFACE_BLOCK && __is_new_interface_block(pcapng))
 			__append_interface_block_to_file_info(pcapng->pcapng, pcapng->file_info);
 
 		light_read_record(pcapng->file, &pcapng->pcapng);
@@ -446,6 +487,246 @@ int light_get_next_packet(light_pcapng_t *pcapng, light_packet_header *packet_he
 	return 1;
 }
 
+//Return the value of the first option of the given code in the options between options and options_end, or NULL if there's no such option
+static const uint8_t *__find_option_in_buffer(const uint8_t *options, const uint8_t *options_end, uint16_t code, uint16_t *length)
+{
+	while (options + 2 * sizeof(uint16_t) <= options_end)
+	{
+		uint16_t option_code = ((const uint16_t*)options)[0];
+		uint16_t option_length = ((const uint16_t*)options)[1];
+		const uint8_t *value = options + 2 * sizeof(uint16_t);
+
+		//opt_endofopt, or an option which runs past the end of the block
+		if (option_code == 0 || option_length > (size_t)(options_end - value))
+			break;
+
+		if (option_code == code)
+		{
+			*length = option_length;
+			return value;
+		}
+
+		size_t padded_length = 0;
+		PADD32((size_t)option_length, &padded_length);
+		if (padded_length > (size_t)(options_end - value))
+			break;
+		options = value + padded_length;
+	}
+
+	return NULL;
+}
+
+//Make sure at least needed unconsumed bytes are in the read buffer. Unconsumed bytes are moved to the start of the buffer first, and the
+//buffer grows if needed is larger than it
+static light_boolean __fill_read_buffer(struct _light_pcapng_t *pcapng, size_t needed)
+{
+	size_t available = pcapng->read_buffer_len - pcapng->read_buffer_offset;
+	if (available >= needed)
+		return LIGHT_TRUE;
+
+	if (available == 0)
+	{
+		//Positions in a compressed file aren't positions in the capture, and they're never used since compressed files can't be seeked
+		if (pcapng->file->decompression_context == NULL)
+			pcapng->read_buffer_pos = light_get_pos(pcapng->file);
+	}
+	else
+	{
+		memmove(pcapng->read_buffer, pcapng->read_buffer + pcapng->read_buffer_offset, available);
+		pcapng->read_buffer_pos += pcapng->read_buffer_offset;
+	}
+	pcapng->read_buffer_len = available;
+	pcapng->read_buffer_offset = 0;
+
+	size_t capacity = pcapng->read_buffer_size > 0 ? pcapng->read_buffer_size : LIGHT_DEFAULT_READ_BUFFER_SIZE;
+	if (capacity < needed)
+		capacity = needed;
+	if (pcapng->read_buffer == NULL || capacity > pcapng->read_buffer_capacity)
+	{
+		uint8_t *new_buffer = realloc(pcapng->read_buffer, capacity);
+		if (new_buffer == NULL)
+			return LIGHT_FALSE;
+		pcapng->read_buffer = new_buffer;
+		pcapng->read_buffer_capacity = capacity;
+	}
+
+	if (pcapng->file->decompression_context == NULL)
+	{
+		pcapng->read_buffer_len += fread(pcapng->read_buffer + pcapng->read_buffer_len, 1, pcapng->read_buffer_capacity - pcapng->read_buffer_len, pcapng->file->file);
+	}
+	else
+	{
+		//A short read of a compressed file loses the bytes read, so read exactly what's missing
+		size_t missing = needed - pcapng->read_buffer_len;
+		if (light_read(pcapng->file, pcapng->read_buffer + pcapng->read_buffer_len, missing) != missing)
+			return LIGHT_FALSE;
+		pcapng->read_buffer_len += missing;
+	}
+
+	return pcapng->read_buffer_len >= needed ? LIGHT_TRUE : LIGHT_FALSE;
+}
+
+int light_get_next_packet_buffered(light_pcapng_t *pcapng, light_packet_header *packet_header, const uint8_t **packet_data, light_boolean read_comment)
+{
+	DCHECK_NULLP(pcapng, return 0);
+
+	*packet_data = NULL;
+	light_pcapng_file_info *info = pcapng->file_info;
+
+	while (1)
+	{
+		if (!__fill_read_buffer(pcapng, 2 * sizeof(uint32_t)))
+			return 0;
+
+		const uint32_t *block_header = (const uint32_t*)(pcapng->read_buffer + pcapng->read_buffer_offset);
+		uint32_t block_type = block_header[0];
+		uint32_t block_length = block_header[1];
+		if (block_length < 3 * sizeof(uint32_t) || block_length % 4 != 0)
+			return 0;
+
+		if (!__fill_read_buffer(pcapng, block_length))
+			return 0;
+
+		//The buffer may have moved while being filled
+		const uint8_t *block = pcapng->read_buffer + pcapng->read_buffer_offset;
+		const uint8_t *body = block + 2 * sizeof(uint32_t);
+		const uint8_t *body_end = block + block_length - sizeof(uint32_t);
+		size_t body_length = block_length - 3 * sizeof(uint32_t);
+		light_file_pos_t block_pos = pcapng->read_buffer_pos + pcapng->read_buffer_offset;
+		pcapng->read_buffer_offset += block_length;
+
+		const uint8_t *options = NULL;
+
+		if (block_type == LIGHT_ENHANCED_PACKET_BLOCK)
+		{
+			if (body_length < sizeof(struct _light_enhanced_packet_block))
+				return 0;
+
+			const struct _light_enhanced_packet_block *epb = (const struct _light_enhanced_packet_block*)body;
+			size_t padded_length = 0;
+			PADD32((size_t)epb->capture_packet_length, &padded_length);
+			if (padded_length > body_length - sizeof(struct _light_enhanced_packet_block))
+				return 0;
+
+			packet_header->interface_id = epb->interface_id;
+			packet_header->captured_length = epb->capture_packet_length;
+			packet_header->original_length = epb->original_capture_length;
+			uint64_t timestamp = epb->timestamp_high;
+			timestamp = timestamp << 32;
+			timestamp += epb->timestamp_low;
+			double timestamp_res = epb->interface_id < info->interface_block_count ? info->timestamp_resolution[epb->interface_id] : __power_of(10,-6);
+			packet_header->timestamp.tv_sec = timestamp * timestamp_res;
+			packet_header->timestamp.tv_usec = (timestamp - (packet_header->timestamp.tv_sec / timestamp_res))*timestamp_res*1000000;
+			packet_header->data_link = epb->interface_id < info->interface_block_count ? info->link_types[epb->interface_id] : 0;
+
+			*packet_data = (const uint8_t*)epb->packet_data;
+			options = *packet_data + padded_length;
+		}
+		else if (block_type == LIGHT_SIMPLE_PACKET_BLOCK)
+		{
+			if (body_length < sizeof(struct _light_simple_packet_block))
+				return 0;
+
+			const struct _light_simple_packet_block *spb = (const struct _light_simple_packet_block*)body;
+			uint32_t max_length = body_length - sizeof(struct _light_simple_packet_block);
+
+			packet_header->interface_id = 0;
+			packet_header->captured_length = spb->original_packet_length < max_length ? spb->original_packet_length : max_length;
+			packet_header->original_length = spb->original_packet_length;
+			packet_header->timestamp.tv_sec = 0;
+			packet_header->timestamp.tv_usec = 0;
+			packet_header->data_link = info->interface_block_count > 0 ? info->link_types[0] : 0;
+
+			*packet_data = (const uint8_t*)spb->packet_data;
+		}
+		else
+		{
+			//Interface blocks read again after seeking back were already added
+			if (block_type == LIGHT_INTERFACE_BLOCK && body_length >= sizeof(struct _light_interface_description_block) &&
+					(pcapng->interfaces_end == 0 || block_pos >= pcapng->interfaces_end))
+			{
+				const struct _light_interface_description_block *idb = (const struct _light_interface_description_block*)body;
+				uint16_t ts_resolution_length = 0;
+				const uint8_t *ts_resolution = __find_option_in_buffer(body + sizeof(struct _light_interface_description_block), body_end, LIGHT_OPTION_IF_TSRESOL, &ts_resolution_length);
+				__append_interface_to_file_info(idb->link_type, ts_resolution_length > 0 ? ts_resolution : NULL, info);
+			}
+
+			continue;
+		}
+
+		packet_header->comment = NULL;
+		packet_header->comment_length = 0;
+
+		if (read_comment && options != NULL)
+		{
+			uint16_t comment_length = 0;
+			const uint8_t *comment = __find_option_in_buffer(options, body_end, LIGHT_OPTION_COMMENT, &comment_length);
+			if (comment != NULL)
+			{
+				packet_header->comment = (char*)comment;
+				packet_header->comment_length = comment_length;
+			}
+		}
+
+		return 1;
+	}
+}
+
+void light_pcapng_set_read_buffer_size(light_pcapng_t *pcapng, size_t read_buffer_size)
+{
+	DCHECK_NULLP(pcapng, return);
+	pcapng->read_buffer_size = read_buffer_size;
+}
+
+int light_pcapng_seek(light_pcapng_t *pcapng, long pos)
+{
+	DCHECK_NULLP(pcapng, return -1);
+	DCHECK_NULLP(pcapng->file, return -1);
+
+	//Positions in a compressed file aren't positions in the capture
+	if (pcapng->file->decompression_context != NULL || pcapng->file->compression_context != NULL)
+		return -1;
+
+	//Blocks which were buffered by light_get_next_packet_buffered() but not consumed yet weren't scanned for interfaces
+	light_file_pos_t current_pos = pcapng->read_buffer_len > 0 ? pcapng->read_buffer_pos + (light_file_pos_t)pcapng->read_buffer_offset : light_get_pos(pcapng->file);
+	pcapng->read_buffer_len = 0;
+	pcapng->read_buffer_offset = 0;
+	if (current_pos > pcapng->interfaces_end)
+		pcapng->interfaces_end = current_pos;
+
+	//Packets after pos may belong to interfaces described before it which weren't read yet. Walk the blocks in between and read only
+	//the interface blocks, skipping over the rest
+	if (pos > pcapng->interfaces_end)
+	{
+		light_file_pos_t block_pos = pcapng->interfaces_end;
+		while (block_pos < pos)
+		{
+			uint32_t block_header[2];
+			if (light_set_pos(pcapng->file, block_pos) != 0 || light_read(pcapng->file, block_header, sizeof(block_header)) != sizeof(block_header))
+				return -1;
+
+			uint32_t block_length = block_header[1];
+			if (block_length < 3 * sizeof(uint32_t) || block_length % 4 != 0)
+				return -1;
+
+			if (block_header[0] == LIGHT_INTERFACE_BLOCK)
+			{
+				light_set_pos(pcapng->file, block_pos);
+				light_read_record(pcapng->file, &pcapng->pcapng);
+				if (pcapng->pcapng == NULL)
+					return -1;
+				__append_interface_block_to_file_info(pcapng->pcapng, pcapng->file_info);
+			}
+
+			block_pos += block_length;
+		}
+
+		pcapng->interfaces_end = pos;
+	}
+
+	return light_set_pos(pcapng->file, pos) == 0 ? 0 : -1;
+}
+
 void light_write_packet(light_pcapng_t *pcapng, const light_packet_header *packet_header, const uint8_t *packet_data)
 {
 	DCHECK_NULLP(pcapng, return);
@@ -520,6 +801,7 @@ void light_pcapng_close(light_pcapng_t *pcapng)
 		light_close(pcapng->file);
 	}
 	light_free_file_info(pcapng->file_info);
+	free(pcapng->read_buffer);
 	free(pcapng);
 }
 
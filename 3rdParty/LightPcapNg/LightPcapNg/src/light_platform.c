@@ -39,11 +39,11 @@
 
 #ifdef UNIVERSAL
 
-light_file light_open_decompression(const char *file_name, const __read_mode_t mode)
+light_file light_open_decompression(const char *file_name, const __read_mode_t mode, int num_workers)
 {
 	light_file fd = calloc(1, sizeof(light_file_t));
 	fd->file = INVALID_FILE;
-	fd->decompression_context = light_get_decompression_context();
+	fd->decompression_context = light_get_parallel_decompression_context(num_workers);
 
 	switch (mode)
 	{
@@ -66,6 +66,11 @@ light_file light_open_decompression(const char *file_name, const __read_mode_t m
 }
 
 light_file light_open(const char *file_name, const __read_mode_t mode)
+{
+	return light_open_parallel(file_name, mode, 0);
+}
+
+light_file light_open_parallel(const char *file_name, const __read_mode_t mode, int num_workers)
 {
 	light_file fd = calloc(1,sizeof(light_file_t));
 	fd->file = INVALID_FILE;
@@ -77,7 +82,8 @@ light_file light_open(const char *file_name, const __read_mode_t mode)
 	{
 		if (light_is_compressed_file(file_name))
 		{
-			return light_open_decompression(file_name, mode);
+			free(fd);
+			return light_open_decompression(file_name, mode, num_workers);
 		}
 		fd->file = fopen(file_name, "rb");
 		break;
@@ -101,6 +107,11 @@ light_file light_open(const char *file_name, const __read_mode_t mode)
 }
 
 light_file light_open_compression(const char *file_name, const __read_mode_t mode, int compression_level)
+{
+	return light_open_compression_parallel(file_name, mode, compression_level, 0);
+}
+
+light_file light_open_compression_parallel(const char *file_name, const __read_mode_t mode, int compression_level, int num_workers)
 {
 	light_file fd = calloc(1, sizeof(light_file_t));
 	fd->file = INVALID_FILE;
@@ -109,7 +120,7 @@ light_file light_open_compression(const char *file_name, const __read_mode_t mod
 	compression_level = max(0, compression_level);
 	compression_level = min(compression_level, 10);
 
-	fd->compression_context = light_get_compression_context(compression_level);
+	fd->compression_context = light_get_parallel_compression_context(compression_level, num_workers);
 
 	switch (mode)
 	{
@@ -28,17 +28,208 @@
 #include "light_file.h"
 #include <stdlib.h>
 #include <memory.h>
+#include <string.h>
 #include <assert.h>
 
+//Visual studio gives us min + max for free, but other OS does not....
+#if !defined(max) && !defined(min)
+#define max(a,b) (((a) > (b)) ? (a) : (b))
+#define min(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+
 struct _compression_t * (*get_compression_context_ptr)(int) = &get_zstd_compression_context;
 void(*free_compression_context_ptr)(struct _compression_t*) = &free_zstd_compression_context;
 struct _decompression_t * (*get_decompression_context_ptr)() = &get_zstd_decompression_context;
+struct _compression_t * (*get_parallel_compression_context_ptr)(int, int) = &get_zstd_parallel_compression_context;
+struct _decompression_t * (*get_parallel_decompression_context_ptr)(int) = &get_zstd_parallel_decompression_context;
 void(*free_decompression_context_ptr)(struct _decompression_t*) = &free_zstd_decompression_context;
 int(*is_compressed_file)(const char*) = &is_zstd_compressed_file;
 size_t(*read_compressed)(struct light_file_t *, void *, size_t) = &read_zstd_compressed;
 size_t(*write_compressed)(struct light_file_t *, const void *, size_t) = &write_zstd_compressed;
 int(*close_compressed)(struct light_file_t *) = &close_zstd_compresssed;
 
+static void* zstd_worker_main(void* arg)
+{
+	struct zstd_worker_pool_t* pool = (struct zstd_worker_pool_t*)arg;
+	ZSTD_CCtx* cctx = pool->compress ? ZSTD_createCCtx() : NULL;
+	ZSTD_DCtx* dctx = pool->compress ? NULL : ZSTD_createDCtx();
+
+	pthread_mutex_lock(&pool->mutex);
+	while (1)
+	{
+		//Frames are queued in ring order so the next one to pick is always the oldest queued frame
+		struct zstd_frame_job_t* job = &pool->jobs[pool->next_job];
+		while (!pool->stop && job->state != LIGHT_ZSTD_FRAME_QUEUED)
+		{
+			pthread_cond_wait(&pool->job_queued, &pool->mutex);
+			job = &pool->jobs[pool->next_job];
+		}
+		if (pool->stop)
+			break;
+
+		job->state = LIGHT_ZSTD_FRAME_BUSY;
+		pool->next_job = (pool->next_job + 1) % pool->num_jobs;
+		pthread_mutex_unlock(&pool->mutex);
+
+		int error = 1;
+		if (pool->compress && cctx != NULL)
+		{
+			size_t const result = ZSTD_compressCCtx(cctx, job->out, job->out_max_size, job->in, job->in_size, pool->compression_level);
+			if (!ZSTD_isError(result))
+			{
+				job->out_size = result;
+				error = 0;
+			}
+		}
+		else if (!pool->compress && dctx != NULL)
+		{
+			//The size of the output is known up front from the frame header
+			size_t const result = ZSTD_decompressDCtx(dctx, job->out, job->out_size, job->in, job->in_size);
+			error = (ZSTD_isError(result) || result != job->out_size);
+		}
+
+		pthread_mutex_lock(&pool->mutex);
+		job->error = error;
+		job->state = LIGHT_ZSTD_FRAME_DONE;
+		pthread_cond_broadcast(&pool->job_done);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (cctx)
+		ZSTD_freeCCtx(cctx);
+	if (dctx)
+		ZSTD_freeDCtx(dctx);
+
+	return NULL;
+}
+
+//Returns 0 if at least one worker was started. Frame buffers of size 0 are allocated by the caller when they're needed
+static int zstd_pool_start(struct zstd_worker_pool_t* pool, int num_workers, int compress, int compression_level, size_t in_max_size, size_t out_max_size)
+{
+	size_t i;
+	pool->num_jobs = 2 * num_workers;
+	pool->jobs = calloc(pool->num_jobs, sizeof(struct zstd_frame_job_t));
+	pool->threads = calloc(num_workers, sizeof(pthread_t));
+	if (pool->jobs == NULL || pool->threads == NULL)
+		goto fail;
+
+	for (i = 0; i < pool->num_jobs; i++)
+	{
+		struct zstd_frame_job_t* job = &pool->jobs[i];
+		job->state = LIGHT_ZSTD_FRAME_FREE;
+		if (in_max_size > 0 && (job->in = malloc(in_max_size)) == NULL)
+			goto fail;
+		job->in_max_size = in_max_size;
+		if (out_max_size > 0 && (job->out = malloc(out_max_size)) == NULL)
+			goto fail;
+		job->out_max_size = out_max_size;
+	}
+
+	pool->submit_job = pool->collect_job = pool->next_job = 0;
+	pool->stop = 0;
+	pool->compress = compress;
+	pool->compression_level = compression_level;
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->job_queued, NULL);
+	pthread_cond_init(&pool->job_done, NULL);
+
+	pool->num_threads = 0;
+	for (i = 0; i < (size_t)num_workers; i++)
+	{
+		if (pthread_create(&pool->threads[i], NULL, zstd_worker_main, pool) != 0)
+			break;
+		pool->num_threads++;
+	}
+
+	if (pool->num_threads > 0)
+		return 0;
+
+	pthread_cond_destroy(&pool->job_done);
+	pthread_cond_destroy(&pool->job_queued);
+	pthread_mutex_destroy(&pool->mutex);
+
+fail:
+	if (pool->jobs)
+	{
+		for (i = 0; i < pool->num_jobs; i++)
+		{
+			free(pool->jobs[i].in);
+			free(pool->jobs[i].out);
+		}
+	}
+	free(pool->jobs);
+	free(pool->threads);
+	memset(pool, 0, sizeof(struct zstd_worker_pool_t));
+	return -1;
+}
+
+static void zstd_pool_free(struct zstd_worker_pool_t* pool)
+{
+	size_t i;
+	if (pool->threads == NULL)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->job_queued);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (i = 0; i < (size_t)pool->num_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_cond_destroy(&pool->job_done);
+	pthread_cond_destroy(&pool->job_queued);
+	pthread_mutex_destroy(&pool->mutex);
+
+	for (i = 0; i < pool->num_jobs; i++)
+	{
+		free(pool->jobs[i].in);
+		free(pool->jobs[i].out);
+	}
+	free(pool->jobs);
+	free(pool->threads);
+	memset(pool, 0, sizeof(struct zstd_worker_pool_t));
+}
+
+static enum zstd_frame_state_t zstd_pool_job_state(struct zstd_worker_pool_t* pool, size_t job)
+{
+	pthread_mutex_lock(&pool->mutex);
+	enum zstd_frame_state_t state = pool->jobs[job].state;
+	pthread_mutex_unlock(&pool->mutex);
+	return state;
+}
+
+//Hand the frame at submit_job, which the caller filled, to the workers
+static void zstd_pool_submit(struct zstd_worker_pool_t* pool)
+{
+	pthread_mutex_lock(&pool->mutex);
+	pool->jobs[pool->submit_job].state = LIGHT_ZSTD_FRAME_QUEUED;
+	pthread_cond_signal(&pool->job_queued);
+	pthread_mutex_unlock(&pool->mutex);
+	pool->submit_job = (pool->submit_job + 1) % pool->num_jobs;
+}
+
+//Wait for the frame at collect_job, which must have been submitted, to be (de)compressed
+static struct zstd_frame_job_t* zstd_pool_collect(struct zstd_worker_pool_t* pool)
+{
+	struct zstd_frame_job_t* job = &pool->jobs[pool->collect_job];
+	pthread_mutex_lock(&pool->mutex);
+	while (job->state != LIGHT_ZSTD_FRAME_DONE)
+		pthread_cond_wait(&pool->job_done, &pool->mutex);
+	pthread_mutex_unlock(&pool->mutex);
+	return job;
+}
+
+//Give the frame at collect_job back to the caller for filling
+static void zstd_pool_release(struct zstd_worker_pool_t* pool)
+{
+	pthread_mutex_lock(&pool->mutex);
+	pool->jobs[pool->collect_job].state = LIGHT_ZSTD_FRAME_FREE;
+	pool->jobs[pool->collect_job].in_size = 0;
+	pthread_mutex_unlock(&pool->mutex);
+	pool->collect_job = (pool->collect_job + 1) % pool->num_jobs;
+}
+
 _compression_t * get_zstd_compression_context(int compression_level)
 {
 	struct zstd_compression_t *context = calloc(1, sizeof(struct zstd_compression_t));
@@ -50,7 +241,23 @@ _compression_t * get_zstd_compression_context(int compression_level)
 	context->buffer_in = malloc(context->buffer_in_max_size);
 	context->buffer_out = malloc(context->buffer_out_max_size);
 	context->compression_level = compression_level * 2; //Input is scale 0-10 but zstd goes 0 - 20!
-	assert(!ZSTD_isError(ZSTD_CCtx_setParameter(context->cctx, ZSTD_c_compressionLevel, compression_level)));
+	size_t const result = ZSTD_CCtx_setParameter(context->cctx, ZSTD_c_compressionLevel, context->compression_level);
+	assert(!ZSTD_isError(result));
+	(void)result;
+
+	return context;
+}
+
+_compression_t * get_zstd_parallel_compression_context(int compression_level, int num_workers)
+{
+	struct zstd_compression_t *context = get_zstd_compression_context(compression_level);
+	if (num_workers <= 0)
+		return context;
+
+	//Every frame is compressed in one shot, so the output buffer is big enough for incompressible data as well.
+	//If no worker can be started the file is compressed as a stream by the calling thread
+	if (zstd_pool_start(&context->pool, num_workers, 1, context->compression_level, LIGHT_ZSTD_FRAME_SIZE, ZSTD_compressBound(LIGHT_ZSTD_FRAME_SIZE)) == 0)
+		context->num_workers = context->pool.num_threads;
 
 	return context;
 }
@@ -60,6 +267,7 @@ void free_zstd_compression_context(_compression_t* context)
 	if (!context)
 		return;
 
+	zstd_pool_free(&context->pool);
 	if (context->cctx)
 		ZSTD_freeCCtx(context->cctx);
 	if (context->buffer_out)
@@ -87,11 +295,21 @@ _decompression_t * get_zstd_decompression_context()
 	return context;
 }
 
+_decompression_t * get_zstd_parallel_decompression_context(int num_workers)
+{
+	struct zstd_decompression_t *context = get_zstd_decompression_context();
+	//The workers are started on the first read, once it's known the file can be decompressed in parallel
+	context->num_workers = max(num_workers, 0);
+	return context;
+}
+
 void free_zstd_decompression_context(_decompression_t* context)
 {
 	if (!context)
 		return;
 
+	zstd_pool_free(&context->pool);
+	free(context->pending);
 	if (context->dctx)
 		ZSTD_freeDCtx(context->dctx);
 	if (context->buffer_out)
@@ -111,8 +329,187 @@ int is_zstd_compressed_file(const char* file_path)
 		return 0; 
 }
 
+//Returns the compressed size of the next frame in the read ahead buffer, reading from file until it holds the whole frame,
+//or 0 if there are no more frames
+static size_t zstd_next_frame_size(struct zstd_decompression_t* context, FILE* file)
+{
+	while (1)
+	{
+		size_t const available = context->pending_size - context->pending_pos;
+		if (available > 0)
+		{
+			size_t const frame_size = ZSTD_findFrameCompressedSize(context->pending + context->pending_pos, available);
+			if (!ZSTD_isError(frame_size))
+				return frame_size;
+		}
+
+		//The frame isn't complete: move what's left of it to the start of the buffer and grow the buffer if it's full
+		if (context->pending_pos > 0)
+		{
+			memmove(context->pending, context->pending + context->pending_pos, available);
+			context->pending_pos = 0;
+			context->pending_size = available;
+		}
+		if (context->pending_size == context->pending_max_size)
+		{
+			size_t const new_size = max(2 * context->pending_max_size, ZSTD_compressBound(LIGHT_ZSTD_FRAME_SIZE));
+			uint8_t* new_buffer = realloc(context->pending, new_size);
+			if (new_buffer == NULL)
+			{
+				context->failed = 1;
+				return 0;
+			}
+			context->pending = new_buffer;
+			context->pending_max_size = new_size;
+		}
+
+		size_t const bytes_read_file = fread(context->pending + context->pending_size, 1, context->pending_max_size - context->pending_size, file);
+		if (bytes_read_file == 0)
+		{
+			//Anything left is a truncated or corrupt frame
+			if (available > 0)
+				context->failed = 1;
+			return 0;
+		}
+		context->pending_size += bytes_read_file;
+	}
+}
+
+//Read ahead as many frames as there are free slots in the ring and queue them for decompression
+static void zstd_read_ahead(struct zstd_decompression_t* context, FILE* file)
+{
+	struct zstd_worker_pool_t* pool = &context->pool;
+	while (!context->input_done && zstd_pool_job_state(pool, pool->submit_job) == LIGHT_ZSTD_FRAME_FREE)
+	{
+		size_t const frame_size = zstd_next_frame_size(context, file);
+		if (frame_size == 0)
+		{
+			context->input_done = 1;
+			break;
+		}
+
+		uint8_t* frame = context->pending + context->pending_pos;
+		unsigned long long const content_size = ZSTD_getFrameContentSize(frame, frame_size);
+		if (content_size == ZSTD_CONTENTSIZE_UNKNOWN || content_size == ZSTD_CONTENTSIZE_ERROR || content_size != (size_t)content_size)
+		{
+			//Only frames which record their decompressed size can be decompressed in parallel
+			context->failed = 1;
+			context->input_done = 1;
+			break;
+		}
+
+		struct zstd_frame_job_t* job = &pool->jobs[pool->submit_job];
+		if (frame_size > job->in_max_size)
+		{
+			uint8_t* new_buffer = realloc(job->in, frame_size);
+			if (new_buffer == NULL)
+			{
+				context->failed = 1;
+				context->input_done = 1;
+				break;
+			}
+			job->in = new_buffer;
+			job->in_max_size = frame_size;
+		}
+		if (content_size > job->out_max_size)
+		{
+			uint8_t* new_buffer = realloc(job->out, (size_t)content_size);
+			if (new_buffer == NULL)
+			{
+				context->failed = 1;
+				context->input_done = 1;
+				break;
+			}
+			job->out = new_buffer;
+			job->out_max_size = (size_t)content_size;
+		}
+
+		memcpy(job->in, frame, frame_size);
+		job->in_size = frame_size;
+		job->out_size = (size_t)content_size;
+		job->error = 0;
+		context->pending_pos += frame_size;
+		zstd_pool_submit(pool);
+	}
+}
+
+//Decide on the first read whether the file is decompressed in parallel or as a stream. Whatever was read from file to find out
+//is handed to the streaming decompressor if that's the case
+static void zstd_choose_read_mode(light_file fd)
+{
+	struct zstd_decompression_t* context = fd->decompression_context;
+	context->mode_chosen = 1;
+	if (context->num_workers <= 0)
+		return;
+
+	//Only the frame header is needed to decide, a file compressed as a stream may be a single frame as big as the file
+	context->pending_max_size = ZSTD_compressBound(LIGHT_ZSTD_FRAME_SIZE);
+	context->pending = malloc(context->pending_max_size);
+	if (context->pending == NULL)
+	{
+		context->pending_max_size = 0;
+		return;
+	}
+	context->pending_size = fread(context->pending, 1, context->pending_max_size, fd->file);
+
+	unsigned long long const content_size = ZSTD_getFrameContentSize(context->pending, context->pending_size);
+	if (content_size != ZSTD_CONTENTSIZE_UNKNOWN && content_size != ZSTD_CONTENTSIZE_ERROR &&
+		zstd_pool_start(&context->pool, context->num_workers, 0, 0, 0, 0) == 0)
+	{
+		context->parallel = 1;
+		return;
+	}
+
+	context->input.src = context->pending + context->pending_pos;
+	context->input.size = context->pending_size - context->pending_pos;
+	context->input.pos = 0;
+}
+
+static size_t read_zstd_parallel(light_file fd, void *buf, size_t count)
+{
+	struct zstd_decompression_t* context = fd->decompression_context;
+	struct zstd_worker_pool_t* pool = &context->pool;
+	size_t bytes_read = 0;
+
+	while (bytes_read < count)
+	{
+		//Refill the ring whenever a new frame is started, so the workers stay ahead of the reader
+		if (context->consumed == 0)
+			zstd_read_ahead(context, fd->file);
+
+		if (zstd_pool_job_state(pool, pool->collect_job) == LIGHT_ZSTD_FRAME_FREE)
+			return bytes_read > 0 ? bytes_read : (size_t)EOF;
+
+		struct zstd_frame_job_t* job = zstd_pool_collect(pool);
+		if (job->error)
+		{
+			context->failed = 1;
+			context->input_done = 1;
+			return EOF;
+		}
+
+		size_t const to_copy = min(count - bytes_read, job->out_size - context->consumed);
+		memcpy((uint8_t*)buf + bytes_read, job->out + context->consumed, to_copy);
+		context->consumed += to_copy;
+		bytes_read += to_copy;
+
+		if (context->consumed == job->out_size)
+		{
+			context->consumed = 0;
+			zstd_pool_release(pool);
+		}
+	}
+
+	return bytes_read;
+}
+
 size_t read_zstd_compressed(light_file fd, void *buf, size_t count)
 {
+	if (!fd->decompression_context->mode_chosen)
+		zstd_choose_read_mode(fd);
+	if (fd->decompression_context->parallel)
+		return read_zstd_parallel(fd, buf, count);
+
 	//Decompression is a little more complex
 	//Need to manage reading bytes from orignal file
 	//Decompressing those into a buffer
@@ -181,8 +578,49 @@ size_t read_zstd_compressed(light_file fd, void *buf, size_t count)
 	return bytes_read;
 }
 
+//Write the frame at collect_job to file once it's compressed. Frames are written in the order they were submitted
+static void zstd_write_collected_frame(light_file fd)
+{
+	struct zstd_worker_pool_t* pool = &fd->compression_context->pool;
+	struct zstd_frame_job_t* job = zstd_pool_collect(pool);
+	if (job->error || fwrite(job->out, 1, job->out_size, fd->file) != job->out_size)
+		fd->compression_context->failed = 1;
+	zstd_pool_release(pool);
+}
+
+static size_t write_zstd_parallel(light_file fd, const void *buf, size_t count)
+{
+	struct zstd_worker_pool_t* pool = &fd->compression_context->pool;
+	size_t bytes_copied = 0;
+
+	while (bytes_copied < count)
+	{
+		struct zstd_frame_job_t* job = &pool->jobs[pool->submit_job];
+		size_t const to_copy = min(count - bytes_copied, job->in_max_size - job->in_size);
+		memcpy(job->in + job->in_size, (const uint8_t*)buf + bytes_copied, to_copy);
+		job->in_size += to_copy;
+		bytes_copied += to_copy;
+
+		if (job->in_size < job->in_max_size)
+			break;
+
+		zstd_pool_submit(pool);
+
+		//Write whatever is already compressed, and if the ring is full wait for the oldest frame so its slot can be filled next
+		while (pool->collect_job != pool->submit_job && zstd_pool_job_state(pool, pool->collect_job) == LIGHT_ZSTD_FRAME_DONE)
+			zstd_write_collected_frame(fd);
+		if (zstd_pool_job_state(pool, pool->submit_job) != LIGHT_ZSTD_FRAME_FREE)
+			zstd_write_collected_frame(fd);
+	}
+
+	return fd->compression_context->failed ? (size_t)-1 : count;
+}
+
 size_t write_zstd_compressed(light_file fd, const void *buf, size_t count)
 {
+	if (fd->compression_context->num_workers > 0)
+		return write_zstd_parallel(fd, buf, count);
+
 	//Do compression here!
 	/* Set the input buffer to what we just read.
 	* We compress until the input buffer is empty, each time flushing the
@@ -211,7 +649,18 @@ size_t write_zstd_compressed(light_file fd, const void *buf, size_t count)
 int close_zstd_compresssed(light_file fd)
 {
 	//Wrap up the compression here
-	if (fd->compression_context)
+	if (fd->compression_context && fd->compression_context->num_workers > 0)
+	{
+		//Compress the last partial frame and write all frames still in the ring
+		struct zstd_worker_pool_t* pool = &fd->compression_context->pool;
+		if (pool->jobs[pool->submit_job].in_size > 0)
+			zstd_pool_submit(pool);
+		while (zstd_pool_job_state(pool, pool->collect_job) != LIGHT_ZSTD_FRAME_FREE)
+			zstd_write_collected_frame(fd);
+
+		return fd->compression_context->failed ? -1 : 0;
+	}
+	else if (fd->compression_context)
 	{
 		ZSTD_inBuffer input = { 0,0,0 };
 
@@ -224,6 +673,8 @@ int close_zstd_compresssed(light_file fd)
 			fwrite(output.dst, 1, output.pos, fd->file);
 		}
 	}
+
+	return 0;
 }
 
 #endif // USE_Z_STD
\ No newline at end of file
@@ -8,4 +8,5 @@ void __static_mem_check(size_t&  memCount, uint64_t& memSize, bool verbose, cons
 void __start(bool verbose, const char* fileDumperName, bool append);
 void __stop();
 void __stop_and_free_all_mem();
-void __program_started();
\ No newline at end of file
+void __program_started();
+void __allocation_count(uint64_t& allocCount, uint64_t& allocSize);
\ No newline at end of file
@@ -32,6 +32,8 @@ class MemPlumberInternal {
 
     bool m_Started;
     int m_ProgramStarted;
+    uint64_t m_AllocationCount;
+    uint64_t m_AllocationSize;
     bool m_Verbose;
     FILE* m_Dumper;
 
@@ -39,6 +41,8 @@ class MemPlumberInternal {
     MemPlumberInternal() {
         m_Started = false;
         m_Verbose = false;
+        m_AllocationCount = 0;
+        m_AllocationSize = 0;
 
         // zero the hashtables
         for (int i = 0; i < MEMPLUMBER_HASHTABLE_SIZE; i++) {
@@ -97,8 +101,17 @@ class MemPlumberInternal {
         return instance;
     }
 
+    // whether allocations are recorded right now, i.e. their caller is needed
+    bool isCollecting() const {
+        return m_ProgramStarted == 0 || m_Started;
+    }
+
     void* allocateMemory(std::size_t size, const char* file, int line) {
 
+        // allocations are counted whether or not collection has started
+        m_AllocationCount++;
+        m_AllocationSize += (uint64_t)size;
+
         // if not started, allocate memory and exit
         if (m_ProgramStarted != 0 && !m_Started) {
             if (isVerbose()) {
@@ -303,6 +316,11 @@ class MemPlumberInternal {
         closeFile(dumper);
     }
 
+    void allocationCount(uint64_t& allocCount, uint64_t& allocSize) {
+        allocCount = m_AllocationCount;
+        allocSize = m_AllocationSize;
+    }
+
     void freeAllMemory() {
         for (int index = 0; index < MEMPLUMBER_HASHTABLE_SIZE; ++index) {
             new_ptr_list_t* metaDataBucketLinkedListElement = m_PointerListHashtable[index];
@@ -352,6 +370,11 @@ const char* getCaller() {
 #else
 #include <execinfo.h>
 const char* getCaller() {
+    // backtrace_symbols() is expensive (and allocates), so skip it when the allocation isn't recorded anyway
+    if (!MemPlumberInternal::getInstance().isCollecting()) {
+        return "Unknown";
+    }
+
     void* backtraceArr[3];
     size_t backtraceArrSize;
 
@@ -451,3 +474,7 @@ void __stop_and_free_all_mem() {
 void __program_started() {
     MemPlumberInternal::getInstance().programStarted();
 }
+
+void __allocation_count(uint64_t& allocCount, uint64_t& allocSize) {
+    MemPlumberInternal::getInstance().allocationCount(allocCount, allocSize);
+}
@@ -85,6 +85,67 @@ class MemPlumber {
         static void staticMemCheck(size_t& memCount, uint64_t& memSize, bool verbose = false, const char* fileDumperName = "", bool append = false) {
             __static_mem_check(memCount, memSize, verbose, fileDumperName, append);
         }
+
+        /**
+         * Get the number of memory allocations and the total amount of memory allocated since the program started. Unlike the other
+         * methods, these counters are updated whether or not start() was called, and they aren't decremented when memory is freed.
+         * They are meant for measuring how many allocations a piece of code makes (see MemPlumberAllocationScope)
+         * @param[out] allocCount The number of memory allocations made so far
+         * @param[out] allocSize The total amount of memory allocated so far
+         */
+        static void allocationCount(uint64_t& allocCount, uint64_t& allocSize) {
+            __allocation_count(allocCount, allocSize);
+        }
+};
+
+/**
+ * @class MemPlumberAllocationScope
+ * Counts the memory allocations made from the moment it's created (or reset) until the moment the counters are read. For example:
+ *
+ *     MemPlumberAllocationScope scope;
+ *     packet.setRawPacket(rawPacket, false);
+ *     printf("%d allocations\n", (int)scope.getAllocationCount());
+ *
+ * Memory freed inside the scope doesn't reduce the counters
+ */
+class MemPlumberAllocationScope {
+    private:
+        uint64_t m_StartCount;
+        uint64_t m_StartSize;
+
+    public:
+
+        /**
+         * Start counting allocations from now
+         */
+        MemPlumberAllocationScope() {
+            reset();
+        }
+
+        /**
+         * Restart counting allocations from now
+         */
+        void reset() {
+            MemPlumber::allocationCount(m_StartCount, m_StartSize);
+        }
+
+        /**
+         * @return The number of memory allocations made since the scope was created or reset
+         */
+        uint64_t getAllocationCount() const {
+            uint64_t count, size;
+            MemPlumber::allocationCount(count, size);
+            return count - m_StartCount;
+        }
+
+        /**
+         * @return The total amount of memory allocated since the scope was created or reset
+         */
+        uint64_t getAllocationSize() const {
+            uint64_t count, size;
+            MemPlumber::allocationCount(count, size);
+            return size - m_StartSize;
+        }
 };
 
 #ifdef COLLECT_STATIC_VAR_DATA
@@ -0,0 +1,237 @@
+#ifndef PCAPPP_ATOMIC_UTILS
+#define PCAPPP_ATOMIC_UTILS
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/// @file
+
+/**
+ * Memory-ordered accesses to integers and pointers shared between threads, for code which can't use std::atomic. The variables are plain
+ * (usually volatile) integers or pointers, and each access states its ordering:
+ * - Acquire loads and release stores, for publishing data from one thread to another: everything written before a release store is
+ *   visible to a thread whose acquire load read the stored value
+ * - Relaxed loads and stores, for counters and flags which don't publish other data but mustn't be torn or cached in a register
+ * - Read-modify-write operations (compare-and-swap, add, increment and decrement)
+ *
+ * With GCC and clang these are the __atomic builtins. With MSVC volatile accesses already have acquire/release semantics, so loads and
+ * stores are volatile accesses with a compiler barrier that prevents reordering, and read-modify-write operations are the _Interlocked
+ * intrinsics. As with the builtins, 64-bit loads and stores are atomic only when the platform's aligned 64-bit accesses are
+ */
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct AtomicValue
+	 * The type of the value parameters of the atomic functions. It makes them take the type of the variable (for example a literal 0 is
+	 * converted to size_t when stored to a size_t variable) instead of taking part in template argument deduction
+	 */
+	template<typename T>
+	struct AtomicValue
+	{
+		typedef T Type;
+	};
+
+#if defined(_MSC_VER)
+
+	/**
+	 * @struct AtomicInterlocked
+	 * The _Interlocked intrinsics for integers of a given size, used by the read-modify-write functions with MSVC
+	 */
+	template<size_t Size>
+	struct AtomicInterlocked;
+
+	template<>
+	struct AtomicInterlocked<4>
+	{
+		template<typename T>
+		static inline T compareExchange(volatile T* ptr, T expected, T desired) { return (T)_InterlockedCompareExchange((volatile long*)ptr, (long)desired, (long)expected); }
+
+		template<typename T>
+		static inline T fetchAdd(volatile T* ptr, T value) { return (T)_InterlockedExchangeAdd((volatile long*)ptr, (long)value); }
+	};
+
+	template<>
+	struct AtomicInterlocked<8>
+	{
+		template<typename T>
+		static inline T compareExchange(volatile T* ptr, T expected, T desired) { return (T)_InterlockedCompareExchange64((volatile __int64*)ptr, (__int64)desired, (__int64)expected); }
+
+		template<typename T>
+		static inline T fetchAdd(volatile T* ptr, T value) { return (T)_InterlockedExchangeAdd64((volatile __int64*)ptr, (__int64)value); }
+	};
+
+#endif
+
+	/**
+	 * Load a variable with acquire ordering: memory accesses following the load can't be moved before it
+	 * @param[in] ptr A pointer to the variable
+	 * @return The value of the variable
+	 */
+	template<typename T>
+	inline T atomicLoadAcquire(const volatile T* ptr)
+	{
+#if defined(_MSC_VER)
+		T value = *ptr;
+		_ReadWriteBarrier();
+		return value;
+#else
+		return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+	}
+
+	/**
+	 * Store a value to a variable with release ordering: memory accesses preceding the store can't be moved after it
+	 * @param[in] ptr A pointer to the variable
+	 * @param[in] value The value to store
+	 */
+	template<typename T>
+	inline void atomicStoreRelease(volatile T* ptr, typename AtomicValue<T>::Type value)
+	{
+#if defined(_MSC_VER)
+		_ReadWriteBarrier();
+		*ptr = value;
+#else
+		__atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+	}
+
+	/**
+	 * Load a variable without ordering other memory accesses
+	 * @param[in] ptr A pointer to the variable
+	 * @return The value of the variable
+	 */
+	template<typename T>
+	inline T atomicLoadRelaxed(const volatile T* ptr)
+	{
+#if defined(_MSC_VER)
+		return *ptr;
+#else
+		return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+#endif
+	}
+
+	/**
+	 * Store a value to a variable without ordering other memory accesses
+	 * @param[in] ptr A pointer to the variable
+	 * @param[in] value The value to store
+	 */
+	template<typename T>
+	inline void atomicStoreRelaxed(volatile T* ptr, typename AtomicValue<T>::Type value)
+	{
+#if defined(_MSC_VER)
+		*ptr = value;
+#else
+		__atomic_store_n(ptr, value, __ATOMIC_RELAXED);
+#endif
+	}
+
+	/**
+	 * Load a pointer with acquire ordering, usually to read an object another thread published with atomicStorePointerRelease()
+	 * @param[in] ptr A pointer to the pointer variable
+	 * @return The value of the pointer variable
+	 */
+	template<typename T>
+	inline T* atomicLoadPointerAcquire(T* const volatile* ptr)
+	{
+		return atomicLoadAcquire<T*>(ptr);
+	}
+
+	/**
+	 * Store a pointer with release ordering, usually to publish an object whose fields were written before the store
+	 * @param[in] ptr A pointer to the pointer variable
+	 * @param[in] value The pointer to store
+	 */
+	template<typename T>
+	inline void atomicStorePointerRelease(T* volatile* ptr, typename AtomicValue<T*>::Type value)
+	{
+		atomicStoreRelease<T*>(ptr, value);
+	}
+
+	/**
+	 * Replace the value of an integer variable if it equals an expected value, with acquire and release ordering
+	 * @param[in] ptr A pointer to the variable. Its size must be 4 or 8 bytes
+	 * @param[in] expected The value the variable should have
+	 * @param[in] desired The value to store if the variable has the expected value
+	 * @return True if the variable had the expected value and desired was stored, false otherwise
+	 */
+	template<typename T>
+	inline bool atomicCompareExchange(volatile T* ptr, typename AtomicValue<T>::Type expected, typename AtomicValue<T>::Type desired)
+	{
+#if defined(_MSC_VER)
+		return AtomicInterlocked<sizeof(T)>::compareExchange(ptr, expected, desired) == expected;
+#else
+		return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+#endif
+	}
+
+	/**
+	 * Add a value to an integer variable without ordering other memory accesses, usually to update a counter shared by several threads
+	 * @param[in] ptr A pointer to the variable. Its size must be 4 or 8 bytes
+	 * @param[in] value The value to add
+	 * @return The value of the variable before the addition
+	 */
+	template<typename T>
+	inline T atomicFetchAdd(volatile T* ptr, typename AtomicValue<T>::Type value)
+	{
+#if defined(_MSC_VER)
+		return AtomicInterlocked<sizeof(T)>::fetchAdd(ptr, value);
+#else
+		return __atomic_fetch_add(ptr, value, __ATOMIC_RELAXED);
+#endif
+	}
+
+	/**
+	 * Increment an integer variable with acquire and release ordering, usually a reference count
+	 * @param[in] ptr A pointer to the variable. Its size must be 4 or 8 bytes
+	 * @return The value of the variable after the increment
+	 */
+	template<typename T>
+	inline T atomicIncrement(volatile T* ptr)
+	{
+#if defined(_MSC_VER)
+		return AtomicInterlocked<sizeof(T)>::fetchAdd(ptr, (T)1) + 1;
+#else
+		return __atomic_add_fetch(ptr, 1, __ATOMIC_ACQ_REL);
+#endif
+	}
+
+	/**
+	 * Decrement an integer variable with acquire and release ordering, usually a reference count
+	 * @param[in] ptr A pointer to the variable. Its size must be 4 or 8 bytes
+	 * @return The value of the variable after the decrement
+	 */
+	template<typename T>
+	inline T atomicDecrement(volatile T* ptr)
+	{
+#if defined(_MSC_VER)
+		return AtomicInterlocked<sizeof(T)>::fetchAdd(ptr, (T)-1) - 1;
+#else
+		return __atomic_sub_fetch(ptr, 1, __ATOMIC_ACQ_REL);
+#endif
+	}
+
+	/**
+	 * An acquire fence: memory accesses following the fence can't be moved before loads preceding it. Used after relaxed loads which
+	 * should have acquire ordering together
+	 */
+	inline void atomicAcquireFence()
+	{
+#if defined(_MSC_VER)
+		_ReadWriteBarrier();
+#else
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+	}
+
+} // namespace pcpp
+
+#endif /* PCAPPP_ATOMIC_UTILS */
@@ -0,0 +1,70 @@
+#ifndef PCAPPP_CPU_FEATURES
+#define PCAPPP_CPU_FEATURES
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class CpuFeatures
+	 * The instruction set extensions of the CPU the program runs on, for code which is built with several kernels (for example SSE2, AVX2
+	 * and scalar ones) and picks the best one the CPU supports at runtime. Kernels are usually selected once, on first use, and kept in a
+	 * function pointer.
+	 * On x86 the CPU is queried once, with __builtin_cpu_supports() on GCC and clang and with CPUID on MSVC. Extensions which use the AVX
+	 * registers are reported only if the operating system saves these registers on context switches. On ARM NEON and the CRC32
+	 * instructions are reported if the library is built for a CPU which has them, as the kernels using them are built only in that case.
+	 * All methods are static and thread-safe, and return false for extensions of other architectures
+	 */
+	class CpuFeatures
+	{
+	public:
+
+		/**
+		 * @return True if the CPU supports SSE2
+		 */
+		static bool hasSse2();
+
+		/**
+		 * @return True if the CPU supports SSSE3
+		 */
+		static bool hasSsse3();
+
+		/**
+		 * @return True if the CPU supports SSE4.2, which includes the CRC32C instruction
+		 */
+		static bool hasSse42();
+
+		/**
+		 * @return True if the CPU and the operating system support AVX2
+		 */
+		static bool hasAvx2();
+
+		/**
+		 * @return True if the CPU and the operating system support AVX-512 Foundation
+		 */
+		static bool hasAvx512f();
+
+		/**
+		 * @return True if the CPU has an invariant TSC (time stamp counter), which runs at a constant rate in all power states
+		 */
+		static bool hasInvariantTsc();
+
+		/**
+		 * @return True if the library is built for an ARM CPU with NEON
+		 */
+		static bool hasNeon();
+
+		/**
+		 * @return True if the library is built for an ARM CPU with the CRC32 instructions
+		 */
+		static bool hasArmCrc32();
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_CPU_FEATURES */
@@ -0,0 +1,351 @@
+#ifndef PCAPPP_FIXED_LRU_LIST
+#define PCAPPP_FIXED_LRU_LIST
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "OpenAddressingTable.h"
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct LRUHash
+	 * The default hash functor of FixedLRUList. It works for integral types (and any type convertible to uint64_t) by mixing all bits
+	 * of the value, so values which differ only in their high bits don't collide. For other types a functor with the same signature
+	 * should be provided
+	 */
+	template<typename T>
+	struct LRUHash
+	{
+		/**
+		 * @param[in] element The element to hash
+		 * @return A 32-bit hash value of the element
+		 */
+		uint32_t operator()(const T& element) const
+		{
+			// the finalizer of MurmurHash3
+			uint64_t value = (uint64_t)element;
+			value ^= value >> 33;
+			value *= 0xff51afd7ed558ccdULL;
+			value ^= value >> 33;
+			value *= 0xc4ceb9fe1a85ec53ULL;
+			value ^= value >> 33;
+			return (uint32_t)value;
+		}
+	};
+
+
+	/**
+	 * @class FixedLRUList
+	 * A template class that implements a LRU cache with a fixed capacity, with the same semantics as LRUList but without allocating
+	 * memory per element. Elements are stored in an array of nodes linked in LRU order, and are indexed by an OpenAddressingTable,
+	 * so putting, touching, erasing and evicting an element are all O(1) on average. Unlike LRUList, the evicted element is
+	 * returned by value (or reported to a callback) instead of being allocated on the heap.
+	 * Storage grows geometrically as elements are added until it reaches the max size and is then reused; call reserve() to allocate
+	 * it upfront. The memory overhead is 12 bytes per element plus 16 to 32 bytes of hash table (compared to about 80 bytes for LRUList).
+	 * T must be copyable and comparable with operator==, and Hash must be a functor returning a uint32_t hash of T (see LRUHash).
+	 * The max size is limited to 2^31 elements
+	 */
+	template<typename T, typename Hash = LRUHash<T> >
+	class FixedLRUList
+	{
+	public:
+
+		/**
+		 * A callback invoked when the least recently used element is evicted from the list because a new element was put while the list
+		 * was full
+		 * @param[in] element The evicted element
+		 * @param[in] userCookie A pointer to the cookie provided to the FixedLRUList c'tor or NULL if no cookie provided
+		 */
+		typedef void (*OnElementEvicted)(const T& element, void* userCookie);
+
+		/**
+		 * A c'tor for this class. No memory is allocated until the first element is put or reserve() is called
+		 * @param[in] maxSize The max size this list can go
+		 * @param[in] onElementEvicted An optional callback invoked whenever an element is evicted. Default value is NULL
+		 * @param[in] userCookie A pointer to a user provided object which will be passed to the callback. Default value is NULL
+		 * @param[in] hash An optional instance of the hash functor
+		 */
+		FixedLRUList(size_t maxSize, OnElementEvicted onElementEvicted = NULL, void* userCookie = NULL, const Hash& hash = Hash())
+			: m_Hash(hash)
+		{
+			m_MaxSize = maxSize;
+			if (m_MaxSize > MaxCapacity)
+				m_MaxSize = MaxCapacity;
+			m_Size = 0;
+			m_Head = NullIndex;
+			m_Tail = NullIndex;
+			m_FreeList = NullIndex;
+			m_OnElementEvicted = onElementEvicted;
+			m_UserCookie = userCookie;
+		}
+
+		/**
+		 * Puts an element in the list. This element will be inserted (or advanced if it already exists) to the head of the list as
+		 * the most recently used element. If the list already reached its max size and the element is new this method will remove the
+		 * least recently used element, copy it to evictedElement (if not NULL) and invoke the eviction callback (if set).
+		 * Method complexity is O(1) on average
+		 * @param[in] element The element to insert or to advance to the head of the list (if already exists)
+		 * @param[out] evictedElement An optional pointer the removed element is copied to. Default value is NULL
+		 * @return True if an element was removed from the list, false otherwise
+		 */
+		bool put(const T& element, T* evictedElement = NULL)
+		{
+			if (m_MaxSize == 0)
+			{
+				reportEvicted(element, evictedElement);
+				return true;
+			}
+
+			uint32_t hash = m_Hash(element);
+			const IndexSlot* slot = m_Index.find(hash, MatchElement(m_Nodes, element));
+			if (slot != NULL)
+			{
+				uint32_t nodeIndex = slot->nodeIndex;
+				unlink(nodeIndex);
+				linkAtHead(nodeIndex);
+				return false;
+			}
+
+			bool evicted = false;
+			T evictedValue = element;
+			if (m_Size == m_MaxSize)
+			{
+				uint32_t lruIndex = m_Tail;
+				evictedValue = m_Nodes[lruIndex].element;
+				eraseNode(lruIndex);
+				evicted = true;
+			}
+
+			uint32_t nodeIndex = allocateNode(element, hash);
+			m_Index.insert(hash, MatchElement(m_Nodes, element)).nodeIndex = nodeIndex;
+			linkAtHead(nodeIndex);
+			m_Size++;
+
+			if (evicted)
+				reportEvicted(evictedValue, evictedElement);
+
+			return evicted;
+		}
+
+		/**
+		 * Check whether an element is in the list. The element isn't advanced to the head of the list
+		 * @param[in] element The element to look for
+		 * @return True if the element is in the list, false otherwise
+		 */
+		bool contains(const T& element) const
+		{
+			return m_Index.find(m_Hash(element), MatchElement(m_Nodes, element)) != NULL;
+		}
+
+		/**
+		 * Get the most recently used element (the one at the beginning of the list). The list must not be empty
+		 * @return The most recently used element
+		 */
+		const T& getMRUElement() const
+		{
+			return m_Nodes[m_Head].element;
+		}
+
+		/**
+		 * Get the least recently used element (the one at the end of the list). The list must not be empty
+		 * @return The least recently used element
+		 */
+		const T& getLRUElement() const
+		{
+			return m_Nodes[m_Tail].element;
+		}
+
+		/**
+		 * Erase an element from the list. If element isn't found in the list nothing happens
+		 * @param[in] element The element to erase
+		 * @return True if the element was found and erased, false otherwise
+		 */
+		bool eraseElement(const T& element)
+		{
+			IndexSlot* slot = m_Index.find(m_Hash(element), MatchElement(m_Nodes, element));
+			if (slot == NULL)
+				return false;
+
+			uint32_t nodeIndex = slot->nodeIndex;
+			m_Index.erase(slot);
+			releaseNode(nodeIndex);
+			return true;
+		}
+
+		/**
+		 * Remove all elements from the list. Allocated storage is kept for reuse
+		 */
+		void clear()
+		{
+			m_Nodes.clear();
+			m_Index.clear();
+			m_Size = 0;
+			m_Head = NullIndex;
+			m_Tail = NullIndex;
+			m_FreeList = NullIndex;
+		}
+
+		/**
+		 * Allocate storage for a number of elements upfront so putting them doesn't allocate memory
+		 * @param[in] numOfElements The number of elements to allocate storage for. Values larger than the max size are reduced to
+		 * the max size
+		 */
+		void reserve(size_t numOfElements)
+		{
+			if (numOfElements > m_MaxSize)
+				numOfElements = m_MaxSize;
+
+			m_Nodes.reserve(numOfElements);
+			m_Index.reserve(numOfElements);
+		}
+
+		/**
+		 * @return The max size of this list as determined in the c'tor
+		 */
+		inline size_t getMaxSize() const { return m_MaxSize; }
+
+		/**
+		 * @return The number of elements currently in this list
+		 */
+		inline size_t getSize() const { return m_Size; }
+
+	private:
+
+		static const uint32_t NullIndex = 0xffffffff;
+		static const size_t MaxCapacity = 0x80000000;
+
+		struct Node
+		{
+			T element;
+			uint32_t hash;
+			uint32_t prev;
+			uint32_t next;
+
+			Node(const T& elem, uint32_t elemHash) : element(elem), hash(elemHash), prev(NullIndex), next(NullIndex) {}
+		};
+
+		struct IndexSlot
+		{
+			uint32_t hash;
+			uint32_t nodeIndex;
+
+			IndexSlot() : hash(0), nodeIndex(NullIndex) {}
+			bool isEmpty() const { return nodeIndex == NullIndex; }
+		};
+
+		// matches the slot of the node holding an element
+		struct MatchElement
+		{
+			const std::vector<Node>& nodes;
+			const T& element;
+
+			MatchElement(const std::vector<Node>& nodeList, const T& elem) : nodes(nodeList), element(elem) {}
+			bool operator()(const IndexSlot& slot) const { return nodes[slot.nodeIndex].element == element; }
+		};
+
+		// matches the slot of a node
+		struct MatchNode
+		{
+			uint32_t nodeIndex;
+
+			MatchNode(uint32_t index) : nodeIndex(index) {}
+			bool operator()(const IndexSlot& slot) const { return slot.nodeIndex == nodeIndex; }
+		};
+
+		std::vector<Node> m_Nodes;
+		OpenAddressingTable<IndexSlot> m_Index;
+		size_t m_Size;
+		size_t m_MaxSize;
+		uint32_t m_Head;
+		uint32_t m_Tail;
+		uint32_t m_FreeList;
+		Hash m_Hash;
+		OnElementEvicted m_OnElementEvicted;
+		void* m_UserCookie;
+
+		uint32_t allocateNode(const T& element, uint32_t hash)
+		{
+			if (m_FreeList != NullIndex)
+			{
+				uint32_t nodeIndex = m_FreeList;
+				m_FreeList = m_Nodes[nodeIndex].next;
+				m_Nodes[nodeIndex] = Node(element, hash);
+				return nodeIndex;
+			}
+
+			m_Nodes.push_back(Node(element, hash));
+			return (uint32_t)(m_Nodes.size() - 1);
+		}
+
+		// remove the node from the hash table and release it
+		void eraseNode(uint32_t nodeIndex)
+		{
+			m_Index.erase(m_Index.find(m_Nodes[nodeIndex].hash, MatchNode(nodeIndex)));
+			releaseNode(nodeIndex);
+		}
+
+		// remove the node from the LRU order and return it to the free list
+		void releaseNode(uint32_t nodeIndex)
+		{
+			unlink(nodeIndex);
+			m_Nodes[nodeIndex].next = m_FreeList;
+			m_FreeList = nodeIndex;
+			m_Size--;
+		}
+
+		void unlink(uint32_t nodeIndex)
+		{
+			Node& node = m_Nodes[nodeIndex];
+			if (node.prev != NullIndex)
+				m_Nodes[node.prev].next = node.next;
+			else
+				m_Head = node.next;
+
+			if (node.next != NullIndex)
+				m_Nodes[node.next].prev = node.prev;
+			else
+				m_Tail = node.prev;
+
+			node.prev = NullIndex;
+			node.next = NullIndex;
+		}
+
+		void linkAtHead(uint32_t nodeIndex)
+		{
+			Node& node = m_Nodes[nodeIndex];
+			node.prev = NullIndex;
+			node.next = m_Head;
+			if (m_Head != NullIndex)
+				m_Nodes[m_Head].prev = nodeIndex;
+			m_Head = nodeIndex;
+			if (m_Tail == NullIndex)
+				m_Tail = nodeIndex;
+		}
+
+		void reportEvicted(const T& element, T* evictedElement)
+		{
+			if (evictedElement != NULL)
+				*evictedElement = element;
+
+			if (m_OnElementEvicted != NULL)
+				m_OnElementEvicted(element, m_UserCookie);
+		}
+	};
+
+	template<typename T, typename Hash>
+	const uint32_t FixedLRUList<T, Hash>::NullIndex;
+
+	template<typename T, typename Hash>
+	const size_t FixedLRUList<T, Hash>::MaxCapacity;
+
+} // namespace pcpp
+
+#endif /* PCAPPP_FIXED_LRU_LIST */
@@ -39,6 +39,47 @@ namespace pcpp
 	 * Illegal hex string means odd number of characters or a string that contains non-hex characters
 	 */
 	size_t hexStringToByteArray(const std::string& hexString, uint8_t* resultByteArr, size_t resultByteArrSize);
+
+	/**
+	 * Find the first occurrence of any of several characters in a buffer which isn't necessarily null-terminated, for example the first CR,
+	 * LF or ':' of a header line. Up to 4 characters are searched with SIMD instructions when the CPU supports them
+	 * @param[in] data The buffer to search in
+	 * @param[in] dataLen The length of the buffer
+	 * @param[in] chars The characters to search for
+	 * @param[in] numOfChars The number of characters to search for
+	 * @return A pointer to the first byte of data which equals one of the characters, or NULL if there's none
+	 */
+	const char* findFirstOf(const char* data, size_t dataLen, const char* chars, size_t numOfChars);
+
+	/**
+	 * Find the first occurrence of a string in a buffer. Unlike strstr() the buffer isn't required to be null-terminated and the search
+	 * never reads past dataLen
+	 * @param[in] data The buffer to search in
+	 * @param[in] dataLen The length of the buffer
+	 * @param[in] pattern The string to search for
+	 * @param[in] patternLen The length of the string
+	 * @return A pointer to the first occurrence of the string in data, data if patternLen is 0, or NULL if there's none
+	 */
+	const char* findSubstring(const char* data, size_t dataLen, const char* pattern, size_t patternLen);
+
+	/**
+	 * Compare two strings of the same length ignoring the case of ASCII letters. Unlike strncasecmp() the result doesn't depend on the
+	 * locale and null characters are compared as any other character
+	 * @param[in] str1 The first string
+	 * @param[in] str2 The second string
+	 * @param[in] len The length of both strings
+	 * @return True if the strings are equal ignoring the case of ASCII letters
+	 */
+	bool equalsIgnoreCase(const char* str1, const char* str2, size_t len);
+
+	/**
+	 * Compute a hash of a string which ignores the case of ASCII letters, so strings equalsIgnoreCase() considers equal have the same
+	 * hash. The hash is meant for in-memory hash tables: its value may differ between platforms and versions
+	 * @param[in] data The string
+	 * @param[in] len The length of the string
+	 * @return The hash value
+	 */
+	uint32_t hashIgnoreCase(const char* data, size_t len);
 }
 
 #endif // PCAPPP_GENERAL_UTILS
@@ -0,0 +1,180 @@
+#ifndef PCAPPP_HARDWARE_COUNTERS
+#define PCAPPP_HARDWARE_COUNTERS
+
+#include <stdint.h>
+#include <string>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * The CPU hardware events HardwareCounters counts
+	 */
+	enum HardwareCounterType
+	{
+		/** CPU cycles */
+		HwCounterCycles,
+		/** Retired instructions */
+		HwCounterInstructions,
+		/** L1 data cache read misses */
+		HwCounterL1DataMisses,
+		/** Last level cache misses */
+		HwCounterLLCMisses,
+		/** Mispredicted branches */
+		HwCounterBranchMisses,
+		/** The number of counter types */
+		NumOfHwCounterTypes
+	};
+
+
+	/**
+	 * @struct HardwareCounterValues
+	 * The values read by HardwareCounters, summed over all measured periods. A counter is available only if the CPU and the kernel
+	 * support it (virtual machines often expose no hardware counters at all, or only some of them)
+	 */
+	struct HardwareCounterValues
+	{
+		/** The counter values, indexed by HardwareCounterType. When the kernel had to multiplex the counters they're scaled to the
+		 * whole measured time */
+		uint64_t values[NumOfHwCounterTypes];
+		/** Whether each counter is available, indexed by HardwareCounterType */
+		bool available[NumOfHwCounterTypes];
+
+		/**
+		 * A c'tor for this struct which zeroes all values and marks all counters as unavailable
+		 */
+		HardwareCounterValues() { clear(); }
+
+		/**
+		 * Zero all values and mark all counters as unavailable
+		 */
+		void clear();
+
+		/**
+		 * Add the values of another measurement. A counter stays available only if it's available in both, unless this instance is
+		 * empty (no counter is available), in which case the other's values are copied
+		 * @param[in] other The values to add
+		 * @return A reference to this instance
+		 */
+		HardwareCounterValues& operator+=(const HardwareCounterValues& other);
+
+		/**
+		 * @return True if at least one counter is available
+		 */
+		bool isAnyAvailable() const;
+
+		/**
+		 * Get a counter value divided by a number of units of work, such as packets
+		 * @param[in] type The counter type
+		 * @param[in] numOfUnits The number of units
+		 * @return The value per unit, or -1 if the counter isn't available or numOfUnits is 0
+		 */
+		double getPerUnit(HardwareCounterType type, uint64_t numOfUnits) const;
+
+		/**
+		 * @return The number of instructions per cycle, or -1 if cycles or instructions aren't available
+		 */
+		double getInstructionsPerCycle() const;
+
+		/**
+		 * @param[in] type The counter type
+		 * @return A short name of the counter, for example "cycles" or "llc-misses"
+		 */
+		static const char* getName(HardwareCounterType type);
+	};
+
+
+	/**
+	 * @class HardwareCounters
+	 * Counts CPU hardware events (cycles, instructions, L1 data cache misses, LLC misses and branch misses) of the calling thread
+	 * using the Linux perf_event_open() interface, for explaining where the time of a piece of code goes:
+	 *
+	 *     HardwareCounters counters;
+	 *     if (counters.open())
+	 *     {
+	 *         counters.start();
+	 *         ... parse packets ...
+	 *         counters.stop();
+	 *         HardwareCounterValues values;
+	 *         counters.read(values);
+	 *     }
+	 *
+	 * Only user space events are counted, which is what perf_event_paranoid=2 (the default of most distributions) allows unprivileged
+	 * processes to do. start() and stop() are a system call per counter, so they should wrap a batch of work rather than every packet.
+	 * The counters follow the thread that opened them, so an instance must be opened, started and stopped on the thread it measures.
+	 * On platforms other than Linux open() always fails
+	 */
+	class HardwareCounters
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. The counters aren't opened
+		 */
+		HardwareCounters();
+
+		/**
+		 * A d'tor for this class. Closes the counters
+		 */
+		~HardwareCounters();
+
+		/**
+		 * Open the counters of the calling thread. Counters the CPU or the kernel don't support are marked as unavailable
+		 * @return True if at least one counter was opened, false if none could be opened (for example on platforms other than Linux,
+		 * when perf_event_paranoid is 3 or in a virtual machine without a virtual PMU)
+		 */
+		bool open();
+
+		/**
+		 * Close the counters. Does nothing if they aren't open
+		 */
+		void close();
+
+		/**
+		 * @return True if the counters are open
+		 */
+		bool isOpen() const;
+
+		/**
+		 * Zero the counters and start counting
+		 */
+		void start();
+
+		/**
+		 * Stop counting. The counted values are kept until the next start()
+		 */
+		void stop();
+
+		/**
+		 * Read the values counted between the last start() and stop() (or until now if stop() wasn't called)
+		 * @param[out] result The values. Counters which couldn't be opened are marked as unavailable
+		 * @return False if the counters aren't open, true otherwise
+		 */
+		bool read(HardwareCounterValues& result) const;
+
+		/**
+		 * Format counter values per unit of work in a single line, for example:
+		 * "2510.3 cycles 4102.7 instructions 1.63 IPC 12.1 l1d-misses 0.8 llc-misses 3.2 branch-misses". Unavailable counters are skipped
+		 * @param[in] values The values to format
+		 * @param[in] numOfUnits The number of units of work, such as packets, to divide the values by
+		 * @return The formatted values, or an empty string if no counter is available
+		 */
+		static std::string toString(const HardwareCounterValues& values, uint64_t numOfUnits);
+
+	private:
+		int m_Fds[NumOfHwCounterTypes];
+
+		// disable copy c'tor and assignment operator
+		HardwareCounters(const HardwareCounters& other);
+		HardwareCounters& operator=(const HardwareCounters& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_HARDWARE_COUNTERS */
@@ -0,0 +1,620 @@
+#ifndef PCAPPP_HASH_COUNTERS
+#define PCAPPP_HASH_COUNTERS
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <utility>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * Calculate a 64-bit hash of a string, which is the hash StringTable, StringCounter and the sketches in this file use
+	 * @param[in] str The string data, which doesn't have to be null-terminated
+	 * @param[in] len The length of the string
+	 * @return The hash of the string
+	 */
+	uint64_t hashString(const char* str, size_t len);
+
+	/**
+	 * Mix all bits of a 64-bit value, so values which differ in few bits get unrelated hashes. This is the finalizer of MurmurHash3
+	 * @param[in] value The value to hash
+	 * @return The hash of the value
+	 */
+	inline uint64_t hashInteger(uint64_t value)
+	{
+		value ^= value >> 33;
+		value *= 0xff51afd7ed558ccdULL;
+		value ^= value >> 33;
+		value *= 0xc4ceb9fe1a85ec53ULL;
+		value ^= value >> 33;
+		return value;
+	}
+
+
+	/**
+	 * @class StringTable
+	 * A table of interned strings, which gives each distinct string a dense ID (0, 1, 2...) that can index arrays of per-string data.
+	 * Strings are looked up by a pointer and a length, so strings taken directly from packet data are found without constructing a
+	 * std::string; a copy is made only when a new string is added. The table is indexed by an open-addressing hash table with linear
+	 * probing which holds 4 bytes per slot
+	 */
+	class StringTable
+	{
+	public:
+
+		/**
+		 * The ID returned for strings which aren't in the table
+		 */
+		static const uint32_t NotFound = 0xffffffff;
+
+		/**
+		 * A c'tor for this class. No memory is allocated until the first string is added
+		 * @param[in] maxSize The max number of strings in the table, or 0 for no limit (which is the default)
+		 */
+		StringTable(size_t maxSize = 0);
+
+		/**
+		 * Find a string or add it to the table
+		 * @param[in] str The string data, which doesn't have to be null-terminated
+		 * @param[in] len The length of the string
+		 * @return The ID of the string, or #NotFound if it isn't in the table and the table is full
+		 */
+		inline uint32_t intern(const char* str, size_t len) { return intern(str, len, hashString(str, len)); }
+
+		/**
+		 * Find a string or add it to the table, when its hash (see hashString()) is already known
+		 * @param[in] str The string data
+		 * @param[in] len The length of the string
+		 * @param[in] hash The hash of the string
+		 * @return The ID of the string, or #NotFound if it isn't in the table and the table is full
+		 */
+		uint32_t intern(const char* str, size_t len, uint64_t hash);
+
+		/**
+		 * Find a string or add it to the table
+		 * @param[in] str The string
+		 * @return The ID of the string, or #NotFound if it isn't in the table and the table is full
+		 */
+		inline uint32_t intern(const std::string& str) { return intern(str.data(), str.length()); }
+
+		/**
+		 * Find a string without adding it
+		 * @param[in] str The string data
+		 * @param[in] len The length of the string
+		 * @return The ID of the string, or #NotFound if it isn't in the table
+		 */
+		inline uint32_t find(const char* str, size_t len) const { return find(str, len, hashString(str, len)); }
+
+		/**
+		 * Find a string without adding it, when its hash (see hashString()) is already known
+		 * @param[in] str The string data
+		 * @param[in] len The length of the string
+		 * @param[in] hash The hash of the string
+		 * @return The ID of the string, or #NotFound if it isn't in the table
+		 */
+		uint32_t find(const char* str, size_t len, uint64_t hash) const;
+
+		/**
+		 * Replace the string of an ID with another string, which is how a full table makes room for a new string
+		 * @param[in] id The ID of a string in the table
+		 * @param[in] str The new string data
+		 * @param[in] len The length of the new string
+		 * @param[in] hash The hash of the new string (see hashString())
+		 * @return True if the string was replaced, false if the ID isn't in the table or the new string already is
+		 */
+		bool reassign(uint32_t id, const char* str, size_t len, uint64_t hash);
+
+		/**
+		 * @param[in] id The ID of a string in the table
+		 * @return The string
+		 */
+		inline const std::string& getString(uint32_t id) const { return m_Strings[id]; }
+
+		/**
+		 * @return The number of strings in the table
+		 */
+		inline size_t size() const { return m_Strings.size(); }
+
+		/**
+		 * @return The max number of strings in the table, or 0 if there is no limit
+		 */
+		inline size_t getMaxSize() const { return m_MaxSize; }
+
+		/**
+		 * Remove all strings from the table. Allocated index storage is kept for reuse
+		 */
+		void clear();
+
+	private:
+		static const uint32_t EmptySlot = 0;
+
+		std::vector<std::string> m_Strings;
+		std::vector<uint32_t> m_Hashes;
+		// each slot holds a string ID plus 1, or EmptySlot
+		std::vector<uint32_t> m_Slots;
+		size_t m_MaxSize;
+
+		size_t findSlot(const char* str, size_t len, uint32_t hash) const;
+		void eraseSlot(size_t slot);
+		void grow();
+	};
+
+
+	/**
+	 * @class FlatHashMap
+	 * A hash map from 64-bit keys to values, stored in one array of slots with open addressing and linear probing, so a lookup usually
+	 * touches a single cache line and no memory is allocated per entry (unlike std::map). Values must be default-constructible and
+	 * copyable. Pointers and references to values are invalidated by insertions, which may grow the array, and by erasures
+	 */
+	template<typename V>
+	class FlatHashMap
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. No memory is allocated until the first entry is inserted or reserve() is called
+		 */
+		FlatHashMap() : m_Size(0) {}
+
+		/**
+		 * Find the value of a key
+		 * @param[in] key The key
+		 * @return A pointer to the value, or NULL if the key isn't in the map
+		 */
+		V* find(uint64_t key)
+		{
+			if (m_Size == 0)
+				return NULL;
+
+			Slot& slot = m_Slots[findSlot(key)];
+			return slot.used ? &slot.value : NULL;
+		}
+
+		/**
+		 * Find the value of a key
+		 * @param[in] key The key
+		 * @return A pointer to the value, or NULL if the key isn't in the map
+		 */
+		const V* find(uint64_t key) const
+		{
+			if (m_Size == 0)
+				return NULL;
+
+			const Slot& slot = m_Slots[findSlot(key)];
+			return slot.used ? &slot.value : NULL;
+		}
+
+		/**
+		 * Get the value of a key, inserting a default-constructed value if the key isn't in the map
+		 * @param[in] key The key
+		 * @param[out] isNew An optional pointer which is set to true if the key was inserted, false otherwise. Default value is NULL
+		 * @return The value of the key
+		 */
+		V& get(uint64_t key, bool* isNew = NULL)
+		{
+			if ((m_Size + 1) * 4 > m_Slots.size() * 3)
+				grow();
+
+			size_t index = findSlot(key);
+			Slot& slot = m_Slots[index];
+			if (isNew != NULL)
+				*isNew = !slot.used;
+
+			if (!slot.used)
+			{
+				slot.used = true;
+				slot.key = key;
+				slot.value = V();
+				m_Size++;
+			}
+
+			return slot.value;
+		}
+
+		/**
+		 * The same as get()
+		 */
+		inline V& operator[](uint64_t key) { return get(key); }
+
+		/**
+		 * Erase a key from the map
+		 * @param[in] key The key
+		 * @return True if the key was found and erased, false otherwise
+		 */
+		bool erase(uint64_t key)
+		{
+			if (m_Size == 0)
+				return false;
+
+			size_t index = findSlot(key);
+			if (!m_Slots[index].used)
+				return false;
+
+			// shift back the following entries of the probe sequence so lookups don't need tombstones
+			size_t mask = m_Slots.size() - 1;
+			size_t hole = index;
+			size_t next = (hole + 1) & mask;
+			while (m_Slots[next].used)
+			{
+				size_t home = (size_t)hashInteger(m_Slots[next].key) & mask;
+				if (((next - home) & mask) >= ((next - hole) & mask))
+				{
+					m_Slots[hole] = m_Slots[next];
+					hole = next;
+				}
+				next = (next + 1) & mask;
+			}
+
+			m_Slots[hole].used = false;
+			m_Slots[hole].value = V();
+			m_Size--;
+			return true;
+		}
+
+		/**
+		 * @return The number of entries in the map
+		 */
+		inline size_t size() const { return m_Size; }
+
+		/**
+		 * Allocate room for a number of entries, so inserting them doesn't grow the array
+		 * @param[in] numOfEntries The number of entries
+		 */
+		void reserve(size_t numOfEntries)
+		{
+			while (numOfEntries * 4 > m_Slots.size() * 3)
+				grow();
+		}
+
+		/**
+		 * Remove all entries from the map. Allocated storage is kept for reuse
+		 */
+		void clear()
+		{
+			for (size_t i = 0; i < m_Slots.size(); i++)
+			{
+				m_Slots[i].used = false;
+				m_Slots[i].value = V();
+			}
+			m_Size = 0;
+		}
+
+		/**
+		 * Copy all entries of the map to a vector, in no particular order
+		 * @param[out] entries The vector to append the entries to
+		 */
+		void getEntries(std::vector<std::pair<uint64_t, V> >& entries) const
+		{
+			entries.reserve(entries.size() + m_Size);
+			for (size_t i = 0; i < m_Slots.size(); i++)
+			{
+				if (m_Slots[i].used)
+					entries.push_back(std::pair<uint64_t, V>(m_Slots[i].key, m_Slots[i].value));
+			}
+		}
+
+	private:
+		struct Slot
+		{
+			uint64_t key;
+			V value;
+			bool used;
+
+			Slot() : key(0), value(), used(false) {}
+		};
+
+		std::vector<Slot> m_Slots;
+		size_t m_Size;
+
+		// returns the slot of the key or the empty slot where it should be inserted. The array must not be empty
+		size_t findSlot(uint64_t key) const
+		{
+			size_t mask = m_Slots.size() - 1;
+			size_t index = (size_t)hashInteger(key) & mask;
+			while (m_Slots[index].used && m_Slots[index].key != key)
+				index = (index + 1) & mask;
+			return index;
+		}
+
+		void grow()
+		{
+			std::vector<Slot> oldSlots(m_Slots.size() == 0 ? 16 : m_Slots.size() * 2);
+			oldSlots.swap(m_Slots);
+			for (size_t i = 0; i < oldSlots.size(); i++)
+			{
+				if (oldSlots[i].used)
+					m_Slots[findSlot(oldSlots[i].key)] = oldSlots[i];
+			}
+		}
+	};
+
+
+	/**
+	 * @class HashCounter
+	 * Counts occurrences of 64-bit keys, such as ports, protocol numbers or IDs of interned strings, in a FlatHashMap. Counters of
+	 * different threads can be merged, so each thread can count on its own and the results are added up when they're reported
+	 */
+	class HashCounter
+	{
+	public:
+
+		/**
+		 * A c'tor for this class, which creates an empty counter
+		 */
+		HashCounter() : m_TotalCount(0) {}
+
+		/**
+		 * Count occurrences of a key
+		 * @param[in] key The key
+		 * @param[in] count The number of occurrences. Default value is 1
+		 */
+		inline void add(uint64_t key, uint64_t count = 1) { m_Counts[key] += count; m_TotalCount += count; }
+
+		/**
+		 * @param[in] key The key
+		 * @return The number of occurrences of the key
+		 */
+		inline uint64_t getCount(uint64_t key) const { const uint64_t* count = m_Counts.find(key); return count != NULL ? *count : 0; }
+
+		/**
+		 * Add the counts of another counter to this one
+		 * @param[in] other The counter to add
+		 */
+		void merge(const HashCounter& other);
+
+		/**
+		 * Get the keys and their counts, sorted by descending count (keys of the same count are sorted by ascending key)
+		 * @param[out] result The vector to fill with the keys and their counts. Its previous content is removed
+		 * @param[in] maxNumOfEntries The max number of entries to return, or 0 for all of them (which is the default)
+		 */
+		void getSortedCounts(std::vector<std::pair<uint64_t, uint64_t> >& result, size_t maxNumOfEntries = 0) const;
+
+		/**
+		 * @return The number of different keys counted
+		 */
+		inline size_t size() const { return m_Counts.size(); }
+
+		/**
+		 * @return The sum of all counts
+		 */
+		inline uint64_t getTotalCount() const { return m_TotalCount; }
+
+		/**
+		 * Remove all keys
+		 */
+		inline void clear() { m_Counts.clear(); m_TotalCount = 0; }
+
+	private:
+		FlatHashMap<uint64_t> m_Counts;
+		uint64_t m_TotalCount;
+	};
+
+
+	/**
+	 * @class CountMinSketch
+	 * A Count-Min sketch, which estimates the number of occurrences of any number of different keys in a fixed amount of memory.
+	 * An estimate is never lower than the real count, and with a width of w it's higher by at most 2.7 * (total count) / w with
+	 * probability 1 - 2^-depth. Keys are given by their 64-bit hash (see hashString() and hashInteger())
+	 */
+	class CountMinSketch
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] width The number of counters of each row, which is rounded up to a power of 2. Default value is 2048
+		 * @param[in] depth The number of rows, each with its own hash function. Default value is 4
+		 */
+		CountMinSketch(size_t width = 2048, size_t depth = 4);
+
+		/**
+		 * Count occurrences of a key
+		 * @param[in] hash The hash of the key
+		 * @param[in] count The number of occurrences. Default value is 1
+		 */
+		void add(uint64_t hash, uint64_t count = 1);
+
+		/**
+		 * @param[in] hash The hash of the key
+		 * @return An upper bound on the number of occurrences of the key
+		 */
+		uint64_t estimate(uint64_t hash) const;
+
+		/**
+		 * Add the counts of another sketch to this one
+		 * @param[in] other The sketch to add
+		 * @return True if the sketch was added, false if it's of another width or depth
+		 */
+		bool merge(const CountMinSketch& other);
+
+		/**
+		 * @return The number of counters of each row
+		 */
+		inline size_t getWidth() const { return m_Width; }
+
+		/**
+		 * @return The number of rows
+		 */
+		inline size_t getDepth() const { return m_Depth; }
+
+		/**
+		 * Set all counters to zero
+		 */
+		void clear();
+
+	private:
+		std::vector<uint64_t> m_Counters;
+		size_t m_Width;
+		size_t m_Depth;
+	};
+
+
+	/**
+	 * @class HyperLogLog
+	 * A HyperLogLog sketch, which estimates the number of different keys seen in a fixed amount of memory: 2^precision bytes give a
+	 * standard error of about 1.04 / sqrt(2^precision), for example 1.6% for the default precision of 12 (4KB). Small numbers of keys
+	 * are counted almost exactly. Keys are given by their 64-bit hash (see hashString() and hashInteger())
+	 */
+	class HyperLogLog
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] precision The number of hash bits which select a register, between 4 and 18. Default value is 12
+		 */
+		HyperLogLog(int precision = 12);
+
+		/**
+		 * Add a key
+		 * @param[in] hash The hash of the key
+		 */
+		void add(uint64_t hash);
+
+		/**
+		 * @return An estimate of the number of different keys added
+		 */
+		uint64_t estimate() const;
+
+		/**
+		 * Add the keys of another sketch to this one
+		 * @param[in] other The sketch to add
+		 * @return True if the sketch was added, false if it's of another precision
+		 */
+		bool merge(const HyperLogLog& other);
+
+		/**
+		 * @return The precision of the sketch
+		 */
+		inline int getPrecision() const { return m_Precision; }
+
+		/**
+		 * Remove all keys
+		 */
+		void clear();
+
+	private:
+		std::vector<uint8_t> m_Registers;
+		int m_Precision;
+	};
+
+
+	/**
+	 * @class StringCounter
+	 * Counts occurrences of strings, such as host names or content types, by interning them in a StringTable and counting by string ID,
+	 * so counting a string which was already seen neither allocates memory nor constructs a std::string.<BR>
+	 * By default all strings are counted exactly. A counter created with a max number of strings keeps a bounded amount of memory
+	 * however many different strings it sees, and tracks the most frequent ones (top-K): strings which don't fit in the table are
+	 * counted in a CountMinSketch, and such a string replaces the least frequent string of the table once its estimated count gets higher.
+	 * The replaced string's count moves to the sketch. In this mode counts are upper bounds (as in the Space-Saving algorithm) and the
+	 * number of different strings is estimated by a HyperLogLog sketch.<BR>
+	 * Counters of different threads can be merged, so each thread can count on its own and the results are added up when they're reported
+	 */
+	class StringCounter
+	{
+	public:
+
+		/**
+		 * A c'tor for this class, which creates an empty counter
+		 * @param[in] maxNumOfStrings The max number of strings to count individually, or 0 to count all strings exactly (which is the
+		 * default)
+		 * @param[in] sketchWidth The width of the CountMinSketch used when the number of strings is bounded. Default value is 4096
+		 * @param[in] sketchDepth The depth of the CountMinSketch used when the number of strings is bounded. Default value is 4
+		 */
+		StringCounter(size_t maxNumOfStrings = 0, size_t sketchWidth = 4096, size_t sketchDepth = 4);
+
+		/**
+		 * Count occurrences of a string
+		 * @param[in] str The string data, which doesn't have to be null-terminated
+		 * @param[in] len The length of the string
+		 * @param[in] count The number of occurrences. Default value is 1
+		 */
+		void add(const char* str, size_t len, uint64_t count = 1);
+
+		/**
+		 * Count occurrences of a string
+		 * @param[in] str The string
+		 * @param[in] count The number of occurrences. Default value is 1
+		 */
+		inline void add(const std::string& str, uint64_t count = 1) { add(str.data(), str.length(), count); }
+
+		/**
+		 * @param[in] str The string data
+		 * @param[in] len The length of the string
+		 * @return The number of occurrences of the string. When the number of strings is bounded this is an upper bound
+		 */
+		uint64_t getCount(const char* str, size_t len) const;
+
+		/**
+		 * @param[in] str The string
+		 * @return The number of occurrences of the string. When the number of strings is bounded this is an upper bound
+		 */
+		inline uint64_t getCount(const std::string& str) const { return getCount(str.data(), str.length()); }
+
+		/**
+		 * Add the counts of another counter to this one
+		 * @param[in] other The counter to add
+		 */
+		void merge(const StringCounter& other);
+
+		/**
+		 * Get the counted strings and their counts, sorted by descending count (strings of the same count are sorted alphabetically).
+		 * When the number of strings is bounded only the strings in the table are returned
+		 * @param[out] result The vector to fill with the strings and their counts. Its previous content is removed
+		 * @param[in] maxNumOfEntries The max number of entries to return, or 0 for all of them (which is the default)
+		 */
+		void getSortedCounts(std::vector<std::pair<std::string, uint64_t> >& result, size_t maxNumOfEntries = 0) const;
+
+		/**
+		 * @return The number of strings counted individually
+		 */
+		inline size_t size() const { return m_Strings.size(); }
+
+		/**
+		 * @return The number of different strings seen. It's exact unless the number of strings is bounded and more strings than the
+		 * bound were seen, in which case it's estimated
+		 */
+		uint64_t getNumOfDistinctStrings() const;
+
+		/**
+		 * @return The sum of all counts
+		 */
+		inline uint64_t getTotalCount() const { return m_TotalCount; }
+
+		/**
+		 * @return True if the number of strings counted individually is bounded, false otherwise
+		 */
+		inline bool isBounded() const { return m_Strings.getMaxSize() != 0; }
+
+		/**
+		 * Remove all strings
+		 */
+		void clear();
+
+	private:
+		StringTable m_Strings;
+		std::vector<uint64_t> m_Counts;
+		uint64_t m_TotalCount;
+		// the following are used only when the number of strings is bounded
+		CountMinSketch m_Overflow;
+		HyperLogLog m_DistinctStrings;
+		bool m_Overflowed;
+		// a lower bound on the smallest count of the table: counts only grow, so it's refreshed only when a string may replace it
+		uint64_t m_MinCount;
+
+		void addUntracked(const char* str, size_t len, uint64_t hash, uint64_t count);
+		uint32_t findMinCount();
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_HASH_COUNTERS */
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <stdint.h>
+#include <string.h>
 #include <string>
 
 #define MAX_ADDR_STRING_LEN 40 //xxxx:xxxx:xxxx:xxxx:xxxx:xxxx:xxxx:xxxx\0
@@ -73,6 +74,15 @@ namespace pcpp
 		 */
 		std::string toString() const { return std::string(m_AddressAsString); }
 
+		/**
+		 * Copy the string representation of the address to a buffer without allocating memory
+		 * @param[out] buffer The buffer to write the null-terminated string to
+		 * @param[in] bufferLen The buffer length. MAX_ADDR_STRING_LEN is always enough
+		 * @return The length of the string, not including the terminating null character, or 0 if the buffer is too small or the address
+		 * is invalid
+		 */
+		size_t toString(char* buffer, size_t bufferLen) const;
+
 		/**
 		 * Get an indication if the address is valid. An address can be invalid if it was constructed from illegal input, for example:
 		 * An IPv4 address that was constructed form the string "999.999.999.999"
@@ -114,12 +124,13 @@ namespace pcpp
 	/**
 	 * @class IPv4Address
 	 * Represents an IPv4 address (of type XXX.XXX.XXX.XXX). An instance of this class can be constructed from string,
-	 * 4-byte integer or from the in_addr struct. It can be converted to each of these types
+	 * 4-byte integer or from the in_addr struct. It can be converted to each of these types. The address is stored inline, so
+	 * creating and copying instances doesn't allocate memory
 	 */
 	class IPv4Address : public IPAddress
 	{
 	private:
-		in_addr* m_pInAddr;
+		uint32_t m_Address;
 		void init(const char* addressAsString);
 	public:
 		/**
@@ -167,25 +178,25 @@ namespace pcpp
 		 * Converts the IPv4 address into a 4B integer
 		 * @return a 4B integer representing the IPv4 address
 		 */
-		uint32_t toInt() const;
+		uint32_t toInt() const { return m_Address; }
 
 		/**
 		 * Returns a in_addr struct pointer representing the IPv4 address
 		 * @return a in_addr struct pointer representing the IPv4 address
 		 */
-		in_addr* toInAddr() { return m_pInAddr; }
+		in_addr* toInAddr() { return (in_addr*)&m_Address; }
 
 		/**
 		 * Overload of the comparison operator
 		 * @return true if 2 addresses are equal. False otherwise
 		 */
-		bool operator==(const IPv4Address& other) const { return toInt() == other.toInt(); }
+		bool operator==(const IPv4Address& other) const { return m_Address == other.m_Address; }
 
 		/**
 		 * Overload of the non-equal operator
 		 * @return true if 2 addresses are not equal. False otherwise
 		 */
-		bool operator!=(const IPv4Address& other) const { return toInt() != other.toInt(); }
+		bool operator!=(const IPv4Address& other) const { return m_Address != other.m_Address; }
 
 		/**
 		 * Overload of the assignment operator
@@ -224,12 +235,13 @@ namespace pcpp
 	/**
 	 * @class IPv6Address
 	 * Represents an IPv6 address (of type xxxx:xxxx:xxxx:xxxx:xxxx:xxxx:xxxx:xxxx). An instance of this class can be constructed from string,
-	 * 16-byte array or from the in6_addr struct. It can be converted or copied to each of these types
+	 * 16-byte array or from the in6_addr struct. It can be converted or copied to each of these types. The address is stored inline,
+	 * so creating and copying instances doesn't allocate memory
 	 */
 	class IPv6Address : public IPAddress
 	{
 	private:
-		in6_addr* m_pInAddr;
+		uint32_t m_Address[4];
 		void init(char* addressAsString);
 	public:
 		~IPv6Address();
@@ -271,7 +283,7 @@ namespace pcpp
 		 * Returns a in6_addr struct pointer representing the IPv6 address
 		 * @return a in6_addr struct pointer representing the IPv6 address
 		 */
-		in6_addr* toIn6Addr() { return m_pInAddr; }
+		in6_addr* toIn6Addr() { return (in6_addr*)m_Address; }
 
 		/**
 		 * Allocates a byte array and copies address value into it. Array deallocation is user responsibility
@@ -311,6 +323,175 @@ namespace pcpp
 		static IPv6Address Zero;
 	};
 
+
+	/**
+	 * @class IPAddressValue
+	 * A compact value type holding either an IPv4 or an IPv6 address. Unlike IPAddress and its subclasses it has no virtual methods
+	 * and doesn't keep a string representation: it consists of the address bytes (in network byte order) and the IP version, 17 bytes
+	 * in total, so it can be copied, compared and hashed cheaply and stored by value in containers. It's meant for flow tables,
+	 * connection data and other places which hold many addresses. It can be converted to and from IPv4Address, IPv6Address and
+	 * IPAddress when their richer API is needed
+	 */
+	class IPAddressValue
+	{
+	public:
+
+		/**
+		 * A default c'tor that creates an invalid address (isValid() returns false)
+		 */
+		IPAddressValue() : m_IPVersion(0) { memset(m_Bytes, 0, sizeof(m_Bytes)); }
+
+		/**
+		 * A c'tor that creates an instance from an IPv4 address
+		 * @param[in] addr The IPv4 address. If it's invalid the instance is invalid too
+		 */
+		IPAddressValue(const IPv4Address& addr);
+
+		/**
+		 * A c'tor that creates an instance from an IPv6 address
+		 * @param[in] addr The IPv6 address. If it's invalid the instance is invalid too
+		 */
+		IPAddressValue(const IPv6Address& addr);
+
+		/**
+		 * A c'tor that creates an instance from an IPv4Address or IPv6Address instance
+		 * @param[in] addr A pointer to the address. If it's NULL or invalid the instance is invalid too
+		 */
+		explicit IPAddressValue(const IPAddress* addr);
+
+		/**
+		 * Create an IPv4 address from a 4-byte integer in network byte order (the same as IPv4Address#toInt())
+		 * @param[in] addressAsInt The address as 4-byte integer
+		 * @return The new instance
+		 */
+		static IPAddressValue fromIPv4(uint32_t addressAsInt);
+
+		/**
+		 * Create an IPv6 address from a 16-byte array in network byte order
+		 * @param[in] addressAsUintArr A 16-byte array containing the address value
+		 * @return The new instance
+		 */
+		static IPAddressValue fromIPv6(const uint8_t* addressAsUintArr);
+
+		/**
+		 * Create an IPv4 or IPv6 address from a string representation
+		 * @param[in] addressAsString The address as string
+		 * @return The new instance, which is invalid if the string doesn't represent either of types
+		 */
+		static IPAddressValue fromString(const std::string& addressAsString);
+
+		/**
+		 * Create an IPv4 or IPv6 address from a string representation without allocating memory. The string doesn't have to be
+		 * null-terminated, so addresses can be parsed in place from a larger text (see parse_ipv4_address() and parse_ipv6_address())
+		 * @param[in] addressAsString The address as string
+		 * @param[in] addressLen The length of the address string
+		 * @return The new instance, which is invalid if the string doesn't represent either of types
+		 */
+		static IPAddressValue fromString(const char* addressAsString, size_t addressLen);
+
+		/**
+		 * @return True if the instance holds an IPv4 or IPv6 address, false if it was default constructed or constructed from an
+		 * invalid address
+		 */
+		bool isValid() const { return m_IPVersion != 0; }
+
+		/**
+		 * @return True if the instance holds an IPv4 address
+		 */
+		bool isIPv4() const { return m_IPVersion == 4; }
+
+		/**
+		 * @return True if the instance holds an IPv6 address
+		 */
+		bool isIPv6() const { return m_IPVersion == 6; }
+
+		/**
+		 * @return The address type. Relevant only when isValid() returns true
+		 */
+		IPAddress::AddressType getType() const { return (m_IPVersion == 6 ? IPAddress::IPv6AddressType : IPAddress::IPv4AddressType); }
+
+		/**
+		 * @return A pointer to the address bytes in network byte order: 4 bytes for IPv4 addresses, 16 bytes for IPv6 addresses
+		 */
+		const uint8_t* getBytes() const { return m_Bytes; }
+
+		/**
+		 * @return The length of the address in bytes: 4 for IPv4 addresses, 16 for IPv6 addresses and 0 for invalid addresses
+		 */
+		size_t getLength() const { return (m_IPVersion == 4 ? 4 : (m_IPVersion == 6 ? 16 : 0)); }
+
+		/**
+		 * @return The IPv4 address as 4-byte integer in network byte order (the same as IPv4Address#toInt()), or 0 if the instance
+		 * doesn't hold an IPv4 address
+		 */
+		uint32_t toIPv4Int() const;
+
+		/**
+		 * @return The address as IPv4Address, or IPv4Address#Zero if the instance doesn't hold an IPv4 address
+		 */
+		IPv4Address toIPv4Address() const;
+
+		/**
+		 * @return The address as IPv6Address, or IPv6Address#Zero if the instance doesn't hold an IPv6 address
+		 */
+		IPv6Address toIPv6Address() const;
+
+		/**
+		 * @return An auto-pointer to a newly allocated IPv4Address or IPv6Address instance, or an auto-pointer to NULL if the instance is
+		 * invalid
+		 */
+		IPAddress::Ptr_t toIPAddress() const;
+
+		/**
+		 * Write the string representation of the address to a buffer without allocating memory
+		 * @param[out] buffer The buffer to write to
+		 * @param[in] bufferLen The buffer length. MAX_ADDR_STRING_LEN is always enough
+		 * @return The length of the string written (not including the terminating null character), or 0 if the buffer is too small or
+		 * the instance is invalid
+		 */
+		size_t toString(char* buffer, size_t bufferLen) const;
+
+		/**
+		 * @return The string representation of the address, or an empty string if the instance is invalid
+		 */
+		std::string toString() const;
+
+		/**
+		 * @return A 32-bit hash value of the address, suitable for hash tables
+		 */
+		uint32_t hash() const;
+
+		/**
+		 * Overload of the comparison operator
+		 * @return True if both instances hold the same address of the same type, or both are invalid. False otherwise
+		 */
+		bool operator==(const IPAddressValue& other) const { return m_IPVersion == other.m_IPVersion && memcmp(m_Bytes, other.m_Bytes, sizeof(m_Bytes)) == 0; }
+
+		/**
+		 * Overload of the non-equal operator
+		 * @return True if the instances hold different addresses. False otherwise
+		 */
+		bool operator!=(const IPAddressValue& other) const { return !(*this == other); }
+
+		/**
+		 * Overload of the less-than operator, allowing to use this class as a key in ordered containers. IPv4 addresses are ordered
+		 * before IPv6 addresses, and addresses of the same type are ordered by their bytes in network byte order
+		 * @return True if this address is ordered before the other address. False otherwise
+		 */
+		bool operator<(const IPAddressValue& other) const
+		{
+			if (m_IPVersion != other.m_IPVersion)
+				return m_IPVersion < other.m_IPVersion;
+
+			return memcmp(m_Bytes, other.m_Bytes, sizeof(m_Bytes)) < 0;
+		}
+
+	private:
+		// unused bytes of IPv4 addresses are always zero so comparisons can cover all bytes
+		uint8_t m_Bytes[16];
+		uint8_t m_IPVersion;
+	};
+
 } // namespace pcpp
 
 #endif /* PCAPPP_IPADDRESS */
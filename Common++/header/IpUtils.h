@@ -103,6 +103,25 @@ namespace pcpp
 	 */
 	uint16_t compute_checksum(ScalarBuffer<uint16_t> vec[], size_t vecSize);
 
+	/**
+	 * Update an internet checksum after a 16-bit field it covers has changed, without computing it again over the whole data
+	 * (incremental update as described in RFC 1624). All values should be in the same byte order they are stored in the packet
+	 * @param[in] checksum The current value of the checksum field
+	 * @param[in] oldValue The old value of the changed field
+	 * @param[in] newValue The new value of the changed field
+	 * @return The new value of the checksum field
+	 */
+	uint16_t update_checksum(uint16_t checksum, uint16_t oldValue, uint16_t newValue);
+
+	/**
+	 * Same as update_checksum(uint16_t, uint16_t, uint16_t) but for a 32-bit field (for example an IPv4 address) aligned to a 16-bit boundary
+	 * @param[in] checksum The current value of the checksum field
+	 * @param[in] oldValue The old value of the changed field
+	 * @param[in] newValue The new value of the changed field
+	 * @return The new value of the checksum field
+	 */
+	uint16_t update_checksum(uint16_t checksum, uint32_t oldValue, uint32_t newValue);
+
 	/**
 	 * Computes Fowler-Noll-Vo (FNV-1) 32bit hash function on an array of byte buffers. The hash is calculated on each
 	 * byte in each byte buffer, as if all byte buffers were one long byte buffer
@@ -120,5 +139,46 @@ namespace pcpp
 	 */
 	uint32_t fnv_hash(uint8_t* buffer, size_t bufSize);
 
+	/**
+	 * Write the string representation of an IPv4 address (for example "10.0.0.1") to a buffer, without allocating memory. This is
+	 * considerably faster than inet_ntop()
+	 * @param[in] addr The address as 4 bytes in network byte order
+	 * @param[out] buffer The buffer to write the null-terminated string to
+	 * @param[in] bufferLen The buffer length. 16 bytes are always enough
+	 * @return The length of the string, not including the terminating null character, or 0 if the buffer is too small
+	 */
+	size_t format_ipv4_address(const uint8_t* addr, char* buffer, size_t bufferLen);
+
+	/**
+	 * Write the string representation of an IPv6 address to a buffer, without allocating memory. The representation is the same as
+	 * inet_ntop() returns: lowercase hex groups without leading zeros, the first longest run of zero groups compressed to "::" and a
+	 * dotted IPv4 address at the end of IPv4-mapped and IPv4-compatible addresses
+	 * @param[in] addr The address as 16 bytes in network byte order
+	 * @param[out] buffer The buffer to write the null-terminated string to
+	 * @param[in] bufferLen The buffer length. 40 bytes are always enough
+	 * @return The length of the string, not including the terminating null character, or 0 if the buffer is too small
+	 */
+	size_t format_ipv6_address(const uint8_t* addr, char* buffer, size_t bufferLen);
+
+	/**
+	 * Parse a dotted-decimal IPv4 address without allocating memory. The string doesn't have to be null-terminated, so addresses can be
+	 * parsed in place from a larger text. Octets with leading zeros are rejected, the same as inet_pton() does on Linux
+	 * @param[in] str The string to parse
+	 * @param[in] strLen The length of the string, which must contain the address and nothing else
+	 * @param[out] result A 4-byte array the address is written to in network byte order. It's left untouched if parsing fails
+	 * @return True if the string is a valid IPv4 address, false otherwise
+	 */
+	bool parse_ipv4_address(const char* str, size_t strLen, uint8_t* result);
+
+	/**
+	 * Parse an IPv6 address in any of the RFC 4291 text forms (including "::" and a dotted IPv4 address at the end) without allocating
+	 * memory. The string doesn't have to be null-terminated
+	 * @param[in] str The string to parse
+	 * @param[in] strLen The length of the string, which must contain the address and nothing else
+	 * @param[out] result A 16-byte array the address is written to in network byte order. It's left untouched if parsing fails
+	 * @return True if the string is a valid IPv6 address, false otherwise
+	 */
+	bool parse_ipv6_address(const char* str, size_t strLen, uint8_t* result);
+
 } // namespace pcpp
 #endif
@@ -18,7 +18,8 @@ namespace pcpp
 	 * A template class that implements a LRU cache with limited size. Each time the user puts an element it goes to head of the
 	 * list as the most recently used element (if the element was already in the list it advances to the head of the list).
 	 * The last element in the list is the one least recently used and will be pulled out of the list if it reaches its max size
-	 * and a new element comes in. All actions on this LRU list are O(1)
+	 * and a new element comes in. All actions on this LRU list are O(1).
+	 * For large caches FixedLRUList is usually a better fit: it doesn't allocate memory per element and has a lower memory overhead
 	 */
 	template<typename T>
 	class LRUList
@@ -0,0 +1,340 @@
+#ifndef PCAPPP_LATENCY_TRACER
+#define PCAPPP_LATENCY_TRACER
+
+#include <stdint.h>
+#include <stddef.h>
+#include "TimestampClock.h"
+#include "AtomicUtils.h"
+
+/// @file
+
+/**
+ * The tracing points inside PcapPlusPlus (device RX, Packet parsing, the TcpReassembly message callback and device TX) are compiled in
+ * only when the library is built with PCPP_ENABLE_LATENCY_TRACING defined (for example by running the configure script with
+ * --enable-latency-tracing, or by adding -DPCPP_ENABLE_LATENCY_TRACING to the build flags). Otherwise the PCPP_LATENCY_TRACE_* macros
+ * expand to nothing and tracing costs nothing. The LatencyTracer and LatencyHistogram classes are always available, so applications can
+ * record their own stages either way
+ */
+
+/** The number of linear sub-buckets each power of 2 is divided into is 2^PCPP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS. 5 bits give a relative
+ * error of up to 1/32 (~3%) */
+#define PCPP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS 5
+/** Values of 2^PCPP_LATENCY_HISTOGRAM_MAX_VALUE_BITS and above are counted in the last bucket (2^48 cycles are over a day at 3GHz) */
+#define PCPP_LATENCY_HISTOGRAM_MAX_VALUE_BITS 48
+/** The number of buckets of a LatencyHistogram */
+#define PCPP_LATENCY_HISTOGRAM_NUM_OF_BUCKETS \
+	((PCPP_LATENCY_HISTOGRAM_MAX_VALUE_BITS - PCPP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1) << PCPP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+
+/** The maximum number of stages, including the built-in ones (see LatencyStage) */
+#define PCPP_LATENCY_TRACER_MAX_STAGES 16
+/** The maximum number of threads that can record latencies. Threads beyond this number don't record anything */
+#define PCPP_LATENCY_TRACER_MAX_THREADS 128
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class LatencyHistogram
+	 * A latency histogram in the style of HdrHistogram: values are counted in log-linear buckets, where each power of 2 is divided into
+	 * 32 linear sub-buckets, so any value from 0 to 2^48 is counted with a relative error of up to ~3% in a fixed array of counters.
+	 * Recording a value doesn't allocate memory and costs a few instructions. Values are usually durations in cycles as read by
+	 * TimestampClock#readCycleCounter() (see LatencyTracer#cyclesToNs()).
+	 * A histogram is meant to be recorded into by a single thread. Other threads may read it (or merge it into another histogram) while
+	 * it's being recorded into and get an approximate snapshot: each counter is read atomically, but not all of them at the same time
+	 */
+	class LatencyHistogram
+	{
+	public:
+
+		/**
+		 * A c'tor for this class which creates an empty histogram
+		 */
+		LatencyHistogram();
+
+		/**
+		 * Count a value
+		 * @param[in] value The value to count
+		 */
+		inline void record(uint64_t value)
+		{
+			size_t bucket = getBucketIndex(value);
+			atomicStoreRelaxed(&m_Counts[bucket], atomicLoadRelaxed(&m_Counts[bucket]) + 1);
+			atomicStoreRelaxed(&m_TotalCount, atomicLoadRelaxed(&m_TotalCount) + 1);
+			atomicStoreRelaxed(&m_Sum, atomicLoadRelaxed(&m_Sum) + value);
+			if (value < atomicLoadRelaxed(&m_Min))
+				atomicStoreRelaxed(&m_Min, value);
+			if (value > atomicLoadRelaxed(&m_Max))
+				atomicStoreRelaxed(&m_Max, value);
+		}
+
+		/**
+		 * Add the counts of another histogram to this histogram
+		 * @param[in] other The histogram to add
+		 */
+		void merge(const LatencyHistogram& other);
+
+		/**
+		 * Clear all counts
+		 */
+		void reset();
+
+		/**
+		 * @return The number of values counted
+		 */
+		inline uint64_t getCount() const { return atomicLoadRelaxed(&m_TotalCount); }
+
+		/**
+		 * @return The smallest value counted, or 0 if the histogram is empty
+		 */
+		uint64_t getMin() const;
+
+		/**
+		 * @return The largest value counted, or 0 if the histogram is empty
+		 */
+		inline uint64_t getMax() const { return atomicLoadRelaxed(&m_Max); }
+
+		/**
+		 * @return The mean of the values counted, or 0 if the histogram is empty
+		 */
+		double getMean() const;
+
+		/**
+		 * Get the value at a percentile. Like HdrHistogram the highest value of the bucket the percentile falls in is returned (capped at
+		 * the largest value counted), so the result is never lower than the actual value
+		 * @param[in] percentile The percentile (0-100), for example 99.9
+		 * @return The value at the percentile, or 0 if the histogram is empty
+		 */
+		uint64_t getValueAtPercentile(double percentile) const;
+
+		/**
+		 * @param[in] bucket The bucket index (0 to PCPP_LATENCY_HISTOGRAM_NUM_OF_BUCKETS - 1)
+		 * @return The number of values counted in the bucket
+		 */
+		inline uint64_t getBucketCount(size_t bucket) const { return atomicLoadRelaxed(&m_Counts[bucket]); }
+
+		/**
+		 * @param[in] bucket The bucket index
+		 * @return The lowest value counted in the bucket
+		 */
+		static uint64_t getBucketLowestValue(size_t bucket);
+
+		/**
+		 * @param[in] bucket The bucket index
+		 * @return The highest value counted in the bucket
+		 */
+		static uint64_t getBucketHighestValue(size_t bucket);
+
+		/**
+		 * @param[in] value A value
+		 * @return The index of the bucket the value is counted in
+		 */
+		static inline size_t getBucketIndex(uint64_t value)
+		{
+			const uint64_t linearLimit = (uint64_t)2 << PCPP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+			if (value < linearLimit)
+				return (size_t)value;
+
+			int exponent = getHighestBit(value);
+			if (exponent >= PCPP_LATENCY_HISTOGRAM_MAX_VALUE_BITS)
+				return PCPP_LATENCY_HISTOGRAM_NUM_OF_BUCKETS - 1;
+
+			// the top PCPP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1 bits of the value, which are 2^SUB_BUCKET_BITS to 2^(SUB_BUCKET_BITS+1)-1
+			int shift = exponent - PCPP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+			return ((size_t)shift << PCPP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS) + (size_t)(value >> shift);
+		}
+
+	private:
+		volatile uint64_t m_Counts[PCPP_LATENCY_HISTOGRAM_NUM_OF_BUCKETS];
+		volatile uint64_t m_TotalCount;
+		volatile uint64_t m_Sum;
+		volatile uint64_t m_Min;
+		volatile uint64_t m_Max;
+
+		static inline int getHighestBit(uint64_t value)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return 63 - __builtin_clzll(value);
+#else
+			int index = 0;
+			while (value >>= 1)
+				index++;
+			return index;
+#endif
+		}
+
+		// disable copy c'tor and assignment operator
+		LatencyHistogram(const LatencyHistogram& other);
+		LatencyHistogram& operator=(const LatencyHistogram& other);
+	};
+
+
+	/**
+	 * The stages LatencyTracer records latencies for. The first ones are recorded by PcapPlusPlus when it's built with
+	 * PCPP_ENABLE_LATENCY_TRACING, applications may record their own stages from #LatencyStageFirstUserStage up to
+	 * PCPP_LATENCY_TRACER_MAX_STAGES - 1 (see LatencyTracer#setStageName()).
+	 * The "since RX" stages measure the time from the last time the recording thread received packets from a device (see
+	 * LatencyTracer#markRx()) to the end of a stage, so they measure the latency of run-to-completion processing, where the same thread
+	 * receives, processes and sends the packets
+	 */
+	enum LatencyStage
+	{
+		/** Parsing a packet: constructing a Packet or calling Packet#setRawPacket() */
+		LatencyStageParse = 0,
+		/** From device RX to the end of parsing a packet */
+		LatencyStageRxToParse,
+		/** The TcpReassembly message ready callback, from entry to exit */
+		LatencyStageTcpReassemblyCallback,
+		/** From device RX to the exit of the TcpReassembly message ready callback */
+		LatencyStageRxToTcpReassemblyCallback,
+		/** Sending packets from a device (DpdkDevice and PcapLiveDevice sendPacket() and sendPackets()) */
+		LatencyStageTx,
+		/** From device RX to the end of sending packets */
+		LatencyStageRxToTx,
+		/** The first stage applications can record */
+		LatencyStageFirstUserStage
+	};
+
+
+	/**
+	 * @class LatencyTracer
+	 * Records how long packets spend in the stages of a packet processing pipeline into a LatencyHistogram per stage and per thread.
+	 * Durations are measured with TimestampClock#readCycleCounter() (a single RDTSC instruction on x86) and kept in cycles.
+	 * Each thread records into its own histograms, which are allocated the first time the thread records something, so recording needs
+	 * no locks. The histograms of a thread are kept after the thread exits, so its latencies can still be read. Histograms can be read at
+	 * any time from any thread, per thread with getThreadHistogram() or aggregated over all threads with getAggregatedHistogram().
+	 * All methods are static.
+	 * PcapPlusPlus records the built-in stages (see LatencyStage) only when it's built with PCPP_ENABLE_LATENCY_TRACING. Applications can
+	 * record their own stages with the same macros or by calling the methods directly:
+	 *
+	 *     PCPP_LATENCY_TRACE_BEGIN(classifyStart);
+	 *     classify(packet);
+	 *     PCPP_LATENCY_TRACE_END(classifyStart, LatencyStageFirstUserStage, -1);
+	 */
+	class LatencyTracer
+	{
+	public:
+
+		/**
+		 * Read the cycle counter durations are measured with
+		 * @return The current value of TimestampClock#readCycleCounter()
+		 */
+		static inline uint64_t now() { return TimestampClock::readCycleCounter(); }
+
+		/**
+		 * Mark that the current thread has just received packets from a device. The "since RX" stages the thread records next are
+		 * measured from this time
+		 * @param[in] cycles The time packets were received, as read by now()
+		 */
+		static void markRx(uint64_t cycles);
+
+		/**
+		 * Record the duration of a stage in the current thread's histograms
+		 * @param[in] stage The stage (0 to PCPP_LATENCY_TRACER_MAX_STAGES - 1, see LatencyStage)
+		 * @param[in] startCycles The time the stage started, as read by now()
+		 * @param[in] endCycles The time the stage ended, as read by now()
+		 * @param[in] sinceRxStage A stage to record the time from the last markRx() of this thread to endCycles in, or -1 for none. Not
+		 * recorded if the thread never received packets
+		 */
+		static void recordStage(int stage, uint64_t startCycles, uint64_t endCycles, int sinceRxStage = -1);
+
+		/**
+		 * Allocate the histograms of the current thread if they weren't allocated yet. Otherwise they're allocated the first time the
+		 * thread records something, so processing threads may call it when they start to keep the allocation out of the packet path
+		 * @return The index of the current thread, or -1 if PCPP_LATENCY_TRACER_MAX_THREADS threads are recording already
+		 */
+		static int registerCurrentThread();
+
+		/**
+		 * @return The number of threads which recorded latencies so far. Thread indices are 0 to getNumOfThreads() - 1 in the order the
+		 * threads started recording
+		 */
+		static int getNumOfThreads();
+
+		/**
+		 * @return The index of the current thread, or -1 if it didn't record latencies yet
+		 */
+		static int getCurrentThreadIndex();
+
+		/**
+		 * Get the histogram of a stage recorded by a single thread
+		 * @param[in] threadIndex The thread index (0 to getNumOfThreads() - 1)
+		 * @param[in] stage The stage
+		 * @return The histogram or NULL if the thread index or stage is out of range
+		 */
+		static const LatencyHistogram* getThreadHistogram(int threadIndex, int stage);
+
+		/**
+		 * Merge the histograms of a stage of all threads
+		 * @param[in] stage The stage
+		 * @param[out] result The histogram to merge into. It's reset first
+		 * @return False if the stage is out of range, true otherwise
+		 */
+		static bool getAggregatedHistogram(int stage, LatencyHistogram& result);
+
+		/**
+		 * Clear the histograms of all threads. Latencies recorded at the same time by other threads may be lost or partly counted
+		 */
+		static void reset();
+
+		/**
+		 * Set the name of a stage, which is shown by printSummary(). The built-in stages have names already
+		 * @param[in] stage The stage
+		 * @param[in] name The name. Only the pointer is kept, so it should point to a string literal or to a string that outlives the
+		 * tracer
+		 * @return False if the stage is out of range, true otherwise
+		 */
+		static bool setStageName(int stage, const char* name);
+
+		/**
+		 * @param[in] stage The stage
+		 * @return The name of the stage, or NULL if the stage is out of range or has no name
+		 */
+		static const char* getStageName(int stage);
+
+		/**
+		 * Convert a duration measured with now() to nanoseconds. When the cycle counter isn't the calibrated TSC (see
+		 * TimestampClock#getTscFrequency()) it counts nanoseconds already and is returned as is
+		 * @param[in] cycles The duration in cycles
+		 * @return The duration in nanoseconds
+		 */
+		static double cyclesToNs(uint64_t cycles);
+
+		/**
+		 * Print a table of the latencies of all stages that have any values, aggregated over all threads, to stdout: the number of
+		 * values, the minimum, mean, median, 99th, 99.9th percentile and maximum in nanoseconds
+		 */
+		static void printSummary();
+
+		/**
+		 * @return True if PcapPlusPlus was built with its tracing points (PCPP_ENABLE_LATENCY_TRACING), false otherwise
+		 */
+		static bool isTracingCompiledIn();
+	};
+
+} // namespace pcpp
+
+
+#ifdef PCPP_ENABLE_LATENCY_TRACING
+
+/** Mark that the current thread has just received packets (see LatencyTracer#markRx()) */
+#define PCPP_LATENCY_TRACE_RX() pcpp::LatencyTracer::markRx(pcpp::LatencyTracer::now())
+
+/** Start timing a stage: declare a variable with the given name holding the current cycle counter */
+#define PCPP_LATENCY_TRACE_BEGIN(startVar) uint64_t startVar = pcpp::LatencyTracer::now()
+
+/** End timing a stage started with PCPP_LATENCY_TRACE_BEGIN() and record it (see LatencyTracer#recordStage()) */
+#define PCPP_LATENCY_TRACE_END(startVar, stage, sinceRxStage) pcpp::LatencyTracer::recordStage(stage, startVar, pcpp::LatencyTracer::now(), sinceRxStage)
+
+#else
+
+#define PCPP_LATENCY_TRACE_RX() do { } while (0)
+#define PCPP_LATENCY_TRACE_BEGIN(startVar) do { } while (0)
+#define PCPP_LATENCY_TRACE_END(startVar, stage, sinceRxStage) do { } while (0)
+
+#endif // PCPP_ENABLE_LATENCY_TRACING
+
+#endif /* PCAPPP_LATENCY_TRACER */
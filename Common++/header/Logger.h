@@ -10,6 +10,22 @@
 
 /// @file
 
+/** Compile-time log level in which all log messages are compiled out */
+#define PCPP_LOG_LEVEL_NONE  0
+/** Compile-time log level in which only error messages are compiled in */
+#define PCPP_LOG_LEVEL_ERROR 1
+/** Compile-time log level in which both error and debug messages are compiled in */
+#define PCPP_LOG_LEVEL_DEBUG 2
+
+/**
+ * The maximum log level compiled into the code. Messages of higher levels are compiled out entirely: their arguments aren't evaluated
+ * and checking whether they're enabled costs nothing. For example, building with -DPCPP_MAX_LOG_LEVEL=PCPP_LOG_LEVEL_ERROR (or 1)
+ * removes all debug messages. The default is PCPP_LOG_LEVEL_DEBUG, meaning all messages are compiled in and controlled at runtime
+ */
+#ifndef PCPP_MAX_LOG_LEVEL
+#define PCPP_MAX_LOG_LEVEL PCPP_LOG_LEVEL_DEBUG
+#endif
+
 /**
  * \namespace pcpp
  * \brief The main namespace for the PcapPlusPlus lib
@@ -26,6 +42,9 @@ namespace pcpp
 		CommonLogModuleIpUtils, ///< IP Utils module (Common++)
 		CommonLogModuleTablePrinter, ///< Table printer module (Common++)
 		CommonLogModuleGenericUtils, ///< Generic Utils (Common++)
+		CommonLogModuleStatsReporter, ///< Stats reporter (Common++)
+		CommonLogModuleMetricsRegistry, ///< Metrics registry and exporter (Common++)
+		CommonLogModuleHardwareCounters, ///< Hardware counters (Common++)
 		PacketLogModuleRawPacket, ///< RawPacket module (Packet++)
 		PacketLogModulePacket, ///< Packet module (Packet++)
 		PacketLogModuleLayer, ///< Layer module (Packet++)
@@ -53,6 +72,23 @@ namespace pcpp
 		PacketLogModuleGtpLayer, ///< GtpLayer module (Packet++)
 		PacketLogModuleTcpReassembly, ///< TcpReassembly module (Packet++)
 		PacketLogModuleIPReassembly, ///< IPReassembly module (Packet++)
+		PacketLogModuleRuleClassifier, ///< RuleClassifier module (Packet++)
+		PacketLogModuleMultiPatternMatcher, ///< MultiPatternMatcher module (Packet++)
+		PacketLogModuleFlowDispatcher, ///< FlowDispatcher module (Packet++)
+		PacketLogModuleHttpStreamParser, ///< HttpStreamParser module (Packet++)
+		PacketLogModuleSSLStreamParser, ///< SSLStreamParser module (Packet++)
+		PacketLogModuleSipDialogTracker, ///< SipDialogTracker module (Packet++)
+		PacketLogModuleTrafficGenerator, ///< TrafficGenerator module (Packet++)
+		PacketLogModuleFlowExporter, ///< FlowMeter and FlowExporter module (Packet++)
+		PacketLogModuleStreamCoroutine, ///< StreamCoroutine module (Packet++)
+		PacketLogModulePacketMemoryAllocator, ///< PacketMemoryAllocator module (Packet++)
+		PacketLogModuleTcpFlowTracker, ///< TcpFlowTracker module (Packet++)
+		PacketLogModuleGtpSessionTable, ///< GtpSessionTable module (Packet++)
+		PacketLogModuleTrafficShaper, ///< TrafficShaper module (Packet++)
+		PacketLogModuleParallelPacketProcessor, ///< ParallelPacketProcessor module (Packet++)
+		PacketLogModuleDomainMatcher, ///< DomainMatcher module (Packet++)
+		PacketLogModuleClusterDistributor, ///< ClusterDistributor module (Packet++)
+		PacketLogModuleL3Forwarder, ///< L3Forwarder module (Packet++)
 		PcapLogModuleWinPcapLiveDevice, ///< WinPcapLiveDevice module (Pcap++)
 		PcapLogModuleRemoteDevice, ///< WinPcapRemoteDevice module (Pcap++)
 		PcapLogModuleLiveDevice, ///< PcapLiveDevice module (Pcap++)
@@ -61,6 +97,28 @@ namespace pcpp
 		PcapLogModuleMBufRawPacket, ///< MBufRawPacket module (Pcap++)
 		PcapLogModuleDpdkDevice, ///< DpdkDevice module (Pcap++)
 		PcapLogModuleKniDevice, ///< KniDevice module (Pcap++)
+		PcapLogModulePacketMmapDevice, ///< PacketMmapDevice module (Pcap++)
+		PcapLogModuleXdpDevice, ///< XdpDevice module (Pcap++)
+		PcapLogModulePacketQueueDevice, ///< PacketQueueDevice module (Pcap++)
+		PcapLogModuleDeviceReactor, ///< DeviceReactor module (Pcap++)
+		PcapLogModuleDpdkPipeline, ///< DpdkPipeline module (Pcap++)
+		PcapLogModuleDpdkAdaptivePoller, ///< DpdkAdaptivePoller module (Pcap++)
+		PcapLogModuleDpdkForwarder, ///< DpdkForwarder module (Pcap++)
+		PcapLogModuleDpdkTxAggregator, ///< DpdkTxAggregator module (Pcap++)
+		PcapLogModuleDpdkL2Switch, ///< DpdkL2Switch module (Pcap++)
+		PcapLogModuleDpdkEventScheduler, ///< DpdkEventScheduler module (Pcap++)
+		PcapLogModuleDpdkCaptureWriter, ///< DpdkCaptureWriter module (Pcap++)
+		PcapLogModulePacketSampler, ///< PacketSampler module (Pcap++)
+		PcapLogModuleBenchmarkHarness, ///< BenchmarkHarness module (Pcap++)
+		PcapLogModuleDnsResponderEngine, ///< DnsResponderEngine module (Pcap++)
+		PcapLogModuleSharedMemoryRingDevice, ///< SharedMemoryRingDevice module (Pcap++)
+		PcapLogModuleMergingReaderDevice, ///< MergingReaderDevice module (Pcap++)
+		PcapLogModuleBsdBpfDevice, ///< BsdBpfDevice module (Pcap++)
+		PcapLogModuleRemoteCaptureDevice, ///< RemoteCaptureDevice module (Pcap++)
+		PcapLogModuleArrowFileWriter, ///< ArrowFileWriter and PacketTableWriter module (Pcap++)
+		PcapLogModuleFlightRecorderDevice, ///< FlightRecorderDevice module (Pcap++)
+		PcapLogModuleDpdkRssRebalancer, ///< DpdkRssRebalancer module (Pcap++)
+		PcapLogModuleDpdkL3Router, ///< DpdkL3Router module (Pcap++)
 		NetworkUtils, ///< NetworkUtils module (Pcap++)
 		NumOfLogModules
 	};
@@ -77,6 +135,16 @@ namespace pcpp
 	 * 1. Suppress errors - no errors will be printed (for all modules)
 	 * 2. Print error logs to a string provided by the user instead of stderr
 	 *
+	 * Checking whether a module is set to debug log level, or whether errors are suppressed, is a single memory load. Log levels can also
+	 * be compiled out entirely using #PCPP_MAX_LOG_LEVEL.
+	 *
+	 * Async logging: by default messages are printed synchronously by the thread logging them. When async logging is started (see
+	 * startAsyncLogging()) each thread formats its messages into its own lock-free single-producer single-consumer ring, and a background
+	 * thread drains the rings and prints the messages. This way logging threads (for example threads polling a NIC) never block on I/O.
+	 * If a ring is full the message is dropped and counted. Identical messages repeated by the same thread are rate-limited: after the
+	 * first one, repetitions are counted and a summary line is printed at most once per rate limit interval. In async mode messages are
+	 * always printed to stdout (debug) or stderr (errors); the user error string isn't used.
+	 *
 	 * PcapPlusPlus logger is a singleton which can be reached from anywhere in the code *
 	 */
 	class LoggerPP
@@ -96,20 +164,28 @@ namespace pcpp
 		 * @param[in] module PcapPlusPlus module
 		 * @param[in] level The log level to set the module to
 		 */
-		void setLogLevel(LogModule module, LogLevel level) { m_LogModulesArray[module] = level; }
+		void setLogLevel(LogModule module, LogLevel level) { s_LogModulesArray[module] = level; }
 
 		/**
 		 * Set all PcapPlusPlus modules to a certain log leve
 		 * @param[in] level The log level to set all modules to
 		 */
-		void setAllModlesToLogLevel(LogLevel level) { for (int i=1; i<NumOfLogModules; i++) m_LogModulesArray[i] = level; }
+		void setAllModlesToLogLevel(LogLevel level) { for (int i=1; i<NumOfLogModules; i++) s_LogModulesArray[i] = level; }
 
 		/**
 		 * Check whether a certain module is set to debug log level
 		 * @param[in] module PcapPlusPlus module
 		 * @return True if this module log level is "debug". False otherwise
 		 */
-		inline bool isDebugEnabled(LogModule module) { return m_LogModulesArray[module] == Debug; }
+		inline bool isDebugEnabled(LogModule module) { return s_LogModulesArray[module] == Debug; }
+
+		/**
+		 * Same as isDebugEnabled() but doesn't require accessing the singleton, so it's a single memory load. This is what LOG_DEBUG
+		 * and IS_DEBUG use
+		 * @param[in] module PcapPlusPlus module
+		 * @return True if this module log level is "debug". False otherwise
+		 */
+		static inline bool isModuleDebugEnabled(LogModule module) { return s_LogModulesArray[module] == Debug; }
 
 		/**
 		 * Get an array that contains log level information for all modules. User can access this array with a certain PcapPlusPlus module
@@ -118,7 +194,7 @@ namespace pcpp
 		 * if (myLogLevelArr[PacketLogModuleUdpLayer] == LogLevel::Debug) ....
 		 * @return A pointer to the LogLevel array
 		 */
-		inline LogLevel* getLogModulesArr() { return m_LogModulesArray; }
+		inline LogLevel* getLogModulesArr() { return s_LogModulesArray; }
 
 		/**
 		 * Check whether error string was already set
@@ -149,18 +225,69 @@ namespace pcpp
 		/**
 		 * Suppress all errors in all PcapPlusPlusModules
 		 */
-		void supressErrors() { m_SuppressErrors = true; }
+		void supressErrors() { s_SuppressErrors = true; }
 
 		/**
 		 * Enable all errors in all PcapPlusPlusModules
 		 */
-		void enableErrors() { m_SuppressErrors = false; }
+		void enableErrors() { s_SuppressErrors = false; }
 
 		/**
 		 * Get an indication if errors are currently suppressed
 		 * @return True if errors are currently suppressed, false otherwise
 		 */
-		inline bool isSupressErrors() { return m_SuppressErrors; }
+		inline bool isSupressErrors() { return s_SuppressErrors; }
+
+		/**
+		 * Same as isSupressErrors() but doesn't require accessing the singleton. This is what LOG_ERROR uses
+		 * @return True if errors are currently suppressed, false otherwise
+		 */
+		static inline bool areErrorsSuppressed() { return s_SuppressErrors; }
+
+		/**
+		 * Start async logging. From now on messages are queued in per-thread rings and printed by a background thread (see the class
+		 * description). If async logging is already running nothing happens
+		 * @param[in] ringCapacity The number of messages each thread's ring can hold. Messages logged while the ring is full are dropped.
+		 * Default value is 1024
+		 * @param[in] rateLimitIntervalMs The minimum interval in milliseconds between summary lines of a message which is being repeated.
+		 * 0 disables rate limiting. Default value is 1000
+		 * @return True if async logging is running when the method returns, false if the background thread couldn't be created
+		 */
+		bool startAsyncLogging(size_t ringCapacity = 1024, uint32_t rateLimitIntervalMs = 1000);
+
+		/**
+		 * Stop async logging: wait for the background thread to print all queued messages (including repetition summaries) and go back
+		 * to synchronous logging. Messages logged concurrently by other threads while stopping may be delayed until async logging is
+		 * started again. If async logging isn't running nothing happens
+		 */
+		void stopAsyncLogging();
+
+		/**
+		 * @return True if async logging is currently running
+		 */
+		static inline bool isAsyncLoggingEnabled() { return s_AsyncLogging; }
+
+		/**
+		 * @return The number of messages dropped since async logging was started because a thread's ring was full
+		 */
+		uint64_t getNumOfDroppedMessages() const;
+
+		/**
+		 * @return The number of messages that weren't printed since async logging was started because they repeated the previous message
+		 * of the same thread (they're summarized in "repeated N times" lines)
+		 */
+		uint64_t getNumOfSuppressedRepeats() const;
+
+		/**
+		 * Queue a message to the calling thread's ring. Normally called by LOG_DEBUG and LOG_ERROR when async logging is running
+		 * @param[in] level Debug messages are printed to stdout and Normal messages (errors) to stderr
+		 * @param[in] format A printf-style format string, followed by its arguments
+		 */
+		void logAsync(LogLevel level, const char* format, ...)
+#ifdef __GNUC__
+			__attribute__((format(printf, 3, 4)))
+#endif
+			;
 
 		/**
 		 * Get access to LoggerPP singleton
@@ -175,27 +302,61 @@ namespace pcpp
 	private:
 		char* m_ErrorString;
 		int m_ErrorStringLen;
-		bool m_SuppressErrors;
-		LoggerPP::LogLevel m_LogModulesArray[NumOfLogModules];
+		// kept static (constant-initialized) so checking them doesn't go through the singleton
+		static bool s_SuppressErrors;
+		static bool s_AsyncLogging;
+		static LoggerPP::LogLevel s_LogModulesArray[NumOfLogModules];
 		LoggerPP();
 	};
 
+#if PCPP_MAX_LOG_LEVEL >= PCPP_LOG_LEVEL_DEBUG
+
+#define LOG_DEBUG(format, ...) do { \
+			if(pcpp::LoggerPP::isModuleDebugEnabled(LOG_MODULE)) { \
+				if (pcpp::LoggerPP::isAsyncLoggingEnabled()) \
+					pcpp::LoggerPP::getInstance().logAsync(pcpp::LoggerPP::Debug, "[%-35s: %-25s: line:%-4d] " format "\n", __FILE__, __FUNCTION__, __LINE__, ## __VA_ARGS__); \
+				else \
+					printf("[%-35s: %-25s: line:%-4d] " format "\n", __FILE__, __FUNCTION__, __LINE__, ## __VA_ARGS__); \
+			} \
+	} while(0)
+
+#define IS_DEBUG pcpp::LoggerPP::isModuleDebugEnabled(LOG_MODULE)
+
+#else
+
+// the message is still compiled (but never executed) so format errors and unused variables are reported the same in all log levels
 #define LOG_DEBUG(format, ...) do { \
-			if(pcpp::LoggerPP::getInstance().isDebugEnabled(LOG_MODULE)) { \
-				printf("[%-35s: %-25s: line:%-4d] " format "\n", __FILE__, __FUNCTION__, __LINE__, ## __VA_ARGS__); \
+			if (0) { \
+				printf(format "\n", ## __VA_ARGS__); \
 			} \
 	} while(0)
 
+#define IS_DEBUG false
+
+#endif
+
+#if PCPP_MAX_LOG_LEVEL >= PCPP_LOG_LEVEL_ERROR
+
 #define LOG_ERROR(format, ...) do { \
-			if (!pcpp::LoggerPP::getInstance().isSupressErrors()) {\
-				if(pcpp::LoggerPP::getInstance().isErrorStringSet()) \
+			if (!pcpp::LoggerPP::areErrorsSuppressed()) {\
+				if (pcpp::LoggerPP::isAsyncLoggingEnabled()) \
+					pcpp::LoggerPP::getInstance().logAsync(pcpp::LoggerPP::Normal, format "\n", ## __VA_ARGS__); \
+				else if(pcpp::LoggerPP::getInstance().isErrorStringSet()) \
 					snprintf(pcpp::LoggerPP::getInstance().getErrorString(), pcpp::LoggerPP::getInstance().getErrorStringLength(), format "\n", ## __VA_ARGS__); \
 				else \
 					fprintf(stderr, format "\n", ## __VA_ARGS__); \
 			} \
 		} while (0)
 
-#define IS_DEBUG pcpp::LoggerPP::getInstance().isDebugEnabled(LOG_MODULE)
+#else
+
+#define LOG_ERROR(format, ...) do { \
+			if (0) { \
+				fprintf(stderr, format "\n", ## __VA_ARGS__); \
+			} \
+		} while (0)
+
+#endif
 
 } // namespace pcpp
 
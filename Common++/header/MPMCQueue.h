@@ -0,0 +1,217 @@
+#ifndef PCAPPP_MPMC_QUEUE
+#define PCAPPP_MPMC_QUEUE
+
+#include <stddef.h>
+#include "AtomicUtils.h"
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class MPMCQueue
+	 * A bounded lock-free queue which any number of producer threads push elements to and any number of consumer threads pop them from.
+	 * The elements are kept in a ring allocated in the c'tor, and each slot carries a sequence number telling whether it's free for the
+	 * producer of a given round or holds an element for the consumer of that round. A producer claims slots by advancing the shared tail
+	 * index with a compare-and-swap, writes them and releases each slot by storing its sequence number; consumers do the same with the head
+	 * index. Producers therefore only contend with each other on the tail index and consumers on the head index, which are kept on separate
+	 * cache lines.
+	 * pushBulk() and popBulk() claim a run of consecutive slots with one compare-and-swap, so passing a burst of packets costs about as much
+	 * as passing one. Elements pushed by the same producer are popped in the order they were pushed, but elements of different producers may
+	 * interleave in any order. Unlike SPSCQueue, elements are copied in and out, so T should be cheap to copy (a pointer, typically).
+	 * When there's a single producer and a single consumer SPSCQueue is cheaper
+	 */
+	template<typename T>
+	class MPMCQueue
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] capacity The maximum number of elements in the queue. It's rounded up to a power of 2, and is at least 2
+		 */
+		MPMCQueue(size_t capacity)
+		{
+			m_Capacity = 2;
+			while (m_Capacity < capacity)
+				m_Capacity <<= 1;
+			m_Mask = m_Capacity - 1;
+			m_Cells = new Cell[m_Capacity];
+			for (size_t i = 0; i < m_Capacity; i++)
+				m_Cells[i].sequence = i;
+			m_Tail = 0;
+			m_Head = 0;
+		}
+
+		/**
+		 * A d'tor for this class. Destroys all elements, including the ones which weren't popped
+		 */
+		~MPMCQueue()
+		{
+			delete [] m_Cells;
+		}
+
+		/**
+		 * Copy an element into the queue. May be called by any number of threads concurrently
+		 * @param[in] element The element to copy
+		 * @return True if the element was pushed, false if the queue is full
+		 */
+		inline bool push(const T& element)
+		{
+			return pushBulk(&element, 1) == 1;
+		}
+
+		/**
+		 * Copy several elements into the queue. The elements are pushed as one run of consecutive slots, so they're popped in order and aren't
+		 * interleaved with elements of other producers. May be called by any number of threads concurrently
+		 * @param[in] elements The elements to copy
+		 * @param[in] count The number of elements
+		 * @return The number of elements pushed, which is less than count if the queue doesn't have room for all of them. The elements
+		 * pushed are always the first ones
+		 */
+		inline size_t pushBulk(const T* elements, size_t count)
+		{
+			size_t pos = atomicLoadAcquire(&m_Tail);
+			size_t claimed = 0;
+			while (true)
+			{
+				// count the free slots starting at pos, a slot is free for the producer of pos when its sequence number equals pos
+				claimed = 0;
+				while (claimed < count && atomicLoadAcquire(&m_Cells[(pos + claimed) & m_Mask].sequence) == pos + claimed)
+					claimed++;
+
+				if (claimed == 0)
+				{
+					// the slot still holds the element of the previous round, which means the queue is full
+					if ((ptrdiff_t)(atomicLoadAcquire(&m_Cells[pos & m_Mask].sequence) - pos) < 0)
+						return 0;
+
+					// another producer already claimed the slot
+					pos = atomicLoadAcquire(&m_Tail);
+					continue;
+				}
+
+				if (atomicCompareExchange(&m_Tail, pos, pos + claimed))
+					break;
+			}
+
+			for (size_t i = 0; i < claimed; i++)
+			{
+				Cell& cell = m_Cells[(pos + i) & m_Mask];
+				cell.data = elements[i];
+				atomicStoreRelease(&cell.sequence, pos + i + 1);
+			}
+
+			return claimed;
+		}
+
+		/**
+		 * Copy the oldest element out of the queue and remove it. May be called by any number of threads concurrently
+		 * @param[out] element The element to copy to
+		 * @return True if an element was popped, false if the queue is empty
+		 */
+		inline bool pop(T& element)
+		{
+			return popBulk(&element, 1) == 1;
+		}
+
+		/**
+		 * Copy up to maxCount of the oldest elements out of the queue and remove them. May be called by any number of threads concurrently
+		 * @param[out] elements An array of at least maxCount elements to copy to
+		 * @param[in] maxCount The maximum number of elements to pop
+		 * @return The number of elements popped, 0 if the queue is empty
+		 */
+		inline size_t popBulk(T* elements, size_t maxCount)
+		{
+			size_t pos = atomicLoadAcquire(&m_Head);
+			size_t claimed = 0;
+			while (true)
+			{
+				// count the full slots starting at pos, a slot holds an element for the consumer of pos when its sequence number is pos+1
+				claimed = 0;
+				while (claimed < maxCount && atomicLoadAcquire(&m_Cells[(pos + claimed) & m_Mask].sequence) == pos + claimed + 1)
+					claimed++;
+
+				if (claimed == 0)
+				{
+					// the slot wasn't written in this round yet, which means the queue is empty (or its producer didn't finish writing it)
+					if ((ptrdiff_t)(atomicLoadAcquire(&m_Cells[pos & m_Mask].sequence) - (pos + 1)) < 0)
+						return 0;
+
+					// another consumer already claimed the slot
+					pos = atomicLoadAcquire(&m_Head);
+					continue;
+				}
+
+				if (atomicCompareExchange(&m_Head, pos, pos + claimed))
+					break;
+			}
+
+			for (size_t i = 0; i < claimed; i++)
+			{
+				Cell& cell = m_Cells[(pos + i) & m_Mask];
+				elements[i] = cell.data;
+				// free the slot for the producer of the next round
+				atomicStoreRelease(&cell.sequence, pos + i + m_Capacity);
+			}
+
+			return claimed;
+		}
+
+		/**
+		 * @return The number of elements in the queue, including ones being written or read. When called while other threads work on the
+		 * queue the value may already be outdated
+		 */
+		inline size_t size() const
+		{
+			size_t head = atomicLoadAcquire(&m_Head);
+			size_t tail = atomicLoadAcquire(&m_Tail);
+			return (tail > head ? tail - head : 0);
+		}
+
+		/**
+		 * @return True if the queue is empty. When called while other threads work on the queue the value may already be outdated
+		 */
+		inline bool empty() const { return size() == 0; }
+
+		/**
+		 * @return The maximum number of elements in the queue
+		 */
+		inline size_t getCapacity() const { return m_Capacity; }
+
+	private:
+
+		enum { CacheLineSize = 64 };
+
+		struct Cell
+		{
+			volatile size_t sequence;
+			T data;
+		};
+
+		Cell* m_Cells;
+		size_t m_Capacity;
+		size_t m_Mask;
+
+		// the index producers claim slots from
+		char m_ProducerPad[CacheLineSize];
+		volatile size_t m_Tail;
+
+		// the index consumers claim slots from
+		char m_ConsumerPad[CacheLineSize - sizeof(size_t)];
+		volatile size_t m_Head;
+		char m_EndPad[CacheLineSize - sizeof(size_t)];
+
+		// disable copy c'tor and assignment operator
+		MPMCQueue(const MPMCQueue& other);
+		MPMCQueue& operator=(const MPMCQueue& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_MPMC_QUEUE */
@@ -5,6 +5,8 @@
 #include <string.h>
 #include <string>
 
+#define MAX_MAC_STRING_LEN 18 //xx:xx:xx:xx:xx:xx\0
+
 #if __cplusplus > 199711L || _MSC_VER >= 1800
 #include <initializer_list>
 #include <algorithm>
@@ -43,13 +45,15 @@ namespace pcpp
 
 		/**
 		 *  A constructor that creates an instance of the class out of a (char*) string.
+		 *  The string is 6 pairs of hex digits separated by any character (for example "00:1a:2b:3c:d4:ef" or "00.1a.2b.3c.d4.ef"),
+		 *  optionally followed by one more separator. Use parse() to accept only ':' or '-' separators.
 		 *  If the string doesn't represent a valid MAC address, instance will be invalid, meaning isValid() will return false
 		 *  @param[in] addr A pointer to the (char*) string
 		 */
 		MacAddress(const char* addr) { init(addr); }
 
 		/**
-		 *  A constructor that creates an instance of the class out of a std::string.
+		 *  A constructor that creates an instance of the class out of a std::string, in the same forms as the (char*) string c'tor.
 		 *  If the string doesn't represent a valid MAC address, instance will be invalid, meaning isValid() will return false
 	 	 *	@param[in] addr A pointer to the string
 		 */
@@ -134,6 +138,24 @@ namespace pcpp
 		 */
 		std::string toString() const;
 
+		/**
+		 * Write the string representation of the address (for example "00:11:22:aa:bb:cc") to a buffer without allocating memory
+		 * @param[out] buffer The buffer to write the null-terminated string to
+		 * @param[in] bufferLen The buffer length. MAX_MAC_STRING_LEN is always enough
+		 * @return The length of the string, not including the terminating null character, or 0 if the buffer is too small
+		 */
+		size_t toString(char* buffer, size_t bufferLen) const;
+
+		/**
+		 * Parse a MAC address of the form "xx:xx:xx:xx:xx:xx" or "xx-xx-xx-xx-xx-xx" (upper or lower case hex digits) without allocating
+		 * memory. The string doesn't have to be null-terminated, so addresses can be parsed in place from a larger text
+		 * @param[in] str The string to parse
+		 * @param[in] strLen The length of the string, which must contain the address and nothing else
+		 * @param[out] result The parsed address. It's left untouched if parsing fails
+		 * @return True if the string is a valid MAC address, false otherwise
+		 */
+		static bool parse(const char* str, size_t strLen, MacAddress& result);
+
 		/**
 		 * Allocates a byte array of length 6 and copies address value into it. Array deallocation is user responsibility
 		 * @param[in] arr A pointer to where array will be allocated
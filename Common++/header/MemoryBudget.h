@@ -0,0 +1,250 @@
+#ifndef PCAPPP_MEMORY_BUDGET
+#define PCAPPP_MEMORY_BUDGET
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * An enum of the policies for choosing which state to evict when a memory budget is exceeded
+	 */
+	enum EvictionPolicy
+	{
+		/** Evict the state which was used least recently */
+		EvictLeastRecentlyUsed,
+		/** Evict the state which was created first */
+		EvictOldestFirst,
+		/** Evict the state which takes the most memory */
+		EvictLargestFirst
+	};
+
+
+	/**
+	 * @class MemoryBudget
+	 * A limit on the number of bytes a set of components may keep, for example the connection state and out-of-order data of TcpReassembly
+	 * and the fragments of IPReassembly. Each component charges the budget for the memory it takes and releases it when the memory is freed,
+	 * and when the budget is exceeded the component which made it exceed evicts some of its own state until the budget isn't exceeded
+	 * or it has nothing left to evict. A budget can be given to several components so they share a single limit. Charging and releasing
+	 * is O(1). A budget isn't thread-safe, so all components sharing it must be used from the same thread
+	 */
+	class MemoryBudget
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] maxBytes The maximum number of bytes. If it's 0 there is no limit and the budget only counts the bytes. Default value is 0
+		 */
+		MemoryBudget(size_t maxBytes = 0) : m_MaxBytes(maxBytes), m_UsedBytes(0), m_PeakBytes(0), m_NumOfEvictions(0), m_EvictedBytes(0) {}
+
+		/**
+		 * Charge the budget for memory taken
+		 * @param[in] bytes The number of bytes
+		 */
+		inline void charge(size_t bytes)
+		{
+			m_UsedBytes += bytes;
+			if (m_UsedBytes > m_PeakBytes)
+				m_PeakBytes = m_UsedBytes;
+		}
+
+		/**
+		 * Release memory charged before
+		 * @param[in] bytes The number of bytes
+		 */
+		inline void release(size_t bytes) { m_UsedBytes -= (bytes < m_UsedBytes ? bytes : m_UsedBytes); }
+
+		/**
+		 * Count an eviction made to meet the budget
+		 * @param[in] bytes The number of bytes the evicted state took
+		 */
+		inline void countEviction(size_t bytes) { m_NumOfEvictions++; m_EvictedBytes += bytes; }
+
+		/**
+		 * @return True if there is a limit and more bytes than it are charged
+		 */
+		inline bool isExceeded() const { return m_MaxBytes > 0 && m_UsedBytes > m_MaxBytes; }
+
+		/**
+		 * Change the maximum number of bytes. Components evict state the next time they charge the budget
+		 * @param[in] maxBytes The maximum number of bytes, or 0 for no limit
+		 */
+		inline void setMaxBytes(size_t maxBytes) { m_MaxBytes = maxBytes; }
+
+		/**
+		 * @return The maximum number of bytes, or 0 if there is no limit
+		 */
+		inline size_t getMaxBytes() const { return m_MaxBytes; }
+
+		/**
+		 * @return The number of bytes currently charged
+		 */
+		inline size_t getUsedBytes() const { return m_UsedBytes; }
+
+		/**
+		 * @return The highest number of bytes charged at any time
+		 */
+		inline size_t getPeakBytes() const { return m_PeakBytes; }
+
+		/**
+		 * @return The number of times state was evicted to meet the budget
+		 */
+		inline uint64_t getNumOfEvictions() const { return m_NumOfEvictions; }
+
+		/**
+		 * @return The total number of bytes the evicted state took
+		 */
+		inline uint64_t getEvictedBytes() const { return m_EvictedBytes; }
+
+	private:
+		size_t m_MaxBytes;
+		size_t m_UsedBytes;
+		size_t m_PeakBytes;
+		uint64_t m_NumOfEvictions;
+		uint64_t m_EvictedBytes;
+	};
+
+
+	/**
+	 * @class EvictionList
+	 * Keeps track of evictable state, such as connections or partially reassembled packets, in the order an EvictionPolicy chooses them for
+	 * eviction. Each item has a size in bytes and a 64-bit user value identifying the state. All operations are O(1):
+	 * - with pcpp#EvictLeastRecentlyUsed items are kept in a list and moved to its end when touched
+	 * - with pcpp#EvictOldestFirst items are kept in a list in the order they were added
+	 * - with pcpp#EvictLargestFirst items are kept in buckets by the power of 2 of their size and the victim is taken from the largest non-empty
+	 *   bucket, so it takes at least half as many bytes as the largest item
+	 *
+	 * Items are stored in a pool of nodes which is reused, so adding an item allocates memory only when the number of items grows beyond its
+	 * previous maximum
+	 */
+	class EvictionList
+	{
+	public:
+
+		/**
+		 * The ID returned for an item which couldn't be added and never used for a valid item
+		 */
+		static const uint32_t InvalidItemId = 0xffffffff;
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] policy The order items are chosen for eviction in. Default value is pcpp#EvictLeastRecentlyUsed
+		 */
+		EvictionList(EvictionPolicy policy = EvictLeastRecentlyUsed);
+
+		/**
+		 * Add an item
+		 * @param[in] userValue A value identifying the item, returned by getVictim()
+		 * @param[in] bytes The size of the item
+		 * @return The ID of the item, valid until it's removed
+		 */
+		uint32_t add(uint64_t userValue, size_t bytes);
+
+		/**
+		 * Remove an item
+		 * @param[in] itemId The item ID
+		 */
+		void remove(uint32_t itemId);
+
+		/**
+		 * Mark an item as used. With pcpp#EvictLeastRecentlyUsed it becomes the last to be evicted, with the other policies nothing changes
+		 * @param[in] itemId The item ID
+		 */
+		inline void touch(uint32_t itemId)
+		{
+			if (m_Policy == EvictLeastRecentlyUsed && m_Nodes[itemId].next != NullNode)
+			{
+				unlinkNode(itemId);
+				linkNode(itemId);
+			}
+		}
+
+		/**
+		 * Change the size of an item
+		 * @param[in] itemId The item ID
+		 * @param[in] bytes The new size of the item
+		 */
+		void resize(uint32_t itemId, size_t bytes);
+
+		/**
+		 * Get the item to evict next. The item isn't removed
+		 * @param[out] userValue The user value of the item
+		 * @return True if there is an item, false if the list is empty
+		 */
+		bool getVictim(uint64_t& userValue) const;
+
+		/**
+		 * @param[in] itemId The item ID
+		 * @return The size of the item
+		 */
+		inline size_t getItemBytes(uint32_t itemId) const { return m_Nodes[itemId].bytes; }
+
+		/**
+		 * @return The number of items
+		 */
+		inline size_t getNumOfItems() const { return m_NumOfItems; }
+
+		/**
+		 * @return The total size of all items
+		 */
+		inline size_t getTotalBytes() const { return m_TotalBytes; }
+
+		/**
+		 * @return The eviction policy
+		 */
+		inline EvictionPolicy getPolicy() const { return m_Policy; }
+
+		/**
+		 * Change the eviction policy. Existing items are re-ordered, which is O(n)
+		 * @param[in] policy The new eviction policy
+		 */
+		void setPolicy(EvictionPolicy policy);
+
+		/**
+		 * Remove all items. Allocated storage is kept for reuse
+		 */
+		void clear();
+
+	private:
+
+		enum { NumOfBuckets = 64 };
+
+		static const uint32_t NullNode = 0xffffffff;
+
+		struct Node
+		{
+			uint64_t userValue;
+			size_t bytes;
+			uint32_t prev;
+			uint32_t next;
+			// the list the node is in, or NumOfBuckets if it's free
+			uint32_t bucket;
+		};
+
+		std::vector<Node> m_Nodes;
+		uint32_t m_FreeList;
+		uint32_t m_Heads[NumOfBuckets];
+		uint32_t m_Tails[NumOfBuckets];
+		// a bit for each non-empty bucket, for finding the largest one in a constant number of steps
+		uint64_t m_NonEmptyBuckets;
+		size_t m_NumOfItems;
+		size_t m_TotalBytes;
+		EvictionPolicy m_Policy;
+
+		uint32_t getBucket(size_t bytes) const;
+		void linkNode(uint32_t nodeIndex);
+		void unlinkNode(uint32_t nodeIndex);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_MEMORY_BUDGET */
@@ -0,0 +1,318 @@
+#ifndef PCAPPP_METRICS_REGISTRY
+#define PCAPPP_METRICS_REGISTRY
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * The types of metrics, as in the Prometheus/OpenMetrics data model
+	 */
+	enum MetricType
+	{
+		/** A value which only goes up, such as the number of packets received. Counter names end with "_total" */
+		MetricCounter,
+		/** A value which goes up and down, such as the number of open connections */
+		MetricGauge
+	};
+
+
+	/**
+	 * @struct MetricValue
+	 * The value of a single metric in a MetricsSnapshot
+	 */
+	struct MetricValue
+	{
+		/** The metric name, for example "pcpp_device_packets_received_total" */
+		std::string name;
+		/** A description of the metric */
+		std::string help;
+		/** The labels of the value in the Prometheus format without the braces, for example: device="eth0",queue="1". Empty if there
+		 * are no labels */
+		std::string labels;
+		/** The metric type */
+		MetricType type;
+		/** The value */
+		double value;
+	};
+
+
+	/**
+	 * @class MetricsSnapshot
+	 * The values of all metrics of a MetricsRegistry at a certain time (see MetricsRegistry#snapshot())
+	 */
+	class MetricsSnapshot
+	{
+	public:
+
+		/** The time the snapshot was taken */
+		timespec timestamp;
+
+		/** The values, in the order their sources were added to the registry */
+		std::vector<MetricValue> values;
+
+		/**
+		 * Find a value
+		 * @param[in] name The metric name
+		 * @param[in] labels The labels of the value, in the same format as MetricValue#labels. Default value is no labels
+		 * @return The value or NULL if there's no value with this name and labels
+		 */
+		const MetricValue* find(const std::string& name, const std::string& labels = "") const;
+
+		/**
+		 * Format the snapshot in the Prometheus text exposition format (version 0.0.4), which OpenMetrics parsers accept as well: the
+		 * values of each metric are grouped under a # HELP and # TYPE line
+		 * @param[out] output The string to append the text to
+		 */
+		void toPrometheusText(std::string& output) const;
+	};
+
+
+	/**
+	 * @class MetricsWriter
+	 * Passed to MetricsSource#collectMetrics() for reporting the source's values into a snapshot. The labels the source was registered
+	 * with are added to every value
+	 */
+	class MetricsWriter
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] snapshot The snapshot to add the values to
+		 * @param[in] labels The labels to add to every value, in the same format as MetricValue#labels
+		 */
+		MetricsWriter(MetricsSnapshot& snapshot, const std::string& labels) : m_Snapshot(snapshot), m_Labels(labels) {}
+
+		/**
+		 * Report the value of a counter
+		 * @param[in] name The metric name, which should end with "_total"
+		 * @param[in] help A description of the metric
+		 * @param[in] value The value
+		 * @param[in] labels Labels of this value on top of the source's labels, for example: queue="1". Default value is NULL (none)
+		 */
+		inline void addCounter(const char* name, const char* help, uint64_t value, const char* labels = NULL) { add(name, help, MetricCounter, (double)value, labels); }
+
+		/**
+		 * Report the value of a gauge
+		 * @param[in] name The metric name
+		 * @param[in] help A description of the metric
+		 * @param[in] value The value
+		 * @param[in] labels Labels of this value on top of the source's labels. Default value is NULL (none)
+		 */
+		inline void addGauge(const char* name, const char* help, double value, const char* labels = NULL) { add(name, help, MetricGauge, value, labels); }
+
+		/**
+		 * Report a value
+		 * @param[in] name The metric name
+		 * @param[in] help A description of the metric
+		 * @param[in] type The metric type
+		 * @param[in] value The value
+		 * @param[in] labels Labels of this value on top of the source's labels, or NULL for none
+		 */
+		void add(const std::string& name, const std::string& help, MetricType type, double value, const char* labels);
+
+	private:
+		MetricsSnapshot& m_Snapshot;
+		const std::string& m_Labels;
+	};
+
+
+	/**
+	 * @class MetricsSource
+	 * An interface of devices, engines and application components which report metrics to a MetricsRegistry. Sources keep their values
+	 * in their own counters, which they update as they process packets, and report them only when the registry takes a snapshot, so
+	 * being a source adds nothing to the packet path.
+	 * collectMetrics() is called from the thread taking the snapshot (for example MetricsHttpExporter's thread), while the source may be
+	 * processing packets in another thread. Sources only read scalar counters there, which may be slightly behind, and don't touch their
+	 * other state
+	 */
+	class MetricsSource
+	{
+	public:
+		virtual ~MetricsSource() {}
+
+		/**
+		 * Report the current values of the source's metrics
+		 * @param[in] writer The writer to report the values to
+		 */
+		virtual void collectMetrics(MetricsWriter& writer) = 0;
+	};
+
+
+	/**
+	 * @class MetricsRegistry
+	 * A registry of metrics sources which can take a snapshot of all their values, for example:
+	 *
+	 *     MetricsRegistry registry;
+	 *     registry.addSource(liveDevice, MetricsRegistry::createLabel("device", liveDevice->getName()));
+	 *     registry.addSource(&tcpReassembly, MetricsRegistry::createLabel("engine", "tcp"));
+	 *     registry.addSource(&workerCounters);   // StatsCounters updated by the worker threads
+	 *     MetricsHttpExporter exporter(registry);
+	 *     exporter.start(9100);
+	 *
+	 * All PcapPlusPlus devices, TcpReassembly, IPReassembly and StatsCounters are sources. Sources can be added and removed while
+	 * snapshots are taken, from any thread
+	 */
+	class MetricsRegistry
+	{
+	public:
+
+		/**
+		 * A c'tor for this class which creates an empty registry
+		 */
+		MetricsRegistry();
+
+		/**
+		 * A d'tor for this class. The sources aren't freed
+		 */
+		~MetricsRegistry();
+
+		/**
+		 * Add a source
+		 * @param[in] source The source. It isn't freed by the registry and must be removed before it's destroyed
+		 * @param[in] labels Labels to add to all values of the source, in the same format as MetricValue#labels (see createLabel()).
+		 * Default value is no labels
+		 * @return False if the source is NULL or was added already, true otherwise
+		 */
+		bool addSource(MetricsSource* source, const std::string& labels = "");
+
+		/**
+		 * Remove a source
+		 * @param[in] source The source to remove
+		 * @return False if the source wasn't added, true otherwise
+		 */
+		bool removeSource(MetricsSource* source);
+
+		/**
+		 * @return The number of sources
+		 */
+		size_t getNumOfSources() const;
+
+		/**
+		 * Collect the current values of all sources
+		 * @param[out] result The snapshot to fill. Its previous values are removed
+		 */
+		void snapshot(MetricsSnapshot& result);
+
+		/**
+		 * Take a snapshot and format it in the Prometheus text exposition format (see MetricsSnapshot#toPrometheusText())
+		 * @return The snapshot as text
+		 */
+		std::string toPrometheusText();
+
+		/**
+		 * Create a label in the Prometheus format, escaping the value as needed. Several labels are separated by a comma
+		 * @param[in] name The label name, for example "device"
+		 * @param[in] value The label value, for example "eth0"
+		 * @return The label, for example: device="eth0"
+		 */
+		static std::string createLabel(const std::string& name, const std::string& value);
+
+		/**
+		 * Convert a string to a valid metric name by replacing all characters other than letters, digits, underscores and colons with
+		 * underscores (and a leading digit too)
+		 * @param[in] name The string to convert
+		 * @return The metric name
+		 */
+		static std::string sanitizeName(const std::string& name);
+
+	private:
+		struct SourceEntry
+		{
+			MetricsSource* source;
+			std::string labels;
+		};
+
+		std::vector<SourceEntry> m_Sources;
+		mutable pthread_mutex_t m_Mutex;
+
+		// disable copy c'tor and assignment operator
+		MetricsRegistry(const MetricsRegistry& other);
+		MetricsRegistry& operator=(const MetricsRegistry& other);
+	};
+
+
+	/**
+	 * @class MetricsHttpExporter
+	 * A minimal HTTP server running on a background thread which serves a snapshot of a MetricsRegistry in the Prometheus text format
+	 * to every GET request of the /metrics path, so the registry can be scraped by Prometheus or any OpenMetrics compatible collector.
+	 * Requests are handled one at a time, and each request takes its own snapshot, so the packet processing threads are never involved
+	 */
+	class MetricsHttpExporter
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] registry The registry to export. It must outlive the exporter
+		 */
+		MetricsHttpExporter(MetricsRegistry& registry);
+
+		/**
+		 * A d'tor for this class. Stops the server if it's running
+		 */
+		~MetricsHttpExporter();
+
+		/**
+		 * Start listening and serving requests on a background thread
+		 * @param[in] port The TCP port to listen on. If it's 0 a free port is chosen (see getPort())
+		 * @param[in] bindAddress The IPv4 address to listen on. Default value is "0.0.0.0" (all interfaces)
+		 * @return True if the server started or is running already, false if the socket couldn't be opened or the thread couldn't be
+		 * created
+		 */
+		bool start(uint16_t port, const std::string& bindAddress = "0.0.0.0");
+
+		/**
+		 * Stop the server and wait for its thread to exit. Does nothing if the server isn't running
+		 */
+		void stop();
+
+		/**
+		 * @return True if the server is running
+		 */
+		inline bool isRunning() const { return m_Running; }
+
+		/**
+		 * @return The port the server listens on, or 0 if it isn't running
+		 */
+		inline uint16_t getPort() const { return m_Port; }
+
+		/**
+		 * @return The number of requests served so far
+		 */
+		inline uint64_t getNumOfRequests() const { return m_NumOfRequests; }
+
+	private:
+		MetricsRegistry& m_Registry;
+		int m_ListenSocket;
+		uint16_t m_Port;
+		bool m_Running;
+		volatile bool m_StopRequested;
+		volatile uint64_t m_NumOfRequests;
+		pthread_t m_Thread;
+		// reused by all requests so its vector isn't reallocated every time
+		MetricsSnapshot m_Snapshot;
+
+		static void* exporterThreadMain(void* exporterPtr);
+		void handleConnection(int connSocket);
+
+		// disable copy c'tor and assignment operator
+		MetricsHttpExporter(const MetricsHttpExporter& other);
+		MetricsHttpExporter& operator=(const MetricsHttpExporter& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_METRICS_REGISTRY */
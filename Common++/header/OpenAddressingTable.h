@@ -0,0 +1,232 @@
+#ifndef PCAPPP_OPEN_ADDRESSING_TABLE
+#define PCAPPP_OPEN_ADDRESSING_TABLE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class OpenAddressingTable
+	 * A template class that implements an open addressing hash table with linear probing, for indexing items whose storage is managed
+	 * by the owner of the table (in a node array, an entry pool, or in the slots themselves). Each slot holds the 32-bit hash of its
+	 * item and whatever the owner needs to reach the item, so probing compares hashes without touching the items. The number of slots is
+	 * a power of 2 and at least twice the number of items, so probe sequences stay short, and erasing an item moves the following slots
+	 * of its probe sequence back (backward shift deletion) so no tombstones are needed.
+	 * Slot must be copyable, have a uint32_t member named hash and a bool isEmpty() const method, and a default constructed Slot must be
+	 * empty. Hashes must be well mixed since their low bits select the home slot. Items with the same hash are told apart by a match
+	 * functor taking a const Slot& and returning true for the slot of the item looked for; lookups without a functor treat the hash as
+	 * the key
+	 */
+	template<typename Slot>
+	class OpenAddressingTable
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. No memory is allocated until the first item is inserted or reserve() is called
+		 */
+		OpenAddressingTable() : m_Mask(0), m_Size(0) {}
+
+		/**
+		 * Find the slot of an item whose hash is its key
+		 * @param[in] hash The hash of the item
+		 * @return The slot of the item or NULL if it isn't in the table
+		 */
+		Slot* find(uint32_t hash) { return find(hash, MatchHash()); }
+
+		/**
+		 * Find the slot of an item whose hash is its key
+		 * @param[in] hash The hash of the item
+		 * @return The slot of the item or NULL if it isn't in the table
+		 */
+		const Slot* find(uint32_t hash) const { return find(hash, MatchHash()); }
+
+		/**
+		 * Find the slot of an item
+		 * @param[in] hash The hash of the item
+		 * @param[in] match A functor returning true for the slot of the item. It's called only for slots with the same hash
+		 * @return The slot of the item or NULL if it isn't in the table
+		 */
+		template<typename Match>
+		Slot* find(uint32_t hash, const Match& match)
+		{
+			if (m_Size == 0)
+				return NULL;
+
+			Slot& slot = m_Slots[findSlot(hash, match)];
+			return (slot.isEmpty() ? NULL : &slot);
+		}
+
+		/**
+		 * Find the slot of an item
+		 * @param[in] hash The hash of the item
+		 * @param[in] match A functor returning true for the slot of the item. It's called only for slots with the same hash
+		 * @return The slot of the item or NULL if it isn't in the table
+		 */
+		template<typename Match>
+		const Slot* find(uint32_t hash, const Match& match) const
+		{
+			if (m_Size == 0)
+				return NULL;
+
+			const Slot& slot = m_Slots[findSlot(hash, match)];
+			return (slot.isEmpty() ? NULL : &slot);
+		}
+
+		/**
+		 * Insert an item whose hash is its key. See insert(uint32_t, const Match&)
+		 * @param[in] hash The hash of the item
+		 * @return The slot of the item
+		 */
+		Slot& insert(uint32_t hash) { return insert(hash, MatchHash()); }
+
+		/**
+		 * Insert an item, growing the table if needed. If the item is already in the table its slot is returned as is. Otherwise an
+		 * empty slot with the hash set is returned and counted as used, and the caller must fill it so it's no longer empty
+		 * @param[in] hash The hash of the item
+		 * @param[in] match A functor returning true for the slot of the item. It's called only for slots with the same hash
+		 * @return The slot of the item
+		 */
+		template<typename Match>
+		Slot& insert(uint32_t hash, const Match& match)
+		{
+			reserve(m_Size + 1);
+
+			Slot& slot = m_Slots[findSlot(hash, match)];
+			if (slot.isEmpty())
+			{
+				slot.hash = hash;
+				m_Size++;
+			}
+
+			return slot;
+		}
+
+		/**
+		 * Erase an item from the table. Pointers to other slots may no longer point to the same items afterwards
+		 * @param[in] slot The slot of the item, as returned by find() or insert()
+		 */
+		void erase(Slot* slot)
+		{
+			size_t cur = slot - &m_Slots[0];
+			size_t next = cur;
+			while (true)
+			{
+				next = (next + 1) & m_Mask;
+				if (m_Slots[next].isEmpty())
+					break;
+
+				// a slot can move back to the freed slot only if that doesn't put it before its home slot
+				size_t home = m_Slots[next].hash & m_Mask;
+				bool homeInRange = (cur <= next ? (home > cur && home <= next) : (home > cur || home <= next));
+				if (!homeInRange)
+				{
+					m_Slots[cur] = m_Slots[next];
+					cur = next;
+				}
+			}
+
+			m_Slots[cur] = Slot();
+			m_Size--;
+		}
+
+		/**
+		 * Remove all items from the table. Allocated slots are kept for reuse
+		 */
+		void clear()
+		{
+			m_Slots.assign(m_Slots.size(), Slot());
+			m_Size = 0;
+		}
+
+		/**
+		 * Grow the table so it can hold a number of items without growing again. The table never shrinks
+		 * @param[in] numOfItems The number of items
+		 */
+		void reserve(size_t numOfItems)
+		{
+			if (numOfItems * 2 <= m_Slots.size())
+				return;
+
+			size_t newSize = MinNumOfSlots;
+			while (newSize < numOfItems * 2)
+				newSize *= 2;
+
+			std::vector<Slot> oldSlots(newSize);
+			oldSlots.swap(m_Slots);
+			m_Mask = newSize - 1;
+
+			for (size_t i = 0; i < oldSlots.size(); i++)
+			{
+				if (oldSlots[i].isEmpty())
+					continue;
+
+				size_t slot = oldSlots[i].hash & m_Mask;
+				while (!m_Slots[slot].isEmpty())
+					slot = (slot + 1) & m_Mask;
+				m_Slots[slot] = oldSlots[i];
+			}
+		}
+
+		/**
+		 * @return The number of items in the table
+		 */
+		inline size_t getSize() const { return m_Size; }
+
+		/**
+		 * @return The number of slots in the table, for iterating them with getSlot()
+		 */
+		inline size_t getNumOfSlots() const { return m_Slots.size(); }
+
+		/**
+		 * @param[in] index A slot index between 0 and getNumOfSlots() - 1
+		 * @return The slot at this index, which may be empty
+		 */
+		inline Slot& getSlot(size_t index) { return m_Slots[index]; }
+
+		/**
+		 * @param[in] index A slot index between 0 and getNumOfSlots() - 1
+		 * @return The slot at this index, which may be empty
+		 */
+		inline const Slot& getSlot(size_t index) const { return m_Slots[index]; }
+
+	private:
+
+		static const size_t MinNumOfSlots = 16;
+
+		struct MatchHash
+		{
+			bool operator()(const Slot&) const { return true; }
+		};
+
+		std::vector<Slot> m_Slots;
+		size_t m_Mask;
+		size_t m_Size;
+
+		// return the slot of the item or the empty slot where it should be inserted
+		template<typename Match>
+		size_t findSlot(uint32_t hash, const Match& match) const
+		{
+			size_t slot = hash & m_Mask;
+			while (!m_Slots[slot].isEmpty() && !(m_Slots[slot].hash == hash && match(m_Slots[slot])))
+				slot = (slot + 1) & m_Mask;
+
+			return slot;
+		}
+	};
+
+	template<typename Slot>
+	const size_t OpenAddressingTable<Slot>::MinNumOfSlots;
+
+} // namespace pcpp
+
+#endif /* PCAPPP_OPEN_ADDRESSING_TABLE */
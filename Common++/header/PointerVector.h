@@ -63,6 +63,29 @@ namespace pcpp
 			}
 		}
 
+#if __cplusplus > 199711L || _MSC_VER >= 1800
+		/**
+		 * Move constructor. The elements of the other vector are moved to the new vector without being copied, and the other vector is
+		 * left empty
+		 */
+		PointerVector(PointerVector&& other) { m_Vector.swap(other.m_Vector); }
+
+		/**
+		 * Move assignment operator. The elements of this vector are freed, then the elements of the other vector are moved to this vector
+		 * without being copied, and the other vector is left empty
+		 */
+		PointerVector& operator=(PointerVector&& other)
+		{
+			if (this != &other)
+			{
+				clear();
+				m_Vector.swap(other.m_Vector);
+			}
+
+			return *this;
+		}
+#endif
+
 		/**
 		 * Clears all elements of the vector while freeing them
 		 */
@@ -145,6 +168,53 @@ namespace pcpp
 			return result;
 		}
 
+		/**
+		 * Remove all elements from the vector without freeing them. The elements are appended to the given std::vector and it becomes the
+		 * user's responsibility to free them (for example by adopting them into another PointerVector)
+		 * @param[out] elements The std::vector to append the elements to
+		 */
+		inline void release(std::vector<T*>& elements)
+		{
+			if (elements.empty())
+				elements.swap(m_Vector);
+			else
+				elements.insert(elements.end(), m_Vector.begin(), m_Vector.end());
+
+			m_Vector.clear();
+		}
+
+		/**
+		 * Take ownership of elements that aren't managed by any vector. The elements are appended to this vector and will be freed by it.
+		 * The given std::vector is cleared
+		 * @param[in] elements The elements to adopt
+		 */
+		inline void adopt(std::vector<T*>& elements)
+		{
+			if (m_Vector.empty())
+				m_Vector.swap(elements);
+			else
+				m_Vector.insert(m_Vector.end(), elements.begin(), elements.end());
+
+			elements.clear();
+		}
+
+		/**
+		 * Take ownership of all elements of another vector. The elements are appended to this vector without being copied and the other
+		 * vector is left empty
+		 * @param[in] other The vector to take the elements from
+		 */
+		inline void adopt(PointerVector& other)
+		{
+			if (&other != this)
+				adopt(other.m_Vector);
+		}
+
+		/**
+		 * Exchange the elements of this vector with the elements of another vector. No element is copied or freed
+		 * @param[in] other The vector to swap with
+		 */
+		inline void swap(PointerVector& other) { m_Vector.swap(other.m_Vector); }
+
 		/**
 		 * Return a pointer to the element in a certain index
 		 * @param[in] index The index to retrieve the element from
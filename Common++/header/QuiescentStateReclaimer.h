@@ -0,0 +1,196 @@
+#ifndef PCAPPP_QUIESCENT_STATE_RECLAIMER
+#define PCAPPP_QUIESCENT_STATE_RECLAIMER
+
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include "AtomicUtils.h"
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/** The maximum number of threads which can be registered as readers of a QuiescentStateReclaimer at the same time */
+#define PCPP_QUIESCENT_STATE_MAX_READERS 64
+
+	/**
+	 * @struct QuiescentStateDeleter
+	 * A functor for QuiescentStateReclaimer#reclaim() and QuiescentStateReclaimer#reclaimAll() which deletes retired pointers
+	 */
+	struct QuiescentStateDeleter
+	{
+		template<typename T>
+		void operator()(T* item) const { delete item; }
+	};
+
+
+	/**
+	 * @class QuiescentStateReclaimer
+	 * Quiescent-state based reclamation of objects which lock-free readers may still be using after a writer unlinked them, for example
+	 * a rule set which was replaced or a table entry which was removed. Readers register with registerReader() and call quiescentState()
+	 * regularly at a point where they don't hold a reference to any such object, for example between bursts of packets. The writer unlinks
+	 * an object so it can't be reached anymore, hands it over with retire() and publishes the unlinking with advanceEpoch(). The object
+	 * is reclaimed by reclaim() once every registered reader passed a quiescent state since, so it can't be in use anymore.<BR>
+	 * Readers call only quiescentState(), which is an atomic load and store and never blocks. All other methods must be serialized by the
+	 * owner of the objects, usually under the lock its writers already take.<BR>
+	 * What reclaiming an item means (deleting it, returning it to a free list, ...) is up to the owner, which passes a functor to reclaim()
+	 * @tparam T The type of the retired items, usually a pointer to the unlinked object or a small struct describing it
+	 */
+	template<typename T>
+	class QuiescentStateReclaimer
+	{
+	public:
+		/**
+		 * A c'tor for this class, with no registered readers and no retired items
+		 */
+		QuiescentStateReclaimer() : m_Epoch(1)
+		{
+			memset(m_Readers, 0, sizeof(m_Readers));
+		}
+
+		/**
+		 * Register a reader. Items retired after a reader registered aren't reclaimed until it calls quiescentState() or
+		 * unregisterReader()
+		 * @return A reader ID to pass to quiescentState() and unregisterReader(), or -1 if #PCPP_QUIESCENT_STATE_MAX_READERS readers are
+		 * already registered
+		 */
+		int registerReader()
+		{
+			for (int i = 0; i < PCPP_QUIESCENT_STATE_MAX_READERS; i++)
+			{
+				if (m_Readers[i].active == 0)
+				{
+					m_Readers[i].epoch = m_Epoch;
+					atomicStoreRelease(&m_Readers[i].active, 1);
+					return i;
+				}
+			}
+
+			return -1;
+		}
+
+		/**
+		 * Unregister a reader. The reader must not access the objects after this method is called unless it registers again
+		 * @param[in] readerId The reader ID registerReader() returned. Invalid IDs are ignored
+		 */
+		void unregisterReader(int readerId)
+		{
+			if (readerId < 0 || readerId >= PCPP_QUIESCENT_STATE_MAX_READERS)
+				return;
+
+			atomicStoreRelease(&m_Readers[readerId].active, 0);
+		}
+
+		/**
+		 * Announce a reader doesn't hold a reference to any object which may be retired. Called by the reader itself, concurrently with
+		 * the writer
+		 * @param[in] readerId The reader ID registerReader() returned
+		 */
+		void quiescentState(int readerId)
+		{
+			atomicStoreRelease(&m_Readers[readerId].epoch, atomicLoadAcquire(&m_Epoch));
+		}
+
+		/**
+		 * Hand over an item which readers can't reach anymore. It's reclaimed once all readers passed a quiescent state after the next
+		 * call to advanceEpoch(), so several items unlinked together can be retired with one advanceEpoch() call
+		 * @param[in] item The retired item
+		 */
+		void retire(const T& item)
+		{
+			RetiredItem retired;
+			retired.item = item;
+			retired.epoch = m_Epoch + 1;
+			m_Retired.push_back(retired);
+		}
+
+		/**
+		 * Publish the unlinking of the items retired since the previous call: readers which see the new epoch in quiescentState() can't
+		 * reach them anymore
+		 */
+		void advanceEpoch()
+		{
+			atomicStoreRelease(&m_Epoch, m_Epoch + 1);
+		}
+
+		/**
+		 * Reclaim the retired items all registered readers are done with
+		 * @param[in] reclaimItem A functor called with each item which can be reclaimed, for example QuiescentStateDeleter
+		 * @return The number of retired items which are still waiting for readers to pass a quiescent state
+		 */
+		template<typename Reclaim>
+		size_t reclaim(Reclaim reclaimItem)
+		{
+			if (m_Retired.empty())
+				return 0;
+
+			// an item retired at epoch E may still be used by readers whose last quiescent state was before E
+			size_t minEpoch = (size_t)-1;
+			for (int i = 0; i < PCPP_QUIESCENT_STATE_MAX_READERS; i++)
+			{
+				if (atomicLoadAcquire(&m_Readers[i].active) == 0)
+					continue;
+
+				size_t readerEpoch = atomicLoadAcquire(&m_Readers[i].epoch);
+				if (readerEpoch < minEpoch)
+					minEpoch = readerEpoch;
+			}
+
+			size_t numOfRemaining = 0;
+			for (size_t i = 0; i < m_Retired.size(); i++)
+			{
+				if (m_Retired[i].epoch <= minEpoch)
+					reclaimItem(m_Retired[i].item);
+				else
+					m_Retired[numOfRemaining++] = m_Retired[i];
+			}
+
+			m_Retired.resize(numOfRemaining);
+			return numOfRemaining;
+		}
+
+		/**
+		 * Reclaim all retired items regardless of the readers, for example when the owner is destroyed and no reader accesses the
+		 * objects anymore
+		 * @param[in] reclaimItem A functor called with each retired item
+		 */
+		template<typename Reclaim>
+		void reclaimAll(Reclaim reclaimItem)
+		{
+			for (size_t i = 0; i < m_Retired.size(); i++)
+				reclaimItem(m_Retired[i].item);
+
+			m_Retired.clear();
+		}
+
+	private:
+		struct ReaderSlot
+		{
+			volatile size_t epoch;
+			volatile size_t active;
+			char padding[64 - 2*sizeof(size_t)];
+		};
+
+		struct RetiredItem
+		{
+			T item;
+			size_t epoch;
+		};
+
+		volatile size_t m_Epoch;
+		ReaderSlot m_Readers[PCPP_QUIESCENT_STATE_MAX_READERS];
+		std::vector<RetiredItem> m_Retired;
+
+		// disable copy c'tor and assignment operator
+		QuiescentStateReclaimer(const QuiescentStateReclaimer& other);
+		QuiescentStateReclaimer& operator=(const QuiescentStateReclaimer& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_QUIESCENT_STATE_RECLAIMER */
@@ -0,0 +1,263 @@
+#ifndef PCAPPP_SPSC_QUEUE
+#define PCAPPP_SPSC_QUEUE
+
+#include <stddef.h>
+#include "AtomicUtils.h"
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class SPSCQueue
+	 * A bounded lock-free queue for passing elements from a single producer thread to a single consumer thread. The elements are kept in
+	 * a ring allocated in the c'tor, so pushing and popping never allocate memory and cost an acquire load and a release store of an index.
+	 * The producer and consumer indices are kept on separate cache lines, and each side caches the other side's index so it's read only
+	 * when the ring looks full (or empty).
+	 * Besides push() and pop(), elements can be written and read in place: the producer gets the next free element with reserve(), fills it
+	 * and makes it visible with publish(), and the consumer reads the oldest element with front() and releases it with pop(). Elements are
+	 * never destroyed before the queue is, so an element may own buffers which are reused each time it's written. Bursts of elements can be
+	 * passed with pushBulk() and popBulk(), which touch the shared indices once per burst.
+	 * Only one thread may call the producer methods (push(), pushBulk(), reserve(), publish()) and only one thread the consumer methods
+	 * (pop(), popBulk(), front())
+	 */
+	template<typename T>
+	class SPSCQueue
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] capacity The maximum number of elements in the queue. It's rounded up to a power of 2
+		 */
+		SPSCQueue(size_t capacity)
+		{
+			m_Capacity = 1;
+			while (m_Capacity < capacity)
+				m_Capacity <<= 1;
+			m_Mask = m_Capacity - 1;
+			m_Elements = new T[m_Capacity];
+			m_Tail = 0;
+			m_CachedHead = 0;
+			m_Head = 0;
+			m_CachedTail = 0;
+		}
+
+		/**
+		 * A d'tor for this class. Destroys all elements, including the ones which weren't popped
+		 */
+		~SPSCQueue()
+		{
+			delete [] m_Elements;
+		}
+
+		/**
+		 * Get the next free element for writing it in place. Should be called only by the producer. The element isn't visible to the
+		 * consumer until publish() is called, and calling reserve() again before that returns the same element
+		 * @return A pointer to the element, or NULL if the queue is full
+		 */
+		inline T* reserve()
+		{
+			size_t tail = m_Tail;
+			if (tail - m_CachedHead >= m_Capacity)
+			{
+				m_CachedHead = atomicLoadAcquire(&m_Head);
+				if (tail - m_CachedHead >= m_Capacity)
+					return NULL;
+			}
+
+			return &m_Elements[tail & m_Mask];
+		}
+
+		/**
+		 * Make the element returned by reserve() visible to the consumer. Should be called only by the producer, after a successful reserve()
+		 */
+		inline void publish() { atomicStoreRelease(&m_Tail, m_Tail + 1); }
+
+		/**
+		 * Copy an element into the queue. Should be called only by the producer
+		 * @param[in] element The element to copy
+		 * @return True if the element was pushed, false if the queue is full
+		 */
+		inline bool push(const T& element)
+		{
+			T* slot = reserve();
+			if (slot == NULL)
+				return false;
+
+			*slot = element;
+			publish();
+			return true;
+		}
+
+		/**
+		 * Copy several elements into the queue at once. The elements are made visible to the consumer together, with a single release store,
+		 * so pushing a burst costs about as much as pushing one element. Should be called only by the producer
+		 * @param[in] elements The elements to copy
+		 * @param[in] count The number of elements
+		 * @return The number of elements pushed, which is less than count if the queue doesn't have room for all of them. The elements
+		 * pushed are always the first ones
+		 */
+		inline size_t pushBulk(const T* elements, size_t count)
+		{
+			size_t tail = m_Tail;
+			if (m_Capacity - (tail - m_CachedHead) < count)
+				m_CachedHead = atomicLoadAcquire(&m_Head);
+
+			size_t freeSpace = m_Capacity - (tail - m_CachedHead);
+			if (count > freeSpace)
+				count = freeSpace;
+
+			for (size_t i = 0; i < count; i++)
+				m_Elements[(tail + i) & m_Mask] = elements[i];
+
+			if (count > 0)
+				atomicStoreRelease(&m_Tail, tail + count);
+			return count;
+		}
+
+		/**
+		 * Get the oldest element in the queue for reading it in place. Should be called only by the consumer. The element stays in the queue
+		 * until pop() is called
+		 * @return A pointer to the element, or NULL if the queue is empty
+		 */
+		inline T* front()
+		{
+			size_t head = m_Head;
+			if (head == m_CachedTail)
+			{
+				m_CachedTail = atomicLoadAcquire(&m_Tail);
+				if (head == m_CachedTail)
+					return NULL;
+			}
+
+			return &m_Elements[head & m_Mask];
+		}
+
+		/**
+		 * Remove the oldest element from the queue. Should be called only by the consumer, after a successful front()
+		 */
+		inline void pop() { atomicStoreRelease(&m_Head, m_Head + 1); }
+
+		/**
+		 * Copy the oldest element out of the queue and remove it. Should be called only by the consumer
+		 * @param[out] element The element to copy to
+		 * @return True if an element was popped, false if the queue is empty
+		 */
+		inline bool pop(T& element)
+		{
+			T* slot = front();
+			if (slot == NULL)
+				return false;
+
+			element = *slot;
+			pop();
+			return true;
+		}
+
+		/**
+		 * Copy up to maxCount of the oldest elements out of the queue and remove them, with a single release store. Should be called only
+		 * by the consumer
+		 * @param[out] elements An array of at least maxCount elements to copy to
+		 * @param[in] maxCount The maximum number of elements to pop
+		 * @return The number of elements popped, 0 if the queue is empty
+		 */
+		inline size_t popBulk(T* elements, size_t maxCount)
+		{
+			size_t head = m_Head;
+			if (m_CachedTail - head < maxCount)
+				m_CachedTail = atomicLoadAcquire(&m_Tail);
+
+			size_t count = m_CachedTail - head;
+			if (count > maxCount)
+				count = maxCount;
+
+			for (size_t i = 0; i < count; i++)
+				elements[i] = m_Elements[(head + i) & m_Mask];
+
+			if (count > 0)
+				atomicStoreRelease(&m_Head, head + count);
+			return count;
+		}
+
+		/**
+		 * Get up to maxCount of the oldest elements in the queue for reading them in place. Should be called only by the consumer. The
+		 * elements stay in the queue until popBulk(size_t) is called
+		 * @param[out] elements An array of at least maxCount pointers the element pointers are written to, oldest first
+		 * @param[in] maxCount The maximum number of elements to get
+		 * @return The number of elements, 0 if the queue is empty
+		 */
+		inline size_t frontBulk(T** elements, size_t maxCount)
+		{
+			size_t head = m_Head;
+			if (m_CachedTail - head < maxCount)
+				m_CachedTail = atomicLoadAcquire(&m_Tail);
+
+			size_t count = m_CachedTail - head;
+			if (count > maxCount)
+				count = maxCount;
+
+			for (size_t i = 0; i < count; i++)
+				elements[i] = &m_Elements[(head + i) & m_Mask];
+
+			return count;
+		}
+
+		/**
+		 * Remove the oldest count elements from the queue with a single release store. Should be called only by the consumer, after
+		 * frontBulk() returned at least count elements
+		 * @param[in] count The number of elements to remove
+		 */
+		inline void popBulk(size_t count) { atomicStoreRelease(&m_Head, m_Head + count); }
+
+		/**
+		 * @return The number of elements in the queue. When called while the other side works on the queue the value may already be outdated
+		 */
+		inline size_t size() const
+		{
+			size_t head = atomicLoadAcquire(&m_Head);
+			return atomicLoadAcquire(&m_Tail) - head;
+		}
+
+		/**
+		 * @return True if the queue is empty. When called while the other side works on the queue the value may already be outdated
+		 */
+		inline bool empty() const { return size() == 0; }
+
+		/**
+		 * @return The maximum number of elements in the queue
+		 */
+		inline size_t getCapacity() const { return m_Capacity; }
+
+	private:
+
+		enum { CacheLineSize = 64 };
+
+		T* m_Elements;
+		size_t m_Capacity;
+		size_t m_Mask;
+
+		// the producer's index and its copy of the consumer's index
+		char m_ProducerPad[CacheLineSize];
+		volatile size_t m_Tail;
+		size_t m_CachedHead;
+
+		// the consumer's index and its copy of the producer's index
+		char m_ConsumerPad[CacheLineSize - 2 * sizeof(size_t)];
+		volatile size_t m_Head;
+		size_t m_CachedTail;
+		char m_EndPad[CacheLineSize - 2 * sizeof(size_t)];
+
+		// disable copy c'tor and assignment operator
+		SPSCQueue(const SPSCQueue& other);
+		SPSCQueue& operator=(const SPSCQueue& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_SPSC_QUEUE */
@@ -0,0 +1,222 @@
+#ifndef PCAPPP_STATE_CHECKPOINT
+#define PCAPPP_STATE_CHECKPOINT
+
+#include "IpAddress.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <string>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class CheckpointWriter
+	 * Appends values to a binary checkpoint of the state of a component, for example the connections of TcpReassembly or the packets
+	 * IPReassembly is reassembling, so the state can be restored by another instance, possibly in another process after a restart.
+	 * Integers are written in little endian byte order regardless of the host, and IP addresses take only the bytes of their version,
+	 * so checkpoints are compact and can be moved between hosts
+	 */
+	class CheckpointWriter
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] buffer The buffer the values are appended to. It's not cleared, so several components can be written into one buffer
+		 */
+		CheckpointWriter(std::vector<uint8_t>& buffer) : m_Buffer(buffer) {}
+
+		/**
+		 * Write an unsigned 8-bit integer
+		 * @param[in] value The value
+		 */
+		inline void writeUInt8(uint8_t value) { m_Buffer.push_back(value); }
+
+		/**
+		 * Write an unsigned 16-bit integer
+		 * @param[in] value The value
+		 */
+		inline void writeUInt16(uint16_t value) { writeLittleEndian(value, 2); }
+
+		/**
+		 * Write an unsigned 32-bit integer
+		 * @param[in] value The value
+		 */
+		inline void writeUInt32(uint32_t value) { writeLittleEndian(value, 4); }
+
+		/**
+		 * Write an unsigned 64-bit integer
+		 * @param[in] value The value
+		 */
+		inline void writeUInt64(uint64_t value) { writeLittleEndian(value, 8); }
+
+		/**
+		 * Write an array of bytes as is
+		 * @param[in] data The bytes
+		 * @param[in] dataLen The number of bytes
+		 */
+		inline void writeBytes(const uint8_t* data, size_t dataLen) { m_Buffer.insert(m_Buffer.end(), data, data + dataLen); }
+
+		/**
+		 * Write an IP address: its version followed by its 4 or 16 bytes. An invalid address is written as version 0 without bytes
+		 * @param[in] addr The address
+		 */
+		void writeIPAddress(const IPAddressValue& addr);
+
+		/**
+		 * Reserve room for more values, so writing a large state doesn't reallocate the buffer many times
+		 * @param[in] numOfBytes The number of bytes about to be written
+		 */
+		inline void reserve(size_t numOfBytes) { m_Buffer.reserve(m_Buffer.size() + numOfBytes); }
+
+		/**
+		 * @return The number of bytes in the buffer
+		 */
+		inline size_t getSize() const { return m_Buffer.size(); }
+
+	private:
+		std::vector<uint8_t>& m_Buffer;
+
+		inline void writeLittleEndian(uint64_t value, size_t numOfBytes)
+		{
+			for (size_t i = 0; i < numOfBytes; i++)
+				m_Buffer.push_back((uint8_t)(value >> (8 * i)));
+		}
+	};
+
+
+	/**
+	 * @class CheckpointReader
+	 * Reads the values of a checkpoint written by CheckpointWriter. Reading past the end of the data or an invalid value sets a failure flag
+	 * which stays set, and values read after it are 0, so a whole structure can be read before checking isValid() once
+	 */
+	class CheckpointReader
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] data The checkpoint data. It must stay valid while the reader is used
+		 * @param[in] dataLen The length of the data
+		 */
+		CheckpointReader(const uint8_t* data, size_t dataLen) : m_Data(data), m_DataLen(dataLen), m_Offset(0), m_Failed(false) {}
+
+		/**
+		 * @return The next value as an unsigned 8-bit integer, or 0 if there aren't enough bytes left
+		 */
+		inline uint8_t readUInt8() { return (uint8_t)readLittleEndian(1); }
+
+		/**
+		 * @return The next value as an unsigned 16-bit integer, or 0 if there aren't enough bytes left
+		 */
+		inline uint16_t readUInt16() { return (uint16_t)readLittleEndian(2); }
+
+		/**
+		 * @return The next value as an unsigned 32-bit integer, or 0 if there aren't enough bytes left
+		 */
+		inline uint32_t readUInt32() { return (uint32_t)readLittleEndian(4); }
+
+		/**
+		 * @return The next value as an unsigned 64-bit integer, or 0 if there aren't enough bytes left
+		 */
+		inline uint64_t readUInt64() { return readLittleEndian(8); }
+
+		/**
+		 * Read an array of bytes without copying them
+		 * @param[in] dataLen The number of bytes
+		 * @return A pointer to the bytes in the checkpoint data, or NULL if there aren't enough bytes left
+		 */
+		inline const uint8_t* readBytes(size_t dataLen)
+		{
+			if (!checkRemaining(dataLen))
+				return NULL;
+
+			const uint8_t* result = m_Data + m_Offset;
+			m_Offset += dataLen;
+			return result;
+		}
+
+		/**
+		 * Read an IP address written by CheckpointWriter#writeIPAddress()
+		 * @return The address. It's invalid if an invalid address was written or the reader failed
+		 */
+		IPAddressValue readIPAddress();
+
+		/**
+		 * Set the failure flag, for example when a value read is out of its valid range
+		 */
+		inline void setFailed() { m_Failed = true; }
+
+		/**
+		 * @return True if all values were read successfully so far
+		 */
+		inline bool isValid() const { return !m_Failed; }
+
+		/**
+		 * @return The number of bytes which weren't read yet
+		 */
+		inline size_t getRemainingBytes() const { return m_DataLen - m_Offset; }
+
+		/**
+		 * @return The number of bytes read so far
+		 */
+		inline size_t getOffset() const { return m_Offset; }
+
+	private:
+		const uint8_t* m_Data;
+		size_t m_DataLen;
+		size_t m_Offset;
+		bool m_Failed;
+
+		inline bool checkRemaining(size_t numOfBytes)
+		{
+			if (m_Failed || numOfBytes > m_DataLen - m_Offset)
+			{
+				m_Failed = true;
+				return false;
+			}
+
+			return true;
+		}
+
+		inline uint64_t readLittleEndian(size_t numOfBytes)
+		{
+			if (!checkRemaining(numOfBytes))
+				return 0;
+
+			uint64_t value = 0;
+			for (size_t i = 0; i < numOfBytes; i++)
+				value |= (uint64_t)m_Data[m_Offset + i] << (8 * i);
+			m_Offset += numOfBytes;
+			return value;
+		}
+	};
+
+
+	/**
+	 * Write a checkpoint to a file, replacing it if it exists. The data is written to a temporary file next to it which is then renamed,
+	 * so a crash while writing leaves the previous checkpoint in place
+	 * @param[in] fileName The file name
+	 * @param[in] data The checkpoint data
+	 * @return True if the file was written, false otherwise
+	 */
+	bool writeCheckpointFile(const std::string& fileName, const std::vector<uint8_t>& data);
+
+	/**
+	 * Read a whole checkpoint file
+	 * @param[in] fileName The file name
+	 * @param[out] data The checkpoint data. Its previous content is replaced
+	 * @return True if the file was read, false otherwise
+	 */
+	bool readCheckpointFile(const std::string& fileName, std::vector<uint8_t>& data);
+
+} // namespace pcpp
+
+#endif /* PCAPPP_STATE_CHECKPOINT */
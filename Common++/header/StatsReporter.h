@@ -0,0 +1,336 @@
+#ifndef PCAPPP_STATS_REPORTER
+#define PCAPPP_STATS_REPORTER
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "TablePrinter.h"
+#include "AtomicUtils.h"
+#include "MetricsRegistry.h"
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class StatsCounters
+	 * A set of named 64-bit counters kept separately for each worker thread, meant for applications which collect statistics on several
+	 * capture or processing threads and report them periodically (see StatsReporter). All memory is allocated in the c'tor. Each worker
+	 * updates only its own copy of the counters, which is cache line aligned so workers never share a cache line, and updating a counter
+	 * is a plain load and store without locks or atomic read-modify-write instructions. The totals over all workers can be read at any
+	 * time from another thread with aggregate(), without stopping the workers.
+	 * A counter must be updated by a single thread: the worker whose ID is used.
+	 * StatsCounters is also a MetricsSource: when added to a MetricsRegistry the totals are reported under the counter names (converted
+	 * to valid metric names), with a "_total" suffix for counters of the MetricCounter type (see setMetricType())
+	 */
+	class StatsCounters : public MetricsSource
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] counterNames The names of the counters. The counter IDs are the indices in this vector
+		 * @param[in] numOfWorkers The number of workers, each gets its own copy of the counters. Worker IDs are 0 to numOfWorkers - 1
+		 */
+		StatsCounters(const std::vector<std::string>& counterNames, int numOfWorkers);
+
+		/**
+		 * A d'tor for this class
+		 */
+		~StatsCounters();
+
+		/**
+		 * Add a value to a counter of a worker. Should be called only by the thread of that worker
+		 * @param[in] workerId The worker ID
+		 * @param[in] counterId The counter ID
+		 * @param[in] value The value to add. Default value is 1
+		 */
+		inline void add(int workerId, int counterId, uint64_t value = 1)
+		{
+			volatile uint64_t* counter = getCounter(workerId, counterId);
+			atomicStoreRelaxed(counter, atomicLoadRelaxed(counter) + value);
+		}
+
+		/**
+		 * Set a counter of a worker to a value, for counters representing a level rather than a count (such as a queue length). Should be
+		 * called only by the thread of that worker
+		 * @param[in] workerId The worker ID
+		 * @param[in] counterId The counter ID
+		 * @param[in] value The value to set
+		 */
+		inline void set(int workerId, int counterId, uint64_t value) { atomicStoreRelaxed(getCounter(workerId, counterId), value); }
+
+		/**
+		 * Get the value of a counter of a single worker. Can be called from any thread
+		 * @param[in] workerId The worker ID
+		 * @param[in] counterId The counter ID
+		 * @return The counter value
+		 */
+		inline uint64_t get(int workerId, int counterId) const { return atomicLoadRelaxed(getCounter(workerId, counterId)); }
+
+		/**
+		 * Sum the counters of all workers. Can be called from any thread while the workers update their counters. Doesn't allocate memory
+		 * @param[out] totals An array of getNumOfCounters() values the totals are written to
+		 */
+		void aggregate(uint64_t* totals) const;
+
+		/**
+		 * Set all counters of all workers to zero. Should be called only while the workers don't update their counters
+		 */
+		void reset();
+
+		/**
+		 * @return The number of counters
+		 */
+		inline int getNumOfCounters() const { return (int)m_CounterNames.size(); }
+
+		/**
+		 * @return The number of workers
+		 */
+		inline int getNumOfWorkers() const { return m_NumOfWorkers; }
+
+		/**
+		 * @param[in] counterId The counter ID
+		 * @return The name of the counter
+		 */
+		inline const std::string& getCounterName(int counterId) const { return m_CounterNames[counterId]; }
+
+		/**
+		 * Find a counter by its name
+		 * @param[in] name The counter name
+		 * @return The counter ID or -1 if there is no counter with this name
+		 */
+		int getCounterId(const std::string& name) const;
+
+		/**
+		 * Set the type a counter is reported as to a MetricsRegistry. All counters are of the MetricCounter type by default, counters
+		 * updated with set() should be set to MetricGauge
+		 * @param[in] counterId The counter ID
+		 * @param[in] type The metric type
+		 */
+		inline void setMetricType(int counterId, MetricType type) { m_MetricTypes[counterId] = type; }
+
+		/**
+		 * Report the totals of all counters to a MetricsRegistry snapshot
+		 * @param[in] writer The writer to report the values to
+		 */
+		void collectMetrics(MetricsWriter& writer);
+
+	private:
+		std::vector<std::string> m_CounterNames;
+		std::vector<MetricType> m_MetricTypes;
+		std::vector<std::string> m_MetricNames;
+		int m_NumOfWorkers;
+		// the number of counters each worker's copy takes, rounded up to a whole number of cache lines
+		size_t m_Stride;
+		uint64_t* m_Buffer;
+		// m_Buffer aligned to a cache line
+		volatile uint64_t* m_Values;
+
+		inline volatile uint64_t* getCounter(int workerId, int counterId) const { return m_Values + (size_t)workerId * m_Stride + counterId; }
+
+		// disable copy c'tor and assignment operator
+		StatsCounters(const StatsCounters& other);
+		StatsCounters& operator=(const StatsCounters& other);
+	};
+
+
+	/**
+	 * @struct StatsSnapshot
+	 * The totals of all counters of a StatsCounters instance at a certain time, together with the change since the previous snapshot.
+	 * Passed by StatsReporter to its sinks. The arrays are owned by the reporter and are valid only during StatsSink#write()
+	 */
+	struct StatsSnapshot
+	{
+		/** The counters the snapshot was taken of, for their names */
+		const StatsCounters* counters;
+		/** The time the snapshot was taken */
+		timespec timestamp;
+		/** The time in seconds since the previous snapshot */
+		double intervalSec;
+		/** The totals of the counters over all workers */
+		const uint64_t* totals;
+		/** The change of each total since the previous snapshot */
+		const uint64_t* deltas;
+
+		/**
+		 * @param[in] counterId The counter ID
+		 * @return The change of the counter per second since the previous snapshot
+		 */
+		inline double getRate(int counterId) const { return (intervalSec > 0 ? (double)deltas[counterId] / intervalSec : 0); }
+	};
+
+
+	/**
+	 * @class StatsSink
+	 * An abstract output of StatsReporter. A sink is written to by a single thread at a time
+	 */
+	class StatsSink
+	{
+	public:
+		virtual ~StatsSink() {}
+
+		/**
+		 * Write a snapshot
+		 * @param[in] snapshot The snapshot to write
+		 */
+		virtual void write(const StatsSnapshot& snapshot) = 0;
+	};
+
+
+	/**
+	 * @class TableStatsSink
+	 * A sink which prints each snapshot as a table with a row per counter (name, total and rate per second) using TablePrinter
+	 */
+	class TableStatsSink : public StatsSink
+	{
+	public:
+		/**
+		 * A c'tor for this class
+		 * @param[in] nameColumnWidth The width of the counter name column. Default value is 30
+		 * @param[in] valueColumnWidth The width of the total and rate columns. Default value is 20
+		 */
+		TableStatsSink(int nameColumnWidth = 30, int valueColumnWidth = 20);
+
+		void write(const StatsSnapshot& snapshot);
+
+	private:
+		TablePrinter m_Printer;
+	};
+
+
+	/**
+	 * @class CsvStatsSink
+	 * A sink which writes a CSV line per snapshot: the timestamp followed by the total of each counter. A header line with the counter
+	 * names is written before the first snapshot
+	 */
+	class CsvStatsSink : public StatsSink
+	{
+	public:
+		/**
+		 * A c'tor for this class
+		 * @param[in] file The file to write to. It isn't closed by the sink. Default value is stdout
+		 */
+		CsvStatsSink(FILE* file = stdout);
+
+		void write(const StatsSnapshot& snapshot);
+
+	private:
+		FILE* m_File;
+		bool m_HeaderWritten;
+	};
+
+
+	/**
+	 * @class JsonLinesStatsSink
+	 * A sink which writes each snapshot as a single line JSON object (the JSON lines format), for example:
+	 * {"timestamp":1500000000.123456789,"interval":1.000000,"totals":{"packets":100,"bytes":6400},"rates":{"packets":100.00,"bytes":6400.00}}
+	 */
+	class JsonLinesStatsSink : public StatsSink
+	{
+	public:
+		/**
+		 * A c'tor for this class
+		 * @param[in] file The file to write to. It isn't closed by the sink. Default value is stdout
+		 */
+		JsonLinesStatsSink(FILE* file = stdout);
+
+		void write(const StatsSnapshot& snapshot);
+
+	private:
+		FILE* m_File;
+		// the counter names escaped as JSON strings, prepared on the first write
+		std::vector<std::string> m_EscapedNames;
+	};
+
+
+	/**
+	 * @class StatsReporter
+	 * Periodically aggregates a StatsCounters instance and writes the totals and rates to one or more sinks (see TableStatsSink,
+	 * CsvStatsSink and JsonLinesStatsSink). Reporting is done either by a background thread started with start(), so the worker threads
+	 * and the application's main loop never block on output, or by calling report() directly. Aggregation reads the workers' counters
+	 * without locking them, and all buffers are allocated in the c'tor, so a report doesn't allocate memory (besides what sinks do on
+	 * their first write)
+	 */
+	class StatsReporter
+	{
+	public:
+		/**
+		 * A c'tor for this class. The current values of the counters are the base for the first report
+		 * @param[in] counters The counters to report. The instance must outlive the reporter
+		 */
+		StatsReporter(const StatsCounters& counters);
+
+		/**
+		 * A d'tor for this class. Stops the background thread if it's running
+		 */
+		~StatsReporter();
+
+		/**
+		 * Add a sink to write reports to. Sinks should be added before reporting starts
+		 * @param[in] sink The sink. It isn't freed by the reporter and must outlive it
+		 */
+		void addSink(StatsSink* sink);
+
+		/**
+		 * Aggregate the counters and write a snapshot to all sinks. The deltas and rates are relative to the previous report
+		 */
+		void report();
+
+		/**
+		 * Start a background thread which calls report() periodically
+		 * @param[in] intervalMs The reporting interval in milliseconds. Default value is 1000
+		 * @return True if the thread was started or is already running, false if it couldn't be created
+		 */
+		bool start(uint32_t intervalMs = 1000);
+
+		/**
+		 * Stop the background thread, after writing a last report. Does nothing if the thread isn't running
+		 */
+		void stop();
+
+		/**
+		 * @return True if the background thread is running
+		 */
+		inline bool isRunning() const { return m_Running; }
+
+		/**
+		 * @return The number of reports written so far
+		 */
+		inline uint64_t getNumOfReports() const { return m_NumOfReports; }
+
+	private:
+		const StatsCounters& m_Counters;
+		std::vector<StatsSink*> m_Sinks;
+		std::vector<uint64_t> m_Totals;
+		std::vector<uint64_t> m_PrevTotals;
+		std::vector<uint64_t> m_Deltas;
+		timespec m_PrevTimestamp;
+		uint64_t m_NumOfReports;
+
+		bool m_Running;
+		bool m_StopRequested;
+		uint32_t m_IntervalMs;
+		pthread_t m_Thread;
+		// protects the report state and the stop request
+		pthread_mutex_t m_Mutex;
+		pthread_cond_t m_StopCond;
+
+		static void* reporterThreadMain(void* reporterPtr);
+
+		// disable copy c'tor and assignment operator
+		StatsReporter(const StatsReporter& other);
+		StatsReporter& operator=(const StatsReporter& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_STATS_REPORTER */
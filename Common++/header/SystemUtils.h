@@ -229,6 +229,71 @@ namespace pcpp
 	 */
 	void createCoreVectorFromCoreMask(CoreMask coreMask, std::vector<SystemCore>& resultVec);
 
+	/**
+	 * Create a core mask from a CPU list in the format Linux uses (for example in sysfs and for the isolcpus kernel parameter), such as
+	 * "0-3,8,10-11". Cores with ID of MAX_NUM_OF_CORES or more are ignored
+	 * @param[in] cpuList The CPU list
+	 * @return A core mask representing the cores in the list, or 0 if the list is empty or malformed
+	 */
+	CoreMask createCoreMaskFromCpuList(const std::string& cpuList);
+
+	/**
+	 * @return The number of NUMA nodes on the machine. Machines without NUMA support (and platforms other than Linux) are reported
+	 * as having 1 node
+	 */
+	int getNumOfNumaNodes();
+
+	/**
+	 * Get the NUMA node a core belongs to
+	 * @param[in] coreId The core ID
+	 * @return The NUMA node of the core, or -1 if the core doesn't exist. On machines without NUMA support (and platforms other than
+	 * Linux) all cores belong to node 0
+	 */
+	int getCoreNumaNode(int coreId);
+
+	/**
+	 * Create a core mask for all cores of a NUMA node
+	 * @param[in] numaNode The NUMA node
+	 * @return A core mask for the cores of the node, or 0 if the node doesn't exist
+	 */
+	CoreMask getNumaNodeCoreMask(int numaNode);
+
+	/**
+	 * Get the SMT (hyperthread) siblings of a core, meaning the cores which share the same physical core
+	 * @param[in] coreId The core ID
+	 * @return A core mask of the siblings, including the core itself. If the topology isn't known the mask contains only the core
+	 * itself, and if the core doesn't exist the mask is 0
+	 */
+	CoreMask getSmtSiblingsCoreMask(int coreId);
+
+	/**
+	 * Get the NUMA node a PCI device (such as a NIC) is attached to
+	 * @param[in] pciAddress The PCI address of the device in the format DpdkDevice#getPciAddress() returns, for example "0000:04:00.1".
+	 * The domain prefix ("0000:") is optional
+	 * @return The NUMA node of the device, or -1 if it's not known (the device doesn't exist, the machine isn't a NUMA machine or the
+	 * platform isn't Linux)
+	 */
+	int getPciDeviceNumaNode(const std::string& pciAddress);
+
+	/**
+	 * Get the NUMA node of the device behind a network interface
+	 * @param[in] interfaceName The interface name, for example "eth0"
+	 * @return The NUMA node of the device, or -1 if it's not known (for example for virtual interfaces)
+	 */
+	int getNetworkInterfaceNumaNode(const std::string& interfaceName);
+
+	/**
+	 * Select cores for running worker threads close to a NUMA node. Cores are picked in this order: cores of the node whose SMT
+	 * siblings weren't picked yet (one core per physical core), the rest of the cores of the node, and then the cores of other nodes in
+	 * the same manner
+	 * @param[in] numaNode The NUMA node to prefer, usually the node of the NIC the threads work with. If it's -1 there's no node
+	 * preference and only physical cores are preferred over SMT siblings
+	 * @param[in] numOfCores The number of cores to select
+	 * @param[in] availableCores The cores to select from. Default value is all machine cores
+	 * @return A core mask of the selected cores. It contains less than numOfCores cores if availableCores doesn't contain enough cores
+	 */
+	CoreMask selectNumaLocalCores(int numaNode, int numOfCores, CoreMask availableCores = getCoreMaskForAllMachineCores());
+
 	/**
 	 * Execute a shell command and return its output
 	 * @param[in] command The command to run
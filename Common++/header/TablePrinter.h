@@ -1,3 +1,7 @@
+#ifndef PCAPPP_TABLE_PRINTER
+#define PCAPPP_TABLE_PRINTER
+
+#include <string>
 #include <vector>
 
 /// @file
@@ -45,6 +49,16 @@ namespace pcpp
 		 */
 		bool printRow(std::vector<std::string> values);
 
+		/**
+		 * Print a single row from an array of C strings. Unlike the other printRow() overloads this method doesn't allocate memory, which
+		 * makes it suitable for printing large tables periodically
+		 * @param[in] values An array of null-terminated strings containing values for all columns
+		 * @param[in] numOfValues The number of values in the array, must be equal to the number of columns
+		 * @return True if row was printed successfully or false otherwise (in any case of error an appropriate message
+		 * will be printed to log)
+		 */
+		bool printRow(const char* const values[], int numOfValues);
+
 		/**
 		 * Print a separator line
 		 */
@@ -56,6 +70,12 @@ namespace pcpp
 		 */
 		void closeTable();
 
+		/**
+		 * Start a new table with the same columns: the table is closed if it isn't closed yet, and the headline is printed again before
+		 * the next row. Useful for printing the same table periodically
+		 */
+		void resetTable();
+
 	private:
 		std::vector<std::string> m_ColumnNames;
 		std::vector<int> m_ColumnWidths;
@@ -66,6 +86,13 @@ namespace pcpp
 		 * Print the table headline
 		 */
 		void printHeadline();
+
+		/**
+		 * Check the table is open and print the headline before the first row
+		 */
+		bool prepareRow(size_t numOfValues);
 	};
 
 }
+
+#endif /* PCAPPP_TABLE_PRINTER */
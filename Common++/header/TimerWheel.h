@@ -0,0 +1,155 @@
+#ifndef PCAPPP_TIMER_WHEEL
+#define PCAPPP_TIMER_WHEEL
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class TimerWheel
+	 * A hierarchical timing wheel for managing a large number of timeouts, such as idle timeouts of connections or flows. Time is measured in
+	 * abstract ticks (for example seconds of packet timestamps) and only moves forward when advance() is called, so a timer wheel can be driven
+	 * by packet timestamps rather than the wall clock.
+	 * The wheel has 4 levels of 64 slots each: level 0 holds timers expiring in the next 64 ticks with one tick per slot, and each higher level
+	 * covers a 64 times longer range with coarser slots. Timers are moved to a lower level as their expiry gets closer. Adding, removing and
+	 * rescheduling a timer is O(1), and advancing the time costs O(1) per expired timer plus the amortized cost of moving timers between levels,
+	 * skipping empty ranges, so a large jump in time doesn't cost a step per tick. Expired timers are collected in a list and handed to the user
+	 * one at a time by popExpired(), so the user may limit the work done per call.
+	 * Each timer carries a 64-bit user value. Timers are stored in a pool of nodes which is reused, so adding a timer allocates memory only when
+	 * the number of timers grows beyond its previous maximum. Timers expiring more than 2^24 ticks ahead are supported: they're kept at the top
+	 * level and re-examined until they're close enough
+	 */
+	class TimerWheel
+	{
+	public:
+
+		/**
+		 * The ID returned for a timer which couldn't be added and never used for a valid timer
+		 */
+		static const uint32_t InvalidTimerId = 0xffffffff;
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] currentTick The current time of the wheel. Default value is 0
+		 */
+		TimerWheel(uint64_t currentTick = 0);
+
+		/**
+		 * Add a timer
+		 * @param[in] expiryTick The time the timer expires at. If it isn't later than the current time the timer is expired right away and is
+		 * returned by the next call to popExpired()
+		 * @param[in] userValue A value returned to the user when the timer expires
+		 * @return The ID of the timer, valid until the timer is removed or popped after expiring
+		 */
+		uint32_t addTimer(uint64_t expiryTick, uint64_t userValue);
+
+		/**
+		 * Remove a timer which didn't expire yet or expired but wasn't popped
+		 * @param[in] timerId The timer ID
+		 */
+		void removeTimer(uint32_t timerId);
+
+		/**
+		 * Change the expiry time of a timer. The timer keeps its ID and user value
+		 * @param[in] timerId The ID of a timer which didn't expire yet or expired but wasn't popped
+		 * @param[in] expiryTick The new time the timer expires at
+		 */
+		void rescheduleTimer(uint32_t timerId, uint64_t expiryTick);
+
+		/**
+		 * Advance the time of the wheel and move all timers which expire until then to the expired list. Times earlier than the current
+		 * time are ignored
+		 * @param[in] currentTick The new current time
+		 */
+		void advance(uint64_t currentTick);
+
+		/**
+		 * Take the next timer from the expired list. The timer is removed from the wheel
+		 * @param[out] userValue The user value of the timer
+		 * @return True if an expired timer was found, false if there are no expired timers
+		 */
+		bool popExpired(uint64_t& userValue);
+
+		/**
+		 * @param[in] timerId The ID of a valid timer
+		 * @return The user value of the timer
+		 */
+		inline uint64_t getUserValue(uint32_t timerId) const { return m_Nodes[timerId].userValue; }
+
+		/**
+		 * @param[in] timerId The ID of a valid timer
+		 * @return The time the timer expires at
+		 */
+		inline uint64_t getExpiryTick(uint32_t timerId) const { return m_Nodes[timerId].expiryTick; }
+
+		/**
+		 * @return The current time of the wheel
+		 */
+		inline uint64_t getCurrentTick() const { return m_CurrentTick; }
+
+		/**
+		 * @return The number of timers in the wheel, including expired timers which weren't popped yet
+		 */
+		inline size_t getNumOfTimers() const { return m_NumOfTimers; }
+
+		/**
+		 * @return The number of expired timers which weren't popped yet
+		 */
+		inline size_t getNumOfExpiredTimers() const { return m_NumOfExpired; }
+
+		/**
+		 * Remove all timers. Allocated storage is kept for reuse
+		 */
+		void clear();
+
+	private:
+
+		enum
+		{
+			SlotBits = 6,
+			SlotsPerLevel = 1 << SlotBits,
+			NumOfLevels = 4,
+			// the list of expired timers comes after the lists of the wheel slots
+			ExpiredList = NumOfLevels * SlotsPerLevel,
+			NumOfLists = ExpiredList + 1
+		};
+
+		struct Node
+		{
+			uint64_t expiryTick;
+			uint64_t userValue;
+			uint32_t prev;
+			uint32_t next;
+			// the list the node is in, or NumOfLists if it's free
+			uint32_t list;
+		};
+
+		std::vector<Node> m_Nodes;
+		uint32_t m_FreeList;
+		uint32_t m_ListHeads[NumOfLists];
+		// the expired timers are appended to their list so they're popped in the order they expired in
+		uint32_t m_ExpiredTail;
+		// the number of timers in each level, for skipping empty ranges when advancing
+		size_t m_LevelCounts[NumOfLevels];
+		size_t m_NumOfTimers;
+		size_t m_NumOfExpired;
+		uint64_t m_CurrentTick;
+
+		void placeTimer(uint32_t nodeIndex);
+		void linkToList(uint32_t nodeIndex, uint32_t list);
+		void unlinkFromList(uint32_t nodeIndex);
+		void step();
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_TIMER_WHEEL */
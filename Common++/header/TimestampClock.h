@@ -0,0 +1,119 @@
+#ifndef PCAPPP_TIMESTAMP_CLOCK
+#define PCAPPP_TIMESTAMP_CLOCK
+
+#include <stdint.h>
+#include <time.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <winsock2.h>
+#else
+#include <sys/time.h>
+#endif
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class TimestampClock
+	 * A nanosecond resolution wall clock meant for timestamping packets without a system call per packet. On x86 CPUs with an invariant
+	 * TSC (time stamp counter) the time is calculated from the TSC, which is calibrated against the system clock once, on first use.
+	 * Reading the clock then costs a single RDTSC instruction and a multiplication. On other CPUs the system clock is read on every call
+	 * (clock_gettime() on Linux).
+	 * Devices stamp all packets of a received burst with a single read of this clock (see DpdkDevice and RawSocketDevice), and Packet
+	 * takes the timestamp of newly created packets from it.
+	 * The TSC and the system clock drift apart slowly (for example when the system clock is adjusted by NTP). Applications that run for
+	 * a long time and need their timestamps to agree with the system clock can call recalibrate() periodically, for example once a
+	 * minute. All methods are static and thread-safe
+	 */
+	class TimestampClock
+	{
+	public:
+
+		/**
+		 * @return The current time as a timespec since the Epoch, in nanosecond resolution
+		 */
+		static timespec now();
+
+		/**
+		 * @return The current time as a timeval since the Epoch, in microsecond resolution
+		 */
+		static timeval nowTimeval();
+
+		/**
+		 * @return The current time in nanoseconds since the Epoch
+		 */
+		static uint64_t nowNs();
+
+		/**
+		 * Re-synchronize the clock with the system clock: the current TSC value is paired with the current system time and the TSC
+		 * frequency is re-measured over the time passed since the previous calibration. Does nothing if the clock isn't TSC based
+		 */
+		static void recalibrate();
+
+		/**
+		 * @return True if the clock is calculated from the TSC, false if the system clock is read on every call
+		 */
+		static bool isTscBased();
+
+		/**
+		 * @return The measured TSC frequency in ticks per second, or 0 if the clock isn't TSC based
+		 */
+		static uint64_t getTscFrequency();
+
+		/**
+		 * Read a free running counter for measuring short durations, such as the cost of a piece of code, by subtracting two readings.
+		 * It's the raw TSC on x86 CPUs, so a reading costs a single RDTSC instruction, and the system clock in nanoseconds elsewhere.
+		 * Unlike nowNs() it isn't calibrated, so readings can only be compared with each other
+		 * @return The current counter value
+		 */
+		static uint64_t readCycleCounter();
+
+		/**
+		 * Convert a timeval to a timespec
+		 * @param[in] tv The timeval to convert
+		 * @return A timespec of the same time
+		 */
+		static inline timespec toTimespec(const timeval& tv)
+		{
+			timespec result;
+			result.tv_sec = tv.tv_sec;
+			result.tv_nsec = tv.tv_usec * 1000;
+			return result;
+		}
+
+		/**
+		 * Convert a timespec to a timeval. The nanoseconds are truncated to microseconds
+		 * @param[in] ts The timespec to convert
+		 * @return A timeval of the same time
+		 */
+		static inline timeval toTimeval(const timespec& ts)
+		{
+			timeval result;
+			result.tv_sec = ts.tv_sec;
+			result.tv_usec = ts.tv_nsec / 1000;
+			return result;
+		}
+
+		/**
+		 * Convert a timeval to nanoseconds since the Epoch
+		 * @param[in] tv The timeval to convert
+		 * @return The time in nanoseconds
+		 */
+		static inline uint64_t toNs(const timeval& tv) { return (uint64_t)tv.tv_sec * 1000000000ULL + (uint64_t)tv.tv_usec * 1000; }
+
+		/**
+		 * Convert a timespec to nanoseconds since the Epoch
+		 * @param[in] ts The timespec to convert
+		 * @return The time in nanoseconds
+		 */
+		static inline uint64_t toNs(const timespec& ts) { return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec; }
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_TIMESTAMP_CLOCK */
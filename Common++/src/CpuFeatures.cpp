@@ -0,0 +1,154 @@
+#include "CpuFeatures.h"
+#include <stddef.h>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define PCPP_CPU_FEATURES_X86_MSVC
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PCPP_CPU_FEATURES_X86_GCC
+#include <cpuid.h>
+#endif
+
+namespace pcpp
+{
+
+struct CpuFeatureFlags
+{
+	bool sse2;
+	bool ssse3;
+	bool sse42;
+	bool avx2;
+	bool avx512f;
+	bool invariantTsc;
+};
+
+#if defined(PCPP_CPU_FEATURES_X86_MSVC)
+
+static void detectCpuFeatures(CpuFeatureFlags& flags)
+{
+	int regs[4];
+	__cpuid(regs, 0);
+	int maxLeaf = regs[0];
+
+	__cpuid(regs, 1);
+	flags.sse2 = (regs[3] & (1 << 26)) != 0;
+	flags.ssse3 = (regs[2] & (1 << 9)) != 0;
+	flags.sse42 = (regs[2] & (1 << 20)) != 0;
+
+	// the AVX registers can be used only if the operating system enabled saving them (OSXSAVE and the XCR0 bits of their state)
+	unsigned __int64 xcr0 = ((regs[2] & (1 << 27)) != 0 ? _xgetbv(0) : 0);
+	bool avxState = ((xcr0 & 0x6) == 0x6);
+	bool avx512State = ((xcr0 & 0xe6) == 0xe6);
+
+	if (maxLeaf >= 7)
+	{
+		__cpuidex(regs, 7, 0);
+		flags.avx2 = avxState && (regs[1] & (1 << 5)) != 0;
+		flags.avx512f = avx512State && (regs[1] & (1 << 16)) != 0;
+	}
+
+	__cpuid(regs, 0x80000000);
+	if ((unsigned int)regs[0] >= 0x80000007)
+	{
+		__cpuid(regs, 0x80000007);
+		flags.invariantTsc = (regs[3] & (1 << 8)) != 0;
+	}
+}
+
+#elif defined(PCPP_CPU_FEATURES_X86_GCC)
+
+static void detectCpuFeatures(CpuFeatureFlags& flags)
+{
+	// the builtins take the operating system support of the AVX registers into account
+	__builtin_cpu_init();
+	flags.sse2 = __builtin_cpu_supports("sse2");
+	flags.ssse3 = __builtin_cpu_supports("ssse3");
+	flags.sse42 = __builtin_cpu_supports("sse4.2");
+	flags.avx2 = __builtin_cpu_supports("avx2");
+	flags.avx512f = __builtin_cpu_supports("avx512f");
+
+	unsigned int regs[4] = { 0, 0, 0, 0 };
+	if (__get_cpuid_max(0x80000000, NULL) >= 0x80000007)
+	{
+		__get_cpuid(0x80000007, &regs[0], &regs[1], &regs[2], &regs[3]);
+		flags.invariantTsc = (regs[3] & (1 << 8)) != 0;
+	}
+}
+
+#else
+
+static void detectCpuFeatures(CpuFeatureFlags& flags)
+{
+	(void)flags;
+}
+
+#endif
+
+static CpuFeatureFlags queryCpuFeatures()
+{
+	CpuFeatureFlags flags;
+	flags.sse2 = false;
+	flags.ssse3 = false;
+	flags.sse42 = false;
+	flags.avx2 = false;
+	flags.avx512f = false;
+	flags.invariantTsc = false;
+	detectCpuFeatures(flags);
+	return flags;
+}
+
+static const CpuFeatureFlags& getCpuFeatureFlags()
+{
+	// the CPU is queried once, on first use
+	static const CpuFeatureFlags flags = queryCpuFeatures();
+	return flags;
+}
+
+bool CpuFeatures::hasSse2()
+{
+	return getCpuFeatureFlags().sse2;
+}
+
+bool CpuFeatures::hasSsse3()
+{
+	return getCpuFeatureFlags().ssse3;
+}
+
+bool CpuFeatures::hasSse42()
+{
+	return getCpuFeatureFlags().sse42;
+}
+
+bool CpuFeatures::hasAvx2()
+{
+	return getCpuFeatureFlags().avx2;
+}
+
+bool CpuFeatures::hasAvx512f()
+{
+	return getCpuFeatureFlags().avx512f;
+}
+
+bool CpuFeatures::hasInvariantTsc()
+{
+	return getCpuFeatureFlags().invariantTsc;
+}
+
+bool CpuFeatures::hasNeon()
+{
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool CpuFeatures::hasArmCrc32()
+{
+#if defined(__ARM_FEATURE_CRC32)
+	return true;
+#else
+	return false;
+#endif
+}
+
+} // namespace pcpp
@@ -2,31 +2,24 @@
 
 #include "GeneralUtils.h"
 #include "Logger.h"
-#include <sstream>
-#include <iomanip>
+#include "CpuFeatures.h"
 #include <string.h>
 #include <stdlib.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PCPP_STRING_X86_KERNELS
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+#define PCPP_STRING_NEON_KERNELS
+#include <arm_neon.h>
+#endif
 
-namespace pcpp
-{
+// the maximum number of characters findFirstOf() searches for with SIMD instructions
+#define PCPP_FIND_FIRST_OF_SIMD_MAX_CHARS 4
 
-std::string byteArrayToHexString(const uint8_t* byteArr, size_t byteArrSize, int stringSizeLimit)
+namespace pcpp
 {
-	if (stringSizeLimit <= 0)
-		stringSizeLimit = byteArrSize;
 
-	std::stringstream dataStream;
-	dataStream << std::hex;
-	for (size_t i = 0; i < byteArrSize; ++i)
-	{
-		if (i >= (size_t)stringSizeLimit)
-			break;
-
-		dataStream << std::setw(2) << std::setfill('0') << (int)byteArr[i];
-	}
-
-	return dataStream.str();
-}
+static const char HexDigits[] = "0123456789abcdef";
 
 static int char2int(char input)
 {
@@ -39,6 +32,451 @@ static int char2int(char input)
 	return -1;
 }
 
+static inline int getLowestSetBit(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(word);
+#else
+	int index = 0;
+	while ((word & 1) == 0)
+	{
+		word >>= 1;
+		index++;
+	}
+	return index;
+#endif
+}
+
+// The kernels below come in a scalar version and, where the CPU has them, SIMD versions. The SIMD versions handle whole vectors and leave
+// the remaining bytes to the scalar version
+
+typedef void (*HexEncodeKernel)(const uint8_t* data, size_t len, char* result);
+typedef bool (*HexDecodeKernel)(const char* hex, size_t numOfBytes, uint8_t* result);
+typedef const char* (*FindFirstOfKernel)(const char* data, size_t dataLen, const char* chars, size_t numOfChars);
+typedef const char* (*FindSubstringKernel)(const char* data, size_t dataLen, const char* pattern, size_t patternLen);
+
+struct StringKernels
+{
+	HexEncodeKernel hexEncode;
+	HexDecodeKernel hexDecode;
+	FindFirstOfKernel findFirstOf;
+	FindSubstringKernel findSubstring;
+};
+
+static void hexEncodeScalar(const uint8_t* data, size_t len, char* result)
+{
+	for (size_t i = 0; i < len; i++)
+	{
+		result[2*i] = HexDigits[data[i] >> 4];
+		result[2*i + 1] = HexDigits[data[i] & 0x0f];
+	}
+}
+
+static bool hexDecodeScalar(const char* hex, size_t numOfBytes, uint8_t* result)
+{
+	for (size_t i = 0; i < numOfBytes; i++)
+	{
+		int high = char2int(hex[2*i]);
+		int low = char2int(hex[2*i + 1]);
+		if (high < 0 || low < 0)
+			return false;
+
+		result[i] = (uint8_t)(high*16 + low);
+	}
+
+	return true;
+}
+
+static const char* findFirstOfScalar(const char* data, size_t dataLen, const char* chars, size_t numOfChars)
+{
+	for (size_t i = 0; i < dataLen; i++)
+	{
+		for (size_t j = 0; j < numOfChars; j++)
+		{
+			if (data[i] == chars[j])
+				return data + i;
+		}
+	}
+
+	return NULL;
+}
+
+static const char* findSubstringScalar(const char* data, size_t dataLen, const char* pattern, size_t patternLen)
+{
+	const char* dataEnd = data + dataLen;
+	while ((size_t)(dataEnd - data) >= patternLen)
+	{
+		const char* candidate = (const char*)memchr(data, pattern[0], dataEnd - data - patternLen + 1);
+		if (candidate == NULL)
+			return NULL;
+
+		if (memcmp(candidate + 1, pattern + 1, patternLen - 1) == 0)
+			return candidate;
+
+		data = candidate + 1;
+	}
+
+	return NULL;
+}
+
+#if defined(PCPP_STRING_X86_KERNELS)
+
+__attribute__((target("sse2")))
+static inline __m128i nibblesToHexSse2(__m128i nibbles)
+{
+	// '0' + n for digits, 'a' + n - 10 for letters
+	__m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+	return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+
+__attribute__((target("sse2")))
+static void hexEncodeSse2(const uint8_t* data, size_t len, char* result)
+{
+	const __m128i lowNibbleMask = _mm_set1_epi8(0x0f);
+	while (len >= 16)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i*)data);
+		__m128i high = nibblesToHexSse2(_mm_and_si128(_mm_srli_epi16(bytes, 4), lowNibbleMask));
+		__m128i low = nibblesToHexSse2(_mm_and_si128(bytes, lowNibbleMask));
+		_mm_storeu_si128((__m128i*)result, _mm_unpacklo_epi8(high, low));
+		_mm_storeu_si128((__m128i*)(result + 16), _mm_unpackhi_epi8(high, low));
+		data += 16;
+		len -= 16;
+		result += 32;
+	}
+
+	hexEncodeScalar(data, len, result);
+}
+
+// convert 16 hex characters to their values, setting allValid to false if any of them isn't a hex character
+__attribute__((target("sse2")))
+static inline __m128i hexToNibblesSse2(__m128i chars, bool& allValid)
+{
+	// x <= max (unsigned) is tested as min(x, max) == x
+	__m128i digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+	__m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+	__m128i letters = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	__m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(5)), letters);
+	if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xffff)
+		allValid = false;
+
+	return _mm_or_si128(_mm_and_si128(isDigit, digits), _mm_and_si128(isLetter, _mm_add_epi8(letters, _mm_set1_epi8(10))));
+}
+
+__attribute__((target("sse2")))
+static bool hexDecodeSse2(const char* hex, size_t numOfBytes, uint8_t* result)
+{
+	const __m128i lowByteMask = _mm_set1_epi16(0x00ff);
+	while (numOfBytes >= 16)
+	{
+		bool allValid = true;
+		__m128i first = hexToNibblesSse2(_mm_loadu_si128((const __m128i*)hex), allValid);
+		__m128i second = hexToNibblesSse2(_mm_loadu_si128((const __m128i*)(hex + 16)), allValid);
+		if (!allValid)
+			return false;
+
+		// each 16-bit lane holds the high nibble in its low byte and the low nibble in its high byte
+		first = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(first, lowByteMask), 4), _mm_srli_epi16(first, 8));
+		second = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(second, lowByteMask), 4), _mm_srli_epi16(second, 8));
+		_mm_storeu_si128((__m128i*)result, _mm_packus_epi16(first, second));
+		hex += 32;
+		numOfBytes -= 16;
+		result += 16;
+	}
+
+	return hexDecodeScalar(hex, numOfBytes, result);
+}
+
+__attribute__((target("sse2")))
+static const char* findFirstOfSse2(const char* data, size_t dataLen, const char* chars, size_t numOfChars)
+{
+	// unused slots repeat the first character
+	__m128i char0 = _mm_set1_epi8(chars[0]);
+	__m128i char1 = _mm_set1_epi8(chars[numOfChars > 1 ? 1 : 0]);
+	__m128i char2 = _mm_set1_epi8(chars[numOfChars > 2 ? 2 : 0]);
+	__m128i char3 = _mm_set1_epi8(chars[numOfChars > 3 ? 3 : 0]);
+	while (dataLen >= 16)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i*)data);
+		__m128i matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, char0), _mm_cmpeq_epi8(block, char1)),
+				_mm_or_si128(_mm_cmpeq_epi8(block, char2), _mm_cmpeq_epi8(block, char3)));
+		int mask = _mm_movemask_epi8(matches);
+		if (mask != 0)
+			return data + getLowestSetBit((uint64_t)mask);
+
+		data += 16;
+		dataLen -= 16;
+	}
+
+	return findFirstOfScalar(data, dataLen, chars, numOfChars);
+}
+
+__attribute__((target("avx2")))
+static const char* findFirstOfAvx2(const char* data, size_t dataLen, const char* chars, size_t numOfChars)
+{
+	__m256i char0 = _mm256_set1_epi8(chars[0]);
+	__m256i char1 = _mm256_set1_epi8(chars[numOfChars > 1 ? 1 : 0]);
+	__m256i char2 = _mm256_set1_epi8(chars[numOfChars > 2 ? 2 : 0]);
+	__m256i char3 = _mm256_set1_epi8(chars[numOfChars > 3 ? 3 : 0]);
+	while (dataLen >= 32)
+	{
+		__m256i block = _mm256_loadu_si256((const __m256i*)data);
+		__m256i matches = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, char0), _mm256_cmpeq_epi8(block, char1)),
+				_mm256_or_si256(_mm256_cmpeq_epi8(block, char2), _mm256_cmpeq_epi8(block, char3)));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(matches);
+		if (mask != 0)
+			return data + getLowestSetBit(mask);
+
+		data += 32;
+		dataLen -= 32;
+	}
+
+	return findFirstOfSse2(data, dataLen, chars, numOfChars);
+}
+
+// candidates are positions where both the first and the last character of the pattern match, only those are compared in full
+__attribute__((target("sse2")))
+static const char* findSubstringSse2(const char* data, size_t dataLen, const char* pattern, size_t patternLen)
+{
+	const __m128i first = _mm_set1_epi8(pattern[0]);
+	const __m128i last = _mm_set1_epi8(pattern[patternLen - 1]);
+	size_t pos = 0;
+	while (pos + patternLen - 1 + 16 <= dataLen)
+	{
+		__m128i firstBlock = _mm_loadu_si128((const __m128i*)(data + pos));
+		__m128i lastBlock = _mm_loadu_si128((const __m128i*)(data + pos + patternLen - 1));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(firstBlock, first), _mm_cmpeq_epi8(lastBlock, last)));
+		while (mask != 0)
+		{
+			int index = getLowestSetBit(mask);
+			if (memcmp(data + pos + index + 1, pattern + 1, patternLen - 2) == 0)
+				return data + pos + index;
+			mask &= mask - 1;
+		}
+
+		pos += 16;
+	}
+
+	return findSubstringScalar(data + pos, dataLen - pos, pattern, patternLen);
+}
+
+__attribute__((target("avx2")))
+static const char* findSubstringAvx2(const char* data, size_t dataLen, const char* pattern, size_t patternLen)
+{
+	const __m256i first = _mm256_set1_epi8(pattern[0]);
+	const __m256i last = _mm256_set1_epi8(pattern[patternLen - 1]);
+	size_t pos = 0;
+	while (pos + patternLen - 1 + 32 <= dataLen)
+	{
+		__m256i firstBlock = _mm256_loadu_si256((const __m256i*)(data + pos));
+		__m256i lastBlock = _mm256_loadu_si256((const __m256i*)(data + pos + patternLen - 1));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(firstBlock, first), _mm256_cmpeq_epi8(lastBlock, last)));
+		while (mask != 0)
+		{
+			int index = getLowestSetBit(mask);
+			if (memcmp(data + pos + index + 1, pattern + 1, patternLen - 2) == 0)
+				return data + pos + index;
+			mask &= mask - 1;
+		}
+
+		pos += 32;
+	}
+
+	return findSubstringSse2(data + pos, dataLen - pos, pattern, patternLen);
+}
+
+#elif defined(PCPP_STRING_NEON_KERNELS)
+
+// NEON has no movemask: narrowing each 16-bit lane by 4 bits leaves a 64-bit mask with 4 bits per byte
+static inline uint64_t neonMask(uint8x16_t matches)
+{
+	return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+}
+
+static inline uint8x16_t nibblesToHexNeon(uint8x16_t nibbles)
+{
+	uint8x16_t letters = vandq_u8(vcgtq_u8(nibbles, vdupq_n_u8(9)), vdupq_n_u8('a' - '0' - 10));
+	return vaddq_u8(vaddq_u8(nibbles, vdupq_n_u8('0')), letters);
+}
+
+static void hexEncodeNeon(const uint8_t* data, size_t len, char* result)
+{
+	while (len >= 16)
+	{
+		uint8x16_t bytes = vld1q_u8(data);
+		uint8x16x2_t hex;
+		hex.val[0] = nibblesToHexNeon(vshrq_n_u8(bytes, 4));
+		hex.val[1] = nibblesToHexNeon(vandq_u8(bytes, vdupq_n_u8(0x0f)));
+		// interleaving store, the high nibble of each byte first
+		vst2q_u8((uint8_t*)result, hex);
+		data += 16;
+		len -= 16;
+		result += 32;
+	}
+
+	hexEncodeScalar(data, len, result);
+}
+
+static inline uint8x16_t hexToNibblesNeon(uint8x16_t chars, uint8x16_t& valid)
+{
+	uint8x16_t digits = vsubq_u8(chars, vdupq_n_u8('0'));
+	uint8x16_t isDigit = vcleq_u8(digits, vdupq_n_u8(9));
+	uint8x16_t letters = vsubq_u8(vorrq_u8(chars, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+	uint8x16_t isLetter = vcleq_u8(letters, vdupq_n_u8(5));
+	valid = vandq_u8(valid, vorrq_u8(isDigit, isLetter));
+	return vorrq_u8(vandq_u8(isDigit, digits), vandq_u8(isLetter, vaddq_u8(letters, vdupq_n_u8(10))));
+}
+
+static bool hexDecodeNeon(const char* hex, size_t numOfBytes, uint8_t* result)
+{
+	while (numOfBytes >= 16)
+	{
+		// de-interleaving load, the high nibbles in val[0] and the low nibbles in val[1]
+		uint8x16x2_t chars = vld2q_u8((const uint8_t*)hex);
+		uint8x16_t valid = vdupq_n_u8(0xff);
+		uint8x16_t high = hexToNibblesNeon(chars.val[0], valid);
+		uint8x16_t low = hexToNibblesNeon(chars.val[1], valid);
+		if (~neonMask(valid) != 0)
+			return false;
+
+		vst1q_u8(result, vorrq_u8(vshlq_n_u8(high, 4), low));
+		hex += 32;
+		numOfBytes -= 16;
+		result += 16;
+	}
+
+	return hexDecodeScalar(hex, numOfBytes, result);
+}
+
+static const char* findFirstOfNeon(const char* data, size_t dataLen, const char* chars, size_t numOfChars)
+{
+	uint8x16_t char0 = vdupq_n_u8((uint8_t)chars[0]);
+	uint8x16_t char1 = vdupq_n_u8((uint8_t)chars[numOfChars > 1 ? 1 : 0]);
+	uint8x16_t char2 = vdupq_n_u8((uint8_t)chars[numOfChars > 2 ? 2 : 0]);
+	uint8x16_t char3 = vdupq_n_u8((uint8_t)chars[numOfChars > 3 ? 3 : 0]);
+	while (dataLen >= 16)
+	{
+		uint8x16_t block = vld1q_u8((const uint8_t*)data);
+		uint8x16_t matches = vorrq_u8(vorrq_u8(vceqq_u8(block, char0), vceqq_u8(block, char1)),
+				vorrq_u8(vceqq_u8(block, char2), vceqq_u8(block, char3)));
+		uint64_t mask = neonMask(matches);
+		if (mask != 0)
+			return data + getLowestSetBit(mask) / 4;
+
+		data += 16;
+		dataLen -= 16;
+	}
+
+	return findFirstOfScalar(data, dataLen, chars, numOfChars);
+}
+
+static const char* findSubstringNeon(const char* data, size_t dataLen, const char* pattern, size_t patternLen)
+{
+	const uint8x16_t first = vdupq_n_u8((uint8_t)pattern[0]);
+	const uint8x16_t last = vdupq_n_u8((uint8_t)pattern[patternLen - 1]);
+	size_t pos = 0;
+	while (pos + patternLen - 1 + 16 <= dataLen)
+	{
+		uint8x16_t firstBlock = vld1q_u8((const uint8_t*)(data + pos));
+		uint8x16_t lastBlock = vld1q_u8((const uint8_t*)(data + pos + patternLen - 1));
+		uint64_t mask = neonMask(vandq_u8(vceqq_u8(firstBlock, first), vceqq_u8(lastBlock, last)));
+		while (mask != 0)
+		{
+			int index = getLowestSetBit(mask) / 4;
+			if (memcmp(data + pos + index + 1, pattern + 1, patternLen - 2) == 0)
+				return data + pos + index;
+			mask &= ~((uint64_t)0xf << (index * 4));
+		}
+
+		pos += 16;
+	}
+
+	return findSubstringScalar(data + pos, dataLen - pos, pattern, patternLen);
+}
+
+#endif
+
+static StringKernels selectStringKernels()
+{
+	StringKernels kernels;
+	kernels.hexEncode = hexEncodeScalar;
+	kernels.hexDecode = hexDecodeScalar;
+	kernels.findFirstOf = findFirstOfScalar;
+	kernels.findSubstring = findSubstringScalar;
+
+#if defined(PCPP_STRING_X86_KERNELS)
+	if (CpuFeatures::hasSse2())
+	{
+		kernels.hexEncode = hexEncodeSse2;
+		kernels.hexDecode = hexDecodeSse2;
+		kernels.findFirstOf = findFirstOfSse2;
+		kernels.findSubstring = findSubstringSse2;
+	}
+	if (CpuFeatures::hasAvx2())
+	{
+		kernels.findFirstOf = findFirstOfAvx2;
+		kernels.findSubstring = findSubstringAvx2;
+	}
+#elif defined(PCPP_STRING_NEON_KERNELS)
+	if (CpuFeatures::hasNeon())
+	{
+		kernels.hexEncode = hexEncodeNeon;
+		kernels.hexDecode = hexDecodeNeon;
+		kernels.findFirstOf = findFirstOfNeon;
+		kernels.findSubstring = findSubstringNeon;
+	}
+#endif
+
+	return kernels;
+}
+
+static inline const StringKernels& getStringKernels()
+{
+	static const StringKernels kernels = selectStringKernels();
+	return kernels;
+}
+
+// Case-insensitive comparison and hashing work on 8 bytes at a time (SWAR): the names they're used for, such as header field names, are
+// too short for vector registers to pay off
+
+static inline uint64_t loadWord(const char* data)
+{
+	uint64_t word;
+	memcpy(&word, data, sizeof(word));
+	return word;
+}
+
+static inline uint64_t toLowerWord(uint64_t word)
+{
+	const uint64_t ones = 0x0101010101010101ULL;
+	// adding to the low 7 bits of each byte sets its high bit if it's >= 'A', and separately if it's > 'Z', without carrying into the next byte
+	uint64_t heptets = word & (0x7f * ones);
+	uint64_t aboveA = heptets + (0x80 - 'A') * ones;
+	uint64_t aboveZ = heptets + (0x80 - 'Z' - 1) * ones;
+	uint64_t isUpper = (aboveA ^ aboveZ) & ~word & (0x80 * ones);
+	// 0x80 >> 2 is the 0x20 which separates upper and lower case letters
+	return word | (isUpper >> 2);
+}
+
+static inline uint8_t toLowerChar(char c)
+{
+	return (c >= 'A' && c <= 'Z' ? (uint8_t)(c + ('a' - 'A')) : (uint8_t)c);
+}
+
+std::string byteArrayToHexString(const uint8_t* byteArr, size_t byteArrSize, int stringSizeLimit)
+{
+	size_t numOfBytes = byteArrSize;
+	if (stringSizeLimit > 0 && (size_t)stringSizeLimit < numOfBytes)
+		numOfBytes = (size_t)stringSizeLimit;
+
+	if (numOfBytes == 0)
+		return std::string();
+
+	std::string result(numOfBytes * 2, '\0');
+	getStringKernels().hexEncode(byteArr, numOfBytes, &result[0]);
+	return result;
+}
+
 size_t hexStringToByteArray(const std::string& hexString, uint8_t* resultByteArr, size_t resultByteArrSize)
 {
 	if (hexString.size() % 2 != 0)
@@ -48,26 +486,94 @@ size_t hexStringToByteArray(const std::string& hexString, uint8_t* resultByteArr
 	}
 
 	memset(resultByteArr, 0, resultByteArrSize);
-	for (size_t i = 0; i < hexString.length(); i += 2)
+
+	// if the array is too short only the part of the string which fits is converted
+	size_t numOfBytes = hexString.size() / 2;
+	if (numOfBytes > resultByteArrSize)
+		numOfBytes = resultByteArrSize;
+
+	if (!getStringKernels().hexDecode(hexString.data(), numOfBytes, resultByteArr))
 	{
-		if (i >= resultByteArrSize*2)
-			return resultByteArrSize;
+		LOG_ERROR("Input string has an illegal character");
+		memset(resultByteArr, 0, resultByteArrSize);
+		return 0;
+	}
 
-		std::string byteString = hexString.substr(i, 2);
-		int firstChar = char2int(byteString[0]);
-		int secondChar = char2int(byteString[1]);
-		if (firstChar < 0 || secondChar < 0)
-		{
-			LOG_ERROR("Input string has an illegal character");
-			memset(resultByteArr, 0, resultByteArrSize);
-			return 0;
-		}
+	return numOfBytes;
+}
+
+const char* findFirstOf(const char* data, size_t dataLen, const char* chars, size_t numOfChars)
+{
+	if (data == NULL || dataLen == 0 || numOfChars == 0)
+		return NULL;
 
-		uint8_t byte = (uint8_t)(firstChar*16 + secondChar);
-		resultByteArr[i/2] = byte;
+	if (numOfChars == 1)
+		return (const char*)memchr(data, chars[0], dataLen);
+
+	if (numOfChars > PCPP_FIND_FIRST_OF_SIMD_MAX_CHARS)
+		return findFirstOfScalar(data, dataLen, chars, numOfChars);
+
+	return getStringKernels().findFirstOf(data, dataLen, chars, numOfChars);
+}
+
+const char* findSubstring(const char* data, size_t dataLen, const char* pattern, size_t patternLen)
+{
+	if (patternLen == 0)
+		return data;
+
+	if (data == NULL || patternLen > dataLen)
+		return NULL;
+
+	if (patternLen == 1)
+		return (const char*)memchr(data, pattern[0], dataLen);
+
+	return getStringKernels().findSubstring(data, dataLen, pattern, patternLen);
+}
+
+bool equalsIgnoreCase(const char* str1, const char* str2, size_t len)
+{
+	while (len >= sizeof(uint64_t))
+	{
+		if (toLowerWord(loadWord(str1)) != toLowerWord(loadWord(str2)))
+			return false;
+
+		str1 += sizeof(uint64_t);
+		str2 += sizeof(uint64_t);
+		len -= sizeof(uint64_t);
+	}
+
+	for (size_t i = 0; i < len; i++)
+	{
+		if (toLowerChar(str1[i]) != toLowerChar(str2[i]))
+			return false;
+	}
+
+	return true;
+}
+
+uint32_t hashIgnoreCase(const char* data, size_t len)
+{
+	const uint64_t multiplier = 0x9e3779b97f4a7c15ULL;
+	// the length is part of the seed so a string and the same string padded with null characters don't collide
+	uint64_t hash = 0xcbf29ce484222325ULL ^ ((uint64_t)len * multiplier);
+	while (len >= sizeof(uint64_t))
+	{
+		hash = (hash ^ toLowerWord(loadWord(data))) * multiplier;
+		hash ^= hash >> 29;
+		data += sizeof(uint64_t);
+		len -= sizeof(uint64_t);
+	}
+
+	if (len > 0)
+	{
+		uint64_t word = 0;
+		memcpy(&word, data, len);
+		hash = (hash ^ toLowerWord(word)) * multiplier;
 	}
 
-	return (size_t)(hexString.length() / 2);
+	hash ^= hash >> 32;
+	hash *= multiplier;
+	return (uint32_t)(hash >> 32);
 }
 
 }
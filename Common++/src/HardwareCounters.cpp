@@ -0,0 +1,278 @@
+#define LOG_MODULE CommonLogModuleHardwareCounters
+
+#include "HardwareCounters.h"
+#include "Logger.h"
+#include <stdio.h>
+#include <string.h>
+#ifdef LINUX
+#include <unistd.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+namespace pcpp
+{
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// HardwareCounterValues members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+void HardwareCounterValues::clear()
+{
+	for (int i = 0; i < NumOfHwCounterTypes; i++)
+	{
+		values[i] = 0;
+		available[i] = false;
+	}
+}
+
+HardwareCounterValues& HardwareCounterValues::operator+=(const HardwareCounterValues& other)
+{
+	bool wasEmpty = !isAnyAvailable();
+	for (int i = 0; i < NumOfHwCounterTypes; i++)
+	{
+		values[i] += other.values[i];
+		available[i] = (wasEmpty ? other.available[i] : available[i] && other.available[i]);
+	}
+
+	return *this;
+}
+
+bool HardwareCounterValues::isAnyAvailable() const
+{
+	for (int i = 0; i < NumOfHwCounterTypes; i++)
+	{
+		if (available[i])
+			return true;
+	}
+
+	return false;
+}
+
+double HardwareCounterValues::getPerUnit(HardwareCounterType type, uint64_t numOfUnits) const
+{
+	if (!available[type] || numOfUnits == 0)
+		return -1;
+
+	return (double)values[type] / (double)numOfUnits;
+}
+
+double HardwareCounterValues::getInstructionsPerCycle() const
+{
+	if (!available[HwCounterCycles] || !available[HwCounterInstructions] || values[HwCounterCycles] == 0)
+		return -1;
+
+	return (double)values[HwCounterInstructions] / (double)values[HwCounterCycles];
+}
+
+const char* HardwareCounterValues::getName(HardwareCounterType type)
+{
+	switch (type)
+	{
+	case HwCounterCycles:
+		return "cycles";
+	case HwCounterInstructions:
+		return "instructions";
+	case HwCounterL1DataMisses:
+		return "l1d-misses";
+	case HwCounterLLCMisses:
+		return "llc-misses";
+	case HwCounterBranchMisses:
+		return "branch-misses";
+	default:
+		return "unknown";
+	}
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+// HardwareCounters members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifdef LINUX
+// fill the perf_event_attr type and config of a counter type
+static void setCounterEventConfig(HardwareCounterType type, perf_event_attr& attr)
+{
+	switch (type)
+	{
+	case HwCounterCycles:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case HwCounterInstructions:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case HwCounterL1DataMisses:
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	case HwCounterLLCMisses:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		break;
+	case HwCounterBranchMisses:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	default:
+		break;
+	}
+}
+#endif
+
+HardwareCounters::HardwareCounters()
+{
+	for (int i = 0; i < NumOfHwCounterTypes; i++)
+		m_Fds[i] = -1;
+}
+
+HardwareCounters::~HardwareCounters()
+{
+	close();
+}
+
+bool HardwareCounters::open()
+{
+	if (isOpen())
+		return true;
+
+#ifdef LINUX
+	for (int i = 0; i < NumOfHwCounterTypes; i++)
+	{
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		setCounterEventConfig((HardwareCounterType)i, attr);
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		// the counters aren't a group so each of them is scheduled on its own when the CPU has fewer counters than requested, the
+		// enabled and running times are used for scaling the values in that case
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		// count the calling thread on any CPU
+		m_Fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		if (m_Fds[i] < 0)
+			LOG_DEBUG("Cannot open hardware counter '%s': %s", HardwareCounterValues::getName((HardwareCounterType)i), strerror(errno));
+	}
+
+	if (!isOpen())
+	{
+		LOG_ERROR("Cannot open any hardware counter. Hardware counters may not be supported on this machine or not allowed by "
+				"/proc/sys/kernel/perf_event_paranoid");
+		return false;
+	}
+
+	return true;
+#else
+	LOG_ERROR("Hardware counters are supported on Linux only");
+	return false;
+#endif
+}
+
+void HardwareCounters::close()
+{
+#ifdef LINUX
+	for (int i = 0; i < NumOfHwCounterTypes; i++)
+	{
+		if (m_Fds[i] >= 0)
+			::close(m_Fds[i]);
+		m_Fds[i] = -1;
+	}
+#endif
+}
+
+bool HardwareCounters::isOpen() const
+{
+	for (int i = 0; i < NumOfHwCounterTypes; i++)
+	{
+		if (m_Fds[i] >= 0)
+			return true;
+	}
+
+	return false;
+}
+
+void HardwareCounters::start()
+{
+#ifdef LINUX
+	for (int i = 0; i < NumOfHwCounterTypes; i++)
+	{
+		if (m_Fds[i] < 0)
+			continue;
+		ioctl(m_Fds[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(m_Fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+void HardwareCounters::stop()
+{
+#ifdef LINUX
+	for (int i = 0; i < NumOfHwCounterTypes; i++)
+	{
+		if (m_Fds[i] >= 0)
+			ioctl(m_Fds[i], PERF_EVENT_IOC_DISABLE, 0);
+	}
+#endif
+}
+
+bool HardwareCounters::read(HardwareCounterValues& result) const
+{
+	result.clear();
+	if (!isOpen())
+		return false;
+
+#ifdef LINUX
+	for (int i = 0; i < NumOfHwCounterTypes; i++)
+	{
+		if (m_Fds[i] < 0)
+			continue;
+
+		// the value, the time enabled and the time running
+		uint64_t data[3];
+		if (::read(m_Fds[i], data, sizeof(data)) != (ssize_t)sizeof(data))
+			continue;
+
+		// a counter which was never scheduled has no meaningful value
+		if (data[2] == 0)
+			continue;
+
+		if (data[2] < data[1])
+			data[0] = (uint64_t)((double)data[0] * (double)data[1] / (double)data[2]);
+
+		result.values[i] = data[0];
+		result.available[i] = true;
+	}
+#endif
+
+	return true;
+}
+
+std::string HardwareCounters::toString(const HardwareCounterValues& values, uint64_t numOfUnits)
+{
+	std::string result;
+	char buffer[64];
+	for (int i = 0; i < NumOfHwCounterTypes; i++)
+	{
+		double perUnit = values.getPerUnit((HardwareCounterType)i, numOfUnits);
+		if (perUnit < 0)
+			continue;
+
+		snprintf(buffer, sizeof(buffer), "%s%.1f %s", (result.empty() ? "" : " "), perUnit, HardwareCounterValues::getName((HardwareCounterType)i));
+		result += buffer;
+
+		if (i == HwCounterInstructions && values.getInstructionsPerCycle() >= 0)
+		{
+			snprintf(buffer, sizeof(buffer), " %.2f IPC", values.getInstructionsPerCycle());
+			result += buffer;
+		}
+	}
+
+	return result;
+}
+
+} // namespace pcpp
@@ -0,0 +1,480 @@
+#include "HashCounters.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+namespace pcpp
+{
+
+const uint32_t StringTable::NotFound;
+const uint32_t StringTable::EmptySlot;
+
+uint64_t hashString(const char* str, size_t len)
+{
+	uint64_t hash = 0x9e3779b97f4a7c15ULL ^ ((uint64_t)len * 0xc2b2ae3d27d4eb4fULL);
+	while (len >= sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, str, sizeof(word));
+		hash = (hash ^ hashInteger(word)) * 0x9e3779b97f4a7c15ULL;
+		str += sizeof(uint64_t);
+		len -= sizeof(uint64_t);
+	}
+
+	if (len > 0)
+	{
+		uint64_t word = 0;
+		memcpy(&word, str, len);
+		hash = (hash ^ hashInteger(word)) * 0x9e3779b97f4a7c15ULL;
+	}
+
+	return hashInteger(hash);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~
+// StringTable class
+// ~~~~~~~~~~~~~~~~~~
+
+StringTable::StringTable(size_t maxSize)
+{
+	m_MaxSize = maxSize;
+	if (m_MaxSize >= (size_t)NotFound)
+		m_MaxSize = 0;
+}
+
+uint32_t StringTable::intern(const char* str, size_t len, uint64_t hash)
+{
+	if (m_Slots.size() > 0)
+	{
+		size_t slot = findSlot(str, len, (uint32_t)hash);
+		if (m_Slots[slot] != EmptySlot)
+			return m_Slots[slot] - 1;
+	}
+
+	if ((m_MaxSize != 0 && m_Strings.size() >= m_MaxSize) || m_Strings.size() >= (size_t)NotFound - 1)
+		return NotFound;
+
+	// keep the load factor up to 1/2, slots are only 4 bytes each
+	if ((m_Strings.size() + 1) * 2 > m_Slots.size())
+		grow();
+
+	uint32_t id = (uint32_t)m_Strings.size();
+	m_Strings.push_back(len > 0 ? std::string(str, len) : std::string());
+	m_Hashes.push_back((uint32_t)hash);
+	m_Slots[findSlot(str, len, (uint32_t)hash)] = id + 1;
+	return id;
+}
+
+uint32_t StringTable::find(const char* str, size_t len, uint64_t hash) const
+{
+	if (m_Strings.empty())
+		return NotFound;
+
+	uint32_t slotValue = m_Slots[findSlot(str, len, (uint32_t)hash)];
+	return (slotValue == EmptySlot ? NotFound : slotValue - 1);
+}
+
+bool StringTable::reassign(uint32_t id, const char* str, size_t len, uint64_t hash)
+{
+	if (id >= m_Strings.size() || find(str, len, hash) != NotFound)
+		return false;
+
+	const std::string& oldString = m_Strings[id];
+	eraseSlot(findSlot(oldString.data(), oldString.length(), m_Hashes[id]));
+
+	if (len > 0)
+		m_Strings[id].assign(str, len);
+	else
+		m_Strings[id].clear();
+	m_Hashes[id] = (uint32_t)hash;
+	m_Slots[findSlot(str, len, (uint32_t)hash)] = id + 1;
+	return true;
+}
+
+void StringTable::clear()
+{
+	m_Strings.clear();
+	m_Hashes.clear();
+	m_Slots.assign(m_Slots.size(), EmptySlot);
+}
+
+size_t StringTable::findSlot(const char* str, size_t len, uint32_t hash) const
+{
+	size_t mask = m_Slots.size() - 1;
+	size_t slot = hash & mask;
+	while (m_Slots[slot] != EmptySlot)
+	{
+		uint32_t id = m_Slots[slot] - 1;
+		if (m_Hashes[id] == hash && m_Strings[id].length() == len && (len == 0 || memcmp(m_Strings[id].data(), str, len) == 0))
+			break;
+
+		slot = (slot + 1) & mask;
+	}
+
+	return slot;
+}
+
+void StringTable::eraseSlot(size_t slot)
+{
+	// shift back the following entries of the probe sequence so lookups don't need tombstones
+	size_t mask = m_Slots.size() - 1;
+	size_t hole = slot;
+	size_t next = (hole + 1) & mask;
+	while (m_Slots[next] != EmptySlot)
+	{
+		size_t home = m_Hashes[m_Slots[next] - 1] & mask;
+		if (((next - home) & mask) >= ((next - hole) & mask))
+		{
+			m_Slots[hole] = m_Slots[next];
+			hole = next;
+		}
+		next = (next + 1) & mask;
+	}
+
+	m_Slots[hole] = EmptySlot;
+}
+
+void StringTable::grow()
+{
+	m_Slots.assign(m_Slots.size() == 0 ? 16 : m_Slots.size() * 2, EmptySlot);
+	size_t mask = m_Slots.size() - 1;
+	for (size_t id = 0; id < m_Strings.size(); id++)
+	{
+		size_t slot = m_Hashes[id] & mask;
+		while (m_Slots[slot] != EmptySlot)
+			slot = (slot + 1) & mask;
+		m_Slots[slot] = (uint32_t)id + 1;
+	}
+}
+
+
+// ~~~~~~~~~~~~~~~~~~
+// HashCounter class
+// ~~~~~~~~~~~~~~~~~~
+
+template<typename K>
+static bool compareCounts(const std::pair<K, uint64_t>& first, const std::pair<K, uint64_t>& second)
+{
+	if (first.second != second.second)
+		return first.second > second.second;
+
+	return first.first < second.first;
+}
+
+template<typename K>
+static void sortCounts(std::vector<std::pair<K, uint64_t> >& counts, size_t maxNumOfEntries)
+{
+	if (maxNumOfEntries == 0 || maxNumOfEntries >= counts.size())
+	{
+		std::sort(counts.begin(), counts.end(), compareCounts<K>);
+		return;
+	}
+
+	std::partial_sort(counts.begin(), counts.begin() + maxNumOfEntries, counts.end(), compareCounts<K>);
+	counts.resize(maxNumOfEntries);
+}
+
+void HashCounter::merge(const HashCounter& other)
+{
+	std::vector<std::pair<uint64_t, uint64_t> > entries;
+	other.m_Counts.getEntries(entries);
+	m_Counts.reserve(m_Counts.size() + entries.size());
+	for (size_t i = 0; i < entries.size(); i++)
+		m_Counts[entries[i].first] += entries[i].second;
+
+	m_TotalCount += other.m_TotalCount;
+}
+
+void HashCounter::getSortedCounts(std::vector<std::pair<uint64_t, uint64_t> >& result, size_t maxNumOfEntries) const
+{
+	result.clear();
+	m_Counts.getEntries(result);
+	sortCounts(result, maxNumOfEntries);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~
+// CountMinSketch class
+// ~~~~~~~~~~~~~~~~~~~~~
+
+CountMinSketch::CountMinSketch(size_t width, size_t depth)
+{
+	m_Width = 1;
+	while (m_Width < width)
+		m_Width *= 2;
+	m_Depth = (depth == 0 ? 1 : depth);
+	m_Counters.resize(m_Width * m_Depth, 0);
+}
+
+void CountMinSketch::add(uint64_t hash, uint64_t count)
+{
+	// the rows are indexed by double hashing, so one hash of the key is enough for all of them
+	uint64_t step = hashInteger(hash) | 1;
+	size_t mask = m_Width - 1;
+	for (size_t row = 0; row < m_Depth; row++)
+	{
+		m_Counters[row * m_Width + ((size_t)hash & mask)] += count;
+		hash += step;
+	}
+}
+
+uint64_t CountMinSketch::estimate(uint64_t hash) const
+{
+	uint64_t step = hashInteger(hash) | 1;
+	size_t mask = m_Width - 1;
+	uint64_t result = (uint64_t)-1;
+	for (size_t row = 0; row < m_Depth; row++)
+	{
+		uint64_t counter = m_Counters[row * m_Width + ((size_t)hash & mask)];
+		if (counter < result)
+			result = counter;
+		hash += step;
+	}
+
+	return result;
+}
+
+bool CountMinSketch::merge(const CountMinSketch& other)
+{
+	if (other.m_Width != m_Width || other.m_Depth != m_Depth)
+		return false;
+
+	for (size_t i = 0; i < m_Counters.size(); i++)
+		m_Counters[i] += other.m_Counters[i];
+
+	return true;
+}
+
+void CountMinSketch::clear()
+{
+	m_Counters.assign(m_Counters.size(), 0);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~
+// HyperLogLog class
+// ~~~~~~~~~~~~~~~~~~
+
+HyperLogLog::HyperLogLog(int precision)
+{
+	if (precision < 4)
+		precision = 4;
+	else if (precision > 18)
+		precision = 18;
+
+	m_Precision = precision;
+	m_Registers.resize((size_t)1 << m_Precision, 0);
+}
+
+void HyperLogLog::add(uint64_t hash)
+{
+	size_t index = (size_t)(hash >> (64 - m_Precision));
+
+	// the rank is the position of the first 1 bit of the remaining bits. The guard bit bounds it by 64 - precision + 1
+	uint64_t remainingBits = (hash << m_Precision) | ((uint64_t)1 << (m_Precision - 1));
+	uint8_t rank = 1;
+	while ((remainingBits & 0x8000000000000000ULL) == 0)
+	{
+		rank++;
+		remainingBits <<= 1;
+	}
+
+	if (rank > m_Registers[index])
+		m_Registers[index] = rank;
+}
+
+uint64_t HyperLogLog::estimate() const
+{
+	double numOfRegisters = (double)m_Registers.size();
+	double sum = 0;
+	size_t numOfZeros = 0;
+	for (size_t i = 0; i < m_Registers.size(); i++)
+	{
+		sum += ldexp(1.0, -(int)m_Registers[i]);
+		if (m_Registers[i] == 0)
+			numOfZeros++;
+	}
+
+	double alpha;
+	if (m_Precision == 4)
+		alpha = 0.673;
+	else if (m_Precision == 5)
+		alpha = 0.697;
+	else if (m_Precision == 6)
+		alpha = 0.709;
+	else
+		alpha = 0.7213 / (1 + 1.079 / numOfRegisters);
+
+	double result = alpha * numOfRegisters * numOfRegisters / sum;
+
+	// linear counting is more accurate for small cardinalities. With 64-bit hashes no large range correction is needed
+	if (result <= 2.5 * numOfRegisters && numOfZeros > 0)
+		result = numOfRegisters * log(numOfRegisters / (double)numOfZeros);
+
+	return (uint64_t)(result + 0.5);
+}
+
+bool HyperLogLog::merge(const HyperLogLog& other)
+{
+	if (other.m_Precision != m_Precision)
+		return false;
+
+	for (size_t i = 0; i < m_Registers.size(); i++)
+	{
+		if (other.m_Registers[i] > m_Registers[i])
+			m_Registers[i] = other.m_Registers[i];
+	}
+
+	return true;
+}
+
+void HyperLogLog::clear()
+{
+	m_Registers.assign(m_Registers.size(), 0);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~
+// StringCounter class
+// ~~~~~~~~~~~~~~~~~~~~
+
+StringCounter::StringCounter(size_t maxNumOfStrings, size_t sketchWidth, size_t sketchDepth) :
+	m_Strings(maxNumOfStrings),
+	// the sketches are needed only when the number of strings is bounded, so otherwise they're kept at their minimal size
+	m_Overflow(maxNumOfStrings != 0 ? sketchWidth : 1, maxNumOfStrings != 0 ? sketchDepth : 1),
+	m_DistinctStrings(maxNumOfStrings != 0 ? 12 : 4)
+{
+	m_TotalCount = 0;
+	m_Overflowed = false;
+	m_MinCount = 0;
+}
+
+void StringCounter::add(const char* str, size_t len, uint64_t count)
+{
+	uint64_t hash = hashString(str, len);
+	m_TotalCount += count;
+
+	if (!isBounded())
+	{
+		uint32_t id = m_Strings.intern(str, len, hash);
+		if (id == m_Counts.size())
+			m_Counts.push_back(0);
+		m_Counts[id] += count;
+		return;
+	}
+
+	uint32_t id = m_Strings.find(str, len, hash);
+	if (id != StringTable::NotFound)
+	{
+		m_Counts[id] += count;
+		return;
+	}
+
+	m_DistinctStrings.add(hash);
+
+	if (m_Strings.size() < m_Strings.getMaxSize())
+	{
+		m_Strings.intern(str, len, hash);
+		m_Counts.push_back(count);
+		return;
+	}
+
+	addUntracked(str, len, hash, count);
+}
+
+void StringCounter::addUntracked(const char* str, size_t len, uint64_t hash, uint64_t count)
+{
+	m_Overflowed = true;
+	m_Overflow.add(hash, count);
+
+	uint64_t estimate = m_Overflow.estimate(hash);
+	if (estimate <= m_MinCount)
+		return;
+
+	uint32_t minId = findMinCount();
+	if (estimate <= m_MinCount)
+		return;
+
+	// the least frequent string moves to the sketch and the new string takes its place with its estimated count
+	const std::string& evicted = m_Strings.getString(minId);
+	m_Overflow.add(hashString(evicted.data(), evicted.length()), m_Counts[minId]);
+	m_Strings.reassign(minId, str, len, hash);
+	m_Counts[minId] = estimate;
+}
+
+uint32_t StringCounter::findMinCount()
+{
+	uint32_t minId = 0;
+	for (uint32_t id = 1; id < (uint32_t)m_Counts.size(); id++)
+	{
+		if (m_Counts[id] < m_Counts[minId])
+			minId = id;
+	}
+
+	m_MinCount = m_Counts[minId];
+	return minId;
+}
+
+uint64_t StringCounter::getCount(const char* str, size_t len) const
+{
+	uint64_t hash = hashString(str, len);
+	uint32_t id = m_Strings.find(str, len, hash);
+	if (id != StringTable::NotFound)
+		return m_Counts[id];
+
+	return (m_Overflowed ? m_Overflow.estimate(hash) : 0);
+}
+
+void StringCounter::merge(const StringCounter& other)
+{
+	uint64_t totalCount = m_TotalCount + other.m_TotalCount;
+
+	if (isBounded() && other.isBounded())
+	{
+		if (other.m_Overflowed && m_Overflow.merge(other.m_Overflow))
+			m_Overflowed = true;
+		m_DistinctStrings.merge(other.m_DistinctStrings);
+	}
+
+	for (uint32_t id = 0; id < (uint32_t)other.m_Counts.size(); id++)
+	{
+		const std::string& str = other.m_Strings.getString(id);
+		add(str.data(), str.length(), other.m_Counts[id]);
+	}
+
+	// the total includes the counts other kept only in its sketch
+	m_TotalCount = totalCount;
+}
+
+void StringCounter::getSortedCounts(std::vector<std::pair<std::string, uint64_t> >& result, size_t maxNumOfEntries) const
+{
+	result.clear();
+	result.reserve(m_Counts.size());
+	for (uint32_t id = 0; id < (uint32_t)m_Counts.size(); id++)
+		result.push_back(std::pair<std::string, uint64_t>(m_Strings.getString(id), m_Counts[id]));
+
+	sortCounts(result, maxNumOfEntries);
+}
+
+uint64_t StringCounter::getNumOfDistinctStrings() const
+{
+	if (!m_Overflowed)
+		return m_Strings.size();
+
+	uint64_t estimate = m_DistinctStrings.estimate();
+	return (estimate > m_Strings.size() ? estimate : m_Strings.size());
+}
+
+void StringCounter::clear()
+{
+	m_Strings.clear();
+	m_Counts.clear();
+	m_TotalCount = 0;
+	m_Overflow.clear();
+	m_DistinctStrings.clear();
+	m_Overflowed = false;
+	m_MinCount = 0;
+}
+
+} // namespace pcpp
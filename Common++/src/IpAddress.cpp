@@ -35,15 +35,28 @@ bool IPAddress::equals(const IPAddress* other)
 	return false;
 }
 
+size_t IPAddress::toString(char* buffer, size_t bufferLen) const
+{
+	if (!m_IsValid)
+		return 0;
+
+	size_t len = strlen(m_AddressAsString);
+	if (len >= bufferLen)
+		return 0;
+
+	memcpy(buffer, m_AddressAsString, len + 1);
+	return len;
+}
+
 IPAddress::Ptr_t IPAddress::fromString(char* addressAsString)
 {
-	in_addr ip4Addr;
-	in6_addr ip6Addr;
-	if (inet_pton(AF_INET, addressAsString, &ip4Addr) != 0)
+	uint8_t addr[16];
+	size_t len = strlen(addressAsString);
+	if (parse_ipv4_address(addressAsString, len, addr))
 	{
 		return IPAddress::Ptr_t(new IPv4Address(addressAsString));
 	}
-	else if (inet_pton(AF_INET6, addressAsString, &ip6Addr) != 0)
+	else if (parse_ipv6_address(addressAsString, len, addr))
 	{
 		return IPAddress::Ptr_t(new IPv6Address(addressAsString));
 	}
@@ -61,8 +74,7 @@ IPv4Address IPv4Address::Zero((uint32_t)0);
 
 IPv4Address::IPv4Address(const IPv4Address& other)
 {
-	m_pInAddr = new in_addr();
-	memcpy(m_pInAddr, other.m_pInAddr, sizeof(in_addr));
+	m_Address = other.m_Address;
 
 	strncpy(m_AddressAsString, other.m_AddressAsString, 40);
 	m_IsValid = other.m_IsValid;
@@ -70,22 +82,14 @@ IPv4Address::IPv4Address(const IPv4Address& other)
 
 IPv4Address::IPv4Address(uint32_t addressAsInt)
 {
-	m_pInAddr = new in_addr();
-	memcpy(m_pInAddr, &addressAsInt, sizeof(addressAsInt));
-	if (inet_ntop(AF_INET, m_pInAddr, m_AddressAsString, MAX_ADDR_STRING_LEN) == 0)
-		m_IsValid = false;
-	else
-		m_IsValid = true;
+	m_Address = addressAsInt;
+	m_IsValid = (format_ipv4_address((const uint8_t*)&m_Address, m_AddressAsString, MAX_ADDR_STRING_LEN) != 0);
 }
 
 IPv4Address::IPv4Address(in_addr* inAddr)
 {
-	m_pInAddr = new in_addr();
-	memcpy(m_pInAddr, inAddr, sizeof(in_addr));
-	if (inet_ntop(AF_INET, m_pInAddr, m_AddressAsString, MAX_ADDR_STRING_LEN) == 0)
-		m_IsValid = false;
-	else
-		m_IsValid = true;
+	memcpy(&m_Address, inAddr, sizeof(m_Address));
+	m_IsValid = (format_ipv4_address((const uint8_t*)&m_Address, m_AddressAsString, MAX_ADDR_STRING_LEN) != 0);
 }
 
 IPAddress* IPv4Address::clone() const
@@ -95,9 +99,10 @@ IPAddress* IPv4Address::clone() const
 
 void IPv4Address::init(const char* addressAsString)
 {
-	m_pInAddr = new in_addr();
-	if (inet_pton(AF_INET, addressAsString , m_pInAddr) == 0)
+	m_Address = 0;
+	if (!parse_ipv4_address(addressAsString, strlen(addressAsString), (uint8_t*)&m_Address))
 	{
+		m_Address = 0;
 		m_IsValid = false;
 		return;
 	}
@@ -109,7 +114,6 @@ void IPv4Address::init(const char* addressAsString)
 
 IPv4Address::~IPv4Address()
 {
-	delete m_pInAddr;
 }
 
 IPv4Address::IPv4Address(const char* addressAsString)
@@ -122,18 +126,9 @@ IPv4Address::IPv4Address(std::string addressAsString)
 	init((char*)addressAsString.c_str());
 }
 
-uint32_t IPv4Address::toInt() const
-{
-	uint32_t result;
-	memcpy(&result, m_pInAddr, sizeof(uint32_t));
-	return result;
-}
-
 IPv4Address& IPv4Address::operator=(const IPv4Address& other)
 {
-	if (m_pInAddr == NULL)
-		m_pInAddr = new in_addr();
-	memcpy(m_pInAddr, other.m_pInAddr, sizeof(in_addr));
+	m_Address = other.m_Address;
 
 	strncpy(m_AddressAsString, other.m_AddressAsString, 40);
 	m_IsValid = other.m_IsValid;
@@ -168,8 +163,7 @@ IPv6Address IPv6Address::Zero(std::string("0:0:0:0:0:0:0:0:0:0:0:0:0:0:0:0"));
 
 IPv6Address::IPv6Address(const IPv6Address& other)
 {
-	m_pInAddr = (in6_addr*)new uint8_t[sizeof(in6_addr)];
-	memcpy(m_pInAddr, other.m_pInAddr, sizeof(in6_addr));
+	memcpy(m_Address, other.m_Address, sizeof(m_Address));
 
 	strncpy(m_AddressAsString, other.m_AddressAsString, MAX_ADDR_STRING_LEN-1);
 	m_AddressAsString[MAX_ADDR_STRING_LEN - 1] = '\0';
@@ -178,7 +172,6 @@ IPv6Address::IPv6Address(const IPv6Address& other)
 
 IPv6Address::~IPv6Address()
 {
-	delete[] m_pInAddr;
 }
 
 IPAddress* IPv6Address::clone() const
@@ -188,9 +181,10 @@ IPAddress* IPv6Address::clone() const
 
 void IPv6Address::init(char* addressAsString)
 {
-	m_pInAddr = (in6_addr*)new uint8_t[sizeof(in6_addr)];
-	if (inet_pton(AF_INET6, addressAsString , m_pInAddr) == 0)
+	memset(m_Address, 0, sizeof(m_Address));
+	if (!parse_ipv6_address(addressAsString, strlen(addressAsString), (uint8_t*)m_Address))
 	{
+		memset(m_Address, 0, sizeof(m_Address));
 		m_IsValid = false;
 		return;
 	}
@@ -202,12 +196,8 @@ void IPv6Address::init(char* addressAsString)
 
 IPv6Address::IPv6Address(uint8_t* addressAsUintArr)
 {
-	m_pInAddr = (in6_addr*)new uint8_t[sizeof(in6_addr)];
-	memcpy(m_pInAddr, addressAsUintArr, 16);
-	if (inet_ntop(AF_INET6, m_pInAddr, m_AddressAsString, MAX_ADDR_STRING_LEN) == 0)
-		m_IsValid = false;
-	else
-		m_IsValid = true;
+	memcpy(m_Address, addressAsUintArr, 16);
+	m_IsValid = (format_ipv6_address((const uint8_t*)m_Address, m_AddressAsString, MAX_ADDR_STRING_LEN) != 0);
 }
 
 IPv6Address::IPv6Address(char* addressAsString)
@@ -224,17 +214,17 @@ void IPv6Address::copyTo(uint8_t** arr, size_t& length)
 {
 	length = 16;
 	(*arr) = new uint8_t[length];
-	memcpy((*arr), m_pInAddr, length);
+	memcpy((*arr), m_Address, length);
 }
 
 void IPv6Address::copyTo(uint8_t* arr) const
 {
-	memcpy(arr, m_pInAddr, 16);
+	memcpy(arr, m_Address, 16);
 }
 
 bool IPv6Address::operator==(const IPv6Address& other) const
 {
-	return (memcmp(m_pInAddr, other.m_pInAddr, 16) == 0);
+	return (memcmp(m_Address, other.m_Address, 16) == 0);
 }
 
 bool IPv6Address::operator!=(const IPv6Address& other)
@@ -244,9 +234,7 @@ bool IPv6Address::operator!=(const IPv6Address& other)
 
 IPv6Address& IPv6Address::operator=(const IPv6Address& other)
 {
-	if (m_pInAddr == NULL)
-		m_pInAddr = (in6_addr*)new uint8_t[sizeof(in6_addr)];
-	memcpy(m_pInAddr, other.m_pInAddr, sizeof(in6_addr));
+	memcpy(m_Address, other.m_Address, sizeof(m_Address));
 
 	strncpy(m_AddressAsString, other.m_AddressAsString, 40);
 	m_IsValid = other.m_IsValid;
@@ -254,4 +242,135 @@ IPv6Address& IPv6Address::operator=(const IPv6Address& other)
 	return *this;
 }
 
+IPAddressValue::IPAddressValue(const IPv4Address& addr)
+{
+	memset(m_Bytes, 0, sizeof(m_Bytes));
+	m_IPVersion = 0;
+	if (!addr.isValid())
+		return;
+
+	uint32_t addrAsInt = addr.toInt();
+	memcpy(m_Bytes, &addrAsInt, sizeof(addrAsInt));
+	m_IPVersion = 4;
+}
+
+IPAddressValue::IPAddressValue(const IPv6Address& addr)
+{
+	memset(m_Bytes, 0, sizeof(m_Bytes));
+	m_IPVersion = 0;
+	if (!addr.isValid())
+		return;
+
+	addr.copyTo(m_Bytes);
+	m_IPVersion = 6;
+}
+
+IPAddressValue::IPAddressValue(const IPAddress* addr)
+{
+	memset(m_Bytes, 0, sizeof(m_Bytes));
+	m_IPVersion = 0;
+	if (addr == NULL)
+		return;
+
+	if (addr->getType() == IPAddress::IPv4AddressType)
+		*this = IPAddressValue(*(const IPv4Address*)addr);
+	else
+		*this = IPAddressValue(*(const IPv6Address*)addr);
+}
+
+IPAddressValue IPAddressValue::fromIPv4(uint32_t addressAsInt)
+{
+	IPAddressValue result;
+	memcpy(result.m_Bytes, &addressAsInt, sizeof(addressAsInt));
+	result.m_IPVersion = 4;
+	return result;
+}
+
+IPAddressValue IPAddressValue::fromIPv6(const uint8_t* addressAsUintArr)
+{
+	IPAddressValue result;
+	memcpy(result.m_Bytes, addressAsUintArr, 16);
+	result.m_IPVersion = 6;
+	return result;
+}
+
+IPAddressValue IPAddressValue::fromString(const std::string& addressAsString)
+{
+	return fromString(addressAsString.c_str(), addressAsString.length());
+}
+
+IPAddressValue IPAddressValue::fromString(const char* addressAsString, size_t addressLen)
+{
+	IPAddressValue result;
+	if (parse_ipv4_address(addressAsString, addressLen, result.m_Bytes))
+		result.m_IPVersion = 4;
+	else if (parse_ipv6_address(addressAsString, addressLen, result.m_Bytes))
+		result.m_IPVersion = 6;
+
+	return result;
+}
+
+uint32_t IPAddressValue::toIPv4Int() const
+{
+	if (m_IPVersion != 4)
+		return 0;
+
+	uint32_t result;
+	memcpy(&result, m_Bytes, sizeof(result));
+	return result;
+}
+
+IPv4Address IPAddressValue::toIPv4Address() const
+{
+	if (m_IPVersion != 4)
+		return IPv4Address::Zero;
+
+	return IPv4Address(toIPv4Int());
+}
+
+IPv6Address IPAddressValue::toIPv6Address() const
+{
+	if (m_IPVersion != 6)
+		return IPv6Address::Zero;
+
+	return IPv6Address((uint8_t*)m_Bytes);
+}
+
+IPAddress::Ptr_t IPAddressValue::toIPAddress() const
+{
+	if (m_IPVersion == 4)
+		return IPAddress::Ptr_t(new IPv4Address(toIPv4Int()));
+	if (m_IPVersion == 6)
+		return IPAddress::Ptr_t(new IPv6Address((uint8_t*)m_Bytes));
+
+	return IPAddress::Ptr_t();
+}
+
+size_t IPAddressValue::toString(char* buffer, size_t bufferLen) const
+{
+	if (m_IPVersion == 4)
+		return format_ipv4_address(m_Bytes, buffer, bufferLen);
+	if (m_IPVersion == 6)
+		return format_ipv6_address(m_Bytes, buffer, bufferLen);
+
+	return 0;
+}
+
+std::string IPAddressValue::toString() const
+{
+	char buffer[MAX_ADDR_STRING_LEN];
+	size_t len = toString(buffer, sizeof(buffer));
+	return std::string(buffer, len);
+}
+
+uint32_t IPAddressValue::hash() const
+{
+	ScalarBuffer<uint8_t> vec[2];
+	vec[0].buffer = (uint8_t*)m_Bytes;
+	vec[0].len = getLength();
+	vec[1].buffer = (uint8_t*)&m_IPVersion;
+	vec[1].len = 1;
+	return fnv_hash(vec, 2);
+}
+
 } // namespace pcpp
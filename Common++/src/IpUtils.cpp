@@ -2,8 +2,16 @@
 
 #include "IpUtils.h"
 #include "Logger.h"
+#include "CpuFeatures.h"
 #include <string.h>
 #include <stdio.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PCPP_CHECKSUM_X86_KERNELS
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+#define PCPP_CHECKSUM_NEON_KERNEL
+#include <arm_neon.h>
+#endif
 #ifndef NS_INADDRSZ
 #define NS_INADDRSZ	4
 #endif
@@ -59,35 +67,161 @@ uint32_t in_addr2int(in_addr inAddr)
 #endif
 }
 
+// The checksum kernels below return the sum of all 16-bit words (in host byte order) of a buffer whose length is a multiple of 2.
+// The sum isn't folded so it can be larger than 16 bits. Summing wider words is equivalent because 2^16 = 1 (mod 2^16 - 1), which is
+// what the one's complement sum is taken modulo
+
+typedef uint64_t (*ChecksumKernel)(const uint8_t* data, size_t len);
+
+static uint64_t checksumKernelScalar(const uint8_t* data, size_t len)
+{
+	uint64_t sum = 0;
+	while (len >= 4)
+	{
+		uint32_t word;
+		memcpy(&word, data, sizeof(word));
+		sum += word;
+		data += 4;
+		len -= 4;
+	}
+
+	if (len >= 2)
+	{
+		uint16_t word;
+		memcpy(&word, data, sizeof(word));
+		sum += word;
+	}
+
+	return sum;
+}
+
+#if defined(PCPP_CHECKSUM_X86_KERNELS)
+
+// each 32-bit lane gains at most 2 * 0xffff per iteration, so lanes are flushed before they can overflow
+#define PCPP_CHECKSUM_MAX_ITERATIONS_PER_FLUSH 32768
+
+__attribute__((target("sse2")))
+static uint64_t checksumKernelSse2(const uint8_t* data, size_t len)
+{
+	uint64_t sum = 0;
+	const __m128i zero = _mm_setzero_si128();
+
+	while (len >= 16)
+	{
+		__m128i acc = _mm_setzero_si128();
+		size_t iterations = 0;
+		while (len >= 16 && iterations < PCPP_CHECKSUM_MAX_ITERATIONS_PER_FLUSH)
+		{
+			__m128i words = _mm_loadu_si128((const __m128i*)data);
+			acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_unpacklo_epi16(words, zero), _mm_unpackhi_epi16(words, zero)));
+			data += 16;
+			len -= 16;
+			iterations++;
+		}
+
+		uint32_t lanes[4];
+		_mm_storeu_si128((__m128i*)lanes, acc);
+		sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+
+	return sum + checksumKernelScalar(data, len);
+}
+
+__attribute__((target("avx2")))
+static uint64_t checksumKernelAvx2(const uint8_t* data, size_t len)
+{
+	uint64_t sum = 0;
+	const __m256i zero = _mm256_setzero_si256();
+
+	while (len >= 32)
+	{
+		__m256i acc = _mm256_setzero_si256();
+		size_t iterations = 0;
+		while (len >= 32 && iterations < PCPP_CHECKSUM_MAX_ITERATIONS_PER_FLUSH)
+		{
+			__m256i words = _mm256_loadu_si256((const __m256i*)data);
+			acc = _mm256_add_epi32(acc, _mm256_add_epi32(_mm256_unpacklo_epi16(words, zero), _mm256_unpackhi_epi16(words, zero)));
+			data += 32;
+			len -= 32;
+			iterations++;
+		}
+
+		uint32_t lanes[8];
+		_mm256_storeu_si256((__m256i*)lanes, acc);
+		for (int i = 0; i < 8; i++)
+			sum += lanes[i];
+	}
+
+	return sum + checksumKernelSse2(data, len);
+}
+
+#elif defined(PCPP_CHECKSUM_NEON_KERNEL)
+
+#define PCPP_CHECKSUM_MAX_ITERATIONS_PER_FLUSH 32768
+
+static uint64_t checksumKernelNeon(const uint8_t* data, size_t len)
+{
+	uint64_t sum = 0;
+
+	while (len >= 16)
+	{
+		uint32x4_t acc = vdupq_n_u32(0);
+		size_t iterations = 0;
+		while (len >= 16 && iterations < PCPP_CHECKSUM_MAX_ITERATIONS_PER_FLUSH)
+		{
+			// add each pair of adjacent 16-bit words into a 32-bit lane
+			acc = vpadalq_u16(acc, vreinterpretq_u16_u8(vld1q_u8(data)));
+			data += 16;
+			len -= 16;
+			iterations++;
+		}
+
+		sum += (uint64_t)vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+	}
+
+	return sum + checksumKernelScalar(data, len);
+}
+#endif
+
+static ChecksumKernel selectChecksumKernel()
+{
+#if defined(PCPP_CHECKSUM_X86_KERNELS)
+	if (CpuFeatures::hasAvx2())
+		return checksumKernelAvx2;
+	if (CpuFeatures::hasSse2())
+		return checksumKernelSse2;
+#elif defined(PCPP_CHECKSUM_NEON_KERNEL)
+	if (CpuFeatures::hasNeon())
+		return checksumKernelNeon;
+#endif
+	return checksumKernelScalar;
+}
+
 uint16_t compute_checksum(ScalarBuffer<uint16_t> vec[], size_t vecSize)
 {
+	static const ChecksumKernel checksumKernel = selectChecksumKernel();
+
 	uint32_t sum = 0;
 	for (size_t i = 0; i<vecSize; i++)
 	{
-		uint32_t local_sum = 0;
 		size_t buff_len = vec[i].len;
-		while (buff_len > 1) {
-			LOG_DEBUG("Value to add = 0x%4X", *(vec[i].buffer));
-			local_sum += *(vec[i].buffer);
-			++(vec[i].buffer);
-			buff_len -= 2;
-		}
-		LOG_DEBUG("Local sum = %d, 0x%4X", local_sum, local_sum);
+		const uint8_t* buffer = (const uint8_t*)vec[i].buffer;
 
-		if (buff_len == 1)
+		uint64_t local_sum = checksumKernel(buffer, buff_len & ~((size_t)1));
+
+		if (buff_len & 1)
 		{
-			uint8_t lastByte = *(vec[i].buffer);
+			uint8_t lastByte = buffer[buff_len - 1];
 			LOG_DEBUG("1 byte left, adding value: 0x%4X", lastByte);
 			local_sum += lastByte;
-			LOG_DEBUG("Local sum = %d, 0x%4X", local_sum, local_sum);
 		}
 
 		while (local_sum>>16) {
 			local_sum = (local_sum & 0xffff) + (local_sum >> 16);
 		}
-		local_sum = ntohs(local_sum);
-		LOG_DEBUG("Local sum = %d, 0x%4X", local_sum, local_sum);
-		sum += local_sum;
+		local_sum = ntohs((uint16_t)local_sum);
+		LOG_DEBUG("Local sum = %d, 0x%4X", (int)local_sum, (int)local_sum);
+		sum += (uint32_t)local_sum;
 	}
 
 	while (sum>>16) {
@@ -103,6 +237,26 @@ uint16_t compute_checksum(ScalarBuffer<uint16_t> vec[], size_t vecSize)
 	return ((uint16_t) sum);
 }
 
+uint16_t update_checksum(uint16_t checksum, uint16_t oldValue, uint16_t newValue)
+{
+	// RFC 1624 eqn. 3: HC' = ~(~HC + ~m + m')
+	uint32_t sum = (uint16_t)~checksum;
+	sum += (uint16_t)~oldValue;
+	sum += newValue;
+
+	while (sum>>16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return (uint16_t)~sum;
+}
+
+uint16_t update_checksum(uint16_t checksum, uint32_t oldValue, uint32_t newValue)
+{
+	checksum = update_checksum(checksum, (uint16_t)(oldValue >> 16), (uint16_t)(newValue >> 16));
+	return update_checksum(checksum, (uint16_t)(oldValue & 0xffff), (uint16_t)(newValue & 0xffff));
+}
+
 
 static const uint32_t FNV_PRIME = 16777619u;
 static const uint32_t OFFSET_BASIS = 2166136261u;
@@ -129,6 +283,273 @@ uint32_t fnv_hash(uint8_t* buffer, size_t bufSize)
 	return fnv_hash(&scalarBuf, 1);
 }
 
+static const char hexDigitsLower[] = "0123456789abcdef";
+
+// returns the value of a hex digit or -1 if the character isn't a hex digit
+static inline int hexDigitValue(char ch)
+{
+	if (ch >= '0' && ch <= '9')
+		return ch - '0';
+	if (ch >= 'a' && ch <= 'f')
+		return ch - 'a' + 10;
+	if (ch >= 'A' && ch <= 'F')
+		return ch - 'A' + 10;
+	return -1;
+}
+
+static inline char* writeDecimalOctet(uint8_t octet, char* pos)
+{
+	if (octet >= 100)
+	{
+		*pos++ = (char)('0' + octet / 100);
+		*pos++ = (char)('0' + (octet / 10) % 10);
+	}
+	else if (octet >= 10)
+		*pos++ = (char)('0' + octet / 10);
+
+	*pos++ = (char)('0' + octet % 10);
+	return pos;
+}
+
+size_t format_ipv4_address(const uint8_t* addr, char* buffer, size_t bufferLen)
+{
+	if (bufferLen < sizeof("255.255.255.255"))
+		return 0;
+
+	char* pos = buffer;
+	for (int i = 0; i < 4; i++)
+	{
+		pos = writeDecimalOctet(addr[i], pos);
+		*pos++ = (i < 3 ? '.' : '\0');
+	}
+
+	return (size_t)(pos - buffer - 1);
+}
+
+size_t format_ipv6_address(const uint8_t* addr, char* buffer, size_t bufferLen)
+{
+	// the longest representation is 8 groups of 4 digits and 7 colons
+	if (bufferLen < sizeof("ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"))
+		return 0;
+
+	uint16_t words[8];
+	for (int i = 0; i < 8; i++)
+		words[i] = (uint16_t)((addr[2*i] << 8) | addr[2*i + 1]);
+
+	// find the first longest run of zero groups (at least 2 groups long) to replace with "::"
+	int bestBase = -1, bestLen = 0, curBase = -1, curLen = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		if (words[i] == 0)
+		{
+			if (curBase == -1)
+				curBase = i;
+			curLen++;
+			if (curLen > bestLen)
+			{
+				bestBase = curBase;
+				bestLen = curLen;
+			}
+		}
+		else
+		{
+			curBase = -1;
+			curLen = 0;
+		}
+	}
+
+	if (bestLen < 2)
+		bestBase = -1;
+
+	char* pos = buffer;
+	for (int i = 0; i < 8; i++)
+	{
+		if (bestBase != -1 && i >= bestBase && i < bestBase + bestLen)
+		{
+			if (i == bestBase)
+				*pos++ = ':';
+			continue;
+		}
+
+		if (i != 0)
+			*pos++ = ':';
+
+		// IPv4-compatible and IPv4-mapped addresses end with a dotted IPv4 address, the same as inet_ntop() does
+		if (i == 6 && bestBase == 0 && (bestLen == 6 || (bestLen == 5 && words[5] == 0xffff)))
+		{
+			pos += format_ipv4_address(addr + 12, pos, bufferLen - (pos - buffer));
+			return (size_t)(pos - buffer);
+		}
+
+		uint16_t word = words[i];
+		bool started = false;
+		for (int shift = 12; shift >= 0; shift -= 4)
+		{
+			int digit = (word >> shift) & 0xf;
+			if (digit != 0 || started || shift == 0)
+			{
+				*pos++ = hexDigitsLower[digit];
+				started = true;
+			}
+		}
+	}
+
+	if (bestBase != -1 && bestBase + bestLen == 8)
+		*pos++ = ':';
+
+	*pos = '\0';
+	return (size_t)(pos - buffer);
+}
+
+bool parse_ipv4_address(const char* str, size_t strLen, uint8_t* result)
+{
+	if (str == NULL)
+		return false;
+
+	const char* end = str + strLen;
+	uint8_t octets[4];
+	for (int i = 0; i < 4; i++)
+	{
+		if (i > 0)
+		{
+			if (str == end || *str != '.')
+				return false;
+			str++;
+		}
+
+		// 1 to 3 digits, without leading zeros
+		int value = 0, numOfDigits = 0;
+		while (str != end && *str >= '0' && *str <= '9')
+		{
+			if (numOfDigits > 0 && value == 0)
+				return false;
+
+			value = value * 10 + (*str - '0');
+			if (value > 255)
+				return false;
+
+			numOfDigits++;
+			str++;
+		}
+
+		if (numOfDigits == 0)
+			return false;
+
+		octets[i] = (uint8_t)value;
+	}
+
+	if (str != end)
+		return false;
+
+	memcpy(result, octets, sizeof(octets));
+	return true;
+}
+
+bool parse_ipv6_address(const char* str, size_t strLen, uint8_t* result)
+{
+	if (str == NULL)
+		return false;
+
+	const char* end = str + strLen;
+	uint8_t tmp[16];
+	memset(tmp, 0, sizeof(tmp));
+	uint8_t* tp = tmp;
+	uint8_t* tmpEnd = tmp + sizeof(tmp);
+	// the position of "::" in the result
+	uint8_t* colonp = NULL;
+
+	// a leading "::" requires special handling
+	if (str != end && *str == ':')
+	{
+		str++;
+		if (str == end || *str != ':')
+			return false;
+	}
+
+	const char* curTok = str;
+	bool sawXDigit = false;
+	int numOfXDigits = 0;
+	uint32_t val = 0;
+	while (str != end)
+	{
+		char ch = *str++;
+		int digit = hexDigitValue(ch);
+		if (digit != -1)
+		{
+			if (++numOfXDigits > 4)
+				return false;
+
+			val = (val << 4) | (uint32_t)digit;
+			sawXDigit = true;
+			continue;
+		}
+
+		if (ch == ':')
+		{
+			curTok = str;
+			if (!sawXDigit)
+			{
+				if (colonp != NULL)
+					return false;
+
+				colonp = tp;
+				continue;
+			}
+
+			// a single trailing colon
+			if (str == end)
+				return false;
+
+			if (tp + 2 > tmpEnd)
+				return false;
+
+			*tp++ = (uint8_t)(val >> 8);
+			*tp++ = (uint8_t)val;
+			sawXDigit = false;
+			numOfXDigits = 0;
+			val = 0;
+			continue;
+		}
+
+		// an IPv4 address in the last 4 bytes
+		if (ch == '.' && tp + 4 <= tmpEnd && parse_ipv4_address(curTok, end - curTok, tp))
+		{
+			tp += 4;
+			sawXDigit = false;
+			break;
+		}
+
+		return false;
+	}
+
+	if (sawXDigit)
+	{
+		if (tp + 2 > tmpEnd)
+			return false;
+
+		*tp++ = (uint8_t)(val >> 8);
+		*tp++ = (uint8_t)val;
+	}
+
+	if (colonp != NULL)
+	{
+		// "::" must stand for at least one zero group
+		if (tp == tmpEnd)
+			return false;
+
+		size_t numOfBytesAfterColons = tp - colonp;
+		memmove(tmpEnd - numOfBytesAfterColons, colonp, numOfBytesAfterColons);
+		memset(colonp, 0, tmpEnd - numOfBytesAfterColons - colonp);
+		tp = tmpEnd;
+	}
+
+	if (tp != tmpEnd)
+		return false;
+
+	memcpy(result, tmp, sizeof(tmp));
+	return true;
+}
+
 } // namespace pcpp
 
 #if defined(WIN32) && !defined(_MSC_VER)
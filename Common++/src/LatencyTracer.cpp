@@ -0,0 +1,336 @@
+#include "LatencyTracer.h"
+#include "AtomicUtils.h"
+#include "TablePrinter.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+#if defined(_MSC_VER)
+#define PCPP_LATENCY_THREAD_LOCAL __declspec(thread)
+#else
+#define PCPP_LATENCY_THREAD_LOCAL __thread
+#endif
+
+namespace pcpp
+{
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+// LatencyHistogram members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+
+LatencyHistogram::LatencyHistogram()
+{
+	reset();
+}
+
+void LatencyHistogram::reset()
+{
+	for (size_t i = 0; i < PCPP_LATENCY_HISTOGRAM_NUM_OF_BUCKETS; i++)
+		atomicStoreRelaxed(&m_Counts[i], 0);
+	atomicStoreRelaxed(&m_TotalCount, 0);
+	atomicStoreRelaxed(&m_Sum, 0);
+	atomicStoreRelaxed(&m_Min, (uint64_t)-1);
+	atomicStoreRelaxed(&m_Max, 0);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+	for (size_t i = 0; i < PCPP_LATENCY_HISTOGRAM_NUM_OF_BUCKETS; i++)
+	{
+		uint64_t count = other.getBucketCount(i);
+		if (count > 0)
+			atomicStoreRelaxed(&m_Counts[i], atomicLoadRelaxed(&m_Counts[i]) + count);
+	}
+
+	atomicStoreRelaxed(&m_TotalCount, atomicLoadRelaxed(&m_TotalCount) + other.getCount());
+	atomicStoreRelaxed(&m_Sum, atomicLoadRelaxed(&m_Sum) + atomicLoadRelaxed(&other.m_Sum));
+	uint64_t otherMin = atomicLoadRelaxed(&other.m_Min);
+	if (otherMin < atomicLoadRelaxed(&m_Min))
+		atomicStoreRelaxed(&m_Min, otherMin);
+	uint64_t otherMax = other.getMax();
+	if (otherMax > atomicLoadRelaxed(&m_Max))
+		atomicStoreRelaxed(&m_Max, otherMax);
+}
+
+uint64_t LatencyHistogram::getMin() const
+{
+	return (getCount() == 0 ? 0 : atomicLoadRelaxed(&m_Min));
+}
+
+double LatencyHistogram::getMean() const
+{
+	uint64_t count = getCount();
+	return (count == 0 ? 0 : (double)atomicLoadRelaxed(&m_Sum) / (double)count);
+}
+
+uint64_t LatencyHistogram::getValueAtPercentile(double percentile) const
+{
+	uint64_t totalCount = getCount();
+	if (totalCount == 0)
+		return 0;
+
+	if (percentile > 100)
+		percentile = 100;
+
+	// the rank of the value, rounded up, and at least the first value
+	uint64_t rank = (uint64_t)(percentile * (double)totalCount / 100.0 + 0.5);
+	if (rank == 0)
+		rank = 1;
+
+	uint64_t maxValue = getMax();
+	uint64_t countSoFar = 0;
+	for (size_t i = 0; i < PCPP_LATENCY_HISTOGRAM_NUM_OF_BUCKETS; i++)
+	{
+		countSoFar += getBucketCount(i);
+		if (countSoFar >= rank)
+		{
+			uint64_t value = getBucketHighestValue(i);
+			return (value < maxValue ? value : maxValue);
+		}
+	}
+
+	// the counters were updated while they were read
+	return maxValue;
+}
+
+uint64_t LatencyHistogram::getBucketLowestValue(size_t bucket)
+{
+	const size_t subBucketCount = (size_t)1 << PCPP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+	if (bucket < 2 * subBucketCount)
+		return bucket;
+
+	int shift = (int)(bucket >> PCPP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS) - 1;
+	uint64_t mantissa = (bucket & (subBucketCount - 1)) + subBucketCount;
+	return mantissa << shift;
+}
+
+uint64_t LatencyHistogram::getBucketHighestValue(size_t bucket)
+{
+	const size_t subBucketCount = (size_t)1 << PCPP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+	if (bucket < 2 * subBucketCount)
+		return bucket;
+
+	// the last bucket also counts all values which are too large for the histogram
+	if (bucket == PCPP_LATENCY_HISTOGRAM_NUM_OF_BUCKETS - 1)
+		return (uint64_t)-1;
+
+	int shift = (int)(bucket >> PCPP_LATENCY_HISTOGRAM_SUB_BUCKET_BITS) - 1;
+	uint64_t mantissa = (bucket & (subBucketCount - 1)) + subBucketCount;
+	return ((mantissa + 1) << shift) - 1;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~
+// LatencyTracer members
+// ~~~~~~~~~~~~~~~~~~~~~~
+
+// the histograms and the RX time of a single thread
+struct LatencyThreadData
+{
+	LatencyHistogram histograms[PCPP_LATENCY_TRACER_MAX_STAGES];
+	uint64_t lastRxCycles;
+	int threadIndex;
+};
+
+static LatencyThreadData* latencyThreadData[PCPP_LATENCY_TRACER_MAX_THREADS];
+static volatile int numOfLatencyThreads = 0;
+static pthread_mutex_t latencyThreadsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static PCPP_LATENCY_THREAD_LOCAL LatencyThreadData* currentLatencyThreadData = NULL;
+// set when all thread slots are taken, so the thread doesn't try to register on every call
+static PCPP_LATENCY_THREAD_LOCAL bool latencyThreadRegistrationFailed = false;
+
+static const char* latencyStageNames[PCPP_LATENCY_TRACER_MAX_STAGES] =
+{
+	"parse",
+	"rx-to-parse",
+	"tcp-reassembly-callback",
+	"rx-to-tcp-reassembly-callback",
+	"tx",
+	"rx-to-tx"
+};
+
+static LatencyThreadData* getCurrentLatencyThreadData()
+{
+	LatencyThreadData* data = currentLatencyThreadData;
+	if (data != NULL || latencyThreadRegistrationFailed)
+		return data;
+
+	pthread_mutex_lock(&latencyThreadsMutex);
+
+	int numOfThreads = atomicLoadAcquire(&numOfLatencyThreads);
+	if (numOfThreads < PCPP_LATENCY_TRACER_MAX_THREADS)
+	{
+		data = new LatencyThreadData();
+		data->lastRxCycles = 0;
+		data->threadIndex = numOfThreads;
+		latencyThreadData[numOfThreads] = data;
+		// readers only look at the threads below the count, so the count is published after the thread data
+		atomicStoreRelease(&numOfLatencyThreads, numOfThreads + 1);
+	}
+
+	pthread_mutex_unlock(&latencyThreadsMutex);
+
+	currentLatencyThreadData = data;
+	latencyThreadRegistrationFailed = (data == NULL);
+	return data;
+}
+
+void LatencyTracer::markRx(uint64_t cycles)
+{
+	LatencyThreadData* data = getCurrentLatencyThreadData();
+	if (data != NULL)
+		data->lastRxCycles = cycles;
+}
+
+void LatencyTracer::recordStage(int stage, uint64_t startCycles, uint64_t endCycles, int sinceRxStage)
+{
+	LatencyThreadData* data = getCurrentLatencyThreadData();
+	if (data == NULL)
+		return;
+
+	// the TSCs of different cores may be slightly apart, so a thread moved between cores may see time going backwards
+	if (stage >= 0 && stage < PCPP_LATENCY_TRACER_MAX_STAGES)
+		data->histograms[stage].record(endCycles > startCycles ? endCycles - startCycles : 0);
+
+	if (sinceRxStage >= 0 && sinceRxStage < PCPP_LATENCY_TRACER_MAX_STAGES && data->lastRxCycles != 0)
+		data->histograms[sinceRxStage].record(endCycles > data->lastRxCycles ? endCycles - data->lastRxCycles : 0);
+}
+
+int LatencyTracer::registerCurrentThread()
+{
+	LatencyThreadData* data = getCurrentLatencyThreadData();
+	return (data != NULL ? data->threadIndex : -1);
+}
+
+int LatencyTracer::getNumOfThreads()
+{
+	return atomicLoadAcquire(&numOfLatencyThreads);
+}
+
+int LatencyTracer::getCurrentThreadIndex()
+{
+	return (currentLatencyThreadData != NULL ? currentLatencyThreadData->threadIndex : -1);
+}
+
+const LatencyHistogram* LatencyTracer::getThreadHistogram(int threadIndex, int stage)
+{
+	if (threadIndex < 0 || threadIndex >= atomicLoadAcquire(&numOfLatencyThreads) || stage < 0 || stage >= PCPP_LATENCY_TRACER_MAX_STAGES)
+		return NULL;
+
+	return &latencyThreadData[threadIndex]->histograms[stage];
+}
+
+bool LatencyTracer::getAggregatedHistogram(int stage, LatencyHistogram& result)
+{
+	if (stage < 0 || stage >= PCPP_LATENCY_TRACER_MAX_STAGES)
+		return false;
+
+	result.reset();
+	int numOfThreads = atomicLoadAcquire(&numOfLatencyThreads);
+	for (int i = 0; i < numOfThreads; i++)
+		result.merge(latencyThreadData[i]->histograms[stage]);
+
+	return true;
+}
+
+void LatencyTracer::reset()
+{
+	int numOfThreads = atomicLoadAcquire(&numOfLatencyThreads);
+	for (int i = 0; i < numOfThreads; i++)
+	{
+		for (int stage = 0; stage < PCPP_LATENCY_TRACER_MAX_STAGES; stage++)
+			latencyThreadData[i]->histograms[stage].reset();
+	}
+}
+
+bool LatencyTracer::setStageName(int stage, const char* name)
+{
+	if (stage < 0 || stage >= PCPP_LATENCY_TRACER_MAX_STAGES)
+		return false;
+
+	latencyStageNames[stage] = name;
+	return true;
+}
+
+const char* LatencyTracer::getStageName(int stage)
+{
+	if (stage < 0 || stage >= PCPP_LATENCY_TRACER_MAX_STAGES)
+		return NULL;
+
+	return latencyStageNames[stage];
+}
+
+double LatencyTracer::cyclesToNs(uint64_t cycles)
+{
+	uint64_t frequency = TimestampClock::getTscFrequency();
+	if (frequency == 0)
+		return (double)cycles;
+
+	return (double)cycles * 1e9 / (double)frequency;
+}
+
+void LatencyTracer::printSummary()
+{
+	std::vector<std::string> columnNames;
+	columnNames.push_back("Stage");
+	columnNames.push_back("Count");
+	columnNames.push_back("Min (ns)");
+	columnNames.push_back("Mean (ns)");
+	columnNames.push_back("p50 (ns)");
+	columnNames.push_back("p99 (ns)");
+	columnNames.push_back("p99.9 (ns)");
+	columnNames.push_back("Max (ns)");
+
+	std::vector<int> columnWidths;
+	columnWidths.push_back(30);
+	for (size_t i = 1; i < columnNames.size(); i++)
+		columnWidths.push_back(12);
+
+	TablePrinter printer(columnNames, columnWidths);
+
+	double nsPerCycle = cyclesToNs(1000000) / 1000000;
+
+	// the histogram is large, so it's allocated on the heap rather than on the stack
+	LatencyHistogram* histogram = new LatencyHistogram();
+	for (int stage = 0; stage < PCPP_LATENCY_TRACER_MAX_STAGES; stage++)
+	{
+		getAggregatedHistogram(stage, *histogram);
+		if (histogram->getCount() == 0)
+			continue;
+
+		char stageName[32];
+		if (latencyStageNames[stage] != NULL)
+			snprintf(stageName, sizeof(stageName), "%s", latencyStageNames[stage]);
+		else
+			snprintf(stageName, sizeof(stageName), "stage-%d", stage);
+
+		char values[7][24];
+		snprintf(values[0], sizeof(values[0]), "%llu", (unsigned long long)histogram->getCount());
+		snprintf(values[1], sizeof(values[1]), "%.0f", histogram->getMin() * nsPerCycle);
+		snprintf(values[2], sizeof(values[2]), "%.0f", histogram->getMean() * nsPerCycle);
+		snprintf(values[3], sizeof(values[3]), "%.0f", histogram->getValueAtPercentile(50) * nsPerCycle);
+		snprintf(values[4], sizeof(values[4]), "%.0f", histogram->getValueAtPercentile(99) * nsPerCycle);
+		snprintf(values[5], sizeof(values[5]), "%.0f", histogram->getValueAtPercentile(99.9) * nsPerCycle);
+		snprintf(values[6], sizeof(values[6]), "%.0f", histogram->getMax() * nsPerCycle);
+
+		const char* row[8] = { stageName, values[0], values[1], values[2], values[3], values[4], values[5], values[6] };
+		printer.printRow(row, 8);
+	}
+
+	printer.closeTable();
+	delete histogram;
+}
+
+bool LatencyTracer::isTracingCompiledIn()
+{
+#ifdef PCPP_ENABLE_LATENCY_TRACING
+	return true;
+#else
+	return false;
+#endif
+}
+
+} // namespace pcpp
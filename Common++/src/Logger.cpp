@@ -1,11 +1,368 @@
 #include "Logger.h"
+#include "AtomicUtils.h"
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <time.h>
+#endif
+
+// the maximum length of a queued message, including the terminating null character. Longer messages are truncated
+#define PCPP_ASYNC_LOG_MESSAGE_LEN 256
 
 namespace pcpp
 {
 
-LoggerPP::LoggerPP() : m_ErrorString(NULL), m_ErrorStringLen(0), m_SuppressErrors(false)
+bool LoggerPP::s_SuppressErrors = false;
+bool LoggerPP::s_AsyncLogging = false;
+LoggerPP::LogLevel LoggerPP::s_LogModulesArray[NumOfLogModules];
+
+LoggerPP::LoggerPP() : m_ErrorString(NULL), m_ErrorStringLen(0)
 {
 	for (int i = 0; i<NumOfLogModules; i++)
-		m_LogModulesArray[i] = Normal;
+		s_LogModulesArray[i] = Normal;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+// Async logging internals
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+
+struct AsyncLogEntry
+{
+	LoggerPP::LogLevel level;
+	char text[PCPP_ASYNC_LOG_MESSAGE_LEN];
+};
+
+// a single-producer single-consumer ring owned by one logging thread. head and tail are ever-increasing counters: head is written
+// only by the owner thread and tail only by the background thread
+struct AsyncLogRing
+{
+	AsyncLogEntry* entries;
+	size_t capacity;
+	volatile size_t head;
+	volatile size_t tail;
+	// set when the owner thread exits, the background thread frees the ring once it's drained
+	volatile size_t ownerExited;
+	AsyncLogRing* next;
+
+	// rate limiting state, accessed only by the owner thread (and by stopAsyncLogging() after the background thread stopped)
+	LoggerPP::LogLevel lastLevel;
+	char lastText[PCPP_ASYNC_LOG_MESSAGE_LEN];
+	uint64_t lastSummaryTimeMs;
+	uint64_t repeatCount;
+
+	// statistics, written only by the owner thread
+	uint64_t numOfDropped;
+	uint64_t numOfSuppressed;
+};
+
+static pthread_once_t asyncLogKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t asyncLogKey;
+static pthread_mutex_t asyncLogMutex = PTHREAD_MUTEX_INITIALIZER;
+static AsyncLogRing* asyncLogRings = NULL;
+static pthread_t asyncLogThread;
+static volatile size_t asyncLogStopRequested = 0;
+static size_t asyncLogRingCapacity = 1024;
+static uint32_t asyncLogRateLimitMs = 1000;
+// statistics of rings which were already freed
+static uint64_t asyncLogNumOfDroppedInFreedRings = 0;
+static uint64_t asyncLogNumOfSuppressedInFreedRings = 0;
+
+static uint64_t getCurrentTimeMs()
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	return (uint64_t)GetTickCount();
+#else
+	timeval now;
+	gettimeofday(&now, NULL);
+	return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_usec / 1000;
+#endif
+}
+
+static void sleepOneMs()
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	Sleep(1);
+#else
+	timespec interval;
+	interval.tv_sec = 0;
+	interval.tv_nsec = 1000000;
+	nanosleep(&interval, NULL);
+#endif
+}
+
+static void onLoggingThreadExit(void* ringPtr);
+
+static void createAsyncLogKey()
+{
+	pthread_key_create(&asyncLogKey, onLoggingThreadExit);
+}
+
+static AsyncLogRing* getThreadRing()
+{
+	pthread_once(&asyncLogKeyOnce, createAsyncLogKey);
+	AsyncLogRing* ring = (AsyncLogRing*)pthread_getspecific(asyncLogKey);
+	if (ring != NULL)
+		return ring;
+
+	ring = new AsyncLogRing();
+	memset(ring, 0, sizeof(AsyncLogRing));
+
+	pthread_mutex_lock(&asyncLogMutex);
+	ring->capacity = asyncLogRingCapacity;
+	ring->entries = new AsyncLogEntry[ring->capacity];
+	ring->next = asyncLogRings;
+	asyncLogRings = ring;
+	pthread_mutex_unlock(&asyncLogMutex);
+
+	pthread_setspecific(asyncLogKey, ring);
+	return ring;
+}
+
+static void pushEntry(AsyncLogRing* ring, LoggerPP::LogLevel level, const char* text)
+{
+	size_t head = ring->head;
+	if (head - atomicLoadAcquire(&ring->tail) >= ring->capacity)
+	{
+		ring->numOfDropped++;
+		return;
+	}
+
+	AsyncLogEntry& entry = ring->entries[head % ring->capacity];
+	entry.level = level;
+	strncpy(entry.text, text, PCPP_ASYNC_LOG_MESSAGE_LEN - 1);
+	entry.text[PCPP_ASYNC_LOG_MESSAGE_LEN - 1] = '\0';
+	atomicStoreRelease(&ring->head, head + 1);
+}
+
+static void pushRepeatSummary(AsyncLogRing* ring)
+{
+	char summary[PCPP_ASYNC_LOG_MESSAGE_LEN];
+	snprintf(summary, sizeof(summary), "Last message repeated %lu more times\n", (unsigned long)ring->repeatCount);
+	pushEntry(ring, ring->lastLevel, summary);
+	ring->repeatCount = 0;
+}
+
+// must be called with asyncLogMutex locked, after the ring was unlinked from asyncLogRings
+static void freeRing(AsyncLogRing* ring)
+{
+	asyncLogNumOfDroppedInFreedRings += ring->numOfDropped;
+	asyncLogNumOfSuppressedInFreedRings += ring->numOfSuppressed;
+	delete [] ring->entries;
+	delete ring;
+}
+
+// called by the owner thread when it exits
+static void onLoggingThreadExit(void* ringPtr)
+{
+	AsyncLogRing* ring = (AsyncLogRing*)ringPtr;
+	if (ring->repeatCount > 0)
+		pushRepeatSummary(ring);
+	atomicStoreRelease(&ring->ownerExited, 1);
+}
+
+static void printEntry(const AsyncLogEntry& entry)
+{
+	fputs(entry.text, (entry.level == LoggerPP::Debug ? stdout : stderr));
+}
+
+// print all queued messages and free rings of threads which exited. Returns the number of messages printed
+static size_t drainRings()
+{
+	size_t numOfPrinted = 0;
+
+	pthread_mutex_lock(&asyncLogMutex);
+
+	AsyncLogRing** ringPtr = &asyncLogRings;
+	while (*ringPtr != NULL)
+	{
+		AsyncLogRing* ring = *ringPtr;
+		bool ownerExited = (atomicLoadAcquire(&ring->ownerExited) != 0);
+		size_t head = atomicLoadAcquire(&ring->head);
+		size_t tail = ring->tail;
+		for (; tail != head; tail++)
+		{
+			printEntry(ring->entries[tail % ring->capacity]);
+			numOfPrinted++;
+		}
+		atomicStoreRelease(&ring->tail, tail);
+
+		if (ownerExited)
+		{
+			*ringPtr = ring->next;
+			freeRing(ring);
+		}
+		else
+			ringPtr = &ring->next;
+	}
+
+	pthread_mutex_unlock(&asyncLogMutex);
+
+	if (numOfPrinted > 0)
+	{
+		fflush(stdout);
+		fflush(stderr);
+	}
+
+	return numOfPrinted;
 }
+
+static void* asyncLogThreadMain(void*)
+{
+	while (true)
+	{
+		bool stopRequested = (atomicLoadAcquire(&asyncLogStopRequested) != 0);
+
+		size_t numOfPrinted = drainRings();
+
+		// one last pass was done after the stop request was seen
+		if (stopRequested)
+			break;
+
+		if (numOfPrinted == 0)
+			sleepOneMs();
+	}
+
+	return NULL;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Async logging public API
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+bool LoggerPP::startAsyncLogging(size_t ringCapacity, uint32_t rateLimitIntervalMs)
+{
+	if (s_AsyncLogging)
+		return true;
+
+	pthread_mutex_lock(&asyncLogMutex);
+	asyncLogRingCapacity = (ringCapacity > 0 ? ringCapacity : 1);
+	asyncLogRateLimitMs = rateLimitIntervalMs;
+	for (AsyncLogRing* ring = asyncLogRings; ring != NULL; ring = ring->next)
+	{
+		ring->numOfDropped = 0;
+		ring->numOfSuppressed = 0;
+	}
+	asyncLogNumOfDroppedInFreedRings = 0;
+	asyncLogNumOfSuppressedInFreedRings = 0;
+	pthread_mutex_unlock(&asyncLogMutex);
+
+	atomicStoreRelease(&asyncLogStopRequested, 0);
+	if (pthread_create(&asyncLogThread, NULL, asyncLogThreadMain, NULL) != 0)
+	{
+		fprintf(stderr, "Couldn't create the async logging thread\n");
+		return false;
+	}
+
+	s_AsyncLogging = true;
+	return true;
+}
+
+void LoggerPP::stopAsyncLogging()
+{
+	if (!s_AsyncLogging)
+		return;
+
+	s_AsyncLogging = false;
+	atomicStoreRelease(&asyncLogStopRequested, 1);
+	pthread_join(asyncLogThread, NULL);
+
+	// print summaries of messages which were still being repeated
+	pthread_mutex_lock(&asyncLogMutex);
+	for (AsyncLogRing* ring = asyncLogRings; ring != NULL; ring = ring->next)
+	{
+		if (ring->repeatCount == 0)
+			continue;
+
+		AsyncLogEntry entry;
+		entry.level = ring->lastLevel;
+		snprintf(entry.text, sizeof(entry.text), "Last message repeated %lu more times\n", (unsigned long)ring->repeatCount);
+		printEntry(entry);
+		ring->repeatCount = 0;
+	}
+
+	// free the ring of the calling thread, otherwise it lives as long as the thread. Rings of other threads are freed when they exit
+	pthread_once(&asyncLogKeyOnce, createAsyncLogKey);
+	AsyncLogRing* ownRing = (AsyncLogRing*)pthread_getspecific(asyncLogKey);
+	if (ownRing != NULL)
+	{
+		for (AsyncLogRing** ringPtr = &asyncLogRings; *ringPtr != NULL; ringPtr = &(*ringPtr)->next)
+		{
+			if (*ringPtr == ownRing)
+			{
+				*ringPtr = ownRing->next;
+				break;
+			}
+		}
+		freeRing(ownRing);
+		pthread_setspecific(asyncLogKey, NULL);
+	}
+	pthread_mutex_unlock(&asyncLogMutex);
+
+	fflush(stdout);
+	fflush(stderr);
+}
+
+uint64_t LoggerPP::getNumOfDroppedMessages() const
+{
+	pthread_mutex_lock(&asyncLogMutex);
+	uint64_t result = asyncLogNumOfDroppedInFreedRings;
+	for (AsyncLogRing* ring = asyncLogRings; ring != NULL; ring = ring->next)
+		result += ring->numOfDropped;
+	pthread_mutex_unlock(&asyncLogMutex);
+	return result;
+}
+
+uint64_t LoggerPP::getNumOfSuppressedRepeats() const
+{
+	pthread_mutex_lock(&asyncLogMutex);
+	uint64_t result = asyncLogNumOfSuppressedInFreedRings;
+	for (AsyncLogRing* ring = asyncLogRings; ring != NULL; ring = ring->next)
+		result += ring->numOfSuppressed;
+	pthread_mutex_unlock(&asyncLogMutex);
+	return result;
+}
+
+void LoggerPP::logAsync(LogLevel level, const char* format, ...)
+{
+	char text[PCPP_ASYNC_LOG_MESSAGE_LEN];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+
+	AsyncLogRing* ring = getThreadRing();
+
+	if (asyncLogRateLimitMs > 0 && level == ring->lastLevel && strcmp(text, ring->lastText) == 0)
+	{
+		// the same message as the previous one of this thread: count it and print a summary at most once per interval
+		ring->repeatCount++;
+		ring->numOfSuppressed++;
+		uint64_t now = getCurrentTimeMs();
+		if (now - ring->lastSummaryTimeMs >= asyncLogRateLimitMs)
+		{
+			pushRepeatSummary(ring);
+			ring->lastSummaryTimeMs = now;
+		}
+		return;
+	}
+
+	if (ring->repeatCount > 0)
+		pushRepeatSummary(ring);
+
+	pushEntry(ring, level, text);
+
+	if (asyncLogRateLimitMs > 0)
+	{
+		ring->lastLevel = level;
+		memcpy(ring->lastText, text, sizeof(text));
+		ring->lastSummaryTimeMs = getCurrentTimeMs();
+	}
+}
+
 } // namespace pcpp
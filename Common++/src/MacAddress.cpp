@@ -1,6 +1,3 @@
-#include <stdio.h>
-#include <stdlib.h>
-
 #include "MacAddress.h"
 
 namespace pcpp
@@ -8,39 +5,97 @@ namespace pcpp
 
 MacAddress MacAddress::Zero(0,0,0,0,0,0);
 
+static const char hexDigitsLower[] = "0123456789abcdef";
+
+static inline int hexDigitValue(char ch)
+{
+	if (ch >= '0' && ch <= '9')
+		return ch - '0';
+	if (ch >= 'a' && ch <= 'f')
+		return ch - 'a' + 10;
+	if (ch >= 'A' && ch <= 'F')
+		return ch - 'A' + 10;
+	return -1;
+}
+
 std::string MacAddress::toString() const
 {
-	char str[19];
-	snprintf(str, sizeof str, "%02x:%02x:%02x:%02x:%02x:%02x", m_Address[0], m_Address[1], m_Address[2], m_Address[3], m_Address[4], m_Address[5]);
-	return std::string(str);
+	char str[MAX_MAC_STRING_LEN];
+	size_t len = toString(str, sizeof str);
+	return std::string(str, len);
 }
 
-void MacAddress::init(const char* addr)
+size_t MacAddress::toString(char* buffer, size_t bufferLen) const
+{
+	if (bufferLen < MAX_MAC_STRING_LEN)
+		return 0;
+
+	char* pos = buffer;
+	for (size_t i = 0; i < sizeof m_Address; i++)
+	{
+		*pos++ = hexDigitsLower[m_Address[i] >> 4];
+		*pos++ = hexDigitsLower[m_Address[i] & 0xf];
+		*pos++ = (i < sizeof m_Address - 1 ? ':' : '\0');
+	}
+
+	return MAX_MAC_STRING_LEN - 1;
+}
+
+// parse 6 pairs of hex digits separated by single characters. If strictSeparator is set the separators must all be ':' or all be '-'
+static bool parseMacOctets(const char* str, size_t strLen, bool strictSeparator, uint8_t* addr)
+{
+	if (str == NULL || strLen != MAX_MAC_STRING_LEN - 1)
+		return false;
+
+	char separator = str[2];
+	if (strictSeparator && separator != ':' && separator != '-')
+		return false;
+
+	for (size_t i = 0; i < 6; i++)
+	{
+		const char* pos = str + i * 3;
+		int high = hexDigitValue(pos[0]);
+		int low = hexDigitValue(pos[1]);
+		if (high == -1 || low == -1)
+			return false;
+
+		if (strictSeparator && i < 5 && pos[2] != separator)
+			return false;
+
+		addr[i] = (uint8_t)((high << 4) | low);
+	}
+
+	return true;
+}
+
+bool MacAddress::parse(const char* str, size_t strLen, MacAddress& result)
 {
-	const unsigned int addrLen = sizeof m_Address;
-	unsigned int i = 0;
+	uint8_t addr[6];
+	if (!parseMacOctets(str, strLen, true, addr))
+		return false;
+
+	memcpy(result.m_Address, addr, sizeof addr);
+	result.m_IsValid = true;
+	return true;
+}
 
-	for(; *addr != 0 && i < addrLen; ++i)
+void MacAddress::init(const char* addr)
+{
+	memset(m_Address, 0, sizeof m_Address);
+	if (addr == NULL)
 	{
-		char byte[3];
-		memset(byte, 0, sizeof byte);
-		byte[0] = *addr++;
-		if(*addr == '\0') break;
-		byte[1] = *addr++;
-		if(*addr != '\0') // holds the ":" char or end of string
-			++addr; // ignore the ":" char
-		m_Address[i] = static_cast<uint8_t>(strtol(byte, NULL, 16));
-
-		// The strtol function returns zero value in two cases: when an error occures or the string '00' is converted.
-		// This code verifies that it's the second case.
-		if(m_Address[i] == 0 && (byte[0] != '0' || byte[1] != '0'))
-		{
-			m_IsValid = false;
-			return;
-		}
+		m_IsValid = false;
+		return;
 	}
 
-	m_IsValid = (i == addrLen && *addr == '\0');
+	// unlike parse(), any character has always been accepted as a separator here, also after the last octet
+	size_t len = strlen(addr);
+	if (len == MAX_MAC_STRING_LEN)
+		len--;
+
+	m_IsValid = parseMacOctets(addr, len, false, m_Address);
+	if (!m_IsValid)
+		memset(m_Address, 0, sizeof m_Address);
 }
 
 } // namespace pcpp
@@ -0,0 +1,187 @@
+#include "MemoryBudget.h"
+
+namespace pcpp
+{
+
+const uint32_t EvictionList::InvalidItemId;
+const uint32_t EvictionList::NullNode;
+
+EvictionList::EvictionList(EvictionPolicy policy)
+{
+	m_Policy = policy;
+	m_FreeList = NullNode;
+	m_NonEmptyBuckets = 0;
+	m_NumOfItems = 0;
+	m_TotalBytes = 0;
+	for (int i = 0; i < NumOfBuckets; i++)
+	{
+		m_Heads[i] = NullNode;
+		m_Tails[i] = NullNode;
+	}
+}
+
+uint32_t EvictionList::add(uint64_t userValue, size_t bytes)
+{
+	uint32_t nodeIndex;
+	if (m_FreeList != NullNode)
+	{
+		nodeIndex = m_FreeList;
+		m_FreeList = m_Nodes[nodeIndex].next;
+	}
+	else
+	{
+		if (m_Nodes.size() >= (size_t)InvalidItemId)
+			return InvalidItemId;
+
+		m_Nodes.push_back(Node());
+		nodeIndex = (uint32_t)(m_Nodes.size() - 1);
+	}
+
+	Node& node = m_Nodes[nodeIndex];
+	node.userValue = userValue;
+	node.bytes = bytes;
+	linkNode(nodeIndex);
+
+	m_NumOfItems++;
+	m_TotalBytes += bytes;
+	return nodeIndex;
+}
+
+void EvictionList::remove(uint32_t itemId)
+{
+	unlinkNode(itemId);
+
+	Node& node = m_Nodes[itemId];
+	m_NumOfItems--;
+	m_TotalBytes -= node.bytes;
+	node.bucket = NumOfBuckets;
+	node.next = m_FreeList;
+	m_FreeList = itemId;
+}
+
+void EvictionList::resize(uint32_t itemId, size_t bytes)
+{
+	Node& node = m_Nodes[itemId];
+	m_TotalBytes = m_TotalBytes - node.bytes + bytes;
+	node.bytes = bytes;
+
+	// only the largest-first policy orders items by their size
+	if (m_Policy == EvictLargestFirst && getBucket(bytes) != node.bucket)
+	{
+		unlinkNode(itemId);
+		linkNode(itemId);
+	}
+}
+
+bool EvictionList::getVictim(uint64_t& userValue) const
+{
+	if (m_NonEmptyBuckets == 0)
+		return false;
+
+	// find the highest non-empty bucket by halving the range of bits searched
+	uint64_t mask = m_NonEmptyBuckets;
+	uint32_t bucket = 0;
+	for (uint32_t shift = NumOfBuckets / 2; shift > 0; shift /= 2)
+	{
+		if (mask >> shift)
+		{
+			mask >>= shift;
+			bucket += shift;
+		}
+	}
+
+	userValue = m_Nodes[m_Heads[bucket]].userValue;
+	return true;
+}
+
+void EvictionList::setPolicy(EvictionPolicy policy)
+{
+	if (policy == m_Policy)
+		return;
+
+	// collect the items in their current eviction order and link them again under the new policy
+	std::vector<uint32_t> nodes;
+	nodes.reserve(m_NumOfItems);
+	for (int bucket = NumOfBuckets - 1; bucket >= 0; bucket--)
+	{
+		for (uint32_t nodeIndex = m_Heads[bucket]; nodeIndex != NullNode; nodeIndex = m_Nodes[nodeIndex].next)
+			nodes.push_back(nodeIndex);
+		m_Heads[bucket] = NullNode;
+		m_Tails[bucket] = NullNode;
+	}
+	m_NonEmptyBuckets = 0;
+
+	m_Policy = policy;
+	for (std::vector<uint32_t>::iterator iter = nodes.begin(); iter != nodes.end(); iter++)
+		linkNode(*iter);
+}
+
+void EvictionList::clear()
+{
+	m_Nodes.clear();
+	m_FreeList = NullNode;
+	m_NonEmptyBuckets = 0;
+	m_NumOfItems = 0;
+	m_TotalBytes = 0;
+	for (int i = 0; i < NumOfBuckets; i++)
+	{
+		m_Heads[i] = NullNode;
+		m_Tails[i] = NullNode;
+	}
+}
+
+uint32_t EvictionList::getBucket(size_t bytes) const
+{
+	if (m_Policy != EvictLargestFirst)
+		return 0;
+
+	// the bucket of an item is the position of the highest bit of its size
+	uint32_t bucket = 0;
+	uint64_t value = (uint64_t)bytes;
+	while (value > 1)
+	{
+		value >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+void EvictionList::linkNode(uint32_t nodeIndex)
+{
+	Node& node = m_Nodes[nodeIndex];
+	node.bucket = getBucket(node.bytes);
+	node.next = NullNode;
+	node.prev = m_Tails[node.bucket];
+
+	if (node.prev != NullNode)
+		m_Nodes[node.prev].next = nodeIndex;
+	else
+		m_Heads[node.bucket] = nodeIndex;
+
+	m_Tails[node.bucket] = nodeIndex;
+	m_NonEmptyBuckets |= ((uint64_t)1 << node.bucket);
+}
+
+void EvictionList::unlinkNode(uint32_t nodeIndex)
+{
+	Node& node = m_Nodes[nodeIndex];
+
+	if (node.prev != NullNode)
+		m_Nodes[node.prev].next = node.next;
+	else
+		m_Heads[node.bucket] = node.next;
+
+	if (node.next != NullNode)
+		m_Nodes[node.next].prev = node.prev;
+	else
+		m_Tails[node.bucket] = node.prev;
+
+	if (m_Heads[node.bucket] == NullNode)
+		m_NonEmptyBuckets &= ~((uint64_t)1 << node.bucket);
+
+	node.prev = NullNode;
+	node.next = NullNode;
+}
+
+} // namespace pcpp
@@ -0,0 +1,468 @@
+#define LOG_MODULE CommonLogModuleMetricsRegistry
+
+#include "MetricsRegistry.h"
+#include "TimestampClock.h"
+#include "Logger.h"
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define PCPP_CLOSE_SOCKET closesocket
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#define PCPP_CLOSE_SOCKET close
+#endif
+
+// how often the exporter thread checks whether it should stop
+#define PCPP_METRICS_EXPORTER_POLL_MS 100
+// how long the exporter waits for a request to arrive on an accepted connection
+#define PCPP_METRICS_EXPORTER_REQUEST_TIMEOUT_MS 2000
+#define PCPP_METRICS_EXPORTER_MAX_REQUEST_SIZE 4096
+
+namespace pcpp
+{
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~
+// MetricsSnapshot members
+// ~~~~~~~~~~~~~~~~~~~~~~~~
+
+const MetricValue* MetricsSnapshot::find(const std::string& name, const std::string& labels) const
+{
+	for (std::vector<MetricValue>::const_iterator iter = values.begin(); iter != values.end(); iter++)
+	{
+		if (iter->name == name && iter->labels == labels)
+			return &(*iter);
+	}
+
+	return NULL;
+}
+
+static void appendEscapedHelp(std::string& output, const std::string& help)
+{
+	for (size_t i = 0; i < help.length(); i++)
+	{
+		if (help[i] == '\\')
+			output += "\\\\";
+		else if (help[i] == '\n')
+			output += "\\n";
+		else
+			output += help[i];
+	}
+}
+
+static void appendMetricValue(std::string& output, double value)
+{
+	char buffer[32];
+	// integral values, which all counters are, are printed without an exponent or a fraction
+	if (value >= -9007199254740992.0 && value <= 9007199254740992.0 && value == (double)(long long)value)
+		snprintf(buffer, sizeof(buffer), "%lld", (long long)value);
+	else
+		snprintf(buffer, sizeof(buffer), "%.17g", value);
+
+	output += buffer;
+}
+
+void MetricsSnapshot::toPrometheusText(std::string& output) const
+{
+	// all values of a metric must be grouped together, but different sources may report the same metric (for example two devices), so
+	// the values are grouped by name keeping the order each name first appeared in
+	std::vector<std::string> names;
+	std::map<std::string, std::vector<size_t> > valuesByName;
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		std::map<std::string, std::vector<size_t> >::iterator iter = valuesByName.find(values[i].name);
+		if (iter == valuesByName.end())
+		{
+			names.push_back(values[i].name);
+			iter = valuesByName.insert(std::make_pair(values[i].name, std::vector<size_t>())).first;
+		}
+
+		iter->second.push_back(i);
+	}
+
+	for (std::vector<std::string>::const_iterator nameIter = names.begin(); nameIter != names.end(); nameIter++)
+	{
+		const std::vector<size_t>& indices = valuesByName[*nameIter];
+		const MetricValue& first = values[indices[0]];
+
+		output += "# HELP ";
+		output += first.name;
+		output += ' ';
+		appendEscapedHelp(output, first.help);
+		output += "\n# TYPE ";
+		output += first.name;
+		output += (first.type == MetricCounter ? " counter\n" : " gauge\n");
+
+		for (std::vector<size_t>::const_iterator indexIter = indices.begin(); indexIter != indices.end(); indexIter++)
+		{
+			const MetricValue& value = values[*indexIter];
+			output += value.name;
+			if (!value.labels.empty())
+			{
+				output += '{';
+				output += value.labels;
+				output += '}';
+			}
+
+			output += ' ';
+			appendMetricValue(output, value.value);
+			output += '\n';
+		}
+	}
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~
+// MetricsWriter members
+// ~~~~~~~~~~~~~~~~~~~~~~
+
+void MetricsWriter::add(const std::string& name, const std::string& help, MetricType type, double value, const char* labels)
+{
+	m_Snapshot.values.push_back(MetricValue());
+	MetricValue& metricValue = m_Snapshot.values.back();
+	metricValue.name = name;
+	metricValue.help = help;
+	metricValue.type = type;
+	metricValue.value = value;
+	metricValue.labels = m_Labels;
+	if (labels != NULL && labels[0] != '\0')
+	{
+		if (!metricValue.labels.empty())
+			metricValue.labels += ',';
+		metricValue.labels += labels;
+	}
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~
+// MetricsRegistry members
+// ~~~~~~~~~~~~~~~~~~~~~~~~
+
+MetricsRegistry::MetricsRegistry()
+{
+	pthread_mutex_init(&m_Mutex, NULL);
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+bool MetricsRegistry::addSource(MetricsSource* source, const std::string& labels)
+{
+	if (source == NULL)
+	{
+		LOG_ERROR("Cannot add a NULL metrics source");
+		return false;
+	}
+
+	pthread_mutex_lock(&m_Mutex);
+	for (std::vector<SourceEntry>::iterator iter = m_Sources.begin(); iter != m_Sources.end(); iter++)
+	{
+		if (iter->source == source)
+		{
+			pthread_mutex_unlock(&m_Mutex);
+			LOG_ERROR("Metrics source was already added");
+			return false;
+		}
+	}
+
+	SourceEntry entry;
+	entry.source = source;
+	entry.labels = labels;
+	m_Sources.push_back(entry);
+	pthread_mutex_unlock(&m_Mutex);
+	return true;
+}
+
+bool MetricsRegistry::removeSource(MetricsSource* source)
+{
+	pthread_mutex_lock(&m_Mutex);
+	for (std::vector<SourceEntry>::iterator iter = m_Sources.begin(); iter != m_Sources.end(); iter++)
+	{
+		if (iter->source == source)
+		{
+			m_Sources.erase(iter);
+			pthread_mutex_unlock(&m_Mutex);
+			return true;
+		}
+	}
+
+	pthread_mutex_unlock(&m_Mutex);
+	return false;
+}
+
+size_t MetricsRegistry::getNumOfSources() const
+{
+	pthread_mutex_lock(&m_Mutex);
+	size_t result = m_Sources.size();
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+void MetricsRegistry::snapshot(MetricsSnapshot& result)
+{
+	result.values.clear();
+
+	// the mutex is held while collecting so a source can't be removed (and destroyed) in the middle
+	pthread_mutex_lock(&m_Mutex);
+	result.timestamp = TimestampClock::now();
+	for (std::vector<SourceEntry>::iterator iter = m_Sources.begin(); iter != m_Sources.end(); iter++)
+	{
+		MetricsWriter writer(result, iter->labels);
+		iter->source->collectMetrics(writer);
+	}
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+std::string MetricsRegistry::toPrometheusText()
+{
+	MetricsSnapshot result;
+	snapshot(result);
+	std::string text;
+	result.toPrometheusText(text);
+	return text;
+}
+
+std::string MetricsRegistry::createLabel(const std::string& name, const std::string& value)
+{
+	std::string result = sanitizeName(name);
+	result += "=\"";
+	for (size_t i = 0; i < value.length(); i++)
+	{
+		if (value[i] == '\\')
+			result += "\\\\";
+		else if (value[i] == '"')
+			result += "\\\"";
+		else if (value[i] == '\n')
+			result += "\\n";
+		else
+			result += value[i];
+	}
+
+	result += '"';
+	return result;
+}
+
+std::string MetricsRegistry::sanitizeName(const std::string& name)
+{
+	std::string result = name;
+	for (size_t i = 0; i < result.length(); i++)
+	{
+		char ch = result[i];
+		bool valid = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' || ch == ':' || (i > 0 && ch >= '0' && ch <= '9');
+		if (!valid)
+			result[i] = '_';
+	}
+
+	if (result.empty())
+		result = "_";
+
+	return result;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// MetricsHttpExporter members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+MetricsHttpExporter::MetricsHttpExporter(MetricsRegistry& registry) : m_Registry(registry), m_ListenSocket(-1), m_Port(0),
+	m_Running(false), m_StopRequested(false), m_NumOfRequests(0)
+{
+}
+
+MetricsHttpExporter::~MetricsHttpExporter()
+{
+	stop();
+}
+
+// wait until a socket is readable. Returns false on timeout or error
+static bool waitForReadable(int sock, int timeoutMs)
+{
+	fd_set readSet;
+	FD_ZERO(&readSet);
+	FD_SET(sock, &readSet);
+	timeval timeout;
+	timeout.tv_sec = timeoutMs / 1000;
+	timeout.tv_usec = (timeoutMs % 1000) * 1000;
+	return select(sock + 1, &readSet, NULL, NULL, &timeout) > 0;
+}
+
+static void sendAll(int sock, const std::string& data)
+{
+	size_t sent = 0;
+	while (sent < data.length())
+	{
+		int result = (int)send(sock, data.c_str() + sent, (int)(data.length() - sent), 0);
+		if (result <= 0)
+			return;
+		sent += (size_t)result;
+	}
+}
+
+void MetricsHttpExporter::handleConnection(int connSocket)
+{
+	// read until the end of the request headers. The request body (if any) is ignored
+	std::string request;
+	char buffer[1024];
+	while (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos)
+	{
+		if (request.length() > PCPP_METRICS_EXPORTER_MAX_REQUEST_SIZE || !waitForReadable(connSocket, PCPP_METRICS_EXPORTER_REQUEST_TIMEOUT_MS))
+			return;
+
+		int len = (int)recv(connSocket, buffer, sizeof(buffer), 0);
+		if (len <= 0)
+			return;
+		request.append(buffer, len);
+	}
+
+	std::string requestLine = request.substr(0, request.find_first_of("\r\n"));
+	size_t methodEnd = requestLine.find(' ');
+	size_t pathEnd = (methodEnd == std::string::npos ? std::string::npos : requestLine.find(' ', methodEnd + 1));
+	std::string method = requestLine.substr(0, methodEnd);
+	std::string path = (pathEnd == std::string::npos ? "" : requestLine.substr(methodEnd + 1, pathEnd - methodEnd - 1));
+	size_t queryStart = path.find('?');
+	if (queryStart != std::string::npos)
+		path.erase(queryStart);
+
+	std::string status;
+	std::string contentType = "text/plain; charset=utf-8";
+	std::string body;
+	if (method != "GET" && method != "HEAD")
+	{
+		status = "405 Method Not Allowed";
+		body = "Method not allowed\n";
+	}
+	else if (path != "/metrics")
+	{
+		status = "404 Not Found";
+		body = "Not found, metrics are served at /metrics\n";
+	}
+	else
+	{
+		status = "200 OK";
+		contentType = "text/plain; version=0.0.4; charset=utf-8";
+		m_Registry.snapshot(m_Snapshot);
+		m_Snapshot.toPrometheusText(body);
+	}
+
+	char contentLength[32];
+	snprintf(contentLength, sizeof(contentLength), "%llu", (unsigned long long)body.length());
+	std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: " + contentType + "\r\nContent-Length: " + contentLength +
+			"\r\nConnection: close\r\n\r\n";
+	if (method != "HEAD")
+		response += body;
+
+	sendAll(connSocket, response);
+	m_NumOfRequests = m_NumOfRequests + 1;
+}
+
+void* MetricsHttpExporter::exporterThreadMain(void* exporterPtr)
+{
+	MetricsHttpExporter* exporter = (MetricsHttpExporter*)exporterPtr;
+
+	while (!exporter->m_StopRequested)
+	{
+		// the listening socket is polled with a timeout so stop() doesn't need to wake up a blocked accept()
+		if (!waitForReadable(exporter->m_ListenSocket, PCPP_METRICS_EXPORTER_POLL_MS))
+			continue;
+
+		int connSocket = (int)accept(exporter->m_ListenSocket, NULL, NULL);
+		if (connSocket < 0)
+			continue;
+
+		exporter->handleConnection(connSocket);
+		PCPP_CLOSE_SOCKET(connSocket);
+	}
+
+	return NULL;
+}
+
+bool MetricsHttpExporter::start(uint16_t port, const std::string& bindAddress)
+{
+	if (m_Running)
+		return true;
+
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		LOG_ERROR("Couldn't initialize Winsock");
+		return false;
+	}
+#endif
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = inet_addr(bindAddress.c_str());
+	if (addr.sin_addr.s_addr == INADDR_NONE && bindAddress != "255.255.255.255")
+	{
+		LOG_ERROR("Metrics exporter bind address '%s' isn't a valid IPv4 address", bindAddress.c_str());
+		return false;
+	}
+
+	m_ListenSocket = (int)socket(AF_INET, SOCK_STREAM, 0);
+	if (m_ListenSocket < 0)
+	{
+		LOG_ERROR("Couldn't create the metrics exporter socket");
+		return false;
+	}
+
+	int reuseAddr = 1;
+	setsockopt(m_ListenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuseAddr, sizeof(reuseAddr));
+
+	if (bind(m_ListenSocket, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(m_ListenSocket, 16) != 0)
+	{
+		LOG_ERROR("Couldn't listen on %s:%d for the metrics exporter", bindAddress.c_str(), (int)port);
+		PCPP_CLOSE_SOCKET(m_ListenSocket);
+		m_ListenSocket = -1;
+		return false;
+	}
+
+	// find the chosen port when port 0 was requested
+	socklen_t addrLen = sizeof(addr);
+	if (getsockname(m_ListenSocket, (sockaddr*)&addr, &addrLen) == 0)
+		m_Port = ntohs(addr.sin_port);
+	else
+		m_Port = port;
+
+	m_StopRequested = false;
+	if (pthread_create(&m_Thread, NULL, exporterThreadMain, this) != 0)
+	{
+		LOG_ERROR("Couldn't create the metrics exporter thread");
+		PCPP_CLOSE_SOCKET(m_ListenSocket);
+		m_ListenSocket = -1;
+		m_Port = 0;
+		return false;
+	}
+
+	m_Running = true;
+	return true;
+}
+
+void MetricsHttpExporter::stop()
+{
+	if (!m_Running)
+		return;
+
+	m_StopRequested = true;
+	pthread_join(m_Thread, NULL);
+	PCPP_CLOSE_SOCKET(m_ListenSocket);
+	m_ListenSocket = -1;
+	m_Port = 0;
+	m_Running = false;
+
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	WSACleanup();
+#endif
+}
+
+} // namespace pcpp
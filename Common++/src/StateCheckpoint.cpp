@@ -0,0 +1,110 @@
+#include "StateCheckpoint.h"
+#include <string.h>
+#include <stdio.h>
+
+namespace pcpp
+{
+
+void CheckpointWriter::writeIPAddress(const IPAddressValue& addr)
+{
+	if (!addr.isValid())
+	{
+		writeUInt8(0);
+		return;
+	}
+
+	writeUInt8(addr.isIPv4() ? 4 : 6);
+	writeBytes(addr.getBytes(), addr.getLength());
+}
+
+IPAddressValue CheckpointReader::readIPAddress()
+{
+	uint8_t version = readUInt8();
+	if (version == 4)
+	{
+		const uint8_t* bytes = readBytes(4);
+		if (bytes == NULL)
+			return IPAddressValue();
+
+		uint32_t addressAsInt;
+		memcpy(&addressAsInt, bytes, sizeof(addressAsInt));
+		return IPAddressValue::fromIPv4(addressAsInt);
+	}
+
+	if (version == 6)
+	{
+		const uint8_t* bytes = readBytes(16);
+		if (bytes == NULL)
+			return IPAddressValue();
+
+		return IPAddressValue::fromIPv6(bytes);
+	}
+
+	if (version != 0)
+		setFailed();
+
+	return IPAddressValue();
+}
+
+bool writeCheckpointFile(const std::string& fileName, const std::vector<uint8_t>& data)
+{
+	std::string tempFileName = fileName + ".tmp";
+	FILE* file = fopen(tempFileName.c_str(), "wb");
+	if (file == NULL)
+		return false;
+
+	bool written = (data.empty() || fwrite(&data[0], 1, data.size(), file) == data.size());
+	if (fclose(file) != 0)
+		written = false;
+
+	if (!written)
+	{
+		remove(tempFileName.c_str());
+		return false;
+	}
+
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	// rename() doesn't replace an existing file on Windows
+	remove(fileName.c_str());
+#endif
+
+	if (rename(tempFileName.c_str(), fileName.c_str()) != 0)
+	{
+		remove(tempFileName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool readCheckpointFile(const std::string& fileName, std::vector<uint8_t>& data)
+{
+	FILE* file = fopen(fileName.c_str(), "rb");
+	if (file == NULL)
+		return false;
+
+	// the size is known up front, so the data is read at once into a buffer of the right size
+	long fileSize = -1;
+	if (fseek(file, 0, SEEK_END) == 0)
+		fileSize = ftell(file);
+
+	if (fileSize < 0 || fseek(file, 0, SEEK_SET) != 0)
+	{
+		fclose(file);
+		return false;
+	}
+
+	data.resize((size_t)fileSize);
+	if (fileSize > 0 && fread(&data[0], 1, data.size(), file) != data.size())
+	{
+		fclose(file);
+		data.clear();
+		return false;
+	}
+
+	bool result = (ferror(file) == 0);
+	fclose(file);
+	return result;
+}
+
+} // namespace pcpp
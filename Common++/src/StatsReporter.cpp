@@ -0,0 +1,370 @@
+#define LOG_MODULE CommonLogModuleStatsReporter
+
+#include "StatsReporter.h"
+#include "TimestampClock.h"
+#include "Logger.h"
+#include <string.h>
+#include <errno.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <winsock2.h>
+#else
+#include <sys/time.h>
+#endif
+
+// the cache line size counters of different workers are separated by
+#define PCPP_STATS_CACHE_LINE_SIZE 64
+#define PCPP_STATS_COUNTERS_PER_CACHE_LINE (PCPP_STATS_CACHE_LINE_SIZE / sizeof(uint64_t))
+
+namespace pcpp
+{
+
+// ~~~~~~~~~~~~~~~~~~~~~~
+// StatsCounters members
+// ~~~~~~~~~~~~~~~~~~~~~~
+
+StatsCounters::StatsCounters(const std::vector<std::string>& counterNames, int numOfWorkers) : m_CounterNames(counterNames),
+	m_MetricTypes(counterNames.size(), MetricCounter)
+{
+	m_NumOfWorkers = (numOfWorkers > 0 ? numOfWorkers : 1);
+	m_Stride = (m_CounterNames.size() + PCPP_STATS_COUNTERS_PER_CACHE_LINE - 1) / PCPP_STATS_COUNTERS_PER_CACHE_LINE * PCPP_STATS_COUNTERS_PER_CACHE_LINE;
+	if (m_Stride == 0)
+		m_Stride = PCPP_STATS_COUNTERS_PER_CACHE_LINE;
+
+	// one extra cache line for aligning the values
+	size_t bufferLen = (size_t)m_NumOfWorkers * m_Stride + PCPP_STATS_COUNTERS_PER_CACHE_LINE;
+	m_Buffer = new uint64_t[bufferLen];
+	memset(m_Buffer, 0, bufferLen * sizeof(uint64_t));
+
+	uintptr_t alignedAddr = ((uintptr_t)m_Buffer + PCPP_STATS_CACHE_LINE_SIZE - 1) & ~(uintptr_t)(PCPP_STATS_CACHE_LINE_SIZE - 1);
+	m_Values = (volatile uint64_t*)alignedAddr;
+}
+
+StatsCounters::~StatsCounters()
+{
+	delete [] m_Buffer;
+}
+
+void StatsCounters::aggregate(uint64_t* totals) const
+{
+	int numOfCounters = getNumOfCounters();
+	for (int counterId = 0; counterId < numOfCounters; counterId++)
+		totals[counterId] = 0;
+
+	for (int workerId = 0; workerId < m_NumOfWorkers; workerId++)
+	{
+		for (int counterId = 0; counterId < numOfCounters; counterId++)
+			totals[counterId] += get(workerId, counterId);
+	}
+}
+
+void StatsCounters::reset()
+{
+	for (int workerId = 0; workerId < m_NumOfWorkers; workerId++)
+	{
+		for (int counterId = 0; counterId < getNumOfCounters(); counterId++)
+			set(workerId, counterId, 0);
+	}
+}
+
+int StatsCounters::getCounterId(const std::string& name) const
+{
+	for (size_t i = 0; i < m_CounterNames.size(); i++)
+	{
+		if (m_CounterNames[i] == name)
+			return (int)i;
+	}
+
+	return -1;
+}
+
+void StatsCounters::collectMetrics(MetricsWriter& writer)
+{
+	int numOfCounters = getNumOfCounters();
+	// the metric names are built on the first snapshot and then reused
+	if ((int)m_MetricNames.size() != numOfCounters)
+	{
+		m_MetricNames.clear();
+		for (int counterId = 0; counterId < numOfCounters; counterId++)
+			m_MetricNames.push_back(MetricsRegistry::sanitizeName(m_CounterNames[counterId]));
+	}
+
+	for (int counterId = 0; counterId < numOfCounters; counterId++)
+	{
+		uint64_t total = 0;
+		for (int workerId = 0; workerId < m_NumOfWorkers; workerId++)
+			total += get(workerId, counterId);
+
+		const std::string& name = m_MetricNames[counterId];
+		if (m_MetricTypes[counterId] == MetricGauge)
+			writer.add(name, m_CounterNames[counterId], MetricGauge, (double)total, NULL);
+		else if (name.length() >= 6 && name.compare(name.length() - 6, 6, "_total") == 0)
+			writer.add(name, m_CounterNames[counterId], MetricCounter, (double)total, NULL);
+		else
+			writer.add(name + "_total", m_CounterNames[counterId], MetricCounter, (double)total, NULL);
+	}
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~
+// TableStatsSink members
+// ~~~~~~~~~~~~~~~~~~~~~~~
+
+static std::vector<std::string> createStatsTableColumnNames()
+{
+	std::vector<std::string> columnNames;
+	columnNames.push_back("Counter");
+	columnNames.push_back("Total");
+	columnNames.push_back("Rate/sec");
+	return columnNames;
+}
+
+static std::vector<int> createStatsTableColumnWidths(int nameColumnWidth, int valueColumnWidth)
+{
+	std::vector<int> columnWidths;
+	columnWidths.push_back(nameColumnWidth);
+	columnWidths.push_back(valueColumnWidth);
+	columnWidths.push_back(valueColumnWidth);
+	return columnWidths;
+}
+
+TableStatsSink::TableStatsSink(int nameColumnWidth, int valueColumnWidth) :
+	m_Printer(createStatsTableColumnNames(), createStatsTableColumnWidths(nameColumnWidth, valueColumnWidth))
+{
+}
+
+void TableStatsSink::write(const StatsSnapshot& snapshot)
+{
+	char total[32];
+	char rate[32];
+	const char* values[3];
+	values[1] = total;
+	values[2] = rate;
+
+	for (int counterId = 0; counterId < snapshot.counters->getNumOfCounters(); counterId++)
+	{
+		snprintf(total, sizeof(total), "%llu", (unsigned long long)snapshot.totals[counterId]);
+		snprintf(rate, sizeof(rate), "%.2f", snapshot.getRate(counterId));
+		values[0] = snapshot.counters->getCounterName(counterId).c_str();
+		m_Printer.printRow(values, 3);
+	}
+
+	m_Printer.resetTable();
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~
+// CsvStatsSink members
+// ~~~~~~~~~~~~~~~~~~~~~
+
+CsvStatsSink::CsvStatsSink(FILE* file) : m_File(file), m_HeaderWritten(false)
+{
+}
+
+void CsvStatsSink::write(const StatsSnapshot& snapshot)
+{
+	int numOfCounters = snapshot.counters->getNumOfCounters();
+	if (!m_HeaderWritten)
+	{
+		fputs("timestamp", m_File);
+		for (int counterId = 0; counterId < numOfCounters; counterId++)
+		{
+			fputc(',', m_File);
+			fputs(snapshot.counters->getCounterName(counterId).c_str(), m_File);
+		}
+
+		fputc('\n', m_File);
+		m_HeaderWritten = true;
+	}
+
+	fprintf(m_File, "%lld.%09ld", (long long)snapshot.timestamp.tv_sec, (long)snapshot.timestamp.tv_nsec);
+	for (int counterId = 0; counterId < numOfCounters; counterId++)
+		fprintf(m_File, ",%llu", (unsigned long long)snapshot.totals[counterId]);
+
+	fputc('\n', m_File);
+	fflush(m_File);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// JsonLinesStatsSink members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+JsonLinesStatsSink::JsonLinesStatsSink(FILE* file) : m_File(file)
+{
+}
+
+static std::string escapeJsonString(const std::string& str)
+{
+	std::string result = "\"";
+	for (size_t i = 0; i < str.length(); i++)
+	{
+		unsigned char ch = (unsigned char)str[i];
+		if (ch == '"' || ch == '\\')
+		{
+			result += '\\';
+			result += (char)ch;
+		}
+		else if (ch < 0x20)
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+			result += escaped;
+		}
+		else
+			result += (char)ch;
+	}
+
+	result += '"';
+	return result;
+}
+
+void JsonLinesStatsSink::write(const StatsSnapshot& snapshot)
+{
+	int numOfCounters = snapshot.counters->getNumOfCounters();
+	if ((int)m_EscapedNames.size() != numOfCounters)
+	{
+		m_EscapedNames.clear();
+		for (int counterId = 0; counterId < numOfCounters; counterId++)
+			m_EscapedNames.push_back(escapeJsonString(snapshot.counters->getCounterName(counterId)));
+	}
+
+	fprintf(m_File, "{\"timestamp\":%lld.%09ld,\"interval\":%.6f,\"totals\":{", (long long)snapshot.timestamp.tv_sec, (long)snapshot.timestamp.tv_nsec, snapshot.intervalSec);
+	for (int counterId = 0; counterId < numOfCounters; counterId++)
+		fprintf(m_File, "%s%s:%llu", (counterId > 0 ? "," : ""), m_EscapedNames[counterId].c_str(), (unsigned long long)snapshot.totals[counterId]);
+
+	fputs("},\"rates\":{", m_File);
+	for (int counterId = 0; counterId < numOfCounters; counterId++)
+		fprintf(m_File, "%s%s:%.2f", (counterId > 0 ? "," : ""), m_EscapedNames[counterId].c_str(), snapshot.getRate(counterId));
+
+	fputs("}}\n", m_File);
+	fflush(m_File);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~
+// StatsReporter members
+// ~~~~~~~~~~~~~~~~~~~~~~
+
+StatsReporter::StatsReporter(const StatsCounters& counters) : m_Counters(counters),
+	m_Totals(counters.getNumOfCounters() + 1), m_PrevTotals(counters.getNumOfCounters() + 1), m_Deltas(counters.getNumOfCounters() + 1),
+	m_NumOfReports(0), m_Running(false), m_StopRequested(false), m_IntervalMs(1000)
+{
+	// the vectors have an extra element so their data is valid even when there are no counters
+	m_Counters.aggregate(&m_PrevTotals[0]);
+	m_PrevTimestamp = TimestampClock::now();
+	pthread_mutex_init(&m_Mutex, NULL);
+	pthread_cond_init(&m_StopCond, NULL);
+}
+
+StatsReporter::~StatsReporter()
+{
+	stop();
+	pthread_cond_destroy(&m_StopCond);
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+void StatsReporter::addSink(StatsSink* sink)
+{
+	if (sink == NULL)
+		return;
+
+	pthread_mutex_lock(&m_Mutex);
+	m_Sinks.push_back(sink);
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+void StatsReporter::report()
+{
+	pthread_mutex_lock(&m_Mutex);
+
+	StatsSnapshot snapshot;
+	snapshot.counters = &m_Counters;
+	snapshot.timestamp = TimestampClock::now();
+	m_Counters.aggregate(&m_Totals[0]);
+
+	int64_t intervalNs = (int64_t)(snapshot.timestamp.tv_sec - m_PrevTimestamp.tv_sec) * 1000000000 + (snapshot.timestamp.tv_nsec - m_PrevTimestamp.tv_nsec);
+	snapshot.intervalSec = (intervalNs > 0 ? (double)intervalNs / 1e9 : 0);
+
+	// counters set to lower values (levels or a reset) don't produce negative deltas
+	for (int counterId = 0; counterId < m_Counters.getNumOfCounters(); counterId++)
+		m_Deltas[counterId] = (m_Totals[counterId] > m_PrevTotals[counterId] ? m_Totals[counterId] - m_PrevTotals[counterId] : 0);
+
+	snapshot.totals = &m_Totals[0];
+	snapshot.deltas = &m_Deltas[0];
+
+	for (std::vector<StatsSink*>::iterator iter = m_Sinks.begin(); iter != m_Sinks.end(); iter++)
+		(*iter)->write(snapshot);
+
+	m_Totals.swap(m_PrevTotals);
+	m_PrevTimestamp = snapshot.timestamp;
+	m_NumOfReports++;
+
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+void* StatsReporter::reporterThreadMain(void* reporterPtr)
+{
+	StatsReporter* reporter = (StatsReporter*)reporterPtr;
+
+	pthread_mutex_lock(&reporter->m_Mutex);
+	while (!reporter->m_StopRequested)
+	{
+		// wait on the system clock, which pthread_cond_timedwait() uses by default
+		timeval now;
+		gettimeofday(&now, NULL);
+		uint64_t deadlineNs = (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_usec * 1000 + (uint64_t)reporter->m_IntervalMs * 1000000;
+		timespec deadline;
+		deadline.tv_sec = (time_t)(deadlineNs / 1000000000);
+		deadline.tv_nsec = (long)(deadlineNs % 1000000000);
+
+		int result = 0;
+		while (!reporter->m_StopRequested && result != ETIMEDOUT)
+			result = pthread_cond_timedwait(&reporter->m_StopCond, &reporter->m_Mutex, &deadline);
+
+		if (reporter->m_StopRequested)
+			break;
+
+		// report() takes the mutex itself
+		pthread_mutex_unlock(&reporter->m_Mutex);
+		reporter->report();
+		pthread_mutex_lock(&reporter->m_Mutex);
+	}
+	pthread_mutex_unlock(&reporter->m_Mutex);
+
+	return NULL;
+}
+
+bool StatsReporter::start(uint32_t intervalMs)
+{
+	if (m_Running)
+		return true;
+
+	m_IntervalMs = (intervalMs > 0 ? intervalMs : 1);
+	m_StopRequested = false;
+	if (pthread_create(&m_Thread, NULL, reporterThreadMain, this) != 0)
+	{
+		LOG_ERROR("Couldn't create the stats reporter thread");
+		return false;
+	}
+
+	m_Running = true;
+	return true;
+}
+
+void StatsReporter::stop()
+{
+	if (!m_Running)
+		return;
+
+	pthread_mutex_lock(&m_Mutex);
+	m_StopRequested = true;
+	pthread_cond_signal(&m_StopCond);
+	pthread_mutex_unlock(&m_Mutex);
+
+	pthread_join(m_Thread, NULL);
+	m_Running = false;
+
+	report();
+}
+
+} // namespace pcpp
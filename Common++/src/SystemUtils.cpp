@@ -4,7 +4,9 @@
 #include <unistd.h>
 #endif
 #include <stdio.h>
+#include <stdlib.h>
 #include <iostream>
+#include <algorithm>
 #include <signal.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -168,6 +170,216 @@ void createCoreVectorFromCoreMask(CoreMask coreMask, std::vector<SystemCore>& re
 	}
 }
 
+CoreMask createCoreMaskFromCpuList(const std::string& cpuList)
+{
+	CoreMask result = 0;
+	const char* curPos = cpuList.c_str();
+	while (*curPos != '\0' && *curPos != '\n')
+	{
+		char* endPos = NULL;
+		long first = strtol(curPos, &endPos, 10);
+		if (endPos == curPos || first < 0)
+			return 0;
+
+		long last = first;
+		curPos = endPos;
+		if (*curPos == '-')
+		{
+			last = strtol(curPos + 1, &endPos, 10);
+			if (endPos == curPos + 1 || last < first)
+				return 0;
+			curPos = endPos;
+		}
+
+		for (long coreId = first; coreId <= last && coreId < MAX_NUM_OF_CORES; coreId++)
+			result |= SystemCores::IdToSystemCore[coreId].Mask;
+
+		if (*curPos == ',')
+			curPos++;
+		else if (*curPos != '\0' && *curPos != '\n')
+			return 0;
+	}
+
+	return result;
+}
+
+#ifdef LINUX
+// read the first line of a (sysfs) file, without the line break
+static bool readFirstLine(const std::string& filePath, std::string& line)
+{
+	FILE* file = fopen(filePath.c_str(), "r");
+	if (file == NULL)
+		return false;
+
+	char buffer[256];
+	bool result = (fgets(buffer, sizeof(buffer), file) != NULL);
+	fclose(file);
+	if (!result)
+		return false;
+
+	line = buffer;
+	if (!line.empty() && line[line.length() - 1] == '\n')
+		line.erase(line.length() - 1);
+
+	return true;
+}
+
+static int readNumaNodeFile(const std::string& filePath)
+{
+	std::string line;
+	if (!readFirstLine(filePath, line) || line.empty())
+		return -1;
+
+	// the kernel reports -1 when the node isn't known
+	int numaNode = atoi(line.c_str());
+	return (numaNode >= 0 ? numaNode : -1);
+}
+#endif
+
+static inline bool isValidCoreId(int coreId)
+{
+	return coreId >= 0 && coreId < MAX_NUM_OF_CORES && coreId < getNumOfCores();
+}
+
+int getNumOfNumaNodes()
+{
+#ifdef LINUX
+	std::string onlineNodes;
+	if (readFirstLine("/sys/devices/system/node/online", onlineNodes))
+	{
+		CoreMask nodeMask = createCoreMaskFromCpuList(onlineNodes);
+		int result = 0;
+		for (; nodeMask != 0; nodeMask &= nodeMask - 1)
+			result++;
+
+		if (result > 0)
+			return result;
+	}
+#endif
+	return 1;
+}
+
+int getCoreNumaNode(int coreId)
+{
+	if (!isValidCoreId(coreId))
+		return -1;
+
+#ifdef LINUX
+	// sysfs contains a link named after the node in the directory of each core
+	char path[64];
+	for (int numaNode = 0; numaNode < MAX_NUM_OF_CORES; numaNode++)
+	{
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d", coreId, numaNode);
+		if (directoryExists(path))
+			return numaNode;
+	}
+#endif
+	return 0;
+}
+
+CoreMask getNumaNodeCoreMask(int numaNode)
+{
+	if (numaNode < 0)
+		return 0;
+
+#ifdef LINUX
+	char path[64];
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", numaNode);
+	std::string cpuList;
+	if (readFirstLine(path, cpuList))
+		return createCoreMaskFromCpuList(cpuList) & getCoreMaskForAllMachineCores();
+
+	// a kernel without NUMA support
+	if (directoryExists("/sys/devices/system/node/node0"))
+		return 0;
+#endif
+	return (numaNode == 0 ? getCoreMaskForAllMachineCores() : 0);
+}
+
+CoreMask getSmtSiblingsCoreMask(int coreId)
+{
+	if (!isValidCoreId(coreId))
+		return 0;
+
+	CoreMask result = SystemCores::IdToSystemCore[coreId].Mask;
+
+#ifdef LINUX
+	char path[80];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", coreId);
+	std::string cpuList;
+	if (readFirstLine(path, cpuList))
+		result |= createCoreMaskFromCpuList(cpuList);
+#endif
+
+	return result;
+}
+
+int getPciDeviceNumaNode(const std::string& pciAddress)
+{
+#ifdef LINUX
+	// add the PCI domain if it's missing ("04:00.1" -> "0000:04:00.1")
+	std::string fullAddress = pciAddress;
+	if (std::count(fullAddress.begin(), fullAddress.end(), ':') == 1)
+		fullAddress = "0000:" + fullAddress;
+
+	if (fullAddress.empty() || fullAddress.find('/') != std::string::npos)
+		return -1;
+
+	return readNumaNodeFile("/sys/bus/pci/devices/" + fullAddress + "/numa_node");
+#else
+	return -1;
+#endif
+}
+
+int getNetworkInterfaceNumaNode(const std::string& interfaceName)
+{
+#ifdef LINUX
+	if (interfaceName.empty() || interfaceName.find('/') != std::string::npos)
+		return -1;
+
+	return readNumaNodeFile("/sys/class/net/" + interfaceName + "/device/numa_node");
+#else
+	return -1;
+#endif
+}
+
+CoreMask selectNumaLocalCores(int numaNode, int numOfCores, CoreMask availableCores)
+{
+	CoreMask siblings[MAX_NUM_OF_CORES];
+	for (int coreId = 0; coreId < MAX_NUM_OF_CORES; coreId++)
+		siblings[coreId] = ((availableCores & SystemCores::IdToSystemCore[coreId].Mask) ? getSmtSiblingsCoreMask(coreId) : 0);
+
+	CoreMask nodeCores = (numaNode >= 0 ? getNumaNodeCoreMask(numaNode) & availableCores : 0);
+	CoreMask coreGroups[2] = { nodeCores, availableCores & ~nodeCores };
+
+	CoreMask result = 0;
+	int numOfSelected = 0;
+	for (int group = 0; group < 2; group++)
+	{
+		// first pass: one core per physical core, second pass: the remaining SMT siblings
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int coreId = 0; coreId < MAX_NUM_OF_CORES; coreId++)
+			{
+				if (numOfSelected >= numOfCores)
+					return result;
+
+				CoreMask coreMask = SystemCores::IdToSystemCore[coreId].Mask;
+				if (!(coreGroups[group] & coreMask) || (result & coreMask))
+					continue;
+
+				if (pass == 0 && (siblings[coreId] & result))
+					continue;
+
+				result |= coreMask;
+				numOfSelected++;
+			}
+		}
+	}
+
+	return result;
+}
+
 std::string executeShellCommand(const std::string command)
 {
 	FILE* pipe = POPEN(command.c_str(), "r");
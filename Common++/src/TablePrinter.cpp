@@ -4,6 +4,7 @@
 #include <sstream>
 #include <iostream>
 #include <iterator>
+#include <string.h>
 #include "TablePrinter.h"
 #include "Logger.h"
 
@@ -26,7 +27,7 @@ TablePrinter::~TablePrinter()
 	closeTable();
 }
 
-bool TablePrinter::printRow(std::vector<std::string> values)
+bool TablePrinter::prepareRow(size_t numOfValues)
 {
 	// if table is already closed return false
 	if (m_TableClosed)
@@ -35,7 +36,7 @@ bool TablePrinter::printRow(std::vector<std::string> values)
 		return false;
 	}
 
-	if (values.size() != m_ColumnWidths.size())
+	if (numOfValues != m_ColumnWidths.size())
 	{
 		LOG_ERROR("Number of values in input doesn't equal to number of columns");
 		return false;
@@ -48,6 +49,14 @@ bool TablePrinter::printRow(std::vector<std::string> values)
 		m_FirstRow = false;
 	}
 
+	return true;
+}
+
+bool TablePrinter::printRow(std::vector<std::string> values)
+{
+	if (!prepareRow(values.size()))
+		return false;
+
 	for (int i = 0; i < (int)m_ColumnWidths.size(); i++)
 	{
 		std::string val = values.at(i);
@@ -65,6 +74,36 @@ bool TablePrinter::printRow(std::vector<std::string> values)
 	return true;
 }
 
+bool TablePrinter::printRow(const char* const values[], int numOfValues)
+{
+	if (numOfValues < 0 || !prepareRow((size_t)numOfValues))
+		return false;
+
+	for (int i = 0; i < numOfValues; i++)
+	{
+		size_t width = (size_t)m_ColumnWidths.at(i);
+		size_t len = strlen(values[i]);
+		std::cout << "| ";
+		if (len > width)
+		{
+			std::cout.write(values[i], width - 3);
+			std::cout << "...";
+		}
+		else
+		{
+			std::cout.write(values[i], len);
+			for (size_t pad = len; pad < width; pad++)
+				std::cout.put(' ');
+		}
+
+		std::cout.put(' ');
+	}
+
+	std::cout << "|" <<  std::endl;
+
+	return true;
+}
+
 bool TablePrinter::printRow(std::string values, char delimiter)
 {
 	std::string singleValue;
@@ -116,6 +155,17 @@ void TablePrinter::closeTable()
 	m_TableClosed = true;
 }
 
+void TablePrinter::resetTable()
+{
+	// the table can't be reset if it was never valid
+	if (m_ColumnWidths.size() != m_ColumnNames.size())
+		return;
+
+	closeTable();
+	m_FirstRow = true;
+	m_TableClosed = false;
+}
+
 void TablePrinter::printHeadline()
 {
 	// if table is already closed return
@@ -0,0 +1,240 @@
+#include "TimerWheel.h"
+
+namespace pcpp
+{
+
+static const uint32_t NullNode = 0xffffffff;
+
+const uint32_t TimerWheel::InvalidTimerId;
+
+TimerWheel::TimerWheel(uint64_t currentTick)
+{
+	m_CurrentTick = currentTick;
+	m_FreeList = NullNode;
+	m_ExpiredTail = NullNode;
+	m_NumOfTimers = 0;
+	m_NumOfExpired = 0;
+	for (int i = 0; i < NumOfLists; i++)
+		m_ListHeads[i] = NullNode;
+	for (int i = 0; i < NumOfLevels; i++)
+		m_LevelCounts[i] = 0;
+}
+
+uint32_t TimerWheel::addTimer(uint64_t expiryTick, uint64_t userValue)
+{
+	uint32_t nodeIndex;
+	if (m_FreeList != NullNode)
+	{
+		nodeIndex = m_FreeList;
+		m_FreeList = m_Nodes[nodeIndex].next;
+	}
+	else
+	{
+		if (m_Nodes.size() >= (size_t)InvalidTimerId)
+			return InvalidTimerId;
+
+		m_Nodes.push_back(Node());
+		nodeIndex = (uint32_t)(m_Nodes.size() - 1);
+	}
+
+	Node& node = m_Nodes[nodeIndex];
+	node.expiryTick = expiryTick;
+	node.userValue = userValue;
+	m_NumOfTimers++;
+	placeTimer(nodeIndex);
+
+	return nodeIndex;
+}
+
+void TimerWheel::removeTimer(uint32_t timerId)
+{
+	unlinkFromList(timerId);
+
+	Node& node = m_Nodes[timerId];
+	node.list = NumOfLists;
+	node.next = m_FreeList;
+	m_FreeList = timerId;
+	m_NumOfTimers--;
+}
+
+void TimerWheel::rescheduleTimer(uint32_t timerId, uint64_t expiryTick)
+{
+	unlinkFromList(timerId);
+	m_Nodes[timerId].expiryTick = expiryTick;
+	placeTimer(timerId);
+}
+
+void TimerWheel::advance(uint64_t currentTick)
+{
+	while (m_CurrentTick < currentTick)
+	{
+		// no timers are waiting in the wheel, so there is nothing to do until the new time
+		if (m_NumOfTimers == m_NumOfExpired)
+		{
+			m_CurrentTick = currentTick;
+			return;
+		}
+
+		// if the lower levels are empty nothing happens until the next tick which moves timers down from the lowest non-empty level,
+		// so jump to the tick before it
+		int level = 0;
+		while (m_LevelCounts[level] == 0)
+			level++;
+
+		if (level > 0)
+		{
+			uint64_t levelSpan = (uint64_t)1 << (SlotBits * level);
+			uint64_t tickBeforeCascade = (m_CurrentTick / levelSpan + 1) * levelSpan - 1;
+			if (tickBeforeCascade >= currentTick)
+			{
+				m_CurrentTick = currentTick;
+				return;
+			}
+
+			m_CurrentTick = tickBeforeCascade;
+		}
+
+		step();
+	}
+}
+
+bool TimerWheel::popExpired(uint64_t& userValue)
+{
+	uint32_t nodeIndex = m_ListHeads[ExpiredList];
+	if (nodeIndex == NullNode)
+		return false;
+
+	userValue = m_Nodes[nodeIndex].userValue;
+	removeTimer(nodeIndex);
+	return true;
+}
+
+void TimerWheel::clear()
+{
+	m_Nodes.clear();
+	m_FreeList = NullNode;
+	m_ExpiredTail = NullNode;
+	m_NumOfTimers = 0;
+	m_NumOfExpired = 0;
+	for (int i = 0; i < NumOfLists; i++)
+		m_ListHeads[i] = NullNode;
+	for (int i = 0; i < NumOfLevels; i++)
+		m_LevelCounts[i] = 0;
+}
+
+void TimerWheel::placeTimer(uint32_t nodeIndex)
+{
+	uint64_t expiryTick = m_Nodes[nodeIndex].expiryTick;
+	if (expiryTick <= m_CurrentTick)
+	{
+		linkToList(nodeIndex, ExpiredList);
+		return;
+	}
+
+	// timers beyond the range of the wheel are kept in the last slot of the range and placed again when they're moved down
+	static const uint64_t maxDelta = ((uint64_t)1 << (SlotBits * NumOfLevels)) - 1;
+	uint64_t delta = expiryTick - m_CurrentTick;
+	if (delta > maxDelta)
+	{
+		delta = maxDelta;
+		expiryTick = m_CurrentTick + maxDelta;
+	}
+
+	// level N holds the timers expiring in less than 64^(N+1) ticks, in slots of 64^N ticks
+	int level = 0;
+	while (level < NumOfLevels - 1 && delta >= ((uint64_t)1 << (SlotBits * (level + 1))))
+		level++;
+
+	uint32_t slot = (uint32_t)((expiryTick >> (SlotBits * level)) & (SlotsPerLevel - 1));
+	linkToList(nodeIndex, level * SlotsPerLevel + slot);
+}
+
+void TimerWheel::linkToList(uint32_t nodeIndex, uint32_t list)
+{
+	Node& node = m_Nodes[nodeIndex];
+	node.list = list;
+	node.prev = NullNode;
+
+	if (list == ExpiredList)
+	{
+		// expired timers are kept in the order they expired in, so they're appended
+		node.next = NullNode;
+		node.prev = m_ExpiredTail;
+		if (m_ExpiredTail != NullNode)
+			m_Nodes[m_ExpiredTail].next = nodeIndex;
+		else
+			m_ListHeads[ExpiredList] = nodeIndex;
+		m_ExpiredTail = nodeIndex;
+		m_NumOfExpired++;
+		return;
+	}
+
+	node.next = m_ListHeads[list];
+	if (node.next != NullNode)
+		m_Nodes[node.next].prev = nodeIndex;
+	m_ListHeads[list] = nodeIndex;
+	m_LevelCounts[list / SlotsPerLevel]++;
+}
+
+void TimerWheel::unlinkFromList(uint32_t nodeIndex)
+{
+	Node& node = m_Nodes[nodeIndex];
+
+	if (node.prev != NullNode)
+		m_Nodes[node.prev].next = node.next;
+	else
+		m_ListHeads[node.list] = node.next;
+
+	if (node.next != NullNode)
+		m_Nodes[node.next].prev = node.prev;
+
+	if (node.list == ExpiredList)
+	{
+		if (m_ExpiredTail == nodeIndex)
+			m_ExpiredTail = node.prev;
+		m_NumOfExpired--;
+	}
+	else
+		m_LevelCounts[node.list / SlotsPerLevel]--;
+
+	node.prev = NullNode;
+	node.next = NullNode;
+}
+
+void TimerWheel::step()
+{
+	m_CurrentTick++;
+
+	// lists are detached before their timers are placed again, as a timer may be placed back in the same list
+	uint32_t cascadeLists[NumOfLevels];
+	int numOfLists = 0;
+
+	// when the slot index of a level wraps around, the timers of the next slot of the level above are moved down
+	for (int level = 1; level < NumOfLevels; level++)
+	{
+		if (((m_CurrentTick >> (SlotBits * (level - 1))) & (SlotsPerLevel - 1)) != 0)
+			break;
+
+		cascadeLists[numOfLists++] = level * SlotsPerLevel + (uint32_t)((m_CurrentTick >> (SlotBits * level)) & (SlotsPerLevel - 1));
+	}
+
+	// the timers of the current slot of level 0 expire now
+	cascadeLists[numOfLists++] = (uint32_t)(m_CurrentTick & (SlotsPerLevel - 1));
+
+	for (int i = 0; i < numOfLists; i++)
+	{
+		uint32_t list = cascadeLists[i];
+		uint32_t nodeIndex = m_ListHeads[list];
+		m_ListHeads[list] = NullNode;
+
+		while (nodeIndex != NullNode)
+		{
+			uint32_t next = m_Nodes[nodeIndex].next;
+			m_LevelCounts[list / SlotsPerLevel]--;
+			placeTimer(nodeIndex);
+			nodeIndex = next;
+		}
+	}
+}
+
+} // namespace pcpp
@@ -0,0 +1,214 @@
+#include "TimestampClock.h"
+#include "AtomicUtils.h"
+#include "SystemUtils.h"
+#include "CpuFeatures.h"
+#include <pthread.h>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define PCPP_TIMESTAMP_CLOCK_TSC
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PCPP_TIMESTAMP_CLOCK_TSC
+#include <x86intrin.h>
+#endif
+#if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV)
+#include <unistd.h>
+#endif
+
+namespace pcpp
+{
+
+// the TSC is converted to nanoseconds as: baseNs + (tsc - baseTsc) * nsPerTick / 2^32
+struct TscCalibration
+{
+	uint64_t baseTsc;
+	uint64_t baseNs;
+	uint64_t nsPerTick;
+	uint64_t frequency;
+};
+
+// recalibrate() writes the slot which isn't in use and then switches the index, so readers never see a partially written calibration
+static TscCalibration tscCalibrations[2];
+static volatile uint32_t tscCalibrationIndex = 0;
+static bool tscClockEnabled = false;
+static pthread_once_t tscClockInitOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t tscClockMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// the time the TSC frequency is measured over on first use
+#define PCPP_TSC_CALIBRATION_PERIOD_US 20000
+
+static uint64_t getSystemTimeNs()
+{
+#if defined(LINUX) || (defined(CLOCK_REALTIME) && !defined(_MSC_VER) && !defined(MAC_OS_X))
+	timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#else
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000000000 + (uint64_t)tv.tv_usec * 1000;
+#endif
+}
+
+#ifdef PCPP_TIMESTAMP_CLOCK_TSC
+
+static inline uint64_t readTsc()
+{
+	return __rdtsc();
+}
+
+// pair a TSC value with the system time. The TSC is read before and after the system clock and the tightest of a few attempts is used
+static void readTscAndSystemTime(uint64_t& tsc, uint64_t& ns)
+{
+	uint64_t bestGap = (uint64_t)-1;
+	for (int i = 0; i < 5; i++)
+	{
+		uint64_t before = readTsc();
+		uint64_t curNs = getSystemTimeNs();
+		uint64_t after = readTsc();
+		if (after - before < bestGap)
+		{
+			bestGap = after - before;
+			tsc = before + (after - before) / 2;
+			ns = curNs;
+		}
+	}
+}
+
+static void sleepMicroseconds(uint32_t us)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	Sleep(us / 1000);
+#else
+	usleep(us);
+#endif
+}
+
+// calculate a calibration which begins at (tsc, ns) from a frequency measured between two points
+static bool calculateCalibration(uint64_t prevTsc, uint64_t prevNs, uint64_t tsc, uint64_t ns, TscCalibration& calibration)
+{
+	if (tsc <= prevTsc || ns <= prevNs)
+		return false;
+
+	double frequency = (double)(tsc - prevTsc) * 1e9 / (double)(ns - prevNs);
+	// nsPerTick is a 32.32 fixed point number which must be smaller than 1 for the conversion not to overflow, so slower counters
+	// aren't used
+	if (frequency <= 1e9)
+		return false;
+
+	calibration.baseTsc = tsc;
+	calibration.baseNs = ns;
+	calibration.frequency = (uint64_t)frequency;
+	calibration.nsPerTick = (uint64_t)(1e9 * 4294967296.0 / frequency);
+	return true;
+}
+
+static void initTscClock()
+{
+	if (!CpuFeatures::hasInvariantTsc())
+		return;
+
+	uint64_t startTsc = 0, startNs = 0, endTsc = 0, endNs = 0;
+	readTscAndSystemTime(startTsc, startNs);
+	sleepMicroseconds(PCPP_TSC_CALIBRATION_PERIOD_US);
+	readTscAndSystemTime(endTsc, endNs);
+
+	if (!calculateCalibration(startTsc, startNs, endTsc, endNs, tscCalibrations[0]))
+		return;
+
+	atomicStoreRelease(&tscCalibrationIndex, 0);
+	tscClockEnabled = true;
+}
+
+static inline uint64_t tscToNs(uint64_t tsc)
+{
+	const TscCalibration& calibration = tscCalibrations[atomicLoadAcquire(&tscCalibrationIndex)];
+
+	// a TSC read on another core just before the calibration may be a bit behind its base
+	uint64_t delta = (tsc > calibration.baseTsc ? tsc - calibration.baseTsc : 0);
+
+	// 64x32 bit multiplication split to avoid overflowing 64 bits
+	return calibration.baseNs + (delta >> 32) * calibration.nsPerTick + (((delta & 0xffffffff) * calibration.nsPerTick) >> 32);
+}
+
+#endif // PCPP_TIMESTAMP_CLOCK_TSC
+
+static inline void initClock()
+{
+#ifdef PCPP_TIMESTAMP_CLOCK_TSC
+	pthread_once(&tscClockInitOnce, initTscClock);
+#endif
+}
+
+uint64_t TimestampClock::nowNs()
+{
+	initClock();
+#ifdef PCPP_TIMESTAMP_CLOCK_TSC
+	if (tscClockEnabled)
+		return tscToNs(readTsc());
+#endif
+	return getSystemTimeNs();
+}
+
+timespec TimestampClock::now()
+{
+	uint64_t ns = nowNs();
+	timespec result;
+	result.tv_sec = (time_t)(ns / 1000000000);
+	result.tv_nsec = (long)(ns % 1000000000);
+	return result;
+}
+
+timeval TimestampClock::nowTimeval()
+{
+	return toTimeval(now());
+}
+
+void TimestampClock::recalibrate()
+{
+	initClock();
+#ifdef PCPP_TIMESTAMP_CLOCK_TSC
+	if (!tscClockEnabled)
+		return;
+
+	pthread_mutex_lock(&tscClockMutex);
+
+	uint32_t curIndex = atomicLoadAcquire(&tscCalibrationIndex);
+	const TscCalibration& curCalibration = tscCalibrations[curIndex];
+	uint64_t tsc = 0, ns = 0;
+	readTscAndSystemTime(tsc, ns);
+
+	// the new frequency is measured over the whole period since the previous calibration
+	uint64_t prevNs = curCalibration.baseNs;
+	if (calculateCalibration(curCalibration.baseTsc, prevNs, tsc, ns, tscCalibrations[curIndex ^ 1]))
+		atomicStoreRelease(&tscCalibrationIndex, curIndex ^ 1);
+
+	pthread_mutex_unlock(&tscClockMutex);
+#endif
+}
+
+bool TimestampClock::isTscBased()
+{
+	initClock();
+	return tscClockEnabled;
+}
+
+uint64_t TimestampClock::getTscFrequency()
+{
+	initClock();
+#ifdef PCPP_TIMESTAMP_CLOCK_TSC
+	if (tscClockEnabled)
+		return tscCalibrations[atomicLoadAcquire(&tscCalibrationIndex)].frequency;
+#endif
+	return 0;
+}
+
+uint64_t TimestampClock::readCycleCounter()
+{
+#ifdef PCPP_TIMESTAMP_CLOCK_TSC
+	return readTsc();
+#else
+	return getSystemTimeNs();
+#endif
+}
+
+} // namespace pcpp
@@ -2,10 +2,16 @@
  * Arping example application
  * ================================
  * This application resolves a target MAC address by its IPv4 address by sending an ARP request and translating the ARP response.
- * Its basic input is the target IP address and the interface name/IP to send the ARP request from
+ * Its basic input is the target IP address and the interface name/IP to send the ARP request from.
+ * In scan mode it resolves all addresses of a network instead, with many ARP requests outstanding at the same time
  */
 
 #include <stdlib.h>
+#include <string>
+#include <vector>
+#if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV) //for using ntohl, ntohs, etc.
+#include <in.h>
+#endif
 #include <MacAddress.h>
 #include <IpAddress.h>
 #include <Logger.h>
@@ -38,6 +44,8 @@ static struct option ArpingOptions[] =
 	{"version", no_argument, 0, 'v'},
 	{"list", optional_argument, 0, 'l'},
 	{"timeout", optional_argument, 0, 'w'},
+	{"scan", required_argument, 0, 'N'},
+	{"rate", required_argument, 0, 'r'},
     {0, 0, 0, 0}
 };
 
@@ -49,6 +57,7 @@ void printUsage() {
 	printf("\nUsage:\n"
 			"------\n"
 			"%s [-hvl] [-c count] [-w timeout] [-s mac_sddr] [-S ip_addr] -i interface -T ip_addr\n"
+			"%s [-w timeout] [-r rate] [-s mac_sddr] [-S ip_addr] -i interface -N network/prefix\n"
 			"\nOptions:\n\n"
 			"    -h           : Displays this help message and exits\n"
 			"    -v           : Displays the current version and exists\n"
@@ -58,7 +67,11 @@ void printUsage() {
 			"    -s mac_addr  : Set source MAC address\n"
 			"    -S ip_addr   : Set source IP address\n"
 			"    -T ip_addr   : Set target IP address\n"
-			"    -w timeout   : How long to wait for a reply (in seconds)\n", AppName::get().c_str());
+			"    -w timeout   : How long to wait for a reply (in seconds)\n"
+			"    -N network   : Scan mode: resolve all addresses of a network given as address/prefix length (e.g 10.0.0.0/24). The\n"
+			"                   prefix length must be between 16 and 32. Only the addresses which replied are printed\n"
+			"    -r rate      : In scan mode, the maximum number of ARP requests sent per second. Default is 1000\n",
+			AppName::get().c_str(), AppName::get().c_str());
 
 	exit(0);
 }
@@ -92,6 +105,55 @@ void listInterfaces()
 }
 
 
+/**
+ * The callback invoked when an ARP request sent in scan mode is completed
+ */
+void onScanResult(const IPv4Address& ipAddr, const MacAddress& macAddr, double responseTimeMS, void* userCookie)
+{
+	// addresses which didn't reply aren't printed
+	if (macAddr == MacAddress::Zero)
+		return;
+
+	printf("Reply from %s [%s]  %.3fms\n", ipAddr.toString().c_str(), macAddr.toString().c_str(), responseTimeMS);
+}
+
+
+/**
+ * Scan mode: resolve all addresses of a network in one batch of ARP requests
+ */
+void scanNetwork(PcapLiveDevice* dev, IPv4Address network, int prefixLen, MacAddress sourceMac, IPv4Address sourceIP, int timeoutSec, uint32_t rate)
+{
+	uint32_t mask = (prefixLen == 32 ? 0xffffffff : ~(0xffffffff >> prefixLen));
+	uint32_t firstAddr = ntohl(network.toInt()) & mask;
+	uint32_t lastAddr = firstAddr | ~mask;
+
+	// the network and broadcast addresses are skipped, unless the network has only 1 or 2 addresses
+	if (prefixLen < 31)
+	{
+		firstAddr++;
+		lastAddr--;
+	}
+
+	std::vector<IPv4Address> targets;
+	targets.reserve(lastAddr - firstAddr + 1);
+	for (uint32_t addr = firstAddr; addr <= lastAddr && addr >= firstAddr; addr++)
+		targets.push_back(IPv4Address(htonl(addr)));
+
+	printf("Scanning %d addresses...\n", (int)targets.size());
+
+	if (timeoutSec <= 0)
+		timeoutSec = NetworkUtils::DefaultTimeout;
+
+	BatchResolverConfiguration config(256, rate, (uint32_t)timeoutSec * 1000);
+	ArpBatchResolver resolver(dev, onScanResult, NULL, config, sourceMac, sourceIP);
+	int numOfReplies = resolver.resolve(targets);
+	if (numOfReplies < 0)
+		EXIT_WITH_ERROR_AND_PRINT_USAGE("Couldn't scan the network");
+
+	printf("\n%d of %d addresses replied\n", numOfReplies, (int)targets.size());
+}
+
+
 /**
  * main method of the application
  */
@@ -107,10 +169,14 @@ int main(int argc, char* argv[])
 	std::string ifaceNameOrIP = "";
 	bool ifaceNameOrIpProvided = false;
 	int timeoutSec = NetworkUtils::DefaultTimeout;
+	bool scanMode = false;
+	IPv4Address scanNetworkAddr = IPv4Address::Zero;
+	int scanPrefixLen = 0;
+	uint32_t scanRate = 1000;
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long (argc, argv, "i:s:S:T:c:hvlw:", ArpingOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "i:s:S:T:c:hvlw:N:r:", ArpingOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -145,6 +211,24 @@ int main(int argc, char* argv[])
 			case 'w':
 				timeoutSec = atoi(optarg);
 				break;
+			case 'N':
+			{
+				std::string network = optarg;
+				size_t slashPos = network.find('/');
+				if (slashPos == std::string::npos)
+					EXIT_WITH_ERROR_AND_PRINT_USAGE("Network must be given as address/prefix length");
+				scanNetworkAddr = IPv4Address(network.substr(0, slashPos));
+				scanPrefixLen = atoi(network.substr(slashPos + 1).c_str());
+				if (!scanNetworkAddr.isValid())
+					EXIT_WITH_ERROR_AND_PRINT_USAGE("Network address is not valid");
+				if (scanPrefixLen < 16 || scanPrefixLen > 32)
+					EXIT_WITH_ERROR_AND_PRINT_USAGE("Prefix length must be between 16 and 32");
+				scanMode = true;
+				break;
+			}
+			case 'r':
+				scanRate = (uint32_t)atoi(optarg);
+				break;
 			default:
 				printUsage();
 				exit(-1);
@@ -155,12 +239,15 @@ int main(int argc, char* argv[])
 	if (!ifaceNameOrIpProvided)
 		EXIT_WITH_ERROR_AND_PRINT_USAGE("You must provide at least interface name or interface IP (-i switch)");
 
+	if (scanMode && targetIpProvided)
+		EXIT_WITH_ERROR_AND_PRINT_USAGE("Target IP (-T switch) and network scan (-N switch) can't be used together");
+
 	// verify target IP was provided
-	if (!targetIpProvided)
+	if (!targetIpProvided && !scanMode)
 		EXIT_WITH_ERROR_AND_PRINT_USAGE("You must provide target IP (-T switch)");
 
 	// verify target IP is value
-	if (!targetIP.isValid())
+	if (!scanMode && !targetIP.isValid())
 		EXIT_WITH_ERROR_AND_PRINT_USAGE("Target IP is not valid");
 
 
@@ -208,6 +295,13 @@ int main(int argc, char* argv[])
 	if (!sourceIP.isValid() || sourceIP == IPv4Address::Zero)
 		EXIT_WITH_ERROR_AND_PRINT_USAGE("Source IPv4 address wasn't supplied and couldn't be retrieved from interface");
 
+	if (scanMode)
+	{
+		scanNetwork(dev, scanNetworkAddr, scanPrefixLen, sourceMac, sourceIP, timeoutSec, scanRate);
+		dev->close();
+		return 0;
+	}
+
 	// let's go
 	double arpResonseTimeMS = 0;
 	int i = 1;
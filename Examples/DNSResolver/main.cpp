@@ -1,4 +1,6 @@
 #include <stdlib.h>
+#include <fstream>
+#include <vector>
 #include "PcapPlusPlusVersion.h"
 #include "PcapLiveDevice.h"
 #include "PcapLiveDeviceList.h"
@@ -24,6 +26,8 @@ static struct option DNSResolverOptions[] =
 	{"help", no_argument, 0, 'h'},
 	{"version", no_argument, 0, 'v'},
 	{"list", no_argument, 0, 'l'},
+	{"hostname-file", required_argument, 0, 'f'},
+	{"rate", required_argument, 0, 'r'},
     {0, 0, 0, 0}
 };
 
@@ -35,6 +39,7 @@ void printUsage() {
 	printf("\nUsage:\n"
 			"------\n"
 			"%s [-hvl] [-t timeout] [-d dns_server] [-g gateway] [-i interface] -s hostname\n"
+			"%s [-t timeout] [-r rate] [-d dns_server] [-g gateway] [-i interface] -f hostname_file\n"
 			"\nOptions:\n\n"
 			"    -h           : Displays this help message and exits\n"
 			"    -v           : Displays the current version and exists\n"
@@ -44,7 +49,11 @@ void printUsage() {
 			"                   one of the interfaces that has a default gateway will be used\n"
 			"    -d dns_server: IPv4 address of DNS server to send the DNS request to. If not set the DNS request will be sent to the gateway\n"
 			"    -g gateway   : IPv4 address of the gateway to send the DNS request to. If not set the default gateway will be chosen\n"
-			"    -t timeout   : How long to wait for a reply (in seconds). Default timeout is 5 seconds\n", AppName::get().c_str());
+			"    -t timeout   : How long to wait for a reply (in seconds). Default timeout is 5 seconds\n"
+			"    -f hostname_file : Batch mode: resolve all hostnames in this file (one hostname per line), with many DNS requests\n"
+			"                   outstanding at the same time\n"
+			"    -r rate      : In batch mode, the maximum number of DNS requests sent per second. Default is 1000\n",
+			AppName::get().c_str(), AppName::get().c_str());
 
 	exit(0);
 }
@@ -83,6 +92,55 @@ void listInterfaces()
 }
 
 
+/**
+ * The callback invoked when a DNS request sent in batch mode is completed
+ */
+void onBatchResult(const std::string& hostname, const IPv4Address& ipAddr, uint32_t dnsTTL, double responseTimeMS, void* userCookie)
+{
+	if (ipAddr == IPv4Address::Zero)
+		printf("Could not resolve hostname [%s]\n", hostname.c_str());
+	else
+		printf("IP address of [%s] is: %s  DNS-TTL=%d  time=%dms\n", hostname.c_str(), ipAddr.toString().c_str(), dnsTTL, (int)responseTimeMS);
+}
+
+
+/**
+ * Batch mode: resolve all hostnames in a file in one batch of DNS requests
+ */
+void resolveHostnameFile(const std::string& hostnameFile, PcapLiveDevice* dev, int timeoutSec, uint32_t rate, IPv4Address dnsServerIP, IPv4Address gatewayIP)
+{
+	std::ifstream file(hostnameFile.c_str());
+	if (!file.is_open())
+		EXIT_WITH_ERROR("Couldn't open hostname file '%s'", hostnameFile.c_str());
+
+	std::vector<std::string> hostnames;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		// trim spaces and line endings, and skip empty lines
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == std::string::npos)
+			continue;
+		size_t end = line.find_last_not_of(" \t\r");
+		hostnames.push_back(line.substr(start, end - start + 1));
+	}
+
+	if (hostnames.empty())
+		EXIT_WITH_ERROR("Hostname file is empty");
+
+	if (timeoutSec <= 0)
+		timeoutSec = NetworkUtils::DefaultTimeout;
+
+	BatchResolverConfiguration config(256, rate, (uint32_t)timeoutSec * 1000);
+	DnsBatchResolver resolver(dev, onBatchResult, NULL, config, dnsServerIP, gatewayIP);
+	int numOfResolved = resolver.resolve(hostnames);
+	if (numOfResolved < 0)
+		EXIT_WITH_ERROR("Couldn't resolve the hostnames");
+
+	printf("\n%d of %d hostnames resolved\n", numOfResolved, (int)hostnames.size());
+}
+
+
 /**
  * main method of the application
  */
@@ -97,11 +155,13 @@ int main(int argc, char* argv[])
 	IPv4Address dnsServerIP = IPv4Address::Zero;
 	IPv4Address gatewayIP = IPv4Address::Zero;
 	int timeoutSec = -1;
+	std::string hostnameFile;
+	uint32_t rate = 1000;
 
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long (argc, argv, "i:d:g:s:t:hvl", DNSResolverOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "i:d:g:s:t:f:r:hvl", DNSResolverOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -151,6 +211,16 @@ int main(int argc, char* argv[])
 				timeoutSec = atoi(optarg);
 				break;
 			}
+			case 'f':
+			{
+				hostnameFile = optarg;
+				break;
+			}
+			case 'r':
+			{
+				rate = (uint32_t)atoi(optarg);
+				break;
+			}
 			default:
 			{
 				printUsage();
@@ -160,9 +230,12 @@ int main(int argc, char* argv[])
 	}
 
 	// make sure that hostname is provided
-	if (!hostnameProvided)
+	if (!hostnameProvided && hostnameFile.empty())
 		EXIT_WITH_ERROR("Hostname not provided");
 
+	if (hostnameProvided && !hostnameFile.empty())
+		EXIT_WITH_ERROR("Hostname (-s switch) and hostname file (-f switch) can't be used together");
+
 	// find the interface to send the DNS request from
 	PcapLiveDevice* dev = NULL;
 
@@ -203,6 +276,12 @@ int main(int argc, char* argv[])
 
 	printf("Using interface '%s'\n", dev->getIPv4Address().toString().c_str());
 
+	if (!hostnameFile.empty())
+	{
+		resolveHostnameFile(hostnameFile, dev, timeoutSec, rate, dnsServerIP, gatewayIP);
+		return 0;
+	}
+
 	// find the IPv4 address for provided hostname
 	double responseTime = 0;
 	uint32_t dnsTTL = 0;
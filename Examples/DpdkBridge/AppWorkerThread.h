@@ -5,13 +5,15 @@
 #include "PacketUtils.h"
 #include "DpdkDevice.h"
 #include "DpdkDeviceList.h"
+#include "DpdkL2Switch.h"
 #include "PcapFileDevice.h"
 
 using namespace pcpp;
 
 /**
- * The worker thread class which does all the work. It's initialized with pointers to the RX and TX devices, then it runs in
- * an endless loop which reads packets from the RX device and sends them to the TX device.
+ * The worker thread class which does all the work. It's initialized with the port it receives from, the ports of the bridge and the
+ * shared MAC learning table, then it runs in an endless loop which reads packets from its port and sends each of them to the port its
+ * destination was learned on, or to all other ports if it wasn't learned yet.
  * The endless loop is interrupted only when the thread is asked to stop (calling its stop() method)
  */
 class AppWorkerThread : public DpdkWorkerThread
@@ -38,41 +40,28 @@ public:
 	{
 		m_CoreId = coreId;
 		m_Stop = false;
-		DpdkDevice* rxDevice = m_WorkerConfig.RxDevice;
-		DpdkDevice* txDevice = m_WorkerConfig.TxDevice;
+		std::vector<DpdkDevice*>* ports = m_WorkerConfig.Ports;
 
 		// if no DPDK devices were assigned to this worker/core don't enter the main loop and exit
-		if (!rxDevice || !txDevice)
+		if (!ports || !m_WorkerConfig.Table || m_WorkerConfig.RxPort >= ports->size())
 		{
 			return true;
 		}
 
-		#define MAX_RECEIVE_BURST 64
-		MBufRawPacket* packetArr[MAX_RECEIVE_BURST] = {};
+		// each worker sends on its own TX queue of every port, whose index is the index of the port it receives from. The switch moves
+		// the received mbufs to the TX ports as they are, without creating packet objects or copying data
+		DpdkL2Switch l2Switch(m_WorkerConfig.Table, *ports, m_WorkerConfig.RxPort);
 
 		// main loop, runs until be told to stop
 		while (!m_Stop)
 		{
 			for(uint16_t i = 0; i < m_WorkerConfig.RxQueues; i++)
 			{
-				// receive packets from network on the specified DPDK device
-				uint16_t packetsReceived = rxDevice->receivePackets(packetArr, MAX_RECEIVE_BURST, i);
-
-				if (packetsReceived > 0)
-				{
-					// send packets to TX port
-					txDevice->sendPackets(packetArr, packetsReceived, 0);
-				}
+				// receive packets from network on the specified RX queue and send them to the ports they should go to
+				l2Switch.switchBurst(m_WorkerConfig.RxPort, i);
 			}
 		}
 
-		// free packet array (frees all mbufs as well)
-		for (int i = 0; i < MAX_RECEIVE_BURST; i++)
-		{
-			if (packetArr[i] != NULL)
-				delete packetArr[i];
-		}
-
 		return true;
 	}
 
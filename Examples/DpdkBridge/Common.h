@@ -2,6 +2,7 @@
 
 #include "Packet.h"
 #include "DpdkDevice.h"
+#include "MacLearningTable.h"
 
 #include <SystemUtils.h>
 
@@ -34,17 +35,19 @@ using namespace pcpp;
 
 /**
  * Contains all the configuration needed for the worker thread including:
- * - Which DPDK port to receive packets from
- * - Which DPDK port to send packets to
+ * - Which port of the bridge to receive packets from, and how many of its RX queues
+ * - The ports of the bridge, which the worker sends packets to on its own TX queue
+ * - The MAC learning table shared by all workers
  */
 struct AppWorkerConfig
 {
 	uint32_t CoreId;
-	DpdkDevice* RxDevice;
+	uint16_t RxPort;
 	uint16_t RxQueues;
-	DpdkDevice* TxDevice;
+	std::vector<DpdkDevice*>* Ports;
+	MacLearningTable* Table;
 
-	AppWorkerConfig() : CoreId(MAX_NUM_OF_CORES+1), RxDevice(NULL), RxQueues(1), TxDevice(NULL)
+	AppWorkerConfig() : CoreId(MAX_NUM_OF_CORES+1), RxPort(0), RxQueues(1), Ports(NULL), Table(NULL)
 	{
 	}
 };
@@ -1,14 +1,19 @@
 /**
  * DPDK bridge example application
  * =======================================
- * This application demonstrates how to create a bridge between two network devices using PcapPlusPlus DPDK APIs. 
- * It listens to two DPDK ports (a.k.a DPDK devices), and forwards all the traffic received on one port to the other, acting like a L2 bridge. 
+ * This application demonstrates how to create a bridge between two or more network devices using PcapPlusPlus DPDK APIs. 
+ * It listens to two or more DPDK ports (a.k.a DPDK devices) and acts like a transparent L2 switch: it learns the port behind each MAC
+ * address (per VLAN) from the source addresses of the received frames, forwards frames to the port their destination was learned on,
+ * and floods broadcast, multicast and unknown destinations to all other ports. Learned addresses which weren't seen for the aging time
+ * are forgotten.
  * 
- * The application is very similar to [DPDK's L2 forwarding example](https://doc.dpdk.org/guides/sample_app_ug/l2_forward_real_virtual.html)
+ * The application is similar to [DPDK's L2 forwarding example](https://doc.dpdk.org/guides/sample_app_ug/l2_forward_real_virtual.html)
  * and demonstrates how to achieve the same functionaly with PcapPlusPlus using less and easier to understand C++ code.
  *
- * The application uses the concept of worker threads. It creates 2 worker threads running in an endless loop (as long as the app is running):
- * one for receiving packets on NIC#1 and sending them to NIC#2, and another for receiving packets on NIC#2 and sending them to NIC#1.
+ * The application uses the concept of worker threads. It creates a worker thread for each port running in an endless loop (as long as the
+ * app is running), which receives packets on its port and sends them to the other ports using DpdkL2Switch. All workers share one
+ * MacLearningTable, and each of them sends on its own TX queue of every port. The management thread removes aged-out addresses from the
+ * table once a second.
  *
  * __Important__: 
  * - This application runs only on Linux (DPDK is not supported on Windows and Mac OS X)
@@ -27,6 +32,7 @@
 #include "SystemUtils.h"
 #include "PcapPlusPlusVersion.h"
 #include "TablePrinter.h"
+#include "TimestampClock.h"
 
 #include <vector>
 #include <iostream>
@@ -43,6 +49,8 @@ using namespace pcpp;
 #define COLLECT_STATS_EVERY_SEC 1
 #define DEFAULT_MBUF_POOL_SIZE 4095
 #define DEFAULT_QUEUE_QUANTITY 1
+#define DEFAULT_AGING_TIME 300
+#define DEFAULT_FDB_SIZE 65536
 
 
 static struct option DpdkBridgeOptions[] =
@@ -51,6 +59,8 @@ static struct option DpdkBridgeOptions[] =
 	{"core-mask",  optional_argument, 0, 'c'},
 	{"mbuf-pool-size",  optional_argument, 0, 'm'},
 	{"queue-quantity",  optional_argument, 0, 'q'},
+	{"aging-time",  optional_argument, 0, 'a'},
+	{"fdb-size",  optional_argument, 0, 'f'},
 	{"help", optional_argument, 0, 'h'},
 	{"list", optional_argument, 0, 'l'},
 	{"version", optional_argument, 0, 'v'},
@@ -65,7 +75,7 @@ void printUsage()
 {
 	printf("\nUsage:\n"
 			"------\n"
-			"%s [-hlv] [-c CORE_MASK] [-m POOL_SIZE] [-q QUEUE_QTY] -d PORT_1,PORT_2\n"
+			"%s [-hlv] [-c CORE_MASK] [-m POOL_SIZE] [-q QUEUE_QTY] [-a AGING_TIME] [-f FDB_SIZE] -d PORT_1,PORT_2[,PORT_3...]\n"
 			"\nOptions:\n\n"
 			"    -h|--help                                  : Displays this help message and exits\n"
 			"    -l|--list                                  : Print the list of DPDK ports and exits\n"
@@ -73,9 +83,12 @@ void printUsage()
 			"    -c|--core-mask CORE_MASK                   : Core mask of cores to use. For example: use 7 (binary 0111) to use cores 0,1,2.\n"
 			"                                                 Default is using all cores except management core\n"
 			"    -m|--mbuf-pool-size POOL_SIZE              : DPDK mBuf pool size to initialize DPDK with. Default value is 4095\n\n"
-			"    -d|--dpdk-ports PORT_1,PORT_2              : A comma-separated list of two DPDK port numbers to be bridged.\n"
+			"    -d|--dpdk-ports PORT_1,PORT_2[,PORT_3...]  : A comma-separated list of two or more DPDK port numbers to be bridged.\n"
 			"                                                 To see all available DPDK ports use the -l switch\n"
-			"    -q|--queue-quantity QUEUE_QTY              : Quantity of RX queues to be opened for each DPDK device. Default value is 1\n", AppName::get().c_str());
+			"    -q|--queue-quantity QUEUE_QTY              : Quantity of RX queues to be opened for each DPDK device. Default value is 1\n"
+			"    -a|--aging-time AGING_TIME                 : Number of seconds a learned MAC address is kept without traffic from it.\n"
+			"                                                 Default value is 300\n"
+			"    -f|--fdb-size FDB_SIZE                     : Number of MAC addresses to size the forwarding database for. Default value is 65536\n", AppName::get().c_str());
 }
 
 
@@ -201,8 +214,10 @@ int main(int argc, char* argv[])
 
 	uint32_t mBufPoolSize = DEFAULT_MBUF_POOL_SIZE;
 	uint16_t queueQuantity = DEFAULT_QUEUE_QUANTITY;
+	uint32_t agingTime = DEFAULT_AGING_TIME;
+	size_t fdbSize = DEFAULT_FDB_SIZE;
 
-	while((opt = getopt_long (argc, argv, "d:c:m:q:hvl", DpdkBridgeOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "d:c:m:q:a:f:hvl", DpdkBridgeOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -234,10 +249,10 @@ int main(int argc, char* argv[])
 					}
 					dpdkPortVec.push_back(port);
 				}
-				// verify list contains two ports
-				if(dpdkPortVec.size()!=2)
+				// verify list contains at least two ports
+				if(dpdkPortVec.size()<2)
 				{
-					EXIT_WITH_ERROR_AND_PRINT_USAGE("DPDK list must contain two values");
+					EXIT_WITH_ERROR_AND_PRINT_USAGE("DPDK list must contain at least two values");
 				}
 				break;
 			}
@@ -251,6 +266,20 @@ int main(int argc, char* argv[])
 				queueQuantity = atoi(optarg);
 				break;
 			}
+			case 'a':
+			{
+				agingTime = atoi(optarg);
+				break;
+			}
+			case 'f':
+			{
+				fdbSize = atoi(optarg);
+				if (fdbSize == 0)
+				{
+					EXIT_WITH_ERROR_AND_PRINT_USAGE("FDB size must be larger than 0");
+				}
+				break;
+			}
 			case 'h':
 			{
 				printUsage();
@@ -284,10 +313,10 @@ int main(int argc, char* argv[])
 	vector<SystemCore> coresToUse;
 	createCoreVectorFromCoreMask(coreMaskToUse, coresToUse);
 
-	// need minimum of 3 cores to start - 1 management core + 1 (or more) worker thread(s)
-	if (coresToUse.size() < 3)
+	// need 1 management core + 1 worker core for each port
+	if (coresToUse.size() < dpdkPortVec.size() + 1)
 	{
-		EXIT_WITH_ERROR("Needed minimum of 3 cores to start the application");
+		EXIT_WITH_ERROR("Needed minimum of %d cores to start the application", (int)dpdkPortVec.size() + 1);
 	}
 
 	// initialize DPDK
@@ -315,33 +344,46 @@ int main(int argc, char* argv[])
 		dpdkDevicesToUse.push_back(dev);
 	}
 
-	// go over all devices and open them
+	// go over all devices and open them, with a TX queue for every worker
+	uint16_t numOfPorts = (uint16_t)dpdkDevicesToUse.size();
 	for (vector<DpdkDevice*>::iterator iter = dpdkDevicesToUse.begin(); iter != dpdkDevicesToUse.end(); iter++)
 	{
-		if (!(*iter)->openMultiQueues(queueQuantity, 1))
+		if (!(*iter)->openMultiQueues(queueQuantity, numOfPorts))
 		{
 			EXIT_WITH_ERROR("Couldn't open DPDK device #%d, PMD '%s'", (*iter)->getDeviceId(), (*iter)->getPMDName().c_str());
 		}
 	}
 
-	// prepare configuration for every core
-	AppWorkerConfig workerConfigArr[2];
-	workerConfigArr[0].CoreId = coresToUse.at(0).Id;
-	workerConfigArr[0].RxDevice = dpdkDevicesToUse.at(0);
-	workerConfigArr[0].RxQueues = queueQuantity;
-	workerConfigArr[0].TxDevice = dpdkDevicesToUse.at(1);
-	workerConfigArr[1].CoreId = coresToUse.at(1).Id;
-	workerConfigArr[1].RxDevice = dpdkDevicesToUse.at(1);
-	workerConfigArr[1].RxQueues = queueQuantity;
-	workerConfigArr[1].TxDevice = dpdkDevicesToUse.at(0);
+	// the forwarding database shared by all workers
+	MacLearningTable macTable(fdbSize, agingTime);
+
+	// prepare configuration for every core, one core per port
+	vector<AppWorkerConfig> workerConfigVec(numOfPorts);
+	for (uint16_t i = 0; i < numOfPorts; i++)
+	{
+		workerConfigVec[i].CoreId = coresToUse.at(i).Id;
+		workerConfigVec[i].RxPort = i;
+		workerConfigVec[i].RxQueues = queueQuantity;
+		workerConfigVec[i].Ports = &dpdkDevicesToUse;
+		workerConfigVec[i].Table = &macTable;
+	}
 
 	// create worker thread for every core
 	vector<DpdkWorkerThread*> workerThreadVec;
-	workerThreadVec.push_back(new AppWorkerThread(workerConfigArr[0]));
-	workerThreadVec.push_back(new AppWorkerThread(workerConfigArr[1]));
+	for (uint16_t i = 0; i < numOfPorts; i++)
+	{
+		workerThreadVec.push_back(new AppWorkerThread(workerConfigVec[i]));
+	}
+
+	// start the worker threads only on the cores they were configured for
+	CoreMask workerCoreMask = 0;
+	for (uint16_t i = 0; i < numOfPorts; i++)
+	{
+		workerCoreMask |= coresToUse.at(i).Mask;
+	}
 
 	// start all worker threads
-	if (!DpdkDeviceList::getInstance().startDpdkWorkerThreads(coreMaskToUse, workerThreadVec))
+	if (!DpdkDeviceList::getInstance().startDpdkWorkerThreads(workerCoreMask, workerThreadVec))
 	{
 		EXIT_WITH_ERROR("Couldn't start worker threads");
 	}
@@ -361,6 +403,9 @@ int main(int argc, char* argv[])
 		// Sleep for 1 second
 		sleep(1);
 
+		// remove the addresses which weren't seen for the aging time, using the clock the workers learn with
+		macTable.age((uint32_t)(TimestampClock::nowNs() / 1000000000ULL));
+
 		// Print stats every COLLECT_STATS_EVERY_SEC seconds
 		if (counter % COLLECT_STATS_EVERY_SEC == 0)
 		{
@@ -371,8 +416,17 @@ int main(int argc, char* argv[])
 
 			// Print devices traffic stats
 			printf("Stats #%d\n==========\n", statsCounter++);
-			printStats(dpdkDevicesToUse.at(0));
-			printStats(dpdkDevicesToUse.at(1));
+			for (vector<DpdkDevice*>::iterator iter = dpdkDevicesToUse.begin(); iter != dpdkDevicesToUse.end(); iter++)
+			{
+				printStats(*iter);
+			}
+
+			MacLearningTableStats fdbStats;
+			macTable.getStats(fdbStats);
+			printf("\nForwarding database: %d addresses (capacity %d); learned: %llu; moved: %llu; evicted: %llu; aged: %llu\n",
+					(int)macTable.getNumOfEntries(), (int)macTable.getCapacity(),
+					(unsigned long long)fdbStats.learnedEntries, (unsigned long long)fdbStats.movedEntries,
+					(unsigned long long)fdbStats.evictedEntries, (unsigned long long)fdbStats.agedEntries);
 		}
 		counter++;
 	}
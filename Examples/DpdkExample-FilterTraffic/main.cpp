@@ -29,6 +29,7 @@
 #include "SystemUtils.h"
 #include "PcapPlusPlusVersion.h"
 #include "TablePrinter.h"
+#include "BenchmarkHarness.h"
 
 #include <vector>
 #include <iostream>
@@ -60,6 +61,8 @@ static struct option FilterTrafficOptions[] =
 	{"help", optional_argument, 0, 'h'},
 	{"version", optional_argument, 0, 'v'},
 	{"list", optional_argument, 0, 'l'},
+	{"benchmark-input", required_argument, 0, 'b'},
+	{"hw-counters", no_argument, 0, 'H'},
 	{0, 0, 0, 0}
 };
 
@@ -72,7 +75,8 @@ void printUsage()
 	printf("\nUsage:\n"
                  "------\n"
                         "%s [-hvl] [-s PORT] [-f FILENAME] [-i IPV4_ADDR] [-I IPV4_ADDR] [-p PORT] [-P PORT] [-r PROTOCOL]\n"
-			"                     [-c CORE_MASK] [-m POOL_SIZE] -d PORT_1,PORT_3,...,PORT_N\n"
+			"                     [-c CORE_MASK] [-m POOL_SIZE] [-H] -d PORT_1,PORT_3,...,PORT_N\n"
+			"%s [-i IPV4_ADDR] [-I IPV4_ADDR] [-p PORT] [-P PORT] [-r PROTOCOL] --benchmark[=ITERATIONS] -b FILENAME\n"
 			"\nOptions:\n\n"
 			"    -h|--help                                  : Displays this help message and exits\n"
                         "    -v|--version                               : Displays the current version and exits\n"
@@ -88,7 +92,13 @@ void printUsage()
 			"    -r|--match-protocol       PROTOCOL         : Match protocol. Valid values are 'TCP' or 'UDP'\n"
 			"    -c|--core-mask            CORE_MASK        : Core mask of cores to use. For example: use 7 (binary 0111) to use cores 0,1,2.\n"
 			"                                                 Default is using all cores except management core\n"
-			"    -m|--mbuf-pool-size       POOL_SIZE        : DPDK mBuf pool size to initialize DPDK with. Default value is 4095\n\n", AppName::get().c_str());
+			"    -m|--mbuf-pool-size       POOL_SIZE        : DPDK mBuf pool size to initialize DPDK with. Default value is 4095\n"
+			"    -H|--hw-counters                           : Count CPU hardware events (cycles, instructions, cache misses, branch misses)\n"
+			"                                                 of every worker with perf_event and print them per packet on exit\n"
+			"    -b|--benchmark-input      FILENAME         : The pcap/pcapng file to process in benchmark mode\n"
+			"%s"
+			"\nIn benchmark mode the packets of the input file go through the workers' processing (stats, flow table and matching)\n"
+			"on a single core, without initializing DPDK\n\n", AppName::get().c_str(), AppName::get().c_str(), BenchmarkHarness::getUsage());
 }
 
 
@@ -210,9 +220,10 @@ void prepareCoreConfiguration(vector<DpdkDevice*>& dpdkDevicesToUse, vector<Syst
 struct FiltetTrafficArgs
 {
 	bool shouldStop;
+	bool hwCounters;
 	std::vector<DpdkWorkerThread*>* workerThreadsVector;
 
-	FiltetTrafficArgs() : shouldStop(false), workerThreadsVector(NULL) {}
+	FiltetTrafficArgs() : shouldStop(false), hwCounters(false), workerThreadsVector(NULL) {}
 };
 
 /**
@@ -235,22 +246,92 @@ void onApplicationInterrupted(void* cookie)
 
 	// print final stats for every worker thread plus sum of all threads and free worker threads memory
 	PacketStats aggregatedStats;
+	std::vector<std::string> hwCounterLines;
 	for (std::vector<DpdkWorkerThread*>::iterator iter = args->workerThreadsVector->begin(); iter != args->workerThreadsVector->end(); iter++)
 	{
 		AppWorkerThread* thread = (AppWorkerThread*)(*iter);
 		PacketStats threadStats = thread->getStats();
 		aggregatedStats.collectStats(threadStats);
 		printer.printRow(threadStats.getStatValuesAsString("|"), '|');
+
+		HardwareCounterValues hwCounterValues;
+		if (args->hwCounters && DpdkDeviceList::getInstance().getWorkerHardwareCounters(thread->getCoreId(), hwCounterValues))
+		{
+			std::stringstream line;
+			line << "Core " << thread->getCoreId() << ": ";
+			if (hwCounterValues.isAnyAvailable())
+				line << HardwareCounters::toString(hwCounterValues, threadStats.PacketCount);
+			else
+				line << "not available";
+			hwCounterLines.push_back(line.str());
+		}
+
 		delete thread;
 	}
 
 	printer.printSeparator();
 	printer.printRow(aggregatedStats.getStatValuesAsString("|"), '|');
 
+	// the hardware counters cover the whole worker loop, including polling when there were no packets
+	if (!hwCounterLines.empty())
+	{
+		printf("\nHardware counters per packet:\n");
+		for (std::vector<std::string>::iterator iter = hwCounterLines.begin(); iter != hwCounterLines.end(); iter++)
+			printf("   %s\n", iter->c_str());
+	}
+
 	args->shouldStop = true;
 }
 
 
+/**
+ * Benchmark mode: run the packets of a pcap/pcapng file through the same processing AppWorkerThread does for every received packet
+ * (collecting stats, looking up the flow table and matching new flows) several times, on the current core and without DPDK
+ */
+void runBenchmark(const string& inputFile, PacketMatchingEngine& matchingEngine, const BenchmarkConfiguration& benchmarkConfig)
+{
+	BenchmarkHarness harness(AppName::get(), benchmarkConfig);
+
+	if (!harness.loadFile(inputFile))
+	{
+		EXIT_WITH_ERROR("Couldn't read benchmark input file '%s'", inputFile.c_str());
+	}
+
+	int parseStage = harness.addStage("parse");
+	int statsStage = harness.addStage("collect stats");
+	int matchStage = harness.addStage("match");
+
+	while (harness.startIteration())
+	{
+		PacketStats stats;
+		map<uint32_t, bool> flowTable;
+		for (size_t i = 0; i < harness.getNumOfPackets(); i++)
+		{
+			harness.beginStage(parseStage);
+			Packet parsedPacket(harness.getPacket(i));
+			harness.endStage(parseStage);
+
+			harness.beginStage(statsStage);
+			stats.collectStats(parsedPacket);
+			harness.endStage(statsStage);
+
+			harness.beginStage(matchStage);
+			uint32_t hash = hash5Tuple(&parsedPacket);
+			map<uint32_t, bool>::const_iterator iter = flowTable.find(hash);
+			if (iter == flowTable.end() || !iter->second)
+			{
+				if (matchingEngine.isMatched(parsedPacket))
+					flowTable[hash] = true;
+			}
+			harness.endStage(matchStage);
+		}
+		harness.endIteration();
+	}
+
+	harness.printReport();
+}
+
+
 /**
  * main method of the application. Responsible for parsing user args, preparing worker thread configuration, creating the worker threads and activate them.
  * At program termination worker threads are stopped, statistics are collected from them and printed to console
@@ -280,7 +361,18 @@ int main(int argc, char* argv[])
 	uint16_t 		dstPortToMatch = 0;
 	ProtocolType	protocolToMatch = UnknownProtocol;
 
-	while((opt = getopt_long (argc, argv, "d:c:s:f:m:i:I:p:P:r:hvl", FilterTrafficOptions, &optionIndex)) != -1)
+	string benchmarkInputFile = "";
+
+	bool hwCounters = false;
+
+	// the benchmark options are removed from the command line before it's parsed
+	BenchmarkConfiguration benchmarkConfig;
+	if (!BenchmarkHarness::extractOptions(argc, argv, benchmarkConfig))
+	{
+		EXIT_WITH_ERROR_AND_PRINT_USAGE("Invalid benchmark option");
+	}
+
+	while((opt = getopt_long (argc, argv, "d:c:s:f:m:i:I:p:P:r:b:Hhvl", FilterTrafficOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -389,6 +481,16 @@ int main(int argc, char* argv[])
 				}
 				break;
 			}
+			case 'b':
+			{
+				benchmarkInputFile = string(optarg);
+				break;
+			}
+			case 'H':
+			{
+				hwCounters = true;
+				break;
+			}
 			case 'h':
 			{
 				printUsage();
@@ -412,6 +514,19 @@ int main(int argc, char* argv[])
 		}
 	}
 
+	// benchmark mode doesn't use DPDK at all
+	if (benchmarkConfig.enabled)
+	{
+		if (benchmarkInputFile.empty())
+		{
+			EXIT_WITH_ERROR_AND_PRINT_USAGE("Benchmark mode requires an input file. Please use the -b switch");
+		}
+
+		PacketMatchingEngine matchingEngine(srcIPToMatch, dstIPToMatch, srcPortToMatch, dstPortToMatch, protocolToMatch);
+		runBenchmark(benchmarkInputFile, matchingEngine, benchmarkConfig);
+		return 0;
+	}
+
 	// verify list is not empty
 	if (dpdkPortVec.empty())
 	{
@@ -485,6 +600,8 @@ int main(int argc, char* argv[])
 		i++;
 	}
 
+	DpdkDeviceList::getInstance().setWorkerHardwareCountersEnabled(hwCounters);
+
 	// start all worker threads
 	if (!DpdkDeviceList::getInstance().startDpdkWorkerThreads(coreMaskToUse, workerThreadVec))
 	{
@@ -493,6 +610,7 @@ int main(int argc, char* argv[])
 
 	// register the on app close event to print summary stats on app termination
 	FiltetTrafficArgs args;
+	args.hwCounters = hwCounters;
 	args.workerThreadsVector = &workerThreadVec;
 	ApplicationEventHandler::getInstance().onApplicationInterrupted(onApplicationInterrupted, &args);
 
@@ -2,12 +2,14 @@
 
 #include <map>
 #include <sstream>
+#include <string.h>
 #include "HttpLayer.h"
 #include "TcpLayer.h"
 #include "IPv4Layer.h"
 #include "PayloadLayer.h"
 #include "PacketUtils.h"
 #include "SystemUtils.h"
+#include "HashCounters.h"
 
 
 /**
@@ -91,7 +93,7 @@ struct HttpMessageStats
 struct HttpRequestStats : HttpMessageStats
 {
 	std::map<pcpp::HttpRequestLayer::HttpMethod, int> methodCount; // a map for counting the different HTTP methods seen in traffic
-	std::map<std::string, int> hostnameCount; // a map for counting the hostnames seen in traffic
+	pcpp::StringCounter hostnameCount; // counts the hostnames seen in traffic
 
 	void clear()
 	{
@@ -107,8 +109,8 @@ struct HttpRequestStats : HttpMessageStats
  */
 struct HttpResponseStats : HttpMessageStats
 {
-	std::map<std::string, int> statusCodeCount; // a map for counting the different status codes seen in traffic
-	std::map<std::string, int> contentTypeCount; // a map for counting the content-types seen in traffic
+	pcpp::StringCounter statusCodeCount; // counts the different status codes seen in traffic
+	pcpp::StringCounter contentTypeCount; // counts the content-types seen in traffic
 	int numOfMessagesWithContentLength; // total number of responses containing the "content-length" field
 	int totalConentLengthSize; // total body size extracted by responses containing "content-length" field
 	double averageContentLengthSize; // average body size
@@ -126,7 +128,9 @@ struct HttpResponseStats : HttpMessageStats
 
 
 /**
- * The HTTP stats collector. Should be called for every packet arriving and also periodically to calculate rates
+ * The HTTP stats collector. Should be called for every packet arriving and also periodically to calculate rates.
+ * Hostnames, status codes and content-types are counted in interned string tables, so a value which was already seen is counted
+ * without allocating memory. Each capture thread should have its own collector, and the collectors are merged when stats are reported
  */
 class HttpStatsCollector
 {
@@ -134,9 +138,15 @@ public:
 
 	/**
 	 * C'tor - clear all structures
+	 * @param[in] maxNumOfStrings The max number of hostnames, status codes and content-types to count individually. When more are seen
+	 * only the most frequent ones are kept and their counts become upper bounds, so memory stays bounded on long captures. The default
+	 * is 0 which means all of them are counted exactly
 	 */
-	HttpStatsCollector()
+	HttpStatsCollector(size_t maxNumOfStrings = 0)
 	{
+		m_RequestStats.hostnameCount = pcpp::StringCounter(maxNumOfStrings);
+		m_ResponseStats.statusCodeCount = pcpp::StringCounter(maxNumOfStrings);
+		m_ResponseStats.contentTypeCount = pcpp::StringCounter(maxNumOfStrings);
 		clear();
 	}
 
@@ -155,14 +165,14 @@ public:
 			return;
 
 		// collect general HTTP traffic stats on this packet
-		uint32_t hashVal = collectHttpTrafficStats(httpPacket);
+		HttpFlowData& flowData = collectHttpTrafficStats(httpPacket);
 
 		// if packet is an HTTP request - collect HTTP request stats on this packet
 		if (httpPacket->isPacketOfType(pcpp::HTTPRequest))
 		{
 			pcpp::HttpRequestLayer* req = httpPacket->getLayerOfType<pcpp::HttpRequestLayer>();
 			pcpp::TcpLayer* tcpLayer = httpPacket->getLayerOfType<pcpp::TcpLayer>();
-			collectHttpGeneralStats(tcpLayer, req, hashVal);
+			collectHttpGeneralStats(tcpLayer, req, flowData);
 			collectRequestStats(req);
 		}
 		// if packet is an HTTP response - collect HTTP response stats on this packet
@@ -170,7 +180,7 @@ public:
 		{
 			pcpp::HttpResponseLayer* res = httpPacket->getLayerOfType<pcpp::HttpResponseLayer>();
 			pcpp::TcpLayer* tcpLayer = httpPacket->getLayerOfType<pcpp::TcpLayer>();
-			collectHttpGeneralStats(tcpLayer, res, hashVal);
+			collectHttpGeneralStats(tcpLayer, res, flowData);
 			collectResponseStats(res);
 		}
 
@@ -197,8 +207,8 @@ public:
 			m_GeneralStats.httpPacketRate.currentRate = (m_GeneralStats.numOfHttpPackets - m_PrevGeneralStats.numOfHttpPackets) / diffSec;
 			m_GeneralStats.httpFlowRate.currentRate = (m_GeneralStats.numOfHttpFlows - m_PrevGeneralStats.numOfHttpFlows) / diffSec;
 			m_GeneralStats.httpTransactionsRate.currentRate = (m_GeneralStats.numOfHttpTransactions - m_PrevGeneralStats.numOfHttpTransactions) / diffSec;
-			m_RequestStats.messageRate.currentRate = (m_RequestStats.numOfMessages - m_PrevRequestStats.numOfMessages) / diffSec;
-			m_ResponseStats.messageRate.currentRate = (m_ResponseStats.numOfMessages - m_PrevResponseStats.numOfMessages) / diffSec;
+			m_RequestStats.messageRate.currentRate = (m_RequestStats.numOfMessages - m_PrevNumOfRequests) / diffSec;
+			m_ResponseStats.messageRate.currentRate = (m_ResponseStats.numOfMessages - m_PrevNumOfResponses) / diffSec;
 		}
 
 		// getting the time from the beginning of stats collection until now
@@ -216,10 +226,11 @@ public:
 			m_ResponseStats.messageRate.totalRate = m_ResponseStats.numOfMessages / diffSecTotal;
 		}
 
-		// saving current numbers for using them in the next rate calculation
+		// saving current numbers for using them in the next rate calculation. Only the message numbers of the request and response stats
+		// are needed, so their counters aren't copied
 		m_PrevGeneralStats = m_GeneralStats;
-		m_PrevRequestStats = m_RequestStats;
-		m_PrevResponseStats = m_ResponseStats;
+		m_PrevNumOfRequests = m_RequestStats.numOfMessages;
+		m_PrevNumOfResponses = m_ResponseStats.numOfMessages;
 
 		// saving the current time for using in the next rate calculation
 		m_LastCalcRateTime = curTime;
@@ -233,13 +244,59 @@ public:
 		m_GeneralStats.clear();
 		m_PrevGeneralStats.clear();
 		m_RequestStats.clear();
-		m_PrevRequestStats.clear();
+		m_PrevNumOfRequests = 0;
 		m_ResponseStats.clear();
-		m_PrevResponseStats.clear();
+		m_PrevNumOfResponses = 0;
+		m_FlowTable.clear();
 		m_LastCalcRateTime = getCurTime();
 		m_StartTime = m_LastCalcRateTime;
 	}
 
+	/**
+	 * Add the stats of another collector to this one, for example the collector of another capture thread. Flows are identified by
+	 * their hash, so the collectors are expected to see different flows. Current rates aren't merged, calcRates() should be called
+	 * after merging
+	 */
+	void merge(const HttpStatsCollector& other)
+	{
+		m_GeneralStats.numOfHttpFlows += other.m_GeneralStats.numOfHttpFlows;
+		m_GeneralStats.numOfHttpPipeliningFlows += other.m_GeneralStats.numOfHttpPipeliningFlows;
+		m_GeneralStats.numOfHttpTransactions += other.m_GeneralStats.numOfHttpTransactions;
+		m_GeneralStats.numOfHttpPackets += other.m_GeneralStats.numOfHttpPackets;
+		m_GeneralStats.amountOfHttpTraffic += other.m_GeneralStats.amountOfHttpTraffic;
+
+		m_RequestStats.numOfMessages += other.m_RequestStats.numOfMessages;
+		m_RequestStats.totalMessageHeaderSize += other.m_RequestStats.totalMessageHeaderSize;
+		for (std::map<pcpp::HttpRequestLayer::HttpMethod, int>::const_iterator iter = other.m_RequestStats.methodCount.begin();
+				iter != other.m_RequestStats.methodCount.end();
+				iter++)
+		{
+			m_RequestStats.methodCount[iter->first] += iter->second;
+		}
+		m_RequestStats.hostnameCount.merge(other.m_RequestStats.hostnameCount);
+
+		m_ResponseStats.numOfMessages += other.m_ResponseStats.numOfMessages;
+		m_ResponseStats.totalMessageHeaderSize += other.m_ResponseStats.totalMessageHeaderSize;
+		m_ResponseStats.numOfMessagesWithContentLength += other.m_ResponseStats.numOfMessagesWithContentLength;
+		m_ResponseStats.totalConentLengthSize += other.m_ResponseStats.totalConentLengthSize;
+		m_ResponseStats.statusCodeCount.merge(other.m_ResponseStats.statusCodeCount);
+		m_ResponseStats.contentTypeCount.merge(other.m_ResponseStats.contentTypeCount);
+
+		std::vector<std::pair<uint64_t, HttpFlowData> > flows;
+		other.m_FlowTable.getEntries(flows);
+		m_FlowTable.reserve(m_FlowTable.size() + flows.size());
+		for (size_t i = 0; i < flows.size(); i++)
+			m_FlowTable[flows[i].first] = flows[i].second;
+
+		// the merged stats span from the earliest start time
+		if (other.m_StartTime < m_StartTime)
+			m_StartTime = other.m_StartTime;
+		if (other.m_GeneralStats.sampleTime > m_GeneralStats.sampleTime)
+			m_GeneralStats.sampleTime = other.m_GeneralStats.sampleTime;
+
+		calcAverages();
+	}
+
 	/**
 	 * Get HTTP general stats
 	 */
@@ -279,9 +336,9 @@ private:
 
 	/**
 	 * Collect stats relevant for every HTTP packet (request, response or any other)
-	 * This method calculates and returns the flow key for this packet
+	 * This method finds the flow of this packet in the flow table (or adds it) and returns its data
 	 */
-	uint32_t collectHttpTrafficStats(pcpp::Packet* httpPacket)
+	HttpFlowData& collectHttpTrafficStats(pcpp::Packet* httpPacket)
 	{
 		pcpp::TcpLayer* tcpLayer = httpPacket->getLayerOfType<pcpp::TcpLayer>();
 
@@ -294,12 +351,13 @@ private:
 		// calculate a hash key for this flow to be used in the flow table
 		uint32_t hashVal = pcpp::hash5Tuple(httpPacket);
 
-		// if flow is a new flow (meaning it's not already in the flow table)
-		if (m_FlowTable.find(hashVal) == m_FlowTable.end())
+		// find the flow with a single lookup. If flow is a new flow (meaning it's not already in the flow table) count it
+		bool isNewFlow = false;
+		HttpFlowData& flowData = m_FlowTable.get(hashVal, &isNewFlow);
+		if (isNewFlow)
 		{
-			// count this new flow
 			m_GeneralStats.numOfHttpFlows++;
-			m_FlowTable[hashVal].clear();
+			flowData.clear();
 		}
 
 		// calculate averages
@@ -309,65 +367,88 @@ private:
 			m_GeneralStats.averageNumOfPacketsPerFlow = (double)m_GeneralStats.numOfHttpPackets / (double)m_FlowTable.size();
 		}
 
-		return hashVal;
+		return flowData;
+	}
+
+
+	/**
+	 * Calculate all averages from the totals, which is needed after merging collectors
+	 */
+	void calcAverages()
+	{
+		if (m_FlowTable.size() != 0)
+		{
+			m_GeneralStats.averageAmountOfDataPerFlow = (double)m_GeneralStats.amountOfHttpTraffic / (double)m_FlowTable.size();
+			m_GeneralStats.averageNumOfPacketsPerFlow = (double)m_GeneralStats.numOfHttpPackets / (double)m_FlowTable.size();
+			m_GeneralStats.averageNumOfHttpTransactionsPerFlow = (double)m_GeneralStats.numOfHttpTransactions / (double)m_FlowTable.size();
+		}
+
+		if (m_RequestStats.numOfMessages != 0)
+			m_RequestStats.averageMessageHeaderSize = (double)m_RequestStats.totalMessageHeaderSize / (double)m_RequestStats.numOfMessages;
+
+		if (m_ResponseStats.numOfMessages != 0)
+			m_ResponseStats.averageMessageHeaderSize = (double)m_ResponseStats.totalMessageHeaderSize / (double)m_ResponseStats.numOfMessages;
+
+		if (m_ResponseStats.numOfMessagesWithContentLength != 0)
+			m_ResponseStats.averageContentLengthSize = (double)m_ResponseStats.totalConentLengthSize / (double)m_ResponseStats.numOfMessagesWithContentLength;
 	}
 
 
 	/**
 	 * Collect stats relevant for HTTP messages (requests or responses)
 	 */
-	void collectHttpGeneralStats(pcpp::TcpLayer* tcpLayer, pcpp::HttpMessage* message, uint32_t flowKey)
+	void collectHttpGeneralStats(pcpp::TcpLayer* tcpLayer, pcpp::HttpMessage* message, HttpFlowData& flowData)
 	{
 		// if num of current opened transaction is negative it means something went completely wrong
-		if (m_FlowTable[flowKey].numOfOpenTransactions < 0)
+		if (flowData.numOfOpenTransactions < 0)
 			return;
 
 		if (message->getProtocol() == pcpp::HTTPRequest)
 		{
 			// if new packet seq number is smaller than previous seen seq number current it means this packet is
 			// a re-transmitted packet and should be ignored
-			if (m_FlowTable[flowKey].curSeqNumberRequests >= ntohl(tcpLayer->getTcpHeader()->sequenceNumber))
+			if (flowData.curSeqNumberRequests >= ntohl(tcpLayer->getTcpHeader()->sequenceNumber))
 				return;
 
 			// a new request - increase num of open transactions
-			m_FlowTable[flowKey].numOfOpenTransactions++;
+			flowData.numOfOpenTransactions++;
 
 			// if the previous message seen on this flow is HTTP request and if flow is not already marked as HTTP pipelining -
 			// mark it as so and increase number of HTTP pipelining flows
-			if (!m_FlowTable[flowKey].httpPipeliningFlow && m_FlowTable[flowKey].lastSeenMessage == pcpp::HTTPRequest)
+			if (!flowData.httpPipeliningFlow && flowData.lastSeenMessage == pcpp::HTTPRequest)
 			{
-				m_FlowTable[flowKey].httpPipeliningFlow = true;
+				flowData.httpPipeliningFlow = true;
 				m_GeneralStats.numOfHttpPipeliningFlows++;
 			}
 
 			// set last seen message on flow as HTTP request
-			m_FlowTable[flowKey].lastSeenMessage = pcpp::HTTPRequest;
+			flowData.lastSeenMessage = pcpp::HTTPRequest;
 
 			// set last seen sequence number
-			m_FlowTable[flowKey].curSeqNumberRequests = ntohl(tcpLayer->getTcpHeader()->sequenceNumber);
+			flowData.curSeqNumberRequests = ntohl(tcpLayer->getTcpHeader()->sequenceNumber);
 		}
 		else if (message->getProtocol() == pcpp::HTTPResponse)
 		{
 			// if new packet seq number is smaller than previous seen seq number current it means this packet is
 			// a re-transmitted packet and should be ignored
-			if (m_FlowTable[flowKey].curSeqNumberResponses >= ntohl(tcpLayer->getTcpHeader()->sequenceNumber))
+			if (flowData.curSeqNumberResponses >= ntohl(tcpLayer->getTcpHeader()->sequenceNumber))
 				return;
 
 			// a response - decrease num of open transactions
-			m_FlowTable[flowKey].numOfOpenTransactions--;
+			flowData.numOfOpenTransactions--;
 
 			// if the previous message seen on this flow is HTTP response and if flow is not already marked as HTTP pipelining -
 			// mark it as so and increase number of HTTP pipelining flows
-			if (!m_FlowTable[flowKey].httpPipeliningFlow && m_FlowTable[flowKey].lastSeenMessage == pcpp::HTTPResponse)
+			if (!flowData.httpPipeliningFlow && flowData.lastSeenMessage == pcpp::HTTPResponse)
 			{
-				m_FlowTable[flowKey].httpPipeliningFlow = true;
+				flowData.httpPipeliningFlow = true;
 				m_GeneralStats.numOfHttpPipeliningFlows++;
 			}
 
 			// set last seen message on flow as HTTP response
-			m_FlowTable[flowKey].lastSeenMessage = pcpp::HTTPResponse;
+			flowData.lastSeenMessage = pcpp::HTTPResponse;
 
-			if (m_FlowTable[flowKey].numOfOpenTransactions >= 0)
+			if (flowData.numOfOpenTransactions >= 0)
 			{
 				// a transaction was closed - increase number of complete transactions
 				m_GeneralStats.numOfHttpTransactions++;
@@ -378,7 +459,7 @@ private:
 			}
 
 			// set last seen sequence number
-			m_FlowTable[flowKey].curSeqNumberResponses = ntohl(tcpLayer->getTcpHeader()->sequenceNumber);
+			flowData.curSeqNumberResponses = ntohl(tcpLayer->getTcpHeader()->sequenceNumber);
 		}
 	}
 
@@ -393,10 +474,10 @@ private:
 		if (m_RequestStats.numOfMessages != 0)
 			m_RequestStats.averageMessageHeaderSize = (double)m_RequestStats.totalMessageHeaderSize / (double)m_RequestStats.numOfMessages;
 
-		// extract hostname and add to hostname count map
+		// extract hostname and count it. The value is counted directly from the packet data without copying it
 		pcpp::HeaderField* hostField = req->getFieldByName(PCPP_HTTP_HOST_FIELD);
 		if (hostField != NULL)
-			m_RequestStats.hostnameCount[hostField->getFieldValue()]++;
+			m_RequestStats.hostnameCount.add(hostField->getFieldValueData(), hostField->getFieldValueLength());
 
 		m_RequestStats.methodCount[req->getFirstLine()->getMethod()]++;
 	}
@@ -422,27 +503,40 @@ private:
 				m_ResponseStats.averageContentLengthSize = (double)m_ResponseStats.totalConentLengthSize / (double)m_ResponseStats.numOfMessagesWithContentLength;
 		}
 
-		// extract content-type and add to content-type map
+		// extract content-type and count it
 		pcpp::HeaderField* contentTypeField = res->getFieldByName(PCPP_HTTP_CONTENT_TYPE_FIELD);
 		if (contentTypeField != NULL)
 		{
-			std::string contentType = contentTypeField->getFieldValue();
+			const char* contentType = contentTypeField->getFieldValueData();
+			size_t contentTypeLen = contentTypeField->getFieldValueLength();
 
 			// sometimes content-type contains also the charset it uses.
 			// for example: "application/javascript; charset=UTF-8"
 			// remove charset as it's not relevant for these stats
-			size_t charsetPos = contentType.find(";");
-			if (charsetPos != std::string::npos)
-				contentType = contentType.substr(0, charsetPos);
+			const char* charsetPos = (contentType != NULL ? (const char*)memchr(contentType, ';', contentTypeLen) : NULL);
+			if (charsetPos != NULL)
+				contentTypeLen = charsetPos - contentType;
 
-			m_ResponseStats.contentTypeCount[contentType]++;
+			m_ResponseStats.contentTypeCount.add(contentType, contentTypeLen);
 		}
 
-		// collect status code - create one string from status code and status description (for example: 200 OK)
-		std::ostringstream stream;
-		stream << res->getFirstLine()->getStatusCodeAsInt();
-		std::string statusCode = stream.str() + " " + res->getFirstLine()->getStatusCodeString();
-		m_ResponseStats.statusCodeCount[statusCode]++;
+		// collect status code - status code and status description (for example: 200 OK) are counted together. For known status codes
+		// they're taken directly from the first line, which starts with "HTTP/x.y "
+		pcpp::HttpResponseFirstLine* firstLine = res->getFirstLine();
+		int statusCodeEndOffset = firstLine->getSize() - 2;
+		if (firstLine->getStatusCode() != pcpp::HttpResponseLayer::HttpStatusCodeUnknown && statusCodeEndOffset > HttpStatusCodeOffset)
+		{
+			const char* line = (const char*)res->getData();
+			if (line[statusCodeEndOffset] != '\r')
+				statusCodeEndOffset++;
+			m_ResponseStats.statusCodeCount.add(line + HttpStatusCodeOffset, statusCodeEndOffset - HttpStatusCodeOffset);
+		}
+		else
+		{
+			std::ostringstream stream;
+			stream << firstLine->getStatusCodeAsInt();
+			m_ResponseStats.statusCodeCount.add(stream.str() + " " + firstLine->getStatusCodeString());
+		}
 	}
 
 	double getCurTime(void)
@@ -454,14 +548,17 @@ private:
 	    return (((double) tv.tv_sec) + (double) (tv.tv_usec / 1000000.0));
 	}
 
+	// the offset of the status code in the first line of a response, after "HTTP/x.y "
+	static const int HttpStatusCodeOffset = 9;
+
 	HttpGeneralStats m_GeneralStats;
 	HttpGeneralStats m_PrevGeneralStats;
 	HttpRequestStats m_RequestStats;
-	HttpRequestStats m_PrevRequestStats;
+	int m_PrevNumOfRequests;
 	HttpResponseStats m_ResponseStats;
-	HttpResponseStats m_PrevResponseStats;
+	int m_PrevNumOfResponses;
 
-	std::map<uint32_t, HttpFlowData> m_FlowTable;
+	pcpp::FlatHashMap<HttpFlowData> m_FlowTable;
 
 	double m_LastCalcRateTime;
 	double m_StartTime;
@@ -13,6 +13,10 @@
  * - HTTP status code map
  * - content-type map
  *
+ * Both modes can run the analysis on several threads (see the -t option). Packets are distributed between the threads by flow, so each
+ * thread keeps its own collector and flow table without sharing them, and the collectors are merged when the summary is printed.
+ * In live traffic mode packets can also be captured with PF_RING or DPDK if PcapPlusPlus was built with them.
+ *
  * For more details about modes of operation and parameters run HttpAnalyzer -h
  */
 
@@ -25,6 +29,16 @@
 #include "PcapLiveDeviceList.h"
 #include "PcapFilter.h"
 #include "PcapFileDevice.h"
+#include "PrefetchingFileReader.h"
+#include "BenchmarkHarness.h"
+#include "FlowDispatcher.h"
+#include "StatsReporter.h"
+#ifdef USE_PF_RING
+#include "PfRingDeviceList.h"
+#endif
+#ifdef USE_DPDK
+#include "DpdkDeviceList.h"
+#endif
 #include "HttpStatsCollector.h"
 #include "TablePrinter.h"
 #include "PlatformSpecificUtils.h"
@@ -54,6 +68,9 @@
 
 #define DEFAULT_CALC_RATES_PERIOD_SEC 2
 
+#define DPDK_MBUF_POOL_SIZE 16383
+#define DPDK_RECEIVE_BURST_SIZE 64
+
 using namespace pcpp;
 
 static struct option HttpAnalyzerOptions[] =
@@ -63,6 +80,10 @@ static struct option HttpAnalyzerOptions[] =
 	{"output-file", required_argument, 0, 'o'},
 	{"rate-calc-period", required_argument, 0, 'r'},
 	{"disable-rates-print", no_argument, 0, 'd'},
+	{"top-k", required_argument, 0, 'k'},
+	{"threads", required_argument, 0, 't'},
+	{"pf-ring-interface", required_argument, 0, 'p'},
+	{"dpdk-port", required_argument, 0, 'P'},
 	{"list-interfaces", no_argument, 0, 'l'},
 	{"help", no_argument, 0, 'h'},
 	{"version", no_argument, 0, 'v'},
@@ -78,6 +99,96 @@ struct HttpPacketArrivedData
 };
 
 
+/**
+ * The IDs of the counters the analysis threads publish for the rates report of the multi-threaded modes
+ */
+enum HttpRateCounterId
+{
+	HttpPacketsCounter,
+	HttpFlowsCounter,
+	HttpTransactionsCounter,
+	HttpDataCounter,
+	HttpRequestsCounter,
+	HttpResponsesCounter,
+	NumOfHttpRateCounters
+};
+
+
+/**
+ * The data of a single analysis thread in the multi-threaded modes. The packets are distributed between the threads by flow, so each
+ * thread owns a shard of the flow table in its own collector
+ */
+struct HttpWorkerData
+{
+	HttpStatsCollector* statsCollector;
+	StatsCounters* rateCounters;
+	int workerId;
+};
+
+
+/**
+ * The analysis threads of the multi-threaded modes. Each thread updates only its own collector, and publishes its message and
+ * traffic counters to a shared StatsCounters instance so the rates can be reported without stopping or locking the threads. The
+ * collectors themselves are merged only after the threads stop
+ */
+class HttpWorkers
+{
+public:
+	HttpWorkers(int numOfWorkers, size_t topK) : m_RateCounters(getRateCounterNames(), numOfWorkers)
+	{
+		for (int i = 0; i < numOfWorkers; i++)
+		{
+			HttpWorkerData worker;
+			worker.statsCollector = new HttpStatsCollector(topK);
+			worker.rateCounters = &m_RateCounters;
+			worker.workerId = i;
+			m_Workers.push_back(worker);
+		}
+	}
+
+	~HttpWorkers()
+	{
+		for (size_t i = 0; i < m_Workers.size(); i++)
+			delete m_Workers[i].statsCollector;
+	}
+
+	HttpWorkerData& getWorker(int workerId) { return m_Workers[workerId]; }
+
+	int getNumOfWorkers() const { return (int)m_Workers.size(); }
+
+	StatsCounters& getRateCounters() { return m_RateCounters; }
+
+	/**
+	 * Merge the collectors of all threads into a single collector. Should be called only after the threads stopped
+	 */
+	void mergeStats(HttpStatsCollector& collector)
+	{
+		for (size_t i = 0; i < m_Workers.size(); i++)
+			collector.merge(*m_Workers[i].statsCollector);
+	}
+
+private:
+	std::vector<HttpWorkerData> m_Workers;
+	StatsCounters m_RateCounters;
+
+	static std::vector<std::string> getRateCounterNames()
+	{
+		std::vector<std::string> names(NumOfHttpRateCounters);
+		names[HttpPacketsCounter] = "HTTP packets";
+		names[HttpFlowsCounter] = "HTTP flows";
+		names[HttpTransactionsCounter] = "HTTP transactions";
+		names[HttpDataCounter] = "HTTP data";
+		names[HttpRequestsCounter] = "HTTP requests";
+		names[HttpResponsesCounter] = "HTTP responses";
+		return names;
+	}
+
+	// disable copy c'tor and assignment operator
+	HttpWorkers(const HttpWorkers& other);
+	HttpWorkers& operator=(const HttpWorkers& other);
+};
+
+
 /**
  * Print application usage
  */
@@ -85,22 +196,38 @@ void printUsage()
 {
 	printf("\nUsage: PCAP file mode:\n"
 			"----------------------\n"
-			"%s [-vh] -f input_file\n"
+			"%s [-vh] [--benchmark[=ITERATIONS]] [-k top_k] [-t threads] -f input_file\n"
 			"\nOptions:\n\n"
 			"    -f           : The input pcap/pcapng file to analyze. Required argument for this mode\n"
+			"    -k top_k     : Count only the top_k most frequent hostnames, status codes and content-types, in bounded memory.\n"
+			"                   Their counts may be overestimated. If not provided all of them are counted exactly\n"
+			"    -t threads   : Analyze the file on this number of threads. The packets are distributed between the threads by flow.\n"
+			"                   If not provided the file is analyzed on a single thread\n"
 			"    -v             : Displays the current version and exists\n"
-			"    -h           : Displays this help message and exits\n\n"
+			"    -h           : Displays this help message and exits\n"
+			"%s\n"
 			"Usage: Live traffic mode:\n"
 			"-------------------------\n"
-			"%s [-hvld] [-o output_file] [-r calc_period] -i interface\n"
+			"%s [-hvld] [-o output_file] [-r calc_period] [-k top_k] [-t threads] -i interface\n"
 			"\nOptions:\n\n"
 			"    -i interface   : Use the specified interface. Can be interface name (e.g eth0) or interface IPv4 address\n"
 			"    -o output_file : Save all captured HTTP packets to a pcap file. Notice this may cause performance degradation\n"
 			"    -r calc_period : The period in seconds to calculate rates. If not provided default is 2 seconds\n"
+			"    -k top_k       : Count only the top_k most frequent hostnames, status codes and content-types, in bounded memory.\n"
+			"                     Their counts may be overestimated. If not provided all of them are counted exactly\n"
+			"    -t threads     : Capture and analyze on this number of threads. The packets are distributed between the threads by flow\n"
+			"                     (by the kernel, the PF_RING RX channels or the DPDK RX queues). Can't be used with -o. If not provided\n"
+			"                     packets are captured and analyzed on a single thread\n"
 			"    -d             : Disable periodic rates calculation\n"
 			"    -h             : Displays this help message and exits\n"
 			"    -v             : Displays the current version and exists\n"
-			"    -l             : Print the list of interfaces and exists\n", AppName::get().c_str(), AppName::get().c_str());
+			"    -l             : Print the list of interfaces and exists\n", AppName::get().c_str(), BenchmarkHarness::getUsage(), AppName::get().c_str());
+#ifdef USE_PF_RING
+	printf("    -p interface   : Capture with PF_RING from the specified interface instead of -i, on an RX channel per thread\n");
+#endif
+#ifdef USE_DPDK
+	printf("    -P port_id     : Capture with DPDK from the specified DPDK port instead of -i, on an RX queue per thread\n");
+#endif
 	exit(0);
 }
 
@@ -153,6 +280,128 @@ void httpPacketArrive(RawPacket* packet, PcapLiveDevice* dev, void* cookie)
 	}
 }
 
+
+/**
+ * Analyze a packet on an analysis thread of the multi-threaded modes
+ */
+inline void analyzePacket(RawPacket* packet, HttpWorkerData& worker)
+{
+	Packet parsedPacket(packet);
+	worker.statsCollector->collectStats(&parsedPacket);
+}
+
+
+/**
+ * Publish the counters of an analysis thread for the rates report. The counters are plain stores to the thread's own cache line, so
+ * this is cheap enough to be done after every packet or burst
+ */
+inline void publishRateCounters(HttpWorkerData& worker)
+{
+	HttpStatsCollector& collector = *worker.statsCollector;
+	StatsCounters& counters = *worker.rateCounters;
+	counters.set(worker.workerId, HttpPacketsCounter, collector.getGeneralStats().numOfHttpPackets);
+	counters.set(worker.workerId, HttpFlowsCounter, collector.getGeneralStats().numOfHttpFlows);
+	counters.set(worker.workerId, HttpTransactionsCounter, collector.getGeneralStats().numOfHttpTransactions);
+	counters.set(worker.workerId, HttpDataCounter, collector.getGeneralStats().amountOfHttpTraffic);
+	counters.set(worker.workerId, HttpRequestsCounter, collector.getRequestStats().numOfMessages);
+	counters.set(worker.workerId, HttpResponsesCounter, collector.getResponseStats().numOfMessages);
+}
+
+
+/**
+ * packet capture callback of the multi-threaded live traffic mode - called on the capture thread the kernel put the packet's flow on
+ */
+void httpPacketArriveMultiThread(RawPacket* packet, uint8_t threadId, PcapLiveDevice* dev, void* cookie)
+{
+	HttpWorkerData& worker = ((HttpWorkers*)cookie)->getWorker(threadId);
+	analyzePacket(packet, worker);
+	publishRateCounters(worker);
+}
+
+
+/**
+ * FlowDispatcher callback of the multi-threaded file mode - called with a burst of packets of the flows of a worker thread
+ */
+void httpPacketsDispatched(RawPacket* packets, uint32_t numOfPackets, int workerIndex, FlowDispatcher* dispatcher, void* cookie)
+{
+	HttpWorkerData& worker = ((HttpWorkers*)cookie)->getWorker(workerIndex);
+	for (uint32_t i = 0; i < numOfPackets; i++)
+		analyzePacket(&packets[i], worker);
+}
+
+
+#ifdef USE_PF_RING
+/**
+ * PF_RING capture callback - called with a burst of packets on the capture thread of an RX channel. Capture threads are identified by
+ * the core they run on
+ */
+void httpPacketsArrivePfRing(RawPacket* packets, uint32_t numOfPackets, uint8_t threadId, PfRingDevice* device, void* cookie)
+{
+	HttpWorkerData& worker = ((HttpWorkers*)cookie)->getWorker(threadId);
+	for (uint32_t i = 0; i < numOfPackets; i++)
+		analyzePacket(&packets[i], worker);
+	publishRateCounters(worker);
+}
+#endif
+
+
+#ifdef USE_DPDK
+/**
+ * A DPDK worker thread which receives and analyzes the packets of a single RX queue
+ */
+class HttpDpdkWorkerThread : public DpdkWorkerThread
+{
+public:
+	HttpDpdkWorkerThread(DpdkDevice* device, uint16_t rxQueueId, HttpWorkerData& worker) :
+		m_Device(device), m_RxQueueId(rxQueueId), m_Worker(worker), m_Stop(true), m_CoreId(MAX_NUM_OF_CORES+1)
+	{
+	}
+
+	bool run(uint32_t coreId)
+	{
+		m_CoreId = coreId;
+		m_Stop = false;
+
+		// the MBufRawPacket objects are reused by each receive call, so the loop doesn't allocate memory
+		MBufRawPacket* packetArr[DPDK_RECEIVE_BURST_SIZE] = {};
+
+		while (!m_Stop)
+		{
+			uint16_t packetsReceived = m_Device->receivePackets(packetArr, DPDK_RECEIVE_BURST_SIZE, m_RxQueueId);
+			if (packetsReceived == 0)
+				continue;
+
+			for (uint16_t i = 0; i < packetsReceived; i++)
+				analyzePacket(packetArr[i], m_Worker);
+
+			publishRateCounters(m_Worker);
+		}
+
+		for (int i = 0; i < DPDK_RECEIVE_BURST_SIZE; i++)
+			delete packetArr[i];
+
+		return true;
+	}
+
+	void stop()
+	{
+		m_Stop = true;
+	}
+
+	uint32_t getCoreId()
+	{
+		return m_CoreId;
+	}
+
+private:
+	DpdkDevice* m_Device;
+	uint16_t m_RxQueueId;
+	HttpWorkerData& m_Worker;
+	volatile bool m_Stop;
+	uint32_t m_CoreId;
+};
+#endif
+
 /**
  * Print the method count table
  */
@@ -222,15 +471,26 @@ void printMethods(HttpRequestStats& reqStatscollector)
 
 
 /**
- * An auxiliary method for sorting the hostname count map. Used only in printHostnames()
+ * Print the strings of a string counter and their counts, sorted by popularity (most popular strings will be first)
  */
-bool hostnameComparer(std::pair<std::string, int> first, std::pair<std::string, int> second)
+void printStringCounts(const StringCounter& counter, TablePrinter& printer)
 {
-	return first.second > second.second;
+	std::vector<std::pair<std::string, uint64_t> > sortedCounts;
+	counter.getSortedCounts(sortedCounts);
+
+	// go over all items (string + count) in the sorted vector and print them
+	for(std::vector<std::pair<std::string, uint64_t> >::iterator iter = sortedCounts.begin();
+			iter != sortedCounts.end();
+			iter++)
+	{
+		std::stringstream values;
+		values << iter->first << "|" << iter->second;
+		printer.printRow(values.str(), '|');
+	}
 }
 
 /**
- * Print the hostname count map to a table sorted by popularity (most popular hostnames will be first)
+ * Print the hostname counts to a table sorted by popularity (most popular hostnames will be first)
  */
 void printHostnames(HttpRequestStats& reqStatscollector)
 {
@@ -243,20 +503,7 @@ void printHostnames(HttpRequestStats& reqStatscollector)
 	columnsWidths.push_back(5);
 	TablePrinter printer(columnNames, columnsWidths);
 
-	// sort the hostname count map so the most popular hostnames will be first
-	// since it's not possible to sort a std::map you must copy it to a std::vector and sort it then
-	std::vector<std::pair<std::string, int> > map2vec(reqStatscollector.hostnameCount.begin(), reqStatscollector.hostnameCount.end());
-	std::sort(map2vec.begin(),map2vec.end(), &hostnameComparer);
-
-	// go over all items (hostname + count) in the sorted vector and print them
-	for(std::vector<std::pair<std::string, int> >::iterator iter = map2vec.begin();
-			iter != map2vec.end();
-			iter++)
-	{
-		std::stringstream values;
-		values << iter->first << "|" << iter->second;
-		printer.printRow(values.str(), '|');
-	}
+	printStringCounts(reqStatscollector.hostnameCount, printer);
 }
 
 
@@ -274,15 +521,7 @@ void printStatusCodes(HttpResponseStats& resStatscollector)
 	columnsWidths.push_back(5);
 	TablePrinter printer(columnNames, columnsWidths);
 
-	// go over the status code map and print each item
-	for(std::map<std::string, int>::iterator iter = resStatscollector.statusCodeCount.begin();
-			iter != resStatscollector.statusCodeCount.end();
-			iter++)
-	{
-		std::stringstream values;
-		values << iter->first << "|" << iter->second;
-		printer.printRow(values.str(), '|');
-	}
+	printStringCounts(resStatscollector.statusCodeCount, printer);
 }
 
 
@@ -300,15 +539,7 @@ void printContentTypes(HttpResponseStats& resStatscollector)
 	columnsWidths.push_back(5);
 	TablePrinter printer(columnNames, columnsWidths);
 
-	// go over the status code map and print each item
-	for(std::map<std::string, int>::iterator iter = resStatscollector.contentTypeCount.begin();
-			iter != resStatscollector.contentTypeCount.end();
-			iter++)
-	{
-		std::stringstream values;
-		values << iter->first << "|" << iter->second;
-		printer.printRow(values.str(), '|');
-	}
+	printStringCounts(resStatscollector.contentTypeCount, printer);
 }
 
 
@@ -337,6 +568,7 @@ void printStatsSummary(HttpStatsCollector& collector)
 	PRINT_STAT_LINE_DOUBLE("Rate of HTTP requests", collector.getRequestStats().messageRate.totalRate, "Requests/sec");
 	PRINT_STAT_LINE_INT("Total data in headers", collector.getRequestStats().totalMessageHeaderSize, "Bytes");
 	PRINT_STAT_LINE_DOUBLE("Average header size", collector.getRequestStats().averageMessageHeaderSize, "Bytes");
+	PRINT_STAT_LINE_INT("Number of distinct hostnames", (int)collector.getRequestStats().hostnameCount.getNumOfDistinctStrings(), "Hostnames");
 
 	PRINT_STAT_HEADLINE("HTTP response stats");
 	PRINT_STAT_LINE_INT("Number of HTTP responses", collector.getResponseStats().numOfMessages, "Responses");
@@ -376,6 +608,25 @@ void printCurrentRates(HttpStatsCollector& collector)
 }
 
 
+/**
+ * Prints the current rates of the multi-threaded modes, which are calculated from the counters published by all analysis threads
+ */
+class HttpRatesPrinter : public StatsSink
+{
+public:
+	void write(const StatsSnapshot& snapshot)
+	{
+		PRINT_STAT_HEADLINE("Current HTTP rates");
+		PRINT_STAT_LINE_DOUBLE("Rate of HTTP packets", snapshot.getRate(HttpPacketsCounter), "Packets/sec");
+		PRINT_STAT_LINE_DOUBLE("Rate of HTTP flows", snapshot.getRate(HttpFlowsCounter), "Flows/sec");
+		PRINT_STAT_LINE_DOUBLE("Rate of HTTP transactions", snapshot.getRate(HttpTransactionsCounter), "Transactions/sec");
+		PRINT_STAT_LINE_DOUBLE("Rate of HTTP data", snapshot.getRate(HttpDataCounter), "Bytes/sec");
+		PRINT_STAT_LINE_DOUBLE("Rate of HTTP requests", snapshot.getRate(HttpRequestsCounter), "Requests/sec");
+		PRINT_STAT_LINE_DOUBLE("Rate of HTTP responses", snapshot.getRate(HttpResponsesCounter), "Responses/sec");
+	}
+};
+
+
 /**
  * The callback to be called when application is terminated by ctrl-c. Stops the endless while loop
  */
@@ -386,10 +637,51 @@ void onApplicationInterrupted(void* cookie)
 }
 
 
+/**
+ * Print the rates of the analysis threads of a multi-threaded mode periodically, until the application is interrupted. The rates are
+ * calculated from the counters the threads publish, so the threads aren't stopped or locked for the report
+ */
+void reportRatesUntilInterrupted(HttpWorkers& workers, bool printRatesPeriodicaly, int printRatePeriod)
+{
+	HttpRatesPrinter ratesPrinter;
+	StatsReporter reporter(workers.getRateCounters());
+	reporter.addSink(&ratesPrinter);
+
+	// register the on app close event to print summary stats on app termination
+	bool shouldStop = false;
+	ApplicationEventHandler::getInstance().onApplicationInterrupted(onApplicationInterrupted, &shouldStop);
+
+	while(!shouldStop)
+	{
+		PCAP_SLEEP(printRatePeriod);
+
+		if (printRatesPeriodicaly)
+			reporter.report();
+	}
+}
+
+
+/**
+ * Merge the collectors of the analysis threads of a multi-threaded mode and print the summary. Should be called after the threads stopped
+ */
+void printWorkersStatsSummary(HttpWorkers& workers, size_t topK, bool calcRates)
+{
+	HttpStatsCollector collector(topK);
+	workers.mergeStats(collector);
+
+	if (calcRates)
+		collector.calcRates();
+
+	printf("\n\nSTATS SUMMARY\n");
+	printf("=============\n");
+	printStatsSummary(collector);
+}
+
+
 /**
  * activate HTTP analysis from pcap file
  */
-void analyzeHttpFromPcapFile(std::string pcapFileName)
+void analyzeHttpFromPcapFile(std::string pcapFileName, int numOfThreads, size_t topK)
 {
 	// open input file (pcap or pcapng file)
 	IFileReaderDevice* reader = IFileReaderDevice::getReader(pcapFileName.c_str());
@@ -402,20 +694,49 @@ void analyzeHttpFromPcapFile(std::string pcapFileName)
 	if (!reader->setFilter(httpPortFilter))
 		EXIT_WITH_ERROR("Could not set up filter on file");
 
-	// read the input file packet by packet and give it to the HttpStatsCollector for collecting stats
-	HttpStatsCollector collector;
-	RawPacket rawPacket;
-	while(reader->getNextPacket(rawPacket))
+	// packets are read in a background thread while the previous ones are processed
+	PrefetchingFileReader prefetchingReader(*reader);
+	if (!prefetchingReader.start())
+		EXIT_WITH_ERROR("Could not start reading the input file");
+
+	RawPacket* rawPacket;
+	if (numOfThreads > 1)
 	{
-		Packet parsedPacket(&rawPacket);
-		collector.collectStats(&parsedPacket);
+		// distribute the packets between the analysis threads by flow. The dispatcher copies each packet into the queue of its thread
+		HttpWorkers workers(numOfThreads, topK);
+		FlowDispatcher dispatcher(httpPacketsDispatched, &workers, FlowDispatcherConfiguration(numOfThreads));
+		if (!dispatcher.start())
+			EXIT_WITH_ERROR("Could not start the analysis threads");
+
+		while((rawPacket = prefetchingReader.getNextPacket()) != NULL)
+		{
+			dispatcher.dispatchPacket(rawPacket);
+		}
+
+		// wait for the threads to analyze all queued packets
+		dispatcher.stop();
+		prefetchingReader.stop();
+
+		printWorkersStatsSummary(workers, topK, false);
 	}
+	else
+	{
+		// read the input file packet by packet and give it to the HttpStatsCollector for collecting stats
+		HttpStatsCollector collector(topK);
+		while((rawPacket = prefetchingReader.getNextPacket()) != NULL)
+		{
+			Packet parsedPacket(rawPacket);
+			collector.collectStats(&parsedPacket);
+		}
 
-	// print stats summary
-	printf("\n\n");
-	printf("STATS SUMMARY\n");
-	printf("=============\n");
-	printStatsSummary(collector);
+		prefetchingReader.stop();
+
+		// print stats summary
+		printf("\n\n");
+		printf("STATS SUMMARY\n");
+		printf("=============\n");
+		printStatsSummary(collector);
+	}
 
 	// close input file
 	reader->close();
@@ -425,10 +746,44 @@ void analyzeHttpFromPcapFile(std::string pcapFileName)
 }
 
 
+/**
+ * activate benchmark mode: the HTTP packets of the pcap file are read into memory and analyzed several times
+ */
+void benchmarkHttpFromPcapFile(std::string pcapFileName, const BenchmarkConfiguration& benchmarkConfig, size_t topK)
+{
+	BenchmarkHarness harness(AppName::get(), benchmarkConfig);
+
+	PortFilter httpPortFilter(80, SRC_OR_DST);
+	if (!harness.loadFile(pcapFileName, &httpPortFilter))
+		EXIT_WITH_ERROR("Could not read input pcap file");
+
+	int parseStage = harness.addStage("parse");
+	int collectStage = harness.addStage("collect stats");
+
+	while (harness.startIteration())
+	{
+		HttpStatsCollector collector(topK);
+		for (size_t i = 0; i < harness.getNumOfPackets(); i++)
+		{
+			harness.beginStage(parseStage);
+			Packet parsedPacket(harness.getPacket(i));
+			harness.endStage(parseStage);
+
+			harness.beginStage(collectStage);
+			collector.collectStats(&parsedPacket);
+			harness.endStage(collectStage);
+		}
+		harness.endIteration();
+	}
+
+	harness.printReport();
+}
+
+
 /**
  * activate HTTP analysis from live traffic
  */
-void analyzeHttpFromLiveTraffic(PcapLiveDevice* dev, bool printRatesPeriodicaly, int printRatePeriod, std::string savePacketsToFileName)
+void analyzeHttpFromLiveTraffic(PcapLiveDevice* dev, bool printRatesPeriodicaly, int printRatePeriod, std::string savePacketsToFileName, size_t topK)
 {
 	// open the device
 	if (!dev->open())
@@ -452,7 +807,7 @@ void analyzeHttpFromLiveTraffic(PcapLiveDevice* dev, bool printRatesPeriodicaly,
 
 	// start capturing packets and collecting stats
 	HttpPacketArrivedData data;
-	HttpStatsCollector collector;
+	HttpStatsCollector collector(topK);
 	data.statsCollector = &collector;
 	data.pcapWriter = pcapWriter;
 	dev->startCapture(httpPacketArrive, &data);
@@ -494,6 +849,110 @@ void analyzeHttpFromLiveTraffic(PcapLiveDevice* dev, bool printRatesPeriodicaly,
 	}
 }
 
+
+/**
+ * activate HTTP analysis from live traffic on several capture threads. The kernel distributes the packets between the threads by flow
+ * (PACKET_FANOUT), and each thread analyzes the packets it captures
+ */
+void analyzeHttpFromLiveTrafficMultiThread(PcapLiveDevice* dev, int numOfThreads, bool printRatesPeriodicaly, int printRatePeriod, size_t topK)
+{
+	// open the device
+	if (!dev->open())
+		EXIT_WITH_ERROR("Could not open the device");
+
+	// set a port 80 filter on the live device to capture only HTTP packets. The filter is set on the handles of all capture threads
+	PortFilter httpPortFilter(80, SRC_OR_DST);
+	if (!dev->setFilter(httpPortFilter))
+		EXIT_WITH_ERROR("Could not set up filter on device");
+
+	HttpWorkers workers(numOfThreads, topK);
+	if (!dev->startCaptureMultiThread((uint8_t)numOfThreads, httpPacketArriveMultiThread, &workers))
+		EXIT_WITH_ERROR("Could not start capturing on %d threads", numOfThreads);
+
+	reportRatesUntilInterrupted(workers, printRatesPeriodicaly, printRatePeriod);
+
+	// stop capturing and close the live device
+	dev->stopCapture();
+	dev->close();
+
+	printWorkersStatsSummary(workers, topK, true);
+}
+
+
+#ifdef USE_PF_RING
+/**
+ * activate HTTP analysis from live traffic captured with PF_RING. An RX channel is opened for each thread and PF_RING distributes the
+ * packets between the channels by flow
+ */
+void analyzeHttpFromPfRing(std::string interfaceName, int numOfThreads, bool printRatesPeriodicaly, int printRatePeriod, size_t topK)
+{
+	PfRingDevice* dev = PfRingDeviceList::getInstance().getPfRingDeviceByName(interfaceName);
+	if (dev == NULL)
+		EXIT_WITH_ERROR("Couldn't find PF_RING device '%s'", interfaceName.c_str());
+
+	if (!dev->openMultiRxChannels((uint8_t)numOfThreads, PfRingDevice::PerFlow))
+		EXIT_WITH_ERROR("Couldn't open %d RX channels on PF_RING device '%s'", numOfThreads, interfaceName.c_str());
+
+	PortFilter httpPortFilter(80, SRC_OR_DST);
+	if (!dev->setFilter(httpPortFilter))
+		EXIT_WITH_ERROR("Could not set up filter on PF_RING device");
+
+	// the capture threads are identified by the core they run on, so there is a collector for each core
+	HttpWorkers workers(getNumOfCores(), topK);
+	if (!dev->startCaptureMultiThread(httpPacketsArrivePfRing, &workers))
+		EXIT_WITH_ERROR("Couldn't start capturing on PF_RING device '%s'", interfaceName.c_str());
+
+	reportRatesUntilInterrupted(workers, printRatesPeriodicaly, printRatePeriod);
+
+	dev->stopCapture();
+	dev->close();
+
+	printWorkersStatsSummary(workers, topK, true);
+}
+#endif
+
+
+#ifdef USE_DPDK
+/**
+ * activate HTTP analysis from live traffic captured with DPDK. An RX queue is opened for each thread and RSS distributes the packets
+ * between the queues by flow. The default RSS key of DpdkDevice is symmetric, so both directions of a flow reach the same queue
+ */
+void analyzeHttpFromDpdk(int dpdkPortId, int numOfThreads, bool printRatesPeriodicaly, int printRatePeriod, size_t topK)
+{
+	// DPDK is initialized on all cores. The rates are reported from the master core and the worker threads run on cores local to the NIC
+	if (!DpdkDeviceList::initDpdk(getCoreMaskForAllMachineCores(), DPDK_MBUF_POOL_SIZE))
+		EXIT_WITH_ERROR("Couldn't initialize DPDK");
+
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(dpdkPortId);
+	if (dev == NULL)
+		EXIT_WITH_ERROR("Couldn't find DPDK port %d", dpdkPortId);
+
+	if (numOfThreads > dev->getTotalNumOfRxQueues())
+		EXIT_WITH_ERROR("DPDK port %d has only %d RX queues", dpdkPortId, (int)dev->getTotalNumOfRxQueues());
+
+	if (!dev->openMultiQueues((uint16_t)numOfThreads, 1))
+		EXIT_WITH_ERROR("Couldn't open %d RX queues on DPDK port %d", numOfThreads, dpdkPortId);
+
+	HttpWorkers workers(numOfThreads, topK);
+	std::vector<DpdkWorkerThread*> workerThreads;
+	for (int i = 0; i < numOfThreads; i++)
+		workerThreads.push_back(new HttpDpdkWorkerThread(dev, (uint16_t)i, workers.getWorker(i)));
+
+	if (!DpdkDeviceList::getInstance().startDpdkWorkerThreadsOnDeviceSocket(dev, workerThreads))
+		EXIT_WITH_ERROR("Couldn't start the DPDK worker threads");
+
+	reportRatesUntilInterrupted(workers, printRatesPeriodicaly, printRatePeriod);
+
+	DpdkDeviceList::getInstance().stopDpdkWorkerThreads();
+	dev->close();
+
+	for (size_t i = 0; i < workerThreads.size(); i++)
+		delete workerThreads[i];
+
+	printWorkersStatsSummary(workers, topK, true);
+}
+#endif
+
 /**
  * main method of this utility
  */
@@ -505,14 +964,22 @@ int main(int argc, char* argv[])
 	bool printRatesPeriodicaly = true;
 	int printRatePeriod = DEFAULT_CALC_RATES_PERIOD_SEC;
 	std::string savePacketsToFileName = "";
+	size_t topK = 0;
+	int numOfThreads = 1;
+	std::string pfRingInterfaceName = "";
+	int dpdkPortId = -1;
 
 	std::string readPacketsFromPcapFileName = "";
 
+	// the benchmark options are removed from the command line before it's parsed
+	BenchmarkConfiguration benchmarkConfig;
+	if (!BenchmarkHarness::extractOptions(argc, argv, benchmarkConfig))
+		EXIT_WITH_ERROR("Invalid benchmark option");
 
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long (argc, argv, "i:f:o:r:hvld", HttpAnalyzerOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "i:f:o:r:k:t:p:P:hvld", HttpAnalyzerOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -533,6 +1000,30 @@ int main(int argc, char* argv[])
 			case 'd':
 				printRatesPeriodicaly = false;
 				break;
+			case 'k':
+				if (atoi(optarg) <= 0)
+					EXIT_WITH_ERROR("top_k must be a positive number");
+				topK = (size_t)atoi(optarg);
+				break;
+			case 't':
+				numOfThreads = atoi(optarg);
+				if (numOfThreads <= 0 || numOfThreads > PCPP_LIVE_DEVICE_MAX_CAPTURE_THREADS)
+					EXIT_WITH_ERROR("Number of threads must be between 1 and %d", PCPP_LIVE_DEVICE_MAX_CAPTURE_THREADS);
+				break;
+			case 'p':
+#ifdef USE_PF_RING
+				pfRingInterfaceName = optarg;
+				break;
+#else
+				EXIT_WITH_ERROR("PcapPlusPlus wasn't built with PF_RING");
+#endif
+			case 'P':
+#ifdef USE_DPDK
+				dpdkPortId = atoi(optarg);
+				break;
+#else
+				EXIT_WITH_ERROR("PcapPlusPlus wasn't built with DPDK");
+#endif
 			case 'h':
 				printUsage();
 				break;
@@ -549,14 +1040,37 @@ int main(int argc, char* argv[])
 	}
 
 	// if no interface nor input pcap file were provided - exit with error
-	if (readPacketsFromPcapFileName == "" && interfaceNameOrIP == "")
+	if (readPacketsFromPcapFileName == "" && interfaceNameOrIP == "" && pfRingInterfaceName == "" && dpdkPortId < 0)
 		EXIT_WITH_ERROR("Neither interface nor input pcap file were provided");
 
+	// the captured packets can be saved only by the single capture thread of libpcap
+	if (savePacketsToFileName != "" && (numOfThreads > 1 || pfRingInterfaceName != "" || dpdkPortId >= 0))
+		EXIT_WITH_ERROR("Saving the captured packets to a file isn't supported with more than one thread, PF_RING or DPDK");
+
+	if (benchmarkConfig.enabled && readPacketsFromPcapFileName == "")
+		EXIT_WITH_ERROR("Benchmark mode requires an input pcap file");
+
 	// analyze in pcap file mode
-	if (readPacketsFromPcapFileName != "")
+	if (benchmarkConfig.enabled)
+	{
+		benchmarkHttpFromPcapFile(readPacketsFromPcapFileName, benchmarkConfig, topK);
+	}
+	else if (readPacketsFromPcapFileName != "")
+	{
+		analyzeHttpFromPcapFile(readPacketsFromPcapFileName, numOfThreads, topK);
+	}
+#ifdef USE_PF_RING
+	else if (pfRingInterfaceName != "")
+	{
+		analyzeHttpFromPfRing(pfRingInterfaceName, numOfThreads, printRatesPeriodicaly, printRatePeriod, topK);
+	}
+#endif
+#ifdef USE_DPDK
+	else if (dpdkPortId >= 0)
 	{
-		analyzeHttpFromPcapFile(readPacketsFromPcapFileName);
+		analyzeHttpFromDpdk(dpdkPortId, numOfThreads, printRatesPeriodicaly, printRatePeriod, topK);
 	}
+#endif
 	else // analyze in live traffic mode
 	{
 		// extract pcap live device by interface name or IP address
@@ -576,6 +1090,9 @@ int main(int argc, char* argv[])
 		}
 
 		// start capturing and analyzing traffic
-		analyzeHttpFromLiveTraffic(dev, printRatesPeriodicaly, printRatePeriod, savePacketsToFileName);
+		if (numOfThreads > 1)
+			analyzeHttpFromLiveTrafficMultiThread(dev, numOfThreads, printRatesPeriodicaly, printRatePeriod, topK);
+		else
+			analyzeHttpFromLiveTraffic(dev, printRatesPeriodicaly, printRatePeriod, savePacketsToFileName, topK);
 	}
 }
@@ -3,6 +3,8 @@
 #include <sstream>
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
+#include <pthread.h>
 #if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV)  //for using ntohl, ntohs, etc.
 #include <in.h>
 #endif
@@ -10,7 +12,11 @@
 #include "IPv4Layer.h"
 #include "IPv6Layer.h"
 #include "IPReassembly.h"
+#include "ShardedIPReassembly.h"
+#include "RawPacketPool.h"
 #include "PcapFileDevice.h"
+#include "PrefetchingFileReader.h"
+#include "BenchmarkHarness.h"
 #include "SystemUtils.h"
 #include "getopt.h"
 
@@ -28,6 +34,8 @@ static struct option DefragUtilOptions[] =
 	{"filter-by-ipid", required_argument, 0, 'd'},
 	{"bpf-filter", required_argument, 0, 'f'},
 	{"copy-all-packets", no_argument, 0, 'a'},
+	{"threads", required_argument, 0, 't'},
+	{"timeout", required_argument, 0, 'T'},
 	{"help", no_argument, 0, 'h'},
 	{"version", no_argument, 0, 'v'},
     {0, 0, 0, 0}
@@ -48,6 +56,7 @@ struct DefragStats
 	int ipv6FragmentsMatched;
 	int ipv4PacketsDefragmented;
 	int ipv6PacketsDefragmented;
+	int incompletePacketsDropped;
 	int totalPacketsWritten;
 
 	void clear() { memset(this, 0, sizeof(DefragStats)); }
@@ -62,7 +71,8 @@ void printUsage()
 {
 	printf("\nUsage:\n"
 			"-------\n"
-			"%s input_file -o output_file [-d frag_ids] [-f bpf_filter] [-a] [-h] [-v]\n"
+			"%s input_file -o output_file [-d frag_ids] [-f bpf_filter] [-a] [-t num_threads] [-T timeout] [-h] [-v]\n"
+			"%s input_file --benchmark[=ITERATIONS] [-f bpf_filter]\n"
 			"\nOptions:\n\n"
 			"    input_file      : Input pcap/pcapng file\n"
 			"    -o output_file  : Output file. Output file type (pcap/pcapng) will match the input file type\n"
@@ -71,8 +81,15 @@ void printUsage()
 			"    -f bpf_filter   : De-fragment only fragments that match bpf_filter. Filter should be provided in Berkeley Packet Filter (BPF)\n"
 			"                      syntax (http://biot.com/capstats/bpf.html) i.e: 'ip net 1.1.1.1'\n"
 			"    -a              : Copy all packets (those who were de-fragmented and those who weren't) to output file\n"
+			"    -t num_threads  : De-fragment on this number of worker threads. Packets are written in the order they're\n"
+			"                      reassembled, which may differ from the input file order. The default is 1\n"
+			"    -T timeout      : Drop incomplete packets whose fragments are spread over more than this number of seconds\n"
+			"                      (by packet timestamps). The default is 0 (incomplete packets are never dropped)\n"
 			"    -v              : Displays the current version and exits\n"
-			"    -h              : Displays this help message and exits\n", AppName::get().c_str());
+			"    -h              : Displays this help message and exits\n"
+			"%s"
+			"\nIn benchmark mode all fragments matching bpf_filter are de-fragmented and no output file is written\n",
+			AppName::get().c_str(), AppName::get().c_str(), BenchmarkHarness::getUsage());
 	exit(0);
 }
 
@@ -89,26 +106,123 @@ void printAppVersion()
 }
 
 
+/**
+ * The output file. When de-fragmenting with several threads it's written both by the main thread and by the shards of ShardedIPReassembly,
+ * so writing is serialized
+ */
+struct DefragOutput
+{
+	IFileWriterDevice* writer;
+	pthread_mutex_t mutex;
+	int packetsWritten;
+
+	DefragOutput(IFileWriterDevice* writer) : writer(writer), packetsWritten(0) { pthread_mutex_init(&mutex, NULL); }
+	~DefragOutput() { pthread_mutex_destroy(&mutex); }
+
+	void writePacket(RawPacket const& packet)
+	{
+		pthread_mutex_lock(&mutex);
+		writer->writePacket(packet);
+		packetsWritten++;
+		pthread_mutex_unlock(&mutex);
+	}
+};
+
+
+/**
+ * The state of a ShardedIPReassembly shard, passed as the shard cookie. Each shard counts the packets it reassembled on its own so the
+ * counters aren't shared between threads
+ */
+struct DefragShard
+{
+	DefragOutput* output;
+	int ipv4PacketsDefragmented;
+	int ipv6PacketsDefragmented;
+
+	DefragShard() : output(NULL), ipv4PacketsDefragmented(0), ipv6PacketsDefragmented(0) {}
+};
+
+
+/**
+ * The callback invoked by IPReassembly when an incomplete packet is dropped because of the capacity limit or the reassembly timeout
+ */
+void onFragmentsClean(const IPReassembly::PacketKey* key, void* userCookie)
+{
+	((DefragStats*)userCookie)->incompletePacketsDropped++;
+}
+
+
+/**
+ * The callback invoked on the worker thread of a ShardedIPReassembly shard when it completes a packet
+ */
+void onPacketReassembled(Packet* reassembledPacket, int shardIndex, void* userCookie)
+{
+	DefragShard* shard = (DefragShard*)userCookie;
+
+	if (reassembledPacket->isPacketOfType(IPv4))
+		shard->ipv4PacketsDefragmented++;
+	else
+		shard->ipv6PacketsDefragmented++;
+
+	shard->output->writePacket(*reassembledPacket->getRawPacket());
+
+	delete reassembledPacket;
+}
+
+
 /**
  * This method reads packets from the input file, decided which fragments pass the filters set by the user, de-fragment the fragments
- * who pass them, and writes the result packets to the output file
+ * who pass them, and writes the result packets to the output file.
+ * The input file is read ahead by a background thread (PrefetchingFileReader) and packets are parsed only up to the IP layer, which is all
+ * the filters and the reassembly need. If numOfThreads is 1 the fragments are de-fragmented on the calling thread, and the buffers of
+ * reassembled packets are taken from a pool. Otherwise they're queued to ShardedIPReassembly, which de-fragments them on numOfThreads worker
+ * threads that write the reassembled packets themselves, so the order of the packets in the output file may differ from the input file.
+ * If fragmentTimeout isn't 0 incomplete packets are dropped when their fragments are spread over more than fragmentTimeout seconds (by the
+ * packet timestamps), which bounds the memory taken by fragments that never complete a packet
  */
 void processPackets(IFileReaderDevice* reader, IFileWriterDevice* writer,
 		bool filterByBpf, std::string bpfFilter,
 		bool filterByIpID, std::map<uint32_t, bool> fragIDs,
 		bool copyAllPacketsToOutputFile,
+		int numOfThreads, uint32_t fragmentTimeout,
 		DefragStats& stats)
 {
-	RawPacket rawPacket;
 	BPFStringFilter filter(bpfFilter);
 
-	// create an instance of IPReassembly
-	IPReassembly ipReassembly;
+	DefragOutput output(writer);
+
+	// create an instance of IPReassembly, which takes the buffers of reassembled packets from the pool
+	RawPacketPool rawPacketPool;
+	IPReassembly ipReassembly(onFragmentsClean, &stats, PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE, 0, EvictLeastRecentlyUsed, fragmentTimeout);
+	ipReassembly.setRawPacketPool(&rawPacketPool);
+
+	// when de-fragmenting with several threads create the shards instead. Reassembled packets are parsed only up to the IP layer
+	ShardedIPReassembly* shardedReassembly = NULL;
+	std::vector<DefragShard> shards(numOfThreads);
+	if (numOfThreads > 1)
+	{
+		ShardedIPReassemblyConfiguration config(numOfThreads, 1, 1024, false, PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE, 0, EvictLeastRecentlyUsed, fragmentTimeout);
+		config.parseUntilLayer = OsiModelNetworkLayer;
+		shardedReassembly = new ShardedIPReassembly(onPacketReassembled, NULL, NULL, config);
+		for (int i = 0; i < numOfThreads; i++)
+		{
+			shards[i].output = &output;
+			shardedReassembly->setShardUserCookie(i, &shards[i]);
+		}
+
+		if (!shardedReassembly->start())
+			EXIT_WITH_ERROR("Couldn't start the de-fragmentation threads");
+	}
 
 	IPReassembly::ReassemblyStatus status;
 
+	PrefetchingFileReader prefetchingReader(*reader);
+	if (!prefetchingReader.start())
+		EXIT_WITH_ERROR("Couldn't start reading the input file");
+
 	// read all packet from input file
-	while (reader->getNextPacket(rawPacket))
+	RawPacket* rawPacket;
+	while ((rawPacket = prefetchingReader.getNextPacket()) != NULL)
 	{
 		bool defragPacket = true;
 
@@ -118,7 +232,7 @@ void processPackets(IFileReaderDevice* reader, IFileWriterDevice* writer,
 		if (filterByBpf)
 		{
 			// check if packet matches the BPF filter supplied by the user
-			if (IPcapDevice::matchPacketWithFilter(filter, &rawPacket))
+			if (IPcapDevice::matchPacketWithFilter(filter, rawPacket))
 			{
 				stats.ipPacketsMatchBpfFilter++;
 			}
@@ -131,8 +245,8 @@ void processPackets(IFileReaderDevice* reader, IFileWriterDevice* writer,
 		bool isIPv4Packet = false;
 		bool isIPv6Packet = false;
 
-		// check if packet is of type IPv4 or IPv6
-		Packet parsedPacket(&rawPacket);
+		// check if packet is of type IPv4 or IPv6. Layers above IP aren't needed so they aren't parsed
+		Packet parsedPacket(rawPacket, false, UnknownProtocol, OsiModelNetworkLayer);
 		if (parsedPacket.isPacketOfType(IPv4))
 		{
 			stats.ipv4Packets++;
@@ -186,10 +300,26 @@ void processPackets(IFileReaderDevice* reader, IFileWriterDevice* writer,
 		}
 
 		// if fragment is marked for de-fragmentation
-		if (defragPacket)
+		if (defragPacket && shardedReassembly != NULL)
+		{
+			// queue the fragment to the shard of its packet, which writes the packet once it's reassembled
+			if (shardedReassembly->reassemblePacket(rawPacket))
+			{
+				if (isIPv4Packet)
+					stats.ipv4FragmentsMatched++;
+				else
+					stats.ipv6FragmentsMatched++;
+			}
+			// packets which aren't fragments aren't queued
+			else if (copyAllPacketsToOutputFile)
+			{
+				output.writePacket(*rawPacket);
+			}
+		}
+		else if (defragPacket)
 		{
 			// process the packet in the IP reassembly mechanism
-			Packet* result = ipReassembly.processPacket(&parsedPacket, status);
+			Packet* result = ipReassembly.processPacket(&parsedPacket, status, UnknownProtocol, OsiModelNetworkLayer);
 
 			// write fragment/packet to file if:
 			// - packet is fully reassembled (status of REASSEMBLED)
@@ -197,8 +327,7 @@ void processPackets(IFileReaderDevice* reader, IFileWriterDevice* writer,
 			if (status == IPReassembly::REASSEMBLED ||
 					((status == IPReassembly::NON_IP_PACKET || status == IPReassembly::NON_FRAGMENT) && copyAllPacketsToOutputFile))
 			{
-				writer->writePacket(*result->getRawPacket());
-				stats.totalPacketsWritten++;
+				output.writePacket(*result->getRawPacket());
 			}
 
 			// update statistics if packet is fully reassembled (status of REASSEMBLED) and
@@ -229,11 +358,71 @@ void processPackets(IFileReaderDevice* reader, IFileWriterDevice* writer,
 		// if packet isn't marked for de-fragmentation but the user asked to write all packets to output file
 		else if (copyAllPacketsToOutputFile)
 		{
-			writer->writePacket(rawPacket);
-			stats.totalPacketsWritten++;
+			output.writePacket(*rawPacket);
 		}
 
 	}
+
+	prefetchingReader.stop();
+
+	// wait for the shards to write the packets completed by the last fragments, and collect their stats
+	if (shardedReassembly != NULL)
+	{
+		shardedReassembly->flush();
+		shardedReassembly->stop();
+
+		for (int i = 0; i < numOfThreads; i++)
+		{
+			stats.ipv4PacketsDefragmented += shards[i].ipv4PacketsDefragmented;
+			stats.ipv6PacketsDefragmented += shards[i].ipv6PacketsDefragmented;
+		}
+
+		uint64_t totals[ShardedIPReassembly::NumOfStatsCounters];
+		shardedReassembly->getStatsCounters().aggregate(totals);
+		stats.incompletePacketsDropped += (int)totals[ShardedIPReassembly::IncompletePacketsDropped];
+
+		delete shardedReassembly;
+	}
+
+	stats.totalPacketsWritten = output.packetsWritten;
+}
+
+
+/**
+ * Benchmark mode: read the packets of the input file into memory and de-fragment them several times, without writing an output file
+ */
+void benchmarkPackets(std::string inputFile, bool filterByBpf, std::string bpfFilter, const BenchmarkConfiguration& benchmarkConfig)
+{
+	BenchmarkHarness harness(AppName::get(), benchmarkConfig);
+
+	BPFStringFilter filter(bpfFilter);
+	if (!harness.loadFile(inputFile, (filterByBpf ? &filter : NULL)))
+		EXIT_WITH_ERROR("Error reading input file");
+
+	int parseStage = harness.addStage("parse");
+	int defragStage = harness.addStage("de-fragment");
+
+	IPReassembly::ReassemblyStatus status;
+
+	while (harness.startIteration())
+	{
+		IPReassembly ipReassembly;
+		for (size_t i = 0; i < harness.getNumOfPackets(); i++)
+		{
+			harness.beginStage(parseStage);
+			Packet parsedPacket(harness.getPacket(i));
+			harness.endStage(parseStage);
+
+			harness.beginStage(defragStage);
+			Packet* result = ipReassembly.processPacket(&parsedPacket, status);
+			if (status == IPReassembly::REASSEMBLED)
+				delete result;
+			harness.endStage(defragStage);
+		}
+		harness.endIteration();
+	}
+
+	harness.printReport();
 }
 
 
@@ -261,6 +450,7 @@ void printStats(const DefragStats& stats, bool filterByIpID, bool filterByBpf)
 	stream << "Total packets reassembled:               " << (stats.ipv4PacketsDefragmented + stats.ipv6PacketsDefragmented) << std::endl;
 	stream << "IPv4 packets reassembled:                " << stats.ipv4PacketsDefragmented << std::endl;
 	stream << "IPv6 packets reassembled:                " << stats.ipv6PacketsDefragmented << std::endl;
+	stream << "Incomplete packets dropped:              " << stats.incompletePacketsDropped << std::endl;
 	stream << "Total packets written to output file:    " << stats.totalPacketsWritten << std::endl;
 
 	std::cout << stream.str();
@@ -283,9 +473,15 @@ int main(int argc, char* argv[])
 	bool filterByFragID = false;
 	std::map<uint32_t, bool> fragIDMap;
 	bool copyAllPacketsToOutputFile = false;
+	int numOfThreads = 1;
+	uint32_t fragmentTimeout = 0;
 
+	// the benchmark options are removed from the command line before it's parsed
+	BenchmarkConfiguration benchmarkConfig;
+	if (!BenchmarkHarness::extractOptions(argc, argv, benchmarkConfig))
+		EXIT_WITH_ERROR("Invalid benchmark option");
 
-	while((opt = getopt_long (argc, argv, "o:d:f:ahv", DefragUtilOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "o:d:f:at:T:hv", DefragUtilOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -337,6 +533,21 @@ int main(int argc, char* argv[])
 				copyAllPacketsToOutputFile = true;
 				break;
 			}
+			case 't':
+			{
+				numOfThreads = atoi(optarg);
+				if (numOfThreads < 1)
+					EXIT_WITH_ERROR("Number of threads must be a positive integer");
+				break;
+			}
+			case 'T':
+			{
+				int timeout = atoi(optarg);
+				if (timeout < 0)
+					EXIT_WITH_ERROR("Timeout must be a non-negative integer");
+				fragmentTimeout = (uint32_t)timeout;
+				break;
+			}
 			case 'h':
 			{
 				printUsage();
@@ -379,6 +590,12 @@ int main(int argc, char* argv[])
     	EXIT_WITH_ERROR("Input file name was not given");
     }
 
+    if (benchmarkConfig.enabled)
+    {
+    	benchmarkPackets(inputFile, filterByBpfFilter, bpfFilter, benchmarkConfig);
+    	return 0;
+    }
+
     if (outputFile == "")
     {
     	EXIT_WITH_ERROR("Output file name was not given");
@@ -398,7 +615,10 @@ int main(int argc, char* argv[])
 
 	if (dynamic_cast<PcapFileReaderDevice*>(reader) != NULL)
 	{
-		writer = new PcapFileWriterDevice(outputFile.c_str(), ((PcapFileReaderDevice*)reader)->getLinkLayerType());
+		// packets are copied to large buffers which are written by a background thread. Writing waits when the buffers are full, so no
+		// packet is dropped
+		writer = new BufferedPcapFileWriterDevice(outputFile.c_str(), ((PcapFileReaderDevice*)reader)->getLinkLayerType(), false,
+				BufferedPcapFileWriterConfiguration(PCPP_BUFFERED_WRITER_DEFAULT_BUFFER_SIZE, true));
 	}
 	else if (dynamic_cast<PcapNgFileReaderDevice*>(reader) != NULL)
 	{
@@ -416,7 +636,7 @@ int main(int argc, char* argv[])
 
 	// run the de-fragmentation process
 	DefragStats stats;
-	processPackets(reader, writer, filterByBpfFilter, bpfFilter, filterByFragID, fragIDMap, copyAllPacketsToOutputFile, stats);
+	processPackets(reader, writer, filterByBpfFilter, bpfFilter, filterByFragID, fragIDMap, copyAllPacketsToOutputFile, numOfThreads, fragmentTimeout, stats);
 
 	// close files
 	reader->close();
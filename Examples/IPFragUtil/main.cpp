@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <vector>
 #if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV) //for using ntohl, ntohs, etc.
 #include <in.h>
 #endif
@@ -13,6 +14,8 @@
 #include "IPv6Layer.h"
 #include "PayloadLayer.h"
 #include "PcapFileDevice.h"
+#include "PrefetchingFileReader.h"
+#include "IpUtils.h"
 #include "SystemUtils.h"
 #include "getopt.h"
 
@@ -91,9 +94,9 @@ void printAppVersion()
 
 
 /**
- * Set fragment parameters in an IPv4 fragment packet
+ * Set fragment parameters in the IPv4 header of a fragment packet
  */
-void setIPv4FragmentParams(IPv4Layer* fragIpLayer, size_t fragOffset, bool lastFrag)
+void setIPv4FragmentParams(iphdr* fragIpHeader, size_t fragOffset, bool lastFrag)
 {
 	// calculate the fragment offset field
 	uint16_t fragOffsetValue = htons((uint16_t)(fragOffset/8));
@@ -106,7 +109,7 @@ void setIPv4FragmentParams(IPv4Layer* fragIpLayer, size_t fragOffset, bool lastF
 		fragOffsetValue |= (uint16_t)0x20;
 
 	// write fragment flags + fragment offset to packet
-	fragIpLayer->getIPv4Header()->fragmentOffset = fragOffsetValue;
+	fragIpHeader->fragmentOffset = fragOffsetValue;
 }
 
 
@@ -120,6 +123,20 @@ void setIPv6FragmentParams(IPv6Layer* fragIpLayer, size_t fragOffset, bool lastF
 }
 
 
+/**
+ * Set the fragment offset and the "more fragments" flag in the IPv6 fragmentation extension of a fragment packet, encoded as
+ * IPv6FragmentationHeader does
+ */
+void setIPv6FragmentOffset(IPv6FragmentationHeader::ipv6_frag_header* fragHeader, size_t fragOffset, bool lastFrag)
+{
+	uint16_t fragOffsetValue = htons((uint16_t)((fragOffset/8) << 3)) & (uint16_t)0xf8ff;
+	if (!lastFrag)
+		fragOffsetValue |= (uint16_t)0x0100;
+
+	fragHeader->fragOffsetAndFlags = fragOffsetValue;
+}
+
+
 /**
  * Generate a 4-byte positive random number. Used for generating IPv6 fragment ID
  */
@@ -135,100 +152,131 @@ uint32_t generateRandomNumber()
 	return result;
 }
 
+
 /**
- * A method that takes a raw packet and a requested fragment size and splits the packet into fragments.
- * Fragments are written to a  RawPacketVector instance supplied by the user.
- * The input packet isn't modified in any way.
- * If the packet isn't of type IPv4 or IPv6, nothing happens and the result vector remains empty.
- * If the packet payload size is smaller or equal than the request fragment size the packet isn't fragmented, but the packet is copied
- * and pushed into the result vector
+ * Create a fragment packet: duplicate the input packet, replace all layers above the IP layer with a slice of the IP payload, set the
+ * fragment parameters and compute the calculated fields of all layers. The input packet isn't modified in any way. The user is responsible
+ * for freeing the returned raw packet
  */
-void splitIPPacketToFragmentsBySize(RawPacket* rawPacket, size_t fragmentSize, RawPacketVector& resultFragments)
+RawPacket* createFragment(Packet& packet, Layer* ipLayer, size_t fragOffset, size_t fragSize, bool lastFrag, uint32_t fragId)
 {
-	// parse raw packet
-	Packet packet(rawPacket);
-
-	// check if IPv4/6
-	ProtocolType ipProto = UnknownProtocol;
-	if (packet.isPacketOfType(IPv4))
-		ipProto = IPv4;
-	else if (packet.isPacketOfType(IPv6))
-		ipProto = IPv6;
-	else
-		return;
+	// first, duplicate the input packet and create a new parsed packet out of it
+	RawPacket* newFragRawPacket = new RawPacket(*packet.getRawPacket());
+	Packet newFrag(newFragRawPacket);
+
+	// find the IPv4/6 layer of the new fragment
+	Layer* fragIpLayer = NULL;
+	if (ipLayer->getProtocol() == IPv4)
+		fragIpLayer = newFrag.getLayerOfType<IPv4Layer>();
+	else // IPv6
+		fragIpLayer = newFrag.getLayerOfType<IPv6Layer>();
+
+	// delete all layers above IP layer
+	newFrag.removeAllLayersAfter(fragIpLayer);
+
+	// create a new PayloadLayer with the fragmented data and add it to the new fragment packet
+	PayloadLayer newPayload(ipLayer->getLayerPayload() + fragOffset, fragSize, false);
+	newFrag.addLayer(&newPayload);
+
+	// set fragment parameters in IPv4/6 layer
+	if (ipLayer->getProtocol() == IPv4)
+		setIPv4FragmentParams(((IPv4Layer*)fragIpLayer)->getIPv4Header(), fragOffset, lastFrag);
+	else // IPv6
+		setIPv6FragmentParams((IPv6Layer*)fragIpLayer, fragOffset, lastFrag, fragId);
+
+	// compute all calculated fields of the new fragment
+	newFrag.computeCalculateFields();
+
+	return newFrag.getRawPacket();
+}
+
 
-	Layer* ipLayer = NULL;
-	if (ipProto == IPv4)
-		ipLayer = packet.getLayerOfType<IPv4Layer>();
-	else // ipProto == IPv6
+/**
+ * A method that takes a parsed IPv4/IPv6 packet and a requested fragment size, splits the packet into fragments and writes them to the
+ * output file. The input packet isn't modified in any way.
+ * Only the first and the last fragments are created by duplicating and parsing the packet (see createFragment()). All fragments between
+ * them have the requested size, so their headers are identical to the headers of the first fragment except for the fragment offset and
+ * flags (and the IPv4 header checksum). They're built in place in a single buffer which is reused for all of them: the payload slice is
+ * copied after the headers of the first fragment and only the changed fields are updated, with no parsing or allocation per fragment.
+ * fragmentBuffer is the reused buffer, which may be shared between calls.
+ * If the packet payload size is smaller or equal than the request fragment size the packet isn't fragmented and nothing is written
+ * @return The number of fragments written, or 0 if the packet wasn't fragmented
+ */
+int writeIPPacketFragments(Packet& packet, size_t fragmentSize, IFileWriterDevice* writer, std::vector<uint8_t>& fragmentBuffer)
+{
+	Layer* ipLayer = packet.getLayerOfType<IPv4Layer>();
+	if (ipLayer == NULL)
 		ipLayer = packet.getLayerOfType<IPv6Layer>();
 
+	if (ipLayer == NULL)
+		return 0;
+
 	// if packet payload size is less than the requested fragment size, don't fragment and return
-	if (ipLayer->getLayerPayloadSize() <= fragmentSize)
-	{
-		RawPacket* copyOfRawPacket = new RawPacket(*rawPacket);
-		resultFragments.pushBack(copyOfRawPacket);
-		return;
-	}
+	size_t payloadSize = ipLayer->getLayerPayloadSize();
+	if (payloadSize <= fragmentSize)
+		return 0;
 
 	// generate a random number for IPv6 fragment ID (not used in IPv4 packets)
 	uint32_t randomNum = generateRandomNumber();
 
-	// go over the payload and create fragments until reaching the end of the payload
-	size_t curOffset = 0;
-	while (curOffset < ipLayer->getLayerPayloadSize())
-	{
-		bool lastFrag = false;
-		size_t curFragSize = fragmentSize;
-
-		// check if this is the last fragment by comparing the size of the rest of the payload to the requested fragment size
-		if (ipLayer->getLayerPayloadSize() - curOffset <= fragmentSize)
-		{
-			curFragSize = ipLayer->getLayerPayloadSize() - curOffset;
-			lastFrag = true;
-		}
+	// create the first fragment, whose headers are used for all fragments except the last one
+	RawPacket* firstFrag = createFragment(packet, ipLayer, 0, fragmentSize, false, randomNum);
+	writer->writePacket(*firstFrag);
+	int numOfFragments = 1;
 
-		// create the fragment packet
-		// first, duplicate the input packet and create a new parsed packet out of it
-		RawPacket* newFragRawPacket = new RawPacket(*packet.getRawPacket());
-		Packet newFrag(newFragRawPacket);
+	size_t curOffset = fragmentSize;
+	if (payloadSize - curOffset > fragmentSize)
+	{
+		fragmentBuffer.assign(firstFrag->getRawData(), firstFrag->getRawData() + firstFrag->getRawDataLen());
 
-		// find the IPv4/6 layer of the new fragment
-		Layer* fragIpLayer = NULL;
-		if (ipProto == IPv4)
-			fragIpLayer = newFrag.getLayerOfType<IPv4Layer>();
-		else // ipProto == IPv6
-			fragIpLayer = newFrag.getLayerOfType<IPv6Layer>();
+		// the layers below the IP layer have the same size in the fragments, and the fragment payload comes right after the headers
+		size_t ipHeaderOffset = ipLayer->getData() - packet.getRawPacket()->getRawData();
+		size_t headersLen = fragmentBuffer.size() - fragmentSize;
+		iphdr* ipv4Header = (iphdr*)&fragmentBuffer[ipHeaderOffset];
+		// the fragmentation extension is added after all other extensions, right before the payload
+		IPv6FragmentationHeader::ipv6_frag_header* ipv6FragHeader =
+				(IPv6FragmentationHeader::ipv6_frag_header*)&fragmentBuffer[headersLen - sizeof(IPv6FragmentationHeader::ipv6_frag_header)];
 
-		// delete all layers above IP layer
-		newFrag.removeAllLayersAfter(fragIpLayer);
+		while (payloadSize - curOffset > fragmentSize)
+		{
+			memcpy(&fragmentBuffer[headersLen], ipLayer->getLayerPayload() + curOffset, fragmentSize);
 
-		// create a new PayloadLayer with the fragmented data and add it to the new fragment packet
-		PayloadLayer newPayload(ipLayer->getLayerPayload() + curOffset, curFragSize, false);
-		newFrag.addLayer(&newPayload);
+			if (ipLayer->getProtocol() == IPv4)
+			{
+				setIPv4FragmentParams(ipv4Header, curOffset, false);
+				ipv4Header->headerChecksum = 0;
+				ScalarBuffer<uint16_t> scalar = { (uint16_t*)ipv4Header, (size_t)(ipv4Header->internetHeaderLength*4) };
+				ipv4Header->headerChecksum = htons(compute_checksum(&scalar, 1));
+			}
+			else // IPv6
+			{
+				setIPv6FragmentOffset(ipv6FragHeader, curOffset, false);
+			}
 
-		// set fragment parameters in IPv4/6 layer
-		if (ipProto == IPv4)
-			setIPv4FragmentParams((IPv4Layer*)fragIpLayer, curOffset, lastFrag);
-		else // ipProto == IPv6
-			setIPv6FragmentParams((IPv6Layer*)fragIpLayer, curOffset, lastFrag, randomNum);
+			RawPacket fragment(&fragmentBuffer[0], (int)fragmentBuffer.size(), firstFrag->getPacketTimeStampNs(), false, firstFrag->getLinkLayerType());
+			writer->writePacket(fragment);
+			numOfFragments++;
 
-		// compute all calculated fields of the new fragment
-		newFrag.computeCalculateFields();
+			curOffset += fragmentSize;
+		}
+	}
 
-		// add fragment to result list
-		resultFragments.pushBack(newFrag.getRawPacket());
+	delete firstFrag;
 
-		// increment offset pointer
-		curOffset += curFragSize;
-	}
+	// create the last fragment, which is smaller than the others if the payload size doesn't divide by the fragment size
+	RawPacket* lastFrag = createFragment(packet, ipLayer, curOffset, payloadSize - curOffset, true, randomNum);
+	writer->writePacket(*lastFrag);
+	numOfFragments++;
+	delete lastFrag;
 
+	return numOfFragments;
 }
 
 
 /**
  * This method reads packets from the input file, decided which packets pass the filters set by the user, fragment packets who pass them,
- * and write the result packets to the output file
+ * and write the result packets to the output file. The input file is read ahead by a background thread (PrefetchingFileReader), and
+ * packets are parsed only up to the IP layer, which is all the filters and the fragmentation need
  */
 void processPackets(IFileReaderDevice* reader, IFileWriterDevice* writer,
 		int fragSize,
@@ -239,11 +287,18 @@ void processPackets(IFileReaderDevice* reader, IFileWriterDevice* writer,
 {
 	stats.clear();
 
-	RawPacket rawPacket;
 	BPFStringFilter filter(bpfFilter);
 
+	// the buffer fragments are built in, reused for all packets
+	std::vector<uint8_t> fragmentBuffer;
+
+	PrefetchingFileReader prefetchingReader(*reader);
+	if (!prefetchingReader.start())
+		EXIT_WITH_ERROR("Couldn't start reading the input file");
+
 	// read all packet from input file
-	while (reader->getNextPacket(rawPacket))
+	RawPacket* rawPacket;
+	while ((rawPacket = prefetchingReader.getNextPacket()) != NULL)
 	{
 		stats.totalPacketsRead++;
 
@@ -254,7 +309,7 @@ void processPackets(IFileReaderDevice* reader, IFileWriterDevice* writer,
 		if (filterByBpf)
 		{
 			// check if packet matches the BPF filter supplied by the user
-			if (IPcapDevice::matchPacketWithFilter(filter, &rawPacket))
+			if (IPcapDevice::matchPacketWithFilter(filter, rawPacket))
 			{
 				stats.ipPacketsMatchBpfFilter++;
 			}
@@ -266,8 +321,8 @@ void processPackets(IFileReaderDevice* reader, IFileWriterDevice* writer,
 
 		ProtocolType ipProto = UnknownProtocol;
 
-		// check if packet is of type IPv4
-		Packet parsedPacket(&rawPacket);
+		// check if packet is of type IPv4. Layers above IP aren't needed so they aren't parsed
+		Packet parsedPacket(rawPacket, false, UnknownProtocol, OsiModelNetworkLayer);
 		if (parsedPacket.isPacketOfType(IPv4))
 		{
 			ipProto = IPv4;
@@ -305,38 +360,39 @@ void processPackets(IFileReaderDevice* reader, IFileWriterDevice* writer,
 		// if packet passed all filters and marked for fragmentation
 		if (fragPacket)
 		{
-			// call the method who splits the packet into fragments
-			RawPacketVector resultFrags;
-			splitIPPacketToFragmentsBySize(&rawPacket, (size_t)fragSize, resultFrags);
+			// call the method who splits the packet into fragments and writes them
+			int numOfFragments = writeIPPacketFragments(parsedPacket, (size_t)fragSize, writer, fragmentBuffer);
 
-			// if result list contains only 1 packet it means packet wasn't fragmented - update stats accordingly
-			if (resultFrags.size() == 1)
+			// if no fragments were written it means packet wasn't fragmented - update stats accordingly, and write the packet
+			// if user requested to write all packet to output file
+			if (numOfFragments == 0)
 			{
 				stats.ipPacketsUnderSize++;
+				if (copyAllPacketsToOutputFile)
+				{
+					writer->writePacket(*rawPacket);
+					stats.totalPacketsWritten++;
+				}
 			}
-			else if (resultFrags.size() > 1) // packet was fragmented
+			else // packet was fragmented
 			{
 				if (ipProto == IPv4)
 					stats.ipv4PacketsFragmented++;
 				else // ipProto == IPv6
 					stats.ipv6PacketsFragmented++;
-			}
 
-			// write the result fragments if either: (1) packet was indeed fragmented,
-			// or (2) user requested to write all packet to output file
-			if (resultFrags.size() > 1 || copyAllPacketsToOutputFile)
-			{
-				writer->writePackets(resultFrags);
-				stats.totalPacketsWritten += resultFrags.size();
+				stats.totalPacketsWritten += numOfFragments;
 			}
 		}
 		// even if packet didn't pass the filters but user requested to write all packet to output file, write it
 		else if (copyAllPacketsToOutputFile)
 		{
-			writer->writePacket(rawPacket);
+			writer->writePacket(*rawPacket);
 			stats.totalPacketsWritten++;
 		}
 	}
+
+	prefetchingReader.stop();
 }
 
 
@@ -511,7 +567,10 @@ int main(int argc, char* argv[])
 
 	if (dynamic_cast<PcapFileReaderDevice*>(reader) != NULL)
 	{
-		writer = new PcapFileWriterDevice(outputFile.c_str(), ((PcapFileReaderDevice*)reader)->getLinkLayerType());
+		// packets are copied to large buffers which are written by a background thread. Writing waits when the buffers are full, so no
+		// packet is dropped
+		writer = new BufferedPcapFileWriterDevice(outputFile.c_str(), ((PcapFileReaderDevice*)reader)->getLinkLayerType(), false,
+				BufferedPcapFileWriterConfiguration(PCPP_BUFFERED_WRITER_DEFAULT_BUFFER_SIZE, true));
 	}
 	else if (dynamic_cast<PcapNgFileReaderDevice*>(reader) != NULL)
 	{
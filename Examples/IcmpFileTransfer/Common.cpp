@@ -31,6 +31,7 @@ static struct option IcmpFTOptions[] =
 	{"receive-file", no_argument, 0, 'r'},
 	{"speed", required_argument, 0, 'p'},
 	{"block-size", required_argument, 0, 'b'},
+	{"window-size", required_argument, 0, 'w'},
 	{"list-interfaces", no_argument, 0, 'l'},
 	{"help", no_argument, 0, 'h'},
 	{"version", no_argument, 0, 'v'},
@@ -49,23 +50,28 @@ void printUsage(std::string thisSide, std::string otherSide)
 {
 	std::string messagesPerSecShort = (thisSide == "pitcher") ? "[-p messages_per_sec] " : "";
 	std::string messagesPerSecLong = (thisSide == "pitcher") ? "    -p messages_per_sec  : Set number of messages to be sent per seconds. Default is max possible speed\n" : "";
+	std::string windowSizeShort = (thisSide == "pitcher") ? "[-w window_size] " : "";
+	std::string windowSizeLong = (thisSide == "pitcher") ? "    -w window_size       : Use the windowed transfer mode with up to window_size chunks in flight, which are retransmitted\n"
+															"                           selectively if they're lost. The catcher detects this mode automatically. Default is the\n"
+															"                           stop-and-wait mode\n" : "";
 
 	printf("\nUsage:\n"
 			"-------\n"
-			"%s [-h] [-v] [-l] -i %s_interface -d %s_ip -s file_path -r %s[-b block_size]\n"
+			"%s [-h] [-v] [-l] -i %s_interface -d %s_ip -s file_path -r %s%s[-b block_size]\n"
 			"\nOptions:\n\n"
 			"    -i %s_interface : Use the specified interface. Can be interface name (e.g eth0) or interface IPv4 address\n"
 			"    -d %s_ip        : %s IPv4 address\n"
 			"    -s file_path         : Send file mode: send file_path to %s\n"
 			"    -r                   : Receive file mode: receive file from %s\n"
 			"%s"
+			"%s"
 			"    -b block_size        : Set the size of data chunk sent in each ICMP message (in bytes). Default is %d bytes. Relevant only\n"
 			"                           in send file mode (when -s is set)\n"
 			"    -l                   : Print the list of interfaces and exit\n"
 			"    -v                   : Displays the current version and exists\n"
 			"    -h                   : Display this help message and exit\n",
-			AppName::get().c_str(), thisSide.c_str(), otherSide.c_str(), messagesPerSecShort.c_str(), thisSide.c_str(), otherSide.c_str(), otherSide.c_str(), otherSide.c_str(), otherSide.c_str(),
-			messagesPerSecLong.c_str(), DEFAULT_BLOCK_SIZE);
+			AppName::get().c_str(), thisSide.c_str(), otherSide.c_str(), messagesPerSecShort.c_str(), windowSizeShort.c_str(), thisSide.c_str(), otherSide.c_str(), otherSide.c_str(), otherSide.c_str(), otherSide.c_str(),
+			messagesPerSecLong.c_str(), windowSizeLong.c_str(), DEFAULT_BLOCK_SIZE);
 	exit(0);
 }
 
@@ -94,7 +100,7 @@ void readCommandLineArguments(int argc, char* argv[],
 		bool& sender, bool& receiver,
 		pcpp::IPv4Address& myIP, pcpp::IPv4Address& otherSideIP,
 		std::string& fileNameToSend,
-		int& packetsPerSec, size_t& blockSize)
+		int& packetsPerSec, size_t& blockSize, int& windowSize)
 {
 	std::string interfaceNameOrIP = "";
 	std::string otherSideIPAsString = "";
@@ -105,11 +111,13 @@ void readCommandLineArguments(int argc, char* argv[],
 	sender = false;
 	blockSize = DEFAULT_BLOCK_SIZE;
 	bool blockSizeSet = false;
+	windowSize = 0;
+	bool windowSizeSet = false;
 
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long(argc, argv, "i:d:s:rp:b:hvl", IcmpFTOptions, &optionIndex)) != -1)
+	while((opt = getopt_long(argc, argv, "i:d:s:rp:b:w:hvl", IcmpFTOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -138,6 +146,12 @@ void readCommandLineArguments(int argc, char* argv[],
 				blockSize = atoi(optarg);
 				blockSizeSet = true;
 				break;
+			case 'w':
+				if (thisSide == "catcher")
+					EXIT_WITH_ERROR_PRINT_USAGE("Unknown option -w");
+				windowSize = atoi(optarg);
+				windowSizeSet = true;
+				break;
 			case 'h':
 				printUsage(thisSide, otherSide);
 				break;
@@ -196,12 +210,18 @@ void readCommandLineArguments(int argc, char* argv[],
 	// validate packets per sec
 	if (packetsPerSecSet && packetsPerSec < 1)
 		EXIT_WITH_ERROR_PRINT_USAGE("message_per_sec must be a positive value greate or equal to 1");
+
+	// validate window size
+	if (windowSizeSet && (windowSize < 1 || windowSize > MAX_WINDOW_SIZE))
+		EXIT_WITH_ERROR_PRINT_USAGE("window_size must be a positive value lower or equal to %d", MAX_WINDOW_SIZE);
 }
 
-bool sendIcmpMessage(PcapLiveDevice* dev,
-		MacAddress srcMacAddr, MacAddress dstMacAddr,
+/**
+ * Build an ICMP request or reply from source to dest and return its raw packet. The caller is responsible for freeing it
+ */
+static RawPacket* createIcmpMessage(MacAddress srcMacAddr, MacAddress dstMacAddr,
 		IPv4Address srcIPAddr, IPv4Address dstIPAddr,
-		size_t icmpMsgId,
+		size_t icmpMsgId, uint16_t icmpMsgSeq,
 		uint64_t msgType,
 		uint8_t* data, size_t dataLen,
 		bool sendRequest)
@@ -226,9 +246,9 @@ bool sendIcmpMessage(PcapLiveDevice* dev,
 
 	// then ICMP
 	IcmpLayer icmpLayer;
-	if (sendRequest && icmpLayer.setEchoRequestData(icmpMsgId, 0, msgType, data, dataLen) == NULL)
+	if (sendRequest && icmpLayer.setEchoRequestData(icmpMsgId, icmpMsgSeq, msgType, data, dataLen) == NULL)
 		EXIT_WITH_ERROR("Cannot set ICMP echo request data");
-	else if (!sendRequest && icmpLayer.setEchoReplyData(icmpMsgId, 0, msgType, data, dataLen) == NULL)
+	else if (!sendRequest && icmpLayer.setEchoReplyData(icmpMsgId, icmpMsgSeq, msgType, data, dataLen) == NULL)
 		EXIT_WITH_ERROR("Cannot set ICMP echo response data");
 
 	// create an new packet and add all layers to it
@@ -238,8 +258,24 @@ bool sendIcmpMessage(PcapLiveDevice* dev,
 	packet.addLayer(&icmpLayer);
 	packet.computeCalculateFields();
 
+	// copy the raw packet out, the packet and its layers are freed when this method returns
+	return new RawPacket(*packet.getRawPacketReadOnly());
+}
+
+bool sendIcmpMessage(PcapLiveDevice* dev,
+		MacAddress srcMacAddr, MacAddress dstMacAddr,
+		IPv4Address srcIPAddr, IPv4Address dstIPAddr,
+		size_t icmpMsgId, uint16_t icmpMsgSeq,
+		uint64_t msgType,
+		uint8_t* data, size_t dataLen,
+		bool sendRequest)
+{
+	RawPacket* rawPacket = createIcmpMessage(srcMacAddr, dstMacAddr, srcIPAddr, dstIPAddr, icmpMsgId, icmpMsgSeq, msgType, data, dataLen, sendRequest);
+
 	// send the packet through the device
-	return dev->sendPacket(&packet);
+	bool result = dev->sendPacket(*rawPacket);
+	delete rawPacket;
+	return result;
 }
 
 bool sendIcmpRequest(PcapLiveDevice* dev,
@@ -247,9 +283,10 @@ bool sendIcmpRequest(PcapLiveDevice* dev,
 		IPv4Address srcIPAddr, const IPv4Address dstIPAddr,
 		size_t icmpMsgId,
 		uint64_t msgType,
-		uint8_t* data, size_t dataLen)
+		uint8_t* data, size_t dataLen,
+		uint16_t icmpMsgSeq)
 {
-	return sendIcmpMessage(dev, srcMacAddr, dstMacAddr, srcIPAddr, dstIPAddr, icmpMsgId, msgType, data, dataLen, true);
+	return sendIcmpMessage(dev, srcMacAddr, dstMacAddr, srcIPAddr, dstIPAddr, icmpMsgId, icmpMsgSeq, msgType, data, dataLen, true);
 }
 
 bool sendIcmpResponse(PcapLiveDevice* dev,
@@ -257,9 +294,69 @@ bool sendIcmpResponse(PcapLiveDevice* dev,
 		IPv4Address srcIPAddr, IPv4Address dstIPAddr,
 		size_t icmpMsgId,
 		uint64_t msgType,
-		uint8_t* data, size_t dataLen)
+		uint8_t* data, size_t dataLen,
+		uint16_t icmpMsgSeq)
 {
-	return sendIcmpMessage(dev, srcMacAddr, dstMacAddr, srcIPAddr, dstIPAddr, icmpMsgId, msgType, data, dataLen, false);
+	return sendIcmpMessage(dev, srcMacAddr, dstMacAddr, srcIPAddr, dstIPAddr, icmpMsgId, icmpMsgSeq, msgType, data, dataLen, false);
+}
+
+IcmpRequestBatch::IcmpRequestBatch(PcapLiveDevice* dev,
+		MacAddress srcMacAddr, MacAddress dstMacAddr,
+		IPv4Address srcIPAddr, IPv4Address dstIPAddr) :
+	m_Device(dev), m_SrcMacAddr(srcMacAddr), m_DstMacAddr(dstMacAddr), m_SrcIPAddr(srcIPAddr), m_DstIPAddr(dstIPAddr)
+{
+}
+
+void IcmpRequestBatch::add(uint16_t icmpMsgId, uint16_t icmpMsgSeq, uint64_t msgType, uint8_t* data, size_t dataLen)
+{
+	m_Requests.pushBack(createIcmpMessage(m_SrcMacAddr, m_DstMacAddr, m_SrcIPAddr, m_DstIPAddr, icmpMsgId, icmpMsgSeq, msgType, data, dataLen, true));
+}
+
+int IcmpRequestBatch::send()
+{
+	if (m_Requests.size() == 0)
+		return 0;
+
+	int numOfSent = m_Device->sendPackets(m_Requests);
+	m_Requests.clear();
+	return numOfSent;
+}
+
+std::vector<uint8_t> createWindowedStartData(uint32_t fileSize, uint32_t blockSize, const std::string& fileName)
+{
+	std::vector<uint8_t> data(2 * sizeof(uint32_t) + fileName.length() + 1);
+	uint32_t fileSizeNet = htonl(fileSize);
+	uint32_t blockSizeNet = htonl(blockSize);
+	memcpy(&data[0], &fileSizeNet, sizeof(uint32_t));
+	memcpy(&data[sizeof(uint32_t)], &blockSizeNet, sizeof(uint32_t));
+	memcpy(&data[2 * sizeof(uint32_t)], fileName.c_str(), fileName.length() + 1);
+	return data;
+}
+
+bool parseWindowedStartData(const uint8_t* data, size_t dataLen, uint32_t& fileSize, uint32_t& blockSize, std::string& fileName)
+{
+	// the data should contain the file size, block size and a non-empty null-terminated file name
+	if (data == NULL || dataLen < 2 * sizeof(uint32_t) + 2)
+		return false;
+
+	uint32_t fileSizeNet, blockSizeNet;
+	memcpy(&fileSizeNet, data, sizeof(uint32_t));
+	memcpy(&blockSizeNet, data + sizeof(uint32_t), sizeof(uint32_t));
+	fileSize = ntohl(fileSizeNet);
+	blockSize = ntohl(blockSizeNet);
+	if (blockSize < 1 || blockSize > 1464)
+		return false;
+
+	const char* name = (const char*)data + 2 * sizeof(uint32_t);
+	size_t maxNameLen = dataLen - 2 * sizeof(uint32_t);
+	size_t nameLen = 0;
+	while (nameLen < maxNameLen && name[nameLen] != '\0')
+		nameLen++;
+	if (nameLen == 0 || nameLen == maxNameLen)
+		return false;
+
+	fileName = std::string(name, nameLen);
+	return true;
 }
 
 std::string getFileNameFromPath(const std::string& filePath)
@@ -1,6 +1,7 @@
 #ifndef COMMON_H_
 #define COMMON_H_
 
+#include <vector>
 #include "MacAddress.h"
 #include "IpAddress.h"
 #include "PcapLiveDevice.h"
@@ -13,9 +14,16 @@
 #define ICMP_FT_ACK 0x395156c857fbcc6aULL
 #define ICMP_FT_END 0x144156cbeffa2687ULL
 #define ICMP_FT_ABORT 0x146158cbafff2b8aULL
+#define ICMP_FT_WINDOWED_WAITING_FT_START 0x2c5d96c3e7f1cd64ULL
+#define ICMP_FT_WINDOWED_START 0xa45be6c1e7a2cd69ULL
+#define ICMP_FT_WINDOWED_WAITING_DATA 0x5d5e86c517fa5d71ULL
+#define ICMP_FT_WINDOWED_DATA 0x2d5b76c627f25d7aULL
+#define ICMP_FT_WINDOWED_ACK 0x495256c957facc65ULL
 
 #define ONE_MBYTE 1048576
 
+#define MAX_WINDOW_SIZE 4096
+
 #define EXIT_WITH_ERROR(reason, ...) do { \
 	printf("\nError: " reason "\n\n", ## __VA_ARGS__); \
 	exit(1); \
@@ -41,29 +49,81 @@ void readCommandLineArguments(int argc, char* argv[],
 		bool& sender,  bool& receiver,
 		pcpp::IPv4Address& myIP, pcpp::IPv4Address& otherSideIP,
 		std::string& fileNameToSend,
-		int& packetPerSec, size_t& blockSize);
+		int& packetPerSec, size_t& blockSize, int& windowSize);
 
 /**
- * Send an ICMP request from source to dest with certain ICMP ID, msgType will be written in the timestamp field of the request, and data
- * will be written in the data section of the request
+ * Send an ICMP request from source to dest with certain ICMP ID and sequence, msgType will be written in the timestamp field of the request,
+ * and data will be written in the data section of the request
  */
 bool sendIcmpRequest(pcpp::PcapLiveDevice* dev,
 		pcpp::MacAddress srcMacAddr, pcpp::MacAddress dstMacAddr,
 		pcpp::IPv4Address srcIPAddr, pcpp::IPv4Address dstIPAddr,
 		size_t icmpMsgId,
 		uint64_t msgType,
-		uint8_t* data, size_t dataLen);
+		uint8_t* data, size_t dataLen,
+		uint16_t icmpMsgSeq = 0);
 
 /**
- * Send an ICMP reply from source to dest with certain ICMP ID, msgType will be written in the timestamp field of the request, and data
- * will be written in the data section of the request
+ * Send an ICMP reply from source to dest with certain ICMP ID and sequence, msgType will be written in the timestamp field of the request,
+ * and data will be written in the data section of the request
  */
 bool sendIcmpResponse(pcpp::PcapLiveDevice* dev,
 		pcpp::MacAddress srcMacAddr, pcpp::MacAddress dstMacAddr,
 		pcpp::IPv4Address srcIPAddr, pcpp::IPv4Address dstIPAddr,
 		size_t icmpMsgId,
 		uint64_t msgType,
-		uint8_t* data, size_t dataLen);
+		uint8_t* data, size_t dataLen,
+		uint16_t icmpMsgSeq = 0);
+
+/**
+ * A batch of ICMP requests from source to dest which is built message by message and sent with a single PcapLiveDevice#sendPackets()
+ * call, so a whole window of file chunks costs one batched send instead of a send per message
+ */
+class IcmpRequestBatch
+{
+public:
+	IcmpRequestBatch(pcpp::PcapLiveDevice* dev,
+			pcpp::MacAddress srcMacAddr, pcpp::MacAddress dstMacAddr,
+			pcpp::IPv4Address srcIPAddr, pcpp::IPv4Address dstIPAddr);
+
+	/**
+	 * Add an ICMP request to the batch, the parameters have the same meaning as in sendIcmpRequest()
+	 */
+	void add(uint16_t icmpMsgId, uint16_t icmpMsgSeq, uint64_t msgType, uint8_t* data, size_t dataLen);
+
+	/**
+	 * Send all requests in the batch and clear it
+	 * @return The number of requests sent successfully
+	 */
+	int send();
+
+	size_t size() const { return m_Requests.size(); }
+
+private:
+	pcpp::PcapLiveDevice* m_Device;
+	pcpp::MacAddress m_SrcMacAddr, m_DstMacAddr;
+	pcpp::IPv4Address m_SrcIPAddr, m_DstIPAddr;
+	pcpp::RawPacketVector m_Requests;
+};
+
+/**
+ * In windowed mode file chunks are numbered and the chunk index is carried in the ICMP ID (higher 16 bits) and sequence (lower 16 bits)
+ * fields, so every chunk can be acknowledged or requested on its own
+ */
+inline uint32_t getChunkIndex(uint16_t icmpMsgId, uint16_t icmpMsgSeq) { return ((uint32_t)icmpMsgId << 16) | icmpMsgSeq; }
+inline uint16_t getChunkIcmpId(uint32_t chunkIndex) { return (uint16_t)(chunkIndex >> 16); }
+inline uint16_t getChunkIcmpSeq(uint32_t chunkIndex) { return (uint16_t)(chunkIndex & 0xffff); }
+
+/**
+ * Build the data of an ICMP_FT_WINDOWED_START message: the file size and block size (both in network byte order) followed by the file name
+ */
+std::vector<uint8_t> createWindowedStartData(uint32_t fileSize, uint32_t blockSize, const std::string& fileName);
+
+/**
+ * Parse the data of an ICMP_FT_WINDOWED_START message (see createWindowedStartData()). Returns false if the data is malformed or the
+ * block size isn't valid
+ */
+bool parseWindowedStartData(const uint8_t* data, size_t dataLen, uint32_t& fileSize, uint32_t& blockSize, std::string& fileName);
 
 /**
  * An auxiliary method for extracting the file name from file path,
@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <iostream>
 #include <fstream>
+#include <vector>
 #if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV) 
 #include <in.h>
 #endif
@@ -32,6 +33,9 @@ struct IcmpFileTransferStart
 	IPv4Address catcherIPAddr;
 	std::string fileName;
 	uint16_t icmpId;
+	bool windowed;
+	uint32_t fileSize;
+	uint32_t blockSize;
 };
 
 /**
@@ -62,6 +66,40 @@ struct IcmpFileContentDataSend
 	char* memblock;
 };
 
+/**
+ * A struct used for receiving file data from the pitcher in windowed mode
+ */
+struct IcmpWindowedContentDataRecv
+{
+	IPv4Address pitcherIPAddr;
+	IPv4Address catcherIPAddr;
+	std::ofstream* file;
+	std::string fileName;
+	uint32_t fileSize;
+	uint32_t blockSize;
+	uint32_t numOfChunks;
+	uint8_t* fileBuffer;
+	std::vector<bool> chunkReceived;
+	uint32_t numOfChunksReceived;
+	uint32_t MBReceived;
+};
+
+/**
+ * A struct used for sending file data to the pitcher in windowed mode
+ */
+struct IcmpWindowedContentDataSend
+{
+	IPv4Address pitcherIPAddr;
+	IPv4Address catcherIPAddr;
+	std::ifstream* file;
+	uint32_t fileSize;
+	uint32_t blockSize;
+	uint32_t numOfChunks;
+	char* memblock;
+	std::vector<bool> chunkSent;
+	uint32_t MBSent;
+};
+
 
 /**
  * A callback used in the receiveFile() method and responsible to wait for the pitcher to send an ICMP request containing the file name
@@ -93,13 +131,24 @@ static bool waitForFileTransferStart(RawPacket* rawPacket, PcapLiveDevice* dev,
 
 	// check the ICMP timestamp field which contains the type of message delivered between pitcher and catcher
 	// in this case the catcher is waiting for a file-transfer start message from the pitcher containing the file name
-	// which is of type ICMP_FT_START
+	// which is of type ICMP_FT_START, or ICMP_FT_WINDOWED_START if the pitcher uses windowed mode
 	uint64_t resMsg = icmpLayer->getEchoRequestData()->header->timestamp;
-	if (resMsg != ICMP_FT_START)
-		return false;
+	if (resMsg == ICMP_FT_WINDOWED_START)
+	{
+		// in windowed mode the file size and block size precede the file name
+		if (!parseWindowedStartData(icmpLayer->getEchoRequestData()->data, icmpLayer->getEchoRequestData()->dataLength,
+				icmpFTStart->fileSize, icmpFTStart->blockSize, icmpFTStart->fileName))
+			return false;
 
-	// extract the file name from the ICMP request data
-	icmpFTStart->fileName = std::string((char*)icmpLayer->getEchoRequestData()->data);
+		icmpFTStart->windowed = true;
+	}
+	else if (resMsg == ICMP_FT_START)
+	{
+		// extract the file name from the ICMP request data
+		icmpFTStart->fileName = std::string((char*)icmpLayer->getEchoRequestData()->data);
+	}
+	else
+		return false;
 
 	// extract ethernet layer and ICMP ID to be able to respond to the pitcher
 	EthLayer* ethLayer = parsedPacket.getLayerOfType<EthLayer>();
@@ -202,6 +251,110 @@ static bool getFileContent(RawPacket* rawPacket, PcapLiveDevice* dev, void* icmp
 }
 
 
+/**
+ * A callback used in the receiveFile() method in windowed mode and responsible to receive file data chunks arriving from the pitcher in any
+ * order, write them to their place in the preallocated file buffer and ack each of them
+ */
+static bool getFileContentWindowed(RawPacket* rawPacket, PcapLiveDevice* dev, void* icmpVoidData)
+{
+	// first, parse the packet
+	Packet parsedPacket(rawPacket);
+
+	// verify it's ICMP and IPv4 (IPv6 and ICMPv6 are not supported)
+	if (!parsedPacket.isPacketOfType(ICMP) || !parsedPacket.isPacketOfType(IPv4))
+		return false;
+
+	if (icmpVoidData == NULL)
+		return false;
+
+	IcmpWindowedContentDataRecv* icmpData = (IcmpWindowedContentDataRecv*)icmpVoidData;
+
+	// extract the ICMP layer, verify it's an ICMP request
+	IcmpLayer* icmpLayer = parsedPacket.getLayerOfType<IcmpLayer>();
+	icmp_echo_request* echoRequest = icmpLayer->getEchoRequestData();
+	if (echoRequest == NULL)
+		return false;
+
+	// verify the source IP is the pitcher's IP and the dest IP is the catcher's IP
+	IPv4Layer* ip4Layer = parsedPacket.getLayerOfType<IPv4Layer>();
+	if (ip4Layer->getSrcIpAddress() != icmpData->pitcherIPAddr || ip4Layer->getDstIpAddress() != icmpData->catcherIPAddr)
+		return false;
+
+	// extract message type from the ICMP request. Message type is written in ICMP request timestamp field
+	uint64_t resMsg = echoRequest->header->timestamp;
+
+	// if the pitcher sent an abort message, remove the file and exit the program
+	if (resMsg == ICMP_FT_ABORT)
+	{
+		icmpData->file->close();
+		EXIT_WITH_ERROR_AND_RUN_COMMAND("Got an abort message from pitcher. Exiting...", std::remove(icmpData->fileName.c_str()));
+	}
+
+	if (resMsg != ICMP_FT_WINDOWED_DATA && resMsg != ICMP_FT_END)
+		return false;
+
+	// extract ethernet layer and ICMP ID and sequence to be able to respond to the pitcher
+	EthLayer* ethLayer = parsedPacket.getLayerOfType<EthLayer>();
+	uint16_t icmpId = ntohs(echoRequest->header->id);
+	uint16_t icmpSeq = ntohs(echoRequest->header->sequence);
+
+	// if message type is ICMP_FT_END it means the pitcher got acks for all file chunks. Ack it and stop receiveFile() from blocking
+	if (resMsg == ICMP_FT_END)
+	{
+		if (icmpData->numOfChunksReceived != icmpData->numOfChunks)
+			return false;
+
+		if (!sendIcmpResponse(dev,
+				dev->getMacAddress(), ethLayer->getSourceMac(),
+				icmpData->catcherIPAddr, icmpData->pitcherIPAddr,
+				icmpId, ICMP_FT_END,
+				NULL, 0, icmpSeq))
+			EXIT_WITH_ERROR("Cannot send file transfer end message to pitcher");
+
+		printf(".");
+		return true;
+	}
+
+	// the chunk index is carried in the ICMP ID and sequence
+	uint32_t chunkIndex = getChunkIndex(icmpId, icmpSeq);
+	if (chunkIndex >= icmpData->numOfChunks)
+		return false;
+
+	// verify the request carries the whole chunk. The last chunk of the file may be shorter than the block size
+	size_t chunkOffset = (size_t)chunkIndex * icmpData->blockSize;
+	size_t chunkLen = icmpData->fileSize - chunkOffset < icmpData->blockSize ? icmpData->fileSize - chunkOffset : icmpData->blockSize;
+	if (echoRequest->data == NULL || echoRequest->dataLength < chunkLen)
+		return false;
+
+	// write the chunk to its place in the file buffer, unless it's a retransmission of a chunk which was already received
+	if (!icmpData->chunkReceived[chunkIndex])
+	{
+		memcpy(icmpData->fileBuffer + chunkOffset, echoRequest->data, chunkLen);
+		icmpData->chunkReceived[chunkIndex] = true;
+		icmpData->numOfChunksReceived++;
+
+		// print a dot (".") for every 1MB received
+		icmpData->MBReceived += chunkLen;
+		if (icmpData->MBReceived > ONE_MBYTE)
+		{
+			icmpData->MBReceived -= ONE_MBYTE;
+			printf(".");
+		}
+	}
+
+	// ack the chunk, also when it was already received since the previous ack may have been lost
+	if (!sendIcmpResponse(dev,
+			dev->getMacAddress(), ethLayer->getSourceMac(),
+			icmpData->catcherIPAddr, icmpData->pitcherIPAddr,
+			icmpId, ICMP_FT_WINDOWED_ACK,
+			NULL, 0, icmpSeq))
+		EXIT_WITH_ERROR("Cannot send ACK message to pitcher");
+
+	// return and wait for the next data packet
+	return false;
+}
+
+
 /**
  * Receive a file from the pitcher
  */
@@ -227,6 +380,9 @@ void receiveFile(IPv4Address pitcherIP, IPv4Address catcherIP)
 			pitcherIP,
 			catcherIP,
 			"",
+			0,
+			false,
+			0,
 			0
 	};
 
@@ -242,25 +398,63 @@ void receiveFile(IPv4Address pitcherIP, IPv4Address catcherIP)
 	{
 		printf("Getting file from pitcher: '%s' ", icmpFTStart.fileName.c_str());
 
-		IcmpFileContentDataRecv icmpFileContentData = {
-				pitcherIP,
-				catcherIP,
-				&file,
-				icmpFTStart.fileName,
-				(uint16_t)(icmpFTStart.icmpId+1),
-				0,
-				0
-		};
-
-		// get all file data from the pitcher. This method blocks until all file is received
-		res = dev->startCaptureBlockingMode(getFileContent, &icmpFileContentData, -1);
-		if (!res)
+		if (icmpFTStart.windowed)
 		{
+			// in windowed mode chunks may arrive in any order, so they're written to their place in a buffer of the whole file, which is
+			// written to the file once the pitcher signals all chunks were acked
+			uint32_t numOfChunks = (uint32_t)(((uint64_t)icmpFTStart.fileSize + icmpFTStart.blockSize - 1) / icmpFTStart.blockSize);
+
+			IcmpWindowedContentDataRecv icmpWindowedContentData = {
+					pitcherIP,
+					catcherIP,
+					&file,
+					icmpFTStart.fileName,
+					icmpFTStart.fileSize,
+					icmpFTStart.blockSize,
+					numOfChunks,
+					new uint8_t[icmpFTStart.fileSize > 0 ? icmpFTStart.fileSize : 1],
+					std::vector<bool>(numOfChunks, false),
+					0,
+					0
+			};
+
+			// get all file data from the pitcher. This method blocks until all file is received
+			res = dev->startCaptureBlockingMode(getFileContentWindowed, &icmpWindowedContentData, -1);
+			if (!res)
+			{
+				delete [] icmpWindowedContentData.fileBuffer;
+				file.close();
+				EXIT_WITH_ERROR_AND_RUN_COMMAND("Cannot start capturing packets", std::remove(icmpFTStart.fileName.c_str()));
+			}
+
+			file.write((char*)icmpWindowedContentData.fileBuffer, icmpFTStart.fileSize);
 			file.close();
-			EXIT_WITH_ERROR_AND_RUN_COMMAND("Cannot start capturing packets", std::remove(icmpFTStart.fileName.c_str()));
-		}
+			delete [] icmpWindowedContentData.fileBuffer;
 
-		printf("\n\nFinished getting file '%s' [received %d bytes]\n", icmpFTStart.fileName.c_str(), icmpFileContentData.fileSize);
+			printf("\n\nFinished getting file '%s' [received %u bytes]\n", icmpFTStart.fileName.c_str(), icmpFTStart.fileSize);
+		}
+		else
+		{
+			IcmpFileContentDataRecv icmpFileContentData = {
+					pitcherIP,
+					catcherIP,
+					&file,
+					icmpFTStart.fileName,
+					(uint16_t)(icmpFTStart.icmpId+1),
+					0,
+					0
+			};
+
+			// get all file data from the pitcher. This method blocks until all file is received
+			res = dev->startCaptureBlockingMode(getFileContent, &icmpFileContentData, -1);
+			if (!res)
+			{
+				file.close();
+				EXIT_WITH_ERROR_AND_RUN_COMMAND("Cannot start capturing packets", std::remove(icmpFTStart.fileName.c_str()));
+			}
+
+			printf("\n\nFinished getting file '%s' [received %d bytes]\n", icmpFTStart.fileName.c_str(), icmpFileContentData.fileSize);
+		}
 	}
 	else
 		EXIT_WITH_ERROR("Cannot create file");
@@ -300,21 +494,30 @@ static bool startFileTransfer(RawPacket* rawPacket, PcapLiveDevice* dev, void* i
 		return false;
 
 	// check the ICMP timestamp field which contains the type of message delivered between pitcher and catcher
-	// in this case the catcher is waiting for a keep-alive message from the pitcher which is of type ICMP_FT_WAITING_FT_START
+	// in this case the catcher is waiting for a keep-alive message from the pitcher which is of type ICMP_FT_WAITING_FT_START, or
+	// ICMP_FT_WINDOWED_WAITING_FT_START if the pitcher uses windowed mode
 	uint64_t resMsg = icmpLayer->getEchoRequestData()->header->timestamp;
-	if (resMsg != ICMP_FT_WAITING_FT_START)
+	if (resMsg != ICMP_FT_WAITING_FT_START && resMsg != ICMP_FT_WINDOWED_WAITING_FT_START)
 		return false;
 
+	icmpFTStart->windowed = (resMsg == ICMP_FT_WINDOWED_WAITING_FT_START);
+
 	// extract ethernet layer and ICMP ID to be able to respond to the pitcher
 	EthLayer* ethLayer = parsedPacket.getLayerOfType<EthLayer>();
 	uint16_t icmpId = ntohs(icmpLayer->getEchoRequestData()->header->id);
 
-	// send the ICMP response containing the file name back to the pitcher
+	// send the ICMP response containing the file name back to the pitcher. In windowed mode the file size and block size precede it
+	std::vector<uint8_t> startData;
+	if (icmpFTStart->windowed)
+		startData = createWindowedStartData(icmpFTStart->fileSize, icmpFTStart->blockSize, icmpFTStart->fileName);
+	else
+		startData.assign((uint8_t*)icmpFTStart->fileName.c_str(), (uint8_t*)icmpFTStart->fileName.c_str() + icmpFTStart->fileName.length() + 1);
+
 	if (!sendIcmpResponse(dev,
 			dev->getMacAddress(), ethLayer->getSourceMac(),
 			icmpFTStart->catcherIPAddr, icmpFTStart->pitcherIPAddr,
-			icmpId, ICMP_FT_START,
-			(uint8_t*)icmpFTStart->fileName.c_str(), icmpFTStart->fileName.length()+1))
+			icmpId, icmpFTStart->windowed ? ICMP_FT_WINDOWED_START : ICMP_FT_START,
+			&startData[0], startData.size()))
 		EXIT_WITH_ERROR("Cannot send file transfer start message to pitcher");
 
 	return true;
@@ -427,6 +630,102 @@ static bool sendContent(RawPacket* rawPacket, PcapLiveDevice* dev, void* icmpVoi
 }
 
 
+/**
+ * A callback used in the sendFile() method in windowed mode and responsible to wait for ICMP requests coming from the pitcher, each asking
+ * for a file data chunk by its index, and send the chunk as a reply in the ICMP response data
+ */
+static bool sendContentWindowed(RawPacket* rawPacket, PcapLiveDevice* dev, void* icmpVoidData)
+{
+	// first, parse the packet
+	Packet parsedPacket(rawPacket);
+
+	// verify it's ICMP and IPv4 (IPv6 and ICMPv6 are not supported)
+	if (!parsedPacket.isPacketOfType(ICMP) || !parsedPacket.isPacketOfType(IPv4))
+		return false;
+
+	if (icmpVoidData == NULL)
+		return false;
+
+	IcmpWindowedContentDataSend* icmpFileContentData = (IcmpWindowedContentDataSend*)icmpVoidData;
+
+	// extract the ICMP layer, verify it's an ICMP request
+	IcmpLayer* icmpLayer = parsedPacket.getLayerOfType<IcmpLayer>();
+	icmp_echo_request* echoRequest = icmpLayer->getEchoRequestData();
+	if (echoRequest == NULL)
+		return false;
+
+	// verify the source IP is the pitcher's IP and the dest IP is the catcher's IP
+	IPv4Layer* ip4Layer = parsedPacket.getLayerOfType<IPv4Layer>();
+	if (ip4Layer->getSrcIpAddress() != icmpFileContentData->pitcherIPAddr || ip4Layer->getDstIpAddress() != icmpFileContentData->catcherIPAddr)
+		return false;
+
+	// check the ICMP timestamp field which contains the type of message delivered between pitcher and catcher
+	uint64_t resMsg = echoRequest->header->timestamp;
+
+	// if the pitcher sent an abort message, exit the program
+	if (resMsg == ICMP_FT_ABORT)
+		EXIT_WITH_ERROR("Got an abort message from pitcher. Exiting...");
+
+	if (resMsg != ICMP_FT_WINDOWED_WAITING_DATA && resMsg != ICMP_FT_END)
+		return false;
+
+	// extract ethernet layer and ICMP ID and sequence to be able to respond to the pitcher
+	EthLayer* ethLayer = parsedPacket.getLayerOfType<EthLayer>();
+	uint16_t icmpId = ntohs(echoRequest->header->id);
+	uint16_t icmpSeq = ntohs(echoRequest->header->sequence);
+
+	// if message type is ICMP_FT_END it means the pitcher got all file chunks. Ack it and stop sendFile() from blocking
+	if (resMsg == ICMP_FT_END)
+	{
+		if (!sendIcmpResponse(dev,
+				dev->getMacAddress(), ethLayer->getSourceMac(),
+				icmpFileContentData->catcherIPAddr, icmpFileContentData->pitcherIPAddr,
+				icmpId, ICMP_FT_END,
+				NULL, 0, icmpSeq))
+			EXIT_WITH_ERROR("Cannot send file transfer end message to pitcher");
+
+		printf(".");
+		return true;
+	}
+
+	// the chunk index is carried in the ICMP ID and sequence
+	uint32_t chunkIndex = getChunkIndex(icmpId, icmpSeq);
+	if (chunkIndex >= icmpFileContentData->numOfChunks)
+		return false;
+
+	// read the chunk from the file. The last chunk of the file may be shorter than the block size
+	size_t chunkOffset = (size_t)chunkIndex * icmpFileContentData->blockSize;
+	size_t chunkLen = icmpFileContentData->fileSize - chunkOffset < icmpFileContentData->blockSize ?
+			icmpFileContentData->fileSize - chunkOffset : icmpFileContentData->blockSize;
+	icmpFileContentData->file->clear();
+	icmpFileContentData->file->seekg(chunkOffset, std::ios::beg);
+	if (!icmpFileContentData->file->read(icmpFileContentData->memblock, chunkLen))
+		EXIT_WITH_ERROR("Cannot read file data chunk #%u", chunkIndex);
+
+	// send the chunk via the ICMP response to the pitcher. The data chunk will be sent in the response data
+	if (!sendIcmpResponse(dev,
+			dev->getMacAddress(), ethLayer->getSourceMac(),
+			icmpFileContentData->catcherIPAddr, icmpFileContentData->pitcherIPAddr,
+			icmpId, ICMP_FT_WINDOWED_DATA,
+			(uint8_t*)icmpFileContentData->memblock, chunkLen, icmpSeq))
+		EXIT_WITH_ERROR("Cannot send file transfer data message to pitcher");
+
+	// print a dot ('.') on every 1MB sent, not counting chunks the pitcher asked for again
+	if (!icmpFileContentData->chunkSent[chunkIndex])
+	{
+		icmpFileContentData->chunkSent[chunkIndex] = true;
+		icmpFileContentData->MBSent += chunkLen;
+		if (icmpFileContentData->MBSent > ONE_MBYTE)
+		{
+			icmpFileContentData->MBSent -= ONE_MBYTE;
+			printf(".");
+		}
+	}
+
+	return false;
+}
+
+
 /**
  * Send a file to the pitcher
  */
@@ -467,7 +766,10 @@ void sendFile(std::string filePath, IPv4Address pitcherIP, IPv4Address catcherIP
 				pitcherIP,
 				catcherIP,
 				fileName,
-				0
+				0,
+				false,
+				fileSize,
+				(uint32_t)blockSize
 		};
 
 		// first, establish a connection with the pitcher and send it the file name. This method waits for the pitcher to send an ICMP
@@ -479,31 +781,63 @@ void sendFile(std::string filePath, IPv4Address pitcherIP, IPv4Address catcherIP
 
 		printf("Sending file '%s' ", fileName.c_str());
 
+		if (icmpFTStart.windowed)
+		{
+			// in windowed mode the pitcher asks for each chunk by its index, possibly more than once if the reply was lost, so chunks are
+			// read from their place in the file
+			uint32_t numOfChunks = (uint32_t)(((uint64_t)fileSize + blockSize - 1) / blockSize);
+
+			IcmpWindowedContentDataSend icmpWindowedContentData = {
+					pitcherIP,
+					catcherIP,
+					&file,
+					fileSize,
+					(uint32_t)blockSize,
+					numOfChunks,
+					new char[blockSize],
+					std::vector<bool>(numOfChunks, false),
+					0
+			};
+
+			// wait for ICMP requests coming from the pitcher and send the requested file data chunks as a reply in the ICMP response data
+			// this method returns when the pitcher got all file chunks
+			res = dev->startCaptureBlockingMode(sendContentWindowed, &icmpWindowedContentData, -1);
+
+			// free the memory block data and close the file
+			delete [] icmpWindowedContentData.memblock;
+			file.close();
 
-		IcmpFileContentDataSend icmpFileContentData = {
-				pitcherIP,
-				catcherIP,
-				&file,
-				true,
-				0,
-				blockSize,
-				NULL
-		};
-
-		// create the memory block that will contain the file data chunks that will be transferred to the pitcher
-		icmpFileContentData.memblock = new char[blockSize];
-
-		// wait for ICMP requests coming from the pitcher and send file data chunks as a reply in the ICMP response data
-		// this method returns when all file was transferred to the pitcher
-		res = dev->startCaptureBlockingMode(sendContent, &icmpFileContentData, -1);
-
-		// free the memory block data and close the file
-		delete [] icmpFileContentData.memblock;
-		file.close();
+			// if capture failed, exit the program
+			if (!res)
+				EXIT_WITH_ERROR("Cannot start capturing packets");
+		}
+		else
+		{
+			IcmpFileContentDataSend icmpFileContentData = {
+					pitcherIP,
+					catcherIP,
+					&file,
+					true,
+					0,
+					blockSize,
+					NULL
+			};
+
+			// create the memory block that will contain the file data chunks that will be transferred to the pitcher
+			icmpFileContentData.memblock = new char[blockSize];
+
+			// wait for ICMP requests coming from the pitcher and send file data chunks as a reply in the ICMP response data
+			// this method returns when all file was transferred to the pitcher
+			res = dev->startCaptureBlockingMode(sendContent, &icmpFileContentData, -1);
+
+			// free the memory block data and close the file
+			delete [] icmpFileContentData.memblock;
+			file.close();
 
-		// if capture failed, exit the program
-		if (!res)
-			EXIT_WITH_ERROR("Cannot start capturing packets");
+			// if capture failed, exit the program
+			if (!res)
+				EXIT_WITH_ERROR("Cannot start capturing packets");
+		}
 
 		printf("\n\nFinished sending '%s' [sent %d bytes]\n", fileName.c_str(), fileSize);
 	}
@@ -527,12 +861,13 @@ int main(int argc, char* argv[])
 	std::string fileNameToSend = "";
 	int packetsPerSec = 0;
 	size_t blockSize = 0;
+	int windowSize = 0;
 
 	// disable stdout buffering so all printf command will be printed immediately
 	setbuf(stdout, NULL);
 
 	// read and parse command line arguments. This method also takes care of arguments correctness. If they're not correct, it'll exit the program
-	readCommandLineArguments(argc, argv, "catcher", "pitcher", sender, receiver, catcherIP, pitcherIP, fileNameToSend, packetsPerSec, blockSize);
+	readCommandLineArguments(argc, argv, "catcher", "pitcher", sender, receiver, catcherIP, pitcherIP, fileNameToSend, packetsPerSec, blockSize, windowSize);
 
 	// send a file to the pitcher
 	if (sender)
@@ -9,6 +9,8 @@
 #include <stdlib.h>
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <pthread.h>
 #ifndef _MSC_VER
 #include "unistd.h"
 #endif
@@ -33,6 +35,11 @@ using namespace pcpp;
 #define SLEEP_BETWEEN_ABORT_MESSAGES  100000 // 100 msec
 #define NUM_OF_ABORT_MESSAGES_TO_SEND 5
 
+#define WINDOW_RETRANSMIT_TIMEOUT 200000 // 200 msec
+#define WINDOW_MAX_RETRANSMITS 50
+#define WINDOW_MAX_BATCH_SIZE 64
+#define WINDOW_POLL_INTERVAL 200 // 200 usec
+
 #ifdef _MSC_VER
 #include <windows.h>
 
@@ -69,6 +76,9 @@ struct IcmpFileTransferStartRecv
 	IPv4Address catcherIPAddr;
 	bool gotFileTransferStartMsg;
 	std::string fileName;
+	bool windowed;
+	uint32_t fileSize;
+	uint32_t blockSize;
 };
 
 /**
@@ -86,6 +96,72 @@ struct IcmpFileContentData
 	bool fileTransferError;
 };
 
+/**
+ * A struct used for a windowed file transfer in both directions. It's shared between the main thread, which runs the sliding window, and
+ * the capture thread, which collects the chunks the catcher acknowledged (when sending a file) or sent (when receiving a file)
+ */
+struct IcmpWindowedTransfer
+{
+	IPv4Address pitcherIPAddr;
+	IPv4Address catcherIPAddr;
+	bool sending;
+	uint32_t fileSize;
+	uint32_t blockSize;
+	uint32_t numOfChunks;
+
+	// when receiving a file: the preallocated buffer chunks are written to in their place in the file, and which chunks were already
+	// written. These are touched only by the capture thread until capturing stops
+	uint8_t* fileBuffer;
+	std::vector<bool> chunkReceived;
+
+	// the chunks completed since the main thread last collected them, and whether the catcher acknowledged the end of the transfer.
+	// These are guarded by the mutex
+	pthread_mutex_t mutex;
+	std::vector<uint32_t> completedChunks;
+	bool endAcked;
+
+	IcmpWindowedTransfer(IPv4Address pitcherIP, IPv4Address catcherIP, bool sendingFile, uint32_t size, uint32_t chunkSize) :
+		pitcherIPAddr(pitcherIP), catcherIPAddr(catcherIP), sending(sendingFile), fileSize(size), blockSize(chunkSize),
+		numOfChunks((uint32_t)(((uint64_t)size + chunkSize - 1) / chunkSize)), fileBuffer(NULL), endAcked(false)
+	{
+		pthread_mutex_init(&mutex, NULL);
+	}
+
+	~IcmpWindowedTransfer() { pthread_mutex_destroy(&mutex); }
+};
+
+
+/**
+ * Get the current time in microseconds
+ */
+static uint64_t getCurrentTimeUsec()
+{
+	long sec = 0, nsec = 0;
+	clockGetTime(sec, nsec);
+	return (uint64_t)sec * 1000000 + nsec / 1000;
+}
+
+
+/**
+ * Sleep long enough to keep the user defined packetPerSec rate after sending numOfMessages messages. usleep isn't used for 1 second or
+ * more as it's not working for such values
+ */
+static void sleepAfterSending(size_t numOfMessages, int packetPerSec)
+{
+	if (packetPerSec < 1)
+		return;
+
+	uint64_t sleepTime = (uint64_t)numOfMessages * 1000000 / packetPerSec;
+	if (sleepTime >= 1000000)
+	{
+		PCAP_SLEEP(sleepTime / 1000000);
+		sleepTime %= 1000000;
+	}
+
+	if (sleepTime > 0)
+		usleep(sleepTime);
+}
+
 
 /**
  * A callback used in the receiveFile() method and responsible to wait for the catcher to send an ICMP response containing the file name
@@ -115,17 +191,24 @@ static void waitForFileTransferStart(RawPacket* rawPacket, PcapLiveDevice* dev,
 	if (ip4Layer->getSrcIpAddress() != icmpFTStart->catcherIPAddr || ip4Layer->getDstIpAddress() != icmpFTStart->pitcherIPAddr)
 		return;
 
-	// extract the message type in the ICMP reply timestamp field and check if it's  ICMP_FT_START
+	// extract the message type in the ICMP reply timestamp field and check if it's ICMP_FT_START, or ICMP_FT_WINDOWED_START in windowed mode
 	uint64_t resMsg = icmpLayer->getEchoReplyData()->header->timestamp;
-	if (resMsg != ICMP_FT_START)
+	if (resMsg != (icmpFTStart->windowed ? ICMP_FT_WINDOWED_START : ICMP_FT_START))
 		return;
 
 	// verify there is data in the ICMP reply
 	if (icmpLayer->getEchoReplyData()->data == NULL)
 		return;
 
-	// extract the file name from the ICMP reply data
-	icmpFTStart->fileName = std::string((char*)icmpLayer->getEchoReplyData()->data);
+	// extract the file name from the ICMP reply data. In windowed mode the file size and block size precede it
+	if (icmpFTStart->windowed)
+	{
+		if (!parseWindowedStartData(icmpLayer->getEchoReplyData()->data, icmpLayer->getEchoReplyData()->dataLength,
+				icmpFTStart->fileSize, icmpFTStart->blockSize, icmpFTStart->fileName))
+			return;
+	}
+	else
+		icmpFTStart->fileName = std::string((char*)icmpLayer->getEchoReplyData()->data);
 
 	// signal the receiveFile() file name was extracted and it can stop capturing packets
 	icmpFTStart->gotFileTransferStartMsg = true;
@@ -210,10 +293,253 @@ static void getFileContent(RawPacket* rawPacket, PcapLiveDevice* dev, void* icmp
 }
 
 
+/**
+ * A callback used in windowed mode and responsible to collect the ICMP replies of the catcher: acks of file data chunks when sending a file,
+ * file data chunks when receiving a file, and the ack of the end of the transfer. Data chunks are written to their place in the preallocated
+ * file buffer, so they can arrive in any order
+ */
+static void getWindowedTransferReply(RawPacket* rawPacket, PcapLiveDevice* dev, void* icmpVoidData)
+{
+	// first, parse the packet
+	Packet parsedPacket(rawPacket);
+
+	// verify it's ICMP and IPv4 (IPv6 and ICMPv6 are not supported)
+	if (!parsedPacket.isPacketOfType(ICMP) || !parsedPacket.isPacketOfType(IPv4))
+		return;
+
+	if (icmpVoidData == NULL)
+		return;
+
+	IcmpWindowedTransfer* transfer = (IcmpWindowedTransfer*)icmpVoidData;
+
+	// extract the ICMP layer, verify it's an ICMP reply
+	IcmpLayer* icmpLayer = parsedPacket.getLayerOfType<IcmpLayer>();
+	icmp_echo_reply* echoReply = icmpLayer->getEchoReplyData();
+	if (echoReply == NULL)
+		return;
+
+	// verify the source IP is the catcher's IP and the dest IP is the pitcher's IP
+	IPv4Layer* ip4Layer = parsedPacket.getLayerOfType<IPv4Layer>();
+	if (ip4Layer->getSrcIpAddress() != transfer->catcherIPAddr || ip4Layer->getDstIpAddress() != transfer->pitcherIPAddr)
+		return;
+
+	// extract the message type from the ICMP reply timestamp field
+	uint64_t resMsg = echoReply->header->timestamp;
+
+	// if message type is ICMP_FT_END the catcher acknowledged the end of the transfer
+	if (resMsg == ICMP_FT_END)
+	{
+		pthread_mutex_lock(&transfer->mutex);
+		transfer->endAcked = true;
+		pthread_mutex_unlock(&transfer->mutex);
+		return;
+	}
+
+	// otherwise only chunk acks are expected when sending a file, and only data chunks when receiving a file
+	if (resMsg != (transfer->sending ? ICMP_FT_WINDOWED_ACK : ICMP_FT_WINDOWED_DATA))
+		return;
+
+	// the chunk index is carried in the ICMP ID and sequence
+	uint32_t chunkIndex = getChunkIndex(ntohs(echoReply->header->id), ntohs(echoReply->header->sequence));
+	if (chunkIndex >= transfer->numOfChunks)
+		return;
+
+	if (!transfer->sending)
+	{
+		// ignore chunks which were already received, for example when both the request and its retransmission were answered
+		if (transfer->chunkReceived[chunkIndex])
+			return;
+
+		// verify the reply carries the whole chunk. The last chunk of the file may be shorter than the block size
+		size_t chunkOffset = (size_t)chunkIndex * transfer->blockSize;
+		size_t chunkLen = transfer->fileSize - chunkOffset < transfer->blockSize ? transfer->fileSize - chunkOffset : transfer->blockSize;
+		if (echoReply->data == NULL || echoReply->dataLength < chunkLen)
+			return;
+
+		// write the chunk to its place in the file buffer
+		memcpy(transfer->fileBuffer + chunkOffset, echoReply->data, chunkLen);
+		transfer->chunkReceived[chunkIndex] = true;
+	}
+
+	// hand the completed chunk to the main thread
+	pthread_mutex_lock(&transfer->mutex);
+	transfer->completedChunks.push_back(chunkIndex);
+	pthread_mutex_unlock(&transfer->mutex);
+}
+
+
+/**
+ * Add a request for one chunk to the batch: when sending a file the request carries the chunk data read from the file, when receiving a file
+ * the request is empty and the catcher replies with the chunk data
+ */
+static void addChunkRequest(IcmpRequestBatch& batch, IcmpWindowedTransfer& transfer, std::ifstream* file, uint8_t* memblock, uint32_t chunkIndex)
+{
+	if (!transfer.sending)
+	{
+		batch.add(getChunkIcmpId(chunkIndex), getChunkIcmpSeq(chunkIndex), ICMP_FT_WINDOWED_WAITING_DATA, NULL, 0);
+		return;
+	}
+
+	// read the chunk from the file. The last chunk of the file may be shorter than the block size
+	size_t chunkOffset = (size_t)chunkIndex * transfer.blockSize;
+	size_t chunkLen = transfer.fileSize - chunkOffset < transfer.blockSize ? transfer.fileSize - chunkOffset : transfer.blockSize;
+	file->clear();
+	file->seekg(chunkOffset, std::ios::beg);
+	if (!file->read((char*)memblock, chunkLen))
+		EXIT_WITH_ERROR("Cannot read file data chunk #%u", chunkIndex);
+
+	batch.add(getChunkIcmpId(chunkIndex), getChunkIcmpSeq(chunkIndex), ICMP_FT_WINDOWED_DATA, memblock, chunkLen);
+}
+
+
+/**
+ * Run a windowed transfer once the catcher agreed to it. Up to windowSize chunks are in flight: new chunks and chunks the catcher didn't
+ * ack (or send) in time are sent in batches, and the window slides over the chunks completed at its start. When all chunks are completed
+ * an ICMP_FT_END message is sent until the catcher acknowledges it. Returns false if a chunk was retransmitted too many times, in which
+ * case abort messages were sent to the catcher
+ */
+static bool runWindowedTransfer(PcapLiveDevice* dev, MacAddress pitcherMacAddr, MacAddress catcherMacAddr, IcmpWindowedTransfer& transfer,
+		std::ifstream* file, int windowSize, int packetPerSec)
+{
+	// start capturing ICMP packets. The getWindowedTransferReply callback collects the chunks completed by the catcher
+	if (!dev->startCapture(getWindowedTransferReply, &transfer))
+		return false;
+
+	IcmpRequestBatch batch(dev, pitcherMacAddr, catcherMacAddr, transfer.pitcherIPAddr, transfer.catcherIPAddr);
+	uint8_t* memblock = new uint8_t[transfer.blockSize];
+
+	// the completion state of all chunks, and the send time and number of sends of the chunks in the window (indexed by chunk index
+	// modulo the window size)
+	std::vector<bool> chunkCompleted(transfer.numOfChunks, false);
+	std::vector<uint64_t> chunkSendTime(windowSize, 0);
+	std::vector<int> chunkNumOfSends(windowSize, 0);
+	std::vector<uint32_t> newlyCompleted;
+
+	// the window is [windowStart, windowEnd): chunks before it are completed, chunks after it were never sent
+	uint32_t windowStart = 0;
+	uint32_t windowEnd = 0;
+	uint32_t MBCompleted = 0;
+	uint32_t numOfRetransmits = 0;
+	bool aborted = false;
+
+	while (windowStart < transfer.numOfChunks && !aborted)
+	{
+		// collect the chunks the capture thread completed
+		pthread_mutex_lock(&transfer.mutex);
+		newlyCompleted.swap(transfer.completedChunks);
+		pthread_mutex_unlock(&transfer.mutex);
+
+		for (std::vector<uint32_t>::iterator iter = newlyCompleted.begin(); iter != newlyCompleted.end(); iter++)
+		{
+			if (*iter >= windowEnd || chunkCompleted[*iter])
+				continue;
+
+			chunkCompleted[*iter] = true;
+
+			// print a dot (".") for every 1MB completed
+			MBCompleted += transfer.blockSize;
+			if (MBCompleted > ONE_MBYTE)
+			{
+				MBCompleted -= ONE_MBYTE;
+				printf(".");
+			}
+		}
+		newlyCompleted.clear();
+
+		// slide the window over the completed chunks at its start
+		while (windowStart < windowEnd && chunkCompleted[windowStart])
+			windowStart++;
+
+		uint64_t now = getCurrentTimeUsec();
+
+		// selectively retransmit the chunks in the window which weren't completed in time
+		for (uint32_t chunkIndex = windowStart; chunkIndex < windowEnd && batch.size() < WINDOW_MAX_BATCH_SIZE; chunkIndex++)
+		{
+			size_t slot = chunkIndex % windowSize;
+			if (chunkCompleted[chunkIndex] || now - chunkSendTime[slot] < WINDOW_RETRANSMIT_TIMEOUT)
+				continue;
+
+			if (chunkNumOfSends[slot] > WINDOW_MAX_RETRANSMITS)
+			{
+				printf("\n\nChunk #%u wasn't completed after %d retransmissions\n", chunkIndex, WINDOW_MAX_RETRANSMITS);
+				aborted = true;
+				break;
+			}
+
+			addChunkRequest(batch, transfer, file, memblock, chunkIndex);
+			chunkSendTime[slot] = now;
+			chunkNumOfSends[slot]++;
+			numOfRetransmits++;
+		}
+
+		// send new chunks as long as the window isn't full
+		while (!aborted && windowEnd < transfer.numOfChunks && windowEnd - windowStart < (uint32_t)windowSize && batch.size() < WINDOW_MAX_BATCH_SIZE)
+		{
+			size_t slot = windowEnd % windowSize;
+			addChunkRequest(batch, transfer, file, memblock, windowEnd);
+			chunkSendTime[slot] = now;
+			chunkNumOfSends[slot] = 1;
+			windowEnd++;
+		}
+
+		// send the whole batch at once. Requests which couldn't be sent are retransmitted when their timeout expires. If there's nothing
+		// to send the window is full, so wait a little for the catcher
+		size_t batchSize = batch.size();
+		if (batchSize > 0)
+		{
+			batch.send();
+			sleepAfterSending(batchSize, packetPerSec);
+		}
+		else if (!aborted)
+			usleep(WINDOW_POLL_INTERVAL);
+	}
+
+	// all chunks were completed, keep sending the ICMP_FT_END message until the catcher acknowledges it
+	bool endAcked = false;
+	for (int i = 0; i <= WINDOW_MAX_RETRANSMITS && !aborted && !endAcked; i++)
+	{
+		sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, transfer.pitcherIPAddr, transfer.catcherIPAddr,
+				getChunkIcmpId(transfer.numOfChunks), ICMP_FT_END, NULL, 0, getChunkIcmpSeq(transfer.numOfChunks));
+
+		uint64_t endSendTime = getCurrentTimeUsec();
+		while (!endAcked && getCurrentTimeUsec() - endSendTime < WINDOW_RETRANSMIT_TIMEOUT)
+		{
+			pthread_mutex_lock(&transfer.mutex);
+			endAcked = transfer.endAcked;
+			pthread_mutex_unlock(&transfer.mutex);
+			if (!endAcked)
+				usleep(WINDOW_POLL_INTERVAL);
+		}
+	}
+
+	// stop capturing packets
+	dev->stopCapture();
+	delete [] memblock;
+
+	// if the transfer failed, send several abort messages to the catcher so it'll stop waiting for packets
+	if (aborted)
+	{
+		for (int i = 0; i < NUM_OF_ABORT_MESSAGES_TO_SEND; i++)
+		{
+			sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, transfer.pitcherIPAddr, transfer.catcherIPAddr, 0, ICMP_FT_ABORT, NULL, 0);
+			usleep(SLEEP_BETWEEN_ABORT_MESSAGES);
+		}
+
+		return false;
+	}
+
+	if (!endAcked)
+		printf("\n\nWarning: catcher didn't acknowledge the end of the file transfer");
+
+	printf("\n\nWindowed transfer of %u chunks completed [%u retransmissions]", transfer.numOfChunks, numOfRetransmits);
+	return true;
+}
+
+
 /**
  * Receive a file from the catcher
  */
-void receiveFile(IPv4Address pitcherIP, IPv4Address catcherIP, int packetPerSec)
+void receiveFile(IPv4Address pitcherIP, IPv4Address catcherIP, int packetPerSec, int windowSize)
 {
 	// identify the interface to listen and send packets to
 	PcapLiveDevice* dev = PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(&pitcherIP);
@@ -241,7 +567,10 @@ void receiveFile(IPv4Address pitcherIP, IPv4Address catcherIP, int packetPerSec)
 			pitcherIP,
 			catcherIP,
 			false,
-			""
+			"",
+			windowSize > 0,
+			0,
+			0
 	};
 
 	printf("Waiting for catcher to start sending a file...\n");
@@ -254,7 +583,8 @@ void receiveFile(IPv4Address pitcherIP, IPv4Address catcherIP, int packetPerSec)
 	// since it's the pitcher's job to send ICMP requests and the catcher's job to get them and send ICMP replies,
 	// sending a file from the catcher to the pitcher is a bit more complicated
 	// so for start the pitcher needs the file name. It sends an ICMP request with ICMP_FT_WAITING_FT_START message in the timestamp field
-	// and awaits for catcher response that should include the file name
+	// and awaits for catcher response that should include the file name. In windowed mode the message is ICMP_FT_WINDOWED_WAITING_FT_START
+	// and the response includes the file size and block size as well
 
 	// start capturing ICMP packets. The waitForFileTransferStart callback should look for the catcher reply and set icmpFTStart.gotFileTransferStartMsg
 	// to true
@@ -264,7 +594,8 @@ void receiveFile(IPv4Address pitcherIP, IPv4Address catcherIP, int packetPerSec)
 	// while didn't receive response from the catcher, keep sending the ICMP_FT_WAITING_FT_START message
 	while (!icmpFTStart.gotFileTransferStartMsg)
 	{
-		sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, pitcherIP, catcherIP, icmpId, ICMP_FT_WAITING_FT_START, NULL, 0);
+		sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, pitcherIP, catcherIP, icmpId,
+				icmpFTStart.windowed ? ICMP_FT_WINDOWED_WAITING_FT_START : ICMP_FT_WAITING_FT_START, NULL, 0);
 		icmpId++;
 		// sleep for a few seconds between sending the message
 		PCAP_SLEEP(SEND_TIMEOUT_BEFORE_FT_START);
@@ -281,72 +612,98 @@ void receiveFile(IPv4Address pitcherIP, IPv4Address catcherIP, int packetPerSec)
 	{
 		printf("Getting file from catcher: '%s' ", icmpFTStart.fileName.c_str());
 
-		IcmpFileContentData icmpFileContentData = {
-				pitcherIP,
-				catcherIP,
-				&file,
-				icmpId,
-				0,
-				0,
-				false,
-				false
-		};
-
-		// the next thing to do is start getting the file data. For doing that the pitcher sends the catcher ICMP requests with message type
-		// ICMP_FT_WAITING_DATA in the timestamp field. The catcher should send an ICMP response for each such request with data chunk of the
-		// file
-
-		// calculate how many microseconds (usec) the pitcher needs to sleep between sending the ICMP_FT_WAITING_DATA message
-		// (calculated from user defined packetPerSec parameter).
-		// The calculation is done in usec as in most cases the pitcher needs to sleep less than 1 second between chunks. However if packetPerSec
-		// equals to 1 it means sleeping for 1 second and in this case we can't use usleep (as it's not working for 1 sec or more) and we use
-		// sleep instead
-		uint32_t sleepBetweenPackets = 0;
-		if (packetPerSec > 1)
-			sleepBetweenPackets = (uint32_t)(1000000UL / packetPerSec);
-
-		// start capturing ICMP packets. The getFileContent callback should look for the catcher replies containing data chunks of the file
-		// and write them to the opened file. When catcher signals the end of the file transfer, the callback will set the
-		// icmpFileContentData.fileTransferCompleted flag to true
-		if (!dev->startCapture(getFileContent, &icmpFileContentData))
+		if (icmpFTStart.windowed)
 		{
+			// in windowed mode the pitcher requests up to windowSize chunks at a time by their index, and the catcher replies to each request
+			// with the requested chunk. Chunks are written to their place in a buffer of the whole file, which is written to the file once all
+			// of them arrived
+			IcmpWindowedTransfer transfer(pitcherIP, catcherIP, false, icmpFTStart.fileSize, icmpFTStart.blockSize);
+			transfer.fileBuffer = new uint8_t[icmpFTStart.fileSize > 0 ? icmpFTStart.fileSize : 1];
+			transfer.chunkReceived.resize(transfer.numOfChunks, false);
+
+			if (!runWindowedTransfer(dev, pitcherMacAddr, catcherMacAddr, transfer, NULL, windowSize, packetPerSec))
+			{
+				delete [] transfer.fileBuffer;
+				file.close();
+				EXIT_WITH_ERROR_AND_RUN_COMMAND("File transfer failed. Exiting...", std::remove(icmpFTStart.fileName.c_str()));
+			}
+
+			file.write((char*)transfer.fileBuffer, icmpFTStart.fileSize);
 			file.close();
-			EXIT_WITH_ERROR_AND_RUN_COMMAND("Cannot start capturing packets", std::remove(icmpFTStart.fileName.c_str()));
-		}
+			delete [] transfer.fileBuffer;
 
-		// keep sending ICMP requests with ICMP_FT_WAITING_DATA message in the timestamp field until all file was received or until an error occured
-		while (!icmpFileContentData.fileTransferCompleted && !icmpFileContentData.fileTransferError)
+			// file transfer was completed successfully
+			printf("\n\nFinished getting file '%s' [received %u bytes]\n", icmpFTStart.fileName.c_str(), icmpFTStart.fileSize);
+		}
+		else
 		{
-			sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, pitcherIP, catcherIP, icmpId, ICMP_FT_WAITING_DATA, NULL, 0);
-
-			// if rate limit was set by the user, sleep between sending packets
+			IcmpFileContentData icmpFileContentData = {
+					pitcherIP,
+					catcherIP,
+					&file,
+					icmpId,
+					0,
+					0,
+					false,
+					false
+			};
+
+			// the next thing to do is start getting the file data. For doing that the pitcher sends the catcher ICMP requests with message type
+			// ICMP_FT_WAITING_DATA in the timestamp field. The catcher should send an ICMP response for each such request with data chunk of the
+			// file
+
+			// calculate how many microseconds (usec) the pitcher needs to sleep between sending the ICMP_FT_WAITING_DATA message
+			// (calculated from user defined packetPerSec parameter).
+			// The calculation is done in usec as in most cases the pitcher needs to sleep less than 1 second between chunks. However if packetPerSec
+			// equals to 1 it means sleeping for 1 second and in this case we can't use usleep (as it's not working for 1 sec or more) and we use
+			// sleep instead
+			uint32_t sleepBetweenPackets = 0;
 			if (packetPerSec > 1)
-				usleep(sleepBetweenPackets);
-			else if (packetPerSec == 1)
-				PCAP_SLEEP(1);
+				sleepBetweenPackets = (uint32_t)(1000000UL / packetPerSec);
 
-			icmpId++;
-		}
+			// start capturing ICMP packets. The getFileContent callback should look for the catcher replies containing data chunks of the file
+			// and write them to the opened file. When catcher signals the end of the file transfer, the callback will set the
+			// icmpFileContentData.fileTransferCompleted flag to true
+			if (!dev->startCapture(getFileContent, &icmpFileContentData))
+			{
+				file.close();
+				EXIT_WITH_ERROR_AND_RUN_COMMAND("Cannot start capturing packets", std::remove(icmpFTStart.fileName.c_str()));
+			}
+
+			// keep sending ICMP requests with ICMP_FT_WAITING_DATA message in the timestamp field until all file was received or until an error occured
+			while (!icmpFileContentData.fileTransferCompleted && !icmpFileContentData.fileTransferError)
+			{
+				sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, pitcherIP, catcherIP, icmpId, ICMP_FT_WAITING_DATA, NULL, 0);
 
-		// stop capturing packets
-		dev->stopCapture();
+				// if rate limit was set by the user, sleep between sending packets
+				if (packetPerSec > 1)
+					usleep(sleepBetweenPackets);
+				else if (packetPerSec == 1)
+					PCAP_SLEEP(1);
 
-		// if an error occurred (for example: pitcher missed some of the file content packets), send several abort message to the catcher
-		// so it'll stop waiting for packets, and exit the program
-		if (icmpFileContentData.fileTransferError)
-		{
-			for (int i = 0; i < NUM_OF_ABORT_MESSAGES_TO_SEND; i++)
+				icmpId++;
+			}
+
+			// stop capturing packets
+			dev->stopCapture();
+
+			// if an error occurred (for example: pitcher missed some of the file content packets), send several abort message to the catcher
+			// so it'll stop waiting for packets, and exit the program
+			if (icmpFileContentData.fileTransferError)
 			{
-				sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, pitcherIP, catcherIP, icmpId, ICMP_FT_ABORT, NULL, 0);
-				usleep(SLEEP_BETWEEN_ABORT_MESSAGES);
+				for (int i = 0; i < NUM_OF_ABORT_MESSAGES_TO_SEND; i++)
+				{
+					sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, pitcherIP, catcherIP, icmpId, ICMP_FT_ABORT, NULL, 0);
+					usleep(SLEEP_BETWEEN_ABORT_MESSAGES);
+				}
+
+				file.close();
+				EXIT_WITH_ERROR_AND_RUN_COMMAND("Sent abort message to catcher. Exiting...", std::remove(icmpFTStart.fileName.c_str()));
 			}
 
-			file.close();
-			EXIT_WITH_ERROR_AND_RUN_COMMAND("Sent abort message to catcher. Exiting...", std::remove(icmpFTStart.fileName.c_str()));
+			// file transfer was completed successfully
+			printf("\n\nFinished getting file '%s' [received %d bytes]\n", icmpFTStart.fileName.c_str(), icmpFileContentData.fileSize);
 		}
-
-		// file transfer was completed successfully
-		printf("\n\nFinished getting file '%s' [received %d bytes]\n", icmpFTStart.fileName.c_str(), icmpFileContentData.fileSize);
 	}
 	else
 		EXIT_WITH_ERROR("Cannot create file");
@@ -401,7 +758,7 @@ static bool waitForFileTransferStartAck(RawPacket* rawPacket, PcapLiveDevice* de
 /**
  * Send a file to the catcher
  */
-void sendFile(std::string filePath, IPv4Address pitcherIP, IPv4Address catcherIP, size_t blockSize, int packetPerSec)
+void sendFile(std::string filePath, IPv4Address pitcherIP, IPv4Address catcherIP, size_t blockSize, int packetPerSec, int windowSize)
 {
 	// identify the interface to listen and send packets to
 	PcapLiveDevice* dev = PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(&pitcherIP);
@@ -435,13 +792,21 @@ void sendFile(std::string filePath, IPv4Address pitcherIP, IPv4Address catcherIP
 		// remove the path and keep just the file name. This is the name that will be delivered to the catcher
 		std::string fileName = getFileNameFromPath(filePath);
 
+		// extract file size
+		file.seekg(0, std::ios_base::end);
+		uint32_t fileSize = file.tellg();
+
 		// go back to the beginning of the file
 		file.seekg(0, std::ios::beg);
 
 		uint16_t icmpId = 1;
 
-		// copy the file name to the buffer
-		strcpy((char*)memblock, fileName.c_str());
+		// copy the file name to the buffer. In windowed mode the file size and block size precede it
+		std::vector<uint8_t> startData;
+		if (windowSize > 0)
+			startData = createWindowedStartData(fileSize, blockSize, fileName);
+		else
+			startData.assign((uint8_t*)fileName.c_str(), (uint8_t*)fileName.c_str() + fileName.length() + 1);
 
 		IcmpFileTransferStartSend ftStartData = {
 				icmpId,
@@ -455,14 +820,14 @@ void sendFile(std::string filePath, IPv4Address pitcherIP, IPv4Address catcherIP
 		// keep sending these requests until the catcher answers or until the program is stopped
 		while (1)
 		{
-			// send the catcher an ICMP request that includes an special ICMP_FT_START message in the timestamp field and the filename
-			// in the request data. The catcher should intercept this message and send an ICMP response with an ICMP_FT_ACK message in
-			// the timestamp field
+			// send the catcher an ICMP request that includes an special ICMP_FT_START message (ICMP_FT_WINDOWED_START in windowed mode)
+			// in the timestamp field and the filename in the request data. The catcher should intercept this message and send an ICMP
+			// response with an ICMP_FT_ACK message in the timestamp field
 			if (!sendIcmpRequest(dev,
 					pitcherMacAddr, catcherMacAddr,
 					pitcherIP, catcherIP,
-					icmpId, ICMP_FT_START,
-					memblock, fileName.length() + 1))
+					icmpId, windowSize > 0 ? ICMP_FT_WINDOWED_START : ICMP_FT_START,
+					&startData[0], startData.size()))
 				EXIT_WITH_ERROR("Cannot send file transfer start message");
 
 			// now wait for the catcher to answer. The timeout is SEND_TIMEOUT_BEFORE_FT_START. After that another ICMP request will be sent
@@ -481,64 +846,78 @@ void sendFile(std::string filePath, IPv4Address pitcherIP, IPv4Address catcherIP
 
 		printf("Sending file '%s' ", fileName.c_str());
 
-		icmpId++;
-		uint32_t bytesSentSoFar = 0;
-		uint32_t MBSent = 0;
-
-		uint32_t sleepBetweenPackets = 0;
-		// calculate how many microseconds (usec) the pitcher needs to sleep between sending each file data chunk (calculated from user defined
-		// packetPerSec parameter).
-		// The calculation is done in usec as in most cases the pitcher needs to sleep less than 1 second between chunks. However if packetPerSec
-		// equals to 1 it means sleeping for 1 second and in this case we can't use usleep (as it's not working for 1 sec or more) and we use
-		// sleep instead
-		if (packetPerSec > 1)
-			sleepBetweenPackets = (uint32_t)(1000000UL / packetPerSec);
-
-		// read one chunk of the file and send it to catcher. This loop breaks when it is reaching the end of the file and can't read a block
-		// of size blockSize from the file
-		while (file.read((char*)memblock, blockSize))
+		if (windowSize > 0)
 		{
-			// send an ICMP request to the catcher containing the data chunk.The message type (set in the timestamp field) is ICMP_FT_DATA
-			// so the catcher knows it's a data chunk
-			if (!sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, pitcherIP, catcherIP, icmpId, ICMP_FT_DATA, memblock, blockSize))
-				EXIT_WITH_ERROR("Cannot send file data message");
-
-			// use usleep or sleep (see comment a few lines below)
-			//printf("sent #%d\n", icmpId);
+			// in windowed mode up to windowSize chunks are in flight. Each chunk carries its index and the catcher acks every chunk on
+			// its own, so only lost chunks are retransmitted and the catcher writes them to their place in the file whatever order they
+			// arrive in
+			IcmpWindowedTransfer transfer(pitcherIP, catcherIP, true, fileSize, blockSize);
+			if (!runWindowedTransfer(dev, pitcherMacAddr, catcherMacAddr, transfer, &file, windowSize, packetPerSec))
+				EXIT_WITH_ERROR("File transfer failed. Exiting...");
+
+			printf("\n\nFinished sending '%s' [sent %u bytes]\n", fileName.c_str(), fileSize);
+		}
+		else
+		{
+			icmpId++;
+			uint32_t bytesSentSoFar = 0;
+			uint32_t MBSent = 0;
+
+			uint32_t sleepBetweenPackets = 0;
+			// calculate how many microseconds (usec) the pitcher needs to sleep between sending each file data chunk (calculated from user defined
+			// packetPerSec parameter).
+			// The calculation is done in usec as in most cases the pitcher needs to sleep less than 1 second between chunks. However if packetPerSec
+			// equals to 1 it means sleeping for 1 second and in this case we can't use usleep (as it's not working for 1 sec or more) and we use
+			// sleep instead
 			if (packetPerSec > 1)
-				usleep(sleepBetweenPackets);
-			else if (packetPerSec == 1)
-				PCAP_SLEEP(1);
+				sleepBetweenPackets = (uint32_t)(1000000UL / packetPerSec);
 
-			bytesSentSoFar += blockSize;
+			// read one chunk of the file and send it to catcher. This loop breaks when it is reaching the end of the file and can't read a block
+			// of size blockSize from the file
+			while (file.read((char*)memblock, blockSize))
+			{
+				// send an ICMP request to the catcher containing the data chunk.The message type (set in the timestamp field) is ICMP_FT_DATA
+				// so the catcher knows it's a data chunk
+				if (!sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, pitcherIP, catcherIP, icmpId, ICMP_FT_DATA, memblock, blockSize))
+					EXIT_WITH_ERROR("Cannot send file data message");
+
+				// use usleep or sleep (see comment a few lines below)
+				//printf("sent #%d\n", icmpId);
+				if (packetPerSec > 1)
+					usleep(sleepBetweenPackets);
+				else if (packetPerSec == 1)
+					PCAP_SLEEP(1);
+
+				bytesSentSoFar += blockSize;
+
+				// print a dot ('.') on every 1MB sent
+				MBSent += blockSize;
+				if (MBSent > ONE_MBYTE)
+				{
+					MBSent -= ONE_MBYTE;
+					printf(".");
+				}
+
+				icmpId++;
+			}
 
-			// print a dot ('.') on every 1MB sent
-			MBSent += blockSize;
-			if (MBSent > ONE_MBYTE)
+			// after the loop above breaks there may be one more block to read (of size less than blockSize). Read it and send it to the catcher
+			if (file.gcount() > 0)
 			{
-				MBSent -= ONE_MBYTE;
+				if (!sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, pitcherIP, catcherIP, icmpId, ICMP_FT_DATA, memblock, file.gcount()))
+					EXIT_WITH_ERROR("Cannot send file data message");
+
+				bytesSentSoFar += file.gcount();
 				printf(".");
 			}
 
-			icmpId++;
-		}
-
-		// after the loop above breaks there may be one more block to read (of size less than blockSize). Read it and send it to the catcher
-		if (file.gcount() > 0)
-		{
-			if (!sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, pitcherIP, catcherIP, icmpId, ICMP_FT_DATA, memblock, file.gcount()))
-				EXIT_WITH_ERROR("Cannot send file data message");
+			// done sending the file to the catcher, send an ICMP request with message type ICMP_FT_END (in the timestamp field) to the catcher
+			// to indicate all file was sent
+			if (!sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, pitcherIP, catcherIP, icmpId, ICMP_FT_END, NULL, 0))
+				EXIT_WITH_ERROR("Cannot send file transfer end message");
 
-			bytesSentSoFar += file.gcount();
-			printf(".");
+			printf("\n\nFinished sending '%s' [sent %d bytes]\n", fileName.c_str(), bytesSentSoFar);
 		}
-
-		// done sending the file to the catcher, send an ICMP request with message type ICMP_FT_END (in the timestamp field) to the catcher
-		// to indicate all file was sent
-		if (!sendIcmpRequest(dev, pitcherMacAddr, catcherMacAddr, pitcherIP, catcherIP, icmpId, ICMP_FT_END, NULL, 0))
-			EXIT_WITH_ERROR("Cannot send file transfer end message");
-
-		printf("\n\nFinished sending '%s' [sent %d bytes]\n", fileName.c_str(), bytesSentSoFar);
 	}
 	else
 		EXIT_WITH_ERROR("Cannot open file '%s'", filePath.c_str());
@@ -562,17 +941,18 @@ int main(int argc, char* argv[])
 	std::string fileNameToSend = "";
 	int packetsPerSec = 0;
 	size_t blockSize = 0;
+	int windowSize = 0;
 
 	// disable stdout buffering so all printf command will be printed immediately
 	setbuf(stdout, NULL);
 
 	// read and parse command line arguments. This method also takes care of arguments correctness. If they're not correct, it'll exit the program
-	readCommandLineArguments(argc, argv, "pitcher", "catcher", sender, receiver, pitcherIP, catcherIP, fileNameToSend, packetsPerSec, blockSize);
+	readCommandLineArguments(argc, argv, "pitcher", "catcher", sender, receiver, pitcherIP, catcherIP, fileNameToSend, packetsPerSec, blockSize, windowSize);
 
 	// send a file to the catcher
 	if (sender)
-		sendFile(fileNameToSend, pitcherIP, catcherIP, blockSize, packetsPerSec);
+		sendFile(fileNameToSend, pitcherIP, catcherIP, blockSize, packetsPerSec, windowSize);
 	// receive a file from the catcher
 	else if (receiver)
-		receiveFile(pitcherIP, catcherIP, packetsPerSec);
+		receiveFile(pitcherIP, catcherIP, packetsPerSec, windowSize);
 }
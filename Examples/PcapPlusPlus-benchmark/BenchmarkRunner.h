@@ -0,0 +1,281 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <PcapPlusPlusVersion.h>
+#include <HardwareCounters.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCHMARK_HAS_CYCLE_COUNTER
+#endif
+
+/**
+ * The number of heap allocations done by the calling thread so far. It's counted by the global operator new defined in benchmark.cpp.
+ * It's per thread so the workers of the scaling benchmarks don't all write to the same cache line on every allocation
+ */
+extern thread_local uint64_t numOfAllocations;
+
+
+/**
+ * Read the CPU cycle counter (TSC), or return 0 on platforms where it's not available
+ */
+inline uint64_t readCycleCounter()
+{
+#ifdef BENCHMARK_HAS_CYCLE_COUNTER
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+
+/**
+ * The result of a single benchmark
+ */
+struct BenchmarkResult
+{
+	std::string group;
+	std::string name;
+	// the number of packets processed in each repetition
+	uint64_t numOfPackets;
+	double nsPerPacket;
+	double mpps;
+	double allocationsPerPacket;
+	// negative if the cycle counter isn't available
+	double cyclesPerPacket;
+	// the hardware counters summed over all repetitions, none is available if hardware counters weren't requested
+	pcpp::HardwareCounterValues hwCounters;
+};
+
+
+/**
+ * The result of a scaling benchmark for a single number of cores
+ */
+struct ScalingResult
+{
+	// the worker body: parse, hash or reassembly
+	std::string body;
+	int numOfCores;
+	// the aggregate throughput of all cores
+	double mpps;
+	// the throughput of the slowest and the fastest cores
+	double minCoreMpps;
+	double maxCoreMpps;
+	// the packets which arrived when the worker's queue was full, always 0 if the offered load is unlimited
+	uint64_t dropped;
+	double dropPercent;
+	// mpps divided by numOfCores times the single core mpps, 1 means linear scaling
+	double efficiency;
+};
+
+
+/**
+ * Runs benchmarks and collects their results. Each benchmark runs once to warm up the caches and then the requested number of
+ * repetitions. The reported time and cycle counts are the median of the repetitions, which is less sensitive to noise than the mean.
+ * If hardware counters are enabled, cycles, instructions, cache misses and branch misses are counted around every repetition and
+ * reported as the mean per packet
+ */
+class BenchmarkRunner
+{
+private:
+	int m_Repetitions;
+	std::vector<BenchmarkResult> m_Results;
+	std::vector<ScalingResult> m_ScalingResults;
+	pcpp::HardwareCounters m_HwCounters;
+
+	static double median(std::vector<double>& values)
+	{
+		std::sort(values.begin(), values.end());
+		size_t mid = values.size() / 2;
+		if (values.size() % 2 == 1)
+			return values[mid];
+		return (values[mid - 1] + values[mid]) / 2;
+	}
+
+	// write the per packet hardware counters of a result as a JSON object, or null if none is available
+	void writeHwCountersJson(FILE* file, const BenchmarkResult& result) const
+	{
+		if (!result.hwCounters.isAnyAvailable())
+		{
+			fprintf(file, "\"hw_counters_per_packet\": null");
+			return;
+		}
+
+		uint64_t numOfUnits = result.numOfPackets * m_Repetitions;
+		fprintf(file, "\"hw_counters_per_packet\": {");
+		bool first = true;
+		for (int i = 0; i < pcpp::NumOfHwCounterTypes; i++)
+		{
+			double perPacket = result.hwCounters.getPerUnit((pcpp::HardwareCounterType)i, numOfUnits);
+			if (perPacket < 0)
+				continue;
+			fprintf(file, "%s \"%s\": %.3f", (first ? "" : ","), pcpp::HardwareCounterValues::getName((pcpp::HardwareCounterType)i), perPacket);
+			first = false;
+		}
+		if (result.hwCounters.getInstructionsPerCycle() >= 0)
+			fprintf(file, ", \"ipc\": %.3f", result.hwCounters.getInstructionsPerCycle());
+		fprintf(file, " }");
+	}
+
+	static std::string escapeJson(const std::string& str)
+	{
+		std::string result;
+		for (std::string::const_iterator iter = str.begin(); iter != str.end(); iter++)
+		{
+			if (*iter == '"' || *iter == '\\')
+				result += '\\';
+			result += *iter;
+		}
+		return result;
+	}
+
+public:
+
+	BenchmarkRunner(int repetitions) : m_Repetitions(repetitions > 0 ? repetitions : 1) {}
+
+	/**
+	 * Count hardware events (see pcpp::HardwareCounters) in the benchmarks run from now on. The counters belong to the calling thread,
+	 * which must be the thread that runs the benchmarks
+	 * @return True if at least one hardware counter could be opened, false otherwise
+	 */
+	bool enableHardwareCounters() { return m_HwCounters.open(); }
+
+	/**
+	 * Run a benchmark
+	 * @param[in] group The benchmark group (parse, craft, reassembly or file)
+	 * @param[in] name The benchmark name
+	 * @param[in] numOfPackets The number of packets processed by each invocation of func
+	 * @param[in] func The benchmark code. It's invoked once to warm up and then once for each repetition
+	 */
+	void run(const std::string& group, const std::string& name, uint64_t numOfPackets, const std::function<void()>& func)
+	{
+		if (numOfPackets == 0)
+			return;
+
+		func();
+
+		std::vector<double> durations;
+		std::vector<double> cycles;
+		uint64_t allocations = 0;
+		pcpp::HardwareCounterValues hwCounters;
+		bool hwCountersEnabled = m_HwCounters.isOpen();
+
+		for (int i = 0; i < m_Repetitions; i++)
+		{
+			if (hwCountersEnabled)
+				m_HwCounters.start();
+
+			uint64_t allocationsBefore = numOfAllocations;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			uint64_t cyclesBefore = readCycleCounter();
+
+			func();
+
+			uint64_t cyclesAfter = readCycleCounter();
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			allocations += numOfAllocations - allocationsBefore;
+
+			if (hwCountersEnabled)
+			{
+				m_HwCounters.stop();
+				pcpp::HardwareCounterValues repetitionHwCounters;
+				m_HwCounters.read(repetitionHwCounters);
+				hwCounters += repetitionHwCounters;
+			}
+
+			durations.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+			cycles.push_back((double)(cyclesAfter - cyclesBefore));
+		}
+
+		BenchmarkResult result;
+		result.group = group;
+		result.name = name;
+		result.numOfPackets = numOfPackets;
+		result.nsPerPacket = median(durations) / numOfPackets;
+		result.mpps = (result.nsPerPacket > 0 ? 1000.0 / result.nsPerPacket : 0);
+		result.allocationsPerPacket = (double)allocations / m_Repetitions / numOfPackets;
+#ifdef BENCHMARK_HAS_CYCLE_COUNTER
+		result.cyclesPerPacket = median(cycles) / numOfPackets;
+#else
+		result.cyclesPerPacket = -1;
+#endif
+		result.hwCounters = hwCounters;
+		m_Results.push_back(result);
+
+		printf("%-12s %-40s %10.1f ns/pkt %9.3f Mpps %8.2f allocs/pkt", group.c_str(), name.c_str(), result.nsPerPacket, result.mpps, result.allocationsPerPacket);
+		if (result.cyclesPerPacket >= 0)
+			printf(" %10.1f cycles/pkt", result.cyclesPerPacket);
+		if (result.hwCounters.isAnyAvailable())
+			printf(" | per pkt: %s", pcpp::HardwareCounters::toString(result.hwCounters, numOfPackets * m_Repetitions).c_str());
+		printf("\n");
+		fflush(stdout);
+	}
+
+	/**
+	 * @return The number of repetitions of each benchmark
+	 */
+	int getRepetitions() const { return m_Repetitions; }
+
+	/**
+	 * Add the result of a scaling benchmark, which runs its own worker threads rather than a function given to run()
+	 * @param[in] result The result to add
+	 */
+	void addScalingResult(const ScalingResult& result) { m_ScalingResults.push_back(result); }
+
+	/**
+	 * @return The results of all benchmarks run so far
+	 */
+	const std::vector<BenchmarkResult>& getResults() const { return m_Results; }
+
+	/**
+	 * Write the results as a JSON document, for tracking regressions between runs
+	 * @param[in] fileName The output file name
+	 * @param[in] inputFileName The name of the file the packets were read from, or an empty string if the built-in packets were used
+	 * @return True if the file was written, false otherwise
+	 */
+	bool writeJson(const std::string& fileName, const std::string& inputFileName) const
+	{
+		FILE* file = fopen(fileName.c_str(), "w");
+		if (file == NULL)
+			return false;
+
+		fprintf(file, "{\n");
+		fprintf(file, "  \"version\": \"%s\",\n", escapeJson(pcpp::getPcapPlusPlusVersionFull()).c_str());
+		fprintf(file, "  \"input\": \"%s\",\n", escapeJson(inputFileName).c_str());
+		fprintf(file, "  \"repetitions\": %d,\n", m_Repetitions);
+		fprintf(file, "  \"results\": [\n");
+		for (size_t i = 0; i < m_Results.size(); i++)
+		{
+			const BenchmarkResult& result = m_Results[i];
+			fprintf(file, "    { \"group\": \"%s\", \"name\": \"%s\", \"packets\": %llu, \"ns_per_packet\": %.3f, \"mpps\": %.4f, \"allocations_per_packet\": %.3f, ",
+					escapeJson(result.group).c_str(), escapeJson(result.name).c_str(), (unsigned long long)result.numOfPackets,
+					result.nsPerPacket, result.mpps, result.allocationsPerPacket);
+			if (result.cyclesPerPacket >= 0)
+				fprintf(file, "\"cycles_per_packet\": %.1f, ", result.cyclesPerPacket);
+			else
+				fprintf(file, "\"cycles_per_packet\": null, ");
+			writeHwCountersJson(file, result);
+			fprintf(file, " }");
+			fprintf(file, "%s\n", (i + 1 < m_Results.size() ? "," : ""));
+		}
+		fprintf(file, "  ],\n");
+		fprintf(file, "  \"scaling\": [\n");
+		for (size_t i = 0; i < m_ScalingResults.size(); i++)
+		{
+			const ScalingResult& result = m_ScalingResults[i];
+			fprintf(file, "    { \"body\": \"%s\", \"cores\": %d, \"mpps\": %.4f, \"min_core_mpps\": %.4f, \"max_core_mpps\": %.4f, \"dropped\": %llu, \"drop_percent\": %.3f, \"efficiency\": %.4f }",
+					escapeJson(result.body).c_str(), result.numOfCores, result.mpps, result.minCoreMpps, result.maxCoreMpps,
+					(unsigned long long)result.dropped, result.dropPercent, result.efficiency);
+			fprintf(file, "%s\n", (i + 1 < m_ScalingResults.size() ? "," : ""));
+		}
+		fprintf(file, "  ]\n");
+		fprintf(file, "}\n");
+
+		return fclose(file) == 0;
+	}
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "BenchmarkRunner.h"
+#include <Packet.h>
+#include <EthLayer.h>
+#include <IPv4Layer.h>
+#include <IPv6Layer.h>
+#include <TcpLayer.h>
+#include <UdpLayer.h>
+#include <HttpLayer.h>
+#include <DnsLayer.h>
+#include <SipLayer.h>
+#include <GtpLayer.h>
+#include <PayloadLayer.h>
+#include <string.h>
+#if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV) //for using ntohl, ntohs, etc.
+#include <in.h>
+#endif
+#include <string>
+#include <vector>
+
+/**
+ * A function which crafts a packet into an empty Packet instance. It adds the layers and calculates the calculated fields
+ */
+typedef void (*PacketCraftFunction)(pcpp::Packet& packet);
+
+static const uint8_t samplePayload[100] = { 0 };
+
+static void addEthAndIPv4Layers(pcpp::Packet& packet)
+{
+	packet.addLayer(new pcpp::EthLayer(pcpp::MacAddress("00:50:43:11:22:33"), pcpp::MacAddress("aa:bb:cc:dd:ee:ff"), PCPP_ETHERTYPE_IP), true);
+	pcpp::IPv4Layer* ipLayer = new pcpp::IPv4Layer(pcpp::IPv4Address(std::string("10.0.0.1")), pcpp::IPv4Address(std::string("10.0.0.2")));
+	ipLayer->getIPv4Header()->timeToLive = 64;
+	packet.addLayer(ipLayer, true);
+}
+
+/**
+ * Eth/IPv4/TCP with a 100-byte payload
+ */
+static void craftIPv4TcpPacket(pcpp::Packet& packet)
+{
+	addEthAndIPv4Layers(packet);
+	packet.addLayer(new pcpp::TcpLayer(12345, 8080), true);
+	packet.addLayer(new pcpp::PayloadLayer(samplePayload, sizeof(samplePayload), false), true);
+	packet.computeCalculateFields();
+}
+
+/**
+ * Eth/IPv6/UDP with a 100-byte payload
+ */
+static void craftIPv6UdpPacket(pcpp::Packet& packet)
+{
+	packet.addLayer(new pcpp::EthLayer(pcpp::MacAddress("00:50:43:11:22:33"), pcpp::MacAddress("aa:bb:cc:dd:ee:ff"), PCPP_ETHERTYPE_IPV6), true);
+	pcpp::IPv6Layer* ipLayer = new pcpp::IPv6Layer(pcpp::IPv6Address(std::string("2001:db8::1")), pcpp::IPv6Address(std::string("2001:db8::2")));
+	ipLayer->getIPv6Header()->hopLimit = 64;
+	packet.addLayer(ipLayer, true);
+	packet.addLayer(new pcpp::UdpLayer(12345, 8080), true);
+	packet.addLayer(new pcpp::PayloadLayer(samplePayload, sizeof(samplePayload), false), true);
+	packet.computeCalculateFields();
+}
+
+/**
+ * Eth/IPv4/TCP/HTTP GET request
+ */
+static void craftHttpRequestPacket(pcpp::Packet& packet)
+{
+	addEthAndIPv4Layers(packet);
+	packet.addLayer(new pcpp::TcpLayer(12345, 80), true);
+	pcpp::HttpRequestLayer* httpLayer = new pcpp::HttpRequestLayer(pcpp::HttpRequestLayer::HttpGET, "/index.html", pcpp::OneDotOne);
+	httpLayer->addField(PCPP_HTTP_HOST_FIELD, "www.example.com");
+	httpLayer->addField(PCPP_HTTP_USER_AGENT_FIELD, "PcapPlusPlus-benchmark");
+	httpLayer->addField("Accept", "*/*");
+	httpLayer->addEndOfHeader();
+	packet.addLayer(httpLayer, true);
+	packet.computeCalculateFields();
+}
+
+/**
+ * Eth/IPv4/UDP/DNS query
+ */
+static void craftDnsQueryPacket(pcpp::Packet& packet)
+{
+	addEthAndIPv4Layers(packet);
+	packet.addLayer(new pcpp::UdpLayer(12345, 53), true);
+	pcpp::DnsLayer* dnsLayer = new pcpp::DnsLayer();
+	dnsLayer->getDnsHeader()->transactionID = htons(0x1234);
+	dnsLayer->getDnsHeader()->recursionDesired = 1;
+	dnsLayer->addQuery("www.example.com", pcpp::DNS_TYPE_A, pcpp::DNS_CLASS_IN);
+	packet.addLayer(dnsLayer, true);
+	packet.computeCalculateFields();
+}
+
+/**
+ * Eth/IPv4/UDP/SIP INVITE request
+ */
+static void craftSipInvitePacket(pcpp::Packet& packet)
+{
+	addEthAndIPv4Layers(packet);
+	packet.addLayer(new pcpp::UdpLayer(5060, 5060), true);
+	pcpp::SipRequestLayer* sipLayer = new pcpp::SipRequestLayer(pcpp::SipRequestLayer::SipINVITE, "sip:bob@example.com");
+	sipLayer->addField(PCPP_SIP_VIA_FIELD, "SIP/2.0/UDP 10.0.0.1:5060;branch=z9hG4bK776asdhds");
+	sipLayer->addField(PCPP_SIP_MAX_FORWARDS_FIELD, "70");
+	sipLayer->addField(PCPP_SIP_TO_FIELD, "Bob <sip:bob@example.com>");
+	sipLayer->addField(PCPP_SIP_FROM_FIELD, "Alice <sip:alice@example.com>;tag=1928301774");
+	sipLayer->addField(PCPP_SIP_CALL_ID_FIELD, "a84b4c76e66710@10.0.0.1");
+	sipLayer->addField(PCPP_SIP_CSEQ_FIELD, "314159 INVITE");
+	sipLayer->addField(PCPP_SIP_CONTENT_LENGTH_FIELD, "0");
+	sipLayer->addEndOfHeader();
+	packet.addLayer(sipLayer, true);
+	packet.computeCalculateFields();
+}
+
+/**
+ * Eth/IPv4/UDP/GTP-U carrying an IPv4/UDP packet with a 100-byte payload
+ */
+static void craftGtpPacket(pcpp::Packet& packet)
+{
+	addEthAndIPv4Layers(packet);
+	packet.addLayer(new pcpp::UdpLayer(2152, 2152), true);
+	packet.addLayer(new pcpp::GtpV1Layer(pcpp::GtpV1_GPDU, 0x1000), true);
+	packet.addLayer(new pcpp::IPv4Layer(pcpp::IPv4Address(std::string("192.168.1.1")), pcpp::IPv4Address(std::string("192.168.1.2"))), true);
+	packet.addLayer(new pcpp::UdpLayer(12345, 8080), true);
+	packet.addLayer(new pcpp::PayloadLayer(samplePayload, sizeof(samplePayload), false), true);
+	packet.computeCalculateFields();
+}
+
+/**
+ * Eth/IPv4/TCP/SSL with a TLS 1.2 client hello which has a single cipher suite and an SNI extension
+ */
+static void craftSslClientHelloPacket(pcpp::Packet& packet)
+{
+	const char serverName[] = "www.example.com";
+	const size_t serverNameLen = sizeof(serverName) - 1;
+
+	std::vector<uint8_t> hello;
+	// version, random and an empty session ID
+	hello.push_back(0x03); hello.push_back(0x03);
+	hello.insert(hello.end(), 32, 0x5a);
+	hello.push_back(0);
+	// a single cipher suite (TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256) and the null compression method
+	hello.push_back(0x00); hello.push_back(0x02); hello.push_back(0xc0); hello.push_back(0x2f);
+	hello.push_back(0x01); hello.push_back(0x00);
+	// the extensions: only the server name
+	size_t sniLen = serverNameLen + 5;
+	size_t extensionsLen = sniLen + 4;
+	hello.push_back((uint8_t)(extensionsLen >> 8)); hello.push_back((uint8_t)extensionsLen);
+	hello.push_back(0x00); hello.push_back(0x00);
+	hello.push_back((uint8_t)(sniLen >> 8)); hello.push_back((uint8_t)sniLen);
+	hello.push_back((uint8_t)((serverNameLen + 3) >> 8)); hello.push_back((uint8_t)(serverNameLen + 3));
+	hello.push_back(0x00);
+	hello.push_back((uint8_t)(serverNameLen >> 8)); hello.push_back((uint8_t)serverNameLen);
+	hello.insert(hello.end(), serverName, serverName + serverNameLen);
+
+	std::vector<uint8_t> record;
+	size_t recordLen = hello.size() + 4;
+	record.push_back(0x16); record.push_back(0x03); record.push_back(0x01);
+	record.push_back((uint8_t)(recordLen >> 8)); record.push_back((uint8_t)recordLen);
+	record.push_back(0x01);
+	record.push_back((uint8_t)(hello.size() >> 16)); record.push_back((uint8_t)(hello.size() >> 8)); record.push_back((uint8_t)hello.size());
+	record.insert(record.end(), hello.begin(), hello.end());
+
+	addEthAndIPv4Layers(packet);
+	packet.addLayer(new pcpp::TcpLayer(12345, 443), true);
+	packet.addLayer(new pcpp::PayloadLayer(&record[0], record.size(), false), true);
+	packet.computeCalculateFields();
+}
+
+
+struct PacketCraftBenchmark
+{
+	const char* name;
+	PacketCraftFunction craft;
+};
+
+static const PacketCraftBenchmark packetCraftBenchmarks[] =
+{
+	{ "ipv4-tcp", craftIPv4TcpPacket },
+	{ "ipv6-udp", craftIPv6UdpPacket },
+	{ "http-request", craftHttpRequestPacket },
+	{ "dns-query", craftDnsQueryPacket },
+	{ "sip-invite", craftSipInvitePacket },
+	{ "gtp-u", craftGtpPacket },
+	{ "ssl-client-hello", craftSslClientHelloPacket }
+};
+
+static const size_t numOfPacketCraftBenchmarks = sizeof(packetCraftBenchmarks) / sizeof(packetCraftBenchmarks[0]);
+
+
+/**
+ * Create the built-in packets used when no input file is given: the crafted packet types one after the other, repeated until
+ * numOfPackets packets are created. The caller owns the returned raw packets
+ */
+static void createSamplePackets(size_t numOfPackets, std::vector<pcpp::RawPacket*>& packets)
+{
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		pcpp::Packet packet(1500);
+		packetCraftBenchmarks[i % numOfPacketCraftBenchmarks].craft(packet);
+		packets.push_back(new pcpp::RawPacket(*packet.getRawPacket()));
+	}
+}
+
+
+/**
+ * Run the packet building benchmarks: crafting each of the packet types from scratch, and calculating the calculated fields of
+ * already parsed packets
+ */
+static void runCraftBenchmarks(BenchmarkRunner& runner, const std::vector<pcpp::RawPacket*>& packets)
+{
+	size_t numOfPackets = packets.size();
+
+	for (size_t i = 0; i < numOfPacketCraftBenchmarks; i++)
+	{
+		PacketCraftFunction craft = packetCraftBenchmarks[i].craft;
+		runner.run("craft", packetCraftBenchmarks[i].name, numOfPackets, [craft, numOfPackets]()
+		{
+			for (size_t j = 0; j < numOfPackets; j++)
+			{
+				pcpp::Packet packet(1500);
+				craft(packet);
+			}
+		});
+	}
+
+	std::vector<pcpp::Packet*> parsedPackets;
+	for (size_t i = 0; i < numOfPackets; i++)
+		parsedPackets.push_back(new pcpp::Packet(packets[i]));
+
+	runner.run("craft", "compute-calculate-fields", numOfPackets, [&parsedPackets]()
+	{
+		for (size_t j = 0; j < parsedPackets.size(); j++)
+			parsedPackets[j]->computeCalculateFields();
+	});
+
+	for (size_t i = 0; i < parsedPackets.size(); i++)
+		delete parsedPackets[i];
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "BenchmarkRunner.h"
+#include <RawPacket.h>
+#include <PcapFileDevice.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+
+/**
+ * Run the file benchmarks: writing the packets to pcap and pcap-ng files, and reading them back with the pcap, pcap-ng and
+ * memory mapped readers. The files are written to tempFilePrefix + ".pcap" and tempFilePrefix + ".pcapng" and deleted at the end
+ */
+static void runFileBenchmarks(BenchmarkRunner& runner, const std::vector<pcpp::RawPacket*>& packets, const std::string& tempFilePrefix)
+{
+	std::string pcapFileName = tempFilePrefix + ".pcap";
+	std::string pcapNgFileName = tempFilePrefix + ".pcapng";
+
+	runner.run("file", "pcap-write", packets.size(), [&packets, &pcapFileName]()
+	{
+		pcpp::PcapFileWriterDevice writer(pcapFileName.c_str());
+		if (!writer.open())
+			return;
+		for (size_t i = 0; i < packets.size(); i++)
+			writer.writePacket(*packets[i]);
+		writer.close();
+	});
+
+	runner.run("file", "pcapng-write", packets.size(), [&packets, &pcapNgFileName]()
+	{
+		pcpp::PcapNgFileWriterDevice writer(pcapNgFileName.c_str());
+		if (!writer.open())
+			return;
+		for (size_t i = 0; i < packets.size(); i++)
+			writer.writePacket(*packets[i]);
+		writer.close();
+	});
+
+	runner.run("file", "pcap-read", packets.size(), [&pcapFileName]()
+	{
+		pcpp::PcapFileReaderDevice reader(pcapFileName.c_str());
+		if (!reader.open())
+			return;
+		pcpp::RawPacket rawPacket;
+		while (reader.getNextPacket(rawPacket)) {}
+		reader.close();
+	});
+
+	runner.run("file", "pcapng-read", packets.size(), [&pcapNgFileName]()
+	{
+		pcpp::PcapNgFileReaderDevice reader(pcapNgFileName.c_str());
+		if (!reader.open())
+			return;
+		pcpp::RawPacket rawPacket;
+		while (reader.getNextPacket(rawPacket)) {}
+		reader.close();
+	});
+
+	runner.run("file", "mmap-pcap-read", packets.size(), [&pcapFileName]()
+	{
+		pcpp::MmapPcapFileReaderDevice reader(pcapFileName.c_str());
+		if (!reader.open())
+			return;
+		pcpp::RawPacket rawPacket;
+		while (reader.getNextPacket(rawPacket)) {}
+		reader.close();
+	});
+
+	remove(pcapFileName.c_str());
+	remove(pcapNgFileName.c_str());
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "BenchmarkRunner.h"
+#include <Packet.h>
+#include <LayerArena.h>
+#include <PacketView.h>
+#include <vector>
+
+struct ProtocolParseBenchmark
+{
+	const char* name;
+	pcpp::ProtocolType protocol;
+};
+
+static const ProtocolParseBenchmark protocolParseBenchmarks[] =
+{
+	{ "eth", pcpp::Ethernet },
+	{ "ipv4", pcpp::IPv4 },
+	{ "ipv6", pcpp::IPv6 },
+	{ "tcp", pcpp::TCP },
+	{ "udp", pcpp::UDP },
+	{ "http", pcpp::HTTP },
+	{ "ssl", pcpp::SSL },
+	{ "dns", pcpp::DNS },
+	{ "sip", pcpp::SIP },
+	{ "gtp", pcpp::GTP }
+};
+
+// written by the benchmarks so the compiler can't drop the parsing
+static volatile size_t parseBenchmarkSink = 0;
+
+
+/**
+ * Run the parsing benchmarks:
+ * - For each protocol, parsing the packets which contain it up to (and including) its layer. Protocols no packet contains are skipped
+ * - Parsing all layers of all packets, with a new Packet instance for each packet
+ * - Parsing all layers of all packets into a single Packet instance with a LayerArena, so no memory is allocated for the layers
+ * - Extracting the packet headers into a PacketView, without creating layers
+ */
+static void runParseBenchmarks(BenchmarkRunner& runner, const std::vector<pcpp::RawPacket*>& packets)
+{
+	const size_t numOfProtocols = sizeof(protocolParseBenchmarks) / sizeof(protocolParseBenchmarks[0]);
+
+	for (size_t i = 0; i < numOfProtocols; i++)
+	{
+		pcpp::ProtocolType protocol = protocolParseBenchmarks[i].protocol;
+
+		std::vector<pcpp::RawPacket*> protocolPackets;
+		for (size_t j = 0; j < packets.size(); j++)
+		{
+			pcpp::Packet packet(packets[j], protocol);
+			if (packet.isPacketOfType(protocol))
+				protocolPackets.push_back(packets[j]);
+		}
+
+		runner.run("parse", protocolParseBenchmarks[i].name, protocolPackets.size(), [&protocolPackets, protocol]()
+		{
+			for (size_t j = 0; j < protocolPackets.size(); j++)
+			{
+				pcpp::Packet packet(protocolPackets[j], protocol);
+				parseBenchmarkSink += (packet.getLastLayer() != NULL);
+			}
+		});
+	}
+
+	runner.run("parse", "all-layers", packets.size(), [&packets]()
+	{
+		for (size_t j = 0; j < packets.size(); j++)
+		{
+			pcpp::Packet packet(packets[j]);
+			parseBenchmarkSink += (packet.getLastLayer() != NULL);
+		}
+	});
+
+	runner.run("parse", "all-layers-arena", packets.size(), [&packets]()
+	{
+		pcpp::LayerArena arena;
+		pcpp::Packet packet(packets[0]);
+		packet.setLayerArena(&arena);
+		for (size_t j = 0; j < packets.size(); j++)
+		{
+			packet.setRawPacket(packets[j], false);
+			parseBenchmarkSink += (packet.getLastLayer() != NULL);
+		}
+	});
+
+	runner.run("parse", "packet-view", packets.size(), [&packets]()
+	{
+		pcpp::PacketView view;
+		for (size_t j = 0; j < packets.size(); j++)
+		{
+			pcpp::FlowKeyExtractor::extract(packets[j], view);
+			parseBenchmarkSink += view.protocolTypes;
+		}
+	});
+}
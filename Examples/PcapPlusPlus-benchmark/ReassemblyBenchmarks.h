@@ -0,0 +1,243 @@
+#pragma once
+
+#include "BenchmarkRunner.h"
+#include <Packet.h>
+#include <EthLayer.h>
+#include <IPv4Layer.h>
+#include <TcpLayer.h>
+#include <PayloadLayer.h>
+#include <TcpReassembly.h>
+#include <IPReassembly.h>
+#include <string.h>
+#if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV) //for using ntohl, ntohs, etc.
+#include <in.h>
+#endif
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * The traffic conditions the reassembly benchmarks run under
+ */
+struct ReassemblyBenchmarkConfig
+{
+	// the percentage of packets which are swapped with a packet up to reorderWindow packets later
+	double reorderPercent;
+	// the percentage of data packets (TCP segments or IP fragments) which are dropped
+	double lossPercent;
+	size_t reorderWindow;
+
+	ReassemblyBenchmarkConfig() : reorderPercent(0), lossPercent(0), reorderWindow(8) {}
+};
+
+
+/**
+ * Reorder and drop packets according to the benchmark config. The random generator is seeded with a constant so the same
+ * packets are produced in every run
+ */
+static void applyReorderAndLoss(const ReassemblyBenchmarkConfig& config, std::vector<pcpp::RawPacket*>& packets, const std::vector<bool>& canDrop)
+{
+	std::mt19937 random(12345);
+	std::uniform_real_distribution<double> percent(0, 100);
+
+	std::vector<pcpp::RawPacket*> keptPackets;
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		if (canDrop[i] && percent(random) < config.lossPercent)
+			delete packets[i];
+		else
+			keptPackets.push_back(packets[i]);
+	}
+
+	for (size_t i = 0; i + 1 < keptPackets.size(); i++)
+	{
+		if (percent(random) >= config.reorderPercent)
+			continue;
+
+		size_t maxDistance = std::min(config.reorderWindow, keptPackets.size() - i - 1);
+		size_t other = i + 1 + random() % maxDistance;
+		std::swap(keptPackets[i], keptPackets[other]);
+	}
+
+	packets.swap(keptPackets);
+}
+
+
+static pcpp::RawPacket* createTcpSegment(int connection, bool fromClient, uint32_t seq, uint32_t ack, bool syn, bool fin,
+		const uint8_t* payload, size_t payloadLen, size_t packetIndex)
+{
+	pcpp::Packet packet(1600);
+	packet.addLayer(new pcpp::EthLayer(pcpp::MacAddress("00:50:43:11:22:33"), pcpp::MacAddress("aa:bb:cc:dd:ee:ff"), PCPP_ETHERTYPE_IP), true);
+
+	pcpp::IPv4Address clientIP((uint32_t)htonl(0x0a000000 + (connection & 0xffff) + 1));
+	pcpp::IPv4Address serverIP(std::string("10.1.0.1"));
+	uint16_t clientPort = (uint16_t)(10000 + connection % 50000);
+	pcpp::IPv4Layer* ipLayer = (fromClient ? new pcpp::IPv4Layer(clientIP, serverIP) : new pcpp::IPv4Layer(serverIP, clientIP));
+	ipLayer->getIPv4Header()->timeToLive = 64;
+	packet.addLayer(ipLayer, true);
+
+	pcpp::TcpLayer* tcpLayer = (fromClient ? new pcpp::TcpLayer(clientPort, 80) : new pcpp::TcpLayer(80, clientPort));
+	tcpLayer->getTcpHeader()->sequenceNumber = htonl(seq);
+	tcpLayer->getTcpHeader()->ackNumber = htonl(ack);
+	tcpLayer->getTcpHeader()->synFlag = (syn ? 1 : 0);
+	tcpLayer->getTcpHeader()->finFlag = (fin ? 1 : 0);
+	tcpLayer->getTcpHeader()->ackFlag = (syn && fromClient ? 0 : 1);
+	tcpLayer->getTcpHeader()->windowSize = htons(65535);
+	packet.addLayer(tcpLayer, true);
+
+	if (payloadLen > 0)
+		packet.addLayer(new pcpp::PayloadLayer(payload, payloadLen, false), true);
+
+	packet.computeCalculateFields();
+
+	// the packets are 10 microseconds apart
+	timeval time;
+	time.tv_sec = 1000000 + (time_t)(packetIndex / 100000);
+	time.tv_usec = (suseconds_t)(packetIndex % 100000) * 10;
+	int dataLen = packet.getRawPacket()->getRawDataLen();
+	uint8_t* data = new uint8_t[dataLen];
+	memcpy(data, packet.getRawPacket()->getRawData(), dataLen);
+	return new pcpp::RawPacket(data, dataLen, time, true);
+}
+
+
+/**
+ * Create the packets of TCP connections which are interleaved with each other: a handshake, data segments from the client and
+ * FIN packets from both sides
+ */
+static void createTcpStreams(size_t numOfPackets, size_t segmentSize, const ReassemblyBenchmarkConfig& config, std::vector<pcpp::RawPacket*>& packets)
+{
+	const int numOfConnections = 100;
+	// SYN, SYN/ACK and 2 FINs in addition to the data segments
+	size_t segmentsPerConnection = numOfPackets / numOfConnections;
+	segmentsPerConnection = (segmentsPerConnection > 4 ? segmentsPerConnection - 4 : 1);
+
+	std::vector<uint8_t> payload(segmentSize, 'a');
+	std::vector<bool> canDrop;
+
+	for (int connection = 0; connection < numOfConnections; connection++)
+	{
+		packets.push_back(createTcpSegment(connection, true, 1000, 0, true, false, NULL, 0, packets.size()));
+		canDrop.push_back(false);
+		packets.push_back(createTcpSegment(connection, false, 5000, 1001, true, false, NULL, 0, packets.size()));
+		canDrop.push_back(false);
+	}
+
+	for (size_t segment = 0; segment < segmentsPerConnection; segment++)
+	{
+		for (int connection = 0; connection < numOfConnections; connection++)
+		{
+			packets.push_back(createTcpSegment(connection, true, (uint32_t)(1001 + segment * segmentSize), 5001, false, false, &payload[0], segmentSize, packets.size()));
+			canDrop.push_back(true);
+		}
+	}
+
+	uint32_t clientFinSeq = (uint32_t)(1001 + segmentsPerConnection * segmentSize);
+	for (int connection = 0; connection < numOfConnections; connection++)
+	{
+		packets.push_back(createTcpSegment(connection, true, clientFinSeq, 5001, false, true, NULL, 0, packets.size()));
+		canDrop.push_back(false);
+		packets.push_back(createTcpSegment(connection, false, 5001, clientFinSeq + 1, false, true, NULL, 0, packets.size()));
+		canDrop.push_back(false);
+	}
+
+	applyReorderAndLoss(config, packets, canDrop);
+}
+
+
+/**
+ * Create the fragments of UDP datagrams which are larger than the MTU. Each datagram is split into 3 fragments
+ */
+static void createIPv4Fragments(size_t numOfPackets, const ReassemblyBenchmarkConfig& config, std::vector<pcpp::RawPacket*>& packets)
+{
+	const size_t fragmentSize = 1480;
+	const size_t numOfFragments = 3;
+	size_t numOfDatagrams = (numOfPackets + numOfFragments - 1) / numOfFragments;
+
+	// a UDP header followed by the payload. The UDP checksum is left 0 (not calculated)
+	std::vector<uint8_t> datagram(fragmentSize * numOfFragments, 'b');
+	uint16_t udpHeader[4] = { htons(12345), htons(8080), htons((uint16_t)datagram.size()), 0 };
+	memcpy(&datagram[0], udpHeader, sizeof(udpHeader));
+
+	std::vector<bool> canDrop;
+
+	for (size_t i = 0; i < numOfDatagrams; i++)
+	{
+		for (size_t fragment = 0; fragment < numOfFragments; fragment++)
+		{
+			pcpp::Packet packet(1600);
+			packet.addLayer(new pcpp::EthLayer(pcpp::MacAddress("00:50:43:11:22:33"), pcpp::MacAddress("aa:bb:cc:dd:ee:ff"), PCPP_ETHERTYPE_IP), true);
+			pcpp::IPv4Layer* ipLayer = new pcpp::IPv4Layer(pcpp::IPv4Address(std::string("10.0.0.1")), pcpp::IPv4Address(std::string("10.0.0.2")));
+			packet.addLayer(ipLayer, true);
+			packet.addLayer(new pcpp::PayloadLayer(&datagram[fragment * fragmentSize], fragmentSize, false), true);
+
+			pcpp::iphdr* ipHeader = ipLayer->getIPv4Header();
+			ipHeader->timeToLive = 64;
+			ipHeader->protocol = pcpp::PACKETPP_IPPROTO_UDP;
+			ipHeader->ipId = htons((uint16_t)i);
+			// same as IPFragUtil: the offset in 8-byte units and the "more fragments" flag
+			uint16_t fragOffsetValue = htons((uint16_t)(fragment * fragmentSize / 8)) & (uint16_t)0xff1f;
+			if (fragment + 1 < numOfFragments)
+				fragOffsetValue |= (uint16_t)0x20;
+			ipHeader->fragmentOffset = fragOffsetValue;
+			packet.computeCalculateFields();
+
+			packets.push_back(new pcpp::RawPacket(*packet.getRawPacket()));
+			canDrop.push_back(true);
+		}
+	}
+
+	applyReorderAndLoss(config, packets, canDrop);
+}
+
+
+static void onTcpBenchmarkMessageReady(int side, const pcpp::TcpStreamData& tcpData, void* userCookie)
+{
+	*(uint64_t*)userCookie += tcpData.getDataLength();
+}
+
+
+/**
+ * Run the reassembly benchmarks: TcpReassembly over interleaved TCP connections and IPReassembly over fragmented UDP datagrams,
+ * with the packets reordered and dropped according to the config
+ */
+static void runReassemblyBenchmarks(BenchmarkRunner& runner, size_t numOfPackets, const ReassemblyBenchmarkConfig& config)
+{
+	std::ostringstream conditions;
+	conditions << " (reorder " << config.reorderPercent << "%, loss " << config.lossPercent << "%)";
+
+	std::vector<pcpp::RawPacket*> tcpPackets;
+	createTcpStreams(numOfPackets, 500, config, tcpPackets);
+
+	runner.run("reassembly", "tcp" + conditions.str(), tcpPackets.size(), [&tcpPackets]()
+	{
+		uint64_t reassembledBytes = 0;
+		pcpp::TcpReassembly reassembly(onTcpBenchmarkMessageReady, &reassembledBytes);
+		for (size_t i = 0; i < tcpPackets.size(); i++)
+			reassembly.reassemblePacket(tcpPackets[i]);
+		reassembly.closeAllConnections();
+	});
+
+	for (size_t i = 0; i < tcpPackets.size(); i++)
+		delete tcpPackets[i];
+
+	std::vector<pcpp::RawPacket*> fragments;
+	createIPv4Fragments(numOfPackets, config, fragments);
+
+	runner.run("reassembly", "ip" + conditions.str(), fragments.size(), [&fragments]()
+	{
+		pcpp::IPReassembly reassembly;
+		for (size_t i = 0; i < fragments.size(); i++)
+		{
+			pcpp::IPReassembly::ReassemblyStatus status;
+			pcpp::Packet fragment(fragments[i], pcpp::IPv4);
+			pcpp::Packet* result = reassembly.processPacket(&fragment, status, pcpp::IPv4);
+			if (status == pcpp::IPReassembly::REASSEMBLED)
+				delete result;
+		}
+	});
+
+	for (size_t i = 0; i < fragments.size(); i++)
+		delete fragments[i];
+}
@@ -0,0 +1,304 @@
+#pragma once
+
+#include "BenchmarkRunner.h"
+#include <Packet.h>
+#include <PacketUtils.h>
+#include <PacketView.h>
+#include <FlowHash.h>
+#include <TcpReassembly.h>
+#include <TrafficGenerator.h>
+#include <SystemUtils.h>
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <string>
+#include <vector>
+
+/**
+ * The number of packets a worker takes from its queue at a time, like rte_eth_rx_burst() does in a DPDK worker
+ */
+#define SCALING_BURST_SIZE 32
+
+/**
+ * The work done for every packet by the workers of the scaling benchmarks
+ */
+enum ScalingWorkerBody
+{
+	// parse all layers
+	ScalingBodyParse,
+	// parse and count the packet in a per-worker flow table by its 5-tuple hash
+	ScalingBodyParseHash,
+	// parse and feed TCP packets to a per-worker TcpReassembly
+	ScalingBodyParseReassembly
+};
+
+
+/**
+ * The settings of the scaling benchmarks
+ */
+struct ScalingBenchmarkConfig
+{
+	// the largest number of cores to run the workers on, 0 means all cores
+	int maxCores;
+	// the worker bodies to run, a comma-separated list of: parse, hash, reassembly
+	std::string bodies;
+	// the rate packets arrive at in Mpps for all cores together, 0 means each worker processes its packets as fast as it can
+	double offeredMpps;
+	// the number of packets each worker's queue holds when packets arrive at offeredMpps, like the RX descriptor ring of a NIC queue.
+	// Packets which arrive when the queue is full are dropped
+	size_t queueSize;
+	// the number of times each worker goes over its packets
+	int rounds;
+
+	ScalingBenchmarkConfig() : maxCores(0), bodies("parse,hash,reassembly"), offeredMpps(0), queueSize(1024), rounds(20) {}
+};
+
+
+/**
+ * The state and results of a single worker. Aligned to a cache line so the workers don't write to the same cache lines
+ */
+struct alignas(64) ScalingWorker
+{
+	// the packets RSS hashed to this worker
+	std::vector<pcpp::RawPacket*> packets;
+	int coreId;
+	uint64_t processed;
+	uint64_t dropped;
+	double elapsedNs;
+	uint64_t sink;
+};
+
+
+static void onScalingMessageReady(int side, const pcpp::TcpStreamData& tcpData, void* userCookie)
+{
+	*(uint64_t*)userCookie += tcpData.getDataLength();
+}
+
+
+/**
+ * Run a worker on the current thread: go over its packets config.rounds times, taking them in bursts. If packets arrive at a given
+ * rate, only the packets which have arrived by now can be taken and the packets which didn't fit in the queue are dropped
+ */
+static void runScalingWorker(ScalingWorker& worker, ScalingWorkerBody body, const ScalingBenchmarkConfig& config, double packetsPerNs,
+		std::atomic<bool>& startFlag)
+{
+	while (!startFlag.load(std::memory_order_acquire))
+		;
+
+	std::unordered_map<uint32_t, uint64_t> flowTable;
+	uint64_t reassembledBytes = 0;
+	pcpp::TcpReassembly reassembly(onScalingMessageReady, &reassembledBytes);
+
+	size_t numOfPackets = worker.packets.size();
+	uint64_t total = (uint64_t)numOfPackets * config.rounds;
+	uint64_t next = 0;
+	uint64_t sink = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	while (next < total)
+	{
+		uint64_t available = total;
+		if (packetsPerNs > 0)
+		{
+			double elapsed = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			uint64_t arrived = (uint64_t)(elapsed * packetsPerNs);
+			available = (arrived < total ? arrived : total);
+			if (available - next > config.queueSize)
+			{
+				worker.dropped += available - next - config.queueSize;
+				next = available - config.queueSize;
+			}
+		}
+
+		uint64_t burstEnd = std::min(next + SCALING_BURST_SIZE, available);
+		for (; next < burstEnd; next++)
+		{
+			size_t index = (size_t)(next % numOfPackets);
+
+			// every round starts with empty flow state, so the reassembly sees the connections open and close again
+			if (index == 0 && body == ScalingBodyParseReassembly)
+				reassembly.closeAllConnections();
+
+			pcpp::Packet packet(worker.packets[index]);
+			switch (body)
+			{
+			case ScalingBodyParse:
+				sink += packet.getLastLayer()->getProtocol();
+				break;
+			case ScalingBodyParseHash:
+				flowTable[pcpp::hash5Tuple(&packet)]++;
+				break;
+			case ScalingBodyParseReassembly:
+				if (packet.isPacketOfType(pcpp::TCP))
+					reassembly.reassemblePacket(packet);
+				break;
+			}
+			worker.processed++;
+		}
+	}
+
+	reassembly.closeAllConnections();
+	worker.elapsedNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	worker.sink = sink + flowTable.size() + reassembledBytes;
+}
+
+
+/**
+ * Run the workers of a body on numOfCores cores once and return the aggregate result. The packets are distributed between the workers
+ * by their Toeplitz hash with the symmetric RSS key DpdkDevice configures NICs with, like RSS distributes them between RX queues, and
+ * non-IP packets go to the first worker as they do on NICs
+ */
+static ScalingResult runScalingOnce(const std::vector<pcpp::RawPacket*>& packets, ScalingWorkerBody body, const std::string& bodyName,
+		const std::vector<pcpp::SystemCore>& cores, const ScalingBenchmarkConfig& config)
+{
+	size_t numOfCores = cores.size();
+	std::vector<ScalingWorker> workers(numOfCores);
+	for (size_t i = 0; i < numOfCores; i++)
+	{
+		workers[i].coreId = cores[i].Id;
+		workers[i].processed = 0;
+		workers[i].dropped = 0;
+		workers[i].elapsedNs = 0;
+		workers[i].sink = 0;
+	}
+
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		pcpp::PacketView view;
+		pcpp::FlowTuple tuple;
+		size_t workerIndex = 0;
+		if (pcpp::FlowKeyExtractor::extract(packets[i], view) && pcpp::FlowHash::getTuple(view, tuple))
+			workerIndex = pcpp::FlowHash::hashToeplitz(tuple) % numOfCores;
+		workers[workerIndex].packets.push_back(packets[i]);
+	}
+
+	std::atomic<bool> startFlag(false);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < numOfCores; i++)
+	{
+		// each worker gets its share of the offered rate, as it gets its share of the packets
+		double packetsPerNs = config.offeredMpps * workers[i].packets.size() / packets.size() / 1000.0;
+		if (workers[i].packets.empty())
+			continue;
+
+		threads.push_back(std::thread(runScalingWorker, std::ref(workers[i]), body, std::cref(config), packetsPerNs, std::ref(startFlag)));
+
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(workers[i].coreId, &cpuSet);
+		pthread_setaffinity_np(threads.back().native_handle(), sizeof(cpuSet), &cpuSet);
+	}
+
+	startFlag.store(true, std::memory_order_release);
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	ScalingResult result;
+	result.body = bodyName;
+	result.numOfCores = (int)numOfCores;
+	result.minCoreMpps = -1;
+	result.maxCoreMpps = 0;
+	uint64_t processed = 0, dropped = 0;
+	double elapsedNs = 0;
+	for (size_t i = 0; i < numOfCores; i++)
+	{
+		ScalingWorker& worker = workers[i];
+		processed += worker.processed;
+		dropped += worker.dropped;
+		elapsedNs = std::max(elapsedNs, worker.elapsedNs);
+
+		// a worker which got no packets still counts as a core with no throughput
+		double coreMpps = (worker.elapsedNs > 0 ? worker.processed * 1000.0 / worker.elapsedNs : 0);
+		if (result.minCoreMpps < 0 || coreMpps < result.minCoreMpps)
+			result.minCoreMpps = coreMpps;
+		result.maxCoreMpps = std::max(result.maxCoreMpps, coreMpps);
+	}
+
+	result.mpps = (elapsedNs > 0 ? processed * 1000.0 / elapsedNs : 0);
+	result.dropped = dropped;
+	result.dropPercent = (processed + dropped > 0 ? dropped * 100.0 / (processed + dropped) : 0);
+	result.efficiency = -1;
+	return result;
+}
+
+
+/**
+ * Run the scaling benchmarks: for every worker body in the config and every number of cores from 1 to the maximum, the packets are
+ * distributed between worker threads pinned to different cores (physical cores are used before SMT siblings), and the aggregate
+ * throughput, the throughput of the slowest and fastest cores, the drops and the scaling efficiency (the aggregate throughput divided
+ * by the number of cores times the throughput of a single core) are reported. Each configuration runs once to warm up and then the
+ * runner's number of repetitions, and the repetition with the median throughput is reported
+ */
+static void runScalingBenchmarks(BenchmarkRunner& runner, const std::vector<pcpp::RawPacket*>& packets, const ScalingBenchmarkConfig& config)
+{
+	int numOfMachineCores = pcpp::getNumOfCores();
+	int maxCores = (config.maxCores > 0 && config.maxCores < numOfMachineCores ? config.maxCores : numOfMachineCores);
+	if (maxCores > MAX_NUM_OF_CORES)
+		maxCores = MAX_NUM_OF_CORES;
+
+	std::string bodyList = "," + config.bodies + ",";
+	const char* bodyNames[] = { "parse", "hash", "reassembly" };
+	const ScalingWorkerBody bodies[] = { ScalingBodyParse, ScalingBodyParseHash, ScalingBodyParseReassembly };
+
+	if (config.offeredMpps > 0)
+		printf("\nScaling over 1-%d cores, offered load %.3f Mpps, queue size %d\n", maxCores, config.offeredMpps, (int)config.queueSize);
+	else
+		printf("\nScaling over 1-%d cores, unlimited offered load\n", maxCores);
+	printf("%-12s %-6s %10s %16s %16s %12s %8s %11s\n", "body", "cores", "Mpps", "min core Mpps", "max core Mpps", "drops", "drops %", "efficiency");
+
+	for (size_t b = 0; b < sizeof(bodies) / sizeof(bodies[0]); b++)
+	{
+		if (bodyList.find("," + std::string(bodyNames[b]) + ",") == std::string::npos)
+			continue;
+
+		double singleCoreMpps = 0;
+		for (int numOfCores = 1; numOfCores <= maxCores; numOfCores++)
+		{
+			std::vector<pcpp::SystemCore> cores;
+			pcpp::createCoreVectorFromCoreMask(pcpp::selectNumaLocalCores(-1, numOfCores), cores);
+
+			runScalingOnce(packets, bodies[b], bodyNames[b], cores, config);
+
+			std::vector<ScalingResult> repetitions;
+			for (int i = 0; i < runner.getRepetitions(); i++)
+				repetitions.push_back(runScalingOnce(packets, bodies[b], bodyNames[b], cores, config));
+
+			std::sort(repetitions.begin(), repetitions.end(), [](const ScalingResult& first, const ScalingResult& second)
+			{
+				return first.mpps < second.mpps;
+			});
+			ScalingResult result = repetitions[repetitions.size() / 2];
+
+			if (numOfCores == 1)
+				singleCoreMpps = result.mpps;
+			result.efficiency = (singleCoreMpps > 0 ? result.mpps / (numOfCores * singleCoreMpps) : -1);
+
+			printf("%-12s %-6d %10.3f %16.3f %16.3f %12llu %8.2f %10.1f%%\n", result.body.c_str(), result.numOfCores, result.mpps,
+					result.minCoreMpps, result.maxCoreMpps, (unsigned long long)result.dropped, result.dropPercent, result.efficiency * 100);
+			fflush(stdout);
+
+			runner.addScalingResult(result);
+		}
+	}
+}
+
+
+/**
+ * Generate traffic of many flows for the scaling benchmarks when no input file is given, so RSS can spread it over all cores
+ */
+static void createScalingPackets(size_t numOfPackets, std::vector<pcpp::RawPacket*>& packets)
+{
+	pcpp::TrafficGeneratorConfiguration config;
+	config.numOfFlows = (numOfPackets / 10 > 0 ? numOfPackets / 10 : 1);
+	config.maxConcurrentFlows = 256;
+	config.minPacketsPerFlow = 2;
+	config.maxPacketsPerFlow = 20;
+	config.maxPayloadSize = 1400;
+	config.seed = 12345;
+
+	pcpp::TrafficGenerator generator(config);
+	generator.generateAll(packets);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "BenchmarkRunner.h"
+#include <ProtocolRegistry.h>
+#include <SSLLayer.h>
+#include <SSLHandshake.h>
+#include <PcapLiveDeviceList.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+extern char** environ;
+
+/**
+ * The command line option the startup benchmarks run the application's own executable with, followed by the probe name
+ */
+#define STARTUP_PROBE_OPTION "--startup-probe"
+
+
+/**
+ * The work a startup probe process does before it exits. Every probe includes the work of the probes before it:
+ * - exit - nothing, the process only loads the libraries and runs their static initializers
+ * - tables - the first lookups in the protocol, port and cipher-suite tables, which are built on first use
+ * - devices - enumerating the live devices
+ * - device-attributes - fetching the MTU, MAC address and default gateway of every live device and the DNS servers, which are
+ *   fetched on first access
+ */
+static int runStartupProbe(const std::string& probe)
+{
+	if (probe == "exit")
+		return 0;
+
+	int result = 0;
+	result += (pcpp::ProtocolRegistry::getInstance().isPortOfProtocol(443, pcpp::SSL) ? 1 : 0);
+	result += (int)pcpp::SSLLayer::getSSLPortMap()->size();
+	result += (pcpp::SSLCipherSuite::getCipherSuiteByID(0xC02F) != NULL ? 1 : 0);
+	result += (pcpp::SSLCipherSuite::getCipherSuiteByName("TLS_RSA_WITH_AES_128_CBC_SHA") != NULL ? 1 : 0);
+	if (probe == "tables")
+		return (result > 0 ? 0 : 1);
+
+	const std::vector<pcpp::PcapLiveDevice*>& devices = pcpp::PcapLiveDeviceList::getInstance().getPcapLiveDevicesList();
+	if (probe == "devices")
+		return (devices.size() > 0 ? 0 : 1);
+
+	for (size_t i = 0; i < devices.size(); i++)
+	{
+		result += devices[i]->getMtu();
+		result += (devices[i]->getMacAddress().isValid() ? 1 : 0);
+		result += (devices[i]->getDefaultGateway().isValid() ? 1 : 0);
+	}
+	result += (int)pcpp::PcapLiveDeviceList::getInstance().getDnsServers().size();
+	if (probe == "device-attributes")
+		return (result > 0 ? 0 : 1);
+
+	return 2;
+}
+
+
+/**
+ * Start the application's own executable with a startup probe and wait for it to exit
+ */
+static bool spawnStartupProbe(const char* probe)
+{
+	char* argv[] = { (char*)"benchmark", (char*)STARTUP_PROBE_OPTION, (char*)probe, NULL };
+	pid_t pid;
+	if (posix_spawn(&pid, "/proc/self/exe", NULL, NULL, argv, environ) != 0)
+		return false;
+
+	int status;
+	return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) != 2;
+}
+
+
+/**
+ * Run the startup benchmarks: the time it takes to start a process of the application, do some first-use work and exit, as short-lived
+ * tools that run once per file or per command do. Each benchmark processes a single "packet", so ns/pkt is the time per process.
+ * The difference between a probe and the one before it is the cost of its first-use work
+ */
+static void runStartupBenchmarks(BenchmarkRunner& runner)
+{
+	const char* probes[] = { "exit", "tables", "devices", "device-attributes" };
+	for (size_t i = 0; i < sizeof(probes) / sizeof(probes[0]); i++)
+	{
+		const char* probe = probes[i];
+		if (!spawnStartupProbe(probe))
+		{
+			printf("%-12s %-40s cannot run the probe process, skipping\n", "startup", probe);
+			continue;
+		}
+
+		runner.run("startup", probe, 1, [probe]()
+		{
+			spawnStartupProbe(probe);
+		});
+	}
+}
@@ -1,29 +1,349 @@
 /**
  * PcapPlusPlus benchmark application
  * ==================================
- * This application is meant to run a benchmark for PcapPlusPlus as part of the "packet-capture-benchmarks" project created by
- * Matias Fontanini: https://github.com/mfontanini/packet-capture-benchmarks
- * The application follows the project's convention so the benchmark code is very similar to other existing benchmarks in this project
- * with minor changes necessary to test and run PcapPlusPlus.
+ * This application has 2 modes:
+ *
+ * 1. The benchmark suite (the default mode): a set of micro and macro benchmarks which measure packet parsing per protocol,
+ *    packet crafting, TCP and IP reassembly and file reading/writing. The packets are read from an input file or, if no file is
+ *    given, crafted by the application. Each benchmark reports ns/packet, Mpps, heap allocations/packet and CPU cycles/packet
+ *    (and optionally CPU hardware counters such as cache and branch misses), and the results can also be written to a JSON file
+ *    so they can be compared between versions.
+ *    Run the application with -h to see the available options.
+ *
+ * 2. The packet-capture-benchmarks mode: a benchmark for PcapPlusPlus as part of the "packet-capture-benchmarks" project created by
+ *    Matias Fontanini: https://github.com/mfontanini/packet-capture-benchmarks
+ *    The application follows the project's convention so the benchmark code is very similar to other existing benchmarks in this project
+ *    with minor changes necessary to test and run PcapPlusPlus. This mode is used when the application is run with exactly 3
+ *    arguments: <input-file> <dns|packet> <repetitions>
+ *    In order to run this benchmark please download packet-capture-benchmarks and compile the existing benchmarks . Then copy the
+ *    application folder to packet-capture-benchmarks/ , rename it to PcapPlusPlus and compile it using the makefile provided here.
+ *    Then use benchmark.sh script provided in packet-capture-benchmarks with all benchmarks you want to run. For example:
+ *    ./benchmark.sh libpcap PcapPlusPlus libtins libcrafter
+ *
  * This application currently compiles and runs on Linux only, I didn't manage to compile it on Windows with MinGW (issues related to
  * to compiling a C++11 application together with WinPcap. There's probably a solution but I didn't find it yet)
- * In order to run this benchmark please download packet-capture-benchmarks and compile the existing benchmarks . Then copy the
- * application folder to packet-capture-benchmarks/ , rename it to PcapPlusPlus and compile it using the makefile provided here.
- * Then use benchmark.sh script provided in packet-capture-benchmarks with all benchmarks you want to run. For example:
- * ./benchmark.sh libpcap PcapPlusPlus libtins libcrafter
  */
 
+#include "BenchmarkRunner.h"
+#include "ParseBenchmarks.h"
+#include "CraftBenchmarks.h"
+#include "ReassemblyBenchmarks.h"
+#include "FileBenchmarks.h"
+#include "ScalingBenchmarks.h"
+#include "StartupBenchmarks.h"
 #include <Packet.h>
 #include <DnsLayer.h>
 #include <PcapFileDevice.h>
+#include <Logger.h>
+#include <SystemUtils.h>
 #include <iostream>
 #include <chrono>
 #include <string>
 #include <vector>
 #include <numeric>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
 
 using namespace pcpp;
 
+
+/**
+ * Heap allocation counting. All allocations done through operator new (including the ones inside PcapPlusPlus) are counted, so
+ * the benchmarks can report the number of allocations per packet. Allocations libpcap does with malloc() aren't counted. The count is
+ * per thread, see numOfAllocations in BenchmarkRunner.h
+ */
+thread_local uint64_t numOfAllocations = 0;
+
+void* operator new(size_t size)
+{
+	numOfAllocations++;
+	void* ptr = malloc(size > 0 ? size : 1);
+	if (ptr == NULL)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	numOfAllocations++;
+	void* ptr = malloc(size > 0 ? size : 1);
+	if (ptr == NULL)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	free(ptr);
+}
+
+
+static struct option BenchmarkOptions[] =
+{
+	{"input-file",  required_argument, 0, 'f'},
+	{"groups", required_argument, 0, 'g'},
+	{"repetitions", required_argument, 0, 'r'},
+	{"packet-count", required_argument, 0, 'n'},
+	{"reorder", required_argument, 0, 'o'},
+	{"loss", required_argument, 0, 'l'},
+	{"json-file", required_argument, 0, 'j'},
+	{"hw-counters", no_argument, 0, 'c'},
+	{"max-cores", required_argument, 0, 'C'},
+	{"worker-bodies", required_argument, 0, 'W'},
+	{"offered-rate", required_argument, 0, 'R'},
+	{"help", no_argument, 0, 'h'},
+	{"version", no_argument, 0, 'v'},
+	{0, 0, 0, 0}
+};
+
+
+#define EXIT_WITH_ERROR(reason, ...) do { \
+	printf("\nError: " reason "\n\n", ## __VA_ARGS__); \
+	printUsage(); \
+	exit(1); \
+	} while(0)
+
+
+/**
+ * Print application usage
+ */
+void printUsage()
+{
+	printf("\nUsage:\n"
+			"-------\n"
+			"%s [-h] [-v] [-f input_file] [-g groups] [-r repetitions] [-n packet_count] [-o reorder_percent] [-l loss_percent] [-j json_file] [-c] [-C max_cores] [-W bodies] [-R offered_mpps]\n"
+			"%s input_file dns|packet repetitions\n"
+			"\nThe first form runs the benchmark suite, the second form runs the packet-capture-benchmarks benchmark\n"
+			"\nOptions:\n\n"
+			"    -f input_file      : Input pcap/pcapng file name. If not given, a built-in set of crafted packets (Eth, IPv4, IPv6,\n"
+			"                         TCP, UDP, HTTP, SSL, DNS, SIP and GTP) is used\n"
+			"    -g groups          : A comma-separated list of the benchmark groups to run: parse, craft, reassembly, file,\n"
+			"                         scaling, startup. The default is all groups except scaling and startup\n"
+			"    -r repetitions     : The number of times each benchmark is repeated. The median is reported. The default is 5\n"
+			"    -n packet_count    : The number of packets to read from the input file or to craft. The default is 10000\n"
+			"    -o reorder_percent : The percentage of packets reordered in the reassembly benchmarks. The default is 0\n"
+			"    -l loss_percent    : The percentage of packets dropped in the reassembly benchmarks. The default is 0\n"
+			"    -j json_file       : Write the results to a JSON file\n"
+			"    -c                 : Count CPU hardware events (cycles, instructions, L1 data cache misses, LLC misses and branch\n"
+			"                         misses) with perf_event and report them per packet. Requires Linux and hardware counters\n"
+			"                         access (see /proc/sys/kernel/perf_event_paranoid)\n"
+			"    -C max_cores       : The scaling group runs its workers on 1 to max_cores cores. The default is all cores\n"
+			"    -W bodies          : A comma-separated list of the worker bodies the scaling group runs: parse, hash,\n"
+			"                         reassembly. The default is all of them\n"
+			"    -R offered_mpps    : The rate in Mpps packets arrive at the scaling group's workers, packets which don't fit in\n"
+			"                         a worker's queue are dropped. The default is 0, which means the workers run as fast as they can\n"
+			"    -v                 : Displays the current version and exists\n"
+			"    -h                 : Displays this help message and exits\n", AppName::get().c_str(), AppName::get().c_str());
+	exit(0);
+}
+
+
+/**
+ * Print application version
+ */
+void printAppVersion()
+{
+	printf("%s %s\n", AppName::get().c_str(), getPcapPlusPlusVersionFull().c_str());
+	printf("Built: %s\n", getBuildDateTime().c_str());
+	printf("Built from: %s\n", getGitInfo().c_str());
+	exit(0);
+}
+
+
+/**
+ * Read up to maxPackets packets from a pcap/pcapng file. The caller owns the returned raw packets
+ */
+bool readInputFile(const std::string& fileName, size_t maxPackets, std::vector<RawPacket*>& packets)
+{
+	IFileReaderDevice* reader = IFileReaderDevice::getReader(fileName.c_str());
+	if (reader == NULL || !reader->open())
+	{
+		delete reader;
+		return false;
+	}
+
+	RawPacket rawPacket;
+	while (packets.size() < maxPackets && reader->getNextPacket(rawPacket))
+		packets.push_back(new RawPacket(rawPacket));
+
+	reader->close();
+	delete reader;
+	return true;
+}
+
+
+/**
+ * Run the benchmark suite
+ */
+int runBenchmarkSuite(int argc, char* argv[])
+{
+	std::string inputFileName;
+	std::string groups = "parse,craft,reassembly,file";
+	std::string jsonFileName;
+	int repetitions = 5;
+	int packetCount = 10000;
+	bool hwCounters = false;
+	ReassemblyBenchmarkConfig reassemblyConfig;
+	ScalingBenchmarkConfig scalingConfig;
+
+	int optionIndex = 0;
+	int opt = 0;
+
+	while((opt = getopt_long (argc, argv, "f:g:r:n:o:l:j:cC:W:R:hv", BenchmarkOptions, &optionIndex)) != -1)
+	{
+		switch (opt)
+		{
+			case 0:
+				break;
+			case 'f':
+				inputFileName = optarg;
+				break;
+			case 'g':
+				groups = optarg;
+				break;
+			case 'r':
+				repetitions = atoi(optarg);
+				break;
+			case 'n':
+				packetCount = atoi(optarg);
+				break;
+			case 'o':
+				reassemblyConfig.reorderPercent = atof(optarg);
+				break;
+			case 'l':
+				reassemblyConfig.lossPercent = atof(optarg);
+				break;
+			case 'j':
+				jsonFileName = optarg;
+				break;
+			case 'c':
+				hwCounters = true;
+				break;
+			case 'C':
+				scalingConfig.maxCores = atoi(optarg);
+				break;
+			case 'W':
+				scalingConfig.bodies = optarg;
+				break;
+			case 'R':
+				scalingConfig.offeredMpps = atof(optarg);
+				break;
+			case 'h':
+				printUsage();
+				break;
+			case 'v':
+				printAppVersion();
+				break;
+			default:
+				printUsage();
+				exit(-1);
+		}
+	}
+
+	if (repetitions <= 0)
+		EXIT_WITH_ERROR("Number of repetitions must be positive");
+
+	if (packetCount <= 0)
+		EXIT_WITH_ERROR("Packet count must be positive");
+
+	if (reassemblyConfig.reorderPercent < 0 || reassemblyConfig.reorderPercent > 100 || reassemblyConfig.lossPercent < 0 || reassemblyConfig.lossPercent > 100)
+		EXIT_WITH_ERROR("Reorder and loss percentages must be between 0 and 100");
+
+	if (scalingConfig.maxCores < 0)
+		EXIT_WITH_ERROR("Max cores can't be negative");
+
+	if (scalingConfig.offeredMpps < 0)
+		EXIT_WITH_ERROR("Offered rate can't be negative");
+
+	// wrap the group list with commas so each group can be looked up as ",<group>,"
+	std::string groupList = "," + groups + ",";
+	bool runParse = (groupList.find(",parse,") != std::string::npos);
+	bool runCraft = (groupList.find(",craft,") != std::string::npos);
+	bool runReassembly = (groupList.find(",reassembly,") != std::string::npos);
+	bool runFile = (groupList.find(",file,") != std::string::npos);
+	bool runScaling = (groupList.find(",scaling,") != std::string::npos);
+	bool runStartup = (groupList.find(",startup,") != std::string::npos);
+
+	if (!runParse && !runCraft && !runReassembly && !runFile && !runScaling && !runStartup)
+		EXIT_WITH_ERROR("No valid benchmark group was given");
+
+	std::vector<RawPacket*> packets;
+	if (inputFileName != "")
+	{
+		if (!readInputFile(inputFileName, (size_t)packetCount, packets))
+			EXIT_WITH_ERROR("Cannot open input file '%s'", inputFileName.c_str());
+		if (packets.empty())
+			EXIT_WITH_ERROR("Input file '%s' doesn't contain any packets", inputFileName.c_str());
+	}
+	else
+		createSamplePackets((size_t)packetCount, packets);
+
+	printf("Running benchmarks on %d packets from %s, %d repetitions\n\n", (int)packets.size(),
+			(inputFileName != "" ? inputFileName.c_str() : "built-in packets"), repetitions);
+
+	// the benchmarks process malformed and partial packets (for example because of loss), don't flood the output with errors
+	LoggerPP::getInstance().supressErrors();
+
+	BenchmarkRunner runner(repetitions);
+	if (hwCounters && !runner.enableHardwareCounters())
+		printf("Hardware counters aren't available on this machine, running without them\n\n");
+
+	if (runParse)
+		runParseBenchmarks(runner, packets);
+
+	if (runCraft)
+		runCraftBenchmarks(runner, packets);
+
+	if (runReassembly)
+		runReassemblyBenchmarks(runner, packets.size(), reassemblyConfig);
+
+	if (runFile)
+		runFileBenchmarks(runner, packets, "benchmark_tmp");
+
+	if (runScaling)
+	{
+		// the built-in packets are a handful of flows, which RSS can't spread over many cores, so generate traffic of many flows instead
+		std::vector<RawPacket*> scalingPackets;
+		if (inputFileName != "")
+			scalingPackets = packets;
+		else
+			createScalingPackets((size_t)packetCount, scalingPackets);
+
+		runScalingBenchmarks(runner, scalingPackets, scalingConfig);
+
+		if (inputFileName == "")
+		{
+			for (size_t i = 0; i < scalingPackets.size(); i++)
+				delete scalingPackets[i];
+		}
+	}
+
+	if (runStartup)
+		runStartupBenchmarks(runner);
+
+	LoggerPP::getInstance().enableErrors();
+
+	for (size_t i = 0; i < packets.size(); i++)
+		delete packets[i];
+
+	if (jsonFileName != "" && !runner.writeJson(jsonFileName, inputFileName))
+		EXIT_WITH_ERROR("Cannot write JSON file '%s'", jsonFileName.c_str());
+
+	return 0;
+}
+
+
+/**
+ * The packet-capture-benchmarks benchmark
+ */
+
 size_t count = 0;
 
 bool handle_dns(Packet& packet) {
@@ -54,11 +374,7 @@ bool handle_packet(Packet& packet) {
     return true;
 }
 
-int main(int argc, char *argv[]) { 
-    if(argc != 4) {
-        std::cout << "Usage: " << *argv << " <input-file> <dns|packet> <repetitions>\n";
-        return 1;
-    }
+int run_packet_capture_benchmark(int argc, char *argv[]) {
     std::chrono::high_resolution_clock myClock;
     std::string input_type(argv[2]);
     int total_runs = std::stoi(argv[3]);
@@ -102,5 +418,19 @@ int main(int argc, char *argv[]) {
     using std::chrono::milliseconds;
     auto total_time_in_ms = duration_cast<milliseconds>(total_time).count();
     std::cout << (total_packets / total_runs) << " " << (total_time_in_ms / durations.size()) << std::endl;
+    return 0;
 }
 
+int main(int argc, char* argv[])
+{
+	AppName::init(argc, argv);
+
+	// a process started by the startup benchmarks
+	if (argc == 3 && strcmp(argv[1], STARTUP_PROBE_OPTION) == 0)
+		return runStartupProbe(argv[2]);
+
+	if (argc == 4 && (strcmp(argv[2], "dns") == 0 || strcmp(argv[2], "packet") == 0))
+		return run_packet_capture_benchmark(argc, argv);
+
+	return runBenchmarkSuite(argc, argv);
+}
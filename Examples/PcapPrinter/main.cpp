@@ -5,7 +5,7 @@
  * as a readable string (quite similar to the way Wireshark shows packets).
  * In addition it prints a short summary of the file (with details such as file name, size, etc.)
  * The result is printed to stdout (by default) or to a file (if specified). It can also print only the
- * first X packets of a file
+ * first X packets of a file. Packets can also be printed as JSON lines, a JSON object per packet, for processing by other tools
  *
  * For more details about modes of operation and parameters run PcapPrinter -h
  */
@@ -16,6 +16,7 @@
 #include <sstream>
 #include <RawPacket.h>
 #include <Packet.h>
+#include <PacketDumpWriter.h>
 #include <PcapFileDevice.h>
 #include <PcapPlusPlusVersion.h>
 #include <SystemUtils.h>
@@ -30,12 +31,17 @@ static struct option PcapPrinterOptions[] =
 	{"packet-count", required_argument, 0, 'c'},
 	{"filter", required_argument, 0, 'i'},
 	{"summary", no_argument, 0, 's'},
+	{"json", no_argument, 0, 'j'},
 	{"help", no_argument, 0, 'h'},
 	{"version", no_argument, 0, 'v'},
     {0, 0, 0, 0}
 };
 
 
+// the size the output buffer is allowed to grow to before it's written to the output stream
+#define OUTPUT_BUFFER_FLUSH_SIZE 64*1024
+
+
 #define EXIT_WITH_ERROR(reason, ...) do { \
 	printf("\nError: " reason "\n\n", ## __VA_ARGS__); \
 	printUsage(); \
@@ -51,13 +57,14 @@ void printUsage()
 {
 	printf("\nUsage:\n"
 			"-------\n"
-			"%s [-h] [-v] [-o output_file] [-c packet_count] [-i filter] [-s] -f pcap_file\n"
+			"%s [-h] [-v] [-o output_file] [-c packet_count] [-i filter] [-s] [-j] -f pcap_file\n"
 			"\nOptions:\n\n"
 			"    -f pcap_file   : Input pcap/pcapng file name\n"
 			"    -o output_file : Save output to text file (default output is stdout)\n"
 			"    -c packet_count: Print only first packet_count number of packet\n"
 			"    -i filter      : Apply a BPF filter, meaning only filtered packets will be printed\n"
 			"    -s             : Print only file summary and exit\n"
+			"    -j             : Print packets as JSON lines (a JSON object per packet) instead of text\n"
 			"    -v             : Displays the current version and exists\n"
 			"    -h             : Displays this help message and exits\n", AppName::get().c_str());
 	exit(0);
@@ -134,11 +141,28 @@ std::string printFileSummary(IFileReaderDevice* reader)
 }
 
 
+/**
+* write the output buffer to the output stream once it's large enough, or always if force is set
+*/
+void flushOutputBuffer(std::string& buffer, std::ostream* out, bool force)
+{
+	if (buffer.empty() || (!force && buffer.size() < OUTPUT_BUFFER_FLUSH_SIZE))
+		return;
+
+	out->write(buffer.data(), buffer.size());
+	buffer.clear();
+}
+
+
 /**
 * print all requested packets in a pcap file
 */
-int printPcapPackets(PcapFileReaderDevice* reader, std::ostream* out, int packetCount)
+int printPcapPackets(PcapFileReaderDevice* reader, std::ostream* out, int packetCount, PacketDumpWriter::Format format)
 {
+	// the packets are written into a buffer which is reused for all of them, so printing doesn't allocate memory per packet
+	std::string buffer;
+	PacketDumpWriter writer(buffer, format);
+
 	// read packets from the file until end-of-file or until reached user requested packet count
 	int packetCountSoFar = 0;
 	RawPacket rawPacket;
@@ -147,11 +171,17 @@ int printPcapPackets(PcapFileReaderDevice* reader, std::ostream* out, int packet
 		// parse the raw packet into a parsed packet
 		Packet parsedPacket(&rawPacket);
 
-		// print packet to string
-		(*out) << parsedPacket.toString() << std::endl;
+		// print packet to the buffer
+		writer.writePacket(parsedPacket);
+		if (format == PacketDumpWriter::TextFormat)
+			buffer += '\n';
+
+		flushOutputBuffer(buffer, out, false);
 
 		packetCountSoFar++;
 	}
+
+	flushOutputBuffer(buffer, out, true);
 	
 	// return the nubmer of packets that were printed
 	return packetCountSoFar;
@@ -161,28 +191,41 @@ int printPcapPackets(PcapFileReaderDevice* reader, std::ostream* out, int packet
 /**
 * print all requested packets in a pcap-ng file
 */
-int printPcapNgPackets(PcapNgFileReaderDevice* reader, std::ostream* out, int packetCount)
+int printPcapNgPackets(PcapNgFileReaderDevice* reader, std::ostream* out, int packetCount, PacketDumpWriter::Format format)
 {
+	std::string buffer;
+	PacketDumpWriter writer(buffer, format);
+
 	// read packets from the file until end-of-file or until reached user requested packet count
 	int packetCountSoFar = 0;
 	RawPacket rawPacket;
 	std::string packetComment = "";
 	while (reader->getNextPacket(rawPacket, packetComment) && packetCountSoFar != packetCount)
 	{
-		// print packet comment if exists
-		if (packetComment != "")
-			(*out) << "Packet Comment: " << packetComment << std::endl;
-
 		// parse the raw packet into a parsed packet
 		Packet parsedPacket(&rawPacket);
 
-		// print packet to string
-		(*out) << "Link layer type: " << linkLayerToString(rawPacket.getLinkLayerType()) << std::endl;
-		(*out) << parsedPacket.toString() << std::endl;
+		if (format == PacketDumpWriter::TextFormat)
+		{
+			// print packet comment if exists
+			if (packetComment != "")
+				buffer += "Packet Comment: " + packetComment + "\n";
+
+			buffer += "Link layer type: " + linkLayerToString(rawPacket.getLinkLayerType()) + "\n";
+		}
+
+		// print packet to the buffer
+		writer.writePacket(parsedPacket);
+		if (format == PacketDumpWriter::TextFormat)
+			buffer += '\n';
+
+		flushOutputBuffer(buffer, out, false);
 
 		packetCountSoFar++;
 	}
 
+	flushOutputBuffer(buffer, out, true);
+
 	// return the number of packets that were printed
 	return packetCountSoFar;
 }
@@ -202,12 +245,14 @@ int main(int argc, char* argv[])
 
 	bool printOnlySummary = false;
 
+	PacketDumpWriter::Format format = PacketDumpWriter::TextFormat;
+
 	int packetCount = -1;
 
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long (argc, argv, "f:o:c:i:svh", PcapPrinterOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "f:o:c:i:sjvh", PcapPrinterOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -228,6 +273,9 @@ int main(int argc, char* argv[])
 			case 's':
 				printOnlySummary = true;
 				break;
+			case 'j':
+				format = PacketDumpWriter::JsonLinesFormat;
+				break;
 			case 'h':
 				printUsage();
 				break;
@@ -276,8 +324,9 @@ int main(int argc, char* argv[])
 			
 	}
 
-	// print file summary
-	(*out) << printFileSummary(reader);
+	// print file summary. It's left out of JSON lines output so every line of it is a JSON object
+	if (printOnlySummary || format == PacketDumpWriter::TextFormat)
+		(*out) << printFileSummary(reader);
 
 	// if requested to print only file summary - exit
 	if (printOnlySummary)
@@ -293,17 +342,18 @@ int main(int argc, char* argv[])
 	{
 		// print all requested packets in the pcap file
 		PcapFileReaderDevice* pcapReader = dynamic_cast<PcapFileReaderDevice*>(reader);
-		printedPacketCount = printPcapPackets(pcapReader, out, packetCount);
+		printedPacketCount = printPcapPackets(pcapReader, out, packetCount, format);
 	}
 	// if the file is a pcap-ng file
 	else if (dynamic_cast<PcapNgFileReaderDevice*>(reader) != NULL)
 	{
 		// print all requested packets in the pcap-ng file
 		PcapNgFileReaderDevice* pcapNgReader = dynamic_cast<PcapNgFileReaderDevice*>(reader);
-		printedPacketCount = printPcapNgPackets(pcapNgReader, out, packetCount);
+		printedPacketCount = printPcapNgPackets(pcapNgReader, out, packetCount, format);
 	}
 	
-	(*out) << "Finished. Printed " << printedPacketCount << " packets" << std::endl;
+	if (format == PacketDumpWriter::TextFormat)
+		(*out) << "Finished. Printed " << printedPacketCount << " packets" << std::endl;
 
 	// close the file
 	reader->close();
@@ -0,0 +1,634 @@
+#pragma once
+
+#include <Packet.h>
+#include <PacketDumpWriter.h>
+#include <PacketView.h>
+#include <IpAddress.h>
+#include <PcapFileDevice.h>
+#include <PcapFileIndex.h>
+#include <PcapFileSummary.h>
+#include <PcapFilter.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#include <string>
+#include <fstream>
+
+/**
+ * Decides from a file summary (see pcpp::PcapFileSummary) whether a BPF search criteria may match any packet of the file. The criteria is
+ * evaluated over two values, "can't match" and "may match": a host primitive of an IPv4 or IPv6 address ("host", "src host", "ip6 dst host"
+ * etc.) can't match if the file has no such address in that direction, "and" can't match if either side can't, "or" if both sides can't.
+ * "and" and "or" have the same precedence and are evaluated left to right, as in BPF. Everything else, including negated terms and host names, may match, so a file
+ * which has a matching packet is never skipped
+ */
+class SearchCriteriaAnalyzer
+{
+public:
+
+	SearchCriteriaAnalyzer(const std::string& searchCriteria)
+	{
+		// split into words, with every parenthesis and "!" as a separate word
+		std::string word;
+		for (size_t i = 0; i <= searchCriteria.length(); i++)
+		{
+			char c = (i < searchCriteria.length() ? searchCriteria[i] : ' ');
+			if (c == ' ' || c == '\t' || c == '(' || c == ')' || (c == '!' && word.empty()))
+			{
+				if (!word.empty())
+					m_Words.push_back(word);
+				word.clear();
+				if (c != ' ' && c != '\t')
+					m_Words.push_back(std::string(1, c));
+			}
+			else
+				word += c;
+		}
+	}
+
+	/**
+	 * @return False if no packet of the file summarized can match the criteria, true if some packet may match
+	 */
+	bool mayMatch(const pcpp::PcapFileSummary& summary) const
+	{
+		size_t pos = 0;
+		return evalExpression(summary, pos);
+	}
+
+private:
+
+	std::vector<std::string> m_Words;
+
+	static bool isAnd(const std::string& word) { return word == "and" || word == "&&"; }
+	static bool isOr(const std::string& word) { return word == "or" || word == "||"; }
+
+	bool evalExpression(const pcpp::PcapFileSummary& summary, size_t& pos) const
+	{
+		bool result = evalTerm(summary, pos);
+		while (pos < m_Words.size() && m_Words[pos] != ")")
+		{
+			// terms without an operator between them are treated as concatenated
+			bool isOrOp = isOr(m_Words[pos]);
+			if (isOrOp || isAnd(m_Words[pos]))
+				pos++;
+
+			bool rhs = evalTerm(summary, pos);
+			result = (isOrOp ? result || rhs : result && rhs);
+		}
+
+		return result;
+	}
+
+	bool evalTerm(const pcpp::PcapFileSummary& summary, size_t& pos) const
+	{
+		if (pos >= m_Words.size())
+			return true;
+
+		if (m_Words[pos] == "not" || m_Words[pos] == "!")
+		{
+			// the negation of a term which can't match matches every packet
+			pos++;
+			evalTerm(summary, pos);
+			return true;
+		}
+
+		if (m_Words[pos] == "(")
+		{
+			pos++;
+			bool result = evalExpression(summary, pos);
+			if (pos < m_Words.size())
+				pos++;
+			return result;
+		}
+
+		// a primitive is all words up to the next operator or parenthesis
+		size_t start = pos;
+		while (pos < m_Words.size() && !isAnd(m_Words[pos]) && !isOr(m_Words[pos]) && m_Words[pos] != "(" && m_Words[pos] != ")")
+			pos++;
+
+		return evalPrimitive(summary, start, pos);
+	}
+
+	bool evalPrimitive(const pcpp::PcapFileSummary& summary, size_t start, size_t end) const
+	{
+		// [ip|ip6] [src|dst] host ADDRESS
+		size_t i = start;
+		bool ipOnly = false;
+		if (i < end && (m_Words[i] == "ip" || m_Words[i] == "ip6"))
+		{
+			ipOnly = true;
+			i++;
+		}
+		pcpp::Direction direction = pcpp::SRC_OR_DST;
+		if (i < end && (m_Words[i] == "src" || m_Words[i] == "dst"))
+		{
+			direction = (m_Words[i] == "src" ? pcpp::SRC : pcpp::DST);
+			i++;
+		}
+		if (i + 2 != end || m_Words[i] != "host")
+			return true;
+
+		pcpp::IPAddressValue address = pcpp::IPAddressValue::fromString(m_Words[i + 1]);
+		if (!address.isValid())
+			return true;
+
+		// without "ip" or "ip6" IPv4 host primitives match the addresses of ARP and RARP packets too, which the summary doesn't hold
+		if (!ipOnly && address.isIPv4() && summary.getNumOfNonIPPackets() > 0)
+			return true;
+
+		return summary.mayContainIPAddress(address, direction);
+	}
+};
+
+
+/**
+ * The settings of ParallelSearch
+ */
+struct ParallelSearchConfiguration
+{
+	/** The number of worker threads */
+	int numOfThreads;
+	/** Whether to load the summaries of the files, skip the files which can't match and save the summaries of the files searched */
+	bool useSummaries;
+	/** Whether only packets in the time window [fromNs, toNs) are searched */
+	bool hasTimeWindow;
+	uint64_t fromNs;
+	uint64_t toNs;
+	/** Files at least twice this size are split into chunks of about this size, which are searched in parallel */
+	uint64_t chunkSize;
+
+	ParallelSearchConfiguration() : numOfThreads(1), useSummaries(false), hasTimeWindow(false), fromNs(0), toNs(0), chunkSize(64 * 1024 * 1024) {}
+};
+
+
+/**
+ * Searches capture files on several threads:
+ * - Every worker thread has a queue of work items. The files are divided between the queues at the beginning, and a worker whose queue
+ *   is empty steals the oldest item of another worker's queue, so the workers stay busy until all files are searched
+ * - A file at least twice the chunk size is split into chunks of packets, using its packet index (see pcpp::PcapFileIndex), by the worker
+ *   which takes it. The chunks are queued in that worker's queue, from which idle workers steal them, so a few huge files are searched
+ *   by all workers. Other files are read whole, pcap files with pcpp::MmapPcapFileReaderDevice
+ * - Optionally the summary of every file (see pcpp::PcapFileSummary) is loaded from its sidecar file, and files no packet of which can
+ *   match are skipped without reading them. The summaries of the files searched are built while searching and saved
+ * - The results are printed by the calling thread in the order of the file list, as soon as all chunks of the next file are done
+ */
+class ParallelSearch
+{
+public:
+
+	ParallelSearch(const std::string& searchCriteria, const ParallelSearchConfiguration& config) :
+		m_SearchCriteria(searchCriteria), m_CriteriaAnalyzer(searchCriteria), m_Config(config), m_DetailedReport(false),
+		m_NumOfItemsLeft(0)
+	{
+		pthread_mutex_init(&m_Mutex, NULL);
+		pthread_cond_init(&m_FileDone, NULL);
+	}
+
+	~ParallelSearch()
+	{
+		pthread_mutex_destroy(&m_Mutex);
+		pthread_cond_destroy(&m_FileDone);
+	}
+
+	/**
+	 * Search files and print the number of packets found in every file, in the order of the list
+	 * @param[in] filePaths The files to search
+	 * @param[in] detailedReportFile A file to write the matching packets to, or NULL
+	 * @param[out] totalPacketsFound The number of packets found in all files
+	 * @param[out] totalFilesSkipped The number of files skipped by their summaries
+	 * @return False if the worker threads couldn't be started, true otherwise
+	 */
+	bool search(const std::vector<std::string>& filePaths, std::ofstream* detailedReportFile, int& totalPacketsFound, int& totalFilesSkipped)
+	{
+		totalPacketsFound = 0;
+		totalFilesSkipped = 0;
+		m_DetailedReport = (detailedReportFile != NULL);
+
+		m_Files.resize(filePaths.size());
+		for (int i = 0; i < m_Config.numOfThreads; i++)
+			m_Workers.push_back(new Worker(this, i, m_SearchCriteria));
+
+		for (size_t i = 0; i < filePaths.size(); i++)
+		{
+			m_Files[i].path = filePaths[i];
+			WorkItem item = { (int)i, -1, 0, 0 };
+			pushItem(*m_Workers[i % m_Workers.size()], item);
+		}
+
+		std::vector<pthread_t> threads;
+		for (size_t i = 0; i < m_Workers.size(); i++)
+		{
+			pthread_t thread;
+			if (pthread_create(&thread, NULL, workerThreadMain, m_Workers[i]) != 0)
+				break;
+			threads.push_back(thread);
+		}
+
+		// when no thread could be started nothing is searched. Otherwise the threads started take the items of the others
+		if (threads.empty())
+		{
+			for (size_t i = 0; i < m_Workers.size(); i++)
+				delete m_Workers[i];
+			m_Workers.clear();
+			return false;
+		}
+
+		for (size_t i = 0; i < m_Files.size(); i++)
+		{
+			SearchFile& file = m_Files[i];
+			pthread_mutex_lock(&m_Mutex);
+			while (!file.done)
+				pthread_cond_wait(&m_FileDone, &m_Mutex);
+			pthread_mutex_unlock(&m_Mutex);
+
+			int packetsFound = printFileResult(file, detailedReportFile);
+			if (file.skipped)
+				totalFilesSkipped++;
+			if (packetsFound > 0)
+			{
+				printf("%d packets found in '%s'\n", packetsFound, file.path.c_str());
+				totalPacketsFound += packetsFound;
+			}
+		}
+
+		for (size_t i = 0; i < threads.size(); i++)
+			pthread_join(threads[i], NULL);
+
+		for (size_t i = 0; i < m_Workers.size(); i++)
+			delete m_Workers[i];
+		m_Workers.clear();
+		m_Files.clear();
+
+		return true;
+	}
+
+private:
+
+	// a file to search, or a chunk of packets of a file split into chunks (chunkIndex >= 0)
+	struct WorkItem
+	{
+		int fileIndex;
+		int chunkIndex;
+		uint64_t firstPacket;
+		uint64_t endPacket;
+	};
+
+	struct ChunkResult
+	{
+		int packetsFound;
+		std::string report;
+	};
+
+	struct SearchFile
+	{
+		std::string path;
+		uint64_t size;
+		int64_t modificationTime;
+		// the packet index of a file split into chunks
+		pcpp::PcapFileIndex* index;
+		std::vector<ChunkResult> chunks;
+		int numOfChunksLeft;
+		// the summary built while searching, or NULL if it isn't built
+		pcpp::PcapFileSummary* summary;
+		bool skipped;
+		bool openFailed;
+		bool done;
+
+		SearchFile() : size(0), modificationTime(0), index(NULL), numOfChunksLeft(0), summary(NULL), skipped(false), openFailed(false),
+			done(false) {}
+		~SearchFile() { delete index; delete summary; }
+	};
+
+	struct Worker
+	{
+		ParallelSearch* search;
+		int index;
+		// the filter is compiled for each worker, matching packets with it isn't thread safe
+		pcpp::BPFStringFilter filter;
+		std::deque<WorkItem> items;
+		pthread_mutex_t itemsMutex;
+
+		Worker(ParallelSearch* search, int index, const std::string& criteria) : search(search), index(index), filter(criteria)
+		{
+			pthread_mutex_init(&itemsMutex, NULL);
+		}
+
+		~Worker() { pthread_mutex_destroy(&itemsMutex); }
+	};
+
+	std::string m_SearchCriteria;
+	SearchCriteriaAnalyzer m_CriteriaAnalyzer;
+	ParallelSearchConfiguration m_Config;
+	bool m_DetailedReport;
+	std::vector<SearchFile> m_Files;
+	std::vector<Worker*> m_Workers;
+	// the number of items queued or being processed, all work is done when it reaches zero
+	int m_NumOfItemsLeft;
+	pthread_mutex_t m_Mutex;
+	pthread_cond_t m_FileDone;
+
+	void pushItem(Worker& worker, const WorkItem& item)
+	{
+		pthread_mutex_lock(&m_Mutex);
+		m_NumOfItemsLeft++;
+		pthread_mutex_unlock(&m_Mutex);
+
+		pthread_mutex_lock(&worker.itemsMutex);
+		worker.items.push_back(item);
+		pthread_mutex_unlock(&worker.itemsMutex);
+	}
+
+	static bool popItem(Worker& worker, WorkItem& item)
+	{
+		pthread_mutex_lock(&worker.itemsMutex);
+		bool result = !worker.items.empty();
+		if (result)
+		{
+			item = worker.items.front();
+			worker.items.pop_front();
+		}
+		pthread_mutex_unlock(&worker.itemsMutex);
+		return result;
+	}
+
+	bool getItem(Worker& worker, WorkItem& item)
+	{
+		while (true)
+		{
+			if (popItem(worker, item))
+				return true;
+
+			// the oldest items are stolen first, they're the next ones to be printed
+			for (size_t i = 1; i < m_Workers.size(); i++)
+			{
+				if (popItem(*m_Workers[(worker.index + i) % m_Workers.size()], item))
+					return true;
+			}
+
+			pthread_mutex_lock(&m_Mutex);
+			bool allDone = (m_NumOfItemsLeft == 0);
+			pthread_mutex_unlock(&m_Mutex);
+			if (allDone)
+				return false;
+
+			// another worker is still splitting a file into chunks
+			sched_yield();
+		}
+	}
+
+	static void* workerThreadMain(void* workerPtr)
+	{
+		Worker* worker = (Worker*)workerPtr;
+		WorkItem item;
+		while (worker->search->getItem(*worker, item))
+		{
+			if (item.chunkIndex < 0)
+				worker->search->processFile(*worker, item.fileIndex);
+			else
+				worker->search->processChunk(*worker, item);
+
+			pthread_mutex_lock(&worker->search->m_Mutex);
+			worker->search->m_NumOfItemsLeft--;
+			pthread_mutex_unlock(&worker->search->m_Mutex);
+		}
+
+		return NULL;
+	}
+
+	void processFile(Worker& worker, int fileIndex)
+	{
+		SearchFile& file = m_Files[fileIndex];
+		pcpp::PcapFileSummary::getFileVersion(file.path, file.size, file.modificationTime);
+
+		if (m_Config.useSummaries)
+		{
+			pcpp::PcapFileSummary savedSummary;
+			if (savedSummary.load(pcpp::PcapFileSummary::getDefaultSummaryFileName(file.path), file.path))
+			{
+				if (!m_CriteriaAnalyzer.mayMatch(savedSummary) ||
+						(m_Config.hasTimeWindow && !savedSummary.overlapsTimeRange(toTimespec(m_Config.fromNs), toTimespec(m_Config.toNs))))
+				{
+					file.skipped = true;
+					file.chunks.resize(1);
+					file.numOfChunksLeft = 1;
+					chunkDone(file, 0, NULL);
+					return;
+				}
+			}
+			else
+			{
+				// the version of the file is taken before it's read, so a file appended to while it's searched gets a stale summary
+				file.summary = new pcpp::PcapFileSummary();
+				file.summary->setFileVersion(file.size, file.modificationTime);
+			}
+		}
+
+		if (m_Workers.size() > 1 && file.size >= 2 * m_Config.chunkSize && splitFile(worker, fileIndex))
+			return;
+
+		file.chunks.resize(1);
+		file.numOfChunksLeft = 1;
+		pcpp::PcapFileSummary summary;
+		searchWholeFile(worker, file, file.chunks[0], summary);
+		chunkDone(file, 0, &summary);
+	}
+
+	bool splitFile(Worker& worker, int fileIndex)
+	{
+		SearchFile& file = m_Files[fileIndex];
+
+		// the index is saved next to the file only when the user allows writing summaries there
+		pcpp::PcapFileIndex* index = new pcpp::PcapFileIndex();
+		bool indexed = (m_Config.useSummaries ? index->loadOrBuild(file.path) : index->build(file.path));
+		if (!indexed || index->getNumOfPackets() == 0)
+		{
+			delete index;
+			return false;
+		}
+
+		// chunks of whole packets, each starting at least chunkSize bytes after the previous one
+		std::vector<WorkItem> chunks;
+		WorkItem chunk = { fileIndex, 0, 0, 0 };
+		for (uint64_t i = 1; i < index->getNumOfPackets(); i++)
+		{
+			if (index->getPacketOffset(i) - index->getPacketOffset(chunk.firstPacket) >= m_Config.chunkSize)
+			{
+				chunk.endPacket = i;
+				chunks.push_back(chunk);
+				chunk.chunkIndex++;
+				chunk.firstPacket = i;
+			}
+		}
+		chunk.endPacket = index->getNumOfPackets();
+		chunks.push_back(chunk);
+
+		file.index = index;
+		file.chunks.resize(chunks.size());
+		file.numOfChunksLeft = (int)chunks.size();
+		for (size_t i = 0; i < chunks.size(); i++)
+			pushItem(worker, chunks[i]);
+
+		return true;
+	}
+
+	void searchWholeFile(Worker& worker, SearchFile& file, ChunkResult& result, pcpp::PcapFileSummary& summary)
+	{
+		result.packetsFound = 0;
+
+		// pcap files are read by mapping them to memory, where it's supported
+		pcpp::IFileReaderDevice* reader = pcpp::IFileReaderDevice::getReader(file.path.c_str());
+		if (dynamic_cast<pcpp::PcapFileReaderDevice*>(reader) != NULL)
+		{
+			pcpp::IFileReaderDevice* mmapReader = new pcpp::MmapPcapFileReaderDevice(file.path.c_str());
+			if (mmapReader->open())
+			{
+				delete reader;
+				reader = mmapReader;
+			}
+			else
+				delete mmapReader;
+		}
+
+		if (!reader->isOpened() && !reader->open())
+		{
+			file.openFailed = true;
+			delete reader;
+			return;
+		}
+
+		// the filter is matched here rather than by the reader, the summary is built from all packets
+		pcpp::RawPacket rawPacket;
+		std::string report;
+		while (reader->getNextPacket(rawPacket))
+			searchPacket(worker, file, rawPacket, result, summary, report);
+
+		reader->close();
+		delete reader;
+		result.report.swap(report);
+	}
+
+	void processChunk(Worker& worker, const WorkItem& item)
+	{
+		SearchFile& file = m_Files[item.fileIndex];
+		ChunkResult& result = file.chunks[item.chunkIndex];
+		result.packetsFound = 0;
+
+		pcpp::PcapFileSummary summary;
+		pcpp::PcapFileIndex::PacketReader packetReader(*file.index);
+		if (!packetReader.open())
+		{
+			file.openFailed = true;
+			chunkDone(file, item.chunkIndex, NULL);
+			return;
+		}
+
+		pcpp::RawPacket rawPacket;
+		std::string report;
+		for (uint64_t i = item.firstPacket; i < item.endPacket && packetReader.readPacket(i, rawPacket); i++)
+			searchPacket(worker, file, rawPacket, result, summary, report);
+
+		packetReader.close();
+		result.report.swap(report);
+		chunkDone(file, item.chunkIndex, &summary);
+	}
+
+	void searchPacket(Worker& worker, SearchFile& file, pcpp::RawPacket& rawPacket, ChunkResult& result, pcpp::PcapFileSummary& summary,
+			std::string& report)
+	{
+		if (file.summary != NULL)
+			summary.addPacket(rawPacket);
+
+		if (m_Config.hasTimeWindow)
+		{
+			timespec ts = rawPacket.getPacketTimeStampNs();
+			uint64_t timestamp = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+			if (timestamp < m_Config.fromNs || timestamp >= m_Config.toNs)
+				return;
+		}
+
+		if (!worker.filter.matchPacketWithFilter(&rawPacket))
+			return;
+
+		result.packetsFound++;
+		if (m_DetailedReport)
+		{
+			// print layer by layer with a few spaces before each layer, directly into the chunk's report
+			pcpp::Packet parsedPacket(&rawPacket);
+			pcpp::PacketDumpWriter writer(report);
+			writer.setIndent("    ");
+			report += '\n';
+			writer.writePacket(parsedPacket);
+		}
+	}
+
+	void chunkDone(SearchFile& file, int chunkIndex, const pcpp::PcapFileSummary* summary)
+	{
+		pthread_mutex_lock(&m_Mutex);
+		if (summary != NULL && file.summary != NULL)
+			file.summary->merge(*summary);
+		bool fileDone = (--file.numOfChunksLeft == 0);
+		pthread_mutex_unlock(&m_Mutex);
+
+		if (!fileDone)
+			return;
+
+		// a summary can't be saved in a read-only directory, the file is searched again next time
+		if (file.summary != NULL)
+		{
+			if (!file.openFailed)
+				file.summary->save(pcpp::PcapFileSummary::getDefaultSummaryFileName(file.path));
+			delete file.summary;
+			file.summary = NULL;
+		}
+
+		pthread_mutex_lock(&m_Mutex);
+		file.done = true;
+		pthread_cond_broadcast(&m_FileDone);
+		pthread_mutex_unlock(&m_Mutex);
+	}
+
+	int printFileResult(SearchFile& file, std::ofstream* detailedReportFile)
+	{
+		int packetsFound = 0;
+		for (size_t i = 0; i < file.chunks.size(); i++)
+			packetsFound += file.chunks[i].packetsFound;
+
+		if (detailedReportFile != NULL)
+		{
+			(*detailedReportFile) << "File '" << file.path << "':" << std::endl;
+			if (file.openFailed)
+				(*detailedReportFile) << "    Cannot open file" << std::endl;
+			else if (file.skipped)
+				(*detailedReportFile) << "    ----> Skipped, its summary shows no packet can match" << std::endl << std::endl;
+			else
+			{
+				for (size_t i = 0; i < file.chunks.size(); i++)
+					(*detailedReportFile) << file.chunks[i].report;
+				if (packetsFound > 0)
+					(*detailedReportFile) << "\n";
+				(*detailedReportFile) << "    ----> Found " << packetsFound << " packets" << std::endl << std::endl;
+			}
+		}
+
+		// the results are printed once, their memory can be freed
+		std::vector<ChunkResult>().swap(file.chunks);
+		delete file.index;
+		file.index = NULL;
+
+		return packetsFound;
+	}
+
+	static timespec toTimespec(uint64_t timestamp)
+	{
+		timespec ts;
+		ts.tv_sec = (time_t)(timestamp / 1000000000ULL);
+		ts.tv_nsec = (long)(timestamp % 1000000000ULL);
+		return ts;
+	}
+
+	// disable copy c'tor and assignment operator
+	ParallelSearch(const ParallelSearch& other);
+	ParallelSearch& operator=(const ParallelSearch& other);
+};
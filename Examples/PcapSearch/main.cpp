@@ -35,7 +35,10 @@
 #include <SystemUtils.h>
 #include <RawPacket.h>
 #include <Packet.h>
+#include <PacketDumpWriter.h>
 #include <PcapFileDevice.h>
+#include <PrefetchingFileReader.h>
+#include "ParallelSearch.h"
 #include <getopt.h>
 
 
@@ -48,6 +51,9 @@ static struct option PcapSearchOptions[] =
 	{"search", required_argument, 0, 's'},
 	{"detailed-report", required_argument, 0, 'r'},
 	{"set-extensions", required_argument, 0, 'e'},
+	{"threads", required_argument, 0, 'j'},
+	{"use-summaries", no_argument, 0, 'x'},
+	{"time-window", required_argument, 0, 't'},
 	{"version", no_argument, 0, 'v'},
 	{"help", no_argument, 0, 'h'},
     {0, 0, 0, 0}
@@ -79,7 +85,7 @@ void printUsage()
 {
 	printf("\nUsage:\n"
 			"-------\n"
-			"%s [-h] [-v] [-n] [-r file_name] [-e extension_list] -d directory -s search_criteria\n"
+			"%s [-h] [-v] [-n] [-r file_name] [-e extension_list] [-j num_of_threads] [-x] [-t from,to] -d directory -s search_criteria\n"
 			"\nOptions:\n\n"
 			"    -d directory        : Input directory\n"
 			"    -n                  : Don't include sub-directories (default is include them)\n"
@@ -87,6 +93,11 @@ void printUsage()
 			"    -r file_name        : Write a detailed search report to a file\n"
 			"    -e extension_list   : Set file extensions to search. The default is searching '.pcap' and '.pcapng' files.\n"
 			"                          extnesions_list should be a comma-separated list of extensions, for example: pcap,net,dmp\n"
+			"    -j num_of_threads   : Search files on several threads. Large files are split into chunks searched in parallel.\n"
+			"                          The results are printed in the same order as when searching on one thread\n"
+			"    -x                  : Use file summaries: skip files whose summary shows no packet can match the criteria or the\n"
+			"                          time window, and save a summary ('.psum' file) next to every file searched\n"
+			"    -t from,to          : Search only packets captured in this time window, given in seconds since the epoch\n"
 			"    -v                  : Displays the current version and exists\n"
 			"    -h                  : Displays this help message and exits\n", AppName::get().c_str());
 	exit(0);
@@ -154,29 +165,40 @@ int searchPcap(std::string pcapFilePath, std::string searchCriteria, std::ofstre
 	}
 
 	int packetCount = 0;
-	RawPacket rawPacket;
+
+	// the detailed report of a packet is written into a buffer which is reused for all packets
+	std::string packetReport;
+	PacketDumpWriter writer(packetReport);
+	writer.setIndent("    ");
+
+	// packets are read in a background thread while the previous ones are processed. If the thread can't be started the loop below
+	// finds no packets
+	PrefetchingFileReader prefetchingReader(*reader);
+	prefetchingReader.start();
+	RawPacket* rawPacket;
 
 	// read packets from the file. Since we already set the filter, only packets that matches the filter will be read
-	while (reader->getNextPacket(rawPacket))
+	while ((rawPacket = prefetchingReader.getNextPacket()) != NULL)
 	{
 		// if a detailed report is required, parse the packet and print it to the report file
 		if (detailedReportFile != NULL)
 		{
 			// parse the packet
-			Packet parsedPacket(&rawPacket);
-
-			// print layer by layer by layer as we want to add a few spaces before each layer
-			std::vector<std::string> packetLayers;
-			parsedPacket.toStringList(packetLayers);
-			for (std::vector<std::string>::iterator iter = packetLayers.begin(); iter != packetLayers.end(); iter++)
-				(*detailedReportFile) << "\n    " << (*iter);
-			(*detailedReportFile) << std::endl;
+			Packet parsedPacket(rawPacket);
+
+			// print layer by layer with a few spaces before each layer
+			packetReport.clear();
+			packetReport += '\n';
+			writer.writePacket(parsedPacket);
+			detailedReportFile->write(packetReport.data(), packetReport.size());
 		}
 
 		// count the packet read
 		packetCount++;
 	}
 
+	prefetchingReader.stop();
+
 	// close the reader file
 	reader->close();
 
@@ -199,12 +221,11 @@ int searchPcap(std::string pcapFilePath, std::string searchCriteria, std::ofstre
 
 
 /**
- * Searches all pcap files in given directory (and sub-directories if directed by the user) and output how many packets in each file matches a given
- * search criteria. This method outputs how many directories were searched, how many files were searched and how many packets were matched
+ * Collects the pcap files in given directory (and sub-directories if directed by the user) to search. The files of every directory are
+ * added after the files of its sub-directories. This method outputs how many directories were searched
  */
-void searchtDirectories(std::string directory, bool includeSubDirectories, std::string searchCriteria, std::ofstream* detailedReportFile,
-		std::map<std::string, bool> extensionsToSearch,
-		int& totalDirSearched, int& totalFilesSearched, int& totalPacketsFound)
+void collectPcapFiles(std::string directory, bool includeSubDirectories, std::map<std::string, bool> extensionsToSearch,
+		std::vector<std::string>& filesToSearch, int& totalDirSearched)
 {
     // open the directory
     DIR *dir = opendir(directory.c_str());
@@ -259,7 +280,7 @@ void searchtDirectories(std::string directory, bool includeSubDirectories, std::
     	// if we got to here it means the file is actually a directory. If required to search sub-directories, call this method recursively to search
     	// inside this sub-directory
         if (includeSubDirectories)
-        	searchtDirectories(dirPath, true, searchCriteria, detailedReportFile, extensionsToSearch, totalDirSearched, totalFilesSearched, totalPacketsFound);
+        	collectPcapFiles(dirPath, true, extensionsToSearch, filesToSearch, totalDirSearched);
 
         // move to the next file
         entry = readdir(dir);
@@ -270,22 +291,8 @@ void searchtDirectories(std::string directory, bool includeSubDirectories, std::
 
     totalDirSearched++;
 
-    // when we get to here we already covered all sub-directories and collected all the files in this directory that are required for search
-    // go over each such file and search its packets to find the search criteria
-    for (std::vector<std::string>::iterator iter = pcapList.begin(); iter != pcapList.end(); iter++)
-    {
-    	// do the actual search
-    	int packetsFound = searchPcap(*iter, searchCriteria, detailedReportFile);
-
-    	// add to total matched packets
-    	totalFilesSearched++;
-    	if (packetsFound > 0)
-    	{
-    		printf("%d packets found in '%s'\n", packetsFound, iter->c_str());
-    		totalPacketsFound += packetsFound;
-    	}
-    }
-
+    // when we get to here we already covered all sub-directories, so the files of this directory are added after theirs
+    filesToSearch.insert(filesToSearch.end(), pcapList.begin(), pcapList.end());
 }
 
 
@@ -307,6 +314,9 @@ int main(int argc, char* argv[])
 
 	std::map<std::string, bool> extensionsToSearch;
 
+	ParallelSearchConfiguration parallelConfig;
+	bool parallelSearch = false;
+
 	// the default (unless set otherwise) is to search in '.pcap' and '.pcapng' extensions
 	extensionsToSearch["pcap"] = true;
 	extensionsToSearch["pcapng"] = true;
@@ -314,7 +324,7 @@ int main(int argc, char* argv[])
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long (argc, argv, "d:s:r:e:hvn", PcapSearchOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "d:s:r:e:j:xt:hvn", PcapSearchOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -354,6 +364,31 @@ int main(int argc, char* argv[])
 				}
 				break;
 			}
+			case 'j':
+				parallelConfig.numOfThreads = atoi(optarg);
+				if (parallelConfig.numOfThreads <= 0)
+				{
+					EXIT_WITH_ERROR("Number of threads must be a positive number");
+				}
+				parallelSearch = true;
+				break;
+			case 'x':
+				parallelConfig.useSummaries = true;
+				parallelSearch = true;
+				break;
+			case 't':
+			{
+				double from, to;
+				if (sscanf(optarg, "%lf,%lf", &from, &to) != 2 || from < 0 || to <= from)
+				{
+					EXIT_WITH_ERROR("Time window must be given as 'from,to' in seconds since the epoch");
+				}
+				parallelConfig.hasTimeWindow = true;
+				parallelConfig.fromNs = (uint64_t)(from * 1e9);
+				parallelConfig.toNs = (uint64_t)(to * 1e9);
+				parallelSearch = true;
+				break;
+			}
 			case 'h':
 				printUsage();
 				break;
@@ -410,12 +445,42 @@ int main(int argc, char* argv[])
 	int totalDirSearched = 0;
 	int totalFilesSearched = 0;
 	int totalPacketsFound = 0;
+	int totalFilesSkipped = 0;
+
+	// collect all files first, then search them
+	std::vector<std::string> filesToSearch;
+	collectPcapFiles(inputDirectory, includeSubDirectories, extensionsToSearch, filesToSearch, totalDirSearched);
+
+	if (parallelSearch)
+	{
+		ParallelSearch search(searchCriteria, parallelConfig);
+		if (!search.search(filesToSearch, detailedReportFile, totalPacketsFound, totalFilesSkipped))
+		{
+			EXIT_WITH_ERROR("Couldn't start the search threads");
+		}
+		totalFilesSearched = (int)filesToSearch.size() - totalFilesSkipped;
+	}
+	else
+	{
+		for (std::vector<std::string>::iterator iter = filesToSearch.begin(); iter != filesToSearch.end(); iter++)
+		{
+			// do the actual search
+			int packetsFound = searchPcap(*iter, searchCriteria, detailedReportFile);
 
-	// the main call - start searching!
-	searchtDirectories(inputDirectory, includeSubDirectories, searchCriteria, detailedReportFile, extensionsToSearch, totalDirSearched, totalFilesSearched, totalPacketsFound);
+			// add to total matched packets
+			totalFilesSearched++;
+			if (packetsFound > 0)
+			{
+				printf("%d packets found in '%s'\n", packetsFound, iter->c_str());
+				totalPacketsFound += packetsFound;
+			}
+		}
+	}
 
 	// after search is done, close the report file and delete its instance
 	printf("\n\nDone! Searched %d files in %d directories, %d packets were matched to search criteria\n", totalFilesSearched, totalDirSearched, totalPacketsFound);
+	if (totalFilesSkipped > 0)
+		printf("%d files were skipped by their summaries\n", totalFilesSkipped);
 	if (detailedReportFile != NULL)
 	{
 		if (detailedReportFile->is_open())
@@ -28,19 +28,20 @@ public:
 		uint32_t hash = pcpp::hash2Tuple(&packet);
 
 		// if flow isn't found in the flow table
-		if (m_FlowTable.find(hash) == m_FlowTable.end())
+		int* fileNum = m_FlowTable.find(hash);
+		if (fileNum == NULL)
 		{
 			// create a new entry and get a new file number for it
-			m_FlowTable[hash] = getNextFileNumber(filesToClose);
-		}
-		else // flow is found in the 2-tuple flow table
-		{
-			// indicate file is being written because this file may not be in the LRU list (and hence closed),
-			// so we need to put it there, open it, and maybe close another file
-			writingToFile(m_FlowTable[hash], filesToClose);
+			int newFileNum = getNextFileNumber(filesToClose);
+			m_FlowTable[hash] = newFileNum;
+			return newFileNum;
 		}
 
-		return m_FlowTable[hash];
+		// flow is found in the 2-tuple flow table.
+		// indicate file is being written because this file may not be in the LRU list (and hence closed),
+		// so we need to put it there, open it, and maybe close another file
+		writingToFile(*fileNum, filesToClose);
+		return *fileNum;
 	}
 };
 
@@ -58,7 +59,7 @@ private:
 
 	// a flow table for saving TCP state per flow. Currently the only data that is saved is whether
 	// the last packet seen on the flow was a TCP SYN packet
-	std::map<uint32_t, bool> m_TcpFlowTable;
+	pcpp::FlowTable<uint32_t, bool> m_TcpFlowTable;
 
 	/**
 	 * A utility method that takes a packet and returns true if it's a TCP SYN packet
@@ -98,10 +99,11 @@ public:
 		uint32_t hash = pcpp::hash5Tuple(&packet);
 
 		// if flow isn't found in the flow table
-		if (m_FlowTable.find(hash) == m_FlowTable.end())
+		if (m_FlowTable.find(hash) == NULL)
 		{
 			// create a new entry and get a new file number for it
-			m_FlowTable[hash] = getNextFileNumber(filesToClose);
+			int newFileNum = getNextFileNumber(filesToClose);
+			m_FlowTable[hash] = newFileNum;
 
 			// if this is s a TCP packet check whether it's a SYN packet
 			// and save this data in the TCP flow table
@@ -121,9 +123,11 @@ public:
 				//(with the same 5-tuple as the previous one), so assign a new file number to it.
 				// unless the last packet was also SYN, which is an indication of SYN retransmission.
 				// In this case don't assign a new file number
-				if (isSyn && m_TcpFlowTable.find(hash) != m_TcpFlowTable.end() && m_TcpFlowTable[hash] == false)
+				bool* lastWasSyn = m_TcpFlowTable.find(hash);
+				if (isSyn && lastWasSyn != NULL && *lastWasSyn == false)
 				{
-					m_FlowTable[hash] = getNextFileNumber(filesToClose);
+					int newFileNum = getNextFileNumber(filesToClose);
+					m_FlowTable[hash] = newFileNum;
 				}
 				else
 				{
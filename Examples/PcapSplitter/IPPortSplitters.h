@@ -37,12 +37,13 @@ public:
 		// hash the 5-tuple and look for it in the flow table
 		uint32_t hash = pcpp::hash5Tuple(&packet);
 
-		if (m_FlowTable.find(hash) != m_FlowTable.end())
+		int* fileNum = m_FlowTable.find(hash);
+		if (fileNum != NULL)
 		{
-			writingToFile(m_FlowTable[hash], filesToClose);
+			writingToFile(*fileNum, filesToClose);
 
 			// if found it, follow the file number written in the hash record
-			return m_FlowTable[hash];
+			return *fileNum;
 		}
 
 		// if it's the first packet seen on this flow, try to guess the server port
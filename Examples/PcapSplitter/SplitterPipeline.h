@@ -0,0 +1,321 @@
+#pragma once
+
+#include "Splitters.h"
+#include <PcapFileDevice.h>
+#include <MultiFileWriter.h>
+#include <FlowDispatcher.h>
+#include <SPSCQueue.h>
+#include <pthread.h>
+#include <sched.h>
+#include <set>
+
+/**
+ * Splits a pcap file on several threads. The work is done by pipeline stages connected by single-producer single-consumer queues:
+ * - The reader (the thread calling run()) reads the packets and hands each one to a parse worker by the symmetric hash of its 5-tuple
+ *   (see pcpp::FlowDispatcher::getFlowHash()), so all packets of a flow, in both directions, are parsed by the same worker
+ * - The parse workers parse the packets into layers, which is most of the CPU work of splitting
+ * - The classifier takes the parsed packets from the workers in their original order and calls Splitter::getFileNumber(). Splitters
+ *   number their files in the order packets arrive and keep state shared by many flows (the file of a client IP, the size of the current
+ *   file, etc.), so getFileNumber() runs on a single thread in input order and returns exactly what it returns when splitting on one
+ *   thread
+ * - The writers each own a disjoint set of the output files (the file number modulo the number of writers) and write them with a
+ *   pcpp::MultiFileWriter. The packets of each file reach its writer in input order
+ *
+ * Packets travel between the stages in slots taken from a fixed pool, which the writers return to the reader, so no slot is allocated
+ * per packet and a slow stage stops the reader when the pool runs out
+ */
+class SplitterPipeline
+{
+public:
+
+	/**
+	 * A c'tor for this class
+	 * @param[in] splitter The splitter to classify the packets with. It's used by the classifier thread only
+	 * @param[in] outputPcapBasePath The base path passed to Splitter::getFileName()
+	 * @param[in] outputFileExtension The extension added to the file names
+	 * @param[in] numOfWorkers The number of parse workers
+	 * @param[in] numOfWriters The number of writers
+	 */
+	SplitterPipeline(Splitter* splitter, const std::string& outputPcapBasePath, const std::string& outputFileExtension, int numOfWorkers,
+			int numOfWriters) :
+		m_Splitter(splitter), m_OutputPcapBasePath(outputPcapBasePath), m_OutputFileExtension(outputFileExtension),
+		m_OrderQueue(NUM_OF_SLOTS + 1), m_NumOfPackets(0), m_NumOfFiles(0)
+	{
+		m_Slots = new Slot[NUM_OF_SLOTS];
+		for (int i = 0; i < NUM_OF_SLOTS; i++)
+			m_FreeSlots.push_back(&m_Slots[i]);
+
+		// every queue can hold all slots and an end marker, so pushing never waits for room
+		for (int i = 0; i < numOfWorkers; i++)
+		{
+			m_Workers.push_back(new Worker());
+			m_Workers[i]->pipeline = this;
+			m_Workers[i]->inQueue = new SlotQueue(NUM_OF_SLOTS + 1);
+			m_Workers[i]->outQueue = new SlotQueue(NUM_OF_SLOTS + 1);
+		}
+
+		// the memory budget and the open files limit are divided between the writers
+		pcpp::MultiFileWriterConfiguration writerConfig(PCPP_MULTI_FILE_WRITER_DEFAULT_MEMORY_BUDGET / numOfWriters, 250 / numOfWriters);
+		for (int i = 0; i < numOfWriters; i++)
+		{
+			m_Writers.push_back(new Writer(writerConfig));
+			m_Writers[i]->inQueue = new SlotQueue(NUM_OF_SLOTS + 1);
+			m_Writers[i]->returnQueue = new SlotQueue(NUM_OF_SLOTS + 1);
+			m_Writers[i]->result = true;
+		}
+	}
+
+	/**
+	 * A d'tor for this class
+	 */
+	~SplitterPipeline()
+	{
+		for (size_t i = 0; i < m_Workers.size(); i++)
+		{
+			delete m_Workers[i]->inQueue;
+			delete m_Workers[i]->outQueue;
+			delete m_Workers[i];
+		}
+
+		for (size_t i = 0; i < m_Writers.size(); i++)
+		{
+			delete m_Writers[i]->inQueue;
+			delete m_Writers[i]->returnQueue;
+			delete m_Writers[i];
+		}
+
+		delete [] m_Slots;
+	}
+
+	/**
+	 * Split all packets of a reader and close the output files
+	 * @param[in] reader An opened pcap file reader
+	 * @return False if a thread couldn't be started or some output files couldn't be written, true otherwise
+	 */
+	bool run(pcpp::IFileReaderDevice* reader)
+	{
+		std::vector<pthread_t> threads;
+		bool threadsStarted = startThreads(threads);
+
+		int numOfWorkers = (int)m_Workers.size();
+		while (threadsStarted)
+		{
+			Slot* slot = getFreeSlot();
+			if (!reader->getNextPacket(slot->rawPacket))
+				break;
+
+			// the hash is calculated from the raw headers without parsing the packet, and both directions of a flow get the same hash
+			int workerIndex = (int)(((uint64_t)pcpp::FlowDispatcher::getFlowHash(&slot->rawPacket) * numOfWorkers) >> 32);
+			pushWait(*m_Workers[workerIndex]->inQueue, slot);
+			pushWait(m_OrderQueue, workerIndex);
+			m_NumOfPackets++;
+		}
+
+		// the classifier tells the writers to stop after it classifies all packets. If not all threads were started the writers are told
+		// directly, the classifier had no packets to give them
+		for (int i = 0; i < numOfWorkers; i++)
+			pushWait(*m_Workers[i]->inQueue, (Slot*)NULL);
+		pushWait(m_OrderQueue, -1);
+		if (!threadsStarted)
+		{
+			for (size_t i = 0; i < m_Writers.size(); i++)
+				pushWait(*m_Writers[i]->inQueue, (Slot*)NULL);
+		}
+
+		for (size_t i = 0; i < threads.size(); i++)
+			pthread_join(threads[i], NULL);
+
+		bool result = threadsStarted;
+		for (size_t i = 0; i < m_Writers.size(); i++)
+			result = result && m_Writers[i]->result;
+
+		return result;
+	}
+
+	/**
+	 * @return The number of packets read
+	 */
+	int getNumOfPackets() const { return m_NumOfPackets; }
+
+	/**
+	 * @return The number of output files
+	 */
+	int getNumOfFiles() const { return m_NumOfFiles; }
+
+private:
+
+	// the number of packets which can be in the pipeline at the same time
+	static const int NUM_OF_SLOTS = 4096;
+
+	struct Slot
+	{
+		pcpp::RawPacket rawPacket;
+		pcpp::Packet parsedPacket;
+		int fileNumber;
+		// the file name, set only in the first packet of a file
+		std::string newFileName;
+	};
+
+	typedef pcpp::SPSCQueue<Slot*> SlotQueue;
+
+	struct Worker
+	{
+		SplitterPipeline* pipeline;
+		SlotQueue* inQueue;
+		SlotQueue* outQueue;
+	};
+
+	struct Writer
+	{
+		pcpp::MultiFileWriter fileWriter;
+		SlotQueue* inQueue;
+		// the slots written, returned to the reader
+		SlotQueue* returnQueue;
+		bool result;
+
+		Writer(const pcpp::MultiFileWriterConfiguration& config) : fileWriter(config) {}
+	};
+
+	Splitter* m_Splitter;
+	std::string m_OutputPcapBasePath;
+	std::string m_OutputFileExtension;
+	Slot* m_Slots;
+	// the free slots, owned by the reader
+	std::vector<Slot*> m_FreeSlots;
+	std::vector<Worker*> m_Workers;
+	std::vector<Writer*> m_Writers;
+	// the worker of each packet in input order, which the classifier takes the packets back from
+	pcpp::SPSCQueue<int> m_OrderQueue;
+	int m_NumOfPackets;
+	int m_NumOfFiles;
+
+	template<typename T>
+	static void pushWait(pcpp::SPSCQueue<T>& queue, const T& element)
+	{
+		while (!queue.push(element))
+			sched_yield();
+	}
+
+	template<typename T>
+	static T popWait(pcpp::SPSCQueue<T>& queue)
+	{
+		T element;
+		while (!queue.pop(element))
+			sched_yield();
+		return element;
+	}
+
+	Slot* getFreeSlot()
+	{
+		// when the reader runs out of slots it waits for the writers to return some
+		while (m_FreeSlots.empty())
+		{
+			for (size_t i = 0; i < m_Writers.size(); i++)
+			{
+				Slot* slot;
+				while (m_Writers[i]->returnQueue->pop(slot))
+					m_FreeSlots.push_back(slot);
+			}
+
+			if (m_FreeSlots.empty())
+				sched_yield();
+		}
+
+		Slot* slot = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+		return slot;
+	}
+
+	bool startThreads(std::vector<pthread_t>& threads)
+	{
+		pthread_t thread;
+		for (size_t i = 0; i < m_Writers.size(); i++)
+		{
+			if (pthread_create(&thread, NULL, writerThreadMain, m_Writers[i]) != 0)
+				return false;
+			threads.push_back(thread);
+		}
+
+		if (pthread_create(&thread, NULL, classifierThreadMain, this) != 0)
+			return false;
+		threads.push_back(thread);
+
+		for (size_t i = 0; i < m_Workers.size(); i++)
+		{
+			if (pthread_create(&thread, NULL, workerThreadMain, m_Workers[i]) != 0)
+				return false;
+			threads.push_back(thread);
+		}
+
+		return true;
+	}
+
+	static void* workerThreadMain(void* workerPtr)
+	{
+		Worker* worker = (Worker*)workerPtr;
+		Slot* slot;
+		while ((slot = popWait(*worker->inQueue)) != NULL)
+		{
+			slot->parsedPacket.setRawPacket(&slot->rawPacket, false);
+			pushWait(*worker->outQueue, slot);
+		}
+
+		return NULL;
+	}
+
+	static void* classifierThreadMain(void* pipelinePtr)
+	{
+		SplitterPipeline* pipeline = (SplitterPipeline*)pipelinePtr;
+		std::set<int> knownFiles;
+		std::vector<int> filesToClose;
+		int workerIndex;
+		while ((workerIndex = popWait(pipeline->m_OrderQueue)) >= 0)
+		{
+			Slot* slot = popWait(*pipeline->m_Workers[workerIndex]->outQueue);
+
+			// the writers keep a bounded number of files open by themselves, so the files the splitter wants to close don't matter
+			filesToClose.clear();
+			slot->fileNumber = pipeline->m_Splitter->getFileNumber(slot->parsedPacket, filesToClose);
+			slot->newFileName.clear();
+			if (knownFiles.insert(slot->fileNumber).second)
+			{
+				slot->newFileName = pipeline->m_Splitter->getFileName(slot->parsedPacket, pipeline->m_OutputPcapBasePath, slot->fileNumber) +
+						pipeline->m_OutputFileExtension;
+				pipeline->m_NumOfFiles++;
+			}
+
+			pushWait(*pipeline->m_Writers[slot->fileNumber % pipeline->m_Writers.size()]->inQueue, slot);
+		}
+
+		for (size_t i = 0; i < pipeline->m_Writers.size(); i++)
+			pushWait(*pipeline->m_Writers[i]->inQueue, (Slot*)NULL);
+
+		return NULL;
+	}
+
+	static void* writerThreadMain(void* writerPtr)
+	{
+		Writer* writer = (Writer*)writerPtr;
+		std::map<int, int> fileIds;
+		Slot* slot;
+		while ((slot = popWait(*writer->inQueue)) != NULL)
+		{
+			if (!slot->newFileName.empty())
+				fileIds[slot->fileNumber] = writer->fileWriter.addFile(slot->newFileName, slot->rawPacket.getLinkLayerType());
+
+			if (!writer->fileWriter.writePacket(fileIds[slot->fileNumber], slot->rawPacket))
+				writer->result = false;
+
+			pushWait(*writer->returnQueue, slot);
+		}
+
+		if (!writer->fileWriter.close())
+			writer->result = false;
+
+		return NULL;
+	}
+
+	// disable copy c'tor and assignment operator
+	SplitterPipeline(const SplitterPipeline& other);
+	SplitterPipeline& operator=(const SplitterPipeline& other);
+};
@@ -53,9 +53,12 @@
 #include <RawPacket.h>
 #include <Packet.h>
 #include <PcapFileDevice.h>
+#include <MultiFileWriter.h>
+#include <BenchmarkHarness.h>
 #include "SimpleSplitters.h"
 #include "IPPortSplitters.h"
 #include "ConnectionSplitters.h"
+#include "SplitterPipeline.h"
 #include <getopt.h>
 #include <SystemUtils.h>
 #include <PcapPlusPlusVersion.h>
@@ -70,6 +73,8 @@ static struct option PcapSplitterOptions[] =
 	{"method", required_argument, 0, 'm'},
 	{"param", required_argument, 0, 'p'},
 	{"filter", required_argument, 0, 'i'},
+	{"workers", required_argument, 0, 'w'},
+	{"writers", required_argument, 0, 'r'},
 	{"help", no_argument, 0, 'h'},
 	{"version", no_argument, 0, 'v'},
     {0, 0, 0, 0}
@@ -106,7 +111,8 @@ void printUsage()
 {
 	printf("\nUsage:\n"
 			"-------\n"
-			"%s [-h] [-v] [-i filter] -f pcap_file -o output_dir -m split_method [-p split_param]\n"
+			"%s [-h] [-v] [-i filter] [-w num_of_workers [-r num_of_writers]] -f pcap_file -o output_dir -m split_method [-p split_param]\n"
+			"%s [-i filter] --benchmark[=ITERATIONS] -f pcap_file -m split_method [-p split_param]\n"
 			"\nOptions:\n\n"
 			"    -f pcap_file    : Input pcap file name\n"
 			"    -o output_dir   : The directory where the output files shall be written\n"
@@ -146,8 +152,15 @@ void printUsage()
 			"                      'method = bpf-filter'   => split-param is the BPF filter to match upon\n"
 			"                      'method = round-robin'  => split-param is number of files to round-robin packets between\n"
 			"    -i filter       : Apply a BPF filter, meaning only filtered packets will be counted in the split\n"
+			"    -w workers      : Split on several threads: the number of threads parsing the packets, which are spread\n"
+			"                      between them by flow. The output files are the same as when splitting on one thread.\n"
+			"                      Supported for pcap input files only. If not provided the file is split on one thread\n"
+			"    -r writers      : The number of threads writing the output files when -w is set. The default is 1\n"
 			"    -v              : Displays the current version and exists\n"
-			"    -h              : Displays this help message and exits\n", AppName::get().c_str());
+			"    -h              : Displays this help message and exits\n"
+			"%s"
+			"\nIn benchmark mode the output file of every packet is found but no files are written\n",
+			AppName::get().c_str(), AppName::get().c_str(), BenchmarkHarness::getUsage());
 	exit(0);
 }
 
@@ -203,6 +216,101 @@ std::string getFileNameWithoutExtension(const std::string& path)
 	return("");
 }
 
+/**
+ * Create the splitter of a split method
+ * @return The splitter or NULL if the method is unknown
+ */
+Splitter* createSplitter(const std::string& method, const char* param, bool paramWasSet)
+{
+	if (method == SPLIT_BY_FILE_SIZE)
+	{
+		uint64_t paramAsUint64 = (paramWasSet ? strtoull(param, NULL, 10) : 0);
+		return new FileSizeSplitter(paramAsUint64);
+	}
+	else if (method == SPLIT_BY_PACKET_COUNT)
+	{
+		int paramAsInt = (paramWasSet ? atoi(param) : 0);
+		return new PacketCountSplitter(paramAsInt);
+	}
+	else if (method == SPLIT_BY_IP_CLIENT)
+	{
+		int paramAsInt = (paramWasSet ? atoi(param) : SplitterWithMaxFiles::UNLIMITED_FILES_MAGIC_NUMBER);
+		return new ClientIPSplitter(paramAsInt);
+	}
+	else if (method == SPLIT_BY_IP_SERVER)
+	{
+		int paramAsInt = (paramWasSet ? atoi(param) : SplitterWithMaxFiles::UNLIMITED_FILES_MAGIC_NUMBER);
+		return new ServerIPSplitter(paramAsInt);
+	}
+	else if (method == SPLIT_BY_SERVER_PORT)
+	{
+		int paramAsInt = (paramWasSet ? atoi(param) : SplitterWithMaxFiles::UNLIMITED_FILES_MAGIC_NUMBER);
+		return new ServerPortSplitter(paramAsInt);
+	}
+	else if (method == SPLIT_BY_2_TUPLE)
+	{
+		int paramAsInt = (paramWasSet ? atoi(param) : SplitterWithMaxFiles::UNLIMITED_FILES_MAGIC_NUMBER);
+		return new TwoTupleSplitter(paramAsInt);
+	}
+	else if (method == SPLIT_BY_5_TUPLE)
+	{
+		int paramAsInt = (paramWasSet ? atoi(param) : SplitterWithMaxFiles::UNLIMITED_FILES_MAGIC_NUMBER);
+		return new FiveTupleSplitter(paramAsInt);
+	}
+	else if (method == SPLIT_BY_BPF_FILTER)
+	{
+		return new BpfCriteriaSplitter(std::string(param));
+	}
+	else if (method == SPLIT_BY_ROUND_ROBIN)
+	{
+		int paramAsInt = (paramWasSet ? atoi(param) : 0);
+		return new RoundRobinSplitter(paramAsInt);
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Benchmark mode: read the packets of the input file into memory and find the output file of each packet several times, without
+ * writing any files
+ */
+void benchmarkSplitter(const std::string& inputPcapFileName, const std::string& filter, const std::string& method, const char* param,
+		bool paramWasSet, const BenchmarkConfiguration& benchmarkConfig)
+{
+	BenchmarkHarness harness(AppName::get(), benchmarkConfig);
+
+	BPFStringFilter bpfFilter(filter);
+	if (!harness.loadFile(inputPcapFileName, (filter != "" ? &bpfFilter : NULL)))
+		EXIT_WITH_ERROR("Error reading input pcap file");
+
+	int parseStage = harness.addStage("parse");
+	int splitStage = harness.addStage("split");
+
+	std::vector<int> filesToClose;
+	while (harness.startIteration())
+	{
+		// splitters keep state, so every iteration starts with a new one
+		Splitter* splitter = createSplitter(method, param, paramWasSet);
+		for (size_t i = 0; i < harness.getNumOfPackets(); i++)
+		{
+			harness.beginStage(parseStage);
+			Packet parsedPacket(harness.getPacket(i));
+			harness.endStage(parseStage);
+
+			harness.beginStage(splitStage);
+			filesToClose.clear();
+			splitter->getFileNumber(parsedPacket, filesToClose);
+			harness.endStage(splitStage);
+		}
+		harness.endIteration();
+		delete splitter;
+	}
+
+	harness.printReport();
+}
+
+
 /**
  * main method of this utility
  */
@@ -222,10 +330,18 @@ int main(int argc, char* argv[])
 
 	bool paramWasSet = false;
 
+	int numOfWorkers = 0;
+	int numOfWriters = 1;
+
+	// the benchmark options are removed from the command line before it's parsed
+	BenchmarkConfiguration benchmarkConfig;
+	if (!BenchmarkHarness::extractOptions(argc, argv, benchmarkConfig))
+		EXIT_WITH_ERROR("Invalid benchmark option");
+
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long (argc, argv, "f:o:m:p:i:vh", PcapSplitterOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "f:o:m:p:i:w:r:vh", PcapSplitterOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -247,6 +363,12 @@ int main(int argc, char* argv[])
 			case 'i':
 				filter = optarg;
 				break;
+			case 'w':
+				numOfWorkers = atoi(optarg);
+				break;
+			case 'r':
+				numOfWriters = atoi(optarg);
+				break;
 			case 'h':
 				printUsage();
 				break;
@@ -264,12 +386,12 @@ int main(int argc, char* argv[])
 		EXIT_WITH_ERROR("Input file name was not given");
 	}
 
-	if (outputPcapDir == "")
+	if (outputPcapDir == "" && !benchmarkConfig.enabled)
 	{
 		EXIT_WITH_ERROR("Output directory name was not given");
 	}
 
-	if (!pcpp::directoryExists(outputPcapDir))
+	if (!benchmarkConfig.enabled && !pcpp::directoryExists(outputPcapDir))
 	{
 		EXIT_WITH_ERROR("Output directory doesn't exist");
 	}
@@ -279,54 +401,14 @@ int main(int argc, char* argv[])
 		EXIT_WITH_ERROR("Split method was not given");
 	}
 
-	Splitter* splitter = NULL;
-
-	// decide of the splitter to use, according to the user's choice
-	if (method == SPLIT_BY_FILE_SIZE)
+	if (numOfWorkers < 0 || numOfWriters <= 0)
 	{
-		uint64_t paramAsUint64 = (paramWasSet ? strtoull(param, NULL, 10) : 0);
-		splitter = new FileSizeSplitter(paramAsUint64);
+		EXIT_WITH_ERROR("Number of workers and writers must be positive numbers");
 	}
-	else if (method == SPLIT_BY_PACKET_COUNT)
-	{
-		int paramAsInt = (paramWasSet ? atoi(param) : 0);
-		splitter = new PacketCountSplitter(paramAsInt);
-	}
-	else if (method == SPLIT_BY_IP_CLIENT)
-	{
-		int paramAsInt = (paramWasSet ? atoi(param) : SplitterWithMaxFiles::UNLIMITED_FILES_MAGIC_NUMBER);
-		splitter = new ClientIPSplitter(paramAsInt);
-	}
-	else if (method == SPLIT_BY_IP_SERVER)
-	{
-		int paramAsInt = (paramWasSet ? atoi(param) : SplitterWithMaxFiles::UNLIMITED_FILES_MAGIC_NUMBER);
-		splitter = new ServerIPSplitter(paramAsInt);
-	}
-	else if (method == SPLIT_BY_SERVER_PORT)
-	{
-		int paramAsInt = (paramWasSet ? atoi(param) : SplitterWithMaxFiles::UNLIMITED_FILES_MAGIC_NUMBER);
-		splitter = new ServerPortSplitter(paramAsInt);
-	}
-	else if (method == SPLIT_BY_2_TUPLE)
-	{
-		int paramAsInt = (paramWasSet ? atoi(param) : SplitterWithMaxFiles::UNLIMITED_FILES_MAGIC_NUMBER);
-		splitter = new TwoTupleSplitter(paramAsInt);
-	}
-	else if (method == SPLIT_BY_5_TUPLE)
-	{
-		int paramAsInt = (paramWasSet ? atoi(param) : SplitterWithMaxFiles::UNLIMITED_FILES_MAGIC_NUMBER);
-		splitter = new FiveTupleSplitter(paramAsInt);
-	}
-	else if (method == SPLIT_BY_BPF_FILTER)
-	{
-		splitter = new BpfCriteriaSplitter(std::string(param));
-	}
-	else if (method == SPLIT_BY_ROUND_ROBIN)
-	{
-		int paramAsInt = (paramWasSet ? atoi(param) : 0);
-		splitter = new RoundRobinSplitter(paramAsInt);
-	}
-	else
+
+	// decide of the splitter to use, according to the user's choice
+	Splitter* splitter = createSplitter(method, param, paramWasSet);
+	if (splitter == NULL)
 		EXIT_WITH_ERROR("Unknown method '%s'", method.c_str());
 
 
@@ -337,6 +419,13 @@ int main(int argc, char* argv[])
 		EXIT_WITH_ERROR("%s", errorStr.c_str());
 	}
 
+	if (benchmarkConfig.enabled)
+	{
+		delete splitter;
+		benchmarkSplitter(inputPcapFileName, filter, method, param, paramWasSet, benchmarkConfig);
+		return 0;
+	}
+
 	// prepare the output file format: /requested-path/original-file-name-[4-digit-number-starting-at-0000].pcap
 	std::string outputPcapFileName = outputPcapDir + std::string(1, SEPARATOR) + getFileNameWithoutExtension(inputPcapFileName) + "-";
 
@@ -361,6 +450,23 @@ int main(int argc, char* argv[])
 	// determine output file extension
 	std::string outputFileExtenison = (isReaderPcapng ? ".pcapng" : ".pcap");
 
+	// split a pcap file on several threads
+	if (numOfWorkers > 0 && !isReaderPcapng)
+	{
+		SplitterPipeline pipeline(splitter, outputPcapFileName, outputFileExtenison, numOfWorkers, numOfWriters);
+		if (!pipeline.run(reader))
+			printf("Some of the output files couldn't be written\n");
+
+		std::cout << "Finished. Read and written " << pipeline.getNumOfPackets() << " packets to " << pipeline.getNumOfFiles() << " files" << std::endl;
+
+		reader->close();
+		delete reader;
+		return 0;
+	}
+
+	if (numOfWorkers > 0)
+		printf("pcapng files are split on one thread\n");
+
 	int packetCountSoFar = 0;
 	int numOfFiles = 0;
 	RawPacket rawPacket;
@@ -368,6 +474,11 @@ int main(int argc, char* argv[])
 	// prepare a map of file number to IFileWriterDevice
 	std::map<int, IFileWriterDevice*> outputFiles;
 
+	// pcap output files are written by a MultiFileWriter, which buffers the packets of all files in memory and limits the number of
+	// open files by itself, so a file is opened for a few large writes rather than for every few packets. This map holds its file IDs
+	MultiFileWriter pcapWriter;
+	std::map<int, int> pcapFileIds;
+
 	// read all packets from input file, for each packet do:
 	while (reader->getNextPacket(rawPacket))
 	{
@@ -379,6 +490,23 @@ int main(int argc, char* argv[])
 		// call the splitter to get the file number to write the current packet to
 		int fileNum = splitter->getFileNumber(parsedPacket, filesToClose);
 
+		// the files the splitter wants to close don't matter for the MultiFileWriter, which closes files as needed
+		if (!isReaderPcapng)
+		{
+			std::map<int, int>::iterator fileIdIter = pcapFileIds.find(fileNum);
+			if (fileIdIter == pcapFileIds.end())
+			{
+				std::string fileName = splitter->getFileName(parsedPacket, outputPcapFileName, fileNum) + outputFileExtenison;
+				int fileId = pcapWriter.addFile(fileName, rawPacket.getLinkLayerType());
+				fileIdIter = pcapFileIds.insert(std::pair<int, int>(fileNum, fileId)).first;
+				numOfFiles++;
+			}
+
+			pcapWriter.writePacket(fileIdIter->second, rawPacket);
+			packetCountSoFar++;
+			continue;
+		}
+
 		// if file number is seen for the first time (meaning it's the first packet written to it)
 		if (outputFiles.find(fileNum) == outputFiles.end())
 		{
@@ -449,6 +577,10 @@ int main(int argc, char* argv[])
 		packetCountSoFar++;
 	}
 
+	// write the packets still buffered and close the pcap files
+	if (!pcapWriter.close())
+		printf("Some of the output files couldn't be written\n");
+
 	std::cout << "Finished. Read and written " << packetCountSoFar << " packets to " << numOfFiles << " files" << std::endl;
 
 	// close the reader file
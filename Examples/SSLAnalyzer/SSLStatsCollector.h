@@ -7,7 +7,9 @@
 #include "PayloadLayer.h"
 #include "PacketUtils.h"
 #include "SSLLayer.h"
+#include "ProtocolRegistry.h"
 #include "SystemUtils.h"
+#include "HashCounters.h"
 
 
 /**
@@ -36,7 +38,7 @@ struct SSLGeneralStats
 	int numOfHandshakeCompleteFlows; // number of flows which handshake was complete
 	int numOfFlowsWithAlerts; // number of flows that were terminated because of SSL/TLS alert
 	std::map<pcpp::SSLVersion, int> sslRecordVersionCount; // number of flows per SSL/TLS record version
-	std::map<uint16_t, int> sslPortCount; // number of flows per TCP port
+	pcpp::HashCounter sslPortCount; // number of flows per TCP port
 
 	void clear()
 	{
@@ -67,7 +69,7 @@ struct ClientHelloStats
 {
 	int numOfMessages; // total number of client-hello messages
 	Rate messageRate; // rate of client-hello messages
-	std::map<std::string, int> serverNameCount; // a map for counting the server names seen in traffic
+	pcpp::StringCounter serverNameCount; // counts the server names seen in traffic
 	std::map<pcpp::SSLVersion, int> sslClientHelloVersionCount; // number of flows per SSL handshake version
 
 	virtual ~ClientHelloStats() {}
@@ -89,7 +91,7 @@ struct ServerHelloStats
 {
 	int numOfMessages; // total number of server-hello messages
 	Rate messageRate; // rate of server-hello messages
-	std::map<std::string, int> cipherSuiteCount; // count of the different chosen cipher-suites
+	pcpp::HashCounter cipherSuiteCount; // count of the different chosen cipher-suites by their ID
 
 	virtual ~ServerHelloStats() {}
 
@@ -104,7 +106,10 @@ struct ServerHelloStats
 
 
 /**
- * The SSL stats collector. Should be called for every packet arriving and also periodically to calculate rates
+ * The SSL stats collector. Should be called for every packet arriving and also periodically to calculate rates.
+ * Server names are counted in an interned string table and ports and cipher-suites in open-addressing counters, so nothing is
+ * allocated for values which were already seen. Each capture thread should have its own collector, and the collectors are merged when
+ * stats are reported
  */
 class SSLStatsCollector
 {
@@ -112,9 +117,13 @@ public:
 
 	/**
 	 * C'tor - clear all structures
+	 * @param[in] maxNumOfServerNames The max number of server names to count individually. When more are seen only the most frequent
+	 * ones are kept and their counts become upper bounds, so memory stays bounded on long captures. The default is 0 which means all of
+	 * them are counted exactly
 	 */
-	SSLStatsCollector()
+	SSLStatsCollector(size_t maxNumOfServerNames = 0)
 	{
+		m_ClientHelloStats.serverNameCount = pcpp::StringCounter(maxNumOfServerNames);
 		clear();
 	}
 
@@ -128,12 +137,12 @@ public:
 			return;
 
 		// collect general SSL traffic stats on this packet
-		uint32_t hashVal = collectSSLTrafficStats(sslPacket);
+		SSLFlowData& flowData = collectSSLTrafficStats(sslPacket);
 
 		// if packet contains one or more SSL messages, collect stats on them
 		if (sslPacket->isPacketOfType(pcpp::SSL))
 		{
-			collectSSLStats(sslPacket, hashVal);
+			collectSSLStats(sslPacket, flowData);
 		}
 
 		// calculate current sample time which is the time-span from start time until current time
@@ -158,8 +167,8 @@ public:
 			m_GeneralStats.sslTrafficRate.currentRate = (m_GeneralStats.amountOfSSLTraffic - m_PrevGeneralStats.amountOfSSLTraffic) / diffSec;
 			m_GeneralStats.sslPacketRate.currentRate = (m_GeneralStats.numOfSSLPackets - m_PrevGeneralStats.numOfSSLPackets) / diffSec;
 			m_GeneralStats.sslFlowRate.currentRate = (m_GeneralStats.numOfSSLFlows - m_PrevGeneralStats.numOfSSLFlows) / diffSec;
-			m_ClientHelloStats.messageRate.currentRate = (m_ClientHelloStats.numOfMessages - m_PrevClientHelloStats.numOfMessages) / diffSec;
-			m_ServerHelloStats.messageRate.currentRate = (m_ServerHelloStats.numOfMessages - m_PrevServerHelloStats.numOfMessages) / diffSec;
+			m_ClientHelloStats.messageRate.currentRate = (m_ClientHelloStats.numOfMessages - m_PrevNumOfClientHellos) / diffSec;
+			m_ServerHelloStats.messageRate.currentRate = (m_ServerHelloStats.numOfMessages - m_PrevNumOfServerHellos) / diffSec;
 		}
 
 		// getting the time from the beginning of stats collection until now
@@ -176,10 +185,11 @@ public:
 			m_ServerHelloStats.messageRate.totalRate = m_ServerHelloStats.numOfMessages / diffSecTotal;
 		}
 
-		// saving current numbers for using them in the next rate calculation
+		// saving current numbers for using them in the next rate calculation. Only the message numbers of the client-hello and
+		// server-hello stats are needed, so their counters aren't copied
 		m_PrevGeneralStats = m_GeneralStats;
-		m_PrevClientHelloStats = m_ClientHelloStats;
-		m_PrevServerHelloStats = m_ServerHelloStats;
+		m_PrevNumOfClientHellos = m_ClientHelloStats.numOfMessages;
+		m_PrevNumOfServerHellos = m_ServerHelloStats.numOfMessages;
 
 		// saving the current time for using in the next rate calculation
 		m_LastCalcRateTime = curTime;
@@ -193,13 +203,55 @@ public:
 		m_GeneralStats.clear();
 		m_PrevGeneralStats.clear();
 		m_ClientHelloStats.clear();
-		m_PrevClientHelloStats.clear();
+		m_PrevNumOfClientHellos = 0;
 		m_ServerHelloStats.clear();
-		m_PrevServerHelloStats.clear();
+		m_PrevNumOfServerHellos = 0;
+		m_FlowTable.clear();
 		m_LastCalcRateTime = getCurTime();
 		m_StartTime = m_LastCalcRateTime;
 	}
 
+	/**
+	 * Add the stats of another collector to this one, for example the collector of another capture thread. Flows are identified by
+	 * their hash, so the collectors are expected to see different flows. Current rates aren't merged, calcRates() should be called
+	 * after merging
+	 */
+	void merge(const SSLStatsCollector& other)
+	{
+		m_GeneralStats.numOfSSLFlows += other.m_GeneralStats.numOfSSLFlows;
+		m_GeneralStats.numOfSSLPackets += other.m_GeneralStats.numOfSSLPackets;
+		m_GeneralStats.amountOfSSLTraffic += other.m_GeneralStats.amountOfSSLTraffic;
+		m_GeneralStats.numOfHandshakeCompleteFlows += other.m_GeneralStats.numOfHandshakeCompleteFlows;
+		m_GeneralStats.numOfFlowsWithAlerts += other.m_GeneralStats.numOfFlowsWithAlerts;
+		mergeVersionCounts(m_GeneralStats.sslRecordVersionCount, other.m_GeneralStats.sslRecordVersionCount);
+		m_GeneralStats.sslPortCount.merge(other.m_GeneralStats.sslPortCount);
+
+		m_ClientHelloStats.numOfMessages += other.m_ClientHelloStats.numOfMessages;
+		m_ClientHelloStats.serverNameCount.merge(other.m_ClientHelloStats.serverNameCount);
+		mergeVersionCounts(m_ClientHelloStats.sslClientHelloVersionCount, other.m_ClientHelloStats.sslClientHelloVersionCount);
+
+		m_ServerHelloStats.numOfMessages += other.m_ServerHelloStats.numOfMessages;
+		m_ServerHelloStats.cipherSuiteCount.merge(other.m_ServerHelloStats.cipherSuiteCount);
+
+		std::vector<std::pair<uint64_t, SSLFlowData> > flows;
+		other.m_FlowTable.getEntries(flows);
+		m_FlowTable.reserve(m_FlowTable.size() + flows.size());
+		for (size_t i = 0; i < flows.size(); i++)
+			m_FlowTable[flows[i].first] = flows[i].second;
+
+		// the merged stats span from the earliest start time
+		if (other.m_StartTime < m_StartTime)
+			m_StartTime = other.m_StartTime;
+		if (other.m_GeneralStats.sampleTime > m_GeneralStats.sampleTime)
+			m_GeneralStats.sampleTime = other.m_GeneralStats.sampleTime;
+
+		if (m_FlowTable.size() != 0)
+		{
+			m_GeneralStats.averageAmountOfDataPerFlow = (double)m_GeneralStats.amountOfSSLTraffic / (double)m_FlowTable.size();
+			m_GeneralStats.averageNumOfPacketsPerFlow = (double)m_GeneralStats.numOfSSLPackets / (double)m_FlowTable.size();
+		}
+	}
+
 	/**
 	 * Get SSL general stats
 	 */
@@ -233,11 +285,20 @@ private:
 	};
 
 
+	/**
+	 * Add the version counts of another collector
+	 */
+	static void mergeVersionCounts(std::map<pcpp::SSLVersion, int>& counts, const std::map<pcpp::SSLVersion, int>& otherCounts)
+	{
+		for (std::map<pcpp::SSLVersion, int>::const_iterator iter = otherCounts.begin(); iter != otherCounts.end(); iter++)
+			counts[iter->first] += iter->second;
+	}
+
 	/**
 	 * Collect stats relevant for every SSL packet (any SSL message)
-	 * This method calculates and returns the flow key for this packet
+	 * This method finds the flow of this packet in the flow table (or adds it) and returns its data
 	 */
-	uint32_t collectSSLTrafficStats(pcpp::Packet* sslpPacket)
+	SSLFlowData& collectSSLTrafficStats(pcpp::Packet* sslpPacket)
 	{
 		pcpp::TcpLayer* tcpLayer = sslpPacket->getLayerOfType<pcpp::TcpLayer>();
 
@@ -250,21 +311,22 @@ private:
 		// calculate a hash key for this flow to be used in the flow table
 		uint32_t hashVal = hash5Tuple(sslpPacket);
 
-		// if flow is a new flow (meaning it's not already in the flow table)
-		if (m_FlowTable.find(hashVal) == m_FlowTable.end())
+		// find the flow with a single lookup. If flow is a new flow (meaning it's not already in the flow table) count it
+		bool isNewFlow = false;
+		SSLFlowData& flowData = m_FlowTable.get(hashVal, &isNewFlow);
+		if (isNewFlow)
 		{
-			// count this new flow
 			m_GeneralStats.numOfSSLFlows++;
 
 			// find the SSL/TLS port and add it to the port count
 			uint16_t srcPort = ntohs(tcpLayer->getTcpHeader()->portSrc);
 			uint16_t dstPort = ntohs(tcpLayer->getTcpHeader()->portDst);
-			if (pcpp::SSLLayer::getSSLPortMap()->find(srcPort) != pcpp::SSLLayer::getSSLPortMap()->end())
-				m_GeneralStats.sslPortCount[srcPort]++;
+			if (pcpp::ProtocolRegistry::getInstance().isPortOfProtocol(srcPort, pcpp::SSL))
+				m_GeneralStats.sslPortCount.add(srcPort);
 			else
-				m_GeneralStats.sslPortCount[dstPort]++;
+				m_GeneralStats.sslPortCount.add(dstPort);
 
-			m_FlowTable[hashVal].clear();
+			flowData.clear();
 		}
 
 		// calculate averages
@@ -274,13 +336,13 @@ private:
 			m_GeneralStats.averageNumOfPacketsPerFlow = (double)m_GeneralStats.numOfSSLPackets / (double)m_FlowTable.size();
 		}
 
-		return hashVal;
+		return flowData;
 	}
 
 	/**
 	 * Collect stats relevant for several kinds SSL messages
 	 */
-	void collectSSLStats(pcpp::Packet* sslPacket, uint32_t flowKey)
+	void collectSSLStats(pcpp::Packet* sslPacket, SSLFlowData& flowData)
 	{
 		// go over all SSL messages in this packet
 		pcpp::SSLLayer* sslLayer = sslPacket->getLayerOfType<pcpp::SSLLayer>();
@@ -291,10 +353,10 @@ private:
 			if (recType == pcpp::SSL_ALERT)
 			{
 				// if it's the first alert seen in this flow
-				if (m_FlowTable[flowKey].seenAlertPacket == false)
+				if (flowData.seenAlertPacket == false)
 				{
 					m_GeneralStats.numOfFlowsWithAlerts++;
-					m_FlowTable[flowKey].seenAlertPacket = true;
+					flowData.seenAlertPacket = true;
 				}
 			}
 
@@ -302,10 +364,10 @@ private:
 			else if (recType == pcpp::SSL_APPLICATION_DATA)
 			{
 				// if it's the first app data message seen on this flow it means handshake was completed
-				if (m_FlowTable[flowKey].seenAppDataPacket == false)
+				if (flowData.seenAppDataPacket == false)
 				{
 					m_GeneralStats.numOfHandshakeCompleteFlows++;
-					m_FlowTable[flowKey].seenAppDataPacket = true;
+					flowData.seenAppDataPacket = true;
 				}
 			}
 
@@ -348,9 +410,22 @@ private:
 	{
 		m_ClientHelloStats.numOfMessages++;
 
-		pcpp::SSLServerNameIndicationExtension* sniExt = clientHelloMessage->getExtensionOfType<pcpp::SSLServerNameIndicationExtension>();
-		if (sniExt != NULL)
-			m_ClientHelloStats.serverNameCount[sniExt->getHostName()]++;
+		// the server name is counted directly from the extension data, which is a list length (2 bytes), a name type (1 byte), a name
+		// length (2 bytes) and the name
+		for (pcpp::SSLExtensionIterator iter = clientHelloMessage->getExtensionIterator(); iter.isValid(); iter.next())
+		{
+			if (iter.getTypeAsInt() != pcpp::SSL_EXT_SERVER_NAME)
+				continue;
+
+			const uint8_t* extData = iter.getData();
+			if (iter.getLength() >= 5)
+			{
+				size_t nameLength = (extData[3] << 8) | extData[4];
+				if (nameLength <= (size_t)iter.getLength() - 5)
+					m_ClientHelloStats.serverNameCount.add((const char*)extData + 5, nameLength);
+			}
+			break;
+		}
 	}
 
 	/**
@@ -362,7 +437,7 @@ private:
 
 		pcpp::SSLCipherSuite* cipherSuite = serverHelloMessage->getCipherSuite();
 		if (cipherSuite != NULL)
-			m_ServerHelloStats.cipherSuiteCount[cipherSuite->asString()]++;
+			m_ServerHelloStats.cipherSuiteCount.add(cipherSuite->getID());
 	}
 
 	double getCurTime(void)
@@ -377,11 +452,11 @@ private:
 	SSLGeneralStats m_GeneralStats;
 	SSLGeneralStats m_PrevGeneralStats;
 	ClientHelloStats m_ClientHelloStats;
-	ClientHelloStats m_PrevClientHelloStats;
+	int m_PrevNumOfClientHellos;
 	ServerHelloStats m_ServerHelloStats;
-	ServerHelloStats m_PrevServerHelloStats;
+	int m_PrevNumOfServerHellos;
 
-	std::map<uint32_t, SSLFlowData> m_FlowTable;
+	pcpp::FlatHashMap<SSLFlowData> m_FlowTable;
 
 	double m_LastCalcRateTime;
 	double m_StartTime;
@@ -14,6 +14,10 @@
  * - SSL/TLS versions map (which SSL/TLS versions were used and how much)
  * - SSL/TLS ports map (which SSL/TLS TCP ports were used and how much)
  *
+ * Both modes can run the analysis on several threads (see the -t option). Packets are distributed between the threads by flow, so each
+ * thread keeps its own collector and flow table without sharing them, and the collectors are merged when the summary is printed.
+ * In live traffic mode packets can also be captured with PF_RING or DPDK if PcapPlusPlus was built with them.
+ *
  * For more details about modes of operation and parameters run SSLAnalyzer -h
  */
 
@@ -26,6 +30,16 @@
 #include "PcapLiveDeviceList.h"
 #include "PcapFilter.h"
 #include "PcapFileDevice.h"
+#include "PrefetchingFileReader.h"
+#include "BenchmarkHarness.h"
+#include "FlowDispatcher.h"
+#include "StatsReporter.h"
+#ifdef USE_PF_RING
+#include "PfRingDeviceList.h"
+#endif
+#ifdef USE_DPDK
+#include "DpdkDeviceList.h"
+#endif
 #include "SSLStatsCollector.h"
 #include "TablePrinter.h"
 #include "PlatformSpecificUtils.h"
@@ -57,6 +71,9 @@ using namespace pcpp;
 
 #define DEFAULT_CALC_RATES_PERIOD_SEC 2
 
+#define DPDK_MBUF_POOL_SIZE 16383
+#define DPDK_RECEIVE_BURST_SIZE 64
+
 static struct option SSLAnalyzerOptions[] =
 {
 	{"interface",  required_argument, 0, 'i'},
@@ -64,6 +81,10 @@ static struct option SSLAnalyzerOptions[] =
 	{"output-file", required_argument, 0, 'o'},
 	{"rate-calc-period", required_argument, 0, 'r'},
 	{"disable-rates-print", no_argument, 0, 'd'},
+	{"top-k", required_argument, 0, 'k'},
+	{"threads", required_argument, 0, 't'},
+	{"pf-ring-interface", required_argument, 0, 'p'},
+	{"dpdk-port", required_argument, 0, 'P'},
 	{"list-interfaces", no_argument, 0, 'l'},
 	{"help", no_argument, 0, 'h'},
 	{"version", no_argument, 0, 'v'},
@@ -79,6 +100,94 @@ struct SSLPacketArrivedData
 };
 
 
+/**
+ * The IDs of the counters the analysis threads publish for the rates report of the multi-threaded modes
+ */
+enum SSLRateCounterId
+{
+	SSLPacketsCounter,
+	SSLFlowsCounter,
+	SSLDataCounter,
+	ClientHellosCounter,
+	ServerHellosCounter,
+	NumOfSSLRateCounters
+};
+
+
+/**
+ * The data of a single analysis thread in the multi-threaded modes. The packets are distributed between the threads by flow, so each
+ * thread owns a shard of the flow table in its own collector
+ */
+struct SSLWorkerData
+{
+	SSLStatsCollector* statsCollector;
+	StatsCounters* rateCounters;
+	int workerId;
+};
+
+
+/**
+ * The analysis threads of the multi-threaded modes. Each thread updates only its own collector, and publishes its message and
+ * traffic counters to a shared StatsCounters instance so the rates can be reported without stopping or locking the threads. The
+ * collectors themselves are merged only after the threads stop
+ */
+class SSLWorkers
+{
+public:
+	SSLWorkers(int numOfWorkers, size_t topK) : m_RateCounters(getRateCounterNames(), numOfWorkers)
+	{
+		for (int i = 0; i < numOfWorkers; i++)
+		{
+			SSLWorkerData worker;
+			worker.statsCollector = new SSLStatsCollector(topK);
+			worker.rateCounters = &m_RateCounters;
+			worker.workerId = i;
+			m_Workers.push_back(worker);
+		}
+	}
+
+	~SSLWorkers()
+	{
+		for (size_t i = 0; i < m_Workers.size(); i++)
+			delete m_Workers[i].statsCollector;
+	}
+
+	SSLWorkerData& getWorker(int workerId) { return m_Workers[workerId]; }
+
+	int getNumOfWorkers() const { return (int)m_Workers.size(); }
+
+	StatsCounters& getRateCounters() { return m_RateCounters; }
+
+	/**
+	 * Merge the collectors of all threads into a single collector. Should be called only after the threads stopped
+	 */
+	void mergeStats(SSLStatsCollector& collector)
+	{
+		for (size_t i = 0; i < m_Workers.size(); i++)
+			collector.merge(*m_Workers[i].statsCollector);
+	}
+
+private:
+	std::vector<SSLWorkerData> m_Workers;
+	StatsCounters m_RateCounters;
+
+	static std::vector<std::string> getRateCounterNames()
+	{
+		std::vector<std::string> names(NumOfSSLRateCounters);
+		names[SSLPacketsCounter] = "SSL packets";
+		names[SSLFlowsCounter] = "SSL flows";
+		names[SSLDataCounter] = "SSL data";
+		names[ClientHellosCounter] = "Client-hello messages";
+		names[ServerHellosCounter] = "Server-hello messages";
+		return names;
+	}
+
+	// disable copy c'tor and assignment operator
+	SSLWorkers(const SSLWorkers& other);
+	SSLWorkers& operator=(const SSLWorkers& other);
+};
+
+
 /**
  * Print application usage
  */
@@ -86,22 +195,38 @@ void printUsage()
 {
 	printf("\nUsage: PCAP file mode:\n"
 			"----------------------\n"
-			"%s [-hv] -f input_file\n"
+			"%s [-hv] [--benchmark[=ITERATIONS]] [-k top_k] [-t threads] -f input_file\n"
 			"\nOptions:\n\n"
 			"    -f           : The input pcap/pcapng file to analyze. Required argument for this mode\n"
+			"    -k top_k     : Count only the top_k most frequent server names, in bounded memory. Their counts may be\n"
+			"                   overestimated. If not provided all of them are counted exactly\n"
+			"    -t threads   : Analyze the file on this number of threads. The packets are distributed between the threads by flow.\n"
+			"                   If not provided the file is analyzed on a single thread\n"
 			"    -v           : Displays the current version and exists\n"
-			"    -h           : Displays this help message and exits\n\n"
+			"    -h           : Displays this help message and exits\n"
+			"%s\n"
 			"Usage: Live traffic mode:\n"
 			"-------------------------\n"
-			"%s [-hvld] [-o output_file] [-r calc_period] -i interface\n"
+			"%s [-hvld] [-o output_file] [-r calc_period] [-k top_k] [-t threads] -i interface\n"
 			"\nOptions:\n\n"
 			"    -i interface   : Use the specified interface. Can be interface name (e.g eth0) or interface IPv4 address\n"
 			"    -o output_file : Save all captured SSL packets to a pcap file. Notice this may cause performance degradation\n"
 			"    -r calc_period : The period in seconds to calculate rates. If not provided default is 2 seconds\n"
+			"    -k top_k       : Count only the top_k most frequent server names, in bounded memory. Their counts may be\n"
+			"                     overestimated. If not provided all of them are counted exactly\n"
+			"    -t threads     : Capture and analyze on this number of threads. The packets are distributed between the threads by flow\n"
+			"                     (by the kernel, the PF_RING RX channels or the DPDK RX queues). Can't be used with -o. If not provided\n"
+			"                     packets are captured and analyzed on a single thread\n"
 			"    -d             : Disable periodic rates calculation\n"
 			"    -v             : Displays the current version and exists\n"
 			"    -h             : Displays this help message and exits\n"
-			"    -l             : Print the list of interfaces and exists\n", AppName::get().c_str(), AppName::get().c_str());
+			"    -l             : Print the list of interfaces and exists\n", AppName::get().c_str(), BenchmarkHarness::getUsage(), AppName::get().c_str());
+#ifdef USE_PF_RING
+	printf("    -p interface   : Capture with PF_RING from the specified interface instead of -i, on an RX channel per thread\n");
+#endif
+#ifdef USE_DPDK
+	printf("    -P port_id     : Capture with DPDK from the specified DPDK port instead of -i, on an RX queue per thread\n");
+#endif
 	exit(0);
 }
 
@@ -156,25 +281,128 @@ void sslPacketArrive(RawPacket* packet, PcapLiveDevice* dev, void* cookie)
 
 
 /**
- * An auxiliary method for sorting the string count map. Used in printServerNames() and in printCipherSuites()
+ * Analyze a packet on an analysis thread of the multi-threaded modes
  */
-bool stringCountComparer(std::pair<std::string, int> first, std::pair<std::string, int> second)
+inline void analyzePacket(RawPacket* packet, SSLWorkerData& worker)
 {
-	return first.second > second.second;
+	Packet parsedPacket(packet);
+	worker.statsCollector->collectStats(&parsedPacket);
+}
+
+
+/**
+ * Publish the counters of an analysis thread for the rates report. The counters are plain stores to the thread's own cache line, so
+ * this is cheap enough to be done after every packet or burst
+ */
+inline void publishRateCounters(SSLWorkerData& worker)
+{
+	SSLStatsCollector& collector = *worker.statsCollector;
+	StatsCounters& counters = *worker.rateCounters;
+	counters.set(worker.workerId, SSLPacketsCounter, collector.getGeneralStats().numOfSSLPackets);
+	counters.set(worker.workerId, SSLFlowsCounter, collector.getGeneralStats().numOfSSLFlows);
+	counters.set(worker.workerId, SSLDataCounter, collector.getGeneralStats().amountOfSSLTraffic);
+	counters.set(worker.workerId, ClientHellosCounter, collector.getClientHelloStats().numOfMessages);
+	counters.set(worker.workerId, ServerHellosCounter, collector.getServerHelloStats().numOfMessages);
 }
 
 
 /**
- * An auxiliary method for sorting the uint16_t count map. Used in printPorts()
+ * packet capture callback of the multi-threaded live traffic mode - called on the capture thread the kernel put the packet's flow on
  */
-bool uint16CountComparer(std::pair<uint16_t, int> first, std::pair<uint16_t, int> second)
+void sslPacketArriveMultiThread(RawPacket* packet, uint8_t threadId, PcapLiveDevice* dev, void* cookie)
 {
-	return first.second > second.second;
+	SSLWorkerData& worker = ((SSLWorkers*)cookie)->getWorker(threadId);
+	analyzePacket(packet, worker);
+	publishRateCounters(worker);
 }
 
 
 /**
- * Print the server-name count map to a table sorted by popularity (most popular names will be first)
+ * FlowDispatcher callback of the multi-threaded file mode - called with a burst of packets of the flows of a worker thread
+ */
+void sslPacketsDispatched(RawPacket* packets, uint32_t numOfPackets, int workerIndex, FlowDispatcher* dispatcher, void* cookie)
+{
+	SSLWorkerData& worker = ((SSLWorkers*)cookie)->getWorker(workerIndex);
+	for (uint32_t i = 0; i < numOfPackets; i++)
+		analyzePacket(&packets[i], worker);
+}
+
+
+#ifdef USE_PF_RING
+/**
+ * PF_RING capture callback - called with a burst of packets on the capture thread of an RX channel. Capture threads are identified by
+ * the core they run on
+ */
+void sslPacketsArrivePfRing(RawPacket* packets, uint32_t numOfPackets, uint8_t threadId, PfRingDevice* device, void* cookie)
+{
+	SSLWorkerData& worker = ((SSLWorkers*)cookie)->getWorker(threadId);
+	for (uint32_t i = 0; i < numOfPackets; i++)
+		analyzePacket(&packets[i], worker);
+	publishRateCounters(worker);
+}
+#endif
+
+
+#ifdef USE_DPDK
+/**
+ * A DPDK worker thread which receives and analyzes the packets of a single RX queue
+ */
+class SSLDpdkWorkerThread : public DpdkWorkerThread
+{
+public:
+	SSLDpdkWorkerThread(DpdkDevice* device, uint16_t rxQueueId, SSLWorkerData& worker) :
+		m_Device(device), m_RxQueueId(rxQueueId), m_Worker(worker), m_Stop(true), m_CoreId(MAX_NUM_OF_CORES+1)
+	{
+	}
+
+	bool run(uint32_t coreId)
+	{
+		m_CoreId = coreId;
+		m_Stop = false;
+
+		// the MBufRawPacket objects are reused by each receive call, so the loop doesn't allocate memory
+		MBufRawPacket* packetArr[DPDK_RECEIVE_BURST_SIZE] = {};
+
+		while (!m_Stop)
+		{
+			uint16_t packetsReceived = m_Device->receivePackets(packetArr, DPDK_RECEIVE_BURST_SIZE, m_RxQueueId);
+			if (packetsReceived == 0)
+				continue;
+
+			for (uint16_t i = 0; i < packetsReceived; i++)
+				analyzePacket(packetArr[i], m_Worker);
+
+			publishRateCounters(m_Worker);
+		}
+
+		for (int i = 0; i < DPDK_RECEIVE_BURST_SIZE; i++)
+			delete packetArr[i];
+
+		return true;
+	}
+
+	void stop()
+	{
+		m_Stop = true;
+	}
+
+	uint32_t getCoreId()
+	{
+		return m_CoreId;
+	}
+
+private:
+	DpdkDevice* m_Device;
+	uint16_t m_RxQueueId;
+	SSLWorkerData& m_Worker;
+	volatile bool m_Stop;
+	uint32_t m_CoreId;
+};
+#endif
+
+
+/**
+ * Print the server-name counts to a table sorted by popularity (most popular names will be first)
  */
 void printServerNames(ClientHelloStats& clientHelloStatsCollector)
 {
@@ -187,14 +415,13 @@ void printServerNames(ClientHelloStats& clientHelloStatsCollector)
 	columnsWidths.push_back(5);
 	TablePrinter printer(columnNames, columnsWidths);
 
-	// sort the server-name count map so the most popular names will be first
-	// since it's not possible to sort a std::map you must copy it to a std::vector and sort it then
-	std::vector<std::pair<std::string, int> > map2vec(clientHelloStatsCollector.serverNameCount.begin(), clientHelloStatsCollector.serverNameCount.end());
-	std::sort(map2vec.begin(),map2vec.end(), &stringCountComparer);
+	// the counter sorts the names so the most popular names will be first
+	std::vector<std::pair<std::string, uint64_t> > sortedCounts;
+	clientHelloStatsCollector.serverNameCount.getSortedCounts(sortedCounts);
 
 	// go over all items (names + count) in the sorted vector and print them
-	for(std::vector<std::pair<std::string, int> >::iterator iter = map2vec.begin();
-			iter != map2vec.end();
+	for(std::vector<std::pair<std::string, uint64_t> >::iterator iter = sortedCounts.begin();
+			iter != sortedCounts.end();
 			iter++)
 	{
 		std::stringstream values;
@@ -244,18 +471,22 @@ void printCipherSuites(ServerHelloStats& serverHelloStats)
 	columnsWidths.push_back(5);
 	TablePrinter printer(columnNames, columnsWidths);
 
-	// sort the cipher-suite count map so the most popular names will be first
-	// since it's not possible to sort a std::map you must copy it to a std::vector and sort it then
-	std::vector<std::pair<std::string, int> > map2vec(serverHelloStats.cipherSuiteCount.begin(), serverHelloStats.cipherSuiteCount.end());
-	std::sort(map2vec.begin(),map2vec.end(), &stringCountComparer);
+	// the counter sorts the cipher-suite IDs so the most popular ones will be first
+	std::vector<std::pair<uint64_t, uint64_t> > sortedCounts;
+	serverHelloStats.cipherSuiteCount.getSortedCounts(sortedCounts);
 
-	// go over all items (names + count) in the sorted vector and print them
-	for(std::vector<std::pair<std::string, int> >::iterator iter = map2vec.begin();
-			iter != map2vec.end();
+	// go over all items (cipher-suite ID + count) in the sorted vector and print them with their names
+	for(std::vector<std::pair<uint64_t, uint64_t> >::iterator iter = sortedCounts.begin();
+			iter != sortedCounts.end();
 			iter++)
 	{
 		std::stringstream values;
-		values << iter->first << "|" << iter->second;
+		SSLCipherSuite* cipherSuite = SSLCipherSuite::getCipherSuiteByID((uint16_t)iter->first);
+		if (cipherSuite != NULL)
+			values << cipherSuite->asString();
+		else
+			values << "0x" << std::hex << iter->first << std::dec;
+		values << "|" << iter->second;
 		printer.printRow(values.str(), '|');
 	}
 }
@@ -272,14 +503,13 @@ void printPorts(SSLGeneralStats& stats)
 	columnsWidths.push_back(5);
 	TablePrinter printer(columnNames, columnsWidths);
 
-	// sort the port count map so the most popular names will be first
-	// since it's not possible to sort a std::map you must copy it to a std::vector and sort it then
-	std::vector<std::pair<uint16_t, int> > map2vec(stats.sslPortCount.begin(), stats.sslPortCount.end());
-	std::sort(map2vec.begin(),map2vec.end(), &uint16CountComparer);
+	// the counter sorts the ports so the most popular ports will be first
+	std::vector<std::pair<uint64_t, uint64_t> > sortedCounts;
+	stats.sslPortCount.getSortedCounts(sortedCounts);
 
-	// go over all items (names + count) in the sorted vector and print them
-	for(std::vector<std::pair<uint16_t, int> >::iterator iter = map2vec.begin();
-			iter != map2vec.end();
+	// go over all items (port + count) in the sorted vector and print them
+	for(std::vector<std::pair<uint64_t, uint64_t> >::iterator iter = sortedCounts.begin();
+			iter != sortedCounts.end();
 			iter++)
 	{
 		std::stringstream values;
@@ -305,6 +535,7 @@ void printStatsSummary(SSLStatsCollector& collector)
 	PRINT_STAT_LINE_DOUBLE("Average packets per flow", collector.getGeneralStats().averageNumOfPacketsPerFlow, "Packets");
 	PRINT_STAT_LINE_DOUBLE("Average data per flow", collector.getGeneralStats().averageAmountOfDataPerFlow, "Bytes");
 	PRINT_STAT_LINE_INT("Client-hello message", collector.getClientHelloStats().numOfMessages, "Messages");
+	PRINT_STAT_LINE_INT("Number of distinct server names", (int)collector.getClientHelloStats().serverNameCount.getNumOfDistinctStrings(), "Names");
 	PRINT_STAT_LINE_INT("Server-hello message", collector.getServerHelloStats().numOfMessages, "Messages");
 	PRINT_STAT_LINE_INT("Number of SSL flows with successful handshake", collector.getGeneralStats().numOfHandshakeCompleteFlows, "Flows");
 	PRINT_STAT_LINE_INT("Number of SSL flows ended with alert", collector.getGeneralStats().numOfFlowsWithAlerts, "Flows");
@@ -341,6 +572,24 @@ void printCurrentRates(SSLStatsCollector& collector)
 }
 
 
+/**
+ * Prints the current rates of the multi-threaded modes, which are calculated from the counters published by all analysis threads
+ */
+class SSLRatesPrinter : public StatsSink
+{
+public:
+	void write(const StatsSnapshot& snapshot)
+	{
+		PRINT_STAT_HEADLINE("Current SSL rates");
+		PRINT_STAT_LINE_DOUBLE("Rate of SSL packets", snapshot.getRate(SSLPacketsCounter), "Packets/sec");
+		PRINT_STAT_LINE_DOUBLE("Rate of SSL flows", snapshot.getRate(SSLFlowsCounter), "Flows/sec");
+		PRINT_STAT_LINE_DOUBLE("Rate of SSL data", snapshot.getRate(SSLDataCounter), "Bytes/sec");
+		PRINT_STAT_LINE_DOUBLE("Rate of SSL requests", snapshot.getRate(ClientHellosCounter), "Requests/sec");
+		PRINT_STAT_LINE_DOUBLE("Rate of SSL responses", snapshot.getRate(ServerHellosCounter), "Responses/sec");
+	}
+};
+
+
 /**
  * The callback to be called when application is terminated by ctrl-c. Stops the endless while loop
  */
@@ -351,10 +600,77 @@ void onApplicationInterrupted(void* cookie)
 }
 
 
+/**
+ * Set a filter of all ports considered as SSL/TLS traffic on a device, so only SSL/TLS packets are captured
+ */
+void setSSLPortFilter(IFilterableDevice* dev)
+{
+	std::vector<GeneralFilter*> portFilterVec;
+
+	// get all ports considered as SSL/TLS traffic and add them to the filter
+	for (std::map<uint16_t, bool>::const_iterator it = SSLLayer::getSSLPortMap()->begin(); it != SSLLayer::getSSLPortMap()->end(); ++it)
+	{
+		portFilterVec.push_back(new PortFilter(it->first, pcpp::SRC_OR_DST));
+	}
+
+	// make an OR filter out of all port filters
+	OrFilter orFilter(portFilterVec);
+
+	// set the filter for the device
+	if (!dev->setFilter(orFilter))
+	{
+		std::string filterAsString;
+		orFilter.parseToString(filterAsString);
+		EXIT_WITH_ERROR("Couldn't set the filter '%s' for the device", filterAsString.c_str());
+	}
+}
+
+
+/**
+ * Print the rates of the analysis threads of a multi-threaded mode periodically, until the application is interrupted. The rates are
+ * calculated from the counters the threads publish, so the threads aren't stopped or locked for the report
+ */
+void reportRatesUntilInterrupted(SSLWorkers& workers, bool printRatesPeriodicaly, int printRatePeriod)
+{
+	SSLRatesPrinter ratesPrinter;
+	StatsReporter reporter(workers.getRateCounters());
+	reporter.addSink(&ratesPrinter);
+
+	// register the on app close event to print summary stats on app termination
+	bool shouldStop = false;
+	ApplicationEventHandler::getInstance().onApplicationInterrupted(onApplicationInterrupted, &shouldStop);
+
+	while(!shouldStop)
+	{
+		PCAP_SLEEP(printRatePeriod);
+
+		if (printRatesPeriodicaly)
+			reporter.report();
+	}
+}
+
+
+/**
+ * Merge the collectors of the analysis threads of a multi-threaded mode and print the summary. Should be called after the threads stopped
+ */
+void printWorkersStatsSummary(SSLWorkers& workers, size_t topK, bool calcRates)
+{
+	SSLStatsCollector collector(topK);
+	workers.mergeStats(collector);
+
+	if (calcRates)
+		collector.calcRates();
+
+	printf("\n\nSTATS SUMMARY\n");
+	printf("=============\n");
+	printStatsSummary(collector);
+}
+
+
 /**
  * activate SSL/TLS analysis from pcap file
  */
-void analyzeSSLFromPcapFile(std::string pcapFileName)
+void analyzeSSLFromPcapFile(std::string pcapFileName, int numOfThreads, size_t topK)
 {
 	// open input file (pcap or pcapng file)
 	IFileReaderDevice* reader = IFileReaderDevice::getReader(pcapFileName.c_str());
@@ -362,20 +678,49 @@ void analyzeSSLFromPcapFile(std::string pcapFileName)
 	if (!reader->open())
 		EXIT_WITH_ERROR("Could not open input pcap file");
 
-	// read the input file packet by packet and give it to the SSLStatsCollector for collecting stats
-	SSLStatsCollector collector;
-	RawPacket rawPacket;
-	while(reader->getNextPacket(rawPacket))
+	// packets are read in a background thread while the previous ones are processed
+	PrefetchingFileReader prefetchingReader(*reader);
+	if (!prefetchingReader.start())
+		EXIT_WITH_ERROR("Could not start reading the input file");
+
+	RawPacket* rawPacket;
+	if (numOfThreads > 1)
 	{
-		Packet parsedPacket(&rawPacket);
-		collector.collectStats(&parsedPacket);
+		// distribute the packets between the analysis threads by flow. The dispatcher copies each packet into the queue of its thread
+		SSLWorkers workers(numOfThreads, topK);
+		FlowDispatcher dispatcher(sslPacketsDispatched, &workers, FlowDispatcherConfiguration(numOfThreads));
+		if (!dispatcher.start())
+			EXIT_WITH_ERROR("Could not start the analysis threads");
+
+		while((rawPacket = prefetchingReader.getNextPacket()) != NULL)
+		{
+			dispatcher.dispatchPacket(rawPacket);
+		}
+
+		// wait for the threads to analyze all queued packets
+		dispatcher.stop();
+		prefetchingReader.stop();
+
+		printWorkersStatsSummary(workers, topK, false);
 	}
+	else
+	{
+		// read the input file packet by packet and give it to the SSLStatsCollector for collecting stats
+		SSLStatsCollector collector(topK);
+		while((rawPacket = prefetchingReader.getNextPacket()) != NULL)
+		{
+			Packet parsedPacket(rawPacket);
+			collector.collectStats(&parsedPacket);
+		}
 
-	// print stats summary
-	printf("\n\n");
-	printf("STATS SUMMARY\n");
-	printf("=============\n");
-	printStatsSummary(collector);
+		prefetchingReader.stop();
+
+		// print stats summary
+		printf("\n\n");
+		printf("STATS SUMMARY\n");
+		printf("=============\n");
+		printStatsSummary(collector);
+	}
 
 	// close input file
 	reader->close();
@@ -386,33 +731,49 @@ void analyzeSSLFromPcapFile(std::string pcapFileName)
 
 
 /**
- * activate SSL analysis from live traffic
+ * activate benchmark mode: the packets of the pcap file are read into memory and analyzed several times
  */
-void analyzeSSLFromLiveTraffic(PcapLiveDevice* dev, bool printRatesPeriodicaly, int printRatePeriod, std::string savePacketsToFileName)
+void benchmarkSSLFromPcapFile(std::string pcapFileName, const BenchmarkConfiguration& benchmarkConfig, size_t topK)
 {
-	// open the device
-	if (!dev->open())
-		EXIT_WITH_ERROR("Could not open the device");
+	BenchmarkHarness harness(AppName::get(), benchmarkConfig);
 
-	// set SSL/TLS ports filter on the live device to capture only SSL/TLS packets
-	std::vector<GeneralFilter*> portFilterVec;
+	if (!harness.loadFile(pcapFileName))
+		EXIT_WITH_ERROR("Could not read input pcap file");
 
-	// get all ports considered as SSL/TLS traffic and add them to the filter
-	for (std::map<uint16_t, bool>::const_iterator it = SSLLayer::getSSLPortMap()->begin(); it != SSLLayer::getSSLPortMap()->end(); ++it)
+	int parseStage = harness.addStage("parse");
+	int collectStage = harness.addStage("collect stats");
+
+	while (harness.startIteration())
 	{
-		portFilterVec.push_back(new PortFilter(it->first, pcpp::SRC_OR_DST));
+		SSLStatsCollector collector(topK);
+		for (size_t i = 0; i < harness.getNumOfPackets(); i++)
+		{
+			harness.beginStage(parseStage);
+			Packet parsedPacket(harness.getPacket(i));
+			harness.endStage(parseStage);
+
+			harness.beginStage(collectStage);
+			collector.collectStats(&parsedPacket);
+			harness.endStage(collectStage);
+		}
+		harness.endIteration();
 	}
 
-	// make an OR filter out of all port filters
-	OrFilter orFilter(portFilterVec);
+	harness.printReport();
+}
 
-	// set the filter for the device
-	if (!dev->setFilter(orFilter))
-	{
-		std::string filterAsString;
-		orFilter.parseToString(filterAsString);
-		EXIT_WITH_ERROR("Couldn't set the filter '%s' for the device", filterAsString.c_str());
-	}
+
+/**
+ * activate SSL analysis from live traffic
+ */
+void analyzeSSLFromLiveTraffic(PcapLiveDevice* dev, bool printRatesPeriodicaly, int printRatePeriod, std::string savePacketsToFileName, size_t topK)
+{
+	// open the device
+	if (!dev->open())
+		EXIT_WITH_ERROR("Could not open the device");
+
+	// set SSL/TLS ports filter on the live device to capture only SSL/TLS packets
+	setSSLPortFilter(dev);
 
 
 	// if needed to save the captured packets to file - open a writer device
@@ -428,7 +789,7 @@ void analyzeSSLFromLiveTraffic(PcapLiveDevice* dev, bool printRatesPeriodicaly,
 
 	// start capturing packets and collecting stats
 	SSLPacketArrivedData data;
-	SSLStatsCollector collector;
+	SSLStatsCollector collector(topK);
 	data.statsCollector = &collector;
 	data.pcapWriter = pcapWriter;
 	dev->startCapture(sslPacketArrive, &data);
@@ -470,6 +831,106 @@ void analyzeSSLFromLiveTraffic(PcapLiveDevice* dev, bool printRatesPeriodicaly,
 	}
 }
 
+
+/**
+ * activate SSL analysis from live traffic on several capture threads. The kernel distributes the packets between the threads by flow
+ * (PACKET_FANOUT), and each thread analyzes the packets it captures
+ */
+void analyzeSSLFromLiveTrafficMultiThread(PcapLiveDevice* dev, int numOfThreads, bool printRatesPeriodicaly, int printRatePeriod, size_t topK)
+{
+	// open the device
+	if (!dev->open())
+		EXIT_WITH_ERROR("Could not open the device");
+
+	// set SSL/TLS ports filter on the live device. The filter is set on the handles of all capture threads
+	setSSLPortFilter(dev);
+
+	SSLWorkers workers(numOfThreads, topK);
+	if (!dev->startCaptureMultiThread((uint8_t)numOfThreads, sslPacketArriveMultiThread, &workers))
+		EXIT_WITH_ERROR("Could not start capturing on %d threads", numOfThreads);
+
+	reportRatesUntilInterrupted(workers, printRatesPeriodicaly, printRatePeriod);
+
+	// stop capturing and close the live device
+	dev->stopCapture();
+	dev->close();
+
+	printWorkersStatsSummary(workers, topK, true);
+}
+
+
+#ifdef USE_PF_RING
+/**
+ * activate SSL analysis from live traffic captured with PF_RING. An RX channel is opened for each thread and PF_RING distributes the
+ * packets between the channels by flow
+ */
+void analyzeSSLFromPfRing(std::string interfaceName, int numOfThreads, bool printRatesPeriodicaly, int printRatePeriod, size_t topK)
+{
+	PfRingDevice* dev = PfRingDeviceList::getInstance().getPfRingDeviceByName(interfaceName);
+	if (dev == NULL)
+		EXIT_WITH_ERROR("Couldn't find PF_RING device '%s'", interfaceName.c_str());
+
+	if (!dev->openMultiRxChannels((uint8_t)numOfThreads, PfRingDevice::PerFlow))
+		EXIT_WITH_ERROR("Couldn't open %d RX channels on PF_RING device '%s'", numOfThreads, interfaceName.c_str());
+
+	setSSLPortFilter(dev);
+
+	// the capture threads are identified by the core they run on, so there is a collector for each core
+	SSLWorkers workers(getNumOfCores(), topK);
+	if (!dev->startCaptureMultiThread(sslPacketsArrivePfRing, &workers))
+		EXIT_WITH_ERROR("Couldn't start capturing on PF_RING device '%s'", interfaceName.c_str());
+
+	reportRatesUntilInterrupted(workers, printRatesPeriodicaly, printRatePeriod);
+
+	dev->stopCapture();
+	dev->close();
+
+	printWorkersStatsSummary(workers, topK, true);
+}
+#endif
+
+
+#ifdef USE_DPDK
+/**
+ * activate SSL analysis from live traffic captured with DPDK. An RX queue is opened for each thread and RSS distributes the packets
+ * between the queues by flow. The default RSS key of DpdkDevice is symmetric, so both directions of a flow reach the same queue
+ */
+void analyzeSSLFromDpdk(int dpdkPortId, int numOfThreads, bool printRatesPeriodicaly, int printRatePeriod, size_t topK)
+{
+	// DPDK is initialized on all cores. The rates are reported from the master core and the worker threads run on cores local to the NIC
+	if (!DpdkDeviceList::initDpdk(getCoreMaskForAllMachineCores(), DPDK_MBUF_POOL_SIZE))
+		EXIT_WITH_ERROR("Couldn't initialize DPDK");
+
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(dpdkPortId);
+	if (dev == NULL)
+		EXIT_WITH_ERROR("Couldn't find DPDK port %d", dpdkPortId);
+
+	if (numOfThreads > dev->getTotalNumOfRxQueues())
+		EXIT_WITH_ERROR("DPDK port %d has only %d RX queues", dpdkPortId, (int)dev->getTotalNumOfRxQueues());
+
+	if (!dev->openMultiQueues((uint16_t)numOfThreads, 1))
+		EXIT_WITH_ERROR("Couldn't open %d RX queues on DPDK port %d", numOfThreads, dpdkPortId);
+
+	SSLWorkers workers(numOfThreads, topK);
+	std::vector<DpdkWorkerThread*> workerThreads;
+	for (int i = 0; i < numOfThreads; i++)
+		workerThreads.push_back(new SSLDpdkWorkerThread(dev, (uint16_t)i, workers.getWorker(i)));
+
+	if (!DpdkDeviceList::getInstance().startDpdkWorkerThreadsOnDeviceSocket(dev, workerThreads))
+		EXIT_WITH_ERROR("Couldn't start the DPDK worker threads");
+
+	reportRatesUntilInterrupted(workers, printRatesPeriodicaly, printRatePeriod);
+
+	DpdkDeviceList::getInstance().stopDpdkWorkerThreads();
+	dev->close();
+
+	for (size_t i = 0; i < workerThreads.size(); i++)
+		delete workerThreads[i];
+
+	printWorkersStatsSummary(workers, topK, true);
+}
+#endif
+
 /**
  * main method of this utility
  */
@@ -481,14 +942,22 @@ int main(int argc, char* argv[])
 	bool printRatesPeriodicaly = true;
 	int printRatePeriod = DEFAULT_CALC_RATES_PERIOD_SEC;
 	std::string savePacketsToFileName = "";
+	size_t topK = 0;
+	int numOfThreads = 1;
+	std::string pfRingInterfaceName = "";
+	int dpdkPortId = -1;
 
 	std::string readPacketsFromPcapFileName = "";
 
+	// the benchmark options are removed from the command line before it's parsed
+	BenchmarkConfiguration benchmarkConfig;
+	if (!BenchmarkHarness::extractOptions(argc, argv, benchmarkConfig))
+		EXIT_WITH_ERROR("Invalid benchmark option");
 
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long (argc, argv, "i:f:o:r:hvld", SSLAnalyzerOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "i:f:o:r:k:t:p:P:hvld", SSLAnalyzerOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -509,6 +978,30 @@ int main(int argc, char* argv[])
 			case 'd':
 				printRatesPeriodicaly = false;
 				break;
+			case 'k':
+				if (atoi(optarg) <= 0)
+					EXIT_WITH_ERROR("top_k must be a positive number");
+				topK = (size_t)atoi(optarg);
+				break;
+			case 't':
+				numOfThreads = atoi(optarg);
+				if (numOfThreads <= 0 || numOfThreads > PCPP_LIVE_DEVICE_MAX_CAPTURE_THREADS)
+					EXIT_WITH_ERROR("Number of threads must be between 1 and %d", PCPP_LIVE_DEVICE_MAX_CAPTURE_THREADS);
+				break;
+			case 'p':
+#ifdef USE_PF_RING
+				pfRingInterfaceName = optarg;
+				break;
+#else
+				EXIT_WITH_ERROR("PcapPlusPlus wasn't built with PF_RING");
+#endif
+			case 'P':
+#ifdef USE_DPDK
+				dpdkPortId = atoi(optarg);
+				break;
+#else
+				EXIT_WITH_ERROR("PcapPlusPlus wasn't built with DPDK");
+#endif
 			case 'v':
 				printAppVersion();
 				break;
@@ -525,14 +1018,37 @@ int main(int argc, char* argv[])
 	}
 
 	// if no interface nor input pcap file were provided - exit with error
-	if (readPacketsFromPcapFileName == "" && interfaceNameOrIP == "")
+	if (readPacketsFromPcapFileName == "" && interfaceNameOrIP == "" && pfRingInterfaceName == "" && dpdkPortId < 0)
 		EXIT_WITH_ERROR("Neither interface nor input pcap file were provided");
 
+	// the captured packets can be saved only by the single capture thread of libpcap
+	if (savePacketsToFileName != "" && (numOfThreads > 1 || pfRingInterfaceName != "" || dpdkPortId >= 0))
+		EXIT_WITH_ERROR("Saving the captured packets to a file isn't supported with more than one thread, PF_RING or DPDK");
+
+	if (benchmarkConfig.enabled && readPacketsFromPcapFileName == "")
+		EXIT_WITH_ERROR("Benchmark mode requires an input pcap file");
+
 	// analyze in pcap file mode
-	if (readPacketsFromPcapFileName != "")
+	if (benchmarkConfig.enabled)
+	{
+		benchmarkSSLFromPcapFile(readPacketsFromPcapFileName, benchmarkConfig, topK);
+	}
+	else if (readPacketsFromPcapFileName != "")
+	{
+		analyzeSSLFromPcapFile(readPacketsFromPcapFileName, numOfThreads, topK);
+	}
+#ifdef USE_PF_RING
+	else if (pfRingInterfaceName != "")
+	{
+		analyzeSSLFromPfRing(pfRingInterfaceName, numOfThreads, printRatesPeriodicaly, printRatePeriod, topK);
+	}
+#endif
+#ifdef USE_DPDK
+	else if (dpdkPortId >= 0)
 	{
-		analyzeSSLFromPcapFile(readPacketsFromPcapFileName);
+		analyzeSSLFromDpdk(dpdkPortId, numOfThreads, printRatesPeriodicaly, printRatePeriod, topK);
 	}
+#endif
 	else // analyze in live traffic mode
 	{
 		// extract pcap live device by interface name or IP address
@@ -552,6 +1068,9 @@ int main(int argc, char* argv[])
 		}
 
 		// start capturing and analyzing traffic
-		analyzeSSLFromLiveTraffic(dev, printRatesPeriodicaly, printRatePeriod, savePacketsToFileName);
+		if (numOfThreads > 1)
+			analyzeSSLFromLiveTrafficMultiThread(dev, numOfThreads, printRatesPeriodicaly, printRatePeriod, topK);
+		else
+			analyzeSSLFromLiveTraffic(dev, printRatesPeriodicaly, printRatePeriod, savePacketsToFileName, topK);
 	}
 }
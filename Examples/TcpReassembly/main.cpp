@@ -13,6 +13,7 @@
  *   - Write each connection to a separate file
  *   - Write each side of each connection to a separate file
  *   - Limit the max number of open files in each point in time (to avoid running out of file descriptors for large files / heavy traffic)
+ *   - Write all connections to a single indexed container file instead of a file per connection
  *   - Write a metadata file (txt file) for each connection with various stats on the connection: number of packets (in each side + total), number of TCP messages (in each side + total),
  *     number of bytes (in each side + total)
  *   - Write to console only (instead of files)
@@ -26,16 +27,16 @@
 #include <stdio.h>
 #include <map>
 #include <iostream>
-#include <fstream>
 #include <sstream>
 #include <algorithm>
 #include "TcpReassembly.h"
 #include "PcapLiveDeviceList.h"
 #include "PcapFileDevice.h"
+#include "BenchmarkHarness.h"
 #include "PlatformSpecificUtils.h"
 #include "SystemUtils.h"
 #include "PcapPlusPlusVersion.h"
-#include "LRUList.h"
+#include "StreamSink.h"
 #include <getopt.h>
 
 using namespace pcpp;
@@ -69,6 +70,7 @@ static struct option TcpAssemblyOptions[] =
 	{"write-to-console", no_argument, 0, 'c'},
 	{"separate-sides", no_argument, 0, 's'},
 	{"max-file-desc", required_argument, 0, 'f'},
+	{"container-file", required_argument, 0, 'w'},
 	{"help", no_argument, 0, 'h'},
 	{"version", no_argument, 0, 'v'},
     {0, 0, 0, 0}
@@ -85,11 +87,7 @@ private:
 	/**
 	 * A private c'tor (as this is a singleton)
 	 */
-	GlobalConfig() { writeMetadata = false; outputDir = ""; writeToConsole = false; separateSides = false; maxOpenFiles = DEFAULT_MAX_NUMBER_OF_CONCURRENT_OPEN_FILES; m_RecentConnsWithActivity = NULL; }
-
-	// A least-recently-used (LRU) list of all connections seen so far. Each connection is represented by its flow key. This LRU list is used to decide which connection was seen least
-	// recently in case we reached max number of open file descriptors and we need to decide which files to close
-	LRUList<uint32_t>* m_RecentConnsWithActivity;
+	GlobalConfig() { writeMetadata = false; outputDir = ""; writeToConsole = false; separateSides = false; writeToContainer = false; streamSink = NULL; }
 
 public:
 
@@ -105,8 +103,13 @@ public:
 	// a flag indicating whether to write both side of a connection to the same file (which is the default) or write each side to a separate file
 	bool separateSides;
 
-	// max number of allowed open files in each point in time
-	size_t maxOpenFiles;
+	// a flag indicating whether all files are written to a single container file, in which case the file names are the names of the streams in
+	// the container and don't include the output directory
+	bool writeToContainer;
+
+	// the sink all files are written to. It buffers the data of every file and writes it in large writes on an I/O thread, and keeps a bounded
+	// number of files open
+	StreamSink* streamSink;
 
 
 	/**
@@ -118,11 +121,11 @@ public:
 		std::stringstream stream;
 
 		// if user chooses to write to a directory other than the current directory - add the dir path to the return value
-		if (outputDir != "")
+		if (outputDir != "" && !writeToContainer)
 			stream << outputDir << SEPARATOR;
 
-		std::string sourceIP = connData.srcIP->toString();
-		std::string destIP = connData.dstIP->toString();
+		std::string sourceIP = connData.srcIP.toString();
+		std::string destIP = connData.dstIP.toString();
 
 		// for IPv6 addresses, replace ':' with '_'
 		std::replace(sourceIP.begin(), sourceIP.end(), ':', '_');
@@ -139,58 +142,6 @@ public:
 	}
 
 
-	/**
-	 * Open a file stream. Inputs are the filename to open and a flag indicating whether to append to an existing file or overwrite it.
-	 * Return value is a pointer to the new file stream
-	 */
-	std::ostream* openFileStream(std::string fileName, bool reopen)
-	{
-		// if the user chooses to write only to consoe, don't open anything and return std::cout
-		if (writeToConsole)
-			return &std::cout;
-
-		// open the file on the disk (with append or overwrite mode)
-		if (reopen)
-			return new std::ofstream(fileName.c_str(), std::ios_base::binary | std::ios_base::app);
-		else
-			return new std::ofstream(fileName.c_str(), std::ios_base::binary);
-	}
-
-
-	/**
-	 * Close a file stream
-	 */
-	void closeFileSteam(std::ostream* fileStream)
-	{
-		// if the user chooses to write only to console - do nothing and return
-		if (!writeToConsole)
-		{
-			// close the file stream
-			std::ofstream* fstream = (std::ofstream*)fileStream;
-			fstream->close();
-
-			// free the memory of the file stream
-			delete fstream;
-		}
-	}
-
-
-	/**
-	 * Return a pointer to the least-recently-used (LRU) list of connections
-	 */
-	LRUList<uint32_t>* getRecentConnsWithActivity()
-	{
-		// his is a lazy implementation - the instance isn't created until the user requests it for the first time.
-		// the side of the LRU list is determined by the max number of allowed open files at any point in time. Default is DEFAULT_MAX_NUMBER_OF_CONCURRENT_OPEN_FILES
-		// but the user can choose another number
-		if (m_RecentConnsWithActivity == NULL)
-			m_RecentConnsWithActivity = new LRUList<uint32_t>(maxOpenFiles);
-
-		// return the pointer
-		return m_RecentConnsWithActivity;
-	}
-
-
 	/**
 	 * The singleton implementation of this class
 	 */
@@ -203,15 +154,13 @@ public:
 
 
 /**
- * A struct to contain all data save on a specific connection. It contains the file streams to write to and also stats data on the connection
+ * A struct to contain all data save on a specific connection. It contains the streams to write to and also stats data on the connection
  */
 struct TcpReassemblyData
 {
-	// pointer to 2 file stream - one for each side of the connection. If the user chooses to write both sides to the same file (which is the default), only one file stream is used (index 0)
-	std::ostream* fileStreams[2];
-
-	// flags indicating whether the file in each side was already opened before. If the answer is yes, next time it'll be opened in append mode (and not in overwrite mode)
-	bool reopenFileStreams[2];
+	// the stream sink IDs of the files of the connection - one for each side of the connection, or -1 if no data was written to the side yet. If the
+	// user chooses to write both sides to the same file (which is the default), only one stream is used (index 0)
+	int streamIds[2];
 
 	// a flag indicating on which side was the latest message on this connection
 	int curSide;
@@ -224,41 +173,15 @@ struct TcpReassemblyData
 	/**
 	 * the default c'tor
 	 */
-	TcpReassemblyData() { fileStreams[0] = NULL; fileStreams[1] = NULL; clear(); }
-
-	/**
-	 * The default d'tor
-	 */
-	~TcpReassemblyData()
-	{
-		// close files on both sides if open
-		if (fileStreams[0] != NULL)
-			GlobalConfig::getInstance().closeFileSteam(fileStreams[0]);
-
-		if (fileStreams[1] != NULL)
-			GlobalConfig::getInstance().closeFileSteam(fileStreams[1]);
-	}
+	TcpReassemblyData() { clear(); }
 
 	/**
-	 * Clear all data (put 0, false or NULL - whatever relevant for each field)
+	 * Clear all data (put 0, false or -1 - whatever relevant for each field)
 	 */
 	void clear()
 	{
-		// for the file stream - close them if they're not null
-		if (fileStreams[0] != NULL)
-		{
-			GlobalConfig::getInstance().closeFileSteam(fileStreams[0]);
-			fileStreams[0] = NULL;
-		}
-
-		if (fileStreams[1] != NULL)
-		{
-			GlobalConfig::getInstance().closeFileSteam(fileStreams[1]);
-			fileStreams[1] = NULL;
-		}
-
-		reopenFileStreams[0] = false;
-		reopenFileStreams[1] = false;
+		streamIds[0] = -1;
+		streamIds[1] = -1;
 		numOfDataPackets[0] = 0;
 		numOfDataPackets[1] = 0;
 		numOfMessagesFromSide[0] = 0;
@@ -282,19 +205,22 @@ void printUsage()
 {
 	printf("\nUsage:\n"
 			"------\n"
-			"%s [-hvlcms] [-r input_file] [-i interface] [-o output_dir] [-e bpf_filter] [-f max_files]\n"
+			"%s [-hvlcms] [-r input_file] [-i interface] [-o output_dir] [-e bpf_filter] [-f max_files] [-w container_file] [--benchmark[=ITERATIONS]]\n"
 			"\nOptions:\n\n"
 			"    -r input_file : Input pcap/pcapng file to analyze. Required argument for reading from file\n"
 			"    -i interface  : Use the specified interface. Can be interface name (e.g eth0) or interface IPv4 address. Required argument for capturing from live interface\n"
 			"    -o output_dir : Specify output directory (default is '.')\n"
 			"    -e bpf_filter : Apply a BPF filter to capture file or live interface, meaning TCP reassembly will only work on filtered packets\n"
 			"    -f max_files  : Maximum number of file descriptors to use\n"
+			"    -w container_file : Write all files to a single container file in the output directory instead of a file per connection. The\n"
+			"                    files are written as streams of the container, with an index of the streams at its end\n"
 			"    -c            : Write all output to console (nothing will be written to files)\n"
 			"    -m            : Write a metadata file for each connection\n"
 			"    -s            : Write each side of each connection to a separate file (default is writing both sides of each connection to the same file)\n"
 			"    -l            : Print the list of interfaces and exit\n"
 			"    -v            : Displays the current version and exists\n"
-			"    -h            : Display this help message and exit\n\n", AppName::get().c_str());
+			"    -h            : Display this help message and exit\n"
+			"%s\n", AppName::get().c_str(), BenchmarkHarness::getUsage());
 	exit(0);
 }
 
@@ -328,9 +254,10 @@ void listInterfaces()
 
 
 /**
- * The callback being called by the TCP reassembly module whenever new data arrives on a certain connection
+ * The callback being called by the TCP reassembly module whenever new data arrives on a certain connection. The data is copied to the buffers
+ * of the stream sink right away, so it's received without being copied by the reassembly module, and the sink writes it to the file later
  */
-static void tcpReassemblyMsgReadyCallback(int sideIndex, TcpStreamData tcpData, void* userCookie)
+static void tcpReassemblyMsgReadyCallback(int sideIndex, const TcpStreamData& tcpData, void* userCookie)
 {
 	// extract the connection manager from the user cookie
 	TcpReassemblyConnMgr* connMgr = (TcpReassemblyConnMgr*)userCookie;
@@ -351,46 +278,6 @@ static void tcpReassemblyMsgReadyCallback(int sideIndex, TcpStreamData tcpData,
 	else
 		side = 0;
 
-	// if the file stream on the relevant side isn't open yet (meaning it's the first data on this connection)
-	if (iter->second.fileStreams[side] == NULL)
-	{
-		// add the flow key of this connection to the list of open connections. If the return value isn't NULL it means that there are too many open files
-		// and we need to close the connection with least recently used file(s) in order to open a new one.
-		// The connection with the least recently used file is the return value
-		uint32_t* flowKeyToCloseFiles = GlobalConfig::getInstance().getRecentConnsWithActivity()->put(tcpData.getConnectionData().flowKey);
-
-		// if flowKeyToCloseFiles isn't NULL it means we need to close the open files in this connection (the one with the least recently used files)
-		if (flowKeyToCloseFiles != NULL)
-		{
-			// find the connection from the flow key
-			TcpReassemblyConnMgrIter iter2 = connMgr->find(*flowKeyToCloseFiles);
-			if (iter2 != connMgr->end())
-			{
-				// close files on both sides (if they're open)
-				for (int index = 0; index < 1; index++)
-				{
-					if (iter2->second.fileStreams[index] != NULL)
-					{
-						// close the file
-						GlobalConfig::getInstance().closeFileSteam(iter2->second.fileStreams[index]);
-						iter2->second.fileStreams[index] = NULL;
-
-						// set the reopen flag to true to indicate that next time this file will be opened it will be opened in append mode (and not overwrite mode)
-						iter2->second.reopenFileStreams[index] = true;
-					}
-				}
-			}
-
-			delete flowKeyToCloseFiles;
-		}
-
-		// get the file name according to the 5-tuple etc.
-		std::string fileName = GlobalConfig::getInstance().getFileName(tcpData.getConnectionData(), sideIndex, GlobalConfig::getInstance().separateSides) + ".txt";
-
-		// open the file in overwrite mode (if this is the first time the file is opened) or in append mode (if it was already opened before)
-		iter->second.fileStreams[side] = GlobalConfig::getInstance().openFileStream(fileName, iter->second.reopenFileStreams[side]);
-	}
-
 	// if this messages comes on a different side than previous message seen on this connection
 	if (sideIndex != iter->second.curSide)
 	{
@@ -405,8 +292,25 @@ static void tcpReassemblyMsgReadyCallback(int sideIndex, TcpStreamData tcpData,
 	iter->second.numOfDataPackets[sideIndex]++;
 	iter->second.bytesFromSide[sideIndex] += (int)tcpData.getDataLength();
 
-	// write the new data to the file
-	iter->second.fileStreams[side]->write((char*)tcpData.getData(), tcpData.getDataLength());
+	// if the user chooses to write only to console, write the data right away
+	if (GlobalConfig::getInstance().writeToConsole)
+	{
+		std::cout.write((char*)tcpData.getData(), tcpData.getDataLength());
+		return;
+	}
+
+	// the stream of the relevant side is added when its first data arrives. The file is created by the stream sink when the data is written
+	// to the disk, and its data is buffered meanwhile
+	StreamSink* streamSink = GlobalConfig::getInstance().streamSink;
+	if (iter->second.streamIds[side] == -1)
+	{
+		// get the file name according to the 5-tuple etc.
+		std::string fileName = GlobalConfig::getInstance().getFileName(tcpData.getConnectionData(), sideIndex, GlobalConfig::getInstance().separateSides) + ".txt";
+		iter->second.streamIds[side] = streamSink->addStream(fileName);
+	}
+
+	// write the new data to the stream
+	streamSink->write(iter->second.streamIds[side], tcpData.getData(), tcpData.getDataLength());
 }
 
 
@@ -446,11 +350,19 @@ static void tcpReassemblyConnectionEndCallback(ConnectionData connectionData, Tc
 	if (iter == connMgr->end())
 		return;
 
+	// the connection won't have more data, so its files are written and closed rather than waiting to be evicted
+	StreamSink* streamSink = GlobalConfig::getInstance().streamSink;
+	for (int side = 0; side < 2; side++)
+	{
+		if (iter->second.streamIds[side] != -1)
+			streamSink->endStream(iter->second.streamIds[side]);
+	}
+
 	// write a metadata file if required by the user
 	if (GlobalConfig::getInstance().writeMetadata)
 	{
 		std::string fileName = GlobalConfig::getInstance().getFileName(connectionData, 0, false) + "-metadata.txt";
-		std::ofstream metadataFile(fileName.c_str());
+		std::stringstream metadataFile;
 		metadataFile << "Number of data packets in side 0:  " << iter->second.numOfDataPackets[0] << std::endl;
 		metadataFile << "Number of data packets in side 1:  " << iter->second.numOfDataPackets[1] << std::endl;
 		metadataFile << "Total number of data packets:      " << (iter->second.numOfDataPackets[0] + iter->second.numOfDataPackets[1]) << std::endl;
@@ -461,7 +373,11 @@ static void tcpReassemblyConnectionEndCallback(ConnectionData connectionData, Tc
 		metadataFile << std::endl;
 		metadataFile << "Number of messages in side 0:      " << iter->second.numOfMessagesFromSide[0] << std::endl;
 		metadataFile << "Number of messages in side 1:      " << iter->second.numOfMessagesFromSide[1] << std::endl;
-		metadataFile.close();
+
+		std::string metadata = metadataFile.str();
+		int metadataStreamId = streamSink->addStream(fileName);
+		streamSink->write(metadataStreamId, (const uint8_t*)metadata.c_str(), metadata.length());
+		streamSink->endStream(metadataStreamId);
 	}
 
 	// remove the connection from the connection manager
@@ -532,6 +448,58 @@ void doTcpReassemblyOnPcapFile(std::string fileName, TcpReassembly& tcpReassembl
 }
 
 
+/**
+ * The message ready callback of benchmark mode, which only counts the reassembled data instead of writing it to files
+ */
+static void benchmarkMsgReadyCallback(int sideIndex, const TcpStreamData& tcpData, void* userCookie)
+{
+	uint64_t* numOfBytesReassembled = (uint64_t*)userCookie;
+	*numOfBytesReassembled += tcpData.getDataLength();
+}
+
+
+/**
+ * The method responsible for benchmark mode: the packets of the pcap/pcapng file are read into memory and reassembled several times,
+ * without writing any output
+ */
+void benchmarkTcpReassemblyOnPcapFile(std::string fileName, const BenchmarkConfiguration& benchmarkConfig, std::string bpfFiler = "")
+{
+	BenchmarkHarness harness(AppName::get(), benchmarkConfig);
+
+	BPFStringFilter filter(bpfFiler);
+	if (!harness.loadFile(fileName, (bpfFiler != "" ? &filter : NULL)))
+		EXIT_WITH_ERROR("Cannot read pcap/pcapng file");
+
+	int parseStage = harness.addStage("parse");
+	int reassembleStage = harness.addStage("reassemble");
+	int closeStage = harness.addStage("close connections");
+
+	uint64_t numOfBytesReassembled = 0;
+	while (harness.startIteration())
+	{
+		TcpReassembly tcpReassembly(benchmarkMsgReadyCallback, &numOfBytesReassembled);
+		for (size_t i = 0; i < harness.getNumOfPackets(); i++)
+		{
+			harness.beginStage(parseStage);
+			Packet parsedPacket(harness.getPacket(i));
+			harness.endStage(parseStage);
+
+			harness.beginStage(reassembleStage);
+			tcpReassembly.reassemblePacket(parsedPacket);
+			harness.endStage(reassembleStage);
+		}
+
+		harness.beginStage(closeStage);
+		tcpReassembly.closeAllConnections();
+		harness.endStage(closeStage);
+
+		harness.endIteration();
+	}
+
+	harness.printReport();
+}
+
+
 /**
  * The method responsible for TCP reassembly on live traffic
  */
@@ -587,11 +555,17 @@ int main(int argc, char* argv[])
 	bool writeToConsole = false;
 	bool separateSides = false;
 	size_t maxOpenFiles = DEFAULT_MAX_NUMBER_OF_CONCURRENT_OPEN_FILES;
+	std::string containerFileName = "";
+
+	// the benchmark options are removed from the command line before it's parsed
+	BenchmarkConfiguration benchmarkConfig;
+	if (!BenchmarkHarness::extractOptions(argc, argv, benchmarkConfig))
+		EXIT_WITH_ERROR("Invalid benchmark option");
 
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long (argc, argv, "i:r:o:e:f:mcsvhl", TcpAssemblyOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "i:r:o:e:f:w:mcsvhl", TcpAssemblyOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -621,6 +595,9 @@ int main(int argc, char* argv[])
 			case 'f':
 				maxOpenFiles = (size_t)atoi(optarg);
 				break;
+			case 'w':
+				containerFileName = optarg;
+				break;
 			case 'h':
 				printUsage();
 				break;
@@ -640,6 +617,16 @@ int main(int argc, char* argv[])
 	if (inputPcapFileName == "" && interfaceNameOrIP == "")
 		EXIT_WITH_ERROR("Neither interface nor input pcap file were provided");
 
+	// benchmark mode doesn't write any output, so none of the output settings apply
+	if (benchmarkConfig.enabled)
+	{
+		if (inputPcapFileName == "")
+			EXIT_WITH_ERROR("Benchmark mode requires an input pcap file");
+
+		benchmarkTcpReassemblyOnPcapFile(inputPcapFileName, benchmarkConfig, bpfFilter);
+		return 0;
+	}
+
 	// verify output dir exists
 	if (outputDir != "" && !directoryExists(outputDir))
 		EXIT_WITH_ERROR("Output directory doesn't exist");
@@ -649,7 +636,16 @@ int main(int argc, char* argv[])
 	GlobalConfig::getInstance().writeMetadata = writeMetadata;
 	GlobalConfig::getInstance().writeToConsole = writeToConsole;
 	GlobalConfig::getInstance().separateSides = separateSides;
-	GlobalConfig::getInstance().maxOpenFiles = maxOpenFiles;
+	GlobalConfig::getInstance().writeToContainer = (containerFileName != "");
+
+	// create the stream sink all files are written to
+	StreamSinkConfiguration sinkConfig(PCPP_STREAM_SINK_DEFAULT_MEMORY_BUDGET, maxOpenFiles);
+	if (containerFileName != "")
+		sinkConfig.containerFileName = (outputDir != "" ? outputDir + SEPARATOR : std::string("")) + containerFileName;
+	StreamSink streamSink(sinkConfig);
+	if (!streamSink.open())
+		EXIT_WITH_ERROR("Cannot open the output files");
+	GlobalConfig::getInstance().streamSink = &streamSink;
 
 	// create the object which manages info on all connections
 	TcpReassemblyConnMgr connMgr;
@@ -683,4 +679,8 @@ int main(int argc, char* argv[])
 		// start capturing packets and do TCP reassembly
 		doTcpReassemblyOnLiveTraffic(dev, tcpReassembly, bpfFilter);
 	}
+
+	// all connections were closed, write the data still buffered and close the files
+	if (!streamSink.close())
+		EXIT_WITH_ERROR("Couldn't write all output files");
 }
@@ -0,0 +1,33 @@
+#include "WorkerThread.h"
+
+
+L3FwdWorkerThread::L3FwdWorkerThread(pcpp::L3Forwarder* forwarder, const std::vector<pcpp::DpdkDevice*>& ports, uint16_t rxPort, uint16_t txQueueId) :
+	m_Router(forwarder, ports, txQueueId), m_RxPort(rxPort), m_Stop(true), m_CoreId(MAX_NUM_OF_CORES+1)
+{
+}
+
+bool L3FwdWorkerThread::run(uint32_t coreId)
+{
+	// Register coreId for this worker
+	m_CoreId = coreId;
+	m_Stop = false;
+
+	// endless loop, until asking the thread to stop
+	while (!m_Stop)
+	{
+		// receive a burst of packets from RX queue 0 of the port, route them and send them on the ports of their next hops
+		m_Router.routeBurst(m_RxPort, 0);
+	}
+
+	return true;
+}
+
+void L3FwdWorkerThread::stop()
+{
+	m_Stop = true;
+}
+
+uint32_t L3FwdWorkerThread::getCoreId()
+{
+	return m_CoreId;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "DpdkDevice.h"
+#include "DpdkDeviceList.h"
+#include "DpdkL3Router.h"
+
+class L3FwdWorkerThread : public pcpp::DpdkWorkerThread
+{
+ private:
+	pcpp::DpdkL3Router m_Router;
+	uint16_t m_RxPort;
+	bool m_Stop;
+	uint32_t m_CoreId;
+
+public:
+ 	// c'tor
+	L3FwdWorkerThread(pcpp::L3Forwarder* forwarder, const std::vector<pcpp::DpdkDevice*>& ports, uint16_t rxPort, uint16_t txQueueId);
+
+	// d'tor (does nothing)
+	~L3FwdWorkerThread() { }
+
+	// implement abstract method
+
+	// start running the worker thread
+	bool run(uint32_t coreId);
+
+	// ask the worker thread to stop
+	void stop();
+
+	// get worker thread core ID
+	uint32_t getCoreId();
+
+	// get the statistics of the packets this worker received
+	void getStats(pcpp::DpdkL3RouterStats& stats) { m_Router.getStats(stats); }
+};
@@ -0,0 +1,177 @@
+#include <vector>
+#include <unistd.h>
+#include <sstream>
+#include "SystemUtils.h"
+#include "DpdkDeviceList.h"
+#include "TablePrinter.h"
+
+#include "WorkerThread.h"
+
+
+#define MBUF_POOL_SIZE 16*1024-1
+#define DEVICE_ID_1 0
+#define DEVICE_ID_2 1
+
+// the addresses of the router on each port, and a default route through a gateway on port 2
+#define PORT_1_IPV4_ADDRESS "10.0.1.1"
+#define PORT_2_IPV4_ADDRESS "10.0.2.1"
+#define PORT_1_IPV6_ADDRESS "2001:db8:1::1"
+#define PORT_2_IPV6_ADDRESS "2001:db8:2::1"
+#define DEFAULT_IPV4_GATEWAY "10.0.2.254"
+#define DEFAULT_IPV6_GATEWAY "2001:db8:2::fe"
+
+#define COLLECT_STATS_EVERY_SEC 2
+
+
+// Keep running flag
+bool keepRunning = true;
+
+void onApplicationInterrupted(void* cookie)
+{
+	keepRunning = false;
+	printf("\nShutting down...\n");
+}
+
+
+void printStats(std::vector<L3FwdWorkerThread*>& workers)
+{
+	std::vector<std::string> columnNames;
+	columnNames.push_back("Port");
+	columnNames.push_back("RX");
+	columnNames.push_back("IPv4 Fwd");
+	columnNames.push_back("IPv6 Fwd");
+	columnNames.push_back("Control");
+	columnNames.push_back("No Route");
+	columnNames.push_back("TTL Exceeded");
+	columnNames.push_back("TX");
+	columnNames.push_back("TX Drops");
+
+	std::vector<int> columnLengths;
+	columnLengths.push_back(5);
+	for (int i = 1; i < 9; i++)
+		columnLengths.push_back(12);
+
+	pcpp::TablePrinter printer(columnNames, columnLengths);
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		pcpp::DpdkL3RouterStats stats;
+		workers[i]->getStats(stats);
+
+		std::stringstream row;
+		row << i+1 << "|" << stats.rxPackets << "|" << stats.forwarderStats.forwardedIPv4Packets << "|" << stats.forwarderStats.forwardedIPv6Packets
+				<< "|" << stats.controlPackets << "|" << stats.forwarderStats.noRoutePackets << "|" << stats.forwarderStats.ttlExceededPackets
+				<< "|" << stats.txPackets << "|" << stats.txDrops;
+		printer.printRow(row.str(), '|');
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	// Register the on app close event handler
+	pcpp::ApplicationEventHandler::getInstance().onApplicationInterrupted(onApplicationInterrupted, NULL);
+
+	// Initialize DPDK
+	pcpp::CoreMask coreMaskToUse = pcpp::getCoreMaskForAllMachineCores();
+	pcpp::DpdkDeviceList::initDpdk(coreMaskToUse, MBUF_POOL_SIZE);
+
+	// Find DPDK devices
+	pcpp::DpdkDevice* device1 = pcpp::DpdkDeviceList::getInstance().getDeviceByPort(DEVICE_ID_1);
+	if (device1 == NULL)
+	{
+		printf("Cannot find device1 with port '%d'\n", DEVICE_ID_1);
+		return 1;
+	}
+
+	pcpp::DpdkDevice* device2 = pcpp::DpdkDeviceList::getInstance().getDeviceByPort(DEVICE_ID_2);
+	if (device2 == NULL)
+	{
+		printf("Cannot find device2 with port '%d'\n", DEVICE_ID_2);
+		return 1;
+	}
+
+	// Open DPDK devices, with a TX queue for each of the two workers since both of them may send on each port
+	if (!device1->openMultiQueues(1, 2))
+	{
+		printf("Couldn't open device1 #%d, PMD '%s'\n", device1->getDeviceId(), device1->getPMDName().c_str());
+		return 1;
+	}
+
+	if (!device2->openMultiQueues(1, 2))
+	{
+		printf("Couldn't open device2 #%d, PMD '%s'\n", device2->getDeviceId(), device2->getPMDName().c_str());
+		return 1;
+	}
+
+	// Set up the router: port 0 is device1 and port 1 is device2
+	std::vector<pcpp::DpdkDevice*> ports;
+	ports.push_back(device1);
+	ports.push_back(device2);
+
+	pcpp::L3Forwarder forwarder(ports.size());
+	forwarder.setPort(0, device1->getMacAddress());
+	forwarder.setPort(1, device2->getMacAddress());
+	if (!forwarder.addPortAddress(0, pcpp::IPv4Address(std::string(PORT_1_IPV4_ADDRESS)), 24) ||
+		!forwarder.addPortAddress(1, pcpp::IPv4Address(std::string(PORT_2_IPV4_ADDRESS)), 24) ||
+		!forwarder.addPortAddress(0, pcpp::IPv6Address(std::string(PORT_1_IPV6_ADDRESS)), 64) ||
+		!forwarder.addPortAddress(1, pcpp::IPv6Address(std::string(PORT_2_IPV6_ADDRESS)), 64) ||
+		!forwarder.addRoute(pcpp::IPv4Address(std::string("0.0.0.0")), 0, pcpp::IPv4Address(std::string(DEFAULT_IPV4_GATEWAY)), 1) ||
+		!forwarder.addRoute(pcpp::IPv6Address(std::string("::")), 0, pcpp::IPv6Address(std::string(DEFAULT_IPV6_GATEWAY)), 1))
+	{
+		printf("Couldn't set up the routes\n");
+		return 1;
+	}
+
+	// Create worker threads, one receiving from each port
+	std::vector<L3FwdWorkerThread*> l3Workers;
+	l3Workers.push_back(new L3FwdWorkerThread(&forwarder, ports, 0, 0));
+	l3Workers.push_back(new L3FwdWorkerThread(&forwarder, ports, 1, 1));
+	std::vector<pcpp::DpdkWorkerThread*> workers(l3Workers.begin(), l3Workers.end());
+
+	// Create core mask - use core 1 and 2 for the two threads
+	int workersCoreMask = 0;
+	for (int i = 1; i <= 2; i++)
+	{
+		workersCoreMask = workersCoreMask | (1 << (i+1));
+	}
+
+	// Start capture in async mode
+	if (!pcpp::DpdkDeviceList::getInstance().startDpdkWorkerThreads(workersCoreMask, workers))
+	{
+		printf("Couldn't start worker threads");
+		return 1;
+	}
+
+	uint64_t counter = 0;
+	int statsCounter = 1;
+
+	// Keep running while flag is on
+	while (keepRunning)
+	{
+		// Sleep for 1 second
+		sleep(1);
+
+		// Print stats every COLLECT_STATS_EVERY_SEC seconds
+		if (counter % COLLECT_STATS_EVERY_SEC == 0)
+		{
+			// Clear screen and move to top left
+			const char clr[] = { 27, '[', '2', 'J', '\0' };
+			const char topLeft[] = { 27, '[', '1', ';', '1', 'H','\0' };
+			printf("%s%s", clr, topLeft);
+
+			printf("\n\nStats #%d\n", statsCounter++);
+			printf("==========\n\n");
+
+			// Print the stats of the packets received on each port
+			printStats(l3Workers);
+		}
+		counter++;
+	}
+
+	// Stop worker threads
+	pcpp::DpdkDeviceList::getInstance().stopDpdkWorkerThreads();
+
+	// Exit app with normal exit code
+	return 0;
+}
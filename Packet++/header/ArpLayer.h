@@ -133,8 +133,12 @@ namespace pcpp
 
 		std::string toString();
 
+		void dump(PacketDumpWriter& writer);
+
 		OsiModelLayer getOsiModelLayer() const { return OsiModelNetworkLayer; }
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(ArpLayer, ARP);
+
 } // namespace pcpp
 #endif /* PACKETPP_ARP_LAYER */
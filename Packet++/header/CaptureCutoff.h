@@ -0,0 +1,230 @@
+#ifndef PACKETPP_CAPTURE_CUTOFF
+#define PACKETPP_CAPTURE_CUTOFF
+
+#include "FlowTable.h"
+#include "RuleClassifier.h"
+#include "RawPacket.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * An enum of the actions CaptureCutoff takes on the packets of a flow which reached its cut-off
+	 */
+	enum CaptureCutoffAction
+	{
+		/** Drop the packets */
+		CutoffDrop,
+		/** Truncate the packets to their headers (see CaptureCutoffConfiguration#truncatedPayloadLength) */
+		CutoffTruncate
+	};
+
+
+	/**
+	 * An enum of the results of CaptureCutoff#process()
+	 */
+	enum CaptureCutoffResult
+	{
+		/** The packet should be recorded as it is */
+		CutoffPacketKept,
+		/** The packet was truncated and should be recorded */
+		CutoffPacketTruncated,
+		/** The packet should be dropped */
+		CutoffPacketDropped
+	};
+
+
+	/**
+	 * @struct CaptureCutoffConfiguration
+	 * The configuration of a CaptureCutoff
+	 */
+	struct CaptureCutoffConfiguration
+	{
+		/**
+		 * The number of bytes of raw data (both directions together) recorded in full for each flow. Packets arriving after the flow
+		 * reached it are cut off. 0 means no byte limit
+		 */
+		uint64_t maxBytesPerFlow;
+
+		/**
+		 * The number of packets (both directions together) recorded in full for each flow. 0 means no packet limit
+		 */
+		uint32_t maxPacketsPerFlow;
+
+		/**
+		 * What to do with the packets of a flow which reached its cut-off
+		 */
+		CaptureCutoffAction action;
+
+		/**
+		 * The number of bytes following the headers which are kept when a packet is truncated, for example to keep enough of the payload to
+		 * identify the application protocol
+		 */
+		uint16_t truncatedPayloadLength;
+
+		/**
+		 * The number of seconds a flow may stay without packets before it's forgotten. A flow seen again afterwards is recorded in full again
+		 */
+		uint32_t idleTimeout;
+
+		/**
+		 * The maximum number of flows tracked. When it's reached the least recently seen flow is forgotten. 0 means no limit
+		 */
+		size_t maxFlows;
+
+		/**
+		 * An optional budget the memory of the flows is charged to, shared with other components as in FlowTableConfiguration#memoryBudget.
+		 * NULL means the memory is limited only by #maxFlows
+		 */
+		MemoryBudget* memoryBudget;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] maxBytesPerFlow The number of bytes recorded in full for each flow, or 0 for no limit. Default value is 65536
+		 * @param[in] maxPacketsPerFlow The number of packets recorded in full for each flow, or 0 for no limit. Default value is 0
+		 * @param[in] action What to do with the packets after the cut-off. Default value is pcpp#CutoffTruncate
+		 * @param[in] truncatedPayloadLength The number of bytes following the headers kept in truncated packets. Default value is 0
+		 * @param[in] idleTimeout The idle timeout of flows in seconds. Default value is 120
+		 * @param[in] maxFlows The maximum number of flows tracked, or 0 for no limit. Default value is 1000000
+		 * @param[in] memoryBudget An optional budget to charge the memory of the flows to. Default value is NULL
+		 */
+		CaptureCutoffConfiguration(uint64_t maxBytesPerFlow = 65536, uint32_t maxPacketsPerFlow = 0, CaptureCutoffAction action = CutoffTruncate,
+				uint16_t truncatedPayloadLength = 0, uint32_t idleTimeout = 120, size_t maxFlows = 1000000, MemoryBudget* memoryBudget = NULL) :
+			maxBytesPerFlow(maxBytesPerFlow), maxPacketsPerFlow(maxPacketsPerFlow), action(action), truncatedPayloadLength(truncatedPayloadLength),
+			idleTimeout(idleTimeout), maxFlows(maxFlows), memoryBudget(memoryBudget) {}
+	};
+
+
+	/**
+	 * @struct CaptureCutoffStats
+	 * The statistics of a CaptureCutoff
+	 */
+	struct CaptureCutoffStats
+	{
+		/** Number of packets processed */
+		uint64_t packets;
+		/** Number of bytes of raw data processed */
+		uint64_t bytes;
+		/** Number of packets kept as they are, including exempt and non-IP packets */
+		uint64_t keptPackets;
+		/** Number of packets truncated */
+		uint64_t truncatedPackets;
+		/** Number of packets dropped */
+		uint64_t droppedPackets;
+		/** Number of bytes of raw data left after processing (of the kept and truncated packets) */
+		uint64_t outputBytes;
+		/** Number of packets of exempt flows */
+		uint64_t exemptPackets;
+		/** Number of packets which don't contain an IPv4 or IPv6 header. They're always kept */
+		uint64_t nonIpPackets;
+		/** Number of flows forgotten before their idle timeout because of CaptureCutoffConfiguration#maxFlows or the memory budget */
+		uint64_t evictions;
+	};
+
+
+	/**
+	 * @class CaptureCutoff
+	 * A capture stage which keeps only the beginning of each flow, for long-term recording where bulk transfers would fill the disk. The
+	 * packets of each bidirectional flow are recorded in full until the flow reached CaptureCutoffConfiguration#maxBytesPerFlow bytes or
+	 * CaptureCutoffConfiguration#maxPacketsPerFlow packets. Afterwards its packets are dropped, or truncated to their headers (up to the end of
+	 * the TCP or UDP header, or of the IP header for other protocols) while their frame length is kept, so a file written with
+	 * PcapFileWriterDevice or PcapNgFileWriterDevice shows the original packet lengths.<BR>
+	 * Flows are keyed by their 5-tuple with the endpoints ordered, so both directions share one budget, and are kept in a FlowTable with an
+	 * idle timeout. A TCP SYN without ACK starts a flow over, so a connection reusing the 5-tuple of an earlier one is recorded in full. Flows
+	 * can be exempted from the cut-off with the rules of a RuleClassifier (see setExemptions()). Packets without an IP header aren't part of
+	 * any flow and are always kept. Time is taken from the packet timestamps, so the stage works the same on live traffic and on capture
+	 * files.<BR>
+	 * Call process() for each packet before writing it, or filterBurst() for a burst of packets received from DpdkDevice or another burst API.
+	 * A CaptureCutoff isn't thread-safe. To use it on several threads, give each thread its own instance and make sure both directions of a
+	 * flow reach the same thread, for example by distributing packets with a symmetric flow hash (see FlowHash#hashSymmetric())
+	 */
+	class CaptureCutoff
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The configuration of the cut-off. Default is truncating flows after 64KB
+		 */
+		CaptureCutoff(const CaptureCutoffConfiguration& config = CaptureCutoffConfiguration());
+
+		/**
+		 * Set the rules of flows which are always recorded in full. A flow is exempt if its first packet matches one of the rules in either
+		 * direction. The rules are checked once per flow, so changing them affects only flows seen afterwards
+		 * @param[in] exemptions The classifier, or NULL for no exemptions. It isn't owned by the cut-off. If its rules may be replaced while
+		 * the cut-off is used, the calling thread should be registered as its reader (see RuleClassifier#registerReader())
+		 */
+		inline void setExemptions(const RuleClassifier* exemptions) { m_Exemptions = exemptions; }
+
+		/**
+		 * Account a packet to its flow, and truncate it if its flow reached the cut-off and the action is pcpp#CutoffTruncate. The packet
+		 * timestamp is used as the current time
+		 * @param[in] rawPacket The packet. The link layer type is taken from RawPacket#getLinkLayerType()
+		 * @return Whether the packet should be recorded as it is, was truncated or should be dropped
+		 */
+		CaptureCutoffResult process(RawPacket* rawPacket);
+
+		/**
+		 * Process a burst of packets and reorder it so the packets which should be recorded (kept and truncated) come first, in their
+		 * original order, followed by the dropped packets. This suits burst APIs such as DpdkDevice#receivePackets(), whose dropped packets
+		 * still need to be freed
+		 * @param[in,out] packets The packets
+		 * @param[in] numOfPackets The number of packets
+		 * @return The number of packets which should be recorded, which are now packets[0] to packets[return value - 1]
+		 */
+		int filterBurst(RawPacket** packets, int numOfPackets);
+
+		/**
+		 * Forget all flows, so they're recorded in full again. The statistics are kept
+		 */
+		void clear();
+
+		/**
+		 * @return The number of flows currently tracked
+		 */
+		inline size_t getNumOfFlows() const { return m_Table.size(); }
+
+		/**
+		 * @return The configuration of the cut-off
+		 */
+		inline const CaptureCutoffConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * Get the cut-off statistics
+		 * @param[out] stats The statistics
+		 */
+		void getStats(CaptureCutoffStats& stats) const;
+
+	private:
+
+		struct FlowState
+		{
+			uint64_t bytes;
+			uint32_t packets;
+			bool exempt;
+		};
+
+		CaptureCutoffConfiguration m_Config;
+		FlowTable<FlowTuple, FlowState> m_Table;
+		const RuleClassifier* m_Exemptions;
+		CaptureCutoffStats m_Stats;
+
+		bool isExempt(const PacketView& view) const;
+		size_t getHeadersLength(const PacketView& view, size_t dataLen) const;
+
+		// disable copy c'tor and assignment operator
+		CaptureCutoff(const CaptureCutoff& other);
+		CaptureCutoff& operator=(const CaptureCutoff& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_CAPTURE_CUTOFF */
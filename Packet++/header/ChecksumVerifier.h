@@ -0,0 +1,121 @@
+#ifndef PACKETPP_CHECKSUM_VERIFIER
+#define PACKETPP_CHECKSUM_VERIFIER
+
+#include "RawPacket.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class ChecksumVerifier
+	 * Verifies the checksums of a burst of received packets without building Packet objects, for example to check the integrity of
+	 * packets before recording them. A burst is loaded with load(), which locates the headers of each packet using FlowKeyExtractor, and
+	 * is then verified in two separate passes: verifyIPv4HeaderChecksums() for the IPv4 header checksums and verifyL4Checksums() for the
+	 * TCP and UDP checksums (of both IPv4 and IPv6 packets). Each pass returns a bitmask with a bit per packet of the burst.<BR>
+	 * The IPv4 header checksums are computed for 16 (AVX-512) or 8 (AVX2) packets at a time, gathering the same 32-bit word of all their
+	 * headers into one vector. The kernel is selected once according to the CPU features available at runtime, and a scalar one is used
+	 * on other CPUs. The TCP and UDP checksums are computed per packet using compute_checksum().<BR>
+	 * Checksums already validated by the NIC can be passed to setHints() after load(), in which case they aren't computed again (see
+	 * MBufRawPacket#loadChecksumVerifier() for DPDK devices).<BR>
+	 * The verifier doesn't own the raw packets, so they should be kept alive and unchanged until the next call to load()
+	 */
+	class ChecksumVerifier
+	{
+	public:
+
+		/**
+		 * The maximum number of packets in a burst, which is the number of bits in the bitmasks
+		 */
+		static const size_t MaxBurstSize = 64;
+
+		/**
+		 * A checksum status known before the checksum is verified, usually reported by the NIC
+		 */
+		enum ChecksumHint
+		{
+			/** The status isn't known, the checksum is verified in software */
+			ChecksumHintUnknown,
+			/** The checksum is known to be valid */
+			ChecksumHintGood,
+			/** The checksum is known to be invalid */
+			ChecksumHintBad
+		};
+
+		/**
+		 * A c'tor for this class
+		 */
+		ChecksumVerifier();
+
+		/**
+		 * Load a burst of raw packets, replacing the previously loaded one. All hints are reset to ChecksumHintUnknown
+		 * @param[in] rawPackets An array of pointers to raw packets
+		 * @param[in] count The number of raw packets in the array
+		 * @return The number of packets loaded. It's smaller than count only if count exceeds #MaxBurstSize
+		 */
+		size_t load(RawPacket* const* rawPackets, size_t count);
+
+		/**
+		 * Set the known checksum statuses of a loaded packet. Checksums with a hint other than ChecksumHintUnknown aren't computed, and the
+		 * packet is reported as the hint says if it has such a checksum
+		 * @param[in] index The packet index in the burst
+		 * @param[in] ipHint The status of the IPv4 header checksum
+		 * @param[in] l4Hint The status of the TCP or UDP checksum
+		 */
+		void setHints(size_t index, ChecksumHint ipHint, ChecksumHint l4Hint);
+
+		/**
+		 * @return The number of packets loaded by the last call to load()
+		 */
+		inline size_t getCount() const { return m_Count; }
+
+		/**
+		 * @return A bitmask with the bits of all loaded packets set (bit i for the packet at index i)
+		 */
+		inline uint64_t getLoadedMask() const { return m_Count == MaxBurstSize ? ~(uint64_t)0 : (((uint64_t)1 << m_Count) - 1); }
+
+		/**
+		 * Verify the IPv4 header checksums of the loaded packets
+		 * @param[out] checkedMask If not NULL, set to a bitmask of the packets whose IPv4 header checksum was verified or taken from a hint.
+		 * Packets which aren't IPv4 or whose IPv4 header is truncated aren't checked
+		 * @return A bitmask of the packets which passed: their IPv4 header checksum is valid, or they weren't checked. The packets whose
+		 * checksum is invalid are therefore the bits of getLoadedMask() which aren't set in it
+		 */
+		uint64_t verifyIPv4HeaderChecksums(uint64_t* checkedMask = NULL) const;
+
+		/**
+		 * Verify the TCP and UDP checksums of the loaded packets
+		 * @param[out] checkedMask If not NULL, set to a bitmask of the packets whose TCP or UDP checksum was verified or taken from a hint.
+		 * Packets which aren't TCP or UDP, IP fragments, packets whose TCP or UDP data is truncated, packets whose IP length is unknown
+		 * (0, as with TCP Segmentation Offload) and IPv4 UDP packets without a checksum (0) aren't checked
+		 * @return A bitmask of the packets which passed: their TCP or UDP checksum is valid, or they weren't checked. The packets whose
+		 * checksum is invalid are therefore the bits of getLoadedMask() which aren't set in it
+		 */
+		uint64_t verifyL4Checksums(uint64_t* checkedMask = NULL) const;
+
+	private:
+		size_t m_Count;
+		// the IPv4 or IPv6 header of each packet, NULL if there is none
+		const uint8_t* m_NetworkHeaders[MaxBurstSize];
+		// the TCP or UDP header of each packet, NULL if its checksum can't be verified
+		const uint8_t* m_TransportHeaders[MaxBurstSize];
+		// the length of the TCP or UDP header and data
+		uint32_t m_TransportLengths[MaxBurstSize];
+		// the length of the IPv4 header, 0 if the packet isn't IPv4 or the header is truncated
+		uint8_t m_IPv4HeaderLengths[MaxBurstSize];
+		uint8_t m_IPVersions[MaxBurstSize];
+		uint8_t m_IPProtocols[MaxBurstSize];
+		uint8_t m_IPHints[MaxBurstSize];
+		uint8_t m_L4Hints[MaxBurstSize];
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_CHECKSUM_VERIFIER */
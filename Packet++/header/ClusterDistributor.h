@@ -0,0 +1,294 @@
+#ifndef PACKETPP_CLUSTER_DISTRIBUTOR
+#define PACKETPP_CLUSTER_DISTRIBUTOR
+
+#include "RawPacket.h"
+#include "MacAddress.h"
+#include "IpAddress.h"
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file
+ * Spreading traffic which is too much for one host between the nodes of a cluster, so that all packets of a flow (both directions) reach
+ * the same node. pcpp#ClusterDistributor runs on the host receiving the traffic: it hashes each packet by its symmetric 5-tuple, or by
+ * the 5-tuple of the packet inside a tunnel, picks a node with a consistent-hash ring and encapsulates the packet in VXLAN towards that
+ * node. The encapsulated packets are handed to a callback in batches per node, which sends them through any device (for example
+ * DpdkDevice#sendPackets() or XdpDevice#sendPackets()).
+ *
+ * Each node gets many points on the ring (see pcpp#ClusterDistributorConfiguration#virtualNodesPerWeight), and a flow belongs to the node
+ * of the first point following its hash. The points of a node depend only on its ID, so when a node is added only the flows which now
+ * fall on its points move to it, and when a node is removed only its own flows move to the other nodes.
+ *
+ * On each node the packets are received by any device and decapsulated with pcpp#ClusterDistributor#decapsulate, or by
+ * pcpp#ClusterReceiverDevice which presents the original traffic as a normal device.
+ */
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct ClusterNode
+	 * A node of the cluster, which is the destination of the VXLAN packets carrying its flows
+	 */
+	struct ClusterNode
+	{
+		/** A unique ID of the node. The points of the node on the ring are derived from it, so a node should keep its ID when it rejoins */
+		uint32_t nodeId;
+		/** The destination MAC address of the packets sent to the node (the MAC address of the node or of the gateway towards it) */
+		MacAddress macAddress;
+		/** The IPv4 address of the node */
+		IPv4Address ipAddress;
+		/** The relative share of the flows the node gets. A node with weight 2 gets about twice the flows of a node with weight 1 */
+		uint32_t weight;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] nodeId A unique ID of the node
+		 * @param[in] macAddress The destination MAC address of the packets sent to the node
+		 * @param[in] ipAddress The IPv4 address of the node
+		 * @param[in] weight The relative share of the flows the node gets. Default value is 1
+		 */
+		ClusterNode(uint32_t nodeId, const MacAddress& macAddress, const IPv4Address& ipAddress, uint32_t weight = 1) :
+			nodeId(nodeId), macAddress(macAddress), ipAddress(ipAddress), weight(weight) {}
+	};
+
+
+	/**
+	 * @struct ClusterDistributorConfiguration
+	 * The configuration of a ClusterDistributor
+	 */
+	struct ClusterDistributorConfiguration
+	{
+		/** The source MAC address of the VXLAN packets */
+		MacAddress srcMac;
+		/** The source IPv4 address of the VXLAN packets */
+		IPv4Address srcIP;
+		/** The VXLAN Network ID of the VXLAN packets (24 bits) */
+		uint32_t vni;
+		/** The destination UDP port of the VXLAN packets */
+		uint16_t dstPort;
+		/** If true packets are hashed by the 5-tuple of their innermost packet (see TunnelDecapsulator), so the flows inside a tunnel are
+		 * spread over the nodes. Otherwise they're hashed by their outer 5-tuple */
+		bool hashInnerFlow;
+		/** The number of points on the ring for each unit of node weight. More points spread the flows more evenly */
+		uint32_t virtualNodesPerWeight;
+		/** The number of packets sent to a node in one batch */
+		uint32_t batchSize;
+		/** The maximum length of a distributed packet. Longer packets are dropped. The network between the nodes must carry packets
+		 * ClusterDistributor#EncapsulationLength bytes longer */
+		uint16_t maxPacketLength;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] srcMac The source MAC address of the VXLAN packets
+		 * @param[in] srcIP The source IPv4 address of the VXLAN packets
+		 * @param[in] vni The VXLAN Network ID. Default value is 0
+		 * @param[in] dstPort The destination UDP port of the VXLAN packets. Default value is 4789 (the IANA VXLAN port)
+		 * @param[in] hashInnerFlow Whether tunneled packets are hashed by their inner 5-tuple. Default value is true
+		 * @param[in] virtualNodesPerWeight The number of ring points for each unit of node weight. Default value is 128
+		 * @param[in] batchSize The number of packets sent to a node in one batch. Default value is 32
+		 * @param[in] maxPacketLength The maximum length of a distributed packet. Default value is 1518
+		 */
+		ClusterDistributorConfiguration(const MacAddress& srcMac, const IPv4Address& srcIP, uint32_t vni = 0, uint16_t dstPort = 4789,
+				bool hashInnerFlow = true, uint32_t virtualNodesPerWeight = 128, uint32_t batchSize = 32, uint16_t maxPacketLength = 1518) :
+			srcMac(srcMac), srcIP(srcIP), vni(vni), dstPort(dstPort), hashInnerFlow(hashInnerFlow), virtualNodesPerWeight(virtualNodesPerWeight),
+			batchSize(batchSize), maxPacketLength(maxPacketLength) {}
+	};
+
+
+	/**
+	 * @struct ClusterDistributorStats
+	 * The statistics of a ClusterDistributor
+	 */
+	struct ClusterDistributorStats
+	{
+		/** Number of packets given to the distributor */
+		uint64_t packets;
+		/** Number of packets encapsulated towards a node */
+		uint64_t distributedPackets;
+		/** Number of bytes of the encapsulated packets, before they were encapsulated */
+		uint64_t distributedBytes;
+		/** Number of batches passed to the callback */
+		uint64_t batches;
+		/** Number of packets dropped because the cluster has no nodes */
+		uint64_t noNodePackets;
+		/** Number of packets dropped because they aren't Ethernet packets or they're longer than ClusterDistributorConfiguration#maxPacketLength */
+		uint64_t unsupportedPackets;
+	};
+
+
+	/**
+	 * @class ClusterDistributor
+	 * Distributes packets between the nodes of a cluster with per-flow affinity, encapsulating them in VXLAN. Please refer to the
+	 * documentation at the top of ClusterDistributor.h for understanding how to use this class.<BR>
+	 * The Ethernet, IPv4, UDP and VXLAN headers of each node are built once with the layers when the node is added, and each packet is
+	 * copied after them into a batch buffer of the node allocated once, so distributing doesn't allocate memory. For each packet only the
+	 * lengths, the IPv4 checksum (updated incrementally) and the UDP source port change. The UDP source port is derived from the flow hash,
+	 * as RFC 7348 recommends, so the network between the nodes can spread the flows over its links. The UDP checksum is 0, which is allowed
+	 * for VXLAN over IPv4. Only Ethernet packets are distributed, since VXLAN carries Ethernet frames.<BR>
+	 * A distributor isn't thread-safe: with several receiving threads use a distributor per thread with the same nodes, and they all map
+	 * each flow to the same node
+	 */
+	class ClusterDistributor
+	{
+	public:
+
+		/**
+		 * A callback invoked with a batch of encapsulated packets for a node
+		 * @param[in] node The node the packets should be sent to
+		 * @param[in] packets An array of the packets, starting at the outer Ethernet header. Their data belongs to the distributor and is
+		 * valid only until the callback returns
+		 * @param[in] numOfPackets The number of packets in the array
+		 * @param[in] userCookie The cookie given in the c'tor
+		 */
+		typedef void (*OnClusterBatchReady)(const ClusterNode& node, RawPacket* packets, uint32_t numOfPackets, void* userCookie);
+
+		/**
+		 * The length of the Ethernet, IPv4, UDP and VXLAN headers added to each packet
+		 */
+		static const size_t EncapsulationLength = 50;
+
+		/**
+		 * A c'tor for this class. The cluster has no nodes until addNode() is called
+		 * @param[in] config The configuration of the distributor
+		 * @param[in] onBatchReady The callback to invoke with each batch of packets
+		 * @param[in] userCookie A pointer passed to the callback. Default value is NULL
+		 */
+		ClusterDistributor(const ClusterDistributorConfiguration& config, OnClusterBatchReady onBatchReady, void* userCookie = NULL);
+
+		/**
+		 * A d'tor for this class. Packets which weren't sent yet are discarded, so flush() should be called before
+		 */
+		~ClusterDistributor();
+
+		/**
+		 * Add a node to the cluster. Only the flows which fall on the points of the new node move to it
+		 * @param[in] node The node
+		 * @return True if the node was added, false if a node with the same ID is already in the cluster or the weight is 0 (an error is
+		 * printed to log)
+		 */
+		bool addNode(const ClusterNode& node);
+
+		/**
+		 * Remove a node from the cluster. Its batch is sent first, and only its flows move to other nodes
+		 * @param[in] nodeId The ID of the node
+		 * @return True if the node was removed, false if there's no node with this ID
+		 */
+		bool removeNode(uint32_t nodeId);
+
+		/**
+		 * @return The number of nodes in the cluster
+		 */
+		inline size_t getNumOfNodes() const { return m_Nodes.size(); }
+
+		/**
+		 * Get the nodes of the cluster
+		 * @param[out] nodes A vector which is filled with the nodes, in the order they were added
+		 */
+		void getNodes(std::vector<ClusterNode>& nodes) const;
+
+		/**
+		 * Find the node a flow hash belongs to
+		 * @param[in] flowHash A hash returned by getFlowHash()
+		 * @return The node, or NULL if the cluster has no nodes. The pointer is valid until the node is removed
+		 */
+		const ClusterNode* getNode(uint32_t flowHash) const;
+
+		/**
+		 * Calculate the hash the distributor uses for a packet
+		 * @param[in] rawPacket The packet
+		 * @return The symmetric 5-tuple hash of the packet or of its inner packet (see ClusterDistributorConfiguration#hashInnerFlow), or 0
+		 * if it's not an IPv4 or IPv6 packet. All packets which aren't IPv4 or IPv6 go to the same node
+		 */
+		uint32_t getFlowHash(const RawPacket* rawPacket) const;
+
+		/**
+		 * Encapsulate a packet towards the node of its flow. The batch of the node is sent when it's full
+		 * @param[in] rawPacket The packet. Its data is copied
+		 * @return True if the packet was encapsulated, false if it was dropped
+		 */
+		bool distributePacket(const RawPacket* rawPacket);
+
+		/**
+		 * Encapsulate a burst of packets, see distributePacket()
+		 * @param[in] rawPackets An array of packets. Their data is copied
+		 * @param[in] numOfPackets The number of packets in the array
+		 * @return The number of packets encapsulated
+		 */
+		size_t distributePackets(RawPacket** rawPackets, size_t numOfPackets);
+
+		/**
+		 * Send the batches which have any packets
+		 */
+		void flush();
+
+		/**
+		 * Decapsulate a packet sent by a ClusterDistributor, without copying it
+		 * @param[in] outerPacket The received VXLAN packet
+		 * @param[out] innerPacket The raw packet to set to the original packet. It points into the data of outerPacket and it's valid only
+		 * as long as outerPacket is
+		 * @param[out] vni The VXLAN Network ID of the packet
+		 * @param[in] dstPort The destination UDP port of the VXLAN packets. Default value is 4789
+		 * @return True if the packet was decapsulated, false if it isn't a VXLAN packet to this port
+		 */
+		static bool decapsulate(const RawPacket& outerPacket, RawPacket& innerPacket, uint32_t& vni, uint16_t dstPort = 4789);
+
+		/**
+		 * @return The configuration of the distributor
+		 */
+		inline const ClusterDistributorConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * Get the distributor statistics
+		 * @param[out] stats The statistics
+		 */
+		inline void getStats(ClusterDistributorStats& stats) const { stats = m_Stats; }
+
+	private:
+
+		struct NodeBatch
+		{
+			ClusterNode node;
+			uint8_t headers[EncapsulationLength];
+			uint8_t* buffer;
+			RawPacket* packets;
+			uint32_t numOfPackets;
+
+			NodeBatch(const ClusterNode& node) : node(node), buffer(NULL), packets(NULL), numOfPackets(0) {}
+		};
+
+		struct RingPoint
+		{
+			uint32_t point;
+			NodeBatch* nodeBatch;
+
+			bool operator<(const RingPoint& other) const;
+		};
+
+		ClusterDistributorConfiguration m_Config;
+		OnClusterBatchReady m_OnBatchReady;
+		void* m_UserCookie;
+		size_t m_SlotLength;
+		std::vector<NodeBatch*> m_Nodes;
+		std::vector<RingPoint> m_Ring;
+		ClusterDistributorStats m_Stats;
+
+		NodeBatch* findNode(uint32_t flowHash) const;
+		bool buildHeaders(NodeBatch* nodeBatch);
+		void buildRing();
+		void sendBatch(NodeBatch* nodeBatch);
+		static uint32_t getRingPoint(uint32_t nodeId, uint32_t index);
+
+		// disable copy c'tor and assignment operator
+		ClusterDistributor(const ClusterDistributor& other);
+		ClusterDistributor& operator=(const ClusterDistributor& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_CLUSTER_DISTRIBUTOR */
@@ -561,6 +561,18 @@ namespace pcpp
 		 * @return The DhcpOption object
 		 */
 		DhcpOption build() const;
+
+		/**
+		 * @return The size in bytes of the option build() creates, or 0 if the option can't be built out of the parameters defined in the c'tor
+		 */
+		size_t getRecordSize() const;
+
+		/**
+		 * Build the DhcpOption object into a buffer given by the caller instead of allocating one, for example directly into the packet data
+		 * @param[in] recordBuffer A buffer of at least getRecordSize() bytes
+		 * @return The DhcpOption object, which points to recordBuffer, or a logical NULL object if the option can't be built
+		 */
+		DhcpOption build(uint8_t* recordBuffer) const;
 	};
 
 
@@ -779,6 +791,8 @@ namespace pcpp
 
 		DhcpOption addOptionAt(const DhcpOptionBuilder& optionBuilder, int offset);
 	};
+
+	PCPP_LAYER_PROTOCOL_TRAITS(DhcpLayer, DHCP);
 }
 
 #endif /* PACKETPP_DHCP_LAYER */
@@ -428,7 +428,8 @@ namespace pcpp
         OsiModelLayer getOsiModelLayer() const { return OsiModelApplicationLayer; }
 
 		/**
-		 * @return A pointer to a map containing all UDP ports recognize as DNS
+		 * @return A pointer to a map containing the UDP ports recognized as DNS by default. Ports registered at runtime appear only in
+		 * ProtocolRegistry, so use ProtocolRegistry#isPortOfProtocol() for checking whether a port is recognized as DNS
 		 */
 		static const std::map<uint16_t, bool>* getDNSPortMap();
 	private:
@@ -458,6 +459,8 @@ namespace pcpp
 
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(DnsLayer, DNS);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_DNS_LAYER */
@@ -0,0 +1,182 @@
+#ifndef PACKETPP_DNS_MESSAGE_VIEW
+#define PACKETPP_DNS_MESSAGE_VIEW
+
+#include "DnsLayer.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class DnsMessageView
+	 * A read-only view of a DNS message which doesn't allocate memory. Unlike DnsLayer, which creates a DnsQuery or DnsResource object for
+	 * each record and decodes all record names as soon as it's built, the view only walks over the records once and keeps their offsets in
+	 * an inline array of up to #MaxIndexedRecords entries. Record names are decoded (following compression pointers) only when requested,
+	 * into a buffer given by the caller, and they can be compared to a string in their wire format without decoding them at all. This makes
+	 * it suitable for processing many DNS messages, for example in a passive DNS collector.<BR>
+	 * The view only points into the data, so it's valid as long as the data is. All offsets are in bytes from the beginning of the DNS
+	 * header
+	 */
+	class DnsMessageView
+	{
+	public:
+		/**
+		 * The maximum number of records the view indexes. Records beyond it aren't accessible through the view
+		 */
+		enum { MaxIndexedRecords = 32 };
+
+		/**
+		 * A c'tor for this class which creates an empty view
+		 */
+		DnsMessageView();
+
+		/**
+		 * Index the records of a DNS message. Records are indexed in the order they appear in the message, until #MaxIndexedRecords
+		 * records are indexed or a record which is malformed or exceeds the data is reached
+		 * @param[in] data A pointer to the message, starting at the DNS header (for example the UDP payload)
+		 * @param[in] dataLen The length of the data in bytes. Data beyond 65535 bytes (the maximum DNS message length) is ignored
+		 * @return True if the data contains at least a complete DNS header, false otherwise
+		 */
+		bool parse(const uint8_t* data, size_t dataLen);
+
+		/**
+		 * @return A pointer to the DNS header, or NULL if no message was parsed successfully
+		 */
+		inline const dnshdr* getDnsHeader() const { return (const dnshdr*)m_Data; }
+
+		/**
+		 * @return The number of records the view indexed
+		 */
+		inline size_t getRecordCount() const { return m_NumOfRecords; }
+
+		/**
+		 * @return True if all records counted in the DNS header were indexed, false if the message is malformed, truncated or contains more
+		 * than #MaxIndexedRecords records
+		 */
+		inline bool isComplete() const { return m_Complete; }
+
+		/**
+		 * @param[in] index The index of the record, which must be lower than getRecordCount()
+		 * @return The section the record is in (query, answer, authority or additional)
+		 */
+		inline DnsResourceType getSection(size_t index) const { return (DnsResourceType)m_Records[index].section; }
+
+		/**
+		 * @param[in] index The index of the record, which must be lower than getRecordCount()
+		 * @return The DNS type of the record
+		 */
+		inline DnsType getDnsType(size_t index) const { return (DnsType)readUInt16(m_Records[index].fieldsOffset); }
+
+		/**
+		 * @param[in] index The index of the record, which must be lower than getRecordCount()
+		 * @return The DNS class of the record
+		 */
+		inline DnsClass getDnsClass(size_t index) const { return (DnsClass)readUInt16(m_Records[index].fieldsOffset + sizeof(uint16_t)); }
+
+		/**
+		 * @param[in] index The index of the record, which must be lower than getRecordCount()
+		 * @return The TTL of the record, or 0 for query records
+		 */
+		uint32_t getTTL(size_t index) const;
+
+		/**
+		 * @param[in] index The index of the record, which must be lower than getRecordCount()
+		 * @return The offset of the record name
+		 */
+		inline size_t getNameOffset(size_t index) const { return m_Records[index].nameOffset; }
+
+		/**
+		 * @param[in] index The index of the record, which must be lower than getRecordCount()
+		 * @return The offset of the record data, or 0 for query records. Names in the data (such as the name of a CNAME record) can be
+		 * read with decodeName() and isNameEqualAtOffset()
+		 */
+		inline size_t getDataOffset(size_t index) const { return m_Records[index].dataOffset; }
+
+		/**
+		 * @param[in] index The index of the record, which must be lower than getRecordCount()
+		 * @return A pointer to the record data, or NULL for query records
+		 */
+		inline const uint8_t* getData(size_t index) const { return (m_Records[index].dataOffset > 0 ? m_Data + m_Records[index].dataOffset : NULL); }
+
+		/**
+		 * @param[in] index The index of the record, which must be lower than getRecordCount()
+		 * @return The length of the record data in bytes, or 0 for query records
+		 */
+		inline size_t getDataLength(size_t index) const { return m_Records[index].dataLength; }
+
+		/**
+		 * Decode the name of a record into a buffer
+		 * @param[in] index The index of the record, which must be lower than getRecordCount()
+		 * @param[out] buffer The buffer the name is written to as a null-terminated string, with its labels separated by '.' and without a
+		 * trailing '.' (the root name is an empty string)
+		 * @param[in] bufferLen The buffer length in bytes
+		 * @param[out] nameLen If not NULL, set to the length of the decoded name, not including the terminating null
+		 * @return True if the name was decoded, false if it's malformed or longer than the buffer (in which case the buffer holds an empty string)
+		 */
+		inline bool getName(size_t index, char* buffer, size_t bufferLen, size_t* nameLen = NULL) const { return decodeName(m_Records[index].nameOffset, buffer, bufferLen, nameLen); }
+
+		/**
+		 * Decode a name which starts at a certain offset of the message, such as a name in the data of a record
+		 * @param[in] offset The offset of the encoded name
+		 * @param[out] buffer The buffer the name is written to, as described in getName()
+		 * @param[in] bufferLen The buffer length in bytes
+		 * @param[out] nameLen If not NULL, set to the length of the decoded name, not including the terminating null
+		 * @return True if the name was decoded, false if it's malformed or longer than the buffer (in which case the buffer holds an empty string)
+		 */
+		bool decodeName(size_t offset, char* buffer, size_t bufferLen, size_t* nameLen = NULL) const;
+
+		/**
+		 * Compare the name of a record to a string without decoding the name. The comparison ignores the case of ASCII letters
+		 * @param[in] index The index of the record, which must be lower than getRecordCount()
+		 * @param[in] name A null-terminated name with labels separated by '.' (a trailing '.' is allowed)
+		 * @return True if the record name is equal to the string, false if it isn't or if it's malformed
+		 */
+		inline bool isNameEqual(size_t index, const char* name) const { return isNameEqualAtOffset(m_Records[index].nameOffset, name); }
+
+		/**
+		 * Compare a name which starts at a certain offset of the message to a string without decoding the name, as described in isNameEqual()
+		 * @param[in] offset The offset of the encoded name
+		 * @param[in] name A null-terminated name with labels separated by '.' (a trailing '.' is allowed)
+		 * @return True if the name is equal to the string, false if it isn't or if it's malformed
+		 */
+		bool isNameEqualAtOffset(size_t offset, const char* name) const;
+
+		/**
+		 * Find the first record in a section whose name is equal to a string (compared as in isNameEqual())
+		 * @param[in] section The section to search in
+		 * @param[in] name A null-terminated name with labels separated by '.'
+		 * @return The index of the record, or -1 if there is no such record among the indexed records
+		 */
+		int findRecord(DnsResourceType section, const char* name) const;
+
+	private:
+		struct RecordEntry
+		{
+			uint16_t nameOffset;
+			// the offset of the type, class, TTL and data length fields which follow the name
+			uint16_t fieldsOffset;
+			uint16_t dataOffset;
+			uint16_t dataLength;
+			uint8_t section;
+		};
+
+		const uint8_t* m_Data;
+		size_t m_DataLen;
+		size_t m_NumOfRecords;
+		bool m_Complete;
+		RecordEntry m_Records[MaxIndexedRecords];
+
+		inline uint16_t readUInt16(size_t offset) const { return (uint16_t)((m_Data[offset] << 8) | m_Data[offset + 1]); }
+		size_t skipName(size_t offset) const;
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_DNS_MESSAGE_VIEW */
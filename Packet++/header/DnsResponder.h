@@ -0,0 +1,208 @@
+#ifndef PACKETPP_DNS_RESPONDER
+#define PACKETPP_DNS_RESPONDER
+
+#include "IpAddress.h"
+#include "RawPacket.h"
+#include "HashCounters.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct DnsResponderStats
+	 * The statistics of DnsResponder
+	 */
+	struct DnsResponderStats
+	{
+		/** Number of packets which were DNS queries the responder could handle (see DnsResponder#processPacket()) */
+		uint64_t queries;
+		/** Number of queries turned into responses */
+		uint64_t responses;
+		/** Number of queries no record matched */
+		uint64_t noMatch;
+		/** Number of queries which matched a record but whose response didn't fit in the buffer */
+		uint64_t noRoom;
+		/** Number of packets which weren't DNS queries the responder could handle */
+		uint64_t ignored;
+	};
+
+	/**
+	 * @class DnsResponder
+	 * Turns DNS queries into DNS responses in place, for answering queries at high rates (for example for sinkholing domains). Unlike
+	 * building a response with Packet, DnsLayer#addAnswer() and Packet#computeCalculateFields(), the responder doesn't parse the packet into
+	 * layers or allocate memory: it checks the headers at fixed offsets, looks the question up in a table of answers precompiled into DNS
+	 * wire format, and then rewrites the query buffer into the response:
+	 * - The source and destination MAC addresses, IP addresses and UDP ports are swapped
+	 * - The DNS header is turned into a response header (QR and AA bits set, RA bit set, RCODE 0, one answer) and the authority and
+	 *   additional sections of the query (such as an EDNS OPT record) are removed
+	 * - An answer record, whose name is a compression pointer to the question name, is appended after the question
+	 * - The IP and UDP lengths are updated, the IPv4 TTL or IPv6 hop limit is set to 64, and the IPv4 header checksum and the UDP checksum
+	 *   are updated incrementally (RFC 1624) rather than computed over the whole packet. Please notice this means a query with a wrong UDP
+	 *   checksum gets a response with a wrong checksum. An IPv4 query without a UDP checksum gets a response without a checksum
+	 *
+	 * The responder handles Ethernet frames with up to 2 VLAN tags, carrying IPv4 (not fragmented) or IPv6 (without extension headers), UDP
+	 * to the DNS port and a standard query (opcode 0) with one question of class IN. Answers are A or AAAA records, added with addRecord()
+	 * for a name or for all sub-domains of a name ("*.example.com"). A record for "*" answers every name of its type.<BR>
+	 * The responder works on a single packet buffer, so it can be used with any device. Pcap++ has DnsResponderEngine, which runs it on
+	 * bursts of packets received from DPDK or AF_XDP devices. A responder may be used by one thread at a time, since it updates its
+	 * statistics. To respond on several threads, use a copy of the responder in each thread
+	 */
+	class DnsResponder
+	{
+	public:
+
+		/**
+		 * The result of processing a packet
+		 */
+		enum Result
+		{
+			/** The packet was turned into a response */
+			Responded,
+			/** The packet is a DNS query the responder handles but no record matched its question. The packet wasn't changed */
+			NoMatch,
+			/** A record matched but the response is longer than the buffer. The packet wasn't changed */
+			NoRoom,
+			/** The packet isn't a DNS query the responder handles. The packet wasn't changed */
+			Ignored
+		};
+
+		/**
+		 * The number of bytes the answer record of an AAAA response adds to the query, which is the most a response can be longer than
+		 * a query it was built from
+		 */
+		static const size_t MaxResponseGrowth = 28;
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] dnsPort The UDP destination port of the queries. Default is 53
+		 */
+		DnsResponder(uint16_t dnsPort = 53);
+
+		/**
+		 * Add an A record the responder answers with
+		 * @param[in] name The name of the record, with labels separated by '.' (a trailing '.' is allowed). Names are compared ignoring the
+		 * case of ASCII letters. A name which starts with "*." matches all its sub-domains (but not the name itself), and "*" matches all names
+		 * @param[in] ipAddress The IPv4 address of the answer
+		 * @param[in] ttl The TTL of the answer in seconds
+		 * @return True if the record was added, false if the name isn't valid, or if there is already an A record for it (in which case
+		 * an error is printed to log)
+		 */
+		bool addRecord(const std::string& name, const IPv4Address& ipAddress, uint32_t ttl);
+
+		/**
+		 * Add an AAAA record the responder answers with. See addRecord(const std::string&, const IPv4Address&, uint32_t)
+		 * @param[in] name The name of the record
+		 * @param[in] ipAddress The IPv6 address of the answer
+		 * @param[in] ttl The TTL of the answer in seconds
+		 * @return True if the record was added, false if the name isn't valid or there is already an AAAA record for it
+		 */
+		bool addRecord(const std::string& name, const IPv6Address& ipAddress, uint32_t ttl);
+
+		/**
+		 * @return The number of records the responder answers with
+		 */
+		inline size_t getRecordCount() const { return m_Records.size(); }
+
+		/**
+		 * Get how many responses a record was used for. Records are numbered in the order they were added
+		 * @param[in] index The index of the record, which must be lower than getRecordCount()
+		 * @return The number of responses
+		 */
+		inline uint64_t getRecordHits(size_t index) const { return m_Records[index].hits; }
+
+		/**
+		 * Remove all records
+		 */
+		void clearRecords();
+
+		/**
+		 * Turn a DNS query into a response in place
+		 * @param[in,out] data A pointer to the packet, starting at the Ethernet header
+		 * @param[in,out] dataLen The length of the packet. When the packet is turned into a response it's set to the response length, which
+		 * doesn't include Ethernet padding the query may have had
+		 * @param[in] bufferLen The length of the buffer the packet is in, which limits the response length. A buffer with room for
+		 * #MaxResponseGrowth bytes after the packet is always large enough
+		 * @return The result of processing the packet. The packet is changed only if the result is Responded
+		 */
+		Result processPacket(uint8_t* data, size_t& dataLen, size_t bufferLen);
+
+		/**
+		 * Turn a DNS query into a response in place. The raw packet is resized with RawPacket#appendData() or RawPacket#removeData() before
+		 * the response is written, so with MBufRawPacket the mbuf grows into its tailroom
+		 * @param[in] rawPacket The packet, which must have a link type of Ethernet
+		 * @param[in] maxPacketLen The maximum length the packet may grow to. For a plain RawPacket this must not exceed its buffer length.
+		 * For MBufRawPacket a response which doesn't fit in the mbuf is detected even if this value is larger
+		 * @return The result of processing the packet. The packet is changed only if the result is Responded
+		 */
+		Result processPacket(RawPacket& rawPacket, size_t maxPacketLen);
+
+		/**
+		 * Get the responder statistics
+		 * @param[out] stats The statistics
+		 */
+		inline void getStats(DnsResponderStats& stats) const { stats = m_Stats; }
+
+		/**
+		 * Reset the responder statistics and the hit counts of the records
+		 */
+		void clearStats();
+
+	private:
+
+		struct Record
+		{
+			// the offset and length of the record name in m_NameData, in lowercase DNS wire format without the terminating zero length
+			uint32_t nameOffset;
+			uint16_t nameLen;
+			uint16_t dnsType;
+			bool isWildcard;
+			uint32_t ttl;
+			uint8_t data[16];
+			uint8_t dataLen;
+			// the next record with the same hash table key, or NoRecord
+			uint32_t next;
+			uint64_t hits;
+		};
+
+		// what processPacket() found in a query before changing it
+		struct QueryInfo
+		{
+			size_t ipOffset;
+			bool isIPv4;
+			size_t udpOffset;
+			size_t questionEnd;
+			size_t queryEnd;
+			size_t responseLen;
+			Record* record;
+		};
+
+		static const uint32_t NoRecord = 0xffffffff;
+
+		uint16_t m_DnsPort;
+		std::vector<Record> m_Records;
+		std::vector<uint8_t> m_NameData;
+		// maps a key made of the name, type and wildcard flag to the first record with that key
+		FlatHashMap<uint32_t> m_RecordIndex;
+		DnsResponderStats m_Stats;
+
+		bool addRecord(const std::string& name, uint16_t dnsType, const uint8_t* data, uint8_t dataLen, uint32_t ttl);
+		Record* findRecord(const uint8_t* name, size_t nameLen, uint16_t dnsType, bool isWildcard);
+		Result parseQuery(const uint8_t* data, size_t dataLen, size_t bufferLen, QueryInfo& info);
+		void buildResponse(uint8_t* data, const QueryInfo& info);
+		void updateStats(Result result, Record* record);
+		static uint64_t getRecordKey(const uint8_t* name, size_t nameLen, uint16_t dnsType, bool isWildcard);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_DNS_RESPONDER */
@@ -0,0 +1,221 @@
+#ifndef PACKETPP_DOMAIN_MATCHER
+#define PACKETPP_DOMAIN_MATCHER
+
+#include "QuiescentStateReclaimer.h"
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	class DnsLayer;
+	class SSLHandshakeLayer;
+	class HttpRequestLayer;
+
+	/**
+	 * The domains a DomainRule matches
+	 */
+	enum DomainMatchType
+	{
+		/** Only the domain itself */
+		DomainMatchExact,
+		/** Only the subdomains of the domain, at any depth. A rule whose domain starts with "*." is of this type */
+		DomainMatchSubdomains,
+		/** The domain and all of its subdomains */
+		DomainMatchSuffix
+	};
+
+	/**
+	 * @struct DomainRule
+	 * A rule of a DomainMatcher: a domain and the domains it matches
+	 */
+	struct DomainRule
+	{
+		/** The domain, for example "example.com". Letters are matched case-insensitively and a trailing dot is ignored. A leading "*." makes
+		 * the rule a DomainMatchSubdomains rule regardless of #matchType
+		 */
+		std::string domain;
+		/** The value DomainMatcher#match() returns for the names this rule is the best match of */
+		uint32_t id;
+		/** The domains the rule matches */
+		DomainMatchType matchType;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] domain The domain
+		 * @param[in] id The ID of the rule. Default is 0
+		 * @param[in] matchType The domains the rule matches. Default is DomainMatchSuffix
+		 */
+		DomainRule(const std::string& domain, uint32_t id = 0, DomainMatchType matchType = DomainMatchSuffix) :
+			domain(domain), id(id), matchType(matchType) {}
+	};
+
+
+	/**
+	 * @class DomainMatcher
+	 * Matches domain names against large domain lists (such as blocklists of millions of domains) in time which depends on the number of
+	 * labels of the name rather than on the size of the list. The domains are kept in a single open-addressing hash table keyed by a hash
+	 * of their labels computed from the top-level label down, so the hashes of all suffixes of a name ("www.example.com", "example.com",
+	 * "com") are computed in one pass over the name and each suffix is a single table probe. Entries hold only the hash, the IDs and the
+	 * offset of the domain in one shared string buffer, so a list takes about 32 bytes per domain plus the domains themselves.<BR>
+	 * When several rules match a name the one with the longest domain wins: with the rules "example.com" and "ads.example.com" the name
+	 * "x.ads.example.com" matches the latter.<BR>
+	 * Names are matched as text (a DNS name, a TLS SNI or an HTTP Host), or in DNS wire format directly from a DNS message, following
+	 * compression pointers, without decoding them to a string. matchDns(), matchSni() and matchHttpHost() match the names of DnsLayer,
+	 * SSLHandshakeLayer and HttpRequestLayer without copying them.<BR>
+	 * The compiled domain list is immutable. setRules() builds a new list aside and publishes it with an atomic pointer swap, so matching never
+	 * takes a lock and names are matched with either the old or the new list while it's replaced. Old lists are freed with quiescent-state
+	 * based reclamation (see QuiescentStateReclaimer): threads which match names while the list may be replaced register with registerReader() and
+	 * call quiescentState() when they don't hold a reference to the list, for example between bursts of packets
+	 */
+	class DomainMatcher
+	{
+	public:
+		/**
+		 * The value the match methods return for names which don't match any rule
+		 */
+		static const uint32_t NoMatch = 0xffffffff;
+
+		/**
+		 * A c'tor for this class which creates a matcher without rules
+		 */
+		DomainMatcher();
+
+		/**
+		 * A d'tor for this class. Frees the current and all replaced domain lists, so it must not be called while other threads match names
+		 */
+		~DomainMatcher();
+
+		/**
+		 * Compile a set of rules and replace the current rules with it. Names being matched by other threads while this method runs are
+		 * matched with the old rules. Lists replaced earlier are freed if all registered readers passed a quiescent state since. When several
+		 * rules have the same domain and match type the last one wins
+		 * @param[in] rules The rules. They aren't referenced after this method returns
+		 * @return True if the rules were compiled and replaced the current ones, false if a domain isn't a valid domain name (an empty label,
+		 * a label longer than 63 characters or a name longer than 253 characters). In that case the current rules are kept
+		 */
+		bool setRules(const std::vector<DomainRule>& rules);
+
+		/**
+		 * Remove all rules, same as calling setRules() with an empty vector
+		 */
+		void clearRules();
+
+		/**
+		 * @return The number of distinct domains in the current rules
+		 */
+		size_t getNumOfDomains() const;
+
+		/**
+		 * @return The memory used by the current rules in bytes
+		 */
+		size_t getMemoryUsage() const;
+
+		/**
+		 * Match a domain name in text form
+		 * @param[in] name The name. Letters are matched case-insensitively and a trailing dot is ignored
+		 * @param[in] nameLen The length of the name
+		 * @return The ID of the best matching rule, or #NoMatch if no rule matches or the name isn't a valid domain name
+		 */
+		uint32_t match(const char* name, size_t nameLen) const;
+
+		/**
+		 * Match a domain name in text form, see the other match()
+		 * @param[in] name The name
+		 * @return The ID of the best matching rule, or #NoMatch
+		 */
+		uint32_t match(const std::string& name) const;
+
+		/**
+		 * Match a domain name in DNS wire format (a sequence of length-prefixed labels ending with a zero length), which may contain
+		 * compression pointers into the DNS message
+		 * @param[in] message The DNS message, starting with the DNS header. May be NULL if the name doesn't contain compression pointers
+		 * @param[in] messageLen The length of the message
+		 * @param[in] nameOffset The offset of the name in the message
+		 * @return The ID of the best matching rule, or #NoMatch if no rule matches or the name is malformed
+		 */
+		uint32_t matchWireName(const uint8_t* message, size_t messageLen, size_t nameOffset) const;
+
+		/**
+		 * Match several domain names in text form with the same rules
+		 * @param[in] names The names
+		 * @param[in] count The number of names
+		 * @param[out] ids An array of at least count entries the IDs of the best matching rules (or #NoMatch) are written to
+		 */
+		void matchBatch(const std::string* names, size_t count, uint32_t* ids) const;
+
+		/**
+		 * Match the names of the queries of a DNS message, in wire format
+		 * @param[in] dnsLayer The DNS layer
+		 * @return The ID of the best matching rule of the first query which matches a rule, or #NoMatch
+		 */
+		uint32_t matchDns(DnsLayer& dnsLayer) const;
+
+		/**
+		 * Match the server name (SNI) of the client hello message of a TLS handshake
+		 * @param[in] handshakeLayer The handshake layer
+		 * @return The ID of the best matching rule, or #NoMatch if the layer doesn't contain a client hello with a server name or it
+		 * doesn't match
+		 */
+		uint32_t matchSni(SSLHandshakeLayer& handshakeLayer) const;
+
+		/**
+		 * Match the host of the Host header of an HTTP request. A port after the host is ignored
+		 * @param[in] httpRequest The HTTP request layer
+		 * @return The ID of the best matching rule, or #NoMatch if the request has no Host header, the host is an IPv6 address or it
+		 * doesn't match
+		 */
+		uint32_t matchHttpHost(HttpRequestLayer& httpRequest) const;
+
+		/**
+		 * Register the calling thread as a reader, a thread which matches names while rules may be replaced. Lists replaced after a reader
+		 * registered aren't freed until it calls quiescentState() or unregisterReader()
+		 * @return A reader ID to pass to quiescentState() and unregisterReader(), or -1 if #PCPP_QUIESCENT_STATE_MAX_READERS readers are
+		 * already registered
+		 */
+		int registerReader();
+
+		/**
+		 * Unregister a reader. The reader must not match names after this method is called unless it registers again
+		 * @param[in] readerId The reader ID registerReader() returned
+		 */
+		void unregisterReader(int readerId);
+
+		/**
+		 * Announce a reader doesn't hold a reference to the rules: it isn't in the middle of a match call. This method is cheap (an atomic
+		 * load and store) and should be called regularly, for example after each burst of packets
+		 * @param[in] readerId The reader ID registerReader() returned
+		 */
+		void quiescentState(int readerId);
+
+		/**
+		 * Free the replaced lists all registered readers are done with. setRules() does this too, so calling it is only needed to free
+		 * memory sooner
+		 * @return The number of lists which are still waiting for readers to pass a quiescent state
+		 */
+		size_t reclaim();
+
+	private:
+		struct DomainSet;
+
+		DomainSet* volatile m_DomainSet;
+		QuiescentStateReclaimer<DomainSet*> m_Reclaimer;
+		pthread_mutex_t m_Mutex;
+
+		// disable copy c'tor and assignment operator
+		DomainMatcher(const DomainMatcher& other);
+		DomainMatcher& operator=(const DomainMatcher& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_DOMAIN_MATCHER */
@@ -147,9 +147,13 @@ namespace pcpp
 
 		std::string toString();
 
+		void dump(PacketDumpWriter& writer);
+
 		OsiModelLayer getOsiModelLayer() const { return OsiModelDataLinkLayer; }
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(EthLayer, Ethernet);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_ETH_LAYER */
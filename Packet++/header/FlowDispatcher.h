@@ -0,0 +1,283 @@
+#ifndef PACKETPP_FLOW_DISPATCHER
+#define PACKETPP_FLOW_DISPATCHER
+
+#include "RawPacket.h"
+#include "FlowHash.h"
+#include "RawPacketQueue.h"
+#include "StatsReporter.h"
+#include <vector>
+#include <pthread.h>
+
+/**
+ * @file
+ * A software RSS (Receive Side Scaling) stage for sources which deliver all packets on a single thread, such as a pcap file, a single
+ * queue NIC captured with pcpp#PcapLiveDevice, a pcpp#KniDevice or a pcpp#RawSocketDevice. The packets are spread between several worker
+ * threads with per-flow affinity, the same way NICs spread packets between RX queues.
+ *
+ * The thread reading the source gives the packets to pcpp#FlowDispatcher#dispatchPackets. For each packet a symmetric hash of its
+ * 5-tuple (see pcpp#FlowHash#hashSymmetric) is calculated from the raw headers (see pcpp#FlowKeyExtractor), without parsing the packet
+ * into layers, so both directions of a flow get the same hash. The hash selects a bucket of an indirection table (like the RETA of a
+ * NIC) and the bucket selects the worker. The packet data is copied into a single-producer single-consumer queue (pcpp#SPSCQueue) of
+ * that worker, so the source may reuse its buffers as soon as dispatchPackets() returns. Each worker thread takes bursts of packets from
+ * its queue and passes them to the user's callback without copying them again.
+ *
+ * The number of packets dispatched through each bucket is counted, so when a few heavy flows overload a worker the buckets can be
+ * spread again with pcpp#FlowDispatcher#rebalance, either explicitly or automatically every
+ * pcpp#FlowDispatcherConfiguration#rebalanceInterval packets. Packets of a moved bucket which were queued before the move are still
+ * processed by the old worker, so for a short time packets of such a flow may be processed by two workers at once.
+ *
+ * Basic usage:
+ * - create an instance with the callback and a pcpp#FlowDispatcherConfiguration
+ * - call pcpp#FlowDispatcher#start to start the worker threads
+ * - call pcpp#FlowDispatcher#dispatchPackets for each burst read from the source
+ * - when done, call pcpp#FlowDispatcher#stop, which returns after all queued packets were processed
+ */
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * @struct FlowDispatcherConfiguration
+ * A structure for configuring the FlowDispatcher class
+ */
+struct FlowDispatcherConfiguration
+{
+	/** The number of worker threads */
+	int numOfWorkers;
+	/** The number of packets which can be queued for each worker */
+	size_t queueCapacity;
+	/** If true, packets are dropped when the queue of their worker is full. Otherwise the dispatching thread waits until the worker makes
+	 * room, so no packets are lost but a slow worker slows the source down
+	 */
+	bool dropWhenFull;
+	/** The maximum number of packets a worker passes to the callback at once */
+	uint32_t maxBurstSize;
+	/** The number of buckets of the indirection table. More buckets allow spreading the load more evenly. It's raised to the number of
+	 * workers if it's smaller
+	 */
+	uint32_t indirectionTableSize;
+	/** The number of dispatched packets after which the buckets are spread again automatically (see FlowDispatcher#rebalance()), or 0 to
+	 * rebalance only when FlowDispatcher#rebalance() is called
+	 */
+	uint64_t rebalanceInterval;
+
+	/**
+	 * A c'tor for this struct
+	 * @param[in] numOfWorkers The number of worker threads. The default is 1
+	 * @param[in] queueCapacity The number of packets which can be queued for each worker. The default is 1024
+	 * @param[in] dropWhenFull Whether to drop packets when a queue is full instead of waiting. The default is false
+	 * @param[in] maxBurstSize The maximum number of packets passed to the callback at once. The default is 32
+	 * @param[in] indirectionTableSize The number of buckets of the indirection table. The default is 128, as in the RETA of most NICs
+	 * @param[in] rebalanceInterval The number of packets between automatic rebalances, or 0 to disable them. The default is 0
+	 */
+	FlowDispatcherConfiguration(int numOfWorkers = 1, size_t queueCapacity = 1024, bool dropWhenFull = false, uint32_t maxBurstSize = 32,
+			uint32_t indirectionTableSize = 128, uint64_t rebalanceInterval = 0) :
+		numOfWorkers(numOfWorkers), queueCapacity(queueCapacity), dropWhenFull(dropWhenFull), maxBurstSize(maxBurstSize),
+		indirectionTableSize(indirectionTableSize), rebalanceInterval(rebalanceInterval)
+	{
+	}
+};
+
+
+/**
+ * @class FlowDispatcher
+ * Spreads the packets of a single source between worker threads by a symmetric hash of their 5-tuple. Please refer to the documentation
+ * at the top of FlowDispatcher.h for understanding how to use this class
+ */
+class FlowDispatcher
+{
+public:
+
+	/**
+	 * @typedef OnPacketsDispatched
+	 * A callback invoked on a worker thread with a burst of packets dispatched to this worker
+	 * @param[in] packets An array of the packets. Their data points into the queue of the worker, so the packets are valid only until the
+	 * callback returns
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] workerIndex The index of the worker, between 0 and getNumOfWorkers()-1
+	 * @param[in] dispatcher The FlowDispatcher instance
+	 * @param[in] userCookie The cookie of the worker (see setWorkerUserCookie())
+	 */
+	typedef void (*OnPacketsDispatched)(RawPacket* packets, uint32_t numOfPackets, int workerIndex, FlowDispatcher* dispatcher, void* userCookie);
+
+	/**
+	 * The IDs of the counters in getStatsCounters(). The dispatching thread's counters are kept by worker ID 0 and the counters of each
+	 * worker by worker ID 1 + worker index
+	 */
+	enum StatsCounterId
+	{
+		/** Packets queued for a worker */
+		PacketsDispatched,
+		/** Packets dropped because the queue of their worker was full */
+		PacketsDropped,
+		/** Packets passed to the callback by a worker */
+		PacketsProcessed,
+		/** Buckets moved to another worker by rebalance() */
+		BucketsMoved,
+		/** The number of counters */
+		NumOfStatsCounters
+	};
+
+	/**
+	 * A c'tor for this class. The worker threads aren't started until start() is called
+	 * @param[in] onPacketsDispatched The callback invoked with the packets of each worker
+	 * @param[in] userCookie A pointer provided by the user which is passed to the callback of all workers unless a worker has its own
+	 * cookie (see setWorkerUserCookie()). This parameter is optional, default cookie is NULL
+	 * @param[in] config Optional parameter for defining the number of workers and other parameters. If not set the default parameters
+	 * will be set
+	 */
+	FlowDispatcher(OnPacketsDispatched onPacketsDispatched, void* userCookie = NULL, const FlowDispatcherConfiguration& config = FlowDispatcherConfiguration());
+
+	/**
+	 * A d'tor for this class. Stops the worker threads if they're running
+	 */
+	~FlowDispatcher();
+
+	/**
+	 * Set the cookie passed to the callback of a worker. Should be called before start()
+	 * @param[in] workerIndex The worker index
+	 * @param[in] userCookie The cookie
+	 */
+	void setWorkerUserCookie(int workerIndex, void* userCookie);
+
+	/**
+	 * Start the worker threads
+	 * @return True if all threads were started or they're already running, false if a thread couldn't be created (in this case none is
+	 * left running)
+	 */
+	bool start();
+
+	/**
+	 * Stop the worker threads after they process all queued packets. The source should stop calling dispatchPackets() before this method
+	 * is called. Does nothing if the threads aren't running
+	 */
+	void stop();
+
+	/**
+	 * @return True if the worker threads are running
+	 */
+	bool isRunning() const { return m_Running; }
+
+	/**
+	 * Queue a packet for the worker its flow belongs to. Should be called by a single thread at a time. Packets which aren't IPv4 or IPv6
+	 * all go to the worker of the first bucket. If the worker threads aren't running the packet is queued, or dropped if the queue is full
+	 * @param[in] rawPacket The packet. Its data is copied
+	 * @return True if the packet was queued, false if it was dropped
+	 */
+	bool dispatchPacket(RawPacket* rawPacket);
+
+	/**
+	 * Queue a burst of packets, see dispatchPacket(). The hashes of the whole burst are calculated together before the packets are queued
+	 * @param[in] rawPackets An array of packets. Their data is copied
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @return The number of packets queued
+	 */
+	size_t dispatchPackets(RawPacket* rawPackets, size_t numOfPackets);
+
+	/**
+	 * Calculate the hash the dispatcher uses for a packet
+	 * @param[in] rawPacket The packet
+	 * @return The symmetric 5-tuple hash of the packet (see FlowHash#hashSymmetric()), or 0 if it's not an IPv4 or IPv6 packet
+	 */
+	static uint32_t getFlowHash(RawPacket* rawPacket);
+
+	/**
+	 * @param[in] rawPacket The packet
+	 * @return The index of the worker the packet is currently dispatched to
+	 */
+	int getWorkerIndex(RawPacket* rawPacket) const { return m_IndirectionTable[getBucket(getFlowHash(rawPacket))]; }
+
+	/**
+	 * @param[in] flowHash A hash returned by getFlowHash()
+	 * @return The index of the indirection table bucket the hash falls in
+	 */
+	inline uint32_t getBucket(uint32_t flowHash) const { return (uint32_t)(((uint64_t)flowHash * m_IndirectionTable.size()) >> 32); }
+
+	/**
+	 * @return The indirection table: the worker index of each bucket
+	 */
+	const std::vector<int>& getIndirectionTable() const { return m_IndirectionTable; }
+
+	/**
+	 * Replace the indirection table. Should be called by the thread calling dispatchPackets(), or while no packets are dispatched
+	 * @param[in] table The worker index of each bucket. Its size must be the size of the current table
+	 * @return True if the table was replaced, false if its size is wrong or a worker index is out of range
+	 */
+	bool setIndirectionTable(const std::vector<int>& table);
+
+	/**
+	 * Move buckets from the busiest workers to the least busy ones according to the number of packets dispatched through each bucket since
+	 * the previous rebalance. A bucket is moved only if this lowers the load of the busiest worker, so a single flow heavier than all others
+	 * isn't moved back and forth. Should be called by the thread calling dispatchPackets(), or while no packets are dispatched
+	 * @return The number of buckets moved
+	 */
+	size_t rebalance();
+
+	/**
+	 * @return The number of workers
+	 */
+	int getNumOfWorkers() const { return (int)m_Workers.size(); }
+
+	/**
+	 * Get the statistics of the dispatching thread and the workers, see StatsCounterId. They can be read while the threads are running,
+	 * for example with StatsCounters#aggregate() or by a StatsReporter
+	 * @return The statistics counters
+	 */
+	const StatsCounters& getStatsCounters() const { return m_Stats; }
+
+private:
+
+	struct Worker
+	{
+		FlowDispatcher* owner;
+		int index;
+		void* userCookie;
+		RawPacketQueue* queue;
+		pthread_t thread;
+	};
+
+	enum
+	{
+		// the number of packets whose hashes are calculated together by dispatchPackets()
+		HashBatchSize = 32,
+		// the number of rounds a worker polls an empty queue before it starts sleeping between rounds
+		IdleSpinRounds = 64
+	};
+
+	std::vector<Worker*> m_Workers;
+	OnPacketsDispatched m_OnPacketsDispatched;
+	bool m_DropWhenFull;
+	uint32_t m_MaxBurstSize;
+	std::vector<int> m_IndirectionTable;
+	// the number of packets dispatched through each bucket since the last rebalance, owned by the dispatching thread
+	std::vector<uint64_t> m_BucketLoads;
+	uint64_t m_RebalanceInterval;
+	uint64_t m_PacketsSinceRebalance;
+	StatsCounters m_Stats;
+	volatile bool m_Running;
+	volatile size_t m_StopRequested;
+	// serializes start() and stop()
+	pthread_mutex_t m_ControlMutex;
+
+	bool queuePacket(RawPacket* rawPacket, uint32_t flowHash);
+
+	size_t processQueue(Worker* worker, RawPacket* rawPackets, QueuedRawPacket** queuedPackets);
+
+	void stopThreads(size_t numOfThreads);
+
+	static void* workerThreadMain(void* workerPtr);
+
+	static std::vector<std::string> getStatsCounterNames();
+
+	// disable copy c'tor and assignment operator
+	FlowDispatcher(const FlowDispatcher& other);
+	FlowDispatcher& operator=(const FlowDispatcher& other);
+};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_FLOW_DISPATCHER */
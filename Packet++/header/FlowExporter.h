@@ -0,0 +1,230 @@
+#ifndef PACKETPP_FLOW_EXPORTER
+#define PACKETPP_FLOW_EXPORTER
+
+#include "FlowMeter.h"
+#include "MacAddress.h"
+#include "IpAddress.h"
+#include "RawPacket.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * The export protocols FlowExporter supports
+	 */
+	enum FlowExportProtocol
+	{
+		/** NetFlow version 9 (RFC 3954) */
+		FlowExportNetFlowV9 = 9,
+		/** IPFIX (RFC 7011) */
+		FlowExportIPFIX = 10
+	};
+
+
+	/**
+	 * @struct FlowExporterConfiguration
+	 * The configuration of a FlowExporter: the protocol and the addresses of the export packets
+	 */
+	struct FlowExporterConfiguration
+	{
+		/** The export protocol */
+		FlowExportProtocol protocol;
+		/** The source MAC address of the export packets */
+		MacAddress srcMac;
+		/** The destination MAC address of the export packets (usually the MAC address of the collector or of the gateway) */
+		MacAddress dstMac;
+		/** The source IPv4 address of the export packets */
+		IPv4Address srcIP;
+		/** The IPv4 address of the collector */
+		IPv4Address dstIP;
+		/** The source UDP port of the export packets */
+		uint16_t srcPort;
+		/** The UDP port of the collector */
+		uint16_t dstPort;
+		/** The observation domain ID (IPFIX) or source ID (NetFlow v9) of the exporter */
+		uint32_t observationDomainId;
+		/** The maximum length of the UDP payload of an export packet. Default value is 1400 */
+		uint16_t maxMessageLength;
+		/** The number of seconds (in record time) after which the templates are sent again. Default value is 60 */
+		uint32_t templateRefreshInterval;
+		/**
+		 * NetFlow v9 only: the time in milliseconds since the epoch the exporter's "system uptime" counts from, which the flow start and end
+		 * times are relative to. 0 means the start time of the first exported record is used. Default value is 0
+		 */
+		uint64_t systemInitTime;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] protocol The export protocol
+		 * @param[in] srcMac The source MAC address of the export packets
+		 * @param[in] dstMac The destination MAC address of the export packets
+		 * @param[in] srcIP The source IPv4 address of the export packets
+		 * @param[in] dstIP The IPv4 address of the collector
+		 * @param[in] dstPort The UDP port of the collector. Default value is 4739 (the IPFIX port)
+		 * @param[in] observationDomainId The observation domain ID or source ID. Default value is 0
+		 */
+		FlowExporterConfiguration(FlowExportProtocol protocol, const MacAddress& srcMac, const MacAddress& dstMac, const IPv4Address& srcIP,
+				const IPv4Address& dstIP, uint16_t dstPort = 4739, uint32_t observationDomainId = 0) :
+			protocol(protocol), srcMac(srcMac), dstMac(dstMac), srcIP(srcIP), dstIP(dstIP), srcPort(dstPort), dstPort(dstPort),
+			observationDomainId(observationDomainId), maxMessageLength(1400), templateRefreshInterval(60), systemInitTime(0) {}
+	};
+
+
+	/**
+	 * @struct FlowExporterStats
+	 * The statistics of a FlowExporter
+	 */
+	struct FlowExporterStats
+	{
+		/** Number of export packets sent to the callback */
+		uint64_t packets;
+		/** Number of flow records exported */
+		uint64_t records;
+		/** Number of times the templates were sent */
+		uint64_t templates;
+	};
+
+
+	/**
+	 * @class FlowExporter
+	 * Encodes FlowRecord structs (usually exported by a FlowMeter) into NetFlow v9 or IPFIX messages, and hands them to a callback as
+	 * complete Ethernet / IPv4 / UDP packets ready to be sent through any device. Records are appended to a message until it's full
+	 * (see FlowExporterConfiguration#maxMessageLength) or flush() is called.<BR>
+	 * The Ethernet, IPv4 and UDP headers are built once with EthLayer, IPv4Layer and UdpLayer when the exporter is created, and the messages
+	 * are encoded after them in a buffer allocated once, so exporting doesn't allocate memory. For each packet only the lengths and the IPv4
+	 * and UDP checksums are updated. Since the payload is at a fixed offset (#HeadersLength) the messages can also be sent through a UDP socket
+	 * by skipping the headers.<BR>
+	 * The exporter uses two templates, for IPv4 flows (template ID 256) and IPv6 flows (template ID 257), with the fields: source and
+	 * destination addresses and ports, protocol, type of service, TCP flags, VLAN ID, top MPLS label, tunnel ID (as layer2SegmentId),
+	 * packet and byte counts, flow start and end times and flowEndReason. The IPFIX information element numbers are used with both
+	 * protocols, and with NetFlow v9 the times are FIRST_SWITCHED and LAST_SWITCHED relative to the system uptime. The templates are sent in
+	 * the first message and again every FlowExporterConfiguration#templateRefreshInterval seconds, as required when exporting over UDP.<BR>
+	 * Time is taken from the records (the latest end time of the exported records is the export time), so an exporter works the same on
+	 * live traffic and on capture files. An exporter isn't thread-safe
+	 */
+	class FlowExporter
+	{
+	public:
+
+		/**
+		 * A callback invoked with each export packet
+		 * @param[in] packet The packet, starting at the Ethernet header. Its data belongs to the exporter and is valid only until the
+		 * callback returns
+		 * @param[in] userCookie The cookie given in the c'tor
+		 */
+		typedef void (*OnExportPacket)(RawPacket& packet, void* userCookie);
+
+		/**
+		 * The length of the Ethernet, IPv4 and UDP headers preceding the messages in the export packets
+		 */
+		static const size_t HeadersLength = 42;
+
+		/**
+		 * The template ID of IPv4 flow records
+		 */
+		static const uint16_t IPv4TemplateId = 256;
+
+		/**
+		 * The template ID of IPv6 flow records
+		 */
+		static const uint16_t IPv6TemplateId = 257;
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The configuration of the exporter
+		 * @param[in] onExportPacket The callback to invoke with each export packet
+		 * @param[in] userCookie A pointer passed to the callback. Default value is NULL
+		 */
+		FlowExporter(const FlowExporterConfiguration& config, OnExportPacket onExportPacket, void* userCookie = NULL);
+
+		/**
+		 * A d'tor for this class. Records which weren't sent yet are discarded, so flush() should be called before
+		 */
+		~FlowExporter();
+
+		/**
+		 * Append a record to the current message. If the message is full it's sent first
+		 * @param[in] record The record
+		 */
+		void exportRecord(const FlowRecord& record);
+
+		/**
+		 * Send the current message if it has any records
+		 */
+		void flush();
+
+		/**
+		 * A FlowMeter#OnFlowExported callback which exports the record with the FlowExporter given as the cookie
+		 * @param[in] record The record
+		 * @param[in] userCookie A pointer to a FlowExporter
+		 */
+		static void onFlowExported(const FlowRecord& record, void* userCookie);
+
+		/**
+		 * @return The configuration of the exporter
+		 */
+		inline const FlowExporterConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * Get the exporter statistics
+		 * @param[out] stats The statistics
+		 */
+		inline void getStats(FlowExporterStats& stats) const { stats = m_Stats; }
+
+	private:
+
+		struct TemplateField
+		{
+			uint16_t id;
+			uint16_t length;
+		};
+
+		static const TemplateField IPv4TemplateFields[];
+		static const TemplateField IPv6TemplateFields[];
+
+		FlowExporterConfiguration m_Config;
+		OnExportPacket m_OnExportPacket;
+		void* m_UserCookie;
+		uint8_t* m_Buffer;
+		size_t m_BufferLen;
+		RawPacket m_Packet;
+		// the end of the message encoded so far as an offset in m_Buffer, or 0 if no message is being encoded
+		size_t m_MessageEnd;
+		uint16_t m_NumOfRecords;
+		uint16_t m_NumOfTemplateRecords;
+		// the offset of the header of the current set, or 0 if no set is open
+		size_t m_SetOffset;
+		uint16_t m_SetTemplateId;
+		uint64_t m_ExportTime;
+		uint64_t m_LastTemplateTime;
+		bool m_TemplatesSent;
+		uint32_t m_SequenceNumber;
+		FlowExporterStats m_Stats;
+
+		void buildHeaders();
+		void startMessage();
+		void closeSet();
+		void writeTemplates();
+		void writeRecord(const FlowRecord& record, const TemplateField* fields, size_t numOfFields);
+		void sendMessage();
+		size_t getRecordLength(const TemplateField* fields, size_t numOfFields) const;
+		void getTemplate(uint16_t templateId, const TemplateField*& fields, size_t& numOfFields) const;
+		uint16_t getFieldId(const TemplateField& field) const;
+		uint16_t getFieldLength(const TemplateField& field) const;
+
+		// disable copy c'tor and assignment operator
+		FlowExporter(const FlowExporter& other);
+		FlowExporter& operator=(const FlowExporter& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_FLOW_EXPORTER */
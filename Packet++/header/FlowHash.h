@@ -0,0 +1,134 @@
+#ifndef PACKETPP_FLOW_HASH
+#define PACKETPP_FLOW_HASH
+
+#include "PacketView.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct FlowTuple
+	 * A plain struct holding the 5-tuple of a packet (source and destination IP addresses and ports, and the IP protocol). It can be filled
+	 * directly from a PacketView (see FlowHash#getTuple()) so hashing a packet doesn't require creating any Layer objects
+	 */
+	struct FlowTuple
+	{
+		/** The source IP address in network byte order. For IPv4 only the first 4 bytes are used */
+		uint8_t srcIP[16];
+		/** The destination IP address in network byte order. For IPv4 only the first 4 bytes are used */
+		uint8_t dstIP[16];
+		/** The source port in host byte order, or 0 if the packet isn't TCP or UDP */
+		uint16_t srcPort;
+		/** The destination port in host byte order, or 0 if the packet isn't TCP or UDP */
+		uint16_t dstPort;
+		/** The IP protocol of the data following the IP header (see ::IPProtocolTypes) */
+		uint8_t protocol;
+		/** The IP version: 4 or 6 */
+		uint8_t ipVersion;
+	};
+
+	/**
+	 * Compare two tuples. All bytes of the IP addresses are compared, including the bytes IPv4 addresses don't use, which
+	 * FlowHash#getTuple() sets to zero
+	 * @param[in] first The first tuple
+	 * @param[in] second The second tuple
+	 * @return True if all fields of the tuples are equal
+	 */
+	inline bool operator==(const FlowTuple& first, const FlowTuple& second)
+	{
+		return memcmp(first.srcIP, second.srcIP, sizeof(first.srcIP)) == 0 && memcmp(first.dstIP, second.dstIP, sizeof(first.dstIP)) == 0 &&
+				first.srcPort == second.srcPort && first.dstPort == second.dstPort && first.protocol == second.protocol &&
+				first.ipVersion == second.ipVersion;
+	}
+
+
+	/**
+	 * @class FlowHash
+	 * Fast non-cryptographic hash functions over 5-tuples, meant for flow tables and for distributing packets between worker threads:
+	 * - hash() - a CRC32C of the tuple. On x86 CPUs supporting SSE4.2 and on ARM CPUs with the CRC extension it's computed with the
+	 *   dedicated CRC32C instructions (the x86 instructions are selected at runtime), otherwise with a table-based software implementation.
+	 *   All implementations return the same value
+	 * - hashSymmetric() - same as hash() but both directions of a flow get the same value
+	 * - hashToeplitz() - the Toeplitz hash NICs use for Receive Side Scaling (RSS), so the hash of a packet can be matched with the RX queue
+	 *   it was received on
+	 * - hashBatch() - hash() or hashSymmetric() of an array of tuples
+	 *
+	 * Please notice the values are different from hash5Tuple() and hash2Tuple() values
+	 */
+	class FlowHash
+	{
+	public:
+
+		/**
+		 * The length in bytes of DefaultRSSKey
+		 */
+		static const size_t DefaultRSSKeyLength = 40;
+
+		/**
+		 * The default RSS key DpdkDevice configures the NIC with (a repetition of 0x6D, 0x5A). With this key the Toeplitz hash is
+		 * symmetric, meaning both directions of a flow get the same value
+		 */
+		static const uint8_t DefaultRSSKey[DefaultRSSKeyLength];
+
+		/**
+		 * Fill a FlowTuple from a PacketView
+		 * @param[in] view The view to take the tuple from (see FlowKeyExtractor#extract())
+		 * @param[out] tuple The tuple to fill. All its fields are overwritten
+		 * @return True if the view describes an IPv4 or IPv6 packet, false otherwise. Ports are set only for TCP and UDP packets
+		 */
+		static bool getTuple(const PacketView& view, FlowTuple& tuple);
+
+		/**
+		 * Calculate the CRC32C hash of a tuple
+		 * @param[in] tuple The tuple to hash
+		 * @param[in] seed An optional seed which allows getting different hash functions (for example for multiple hash tables)
+		 * @return The hash value
+		 */
+		static uint32_t hash(const FlowTuple& tuple, uint32_t seed = 0);
+
+		/**
+		 * Calculate a symmetric CRC32C hash of a tuple: the source and destination endpoints (IP address and port) are ordered before
+		 * hashing so both directions of a flow get the same value
+		 * @param[in] tuple The tuple to hash
+		 * @param[in] seed An optional seed, as in hash()
+		 * @return The hash value
+		 */
+		static uint32_t hashSymmetric(const FlowTuple& tuple, uint32_t seed = 0);
+
+		/**
+		 * Calculate the Toeplitz (RSS) hash of a tuple, as calculated by NICs. The input is the source IP address, the destination IP
+		 * address and optionally the source and destination ports, all in network byte order
+		 * @param[in] tuple The tuple to hash
+		 * @param[in] includePorts If true the ports are part of the input (the RSS hash NICs use for TCP and UDP), otherwise only the IP
+		 * addresses are (the RSS hash for other IP packets). Default value is true
+		 * @param[in] key The RSS key. Default value is DefaultRSSKey. Use the key the NIC was configured with (for example
+		 * DpdkDevice::DpdkDeviceConfiguration#rssKey) to get the same values as the NIC
+		 * @param[in] keyLength The key length in bytes. It should be at least 4 bytes longer than the input (16 bytes for IPv4 with ports,
+		 * 40 bytes for IPv6 with ports), otherwise 0 is returned. Default value is DefaultRSSKeyLength
+		 * @return The hash value
+		 */
+		static uint32_t hashToeplitz(const FlowTuple& tuple, bool includePorts = true, const uint8_t* key = DefaultRSSKey, size_t keyLength = DefaultRSSKeyLength);
+
+		/**
+		 * Calculate the hash of an array of tuples
+		 * @param[in] tuples The tuples to hash
+		 * @param[in] count The number of tuples
+		 * @param[out] hashes An array of at least count entries the hash values are written to
+		 * @param[in] symmetric If true hashSymmetric() values are calculated, otherwise hash() values. Default value is false
+		 * @param[in] seed An optional seed, as in hash()
+		 */
+		static void hashBatch(const FlowTuple* tuples, size_t count, uint32_t* hashes, bool symmetric = false, uint32_t seed = 0);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_FLOW_HASH */
@@ -0,0 +1,282 @@
+#ifndef PACKETPP_FLOW_METER
+#define PACKETPP_FLOW_METER
+
+#include "FlowTable.h"
+#include "PacketView.h"
+#include "RawPacket.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * The reasons a flow record is exported. The values are the values of the IPFIX flowEndReason information element (RFC 5102)
+	 */
+	enum FlowEndReason
+	{
+		/** The flow had no packets for longer than the idle timeout */
+		FlowEndIdleTimeout = 1,
+		/** The flow lasted longer than the active timeout. The flow goes on, and its next packets are counted in a new record */
+		FlowEndActiveTimeout = 2,
+		/** A TCP FIN or RST was seen on the flow */
+		FlowEndDetected = 3,
+		/** The flow was exported by FlowMeter#flush() */
+		FlowEndForced = 4,
+		/** The flow was evicted to make room for a new flow (see FlowMeterConfiguration#maxFlows) */
+		FlowEndLackOfResources = 5
+	};
+
+
+	/**
+	 * @struct FlowRecord
+	 * The counters of one unidirectional flow, as reported by FlowMeter when the flow is exported. All times are in milliseconds since
+	 * the epoch, taken from the packet timestamps
+	 */
+	struct FlowRecord
+	{
+		/** The 5-tuple of the flow (of the inner packet when tunnels are decapsulated) */
+		FlowTuple tuple;
+		/** The VLAN ID of the outermost VLAN tag of the (inner) packet, or 0 if it has no VLAN tag */
+		uint16_t vlanId;
+		/** The tunnel identifier (see TunnelInfo#getTunnelId()), or 0 if the packet isn't tunneled or tunnels aren't decapsulated */
+		uint32_t tunnelId;
+		/** The top MPLS label of the first packet of the flow, or 0 if it has no MPLS labels */
+		uint32_t mplsLabel;
+		/** The IPv4 type of service or IPv6 traffic class of the first packet of the flow */
+		uint8_t tos;
+		/** The TCP flags of all packets of the flow OR-ed together, or 0 if the flow isn't TCP */
+		uint8_t tcpFlags;
+		/** The reason the record was exported */
+		FlowEndReason endReason;
+		/** The number of packets */
+		uint64_t packets;
+		/** The number of bytes, counted from the beginning of the (inner) IP header as in the IP length field */
+		uint64_t bytes;
+		/** The timestamp of the first packet in milliseconds */
+		uint64_t firstSeen;
+		/** The timestamp of the last packet in milliseconds */
+		uint64_t lastSeen;
+	};
+
+
+	/**
+	 * @struct FlowMeterConfiguration
+	 * The configuration of a FlowMeter
+	 */
+	struct FlowMeterConfiguration
+	{
+		/**
+		 * The number of seconds without packets after which a flow is exported and removed. 0 means flows are exported only by the other
+		 * conditions
+		 */
+		uint32_t idleTimeout;
+
+		/**
+		 * The number of seconds after which a long-lived flow is exported even though it still has packets. Its next packet starts a new
+		 * record. 0 means flows are never exported while active
+		 */
+		uint32_t activeTimeout;
+
+		/**
+		 * The maximum number of flows the meter keeps. When a new flow arrives while the table is full the least recently seen flow is
+		 * exported with ::FlowEndLackOfResources. 0 means no limit
+		 */
+		size_t maxFlows;
+
+		/**
+		 * If true, a TCP flow is exported and removed as soon as a FIN or RST is seen on it (so packets following the FIN start a new record).
+		 * If false TCP flows end only by the timeouts
+		 */
+		bool exportOnTcpEnd;
+
+		/**
+		 * If true, packets are decapsulated with TunnelDecapsulator and metered by their inner headers, and the tunnel identifier becomes
+		 * part of the flow key. If false packets are metered by their outer headers, which is faster
+		 */
+		bool decapsulateTunnels;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] idleTimeout The idle timeout in seconds. Default value is 15
+		 * @param[in] activeTimeout The active timeout in seconds. Default value is 1800
+		 * @param[in] maxFlows The maximum number of flows, or 0 for no limit. Default value is 0
+		 * @param[in] exportOnTcpEnd Whether to export TCP flows when a FIN or RST is seen. Default value is true
+		 * @param[in] decapsulateTunnels Whether to meter tunneled packets by their inner headers. Default value is false
+		 */
+		FlowMeterConfiguration(uint32_t idleTimeout = 15, uint32_t activeTimeout = 1800, size_t maxFlows = 0, bool exportOnTcpEnd = true,
+				bool decapsulateTunnels = false) :
+			idleTimeout(idleTimeout), activeTimeout(activeTimeout), maxFlows(maxFlows), exportOnTcpEnd(exportOnTcpEnd),
+			decapsulateTunnels(decapsulateTunnels) {}
+	};
+
+
+	/**
+	 * @struct FlowMeterStats
+	 * The statistics of a FlowMeter
+	 */
+	struct FlowMeterStats
+	{
+		/** Number of packets processed */
+		uint64_t packets;
+		/** Number of packets which weren't metered because they don't contain an IPv4 or IPv6 header */
+		uint64_t nonIpPackets;
+		/** Number of flows created */
+		uint64_t flowsCreated;
+		/** Number of flow records exported */
+		uint64_t recordsExported;
+	};
+
+
+	/**
+	 * @class FlowMeter
+	 * Keeps NetFlow / IPFIX style counters of unidirectional flows and exports a FlowRecord for each flow when it ends. Packets are read
+	 * with FlowKeyExtractor (or TunnelDecapsulator) directly from the raw data, without creating a Packet, and the flows are kept in a
+	 * FlowTable, so metering a packet doesn't allocate memory once the table reached its size.<BR>
+	 * A flow is identified by its 5-tuple, VLAN ID and tunnel identifier. It's exported to the callback given in the c'tor when:
+	 * - It had no packets for FlowMeterConfiguration#idleTimeout seconds
+	 * - It lasted FlowMeterConfiguration#activeTimeout seconds (the flow stays in the table and its counters start over)
+	 * - A TCP FIN or RST was seen on it (if FlowMeterConfiguration#exportOnTcpEnd is set)
+	 * - It was evicted to make room for a new flow
+	 * - flush() is called
+	 *
+	 * Time is taken from the packet timestamps, so a meter works the same on live traffic and on capture files. When no packets arrive
+	 * for a while, advanceTime() exports the flows which became idle. Records are usually exported with FlowExporter, which builds NetFlow v9
+	 * or IPFIX messages from them:
+	 *
+	 * @code
+	 * FlowExporter exporter(exporterConfig, onExportPacket, &device);
+	 * FlowMeter meter(FlowMeterConfiguration(), FlowExporter::onFlowExported, &exporter);
+	 * ...
+	 * meter.processPacket(&rawPacket);
+	 * @endcode
+	 *
+	 * A meter isn't thread-safe. To meter on several cores (for example on several DPDK worker threads), give each thread its own meter and
+	 * exporter, and make sure all packets of a flow reach the same thread, for example with RSS or FlowDispatcher. Each exporter should then
+	 * have its own observation domain ID, since NetFlow v9 and IPFIX collectors keep the sequence numbers per observation domain
+	 */
+	class FlowMeter
+	{
+	public:
+
+		/**
+		 * A callback invoked for each exported flow record
+		 * @param[in] record The record
+		 * @param[in] userCookie The cookie given in the c'tor
+		 */
+		typedef void (*OnFlowExported)(const FlowRecord& record, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The configuration of the meter
+		 * @param[in] onFlowExported The callback to invoke for each exported flow record
+		 * @param[in] userCookie A pointer passed to the callback. Default value is NULL
+		 */
+		FlowMeter(const FlowMeterConfiguration& config, OnFlowExported onFlowExported, void* userCookie = NULL);
+
+		/**
+		 * Meter a raw packet. Its timestamp is used as the current time
+		 * @param[in] rawPacket The packet. The link layer type is taken from RawPacket#getLinkLayerType()
+		 * @return True if the packet was metered, false if it doesn't contain an IPv4 or IPv6 header
+		 */
+		bool processPacket(const RawPacket* rawPacket);
+
+		/**
+		 * Meter a packet given as raw data
+		 * @param[in] data A pointer to the raw data
+		 * @param[in] dataLen The raw data length in bytes
+		 * @param[in] linkType The link layer type of the raw data, as in FlowKeyExtractor#extract()
+		 * @param[in] timestamp The timestamp of the packet in milliseconds since the epoch
+		 * @return True if the packet was metered, false if it doesn't contain an IPv4 or IPv6 header
+		 */
+		bool processPacket(const uint8_t* data, size_t dataLen, LinkLayerType linkType, uint64_t timestamp);
+
+		/**
+		 * Move the time of the meter forward and export the flows which became idle. processPacket() does it with the packet timestamps,
+		 * so it's needed only when there are no packets for a while. Times earlier than the current time are ignored
+		 * @param[in] timestamp The current time in milliseconds since the epoch
+		 */
+		void advanceTime(uint64_t timestamp);
+
+		/**
+		 * Export all flows with ::FlowEndForced and remove them, for example before the program exits
+		 */
+		void flush();
+
+		/**
+		 * @return The number of flows the meter currently keeps
+		 */
+		inline size_t getNumOfFlows() const { return m_FlowTable.size(); }
+
+		/**
+		 * @return The current time of the meter in milliseconds since the epoch, which is the latest time processPacket() or advanceTime()
+		 * were called with
+		 */
+		inline uint64_t getCurrentTime() const { return m_CurrentTime; }
+
+		/**
+		 * Get the meter statistics
+		 * @param[out] stats The statistics
+		 */
+		inline void getStats(FlowMeterStats& stats) const { stats = m_Stats; }
+
+	private:
+
+		// the flow key. All bytes are set, including the unused bytes of IPv4 addresses, so keys can be compared as a whole
+		struct FlowKey
+		{
+			FlowTuple tuple;
+			uint16_t vlanId;
+			uint32_t tunnelId;
+
+			inline bool operator==(const FlowKey& other) const
+			{
+				return tuple == other.tuple && vlanId == other.vlanId && tunnelId == other.tunnelId;
+			}
+		};
+
+		struct FlowKeyHash
+		{
+			uint64_t operator()(const FlowKey& key) const
+			{
+				return hashInteger((uint64_t)FlowHash::hash(key.tuple) | ((uint64_t)(key.tunnelId ^ ((uint32_t)key.vlanId << 20)) << 32));
+			}
+		};
+
+		struct FlowCounters
+		{
+			uint64_t packets;
+			uint64_t bytes;
+			uint64_t firstSeen;
+			uint64_t lastSeen;
+			uint32_t mplsLabel;
+			uint8_t tos;
+			uint8_t tcpFlags;
+
+			FlowCounters() : packets(0), bytes(0), firstSeen(0), lastSeen(0), mplsLabel(0), tos(0), tcpFlags(0) {}
+		};
+
+		FlowMeterConfiguration m_Config;
+		OnFlowExported m_OnFlowExported;
+		void* m_UserCookie;
+		FlowTable<FlowKey, FlowCounters, FlowKeyHash> m_FlowTable;
+		uint64_t m_CurrentTime;
+		FlowMeterStats m_Stats;
+
+		void exportFlow(const FlowKey& key, const FlowCounters& counters, FlowEndReason reason);
+		static void onFlowRemoved(const FlowKey& key, FlowCounters& counters, FlowRemovalReason reason, void* userCookie);
+
+		// disable copy c'tor and assignment operator
+		FlowMeter(const FlowMeter& other);
+		FlowMeter& operator=(const FlowMeter& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_FLOW_METER */
@@ -0,0 +1,745 @@
+#ifndef PACKETPP_FLOW_TABLE
+#define PACKETPP_FLOW_TABLE
+
+#include "FlowHash.h"
+#include "HashCounters.h"
+#include "TimerWheel.h"
+#include "MemoryBudget.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <utility>
+
+/// @file
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PCPP_FLOW_TABLE_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PCPP_FLOW_TABLE_PREFETCH(addr)
+#endif
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct FlowTableHash
+	 * The default hash function of FlowTable keys. For integer keys it mixes the value with hashInteger(), for FlowTuple it uses
+	 * FlowHash#hash(), and for other types it hashes the bytes of the key, so such keys must be plain structs whose padding bytes (if any)
+	 * are zeroed. Key types with other needs can be given their own hash function as the third template argument of FlowTable
+	 */
+	template<typename K>
+	struct FlowTableHash
+	{
+		uint64_t operator()(const K& key) const
+		{
+			// FNV-1a over the key bytes, mixed so the low bits (which choose the slot) depend on all bytes
+			const uint8_t* bytes = (const uint8_t*)&key;
+			uint64_t hash = 0xcbf29ce484222325ULL;
+			for (size_t i = 0; i < sizeof(K); i++)
+			{
+				hash ^= bytes[i];
+				hash *= 0x100000001b3ULL;
+			}
+			return hashInteger(hash);
+		}
+	};
+
+	template<> struct FlowTableHash<uint16_t> { uint64_t operator()(uint16_t key) const { return hashInteger(key); } };
+	template<> struct FlowTableHash<uint32_t> { uint64_t operator()(uint32_t key) const { return hashInteger(key); } };
+	template<> struct FlowTableHash<uint64_t> { uint64_t operator()(uint64_t key) const { return hashInteger(key); } };
+	template<> struct FlowTableHash<int> { uint64_t operator()(int key) const { return hashInteger((uint64_t)(uint32_t)key); } };
+	template<> struct FlowTableHash<FlowTuple> { uint64_t operator()(const FlowTuple& key) const { return hashInteger(FlowHash::hash(key)); } };
+
+
+	/**
+	 * @struct FlowTableConfiguration
+	 * The configuration of a FlowTable
+	 */
+	struct FlowTableConfiguration
+	{
+		/**
+		 * The maximum number of flows. When a new flow is inserted into a full table the flow chosen by #evictionPolicy is evicted first.
+		 * 0 means no limit
+		 */
+		size_t maxFlows;
+
+		/**
+		 * The number of ticks (see FlowTable#advanceTime()) a flow may stay without being looked up before it's removed. 0 means flows
+		 * never time out
+		 */
+		uint32_t idleTimeout;
+
+		/**
+		 * The order flows are evicted in when the table is full or #memoryBudget is exceeded
+		 */
+		EvictionPolicy evictionPolicy;
+
+		/**
+		 * An optional budget the memory of the flows is charged to (see FlowTable#getBytesPerFlow()). When it's exceeded after a flow is
+		 * inserted, flows are evicted until it isn't. It may be shared with other tables or with TcpReassembly and IPReassembly, and must
+		 * outlive the table. NULL means the memory isn't limited
+		 */
+		MemoryBudget* memoryBudget;
+
+		/**
+		 * The number of flows to allocate room for when the table is created, so inserting them doesn't grow the table
+		 */
+		size_t initialCapacity;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] maxFlows The maximum number of flows, or 0 for no limit. Default value is 0
+		 * @param[in] idleTimeout The idle timeout of flows in ticks, or 0 for no timeout. Default value is 0
+		 * @param[in] evictionPolicy The order flows are evicted in. Default value is pcpp#EvictLeastRecentlyUsed
+		 * @param[in] memoryBudget An optional budget to charge the memory of the flows to. Default value is NULL
+		 * @param[in] initialCapacity The number of flows to allocate room for up front. Default value is 0
+		 */
+		FlowTableConfiguration(size_t maxFlows = 0, uint32_t idleTimeout = 0, EvictionPolicy evictionPolicy = EvictLeastRecentlyUsed,
+				MemoryBudget* memoryBudget = NULL, size_t initialCapacity = 0) :
+			maxFlows(maxFlows), idleTimeout(idleTimeout), evictionPolicy(evictionPolicy), memoryBudget(memoryBudget), initialCapacity(initialCapacity) {}
+	};
+
+
+	/**
+	 * An enum of the reasons FlowTable removes a flow by itself, which are passed to FlowTable#OnFlowRemoved
+	 */
+	enum FlowRemovalReason
+	{
+		/** The flow wasn't looked up for longer than the idle timeout */
+		FlowRemovedByIdleTimeout,
+		/** The flow was evicted to make room for a new flow or to meet the memory budget */
+		FlowRemovedByEviction
+	};
+
+
+	/**
+	 * @class FlowTable
+	 * A hash table of per-flow state, meant to replace the std::map-based flow tables components keep next to separate expiry code. It
+	 * combines in one structure:
+	 * - A Robin Hood open-addressing index. Each slot is 8 bytes (32 bits of the key hash and the index of the flow), so a probe sequence
+	 *   usually stays in one cache line and a flow whose hash doesn't match is skipped without reading it. Robin Hood ordering keeps probe
+	 *   sequences short at high load and lets lookups of missing keys stop early, and erasing shifts entries back instead of leaving tombstones
+	 * - Flows (key and value inline) stored in a pool which is reused, so no memory is allocated per flow once the table reached its size
+	 * - findBulk(), which looks up a burst of keys in stages and prefetches the slots and flows of the whole burst before reading any of them
+	 * - Idle timeouts driven by a TimerWheel. Looking a flow up only records the time, and its timer is rescheduled when it fires, so a lookup
+	 *   doesn't touch the wheel
+	 * - Eviction by an EvictionList (least recently used or oldest first) when #FlowTableConfiguration#maxFlows is reached or a MemoryBudget is
+	 *   exceeded
+	 *
+	 * Time is measured in abstract ticks which only move forward when advanceTime() is called, usually with the seconds of packet timestamps.
+	 * Flows removed by a timeout or an eviction are reported to an optional callback before they're destroyed. Values must be
+	 * default-constructible and copyable, and so must keys, which must also be comparable with operator==. Pointers and references to values are
+	 * invalidated when the flow is removed and by insertions, which may grow the pool.<BR>
+	 * A table isn't thread-safe. To use flow tables from several threads, use ShardedFlowTable, which gives each thread its own table
+	 */
+	template<typename K, typename V, typename Hash = FlowTableHash<K> >
+	class FlowTable
+	{
+	public:
+
+		/**
+		 * A callback invoked when the table removes a flow by itself (but not when the user erases flows or clears the table)
+		 * @param[in] key The key of the flow
+		 * @param[in] value The value of the flow, which is destroyed after the callback returns
+		 * @param[in] reason The reason the flow is removed
+		 * @param[in] userCookie The cookie given in the c'tor
+		 */
+		typedef void (*OnFlowRemoved)(const K& key, V& value, FlowRemovalReason reason, void* userCookie);
+
+		/**
+		 * The maximum number of flows a table can hold regardless of its configuration
+		 */
+		static const size_t MaxCapacity = 0x40000000;
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The configuration of the table. Default is a table without limits or timeouts
+		 * @param[in] onFlowRemoved An optional callback invoked when a flow times out or is evicted. Default value is NULL
+		 * @param[in] userCookie A pointer passed to the callback. Default value is NULL
+		 */
+		FlowTable(const FlowTableConfiguration& config = FlowTableConfiguration(), OnFlowRemoved onFlowRemoved = NULL, void* userCookie = NULL) :
+			m_Config(config), m_OnFlowRemoved(onFlowRemoved), m_UserCookie(userCookie), m_EvictionList(config.evictionPolicy), m_Size(0),
+			m_CurrentTime(0), m_NumOfTimeouts(0), m_NumOfEvictions(0)
+		{
+			if (m_Config.initialCapacity > 0)
+				reserve(m_Config.initialCapacity);
+		}
+
+		/**
+		 * A d'tor for this class. Flows are destroyed without invoking the callback, and their memory is released from the budget
+		 */
+		~FlowTable()
+		{
+			if (m_Config.memoryBudget != NULL)
+				m_Config.memoryBudget->release(m_Size * getBytesPerFlow());
+		}
+
+		/**
+		 * Find a flow and mark it as used (for the idle timeout and for least-recently-used eviction)
+		 * @param[in] key The key of the flow
+		 * @return A pointer to the value of the flow, or NULL if the flow isn't in the table
+		 */
+		V* find(const K& key)
+		{
+			uint32_t flowIndex = findFlow(m_Hash(key), key);
+			if (flowIndex == NullIndex)
+				return NULL;
+
+			touchFlow(flowIndex);
+			return &m_Flows[flowIndex].value;
+		}
+
+		/**
+		 * Find a flow without marking it as used
+		 * @param[in] key The key of the flow
+		 * @return A pointer to the value of the flow, or NULL if the flow isn't in the table
+		 */
+		const V* peek(const K& key) const
+		{
+			uint32_t flowIndex = findFlow(m_Hash(key), key);
+			return flowIndex == NullIndex ? NULL : &m_Flows[flowIndex].value;
+		}
+
+		/**
+		 * Get the value of a flow, inserting a flow with a default-constructed value if the key isn't in the table. The flow is marked as
+		 * used. Inserting may evict other flows (see FlowTableConfiguration#maxFlows and FlowTableConfiguration#memoryBudget), but never the
+		 * returned one
+		 * @param[in] key The key of the flow
+		 * @param[out] isNew An optional pointer which is set to true if the flow was inserted, false otherwise. Default value is NULL
+		 * @return The value of the flow
+		 */
+		V& get(const K& key, bool* isNew = NULL)
+		{
+			uint64_t hash = m_Hash(key);
+			uint32_t flowIndex = findFlow(hash, key);
+			if (isNew != NULL)
+				*isNew = (flowIndex == NullIndex);
+
+			if (flowIndex != NullIndex)
+			{
+				touchFlow(flowIndex);
+				return m_Flows[flowIndex].value;
+			}
+
+			return m_Flows[insertFlow(hash, key)].value;
+		}
+
+		/**
+		 * The same as get()
+		 */
+		inline V& operator[](const K& key) { return get(key); }
+
+		/**
+		 * Find a burst of flows and mark them as used. This is faster than calling find() for each key, because the memory the lookups read
+		 * is prefetched for several keys before it's read
+		 * @param[in] keys The keys of the flows
+		 * @param[in] count The number of keys
+		 * @param[out] values An array of at least count entries, set to a pointer to the value of each flow or to NULL if the flow isn't in
+		 * the table
+		 */
+		void findBulk(const K* keys, size_t count, V** values)
+		{
+			uint64_t hashes[BulkSize];
+			uint32_t flowIndices[BulkSize];
+			for (size_t start = 0; start < count; start += BulkSize)
+			{
+				size_t bulkCount = (count - start < (size_t)BulkSize ? count - start : (size_t)BulkSize);
+
+				// hash all keys and prefetch their home slots, then probe the slots and prefetch the flows, then compare the keys
+				for (size_t i = 0; i < bulkCount; i++)
+				{
+					hashes[i] = m_Hash(keys[start + i]);
+					if (m_Size > 0)
+						PCPP_FLOW_TABLE_PREFETCH(&m_Slots[(uint32_t)hashes[i] & (m_Slots.size() - 1)]);
+				}
+
+				for (size_t i = 0; i < bulkCount; i++)
+				{
+					flowIndices[i] = findCandidate(hashes[i]);
+					if (flowIndices[i] != NullIndex)
+						PCPP_FLOW_TABLE_PREFETCH(&m_Flows[flowIndices[i]]);
+				}
+
+				for (size_t i = 0; i < bulkCount; i++)
+				{
+					uint32_t flowIndex = flowIndices[i];
+					if (flowIndex != NullIndex && !(m_Flows[flowIndex].key == keys[start + i]))
+						flowIndex = findFlow(hashes[i], keys[start + i]);
+
+					if (flowIndex == NullIndex)
+					{
+						values[start + i] = NULL;
+						continue;
+					}
+
+					touchFlow(flowIndex);
+					values[start + i] = &m_Flows[flowIndex].value;
+				}
+			}
+		}
+
+		/**
+		 * Erase a flow. The callback isn't invoked
+		 * @param[in] key The key of the flow
+		 * @return True if the flow was found and erased, false otherwise
+		 */
+		bool erase(const K& key)
+		{
+			uint32_t flowIndex = findFlow(m_Hash(key), key);
+			if (flowIndex == NullIndex)
+				return false;
+
+			removeFlow(flowIndex);
+			return true;
+		}
+
+		/**
+		 * Move the time of the table forward and remove the flows which weren't used for longer than the idle timeout, invoking the callback
+		 * for each of them. Times earlier than the current time are ignored. Calling it for every packet is cheap, since nothing is done
+		 * unless the time changes
+		 * @param[in] currentTime The new current time in ticks
+		 */
+		void advanceTime(uint64_t currentTime)
+		{
+			if (currentTime <= m_CurrentTime)
+				return;
+
+			m_CurrentTime = currentTime;
+			if (m_Config.idleTimeout == 0)
+				return;
+
+			m_Timers.advance(currentTime);
+			uint64_t flowIndex;
+			while (m_Timers.popExpired(flowIndex))
+			{
+				Flow& flow = m_Flows[flowIndex];
+				flow.timerId = TimerWheel::InvalidTimerId;
+
+				// the flow was used after its timer was set, so its timeout moved forward
+				uint64_t expiryTime = flow.lastSeen + m_Config.idleTimeout;
+				if (expiryTime > currentTime)
+				{
+					flow.timerId = m_Timers.addTimer(expiryTime, flowIndex);
+					continue;
+				}
+
+				m_NumOfTimeouts++;
+				if (m_OnFlowRemoved != NULL)
+					m_OnFlowRemoved(flow.key, flow.value, FlowRemovedByIdleTimeout, m_UserCookie);
+				removeFlow((uint32_t)flowIndex);
+			}
+		}
+
+		/**
+		 * @return The current time of the table in ticks
+		 */
+		inline uint64_t getCurrentTime() const { return m_CurrentTime; }
+
+		/**
+		 * @return The number of flows in the table
+		 */
+		inline size_t size() const { return m_Size; }
+
+		/**
+		 * @return The configuration of the table
+		 */
+		inline const FlowTableConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * @return The number of flows removed by the idle timeout since the table was created
+		 */
+		inline uint64_t getNumOfTimeouts() const { return m_NumOfTimeouts; }
+
+		/**
+		 * @return The number of flows evicted since the table was created
+		 */
+		inline uint64_t getNumOfEvictions() const { return m_NumOfEvictions; }
+
+		/**
+		 * @return The number of bytes each flow is charged to the memory budget: the flow itself, its index slots (with room for the slots
+		 * left empty at the maximal load) and its eviction and timer nodes
+		 */
+		static size_t getBytesPerFlow() { return sizeof(Flow) + 2 * sizeof(Slot) + 64; }
+
+		/**
+		 * @return The number of bytes the table currently allocates for flows and slots, which may be more than the flows in it need since
+		 * storage is kept for reuse
+		 */
+		size_t getAllocatedBytes() const { return m_Flows.capacity() * sizeof(Flow) + m_Slots.capacity() * sizeof(Slot); }
+
+		/**
+		 * Allocate room for a number of flows, so inserting them doesn't grow the table
+		 * @param[in] numOfFlows The number of flows
+		 */
+		void reserve(size_t numOfFlows)
+		{
+			if (numOfFlows > MaxCapacity)
+				numOfFlows = MaxCapacity;
+
+			m_Flows.reserve(numOfFlows);
+			while (numOfFlows * 8 > m_Slots.size() * 7)
+				grow();
+		}
+
+		/**
+		 * Remove all flows without invoking the callback. Allocated storage is kept for reuse
+		 */
+		void clear()
+		{
+			if (m_Config.memoryBudget != NULL)
+				m_Config.memoryBudget->release(m_Size * getBytesPerFlow());
+
+			for (size_t i = 0; i < m_Slots.size(); i++)
+				m_Slots[i].flowIndex = NullIndex;
+
+			m_Flows.clear();
+			m_FreeFlows.clear();
+			m_Timers.clear();
+			m_EvictionList.clear();
+			m_Size = 0;
+		}
+
+		/**
+		 * Copy all flows of the table to a vector, in no particular order
+		 * @param[out] flows The vector to append the flows to
+		 */
+		void getEntries(std::vector<std::pair<K, V> >& flows) const
+		{
+			flows.reserve(flows.size() + m_Size);
+			for (size_t i = 0; i < m_Flows.size(); i++)
+			{
+				if (m_Flows[i].used)
+					flows.push_back(std::pair<K, V>(m_Flows[i].key, m_Flows[i].value));
+			}
+		}
+
+	private:
+
+		enum { BulkSize = 16 };
+
+		static const uint32_t NullIndex = 0xffffffff;
+
+		struct Flow
+		{
+			K key;
+			V value;
+			uint64_t hash;
+			uint64_t lastSeen;
+			uint32_t timerId;
+			uint32_t evictionId;
+			bool used;
+
+			Flow() : key(), value(), hash(0), lastSeen(0), timerId(TimerWheel::InvalidTimerId), evictionId(EvictionList::InvalidItemId), used(false) {}
+		};
+
+		// an empty slot has a flow index of NullIndex. The low bits of the hash are the home slot of the flow, so the distance of a flow
+		// from its home slot is known without reading the flow
+		struct Slot
+		{
+			uint32_t hash;
+			uint32_t flowIndex;
+
+			Slot() : hash(0), flowIndex(NullIndex) {}
+		};
+
+		FlowTableConfiguration m_Config;
+		OnFlowRemoved m_OnFlowRemoved;
+		void* m_UserCookie;
+		Hash m_Hash;
+		std::vector<Slot> m_Slots;
+		std::vector<Flow> m_Flows;
+		std::vector<uint32_t> m_FreeFlows;
+		TimerWheel m_Timers;
+		EvictionList m_EvictionList;
+		size_t m_Size;
+		uint64_t m_CurrentTime;
+		uint64_t m_NumOfTimeouts;
+		uint64_t m_NumOfEvictions;
+
+		// returns the index of the first flow in the probe sequence of the hash whose slot hash matches, without comparing keys
+		uint32_t findCandidate(uint64_t hash) const
+		{
+			if (m_Size == 0)
+				return NullIndex;
+
+			size_t mask = m_Slots.size() - 1;
+			uint32_t slotHash = (uint32_t)hash;
+			size_t index = slotHash & mask;
+			for (size_t dist = 0; ; dist++)
+			{
+				const Slot& slot = m_Slots[index];
+				if (slot.flowIndex == NullIndex || ((index - (slot.hash & mask)) & mask) < dist)
+					return NullIndex;
+				if (slot.hash == slotHash)
+					return slot.flowIndex;
+				index = (index + 1) & mask;
+			}
+		}
+
+		// returns the slot of a flow, or NullIndex if it isn't in the table. A flow is always in its probe sequence before any slot whose
+		// flow is closer to its own home slot, so the search stops there
+		size_t findSlot(uint64_t hash, const K& key) const
+		{
+			if (m_Size == 0)
+				return NullIndex;
+
+			size_t mask = m_Slots.size() - 1;
+			uint32_t slotHash = (uint32_t)hash;
+			size_t index = slotHash & mask;
+			for (size_t dist = 0; ; dist++)
+			{
+				const Slot& slot = m_Slots[index];
+				if (slot.flowIndex == NullIndex || ((index - (slot.hash & mask)) & mask) < dist)
+					return NullIndex;
+				if (slot.hash == slotHash && m_Flows[slot.flowIndex].key == key)
+					return index;
+				index = (index + 1) & mask;
+			}
+		}
+
+		uint32_t findFlow(uint64_t hash, const K& key) const
+		{
+			size_t slotIndex = findSlot(hash, key);
+			return slotIndex == NullIndex ? NullIndex : m_Slots[slotIndex].flowIndex;
+		}
+
+		void insertSlot(uint32_t slotHash, uint32_t flowIndex)
+		{
+			size_t mask = m_Slots.size() - 1;
+			size_t index = slotHash & mask;
+			Slot entry;
+			entry.hash = slotHash;
+			entry.flowIndex = flowIndex;
+			for (size_t dist = 0; m_Slots[index].flowIndex != NullIndex; dist++)
+			{
+				// a flow further from its home slot takes the place of one closer to its own
+				size_t residentDist = (index - (m_Slots[index].hash & mask)) & mask;
+				if (residentDist < dist)
+				{
+					std::swap(entry, m_Slots[index]);
+					dist = residentDist;
+				}
+				index = (index + 1) & mask;
+			}
+
+			m_Slots[index] = entry;
+		}
+
+		void eraseSlot(size_t index)
+		{
+			// shift back the following flows of the probe sequence until a flow in its home slot or an empty slot
+			size_t mask = m_Slots.size() - 1;
+			size_t next = (index + 1) & mask;
+			while (m_Slots[next].flowIndex != NullIndex && (next & mask) != (m_Slots[next].hash & mask))
+			{
+				m_Slots[index] = m_Slots[next];
+				index = next;
+				next = (next + 1) & mask;
+			}
+
+			m_Slots[index].flowIndex = NullIndex;
+		}
+
+		void grow()
+		{
+			std::vector<Slot> oldSlots(m_Slots.size() == 0 ? 16 : m_Slots.size() * 2);
+			oldSlots.swap(m_Slots);
+			for (size_t i = 0; i < oldSlots.size(); i++)
+			{
+				if (oldSlots[i].flowIndex != NullIndex)
+					insertSlot(oldSlots[i].hash, oldSlots[i].flowIndex);
+			}
+		}
+
+		inline void touchFlow(uint32_t flowIndex)
+		{
+			Flow& flow = m_Flows[flowIndex];
+			flow.lastSeen = m_CurrentTime;
+			m_EvictionList.touch(flow.evictionId);
+		}
+
+		uint32_t insertFlow(uint64_t hash, const K& key)
+		{
+			if ((m_Config.maxFlows > 0 && m_Size >= m_Config.maxFlows) || m_Size >= MaxCapacity)
+				evictFlow();
+
+			if ((m_Size + 1) * 8 > m_Slots.size() * 7)
+				grow();
+
+			uint32_t flowIndex;
+			if (!m_FreeFlows.empty())
+			{
+				flowIndex = m_FreeFlows.back();
+				m_FreeFlows.pop_back();
+			}
+			else
+			{
+				flowIndex = (uint32_t)m_Flows.size();
+				m_Flows.push_back(Flow());
+			}
+
+			Flow& flow = m_Flows[flowIndex];
+			flow.key = key;
+			flow.hash = hash;
+			flow.lastSeen = m_CurrentTime;
+			flow.used = true;
+			flow.evictionId = m_EvictionList.add(flowIndex, getBytesPerFlow());
+			if (m_Config.idleTimeout > 0)
+				flow.timerId = m_Timers.addTimer(m_CurrentTime + m_Config.idleTimeout, flowIndex);
+
+			insertSlot((uint32_t)hash, flowIndex);
+			m_Size++;
+
+			if (m_Config.memoryBudget != NULL)
+			{
+				m_Config.memoryBudget->charge(getBytesPerFlow());
+				while (m_Config.memoryBudget->isExceeded() && m_Size > 1)
+				{
+					uint64_t victim;
+					if (!m_EvictionList.getVictim(victim) || victim == flowIndex)
+						break;
+					m_Config.memoryBudget->countEviction(getBytesPerFlow());
+					evictFlow();
+				}
+			}
+
+			return flowIndex;
+		}
+
+		void evictFlow()
+		{
+			uint64_t flowIndex;
+			if (!m_EvictionList.getVictim(flowIndex))
+				return;
+
+			m_NumOfEvictions++;
+			Flow& flow = m_Flows[flowIndex];
+			if (m_OnFlowRemoved != NULL)
+				m_OnFlowRemoved(flow.key, flow.value, FlowRemovedByEviction, m_UserCookie);
+			removeFlow((uint32_t)flowIndex);
+		}
+
+		void removeFlow(uint32_t flowIndex)
+		{
+			Flow& flow = m_Flows[flowIndex];
+			eraseSlot(findSlot(flow.hash, flow.key));
+			m_EvictionList.remove(flow.evictionId);
+			if (flow.timerId != TimerWheel::InvalidTimerId)
+				m_Timers.removeTimer(flow.timerId);
+
+			flow = Flow();
+			m_FreeFlows.push_back(flowIndex);
+			m_Size--;
+			if (m_Config.memoryBudget != NULL)
+				m_Config.memoryBudget->release(getBytesPerFlow());
+		}
+
+		// disable copy c'tor and assignment operator
+		FlowTable(const FlowTable& other);
+		FlowTable& operator=(const FlowTable& other);
+	};
+
+	template<typename K, typename V, typename Hash>
+	const size_t FlowTable<K, V, Hash>::MaxCapacity;
+
+	template<typename K, typename V, typename Hash>
+	const uint32_t FlowTable<K, V, Hash>::NullIndex;
+
+
+	/**
+	 * @class ShardedFlowTable
+	 * A set of FlowTable instances (shards) with the same configuration, for keeping flow state on several threads without locks. Each flow
+	 * belongs to one shard, chosen by bits of its hash which don't choose its slot, and each shard must be used by one thread only. Usually
+	 * each worker thread gets a shard and packets are distributed to the threads with getShardIndex() (or by RSS, in which case any shard
+	 * may be used for any key as long as a flow always reaches the same thread).<BR>
+	 * The FlowTableConfiguration limits (#FlowTableConfiguration#maxFlows and #FlowTableConfiguration#initialCapacity) apply to each shard.
+	 * A MemoryBudget isn't thread-safe, so it mustn't be given to the configuration of a sharded table used by several threads
+	 */
+	template<typename K, typename V, typename Hash = FlowTableHash<K> >
+	class ShardedFlowTable
+	{
+	public:
+
+		/**
+		 * The type of the shards
+		 */
+		typedef FlowTable<K, V, Hash> Shard;
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] numOfShards The number of shards. Values lower than 1 are treated as 1
+		 * @param[in] config The configuration of each shard. Default is a table without limits or timeouts
+		 * @param[in] onFlowRemoved An optional callback invoked when a flow times out or is evicted, on the thread using the shard. Default
+		 * value is NULL
+		 * @param[in] userCookie A pointer passed to the callback. Default value is NULL
+		 */
+		ShardedFlowTable(size_t numOfShards, const FlowTableConfiguration& config = FlowTableConfiguration(),
+				typename Shard::OnFlowRemoved onFlowRemoved = NULL, void* userCookie = NULL)
+		{
+			if (numOfShards < 1)
+				numOfShards = 1;
+
+			// each shard is allocated on its own, so shards used by different threads don't share cache lines
+			for (size_t i = 0; i < numOfShards; i++)
+				m_Shards.push_back(new Shard(config, onFlowRemoved, userCookie));
+		}
+
+		/**
+		 * A d'tor for this class
+		 */
+		~ShardedFlowTable()
+		{
+			for (size_t i = 0; i < m_Shards.size(); i++)
+				delete m_Shards[i];
+		}
+
+		/**
+		 * @return The number of shards
+		 */
+		inline size_t getNumOfShards() const { return m_Shards.size(); }
+
+		/**
+		 * @param[in] key The key of a flow
+		 * @return The index of the shard the flow belongs to
+		 */
+		inline size_t getShardIndex(const K& key) const { return (size_t)((m_Hash(key) >> 32) % m_Shards.size()); }
+
+		/**
+		 * @param[in] index The index of the shard, which must be lower than getNumOfShards()
+		 * @return The shard
+		 */
+		inline Shard& getShard(size_t index) { return *m_Shards[index]; }
+
+		/**
+		 * @param[in] key The key of a flow
+		 * @return The shard the flow belongs to
+		 */
+		inline Shard& getShardOf(const K& key) { return *m_Shards[getShardIndex(key)]; }
+
+		/**
+		 * @return The number of flows in all shards. The result is accurate only when no shard is being changed
+		 */
+		size_t size() const
+		{
+			size_t total = 0;
+			for (size_t i = 0; i < m_Shards.size(); i++)
+				total += m_Shards[i]->size();
+			return total;
+		}
+
+	private:
+		std::vector<Shard*> m_Shards;
+		Hash m_Hash;
+
+		// disable copy c'tor and assignment operator
+		ShardedFlowTable(const ShardedFlowTable& other);
+		ShardedFlowTable& operator=(const ShardedFlowTable& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_FLOW_TABLE */
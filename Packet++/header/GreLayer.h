@@ -178,6 +178,8 @@ namespace pcpp
 		void computeCalculateFieldsInner();
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(GreLayer, GRE);
+
 
 	/**
 	 * @class GREv0Layer
@@ -290,6 +292,8 @@ namespace pcpp
 
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(GREv0Layer, GREv0);
+
 
 	/**
 	 * @class GREv1Layer
@@ -363,6 +367,8 @@ namespace pcpp
 
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(GREv1Layer, GREv1);
+
 
 	/**
 	 * @class PPP_PPTPLayer
@@ -420,6 +426,8 @@ namespace pcpp
 
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(PPP_PPTPLayer, PPP_PPTP);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_GRE_LAYER */
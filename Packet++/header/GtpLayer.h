@@ -448,6 +448,8 @@ namespace pcpp
 
 		OsiModelLayer getOsiModelLayer() const { return OsiModelTransportLayer; }
     };
+
+    PCPP_LAYER_PROTOCOL_TRAITS(GtpV1Layer, GTPv1);
 }
 
 #endif //PACKETPP_GTP_LAYER
\ No newline at end of file
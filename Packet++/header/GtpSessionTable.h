@@ -0,0 +1,398 @@
+#ifndef PACKETPP_GTP_SESSION_TABLE
+#define PACKETPP_GTP_SESSION_TABLE
+
+#include "PacketView.h"
+#include "TimerWheel.h"
+#include "QuiescentStateReclaimer.h"
+#include <map>
+#include <deque>
+#include <vector>
+#include <time.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * The direction of a GTP-U packet of a session
+	 */
+	enum GtpSessionDirection
+	{
+		/** A packet sent by the mobile (from the SGSN/S-GW to the GGSN/P-GW) */
+		GtpSessionUplink,
+		/** A packet sent to the mobile (from the GGSN/P-GW to the SGSN/S-GW) */
+		GtpSessionDownlink
+	};
+
+
+	/**
+	 * The reasons a session is removed from GtpSessionTable
+	 */
+	enum GtpSessionEndReason
+	{
+		/** A Delete PDP Context Request of the session was accepted */
+		GtpSessionDeleted,
+		/** The session had no activity for GtpSessionTableConfiguration#sessionTimeout seconds */
+		GtpSessionTimedOut,
+		/** A new session was created with one of the TEIDs of the session, so the session must have ended unnoticed */
+		GtpSessionReplaced
+	};
+
+
+	/**
+	 * @struct GtpTunnelEndpoint
+	 * One end of a GTP tunnel: the TEID a GSN allocated and the address of the GSN, which together identify the tunnel of the packets sent to it
+	 */
+	struct GtpTunnelEndpoint
+	{
+		/** The tunnel endpoint identifier */
+		uint32_t teid;
+		/** The IP version of the address (4 or 6), or 0 if the endpoint isn't known */
+		uint8_t ipVersion;
+		/** The IP address of the GSN. For IPv4 only the first 4 bytes are used */
+		uint8_t ipAddress[16];
+	};
+
+
+	/**
+	 * @struct GtpSession
+	 * A PDP context (a mobile data session) tracked by GtpSessionTable. It's created by an accepted Create PDP Context Request and keeps
+	 * the tunnel endpoints of both sides for the control and the user plane.<BR>
+	 * The counters and the activity time are updated with relaxed atomic operations by the threads classifying GTP-U packets, so they may
+	 * be read at any time but consecutive reads of different counters aren't a consistent snapshot. The tunnel endpoints are changed only
+	 * by update messages, while holding the lock of the table
+	 */
+	struct GtpSession
+	{
+		/** A unique ID the table assigned to the session */
+		uint64_t sessionId;
+		/** The IMSI of the subscriber as a null-terminated string of digits, or an empty string if the request didn't carry it */
+		char imsi[16];
+		/** The NSAPI of the PDP context */
+		uint8_t nsapi;
+		/** The IP version of the address allocated to the mobile (4 or 6), or 0 if the response didn't carry one */
+		uint8_t endUserIpVersion;
+		/** The IP address allocated to the mobile. For IPv4 only the first 4 bytes are used */
+		uint8_t endUserAddress[16];
+		/** The control plane endpoint of the SGSN (or S-GW) */
+		GtpTunnelEndpoint sgsnControl;
+		/** The control plane endpoint of the GGSN (or P-GW) */
+		GtpTunnelEndpoint ggsnControl;
+		/** The user plane endpoint of the SGSN (or S-GW), which downlink packets are sent to */
+		GtpTunnelEndpoint sgsnUserPlane;
+		/** The user plane endpoint of the GGSN (or P-GW), which uplink packets are sent to */
+		GtpTunnelEndpoint ggsnUserPlane;
+		/** The timestamp (in seconds) of the response which created the session */
+		time_t startTime;
+		/** The timestamp (in seconds) of the last control message or GTP-U packet of the session */
+		time_t lastActivityTime;
+		/** The number of uplink GTP-U packets */
+		uint64_t uplinkPackets;
+		/** The number of bytes of the user packets (T-PDUs) carried by the uplink GTP-U packets */
+		uint64_t uplinkBytes;
+		/** The number of downlink GTP-U packets */
+		uint64_t downlinkPackets;
+		/** The number of bytes of the user packets (T-PDUs) carried by the downlink GTP-U packets */
+		uint64_t downlinkBytes;
+	};
+
+
+	/**
+	 * @struct GtpSessionTableConfiguration
+	 * The limits and timeouts of GtpSessionTable
+	 */
+	struct GtpSessionTableConfiguration
+	{
+		/**
+		 * The maximum number of sessions tracked at once. Create requests of new sessions are ignored while this number of sessions is
+		 * tracked. The hash table of the tunnels is sized for this number when the table is created and is never resized
+		 */
+		size_t maxNumOfSessions;
+		/**
+		 * The number of seconds without control messages or GTP-U packets after which a session times out and is removed
+		 */
+		uint32_t sessionTimeout;
+		/**
+		 * The number of seconds a request waits for its response. Responses to older requests are ignored
+		 */
+		uint32_t requestTimeout;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] maxSessions The value of #maxNumOfSessions. Default value is 1000000
+		 * @param[in] timeout The value of #sessionTimeout. Default value is 3600
+		 * @param[in] reqTimeout The value of #requestTimeout. Default value is 30
+		 */
+		GtpSessionTableConfiguration(size_t maxSessions = 1000000, uint32_t timeout = 3600, uint32_t reqTimeout = 30) :
+			maxNumOfSessions(maxSessions), sessionTimeout(timeout), requestTimeout(reqTimeout) {}
+	};
+
+
+	/**
+	 * @class GtpSessionTable
+	 * A table of the GTP sessions (PDP contexts) of mobile-core traffic, which classifies GTP-U packets to their session with a single
+	 * lock-free hash lookup. Sessions are learned from the GTPv1-C Create, Update and Delete PDP Context messages: a request is matched to
+	 * its response by the sequence number and the address of the requester, and the TEIDs and GSN addresses of both messages become the
+	 * tunnel endpoints of the session. Each endpoint is indexed by its (TEID, GSN address) pair, which is what a GTP-U packet carries in its
+	 * header and destination address, so the session and the direction of a packet are found without parsing the tunneled packet.<BR>
+	 * The table is shared by all worker threads. Classifying a GTP-U packet never takes a lock: the tunnels are kept in a chained hash table
+	 * whose buckets and links are published with atomic stores, and the session counters are updated with relaxed atomic additions.
+	 * Control messages, timeouts and reclamation are serialized by a lock, which only control plane traffic (a small fraction of the
+	 * packets) takes. Sessions and tunnels which are removed are freed with quiescent-state based reclamation (see QuiescentStateReclaimer):
+	 * threads which classify packets register with registerReader() and call quiescentState() when they don't hold a pointer returned by the
+	 * table, for example after each burst of packets.<BR>
+	 * The time is taken from the packet timestamps. Since GTP-U packets don't take the lock, they don't advance the time of the table, so a
+	 * thread should call setCurrentTime() regularly (for example once a second) for idle sessions to time out when control messages are rare.
+	 * Only GTPv1 (Gn/Gp and S12/S4 user plane) is supported, and only primary PDP contexts are tracked: Create requests of secondary
+	 * contexts, which are sent over an existing control tunnel, are ignored
+	 */
+	class GtpSessionTable
+	{
+	public:
+		/**
+		 * @typedef OnGtpSessionEnd
+		 * A callback invoked when a session is removed. It's invoked while the lock of the table is held, so it must not call the methods
+		 * of the table which take it
+		 * @param[in] session The session. Its memory is reclaimed once all readers passed a quiescent state
+		 * @param[in] reason The reason the session was removed
+		 * @param[in] userCookie A pointer to the object given by the user
+		 */
+		typedef void (*OnGtpSessionEnd)(const GtpSession& session, GtpSessionEndReason reason, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] onSessionEnd A callback invoked when a session is removed. Default value is NULL (no callback)
+		 * @param[in] userCookie A pointer to an object passed to the callback. Default value is NULL
+		 * @param[in] config The table limits and timeouts
+		 */
+		GtpSessionTable(OnGtpSessionEnd onSessionEnd = NULL, void* userCookie = NULL, const GtpSessionTableConfiguration& config = GtpSessionTableConfiguration());
+
+		/**
+		 * A d'tor for this class. Frees all sessions without invoking the callback, so it must not be called while other threads classify
+		 * packets
+		 */
+		~GtpSessionTable();
+
+		/**
+		 * Process a packet: a GTP-U packet is classified to its session as classifyPacket() does, and a GTP-C message updates the sessions
+		 * it creates, changes or deletes. Other packets are ignored
+		 * @param[in] rawPacket The packet. Its timestamp is the time of the message
+		 * @param[out] direction If not NULL and the packet is a GTP-U packet of a session, the direction of the packet is written to it
+		 * @return The session of a GTP-U packet, or of a control message which created or changed a session. NULL otherwise. The pointer is
+		 * valid until the calling reader passes a quiescent state
+		 */
+		const GtpSession* processPacket(const RawPacket* rawPacket, GtpSessionDirection* direction = NULL);
+
+		/**
+		 * Classify a GTP-U packet to its session by the TEID of its header and its destination address, and update the session counters and
+		 * activity time. This method never takes a lock
+		 * @param[in] data The packet data
+		 * @param[in] view The packet headers, as extracted by FlowKeyExtractor from the same data
+		 * @param[in] packetTime The packet timestamp in seconds
+		 * @param[out] direction If not NULL and the packet belongs to a session, the direction of the packet is written to it
+		 * @return The session of the packet, or NULL if it isn't a GTP-U packet (a G-PDU) of a tracked session. The pointer is valid until
+		 * the calling reader passes a quiescent state
+		 */
+		const GtpSession* classifyPacket(const uint8_t* data, const PacketView& view, time_t packetTime, GtpSessionDirection* direction = NULL);
+
+		/**
+		 * Process a GTP-C message
+		 * @param[in] data The packet data
+		 * @param[in] view The packet headers, as extracted by FlowKeyExtractor from the same data
+		 * @param[in] packetTime The packet timestamp in seconds, the current time of the table
+		 * @return The session the message created or changed, or NULL if the message isn't a GTPv1-C message which created or changed a
+		 * session. The pointer is valid until the calling reader passes a quiescent state
+		 */
+		const GtpSession* processControlMessage(const uint8_t* data, const PacketView& view, time_t packetTime);
+
+		/**
+		 * Find the session a user plane tunnel endpoint belongs to. This method never takes a lock
+		 * @param[in] teid The TEID
+		 * @param[in] ipVersion The IP version of the GSN address (4 or 6)
+		 * @param[in] ipAddress The GSN address, 4 bytes for IPv4 and 16 bytes for IPv6
+		 * @param[out] direction If not NULL and the endpoint is found, the direction of the packets sent to it is written to it
+		 * @return The session, or NULL if no tracked session has this endpoint. The pointer is valid until the calling reader passes a
+		 * quiescent state
+		 */
+		const GtpSession* findSession(uint32_t teid, uint8_t ipVersion, const uint8_t* ipAddress, GtpSessionDirection* direction = NULL) const;
+
+		/**
+		 * Copy all sessions. The sessions are copied while holding the lock, but their counters may still change while they're copied
+		 * @param[out] sessions A vector the sessions are appended to
+		 */
+		void getAllSessions(std::vector<GtpSession>& sessions);
+
+		/**
+		 * Advance the current time of the table and remove the sessions whose timeout passed, as processing a control message does. Should
+		 * be called regularly, since GTP-U packets don't advance the time
+		 * @param[in] currentTime The current time in seconds. Times earlier than the current time of the table are ignored
+		 */
+		void setCurrentTime(time_t currentTime);
+
+		/**
+		 * Register the calling thread as a reader, a thread which classifies packets or uses the sessions returned by the table while
+		 * sessions may be removed. Sessions removed after a reader registered aren't freed until it calls quiescentState() or
+		 * unregisterReader()
+		 * @return A reader ID to pass to quiescentState() and unregisterReader(), or -1 if #PCPP_QUIESCENT_STATE_MAX_READERS readers are
+		 * already registered
+		 */
+		int registerReader();
+
+		/**
+		 * Unregister a reader. The reader must not classify packets after this method is called unless it registers again
+		 * @param[in] readerId The reader ID registerReader() returned
+		 */
+		void unregisterReader(int readerId);
+
+		/**
+		 * Announce a reader doesn't hold a pointer returned by the table. This method is cheap (an atomic load and store) and should be
+		 * called regularly, for example after each burst of packets
+		 * @param[in] readerId The reader ID registerReader() returned
+		 */
+		void quiescentState(int readerId);
+
+		/**
+		 * Free the removed sessions all registered readers are done with. Processing control messages and setCurrentTime() do this too, so
+		 * calling it is only needed to free memory sooner
+		 * @return The number of sessions which are still waiting for readers to pass a quiescent state
+		 */
+		size_t reclaim();
+
+		/**
+		 * @return The number of sessions currently tracked
+		 */
+		size_t getNumOfSessions();
+
+		/**
+		 * @return The number of requests waiting for their response
+		 */
+		size_t getNumOfPendingRequests();
+
+		/**
+		 * @return The number of Create requests of new sessions which were ignored because GtpSessionTableConfiguration#maxNumOfSessions
+		 * sessions were tracked
+		 */
+		uint64_t getNumOfRejectedSessions();
+
+	private:
+		struct SessionEntry;
+
+		// a (TEID, address) pair a session is found by. Control plane tunnels are in the same hash table, but only the lock holder looks them up
+		struct TunnelNode
+		{
+			TunnelNode* volatile next;
+			SessionEntry* entry;
+			GtpTunnelEndpoint endpoint;
+			bool isControl;
+			GtpSessionDirection direction;
+		};
+
+		enum TunnelIndex
+		{
+			SgsnControlTunnel,
+			GgsnControlTunnel,
+			SgsnUserPlaneTunnel,
+			GgsnUserPlaneTunnel,
+			NumOfTunnels
+		};
+
+		struct SessionEntry
+		{
+			GtpSession session;
+			TunnelNode* tunnels[NumOfTunnels];
+			uint32_t timerId;
+			// the next free instance while this instance is in the pool
+			SessionEntry* nextFree;
+		};
+
+		// the fields of a request which are needed when its response arrives
+		struct PendingRequest
+		{
+			uint8_t messageType;
+			time_t time;
+			// the session an update or delete request refers to, and its ID in case the entry was reused since
+			SessionEntry* entry;
+			uint64_t sessionId;
+			bool fromSgsn;
+			char imsi[16];
+			uint8_t nsapi;
+			GtpTunnelEndpoint control;
+			GtpTunnelEndpoint userPlane;
+		};
+
+		// a request is identified by its sequence number and the requester address, which its response is sent to
+		struct PendingKey
+		{
+			uint16_t sequenceNumber;
+			uint8_t ipVersion;
+			uint8_t ipAddress[16];
+
+			bool operator<(const PendingKey& other) const;
+		};
+
+		// a removed session or tunnel, exactly one of the pointers is set
+		struct RetiredItem
+		{
+			SessionEntry* entry;
+			TunnelNode* tunnel;
+		};
+
+		// returns the retired sessions and tunnels the readers are done with to the pools
+		struct RecycleRetiredItem
+		{
+			GtpSessionTable* table;
+
+			RecycleRetiredItem(GtpSessionTable* table) : table(table) {}
+			void operator()(const RetiredItem& retired) const;
+		};
+
+		OnGtpSessionEnd m_OnSessionEnd;
+		void* m_UserCookie;
+		GtpSessionTableConfiguration m_Config;
+		// the chained hash table of the tunnels, a power of two at least twice as large as the maximum number of sessions
+		TunnelNode* volatile* m_Buckets;
+		size_t m_BucketMask;
+		size_t m_NumOfSessions;
+		uint64_t m_NextSessionId;
+		uint64_t m_NumOfRejectedSessions;
+		SessionEntry* m_FreeEntries;
+		std::vector<TunnelNode*> m_FreeTunnels;
+		std::map<PendingKey, PendingRequest> m_PendingRequests;
+		// the keys of the pending requests in the order they were sent, for timing them out
+		std::deque<std::pair<time_t, PendingKey> > m_PendingOrder;
+		TimerWheel m_Timers;
+		time_t m_CurrentTime;
+		QuiescentStateReclaimer<RetiredItem> m_Reclaimer;
+		size_t m_NumOfRetiredSessions;
+		pthread_mutex_t m_Mutex;
+
+		static size_t hashEndpoint(const GtpTunnelEndpoint& endpoint);
+		const TunnelNode* findTunnel(const GtpTunnelEndpoint& endpoint, bool isControl) const;
+		void insertTunnel(SessionEntry* entry, TunnelIndex index, const GtpTunnelEndpoint& endpoint);
+		void eraseTunnel(SessionEntry* entry, TunnelIndex index);
+
+		void handleRequest(uint8_t messageType, uint32_t teid, uint16_t sequenceNumber, const uint8_t* ies, size_t iesLen, const PacketView& view);
+		SessionEntry* handleResponse(uint8_t messageType, uint16_t sequenceNumber, const uint8_t* ies, size_t iesLen, const PacketView& view);
+		SessionEntry* createSession(const PendingRequest& request, const GtpTunnelEndpoint& ggsnControl, const GtpTunnelEndpoint& ggsnUserPlane,
+				uint8_t endUserIpVersion, const uint8_t* endUserAddress);
+		void removeSession(SessionEntry* entry, GtpSessionEndReason reason);
+		void touchSession(SessionEntry* entry);
+		void expireLocked();
+		size_t reclaimLocked();
+
+		// disable copy c'tor and assignment operator
+		GtpSessionTable(const GtpSessionTable& other);
+		GtpSessionTable& operator=(const GtpSessionTable& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_GTP_SESSION_TABLE */
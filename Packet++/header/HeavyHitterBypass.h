@@ -0,0 +1,324 @@
+#ifndef PACKETPP_HEAVY_HITTER_BYPASS
+#define PACKETPP_HEAVY_HITTER_BYPASS
+
+#include "FlowTable.h"
+#include "FlowHash.h"
+#include "RawPacket.h"
+#include "HashCounters.h"
+#include <vector>
+#include <utility>
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct HeavyHitterBypassConfiguration
+	 * The configuration of a HeavyHitterBypass
+	 */
+	struct HeavyHitterBypassConfiguration
+	{
+		/**
+		 * A flow is bypassed once the bytes it sent in both directions within a window reach this number, as estimated by the sketch
+		 */
+		uint64_t thresholdBytes;
+
+		/**
+		 * The length of the window the bytes of flows are counted in, in seconds. The sketch is cleared when a window ends, so flows which
+		 * are only heavy over a long time aren't bypassed
+		 */
+		uint32_t windowSeconds;
+
+		/**
+		 * The number of seconds a bypassed flow may stay without packets before its bypass ends. 0 means bypasses don't time out
+		 */
+		uint32_t idleTimeout;
+
+		/**
+		 * The maximum number of bypassed flows. When it's reached the least recently seen flow stops being bypassed. 0 means no limit
+		 */
+		size_t maxBypassedFlows;
+
+		/**
+		 * The number of counters of each row of the sketch (see CountMinSketch). A wider sketch overestimates light flows less, so fewer of
+		 * them are bypassed by mistake
+		 */
+		size_t sketchWidth;
+
+		/**
+		 * The number of rows of the sketch
+		 */
+		size_t sketchDepth;
+
+		/**
+		 * Whether a TCP packet with the FIN or RST flag ends the bypass of its flow, so the table doesn't keep ended connections until their
+		 * idle timeout. The packet itself is still bypassed, and the flow isn't promoted again until the window ends
+		 */
+		bool endOnTcpClose;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] thresholdBytes The number of bytes within a window above which a flow is bypassed. Default value is 1000000
+		 * @param[in] windowSeconds The length of the counting window in seconds. Default value is 1
+		 * @param[in] idleTimeout The idle timeout of bypassed flows in seconds. Default value is 30
+		 * @param[in] maxBypassedFlows The maximum number of bypassed flows, or 0 for no limit. Default value is 65536
+		 * @param[in] sketchWidth The number of counters of each row of the sketch. Default value is 4096
+		 * @param[in] sketchDepth The number of rows of the sketch. Default value is 4
+		 * @param[in] endOnTcpClose Whether a TCP FIN or RST ends the bypass of its flow. Default value is true
+		 */
+		HeavyHitterBypassConfiguration(uint64_t thresholdBytes = 1000000, uint32_t windowSeconds = 1, uint32_t idleTimeout = 30,
+				size_t maxBypassedFlows = 65536, size_t sketchWidth = 4096, size_t sketchDepth = 4, bool endOnTcpClose = true) :
+			thresholdBytes(thresholdBytes), windowSeconds(windowSeconds), idleTimeout(idleTimeout), maxBypassedFlows(maxBypassedFlows),
+			sketchWidth(sketchWidth), sketchDepth(sketchDepth), endOnTcpClose(endOnTcpClose) {}
+	};
+
+
+	/**
+	 * @struct BypassedFlow
+	 * The state HeavyHitterBypass keeps for a bypassed flow
+	 */
+	struct BypassedFlow
+	{
+		/** Number of packets of the flow bypassed so far, in both directions */
+		uint64_t packets;
+		/** Number of bytes of the flow bypassed so far, in both directions */
+		uint64_t bytes;
+		/** The time in seconds the bypass started */
+		uint64_t bypassTime;
+		/** The bytes the sketch estimated for the flow when it was bypassed, or 0 if it was bypassed by HeavyHitterBypass#addBypass() */
+		uint64_t estimatedBytes;
+		/** An ID of a hardware rule which drops or steers the flow, set by the promotion callback so the removal callback can remove the
+		 * rule. -1 if no rule was added */
+		int offloadRuleId;
+
+		/**
+		 * A c'tor for this struct which zeroes all counters
+		 */
+		BypassedFlow() : packets(0), bytes(0), bypassTime(0), estimatedBytes(0), offloadRuleId(-1) {}
+	};
+
+
+	/**
+	 * An enum of the reasons the bypass of a flow ends, which are passed to the OnBypassEnded callback
+	 */
+	enum BypassEndReason
+	{
+		/** The flow had no packets for longer than HeavyHitterBypassConfiguration#idleTimeout */
+		BypassEndedByIdleTimeout,
+		/** The flow was evicted to make room for a new flow (see HeavyHitterBypassConfiguration#maxBypassedFlows) */
+		BypassEndedByEviction,
+		/** A TCP FIN or RST was seen (see HeavyHitterBypassConfiguration#endOnTcpClose) */
+		BypassEndedByTcpClose,
+		/** The flow was removed by HeavyHitterBypass#removeBypass() */
+		BypassEndedByUser
+	};
+
+
+	/**
+	 * @struct HeavyHitterBypassStats
+	 * The statistics of a HeavyHitterBypass
+	 */
+	struct HeavyHitterBypassStats
+	{
+		/** Number of packets checked */
+		uint64_t packets;
+		/** Number of packets which belong to bypassed flows */
+		uint64_t bypassedPackets;
+		/** Number of bytes of the packets which belong to bypassed flows */
+		uint64_t bypassedBytes;
+		/** Number of packets checked which aren't IPv4 or IPv6, or are IP fragments, which are never bypassed */
+		uint64_t nonFlowPackets;
+		/** Number of flows which were bypassed */
+		uint64_t promotions;
+		/** Number of flows which reached the threshold but whose bypass the promotion callback refused */
+		uint64_t refusedPromotions;
+		/** Number of flows whose bypass ended */
+		uint64_t bypassEnds;
+	};
+
+
+	/**
+	 * @typedef OnHeavyHitterPromoted
+	 * A callback invoked when a flow reaches the threshold, before it's bypassed. It may push the bypass down to the NIC, for example with a
+	 * DpdkDevice#addFlowRule() rule which drops the flow or steers it to a queue whose packets are only counted, and store the rule ID in
+	 * BypassedFlow#offloadRuleId. Since bypassed flows are bidirectional, such rules should match both directions of the tuple
+	 * @param[in] tuple The tuple of the flow in the direction of the packet which reached the threshold
+	 * @param[in,out] flow The state of the flow
+	 * @param[in] userCookie The cookie given in the c'tor
+	 * @return True to bypass the flow, false to keep processing it. A refused flow is checked again when it reaches the threshold in a later
+	 * window
+	 */
+	typedef bool (*OnHeavyHitterPromoted)(const FlowTuple& tuple, BypassedFlow& flow, void* userCookie);
+
+	/**
+	 * @typedef OnBypassEnded
+	 * A callback invoked when the bypass of a flow ends. It may remove the hardware rule the promotion callback added and report the counters
+	 * of the flow
+	 * @param[in] tuple The tuple of the flow, with the lower address (and port) as the source
+	 * @param[in] flow The state of the flow
+	 * @param[in] reason The reason the bypass ended
+	 * @param[in] userCookie The cookie given in the c'tor
+	 */
+	typedef void (*OnBypassEnded)(const FlowTuple& tuple, const BypassedFlow& flow, BypassEndReason reason, void* userCookie);
+
+
+	/**
+	 * @class HeavyHitterBypass
+	 * Detects heavy-hitter ("elephant") flows and bypasses them, so their packets skip Packet parsing, TcpReassembly and layer 7 inspection
+	 * and are only counted. A few such flows (backups, video, bulk transfers) often carry most of the bytes while inspecting them yields
+	 * little after their first packets.<BR>
+	 * Each packet is read with FlowKeyExtractor, without creating any Layer objects. If its flow is in the bypass table it's counted there
+	 * and reported as bypassed. Otherwise its length is added to a CountMinSketch under the symmetric hash of its tuple, and if the estimate
+	 * of the flow within the current window reaches HeavyHitterBypassConfiguration#thresholdBytes the flow is promoted to the bypass table.
+	 * The sketch takes a fixed amount of memory however many flows there are, and never underestimates a flow, so heavy flows are never
+	 * missed, while a light flow is promoted by mistake only if it collides with heavy ones in all rows.<BR>
+	 * The bypass table is a FlowTable keyed by the tuple with the lower address as the source, so both directions of a flow are bypassed
+	 * together. A bypass ends when the flow is idle, is evicted, or closes (TCP FIN or RST), or when it's removed by the user, which is
+	 * reported to the OnBypassEnded callback. Flows may also be bypassed by the application with addBypass(), for example once it found a
+	 * flow to be encrypted.<BR>
+	 * Time is taken from the packet timestamps in seconds. A HeavyHitterBypass isn't thread-safe: to use it on several threads give each
+	 * worker its own one and distribute the packets with a symmetric flow hash (see FlowHash#hashSymmetric()). A typical worker loop looks
+	 * like this:
+	 * @code
+	 * int numOfInspected = bypass.filterBurst(packets, numOfPackets);
+	 * for (int i = 0; i < numOfInspected; i++)
+	 * {
+	 *     Packet packet(packets[i]);
+	 *     // reassembly and inspection
+	 * }
+	 * @endcode
+	 */
+	class HeavyHitterBypass
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The configuration
+		 * @param[in] onPromoted An optional callback invoked before a flow is bypassed. Default value is NULL
+		 * @param[in] onBypassEnded An optional callback invoked when the bypass of a flow ends. Default value is NULL
+		 * @param[in] userCookie A pointer passed to the callbacks. Default value is NULL
+		 */
+		HeavyHitterBypass(const HeavyHitterBypassConfiguration& config = HeavyHitterBypassConfiguration(), OnHeavyHitterPromoted onPromoted = NULL,
+				OnBypassEnded onBypassEnded = NULL, void* userCookie = NULL);
+
+		/**
+		 * Check a raw packet: count it if its flow is bypassed, or count it in the sketch and promote its flow if it became heavy. The
+		 * timestamp of the packet is used as the current time, and its bytes are counted by its frame length
+		 * @param[in] rawPacket The packet. The link layer type is taken from RawPacket#getLinkLayerType()
+		 * @return True if the packet's flow is bypassed, so the packet should only be counted, false if it should be processed as usual.
+		 * The packet which promotes its flow is still processed as usual
+		 */
+		bool process(const RawPacket* rawPacket);
+
+		/**
+		 * Check a packet given as raw data, as in process(const RawPacket*)
+		 * @param[in] data A pointer to the raw data
+		 * @param[in] dataLen The raw data length in bytes
+		 * @param[in] linkType The link layer type of the raw data, as in FlowKeyExtractor#extract()
+		 * @param[in] timestampSec The timestamp of the packet in seconds
+		 * @param[in] packetLength The number of bytes the packet is counted by, or 0 to count it by dataLen. Default value is 0
+		 * @return True if the packet's flow is bypassed, false otherwise
+		 */
+		bool process(const uint8_t* data, size_t dataLen, LinkLayerType linkType, uint64_t timestampSec, size_t packetLength = 0);
+
+		/**
+		 * Check a burst of packets and reorder it so the packets to process come first, in their original order, followed by the bypassed
+		 * ones. This suits burst APIs such as DpdkDevice#receivePackets(), whose bypassed packets still need to be freed
+		 * @param[in,out] packets The packets
+		 * @param[in] numOfPackets The number of packets
+		 * @return The number of packets to process, which are now packets[0] to packets[return value - 1]
+		 */
+		int filterBurst(RawPacket** packets, int numOfPackets);
+
+		/**
+		 * Bypass a flow regardless of its volume. The promotion callback isn't invoked
+		 * @param[in] tuple The tuple of the flow in either direction
+		 * @param[in] offloadRuleId The ID of a hardware rule added for the flow, which is kept in BypassedFlow#offloadRuleId. Default value
+		 * is -1
+		 * @return True if the flow was added, false if it's already bypassed
+		 */
+		bool addBypass(const FlowTuple& tuple, int offloadRuleId = -1);
+
+		/**
+		 * End the bypass of a flow, so its packets are processed again. The OnBypassEnded callback is invoked with BypassEndedByUser
+		 * @param[in] tuple The tuple of the flow in either direction
+		 * @return True if the flow was bypassed, false otherwise
+		 */
+		bool removeBypass(const FlowTuple& tuple);
+
+		/**
+		 * Find a bypassed flow
+		 * @param[in] tuple The tuple of the flow in either direction
+		 * @return A pointer to the state of the flow, or NULL if it isn't bypassed
+		 */
+		const BypassedFlow* getBypassedFlow(const FlowTuple& tuple) const;
+
+		/**
+		 * Copy all bypassed flows to a vector, in no particular order
+		 * @param[out] flows The vector to append the flows to. The tuples have the lower address (and port) as the source
+		 */
+		void getBypassedFlows(std::vector<std::pair<FlowTuple, BypassedFlow> >& flows) const { m_BypassTable.getEntries(flows); }
+
+		/**
+		 * @return The number of bypassed flows
+		 */
+		inline size_t getNumOfBypassedFlows() const { return m_BypassTable.size(); }
+
+		/**
+		 * Move the time forward without a packet, ending the bypass of idle flows and starting a new window if the current one ended.
+		 * Useful when traffic stops. Times earlier than the current time are ignored
+		 * @param[in] currentTimeSec The current time in seconds
+		 */
+		void advanceTime(uint64_t currentTimeSec);
+
+		/**
+		 * End the bypass of all flows, invoking the OnBypassEnded callback with BypassEndedByUser for each of them, and clear the sketch.
+		 * The statistics are kept
+		 */
+		void clear();
+
+		/**
+		 * @return The configuration
+		 */
+		inline const HeavyHitterBypassConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * Get the statistics
+		 * @param[out] stats The statistics
+		 */
+		void getStats(HeavyHitterBypassStats& stats) const { stats = m_Stats; }
+
+	private:
+
+		HeavyHitterBypassConfiguration m_Config;
+		OnHeavyHitterPromoted m_OnPromoted;
+		OnBypassEnded m_OnBypassEnded;
+		void* m_UserCookie;
+		CountMinSketch m_Sketch;
+		FlowTable<FlowTuple, BypassedFlow> m_BypassTable;
+		// the sketch hashes of the flows which aren't promoted until the window ends: flows whose promotion the callback refused and
+		// closed TCP connections
+		FlatHashMap<bool> m_HeldBackFlows;
+		uint64_t m_WindowStart;
+		HeavyHitterBypassStats m_Stats;
+
+		static void onFlowRemoved(const FlowTuple& key, BypassedFlow& flow, FlowRemovalReason reason, void* userCookie);
+		static void getKey(const FlowTuple& tuple, FlowTuple& key);
+		bool endBypass(const FlowTuple& key, BypassEndReason reason);
+
+		// disable copy c'tor and assignment operator
+		HeavyHitterBypass(const HeavyHitterBypass& other);
+		HeavyHitterBypass& operator=(const HeavyHitterBypass& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_HEAVY_HITTER_BYPASS */
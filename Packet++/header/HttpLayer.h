@@ -75,7 +75,8 @@ namespace pcpp
 		virtual ~HttpMessage() {}
 
 		/**
-		 * @return A pointer to a map containing all TCP ports recognize as HTTP
+		 * @return A pointer to a map containing the TCP ports recognized as HTTP by default. Ports registered at runtime appear only in
+		 * ProtocolRegistry, so use ProtocolRegistry#isPortOfProtocol() for checking whether a port is recognized as HTTP
 		 */
 		static const std::map<uint16_t, bool>* getHTTPPortMap();
 
@@ -99,6 +100,8 @@ namespace pcpp
 		bool spacesAllowedBetweenHeaderFieldNameAndValue() { return true; }
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(HttpMessage, HTTP);
+
 
 
 
@@ -206,6 +209,8 @@ namespace pcpp
 		HttpRequestFirstLine* m_FirstLine;
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(HttpRequestLayer, HTTPRequest);
+
 
 
 
@@ -471,6 +476,8 @@ namespace pcpp
 
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(HttpResponseLayer, HTTPResponse);
+
 
 
 
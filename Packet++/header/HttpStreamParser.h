@@ -0,0 +1,290 @@
+#ifndef PACKETPP_HTTP_STREAM_PARSER
+#define PACKETPP_HTTP_STREAM_PARSER
+
+#include "HttpLayer.h"
+#include "TcpReassembly.h"
+#include <map>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct HttpStreamSlice
+	 * A piece of the data given to HttpStreamParser, such as a URI, a header field value or a piece of a message body. It points into the
+	 * parsed data (or into a small buffer which holds a line split between TCP segments), so it's valid only during the callback it's given to
+	 */
+	struct HttpStreamSlice
+	{
+		/** A pointer to the first byte. May be NULL if the slice is empty */
+		const char* data;
+		/** The number of bytes */
+		size_t length;
+
+		/**
+		 * A c'tor for this struct which creates an empty slice
+		 */
+		HttpStreamSlice() : data(NULL), length(0) {}
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] sliceData A pointer to the first byte
+		 * @param[in] sliceLength The number of bytes
+		 */
+		HttpStreamSlice(const char* sliceData, size_t sliceLength) : data(sliceData), length(sliceLength) {}
+
+		/**
+		 * @return A copy of the slice bytes as a string
+		 */
+		inline std::string toString() const { return (length > 0 ? std::string(data, length) : std::string()); }
+
+		/**
+		 * Compare the slice to a string, ignoring the case of ASCII letters
+		 * @param[in] str A null-terminated string
+		 * @return True if the slice holds the same characters as str
+		 */
+		bool equalsIgnoreCase(const char* str) const;
+	};
+
+
+	/**
+	 * The events HttpStreamParser reports, in the order they're reported for each message
+	 */
+	enum HttpStreamEventType
+	{
+		/** The request line of a request was parsed. HttpStreamEvent#method, HttpStreamEvent#uri and HttpStreamEvent#version are set */
+		HttpStreamRequestLine,
+		/** The status line of a response was parsed. HttpStreamEvent#version, HttpStreamEvent#statusCode and HttpStreamEvent#reasonPhrase are set */
+		HttpStreamStatusLine,
+		/** A header field (or a trailer field of a chunked message) was parsed. HttpStreamEvent#fieldName and HttpStreamEvent#fieldValue are set */
+		HttpStreamHeaderField,
+		/** The end of the header was reached. HttpStreamEvent#contentLength and HttpStreamEvent#isChunked describe the body */
+		HttpStreamHeadersComplete,
+		/** A piece of the message body. HttpStreamEvent#bodyData is set. Chunked bodies are reported without the chunk framing */
+		HttpStreamBodyData,
+		/** The message ended. HttpStreamEvent#bodyLength holds the body length */
+		HttpStreamMessageComplete,
+		/** The data of the connection side isn't valid HTTP, or the connection ended in the middle of a message. The rest of the data of the side is ignored */
+		HttpStreamParseError
+	};
+
+
+	/**
+	 * @struct HttpStreamEvent
+	 * An event reported by HttpStreamParser. The members which describe the message (such as #method or #statusCode) are set in all events of
+	 * the message, the slices only in the events listed in HttpStreamEventType
+	 */
+	struct HttpStreamEvent
+	{
+		/** The event type */
+		HttpStreamEventType type;
+		/** The side of the connection the message was sent from (as in TcpReassembly callbacks) */
+		int side;
+		/** The connection */
+		const ConnectionData* connectionData;
+		/** The index of the message among the messages sent from this side of the connection, starting from 0 */
+		uint64_t messageIndex;
+		/** True if the message is a request, false if it's a response */
+		bool isRequest;
+		/** The request method. For responses, the method of the request they answer, or HttpRequestLayer#HttpMethodUnknown if it wasn't seen */
+		HttpRequestLayer::HttpMethod method;
+		/** The HTTP version of the message */
+		HttpVersion version;
+		/** The status code of a response, 0 for requests */
+		int statusCode;
+		/** The request URI */
+		HttpStreamSlice uri;
+		/** The reason phrase of a response */
+		HttpStreamSlice reasonPhrase;
+		/** The header field name */
+		HttpStreamSlice fieldName;
+		/** The header field value, without the leading and trailing white space */
+		HttpStreamSlice fieldValue;
+		/** True if the header field is a trailer field of a chunked message */
+		bool isTrailer;
+		/** The piece of the body */
+		HttpStreamSlice bodyData;
+		/** The value of the Content-Length header field, or -1 if the message doesn't have one */
+		int64_t contentLength;
+		/** True if the message body is chunked */
+		bool isChunked;
+		/** The number of body bytes reported so far */
+		uint64_t bodyLength;
+	};
+
+
+	/**
+	 * @struct HttpStreamParserConfiguration
+	 * The limits of HttpStreamParser
+	 */
+	struct HttpStreamParserConfiguration
+	{
+		/**
+		 * The maximum length of a start line, header field line or chunk size line. Only lines split between pieces of data are buffered, and
+		 * only up to this length. A longer line is a parse error
+		 */
+		size_t maxLineLength;
+		/**
+		 * If false, bodies are skipped without reporting HttpStreamBodyData events, which saves the callback invocations when only the headers
+		 * are of interest
+		 */
+		bool reportBodyData;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] maxLine The value of #maxLineLength. Default value is 16384
+		 * @param[in] reportBody The value of #reportBodyData. Default value is true
+		 */
+		HttpStreamParserConfiguration(size_t maxLine = 16384, bool reportBody = true) : maxLineLength(maxLine), reportBodyData(reportBody) {}
+	};
+
+
+	/**
+	 * @class HttpStreamParser
+	 * An incremental HTTP/1.x parser for the data TcpReassembly delivers. Unlike HttpRequestLayer and HttpResponseLayer, which parse what's in
+	 * a single packet, it keeps the parsing state of each side of each connection between pieces of data, so messages whose header or body
+	 * is split between TCP segments are parsed correctly. Messages are reported as events with slices of the data instead of being collected:
+	 * only a header line split between pieces of data is copied, and bodies are never copied. Content-Length and chunked bodies, bodies
+	 * delimited by the end of the connection, pipelined requests and responses which have no body (responses to HEAD requests, 1xx, 204 and 304)
+	 * are supported. After a successful CONNECT or a protocol switch (101) the rest of the connection isn't HTTP and is ignored.<BR>
+	 * Which side sends the requests is learned from the first message of each side. Obsolete line folding in header fields isn't supported and
+	 * folded lines are ignored.<BR>
+	 * Usage: call parse() from the TcpReassembly message ready callback (TcpReassembly#OnTcpMessageReadyZeroCopy fits best, since the data isn't
+	 * copied) and connectionEnded() from the connection end callback. The callback must not call connectionEnded() or clear()
+	 */
+	class HttpStreamParser
+	{
+	public:
+		/**
+		 * @typedef OnHttpStreamEvent
+		 * A callback invoked for each event found in the data
+		 * @param[in] event The event. Its slices are valid only during the callback
+		 * @param[in] userCookie A pointer to the object given by the user
+		 */
+		typedef void (*OnHttpStreamEvent)(const HttpStreamEvent& event, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] onEvent A callback invoked for each event
+		 * @param[in] userCookie A pointer to an object passed to the callback. Default value is NULL
+		 * @param[in] config The parser limits
+		 */
+		HttpStreamParser(OnHttpStreamEvent onEvent, void* userCookie = NULL, const HttpStreamParserConfiguration& config = HttpStreamParserConfiguration());
+
+		/**
+		 * A d'tor for this class
+		 */
+		~HttpStreamParser();
+
+		/**
+		 * Parse the next piece of data of a connection side
+		 * @param[in] side The side the data was sent from (0 or 1)
+		 * @param[in] tcpData The data, as delivered by TcpReassembly
+		 */
+		void parse(int side, const TcpStreamData& tcpData);
+
+		/**
+		 * Parse the next piece of data of a connection side
+		 * @param[in] side The side the data was sent from (0 or 1)
+		 * @param[in] data A pointer to the data
+		 * @param[in] dataLen The data length in bytes
+		 * @param[in] connectionData The connection. Connections are told apart by their flow key
+		 */
+		void parse(int side, const uint8_t* data, size_t dataLen, const ConnectionData& connectionData);
+
+		/**
+		 * End the parsing of a connection and free its state. A body delimited by the end of the connection is completed, and a message
+		 * which didn't end is reported as a parse error. Should be called when the connection ends
+		 * @param[in] connectionData The connection
+		 */
+		void connectionEnded(const ConnectionData& connectionData);
+
+		/**
+		 * Free the state of all connections without reporting anything
+		 */
+		void clear();
+
+		/**
+		 * @return The number of connections whose state is kept
+		 */
+		inline size_t getNumOfConnections() const { return m_Connections.size(); }
+
+	private:
+		enum ParseState
+		{
+			ParseStartLine,
+			ParseHeaders,
+			ParseBody,
+			ParseBodyUntilClose,
+			ParseChunkSize,
+			ParseChunkData,
+			ParseChunkDataEnd,
+			ParseTrailers,
+			ParseTunnel,
+			ParseError
+		};
+
+		enum SideRole
+		{
+			RoleUnknown,
+			RoleRequests,
+			RoleResponses
+		};
+
+		struct SideState
+		{
+			ParseState state;
+			SideRole role;
+			// a line split between pieces of data. Its capacity is kept, so it's allocated once per side at most
+			std::string lineBuffer;
+			uint64_t bodyRemaining;
+			uint64_t numOfMessages;
+			HttpStreamEvent message;
+		};
+
+		// the number of requests whose methods are remembered until their responses arrive
+		enum { MaxPendingRequests = 32 };
+
+		struct ConnectionState
+		{
+			SideState sides[2];
+			HttpRequestLayer::HttpMethod pendingMethods[MaxPendingRequests];
+			size_t pendingHead;
+			size_t numOfPendingMethods;
+		};
+
+		OnHttpStreamEvent m_OnEvent;
+		void* m_UserCookie;
+		HttpStreamParserConfiguration m_Config;
+		std::map<uint32_t, ConnectionState*> m_Connections;
+		// the connection of the last piece of data, since consecutive pieces usually belong to the same connection
+		ConnectionState* m_LastConnection;
+		uint32_t m_LastFlowKey;
+
+		ConnectionState* getConnection(uint32_t flowKey);
+		void parseSide(ConnectionState* conn, int side, const uint8_t* data, size_t dataLen, const ConnectionData* connectionData);
+		bool readLine(SideState& sideState, const uint8_t*& data, size_t& dataLen, HttpStreamSlice& line);
+		void handleLine(ConnectionState* conn, int side, const HttpStreamSlice& line);
+		bool parseStartLine(ConnectionState* conn, int side, const HttpStreamSlice& line);
+		bool parseHeaderField(SideState& sideState, const HttpStreamSlice& line, bool isTrailer);
+		void headersComplete(ConnectionState* conn, int side);
+		void messageComplete(SideState& sideState);
+		void parseError(SideState& sideState, const char* reason);
+		void reportEvent(SideState& sideState, HttpStreamEventType type);
+
+		// disable copy c'tor and assignment operator
+		HttpStreamParser(const HttpStreamParser& other);
+		HttpStreamParser& operator=(const HttpStreamParser& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_HTTP_STREAM_PARSER */
@@ -2,10 +2,16 @@
 #define PACKETPP_IP_REASSEMBLY
 
 #include "Packet.h"
-#include "LRUList.h"
+#include "PacketView.h"
+#include "FixedLRUList.h"
+#include "OpenAddressingTable.h"
 #include "IpAddress.h"
-#include "PointerVector.h"
-#include <map>
+#include "RawPacketPool.h"
+#include "MemoryBudget.h"
+#include "TimerWheel.h"
+#include "StateCheckpoint.h"
+#include "MetricsRegistry.h"
+#include <vector>
 
 /**
  * @file
@@ -17,15 +23,17 @@
  * reassembly and returns a fully reassembled packet when done.<BR>
  *
  * The logic works as follows:
- * - There is an internal map that stores the reassembly data for each packet. The key to this map, meaning the way to uniquely associate a
+ * - There is an internal hash table that stores the reassembly data for each packet. The key to this table, meaning the way to uniquely associate a
  *   fragment to a (reassembled) packet is the triplet of source IP, destination IP and IP ID (for IPv4) or Fragment ID (for IPv6)
- * - When the first fragment arrives a new record is created in the map and the fragment data is copied
- * - With each fragment arriving the fragment data is copied right after the previous fragment and the reassembled packet is gradually being built
- * - When the last fragment arrives the packet is fully reassembled and returned to the user. Since all fragment data is copied, the packet pointer
- *   returned to the user has to be freed by the user when done using it
- * - The logic supports out-of-order fragments, meaning that a fragment which arrives out-of-order, its data will be copied to a list of out-of-order
- *   fragments where it waits for its turn. This list is observed each time a new fragment arrives to see if the next fragment(s) wait(s) in this
- *   list
+ * - When the first fragment of a packet arrives a new record is created in the table, taken from a pool of records which is reused, and a
+ *   reassembly buffer is allocated for the whole packet (from the pool set by pcpp#IPReassembly#setRawPacketPool if there is one)
+ * - Each fragment's data is copied once, straight to its offset in the reassembly buffer, and the reassembled packet is gradually being built.
+ *   The buffer grows geometrically if the packet turns out to be larger than expected
+ * - When the last fragment arrives the packet is fully reassembled and returned to the user. The reassembly buffer becomes the data of the
+ *   returned packet, which has to be freed by the user when done using it
+ * - The logic supports out-of-order fragments, meaning that a fragment which arrives out-of-order, its data is copied to its place in the
+ *   reassembly buffer and its offset and length are kept in a list of out-of-order fragments where it waits for its turn. This list is
+ *   observed each time a new fragment arrives to see if the next fragment(s) wait(s) in this list
  * - If a non-IP packet arrives it's returned as is to the user
  * - If a non-fragment packet arrives it's returned as is to the user
  *
@@ -35,6 +43,28 @@
  * dropped from the map along with all the data that was reassembled so far. This means that if the next fragment from this packet suddenly
  * appears it will be treated as a new reassembled packet (which will create another record in the map). The user can be notified when
  * reassembled packets are removed from the map by registering to the pcpp#IPReassembly#OnFragmentsClean callback in pcpp#IPReassembly c'tor
+ *
+ * Since the size of fragments varies, the memory can also be limited in bytes, by a byte limit given in the c'tor or by a pcpp#MemoryBudget shared
+ * with other instances or with pcpp#TcpReassembly (see pcpp#IPReassembly#setMemoryBudget). Each packet being reassembled is charged a fixed size
+ * for its state plus its reassembly buffer and out-of-order fragments. When the budget is exceeded packets are dropped in the order of the eviction
+ * policy (least recently used, oldest or largest first, see pcpp#EvictionPolicy) until it isn't, and the pcpp#IPReassembly#OnFragmentsClean
+ * callback is fired for each of them. Keeping track of the memory and of the eviction order is O(1) per fragment
+ *
+ * Packets can also be dropped when they aren't fully reassembled within a timeout from their first fragment (see the fragmentTimeout parameter
+ * of the pcpp#IPReassembly c'tor and #PCPP_IP_REASSEMBLY_DEFAULT_FRAGMENT_TIMEOUT), which frees the data of packets whose remaining fragments
+ * were lost. Time is measured by the timestamps of the processed fragments, and when fragments stop arriving it can be moved forward with
+ * pcpp#IPReassembly#advanceTime. The timeouts are kept in a timing wheel (pcpp#TimerWheel), so they take O(1) per packet and expiring packets
+ * costs only the number of packets which expire. The pcpp#IPReassembly#OnFragmentsClean callback is fired for expired packets as well
+ *
+ * The packets being reassembled can be saved to a binary checkpoint with pcpp#IPReassembly#saveState and restored by another instance with
+ * pcpp#IPReassembly#restoreState, for example when an analyzer is restarted, so fragments arriving after the restart complete the packets whose
+ * other fragments arrived before it. The checkpoint holds the packet keys, the reassembly buffers, the places of the out-of-order fragments and
+ * the reassembly timeouts
+ *
+ * Pipelines which already located the headers of each packet with pcpp#FlowKeyExtractor, such as pcpp#StreamNormalizer, can give the fragments to
+ * pcpp#IPReassembly#processRawPacket instead, along with their pcpp#PacketView. No Packet is built for the fragments or for the reassembled packet:
+ * the IP header of the reassembled packet is fixed directly in its raw data and its PacketView is filled from the header offsets kept while
+ * reassembling
  */
 
 /**
@@ -44,11 +74,19 @@
 namespace pcpp
 {
 
+	// the fragment accessors processing a fragment needs, defined in IPReassembly.cpp
+	class IPFragmentWrapper;
+
 	/** IP reassembly mechanism default capacity. If concurrent packet volume exceeds this numbers, packets will start to be dropped in
 	 * a LRU manner
 	 */
 	#define PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE 500000
 
+	/** A recommended reassembly timeout in seconds, the one Linux uses. RFC 791 suggests 15 seconds and RFC 8200 (IPv6) 60 seconds.
+	 * Please notice the timeout is disabled unless it's set in the pcpp#IPReassembly c'tor
+	 */
+	#define PCPP_IP_REASSEMBLY_DEFAULT_FRAGMENT_TIMEOUT 30
+
 	/**
 	 * @class IPReassembly
 	 * Contains the IP reassembly (a.k.a IP de-fragmentation) mechanism. Encapsulates both IPv4 and IPv6 reassembly.
@@ -59,8 +97,10 @@ namespace pcpp
 	 * - IPReassembly#getCurrentPacket() - get the reassembled data that is currently available, even if reassembly process is not yet completed
 	 * - IPReassembly#removePacket() - remove all data that is currently stored for a packet, including the reassembled data that was gathered
 	 *   so far
+	 *
+	 * IPReassembly is a metrics source (see MetricsRegistry) reporting its fragment, reassembly, drop and memory counters
 	 */
-	class IPReassembly
+	class IPReassembly : public MetricsSource
 	{
 	public:
 
@@ -113,7 +153,7 @@ namespace pcpp
 			/**
 			 * A default c'tor which zeros all members
 			 */
-			IPv4PacketKey() : m_IpID(0), m_SrcIP(IPv4Address::Zero), m_DstIP(IPv4Address::Zero) { }
+			IPv4PacketKey() : m_IpID(0), m_SrcIP(IPAddressValue::fromIPv4(0)), m_DstIP(IPAddressValue::fromIPv4(0)) { }
 
 			/**
 			 * A c'tor that sets values in each one of the members
@@ -123,6 +163,15 @@ namespace pcpp
 			 */
 			IPv4PacketKey(uint16_t ipid, IPv4Address srcip, IPv4Address dstip) : m_IpID(ipid), m_SrcIP(srcip), m_DstIP(dstip) { }
 
+			/**
+			 * A c'tor that sets values in each one of the members, taking the addresses as IPAddressValue (which avoids creating
+			 * IPv4Address instances)
+			 * @param[in] ipid IP ID value
+			 * @param[in] srcip Source IPv4 address
+			 * @param[in] dstip Dest IPv4 address
+			 */
+			IPv4PacketKey(uint16_t ipid, const IPAddressValue& srcip, const IPAddressValue& dstip) : m_IpID(ipid), m_SrcIP(srcip), m_DstIP(dstip) { }
+
 			/**
 			 * A copy c'tor for this class
 			 */
@@ -136,12 +185,12 @@ namespace pcpp
 			/**
 			 * @return Source IP address
 			 */
-			IPv4Address getSrcIP() const { return m_SrcIP; }
+			IPv4Address getSrcIP() const { return m_SrcIP.toIPv4Address(); }
 
 			/**
 			 * @return Dest IP address
 			 */
-			IPv4Address getDstIP() const { return m_DstIP; }
+			IPv4Address getDstIP() const { return m_DstIP.toIPv4Address(); }
 
 			/**
 			 * Set IP ID
@@ -175,8 +224,8 @@ namespace pcpp
 
 		private:
 			uint16_t m_IpID;
-			IPv4Address m_SrcIP;
-			IPv4Address m_DstIP;
+			IPAddressValue m_SrcIP;
+			IPAddressValue m_DstIP;
 		};
 
 
@@ -202,6 +251,15 @@ namespace pcpp
 			 */
 			IPv6PacketKey(uint32_t fragmentID, IPv6Address srcip, IPv6Address dstip) : m_FragmentID(fragmentID), m_SrcIP(srcip), m_DstIP(dstip) { }
 
+			/**
+			 * A c'tor that sets values in each one of the members, taking the addresses as IPAddressValue (which avoids creating
+			 * IPv6Address instances)
+			 * @param[in] fragmentID Fragment ID value
+			 * @param[in] srcip Source IPv6 address
+			 * @param[in] dstip Dest IPv6 address
+			 */
+			IPv6PacketKey(uint32_t fragmentID, const IPAddressValue& srcip, const IPAddressValue& dstip) : m_FragmentID(fragmentID), m_SrcIP(srcip), m_DstIP(dstip) { }
+
 			/**
 			 * A copy c'tor for this class
 			 */
@@ -215,12 +273,12 @@ namespace pcpp
 			/**
 			 * @return Source IP address
 			 */
-			IPv6Address getSrcIP() const { return m_SrcIP; }
+			IPv6Address getSrcIP() const { return m_SrcIP.toIPv6Address(); }
 
 			/**
 			 * @return Dest IP address
 			 */
-			IPv6Address getDstIP() const { return m_DstIP; }
+			IPv6Address getDstIP() const { return m_DstIP.toIPv6Address(); }
 
 			/**
 			 * Set fragment ID
@@ -254,8 +312,8 @@ namespace pcpp
 
 		private:
 			uint32_t m_FragmentID;
-			IPv6Address m_SrcIP;
-			IPv6Address m_DstIP;
+			IPAddressValue m_SrcIP;
+			IPAddressValue m_DstIP;
 		};
 
 
@@ -263,7 +321,8 @@ namespace pcpp
 		 * @typedef OnFragmentsClean
 		 * The IP reassembly mechanism has a certain capacity of concurrent packets it can handle. This capacity is determined in its c'tor
 		 * (default value is #PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE). When traffic volume exceeds this capacity the mechanism starts
-		 * dropping packets in a LRU manner (least recently used are dropped first). Whenever a packet is dropped this callback is fired
+		 * dropping packets in a LRU manner (least recently used are dropped first). Packets are also dropped when the memory budget is exceeded
+		 * (see IPReassembly#setMemoryBudget) and when their reassembly timeout passes. Whenever a packet is dropped this callback is fired
 		 * @param[in] key A pointer to the identifier of the packet that is being dropped
 		 * @param[in] userCookie A pointer to the cookie provided by the user in IPReassemby c'tor (or NULL if no cookie provided)
 		 */
@@ -297,8 +356,16 @@ namespace pcpp
 		 * @param[in] callbackUserCookie A pointer to an object provided by the user. This pointer will be returned when invoking the
 		 * onFragmentsCleanCallback. This parameter is optional, default cookie is NULL
 		 * @param[in] maxPacketsToStore Set the capacity limit of the IP reassembly mechanism. Default capacity is #PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE
+		 * @param[in] maxMemoryBytes The maximum number of bytes the packets being reassembled may take. When it's exceeded packets are dropped by the
+		 * eviction policy. This parameter is optional, default value is 0 (no limit)
+		 * @param[in] evictionPolicy The order packets are dropped in when maxMemoryBytes is exceeded. This parameter is optional, default value is
+		 * pcpp#EvictLeastRecentlyUsed
+		 * @param[in] fragmentTimeout The number of seconds a packet may take to be fully reassembled from the time its first fragment arrived. When
+		 * it passes the packet is dropped. #PCPP_IP_REASSEMBLY_DEFAULT_FRAGMENT_TIMEOUT is a recommended value. This parameter is optional, default
+		 * value is 0 (packets never time out, for example for capture files whose fragments are far apart)
 		 */
-		IPReassembly(OnFragmentsClean onFragmentsCleanCallback = NULL, void* callbackUserCookie = NULL, size_t maxPacketsToStore = PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE);
+		IPReassembly(OnFragmentsClean onFragmentsCleanCallback = NULL, void* callbackUserCookie = NULL, size_t maxPacketsToStore = PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE,
+				size_t maxMemoryBytes = 0, EvictionPolicy evictionPolicy = EvictLeastRecentlyUsed, uint32_t fragmentTimeout = 0);
 
 		/**
 		 * A d'tor for this class
@@ -364,6 +431,24 @@ namespace pcpp
 		 */
 		Packet* processPacket(RawPacket* fragment, ReassemblyStatus& status, ProtocolType parseUntil = UnknownProtocol, OsiModelLayer parseUntilLayer = OsiModelLayerUnknown);
 
+		/**
+		 * Process a fragment whose headers were already located by FlowKeyExtractor, without parsing it into layers. The reassembly logic is the
+		 * same as in processPacket(), but the reassembled packet is returned as a RawPacket: the IP header is fixed directly in its raw data (for
+		 * IPv4 the total length, fragment offset and checksum, for IPv6 the payload length, and the extensions up to the upper-layer header are
+		 * removed) and its PacketView is filled from the network header offset kept while reassembling, so neither needs to be parsed again
+		 * @param[in] fragment The fragment to process (IPv4 or IPv6). The reassembly logic doesn't change it, its data is copied
+		 * @param[in] view The view of the fragment, as filled by FlowKeyExtractor#extract(). It must describe the current data of the fragment
+		 * @param[out] status An indication of the packet reassembly status following the processing of this fragment, as in processPacket()
+		 * @param[out] reassembledView When the packet is reassembled it's set to the view of the reassembled packet. Its link layer fields are those
+		 * of the fragment which completed the packet unless the link layer headers of the first fragment differ in length. Otherwise it isn't changed
+		 * @return
+		 * - If the fragment isn't an IPv4/IPv6 packet or isn't a fragment, the fragment itself
+		 * - If the fragment is the last one and the packet is reassembled, a new RawPacket holding the reassembled packet, whose buffer is taken
+		 *   from the pool set by setRawPacketPool() if there is one. It's the user's responsibility to free it
+		 * - Otherwise NULL
+		 */
+		RawPacket* processRawPacket(RawPacket* fragment, const PacketView& view, ReassemblyStatus& status, PacketView& reassembledView);
+
 		/**
 		 * Get a partially reassembled packet. This method returns all the reassembled data that was gathered so far which is obviously not
 		 * a fully reassembled packet (otherwise it would have returned by processPacket()). Notice all data is being copied so the user is
@@ -390,39 +475,226 @@ namespace pcpp
 		/**
 		 * Get the current number of packets being processed
 		 */
-		size_t getCurrentCapacity() const { return m_FragmentMap.size(); }
+		size_t getCurrentCapacity() const { return m_PacketIndex.getSize(); }
+
+		/**
+		 * Set a pool to take the raw data buffers of reassembled packets from, instead of allocating them on the heap (see
+		 * RawPacket#copyRawData()). Since pool buffers are larger than most packets, reassembly buffers rarely have to grow. Please notice the pool must outlive all packets returned by
+		 * processPacket() and getCurrentPacket(), and all packets still being reassembled
+		 * @param[in] pool The pool to use, or NULL for allocating buffers on the heap (which is the default)
+		 */
+		void setRawPacketPool(RawPacketPool* pool) { m_RawPacketPool = pool; }
+
+		/**
+		 * @return The pool raw data buffers of reassembled packets are taken from, or NULL if buffers are allocated on the heap
+		 */
+		RawPacketPool* getRawPacketPool() const { return m_RawPacketPool; }
+
+		/**
+		 * Charge the memory of this instance to a budget shared with other instances or with TcpReassembly, instead of the budget set in the c'tor.
+		 * The memory already taken moves to the new budget, and packets are dropped if the new budget is exceeded
+		 * @param[in] budget The budget to use. It must outlive this instance or be replaced before this instance is destroyed. If it's NULL the
+		 * instance goes back to its own budget
+		 */
+		void setMemoryBudget(MemoryBudget* budget);
+
+		/**
+		 * @return The budget the memory of this instance is charged to
+		 */
+		const MemoryBudget* getMemoryBudget() const { return m_MemoryBudget; }
+
+		/**
+		 * @return The number of bytes the packets being reassembled take, as charged to the memory budget
+		 */
+		size_t getMemoryUsage() const { return m_MemoryBytes; }
+
+		/**
+		 * @return The number of packets dropped because the memory budget was exceeded
+		 */
+		uint64_t getNumOfEvictedPackets() const { return m_NumOfEvictedPackets; }
+
+		/**
+		 * Move the time of this instance forward without a fragment, for example when a live capture has no traffic, and drop the packets
+		 * whose reassembly timeout passed. The time otherwise moves with the timestamps of the processed fragments, and earlier times are ignored
+		 * @param[in] currentTime The current time, in the same clock as the packet timestamps
+		 */
+		void advanceTime(const timeval& currentTime) { setCurrentTime(currentTime.tv_sec); }
+
+		/**
+		 * @return The reassembly timeout in seconds as set in the c'tor, or 0 if packets never time out
+		 */
+		uint32_t getFragmentTimeout() const { return m_FragmentTimeout; }
+
+		/**
+		 * @return The number of packets dropped because their reassembly timeout passed
+		 */
+		uint64_t getNumOfExpiredPackets() const { return m_NumOfExpiredPackets; }
+
+		/**
+		 * @return The number of fragments processed, including malformed ones
+		 */
+		uint64_t getNumOfFragmentsProcessed() const { return m_NumOfFragmentsProcessed; }
+
+		/**
+		 * @return The number of packets fully reassembled
+		 */
+		uint64_t getNumOfPacketsReassembled() const { return m_NumOfPacketsReassembled; }
+
+		/**
+		 * @return The number of malformed fragments processed
+		 */
+		uint64_t getNumOfMalformedFragments() const { return m_NumOfMalformedFragments; }
+
+		/**
+		 * @return The number of packets dropped because the maximum number of packets being reassembled was reached
+		 */
+		uint64_t getNumOfPacketsDroppedAtCapacity() const { return m_NumOfPacketsDroppedAtCapacity; }
+
+		/**
+		 * Report the counters of this instance to a MetricsRegistry snapshot: fragments processed, packets reassembled and being reassembled,
+		 * malformed fragments, packets dropped for capacity, memory or timeout, and memory usage. The counters are plain variables updated by the
+		 * thread processing the fragments, so when the snapshot is taken by another thread they may be slightly behind
+		 * @param[in] writer The writer to report the values to
+		 */
+		void collectMetrics(MetricsWriter& writer);
+
+		/**
+		 * Save the packets being reassembled to a checkpoint: their keys, the data received so far, the places of their out-of-order fragments
+		 * and their reassembly timeouts. The state of other instances or of TcpReassembly can be written to the same checkpoint after it
+		 * @param[in] writer The writer of the checkpoint
+		 */
+		void saveState(CheckpointWriter& writer) const;
+
+		/**
+		 * Save the packets being reassembled to a checkpoint file, see saveState(CheckpointWriter&). The file is replaced only when the whole
+		 * checkpoint was written
+		 * @param[in] fileName The file name
+		 * @return True if the file was written, false otherwise
+		 */
+		bool saveState(const std::string& fileName) const;
+
+		/**
+		 * Restore packets saved by saveState(). This instance must not be reassembling any packet yet. The LRU and eviction order of the
+		 * restored packets starts over in the order they were saved, and if there are more of them than the capacity of this instance the
+		 * first ones are dropped as usual. If the checkpoint is invalid nothing is changed
+		 * @param[in] reader The reader of the checkpoint. When the method succeeds it's positioned after the state of this instance
+		 * @return True if the state was restored, false if this instance is already reassembling packets or the checkpoint is invalid
+		 */
+		bool restoreState(CheckpointReader& reader);
+
+		/**
+		 * Restore packets from a checkpoint file written by saveState(const std::string&), see restoreState(CheckpointReader&)
+		 * @param[in] fileName The file name
+		 * @return True if the state was restored, false otherwise
+		 */
+		bool restoreState(const std::string& fileName);
 
 	private:
 
+		// identifies the state of an IPReassembly instance in a checkpoint, and the version of its format
+		static const uint32_t CheckpointMagic = 0x52504950;
+		static const uint16_t CheckpointVersion = 1;
+
+		// a RawPacket whose buffer is allocated ahead of its data, defined in IPReassembly.cpp
+		class ReassemblyBuffer;
+
+		// a fragment which arrived before the data preceding it. Its data is already in the reassembly buffer, only its place is kept
 		struct IPFragment
 		{
-			uint16_t fragmentOffset;
+			uint32_t fragmentOffset;
+			uint32_t fragmentDataLen;
 			bool lastFragment;
-			uint8_t* fragmentData;
-			size_t fragmentDataLen;
-			IPFragment() { fragmentOffset = 0; lastFragment = false; fragmentData = NULL; fragmentDataLen = 0; }
-			~IPFragment() { delete [] fragmentData; }
 		};
 
 		struct IPFragmentData
 		{
-			uint16_t currentOffset;
-			RawPacket* data;
-			bool deleteData;
+			// the payload bytes received in order from the beginning of the packet
+			uint32_t currentOffset;
+			// the headers of the first fragment followed by the payload of each fragment at its offset, NULL until a fragment is copied
+			ReassemblyBuffer* data;
+			// the bytes in data before the payload. Until the first fragment arrives they're the headers of another fragment
+			size_t headerLen;
+			// the offset of the IP header of the first fragment in data, PacketView::NoOffset until it arrives or if it isn't known (for
+			// packets restored from a checkpoint)
+			uint16_t networkOffset;
+			bool gotFirstFragment;
 			uint32_t fragmentID;
+			uint32_t hash;
+			// the key is kept in place, packetKey points to the one of the packet's IP version
+			IPv4PacketKey ipv4Key;
+			IPv6PacketKey ipv6Key;
 			PacketKey* packetKey;
-			PointerVector<IPFragment> outOfOrderFragments;
-			IPFragmentData(PacketKey* pktKey, uint32_t fragId) { currentOffset = 0; data = NULL; deleteData = true; fragmentID = fragId; packetKey = pktKey; }
-			~IPFragmentData() { delete packetKey; if (deleteData && data != NULL) { delete data; } }
+			// the vector keeps its storage when the instance is reused
+			std::vector<IPFragment> outOfOrderFragments;
+			// the bytes charged to the memory budget for this packet and its item in the eviction list
+			size_t memoryBytes;
+			uint32_t evictionId;
+			// the reassembly timeout of the packet
+			uint32_t timerId;
+			// the next free instance while this instance is in the pool
+			IPFragmentData* nextFree;
+			IPFragmentData();
+			~IPFragmentData();
 		};
 
-		LRUList<uint32_t>* m_PacketLRU;
-		std::map<uint32_t, IPFragmentData*> m_FragmentMap;
+		// a hash table slot. The hash is kept in the slot so probing doesn't touch the packets
+		struct PacketSlot
+		{
+			uint32_t hash;
+			IPFragmentData* fragData;
+
+			PacketSlot() : hash(0), fragData(NULL) {}
+			bool isEmpty() const { return fragData == NULL; }
+		};
+
+		FixedLRUList<uint32_t>* m_PacketLRU;
+		// the packets being reassembled by their hash
+		OpenAddressingTable<PacketSlot> m_PacketIndex;
+		// IPFragmentData instances which aren't in use
+		IPFragmentData* m_FreeFragmentData;
 		OnFragmentsClean m_OnFragmentsCleanCallback;
 		void* m_CallbackUserCookie;
-
+		RawPacketPool* m_RawPacketPool;
+		// the memory of the packets being reassembled, charged to m_MemoryBudget, and the order they're dropped in when it's exceeded
+		MemoryBudget m_OwnMemoryBudget;
+		MemoryBudget* m_MemoryBudget;
+		EvictionList m_EvictionList;
+		size_t m_MemoryBytes;
+		uint64_t m_NumOfEvictedPackets;
+		// the reassembly timeouts, set when the first fragment of a packet arrives
+		TimerWheel m_ExpiryTimers;
+		time_t m_CurrentTime;
+		uint32_t m_FragmentTimeout;
+		uint64_t m_NumOfExpiredPackets;
+		uint64_t m_NumOfFragmentsProcessed;
+		uint64_t m_NumOfPacketsReassembled;
+		uint64_t m_NumOfMalformedFragments;
+		uint64_t m_NumOfPacketsDroppedAtCapacity;
+
+		Packet* processFragment(Packet* fragment, ReassemblyStatus& status, ProtocolType parseUntil, OsiModelLayer parseUntilLayer);
+		IPFragmentData* processFragment(IPFragmentWrapper* fragWrapper, const RawPacket* rawFragment, ReassemblyStatus& status);
+		RawPacket* buildRawPacket(IPFragmentData* fragData, const PacketView& fragmentView, PacketView& reassembledView);
+		void removeReassembledPacket(IPFragmentData* fragData);
+		void countFragment(ReassemblyStatus status);
+		IPFragmentData* findPacket(uint32_t hash) const;
+		void insertPacket(IPFragmentData* fragData);
+		void erasePacket(uint32_t hash);
+		IPFragmentData* allocateFragmentData();
+		void freeFragmentData(IPFragmentData* fragData);
+		void copyFirstFragment(IPFragmentData* fragData, const RawPacket* fragment, size_t headerLen, size_t payloadLen);
+		void copyFragment(IPFragmentData* fragData, const RawPacket* fragment, size_t headerLen, uint32_t fragOffset, const uint8_t* payload, size_t payloadLen, bool lastFragment);
 		void addNewFragment(uint32_t hash, IPFragmentData* fragData);
 		bool matchOutOfOrderFragments(IPFragmentData* fragData);
+		void updateMemoryUsage(IPFragmentData* fragData);
+		void releaseMemory(IPFragmentData* fragData);
+		void dropPacket(IPFragmentData* fragData);
+		void evictPackets();
+		void setCurrentTime(time_t currentTime);
+		void readPackets(CheckpointReader& reader, uint32_t numOfPackets, bool build);
+
+		// disable copy c'tor and assignment operator
+		IPReassembly(const IPReassembly& other);
+		IPReassembly& operator=(const IPReassembly& other);
 	};
 
 } // namespace pcpp
@@ -98,6 +98,8 @@ namespace pcpp
 		PACKETPP_IPPROTO_NONE = 59,
 		/** IPv6 Destination options		*/
 		PACKETPP_IPPROTO_DSTOPTS = 60,
+		/** Stream Control Transmission Protocol	*/
+		PACKETPP_IPPROTO_SCTP = 132,
 		/** Raw IP packets			*/
 		PACKETPP_IPPROTO_RAW = 255,
 		/** Maximum value */
@@ -394,6 +396,18 @@ namespace pcpp
 		 * @return The IPv4Option object
 		 */
 		IPv4Option build() const;
+
+		/**
+		 * @return The size in bytes of the option build() creates, or 0 if the option can't be built out of the parameters defined in the c'tor
+		 */
+		size_t getRecordSize() const;
+
+		/**
+		 * Build the IPv4Option object into a buffer given by the caller instead of allocating one, for example directly into the packet data
+		 * @param[in] recordBuffer A buffer of at least getRecordSize() bytes
+		 * @return The IPv4Option object, which points to recordBuffer, or a logical NULL object if the option can't be built
+		 */
+		IPv4Option build(uint8_t* recordBuffer) const;
 	};
 
 
@@ -461,11 +475,20 @@ namespace pcpp
 		 */
 		inline IPv4Address getSrcIpAddress() { return IPv4Address(getIPv4Header()->ipSrc); }
 
+		/**
+		 * Get the source IP address in the form of IPAddressValue. Unlike getSrcIpAddress() no string representation is created
+		 * @return An IPAddressValue containing the source address
+		 */
+		inline IPAddressValue getSrcIpAddressValue() const { return IPAddressValue::fromIPv4(((const iphdr*)m_Data)->ipSrc); }
+
 		/**
 		 * Set the source IP address
 		 * @param[in] ipAddr The IP address to set
+		 * @param[in] updateChecksums If set to true the IPv4 header checksum and the checksum of a following TCP or UDP layer (whose
+		 * pseudo-header contains the address) are updated incrementally (RFC 1624) instead of having to call computeCalculateFields().
+		 * Please notice an incrementally updated checksum is only valid if it was valid before the change. Default value is false
 		 */
-		inline void setSrcIpAddress(const IPv4Address& ipAddr) { getIPv4Header()->ipSrc = ipAddr.toInt(); }
+		void setSrcIpAddress(const IPv4Address& ipAddr, bool updateChecksums = false);
 
 		/**
 		 * Get the destination IP address in the form of IPv4Address
@@ -473,11 +496,32 @@ namespace pcpp
 		 */
 		inline IPv4Address getDstIpAddress() { return IPv4Address(getIPv4Header()->ipDst); }
 
+		/**
+		 * Get the destination IP address in the form of IPAddressValue. Unlike getDstIpAddress() no string representation is created
+		 * @return An IPAddressValue containing the destination address
+		 */
+		inline IPAddressValue getDstIpAddressValue() const { return IPAddressValue::fromIPv4(((const iphdr*)m_Data)->ipDst); }
+
 		/**
 		 * Set the dest IP address
 		 * @param[in] ipAddr The IP address to set
+		 * @param[in] updateChecksums If set to true the checksums are updated incrementally, same as in setSrcIpAddress(). Default
+		 * value is false
+		 */
+		void setDstIpAddress(const IPv4Address& ipAddr, bool updateChecksums = false);
+
+		/**
+		 * @return The time-to-live (TTL) value of the packet
 		 */
-		inline void setDstIpAddress(const IPv4Address& ipAddr) { getIPv4Header()->ipDst = ipAddr.toInt(); }
+		inline uint8_t getTimeToLive() { return getIPv4Header()->timeToLive; }
+
+		/**
+		 * Set the time-to-live (TTL) value of the packet
+		 * @param[in] ttl The value to set
+		 * @param[in] updateChecksum If set to true the IPv4 header checksum is updated incrementally (RFC 1624) instead of having to
+		 * call computeCalculateFields(). Default value is false
+		 */
+		void setTimeToLive(uint8_t ttl, bool updateChecksum = false);
 
 		/**
 		 * @return True if this packet is a fragment (in sense of IP fragmentation), false otherwise
@@ -592,6 +636,8 @@ namespace pcpp
 
 		std::string toString();
 
+		void dump(PacketDumpWriter& writer);
+
 		OsiModelLayer getOsiModelLayer() const { return OsiModelNetworkLayer; }
 
 	private:
@@ -605,8 +651,12 @@ namespace pcpp
 		void adjustOptionsTrailer(size_t totalOptSize);
 		void initLayer();
 		void initLayerInPacket(uint8_t* data, size_t dataLen, Layer* prevLayer, Packet* packet, bool setTotalLenAsDataLen);
+		void updateChecksumsForAddress(uint32_t oldAddr, uint32_t newAddr);
+		void markModifiedForAddress();
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(IPv4Layer, IPv4);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_IPV4_LAYER */
@@ -282,6 +282,18 @@ namespace pcpp
 			 * @return The IPv6Option object
 			 */
 			IPv6Option build() const;
+
+			/**
+			 * @return The size in bytes of the option build() creates, or 0 if the option can't be built out of the parameters defined in the c'tor
+			 */
+			size_t getRecordSize() const;
+
+			/**
+			 * Build the IPv6Option object into a buffer given by the caller instead of allocating one, for example directly into the packet data
+			 * @param[in] recordBuffer A buffer of at least getRecordSize() bytes
+			 * @return The IPv6Option object, which points to recordBuffer, or a logical NULL object if the option can't be built
+			 */
+			IPv6Option build(uint8_t* recordBuffer) const;
 		};
 
 		/**
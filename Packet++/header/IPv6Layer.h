@@ -49,11 +49,21 @@ namespace pcpp
 
 	/**
 	 * @class IPv6Layer
-	 * Represents an IPv6 protocol layer
+	 * Represents an IPv6 protocol layer.<BR>
+	 * When the layer is parsed the extension headers chain is walked once, and the type and offset of each extension are kept
+	 * inline in the layer. Nothing is allocated for that: the IPv6Extension objects are created only on the first call which needs
+	 * them (such as getExtensionOfType() or addExtension()), while getExtensionCount(), getExtensionType(), isFragment(),
+	 * getFragmentationHeader() and getUpperLayerProtocol() read the inline data
 	 */
 	class IPv6Layer : public Layer
 	{
 	public:
+		/**
+		 * The maximum number of extensions parsed in a single IPv6 header. Data following a longer chain of extensions is treated
+		 * as the layer payload
+		 */
+		static const size_t MaxExtensions = 16;
+
 		/**
 		 * A constructor that creates the layer from an existing packet raw data
 		 * @param[in] data A pointer to the raw data (will be casted to @ref ip6_hdr)
@@ -102,20 +112,65 @@ namespace pcpp
 		 */
 		inline IPv6Address getSrcIpAddress() { return IPv6Address(getIPv6Header()->ipSrc); }
 
+		/**
+		 * Get the source IP address in the form of IPAddressValue. Unlike getSrcIpAddress() no string representation is created
+		 * @return An IPAddressValue containing the source address
+		 */
+		inline IPAddressValue getSrcIpAddressValue() const { return IPAddressValue::fromIPv6(((const ip6_hdr*)m_Data)->ipSrc); }
+
 		/**
 		 * Get the destination IP address in the form of IPv6Address
 		 * @return An IPv6Address containing the destination address
 		 */
 		inline IPv6Address getDstIpAddress() { return IPv6Address(getIPv6Header()->ipDst); }
 
+		/**
+		 * Get the destination IP address in the form of IPAddressValue. Unlike getDstIpAddress() no string representation is created
+		 * @return An IPAddressValue containing the destination address
+		 */
+		inline IPAddressValue getDstIpAddressValue() const { return IPAddressValue::fromIPv6(((const ip6_hdr*)m_Data)->ipDst); }
+
 		/**
 		 * @return Number of IPv6 extensions in this layer
 		 */
-		size_t getExtensionCount();
+		inline size_t getExtensionCount() const { return m_NumOfExtensions; }
+
+		/**
+		 * Get the type of an extension without creating the extension objects
+		 * @param[in] index The index of the extension in the chain
+		 * @return The extension type, or IPv6Extension#IPv6ExtensionUnknown if index is out of range
+		 */
+		IPv6Extension::IPv6ExtensionType getExtensionType(size_t index) const;
+
+		/**
+		 * Get the fragmentation header without creating the extension objects
+		 * @return A pointer to the fragmentation header inside the layer data, or NULL if the layer doesn't have a fragmentation extension
+		 */
+		IPv6FragmentationHeader::ipv6_frag_header* getFragmentationHeader() const;
+
+		/**
+		 * @return The protocol of the header which follows the IPv6 header and its extensions, meaning the next header field of the last
+		 * extension (or of the IPv6 header if there are no extensions)
+		 */
+		uint8_t getUpperLayerProtocol() const;
+
+		/**
+		 * Find the upper-layer protocol of an IPv6 packet by walking its extensions as IPv6Layer does, without creating a layer. Useful
+		 * for building flow keys
+		 * @param[in] data A pointer to the IPv6 header
+		 * @param[in] dataLen The length of the data in bytes
+		 * @param[out] protocol The protocol of the header which follows the extensions
+		 * @param[out] headerLen The length of the IPv6 header and its extensions, meaning the offset of the upper-layer header. Notice
+		 * it may be larger than dataLen if the packet is truncated
+		 * @param[out] fragmentHeaderOffset The offset of the fragmentation extension, or 0 if the packet isn't a fragment
+		 * @return True if data contains an IPv6 header, false otherwise
+		 */
+		static bool findUpperLayerProtocol(const uint8_t* data, size_t dataLen, uint8_t& protocol, size_t& headerLen, size_t& fragmentHeaderOffset);
 
 		/**
 		 * A templated getter for an IPv6 extension of a type TIPv6Extension. TIPv6Extension has to be one of the supported IPv6 extensions,
-		 * meaning a class that inherits IPv6Extension. If the requested extension type isn't found NULL is returned
+		 * meaning a class that inherits IPv6Extension. If the requested extension type isn't found NULL is returned. The extension objects
+		 * are created on the first call
 		 * @return A pointer to the extension instance or NULL if the requested extension type isn't found
 		 */
 		template<class TIPv6Extension>
@@ -127,8 +182,8 @@ namespace pcpp
 		 * to the newly added extension object is returned, otherwise NULL is returned
 		 * @param[in] extensionHeader The extension object to add. Notice the object passed here is read-only, meaning its data is copied
 		 * but the object itself isn't modified
-		 * @return If the extension is added successfully a pointer to the newly added extension object is returned. Otherwise NULL is
-		 * returned
+		 * @return If the extension is added successfully a pointer to the newly added extension object is returned. Otherwise (including
+		 * when the layer already has #MaxExtensions extensions) NULL is returned
 		 */
 		template<class TIPv6Extension>
 		TIPv6Extension* addExtension(const TIPv6Extension& extensionHeader);
@@ -141,7 +196,7 @@ namespace pcpp
 		/**
 		 * @return True if this packet is an IPv6 fragment, meaning if it has an IPv6FragmentationHeader extension
 		 */
-		bool isFragment();
+		bool isFragment() const;
 
 
 		// implement abstract methods
@@ -166,22 +221,37 @@ namespace pcpp
 
 		std::string toString();
 
+		void dump(PacketDumpWriter& writer);
+
 		OsiModelLayer getOsiModelLayer() const { return OsiModelNetworkLayer; }
 
 	private:
 		void initLayer();
 		void parseExtensions();
+		void createExtensionObjects();
 		void deleteExtensions();
 
+		// walk the extensions chain, recording the type and offset of each extension. Returns the upper-layer protocol
+		static uint8_t walkExtensions(const uint8_t* data, size_t dataLen, size_t& headerLen, size_t& numOfExtensions,
+				uint8_t* extensionTypes, uint16_t* extensionOffsets);
+
+		// created by createExtensionObjects() on demand
 		IPv6Extension* m_FirstExtension;
 		IPv6Extension* m_LastExtension;
 		size_t m_ExtensionsLen;
+		size_t m_NumOfExtensions;
+		uint8_t m_ExtensionTypes[MaxExtensions];
+		uint16_t m_ExtensionOffsets[MaxExtensions];
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(IPv6Layer, IPv6);
+
 
 	template<class TIPv6Extension>
 	TIPv6Extension* IPv6Layer::getExtensionOfType()
 	{
+		createExtensionObjects();
+
 		IPv6Extension* curExt = m_FirstExtension;
 		while (curExt != NULL && dynamic_cast<TIPv6Extension*>(curExt) == NULL)
 			curExt = curExt->getNextHeader();
@@ -192,6 +262,11 @@ namespace pcpp
 	template<class TIPv6Extension>
 	TIPv6Extension* IPv6Layer::addExtension(const TIPv6Extension& extensionHeader)
 	{
+		if (m_NumOfExtensions == MaxExtensions)
+			return NULL;
+
+		createExtensionObjects();
+
 		int offsetToAddHeader = (int)getHeaderLen();
 		if (!extendLayer(offsetToAddHeader, extensionHeader.getExtensionLen()))
 		{
@@ -216,6 +291,9 @@ namespace pcpp
 			getIPv6Header()->nextHeader = newHeader->getExtensionType();
 		}
 
+		m_ExtensionTypes[m_NumOfExtensions] = (uint8_t)newHeader->getExtensionType();
+		m_ExtensionOffsets[m_NumOfExtensions] = (uint16_t)offsetToAddHeader;
+		m_NumOfExtensions++;
 		m_ExtensionsLen += newHeader->getExtensionLen();
 
 		return newHeader;
@@ -695,9 +695,13 @@ namespace pcpp
 
 		std::string toString();
 
+		void dump(PacketDumpWriter& writer);
+
         OsiModelLayer getOsiModelLayer() const { return OsiModelNetworkLayer; }
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(IcmpLayer, ICMP);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_ICMP_LAYER */
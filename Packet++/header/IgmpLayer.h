@@ -230,6 +230,8 @@ public:
 	OsiModelLayer getOsiModelLayer() const { return OsiModelNetworkLayer; }
 };
 
+PCPP_LAYER_PROTOCOL_TRAITS(IgmpLayer, IGMP);
+
 
 /**
  * @class IgmpV1Layer
@@ -269,6 +271,8 @@ public:
 
 };
 
+PCPP_LAYER_PROTOCOL_TRAITS(IgmpV1Layer, IGMPv1);
+
 
 /**
  * @class IgmpV2Layer
@@ -307,6 +311,8 @@ public:
 	void computeCalculateFields();
 };
 
+PCPP_LAYER_PROTOCOL_TRAITS(IgmpV2Layer, IGMPv2);
+
 
 /**
  * @class IgmpV3QueryLayer
@@ -0,0 +1,356 @@
+#ifndef PACKETPP_L3_FORWARDER
+#define PACKETPP_L3_FORWARDER
+
+#include "LpmTable.h"
+#include "MacAddress.h"
+#include "IpAddress.h"
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file
+ * The forwarding engine of a software IPv4/IPv6 router. pcpp#L3Forwarder holds the routes of the router in an pcpp#IPv4LpmTable and an
+ * pcpp#IPv6LpmTable, which map each prefix to a next hop. A next hop is an output port and the Ethernet header (the MAC address of the
+ * gateway or host and the MAC address of the port) packets to it get, so forwarding a packet is an LPM lookup, a TTL (hop limit)
+ * decrement with an incremental checksum update and a 12-byte copy. pcpp#L3Forwarder#forwardBurst does it for a burst of frames in place,
+ * looking up their addresses with lookupBulk(), and returns the output port of each frame.
+ *
+ * Frames the forwarder doesn't handle itself go to #HostPort, and are given to pcpp#L3Forwarder#processHostFrame, which plays the part of
+ * the router's control plane:
+ * - ARP requests for the addresses of the router are answered, and ARP replies and requests from neighbors are learned
+ * - IPv6 neighbor solicitations for the addresses of the router are answered, and neighbor advertisements are learned
+ * - A packet to a next hop whose MAC address isn't known yet (or to a host on a connected subnet which wasn't learned yet) triggers an ARP
+ *   request or a neighbor solicitation for it, and is dropped. Requests for the same address are sent at most once a second
+ *
+ * A learned host on a connected subnet gets a host route (/32 or /128) with its own next hop, so packets to it are forwarded without
+ * the control plane from then on. The engine doesn't send ICMP errors (time exceeded, unreachable) and doesn't fragment; packets which
+ * would need them are dropped and counted.
+ *
+ * A DPDK router built on it is pcpp#DpdkL3Router. The engine itself only works on frame buffers, so it can be used with any device:
+ *
+ * @code
+ * L3Forwarder forwarder(2);
+ * forwarder.setPort(0, MacAddress("00:11:22:33:44:00"));
+ * forwarder.setPort(1, MacAddress("00:11:22:33:44:01"));
+ * forwarder.addPortAddress(0, IPv4Address(std::string("10.0.0.1")), 24);
+ * forwarder.addPortAddress(1, IPv4Address(std::string("10.1.0.1")), 24);
+ * forwarder.addRoute(IPv4Address(std::string("192.168.0.0")), 16, IPv4Address(std::string("10.1.0.254")), 1);
+ *
+ * // for each received burst
+ * forwarder.forwardBurst(frames, frameLengths, count, inPort, outPorts, &stats);
+ * // send frame i on port outPorts[i], drop it if outPorts[i] is DropPort, or give it to processHostFrame() if it's HostPort
+ * @endcode
+ */
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct L3ForwarderStats
+	 * The statistics of the frames given to L3Forwarder#forwardBurst(). Each frame is counted once
+	 */
+	struct L3ForwarderStats
+	{
+		/** Number of IPv4 packets forwarded */
+		uint64_t forwardedIPv4Packets;
+		/** Number of IPv6 packets forwarded */
+		uint64_t forwardedIPv6Packets;
+		/** Number of frames for the control plane: ARP, neighbor discovery and packets to the addresses of the router */
+		uint64_t localPackets;
+		/** Number of packets given to the control plane because the MAC address of their next hop isn't known yet */
+		uint64_t unresolvedPackets;
+		/** Number of packets dropped because no route matches their destination */
+		uint64_t noRoutePackets;
+		/** Number of packets dropped because their TTL or hop limit expired */
+		uint64_t ttlExceededPackets;
+		/** Number of frames dropped because they're malformed, aren't IP, or aren't addressed to the MAC address of the port */
+		uint64_t filteredPackets;
+	};
+
+
+	/**
+	 * @class L3Forwarder
+	 * An IPv4/IPv6 forwarding engine with longest prefix match routing, next hop tables with MAC rewrite and a neighbor cache. Please refer
+	 * to the documentation at the top of L3Forwarder.h for understanding how to use this class.<BR>
+	 * Ports are numbered from 0, and must be set with setPort() before routes use them. forwardBurst() doesn't take any lock and may be
+	 * called by any number of threads (typically one per RX queue), while routes and neighbors change. Changes to routes and neighbors,
+	 * including the ones processHostFrame() makes, are serialized by a lock, so processHostFrame() may be called by all forwarding threads.
+	 * A next hop is published to the forwarding threads only when its MAC address is known, and its header is updated in place when the
+	 * neighbor's MAC address changes. Next hops aren't removed, and a route which is removed leaves its next hop for other routes to reuse
+	 */
+	class L3Forwarder
+	{
+	public:
+
+		/**
+		 * The output port of frames which should be dropped
+		 */
+		static const uint16_t DropPort = 0xffff;
+
+		/**
+		 * The output port of frames which should be given to processHostFrame()
+		 */
+		static const uint16_t HostPort = 0xfffe;
+
+		/**
+		 * The minimal size of the reply buffer of processHostFrame(), which fits an IPv6 neighbor advertisement or solicitation
+		 */
+		static const size_t MaxReplyLength = 86;
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] numOfPorts The number of ports of the router
+		 * @param[in] maxNumOfNextHops The maximum number of next hops, including one for every learned host on a connected subnet. Default
+		 * value is 4096
+		 * @param[in] maxNumOfIPv4Groups The maximum number of groups of the IPv4 routing table (see IPv4LpmTable). Default value is 1024
+		 * @param[in] maxNumOfIPv6Groups The maximum number of groups of the IPv6 routing table (see IPv6LpmTable). Default value is 4096
+		 */
+		L3Forwarder(uint16_t numOfPorts, uint32_t maxNumOfNextHops = 4096, uint32_t maxNumOfIPv4Groups = 1024, uint32_t maxNumOfIPv6Groups = 4096);
+
+		/**
+		 * A d'tor for this class
+		 */
+		~L3Forwarder();
+
+		/**
+		 * Set the MAC address of a port, which is the source address of the frames sent on it. Frames received on the port are routed only
+		 * if they're sent to this address. Should be called before forwarding starts
+		 * @param[in] port The port number
+		 * @param[in] macAddress The MAC address of the port
+		 * @return False if the port number or the address is invalid, true otherwise
+		 */
+		bool setPort(uint16_t port, const MacAddress& macAddress);
+
+		/**
+		 * Assign an IPv4 address to a port. The address is local (packets to it go to #HostPort and ARP requests for it are answered), and
+		 * its subnet is a connected route of the port
+		 * @param[in] port The port number. Its MAC address must be set
+		 * @param[in] address The address of the router on the port
+		 * @param[in] prefixLength The length of the subnet prefix (1-32)
+		 * @return False if the port or the prefix length is invalid or the tables are full, true otherwise
+		 */
+		bool addPortAddress(uint16_t port, const IPv4Address& address, uint8_t prefixLength);
+
+		/**
+		 * Assign an IPv6 address to a port. The address is local (packets to it go to #HostPort and neighbor solicitations for it are
+		 * answered), and its subnet is a connected route of the port
+		 * @param[in] port The port number. Its MAC address must be set
+		 * @param[in] address The address of the router on the port
+		 * @param[in] prefixLength The length of the subnet prefix (1-128)
+		 * @return False if the port or the prefix length is invalid or the tables are full, true otherwise
+		 */
+		bool addPortAddress(uint16_t port, const IPv6Address& address, uint8_t prefixLength);
+
+		/**
+		 * Add an IPv4 route, or replace the route of the same prefix
+		 * @param[in] prefix The destination prefix. Bits beyond the prefix length are ignored
+		 * @param[in] prefixLength The prefix length (0-32)
+		 * @param[in] gateway The address of the next router, or 0.0.0.0 if the prefix is directly connected to the port
+		 * @param[in] port The output port. Its MAC address must be set
+		 * @return False if the port or the prefix length is invalid or the tables are full, true otherwise
+		 */
+		bool addRoute(const IPv4Address& prefix, uint8_t prefixLength, const IPv4Address& gateway, uint16_t port);
+
+		/**
+		 * Add an IPv6 route, or replace the route of the same prefix
+		 * @param[in] prefix The destination prefix. Bits beyond the prefix length are ignored
+		 * @param[in] prefixLength The prefix length (0-128)
+		 * @param[in] gateway The address of the next router, or :: if the prefix is directly connected to the port
+		 * @param[in] port The output port. Its MAC address must be set
+		 * @return False if the port or the prefix length is invalid or the tables are full, true otherwise
+		 */
+		bool addRoute(const IPv6Address& prefix, uint8_t prefixLength, const IPv6Address& gateway, uint16_t port);
+
+		/**
+		 * Remove an IPv4 route
+		 * @param[in] prefix The destination prefix
+		 * @param[in] prefixLength The prefix length (0-32)
+		 * @return False if there's no route of this prefix, true otherwise
+		 */
+		bool removeRoute(const IPv4Address& prefix, uint8_t prefixLength);
+
+		/**
+		 * Remove an IPv6 route
+		 * @param[in] prefix The destination prefix
+		 * @param[in] prefixLength The prefix length (0-128)
+		 * @return False if there's no route of this prefix, true otherwise
+		 */
+		bool removeRoute(const IPv6Address& prefix, uint8_t prefixLength);
+
+		/**
+		 * Add a static neighbor, or change the MAC address of a neighbor. Next hops through the neighbor are resolved, and if it's on a
+		 * connected subnet it gets a host route
+		 * @param[in] address The IPv4 address of the neighbor
+		 * @param[in] macAddress The MAC address of the neighbor
+		 */
+		void addNeighbor(const IPv4Address& address, const MacAddress& macAddress);
+
+		/**
+		 * Add a static neighbor, or change the MAC address of a neighbor. Next hops through the neighbor are resolved, and if it's on a
+		 * connected subnet it gets a host route
+		 * @param[in] address The IPv6 address of the neighbor
+		 * @param[in] macAddress The MAC address of the neighbor
+		 */
+		void addNeighbor(const IPv6Address& address, const MacAddress& macAddress);
+
+		/**
+		 * Get the MAC address of a neighbor from the neighbor cache
+		 * @param[in] address The IPv4 address of the neighbor
+		 * @param[out] macAddress The MAC address of the neighbor
+		 * @return False if the MAC address of the neighbor isn't known, true otherwise
+		 */
+		bool getNeighbor(const IPv4Address& address, MacAddress& macAddress);
+
+		/**
+		 * Get the MAC address of a neighbor from the neighbor cache
+		 * @param[in] address The IPv6 address of the neighbor
+		 * @param[out] macAddress The MAC address of the neighbor
+		 * @return False if the MAC address of the neighbor isn't known, true otherwise
+		 */
+		bool getNeighbor(const IPv6Address& address, MacAddress& macAddress);
+
+		/**
+		 * Route a burst of frames received on a port. The IPv4 and IPv6 destinations of the burst are looked up together with
+		 * IPv4LpmTable#lookupBulk() and IPv6LpmTable#lookupBulk(), and each forwarded frame is changed in place: its TTL or hop limit is
+		 * decremented (updating the IPv4 checksum incrementally) and its Ethernet addresses are replaced by the ones of its next hop
+		 * @param[in] frames The Ethernet frames. Frames which aren't forwarded aren't changed
+		 * @param[in] frameLengths The length of each frame
+		 * @param[in] count The number of frames
+		 * @param[in] inPort The port the frames were received on
+		 * @param[out] outPorts An array of count ports the output port of each frame is written to, #DropPort for frames which should be
+		 * dropped or #HostPort for frames which should be given to processHostFrame()
+		 * @param[out] stats If not NULL the frames are added to these statistics. Each forwarding thread should have its own
+		 */
+		void forwardBurst(uint8_t* const* frames, const uint16_t* frameLengths, uint16_t count, uint16_t inPort, uint16_t* outPorts,
+				L3ForwarderStats* stats = NULL);
+
+		/**
+		 * Route a single frame, see forwardBurst()
+		 * @param[in] frame The Ethernet frame. It's changed in place if it's forwarded
+		 * @param[in] frameLength The length of the frame
+		 * @param[in] inPort The port the frame was received on
+		 * @param[out] stats If not NULL the frame is added to these statistics
+		 * @return The output port, #DropPort or #HostPort
+		 */
+		uint16_t forwardFrame(uint8_t* frame, uint16_t frameLength, uint16_t inPort, L3ForwarderStats* stats = NULL);
+
+		/**
+		 * Handle a frame forwardBurst() sent to #HostPort: learn neighbors from ARP and neighbor discovery frames, answer requests for the
+		 * addresses of the router, and ask for the MAC address of the next hop of an unresolved packet. The frame isn't changed, and should
+		 * be freed by the caller afterwards
+		 * @param[in] frame The Ethernet frame
+		 * @param[in] frameLength The length of the frame
+		 * @param[in] inPort The port the frame was received on
+		 * @param[in] now The current time in seconds (any monotonic clock), used for sending requests for the same address at most once a
+		 * second
+		 * @param[out] reply A buffer of at least #MaxReplyLength bytes the frame to send is written to, if there is one
+		 * @param[out] replyPort The port the frame in the reply buffer should be sent on
+		 * @return The length of the frame written to the reply buffer, or 0 if there's nothing to send
+		 */
+		size_t processHostFrame(const uint8_t* frame, size_t frameLength, uint16_t inPort, uint32_t now, uint8_t* reply, uint16_t& replyPort);
+
+		/**
+		 * @return The number of ports of the router
+		 */
+		inline uint16_t getNumOfPorts() const { return (uint16_t)m_Ports.size(); }
+
+		/**
+		 * @return The number of next hops in use
+		 */
+		inline uint32_t getNumOfNextHops() const { return m_NumOfNextHops; }
+
+		/**
+		 * @return The IPv4 routing table, whose values are next hop indices
+		 */
+		inline const IPv4LpmTable& getIPv4Table() const { return m_IPv4Table; }
+
+		/**
+		 * @return The IPv6 routing table, whose values are next hop indices
+		 */
+		inline const IPv6LpmTable& getIPv6Table() const { return m_IPv6Table; }
+
+	private:
+
+		enum NextHopState
+		{
+			// the MAC address of the gateway isn't known yet
+			NextHopUnresolved = 0,
+			// packets get the header of the next hop and go to its port
+			NextHopResolved = 1,
+			// the destination is one of the addresses of the router
+			NextHopLocal = 2,
+			// the destination is on a connected subnet of the port, and doesn't have a host route yet
+			NextHopConnected = 3
+		};
+
+		struct NextHop
+		{
+			// the destination and source MAC addresses of the forwarded frames
+			uint8_t ethHeader[12];
+			uint16_t port;
+			volatile uint8_t state;
+			bool isIPv6;
+			uint8_t gateway[16];
+		};
+
+		struct PortInfo
+		{
+			uint8_t macAddress[6];
+			bool isSet;
+			bool hasIPv4Address;
+			bool hasIPv6Address;
+			uint32_t ipv4Address;
+			uint8_t ipv6Address[16];
+		};
+
+		struct Neighbor
+		{
+			uint8_t macAddress[6];
+			bool isResolved;
+			bool requestSent;
+			uint32_t requestTime;
+		};
+
+		std::vector<PortInfo> m_Ports;
+		IPv4LpmTable m_IPv4Table;
+		IPv6LpmTable m_IPv6Table;
+		NextHop* m_NextHops;
+		uint32_t m_NumOfNextHops;
+		uint32_t m_MaxNumOfNextHops;
+		uint32_t m_LocalNextHop;
+		// the next hops by output port, address family and gateway, and the neighbors by address family and address
+		std::map<std::string, uint32_t> m_NextHopIndex;
+		std::map<std::string, Neighbor> m_Neighbors;
+		pthread_mutex_t m_Lock;
+
+		static std::string makeKey(bool isIPv6, const uint8_t* address, uint16_t port);
+		inline size_t getAddressLength(bool isIPv6) const { return isIPv6 ? 16 : 4; }
+		uint32_t getNextHop(uint16_t port, bool isIPv6, const uint8_t* gateway, NextHopState state);
+		bool addRoute(bool isIPv6, const uint8_t* prefix, uint8_t prefixLength, uint32_t nextHop);
+		uint32_t lookupRoute(bool isIPv6, const uint8_t* address) const;
+		bool isPortValid(uint16_t port) const;
+		void learnNeighbor(bool isIPv6, const uint8_t* address, const uint8_t* macAddress, bool isStatic);
+		bool findNeighbor(bool isIPv6, const uint8_t* address, uint8_t* macAddress);
+		size_t processArp(const uint8_t* frame, size_t frameLength, uint16_t inPort, uint8_t* reply, uint16_t& replyPort);
+		size_t processNeighborDiscovery(const uint8_t* frame, size_t frameLength, uint16_t inPort, uint8_t* reply, uint16_t& replyPort);
+		size_t resolveNextHop(const uint8_t* frame, size_t frameLength, uint32_t now, uint8_t* reply, uint16_t& replyPort);
+		size_t buildArpRequest(uint16_t port, uint32_t targetAddress, uint8_t* reply);
+		size_t buildNeighborMessage(uint16_t port, bool isSolicitation, const uint8_t* dstMacAddress, const uint8_t* dstAddress,
+				const uint8_t* targetAddress, uint8_t* reply);
+
+		// disable copy c'tor and assignment operator
+		L3Forwarder(const L3Forwarder& other);
+		L3Forwarder& operator=(const L3Forwarder& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_L3_FORWARDER */
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include "ProtocolType.h"
+#include "PacketDumpWriter.h"
 #include <string>
 
 /// @file
@@ -34,6 +35,7 @@ namespace pcpp
 	};
 
 	class Packet;
+	class LayerArena;
 
 	/**
 	 * @class Layer
@@ -76,9 +78,10 @@ namespace pcpp
 		virtual ~Layer();
 
 		/**
-		 * @return A pointer to the next layer in the protocol stack or NULL if the layer is the last one
+		 * @return A pointer to the next layer in the protocol stack or NULL if the layer is the last one. If the packet is parsed
+		 * lazily (see Packet#setLazyParsing()) and the next layer wasn't parsed yet, it's parsed when this method is called
 		 */
-		inline Layer* getNextLayer() { return m_NextLayer; }
+		inline Layer* getNextLayer() { if (m_IsParsePending) parsePendingLayer(); return m_NextLayer; }
 
 		/**
 		 * @return A pointer to the previous layer in the protocol stack or NULL if the layer is the first one
@@ -126,6 +129,22 @@ namespace pcpp
 		 */
 		void copyData(uint8_t* toArr);
 
+		/**
+		 * @return True if the layer was modified since the packet was parsed or since the last call to Packet#computeCalculateFields(),
+		 * meaning its calculated fields and the ones of the layers preceding it may be stale. Layers created by the user are modified
+		 * until they're computed
+		 */
+		inline bool isModified() const { return m_IsModified; }
+
+		/**
+		 * Mark the layer as modified, so Packet#computeCalculateFields() recomputes it even when asked to compute only modified layers.
+		 * Inserting, removing, extending or shortening layers and the setters which don't update checksums incrementally mark the layers
+		 * they affect, but a change made directly through the header pointer (for example getIPv4Header()) isn't tracked and should be
+		 * followed by a call to this method. If the change affects a calculated field of a following layer (for example the IP addresses
+		 * are part of the TCP and UDP checksums) that layer should be marked as well
+		 */
+		inline void setModified() { m_IsModified = true; }
+
 
 		// implement abstract methods
 
@@ -154,11 +173,77 @@ namespace pcpp
 		 */
 		virtual std::string toString() = 0;
 
+		/**
+		 * Write the layer to a PacketDumpWriter, which appends it to a buffer as the text of toString() or as a JSON object without
+		 * allocating memory per field. The default implementation writes toString() as the layer summary, layers override it to write
+		 * their fields
+		 * @param[in] writer The writer to write the layer to
+		 */
+		virtual void dump(PacketDumpWriter& writer);
+
 		/**
 		 * @return The OSI Model layer this protocol belongs to
 		 */
         virtual OsiModelLayer getOsiModelLayer() const = 0;
 
+		/**
+		 * An allocation function for layers. Allocates the layer on the heap
+		 */
+		static void* operator new(size_t size);
+
+		/**
+		 * An allocation function used while parsing packets. If the packet has a layer arena (see Packet#setLayerArena())
+		 * and there is enough space left in it the layer is allocated from the arena, otherwise it's allocated on the heap
+		 * @param[in] size The layer object size
+		 * @param[in] packet The packet the layer is being created for. May be NULL
+		 */
+		static void* operator new(size_t size, Packet* packet);
+
+		/**
+		 * The standard placement allocation function, constructs the layer in memory provided by the user
+		 */
+		static void* operator new(size_t size, void* ptr) { return ptr; }
+
+		/**
+		 * Accepts other placement allocation forms (such as the ones used by debug allocators which pass file name and line number)
+		 * so they keep working for layers. The layer is allocated on the heap, same as operator new(size_t)
+		 */
+		template<typename T1, typename T2>
+		static void* operator new(size_t size, T1, T2) { return operator new(size); }
+
+		/**
+		 * A deallocation function for layers. Returns the memory to the arena it was allocated from or to the heap
+		 */
+		static void operator delete(void* ptr);
+
+		/**
+		 * A deallocation function matching operator new(size_t, Packet*), called only if the layer c'tor throws
+		 */
+		static void operator delete(void* ptr, Packet* packet);
+
+		/**
+		 * A deallocation function matching the standard placement allocation function. Does nothing
+		 */
+		static void operator delete(void* ptr, void* place) {}
+
+		/**
+		 * A deallocation function matching the forwarding placement allocation function, called only if the layer c'tor throws
+		 */
+		template<typename T1, typename T2>
+		static void operator delete(void* ptr, T1, T2) { Layer::operator delete(ptr); }
+
+	private:
+		// parse the next layer of a lazily parsed packet (see Packet#setLazyParsing())
+		void parsePendingLayer();
+
+		// every layer allocated by one of the allocation functions above is preceded by this header which holds the arena the layer
+		// was allocated from (or NULL if it was allocated on the heap). The union keeps the layer object aligned
+		union AllocationHeader
+		{
+			LayerArena* arena;
+			long double alignment;
+		};
+
 	protected:
 		uint8_t* m_Data;
 		size_t m_DataLen;
@@ -167,13 +252,15 @@ namespace pcpp
 		Layer* m_NextLayer;
 		Layer* m_PrevLayer;
 		bool m_IsAllocatedInPacket;
+		bool m_IsParsePending;
+		bool m_IsModified;
 
-		Layer() : m_Data(NULL), m_DataLen(0), m_Packet(NULL), m_Protocol(UnknownProtocol), m_NextLayer(NULL), m_PrevLayer(NULL), m_IsAllocatedInPacket(false) { }
+		Layer() : m_Data(NULL), m_DataLen(0), m_Packet(NULL), m_Protocol(UnknownProtocol), m_NextLayer(NULL), m_PrevLayer(NULL), m_IsAllocatedInPacket(false), m_IsParsePending(false), m_IsModified(true) { }
 
 		Layer(uint8_t* data, size_t dataLen, Layer* prevLayer, Packet* packet) :
 			m_Data(data), m_DataLen(dataLen),
 			m_Packet(packet), m_Protocol(UnknownProtocol),
-			m_NextLayer(NULL), m_PrevLayer(prevLayer), m_IsAllocatedInPacket(false) {}
+			m_NextLayer(NULL), m_PrevLayer(prevLayer), m_IsAllocatedInPacket(false), m_IsParsePending(false), m_IsModified(false) {}
 
 		// Copy c'tor
 		Layer(const Layer& other);
@@ -186,6 +273,37 @@ namespace pcpp
 		virtual bool shortenLayer(int offsetInLayer, size_t numOfBytesToShorten);
 	};
 
+
+	/**
+	 * @struct LayerProtocolTraits
+	 * A compile-time mapping between a layer class and the protocols of the layers that are instances of this class. It's used by
+	 * Packet#getLayerOfType() and Packet#getNextLayerOfType() to find layers by their protocol (using the packet's protocol bitmask)
+	 * instead of using dynamic_cast on each layer. The generic template has no protocols (::UnknownProtocol), which means layers of such
+	 * classes are searched using dynamic_cast as before. Layer classes declare their protocols using PCPP_LAYER_PROTOCOL_TRAITS().
+	 * Please notice the mapping must be accurate: each layer whose protocol is in the mask must be an instance of the class (or of a class
+	 * derived from it)
+	 */
+	template<class TLayer>
+	struct LayerProtocolTraits
+	{
+		/**
+		 * A bitmask of all protocols (ProtocolType values) of layers that are instances of this class
+		 */
+		static const uint64_t ProtocolMask = (uint64_t)UnknownProtocol;
+	};
+
+/**
+ * Declare the protocols of a layer class (see LayerProtocolTraits). Should be used inside namespace pcpp, right after the class declaration
+ * @param[in] LayerClass The layer class
+ * @param[in] protocolMask A single ProtocolType value, or a bitmask of ProtocolType values if the class is a base class of several layers
+ */
+#define PCPP_LAYER_PROTOCOL_TRAITS(LayerClass, protocolMask) \
+	template<> \
+	struct LayerProtocolTraits<LayerClass> \
+	{ \
+		static const uint64_t ProtocolMask = (uint64_t)(protocolMask); \
+	}
+
 } // namespace pcpp
 
 #endif /* PACKETPP_LAYER */
@@ -0,0 +1,102 @@
+#ifndef PACKETPP_LAYER_ARENA
+#define PACKETPP_LAYER_ARENA
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class LayerArena
+	 * A simple bump allocator that can be attached to a Packet (using Packet#setLayerArena()) and be used for allocating
+	 * the layers created while parsing the packet, instead of allocating each layer separately on the heap.
+	 * Layers are placement-constructed into a pre-allocated buffer one after the other. Freeing a layer doesn't return memory
+	 * to the heap, it only decreases the number of live allocations. Once all layers allocated from the arena are freed
+	 * (which typically happens when the packet is destructed or when Packet#setRawPacket() is called again) the arena is rewound
+	 * to its beginning and can be reused for the next packet without any heap activity.
+	 * If the arena runs out of space layers are transparently allocated on the heap as usual.
+	 * Please notice this class isn't thread-safe: all layers allocated from the arena should be freed in the same thread
+	 */
+	class LayerArena
+	{
+	public:
+
+		/**
+		 * The default arena size in bytes. It's enough for holding the layers of most common packets
+		 */
+		static const size_t DefaultArenaSize = 2048;
+
+		/**
+		 * A c'tor for this class. Allocates the arena buffer
+		 * @param[in] size The arena size in bytes. Default value is DefaultArenaSize
+		 */
+		LayerArena(size_t size = DefaultArenaSize);
+
+		/**
+		 * A d'tor for this class. Frees the arena buffer. Please notice the arena must outlive all layers allocated from it
+		 */
+		~LayerArena();
+
+		/**
+		 * Allocate a memory block from the arena
+		 * @param[in] size The requested block size in bytes
+		 * @return A pointer to the allocated block or NULL if there is not enough space left in the arena
+		 */
+		void* allocate(size_t size);
+
+		/**
+		 * Return a memory block to the arena. The memory itself is reclaimed only when all blocks allocated from the arena
+		 * are returned, in which case the arena is rewound to its beginning
+		 * @param[in] ptr A pointer to a memory block previously returned by allocate(). If ptr isn't inside the arena nothing happens
+		 */
+		void deallocate(void* ptr);
+
+		/**
+		 * @return True if the ptr points to a location inside the arena buffer, false otherwise
+		 */
+		inline bool contains(const void* ptr) const { return (const uint8_t*)ptr >= m_Buffer && (const uint8_t*)ptr < m_Buffer + m_Size; }
+
+		/**
+		 * @return The arena size in bytes
+		 */
+		inline size_t getSize() const { return m_Size; }
+
+		/**
+		 * @return The number of bytes currently in use
+		 */
+		inline size_t getUsedSize() const { return m_Offset; }
+
+		/**
+		 * @return The number of blocks allocated from the arena that weren't deallocated yet
+		 */
+		inline size_t getNumOfLiveAllocations() const { return m_LiveAllocations; }
+
+		/**
+		 * Mark the arena to be deleted once all blocks allocated from it are returned. If there are no live allocations the arena
+		 * is deleted immediately. This is used by Packet for arenas it owns, in case a layer allocated from the arena was
+		 * detached from the packet and is still held by the user when the packet is destructed
+		 */
+		void deleteWhenEmpty();
+
+	private:
+		uint8_t* m_Buffer;
+		size_t m_Size;
+		size_t m_Offset;
+		size_t m_LiveAllocations;
+		bool m_DeleteWhenEmpty;
+
+		// disable copy c'tor and assignment operator
+		LayerArena(const LayerArena& other);
+		LayerArena& operator=(const LayerArena& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_LAYER_ARENA */
@@ -0,0 +1,257 @@
+#ifndef PACKETPP_LPM_TABLE
+#define PACKETPP_LPM_TABLE
+
+#include "IpAddress.h"
+#include <map>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/** The number of addresses IPv4LpmTable#lookupBulk() and IPv6LpmTable#lookupBulk() resolve together, prefetching the entries of all of
+ * them before reading any */
+#define PCPP_LPM_BULK_SIZE 16
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class LpmTrie
+	 * The longest prefix match engine shared by IPv4LpmTable and IPv6LpmTable, which should be used instead of it: a multibit trie whose
+	 * first level is indexed by the first 24 (IPv4) or 16 (IPv6) bits of the address and whose next levels are groups of 256 entries, each
+	 * indexed by the next byte of the address. Prefixes are expanded into all the entries they cover (controlled prefix expansion), and each
+	 * entry keeps the length of the prefix it came from, so a longer prefix is never overwritten by a shorter one added later. A lookup
+	 * therefore reads one entry per level and no more, which is one memory access for most IPv4 addresses (the DIR-24-8 scheme).<BR>
+	 * The groups are allocated in the c'tor, so the table never reallocates. Changes are done by a single thread while any number of threads
+	 * look addresses up: each entry is a 32-bit word written with one store, and a new group is filled before the entry pointing to it is
+	 * published, so a lookup running during a change finds either the old or the new route. Groups of removed prefixes aren't reclaimed
+	 * until clear() is called
+	 */
+	class LpmTrie
+	{
+	public:
+
+		/**
+		 * The value lookups return for addresses which don't match any prefix
+		 */
+		static const uint32_t NoRoute = 0xffffffff;
+
+		/**
+		 * The largest value a prefix can be mapped to
+		 */
+		static const uint32_t MaxValue = 0x3fffff;
+
+		/**
+		 * A d'tor for this class
+		 */
+		~LpmTrie();
+
+		/**
+		 * Remove all prefixes and free all groups. Unlike other changes, it shouldn't be done while other threads look addresses up
+		 */
+		void clear();
+
+		/**
+		 * @return The number of prefixes in the table
+		 */
+		inline size_t getNumOfPrefixes() const { return m_Prefixes.size(); }
+
+		/**
+		 * @return The number of groups of 256 entries in use, each holding the entries of one byte of the addresses under a prefix longer
+		 * than the first level
+		 */
+		inline uint32_t getNumOfGroups() const { return m_NumOfGroups; }
+
+		/**
+		 * @return The maximum number of groups, as given in the c'tor
+		 */
+		inline uint32_t getMaxNumOfGroups() const { return m_MaxNumOfGroups; }
+
+	protected:
+
+		LpmTrie(uint8_t addressLength, uint8_t firstLevelBits, uint32_t maxNumOfGroups);
+
+		bool addPrefix(const uint8_t* prefix, uint8_t prefixLength, uint32_t value);
+		bool removePrefix(const uint8_t* prefix, uint8_t prefixLength);
+		bool findPrefix(const uint8_t* prefix, uint8_t prefixLength, uint32_t& value) const;
+
+		static inline bool isGroup(uint32_t entry) { return (entry & 0x40000000) != 0; }
+		static inline uint32_t getEntryValue(uint32_t entry) { return (entry & 0x80000000) != 0 ? (entry & MaxValue) : NoRoute; }
+
+		inline uint32_t getFirstLevelIndex(const uint8_t* address) const
+		{
+			return (m_FirstLevelBits == 24 ? ((uint32_t)address[0] << 16) | ((uint32_t)address[1] << 8) | address[2] :
+					((uint32_t)address[0] << 8) | address[1]);
+		}
+
+		// the first level entry and the group entries of an address, NoRoute if it doesn't match any prefix
+		inline uint32_t lookupAddress(const uint8_t* address, uint32_t entry) const
+		{
+			size_t byteIndex = m_FirstLevelBits / 8;
+			while (isGroup(entry))
+				entry = m_Groups[(size_t)(entry & MaxValue) * 256 + address[byteIndex++]];
+			return getEntryValue(entry);
+		}
+
+		volatile uint32_t* m_FirstLevel;
+		volatile uint32_t* m_Groups;
+
+	private:
+
+		uint8_t m_AddressLength;
+		uint8_t m_FirstLevelBits;
+		uint32_t m_NumOfGroups;
+		uint32_t m_MaxNumOfGroups;
+		// the prefixes in the table, keyed by their masked address bytes followed by their length
+		std::map<std::string, uint32_t> m_Prefixes;
+
+		std::string makeKey(const uint8_t* prefix, uint8_t prefixLength) const;
+		volatile uint32_t* getGroup(volatile uint32_t* entry);
+		void setEntries(volatile uint32_t* entry, size_t count, uint8_t prefixLength, uint32_t newEntry);
+		void replaceEntries(volatile uint32_t* entry, size_t count, uint8_t prefixLength, uint32_t newEntry);
+		bool walkPrefix(const uint8_t* prefix, uint8_t prefixLength, uint32_t newEntry, bool replace);
+
+		// disable copy c'tor and assignment operator
+		LpmTrie(const LpmTrie& other);
+		LpmTrie& operator=(const LpmTrie& other);
+	};
+
+
+	/**
+	 * @class IPv4LpmTable
+	 * A longest prefix match table of IPv4 prefixes, such as the routes of a router, mapping each prefix to a 22-bit value (for example the
+	 * index of a next hop). It uses the DIR-24-8 scheme: a first level of 2^24 entries (64MB, allocated when the table is created) indexed
+	 * by the first 24 bits of the address, and groups of 256 entries for the addresses under prefixes longer than 24 bits. A lookup is one
+	 * memory access, or two for addresses under a prefix longer than 24 bits. See LpmTrie for the details and thread safety
+	 */
+	class IPv4LpmTable : public LpmTrie
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] maxNumOfGroups The maximum number of groups of 256 entries, each needed by the prefixes longer than 24 bits under one
+		 * /24. Default value is 1024
+		 */
+		IPv4LpmTable(uint32_t maxNumOfGroups = 1024);
+
+		/**
+		 * Add a prefix, or change the value of a prefix already in the table
+		 * @param[in] prefix The prefix address. Bits beyond the prefix length are ignored
+		 * @param[in] prefixLength The prefix length (0-32)
+		 * @param[in] value The value lookups return for addresses matching the prefix. Must be at most #MaxValue
+		 * @return False if the prefix length or the value is invalid or the table has no free groups, true otherwise
+		 */
+		bool add(const IPv4Address& prefix, uint8_t prefixLength, uint32_t value);
+
+		/**
+		 * Remove a prefix. Addresses it covered match the longest shorter prefix containing them from now on
+		 * @param[in] prefix The prefix address. Bits beyond the prefix length are ignored
+		 * @param[in] prefixLength The prefix length (0-32)
+		 * @return False if the prefix isn't in the table, true otherwise
+		 */
+		bool remove(const IPv4Address& prefix, uint8_t prefixLength);
+
+		/**
+		 * Get the value of a prefix (an exact match, not a longest prefix match)
+		 * @param[in] prefix The prefix address. Bits beyond the prefix length are ignored
+		 * @param[in] prefixLength The prefix length (0-32)
+		 * @param[out] value The value of the prefix
+		 * @return False if the prefix isn't in the table, true otherwise
+		 */
+		bool find(const IPv4Address& prefix, uint8_t prefixLength, uint32_t& value) const;
+
+		/**
+		 * Find the value of the longest prefix matching an address
+		 * @param[in] address The address in network byte order, as in the IPv4 header (see IPv4Address#toInt())
+		 * @return The value of the longest matching prefix, or #NoRoute if no prefix matches
+		 */
+		inline uint32_t lookup(uint32_t address) const
+		{
+			const uint8_t* bytes = (const uint8_t*)&address;
+			return lookupAddress(bytes, m_FirstLevel[getFirstLevelIndex(bytes)]);
+		}
+
+		/**
+		 * Find the values of the longest prefixes matching many addresses, prefetching the entries of #PCPP_LPM_BULK_SIZE addresses at a
+		 * time before reading them so their cache misses overlap
+		 * @param[in] addresses The addresses in network byte order, as in the IPv4 header
+		 * @param[out] values An array the values are written to, #NoRoute for addresses which don't match any prefix
+		 * @param[in] count The number of addresses
+		 */
+		void lookupBulk(const uint32_t* addresses, uint32_t* values, size_t count) const;
+	};
+
+
+	/**
+	 * @class IPv6LpmTable
+	 * A longest prefix match table of IPv6 prefixes, such as the routes of a router, mapping each prefix to a 22-bit value (for example the
+	 * index of a next hop). Its first level has 2^16 entries indexed by the first 16 bits of the address, followed by groups of 256 entries
+	 * for each further byte of the prefixes, so a lookup of an address under a /48 takes 5 memory accesses and under a /64 takes 7. See
+	 * LpmTrie for the details and thread safety
+	 */
+	class IPv6LpmTable : public LpmTrie
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] maxNumOfGroups The maximum number of groups of 256 entries. A prefix of length L needs up to (L-9)/8 groups, fewer
+		 * when it shares leading bytes with other prefixes. Default value is 4096
+		 */
+		IPv6LpmTable(uint32_t maxNumOfGroups = 4096);
+
+		/**
+		 * Add a prefix, or change the value of a prefix already in the table
+		 * @param[in] prefix The prefix address. Bits beyond the prefix length are ignored
+		 * @param[in] prefixLength The prefix length (0-128)
+		 * @param[in] value The value lookups return for addresses matching the prefix. Must be at most #MaxValue
+		 * @return False if the prefix length or the value is invalid or the table has no free groups, true otherwise
+		 */
+		bool add(const IPv6Address& prefix, uint8_t prefixLength, uint32_t value);
+
+		/**
+		 * Remove a prefix. Addresses it covered match the longest shorter prefix containing them from now on
+		 * @param[in] prefix The prefix address. Bits beyond the prefix length are ignored
+		 * @param[in] prefixLength The prefix length (0-128)
+		 * @return False if the prefix isn't in the table, true otherwise
+		 */
+		bool remove(const IPv6Address& prefix, uint8_t prefixLength);
+
+		/**
+		 * Get the value of a prefix (an exact match, not a longest prefix match)
+		 * @param[in] prefix The prefix address. Bits beyond the prefix length are ignored
+		 * @param[in] prefixLength The prefix length (0-128)
+		 * @param[out] value The value of the prefix
+		 * @return False if the prefix isn't in the table, true otherwise
+		 */
+		bool find(const IPv6Address& prefix, uint8_t prefixLength, uint32_t& value) const;
+
+		/**
+		 * Find the value of the longest prefix matching an address
+		 * @param[in] address The 16 bytes of the address, as in the IPv6 header
+		 * @return The value of the longest matching prefix, or #NoRoute if no prefix matches
+		 */
+		inline uint32_t lookup(const uint8_t* address) const
+		{
+			return lookupAddress(address, m_FirstLevel[getFirstLevelIndex(address)]);
+		}
+
+		/**
+		 * Find the values of the longest prefixes matching many addresses, prefetching the entries of #PCPP_LPM_BULK_SIZE addresses at a
+		 * time before reading them so their cache misses overlap
+		 * @param[in] addresses Pointers to the 16 bytes of each address, for example into the IPv6 headers of the packets
+		 * @param[out] values An array the values are written to, #NoRoute for addresses which don't match any prefix
+		 * @param[in] count The number of addresses
+		 */
+		void lookupBulk(const uint8_t* const* addresses, uint32_t* values, size_t count) const;
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_LPM_TABLE */
@@ -0,0 +1,222 @@
+#ifndef PACKETPP_MAC_LEARNING_TABLE
+#define PACKETPP_MAC_LEARNING_TABLE
+
+#include "RawPacket.h"
+#include "MacAddress.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/** The number of entries in each bucket of MacLearningTable. The keys of a bucket fill one cache line and its values another */
+#define PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE 8
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct MacLearningTableStats
+	 * The statistics of a MacLearningTable
+	 */
+	struct MacLearningTableStats
+	{
+		/** Number of entries added */
+		uint64_t learnedEntries;
+		/** Number of entries whose port changed because their address was seen on another port (station moves) */
+		uint64_t movedEntries;
+		/** Number of live entries replaced by new ones because their bucket was full */
+		uint64_t evictedEntries;
+		/** Number of entries removed by age() */
+		uint64_t agedEntries;
+	};
+
+
+	/**
+	 * @class MacLearningTable
+	 * The forwarding database (FDB) of a software L2 switch: a hash table mapping (MAC address, VLAN ID) pairs to the port they were last
+	 * seen on, which is learned from the source addresses of received frames and aged out after a period of inactivity. switchFrame() and
+	 * switchBurst() implement the forwarding decision of a transparent bridge on top of it: they learn the source of each frame and return
+	 * the port its destination was learned on, #FloodPort for broadcast, multicast and unknown destinations, or #DropPort for frames which
+	 * should be filtered.<BR>
+	 * The table is meant to be shared by all worker threads of a switch, each receiving from its own ports:
+	 * - A key (48-bit MAC address and 12-bit VLAN ID) is packed in a 64-bit word, and the keys of a bucket are kept in one cache line so a
+	 *   lookup reads one line for the keys and one for the matching value
+	 * - Lookups and refreshing the time of known entries never take a lock. Entries are published and removed with atomic stores, and
+	 *   refreshing an entry writes it only when its time changed, so the cache lines of busy stations aren't written on every frame
+	 * - Adding entries, moving them to another port and removing them are serialized by a lock, which is taken only for the first frame of a
+	 *   new station or a station which moved
+	 *
+	 * When all entries of a bucket are live, a new entry replaces the least recently seen one. Time is given by the caller in seconds (any
+	 * monotonic clock). Entries which weren't seen for longer than the aging time are ignored by lookups, and are removed by age(), which
+	 * should be called regularly (for example once a second by a management thread) so their slots can be reused
+	 */
+	class MacLearningTable
+	{
+	public:
+
+		/**
+		 * The port returned for frames which should be sent to all ports except the one they were received on
+		 */
+		static const uint16_t FloodPort = 0xffff;
+
+		/**
+		 * The port returned for frames which shouldn't be forwarded: frames whose destination was learned on the port they were received
+		 * on, frames with a multicast source address and frames too short to contain an Ethernet header
+		 */
+		static const uint16_t DropPort = 0xfffe;
+
+		/**
+		 * The maximum port number a table can hold
+		 */
+		static const uint16_t MaxPort = 0xfffd;
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] maxEntries The number of entries to size the table for. The table has room for at least twice as many, so buckets rarely
+		 * fill up
+		 * @param[in] agingTime The number of seconds an entry may stay without frames from its address before it's ignored and removed.
+		 * Default value is 300, the default of IEEE 802.1D
+		 */
+		MacLearningTable(size_t maxEntries, uint32_t agingTime = 300);
+
+		/**
+		 * A d'tor for this class. Must not be called while other threads use the table
+		 */
+		~MacLearningTable();
+
+		/**
+		 * Learn that an address was seen on a port: add an entry for it, refresh its time, or move it to the new port
+		 * @param[in] mac The MAC address
+		 * @param[in] vlanId The VLAN ID, or 0 for untagged frames
+		 * @param[in] port The port, up to #MaxPort
+		 * @param[in] now The current time in seconds
+		 */
+		void learn(const MacAddress& mac, uint16_t vlanId, uint16_t port, uint32_t now);
+
+		/**
+		 * Find the port an address was learned on
+		 * @param[in] mac The MAC address
+		 * @param[in] vlanId The VLAN ID, or 0 for untagged frames
+		 * @param[in] now The current time in seconds
+		 * @return The port, or #FloodPort if the address wasn't learned or its entry aged out
+		 */
+		uint16_t lookup(const MacAddress& mac, uint16_t vlanId, uint32_t now) const;
+
+		/**
+		 * Learn the source of an Ethernet frame (with or without an 802.1Q or 802.1ad tag) and find the port to forward it to
+		 * @param[in] data The frame
+		 * @param[in] dataLen The frame length
+		 * @param[in] inPort The port the frame was received on, up to #MaxPort
+		 * @param[in] now The current time in seconds
+		 * @return The port the destination was learned on, #FloodPort or #DropPort
+		 */
+		uint16_t switchFrame(const uint8_t* data, size_t dataLen, uint16_t inPort, uint32_t now);
+
+		/**
+		 * Same as switchFrame() for a burst of frames received on the same port. The buckets of the whole burst are prefetched before any
+		 * of them is read, which hides most of the memory latency of a large table
+		 * @param[in] frames The frames
+		 * @param[in] frameLengths The frame lengths
+		 * @param[in] count The number of frames
+		 * @param[in] inPort The port the frames were received on
+		 * @param[in] now The current time in seconds
+		 * @param[out] outPorts An array of at least count entries the decisions are written to
+		 */
+		void switchBurst(const uint8_t* const* frames, const uint16_t* frameLengths, size_t count, uint16_t inPort, uint32_t now, uint16_t* outPorts);
+
+		/**
+		 * Same as switchFrame() for a burst of raw packets received on the same port
+		 * @param[in] packets The packets
+		 * @param[in] count The number of packets
+		 * @param[in] inPort The port the packets were received on
+		 * @param[in] now The current time in seconds
+		 * @param[out] outPorts An array of at least count entries the decisions are written to
+		 */
+		void switchBurst(RawPacket* const* packets, size_t count, uint16_t inPort, uint32_t now, uint16_t* outPorts);
+
+		/**
+		 * Remove the entries which weren't seen for longer than the aging time. It may be called while other threads use the table
+		 * @param[in] now The current time in seconds
+		 * @return The number of entries removed
+		 */
+		size_t age(uint32_t now);
+
+		/**
+		 * Remove the entries of a port, for example when its link goes down
+		 * @param[in] port The port
+		 * @return The number of entries removed
+		 */
+		size_t flushPort(uint16_t port);
+
+		/**
+		 * Remove all entries. The statistics are kept
+		 */
+		void clear();
+
+		/**
+		 * @return The number of entries in the table, including entries which aged out but weren't removed by age() yet
+		 */
+		size_t getNumOfEntries() const;
+
+		/**
+		 * @return The number of entries the table has room for
+		 */
+		inline size_t getCapacity() const { return m_NumOfBuckets * PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE; }
+
+		/**
+		 * @return The aging time in seconds
+		 */
+		inline uint32_t getAgingTime() const { return m_AgingTime; }
+
+		/**
+		 * Change the aging time
+		 * @param[in] agingTime The number of seconds an entry may stay without frames from its address
+		 */
+		inline void setAgingTime(uint32_t agingTime) { m_AgingTime = agingTime; }
+
+		/**
+		 * Get the table statistics
+		 * @param[out] stats The statistics
+		 */
+		void getStats(MacLearningTableStats& stats) const;
+
+	private:
+
+		struct Bucket
+		{
+			// 0 for free slots, otherwise a bit marking the key as used, the VLAN ID and the MAC address
+			volatile uint64_t keys[PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE];
+			// the time the address was last seen in the high 32 bits and the port + 1 in the low 16 bits, or 0 while the slot is removed
+			volatile uint64_t values[PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE];
+		};
+
+		uint8_t* m_Memory;
+		Bucket* m_Buckets;
+		size_t m_NumOfBuckets;
+		volatile uint32_t m_AgingTime;
+		size_t m_NumOfEntries;
+		MacLearningTableStats m_Stats;
+		mutable pthread_mutex_t m_Mutex;
+
+		static uint64_t makeKey(const uint8_t* mac, uint16_t vlanId);
+		Bucket* getBucket(uint64_t key) const;
+		uint16_t lookupKey(uint64_t key, uint32_t now) const;
+		void learnKey(uint64_t key, uint16_t port, uint32_t now);
+		void learnKeyLocked(uint64_t key, uint16_t port, uint32_t now);
+		bool isExpired(uint64_t value, uint32_t now) const;
+		void removeSlot(Bucket* bucket, int slot);
+		uint16_t switchParsed(const uint8_t* data, uint64_t srcKey, uint64_t dstKey, uint16_t inPort, uint32_t now);
+
+		// disable copy c'tor and assignment operator
+		MacLearningTable(const MacLearningTable& other);
+		MacLearningTable& operator=(const MacLearningTable& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_MAC_LEARNING_TABLE */
@@ -118,9 +118,13 @@ namespace pcpp
 
 		std::string toString();
 
+		void dump(PacketDumpWriter& writer);
+
         OsiModelLayer getOsiModelLayer() const { return OsiModelNetworkLayer; }
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(MplsLayer, MPLS);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_MPLS_LAYER */
@@ -0,0 +1,263 @@
+#ifndef PACKETPP_MULTI_PATTERN_MATCHER
+#define PACKETPP_MULTI_PATTERN_MATCHER
+
+#include "Layer.h"
+#include "TcpReassembly.h"
+#include <vector>
+#include <map>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @typedef OnPatternMatch
+	 * A callback invoked by MultiPatternMatcher for each pattern found in the scanned data
+	 * @param[in] patternId The ID the pattern was added with
+	 * @param[in] endOffset The offset right after the last byte of the match: from the beginning of the data for MultiPatternMatcher#scan(), and
+	 * from the beginning of the stream for MultiPatternMatcher#scanStream()
+	 * @param[in] userCookie A pointer to the object given by the user
+	 * @return True to continue scanning, false to stop
+	 */
+	typedef bool (*OnPatternMatch)(uint32_t patternId, uint64_t endOffset, void* userCookie);
+
+
+	/**
+	 * @struct PatternStreamState
+	 * The state of a stream scanned by MultiPatternMatcher#scanStream(): the automaton states and the number of bytes scanned. Keeping it
+	 * between calls lets matches which cross the boundary of two pieces of data (for example two TCP segments) be found. A state is tied to the
+	 * matcher which scanned it and becomes invalid when the matcher is compiled again
+	 */
+	struct PatternStreamState
+	{
+		/** The state of the case-sensitive automaton */
+		uint32_t caseSensitiveState;
+		/** The state of the caseless automaton */
+		uint32_t caselessState;
+		/** The number of bytes scanned so far */
+		uint64_t offset;
+
+		/**
+		 * A c'tor for this struct which creates the state of a stream which wasn't scanned yet
+		 */
+		PatternStreamState() : caseSensitiveState(0), caselessState(0), offset(0) {}
+
+		/**
+		 * Reset the state to the one of a stream which wasn't scanned yet
+		 */
+		void reset() { caseSensitiveState = 0; caselessState = 0; offset = 0; }
+	};
+
+
+	/**
+	 * @class MultiPatternMatcher
+	 * Finds all occurrences of a set of byte patterns (up to many thousands) in a single pass over the data. The patterns are compiled into
+	 * Aho-Corasick automata whose transitions are a dense table indexed by byte equivalence classes, so scanning costs one table lookup per
+	 * byte regardless of the number of patterns. While the automaton is in its initial state, the bytes which can't start a match are skipped
+	 * 16 at a time with SSSE3 nibble lookups (as in the Teddy algorithm) on x86 CPUs supporting them, which is most of the data when matches
+	 * are rare.<BR>
+	 * Case-sensitive and caseless patterns are kept in separate automata, so data containing both kinds is scanned twice.<BR>
+	 * Usage: add the patterns with addPattern(), call compile(), then scan packets with scan() or scanLayerPayload(), or streams with
+	 * scanStream() (see also TcpStreamPatternScanner). Scanning doesn't change the object, so a compiled matcher may be shared by threads
+	 * which scan in parallel
+	 */
+	class MultiPatternMatcher
+	{
+	public:
+		/**
+		 * A c'tor for this class which creates a matcher without patterns
+		 */
+		MultiPatternMatcher();
+
+		/**
+		 * A d'tor for this class
+		 */
+		~MultiPatternMatcher();
+
+		/**
+		 * Add a pattern. Patterns added after compile() are used only after compile() is called again
+		 * @param[in] pattern A pointer to the pattern bytes. They're copied
+		 * @param[in] patternLen The pattern length in bytes
+		 * @param[in] patternId The ID reported when the pattern is found. Several patterns may have the same ID
+		 * @param[in] caseless If true ASCII letters of the pattern match both upper and lower case letters. Default value is false
+		 * @return True if the pattern was added, false if it's empty
+		 */
+		bool addPattern(const uint8_t* pattern, size_t patternLen, uint32_t patternId, bool caseless = false);
+
+		/**
+		 * Add a pattern, see the other addPattern()
+		 * @param[in] pattern The pattern
+		 * @param[in] patternId The ID reported when the pattern is found
+		 * @param[in] caseless If true ASCII letters of the pattern match both upper and lower case letters. Default value is false
+		 * @return True if the pattern was added, false if it's empty
+		 */
+		bool addPattern(const std::string& pattern, uint32_t patternId, bool caseless = false);
+
+		/**
+		 * Remove all patterns and free the compiled automata
+		 */
+		void clear();
+
+		/**
+		 * Compile the patterns added so far into automata. States of streams scanned before become invalid
+		 * @return True if the patterns were compiled, false if there are no patterns or the automata are too large
+		 */
+		bool compile();
+
+		/**
+		 * @return True if the patterns were compiled and no pattern was added since
+		 */
+		inline bool isCompiled() const { return m_Compiled; }
+
+		/**
+		 * @return The number of patterns added
+		 */
+		inline size_t getNumOfPatterns() const { return m_Patterns.size(); }
+
+		/**
+		 * @return The number of states of the compiled automata
+		 */
+		size_t getNumOfStates() const;
+
+		/**
+		 * Find the patterns in a buffer
+		 * @param[in] data A pointer to the data
+		 * @param[in] dataLen The data length in bytes
+		 * @param[in] onMatch A callback invoked for each match, in the order of the match end offsets within each automaton. May be NULL
+		 * to only count the matches
+		 * @param[in] userCookie A pointer to an object passed to the callback
+		 * @return The number of matches found
+		 */
+		size_t scan(const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie = NULL) const;
+
+		/**
+		 * Find the patterns in the payload of a layer (see Layer#getLayerPayload())
+		 * @param[in] layer The layer
+		 * @param[in] onMatch A callback invoked for each match. May be NULL to only count the matches
+		 * @param[in] userCookie A pointer to an object passed to the callback
+		 * @return The number of matches found
+		 */
+		size_t scanLayerPayload(Layer* layer, OnPatternMatch onMatch, void* userCookie = NULL) const;
+
+		/**
+		 * Find the patterns in the next piece of a stream, including matches which started in previous pieces
+		 * @param[in,out] state The state of the stream, updated to continue from the end of this piece
+		 * @param[in] data A pointer to the data of the piece
+		 * @param[in] dataLen The data length in bytes
+		 * @param[in] onMatch A callback invoked for each match. Match offsets are from the beginning of the stream. May be NULL to only count
+		 * the matches
+		 * @param[in] userCookie A pointer to an object passed to the callback
+		 * @return The number of matches found. If the callback stops the scan, the next piece is scanned as if no bytes preceded it, but
+		 * offsets keep counting from the end of this piece
+		 */
+		size_t scanStream(PatternStreamState& state, const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie = NULL) const;
+
+	private:
+		class Automaton;
+
+		struct Pattern
+		{
+			std::string bytes;
+			uint32_t id;
+			bool caseless;
+		};
+
+		std::vector<Pattern> m_Patterns;
+		Automaton* m_CaseSensitiveAutomaton;
+		Automaton* m_CaselessAutomaton;
+		bool m_Compiled;
+
+		void freeAutomata();
+
+		// disable copy c'tor and assignment operator
+		MultiPatternMatcher(const MultiPatternMatcher& other);
+		MultiPatternMatcher& operator=(const MultiPatternMatcher& other);
+	};
+
+
+	/**
+	 * @class TcpStreamPatternScanner
+	 * Scans the data TcpReassembly delivers with a MultiPatternMatcher, keeping a stream state for each side of each connection so matches
+	 * split between TCP segments are found. Call scan() from the TcpReassembly message ready callback and connectionEnded() from the connection
+	 * end callback. Data TcpReassembly reports as missing is scanned as it's delivered, so matches aren't found across the gap
+	 */
+	class TcpStreamPatternScanner
+	{
+	public:
+		/**
+		 * @typedef OnTcpPatternMatch
+		 * A callback invoked for each pattern found in a TCP stream
+		 * @param[in] patternId The ID of the pattern
+		 * @param[in] endOffset The offset right after the last byte of the match from the beginning of the stream of this side
+		 * @param[in] side The side of the connection the data was sent from (as in TcpReassembly callbacks)
+		 * @param[in] connectionData The connection
+		 * @param[in] userCookie A pointer to the object given by the user
+		 * @return True to continue scanning, false to stop scanning the current data
+		 */
+		typedef bool (*OnTcpPatternMatch)(uint32_t patternId, uint64_t endOffset, int side, const ConnectionData& connectionData, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] matcher The compiled matcher to scan with. It's not copied, so it must stay valid and not be recompiled while this object
+		 * is used
+		 * @param[in] onMatch A callback invoked for each match
+		 * @param[in] userCookie A pointer to an object passed to the callback. Default value is NULL
+		 */
+		TcpStreamPatternScanner(const MultiPatternMatcher& matcher, OnTcpPatternMatch onMatch, void* userCookie = NULL);
+
+		/**
+		 * Scan the next piece of data of a connection side
+		 * @param[in] side The side the data was sent from
+		 * @param[in] tcpData The data, as delivered by TcpReassembly
+		 * @return The number of matches found
+		 */
+		size_t scan(int side, const TcpStreamData& tcpData);
+
+		/**
+		 * Free the stream states of a connection. Should be called when the connection ends
+		 * @param[in] connectionData The connection
+		 */
+		void connectionEnded(const ConnectionData& connectionData);
+
+		/**
+		 * Free the stream states of all connections
+		 */
+		void clear();
+
+		/**
+		 * @return The number of connections whose stream states are kept
+		 */
+		inline size_t getNumOfConnections() const { return m_StreamStates.size(); }
+
+	private:
+		struct ConnectionStreamStates
+		{
+			PatternStreamState sides[2];
+		};
+
+		struct MatchContext
+		{
+			TcpStreamPatternScanner* scanner;
+			int side;
+			const ConnectionData* connectionData;
+		};
+
+		const MultiPatternMatcher& m_Matcher;
+		OnTcpPatternMatch m_OnMatch;
+		void* m_UserCookie;
+		std::map<uint32_t, ConnectionStreamStates> m_StreamStates;
+
+		static bool onStreamMatch(uint32_t patternId, uint64_t endOffset, void* userCookie);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_MULTI_PATTERN_MATCHER */
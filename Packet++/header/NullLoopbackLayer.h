@@ -84,9 +84,13 @@ namespace pcpp
 
 		std::string toString();
 
+		void dump(PacketDumpWriter& writer);
+
 		OsiModelLayer getOsiModelLayer() const { return OsiModelDataLinkLayer; }
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(NullLoopbackLayer, NULL_LOOPBACK);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_NULL_LOOPBACK_LAYER */
@@ -107,6 +107,8 @@ namespace pcpp
 
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(PPPoELayer, PPPoE);
+
 
 	/**
 	 * @class PPPoESessionLayer
@@ -163,6 +165,8 @@ namespace pcpp
 		virtual std::string toString();
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(PPPoESessionLayer, PPPoESession);
+
 
 
 	/**
@@ -386,6 +390,8 @@ namespace pcpp
 		std::string codeToString(PPPoECode code);
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(PPPoEDiscoveryLayer, PPPoEDiscovery);
+
 
 	// Copied from Wireshark: ppptypes.h
 
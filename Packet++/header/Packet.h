@@ -3,10 +3,16 @@
 
 #include "RawPacket.h"
 #include "Layer.h"
+#include "LayerArena.h"
 #include <vector>
 
 /// @file
 
+/**
+ * The number of entries in the packet's layer index, one entry for each bit in the protocol bitmask
+ */
+#define PCPP_PACKET_LAYER_INDEX_SIZE 64
+
 /**
  * \namespace pcpp
  * \brief The main namespace for the PcapPlusPlus lib
@@ -32,6 +38,16 @@ namespace pcpp
 		uint64_t m_ProtocolTypes;
 		size_t m_MaxPacketLen;
 		bool m_FreeRawPacket;
+		LayerArena* m_LayerArena;
+		bool m_OwnLayerArena;
+		// the first layer of each protocol in the packet, indexed by the protocol bit. An entry is valid only if its protocol bit
+		// is set in m_ProtocolTypes
+		Layer* m_LayerIndex[PCPP_PACKET_LAYER_INDEX_SIZE];
+		bool m_LazyParsing;
+		// in lazy parsing mode: the last parsed layer, whose next layer wasn't parsed yet. NULL if there is nothing left to parse
+		Layer* m_PendingLayer;
+		ProtocolType m_ParseUntil;
+		OsiModelLayer m_ParseUntilLayer;
 
 	public:
 
@@ -103,6 +119,24 @@ namespace pcpp
 		 */
 		Packet& operator=(const Packet& other);
 
+#if __cplusplus > 199711L || _MSC_VER >= 1800
+		/**
+		 * A move constructor for this class. The raw packet, the layers and the layer arena are taken from the other instance as they
+		 * are: no raw data is copied and the packet isn't parsed again (layers that weren't parsed yet in lazy parsing mode are parsed on
+		 * demand by this instance). Layers added by the user move as well and keep their ownership semantics. The other instance is left
+		 * empty, without a raw packet and without layers
+		 * @param[in] other The instance to move from
+		 */
+		Packet(Packet&& other);
+
+		/**
+		 * Move assignment operator for this class. It first frees all layers and the raw packet of this instance the same way the
+		 * copy assignment operator does, then moves the other instance to this instance the same way the move constructor works
+		 * @param[in] other The instance to move from
+		 */
+		Packet& operator=(Packet&& other);
+#endif
+
 		/**
 		 * Get a pointer to the Packet's RawPacket
 		 * @return A pointer to the Packet's RawPacket
@@ -111,7 +145,7 @@ namespace pcpp
 
 		/**
 		 * Set a RawPacket and re-construct all packet layers
-		 * @param[in] rawPacket Raw packet to set
+		 * @param[in] rawPacket Raw packet to set. If NULL, all layers are freed and the packet is left empty
 		 * @param[in] freeRawPacket A flag indicating if the destructor should also call the raw packet destructor or not
 		 * @param[in] parseUntil Parse the packet until it reaches this protocol. Can be useful for cases when you need to parse only up to a certain layer and want to avoid the
 		 * performance impact and memory consumption of parsing the whole packet. Default value is ::UnknownProtocol which means don't take this parameter into account
@@ -120,6 +154,75 @@ namespace pcpp
 		 */
 		void setRawPacket(RawPacket* rawPacket, bool freeRawPacket, ProtocolType parseUntil = UnknownProtocol, OsiModelLayer parseUntilLayer = OsiModelLayerUnknown);
 
+		/**
+		 * Reserve headroom in the raw packet buffer (see RawPacket#reserveHeadroom()). Once the raw packet has headroom, insertLayer() and
+		 * layer extensions that add data close to the beginning of the packet (for example pushing an encapsulation header in front of
+		 * the existing layers) use it instead of shifting the rest of the packet and re-allocating the buffer, and removeLayer() returns the
+		 * space of layers removed from the beginning of the packet to the headroom. If the buffer doesn't have enough headroom the packet data
+		 * is copied once to a new buffer
+		 * @param[in] headroom The number of bytes to reserve before the packet data
+		 * @return True if the headroom was reserved successfully, false otherwise (an error will be printed to log)
+		 */
+		bool reserveHeadroom(size_t headroom);
+
+		/**
+		 * Create a copy of the packet which shares its raw data instead of copying it (see RawPacket#shareRawData()), for handing the same
+		 * packet to several consumers which keep it or change it. The copy is parsed lazily (see setLazyParsing()) from the raw data with
+		 * the same parseUntil limits, so creating it costs a few allocations and no parsing, and only the layers a consumer looks at are
+		 * parsed. The raw data is copy-on-write: methods which change the packet structure (insertLayer(), removeLayer(), extending or
+		 * shortening a layer, reserveHeadroom()) copy the raw data first if it's shared, so neither the packet nor its clones see the
+		 * change. Fields changed directly in a layer (through a header pointer or a setter) aren't tracked, so unshareRawData() should be
+		 * called before changing them, on the original packet as well as on a clone.<BR>
+		 * If the raw packet doesn't own its data (for example it was captured into a buffer of the capture engine) the data is copied once
+		 * to a buffer owned by the raw packet, and the clones share that buffer. Raw packets of derived classes (such as MBufRawPacket) are
+		 * copied. The clone is independent of this packet and can be freed before or after it
+		 * @return A new packet which should be freed by the user, or NULL if the packet has no raw data or the data couldn't be shared
+		 */
+		Packet* clone();
+
+		/**
+		 * If the raw data is shared with clones of this packet (see clone()), copy it to a buffer owned by this packet so its layers can
+		 * be changed without affecting the clones. The layers stay valid
+		 * @return True if the raw data isn't shared (anymore), false if it couldn't be copied
+		 */
+		bool unshareRawData();
+
+		/**
+		 * Set a layer arena to be used for allocating the layers created while parsing the packet. When an arena is set, layers
+		 * created in setRawPacket() (and in the c'tors that parse a RawPacket) are placement-constructed into the arena instead of being
+		 * allocated one by one on the heap. The arena is rewound automatically when these layers are freed, so the same arena can be
+		 * reused across setRawPacket() calls without any heap allocations. Ownership semantics of layers don't change: layers created by
+		 * the packet are still freed by it and layers added by the user are not. If the arena runs out of space layers are allocated
+		 * on the heap as usual. Please notice the arena is used only for layers created after this method is called
+		 * @param[in] arena A pointer to the arena to use or NULL to stop using an arena
+		 * @param[in] ownArena A flag indicating whether the packet should free the arena when it's destructed or when another
+		 * arena is set. If false, it's the user's responsibility to keep the arena alive as long as layers allocated from it exist.
+		 * Default value is false
+		 */
+		void setLayerArena(LayerArena* arena, bool ownArena = false);
+
+		/**
+		 * @return A pointer to the layer arena used by this packet or NULL if no arena was set
+		 */
+		inline LayerArena* getLayerArena() const { return m_LayerArena; }
+
+		/**
+		 * Set lazy parsing mode. In this mode setRawPacket() parses only the first layer of the packet, and the rest of the layers are
+		 * parsed on demand when they're reached: when Layer#getNextLayer() is called on the last parsed layer, or when the packet is
+		 * searched for a protocol that wasn't parsed yet (using getLayerOfType(), isPacketOfType(), etc.). The protocol bitmask is filled
+		 * incrementally as layers are parsed. Methods that need all layers (such as getLastLayer(), toString(), computeCalculateFields() or
+		 * methods that add, remove or change the size of layers) parse the rest of the packet first. This mode can save a lot of parsing
+		 * for applications that look only at the lower layers of most packets. The parseUntil and parseUntilLayer limits given to
+		 * setRawPacket() are kept in this mode as well. Please notice the mode affects only subsequent calls to setRawPacket()
+		 * @param[in] lazyParsing True to turn lazy parsing mode on, false to turn it off
+		 */
+		inline void setLazyParsing(bool lazyParsing) { m_LazyParsing = lazyParsing; }
+
+		/**
+		 * @return True if lazy parsing mode is on (see setLazyParsing()), false otherwise
+		 */
+		inline bool isLazyParsing() const { return m_LazyParsing; }
+
 		/**
 		 * Get a pointer to the Packet's RawPacket in a read-only manner
 		 * @return A pointer to the Packet's RawPacket
@@ -136,7 +239,7 @@ namespace pcpp
 		 * Get a pointer to the last (highest) layer in the packet
 		 * @return A pointer to the last (highest) layer in the packet
 		 */
-		inline Layer* getLastLayer() { return m_LastLayer; }
+		inline Layer* getLastLayer() { if (m_PendingLayer != NULL) parseRemainingLayers(); return m_LastLayer; }
 
 		/**
 		 * Add a new layer as the last layer in the packet. This method gets a pointer to the new layer as a parameter
@@ -234,7 +337,7 @@ namespace pcpp
 
 		/**
 		 * Get a pointer to the layer of a certain type (protocol). This method goes through the layers and returns a layer
-		 * that matches the give protocol type
+		 * that matches the give protocol type. The first layer of each protocol is fetched in O(1) without going through the layers
 		 * @param[in] layerType The layer type (protocol) to fetch
 		 * @param[in] index If there are multiple layers of the same type, indicate which instance to fetch. The default
 		 * value is 0, meaning fetch the first layer of this type
@@ -243,7 +346,9 @@ namespace pcpp
 		Layer* getLayerOfType(ProtocolType layerType, int index = 0);
 
 		/**
-		 * A templated method to get a layer of a certain type (protocol). If no layer of such type is found, NULL is returned
+		 * A templated method to get a layer of a certain type (protocol). If no layer of such type is found, NULL is returned.
+		 * For layer classes that declare their protocols (see LayerProtocolTraits) the layer is found by its protocol without
+		 * using dynamic_cast, and for classes of a single protocol it's fetched in O(1) from the packet's layer index
 		 * @return A pointer to the layer of the requested type, NULL if not found
 		 */
 		template<class TLayer>
@@ -265,13 +370,18 @@ namespace pcpp
 		 * @param[in] protocolType The protocol type to search
 		 * @return True if the packet contains the protocol, false otherwise
 		 */
-		inline bool isPacketOfType(ProtocolType protocolType) { return m_ProtocolTypes & protocolType; }
+		inline bool isPacketOfType(ProtocolType protocolType) { return containsProtocol(protocolType); }
 
 		/**
 		 * Each layer can have fields that can be calculate automatically from other fields using Layer#computeCalculateFields(). This method forces all layers to calculate these
 		 * fields values
+		 * @param[in] onlyModifiedLayers If set to true only the layers which need it are computed: the modified layers (see Layer#isModified())
+		 * and the layers preceding them, whose lengths and checksums cover them. For example after changing the MAC addresses and the IPv4 TTL
+		 * of a forwarded packet only the Ethernet and IPv4 layers are computed, and the TCP checksum isn't computed again over the payload.
+		 * Please notice changes made directly through header pointers must be marked with Layer#setModified(). Default value is false,
+		 * which means all layers are computed. Either way all layers are unmarked afterwards
 		 */
-		void computeCalculateFields();
+		void computeCalculateFields(bool onlyModifiedLayers = false);
 
 		/**
 		 * Each layer can print a string representation of the layer most important data using Layer#toString(). This method aggregates this string from all layers and
@@ -291,13 +401,56 @@ namespace pcpp
 	private:
 		void copyDataFrom(const Packet& other);
 
+		void moveDataFrom(Packet& other);
+
 		void destructPacketData();
 
+		void releaseLayerArena();
+
+		void registerLayerProtocol(Layer* layer);
+
+		void updateLayerIndex(ProtocolType protocol);
+
+		bool acceptParsedLayer(Layer* layer);
+
+		void parsePendingLayer();
+
+		void parseRemainingLayers();
+
+		bool parseUntilProtocolFound(uint64_t protocolMask);
+
+		inline bool containsProtocol(uint64_t protocolMask)
+		{
+			return (m_ProtocolTypes & protocolMask) != 0 || (m_PendingLayer != NULL && parseUntilProtocolFound(protocolMask));
+		}
+
+		static inline bool isSingleProtocol(uint64_t protocolMask) { return protocolMask != 0 && (protocolMask & (protocolMask - 1)) == 0; }
+
+		static inline int getProtocolIndex(uint64_t protocol)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_ctzll(protocol);
+#else
+			int index = 0;
+			while ((protocol & 1) == 0)
+			{
+				protocol >>= 1;
+				index++;
+			}
+			return index;
+#endif
+		}
+
 		bool extendLayer(Layer* layer, int offsetInLayer, size_t numOfBytesToExtend);
 		bool shortenLayer(Layer* layer, int offsetInLayer, size_t numOfBytesToShorten);
 
 		void reallocateRawData(size_t newSize);
 
+		// point the layers to the raw data after it was moved from the given buffer
+		void rebaseLayers(const uint8_t* prevRawData);
+
+		void updateMaxPacketLen(size_t prevHeadroom);
+
 		bool removeLayer(Layer* layer, bool tryToDelete);
 
 		std::string printPacketInfo(bool timeAsLocalTime);
@@ -308,6 +461,23 @@ namespace pcpp
 	template<class TLayer>
 	TLayer* Packet::getLayerOfType()
 	{
+		const uint64_t protocolMask = LayerProtocolTraits<TLayer>::ProtocolMask;
+
+		if (protocolMask != UnknownProtocol)
+		{
+			if (!containsProtocol(protocolMask))
+				return NULL;
+
+			if (isSingleProtocol(protocolMask))
+				return (TLayer*)m_LayerIndex[getProtocolIndex(protocolMask)];
+
+			Layer* curLayer = m_FirstLayer;
+			while ((curLayer != NULL) && ((curLayer->getProtocol() & protocolMask) == 0))
+				curLayer = curLayer->getNextLayer();
+
+			return (TLayer*)curLayer;
+		}
+
 		if (dynamic_cast<TLayer*>(m_FirstLayer) != NULL)
 			return (TLayer*)m_FirstLayer;
 
@@ -320,7 +490,18 @@ namespace pcpp
 		if (after == NULL)
 			return NULL;
 
+		const uint64_t protocolMask = LayerProtocolTraits<TLayer>::ProtocolMask;
+
 		Layer* curLayer = after->getNextLayer();
+
+		if (protocolMask != UnknownProtocol)
+		{
+			while ((curLayer != NULL) && ((curLayer->getProtocol() & protocolMask) == 0))
+				curLayer = curLayer->getNextLayer();
+
+			return (TLayer*)curLayer;
+		}
+
 		while ((curLayer != NULL) && (dynamic_cast<TLayer*>(curLayer) == NULL))
 		{
 			curLayer = curLayer->getNextLayer();
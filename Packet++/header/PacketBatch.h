@@ -0,0 +1,148 @@
+#ifndef PACKETPP_PACKET_BATCH
+#define PACKETPP_PACKET_BATCH
+
+#include "Packet.h"
+#include "LayerArena.h"
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class PacketBatch
+	 * A reusable container for parsing bursts of raw packets (such as the ones received from DPDK, PF_RING or pcap devices) in one pass.
+	 * The batch holds a pre-allocated Packet instance per slot, each one with its own LayerArena, so parsing a burst doesn't involve any
+	 * heap allocations once the batch was created. While parsing, the following per-packet data is laid out in structure-of-arrays form
+	 * (one array per property, indexed by the packet position in the batch) so filtering and classification stages can scan it with good
+	 * cache behavior before looking at the packets themselves:
+	 * - The protocol bitmask of the layers parsed so far (see getProtocolTypes())
+	 * - The offset of the first IPv4/IPv6 header in the raw data (see getNetworkLayerOffsets())
+	 * - The offset of the first TCP/UDP header in the raw data (see getTransportLayerOffsets())
+	 *
+	 * Packets are parsed only up to a certain OSI model layer (the transport layer by default). The rest of the layers are parsed lazily
+	 * (see Packet#setLazyParsing()) only if the full packet is accessed using getPacket(). Please notice the batch doesn't own the raw
+	 * packets, so they should be kept alive as long as the packets in the batch are used, meaning until the next call to parse() or clear()
+	 */
+	class PacketBatch
+	{
+	public:
+
+		/**
+		 * An offset value indicating the packet doesn't contain the requested header
+		 */
+		static const uint16_t NoOffset = 0xffff;
+
+		/**
+		 * The default number of packets parse() prefetches ahead of the packet being parsed
+		 */
+		static const size_t DefaultPrefetchDistance = 4;
+
+		/**
+		 * A c'tor for this class. Pre-allocates all packets and layer storage
+		 * @param[in] capacity The maximum number of packets the batch can hold
+		 * @param[in] layerArenaSize The size in bytes of the layer arena allocated for each packet. Default value is
+		 * LayerArena#DefaultArenaSize
+		 */
+		PacketBatch(size_t capacity, size_t layerArenaSize = LayerArena::DefaultArenaSize);
+
+		/**
+		 * A d'tor for this class. Frees all packets and layers. Raw packets aren't freed
+		 */
+		~PacketBatch();
+
+		/**
+		 * Parse an array of raw packets into the batch. Packets that were parsed in the previous call are freed first (and their layer storage
+		 * is reused)
+		 * @param[in] rawPackets An array of pointers to raw packets
+		 * @param[in] count The number of raw packets in the array
+		 * @param[in] scanUntilLayer Each packet is parsed until a layer of this OSI model layer (or above) is reached. The rest of the
+		 * layers are parsed only if the packet is accessed using getPacket(). Default value is ::OsiModelTransportLayer. Use
+		 * ::OsiModelLayerUnknown to parse packets completely
+		 * @return The number of packets parsed into the batch. It's smaller than count only if count exceeds the batch capacity
+		 */
+		size_t parse(RawPacket** rawPackets, size_t count, OsiModelLayer scanUntilLayer = OsiModelTransportLayer);
+
+		/**
+		 * Set how many packets ahead of the packet being parsed parse() prefetches. The raw packet of the packet which is twice that
+		 * distance ahead is prefetched too, so its data pointer is in cache when the data is prefetched. The distance should cover the
+		 * memory latency: too short and the packet data isn't in cache yet when it's parsed, too long and it's evicted before
+		 * @param[in] prefetchDistance The number of packets to prefetch ahead, or 0 to disable prefetching
+		 */
+		inline void setPrefetchDistance(size_t prefetchDistance) { m_PrefetchDistance = prefetchDistance; }
+
+		/**
+		 * @return The number of packets parse() prefetches ahead. Default value is #DefaultPrefetchDistance
+		 */
+		inline size_t getPrefetchDistance() const { return m_PrefetchDistance; }
+
+		/**
+		 * Free all packets parsed into the batch. The batch capacity and layer storage are kept for the next call to parse()
+		 */
+		void clear();
+
+		/**
+		 * @return The maximum number of packets the batch can hold
+		 */
+		inline size_t getCapacity() const { return m_Capacity; }
+
+		/**
+		 * @return The number of packets currently in the batch
+		 */
+		inline size_t getCount() const { return m_Count; }
+
+		/**
+		 * @return An array of getCount() elements containing the protocol bitmask (ProtocolType values) of each packet. The bitmask
+		 * contains the protocols of the layers parsed by parse(), meaning the layers up to the requested OSI model layer
+		 */
+		inline const uint64_t* getProtocolTypes() const { return m_ProtocolTypes.empty() ? NULL : &m_ProtocolTypes[0]; }
+
+		/**
+		 * @return An array of getCount() elements containing the offset in bytes of the first IPv4 or IPv6 header in each packet's raw data,
+		 * or #NoOffset if there is no such header
+		 */
+		inline const uint16_t* getNetworkLayerOffsets() const { return m_NetworkLayerOffsets.empty() ? NULL : &m_NetworkLayerOffsets[0]; }
+
+		/**
+		 * @return An array of getCount() elements containing the offset in bytes of the first TCP or UDP header in each packet's raw data,
+		 * or #NoOffset if there is no such header
+		 */
+		inline const uint16_t* getTransportLayerOffsets() const { return m_TransportLayerOffsets.empty() ? NULL : &m_TransportLayerOffsets[0]; }
+
+		/**
+		 * Get the full Packet view of a packet in the batch. Layers above the layers parsed by parse() are parsed on demand when they're reached
+		 * @param[in] index The packet index in the batch
+		 * @return A pointer to the packet, or NULL if index is out of range. The packet is owned by the batch and is valid until the next
+		 * call to parse() or clear()
+		 */
+		Packet* getPacket(size_t index);
+
+		/**
+		 * @return The raw packet of a packet in the batch, or NULL if index is out of range
+		 */
+		RawPacket* getRawPacket(size_t index);
+
+	private:
+		size_t m_Capacity;
+		size_t m_Count;
+		size_t m_PrefetchDistance;
+		Packet* m_Packets;
+		std::vector<uint64_t> m_ProtocolTypes;
+		std::vector<uint16_t> m_NetworkLayerOffsets;
+		std::vector<uint16_t> m_TransportLayerOffsets;
+
+		void scanPacket(size_t index, OsiModelLayer scanUntilLayer);
+
+		// disable copy c'tor and assignment operator
+		PacketBatch(const PacketBatch& other);
+		PacketBatch& operator=(const PacketBatch& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_PACKET_BATCH */
@@ -0,0 +1,178 @@
+#ifndef PACKETPP_PACKET_DEDUPLICATOR
+#define PACKETPP_PACKET_DEDUPLICATOR
+
+#include "FlowTable.h"
+#include "RawPacket.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct PacketDeduplicatorConfiguration
+	 * The configuration of a PacketDeduplicator
+	 */
+	struct PacketDeduplicatorConfiguration
+	{
+		/**
+		 * The time window in microseconds: a packet is a duplicate if an identical packet was seen up to this long before it. Copies of a
+		 * packet captured on several taps usually arrive within microseconds of each other, while a longer window also catches
+		 * retransmissions, which aren't duplicates
+		 */
+		uint32_t windowUs;
+
+		/**
+		 * The maximum number of packets remembered. When it's reached the packet seen first is forgotten, so the memory is bounded even when
+		 * the window holds more packets. 0 means no limit
+		 */
+		size_t maxEntries;
+
+		/**
+		 * The number of bytes following the IP header which are part of the packet identity, besides the IP header itself. Longer prefixes
+		 * tell apart more packets which only differ in their payload, at the cost of hashing more bytes
+		 */
+		size_t payloadPrefixLength;
+
+		/**
+		 * An optional budget the memory of the remembered packets is charged to, shared with other components as in
+		 * FlowTableConfiguration#memoryBudget. NULL means the memory is limited only by #maxEntries
+		 */
+		MemoryBudget* memoryBudget;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] windowUs The time window in microseconds. Default value is 50000 (50 milliseconds)
+		 * @param[in] maxEntries The maximum number of packets remembered, or 0 for no limit. Default value is 1000000
+		 * @param[in] payloadPrefixLength The number of bytes following the IP header which are hashed. Default value is 64
+		 * @param[in] memoryBudget An optional budget to charge the memory of the remembered packets to. Default value is NULL
+		 */
+		PacketDeduplicatorConfiguration(uint32_t windowUs = 50000, size_t maxEntries = 1000000, size_t payloadPrefixLength = 64,
+				MemoryBudget* memoryBudget = NULL) :
+			windowUs(windowUs), maxEntries(maxEntries), payloadPrefixLength(payloadPrefixLength), memoryBudget(memoryBudget) {}
+	};
+
+
+	/**
+	 * @struct PacketDeduplicatorStats
+	 * The statistics of a PacketDeduplicator
+	 */
+	struct PacketDeduplicatorStats
+	{
+		/** Number of packets checked */
+		uint64_t packets;
+		/** Number of packets found to be duplicates */
+		uint64_t duplicates;
+		/** Number of packets checked which don't contain an IPv4 or IPv6 header, and were identified by all of their bytes */
+		uint64_t nonIpPackets;
+		/** Number of packets forgotten before their window ended because of PacketDeduplicatorConfiguration#maxEntries or the memory budget */
+		uint64_t evictions;
+	};
+
+
+	/**
+	 * @class PacketDeduplicator
+	 * Drops the copies of a packet which was captured more than once, for example on several taps or on both directions of a SPAN port, so
+	 * TcpReassembly and other stateful components further down don't have to process each packet several times.<BR>
+	 * Each packet is identified by a 64-bit hash of the fields which don't change on the way between capture points: the IP header with
+	 * the TTL (hop limit) and the header checksum left out, and the first bytes following it (see
+	 * PacketDeduplicatorConfiguration#payloadPrefixLength). Layer 2 headers (MAC addresses, VLAN tags, MPLS labels) aren't part of the
+	 * identity, since they differ between capture points. Packets without an IP header are identified by all of their bytes.<BR>
+	 * The hashes of the packets seen in the last PacketDeduplicatorConfiguration#windowUs microseconds are kept in a FlowTable with a bounded
+	 * number of entries, so checking a packet doesn't allocate memory once the table reached its size. Time is taken from the packet
+	 * timestamps, so a deduplicator works the same on live traffic and on capture files, but the sources should be timestamped by the same
+	 * clock. A deduplicator can be used with any source of RawPacket objects: call isDuplicate() for each packet read from a file or live
+	 * device, or filterBurst() for a burst of packets received from DpdkDevice or another burst API.<BR>
+	 * A deduplicator isn't thread-safe. To deduplicate on several threads, make sure all copies of a packet reach the same thread, for
+	 * example by distributing packets with a symmetric flow hash (see FlowHash#hashSymmetric())
+	 */
+	class PacketDeduplicator
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The configuration of the deduplicator. Default is a 50 milliseconds window of up to 1000000 packets
+		 */
+		PacketDeduplicator(const PacketDeduplicatorConfiguration& config = PacketDeduplicatorConfiguration());
+
+		/**
+		 * Check whether a raw packet is a duplicate of a packet seen within the window, and remember it if it isn't. Its timestamp is used
+		 * as the current time
+		 * @param[in] rawPacket The packet. The link layer type is taken from RawPacket#getLinkLayerType()
+		 * @return True if the packet is a duplicate, false otherwise
+		 */
+		bool isDuplicate(const RawPacket* rawPacket);
+
+		/**
+		 * Check whether a packet given as raw data is a duplicate of a packet seen within the window, and remember it if it isn't
+		 * @param[in] data A pointer to the raw data
+		 * @param[in] dataLen The raw data length in bytes
+		 * @param[in] linkType The link layer type of the raw data, as in FlowKeyExtractor#extract()
+		 * @param[in] timestampUs The timestamp of the packet in microseconds
+		 * @return True if the packet is a duplicate, false otherwise
+		 */
+		bool isDuplicate(const uint8_t* data, size_t dataLen, LinkLayerType linkType, uint64_t timestampUs);
+
+		/**
+		 * Check a burst of packets and reorder it so the packets which aren't duplicates come first, in their original order, followed by
+		 * the duplicates. This suits burst APIs such as DpdkDevice#receivePackets(), whose duplicate packets still need to be freed
+		 * @param[in,out] packets The packets
+		 * @param[in] numOfPackets The number of packets
+		 * @return The number of packets which aren't duplicates, which are now packets[0] to packets[return value - 1]
+		 */
+		int filterBurst(RawPacket** packets, int numOfPackets);
+
+		/**
+		 * Calculate the hash a deduplicator identifies a packet by
+		 * @param[in] data A pointer to the raw data
+		 * @param[in] dataLen The raw data length in bytes
+		 * @param[in] linkType The link layer type of the raw data
+		 * @param[in] payloadPrefixLength The number of bytes following the IP header which are hashed
+		 * @param[out] isIP An optional pointer which is set to true if the packet contains an IPv4 or IPv6 header. Default value is NULL
+		 * @return The hash value
+		 */
+		static uint64_t hashPacket(const uint8_t* data, size_t dataLen, LinkLayerType linkType, size_t payloadPrefixLength, bool* isIP = NULL);
+
+		/**
+		 * Forget all packets seen so far. The statistics are kept
+		 */
+		void clear();
+
+		/**
+		 * @return The number of packets currently remembered
+		 */
+		inline size_t getNumOfEntries() const { return m_Table.size(); }
+
+		/**
+		 * @return The configuration of the deduplicator
+		 */
+		inline const PacketDeduplicatorConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * Get the deduplicator statistics
+		 * @param[out] stats The statistics
+		 */
+		void getStats(PacketDeduplicatorStats& stats) const;
+
+	private:
+
+		PacketDeduplicatorConfiguration m_Config;
+		// the packet hash mapped to the time in microseconds the packet was first seen
+		FlowTable<uint64_t, uint64_t> m_Table;
+		PacketDeduplicatorStats m_Stats;
+
+		// disable copy c'tor and assignment operator
+		PacketDeduplicator(const PacketDeduplicator& other);
+		PacketDeduplicator& operator=(const PacketDeduplicator& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_PACKET_DEDUPLICATOR */
@@ -0,0 +1,229 @@
+#ifndef PACKETPP_PACKET_DUMP_WRITER
+#define PACKETPP_PACKET_DUMP_WRITER
+
+#include "ProtocolType.h"
+#include <stdint.h>
+#include <string>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	class Packet;
+	class Layer;
+	class IPAddress;
+	class MacAddress;
+
+	/**
+	 * @class PacketDumpWriter
+	 * Writes packets and their layers into a growable buffer supplied by the caller, as human readable text or as JSON lines. Numbers and
+	 * addresses are formatted directly into the buffer, so once the buffer has grown to the size of a packet's output, dumping more
+	 * packets doesn't allocate memory. This is much faster than Packet#toString(), which builds a string per field and per layer:
+	 *
+	 *     std::string buffer;
+	 *     PacketDumpWriter writer(buffer, PacketDumpWriter::JsonLinesFormat);
+	 *     while (reader.getNextPacket(rawPacket))
+	 *     {
+	 *         Packet packet(&rawPacket);
+	 *         writer.writePacket(packet);
+	 *         if (buffer.size() > 64 * 1024)
+	 *         {
+	 *             fwrite(buffer.data(), 1, buffer.size(), outFile);
+	 *             buffer.clear();
+	 *         }
+	 *     }
+	 *
+	 * The text format is the same as Packet#toString(): a line with the packet length and arrival time followed by a line per layer. The
+	 * JSON lines format writes a JSON object per packet on a line of its own, with an array of the layers and their fields.<BR>
+	 * Layers write themselves through Layer#dump(), using the begin/add methods of this class. Every field has a text key and a JSON key,
+	 * and a NULL key leaves the field out of that format. Layers which don't implement dump() are written from their toString(), which
+	 * JSON lines holds as a "summary" string
+	 */
+	class PacketDumpWriter
+	{
+	public:
+
+		/**
+		 * The output formats
+		 */
+		enum Format
+		{
+			/** Human readable text, the same as Packet#toString() */
+			TextFormat,
+			/** A JSON object per packet, each on a line of its own */
+			JsonLinesFormat
+		};
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] buffer The buffer output is appended to. It's never cleared by the writer
+		 * @param[in] format The output format. Default is TextFormat
+		 */
+		PacketDumpWriter(std::string& buffer, Format format = TextFormat);
+
+		/**
+		 * @return The output format
+		 */
+		inline Format getFormat() const { return m_Format; }
+
+		/**
+		 * @return The buffer output is appended to
+		 */
+		inline std::string& getBuffer() { return m_Buffer; }
+
+		/**
+		 * Set a string written at the beginning of every text line, for example to indent the layers of a report. It's ignored in JSON lines
+		 * format
+		 * @param[in] indent The string, which must remain valid while the writer is used. NULL or an empty string for no indentation
+		 */
+		inline void setIndent(const char* indent) { m_Indent = indent; }
+
+		/**
+		 * Set whether the arrival time in text format is printed as local time or GMT. Default is local time, like Packet#toString()
+		 * @param[in] timeAsLocalTime True for local time, false for GMT
+		 */
+		inline void setTimeAsLocalTime(bool timeAsLocalTime) { m_TimeAsLocalTime = timeAsLocalTime; }
+
+		/**
+		 * Write a packet: a line with its length and arrival time followed by a line per layer in text format, or a JSON object and a new
+		 * line in JSON lines format. All layers of the packet are parsed
+		 * @param[in] packet The packet to write
+		 */
+		void writePacket(Packet& packet);
+
+		/**
+		 * Write a single layer: a line in text format (terminated by a new line) or a JSON object (without a new line) in JSON lines format
+		 * @param[in] layer The layer to write
+		 */
+		void writeLayer(Layer& layer);
+
+		/**
+		 * Render a layer as the text of its toString() without a new line. Layers which implement dump() use it for their toString()
+		 * @param[in] layer The layer
+		 * @return The text of the layer
+		 */
+		static std::string layerToString(Layer& layer);
+
+		// methods used by Layer#dump() implementations
+
+		/**
+		 * Begin writing a layer
+		 * @param[in] textTitle The text the layer's line starts with, for example "Ethernet II Layer"
+		 * @param[in] protocol The protocol of the layer, whose name is written as the "layer" value of its JSON object
+		 */
+		void beginLayer(const char* textTitle, ProtocolType protocol);
+
+		/**
+		 * End writing a layer
+		 */
+		void endLayer();
+
+		/**
+		 * Write a layer from a summary string, which is how layers that don't implement dump() are written
+		 * @param[in] summary The summary, usually the layer's toString()
+		 * @param[in] protocol The protocol of the layer
+		 */
+		void addLayerSummary(const std::string& summary, ProtocolType protocol);
+
+		/**
+		 * Add a number field, written as "textKey: value" in text format
+		 * @param[in] textKey The key in text format, or NULL to leave the field out of the text
+		 * @param[in] jsonKey The key in JSON lines format, or NULL to leave the field out of the JSON object
+		 * @param[in] value The value
+		 */
+		void addNumber(const char* textKey, const char* jsonKey, uint64_t value);
+
+		/**
+		 * Add a string field
+		 * @param[in] textKey The key in text format, or NULL to leave the field out of the text
+		 * @param[in] jsonKey The key in JSON lines format, or NULL to leave the field out of the JSON object
+		 * @param[in] value The value, a null-terminated string. It's escaped in JSON lines format
+		 */
+		void addString(const char* textKey, const char* jsonKey, const char* value);
+
+		/**
+		 * Add a boolean field, written as true or false
+		 * @param[in] textKey The key in text format, or NULL to leave the field out of the text
+		 * @param[in] jsonKey The key in JSON lines format, or NULL to leave the field out of the JSON object
+		 * @param[in] value The value
+		 */
+		void addBool(const char* textKey, const char* jsonKey, bool value);
+
+		/**
+		 * Add an IPv4 or IPv6 address field
+		 * @param[in] textKey The key in text format, or NULL to leave the field out of the text
+		 * @param[in] jsonKey The key in JSON lines format, or NULL to leave the field out of the JSON object
+		 * @param[in] value The address
+		 */
+		void addIPAddress(const char* textKey, const char* jsonKey, const IPAddress& value);
+
+		/**
+		 * Add a MAC address field
+		 * @param[in] textKey The key in text format, or NULL to leave the field out of the text
+		 * @param[in] jsonKey The key in JSON lines format, or NULL to leave the field out of the JSON object
+		 * @param[in] value The address
+		 */
+		void addMacAddress(const char* textKey, const char* jsonKey, const MacAddress& value);
+
+		/**
+		 * Add an item without a key to the text line of the layer, for example "[SYN, ACK]". It's ignored in JSON lines format
+		 * @param[in] text The text of the item
+		 */
+		void addText(const char* text);
+
+		/**
+		 * Append text to the last item of the text line. It's ignored in JSON lines format
+		 * @param[in] text The text to append
+		 */
+		void appendText(const char* text);
+
+		/**
+		 * Append a number to the last item of the text line. It's ignored in JSON lines format
+		 * @param[in] value The number to append
+		 */
+		void appendNumber(uint64_t value);
+
+		/**
+		 * Append an address to the last item of the text line. It's ignored in JSON lines format
+		 * @param[in] value The address to append
+		 */
+		void appendIPAddress(const IPAddress& value);
+
+		/**
+		 * Append a MAC address to the last item of the text line. It's ignored in JSON lines format
+		 * @param[in] value The address to append
+		 */
+		void appendMacAddress(const MacAddress& value);
+
+		/**
+		 * @param[in] protocol A protocol
+		 * @return The name of the protocol used in JSON lines format, for example "ipv4", or "unknown"
+		 */
+		static const char* getProtocolName(ProtocolType protocol);
+
+	private:
+		std::string& m_Buffer;
+		Format m_Format;
+		const char* m_Indent;
+		bool m_TimeAsLocalTime;
+		bool m_NewLineAfterLayer;
+		int m_NumOfLayersInPacket;
+
+		void beginField(const char* textKey, const char* jsonKey);
+		void writeNumber(uint64_t value);
+		void appendJsonString(const char* value);
+		void appendTimestamp(Packet& packet);
+
+		// disable copy c'tor and assignment operator
+		PacketDumpWriter(const PacketDumpWriter& other);
+		PacketDumpWriter& operator=(const PacketDumpWriter& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_PACKET_DUMP_WRITER */
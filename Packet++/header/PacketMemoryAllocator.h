@@ -0,0 +1,188 @@
+#ifndef PACKETPP_PACKET_MEMORY_ALLOCATOR
+#define PACKETPP_PACKET_MEMORY_ALLOCATOR
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <pthread.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class PacketMemoryAllocator
+	 * An interface for allocating the large blocks of memory packet buffers are carved out of: the slabs of RawPacketPool and the slabs and
+	 * RawPacket blocks of RawPacketSlabVector. Implementations decide where the memory comes from, for example HugePagePacketMemoryAllocator
+	 * which backs the blocks with huge pages. Since capture devices, file readers and IPReassembly copy packets into buffers of the
+	 * RawPacketPool attached to them, giving the pool an allocator moves all of their packet buffers to that memory.
+	 * The memory is requested a block at a time, so an implementation doesn't need to be fast, but it must be thread-safe if the pool using
+	 * it is shared between threads
+	 */
+	class PacketMemoryAllocator
+	{
+	public:
+
+		/**
+		 * A d'tor for this class
+		 */
+		virtual ~PacketMemoryAllocator() {}
+
+		/**
+		 * Allocate a block of memory
+		 * @param[in] size The block size in bytes
+		 * @return A pointer to a block of at least the requested size which is at least 16-byte aligned, or NULL if the memory can't be
+		 * allocated
+		 */
+		virtual uint8_t* allocate(size_t size) = 0;
+
+		/**
+		 * Free a block of memory
+		 * @param[in] memory A pointer to a block previously returned by allocate() of this allocator
+		 * @param[in] size The size the block was allocated with
+		 */
+		virtual void deallocate(uint8_t* memory, size_t size) = 0;
+
+		/**
+		 * @return The allocator used when no allocator is given, which allocates the blocks on the heap. Unlike other allocators it
+		 * never returns NULL, failing to allocate throws std::bad_alloc as operator new does
+		 */
+		static PacketMemoryAllocator* getHeapAllocator();
+	};
+
+
+	/**
+	 * An enum of the huge page sizes HugePagePacketMemoryAllocator can map
+	 */
+	enum HugePageSize
+	{
+		/** 2MB huge pages */
+		HugePage2MB,
+		/** 1GB huge pages */
+		HugePage1GB
+	};
+
+
+	/**
+	 * @class HugePagePacketMemoryAllocator
+	 * A PacketMemoryAllocator which backs packet memory with huge pages, so buffering gigabytes of packets doesn't thrash the TLB. Memory
+	 * is mapped in regions of whole huge pages and blocks are carved out of the current region one after the other; a block larger than
+	 * the region gets a mapping of its own. When all blocks carved out of a region are freed the region is unmapped, or reused from its
+	 * start if it's the current region. The regions can be bound to a NUMA node, which should be the node of the threads processing the
+	 * packets.<BR>
+	 * Huge pages must be reserved by the system administrator (for example in /sys/kernel/mm/hugepages). When a region can't be mapped
+	 * with huge pages, for example because none are left, the allocator transparently falls back to mapping it with regular pages and
+	 * asks the kernel to back it with transparent huge pages, unless the fallback is disabled. Mapping memory is implemented for Linux
+	 * only, on other platforms all regions are allocated on the heap through the fallback.
+	 * The allocator is thread-safe. Please notice it must outlive all memory allocated from it, as well as the pools and vectors using it
+	 */
+	class HugePagePacketMemoryAllocator : public PacketMemoryAllocator
+	{
+	public:
+
+		/**
+		 * The default size of the regions memory is mapped in when 2MB pages are used. With 1GB pages the default is a single page
+		 */
+		static const size_t DefaultRegionSize = 64 * 1024 * 1024;
+
+		/**
+		 * A c'tor for this class. No memory is mapped until the first block is allocated
+		 * @param[in] pageSize The size of the huge pages. Default value is HugePage2MB
+		 * @param[in] numaNode The NUMA node to allocate the memory on, or -1 for the node the kernel chooses. Default value is -1
+		 * @param[in] regionSize The size in bytes of the regions memory is mapped in. It's rounded up to whole pages. 0 means
+		 * DefaultRegionSize for 2MB pages and a single page for 1GB pages. Default value is 0
+		 * @param[in] allowFallback If set to true, regions which can't be mapped with huge pages are mapped with regular pages (preferring
+		 * the NUMA node instead of requiring it), otherwise allocate() returns NULL. Default value is true
+		 */
+		HugePagePacketMemoryAllocator(HugePageSize pageSize = HugePage2MB, int numaNode = -1, size_t regionSize = 0, bool allowFallback = true);
+
+		/**
+		 * A d'tor for this class. Unmaps all regions. Please notice all memory allocated from the allocator becomes invalid
+		 */
+		~HugePagePacketMemoryAllocator();
+
+		/**
+		 * @return The huge page size in bytes
+		 */
+		inline size_t getPageSize() const { return m_PageSize; }
+
+		/**
+		 * @return The NUMA node the memory is allocated on, or -1 if the kernel chooses it
+		 */
+		inline int getNumaNode() const { return m_NumaNode; }
+
+		/**
+		 * @return The size in bytes of the regions memory is mapped in
+		 */
+		inline size_t getRegionSize() const { return m_RegionSize; }
+
+		/**
+		 * @return The number of bytes currently mapped with huge pages
+		 */
+		size_t getHugePageBytes();
+
+		/**
+		 * @return The number of bytes currently mapped with regular pages because they couldn't be mapped with huge pages
+		 */
+		size_t getFallbackBytes();
+
+		/**
+		 * @return The number of times a region couldn't be mapped with huge pages since the allocator was created
+		 */
+		uint64_t getNumOfHugePageFailures();
+
+		//overridden methods
+
+		/**
+		 * Allocate a block of memory out of the current region, mapping a new region if it doesn't fit
+		 * @param[in] size The block size in bytes
+		 * @return A pointer to a 64-byte aligned block (16-byte aligned on platforms where regions are allocated on the heap), or NULL if size
+		 * is 0 or a region can't be mapped
+		 */
+		uint8_t* allocate(size_t size);
+
+		/**
+		 * Free a block of memory. Its region is unmapped if it was the last block in use in the region and the region isn't the current one
+		 * @param[in] memory A pointer to a block previously returned by allocate() of this allocator
+		 * @param[in] size The size the block was allocated with
+		 */
+		void deallocate(uint8_t* memory, size_t size);
+
+	private:
+
+		struct Region
+		{
+			size_t size;
+			size_t numOfBlocks;
+			bool hugePages;
+		};
+
+		size_t m_PageSize;
+		int m_NumaNode;
+		size_t m_RegionSize;
+		bool m_AllowFallback;
+		// regions by their start address
+		std::map<uint8_t*, Region> m_Regions;
+		uint8_t* m_CurRegion;
+		size_t m_CurRegionOffset;
+		size_t m_HugePageBytes;
+		size_t m_FallbackBytes;
+		uint64_t m_NumOfHugePageFailures;
+		pthread_mutex_t m_Mutex;
+
+		uint8_t* mapRegion(size_t size, bool& hugePages);
+		void unmapRegion(uint8_t* start, const Region& region);
+
+		// disable copy c'tor and assignment operator
+		HugePagePacketMemoryAllocator(const HugePagePacketMemoryAllocator& other);
+		HugePagePacketMemoryAllocator& operator=(const HugePagePacketMemoryAllocator& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_PACKET_MEMORY_ALLOCATOR */
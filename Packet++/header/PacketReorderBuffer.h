@@ -0,0 +1,255 @@
+#ifndef PACKETPP_PACKET_REORDER_BUFFER
+#define PACKETPP_PACKET_REORDER_BUFFER
+
+#include "RawPacket.h"
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file
+ * Restoring the order of packets processed by parallel workers, so an inline application (a bridge, a pipeline stage, a splitter writing
+ * to a single file) can spread its packets over cores without reordering them. The receiving thread tags each packet with a sequence
+ * number from pcpp#PacketReorderBuffer#assignSequence before handing it to a worker. Workers insert the packets they're done with into the
+ * buffer in whatever order they finish, and the sending (or writing) thread drains them in sequence order:
+ *
+ * @code
+ * // receiving thread
+ * uint64_t seq = reorderBuffer.assignSequence();
+ * // ... pass the packet and seq to a worker
+ *
+ * // worker thread
+ * if (shouldDrop(packet))
+ *     packet = NULL; // NULL tells the buffer the sequence number is done, so it doesn't wait for it
+ * if (reorderBuffer.insert(seq, packet) != PacketReorderBuffer::Inserted)
+ *     delete packet; // late, duplicate or the window is full
+ *
+ * // sending thread
+ * RawPacket* packets[64];
+ * size_t numOfPackets = reorderBuffer.drain(packets, 64);
+ * device->sendPackets(packets, numOfPackets);
+ * @endcode
+ *
+ * The buffer is a window of pcpp#PacketReorderBufferConfiguration#windowSize sequence numbers starting at the next one to release. A
+ * packet whose sequence number is missing holds back the packets after it until it arrives or is given up on. A missing sequence number
+ * is given up on (skipped) when:
+ * - it has been missing for pcpp#PacketReorderBufferConfiguration#timeoutNs while a later packet was waiting, for example because a
+ *   worker lost the packet
+ * - a worker couldn't insert a packet because its sequence number is beyond the window, so waiting longer would stall the workers
+ *
+ * A packet whose sequence number was already skipped or released is late and isn't inserted, so it's left with the worker, which may send
+ * it out of order or drop it. The statistics count late packets, skipped sequence numbers and packets rejected by a full window.
+ */
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct PacketReorderBufferConfiguration
+	 * The configuration of a PacketReorderBuffer
+	 */
+	struct PacketReorderBufferConfiguration
+	{
+		/** The number of sequence numbers the buffer holds, starting at the next one to release. It's rounded up to a power of 2. It should
+		 * be larger than the number of packets in flight between the receiving thread and the sending thread */
+		size_t windowSize;
+		/** The time in nanoseconds a missing sequence number is waited for while later packets are waiting, or 0 for waiting until the
+		 * window is full */
+		uint64_t timeoutNs;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] windowSize The number of sequence numbers the buffer holds. Default value is 1024
+		 * @param[in] timeoutNs The time a missing sequence number is waited for. Default value is 1 millisecond
+		 */
+		PacketReorderBufferConfiguration(size_t windowSize = 1024, uint64_t timeoutNs = 1000000) :
+			windowSize(windowSize), timeoutNs(timeoutNs) {}
+	};
+
+
+	/**
+	 * @struct PacketReorderBufferStats
+	 * The statistics of a PacketReorderBuffer
+	 */
+	struct PacketReorderBufferStats
+	{
+		/** Number of packets drained in order */
+		uint64_t releasedPackets;
+		/** Number of sequence numbers inserted without a packet (see PacketReorderBuffer#insert()) */
+		uint64_t emptySequences;
+		/** Number of packets which weren't inserted because their sequence number was already released or skipped */
+		uint64_t latePackets;
+		/** Number of packets which weren't inserted because a packet with the same sequence number is in the buffer */
+		uint64_t duplicatePackets;
+		/** Number of packets which weren't inserted because their sequence number is beyond the window */
+		uint64_t windowFullPackets;
+		/** Number of missing sequence numbers which were skipped, since their timeout expired or the window was full */
+		uint64_t skippedSequences;
+	};
+
+
+	/**
+	 * @class PacketReorderBuffer
+	 * A window of packets indexed by sequence number, which any number of workers insert packets into and a single thread drains them from
+	 * in sequence order. Please refer to the documentation at the top of PacketReorderBuffer.h for understanding how to use this class.<BR>
+	 * The window is a ring allocated in the c'tor with a slot per sequence number. Each slot has a state word holding the sequence number
+	 * it's waiting for and whether it's free, being written or holds a packet. A worker claims the slot of its sequence number with a
+	 * compare-and-swap and publishes the packet with a release store, and the draining thread frees each slot for the sequence number one
+	 * window later. A missing sequence number is skipped with a compare-and-swap of its free slot, so a packet arriving at the same time is
+	 * either inserted before the skip and released, or found late. Workers never wait for each other or for the draining thread, and they
+	 * share only the slots of their own packets and the highest sequence number inserted.<BR>
+	 * assignSequence() and insert() may be called by any number of threads concurrently. drain() and flush() must be called by a single
+	 * thread
+	 */
+	class PacketReorderBuffer
+	{
+	public:
+
+		/**
+		 * The result of inserting a packet
+		 */
+		enum InsertResult
+		{
+			/** The packet was inserted, and the buffer holds it until it's drained */
+			Inserted,
+			/** The sequence number was already released or skipped. The packet is left with the caller */
+			Late,
+			/** A packet with the same sequence number is in the buffer. The packet is left with the caller */
+			Duplicate,
+			/** The sequence number is beyond the window. The packet is left with the caller, which may insert it again after the window
+			 * moves or drop it. Missing sequence numbers holding the window are skipped in the next drain() */
+			WindowFull
+		};
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The configuration of the buffer. Default value is the default configuration
+		 * @param[in] firstSequence The first sequence number, which is the first one released and the first one assignSequence()
+		 * returns. Default value is 0
+		 */
+		PacketReorderBuffer(const PacketReorderBufferConfiguration& config = PacketReorderBufferConfiguration(), uint64_t firstSequence = 0);
+
+		/**
+		 * A d'tor for this class. Packets still in the buffer aren't freed, call flush() first to get them
+		 */
+		~PacketReorderBuffer();
+
+		/**
+		 * Get consecutive sequence numbers for received packets. May be called by any number of threads concurrently, but packets should be
+		 * tagged in the order they're received, which normally means a single receiving thread
+		 * @param[in] count The number of sequence numbers. Default value is 1
+		 * @return The first sequence number, the others follow it
+		 */
+		uint64_t assignSequence(uint32_t count = 1);
+
+		/**
+		 * Insert a packet a worker is done with. May be called by any number of threads concurrently
+		 * @param[in] sequence The sequence number of the packet
+		 * @param[in] packet The packet. On success the buffer holds the pointer until drain() or flush() returns it, otherwise it's left
+		 * with the caller. NULL marks the sequence number as done without a packet, for example when the worker dropped the packet
+		 * @return The result of the insertion
+		 */
+		InsertResult insert(uint64_t sequence, RawPacket* packet);
+
+		/**
+		 * Get the packets which may be released at a given time, in sequence order. Stops at the first missing sequence number which
+		 * shouldn't be skipped yet. Must be called by a single thread
+		 * @param[in] now The current time
+		 * @param[out] packets An array the packets are written to. The caller owns the packets from now on
+		 * @param[in] maxPackets The size of the array
+		 * @return The number of packets written to the array
+		 */
+		size_t drain(const timespec& now, RawPacket** packets, size_t maxPackets);
+
+		/**
+		 * Same as drain(const timespec&, RawPacket**, size_t) with the current time of TimestampClock
+		 * @param[out] packets An array the packets are written to. The caller owns the packets from now on
+		 * @param[in] maxPackets The size of the array
+		 * @return The number of packets written to the array
+		 */
+		size_t drain(RawPacket** packets, size_t maxPackets);
+
+		/**
+		 * Release all packets in the buffer in sequence order, skipping the missing sequence numbers, for example before the buffer is
+		 * deleted. Must be called when no thread inserts packets
+		 * @param[out] packets A vector the packets are added to. The caller owns the packets from now on
+		 */
+		void flush(std::vector<RawPacket*>& packets);
+
+		/**
+		 * @return The sequence number drain() releases next. When called by a thread other than the draining thread the value may already
+		 * be outdated
+		 */
+		uint64_t getNextSequence() const;
+
+		/**
+		 * @return The number of sequence numbers the buffer holds (the window size rounded up to a power of 2)
+		 */
+		inline size_t getWindowSize() const { return m_WindowSize; }
+
+		/**
+		 * Get the statistics of the buffer. When workers are inserting packets the values may already be outdated
+		 * @param[out] stats The statistics
+		 */
+		void getStats(PacketReorderBufferStats& stats) const;
+
+		/**
+		 * Reset the statistics. Should be called when no thread inserts or drains packets
+		 */
+		void resetStats();
+
+	private:
+
+		enum { CacheLineSize = 64 };
+
+		struct Slot
+		{
+			// the sequence number the slot is waiting for or holds, shifted left by 2, and the SlotState in the 2 low bits
+			volatile uint64_t state;
+			RawPacket* packet;
+		};
+
+		Slot* m_Slots;
+		size_t m_WindowSize;
+		uint64_t m_Mask;
+		uint64_t m_TimeoutNs;
+
+		// shared by the workers
+		char m_WorkerPad[CacheLineSize];
+		// the highest sequence number inserted plus 1, or the first sequence number if none was inserted
+		volatile uint64_t m_InsertedEnd;
+		// the highest sequence number rejected by a full window plus 1, the draining thread skips until it fits
+		volatile uint64_t m_RejectedEnd;
+		volatile uint64_t m_LatePackets;
+		volatile uint64_t m_DuplicatePackets;
+		volatile uint64_t m_WindowFullPackets;
+
+		// used by the receiving thread
+		char m_ReceiverPad[CacheLineSize];
+		volatile uint64_t m_NextAssigned;
+
+		// used by the draining thread
+		char m_DrainerPad[CacheLineSize];
+		volatile uint64_t m_NextSequence;
+		// whether the draining thread waits for a missing sequence number while later packets wait, and since when
+		bool m_Waiting;
+		uint64_t m_WaitStartNs;
+		uint64_t m_ReleasedPackets;
+		uint64_t m_EmptySequences;
+		uint64_t m_SkippedSequences;
+		char m_EndPad[CacheLineSize];
+
+		bool skipMissing(uint64_t sequence);
+
+		// disable copy c'tor and assignment operator
+		PacketReorderBuffer(const PacketReorderBuffer& other);
+		PacketReorderBuffer& operator=(const PacketReorderBuffer& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_PACKET_REORDER_BUFFER */
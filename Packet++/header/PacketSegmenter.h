@@ -0,0 +1,172 @@
+#ifndef PACKETPP_PACKET_SEGMENTER
+#define PACKETPP_PACKET_SEGMENTER
+
+#include "Packet.h"
+#include "PacketView.h"
+#include "RawPacket.h"
+#include "PointerVector.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class PacketSegmenter
+	 * Generic segmentation offload (GSO) in software: splits one large TCP or UDP packet into packets whose payload is at most a given
+	 * segment size, so a traffic generator can build a single packet with a large payload instead of building and computing every segment
+	 * separately:
+	 *
+	 * @code
+	 * Packet packet(66000);
+	 * ... // Ethernet, IPv4, TCP and a payload layer of up to 65495 bytes
+	 * PacketSegmenter segmenter(packet, 1460);
+	 * PointerVector<RawPacket> segments;
+	 * segmenter.writeSegments(segments);
+	 * @endcode
+	 *
+	 * Every segment is a copy of the headers (from the link layer up to the transport header) followed by its part of the payload:
+	 * - TCP: the sequence number of each segment is advanced by the payload of the segments before it. FIN and PSH are set only in the last
+	 *   segment and CWR only in the first, as done by TSO
+	 * - UDP: each segment is a datagram of its own with its own UDP length, as done by UDP GSO (it isn't IP fragmentation)
+	 * - IPv4: the total length is updated and the IP ID is incremented by one for every segment. IPv6: the payload length is updated
+	 *
+	 * The checksums aren't computed from scratch for every segment: the sums of the headers without the fields which change are computed
+	 * once when the segmenter is created, and each segment adds the sums of its changed fields and of its payload, which is summed while
+	 * it's copied. The checksums of the large packet don't need to be valid. A UDP checksum of 0 over IPv4, which means no checksum, stays 0.
+	 *
+	 * The segmenter doesn't copy the large packet: it points into its raw data, which must stay valid while segments are written. Segments
+	 * can be written into buffers, into existing raw packets (for example MBufRawPacket objects allocated from a DpdkDevice, which grow into
+	 * their tailroom) or into new raw packets. To let the NIC do the segmentation of TCP packets see MBufRawPacket#setTxTcpSegmentation()
+	 * and DpdkDevice#sendPacketSegmented(), which uses the NIC when the device is opened with TSO and this class otherwise
+	 */
+	class PacketSegmenter
+	{
+	public:
+
+		/**
+		 * Create a segmenter for a packet built from layers. Packet#computeCalculateFields() is called to set the lengths of the headers
+		 * @param[in] packet The packet. It must stay valid and unchanged while segments are written
+		 * @param[in] segmentSize The maximum TCP or UDP payload of a segment, for TCP the MSS
+		 */
+		PacketSegmenter(Packet& packet, size_t segmentSize);
+
+		/**
+		 * Create a segmenter for a raw packet whose IP and UDP lengths are already set. The segments have the link layer type and the
+		 * timestamp of the raw packet
+		 * @param[in] rawPacket The raw packet. It must stay valid and unchanged while segments are written
+		 * @param[in] segmentSize The maximum TCP or UDP payload of a segment, for TCP the MSS
+		 */
+		PacketSegmenter(const RawPacket& rawPacket, size_t segmentSize);
+
+		/**
+		 * @return True if the packet can be segmented: it's an unfragmented TCP or UDP packet over IPv4 or IPv6 and the segment size isn't 0
+		 */
+		inline bool isValid() const { return m_NumOfSegments > 0; }
+
+		/**
+		 * @return True if the packet is a TCP packet, false if it's a UDP packet or it can't be segmented
+		 */
+		inline bool isTcp() const { return m_IsTcp; }
+
+		/**
+		 * @return The headers of the packet (the offsets apply to the segments as well)
+		 */
+		inline const PacketView& getView() const { return m_View; }
+
+		/**
+		 * @return The number of segments, which is 0 if the packet can't be segmented and 1 if its payload isn't larger than the segment size
+		 */
+		inline size_t getNumOfSegments() const { return m_NumOfSegments; }
+
+		/**
+		 * @return The length of the headers copied to every segment, from the link layer up to the end of the transport header
+		 */
+		inline size_t getHeaderLength() const { return m_HeaderLen; }
+
+		/**
+		 * @return The length of the payload of the packet
+		 */
+		inline size_t getPayloadLength() const { return m_PayloadLen; }
+
+		/**
+		 * @return The maximum payload of a segment
+		 */
+		inline size_t getSegmentSize() const { return m_SegmentSize; }
+
+		/**
+		 * Get the length of a segment
+		 * @param[in] index The index of the segment
+		 * @return The length of the segment including its headers, or 0 if the index is out of range
+		 */
+		size_t getSegmentLength(size_t index) const;
+
+		/**
+		 * Write a segment into a buffer
+		 * @param[in] index The index of the segment
+		 * @param[out] buffer The buffer
+		 * @param[in] bufferLen The length of the buffer
+		 * @return The length of the segment, or 0 if the index is out of range or the buffer is too short
+		 */
+		size_t writeSegment(size_t index, uint8_t* buffer, size_t bufferLen) const;
+
+		/**
+		 * Write a segment into a raw packet, which is resized to the segment length with RawPacket#appendData() or RawPacket#removeData().
+		 * The raw packet is first grown with RawPacket#reallocateData() if needed. For an MBufRawPacket the mbuf grows into its tailroom, so a
+		 * newly allocated mbuf can be written directly
+		 * @param[in] index The index of the segment
+		 * @param[in,out] rawPacket The raw packet
+		 * @return True if the segment was written, false if the index is out of range or the raw packet couldn't be resized
+		 */
+		bool writeSegment(size_t index, RawPacket& rawPacket) const;
+
+		/**
+		 * Write the segments into existing raw packets, segment i into the i-th raw packet
+		 * @param[in] rawPackets An array of pointers to raw packets
+		 * @param[in] numOfPackets The number of raw packets in the array. If it's smaller than getNumOfSegments() only the first segments are
+		 * written
+		 * @return The number of segments written. Writing stops at the first raw packet which couldn't be resized
+		 */
+		size_t writeSegments(RawPacket* const* rawPackets, size_t numOfPackets) const;
+
+		/**
+		 * Write all segments into new raw packets, which are added to the end of a vector
+		 * @param[out] segments The vector
+		 * @return The number of segments added
+		 */
+		size_t writeSegments(PointerVector<RawPacket>& segments) const;
+
+	private:
+
+		const uint8_t* m_Data;
+		LinkLayerType m_LinkType;
+		timeval m_Timestamp;
+		PacketView m_View;
+		bool m_IsTcp;
+		// false for UDP over IPv4 with a zero checksum
+		bool m_HasTransportChecksum;
+		size_t m_HeaderLen;
+		size_t m_PayloadLen;
+		size_t m_SegmentSize;
+		size_t m_NumOfSegments;
+		// the sums of the headers without the checksums and the fields which change per segment: the IPv4 total length and ID, the IPv6
+		// payload length, the pseudo header length, the UDP length and the TCP sequence number and flags
+		uint32_t m_IPv4HeaderSum;
+		uint32_t m_TransportSum;
+		uint16_t m_IPv4Id;
+		uint32_t m_TcpSequence;
+		uint8_t m_TcpFlags;
+
+		void init(const uint8_t* data, size_t dataLen, size_t segmentSize);
+		void fillSegment(size_t index, uint8_t* buffer) const;
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_PACKET_SEGMENTER */
@@ -0,0 +1,243 @@
+#ifndef PACKETPP_PACKET_TEMPLATE
+#define PACKETPP_PACKET_TEMPLATE
+
+#include "Packet.h"
+#include "PacketView.h"
+#include "RawPacket.h"
+#include "IpAddress.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class PacketTemplate
+	 * A packet frozen into bytes, for crafting many similar packets fast. Building a Packet from layers and calling
+	 * Packet#computeCalculateFields() for every packet allocates layers and computes all checksums from scratch; with a template the layers
+	 * are built once, and each packet is made by copying the template bytes into a buffer (stamp()) and patching the fields which change
+	 * (addresses, ports, TCP sequence numbers, payload bytes). Every patch updates the lengths and checksums it affects incrementally
+	 * (RFC 1624), so the cost of a packet doesn't depend on its length:
+	 *
+	 * @code
+	 * Packet packet(100);
+	 * packet.addLayer(&ethLayer);
+	 * packet.addLayer(&ipLayer);
+	 * packet.addLayer(&udpLayer);
+	 * packet.addLayer(&payloadLayer);
+	 * PacketTemplate packetTemplate(packet);
+	 *
+	 * for (...)
+	 * {
+	 *     size_t len = packetTemplate.stamp(buffer, sizeof(buffer), payloadLen);
+	 *     packetTemplate.setSrcPort(buffer, srcPort++);
+	 * }
+	 * @endcode
+	 *
+	 * The headers are located with FlowKeyExtractor, so any link layer it understands may precede the IP header. Checksums are maintained
+	 * for IPv4 headers, TCP, UDP (unless the template's UDP checksum is 0 over IPv4, which means no checksum), ICMP and ICMPv6.
+	 * For ICMP and ICMPv6 the payload is the data following the 8 byte echo header.<BR>
+	 * The template's payload is the longest payload packets can have: stamp() can shorten it, updating the IP and UDP lengths and the
+	 * checksums without reading the payload (the sums of all payload prefixes are computed when the template is created). The patch methods
+	 * work on the stamped buffer and must be given packets stamped from the same template. A template is immutable after it's created,
+	 * so it can be used by several threads at once
+	 */
+	class PacketTemplate
+	{
+	public:
+
+		/**
+		 * Create a template from a packet built from layers. Packet#computeCalculateFields() is called before the packet is frozen
+		 * @param[in] packet The packet
+		 */
+		PacketTemplate(Packet& packet);
+
+		/**
+		 * Create a template from raw data whose lengths and checksums are already set
+		 * @param[in] data A pointer to the raw data
+		 * @param[in] dataLen The raw data length in bytes
+		 * @param[in] linkType The link layer type of the raw data, as in FlowKeyExtractor#extract(). Default is ::LINKTYPE_ETHERNET
+		 */
+		PacketTemplate(const uint8_t* data, size_t dataLen, LinkLayerType linkType = LINKTYPE_ETHERNET);
+
+		/**
+		 * @return The length of the template, which is the length of packets stamped with the full payload
+		 */
+		inline size_t getLength() const { return m_Data.size(); }
+
+		/**
+		 * @return A pointer to the template bytes
+		 */
+		inline const uint8_t* getData() const { return m_Data.empty() ? NULL : &m_Data[0]; }
+
+		/**
+		 * @return The link layer type of the template
+		 */
+		inline LinkLayerType getLinkLayerType() const { return m_LinkType; }
+
+		/**
+		 * @return The headers of the template (the offsets apply to stamped packets as well)
+		 */
+		inline const PacketView& getView() const { return m_View; }
+
+		/**
+		 * @return The offset of the payload, or PacketView#NoOffset if the template isn't a TCP, UDP, ICMP or ICMPv6 packet
+		 */
+		inline uint16_t getPayloadOffset() const { return m_PayloadOffset; }
+
+		/**
+		 * @return The length of the template's payload, which is the longest payload stamped packets can have
+		 */
+		inline size_t getMaxPayloadLength() const { return m_MaxPayloadLen; }
+
+		/**
+		 * Copy the template into a buffer
+		 * @param[out] buffer The buffer
+		 * @param[in] bufferLen The length of the buffer
+		 * @return The length of the packet, or 0 if the buffer is too short
+		 */
+		size_t stamp(uint8_t* buffer, size_t bufferLen) const;
+
+		/**
+		 * Copy the template into a buffer with a shorter payload. The IP length, UDP length and the checksums are updated
+		 * @param[out] buffer The buffer
+		 * @param[in] bufferLen The length of the buffer
+		 * @param[in] payloadLen The payload length, which mustn't exceed getMaxPayloadLength(). The payload bytes are the first bytes
+		 * of the template's payload
+		 * @return The length of the packet, or 0 if the buffer is too short, the payload is too long or the template has no payload
+		 * whose length can be changed
+		 */
+		size_t stamp(uint8_t* buffer, size_t bufferLen, size_t payloadLen) const;
+
+		/**
+		 * Copy the template into a raw packet, which is resized to the packet length with RawPacket#appendData() or RawPacket#removeData().
+		 * The raw packet is first grown with RawPacket#reallocateData() if needed. For an MBufRawPacket the mbuf grows into its tailroom,
+		 * so a newly allocated mbuf can be stamped directly
+		 * @param[in,out] rawPacket The raw packet
+		 * @return True if the raw packet was stamped, false if it couldn't be resized
+		 */
+		bool stamp(RawPacket& rawPacket) const;
+
+		/**
+		 * Same as stamp(RawPacket&) const, but with a shorter payload as in stamp(uint8_t*, size_t, size_t) const
+		 * @param[in,out] rawPacket The raw packet
+		 * @param[in] payloadLen The payload length
+		 * @return True if the raw packet was stamped, false if it couldn't be resized or the payload length isn't valid
+		 */
+		bool stamp(RawPacket& rawPacket, size_t payloadLen) const;
+
+		/**
+		 * Set the IPv4 source address of a stamped packet
+		 * @param[in,out] packet The packet
+		 * @param[in] address The new address
+		 * @return True if the address was set, false if the template isn't an IPv4 packet
+		 */
+		bool setSrcIPv4Address(uint8_t* packet, const IPv4Address& address) const;
+
+		/**
+		 * Set the IPv4 destination address of a stamped packet
+		 * @param[in,out] packet The packet
+		 * @param[in] address The new address
+		 * @return True if the address was set, false if the template isn't an IPv4 packet
+		 */
+		bool setDstIPv4Address(uint8_t* packet, const IPv4Address& address) const;
+
+		/**
+		 * Set the IPv6 source address of a stamped packet
+		 * @param[in,out] packet The packet
+		 * @param[in] address The new address
+		 * @return True if the address was set, false if the template isn't an IPv6 packet
+		 */
+		bool setSrcIPv6Address(uint8_t* packet, const IPv6Address& address) const;
+
+		/**
+		 * Set the IPv6 destination address of a stamped packet
+		 * @param[in,out] packet The packet
+		 * @param[in] address The new address
+		 * @return True if the address was set, false if the template isn't an IPv6 packet
+		 */
+		bool setDstIPv6Address(uint8_t* packet, const IPv6Address& address) const;
+
+		/**
+		 * Set the IPv4 identification field of a stamped packet
+		 * @param[in,out] packet The packet
+		 * @param[in] ipId The new value in host byte order
+		 * @return True if the value was set, false if the template isn't an IPv4 packet
+		 */
+		bool setIPv4Id(uint8_t* packet, uint16_t ipId) const;
+
+		/**
+		 * Set the TCP or UDP source port of a stamped packet
+		 * @param[in,out] packet The packet
+		 * @param[in] port The new port in host byte order
+		 * @return True if the port was set, false if the template isn't a TCP or UDP packet
+		 */
+		bool setSrcPort(uint8_t* packet, uint16_t port) const;
+
+		/**
+		 * Set the TCP or UDP destination port of a stamped packet
+		 * @param[in,out] packet The packet
+		 * @param[in] port The new port in host byte order
+		 * @return True if the port was set, false if the template isn't a TCP or UDP packet
+		 */
+		bool setDstPort(uint8_t* packet, uint16_t port) const;
+
+		/**
+		 * Set the TCP sequence number of a stamped packet
+		 * @param[in,out] packet The packet
+		 * @param[in] sequenceNumber The new sequence number in host byte order
+		 * @return True if the sequence number was set, false if the template isn't a TCP packet
+		 */
+		bool setTcpSequenceNumber(uint8_t* packet, uint32_t sequenceNumber) const;
+
+		/**
+		 * Set the TCP acknowledgment number of a stamped packet
+		 * @param[in,out] packet The packet
+		 * @param[in] ackNumber The new acknowledgment number in host byte order
+		 * @return True if the acknowledgment number was set, false if the template isn't a TCP packet
+		 */
+		bool setTcpAckNumber(uint8_t* packet, uint32_t ackNumber) const;
+
+		/**
+		 * Overwrite bytes of the payload of a stamped packet
+		 * @param[in,out] packet The packet
+		 * @param[in] packetLen The length of the packet, as returned by stamp()
+		 * @param[in] offset The offset in the payload to write the data to
+		 * @param[in] data The data to write
+		 * @param[in] dataLen The length of the data
+		 * @return True if the data was written, false if the template has no payload or the data exceeds the payload of the packet
+		 */
+		bool setPayload(uint8_t* packet, size_t packetLen, size_t offset, const uint8_t* data, size_t dataLen) const;
+
+	private:
+
+		std::vector<uint8_t> m_Data;
+		LinkLayerType m_LinkType;
+		PacketView m_View;
+		// the offset of the data the transport checksum covers (the TCP, UDP, ICMP or ICMPv6 header), or NoOffset
+		uint16_t m_L4Offset;
+		// the offset of the transport checksum field, or NoOffset if there is no checksum to maintain
+		uint16_t m_ChecksumOffset;
+		bool m_HasPseudoHeader;
+		uint16_t m_PayloadOffset;
+		size_t m_MaxPayloadLen;
+		// the sum of the checksummed data without the payload and the length fields, and the sums of the payload prefixes
+		uint32_t m_BaseSum;
+		std::vector<uint32_t> m_PayloadSums;
+
+		void init(const uint8_t* data, size_t dataLen);
+		bool patch(uint8_t* packet, size_t packetLen, size_t offset, const uint8_t* data, size_t dataLen, bool inIPv4Header, bool inTransportChecksum) const;
+		size_t stampShortened(uint8_t* buffer, size_t payloadLen) const;
+		bool resizeRawPacket(RawPacket& rawPacket, size_t packetLen) const;
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_PACKET_TEMPLATE */
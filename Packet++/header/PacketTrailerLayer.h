@@ -79,6 +79,8 @@ namespace pcpp
 		OsiModelLayer getOsiModelLayer() const { return OsiModelDataLinkLayer; }
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(PacketTrailerLayer, PacketTrailer);
+
 }
 
 #endif // PACKETPP_PACKET_TRAILER_LAYER
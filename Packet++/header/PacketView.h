@@ -0,0 +1,178 @@
+#ifndef PACKETPP_PACKET_VIEW
+#define PACKETPP_PACKET_VIEW
+
+#include "RawPacket.h"
+#include "ProtocolType.h"
+#include "IpAddress.h"
+#include <stdint.h>
+#include <string.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct PacketView
+	 * A plain struct describing the headers of a packet up to the transport layer: header offsets, the 5-tuple, VLAN and TCP flags.
+	 * It's filled by FlowKeyExtractor directly from the raw data, without creating any Layer objects, which makes it suitable for
+	 * dataplane filtering and flow classification where building a full Packet isn't needed.
+	 * All offsets are in bytes from the beginning of the raw data, all port and VLAN values are in host byte order, and IP addresses are
+	 * kept in network byte order as they appear in the packet
+	 */
+	struct PacketView
+	{
+		/**
+		 * An offset value indicating the packet doesn't contain the requested header
+		 */
+		static const uint16_t NoOffset = 0xffff;
+
+		/** A bitmask of the headers found in the packet. Can contain ::Ethernet, ::SLL, ::VLAN, ::MPLS, ::IPv4, ::IPv6, ::TCP and ::UDP */
+		uint64_t protocolTypes;
+		/** The offset of the IPv4 or IPv6 header, or #NoOffset if the packet doesn't contain one */
+		uint16_t networkOffset;
+		/**
+		 * The offset of the data following the IPv4 header or the IPv6 header and its extensions, or #NoOffset if there is no such data or
+		 * the packet is a fragment. Unlike #transportOffset it's set for all IP protocols, for example for GRE and IP-in-IP
+		 */
+		uint16_t ipPayloadOffset;
+		/** The offset of the TCP or UDP header, or #NoOffset if the packet doesn't contain one */
+		uint16_t transportOffset;
+		/** The offset of the data following the TCP or UDP header, or #NoOffset if there is no such data */
+		uint16_t payloadOffset;
+		/** The length of the data following the TCP or UDP header up to the end of the IP packet (Ethernet padding isn't included), or 0 if
+		 * there is no such data */
+		uint32_t payloadLength;
+		/** The VLAN ID of the outermost VLAN tag, valid only if #vlanCount is larger than 0 */
+		uint16_t vlanId;
+		/** The number of VLAN tags preceding the network header */
+		uint8_t vlanCount;
+		/** The number of MPLS labels preceding the network header */
+		uint8_t mplsLabelCount;
+		/** The IP version (4 or 6), or 0 if the packet doesn't contain an IP header */
+		uint8_t ipVersion;
+		/** The IP protocol of the data following the IP header (for IPv6 this is the next header value following all extensions) */
+		uint8_t ipProtocol;
+		/** True if the IP header is a fragment (for IPv6: contains a fragmentation extension). Fragments never have a transport header */
+		bool isFragment;
+		/** The identification of the fragment: the IP ID for IPv4 and the fragmentation extension ID for IPv6. Valid only for fragments */
+		uint32_t fragmentId;
+		/** The TCP flags byte (FIN = 0x01 ... CWR = 0x80), valid only for TCP packets */
+		uint8_t tcpFlags;
+		/** The source port, valid only for TCP and UDP packets */
+		uint16_t srcPort;
+		/** The destination port, valid only for TCP and UDP packets */
+		uint16_t dstPort;
+		/** The source IP address. For IPv4 packets only the first 4 bytes are used */
+		uint8_t srcIP[16];
+		/** The destination IP address. For IPv4 packets only the first 4 bytes are used */
+		uint8_t dstIP[16];
+
+		/**
+		 * Check whether the packet contains a certain header. Same semantics as Packet#isPacketOfType()
+		 * @param[in] protocolType The protocol type to check
+		 * @return True if the packet contains a header of this protocol, false otherwise
+		 */
+		inline bool isPacketOfType(ProtocolType protocolType) const { return (protocolTypes & protocolType) != 0; }
+
+		/**
+		 * @return The source IPv4 address, or IPv4Address#Zero if the packet isn't an IPv4 packet
+		 */
+		inline IPv4Address getSrcIPv4Address() const { return getIPv4Address(srcIP); }
+
+		/**
+		 * @return The destination IPv4 address, or IPv4Address#Zero if the packet isn't an IPv4 packet
+		 */
+		inline IPv4Address getDstIPv4Address() const { return getIPv4Address(dstIP); }
+
+		/**
+		 * @return The source IPv6 address, or IPv6Address#Zero if the packet isn't an IPv6 packet
+		 */
+		inline IPv6Address getSrcIPv6Address() const { return getIPv6Address(srcIP); }
+
+		/**
+		 * @return The destination IPv6 address, or IPv6Address#Zero if the packet isn't an IPv6 packet
+		 */
+		inline IPv6Address getDstIPv6Address() const { return getIPv6Address(dstIP); }
+
+	private:
+		inline IPv4Address getIPv4Address(const uint8_t* addr) const
+		{
+			if (ipVersion != 4)
+				return IPv4Address::Zero;
+
+			uint32_t addrAsInt;
+			memcpy(&addrAsInt, addr, sizeof(addrAsInt));
+			return IPv4Address(addrAsInt);
+		}
+
+		inline IPv6Address getIPv6Address(const uint8_t* addr) const
+		{
+			if (ipVersion != 6)
+				return IPv6Address::Zero;
+
+			return IPv6Address((uint8_t*)addr);
+		}
+	};
+
+
+	/**
+	 * @class FlowKeyExtractor
+	 * Fills PacketView structs from raw packets. It walks the same headers EthLayer, SllLayer, VlanLayer, MplsLayer, IPv4Layer, IPv6Layer
+	 * (including IPv6 extensions), TcpLayer and UdpLayer understand, in the same order and using the same ProtocolRegistry tables, so its
+	 * results are consistent with the layers of a Packet created from the same raw packet. The main differences are:
+	 * - Nothing is allocated and no Layer objects are created
+	 * - Only the first network header is described. Tunneled packets (IP-in-IP, GRE, GTP, VXLAN) are described by their outer headers. TunnelDecapsulator describes their inner headers
+	 * - Headers truncated before their fixed part ends are considered missing
+	 */
+	class FlowKeyExtractor
+	{
+	public:
+
+		/**
+		 * Fill a PacketView from a raw packet
+		 * @param[in] rawPacket The raw packet to read. The link layer type is taken from RawPacket#getLinkLayerType()
+		 * @param[out] view The struct to fill. All its fields are overwritten
+		 * @return True if the packet contains an IPv4 or IPv6 header, false otherwise (in which case view may still describe the
+		 * link layer headers)
+		 */
+		static bool extract(const RawPacket* rawPacket, PacketView& view);
+
+		/**
+		 * Fill a PacketView from raw data
+		 * @param[in] data A pointer to the raw data
+		 * @param[in] dataLen The raw data length in bytes
+		 * @param[in] linkType The link layer type of the raw data. Supported types are ::LINKTYPE_ETHERNET, ::LINKTYPE_LINUX_SLL,
+		 * ::LINKTYPE_RAW, ::LINKTYPE_DLT_RAW1 and ::LINKTYPE_DLT_RAW2 (::LINKTYPE_NULL isn't supported). As in Packet, unknown types
+		 * are parsed as Ethernet
+		 * @param[out] view The struct to fill. All its fields are overwritten
+		 * @return True if the packet contains an IPv4 or IPv6 header, false otherwise (in which case view may still describe the
+		 * link layer headers)
+		 */
+		static bool extract(const uint8_t* data, size_t dataLen, LinkLayerType linkType, PacketView& view);
+
+		/**
+		 * Fill the network and transport fields of a PacketView whose link layer fields are already known, starting at the network header
+		 * instead of the beginning of the data. Useful when the headers following the link layer headers changed, for example after IP
+		 * reassembly (see IPReassembly#processRawPacket())
+		 * @param[in] data A pointer to the raw data
+		 * @param[in] dataLen The raw data length in bytes
+		 * @param[in] networkOffset The offset of the IPv4 or IPv6 header in the raw data. The IP version is taken from the header
+		 * @param[in,out] view The struct to fill. The link layer fields (VLAN, MPLS and the link layer protocol types) are kept and all other
+		 * fields are overwritten
+		 * @return True if there is an IPv4 or IPv6 header at networkOffset, false otherwise
+		 */
+		static bool extractFromNetworkLayer(const uint8_t* data, size_t dataLen, size_t networkOffset, PacketView& view);
+
+	private:
+		static bool extractNetworkLayer(const uint8_t* data, size_t dataLen, size_t offset, ProtocolType protocol, PacketView& view);
+		static void extractTransportLayer(const uint8_t* data, size_t offset, size_t len, ProtocolType protocol, PacketView& view);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_PACKET_VIEW */
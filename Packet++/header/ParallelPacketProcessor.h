@@ -0,0 +1,462 @@
+#ifndef PACKETPP_PARALLEL_PACKET_PROCESSOR
+#define PACKETPP_PARALLEL_PACKET_PROCESSOR
+
+#include "RawPacket.h"
+#include "RawPacketSlabVector.h"
+#include "Packet.h"
+#include "LayerArena.h"
+#include "PointerVector.h"
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/**
+ * @file
+ * Parallel algorithms over packets held in memory, such as a capture file loaded with IFileReaderDevice#getNextPackets() into a
+ * RawPacketVector or a pcpp#RawPacketSlabVector. Parsing, filtering, hashing and counting such packets are independent per packet (or
+ * per flow), so pcpp#ParallelPacketProcessor spreads them over all cores:
+ * - pcpp#ParallelPacketProcessor#forEach calls a callback for every packet
+ * - pcpp#ParallelPacketProcessor#transformReduce folds the packets into a value, e.g counters or a histogram
+ * - pcpp#ParallelPacketProcessor#filter collects the indices of the packets matching a predicate, in their original order
+ * - pcpp#ParallelPacketProcessor#partitionByFlow splits the packets into partitions by a symmetric hash of their 5-tuple, and
+ *   pcpp#ParallelPacketProcessor#forEachPartition processes each partition on a single thread, so per-flow state needs no locks
+ *
+ * The packets are split into chunks of consecutive packets, and the chunks into one contiguous range per thread. Each thread processes
+ * its range from the front, and a thread which finished its range steals the back half of the largest range left, so threads which got
+ * cheap packets help the others instead of waiting. The threads are created once, in the c'tor, and the thread calling an algorithm
+ * works as thread 0 until the algorithm is done.
+ *
+ * Results don't depend on the scheduling: transformReduce() folds each chunk into its own accumulator and merges the accumulators in
+ * chunk order, and filter() and partitionByFlow() return indices in packet order. Callbacks get a pcpp#ParallelPacketContext with the
+ * index of the thread, the user cookie of the thread and a Packet with a LayerArena owned by the thread, for parsing packets without
+ * allocating layers on the heap.
+ */
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * @struct ParallelPacketProcessorConfiguration
+ * A structure for configuring the ParallelPacketProcessor class
+ */
+struct ParallelPacketProcessorConfiguration
+{
+	/** The number of threads, including the thread calling the algorithms, or 0 for the number of cores of the machine */
+	int numOfThreads;
+	/** The number of consecutive packets processed as one task. Smaller chunks balance the load better, larger ones cost less scheduling */
+	size_t chunkSize;
+	/** The size of the LayerArena of each thread (see ParallelPacketContext#parsePacket()) */
+	size_t layerArenaSize;
+
+	/**
+	 * A c'tor for this struct
+	 * @param[in] numOfThreads The number of threads, or 0 for the number of cores. The default is 0
+	 * @param[in] chunkSize The number of packets processed as one task. The default is 256
+	 * @param[in] layerArenaSize The size of the LayerArena of each thread. The default is LayerArena#DefaultArenaSize
+	 */
+	ParallelPacketProcessorConfiguration(int numOfThreads = 0, size_t chunkSize = 256, size_t layerArenaSize = LayerArena::DefaultArenaSize) :
+		numOfThreads(numOfThreads), chunkSize(chunkSize), layerArenaSize(layerArenaSize)
+	{
+	}
+};
+
+
+/**
+ * @class ParallelPacketContext
+ * The state of one thread of a ParallelPacketProcessor, passed to the callbacks running on that thread. It's valid only during the callback
+ */
+class ParallelPacketContext
+{
+	friend class ParallelPacketProcessor;
+
+public:
+	/**
+	 * @return The index of the thread, between 0 and ParallelPacketProcessor#getNumOfThreads()-1. Thread 0 is the thread which called the
+	 * algorithm
+	 */
+	inline int getThreadIndex() const { return m_ThreadIndex; }
+
+	/**
+	 * @return The user cookie of the thread (see ParallelPacketProcessor#setThreadUserCookie())
+	 */
+	inline void* getUserCookie() const { return m_UserCookie; }
+
+	/**
+	 * Parse a packet into the Packet of the thread, whose layers are allocated from the LayerArena of the thread. The previous packet
+	 * parsed by the thread is freed, so the returned Packet is valid until the next call on this thread or the end of the algorithm
+	 * @param[in] rawPacket The packet to parse
+	 * @param[in] parseUntil Parse the packet until this protocol (inclusive). The default is ::UnknownProtocol, which parses all layers
+	 * @return The Packet of the thread
+	 */
+	Packet& parsePacket(RawPacket* rawPacket, ProtocolType parseUntil = UnknownProtocol);
+
+private:
+	int m_ThreadIndex;
+	void* m_UserCookie;
+	LayerArena m_LayerArena;
+	Packet m_Packet;
+
+	ParallelPacketContext(int threadIndex, size_t layerArenaSize);
+
+	// disable copy c'tor and assignment operator
+	ParallelPacketContext(const ParallelPacketContext& other);
+	ParallelPacketContext& operator=(const ParallelPacketContext& other);
+};
+
+
+/**
+ * @class ParallelPacketProcessor
+ * Runs algorithms over packets held in memory on a pool of threads with work stealing. Please refer to the documentation at the top of
+ * ParallelPacketProcessor.h for understanding how to use this class.<BR>
+ * An algorithm returns after all packets were processed. The packets mustn't be changed by other threads while an algorithm runs, and
+ * algorithms of the same instance mustn't be called by several threads at once
+ */
+class ParallelPacketProcessor
+{
+public:
+
+	/**
+	 * @typedef OnPacket
+	 * A callback invoked for a packet
+	 * @param[in] rawPacket The packet
+	 * @param[in] packetIndex The index of the packet in the packets given to the algorithm
+	 * @param[in] context The context of the thread the callback runs on
+	 */
+	typedef void (*OnPacket)(RawPacket* rawPacket, size_t packetIndex, ParallelPacketContext& context);
+
+	/**
+	 * @typedef PacketPredicate
+	 * A predicate invoked for a packet by filter(). A GeneralFilter can't be shared between threads, since it compiles its program on
+	 * first use, so give each thread its own filter through its user cookie
+	 * @param[in] rawPacket The packet
+	 * @param[in] packetIndex The index of the packet in the packets given to the algorithm
+	 * @param[in] context The context of the thread the predicate runs on
+	 * @return True if the packet matches
+	 */
+	typedef bool (*PacketPredicate)(RawPacket* rawPacket, size_t packetIndex, ParallelPacketContext& context);
+
+	/**
+	 * @typedef OnTask
+	 * A callback invoked for a task of runTasks()
+	 * @param[in] taskIndex The index of the task
+	 * @param[in] context The context of the thread the task runs on
+	 * @param[in] taskCookie The cookie given to runTasks()
+	 */
+	typedef void (*OnTask)(size_t taskIndex, ParallelPacketContext& context, void* taskCookie);
+
+	/**
+	 * A c'tor for this class, which creates the threads. If a thread can't be created the processor works with the threads created
+	 * before it
+	 * @param[in] userCookie The user cookie of all threads, unless a thread gets its own cookie (see setThreadUserCookie()). The default
+	 * is NULL
+	 * @param[in] config The number of threads and the chunk size. If not set the default parameters will be set
+	 */
+	ParallelPacketProcessor(void* userCookie = NULL, const ParallelPacketProcessorConfiguration& config = ParallelPacketProcessorConfiguration());
+
+	/**
+	 * A d'tor for this class. Stops and joins the threads
+	 */
+	~ParallelPacketProcessor();
+
+	/**
+	 * @return The number of threads, including the thread calling the algorithms
+	 */
+	inline int getNumOfThreads() const { return (int)m_Contexts.size(); }
+
+	/**
+	 * @return The number of packets processed as one task
+	 */
+	inline size_t getChunkSize() const { return m_ChunkSize; }
+
+	/**
+	 * Set the user cookie of a thread, e.g a per-thread filter, flow table or counters. Should be called while no algorithm runs
+	 * @param[in] threadIndex The index of the thread
+	 * @param[in] userCookie The cookie
+	 */
+	void setThreadUserCookie(int threadIndex, void* userCookie);
+
+	/**
+	 * @return The number of tasks which were stolen from another thread since the processor was created
+	 */
+	inline uint64_t getNumOfStolenTasks() const { return m_NumOfStolenTasks; }
+
+	/**
+	 * Call a callback for every packet. The packets of a chunk are processed in order on one thread, chunks in no particular order
+	 * @param[in] packets An array of packets
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] onPacket The callback
+	 */
+	void forEach(RawPacket* const* packets, size_t numOfPackets, OnPacket onPacket);
+
+	/**
+	 * Call a callback for every packet of a RawPacketVector, see forEach(RawPacket* const*, size_t, OnPacket)
+	 * @param[in] packets The packets
+	 * @param[in] onPacket The callback
+	 */
+	inline void forEach(const PointerVector<RawPacket>& packets, OnPacket onPacket) { forEach(getPacketArray(packets), packets.size(), onPacket); }
+
+	/**
+	 * Call a callback for every packet of a RawPacketSlabVector, see forEach(RawPacket* const*, size_t, OnPacket)
+	 * @param[in] packets The packets
+	 * @param[in] onPacket The callback
+	 */
+	inline void forEach(const RawPacketSlabVector& packets, OnPacket onPacket) { forEach(getPacketArray(packets), packets.size(), onPacket); }
+
+	/**
+	 * Fold the packets into a value. Every chunk is folded into an accumulator of its own, which starts as a copy of the identity value,
+	 * and the accumulators are merged into the identity value in chunk order, so the result is the same for any number of threads if the
+	 * merge is associative. The reducer is a class with the following methods, called concurrently for different accumulators:
+	 * - void accumulate(T& accumulator, RawPacket* rawPacket, size_t packetIndex, ParallelPacketContext& context)
+	 * - void merge(T& accumulator, const T& other), which is called on the calling thread only
+	 * @param[in] packets An array of packets
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] identity The value accumulators start from, which merging mustn't change (e.g 0 for a sum)
+	 * @param[in] reducer The reducer
+	 * @return The merged value
+	 */
+	template<typename T, typename Reducer>
+	T transformReduce(RawPacket* const* packets, size_t numOfPackets, const T& identity, Reducer& reducer)
+	{
+		ReduceTask<T, Reducer> task(packets, numOfPackets, m_ChunkSize, identity, reducer);
+		runTasks(task.accumulators.size(), ReduceTask<T, Reducer>::run, &task);
+
+		T result = identity;
+		for (size_t i = 0; i < task.accumulators.size(); i++)
+			reducer.merge(result, task.accumulators[i]);
+
+		return result;
+	}
+
+	/**
+	 * Fold the packets of a RawPacketVector into a value, see transformReduce(RawPacket* const*, size_t, const T&, Reducer&)
+	 * @param[in] packets The packets
+	 * @param[in] identity The value accumulators start from
+	 * @param[in] reducer The reducer
+	 * @return The merged value
+	 */
+	template<typename T, typename Reducer>
+	inline T transformReduce(const PointerVector<RawPacket>& packets, const T& identity, Reducer& reducer)
+	{
+		return transformReduce(getPacketArray(packets), packets.size(), identity, reducer);
+	}
+
+	/**
+	 * Fold the packets of a RawPacketSlabVector into a value, see transformReduce(RawPacket* const*, size_t, const T&, Reducer&)
+	 * @param[in] packets The packets
+	 * @param[in] identity The value accumulators start from
+	 * @param[in] reducer The reducer
+	 * @return The merged value
+	 */
+	template<typename T, typename Reducer>
+	inline T transformReduce(const RawPacketSlabVector& packets, const T& identity, Reducer& reducer)
+	{
+		return transformReduce(getPacketArray(packets), packets.size(), identity, reducer);
+	}
+
+	/**
+	 * Collect the indices of the packets which match a predicate
+	 * @param[in] packets An array of packets
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] predicate The predicate
+	 * @param[out] matchingIndices The indices of the matching packets in ascending order. The vector is cleared first
+	 * @return The number of matching packets
+	 */
+	size_t filter(RawPacket* const* packets, size_t numOfPackets, PacketPredicate predicate, std::vector<size_t>& matchingIndices);
+
+	/**
+	 * Collect the indices of the packets of a RawPacketVector which match a predicate, see filter(RawPacket* const*, size_t,
+	 * PacketPredicate, std::vector<size_t>&)
+	 * @param[in] packets The packets
+	 * @param[in] predicate The predicate
+	 * @param[out] matchingIndices The indices of the matching packets in ascending order
+	 * @return The number of matching packets
+	 */
+	inline size_t filter(const PointerVector<RawPacket>& packets, PacketPredicate predicate, std::vector<size_t>& matchingIndices)
+	{
+		return filter(getPacketArray(packets), packets.size(), predicate, matchingIndices);
+	}
+
+	/**
+	 * Collect the indices of the packets of a RawPacketSlabVector which match a predicate, see filter(RawPacket* const*, size_t,
+	 * PacketPredicate, std::vector<size_t>&)
+	 * @param[in] packets The packets
+	 * @param[in] predicate The predicate
+	 * @param[out] matchingIndices The indices of the matching packets in ascending order
+	 * @return The number of matching packets
+	 */
+	inline size_t filter(const RawPacketSlabVector& packets, PacketPredicate predicate, std::vector<size_t>& matchingIndices)
+	{
+		return filter(getPacketArray(packets), packets.size(), predicate, matchingIndices);
+	}
+
+	/**
+	 * Split the packets into partitions by the symmetric hash of their 5-tuple (see FlowDispatcher#getFlowHash()), so all packets of a
+	 * flow, in both directions, are in the same partition. Packets which aren't IPv4 or IPv6 are all in partition 0
+	 * @param[in] packets An array of packets
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] numOfPartitions The number of partitions. Values lower than 1 are treated as 1
+	 * @param[out] partitions The indices of the packets of each partition in ascending order. The vector is resized to the number of
+	 * partitions
+	 */
+	void partitionByFlow(RawPacket* const* packets, size_t numOfPackets, size_t numOfPartitions, std::vector<std::vector<size_t> >& partitions);
+
+	/**
+	 * Split the packets of a RawPacketVector into partitions by flow, see partitionByFlow(RawPacket* const*, size_t, size_t,
+	 * std::vector<std::vector<size_t> >&)
+	 * @param[in] packets The packets
+	 * @param[in] numOfPartitions The number of partitions
+	 * @param[out] partitions The indices of the packets of each partition in ascending order
+	 */
+	inline void partitionByFlow(const PointerVector<RawPacket>& packets, size_t numOfPartitions, std::vector<std::vector<size_t> >& partitions)
+	{
+		partitionByFlow(getPacketArray(packets), packets.size(), numOfPartitions, partitions);
+	}
+
+	/**
+	 * Split the packets of a RawPacketSlabVector into partitions by flow, see partitionByFlow(RawPacket* const*, size_t, size_t,
+	 * std::vector<std::vector<size_t> >&)
+	 * @param[in] packets The packets
+	 * @param[in] numOfPartitions The number of partitions
+	 * @param[out] partitions The indices of the packets of each partition in ascending order
+	 */
+	inline void partitionByFlow(const RawPacketSlabVector& packets, size_t numOfPartitions, std::vector<std::vector<size_t> >& partitions)
+	{
+		partitionByFlow(getPacketArray(packets), packets.size(), numOfPartitions, partitions);
+	}
+
+	/**
+	 * Call a callback for every packet of the partitions returned by partitionByFlow(). All packets of a partition are processed in order
+	 * on one thread, so state kept per thread (e.g a TcpReassembly in the user cookie of the thread) sees all packets of each of its flows.
+	 * Partitions are the tasks which are stolen, so there should be several times more partitions than threads
+	 * @param[in] packets The array of packets the partitions were created from
+	 * @param[in] partitions The partitions
+	 * @param[in] onPacket The callback
+	 */
+	void forEachPartition(RawPacket* const* packets, const std::vector<std::vector<size_t> >& partitions, OnPacket onPacket);
+
+	/**
+	 * Call a callback for every packet of the partitions of a RawPacketVector, see forEachPartition(RawPacket* const*,
+	 * const std::vector<std::vector<size_t> >&, OnPacket)
+	 * @param[in] packets The packets the partitions were created from
+	 * @param[in] partitions The partitions
+	 * @param[in] onPacket The callback
+	 */
+	inline void forEachPartition(const PointerVector<RawPacket>& packets, const std::vector<std::vector<size_t> >& partitions, OnPacket onPacket)
+	{
+		forEachPartition(getPacketArray(packets), partitions, onPacket);
+	}
+
+	/**
+	 * Call a callback for every packet of the partitions of a RawPacketSlabVector, see forEachPartition(RawPacket* const*,
+	 * const std::vector<std::vector<size_t> >&, OnPacket)
+	 * @param[in] packets The packets the partitions were created from
+	 * @param[in] partitions The partitions
+	 * @param[in] onPacket The callback
+	 */
+	inline void forEachPartition(const RawPacketSlabVector& packets, const std::vector<std::vector<size_t> >& partitions, OnPacket onPacket)
+	{
+		forEachPartition(getPacketArray(packets), partitions, onPacket);
+	}
+
+	/**
+	 * Run tasks on all threads, the building block of the algorithms. Tasks are handed out as contiguous ranges, one per thread, and
+	 * stolen as described at the top of ParallelPacketProcessor.h. Returns after all tasks ran
+	 * @param[in] numOfTasks The number of tasks
+	 * @param[in] onTask The callback invoked for each task
+	 * @param[in] taskCookie A pointer passed to the callback
+	 */
+	void runTasks(size_t numOfTasks, OnTask onTask, void* taskCookie);
+
+	/**
+	 * @param[in] packets The packets
+	 * @return A pointer to the array of packet pointers of the vector, or NULL if it's empty
+	 */
+	static inline RawPacket* const* getPacketArray(const PointerVector<RawPacket>& packets) { return (packets.size() == 0 ? NULL : &(*packets.begin())); }
+
+	/**
+	 * @param[in] packets The packets
+	 * @return A pointer to the array of packet pointers of the vector, or NULL if it's empty
+	 */
+	static inline RawPacket* const* getPacketArray(const RawPacketSlabVector& packets) { return (packets.size() == 0 ? NULL : &(*packets.begin())); }
+
+private:
+
+	template<typename T, typename Reducer>
+	struct ReduceTask
+	{
+		RawPacket* const* packets;
+		size_t numOfPackets;
+		size_t chunkSize;
+		std::vector<T> accumulators;
+		Reducer* reducer;
+
+		ReduceTask(RawPacket* const* packets, size_t numOfPackets, size_t chunkSize, const T& identity, Reducer& reducer) :
+			packets(packets), numOfPackets(numOfPackets), chunkSize(chunkSize), accumulators((numOfPackets + chunkSize - 1) / chunkSize, identity),
+			reducer(&reducer)
+		{
+		}
+
+		static void run(size_t taskIndex, ParallelPacketContext& context, void* taskCookie)
+		{
+			ReduceTask* task = (ReduceTask*)taskCookie;
+			size_t end = (taskIndex + 1) * task->chunkSize;
+			if (end > task->numOfPackets)
+				end = task->numOfPackets;
+			T& accumulator = task->accumulators[taskIndex];
+			for (size_t i = taskIndex * task->chunkSize; i < end; i++)
+				task->reducer->accumulate(accumulator, task->packets[i], i, context);
+		}
+	};
+
+	// the tasks a thread has left, [next, end). The owner takes tasks from the front and thieves take the back half
+	struct TaskRange
+	{
+		pthread_mutex_t mutex;
+		size_t next;
+		size_t end;
+		// the number of tasks this thread stole in the current job
+		size_t numOfStolenTasks;
+	};
+
+	struct Worker
+	{
+		ParallelPacketProcessor* owner;
+		int index;
+		pthread_t thread;
+	};
+
+	std::vector<ParallelPacketContext*> m_Contexts;
+	std::vector<TaskRange*> m_Ranges;
+	std::vector<Worker*> m_Workers;
+	size_t m_ChunkSize;
+	uint64_t m_NumOfStolenTasks;
+
+	// the current job, published to the threads by incrementing m_JobId under m_Mutex
+	OnTask m_OnTask;
+	void* m_TaskCookie;
+	uint64_t m_JobId;
+	int m_NumOfBusyThreads;
+	bool m_StopRequested;
+	pthread_mutex_t m_Mutex;
+	pthread_cond_t m_JobCond;
+	pthread_cond_t m_DoneCond;
+
+	bool takeTask(int threadIndex, size_t& taskIndex);
+	bool stealTasks(int threadIndex);
+	void runThreadTasks(int threadIndex);
+
+	static void* workerThreadMain(void* workerPtr);
+
+	// disable copy c'tor and assignment operator
+	ParallelPacketProcessor(const ParallelPacketProcessor& other);
+	ParallelPacketProcessor& operator=(const ParallelPacketProcessor& other);
+};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_PARALLEL_PACKET_PROCESSOR */
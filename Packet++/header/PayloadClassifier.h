@@ -0,0 +1,164 @@
+#ifndef PACKETPP_PAYLOAD_CLASSIFIER
+#define PACKETPP_PAYLOAD_CLASSIFIER
+
+#include "FlowTable.h"
+#include "ProtocolType.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	class Layer;
+	class Packet;
+
+	/**
+	 * @struct PayloadClassifierConfiguration
+	 * The configuration of a PayloadClassifier
+	 */
+	struct PayloadClassifierConfiguration
+	{
+		/**
+		 * A bitmask of the protocols to detect. Supported values are ::HTTP, ::SSL, ::SIP, ::DNS, ::Radius and ::GTPv1
+		 */
+		uint64_t protocols;
+
+		/**
+		 * The maximum number of flows whose verdict is kept. When it's reached the least recently seen flow is forgotten. 0 disables the
+		 * cache, so every packet is matched against the signatures
+		 */
+		size_t flowCacheSize;
+
+		/**
+		 * The number of packets with payload of a flow which are matched against the signatures before the flow is marked as unknown and
+		 * its packets aren't matched anymore. Flows are often first seen in the middle, where their payload doesn't start with a header
+		 */
+		uint8_t maxAttempts;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] protocols A bitmask of the protocols to detect. Default value is all supported protocols
+		 * @param[in] flowCacheSize The maximum number of flows whose verdict is kept, or 0 to disable the cache. Default value is 65536
+		 * @param[in] maxAttempts The number of packets of a flow matched before the flow is marked as unknown. Default value is 4
+		 */
+		PayloadClassifierConfiguration(uint64_t protocols = HTTP | SSL | SIP | DNS | Radius | GTPv1, size_t flowCacheSize = 65536,
+				uint8_t maxAttempts = 4) :
+			protocols(protocols), flowCacheSize(flowCacheSize), maxAttempts(maxAttempts) {}
+	};
+
+
+	/**
+	 * @struct PayloadClassifierStats
+	 * The statistics of a PayloadClassifier
+	 */
+	struct PayloadClassifierStats
+	{
+		/** Number of packets classified */
+		uint64_t packets;
+		/** Number of packets whose flow already had a verdict, so they weren't matched against the signatures */
+		uint64_t cacheHits;
+		/** Number of flows a protocol was detected for */
+		uint64_t flowsDetected;
+		/** Number of flows marked as unknown after PayloadClassifierConfiguration#maxAttempts packets */
+		uint64_t flowsUnknown;
+	};
+
+
+	/**
+	 * @class PayloadClassifier
+	 * Detects the application layer protocol of TCP and UDP payloads by their content rather than by their ports, so for example TLS on
+	 * port 8443, HTTP on port 8090 or DNS on a non-standard port are parsed as SSLLayer, HttpRequestLayer and DnsLayer instead of
+	 * PayloadLayer.<BR>
+	 * Detection is cheap by design: the first 4 bytes of the payload are compared with the prefixes of the text protocols (HTTP methods
+	 * and status lines, SIP methods and status lines), and the binary protocols are recognized by a few fixed header fields (a TLS record
+	 * header, DNS header sanity, RADIUS and GTPv1 lengths which match the datagram length). The verdict is cached per flow (both directions
+	 * of a flow share it), so each flow is matched once and its next packets are dispatched directly to the parser of its protocol.<BR>
+	 * A classifier is used by TcpLayer and UdpLayer when it's set with ProtocolRegistry#setPayloadClassifier(). It's consulted only for
+	 * payloads the port-based detection didn't recognize, so it doesn't change how packets on registered ports are parsed. Please notice
+	 * the flow cache isn't thread-safe: when packets are parsed on several threads, use a classifier without a cache (see
+	 * PayloadClassifierConfiguration#flowCacheSize)
+	 */
+	class PayloadClassifier
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The configuration of the classifier. Default is all supported protocols and a cache of 65536 flows
+		 */
+		PayloadClassifier(const PayloadClassifierConfiguration& config = PayloadClassifierConfiguration());
+
+		/**
+		 * Match a payload against the signatures, without using the flow cache
+		 * @param[in] data The payload (the data following the TCP or UDP header)
+		 * @param[in] dataLen The payload length in bytes
+		 * @param[in] isTcp True if the payload is carried over TCP, false if it's carried over UDP
+		 * @param[in] protocols A bitmask of the protocols to detect. Default value is all supported protocols
+		 * @return The detected protocol (::HTTP, ::SSL, ::SIP, ::DNS, ::Radius or ::GTPv1), or ::UnknownProtocol if none matched
+		 */
+		static ProtocolType matchSignature(const uint8_t* data, size_t dataLen, bool isTcp, uint64_t protocols = HTTP | SSL | SIP | DNS | Radius | GTPv1);
+
+		/**
+		 * Classify the payload of a flow, using the verdict cached for the flow if there is one
+		 * @param[in] tuple The 5-tuple of the flow. Its protocol field tells whether the payload is carried over TCP or UDP
+		 * @param[in] data The payload
+		 * @param[in] dataLen The payload length in bytes
+		 * @return The protocol of the flow, as in matchSignature()
+		 */
+		ProtocolType classify(const FlowTuple& tuple, const uint8_t* data, size_t dataLen);
+
+		/**
+		 * Classify the payload following a TCP or UDP layer and create the layer of the detected protocol. This is the method TcpLayer and
+		 * UdpLayer call while parsing
+		 * @param[in] data The payload
+		 * @param[in] dataLen The payload length in bytes
+		 * @param[in] prevLayer The TcpLayer or UdpLayer the payload follows
+		 * @param[in] packet The packet the layer belongs to
+		 * @return The new layer, or NULL if no protocol was detected or the payload isn't a valid message of the protocol of its flow
+		 */
+		Layer* createLayer(uint8_t* data, size_t dataLen, Layer* prevLayer, Packet* packet);
+
+		/**
+		 * Forget the verdicts of all flows. The statistics are kept
+		 */
+		void clear();
+
+		/**
+		 * @return The number of flows in the cache
+		 */
+		inline size_t getNumOfFlows() const { return m_Flows.size(); }
+
+		/**
+		 * Get the classifier statistics
+		 * @param[out] stats The statistics
+		 */
+		inline void getStats(PayloadClassifierStats& stats) const { stats = m_Stats; }
+
+	private:
+
+		struct FlowVerdict
+		{
+			ProtocolType protocol;
+			uint8_t attempts;
+
+			FlowVerdict() : protocol(UnknownProtocol), attempts(0) {}
+		};
+
+		PayloadClassifierConfiguration m_Config;
+		FlowTable<FlowTuple, FlowVerdict> m_Flows;
+		PayloadClassifierStats m_Stats;
+
+		// disable copy c'tor and assignment operator
+		PayloadClassifier(const PayloadClassifier& other);
+		PayloadClassifier& operator=(const PayloadClassifier& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_PAYLOAD_CLASSIFIER */
@@ -69,10 +69,14 @@ namespace pcpp
 
 		std::string toString();
 
+		void dump(PacketDumpWriter& writer);
+
 		OsiModelLayer getOsiModelLayer() const { return OsiModelApplicationLayer; }
 
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(PayloadLayer, GenericPayload);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_PAYLOAD_LAYER */
@@ -0,0 +1,192 @@
+#ifndef PACKETPP_PROTOCOL_REGISTRY
+#define PACKETPP_PROTOCOL_REGISTRY
+
+#include "ProtocolType.h"
+#include <stdint.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	class PayloadClassifier;
+
+	/**
+	 * @class ProtocolRegistry
+	 * A singleton holding the tables layers use for deciding which layer comes next while parsing a packet:
+	 * - A table indexed by ethertype, used by EthLayer, SllLayer, VlanLayer and GreLayer
+	 * - A table indexed by IP protocol number, used by IPv4Layer and IPv6Layer
+	 * - A table indexed by TCP/UDP port, used by TcpLayer and UdpLayer to identify application layer protocols
+	 * - An optional PayloadClassifier, used by TcpLayer and UdpLayer to identify application layer protocols on unregistered ports by the
+	 *   content of the payload
+	 *
+	 * All tables are flat arrays so each lookup costs a single memory access. The tables are initialized with the values PcapPlusPlus
+	 * supports by default, and the user can add or remove entries, for example register HTTP on port 8081 or VLAN on ethertype 0x88a8.
+	 * Please notice an entry only tells the parser which layer to try: the parser may still verify the data (for example that a message
+	 * on an HTTP port really starts with an HTTP request line) before creating the layer.
+	 * Also notice this class isn't thread-safe: entries should be registered before packets are parsed, and not while other threads
+	 * are parsing packets
+	 */
+	class ProtocolRegistry
+	{
+	public:
+
+		/**
+		 * @return The singleton instance of this class
+		 */
+		static ProtocolRegistry& getInstance();
+
+		/**
+		 * Register an application layer protocol on a TCP/UDP port. A port can be registered for several protocols
+		 * @param[in] port The port number
+		 * @param[in] protocol The protocol. Supported values are: ::DNS, ::HTTP (or ::HTTPRequest / ::HTTPResponse), ::SSL, ::SIP
+		 * (or ::SIPRequest / ::SIPResponse), ::Radius, ::GTPv1 and ::VXLAN
+		 * @return True if the port was registered successfully or false if the protocol isn't supported (an error will be printed to log)
+		 */
+		bool registerPort(uint16_t port, ProtocolType protocol);
+
+		/**
+		 * Remove a port registration
+		 * @param[in] port The port number
+		 * @param[in] protocol The protocol to remove from this port. Same values as in registerPort() are supported
+		 * @return True if the protocol is supported or false otherwise (an error will be printed to log)
+		 */
+		bool unregisterPort(uint16_t port, ProtocolType protocol);
+
+		/**
+		 * Check whether a TCP/UDP port is registered for a certain protocol
+		 * @param[in] port The port number
+		 * @param[in] protocol The protocol to check. Same values as in registerPort() are supported
+		 * @return True if the port is registered for this protocol, false otherwise
+		 */
+		inline bool isPortOfProtocol(uint16_t port, ProtocolType protocol) const { return (m_PortTable[port] & getPortProtocolFlag(protocol)) != 0; }
+
+		/**
+		 * Register the protocol carried over a certain ethertype
+		 * @param[in] etherType The ethertype value (in host byte order)
+		 * @param[in] protocol The protocol. Supported values are: ::IPv4, ::IPv6, ::ARP, ::VLAN, ::PPPoESession, ::PPPoEDiscovery, ::MPLS and
+		 * ::PPP_PPTP. Please notice not all layers support all protocols (for example PPP_PPTP is supported only over GRE)
+		 * @return True if the ethertype was registered successfully or false if the protocol isn't supported (an error will be printed to log)
+		 */
+		bool registerEtherType(uint16_t etherType, ProtocolType protocol);
+
+		/**
+		 * Remove the protocol registered on a certain ethertype. Packets with this ethertype will be parsed as PayloadLayer
+		 * @param[in] etherType The ethertype value (in host byte order)
+		 */
+		void unregisterEtherType(uint16_t etherType);
+
+		/**
+		 * @param[in] etherType The ethertype value (in host byte order)
+		 * @return The protocol registered on this ethertype or ::UnknownProtocol if no protocol is registered
+		 */
+		inline ProtocolType getProtocolByEtherType(uint16_t etherType) const { return getProtocolByIndex(m_EtherTypeTable[etherType]); }
+
+		/**
+		 * Register the protocol carried over a certain IP protocol number
+		 * @param[in] ipProtocol The IP protocol number (see ::IPProtocolTypes)
+		 * @param[in] protocol The protocol. Supported values are: ::TCP, ::UDP, ::ICMP, ::GRE, ::IGMP and ::IPv4 (IP-in-IP: the version of the
+		 * encapsulated packet is detected from its data). Please notice IPv6Layer doesn't support ::ICMP and ::IGMP
+		 * @return True if the IP protocol was registered successfully or false if the protocol isn't supported (an error will be printed to log)
+		 */
+		bool registerIPProtocol(uint8_t ipProtocol, ProtocolType protocol);
+
+		/**
+		 * Remove the protocol registered on a certain IP protocol number. Packets with this IP protocol will be parsed as PayloadLayer
+		 * @param[in] ipProtocol The IP protocol number (see ::IPProtocolTypes)
+		 */
+		void unregisterIPProtocol(uint8_t ipProtocol);
+
+		/**
+		 * @param[in] ipProtocol The IP protocol number (see ::IPProtocolTypes)
+		 * @return The protocol registered on this IP protocol number or ::UnknownProtocol if no protocol is registered
+		 */
+		inline ProtocolType getProtocolByIPProtocol(uint8_t ipProtocol) const { return m_IPProtocolTable[ipProtocol]; }
+
+		/**
+		 * Set a classifier which TcpLayer and UdpLayer consult for payloads the port table didn't identify, before parsing them as
+		 * PayloadLayer
+		 * @param[in] classifier The classifier, or NULL to identify protocols by their ports only. The classifier isn't owned by the
+		 * registry and must outlive the parsing of packets
+		 */
+		inline void setPayloadClassifier(PayloadClassifier* classifier) { m_PayloadClassifier = classifier; }
+
+		/**
+		 * @return The classifier set with setPayloadClassifier(), or NULL if there is none
+		 */
+		inline PayloadClassifier* getPayloadClassifier() const { return m_PayloadClassifier; }
+
+		/**
+		 * Remove all user registrations and the payload classifier, and restore the default values of all tables
+		 */
+		void resetToDefaults();
+
+	private:
+
+		enum PortProtocolFlag
+		{
+			PortProtocolDns = 0x01,
+			PortProtocolHttp = 0x02,
+			PortProtocolSsl = 0x04,
+			PortProtocolSip = 0x08,
+			PortProtocolRadius = 0x10,
+			PortProtocolGtp = 0x20,
+			PortProtocolVxlan = 0x40
+		};
+
+		// the value of ethertype table entries which don't have any protocol registered
+		static const uint8_t NoProtocol = 0xff;
+
+		// the port table holds PortProtocolFlag bitmasks. The ethertype table holds the bit index of the protocol (a ProtocolType value
+		// is 1 << index) which keeps it small enough to stay in cache. The IP protocol table is small anyway so it holds the ProtocolType
+		// itself (some of the registrable protocols are composite values, like ::GRE and ::IGMP)
+		uint16_t m_PortTable[65536];
+		uint8_t m_EtherTypeTable[65536];
+		ProtocolType m_IPProtocolTable[256];
+		PayloadClassifier* m_PayloadClassifier;
+
+		ProtocolRegistry();
+
+		// disable copy c'tor and assignment operator
+		ProtocolRegistry(const ProtocolRegistry& other);
+		ProtocolRegistry& operator=(const ProtocolRegistry& other);
+
+		static inline uint16_t getPortProtocolFlag(ProtocolType protocol)
+		{
+			switch (protocol)
+			{
+			case DNS:
+				return PortProtocolDns;
+			case HTTPRequest:
+			case HTTPResponse:
+			case HTTP:
+				return PortProtocolHttp;
+			case SSL:
+				return PortProtocolSsl;
+			case SIPRequest:
+			case SIPResponse:
+			case SIP:
+				return PortProtocolSip;
+			case Radius:
+				return PortProtocolRadius;
+			case GTPv1:
+				return PortProtocolGtp;
+			case VXLAN:
+				return PortProtocolVxlan;
+			default:
+				return 0;
+			}
+		}
+
+		static inline ProtocolType getProtocolByIndex(uint8_t index) { return (index == NoProtocol ? UnknownProtocol : (ProtocolType)((uint64_t)1 << index)); }
+
+		static uint8_t getProtocolIndex(ProtocolType protocol);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_PROTOCOL_REGISTRY */
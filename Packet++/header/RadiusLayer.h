@@ -142,6 +142,18 @@ namespace pcpp
 		 * @return The RadiusAttribute object
 		 */
 		RadiusAttribute build() const;
+
+		/**
+		 * @return The size in bytes of the attribute build() creates, or 0 if the attribute can't be built out of the parameters defined in the c'tor
+		 */
+		size_t getRecordSize() const;
+
+		/**
+		 * Build the RadiusAttribute object into a buffer given by the caller instead of allocating one, for example directly into the packet data
+		 * @param[in] recordBuffer A buffer of at least getRecordSize() bytes
+		 * @return The RadiusAttribute object, which points to recordBuffer, or a logical NULL object if the attribute can't be built
+		 */
+		RadiusAttribute build(uint8_t* recordBuffer) const;
 	};
 
 
@@ -313,6 +325,8 @@ namespace pcpp
 		static bool isDataValid(const uint8_t *udpData, size_t udpDataLen);
 
 	};
+
+	PCPP_LAYER_PROTOCOL_TRAITS(RadiusLayer, Radius);
 }
 
 #endif // PACKETPP_RADIUS_LAYER
@@ -7,6 +7,7 @@
 #else
 #include <sys/time.h>
 #endif
+#include <time.h>
 #include <stddef.h>
 
 /// @file
@@ -210,6 +211,8 @@ namespace pcpp
 	 */
 #define PCPP_MAX_PACKET_SIZE 65536
 
+	class RawPacketPool;
+
 	/**
 	 * @class RawPacket
 	 * This class holds the packet as raw (not parsed) data. The data is held as byte array. In addition to the data itself
@@ -222,12 +225,24 @@ namespace pcpp
 		uint8_t* m_RawData;
 		int m_RawDataLen;
 		int m_FrameLength;
-		timeval m_TimeStamp;
+		timespec m_TimeStamp;
 		bool m_DeleteRawDataAtDestructor;
 		bool m_RawPacketSet;
 		LinkLayerType m_LinkLayerType;
+		RawPacketPool* m_RawDataPool;
+		// the number of bytes of the raw data buffer preceding m_RawData, which can be used for prepending data without moving it
+		size_t m_Headroom;
+		// the reference count of the raw data buffer if it's shared with other instances (see shareRawData()), or NULL
+		struct SharedRawData;
+		SharedRawData* m_SharedData;
 		void init();
 		void copyDataFrom(const RawPacket& other, bool allocateData = true);
+
+		void moveDataFrom(RawPacket& other);
+		// free the raw data buffer, returning it to its pool if it was taken from one
+		void freeRawData();
+		// copy the data to a new buffer with the given headroom and length
+		bool moveToNewBuffer(size_t headroom, size_t newBufferLength);
 	public:
 		/**
 		 * A constructor that receives a pointer to the raw data (allocated elsewhere). This constructor is usually used when packet
@@ -242,6 +257,16 @@ namespace pcpp
 		 */
 		RawPacket(const uint8_t* pRawData, int rawDataLen, timeval timestamp, bool deleteRawDataAtDestructor, LinkLayerType layerType = LINKTYPE_ETHERNET);
 
+		/**
+		 * Same as the c'tor above but with a nanosecond resolution timestamp
+		 * @param[in] pRawData A pointer to the raw data
+		 * @param[in] rawDataLen The raw data length in bytes
+		 * @param[in] timestamp The timestamp packet was received by the NIC, in nanosecond resolution
+		 * @param[in] deleteRawDataAtDestructor An indicator whether raw data pointer should be freed when the instance is freed or not
+		 * @param[in] layerType The link layer type of this raw packet. The default is Ethernet
+		 */
+		RawPacket(const uint8_t* pRawData, int rawDataLen, timespec timestamp, bool deleteRawDataAtDestructor, LinkLayerType layerType = LINKTYPE_ETHERNET);
+
 		/**
 		 * A default constructor that initializes class'es attributes to default value:
 		 * - data pointer is set to NULL
@@ -265,12 +290,29 @@ namespace pcpp
 
 		/**
 		 * Assignment operator overload for this class. When using this operator on an already initialized RawPacket instance,
-		 * the original raw data is freed first. Then the other instance is copied to this instance, the same way the copy constructor works
-		 * @todo free raw data only if deleteRawDataAtDestructor was set to 'true'
+		 * the original raw data is freed first (if deleteRawDataAtDestructor was set to 'true'). Then the other instance is copied to this
+		 * instance, the same way the copy constructor works
 		 * @param[in] other The instance to copy from
 		 */
 		RawPacket& operator=(const RawPacket& other);
 
+#if __cplusplus > 199711L || _MSC_VER >= 1800
+		/**
+		 * A move constructor for this class. The raw data buffer (including a buffer taken from a RawPacketPool) and the
+		 * deleteRawDataAtDestructor flag are taken from the other instance without copying the data. The other instance is left
+		 * empty, as if it was created with the default c'tor
+		 * @param[in] other The instance to move from
+		 */
+		RawPacket(RawPacket&& other);
+
+		/**
+		 * Move assignment operator for this class. The raw data of this instance is freed first (if deleteRawDataAtDestructor was
+		 * set to 'true'), then the other instance is moved to this instance the same way the move constructor works
+		 * @param[in] other The instance to move from
+		 */
+		RawPacket& operator=(RawPacket&& other);
+#endif
+
 		/**
 		 * @return RawPacket object type. Each derived class should return a different value
 		 */
@@ -288,6 +330,87 @@ namespace pcpp
 		 */
 		virtual bool setRawData(const uint8_t* pRawData, int rawDataLen, timeval timestamp, LinkLayerType layerType = LINKTYPE_ETHERNET, int frameLength = -1);
 
+		/**
+		 * Copy raw data into a buffer owned by this instance and set it as the raw data. If a pool is given the buffer is taken from the pool
+		 * and is returned to it when the raw data is freed, otherwise (or if the data is too large for the pool buffers) the buffer is allocated
+		 * on the heap. If data was already set and deleteRawDataAtDestructor was set to 'true' the old data will be freed first. After this call
+		 * deleteRawDataAtDestructor is 'true'
+		 * @param[in] pRawData A pointer to the data to copy
+		 * @param[in] rawDataLen The data length in bytes
+		 * @param[in] timestamp The timestamp packet was received by the NIC
+		 * @param[in] pool The pool to take the buffer from. If NULL the buffer is allocated on the heap
+		 * @param[in] layerType The link layer type for this raw data
+		 * @param[in] frameLength The packet length if it's different from the captured length (see setRawData()). This parameter is optional,
+		 * if not set or set to -1 it is assumed both lengths are equal
+		 * @param[in] headroom The number of bytes to reserve before the data (see reserveHeadroom()). Default value is 0
+		 * @return True if raw data was set successfully, false otherwise
+		 */
+		bool copyRawData(const uint8_t* pRawData, int rawDataLen, timeval timestamp, RawPacketPool* pool, LinkLayerType layerType = LINKTYPE_ETHERNET, int frameLength = -1, size_t headroom = 0);
+
+		/**
+		 * Same as the copyRawData() above but with a nanosecond resolution timestamp
+		 * @param[in] pRawData A pointer to the data to copy
+		 * @param[in] rawDataLen The data length in bytes
+		 * @param[in] timestamp The timestamp packet was received by the NIC, in nanosecond resolution
+		 * @param[in] pool The pool to take the buffer from. If NULL the buffer is allocated on the heap
+		 * @param[in] layerType The link layer type for this raw data
+		 * @param[in] frameLength The packet length if it's different from the captured length. Default value is -1 which means both lengths
+		 * are equal
+		 * @param[in] headroom The number of bytes to reserve before the data. Default value is 0
+		 * @return True if raw data was set successfully, false otherwise
+		 */
+		bool copyRawData(const uint8_t* pRawData, int rawDataLen, timespec timestamp, RawPacketPool* pool, LinkLayerType layerType = LINKTYPE_ETHERNET, int frameLength = -1, size_t headroom = 0);
+
+		/**
+		 * Set raw data which isn't owned by this instance, for example data in a memory-mapped file, without copying it. If data was already
+		 * set and deleteRawDataAtDestructor was set to 'true' the old data will be freed first. After this call deleteRawDataAtDestructor
+		 * is 'false', so the data is never freed by this instance and must stay valid as long as it's used
+		 * @param[in] pRawData A pointer to the data
+		 * @param[in] rawDataLen The data length in bytes
+		 * @param[in] timestamp The timestamp packet was received by the NIC, in nanosecond resolution
+		 * @param[in] layerType The link layer type for this raw data
+		 * @param[in] frameLength The packet length if it's different from the captured length. Default value is -1 which means both lengths
+		 * are equal
+		 * @return True if raw data was set successfully, false otherwise
+		 */
+		bool setExternalRawData(const uint8_t* pRawData, int rawDataLen, timespec timestamp, LinkLayerType layerType = LINKTYPE_ETHERNET, int frameLength = -1);
+
+		/**
+		 * Share the raw data of another instance instead of copying it. The buffer is reference counted and freed (or returned to its pool)
+		 * when the last instance sharing it releases it, so the instances can be used and freed independently. The reference count is atomic,
+		 * so the instances can also be used on different threads (if the buffer was taken from a RawPacketPool, the pool must allow that too).
+		 * Shared data is copy-on-write: appendData(), insertData(), removeData() and reallocateData() first copy the data to a buffer owned
+		 * by the instance they're called on (see unshareRawData()), so the other instances aren't affected. Data written directly through
+		 * getRawData() isn't tracked, so unshareRawData() should be called before writing it.<BR>
+		 * If the other instance doesn't own its data (for example data set with setExternalRawData() or data owned by a capture engine) the
+		 * data is first copied once to a buffer owned by the other instance, which means the data pointer of the other instance changes.
+		 * Raw data of derived classes (such as MBufRawPacket) isn't shared but copied. Please notice the timestamp and link layer type are
+		 * copied as well
+		 * @param[in] other The instance to share the raw data of
+		 * @return True if the data was shared or copied successfully, false otherwise
+		 */
+		bool shareRawData(RawPacket& other);
+
+		/**
+		 * @return True if the raw data buffer is currently shared with other instances (see shareRawData())
+		 */
+		bool isRawDataShared() const;
+
+		/**
+		 * If the raw data is shared with other instances, copy it to a buffer owned by this instance so it can be modified. The headroom of
+		 * the buffer is kept. Please notice the capacity of the shared buffer beyond the data isn't known, so bytes which were available
+		 * after the data before it was shared aren't available anymore unless newBufferLength is given
+		 * @param[in] newBufferLength The buffer length to keep from the beginning of the data, same as in reallocateData(). If it's smaller
+		 * than the data length, the data length is used. Default value is 0
+		 * @return True if the data isn't shared (anymore), false if it couldn't be copied
+		 */
+		bool unshareRawData(size_t newBufferLength = 0);
+
+		/**
+		 * @return The pool the raw data buffer was taken from, or NULL if the buffer wasn't taken from a pool
+		 */
+		inline RawPacketPool* getRawDataPool() const { return m_RawDataPool; }
+
 		/**
 		 * Get raw data pointer
 		 * @return A pointer to the raw data
@@ -319,22 +442,40 @@ namespace pcpp
 		int getFrameLength() const;
 		/**
 		 * Get raw data timestamp
-		 * @return Raw data timestamp
+		 * @return Raw data timestamp, in microsecond resolution
 		 */
         timeval getPacketTimeStamp() const;
 
+		/**
+		 * Get raw data timestamp in the resolution it was set in. Timestamps are kept in nanosecond resolution, so a timestamp set from a
+		 * nanosecond pcap file or by a device using TimestampClock keeps its nanoseconds
+		 * @return Raw data timestamp, in nanosecond resolution
+		 */
+		inline timespec getPacketTimeStampNs() const { return m_TimeStamp; }
+
+		/**
+		 * Set raw data timestamp
+		 * @param[in] timestamp The timestamp to set
+		 */
+		void setPacketTimeStamp(timeval timestamp);
+
+		/**
+		 * Set raw data timestamp in nanosecond resolution
+		 * @param[in] timestamp The timestamp to set
+		 */
+		inline void setPacketTimeStamp(timespec timestamp) { m_TimeStamp = timestamp; }
+
 		/**
 		 * Get an indication whether raw data was already set for this instance.
 		 * @return True if raw data was set for this instance. Raw data can be set using the non-default constructor, using setRawData(), using
 		 * the copy constructor or using the assignment operator. Returns false otherwise, for example: if the instance was created using the
 		 * default constructor or clear() was called
 		 */
-		inline bool isPacketSet() { return m_RawPacketSet; }
+		inline bool isPacketSet() const { return m_RawPacketSet; }
 
 		/**
-		 * Clears all members of this instance, meaning setting raw data to NULL, raw data length to 0, etc. Currently raw data is always freed,
-		 * even if deleteRawDataAtDestructor was set to 'false'
-		 * @todo deleteRawDataAtDestructor was set to 'true', don't free the raw data
+		 * Clears all members of this instance, meaning setting raw data to NULL, raw data length to 0, etc. Raw data is freed only if
+		 * deleteRawDataAtDestructor was set to 'true'
 		 * @todo set timestamp to a default value as well
 		 */
 		virtual void clear();
@@ -351,7 +492,8 @@ namespace pcpp
 		/**
 		 * Insert new data at some index of the current data and shift the remaining old data to the end. This method works without allocating more memory,
 		 * it just copies dataToAppend at the relevant index and shifts the remaining data to the end. This means that the method assumes this memory was
-		 * already allocated by the user. If it isn't the case then this method will cause memory corruption
+		 * already allocated by the user. If it isn't the case then this method will cause memory corruption. If the buffer has enough headroom (see
+		 * reserveHeadroom()) the data before the index is shifted into the headroom instead, and no memory after the data is needed
 		 * @param[in] atIndex The index to insert the new data to
 		 * @param[in] dataToInsert A pointer to the new data to insert
 		 * @param[in] dataToInsertLen Length in bytes of dataToInsert
@@ -359,22 +501,55 @@ namespace pcpp
 		virtual void insertData(int atIndex, const uint8_t* dataToInsert, size_t dataToInsertLen);
 
 		/**
-		 * Remove certain number of bytes from current raw data buffer. All data after the removed bytes will be shifted back
+		 * Remove certain number of bytes from current raw data buffer. All data after the removed bytes will be shifted back. If the buffer has
+		 * headroom (see reserveHeadroom()) and there is less data before the removed bytes than after them, the data before them is shifted
+		 * forward instead and the removed bytes are added to the headroom
 		 * @param[in] atIndex The index to start removing bytes from
 		 * @param[in] numOfBytesToRemove Number of bytes to remove
 		 * @return True if all bytes were removed successfully, or false if atIndex+numOfBytesToRemove is out-of-bounds of the raw data buffer
 		 */
 		virtual bool removeData(int atIndex, size_t numOfBytesToRemove);
 
+		/**
+		 * Truncate the raw data to a certain length while keeping the frame length (the length of the packet on the wire), the same way a
+		 * capture with a snapshot length does. Writing the packet to a file afterwards records the truncated data and the original length.
+		 * The bytes are removed with removeData(), so the method works with all kinds of raw packets
+		 * @param[in] capturedLength The new raw data length. If the raw data isn't longer than that nothing is changed
+		 * @return True if the raw data was truncated or was already short enough, false if capturedLength is negative or removing the bytes failed
+		 */
+		bool truncate(int capturedLength);
+
 		/**
 		 * Re-allocate raw packet buffer meaning add size to it without losing the current packet data. This method allocates the required buffer size as instructed
 		 * by the use and then copies the raw data from the current allocated buffer to the new one. This method can become useful if the user wants to insert or
 		 * append data to the raw data, and the previous allocated buffer is too small, so the user wants to allocate a larger buffer and get RawPacket instance to
-		 * point to it
+		 * point to it. If the raw data was taken from a RawPacketPool and the pool buffer is already large enough, no memory is allocated. Otherwise
+		 * the new buffer is taken from the same pool, or from the heap if it's too large for the pool
 		 * @param[in] newBufferLength The new buffer length as required by the user. The method is responsible to allocate the memory
 		 * @return True if data was reallocated successfully, false otherwise
 		 */
 		virtual bool reallocateData(size_t newBufferLength);
+
+		/**
+		 * @return The number of bytes available in the raw data buffer before the beginning of the data. Data of up to this size can be
+		 * inserted with insertData() without moving the data that follows the insertion point
+		 */
+		virtual inline size_t getHeadroom() const { return m_Headroom; }
+
+		/**
+		 * Make sure the raw data buffer has a certain number of bytes available before the beginning of the data (headroom). Once headroom
+		 * is reserved, insertData() uses it instead of shifting the data after the insertion point towards the end of the buffer, so
+		 * prepending headers (for example for encapsulation) costs only the size of the data before the insertion point. In the same manner
+		 * removeData() returns the removed bytes to the headroom when they're closer to the beginning of the data. If the buffer doesn't have
+		 * enough headroom the data is copied once to a new buffer (taken from the same RawPacketPool if it was taken from one), which is
+		 * owned by this instance. Please notice headroom is a property of the current buffer: it's reset when new raw data is set and it isn't
+		 * kept when the instance is copied
+		 * @param[in] headroom The number of bytes to reserve before the data
+		 * @param[in] newBufferLength The buffer length to keep from the beginning of the data, same as in reallocateData(). If it's smaller
+		 * than the data length, the data length is used. Default value is 0
+		 * @return True if the headroom was reserved successfully, false otherwise
+		 */
+		virtual bool reserveHeadroom(size_t headroom, size_t newBufferLength = 0);
 	};
 
 } // namespace pcpp
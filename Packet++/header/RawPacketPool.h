@@ -0,0 +1,155 @@
+#ifndef PACKETPP_RAW_PACKET_POOL
+#define PACKETPP_RAW_PACKET_POOL
+
+#include "PacketMemoryAllocator.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <pthread.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class RawPacketPool
+	 * A pool of fixed-size packet buffers that can be used as RawPacket data instead of allocating a new buffer on the heap for
+	 * every packet (see RawPacket#copyRawData()). The pool holds two buffer classes: small buffers (2KB by default, enough for any
+	 * standard Ethernet frame) and large buffers (9KB by default, enough for jumbo frames). Buffers are carved out of slabs which
+	 * are allocated on demand, a slab at a time, and are never returned to the heap until the pool is destructed. When a RawPacket
+	 * whose data was taken from the pool frees its data (on destruction, clear() or when new data is set) the buffer goes back to
+	 * the pool and is reused for the next packet.
+	 * Capture devices and file readers can be attached to a pool (for example PcapLiveDevice#setRawPacketPool() and
+	 * IFileReaderDevice#setRawPacketPool()) so captured packets are copied into pool buffers.
+	 * The slabs are allocated from a PacketMemoryAllocator, the heap by default. Backing the pool with HugePagePacketMemoryAllocator puts
+	 * the buffers of all packets copied into it on huge pages.
+	 * The pool is thread-safe: buffers can be taken in a capture thread and returned in a worker thread. Please notice the pool must
+	 * outlive all raw packets using its buffers
+	 */
+	class RawPacketPool
+	{
+	public:
+
+		/**
+		 * The default size in bytes of small buffers
+		 */
+		static const size_t DefaultSmallBufferSize = 2048;
+
+		/**
+		 * The default size in bytes of large buffers
+		 */
+		static const size_t DefaultLargeBufferSize = 9216;
+
+		/**
+		 * The default number of buffers allocated at once whenever a buffer class runs out of free buffers
+		 */
+		static const size_t DefaultBuffersPerSlab = 256;
+
+		/**
+		 * A c'tor for this class. No memory is allocated until the first buffer is requested
+		 * @param[in] smallBufferSize The size in bytes of small buffers. Default value is DefaultSmallBufferSize
+		 * @param[in] largeBufferSize The size in bytes of large buffers. Default value is DefaultLargeBufferSize. Data larger than this
+		 * size can't be stored in pool buffers
+		 * @param[in] buffersPerSlab The number of buffers allocated at once. Default value is DefaultBuffersPerSlab
+		 * @param[in] allocator The allocator slabs are allocated from, which must outlive the pool, or NULL for allocating them on the heap.
+		 * Default value is NULL
+		 */
+		RawPacketPool(size_t smallBufferSize = DefaultSmallBufferSize, size_t largeBufferSize = DefaultLargeBufferSize, size_t buffersPerSlab = DefaultBuffersPerSlab,
+				PacketMemoryAllocator* allocator = NULL);
+
+		/**
+		 * A d'tor for this class. Frees all slabs. Please notice all buffers taken from the pool become invalid
+		 */
+		~RawPacketPool();
+
+		/**
+		 * Take a buffer from the pool
+		 * @param[in] size The requested buffer size in bytes
+		 * @return A pointer to a buffer of at least the requested size, or NULL if size is larger than the large buffer size or a slab can't
+		 * be allocated
+		 */
+		uint8_t* allocate(size_t size);
+
+		/**
+		 * Return a buffer to the pool
+		 * @param[in] buffer A pointer to a buffer previously returned by allocate() of this pool
+		 */
+		void release(uint8_t* buffer);
+
+		/**
+		 * @param[in] buffer A pointer to a buffer previously returned by allocate() of this pool
+		 * @return The actual size in bytes of the buffer, which may be larger than the size requested when it was allocated
+		 */
+		size_t getBufferSize(const uint8_t* buffer) const;
+
+		/**
+		 * @return The size in bytes of small buffers
+		 */
+		inline size_t getSmallBufferSize() const { return m_BufferClasses[SmallBuffer].bufferSize; }
+
+		/**
+		 * @return The size in bytes of large buffers, which is also the maximum size that can be allocated from the pool
+		 */
+		inline size_t getLargeBufferSize() const { return m_BufferClasses[LargeBuffer].bufferSize; }
+
+		/**
+		 * @return The number of buffers currently taken from the pool and not returned yet
+		 */
+		size_t getNumOfBuffersInUse();
+
+		/**
+		 * @return The number of free buffers currently held by the pool
+		 */
+		size_t getNumOfFreeBuffers();
+
+	private:
+
+		enum BufferClassType
+		{
+			SmallBuffer = 0,
+			LargeBuffer = 1,
+			NumOfBufferClasses = 2
+		};
+
+		// written before each buffer. Its size keeps the buffers 16-byte aligned
+		union BufferHeader
+		{
+			struct
+			{
+				RawPacketPool* pool;
+				union BufferHeader* nextFree;
+				uint32_t bufferClass;
+			} info;
+			uint8_t alignment[32];
+		};
+
+		struct BufferClass
+		{
+			size_t bufferSize;
+			BufferHeader* freeList;
+			size_t numOfFree;
+			size_t numOfInUse;
+		};
+
+		BufferClass m_BufferClasses[NumOfBufferClasses];
+		size_t m_BuffersPerSlab;
+		PacketMemoryAllocator* m_Allocator;
+		// the slabs and their sizes, which differ between the buffer classes
+		std::vector<std::pair<uint8_t*, size_t> > m_Slabs;
+		pthread_mutex_t m_Mutex;
+
+		bool allocateSlab(BufferClassType bufferClass);
+
+		// disable copy c'tor and assignment operator
+		RawPacketPool(const RawPacketPool& other);
+		RawPacketPool& operator=(const RawPacketPool& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_RAW_PACKET_POOL */
@@ -0,0 +1,94 @@
+#ifndef PACKETPP_RAW_PACKET_QUEUE
+#define PACKETPP_RAW_PACKET_QUEUE
+
+#include "RawPacket.h"
+#include "SPSCQueue.h"
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct QueuedRawPacket
+	 * A raw packet copied into a RawPacketQueue element. The buffer belongs to the element and is reused for the following packets
+	 * written into it
+	 */
+	struct QueuedRawPacket
+	{
+		/** The packet data */
+		uint8_t* data;
+		/** The size of the buffer data points to, which may be larger than the packet */
+		size_t bufferSize;
+		/** The length of the packet data */
+		int dataLen;
+		/** The original length of the packet on the wire */
+		int frameLength;
+		/** The packet timestamp */
+		timespec timestamp;
+		/** The link layer type of the packet */
+		LinkLayerType linkType;
+
+		/**
+		 * A c'tor for this struct, with no buffer
+		 */
+		QueuedRawPacket() : data(NULL), bufferSize(0), dataLen(0), frameLength(0), timestamp(), linkType(LINKTYPE_ETHERNET) {}
+
+		/**
+		 * A d'tor for this struct, frees the buffer
+		 */
+		~QueuedRawPacket() { delete [] data; }
+
+	private:
+		// elements are written in place, never copied
+		QueuedRawPacket(const QueuedRawPacket& other);
+		QueuedRawPacket& operator=(const QueuedRawPacket& other);
+	};
+
+
+	/**
+	 * @class RawPacketQueue
+	 * An SPSCQueue of packet copies, for handing packets from a producer thread to a worker thread when the producer has to free or reuse
+	 * its packets right away (for example DPDK mbufs). The producer copies a packet with enqueueCopy() and the consumer reads it in place
+	 * with front() or frontBulk(), for example by pointing a RawPacket to the queued data with RawPacket#setExternalRawData(), and releases
+	 * it with pop() or popBulk()
+	 */
+	class RawPacketQueue : public SPSCQueue<QueuedRawPacket>
+	{
+	public:
+
+		/**
+		 * The minimum size of the element buffers, so most packets don't require reallocating them
+		 */
+		static const size_t MinBufferSize = 2048;
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] capacity The maximum number of packets in the queue. It's rounded up to a power of 2
+		 */
+		RawPacketQueue(size_t capacity) : SPSCQueue<QueuedRawPacket>(capacity) {}
+
+		/**
+		 * Copy a packet into the queue and make it visible to the consumer. Should be called only by the producer. When the queue is full
+		 * the producer either drops the packet or sleeps with sleepBriefly() until the consumer makes room
+		 * @param[in] rawPacket The packet to copy. The queue doesn't keep a pointer to it
+		 * @param[in] dropWhenFull If true the packet is dropped when the queue is full, otherwise the producer waits for room
+		 * @param[in] running A flag the owner clears when the consumer stops. A producer waiting for room drops the packet once it's cleared
+		 * @return True if the packet was queued, false if it was dropped
+		 */
+		bool enqueueCopy(RawPacket* rawPacket, bool dropWhenFull, const volatile bool* running);
+
+		/**
+		 * Sleep for a short while (50 microseconds, or 1 millisecond on Windows). Used by producers waiting for room in a full queue and by
+		 * idle consumers
+		 */
+		static void sleepBriefly();
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_RAW_PACKET_QUEUE */
@@ -0,0 +1,234 @@
+#ifndef PACKETPP_RAW_PACKET_SLAB_VECTOR
+#define PACKETPP_RAW_PACKET_SLAB_VECTOR
+
+#include "RawPacket.h"
+#include "PacketMemoryAllocator.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class RawPacketSlabVector
+	 * A vector of raw packets meant for holding a large number of packets in memory (for example a whole pcap file loaded for replay).
+	 * Unlike RawPacketVector (a PointerVector of RawPacket), which holds a separate heap allocation for every RawPacket object and another
+	 * one for its data, this vector places the RawPacket objects contiguously in blocks of a fixed number of packets, and copies the packet
+	 * data back-to-back into large slabs. Adding a packet therefore usually costs no allocation at all, and memory isn't wasted on allocator
+	 * overhead and partially used buffers.
+	 * The vector has the same iteration interface as RawPacketVector (iterating yields RawPacket pointers), and it can be used with
+	 * IFileReaderDevice#getNextPackets(), PcapLiveDevice#startCapture() and PcapLiveDevice#sendPackets().
+	 * The packets are owned by the vector: the raw packets and their data are valid until the vector is cleared or destructed, and their
+	 * addresses don't change when more packets are added. A packet which is modified in a way that requires more space (see
+	 * RawPacket#reallocateData()) is moved to a new heap buffer which the packet owns.
+	 * For capturing into memory the slabs and RawPacket blocks can be allocated in advance (reserve(), reserveData()), so adding packets
+	 * never reaches the allocator, and a memory limit can be set: packets which need more memory than the limit allows are dropped and
+	 * counted instead of being added. The slabs and RawPacket blocks are allocated from a PacketMemoryAllocator, the heap by default;
+	 * large in-memory capture buffers can be put on huge pages with HugePagePacketMemoryAllocator
+	 */
+	class RawPacketSlabVector
+	{
+	public:
+
+		/**
+		 * Iterator object that is used for iterating all packets in the vector
+		 */
+		typedef std::vector<RawPacket*>::iterator VectorIterator;
+
+		/**
+		 * Const iterator object that is used for iterating all packets in a constant vector
+		 */
+		typedef std::vector<RawPacket*>::const_iterator ConstVectorIterator;
+
+		/**
+		 * The default size in bytes of the slabs packet data is copied to
+		 */
+		static const size_t DefaultSlabSize = 1048576;
+
+		/**
+		 * The default number of RawPacket objects allocated at once
+		 */
+		static const size_t DefaultPacketsPerBlock = 1024;
+
+		/**
+		 * A c'tor for this class. No memory is allocated until the first packet is added
+		 * @param[in] slabSize The size in bytes of the slabs packet data is copied to. A packet larger than this size gets a slab of its
+		 * own. Default value is DefaultSlabSize
+		 * @param[in] packetsPerBlock The number of RawPacket objects allocated at once. Default value is DefaultPacketsPerBlock
+		 * @param[in] allocator The allocator slabs and RawPacket blocks are allocated from, which must outlive the vector, or NULL for
+		 * allocating them on the heap. Default value is NULL
+		 */
+		RawPacketSlabVector(size_t slabSize = DefaultSlabSize, size_t packetsPerBlock = DefaultPacketsPerBlock, PacketMemoryAllocator* allocator = NULL);
+
+		/**
+		 * A d'tor for this class. Frees all packets and all memory held by the vector
+		 */
+		~RawPacketSlabVector();
+
+		/**
+		 * Copy raw data to the vector as a new packet
+		 * @param[in] pRawData A pointer to the raw data to copy
+		 * @param[in] rawDataLen The raw data length in bytes
+		 * @param[in] timestamp The timestamp of the packet
+		 * @param[in] layerType The link layer type of the packet. Default value is Ethernet
+		 * @param[in] frameLength The packet length if it's different from the captured length (see RawPacket#setRawData()). Default value
+		 * is -1 which means the packet length equals rawDataLen
+		 * @return A pointer to the new packet, or NULL if the data is invalid or the memory for it can't be allocated
+		 */
+		RawPacket* pushBack(const uint8_t* pRawData, int rawDataLen, timeval timestamp, LinkLayerType layerType = LINKTYPE_ETHERNET, int frameLength = -1);
+
+		/**
+		 * Same as the pushBack() above but with a nanosecond resolution timestamp
+		 * @param[in] pRawData A pointer to the raw data to copy
+		 * @param[in] rawDataLen The raw data length in bytes
+		 * @param[in] timestamp The timestamp of the packet, in nanosecond resolution
+		 * @param[in] layerType The link layer type of the packet. Default value is Ethernet
+		 * @param[in] frameLength The packet length if it's different from the captured length. Default value is -1 which means the packet
+		 * length equals rawDataLen
+		 * @return A pointer to the new packet, or NULL if the data is invalid or the memory for it can't be allocated
+		 */
+		RawPacket* pushBack(const uint8_t* pRawData, int rawDataLen, timespec timestamp, LinkLayerType layerType = LINKTYPE_ETHERNET, int frameLength = -1);
+
+		/**
+		 * Copy a raw packet to the vector. The data, timestamp, link layer type and frame length are copied
+		 * @param[in] rawPacket The packet to copy
+		 * @return A pointer to the new packet, or NULL if rawPacket has no data set
+		 */
+		RawPacket* pushBack(const RawPacket& rawPacket);
+
+		/**
+		 * Allocate space for the RawPacket objects of the given number of packets in advance. Packet data is still allocated a slab at a time
+		 * @param[in] numOfPackets The number of packets to reserve space for
+		 */
+		void reserve(size_t numOfPackets);
+
+		/**
+		 * Allocate data slabs in advance, so the given number of bytes of packet data can be added without allocating memory (packets
+		 * larger than the slab size still get a slab of their own). Slabs count towards the memory limit, but reserving isn't limited by it
+		 * @param[in] numOfBytes The number of bytes of packet data to reserve space for
+		 */
+		void reserveData(size_t numOfBytes);
+
+		/**
+		 * Set the maximum number of bytes the vector may allocate for RawPacket objects and packet data (see getMemoryUsage()). A packet
+		 * which needs a new block, slab or large slab beyond this limit is dropped: pushBack() returns NULL and the drop counter is
+		 * incremented. Memory which is already allocated (for example by reserve(), reserveData() or before clear()) is used regardless of
+		 * the limit
+		 * @param[in] maxMemoryUsage The limit in bytes, or 0 for no limit (which is the default)
+		 */
+		inline void setMemoryLimit(size_t maxMemoryUsage) { m_MemoryLimit = maxMemoryUsage; }
+
+		/**
+		 * @return The maximum number of bytes the vector may allocate, or 0 if there's no limit
+		 */
+		inline size_t getMemoryLimit() const { return m_MemoryLimit; }
+
+		/**
+		 * @return The number of packets dropped because of the memory limit since the vector was created or last cleared
+		 */
+		inline uint64_t getNumOfDroppedPackets() const { return m_NumOfDroppedPackets; }
+
+		/**
+		 * Remove all packets from the vector and reset the drop counter. The RawPacket blocks and data slabs are kept (except for slabs
+		 * dedicated to packets larger than the slab size) and are reused for packets added later
+		 */
+		void clear();
+
+		/**
+		 * @return The number of packets in the vector
+		 */
+		inline size_t size() const { return m_Packets.size(); }
+
+		/**
+		 * @return An iterator object pointing to the first packet in the vector
+		 */
+		inline VectorIterator begin() { return m_Packets.begin(); }
+
+		/**
+		 * @return A const iterator object pointing to the first packet in the vector
+		 */
+		inline ConstVectorIterator begin() const { return m_Packets.begin(); }
+
+		/**
+		 * @return An iterator object pointing to the last packet in the vector
+		 */
+		inline VectorIterator end() { return m_Packets.end(); }
+
+		/**
+		 * @return A const iterator object pointing to the last packet in the vector
+		 */
+		inline ConstVectorIterator end() const { return m_Packets.end(); }
+
+		/**
+		 * @return A pointer to the first packet in the vector
+		 */
+		inline RawPacket* front() { return m_Packets.front(); }
+
+		/**
+		 * @return A pointer to the last packet in the vector
+		 */
+		inline RawPacket* back() { return m_Packets.back(); }
+
+		/**
+		 * Get a packet by its index
+		 * @param[in] index The index of the packet
+		 * @return A pointer to the packet
+		 */
+		inline RawPacket* at(int index) { return m_Packets.at(index); }
+
+		/**
+		 * Get a packet by its index
+		 * @param[in] index The index of the packet
+		 * @return A const pointer to the packet
+		 */
+		inline const RawPacket* at(int index) const { return m_Packets.at(index); }
+
+		/**
+		 * @return The total number of packet data bytes copied to the vector
+		 */
+		inline size_t getDataSize() const { return m_DataSize; }
+
+		/**
+		 * @return The number of bytes currently allocated by the vector for RawPacket objects and packet data (not including the index
+		 * of packet pointers)
+		 */
+		size_t getMemoryUsage() const;
+
+	private:
+
+		size_t m_SlabSize;
+		size_t m_PacketsPerBlock;
+		PacketMemoryAllocator* m_Allocator;
+		std::vector<RawPacket*> m_Packets;
+		std::vector<uint8_t*> m_PacketBlocks;
+		std::vector<uint8_t*> m_Slabs;
+		// the slab data is currently copied to and the offset of its first free byte
+		size_t m_CurSlab;
+		size_t m_CurSlabOffset;
+		// slabs of packets larger than m_SlabSize and their sizes, freed on clear()
+		std::vector<std::pair<uint8_t*, size_t> > m_LargeSlabs;
+		size_t m_LargeSlabsSize;
+		size_t m_DataSize;
+		size_t m_MemoryLimit;
+		uint64_t m_NumOfDroppedPackets;
+
+		bool allocatePacketBlock();
+		bool allocateSlab();
+		uint8_t* allocateData(size_t size);
+		size_t getAllocationSize(size_t dataSize) const;
+
+		// disable copy c'tor and assignment operator
+		RawPacketSlabVector(const RawPacketSlabVector& other);
+		RawPacketSlabVector& operator=(const RawPacketSlabVector& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_RAW_PACKET_SLAB_VECTOR */
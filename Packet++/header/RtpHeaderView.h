@@ -0,0 +1,281 @@
+#ifndef PACKETPP_RTP_HEADER_VIEW
+#define PACKETPP_RTP_HEADER_VIEW
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * The RTCP packet types (RFC 3550 section 12.1)
+	 */
+	enum RtcpPacketType
+	{
+		/** Sender report */
+		RtcpSenderReport = 200,
+		/** Receiver report */
+		RtcpReceiverReport = 201,
+		/** Source description */
+		RtcpSourceDescription = 202,
+		/** Goodbye */
+		RtcpGoodbye = 203,
+		/** Application-defined */
+		RtcpApplicationDefined = 204
+	};
+
+
+	/**
+	 * @class RtpHeaderView
+	 * A read-only view of the header of an RTP packet (RFC 3550 section 5.1), usually the payload of a UDP packet. RTP has no well-known
+	 * port, so it isn't parsed as a Layer: the view is applied to the UDP payload of packets known to be RTP, for example packets sent to a
+	 * media port announced in SDP. The view only points into the data, so it's valid as long as the data is
+	 */
+	class RtpHeaderView
+	{
+	public:
+		/**
+		 * The length of the fixed RTP header, without CSRC identifiers and extensions
+		 */
+		static const size_t FixedHeaderLength = 12;
+
+		/**
+		 * A c'tor for this class which creates an empty view
+		 */
+		RtpHeaderView() : m_Data(NULL), m_HeaderLength(0), m_PayloadLength(0) {}
+
+		/**
+		 * Parse an RTP header. The data is accepted if it has version 2, its header (including CSRC identifiers and the header extension)
+		 * and padding fit in the data, and its payload type isn't in the range of RTCP packet types, which RTP and RTCP sharing a port
+		 * (RFC 5761) are told apart by
+		 * @param[in] data A pointer to the RTP header
+		 * @param[in] dataLen The length of the data in bytes
+		 * @return True if the data is a valid RTP packet, false otherwise
+		 */
+		bool parse(const uint8_t* data, size_t dataLen);
+
+		/**
+		 * @return True if the padding bit is set
+		 */
+		inline bool hasPadding() const { return (m_Data[0] & 0x20) != 0; }
+
+		/**
+		 * @return True if the extension bit is set
+		 */
+		inline bool hasExtension() const { return (m_Data[0] & 0x10) != 0; }
+
+		/**
+		 * @return The number of CSRC identifiers
+		 */
+		inline uint8_t getCsrcCount() const { return m_Data[0] & 0x0f; }
+
+		/**
+		 * @return True if the marker bit is set
+		 */
+		inline bool getMarker() const { return (m_Data[1] & 0x80) != 0; }
+
+		/**
+		 * @return The payload type
+		 */
+		inline uint8_t getPayloadType() const { return m_Data[1] & 0x7f; }
+
+		/**
+		 * @return The sequence number
+		 */
+		inline uint16_t getSequenceNumber() const { return (uint16_t)((m_Data[2] << 8) | m_Data[3]); }
+
+		/**
+		 * @return The RTP timestamp
+		 */
+		inline uint32_t getTimestamp() const { return readUInt32(m_Data + 4); }
+
+		/**
+		 * @return The synchronization source (SSRC) identifier
+		 */
+		inline uint32_t getSsrc() const { return readUInt32(m_Data + 8); }
+
+		/**
+		 * @param[in] index The index of the CSRC identifier, which must be lower than getCsrcCount()
+		 * @return The contributing source (CSRC) identifier
+		 */
+		inline uint32_t getCsrc(size_t index) const { return readUInt32(m_Data + FixedHeaderLength + index * 4); }
+
+		/**
+		 * @return The length of the header in bytes, including the CSRC identifiers and the header extension
+		 */
+		inline size_t getHeaderLength() const { return m_HeaderLength; }
+
+		/**
+		 * @return A pointer to the payload
+		 */
+		inline const uint8_t* getPayload() const { return m_Data + m_HeaderLength; }
+
+		/**
+		 * @return The length of the payload in bytes, not including padding
+		 */
+		inline size_t getPayloadLength() const { return m_PayloadLength; }
+
+		/**
+		 * Read a 32-bit big-endian number
+		 * @param[in] data A pointer to the number
+		 * @return The number in host byte order
+		 */
+		static inline uint32_t readUInt32(const uint8_t* data) { return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3]; }
+
+	private:
+		const uint8_t* m_Data;
+		size_t m_HeaderLength;
+		size_t m_PayloadLength;
+	};
+
+
+	/**
+	 * @struct RtcpSenderInfo
+	 * The sender information of an RTCP sender report (RFC 3550 section 6.4.1)
+	 */
+	struct RtcpSenderInfo
+	{
+		/** The NTP timestamp: seconds since 1900 in the high 32 bits and the fraction of a second in the low 32 bits */
+		uint64_t ntpTimestamp;
+		/** The RTP timestamp corresponding to the NTP timestamp */
+		uint32_t rtpTimestamp;
+		/** The number of RTP packets the sender sent */
+		uint32_t packetCount;
+		/** The number of payload bytes the sender sent */
+		uint32_t octetCount;
+	};
+
+
+	/**
+	 * @struct RtcpReportBlock
+	 * A reception report block of an RTCP sender or receiver report (RFC 3550 section 6.4.1), describing the reception of one source
+	 */
+	struct RtcpReportBlock
+	{
+		/** The SSRC of the source the block reports on */
+		uint32_t ssrc;
+		/** The fraction of packets lost since the previous report, in units of 1/256 */
+		uint8_t fractionLost;
+		/** The cumulative number of packets lost, which may be negative when duplicates were received */
+		int32_t cumulativeLost;
+		/** The extended highest sequence number received */
+		uint32_t extendedHighestSequence;
+		/** The interarrival jitter in RTP timestamp units */
+		uint32_t jitter;
+		/** The middle 32 bits of the NTP timestamp of the last sender report received from the source, or 0 */
+		uint32_t lastSenderReport;
+		/** The delay since the last sender report was received, in units of 1/65536 seconds */
+		uint32_t delaySinceLastSenderReport;
+	};
+
+
+	/**
+	 * @class RtcpPacketView
+	 * A read-only view of an RTCP packet (RFC 3550 section 6). RTCP packets are sent in compound packets, several RTCP packets in one UDP
+	 * payload: parse() points the view at the first one and next() moves it to the following ones. Sender and receiver reports are read
+	 * with getSenderInfo() and getReportBlock(), other packet types only by their common header. The view only points into the data, so
+	 * it's valid as long as the data is
+	 */
+	class RtcpPacketView
+	{
+	public:
+		/**
+		 * The length of the common RTCP header
+		 */
+		static const size_t CommonHeaderLength = 4;
+
+		/**
+		 * A c'tor for this class which creates an empty view
+		 */
+		RtcpPacketView() : m_Data(NULL), m_DataLen(0), m_Offset(0), m_PacketLength(0) {}
+
+		/**
+		 * Point the view at the first RTCP packet of a compound packet
+		 * @param[in] data A pointer to the compound packet, usually a UDP payload
+		 * @param[in] dataLen The length of the data in bytes
+		 * @return True if the data starts with a valid RTCP packet: version 2, a packet type in the range 192-223 (RFC 5761 section 4) and a
+		 * length which fits in the data, false otherwise
+		 */
+		bool parse(const uint8_t* data, size_t dataLen);
+
+		/**
+		 * Check whether a UDP payload is RTCP rather than RTP, for RTP and RTCP sharing a port (RFC 5761 section 4). Only the packet type
+		 * is checked, the packet is validated by parse()
+		 * @param[in] data A pointer to the payload
+		 * @param[in] dataLen The length of the data in bytes
+		 * @return True if the second byte of the data, the RTCP packet type, is in the range 192-223
+		 */
+		static bool isRtcp(const uint8_t* data, size_t dataLen);
+
+		/**
+		 * Move the view to the next RTCP packet of the compound packet
+		 * @return True if there is a next packet and it's valid, false otherwise
+		 */
+		bool next();
+
+		/**
+		 * @return The packet type, usually one of ::RtcpPacketType
+		 */
+		inline uint8_t getPacketType() const { return m_Data[m_Offset + 1]; }
+
+		/**
+		 * @return The count field of the header: the number of report blocks of sender and receiver reports, the number of sources of
+		 * source descriptions and goodbyes, and the subtype of application-defined packets
+		 */
+		inline uint8_t getCount() const { return m_Data[m_Offset] & 0x1f; }
+
+		/**
+		 * @return The length of the packet in bytes, including its header and padding
+		 */
+		inline size_t getPacketLength() const { return m_PacketLength; }
+
+		/**
+		 * @return A pointer to the packet
+		 */
+		inline const uint8_t* getPacketData() const { return m_Data + m_Offset; }
+
+		/**
+		 * @return The SSRC of the sender of the packet (the first source for source descriptions and goodbyes), or 0 if the packet is too
+		 * short to contain one
+		 */
+		uint32_t getSsrc() const;
+
+		/**
+		 * Read the sender information of a sender report
+		 * @param[out] senderInfo The sender information
+		 * @return True if the packet is a sender report long enough to contain the sender information, false otherwise
+		 */
+		bool getSenderInfo(RtcpSenderInfo& senderInfo) const;
+
+		/**
+		 * @return The number of report blocks of a sender or receiver report which fit in the packet, or 0 for other packet types
+		 */
+		size_t getNumOfReportBlocks() const;
+
+		/**
+		 * Read a report block of a sender or receiver report
+		 * @param[in] index The index of the block
+		 * @param[out] block The block
+		 * @return True if the block was read, false if the packet isn't a sender or receiver report or the index is out of range
+		 */
+		bool getReportBlock(size_t index, RtcpReportBlock& block) const;
+
+	private:
+		const uint8_t* m_Data;
+		size_t m_DataLen;
+		size_t m_Offset;
+		size_t m_PacketLength;
+
+		bool parseAt(size_t offset);
+		size_t getReportBlocksOffset() const;
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_RTP_HEADER_VIEW */
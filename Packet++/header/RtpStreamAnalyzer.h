@@ -0,0 +1,370 @@
+#ifndef PACKETPP_RTP_STREAM_ANALYZER
+#define PACKETPP_RTP_STREAM_ANALYZER
+
+#include "RtpHeaderView.h"
+#include "SipDialogTracker.h"
+#include "FlowTable.h"
+#include "PacketView.h"
+#include "RawPacket.h"
+#include <vector>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct RtpStreamStats
+	 * The quality statistics of an RTP stream: the packets one source (SSRC) sent from one address and port to another, as measured where
+	 * they were captured. The loss, reordering and jitter are computed as a receiver does (RFC 3550 appendix A)
+	 */
+	struct RtpStreamStats
+	{
+		/** The IP version (4 or 6) */
+		uint8_t ipVersion;
+		/** The source IP address. For IPv4 only the first 4 bytes are used */
+		uint8_t srcIP[16];
+		/** The destination IP address. For IPv4 only the first 4 bytes are used */
+		uint8_t dstIP[16];
+		/** The source UDP port */
+		uint16_t srcPort;
+		/** The destination UDP port */
+		uint16_t dstPort;
+		/** The synchronization source (SSRC) identifier */
+		uint32_t ssrc;
+		/** The payload type of the first packet. Packets of other payload types (e.g DTMF events or comfort noise) are counted, but
+		 * don't affect the jitter */
+		uint8_t payloadType;
+		/** The encoding name of the payload type (e.g "PCMU"), or NULL if it isn't known */
+		const char* encodingName;
+		/** The RTP clock rate of the payload type, or 0 if it isn't known, in which case the jitter isn't computed */
+		uint32_t clockRate;
+		/** The context given when the media endpoint of the stream was registered, or NULL */
+		void* context;
+		/** The timestamp of the first packet */
+		timespec firstPacketTime;
+		/** The timestamp of the last packet */
+		timespec lastPacketTime;
+		/** The number of packets received, including duplicates */
+		uint64_t packets;
+		/** The number of payload bytes received */
+		uint64_t payloadBytes;
+		/** The number of packets expected by the sequence numbers */
+		uint64_t expectedPackets;
+		/** The number of packets lost: #expectedPackets - #packets, which is negative when more duplicates than lost packets were received */
+		int64_t lostPackets;
+		/** The number of packets received after a packet with a higher sequence number (late, reordered or duplicated packets) */
+		uint64_t reorderedPackets;
+		/** The number of times the sequence numbers jumped so far the sequence was restarted, e.g because the source restarted */
+		uint32_t sequenceRestarts;
+		/** The interarrival jitter in milliseconds */
+		double jitterMs;
+		/** The highest interarrival jitter seen, in milliseconds */
+		double maxJitterMs;
+		/** The number of RTCP sender reports of the source */
+		uint32_t senderReports;
+		/** True if an RTCP report of the receiver of the stream was seen, in which case the remote fields are set */
+		bool hasRemoteReport;
+		/** The fraction of packets lost (0 to 1) reported by the receiver in its last report */
+		double remoteFractionLost;
+		/** The cumulative number of packets lost reported by the receiver in its last report */
+		int32_t remoteCumulativeLost;
+		/** The interarrival jitter in milliseconds reported by the receiver in its last report, or 0 if the clock rate isn't known */
+		double remoteJitterMs;
+		/** A mean opinion score (1 to 4.5) estimated from the loss and jitter with the E-model (ITU-T G.107). It assumes the stream is voice,
+		 * and is meaningless for other media */
+		double mos;
+	};
+
+
+	/**
+	 * @struct RtpStreamAnalyzerConfiguration
+	 * The limits and timeouts of RtpStreamAnalyzer
+	 */
+	struct RtpStreamAnalyzerConfiguration
+	{
+		/** The maximum number of streams analyzed at once. When a new stream arrives the least recently active one is ended */
+		size_t maxStreams;
+		/** The number of seconds without packets after which a stream ends */
+		uint32_t streamTimeout;
+		/** The maximum number of registered media endpoints. When more are registered the least recently active one is removed */
+		size_t maxEndpoints;
+		/** The number of seconds without packets after which a registered endpoint is removed, or 0 if endpoints are kept until they're
+		 * unregistered */
+		uint32_t endpointTimeout;
+		/** The number of streams (and as many endpoints) to allocate room for up front, so no memory is allocated while they're analyzed */
+		size_t initialCapacity;
+		/** If true, UDP packets which look like RTP are analyzed even if neither of their endpoints was registered. A stream of such packets
+		 * is analyzed only after 2 packets with consecutive sequence numbers were seen (RFC 3550 appendix A.1) */
+		bool analyzeUnregisteredStreams;
+		/** The one-way delay in milliseconds assumed for the MOS estimate, which the jitter buffer delay (twice the jitter) is added to */
+		double assumedDelayMs;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] maxStreams The value of #maxStreams. Default value is 100000
+		 * @param[in] streamTimeout The value of #streamTimeout. Default value is 60
+		 * @param[in] endpointTimeout The value of #endpointTimeout. Default value is 3600
+		 * @param[in] analyzeUnregisteredStreams The value of #analyzeUnregisteredStreams. Default value is false
+		 */
+		RtpStreamAnalyzerConfiguration(size_t maxStreams = 100000, uint32_t streamTimeout = 60, uint32_t endpointTimeout = 3600,
+				bool analyzeUnregisteredStreams = false) :
+			maxStreams(maxStreams), streamTimeout(streamTimeout), maxEndpoints(maxStreams), endpointTimeout(endpointTimeout), initialCapacity(0),
+			analyzeUnregisteredStreams(analyzeUnregisteredStreams), assumedDelayMs(50) {}
+	};
+
+
+	/**
+	 * The results of RtpStreamAnalyzer#processPacket()
+	 */
+	enum RtpPacketResult
+	{
+		/** The packet isn't RTP or RTCP of a registered endpoint (or, if unregistered streams are analyzed, doesn't look like RTP) */
+		RtpPacketIgnored,
+		/** The packet was analyzed as an RTP packet */
+		RtpPacketAnalyzed,
+		/** The packet was analyzed as an RTCP compound packet */
+		RtcpPacketAnalyzed
+	};
+
+
+	/**
+	 * @class RtpStreamAnalyzer
+	 * Measures the quality of RTP streams, usually the media of SIP calls. Media endpoints are registered from the SDP of the signalling
+	 * (see registerSdp()), which also gives the clock rates of dynamic payload types, and UDP packets sent to or from a registered endpoint
+	 * are analyzed as RTP, or as RTCP when their packet type is in the RTCP range (RFC 5761), whether RTCP is sent to the port following
+	 * the RTP port or shares it. A stream is identified by its addresses, ports and SSRC, and its state is kept in a FlowTable, so
+	 * analyzing a packet is two lookups and no memory is allocated once the tables reached their size (see RtpStreamAnalyzerConfiguration#initialCapacity). For each stream
+	 * it computes:
+	 * - The expected, lost and reordered packets from the extended sequence numbers, which are validated as described in RFC 3550
+	 *   appendix A.1, so a restarted source doesn't count as a huge loss
+	 * - The interarrival jitter of RFC 3550 appendix A.8, from the packet timestamps and the RTP timestamps
+	 * - The loss and jitter the receiver reported in RTCP, if it sends reports
+	 * - A MOS estimate computed with the E-model from the loss, the jitter and the codec of the payload type
+	 *
+	 * Streams end when they time out, when they're evicted to make room for new streams and when flush() is called, and their statistics
+	 * are passed to a callback. The time is taken from the packet timestamps, so the timeouts work the same for live traffic and for
+	 * capture files.<BR>
+	 * An analyzer isn't thread-safe. To analyze traffic on several worker threads, give each worker its own analyzer and send each packet
+	 * to the worker chosen by getShardHash(), which sends the RTP and RTCP packets of both directions of a call leg to the same worker.
+	 * The endpoints have to be registered in every analyzer (each on its own thread), since the peer of an endpoint isn't known when its
+	 * SDP is seen
+	 */
+	class RtpStreamAnalyzer
+	{
+	public:
+		/**
+		 * The maximum number of payload types kept for a registered endpoint. Payload types beyond it use their static clock rate
+		 */
+		static const size_t MaxPayloadTypesPerEndpoint = 8;
+
+		/**
+		 * @typedef OnRtpStreamEnd
+		 * A callback invoked when a stream ends
+		 * @param[in] stream The statistics of the stream
+		 * @param[in] userCookie The cookie given in the c'tor
+		 */
+		typedef void (*OnRtpStreamEnd)(const RtpStreamStats& stream, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] onStreamEnd A callback invoked when a stream ends. Default value is NULL (no callback)
+		 * @param[in] userCookie A pointer passed to the callback. Default value is NULL
+		 * @param[in] config The limits and timeouts of the analyzer
+		 */
+		RtpStreamAnalyzer(OnRtpStreamEnd onStreamEnd = NULL, void* userCookie = NULL, const RtpStreamAnalyzerConfiguration& config = RtpStreamAnalyzerConfiguration());
+
+		/**
+		 * Register a media endpoint, e.g one of the endpoints SipDialogTracker collected for a dialog. Packets of its payload types use the
+		 * clock rates of the static payload types (RFC 3551), and the jitter of streams with dynamic payload types isn't computed unless
+		 * the endpoint is registered with registerSdp(). The endpoint timeout counts from the current time of the analyzer, so when
+		 * endpoints are registered before packets were analyzed, call setCurrentTime() with the time of the signalling first
+		 * @param[in] endpoint The address and port the media is sent to
+		 * @param[in] context A pointer which is set in the statistics of the streams of the endpoint, e.g the call the endpoint belongs to.
+		 * Default value is NULL
+		 * @return True if the endpoint was registered or was already registered (its context is then replaced and its payload types are
+		 * reset), false if its IP version isn't 4 or 6 or its port is 0
+		 */
+		bool registerEndpoint(const SipMediaEndpoint& endpoint, void* context = NULL);
+
+		/**
+		 * Register the media endpoints of an SDP message: the connection address (c=) and port of each media description (m=) which isn't
+		 * sent over TCP, with the payload types of the media description and the clock rates of their "rtpmap" attributes
+		 * @param[in] sdpLayer The SDP message, e.g the body of a SIP INVITE or 200 OK
+		 * @param[in] context A pointer which is set in the statistics of the streams of the endpoints. Default value is NULL
+		 * @return The number of endpoints registered
+		 */
+		size_t registerSdp(SdpLayer* sdpLayer, void* context = NULL);
+
+		/**
+		 * Remove a registered endpoint, e.g when the call it belongs to ended. Streams of the endpoint which are analyzed keep being
+		 * analyzed until they end
+		 * @param[in] endpoint The endpoint
+		 * @return True if the endpoint was registered, false otherwise
+		 */
+		bool unregisterEndpoint(const SipMediaEndpoint& endpoint);
+
+		/**
+		 * Analyze a packet. The packet timestamp is the current time of the analyzer
+		 * @param[in] rawPacket The packet
+		 * @return The way the packet was analyzed
+		 */
+		RtpPacketResult processPacket(RawPacket* rawPacket);
+
+		/**
+		 * Analyze a packet whose headers were already extracted
+		 * @param[in] view The packet headers, as extracted by FlowKeyExtractor
+		 * @param[in] data The packet data the view refers to
+		 * @param[in] dataLen The length of the data
+		 * @param[in] timestamp The packet timestamp, the current time of the analyzer
+		 * @return The way the packet was analyzed
+		 */
+		RtpPacketResult processPacket(const PacketView& view, const uint8_t* data, size_t dataLen, const timespec& timestamp);
+
+		/**
+		 * Advance the current time of the analyzer and end the streams and remove the endpoints whose timeout passed, as processing a
+		 * packet does. Useful when no packets arrive for a while
+		 * @param[in] currentTime The current time in seconds. Times earlier than the current time of the analyzer are ignored
+		 */
+		void setCurrentTime(time_t currentTime);
+
+		/**
+		 * Get the current statistics of all streams, e.g for periodic reports of long calls
+		 * @param[out] streams The vector to append the statistics to, in no particular order
+		 */
+		void getStreams(std::vector<RtpStreamStats>& streams) const;
+
+		/**
+		 * End all streams, invoking the callback for each of them. Registered endpoints are kept
+		 */
+		void flush();
+
+		/**
+		 * @return The number of streams currently analyzed
+		 */
+		inline size_t getNumOfStreams() const { return m_Streams.size(); }
+
+		/**
+		 * @return The number of registered endpoints
+		 */
+		inline size_t getNumOfEndpoints() const { return m_Endpoints.size(); }
+
+		/**
+		 * A hash for distributing packets to several analyzers. It's the same for the RTP and RTCP packets of both directions between two
+		 * endpoints, so all of them reach the same analyzer
+		 * @param[in] view The packet headers
+		 * @return The hash
+		 */
+		static uint32_t getShardHash(const PacketView& view);
+
+		/**
+		 * Estimate the mean opinion score of a voice stream with the E-model (ITU-T G.107), using the default values of all parameters but
+		 * the delay and the equipment impairment
+		 * @param[in] lossPercent The percentage of lost packets
+		 * @param[in] delayMs The one-way delay in milliseconds, including the jitter buffer delay
+		 * @param[in] equipmentImpairment The equipment impairment factor (Ie) of the codec, e.g 0 for G.711 and 11 for G.729 (ITU-T G.113)
+		 * @param[in] packetLossRobustness The packet-loss robustness factor (Bpl) of the codec, e.g 25.1 for G.711 with packet loss
+		 * concealment and 19 for G.729
+		 * @return The score, from 1 to 4.5
+		 */
+		static double estimateMos(double lossPercent, double delayMs, double equipmentImpairment, double packetLossRobustness);
+
+	private:
+		struct PayloadFormat
+		{
+			uint8_t payloadType;
+			// the index of the encoding in the known encodings, or -1
+			int8_t encodingIndex;
+			uint32_t clockRate;
+		};
+
+		// the padding is zeroed, since keys are hashed by their bytes
+		struct EndpointKey
+		{
+			uint8_t ipAddress[16];
+			uint16_t port;
+			uint8_t ipVersion;
+			uint8_t reserved;
+
+			bool operator==(const EndpointKey& other) const { return memcmp(this, &other, sizeof(EndpointKey)) == 0; }
+		};
+
+		struct EndpointInfo
+		{
+			void* context;
+			size_t numOfPayloadFormats;
+			PayloadFormat payloadFormats[MaxPayloadTypesPerEndpoint];
+		};
+
+		struct StreamKey
+		{
+			uint8_t srcIP[16];
+			uint8_t dstIP[16];
+			uint16_t srcPort;
+			uint16_t dstPort;
+			uint32_t ssrc;
+			uint8_t ipVersion;
+			uint8_t reserved[3];
+
+			bool operator==(const StreamKey& other) const { return memcmp(this, &other, sizeof(StreamKey)) == 0; }
+		};
+
+		// the statistics and the state of the sequence number and jitter computations (RFC 3550 appendix A)
+		struct StreamState
+		{
+			RtpStreamStats stats;
+			uint16_t maxSeq;
+			uint32_t cycles;
+			uint32_t baseSeq;
+			uint32_t badSeq;
+			uint32_t probation;
+			uint64_t received;
+			// the expected and received packets of the sequences before the last restart
+			uint64_t priorExpected;
+			uint64_t priorReceived;
+			uint32_t lastTransit;
+			bool hasTransit;
+			// the jitter in RTP timestamp units, times 16
+			uint32_t jitter;
+			double equipmentImpairment;
+			double packetLossRobustness;
+		};
+
+		typedef FlowTable<EndpointKey, EndpointInfo> EndpointTable;
+		typedef FlowTable<StreamKey, StreamState> StreamTable;
+
+		OnRtpStreamEnd m_OnStreamEnd;
+		void* m_UserCookie;
+		RtpStreamAnalyzerConfiguration m_Config;
+		EndpointTable m_Endpoints;
+		StreamTable m_Streams;
+
+		static void makeEndpointKey(uint8_t ipVersion, const uint8_t* ipAddress, uint16_t port, EndpointKey& key);
+		static void makeStreamKey(const PacketView& view, uint16_t srcPort, uint16_t dstPort, uint32_t ssrc, bool reversed, StreamKey& key);
+		static void onStreamRemoved(const StreamKey& key, StreamState& stream, FlowRemovalReason reason, void* userCookie);
+		static void initSequence(StreamState& stream, uint16_t seq);
+		static bool updateSequence(StreamState& stream, uint16_t seq);
+		void finalizeStats(const StreamState& stream, RtpStreamStats& stats) const;
+		void endStream(StreamState& stream);
+
+		EndpointInfo* findEndpoint(uint8_t ipVersion, const uint8_t* ipAddress, uint16_t port);
+		void initStream(StreamState& stream, const StreamKey& key, const RtpHeaderView& rtp, const EndpointInfo* endpoint, const timespec& timestamp);
+		RtpPacketResult processRtp(const PacketView& view, const uint8_t* payload, size_t payloadLen, const timespec& timestamp);
+		RtpPacketResult processRtcp(const PacketView& view, const uint8_t* payload, size_t payloadLen);
+
+		// disable copy c'tor and assignment operator
+		RtpStreamAnalyzer(const RtpStreamAnalyzer& other);
+		RtpStreamAnalyzer& operator=(const RtpStreamAnalyzer& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_RTP_STREAM_ANALYZER */
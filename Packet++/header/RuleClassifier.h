@@ -0,0 +1,174 @@
+#ifndef PACKETPP_RULE_CLASSIFIER
+#define PACKETPP_RULE_CLASSIFIER
+
+#include "PacketView.h"
+#include "IpAddress.h"
+#include "QuiescentStateReclaimer.h"
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/** The maximum number of rules sharing the same source prefix which are matched one by one, larger groups are split by destination prefix */
+#define PCPP_RULE_CLASSIFIER_LINEAR_THRESHOLD 16
+
+/** The number of rules in each port and protocol bitmap chunk of a group sharing the same source and destination prefixes */
+#define PCPP_RULE_CLASSIFIER_BITMAP_CHUNK_SIZE 512
+
+	/**
+	 * @struct ClassifierRule
+	 * A rule of a RuleClassifier: a source and destination IPv4 prefix, source and destination port ranges and an IP protocol. A packet matches
+	 * the rule if all of the fields match. A rule with port ranges other than 0-65535 matches only TCP and UDP packets which aren't fragments
+	 */
+	struct ClassifierRule
+	{
+		/** The value RuleClassifier#classify() returns for packets this rule is the best match of */
+		uint32_t id;
+		/** The priority of the rule. When several rules match a packet the one with the highest priority wins, and among rules with the same priority the one added first */
+		int priority;
+		/** The source address prefix. Bits beyond #srcPrefixLen are ignored */
+		IPv4Address srcAddress;
+		/** The length of the source prefix (0-32). 0 matches any source address, including IPv6 ones */
+		uint8_t srcPrefixLen;
+		/** The destination address prefix. Bits beyond #dstPrefixLen are ignored */
+		IPv4Address dstAddress;
+		/** The length of the destination prefix (0-32). 0 matches any destination address, including IPv6 ones */
+		uint8_t dstPrefixLen;
+		/** The lowest source port matched */
+		uint16_t srcPortFrom;
+		/** The highest source port matched */
+		uint16_t srcPortTo;
+		/** The lowest destination port matched */
+		uint16_t dstPortFrom;
+		/** The highest destination port matched */
+		uint16_t dstPortTo;
+		/** The IP protocol matched (see ::IPProtocolTypes), or 0 to match any protocol */
+		uint8_t protocol;
+
+		/**
+		 * A c'tor for this struct which creates a rule with id and priority 0 matching all IPv4 and IPv6 packets
+		 */
+		ClassifierRule();
+	};
+
+
+	/**
+	 * @class RuleClassifier
+	 * A packet classifier for large sets of 5-tuple rules (such as blocklists of hundreds of thousands of prefixes), which finds the best
+	 * matching rule of a packet in time which depends on the number of prefixes containing its addresses rather than on the number of rules.
+	 * Rules are compiled into a multi-bit trie of source prefixes (controlled prefix expansion with strides of 16 and 4 bits), each source
+	 * prefix holding the rules which use it. Source prefixes with many rules split them further with a trie of destination prefixes, and
+	 * destination prefixes with many rules match the port ranges and protocol with bitmaps of elementary intervals, so a lookup is a few
+	 * binary searches and a bitwise "and" instead of a scan of the rules.<BR>
+	 * The compiled rules are immutable. setRules() builds a new rule set aside and publishes it with an atomic pointer swap, so classify() never
+	 * takes a lock and packets are classified with either the old or the new rules while rules are replaced. Old rule sets are freed with
+	 * quiescent-state based reclamation (see QuiescentStateReclaimer): threads which call classify() while rules may be replaced register with registerReader() and call
+	 * quiescentState() when they don't hold a reference to the rules, for example between bursts of packets. A rule set is freed once all
+	 * registered readers passed a quiescent state after it was replaced.<BR>
+	 * Only IPv4 prefixes are supported, IPv6 packets match only rules whose source and destination prefix lengths are 0. Non-IP packets
+	 * don't match any rule
+	 */
+	class RuleClassifier
+	{
+	public:
+		/**
+		 * The value classify() returns for packets which don't match any rule
+		 */
+		static const uint32_t NoMatch = 0xffffffff;
+
+		/**
+		 * A c'tor for this class which creates a classifier without rules
+		 */
+		RuleClassifier();
+
+		/**
+		 * A d'tor for this class. Frees the current and all replaced rule sets, so it must not be called while other threads classify packets
+		 */
+		~RuleClassifier();
+
+		/**
+		 * Compile a set of rules and replace the current rules with it. Packets being classified by other threads while this method runs are
+		 * classified with the old rules. Rule sets replaced earlier are freed if all registered readers passed a quiescent state since
+		 * @param[in] rules The rules. They aren't referenced after this method returns
+		 * @return True if the rules were compiled and replaced the current ones, false if a rule is invalid (a prefix length larger than 32
+		 * or a port range whose lower end is higher than its upper end). In that case the current rules are kept
+		 */
+		bool setRules(const std::vector<ClassifierRule>& rules);
+
+		/**
+		 * Remove all rules, same as calling setRules() with an empty vector
+		 */
+		void clearRules();
+
+		/**
+		 * @return The number of rules in the current rule set
+		 */
+		size_t getNumOfRules() const;
+
+		/**
+		 * Find the best matching rule of a packet
+		 * @param[in] view The headers of the packet (see FlowKeyExtractor#extract())
+		 * @return The id of the matching rule with the highest priority, or #NoMatch if no rule matches the packet
+		 */
+		uint32_t classify(const PacketView& view) const;
+
+		/**
+		 * Find the best matching rule of a set of packets
+		 * @param[in] views The headers of the packets
+		 * @param[in] count The number of packets
+		 * @param[out] ruleIds An array of at least count entries the ids of the matching rules (or #NoMatch) are written to
+		 */
+		void classifyBatch(const PacketView* views, size_t count, uint32_t* ruleIds) const;
+
+		/**
+		 * Register the calling thread as a reader, a thread which classifies packets while rules may be replaced. Rule sets replaced after a
+		 * reader registered aren't freed until it calls quiescentState() or unregisterReader()
+		 * @return A reader ID to pass to quiescentState() and unregisterReader(), or -1 if #PCPP_QUIESCENT_STATE_MAX_READERS readers are
+		 * already registered
+		 */
+		int registerReader();
+
+		/**
+		 * Unregister a reader. The reader must not classify packets after this method is called unless it registers again
+		 * @param[in] readerId The reader ID registerReader() returned
+		 */
+		void unregisterReader(int readerId);
+
+		/**
+		 * Announce a reader doesn't hold a reference to the rules: it isn't in the middle of a classify() or classifyBatch() call. This
+		 * method is cheap (an atomic load and store) and should be called regularly, for example after each burst of packets
+		 * @param[in] readerId The reader ID registerReader() returned
+		 */
+		void quiescentState(int readerId);
+
+		/**
+		 * Free the replaced rule sets all registered readers are done with. setRules() does this too, so calling it is only needed to free
+		 * memory sooner
+		 * @return The number of rule sets which are still waiting for readers to pass a quiescent state
+		 */
+		size_t reclaim();
+
+	private:
+		struct RuleSet;
+
+		RuleSet* volatile m_RuleSet;
+		QuiescentStateReclaimer<RuleSet*> m_Reclaimer;
+		pthread_mutex_t m_Mutex;
+
+		// disable copy c'tor and assignment operator
+		RuleClassifier(const RuleClassifier& other);
+		RuleClassifier& operator=(const RuleClassifier& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_RULE_CLASSIFIER */
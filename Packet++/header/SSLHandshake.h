@@ -87,7 +87,7 @@ public:
 	 *  @param[in] name Cipher-suite name (e.g "TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA")
 	 *  @return A cipher-suite instance matching this name or NULL if name not found
 	 */
-	static SSLCipherSuite* getCipherSuiteByName(std::string name);
+	static SSLCipherSuite* getCipherSuiteByName(const std::string& name);
 
 private:
 	uint16_t m_Id;
@@ -95,7 +95,8 @@ private:
 	SSLAuthenticationAlgorithm m_AuthAlg;
 	SSLSymetricEncryptionAlgorithm m_SymKeyAlg;
 	SSLHashingAlgorithm m_MACAlg;
-	std::string m_Name;
+	// a string literal rather than a std::string, so the hundreds of static cipher-suite instances don't allocate memory at startup
+	const char* m_Name;
 };
 
 
@@ -184,6 +185,77 @@ public:
 };
 
 
+/**
+ * @class SSLExtensionIterator
+ * Iterates over the extensions of a client-hello or server-hello message directly on the message data, without creating
+ * SSLExtension objects or allocating memory. The iteration stops at the first extension which doesn't fit in the data, so the data
+ * returned by getData() is always complete. Since it only points into the packet data, the iterator is valid as long as the packet is.
+ * Usage:
+ * @code
+ * for (SSLExtensionIterator iter = clientHello->getExtensionIterator(); iter.isValid(); iter.next())
+ *     handleExtension(iter.getTypeAsInt(), iter.getData(), iter.getLength());
+ * @endcode
+ */
+class SSLExtensionIterator
+{
+public:
+	/**
+	 * A c'tor for this class which creates an iterator with no extensions
+	 */
+	SSLExtensionIterator() : m_Pos(NULL), m_End(NULL) {}
+
+	/**
+	 * A c'tor for this class
+	 * @param[in] extensionsData A pointer to the first extension (right after the "extensions length" field)
+	 * @param[in] extensionsDataLen The length of the extensions data in bytes
+	 */
+	SSLExtensionIterator(const uint8_t* extensionsData, size_t extensionsDataLen);
+
+	/**
+	 * @return True if the iterator points to an extension, false if the iteration ended
+	 */
+	inline bool isValid() const { return m_Pos != NULL; }
+
+	/**
+	 * Move to the next extension
+	 */
+	void next();
+
+	/**
+	 * @return The type of the current extension as enum
+	 */
+	SSLExtensionType getType() const;
+
+	/**
+	 * @return The type of the current extension as a numeric value
+	 */
+	inline uint16_t getTypeAsInt() const { return (uint16_t)((m_Pos[0] << 8) | m_Pos[1]); }
+
+	/**
+	 * @return The length of the current extension data in bytes (not including the type and length fields)
+	 */
+	inline uint16_t getLength() const { return (uint16_t)((m_Pos[2] << 8) | m_Pos[3]); }
+
+	/**
+	 * @return A pointer to the data of the current extension
+	 */
+	inline const uint8_t* getData() const { return m_Pos + 2*sizeof(uint16_t); }
+
+	/**
+	 * Move to the first extension of a certain type, starting from the current one
+	 * @param[in] type The numeric type of the extension
+	 * @return True if such extension was found, false if the iteration ended
+	 */
+	bool findType(uint16_t type);
+
+private:
+	const uint8_t* m_Pos;
+	const uint8_t* m_End;
+
+	void validate();
+};
+
+
 /**
  * @class SSLx509Certificate
  * Represents a x509v3 certificate. the SSLCertificateMessage class returns an instance of this class as the certificate.
@@ -232,6 +304,69 @@ private:
 class SSLHandshakeLayer;
 
 
+/**
+ * @class SSLHandshakeMessageIterator
+ * Iterates over the handshake messages in the data of a SSLHandshakeLayer without creating SSLHandshakeMessage objects or allocating
+ * memory. Messages are split the same way SSLHandshakeLayer splits them: the message length is taken from the message header and
+ * limited to the remaining data, and a message of unknown type (which may be encrypted) is assumed to span all of the remaining data.
+ * Use SSLHandshakeLayer#getMessageIterator() to iterate over the messages of a layer
+ */
+class SSLHandshakeMessageIterator
+{
+public:
+	/**
+	 * A c'tor for this class
+	 * @param[in] data A pointer to the first handshake message (right after the record layer header)
+	 * @param[in] dataLen The length of the handshake messages data in bytes
+	 */
+	SSLHandshakeMessageIterator(const uint8_t* data, size_t dataLen);
+
+	/**
+	 * @return True if the iterator points to a message, false if the iteration ended
+	 */
+	inline bool isValid() const { return m_Remaining >= sizeof(ssl_tls_handshake_layer); }
+
+	/**
+	 * Move to the next message
+	 */
+	inline void next() { m_Pos += m_MessageLen; m_Remaining -= m_MessageLen; updateMessageLength(); }
+
+	/**
+	 * @return The type of the current message as written in its header. Unlike SSLUnknownMessage#getHandshakeType(), unknown types
+	 * (which may be the first byte of an encrypted message) aren't replaced with ::SSL_HANDSHAKE_UNKNOWN
+	 */
+	inline SSLHandshakeType getType() const { return (SSLHandshakeType)m_Pos[0]; }
+
+	/**
+	 * @return A pointer to the current message, starting at its header
+	 */
+	inline const uint8_t* getData() const { return m_Pos; }
+
+	/**
+	 * @return The length of the current message in bytes, including its header. As in SSLHandshakeMessage#getMessageLength(), it's
+	 * limited to the data in the layer
+	 */
+	inline size_t getLength() const { return m_MessageLen; }
+
+	/**
+	 * @return The length of the data from the current message to the end of the layer
+	 */
+	inline size_t getRemainingLength() const { return m_Remaining; }
+
+	/**
+	 * @return True if the layer contains the entire current message
+	 */
+	bool isComplete() const;
+
+private:
+	const uint8_t* m_Pos;
+	size_t m_Remaining;
+	size_t m_MessageLen;
+
+	void updateMessageLength();
+};
+
+
 /**
  * @class SSLHandshakeMessage
  * A base class for SSL/TLS handshake messages. This is an abstract class and cannot be instantiated. SSL/TLS handshake
@@ -400,13 +535,21 @@ public:
 	template<class TExtension>
 	TExtension* getExtensionOfType();
 
+	/**
+	 * @return An iterator over the extensions of this message which reads them directly from the message data. Unlike the methods
+	 * above, it doesn't create extension objects
+	 */
+	SSLExtensionIterator getExtensionIterator() const;
+
 	// implement abstract methods
 
 	std::string toString();
 
 private:
 	PointerVector<SSLExtension> m_ExtensionList;
+	bool m_ExtensionsParsed;
 
+	void parseExtensions();
 };
 
 
@@ -507,12 +650,21 @@ public:
 	template<class TExtension>
 	TExtension* getExtensionOfType();
 
+	/**
+	 * @return An iterator over the extensions of this message which reads them directly from the message data. Unlike the methods
+	 * above, it doesn't create extension objects
+	 */
+	SSLExtensionIterator getExtensionIterator() const;
+
 	// implement abstract methods
 
 	std::string toString();
 
 private:
 	PointerVector<SSLExtension> m_ExtensionList;
+	bool m_ExtensionsParsed;
+
+	void parseExtensions();
 };
 
 
@@ -913,9 +1065,185 @@ public:
 	std::string toString();
 };
 
+/**
+ * @class SSLClientHelloFingerprint
+ * The client-hello fields JA3 fingerprints are calculated from (the version, cipher-suites, extensions, supported groups and EC point
+ * formats) and the server name. The fields are read directly from the message data, without creating a SSLHandshakeLayer, message or
+ * extension objects, which makes it a cheap way to fingerprint many connections. The object only points into the data, so it's valid as
+ * long as the data is
+ */
+class SSLClientHelloFingerprint
+{
+public:
+	/**
+	 * A c'tor for this class which creates an empty fingerprint
+	 */
+	SSLClientHelloFingerprint();
+
+	/**
+	 * Read the fields of a client-hello message
+	 * @param[in] data A pointer to the message, starting at the handshake message header
+	 * @param[in] dataLen The length of the data in bytes
+	 * @return True if the data is a client-hello message which contains at least all fields up to the extensions, false otherwise
+	 */
+	bool parse(const uint8_t* data, size_t dataLen);
+
+	/**
+	 * Read the fields of a client-hello message which is the first message of a SSL/TLS handshake record, for example the TCP payload
+	 * of the first client packet of a connection
+	 * @param[in] data A pointer to the record, starting at the record layer header
+	 * @param[in] dataLen The length of the data in bytes
+	 * @return True if the data is a handshake record whose first message is a client-hello message, false otherwise
+	 */
+	bool parseRecord(const uint8_t* data, size_t dataLen);
+
+	/**
+	 * @return The handshake version of the message
+	 */
+	inline uint16_t getVersion() const { return m_Version; }
+
+	/**
+	 * @return The number of cipher-suites in the message
+	 */
+	inline size_t getCipherSuiteCount() const { return m_CipherSuitesLen / sizeof(uint16_t); }
+
+	/**
+	 * @param[in] index The index of the cipher-suite, which must be lower than getCipherSuiteCount()
+	 * @return The ID of the cipher-suite
+	 */
+	inline uint16_t getCipherSuiteID(size_t index) const { return (uint16_t)((m_CipherSuites[2*index] << 8) | m_CipherSuites[2*index + 1]); }
+
+	/**
+	 * @return An iterator over the extensions of the message
+	 */
+	inline SSLExtensionIterator getExtensionIterator() const { return SSLExtensionIterator(m_Extensions, m_ExtensionsLen); }
+
+	/**
+	 * @return The number of groups in the supported groups (elliptic curves) extension, or 0 if the message doesn't have one
+	 */
+	inline size_t getSupportedGroupCount() const { return m_SupportedGroupsLen / sizeof(uint16_t); }
+
+	/**
+	 * @param[in] index The index of the group, which must be lower than getSupportedGroupCount()
+	 * @return The group ID
+	 */
+	inline uint16_t getSupportedGroup(size_t index) const { return (uint16_t)((m_SupportedGroups[2*index] << 8) | m_SupportedGroups[2*index + 1]); }
+
+	/**
+	 * @return The number of formats in the EC point formats extension, or 0 if the message doesn't have one
+	 */
+	inline size_t getECPointFormatCount() const { return m_ECPointFormatsLen; }
+
+	/**
+	 * @param[in] index The index of the format, which must be lower than getECPointFormatCount()
+	 * @return The format value
+	 */
+	inline uint8_t getECPointFormat(size_t index) const { return m_ECPointFormats[index]; }
+
+	/**
+	 * @return A pointer to the first host name in the server name indication extension (which isn't null-terminated), or NULL if the
+	 * message doesn't have one
+	 */
+	inline const char* getServerName() const { return m_ServerName; }
+
+	/**
+	 * @return The length of the host name returned by getServerName()
+	 */
+	inline size_t getServerNameLength() const { return m_ServerNameLen; }
+
+	/**
+	 * Build the JA3 string of the message: the version, cipher-suites, extensions, supported groups and EC point formats as decimal
+	 * numbers, with GREASE values left out (for example: "771,4865-4866-49195,0-11-10-35,29-23-24,0"). The JA3 fingerprint is the MD5
+	 * hash of this string. The string is built into an existing object, so reusing the same object for many messages saves allocations
+	 * @param[out] result The string to build into. Its previous content is cleared
+	 */
+	void toJA3String(std::string& result) const;
+
+	/**
+	 * @param[in] value A cipher-suite, extension type or group ID
+	 * @return True if the value is one of the GREASE values (RFC 8701) clients add to make sure servers ignore unknown values
+	 */
+	static inline bool isGreaseValue(uint16_t value) { return (value & 0x0f0f) == 0x0a0a && (value >> 8) == (value & 0xff); }
+
+private:
+	uint16_t m_Version;
+	const uint8_t* m_CipherSuites;
+	size_t m_CipherSuitesLen;
+	const uint8_t* m_Extensions;
+	size_t m_ExtensionsLen;
+	const uint8_t* m_SupportedGroups;
+	size_t m_SupportedGroupsLen;
+	const uint8_t* m_ECPointFormats;
+	size_t m_ECPointFormatsLen;
+	const char* m_ServerName;
+	size_t m_ServerNameLen;
+};
+
+
+/**
+ * @class SSLServerHelloFingerprint
+ * The server-hello fields JA3S fingerprints are calculated from (the version, cipher-suite and extensions), read directly from the
+ * message data like SSLClientHelloFingerprint does. The object only points into the data, so it's valid as long as the data is
+ */
+class SSLServerHelloFingerprint
+{
+public:
+	/**
+	 * A c'tor for this class which creates an empty fingerprint
+	 */
+	SSLServerHelloFingerprint();
+
+	/**
+	 * Read the fields of a server-hello message
+	 * @param[in] data A pointer to the message, starting at the handshake message header
+	 * @param[in] dataLen The length of the data in bytes
+	 * @return True if the data is a server-hello message which contains at least all fields up to the extensions, false otherwise
+	 */
+	bool parse(const uint8_t* data, size_t dataLen);
+
+	/**
+	 * Read the fields of a server-hello message which is the first message of a SSL/TLS handshake record
+	 * @param[in] data A pointer to the record, starting at the record layer header
+	 * @param[in] dataLen The length of the data in bytes
+	 * @return True if the data is a handshake record whose first message is a server-hello message, false otherwise
+	 */
+	bool parseRecord(const uint8_t* data, size_t dataLen);
+
+	/**
+	 * @return The handshake version of the message
+	 */
+	inline uint16_t getVersion() const { return m_Version; }
+
+	/**
+	 * @return The ID of the cipher-suite the server selected
+	 */
+	inline uint16_t getCipherSuiteID() const { return m_CipherSuite; }
+
+	/**
+	 * @return An iterator over the extensions of the message
+	 */
+	inline SSLExtensionIterator getExtensionIterator() const { return SSLExtensionIterator(m_Extensions, m_ExtensionsLen); }
+
+	/**
+	 * Build the JA3S string of the message: the version, cipher-suite and extensions as decimal numbers (for example:
+	 * "771,49199,65281-0-11-35"). The JA3S fingerprint is the MD5 hash of this string
+	 * @param[out] result The string to build into. Its previous content is cleared
+	 */
+	void toJA3SString(std::string& result) const;
+
+private:
+	uint16_t m_Version;
+	uint16_t m_CipherSuite;
+	const uint8_t* m_Extensions;
+	size_t m_ExtensionsLen;
+};
+
+
 template<class TExtension>
 TExtension* SSLClientHelloMessage::getExtensionOfType()
 {
+	parseExtensions();
+
 	size_t vecSize = m_ExtensionList.size();
 	for (size_t i = 0; i < vecSize; i++)
 	{
@@ -930,6 +1258,8 @@ TExtension* SSLClientHelloMessage::getExtensionOfType()
 template<class TExtension>
 TExtension* SSLServerHelloMessage::getExtensionOfType()
 {
+	parseExtensions();
+
 	size_t vecSize = m_ExtensionList.size();
 	for (size_t i = 0; i < vecSize; i++)
 	{
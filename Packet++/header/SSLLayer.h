@@ -216,7 +216,8 @@ namespace pcpp
 		static std::string sslVersionToString(SSLVersion ver);
 
 		/**
-		 * @return A pointer to a map containing all TCP ports recognize as SSL/TLS
+		 * @return A pointer to a map containing the TCP ports recognized as SSL/TLS by default. Ports registered at runtime appear only in
+		 * ProtocolRegistry, so use ProtocolRegistry#isPortOfProtocol() for checking whether a port is recognized as SSL/TLS
 		 */
 		static const std::map<uint16_t, bool>* getSSLPortMap();
 
@@ -256,6 +257,8 @@ namespace pcpp
 
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(SSLLayer, SSL);
+
 
 	/**
 	 * @class SSLHandshakeLayer
@@ -349,6 +352,13 @@ namespace pcpp
 		template<class THandshakeMessage>
 		THandshakeMessage* getNextHandshakeMessageOfType(SSLHandshakeMessage* after);
 
+		/**
+		 * @return An iterator over the handshake messages of this layer which reads them directly from the layer data. Unlike the
+		 * methods above, it doesn't create message objects, so it's the cheaper choice when only some fields of some messages are
+		 * needed (the message objects are created only when one of the methods above is first called)
+		 */
+		SSLHandshakeMessageIterator getMessageIterator() const;
+
 		// implement abstract methods
 
 		std::string toString();
@@ -360,6 +370,9 @@ namespace pcpp
 
 	private:
 		PointerVector<SSLHandshakeMessage> m_MessageList;
+		bool m_MessagesParsed;
+
+		void parseMessages();
 	};
 
 
@@ -482,6 +495,8 @@ namespace pcpp
 	template<class THandshakeMessage>
 	THandshakeMessage* SSLHandshakeLayer::getHandshakeMessageOfType()
 	{
+		parseMessages();
+
 		size_t vecSize = m_MessageList.size();
 		for (size_t i = 0; i < vecSize; i++)
 		{
@@ -497,6 +512,8 @@ namespace pcpp
 	template<class THandshakeMessage>
 	THandshakeMessage* SSLHandshakeLayer::getNextHandshakeMessageOfType(SSLHandshakeMessage* after)
 	{
+		parseMessages();
+
 		size_t vecSize = m_MessageList.size();
 		size_t afterIndex;
 
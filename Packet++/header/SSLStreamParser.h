@@ -0,0 +1,231 @@
+#ifndef PACKETPP_SSL_STREAM_PARSER
+#define PACKETPP_SSL_STREAM_PARSER
+
+#include "SSLLayer.h"
+#include "TcpReassembly.h"
+#include <map>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * The events SSLStreamParser reports
+	 */
+	enum SSLStreamEventType
+	{
+		/**
+		 * The header of a record was parsed. SSLStreamEvent#recordType, SSLStreamEvent#recordVersion, SSLStreamEvent#recordLength and
+		 * SSLStreamEvent#isEncrypted are set. Reported for records of all types, before the handshake messages the record contains
+		 */
+		SSLStreamRecord,
+		/**
+		 * A complete handshake message was parsed. SSLStreamEvent#handshakeType, SSLStreamEvent#messageData and
+		 * SSLStreamEvent#messageLength are set, and SSLStreamEvent#message if message objects are created. Encrypted handshake messages
+		 * (sent after a change-cipher-spec record) aren't reported
+		 */
+		SSLStreamHandshakeMessage,
+		/**
+		 * The data of the connection side isn't SSL/TLS, a handshake message is longer than the configured limit, or the connection ended
+		 * in the middle of a record. The rest of the data of the side is ignored
+		 */
+		SSLStreamParseError
+	};
+
+
+	/**
+	 * @struct SSLStreamEvent
+	 * An event reported by SSLStreamParser. The record members are set in all events, and describe the record the event was found in
+	 * (for handshake messages split between records, the last one)
+	 */
+	struct SSLStreamEvent
+	{
+		/** The event type */
+		SSLStreamEventType type;
+		/** The side of the connection the data was sent from (as in TcpReassembly callbacks) */
+		int side;
+		/** The connection */
+		const ConnectionData* connectionData;
+		/** The record type */
+		SSLRecordType recordType;
+		/** The record version */
+		SSLVersion recordVersion;
+		/** The length of the record data in bytes, not including the record header */
+		size_t recordLength;
+		/**
+		 * True if the record content is encrypted: application data records, and records of all types sent from this side after a
+		 * change-cipher-spec record
+		 */
+		bool isEncrypted;
+		/** The handshake message type */
+		SSLHandshakeType handshakeType;
+		/**
+		 * The handshake message, starting at its header. It points into the parsed data when the message is in one piece of data and one
+		 * record, and into a buffer of the parser otherwise, so it's valid only during the callback
+		 */
+		const uint8_t* messageData;
+		/** The handshake message length in bytes, including its header */
+		size_t messageLength;
+		/**
+		 * The handshake message object created from #messageData (see SSLHandshakeMessage#createHandhakeMessage()), or NULL if
+		 * SSLStreamParserConfiguration#createMessageObjects is false. It isn't contained in a layer, and it's deleted after the callback
+		 */
+		SSLHandshakeMessage* message;
+	};
+
+
+	/**
+	 * @struct SSLStreamParserConfiguration
+	 * The limits and options of SSLStreamParser
+	 */
+	struct SSLStreamParserConfiguration
+	{
+		/**
+		 * The maximum length of a handshake message, including its header. Only messages split between pieces of data or records are
+		 * buffered, and only up to this length. A longer message is a parse error
+		 */
+		size_t maxHandshakeMessageLength;
+		/**
+		 * If true, a SSLHandshakeMessage object is created for each handshake message and given in SSLStreamEvent#message. If false, only
+		 * the raw message is given, which saves the allocation when the message fields are read directly (for example with
+		 * SSLClientHelloFingerprint)
+		 */
+		bool createMessageObjects;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] maxMessageLength The value of #maxHandshakeMessageLength. Default value is 65536
+		 * @param[in] createMessages The value of #createMessageObjects. Default value is true
+		 */
+		SSLStreamParserConfiguration(size_t maxMessageLength = 65536, bool createMessages = true) :
+			maxHandshakeMessageLength(maxMessageLength), createMessageObjects(createMessages) {}
+	};
+
+
+	/**
+	 * @class SSLStreamParser
+	 * A SSL/TLS record parser for the data TcpReassembly delivers. Unlike SSLLayer, which parses only the records which are entirely in a
+	 * single packet, it keeps the parsing state of each side of each connection between pieces of data, so records split between TCP
+	 * segments and handshake messages split between records (such as long certificate messages) are parsed correctly. Only a record
+	 * header or a handshake message split between pieces of data is copied (into a per-side buffer whose capacity is kept), and the
+	 * content of application data and other encrypted records is skipped without being copied.<BR>
+	 * Usage: call parse() from the TcpReassembly message ready callback (TcpReassembly#OnTcpMessageReadyZeroCopy fits best, since the data
+	 * isn't copied) and connectionEnded() from the connection end callback. The callback must not call connectionEnded() or clear()
+	 */
+	class SSLStreamParser
+	{
+	public:
+		/**
+		 * @typedef OnSSLStreamEvent
+		 * A callback invoked for each event found in the data
+		 * @param[in] event The event. Its data and message are valid only during the callback
+		 * @param[in] userCookie A pointer to the object given by the user
+		 */
+		typedef void (*OnSSLStreamEvent)(const SSLStreamEvent& event, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] onEvent A callback invoked for each event
+		 * @param[in] userCookie A pointer to an object passed to the callback. Default value is NULL
+		 * @param[in] config The parser limits and options
+		 */
+		SSLStreamParser(OnSSLStreamEvent onEvent, void* userCookie = NULL, const SSLStreamParserConfiguration& config = SSLStreamParserConfiguration());
+
+		/**
+		 * A d'tor for this class
+		 */
+		~SSLStreamParser();
+
+		/**
+		 * Parse the next piece of data of a connection side
+		 * @param[in] side The side the data was sent from (0 or 1)
+		 * @param[in] tcpData The data, as delivered by TcpReassembly
+		 */
+		void parse(int side, const TcpStreamData& tcpData);
+
+		/**
+		 * Parse the next piece of data of a connection side
+		 * @param[in] side The side the data was sent from (0 or 1)
+		 * @param[in] data A pointer to the data
+		 * @param[in] dataLen The data length in bytes
+		 * @param[in] connectionData The connection. Connections are told apart by their flow key
+		 */
+		void parse(int side, const uint8_t* data, size_t dataLen, const ConnectionData& connectionData);
+
+		/**
+		 * End the parsing of a connection and free its state. A record or handshake message which didn't end is reported as a parse
+		 * error. Should be called when the connection ends
+		 * @param[in] connectionData The connection
+		 */
+		void connectionEnded(const ConnectionData& connectionData);
+
+		/**
+		 * Free the state of all connections without reporting anything
+		 */
+		void clear();
+
+		/**
+		 * @return The number of connections whose state is kept
+		 */
+		inline size_t getNumOfConnections() const { return m_Connections.size(); }
+
+	private:
+		enum ParseState
+		{
+			ParseRecordHeader,
+			ParseRecordData,
+			ParseError
+		};
+
+		struct SideState
+		{
+			ParseState state;
+			// a record header split between pieces of data
+			uint8_t recordHeader[sizeof(ssl_tls_record_layer)];
+			size_t recordHeaderLen;
+			size_t recordRemaining;
+			// set after a change-cipher-spec record, after which all records of the side are encrypted
+			bool encrypted;
+			// a handshake message split between pieces of data or records. Its capacity is kept, so it's allocated once per side at most
+			std::string messageBuffer;
+			size_t messageLength;
+			SSLStreamEvent event;
+		};
+
+		struct ConnectionState
+		{
+			SideState sides[2];
+		};
+
+		OnSSLStreamEvent m_OnEvent;
+		void* m_UserCookie;
+		SSLStreamParserConfiguration m_Config;
+		std::map<uint32_t, ConnectionState*> m_Connections;
+		// the connection of the last piece of data, since consecutive pieces usually belong to the same connection
+		ConnectionState* m_LastConnection;
+		uint32_t m_LastFlowKey;
+
+		ConnectionState* getConnection(uint32_t flowKey);
+		void parseSide(SideState& sideState, const uint8_t* data, size_t dataLen);
+		bool recordHeaderComplete(SideState& sideState);
+		bool parseHandshakeData(SideState& sideState, const uint8_t* data, size_t dataLen);
+		void reportMessage(SideState& sideState, const uint8_t* messageData, size_t messageLength);
+		void parseError(SideState& sideState, const char* reason);
+		void reportEvent(SideState& sideState, SSLStreamEventType type);
+
+		// disable copy c'tor and assignment operator
+		SSLStreamParser(const SSLStreamParser& other);
+		SSLStreamParser& operator=(const SSLStreamParser& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_SSL_STREAM_PARSER */
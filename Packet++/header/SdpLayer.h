@@ -164,6 +164,8 @@ namespace pcpp
 		bool spacesAllowedBetweenHeaderFieldNameAndValue() { return false; }
 
 	};
+
+	PCPP_LAYER_PROTOCOL_TRAITS(SdpLayer, SDP);
 }
 
 #endif // PACKETPP_SDP_LAYER
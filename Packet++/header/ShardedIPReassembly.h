@@ -0,0 +1,297 @@
+#ifndef PACKETPP_SHARDED_IP_REASSEMBLY
+#define PACKETPP_SHARDED_IP_REASSEMBLY
+
+#include "IPReassembly.h"
+#include "RawPacketQueue.h"
+#include "StatsReporter.h"
+#include <vector>
+#include <pthread.h>
+
+/**
+ * @file
+ * This is a multi-threaded front end of IPReassembly, for traffic rates a single core can't defragment. The packets being reassembled are
+ * split between several shards, each of them an IPReassembly instance running on its own worker thread. Fragments are assigned to shards by a
+ * symmetric hash of their source IP, destination IP and IP ID (IPv4) or fragment ID (IPv6), the fields identifying the original packet, so all
+ * fragments of a packet always reach the same shard.
+ *
+ * Fragments are given to pcpp#ShardedIPReassembly#reassemblePacket by one or more producer threads, for example the worker threads of DPDK
+ * (pcpp#DpdkWorkerThread) or the capture threads of PF_RING (pcpp#PfRingDevice#startCaptureMultiThread). As in pcpp#ShardedTcpReassembly there is
+ * a single-producer single-consumer queue (pcpp#SPSCQueue) from every producer to every shard and the fragment data is copied into the queue,
+ * so the producer may free or reuse its packet as soon as reassemblePacket() returns. Packets which aren't fragments don't need reassembly, so
+ * they aren't queued and reassemblePacket() returns false for them: the producer keeps handling them itself, without the cost of a copy.
+ *
+ * When a shard completes a packet it hands it to the pcpp#ShardedIPReassembly#OnPacketReassembled callback on its worker thread. Callbacks of
+ * different shards run concurrently, so state they share must be protected by the user, or kept per shard by giving each shard its own cookie
+ * with pcpp#ShardedIPReassembly#setShardUserCookie. The callback may also pass the packet on to the next stage of a pipeline, for example a
+ * ShardedTcpReassembly which has a producer for each shard of this class: its producer ID is the shard index, so each producer ID is still used
+ * by a single thread.
+ *
+ * Basic usage:
+ * - create an instance with the callbacks and a pcpp#ShardedIPReassemblyConfiguration
+ * - call pcpp#ShardedIPReassembly#start to start the worker threads
+ * - call pcpp#ShardedIPReassembly#reassemblePacket from the producer threads, each with its own producer ID
+ * - when done, stop the producers and call pcpp#ShardedIPReassembly#flush and pcpp#ShardedIPReassembly#stop
+ *
+ * Statistics are kept in a pcpp#StatsCounters instance (see pcpp#ShardedIPReassembly#getStatsCounters) which can be read at any time or be
+ * reported periodically by a pcpp#StatsReporter
+ */
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * @struct ShardedIPReassemblyConfiguration
+ * A structure for configuring the ShardedIPReassembly class
+ */
+struct ShardedIPReassemblyConfiguration
+{
+	/** The number of shards, each with its own IPReassembly instance and worker thread */
+	int numOfShards;
+
+	/** The number of producer threads giving packets to reassemblePacket(). Producer IDs are 0 to numOfProducers - 1 */
+	int numOfProducers;
+
+	/** The number of fragments each producer can queue for each shard */
+	size_t queueCapacity;
+
+	/** If true, fragments are dropped when the queue to their shard is full. Otherwise the producer waits until the shard makes room, so no
+	 * fragments are lost but a slow shard slows its producers down
+	 */
+	bool dropWhenFull;
+
+	/** The capacity limit of the IPReassembly instance of each shard (see IPReassembly c'tor) */
+	size_t maxPacketsToStore;
+
+	/** The maximum number of bytes the packets being reassembled by each shard may take, or 0 for no limit (see IPReassembly c'tor) */
+	size_t maxMemoryBytes;
+
+	/** The order each shard drops packets in when maxMemoryBytes is exceeded */
+	EvictionPolicy evictionPolicy;
+
+	/** The reassembly timeout in seconds of each shard, or 0 if packets never time out (see IPReassembly c'tor) */
+	uint32_t fragmentTimeout;
+
+	/** The protocol reassembled packets are parsed until (see IPReassembly#processPacket()). The default is ::UnknownProtocol (parse all layers) */
+	ProtocolType parseUntil;
+
+	/** The OSI layer reassembled packets are parsed until (see IPReassembly#processPacket()). The default is ::OsiModelLayerUnknown (parse all layers) */
+	OsiModelLayer parseUntilLayer;
+
+	/**
+	 * A c'tor for this struct
+	 * @param[in] numOfShards The number of shards. The default is 1
+	 * @param[in] numOfProducers The number of producer threads. The default is 1
+	 * @param[in] queueCapacity The number of fragments each producer can queue for each shard. The default is 1024
+	 * @param[in] dropWhenFull Whether to drop fragments when a queue is full instead of waiting. The default is false
+	 * @param[in] maxPacketsToStore The capacity limit of each shard. The default is #PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE
+	 * @param[in] maxMemoryBytes The memory limit of each shard. The default is 0 (no limit)
+	 * @param[in] evictionPolicy The order each shard drops packets in when the memory limit is exceeded. The default is pcpp#EvictLeastRecentlyUsed
+	 * @param[in] fragmentTimeout The reassembly timeout in seconds. The default is 0 (packets never time out)
+	 */
+	ShardedIPReassemblyConfiguration(int numOfShards = 1, int numOfProducers = 1, size_t queueCapacity = 1024, bool dropWhenFull = false,
+			size_t maxPacketsToStore = PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE, size_t maxMemoryBytes = 0, EvictionPolicy evictionPolicy = EvictLeastRecentlyUsed,
+			uint32_t fragmentTimeout = 0) :
+		numOfShards(numOfShards), numOfProducers(numOfProducers), queueCapacity(queueCapacity), dropWhenFull(dropWhenFull), maxPacketsToStore(maxPacketsToStore),
+		maxMemoryBytes(maxMemoryBytes), evictionPolicy(evictionPolicy), fragmentTimeout(fragmentTimeout), parseUntil(UnknownProtocol), parseUntilLayer(OsiModelLayerUnknown)
+	{
+	}
+};
+
+
+/**
+ * @class ShardedIPReassembly
+ * A multi-threaded IP reassembly engine which splits the packets being reassembled between several IPReassembly instances, each on its own
+ * worker thread. Please refer to the documentation at the top of ShardedIPReassembly.h for understanding how to use this class
+ */
+class ShardedIPReassembly
+{
+public:
+
+	/**
+	 * @typedef OnPacketReassembled
+	 * A callback invoked on the worker thread of a shard when it completes the reassembly of a packet
+	 * @param[in] reassembledPacket The reassembled packet. The callback takes ownership of it and should free it when it's no longer needed
+	 * @param[in] shardIndex The index of the shard which reassembled the packet
+	 * @param[in] userCookie The cookie of the shard (see ShardedIPReassembly#setShardUserCookie())
+	 */
+	typedef void (*OnPacketReassembled)(Packet* reassembledPacket, int shardIndex, void* userCookie);
+
+	/**
+	 * The IDs of the counters in getStatsCounters(). The producer counters are kept by the worker ID of the producer (its producer ID) and the
+	 * shard counters by the worker ID getNumOfProducers() + shard index
+	 */
+	enum StatsCounterId
+	{
+		/** Fragments queued for a shard by a producer */
+		PacketsQueued,
+		/** Fragments dropped by a producer because the queue to their shard was full */
+		PacketsDropped,
+		/** Packets which aren't IP fragments and weren't queued */
+		PacketsIgnored,
+		/** Fragments given to the IPReassembly instance of a shard */
+		PacketsProcessed,
+		/** Packets reassembled by a shard */
+		PacketsReassembled,
+		/** Incomplete packets a shard dropped because of its capacity limit, memory limit or reassembly timeout */
+		IncompletePacketsDropped,
+		/** The number of bytes currently taken by the packets a shard is reassembling */
+		MemoryUsage,
+		/** The number of counters */
+		NumOfStatsCounters
+	};
+
+	/**
+	 * A c'tor for this class. The worker threads aren't started until start() is called
+	 * @param[in] onPacketReassembledCallback The callback to be invoked when a packet is reassembled
+	 * @param[in] userCookie A pointer provided by the user which is passed to the callbacks of all shards unless a shard has its own cookie
+	 * (see setShardUserCookie()). This parameter is optional, default cookie is NULL
+	 * @param[in] onFragmentsCleanCallback The callback to be invoked when a shard drops an incomplete packet (see IPReassembly#OnFragmentsClean).
+	 * It's invoked on the worker thread of the shard and the key is valid only during the callback. This parameter is optional
+	 * @param[in] config Optional parameter for defining the number of shards, producers and other parameters. If not set the default parameters will be set
+	 */
+	ShardedIPReassembly(OnPacketReassembled onPacketReassembledCallback, void* userCookie = NULL, IPReassembly::OnFragmentsClean onFragmentsCleanCallback = NULL,
+			const ShardedIPReassemblyConfiguration& config = ShardedIPReassemblyConfiguration());
+
+	/**
+	 * A d'tor for this class. Stops the worker threads if they're running. Packets which are still being reassembled are freed without calling
+	 * the fragments clean callback, as in IPReassembly
+	 */
+	~ShardedIPReassembly();
+
+	/**
+	 * Set the cookie passed to the callbacks of a shard. Should be called before start()
+	 * @param[in] shardIndex The shard index
+	 * @param[in] userCookie The cookie
+	 */
+	void setShardUserCookie(int shardIndex, void* userCookie);
+
+	/**
+	 * Start the worker threads of all shards
+	 * @return True if all threads were started or they're already running, false if a thread couldn't be created (in this case none is left running)
+	 */
+	bool start();
+
+	/**
+	 * Stop the worker threads after they process all queued fragments. The producers should stop calling reassemblePacket() before this method
+	 * is called. Packets still being reassembled are kept and can be completed after the threads are started again. Does nothing if the threads
+	 * aren't running
+	 */
+	void stop();
+
+	/**
+	 * @return True if the worker threads are running
+	 */
+	bool isRunning() const { return m_Running; }
+
+	/**
+	 * Queue a fragment for the shard its packet belongs to. Can be called concurrently by different producers, but each producer ID must be
+	 * used by a single thread. The packet data is copied, so the packet may be freed or reused when this method returns
+	 * @param[in] rawPacket The fragment
+	 * @param[in] producerId The ID of the calling producer, 0 to getNumOfProducers() - 1. Default value is 0
+	 * @return True if the fragment was queued, false if it's not an IP fragment (in this case the caller should handle the packet itself), the
+	 * producer ID is invalid or the fragment was dropped because the queue was full (when ShardedIPReassemblyConfiguration#dropWhenFull is set or
+	 * the worker threads aren't running)
+	 */
+	bool reassemblePacket(RawPacket* rawPacket, int producerId = 0);
+
+	/**
+	 * Queue an array of fragments, for example the packets PF_RING passes to the callback of startCaptureMultiThread(). See reassemblePacket()
+	 * @param[in] rawPackets The packets
+	 * @param[in] numOfPackets The number of packets
+	 * @param[in] producerId The ID of the calling producer, 0 to getNumOfProducers() - 1. Default value is 0
+	 * @return The number of packets queued
+	 */
+	size_t reassemblePackets(RawPacket* rawPackets, size_t numOfPackets, int producerId = 0);
+
+	/**
+	 * Wait until all shards processed the fragments which were queued before this method was called, so the callbacks of all packets they
+	 * completed were invoked. If the worker threads aren't running the queued fragments are processed on the calling thread
+	 */
+	void flush();
+
+	/**
+	 * Get the shard a fragment belongs to
+	 * @param[in] rawPacket The packet
+	 * @return The shard index, or -1 if it's not an IP fragment
+	 */
+	int getShardIndex(RawPacket* rawPacket) const;
+
+	/**
+	 * @return The number of shards
+	 */
+	int getNumOfShards() const { return (int)m_Shards.size(); }
+
+	/**
+	 * @return The number of producers
+	 */
+	int getNumOfProducers() const { return m_NumOfProducers; }
+
+	/**
+	 * Get the statistics of all producers and shards, see StatsCounterId. They can be read while the threads are running, for example
+	 * with StatsCounters#aggregate() or by a StatsReporter
+	 * @return The statistics counters
+	 */
+	const StatsCounters& getStatsCounters() const { return m_Stats; }
+
+private:
+
+	struct Shard
+	{
+		ShardedIPReassembly* owner;
+		int index;
+		IPReassembly* reassembly;
+		void* userCookie;
+		// a queue from each producer
+		std::vector<RawPacketQueue*> queues;
+		pthread_t thread;
+		// the last flush request the owner made and the last one the shard completed
+		volatile size_t flushRequest;
+		volatile size_t flushDone;
+	};
+
+	enum
+	{
+		// the maximum number of fragments a shard takes from one queue before moving to the next
+		MaxBurstSize = 32,
+		// the number of rounds a shard polls empty queues before it starts sleeping between rounds
+		IdleSpinRounds = 64
+	};
+
+	std::vector<Shard*> m_Shards;
+	int m_NumOfProducers;
+	bool m_DropWhenFull;
+	ProtocolType m_ParseUntil;
+	OsiModelLayer m_ParseUntilLayer;
+	OnPacketReassembled m_OnPacketReassembled;
+	IPReassembly::OnFragmentsClean m_OnFragmentsClean;
+	StatsCounters m_Stats;
+	volatile bool m_Running;
+	volatile size_t m_StopRequested;
+	size_t m_NumOfFlushRequests;
+	// serializes start(), stop() and flush()
+	pthread_mutex_t m_ControlMutex;
+
+	int getShardIndex(const uint8_t* data, size_t dataLen, LinkLayerType linkType) const;
+
+	size_t processQueues(Shard* shard, size_t maxPacketsPerQueue);
+
+	void stopThreads(size_t numOfThreads);
+
+	static void* shardThreadMain(void* shardPtr);
+
+	static void onFragmentsClean(const IPReassembly::PacketKey* key, void* shardPtr);
+
+	static std::vector<std::string> getStatsCounterNames();
+
+	// disable copy c'tor and assignment operator
+	ShardedIPReassembly(const ShardedIPReassembly& other);
+	ShardedIPReassembly& operator=(const ShardedIPReassembly& other);
+};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_SHARDED_IP_REASSEMBLY */
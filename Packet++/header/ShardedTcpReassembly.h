@@ -0,0 +1,301 @@
+#ifndef PACKETPP_SHARDED_TCP_REASSEMBLY
+#define PACKETPP_SHARDED_TCP_REASSEMBLY
+
+#include "TcpReassembly.h"
+#include "StreamNormalizer.h"
+#include "RawPacketQueue.h"
+#include "StatsReporter.h"
+#include <vector>
+#include <pthread.h>
+
+/**
+ * @file
+ * This is a multi-threaded front end of TcpReassembly, for traffic rates a single core can't reassemble. The connections are split between
+ * several shards, each of them a TcpReassembly instance running on its own worker thread. Packets are assigned to shards by a symmetric hash of
+ * their 5-tuple (see pcpp#FlowHash#hashSymmetric), so both sides of a connection always reach the same shard and each shard sees complete
+ * connections.
+ *
+ * Packets are given to pcpp#ShardedTcpReassembly#reassemblePacket by one or more producer threads, for example the worker threads of DPDK
+ * (pcpp#DpdkWorkerThread) or the capture threads of PF_RING (pcpp#PfRingDevice#startCaptureMultiThread). Each producer has an ID and there is a
+ * single-producer single-consumer queue (pcpp#SPSCQueue) from every producer to every shard, so producers and shards never share a lock or a
+ * queue and there is no serialization point between them. The packet data is copied into the queue, so the producer may free or reuse its packet
+ * (for example a DPDK mbuf) as soon as reassemblePacket() returns.
+ *
+ * The callbacks are the same as those of TcpReassembly and are invoked on the worker thread of the shard the connection belongs to. Callbacks of
+ * different shards run concurrently, so state they share must be protected by the user, or kept per shard by giving each shard its own cookie
+ * with pcpp#ShardedTcpReassembly#setShardUserCookie.
+ *
+ * Basic usage:
+ * - create an instance with the callbacks and a pcpp#ShardedTcpReassemblyConfiguration
+ * - call pcpp#ShardedTcpReassembly#start to start the worker threads
+ * - call pcpp#ShardedTcpReassembly#reassemblePacket from the producer threads, each with its own producer ID
+ * - when done, stop the producers and call pcpp#ShardedTcpReassembly#closeAllConnections and pcpp#ShardedTcpReassembly#stop
+ *
+ * When pcpp#ShardedTcpReassemblyConfiguration#defragment is set each shard reassembles IP fragments as well, with a pcpp#StreamNormalizer, and
+ * packets are assigned to shards by their IP addresses only (see pcpp#StreamNormalizer#getShardHash) so the fragments of a packet reach the shard
+ * of its connection. Both stages then run on the worker thread of the shard and the reassembled packets are never queued again.
+ *
+ * Statistics are kept in a pcpp#StatsCounters instance (see pcpp#ShardedTcpReassembly#getStatsCounters) which can be read at any time or be
+ * reported periodically by a pcpp#StatsReporter
+ */
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * @struct ShardedTcpReassemblyConfiguration
+ * A structure for configuring the ShardedTcpReassembly class
+ */
+struct ShardedTcpReassemblyConfiguration
+{
+	/** The number of shards, each with its own TcpReassembly instance and worker thread */
+	int numOfShards;
+
+	/** The number of producer threads giving packets to reassemblePacket(). Producer IDs are 0 to numOfProducers - 1 */
+	int numOfProducers;
+
+	/** The number of packets each producer can queue for each shard */
+	size_t queueCapacity;
+
+	/** If true, packets are dropped when the queue to their shard is full. Otherwise the producer waits until the shard makes room, so no
+	 * packets are lost but a slow shard slows its producers down
+	 */
+	bool dropWhenFull;
+
+	/** The configuration of the TcpReassembly instance of each shard */
+	TcpReassemblyConfiguration reassemblyConfig;
+
+	/** If true each shard reassembles IP fragments before TCP reassembly with a StreamNormalizer, and packets are assigned to shards by their
+	 * IP addresses only so the fragments of a packet reach the shard of its connection. The default is false
+	 */
+	bool defragment;
+
+	/** The configuration of IP reassembly and of the memory budget of the StreamNormalizer of each shard. Only relevant if defragment is true */
+	StreamNormalizerConfiguration normalizerConfig;
+
+	/**
+	 * A c'tor for this struct
+	 * @param[in] numOfShards The number of shards. The default is 1
+	 * @param[in] numOfProducers The number of producer threads. The default is 1
+	 * @param[in] queueCapacity The number of packets each producer can queue for each shard. The default is 1024
+	 * @param[in] dropWhenFull Whether to drop packets when a queue is full instead of waiting. The default is false
+	 * @param[in] reassemblyConfig The configuration of the TcpReassembly instance of each shard. The default is the default TcpReassembly configuration
+	 */
+	ShardedTcpReassemblyConfiguration(int numOfShards = 1, int numOfProducers = 1, size_t queueCapacity = 1024, bool dropWhenFull = false,
+			const TcpReassemblyConfiguration& reassemblyConfig = TcpReassemblyConfiguration()) :
+		numOfShards(numOfShards), numOfProducers(numOfProducers), queueCapacity(queueCapacity), dropWhenFull(dropWhenFull), reassemblyConfig(reassemblyConfig),
+		defragment(false)
+	{
+	}
+};
+
+
+/**
+ * @class ShardedTcpReassembly
+ * A multi-threaded TCP reassembly engine which splits the connections between several TcpReassembly instances, each on its own worker thread.
+ * Please refer to the documentation at the top of ShardedTcpReassembly.h for understanding how to use this class
+ */
+class ShardedTcpReassembly
+{
+public:
+
+	/**
+	 * The IDs of the counters in getStatsCounters(). The producer counters are kept by the worker ID of the producer (its producer ID) and the
+	 * shard counters by the worker ID getNumOfProducers() + shard index
+	 */
+	enum StatsCounterId
+	{
+		/** Packets queued for a shard by a producer */
+		PacketsQueued,
+		/** Packets dropped by a producer because the queue to their shard was full */
+		PacketsDropped,
+		/** Packets which aren't TCP (or IP fragments when defragmenting) and weren't queued */
+		PacketsIgnored,
+		/** Packets given to the TcpReassembly instance of a shard */
+		PacketsProcessed,
+		/** Connections started in a shard */
+		ConnectionsStarted,
+		/** Connections ended in a shard */
+		ConnectionsEnded,
+		/** The number of out-of-order bytes currently queued by the TcpReassembly instance of a shard */
+		OutOfOrderBytes,
+		/** The number of counters */
+		NumOfStatsCounters
+	};
+
+	/**
+	 * A c'tor for this class. The worker threads aren't started until start() is called
+	 * @param[in] onMessageReadyCallback The callback to be invoked when new data arrives (see TcpReassembly#OnTcpMessageReady)
+	 * @param[in] userCookie A pointer provided by the user which is passed to the callbacks of all shards unless a shard has its own cookie
+	 * (see setShardUserCookie()). This parameter is optional, default cookie is NULL
+	 * @param[in] onConnectionStartCallback The callback to be invoked when a new connection is identified. This parameter is optional
+	 * @param[in] onConnectionEndCallback The callback to be invoked when a connection is terminated. This parameter is optional
+	 * @param[in] config Optional parameter for defining the number of shards, producers and other parameters. If not set the default parameters will be set
+	 */
+	ShardedTcpReassembly(TcpReassembly::OnTcpMessageReady onMessageReadyCallback, void* userCookie = NULL, TcpReassembly::OnTcpConnectionStart onConnectionStartCallback = NULL,
+			TcpReassembly::OnTcpConnectionEnd onConnectionEndCallback = NULL, const ShardedTcpReassemblyConfiguration& config = ShardedTcpReassemblyConfiguration());
+
+	/**
+	 * A c'tor for this class which delivers new data without copying it (see TcpReassembly#OnTcpMessageReadyZeroCopy). The worker threads aren't
+	 * started until start() is called
+	 * @param[in] onMessageReadyCallback The callback to be invoked when new data arrives
+	 * @param[in] userCookie A pointer provided by the user which is passed to the callbacks of all shards unless a shard has its own cookie
+	 * (see setShardUserCookie()). This parameter is optional, default cookie is NULL
+	 * @param[in] onConnectionStartCallback The callback to be invoked when a new connection is identified. This parameter is optional
+	 * @param[in] onConnectionEndCallback The callback to be invoked when a connection is terminated. This parameter is optional
+	 * @param[in] config Optional parameter for defining the number of shards, producers and other parameters. If not set the default parameters will be set
+	 */
+	ShardedTcpReassembly(TcpReassembly::OnTcpMessageReadyZeroCopy onMessageReadyCallback, void* userCookie = NULL, TcpReassembly::OnTcpConnectionStart onConnectionStartCallback = NULL,
+			TcpReassembly::OnTcpConnectionEnd onConnectionEndCallback = NULL, const ShardedTcpReassemblyConfiguration& config = ShardedTcpReassemblyConfiguration());
+
+	/**
+	 * A d'tor for this class. Stops the worker threads if they're running. Connections which are still open are lost without calling the
+	 * connection end callback, as in TcpReassembly
+	 */
+	~ShardedTcpReassembly();
+
+	/**
+	 * Set the cookie passed to the callbacks of a shard. Should be called before start()
+	 * @param[in] shardIndex The shard index
+	 * @param[in] userCookie The cookie
+	 */
+	void setShardUserCookie(int shardIndex, void* userCookie);
+
+	/**
+	 * Start the worker threads of all shards
+	 * @return True if all threads were started or they're already running, false if a thread couldn't be created (in this case none is left running)
+	 */
+	bool start();
+
+	/**
+	 * Stop the worker threads after they process all queued packets. The producers should stop calling reassemblePacket() before this method is called.
+	 * Connections stay open and can still be closed with closeAllConnections(). Does nothing if the threads aren't running
+	 */
+	void stop();
+
+	/**
+	 * @return True if the worker threads are running
+	 */
+	bool isRunning() const { return m_Running; }
+
+	/**
+	 * Queue a packet for the shard its connection belongs to. Can be called concurrently by different producers, but each producer ID must be
+	 * used by a single thread. The packet data is copied, so the packet may be freed or reused when this method returns
+	 * @param[in] rawPacket The packet
+	 * @param[in] producerId The ID of the calling producer, 0 to getNumOfProducers() - 1. Default value is 0
+	 * @return True if the packet was queued, false if it's not a TCP packet (or an IP fragment when defragmenting), the producer ID is invalid or the packet was dropped because the
+	 * queue was full (when ShardedTcpReassemblyConfiguration#dropWhenFull is set or the worker threads aren't running)
+	 */
+	bool reassemblePacket(RawPacket* rawPacket, int producerId = 0);
+
+	/**
+	 * Queue an array of packets, for example the packets PF_RING passes to the callback of startCaptureMultiThread(). See reassemblePacket()
+	 * @param[in] rawPackets The packets
+	 * @param[in] numOfPackets The number of packets
+	 * @param[in] producerId The ID of the calling producer, 0 to getNumOfProducers() - 1. Default value is 0
+	 * @return The number of packets queued
+	 */
+	size_t reassemblePackets(RawPacket* rawPackets, size_t numOfPackets, int producerId = 0);
+
+	/**
+	 * Close all open connections of all shards. Each shard first processes the packets already queued for it and then closes its connections
+	 * on its own worker thread, so the connection end callbacks are invoked on the shard threads as usual. This method returns after all shards
+	 * are done. If the worker threads aren't running the queued packets are processed and the connections closed on the calling thread
+	 */
+	void closeAllConnections();
+
+	/**
+	 * Get the shard a packet belongs to
+	 * @param[in] rawPacket The packet
+	 * @return The shard index, or -1 if it's not a TCP packet (or an IP fragment when defragmenting)
+	 */
+	int getShardIndex(RawPacket* rawPacket) const;
+
+	/**
+	 * @return The number of shards
+	 */
+	int getNumOfShards() const { return (int)m_Shards.size(); }
+
+	/**
+	 * @return The number of producers
+	 */
+	int getNumOfProducers() const { return m_NumOfProducers; }
+
+	/**
+	 * Get the statistics of all producers and shards, see StatsCounterId. They can be read while the threads are running, for example
+	 * with StatsCounters#aggregate() or by a StatsReporter
+	 * @return The statistics counters
+	 */
+	const StatsCounters& getStatsCounters() const { return m_Stats; }
+
+private:
+
+	struct Shard
+	{
+		ShardedTcpReassembly* owner;
+		int index;
+		// the normalizer is NULL unless defragmenting, in which case the reassembly instance is its TCP stage
+		StreamNormalizer* normalizer;
+		TcpReassembly* reassembly;
+		void* userCookie;
+		// a queue from each producer
+		std::vector<RawPacketQueue*> queues;
+		pthread_t thread;
+		// the last close all request the owner made and the last one the shard completed
+		volatile size_t closeAllRequest;
+		volatile size_t closeAllDone;
+	};
+
+	enum
+	{
+		// the maximum number of packets a shard takes from one queue before moving to the next
+		MaxBurstSize = 32,
+		// the number of rounds a shard polls empty queues before it starts sleeping between rounds
+		IdleSpinRounds = 64
+	};
+
+	std::vector<Shard*> m_Shards;
+	int m_NumOfProducers;
+	bool m_DropWhenFull;
+	bool m_Defragment;
+	TcpReassembly::OnTcpMessageReady m_OnMessageReadyCallback;
+	TcpReassembly::OnTcpMessageReadyZeroCopy m_OnMessageReadyZeroCopyCallback;
+	TcpReassembly::OnTcpConnectionStart m_OnConnStart;
+	TcpReassembly::OnTcpConnectionEnd m_OnConnEnd;
+	StatsCounters m_Stats;
+	volatile bool m_Running;
+	volatile size_t m_StopRequested;
+	size_t m_NumOfCloseAllRequests;
+	// serializes start(), stop() and closeAllConnections()
+	pthread_mutex_t m_ControlMutex;
+
+	void init(void* userCookie, const ShardedTcpReassemblyConfiguration& config);
+
+	int getShardIndex(const uint8_t* data, size_t dataLen, LinkLayerType linkType) const;
+
+	size_t processQueues(Shard* shard, size_t maxPacketsPerQueue);
+
+	void stopThreads(size_t numOfThreads);
+
+	static void* shardThreadMain(void* shardPtr);
+
+	static void onMessageReady(int side, const TcpStreamData& tcpData, void* shardPtr);
+
+	static void onConnectionStart(ConnectionData connectionData, void* shardPtr);
+
+	static void onConnectionEnd(ConnectionData connectionData, TcpReassembly::ConnectionEndReason reason, void* shardPtr);
+
+	static std::vector<std::string> getStatsCounterNames();
+
+	// disable copy c'tor and assignment operator
+	ShardedTcpReassembly(const ShardedTcpReassembly& other);
+	ShardedTcpReassembly& operator=(const ShardedTcpReassembly& other);
+};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_SHARDED_TCP_REASSEMBLY */
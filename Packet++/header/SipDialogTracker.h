@@ -0,0 +1,310 @@
+#ifndef PACKETPP_SIP_DIALOG_TRACKER
+#define PACKETPP_SIP_DIALOG_TRACKER
+
+#include "SipLayer.h"
+#include "SdpLayer.h"
+#include "PacketView.h"
+#include "TimerWheel.h"
+#include "OpenAddressingTable.h"
+#include <vector>
+#include <time.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * The states of a dialog tracked by SipDialogTracker
+	 */
+	enum SipDialogState
+	{
+		/** An INVITE was seen, but no final response to it */
+		SipDialogEarly,
+		/** A 2xx response to the INVITE was seen */
+		SipDialogConfirmed,
+		/** The dialog was ended by a BYE request */
+		SipDialogTerminated,
+		/** The INVITE was cancelled or rejected with a 3xx-6xx response before the dialog was confirmed */
+		SipDialogFailed
+	};
+
+
+	/**
+	 * @struct SipMediaEndpoint
+	 * An address and UDP port a media (RTP) stream is sent to, as announced in the SDP of a SIP message
+	 */
+	struct SipMediaEndpoint
+	{
+		/** The IP version of the address (4 or 6) */
+		uint8_t ipVersion;
+		/** The IP address. For IPv4 only the first 4 bytes are used */
+		uint8_t ipAddress[16];
+		/** The UDP port */
+		uint16_t port;
+	};
+
+
+	/**
+	 * @struct SipDialog
+	 * A SIP dialog (call) tracked by SipDialogTracker. The dialog is created by an INVITE request and identified by its Call-ID. The
+	 * strings are null-terminated and their lengths are limited, since they're kept in the struct
+	 */
+	struct SipDialog
+	{
+		/** The maximum length of the Call-ID. Messages with a longer Call-ID aren't tracked */
+		static const size_t MaxCallIdLength = 128;
+		/** The maximum length of the From and To tags. Longer tags are truncated */
+		static const size_t MaxTagLength = 64;
+		/** The maximum number of media endpoints kept for a dialog. When more are announced the oldest ones are replaced */
+		static const size_t MaxMediaEndpoints = 8;
+
+		/** The Call-ID */
+		char callId[MaxCallIdLength + 1];
+		/** The tag of the From header of the INVITE */
+		char fromTag[MaxTagLength + 1];
+		/** The tag of the To header of the first response which has one, or an empty string if no such response was seen */
+		char toTag[MaxTagLength + 1];
+		/** The sequence number of the CSeq header of the last message */
+		uint32_t lastCSeq;
+		/** The method of the CSeq header of the last message */
+		SipRequestLayer::SipMethod lastCSeqMethod;
+		/** The dialog state */
+		SipDialogState state;
+		/** The timestamp (in seconds) of the INVITE which created the dialog */
+		time_t startTime;
+		/** The timestamp (in seconds) of the last SIP message or media packet of the dialog */
+		time_t lastActivityTime;
+		/** The number of SIP messages of the dialog */
+		uint32_t numOfSipMessages;
+		/** The number of media (RTP and RTCP) packets classified to the dialog by SipDialogTracker#classifyMediaPacket() */
+		uint64_t numOfMediaPackets;
+		/** The number of valid entries in #mediaEndpoints */
+		size_t numOfMediaEndpoints;
+		/** The media endpoints announced in the SDP of the dialog messages, of both parties */
+		SipMediaEndpoint mediaEndpoints[MaxMediaEndpoints];
+	};
+
+
+	/**
+	 * @struct SipDialogTrackerConfiguration
+	 * The limits and timeouts of SipDialogTracker
+	 */
+	struct SipDialogTrackerConfiguration
+	{
+		/**
+		 * The maximum number of dialogs tracked at once. INVITE requests of new dialogs are ignored while this number of dialogs is tracked
+		 */
+		size_t maxNumOfDialogs;
+		/**
+		 * The number of seconds without SIP messages or media packets after which a dialog times out and is removed
+		 */
+		uint32_t dialogTimeout;
+		/**
+		 * The number of seconds a terminated or failed dialog is kept, so retransmissions and media packets which are still in flight are
+		 * still associated with it
+		 */
+		uint32_t terminatedDialogTimeout;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] maxDialogs The value of #maxNumOfDialogs. Default value is 100000
+		 * @param[in] timeout The value of #dialogTimeout. Default value is 3600
+		 * @param[in] terminatedTimeout The value of #terminatedDialogTimeout. Default value is 32 (the SIP transaction timeout)
+		 */
+		SipDialogTrackerConfiguration(size_t maxDialogs = 100000, uint32_t timeout = 3600, uint32_t terminatedTimeout = 32) :
+			maxNumOfDialogs(maxDialogs), dialogTimeout(timeout), terminatedDialogTimeout(terminatedTimeout) {}
+	};
+
+
+	/**
+	 * @class SipDialogTracker
+	 * Tracks SIP dialogs (calls) and the media streams announced in their SDP, so the RTP and RTCP packets of a call can be associated with
+	 * it. SIP messages are read with the header field lookup of SipLayer and SdpLayer, without copying the field values. The Call-ID, CSeq,
+	 * From and To tags and the SDP media endpoints are kept in a pooled SipDialog instance, found through an open addressing hash table of
+	 * the Call-ID hashes. The media endpoints are kept in a second hash table, so a media packet is classified to its dialog with a single
+	 * lookup of its UDP destination (or source) address and port, using a PacketView instead of a parsed Packet.<BR>
+	 * Dialogs which end (by a BYE, a CANCEL or a failure response) are kept for SipDialogTrackerConfiguration#terminatedDialogTimeout
+	 * seconds, and dialogs without any activity are removed after SipDialogTrackerConfiguration#dialogTimeout seconds. The time is taken
+	 * from the packet timestamps, so the timeouts work the same for live traffic and for capture files
+	 */
+	class SipDialogTracker
+	{
+	public:
+		/**
+		 * @typedef OnSipDialogEnd
+		 * A callback invoked when a dialog is removed because its timeout passed. The dialog state tells whether it ended
+		 * (::SipDialogTerminated or ::SipDialogFailed) or timed out while it was active
+		 * @param[in] dialog The dialog. It's returned to the pool after the callback
+		 * @param[in] userCookie A pointer to the object given by the user
+		 */
+		typedef void (*OnSipDialogEnd)(const SipDialog& dialog, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] onDialogEnd A callback invoked when a dialog is removed. Default value is NULL (no callback)
+		 * @param[in] userCookie A pointer to an object passed to the callback. Default value is NULL
+		 * @param[in] config The tracker limits and timeouts
+		 */
+		SipDialogTracker(OnSipDialogEnd onDialogEnd = NULL, void* userCookie = NULL, const SipDialogTrackerConfiguration& config = SipDialogTrackerConfiguration());
+
+		/**
+		 * A d'tor for this class. Removes all dialogs without invoking the callback
+		 */
+		~SipDialogTracker();
+
+		/**
+		 * Process a packet. If it contains a SIP message of a tracked dialog (or an INVITE of a new one) the dialog is updated, and the
+		 * media endpoints of the SDP the message carries are added to it. Packets which don't contain a SIP message only advance the time
+		 * @param[in] packet The packet. Its timestamp is the current time of the tracker
+		 * @return The dialog of the message, or NULL if the packet doesn't contain a SIP message of a tracked dialog
+		 */
+		SipDialog* processPacket(Packet& packet);
+
+		/**
+		 * Classify a media packet to the dialog which announced its UDP destination address and port in SDP, or its source address and
+		 * port if there is none (since media is usually sent from the port it's received on). RTCP packets, sent to the port following the
+		 * announced one, are classified as well. The dialog's media packet count and activity time are updated
+		 * @param[in] view The packet headers, as extracted by FlowKeyExtractor
+		 * @param[in] packetTime The packet timestamp in seconds, the current time of the tracker
+		 * @return The dialog of the packet, or NULL if the packet isn't a UDP packet of a tracked dialog
+		 */
+		SipDialog* classifyMediaPacket(const PacketView& view, time_t packetTime);
+
+		/**
+		 * Find a dialog by its Call-ID
+		 * @param[in] callId The Call-ID
+		 * @param[in] callIdLength The Call-ID length in bytes
+		 * @return The dialog, or NULL if no dialog with this Call-ID is tracked
+		 */
+		SipDialog* findDialog(const char* callId, size_t callIdLength) const;
+
+		/**
+		 * Advance the current time of the tracker and remove the dialogs whose timeout passed, as processing a packet does. Useful when no
+		 * packets arrive for a while
+		 * @param[in] currentTime The current time in seconds. Times earlier than the current time of the tracker are ignored
+		 */
+		void setCurrentTime(time_t currentTime);
+
+		/**
+		 * Remove all dialogs without invoking the callback
+		 */
+		void clear();
+
+		/**
+		 * @return The number of dialogs currently tracked
+		 */
+		inline size_t getNumOfDialogs() const { return m_DialogIndex.getSize(); }
+
+		/**
+		 * @return The number of media endpoints currently registered for the tracked dialogs
+		 */
+		inline size_t getNumOfMediaEndpoints() const { return m_EndpointIndex.getSize(); }
+
+		/**
+		 * @return The number of INVITE requests of new dialogs which were ignored because SipDialogTrackerConfiguration#maxNumOfDialogs
+		 * dialogs were tracked
+		 */
+		inline uint64_t getNumOfRejectedDialogs() const { return m_NumOfRejectedDialogs; }
+
+		/**
+		 * Parse the address of a SDP connection field (c=), e.g "IN IP4 10.0.0.1". Multicast addresses may be followed by a TTL and a
+		 * number of addresses, which are ignored
+		 * @param[in] field The connection field of an SdpLayer
+		 * @param[out] endpoint The endpoint whose IP version and address are set. The port is set to 0
+		 * @return True if the field holds a valid non-zero IPv4 or IPv6 address, false otherwise
+		 */
+		static bool parseSdpConnection(HeaderField* field, SipMediaEndpoint& endpoint);
+
+	private:
+		// a dialog and its tracking state. The dialog is the first member so the user visible struct can be converted back to it
+		struct DialogEntry
+		{
+			SipDialog dialog;
+			uint32_t callIdHash;
+			size_t callIdLength;
+			uint32_t timerId;
+			// the next free instance while this instance is in the pool
+			DialogEntry* nextFree;
+		};
+
+		// the hash is kept in the slots so probing doesn't touch the dialogs
+		struct DialogSlot
+		{
+			uint32_t hash;
+			DialogEntry* entry;
+
+			DialogSlot() : hash(0), entry(NULL) {}
+			bool isEmpty() const { return entry == NULL; }
+		};
+
+		// the endpoint is kept in the slot so a media packet lookup touches only the table
+		struct EndpointSlot
+		{
+			uint32_t hash;
+			SipMediaEndpoint endpoint;
+			DialogEntry* entry;
+
+			EndpointSlot() : hash(0), endpoint(), entry(NULL) {}
+			bool isEmpty() const { return entry == NULL; }
+		};
+
+		// matches the slot of a dialog by its Call-ID
+		struct MatchCallId
+		{
+			const char* callId;
+			size_t callIdLength;
+
+			MatchCallId(const char* id, size_t idLength) : callId(id), callIdLength(idLength) {}
+			bool operator()(const DialogSlot& slot) const;
+		};
+
+		// matches the slot of a media endpoint
+		struct MatchEndpoint
+		{
+			const SipMediaEndpoint& endpoint;
+
+			MatchEndpoint(const SipMediaEndpoint& mediaEndpoint) : endpoint(mediaEndpoint) {}
+			bool operator()(const EndpointSlot& slot) const;
+		};
+
+		OnSipDialogEnd m_OnDialogEnd;
+		void* m_UserCookie;
+		SipDialogTrackerConfiguration m_Config;
+		OpenAddressingTable<DialogSlot> m_DialogIndex;
+		OpenAddressingTable<EndpointSlot> m_EndpointIndex;
+		// DialogEntry instances which aren't in use
+		DialogEntry* m_FreeEntries;
+		TimerWheel m_Timers;
+		time_t m_CurrentTime;
+		uint64_t m_NumOfRejectedDialogs;
+
+		void processSipMessage(DialogEntry* entry, SipLayer* sipLayer, bool isRequest, SipRequestLayer::SipMethod method, int statusCode);
+		void addMediaEndpoints(DialogEntry* entry, SdpLayer* sdpLayer);
+		void addMediaEndpoint(DialogEntry* entry, const SipMediaEndpoint& endpoint);
+		void touchDialog(DialogEntry* entry, uint32_t timeout);
+		DialogEntry* createDialog(const char* callId, size_t callIdLength, uint32_t hash);
+		void removeDialog(DialogEntry* entry);
+
+		DialogEntry* findDialogEntry(const char* callId, size_t callIdLength, uint32_t hash) const;
+		void insertDialog(DialogEntry* entry);
+		void eraseDialog(DialogEntry* entry);
+
+		DialogEntry* findEndpoint(const SipMediaEndpoint& endpoint) const;
+		void insertEndpoint(const SipMediaEndpoint& endpoint, DialogEntry* entry);
+		void eraseEndpoint(const SipMediaEndpoint& endpoint, DialogEntry* entry);
+
+		// disable copy c'tor and assignment operator
+		SipDialogTracker(const SipDialogTracker& other);
+		SipDialogTracker& operator=(const SipDialogTracker& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_SIP_DIALOG_TRACKER */
@@ -123,6 +123,8 @@ namespace pcpp
 		bool spacesAllowedBetweenHeaderFieldNameAndValue() { return true; }
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(SipLayer, SIP);
+
 
 
 	class SipRequestFirstLine;
@@ -225,6 +227,8 @@ namespace pcpp
 		SipRequestFirstLine* m_FirstLine;
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(SipRequestLayer, SIPRequest);
+
 
 
 
@@ -451,6 +455,8 @@ namespace pcpp
 		SipResponseFirstLine* m_FirstLine;
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(SipResponseLayer, SIPResponse);
+
 
 
 	/**
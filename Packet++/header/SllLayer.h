@@ -102,9 +102,13 @@ namespace pcpp
 
 		std::string toString();
 
+		void dump(PacketDumpWriter& writer);
+
 		OsiModelLayer getOsiModelLayer() const { return OsiModelDataLinkLayer; }
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(SllLayer, SLL);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_SLL_LAYER */
@@ -0,0 +1,489 @@
+#ifndef PACKETPP_STATIC_PACKET
+#define PACKETPP_STATIC_PACKET
+
+#include "Packet.h"
+#include "ProtocolRegistry.h"
+#include "EthLayer.h"
+#include "VlanLayer.h"
+#include "IPv4Layer.h"
+#include "IPv6Layer.h"
+#include "TcpLayer.h"
+#include "UdpLayer.h"
+#include "GtpLayer.h"
+#include <stdint.h>
+#include <stddef.h>
+#if defined(WIN32) || defined(WINx64)
+#include <winsock2.h>
+#elif LINUX
+#include <in.h>
+#elif MAC_OS_X || FREEBSD
+#include <arpa/inet.h>
+#endif
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct StaticLayerHint
+	 * What a layer of a StaticPacket stack tells the next layer about the data following it, so the next layer can check it's the
+	 * protocol the data was meant to be parsed as, the same way the generic parser chooses the next layer
+	 */
+	struct StaticLayerHint
+	{
+		/**
+		 * The kinds of hints
+		 */
+		enum Kind
+		{
+			/** The layer is the first layer, or the previous layer doesn't identify the next protocol (the next layer checks the data itself) */
+			Any,
+			/** The value is an ethertype in host byte order */
+			EtherType,
+			/** The value is an IP protocol number */
+			IPProtocol,
+			/** The value is the source port in the upper 16 bits and the destination port in the lower 16 bits */
+			Ports,
+			/** The previous layer isn't followed by another layer (for example an IPv4 fragment or a GTP-C message) */
+			None
+		};
+
+		/** The kind of the hint */
+		Kind kind;
+		/** The value of the hint */
+		uint32_t value;
+	};
+
+
+	/**
+	 * @struct StaticLayerTraits
+	 * Describes how a StaticPacket parses a layer type. It's specialized for the layers StaticPacket supports: EthLayer, VlanLayer,
+	 * IPv4Layer, IPv6Layer, TcpLayer, UdpLayer and GtpV1Layer. Each specialization defines:
+	 * - Header - the header struct get() returns for the layer
+	 * - parse() - checks the data is a valid header of the layer which follows the previous layer as the hint says, calculates the header
+	 *   length and sets the hint for the next layer. The checks are the same the generic parser makes, and the protocol tables of
+	 *   ProtocolRegistry are used the same way
+	 *
+	 * A stack with a layer type which doesn't have a specialization doesn't compile
+	 */
+	template<typename T>
+	struct StaticLayerTraits;
+
+	/**
+	 * @struct StaticPacketNoLayer
+	 * The type of the unused layers of a StaticPacket stack
+	 */
+	struct StaticPacketNoLayer {};
+
+	/// @cond PCPP_INTERNAL
+
+	template<>
+	struct StaticLayerTraits<StaticPacketNoLayer>
+	{
+		typedef void Header;
+		static inline bool parse(uint8_t*, size_t&, StaticLayerHint&, size_t& headerLen) { headerLen = 0; return true; }
+	};
+
+	template<>
+	struct StaticLayerTraits<EthLayer>
+	{
+		typedef ether_header Header;
+		static inline bool parse(uint8_t* data, size_t& dataLen, StaticLayerHint& hint, size_t& headerLen)
+		{
+			if (hint.kind != StaticLayerHint::Any || dataLen < sizeof(ether_header))
+				return false;
+
+			headerLen = sizeof(ether_header);
+			hint.kind = StaticLayerHint::EtherType;
+			hint.value = ntohs(((ether_header*)data)->etherType);
+			return true;
+		}
+	};
+
+	template<>
+	struct StaticLayerTraits<VlanLayer>
+	{
+		typedef vlan_header Header;
+		static inline bool parse(uint8_t* data, size_t& dataLen, StaticLayerHint& hint, size_t& headerLen)
+		{
+			if (hint.kind != StaticLayerHint::EtherType || ProtocolRegistry::getInstance().getProtocolByEtherType((uint16_t)hint.value) != VLAN ||
+					dataLen < sizeof(vlan_header))
+				return false;
+
+			headerLen = sizeof(vlan_header);
+			hint.value = ntohs(((vlan_header*)data)->etherType);
+			return true;
+		}
+	};
+
+	template<>
+	struct StaticLayerTraits<IPv4Layer>
+	{
+		typedef iphdr Header;
+		static inline bool parse(uint8_t* data, size_t& dataLen, StaticLayerHint& hint, size_t& headerLen)
+		{
+			// the data follows an ethertype or an IP protocol (IP-in-IP) registered for IPv4, or a layer which carries IP (GTP-U)
+			if ((hint.kind == StaticLayerHint::EtherType && ProtocolRegistry::getInstance().getProtocolByEtherType((uint16_t)hint.value) != IPv4) ||
+					(hint.kind == StaticLayerHint::IPProtocol && ProtocolRegistry::getInstance().getProtocolByIPProtocol((uint8_t)hint.value) != IPv4) ||
+					hint.kind == StaticLayerHint::Ports || hint.kind == StaticLayerHint::None)
+				return false;
+
+			if (dataLen < sizeof(iphdr) || (data[0] >> 4) != 4)
+				return false;
+
+			headerLen = (size_t)(data[0] & 0x0f) * 4;
+			if (headerLen < sizeof(iphdr) || headerLen > dataLen)
+				return false;
+
+			// the layers which follow end where the IP packet does, not where the frame does
+			size_t totalLen = ntohs(((iphdr*)data)->totalLength);
+			if (totalLen >= headerLen && totalLen < dataLen)
+				dataLen = totalLen;
+
+			// upper layers of fragments aren't parsed
+			bool isFragment = (data[6] & PCPP_IP_MORE_FRAGMENTS) != 0 || (((data[6] & 0x1f) << 8) | data[7]) != 0;
+			hint.kind = (isFragment ? StaticLayerHint::None : StaticLayerHint::IPProtocol);
+			hint.value = ((iphdr*)data)->protocol;
+			return true;
+		}
+	};
+
+	template<>
+	struct StaticLayerTraits<IPv6Layer>
+	{
+		typedef ip6_hdr Header;
+		static inline bool parse(uint8_t* data, size_t& dataLen, StaticLayerHint& hint, size_t& headerLen)
+		{
+			if ((hint.kind == StaticLayerHint::EtherType && ProtocolRegistry::getInstance().getProtocolByEtherType((uint16_t)hint.value) != IPv6) ||
+					(hint.kind == StaticLayerHint::IPProtocol && ProtocolRegistry::getInstance().getProtocolByIPProtocol((uint8_t)hint.value) != IPv4) ||
+					hint.kind == StaticLayerHint::Ports || hint.kind == StaticLayerHint::None)
+				return false;
+
+			if (dataLen < sizeof(ip6_hdr) || (data[0] >> 4) != 6)
+				return false;
+
+			headerLen = sizeof(ip6_hdr);
+			size_t totalLen = ntohs(((ip6_hdr*)data)->payloadLength) + sizeof(ip6_hdr);
+			if (totalLen > sizeof(ip6_hdr) && totalLen < dataLen)
+				dataLen = totalLen;
+
+			// extension headers aren't walked, so a TCP or UDP layer matches only when it directly follows the fixed header
+			hint.kind = StaticLayerHint::IPProtocol;
+			hint.value = ((ip6_hdr*)data)->nextHeader;
+			return true;
+		}
+	};
+
+	template<>
+	struct StaticLayerTraits<TcpLayer>
+	{
+		typedef tcphdr Header;
+		static inline bool parse(uint8_t* data, size_t& dataLen, StaticLayerHint& hint, size_t& headerLen)
+		{
+			if (hint.kind != StaticLayerHint::IPProtocol || ProtocolRegistry::getInstance().getProtocolByIPProtocol((uint8_t)hint.value) != TCP ||
+					dataLen < sizeof(tcphdr))
+				return false;
+
+			headerLen = (size_t)(data[12] >> 4) * 4;
+			if (headerLen < sizeof(tcphdr) || headerLen > dataLen)
+				return false;
+
+			hint.kind = StaticLayerHint::Ports;
+			hint.value = ((uint32_t)ntohs(((tcphdr*)data)->portSrc) << 16) | ntohs(((tcphdr*)data)->portDst);
+			return true;
+		}
+	};
+
+	template<>
+	struct StaticLayerTraits<UdpLayer>
+	{
+		typedef udphdr Header;
+		static inline bool parse(uint8_t* data, size_t& dataLen, StaticLayerHint& hint, size_t& headerLen)
+		{
+			if (hint.kind != StaticLayerHint::IPProtocol || ProtocolRegistry::getInstance().getProtocolByIPProtocol((uint8_t)hint.value) != UDP ||
+					dataLen < sizeof(udphdr))
+				return false;
+
+			headerLen = sizeof(udphdr);
+			hint.kind = StaticLayerHint::Ports;
+			hint.value = ((uint32_t)ntohs(((udphdr*)data)->portSrc) << 16) | ntohs(((udphdr*)data)->portDst);
+			return true;
+		}
+	};
+
+	template<>
+	struct StaticLayerTraits<GtpV1Layer>
+	{
+		typedef gtpv1_header Header;
+		static inline bool parse(uint8_t* data, size_t& dataLen, StaticLayerHint& hint, size_t& headerLen)
+		{
+			const ProtocolRegistry& registry = ProtocolRegistry::getInstance();
+			if (hint.kind != StaticLayerHint::Ports || dataLen < sizeof(gtpv1_header) ||
+					(!registry.isPortOfProtocol((uint16_t)(hint.value >> 16), GTPv1) && !registry.isPortOfProtocol((uint16_t)hint.value, GTPv1)) ||
+					!GtpV1Layer::isGTPv1(data, dataLen))
+				return false;
+
+			// a GTP-C message isn't followed by another layer
+			const uint8_t gpduMessageType = 0xff;
+			if (data[1] != gpduMessageType)
+			{
+				headerLen = dataLen;
+				hint.kind = StaticLayerHint::None;
+				return true;
+			}
+
+			// the optional fields and the extension headers of a GTP-U message, each extension ends with the type of the next one
+			headerLen = sizeof(gtpv1_header);
+			if ((data[0] & 0x07) != 0)
+			{
+				headerLen += 4;
+				if (headerLen > dataLen)
+					return false;
+
+				uint8_t nextExtensionType = ((data[0] & 0x04) != 0 ? data[headerLen - 1] : 0);
+				while (nextExtensionType != 0)
+				{
+					if (headerLen >= dataLen || data[headerLen] == 0 || headerLen + (size_t)data[headerLen] * 4 > dataLen)
+						return false;
+
+					headerLen += (size_t)data[headerLen] * 4;
+					nextExtensionType = data[headerLen - 1];
+				}
+			}
+
+			hint.kind = StaticLayerHint::Any;
+			hint.value = 0;
+			return true;
+		}
+	};
+
+	template<typename T, typename U>
+	struct StaticLayerIsSame { enum { value = 0 }; };
+
+	template<typename T>
+	struct StaticLayerIsSame<T, T> { enum { value = 1 }; };
+
+	// the index in the stack L0..L7 of the layer of type T which appears Occurrence times before it, or -1 if there is no such layer
+	template<typename T, int Occurrence, int Position, typename L0, typename L1, typename L2, typename L3, typename L4, typename L5, typename L6, typename L7>
+	struct StaticLayerIndex
+	{
+		enum
+		{
+			value = (StaticLayerIsSame<T, L0>::value && Occurrence == 0) ? Position :
+					StaticLayerIndex<T, Occurrence - StaticLayerIsSame<T, L0>::value, Position + 1, L1, L2, L3, L4, L5, L6, L7, StaticPacketNoLayer>::value
+		};
+	};
+
+	template<typename T, int Occurrence, typename L0, typename L1, typename L2, typename L3, typename L4, typename L5, typename L6, typename L7>
+	struct StaticLayerIndex<T, Occurrence, 8, L0, L1, L2, L3, L4, L5, L6, L7>
+	{
+		enum { value = -1 };
+	};
+
+	/// @endcond
+
+
+	/**
+	 * @class StaticPacket
+	 * A parser specialized at compile time for a known stack of layers, for pipelines which know in advance what their traffic looks like,
+	 * for example:
+	 *
+	 * @code
+	 * StaticPacket<EthLayer, VlanLayer, IPv4Layer, UdpLayer, GtpV1Layer> packet;
+	 * if (packet.parse(&rawPacket))
+	 * {
+	 *     uint32_t teid = packet.get<GtpV1Layer>()->teid;
+	 *     ...
+	 * }
+	 * @endcode
+	 *
+	 * Parsing is a straight sequence of the inlined header checks of the layers in the stack (see StaticLayerTraits), with no virtual calls
+	 * and no Layer objects. Only the offset of each header is stored, inside the object, so parsing doesn't allocate memory, and get() returns
+	 * a pointer to a header struct at the stored offset of a layer whose index in the stack is known at compile time.<BR>
+	 * The packet matches the stack when each layer follows the previous one the way the generic parser would parse it (for example a TCP
+	 * layer follows an IPv4 header whose protocol is registered as TCP in ProtocolRegistry, and isn't a fragment), and the data after the
+	 * last layer is the payload. When the packet doesn't match, parse(RawPacket*) parses it with a generic Packet instead, which is kept in the
+	 * object and reused for the next packets that don't match, so mixed traffic can still be handled.<BR>
+	 * Stacks have up to 8 layers. A layer type may appear more than once (for example the outer and inner IPv4 headers of GTP-U), and get()
+	 * takes the occurrence as an optional second template argument. Please notice IPv6 extension headers aren't walked: a TCP or UDP layer
+	 * matches only when it directly follows the IPv6 fixed header
+	 */
+	template<typename L0, typename L1 = StaticPacketNoLayer, typename L2 = StaticPacketNoLayer, typename L3 = StaticPacketNoLayer,
+			typename L4 = StaticPacketNoLayer, typename L5 = StaticPacketNoLayer, typename L6 = StaticPacketNoLayer, typename L7 = StaticPacketNoLayer>
+	class StaticPacket
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. The object holds no packet until parse() is called
+		 */
+		StaticPacket() : m_Data(NULL), m_DataLen(0), m_IsMatched(false), m_FallbackPacket(NULL) { m_Offsets[0] = 0; }
+
+		/**
+		 * A d'tor for this class. Frees the fallback packet if one was created
+		 */
+		~StaticPacket() { delete m_FallbackPacket; }
+
+		/**
+		 * Parse raw data with the stack. The data isn't copied and must outlive the use of the headers
+		 * @param[in] data The raw data, starting with the header of the first layer of the stack
+		 * @param[in] dataLen The raw data length in bytes
+		 * @return True if the data matches the stack, false otherwise
+		 */
+		bool parse(uint8_t* data, size_t dataLen)
+		{
+			m_Data = data;
+			m_DataLen = dataLen;
+			StaticLayerHint hint;
+			hint.kind = StaticLayerHint::Any;
+			hint.value = 0;
+			size_t offset = 0;
+			m_IsMatched = parseLayer<L0>(0, offset, hint) && parseLayer<L1>(1, offset, hint) && parseLayer<L2>(2, offset, hint) &&
+					parseLayer<L3>(3, offset, hint) && parseLayer<L4>(4, offset, hint) && parseLayer<L5>(5, offset, hint) &&
+					parseLayer<L6>(6, offset, hint) && parseLayer<L7>(7, offset, hint);
+			m_Offsets[NumOfLayers] = offset;
+			if (m_DataLen < offset)
+				m_DataLen = offset;
+			return m_IsMatched;
+		}
+
+		/**
+		 * Parse a raw packet with the stack, or with a generic Packet if it doesn't match the stack. The link layer type of the raw packet
+		 * must be the one of the first layer of the stack (Ethernet for a stack starting with EthLayer, raw IP for a stack starting with
+		 * IPv4Layer or IPv6Layer), otherwise the packet doesn't match
+		 * @param[in] rawPacket The raw packet. It isn't copied and must outlive the use of the headers and of the fallback packet
+		 * @return True if the packet matches the stack, false if it was parsed by the fallback packet (see getFallbackPacket())
+		 */
+		bool parse(RawPacket* rawPacket)
+		{
+			LinkLayerType linkType = rawPacket->getLinkLayerType();
+			bool linkTypeMatches = (StaticLayerIsSame<L0, EthLayer>::value ?
+					linkType == LINKTYPE_ETHERNET : (linkType == LINKTYPE_RAW || linkType == LINKTYPE_DLT_RAW1 || linkType == LINKTYPE_DLT_RAW2 ||
+					linkType == LINKTYPE_IPV4 || linkType == LINKTYPE_IPV6));
+
+			if (linkTypeMatches && parse((uint8_t*)rawPacket->getRawData(), (size_t)rawPacket->getRawDataLen()))
+				return true;
+
+			m_IsMatched = false;
+			if (m_FallbackPacket == NULL)
+				m_FallbackPacket = new Packet(rawPacket, false);
+			else
+				m_FallbackPacket->setRawPacket(rawPacket, false);
+
+			return false;
+		}
+
+		/**
+		 * @return True if the last parsed packet matches the stack, false otherwise
+		 */
+		inline bool isMatched() const { return m_IsMatched; }
+
+		/**
+		 * @return The generic Packet the last raw packet was parsed with if it didn't match the stack, or NULL if it matched
+		 */
+		inline Packet* getFallbackPacket() const { return m_IsMatched ? NULL : m_FallbackPacket; }
+
+		/**
+		 * Get the header of a layer of the stack. Calling it with a layer type which isn't in the stack doesn't compile. Please notice the
+		 * returned pointer is valid only if the packet matches the stack
+		 * @return A pointer to the header struct of the first layer of type T
+		 */
+		template<typename T>
+		inline typename StaticLayerTraits<T>::Header* get() const { return get<T, 0>(); }
+
+		/**
+		 * Get the header of a layer type which appears more than once in the stack
+		 * @tparam Occurrence The occurrence of the layer type: 0 for the first layer of this type, 1 for the second and so on
+		 * @return A pointer to the header struct of the layer
+		 */
+		template<typename T, int Occurrence>
+		inline typename StaticLayerTraits<T>::Header* get() const
+		{
+			return (typename StaticLayerTraits<T>::Header*)(m_Data + m_Offsets[checkIndex<StaticLayerIndex<T, Occurrence, 0, L0, L1, L2, L3, L4, L5, L6, L7>::value>()]);
+		}
+
+		/**
+		 * @return The offset in bytes of the header of the first layer of type T from the beginning of the packet
+		 */
+		template<typename T>
+		inline size_t getOffset() const
+		{
+			return m_Offsets[checkIndex<StaticLayerIndex<T, 0, 0, L0, L1, L2, L3, L4, L5, L6, L7>::value>()];
+		}
+
+		/**
+		 * @return The header length in bytes of the first layer of type T
+		 */
+		template<typename T>
+		inline size_t getHeaderLen() const
+		{
+			const int index = checkIndex<StaticLayerIndex<T, 0, 0, L0, L1, L2, L3, L4, L5, L6, L7>::value>();
+			return m_Offsets[index + 1] - m_Offsets[index];
+		}
+
+		/**
+		 * @return A pointer to the data following the last layer of the stack, valid only if the packet matches the stack
+		 */
+		inline uint8_t* getPayload() const { return m_Data + m_Offsets[NumOfLayers]; }
+
+		/**
+		 * @return The length of the data following the last layer of the stack up to the end of the innermost IP packet (Ethernet padding
+		 * isn't included), valid only if the packet matches the stack
+		 */
+		inline size_t getPayloadLen() const { return m_DataLen - m_Offsets[NumOfLayers]; }
+
+		/**
+		 * The number of layers in the stack
+		 */
+		static const int NumOfLayers = StaticLayerIndex<StaticPacketNoLayer, 0, 0, L0, L1, L2, L3, L4, L5, L6, L7>::value < 0 ? 8 :
+				StaticLayerIndex<StaticPacketNoLayer, 0, 0, L0, L1, L2, L3, L4, L5, L6, L7>::value;
+
+	private:
+
+		uint8_t* m_Data;
+		// the end of the data of the innermost layer, which may be shorter than the packet
+		size_t m_DataLen;
+		size_t m_Offsets[NumOfLayers + 1];
+		bool m_IsMatched;
+		Packet* m_FallbackPacket;
+
+		template<typename T>
+		inline bool parseLayer(int index, size_t& offset, StaticLayerHint& hint)
+		{
+			if (index >= NumOfLayers)
+				return true;
+
+			size_t layerDataLen = m_DataLen - offset;
+			size_t headerLen;
+			if (!StaticLayerTraits<T>::parse(m_Data + offset, layerDataLen, hint, headerLen))
+				return false;
+
+			// a layer may end the data of the layers following it (the IP length)
+			m_DataLen = offset + layerDataLen;
+			m_Offsets[index] = offset;
+			offset += headerLen;
+			return true;
+		}
+
+		template<int Index>
+		static inline int checkIndex()
+		{
+			// a compile error here means the layer type isn't in the stack
+			typedef char LayerTypeIsInStack[Index >= 0 ? 1 : -1];
+			(void)sizeof(LayerTypeIsInStack);
+			return Index;
+		}
+
+		// disable copy c'tor and assignment operator
+		StaticPacket(const StaticPacket& other);
+		StaticPacket& operator=(const StaticPacket& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_STATIC_PACKET */
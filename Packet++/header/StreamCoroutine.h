@@ -0,0 +1,542 @@
+#ifndef PACKETPP_STREAM_COROUTINE
+#define PACKETPP_STREAM_COROUTINE
+
+#include "TcpReassembly.h"
+#include <map>
+#include <new>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * The default maximum number of bytes a single read of ByteStreamReader may return, which is also the most it buffers for a read split
+ * between pieces of data
+ */
+#define PCPP_STREAM_MAX_READ_LENGTH 65536
+
+/**
+ * Begin the body of StreamCoroutine#resume(). Must be followed by the parser code and #PCPP_STREAM_COROUTINE_END
+ */
+#define PCPP_STREAM_COROUTINE_BEGIN switch (m_ResumePoint) { case 0:
+
+/**
+ * Wait until a condition, usually a read of the ByteStreamReader, is true. If it isn't, resume() returns pcpp#StreamCoroutineSuspended and
+ * the next call to resume() continues from this point by evaluating the condition again. Local variables don't keep their values across a
+ * wait, so parser state must be kept in members of the coroutine class. Only one wait may appear on a line
+ */
+#define PCPP_STREAM_AWAIT(condition) do { m_ResumePoint = __LINE__; case __LINE__: if (!(condition)) return pcpp::StreamCoroutineSuspended; } while (0)
+
+/**
+ * End the body of StreamCoroutine#resume(). A coroutine which reaches it returns pcpp#StreamCoroutineDone, and the rest of the data of its
+ * connection side is ignored
+ */
+#define PCPP_STREAM_COROUTINE_END } m_ResumePoint = -1; return pcpp::StreamCoroutineDone
+
+/**
+ * Stop the coroutine because the data isn't valid for the protocol. resume() returns pcpp#StreamCoroutineFailed and the rest of the data of
+ * the connection side is ignored
+ */
+#define PCPP_STREAM_COROUTINE_FAIL do { m_ResumePoint = -1; return pcpp::StreamCoroutineFailed; } while (0)
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct ByteStreamSlice
+	 * A sequence of bytes returned by a read of ByteStreamReader. It points into the data given to the reader, or into the reader's buffer if
+	 * the bytes were split between pieces of data, so it's valid only until the next wait of the coroutine
+	 */
+	struct ByteStreamSlice
+	{
+		/** A pointer to the first byte. May be NULL if the slice is empty */
+		const uint8_t* data;
+		/** The number of bytes */
+		size_t length;
+
+		/**
+		 * A c'tor for this struct which creates an empty slice
+		 */
+		ByteStreamSlice() : data(NULL), length(0) {}
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] sliceData A pointer to the first byte
+		 * @param[in] sliceLength The number of bytes
+		 */
+		ByteStreamSlice(const uint8_t* sliceData, size_t sliceLength) : data(sliceData), length(sliceLength) {}
+	};
+
+
+	/**
+	 * @class ByteStreamReader
+	 * The byte stream of one side of a TCP connection as a parser coroutine sees it. The stream is fed piece by piece, as TcpReassembly delivers
+	 * the data, and the coroutine reads a number of bytes, reads up to a delimiter or skips bytes. Each read returns true if the stream holds
+	 * what was requested, and false after it consumed all the data of the current piece, so the coroutine waits for the next piece. Bytes are
+	 * returned as slices of the delivered data; only a read which is split between pieces is copied to a buffer, and skipped bytes are never
+	 * copied.<BR>
+	 * A read that fails must be repeated with the same arguments when the coroutine resumes, which #PCPP_STREAM_AWAIT does, and a coroutine
+	 * must not start a different read while one is pending. A read longer than the maximum read length makes the stream overflow: all reads
+	 * fail from then on
+	 */
+	class ByteStreamReader
+	{
+	public:
+		/**
+		 * A c'tor for this class
+		 * @param[in] maxReadLength The maximum number of bytes a read may return. Default value is #PCPP_STREAM_MAX_READ_LENGTH
+		 */
+		ByteStreamReader(size_t maxReadLength = PCPP_STREAM_MAX_READ_LENGTH);
+
+		/**
+		 * Set the next piece of the stream. The data isn't copied, so it must remain valid until the coroutine waits
+		 * @param[in] data A pointer to the data
+		 * @param[in] dataLen The data length in bytes
+		 */
+		void feed(const uint8_t* data, size_t dataLen);
+
+		/**
+		 * Mark the end of the stream. Reads which need more data fail from then on, and isEnded() returns true
+		 */
+		inline void setEnded() { m_Ended = true; }
+
+		/**
+		 * Read a number of bytes
+		 * @param[in] numOfBytes The number of bytes
+		 * @param[out] slice The bytes, if the read succeeded
+		 * @return True if the bytes were read, false if the stream ended or overflowed or the coroutine has to wait for more data
+		 */
+		bool read(size_t numOfBytes, ByteStreamSlice& slice);
+
+		/**
+		 * Read the bytes up to a delimiter, for example a line ending with "\r\n". The delimiter is consumed too
+		 * @param[in] delimiter The delimiter bytes
+		 * @param[in] delimiterLen The number of delimiter bytes, which must be at least 1
+		 * @param[out] slice The bytes before the delimiter, if the read succeeded
+		 * @return True if the delimiter was found, false if the stream ended or overflowed or the coroutine has to wait for more data
+		 */
+		bool readUntil(const char* delimiter, size_t delimiterLen, ByteStreamSlice& slice);
+
+		/**
+		 * Read whatever bytes are available in the current piece, up to a maximum, without ever copying them. Useful for passing message
+		 * bodies on piece by piece
+		 * @param[in] maxBytes The maximum number of bytes to read
+		 * @param[out] slice The bytes, if the read succeeded
+		 * @return True if at least one byte was read, false if there are no more bytes in the current piece
+		 */
+		bool readSome(size_t maxBytes, ByteStreamSlice& slice);
+
+		/**
+		 * Skip a number of bytes, which may span many pieces. The bytes aren't copied
+		 * @param[in] numOfBytes The number of bytes to skip
+		 * @return True if the bytes were skipped, false if the stream ended or the coroutine has to wait for more data
+		 */
+		bool skip(uint64_t numOfBytes);
+
+		/**
+		 * @return The number of bytes of the current piece which weren't consumed yet
+		 */
+		inline size_t getAvailableBytes() const { return m_DataLen - m_Offset; }
+
+		/**
+		 * @return The number of stream bytes consumed so far, including bytes of a pending read which were already buffered
+		 */
+		inline uint64_t getPosition() const { return m_Position; }
+
+		/**
+		 * @return True if the end of the stream was marked by setEnded()
+		 */
+		inline bool isEnded() const { return m_Ended; }
+
+		/**
+		 * @return True if a read was longer than the maximum read length
+		 */
+		inline bool hasOverflowed() const { return m_Overflowed; }
+
+		/**
+		 * @return The maximum number of bytes a read may return
+		 */
+		inline size_t getMaxReadLength() const { return m_MaxReadLength; }
+
+		/**
+		 * Set the maximum number of bytes a read may return
+		 * @param[in] maxReadLength The maximum read length
+		 */
+		inline void setMaxReadLength(size_t maxReadLength) { m_MaxReadLength = maxReadLength; }
+
+	private:
+		const uint8_t* m_Data;
+		size_t m_DataLen;
+		size_t m_Offset;
+		uint64_t m_Position;
+		size_t m_MaxReadLength;
+		// the bytes of a read split between pieces. Its capacity is kept, so it's allocated once per stream at most
+		std::vector<uint8_t> m_Buffer;
+		// true if the buffer was returned by the last read, in which case the next read clears it
+		bool m_BufferReturned;
+		uint64_t m_SkipRemaining;
+		bool m_Skipping;
+		bool m_Ended;
+		bool m_Overflowed;
+
+		void releaseBuffer();
+		void consume(size_t numOfBytes);
+		bool overflow();
+	};
+
+
+	/**
+	 * The status a parser coroutine returns from StreamCoroutine#resume()
+	 */
+	enum StreamCoroutineStatus
+	{
+		/** The coroutine waits for more data */
+		StreamCoroutineSuspended,
+		/** The coroutine finished, and the rest of the data of its connection side is ignored */
+		StreamCoroutineDone,
+		/** The data isn't valid for the protocol, and the rest of the data of the connection side is ignored */
+		StreamCoroutineFailed
+	};
+
+
+	/**
+	 * @class StreamCoroutine
+	 * The base class of parser coroutines. A coroutine parses one side of a TCP connection as linear code which waits for the bytes it needs,
+	 * instead of as a state machine fed with arbitrary pieces of data. C++98 has no coroutines, so the waits are implemented by the
+	 * #PCPP_STREAM_COROUTINE_BEGIN, #PCPP_STREAM_AWAIT and #PCPP_STREAM_COROUTINE_END macros, which turn the body of resume() into a switch
+	 * statement that jumps back to the last wait. For example, a parser of messages which start with a 2-byte length:
+	 *
+	 *     class LengthPrefixedParser : public StreamCoroutine
+	 *     {
+	 *     public:
+	 *         StreamCoroutineStatus resume(ByteStreamReader& stream)
+	 *         {
+	 *             PCPP_STREAM_COROUTINE_BEGIN;
+	 *             while (true)
+	 *             {
+	 *                 PCPP_STREAM_AWAIT(stream.read(2, m_Slice));
+	 *                 m_Length = (m_Slice.data[0] << 8) | m_Slice.data[1];
+	 *                 PCPP_STREAM_AWAIT(stream.read(m_Length, m_Slice));
+	 *                 handleMessage(m_Slice.data, m_Slice.length);
+	 *             }
+	 *             PCPP_STREAM_COROUTINE_END;
+	 *         }
+	 *
+	 *     private:
+	 *         ByteStreamSlice m_Slice;
+	 *         uint16_t m_Length;
+	 *     };
+	 *
+	 * Local variables don't survive a wait, and the compiler rejects a wait which jumps over the initialization of one, so the parser state is
+	 * kept in members. A coroutine can check ByteStreamReader#isEnded() in its wait condition to handle the end of the connection, for example
+	 * to complete a message delimited by it
+	 */
+	class StreamCoroutine
+	{
+	public:
+		/**
+		 * A c'tor for this class
+		 */
+		StreamCoroutine() : m_ResumePoint(0) {}
+
+		/**
+		 * A d'tor for this class
+		 */
+		virtual ~StreamCoroutine() {}
+
+		/**
+		 * Run the coroutine from its last wait until it waits again or finishes
+		 * @param[in] stream The stream of the connection side
+		 * @return The coroutine status
+		 */
+		virtual StreamCoroutineStatus resume(ByteStreamReader& stream) = 0;
+
+	protected:
+		/** The line of the last wait, 0 before the coroutine started and -1 after it finished */
+		int m_ResumePoint;
+	};
+
+
+	/**
+	 * @class StreamCoroutinePool
+	 * A pool of fixed-size memory frames for parser coroutines. Frames are allocated in blocks and reused, so starting a coroutine for a
+	 * connection doesn't allocate memory once the pool has grown to the number of concurrent connections. The pool isn't thread safe; keep a
+	 * pool (that is, a StreamCoroutineDispatcher) per thread, for example per shard of ShardedTcpReassembly
+	 */
+	class StreamCoroutinePool
+	{
+	public:
+		/**
+		 * A c'tor for this class
+		 * @param[in] frameSize The size of a frame, which must fit the largest coroutine class allocated from the pool
+		 * @param[in] framesPerBlock The number of frames allocated at once when the pool has no free frame
+		 */
+		StreamCoroutinePool(size_t frameSize, size_t framesPerBlock);
+
+		/**
+		 * A d'tor for this class. Frees all frames, so all coroutines allocated from the pool must have been destroyed
+		 */
+		~StreamCoroutinePool();
+
+		/**
+		 * Allocate a frame. A coroutine is constructed in it with placement new (which create() does), and must derive from StreamCoroutine as
+		 * its first (or only) base class so the frame is at the address of its StreamCoroutine part
+		 * @param[in] size The size of the object to construct in the frame, usually sizeof() its class
+		 * @return The frame, or NULL if size is larger than the frame size (an error will be printed to log)
+		 */
+		void* allocate(size_t size);
+
+		/**
+		 * Return a frame to the pool
+		 * @param[in] frame The frame, whose object was already destroyed
+		 */
+		void release(void* frame);
+
+		/**
+		 * Allocate a frame and construct a coroutine in it with its default c'tor
+		 * @return The coroutine, or NULL if it doesn't fit in a frame (an error will be printed to log)
+		 */
+		template <typename T>
+		T* create() { void* frame = allocate(sizeof(T)); return (frame != NULL ? new (frame) T() : NULL); }
+
+		/**
+		 * Allocate a frame and construct a coroutine in it with a c'tor which takes one argument
+		 * @param[in] arg1 The c'tor argument
+		 * @return The coroutine, or NULL if it doesn't fit in a frame (an error will be printed to log)
+		 */
+		template <typename T, typename A1>
+		T* create(const A1& arg1) { void* frame = allocate(sizeof(T)); return (frame != NULL ? new (frame) T(arg1) : NULL); }
+
+		/**
+		 * Allocate a frame and construct a coroutine in it with a c'tor which takes two arguments
+		 * @param[in] arg1 The first c'tor argument
+		 * @param[in] arg2 The second c'tor argument
+		 * @return The coroutine, or NULL if it doesn't fit in a frame (an error will be printed to log)
+		 */
+		template <typename T, typename A1, typename A2>
+		T* create(const A1& arg1, const A2& arg2) { void* frame = allocate(sizeof(T)); return (frame != NULL ? new (frame) T(arg1, arg2) : NULL); }
+
+		/**
+		 * @return The size of a frame
+		 */
+		inline size_t getFrameSize() const { return m_FrameSize; }
+
+		/**
+		 * @return The number of frames currently allocated
+		 */
+		inline size_t getNumOfFramesInUse() const { return m_NumOfFramesInUse; }
+
+		/**
+		 * @return The number of frames the pool holds, in use or free
+		 */
+		inline size_t getNumOfFrames() const { return m_Blocks.size() * m_FramesPerBlock; }
+
+	private:
+		size_t m_FrameSize;
+		size_t m_FramesPerBlock;
+		std::vector<uint8_t*> m_Blocks;
+		// free frames are linked through their first bytes
+		void* m_FreeList;
+		size_t m_NumOfFramesInUse;
+
+		// disable copy c'tor and assignment operator
+		StreamCoroutinePool(const StreamCoroutinePool& other);
+		StreamCoroutinePool& operator=(const StreamCoroutinePool& other);
+	};
+
+
+	/**
+	 * @struct StreamCoroutineDispatcherConfiguration
+	 * The parameters of StreamCoroutineDispatcher
+	 */
+	struct StreamCoroutineDispatcherConfiguration
+	{
+		/** The size of a coroutine frame, which must fit the largest coroutine class the dispatcher creates */
+		size_t maxCoroutineSize;
+		/** The number of frames the pool allocates at once */
+		size_t framesPerBlock;
+		/** The maximum number of bytes a read of a connection side may return (see ByteStreamReader) */
+		size_t maxReadLength;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] coroutineSize The value of #maxCoroutineSize. Default value is 256
+		 * @param[in] framesInBlock The value of #framesPerBlock. Default value is 64
+		 * @param[in] readLength The value of #maxReadLength. Default value is #PCPP_STREAM_MAX_READ_LENGTH
+		 */
+		StreamCoroutineDispatcherConfiguration(size_t coroutineSize = 256, size_t framesInBlock = 64, size_t readLength = PCPP_STREAM_MAX_READ_LENGTH) :
+			maxCoroutineSize(coroutineSize), framesPerBlock(framesInBlock), maxReadLength(readLength) {}
+	};
+
+
+	/**
+	 * @class StreamCoroutineDispatcher
+	 * Runs a parser coroutine (see StreamCoroutine) on each side of each TCP connection, feeding it the data TcpReassembly delivers without
+	 * copying it. When a connection side delivers its first data the user's factory callback creates the coroutine in a frame of the
+	 * dispatcher's pool, or returns NULL to leave the side unparsed (for example, after looking at the ports). The coroutine is destroyed and
+	 * its frame reused when it finishes or fails, when its stream overflows or when the connection ends, after it's resumed once more with
+	 * ByteStreamReader#isEnded() true.<BR>
+	 * Usage: call parse() from the TcpReassembly message ready callback and connectionEnded() from the connection end callback, or give
+	 * onTcpMessageReady() and onTcpConnectionEnd() to TcpReassembly with the dispatcher as the cookie:
+	 *
+	 *     StreamCoroutineDispatcher dispatcher(createParser);
+	 *     TcpReassembly reassembly(StreamCoroutineDispatcher::onTcpMessageReady, &dispatcher, NULL,
+	 *         StreamCoroutineDispatcher::onTcpConnectionEnd);
+	 *
+	 * The dispatcher isn't thread safe. With ShardedTcpReassembly, give each shard a dispatcher of its own as its cookie, so each shard has its
+	 * own coroutine pool
+	 */
+	class StreamCoroutineDispatcher
+	{
+	public:
+		/**
+		 * @typedef CreateStreamCoroutine
+		 * A callback which creates the coroutine of a connection side in a frame of the pool, usually with StreamCoroutinePool#create():
+		 *
+		 *     return pool.create<MyParser>();
+		 *
+		 * @param[in] connectionData The connection
+		 * @param[in] side The connection side (0 or 1)
+		 * @param[in] pool The pool to allocate the coroutine from
+		 * @param[in] userCookie A pointer to the object given by the user
+		 * @return The coroutine, or NULL to leave the side unparsed
+		 */
+		typedef StreamCoroutine* (*CreateStreamCoroutine)(const ConnectionData& connectionData, int side, StreamCoroutinePool& pool, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] createCoroutine The callback which creates coroutines
+		 * @param[in] userCookie A pointer to an object passed to the callback. Default value is NULL
+		 * @param[in] config The dispatcher parameters
+		 */
+		StreamCoroutineDispatcher(CreateStreamCoroutine createCoroutine, void* userCookie = NULL,
+				const StreamCoroutineDispatcherConfiguration& config = StreamCoroutineDispatcherConfiguration());
+
+		/**
+		 * A d'tor for this class. Destroys the coroutines of all connections without resuming them
+		 */
+		~StreamCoroutineDispatcher();
+
+		/**
+		 * Feed the next piece of data of a connection side to its coroutine
+		 * @param[in] side The side the data was sent from (0 or 1)
+		 * @param[in] tcpData The data, as delivered by TcpReassembly
+		 */
+		void parse(int side, const TcpStreamData& tcpData);
+
+		/**
+		 * Feed the next piece of data of a connection side to its coroutine
+		 * @param[in] side The side the data was sent from (0 or 1)
+		 * @param[in] data A pointer to the data
+		 * @param[in] dataLen The data length in bytes
+		 * @param[in] connectionData The connection. Connections are told apart by their flow key
+		 */
+		void parse(int side, const uint8_t* data, size_t dataLen, const ConnectionData& connectionData);
+
+		/**
+		 * End the streams of a connection: its running coroutines are resumed once more with the stream marked as ended, then destroyed.
+		 * Should be called when the connection ends
+		 * @param[in] connectionData The connection
+		 */
+		void connectionEnded(const ConnectionData& connectionData);
+
+		/**
+		 * Destroy the coroutines of all connections without resuming them
+		 */
+		void clear();
+
+		/**
+		 * A TcpReassembly#OnTcpMessageReadyZeroCopy callback which calls parse()
+		 * @param[in] side The side the data was sent from
+		 * @param[in] tcpData The data
+		 * @param[in] userCookie A pointer to the StreamCoroutineDispatcher
+		 */
+		static void onTcpMessageReady(int side, const TcpStreamData& tcpData, void* userCookie);
+
+		/**
+		 * A TcpReassembly#OnTcpConnectionEnd callback which calls connectionEnded()
+		 * @param[in] connectionData The connection
+		 * @param[in] reason The reason the connection ended
+		 * @param[in] userCookie A pointer to the StreamCoroutineDispatcher
+		 */
+		static void onTcpConnectionEnd(ConnectionData connectionData, TcpReassembly::ConnectionEndReason reason, void* userCookie);
+
+		/**
+		 * @return The number of connections whose state is kept
+		 */
+		inline size_t getNumOfConnections() const { return m_Connections.size(); }
+
+		/**
+		 * @return The number of coroutines which are currently running
+		 */
+		inline size_t getNumOfRunningCoroutines() const { return m_Pool.getNumOfFramesInUse(); }
+
+		/**
+		 * @return The number of coroutines created so far
+		 */
+		inline uint64_t getNumOfCoroutinesCreated() const { return m_NumOfCoroutinesCreated; }
+
+		/**
+		 * @return The number of coroutines which finished, including those which finished when their stream ended
+		 */
+		inline uint64_t getNumOfCoroutinesDone() const { return m_NumOfCoroutinesDone; }
+
+		/**
+		 * @return The number of coroutines which failed or whose stream overflowed
+		 */
+		inline uint64_t getNumOfCoroutinesFailed() const { return m_NumOfCoroutinesFailed; }
+
+		/**
+		 * @return The number of coroutines which were still waiting for data when their connection ended
+		 */
+		inline uint64_t getNumOfCoroutinesInterrupted() const { return m_NumOfCoroutinesInterrupted; }
+
+		/**
+		 * @return The coroutine pool
+		 */
+		inline const StreamCoroutinePool& getPool() const { return m_Pool; }
+
+	private:
+		struct SideState
+		{
+			StreamCoroutine* coroutine;
+			ByteStreamReader stream;
+			// true once the factory was called for the side, so it's called once even if it returned NULL
+			bool started;
+		};
+
+		struct ConnectionState
+		{
+			SideState sides[2];
+		};
+
+		CreateStreamCoroutine m_CreateCoroutine;
+		void* m_UserCookie;
+		StreamCoroutineDispatcherConfiguration m_Config;
+		StreamCoroutinePool m_Pool;
+		std::map<uint32_t, ConnectionState*> m_Connections;
+		// the connection of the last piece of data, since consecutive pieces usually belong to the same connection
+		ConnectionState* m_LastConnection;
+		uint32_t m_LastFlowKey;
+		uint64_t m_NumOfCoroutinesCreated;
+		uint64_t m_NumOfCoroutinesDone;
+		uint64_t m_NumOfCoroutinesFailed;
+		uint64_t m_NumOfCoroutinesInterrupted;
+
+		ConnectionState* getConnection(uint32_t flowKey);
+		void resumeCoroutine(SideState& sideState);
+		void destroyCoroutine(SideState& sideState);
+
+		// disable copy c'tor and assignment operator
+		StreamCoroutineDispatcher(const StreamCoroutineDispatcher& other);
+		StreamCoroutineDispatcher& operator=(const StreamCoroutineDispatcher& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_STREAM_COROUTINE */
@@ -0,0 +1,183 @@
+#ifndef PACKETPP_STREAM_NORMALIZER
+#define PACKETPP_STREAM_NORMALIZER
+
+#include "TcpReassembly.h"
+#include "IPReassembly.h"
+#include "PacketView.h"
+#include "RawPacketPool.h"
+#include "MemoryBudget.h"
+
+/**
+ * @file
+ * This is a single ingest stage for TCP streams which combines IP reassembly (pcpp#IPReassembly) and TCP reassembly (pcpp#TcpReassembly). Chaining
+ * pcpp#IPReassembly#processPacket and pcpp#TcpReassembly#reassemblePacket parses every packet twice and the reassembled packets three times: a
+ * Packet is built for each fragment, another one for the reassembled packet, and TcpReassembly locates its headers again. pcpp#StreamNormalizer
+ * instead locates the headers of each packet once with pcpp#FlowKeyExtractor:
+ * - Packets which aren't fragments go straight to TCP reassembly with their pcpp#PacketView
+ * - Fragments go to pcpp#IPReassembly#processRawPacket, which fixes the IP header of the reassembled packet in its raw data and fills its
+ *   PacketView from the header offsets kept while reassembling. The reassembled packet goes to TCP reassembly with that view and its buffer is
+ *   then freed, back to the raw packet pool if one is set, so no Packet object is built on the way
+ *
+ * The TCP streams are delivered through the callbacks of pcpp#TcpReassembly, whether their packets were fragmented or not, and have the same
+ * flow keys either way. The memory of both stages is charged to one pcpp#MemoryBudget.
+ *
+ * Both stages can be sharded by one hash, so a fragmented packet and the other packets of its connection are handled by the same instance: the
+ * fragments of a packet don't carry its ports, so the 5-tuple can't be used, but all fragments and TCP packets of a connection have the same IP
+ * addresses (see pcpp#StreamNormalizer#getShardHash). pcpp#ShardedTcpReassembly runs a normalizer per shard and assigns packets this way when
+ * pcpp#ShardedTcpReassemblyConfiguration#defragment is set
+ */
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * @struct StreamNormalizerConfiguration
+ * A structure for configuring the IP reassembly and the memory of the StreamNormalizer class. TCP reassembly is configured by a
+ * TcpReassemblyConfiguration
+ */
+struct StreamNormalizerConfiguration
+{
+	/** The maximum number of packets being reassembled from fragments at the same time (see the maxPacketsToStore parameter of the IPReassembly c'tor) */
+	size_t maxFragmentedPackets;
+
+	/** The number of seconds a fragmented packet may take to be reassembled, or 0 if fragmented packets never time out (see the fragmentTimeout
+	 * parameter of the IPReassembly c'tor)
+	 */
+	uint32_t fragmentTimeout;
+
+	/** The maximum number of bytes both stages may take together. If it's 0 TcpReassemblyConfiguration#maxMemoryBytes is the limit of both stages */
+	size_t maxMemoryBytes;
+
+	/** A pool to take the buffers of reassembled packets from (see IPReassembly#setRawPacketPool()), or NULL for allocating them on the heap */
+	RawPacketPool* rawPacketPool;
+
+	/**
+	 * A c'tor for this struct
+	 * @param[in] maxFragmentedPackets The maximum number of packets being reassembled from fragments. The default is #PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE
+	 * @param[in] fragmentTimeout The reassembly timeout of fragmented packets in seconds. The default is 0 (no timeout)
+	 * @param[in] maxMemoryBytes The maximum number of bytes both stages may take. The default is 0 (the limit of TcpReassemblyConfiguration)
+	 * @param[in] rawPacketPool The pool of the buffers of reassembled packets. The default is NULL
+	 */
+	StreamNormalizerConfiguration(size_t maxFragmentedPackets = PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE, uint32_t fragmentTimeout = 0, size_t maxMemoryBytes = 0,
+			RawPacketPool* rawPacketPool = NULL) :
+		maxFragmentedPackets(maxFragmentedPackets), fragmentTimeout(fragmentTimeout), maxMemoryBytes(maxMemoryBytes), rawPacketPool(rawPacketPool)
+	{
+	}
+};
+
+
+/**
+ * @class StreamNormalizer
+ * An ingest stage which reassembles IP fragments and TCP streams, locating the headers of each packet only once. Please refer to the
+ * documentation at the top of StreamNormalizer.h for understanding how it works
+ */
+class StreamNormalizer
+{
+public:
+
+	/**
+	 * A c'tor for this class
+	 * @param[in] onMessageReadyCallback The callback to be invoked when new data arrives (see TcpReassembly#OnTcpMessageReady)
+	 * @param[in] userCookie A pointer provided by the user which is passed to the callbacks. This parameter is optional, default cookie is NULL
+	 * @param[in] onConnectionStartCallback The callback to be invoked when a new connection is identified. This parameter is optional
+	 * @param[in] onConnectionEndCallback The callback to be invoked when a connection is terminated. This parameter is optional
+	 * @param[in] reassemblyConfig The configuration of TCP reassembly. This parameter is optional, default is the default TcpReassembly configuration
+	 * @param[in] config The configuration of IP reassembly and of the memory budget. This parameter is optional
+	 */
+	StreamNormalizer(TcpReassembly::OnTcpMessageReady onMessageReadyCallback, void* userCookie = NULL, TcpReassembly::OnTcpConnectionStart onConnectionStartCallback = NULL,
+			TcpReassembly::OnTcpConnectionEnd onConnectionEndCallback = NULL, const TcpReassemblyConfiguration& reassemblyConfig = TcpReassemblyConfiguration(),
+			const StreamNormalizerConfiguration& config = StreamNormalizerConfiguration());
+
+	/**
+	 * A c'tor for this class which delivers new data without copying it (see TcpReassembly#OnTcpMessageReadyZeroCopy)
+	 * @param[in] onMessageReadyCallback The callback to be invoked when new data arrives
+	 * @param[in] userCookie A pointer provided by the user which is passed to the callbacks. This parameter is optional, default cookie is NULL
+	 * @param[in] onConnectionStartCallback The callback to be invoked when a new connection is identified. This parameter is optional
+	 * @param[in] onConnectionEndCallback The callback to be invoked when a connection is terminated. This parameter is optional
+	 * @param[in] reassemblyConfig The configuration of TCP reassembly. This parameter is optional, default is the default TcpReassembly configuration
+	 * @param[in] config The configuration of IP reassembly and of the memory budget. This parameter is optional
+	 */
+	StreamNormalizer(TcpReassembly::OnTcpMessageReadyZeroCopy onMessageReadyCallback, void* userCookie = NULL, TcpReassembly::OnTcpConnectionStart onConnectionStartCallback = NULL,
+			TcpReassembly::OnTcpConnectionEnd onConnectionEndCallback = NULL, const TcpReassemblyConfiguration& reassemblyConfig = TcpReassemblyConfiguration(),
+			const StreamNormalizerConfiguration& config = StreamNormalizerConfiguration());
+
+	/**
+	 * Process a raw packet: a fragment is reassembled, and a TCP packet (whether it was fragmented or not) is reassembled into its stream,
+	 * which may invoke the callbacks. Other packets are handled as TcpReassembly#reassemblePacket(RawPacket*) handles them, so TCP carried in
+	 * tunnels is still reassembled
+	 * @param[in] rawPacket The raw packet to process. Its data is copied if it's a fragment, so it may be freed when this method returns
+	 */
+	void processPacket(RawPacket* rawPacket);
+
+	/**
+	 * Same as processPacket(RawPacket*) for a raw packet whose headers were already located by FlowKeyExtractor, for example for
+	 * classification or for getShardHash()
+	 * @param[in] rawPacket The raw packet to process
+	 * @param[in] view The view of the raw packet, as filled by FlowKeyExtractor#extract(). It must describe the current data of the raw packet
+	 */
+	void processPacket(RawPacket* rawPacket, const PacketView& view);
+
+	/**
+	 * Process an array of raw packets, in their order in the array. See processPacket(RawPacket*)
+	 * @param[in] rawPacketsArr An array of raw packets
+	 * @param[in] numOfPackets The number of packets in the array
+	 */
+	void processPackets(RawPacket* rawPacketsArr, size_t numOfPackets);
+
+	/**
+	 * Move the time of both stages forward without a packet, closing idle TCP connections and dropping fragmented packets whose
+	 * reassembly timeout passed (see TcpReassembly#advanceTime() and IPReassembly#advanceTime())
+	 * @param[in] currentTime The current time, in the same clock as the packet timestamps
+	 */
+	void advanceTime(const timeval& currentTime);
+
+	/**
+	 * Close all open TCP connections, see TcpReassembly#closeAllConnections(). Fragmented packets which aren't reassembled yet are kept
+	 */
+	void closeAllConnections() { m_TcpReassembly.closeAllConnections(); }
+
+	/**
+	 * @return The TCP reassembly stage, for its connection information, statistics and checkpoints. Packets shouldn't be given to it directly
+	 * if they may be fragmented
+	 */
+	TcpReassembly& getTcpReassembly() { return m_TcpReassembly; }
+
+	/**
+	 * @return The IP reassembly stage, for its statistics and checkpoints
+	 */
+	IPReassembly& getIPReassembly() { return m_IPReassembly; }
+
+	/**
+	 * @return The budget the memory of both stages is charged to
+	 */
+	const MemoryBudget& getMemoryBudget() const { return m_MemoryBudget; }
+
+	/**
+	 * Calculate the hash packets are sharded by so both stages can be sharded together: a symmetric hash (see FlowHash#hashSymmetric()) of
+	 * the source and destination IP addresses only, which is the same for all fragments and all TCP packets of a connection in both directions
+	 * @param[in] view The view of the packet, as filled by FlowKeyExtractor#extract()
+	 * @param[out] hash The hash value
+	 * @return True if the view describes an IPv4 or IPv6 packet, false otherwise (in which case hash isn't set)
+	 */
+	static bool getShardHash(const PacketView& view, uint32_t& hash);
+
+private:
+	// the budget is initialized before the stages which are charged to it
+	MemoryBudget m_MemoryBudget;
+	TcpReassembly m_TcpReassembly;
+	IPReassembly m_IPReassembly;
+
+	void init(const StreamNormalizerConfiguration& config);
+
+	// disable copy c'tor and assignment operator
+	StreamNormalizer(const StreamNormalizer& other);
+	StreamNormalizer& operator=(const StreamNormalizer& other);
+};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_STREAM_NORMALIZER */
@@ -191,27 +191,77 @@ namespace pcpp
 	/**
 	 * @class TLVRecordReader
 	 * A class for reading TLV records data out of a byte stream. This class contains helper methods for retrieving and
-	 * counting TLV records. This is a template class that expects template argument class derived from TLVRecord.
+	 * counting TLV records. This is a template class that expects template argument class derived from TLVRecord.<BR>
+	 * The first time a record is looked up by type the records are walked once, and the types and offsets of the first
+	 * #MaxIndexedRecords records are kept in a small inline index. Following lookups by type search the index instead of
+	 * walking the records again, and records beyond the index (if there are more) are walked starting from the last indexed
+	 * one. The index is dropped when changeTLVRecordCount() is called or when the TLV data length changes
 	 */
 	template<typename TLVRecordType>
 	class TLVRecordReader
 	{
+	public:
+		/**
+		 * The maximum number of records kept in the index of record types and offsets
+		 */
+		static const size_t MaxIndexedRecords = 32;
+
 	private:
 		size_t m_RecordCount;
+		// the length of the TLV data the index was built for, or (size_t)-1 if it isn't built
+		size_t m_IndexedDataLen;
+		size_t m_NumOfIndexedRecords;
+		// false if there are records beyond the index
+		bool m_IndexComplete;
+		uint8_t m_IndexedTypes[MaxIndexedRecords];
+		uint16_t m_IndexedOffsets[MaxIndexedRecords];
+
+		void copyFrom(const TLVRecordReader& other)
+		{
+			m_RecordCount = other.m_RecordCount;
+			m_IndexedDataLen = other.m_IndexedDataLen;
+			m_NumOfIndexedRecords = other.m_NumOfIndexedRecords;
+			m_IndexComplete = other.m_IndexComplete;
+			memcpy(m_IndexedTypes, other.m_IndexedTypes, sizeof(m_IndexedTypes));
+			memcpy(m_IndexedOffsets, other.m_IndexedOffsets, sizeof(m_IndexedOffsets));
+		}
+
+		void buildIndex(uint8_t* tlvDataBasePtr, size_t tlvDataLen)
+		{
+			m_IndexedDataLen = tlvDataLen;
+			m_NumOfIndexedRecords = 0;
+			m_IndexComplete = true;
+
+			TLVRecordType curRec = getFirstTLVRecord(tlvDataBasePtr, tlvDataLen);
+			while (!curRec.isNull())
+			{
+				size_t offset = curRec.getRecordBasePtr() - tlvDataBasePtr;
+				if (m_NumOfIndexedRecords == MaxIndexedRecords || offset > 0xffff)
+				{
+					m_IndexComplete = false;
+					return;
+				}
+
+				m_IndexedTypes[m_NumOfIndexedRecords] = curRec.getType();
+				m_IndexedOffsets[m_NumOfIndexedRecords] = (uint16_t)offset;
+				m_NumOfIndexedRecords++;
+				curRec = getNextTLVRecord(curRec, tlvDataBasePtr, tlvDataLen);
+			}
+		}
 
 	public:
 
 		/**
 		 * A default c'tor for this class
 		 */
-		TLVRecordReader() { m_RecordCount = (size_t)-1; }
+		TLVRecordReader() : m_RecordCount((size_t)-1), m_IndexedDataLen((size_t)-1), m_NumOfIndexedRecords(0), m_IndexComplete(false) { }
 
 		/**
 		 * A default copy c'tor for this class
 		 */
 		TLVRecordReader(const TLVRecordReader& other)
 		{
-			m_RecordCount = other.m_RecordCount;
+			copyFrom(other);
 		}
 
 		/**
@@ -225,7 +275,7 @@ namespace pcpp
 		 */
 		TLVRecordReader& operator=(const TLVRecordReader& other)
 		{
-			m_RecordCount = other.m_RecordCount;
+			copyFrom(other);
 			return *this;
 		}
 
@@ -290,7 +340,28 @@ namespace pcpp
 		 */
 		TLVRecordType getTLVRecord(uint8_t recordType, uint8_t* tlvDataBasePtr, size_t tlvDataLen)
 		{
-			TLVRecordType curRec = getFirstTLVRecord(tlvDataBasePtr, tlvDataLen);
+			if (m_IndexedDataLen != tlvDataLen)
+				buildIndex(tlvDataBasePtr, tlvDataLen);
+
+			for (size_t i = 0; i < m_NumOfIndexedRecords; i++)
+			{
+				if (m_IndexedTypes[i] == recordType)
+					return TLVRecordType(tlvDataBasePtr + m_IndexedOffsets[i]);
+			}
+
+			if (m_IndexComplete)
+				return TLVRecordType(NULL);
+
+			// continue walking the records which follow the index
+			TLVRecordType curRec(NULL);
+			if (m_NumOfIndexedRecords == 0)
+				curRec = getFirstTLVRecord(tlvDataBasePtr, tlvDataLen);
+			else
+			{
+				TLVRecordType lastIndexedRec(tlvDataBasePtr + m_IndexedOffsets[m_NumOfIndexedRecords - 1]);
+				curRec = getNextTLVRecord(lastIndexedRec, tlvDataBasePtr, tlvDataLen);
+			}
+
 			while (!curRec.isNull())
 			{
 				if (curRec.getType() == recordType)
@@ -317,6 +388,12 @@ namespace pcpp
 			if (m_RecordCount != (size_t)-1)
 				return m_RecordCount;
 
+			if (m_IndexedDataLen == tlvDataLen && m_IndexComplete)
+			{
+				m_RecordCount = m_NumOfIndexedRecords;
+				return m_RecordCount;
+			}
+
 			m_RecordCount = 0;
 			TLVRecordType curRec = getFirstTLVRecord(tlvDataBasePtr, tlvDataLen);
 			while (!curRec.isNull())
@@ -332,10 +409,15 @@ namespace pcpp
 		 * As described in getTLVRecordCount(), the TLV record count is being cached for efficiency purposes. So if the
 		 * number of TLV records change, it's the user's responsibility to call this method with the number of TLV records
 		 * being added or removed. If records were added the change should be a positive number, or a negative number
-		 * if records were removed
+		 * if records were removed. The index of record types and offsets is dropped, and rebuilt by the next lookup by type
 		 * @param[in] changedBy Number of records that were added or removed
 		 */
-		void changeTLVRecordCount(int changedBy) { if (m_RecordCount != (size_t)-1) m_RecordCount += changedBy; }
+		void changeTLVRecordCount(int changedBy)
+		{
+			m_IndexedDataLen = (size_t)-1;
+			if (m_RecordCount != (size_t)-1)
+				m_RecordCount += changedBy;
+		}
 	};
 
 
@@ -372,6 +454,9 @@ namespace pcpp
 
 		void init(uint8_t recType, const uint8_t* recValue, uint8_t recValueLen);
 
+		// write the record into a buffer of recordSize bytes: the type, and for records longer than 1 byte the length field and the value
+		void writeRecord(uint8_t* recordBuffer, size_t recordSize, uint8_t recordLenFieldValue) const;
+
 		uint8_t* m_RecValue;
 		uint8_t m_RecValueLen;
 		uint8_t m_RecType;
@@ -0,0 +1,367 @@
+#ifndef PACKETPP_TCP_FLOW_TRACKER
+#define PACKETPP_TCP_FLOW_TRACKER
+
+#include "FlowTable.h"
+#include "PacketView.h"
+#include "RawPacket.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * The reasons TcpFlowTracker reports a connection
+	 */
+	enum TcpFlowEndReason
+	{
+		/** Both sides sent a FIN */
+		TcpFlowEndFin,
+		/** One of the sides sent a RST */
+		TcpFlowEndRst,
+		/** The connection had no packets for longer than the idle timeout */
+		TcpFlowEndIdleTimeout,
+		/** The connection was evicted to make room for a new connection (see TcpFlowTrackerConfiguration#maxConnections) */
+		TcpFlowEndEvicted,
+		/** The connection was reported by TcpFlowTracker#flush() */
+		TcpFlowEndForced
+	};
+
+
+	/**
+	 * @struct TcpFlowDirectionMetrics
+	 * The metrics of the data one side of a TCP connection sent to the other side. All times are in microseconds
+	 */
+	struct TcpFlowDirectionMetrics
+	{
+		/** The number of packets sent */
+		uint32_t packets;
+		/** The number of payload bytes sent, retransmissions included */
+		uint64_t bytes;
+		/** The number of segments carrying data which was sent before (see TcpFlowTracker for how they're told apart from out-of-order segments) */
+		uint32_t retransmissions;
+		/** The number of segments carrying data which was skipped by an earlier segment, and arrived shortly after it */
+		uint32_t outOfOrder;
+		/** The number of times the side advertised a zero window, meaning its receive buffer filled up (consecutive zero window packets count once) */
+		uint32_t zeroWindowEvents;
+		/** The number of RTT samples taken from the data of this direction and the ACKs of the other side */
+		uint32_t rttSamples;
+		/** The smallest RTT sample, or 0 if there are none */
+		uint32_t minRtt;
+		/** The largest RTT sample, or 0 if there are none */
+		uint32_t maxRtt;
+		/** The sum of the RTT samples */
+		uint64_t rttSum;
+
+		/**
+		 * @return The average RTT sample in microseconds, or 0 if there are none
+		 */
+		inline uint32_t getAverageRtt() const { return rttSamples == 0 ? 0 : (uint32_t)(rttSum / rttSamples); }
+	};
+
+
+	/**
+	 * @struct TcpFlowMetrics
+	 * The metrics of a TCP connection as reported by TcpFlowTracker. The client is the side which sent the SYN, or the side which sent the
+	 * first packet seen if the handshake wasn't seen. All times are in microseconds, timestamps are since the epoch and taken from the packets
+	 */
+	struct TcpFlowMetrics
+	{
+		/** The 5-tuple of the connection in the client to server direction */
+		FlowTuple tuple;
+		/** The VLAN ID of the outermost VLAN tag, or 0 if the packets have no VLAN tag */
+		uint16_t vlanId;
+		/** True if the whole three-way handshake was seen */
+		bool handshakeSeen;
+		/** The reason the connection is reported. It's meaningful only for connections reported to the callback */
+		TcpFlowEndReason endReason;
+		/** The timestamp of the first packet */
+		uint64_t firstSeen;
+		/** The timestamp of the last packet */
+		uint64_t lastSeen;
+		/** The time from the SYN to the SYN-ACK, which is the RTT between the capture point and the server, or 0 if it wasn't measured */
+		uint32_t serverHandshakeRtt;
+		/** The time from the SYN-ACK to the ACK completing the handshake, which is the RTT between the capture point and the client, or 0 if
+		 * it wasn't measured */
+		uint32_t clientHandshakeRtt;
+		/** The data the client sent */
+		TcpFlowDirectionMetrics clientToServer;
+		/** The data the server sent */
+		TcpFlowDirectionMetrics serverToClient;
+
+		/**
+		 * @return The end-to-end RTT measured by the handshake, or 0 if the whole handshake wasn't timed
+		 */
+		inline uint32_t getHandshakeRtt() const { return (serverHandshakeRtt == 0 || clientHandshakeRtt == 0) ? 0 : serverHandshakeRtt + clientHandshakeRtt; }
+
+		/**
+		 * @return The duration of the connection in microseconds, from its first packet to its last
+		 */
+		inline uint64_t getDuration() const { return lastSeen - firstSeen; }
+
+		/**
+		 * @param[in] fromClient Whether to calculate the throughput of the data the client sent or the data the server sent
+		 * @return The payload throughput of a direction in bits per second over the duration of the connection, or 0 if the duration is 0
+		 */
+		inline double getThroughput(bool fromClient) const
+		{
+			uint64_t duration = getDuration();
+			return duration == 0 ? 0.0 : (double)(fromClient ? clientToServer.bytes : serverToClient.bytes) * 8 * 1000000 / duration;
+		}
+	};
+
+
+	/**
+	 * @struct TcpFlowTrackerConfiguration
+	 * The configuration of a TcpFlowTracker
+	 */
+	struct TcpFlowTrackerConfiguration
+	{
+		/**
+		 * The number of seconds without packets after which a connection is reported and removed. 0 means connections are only removed when
+		 * they end or are evicted
+		 */
+		uint32_t idleTimeout;
+
+		/**
+		 * The maximum number of connections the tracker keeps. When a new connection arrives while the table is full the least recently seen
+		 * connection is reported with ::TcpFlowEndEvicted. 0 means no limit
+		 */
+		size_t maxConnections;
+
+		/**
+		 * A segment with data which was already skipped counts as out-of-order rather than a retransmission if it arrives less than the
+		 * smallest RTT of its direction after the segment which skipped it, or less than this number of microseconds if no RTT was
+		 * measured yet. Later segments count as retransmissions, since the sender can't have retransmitted before an RTT went by
+		 */
+		uint32_t outOfOrderThreshold;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] idleTimeout The idle timeout in seconds, or 0 for no timeout. Default value is 60
+		 * @param[in] maxConnections The maximum number of connections, or 0 for no limit. Default value is 0
+		 * @param[in] outOfOrderThreshold The out-of-order threshold in microseconds. Default value is 3000
+		 */
+		TcpFlowTrackerConfiguration(uint32_t idleTimeout = 60, size_t maxConnections = 0, uint32_t outOfOrderThreshold = 3000) :
+			idleTimeout(idleTimeout), maxConnections(maxConnections), outOfOrderThreshold(outOfOrderThreshold) {}
+	};
+
+
+	/**
+	 * @struct TcpFlowTrackerStats
+	 * The statistics of a TcpFlowTracker
+	 */
+	struct TcpFlowTrackerStats
+	{
+		/** Number of packets processed */
+		uint64_t packets;
+		/** Number of packets which weren't tracked because they don't contain a TCP header */
+		uint64_t nonTcpPackets;
+		/** Number of connections created */
+		uint64_t connectionsCreated;
+		/** Number of connections reported to the callback */
+		uint64_t connectionsReported;
+	};
+
+
+	/**
+	 * @class TcpFlowTracker
+	 * Measures the health of TCP connections from their headers only: handshake RTT, RTT samples of data and the ACKs acknowledging it,
+	 * retransmissions, out-of-order segments, zero window events and throughput. Unlike TcpReassembly, payloads are never copied or
+	 * buffered and no Packet is created: packets are read with FlowKeyExtractor directly from the raw data, and a connection is a fixed-size
+	 * entry of a FlowTable, so tracking a packet doesn't allocate memory once the table reached its size.<BR>
+	 * The metrics are taken the way a passive monitor can:
+	 * - The handshake is timed in two halves, SYN to SYN-ACK (the RTT to the server) and SYN-ACK to ACK (the RTT to the client). The halves
+	 *   of a retransmitted SYN or SYN-ACK aren't timed, since it's unknown which copy was answered
+	 * - One segment of each direction is timed at a time, from the time it's seen until the other side acknowledges it, so the samples
+	 *   are the RTT between the capture point and the receiver. Samples aren't taken across retransmissions (Karn's algorithm)
+	 * - A segment with data beyond the next expected sequence number skips data, which was lost before the capture point or reordered. When
+	 *   data which was already skipped or seen arrives it counts as out-of-order if it arrived shortly after the segment which skipped it
+	 *   (see TcpFlowTrackerConfiguration#outOfOrderThreshold), otherwise as a retransmission
+	 * - Window scaling doesn't matter for zero window events, so the options aren't parsed
+	 *
+	 * A connection is reported to the callback given in the c'tor when both sides sent a FIN, a side sent a RST, it had no packets for
+	 * TcpFlowTrackerConfiguration#idleTimeout seconds, it was evicted or flush() is called. A connection which ended by a FIN or RST stays
+	 * in the table until its idle timeout (or is removed right away if there's no idle timeout), so packets which follow the end (such as
+	 * the last ACK) don't start a new connection, unless they're a SYN. The metrics of connections which didn't end yet can be read with getMetrics() and getAllMetrics(), for example periodically.
+	 * Time is taken from the packet timestamps, so a tracker works the same on live traffic and on capture files. When no packets arrive for
+	 * a while, advanceTime() reports the connections which became idle.<BR>
+	 * A tracker isn't thread-safe. To track connections on several cores, give each thread its own tracker and make sure both directions of
+	 * a connection reach the same thread: with FlowDispatcher, with RSS configured with a symmetric key (such as FlowHash#DefaultRSSKey,
+	 * which DpdkDevice uses by default) or by distributing packets with getShardIndex()
+	 */
+	class TcpFlowTracker
+	{
+	public:
+
+		/**
+		 * A callback invoked for each connection reported
+		 * @param[in] metrics The metrics of the connection
+		 * @param[in] userCookie The cookie given in the c'tor
+		 */
+		typedef void (*OnConnectionReported)(const TcpFlowMetrics& metrics, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The configuration of the tracker
+		 * @param[in] onConnectionReported The callback to invoke for each connection reported. May be NULL if the metrics are only read
+		 * with getMetrics() and getAllMetrics()
+		 * @param[in] userCookie A pointer passed to the callback. Default value is NULL
+		 */
+		TcpFlowTracker(const TcpFlowTrackerConfiguration& config, OnConnectionReported onConnectionReported, void* userCookie = NULL);
+
+		/**
+		 * Track a raw packet. Its timestamp is used as the current time
+		 * @param[in] rawPacket The packet. The link layer type is taken from RawPacket#getLinkLayerType()
+		 * @return True if the packet was tracked, false if it doesn't contain a TCP header
+		 */
+		bool processPacket(const RawPacket* rawPacket);
+
+		/**
+		 * Track a packet given as raw data
+		 * @param[in] data A pointer to the raw data
+		 * @param[in] dataLen The raw data length in bytes
+		 * @param[in] linkType The link layer type of the raw data, as in FlowKeyExtractor#extract()
+		 * @param[in] timestamp The timestamp of the packet in microseconds since the epoch
+		 * @return True if the packet was tracked, false if it doesn't contain a TCP header
+		 */
+		bool processPacket(const uint8_t* data, size_t dataLen, LinkLayerType linkType, uint64_t timestamp);
+
+		/**
+		 * Move the time of the tracker forward and report the connections which became idle. processPacket() does it with the packet
+		 * timestamps, so it's needed only when there are no packets for a while. Times earlier than the current time are ignored
+		 * @param[in] timestamp The current time in microseconds since the epoch
+		 */
+		void advanceTime(uint64_t timestamp);
+
+		/**
+		 * Report all connections which didn't end yet with ::TcpFlowEndForced and remove all connections, for example before the program exits
+		 */
+		void flush();
+
+		/**
+		 * Get the current metrics of a connection
+		 * @param[in] tuple The 5-tuple of the connection, in either direction
+		 * @param[in] vlanId The VLAN ID of the connection, or 0 if its packets have no VLAN tag. Default value is 0
+		 * @param[out] metrics The metrics of the connection. TcpFlowMetrics#endReason isn't set
+		 * @return True if the connection was found, false otherwise
+		 */
+		bool getMetrics(const FlowTuple& tuple, uint16_t vlanId, TcpFlowMetrics& metrics) const;
+
+		/**
+		 * Get the current metrics of all connections in the table, including connections which ended and wait for their idle timeout
+		 * @param[out] metrics The vector to append the metrics to, in no particular order. TcpFlowMetrics#endReason isn't set
+		 */
+		void getAllMetrics(std::vector<TcpFlowMetrics>& metrics) const;
+
+		/**
+		 * @return The number of connections the tracker currently keeps
+		 */
+		inline size_t getNumOfConnections() const { return m_Connections.size(); }
+
+		/**
+		 * @return The current time of the tracker in microseconds since the epoch, which is the latest time processPacket() or advanceTime()
+		 * were called with
+		 */
+		inline uint64_t getCurrentTime() const { return m_CurrentTime; }
+
+		/**
+		 * Get the tracker statistics
+		 * @param[out] stats The statistics
+		 */
+		inline void getStats(TcpFlowTrackerStats& stats) const { stats = m_Stats; }
+
+		/**
+		 * @return The number of bytes the table of the tracker uses per connection, including the key and the bookkeeping of the table
+		 */
+		static size_t getBytesPerConnection();
+
+		/**
+		 * Choose a tracker for a packet out of several trackers, each used by its own thread, so both directions of a connection are
+		 * tracked by the same tracker. Packets without a TCP header are assigned to tracker 0
+		 * @param[in] rawPacket The packet
+		 * @param[in] numOfShards The number of trackers
+		 * @return The index of the tracker, between 0 and numOfShards-1
+		 */
+		static size_t getShardIndex(const RawPacket* rawPacket, size_t numOfShards);
+
+	private:
+
+		// the connection key: the endpoint which is smaller by IP address and port comes first, so both directions map to the same key. All
+		// bytes are set, including the unused bytes of IPv4 addresses, so keys can be compared as a whole
+		struct ConnectionKey
+		{
+			FlowTuple tuple;
+			uint16_t vlanId;
+
+			inline bool operator==(const ConnectionKey& other) const { return tuple == other.tuple && vlanId == other.vlanId; }
+		};
+
+		struct ConnectionKeyHash
+		{
+			uint64_t operator()(const ConnectionKey& key) const
+			{
+				return hashInteger((uint64_t)FlowHash::hash(key.tuple) | ((uint64_t)key.vlanId << 32));
+			}
+		};
+
+		// the state of the data one side sends. Times are the low 32 bits of microsecond timestamps, so differences are right as long as
+		// they're shorter than about 71 minutes
+		struct SideState
+		{
+			TcpFlowDirectionMetrics metrics;
+			// the sequence number following the highest data seen
+			uint32_t nextSeq;
+			// the ACK number which completes the RTT sample in progress, and the time its segment was seen
+			uint32_t timedSeq;
+			uint32_t timedAt;
+			// the last time nextSeq skipped data, for telling out-of-order segments from retransmissions
+			uint32_t skippedAt;
+			uint8_t flags;
+		};
+
+		struct ConnectionState
+		{
+			uint64_t firstSeen;
+			uint64_t lastSeen;
+			// the time the SYN and the SYN-ACK were seen
+			uint64_t synTime;
+			uint64_t synAckTime;
+			uint32_t serverHandshakeRtt;
+			uint32_t clientHandshakeRtt;
+			// sides[0] sends from the first endpoint of the key
+			SideState sides[2];
+			uint8_t clientSide;
+			uint8_t flags;
+
+			ConnectionState();
+		};
+
+		TcpFlowTrackerConfiguration m_Config;
+		OnConnectionReported m_OnConnectionReported;
+		void* m_UserCookie;
+		FlowTable<ConnectionKey, ConnectionState, ConnectionKeyHash> m_Connections;
+		uint64_t m_CurrentTime;
+		TcpFlowTrackerStats m_Stats;
+
+		static int getKey(const FlowTuple& tuple, uint16_t vlanId, ConnectionKey& key);
+		void trackSegment(ConnectionState& conn, int side, const uint8_t* tcpHeader, uint32_t payloadLength, uint64_t timestamp);
+		static void fillMetrics(const ConnectionKey& key, const ConnectionState& conn, TcpFlowMetrics& metrics);
+		void reportConnection(const ConnectionKey& key, ConnectionState& conn, TcpFlowEndReason reason);
+		static void onConnectionRemoved(const ConnectionKey& key, ConnectionState& conn, FlowRemovalReason reason, void* userCookie);
+
+		// disable copy c'tor and assignment operator
+		TcpFlowTracker(const TcpFlowTracker& other);
+		TcpFlowTracker& operator=(const TcpFlowTracker& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_TCP_FLOW_TRACKER */
@@ -317,6 +317,18 @@ namespace pcpp
 		 * @return The TcpOption object
 		 */
 		TcpOption build() const;
+
+		/**
+		 * @return The size in bytes of the option build() creates, or 0 if the option can't be built out of the parameters defined in the c'tor
+		 */
+		size_t getRecordSize() const;
+
+		/**
+		 * Build the TcpOption object into a buffer given by the caller instead of allocating one, for example directly into the packet data
+		 * @param[in] recordBuffer A buffer of at least getRecordSize() bytes
+		 * @return The TcpOption object, which points to recordBuffer, or a logical NULL object if the option can't be built
+		 */
+		TcpOption build(uint8_t* recordBuffer) const;
 	};
 
 
@@ -366,6 +378,31 @@ namespace pcpp
 		 */
 		inline tcphdr* getTcpHeader() const { return (tcphdr*)m_Data; }
 
+		/**
+		 * @return The source port (in host byte order)
+		 */
+		uint16_t getSrcPort() const;
+
+		/**
+		 * Set the source port
+		 * @param[in] port The port to set (in host byte order)
+		 * @param[in] updateChecksum If set to true the TCP checksum is updated incrementally (RFC 1624) instead of having to call
+		 * computeCalculateFields(). Default value is false
+		 */
+		void setSrcPort(uint16_t port, bool updateChecksum = false);
+
+		/**
+		 * @return The destination port (in host byte order)
+		 */
+		uint16_t getDstPort() const;
+
+		/**
+		 * Set the destination port
+		 * @param[in] port The port to set (in host byte order)
+		 * @param[in] updateChecksum If set to true the TCP checksum is updated incrementally, same as in setSrcPort(). Default value is false
+		 */
+		void setDstPort(uint16_t port, bool updateChecksum = false);
+
 		/**
 		 * Get a TCP option by type
 		 * @param[in] option TCP option type to retrieve
@@ -456,6 +493,8 @@ namespace pcpp
 
 		std::string toString();
 
+		void dump(PacketDumpWriter& writer);
+
 		OsiModelLayer getOsiModelLayer() const { return OsiModelTransportLayer; }
 
 	private:
@@ -470,6 +509,8 @@ namespace pcpp
 		void copyLayerData(const TcpLayer& other);
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(TcpLayer, TCP);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_TCP_LAYER */
@@ -4,8 +4,15 @@
 #include "Packet.h"
 #include "IpAddress.h"
 #include "PointerVector.h"
+#include "TimerWheel.h"
+#include "MemoryBudget.h"
+#include "StateCheckpoint.h"
+#include "MetricsRegistry.h"
+#include "OpenAddressingTable.h"
 #include <map>
 #include <list>
+#include <vector>
+#include <utility>
 #include <time.h>
 
 
@@ -47,6 +54,8 @@
  * - pcpp#TcpReassembly#closeConnection() - Manually close a connection by a flow key
  * - pcpp#TcpReassembly#closeAllConnections() - Manually close all currently opened connections
  * - pcpp#TcpReassembly#OnTcpMessageReady callback - Invoked when new data arrives on a certain connection. Contains the new data as well as connection data (5-tuple, flow key)
+ * - pcpp#TcpReassembly#OnTcpMessageReadyZeroCopy callback - The same as pcpp#TcpReassembly#OnTcpMessageReady but the data isn't copied: it points directly to the TCP payload of the packet
+ *   (or to the stored out-of-order fragment) and is valid only during the callback
  * - pcpp#TcpReassembly#OnTcpConnectionStart callback - Invoked when a new connection is identified
  * - pcpp#TcpReassembly#OnTcpConnectionEnd callback - Invoked when a connection ends (either by FIN/RST or manually by the user)
  *
@@ -54,14 +63,56 @@
  * When the connection is closed the information is not being deleted from memory immediately. There is a delay between these moments. Existence of this delay is caused by two reasons:
  * - pcpp#TcpReassembly#reassemblePacket() should detect the packets that arrive after the FIN packet has been received
  * - the user can use the information about connections managed by pcpp#TcpReassembly instance. Following methods are used for this purpose: pcpp#TcpReassembly#getConnectionInformation and pcpp#TcpReassembly#isConnectionOpen.
+ *
+ * Connections are kept in an open-addressing hash table keyed by the flow key (pcpp#TcpReassembly#ConnectionInfoList), so looking up the connection of a packet is O(1) on average also with
+ * millions of concurrent connections. The reassembly state of open connections is taken from a pool and returned to it when the connection is closed, so a new connection usually doesn't allocate memory.
  * Cleaning of memory can be performed automatically (the default behavior) by pcpp#TcpReassembly#reassemblePacket() or manually by calling pcpp#TcpReassembly#purgeClosedConnections in the user code.
- * Automatic cleaning is performed once per second.
+ * Time is measured by the timestamps of the processed packets rather than the wall clock, so a capture file is handled the same way regardless of how fast it's read. Automatic cleaning is
+ * performed once per second of packet time. When packets stop arriving, time can be moved forward with pcpp#TcpReassembly#advanceTime.
  *
  * The struct pcpp#TcpReassemblyConfiguration allows to setup the parameters of cleanup. Following parameters are supported:
  * - pcpp#TcpReassemblyConfiguration#doNotRemoveConnInfo - if this member is set to false the automatic cleanup mode is applied
  * - pcpp#TcpReassemblyConfiguration#closedConnectionDelay - the value of delay expressed in seconds. The minimum value is 1
  * - pcpp#TcpReassemblyConfiguration#maxNumToClean - to avoid performance overhead when the cleanup is being performed, this parameter is used. It defines the maximum number of items to be removed per one call of pcpp#TcpReassembly#purgeClosedConnections
  *
+ * Connections which don't see a FIN or RST packet can be closed after a period without packets by setting pcpp#TcpReassemblyConfiguration#idleConnectionTimeout. Such connections are ended with
+ * a reason of pcpp#TcpReassembly#TcpReassemblyConnectionClosedByIdleTimeout. Both the idle timeouts and the delay before closed connections are cleaned are kept in timing wheels (pcpp#TimerWheel),
+ * so their cost is proportional to the number of connections which expire and not to the number of connections managed.
+ *
+ * Out-of-order packets are kept per connection side sorted by their sequence number, so handling them is O(log n) per packet also when many are queued. Their payload is copied to buffers taken
+ * from a pool. The memory they take can be limited with the following parameters, and when a limit is exceeded the queued data of the connection side is sent to the user as if the data before it was missing:
+ * - pcpp#TcpReassemblyConfiguration#maxOutOfOrderBytesPerConnection - the maximum number of out-of-order bytes queued for a single connection
+ * - pcpp#TcpReassemblyConfiguration#maxOutOfOrderBytes - the maximum number of out-of-order bytes queued for all connections together
+ *
+ * The total memory taken by open connections, including their out-of-order data, can be capped with pcpp#TcpReassemblyConfiguration#maxMemoryBytes, so a flood of new connections or
+ * out-of-order packets can't exhaust the memory. Each open connection is charged a fixed size for its state plus the buffers of its out-of-order fragments. When the cap is exceeded
+ * connections are closed with a reason of pcpp#TcpReassembly#TcpReassemblyConnectionClosedByMemoryBudget until it isn't, in the order set by
+ * pcpp#TcpReassemblyConfiguration#evictionPolicy (least recently used, oldest or largest first, see pcpp#EvictionPolicy). Their queued data is sent to the user first like when any connection is
+ * closed. Instead of a cap of its own, an instance can share a pcpp#MemoryBudget with other instances or with pcpp#IPReassembly (see pcpp#TcpReassembly#setMemoryBudget). Keeping track of
+ * the memory and of the eviction order is O(1) per packet
+ *
+ * The state of all connections can be saved to a compact binary checkpoint with pcpp#TcpReassembly#saveState and restored by another instance, for example after an analyzer is
+ * restarted for an upgrade, so the connections which were open continue where they stopped instead of starting over in the middle with missing data. The checkpoint holds the connection
+ * table, the sequence numbers of both sides, the queued out-of-order data and the timers. pcpp#TcpReassembly#restoreState validates the whole checkpoint before changing anything and then
+ * rebuilds the table in bulk, sizing the hash table and allocating the reassembly state of all open connections at once
+ *
+ * Most analyzers only need the first bytes of a connection, such as the HTTP headers or the TLS handshake. The number of bytes delivered to the user can be limited per connection side
+ * with pcpp#TcpReassemblyConfiguration#maxBytesPerSide and per connection with pcpp#TcpReassemblyConfiguration#maxBytesPerConnection, and the limits of a single connection can be
+ * changed with pcpp#TcpReassembly#setConnectionByteLimits, also from inside the callbacks. Data past a limit is cut off, and the connection is bypassed: its sequence numbers
+ * aren't tracked anymore, its out-of-order data is dropped and no more data is delivered for it, but it's still closed by its FIN or RST packets, its idle timeout or the memory
+ * budget like any other connection. A connection can also be bypassed directly with pcpp#TcpReassembly#bypassConnection, for example once its protocol was identified. Bypassed
+ * connections are reported to an optional callback (see pcpp#TcpReassembly#setOnConnectionBypassedCallback) so the capture layer can drop their packets before they reach the
+ * reassembly, for example with a pcpp#HeavyHitterBypass or a NIC flow rule
+ *
+ * By default every SYN packet opens a connection with its full reassembly state and invokes the connection start callback, so a SYN flood fills the connection table with
+ * connections which never carry data. Setting pcpp#TcpReassemblyConfiguration#halfOpenTableSize keeps the handshake of new connections in a fixed-size half-open table instead,
+ * holding only the flow key, the initial sequence numbers of both sides, the client port and the time of the SYN per connection. A connection is promoted to the connection table,
+ * and the connection start callback is invoked, only when its handshake is completed by the ACK of the SYN-ACK (or, if
+ * pcpp#TcpReassemblyConfiguration#promoteHalfOpenOnAck is false, only when it carries data). Half-open connections expire after
+ * pcpp#TcpReassemblyConfiguration#halfOpenTimeout seconds, and when the table has no room for a new one the oldest in its bucket is dropped, so a flood costs a fixed amount of
+ * memory and a hash table probe per packet. A SYN-ACK which doesn't answer a SYN in the table is ignored, as are RST and FIN packets of half-open connections, which are removed
+ * from the table. Half-open connections aren't saved by pcpp#TcpReassembly#saveState
+ *
  */
 
 /**
@@ -78,9 +129,9 @@ namespace pcpp
 struct ConnectionData
 {
 	/** Source IP address */
-	IPAddress* srcIP;
+	IPAddressValue srcIP;
 	/** Destination IP address */
-	IPAddress* dstIP;
+	IPAddressValue dstIP;
 	/** Source TCP/UDP port */
 	size_t srcPort;
 	/** Destination TCP/UDP port */
@@ -95,34 +146,31 @@ struct ConnectionData
 	/**
 	 * A c'tor for this struct that basically zeros all members
 	 */
-	ConnectionData() : srcIP(NULL), dstIP(NULL), srcPort(0), dstPort(0), flowKey(0), startTime(), endTime()  {}
-
-	/**
-	 * A d'tor for this strcut. Notice it frees the memory of srcIP and dstIP members
-	 */
-	~ConnectionData();
+	ConnectionData() : srcIP(), dstIP(), srcPort(0), dstPort(0), flowKey(0), startTime(), endTime()  {}
 
 	/**
-	 * A copy constructor for this struct. Notice it clones ConnectionData#srcIP and ConnectionData#dstIP
+	 * Set source IP
+	 * @param[in] sourceIP A pointer to the source IP to set. Its value is copied
 	 */
-	ConnectionData(const ConnectionData& other);
+	void setSrcIpAddress(const IPAddress* sourceIP) { srcIP = IPAddressValue(sourceIP); }
 
 	/**
-	 * An assignment operator for this struct. Notice it clones ConnectionData#srcIP and ConnectionData#dstIP
+	 * Set source IP
+	 * @param[in] sourceIP The source IP to set
 	 */
-	ConnectionData& operator=(const ConnectionData& other);
+	void setSrcIpAddress(const IPAddressValue& sourceIP) { srcIP = sourceIP; }
 
 	/**
-	 * Set source IP
-	 * @param[in] sourceIP A pointer to the source IP to set. Notice the IPAddress object will be cloned
+	 * Set destination IP
+	 * @param[in] destIP A pointer to the destination IP to set. Its value is copied
 	 */
-	void setSrcIpAddress(const IPAddress* sourceIP) { srcIP = sourceIP->clone(); }
+	void setDstIpAddress(const IPAddress* destIP) { dstIP = IPAddressValue(destIP); }
 
 	/**
 	 * Set destination IP
-	 * @param[in] destIP A pointer to the destination IP to set. Notice the IPAddress object will be cloned
+	 * @param[in] destIP The destination IP to set
 	 */
-	void setDstIpAddress(const IPAddress* destIP) { dstIP = destIP->clone(); }
+	void setDstIpAddress(const IPAddressValue& destIP) { dstIP = destIP; }
 
 	/**
 	 * Set startTime of Connection
@@ -135,14 +183,13 @@ struct ConnectionData
 	 * @param[in] endTime integer value
 	 */
 	void setEndTime(const timeval &endTime) { this->endTime = endTime; }
-
-private:
-
-	void copyData(const ConnectionData& other);
 };
 
 
 class TcpReassembly;
+class TcpSegmentCoalescer;
+struct tcphdr;
+struct PacketView;
 
 
 /**
@@ -176,10 +223,10 @@ public:
 
 	/**
 	 * A copy c'tor for this class. Notice the data buffer is copied from the source instance to this instance, so even if the source instance is destroyed the data in this instance
-	 * stays valid. When this instance is destroyed it also frees the data buffer
+	 * stays valid. When this instance is destroyed it also frees the data buffer. This is how data received in TcpReassembly#OnTcpMessageReadyZeroCopy can be kept after the callback returns
 	 * @param[in] other The instance to copy from
 	 */
-	TcpStreamData(TcpStreamData& other);
+	TcpStreamData(const TcpStreamData& other);
 
 	/**
 	 * Overload of the assignment operator. Notice the data buffer is copied from the source instance to this instance, so even if the source instance is destroyed the data in this instance
@@ -243,14 +290,77 @@ struct TcpReassemblyConfiguration
 	 */
 	uint32_t maxNumToClean;
 
+	/** The maximum number of TCP payload bytes of out-of-order packets queued for a single connection. When it's exceeded the queued data of the connection side is sent to the user
+	 * with a missing data indication. If the value is set to 0 there is no limit.
+	 */
+	size_t maxOutOfOrderBytesPerConnection;
+
+	/** The maximum number of TCP payload bytes of out-of-order packets queued for all connections. When it's exceeded the queued data of the connection side the last packet belongs
+	 * to is sent to the user with a missing data indication. If the value is set to 0 there is no limit.
+	 */
+	size_t maxOutOfOrderBytes;
+
+	/** How long a connection may stay without packets before it's closed, expressed in seconds of packet time. If the value is set to 0 idle connections are never closed.
+	 */
+	uint32_t idleConnectionTimeout;
+
+	/** The maximum number of bytes the state and out-of-order data of the open connections may take. When it's exceeded connections are closed by the eviction policy. If the value is
+	 * set to 0 there is no limit.
+	 */
+	size_t maxMemoryBytes;
+
+	/** The order connections are closed in when maxMemoryBytes is exceeded
+	 */
+	EvictionPolicy evictionPolicy;
+
+	/** The maximum number of TCP payload bytes delivered to the user for each side of a connection. When a side reaches it the rest of its data is cut off and the connection is
+	 * bypassed (see TcpReassembly#bypassConnection()). If the value is set to 0 there is no limit.
+	 */
+	size_t maxBytesPerSide;
+
+	/** The maximum number of TCP payload bytes delivered to the user for both sides of a connection together. When it's reached the rest of the data is cut off and the connection
+	 * is bypassed (see TcpReassembly#bypassConnection()). If the value is set to 0 there is no limit.
+	 */
+	size_t maxBytesPerConnection;
+
+	/** The number of half-open connections (a SYN was seen but the handshake wasn't completed) kept in the half-open table, rounded up to a power of 2. Connections stay out of the
+	 * connection table until their handshake is completed. If the value is set to 0 there is no half-open table, and every SYN opens a connection.
+	 */
+	size_t halfOpenTableSize;
+
+	/** How long a half-open connection is kept, expressed in seconds of packet time since its SYN. If the value is set to 0 the default value is used.
+	 * This parameter is only relevant if halfOpenTableSize isn't 0.
+	 */
+	uint32_t halfOpenTimeout;
+
+	/** The flag indicating whether a half-open connection is promoted by the ACK of the SYN-ACK. If it's false connections are promoted only by their first data packet, so
+	 * connections which complete the handshake but never send data don't take state either. This parameter is only relevant if halfOpenTableSize isn't 0.
+	 */
+	bool promoteHalfOpenOnAck;
+
 	/**
 	 * A c'tor for this struct
 	 * @param[in] removeConnInfo The flag indicating whether to remove the connection data after a connection is closed. The default is true
 	 * @param[in] closedConnectionDelay How long the closed connections will not be cleaned up. The value is expressed in seconds. If it's set to 0 the default value will be used. The default is 5.
 	 * @param[in] maxNumToClean The maximum number of items to be cleaned up per one call of purgeClosedConnections. If it's set to 0 the default value will be used. The default is 30.
+	 * @param[in] maxOutOfOrderBytesPerConnection The maximum number of out-of-order bytes queued for a single connection. The default is 0 (no limit)
+	 * @param[in] maxOutOfOrderBytes The maximum number of out-of-order bytes queued for all connections. The default is 0 (no limit)
+	 * @param[in] idleConnectionTimeout How long a connection may stay without packets before it's closed, in seconds. The default is 0 (idle connections are never closed)
+	 * @param[in] maxMemoryBytes The maximum number of bytes the open connections may take. The default is 0 (no limit)
+	 * @param[in] evictionPolicy The order connections are closed in when maxMemoryBytes is exceeded. The default is pcpp#EvictLeastRecentlyUsed
+	 * @param[in] maxBytesPerSide The maximum number of bytes delivered for each side of a connection. The default is 0 (no limit)
+	 * @param[in] maxBytesPerConnection The maximum number of bytes delivered for both sides of a connection. The default is 0 (no limit)
+	 * @param[in] halfOpenTableSize The number of half-open connections kept until their handshake is completed. The default is 0 (no half-open table)
+	 * @param[in] halfOpenTimeout How long a half-open connection is kept, in seconds. The default is 5
+	 * @param[in] promoteHalfOpenOnAck The flag indicating whether a half-open connection is promoted by the ACK of the SYN-ACK rather than by its first data. The default is true
 	 */
-	TcpReassemblyConfiguration(bool removeConnInfo = true, uint32_t closedConnectionDelay = 5, uint32_t maxNumToClean = 30) :
-		removeConnInfo(removeConnInfo), closedConnectionDelay(closedConnectionDelay), maxNumToClean(maxNumToClean)
+	TcpReassemblyConfiguration(bool removeConnInfo = true, uint32_t closedConnectionDelay = 5, uint32_t maxNumToClean = 30, size_t maxOutOfOrderBytesPerConnection = 0, size_t maxOutOfOrderBytes = 0,
+			uint32_t idleConnectionTimeout = 0, size_t maxMemoryBytes = 0, EvictionPolicy evictionPolicy = EvictLeastRecentlyUsed, size_t maxBytesPerSide = 0, size_t maxBytesPerConnection = 0,
+			size_t halfOpenTableSize = 0, uint32_t halfOpenTimeout = 5, bool promoteHalfOpenOnAck = true) :
+		removeConnInfo(removeConnInfo), closedConnectionDelay(closedConnectionDelay), maxNumToClean(maxNumToClean),
+		maxOutOfOrderBytesPerConnection(maxOutOfOrderBytesPerConnection), maxOutOfOrderBytes(maxOutOfOrderBytes), idleConnectionTimeout(idleConnectionTimeout),
+		maxMemoryBytes(maxMemoryBytes), evictionPolicy(evictionPolicy), maxBytesPerSide(maxBytesPerSide), maxBytesPerConnection(maxBytesPerConnection),
+		halfOpenTableSize(halfOpenTableSize), halfOpenTimeout(halfOpenTimeout), promoteHalfOpenOnAck(promoteHalfOpenOnAck)
 	{
 	}
 };
@@ -258,10 +368,14 @@ struct TcpReassemblyConfiguration
 
 /**
  * @class TcpReassembly
- * A class containing the TCP reassembly logic. Please refer to the documentation at the top of TcpReassembly.h for understanding how to use this class
+ * A class containing the TCP reassembly logic. Please refer to the documentation at the top of TcpReassembly.h for understanding how to use this class.
+ * TcpReassembly is a metrics source (see MetricsRegistry) reporting its packet, byte, connection, out-of-order and memory counters
  */
-class TcpReassembly
+class TcpReassembly : public MetricsSource
 {
+private:
+	struct TcpReassemblyData;
+
 public:
 
 	/**
@@ -272,13 +386,161 @@ public:
 		/** Connection ended because of FIN or RST packet */
 		TcpReassemblyConnectionClosedByFIN_RST,
 		/** Connection ended manually by the user */
-		TcpReassemblyConnectionClosedManually
+		TcpReassemblyConnectionClosedManually,
+		/** Connection ended because no packets were seen on it for longer than TcpReassemblyConfiguration#idleConnectionTimeout */
+		TcpReassemblyConnectionClosedByIdleTimeout,
+		/** Connection ended to free memory because the memory budget was exceeded (see TcpReassemblyConfiguration#maxMemoryBytes) */
+		TcpReassemblyConnectionClosedByMemoryBudget
 	};
 
 	/**
-	 * The type for storing the connection information
+	 * @class ConnectionInfoList
+	 * The type for storing the connection information. It's an open-addressing hash table of all connections managed by a TcpReassembly instance keyed by their flow key, which is
+	 * also where TcpReassembly looks up the connection of each packet. It provides the part of the std::map interface needed for looking up and iterating connections (find(), count(),
+	 * size(), empty(), begin() and end()), and its iterators point to a std::pair of the flow key and the ConnectionData. Unlike std::map the iteration order is unspecified.
+	 * A copy of this list is a snapshot of the connection information which stays valid after the connections are purged from the TcpReassembly instance
 	 */
-	typedef std::map<uint32_t, ConnectionData> ConnectionInfoList;
+	class ConnectionInfoList
+	{
+		friend class TcpReassembly;
+
+	public:
+
+		/**
+		 * The type of the elements iterators point to: the flow key and the connection information
+		 */
+		typedef std::pair<uint32_t, ConnectionData> value_type;
+
+		/**
+		 * @class const_iterator
+		 * A forward iterator over the connections of a ConnectionInfoList. It's invalidated when connections are purged, but not when new connections are added
+		 */
+		class const_iterator
+		{
+			friend class ConnectionInfoList;
+
+		public:
+			const_iterator() : m_List(NULL), m_EntryIndex(0) {}
+
+			const value_type& operator*() const { return m_List->getEntry(m_EntryIndex).value; }
+			const value_type* operator->() const { return &(m_List->getEntry(m_EntryIndex).value); }
+
+			const_iterator& operator++() { m_EntryIndex = m_List->nextEntryInUse(m_EntryIndex + 1); return *this; }
+			const_iterator operator++(int) { const_iterator result = *this; ++(*this); return result; }
+
+			bool operator==(const const_iterator& other) const { return m_List == other.m_List && m_EntryIndex == other.m_EntryIndex; }
+			bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+		private:
+			const ConnectionInfoList* m_List;
+			uint32_t m_EntryIndex;
+
+			const_iterator(const ConnectionInfoList* list, uint32_t entryIndex) : m_List(list), m_EntryIndex(entryIndex) {}
+		};
+
+		/**
+		 * A c'tor for this class which creates an empty list
+		 */
+		ConnectionInfoList();
+
+		/**
+		 * A copy c'tor for this class. Copies the connection information of all connections
+		 * @param[in] other The instance to copy from
+		 */
+		ConnectionInfoList(const ConnectionInfoList& other);
+
+		/**
+		 * A d'tor for this class
+		 */
+		~ConnectionInfoList();
+
+		/**
+		 * Assignment operator. Copies the connection information of all connections
+		 * @param[in] other The instance to copy from
+		 * @return A reference to this instance
+		 */
+		ConnectionInfoList& operator=(const ConnectionInfoList& other);
+
+		/**
+		 * @return An iterator to the first connection in the list
+		 */
+		const_iterator begin() const { return const_iterator(this, nextEntryInUse(0)); }
+
+		/**
+		 * @return An iterator past the last connection in the list
+		 */
+		const_iterator end() const { return const_iterator(this, m_NumOfEntries); }
+
+		/**
+		 * Find a connection by its flow key
+		 * @param[in] flowKey The flow key of the connection
+		 * @return An iterator to the connection or end() if it isn't in the list
+		 */
+		const_iterator find(uint32_t flowKey) const;
+
+		/**
+		 * @param[in] flowKey The flow key of a connection
+		 * @return 1 if the connection is in the list, 0 otherwise
+		 */
+		size_t count(uint32_t flowKey) const { return (findEntry(flowKey) != NULL ? 1 : 0); }
+
+		/**
+		 * @return The number of connections in the list
+		 */
+		size_t size() const { return m_Index.getSize(); }
+
+		/**
+		 * @return True if the list contains no connections
+		 */
+		bool empty() const { return m_Index.getSize() == 0; }
+
+	private:
+		enum
+		{
+			EntryBlockBits = 8,
+			EntryBlockSize = 1 << EntryBlockBits
+		};
+
+		static const uint32_t NullIndex = 0xffffffff;
+
+		struct Entry
+		{
+			value_type value;
+			// the reassembly state of an open connection, NULL if the connection is closed
+			TcpReassemblyData* reassemblyData;
+			// the idle timer of an open connection or the cleanup timer of a closed connection
+			uint32_t timerId;
+			// the next free entry while this entry isn't in use
+			uint32_t nextFree;
+			bool inUse;
+
+			Entry() : value(), reassemblyData(NULL), timerId(TimerWheel::InvalidTimerId), nextFree(NullIndex), inUse(false) {}
+		};
+
+		// a hash table slot. The hash of the flow key is a reversible mix of it, so it identifies the connection without touching the entries
+		struct Slot
+		{
+			uint32_t hash;
+			uint32_t entryIndex;
+
+			Slot() : hash(0), entryIndex(NullIndex) {}
+			bool isEmpty() const { return entryIndex == NullIndex; }
+		};
+
+		// entries are allocated in fixed size blocks so they never move and pointers to them stay valid until they're erased
+		std::vector<Entry*> m_EntryBlocks;
+		uint32_t m_NumOfEntries;
+		uint32_t m_FreeList;
+		OpenAddressingTable<Slot> m_Index;
+
+		inline Entry& getEntry(uint32_t entryIndex) const { return m_EntryBlocks[entryIndex >> EntryBlockBits][entryIndex & (EntryBlockSize - 1)]; }
+		uint32_t nextEntryInUse(uint32_t entryIndex) const;
+		Entry* findEntry(uint32_t flowKey) const;
+		Entry* insertEntry(uint32_t flowKey);
+		bool eraseEntry(uint32_t flowKey);
+		void copyFrom(const ConnectionInfoList& other);
+		void clear();
+	};
 
 	/**
 	 * @typedef OnTcpMessageReady
@@ -289,6 +551,17 @@ public:
 	 */
 	typedef void (*OnTcpMessageReady)(int side, TcpStreamData tcpData, void* userCookie);
 
+	/**
+	 * @typedef OnTcpMessageReadyZeroCopy
+	 * A callback invoked when new data arrives on a connection, without copying the data. The data points directly to the TCP payload of the packet being processed, or to the
+	 * copy TcpReassembly keeps of an out-of-order fragment, and is valid only until the callback returns. To keep the data longer copy the TcpStreamData instance, which copies
+	 * the data buffer
+	 * @param[in] side The side this data belongs to (MachineA->MachineB or vice versa). The value is 0 or 1 where 0 is the first side seen in the connection and 1 is the second side seen
+	 * @param[in] tcpData The TCP data itself + connection information
+	 * @param[in] userCookie A pointer to the cookie provided by the user in TcpReassembly c'tor (or NULL if no cookie provided)
+	 */
+	typedef void (*OnTcpMessageReadyZeroCopy)(int side, const TcpStreamData& tcpData, void* userCookie);
+
 	/**
 	 * @typedef OnTcpConnectionStart
 	 * A callback invoked when a new TCP connection is identified (whether it begins with a SYN packet or not)
@@ -301,11 +574,20 @@ public:
 	 * @typedef OnTcpConnectionEnd
 	 * A callback invoked when a TCP connection is terminated, either by a FIN or RST packet or manually by the user
 	 * @param[in] connectionData Connection information
-	 * @param[in] reason The reason for connection termination: FIN/RST packet or manually by the user
+	 * @param[in] reason The reason for connection termination: FIN/RST packet, idle timeout, memory budget or manually by the user
 	 * @param[in] userCookie A pointer to the cookie provided by the user in TcpReassembly c'tor (or NULL if no cookie provided)
 	 */
 	typedef void (*OnTcpConnectionEnd)(ConnectionData connectionData, ConnectionEndReason reason, void* userCookie);
 
+	/**
+	 * @typedef OnTcpConnectionBypassed
+	 * A callback invoked when a connection is bypassed, either because it reached its byte limits or by TcpReassembly#bypassConnection(). The packets of the connection can be dropped
+	 * from now on before they reach the reassembly, except for its FIN and RST packets if the connection end callback is needed
+	 * @param[in] connectionData Connection information
+	 * @param[in] userCookie A pointer to the cookie provided by the user in TcpReassembly c'tor (or NULL if no cookie provided)
+	 */
+	typedef void (*OnTcpConnectionBypassed)(const ConnectionData& connectionData, void* userCookie);
+
 	/**
 	 * A c'tor for this class
 	 * @param[in] onMessageReadyCallback The callback to be invoked when new data arrives
@@ -316,6 +598,17 @@ public:
 	 */
 	TcpReassembly(OnTcpMessageReady onMessageReadyCallback, void* userCookie = NULL, OnTcpConnectionStart onConnectionStartCallback = NULL, OnTcpConnectionEnd onConnectionEndCallback = NULL, const TcpReassemblyConfiguration &config = TcpReassemblyConfiguration());
 
+	/**
+	 * A c'tor for this class which delivers new data without copying it (see TcpReassembly#OnTcpMessageReadyZeroCopy). The TCP payload is copied only when a packet arrives
+	 * out-of-order and has to be stored until the data before it arrives
+	 * @param[in] onMessageReadyCallback The callback to be invoked when new data arrives
+	 * @param[in] userCookie A pointer to an object provided by the user. This pointer will be returned when invoking the various callbacks. This parameter is optional, default cookie is NULL
+	 * @param[in] onConnectionStartCallback The callback to be invoked when a new connection is identified. This parameter is optional
+	 * @param[in] onConnectionEndCallback The callback to be invoked when a new connection is terminated (either by a FIN/RST packet or manually by the user). This parameter is optional
+	 * @param[in] config Optional parameter for defining special configuration parameters. If not set the default parameters will be set
+	 */
+	TcpReassembly(OnTcpMessageReadyZeroCopy onMessageReadyCallback, void* userCookie = NULL, OnTcpConnectionStart onConnectionStartCallback = NULL, OnTcpConnectionEnd onConnectionEndCallback = NULL, const TcpReassemblyConfiguration &config = TcpReassemblyConfiguration());
+
 	/**
 	 * A d'tor for this class. Frees all internal structures. Notice that if the d'tor is called while connections are still open, all data is lost and TcpReassembly#OnTcpConnectionEnd won't
 	 * be called for those connections
@@ -331,11 +624,40 @@ public:
 
 	/**
 	 * The most important method of this class which gets a raw packet from the user and processes it. If this packet opens a new connection, ends a connection or contains new data on an
-	 * existing connection, the relevant callback will be invoked (TcpReassembly#OnTcpMessageReady, TcpReassembly#OnTcpConnectionStart, TcpReassembly#OnTcpConnectionEnd)
+	 * existing connection, the relevant callback will be invoked (TcpReassembly#OnTcpMessageReady, TcpReassembly#OnTcpConnectionStart, TcpReassembly#OnTcpConnectionEnd).<BR>
+	 * Unlike reassemblePacket(Packet&) the packet isn't parsed into layers: the IP addresses, ports, TCP flags, sequence number and payload are read from the raw data at
+	 * the offsets FlowKeyExtractor finds. Only packets which may carry TCP inside a tunnel (IP-in-IP, GRE, VXLAN or GTP) or whose link layer FlowKeyExtractor doesn't
+	 * support are parsed as a Packet. The results are the same as those of reassemblePacket(Packet&), including the flow keys
 	 * @param[in] tcpRawData A reference to the raw packet to process
 	 */
 	void reassemblePacket(RawPacket* tcpRawData);
 
+	/**
+	 * Same as reassemblePacket(RawPacket*) for a raw packet whose headers were already located by FlowKeyExtractor, for example by a pipeline
+	 * which classifies or defragments packets before reassembling them (see StreamNormalizer), so they aren't located again
+	 * @param[in] tcpRawData A pointer to the raw packet to process
+	 * @param[in] view The view of the raw packet, as filled by FlowKeyExtractor#extract(). It must describe the current data of the raw packet
+	 */
+	void reassemblePacket(RawPacket* tcpRawData, const PacketView& view);
+
+	/**
+	 * Process an array of raw packets, in their order in the array. Like reassemblePacket(RawPacket*) the TCP fields are read directly from
+	 * the raw data, so this is the fastest way to feed packets captured in bursts (for example from DPDK or AF_XDP devices)
+	 * @param[in] rawPacketsArr An array of raw packets
+	 * @param[in] numOfPackets The number of packets in the array
+	 */
+	void reassemblePackets(RawPacket* rawPacketsArr, size_t numOfPackets);
+
+	/**
+	 * Process a burst of packets coalesced by a TcpSegmentCoalescer, in the order of its segments. A segment of a single packet is processed
+	 * by reassemblePacket(RawPacket*), and a segment of several packets is processed as one TCP segment carrying their merged payload, so
+	 * a bulk transfer costs one connection lookup and one TcpReassembly#OnTcpMessageReady callback per merged segment instead of per
+	 * packet. The merged payload is copied once into a buffer of this class, which also makes it contiguous for the callback. The
+	 * statistics count the original packets
+	 * @param[in] coalescer The coalescer holding the segments of the burst
+	 */
+	void reassembleCoalescedSegments(const TcpSegmentCoalescer& coalescer);
+
 	/**
 	 * Close a connection manually. If the connection doesn't exist or already closed an error log is printed. This method will cause the TcpReassembly#OnTcpConnectionEnd to be invoked with
 	 * a reason of TcpReassembly#TcpReassemblyConnectionClosedManually
@@ -350,8 +672,42 @@ public:
 	void closeAllConnections();
 
 	/**
-	 * Get a map of all connections managed by this TcpReassembly instance (both connections that are open and those that are already closed)
-	 * @return A map of all connections managed. Notice this map is constant and cannot be changed by the user
+	 * Set the byte limits of an open connection, overriding TcpReassemblyConfiguration#maxBytesPerSide and TcpReassemblyConfiguration#maxBytesPerConnection. It may be called from
+	 * inside the callbacks, for example to raise the limits of a connection whose protocol needs more data or to lower them once enough was seen. If the bytes already delivered reach
+	 * the new limits the connection is bypassed right away
+	 * @param[in] flowKey A 4-byte hash key representing the connection. Can be taken from a ConnectionData instance
+	 * @param[in] maxBytesPerSide The maximum number of bytes delivered for each side of the connection, or 0 for no limit
+	 * @param[in] maxBytesPerConnection The maximum number of bytes delivered for both sides of the connection, or 0 for no limit
+	 * @return True if the limits were set, false if the connection doesn't exist or is closed
+	 */
+	bool setConnectionByteLimits(uint32_t flowKey, size_t maxBytesPerSide, size_t maxBytesPerConnection);
+
+	/**
+	 * Bypass an open connection: its sequence numbers aren't tracked anymore, its out-of-order data is dropped and no more data is delivered for it, while its FIN and RST packets
+	 * still close it. A bypassed connection stays bypassed until it's closed. It may be called from inside the callbacks. The TcpReassembly#OnTcpConnectionBypassed callback is
+	 * invoked if it's set
+	 * @param[in] flowKey A 4-byte hash key representing the connection. Can be taken from a ConnectionData instance
+	 * @return True if the connection is bypassed, false if it doesn't exist or is closed
+	 */
+	bool bypassConnection(uint32_t flowKey);
+
+	/**
+	 * Check if an open connection is bypassed, so a capture layer in front of the reassembly can drop its packets
+	 * @param[in] flowKey A 4-byte hash key representing the connection. Can be taken from a ConnectionData instance
+	 * @return True if the connection is open and bypassed, false otherwise
+	 */
+	bool isConnectionBypassed(uint32_t flowKey) const;
+
+	/**
+	 * Set the callback invoked when a connection is bypassed
+	 * @param[in] onConnectionBypassedCallback The callback, or NULL to remove the current one
+	 */
+	void setOnConnectionBypassedCallback(OnTcpConnectionBypassed onConnectionBypassedCallback) { m_OnConnBypassed = onConnectionBypassedCallback; }
+
+	/**
+	 * Get a view of all connections managed by this TcpReassembly instance (both connections that are open and those that are already closed). The view is the
+	 * connection table itself, so getting it doesn't copy anything
+	 * @return A list of all connections managed. Notice this list is constant and cannot be changed by the user
 	 */
 	const ConnectionInfoList &getConnectionInformation() const { return m_ConnectionInfo; }
 
@@ -369,30 +725,155 @@ public:
 	 */
 	uint32_t purgeClosedConnections(uint32_t maxNumToClean = 0);
 
+	/**
+	 * Move the time of this instance forward without a packet, for example when a live capture has no traffic. Idle connections whose timeout passed are closed, and if automatic cleanup
+	 * is enabled closed connections whose delay passed are cleaned up. The time otherwise moves with the timestamps of the processed packets, and earlier times are ignored
+	 * @param[in] currentTime The current time, in the same clock as the packet timestamps
+	 */
+	void advanceTime(const timeval& currentTime);
+
+	/**
+	 * @return The number of TCP payload bytes of out-of-order packets currently queued for all connections
+	 */
+	size_t getOutOfOrderBytes() const { return m_OutOfOrderBytes; }
+
+	/**
+	 * Charge the memory of this instance to a budget shared with other instances or with IPReassembly, instead of the budget set by TcpReassemblyConfiguration#maxMemoryBytes.
+	 * The memory already taken moves to the new budget, and connections are closed if the new budget is exceeded
+	 * @param[in] budget The budget to use. It must outlive this instance or be replaced before this instance is destroyed. If it's NULL the instance goes back to its own budget
+	 */
+	void setMemoryBudget(MemoryBudget* budget);
+
+	/**
+	 * @return The budget the memory of this instance is charged to
+	 */
+	const MemoryBudget* getMemoryBudget() const { return m_MemoryBudget; }
+
+	/**
+	 * @return The number of bytes the state and out-of-order data of the open connections of this instance take, as charged to the memory budget
+	 */
+	size_t getMemoryUsage() const { return m_MemoryBytes; }
+
+	/**
+	 * @return The number of connections closed because the memory budget was exceeded
+	 */
+	uint64_t getNumOfEvictedConnections() const { return m_NumOfEvictedConnections; }
+
+	/**
+	 * @return The number of TCP packets processed, not including ICMP packets carrying TCP data
+	 */
+	uint64_t getNumOfPacketsProcessed() const { return m_NumOfPacketsProcessed; }
+
+	/**
+	 * @return The number of TCP payload bytes processed
+	 */
+	uint64_t getNumOfPayloadBytesProcessed() const { return m_NumOfPayloadBytesProcessed; }
+
+	/**
+	 * @return The number of connections started, not including connections restored by restoreState()
+	 */
+	uint64_t getNumOfConnectionsStarted() const { return m_NumOfConnectionsStarted; }
+
+	/**
+	 * @return The number of connections bypassed, either because they reached their byte limits or by bypassConnection()
+	 */
+	uint64_t getNumOfBypassedConnections() const { return m_NumOfBypassedConnections; }
+
+	/**
+	 * @return The number of TCP payload bytes of bypassed connections which weren't reassembled
+	 */
+	uint64_t getNumOfBypassedPayloadBytes() const { return m_NumOfBypassedPayloadBytes; }
+
+	/**
+	 * @return The number of currently open connections
+	 */
+	size_t getNumOfOpenConnections() const { return m_NumOfOpenConnections; }
+
+	/**
+	 * @return The number of entries in use in the half-open table, including half-open connections which expired but whose entries weren't reused yet
+	 */
+	size_t getNumOfHalfOpenConnections() const { return m_NumOfHalfOpenConnections; }
+
+	/**
+	 * @return The number of half-open connections promoted to the connection table because their handshake was completed or they carried data
+	 */
+	uint64_t getNumOfPromotedConnections() const { return m_NumOfPromotedConnections; }
+
+	/**
+	 * @return The number of half-open connections which expired (see TcpReassemblyConfiguration#halfOpenTimeout)
+	 */
+	uint64_t getNumOfExpiredHalfOpenConnections() const { return m_NumOfExpiredHalfOpenConnections; }
+
+	/**
+	 * @return The number of half-open connections dropped before they expired because the half-open table had no room for new ones
+	 */
+	uint64_t getNumOfDroppedHalfOpenConnections() const { return m_NumOfDroppedHalfOpenConnections; }
+
+	/**
+	 * Report the counters of this instance to a MetricsRegistry snapshot: packets and payload bytes processed, connections started and currently open,
+	 * evicted and bypassed connections, bypassed bytes, out-of-order bytes, memory usage and the half-open table. The counters are plain variables updated by the thread processing the packets, so when
+	 * the snapshot is taken by another thread they may be slightly behind
+	 * @param[in] writer The writer to report the values to
+	 */
+	void collectMetrics(MetricsWriter& writer);
+
+	/**
+	 * Save the state of all connections managed by this instance to a checkpoint: their connection information, the sequence numbers of both sides, the queued out-of-order
+	 * data, their byte limits and bypass state and their timers. The state of other instances or of IPReassembly can be written to the same checkpoint after it
+	 * @param[in] writer The writer of the checkpoint
+	 */
+	void saveState(CheckpointWriter& writer) const;
+
+	/**
+	 * Save the state of all connections to a checkpoint file, see saveState(CheckpointWriter&). The file is replaced only when the whole checkpoint was written
+	 * @param[in] fileName The file name
+	 * @return True if the file was written, false otherwise
+	 */
+	bool saveState(const std::string& fileName) const;
+
+	/**
+	 * Restore the state of connections saved by saveState(). This instance must not manage any connection yet. Restored connections don't invoke the connection start callback
+	 * since it was invoked by the instance which saved them, and their idle, cleanup and eviction order starts over in the order they were saved. If the checkpoint is invalid
+	 * nothing is changed
+	 * @param[in] reader The reader of the checkpoint. When the method succeeds it's positioned after the state of this instance
+	 * @return True if the state was restored, false if this instance already manages connections or the checkpoint is invalid
+	 */
+	bool restoreState(CheckpointReader& reader);
+
+	/**
+	 * Restore the state of connections from a checkpoint file written by saveState(const std::string&), see restoreState(CheckpointReader&)
+	 * @param[in] fileName The file name
+	 * @return True if the state was restored, false otherwise
+	 */
+	bool restoreState(const std::string& fileName);
+
 private:
+	// the payload of an out-of-order packet. The buffer is taken from the fragment buffer pool if the payload fits in it (see allocateFragmentBuffer())
 	struct TcpFragment
 	{
-		uint32_t sequence;
 		size_t dataLength;
 		uint8_t* data;
 
-		TcpFragment() { sequence = 0; dataLength = 0; data = NULL; }
-		~TcpFragment() { if (data != NULL) delete [] data; }
+		TcpFragment() { dataLength = 0; data = NULL; }
 	};
 
+	// out-of-order fragments sorted by their sequence
+	typedef std::map<uint32_t, TcpFragment> TcpFragmentList;
+
 	struct TcpOneSideData
 	{
-		IPAddress* srcIP;
+		IPAddressValue srcIP;
 		uint16_t srcPort;
 		uint32_t sequence;
-		PointerVector<TcpFragment> tcpFragmentList;
+		TcpFragmentList tcpFragmentList;
 		bool gotFinOrRst;
+		// the payload bytes delivered to the user, for the byte limits
+		uint64_t deliveredBytes;
 
-		void setSrcIP(IPAddress* sourrcIP);
+		TcpOneSideData() { srcPort = 0; sequence = 0; gotFinOrRst = false; deliveredBytes = 0; }
 
-		TcpOneSideData() { srcIP = NULL; srcPort = 0; sequence = 0; gotFinOrRst = false; }
-
-		~TcpOneSideData() { if (srcIP != NULL) delete srcIP; }
+		// the fragment buffers must have been released before
+		void reset() { srcIP = IPAddressValue(); srcPort = 0; sequence = 0; tcpFragmentList.clear(); gotFinOrRst = false; deliveredBytes = 0; }
 	};
 
 	struct TcpReassemblyData
@@ -400,35 +881,197 @@ private:
 		int numOfSides;
 		int prevSide;
 		TcpOneSideData twoSides[2];
-		ConnectionData connData;
+		// the connection information, kept in the connection's entry in m_ConnectionInfo
+		ConnectionData* connData;
+		// the payload bytes of the out-of-order fragments of both sides
+		size_t outOfOrderBytes;
+		// the bytes charged to the memory budget for this connection and its item in the eviction list
+		size_t memoryBytes;
+		uint32_t evictionId;
+		// the byte limits of the connection (0 is no limit), and whether it reached them or was bypassed by the user
+		uint64_t maxBytesPerSide;
+		uint64_t maxBytesPerConnection;
+		bool bypassed;
+
+		TcpReassemblyData() { numOfSides = 0; prevSide = -1; connData = NULL; outOfOrderBytes = 0; memoryBytes = 0; evictionId = EvictionList::InvalidItemId; maxBytesPerSide = 0; maxBytesPerConnection = 0; bypassed = false; }
+
+		void reset() { numOfSides = 0; prevSide = -1; twoSides[0].reset(); twoSides[1].reset(); connData = NULL; outOfOrderBytes = 0; memoryBytes = 0; evictionId = EvictionList::InvalidItemId; maxBytesPerSide = 0; maxBytesPerConnection = 0; bypassed = false; }
+	};
+
+	// a connection whose SYN was seen but whose handshake wasn't completed yet. The ports are in network byte order
+	struct HalfOpenEntry
+	{
+		uint32_t flowKey;
+		uint32_t clientIsn;
+		uint32_t serverIsn;
+		uint32_t startTimeSec;
+		uint32_t startTimeUsec;
+		uint16_t clientPort;
+		uint8_t state;
+	};
+
+	enum HalfOpenState
+	{
+		HalfOpenFree = 0,
+		// the SYN was seen
+		HalfOpenSyn = 1,
+		// the SYN-ACK answering the SYN was seen too
+		HalfOpenSynAck = 2
+	};
 
-		TcpReassemblyData() { numOfSides = 0; prevSide = -1; }
+	enum
+	{
+		// the number of entries in a bucket of the half-open table. A new half-open connection replaces the oldest entry of its bucket when the bucket is full
+		HalfOpenBucketSize = 4,
+		// the number of TcpReassemblyData instances allocated at once when the pool is empty
+		ReassemblyDataBlockSize = 64,
+		// the size of pooled fragment buffers, enough for the payload of a full size Ethernet frame. Larger payloads are allocated separately
+		FragmentBufferSize = 2048,
+		// the maximum number of free fragment buffers kept for reuse
+		MaxFreeFragmentBuffers = 1024,
+		// the memory charged for the state of an open connection, and for each out-of-order fragment on top of its buffer
+		ConnectionStateBytes = sizeof(TcpReassemblyData) + sizeof(ConnectionInfoList::Entry) + 2 * sizeof(ConnectionInfoList::Slot),
+		FragmentOverheadBytes = sizeof(TcpFragmentList::value_type) + 4 * sizeof(void*),
+		// the version of the checkpoint format written by saveState(). Version 1 checkpoints, which have no byte limits, are still restored
+		CheckpointVersion = 2
 	};
-	
-	typedef std::map<uint32_t, TcpReassemblyData *> ConnectionList;
-	typedef std::map<time_t, std::list<uint32_t> > CleanupList;
+
+	// identifies the state of a TcpReassembly instance in a checkpoint
+	static const uint32_t CheckpointMagic = 0x52435450;
 
 	OnTcpMessageReady m_OnMessageReadyCallback;
+	OnTcpMessageReadyZeroCopy m_OnMessageReadyZeroCopyCallback;
 	OnTcpConnectionStart m_OnConnStart;
 	OnTcpConnectionEnd m_OnConnEnd;
+	OnTcpConnectionBypassed m_OnConnBypassed;
 	void* m_UserCookie;
-	ConnectionList m_ConnectionList;
 	ConnectionInfoList m_ConnectionInfo;
-	CleanupList m_CleanupList;
+	std::vector<TcpReassemblyData*> m_ReassemblyDataBlocks;
+	std::vector<TcpReassemblyData*> m_FreeReassemblyData;
+	std::vector<uint8_t*> m_FreeFragmentBuffers;
+	size_t m_OutOfOrderBytes;
+	size_t m_MaxOutOfOrderBytesPerConn;
+	size_t m_MaxOutOfOrderBytes;
+	// timers of the open connections for closing them when they're idle, and of the closed connections for cleaning them up. Both are in seconds of packet time
+	TimerWheel m_IdleTimers;
+	TimerWheel m_CleanupTimers;
+	time_t m_CurrentTime;
 	bool m_RemoveConnInfo;
 	uint32_t m_ClosedConnectionDelay;
 	uint32_t m_MaxNumToClean;
-	time_t m_PurgeTimepoint;
+	uint32_t m_IdleConnectionTimeout;
+	// the memory of the open connections, charged to m_MemoryBudget, and the order they're evicted in when it's exceeded
+	MemoryBudget m_OwnMemoryBudget;
+	MemoryBudget* m_MemoryBudget;
+	EvictionList m_EvictionList;
+	size_t m_MemoryBytes;
+	uint64_t m_NumOfEvictedConnections;
+	uint64_t m_NumOfPacketsProcessed;
+	// the merged payload of the coalesced segment being processed
+	std::vector<uint8_t> m_CoalescedPayload;
+	uint64_t m_NumOfPayloadBytesProcessed;
+	uint64_t m_NumOfConnectionsStarted;
+	size_t m_NumOfOpenConnections;
+	size_t m_MaxBytesPerSide;
+	size_t m_MaxBytesPerConnection;
+	uint64_t m_NumOfBypassedConnections;
+	uint64_t m_NumOfBypassedPayloadBytes;
+	// the half-open table, in buckets of HalfOpenBucketSize entries. It's empty if there's no half-open table
+	std::vector<HalfOpenEntry> m_HalfOpenTable;
+	size_t m_HalfOpenBucketMask;
+	uint32_t m_HalfOpenTimeout;
+	bool m_PromoteHalfOpenOnAck;
+	size_t m_NumOfHalfOpenConnections;
+	uint64_t m_NumOfPromotedConnections;
+	uint64_t m_NumOfExpiredHalfOpenConnections;
+	uint64_t m_NumOfDroppedHalfOpenConnections;
+
+	void init(void* userCookie, OnTcpConnectionStart onConnectionStartCallback, OnTcpConnectionEnd onConnectionEndCallback, const TcpReassemblyConfiguration &config);
+
+	inline bool hasMessageReadyCallback() const { return m_OnMessageReadyCallback != NULL || m_OnMessageReadyZeroCopyCallback != NULL; }
+
+	// the fields of a TCP packet the reassembly uses, which are taken either from a parsed Packet or directly from the raw data
+	struct TcpSegmentInfo
+	{
+		IPAddressValue srcIP;
+		IPAddressValue dstIP;
+		const tcphdr* tcpHeader;
+		uint8_t* payload;
+		size_t payloadSize;
+		uint32_t flowKey;
+		timeval timestamp;
+	};
+
+	void processPacket(Packet& tcpData);
+
+	void processRawPacket(RawPacket* tcpRawData);
+
+	void processRawPacket(RawPacket* tcpRawData, const PacketView& view);
+
+	void processTcpView(uint8_t* data, const PacketView& view, uint8_t* payload, size_t payloadSize, const timeval& timestamp);
+
+	void processSegment(const TcpSegmentInfo& segment);
+
+	ConnectionInfoList::Entry* createConnection(uint32_t flowKey, const IPAddressValue& srcIP, const IPAddressValue& dstIP, uint16_t srcPort, uint16_t dstPort, const timeval& startTime);
+
+	bool processHalfOpenSegment(const TcpSegmentInfo& segment, ConnectionInfoList::Entry*& connEntry);
+
+	HalfOpenEntry* findHalfOpenEntry(uint32_t flowKey);
+
+	HalfOpenEntry* insertHalfOpenEntry(uint32_t flowKey);
+
+	inline bool isHalfOpenExpired(const HalfOpenEntry& entry) const { return (time_t)entry.startTimeSec + (time_t)m_HalfOpenTimeout <= m_CurrentTime; }
+
+	void notifyMessageReady(TcpReassemblyData* tcpReassemblyData, int sideIndex, TcpStreamData& streamData);
+
+	void setBypassed(TcpReassemblyData* tcpReassemblyData);
+
+	static bool isOverByteLimits(const TcpReassemblyData* tcpReassemblyData);
 
 	void checkOutOfOrderFragments(TcpReassemblyData* tcpReassemblyData, int sideIndex, bool cleanWholeFragList);
 
+	void insertFragment(TcpReassemblyData* tcpReassemblyData, int sideIndex, uint32_t sequence, const uint8_t* data, size_t dataLength);
+
+	void eraseFragment(TcpReassemblyData* tcpReassemblyData, int sideIndex, TcpFragmentList::iterator fragIter);
+
+	void releaseFragments(TcpReassemblyData* tcpReassemblyData);
+
+	uint8_t* allocateFragmentBuffer(size_t dataLength);
+
+	void releaseFragmentBuffer(uint8_t* buffer, size_t dataLength);
+
+	// the memory charged for an out-of-order fragment: its buffer, which is at least the size of a pooled buffer, and its node in the fragment list
+	static inline size_t getFragmentMemory(size_t dataLength) { return (dataLength > FragmentBufferSize ? dataLength : (size_t)FragmentBufferSize) + FragmentOverheadBytes; }
+
 	std::string prepareMissingDataMessage(uint32_t missingDataLen);
 
 	void handleFinOrRst(TcpReassemblyData* tcpReassemblyData, int sideIndex, uint32_t flowKey);
 
 	void closeConnectionInternal(uint32_t flowKey, ConnectionEndReason reason);
 
-	void insertIntoCleanupList(uint32_t flowKey);
+	void closeConnectionEntry(ConnectionInfoList::Entry* entry, ConnectionEndReason reason);
+
+	void handleIdleTimers();
+
+	void setCurrentTime(time_t currentTime);
+
+	TcpReassemblyData* allocateReassemblyData();
+
+	void allocateReassemblyDataBlock(size_t blockSize);
+
+	size_t readConnections(CheckpointReader& reader, uint16_t version, uint32_t numOfConnections, bool build);
+
+	void releaseReassemblyData(TcpReassemblyData* tcpReassemblyData);
+
+	void chargeMemory(TcpReassemblyData* tcpReassemblyData, size_t bytes);
+
+	void releaseMemory(TcpReassemblyData* tcpReassemblyData, size_t bytes);
+
+	void evictConnections();
+
+	// disable copy c'tor and assignment operator
+	TcpReassembly(const TcpReassembly& other);
+	TcpReassembly& operator=(const TcpReassembly& other);
 };
 
 }
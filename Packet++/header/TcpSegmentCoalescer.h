@@ -0,0 +1,189 @@
+#ifndef PACKETPP_TCP_SEGMENT_COALESCER
+#define PACKETPP_TCP_SEGMENT_COALESCER
+
+#include "RawPacket.h"
+#include "PacketView.h"
+#include "FlowHash.h"
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file
+ * A software implementation of generic receive offload (GRO) for bursts of captured packets. Bulk TCP transfers arrive as long runs of
+ * full-sized segments, and handing each of them to TcpReassembly and the L7 parsers on top of it costs a connection lookup, a callback
+ * and a parser invocation per packet. pcpp#TcpSegmentCoalescer merges consecutive in-order data segments of the same connection within a
+ * burst into a single pcpp#TcpCoalescedSegment, which describes the merged payload as a list of spans pointing into the original packets
+ * (nothing is copied) and keeps the original packets, so they can still be written to a capture file as they arrived.
+ * TcpReassembly#reassembleCoalescedSegments() then processes each merged segment as one TCP segment.
+ *
+ * A segment is merged into the one before it only if it continues it exactly: same connection and direction, the sequence number right
+ * after the previous payload, only the ACK and PSH flags set, not an IP fragment and the whole payload captured. Like GRO, a segment with
+ * PSH is the last of its merged segment, and a SYN, FIN, RST or URG segment, or a segment with payload in the other direction, ends the
+ * merged segment of the connection and is left alone. Pure ACKs, in either direction, don't end it and are left alone too.
+ */
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct TcpPayloadSpan
+	 * A part of a merged TCP payload: the payload of one of the original packets
+	 */
+	struct TcpPayloadSpan
+	{
+		/** A pointer to the payload inside the raw data of the packet */
+		const uint8_t* data;
+		/** The length of the payload */
+		size_t length;
+	};
+
+	/**
+	 * @struct TcpCoalescedSegment
+	 * One or more packets of a burst processed as a single TCP segment. The pointers point into the storage of the
+	 * pcpp#TcpSegmentCoalescer which created the segment and are valid until its next call to TcpSegmentCoalescer#coalesce()
+	 */
+	struct TcpCoalescedSegment
+	{
+		/** The headers of the first packet. For a TCP segment #view.payloadLength is the length of the first packet's payload only */
+		PacketView view;
+		/** True if the first packet was parsed by FlowKeyExtractor, false if its link layer isn't supported */
+		bool isViewValid;
+		/** The number of original packets in this segment */
+		size_t numOfPackets;
+		/** The original packets, in the order they arrived */
+		RawPacket* const* packets;
+		/** The indices of the original packets in the burst */
+		const size_t* packetIndices;
+		/** The payload of each original packet, valid only if #numOfPackets is larger than 1 */
+		const TcpPayloadSpan* spans;
+		/** The sequence number of the first payload byte, in host byte order. Valid only if #numOfPackets is larger than 1 */
+		uint32_t sequenceNumber;
+		/** The length of the merged payload, valid only if #numOfPackets is larger than 1 */
+		size_t payloadLength;
+
+		/**
+		 * Copy the merged payload to a buffer
+		 * @param[out] buffer A buffer of at least #payloadLength bytes
+		 * @return The number of bytes copied
+		 */
+		size_t copyPayload(uint8_t* buffer) const;
+	};
+
+	/**
+	 * @struct TcpSegmentCoalescerConfiguration
+	 * The limits of the segments pcpp#TcpSegmentCoalescer creates
+	 */
+	struct TcpSegmentCoalescerConfiguration
+	{
+		/** The maximum number of packets merged into one segment */
+		size_t maxPacketsPerSegment;
+		/** The maximum length of the payload of a merged segment. A packet which would exceed it starts a new segment */
+		size_t maxSegmentLength;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] maxPacketsPerSegment The maximum number of packets merged into one segment. The default is 64
+		 * @param[in] maxSegmentLength The maximum length of the payload of a merged segment. The default is 65535, the limit of the
+		 * Linux GRO
+		 */
+		TcpSegmentCoalescerConfiguration(size_t maxPacketsPerSegment = 64, size_t maxSegmentLength = 65535)
+			: maxPacketsPerSegment(maxPacketsPerSegment), maxSegmentLength(maxSegmentLength) {}
+	};
+
+	/**
+	 * @class TcpSegmentCoalescer
+	 * Merges consecutive in-order TCP data segments of the same connection within a burst of packets (see the file description). Every
+	 * packet of the burst belongs to exactly one pcpp#TcpCoalescedSegment, and the segments are ordered by their first packet, so
+	 * processing them in order processes every packet once and keeps the order of the packets within each connection. The internal
+	 * storage is reused between bursts, so after the first few bursts coalescing doesn't allocate memory. This class isn't thread-safe
+	 */
+	class TcpSegmentCoalescer
+	{
+	public:
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The limits of the merged segments
+		 */
+		TcpSegmentCoalescer(const TcpSegmentCoalescerConfiguration& config = TcpSegmentCoalescerConfiguration());
+
+		/**
+		 * Coalesce a burst of packets. The segments of the previous burst are discarded
+		 * @param[in] rawPacketsArr An array of raw packets
+		 * @param[in] numOfPackets The number of packets in the array
+		 * @return The number of segments the packets were coalesced into
+		 */
+		size_t coalesce(RawPacket* rawPacketsArr, size_t numOfPackets);
+
+		/**
+		 * Coalesce a burst of packets given as an array of pointers, for example MBufRawPacket objects received from a DPDK device.
+		 * The segments of the previous burst are discarded
+		 * @param[in] rawPackets An array of pointers to raw packets
+		 * @param[in] numOfPackets The number of packets in the array
+		 * @return The number of segments the packets were coalesced into
+		 */
+		size_t coalesce(RawPacket* const* rawPackets, size_t numOfPackets);
+
+		/**
+		 * @return The number of segments of the last burst
+		 */
+		size_t getNumOfSegments() const { return m_Segments.size(); }
+
+		/**
+		 * Get a segment of the last burst
+		 * @param[in] index The index of the segment, smaller than getNumOfSegments()
+		 * @return The segment
+		 */
+		const TcpCoalescedSegment& getSegment(size_t index) const { return m_Segments[index]; }
+
+		/**
+		 * @return The total number of packets merged into a segment they didn't start, in all bursts so far. Each of them is a TCP segment
+		 * TcpReassembly doesn't process separately
+		 */
+		uint64_t getNumOfMergedPackets() const { return m_NumOfMergedPackets; }
+
+		/**
+		 * @return The limits of the merged segments
+		 */
+		const TcpSegmentCoalescerConfiguration& getConfiguration() const { return m_Config; }
+
+	private:
+		// a connection with a segment which may still grow, in the open addressing table of the burst
+		struct OpenSegment
+		{
+			FlowTuple tuple;
+			uint32_t hash;
+			// the index of the segment in m_Segments, -1 if the connection has no segment which may grow, or -2 if the slot is empty
+			int segmentIndex;
+			uint32_t nextSequence;
+		};
+
+		void startBurst(size_t numOfPackets);
+		void addPacket(RawPacket* rawPacket);
+		size_t endBurst();
+		OpenSegment& findConnection(const FlowTuple& tuple, bool& isReverse);
+		size_t addSegment(const PacketView* view);
+
+		TcpSegmentCoalescerConfiguration m_Config;
+		std::vector<TcpCoalescedSegment> m_Segments;
+		std::vector<OpenSegment> m_Connections;
+		size_t m_ConnectionMask;
+		// per packet of the burst, in arrival order: the packet, its segment and its payload
+		std::vector<RawPacket*> m_BurstPackets;
+		std::vector<size_t> m_BurstSegmentIndices;
+		std::vector<TcpPayloadSpan> m_BurstSpans;
+		// the packets, indices and spans of the burst grouped by segment, which the segments point into
+		std::vector<RawPacket*> m_SegmentPackets;
+		std::vector<size_t> m_SegmentPacketIndices;
+		std::vector<TcpPayloadSpan> m_SegmentSpans;
+		std::vector<size_t> m_SegmentOffsets;
+		uint64_t m_NumOfMergedPackets;
+	};
+
+} // namespace pcpp
+
+#endif // PACKETPP_TCP_SEGMENT_COALESCER
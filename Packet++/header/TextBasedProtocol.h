@@ -58,6 +58,28 @@ public:
 	 */
 	std::string getFieldValue() const;
 
+	/**
+	 * @return A pointer to the field name inside the message data, or NULL if the field has no name. The name isn't null-terminated, its
+	 * length is given by getFieldNameLength(). Unlike getFieldName() nothing is copied, so the pointer is valid only until the message is changed
+	 */
+	const char* getFieldNameData() const;
+
+	/**
+	 * @return The length of the field name in bytes, or 0 if the field has no name
+	 */
+	inline size_t getFieldNameLength() const { return (m_FieldNameSize == (size_t)-1 ? 0 : m_FieldNameSize); }
+
+	/**
+	 * @return A pointer to the field value inside the message data, or NULL if the field has no value. The value isn't null-terminated, its
+	 * length is given by getFieldValueLength(). Unlike getFieldValue() nothing is copied, so the pointer is valid only until the message is changed
+	 */
+	const char* getFieldValueData() const;
+
+	/**
+	 * @return The length of the field value in bytes, or 0 if the field has no value
+	 */
+	inline size_t getFieldValueLength() const { return (m_ValueOffsetInMessage == -1 ? 0 : m_FieldValueSize); }
+
 	/**
 	 * A setter for field value
 	 * @param[in] newValue The new value to set to the field. Old value will be deleted
@@ -78,6 +100,9 @@ private:
 	inline HeaderField* getNextField() { return m_NextField; }
 	void initNewField(std::string name, std::string value);
 	void attachToTextBasedProtocolMessage(TextBasedProtocolMessage* message, int fieldOffsetInMessage);
+	bool isFieldNameEqual(const char* name, size_t nameLen);
+	// a case insensitive hash of a field name, kept for each field so looking up a field by name compares the names only on a hash match
+	static uint32_t hashFieldName(const char* name, size_t nameLen);
 	uint8_t* m_NewFieldData;
 	TextBasedProtocolMessage* m_TextBasedProtocolMessage;
 	int m_NameOffsetInMessage;
@@ -89,6 +114,9 @@ private:
 	bool m_IsEndOfHeaderField;
 	char m_NameValueSeperator;
 	bool m_SpacesAllowedBetweenNameAndValue;
+	uint32_t m_NameHash;
+	// the order in which the field was added to the message, fields with the same name are looked up in this order
+	uint32_t m_InsertionIndex;
 };
 
 
@@ -115,7 +143,7 @@ public:
 	 * The default value is 0 (get the first appearance of the field name as appears on the packet)
 	 * @return A pointer to an HeaderField instance, or NULL if field doesn't exist
 	 */
-    HeaderField* getFieldByName(std::string fieldName, int index = 0) const;
+    HeaderField* getFieldByName(const std::string& fieldName, int index = 0) const;
 
 	/**
 	 * @return A pointer to the first header field exists in this message, or NULL if no such field exists
@@ -197,7 +225,7 @@ public:
 	 * The default value is 0 (remove the first appearance of the field name as appears on the packet)
 	 * @return True if the field was removed successfully, or false otherwise (for example: if fieldName doesn't exist in the message, or if the removal failed)
 	 */
-	bool removeField(std::string fieldName, int index = 0);
+	bool removeField(const std::string& fieldName, int index = 0);
 
 	/**
 	 * Indicate whether the header is complete (ending with end-of-header "\r\n\r\n" or "\n\n") or spread over more packets
@@ -224,7 +252,7 @@ public:
 
 protected:
 	TextBasedProtocolMessage(uint8_t* data, size_t dataLen, Layer* prevLayer, Packet* packet);
-	TextBasedProtocolMessage() : m_FieldList(NULL), m_LastField(NULL), m_FieldsOffset(0) {}
+	TextBasedProtocolMessage() : m_FieldList(NULL), m_LastField(NULL), m_FieldsOffset(0), m_ParsedFields(NULL), m_ParsedFieldsCapacity(0), m_NextInsertionIndex(0) {}
 
 	// copy c'tor
 	TextBasedProtocolMessage(const TextBasedProtocolMessage& other);
@@ -234,6 +262,8 @@ protected:
 
 	void parseFields();
 	void shiftFieldsOffset(HeaderField* fromField, int numOfBytesToShift);
+	void deleteField(HeaderField* field);
+	void deleteAllFields();
 
 	// abstract methods
 	virtual char getHeaderFieldNameValueSeparator() = 0;
@@ -242,9 +272,15 @@ protected:
 	HeaderField* m_FieldList;
 	HeaderField* m_LastField;
 	int m_FieldsOffset;
-	std::multimap<std::string, HeaderField*> m_FieldNameToFieldMap;
+	// the fields parsed from the packet are constructed in a single block allocated by parseFields(), fields added later are
+	// allocated separately
+	HeaderField* m_ParsedFields;
+	size_t m_ParsedFieldsCapacity;
+	uint32_t m_NextInsertionIndex;
 };
 
+PCPP_LAYER_PROTOCOL_TRAITS(TextBasedProtocolMessage, HTTP | SIP | SDP);
+
 
 }
 
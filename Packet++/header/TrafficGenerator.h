@@ -0,0 +1,297 @@
+#ifndef PACKETPP_TRAFFIC_GENERATOR
+#define PACKETPP_TRAFFIC_GENERATOR
+
+#include "RawPacket.h"
+#include "RawPacketPool.h"
+#include "IpAddress.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct TrafficGeneratorConfiguration
+	 * A structure for configuring the TrafficGenerator class
+	 */
+	struct TrafficGeneratorConfiguration
+	{
+		/**
+		 * The distributions flow and payload sizes are drawn from
+		 */
+		enum SizeDistribution
+		{
+			/** Always the minimum value */
+			FixedSize,
+			/** Uniformly distributed between the minimum and the maximum values */
+			UniformSize,
+			/** Pareto distributed (shape 1.2) with the minimum value as the scale, capped at the maximum value. Most values are close to the
+			 * minimum with a heavy tail of large values, similar to real traffic */
+			ParetoSize
+		};
+
+		/** The number of flows to generate */
+		size_t numOfFlows;
+
+		/** The number of flows whose packets are interleaved with each other at any time. When a flow ends a new one starts */
+		size_t maxConcurrentFlows;
+
+		/** The distribution of the flow sizes */
+		SizeDistribution flowSizeDistribution;
+
+		/** The minimum number of data packets (TCP segments or UDP datagrams) in a flow. HTTP flows send this number of packets worth of
+		 * response body and DNS flows always have a single query and response */
+		size_t minPacketsPerFlow;
+
+		/** The maximum number of data packets in a flow */
+		size_t maxPacketsPerFlow;
+
+		/** The distribution of the payload sizes */
+		SizeDistribution payloadSizeDistribution;
+
+		/** The minimum payload size in bytes of data packets */
+		size_t minPayloadSize;
+
+		/** The maximum payload size in bytes of data packets. TCP payloads are limited by the MTU, UDP payloads larger than the MTU are sent
+		 * as IPv4 fragments. The largest possible value is 65507 */
+		size_t maxPayloadSize;
+
+		/** The relative weight of TCP flows carrying random data in the protocol mix */
+		int tcpWeight;
+
+		/** The relative weight of HTTP flows (a GET request and a response) in the protocol mix */
+		int httpWeight;
+
+		/** The relative weight of UDP flows carrying random data in the protocol mix */
+		int udpWeight;
+
+		/** The relative weight of DNS flows (a query and a response) in the protocol mix */
+		int dnsWeight;
+
+		/** The percentage of packets (0-100) which are sent later than they should, swapped with one of the next reorderWindow packets */
+		double reorderPercent;
+
+		/** How many packets a reordered packet may be delayed by */
+		size_t reorderWindow;
+
+		/** The percentage of packets (0-100) which are dropped. TCP sequence numbers advance as if the dropped packets were sent */
+		double lossPercent;
+
+		/** The largest IP packet size. Larger UDP datagrams are fragmented */
+		size_t mtu;
+
+		/** The seed of the pseudo-random generator. The same configuration and seed always generate the same packets */
+		uint32_t seed;
+
+		/** The network client addresses are taken from. The flow number is added to it */
+		IPv4Address clientNetwork;
+
+		/** The network server addresses are taken from. There are up to 16 servers */
+		IPv4Address serverNetwork;
+
+		/** The timestamp of the first packet */
+		timeval startTime;
+
+		/** The time between consecutive packets in microseconds */
+		uint32_t interPacketGapUsec;
+
+		/**
+		 * A c'tor for this struct which sets the default values: 100 flows all running concurrently, 10-100 uniformly distributed packets
+		 * per flow, 64-1400 uniformly distributed payload bytes, an equal mix of all protocols, no reordering or loss, MTU of 1500, clients
+		 * from 10.0.0.0 and servers from 10.128.0.0, and a packet every 10 microseconds starting at time 0
+		 */
+		TrafficGeneratorConfiguration();
+	};
+
+
+	/**
+	 * @class TrafficGenerator
+	 * Generates synthetic, reproducible traffic for load-testing and benchmarking: interleaved TCP, HTTP, UDP and DNS flows with configurable
+	 * flow and payload size distributions, reordering, loss and IPv4 fragmentation (see TrafficGeneratorConfiguration). TCP and HTTP flows
+	 * include the handshake and FIN packets, and their sequence and acknowledgment numbers are consistent so they can be fed into
+	 * TcpReassembly, and fragments can be fed into IPReassembly.
+	 *
+	 * The packet headers are built once with the layer classes (EthLayer, IPv4Layer, TcpLayer, UdpLayer, HttpRequestLayer, HttpResponseLayer
+	 * and DnsLayer) when the generator is created. Generating a packet only copies the relevant template, patches the per-flow and
+	 * per-packet fields (addresses, ports, lengths, sequence numbers, IP ID and so on), copies the payload and calculates the checksums, so
+	 * no layers are created and no memory is allocated per packet.
+	 *
+	 * Packets are pulled from the generator one at a time with getNextPacket(), so they can be kept in memory, written to a file device
+	 * or sent from a capture device:
+	 *
+	 *     TrafficGenerator generator(config);
+	 *     RawPacket rawPacket;
+	 *     while (generator.getNextPacket(rawPacket))
+	 *         writer.writePacket(rawPacket);
+	 *
+	 * When packets are sent in bursts (for example with DpdkDevice#sendPackets()) they should be copied into their own buffers with the
+	 * getNextPacket() overload which takes a RawPacketPool.
+	 * This class isn't thread-safe
+	 */
+	class TrafficGenerator
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. Builds the packet templates and allocates all memory the generator uses
+		 * @param[in] config The generator configuration
+		 */
+		TrafficGenerator(const TrafficGeneratorConfiguration& config);
+
+		/**
+		 * Get the next packet without copying it. The raw packet points to a buffer owned by the generator, which is valid only until the
+		 * next call to getNextPacket() or reset()
+		 * @param[out] rawPacket The raw packet to set the data of
+		 * @return True if a packet was generated, false if all flows ended
+		 */
+		bool getNextPacket(RawPacket& rawPacket);
+
+		/**
+		 * Get the next packet and copy it into a buffer owned by the raw packet
+		 * @param[out] rawPacket The raw packet to copy the data into
+		 * @param[in] pool The pool to take the buffer from. If NULL the buffer is allocated on the heap
+		 * @return True if a packet was generated, false if all flows ended
+		 */
+		bool getNextPacket(RawPacket& rawPacket, RawPacketPool* pool);
+
+		/**
+		 * Generate all remaining packets into memory
+		 * @param[out] packets A vector the generated raw packets are added to. The caller is responsible for freeing them
+		 * @param[in] pool The pool to take the packet buffers from. If NULL the buffers are allocated on the heap
+		 * @return The number of packets added
+		 */
+		size_t generateAll(std::vector<RawPacket*>& packets, RawPacketPool* pool = NULL);
+
+		/**
+		 * Restart generating from the first packet. The same packets are generated again
+		 */
+		void reset();
+
+		/**
+		 * @return The number of flows started so far
+		 */
+		inline size_t getNumOfFlowsStarted() const { return m_NumOfFlowsStarted; }
+
+		/**
+		 * @return The number of packets returned so far
+		 */
+		inline uint64_t getNumOfPacketsGenerated() const { return m_NumOfPacketsGenerated; }
+
+		/**
+		 * @return The number of packets dropped so far according to TrafficGeneratorConfiguration#lossPercent
+		 */
+		inline uint64_t getNumOfPacketsDropped() const { return m_NumOfPacketsDropped; }
+
+		/**
+		 * @return The generator configuration
+		 */
+		inline const TrafficGeneratorConfiguration& getConfiguration() const { return m_Config; }
+
+	private:
+
+		enum FlowType
+		{
+			TcpFlow,
+			HttpFlow,
+			UdpFlow,
+			DnsFlow
+		};
+
+		enum FlowStage
+		{
+			StageSyn,
+			StageSynAck,
+			StageAck,
+			StageRequest,
+			StageResponse,
+			StageData,
+			StageClientFin,
+			StageServerFin,
+			StageDone
+		};
+
+		struct FlowState
+		{
+			FlowType type;
+			FlowStage stage;
+			uint32_t clientIP;
+			uint32_t serverIP;
+			uint16_t clientPort;
+			uint16_t serverPort;
+			uint16_t ipId;
+			uint16_t dnsTransactionId;
+			uint32_t clientSeq;
+			uint32_t serverSeq;
+			size_t packetsLeft;
+			size_t bytesLeft;
+		};
+
+		TrafficGeneratorConfiguration m_Config;
+		int m_TotalWeight;
+		size_t m_MaxTcpPayload;
+		size_t m_MaxFragmentPayload;
+
+		// the templates built with the layer classes
+		std::vector<uint8_t> m_TcpTemplate;
+		std::vector<uint8_t> m_UdpTemplate;
+		std::vector<uint8_t> m_HttpRequest;
+		std::vector<uint8_t> m_HttpResponseHeader;
+		std::vector<uint8_t> m_DnsQuery;
+		std::vector<uint8_t> m_DnsResponse;
+		uint8_t m_ClientMac[6];
+		uint8_t m_ServerMac[6];
+
+		// the payload bytes are taken from this buffer
+		std::vector<uint8_t> m_PayloadPattern;
+		// a UDP datagram is built here before it's fragmented
+		std::vector<uint8_t> m_DatagramBuffer;
+
+		// generated packets wait in slots until they're returned, which is where they're reordered
+		size_t m_SlotSize;
+		std::vector<uint8_t> m_SlotData;
+		std::vector<size_t> m_SlotLength;
+		std::vector<size_t> m_FreeSlots;
+		std::vector<size_t> m_Queue;
+		size_t m_QueueHead;
+		size_t m_QueueCount;
+		int m_LastReturnedSlot;
+
+		std::vector<FlowState> m_ActiveFlows;
+		size_t m_NumOfFlowsStarted;
+		uint64_t m_NumOfPacketsGenerated;
+		uint64_t m_NumOfPacketsDropped;
+		// the traffic and the reordering and loss use separate random sequences, so the same flows are generated with and without them
+		uint64_t m_RandomState;
+		uint64_t m_ImpairmentRandomState;
+
+		// disable copy c'tor and assignment operator
+		TrafficGenerator(const TrafficGenerator& other);
+		TrafficGenerator& operator=(const TrafficGenerator& other);
+
+		void buildTemplates();
+		uint64_t nextRandom();
+		double nextRandomPercent();
+		uint64_t nextImpairmentRandom();
+		size_t drawSize(TrafficGeneratorConfiguration::SizeDistribution distribution, size_t minValue, size_t maxValue);
+		void startFlow(FlowState& flow);
+		bool generateNextStep();
+		void generateFlowPacket(FlowState& flow);
+		uint8_t* allocateSlot();
+		void enqueueSlot(uint8_t* slot, size_t length);
+		bool dequeuePacket(const uint8_t*& data, size_t& length, timeval& timestamp);
+		uint8_t* writeEthAndIPv4(uint8_t* frame, const FlowState& flow, bool fromClient, uint8_t protocol, size_t ipPayloadLen, uint16_t ipId,
+				uint16_t fragmentOffset);
+		void sendTcpPacket(FlowState& flow, bool fromClient, bool syn, bool fin, const uint8_t* payload, size_t payloadLen);
+		void sendUdpDatagram(FlowState& flow, bool fromClient, const uint8_t* payload, size_t payloadLen);
+	};
+
+} // namespace pcpp
+
+#endif // PACKETPP_TRAFFIC_GENERATOR
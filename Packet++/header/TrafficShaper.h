@@ -0,0 +1,291 @@
+#ifndef PACKETPP_TRAFFIC_SHAPER
+#define PACKETPP_TRAFFIC_SHAPER
+
+#include "RawPacket.h"
+#include "RuleClassifier.h"
+#include <map>
+#include <deque>
+#include <vector>
+#include <time.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/** The number of strict priority levels of TrafficShaper. Level 0 is the highest */
+#define PCPP_TRAFFIC_SHAPER_NUM_OF_PRIORITIES 8
+
+/** The number of bytes a class of weight 1 may send in each weighted round-robin round of its priority level */
+#define PCPP_TRAFFIC_SHAPER_QUANTUM 1518
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct TrafficShaperClass
+	 * A traffic class of TrafficShaper, for example the traffic of one customer. Each class has its own queue, an optional rate limit
+	 * enforced by a token bucket, a strict priority level and a weight within its priority level
+	 */
+	struct TrafficShaperClass
+	{
+		/** The class ID. Packets classified by the RuleClassifier set with TrafficShaper#setClassifier() go to the class whose ID is the ID
+		 * of the rule they match */
+		uint32_t id;
+		/** The strict priority level of the class, 0 (highest) to #PCPP_TRAFFIC_SHAPER_NUM_OF_PRIORITIES - 1. A class is served only when
+		 * no class of a higher level has a packet it's allowed to send */
+		uint8_t priority;
+		/** The weight of the class among the classes of its priority level, which share the bandwidth in proportion to their weights.
+		 * Must be larger than 0 */
+		uint32_t weight;
+		/** The maximum rate of the class in bytes per second, or 0 for no limit */
+		uint64_t rateBytesPerSec;
+		/** The size of the token bucket in bytes: the number of bytes the class may send back to back above its rate after it was idle.
+		 * 0 means 10 milliseconds worth of the rate, and at least #PCPP_TRAFFIC_SHAPER_QUANTUM bytes. Ignored when there is no rate limit */
+		uint32_t burstBytes;
+		/** The maximum number of packets queued in the class. Packets which arrive when the queue is full are dropped (tail drop) */
+		uint32_t queueLimit;
+
+		/**
+		 * A c'tor for this struct which creates a class with ID 0, the highest priority, weight 1, no rate limit and a queue of 1024 packets
+		 */
+		TrafficShaperClass();
+	};
+
+
+	/**
+	 * @struct TrafficShaperClassStats
+	 * The statistics of a traffic class of TrafficShaper
+	 */
+	struct TrafficShaperClassStats
+	{
+		/** Number of packets queued in the class */
+		uint64_t enqueuedPackets;
+		/** Number of bytes queued in the class */
+		uint64_t enqueuedBytes;
+		/** Number of packets the class sent */
+		uint64_t sentPackets;
+		/** Number of bytes the class sent */
+		uint64_t sentBytes;
+		/** Number of packets dropped because the queue of the class was full */
+		uint64_t droppedPackets;
+		/** Number of packets currently in the queue of the class */
+		uint32_t queuedPackets;
+		/** Number of bytes currently in the queue of the class */
+		uint64_t queuedBytes;
+	};
+
+
+	/**
+	 * @class TrafficShaper
+	 * A hierarchical traffic shaper for the TX path of any device. Packets are classified into traffic classes (see TrafficShaperClass) by a
+	 * RuleClassifier, or by the caller, and queued per class. dequeue() returns the packets which may be sent at the current time:
+	 *    - The port level limits the total rate with a token bucket (see setPortRate())
+	 *    - Classes of a higher priority level are always served before classes of a lower level
+	 *    - Classes of the same priority level share the bandwidth in proportion to their weights, using deficit round-robin so packet sizes
+	 *      are accounted for
+	 *    - Each class may be limited to a maximum rate with its own token bucket. A class which used up its tokens waits while other
+	 *      classes are served, so the shaper smooths bursts rather than dropping them. Packets are dropped only when the queue of their class
+	 *      is full
+	 *
+	 * The shaper doesn't send packets itself, so it works with DpdkDevice, PcapLiveDevice, PfRingDevice and other devices alike. A TX loop
+	 * looks like this:
+	 *
+	 * @code
+	 * if (!shaper.enqueue(rawPacket))
+	 *     delete rawPacket; // the queue of its class is full
+	 * ...
+	 * RawPacket* packets[64];
+	 * size_t numOfPackets = shaper.dequeue(packets, 64);
+	 * for (size_t i = 0; i < numOfPackets; i++)
+	 *     device->sendPacket(*packets[i]);
+	 * // free or reuse the packets, then wait up to getNextSendDelay() before the next dequeue
+	 * @endcode
+	 *
+	 * Time is given by the caller in all methods which depend on it, and there are overloads which read TimestampClock. All calls must use
+	 * the same clock. This class isn't thread-safe, it should be used by the thread which sends the packets
+	 */
+	class TrafficShaper
+	{
+	public:
+
+		/**
+		 * The value getNextSendDelay() returns when no packet is queued
+		 */
+		static const uint64_t NoPacketsQueued = 0xffffffffffffffffULL;
+
+		/**
+		 * A c'tor for this class. Check isValid() to find out whether the classes are valid
+		 * @param[in] classes The traffic classes. Each class must have a unique ID, a valid priority level and a weight larger than 0
+		 * @param[in] defaultClassId The ID of the class packets which don't match any rule go to. Must be one of the classes
+		 */
+		TrafficShaper(const std::vector<TrafficShaperClass>& classes, uint32_t defaultClassId);
+
+		/**
+		 * A d'tor for this class. Packets still queued aren't freed, call flush() first to get them
+		 */
+		~TrafficShaper();
+
+		/**
+		 * @return True if the classes given in the c'tor are valid, false otherwise. An invalid shaper drops all packets
+		 */
+		inline bool isValid() const { return m_Valid; }
+
+		/**
+		 * Set the classifier enqueue() uses for choosing the class of a packet. The ID of the rule a packet matches is the ID of its class
+		 * @param[in] classifier The classifier, or NULL to put all packets in the default class. It isn't owned by the shaper. If its rules
+		 * may be replaced while the shaper is used, the sending thread should be registered as its reader (see RuleClassifier#registerReader())
+		 */
+		inline void setClassifier(const RuleClassifier* classifier) { m_Classifier = classifier; }
+
+		/**
+		 * Limit the total rate of all classes
+		 * @param[in] rateBytesPerSec The maximum rate in bytes per second, or 0 for no limit
+		 * @param[in] burstBytes The size of the port token bucket in bytes. 0 means 10 milliseconds worth of the rate, and at least
+		 * #PCPP_TRAFFIC_SHAPER_QUANTUM bytes
+		 */
+		void setPortRate(uint64_t rateBytesPerSec, uint32_t burstBytes = 0);
+
+		/**
+		 * Change the rate limit of a class. The tokens the class has are kept, up to the new bucket size
+		 * @param[in] classId The class ID
+		 * @param[in] rateBytesPerSec The maximum rate in bytes per second, or 0 for no limit
+		 * @param[in] burstBytes The size of the token bucket in bytes. 0 means 10 milliseconds worth of the rate, and at least
+		 * #PCPP_TRAFFIC_SHAPER_QUANTUM bytes
+		 * @return False if no class has this ID, true otherwise
+		 */
+		bool setClassRate(uint32_t classId, uint64_t rateBytesPerSec, uint32_t burstBytes = 0);
+
+		/**
+		 * Classify a packet with the classifier set with setClassifier() and queue it in its class
+		 * @param[in] packet The packet. On success the shaper holds the pointer until dequeue() or flush() returns it, otherwise it's left
+		 * with the caller
+		 * @return True if the packet was queued, false if the queue of its class is full or the shaper isn't valid
+		 */
+		bool enqueue(RawPacket* packet);
+
+		/**
+		 * Queue a packet in a class chosen by the caller
+		 * @param[in] packet The packet. On success the shaper holds the pointer until dequeue() or flush() returns it, otherwise it's left
+		 * with the caller
+		 * @param[in] classId The class ID. Packets of an unknown class go to the default class
+		 * @return True if the packet was queued, false if the queue of its class is full or the shaper isn't valid
+		 */
+		bool enqueue(RawPacket* packet, uint32_t classId);
+
+		/**
+		 * Get the packets which may be sent at a given time, in the order they should be sent
+		 * @param[in] now The current time
+		 * @param[out] packets An array the packets are written to. The caller owns the packets from now on
+		 * @param[in] maxPackets The size of the array
+		 * @return The number of packets written to the array
+		 */
+		size_t dequeue(const timespec& now, RawPacket** packets, size_t maxPackets);
+
+		/**
+		 * Same as dequeue(const timespec&, RawPacket**, size_t) with the current time of TimestampClock
+		 * @param[out] packets An array the packets are written to. The caller owns the packets from now on
+		 * @param[in] maxPackets The size of the array
+		 * @return The number of packets written to the array
+		 */
+		size_t dequeue(RawPacket** packets, size_t maxPackets);
+
+		/**
+		 * Get the time until the next queued packet may be sent, so the sending thread can sleep until then
+		 * @param[in] now The current time
+		 * @return The time in nanoseconds, 0 if a packet may be sent now, or #NoPacketsQueued if no packet is queued
+		 */
+		uint64_t getNextSendDelay(const timespec& now);
+
+		/**
+		 * Same as getNextSendDelay(const timespec&) with the current time of TimestampClock
+		 * @return The time in nanoseconds, 0 if a packet may be sent now, or #NoPacketsQueued if no packet is queued
+		 */
+		uint64_t getNextSendDelay();
+
+		/**
+		 * Remove all queued packets regardless of the rate limits, for example before the shaper is deleted. They aren't counted as sent
+		 * @param[out] packets A vector the packets are added to. The caller owns the packets from now on
+		 */
+		void flush(std::vector<RawPacket*>& packets);
+
+		/**
+		 * @return The number of packets queued in all classes
+		 */
+		inline size_t getNumOfQueuedPackets() const { return m_NumOfQueuedPackets; }
+
+		/**
+		 * Get the statistics of a class
+		 * @param[in] classId The class ID
+		 * @param[out] stats The statistics
+		 * @return False if no class has this ID, true otherwise
+		 */
+		bool getClassStats(uint32_t classId, TrafficShaperClassStats& stats) const;
+
+		/**
+		 * Reset the statistics of all classes. The number of queued packets and bytes isn't reset
+		 */
+		void clearStats();
+
+	private:
+
+		struct TokenBucket
+		{
+			uint64_t rateBytesPerSec;
+			// the tokens are kept in bytes multiplied by 10^9, so the tokens added every nanosecond are exactly the rate. The balance may
+			// be negative after a packet larger than the bucket was sent
+			int64_t tokens;
+			int64_t capacity;
+			uint64_t lastUpdate;
+			bool started;
+
+			void setRate(uint64_t rate, uint32_t burstBytes);
+			void refill(uint64_t now);
+			bool hasTokens(uint32_t bytes) const;
+			void consume(uint32_t bytes);
+			uint64_t getDelay(uint32_t bytes) const;
+		};
+
+		struct ClassState
+		{
+			TrafficShaperClass config;
+			std::deque<RawPacket*> queue;
+			TokenBucket bucket;
+			// the bytes the class may still send in the current round of its priority level
+			uint64_t deficit;
+			TrafficShaperClassStats stats;
+		};
+
+		struct PriorityLevel
+		{
+			std::vector<ClassState*> classes;
+			// the class whose turn it is, and whether its quantum was already added in this turn
+			size_t current;
+			bool turnStarted;
+
+			void nextTurn();
+		};
+
+		bool m_Valid;
+		std::vector<ClassState*> m_Classes;
+		std::map<uint32_t, ClassState*> m_ClassById;
+		ClassState* m_DefaultClass;
+		PriorityLevel m_Levels[PCPP_TRAFFIC_SHAPER_NUM_OF_PRIORITIES];
+		TokenBucket m_PortBucket;
+		const RuleClassifier* m_Classifier;
+		size_t m_NumOfQueuedPackets;
+
+		static uint64_t toNanoseconds(const timespec& time);
+		ClassState* selectClass(PriorityLevel& level, uint64_t now);
+
+		// disable copy c'tor and assignment operator
+		TrafficShaper(const TrafficShaper& other);
+		TrafficShaper& operator=(const TrafficShaper& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_TRAFFIC_SHAPER */
@@ -0,0 +1,160 @@
+#ifndef PACKETPP_TUNNEL_DECAPSULATOR
+#define PACKETPP_TUNNEL_DECAPSULATOR
+
+#include "PacketView.h"
+#include "FlowHash.h"
+#include "RawPacket.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * The tunnel types TunnelDecapsulator understands. The values are bits, so several types can be combined in TunnelInfo#tunnelTypes
+	 */
+	enum TunnelType
+	{
+		/** No tunnel */
+		TunnelNone = 0x00,
+		/** GTP-U (GTPv1 G-PDU messages over UDP) */
+		TunnelGTPU = 0x01,
+		/** VXLAN over UDP */
+		TunnelVXLAN = 0x02,
+		/** GRE (version 0, and version 1 as used by PPTP) */
+		TunnelGRE = 0x04,
+		/** MPLS labels preceding an IP header, in the link layer headers or inside GRE */
+		TunnelMPLS = 0x08,
+		/** IPv4 or IPv6 directly inside IPv4 or IPv6 (IP protocols 4 and 41) */
+		TunnelIPinIP = 0x10
+	};
+
+
+	/**
+	 * @struct TunnelInfo
+	 * A plain struct describing the tunnel headers of a packet, filled by TunnelDecapsulator. It holds the identifiers of the outer tunnels
+	 * and the location and headers of the innermost packet
+	 */
+	struct TunnelInfo
+	{
+		/**
+		 * The maximum number of MPLS labels kept in #mplsLabels
+		 */
+		static const int MaxMplsLabels = 4;
+
+		/** A bitmask of the ::TunnelType values of all tunnels the packet was decapsulated from */
+		uint32_t tunnelTypes;
+		/** The number of tunnel headers the packet was decapsulated from (an MPLS label stack counts as one) */
+		uint8_t numOfTunnels;
+		/** The TEID of the innermost GTP-U tunnel, valid only if #tunnelTypes contains ::TunnelGTPU */
+		uint32_t gtpTeid;
+		/** The VNI of the innermost VXLAN tunnel, valid only if #tunnelTypes contains ::TunnelVXLAN */
+		uint32_t vxlanVni;
+		/** True if the innermost GRE header has a key. For GREv1 the key is the call ID */
+		bool hasGreKey;
+		/** The key of the innermost GRE header, valid only if #hasGreKey is true */
+		uint32_t greKey;
+		/** The number of MPLS labels found, which may be larger than the number of labels kept in #mplsLabels */
+		uint8_t mplsLabelCount;
+		/** The MPLS label values (20 bits each) of the innermost label stack, starting at the top of the stack */
+		uint32_t mplsLabels[MaxMplsLabels];
+		/** The offset of the innermost packet from the beginning of the raw data. 0 if the packet isn't tunneled */
+		uint16_t innerOffset;
+		/** The link layer type of the innermost packet: ::LINKTYPE_ETHERNET for VXLAN and Ethernet over GRE, ::LINKTYPE_RAW for IP packets */
+		LinkLayerType innerLinkType;
+		/**
+		 * The headers of the innermost packet. Its offsets are relative to #innerOffset, so they match the raw packet
+		 * TunnelDecapsulator#setInnerRawData() sets
+		 */
+		PacketView innerView;
+
+		/**
+		 * @return The identifier of the innermost GTP-U or VXLAN tunnel (the TEID or the VNI), the GRE key, or 0 if the packet has none of them
+		 */
+		uint32_t getTunnelId() const;
+	};
+
+
+	/**
+	 * @class TunnelDecapsulator
+	 * Finds the packet carried inside GTP-U, VXLAN, GRE, MPLS and IP-in-IP tunnels directly from the raw data. Instead of creating
+	 * GtpV1Layer, VxlanLayer, GREv0Layer / GREv1Layer, MplsLayer and the outer Ethernet and IP layers, the headers are walked with
+	 * FlowKeyExtractor, the tunnel identifiers are recorded in a TunnelInfo and the inner packet is described by a PacketView. Nothing is
+	 * allocated. Nested tunnels (for example GTP-U inside GRE) are decapsulated up to #MaxTunnelDepth levels.<BR>
+	 * Tunnels are recognized the same way the layers recognize them: GTP-U and VXLAN by their UDP ports in ProtocolRegistry, GRE and
+	 * IP-in-IP by the IP protocol. A tunnel whose inner packet doesn't contain an IP header (for example GTP-C messages or GRE carrying
+	 * something else) isn't decapsulated
+	 */
+	class TunnelDecapsulator
+	{
+	public:
+		/**
+		 * The maximum number of nested tunnel headers which are decapsulated
+		 */
+		static const int MaxTunnelDepth = 4;
+
+		/**
+		 * Decapsulate a raw packet
+		 * @param[in] rawPacket The raw packet. The link layer type is taken from RawPacket#getLinkLayerType()
+		 * @param[out] info The struct to fill. All its fields are overwritten
+		 * @return True if the packet contains an IPv4 or IPv6 header, false otherwise. If the packet isn't tunneled TunnelInfo#innerView
+		 * describes the packet itself
+		 */
+		static bool decapsulate(const RawPacket* rawPacket, TunnelInfo& info);
+
+		/**
+		 * Decapsulate raw data
+		 * @param[in] data A pointer to the raw data
+		 * @param[in] dataLen The raw data length in bytes
+		 * @param[in] linkType The link layer type of the raw data, as in FlowKeyExtractor#extract()
+		 * @param[out] info The struct to fill. All its fields are overwritten
+		 * @return True if the packet contains an IPv4 or IPv6 header, false otherwise. If the packet isn't tunneled TunnelInfo#innerView
+		 * describes the packet itself
+		 */
+		static bool decapsulate(const uint8_t* data, size_t dataLen, LinkLayerType linkType, TunnelInfo& info);
+
+		/**
+		 * Set the raw data of a raw packet to the inner packet of a decapsulated packet, without copying it. A Packet created from it
+		 * starts at the inner Ethernet or IP layer
+		 * @param[in] outerPacket The decapsulated raw packet
+		 * @param[in] info The result of decapsulate() for outerPacket
+		 * @param[out] innerPacket The raw packet to set. It points into the data of outerPacket, so it must be created with
+		 * deleteRawDataAtDestructor set to false, and it's valid only as long as outerPacket is
+		 * @return True if the raw data was set, false if outerPacket doesn't have data beyond TunnelInfo#innerOffset
+		 */
+		static bool setInnerRawData(const RawPacket& outerPacket, const TunnelInfo& info, RawPacket& innerPacket);
+
+		/**
+		 * Get the 5-tuple of the inner packet
+		 * @param[in] info The result of decapsulate()
+		 * @param[out] tuple The inner 5-tuple
+		 * @return True if the inner packet contains an IPv4 or IPv6 header, false otherwise
+		 */
+		static inline bool getInnerTuple(const TunnelInfo& info, FlowTuple& tuple) { return FlowHash::getTuple(info.innerView, tuple); }
+
+		/**
+		 * Hash the inner flow of a decapsulated packet, optionally together with the tunnel identifier (see TunnelInfo#getTunnelId()),
+		 * so inner flows with overlapping addresses in different tunnels get different hash values. Note that the two directions of a
+		 * GTP-U session use different TEIDs, so a symmetric hash which includes the tunnel identifier isn't equal in both directions
+		 * @param[in] info The result of decapsulate()
+		 * @param[in] symmetric If true the hash is calculated with FlowHash#hashSymmetric(), otherwise with FlowHash#hash()
+		 * @param[in] includeTunnelId If true the tunnel identifier is used as the hash seed
+		 * @return The hash value, or 0 if the inner packet doesn't contain an IPv4 or IPv6 header
+		 */
+		static uint32_t hashInnerFlow(const TunnelInfo& info, bool symmetric = false, bool includeTunnelId = true);
+
+	private:
+		static size_t decapsulateUdp(const uint8_t* data, size_t dataLen, const PacketView& view, TunnelInfo& info, LinkLayerType& innerLinkType);
+		static size_t decapsulateGre(const uint8_t* data, size_t dataLen, size_t offset, TunnelInfo& info, LinkLayerType& innerLinkType);
+		static size_t skipMplsLabels(const uint8_t* data, size_t dataLen, size_t offset, TunnelInfo& info);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_TUNNEL_DECAPSULATOR */
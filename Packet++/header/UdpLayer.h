@@ -59,6 +59,31 @@ namespace pcpp
 		 */
 		inline udphdr* getUdpHeader() const { return (udphdr*)m_Data; }
 
+		/**
+		 * @return The source port (in host byte order)
+		 */
+		uint16_t getSrcPort() const;
+
+		/**
+		 * Set the source port
+		 * @param[in] port The port to set (in host byte order)
+		 * @param[in] updateChecksum If set to true the UDP checksum is updated incrementally (RFC 1624) (unless the checksum is 0, which means it isn't used) instead of having to call
+		 * computeCalculateFields(). Default value is false
+		 */
+		void setSrcPort(uint16_t port, bool updateChecksum = false);
+
+		/**
+		 * @return The destination port (in host byte order)
+		 */
+		uint16_t getDstPort() const;
+
+		/**
+		 * Set the destination port
+		 * @param[in] port The port to set (in host byte order)
+		 * @param[in] updateChecksum If set to true the UDP checksum is updated incrementally, same as in setSrcPort(). Default value is false
+		 */
+		void setDstPort(uint16_t port, bool updateChecksum = false);
+
 		/**
 		 * Calculate the checksum from header and data and possibly write the result to @ref udphdr#headerChecksum
 		 * @param[in] writeResultToPacket If set to true then checksum result will be written to @ref udphdr#headerChecksum
@@ -86,9 +111,16 @@ namespace pcpp
 
 		std::string toString();
 
+		void dump(PacketDumpWriter& writer);
+
         OsiModelLayer getOsiModelLayer() const { return OsiModelTransportLayer; }
+
+	private:
+		void updateChecksumForField(uint16_t oldValue, uint16_t newValue);
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(UdpLayer, UDP);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_UDP_LAYER */
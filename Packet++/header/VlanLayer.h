@@ -131,9 +131,13 @@ namespace pcpp
 
 		std::string toString();
 
+		void dump(PacketDumpWriter& writer);
+
 		OsiModelLayer getOsiModelLayer() const { return OsiModelDataLinkLayer; }
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(VlanLayer, VLAN);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_VLAN_LAYER */
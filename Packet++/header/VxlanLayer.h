@@ -134,6 +134,8 @@ namespace pcpp
 
 	};
 
+	PCPP_LAYER_PROTOCOL_TRAITS(VxlanLayer, VXLAN);
+
 }
 
 #endif // PACKETPP_VXLAN_LAYER
@@ -45,14 +45,33 @@ void ArpLayer::computeCalculateFields()
 
 std::string ArpLayer::toString()
 {
+	return PacketDumpWriter::layerToString(*this);
+}
+
+void ArpLayer::dump(PacketDumpWriter& writer)
+{
+	writer.beginLayer("ARP Layer", ARP);
 	if (ntohs(getArpHeader()->opcode) == ARP_REQUEST)
 	{
-		return "ARP Layer, ARP request, who has " + getTargetIpAddr().toString() + " ? Tell " + getSenderIpAddr().toString();
+		writer.addText("ARP request, who has ");
+		writer.appendIPAddress(getTargetIpAddr());
+		writer.appendText(" ? Tell ");
+		writer.appendIPAddress(getSenderIpAddr());
+		writer.addString(NULL, "opcode", "request");
 	}
 	else
 	{
-		return "ARP Layer, ARP reply, " + getSenderIpAddr().toString() + " is at " + getSenderMacAddress().toString();
+		writer.addText("ARP reply, ");
+		writer.appendIPAddress(getSenderIpAddr());
+		writer.appendText(" is at ");
+		writer.appendMacAddress(getSenderMacAddress());
+		writer.addString(NULL, "opcode", "reply");
 	}
+
+	writer.addIPAddress(NULL, "senderIp", getSenderIpAddr());
+	writer.addMacAddress(NULL, "senderMac", getSenderMacAddress());
+	writer.addIPAddress(NULL, "targetIp", getTargetIpAddr());
+	writer.endLayer();
 }
 
 } // namespace pcpp
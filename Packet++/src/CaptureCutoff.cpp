@@ -0,0 +1,148 @@
+#include "CaptureCutoff.h"
+#include "IPv4Layer.h"
+#include <string.h>
+
+#define TCP_SYN_FLAG 0x02
+#define TCP_ACK_FLAG 0x10
+
+namespace pcpp
+{
+
+// order the endpoints of a tuple so both directions of a flow get the same key
+static void normalizeTuple(FlowTuple& tuple)
+{
+	int cmp = memcmp(tuple.srcIP, tuple.dstIP, sizeof(tuple.srcIP));
+	if (cmp < 0 || (cmp == 0 && tuple.srcPort <= tuple.dstPort))
+		return;
+
+	uint8_t ip[16];
+	memcpy(ip, tuple.srcIP, sizeof(ip));
+	memcpy(tuple.srcIP, tuple.dstIP, sizeof(ip));
+	memcpy(tuple.dstIP, ip, sizeof(ip));
+	uint16_t port = tuple.srcPort;
+	tuple.srcPort = tuple.dstPort;
+	tuple.dstPort = port;
+}
+
+CaptureCutoff::CaptureCutoff(const CaptureCutoffConfiguration& config) :
+	m_Config(config), m_Table(FlowTableConfiguration(config.maxFlows, config.idleTimeout, EvictLeastRecentlyUsed, config.memoryBudget)),
+	m_Exemptions(NULL)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+bool CaptureCutoff::isExempt(const PacketView& view) const
+{
+	if (m_Exemptions == NULL)
+		return false;
+
+	if (m_Exemptions->classify(view) != RuleClassifier::NoMatch)
+		return true;
+
+	// the first packet seen may be of either direction
+	PacketView reversed = view;
+	memcpy(reversed.srcIP, view.dstIP, sizeof(reversed.srcIP));
+	memcpy(reversed.dstIP, view.srcIP, sizeof(reversed.dstIP));
+	reversed.srcPort = view.dstPort;
+	reversed.dstPort = view.srcPort;
+	return m_Exemptions->classify(reversed) != RuleClassifier::NoMatch;
+}
+
+size_t CaptureCutoff::getHeadersLength(const PacketView& view, size_t dataLen) const
+{
+	size_t headersLen;
+	if (view.payloadOffset != PacketView::NoOffset)
+		headersLen = view.payloadOffset;
+	else if (view.transportOffset == PacketView::NoOffset && view.ipPayloadOffset != PacketView::NoOffset)
+		headersLen = view.ipPayloadOffset;
+	else
+		// a TCP or UDP packet without payload, or a fragment
+		return dataLen;
+
+	headersLen += m_Config.truncatedPayloadLength;
+	return (headersLen < dataLen ? headersLen : dataLen);
+}
+
+CaptureCutoffResult CaptureCutoff::process(RawPacket* rawPacket)
+{
+	size_t dataLen = (size_t)rawPacket->getRawDataLen();
+	m_Stats.packets++;
+	m_Stats.bytes += dataLen;
+	m_Table.advanceTime((uint64_t)rawPacket->getPacketTimeStampNs().tv_sec);
+
+	PacketView view;
+	FlowTuple tuple;
+	if (!FlowKeyExtractor::extract(rawPacket, view) || !FlowHash::getTuple(view, tuple))
+	{
+		m_Stats.nonIpPackets++;
+		m_Stats.keptPackets++;
+		m_Stats.outputBytes += dataLen;
+		return CutoffPacketKept;
+	}
+
+	normalizeTuple(tuple);
+	bool isNew;
+	FlowState& flow = m_Table.get(tuple, &isNew);
+	bool isSyn = (view.ipProtocol == PACKETPP_IPPROTO_TCP && (view.tcpFlags & (TCP_SYN_FLAG | TCP_ACK_FLAG)) == TCP_SYN_FLAG);
+	if (isNew || isSyn)
+	{
+		flow.bytes = 0;
+		flow.packets = 0;
+		flow.exempt = isExempt(view);
+	}
+
+	bool withinLimits = (m_Config.maxBytesPerFlow == 0 || flow.bytes < m_Config.maxBytesPerFlow) &&
+			(m_Config.maxPacketsPerFlow == 0 || flow.packets < m_Config.maxPacketsPerFlow);
+	flow.bytes += dataLen;
+	flow.packets++;
+
+	if (flow.exempt || withinLimits)
+	{
+		if (flow.exempt)
+			m_Stats.exemptPackets++;
+		m_Stats.keptPackets++;
+		m_Stats.outputBytes += dataLen;
+		return CutoffPacketKept;
+	}
+
+	if (m_Config.action == CutoffDrop)
+	{
+		m_Stats.droppedPackets++;
+		return CutoffPacketDropped;
+	}
+
+	rawPacket->truncate((int)getHeadersLength(view, dataLen));
+	m_Stats.truncatedPackets++;
+	m_Stats.outputBytes += (size_t)rawPacket->getRawDataLen();
+	return CutoffPacketTruncated;
+}
+
+int CaptureCutoff::filterBurst(RawPacket** packets, int numOfPackets)
+{
+	int numOfRecorded = 0;
+	for (int i = 0; i < numOfPackets; i++)
+	{
+		if (process(packets[i]) == CutoffPacketDropped)
+			continue;
+
+		RawPacket* packet = packets[i];
+		packets[i] = packets[numOfRecorded];
+		packets[numOfRecorded] = packet;
+		numOfRecorded++;
+	}
+
+	return numOfRecorded;
+}
+
+void CaptureCutoff::clear()
+{
+	m_Table.clear();
+}
+
+void CaptureCutoff::getStats(CaptureCutoffStats& stats) const
+{
+	stats = m_Stats;
+	stats.evictions = m_Table.getNumOfEvictions();
+}
+
+} // namespace pcpp
@@ -0,0 +1,305 @@
+#define LOG_MODULE PacketLogModulePacket
+
+#include "ChecksumVerifier.h"
+#include "PacketView.h"
+#include "IPv4Layer.h"
+#include "IPv6Layer.h"
+#include "UdpLayer.h"
+#include "IpUtils.h"
+#include "CpuFeatures.h"
+#include "Logger.h"
+#include <string.h>
+#if defined(__GNUC__) && defined(__x86_64__)
+#define PCPP_CHECKSUM_VERIFY_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace pcpp
+{
+
+// The kernels below write the sum of the 16-bit words of the first 20 bytes of each IPv4 header (the header without options) to
+// sums. The sums aren't folded, and as with the checksum kernels of compute_checksum() the byte order of the words doesn't matter
+// as long as it's the same for all of them
+
+typedef void (*IPv4HeaderSumKernel)(const uint8_t* const* headers, size_t count, uint32_t* sums);
+
+static void sumIPv4HeadersScalar(const uint8_t* const* headers, size_t count, uint32_t* sums)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t sum = 0;
+		for (size_t offset = 0; offset < sizeof(iphdr); offset += 4)
+		{
+			uint32_t word;
+			memcpy(&word, headers[i] + offset, sizeof(word));
+			sum += (word & 0xffff) + (word >> 16);
+		}
+		sums[i] = sum;
+	}
+}
+
+#if defined(PCPP_CHECKSUM_VERIFY_X86_KERNELS)
+
+// each lane gathers the same 32-bit word of another header, addressed by the header pointer itself (a 64-bit index from a NULL base)
+
+__attribute__((target("avx2")))
+static void sumIPv4HeadersAvx2(const uint8_t* const* headers, size_t count, uint32_t* sums)
+{
+	const __m256i lowMask = _mm256_set1_epi32(0xffff);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i lowAddresses = _mm256_loadu_si256((const __m256i*)(headers + i));
+		__m256i highAddresses = _mm256_loadu_si256((const __m256i*)(headers + i + 4));
+		__m256i acc = _mm256_setzero_si256();
+		for (int offset = 0; offset < (int)sizeof(iphdr); offset += 4)
+		{
+			__m256i offsetVec = _mm256_set1_epi64x(offset);
+			__m128i lowWords = _mm256_i64gather_epi32((const int*)NULL, _mm256_add_epi64(lowAddresses, offsetVec), 1);
+			__m128i highWords = _mm256_i64gather_epi32((const int*)NULL, _mm256_add_epi64(highAddresses, offsetVec), 1);
+			__m256i words = _mm256_inserti128_si256(_mm256_castsi128_si256(lowWords), highWords, 1);
+			acc = _mm256_add_epi32(acc, _mm256_add_epi32(_mm256_and_si256(words, lowMask), _mm256_srli_epi32(words, 16)));
+		}
+		_mm256_storeu_si256((__m256i*)(sums + i), acc);
+	}
+
+	sumIPv4HeadersScalar(headers + i, count - i, sums + i);
+}
+
+__attribute__((target("avx512f")))
+static void sumIPv4HeadersAvx512(const uint8_t* const* headers, size_t count, uint32_t* sums)
+{
+	// each gather reads 8 headers, the words of the two halves are summed with 256-bit operations
+	const __m256i lowMask = _mm256_set1_epi32(0xffff);
+	const __m256i zero = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m512i lowAddresses = _mm512_loadu_si512((const void*)(headers + i));
+		__m512i highAddresses = _mm512_loadu_si512((const void*)(headers + i + 8));
+		__m256i lowAcc = _mm256_setzero_si256();
+		__m256i highAcc = _mm256_setzero_si256();
+		for (int offset = 0; offset < (int)sizeof(iphdr); offset += 4)
+		{
+			__m512i offsetVec = _mm512_set1_epi64(offset);
+			// the masked form is used since the plain one starts from an undefined register, which GCC warns about
+			__m256i lowWords = _mm512_mask_i64gather_epi32(zero, 0xff, _mm512_add_epi64(lowAddresses, offsetVec), NULL, 1);
+			__m256i highWords = _mm512_mask_i64gather_epi32(zero, 0xff, _mm512_add_epi64(highAddresses, offsetVec), NULL, 1);
+			lowAcc = _mm256_add_epi32(lowAcc, _mm256_add_epi32(_mm256_and_si256(lowWords, lowMask), _mm256_srli_epi32(lowWords, 16)));
+			highAcc = _mm256_add_epi32(highAcc, _mm256_add_epi32(_mm256_and_si256(highWords, lowMask), _mm256_srli_epi32(highWords, 16)));
+		}
+		_mm256_storeu_si256((__m256i*)(sums + i), lowAcc);
+		_mm256_storeu_si256((__m256i*)(sums + i + 8), highAcc);
+	}
+
+	sumIPv4HeadersAvx2(headers + i, count - i, sums + i);
+}
+#endif
+
+static IPv4HeaderSumKernel selectIPv4HeaderSumKernel()
+{
+#if defined(PCPP_CHECKSUM_VERIFY_X86_KERNELS)
+	if (CpuFeatures::hasAvx512f())
+		return sumIPv4HeadersAvx512;
+	if (CpuFeatures::hasAvx2())
+		return sumIPv4HeadersAvx2;
+#endif
+	return sumIPv4HeadersScalar;
+}
+
+ChecksumVerifier::ChecksumVerifier() : m_Count(0)
+{
+}
+
+size_t ChecksumVerifier::load(RawPacket* const* rawPackets, size_t count)
+{
+	if (count > MaxBurstSize)
+	{
+		LOG_DEBUG("Burst size is limited to %d, only the first %d packets out of %d will be loaded", (int)MaxBurstSize, (int)MaxBurstSize, (int)count);
+		count = MaxBurstSize;
+	}
+
+	m_Count = count;
+	PacketView view;
+	for (size_t i = 0; i < count; i++)
+	{
+		m_NetworkHeaders[i] = m_TransportHeaders[i] = NULL;
+		m_TransportLengths[i] = 0;
+		m_IPv4HeaderLengths[i] = 0;
+		m_IPVersions[i] = m_IPProtocols[i] = 0;
+		m_IPHints[i] = m_L4Hints[i] = ChecksumHintUnknown;
+
+		if (!FlowKeyExtractor::extract(rawPackets[i], view))
+			continue;
+
+		const uint8_t* data = rawPackets[i]->getRawData();
+		size_t dataLen = (size_t)rawPackets[i]->getRawDataLen();
+		m_NetworkHeaders[i] = data + view.networkOffset;
+		m_IPVersions[i] = view.ipVersion;
+		m_IPProtocols[i] = view.ipProtocol;
+
+		size_t ipLen = 0;
+		if (view.ipVersion == 4)
+		{
+			const iphdr* ipHeader = (const iphdr*)m_NetworkHeaders[i];
+			// a header length below the minimum is checked over the fixed header, a header longer than the captured data can't be checked
+			size_t headerLen = ipHeader->internetHeaderLength * 4;
+			if (headerLen < sizeof(iphdr))
+				headerLen = sizeof(iphdr);
+			if (view.networkOffset + headerLen <= dataLen)
+				m_IPv4HeaderLengths[i] = (uint8_t)headerLen;
+			ipLen = ntohs(ipHeader->totalLength);
+		}
+		else
+		{
+			const ip6_hdr* ipHeader = (const ip6_hdr*)m_NetworkHeaders[i];
+			size_t payloadLen = ntohs(ipHeader->payloadLength);
+			if (payloadLen != 0)
+				ipLen = sizeof(ip6_hdr) + payloadLen;
+		}
+
+		// the whole TCP or UDP segment must be captured for its checksum to be verified
+		if (view.transportOffset == PacketView::NoOffset || ipLen == 0)
+			continue;
+
+		size_t headersLen = view.transportOffset - view.networkOffset;
+		if (ipLen <= headersLen || view.networkOffset + ipLen > dataLen)
+			continue;
+
+		const uint8_t* transportHeader = data + view.transportOffset;
+		if (view.ipVersion == 4 && view.isPacketOfType(UDP) && ((const udphdr*)transportHeader)->headerChecksum == 0)
+			continue;
+
+		m_TransportHeaders[i] = transportHeader;
+		m_TransportLengths[i] = (uint32_t)(ipLen - headersLen);
+	}
+
+	return count;
+}
+
+void ChecksumVerifier::setHints(size_t index, ChecksumHint ipHint, ChecksumHint l4Hint)
+{
+	if (index >= m_Count)
+		return;
+
+	m_IPHints[index] = (uint8_t)ipHint;
+	m_L4Hints[index] = (uint8_t)l4Hint;
+}
+
+uint64_t ChecksumVerifier::verifyIPv4HeaderChecksums(uint64_t* checkedMask) const
+{
+	static const IPv4HeaderSumKernel ipv4HeaderSumKernel = selectIPv4HeaderSumKernel();
+
+	uint64_t passed = getLoadedMask();
+	uint64_t checked = 0;
+
+	// the headers to compute are gathered into one array so the kernel processes them without gaps
+	const uint8_t* headers[MaxBurstSize];
+	uint8_t indices[MaxBurstSize];
+	size_t numOfHeaders = 0;
+
+	for (size_t i = 0; i < m_Count; i++)
+	{
+		if (m_IPVersions[i] != 4 || m_IPv4HeaderLengths[i] == 0)
+			continue;
+
+		uint64_t bit = (uint64_t)1 << i;
+		checked |= bit;
+		if (m_IPHints[i] == ChecksumHintBad)
+			passed &= ~bit;
+		else if (m_IPHints[i] == ChecksumHintUnknown)
+		{
+			headers[numOfHeaders] = m_NetworkHeaders[i];
+			indices[numOfHeaders++] = (uint8_t)i;
+		}
+	}
+
+	uint32_t sums[MaxBurstSize];
+	ipv4HeaderSumKernel(headers, numOfHeaders, sums);
+
+	for (size_t j = 0; j < numOfHeaders; j++)
+	{
+		size_t i = indices[j];
+		uint32_t sum = sums[j];
+		for (size_t offset = sizeof(iphdr); offset < m_IPv4HeaderLengths[i]; offset += 2)
+		{
+			uint16_t word;
+			memcpy(&word, m_NetworkHeaders[i] + offset, sizeof(word));
+			sum += word;
+		}
+
+		while (sum >> 16)
+			sum = (sum & 0xffff) + (sum >> 16);
+
+		// the sum of a header including a valid checksum is 0xffff
+		if (sum != 0xffff)
+			passed &= ~((uint64_t)1 << i);
+	}
+
+	if (checkedMask != NULL)
+		*checkedMask = checked;
+
+	return passed;
+}
+
+uint64_t ChecksumVerifier::verifyL4Checksums(uint64_t* checkedMask) const
+{
+	uint64_t passed = getLoadedMask();
+	uint64_t checked = 0;
+
+	for (size_t i = 0; i < m_Count; i++)
+	{
+		if (m_TransportHeaders[i] == NULL)
+			continue;
+
+		uint64_t bit = (uint64_t)1 << i;
+		checked |= bit;
+		if (m_L4Hints[i] == ChecksumHintGood)
+			continue;
+
+		if (m_L4Hints[i] == ChecksumHintBad)
+		{
+			passed &= ~bit;
+			continue;
+		}
+
+		// same pseudo header as TcpLayer and UdpLayer, with the addresses copied as they are in the IP header
+		uint16_t pseudoHeader[18];
+		size_t pseudoHeaderLen;
+		if (m_IPVersions[i] == 4)
+		{
+			const iphdr* ipHeader = (const iphdr*)m_NetworkHeaders[i];
+			memcpy(pseudoHeader, &ipHeader->ipSrc, 4);
+			memcpy(pseudoHeader + 2, &ipHeader->ipDst, 4);
+			pseudoHeader[4] = htons((uint16_t)m_TransportLengths[i]);
+			pseudoHeader[5] = htons(m_IPProtocols[i]);
+			pseudoHeaderLen = 12;
+		}
+		else
+		{
+			const ip6_hdr* ipHeader = (const ip6_hdr*)m_NetworkHeaders[i];
+			memcpy(pseudoHeader, ipHeader->ipSrc, 16);
+			memcpy(pseudoHeader + 8, ipHeader->ipDst, 16);
+			pseudoHeader[16] = htons((uint16_t)m_TransportLengths[i]);
+			pseudoHeader[17] = htons(m_IPProtocols[i]);
+			pseudoHeaderLen = 36;
+		}
+
+		ScalarBuffer<uint16_t> vec[2];
+		vec[0].buffer = (uint16_t*)m_TransportHeaders[i];
+		vec[0].len = m_TransportLengths[i];
+		vec[1].buffer = pseudoHeader;
+		vec[1].len = pseudoHeaderLen;
+
+		// computing the checksum over data which includes a valid checksum results in 0
+		if (compute_checksum(vec, 2) != 0)
+			passed &= ~bit;
+	}
+
+	if (checkedMask != NULL)
+		*checkedMask = checked;
+
+	return passed;
+}
+
+} // namespace pcpp
@@ -0,0 +1,298 @@
+#define LOG_MODULE PacketLogModuleClusterDistributor
+
+#include "ClusterDistributor.h"
+#include "Packet.h"
+#include "EthLayer.h"
+#include "IPv4Layer.h"
+#include "UdpLayer.h"
+#include "VxlanLayer.h"
+#include "PacketView.h"
+#include "FlowHash.h"
+#include "TunnelDecapsulator.h"
+#include "HashCounters.h"
+#include "IpUtils.h"
+#include "Logger.h"
+#include <algorithm>
+#include <string.h>
+
+#define ENCAPSULATION_IP_TTL 64
+#define VXLAN_HEADER_LENGTH 8
+#define VXLAN_FLAG_VNI_PRESENT 0x08
+
+// the UDP source ports the flow hash is mapped to, the dynamic port range as RFC 7348 recommends
+#define VXLAN_SRC_PORT_BASE 0xC000
+#define VXLAN_SRC_PORT_MASK 0x3FFF
+
+namespace pcpp
+{
+
+const size_t ClusterDistributor::EncapsulationLength;
+
+bool ClusterDistributor::RingPoint::operator<(const RingPoint& other) const
+{
+	// node IDs break ties between equal points, so the ring doesn't depend on the order the nodes were added in
+	if (point != other.point)
+		return point < other.point;
+	return nodeBatch->node.nodeId < other.nodeBatch->node.nodeId;
+}
+
+ClusterDistributor::ClusterDistributor(const ClusterDistributorConfiguration& config, OnClusterBatchReady onBatchReady, void* userCookie) :
+	m_Config(config), m_OnBatchReady(onBatchReady), m_UserCookie(userCookie)
+{
+	if (m_Config.batchSize == 0)
+		m_Config.batchSize = 1;
+	if (m_Config.virtualNodesPerWeight == 0)
+		m_Config.virtualNodesPerWeight = 1;
+
+	m_SlotLength = EncapsulationLength + m_Config.maxPacketLength;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+ClusterDistributor::~ClusterDistributor()
+{
+	for (std::vector<NodeBatch*>::iterator iter = m_Nodes.begin(); iter != m_Nodes.end(); iter++)
+	{
+		delete [] (*iter)->packets;
+		delete [] (*iter)->buffer;
+		delete (*iter);
+	}
+}
+
+uint32_t ClusterDistributor::getRingPoint(uint32_t nodeId, uint32_t index)
+{
+	return (uint32_t)hashInteger(((uint64_t)nodeId << 32) | index);
+}
+
+bool ClusterDistributor::addNode(const ClusterNode& node)
+{
+	if (node.weight == 0)
+	{
+		LOG_ERROR("Can't add node %u with weight 0", node.nodeId);
+		return false;
+	}
+
+	for (std::vector<NodeBatch*>::const_iterator iter = m_Nodes.begin(); iter != m_Nodes.end(); iter++)
+	{
+		if ((*iter)->node.nodeId == node.nodeId)
+		{
+			LOG_ERROR("Node %u is already in the cluster", node.nodeId);
+			return false;
+		}
+	}
+
+	NodeBatch* nodeBatch = new NodeBatch(node);
+	if (!buildHeaders(nodeBatch))
+	{
+		delete nodeBatch;
+		return false;
+	}
+
+	nodeBatch->buffer = new uint8_t[m_SlotLength * m_Config.batchSize];
+	nodeBatch->packets = new RawPacket[m_Config.batchSize];
+	m_Nodes.push_back(nodeBatch);
+	buildRing();
+	return true;
+}
+
+bool ClusterDistributor::removeNode(uint32_t nodeId)
+{
+	for (std::vector<NodeBatch*>::iterator iter = m_Nodes.begin(); iter != m_Nodes.end(); iter++)
+	{
+		if ((*iter)->node.nodeId != nodeId)
+			continue;
+
+		NodeBatch* nodeBatch = *iter;
+		sendBatch(nodeBatch);
+		m_Nodes.erase(iter);
+		buildRing();
+
+		delete [] nodeBatch->packets;
+		delete [] nodeBatch->buffer;
+		delete nodeBatch;
+		return true;
+	}
+
+	return false;
+}
+
+void ClusterDistributor::getNodes(std::vector<ClusterNode>& nodes) const
+{
+	nodes.clear();
+	for (std::vector<NodeBatch*>::const_iterator iter = m_Nodes.begin(); iter != m_Nodes.end(); iter++)
+		nodes.push_back((*iter)->node);
+}
+
+void ClusterDistributor::buildRing()
+{
+	m_Ring.clear();
+	for (std::vector<NodeBatch*>::const_iterator iter = m_Nodes.begin(); iter != m_Nodes.end(); iter++)
+	{
+		uint32_t numOfPoints = (*iter)->node.weight * m_Config.virtualNodesPerWeight;
+		for (uint32_t i = 0; i < numOfPoints; i++)
+		{
+			RingPoint ringPoint;
+			ringPoint.point = getRingPoint((*iter)->node.nodeId, i);
+			ringPoint.nodeBatch = *iter;
+			m_Ring.push_back(ringPoint);
+		}
+	}
+
+	std::sort(m_Ring.begin(), m_Ring.end());
+}
+
+bool ClusterDistributor::buildHeaders(NodeBatch* nodeBatch)
+{
+	Packet headers(EncapsulationLength);
+	EthLayer ethLayer(m_Config.srcMac, nodeBatch->node.macAddress, PCPP_ETHERTYPE_IP);
+	IPv4Layer ipLayer(m_Config.srcIP, nodeBatch->node.ipAddress);
+	ipLayer.getIPv4Header()->timeToLive = ENCAPSULATION_IP_TTL;
+	ipLayer.getIPv4Header()->fragmentOffset = htons(PCPP_IP_DONT_FRAGMENT << 8);
+	UdpLayer udpLayer(VXLAN_SRC_PORT_BASE, m_Config.dstPort);
+	VxlanLayer vxlanLayer(m_Config.vni);
+
+	if (!headers.addLayer(&ethLayer) || !headers.addLayer(&ipLayer) || !headers.addLayer(&udpLayer) || !headers.addLayer(&vxlanLayer))
+	{
+		LOG_ERROR("Couldn't build the headers of the packets to node %u", nodeBatch->node.nodeId);
+		return false;
+	}
+
+	headers.computeCalculateFields();
+	memcpy(nodeBatch->headers, headers.getRawPacket()->getRawData(), EncapsulationLength);
+
+	// the UDP checksum isn't used, and only the IPv4 checksum is updated for each packet
+	((udphdr*)(nodeBatch->headers + sizeof(ether_header) + sizeof(iphdr)))->headerChecksum = 0;
+	return true;
+}
+
+ClusterDistributor::NodeBatch* ClusterDistributor::findNode(uint32_t flowHash) const
+{
+	if (m_Ring.empty())
+		return NULL;
+
+	// the flow belongs to the first point following its hash, wrapping around the end of the ring
+	size_t low = 0, high = m_Ring.size();
+	while (low < high)
+	{
+		size_t middle = (low + high) / 2;
+		if (m_Ring[middle].point < flowHash)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return m_Ring[low == m_Ring.size() ? 0 : low].nodeBatch;
+}
+
+const ClusterNode* ClusterDistributor::getNode(uint32_t flowHash) const
+{
+	NodeBatch* nodeBatch = findNode(flowHash);
+	return (nodeBatch != NULL ? &nodeBatch->node : NULL);
+}
+
+uint32_t ClusterDistributor::getFlowHash(const RawPacket* rawPacket) const
+{
+	if (m_Config.hashInnerFlow)
+	{
+		// the tunnel ID isn't hashed since the two directions of a GTP-U session have different TEIDs
+		TunnelInfo info;
+		if (!TunnelDecapsulator::decapsulate(rawPacket, info))
+			return 0;
+		return TunnelDecapsulator::hashInnerFlow(info, true, false);
+	}
+
+	PacketView view;
+	FlowTuple tuple;
+	if (!FlowKeyExtractor::extract(rawPacket, view) || !FlowHash::getTuple(view, tuple))
+		return 0;
+	return FlowHash::hashSymmetric(tuple);
+}
+
+bool ClusterDistributor::distributePacket(const RawPacket* rawPacket)
+{
+	m_Stats.packets++;
+
+	size_t packetLen = (size_t)rawPacket->getRawDataLen();
+	if (rawPacket->getLinkLayerType() != LINKTYPE_ETHERNET || packetLen > m_Config.maxPacketLength)
+	{
+		m_Stats.unsupportedPackets++;
+		return false;
+	}
+
+	uint32_t flowHash = getFlowHash(rawPacket);
+	NodeBatch* nodeBatch = findNode(flowHash);
+	if (nodeBatch == NULL)
+	{
+		m_Stats.noNodePackets++;
+		return false;
+	}
+
+	uint8_t* slot = nodeBatch->buffer + nodeBatch->numOfPackets * m_SlotLength;
+	memcpy(slot, nodeBatch->headers, EncapsulationLength);
+	memcpy(slot + EncapsulationLength, rawPacket->getRawData(), packetLen);
+
+	// the headers were built by the layers, only the lengths, the IPv4 checksum and the UDP source port change
+	iphdr* ipHeader = (iphdr*)(slot + sizeof(ether_header));
+	udphdr* udpHeader = (udphdr*)(slot + sizeof(ether_header) + sizeof(iphdr));
+	uint16_t totalLength = htons((uint16_t)(EncapsulationLength - sizeof(ether_header) + packetLen));
+	ipHeader->headerChecksum = update_checksum(ipHeader->headerChecksum, ipHeader->totalLength, totalLength);
+	ipHeader->totalLength = totalLength;
+	udpHeader->portSrc = htons((uint16_t)(VXLAN_SRC_PORT_BASE | (flowHash & VXLAN_SRC_PORT_MASK)));
+	udpHeader->length = htons((uint16_t)(sizeof(udphdr) + VXLAN_HEADER_LENGTH + packetLen));
+
+	nodeBatch->packets[nodeBatch->numOfPackets].setExternalRawData(slot, (int)(EncapsulationLength + packetLen), rawPacket->getPacketTimeStampNs());
+	nodeBatch->numOfPackets++;
+	m_Stats.distributedPackets++;
+	m_Stats.distributedBytes += packetLen;
+
+	if (nodeBatch->numOfPackets == m_Config.batchSize)
+		sendBatch(nodeBatch);
+
+	return true;
+}
+
+size_t ClusterDistributor::distributePackets(RawPacket** rawPackets, size_t numOfPackets)
+{
+	size_t numOfDistributed = 0;
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		if (distributePacket(rawPackets[i]))
+			numOfDistributed++;
+	}
+
+	return numOfDistributed;
+}
+
+void ClusterDistributor::sendBatch(NodeBatch* nodeBatch)
+{
+	if (nodeBatch->numOfPackets == 0)
+		return;
+
+	uint32_t numOfPackets = nodeBatch->numOfPackets;
+	nodeBatch->numOfPackets = 0;
+	m_Stats.batches++;
+	m_OnBatchReady(nodeBatch->node, nodeBatch->packets, numOfPackets, m_UserCookie);
+}
+
+void ClusterDistributor::flush()
+{
+	for (std::vector<NodeBatch*>::iterator iter = m_Nodes.begin(); iter != m_Nodes.end(); iter++)
+		sendBatch(*iter);
+}
+
+bool ClusterDistributor::decapsulate(const RawPacket& outerPacket, RawPacket& innerPacket, uint32_t& vni, uint16_t dstPort)
+{
+	PacketView view;
+	if (!FlowKeyExtractor::extract(&outerPacket, view) || !view.isPacketOfType(UDP) || view.dstPort != dstPort ||
+			view.payloadOffset == PacketView::NoOffset || view.payloadLength <= VXLAN_HEADER_LENGTH)
+		return false;
+
+	const uint8_t* vxlanHeader = outerPacket.getRawData() + view.payloadOffset;
+	if ((vxlanHeader[0] & VXLAN_FLAG_VNI_PRESENT) == 0)
+		return false;
+
+	vni = ((uint32_t)vxlanHeader[4] << 16) | ((uint32_t)vxlanHeader[5] << 8) | vxlanHeader[6];
+	return innerPacket.setExternalRawData(vxlanHeader + VXLAN_HEADER_LENGTH, (int)(view.payloadLength - VXLAN_HEADER_LENGTH),
+			outerPacket.getPacketTimeStampNs());
+}
+
+} // namespace pcpp
@@ -9,33 +9,38 @@ namespace pcpp
 #define DHCP_MAGIC_NUMBER 0x63538263
 
 
-DhcpOption DhcpOptionBuilder::build() const
+size_t DhcpOptionBuilder::getRecordSize() const
 {
-	size_t recSize = 2*sizeof(uint8_t) + m_RecValueLen;
-
 	if ((m_RecType == DHCPOPT_END || m_RecType == DHCPOPT_PAD))
 	{
 		if (m_RecValueLen != 0)
 		{
 			LOG_ERROR("Can't set DHCP END option or DHCP PAD option with size different than 0, tried to set size %d", m_RecValueLen);
-			return DhcpOption(NULL);
+			return 0;
 		}
 
-		recSize = sizeof(uint8_t);
+		return sizeof(uint8_t);
 	}
 
-	uint8_t* recordBuffer = new uint8_t[recSize];
-	memset(recordBuffer, 0, recSize);
-	recordBuffer[0] = m_RecType;
-	if (recSize > 1)
-	{
-		recordBuffer[1] = m_RecValueLen;
-		if (m_RecValue != NULL)
-			memcpy(recordBuffer+2, m_RecValue, m_RecValueLen);
-		else
-			memset(recordBuffer+2, 0, m_RecValueLen);
-	}
+	return 2*sizeof(uint8_t) + m_RecValueLen;
+}
+
+DhcpOption DhcpOptionBuilder::build() const
+{
+	size_t recSize = getRecordSize();
+	if (recSize == 0)
+		return DhcpOption(NULL);
 
+	return build(new uint8_t[recSize]);
+}
+
+DhcpOption DhcpOptionBuilder::build(uint8_t* recordBuffer) const
+{
+	size_t recSize = getRecordSize();
+	if (recSize == 0 || recordBuffer == NULL)
+		return DhcpOption(NULL);
+
+	writeRecord(recordBuffer, recSize, (uint8_t)m_RecValueLen);
 	return DhcpOption(recordBuffer);
 }
 
@@ -267,31 +272,26 @@ size_t DhcpLayer::getOptionsCount()
 
 DhcpOption DhcpLayer::addOptionAt(const DhcpOptionBuilder& optionBuilder, int offset)
 {
-	DhcpOption newOpt = optionBuilder.build();
+	size_t sizeToExtend = optionBuilder.getRecordSize();
 
-	if (newOpt.isNull())
+	if (sizeToExtend == 0)
 	{
-		LOG_ERROR("Cannot build new option of type %d", (int)newOpt.getType());
+		LOG_ERROR("Cannot build new DHCP option");
 		return DhcpOption(NULL);
 	}
 
-	size_t sizeToExtend = newOpt.getTotalSize();
-
 	if (!extendLayer(offset, sizeToExtend))
 	{
-		LOG_ERROR("Could not extend DhcpLayer in [%d] bytes", (int)newOpt.getTotalSize());
+		LOG_ERROR("Could not extend DhcpLayer in [%d] bytes", (int)sizeToExtend);
 		return DhcpOption(NULL);
 	}
 
-	memcpy(m_Data + offset, newOpt.getRecordBasePtr(), newOpt.getTotalSize());
-
-	uint8_t* newOptPtr = m_Data + offset;
+	// the option is written directly into the space made for it
+	DhcpOption newOpt = optionBuilder.build(m_Data + offset);
 
 	m_OptionReader.changeTLVRecordCount(1);
 
-	newOpt.purgeRecordData();
-
-	return DhcpOption(newOptPtr);
+	return newOpt;
 }
 
 DhcpOption DhcpLayer::addOption(const DhcpOptionBuilder& optionBuilder)
@@ -25,7 +25,6 @@ static std::map<uint16_t, bool> createDNSPortMap()
 	return result;
 }
 
-static const std::map<uint16_t, bool> DNSPortMap = createDNSPortMap();
 
 
 DnsLayer::DnsLayer(uint8_t* data, size_t dataLen, Layer* prevLayer, Packet* packet)
@@ -691,7 +690,9 @@ bool DnsLayer::removeAnswer(DnsResource* answerToRemove)
 
 const std::map<uint16_t, bool>* DnsLayer::getDNSPortMap()
 {
-	return &DNSPortMap;
+	// built on first use rather than at startup
+	static const std::map<uint16_t, bool> portMap = createDNSPortMap();
+	return &portMap;
 }
 
 
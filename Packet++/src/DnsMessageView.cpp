@@ -0,0 +1,248 @@
+#define LOG_MODULE PacketLogModuleDnsLayer
+
+#include "DnsMessageView.h"
+#include "Logger.h"
+#include <string.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV) //for using ntohl, ntohs, etc.
+#include <winsock2.h>
+#elif LINUX
+#include <in.h> //for using ntohl, ntohs, etc.
+#elif MAC_OS_X
+#include <arpa/inet.h> //for using ntohl, ntohs, etc.
+#endif
+
+// the maximum number of compression pointers followed while reading a name, which protects against pointer loops
+#define DNS_MAX_NAME_POINTERS 20
+
+// the maximum length of a DNS message
+#define DNS_MAX_MESSAGE_LENGTH 0xffff
+
+namespace pcpp
+{
+
+static inline char toLowerAscii(char c)
+{
+	return (c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c);
+}
+
+DnsMessageView::DnsMessageView() : m_Data(NULL), m_DataLen(0), m_NumOfRecords(0), m_Complete(false)
+{
+}
+
+bool DnsMessageView::parse(const uint8_t* data, size_t dataLen)
+{
+	m_Data = NULL;
+	m_DataLen = 0;
+	m_NumOfRecords = 0;
+	m_Complete = false;
+
+	if (data == NULL || dataLen < sizeof(dnshdr))
+		return false;
+
+	m_Data = data;
+	m_DataLen = (dataLen > DNS_MAX_MESSAGE_LENGTH ? DNS_MAX_MESSAGE_LENGTH : dataLen);
+
+	const dnshdr* hdr = (const dnshdr*)data;
+	size_t sectionCounts[4] = { ntohs(hdr->numberOfQuestions), ntohs(hdr->numberOfAnswers), ntohs(hdr->numberOfAuthority), ntohs(hdr->numberOfAdditional) };
+
+	size_t offset = sizeof(dnshdr);
+	for (int section = DnsQueryType; section <= DnsAdditionalType; section++)
+	{
+		for (size_t i = 0; i < sectionCounts[section]; i++)
+		{
+			if (m_NumOfRecords == MaxIndexedRecords)
+			{
+				LOG_DEBUG("DNS message contains more than %d records, the rest aren't indexed", (int)MaxIndexedRecords);
+				return true;
+			}
+
+			size_t fieldsOffset = skipName(offset);
+			if (fieldsOffset == 0)
+			{
+				LOG_DEBUG("DNS record #%d has a malformed name", (int)m_NumOfRecords);
+				return true;
+			}
+
+			RecordEntry& record = m_Records[m_NumOfRecords];
+			record.nameOffset = (uint16_t)offset;
+			record.fieldsOffset = (uint16_t)fieldsOffset;
+			record.section = (uint8_t)section;
+			record.dataOffset = 0;
+			record.dataLength = 0;
+
+			if (section == DnsQueryType)
+			{
+				// a query record has only the type and class fields
+				offset = fieldsOffset + 2*sizeof(uint16_t);
+			}
+			else
+			{
+				size_t dataOffset = fieldsOffset + 3*sizeof(uint16_t) + sizeof(uint32_t);
+				if (dataOffset > m_DataLen)
+				{
+					LOG_DEBUG("DNS record #%d exceeds the message", (int)m_NumOfRecords);
+					return true;
+				}
+
+				record.dataOffset = (uint16_t)dataOffset;
+				record.dataLength = readUInt16(dataOffset - sizeof(uint16_t));
+				offset = dataOffset + record.dataLength;
+			}
+
+			if (offset > m_DataLen)
+			{
+				LOG_DEBUG("DNS record #%d exceeds the message", (int)m_NumOfRecords);
+				return true;
+			}
+
+			m_NumOfRecords++;
+		}
+	}
+
+	m_Complete = true;
+	return true;
+}
+
+size_t DnsMessageView::skipName(size_t offset) const
+{
+	while (offset < m_DataLen)
+	{
+		uint8_t labelLength = m_Data[offset];
+		if (labelLength == 0)
+			return offset + 1;
+
+		// a compression pointer ends the name in place
+		if ((labelLength & 0xc0) == 0xc0)
+			return (offset + sizeof(uint16_t) <= m_DataLen ? offset + sizeof(uint16_t) : 0);
+
+		// the other label types are obsolete
+		if ((labelLength & 0xc0) != 0)
+			return 0;
+
+		offset += labelLength + 1;
+	}
+
+	return 0;
+}
+
+uint32_t DnsMessageView::getTTL(size_t index) const
+{
+	if (m_Records[index].section == DnsQueryType)
+		return 0;
+
+	size_t ttlOffset = m_Records[index].fieldsOffset + 2*sizeof(uint16_t);
+	return ((uint32_t)readUInt16(ttlOffset) << 16) | readUInt16(ttlOffset + sizeof(uint16_t));
+}
+
+bool DnsMessageView::decodeName(size_t offset, char* buffer, size_t bufferLen, size_t* nameLen) const
+{
+	if (buffer == NULL || bufferLen == 0)
+		return false;
+
+	buffer[0] = 0;
+	size_t resultLen = 0;
+	int numOfPointers = 0;
+
+	while (offset < m_DataLen)
+	{
+		uint8_t labelLength = m_Data[offset];
+		if (labelLength == 0)
+		{
+			buffer[resultLen] = 0;
+			if (nameLen != NULL)
+				*nameLen = resultLen;
+			return true;
+		}
+
+		if ((labelLength & 0xc0) == 0xc0)
+		{
+			if (offset + sizeof(uint16_t) > m_DataLen || ++numOfPointers > DNS_MAX_NAME_POINTERS)
+				break;
+
+			offset = ((labelLength & 0x3f) << 8) | m_Data[offset + 1];
+			if (offset < sizeof(dnshdr))
+				break;
+
+			continue;
+		}
+
+		if ((labelLength & 0xc0) != 0 || offset + 1 + labelLength > m_DataLen)
+			break;
+
+		// the label, a separator before it if it isn't the first one, and the terminating null must fit in the buffer
+		size_t separatorLen = (resultLen > 0 ? 1 : 0);
+		if (resultLen + separatorLen + labelLength + 1 > bufferLen)
+			break;
+
+		if (separatorLen > 0)
+			buffer[resultLen++] = '.';
+
+		memcpy(buffer + resultLen, m_Data + offset + 1, labelLength);
+		resultLen += labelLength;
+		offset += labelLength + 1;
+	}
+
+	buffer[0] = 0;
+	return false;
+}
+
+bool DnsMessageView::isNameEqualAtOffset(size_t offset, const char* name) const
+{
+	if (name == NULL)
+		return false;
+
+	int numOfPointers = 0;
+
+	while (offset < m_DataLen)
+	{
+		uint8_t labelLength = m_Data[offset];
+		if (labelLength == 0)
+			return (name[0] == 0 || (name[0] == '.' && name[1] == 0));
+
+		if ((labelLength & 0xc0) == 0xc0)
+		{
+			if (offset + sizeof(uint16_t) > m_DataLen || ++numOfPointers > DNS_MAX_NAME_POINTERS)
+				return false;
+
+			offset = ((labelLength & 0x3f) << 8) | m_Data[offset + 1];
+			if (offset < sizeof(dnshdr))
+				return false;
+
+			continue;
+		}
+
+		if ((labelLength & 0xc0) != 0 || offset + 1 + labelLength > m_DataLen)
+			return false;
+
+		const char* label = (const char*)m_Data + offset + 1;
+		for (uint8_t i = 0; i < labelLength; i++)
+		{
+			if (name[i] == 0 || name[i] == '.' || toLowerAscii(name[i]) != toLowerAscii(label[i]))
+				return false;
+		}
+
+		// the label must match a whole label of the string
+		name += labelLength;
+		if (name[0] == '.')
+			name++;
+		else if (name[0] != 0)
+			return false;
+
+		offset += labelLength + 1;
+	}
+
+	return false;
+}
+
+int DnsMessageView::findRecord(DnsResourceType section, const char* name) const
+{
+	for (size_t i = 0; i < m_NumOfRecords; i++)
+	{
+		if (m_Records[i].section == section && isNameEqualAtOffset(m_Records[i].nameOffset, name))
+			return (int)i;
+	}
+
+	return -1;
+}
+
+} // namespace pcpp
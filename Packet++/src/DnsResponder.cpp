@@ -0,0 +1,480 @@
+#define LOG_MODULE PacketLogModuleDnsLayer
+
+#include "DnsResponder.h"
+#include "Logger.h"
+#include <string.h>
+
+// the maximum length of a DNS name in wire format, including the terminating zero length
+#define DNS_MAX_NAME_LENGTH 255
+
+#define DNS_HEADER_LENGTH 12
+#define DNS_TYPE_A_VALUE 1
+#define DNS_TYPE_AAAA_VALUE 28
+#define DNS_CLASS_IN_VALUE 1
+
+// the TTL (IPv4) or hop limit (IPv6) of responses
+#define DNS_RESPONDER_IP_TTL 64
+
+namespace pcpp
+{
+
+static inline uint16_t readUInt16(const uint8_t* data)
+{
+	return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+static inline void writeUInt16(uint8_t* data, uint16_t value)
+{
+	data[0] = (uint8_t)(value >> 8);
+	data[1] = (uint8_t)value;
+}
+
+static inline uint8_t toLowerAscii(uint8_t c)
+{
+	return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + ('a' - 'A')) : c;
+}
+
+static inline uint16_t foldChecksum(uint32_t sum)
+{
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return (uint16_t)sum;
+}
+
+// the one's complement sum of data taken as 16-bit big-endian words (an odd last byte is padded with zero), as it's summed into a
+// checksum whose words start at an even (startsAtOddOffset = false) or odd offset from the data
+static uint16_t sumBytes(const uint8_t* data, size_t len, bool startsAtOddOffset)
+{
+	uint32_t sum = 0;
+	size_t i = 0;
+	for (; i + 1 < len; i += 2)
+		sum += readUInt16(data + i);
+	if (i < len)
+		sum += (uint32_t)data[i] << 8;
+
+	uint16_t result = foldChecksum(sum);
+	// a sum of bytes shifted by one position is the byte-swapped sum
+	return startsAtOddOffset ? (uint16_t)((result << 8) | (result >> 8)) : result;
+}
+
+// accumulates the difference a changed field makes to a checksum (RFC 1624, eqn. 3)
+static inline void addChecksumDelta(uint32_t& delta, uint16_t oldValue, uint16_t newValue)
+{
+	delta += (uint16_t)~oldValue;
+	delta += newValue;
+}
+
+static inline uint16_t applyChecksumDelta(uint16_t checksum, uint32_t delta)
+{
+	return (uint16_t)~foldChecksum((uint16_t)~checksum + delta);
+}
+
+// swap two fields of the same length
+static inline void swapBytes(uint8_t* first, uint8_t* second, size_t len)
+{
+	uint8_t temp[16];
+	memcpy(temp, first, len);
+	memcpy(first, second, len);
+	memcpy(second, temp, len);
+}
+
+
+DnsResponder::DnsResponder(uint16_t dnsPort) : m_DnsPort(dnsPort)
+{
+	clearStats();
+}
+
+bool DnsResponder::addRecord(const std::string& name, const IPv4Address& ipAddress, uint32_t ttl)
+{
+	uint32_t address = ipAddress.toInt();
+	return addRecord(name, DNS_TYPE_A_VALUE, (const uint8_t*)&address, sizeof(address), ttl);
+}
+
+bool DnsResponder::addRecord(const std::string& name, const IPv6Address& ipAddress, uint32_t ttl)
+{
+	uint8_t address[16];
+	ipAddress.copyTo(address);
+	return addRecord(name, DNS_TYPE_AAAA_VALUE, address, sizeof(address), ttl);
+}
+
+bool DnsResponder::addRecord(const std::string& name, uint16_t dnsType, const uint8_t* data, uint8_t dataLen, uint32_t ttl)
+{
+	std::string recordName = name;
+	if (!recordName.empty() && recordName[recordName.length() - 1] == '.')
+		recordName.erase(recordName.length() - 1);
+
+	bool isWildcard = false;
+	if (recordName == "*")
+	{
+		isWildcard = true;
+		recordName.clear();
+	}
+	else if (recordName.compare(0, 2, "*.") == 0)
+	{
+		isWildcard = true;
+		recordName.erase(0, 2);
+	}
+	else if (recordName.empty())
+	{
+		LOG_ERROR("Cannot add a record with an empty name");
+		return false;
+	}
+
+	// compile the name into lowercase wire format
+	uint8_t wireName[DNS_MAX_NAME_LENGTH];
+	size_t wireNameLen = 0;
+	size_t labelStart = 0;
+	while (labelStart < recordName.length())
+	{
+		size_t labelEnd = recordName.find('.', labelStart);
+		if (labelEnd == std::string::npos)
+			labelEnd = recordName.length();
+
+		size_t labelLen = labelEnd - labelStart;
+		// the name must also leave room for the terminating zero length
+		if (labelLen == 0 || labelLen > 63 || wireNameLen + 1 + labelLen + 1 > DNS_MAX_NAME_LENGTH)
+		{
+			LOG_ERROR("Cannot add a record for '%s', it's not a valid DNS name", name.c_str());
+			return false;
+		}
+
+		wireName[wireNameLen++] = (uint8_t)labelLen;
+		for (size_t i = labelStart; i < labelEnd; i++)
+			wireName[wireNameLen++] = toLowerAscii((uint8_t)recordName[i]);
+
+		labelStart = labelEnd + 1;
+	}
+
+	if (findRecord(wireName, wireNameLen, dnsType, isWildcard) != NULL)
+	{
+		LOG_ERROR("A record of type %d already exists for '%s'", (int)dnsType, name.c_str());
+		return false;
+	}
+
+	Record record;
+	record.nameOffset = (uint32_t)m_NameData.size();
+	record.nameLen = (uint16_t)wireNameLen;
+	record.dnsType = dnsType;
+	record.isWildcard = isWildcard;
+	record.ttl = ttl;
+	memcpy(record.data, data, dataLen);
+	record.dataLen = dataLen;
+	record.hits = 0;
+
+	m_NameData.insert(m_NameData.end(), wireName, wireName + wireNameLen);
+
+	// new records are added to the beginning of the chain of their key
+	bool isNew = false;
+	uint32_t& firstRecord = m_RecordIndex.get(getRecordKey(wireName, wireNameLen, dnsType, isWildcard), &isNew);
+	record.next = (isNew ? NoRecord : firstRecord);
+	firstRecord = (uint32_t)m_Records.size();
+	m_Records.push_back(record);
+
+	return true;
+}
+
+void DnsResponder::clearRecords()
+{
+	m_Records.clear();
+	m_NameData.clear();
+	m_RecordIndex.clear();
+}
+
+void DnsResponder::clearStats()
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	for (std::vector<Record>::iterator iter = m_Records.begin(); iter != m_Records.end(); iter++)
+		iter->hits = 0;
+}
+
+uint64_t DnsResponder::getRecordKey(const uint8_t* name, size_t nameLen, uint16_t dnsType, bool isWildcard)
+{
+	return hashString((const char*)name, nameLen) ^ hashInteger(((uint64_t)dnsType << 1) | (isWildcard ? 1 : 0));
+}
+
+DnsResponder::Record* DnsResponder::findRecord(const uint8_t* name, size_t nameLen, uint16_t dnsType, bool isWildcard)
+{
+	const uint32_t* firstRecord = m_RecordIndex.find(getRecordKey(name, nameLen, dnsType, isWildcard));
+	if (firstRecord == NULL)
+		return NULL;
+
+	// records with the same key are compared, since different names may have the same key
+	for (uint32_t index = *firstRecord; index != NoRecord; index = m_Records[index].next)
+	{
+		Record& record = m_Records[index];
+		if (record.dnsType == dnsType && record.isWildcard == isWildcard && record.nameLen == nameLen &&
+				memcmp(&m_NameData[0] + record.nameOffset, name, nameLen) == 0)
+			return &record;
+	}
+
+	return NULL;
+}
+
+DnsResponder::Result DnsResponder::parseQuery(const uint8_t* data, size_t dataLen, size_t bufferLen, QueryInfo& info)
+{
+	if (dataLen < 14)
+		return Ignored;
+
+	// Ethernet header and up to 2 VLAN tags
+	uint16_t etherType = readUInt16(data + 12);
+	size_t offset = 14;
+	for (int i = 0; i < 2 && (etherType == 0x8100 || etherType == 0x88a8); i++)
+	{
+		if (offset + 4 > dataLen)
+			return Ignored;
+		etherType = readUInt16(data + offset + 2);
+		offset += 4;
+	}
+
+	info.ipOffset = offset;
+	size_t ipEnd = 0;
+	if (etherType == 0x0800)
+	{
+		if (offset + 20 > dataLen || (data[offset] >> 4) != 4)
+			return Ignored;
+
+		size_t headerLen = (data[offset] & 0x0f) * 4;
+		size_t totalLen = readUInt16(data + offset + 2);
+		// fragments (the MF flag or a fragment offset is set) and protocols other than UDP aren't handled
+		if (headerLen < 20 || totalLen < headerLen || offset + totalLen > dataLen || (readUInt16(data + offset + 6) & 0x3fff) != 0 ||
+				data[offset + 9] != 17)
+			return Ignored;
+
+		info.isIPv4 = true;
+		info.udpOffset = offset + headerLen;
+		ipEnd = offset + totalLen;
+	}
+	else if (etherType == 0x86dd)
+	{
+		// the next header must be UDP, extension headers aren't handled
+		if (offset + 40 > dataLen || (data[offset] >> 4) != 6 || data[offset + 6] != 17)
+			return Ignored;
+
+		info.isIPv4 = false;
+		info.udpOffset = offset + 40;
+		ipEnd = info.udpOffset + readUInt16(data + offset + 4);
+		if (ipEnd > dataLen)
+			return Ignored;
+	}
+	else
+		return Ignored;
+
+	// UDP header. An IPv6 packet without a UDP checksum isn't valid
+	size_t udpOffset = info.udpOffset;
+	if (udpOffset + 8 > ipEnd || readUInt16(data + udpOffset + 2) != m_DnsPort || (!info.isIPv4 && readUInt16(data + udpOffset + 6) == 0))
+		return Ignored;
+
+	size_t udpLen = readUInt16(data + udpOffset + 4);
+	if (udpLen < 8 + DNS_HEADER_LENGTH || udpOffset + udpLen > ipEnd)
+		return Ignored;
+
+	info.queryEnd = udpOffset + udpLen;
+
+	// DNS header: a standard query (QR bit and opcode are 0) with one question and no answers
+	const uint8_t* dns = data + udpOffset + 8;
+	if ((readUInt16(dns + 2) & 0xf800) != 0 || readUInt16(dns + 4) != 1 || readUInt16(dns + 6) != 0)
+		return Ignored;
+
+	// copy the question name in lowercase, the question name of a query isn't compressed
+	uint8_t name[DNS_MAX_NAME_LENGTH];
+	size_t nameLen = 0;
+	size_t nameOffset = udpOffset + 8 + DNS_HEADER_LENGTH;
+	while (true)
+	{
+		if (nameOffset + nameLen >= info.queryEnd)
+			return Ignored;
+
+		uint8_t labelLen = data[nameOffset + nameLen];
+		if (labelLen == 0)
+			break;
+
+		if (labelLen > 63 || nameLen + 1 + labelLen + 1 > DNS_MAX_NAME_LENGTH || nameOffset + nameLen + 1 + labelLen > info.queryEnd)
+			return Ignored;
+
+		name[nameLen] = labelLen;
+		for (size_t i = nameLen + 1; i <= nameLen + labelLen; i++)
+			name[i] = toLowerAscii(data[nameOffset + i]);
+		nameLen += 1 + labelLen;
+	}
+
+	// skip the terminating zero length, type and class
+	info.questionEnd = nameOffset + nameLen + 1 + 4;
+	if (info.questionEnd > info.queryEnd)
+		return Ignored;
+
+	uint16_t dnsType = readUInt16(data + info.questionEnd - 4);
+	if (readUInt16(data + info.questionEnd - 2) != DNS_CLASS_IN_VALUE)
+		return Ignored;
+
+	// an exact match first, then wildcards from the longest suffix of the name to "*"
+	info.record = findRecord(name, nameLen, dnsType, false);
+	size_t suffixOffset = 0;
+	while (info.record == NULL && suffixOffset < nameLen)
+	{
+		suffixOffset += 1 + name[suffixOffset];
+		info.record = findRecord(name + suffixOffset, nameLen - suffixOffset, dnsType, true);
+	}
+
+	if (info.record == NULL)
+		return NoMatch;
+
+	// the answer is a compression pointer to the question name, type, class, TTL, data length and data
+	info.responseLen = info.questionEnd + 12 + info.record->dataLen;
+	if (info.responseLen > bufferLen)
+		return NoRoom;
+
+	return Responded;
+}
+
+void DnsResponder::buildResponse(uint8_t* data, const QueryInfo& info)
+{
+	size_t udpOffset = info.udpOffset;
+	uint8_t* dns = data + udpOffset + 8;
+	uint16_t udpChecksum = readUInt16(data + udpOffset + 6);
+	// the difference the changes make to the UDP checksum
+	uint32_t udpDelta = 0;
+
+	// remove the authority and additional sections, their sum is taken before the answer overwrites them
+	if (info.queryEnd > info.questionEnd)
+	{
+		uint16_t removedSum = sumBytes(data + info.questionEnd, info.queryEnd - info.questionEnd, ((info.questionEnd - udpOffset) & 1) != 0);
+		addChecksumDelta(udpDelta, removedSum, 0);
+	}
+
+	// DNS header: keep the ID and the RD bit, set the QR, AA and RA bits, one answer and no other records
+	uint16_t newFlags = (uint16_t)(0x8000 | 0x0400 | (readUInt16(dns + 2) & 0x0100) | 0x0080);
+	const uint16_t newValues[4] = { newFlags, 1, 0, 0 };
+	// the offsets of the flags, answer count, authority count and additional count
+	const size_t fieldOffsets[4] = { 2, 6, 8, 10 };
+	for (int i = 0; i < 4; i++)
+	{
+		addChecksumDelta(udpDelta, readUInt16(dns + fieldOffsets[i]), newValues[i]);
+		writeUInt16(dns + fieldOffsets[i], newValues[i]);
+	}
+
+	// the answer record
+	const Record& record = *info.record;
+	uint8_t* answer = data + info.questionEnd;
+	writeUInt16(answer, 0xc000 | DNS_HEADER_LENGTH);
+	writeUInt16(answer + 2, record.dnsType);
+	writeUInt16(answer + 4, DNS_CLASS_IN_VALUE);
+	writeUInt16(answer + 6, (uint16_t)(record.ttl >> 16));
+	writeUInt16(answer + 8, (uint16_t)record.ttl);
+	writeUInt16(answer + 10, record.dataLen);
+	memcpy(answer + 12, record.data, record.dataLen);
+	addChecksumDelta(udpDelta, 0, sumBytes(answer, 12 + record.dataLen, ((info.questionEnd - udpOffset) & 1) != 0));
+
+	// the UDP length is in both the UDP header and the pseudo-header
+	uint16_t oldUdpLen = readUInt16(data + udpOffset + 4);
+	uint16_t newUdpLen = (uint16_t)(info.responseLen - udpOffset);
+	addChecksumDelta(udpDelta, oldUdpLen, newUdpLen);
+	addChecksumDelta(udpDelta, oldUdpLen, newUdpLen);
+	writeUInt16(data + udpOffset + 4, newUdpLen);
+
+	// swapping the ports and addresses doesn't change the checksums
+	swapBytes(data + udpOffset, data + udpOffset + 2, 2);
+
+	uint8_t* ip = data + info.ipOffset;
+	if (info.isIPv4)
+	{
+		swapBytes(ip + 12, ip + 16, 4);
+
+		uint32_t ipDelta = 0;
+		uint16_t newTotalLen = (uint16_t)(info.responseLen - info.ipOffset);
+		addChecksumDelta(ipDelta, readUInt16(ip + 2), newTotalLen);
+		writeUInt16(ip + 2, newTotalLen);
+		// the TTL shares a 16-bit word with the protocol
+		uint16_t oldTtlWord = readUInt16(ip + 8);
+		ip[8] = DNS_RESPONDER_IP_TTL;
+		addChecksumDelta(ipDelta, oldTtlWord, readUInt16(ip + 8));
+		writeUInt16(ip + 10, applyChecksumDelta(readUInt16(ip + 10), ipDelta));
+	}
+	else
+	{
+		swapBytes(ip + 8, ip + 24, 16);
+		writeUInt16(ip + 4, (uint16_t)(info.responseLen - info.ipOffset - 40));
+		ip[7] = DNS_RESPONDER_IP_TTL;
+	}
+
+	// a zero UDP checksum (possible only with IPv4) means there is no checksum
+	if (udpChecksum != 0)
+	{
+		uint16_t newChecksum = applyChecksumDelta(udpChecksum, udpDelta);
+		writeUInt16(data + udpOffset + 6, newChecksum == 0 ? 0xffff : newChecksum);
+	}
+
+	swapBytes(data, data + 6, 6);
+}
+
+void DnsResponder::updateStats(Result result, Record* record)
+{
+	switch (result)
+	{
+	case Responded:
+		record->hits++;
+		m_Stats.queries++;
+		m_Stats.responses++;
+		break;
+	case NoMatch:
+		m_Stats.queries++;
+		m_Stats.noMatch++;
+		break;
+	case NoRoom:
+		m_Stats.queries++;
+		m_Stats.noRoom++;
+		break;
+	default:
+		m_Stats.ignored++;
+		break;
+	}
+}
+
+DnsResponder::Result DnsResponder::processPacket(uint8_t* data, size_t& dataLen, size_t bufferLen)
+{
+	QueryInfo info;
+	Result result = parseQuery(data, dataLen, bufferLen, info);
+	if (result == Responded)
+	{
+		buildResponse(data, info);
+		dataLen = info.responseLen;
+	}
+
+	updateStats(result, info.record);
+	return result;
+}
+
+DnsResponder::Result DnsResponder::processPacket(RawPacket& rawPacket, size_t maxPacketLen)
+{
+	if (rawPacket.getLinkLayerType() != LINKTYPE_ETHERNET)
+	{
+		m_Stats.ignored++;
+		return Ignored;
+	}
+
+	size_t dataLen = (size_t)rawPacket.getRawDataLen();
+	QueryInfo info;
+	Result result = parseQuery(rawPacket.getRawData(), dataLen, maxPacketLen, info);
+
+	// resize the packet before writing the response, so the raw packet (and the mbuf of MBufRawPacket) knows its new length
+	if (result == Responded && info.responseLen > dataLen)
+	{
+		uint8_t appendedData[MaxResponseGrowth];
+		memset(appendedData, 0, sizeof(appendedData));
+		rawPacket.appendData(appendedData, info.responseLen - dataLen);
+		if ((size_t)rawPacket.getRawDataLen() != info.responseLen)
+			result = NoRoom;
+	}
+	else if (result == Responded && info.responseLen < dataLen)
+	{
+		if (!rawPacket.removeData((int)info.responseLen, dataLen - info.responseLen))
+			result = Ignored;
+	}
+
+	if (result == Responded)
+		buildResponse((uint8_t*)rawPacket.getRawData(), info);
+
+	updateStats(result, info.record);
+	return result;
+}
+
+} // namespace pcpp
@@ -0,0 +1,498 @@
+#define LOG_MODULE PacketLogModuleDomainMatcher
+
+#include "DomainMatcher.h"
+#include "AtomicUtils.h"
+#include "DnsLayer.h"
+#include "SSLLayer.h"
+#include "SSLHandshake.h"
+#include "HttpLayer.h"
+#include "Logger.h"
+#include <string.h>
+
+#define MAX_DOMAIN_NAME_LENGTH 253
+#define MAX_LABEL_LENGTH 63
+// a name of 253 characters has at most 127 labels
+#define MAX_NUM_OF_LABELS 127
+// the maximum number of compression pointers followed while reading a name, which protects against pointer loops
+#define DNS_MAX_NAME_POINTERS 20
+#define DNS_COMPRESSION_POINTER 0xc0
+#define SNI_HOST_NAME_TYPE 0
+#define MIN_TABLE_SIZE 16
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+namespace pcpp
+{
+
+// a label of a name, pointing into the text or the DNS message it was read from
+struct DomainLabel
+{
+	const uint8_t* data;
+	uint8_t length;
+};
+
+static inline uint8_t toLowerAscii(uint8_t c)
+{
+	return (c >= 'A' && c <= 'Z' ? (uint8_t)(c - 'A' + 'a') : c);
+}
+
+static inline uint64_t hashLabel(const DomainLabel& label)
+{
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for (uint8_t i = 0; i < label.length; i++)
+		hash = (hash ^ toLowerAscii(label.data[i])) * FNV_PRIME;
+
+	return hash;
+}
+
+// the hash of a suffix is built from the top-level label down, so the hashes of all suffixes of a name are computed in one pass
+static inline uint64_t extendSuffixHash(uint64_t suffixHash, uint64_t labelHash)
+{
+	uint64_t hash = (suffixHash ^ labelHash) * 0x9e3779b97f4a7c15ULL;
+	return hash ^ (hash >> 32);
+}
+
+// split a name in text form into its labels. Returns the number of labels, or -1 if the name isn't a valid domain name
+static int splitTextName(const uint8_t* name, size_t nameLen, DomainLabel* labels)
+{
+	if (nameLen > 0 && name[nameLen - 1] == '.')
+		nameLen--;
+
+	if (nameLen == 0 || nameLen > MAX_DOMAIN_NAME_LENGTH)
+		return -1;
+
+	int numOfLabels = 0;
+	size_t labelStart = 0;
+	for (size_t i = 0; i <= nameLen; i++)
+	{
+		if (i < nameLen && name[i] != '.')
+			continue;
+
+		size_t labelLen = i - labelStart;
+		if (labelLen == 0 || labelLen > MAX_LABEL_LENGTH)
+			return -1;
+
+		labels[numOfLabels].data = name + labelStart;
+		labels[numOfLabels].length = (uint8_t)labelLen;
+		numOfLabels++;
+		labelStart = i + 1;
+	}
+
+	return numOfLabels;
+}
+
+// split a name in DNS wire format into its labels, following compression pointers. Returns the number of labels, or -1 if the name is
+// malformed or the root name
+static int splitWireName(const uint8_t* message, size_t messageLen, size_t offset, DomainLabel* labels)
+{
+	int numOfLabels = 0;
+	int numOfPointers = 0;
+	size_t nameLen = 0;
+	while (true)
+	{
+		if (offset >= messageLen)
+			return -1;
+
+		uint8_t labelLen = message[offset];
+		if ((labelLen & DNS_COMPRESSION_POINTER) == DNS_COMPRESSION_POINTER)
+		{
+			if (offset + 1 >= messageLen || ++numOfPointers > DNS_MAX_NAME_POINTERS)
+				return -1;
+
+			offset = ((size_t)(labelLen & ~DNS_COMPRESSION_POINTER) << 8) | message[offset + 1];
+			continue;
+		}
+
+		// the other label types are obsolete
+		if ((labelLen & DNS_COMPRESSION_POINTER) != 0)
+			return -1;
+
+		if (labelLen == 0)
+			break;
+
+		nameLen += (numOfLabels > 0 ? 1 : 0) + labelLen;
+		if (offset + 1 + labelLen > messageLen || nameLen > MAX_DOMAIN_NAME_LENGTH || numOfLabels == MAX_NUM_OF_LABELS)
+			return -1;
+
+		labels[numOfLabels].data = message + offset + 1;
+		labels[numOfLabels].length = labelLen;
+		numOfLabels++;
+		offset += 1 + labelLen;
+	}
+
+	return (numOfLabels > 0 ? numOfLabels : -1);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DomainMatcher::DomainSet
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+struct DomainMatcher::DomainSet
+{
+	// an entry of the open-addressing table. The domains are stored lowercase and dot separated in one string
+	struct Entry
+	{
+		uint64_t hash;
+		uint32_t nameOffset;
+		uint32_t exactId;
+		uint32_t subdomainsId;
+		// 0 for an empty slot, since domains aren't empty
+		uint8_t nameLength;
+		uint8_t numOfLabels;
+	};
+
+	std::vector<Entry> table;
+	size_t mask;
+	std::string names;
+	size_t numOfDomains;
+
+	DomainSet() : mask(0), numOfDomains(0) {}
+
+	bool isEqual(const Entry& entry, const DomainLabel* labels, int firstLabel, int numOfLabels) const
+	{
+		if (entry.numOfLabels != numOfLabels - firstLabel)
+			return false;
+
+		const uint8_t* stored = (const uint8_t*)names.data() + entry.nameOffset;
+		size_t pos = 0;
+		for (int i = firstLabel; i < numOfLabels; i++)
+		{
+			if (i > firstLabel)
+			{
+				if (pos >= entry.nameLength || stored[pos] != '.')
+					return false;
+				pos++;
+			}
+
+			if (pos + labels[i].length > entry.nameLength)
+				return false;
+
+			for (uint8_t j = 0; j < labels[i].length; j++)
+			{
+				if (toLowerAscii(labels[i].data[j]) != stored[pos + j])
+					return false;
+			}
+
+			pos += labels[i].length;
+		}
+
+		return pos == entry.nameLength;
+	}
+
+	// find the entry of the suffix of a name starting at firstLabel, or the empty slot it would be added to
+	size_t findSlot(uint64_t hash, const DomainLabel* labels, int firstLabel, int numOfLabels) const
+	{
+		size_t slot = (size_t)hash & mask;
+		while (table[slot].nameLength != 0)
+		{
+			if (table[slot].hash == hash && isEqual(table[slot], labels, firstLabel, numOfLabels))
+				return slot;
+
+			slot = (slot + 1) & mask;
+		}
+
+		return slot;
+	}
+
+	bool build(const std::vector<DomainRule>& rules)
+	{
+		// the table is kept at most 3/4 full so probing stays short
+		size_t tableSize = MIN_TABLE_SIZE;
+		while (tableSize * 3 < rules.size() * 4)
+			tableSize *= 2;
+
+		Entry emptyEntry;
+		memset(&emptyEntry, 0, sizeof(emptyEntry));
+		table.assign(tableSize, emptyEntry);
+		mask = tableSize - 1;
+
+		DomainLabel labels[MAX_NUM_OF_LABELS];
+		for (std::vector<DomainRule>::const_iterator iter = rules.begin(); iter != rules.end(); iter++)
+		{
+			const uint8_t* domain = (const uint8_t*)iter->domain.data();
+			size_t domainLen = iter->domain.size();
+			DomainMatchType matchType = iter->matchType;
+			if (domainLen > 2 && domain[0] == '*' && domain[1] == '.')
+			{
+				domain += 2;
+				domainLen -= 2;
+				matchType = DomainMatchSubdomains;
+			}
+
+			int numOfLabels = splitTextName(domain, domainLen, labels);
+			if (numOfLabels < 0)
+			{
+				LOG_ERROR("Invalid domain '%s'", iter->domain.c_str());
+				return false;
+			}
+
+			uint64_t hash = 0;
+			for (int i = numOfLabels - 1; i >= 0; i--)
+				hash = extendSuffixHash(hash, hashLabel(labels[i]));
+
+			Entry& entry = table[findSlot(hash, labels, 0, numOfLabels)];
+			if (entry.nameLength == 0)
+			{
+				entry.hash = hash;
+				entry.nameOffset = (uint32_t)names.size();
+				entry.exactId = DomainMatcher::NoMatch;
+				entry.subdomainsId = DomainMatcher::NoMatch;
+				entry.numOfLabels = (uint8_t)numOfLabels;
+				for (int i = 0; i < numOfLabels; i++)
+				{
+					if (i > 0)
+						names.push_back('.');
+					for (uint8_t j = 0; j < labels[i].length; j++)
+						names.push_back((char)toLowerAscii(labels[i].data[j]));
+				}
+
+				entry.nameLength = (uint8_t)(names.size() - entry.nameOffset);
+				numOfDomains++;
+			}
+
+			if (matchType != DomainMatchSubdomains)
+				entry.exactId = iter->id;
+			if (matchType != DomainMatchExact)
+				entry.subdomainsId = iter->id;
+		}
+
+		return true;
+	}
+
+	uint32_t match(const DomainLabel* labels, int numOfLabels) const
+	{
+		uint64_t suffixHashes[MAX_NUM_OF_LABELS];
+		uint64_t hash = 0;
+		for (int i = numOfLabels - 1; i >= 0; i--)
+		{
+			hash = extendSuffixHash(hash, hashLabel(labels[i]));
+			suffixHashes[i] = hash;
+		}
+
+		// the longest matching suffix wins: the name itself matches exact rules, shorter suffixes match subdomain rules
+		for (int i = 0; i < numOfLabels; i++)
+		{
+			const Entry& entry = table[findSlot(suffixHashes[i], labels, i, numOfLabels)];
+			if (entry.nameLength == 0)
+				continue;
+
+			uint32_t id = (i == 0 ? entry.exactId : entry.subdomainsId);
+			if (id != DomainMatcher::NoMatch)
+				return id;
+		}
+
+		return DomainMatcher::NoMatch;
+	}
+
+	size_t getMemoryUsage() const
+	{
+		return sizeof(DomainSet) + table.capacity() * sizeof(Entry) + names.capacity();
+	}
+};
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DomainMatcher
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+DomainMatcher::DomainMatcher()
+{
+	std::vector<DomainRule> noRules;
+	m_DomainSet = new DomainSet();
+	m_DomainSet->build(noRules);
+	pthread_mutex_init(&m_Mutex, NULL);
+}
+
+DomainMatcher::~DomainMatcher()
+{
+	delete m_DomainSet;
+	m_Reclaimer.reclaimAll(QuiescentStateDeleter());
+
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+bool DomainMatcher::setRules(const std::vector<DomainRule>& rules)
+{
+	// the new list is built without holding the lock, only publishing it is serialized
+	DomainSet* newDomainSet = new DomainSet();
+	if (!newDomainSet->build(rules))
+	{
+		delete newDomainSet;
+		return false;
+	}
+
+	pthread_mutex_lock(&m_Mutex);
+
+	m_Reclaimer.retire((DomainSet*)m_DomainSet);
+	atomicStorePointerRelease(&m_DomainSet, newDomainSet);
+	// readers which see the new epoch in quiescentState() see the new list from then on
+	m_Reclaimer.advanceEpoch();
+	m_Reclaimer.reclaim(QuiescentStateDeleter());
+
+	pthread_mutex_unlock(&m_Mutex);
+
+	LOG_DEBUG("Domain list of %d domains published", (int)newDomainSet->numOfDomains);
+	return true;
+}
+
+void DomainMatcher::clearRules()
+{
+	std::vector<DomainRule> noRules;
+	setRules(noRules);
+}
+
+size_t DomainMatcher::getNumOfDomains() const
+{
+	return atomicLoadPointerAcquire(&m_DomainSet)->numOfDomains;
+}
+
+size_t DomainMatcher::getMemoryUsage() const
+{
+	return atomicLoadPointerAcquire(&m_DomainSet)->getMemoryUsage();
+}
+
+uint32_t DomainMatcher::match(const char* name, size_t nameLen) const
+{
+	DomainLabel labels[MAX_NUM_OF_LABELS];
+	int numOfLabels = splitTextName((const uint8_t*)name, nameLen, labels);
+	if (numOfLabels < 0)
+		return NoMatch;
+
+	return atomicLoadPointerAcquire(&m_DomainSet)->match(labels, numOfLabels);
+}
+
+uint32_t DomainMatcher::match(const std::string& name) const
+{
+	return match(name.data(), name.size());
+}
+
+uint32_t DomainMatcher::matchWireName(const uint8_t* message, size_t messageLen, size_t nameOffset) const
+{
+	DomainLabel labels[MAX_NUM_OF_LABELS];
+	int numOfLabels = splitWireName(message, messageLen, nameOffset, labels);
+	if (numOfLabels < 0)
+		return NoMatch;
+
+	return atomicLoadPointerAcquire(&m_DomainSet)->match(labels, numOfLabels);
+}
+
+void DomainMatcher::matchBatch(const std::string* names, size_t count, uint32_t* ids) const
+{
+	// all names of the batch are matched with the same list
+	const DomainSet* domainSet = atomicLoadPointerAcquire(&m_DomainSet);
+	DomainLabel labels[MAX_NUM_OF_LABELS];
+	for (size_t i = 0; i < count; i++)
+	{
+		int numOfLabels = splitTextName((const uint8_t*)names[i].data(), names[i].size(), labels);
+		ids[i] = (numOfLabels < 0 ? NoMatch : domainSet->match(labels, numOfLabels));
+	}
+}
+
+uint32_t DomainMatcher::matchDns(DnsLayer& dnsLayer) const
+{
+	const DomainSet* domainSet = atomicLoadPointerAcquire(&m_DomainSet);
+	DomainLabel labels[MAX_NUM_OF_LABELS];
+	for (DnsQuery* query = dnsLayer.getFirstQuery(); query != NULL; query = dnsLayer.getNextQuery(query))
+	{
+		int numOfLabels = splitWireName(dnsLayer.getData(), dnsLayer.getDataLen(), query->getNameOffset(), labels);
+		if (numOfLabels < 0)
+			continue;
+
+		uint32_t id = domainSet->match(labels, numOfLabels);
+		if (id != NoMatch)
+			return id;
+	}
+
+	return NoMatch;
+}
+
+uint32_t DomainMatcher::matchSni(SSLHandshakeLayer& handshakeLayer) const
+{
+	SSLClientHelloMessage* clientHello = handshakeLayer.getHandshakeMessageOfType<SSLClientHelloMessage>();
+	if (clientHello == NULL)
+		return NoMatch;
+
+	SSLExtension* sniExtension = clientHello->getExtensionOfType(SSL_EXT_SERVER_NAME);
+	if (sniExtension == NULL)
+		return NoMatch;
+
+	// the extension holds a list of names, each of them a type byte and a length-prefixed name
+	const uint8_t* data = sniExtension->getData();
+	size_t dataLen = sniExtension->getLength();
+	if (dataLen < sizeof(uint16_t))
+		return NoMatch;
+
+	size_t listLen = ((size_t)data[0] << 8) | data[1];
+	size_t offset = sizeof(uint16_t);
+	size_t listEnd = (sizeof(uint16_t) + listLen < dataLen ? sizeof(uint16_t) + listLen : dataLen);
+	while (offset + 3 <= listEnd)
+	{
+		uint8_t nameType = data[offset];
+		size_t nameLen = ((size_t)data[offset + 1] << 8) | data[offset + 2];
+		offset += 3;
+		if (offset + nameLen > listEnd)
+			break;
+
+		if (nameType == SNI_HOST_NAME_TYPE)
+			return match((const char*)data + offset, nameLen);
+
+		offset += nameLen;
+	}
+
+	return NoMatch;
+}
+
+uint32_t DomainMatcher::matchHttpHost(HttpRequestLayer& httpRequest) const
+{
+	HeaderField* hostField = httpRequest.getFieldByName(PCPP_HTTP_HOST_FIELD);
+	if (hostField == NULL)
+		return NoMatch;
+
+	const char* host = hostField->getFieldValueData();
+	size_t hostLen = hostField->getFieldValueLength();
+	if (host == NULL || hostLen == 0 || host[0] == '[')
+		return NoMatch;
+
+	const char* portSeparator = (const char*)memchr(host, ':', hostLen);
+	if (portSeparator != NULL)
+		hostLen = (size_t)(portSeparator - host);
+
+	return match(host, hostLen);
+}
+
+int DomainMatcher::registerReader()
+{
+	pthread_mutex_lock(&m_Mutex);
+	int readerId = m_Reclaimer.registerReader();
+	pthread_mutex_unlock(&m_Mutex);
+
+	if (readerId < 0)
+		LOG_ERROR("Cannot register reader: %d readers are already registered", PCPP_QUIESCENT_STATE_MAX_READERS);
+
+	return readerId;
+}
+
+void DomainMatcher::unregisterReader(int readerId)
+{
+	pthread_mutex_lock(&m_Mutex);
+	m_Reclaimer.unregisterReader(readerId);
+	m_Reclaimer.reclaim(QuiescentStateDeleter());
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+void DomainMatcher::quiescentState(int readerId)
+{
+	m_Reclaimer.quiescentState(readerId);
+}
+
+size_t DomainMatcher::reclaim()
+{
+	pthread_mutex_lock(&m_Mutex);
+	size_t numOfRemaining = m_Reclaimer.reclaim(QuiescentStateDeleter());
+	pthread_mutex_unlock(&m_Mutex);
+	return numOfRemaining;
+}
+
+} // namespace pcpp
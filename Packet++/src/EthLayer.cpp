@@ -8,6 +8,7 @@
 #include "VlanLayer.h"
 #include "PPPoELayer.h"
 #include "MplsLayer.h"
+#include "ProtocolRegistry.h"
 #include <string.h>
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 #include <winsock2.h>
@@ -38,41 +39,41 @@ void EthLayer::parseNextLayer()
 		return;
 
 	ether_header* hdr = getEthHeader();
-	switch (ntohs(hdr->etherType))
+	switch (ProtocolRegistry::getInstance().getProtocolByEtherType(ntohs(hdr->etherType)))
 	{
-	case PCPP_ETHERTYPE_IP:
-		m_NextLayer = new IPv4Layer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
+	case IPv4:
+		m_NextLayer = new(m_Packet) IPv4Layer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_IPV6:
-		m_NextLayer = new IPv6Layer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
+	case IPv6:
+		m_NextLayer = new(m_Packet) IPv6Layer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_ARP:
-		m_NextLayer = new ArpLayer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
+	case ARP:
+		m_NextLayer = new(m_Packet) ArpLayer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_VLAN:
-		m_NextLayer = new VlanLayer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
+	case VLAN:
+		m_NextLayer = new(m_Packet) VlanLayer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_PPPOES:
-		m_NextLayer = new PPPoESessionLayer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
+	case PPPoESession:
+		m_NextLayer = new(m_Packet) PPPoESessionLayer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_PPPOED:
-		m_NextLayer = new PPPoEDiscoveryLayer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
+	case PPPoEDiscovery:
+		m_NextLayer = new(m_Packet) PPPoEDiscoveryLayer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_MPLS:
-		m_NextLayer = new MplsLayer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
+	case MPLS:
+		m_NextLayer = new(m_Packet) MplsLayer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
 		break;
 	default:
-		m_NextLayer = new PayloadLayer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + sizeof(ether_header), m_DataLen - sizeof(ether_header), this, m_Packet);
 	}
 
 }
 
 void EthLayer::computeCalculateFields()
 {
-	if (m_NextLayer == NULL)
+	if (getNextLayer() == NULL)
 		return;
 
-	switch (m_NextLayer->getProtocol())
+	switch (getNextLayer()->getProtocol())
 	{
 		case IPv4:
 			getEthHeader()->etherType = htons(PCPP_ETHERTYPE_IP);
@@ -93,7 +94,16 @@ void EthLayer::computeCalculateFields()
 
 std::string EthLayer::toString()
 {
-	return "Ethernet II Layer, Src: " + getSourceMac().toString() + ", Dst: " + getDestMac().toString();
+	return PacketDumpWriter::layerToString(*this);
+}
+
+void EthLayer::dump(PacketDumpWriter& writer)
+{
+	writer.beginLayer("Ethernet II Layer", Ethernet);
+	writer.addMacAddress("Src", "src", getSourceMac());
+	writer.addMacAddress("Dst", "dst", getDestMac());
+	writer.addNumber(NULL, "etherType", ntohs(getEthHeader()->etherType));
+	writer.endLayer();
 }
 
 } // namespace pcpp
@@ -0,0 +1,319 @@
+#define LOG_MODULE PacketLogModuleFlowDispatcher
+
+#include "FlowDispatcher.h"
+#include "AtomicUtils.h"
+#include "PacketView.h"
+#include "Logger.h"
+#include <string.h>
+#include <algorithm>
+
+namespace pcpp
+{
+
+static int getConfiguredNumOfWorkers(const FlowDispatcherConfiguration& config)
+{
+	return (config.numOfWorkers > 0 ? config.numOfWorkers : 1);
+}
+
+FlowDispatcher::FlowDispatcher(OnPacketsDispatched onPacketsDispatched, void* userCookie, const FlowDispatcherConfiguration& config) :
+	m_Stats(getStatsCounterNames(), 1 + getConfiguredNumOfWorkers(config))
+{
+	int numOfWorkers = getConfiguredNumOfWorkers(config);
+	m_OnPacketsDispatched = onPacketsDispatched;
+	m_DropWhenFull = config.dropWhenFull;
+	m_MaxBurstSize = (config.maxBurstSize > 0 ? config.maxBurstSize : 1);
+	m_RebalanceInterval = config.rebalanceInterval;
+	m_PacketsSinceRebalance = 0;
+	m_Running = false;
+	m_StopRequested = 0;
+	pthread_mutex_init(&m_ControlMutex, NULL);
+
+	for (int i = 0; i < numOfWorkers; i++)
+	{
+		Worker* worker = new Worker();
+		worker->owner = this;
+		worker->index = i;
+		worker->userCookie = userCookie;
+		worker->queue = new RawPacketQueue(config.queueCapacity > 0 ? config.queueCapacity : 1);
+		m_Workers.push_back(worker);
+	}
+
+	// the buckets are spread round-robin, so each worker starts with the same share of the hash space
+	size_t tableSize = (config.indirectionTableSize > (uint32_t)numOfWorkers ? (size_t)config.indirectionTableSize : (size_t)numOfWorkers);
+	m_IndirectionTable.resize(tableSize);
+	for (size_t i = 0; i < tableSize; i++)
+		m_IndirectionTable[i] = (int)(i % numOfWorkers);
+	m_BucketLoads.resize(tableSize, 0);
+}
+
+FlowDispatcher::~FlowDispatcher()
+{
+	stop();
+
+	for (std::vector<Worker*>::iterator iter = m_Workers.begin(); iter != m_Workers.end(); iter++)
+	{
+		delete (*iter)->queue;
+		delete (*iter);
+	}
+
+	pthread_mutex_destroy(&m_ControlMutex);
+}
+
+std::vector<std::string> FlowDispatcher::getStatsCounterNames()
+{
+	const char* names[NumOfStatsCounters] = { "packets dispatched", "packets dropped", "packets processed", "buckets moved" };
+	return std::vector<std::string>(names, names + NumOfStatsCounters);
+}
+
+void FlowDispatcher::setWorkerUserCookie(int workerIndex, void* userCookie)
+{
+	if (workerIndex < 0 || workerIndex >= (int)m_Workers.size())
+	{
+		LOG_ERROR("Worker index %d is out of range", workerIndex);
+		return;
+	}
+
+	m_Workers[workerIndex]->userCookie = userCookie;
+}
+
+bool FlowDispatcher::start()
+{
+	pthread_mutex_lock(&m_ControlMutex);
+
+	if (m_Running)
+	{
+		pthread_mutex_unlock(&m_ControlMutex);
+		return true;
+	}
+
+	atomicStoreRelease(&m_StopRequested, 0);
+	for (size_t i = 0; i < m_Workers.size(); i++)
+	{
+		int err = pthread_create(&(m_Workers[i]->thread), NULL, workerThreadMain, m_Workers[i]);
+		if (err != 0)
+		{
+			LOG_ERROR("Cannot create the thread of worker %d: [%s]", (int)i, strerror(err));
+			stopThreads(i);
+			pthread_mutex_unlock(&m_ControlMutex);
+			return false;
+		}
+	}
+
+	m_Running = true;
+	pthread_mutex_unlock(&m_ControlMutex);
+	return true;
+}
+
+void FlowDispatcher::stop()
+{
+	pthread_mutex_lock(&m_ControlMutex);
+
+	if (m_Running)
+	{
+		stopThreads(m_Workers.size());
+		m_Running = false;
+	}
+
+	pthread_mutex_unlock(&m_ControlMutex);
+}
+
+void FlowDispatcher::stopThreads(size_t numOfThreads)
+{
+	atomicStoreRelease(&m_StopRequested, 1);
+	for (size_t i = 0; i < numOfThreads; i++)
+		pthread_join(m_Workers[i]->thread, NULL);
+}
+
+uint32_t FlowDispatcher::getFlowHash(RawPacket* rawPacket)
+{
+	PacketView view;
+	FlowTuple tuple;
+	if (!FlowKeyExtractor::extract(rawPacket, view) || !FlowHash::getTuple(view, tuple))
+		return 0;
+
+	return FlowHash::hashSymmetric(tuple);
+}
+
+bool FlowDispatcher::dispatchPacket(RawPacket* rawPacket)
+{
+	return queuePacket(rawPacket, getFlowHash(rawPacket));
+}
+
+size_t FlowDispatcher::dispatchPackets(RawPacket* rawPackets, size_t numOfPackets)
+{
+	FlowTuple tuples[HashBatchSize];
+	bool isIP[HashBatchSize];
+	uint32_t hashes[HashBatchSize];
+	size_t numOfQueued = 0;
+
+	for (size_t batchStart = 0; batchStart < numOfPackets; batchStart += HashBatchSize)
+	{
+		size_t batchSize = (numOfPackets - batchStart < (size_t)HashBatchSize ? numOfPackets - batchStart : (size_t)HashBatchSize);
+
+		// extract all tuples first so the hashes of the whole batch are calculated in one loop
+		for (size_t i = 0; i < batchSize; i++)
+		{
+			PacketView view;
+			isIP[i] = (FlowKeyExtractor::extract(&rawPackets[batchStart + i], view) && FlowHash::getTuple(view, tuples[i]));
+			if (!isIP[i])
+				memset(&tuples[i], 0, sizeof(FlowTuple));
+		}
+
+		FlowHash::hashBatch(tuples, batchSize, hashes, true);
+
+		for (size_t i = 0; i < batchSize; i++)
+		{
+			if (queuePacket(&rawPackets[batchStart + i], (isIP[i] ? hashes[i] : 0)))
+				numOfQueued++;
+		}
+	}
+
+	return numOfQueued;
+}
+
+bool FlowDispatcher::queuePacket(RawPacket* rawPacket, uint32_t flowHash)
+{
+	uint32_t bucket = getBucket(flowHash);
+	m_BucketLoads[bucket]++;
+	RawPacketQueue* queue = m_Workers[m_IndirectionTable[bucket]]->queue;
+
+	if (m_RebalanceInterval > 0 && ++m_PacketsSinceRebalance >= m_RebalanceInterval)
+		rebalance();
+
+	if (!queue->enqueueCopy(rawPacket, m_DropWhenFull, &m_Running))
+	{
+		m_Stats.add(0, PacketsDropped);
+		return false;
+	}
+
+	m_Stats.add(0, PacketsDispatched);
+	return true;
+}
+
+bool FlowDispatcher::setIndirectionTable(const std::vector<int>& table)
+{
+	if (table.size() != m_IndirectionTable.size())
+	{
+		LOG_ERROR("The indirection table must have %d buckets", (int)m_IndirectionTable.size());
+		return false;
+	}
+
+	for (size_t i = 0; i < table.size(); i++)
+	{
+		if (table[i] < 0 || table[i] >= (int)m_Workers.size())
+		{
+			LOG_ERROR("Worker index %d of bucket %d is out of range", table[i], (int)i);
+			return false;
+		}
+	}
+
+	m_IndirectionTable = table;
+	return true;
+}
+
+size_t FlowDispatcher::rebalance()
+{
+	std::vector<uint64_t> workerLoads(m_Workers.size(), 0);
+	for (size_t i = 0; i < m_IndirectionTable.size(); i++)
+		workerLoads[m_IndirectionTable[i]] += m_BucketLoads[i];
+
+	// greedily move the largest bucket of the busiest worker which still fits in the gap to the least busy worker. Each move lowers the
+	// sum of squared loads, so the loop ends, and it's bounded by the number of buckets anyway
+	size_t numOfMoved = 0;
+	for (size_t round = 0; round < m_IndirectionTable.size(); round++)
+	{
+		size_t busiest = 0, leastBusy = 0;
+		for (size_t i = 1; i < workerLoads.size(); i++)
+		{
+			if (workerLoads[i] > workerLoads[busiest])
+				busiest = i;
+			if (workerLoads[i] < workerLoads[leastBusy])
+				leastBusy = i;
+		}
+
+		uint64_t gap = workerLoads[busiest] - workerLoads[leastBusy];
+		int bucketToMove = -1;
+		for (size_t i = 0; i < m_IndirectionTable.size(); i++)
+		{
+			if (m_IndirectionTable[i] != (int)busiest || m_BucketLoads[i] == 0 || m_BucketLoads[i] >= gap)
+				continue;
+
+			if (bucketToMove < 0 || m_BucketLoads[i] > m_BucketLoads[bucketToMove])
+				bucketToMove = (int)i;
+		}
+
+		if (bucketToMove < 0)
+			break;
+
+		m_IndirectionTable[bucketToMove] = (int)leastBusy;
+		workerLoads[busiest] -= m_BucketLoads[bucketToMove];
+		workerLoads[leastBusy] += m_BucketLoads[bucketToMove];
+		numOfMoved++;
+	}
+
+	std::fill(m_BucketLoads.begin(), m_BucketLoads.end(), 0);
+	m_PacketsSinceRebalance = 0;
+
+	if (numOfMoved > 0)
+	{
+		m_Stats.add(0, BucketsMoved, numOfMoved);
+		LOG_DEBUG("Moved %d buckets between workers", (int)numOfMoved);
+	}
+
+	return numOfMoved;
+}
+
+size_t FlowDispatcher::processQueue(Worker* worker, RawPacket* rawPackets, QueuedRawPacket** queuedPackets)
+{
+	size_t numOfPackets = worker->queue->frontBulk(queuedPackets, m_MaxBurstSize);
+	if (numOfPackets == 0)
+		return 0;
+
+	// the raw packets point to the queued data, which stays in place until the elements are popped
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		QueuedRawPacket* queuedPacket = queuedPackets[i];
+		rawPackets[i].setExternalRawData(queuedPacket->data, queuedPacket->dataLen, queuedPacket->timestamp, queuedPacket->linkType, queuedPacket->frameLength);
+	}
+
+	m_OnPacketsDispatched(rawPackets, (uint32_t)numOfPackets, worker->index, this, worker->userCookie);
+	worker->queue->popBulk(numOfPackets);
+
+	m_Stats.add(1 + worker->index, PacketsProcessed, numOfPackets);
+	return numOfPackets;
+}
+
+void* FlowDispatcher::workerThreadMain(void* workerPtr)
+{
+	Worker* worker = (Worker*)workerPtr;
+	FlowDispatcher* owner = worker->owner;
+	RawPacket* rawPackets = new RawPacket[owner->m_MaxBurstSize];
+	QueuedRawPacket** queuedPackets = new QueuedRawPacket*[owner->m_MaxBurstSize];
+	int idleRounds = 0;
+
+	while (true)
+	{
+		// the stop request is read before polling, so when it's set and the queue is found empty all packets were processed
+		bool stopRequested = (atomicLoadAcquire(&owner->m_StopRequested) != 0);
+
+		if (owner->processQueue(worker, rawPackets, queuedPackets) > 0)
+		{
+			idleRounds = 0;
+			continue;
+		}
+
+		if (stopRequested)
+			break;
+
+		if (idleRounds < IdleSpinRounds)
+			idleRounds++;
+		else
+			RawPacketQueue::sleepBriefly();
+	}
+
+	delete [] queuedPackets;
+	delete [] rawPackets;
+	return NULL;
+}
+
+} // namespace pcpp
@@ -0,0 +1,444 @@
+#define LOG_MODULE PacketLogModuleFlowExporter
+
+#include "FlowExporter.h"
+#include "Packet.h"
+#include "EthLayer.h"
+#include "IPv4Layer.h"
+#include "UdpLayer.h"
+#include "IpUtils.h"
+#include "Logger.h"
+#include <string.h>
+
+#define NETFLOW_V9_HEADER_LENGTH 20
+#define IPFIX_HEADER_LENGTH 16
+#define SET_HEADER_LENGTH 4
+#define TEMPLATE_HEADER_LENGTH 4
+#define TEMPLATE_FIELD_LENGTH 4
+
+#define NETFLOW_V9_TEMPLATE_SET_ID 0
+#define IPFIX_TEMPLATE_SET_ID 2
+
+// IPFIX information elements (RFC 5102 and the IANA registry). The numbers below 128 are the NetFlow v9 field types as well
+#define IE_OCTET_DELTA_COUNT 1
+#define IE_PACKET_DELTA_COUNT 2
+#define IE_PROTOCOL_IDENTIFIER 4
+#define IE_IP_CLASS_OF_SERVICE 5
+#define IE_TCP_CONTROL_BITS 6
+#define IE_SOURCE_TRANSPORT_PORT 7
+#define IE_SOURCE_IPV4_ADDRESS 8
+#define IE_DESTINATION_TRANSPORT_PORT 11
+#define IE_DESTINATION_IPV4_ADDRESS 12
+#define IE_LAST_SWITCHED 21
+#define IE_FIRST_SWITCHED 22
+#define IE_SOURCE_IPV6_ADDRESS 27
+#define IE_DESTINATION_IPV6_ADDRESS 28
+#define IE_VLAN_ID 58
+#define IE_MPLS_TOP_LABEL_STACK_SECTION 70
+#define IE_FLOW_END_REASON 136
+#define IE_FLOW_START_MILLISECONDS 152
+#define IE_FLOW_END_MILLISECONDS 153
+#define IE_LAYER2_SEGMENT_ID 351
+
+// the largest UDP payload of an IPv4 packet, and the smallest message length which has room for the templates and a record
+#define MAX_MESSAGE_LENGTH 65507
+#define MIN_MESSAGE_LENGTH 512
+
+#define EXPORT_IP_TTL 64
+
+namespace pcpp
+{
+
+const size_t FlowExporter::HeadersLength;
+const uint16_t FlowExporter::IPv4TemplateId;
+const uint16_t FlowExporter::IPv6TemplateId;
+
+// the flow start and end times are listed as IPFIX millisecond times, and replaced by the NetFlow v9 uptime fields when exporting NetFlow v9
+const FlowExporter::TemplateField FlowExporter::IPv4TemplateFields[] =
+{
+	{ IE_SOURCE_IPV4_ADDRESS, 4 },
+	{ IE_DESTINATION_IPV4_ADDRESS, 4 },
+	{ IE_SOURCE_TRANSPORT_PORT, 2 },
+	{ IE_DESTINATION_TRANSPORT_PORT, 2 },
+	{ IE_PROTOCOL_IDENTIFIER, 1 },
+	{ IE_IP_CLASS_OF_SERVICE, 1 },
+	{ IE_TCP_CONTROL_BITS, 1 },
+	{ IE_VLAN_ID, 2 },
+	{ IE_MPLS_TOP_LABEL_STACK_SECTION, 3 },
+	{ IE_LAYER2_SEGMENT_ID, 4 },
+	{ IE_PACKET_DELTA_COUNT, 8 },
+	{ IE_OCTET_DELTA_COUNT, 8 },
+	{ IE_FLOW_START_MILLISECONDS, 8 },
+	{ IE_FLOW_END_MILLISECONDS, 8 },
+	{ IE_FLOW_END_REASON, 1 }
+};
+
+const FlowExporter::TemplateField FlowExporter::IPv6TemplateFields[] =
+{
+	{ IE_SOURCE_IPV6_ADDRESS, 16 },
+	{ IE_DESTINATION_IPV6_ADDRESS, 16 },
+	{ IE_SOURCE_TRANSPORT_PORT, 2 },
+	{ IE_DESTINATION_TRANSPORT_PORT, 2 },
+	{ IE_PROTOCOL_IDENTIFIER, 1 },
+	{ IE_IP_CLASS_OF_SERVICE, 1 },
+	{ IE_TCP_CONTROL_BITS, 1 },
+	{ IE_VLAN_ID, 2 },
+	{ IE_MPLS_TOP_LABEL_STACK_SECTION, 3 },
+	{ IE_LAYER2_SEGMENT_ID, 4 },
+	{ IE_PACKET_DELTA_COUNT, 8 },
+	{ IE_OCTET_DELTA_COUNT, 8 },
+	{ IE_FLOW_START_MILLISECONDS, 8 },
+	{ IE_FLOW_END_MILLISECONDS, 8 },
+	{ IE_FLOW_END_REASON, 1 }
+};
+
+static inline void writeUInt16(uint8_t* data, uint16_t value)
+{
+	data[0] = (uint8_t)(value >> 8);
+	data[1] = (uint8_t)value;
+}
+
+static inline void writeUInt32(uint8_t* data, uint32_t value)
+{
+	writeUInt16(data, (uint16_t)(value >> 16));
+	writeUInt16(data + 2, (uint16_t)value);
+}
+
+static inline void writeUInt64(uint8_t* data, uint64_t value)
+{
+	writeUInt32(data, (uint32_t)(value >> 32));
+	writeUInt32(data + 4, (uint32_t)value);
+}
+
+FlowExporter::FlowExporter(const FlowExporterConfiguration& config, OnExportPacket onExportPacket, void* userCookie) :
+	m_Config(config), m_OnExportPacket(onExportPacket), m_UserCookie(userCookie), m_MessageEnd(0), m_NumOfRecords(0),
+	m_NumOfTemplateRecords(0), m_SetOffset(0), m_SetTemplateId(0), m_ExportTime(0), m_LastTemplateTime(0), m_TemplatesSent(false),
+	m_SequenceNumber(0)
+{
+	if (m_Config.maxMessageLength < MIN_MESSAGE_LENGTH)
+		m_Config.maxMessageLength = MIN_MESSAGE_LENGTH;
+	else if (m_Config.maxMessageLength > MAX_MESSAGE_LENGTH)
+		m_Config.maxMessageLength = MAX_MESSAGE_LENGTH;
+
+	m_BufferLen = HeadersLength + m_Config.maxMessageLength;
+	m_Buffer = new uint8_t[m_BufferLen];
+	memset(m_Buffer, 0, m_BufferLen);
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	buildHeaders();
+}
+
+FlowExporter::~FlowExporter()
+{
+	delete [] m_Buffer;
+}
+
+void FlowExporter::buildHeaders()
+{
+	Packet headers(HeadersLength);
+	EthLayer ethLayer(m_Config.srcMac, m_Config.dstMac, PCPP_ETHERTYPE_IP);
+	IPv4Layer ipLayer(m_Config.srcIP, m_Config.dstIP);
+	ipLayer.getIPv4Header()->timeToLive = EXPORT_IP_TTL;
+	UdpLayer udpLayer(m_Config.srcPort, m_Config.dstPort);
+
+	if (!headers.addLayer(&ethLayer) || !headers.addLayer(&ipLayer) || !headers.addLayer(&udpLayer))
+	{
+		LOG_ERROR("Couldn't build the headers of the export packets");
+		return;
+	}
+
+	headers.computeCalculateFields();
+	memcpy(m_Buffer, headers.getRawPacket()->getRawData(), HeadersLength);
+}
+
+void FlowExporter::getTemplate(uint16_t templateId, const TemplateField*& fields, size_t& numOfFields) const
+{
+	if (templateId == IPv6TemplateId)
+	{
+		fields = IPv6TemplateFields;
+		numOfFields = sizeof(IPv6TemplateFields) / sizeof(IPv6TemplateFields[0]);
+	}
+	else
+	{
+		fields = IPv4TemplateFields;
+		numOfFields = sizeof(IPv4TemplateFields) / sizeof(IPv4TemplateFields[0]);
+	}
+}
+
+uint16_t FlowExporter::getFieldId(const TemplateField& field) const
+{
+	if (m_Config.protocol == FlowExportNetFlowV9)
+	{
+		if (field.id == IE_FLOW_START_MILLISECONDS)
+			return IE_FIRST_SWITCHED;
+		if (field.id == IE_FLOW_END_MILLISECONDS)
+			return IE_LAST_SWITCHED;
+	}
+
+	return field.id;
+}
+
+uint16_t FlowExporter::getFieldLength(const TemplateField& field) const
+{
+	// the NetFlow v9 uptime fields are 32-bit
+	if (m_Config.protocol == FlowExportNetFlowV9 && (field.id == IE_FLOW_START_MILLISECONDS || field.id == IE_FLOW_END_MILLISECONDS))
+		return 4;
+
+	return field.length;
+}
+
+size_t FlowExporter::getRecordLength(const TemplateField* fields, size_t numOfFields) const
+{
+	size_t recordLen = 0;
+	for (size_t i = 0; i < numOfFields; i++)
+		recordLen += getFieldLength(fields[i]);
+	return recordLen;
+}
+
+void FlowExporter::startMessage()
+{
+	m_MessageEnd = HeadersLength + (m_Config.protocol == FlowExportNetFlowV9 ? NETFLOW_V9_HEADER_LENGTH : IPFIX_HEADER_LENGTH);
+	m_NumOfRecords = 0;
+	m_NumOfTemplateRecords = 0;
+	m_SetOffset = 0;
+
+	bool templatesDue = !m_TemplatesSent ||
+			(m_Config.templateRefreshInterval > 0 && m_ExportTime >= m_LastTemplateTime + (uint64_t)m_Config.templateRefreshInterval * 1000);
+	if (templatesDue)
+		writeTemplates();
+}
+
+void FlowExporter::writeTemplates()
+{
+	uint16_t templateIds[] = { IPv4TemplateId, IPv6TemplateId };
+
+	m_SetOffset = m_MessageEnd;
+	m_SetTemplateId = (m_Config.protocol == FlowExportNetFlowV9 ? NETFLOW_V9_TEMPLATE_SET_ID : IPFIX_TEMPLATE_SET_ID);
+	m_MessageEnd += SET_HEADER_LENGTH;
+
+	for (size_t i = 0; i < sizeof(templateIds) / sizeof(templateIds[0]); i++)
+	{
+		const TemplateField* fields;
+		size_t numOfFields;
+		getTemplate(templateIds[i], fields, numOfFields);
+
+		uint8_t* data = m_Buffer + m_MessageEnd;
+		writeUInt16(data, templateIds[i]);
+		writeUInt16(data + 2, (uint16_t)numOfFields);
+		data += TEMPLATE_HEADER_LENGTH;
+		for (size_t j = 0; j < numOfFields; j++)
+		{
+			writeUInt16(data, getFieldId(fields[j]));
+			writeUInt16(data + 2, getFieldLength(fields[j]));
+			data += TEMPLATE_FIELD_LENGTH;
+		}
+
+		m_MessageEnd += TEMPLATE_HEADER_LENGTH + numOfFields * TEMPLATE_FIELD_LENGTH;
+		m_NumOfTemplateRecords++;
+	}
+
+	closeSet();
+	m_TemplatesSent = true;
+	m_LastTemplateTime = m_ExportTime;
+	m_Stats.templates++;
+}
+
+void FlowExporter::closeSet()
+{
+	if (m_SetOffset == 0)
+		return;
+
+	// sets are padded to a 4 byte boundary, which NetFlow v9 requires and IPFIX allows
+	while ((m_MessageEnd - m_SetOffset) % 4 != 0)
+		m_Buffer[m_MessageEnd++] = 0;
+
+	writeUInt16(m_Buffer + m_SetOffset, m_SetTemplateId);
+	writeUInt16(m_Buffer + m_SetOffset + 2, (uint16_t)(m_MessageEnd - m_SetOffset));
+	m_SetOffset = 0;
+}
+
+void FlowExporter::exportRecord(const FlowRecord& record)
+{
+	if (record.lastSeen > m_ExportTime)
+		m_ExportTime = record.lastSeen;
+	if (m_Config.systemInitTime == 0)
+		m_Config.systemInitTime = record.firstSeen;
+
+	uint16_t templateId = (record.tuple.ipVersion == 6 ? IPv6TemplateId : IPv4TemplateId);
+	const TemplateField* fields;
+	size_t numOfFields;
+	getTemplate(templateId, fields, numOfFields);
+	size_t recordLen = getRecordLength(fields, numOfFields);
+
+	if (m_MessageEnd == 0)
+		startMessage();
+
+	// room for the record, the set padding and the header of a new set if the record doesn't belong to the open one
+	bool isNewSet = (m_SetOffset == 0 || m_SetTemplateId != templateId);
+	if (m_MessageEnd + recordLen + 3 + (isNewSet ? SET_HEADER_LENGTH : 0) > m_BufferLen)
+	{
+		sendMessage();
+		startMessage();
+		isNewSet = true;
+	}
+
+	if (isNewSet)
+	{
+		closeSet();
+		m_SetOffset = m_MessageEnd;
+		m_SetTemplateId = templateId;
+		m_MessageEnd += SET_HEADER_LENGTH;
+	}
+
+	writeRecord(record, fields, numOfFields);
+	m_NumOfRecords++;
+	m_Stats.records++;
+}
+
+void FlowExporter::writeRecord(const FlowRecord& record, const TemplateField* fields, size_t numOfFields)
+{
+	uint8_t* data = m_Buffer + m_MessageEnd;
+	bool isNetFlowV9 = (m_Config.protocol == FlowExportNetFlowV9);
+
+	for (size_t i = 0; i < numOfFields; i++)
+	{
+		switch (fields[i].id)
+		{
+		case IE_SOURCE_IPV4_ADDRESS:
+		case IE_SOURCE_IPV6_ADDRESS:
+			memcpy(data, record.tuple.srcIP, fields[i].length);
+			break;
+		case IE_DESTINATION_IPV4_ADDRESS:
+		case IE_DESTINATION_IPV6_ADDRESS:
+			memcpy(data, record.tuple.dstIP, fields[i].length);
+			break;
+		case IE_SOURCE_TRANSPORT_PORT:
+			writeUInt16(data, record.tuple.srcPort);
+			break;
+		case IE_DESTINATION_TRANSPORT_PORT:
+			writeUInt16(data, record.tuple.dstPort);
+			break;
+		case IE_PROTOCOL_IDENTIFIER:
+			data[0] = record.tuple.protocol;
+			break;
+		case IE_IP_CLASS_OF_SERVICE:
+			data[0] = record.tos;
+			break;
+		case IE_TCP_CONTROL_BITS:
+			data[0] = record.tcpFlags;
+			break;
+		case IE_VLAN_ID:
+			writeUInt16(data, record.vlanId);
+			break;
+		case IE_MPLS_TOP_LABEL_STACK_SECTION:
+		{
+			// a label stack entry without the experimental bits, the bottom of stack bit and the TTL
+			uint32_t entry = (record.mplsLabel << 4);
+			data[0] = (uint8_t)(entry >> 16);
+			data[1] = (uint8_t)(entry >> 8);
+			data[2] = (uint8_t)entry;
+			break;
+		}
+		case IE_LAYER2_SEGMENT_ID:
+			writeUInt32(data, record.tunnelId);
+			break;
+		case IE_PACKET_DELTA_COUNT:
+			writeUInt64(data, record.packets);
+			break;
+		case IE_OCTET_DELTA_COUNT:
+			writeUInt64(data, record.bytes);
+			break;
+		case IE_FLOW_START_MILLISECONDS:
+		case IE_FLOW_END_MILLISECONDS:
+		{
+			uint64_t time = (fields[i].id == IE_FLOW_START_MILLISECONDS ? record.firstSeen : record.lastSeen);
+			if (!isNetFlowV9)
+				writeUInt64(data, time);
+			else
+				writeUInt32(data, time > m_Config.systemInitTime ? (uint32_t)(time - m_Config.systemInitTime) : 0);
+			break;
+		}
+		case IE_FLOW_END_REASON:
+			data[0] = (uint8_t)record.endReason;
+			break;
+		default:
+			memset(data, 0, fields[i].length);
+			break;
+		}
+
+		data += getFieldLength(fields[i]);
+	}
+
+	m_MessageEnd = data - m_Buffer;
+}
+
+void FlowExporter::flush()
+{
+	if (m_MessageEnd != 0 && m_NumOfRecords > 0)
+		sendMessage();
+}
+
+void FlowExporter::sendMessage()
+{
+	closeSet();
+
+	uint8_t* message = m_Buffer + HeadersLength;
+	size_t messageLen = m_MessageEnd - HeadersLength;
+	uint32_t exportSecs = (uint32_t)(m_ExportTime / 1000);
+
+	if (m_Config.protocol == FlowExportNetFlowV9)
+	{
+		writeUInt16(message, FlowExportNetFlowV9);
+		writeUInt16(message + 2, (uint16_t)(m_NumOfRecords + m_NumOfTemplateRecords));
+		writeUInt32(message + 4, m_ExportTime > m_Config.systemInitTime ? (uint32_t)(m_ExportTime - m_Config.systemInitTime) : 0);
+		writeUInt32(message + 8, exportSecs);
+		writeUInt32(message + 12, m_SequenceNumber);
+		writeUInt32(message + 16, m_Config.observationDomainId);
+		// NetFlow v9 counts export packets
+		m_SequenceNumber++;
+	}
+	else
+	{
+		writeUInt16(message, FlowExportIPFIX);
+		writeUInt16(message + 2, (uint16_t)messageLen);
+		writeUInt32(message + 4, exportSecs);
+		writeUInt32(message + 8, m_SequenceNumber);
+		writeUInt32(message + 12, m_Config.observationDomainId);
+		// IPFIX counts the data records sent before the message
+		m_SequenceNumber += m_NumOfRecords;
+	}
+
+	// the headers were built by the layers, only the lengths and the checksums change
+	iphdr* ipHeader = (iphdr*)(m_Buffer + sizeof(ether_header));
+	udphdr* udpHeader = (udphdr*)(m_Buffer + sizeof(ether_header) + sizeof(iphdr));
+	ipHeader->totalLength = htons((uint16_t)(sizeof(iphdr) + sizeof(udphdr) + messageLen));
+	ipHeader->headerChecksum = 0;
+	ScalarBuffer<uint16_t> ipVec = { (uint16_t*)ipHeader, sizeof(iphdr) };
+	ipHeader->headerChecksum = htons(compute_checksum(&ipVec, 1));
+
+	udpHeader->length = htons((uint16_t)(sizeof(udphdr) + messageLen));
+	udpHeader->headerChecksum = 0;
+	uint16_t pseudoHeader[6];
+	memcpy(pseudoHeader, &ipHeader->ipSrc, 4);
+	memcpy(pseudoHeader + 2, &ipHeader->ipDst, 4);
+	pseudoHeader[4] = udpHeader->length;
+	pseudoHeader[5] = htons(PACKETPP_IPPROTO_UDP);
+	ScalarBuffer<uint16_t> udpVec[2] = { { (uint16_t*)udpHeader, sizeof(udphdr) + messageLen }, { pseudoHeader, sizeof(pseudoHeader) } };
+	uint16_t udpChecksum = compute_checksum(udpVec, 2);
+	// a computed checksum of 0 is sent as all ones, since 0 means the datagram has no checksum
+	udpHeader->headerChecksum = htons(udpChecksum == 0 ? 0xffff : udpChecksum);
+
+	timespec timestamp;
+	timestamp.tv_sec = (time_t)(m_ExportTime / 1000);
+	timestamp.tv_nsec = (long)((m_ExportTime % 1000) * 1000000);
+	m_Packet.setExternalRawData(m_Buffer, (int)(m_MessageEnd), timestamp, LINKTYPE_ETHERNET);
+
+	m_Stats.packets++;
+	m_MessageEnd = 0;
+	m_OnExportPacket(m_Packet, m_UserCookie);
+}
+
+void FlowExporter::onFlowExported(const FlowRecord& record, void* userCookie)
+{
+	((FlowExporter*)userCookie)->exportRecord(record);
+}
+
+} // namespace pcpp
@@ -0,0 +1,229 @@
+#include "FlowHash.h"
+#include "CpuFeatures.h"
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PCPP_FLOW_HASH_X86_CRC32C
+#include <immintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define PCPP_FLOW_HASH_ARM_CRC32C
+#include <arm_acle.h>
+#endif
+
+namespace pcpp
+{
+
+const uint8_t FlowHash::DefaultRSSKey[FlowHash::DefaultRSSKeyLength] = {
+		0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A,
+		0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A,
+		0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A,
+		0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A,
+		0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A,
+	};
+
+// the maximum length of the hashed data: 2 IPv6 addresses, 2 ports, the protocol and the IP version, padded to a multiple of 8 bytes
+#define PCPP_FLOW_HASH_MAX_KEY_LEN 40
+
+// the CRC32C kernels get the data length as a multiple of 8 bytes
+typedef uint32_t (*Crc32cKernel)(uint32_t crc, const uint8_t* data, size_t len);
+
+struct Crc32cTable
+{
+	uint32_t table[256];
+
+	Crc32cTable()
+	{
+		// CRC32C (Castagnoli) polynomial in reversed bit order
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; bit++)
+				crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : (crc >> 1);
+			table[i] = crc;
+		}
+	}
+};
+
+static uint32_t crc32cSoftware(uint32_t crc, const uint8_t* data, size_t len)
+{
+	static const Crc32cTable crcTable;
+
+	for (size_t i = 0; i < len; i++)
+		crc = crcTable.table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+
+#if defined(PCPP_FLOW_HASH_X86_CRC32C)
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSse42(uint32_t crc, const uint8_t* data, size_t len)
+{
+	for (size_t i = 0; i < len; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+#if defined(__x86_64__)
+		crc = (uint32_t)_mm_crc32_u64(crc, word);
+#else
+		crc = _mm_crc32_u32(crc, (uint32_t)word);
+		crc = _mm_crc32_u32(crc, (uint32_t)(word >> 32));
+#endif
+	}
+
+	return crc;
+}
+
+#elif defined(PCPP_FLOW_HASH_ARM_CRC32C) && !defined(__ARM_BIG_ENDIAN)
+
+static uint32_t crc32cArm(uint32_t crc, const uint8_t* data, size_t len)
+{
+	for (size_t i = 0; i < len; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		crc = __crc32cd(crc, word);
+	}
+
+	return crc;
+}
+
+#endif
+
+static Crc32cKernel selectCrc32cKernel()
+{
+#if defined(PCPP_FLOW_HASH_X86_CRC32C)
+	if (CpuFeatures::hasSse42())
+		return crc32cSse42;
+#elif defined(PCPP_FLOW_HASH_ARM_CRC32C) && !defined(__ARM_BIG_ENDIAN)
+	// the 64-bit CRC32C instruction consumes the bytes in little endian order, as the software implementation does
+	if (CpuFeatures::hasArmCrc32())
+		return crc32cArm;
+#endif
+	return crc32cSoftware;
+}
+
+static inline Crc32cKernel getCrc32cKernel()
+{
+	static const Crc32cKernel kernel = selectCrc32cKernel();
+	return kernel;
+}
+
+static inline void writePort(uint8_t* buffer, uint16_t port)
+{
+	buffer[0] = (uint8_t)(port >> 8);
+	buffer[1] = (uint8_t)(port & 0xff);
+}
+
+// serialize the tuple to a buffer whose length is a multiple of 8. Ports are written in network byte order so values don't depend
+// on the platform
+static size_t serializeTuple(const FlowTuple& tuple, bool symmetric, uint8_t* buffer)
+{
+	size_t addrLen = (tuple.ipVersion == 6 ? 16 : 4);
+	const uint8_t* firstIP = tuple.srcIP;
+	const uint8_t* secondIP = tuple.dstIP;
+	uint16_t firstPort = tuple.srcPort;
+	uint16_t secondPort = tuple.dstPort;
+
+	if (symmetric)
+	{
+		int res = memcmp(tuple.srcIP, tuple.dstIP, addrLen);
+		if (res > 0 || (res == 0 && tuple.srcPort > tuple.dstPort))
+		{
+			firstIP = tuple.dstIP;
+			secondIP = tuple.srcIP;
+			firstPort = tuple.dstPort;
+			secondPort = tuple.srcPort;
+		}
+	}
+
+	size_t len = (tuple.ipVersion == 6 ? 40 : 16);
+	memset(buffer + len - 8, 0, 8);
+	memcpy(buffer, firstIP, addrLen);
+	memcpy(buffer + addrLen, secondIP, addrLen);
+	writePort(buffer + 2*addrLen, firstPort);
+	writePort(buffer + 2*addrLen + 2, secondPort);
+	buffer[2*addrLen + 4] = tuple.protocol;
+	buffer[2*addrLen + 5] = tuple.ipVersion;
+	return len;
+}
+
+bool FlowHash::getTuple(const PacketView& view, FlowTuple& tuple)
+{
+	memset(&tuple, 0, sizeof(tuple));
+	if (view.ipVersion != 4 && view.ipVersion != 6)
+		return false;
+
+	size_t addrLen = (view.ipVersion == 6 ? 16 : 4);
+	memcpy(tuple.srcIP, view.srcIP, addrLen);
+	memcpy(tuple.dstIP, view.dstIP, addrLen);
+	tuple.protocol = view.ipProtocol;
+	tuple.ipVersion = view.ipVersion;
+	if (view.isPacketOfType(TCP) || view.isPacketOfType(UDP))
+	{
+		tuple.srcPort = view.srcPort;
+		tuple.dstPort = view.dstPort;
+	}
+
+	return true;
+}
+
+uint32_t FlowHash::hash(const FlowTuple& tuple, uint32_t seed)
+{
+	uint8_t buffer[PCPP_FLOW_HASH_MAX_KEY_LEN];
+	size_t len = serializeTuple(tuple, false, buffer);
+	return ~getCrc32cKernel()(~seed, buffer, len);
+}
+
+uint32_t FlowHash::hashSymmetric(const FlowTuple& tuple, uint32_t seed)
+{
+	uint8_t buffer[PCPP_FLOW_HASH_MAX_KEY_LEN];
+	size_t len = serializeTuple(tuple, true, buffer);
+	return ~getCrc32cKernel()(~seed, buffer, len);
+}
+
+void FlowHash::hashBatch(const FlowTuple* tuples, size_t count, uint32_t* hashes, bool symmetric, uint32_t seed)
+{
+	Crc32cKernel kernel = getCrc32cKernel();
+	uint8_t buffer[PCPP_FLOW_HASH_MAX_KEY_LEN];
+
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t len = serializeTuple(tuples[i], symmetric, buffer);
+		hashes[i] = ~kernel(~seed, buffer, len);
+	}
+}
+
+uint32_t FlowHash::hashToeplitz(const FlowTuple& tuple, bool includePorts, const uint8_t* key, size_t keyLength)
+{
+	size_t addrLen = (tuple.ipVersion == 6 ? 16 : 4);
+	size_t inputLen = 2*addrLen + (includePorts ? 4 : 0);
+	if (key == NULL || keyLength < inputLen + 4)
+		return 0;
+
+	uint8_t input[36];
+	memcpy(input, tuple.srcIP, addrLen);
+	memcpy(input + addrLen, tuple.dstIP, addrLen);
+	if (includePorts)
+	{
+		writePort(input + 2*addrLen, tuple.srcPort);
+		writePort(input + 2*addrLen + 2, tuple.dstPort);
+	}
+
+	// for each set bit of the input, XOR the result with the 32 bits of the key starting at the same bit offset
+	uint32_t result = 0;
+	uint32_t window = ((uint32_t)key[0] << 24) | ((uint32_t)key[1] << 16) | ((uint32_t)key[2] << 8) | (uint32_t)key[3];
+	for (size_t i = 0; i < inputLen; i++)
+	{
+		for (int bit = 7; bit >= 0; bit--)
+		{
+			if (input[i] & (1 << bit))
+				result ^= window;
+
+			window = (window << 1) | ((key[i + 4] >> bit) & 1);
+		}
+	}
+
+	return result;
+}
+
+} // namespace pcpp
@@ -0,0 +1,191 @@
+#define LOG_MODULE PacketLogModuleFlowExporter
+
+#include "FlowMeter.h"
+#include "TunnelDecapsulator.h"
+#include "Logger.h"
+#include <string.h>
+#include <vector>
+#include <utility>
+
+#define TCP_FLAG_FIN 0x01
+#define TCP_FLAG_RST 0x04
+
+#define IPV4_MIN_HEADER_LENGTH 20
+#define IPV6_HEADER_LENGTH 40
+#define MPLS_LABEL_LENGTH 4
+
+namespace pcpp
+{
+
+// read the length and the type of service of an IP header which FlowKeyExtractor found, so its fixed part is in the data. A packet
+// truncated by the capture is counted by its IP length, while a packet whose IP length is too small (for example 0 with segmentation
+// offload) is counted by its captured length
+static void readIpFields(const uint8_t* data, size_t dataLen, const PacketView& view, uint32_t& ipLength, uint8_t& tos)
+{
+	const uint8_t* ipHeader = data + view.networkOffset;
+	if (view.ipVersion == 4)
+	{
+		tos = ipHeader[1];
+		ipLength = ((uint32_t)ipHeader[2] << 8) | ipHeader[3];
+		if (ipLength < IPV4_MIN_HEADER_LENGTH)
+			ipLength = (uint32_t)(dataLen - view.networkOffset);
+	}
+	else
+	{
+		tos = (uint8_t)(((ipHeader[0] & 0x0f) << 4) | (ipHeader[1] >> 4));
+		ipLength = ((((uint32_t)ipHeader[4] << 8) | ipHeader[5]) + IPV6_HEADER_LENGTH);
+		if (ipLength == IPV6_HEADER_LENGTH && dataLen - view.networkOffset > IPV6_HEADER_LENGTH)
+			ipLength = (uint32_t)(dataLen - view.networkOffset);
+	}
+}
+
+FlowMeter::FlowMeter(const FlowMeterConfiguration& config, OnFlowExported onFlowExported, void* userCookie) :
+	m_Config(config), m_OnFlowExported(onFlowExported), m_UserCookie(userCookie),
+	m_FlowTable(FlowTableConfiguration(config.maxFlows, config.idleTimeout, EvictLeastRecentlyUsed), onFlowRemoved, this), m_CurrentTime(0)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+bool FlowMeter::processPacket(const RawPacket* rawPacket)
+{
+	timespec ts = rawPacket->getPacketTimeStampNs();
+	uint64_t timestamp = (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+	return processPacket(rawPacket->getRawData(), (size_t)rawPacket->getRawDataLen(), rawPacket->getLinkLayerType(), timestamp);
+}
+
+bool FlowMeter::processPacket(const uint8_t* data, size_t dataLen, LinkLayerType linkType, uint64_t timestamp)
+{
+	m_Stats.packets++;
+	advanceTime(timestamp);
+
+	FlowKey key;
+	uint32_t mplsLabel = 0;
+	const PacketView* view;
+	PacketView outerView;
+	TunnelInfo tunnelInfo;
+
+	if (m_Config.decapsulateTunnels)
+	{
+		if (!TunnelDecapsulator::decapsulate(data, dataLen, linkType, tunnelInfo))
+		{
+			m_Stats.nonIpPackets++;
+			return false;
+		}
+
+		view = &tunnelInfo.innerView;
+		data += tunnelInfo.innerOffset;
+		dataLen -= tunnelInfo.innerOffset;
+		key.tunnelId = tunnelInfo.getTunnelId();
+		if ((tunnelInfo.tunnelTypes & TunnelMPLS) != 0 && tunnelInfo.mplsLabelCount > 0)
+			mplsLabel = tunnelInfo.mplsLabels[0];
+	}
+	else
+	{
+		if (!FlowKeyExtractor::extract(data, dataLen, linkType, outerView))
+		{
+			m_Stats.nonIpPackets++;
+			return false;
+		}
+
+		view = &outerView;
+		key.tunnelId = 0;
+	}
+
+	FlowHash::getTuple(*view, key.tuple);
+	key.vlanId = (view->vlanCount > 0 ? view->vlanId : 0);
+
+	// the label stack directly precedes the network header
+	if (!m_Config.decapsulateTunnels && view->mplsLabelCount > 0)
+	{
+		const uint8_t* label = data + view->networkOffset - view->mplsLabelCount * MPLS_LABEL_LENGTH;
+		mplsLabel = ((uint32_t)label[0] << 12) | ((uint32_t)label[1] << 4) | (label[2] >> 4);
+	}
+
+	uint32_t ipLength;
+	uint8_t tos;
+	readIpFields(data, dataLen, *view, ipLength, tos);
+	uint8_t tcpFlags = (view->isPacketOfType(TCP) ? view->tcpFlags : 0);
+
+	bool isNew;
+	FlowCounters& counters = m_FlowTable.get(key, &isNew);
+	if (isNew)
+	{
+		m_Stats.flowsCreated++;
+	}
+	else if (m_Config.activeTimeout > 0 && timestamp >= counters.firstSeen && timestamp - counters.firstSeen >= (uint64_t)m_Config.activeTimeout * 1000)
+	{
+		// the record is exported and the flow starts over with this packet
+		exportFlow(key, counters, FlowEndActiveTimeout);
+		counters = FlowCounters();
+	}
+
+	if (counters.packets == 0)
+	{
+		counters.firstSeen = timestamp;
+		counters.mplsLabel = mplsLabel;
+		counters.tos = tos;
+	}
+
+	counters.packets++;
+	counters.bytes += ipLength;
+	counters.tcpFlags |= tcpFlags;
+	if (timestamp > counters.lastSeen)
+		counters.lastSeen = timestamp;
+	if (timestamp < counters.firstSeen)
+		counters.firstSeen = timestamp;
+
+	if (m_Config.exportOnTcpEnd && (tcpFlags & (TCP_FLAG_FIN | TCP_FLAG_RST)) != 0)
+	{
+		exportFlow(key, counters, FlowEndDetected);
+		m_FlowTable.erase(key);
+	}
+
+	return true;
+}
+
+void FlowMeter::advanceTime(uint64_t timestamp)
+{
+	if (timestamp <= m_CurrentTime)
+		return;
+
+	m_CurrentTime = timestamp;
+	m_FlowTable.advanceTime(timestamp / 1000);
+}
+
+void FlowMeter::flush()
+{
+	std::vector<std::pair<FlowKey, FlowCounters> > flows;
+	m_FlowTable.getEntries(flows);
+	for (size_t i = 0; i < flows.size(); i++)
+		exportFlow(flows[i].first, flows[i].second, FlowEndForced);
+
+	m_FlowTable.clear();
+	LOG_DEBUG("Flushed %d flows", (int)flows.size());
+}
+
+void FlowMeter::exportFlow(const FlowKey& key, const FlowCounters& counters, FlowEndReason reason)
+{
+	FlowRecord record;
+	record.tuple = key.tuple;
+	record.vlanId = key.vlanId;
+	record.tunnelId = key.tunnelId;
+	record.mplsLabel = counters.mplsLabel;
+	record.tos = counters.tos;
+	record.tcpFlags = counters.tcpFlags;
+	record.endReason = reason;
+	record.packets = counters.packets;
+	record.bytes = counters.bytes;
+	record.firstSeen = counters.firstSeen;
+	record.lastSeen = counters.lastSeen;
+
+	m_Stats.recordsExported++;
+	m_OnFlowExported(record, m_UserCookie);
+}
+
+void FlowMeter::onFlowRemoved(const FlowKey& key, FlowCounters& counters, FlowRemovalReason reason, void* userCookie)
+{
+	FlowMeter* meter = (FlowMeter*)userCookie;
+	meter->exportFlow(key, counters, reason == FlowRemovedByIdleTimeout ? FlowEndIdleTimeout : FlowEndLackOfResources);
+}
+
+} // namespace pcpp
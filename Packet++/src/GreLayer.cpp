@@ -8,6 +8,7 @@
 #include "VlanLayer.h"
 #include "MplsLayer.h"
 #include "PayloadLayer.h"
+#include "ProtocolRegistry.h"
 #include "Logger.h"
 #include "IpUtils.h"
 #if defined(WIN32) || defined(WINx64) //for using ntohl, ntohs, etc.
@@ -107,9 +108,9 @@ uint8_t* GreLayer::getFieldValue(GreField field, bool returnOffsetEvenIfFieldMis
 void GreLayer::computeCalculateFieldsInner()
 {
 	gre_basic_header* header = (gre_basic_header*)m_Data;
-	if (m_NextLayer != NULL)
+	if (getNextLayer() != NULL)
 	{
-		switch (m_NextLayer->getProtocol())
+		switch (getNextLayer()->getProtocol())
 		{
 		case IPv4:
 			header->protocol = htons(PCPP_ETHERTYPE_IP);
@@ -206,25 +207,25 @@ void GreLayer::parseNextLayer()
 		return;
 
 	gre_basic_header* header = (gre_basic_header*)m_Data;
-	switch (ntohs(header->protocol))
+	switch (ProtocolRegistry::getInstance().getProtocolByEtherType(ntohs(header->protocol)))
 	{
-	case PCPP_ETHERTYPE_IP:
-		m_NextLayer = new IPv4Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	case IPv4:
+		m_NextLayer = new(m_Packet) IPv4Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_IPV6:
-		m_NextLayer = new IPv6Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	case IPv6:
+		m_NextLayer = new(m_Packet) IPv6Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_VLAN:
-		m_NextLayer = new VlanLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	case VLAN:
+		m_NextLayer = new(m_Packet) VlanLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_MPLS:
-		m_NextLayer = new MplsLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	case MPLS:
+		m_NextLayer = new(m_Packet) MplsLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_PPP:
-		m_NextLayer = new PPP_PPTPLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	case PPP_PPTP:
+		m_NextLayer = new(m_Packet) PPP_PPTPLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
 	default:
-		m_NextLayer = new PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 	}
 }
 
@@ -560,13 +561,13 @@ void PPP_PPTPLayer::parseNextLayer()
 	switch (ntohs(getPPP_PPTPHeader()->protocol))
 	{
 	case PCPP_PPP_IP:
-		m_NextLayer = new IPv4Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) IPv4Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
 	case PCPP_PPP_IPV6:
-		m_NextLayer = new IPv6Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) IPv6Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
 	default:
-		m_NextLayer = new PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
 	}
 }
@@ -574,9 +575,9 @@ void PPP_PPTPLayer::parseNextLayer()
 void PPP_PPTPLayer::computeCalculateFields()
 {
 	ppp_pptp_header* header = getPPP_PPTPHeader();
-	if (m_NextLayer != NULL)
+	if (getNextLayer() != NULL)
 	{
-		switch (m_NextLayer->getProtocol())
+		switch (getNextLayer()->getProtocol())
 		{
 		case IPv4:
 			header->protocol = htons(PCPP_PPP_IP);
@@ -1,6 +1,5 @@
 #define LOG_MODULE PacketLogModuleGtpLayer
 
-#include <map>
 #include <sstream>
 #include "Logger.h"
 #include "GtpLayer.h"
@@ -442,84 +441,151 @@ GtpV1MessageType GtpV1Layer::getMessageType()
     return (GtpV1MessageType)header->messageType;
 }
 
-std::map<uint8_t, std::string> createGtpV1MessageTypeToStringMap()
-{    
-	std::map<uint8_t, std::string> tempMap;
-
-    tempMap[0] =   "GTPv1 Message Type Unknown";
-    tempMap[1] =   "Echo Request";
-    tempMap[2] =   "Echo Response";
-    tempMap[3] =   "Version Not Supported";
-    tempMap[4] =   "Node Alive Request";
-    tempMap[5] =   "Node Alive Response";
-    tempMap[6] =   "Redirection Request";
-    tempMap[7] =   "Create PDP Context Request";
-    tempMap[16] =  "Create PDP Context Response";
-    tempMap[17] =  "Update PDP Context Request";
-    tempMap[18] =  "Update PDP Context Response";
-    tempMap[19] =  "Delete PDP Context Request";
-    tempMap[20] =  "Delete PDP Context Response";
-    tempMap[22] =  "Initiate PDP Context Activation Request";
-    tempMap[23] =  "Initiate PDP Context Activation Response";
-    tempMap[26] =  "Error Indication";
-    tempMap[27] =  "PDU Notification Request";
-    tempMap[28] =  "PDU Notification Response";
-    tempMap[29] =  "PDU Notification Reject Request";
-    tempMap[30] =  "PDU Notification Reject Response";
-    tempMap[31] =  "Supported Extensions Header Notification";
-    tempMap[32] =  "Send Routing for GPRS Request";
-    tempMap[33] =  "Send Routing for GPRS Response";
-    tempMap[34] =  "Failure Report Request";
-    tempMap[35] =  "Failure Report Response";
-    tempMap[36] =  "Note MS Present Request";
-    tempMap[37] =  "Note MS Present Response";
-    tempMap[38] =  "Identification Request";
-    tempMap[39] =  "Identification Response";
-    tempMap[50] =  "SGSN Context Request";
-    tempMap[51] =  "SGSN Context Response";
-    tempMap[52] =  "SGSN Context Acknowledge";
-    tempMap[53] =  "Forward Relocation Request";
-    tempMap[54] =  "Forward Relocation Response";
-    tempMap[55] =  "Forward Relocation Complete";
-    tempMap[56] =  "Relocation Cancel Request";
-    tempMap[57] =  "Relocation Cancel Response";
-    tempMap[58] =  "Forward SRNS Context";
-    tempMap[59] =  "Forward Relocation Complete Acknowledge";
-    tempMap[60] =  "Forward SRNS Context Acknowledge";
-    tempMap[61] =  "UE Registration Request";
-    tempMap[62] =  "UE Registration Response";
-    tempMap[70] =  "RAN Information Relay";
-    tempMap[96] =  "MBMS Notification Request";
-    tempMap[97] =  "MBMS Notification Response";
-    tempMap[98] =  "MBMS Notification Reject Request";
-    tempMap[99] =  "MBMS Notification Reject Response";
-    tempMap[100] = "Create MBMS Notification Request";
-    tempMap[101] = "Create MBMS Notification Response";
-    tempMap[102] = "Update MBMS Notification Request";
-    tempMap[103] = "Update MBMS Notification Response";
-    tempMap[104] = "Delete MBMS Notification Request";
-    tempMap[105] = "Delete MBMS Notification Response";
-    tempMap[112] = "MBMS Registration Request";
-    tempMap[113] = "MBMS Registration Response";
-    tempMap[114] = "MBMS De-Registration Request";
-    tempMap[115] = "MBMS De-Registration Response";
-    tempMap[116] = "MBMS Session Start Request";
-    tempMap[117] = "MBMS Session Start Response";
-    tempMap[118] = "MBMS Session Stop Request";
-    tempMap[119] = "MBMS Session Stop Response";
-    tempMap[120] = "MBMS Session Update Request";
-    tempMap[121] = "MBMS Session Update Response";
-    tempMap[128] = "MS Info Change Request";
-    tempMap[129] = "MS Info Change Response";
-    tempMap[240] = "Data Record Transfer Request";
-    tempMap[241] = "Data Record Transfer Response";
-    tempMap[254] = "End Marker";
-    tempMap[255] = "G-PDU";
-
-	return tempMap;
-}
-
-const std::map<uint8_t, std::string> GTPv1MsgTypeToStringMap = createGtpV1MessageTypeToStringMap();
+// the names of the message types. A switch is compiled into a jump table, so unlike a map it costs nothing at startup
+static const char* getGtpV1MessageTypeName(uint8_t messageType)
+{
+	switch (messageType)
+	{
+	case 1:
+		return "Echo Request";
+	case 2:
+		return "Echo Response";
+	case 3:
+		return "Version Not Supported";
+	case 4:
+		return "Node Alive Request";
+	case 5:
+		return "Node Alive Response";
+	case 6:
+		return "Redirection Request";
+	case 7:
+		return "Create PDP Context Request";
+	case 16:
+		return "Create PDP Context Response";
+	case 17:
+		return "Update PDP Context Request";
+	case 18:
+		return "Update PDP Context Response";
+	case 19:
+		return "Delete PDP Context Request";
+	case 20:
+		return "Delete PDP Context Response";
+	case 22:
+		return "Initiate PDP Context Activation Request";
+	case 23:
+		return "Initiate PDP Context Activation Response";
+	case 26:
+		return "Error Indication";
+	case 27:
+		return "PDU Notification Request";
+	case 28:
+		return "PDU Notification Response";
+	case 29:
+		return "PDU Notification Reject Request";
+	case 30:
+		return "PDU Notification Reject Response";
+	case 31:
+		return "Supported Extensions Header Notification";
+	case 32:
+		return "Send Routing for GPRS Request";
+	case 33:
+		return "Send Routing for GPRS Response";
+	case 34:
+		return "Failure Report Request";
+	case 35:
+		return "Failure Report Response";
+	case 36:
+		return "Note MS Present Request";
+	case 37:
+		return "Note MS Present Response";
+	case 38:
+		return "Identification Request";
+	case 39:
+		return "Identification Response";
+	case 50:
+		return "SGSN Context Request";
+	case 51:
+		return "SGSN Context Response";
+	case 52:
+		return "SGSN Context Acknowledge";
+	case 53:
+		return "Forward Relocation Request";
+	case 54:
+		return "Forward Relocation Response";
+	case 55:
+		return "Forward Relocation Complete";
+	case 56:
+		return "Relocation Cancel Request";
+	case 57:
+		return "Relocation Cancel Response";
+	case 58:
+		return "Forward SRNS Context";
+	case 59:
+		return "Forward Relocation Complete Acknowledge";
+	case 60:
+		return "Forward SRNS Context Acknowledge";
+	case 61:
+		return "UE Registration Request";
+	case 62:
+		return "UE Registration Response";
+	case 70:
+		return "RAN Information Relay";
+	case 96:
+		return "MBMS Notification Request";
+	case 97:
+		return "MBMS Notification Response";
+	case 98:
+		return "MBMS Notification Reject Request";
+	case 99:
+		return "MBMS Notification Reject Response";
+	case 100:
+		return "Create MBMS Notification Request";
+	case 101:
+		return "Create MBMS Notification Response";
+	case 102:
+		return "Update MBMS Notification Request";
+	case 103:
+		return "Update MBMS Notification Response";
+	case 104:
+		return "Delete MBMS Notification Request";
+	case 105:
+		return "Delete MBMS Notification Response";
+	case 112:
+		return "MBMS Registration Request";
+	case 113:
+		return "MBMS Registration Response";
+	case 114:
+		return "MBMS De-Registration Request";
+	case 115:
+		return "MBMS De-Registration Response";
+	case 116:
+		return "MBMS Session Start Request";
+	case 117:
+		return "MBMS Session Start Response";
+	case 118:
+		return "MBMS Session Stop Request";
+	case 119:
+		return "MBMS Session Stop Response";
+	case 120:
+		return "MBMS Session Update Request";
+	case 121:
+		return "MBMS Session Update Response";
+	case 128:
+		return "MS Info Change Request";
+	case 129:
+		return "MS Info Change Response";
+	case 240:
+		return "Data Record Transfer Request";
+	case 241:
+		return "Data Record Transfer Response";
+	case 254:
+		return "End Marker";
+	case 255:
+		return "G-PDU";
+	default:
+		return "GTPv1 Message Type Unknown";
+	}
+}
 
 std::string GtpV1Layer::getMessageTypeAsString()
 {
@@ -527,18 +593,10 @@ std::string GtpV1Layer::getMessageTypeAsString()
 
     if (header == NULL)
     {
-        return GTPv1MsgTypeToStringMap.find(0)->second;
+        return getGtpV1MessageTypeName(0);
     }
 
-    std::map<uint8_t, std::string>::const_iterator iter = GTPv1MsgTypeToStringMap.find(header->messageType);
-    if (iter != GTPv1MsgTypeToStringMap.end())
-    {
-        return iter->second;
-    }
-    else
-    {
-        return GTPv1MsgTypeToStringMap.find(0)->second;
-    }
+    return getGtpV1MessageTypeName(header->messageType);
 }
 
 bool GtpV1Layer::isGTPUMessage()
@@ -591,15 +649,15 @@ void GtpV1Layer::parseNextLayer()
     uint8_t subProto = *(uint8_t*)(m_Data + headerLen);
     if (subProto >= 0x45 && subProto <= 0x4e)
     {
-        m_NextLayer = new IPv4Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+        m_NextLayer = new(m_Packet) IPv4Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
     }
     else if ((subProto & 0xf0) == 0x60)
     {
-        m_NextLayer = new IPv6Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+        m_NextLayer = new(m_Packet) IPv6Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
     }
     else
     {
-        m_NextLayer = new PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+        m_NextLayer = new(m_Packet) PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
     }
 }
 
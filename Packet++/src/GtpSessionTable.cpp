@@ -0,0 +1,973 @@
+#define LOG_MODULE PacketLogModuleGtpSessionTable
+
+#include "GtpSessionTable.h"
+#include "AtomicUtils.h"
+#include "GtpLayer.h"
+#include "ProtocolRegistry.h"
+#include "Logger.h"
+#include <string.h>
+
+// the flags of the first byte of the GTPv1 header
+#define GTP_VERSION_MASK      0xe0
+#define GTP_VERSION_1         0x20
+#define GTP_PROTOCOL_TYPE_GTP 0x10
+#define GTP_EXTENSION_FLAG    0x04
+#define GTP_SEQUENCE_FLAG     0x02
+#define GTP_OPTIONAL_FIELDS   0x07
+
+// the PDP context message types (3GPP TS 29.060 section 7.1). GtpV1MessageType numbers them differently, so the wire values are used
+#define GTP_CREATE_PDP_CONTEXT_REQUEST  16
+#define GTP_CREATE_PDP_CONTEXT_RESPONSE 17
+#define GTP_UPDATE_PDP_CONTEXT_REQUEST  18
+#define GTP_UPDATE_PDP_CONTEXT_RESPONSE 19
+#define GTP_DELETE_PDP_CONTEXT_REQUEST  20
+#define GTP_DELETE_PDP_CONTEXT_RESPONSE 21
+
+// the information elements of GTPv1-C used by the table (3GPP TS 29.060 section 7.7)
+#define GTP_IE_CAUSE           1
+#define GTP_IE_IMSI            2
+#define GTP_IE_TEID_DATA_I     16
+#define GTP_IE_TEID_CONTROL    17
+#define GTP_IE_NSAPI           20
+#define GTP_IE_END_USER_ADDR   128
+#define GTP_IE_GSN_ADDRESS     133
+
+// the cause values 128-191 mean the request was accepted
+#define GTP_CAUSE_ACCEPTED_FIRST 128
+#define GTP_CAUSE_ACCEPTED_LAST  191
+
+// the PDP types of the End User Address information element
+#define GTP_PDP_TYPE_ORG_IETF 0x01
+#define GTP_PDP_TYPE_IPV4     0x21
+#define GTP_PDP_TYPE_IPV6     0x57
+#define GTP_PDP_TYPE_IPV4V6   0x8d
+
+namespace pcpp
+{
+
+// the fields of a GTPv1 header, and where its payload (the information elements or the T-PDU) starts
+struct GtpHeaderFields
+{
+	uint8_t messageType;
+	uint32_t teid;
+	uint16_t sequenceNumber;
+	bool hasSequenceNumber;
+	size_t headerLen;
+	// the message length according to the header, which may be longer than the captured data
+	size_t messageLen;
+};
+
+// the information elements of a GTPv1-C message used by the table
+struct GtpControlFields
+{
+	bool hasCause;
+	uint8_t cause;
+	char imsi[16];
+	bool hasTeidData;
+	uint32_t teidData;
+	bool hasTeidControl;
+	uint32_t teidControl;
+	uint8_t nsapi;
+	uint8_t endUserIpVersion;
+	uint8_t endUserAddress[16];
+	// the first GSN address is the control plane address of the sender and the second one its user plane address
+	int numOfGsnAddresses;
+	GtpTunnelEndpoint gsnAddresses[2];
+};
+
+static inline uint32_t readUint32(const uint8_t* data)
+{
+	return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+}
+
+static inline size_t getAddressLength(uint8_t ipVersion)
+{
+	return (ipVersion == 6 ? 16 : 4);
+}
+
+static void setEndpointAddress(GtpTunnelEndpoint& endpoint, uint8_t ipVersion, const uint8_t* ipAddress)
+{
+	memset(endpoint.ipAddress, 0, sizeof(endpoint.ipAddress));
+	endpoint.ipVersion = ipVersion;
+	memcpy(endpoint.ipAddress, ipAddress, getAddressLength(ipVersion));
+}
+
+static inline bool isSameEndpoint(const GtpTunnelEndpoint& first, const GtpTunnelEndpoint& second)
+{
+	return first.teid == second.teid && first.ipVersion == second.ipVersion &&
+			memcmp(first.ipAddress, second.ipAddress, getAddressLength(first.ipVersion)) == 0;
+}
+
+static bool parseGtpHeader(const uint8_t* data, size_t dataLen, GtpHeaderFields& fields)
+{
+	if (dataLen < sizeof(gtpv1_header))
+		return false;
+
+	// only GTP (not GTP') version 1
+	uint8_t flags = data[0];
+	if ((flags & GTP_VERSION_MASK) != GTP_VERSION_1 || (flags & GTP_PROTOCOL_TYPE_GTP) == 0)
+		return false;
+
+	fields.messageType = data[1];
+	fields.messageLen = sizeof(gtpv1_header) + (((size_t)data[2] << 8) | data[3]);
+	fields.teid = readUint32(data + 4);
+	fields.hasSequenceNumber = false;
+	fields.sequenceNumber = 0;
+	fields.headerLen = sizeof(gtpv1_header);
+
+	if ((flags & GTP_OPTIONAL_FIELDS) == 0)
+		return true;
+
+	// the sequence number, N-PDU number and next extension type are present if any of their flags is set
+	fields.headerLen += 4;
+	if (dataLen < fields.headerLen)
+		return false;
+
+	fields.hasSequenceNumber = ((flags & GTP_SEQUENCE_FLAG) != 0);
+	fields.sequenceNumber = (uint16_t)(((uint16_t)data[8] << 8) | data[9]);
+
+	if ((flags & GTP_EXTENSION_FLAG) == 0)
+		return true;
+
+	// each extension header has its length in 4-byte units in its first byte and the type of the next one in its last byte
+	uint8_t nextExtensionType = data[11];
+	while (nextExtensionType != 0)
+	{
+		if (dataLen < fields.headerLen + 1 || data[fields.headerLen] == 0)
+			return false;
+
+		size_t extensionLen = (size_t)data[fields.headerLen] * 4;
+		if (dataLen < fields.headerLen + extensionLen)
+			return false;
+
+		nextExtensionType = data[fields.headerLen + extensionLen - 1];
+		fields.headerLen += extensionLen;
+	}
+
+	return fields.headerLen <= fields.messageLen;
+}
+
+// the length of the value of a TV information element (types 1-127), or 0 if the type is unknown and the rest of the message can't be parsed
+static size_t getTVLength(uint8_t type)
+{
+	switch (type)
+	{
+	case 1: case 8: case 11: case 13: case 14: case 15: case 19: case 20: case 21: case 23: case 24: case 29:
+		return 1;
+	case 25: case 26: case 27: case 28:
+		return 2;
+	case 12:
+		return 3;
+	case 4: case 5: case 16: case 17: case 127:
+		return 4;
+	case 18:
+		return 5;
+	case 3:
+		return 6;
+	case 2:
+		return 8;
+	case 22:
+		return 9;
+	case 9:
+		return 28;
+	default:
+		return 0;
+	}
+}
+
+static void parseImsi(const uint8_t* data, char* imsi)
+{
+	// TBCD: two digits per byte, the first one in the low nibble, filled with 0xf
+	int numOfDigits = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		uint8_t digits[2] = { (uint8_t)(data[i] & 0x0f), (uint8_t)(data[i] >> 4) };
+		for (int j = 0; j < 2; j++)
+		{
+			if (digits[j] > 9 || numOfDigits == 15)
+			{
+				imsi[numOfDigits] = 0;
+				return;
+			}
+			imsi[numOfDigits++] = (char)('0' + digits[j]);
+		}
+	}
+
+	imsi[numOfDigits] = 0;
+}
+
+static void parseControlFields(const uint8_t* data, size_t dataLen, GtpControlFields& fields)
+{
+	memset(&fields, 0, sizeof(fields));
+
+	size_t offset = 0;
+	while (offset < dataLen)
+	{
+		uint8_t type = data[offset];
+		const uint8_t* value;
+		size_t valueLen;
+
+		if (type < 128)
+		{
+			valueLen = getTVLength(type);
+			if (valueLen == 0)
+				return;
+			value = data + offset + 1;
+			offset += 1 + valueLen;
+		}
+		else
+		{
+			if (offset + 3 > dataLen)
+				return;
+			valueLen = ((size_t)data[offset + 1] << 8) | data[offset + 2];
+			value = data + offset + 3;
+			offset += 3 + valueLen;
+		}
+
+		if (offset > dataLen)
+			return;
+
+		switch (type)
+		{
+		case GTP_IE_CAUSE:
+			fields.hasCause = true;
+			fields.cause = value[0];
+			break;
+		case GTP_IE_IMSI:
+			parseImsi(value, fields.imsi);
+			break;
+		case GTP_IE_TEID_DATA_I:
+			fields.hasTeidData = true;
+			fields.teidData = readUint32(value);
+			break;
+		case GTP_IE_TEID_CONTROL:
+			fields.hasTeidControl = true;
+			fields.teidControl = readUint32(value);
+			break;
+		case GTP_IE_NSAPI:
+			fields.nsapi = value[0] & 0x0f;
+			break;
+		case GTP_IE_END_USER_ADDR:
+			if (valueLen < 2 || (value[0] & 0x0f) != GTP_PDP_TYPE_ORG_IETF)
+				break;
+			// an IPv4v6 address has the IPv4 address first
+			if ((value[1] == GTP_PDP_TYPE_IPV4 || value[1] == GTP_PDP_TYPE_IPV4V6) && valueLen >= 6)
+			{
+				fields.endUserIpVersion = 4;
+				memcpy(fields.endUserAddress, value + 2, 4);
+			}
+			else if (value[1] == GTP_PDP_TYPE_IPV6 && valueLen >= 18)
+			{
+				fields.endUserIpVersion = 6;
+				memcpy(fields.endUserAddress, value + 2, 16);
+			}
+			break;
+		case GTP_IE_GSN_ADDRESS:
+			if (fields.numOfGsnAddresses < 2 && (valueLen == 4 || valueLen == 16))
+			{
+				setEndpointAddress(fields.gsnAddresses[fields.numOfGsnAddresses], (valueLen == 4 ? 4 : 6), value);
+				fields.numOfGsnAddresses++;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static inline bool isAccepted(const GtpControlFields& fields)
+{
+	return fields.hasCause && fields.cause >= GTP_CAUSE_ACCEPTED_FIRST && fields.cause <= GTP_CAUSE_ACCEPTED_LAST;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~
+// GtpSessionTable members
+// ~~~~~~~~~~~~~~~~~~~~~~~
+
+bool GtpSessionTable::PendingKey::operator<(const PendingKey& other) const
+{
+	if (sequenceNumber != other.sequenceNumber)
+		return sequenceNumber < other.sequenceNumber;
+	if (ipVersion != other.ipVersion)
+		return ipVersion < other.ipVersion;
+	return memcmp(ipAddress, other.ipAddress, sizeof(ipAddress)) < 0;
+}
+
+GtpSessionTable::GtpSessionTable(OnGtpSessionEnd onSessionEnd, void* userCookie, const GtpSessionTableConfiguration& config) :
+	m_OnSessionEnd(onSessionEnd), m_UserCookie(userCookie), m_Config(config)
+{
+	if (m_Config.maxNumOfSessions == 0)
+		m_Config.maxNumOfSessions = 1;
+
+	// each session has up to 4 tunnels, 2 of which are looked up by the user plane
+	size_t numOfBuckets = 16;
+	while (numOfBuckets < m_Config.maxNumOfSessions * 2)
+		numOfBuckets <<= 1;
+
+	m_Buckets = new TunnelNode* volatile[numOfBuckets];
+	for (size_t i = 0; i < numOfBuckets; i++)
+		m_Buckets[i] = NULL;
+	m_BucketMask = numOfBuckets - 1;
+
+	m_NumOfSessions = 0;
+	m_NextSessionId = 1;
+	m_NumOfRejectedSessions = 0;
+	m_FreeEntries = NULL;
+	m_CurrentTime = 0;
+	m_NumOfRetiredSessions = 0;
+	pthread_mutex_init(&m_Mutex, NULL);
+}
+
+GtpSessionTable::~GtpSessionTable()
+{
+	for (size_t i = 0; i <= m_BucketMask; i++)
+	{
+		TunnelNode* tunnel = m_Buckets[i];
+		while (tunnel != NULL)
+		{
+			TunnelNode* next = tunnel->next;
+			// the session is freed with its first tunnel
+			SessionEntry* entry = tunnel->entry;
+			if (entry != NULL)
+			{
+				for (int j = 0; j < NumOfTunnels; j++)
+				{
+					if (entry->tunnels[j] != NULL)
+						entry->tunnels[j]->entry = NULL;
+				}
+				delete entry;
+			}
+			delete tunnel;
+			tunnel = next;
+		}
+	}
+
+	delete [] m_Buckets;
+
+	m_Reclaimer.reclaimAll(RecycleRetiredItem(this));
+
+	while (m_FreeEntries != NULL)
+	{
+		SessionEntry* next = m_FreeEntries->nextFree;
+		delete m_FreeEntries;
+		m_FreeEntries = next;
+	}
+
+	for (size_t i = 0; i < m_FreeTunnels.size(); i++)
+		delete m_FreeTunnels[i];
+
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+size_t GtpSessionTable::hashEndpoint(const GtpTunnelEndpoint& endpoint)
+{
+	// the TEIDs are allocated by the GSNs and are usually sequential, so they're mixed with the address and scrambled
+	uint32_t hash = endpoint.teid * 0x9e3779b1;
+	size_t addressLen = getAddressLength(endpoint.ipVersion);
+	for (size_t i = 0; i < addressLen; i += 4)
+	{
+		hash ^= readUint32(endpoint.ipAddress + i);
+		hash *= 0x85ebca6b;
+		hash ^= hash >> 13;
+	}
+
+	hash ^= hash >> 16;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+const GtpSessionTable::TunnelNode* GtpSessionTable::findTunnel(const GtpTunnelEndpoint& endpoint, bool isControl) const
+{
+	const TunnelNode* tunnel = atomicLoadPointerAcquire(&m_Buckets[hashEndpoint(endpoint) & m_BucketMask]);
+	while (tunnel != NULL)
+	{
+		if (tunnel->isControl == isControl && isSameEndpoint(tunnel->endpoint, endpoint))
+			return tunnel;
+		tunnel = atomicLoadPointerAcquire(&tunnel->next);
+	}
+
+	return NULL;
+}
+
+void GtpSessionTable::insertTunnel(SessionEntry* entry, TunnelIndex index, const GtpTunnelEndpoint& endpoint)
+{
+	if (endpoint.ipVersion == 0)
+		return;
+
+	TunnelNode* tunnel;
+	if (!m_FreeTunnels.empty())
+	{
+		tunnel = m_FreeTunnels.back();
+		m_FreeTunnels.pop_back();
+	}
+	else
+	{
+		tunnel = new TunnelNode();
+	}
+
+	tunnel->entry = entry;
+	tunnel->endpoint = endpoint;
+	tunnel->isControl = (index == SgsnControlTunnel || index == GgsnControlTunnel);
+	// packets sent to the GGSN are uplink packets
+	tunnel->direction = (index == GgsnUserPlaneTunnel || index == GgsnControlTunnel ? GtpSessionUplink : GtpSessionDownlink);
+
+	// the tunnel is fully written before it's published at the head of its bucket
+	TunnelNode* volatile* bucket = &m_Buckets[hashEndpoint(endpoint) & m_BucketMask];
+	tunnel->next = *bucket;
+	atomicStorePointerRelease(bucket, tunnel);
+
+	entry->tunnels[index] = tunnel;
+}
+
+void GtpSessionTable::eraseTunnel(SessionEntry* entry, TunnelIndex index)
+{
+	TunnelNode* tunnel = entry->tunnels[index];
+	if (tunnel == NULL)
+		return;
+
+	entry->tunnels[index] = NULL;
+
+	// readers standing on the tunnel still reach the rest of the chain through its next link, which isn't changed
+	TunnelNode* volatile* link = &m_Buckets[hashEndpoint(tunnel->endpoint) & m_BucketMask];
+	while (*link != NULL && *link != tunnel)
+		link = &(*link)->next;
+
+	if (*link == tunnel)
+		atomicStorePointerRelease(link, (TunnelNode*)tunnel->next);
+
+	RetiredItem retired;
+	retired.entry = NULL;
+	retired.tunnel = tunnel;
+	m_Reclaimer.retire(retired);
+}
+
+const GtpSession* GtpSessionTable::processPacket(const RawPacket* rawPacket, GtpSessionDirection* direction)
+{
+	PacketView view;
+	if (!FlowKeyExtractor::extract(rawPacket, view) || !view.isPacketOfType(UDP) || view.payloadOffset == PacketView::NoOffset)
+		return NULL;
+
+	const ProtocolRegistry& registry = ProtocolRegistry::getInstance();
+	if (!registry.isPortOfProtocol(view.dstPort, GTPv1) && !registry.isPortOfProtocol(view.srcPort, GTPv1))
+		return NULL;
+
+	const uint8_t* data = rawPacket->getRawData();
+	time_t packetTime = rawPacket->getPacketTimeStamp().tv_sec;
+
+	// G-PDUs carry the user plane, all other GTP messages of interest are control messages
+	if (view.payloadLength >= 2 && data[view.payloadOffset + 1] == GtpV1_GPDU)
+		return classifyPacket(data, view, packetTime, direction);
+
+	return processControlMessage(data, view, packetTime);
+}
+
+const GtpSession* GtpSessionTable::classifyPacket(const uint8_t* data, const PacketView& view, time_t packetTime, GtpSessionDirection* direction)
+{
+	if (view.payloadOffset == PacketView::NoOffset)
+		return NULL;
+
+	GtpHeaderFields header;
+	if (!parseGtpHeader(data + view.payloadOffset, view.payloadLength, header) || header.messageType != GtpV1_GPDU)
+		return NULL;
+
+	// a GTP-U packet is sent to the GSN which allocated its TEID
+	GtpTunnelEndpoint endpoint;
+	endpoint.teid = header.teid;
+	setEndpointAddress(endpoint, view.ipVersion, view.dstIP);
+
+	const TunnelNode* tunnel = findTunnel(endpoint, false);
+	if (tunnel == NULL)
+		return NULL;
+
+	GtpSession* session = &tunnel->entry->session;
+	uint64_t userBytes = (header.messageLen > header.headerLen ? header.messageLen - header.headerLen : 0);
+	if (tunnel->direction == GtpSessionUplink)
+	{
+		atomicFetchAdd(&session->uplinkPackets, 1);
+		atomicFetchAdd(&session->uplinkBytes, userBytes);
+	}
+	else
+	{
+		atomicFetchAdd(&session->downlinkPackets, 1);
+		atomicFetchAdd(&session->downlinkBytes, userBytes);
+	}
+
+	// the activity time is written only when it changes, so packets of the same second don't keep invalidating the cache line
+	if (atomicLoadRelaxed(&session->lastActivityTime) < packetTime)
+		atomicStoreRelaxed(&session->lastActivityTime, packetTime);
+
+	if (direction != NULL)
+		*direction = tunnel->direction;
+
+	return session;
+}
+
+const GtpSession* GtpSessionTable::findSession(uint32_t teid, uint8_t ipVersion, const uint8_t* ipAddress, GtpSessionDirection* direction) const
+{
+	if (ipVersion != 4 && ipVersion != 6)
+		return NULL;
+
+	GtpTunnelEndpoint endpoint;
+	endpoint.teid = teid;
+	setEndpointAddress(endpoint, ipVersion, ipAddress);
+
+	const TunnelNode* tunnel = findTunnel(endpoint, false);
+	if (tunnel == NULL)
+		return NULL;
+
+	if (direction != NULL)
+		*direction = tunnel->direction;
+
+	return &tunnel->entry->session;
+}
+
+const GtpSession* GtpSessionTable::processControlMessage(const uint8_t* data, const PacketView& view, time_t packetTime)
+{
+	if (view.payloadOffset == PacketView::NoOffset || (view.ipVersion != 4 && view.ipVersion != 6))
+		return NULL;
+
+	GtpHeaderFields header;
+	if (!parseGtpHeader(data + view.payloadOffset, view.payloadLength, header) || !header.hasSequenceNumber)
+		return NULL;
+
+	// the information elements end where the message or the captured data ends
+	size_t messageLen = (header.messageLen < view.payloadLength ? header.messageLen : view.payloadLength);
+	const uint8_t* ies = data + view.payloadOffset + header.headerLen;
+	size_t iesLen = messageLen - header.headerLen;
+
+	pthread_mutex_lock(&m_Mutex);
+
+	if (packetTime > m_CurrentTime)
+	{
+		m_CurrentTime = packetTime;
+		expireLocked();
+	}
+
+	SessionEntry* entry = NULL;
+	switch (header.messageType)
+	{
+	case GTP_CREATE_PDP_CONTEXT_REQUEST:
+	case GTP_UPDATE_PDP_CONTEXT_REQUEST:
+	case GTP_DELETE_PDP_CONTEXT_REQUEST:
+		handleRequest(header.messageType, header.teid, header.sequenceNumber, ies, iesLen, view);
+		break;
+	case GTP_CREATE_PDP_CONTEXT_RESPONSE:
+	case GTP_UPDATE_PDP_CONTEXT_RESPONSE:
+	case GTP_DELETE_PDP_CONTEXT_RESPONSE:
+		entry = handleResponse(header.messageType, header.sequenceNumber, ies, iesLen, view);
+		break;
+	default:
+		break;
+	}
+
+	reclaimLocked();
+
+	pthread_mutex_unlock(&m_Mutex);
+
+	return (entry != NULL ? &entry->session : NULL);
+}
+
+void GtpSessionTable::handleRequest(uint8_t messageType, uint32_t teid, uint16_t sequenceNumber, const uint8_t* ies, size_t iesLen, const PacketView& view)
+{
+	GtpControlFields fields;
+	parseControlFields(ies, iesLen, fields);
+
+	PendingRequest request;
+	memset(&request, 0, sizeof(request));
+	request.messageType = messageType;
+	request.time = m_CurrentTime;
+
+	if (messageType == GTP_CREATE_PDP_CONTEXT_REQUEST)
+	{
+		// a request with a TEID is sent over an existing control tunnel, so it creates a secondary context
+		if (teid != 0 || !fields.hasTeidData || !fields.hasTeidControl)
+			return;
+
+		request.fromSgsn = true;
+		memcpy(request.imsi, fields.imsi, sizeof(request.imsi));
+		request.nsapi = fields.nsapi;
+	}
+	else
+	{
+		// update and delete requests are sent to the control tunnel of their receiver
+		GtpTunnelEndpoint receiver;
+		receiver.teid = teid;
+		setEndpointAddress(receiver, view.ipVersion, view.dstIP);
+		const TunnelNode* tunnel = findTunnel(receiver, true);
+		if (tunnel == NULL)
+			return;
+
+		request.entry = tunnel->entry;
+		request.sessionId = tunnel->entry->session.sessionId;
+		// requests sent to the GGSN are sent by the SGSN
+		request.fromSgsn = (tunnel->direction == GtpSessionUplink);
+	}
+
+	// the control plane address is the first GSN address, or the source of the request if it's missing
+	if (fields.hasTeidControl)
+	{
+		if (fields.numOfGsnAddresses > 0)
+			request.control = fields.gsnAddresses[0];
+		else
+			setEndpointAddress(request.control, view.ipVersion, view.srcIP);
+		request.control.teid = fields.teidControl;
+	}
+
+	if (fields.hasTeidData && fields.numOfGsnAddresses > 1)
+	{
+		request.userPlane = fields.gsnAddresses[1];
+		request.userPlane.teid = fields.teidData;
+	}
+
+	PendingKey key;
+	memset(&key, 0, sizeof(key));
+	key.sequenceNumber = sequenceNumber;
+	key.ipVersion = view.ipVersion;
+	memcpy(key.ipAddress, view.srcIP, getAddressLength(view.ipVersion));
+
+	// a retransmitted request replaces the pending one, so it's timed out from the latest copy
+	m_PendingRequests[key] = request;
+	m_PendingOrder.push_back(std::make_pair(m_CurrentTime, key));
+}
+
+GtpSessionTable::SessionEntry* GtpSessionTable::handleResponse(uint8_t messageType, uint16_t sequenceNumber, const uint8_t* ies, size_t iesLen, const PacketView& view)
+{
+	// the response is sent back to the requester
+	PendingKey key;
+	memset(&key, 0, sizeof(key));
+	key.sequenceNumber = sequenceNumber;
+	key.ipVersion = view.ipVersion;
+	memcpy(key.ipAddress, view.dstIP, getAddressLength(view.ipVersion));
+
+	std::map<PendingKey, PendingRequest>::iterator iter = m_PendingRequests.find(key);
+	if (iter == m_PendingRequests.end() || iter->second.messageType + 1 != messageType)
+	{
+		LOG_DEBUG("Response of message type %d with sequence number %d doesn't match a pending request", (int)messageType, (int)sequenceNumber);
+		return NULL;
+	}
+
+	PendingRequest request = iter->second;
+	m_PendingRequests.erase(iter);
+
+	GtpControlFields fields;
+	parseControlFields(ies, iesLen, fields);
+	if (!isAccepted(fields))
+		return NULL;
+
+	// the responder's endpoints, with its source address as the control plane address if the GSN address is missing
+	GtpTunnelEndpoint control;
+	memset(&control, 0, sizeof(control));
+	if (fields.hasTeidControl)
+	{
+		if (fields.numOfGsnAddresses > 0)
+			control = fields.gsnAddresses[0];
+		else
+			setEndpointAddress(control, view.ipVersion, view.srcIP);
+		control.teid = fields.teidControl;
+	}
+
+	GtpTunnelEndpoint userPlane;
+	memset(&userPlane, 0, sizeof(userPlane));
+	if (fields.hasTeidData && fields.numOfGsnAddresses > 1)
+	{
+		userPlane = fields.gsnAddresses[1];
+		userPlane.teid = fields.teidData;
+	}
+
+	if (messageType == GTP_CREATE_PDP_CONTEXT_RESPONSE)
+		return createSession(request, control, userPlane, fields.endUserIpVersion, fields.endUserAddress);
+
+	SessionEntry* entry = request.entry;
+	if (entry == NULL || entry->timerId == TimerWheel::InvalidTimerId || entry->session.sessionId != request.sessionId)
+		return NULL;
+
+	if (messageType == GTP_DELETE_PDP_CONTEXT_RESPONSE)
+	{
+		removeSession(entry, GtpSessionDeleted);
+		return NULL;
+	}
+
+	// an update changes the endpoints each side sent, the old tunnels stay readable until the readers pass a quiescent state
+	const GtpTunnelEndpoint* newEndpoints[NumOfTunnels] = { NULL, NULL, NULL, NULL };
+	newEndpoints[request.fromSgsn ? SgsnControlTunnel : GgsnControlTunnel] = &request.control;
+	newEndpoints[request.fromSgsn ? SgsnUserPlaneTunnel : GgsnUserPlaneTunnel] = &request.userPlane;
+	newEndpoints[request.fromSgsn ? GgsnControlTunnel : SgsnControlTunnel] = &control;
+	newEndpoints[request.fromSgsn ? GgsnUserPlaneTunnel : SgsnUserPlaneTunnel] = &userPlane;
+
+	GtpTunnelEndpoint* sessionEndpoints[NumOfTunnels] = { &entry->session.sgsnControl, &entry->session.ggsnControl,
+			&entry->session.sgsnUserPlane, &entry->session.ggsnUserPlane };
+
+	for (int i = 0; i < NumOfTunnels; i++)
+	{
+		const GtpTunnelEndpoint& newEndpoint = *newEndpoints[i];
+		if (newEndpoint.ipVersion == 0 || isSameEndpoint(newEndpoint, *sessionEndpoints[i]))
+			continue;
+
+		const TunnelNode* existing = findTunnel(newEndpoint, (i == SgsnControlTunnel || i == GgsnControlTunnel));
+		if (existing != NULL && existing->entry != entry)
+			removeSession(existing->entry, GtpSessionReplaced);
+
+		eraseTunnel(entry, (TunnelIndex)i);
+		*sessionEndpoints[i] = newEndpoint;
+		insertTunnel(entry, (TunnelIndex)i, newEndpoint);
+	}
+
+	// the retired tunnels become reclaimable once the readers see the new epoch
+	m_Reclaimer.advanceEpoch();
+
+	touchSession(entry);
+	return entry;
+}
+
+GtpSessionTable::SessionEntry* GtpSessionTable::createSession(const PendingRequest& request, const GtpTunnelEndpoint& ggsnControl,
+		const GtpTunnelEndpoint& ggsnUserPlane, uint8_t endUserIpVersion, const uint8_t* endUserAddress)
+{
+	const GtpTunnelEndpoint* endpoints[NumOfTunnels] = { &request.control, &ggsnControl, &request.userPlane, &ggsnUserPlane };
+
+	// a TEID which is still in use by a tracked session means that session ended without its delete messages being seen
+	for (int i = 0; i < NumOfTunnels; i++)
+	{
+		if (endpoints[i]->ipVersion == 0)
+			continue;
+
+		const TunnelNode* existing = findTunnel(*endpoints[i], (i == SgsnControlTunnel || i == GgsnControlTunnel));
+		if (existing != NULL)
+			removeSession(existing->entry, GtpSessionReplaced);
+	}
+
+	if (m_NumOfSessions >= m_Config.maxNumOfSessions)
+	{
+		m_NumOfRejectedSessions++;
+		LOG_DEBUG("Session isn't created since %d sessions are already tracked", (int)m_NumOfSessions);
+		return NULL;
+	}
+
+	SessionEntry* entry = m_FreeEntries;
+	if (entry != NULL)
+		m_FreeEntries = entry->nextFree;
+	else
+		entry = new SessionEntry();
+
+	memset(&entry->session, 0, sizeof(entry->session));
+	entry->session.sessionId = m_NextSessionId++;
+	memcpy(entry->session.imsi, request.imsi, sizeof(entry->session.imsi));
+	entry->session.nsapi = request.nsapi;
+	if (endUserIpVersion != 0)
+	{
+		entry->session.endUserIpVersion = endUserIpVersion;
+		memcpy(entry->session.endUserAddress, endUserAddress, getAddressLength(endUserIpVersion));
+	}
+	entry->session.sgsnControl = request.control;
+	entry->session.ggsnControl = ggsnControl;
+	entry->session.sgsnUserPlane = request.userPlane;
+	entry->session.ggsnUserPlane = ggsnUserPlane;
+	entry->session.startTime = m_CurrentTime;
+	entry->session.lastActivityTime = m_CurrentTime;
+	entry->timerId = TimerWheel::InvalidTimerId;
+	entry->nextFree = NULL;
+
+	for (int i = 0; i < NumOfTunnels; i++)
+	{
+		entry->tunnels[i] = NULL;
+		insertTunnel(entry, (TunnelIndex)i, *endpoints[i]);
+	}
+
+	m_NumOfSessions++;
+	touchSession(entry);
+
+	LOG_DEBUG("Session %llu of IMSI '%s' is created", (unsigned long long)entry->session.sessionId, entry->session.imsi);
+	return entry;
+}
+
+void GtpSessionTable::removeSession(SessionEntry* entry, GtpSessionEndReason reason)
+{
+	LOG_DEBUG("Session %llu of IMSI '%s' is removed", (unsigned long long)entry->session.sessionId, entry->session.imsi);
+
+	if (m_OnSessionEnd != NULL)
+		m_OnSessionEnd(entry->session, reason, m_UserCookie);
+
+	if (entry->timerId != TimerWheel::InvalidTimerId)
+	{
+		m_Timers.removeTimer(entry->timerId);
+		entry->timerId = TimerWheel::InvalidTimerId;
+	}
+
+	for (int i = 0; i < NumOfTunnels; i++)
+		eraseTunnel(entry, (TunnelIndex)i);
+
+	RetiredItem retired;
+	retired.entry = entry;
+	retired.tunnel = NULL;
+	m_Reclaimer.retire(retired);
+	m_NumOfRetiredSessions++;
+
+	// readers which see the new epoch in quiescentState() can't reach the session anymore
+	m_Reclaimer.advanceEpoch();
+
+	m_NumOfSessions--;
+}
+
+void GtpSessionTable::touchSession(SessionEntry* entry)
+{
+	atomicStoreRelaxed(&entry->session.lastActivityTime, m_CurrentTime);
+
+	uint64_t expiry = (uint64_t)m_CurrentTime + m_Config.sessionTimeout;
+	if (entry->timerId == TimerWheel::InvalidTimerId)
+		entry->timerId = m_Timers.addTimer(expiry, (uint64_t)(size_t)entry);
+	else if (m_Timers.getExpiryTick(entry->timerId) != expiry)
+		m_Timers.rescheduleTimer(entry->timerId, expiry);
+}
+
+void GtpSessionTable::expireLocked()
+{
+	m_Timers.advance((uint64_t)m_CurrentTime);
+
+	uint64_t userValue;
+	while (m_Timers.popExpired(userValue))
+	{
+		SessionEntry* entry = (SessionEntry*)(size_t)userValue;
+
+		// the timer was already removed from the wheel
+		entry->timerId = TimerWheel::InvalidTimerId;
+
+		// GTP-U packets only update the activity time, so the timer is moved forward lazily when it expires
+		uint64_t expiry = (uint64_t)atomicLoadRelaxed(&entry->session.lastActivityTime) + m_Config.sessionTimeout;
+		if (expiry > (uint64_t)m_CurrentTime)
+		{
+			entry->timerId = m_Timers.addTimer(expiry, userValue);
+			continue;
+		}
+
+		removeSession(entry, GtpSessionTimedOut);
+	}
+
+	time_t requestExpiry = m_CurrentTime - (time_t)m_Config.requestTimeout;
+	while (!m_PendingOrder.empty() && m_PendingOrder.front().first < requestExpiry)
+	{
+		// the request may have been answered or retransmitted since
+		std::map<PendingKey, PendingRequest>::iterator iter = m_PendingRequests.find(m_PendingOrder.front().second);
+		if (iter != m_PendingRequests.end() && iter->second.time < requestExpiry)
+			m_PendingRequests.erase(iter);
+		m_PendingOrder.pop_front();
+	}
+}
+
+void GtpSessionTable::getAllSessions(std::vector<GtpSession>& sessions)
+{
+	pthread_mutex_lock(&m_Mutex);
+
+	// each session is reached through its first tunnel
+	for (size_t i = 0; i <= m_BucketMask; i++)
+	{
+		for (const TunnelNode* tunnel = m_Buckets[i]; tunnel != NULL; tunnel = tunnel->next)
+		{
+			for (int j = 0; j < NumOfTunnels; j++)
+			{
+				if (tunnel->entry->tunnels[j] == NULL)
+					continue;
+				if (tunnel->entry->tunnels[j] == tunnel)
+					sessions.push_back(tunnel->entry->session);
+				break;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+void GtpSessionTable::setCurrentTime(time_t currentTime)
+{
+	pthread_mutex_lock(&m_Mutex);
+
+	// time only moves forward, and the timers have a resolution of a second
+	if (currentTime > m_CurrentTime)
+	{
+		m_CurrentTime = currentTime;
+		expireLocked();
+	}
+
+	reclaimLocked();
+
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+int GtpSessionTable::registerReader()
+{
+	pthread_mutex_lock(&m_Mutex);
+	int readerId = m_Reclaimer.registerReader();
+	pthread_mutex_unlock(&m_Mutex);
+
+	if (readerId < 0)
+		LOG_ERROR("Cannot register reader: %d readers are already registered", PCPP_QUIESCENT_STATE_MAX_READERS);
+
+	return readerId;
+}
+
+void GtpSessionTable::unregisterReader(int readerId)
+{
+	pthread_mutex_lock(&m_Mutex);
+	m_Reclaimer.unregisterReader(readerId);
+	reclaimLocked();
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+void GtpSessionTable::quiescentState(int readerId)
+{
+	m_Reclaimer.quiescentState(readerId);
+}
+
+size_t GtpSessionTable::reclaim()
+{
+	pthread_mutex_lock(&m_Mutex);
+	size_t numOfRemaining = reclaimLocked();
+	pthread_mutex_unlock(&m_Mutex);
+	return numOfRemaining;
+}
+
+void GtpSessionTable::RecycleRetiredItem::operator()(const RetiredItem& retired) const
+{
+	if (retired.entry != NULL)
+	{
+		retired.entry->nextFree = table->m_FreeEntries;
+		table->m_FreeEntries = retired.entry;
+		table->m_NumOfRetiredSessions--;
+	}
+	else
+	{
+		table->m_FreeTunnels.push_back(retired.tunnel);
+	}
+}
+
+size_t GtpSessionTable::reclaimLocked()
+{
+	m_Reclaimer.reclaim(RecycleRetiredItem(this));
+	return m_NumOfRetiredSessions;
+}
+
+size_t GtpSessionTable::getNumOfSessions()
+{
+	pthread_mutex_lock(&m_Mutex);
+	size_t result = m_NumOfSessions;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+size_t GtpSessionTable::getNumOfPendingRequests()
+{
+	pthread_mutex_lock(&m_Mutex);
+	size_t result = m_PendingRequests.size();
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+uint64_t GtpSessionTable::getNumOfRejectedSessions()
+{
+	pthread_mutex_lock(&m_Mutex);
+	uint64_t result = m_NumOfRejectedSessions;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+} // namespace pcpp
@@ -0,0 +1,199 @@
+#include "HeavyHitterBypass.h"
+#include "PacketView.h"
+#include <string.h>
+
+#define TCP_FLAG_FIN 0x01
+#define TCP_FLAG_RST 0x04
+
+namespace pcpp
+{
+
+HeavyHitterBypass::HeavyHitterBypass(const HeavyHitterBypassConfiguration& config, OnHeavyHitterPromoted onPromoted, OnBypassEnded onBypassEnded,
+		void* userCookie) :
+	m_Config(config), m_OnPromoted(onPromoted), m_OnBypassEnded(onBypassEnded), m_UserCookie(userCookie),
+	m_Sketch(config.sketchWidth, config.sketchDepth),
+	m_BypassTable(FlowTableConfiguration(config.maxBypassedFlows, config.idleTimeout, EvictLeastRecentlyUsed), onFlowRemoved, this),
+	m_WindowStart(0)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+void HeavyHitterBypass::getKey(const FlowTuple& tuple, FlowTuple& key)
+{
+	key = tuple;
+
+	int cmp = memcmp(tuple.srcIP, tuple.dstIP, sizeof(tuple.srcIP));
+	if (cmp < 0 || (cmp == 0 && tuple.srcPort <= tuple.dstPort))
+		return;
+
+	memcpy(key.srcIP, tuple.dstIP, sizeof(tuple.dstIP));
+	memcpy(key.dstIP, tuple.srcIP, sizeof(tuple.srcIP));
+	key.srcPort = tuple.dstPort;
+	key.dstPort = tuple.srcPort;
+}
+
+bool HeavyHitterBypass::process(const RawPacket* rawPacket)
+{
+	timespec ts = rawPacket->getPacketTimeStampNs();
+	return process(rawPacket->getRawData(), (size_t)rawPacket->getRawDataLen(), rawPacket->getLinkLayerType(), (uint64_t)ts.tv_sec,
+			(size_t)rawPacket->getFrameLength());
+}
+
+bool HeavyHitterBypass::process(const uint8_t* data, size_t dataLen, LinkLayerType linkType, uint64_t timestampSec, size_t packetLength)
+{
+	m_Stats.packets++;
+	advanceTime(timestampSec);
+
+	if (packetLength == 0)
+		packetLength = dataLen;
+
+	// fragments are left to IPReassembly: only the first one has the ports, so they can't be matched with their flow
+	PacketView view;
+	FlowTuple tuple;
+	if (!FlowKeyExtractor::extract(data, dataLen, linkType, view) || view.isFragment || !FlowHash::getTuple(view, tuple))
+	{
+		m_Stats.nonFlowPackets++;
+		return false;
+	}
+
+	bool isTcpClose = (m_Config.endOnTcpClose && view.isPacketOfType(TCP) && (view.tcpFlags & (TCP_FLAG_FIN | TCP_FLAG_RST)) != 0);
+
+	FlowTuple key;
+	getKey(tuple, key);
+	BypassedFlow* flow = m_BypassTable.find(key);
+	if (flow != NULL)
+	{
+		flow->packets++;
+		flow->bytes += packetLength;
+		m_Stats.bypassedPackets++;
+		m_Stats.bypassedBytes += packetLength;
+		if (isTcpClose)
+		{
+			// the sketch still holds the bytes of the connection, so it would be promoted again by its last packets
+			m_HeldBackFlows[hashInteger(FlowHash::hashSymmetric(tuple))] = true;
+			endBypass(key, BypassEndedByTcpClose);
+		}
+		return true;
+	}
+
+	uint64_t hash = hashInteger(FlowHash::hashSymmetric(tuple));
+	m_Sketch.add(hash, packetLength);
+	uint64_t estimatedBytes = m_Sketch.estimate(hash);
+	if (estimatedBytes < m_Config.thresholdBytes || isTcpClose || m_HeldBackFlows.find(hash) != NULL)
+		return false;
+
+	BypassedFlow newFlow;
+	newFlow.bypassTime = m_BypassTable.getCurrentTime();
+	newFlow.estimatedBytes = estimatedBytes;
+	if (m_OnPromoted != NULL && !m_OnPromoted(tuple, newFlow, m_UserCookie))
+	{
+		// don't ask again for every packet of the flow until the window ends
+		m_HeldBackFlows[hash] = true;
+		m_Stats.refusedPromotions++;
+		return false;
+	}
+
+	m_BypassTable.get(key) = newFlow;
+	m_Stats.promotions++;
+	return false;
+}
+
+int HeavyHitterBypass::filterBurst(RawPacket** packets, int numOfPackets)
+{
+	int numOfInspected = 0;
+	for (int i = 0; i < numOfPackets; i++)
+	{
+		if (process(packets[i]))
+			continue;
+
+		RawPacket* packet = packets[i];
+		packets[i] = packets[numOfInspected];
+		packets[numOfInspected] = packet;
+		numOfInspected++;
+	}
+
+	return numOfInspected;
+}
+
+bool HeavyHitterBypass::addBypass(const FlowTuple& tuple, int offloadRuleId)
+{
+	FlowTuple key;
+	getKey(tuple, key);
+
+	bool isNew;
+	BypassedFlow& flow = m_BypassTable.get(key, &isNew);
+	if (!isNew)
+		return false;
+
+	flow.bypassTime = m_BypassTable.getCurrentTime();
+	flow.offloadRuleId = offloadRuleId;
+	m_Stats.promotions++;
+	return true;
+}
+
+bool HeavyHitterBypass::removeBypass(const FlowTuple& tuple)
+{
+	FlowTuple key;
+	getKey(tuple, key);
+	return endBypass(key, BypassEndedByUser);
+}
+
+const BypassedFlow* HeavyHitterBypass::getBypassedFlow(const FlowTuple& tuple) const
+{
+	FlowTuple key;
+	getKey(tuple, key);
+	return m_BypassTable.peek(key);
+}
+
+void HeavyHitterBypass::advanceTime(uint64_t currentTimeSec)
+{
+	m_BypassTable.advanceTime(currentTimeSec);
+
+	if (currentTimeSec >= m_WindowStart + m_Config.windowSeconds && currentTimeSec > m_WindowStart)
+	{
+		m_Sketch.clear();
+		m_HeldBackFlows.clear();
+		m_WindowStart = currentTimeSec;
+	}
+}
+
+void HeavyHitterBypass::clear()
+{
+	std::vector<std::pair<FlowTuple, BypassedFlow> > flows;
+	m_BypassTable.getEntries(flows);
+	m_BypassTable.clear();
+	m_Sketch.clear();
+	m_HeldBackFlows.clear();
+
+	m_Stats.bypassEnds += flows.size();
+	if (m_OnBypassEnded == NULL)
+		return;
+
+	for (size_t i = 0; i < flows.size(); i++)
+		m_OnBypassEnded(flows[i].first, flows[i].second, BypassEndedByUser, m_UserCookie);
+}
+
+bool HeavyHitterBypass::endBypass(const FlowTuple& key, BypassEndReason reason)
+{
+	const BypassedFlow* flow = m_BypassTable.peek(key);
+	if (flow == NULL)
+		return false;
+
+	// the flow is erased before the callback, so the callback may bypass it again
+	BypassedFlow endedFlow = *flow;
+	m_BypassTable.erase(key);
+	m_Stats.bypassEnds++;
+	if (m_OnBypassEnded != NULL)
+		m_OnBypassEnded(key, endedFlow, reason, m_UserCookie);
+	return true;
+}
+
+void HeavyHitterBypass::onFlowRemoved(const FlowTuple& key, BypassedFlow& flow, FlowRemovalReason reason, void* userCookie)
+{
+	HeavyHitterBypass* bypass = (HeavyHitterBypass*)userCookie;
+	bypass->m_Stats.bypassEnds++;
+	if (bypass->m_OnBypassEnded != NULL)
+		bypass->m_OnBypassEnded(key, flow, (reason == FlowRemovedByIdleTimeout ? BypassEndedByIdleTimeout : BypassEndedByEviction), bypass->m_UserCookie);
+}
+
+} // namespace pcpp
@@ -1,6 +1,7 @@
 #define LOG_MODULE PacketLogModuleHttpLayer
 
 #include "Logger.h"
+#include "GeneralUtils.h"
 #include "HttpLayer.h"
 #include <string.h>
 #include <algorithm>
@@ -18,8 +19,6 @@ static std::map<uint16_t, bool> createHTTPPortMap()
 	return result;
 }
 
-static const std::map<uint16_t, bool> HTTPPortMap = createHTTPPortMap();
-
 
 
 
@@ -27,7 +26,9 @@ static const std::map<uint16_t, bool> HTTPPortMap = createHTTPPortMap();
 
 const std::map<uint16_t, bool>* HttpMessage::getHTTPPortMap()
 {
-	return &HTTPPortMap;
+	// built on first use rather than at startup
+	static const std::map<uint16_t, bool> portMap = createHTTPPortMap();
+	return &portMap;
 }
 
 
@@ -352,8 +353,12 @@ HttpRequestLayer::HttpMethod HttpRequestFirstLine::parseMethod(char* data, size_
 
 void HttpRequestFirstLine::parseVersion()
 {
-	char* data = (char*)(m_HttpRequest->m_Data + m_UriOffset);
-	char* verPos = strstr(data, " HTTP/");
+	// the message isn't null-terminated, so the search is bounded by its length
+	size_t searchOffset = (m_UriOffset > 0 ? (size_t)m_UriOffset : 0);
+	if (searchOffset > m_HttpRequest->getDataLen())
+		searchOffset = m_HttpRequest->getDataLen();
+	char* data = (char*)(m_HttpRequest->m_Data + searchOffset);
+	char* verPos = (char*)findSubstring(data, m_HttpRequest->getDataLen() - searchOffset, " HTTP/", 6);
 	if (verPos == NULL)
 	{
 		m_Version = HttpVersionUnknown;
@@ -503,7 +508,8 @@ void HttpRequestFirstLine::setVersion(HttpVersion newVersion)
 
 
 
-const std::string StatusCodeEnumToString[80] = {
+// string literals rather than std::strings, many of which would allocate memory at startup
+const char* const StatusCodeEnumToString[80] = {
 		"Continue",
 		"Switching Protocols",
 		"Processing",
@@ -730,9 +736,8 @@ HeaderField* HttpResponseLayer::setContentLength(int contentLength, const std::s
 
 int HttpResponseLayer::getContentLength()
 {
-	std::string contentLengthFieldName(PCPP_HTTP_CONTENT_LENGTH_FIELD);
-	std::transform(contentLengthFieldName.begin(), contentLengthFieldName.end(), contentLengthFieldName.begin(), ::tolower);
-	HeaderField* contentLengthField = getFieldByName(contentLengthFieldName);
+	// field names are matched case-insensitively
+	HeaderField* contentLengthField = getFieldByName(PCPP_HTTP_CONTENT_LENGTH_FIELD);
 	if (contentLengthField != NULL)
 		return atoi(contentLengthField->getFieldValue().c_str());
 	return 0;
@@ -0,0 +1,560 @@
+#define LOG_MODULE PacketLogModuleHttpStreamParser
+
+#include "HttpStreamParser.h"
+#include "Logger.h"
+#include <string.h>
+
+namespace pcpp
+{
+
+// ASCII lower-casing, which doesn't depend on the locale
+static inline char toLowerAscii(char c)
+{
+	return (c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+}
+
+static inline bool isWhiteSpace(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+// parses "HTTP/x.y"
+static HttpVersion parseHttpVersion(const char* data, size_t dataLen)
+{
+	if (dataLen != 8 || memcmp(data, "HTTP/", 5) != 0 || data[6] != '.')
+		return HttpVersionUnknown;
+
+	if (data[5] == '1' && data[7] == '1')
+		return OneDotOne;
+	if (data[5] == '1' && data[7] == '0')
+		return OneDotZero;
+	if (data[5] == '0' && data[7] == '9')
+		return ZeroDotNine;
+
+	return HttpVersionUnknown;
+}
+
+bool HttpStreamSlice::equalsIgnoreCase(const char* str) const
+{
+	size_t strLen = strlen(str);
+	if (strLen != length)
+		return false;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		if (toLowerAscii(data[i]) != toLowerAscii(str[i]))
+			return false;
+	}
+
+	return true;
+}
+
+
+// -------- Class HttpStreamParser -----------------
+
+HttpStreamParser::HttpStreamParser(OnHttpStreamEvent onEvent, void* userCookie, const HttpStreamParserConfiguration& config) :
+	m_OnEvent(onEvent), m_UserCookie(userCookie), m_Config(config), m_LastConnection(NULL), m_LastFlowKey(0)
+{
+}
+
+HttpStreamParser::~HttpStreamParser()
+{
+	clear();
+}
+
+void HttpStreamParser::clear()
+{
+	for (std::map<uint32_t, ConnectionState*>::iterator iter = m_Connections.begin(); iter != m_Connections.end(); ++iter)
+		delete iter->second;
+
+	m_Connections.clear();
+	m_LastConnection = NULL;
+}
+
+HttpStreamParser::ConnectionState* HttpStreamParser::getConnection(uint32_t flowKey)
+{
+	if (m_LastConnection != NULL && m_LastFlowKey == flowKey)
+		return m_LastConnection;
+
+	ConnectionState*& conn = m_Connections[flowKey];
+	if (conn == NULL)
+	{
+		conn = new ConnectionState();
+		for (int side = 0; side < 2; side++)
+		{
+			SideState& sideState = conn->sides[side];
+			sideState.state = ParseStartLine;
+			sideState.role = RoleUnknown;
+			sideState.bodyRemaining = 0;
+			sideState.numOfMessages = 0;
+			sideState.message = HttpStreamEvent();
+			sideState.message.side = side;
+		}
+
+		conn->pendingHead = 0;
+		conn->numOfPendingMethods = 0;
+	}
+
+	m_LastConnection = conn;
+	m_LastFlowKey = flowKey;
+	return conn;
+}
+
+void HttpStreamParser::parse(int side, const TcpStreamData& tcpData)
+{
+	parse(side, tcpData.getData(), tcpData.getDataLength(), tcpData.getConnectionDataRef());
+}
+
+void HttpStreamParser::parse(int side, const uint8_t* data, size_t dataLen, const ConnectionData& connectionData)
+{
+	if (side != 0 && side != 1)
+	{
+		LOG_ERROR("Side must be 0 or 1");
+		return;
+	}
+
+	parseSide(getConnection(connectionData.flowKey), side, data, dataLen, &connectionData);
+}
+
+void HttpStreamParser::connectionEnded(const ConnectionData& connectionData)
+{
+	std::map<uint32_t, ConnectionState*>::iterator iter = m_Connections.find(connectionData.flowKey);
+	if (iter == m_Connections.end())
+		return;
+
+	ConnectionState* conn = iter->second;
+	for (int side = 0; side < 2; side++)
+	{
+		SideState& sideState = conn->sides[side];
+		sideState.message.connectionData = &connectionData;
+		if (sideState.state == ParseBodyUntilClose)
+			messageComplete(sideState);
+		else if ((sideState.state == ParseStartLine && !sideState.lineBuffer.empty()) ||
+				(sideState.state != ParseStartLine && sideState.state != ParseTunnel && sideState.state != ParseError))
+			parseError(sideState, "Connection ended in the middle of a message");
+	}
+
+	if (m_LastConnection == conn)
+		m_LastConnection = NULL;
+
+	delete conn;
+	m_Connections.erase(iter);
+}
+
+void HttpStreamParser::parseSide(ConnectionState* conn, int side, const uint8_t* data, size_t dataLen, const ConnectionData* connectionData)
+{
+	SideState& sideState = conn->sides[side];
+	sideState.message.connectionData = connectionData;
+
+	while (dataLen > 0)
+	{
+		switch (sideState.state)
+		{
+		case ParseTunnel:
+		case ParseError:
+			return;
+
+		case ParseBodyUntilClose:
+		case ParseBody:
+		case ParseChunkData:
+		{
+			size_t bodyLen = dataLen;
+			if (sideState.state != ParseBodyUntilClose && sideState.bodyRemaining < bodyLen)
+				bodyLen = (size_t)sideState.bodyRemaining;
+
+			sideState.message.bodyLength += bodyLen;
+			if (m_Config.reportBodyData)
+			{
+				sideState.message.bodyData = HttpStreamSlice((const char*)data, bodyLen);
+				reportEvent(sideState, HttpStreamBodyData);
+			}
+
+			data += bodyLen;
+			dataLen -= bodyLen;
+			if (sideState.state == ParseBodyUntilClose)
+				break;
+
+			sideState.bodyRemaining -= bodyLen;
+			if (sideState.bodyRemaining == 0)
+			{
+				if (sideState.state == ParseBody)
+					messageComplete(sideState);
+				else
+					sideState.state = ParseChunkDataEnd;
+			}
+			break;
+		}
+
+		default:
+		{
+			HttpStreamSlice line;
+			if (!readLine(sideState, data, dataLen, line))
+				return;
+
+			handleLine(conn, side, line);
+			sideState.lineBuffer.clear();
+			break;
+		}
+		}
+	}
+}
+
+bool HttpStreamParser::readLine(SideState& sideState, const uint8_t*& data, size_t& dataLen, HttpStreamSlice& line)
+{
+	const uint8_t* lineEnd = (const uint8_t*)memchr(data, '\n', dataLen);
+	size_t lineLen = (lineEnd != NULL ? (size_t)(lineEnd - data) : dataLen);
+
+	if (sideState.lineBuffer.length() + lineLen > m_Config.maxLineLength)
+	{
+		parseError(sideState, "Line is too long");
+		return false;
+	}
+
+	if (lineEnd == NULL)
+	{
+		// keep the beginning of the line until the rest of it arrives
+		sideState.lineBuffer.append((const char*)data, dataLen);
+		data += dataLen;
+		dataLen = 0;
+		return false;
+	}
+
+	if (sideState.lineBuffer.empty())
+		line = HttpStreamSlice((const char*)data, lineLen);
+	else
+	{
+		sideState.lineBuffer.append((const char*)data, lineLen);
+		line = HttpStreamSlice(sideState.lineBuffer.data(), sideState.lineBuffer.length());
+	}
+
+	data += lineLen + 1;
+	dataLen -= lineLen + 1;
+
+	if (line.length > 0 && line.data[line.length - 1] == '\r')
+		line.length--;
+
+	return true;
+}
+
+void HttpStreamParser::handleLine(ConnectionState* conn, int side, const HttpStreamSlice& line)
+{
+	SideState& sideState = conn->sides[side];
+
+	switch (sideState.state)
+	{
+	case ParseStartLine:
+		// empty lines before a message are allowed
+		if (line.length > 0 && parseStartLine(conn, side, line))
+			sideState.state = ParseHeaders;
+		break;
+
+	case ParseHeaders:
+		if (line.length == 0)
+			headersComplete(conn, side);
+		else
+			parseHeaderField(sideState, line, false);
+		break;
+
+	case ParseTrailers:
+		if (line.length == 0)
+			messageComplete(sideState);
+		else
+			parseHeaderField(sideState, line, true);
+		break;
+
+	case ParseChunkSize:
+	{
+		uint64_t chunkSize = 0;
+		size_t numOfDigits = 0;
+		for (; numOfDigits < line.length; numOfDigits++)
+		{
+			char c = toLowerAscii(line.data[numOfDigits]);
+			int digit;
+			if (c >= '0' && c <= '9')
+				digit = c - '0';
+			else if (c >= 'a' && c <= 'f')
+				digit = c - 'a' + 10;
+			else
+				break;
+
+			// more than 15 hex digits may overflow the size
+			if (numOfDigits == 15)
+			{
+				parseError(sideState, "Chunk size is too large");
+				return;
+			}
+
+			chunkSize = (chunkSize << 4) | digit;
+		}
+
+		// the size may be followed by chunk extensions
+		if (numOfDigits == 0 || (numOfDigits < line.length && line.data[numOfDigits] != ';' && !isWhiteSpace(line.data[numOfDigits])))
+		{
+			parseError(sideState, "Invalid chunk size");
+			return;
+		}
+
+		if (chunkSize == 0)
+			sideState.state = ParseTrailers;
+		else
+		{
+			sideState.bodyRemaining = chunkSize;
+			sideState.state = ParseChunkData;
+		}
+		break;
+	}
+
+	case ParseChunkDataEnd:
+		if (line.length != 0)
+		{
+			parseError(sideState, "Chunk data isn't followed by a line end");
+			return;
+		}
+
+		sideState.state = ParseChunkSize;
+		break;
+
+	default:
+		break;
+	}
+}
+
+bool HttpStreamParser::parseStartLine(ConnectionState* conn, int side, const HttpStreamSlice& line)
+{
+	SideState& sideState = conn->sides[side];
+	HttpStreamEvent& message = sideState.message;
+
+	bool isResponse = (line.length >= 5 && memcmp(line.data, "HTTP/", 5) == 0);
+	if ((isResponse && sideState.role == RoleRequests) || (!isResponse && sideState.role == RoleResponses))
+	{
+		parseError(sideState, "Requests and responses are sent from the same side");
+		return false;
+	}
+
+	message.messageIndex = sideState.numOfMessages;
+	message.isRequest = !isResponse;
+	message.contentLength = -1;
+	message.isChunked = false;
+	message.bodyLength = 0;
+
+	if (isResponse)
+	{
+		// HTTP-version SP status-code SP [reason-phrase]
+		if (line.length < 12 || line.data[8] != ' ' || (line.length > 12 && line.data[12] != ' '))
+		{
+			parseError(sideState, "Invalid status line");
+			return false;
+		}
+
+		message.version = parseHttpVersion(line.data, 8);
+		message.statusCode = 0;
+		for (int i = 9; i < 12; i++)
+		{
+			if (line.data[i] < '0' || line.data[i] > '9')
+			{
+				parseError(sideState, "Invalid status code");
+				return false;
+			}
+
+			message.statusCode = message.statusCode * 10 + (line.data[i] - '0');
+		}
+
+		// interim responses precede the final response of the same request
+		message.method = HttpRequestLayer::HttpMethodUnknown;
+		if (conn->numOfPendingMethods > 0)
+		{
+			message.method = conn->pendingMethods[conn->pendingHead];
+			if (message.statusCode >= 200 || message.statusCode == 101)
+			{
+				conn->pendingHead = (conn->pendingHead + 1) % MaxPendingRequests;
+				conn->numOfPendingMethods--;
+			}
+		}
+
+		sideState.role = RoleResponses;
+		if (line.length > 13)
+			message.reasonPhrase = HttpStreamSlice(line.data + 13, line.length - 13);
+		reportEvent(sideState, HttpStreamStatusLine);
+	}
+	else
+	{
+		// method SP request-target SP HTTP-version
+		message.method = HttpRequestFirstLine::parseMethod((char*)line.data, line.length);
+		const char* uriStart = (const char*)memchr(line.data, ' ', line.length);
+		const char* uriEnd = NULL;
+		for (const char* curPos = line.data + line.length - 1; curPos > uriStart; curPos--)
+		{
+			if (*curPos == ' ')
+			{
+				uriEnd = curPos;
+				break;
+			}
+		}
+
+		if (message.method == HttpRequestLayer::HttpMethodUnknown || uriEnd == NULL)
+		{
+			parseError(sideState, "Invalid request line");
+			return false;
+		}
+
+		message.version = parseHttpVersion(uriEnd + 1, line.data + line.length - (uriEnd + 1));
+		message.statusCode = 0;
+
+		// requests beyond the limit are answered with an unknown method
+		if (conn->numOfPendingMethods < MaxPendingRequests)
+		{
+			conn->pendingMethods[(conn->pendingHead + conn->numOfPendingMethods) % MaxPendingRequests] = message.method;
+			conn->numOfPendingMethods++;
+		}
+
+		sideState.role = RoleRequests;
+		message.uri = HttpStreamSlice(uriStart + 1, uriEnd - (uriStart + 1));
+		reportEvent(sideState, HttpStreamRequestLine);
+	}
+
+	return true;
+}
+
+bool HttpStreamParser::parseHeaderField(SideState& sideState, const HttpStreamSlice& line, bool isTrailer)
+{
+	// obsolete line folding isn't supported, folded lines are ignored
+	if (isWhiteSpace(line.data[0]))
+		return true;
+
+	const char* separator = (const char*)memchr(line.data, ':', line.length);
+	if (separator == NULL || separator == line.data)
+	{
+		parseError(sideState, "Invalid header field");
+		return false;
+	}
+
+	HttpStreamSlice name(line.data, separator - line.data);
+	const char* valueStart = separator + 1;
+	const char* valueEnd = line.data + line.length;
+	while (valueStart < valueEnd && isWhiteSpace(*valueStart))
+		valueStart++;
+	while (valueEnd > valueStart && isWhiteSpace(*(valueEnd - 1)))
+		valueEnd--;
+	HttpStreamSlice value(valueStart, valueEnd - valueStart);
+
+	HttpStreamEvent& message = sideState.message;
+	if (!isTrailer)
+	{
+		if (name.equalsIgnoreCase("content-length"))
+		{
+			int64_t contentLength = 0;
+			for (size_t i = 0; i < value.length; i++)
+			{
+				if (value.data[i] < '0' || value.data[i] > '9' || i == 18)
+				{
+					parseError(sideState, "Invalid Content-Length");
+					return false;
+				}
+
+				contentLength = contentLength * 10 + (value.data[i] - '0');
+			}
+
+			if (value.length == 0 || (message.contentLength != -1 && message.contentLength != contentLength))
+			{
+				parseError(sideState, "Invalid Content-Length");
+				return false;
+			}
+
+			message.contentLength = contentLength;
+		}
+		else if (name.equalsIgnoreCase("transfer-encoding"))
+		{
+			// the body is chunked if chunked is the last coding applied
+			message.isChunked = (value.length >= 7 && HttpStreamSlice(value.data + value.length - 7, 7).equalsIgnoreCase("chunked") &&
+					(value.length == 7 || value.data[value.length - 8] == ',' || isWhiteSpace(value.data[value.length - 8])));
+		}
+	}
+
+	message.fieldName = name;
+	message.fieldValue = value;
+	message.isTrailer = isTrailer;
+	reportEvent(sideState, HttpStreamHeaderField);
+	return true;
+}
+
+void HttpStreamParser::headersComplete(ConnectionState* conn, int side)
+{
+	SideState& sideState = conn->sides[side];
+	HttpStreamEvent& message = sideState.message;
+
+	// Transfer-Encoding overrides Content-Length
+	if (message.isChunked)
+		message.contentLength = -1;
+
+	reportEvent(sideState, HttpStreamHeadersComplete);
+
+	if (message.isRequest)
+	{
+		if (message.isChunked)
+			sideState.state = ParseChunkSize;
+		else if (message.contentLength > 0)
+		{
+			sideState.bodyRemaining = (uint64_t)message.contentLength;
+			sideState.state = ParseBody;
+		}
+		else
+			messageComplete(sideState);
+
+		return;
+	}
+
+	int statusCode = message.statusCode;
+	if (statusCode == 101 || (message.method == HttpRequestLayer::HttpCONNECT && statusCode >= 200 && statusCode < 300))
+	{
+		// the connection isn't HTTP anymore
+		messageComplete(sideState);
+		conn->sides[0].state = ParseTunnel;
+		conn->sides[1].state = ParseTunnel;
+	}
+	else if (message.method == HttpRequestLayer::HttpHEAD || statusCode < 200 || statusCode == 204 || statusCode == 304)
+		messageComplete(sideState);
+	else if (message.isChunked)
+		sideState.state = ParseChunkSize;
+	else if (message.contentLength == 0)
+		messageComplete(sideState);
+	else if (message.contentLength > 0)
+	{
+		sideState.bodyRemaining = (uint64_t)message.contentLength;
+		sideState.state = ParseBody;
+	}
+	else
+		sideState.state = ParseBodyUntilClose;
+}
+
+void HttpStreamParser::messageComplete(SideState& sideState)
+{
+	reportEvent(sideState, HttpStreamMessageComplete);
+	sideState.numOfMessages++;
+	sideState.state = ParseStartLine;
+}
+
+void HttpStreamParser::parseError(SideState& sideState, const char* reason)
+{
+	LOG_DEBUG("Parse error on side %d: %s", sideState.message.side, reason);
+	sideState.state = ParseError;
+	sideState.lineBuffer.clear();
+	reportEvent(sideState, HttpStreamParseError);
+}
+
+void HttpStreamParser::reportEvent(SideState& sideState, HttpStreamEventType type)
+{
+	HttpStreamEvent& event = sideState.message;
+	event.type = type;
+	if (m_OnEvent != NULL)
+		m_OnEvent(event, m_UserCookie);
+
+	// the slices belong only to this event
+	event.uri = HttpStreamSlice();
+	event.reasonPhrase = HttpStreamSlice();
+	event.fieldName = HttpStreamSlice();
+	event.fieldValue = HttpStreamSlice();
+	event.bodyData = HttpStreamSlice();
+	event.isTrailer = false;
+}
+
+} // namespace pcpp
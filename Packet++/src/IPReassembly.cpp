@@ -6,6 +6,7 @@
 #include "IpUtils.h"
 #include "Logger.h"
 #include <string.h>
+#include <stddef.h>
 #if defined(WIN32) || defined(WINx64)
 #include <winsock2.h>
 #elif LINUX
@@ -57,8 +58,9 @@ public:
 	virtual uint16_t getFragmentOffset() = 0;
 	virtual uint32_t getFragmentId() = 0;
 	virtual uint32_t hashPacket() = 0;
-	virtual IPReassembly::PacketKey* createPacketKey() = 0;
+	virtual IPReassembly::PacketKey* setPacketKey(IPReassembly::IPv4PacketKey& ipv4Key, IPReassembly::IPv6PacketKey& ipv6Key) = 0;
 
+	virtual uint8_t* getIPHeader() = 0;
 	virtual uint8_t* getIPLayerPayload() = 0;
 	virtual size_t getIPLayerPayloadSize() = 0;
 
@@ -118,9 +120,15 @@ public:
 		return pcpp::fnv_hash(vec, 3);
 	}
 
-	IPReassembly::PacketKey* createPacketKey()
+	IPReassembly::PacketKey* setPacketKey(IPReassembly::IPv4PacketKey& ipv4Key, IPReassembly::IPv6PacketKey& /* ipv6Key */)
 	{
-		return new IPReassembly::IPv4PacketKey(ntohs(m_IPLayer->getIPv4Header()->ipId), m_IPLayer->getSrcIpAddress(), m_IPLayer->getDstIpAddress());
+		ipv4Key = IPReassembly::IPv4PacketKey(ntohs(m_IPLayer->getIPv4Header()->ipId), m_IPLayer->getSrcIpAddressValue(), m_IPLayer->getDstIpAddressValue());
+		return &ipv4Key;
+	}
+
+	uint8_t* getIPHeader()
+	{
+		return m_IPLayer->getData();
 	}
 
 	uint8_t* getIPLayerPayload()
@@ -144,8 +152,9 @@ public:
 	IPv6FragmentWrapper(Packet* fragment)
 	{
 		m_IPLayer = fragment->isPacketOfType(IPv6) ? fragment->getLayerOfType<IPv6Layer>() : NULL;
+		// the fragmentation header is read from the layer data, so no extension objects are created
 		if (m_IPLayer != NULL)
-			m_FragHeader = m_IPLayer->getExtensionOfType<IPv6FragmentationHeader>();
+			m_FragHeader = m_IPLayer->getFragmentationHeader();
 		else
 			m_FragHeader = NULL;
 	}
@@ -160,15 +169,16 @@ public:
 	bool isFirstFragment()
 	{
 		if (isFragment())
-			return m_FragHeader->isFirstFragment();
+			return getFragmentOffset() == 0;
 
 		return false;
 	}
 
 	bool isLastFragment()
 	{
+		// the "more fragments" bit is the lowest bit of the offset and flags field
 		if (isFragment())
-			return m_FragHeader->isLastFragment();
+			return (ntohs(m_FragHeader->fragOffsetAndFlags) & 0x0001) == 0;
 
 		return false;
 	}
@@ -177,14 +187,14 @@ public:
 	uint16_t getFragmentOffset()
 	{
 		if (isFragment())
-			return m_FragHeader->getFragmentOffset();
+			return ntohs(m_FragHeader->fragOffsetAndFlags) & 0xfff8;
 
 		return 0;
 	}
 
 	uint32_t getFragmentId()
 	{
-		return ntohl(m_FragHeader->getFragHeader()->id);
+		return ntohl(m_FragHeader->id);
 	}
 
 	uint32_t hashPacket()
@@ -198,15 +208,21 @@ public:
 		vec[0].len = 16;
 		vec[1].buffer = m_IPLayer->getIPv6Header()->ipDst;
 		vec[1].len = 16;
-		vec[2].buffer = (uint8_t*)&m_FragHeader->getFragHeader()->id;
+		vec[2].buffer = (uint8_t*)&m_FragHeader->id;
 		vec[2].len = 4;
 
 		return pcpp::fnv_hash(vec, 3);
 	}
 
-	IPReassembly::PacketKey* createPacketKey()
+	IPReassembly::PacketKey* setPacketKey(IPReassembly::IPv4PacketKey& /* ipv4Key */, IPReassembly::IPv6PacketKey& ipv6Key)
 	{
-		return new IPReassembly::IPv6PacketKey(ntohl(m_FragHeader->getFragHeader()->id), m_IPLayer->getSrcIpAddress(), m_IPLayer->getDstIpAddress());
+		ipv6Key = IPReassembly::IPv6PacketKey(ntohl(m_FragHeader->id), m_IPLayer->getSrcIpAddressValue(), m_IPLayer->getDstIpAddressValue());
+		return &ipv6Key;
+	}
+
+	uint8_t* getIPHeader()
+	{
+		return m_IPLayer->getData();
 	}
 
 	uint8_t* getIPLayerPayload()
@@ -221,7 +237,161 @@ public:
 
 private:
 	IPv6Layer* m_IPLayer;
-	IPv6FragmentationHeader* m_FragHeader;
+	IPv6FragmentationHeader::ipv6_frag_header* m_FragHeader;
+
+};
+
+// reads an IPv4 or IPv6 fragment directly from its raw data at the offsets FlowKeyExtractor found, with the same results as the layer wrappers
+class RawFragmentWrapper : public IPFragmentWrapper
+{
+public:
+	RawFragmentWrapper(RawPacket* fragment, const PacketView& view)
+	{
+		m_IPHeader = NULL;
+		m_Payload = NULL;
+		m_PayloadLen = 0;
+		m_FragIdPtr = NULL;
+		m_IsFragment = false;
+		m_MoreFragments = false;
+		m_FragmentOffset = 0;
+		m_FragmentId = 0;
+		m_IPVersion = view.ipVersion;
+
+		if (!view.isFragment || view.networkOffset == PacketView::NoOffset)
+			return;
+
+		uint8_t* data = (uint8_t*)fragment->getRawData();
+		size_t capturedLen = (size_t)fragment->getRawDataLen() - view.networkOffset;
+		m_IPHeader = data + view.networkOffset;
+
+		// the IP length and payload are bounded the same way IPv4Layer and IPv6Layer bound them
+		size_t headerLen = 0;
+		size_t ipLen = capturedLen;
+		if (m_IPVersion == 4)
+		{
+			iphdr* ipHeader = (iphdr*)m_IPHeader;
+			headerLen = ipHeader->internetHeaderLength * 4;
+			size_t totalLen = ntohs(ipHeader->totalLength);
+			if (totalLen < ipLen && totalLen != 0)
+				ipLen = totalLen;
+
+			uint16_t fragOffsetAndFlags = ntohs(ipHeader->fragmentOffset);
+			m_MoreFragments = (fragOffsetAndFlags & 0x2000) != 0;
+			m_FragmentOffset = (uint16_t)((fragOffsetAndFlags & 0x1FFF) * 8);
+			m_FragmentId = ntohs(ipHeader->ipId);
+			m_FragIdPtr = (uint8_t*)&ipHeader->ipId;
+		}
+		else
+		{
+			uint8_t nextHeader = 0;
+			size_t fragHeaderOffset = 0;
+			IPv6Layer::findUpperLayerProtocol(m_IPHeader, capturedLen, nextHeader, headerLen, fragHeaderOffset);
+			if (fragHeaderOffset == 0 || fragHeaderOffset + sizeof(IPv6FragmentationHeader::ipv6_frag_header) > capturedLen)
+				return;
+
+			size_t totalLen = ntohs(((ip6_hdr*)m_IPHeader)->payloadLength) + headerLen;
+			if (totalLen < ipLen)
+				ipLen = totalLen;
+
+			IPv6FragmentationHeader::ipv6_frag_header* fragHeader = (IPv6FragmentationHeader::ipv6_frag_header*)(m_IPHeader + fragHeaderOffset);
+			m_MoreFragments = (ntohs(fragHeader->fragOffsetAndFlags) & 0x0001) != 0;
+			m_FragmentOffset = ntohs(fragHeader->fragOffsetAndFlags) & 0xfff8;
+			m_FragmentId = ntohl(fragHeader->id);
+			m_FragIdPtr = (uint8_t*)&fragHeader->id;
+		}
+
+		// a fragment whose headers are truncated is returned as is
+		if (headerLen > ipLen)
+			return;
+
+		m_Payload = m_IPHeader + headerLen;
+		m_PayloadLen = ipLen - headerLen;
+		m_IsFragment = true;
+	}
+
+	// implement abstract methods
+
+	bool isFragment()
+	{
+		return m_IsFragment;
+	}
+
+	bool isFirstFragment()
+	{
+		return m_IsFragment && m_FragmentOffset == 0;
+	}
+
+	bool isLastFragment()
+	{
+		return m_IsFragment && !m_MoreFragments;
+	}
+
+	uint16_t getFragmentOffset()
+	{
+		return m_FragmentOffset;
+	}
+
+	uint32_t getFragmentId()
+	{
+		return m_FragmentId;
+	}
+
+	uint32_t hashPacket()
+	{
+		// the same bytes the layer wrappers hash, so fragments of a packet may come through both paths
+		size_t addrLen = (m_IPVersion == 4 ? 4 : 16);
+		size_t addrOffset = (m_IPVersion == 4 ? offsetof(iphdr, ipSrc) : offsetof(ip6_hdr, ipSrc));
+		ScalarBuffer<uint8_t> vec[3];
+
+		vec[0].buffer = m_IPHeader + addrOffset;
+		vec[0].len = addrLen;
+		vec[1].buffer = m_IPHeader + addrOffset + addrLen;
+		vec[1].len = addrLen;
+		vec[2].buffer = m_FragIdPtr;
+		vec[2].len = (m_IPVersion == 4 ? 2 : 4);
+
+		return pcpp::fnv_hash(vec, 3);
+	}
+
+	IPReassembly::PacketKey* setPacketKey(IPReassembly::IPv4PacketKey& ipv4Key, IPReassembly::IPv6PacketKey& ipv6Key)
+	{
+		if (m_IPVersion == 4)
+		{
+			iphdr* ipHeader = (iphdr*)m_IPHeader;
+			ipv4Key = IPReassembly::IPv4PacketKey((uint16_t)m_FragmentId, IPAddressValue::fromIPv4(ipHeader->ipSrc), IPAddressValue::fromIPv4(ipHeader->ipDst));
+			return &ipv4Key;
+		}
+
+		ip6_hdr* ipHeader = (ip6_hdr*)m_IPHeader;
+		ipv6Key = IPReassembly::IPv6PacketKey(m_FragmentId, IPAddressValue::fromIPv6(ipHeader->ipSrc), IPAddressValue::fromIPv6(ipHeader->ipDst));
+		return &ipv6Key;
+	}
+
+	uint8_t* getIPHeader()
+	{
+		return m_IPHeader;
+	}
+
+	uint8_t* getIPLayerPayload()
+	{
+		return m_Payload;
+	}
+
+	size_t getIPLayerPayloadSize()
+	{
+		return m_PayloadLen;
+	}
+
+private:
+	uint8_t* m_IPHeader;
+	uint8_t* m_Payload;
+	size_t m_PayloadLen;
+	uint8_t* m_FragIdPtr;
+	bool m_IsFragment;
+	bool m_MoreFragments;
+	uint16_t m_FragmentOffset;
+	uint32_t m_FragmentId;
+	uint8_t m_IPVersion;
 
 };
 
@@ -231,8 +401,8 @@ uint32_t IPReassembly::IPv4PacketKey::getHashValue() const
 	ScalarBuffer<uint8_t> vec[3];
 
 	uint16_t ipIdNetworkOrder = htons(m_IpID);
-	uint32_t ipSrcAsInt = m_SrcIP.toInt();
-	uint32_t ipDstAsInt = m_DstIP.toInt();
+	uint32_t ipSrcAsInt = m_SrcIP.toIPv4Int();
+	uint32_t ipDstAsInt = m_DstIP.toIPv4Int();
 
 	vec[0].buffer = (uint8_t*)&ipSrcAsInt;
 	vec[0].len = 4;
@@ -249,14 +419,11 @@ uint32_t IPReassembly::IPv6PacketKey::getHashValue() const
 	ScalarBuffer<uint8_t> vec[3];
 
 	uint32_t fragIdNetworkOrder = htonl(m_FragmentID);
-	uint8_t ipSrcAsByteArr[16];
-	uint8_t ipDstAsByteArr[16];
-	m_SrcIP.copyTo(ipSrcAsByteArr);
-	m_DstIP.copyTo(ipDstAsByteArr);
 
-	vec[0].buffer = ipSrcAsByteArr;
+	// the bytes of an invalid IPAddressValue are zeros, the same as the bytes of IPv6Address::Zero
+	vec[0].buffer = (uint8_t*)m_SrcIP.getBytes();
 	vec[0].len = 16;
-	vec[1].buffer = ipDstAsByteArr;
+	vec[1].buffer = (uint8_t*)m_DstIP.getBytes();
 	vec[1].len = 16;
 	vec[2].buffer = (uint8_t*)&fragIdNetworkOrder;
 	vec[2].len = 4;
@@ -266,26 +433,173 @@ uint32_t IPReassembly::IPv6PacketKey::getHashValue() const
 
 
 
-IPReassembly::IPReassembly(OnFragmentsClean onFragmentsCleanCallback, void* callbackUserCookie, size_t maxPacketsToStore)
+class IPReassembly::ReassemblyBuffer : public RawPacket
 {
-	m_PacketLRU = new LRUList<uint32_t>(maxPacketsToStore);
+public:
+	ReassemblyBuffer(timespec timestamp, LinkLayerType layerType) : m_Capacity(0)
+	{
+		m_TimeStamp = timestamp;
+		m_LinkLayerType = layerType;
+	}
+
+	inline size_t getCapacity() const { return m_Capacity; }
+
+	// make the buffer at least the given length, keeping the data. It grows at least twice as large each time so a packet arriving in many
+	// fragments is moved only a few times
+	void reserve(size_t capacity, RawPacketPool* pool)
+	{
+		if (capacity <= m_Capacity)
+			return;
+
+		if (m_RawData == NULL)
+		{
+			uint8_t* buffer = (pool != NULL ? pool->allocate(capacity) : NULL);
+			if (buffer != NULL)
+			{
+				m_RawDataPool = pool;
+				m_Capacity = pool->getBufferSize(buffer);
+			}
+			else
+			{
+				buffer = new uint8_t[capacity];
+				m_Capacity = capacity;
+			}
+
+			m_RawData = buffer;
+			m_RawDataLen = 0;
+			m_FrameLength = 0;
+			m_DeleteRawDataAtDestructor = true;
+			m_RawPacketSet = true;
+			return;
+		}
+
+		size_t newCapacity = 2 * m_Capacity;
+		if (newCapacity < capacity)
+			newCapacity = capacity;
+
+		reallocateData(newCapacity);
+		m_Capacity = (m_RawDataPool != NULL ? m_RawDataPool->getBufferSize(m_RawData) : newCapacity);
+	}
+
+	// copy data to an offset of a buffer reserved to hold it, extending the data length if the data ends after it
+	inline void write(size_t offset, const uint8_t* data, size_t dataLen)
+	{
+		memcpy(m_RawData + offset, data, dataLen);
+		if (offset + dataLen > (size_t)m_RawDataLen)
+			setDataLen(offset + dataLen);
+	}
+
+	// move data within a buffer reserved to hold it, extending the data length if it ends after it
+	inline void move(size_t fromOffset, size_t toOffset, size_t dataLen)
+	{
+		memmove(m_RawData + toOffset, m_RawData + fromOffset, dataLen);
+		if (toOffset + dataLen > (size_t)m_RawDataLen)
+			setDataLen(toOffset + dataLen);
+	}
+
+	inline void setDataLen(size_t dataLen)
+	{
+		m_RawDataLen = (int)dataLen;
+		m_FrameLength = (int)dataLen;
+	}
+
+	// the data of a buffer which isn't shared, for fixing the headers of a reassembled packet in place
+	inline uint8_t* getWritableData() { return m_RawData; }
+
+private:
+	size_t m_Capacity;
+};
+
+
+IPReassembly::IPFragmentData::IPFragmentData()
+{
+	currentOffset = 0;
+	data = NULL;
+	headerLen = 0;
+	networkOffset = PacketView::NoOffset;
+	gotFirstFragment = false;
+	fragmentID = 0;
+	hash = 0;
+	packetKey = NULL;
+	memoryBytes = 0;
+	evictionId = EvictionList::InvalidItemId;
+	timerId = TimerWheel::InvalidTimerId;
+	nextFree = NULL;
+}
+
+IPReassembly::IPFragmentData::~IPFragmentData()
+{
+	delete data;
+}
+
+
+IPReassembly::IPReassembly(OnFragmentsClean onFragmentsCleanCallback, void* callbackUserCookie, size_t maxPacketsToStore, size_t maxMemoryBytes, EvictionPolicy evictionPolicy, uint32_t fragmentTimeout) :
+	m_OwnMemoryBudget(maxMemoryBytes), m_EvictionList(evictionPolicy)
+{
+	m_PacketLRU = new FixedLRUList<uint32_t>(maxPacketsToStore);
+	m_FreeFragmentData = NULL;
 	m_OnFragmentsCleanCallback = onFragmentsCleanCallback;
 	m_CallbackUserCookie = callbackUserCookie;
+	m_RawPacketPool = NULL;
+	m_MemoryBudget = &m_OwnMemoryBudget;
+	m_MemoryBytes = 0;
+	m_NumOfEvictedPackets = 0;
+	m_CurrentTime = 0;
+	m_FragmentTimeout = fragmentTimeout;
+	m_NumOfExpiredPackets = 0;
+	m_NumOfFragmentsProcessed = 0;
+	m_NumOfPacketsReassembled = 0;
+	m_NumOfMalformedFragments = 0;
+	m_NumOfPacketsDroppedAtCapacity = 0;
 }
 
 IPReassembly::~IPReassembly()
 {
 	delete m_PacketLRU;
 
-	// empty the map - go over all keys, delete all IPFragmentData objects and remove them from the map
-	while (!m_FragmentMap.empty())
+	// delete all packets being reassembled and the pool of free IPFragmentData objects
+	for (size_t i = 0; i < m_PacketIndex.getNumOfSlots(); i++)
+		delete m_PacketIndex.getSlot(i).fragData;
+
+	while (m_FreeFragmentData != NULL)
 	{
-		delete m_FragmentMap.begin()->second;
-		m_FragmentMap.erase(m_FragmentMap.begin());
+		IPFragmentData* next = m_FreeFragmentData->nextFree;
+		delete m_FreeFragmentData;
+		m_FreeFragmentData = next;
 	}
+
+	// the budget may be shared with other instances which keep using it
+	m_MemoryBudget->release(m_MemoryBytes);
 }
 
 Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status, ProtocolType parseUntil, OsiModelLayer parseUntilLayer)
+{
+	// packets whose timeout passed are dropped before the fragment is handled, so a late fragment of such a packet begins a new one
+	setCurrentTime(fragment->getRawPacket()->getPacketTimeStampNs().tv_sec);
+
+	Packet* result = processFragment(fragment, status, parseUntil, parseUntilLayer);
+	countFragment(status);
+
+	// new packets and fragments may have exceeded the memory budget. Packets are dropped only here, after the fragment was fully handled
+	if (m_MemoryBudget->isExceeded())
+		evictPackets();
+
+	return result;
+}
+
+void IPReassembly::countFragment(ReassemblyStatus status)
+{
+	if (status >= FIRST_FRAGMENT)
+	{
+		m_NumOfFragmentsProcessed++;
+		if (status == REASSEMBLED)
+			m_NumOfPacketsReassembled++;
+		else if (status == MALFORMED_FRAGMENT)
+			m_NumOfMalformedFragments++;
+	}
+}
+
+Packet* IPReassembly::processFragment(Packet* fragment, ReassemblyStatus& status, ProtocolType parseUntil, OsiModelLayer parseUntilLayer)
 {
 	status = NON_IP_PACKET;
 
@@ -297,9 +611,6 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 		return fragment;
 	}
 
-	// get IPv4 layer
-	//IPv4Layer* ipLayer = fragment->getLayerOfType<IPv4Layer>();
-
 	// create fragment wrapper
 	IPv4FragmentWrapper ipv4Wrapper(fragment);
 	IPv6FragmentWrapper ipv6Wrapper(fragment);
@@ -317,52 +628,109 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 		return fragment;
 	}
 
+	IPFragmentData* fragData = processFragment(fragWrapper, fragment->getRawPacket(), status);
+	if (fragData == NULL)
+		return NULL;
+
+	LOG_DEBUG("[FragID=0x%X] Reassembly process completed, allocating a packet and returning it", fragWrapper->getFragmentId());
+
+	// the reassembly buffer becomes the raw data of the reassembled packet. Data of out-of-order fragments beyond the last fragment is dropped
+	ReassemblyBuffer* reassembledData = fragData->data;
+	fragData->data = NULL;
+	reassembledData->setDataLen(fragData->headerLen + fragData->currentOffset);
+
+	// fix IP length field. For IPv4 also clear the fragment offset and flags now, otherwise the reassembled packet is parsed as a
+	// fragment and the layers above IPv4 aren't parsed
+	if (fragData->packetKey->getProtocolType() == IPv4)
+	{
+		Packet tempPacket(reassembledData, IPv4);
+		tempPacket.getLayerOfType<IPv4Layer>()->getIPv4Header()->totalLength = htons(fragData->currentOffset + tempPacket.getLayerOfType<IPv4Layer>()->getHeaderLen());
+		tempPacket.getLayerOfType<IPv4Layer>()->getIPv4Header()->fragmentOffset = 0;
+	}
+	else
+	{
+		Packet tempPacket(reassembledData, IPv6);
+		tempPacket.getLayerOfType<IPv6Layer>()->getIPv6Header()->payloadLength = fragData->currentOffset;
+	}
+
+	// create a new Packet object with the reassembled data as its RawPacket
+	Packet* reassembledPacket = new Packet(reassembledData, true, parseUntil, parseUntilLayer);
+
+	if (fragData->packetKey->getProtocolType() == IPv4)
+	{
+		// set the fragment offset to 0
+		IPv4Layer* ipLayer = reassembledPacket->getLayerOfType<IPv4Layer>();
+		ipLayer->getIPv4Header()->fragmentOffset = 0;
+
+		// re-calculate all IPv4 fields
+		ipLayer->computeCalculateFields();
+	}
+	else
+	{
+		// remove fragment extension
+		IPv6Layer* ipLayer = reassembledPacket->getLayerOfType<IPv6Layer>();
+		ipLayer->removeAllExtensions();
+
+		// re-calculate all IPv4 fields
+		ipLayer->computeCalculateFields();
+	}
+
+	removeReassembledPacket(fragData);
+	return reassembledPacket;
+}
+
+IPReassembly::IPFragmentData* IPReassembly::processFragment(IPFragmentWrapper* fragWrapper, const RawPacket* rawFragment, ReassemblyStatus& status)
+{
 	// create a hash from source IP, destination IP and IP/fragment ID
 	uint32_t hash = fragWrapper->hashPacket();
 
-	IPFragmentData* fragData = NULL;
-
-	// check whether this packet already exists in the map
-	std::map<uint32_t, IPFragmentData*>::iterator iter = m_FragmentMap.find(hash);
+	// check whether this packet already exists in the table
+	IPFragmentData* fragData = findPacket(hash);
 
 	// this is the first fragment seen for this packet
-	if (iter == m_FragmentMap.end())
+	if (fragData == NULL)
 	{
-		LOG_DEBUG("Got new packet with FragID=0x%X, allocating place in map", fragWrapper->getFragmentId());
+		LOG_DEBUG("Got new packet with FragID=0x%X, allocating place in table", fragWrapper->getFragmentId());
 
-		// create the IPFragmentData object
-		fragData = new IPFragmentData(fragWrapper->createPacketKey(), fragWrapper->getFragmentId());
+		// take an IPFragmentData object from the pool and set the packet key in place
+		fragData = allocateFragmentData();
+		fragData->fragmentID = fragWrapper->getFragmentId();
+		fragData->hash = hash;
+		fragData->packetKey = fragWrapper->setPacketKey(fragData->ipv4Key, fragData->ipv6Key);
 
-		// add the new fragment to the map
+		// add the new fragment to the table
 		addNewFragment(hash, fragData);
 	}
 	else // packet was seen before
 	{
-		// get the IPFragmentData object
-		fragData = iter->second;
-
 		// mark this packet as used
-		uint32_t* removedElement = m_PacketLRU->put(hash);
-		if (removedElement != NULL)
-			delete removedElement;
+		m_PacketLRU->put(hash);
+		m_EvictionList.touch(fragData->evictionId);
 	}
 
+	// the fragment's headers are everything before the IP payload
+	uint8_t* payload = fragWrapper->getIPLayerPayload();
+	size_t payloadLen = fragWrapper->getIPLayerPayloadSize();
+	size_t headerLen = payload - rawFragment->getRawData();
+
 	bool gotLastFragment = false;
 
 	// if current fragment is the first fragment of this packet
 	if (fragWrapper->isFirstFragment())
 	{
-		if (fragData->data == NULL) // first fragment
+		if (!fragData->gotFirstFragment) // first fragment
 		{
-			LOG_DEBUG("[FragID=0x%X] Got first fragment, allocating RawPacket", fragWrapper->getFragmentId());
+			LOG_DEBUG("[FragID=0x%X] Got first fragment, copying it to the reassembly buffer", fragWrapper->getFragmentId());
 
-			// create the reassembled packet and copy the fragment data to it
-			fragData->data = new RawPacket(*(fragment->getRawPacket()));
-			fragData->currentOffset = fragWrapper->getIPLayerPayloadSize();
+			// copy the fragment headers and data to the beginning of the reassembly buffer
+			copyFirstFragment(fragData, rawFragment, headerLen, payloadLen);
+			fragData->networkOffset = (uint16_t)(fragWrapper->getIPHeader() - rawFragment->getRawData());
+			fragData->currentOffset = payloadLen;
 			status = FIRST_FRAGMENT;
 
 			// check if the next fragments already arrived out-of-order and waiting in the out-of-order list
 			gotLastFragment = matchOutOfOrderFragments(fragData);
+			updateMemoryUsage(fragData);
 		}
 		else // duplicated first fragment
 		{
@@ -382,7 +750,7 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 		if (fragData->currentOffset == fragOffset)
 		{
 			// malformed fragment which is not the first fragment but its offset is 0
-			if (fragData->data == NULL)
+			if (!fragData->gotFirstFragment)
 			{
 				LOG_DEBUG("[FragID=0x%X] Fragment is malformed", fragWrapper->getFragmentId());
 				status = MALFORMED_FRAGMENT;
@@ -391,12 +759,11 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 
 			LOG_DEBUG("[FragID=0x%X] Found next matching fragment with offset %d, adding fragment data to reassembled packet", fragWrapper->getFragmentId(), (int)fragOffset);
 
-			// copy fragment data to reassembled packet
-			fragData->data->reallocateData(fragData->data->getRawDataLen() + fragWrapper->getIPLayerPayloadSize());
-			fragData->data->appendData(fragWrapper->getIPLayerPayload(), fragWrapper->getIPLayerPayloadSize());
+			// copy fragment data to its place in the reassembly buffer
+			copyFragment(fragData, rawFragment, headerLen, fragOffset, payload, payloadLen, false);
 
 			// update expected offset
-			fragData->currentOffset += fragWrapper->getIPLayerPayloadSize();
+			fragData->currentOffset += payloadLen;
 
 			// if this is the last fragment - mark it
 			if (fragWrapper->isLastFragment())
@@ -404,22 +771,22 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 			else
 				// if not the last fragment - check if the next fragments are waiting in the out-of-order list
 				gotLastFragment = matchOutOfOrderFragments(fragData);
+
+			updateMemoryUsage(fragData);
 		}
 		// if current fragment offset is larger than expected - this means this fragment is out-of-order
 		else if (fragOffset > fragData->currentOffset)
 		{
 			LOG_DEBUG("[FragID=0x%X] Got out-of-ordered fragment with offset %d (expected: %d). Adding it to out-of-order list", fragWrapper->getFragmentId(), (int)fragOffset, (int)fragData->currentOffset);
 
-			// create a new IPFragment and copy the fragment data and params to it
-			IPFragment* newFrag = new IPFragment();
-			newFrag->fragmentOffset = fragWrapper->getFragmentOffset();
-			newFrag->fragmentData = new uint8_t[fragWrapper->getIPLayerPayloadSize()];
-			newFrag->fragmentDataLen = fragWrapper->getIPLayerPayloadSize();
-			memcpy(newFrag->fragmentData, fragWrapper->getIPLayerPayload(), newFrag->fragmentDataLen);
-			newFrag->lastFragment = fragWrapper->isLastFragment();
-
-			// store the IPFragment in the out-of-order fragment list
-			fragData->outOfOrderFragments.pushBack(newFrag);
+			// copy the fragment data to its place in the reassembly buffer and keep its place in the out-of-order list
+			copyFragment(fragData, rawFragment, headerLen, fragOffset, payload, payloadLen, true);
+			IPFragment newFrag;
+			newFrag.fragmentOffset = fragOffset;
+			newFrag.fragmentDataLen = (uint32_t)payloadLen;
+			newFrag.lastFragment = fragWrapper->isLastFragment();
+			fragData->outOfOrderFragments.push_back(newFrag);
+			updateMemoryUsage(fragData);
 
 			status = OUT_OF_ORDER_FRAGMENT;
 			return NULL;
@@ -431,176 +798,454 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 
 	}
 
-	// if seen the last fragment
+	// if seen the last fragment the packet is complete. The caller builds the reassembled packet and then removes it with removeReassembledPacket()
 	if (gotLastFragment)
 	{
-		LOG_DEBUG("[FragID=0x%X] Reassembly process completed, allocating a packet and returning it", fragWrapper->getFragmentId());
-		fragData->deleteData = false;
+		status = REASSEMBLED;
+		return fragData;
+	}
+
+	// if got to here it means this fragment is either the first fragment or a fragment in the middle. Set the appropriate status and return
+	if (status != FIRST_FRAGMENT)
+		status = FRAGMENT;
+
+	return NULL;
+}
+
+void IPReassembly::removeReassembledPacket(IPFragmentData* fragData)
+{
+	LOG_DEBUG("[FragID=0x%X] Deleting fragment data from table", fragData->fragmentID);
+
+	// remove the packet from the table and return its IPFragmentData object to the pool
+	uint32_t hash = fragData->hash;
+	releaseMemory(fragData);
+	erasePacket(hash);
+	m_PacketLRU->eraseElement(hash);
+	freeFragmentData(fragData);
+}
+
+Packet* IPReassembly::processPacket(RawPacket* fragment, ReassemblyStatus& status, ProtocolType parseUntil, OsiModelLayer parseUntilLayer)
+{
+	// reassembly needs the layers up to the IP layer only, so the fragment is parsed up to the network layer into a packet on the stack.
+	// Only a packet returned as is is parsed again, on the heap and as deep as requested
+	Packet parsedFragment(fragment, false, parseUntil, (parseUntilLayer < OsiModelNetworkLayer ? parseUntilLayer : OsiModelNetworkLayer));
+	Packet* result = processPacket(&parsedFragment, status, parseUntil, parseUntilLayer);
+	if (result == &parsedFragment)
+		return new Packet(fragment, false, parseUntil, parseUntilLayer);
+
+	return result;
+}
+
+RawPacket* IPReassembly::processRawPacket(RawPacket* fragment, const PacketView& view, ReassemblyStatus& status, PacketView& reassembledView)
+{
+	setCurrentTime(fragment->getPacketTimeStampNs().tv_sec);
+
+	RawPacket* result = NULL;
+	RawFragmentWrapper fragWrapper(fragment, view);
+	if (view.ipVersion != 4 && view.ipVersion != 6)
+	{
+		status = NON_IP_PACKET;
+		result = fragment;
+	}
+	else if (!fragWrapper.isFragment())
+	{
+		status = NON_FRAGMENT;
+		result = fragment;
+	}
+	else
+	{
+		status = NON_IP_PACKET;
+		IPFragmentData* fragData = processFragment(&fragWrapper, fragment, status);
+		if (fragData != NULL)
+		{
+			result = buildRawPacket(fragData, view, reassembledView);
+			removeReassembledPacket(fragData);
+		}
+	}
+
+	countFragment(status);
+
+	if (m_MemoryBudget->isExceeded())
+		evictPackets();
+
+	return result;
+}
+
+RawPacket* IPReassembly::buildRawPacket(IPFragmentData* fragData, const PacketView& fragmentView, PacketView& reassembledView)
+{
+	// the reassembly buffer becomes the raw data of the reassembled packet. Data of out-of-order fragments beyond the last fragment is dropped
+	ReassemblyBuffer* reassembledData = fragData->data;
+	fragData->data = NULL;
+	size_t headerLen = fragData->headerLen;
+	size_t dataLen = headerLen + fragData->currentOffset;
+	reassembledData->setDataLen(dataLen);
+	uint8_t* data = reassembledData->getWritableData();
+
+	// the offset is unknown only for packets restored from a checkpoint, whose headers are located again
+	size_t networkOffset = fragData->networkOffset;
+	if (networkOffset == PacketView::NoOffset)
+	{
+		FlowKeyExtractor::extract(reassembledData, reassembledView);
+		networkOffset = reassembledView.networkOffset;
+		if (networkOffset == PacketView::NoOffset || networkOffset >= headerLen)
+			return reassembledData;
+	}
+
+	if (fragData->packetKey->getProtocolType() == IPv4)
+	{
+		// clear the fragment offset and flags and fix the length and the checksum, as IPv4Layer#computeCalculateFields() does
+		iphdr* ipHeader = (iphdr*)(data + networkOffset);
+		ipHeader->totalLength = htons((uint16_t)(dataLen - networkOffset));
+		ipHeader->fragmentOffset = 0;
+		ipHeader->headerChecksum = 0;
+		ScalarBuffer<uint16_t> scalar = { (uint16_t*)ipHeader, (size_t)(ipHeader->internetHeaderLength*4) };
+		ipHeader->headerChecksum = htons(compute_checksum(&scalar, 1));
+	}
+	else if (headerLen >= networkOffset + sizeof(ip6_hdr))
+	{
+		// remove all extensions as IPv6Layer#removeAllExtensions() does. The payload is moved right after the fixed header
+		ip6_hdr* ipHeader = (ip6_hdr*)(data + networkOffset);
+		size_t extensionsLen = headerLen - networkOffset - sizeof(ip6_hdr);
+		if (extensionsLen > 0)
+		{
+			uint8_t nextHeader = 0;
+			size_t ipHeaderLen = 0;
+			size_t fragHeaderOffset = 0;
+			IPv6Layer::findUpperLayerProtocol(data + networkOffset, dataLen - networkOffset, nextHeader, ipHeaderLen, fragHeaderOffset);
+			ipHeader->nextHeader = nextHeader;
+			reassembledData->move(headerLen, headerLen - extensionsLen, fragData->currentOffset);
+			dataLen -= extensionsLen;
+			reassembledData->setDataLen(dataLen);
+		}
+
+		ipHeader->payloadLength = htons((uint16_t)(dataLen - networkOffset - sizeof(ip6_hdr)));
+	}
+
+	// the link layer headers are those of the first fragment. When they're as long as those of this fragment only the network and transport
+	// fields have to be filled again
+	if (networkOffset == fragmentView.networkOffset)
+	{
+		reassembledView = fragmentView;
+		FlowKeyExtractor::extractFromNetworkLayer(data, dataLen, networkOffset, reassembledView);
+	}
+	else
+	{
+		FlowKeyExtractor::extract(reassembledData, reassembledView);
+	}
+
+	return reassembledData;
+}
+
+Packet* IPReassembly::getCurrentPacket(const PacketKey& key)
+{
+	// look for the hash value of the packet key in the table
+	IPFragmentData* fragData = findPacket(key.getHashValue());
+
+	// some data already exists
+	if (fragData != NULL && fragData->gotFirstFragment)
+	{
+		// copy the headers and the data received in order
+		RawPacket* partialRawPacket = new RawPacket();
+		partialRawPacket->copyRawData(fragData->data->getRawData(), (int)(fragData->headerLen + fragData->currentOffset), fragData->data->getPacketTimeStampNs(),
+				m_RawPacketPool, fragData->data->getLinkLayerType());
 
 		// fix IP length field
 		if (fragData->packetKey->getProtocolType() == IPv4)
 		{
-			Packet tempPacket(fragData->data, IPv4);
+			Packet tempPacket(partialRawPacket, IPv4);
 			tempPacket.getLayerOfType<IPv4Layer>()->getIPv4Header()->totalLength = htons(fragData->currentOffset + tempPacket.getLayerOfType<IPv4Layer>()->getHeaderLen());
 		}
 		else
 		{
-			Packet tempPacket(fragData->data, IPv6);
+			Packet tempPacket(partialRawPacket, IPv6);
 			tempPacket.getLayerOfType<IPv6Layer>()->getIPv6Header()->payloadLength = fragData->currentOffset;
 		}
 
-		// create a new Packet object with the reassembled data as its RawPacket
-		Packet* reassembledPacket = new Packet(fragData->data, true, parseUntil, parseUntilLayer);
+		// create a packet object wrapping the RawPacket we've just created
+		Packet* partialDataPacket = new Packet(partialRawPacket, true);
 
-		if (fragData->packetKey->getProtocolType() == IPv4)
+		// prepare the packet and return it
+		if (key.getProtocolType() == IPv4)
 		{
-			// set the fragment offset to 0
-			IPv4Layer* ipLayer = reassembledPacket->getLayerOfType<IPv4Layer>();
+			IPv4Layer* ipLayer = partialDataPacket->getLayerOfType<IPv4Layer>();
 			ipLayer->getIPv4Header()->fragmentOffset = 0;
-
-			// re-calculate all IPv4 fields
 			ipLayer->computeCalculateFields();
 		}
-		else
+		else // key.getProtocolType() == IPv6
 		{
-			// remove fragment extension
-			IPv6Layer* ipLayer = reassembledPacket->getLayerOfType<IPv6Layer>();
+			IPv6Layer* ipLayer = partialDataPacket->getLayerOfType<IPv6Layer>();
 			ipLayer->removeAllExtensions();
-
-			// re-calculate all IPv4 fields
 			ipLayer->computeCalculateFields();
 		}
 
-		LOG_DEBUG("[FragID=0x%X] Deleting fragment data from map", fragWrapper->getFragmentId());
-
-		// delete the IPFragmentData object and remove it from the map
-		delete fragData;
-		m_FragmentMap.erase(iter);
-		m_PacketLRU->eraseElement(hash);
-		status = REASSEMBLED;
-		return reassembledPacket;
+		return partialDataPacket;
 	}
 
-	// if got to here it means this fragment is either the first fragment or a fragment in the middle. Set the appropriate status and return
-	if (status != FIRST_FRAGMENT)
-		status = FRAGMENT;
-
 	return NULL;
 }
 
-Packet* IPReassembly::processPacket(RawPacket* fragment, ReassemblyStatus& status, ProtocolType parseUntil, OsiModelLayer parseUntilLayer)
-{
-	Packet* parsedFragment = new Packet(fragment, false, parseUntil, parseUntilLayer);
-	Packet* result = processPacket(parsedFragment, status, parseUntil, parseUntilLayer);
-	if (result != parsedFragment)
-		delete parsedFragment;
-
-	return result;
-}
-
-Packet* IPReassembly::getCurrentPacket(const PacketKey& key)
+void IPReassembly::removePacket(const PacketKey& key)
 {
 	// create a hash out of the packet key
 	uint32_t hash = key.getHashValue();
 
-	// look for this hash value in the map
-	std::map<uint32_t, IPFragmentData*>::iterator iter = m_FragmentMap.find(hash);
+	// look for this hash value in the table
+	IPFragmentData* fragData = findPacket(hash);
 
 	// hash was found
-	if (iter != m_FragmentMap.end())
+	if (fragData != NULL)
 	{
-		IPFragmentData* fragData = iter->second;
+		// free all data saved for the packet
+		releaseMemory(fragData);
+		erasePacket(hash);
+		freeFragmentData(fragData);
 
-		// some data already exists
-		if (fragData != NULL && fragData->data != NULL)
-		{
-			// create a copy of the RawPacket object
-			RawPacket* partialRawPacket = new RawPacket(*(fragData->data));
+		// remove from LRU list
+		m_PacketLRU->eraseElement(hash);
+	}
+}
 
-			// fix IP length field
-			if (fragData->packetKey->getProtocolType() == IPv4)
-			{
-				Packet tempPacket(partialRawPacket, IPv4);
-				tempPacket.getLayerOfType<IPv4Layer>()->getIPv4Header()->totalLength = htons(fragData->currentOffset + tempPacket.getLayerOfType<IPv4Layer>()->getHeaderLen());
-			}
-			else
-			{
-				Packet tempPacket(partialRawPacket, IPv6);
-				tempPacket.getLayerOfType<IPv6Layer>()->getIPv6Header()->payloadLength = fragData->currentOffset;
-			}
+IPReassembly::IPFragmentData* IPReassembly::findPacket(uint32_t hash) const
+{
+	const PacketSlot* slot = m_PacketIndex.find(hash);
+	return (slot != NULL ? slot->fragData : NULL);
+}
 
-			// create a packet object wrapping the RawPacket we've just created
-			Packet* partialDataPacket = new Packet(partialRawPacket, true);
+void IPReassembly::insertPacket(IPFragmentData* fragData)
+{
+	m_PacketIndex.insert(fragData->hash).fragData = fragData;
+}
 
-			// prepare the packet and return it
-			if (key.getProtocolType() == IPv4)
-			{
-				IPv4Layer* ipLayer = partialDataPacket->getLayerOfType<IPv4Layer>();
-				ipLayer->getIPv4Header()->fragmentOffset = 0;
-				ipLayer->computeCalculateFields();
-			}
-			else // key.getProtocolType() == IPv6
-			{
-				IPv6Layer* ipLayer = partialDataPacket->getLayerOfType<IPv6Layer>();
-				ipLayer->removeAllExtensions();
-				ipLayer->computeCalculateFields();
-			}
+void IPReassembly::erasePacket(uint32_t hash)
+{
+	PacketSlot* slot = m_PacketIndex.find(hash);
+	if (slot != NULL)
+		m_PacketIndex.erase(slot);
+}
 
-			return partialDataPacket;
-		}
-	}
+IPReassembly::IPFragmentData* IPReassembly::allocateFragmentData()
+{
+	if (m_FreeFragmentData == NULL)
+		return new IPFragmentData();
 
-	return NULL;
+	IPFragmentData* fragData = m_FreeFragmentData;
+	m_FreeFragmentData = fragData->nextFree;
+	fragData->nextFree = NULL;
+	return fragData;
 }
 
-void IPReassembly::removePacket(const PacketKey& key)
+void IPReassembly::freeFragmentData(IPFragmentData* fragData)
 {
-	// create a hash out of the packet key
-	uint32_t hash = key.getHashValue();
+	delete fragData->data;
+	fragData->data = NULL;
+	fragData->currentOffset = 0;
+	fragData->headerLen = 0;
+	fragData->networkOffset = PacketView::NoOffset;
+	fragData->gotFirstFragment = false;
+	fragData->packetKey = NULL;
+	fragData->outOfOrderFragments.clear();
+	fragData->memoryBytes = 0;
+	fragData->evictionId = EvictionList::InvalidItemId;
+	if (fragData->timerId != TimerWheel::InvalidTimerId)
+	{
+		m_ExpiryTimers.removeTimer(fragData->timerId);
+		fragData->timerId = TimerWheel::InvalidTimerId;
+	}
 
-	// look for this hash value in the map
-	std::map<uint32_t, IPFragmentData*>::iterator iter = m_FragmentMap.find(hash);
+	fragData->nextFree = m_FreeFragmentData;
+	m_FreeFragmentData = fragData;
+}
 
-	// hash was found
-	if (iter != m_FragmentMap.end())
+void IPReassembly::copyFirstFragment(IPFragmentData* fragData, const RawPacket* fragment, size_t headerLen, size_t payloadLen)
+{
+	if (fragData->data == NULL)
 	{
-		// free all data saved in the map
-		delete iter->second;
-		m_FragmentMap.erase(iter);
+		// the other fragments usually take about as much as this one
+		fragData->data = new ReassemblyBuffer(fragment->getPacketTimeStampNs(), fragment->getLinkLayerType());
+		fragData->data->reserve(headerLen + 2 * payloadLen, m_RawPacketPool);
+	}
+	else if (headerLen != fragData->headerLen)
+	{
+		// the buffer was allocated for an out-of-order fragment whose headers are of a different length. Move the data after the new headers
+		size_t dataLen = fragData->data->getRawDataLen() - fragData->headerLen;
+		fragData->data->reserve(headerLen + dataLen, m_RawPacketPool);
+		fragData->data->move(fragData->headerLen, headerLen, dataLen);
+		fragData->data->setDataLen(headerLen + dataLen);
+	}
 
-		// remove from LRU list
-		m_PacketLRU->eraseElement(hash);
+	fragData->data->reserve(headerLen + payloadLen, m_RawPacketPool);
+	fragData->data->write(0, fragment->getRawData(), headerLen + payloadLen);
+	fragData->data->setPacketTimeStamp(fragment->getPacketTimeStampNs());
+	fragData->headerLen = headerLen;
+	fragData->gotFirstFragment = true;
+}
+
+void IPReassembly::copyFragment(IPFragmentData* fragData, const RawPacket* fragment, size_t headerLen, uint32_t fragOffset, const uint8_t* payload, size_t payloadLen, bool lastFragment)
+{
+	size_t offset = fragData->headerLen + fragOffset;
+
+	if (fragData->data == NULL)
+	{
+		// no fragment was copied yet. The buffer begins with the headers of this fragment, which the first fragment replaces. Unless this
+		// is the last fragment, whose end is the end of the packet, room is made for twice the data up to its end
+		fragData->data = new ReassemblyBuffer(fragment->getPacketTimeStampNs(), fragment->getLinkLayerType());
+		fragData->headerLen = headerLen;
+		offset = headerLen + fragOffset;
+		fragData->data->reserve(offset + payloadLen + (lastFragment ? 0 : fragOffset + payloadLen), m_RawPacketPool);
+		fragData->data->write(0, fragment->getRawData(), headerLen);
 	}
+
+	fragData->data->reserve(offset + payloadLen, m_RawPacketPool);
+
+	// fill the gap of fragments which haven't arrived yet, so the data length covers it
+	size_t dataLen = fragData->data->getRawDataLen();
+	if (offset > dataLen)
+		fragData->data->setDataLen(offset);
+
+	fragData->data->write(offset, payload, payloadLen);
 }
 
 void IPReassembly::addNewFragment(uint32_t hash, IPFragmentData* fragData)
 {
 	// put the new frag in the LRU list
-	uint32_t* packetRemoved = m_PacketLRU->put(hash);
+	uint32_t packetRemoved;
 
-	if (packetRemoved != NULL) // this means LRU list was full and the least recently used item was removed
+	if (m_PacketLRU->put(hash, &packetRemoved)) // this means LRU list was full and the least recently used item was removed
 	{
-		// remove this item from the fragment map
-		std::map<uint32_t, IPFragmentData*>::iterator iter = m_FragmentMap.find(*packetRemoved);
-		IPFragmentData* dataRemoved = iter->second;
-		PacketKey* key = dataRemoved->packetKey->clone();
+		// remove this item from the fragment table
+		IPFragmentData* dataRemoved = findPacket(packetRemoved);
 		LOG_DEBUG("Reached maximum packet capacity, removing data for FragID=0x%X", dataRemoved->fragmentID);
-		delete dataRemoved;
-		m_FragmentMap.erase(iter);
+		m_NumOfPacketsDroppedAtCapacity++;
+		dropPacket(dataRemoved);
+	}
+
+	// add the new fragment to the table
+	insertPacket(fragData);
+
+	fragData->evictionId = m_EvictionList.add(hash, 0);
+	updateMemoryUsage(fragData);
+
+	// the timeout counts from the first fragment and isn't moved by the following ones, so only one timer is set per packet
+	if (m_FragmentTimeout > 0)
+		fragData->timerId = m_ExpiryTimers.addTimer((uint64_t)m_CurrentTime + m_FragmentTimeout, hash);
+}
+
+void IPReassembly::updateMemoryUsage(IPFragmentData* fragData)
+{
+	// the fixed cost of a packet: its state, its slots in the table and its node in the LRU list
+	static const size_t packetStateBytes = sizeof(IPFragmentData) + 2 * sizeof(PacketSlot) + 4 * sizeof(void*);
+
+	size_t memoryBytes = packetStateBytes + fragData->outOfOrderFragments.capacity() * sizeof(IPFragment);
+	if (fragData->data != NULL)
+		memoryBytes += sizeof(ReassemblyBuffer) + fragData->data->getCapacity();
+
+	if (memoryBytes >= fragData->memoryBytes)
+		m_MemoryBudget->charge(memoryBytes - fragData->memoryBytes);
+	else
+		m_MemoryBudget->release(fragData->memoryBytes - memoryBytes);
+
+	m_MemoryBytes = m_MemoryBytes - fragData->memoryBytes + memoryBytes;
+	fragData->memoryBytes = memoryBytes;
+	m_EvictionList.resize(fragData->evictionId, memoryBytes);
+}
+
+void IPReassembly::releaseMemory(IPFragmentData* fragData)
+{
+	m_MemoryBudget->release(fragData->memoryBytes);
+	m_MemoryBytes -= fragData->memoryBytes;
+	fragData->memoryBytes = 0;
+	m_EvictionList.remove(fragData->evictionId);
+	fragData->evictionId = EvictionList::InvalidItemId;
+}
+
+void IPReassembly::collectMetrics(MetricsWriter& writer)
+{
+	writer.addCounter("pcpp_ip_reassembly_fragments_total", "IP fragments processed", m_NumOfFragmentsProcessed);
+	writer.addCounter("pcpp_ip_reassembly_reassembled_packets_total", "IP packets fully reassembled", m_NumOfPacketsReassembled);
+	writer.addCounter("pcpp_ip_reassembly_malformed_fragments_total", "Malformed IP fragments processed", m_NumOfMalformedFragments);
+	writer.addGauge("pcpp_ip_reassembly_pending_packets", "IP packets currently being reassembled", (double)m_PacketIndex.getSize());
+	writer.addCounter("pcpp_ip_reassembly_capacity_dropped_packets_total", "IP packets dropped because the maximum number of packets was reached", m_NumOfPacketsDroppedAtCapacity);
+	writer.addCounter("pcpp_ip_reassembly_evicted_packets_total", "IP packets dropped because the memory budget was exceeded", m_NumOfEvictedPackets);
+	writer.addCounter("pcpp_ip_reassembly_expired_packets_total", "IP packets dropped because their reassembly timeout passed", m_NumOfExpiredPackets);
+	writer.addGauge("pcpp_ip_reassembly_memory_bytes", "Memory taken by the IP packets being reassembled", (double)m_MemoryBytes);
+}
+
+void IPReassembly::dropPacket(IPFragmentData* fragData)
+{
+	releaseMemory(fragData);
+	erasePacket(fragData->hash);
+
+	// fire callback if not null. The key is valid until the IPFragmentData object is reused
+	if (m_OnFragmentsCleanCallback != NULL)
+	{
+		m_OnFragmentsCleanCallback(fragData->packetKey, m_CallbackUserCookie);
+	}
+
+	freeFragmentData(fragData);
+}
 
-		// fire callback if not null
-		if (m_OnFragmentsCleanCallback != NULL)
+void IPReassembly::setMemoryBudget(MemoryBudget* budget)
+{
+	if (budget == NULL)
+		budget = &m_OwnMemoryBudget;
+
+	if (budget == m_MemoryBudget)
+		return;
+
+	m_MemoryBudget->release(m_MemoryBytes);
+	budget->charge(m_MemoryBytes);
+	m_MemoryBudget = budget;
+
+	evictPackets();
+}
+
+void IPReassembly::evictPackets()
+{
+	uint64_t hash;
+	while (m_MemoryBudget->isExceeded() && m_EvictionList.getVictim(hash))
+	{
+		IPFragmentData* fragData = findPacket((uint32_t)hash);
+		if (fragData == NULL)
 		{
-			m_OnFragmentsCleanCallback(key, m_CallbackUserCookie);
+			LOG_ERROR("Cannot evict packet with hash 0x%X: cannot find packet", (uint32_t)hash);
+			return;
 		}
 
-		delete key;
-		delete packetRemoved;
+		LOG_DEBUG("Memory budget exceeded, removing data for FragID=0x%X", fragData->fragmentID);
+		m_NumOfEvictedPackets++;
+		m_MemoryBudget->countEviction(fragData->memoryBytes);
+		m_PacketLRU->eraseElement((uint32_t)hash);
+		dropPacket(fragData);
 	}
+}
+
+void IPReassembly::setCurrentTime(time_t currentTime)
+{
+	// time only moves forward, and the timers have a resolution of a second
+	if (currentTime <= m_CurrentTime)
+		return;
+
+	m_CurrentTime = currentTime;
+	if (m_FragmentTimeout == 0)
+		return;
+
+	m_ExpiryTimers.advance((uint64_t)currentTime);
 
-	// add the new fragment to the map
-	std::pair<uint32_t, IPFragmentData*> pair(hash, fragData);
-	m_FragmentMap.insert(pair);
+	uint64_t hash;
+	while (m_ExpiryTimers.popExpired(hash))
+	{
+		IPFragmentData* fragData = findPacket((uint32_t)hash);
+		if (fragData == NULL)
+			continue;
+
+		// the timer was already removed from the wheel
+		fragData->timerId = TimerWheel::InvalidTimerId;
+
+		LOG_DEBUG("Reassembly timeout passed, removing data for FragID=0x%X", fragData->fragmentID);
+		m_NumOfExpiredPackets++;
+		m_PacketLRU->eraseElement((uint32_t)hash);
+		dropPacket(fragData);
+	}
 }
 
 bool IPReassembly::matchOutOfOrderFragments(IPFragmentData* fragData)
@@ -615,23 +1260,20 @@ bool IPReassembly::matchOutOfOrderFragments(IPFragmentData* fragData)
 	{
 		bool foundOutOfOrderFrag = false;
 
-		int index = 0;
+		size_t index = 0;
 
 		// go over all fragment in the out-of-order list
-		while (index < (int)fragData->outOfOrderFragments.size())
+		while (index < fragData->outOfOrderFragments.size())
 		{
 			// get the current fragment from the out-of-order list
-			IPFragment* frag = fragData->outOfOrderFragments.at(index);
+			IPFragment& frag = fragData->outOfOrderFragments[index];
 
-			// this fragment is exactly the one we're looking for
-			if (fragData->currentOffset == frag->fragmentOffset)
+			// this fragment is exactly the one we're looking for. Its data is already in place, only the expected offset moves past it
+			if (fragData->currentOffset == frag.fragmentOffset)
 			{
-				// add it to the reassembled packet
-				LOG_DEBUG("[FragID=0x%X] Found the next matching fragment in out-of-order list with offset %d, adding its data to reassembled packet", fragData->fragmentID, (int)frag->fragmentOffset);
-				fragData->data->reallocateData(fragData->data->getRawDataLen() + frag->fragmentDataLen);
-				fragData->data->appendData(frag->fragmentData, frag->fragmentDataLen);
-				fragData->currentOffset += frag->fragmentDataLen;
-				if (frag->lastFragment) // if this is the last fragment of the packet
+				LOG_DEBUG("[FragID=0x%X] Found the next matching fragment in out-of-order list with offset %d", fragData->fragmentID, (int)frag.fragmentOffset);
+				fragData->currentOffset += frag.fragmentDataLen;
+				if (frag.lastFragment) // if this is the last fragment of the packet
 				{
 					LOG_DEBUG("[FragID=0x%X] Found last fragment inside out-of-order list", fragData->fragmentID);
 					foundLastSgement = true;
@@ -659,4 +1301,233 @@ bool IPReassembly::matchOutOfOrderFragments(IPFragmentData* fragData)
 	return foundLastSgement;
 }
 
+
+void IPReassembly::saveState(CheckpointWriter& writer) const
+{
+	writer.writeUInt32(CheckpointMagic);
+	writer.writeUInt16(CheckpointVersion);
+	writer.writeUInt64((uint64_t)m_CurrentTime);
+	writer.writeUInt32((uint32_t)m_PacketIndex.getSize());
+
+	// most of a checkpoint is the data of the reassembly buffers, which is at most the memory charged for them
+	writer.reserve(m_MemoryBytes);
+
+	for (size_t i = 0; i < m_PacketIndex.getNumOfSlots(); i++)
+	{
+		const IPFragmentData* fragData = m_PacketIndex.getSlot(i).fragData;
+		if (fragData == NULL)
+			continue;
+
+		if (fragData->packetKey->getProtocolType() == IPv4)
+		{
+			writer.writeUInt8(4);
+			writer.writeUInt32(fragData->ipv4Key.getIpID());
+			writer.writeIPAddress(fragData->ipv4Key.getSrcIP());
+			writer.writeIPAddress(fragData->ipv4Key.getDstIP());
+		}
+		else
+		{
+			writer.writeUInt8(6);
+			writer.writeUInt32(fragData->ipv6Key.getFragmentID());
+			writer.writeIPAddress(fragData->ipv6Key.getSrcIP());
+			writer.writeIPAddress(fragData->ipv6Key.getDstIP());
+		}
+
+		writer.writeUInt8(fragData->gotFirstFragment ? 1 : 0);
+		writer.writeUInt32((uint32_t)fragData->headerLen);
+		writer.writeUInt32(fragData->currentOffset);
+		writer.writeUInt64(fragData->timerId != TimerWheel::InvalidTimerId ? m_ExpiryTimers.getExpiryTick(fragData->timerId) : 0);
+
+		// the reassembly buffer, including the gaps of fragments which didn't arrive yet so the out-of-order fragments stay at their offsets
+		const ReassemblyBuffer* data = fragData->data;
+		writer.writeUInt32(data != NULL ? (uint32_t)data->getRawDataLen() : 0);
+		if (data != NULL)
+		{
+			timespec timestamp = data->getPacketTimeStampNs();
+			writer.writeUInt64((uint64_t)timestamp.tv_sec);
+			writer.writeUInt32((uint32_t)timestamp.tv_nsec);
+			writer.writeUInt16((uint16_t)data->getLinkLayerType());
+			writer.writeBytes(data->getRawData(), data->getRawDataLen());
+		}
+
+		writer.writeUInt32((uint32_t)fragData->outOfOrderFragments.size());
+		for (std::vector<IPFragment>::const_iterator iter = fragData->outOfOrderFragments.begin(); iter != fragData->outOfOrderFragments.end(); iter++)
+		{
+			writer.writeUInt32(iter->fragmentOffset);
+			writer.writeUInt32(iter->fragmentDataLen);
+			writer.writeUInt8(iter->lastFragment ? 1 : 0);
+		}
+	}
+}
+
+bool IPReassembly::saveState(const std::string& fileName) const
+{
+	std::vector<uint8_t> checkpoint;
+	CheckpointWriter writer(checkpoint);
+	saveState(writer);
+
+	if (!writeCheckpointFile(fileName, checkpoint))
+	{
+		LOG_ERROR("Cannot write the checkpoint file '%s'", fileName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool IPReassembly::restoreState(CheckpointReader& reader)
+{
+	if (m_PacketIndex.getSize() != 0)
+	{
+		LOG_ERROR("Cannot restore the state of packets to an instance which already reassembles packets");
+		return false;
+	}
+
+	// the checkpoint is read once to validate it before anything is changed, and a second time to build the state
+	CheckpointReader validationReader = reader;
+	uint32_t magic = validationReader.readUInt32();
+	uint16_t version = validationReader.readUInt16();
+	uint64_t currentTime = validationReader.readUInt64();
+	uint32_t numOfPackets = validationReader.readUInt32();
+	if (!validationReader.isValid() || magic != CheckpointMagic || version != CheckpointVersion)
+	{
+		LOG_ERROR("The checkpoint doesn't contain an IPReassembly state of a supported version");
+		return false;
+	}
+
+	readPackets(validationReader, numOfPackets, false);
+	if (!validationReader.isValid())
+	{
+		LOG_ERROR("The IPReassembly state in the checkpoint is truncated or corrupted");
+		return false;
+	}
+
+	// move the time and the timers to when the state was saved so the saved expiry times stay in the future
+	setCurrentTime((time_t)currentTime);
+
+	// size the table and the LRU list for all packets at once, so building the state doesn't rehash or grow them per packet
+	m_PacketIndex.reserve(numOfPackets);
+	m_PacketLRU->reserve(numOfPackets);
+
+	reader.readUInt32();
+	reader.readUInt16();
+	reader.readUInt64();
+	reader.readUInt32();
+	readPackets(reader, numOfPackets, true);
+
+	// the saved state may not fit in the budget of this instance
+	evictPackets();
+
+	return true;
+}
+
+bool IPReassembly::restoreState(const std::string& fileName)
+{
+	std::vector<uint8_t> checkpoint;
+	if (!readCheckpointFile(fileName, checkpoint))
+	{
+		LOG_ERROR("Cannot read the checkpoint file '%s'", fileName.c_str());
+		return false;
+	}
+
+	CheckpointReader reader(checkpoint.empty() ? NULL : &checkpoint[0], checkpoint.size());
+	return restoreState(reader);
+}
+
+void IPReassembly::readPackets(CheckpointReader& reader, uint32_t numOfPackets, bool build)
+{
+	for (uint32_t i = 0; i < numOfPackets && reader.isValid(); i++)
+	{
+		uint8_t ipVersion = reader.readUInt8();
+		uint32_t fragmentID = reader.readUInt32();
+		IPAddressValue srcIP = reader.readIPAddress();
+		IPAddressValue dstIP = reader.readIPAddress();
+		uint8_t gotFirstFragment = reader.readUInt8();
+		uint32_t headerLen = reader.readUInt32();
+		uint32_t currentOffset = reader.readUInt32();
+		uint64_t timerExpiry = reader.readUInt64();
+		uint32_t dataLen = reader.readUInt32();
+
+		timespec timestamp;
+		timestamp.tv_sec = 0;
+		timestamp.tv_nsec = 0;
+		LinkLayerType linkLayerType = LINKTYPE_ETHERNET;
+		const uint8_t* data = NULL;
+		if (dataLen > 0)
+		{
+			timestamp.tv_sec = (time_t)reader.readUInt64();
+			timestamp.tv_nsec = (long)reader.readUInt32();
+			linkLayerType = (LinkLayerType)reader.readUInt16();
+			data = reader.readBytes(dataLen);
+		}
+
+		bool validVersion = (ipVersion == 4 && srcIP.isIPv4() && dstIP.isIPv4() && fragmentID <= 0xFFFF) ||
+				(ipVersion == 6 && srcIP.isIPv6() && dstIP.isIPv6());
+		if (!validVersion || gotFirstFragment > 1 || (gotFirstFragment && dataLen == 0) || (uint64_t)headerLen + currentOffset > dataLen)
+			reader.setFailed();
+
+		std::vector<IPFragment> outOfOrderFragments;
+		uint32_t numOfFragments = reader.readUInt32();
+		for (uint32_t j = 0; j < numOfFragments && reader.isValid(); j++)
+		{
+			IPFragment frag;
+			frag.fragmentOffset = reader.readUInt32();
+			frag.fragmentDataLen = reader.readUInt32();
+			uint8_t lastFragment = reader.readUInt8();
+			frag.lastFragment = (lastFragment != 0);
+
+			// the data of an out-of-order fragment is in the reassembly buffer after the data received in order
+			if (lastFragment > 1 || frag.fragmentOffset <= currentOffset || (uint64_t)headerLen + frag.fragmentOffset + frag.fragmentDataLen > dataLen)
+				reader.setFailed();
+
+			if (build)
+				outOfOrderFragments.push_back(frag);
+		}
+
+		if (!build || !reader.isValid())
+			continue;
+
+		IPv4PacketKey ipv4Key((uint16_t)fragmentID, srcIP, dstIP);
+		IPv6PacketKey ipv6Key(fragmentID, srcIP, dstIP);
+		uint32_t hash = (ipVersion == 4 ? ipv4Key.getHashValue() : ipv6Key.getHashValue());
+
+		// a packet whose hash appears twice is kept once, like two packets with the same hash while reassembling
+		if (findPacket(hash) != NULL)
+		{
+			LOG_DEBUG("Packet with FragID=0x%X appears in the checkpoint more than once, keeping its first state", fragmentID);
+			continue;
+		}
+
+		IPFragmentData* newFragData = allocateFragmentData();
+		newFragData->fragmentID = fragmentID;
+		newFragData->hash = hash;
+		if (ipVersion == 4)
+		{
+			newFragData->ipv4Key = ipv4Key;
+			newFragData->packetKey = &newFragData->ipv4Key;
+		}
+		else
+		{
+			newFragData->ipv6Key = ipv6Key;
+			newFragData->packetKey = &newFragData->ipv6Key;
+		}
+		newFragData->gotFirstFragment = (gotFirstFragment != 0);
+		newFragData->headerLen = headerLen;
+		newFragData->currentOffset = currentOffset;
+		newFragData->outOfOrderFragments = outOfOrderFragments;
+		if (data != NULL)
+		{
+			newFragData->data = new ReassemblyBuffer(timestamp, linkLayerType);
+			newFragData->data->reserve(dataLen, m_RawPacketPool);
+			newFragData->data->write(0, data, dataLen);
+		}
+
+		addNewFragment(hash, newFragData);
+
+		// the timeout still counts from the first fragment which arrived before the checkpoint
+		if (timerExpiry != 0 && newFragData->timerId != TimerWheel::InvalidTimerId)
+			m_ExpiryTimers.rescheduleTimer(newFragData->timerId, timerExpiry);
+	}
+}
+
 }
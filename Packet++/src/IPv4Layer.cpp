@@ -8,8 +8,8 @@
 #include "IcmpLayer.h"
 #include "GreLayer.h"
 #include "IgmpLayer.h"
+#include "ProtocolRegistry.h"
 #include <string.h>
-#include <sstream>
 #include "IpUtils.h"
 #include "Logger.h"
 
@@ -124,34 +124,41 @@ IPv4OptionBuilder::IPv4OptionBuilder(const IPv4TimestampOptionValue& timestampVa
 	m_BuilderParamsValid = true;
 }
 
-IPv4Option IPv4OptionBuilder::build() const
+size_t IPv4OptionBuilder::getRecordSize() const
 {
 	if (!m_BuilderParamsValid)
-		return IPv4Option(NULL);
-
-	size_t optionSize = m_RecValueLen + 2*sizeof(uint8_t);
+		return 0;
 
 	if ((m_RecType == (uint8_t)IPV4OPT_NOP || m_RecType == (uint8_t)IPV4OPT_EndOfOtionsList))
 	{
 		if (m_RecValueLen != 0)
 		{
 			LOG_ERROR("Can't set IPv4 NOP option or IPv4 End-of-options option with size different than 0, tried to set size %d", (int)m_RecValueLen);
-			return IPv4Option(NULL);
+			return 0;
 		}
 
-		optionSize = sizeof(uint8_t);
+		return sizeof(uint8_t);
 	}
 
-	uint8_t* recordBuffer = new uint8_t[optionSize];
-	memset(recordBuffer, 0, optionSize);
-	recordBuffer[0] = m_RecType;
-	if (optionSize > 1)
-	{
-		recordBuffer[1] = (uint8_t)optionSize;
-		if (optionSize > 2 && m_RecValue != NULL)
-			memcpy(recordBuffer+2, m_RecValue, m_RecValueLen);
-	}
+	return m_RecValueLen + 2*sizeof(uint8_t);
+}
+
+IPv4Option IPv4OptionBuilder::build() const
+{
+	size_t optionSize = getRecordSize();
+	if (optionSize == 0)
+		return IPv4Option(NULL);
+
+	return build(new uint8_t[optionSize]);
+}
+
+IPv4Option IPv4OptionBuilder::build(uint8_t* recordBuffer) const
+{
+	size_t optionSize = getRecordSize();
+	if (optionSize == 0 || recordBuffer == NULL)
+		return IPv4Option(NULL);
 
+	writeRecord(recordBuffer, optionSize, (uint8_t)optionSize);
 	return IPv4Option(recordBuffer);
 }
 
@@ -249,60 +256,142 @@ void IPv4Layer::parseNextLayer()
 	// TODO: assuming first fragment contains at least L4 header, what if it's not true?
 	if (isFragment())
 	{
-		m_NextLayer = new PayloadLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		return;
 	}
 
-	switch (ipHdr->protocol)
+	switch (ProtocolRegistry::getInstance().getProtocolByIPProtocol(ipHdr->protocol))
 	{
-	case PACKETPP_IPPROTO_UDP:
+	case UDP:
 		if (m_DataLen - hdrLen >= sizeof(udphdr))
-			m_NextLayer = new UdpLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) UdpLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		break;
-	case PACKETPP_IPPROTO_TCP:
+	case TCP:
 		if (m_DataLen - hdrLen >= sizeof(tcphdr))
-			m_NextLayer = new TcpLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) TcpLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		break;
-	case PACKETPP_IPPROTO_ICMP:
-		m_NextLayer = new IcmpLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+	case ICMP:
+		m_NextLayer = new(m_Packet) IcmpLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		break;
-	case PACKETPP_IPPROTO_IPIP:
+	case IPv4:
 		ipVersion = *(m_Data + hdrLen);
 		if (ipVersion >> 4 == 4)
-			m_NextLayer = new IPv4Layer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) IPv4Layer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		else if (ipVersion >> 4 == 6)
-			m_NextLayer = new IPv6Layer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) IPv6Layer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		else
-			m_NextLayer = new PayloadLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) PayloadLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		break;
-	case PACKETPP_IPPROTO_GRE:
+	case GRE:
 		greVer = GreLayer::getGREVersion(m_Data + hdrLen, m_DataLen - hdrLen);
 		if (greVer == GREv0)
-			m_NextLayer = new GREv0Layer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) GREv0Layer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		else if (greVer == GREv1)
-			m_NextLayer = new GREv1Layer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) GREv1Layer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		else
-			m_NextLayer = new PayloadLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) PayloadLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		break;
-	case PACKETPP_IPPROTO_IGMP:
+	case IGMP:
 		igmpVer = IgmpLayer::getIGMPVerFromData(m_Data + hdrLen, ntohs(getIPv4Header()->totalLength) - hdrLen, igmpQuery);
 		if (igmpVer == IGMPv1)
-			m_NextLayer = new IgmpV1Layer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) IgmpV1Layer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		else if (igmpVer == IGMPv2)
-			m_NextLayer = new IgmpV2Layer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) IgmpV2Layer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		else if (igmpVer == IGMPv3)
 		{
 			if (igmpQuery)
-				m_NextLayer = new IgmpV3QueryLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+				m_NextLayer = new(m_Packet) IgmpV3QueryLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 			else
-				m_NextLayer = new IgmpV3ReportLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+				m_NextLayer = new(m_Packet) IgmpV3ReportLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		}
 		else
-			m_NextLayer = new PayloadLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) PayloadLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
 		break;
 	default:
-		m_NextLayer = new PayloadLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + hdrLen, m_DataLen - hdrLen, this, m_Packet);
+		return;
+	}
+}
+
+void IPv4Layer::setSrcIpAddress(const IPv4Address& ipAddr, bool updateChecksums)
+{
+	iphdr* ipHdr = getIPv4Header();
+	uint32_t newAddr = ipAddr.toInt();
+	if (updateChecksums)
+		updateChecksumsForAddress(ipHdr->ipSrc, newAddr);
+	else
+		markModifiedForAddress();
+
+	ipHdr->ipSrc = newAddr;
+}
+
+void IPv4Layer::setDstIpAddress(const IPv4Address& ipAddr, bool updateChecksums)
+{
+	iphdr* ipHdr = getIPv4Header();
+	uint32_t newAddr = ipAddr.toInt();
+	if (updateChecksums)
+		updateChecksumsForAddress(ipHdr->ipDst, newAddr);
+	else
+		markModifiedForAddress();
+
+	ipHdr->ipDst = newAddr;
+}
+
+void IPv4Layer::setTimeToLive(uint8_t ttl, bool updateChecksum)
+{
+	iphdr* ipHdr = getIPv4Header();
+	if (updateChecksum)
+	{
+		// TTL shares a 16-bit word with the protocol field
+		uint8_t oldWord[2] = { ipHdr->timeToLive, ipHdr->protocol };
+		uint8_t newWord[2] = { ttl, ipHdr->protocol };
+		uint16_t oldValue, newValue;
+		memcpy(&oldValue, oldWord, sizeof(oldValue));
+		memcpy(&newValue, newWord, sizeof(newValue));
+		ipHdr->headerChecksum = update_checksum(ipHdr->headerChecksum, oldValue, newValue);
+	}
+	else
+	{
+		setModified();
+	}
+
+	ipHdr->timeToLive = ttl;
+}
+
+void IPv4Layer::markModifiedForAddress()
+{
+	// the TCP/UDP pseudo-header contains the addresses, so the checksum of the next layer needs to be computed as well
+	setModified();
+	Layer* nextLayer = getNextLayer();
+	if (nextLayer != NULL)
+		nextLayer->setModified();
+}
+
+void IPv4Layer::updateChecksumsForAddress(uint32_t oldAddr, uint32_t newAddr)
+{
+	iphdr* ipHdr = getIPv4Header();
+	ipHdr->headerChecksum = update_checksum(ipHdr->headerChecksum, oldAddr, newAddr);
+
+	// the TCP/UDP pseudo-header contains the addresses
+	Layer* nextLayer = getNextLayer();
+	if (nextLayer == NULL)
 		return;
+
+	if (nextLayer->getProtocol() == TCP && nextLayer->getDataLen() >= sizeof(tcphdr))
+	{
+		tcphdr* tcpHdr = ((TcpLayer*)nextLayer)->getTcpHeader();
+		tcpHdr->headerChecksum = update_checksum(tcpHdr->headerChecksum, oldAddr, newAddr);
+	}
+	else if (nextLayer->getProtocol() == UDP && nextLayer->getDataLen() >= sizeof(udphdr))
+	{
+		udphdr* udpHdr = ((UdpLayer*)nextLayer)->getUdpHeader();
+		// a zero UDP checksum means the checksum isn't used
+		if (udpHdr->headerChecksum == 0)
+			return;
+
+		udpHdr->headerChecksum = update_checksum(udpHdr->headerChecksum, oldAddr, newAddr);
+		if (udpHdr->headerChecksum == 0)
+			udpHdr->headerChecksum = 0xffff;
 	}
 }
 
@@ -313,9 +402,9 @@ void IPv4Layer::computeCalculateFields()
 	ipHdr->totalLength = htons(m_DataLen);
 	ipHdr->headerChecksum = 0;
 
-	if (m_NextLayer != NULL)
+	if (getNextLayer() != NULL)
 	{
-		switch (m_NextLayer->getProtocol())
+		switch (getNextLayer()->getProtocol())
 		{
 		case TCP:
 			ipHdr->protocol = PACKETPP_IPPROTO_TCP;
@@ -371,23 +460,33 @@ uint16_t IPv4Layer::getFragmentOffset()
 
 std::string IPv4Layer::toString()
 {
-	std::string fragmet = "";
+	return PacketDumpWriter::layerToString(*this);
+}
+
+void IPv4Layer::dump(PacketDumpWriter& writer)
+{
+	writer.beginLayer("IPv4 Layer", IPv4);
 	if (isFragment())
 	{
 		if (isFirstFragment())
-			fragmet = "First fragment";
+			writer.addText("First fragment");
 		else if (isLastFragment())
-			fragmet = "Last fragment";
+			writer.addText("Last fragment");
 		else
-			fragmet = "Fragment";
+			writer.addText("Fragment");
 
-		std::stringstream sstm;
-		sstm << fragmet << " [offset= " << getFragmentOffset() << "], ";
-		fragmet = sstm.str();
+		writer.appendText(" [offset= ");
+		writer.appendNumber(getFragmentOffset());
+		writer.appendText("]");
+		writer.addNumber(NULL, "fragmentOffset", getFragmentOffset());
 	}
 
-
-	return "IPv4 Layer, " + fragmet + "Src: " + getSrcIpAddress().toString() + ", Dst: " + getDstIpAddress().toString();
+	writer.addIPAddress("Src", "src", getSrcIpAddress());
+	writer.addIPAddress("Dst", "dst", getDstIpAddress());
+	writer.addNumber(NULL, "protocol", getIPv4Header()->protocol);
+	writer.addNumber(NULL, "ttl", getIPv4Header()->timeToLive);
+	writer.addNumber(NULL, "id", ntohs(getIPv4Header()->ipId));
+	writer.endLayer();
 }
 
 IPv4Option IPv4Layer::getOption(IPv4OptionTypes option)
@@ -434,31 +533,26 @@ void IPv4Layer::adjustOptionsTrailer(size_t totalOptSize)
 
 IPv4Option IPv4Layer::addOptionAt(const IPv4OptionBuilder& optionBuilder, int offset)
 {
-	IPv4Option newOption = optionBuilder.build();
-	if (newOption.isNull())
-		return newOption;
-
-	size_t sizeToExtend = newOption.getTotalSize();
+	size_t sizeToExtend = optionBuilder.getRecordSize();
+	if (sizeToExtend == 0)
+		return IPv4Option(NULL);
 
 	size_t totalOptSize = getHeaderLen() - sizeof(iphdr) - m_NumOfTrailingBytes + sizeToExtend;
 
 	if (totalOptSize > IPV4_MAX_OPT_SIZE)
 	{
 		LOG_ERROR("Cannot add option - adding this option will exceed IPv4 total option size which is %d", IPV4_MAX_OPT_SIZE);
-		newOption.purgeRecordData();
 		return IPv4Option(NULL);
 	}
 
 	if (!extendLayer(offset, sizeToExtend))
 	{
 		LOG_ERROR("Could not extend IPv4Layer in [%d] bytes", (int)sizeToExtend);
-		newOption.purgeRecordData();
 		return IPv4Option(NULL);
 	}
 
-	memcpy(m_Data + offset, newOption.getRecordBasePtr(), newOption.getTotalSize());
-
-	newOption.purgeRecordData();
+	// the option is written directly into the space made for it
+	optionBuilder.build(m_Data + offset);
 
 	// setting this m_TempHeaderExtension because adjustOptionsTrailer() may extend or shorten the layer and the extend or shorten methods need to know the accurate
 	// current size of the header. m_TempHeaderExtension will be added to the length extracted from getIPv4Header()->internetHeaderLength as the temp new size
@@ -103,23 +103,26 @@ uint16_t IPv6FragmentationHeader::getFragmentOffset()
 // IPv6TLVOptionBuilder
 // ====================
 
-IPv6TLVOptionHeader::IPv6Option IPv6TLVOptionHeader::IPv6TLVOptionBuilder::build() const
+size_t IPv6TLVOptionHeader::IPv6TLVOptionBuilder::getRecordSize() const
 {
 	size_t optionTotalSize = sizeof(uint8_t);
 	if (m_RecType != IPv6TLVOptionHeader::IPv6Option::Pad0OptionType)
 		optionTotalSize += sizeof(uint8_t) + m_RecValueLen;
 
-	uint8_t* recordBuffer = new uint8_t[optionTotalSize];
-	memset(recordBuffer, 0, optionTotalSize);
+	return optionTotalSize;
+}
 
-	if (m_RecType != IPv6TLVOptionHeader::IPv6Option::Pad0OptionType)
-	{
-		recordBuffer[0] = m_RecType;
-		recordBuffer[1] = m_RecValueLen;
-		if (m_RecValueLen > 0)
-			memcpy(recordBuffer+2, m_RecValue, m_RecValueLen);
-	}
+IPv6TLVOptionHeader::IPv6Option IPv6TLVOptionHeader::IPv6TLVOptionBuilder::build() const
+{
+	return build(new uint8_t[getRecordSize()]);
+}
+
+IPv6TLVOptionHeader::IPv6Option IPv6TLVOptionHeader::IPv6TLVOptionBuilder::build(uint8_t* recordBuffer) const
+{
+	if (recordBuffer == NULL)
+		return IPv6Option(NULL);
 
+	writeRecord(recordBuffer, getRecordSize(), (uint8_t)m_RecValueLen);
 	return IPv6Option(recordBuffer);
 }
 
@@ -155,11 +158,7 @@ IPv6TLVOptionHeader::IPv6TLVOptionHeader(const std::vector<IPv6TLVOptionBuilder>
 	size_t totalSize = sizeof(uint16_t); // nextHeader + headerLen
 
 	for (std::vector<IPv6TLVOptionBuilder>::const_iterator iter = options.begin(); iter != options.end(); iter++)
-	{
-		IPv6Option option = iter->build();
-		totalSize += option.getTotalSize();
-		option.purgeRecordData();
-	}
+		totalSize += iter->getRecordSize();
 
 	while (totalSize % 8 != 0)
 		totalSize++;
@@ -173,10 +172,8 @@ IPv6TLVOptionHeader::IPv6TLVOptionHeader(const std::vector<IPv6TLVOptionBuilder>
 
 	for (std::vector<IPv6TLVOptionBuilder>::const_iterator iter = options.begin(); iter != options.end(); iter++)
 	{
-		IPv6Option option = iter->build();
-		memcpy((uint8_t*)(getDataPtr() + offset), option.getRecordBasePtr(), option.getTotalSize());
-		offset += option.getTotalSize();
-		option.purgeRecordData();
+		iter->build((uint8_t*)(getDataPtr() + offset));
+		offset += iter->getRecordSize();
 	}
 }
 
@@ -7,6 +7,7 @@
 #include "TcpLayer.h"
 #include "GreLayer.h"
 #include "Packet.h"
+#include "ProtocolRegistry.h"
 #include <string.h>
 #include "IpUtils.h"
 
@@ -21,6 +22,7 @@ void IPv6Layer::initLayer()
 	m_FirstExtension = NULL;
 	m_LastExtension = NULL;
 	m_ExtensionsLen = 0;
+	m_NumOfExtensions = 0;
 	memset(m_Data, 0, sizeof(ip6_hdr));
 }
 
@@ -30,6 +32,7 @@ IPv6Layer::IPv6Layer(uint8_t* data, size_t dataLen, Layer* prevLayer, Packet* pa
 	m_FirstExtension = NULL;
 	m_LastExtension = NULL;
 	m_ExtensionsLen = 0;
+	m_NumOfExtensions = 0;
 
 	parseExtensions();
 
@@ -56,6 +59,7 @@ IPv6Layer::IPv6Layer(const IPv6Layer& other) : Layer(other)
 	m_FirstExtension = NULL;
 	m_LastExtension = NULL;
 	m_ExtensionsLen = 0;
+	m_NumOfExtensions = 0;
 	parseExtensions();
 }
 
@@ -75,70 +79,129 @@ IPv6Layer& IPv6Layer::operator=(const IPv6Layer& other)
 	return *this;
 }
 
+uint8_t IPv6Layer::walkExtensions(const uint8_t* data, size_t dataLen, size_t& headerLen, size_t& numOfExtensions,
+		uint8_t* extensionTypes, uint16_t* extensionOffsets)
+{
+	uint8_t nextHdr = ((const ip6_hdr*)data)->nextHeader;
+	headerLen = sizeof(ip6_hdr);
+	numOfExtensions = 0;
+
+	// every extension starts with the next header and length fields
+	while (numOfExtensions < MaxExtensions && headerLen + 2 <= dataLen)
+	{
+		const uint8_t* extension = data + headerLen;
+		size_t extensionLen = 0;
+
+		switch (nextHdr)
+		{
+		case PACKETPP_IPPROTO_FRAGMENT:
+			extensionLen = sizeof(IPv6FragmentationHeader::ipv6_frag_header);
+			break;
+		case PACKETPP_IPPROTO_HOPOPTS:
+		case PACKETPP_IPPROTO_DSTOPTS:
+		case PACKETPP_IPPROTO_ROUTING:
+			extensionLen = 8 * (extension[1] + 1);
+			break;
+		case PACKETPP_IPPROTO_AH:
+			extensionLen = 4 * (extension[1] + 2);
+			break;
+		default:
+			return nextHdr;
+		}
+
+		extensionTypes[numOfExtensions] = nextHdr;
+		extensionOffsets[numOfExtensions] = (uint16_t)headerLen;
+		numOfExtensions++;
+
+		headerLen += extensionLen;
+		nextHdr = extension[0];
+	}
+
+	return nextHdr;
+}
+
+bool IPv6Layer::findUpperLayerProtocol(const uint8_t* data, size_t dataLen, uint8_t& protocol, size_t& headerLen, size_t& fragmentHeaderOffset)
+{
+	fragmentHeaderOffset = 0;
+	if (data == NULL || dataLen < sizeof(ip6_hdr))
+		return false;
+
+	size_t numOfExtensions = 0;
+	uint8_t extensionTypes[MaxExtensions];
+	uint16_t extensionOffsets[MaxExtensions];
+	protocol = walkExtensions(data, dataLen, headerLen, numOfExtensions, extensionTypes, extensionOffsets);
+
+	for (size_t i = 0; i < numOfExtensions; i++)
+	{
+		if (extensionTypes[i] == PACKETPP_IPPROTO_FRAGMENT)
+		{
+			fragmentHeaderOffset = extensionOffsets[i];
+			break;
+		}
+	}
+
+	return true;
+}
+
 void IPv6Layer::parseExtensions()
 {
-	uint8_t nextHdr = getIPv6Header()->nextHeader;
-	IPv6Extension* curExt = NULL;
+	if (m_DataLen < sizeof(ip6_hdr))
+		return;
+
+	size_t headerLen = 0;
+	walkExtensions(m_Data, m_DataLen, headerLen, m_NumOfExtensions, m_ExtensionTypes, m_ExtensionOffsets);
+	m_ExtensionsLen = headerLen - sizeof(ip6_hdr);
+}
 
-	size_t offset = sizeof(ip6_hdr);
+void IPv6Layer::createExtensionObjects()
+{
+	if (m_FirstExtension != NULL)
+		return;
 
-	while (offset <= m_DataLen )
+	for (size_t i = 0; i < m_NumOfExtensions; i++)
 	{
 		IPv6Extension* newExt = NULL;
 
-		switch (nextHdr)
+		switch (m_ExtensionTypes[i])
 		{
 		case PACKETPP_IPPROTO_FRAGMENT:
 		{
-			newExt = new IPv6FragmentationHeader(this, offset);
+			newExt = new IPv6FragmentationHeader(this, m_ExtensionOffsets[i]);
 			break;
 		}
 		case PACKETPP_IPPROTO_HOPOPTS:
 		{
-			newExt = new IPv6HopByHopHeader(this, offset);
+			newExt = new IPv6HopByHopHeader(this, m_ExtensionOffsets[i]);
 			break;
 		}
 		case PACKETPP_IPPROTO_DSTOPTS:
 		{
-			newExt = new IPv6DestinationHeader(this, offset);
+			newExt = new IPv6DestinationHeader(this, m_ExtensionOffsets[i]);
 			break;
 		}
 		case PACKETPP_IPPROTO_ROUTING:
 		{
-			newExt = new IPv6RoutingHeader(this, offset);
+			newExt = new IPv6RoutingHeader(this, m_ExtensionOffsets[i]);
 			break;
 		}
 		case PACKETPP_IPPROTO_AH:
 		{
-			newExt = new IPv6AuthenticationHeader(this, offset);
+			newExt = new IPv6AuthenticationHeader(this, m_ExtensionOffsets[i]);
 			break;
 		}
 		default:
 		{
-			break;
+			continue;
 		}
 		}
 
-		if (newExt == NULL)
-			break;
-
 		if (m_FirstExtension == NULL)
-		{
 			m_FirstExtension = newExt;
-			curExt = m_FirstExtension;
-		}
 		else
-		{
-			curExt->setNextHeader(newExt);
-			curExt = curExt->getNextHeader();
-		}
+			m_LastExtension->setNextHeader(newExt);
 
-		offset += newExt->getExtensionLen();
-		nextHdr = newExt->getBaseHeader()->nextHeader;
-		m_ExtensionsLen += newExt->getExtensionLen();
+		m_LastExtension = newExt;
 	}
-
-	m_LastExtension = curExt;
 }
 
 void IPv6Layer::deleteExtensions()
@@ -154,38 +217,61 @@ void IPv6Layer::deleteExtensions()
 	m_FirstExtension = NULL;
 	m_LastExtension = NULL;
 	m_ExtensionsLen = 0;
-
+	m_NumOfExtensions = 0;
 }
 
-size_t IPv6Layer::getExtensionCount()
+IPv6Extension::IPv6ExtensionType IPv6Layer::getExtensionType(size_t index) const
 {
-	size_t extensionCount = 0;
+	if (index >= m_NumOfExtensions)
+		return IPv6Extension::IPv6ExtensionUnknown;
 
-	IPv6Extension* curExt = m_FirstExtension;
+	return (IPv6Extension::IPv6ExtensionType)m_ExtensionTypes[index];
+}
 
-	while (curExt != NULL)
+IPv6FragmentationHeader::ipv6_frag_header* IPv6Layer::getFragmentationHeader() const
+{
+	for (size_t i = 0; i < m_NumOfExtensions; i++)
 	{
-		extensionCount++;
-		curExt = curExt->getNextHeader();
+		if (m_ExtensionTypes[i] != PACKETPP_IPPROTO_FRAGMENT)
+			continue;
+
+		// the walk accepts an extension as long as its first 2 bytes are in the data
+		if (m_ExtensionOffsets[i] + sizeof(IPv6FragmentationHeader::ipv6_frag_header) > m_DataLen)
+			return NULL;
+
+		return (IPv6FragmentationHeader::ipv6_frag_header*)(m_Data + m_ExtensionOffsets[i]);
 	}
 
-	return extensionCount;
+	return NULL;
+}
+
+uint8_t IPv6Layer::getUpperLayerProtocol() const
+{
+	if (m_NumOfExtensions > 0)
+		return m_Data[m_ExtensionOffsets[m_NumOfExtensions - 1]];
+
+	return ((const ip6_hdr*)m_Data)->nextHeader;
 }
 
 void IPv6Layer::removeAllExtensions()
 {
-	if (m_LastExtension != NULL)
-		getIPv6Header()->nextHeader = m_LastExtension->getBaseHeader()->nextHeader;
+	if (m_NumOfExtensions > 0)
+		getIPv6Header()->nextHeader = getUpperLayerProtocol();
 
 	shortenLayer((int)sizeof(ip6_hdr), m_ExtensionsLen);
 
 	deleteExtensions();
 }
 
-bool IPv6Layer::isFragment()
+bool IPv6Layer::isFragment() const
 {
-	IPv6FragmentationHeader* fragHdr = getExtensionOfType<IPv6FragmentationHeader>();
-	return (fragHdr != NULL);
+	for (size_t i = 0; i < m_NumOfExtensions; i++)
+	{
+		if (m_ExtensionTypes[i] == PACKETPP_IPPROTO_FRAGMENT)
+			return true;
+	}
+
+	return false;
 }
 
 void IPv6Layer::parseNextLayer()
@@ -195,54 +281,46 @@ void IPv6Layer::parseNextLayer()
 	if (m_DataLen <= headerLen)
 		return;
 
-	uint8_t nextHdr = 0;
-	if (m_LastExtension != NULL)
-	{
-		if (m_LastExtension->getExtensionType() == IPv6Extension::IPv6Fragmentation)
-		{
-			m_NextLayer = new PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
-			return;
-		}
-
-		nextHdr = m_LastExtension->getBaseHeader()->nextHeader;
-	}
-	else
+	if (m_NumOfExtensions > 0 && m_ExtensionTypes[m_NumOfExtensions - 1] == PACKETPP_IPPROTO_FRAGMENT)
 	{
-		nextHdr = getIPv6Header()->nextHeader;
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+		return;
 	}
 
+	uint8_t nextHdr = getUpperLayerProtocol();
+
 	ProtocolType greVer = UnknownProtocol;
 
 	uint8_t ipVersion = 0;
 
-	switch (nextHdr)
+	switch (ProtocolRegistry::getInstance().getProtocolByIPProtocol(nextHdr))
 	{
-	case PACKETPP_IPPROTO_UDP:
-		m_NextLayer = new UdpLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	case UDP:
+		m_NextLayer = new(m_Packet) UdpLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
-	case PACKETPP_IPPROTO_TCP:
-		m_NextLayer = new TcpLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	case TCP:
+		m_NextLayer = new(m_Packet) TcpLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
-	case PACKETPP_IPPROTO_IPIP:
+	case IPv4:
 		ipVersion = *(m_Data + headerLen);
 		if (ipVersion >> 4 == 4)
-			m_NextLayer = new IPv4Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) IPv4Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		else if (ipVersion >> 4 == 6)
-			m_NextLayer = new IPv6Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) IPv6Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		else
-			m_NextLayer = new PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
-	case PACKETPP_IPPROTO_GRE:
+	case GRE:
 		greVer = GreLayer::getGREVersion(m_Data + headerLen, m_DataLen - headerLen);
 		if (greVer == GREv0)
-			m_NextLayer = new GREv0Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) GREv0Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		else if (greVer == GREv1)
-			m_NextLayer = new GREv1Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) GREv1Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		else
-			m_NextLayer = new PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
 	default:
-		m_NextLayer = new PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		return;
 	}
 }
@@ -253,10 +331,10 @@ void IPv6Layer::computeCalculateFields()
 	ipHdr->payloadLength = htons(m_DataLen - sizeof(ip6_hdr));
 	ipHdr->ipVersion = (6 & 0x0f);
 
-	if (m_NextLayer != NULL)
+	if (getNextLayer() != NULL)
 	{
 		uint8_t nextHeader = 0;
-		switch (m_NextLayer->getProtocol())
+		switch (getNextLayer()->getProtocol())
 		{
 		case TCP:
 			nextHeader = PACKETPP_IPPROTO_TCP;
@@ -276,8 +354,8 @@ void IPv6Layer::computeCalculateFields()
 
 		if (nextHeader != 0)
 		{
-			if (m_LastExtension != NULL)
-				m_LastExtension->getBaseHeader()->nextHeader = nextHeader;
+			if (m_NumOfExtensions > 0)
+				m_Data[m_ExtensionOffsets[m_NumOfExtensions - 1]] = nextHeader;
 			else
 				ipHdr->nextHeader = nextHeader;
 
@@ -287,45 +365,52 @@ void IPv6Layer::computeCalculateFields()
 
 std::string IPv6Layer::toString()
 {
-	std::string result = "IPv6 Layer, Src: " + getSrcIpAddress().toString() + ", Dst: " + getDstIpAddress().toString();
+	return PacketDumpWriter::layerToString(*this);
+}
+
+void IPv6Layer::dump(PacketDumpWriter& writer)
+{
+	writer.beginLayer("IPv6 Layer", IPv6);
+	writer.addIPAddress("Src", "src", getSrcIpAddress());
+	writer.addIPAddress("Dst", "dst", getDstIpAddress());
+	writer.addNumber(NULL, "nextHeader", getIPv6Header()->nextHeader);
+	writer.addNumber(NULL, "hopLimit", getIPv6Header()->hopLimit);
 	if (m_ExtensionsLen > 0)
 	{
-		result += ", Options=[";
-		IPv6Extension* curExt = m_FirstExtension;
-		while (curExt != NULL)
+		writer.addText("Options=[");
+		for (size_t i = 0; i < m_NumOfExtensions; i++)
 		{
-			switch (curExt->getExtensionType())
+			if (i > 0)
+				writer.appendText(",");
+
+			switch (getExtensionType(i))
 			{
 			case IPv6Extension::IPv6Fragmentation:
-				result += "Fragment,";
+				writer.appendText("Fragment");
 				break;
 			case IPv6Extension::IPv6HopByHop:
-				result += "Hop-By-Hop,";
+				writer.appendText("Hop-By-Hop");
 				break;
 			case IPv6Extension::IPv6Destination:
-				result += "Destination,";
+				writer.appendText("Destination");
 				break;
 			case IPv6Extension::IPv6Routing:
-				result += "Routing,";
+				writer.appendText("Routing");
 				break;
 			case IPv6Extension::IPv6AuthenticationHdr:
-				result += "Authentication,";
+				writer.appendText("Authentication");
 				break;
 			default:
-				result += "Unknown,";
+				writer.appendText("Unknown");
 				break;
 			}
-
-			curExt = curExt->getNextHeader();
 		}
 
-		//remove last ','
-		result = result.substr(0, result.size()-1);
-
-		result +="]";
+		writer.appendText("]");
+		writer.addNumber(NULL, "numOfExtensions", m_NumOfExtensions);
 	}
 
-	return result;
+	writer.endLayer();
 }
 
 }// namespace pcpp
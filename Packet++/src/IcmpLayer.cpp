@@ -5,7 +5,6 @@
 #include "Packet.h"
 #include "IpUtils.h"
 #include "Logger.h"
-#include <sstream>
 #include <string.h>
 #if defined(WIN32) || defined(WINx64) //for using ntohl, ntohs, etc.
 #include <winsock2.h>
@@ -582,12 +581,12 @@ void IcmpLayer::parseNextLayer()
 	case ICMP_PARAM_PROBLEM:
 		headerLen = getHeaderLen();
 		if (m_DataLen - headerLen >= sizeof(iphdr))
-			m_NextLayer = new IPv4Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet, false);
+			m_NextLayer = new(m_Packet) IPv4Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet, false);
 		return;
 	default:
 		headerLen = getHeaderLen();
 		if (m_DataLen > headerLen)
-			m_NextLayer = new PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+			m_NextLayer = new(m_Packet) PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		return;
 	}
 }
@@ -650,66 +649,62 @@ void IcmpLayer::computeCalculateFields()
 	getIcmpHeader()->checksum = htons(checksum);
 }
 
-std::string IcmpLayer::toString()
+static const char* icmpMessageTypeToString(IcmpMessageType type)
 {
-	std::string messageTypeAsString;
-	IcmpMessageType type = getMessageType();
 	switch (type)
 	{
 	case ICMP_ECHO_REPLY:
-		messageTypeAsString = "Echo (ping) reply";
-		break;
+		return "Echo (ping) reply";
 	case ICMP_DEST_UNREACHABLE:
-		messageTypeAsString = "Destination unreachable";
-		break;
+		return "Destination unreachable";
 	case ICMP_SOURCE_QUENCH:
-		messageTypeAsString = "Source quench (flow control)";
-		break;
+		return "Source quench (flow control)";
 	case ICMP_REDIRECT:
-		messageTypeAsString = "Redirect";
-		break;
+		return "Redirect";
 	case ICMP_ECHO_REQUEST:
-		messageTypeAsString = "Echo (ping) request";
-		break;
+		return "Echo (ping) request";
 	case ICMP_ROUTER_ADV:
-		messageTypeAsString = "Router advertisement";
-		break;
+		return "Router advertisement";
 	case ICMP_ROUTER_SOL:
-		messageTypeAsString = "Router solicitation";
-		break;
+		return "Router solicitation";
 	case ICMP_TIME_EXCEEDED:
-		messageTypeAsString = "Time-to-live exceeded";
-		break;
+		return "Time-to-live exceeded";
 	case ICMP_PARAM_PROBLEM:
-		messageTypeAsString = "Parameter problem: bad IP header";
-		break;
+		return "Parameter problem: bad IP header";
 	case ICMP_TIMESTAMP_REQUEST:
-		messageTypeAsString = "Timestamp request";
-		break;
+		return "Timestamp request";
 	case ICMP_TIMESTAMP_REPLY:
-		messageTypeAsString = "Timestamp reply";
-		break;
+		return "Timestamp reply";
 	case ICMP_INFO_REQUEST:
-		messageTypeAsString = "Information request";
-		break;
+		return "Information request";
 	case ICMP_INFO_REPLY:
-		messageTypeAsString = "Information reply";
-		break;
+		return "Information reply";
 	case ICMP_ADDRESS_MASK_REQUEST:
-		messageTypeAsString = "Address mask request";
-		break;
+		return "Address mask request";
 	case ICMP_ADDRESS_MASK_REPLY:
-		messageTypeAsString = "Address mask reply";
-		break;
+		return "Address mask reply";
 	default:
-		messageTypeAsString = "Unknown";
-		break;
+		return "Unknown";
 	}
+}
 
-	std::ostringstream typeStream;
-	typeStream << (int)getIcmpHeader()->type;
+std::string IcmpLayer::toString()
+{
+	return PacketDumpWriter::layerToString(*this);
+}
 
-	return "ICMP Layer, " + messageTypeAsString + " (type: " + typeStream.str() + ")";
+void IcmpLayer::dump(PacketDumpWriter& writer)
+{
+	writer.beginLayer("ICMP Layer", ICMP);
+	const char* messageType = icmpMessageTypeToString(getMessageType());
+	writer.addText(messageType);
+	writer.appendText(" (type: ");
+	writer.appendNumber(getIcmpHeader()->type);
+	writer.appendText(")");
+	writer.addNumber(NULL, "type", getIcmpHeader()->type);
+	writer.addNumber(NULL, "code", getIcmpHeader()->code);
+	writer.addString(NULL, "message", messageType);
+	writer.endLayer();
 }
 
 } // namespace pcpp
@@ -0,0 +1,780 @@
+#define LOG_MODULE PacketLogModuleL3Forwarder
+
+#include "L3Forwarder.h"
+#include "AtomicUtils.h"
+#include "EthLayer.h"
+#include "IPv4Layer.h"
+#include "IPv6Layer.h"
+#include "ArpLayer.h"
+#include "IpUtils.h"
+#include "Logger.h"
+#include <string.h>
+
+// the number of frames forwardBurst() classifies and looks up together
+#define L3_FORWARDER_CHUNK_SIZE 64
+
+#define ICMPV6_NEIGHBOR_SOLICITATION 135
+#define ICMPV6_NEIGHBOR_ADVERTISEMENT 136
+#define ICMPV6_OPTION_SOURCE_LINK_LAYER 1
+#define ICMPV6_OPTION_TARGET_LINK_LAYER 2
+// the type, code, checksum, flags and target of a neighbor solicitation or advertisement
+#define ICMPV6_ND_HEADER_LENGTH 24
+#define ICMPV6_ND_MESSAGE_LENGTH 32
+#define ICMPV6_NA_FLAG_ROUTER 0x80
+#define ICMPV6_NA_FLAG_SOLICITED 0x40
+#define ICMPV6_NA_FLAG_OVERRIDE 0x20
+#define ND_HOP_LIMIT 255
+
+#define ARP_FRAME_LENGTH (sizeof(ether_header) + sizeof(arphdr))
+
+namespace pcpp
+{
+
+const uint16_t L3Forwarder::DropPort;
+const uint16_t L3Forwarder::HostPort;
+const size_t L3Forwarder::MaxReplyLength;
+
+static inline bool isZero(const uint8_t* address, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		if (address[i] != 0)
+			return false;
+	}
+
+	return true;
+}
+
+L3Forwarder::L3Forwarder(uint16_t numOfPorts, uint32_t maxNumOfNextHops, uint32_t maxNumOfIPv4Groups, uint32_t maxNumOfIPv6Groups) :
+	m_Ports(numOfPorts), m_IPv4Table(maxNumOfIPv4Groups), m_IPv6Table(maxNumOfIPv6Groups), m_NumOfNextHops(0)
+{
+	// next hop 0 is the addresses of the router
+	m_MaxNumOfNextHops = (maxNumOfNextHops < 1 ? 1 : maxNumOfNextHops);
+	if (m_MaxNumOfNextHops > LpmTrie::MaxValue + 1)
+		m_MaxNumOfNextHops = LpmTrie::MaxValue + 1;
+	m_NextHops = new NextHop[m_MaxNumOfNextHops];
+	memset((void*)m_NextHops, 0, sizeof(NextHop) * m_MaxNumOfNextHops);
+	m_LocalNextHop = m_NumOfNextHops++;
+	m_NextHops[m_LocalNextHop].port = HostPort;
+	m_NextHops[m_LocalNextHop].state = NextHopLocal;
+
+	pthread_mutex_init(&m_Lock, NULL);
+}
+
+L3Forwarder::~L3Forwarder()
+{
+	pthread_mutex_destroy(&m_Lock);
+	delete [] m_NextHops;
+}
+
+std::string L3Forwarder::makeKey(bool isIPv6, const uint8_t* address, uint16_t port)
+{
+	std::string key(1, isIPv6 ? '6' : '4');
+	key.append((const char*)&port, sizeof(port));
+	key.append((const char*)address, isIPv6 ? 16 : 4);
+	return key;
+}
+
+bool L3Forwarder::isPortValid(uint16_t port) const
+{
+	return port < m_Ports.size() && m_Ports[port].isSet;
+}
+
+bool L3Forwarder::setPort(uint16_t port, const MacAddress& macAddress)
+{
+	if (port >= m_Ports.size() || !macAddress.isValid())
+	{
+		LOG_ERROR("Port %d doesn't exist or its MAC address is invalid", (int)port);
+		return false;
+	}
+
+	pthread_mutex_lock(&m_Lock);
+	macAddress.copyTo(m_Ports[port].macAddress);
+	m_Ports[port].isSet = true;
+
+	// next hops through the port get its new address
+	for (uint32_t i = 0; i < m_NumOfNextHops; i++)
+	{
+		if (m_NextHops[i].port == port && m_NextHops[i].state != NextHopLocal)
+			memcpy(m_NextHops[i].ethHeader + 6, m_Ports[port].macAddress, 6);
+	}
+
+	pthread_mutex_unlock(&m_Lock);
+	return true;
+}
+
+uint32_t L3Forwarder::getNextHop(uint16_t port, bool isIPv6, const uint8_t* gateway, NextHopState state)
+{
+	std::string key = makeKey(isIPv6, gateway, port);
+	std::map<std::string, uint32_t>::const_iterator iter = m_NextHopIndex.find(key);
+	if (iter != m_NextHopIndex.end())
+		return iter->second;
+
+	if (m_NumOfNextHops == m_MaxNumOfNextHops)
+	{
+		LOG_ERROR("Next hop table is full");
+		return LpmTrie::NoRoute;
+	}
+
+	NextHop& nextHop = m_NextHops[m_NumOfNextHops];
+	nextHop.port = port;
+	nextHop.isIPv6 = isIPv6;
+	memcpy(nextHop.gateway, gateway, getAddressLength(isIPv6));
+	memcpy(nextHop.ethHeader + 6, m_Ports[port].macAddress, 6);
+
+	if (state == NextHopUnresolved && findNeighbor(isIPv6, gateway, nextHop.ethHeader))
+		state = NextHopResolved;
+	nextHop.state = (uint8_t)state;
+
+	// the next hop is complete before routes can point to it
+	m_NextHopIndex[key] = m_NumOfNextHops;
+	return m_NumOfNextHops++;
+}
+
+bool L3Forwarder::addRoute(bool isIPv6, const uint8_t* prefix, uint8_t prefixLength, uint32_t nextHop)
+{
+	if (nextHop == LpmTrie::NoRoute)
+		return false;
+
+	bool added;
+	if (isIPv6)
+		added = m_IPv6Table.add(IPv6Address((uint8_t*)prefix), prefixLength, nextHop);
+	else
+	{
+		uint32_t address;
+		memcpy(&address, prefix, sizeof(address));
+		added = m_IPv4Table.add(IPv4Address(address), prefixLength, nextHop);
+	}
+
+	if (!added)
+		LOG_ERROR("Couldn't add a route of prefix length %d, the prefix length is invalid or the routing table is full", (int)prefixLength);
+	return added;
+}
+
+uint32_t L3Forwarder::lookupRoute(bool isIPv6, const uint8_t* address) const
+{
+	if (isIPv6)
+		return m_IPv6Table.lookup(address);
+
+	uint32_t ipv4Address;
+	memcpy(&ipv4Address, address, sizeof(ipv4Address));
+	return m_IPv4Table.lookup(ipv4Address);
+}
+
+bool L3Forwarder::addPortAddress(uint16_t port, const IPv4Address& address, uint8_t prefixLength)
+{
+	if (!isPortValid(port) || prefixLength == 0 || prefixLength > 32)
+	{
+		LOG_ERROR("Port %d isn't set or prefix length %d is invalid", (int)port, (int)prefixLength);
+		return false;
+	}
+
+	uint32_t ipv4Address = address.toInt();
+	uint32_t zero = 0;
+
+	pthread_mutex_lock(&m_Lock);
+	if (!m_Ports[port].hasIPv4Address)
+	{
+		m_Ports[port].ipv4Address = ipv4Address;
+		m_Ports[port].hasIPv4Address = true;
+	}
+
+	bool added = addRoute(false, (const uint8_t*)&ipv4Address, prefixLength, getNextHop(port, false, (const uint8_t*)&zero, NextHopConnected)) &&
+			addRoute(false, (const uint8_t*)&ipv4Address, 32, m_LocalNextHop);
+	pthread_mutex_unlock(&m_Lock);
+	return added;
+}
+
+bool L3Forwarder::addPortAddress(uint16_t port, const IPv6Address& address, uint8_t prefixLength)
+{
+	if (!isPortValid(port) || prefixLength == 0 || prefixLength > 128)
+	{
+		LOG_ERROR("Port %d isn't set or prefix length %d is invalid", (int)port, (int)prefixLength);
+		return false;
+	}
+
+	uint8_t ipv6Address[16];
+	address.copyTo(ipv6Address);
+	uint8_t zero[16] = { 0 };
+
+	pthread_mutex_lock(&m_Lock);
+	if (!m_Ports[port].hasIPv6Address)
+	{
+		memcpy(m_Ports[port].ipv6Address, ipv6Address, 16);
+		m_Ports[port].hasIPv6Address = true;
+	}
+
+	bool added = addRoute(true, ipv6Address, prefixLength, getNextHop(port, true, zero, NextHopConnected)) &&
+			addRoute(true, ipv6Address, 128, m_LocalNextHop);
+	pthread_mutex_unlock(&m_Lock);
+	return added;
+}
+
+bool L3Forwarder::addRoute(const IPv4Address& prefix, uint8_t prefixLength, const IPv4Address& gateway, uint16_t port)
+{
+	if (!isPortValid(port))
+	{
+		LOG_ERROR("Port %d isn't set", (int)port);
+		return false;
+	}
+
+	uint32_t prefixAddress = prefix.toInt();
+	uint32_t gatewayAddress = gateway.toInt();
+
+	pthread_mutex_lock(&m_Lock);
+	uint32_t nextHop = getNextHop(port, false, (const uint8_t*)&gatewayAddress, gatewayAddress == 0 ? NextHopConnected : NextHopUnresolved);
+	bool added = addRoute(false, (const uint8_t*)&prefixAddress, prefixLength, nextHop);
+	pthread_mutex_unlock(&m_Lock);
+	return added;
+}
+
+bool L3Forwarder::addRoute(const IPv6Address& prefix, uint8_t prefixLength, const IPv6Address& gateway, uint16_t port)
+{
+	if (!isPortValid(port))
+	{
+		LOG_ERROR("Port %d isn't set", (int)port);
+		return false;
+	}
+
+	uint8_t prefixAddress[16];
+	uint8_t gatewayAddress[16];
+	prefix.copyTo(prefixAddress);
+	gateway.copyTo(gatewayAddress);
+
+	pthread_mutex_lock(&m_Lock);
+	uint32_t nextHop = getNextHop(port, true, gatewayAddress, isZero(gatewayAddress, 16) ? NextHopConnected : NextHopUnresolved);
+	bool added = addRoute(true, prefixAddress, prefixLength, nextHop);
+	pthread_mutex_unlock(&m_Lock);
+	return added;
+}
+
+bool L3Forwarder::removeRoute(const IPv4Address& prefix, uint8_t prefixLength)
+{
+	pthread_mutex_lock(&m_Lock);
+	bool removed = m_IPv4Table.remove(prefix, prefixLength);
+	pthread_mutex_unlock(&m_Lock);
+	return removed;
+}
+
+bool L3Forwarder::removeRoute(const IPv6Address& prefix, uint8_t prefixLength)
+{
+	pthread_mutex_lock(&m_Lock);
+	bool removed = m_IPv6Table.remove(prefix, prefixLength);
+	pthread_mutex_unlock(&m_Lock);
+	return removed;
+}
+
+void L3Forwarder::learnNeighbor(bool isIPv6, const uint8_t* address, const uint8_t* macAddress, bool isStatic)
+{
+	size_t addressLength = getAddressLength(isIPv6);
+	std::string key = makeKey(isIPv6, address, 0);
+	uint32_t route = lookupRoute(isIPv6, address);
+	bool isConnected = (route != LpmTrie::NoRoute && m_NextHops[route].state == NextHopConnected);
+
+	// learned neighbors are kept only if they were asked for, they're a gateway or they're on a connected subnet
+	bool isRelevant = isStatic || isConnected || m_Neighbors.find(key) != m_Neighbors.end();
+	for (uint32_t i = 0; i < m_NumOfNextHops && !isRelevant; i++)
+	{
+		NextHop& nextHop = m_NextHops[i];
+		if (nextHop.isIPv6 == isIPv6 && (nextHop.state == NextHopUnresolved || nextHop.state == NextHopResolved) &&
+				memcmp(nextHop.gateway, address, addressLength) == 0)
+			isRelevant = true;
+	}
+
+	if (!isRelevant)
+		return;
+
+	Neighbor& neighbor = m_Neighbors[key];
+	memcpy(neighbor.macAddress, macAddress, 6);
+	neighbor.isResolved = true;
+	neighbor.requestSent = false;
+
+	// the header is written before the next hop is published to the forwarding threads
+	for (uint32_t i = 0; i < m_NumOfNextHops; i++)
+	{
+		NextHop& nextHop = m_NextHops[i];
+		if (nextHop.isIPv6 == isIPv6 && (nextHop.state == NextHopUnresolved || nextHop.state == NextHopResolved) &&
+				memcmp(nextHop.gateway, address, addressLength) == 0)
+		{
+			memcpy(nextHop.ethHeader, macAddress, 6);
+			atomicStoreRelease(&nextHop.state, NextHopResolved);
+		}
+	}
+
+	// a host on a connected subnet gets a host route, so packets to it don't go to the control plane anymore
+	if (isConnected)
+	{
+		uint32_t nextHop = getNextHop(m_NextHops[route].port, isIPv6, address, NextHopUnresolved);
+		addRoute(isIPv6, address, isIPv6 ? 128 : 32, nextHop);
+	}
+}
+
+bool L3Forwarder::findNeighbor(bool isIPv6, const uint8_t* address, uint8_t* macAddress)
+{
+	std::map<std::string, Neighbor>::const_iterator iter = m_Neighbors.find(makeKey(isIPv6, address, 0));
+	if (iter == m_Neighbors.end() || !iter->second.isResolved)
+		return false;
+
+	memcpy(macAddress, iter->second.macAddress, 6);
+	return true;
+}
+
+void L3Forwarder::addNeighbor(const IPv4Address& address, const MacAddress& macAddress)
+{
+	uint32_t ipv4Address = address.toInt();
+	pthread_mutex_lock(&m_Lock);
+	learnNeighbor(false, (const uint8_t*)&ipv4Address, macAddress.getRawData(), true);
+	pthread_mutex_unlock(&m_Lock);
+}
+
+void L3Forwarder::addNeighbor(const IPv6Address& address, const MacAddress& macAddress)
+{
+	uint8_t ipv6Address[16];
+	address.copyTo(ipv6Address);
+	pthread_mutex_lock(&m_Lock);
+	learnNeighbor(true, ipv6Address, macAddress.getRawData(), true);
+	pthread_mutex_unlock(&m_Lock);
+}
+
+bool L3Forwarder::getNeighbor(const IPv4Address& address, MacAddress& macAddress)
+{
+	uint32_t ipv4Address = address.toInt();
+	uint8_t rawMacAddress[6];
+	pthread_mutex_lock(&m_Lock);
+	bool found = findNeighbor(false, (const uint8_t*)&ipv4Address, rawMacAddress);
+	pthread_mutex_unlock(&m_Lock);
+	if (found)
+		macAddress = MacAddress(rawMacAddress);
+	return found;
+}
+
+bool L3Forwarder::getNeighbor(const IPv6Address& address, MacAddress& macAddress)
+{
+	uint8_t ipv6Address[16];
+	address.copyTo(ipv6Address);
+	uint8_t rawMacAddress[6];
+	pthread_mutex_lock(&m_Lock);
+	bool found = findNeighbor(true, ipv6Address, rawMacAddress);
+	pthread_mutex_unlock(&m_Lock);
+	if (found)
+		macAddress = MacAddress(rawMacAddress);
+	return found;
+}
+
+void L3Forwarder::forwardBurst(uint8_t* const* frames, const uint16_t* frameLengths, uint16_t count, uint16_t inPort, uint16_t* outPorts,
+		L3ForwarderStats* stats)
+{
+	L3ForwarderStats burstStats;
+	memset(&burstStats, 0, sizeof(burstStats));
+	const uint8_t* portMacAddress = (isPortValid(inPort) ? m_Ports[inPort].macAddress : NULL);
+
+	uint16_t ipv4Frames[L3_FORWARDER_CHUNK_SIZE];
+	uint32_t ipv4Addresses[L3_FORWARDER_CHUNK_SIZE];
+	uint16_t ipv6Frames[L3_FORWARDER_CHUNK_SIZE];
+	const uint8_t* ipv6Addresses[L3_FORWARDER_CHUNK_SIZE];
+	uint32_t nextHops[L3_FORWARDER_CHUNK_SIZE];
+
+	for (uint16_t base = 0; base < count; base += L3_FORWARDER_CHUNK_SIZE)
+	{
+		uint16_t end = (count - base < L3_FORWARDER_CHUNK_SIZE ? count : base + L3_FORWARDER_CHUNK_SIZE);
+		uint16_t numOfIPv4 = 0, numOfIPv6 = 0;
+
+		// classify the frames, and collect the destinations of the packets to route
+		for (uint16_t i = base; i < end; i++)
+		{
+			uint8_t* frame = frames[i];
+			uint16_t frameLength = frameLengths[i];
+			outPorts[i] = DropPort;
+
+			if (portMacAddress == NULL || frameLength < sizeof(ether_header))
+			{
+				burstStats.filteredPackets++;
+				continue;
+			}
+
+			uint16_t etherType = ntohs(((ether_header*)frame)->etherType);
+			if (memcmp(frame, portMacAddress, 6) != 0)
+			{
+				// broadcast and multicast frames the router handles are ARP and neighbor discovery, unicast frames are for other hosts
+				if ((frame[0] & 0x01) != 0 && (etherType == PCPP_ETHERTYPE_ARP || etherType == PCPP_ETHERTYPE_IPV6))
+				{
+					outPorts[i] = HostPort;
+					burstStats.localPackets++;
+				}
+				else
+					burstStats.filteredPackets++;
+				continue;
+			}
+
+			if (etherType == PCPP_ETHERTYPE_IP)
+			{
+				const iphdr* ipHeader = (const iphdr*)(frame + sizeof(ether_header));
+				if (frameLength < sizeof(ether_header) + sizeof(iphdr) || ipHeader->ipVersion != 4 || ipHeader->internetHeaderLength < 5 ||
+						frameLength < sizeof(ether_header) + ipHeader->internetHeaderLength * 4)
+				{
+					burstStats.filteredPackets++;
+					continue;
+				}
+
+				ipv4Frames[numOfIPv4] = i;
+				ipv4Addresses[numOfIPv4++] = ipHeader->ipDst;
+			}
+			else if (etherType == PCPP_ETHERTYPE_IPV6)
+			{
+				const ip6_hdr* ipHeader = (const ip6_hdr*)(frame + sizeof(ether_header));
+				if (frameLength < sizeof(ether_header) + sizeof(ip6_hdr) || ipHeader->ipVersion != 6)
+				{
+					burstStats.filteredPackets++;
+					continue;
+				}
+
+				// multicast and link-local destinations aren't routed
+				if (ipHeader->ipDst[0] == 0xff || (ipHeader->ipDst[0] == 0xfe && (ipHeader->ipDst[1] & 0xc0) == 0x80))
+				{
+					outPorts[i] = HostPort;
+					burstStats.localPackets++;
+					continue;
+				}
+
+				ipv6Frames[numOfIPv6] = i;
+				ipv6Addresses[numOfIPv6++] = ipHeader->ipDst;
+			}
+			else if (etherType == PCPP_ETHERTYPE_ARP)
+			{
+				outPorts[i] = HostPort;
+				burstStats.localPackets++;
+			}
+			else
+				burstStats.filteredPackets++;
+		}
+
+		// look up the IPv4 destinations and forward the packets, then the same for IPv6
+		for (int family = 0; family < 2; family++)
+		{
+			bool isIPv6 = (family == 1);
+			uint16_t numOfPackets = (isIPv6 ? numOfIPv6 : numOfIPv4);
+			if (numOfPackets == 0)
+				continue;
+
+			if (isIPv6)
+				m_IPv6Table.lookupBulk(ipv6Addresses, nextHops, numOfPackets);
+			else
+				m_IPv4Table.lookupBulk(ipv4Addresses, nextHops, numOfPackets);
+
+			for (uint16_t j = 0; j < numOfPackets; j++)
+			{
+				uint16_t frameIndex = (isIPv6 ? ipv6Frames[j] : ipv4Frames[j]);
+				uint8_t* frame = frames[frameIndex];
+
+				if (nextHops[j] == LpmTrie::NoRoute)
+				{
+					burstStats.noRoutePackets++;
+					continue;
+				}
+
+				const NextHop& nextHop = m_NextHops[nextHops[j]];
+				uint8_t state = atomicLoadAcquire(&nextHop.state);
+				if (state == NextHopLocal)
+				{
+					outPorts[frameIndex] = HostPort;
+					burstStats.localPackets++;
+					continue;
+				}
+
+				uint8_t* ipHeader = frame + sizeof(ether_header);
+				uint8_t ttl = (isIPv6 ? ((ip6_hdr*)ipHeader)->hopLimit : ((iphdr*)ipHeader)->timeToLive);
+				if (ttl <= 1)
+				{
+					burstStats.ttlExceededPackets++;
+					continue;
+				}
+
+				if (state != NextHopResolved)
+				{
+					outPorts[frameIndex] = HostPort;
+					burstStats.unresolvedPackets++;
+					continue;
+				}
+
+				if (isIPv6)
+				{
+					((ip6_hdr*)ipHeader)->hopLimit--;
+					burstStats.forwardedIPv6Packets++;
+				}
+				else
+				{
+					// the TTL shares a 16-bit word of the checksum with the protocol
+					iphdr* ipv4Header = (iphdr*)ipHeader;
+					uint16_t oldWord, newWord;
+					memcpy(&oldWord, &ipv4Header->timeToLive, sizeof(oldWord));
+					ipv4Header->timeToLive--;
+					memcpy(&newWord, &ipv4Header->timeToLive, sizeof(newWord));
+					ipv4Header->headerChecksum = update_checksum(ipv4Header->headerChecksum, oldWord, newWord);
+					burstStats.forwardedIPv4Packets++;
+				}
+
+				memcpy(frame, nextHop.ethHeader, sizeof(nextHop.ethHeader));
+				outPorts[frameIndex] = nextHop.port;
+			}
+		}
+	}
+
+	if (stats != NULL)
+	{
+		stats->forwardedIPv4Packets += burstStats.forwardedIPv4Packets;
+		stats->forwardedIPv6Packets += burstStats.forwardedIPv6Packets;
+		stats->localPackets += burstStats.localPackets;
+		stats->unresolvedPackets += burstStats.unresolvedPackets;
+		stats->noRoutePackets += burstStats.noRoutePackets;
+		stats->ttlExceededPackets += burstStats.ttlExceededPackets;
+		stats->filteredPackets += burstStats.filteredPackets;
+	}
+}
+
+uint16_t L3Forwarder::forwardFrame(uint8_t* frame, uint16_t frameLength, uint16_t inPort, L3ForwarderStats* stats)
+{
+	uint16_t outPort;
+	forwardBurst(&frame, &frameLength, 1, inPort, &outPort, stats);
+	return outPort;
+}
+
+size_t L3Forwarder::processHostFrame(const uint8_t* frame, size_t frameLength, uint16_t inPort, uint32_t now, uint8_t* reply, uint16_t& replyPort)
+{
+	if (frameLength < sizeof(ether_header) || !isPortValid(inPort))
+		return 0;
+
+	uint16_t etherType = ntohs(((const ether_header*)frame)->etherType);
+	size_t replyLength = 0;
+
+	pthread_mutex_lock(&m_Lock);
+	if (etherType == PCPP_ETHERTYPE_ARP)
+		replyLength = processArp(frame, frameLength, inPort, reply, replyPort);
+	else if (etherType == PCPP_ETHERTYPE_IPV6)
+	{
+		const ip6_hdr* ipHeader = (const ip6_hdr*)(frame + sizeof(ether_header));
+		const uint8_t* icmpHeader = frame + sizeof(ether_header) + sizeof(ip6_hdr);
+		if (frameLength >= sizeof(ether_header) + sizeof(ip6_hdr) + ICMPV6_ND_HEADER_LENGTH && ipHeader->nextHeader == PACKETPP_IPPROTO_ICMPV6 &&
+				(icmpHeader[0] == ICMPV6_NEIGHBOR_SOLICITATION || icmpHeader[0] == ICMPV6_NEIGHBOR_ADVERTISEMENT))
+			replyLength = processNeighborDiscovery(frame, frameLength, inPort, reply, replyPort);
+		else
+			replyLength = resolveNextHop(frame, frameLength, now, reply, replyPort);
+	}
+	else if (etherType == PCPP_ETHERTYPE_IP)
+		replyLength = resolveNextHop(frame, frameLength, now, reply, replyPort);
+	pthread_mutex_unlock(&m_Lock);
+
+	return replyLength;
+}
+
+size_t L3Forwarder::processArp(const uint8_t* frame, size_t frameLength, uint16_t inPort, uint8_t* reply, uint16_t& replyPort)
+{
+	if (frameLength < ARP_FRAME_LENGTH)
+		return 0;
+
+	const arphdr* arpHeader = (const arphdr*)(frame + sizeof(ether_header));
+	if (ntohs(arpHeader->hardwareType) != 1 || ntohs(arpHeader->protocolType) != PCPP_ETHERTYPE_IP || arpHeader->hardwareSize != 6 ||
+			arpHeader->protocolSize != 4)
+		return 0;
+
+	// requests and replies both tell the MAC address of their sender
+	if (arpHeader->senderIpAddr != 0)
+		learnNeighbor(false, (const uint8_t*)&arpHeader->senderIpAddr, arpHeader->senderMacAddr, false);
+
+	if (ntohs(arpHeader->opcode) != ARP_REQUEST || lookupRoute(false, (const uint8_t*)&arpHeader->targetIpAddr) != m_LocalNextHop)
+		return 0;
+
+	ether_header* ethHeader = (ether_header*)reply;
+	memcpy(ethHeader->dstMac, arpHeader->senderMacAddr, 6);
+	memcpy(ethHeader->srcMac, m_Ports[inPort].macAddress, 6);
+	ethHeader->etherType = htons(PCPP_ETHERTYPE_ARP);
+
+	arphdr* replyHeader = (arphdr*)(reply + sizeof(ether_header));
+	replyHeader->hardwareType = htons(1);
+	replyHeader->protocolType = htons(PCPP_ETHERTYPE_IP);
+	replyHeader->hardwareSize = 6;
+	replyHeader->protocolSize = 4;
+	replyHeader->opcode = htons(ARP_REPLY);
+	memcpy(replyHeader->senderMacAddr, m_Ports[inPort].macAddress, 6);
+	replyHeader->senderIpAddr = arpHeader->targetIpAddr;
+	memcpy(replyHeader->targetMacAddr, arpHeader->senderMacAddr, 6);
+	replyHeader->targetIpAddr = arpHeader->senderIpAddr;
+
+	replyPort = inPort;
+	return ARP_FRAME_LENGTH;
+}
+
+size_t L3Forwarder::processNeighborDiscovery(const uint8_t* frame, size_t frameLength, uint16_t inPort, uint8_t* reply, uint16_t& replyPort)
+{
+	const ip6_hdr* ipHeader = (const ip6_hdr*)(frame + sizeof(ether_header));
+	const uint8_t* icmpHeader = frame + sizeof(ether_header) + sizeof(ip6_hdr);
+	const uint8_t* targetAddress = icmpHeader + 8;
+
+	// neighbor discovery messages from other links are ignored (RFC 4861 section 7.1)
+	if (ipHeader->hopLimit != ND_HOP_LIMIT)
+		return 0;
+
+	const uint8_t* sourceLinkLayer = NULL;
+	const uint8_t* targetLinkLayer = NULL;
+	const uint8_t* option = icmpHeader + ICMPV6_ND_HEADER_LENGTH;
+	const uint8_t* end = frame + frameLength;
+	while (option + 2 <= end)
+	{
+		size_t optionLength = (size_t)option[1] * 8;
+		if (optionLength == 0 || option + optionLength > end)
+			break;
+		if (option[0] == ICMPV6_OPTION_SOURCE_LINK_LAYER && optionLength >= 8)
+			sourceLinkLayer = option + 2;
+		else if (option[0] == ICMPV6_OPTION_TARGET_LINK_LAYER && optionLength >= 8)
+			targetLinkLayer = option + 2;
+		option += optionLength;
+	}
+
+	if (icmpHeader[0] == ICMPV6_NEIGHBOR_ADVERTISEMENT)
+	{
+		if (targetLinkLayer != NULL)
+			learnNeighbor(true, targetAddress, targetLinkLayer, false);
+		return 0;
+	}
+
+	bool isSourceUnspecified = isZero(ipHeader->ipSrc, 16);
+	if (!isSourceUnspecified && sourceLinkLayer != NULL)
+		learnNeighbor(true, ipHeader->ipSrc, sourceLinkLayer, false);
+
+	if (lookupRoute(true, targetAddress) != m_LocalNextHop)
+		return 0;
+
+	// a solicitation from an unspecified address (duplicate address detection) is answered to all nodes
+	static const uint8_t allNodesAddress[16] = { 0xff, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01 };
+	static const uint8_t allNodesMacAddress[6] = { 0x33, 0x33, 0, 0, 0, 0x01 };
+	const uint8_t* dstMacAddress = isSourceUnspecified ? allNodesMacAddress : (sourceLinkLayer != NULL ? sourceLinkLayer : frame + 6);
+	const uint8_t* dstAddress = isSourceUnspecified ? allNodesAddress : ipHeader->ipSrc;
+
+	replyPort = inPort;
+	return buildNeighborMessage(inPort, false, dstMacAddress, dstAddress, targetAddress, reply);
+}
+
+size_t L3Forwarder::resolveNextHop(const uint8_t* frame, size_t frameLength, uint32_t now, uint8_t* reply, uint16_t& replyPort)
+{
+	bool isIPv6 = (ntohs(((const ether_header*)frame)->etherType) == PCPP_ETHERTYPE_IPV6);
+	const uint8_t* dstAddress;
+	if (isIPv6)
+	{
+		if (frameLength < sizeof(ether_header) + sizeof(ip6_hdr))
+			return 0;
+		dstAddress = ((const ip6_hdr*)(frame + sizeof(ether_header)))->ipDst;
+	}
+	else
+	{
+		if (frameLength < sizeof(ether_header) + sizeof(iphdr))
+			return 0;
+		dstAddress = (const uint8_t*)&((const iphdr*)(frame + sizeof(ether_header)))->ipDst;
+	}
+
+	uint32_t route = lookupRoute(isIPv6, dstAddress);
+	if (route == LpmTrie::NoRoute)
+		return 0;
+
+	// a gateway is asked for its own address, a host on a connected subnet for the destination address
+	const NextHop& nextHop = m_NextHops[route];
+	const uint8_t* targetAddress;
+	if (nextHop.state == NextHopUnresolved)
+		targetAddress = nextHop.gateway;
+	else if (nextHop.state == NextHopConnected)
+		targetAddress = dstAddress;
+	else
+		return 0;
+
+	Neighbor& neighbor = m_Neighbors[makeKey(isIPv6, targetAddress, 0)];
+	if (neighbor.isResolved || (neighbor.requestSent && neighbor.requestTime == now))
+		return 0;
+
+	neighbor.requestSent = true;
+	neighbor.requestTime = now;
+	replyPort = nextHop.port;
+
+	if (!isIPv6)
+	{
+		uint32_t ipv4Target;
+		memcpy(&ipv4Target, targetAddress, sizeof(ipv4Target));
+		return buildArpRequest(nextHop.port, ipv4Target, reply);
+	}
+
+	// the solicitation goes to the solicited-node multicast address of the target
+	uint8_t solicitedNodeAddress[16] = { 0xff, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0xff, 0, 0, 0 };
+	memcpy(solicitedNodeAddress + 13, targetAddress + 13, 3);
+	uint8_t solicitedNodeMacAddress[6] = { 0x33, 0x33, 0xff, 0, 0, 0 };
+	memcpy(solicitedNodeMacAddress + 3, targetAddress + 13, 3);
+	return buildNeighborMessage(nextHop.port, true, solicitedNodeMacAddress, solicitedNodeAddress, targetAddress, reply);
+}
+
+size_t L3Forwarder::buildArpRequest(uint16_t port, uint32_t targetAddress, uint8_t* reply)
+{
+	ether_header* ethHeader = (ether_header*)reply;
+	memset(ethHeader->dstMac, 0xff, 6);
+	memcpy(ethHeader->srcMac, m_Ports[port].macAddress, 6);
+	ethHeader->etherType = htons(PCPP_ETHERTYPE_ARP);
+
+	arphdr* arpHeader = (arphdr*)(reply + sizeof(ether_header));
+	arpHeader->hardwareType = htons(1);
+	arpHeader->protocolType = htons(PCPP_ETHERTYPE_IP);
+	arpHeader->hardwareSize = 6;
+	arpHeader->protocolSize = 4;
+	arpHeader->opcode = htons(ARP_REQUEST);
+	memcpy(arpHeader->senderMacAddr, m_Ports[port].macAddress, 6);
+	arpHeader->senderIpAddr = (m_Ports[port].hasIPv4Address ? m_Ports[port].ipv4Address : 0);
+	memset(arpHeader->targetMacAddr, 0, 6);
+	arpHeader->targetIpAddr = targetAddress;
+
+	return ARP_FRAME_LENGTH;
+}
+
+size_t L3Forwarder::buildNeighborMessage(uint16_t port, bool isSolicitation, const uint8_t* dstMacAddress, const uint8_t* dstAddress,
+		const uint8_t* targetAddress, uint8_t* reply)
+{
+	ether_header* ethHeader = (ether_header*)reply;
+	memcpy(ethHeader->dstMac, dstMacAddress, 6);
+	memcpy(ethHeader->srcMac, m_Ports[port].macAddress, 6);
+	ethHeader->etherType = htons(PCPP_ETHERTYPE_IPV6);
+
+	// a solicitation is sent from the address of the port, an advertisement from the address it advertises
+	ip6_hdr* ipHeader = (ip6_hdr*)(reply + sizeof(ether_header));
+	memset(ipHeader, 0, sizeof(ip6_hdr));
+	ipHeader->ipVersion = 6;
+	ipHeader->payloadLength = htons(ICMPV6_ND_MESSAGE_LENGTH);
+	ipHeader->nextHeader = PACKETPP_IPPROTO_ICMPV6;
+	ipHeader->hopLimit = ND_HOP_LIMIT;
+	if (isSolicitation)
+		memcpy(ipHeader->ipSrc, m_Ports[port].ipv6Address, 16);
+	else
+		memcpy(ipHeader->ipSrc, targetAddress, 16);
+	memcpy(ipHeader->ipDst, dstAddress, 16);
+
+	uint8_t* icmpHeader = reply + sizeof(ether_header) + sizeof(ip6_hdr);
+	memset(icmpHeader, 0, ICMPV6_ND_MESSAGE_LENGTH);
+	icmpHeader[0] = (isSolicitation ? ICMPV6_NEIGHBOR_SOLICITATION : ICMPV6_NEIGHBOR_ADVERTISEMENT);
+	if (!isSolicitation)
+		icmpHeader[4] = ICMPV6_NA_FLAG_ROUTER | ICMPV6_NA_FLAG_OVERRIDE | (dstAddress[0] != 0xff ? ICMPV6_NA_FLAG_SOLICITED : 0);
+	memcpy(icmpHeader + 8, targetAddress, 16);
+	icmpHeader[ICMPV6_ND_HEADER_LENGTH] = (isSolicitation ? ICMPV6_OPTION_SOURCE_LINK_LAYER : ICMPV6_OPTION_TARGET_LINK_LAYER);
+	icmpHeader[ICMPV6_ND_HEADER_LENGTH + 1] = 1;
+	memcpy(icmpHeader + ICMPV6_ND_HEADER_LENGTH + 2, m_Ports[port].macAddress, 6);
+
+	uint16_t pseudoHeader[20];
+	memcpy(pseudoHeader, ipHeader->ipSrc, 16);
+	memcpy(pseudoHeader + 8, ipHeader->ipDst, 16);
+	pseudoHeader[16] = 0;
+	pseudoHeader[17] = htons(ICMPV6_ND_MESSAGE_LENGTH);
+	pseudoHeader[18] = 0;
+	pseudoHeader[19] = htons(PACKETPP_IPPROTO_ICMPV6);
+	ScalarBuffer<uint16_t> vec[2];
+	vec[0].buffer = pseudoHeader;
+	vec[0].len = sizeof(pseudoHeader);
+	vec[1].buffer = (uint16_t*)icmpHeader;
+	vec[1].len = ICMPV6_ND_MESSAGE_LENGTH;
+	uint16_t checksum = htons(compute_checksum(vec, 2));
+	memcpy(icmpHeader + 2, &checksum, sizeof(checksum));
+
+	return sizeof(ether_header) + sizeof(ip6_hdr) + ICMPV6_ND_MESSAGE_LENGTH;
+}
+
+} // namespace pcpp
@@ -4,17 +4,57 @@
 #include <string.h>
 #include "Logger.h"
 #include "Packet.h"
+#include "LayerArena.h"
+#include <new>
 
 namespace pcpp
 {
 
+void* Layer::operator new(size_t size)
+{
+	AllocationHeader* header = (AllocationHeader*)::operator new(size + sizeof(AllocationHeader));
+	header->arena = NULL;
+	return header + 1;
+}
+
+void* Layer::operator new(size_t size, Packet* packet)
+{
+	LayerArena* arena = (packet != NULL ? packet->m_LayerArena : NULL);
+	if (arena == NULL)
+		return operator new(size);
+
+	AllocationHeader* header = (AllocationHeader*)arena->allocate(size + sizeof(AllocationHeader));
+	if (header == NULL)
+		return operator new(size);
+
+	header->arena = arena;
+	return header + 1;
+}
+
+void Layer::operator delete(void* ptr)
+{
+	if (ptr == NULL)
+		return;
+
+	AllocationHeader* header = ((AllocationHeader*)ptr) - 1;
+	if (header->arena != NULL)
+		header->arena->deallocate(header);
+	else
+		::operator delete(header);
+}
+
+void Layer::operator delete(void* ptr, Packet* packet)
+{
+	Layer::operator delete(ptr);
+}
+
 Layer::~Layer()
 {
 	if (!isAllocatedToPacket())
 		delete [] m_Data;
 }
 
-Layer::Layer(const Layer& other) : m_Packet(NULL), m_Protocol(other.m_Protocol), m_NextLayer(NULL), m_PrevLayer(NULL), m_IsAllocatedInPacket(false)
+Layer::Layer(const Layer& other) : m_Packet(NULL), m_Protocol(other.m_Protocol), m_NextLayer(NULL), m_PrevLayer(NULL), m_IsAllocatedInPacket(false), m_IsParsePending(false), m_IsModified(true)
 {
 	m_DataLen = ((Layer&)other).getHeaderLen();
 	m_Data = new uint8_t[other.m_DataLen];
@@ -36,11 +76,26 @@ Layer& Layer::operator=(const Layer& other)
 	m_PrevLayer = NULL;
 	m_Data = new uint8_t[other.m_DataLen];
 	m_IsAllocatedInPacket = false;
+	m_IsParsePending = false;
+	m_IsModified = true;
 	memcpy(m_Data, other.m_Data, other.m_DataLen);
 
 	return *this;
 }
 
+void Layer::parsePendingLayer()
+{
+	if (m_Packet != NULL)
+		m_Packet->parsePendingLayer();
+
+	m_IsParsePending = false;
+}
+
+void Layer::dump(PacketDumpWriter& writer)
+{
+	writer.addLayerSummary(toString(), getProtocol());
+}
+
 void Layer::copyData(uint8_t* toArr)
 {
 	memcpy(toArr, m_Data, m_DataLen);
@@ -68,6 +123,7 @@ bool Layer::extendLayer(int offsetInLayer, size_t numOfBytesToExtend)
 		delete [] m_Data;
 		m_Data = newData;
 		m_DataLen += numOfBytesToExtend;
+		m_IsModified = true;
 		return true;
 	}
 
@@ -96,6 +152,7 @@ bool Layer::shortenLayer(int offsetInLayer, size_t numOfBytesToShorten)
 		delete [] m_Data;
 		m_Data = newData;
 		m_DataLen -= numOfBytesToShorten;
+		m_IsModified = true;
 		return true;
 	}
 
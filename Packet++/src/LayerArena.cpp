@@ -0,0 +1,62 @@
+#include "LayerArena.h"
+
+namespace pcpp
+{
+
+// all blocks are aligned to this value so any layer class can be safely constructed in them
+#define PCPP_LAYER_ARENA_ALIGNMENT 16
+
+LayerArena::LayerArena(size_t size) :
+	m_Size(size),
+	m_Offset(0),
+	m_LiveAllocations(0),
+	m_DeleteWhenEmpty(false)
+{
+	m_Buffer = new uint8_t[m_Size];
+}
+
+LayerArena::~LayerArena()
+{
+	delete [] m_Buffer;
+}
+
+void* LayerArena::allocate(size_t size)
+{
+	size_t alignedSize = (size + PCPP_LAYER_ARENA_ALIGNMENT - 1) & ~((size_t)PCPP_LAYER_ARENA_ALIGNMENT - 1);
+	if (alignedSize > m_Size - m_Offset)
+		return NULL;
+
+	void* result = m_Buffer + m_Offset;
+	m_Offset += alignedSize;
+	m_LiveAllocations++;
+	return result;
+}
+
+void LayerArena::deallocate(void* ptr)
+{
+	if (!contains(ptr) || m_LiveAllocations == 0)
+		return;
+
+	m_LiveAllocations--;
+	if (m_LiveAllocations > 0)
+		return;
+
+	// all blocks were returned - rewind the arena
+	m_Offset = 0;
+
+	if (m_DeleteWhenEmpty)
+		delete this;
+}
+
+void LayerArena::deleteWhenEmpty()
+{
+	if (m_LiveAllocations == 0)
+	{
+		delete this;
+		return;
+	}
+
+	m_DeleteWhenEmpty = true;
+}
+
+} // namespace pcpp
@@ -0,0 +1,337 @@
+#include "LpmTable.h"
+#include "AtomicUtils.h"
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PCPP_LPM_PREFETCH(addr) __builtin_prefetch((const void*)(addr))
+#else
+#define PCPP_LPM_PREFETCH(addr)
+#endif
+
+// an entry is a 32-bit word: whether it holds a value, whether it points to a group, the length of the prefix it came from and the value
+// or the group index
+#define LPM_ENTRY_VALID 0x80000000
+#define LPM_ENTRY_GROUP 0x40000000
+#define LPM_ENTRY_DEPTH_SHIFT 22
+#define LPM_ENTRY_DEPTH_MASK 0xff
+
+#define LPM_GROUP_SIZE 256
+
+namespace pcpp
+{
+
+const uint32_t LpmTrie::NoRoute;
+const uint32_t LpmTrie::MaxValue;
+
+static inline uint32_t makeEntry(uint8_t prefixLength, uint32_t value)
+{
+	return LPM_ENTRY_VALID | ((uint32_t)prefixLength << LPM_ENTRY_DEPTH_SHIFT) | value;
+}
+
+static inline uint8_t getEntryDepth(uint32_t entry)
+{
+	return (uint8_t)((entry >> LPM_ENTRY_DEPTH_SHIFT) & LPM_ENTRY_DEPTH_MASK);
+}
+
+// clear the bits of an address beyond a prefix length
+static void maskPrefix(const uint8_t* address, uint8_t addressLength, uint8_t prefixLength, uint8_t* masked)
+{
+	for (uint8_t i = 0; i < addressLength; i++)
+	{
+		int bits = (int)prefixLength - i * 8;
+		if (bits >= 8)
+			masked[i] = address[i];
+		else if (bits <= 0)
+			masked[i] = 0;
+		else
+			masked[i] = (uint8_t)(address[i] & (0xff << (8 - bits)));
+	}
+}
+
+
+LpmTrie::LpmTrie(uint8_t addressLength, uint8_t firstLevelBits, uint32_t maxNumOfGroups) :
+	m_AddressLength(addressLength), m_FirstLevelBits(firstLevelBits), m_NumOfGroups(0), m_MaxNumOfGroups(maxNumOfGroups)
+{
+	if (m_MaxNumOfGroups > MaxValue + 1)
+		m_MaxNumOfGroups = MaxValue + 1;
+
+	// the first level starts zeroed (no prefixes), the groups are initialized when they're taken
+	m_FirstLevel = new uint32_t[(size_t)1 << m_FirstLevelBits]();
+	m_Groups = new uint32_t[(size_t)m_MaxNumOfGroups * LPM_GROUP_SIZE];
+}
+
+LpmTrie::~LpmTrie()
+{
+	delete [] m_FirstLevel;
+	delete [] m_Groups;
+}
+
+void LpmTrie::clear()
+{
+	memset((void*)m_FirstLevel, 0, sizeof(uint32_t) << m_FirstLevelBits);
+	m_NumOfGroups = 0;
+	m_Prefixes.clear();
+}
+
+std::string LpmTrie::makeKey(const uint8_t* prefix, uint8_t prefixLength) const
+{
+	std::string key((const char*)prefix, m_AddressLength);
+	key.push_back((char)prefixLength);
+	return key;
+}
+
+volatile uint32_t* LpmTrie::getGroup(volatile uint32_t* entry)
+{
+	uint32_t current = *entry;
+	if (isGroup(current))
+		return m_Groups + (size_t)(current & MaxValue) * LPM_GROUP_SIZE;
+
+	if (m_NumOfGroups == m_MaxNumOfGroups)
+		return NULL;
+
+	// the group starts as the expansion of the entry it replaces, and is published only when it's filled
+	uint32_t groupIndex = m_NumOfGroups++;
+	volatile uint32_t* group = m_Groups + (size_t)groupIndex * LPM_GROUP_SIZE;
+	for (int i = 0; i < LPM_GROUP_SIZE; i++)
+		group[i] = current;
+
+	atomicStoreRelease(entry, LPM_ENTRY_GROUP | groupIndex);
+	return group;
+}
+
+void LpmTrie::setEntries(volatile uint32_t* entry, size_t count, uint8_t prefixLength, uint32_t newEntry)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t current = entry[i];
+		if (isGroup(current))
+			setEntries(m_Groups + (size_t)(current & MaxValue) * LPM_GROUP_SIZE, LPM_GROUP_SIZE, prefixLength, newEntry);
+		// entries of longer prefixes are kept
+		else if ((current & LPM_ENTRY_VALID) == 0 || getEntryDepth(current) <= prefixLength)
+			atomicStoreRelease(entry + i, newEntry);
+	}
+}
+
+void LpmTrie::replaceEntries(volatile uint32_t* entry, size_t count, uint8_t prefixLength, uint32_t newEntry)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t current = entry[i];
+		if (isGroup(current))
+			replaceEntries(m_Groups + (size_t)(current & MaxValue) * LPM_GROUP_SIZE, LPM_GROUP_SIZE, prefixLength, newEntry);
+		// within the range of a prefix, only the prefix itself has its length
+		else if ((current & LPM_ENTRY_VALID) != 0 && getEntryDepth(current) == prefixLength)
+			atomicStoreRelease(entry + i, newEntry);
+	}
+}
+
+bool LpmTrie::walkPrefix(const uint8_t* prefix, uint8_t prefixLength, uint32_t newEntry, bool replace)
+{
+	uint32_t firstLevelIndex = getFirstLevelIndex(prefix);
+	if (prefixLength <= m_FirstLevelBits)
+	{
+		size_t count = (size_t)1 << (m_FirstLevelBits - prefixLength);
+		if (replace)
+			replaceEntries(m_FirstLevel + firstLevelIndex, count, prefixLength, newEntry);
+		else
+			setEntries(m_FirstLevel + firstLevelIndex, count, prefixLength, newEntry);
+		return true;
+	}
+
+	volatile uint32_t* entry = m_FirstLevel + firstLevelIndex;
+	int levelEnd = m_FirstLevelBits;
+	while (true)
+	{
+		volatile uint32_t* group;
+		if (replace)
+		{
+			if (!isGroup(*entry))
+				return true;
+			group = m_Groups + (size_t)(*entry & MaxValue) * LPM_GROUP_SIZE;
+		}
+		else
+		{
+			group = getGroup(entry);
+			if (group == NULL)
+				return false;
+		}
+
+		uint8_t byte = prefix[levelEnd / 8];
+		if (prefixLength <= levelEnd + 8)
+		{
+			size_t count = (size_t)1 << (levelEnd + 8 - prefixLength);
+			if (replace)
+				replaceEntries(group + byte, count, prefixLength, newEntry);
+			else
+				setEntries(group + byte, count, prefixLength, newEntry);
+			return true;
+		}
+
+		entry = group + byte;
+		levelEnd += 8;
+	}
+}
+
+bool LpmTrie::addPrefix(const uint8_t* prefix, uint8_t prefixLength, uint32_t value)
+{
+	if (prefixLength > m_AddressLength * 8 || value > MaxValue)
+		return false;
+
+	uint8_t masked[16];
+	maskPrefix(prefix, m_AddressLength, prefixLength, masked);
+
+	// groups are taken before any entry changes, so running out of them leaves the lookups as they were
+	if (!walkPrefix(masked, prefixLength, makeEntry(prefixLength, value), false))
+		return false;
+
+	m_Prefixes[makeKey(masked, prefixLength)] = value;
+	return true;
+}
+
+bool LpmTrie::removePrefix(const uint8_t* prefix, uint8_t prefixLength)
+{
+	if (prefixLength > m_AddressLength * 8)
+		return false;
+
+	uint8_t masked[16];
+	maskPrefix(prefix, m_AddressLength, prefixLength, masked);
+	std::map<std::string, uint32_t>::iterator iter = m_Prefixes.find(makeKey(masked, prefixLength));
+	if (iter == m_Prefixes.end())
+		return false;
+
+	m_Prefixes.erase(iter);
+
+	// the entries of the prefix go to the longest shorter prefix containing it, or become empty
+	uint32_t parentEntry = 0;
+	for (int parentLength = (int)prefixLength - 1; parentLength >= 0; parentLength--)
+	{
+		uint8_t parent[16];
+		maskPrefix(masked, m_AddressLength, (uint8_t)parentLength, parent);
+		iter = m_Prefixes.find(makeKey(parent, (uint8_t)parentLength));
+		if (iter != m_Prefixes.end())
+		{
+			parentEntry = makeEntry((uint8_t)parentLength, iter->second);
+			break;
+		}
+	}
+
+	walkPrefix(masked, prefixLength, parentEntry, true);
+	return true;
+}
+
+bool LpmTrie::findPrefix(const uint8_t* prefix, uint8_t prefixLength, uint32_t& value) const
+{
+	if (prefixLength > m_AddressLength * 8)
+		return false;
+
+	uint8_t masked[16];
+	maskPrefix(prefix, m_AddressLength, prefixLength, masked);
+	std::map<std::string, uint32_t>::const_iterator iter = m_Prefixes.find(makeKey(masked, prefixLength));
+	if (iter == m_Prefixes.end())
+		return false;
+
+	value = iter->second;
+	return true;
+}
+
+
+IPv4LpmTable::IPv4LpmTable(uint32_t maxNumOfGroups) : LpmTrie(4, 24, maxNumOfGroups)
+{
+}
+
+bool IPv4LpmTable::add(const IPv4Address& prefix, uint8_t prefixLength, uint32_t value)
+{
+	uint32_t address = prefix.toInt();
+	return addPrefix((const uint8_t*)&address, prefixLength, value);
+}
+
+bool IPv4LpmTable::remove(const IPv4Address& prefix, uint8_t prefixLength)
+{
+	uint32_t address = prefix.toInt();
+	return removePrefix((const uint8_t*)&address, prefixLength);
+}
+
+bool IPv4LpmTable::find(const IPv4Address& prefix, uint8_t prefixLength, uint32_t& value) const
+{
+	uint32_t address = prefix.toInt();
+	return findPrefix((const uint8_t*)&address, prefixLength, value);
+}
+
+void IPv4LpmTable::lookupBulk(const uint32_t* addresses, uint32_t* values, size_t count) const
+{
+	uint32_t entries[PCPP_LPM_BULK_SIZE];
+
+	for (size_t base = 0; base < count; base += PCPP_LPM_BULK_SIZE)
+	{
+		size_t numOfAddresses = (count - base < PCPP_LPM_BULK_SIZE ? count - base : PCPP_LPM_BULK_SIZE);
+		const uint32_t* bulkAddresses = addresses + base;
+
+		for (size_t i = 0; i < numOfAddresses; i++)
+			PCPP_LPM_PREFETCH(m_FirstLevel + getFirstLevelIndex((const uint8_t*)&bulkAddresses[i]));
+
+		// the addresses under prefixes longer than 24 bits need a group entry, which is prefetched in the same way
+		for (size_t i = 0; i < numOfAddresses; i++)
+		{
+			const uint8_t* bytes = (const uint8_t*)&bulkAddresses[i];
+			entries[i] = m_FirstLevel[getFirstLevelIndex(bytes)];
+			if (isGroup(entries[i]))
+				PCPP_LPM_PREFETCH(m_Groups + (size_t)(entries[i] & MaxValue) * LPM_GROUP_SIZE + bytes[3]);
+		}
+
+		for (size_t i = 0; i < numOfAddresses; i++)
+			values[base + i] = lookupAddress((const uint8_t*)&bulkAddresses[i], entries[i]);
+	}
+}
+
+
+IPv6LpmTable::IPv6LpmTable(uint32_t maxNumOfGroups) : LpmTrie(16, 16, maxNumOfGroups)
+{
+}
+
+bool IPv6LpmTable::add(const IPv6Address& prefix, uint8_t prefixLength, uint32_t value)
+{
+	uint8_t address[16];
+	prefix.copyTo(address);
+	return addPrefix(address, prefixLength, value);
+}
+
+bool IPv6LpmTable::remove(const IPv6Address& prefix, uint8_t prefixLength)
+{
+	uint8_t address[16];
+	prefix.copyTo(address);
+	return removePrefix(address, prefixLength);
+}
+
+bool IPv6LpmTable::find(const IPv6Address& prefix, uint8_t prefixLength, uint32_t& value) const
+{
+	uint8_t address[16];
+	prefix.copyTo(address);
+	return findPrefix(address, prefixLength, value);
+}
+
+void IPv6LpmTable::lookupBulk(const uint8_t* const* addresses, uint32_t* values, size_t count) const
+{
+	uint32_t entries[PCPP_LPM_BULK_SIZE];
+
+	for (size_t base = 0; base < count; base += PCPP_LPM_BULK_SIZE)
+	{
+		size_t numOfAddresses = (count - base < PCPP_LPM_BULK_SIZE ? count - base : PCPP_LPM_BULK_SIZE);
+		const uint8_t* const* bulkAddresses = addresses + base;
+
+		for (size_t i = 0; i < numOfAddresses; i++)
+			PCPP_LPM_PREFETCH(m_FirstLevel + getFirstLevelIndex(bulkAddresses[i]));
+
+		// the deeper levels depend on each other, only the first group of each address is prefetched
+		for (size_t i = 0; i < numOfAddresses; i++)
+		{
+			entries[i] = m_FirstLevel[getFirstLevelIndex(bulkAddresses[i])];
+			if (isGroup(entries[i]))
+				PCPP_LPM_PREFETCH(m_Groups + (size_t)(entries[i] & MaxValue) * LPM_GROUP_SIZE + bulkAddresses[i][2]);
+		}
+
+		for (size_t i = 0; i < numOfAddresses; i++)
+			values[base + i] = lookupAddress(bulkAddresses[i], entries[i]);
+	}
+}
+
+} // namespace pcpp
@@ -0,0 +1,377 @@
+#include "MacLearningTable.h"
+#include "AtomicUtils.h"
+#include "HashCounters.h"
+#include <string.h>
+
+#define MAC_LEARNING_CACHE_LINE_SIZE 64
+#define MAC_LEARNING_BURST_CHUNK 32
+
+#define ETH_HEADER_LEN 14
+#define VLAN_TAG_LEN 4
+#define ETHER_TYPE_OFFSET 12
+#define ETHER_TYPE_VLAN 0x8100
+#define ETHER_TYPE_QINQ 0x88a8
+
+// the bit which marks a key as used, so the key of MAC address 0 on VLAN 0 isn't 0
+#define KEY_USED_BIT 0x8000000000000000ULL
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PCPP_MAC_LEARNING_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PCPP_MAC_LEARNING_PREFETCH(addr)
+#endif
+
+namespace pcpp
+{
+
+static inline uint64_t makeValue(uint16_t port, uint32_t now)
+{
+	return ((uint64_t)now << 32) | (uint64_t)(port + 1);
+}
+
+static inline uint16_t getValuePort(uint64_t value)
+{
+	return (uint16_t)((value & 0xffff) - 1);
+}
+
+static inline uint32_t getValueTime(uint64_t value)
+{
+	return (uint32_t)(value >> 32);
+}
+
+// fill the keys of the source and destination of a frame, or return false if it's too short
+static inline bool parseFrame(const uint8_t* data, size_t dataLen, uint64_t& srcKey, uint64_t& dstKey)
+{
+	if (dataLen < ETH_HEADER_LEN)
+		return false;
+
+	uint64_t vlanId = 0;
+	uint16_t etherType = (uint16_t)((data[ETHER_TYPE_OFFSET] << 8) | data[ETHER_TYPE_OFFSET + 1]);
+	if ((etherType == ETHER_TYPE_VLAN || etherType == ETHER_TYPE_QINQ) && dataLen >= ETH_HEADER_LEN + VLAN_TAG_LEN)
+		vlanId = (uint64_t)(((data[ETHER_TYPE_OFFSET + 2] << 8) | data[ETHER_TYPE_OFFSET + 3]) & 0xfff);
+
+	uint64_t dstMac = 0, srcMac = 0;
+	for (int i = 0; i < 6; i++)
+	{
+		dstMac = (dstMac << 8) | data[i];
+		srcMac = (srcMac << 8) | data[6 + i];
+	}
+
+	dstKey = KEY_USED_BIT | (vlanId << 48) | dstMac;
+	srcKey = KEY_USED_BIT | (vlanId << 48) | srcMac;
+	return true;
+}
+
+MacLearningTable::MacLearningTable(size_t maxEntries, uint32_t agingTime)
+{
+	// at most half of the slots are used when the table holds maxEntries entries
+	size_t minNumOfBuckets = (maxEntries * 2 + PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE - 1) / PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE;
+	m_NumOfBuckets = 1;
+	while (m_NumOfBuckets < minNumOfBuckets)
+		m_NumOfBuckets <<= 1;
+
+	size_t memorySize = m_NumOfBuckets * sizeof(Bucket) + MAC_LEARNING_CACHE_LINE_SIZE;
+	m_Memory = new uint8_t[memorySize];
+	memset(m_Memory, 0, memorySize);
+	uintptr_t alignedAddr = ((uintptr_t)m_Memory + MAC_LEARNING_CACHE_LINE_SIZE - 1) & ~(uintptr_t)(MAC_LEARNING_CACHE_LINE_SIZE - 1);
+	m_Buckets = (Bucket*)alignedAddr;
+
+	m_AgingTime = agingTime;
+	m_NumOfEntries = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	pthread_mutex_init(&m_Mutex, NULL);
+}
+
+MacLearningTable::~MacLearningTable()
+{
+	pthread_mutex_destroy(&m_Mutex);
+	delete [] m_Memory;
+}
+
+uint64_t MacLearningTable::makeKey(const uint8_t* mac, uint16_t vlanId)
+{
+	uint64_t macValue = 0;
+	for (int i = 0; i < 6; i++)
+		macValue = (macValue << 8) | mac[i];
+
+	return KEY_USED_BIT | ((uint64_t)(vlanId & 0xfff) << 48) | macValue;
+}
+
+MacLearningTable::Bucket* MacLearningTable::getBucket(uint64_t key) const
+{
+	return &m_Buckets[(size_t)hashInteger(key) & (m_NumOfBuckets - 1)];
+}
+
+bool MacLearningTable::isExpired(uint64_t value, uint32_t now) const
+{
+	// another thread may have refreshed the entry with a slightly later time
+	int32_t age = (int32_t)(now - getValueTime(value));
+	return age > 0 && (uint32_t)age > m_AgingTime;
+}
+
+uint16_t MacLearningTable::lookupKey(uint64_t key, uint32_t now) const
+{
+	Bucket* bucket = getBucket(key);
+	for (int i = 0; i < PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE; i++)
+	{
+		if (atomicLoadAcquire(&bucket->keys[i]) != key)
+			continue;
+
+		// the slot may have been reused for another key since the key was read, in which case the value isn't this key's
+		uint64_t value = atomicLoadAcquire(&bucket->values[i]);
+		if (value == 0 || atomicLoadRelaxed(&bucket->keys[i]) != key || isExpired(value, now))
+			return FloodPort;
+
+		return getValuePort(value);
+	}
+
+	return FloodPort;
+}
+
+void MacLearningTable::learnKey(uint64_t key, uint16_t port, uint32_t now)
+{
+	Bucket* bucket = getBucket(key);
+	for (int i = 0; i < PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE; i++)
+	{
+		if (atomicLoadAcquire(&bucket->keys[i]) != key)
+			continue;
+
+		uint64_t value = atomicLoadAcquire(&bucket->values[i]);
+		if (value == 0 || getValuePort(value) != port)
+			break;
+
+		// refresh the time without a lock. If the exchange fails the entry was refreshed or changed by another thread
+		if (getValueTime(value) != now)
+			atomicCompareExchange(&bucket->values[i], value, makeValue(port, now));
+		return;
+	}
+
+	// a new address or a station which moved
+	pthread_mutex_lock(&m_Mutex);
+	learnKeyLocked(key, port, now);
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+void MacLearningTable::learnKeyLocked(uint64_t key, uint16_t port, uint32_t now)
+{
+	Bucket* bucket = getBucket(key);
+	int freeSlot = -1, expiredSlot = -1, oldestSlot = -1;
+	uint32_t oldestAge = 0;
+	for (int i = 0; i < PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE; i++)
+	{
+		uint64_t slotKey = atomicLoadRelaxed(&bucket->keys[i]);
+		uint64_t value = atomicLoadRelaxed(&bucket->values[i]);
+		if (slotKey == key)
+		{
+			if (getValuePort(value) != port && !isExpired(value, now))
+				m_Stats.movedEntries++;
+			atomicStoreRelease(&bucket->values[i], makeValue(port, now));
+			return;
+		}
+
+		if (slotKey == 0)
+		{
+			if (freeSlot < 0)
+				freeSlot = i;
+			continue;
+		}
+
+		if (isExpired(value, now))
+		{
+			if (expiredSlot < 0)
+				expiredSlot = i;
+			continue;
+		}
+
+		uint32_t age = now - getValueTime(value);
+		if (oldestSlot < 0 || (int32_t)age > (int32_t)oldestAge)
+		{
+			oldestSlot = i;
+			oldestAge = age;
+		}
+	}
+
+	int slot = freeSlot;
+	if (slot < 0)
+	{
+		slot = (expiredSlot >= 0 ? expiredSlot : oldestSlot);
+		if (expiredSlot >= 0)
+			m_Stats.agedEntries++;
+		else
+			m_Stats.evictedEntries++;
+		removeSlot(bucket, slot);
+	}
+
+	// the value is published before the key, so a reader which finds the key reads its value
+	atomicStoreRelease(&bucket->values[slot], makeValue(port, now));
+	atomicStoreRelease(&bucket->keys[slot], key);
+	m_NumOfEntries++;
+	m_Stats.learnedEntries++;
+}
+
+void MacLearningTable::removeSlot(Bucket* bucket, int slot)
+{
+	atomicStoreRelease(&bucket->values[slot], 0);
+	atomicStoreRelease(&bucket->keys[slot], 0);
+	m_NumOfEntries--;
+}
+
+void MacLearningTable::learn(const MacAddress& mac, uint16_t vlanId, uint16_t port, uint32_t now)
+{
+	if (port > MaxPort)
+		return;
+
+	learnKey(makeKey(mac.getRawData(), vlanId), port, now);
+}
+
+uint16_t MacLearningTable::lookup(const MacAddress& mac, uint16_t vlanId, uint32_t now) const
+{
+	return lookupKey(makeKey(mac.getRawData(), vlanId), now);
+}
+
+uint16_t MacLearningTable::switchParsed(const uint8_t* data, uint64_t srcKey, uint64_t dstKey, uint16_t inPort, uint32_t now)
+{
+	// frames with a multicast source address are invalid
+	if (data[6] & 0x01)
+		return DropPort;
+
+	learnKey(srcKey, inPort, now);
+
+	if (data[0] & 0x01)
+		return FloodPort;
+
+	uint16_t outPort = lookupKey(dstKey, now);
+	return (outPort == inPort ? DropPort : outPort);
+}
+
+uint16_t MacLearningTable::switchFrame(const uint8_t* data, size_t dataLen, uint16_t inPort, uint32_t now)
+{
+	uint64_t srcKey, dstKey;
+	if (inPort > MaxPort || !parseFrame(data, dataLen, srcKey, dstKey))
+		return DropPort;
+
+	return switchParsed(data, srcKey, dstKey, inPort, now);
+}
+
+void MacLearningTable::switchBurst(const uint8_t* const* frames, const uint16_t* frameLengths, size_t count, uint16_t inPort, uint32_t now,
+		uint16_t* outPorts)
+{
+	uint64_t srcKeys[MAC_LEARNING_BURST_CHUNK];
+	uint64_t dstKeys[MAC_LEARNING_BURST_CHUNK];
+	bool valid[MAC_LEARNING_BURST_CHUNK];
+
+	for (size_t start = 0; start < count; start += MAC_LEARNING_BURST_CHUNK)
+	{
+		size_t chunkSize = (count - start < MAC_LEARNING_BURST_CHUNK ? count - start : MAC_LEARNING_BURST_CHUNK);
+
+		// parse the whole chunk and prefetch its buckets, then make the decisions
+		for (size_t i = 0; i < chunkSize; i++)
+		{
+			valid[i] = (inPort <= MaxPort && parseFrame(frames[start + i], frameLengths[start + i], srcKeys[i], dstKeys[i]));
+			if (valid[i])
+			{
+				PCPP_MAC_LEARNING_PREFETCH(getBucket(srcKeys[i]));
+				PCPP_MAC_LEARNING_PREFETCH(getBucket(dstKeys[i]));
+			}
+		}
+
+		for (size_t i = 0; i < chunkSize; i++)
+			outPorts[start + i] = (valid[i] ? switchParsed(frames[start + i], srcKeys[i], dstKeys[i], inPort, now) : DropPort);
+	}
+}
+
+void MacLearningTable::switchBurst(RawPacket* const* packets, size_t count, uint16_t inPort, uint32_t now, uint16_t* outPorts)
+{
+	const uint8_t* frames[MAC_LEARNING_BURST_CHUNK];
+	uint16_t frameLengths[MAC_LEARNING_BURST_CHUNK];
+
+	for (size_t start = 0; start < count; start += MAC_LEARNING_BURST_CHUNK)
+	{
+		size_t chunkSize = (count - start < MAC_LEARNING_BURST_CHUNK ? count - start : MAC_LEARNING_BURST_CHUNK);
+		for (size_t i = 0; i < chunkSize; i++)
+		{
+			int dataLen = packets[start + i]->getRawDataLen();
+			frames[i] = packets[start + i]->getRawData();
+			// only the Ethernet header is parsed, so longer lengths don't matter
+			frameLengths[i] = (uint16_t)(dataLen > 0xffff ? 0xffff : dataLen);
+		}
+
+		switchBurst(frames, frameLengths, chunkSize, inPort, now, outPorts + start);
+	}
+}
+
+size_t MacLearningTable::age(uint32_t now)
+{
+	size_t numOfRemoved = 0;
+	pthread_mutex_lock(&m_Mutex);
+	for (size_t i = 0; i < m_NumOfBuckets; i++)
+	{
+		Bucket* bucket = &m_Buckets[i];
+		for (int j = 0; j < PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE; j++)
+		{
+			if (atomicLoadRelaxed(&bucket->keys[j]) != 0 && isExpired(atomicLoadRelaxed(&bucket->values[j]), now))
+			{
+				removeSlot(bucket, j);
+				numOfRemoved++;
+			}
+		}
+	}
+
+	m_Stats.agedEntries += numOfRemoved;
+	pthread_mutex_unlock(&m_Mutex);
+	return numOfRemoved;
+}
+
+size_t MacLearningTable::flushPort(uint16_t port)
+{
+	size_t numOfRemoved = 0;
+	pthread_mutex_lock(&m_Mutex);
+	for (size_t i = 0; i < m_NumOfBuckets; i++)
+	{
+		Bucket* bucket = &m_Buckets[i];
+		for (int j = 0; j < PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE; j++)
+		{
+			if (atomicLoadRelaxed(&bucket->keys[j]) != 0 && getValuePort(atomicLoadRelaxed(&bucket->values[j])) == port)
+			{
+				removeSlot(bucket, j);
+				numOfRemoved++;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&m_Mutex);
+	return numOfRemoved;
+}
+
+void MacLearningTable::clear()
+{
+	pthread_mutex_lock(&m_Mutex);
+	for (size_t i = 0; i < m_NumOfBuckets; i++)
+	{
+		Bucket* bucket = &m_Buckets[i];
+		for (int j = 0; j < PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE; j++)
+		{
+			if (atomicLoadRelaxed(&bucket->keys[j]) != 0)
+				removeSlot(bucket, j);
+		}
+	}
+
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+size_t MacLearningTable::getNumOfEntries() const
+{
+	pthread_mutex_lock(&m_Mutex);
+	size_t numOfEntries = m_NumOfEntries;
+	pthread_mutex_unlock(&m_Mutex);
+	return numOfEntries;
+}
+
+void MacLearningTable::getStats(MacLearningTableStats& stats) const
+{
+	pthread_mutex_lock(&m_Mutex);
+	stats = m_Stats;
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+} // namespace pcpp
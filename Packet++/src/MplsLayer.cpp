@@ -6,7 +6,6 @@
 #include "PayloadLayer.h"
 #include "Logger.h"
 #include <string.h>
-#include <sstream>
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 #include <winsock2.h>
 #elif LINUX
@@ -111,18 +110,18 @@ void MplsLayer::parseNextLayer()
 
 	if (!isBottomOfStack())
 	{
-		m_NextLayer = new MplsLayer(m_Data + sizeof(mpls_header), m_DataLen - sizeof(mpls_header), this, m_Packet);
+		m_NextLayer = new(m_Packet) MplsLayer(m_Data + sizeof(mpls_header), m_DataLen - sizeof(mpls_header), this, m_Packet);
 		return;
 	}
 
 	uint8_t nextNibble = (*((uint8_t*)(m_Data + headerLen)) & 0xF0) >> 4;
 
 	if (nextNibble == 4)
-		m_NextLayer = new IPv4Layer(m_Data + sizeof(mpls_header), m_DataLen - sizeof(mpls_header), this, m_Packet);
+		m_NextLayer = new(m_Packet) IPv4Layer(m_Data + sizeof(mpls_header), m_DataLen - sizeof(mpls_header), this, m_Packet);
 	else if (nextNibble == 6)
-		m_NextLayer = new IPv6Layer(m_Data + sizeof(mpls_header), m_DataLen - sizeof(mpls_header), this, m_Packet);
+		m_NextLayer = new(m_Packet) IPv6Layer(m_Data + sizeof(mpls_header), m_DataLen - sizeof(mpls_header), this, m_Packet);
 	else
-		m_NextLayer = new PayloadLayer(m_Data + sizeof(mpls_header), m_DataLen - sizeof(mpls_header), this, m_Packet);
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + sizeof(mpls_header), m_DataLen - sizeof(mpls_header), this, m_Packet);
 }
 
 void MplsLayer::computeCalculateFields()
@@ -136,16 +135,17 @@ void MplsLayer::computeCalculateFields()
 
 std::string MplsLayer::toString()
 {
-	std::ostringstream labelStream;
-	labelStream << getMplsLabel();
-	std::ostringstream expStream;
-	expStream << (int)getExperimentalUseValue();
-	std::ostringstream ttlStream;
-	ttlStream << (int)getTTL();
-	std::string bottomOfStack = isBottomOfStack() ? "true" : "false";
-
-	return "MPLS Layer, Label: " + labelStream.str() + ", Exp: " + expStream.str() + ", TTL: " + ttlStream.str() +
-			", Bottom of stack: " + bottomOfStack;
+	return PacketDumpWriter::layerToString(*this);
+}
+
+void MplsLayer::dump(PacketDumpWriter& writer)
+{
+	writer.beginLayer("MPLS Layer", MPLS);
+	writer.addNumber("Label", "label", getMplsLabel());
+	writer.addNumber("Exp", "exp", getExperimentalUseValue());
+	writer.addNumber("TTL", "ttl", getTTL());
+	writer.addBool("Bottom of stack", "bottomOfStack", isBottomOfStack());
+	writer.endLayer();
 }
 
 } // namespace pcpp
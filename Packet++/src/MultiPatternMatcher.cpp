@@ -0,0 +1,487 @@
+#define LOG_MODULE PacketLogModuleMultiPatternMatcher
+
+#include "MultiPatternMatcher.h"
+#include "Logger.h"
+#include "CpuFeatures.h"
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PCPP_PATTERN_MATCHER_X86_SSSE3
+#include <immintrin.h>
+#endif
+
+// a transition with this bit set leads to a state which reports matches
+#define MATCH_FLAG 0x80000000
+#define NO_STATE 0xffffffff
+// skipping bytes is worth it only if most bytes can't start a match
+#define MAX_START_BYTES_TO_SKIP 128
+
+namespace pcpp
+{
+
+/**
+ * The bytes which can start a match, as an exact table and as the nibble masks of the SSSE3 kernel. A byte may start a match if the masks
+ * of its low and high nibbles share a bit, which is a superset of the exact table, so candidates are verified with the table
+ */
+struct PatternSkipTables
+{
+	bool startBytes[256];
+	uint8_t lowNibbleMasks[16];
+	uint8_t highNibbleMasks[16];
+};
+
+// returns the position of the first byte from pos which may start a match, or len if there is none
+typedef size_t (*PatternSkipKernel)(const PatternSkipTables& tables, const uint8_t* data, size_t pos, size_t len);
+
+static size_t skipSoftware(const PatternSkipTables& tables, const uint8_t* data, size_t pos, size_t len)
+{
+	while (pos < len && !tables.startBytes[data[pos]])
+		pos++;
+
+	return pos;
+}
+
+#if defined(PCPP_PATTERN_MATCHER_X86_SSSE3)
+
+__attribute__((target("ssse3")))
+static size_t skipSsse3(const PatternSkipTables& tables, const uint8_t* data, size_t pos, size_t len)
+{
+	const __m128i lowNibbleMasks = _mm_loadu_si128((const __m128i*)tables.lowNibbleMasks);
+	const __m128i highNibbleMasks = _mm_loadu_si128((const __m128i*)tables.highNibbleMasks);
+	const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+	const __m128i zero = _mm_setzero_si128();
+
+	while (pos + 16 <= len)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i*)(data + pos));
+		__m128i lowNibbles = _mm_and_si128(bytes, nibbleMask);
+		__m128i highNibbles = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibbleMask);
+		__m128i candidates = _mm_and_si128(_mm_shuffle_epi8(lowNibbleMasks, lowNibbles), _mm_shuffle_epi8(highNibbleMasks, highNibbles));
+		int candidateBits = ~_mm_movemask_epi8(_mm_cmpeq_epi8(candidates, zero)) & 0xffff;
+		while (candidateBits != 0)
+		{
+			int index = __builtin_ctz(candidateBits);
+			if (tables.startBytes[data[pos + index]])
+				return pos + index;
+			candidateBits &= candidateBits - 1;
+		}
+
+		pos += 16;
+	}
+
+	return skipSoftware(tables, data, pos, len);
+}
+
+#endif
+
+static PatternSkipKernel selectSkipKernel()
+{
+#if defined(PCPP_PATTERN_MATCHER_X86_SSSE3)
+	if (CpuFeatures::hasSsse3())
+		return skipSsse3;
+#endif
+	return skipSoftware;
+}
+
+static inline PatternSkipKernel getSkipKernel()
+{
+	static const PatternSkipKernel kernel = selectSkipKernel();
+	return kernel;
+}
+
+static inline uint8_t toLowerCase(uint8_t byte)
+{
+	return (byte >= 'A' && byte <= 'Z' ? (uint8_t)(byte + ('a' - 'A')) : byte);
+}
+
+
+/**
+ * An Aho-Corasick automaton of either the case-sensitive or the caseless patterns. Transitions are a dense table of numOfClasses entries
+ * per state, where bytes which behave the same in all states (bytes no pattern contains, and the two cases of a letter in the caseless
+ * automaton) share a class. States are represented by the index of their first transition, so a step is a single lookup
+ */
+class MultiPatternMatcher::Automaton
+{
+public:
+	bool build(const std::vector<Pattern>& patterns, bool caseless);
+
+	size_t scan(const uint8_t* data, size_t dataLen, uint32_t& state, uint64_t baseOffset, OnPatternMatch onMatch, void* userCookie, bool& stopped) const;
+
+	inline size_t getNumOfStates() const { return m_DictLinks.size(); }
+
+private:
+	uint8_t m_ByteClasses[256];
+	uint32_t m_NumOfClasses;
+	std::vector<uint32_t> m_Transitions;
+	// the IDs of the patterns ending at each state are m_Outputs[m_OutputStarts[state]] to m_Outputs[m_OutputStarts[state + 1] - 1]
+	std::vector<uint32_t> m_OutputStarts;
+	std::vector<uint32_t> m_Outputs;
+	// the longest proper suffix of each state which has outputs, or NO_STATE
+	std::vector<uint32_t> m_DictLinks;
+	PatternSkipTables m_SkipTables;
+	bool m_UseSkip;
+};
+
+bool MultiPatternMatcher::Automaton::build(const std::vector<Pattern>& patterns, bool caseless)
+{
+	// class 0 is of the bytes which don't appear in any pattern, if there are such bytes
+	memset(m_ByteClasses, 0, sizeof(m_ByteClasses));
+	bool usedBytes[256];
+	memset(usedBytes, 0, sizeof(usedBytes));
+	for (size_t i = 0; i < patterns.size(); i++)
+	{
+		for (size_t j = 0; j < patterns[i].bytes.size(); j++)
+			usedBytes[(uint8_t)patterns[i].bytes[j]] = true;
+	}
+
+	int numOfUsedBytes = 0;
+	for (int byte = 0; byte < 256; byte++)
+		numOfUsedBytes += (usedBytes[byte] ? 1 : 0);
+
+	// caseless patterns are kept in lower case, the upper case letters get the class of the lower case ones
+	m_NumOfClasses = (numOfUsedBytes < 256 ? 1 : 0);
+	for (int byte = 0; byte < 256; byte++)
+	{
+		if (!usedBytes[byte])
+			continue;
+
+		m_ByteClasses[byte] = (uint8_t)m_NumOfClasses;
+		if (caseless && byte >= 'a' && byte <= 'z')
+			m_ByteClasses[byte - ('a' - 'A')] = (uint8_t)m_NumOfClasses;
+		m_NumOfClasses++;
+	}
+
+	// build the trie
+	std::vector<uint32_t> gotoTable(m_NumOfClasses, NO_STATE);
+	std::vector<std::vector<uint32_t> > stateOutputs(1);
+	for (size_t i = 0; i < patterns.size(); i++)
+	{
+		uint32_t state = 0;
+		for (size_t j = 0; j < patterns[i].bytes.size(); j++)
+		{
+			uint32_t byteClass = m_ByteClasses[(uint8_t)patterns[i].bytes[j]];
+			if (gotoTable[state * m_NumOfClasses + byteClass] == NO_STATE)
+			{
+				gotoTable[state * m_NumOfClasses + byteClass] = (uint32_t)stateOutputs.size();
+				gotoTable.resize(gotoTable.size() + m_NumOfClasses, NO_STATE);
+				stateOutputs.push_back(std::vector<uint32_t>());
+			}
+
+			state = gotoTable[state * m_NumOfClasses + byteClass];
+		}
+
+		stateOutputs[state].push_back(patterns[i].id);
+	}
+
+	size_t numOfStates = stateOutputs.size();
+	if ((uint64_t)numOfStates * m_NumOfClasses >= MATCH_FLAG)
+	{
+		LOG_ERROR("Automaton is too large: %d states of %d byte classes", (int)numOfStates, (int)m_NumOfClasses);
+		return false;
+	}
+
+	// complete the transitions with the failure links in breadth-first order, so the failure state of each state is already complete
+	std::vector<uint32_t> failLinks(numOfStates, 0);
+	m_DictLinks.assign(numOfStates, NO_STATE);
+	std::vector<uint32_t> queue;
+	queue.reserve(numOfStates);
+	for (uint32_t byteClass = 0; byteClass < m_NumOfClasses; byteClass++)
+	{
+		uint32_t child = gotoTable[byteClass];
+		if (child == NO_STATE)
+			gotoTable[byteClass] = 0;
+		else
+			queue.push_back(child);
+	}
+
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		uint32_t state = queue[head];
+		uint32_t* transitions = &gotoTable[state * m_NumOfClasses];
+		const uint32_t* failTransitions = &gotoTable[failLinks[state] * m_NumOfClasses];
+		for (uint32_t byteClass = 0; byteClass < m_NumOfClasses; byteClass++)
+		{
+			uint32_t child = transitions[byteClass];
+			if (child == NO_STATE)
+			{
+				transitions[byteClass] = failTransitions[byteClass];
+				continue;
+			}
+
+			uint32_t failLink = failTransitions[byteClass];
+			failLinks[child] = failLink;
+			m_DictLinks[child] = (!stateOutputs[failLink].empty() ? failLink : m_DictLinks[failLink]);
+			queue.push_back(child);
+		}
+	}
+
+	m_Transitions.resize(gotoTable.size());
+	for (size_t i = 0; i < gotoTable.size(); i++)
+	{
+		uint32_t target = gotoTable[i];
+		bool hasOutputs = (!stateOutputs[target].empty() || m_DictLinks[target] != NO_STATE);
+		m_Transitions[i] = (target * m_NumOfClasses) | (hasOutputs ? MATCH_FLAG : 0);
+	}
+
+	m_OutputStarts.resize(numOfStates + 1);
+	m_Outputs.clear();
+	for (size_t state = 0; state < numOfStates; state++)
+	{
+		m_OutputStarts[state] = (uint32_t)m_Outputs.size();
+		m_Outputs.insert(m_Outputs.end(), stateOutputs[state].begin(), stateOutputs[state].end());
+	}
+	m_OutputStarts[numOfStates] = (uint32_t)m_Outputs.size();
+
+	// the bytes which leave the initial state
+	memset(&m_SkipTables, 0, sizeof(m_SkipTables));
+	int numOfStartBytes = 0;
+	for (int byte = 0; byte < 256; byte++)
+	{
+		if (gotoTable[m_ByteClasses[byte]] == 0)
+			continue;
+
+		m_SkipTables.startBytes[byte] = true;
+		uint8_t bucket = (uint8_t)(1 << ((byte >> 4) & 7));
+		m_SkipTables.lowNibbleMasks[byte & 0x0f] |= bucket;
+		m_SkipTables.highNibbleMasks[byte >> 4] |= bucket;
+		numOfStartBytes++;
+	}
+
+	m_UseSkip = (numOfStartBytes <= MAX_START_BYTES_TO_SKIP);
+
+	return true;
+}
+
+size_t MultiPatternMatcher::Automaton::scan(const uint8_t* data, size_t dataLen, uint32_t& state, uint64_t baseOffset, OnPatternMatch onMatch,
+		void* userCookie, bool& stopped) const
+{
+	const uint32_t* transitions = &m_Transitions[0];
+	PatternSkipKernel skipKernel = getSkipKernel();
+	uint32_t currentState = state;
+	size_t numOfMatches = 0;
+	size_t pos = 0;
+
+	while (pos < dataLen)
+	{
+		if (currentState == 0 && m_UseSkip)
+		{
+			pos = skipKernel(m_SkipTables, data, pos, dataLen);
+			if (pos >= dataLen)
+				break;
+		}
+
+		currentState = transitions[currentState + m_ByteClasses[data[pos]]];
+		pos++;
+
+		if ((currentState & MATCH_FLAG) == 0)
+			continue;
+
+		currentState &= ~MATCH_FLAG;
+		uint32_t matchState = currentState / m_NumOfClasses;
+		if (m_OutputStarts[matchState] == m_OutputStarts[matchState + 1])
+			matchState = m_DictLinks[matchState];
+
+		for (; matchState != NO_STATE; matchState = m_DictLinks[matchState])
+		{
+			for (uint32_t output = m_OutputStarts[matchState]; output < m_OutputStarts[matchState + 1]; output++)
+			{
+				numOfMatches++;
+				if (onMatch != NULL && !onMatch(m_Outputs[output], baseOffset + pos, userCookie))
+				{
+					stopped = true;
+					state = currentState;
+					return numOfMatches;
+				}
+			}
+		}
+	}
+
+	state = currentState;
+	return numOfMatches;
+}
+
+
+MultiPatternMatcher::MultiPatternMatcher()
+{
+	m_CaseSensitiveAutomaton = NULL;
+	m_CaselessAutomaton = NULL;
+	m_Compiled = false;
+}
+
+MultiPatternMatcher::~MultiPatternMatcher()
+{
+	freeAutomata();
+}
+
+void MultiPatternMatcher::freeAutomata()
+{
+	delete m_CaseSensitiveAutomaton;
+	delete m_CaselessAutomaton;
+	m_CaseSensitiveAutomaton = NULL;
+	m_CaselessAutomaton = NULL;
+	m_Compiled = false;
+}
+
+bool MultiPatternMatcher::addPattern(const uint8_t* pattern, size_t patternLen, uint32_t patternId, bool caseless)
+{
+	if (pattern == NULL || patternLen == 0)
+	{
+		LOG_ERROR("Cannot add an empty pattern");
+		return false;
+	}
+
+	Pattern newPattern;
+	newPattern.bytes.assign((const char*)pattern, patternLen);
+	newPattern.id = patternId;
+	newPattern.caseless = caseless;
+	if (caseless)
+	{
+		for (size_t i = 0; i < patternLen; i++)
+			newPattern.bytes[i] = (char)toLowerCase((uint8_t)newPattern.bytes[i]);
+	}
+
+	m_Patterns.push_back(newPattern);
+	m_Compiled = false;
+	return true;
+}
+
+bool MultiPatternMatcher::addPattern(const std::string& pattern, uint32_t patternId, bool caseless)
+{
+	return addPattern((const uint8_t*)pattern.data(), pattern.size(), patternId, caseless);
+}
+
+void MultiPatternMatcher::clear()
+{
+	m_Patterns.clear();
+	freeAutomata();
+}
+
+bool MultiPatternMatcher::compile()
+{
+	freeAutomata();
+
+	if (m_Patterns.empty())
+	{
+		LOG_ERROR("No patterns to compile");
+		return false;
+	}
+
+	std::vector<Pattern> caseSensitivePatterns, caselessPatterns;
+	for (size_t i = 0; i < m_Patterns.size(); i++)
+	{
+		if (m_Patterns[i].caseless)
+			caselessPatterns.push_back(m_Patterns[i]);
+		else
+			caseSensitivePatterns.push_back(m_Patterns[i]);
+	}
+
+	if (!caseSensitivePatterns.empty())
+	{
+		m_CaseSensitiveAutomaton = new Automaton();
+		if (!m_CaseSensitiveAutomaton->build(caseSensitivePatterns, false))
+		{
+			freeAutomata();
+			return false;
+		}
+	}
+
+	if (!caselessPatterns.empty())
+	{
+		m_CaselessAutomaton = new Automaton();
+		if (!m_CaselessAutomaton->build(caselessPatterns, true))
+		{
+			freeAutomata();
+			return false;
+		}
+	}
+
+	m_Compiled = true;
+	LOG_DEBUG("Compiled %d patterns into %d states", (int)m_Patterns.size(), (int)getNumOfStates());
+	return true;
+}
+
+size_t MultiPatternMatcher::getNumOfStates() const
+{
+	return (m_CaseSensitiveAutomaton != NULL ? m_CaseSensitiveAutomaton->getNumOfStates() : 0) +
+			(m_CaselessAutomaton != NULL ? m_CaselessAutomaton->getNumOfStates() : 0);
+}
+
+size_t MultiPatternMatcher::scan(const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie) const
+{
+	PatternStreamState state;
+	return scanStream(state, data, dataLen, onMatch, userCookie);
+}
+
+size_t MultiPatternMatcher::scanLayerPayload(Layer* layer, OnPatternMatch onMatch, void* userCookie) const
+{
+	if (layer == NULL)
+		return 0;
+
+	return scan(layer->getLayerPayload(), layer->getLayerPayloadSize(), onMatch, userCookie);
+}
+
+size_t MultiPatternMatcher::scanStream(PatternStreamState& state, const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie) const
+{
+	if (!m_Compiled)
+	{
+		LOG_ERROR("Patterns aren't compiled");
+		return 0;
+	}
+
+	if (data == NULL || dataLen == 0)
+		return 0;
+
+	size_t numOfMatches = 0;
+	bool stopped = false;
+	if (m_CaseSensitiveAutomaton != NULL)
+		numOfMatches += m_CaseSensitiveAutomaton->scan(data, dataLen, state.caseSensitiveState, state.offset, onMatch, userCookie, stopped);
+
+	if (m_CaselessAutomaton != NULL && !stopped)
+		numOfMatches += m_CaselessAutomaton->scan(data, dataLen, state.caselessState, state.offset, onMatch, userCookie, stopped);
+
+	// a scan stopped in the middle of the data continues from the initial state with the next piece
+	if (stopped)
+	{
+		state.caseSensitiveState = 0;
+		state.caselessState = 0;
+	}
+
+	state.offset += dataLen;
+	return numOfMatches;
+}
+
+
+TcpStreamPatternScanner::TcpStreamPatternScanner(const MultiPatternMatcher& matcher, OnTcpPatternMatch onMatch, void* userCookie) :
+	m_Matcher(matcher), m_OnMatch(onMatch), m_UserCookie(userCookie)
+{
+}
+
+size_t TcpStreamPatternScanner::scan(int side, const TcpStreamData& tcpData)
+{
+	const ConnectionData& connectionData = tcpData.getConnectionDataRef();
+	PatternStreamState& state = m_StreamStates[connectionData.flowKey].sides[side & 1];
+
+	MatchContext context;
+	context.scanner = this;
+	context.side = side;
+	context.connectionData = &connectionData;
+
+	return m_Matcher.scanStream(state, tcpData.getData(), tcpData.getDataLength(), (m_OnMatch != NULL ? onStreamMatch : NULL), &context);
+}
+
+void TcpStreamPatternScanner::connectionEnded(const ConnectionData& connectionData)
+{
+	m_StreamStates.erase(connectionData.flowKey);
+}
+
+void TcpStreamPatternScanner::clear()
+{
+	m_StreamStates.clear();
+}
+
+bool TcpStreamPatternScanner::onStreamMatch(uint32_t patternId, uint64_t endOffset, void* userCookie)
+{
+	MatchContext* context = (MatchContext*)userCookie;
+	return context->scanner->m_OnMatch(patternId, endOffset, context->side, *context->connectionData, context->scanner->m_UserCookie);
+}
+
+} // namespace pcpp
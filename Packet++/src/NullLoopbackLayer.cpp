@@ -58,22 +58,29 @@ void NullLoopbackLayer::parseNextLayer()
 	switch (family)
 	{
 	case PCPP_BSD_AF_INET:
-		m_NextLayer = new IPv4Layer(m_Data + sizeof(uint32_t), m_DataLen - sizeof(uint32_t), this, m_Packet);
+		m_NextLayer = new(m_Packet) IPv4Layer(m_Data + sizeof(uint32_t), m_DataLen - sizeof(uint32_t), this, m_Packet);
 		break;
     case PCPP_BSD_AF_INET6_BSD:
     case PCPP_BSD_AF_INET6_FREEBSD:
     case PCPP_BSD_AF_INET6_DARWIN:
-		m_NextLayer = new IPv6Layer(m_Data + sizeof(uint32_t), m_DataLen - sizeof(uint32_t), this, m_Packet);
+		m_NextLayer = new(m_Packet) IPv6Layer(m_Data + sizeof(uint32_t), m_DataLen - sizeof(uint32_t), this, m_Packet);
 		break;
     default:
-    	m_NextLayer = new PayloadLayer(m_Data + sizeof(uint32_t), m_DataLen - sizeof(uint32_t), this, m_Packet);
+    	m_NextLayer = new(m_Packet) PayloadLayer(m_Data + sizeof(uint32_t), m_DataLen - sizeof(uint32_t), this, m_Packet);
 	}
 }
 
 
 std::string NullLoopbackLayer::toString()
 {
-	return "Null/Loopback";
+	return PacketDumpWriter::layerToString(*this);
+}
+
+void NullLoopbackLayer::dump(PacketDumpWriter& writer)
+{
+	writer.beginLayer("Null/Loopback", NULL_LOOPBACK);
+	writer.addNumber(NULL, "family", getFamily());
+	writer.endLayer();
 }
 
 }
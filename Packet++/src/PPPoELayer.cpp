@@ -5,7 +5,6 @@
 #include "IPv6Layer.h"
 #include "PayloadLayer.h"
 #include "Logger.h"
-#include <map>
 #include <sstream>
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 #include <winsock2.h>
@@ -54,13 +53,13 @@ void PPPoESessionLayer::parseNextLayer()
 	switch (getPPPNextProtocol())
 	{
 	case PCPP_PPP_IP:
-		m_NextLayer = new IPv4Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) IPv4Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
 	case PCPP_PPP_IPV6:
-		m_NextLayer = new IPv6Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) IPv6Layer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
 	default:
-		m_NextLayer = new PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 		break;
 	}
 
@@ -90,153 +89,288 @@ void PPPoESessionLayer::setPPPNextProtocol(uint16_t nextProtocol)
 	*pppProto = htons(nextProtocol);
 }
 
-std::map<uint16_t, std::string> createPPPNextProtoToStringMap()
+// the names of the PPP protocols, or NULL for unknown protocols. A switch costs nothing at startup, unlike a map
+static const char* getPPPNextProtoName(uint16_t nextProto)
 {
-	std::map<uint16_t, std::string> tempMap;
-	tempMap[PCPP_PPP_PADDING] =     "Padding Protocol";
-	tempMap[PCPP_PPP_ROHC_SCID] =   "ROHC small-CID";
-	tempMap[PCPP_PPP_ROHC_LCID] =   "ROHC large-CID";
-	tempMap[PCPP_PPP_IP] =          "Internet Protocol version 4";
-	tempMap[PCPP_PPP_OSI] =         "OSI Network Layer";
-	tempMap[PCPP_PPP_XNSIDP] =      "Xerox NS IDP";
-	tempMap[PCPP_PPP_DEC4] =        "DECnet Phase IV";
-	tempMap[PCPP_PPP_AT] =          "Appletalk";
-	tempMap[PCPP_PPP_IPX] =         "Novell IPX";
-	tempMap[PCPP_PPP_VJC_COMP] =    "Van Jacobson Compressed TCP/IP";
-	tempMap[PCPP_PPP_VJC_UNCOMP] =  "Van Jacobson Uncompressed TCP/IP";
-	tempMap[PCPP_PPP_BCP] =         "Bridging PDU";
-	tempMap[PCPP_PPP_ST] =          "Stream Protocol (ST-II)";
-	tempMap[PCPP_PPP_VINES] =       "Banyan Vines";
-	tempMap[PCPP_PPP_AT_EDDP] =     "AppleTalk EDDP";
-	tempMap[PCPP_PPP_AT_SB] =       "AppleTalk SmartBuffered";
-	tempMap[PCPP_PPP_MP] =          "Multi-Link";
-	tempMap[PCPP_PPP_NB] =          "NETBIOS Framing";
-	tempMap[PCPP_PPP_CISCO] =       "Cisco Systems";
-	tempMap[PCPP_PPP_ASCOM] =       "Ascom Timeplex";
-	tempMap[PCPP_PPP_LBLB] =        "Fujitsu Link Backup and Load Balancing (LBLB)";
-	tempMap[PCPP_PPP_RL] =          "DCA Remote Lan";
-	tempMap[PCPP_PPP_SDTP] =        "Serial Data Transport Protocol (PPP-SDTP)";
-	tempMap[PCPP_PPP_LLC] =         "SNA over 802.2";
-	tempMap[PCPP_PPP_SNA] =         "SNA";
-	tempMap[PCPP_PPP_IPV6HC] =      "IPv6 Header Compression ";
-    tempMap[PCPP_PPP_KNX] =         "KNX Bridging Data";
-    tempMap[PCPP_PPP_ENCRYPT] =     "Encryption";
-    tempMap[PCPP_PPP_ILE] =         "Individual Link Encryption";
-    tempMap[PCPP_PPP_IPV6] =        "Internet Protocol version 6";
-    tempMap[PCPP_PPP_MUX] =         "PPP Muxing";
-    tempMap[PCPP_PPP_VSNP] =        "Vendor-Specific Network Protocol (VSNP)";
-    tempMap[PCPP_PPP_TNP] =         "TRILL Network Protocol (TNP)";
-    tempMap[PCPP_PPP_RTP_FH] =      "RTP IPHC Full Header";
-    tempMap[PCPP_PPP_RTP_CTCP] =    "RTP IPHC Compressed TCP";
-    tempMap[PCPP_PPP_RTP_CNTCP] =   "RTP IPHC Compressed Non TCP";
-    tempMap[PCPP_PPP_RTP_CUDP8] =   "RTP IPHC Compressed UDP 8";
-    tempMap[PCPP_PPP_RTP_CRTP8] =   "RTP IPHC Compressed RTP 8";
-    tempMap[PCPP_PPP_STAMPEDE] =    "Stampede Bridging";
-    tempMap[PCPP_PPP_MPPLUS] =      "MP+ Protocol";
-    tempMap[PCPP_PPP_NTCITS_IPI] =  "NTCITS IPI";
-    tempMap[PCPP_PPP_ML_SLCOMP] =   "Single link compression in multilink";
-    tempMap[PCPP_PPP_COMP] =        "Compressed datagram";
-    tempMap[PCPP_PPP_STP_HELLO] =   "802.1d Hello Packets";
-    tempMap[PCPP_PPP_IBM_SR] =      "IBM Source Routing BPDU";
-    tempMap[PCPP_PPP_DEC_LB] =      "DEC LANBridge100 Spanning Tree";
-    tempMap[PCPP_PPP_CDP] =         "Cisco Discovery Protocol";
-    tempMap[PCPP_PPP_NETCS] =       "Netcs Twin Routing";
-    tempMap[PCPP_PPP_STP] =         "STP - Scheduled Transfer Protocol";
-    tempMap[PCPP_PPP_EDP] =         "EDP - Extreme Discovery Protocol";
-    tempMap[PCPP_PPP_OSCP] =        "Optical Supervisory Channel Protocol (OSCP)";
-    tempMap[PCPP_PPP_OSCP2] =       "Optical Supervisory Channel Protocol (OSCP)";
-    tempMap[PCPP_PPP_LUXCOM] =      "Luxcom";
-    tempMap[PCPP_PPP_SIGMA] =       "Sigma Network Systems";
-    tempMap[PCPP_PPP_ACSP] =        "Apple Client Server Protocol";
-    tempMap[PCPP_PPP_MPLS_UNI] =    "MPLS Unicast";
-    tempMap[PCPP_PPP_MPLS_MULTI] =  "MPLS Multicast";
-    tempMap[PCPP_PPP_P12844] =      "IEEE p1284.4 standard - data packets";
-    tempMap[PCPP_PPP_TETRA] =       "ETSI TETRA Network Protocol Type 1";
-    tempMap[PCPP_PPP_MFTP] =        "Multichannel Flow Treatment Protocol";
-    tempMap[PCPP_PPP_RTP_CTCPND] =  "RTP IPHC Compressed TCP No Delta";
-    tempMap[PCPP_PPP_RTP_CS] =      "RTP IPHC Context State";
-    tempMap[PCPP_PPP_RTP_CUDP16] =  "RTP IPHC Compressed UDP 16";
-    tempMap[PCPP_PPP_RTP_CRDP16] =  "RTP IPHC Compressed RTP 16";
-    tempMap[PCPP_PPP_CCCP] =        "Cray Communications Control Protocol";
-    tempMap[PCPP_PPP_CDPD_MNRP] =   "CDPD Mobile Network Registration Protocol";
-    tempMap[PCPP_PPP_EXPANDAP] =    "Expand accelerator protocol";
-    tempMap[PCPP_PPP_ODSICP] =      "ODSICP NCP";
-    tempMap[PCPP_PPP_DOCSIS] =      "DOCSIS DLL";
-    tempMap[PCPP_PPP_CETACEANNDP] = "Cetacean Network Detection Protocol";
-    tempMap[PCPP_PPP_LZS] =         "Stacker LZS";
-    tempMap[PCPP_PPP_REFTEK] =      "RefTek Protocol";
-    tempMap[PCPP_PPP_FC] =          "Fibre Channel";
-    tempMap[PCPP_PPP_EMIT] =        "EMIT Protocols";
-    tempMap[PCPP_PPP_VSP] =         "Vendor-Specific Protocol (VSP)";
-    tempMap[PCPP_PPP_TLSP] =        "TRILL Link State Protocol (TLSP)";
-    tempMap[PCPP_PPP_IPCP] =        "Internet Protocol Control Protocol";
-    tempMap[PCPP_PPP_OSINLCP] =     "OSI Network Layer Control Protocol";
-    tempMap[PCPP_PPP_XNSIDPCP] =    "Xerox NS IDP Control Protocol";
-    tempMap[PCPP_PPP_DECNETCP] =    "DECnet Phase IV Control Protocol";
-    tempMap[PCPP_PPP_ATCP] =        "AppleTalk Control Protocol";
-    tempMap[PCPP_PPP_IPXCP] =       "Novell IPX Control Protocol";
-    tempMap[PCPP_PPP_BRIDGENCP] =   "Bridging NCP";
-    tempMap[PCPP_PPP_SPCP] =        "Stream Protocol Control Protocol";
-    tempMap[PCPP_PPP_BVCP] =        "Banyan Vines Control Protocol";
-    tempMap[PCPP_PPP_MLCP] =        "Multi-Link Control Protocol";
-    tempMap[PCPP_PPP_NBCP] =        "NETBIOS Framing Control Protocol";
-    tempMap[PCPP_PPP_CISCOCP] =     "Cisco Systems Control Protocol";
-    tempMap[PCPP_PPP_ASCOMCP] =     "Ascom Timeplex";
-    tempMap[PCPP_PPP_LBLBCP] =      "Fujitsu LBLB Control Protocol";
-    tempMap[PCPP_PPP_RLNCP] =       "DCA Remote Lan Network Control Protocol (RLNCP)";
-    tempMap[PCPP_PPP_SDCP] =        "Serial Data Control Protocol (PPP-SDCP)";
-    tempMap[PCPP_PPP_LLCCP] =       "SNA over 802.2 Control Protocol";
-    tempMap[PCPP_PPP_SNACP] =       "SNA Control Protocol";
-    tempMap[PCPP_PPP_IP6HCCP] =     "IP6 Header Compression Control Protocol";
-    tempMap[PCPP_PPP_KNXCP] =       "KNX Bridging Control Protocol";
-    tempMap[PCPP_PPP_ECP] =         "Encryption Control Protocol";
-    tempMap[PCPP_PPP_ILECP] =       "Individual Link Encryption Control Protocol";
-    tempMap[PCPP_PPP_IPV6CP] =      "IPv6 Control Protocol";
-    tempMap[PCPP_PPP_MUXCP] =       "PPP Muxing Control Protocol";
-    tempMap[PCPP_PPP_VSNCP] =       "Vendor-Specific Network Control Protocol (VSNCP)";
-    tempMap[PCPP_PPP_TNCP] =        "TRILL Network Control Protocol";
-    tempMap[PCPP_PPP_STAMPEDECP] =  "Stampede Bridging Control Protocol";
-    tempMap[PCPP_PPP_MPPCP] =       "MP+ Control Protocol";
-    tempMap[PCPP_PPP_IPICP] =       "NTCITS IPI Control Protocol";
-    tempMap[PCPP_PPP_SLCC] =        "Single link compression in multilink control";
-    tempMap[PCPP_PPP_CCP] =         "Compression Control Protocol";
-    tempMap[PCPP_PPP_CDPCP] =       "Cisco Discovery Protocol Control Protocol";
-    tempMap[PCPP_PPP_NETCSCP] =     "Netcs Twin Routing";
-    tempMap[PCPP_PPP_STPCP] =       "STP - Control Protocol";
-    tempMap[PCPP_PPP_EDPCP] =       "EDPCP - Extreme Discovery Protocol Control Protocol";
-    tempMap[PCPP_PPP_ACSPC] =       "Apple Client Server Protocol Control";
-    tempMap[PCPP_PPP_MPLSCP] =      "MPLS Control Protocol";
-    tempMap[PCPP_PPP_P12844CP] =    "IEEE p1284.4 standard - Protocol Control";
-    tempMap[PCPP_PPP_TETRACP] =     "ETSI TETRA TNP1 Control Protocol";
-    tempMap[PCPP_PPP_MFTPCP] =      "Multichannel Flow Treatment Protocol";
-    tempMap[PCPP_PPP_LCP] =         "Link Control Protocol";
-    tempMap[PCPP_PPP_PAP] =         "Password Authentication Protocol";
-    tempMap[PCPP_PPP_LQR] =         "Link Quality Report";
-    tempMap[PCPP_PPP_SPAP] =        "Shiva Password Authentication Protocol";
-    tempMap[PCPP_PPP_CBCP] =        "Callback Control Protocol (CBCP)";
-    tempMap[PCPP_PPP_BACP] =        "BACP Bandwidth Allocation Control Protocol";
-    tempMap[PCPP_PPP_BAP] =         "BAP Bandwidth Allocation Protocol";
-    tempMap[PCPP_PPP_VSAP] =        "Vendor-Specific Authentication Protocol (VSAP)";
-    tempMap[PCPP_PPP_CONTCP] =      "Container Control Protocol";
-    tempMap[PCPP_PPP_CHAP] =        "Challenge Handshake Authentication Protocol";
-    tempMap[PCPP_PPP_RSAAP] =       "RSA Authentication Protocol";
-    tempMap[PCPP_PPP_EAP] =         "Extensible Authentication Protocol";
-    tempMap[PCPP_PPP_SIEP] =        "Mitsubishi Security Information Exchange Protocol (SIEP)";
-    tempMap[PCPP_PPP_SBAP] =        "Stampede Bridging Authorization Protocol";
-    tempMap[PCPP_PPP_PRPAP] =       "Proprietary Authentication Protocol";
-    tempMap[PCPP_PPP_PRPAP2] =      "Proprietary Authentication Protocol";
-    tempMap[PCPP_PPP_PRPNIAP] =     "Proprietary Node ID Authentication Protocol";
-	return tempMap;
+	switch (nextProto)
+	{
+	case PCPP_PPP_PADDING:
+		return "Padding Protocol";
+	case PCPP_PPP_ROHC_SCID:
+		return "ROHC small-CID";
+	case PCPP_PPP_ROHC_LCID:
+		return "ROHC large-CID";
+	case PCPP_PPP_IP:
+		return "Internet Protocol version 4";
+	case PCPP_PPP_OSI:
+		return "OSI Network Layer";
+	case PCPP_PPP_XNSIDP:
+		return "Xerox NS IDP";
+	case PCPP_PPP_DEC4:
+		return "DECnet Phase IV";
+	case PCPP_PPP_AT:
+		return "Appletalk";
+	case PCPP_PPP_IPX:
+		return "Novell IPX";
+	case PCPP_PPP_VJC_COMP:
+		return "Van Jacobson Compressed TCP/IP";
+	case PCPP_PPP_VJC_UNCOMP:
+		return "Van Jacobson Uncompressed TCP/IP";
+	case PCPP_PPP_BCP:
+		return "Bridging PDU";
+	case PCPP_PPP_ST:
+		return "Stream Protocol (ST-II)";
+	case PCPP_PPP_VINES:
+		return "Banyan Vines";
+	case PCPP_PPP_AT_EDDP:
+		return "AppleTalk EDDP";
+	case PCPP_PPP_AT_SB:
+		return "AppleTalk SmartBuffered";
+	case PCPP_PPP_MP:
+		return "Multi-Link";
+	case PCPP_PPP_NB:
+		return "NETBIOS Framing";
+	case PCPP_PPP_CISCO:
+		return "Cisco Systems";
+	case PCPP_PPP_ASCOM:
+		return "Ascom Timeplex";
+	case PCPP_PPP_LBLB:
+		return "Fujitsu Link Backup and Load Balancing (LBLB)";
+	case PCPP_PPP_RL:
+		return "DCA Remote Lan";
+	case PCPP_PPP_SDTP:
+		return "Serial Data Transport Protocol (PPP-SDTP)";
+	case PCPP_PPP_LLC:
+		return "SNA over 802.2";
+	case PCPP_PPP_SNA:
+		return "SNA";
+	case PCPP_PPP_IPV6HC:
+		return "IPv6 Header Compression ";
+	case PCPP_PPP_KNX:
+		return "KNX Bridging Data";
+	case PCPP_PPP_ENCRYPT:
+		return "Encryption";
+	case PCPP_PPP_ILE:
+		return "Individual Link Encryption";
+	case PCPP_PPP_IPV6:
+		return "Internet Protocol version 6";
+	case PCPP_PPP_MUX:
+		return "PPP Muxing";
+	case PCPP_PPP_VSNP:
+		return "Vendor-Specific Network Protocol (VSNP)";
+	case PCPP_PPP_TNP:
+		return "TRILL Network Protocol (TNP)";
+	case PCPP_PPP_RTP_FH:
+		return "RTP IPHC Full Header";
+	case PCPP_PPP_RTP_CTCP:
+		return "RTP IPHC Compressed TCP";
+	case PCPP_PPP_RTP_CNTCP:
+		return "RTP IPHC Compressed Non TCP";
+	case PCPP_PPP_RTP_CUDP8:
+		return "RTP IPHC Compressed UDP 8";
+	case PCPP_PPP_RTP_CRTP8:
+		return "RTP IPHC Compressed RTP 8";
+	case PCPP_PPP_STAMPEDE:
+		return "Stampede Bridging";
+	case PCPP_PPP_MPPLUS:
+		return "MP+ Protocol";
+	case PCPP_PPP_NTCITS_IPI:
+		return "NTCITS IPI";
+	case PCPP_PPP_ML_SLCOMP:
+		return "Single link compression in multilink";
+	case PCPP_PPP_COMP:
+		return "Compressed datagram";
+	case PCPP_PPP_STP_HELLO:
+		return "802.1d Hello Packets";
+	case PCPP_PPP_IBM_SR:
+		return "IBM Source Routing BPDU";
+	case PCPP_PPP_DEC_LB:
+		return "DEC LANBridge100 Spanning Tree";
+	case PCPP_PPP_CDP:
+		return "Cisco Discovery Protocol";
+	case PCPP_PPP_NETCS:
+		return "Netcs Twin Routing";
+	case PCPP_PPP_STP:
+		return "STP - Scheduled Transfer Protocol";
+	case PCPP_PPP_EDP:
+		return "EDP - Extreme Discovery Protocol";
+	case PCPP_PPP_OSCP:
+		return "Optical Supervisory Channel Protocol (OSCP)";
+	case PCPP_PPP_OSCP2:
+		return "Optical Supervisory Channel Protocol (OSCP)";
+	case PCPP_PPP_LUXCOM:
+		return "Luxcom";
+	case PCPP_PPP_SIGMA:
+		return "Sigma Network Systems";
+	case PCPP_PPP_ACSP:
+		return "Apple Client Server Protocol";
+	case PCPP_PPP_MPLS_UNI:
+		return "MPLS Unicast";
+	case PCPP_PPP_MPLS_MULTI:
+		return "MPLS Multicast";
+	case PCPP_PPP_P12844:
+		return "IEEE p1284.4 standard - data packets";
+	case PCPP_PPP_TETRA:
+		return "ETSI TETRA Network Protocol Type 1";
+	case PCPP_PPP_MFTP:
+		return "Multichannel Flow Treatment Protocol";
+	case PCPP_PPP_RTP_CTCPND:
+		return "RTP IPHC Compressed TCP No Delta";
+	case PCPP_PPP_RTP_CS:
+		return "RTP IPHC Context State";
+	case PCPP_PPP_RTP_CUDP16:
+		return "RTP IPHC Compressed UDP 16";
+	case PCPP_PPP_RTP_CRDP16:
+		return "RTP IPHC Compressed RTP 16";
+	case PCPP_PPP_CCCP:
+		return "Cray Communications Control Protocol";
+	case PCPP_PPP_CDPD_MNRP:
+		return "CDPD Mobile Network Registration Protocol";
+	case PCPP_PPP_EXPANDAP:
+		return "Expand accelerator protocol";
+	case PCPP_PPP_ODSICP:
+		return "ODSICP NCP";
+	case PCPP_PPP_DOCSIS:
+		return "DOCSIS DLL";
+	case PCPP_PPP_CETACEANNDP:
+		return "Cetacean Network Detection Protocol";
+	case PCPP_PPP_LZS:
+		return "Stacker LZS";
+	case PCPP_PPP_REFTEK:
+		return "RefTek Protocol";
+	case PCPP_PPP_FC:
+		return "Fibre Channel";
+	case PCPP_PPP_EMIT:
+		return "EMIT Protocols";
+	case PCPP_PPP_VSP:
+		return "Vendor-Specific Protocol (VSP)";
+	case PCPP_PPP_TLSP:
+		return "TRILL Link State Protocol (TLSP)";
+	case PCPP_PPP_IPCP:
+		return "Internet Protocol Control Protocol";
+	case PCPP_PPP_OSINLCP:
+		return "OSI Network Layer Control Protocol";
+	case PCPP_PPP_XNSIDPCP:
+		return "Xerox NS IDP Control Protocol";
+	case PCPP_PPP_DECNETCP:
+		return "DECnet Phase IV Control Protocol";
+	case PCPP_PPP_ATCP:
+		return "AppleTalk Control Protocol";
+	case PCPP_PPP_IPXCP:
+		return "Novell IPX Control Protocol";
+	case PCPP_PPP_BRIDGENCP:
+		return "Bridging NCP";
+	case PCPP_PPP_SPCP:
+		return "Stream Protocol Control Protocol";
+	case PCPP_PPP_BVCP:
+		return "Banyan Vines Control Protocol";
+	case PCPP_PPP_MLCP:
+		return "Multi-Link Control Protocol";
+	case PCPP_PPP_NBCP:
+		return "NETBIOS Framing Control Protocol";
+	case PCPP_PPP_CISCOCP:
+		return "Cisco Systems Control Protocol";
+	case PCPP_PPP_ASCOMCP:
+		return "Ascom Timeplex";
+	case PCPP_PPP_LBLBCP:
+		return "Fujitsu LBLB Control Protocol";
+	case PCPP_PPP_RLNCP:
+		return "DCA Remote Lan Network Control Protocol (RLNCP)";
+	case PCPP_PPP_SDCP:
+		return "Serial Data Control Protocol (PPP-SDCP)";
+	case PCPP_PPP_LLCCP:
+		return "SNA over 802.2 Control Protocol";
+	case PCPP_PPP_SNACP:
+		return "SNA Control Protocol";
+	case PCPP_PPP_IP6HCCP:
+		return "IP6 Header Compression Control Protocol";
+	case PCPP_PPP_KNXCP:
+		return "KNX Bridging Control Protocol";
+	case PCPP_PPP_ECP:
+		return "Encryption Control Protocol";
+	case PCPP_PPP_ILECP:
+		return "Individual Link Encryption Control Protocol";
+	case PCPP_PPP_IPV6CP:
+		return "IPv6 Control Protocol";
+	case PCPP_PPP_MUXCP:
+		return "PPP Muxing Control Protocol";
+	case PCPP_PPP_VSNCP:
+		return "Vendor-Specific Network Control Protocol (VSNCP)";
+	case PCPP_PPP_TNCP:
+		return "TRILL Network Control Protocol";
+	case PCPP_PPP_STAMPEDECP:
+		return "Stampede Bridging Control Protocol";
+	case PCPP_PPP_MPPCP:
+		return "MP+ Control Protocol";
+	case PCPP_PPP_IPICP:
+		return "NTCITS IPI Control Protocol";
+	case PCPP_PPP_SLCC:
+		return "Single link compression in multilink control";
+	case PCPP_PPP_CCP:
+		return "Compression Control Protocol";
+	case PCPP_PPP_CDPCP:
+		return "Cisco Discovery Protocol Control Protocol";
+	case PCPP_PPP_NETCSCP:
+		return "Netcs Twin Routing";
+	case PCPP_PPP_STPCP:
+		return "STP - Control Protocol";
+	case PCPP_PPP_EDPCP:
+		return "EDPCP - Extreme Discovery Protocol Control Protocol";
+	case PCPP_PPP_ACSPC:
+		return "Apple Client Server Protocol Control";
+	case PCPP_PPP_MPLSCP:
+		return "MPLS Control Protocol";
+	case PCPP_PPP_P12844CP:
+		return "IEEE p1284.4 standard - Protocol Control";
+	case PCPP_PPP_TETRACP:
+		return "ETSI TETRA TNP1 Control Protocol";
+	case PCPP_PPP_MFTPCP:
+		return "Multichannel Flow Treatment Protocol";
+	case PCPP_PPP_LCP:
+		return "Link Control Protocol";
+	case PCPP_PPP_PAP:
+		return "Password Authentication Protocol";
+	case PCPP_PPP_LQR:
+		return "Link Quality Report";
+	case PCPP_PPP_SPAP:
+		return "Shiva Password Authentication Protocol";
+	case PCPP_PPP_CBCP:
+		return "Callback Control Protocol (CBCP)";
+	case PCPP_PPP_BACP:
+		return "BACP Bandwidth Allocation Control Protocol";
+	case PCPP_PPP_BAP:
+		return "BAP Bandwidth Allocation Protocol";
+	case PCPP_PPP_VSAP:
+		return "Vendor-Specific Authentication Protocol (VSAP)";
+	case PCPP_PPP_CONTCP:
+		return "Container Control Protocol";
+	case PCPP_PPP_CHAP:
+		return "Challenge Handshake Authentication Protocol";
+	case PCPP_PPP_RSAAP:
+		return "RSA Authentication Protocol";
+	case PCPP_PPP_EAP:
+		return "Extensible Authentication Protocol";
+	case PCPP_PPP_SIEP:
+		return "Mitsubishi Security Information Exchange Protocol (SIEP)";
+	case PCPP_PPP_SBAP:
+		return "Stampede Bridging Authorization Protocol";
+	case PCPP_PPP_PRPAP:
+		return "Proprietary Authentication Protocol";
+	case PCPP_PPP_PRPAP2:
+		return "Proprietary Authentication Protocol";
+	case PCPP_PPP_PRPNIAP:
+		return "Proprietary Node ID Authentication Protocol";
+	default:
+		return NULL;
+	}
 }
 
-const std::map<uint16_t, std::string> PPPNextProtoToString = createPPPNextProtoToStringMap();
-
 std::string PPPoESessionLayer::toString()
 {
-	std::map<uint16_t, std::string>::const_iterator iter = PPPNextProtoToString.find(getPPPNextProtocol());
+	const char* nextProtoName = getPPPNextProtoName(getPPPNextProtocol());
 	std::string nextProtocol;
-	if (iter != PPPNextProtoToString.end())
-		nextProtocol = iter->second;
+	if (nextProtoName != NULL)
+		nextProtocol = nextProtoName;
 	else
 	{
 		std::ostringstream stream;
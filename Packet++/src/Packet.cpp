@@ -9,13 +9,11 @@
 #include "PayloadLayer.h"
 #include "PacketTrailerLayer.h"
 #include "Logger.h"
+#include "TimestampClock.h"
+#include "LatencyTracer.h"
 #include <string.h>
 #include <typeinfo>
 #include <sstream>
-#ifdef _MSC_VER
-#include <time.h>
-#include "SystemUtils.h"
-#endif
 
 
 namespace pcpp
@@ -27,10 +25,15 @@ Packet::Packet(size_t maxPacketLen) :
 	m_LastLayer(NULL),
 	m_ProtocolTypes(UnknownProtocol),
 	m_MaxPacketLen(maxPacketLen),
-	m_FreeRawPacket(true)
+	m_FreeRawPacket(true),
+	m_LayerArena(NULL),
+	m_OwnLayerArena(false),
+	m_LazyParsing(false),
+	m_PendingLayer(NULL),
+	m_ParseUntil(UnknownProtocol),
+	m_ParseUntilLayer(OsiModelLayerUnknown)
 {
-	timeval time;
-	gettimeofday(&time, NULL);
+	timespec time = TimestampClock::now();
 	uint8_t* data = new uint8_t[m_MaxPacketLen];
 	memset(data, 0, m_MaxPacketLen);
 	m_RawPacket = new RawPacket((const uint8_t*)data, 0, time, true, LINKTYPE_ETHERNET);
@@ -38,54 +41,93 @@ Packet::Packet(size_t maxPacketLen) :
 
 void Packet::setRawPacket(RawPacket* rawPacket, bool freeRawPacket, ProtocolType parseUntil, OsiModelLayer parseUntilLayer)
 {
+	PCPP_LATENCY_TRACE_BEGIN(parseStart);
+
 	destructPacketData();
 
 	m_FirstLayer = NULL;
 	m_LastLayer = NULL;
+	m_PendingLayer = NULL;
 	m_ProtocolTypes = UnknownProtocol;
-	m_MaxPacketLen = rawPacket->getRawDataLen();
 	m_FreeRawPacket = freeRawPacket;
 	m_RawPacket = rawPacket;
 	if (m_RawPacket == NULL)
 		return;
 
-	LinkLayerType linkType = m_RawPacket->getLinkLayerType();
+	m_MaxPacketLen = m_RawPacket->getRawDataLen();
 
-	m_FirstLayer = createFirstLayer(linkType);
+	m_ParseUntil = parseUntil;
+	m_ParseUntilLayer = parseUntilLayer;
 
+	m_FirstLayer = createFirstLayer(m_RawPacket->getLinkLayerType());
 	m_LastLayer = m_FirstLayer;
-	Layer* curLayer = m_FirstLayer;
-	while (curLayer != NULL && (curLayer->getProtocol() & parseUntil) == 0 && curLayer->getOsiModelLayer() <= parseUntilLayer)
+
+	if (acceptParsedLayer(m_FirstLayer))
 	{
-		m_ProtocolTypes |= curLayer->getProtocol();
-		curLayer->parseNextLayer();
-		curLayer->m_IsAllocatedInPacket = true;
-		curLayer = curLayer->getNextLayer();
-		if (curLayer != NULL)
-			m_LastLayer = curLayer;
+		m_PendingLayer = m_FirstLayer;
+		m_PendingLayer->m_IsParsePending = true;
 	}
 
-	if (curLayer != NULL && (curLayer->getProtocol() & parseUntil) != 0)
+	// in lazy parsing mode the rest of the layers are parsed on demand
+	if (!m_LazyParsing)
+		parseRemainingLayers();
+
+	PCPP_LATENCY_TRACE_END(parseStart, LatencyStageParse, LatencyStageRxToParse);
+}
+
+bool Packet::acceptParsedLayer(Layer* layer)
+{
+	// the layer is above the requested OSI model layer - remove it
+	if (layer->getOsiModelLayer() > m_ParseUntilLayer)
 	{
-		m_ProtocolTypes |= curLayer->getProtocol();
-		curLayer->m_IsAllocatedInPacket = true;
+		m_LastLayer = layer->getPrevLayer();
+		if (m_LastLayer != NULL)
+			m_LastLayer->m_NextLayer = NULL;
+		else
+			m_FirstLayer = NULL;
+		delete layer;
+		return false;
 	}
 
-	if (curLayer != NULL &&  curLayer->getOsiModelLayer() > parseUntilLayer)
+	registerLayerProtocol(layer);
+	layer->m_IsAllocatedInPacket = true;
+	m_LastLayer = layer;
+
+	// stop parsing if this is the requested protocol (inclusive)
+	return (layer->getProtocol() & m_ParseUntil) == 0;
+}
+
+void Packet::parsePendingLayer()
+{
+	Layer* curLayer = m_PendingLayer;
+	if (curLayer == NULL)
+		return;
+
+	m_PendingLayer = NULL;
+	curLayer->m_IsParsePending = false;
+
+	curLayer->parseNextLayer();
+	Layer* nextLayer = curLayer->m_NextLayer;
+
+	if (nextLayer != NULL)
 	{
-		m_LastLayer = curLayer->getPrevLayer();
-		delete curLayer;
-		m_LastLayer->m_NextLayer = NULL;
+		if (acceptParsedLayer(nextLayer))
+		{
+			m_PendingLayer = nextLayer;
+			m_PendingLayer->m_IsParsePending = true;
+		}
+
+		return;
 	}
 
-	if (parseUntil == UnknownProtocol && parseUntilLayer == OsiModelLayerUnknown)
+	if (m_ParseUntil == UnknownProtocol && m_ParseUntilLayer == OsiModelLayerUnknown)
 	{
 		// find if there is data left in the raw packet that doesn't belong to any layer. In that case it's probably a packet trailer.
 		// create a PacketTrailerLayer layer and add it at the end of the packet
 		int trailerLen = (int)((m_RawPacket->getRawData() + m_RawPacket->getRawDataLen()) - (m_LastLayer->getData() + m_LastLayer->getDataLen()));
 		if (trailerLen > 0)
 		{
-			PacketTrailerLayer* trailerLayer = new PacketTrailerLayer(
+			PacketTrailerLayer* trailerLayer = new(this) PacketTrailerLayer(
 					(uint8_t*)(m_LastLayer->getData() + m_LastLayer->getDataLen()),
 					trailerLen,
 					m_LastLayer,
@@ -94,46 +136,73 @@ void Packet::setRawPacket(RawPacket* rawPacket, bool freeRawPacket, ProtocolType
 			trailerLayer->m_IsAllocatedInPacket = true;
 			m_LastLayer->setNextLayer(trailerLayer);
 			m_LastLayer = trailerLayer;
-			m_ProtocolTypes |= trailerLayer->getProtocol();
+			registerLayerProtocol(trailerLayer);
 		}
 	}
 }
 
+void Packet::parseRemainingLayers()
+{
+	while (m_PendingLayer != NULL)
+		parsePendingLayer();
+}
+
+bool Packet::parseUntilProtocolFound(uint64_t protocolMask)
+{
+	while (m_PendingLayer != NULL && (m_ProtocolTypes & protocolMask) == 0)
+		parsePendingLayer();
+
+	return (m_ProtocolTypes & protocolMask) != 0;
+}
+
 Packet::Packet(RawPacket* rawPacket, bool freeRawPacket, ProtocolType parseUntil, OsiModelLayer parseUntilLayer)
 {
+	m_LayerArena = NULL;
+	m_OwnLayerArena = false;
 	m_FreeRawPacket = false;
 	m_RawPacket = NULL;
 	m_FirstLayer = NULL;
+	m_LazyParsing = false;
 	setRawPacket(rawPacket, freeRawPacket, parseUntil, parseUntilLayer);
 }
 
 Packet::Packet(RawPacket* rawPacket, ProtocolType parseUntil)
 {
+	m_LayerArena = NULL;
+	m_OwnLayerArena = false;
 	m_FreeRawPacket = false;
 	m_RawPacket = NULL;
 	m_FirstLayer = NULL;
+	m_LazyParsing = false;
 	setRawPacket(rawPacket, false, parseUntil, OsiModelLayerUnknown);
 }
 
 Packet::Packet(RawPacket* rawPacket, OsiModelLayer parseUntilLayer)
 {
+	m_LayerArena = NULL;
+	m_OwnLayerArena = false;
 	m_FreeRawPacket = false;
 	m_RawPacket = NULL;
 	m_FirstLayer = NULL;
+	m_LazyParsing = false;
 	setRawPacket(rawPacket, false, UnknownProtocol, parseUntilLayer);
 }
 
 Packet::Packet(const Packet& other)
 {
+	m_LayerArena = NULL;
+	m_OwnLayerArena = false;
+	m_LazyParsing = false;
 	copyDataFrom(other);
 }
 
 void Packet::destructPacketData()
 {
+	// layers that weren't parsed yet (in lazy parsing mode) don't exist so there's no need to parse them
 	Layer* curLayer = m_FirstLayer;
 	while (curLayer != NULL)
 	{
-		Layer* nextLayer = curLayer->getNextLayer();
+		Layer* nextLayer = curLayer->m_NextLayer;
 		if (curLayer->m_IsAllocatedInPacket)
 			delete curLayer;
 		curLayer = nextLayer;
@@ -145,6 +214,58 @@ void Packet::destructPacketData()
 	}
 }
 
+void Packet::setLayerArena(LayerArena* arena, bool ownArena)
+{
+	if (arena != m_LayerArena)
+		releaseLayerArena();
+
+	m_LayerArena = arena;
+	m_OwnLayerArena = (arena != NULL && ownArena);
+}
+
+void Packet::releaseLayerArena()
+{
+	// layers that are still allocated from the arena may be in use (either by this packet or by the user if they were detached),
+	// so the arena is deleted only once they're all freed
+	if (m_LayerArena != NULL && m_OwnLayerArena)
+		m_LayerArena->deleteWhenEmpty();
+
+	m_LayerArena = NULL;
+	m_OwnLayerArena = false;
+}
+
+void Packet::registerLayerProtocol(Layer* layer)
+{
+	// layers are registered in the order they appear in the packet, so only the first layer of each protocol is indexed
+	uint64_t protocol = layer->getProtocol();
+	if (protocol == UnknownProtocol)
+		return;
+
+	if ((m_ProtocolTypes & protocol) == 0)
+		m_LayerIndex[getProtocolIndex(protocol)] = layer;
+
+	m_ProtocolTypes |= protocol;
+}
+
+void Packet::updateLayerIndex(ProtocolType protocol)
+{
+	if (protocol == UnknownProtocol)
+		return;
+
+	Layer* curLayer = m_FirstLayer;
+	while (curLayer != NULL && curLayer->getProtocol() != protocol)
+		curLayer = curLayer->getNextLayer();
+
+	if (curLayer == NULL)
+	{
+		m_ProtocolTypes &= ~((uint64_t)protocol);
+		return;
+	}
+
+	m_LayerIndex[getProtocolIndex(protocol)] = curLayer;
+	m_ProtocolTypes |= protocol;
+}
+
 Packet& Packet::operator=(const Packet& other)
 {
 	destructPacketData();
@@ -154,17 +275,76 @@ Packet& Packet::operator=(const Packet& other)
 	return *this;
 }
 
+#if __cplusplus > 199711L || _MSC_VER >= 1800
+Packet::Packet(Packet&& other)
+{
+	moveDataFrom(other);
+}
+
+Packet& Packet::operator=(Packet&& other)
+{
+	if (this == &other)
+		return *this;
+
+	destructPacketData();
+	releaseLayerArena();
+
+	moveDataFrom(other);
+
+	return *this;
+}
+#endif
+
+void Packet::moveDataFrom(Packet& other)
+{
+	m_RawPacket = other.m_RawPacket;
+	m_FreeRawPacket = other.m_FreeRawPacket;
+	m_MaxPacketLen = other.m_MaxPacketLen;
+	m_FirstLayer = other.m_FirstLayer;
+	m_LastLayer = other.m_LastLayer;
+	m_ProtocolTypes = other.m_ProtocolTypes;
+	m_LayerArena = other.m_LayerArena;
+	m_OwnLayerArena = other.m_OwnLayerArena;
+	m_LazyParsing = other.m_LazyParsing;
+	m_PendingLayer = other.m_PendingLayer;
+	m_ParseUntil = other.m_ParseUntil;
+	m_ParseUntilLayer = other.m_ParseUntilLayer;
+	memcpy(m_LayerIndex, other.m_LayerIndex, sizeof(m_LayerIndex));
+
+	// the pending layer and the layer index move here with the layers, so a lazily parsed packet continues parsing where the source
+	// stopped. Layers call back into their packet (for example for parsing the next layer or for extending the packet), so point them
+	// to this instance. The source is reset to an empty packet below
+	for (Layer* curLayer = m_FirstLayer; curLayer != NULL; curLayer = curLayer->m_NextLayer)
+		curLayer->m_Packet = this;
+
+	other.m_RawPacket = NULL;
+	other.m_FreeRawPacket = false;
+	other.m_MaxPacketLen = 0;
+	other.m_FirstLayer = NULL;
+	other.m_LastLayer = NULL;
+	other.m_ProtocolTypes = UnknownProtocol;
+	other.m_LayerArena = NULL;
+	other.m_OwnLayerArena = false;
+	other.m_PendingLayer = NULL;
+	other.m_ParseUntil = UnknownProtocol;
+	other.m_ParseUntilLayer = OsiModelLayerUnknown;
+}
+
 void Packet::copyDataFrom(const Packet& other)
 {
 	m_RawPacket = new RawPacket(*(other.m_RawPacket));
 	m_FreeRawPacket = true;
 	m_MaxPacketLen = other.m_MaxPacketLen;
-	m_ProtocolTypes = other.m_ProtocolTypes;
+	m_ProtocolTypes = UnknownProtocol;
+	m_PendingLayer = NULL;
+	m_ParseUntil = UnknownProtocol;
+	m_ParseUntilLayer = OsiModelLayerUnknown;
 	m_FirstLayer = createFirstLayer(m_RawPacket->getLinkLayerType());
 	m_LastLayer = m_FirstLayer;
 	Layer* curLayer = m_FirstLayer;
 	while (curLayer != NULL)
 	{
+		registerLayerProtocol(curLayer);
 		curLayer->parseNextLayer();
 		curLayer->m_IsAllocatedInPacket = true;
 		curLayer = curLayer->getNextLayer();
@@ -177,6 +357,8 @@ void Packet::reallocateRawData(size_t newSize)
 {
 	LOG_DEBUG("Allocating packet to new size: %d", (int)newSize);
 
+	parseRemainingLayers();
+
 	// allocate a new array with size newSize
 	m_MaxPacketLen = newSize;
 
@@ -200,9 +382,106 @@ void Packet::reallocateRawData(size_t newSize)
 	}
 }
 
+Packet* Packet::clone()
+{
+	if (m_RawPacket == NULL || !m_RawPacket->isPacketSet())
+	{
+		LOG_ERROR("Packet has no raw data");
+		return NULL;
+	}
+
+	RawPacket* rawPacket = new RawPacket();
+	const uint8_t* prevRawData = m_RawPacket->getRawData();
+	if (!rawPacket->shareRawData(*m_RawPacket))
+	{
+		delete rawPacket;
+		return NULL;
+	}
+
+	// data which isn't owned by the raw packet is copied to a buffer it owns before it's shared
+	if (m_RawPacket->getRawData() != prevRawData)
+	{
+		m_MaxPacketLen = m_RawPacket->getRawDataLen();
+		rebaseLayers(prevRawData);
+	}
+
+	Packet* result = new Packet((RawPacket*)NULL);
+	result->setLazyParsing(true);
+	result->setRawPacket(rawPacket, true, m_ParseUntil, m_ParseUntilLayer);
+	return result;
+}
+
+bool Packet::unshareRawData()
+{
+	if (m_RawPacket == NULL || !m_RawPacket->isRawDataShared())
+		return true;
+
+	// the buffer of this packet may be larger than its data, so it keeps its length
+	const uint8_t* prevRawData = m_RawPacket->getRawData();
+	if (!m_RawPacket->unshareRawData(m_MaxPacketLen))
+	{
+		LOG_ERROR("Couldn't copy the shared raw data of the packet");
+		return false;
+	}
+
+	rebaseLayers(prevRawData);
+	return true;
+}
+
+void Packet::rebaseLayers(const uint8_t* prevRawData)
+{
+	// layers that weren't parsed yet are parsed from the data of the last parsed layer, so only existing layers are moved
+	uint8_t* rawData = (uint8_t*)m_RawPacket->getRawData();
+	for (Layer* curLayer = m_FirstLayer; curLayer != NULL; curLayer = curLayer->m_NextLayer)
+		curLayer->m_Data = rawData + (curLayer->m_Data - prevRawData);
+}
+
+void Packet::updateMaxPacketLen(size_t prevHeadroom)
+{
+	// the end of the buffer doesn't move when data is inserted into the headroom or removed into it, so the buffer length from the
+	// beginning of the data changes by the same amount the headroom does
+	size_t headroom = m_RawPacket->getHeadroom();
+	m_MaxPacketLen = m_MaxPacketLen + prevHeadroom - headroom;
+}
+
+bool Packet::reserveHeadroom(size_t headroom)
+{
+	if (m_RawPacket == NULL)
+	{
+		LOG_ERROR("Packet has no raw packet");
+		return false;
+	}
+
+	parseRemainingLayers();
+	if (!unshareRawData())
+		return false;
+
+	if (!m_RawPacket->reserveHeadroom(headroom, m_MaxPacketLen))
+	{
+		LOG_ERROR("Couldn't reserve %d bytes of headroom in raw packet", (int)headroom);
+		return false;
+	}
+
+	if ((size_t)m_RawPacket->getRawDataLen() > m_MaxPacketLen)
+		m_MaxPacketLen = m_RawPacket->getRawDataLen();
+
+	// set all data pointers in layers to the new array address
+	const uint8_t* dataPtr = m_RawPacket->getRawData();
+
+	Layer* curLayer = m_FirstLayer;
+	while (curLayer != NULL)
+	{
+		curLayer->m_Data = (uint8_t*)dataPtr;
+		dataPtr += curLayer->getHeaderLen();
+		curLayer = curLayer->getNextLayer();
+	}
+
+	return true;
+}
+
 bool Packet::addLayer(Layer* newLayer, bool ownInPacket)
 {
-	return insertLayer(m_LastLayer, newLayer, ownInPacket);
+	return insertLayer(getLastLayer(), newLayer, ownInPacket);
 }
 
 bool Packet::insertLayer(Layer* prevLayer, Layer* newLayer, bool ownInPacket)
@@ -225,7 +504,13 @@ bool Packet::insertLayer(Layer* prevLayer, Layer* newLayer, bool ownInPacket)
 		return false;
 	}
 
-	if (m_RawPacket->getRawDataLen() + newLayer->getHeaderLen() > m_MaxPacketLen)
+	parseRemainingLayers();
+	if (!unshareRawData())
+		return false;
+
+	// if the raw packet has enough headroom the data is inserted into it, otherwise the buffer may need to grow
+	size_t headroom = m_RawPacket->getHeadroom();
+	if (headroom < newLayer->getHeaderLen() && m_RawPacket->getRawDataLen() + newLayer->getHeaderLen() > m_MaxPacketLen)
 	{
 		// reallocate to maximum value of: twice the max size of the packet or max size + new required length
 		if (m_RawPacket->getRawDataLen() + newLayer->getHeaderLen() > m_MaxPacketLen*2)
@@ -241,6 +526,7 @@ bool Packet::insertLayer(Layer* prevLayer, Layer* newLayer, bool ownInPacket)
 	if (prevLayer != NULL)
 		indexToInsertData = prevLayer->m_Data+prevLayer->getHeaderLen() - m_RawPacket->getRawData();
 	m_RawPacket->insertData(indexToInsertData, newLayer->m_Data, appendDataLen);
+	updateMaxPacketLen(headroom);
 
 	//delete previous layer data
 	delete[] newLayer->m_Data;
@@ -268,6 +554,11 @@ bool Packet::insertLayer(Layer* prevLayer, Layer* newLayer, bool ownInPacket)
 	// assign layer with this packet only
 	newLayer->m_Packet = this;
 
+	// the previous layer's calculated fields (such as the next protocol and the length) depend on the new layer
+	newLayer->m_IsModified = true;
+	if (prevLayer != NULL)
+		prevLayer->m_IsModified = true;
+
 	// Set flag to indicate if new layer is allocated to packet.
 	if(ownInPacket)
 	   newLayer->m_IsAllocatedInPacket = true;
@@ -306,8 +597,9 @@ bool Packet::insertLayer(Layer* prevLayer, Layer* newLayer, bool ownInPacket)
 		curLayer = curLayer->getNextLayer();
 	}
 
-	// add layer protocol to protocol collection
-	m_ProtocolTypes |= newLayer->getProtocol();
+	// add layer protocol to protocol collection. The new layer may have been inserted before another layer of the same protocol
+	// so the index entry of this protocol is looked up again
+	updateLayerIndex(newLayer->getProtocol());
 	return true;
 }
 
@@ -412,6 +704,10 @@ bool Packet::removeLayer(Layer* layer, bool tryToDelete)
 		return false;
 	}
 
+	parseRemainingLayers();
+	if (!unshareRawData())
+		return false;
+
 	// before removing the layer's data, copy it so it can be later assigned as the removed layer's data
 	size_t layerOldDataSize = layer->getHeaderLen();
 	uint8_t* layerOldData = new uint8_t[layerOldDataSize];
@@ -420,18 +716,27 @@ bool Packet::removeLayer(Layer* layer, bool tryToDelete)
 	// remove data from raw packet
 	size_t numOfBytesToRemove = layer->getHeaderLen();
 	int indexOfDataToRemove = layer->m_Data - m_RawPacket->getRawData();
+	size_t headroom = m_RawPacket->getHeadroom();
 	if (!m_RawPacket->removeData(indexOfDataToRemove, numOfBytesToRemove))
 	{
 		LOG_ERROR("Couldn't remove data from packet");
 		delete [] layerOldData;
 		return false;
 	}
+	updateMaxPacketLen(headroom);
 
-	// remove layer from layers linked list
+	// remove layer from layers linked list. The neighbours of the removed layer need to be computed (for example the next protocol of the
+	// previous layer and the pseudo-header checksum of the next layer)
 	if (layer->m_PrevLayer != NULL)
+	{
 		layer->m_PrevLayer->setNextLayer(layer->m_NextLayer);
+		layer->m_PrevLayer->m_IsModified = true;
+	}
 	if (layer->m_NextLayer != NULL)
+	{
 		layer->m_NextLayer->setPrevLayer(layer->m_PrevLayer);
+		layer->m_NextLayer->m_IsModified = true;
+	}
 
 	// take care of head and tail ptrs
 	if (m_FirstLayer == layer)
@@ -454,8 +759,8 @@ bool Packet::removeLayer(Layer* layer, bool tryToDelete)
 
 	curLayer = m_FirstLayer;
 
-	// a flag to be set if there is another layer in this packet with the same protocol
-	bool anotherLayerWithSameProtocolExists = false;
+	// the first layer in this packet with the same protocol as the removed layer, if exists
+	Layer* firstLayerWithSameProtocol = NULL;
 
 	// go over all layers from the first layer to the last layer and set the data ptr and data length for each one
 	while (curLayer != NULL)
@@ -472,8 +777,8 @@ bool Packet::removeLayer(Layer* layer, bool tryToDelete)
 			curLayer->m_DataLen = dataLen - packetTrailerLen;
 
 		// check if current layer's protocol is the same as removed layer protocol and set the flag accordingly
-		if (curLayer->getProtocol() == layer->getProtocol())
-			anotherLayerWithSameProtocolExists = true;
+		if (firstLayerWithSameProtocol == NULL && curLayer->getProtocol() == layer->getProtocol())
+			firstLayerWithSameProtocol = curLayer;
 
 		// advance data ptr and data length
 		dataPtr += curLayer->getHeaderLen();
@@ -483,9 +788,11 @@ bool Packet::removeLayer(Layer* layer, bool tryToDelete)
 		curLayer = curLayer->getNextLayer();
 	}
 
-	// remove layer protocol from protocol list if necessary
-	if (!anotherLayerWithSameProtocolExists)
+	// remove layer protocol from protocol list if necessary, otherwise make sure the layer index points to a layer that is still in the packet
+	if (firstLayerWithSameProtocol == NULL)
 		m_ProtocolTypes &= ~((uint64_t)layer->getProtocol());
+	else if (layer->getProtocol() != UnknownProtocol)
+		m_LayerIndex[getProtocolIndex(layer->getProtocol())] = firstLayerWithSameProtocol;
 
 	// if layer was allocated by this packet and tryToDelete flag is set, delete it
 	if (tryToDelete && layer->m_IsAllocatedInPacket)
@@ -506,6 +813,14 @@ bool Packet::removeLayer(Layer* layer, bool tryToDelete)
 
 Layer* Packet::getLayerOfType(ProtocolType layerType, int index)
 {
+	if (index == 0 && isSingleProtocol(layerType))
+	{
+		if (!containsProtocol(layerType))
+			return NULL;
+
+		return m_LayerIndex[getProtocolIndex(layerType)];
+	}
+
 	Layer* curLayer = getFirstLayer();
 	int curIndex = 0;
 	while (curLayer != NULL)
@@ -538,7 +853,12 @@ bool Packet::extendLayer(Layer* layer, int offsetInLayer, size_t numOfBytesToExt
 		return false;
 	}
 
-	if (m_RawPacket->getRawDataLen() + numOfBytesToExtend > m_MaxPacketLen)
+	parseRemainingLayers();
+	if (!unshareRawData())
+		return false;
+
+	size_t headroom = m_RawPacket->getHeadroom();
+	if (headroom < numOfBytesToExtend && m_RawPacket->getRawDataLen() + numOfBytesToExtend > m_MaxPacketLen)
 	{
 		// reallocate to maximum value of: twice the max size of the packet or max size + new required length
 		if (m_RawPacket->getRawDataLen() + numOfBytesToExtend > m_MaxPacketLen*2)
@@ -547,11 +867,14 @@ bool Packet::extendLayer(Layer* layer, int offsetInLayer, size_t numOfBytesToExt
 			reallocateRawData(m_MaxPacketLen*2);
 	}
 
+	layer->m_IsModified = true;
+
 	// insert layer data to raw packet
 	int indexToInsertData = layer->m_Data + offsetInLayer - m_RawPacket->getRawData();
 	uint8_t* tempData = new uint8_t[numOfBytesToExtend];
 	m_RawPacket->insertData(indexToInsertData, tempData, numOfBytesToExtend);
 	delete[] tempData;
+	updateMaxPacketLen(headroom);
 
 	// re-calculate all layers data ptr and data length
 	const uint8_t* dataPtr = m_RawPacket->getRawData();
@@ -596,13 +919,20 @@ bool Packet::shortenLayer(Layer* layer, int offsetInLayer, size_t numOfBytesToSh
 		return false;
 	}
 
+	parseRemainingLayers();
+	if (!unshareRawData())
+		return false;
+
 	// remove data from raw packet
 	int indexOfDataToRemove = layer->m_Data + offsetInLayer - m_RawPacket->getRawData();
+	size_t headroom = m_RawPacket->getHeadroom();
 	if (!m_RawPacket->removeData(indexOfDataToRemove, numOfBytesToShorten))
 	{
 		LOG_ERROR("Couldn't remove data from packet");
 		return false;
 	}
+	updateMaxPacketLen(headroom);
+	layer->m_IsModified = true;
 
 	// re-calculate all layers data ptr and data length
 	const uint8_t* dataPtr = m_RawPacket->getRawData();
@@ -632,14 +962,22 @@ bool Packet::shortenLayer(Layer* layer, int offsetInLayer, size_t numOfBytesToSh
 	return true;
 }
 
-void Packet::computeCalculateFields()
+void Packet::computeCalculateFields(bool onlyModifiedLayers)
 {
-	// calculated fields should be calculated from top layer to bottom layer
+	// calculated fields should be calculated from top layer to bottom layer. A layer needs to be computed if it or any layer following it
+	// was modified, since its calculated fields (lengths, checksums) cover the following layers
 
-	Layer* curLayer = m_LastLayer;
+	bool followingLayerModified = !onlyModifiedLayers;
+	Layer* curLayer = getLastLayer();
 	while (curLayer != NULL)
 	{
-		curLayer->computeCalculateFields();
+		if (curLayer->m_IsModified)
+			followingLayerModified = true;
+
+		if (followingLayerModified)
+			curLayer->computeCalculateFields();
+
+		curLayer->m_IsModified = false;
 		curLayer = curLayer->getPrevLayer();
 	}
 }
@@ -647,6 +985,7 @@ void Packet::computeCalculateFields()
 Packet::~Packet()
 {
 	destructPacketData();
+	releaseLayerArena();
 }
 
 std::string Packet::printPacketInfo(bool timeAsLocalTime)
@@ -679,47 +1018,43 @@ Layer* Packet::createFirstLayer(LinkLayerType linkType)
 {
 	if (linkType == LINKTYPE_ETHERNET)
 	{
-		return new EthLayer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), this);
+		return new(this) EthLayer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), this);
 	}
 	else if (linkType == LINKTYPE_LINUX_SLL)
 	{
-		return new SllLayer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), this);
+		return new(this) SllLayer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), this);
 	}
 	else if (linkType == LINKTYPE_NULL)
 	{
-		return new NullLoopbackLayer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), this);
+		return new(this) NullLoopbackLayer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), this);
 	}
 	else if (linkType == LINKTYPE_RAW || linkType == LINKTYPE_DLT_RAW1 || linkType == LINKTYPE_DLT_RAW2)
 	{
 		uint8_t ipVer = m_RawPacket->getRawData()[0] & 0xf0;
 		if (ipVer == 0x40)
 		{
-			return new IPv4Layer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), NULL, this);
+			return new(this) IPv4Layer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), NULL, this);
 		}
 		else if (ipVer == 0x60)
 		{
-			return new IPv6Layer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), NULL, this);
+			return new(this) IPv6Layer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), NULL, this);
 		}
 		else
 		{
-			return new PayloadLayer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), NULL, this);
+			return new(this) PayloadLayer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), NULL, this);
 		}
 	}
 
 	// unknown link type
-	return new EthLayer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), this);
+	return new(this) EthLayer((uint8_t*)m_RawPacket->getRawData(), m_RawPacket->getRawDataLen(), this);
 }
 
 std::string Packet::toString(bool timeAsLocalTime)
 {
-	std::vector<std::string> stringList;
 	std::string result;
-	toStringList(stringList, timeAsLocalTime);
-	for (std::vector<std::string>::iterator iter = stringList.begin(); iter != stringList.end(); iter++)
-	{
-		result += *iter + "\n";
-	}
-
+	PacketDumpWriter writer(result);
+	writer.setTimeAsLocalTime(timeAsLocalTime);
+	writer.writePacket(*this);
 	return result;
 }
 
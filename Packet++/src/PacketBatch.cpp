@@ -0,0 +1,141 @@
+#define LOG_MODULE PacketLogModulePacket
+
+#include "PacketBatch.h"
+#include "Logger.h"
+
+namespace pcpp
+{
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PCPP_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PCPP_PREFETCH(addr)
+#endif
+
+PacketBatch::PacketBatch(size_t capacity, size_t layerArenaSize) :
+	m_Capacity(capacity),
+	m_Count(0),
+	m_PrefetchDistance(DefaultPrefetchDistance),
+	m_ProtocolTypes(capacity),
+	m_NetworkLayerOffsets(capacity),
+	m_TransportLayerOffsets(capacity)
+{
+	m_Packets = new Packet[m_Capacity];
+	for (size_t i = 0; i < m_Capacity; i++)
+	{
+		m_Packets[i].setLayerArena(new LayerArena(layerArenaSize), true);
+		m_Packets[i].setLazyParsing(true);
+	}
+}
+
+PacketBatch::~PacketBatch()
+{
+	delete [] m_Packets;
+}
+
+size_t PacketBatch::parse(RawPacket** rawPackets, size_t count, OsiModelLayer scanUntilLayer)
+{
+	if (count > m_Capacity)
+	{
+		LOG_DEBUG("Batch capacity is %d, only the first %d packets out of %d will be parsed", (int)m_Capacity, (int)m_Capacity, (int)count);
+		count = m_Capacity;
+	}
+
+	// prime the pipeline: the raw packets are fetched two distances ahead and their data one distance ahead, since the data pointer is
+	// read from the raw packet
+	size_t prefetchDistance = m_PrefetchDistance;
+	for (size_t i = 0; i < prefetchDistance * 2 && i < count; i++)
+	{
+		if (rawPackets[i] != NULL)
+			PCPP_PREFETCH(rawPackets[i]);
+	}
+	for (size_t i = 0; i < prefetchDistance && i < count; i++)
+	{
+		if (rawPackets[i] != NULL)
+			PCPP_PREFETCH(rawPackets[i]->getRawData());
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		// fetch the headers of the next packets while the current packet is being parsed
+		if (prefetchDistance > 0)
+		{
+			if (i + prefetchDistance * 2 < count && rawPackets[i + prefetchDistance * 2] != NULL)
+				PCPP_PREFETCH(rawPackets[i + prefetchDistance * 2]);
+			if (i + prefetchDistance < count && rawPackets[i + prefetchDistance] != NULL)
+				PCPP_PREFETCH(rawPackets[i + prefetchDistance]->getRawData());
+		}
+
+		m_Packets[i].setRawPacket(rawPackets[i], false);
+		scanPacket(i, scanUntilLayer);
+	}
+
+	// free the layers of packets left from the previous batch
+	for (size_t i = count; i < m_Count; i++)
+		m_Packets[i].setRawPacket(NULL, false);
+
+	m_Count = count;
+	return m_Count;
+}
+
+void PacketBatch::scanPacket(size_t index, OsiModelLayer scanUntilLayer)
+{
+	uint64_t protocolTypes = UnknownProtocol;
+	uint16_t networkLayerOffset = NoOffset;
+	uint16_t transportLayerOffset = NoOffset;
+
+	Packet& packet = m_Packets[index];
+	const uint8_t* rawData = (packet.getRawPacketReadOnly() != NULL ? packet.getRawPacketReadOnly()->getRawData() : NULL);
+
+	Layer* curLayer = packet.getFirstLayer();
+	while (curLayer != NULL)
+	{
+		ProtocolType protocol = curLayer->getProtocol();
+		protocolTypes |= protocol;
+
+		size_t offset = (size_t)(curLayer->getData() - rawData);
+		if (offset < NoOffset)
+		{
+			if (networkLayerOffset == NoOffset && (protocol & IP) != 0)
+				networkLayerOffset = (uint16_t)offset;
+			else if (transportLayerOffset == NoOffset && (protocol & (TCP | UDP)) != 0)
+				transportLayerOffset = (uint16_t)offset;
+		}
+
+		// don't parse the next layer if the requested layer was reached
+		if (curLayer->getOsiModelLayer() >= scanUntilLayer)
+			break;
+
+		curLayer = curLayer->getNextLayer();
+	}
+
+	m_ProtocolTypes[index] = protocolTypes;
+	m_NetworkLayerOffsets[index] = networkLayerOffset;
+	m_TransportLayerOffsets[index] = transportLayerOffset;
+}
+
+void PacketBatch::clear()
+{
+	for (size_t i = 0; i < m_Count; i++)
+		m_Packets[i].setRawPacket(NULL, false);
+
+	m_Count = 0;
+}
+
+Packet* PacketBatch::getPacket(size_t index)
+{
+	if (index >= m_Count)
+		return NULL;
+
+	return &m_Packets[index];
+}
+
+RawPacket* PacketBatch::getRawPacket(size_t index)
+{
+	if (index >= m_Count)
+		return NULL;
+
+	return m_Packets[index].getRawPacket();
+}
+
+} // namespace pcpp
@@ -0,0 +1,156 @@
+#include "PacketDeduplicator.h"
+#include "PacketView.h"
+#include <string.h>
+
+#define IPV4_MIN_HEADER_LENGTH 20
+#define IPV4_MAX_HEADER_LENGTH 60
+#define IPV6_HEADER_LENGTH 40
+
+namespace pcpp
+{
+
+static inline uint64_t mixWord(uint64_t hash, uint64_t word)
+{
+	hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+	return hash ^ (hash >> 29);
+}
+
+static uint64_t hashBytes(uint64_t hash, const uint8_t* data, size_t len)
+{
+	for (; len >= sizeof(uint64_t); data += sizeof(uint64_t), len -= sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, data, sizeof(word));
+		hash = mixWord(hash, word);
+	}
+
+	// the length is mixed into the last word so data which differs only in trailing zeros gets a different hash
+	uint64_t word = 0;
+	memcpy(&word, data, len);
+	return mixWord(hash, word ^ ((uint64_t)len << 56));
+}
+
+PacketDeduplicator::PacketDeduplicator(const PacketDeduplicatorConfiguration& config) :
+	m_Config(config),
+	m_Table(FlowTableConfiguration(config.maxEntries, (config.windowUs < 0xffffffff ? config.windowUs + 1 : config.windowUs), EvictOldestFirst,
+			config.memoryBudget))
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+uint64_t PacketDeduplicator::hashPacket(const uint8_t* data, size_t dataLen, LinkLayerType linkType, size_t payloadPrefixLength, bool* isIP)
+{
+	PacketView view;
+	if (!FlowKeyExtractor::extract(data, dataLen, linkType, view) || view.networkOffset == PacketView::NoOffset)
+	{
+		if (isIP != NULL)
+			*isIP = false;
+		return hashInteger(hashBytes(0, data, dataLen));
+	}
+
+	if (isIP != NULL)
+		*isIP = true;
+
+	// copy the IP header and clear the fields routers on the way between capture points change
+	const uint8_t* ipHeader = data + view.networkOffset;
+	size_t ipDataLen = dataLen - view.networkOffset;
+	uint8_t header[IPV4_MAX_HEADER_LENGTH];
+	size_t headerLen;
+	size_t ipLength;
+	if (view.ipVersion == 4)
+	{
+		headerLen = (size_t)(ipHeader[0] & 0x0f) * 4;
+		if (headerLen < IPV4_MIN_HEADER_LENGTH || headerLen > ipDataLen)
+			headerLen = IPV4_MIN_HEADER_LENGTH;
+		memcpy(header, ipHeader, headerLen);
+		header[8] = 0;
+		header[10] = 0;
+		header[11] = 0;
+		ipLength = ((size_t)ipHeader[2] << 8) | ipHeader[3];
+	}
+	else
+	{
+		headerLen = IPV6_HEADER_LENGTH;
+		memcpy(header, ipHeader, headerLen);
+		header[7] = 0;
+		ipLength = (((size_t)ipHeader[4] << 8) | ipHeader[5]) + IPV6_HEADER_LENGTH;
+	}
+
+	// Ethernet padding and trailers some taps append aren't part of the identity. A packet whose IP length is too small (for example 0
+	// with segmentation offload) is hashed up to the end of the captured data
+	if (ipLength <= headerLen || ipLength > ipDataLen)
+		ipLength = ipDataLen;
+
+	size_t prefixLen = ipLength - headerLen;
+	if (prefixLen > payloadPrefixLength)
+		prefixLen = payloadPrefixLength;
+
+	uint64_t hash = hashBytes(view.ipVersion, header, headerLen);
+	hash = hashBytes(hash, ipHeader + headerLen, prefixLen);
+	return hashInteger(hash);
+}
+
+bool PacketDeduplicator::isDuplicate(const RawPacket* rawPacket)
+{
+	timespec ts = rawPacket->getPacketTimeStampNs();
+	uint64_t timestampUs = (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+	return isDuplicate(rawPacket->getRawData(), (size_t)rawPacket->getRawDataLen(), rawPacket->getLinkLayerType(), timestampUs);
+}
+
+bool PacketDeduplicator::isDuplicate(const uint8_t* data, size_t dataLen, LinkLayerType linkType, uint64_t timestampUs)
+{
+	m_Stats.packets++;
+	m_Table.advanceTime(timestampUs);
+
+	bool isIP;
+	uint64_t hash = hashPacket(data, dataLen, linkType, m_Config.payloadPrefixLength, &isIP);
+	if (!isIP)
+		m_Stats.nonIpPackets++;
+
+	bool isNew;
+	uint64_t& firstSeen = m_Table.get(hash, &isNew);
+	if (!isNew)
+	{
+		// copies from different sources may be processed slightly out of timestamp order
+		uint64_t timeDiff = (timestampUs >= firstSeen ? timestampUs - firstSeen : firstSeen - timestampUs);
+		if (timeDiff <= m_Config.windowUs)
+		{
+			m_Stats.duplicates++;
+			return true;
+		}
+	}
+
+	// a new packet, or a packet seen again after its window ended, starts a new window
+	firstSeen = timestampUs;
+	return false;
+}
+
+int PacketDeduplicator::filterBurst(RawPacket** packets, int numOfPackets)
+{
+	int numOfUnique = 0;
+	for (int i = 0; i < numOfPackets; i++)
+	{
+		if (isDuplicate(packets[i]))
+			continue;
+
+		RawPacket* packet = packets[i];
+		packets[i] = packets[numOfUnique];
+		packets[numOfUnique] = packet;
+		numOfUnique++;
+	}
+
+	return numOfUnique;
+}
+
+void PacketDeduplicator::clear()
+{
+	m_Table.clear();
+}
+
+void PacketDeduplicator::getStats(PacketDeduplicatorStats& stats) const
+{
+	stats = m_Stats;
+	stats.evictions = m_Table.getNumOfEvictions();
+}
+
+} // namespace pcpp
@@ -0,0 +1,380 @@
+#include "PacketDumpWriter.h"
+#include "Packet.h"
+#include "IpAddress.h"
+#include "MacAddress.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+namespace pcpp
+{
+
+// formats an unsigned number into the end of a buffer and returns a pointer to its first digit
+static inline char* formatNumber(char* bufferEnd, uint64_t value)
+{
+	char* pos = bufferEnd;
+	do
+	{
+		*--pos = (char)('0' + value % 10);
+		value /= 10;
+	} while (value > 0);
+	return pos;
+}
+
+PacketDumpWriter::PacketDumpWriter(std::string& buffer, Format format) : m_Buffer(buffer)
+{
+	m_Format = format;
+	m_Indent = NULL;
+	m_TimeAsLocalTime = true;
+	m_NewLineAfterLayer = true;
+	m_NumOfLayersInPacket = -1;
+}
+
+const char* PacketDumpWriter::getProtocolName(ProtocolType protocol)
+{
+	switch (protocol)
+	{
+	case Ethernet:
+		return "eth";
+	case IPv4:
+		return "ipv4";
+	case IPv6:
+		return "ipv6";
+	case TCP:
+		return "tcp";
+	case UDP:
+		return "udp";
+	case HTTPRequest:
+		return "http_request";
+	case HTTPResponse:
+		return "http_response";
+	case ARP:
+		return "arp";
+	case VLAN:
+		return "vlan";
+	case ICMP:
+		return "icmp";
+	case PPPoESession:
+		return "pppoe_session";
+	case PPPoEDiscovery:
+		return "pppoe_discovery";
+	case DNS:
+		return "dns";
+	case MPLS:
+		return "mpls";
+	case GREv0:
+		return "gre_v0";
+	case GREv1:
+		return "gre_v1";
+	case PPP_PPTP:
+		return "ppp_pptp";
+	case SSL:
+		return "ssl";
+	case SLL:
+		return "sll";
+	case DHCP:
+		return "dhcp";
+	case NULL_LOOPBACK:
+		return "null_loopback";
+	case IGMPv1:
+		return "igmp_v1";
+	case IGMPv2:
+		return "igmp_v2";
+	case IGMPv3:
+		return "igmp_v3";
+	case GenericPayload:
+		return "payload";
+	case VXLAN:
+		return "vxlan";
+	case SIPRequest:
+		return "sip_request";
+	case SIPResponse:
+		return "sip_response";
+	case SDP:
+		return "sdp";
+	case PacketTrailer:
+		return "trailer";
+	case Radius:
+		return "radius";
+	case GTPv1:
+		return "gtp_v1";
+	default:
+		return "unknown";
+	}
+}
+
+void PacketDumpWriter::appendTimestamp(Packet& packet)
+{
+	timespec timestamp = packet.getRawPacketReadOnly()->getPacketTimeStampNs();
+	char buf[96];
+
+	if (m_Format == JsonLinesFormat)
+	{
+		int len = snprintf(buf, sizeof(buf), "%llu.%09lu", (unsigned long long)timestamp.tv_sec, (unsigned long)timestamp.tv_nsec);
+		m_Buffer.append(buf, len);
+		return;
+	}
+
+	// the same format as Packet#toString()
+	time_t nowtime = timestamp.tv_sec;
+	struct tm *nowtm = NULL;
+	if (m_TimeAsLocalTime)
+		nowtm = localtime(&nowtime);
+	else
+		nowtm = gmtime(&nowtime);
+
+	char tmbuf[64];
+	int len;
+	if (nowtm != NULL)
+	{
+		strftime(tmbuf, sizeof(tmbuf), "%Y-%m-%d %H:%M:%S", nowtm);
+		len = snprintf(buf, sizeof(buf), "%s.%06lu", tmbuf, (unsigned long)(timestamp.tv_nsec / 1000));
+	}
+	else
+		len = snprintf(buf, sizeof(buf), "0000-00-00 00:00:00.000000");
+	m_Buffer.append(buf, len);
+}
+
+void PacketDumpWriter::writePacket(Packet& packet)
+{
+	if (m_Format == TextFormat)
+	{
+		if (m_Indent != NULL)
+			m_Buffer += m_Indent;
+		m_Buffer += "Packet length: ";
+		writeNumber((uint64_t)packet.getRawPacketReadOnly()->getRawDataLen());
+		m_Buffer += " [Bytes], Arrival time: ";
+		appendTimestamp(packet);
+		m_Buffer += '\n';
+	}
+	else
+	{
+		m_Buffer += "{\"length\":";
+		writeNumber((uint64_t)packet.getRawPacketReadOnly()->getRawDataLen());
+		m_Buffer += ",\"timestamp\":";
+		appendTimestamp(packet);
+		m_Buffer += ",\"layers\":[";
+	}
+
+	m_NumOfLayersInPacket = 0;
+	for (Layer* curLayer = packet.getFirstLayer(); curLayer != NULL; curLayer = curLayer->getNextLayer())
+		writeLayer(*curLayer);
+	m_NumOfLayersInPacket = -1;
+
+	if (m_Format == JsonLinesFormat)
+		m_Buffer += "]}\n";
+}
+
+void PacketDumpWriter::writeLayer(Layer& layer)
+{
+	layer.dump(*this);
+}
+
+std::string PacketDumpWriter::layerToString(Layer& layer)
+{
+	std::string result;
+	PacketDumpWriter writer(result);
+	writer.m_NewLineAfterLayer = false;
+	layer.dump(writer);
+	return result;
+}
+
+void PacketDumpWriter::beginLayer(const char* textTitle, ProtocolType protocol)
+{
+	if (m_Format == TextFormat)
+	{
+		if (m_Indent != NULL)
+			m_Buffer += m_Indent;
+		m_Buffer += textTitle;
+		return;
+	}
+
+	// layers of a packet are separated by commas in its layers array
+	if (m_NumOfLayersInPacket > 0)
+		m_Buffer += ',';
+	if (m_NumOfLayersInPacket >= 0)
+		m_NumOfLayersInPacket++;
+	m_Buffer += "{\"layer\":\"";
+	m_Buffer += getProtocolName(protocol);
+	m_Buffer += '"';
+}
+
+void PacketDumpWriter::endLayer()
+{
+	if (m_Format == JsonLinesFormat)
+		m_Buffer += '}';
+	else if (m_NewLineAfterLayer)
+		m_Buffer += '\n';
+}
+
+void PacketDumpWriter::addLayerSummary(const std::string& summary, ProtocolType protocol)
+{
+	if (m_Format == TextFormat)
+	{
+		if (m_Indent != NULL)
+			m_Buffer += m_Indent;
+		m_Buffer += summary;
+	}
+	else
+	{
+		beginLayer(NULL, protocol);
+		m_Buffer += ",\"summary\":";
+		appendJsonString(summary.c_str());
+	}
+	endLayer();
+}
+
+void PacketDumpWriter::beginField(const char* textKey, const char* jsonKey)
+{
+	if (m_Format == TextFormat)
+	{
+		m_Buffer += ", ";
+		m_Buffer += textKey;
+		m_Buffer += ": ";
+	}
+	else
+	{
+		m_Buffer += ",\"";
+		m_Buffer += jsonKey;
+		m_Buffer += "\":";
+	}
+}
+
+void PacketDumpWriter::appendJsonString(const char* value)
+{
+	m_Buffer += '"';
+	for (const char* pos = value; *pos != '\0'; pos++)
+	{
+		unsigned char c = (unsigned char)*pos;
+		if (c == '"' || c == '\\')
+		{
+			m_Buffer += '\\';
+			m_Buffer += (char)c;
+		}
+		else if (c < 0x20)
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)c);
+			m_Buffer += escaped;
+		}
+		else
+			m_Buffer += (char)c;
+	}
+	m_Buffer += '"';
+}
+
+void PacketDumpWriter::addNumber(const char* textKey, const char* jsonKey, uint64_t value)
+{
+	const char* key = (m_Format == TextFormat ? textKey : jsonKey);
+	if (key == NULL)
+		return;
+
+	beginField(textKey, jsonKey);
+	writeNumber(value);
+}
+
+void PacketDumpWriter::addString(const char* textKey, const char* jsonKey, const char* value)
+{
+	const char* key = (m_Format == TextFormat ? textKey : jsonKey);
+	if (key == NULL)
+		return;
+
+	beginField(textKey, jsonKey);
+	if (m_Format == TextFormat)
+		m_Buffer += value;
+	else
+		appendJsonString(value);
+}
+
+void PacketDumpWriter::addBool(const char* textKey, const char* jsonKey, bool value)
+{
+	const char* key = (m_Format == TextFormat ? textKey : jsonKey);
+	if (key == NULL)
+		return;
+
+	beginField(textKey, jsonKey);
+	m_Buffer += (value ? "true" : "false");
+}
+
+void PacketDumpWriter::addIPAddress(const char* textKey, const char* jsonKey, const IPAddress& value)
+{
+	const char* key = (m_Format == TextFormat ? textKey : jsonKey);
+	if (key == NULL)
+		return;
+
+	beginField(textKey, jsonKey);
+	char buf[MAX_ADDR_STRING_LEN];
+	size_t len = value.toString(buf, sizeof(buf));
+	if (m_Format == JsonLinesFormat)
+		m_Buffer += '"';
+	m_Buffer.append(buf, len);
+	if (m_Format == JsonLinesFormat)
+		m_Buffer += '"';
+}
+
+void PacketDumpWriter::addMacAddress(const char* textKey, const char* jsonKey, const MacAddress& value)
+{
+	const char* key = (m_Format == TextFormat ? textKey : jsonKey);
+	if (key == NULL)
+		return;
+
+	beginField(textKey, jsonKey);
+	char buf[MAX_MAC_STRING_LEN];
+	size_t len = value.toString(buf, sizeof(buf));
+	if (m_Format == JsonLinesFormat)
+		m_Buffer += '"';
+	m_Buffer.append(buf, len);
+	if (m_Format == JsonLinesFormat)
+		m_Buffer += '"';
+}
+
+void PacketDumpWriter::addText(const char* text)
+{
+	if (m_Format != TextFormat)
+		return;
+
+	m_Buffer += ", ";
+	m_Buffer += text;
+}
+
+void PacketDumpWriter::appendText(const char* text)
+{
+	if (m_Format == TextFormat)
+		m_Buffer += text;
+}
+
+void PacketDumpWriter::appendNumber(uint64_t value)
+{
+	if (m_Format == TextFormat)
+		writeNumber(value);
+}
+
+void PacketDumpWriter::writeNumber(uint64_t value)
+{
+	char buf[24];
+	char* end = buf + sizeof(buf);
+	char* start = formatNumber(end, value);
+	m_Buffer.append(start, end - start);
+}
+
+void PacketDumpWriter::appendIPAddress(const IPAddress& value)
+{
+	if (m_Format != TextFormat)
+		return;
+
+	char buf[MAX_ADDR_STRING_LEN];
+	size_t len = value.toString(buf, sizeof(buf));
+	m_Buffer.append(buf, len);
+}
+
+void PacketDumpWriter::appendMacAddress(const MacAddress& value)
+{
+	if (m_Format != TextFormat)
+		return;
+
+	char buf[MAX_MAC_STRING_LEN];
+	size_t len = value.toString(buf, sizeof(buf));
+	m_Buffer.append(buf, len);
+}
+
+} // namespace pcpp
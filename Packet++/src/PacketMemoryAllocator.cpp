@@ -0,0 +1,285 @@
+#define LOG_MODULE PacketLogModulePacketMemoryAllocator
+
+#include "PacketMemoryAllocator.h"
+#include "Logger.h"
+#include <errno.h>
+#include <string.h>
+#include <new>
+#if defined(LINUX)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(LINUX)
+// the huge page size flags of mmap(), which older headers don't define
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+// the memory policies of mbind(), defined in numaif.h which requires libnuma
+#define PCPP_MPOL_PREFERRED 1
+#define PCPP_MPOL_BIND 2
+#define PCPP_MAX_NUMA_NODES 1024
+#endif
+
+// blocks carved out of a region start on a cache line
+#define PCPP_BLOCK_ALIGNMENT 64
+
+namespace pcpp
+{
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// PacketMemoryAllocator members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class HeapPacketMemoryAllocator : public PacketMemoryAllocator
+{
+public:
+	uint8_t* allocate(size_t size) { return new uint8_t[size]; }
+	void deallocate(uint8_t* memory, size_t size) { delete [] memory; }
+};
+
+PacketMemoryAllocator* PacketMemoryAllocator::getHeapAllocator()
+{
+	static HeapPacketMemoryAllocator heapAllocator;
+	return &heapAllocator;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// HugePagePacketMemoryAllocator members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+HugePagePacketMemoryAllocator::HugePagePacketMemoryAllocator(HugePageSize pageSize, int numaNode, size_t regionSize, bool allowFallback)
+{
+	m_PageSize = (pageSize == HugePage1GB ? (size_t)1024 * 1024 * 1024 : (size_t)2 * 1024 * 1024);
+	m_NumaNode = (numaNode >= 0 ? numaNode : -1);
+	if (regionSize == 0)
+		regionSize = (pageSize == HugePage1GB ? m_PageSize : DefaultRegionSize);
+	m_RegionSize = (regionSize + m_PageSize - 1) / m_PageSize * m_PageSize;
+	m_AllowFallback = allowFallback;
+	m_CurRegion = NULL;
+	m_CurRegionOffset = 0;
+	m_HugePageBytes = 0;
+	m_FallbackBytes = 0;
+	m_NumOfHugePageFailures = 0;
+	pthread_mutex_init(&m_Mutex, NULL);
+}
+
+HugePagePacketMemoryAllocator::~HugePagePacketMemoryAllocator()
+{
+	for (std::map<uint8_t*, Region>::iterator iter = m_Regions.begin(); iter != m_Regions.end(); iter++)
+	{
+		if (iter->second.numOfBlocks > 0)
+			LOG_DEBUG("Huge page allocator is destructed while %d blocks are still in use", (int)iter->second.numOfBlocks);
+		unmapRegion(iter->first, iter->second);
+	}
+
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+uint8_t* HugePagePacketMemoryAllocator::mapRegion(size_t size, bool& hugePages)
+{
+#if defined(LINUX)
+	int hugePageFlag = (m_PageSize > (size_t)2 * 1024 * 1024 ? MAP_HUGE_1GB : MAP_HUGE_2MB);
+	unsigned long nodeMask[PCPP_MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+	if (m_NumaNode >= 0 && m_NumaNode < PCPP_MAX_NUMA_NODES)
+	{
+		memset(nodeMask, 0, sizeof(nodeMask));
+		nodeMask[m_NumaNode / (8 * sizeof(unsigned long))] |= (1UL << (m_NumaNode % (8 * sizeof(unsigned long))));
+	}
+
+	void* result = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | hugePageFlag, -1, 0);
+	if (result != MAP_FAILED)
+	{
+		// huge pages are taken from the pool of the node when they're first touched, so binding after mapping is enough
+		if (m_NumaNode >= 0 && m_NumaNode < PCPP_MAX_NUMA_NODES &&
+				syscall(SYS_mbind, result, size, (m_AllowFallback ? PCPP_MPOL_PREFERRED : PCPP_MPOL_BIND), nodeMask, (unsigned long)PCPP_MAX_NUMA_NODES, 0) != 0)
+			LOG_DEBUG("Cannot bind huge page region to NUMA node %d: %s", m_NumaNode, strerror(errno));
+
+		hugePages = true;
+		return (uint8_t*)result;
+	}
+
+	m_NumOfHugePageFailures++;
+	LOG_DEBUG("Cannot map %llu bytes with huge pages of %llu bytes: %s", (unsigned long long)size, (unsigned long long)m_PageSize, strerror(errno));
+	if (!m_AllowFallback)
+	{
+		LOG_ERROR("Cannot map %llu bytes with huge pages and falling back to regular pages is disabled", (unsigned long long)size);
+		return NULL;
+	}
+
+	result = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (result == MAP_FAILED)
+	{
+		LOG_ERROR("Cannot map %llu bytes: %s", (unsigned long long)size, strerror(errno));
+		return NULL;
+	}
+
+#ifdef MADV_HUGEPAGE
+	if (madvise(result, size, MADV_HUGEPAGE) != 0)
+		LOG_DEBUG("Cannot advise transparent huge pages for region: %s", strerror(errno));
+#endif
+
+	if (m_NumaNode >= 0 && m_NumaNode < PCPP_MAX_NUMA_NODES &&
+			syscall(SYS_mbind, result, size, PCPP_MPOL_PREFERRED, nodeMask, (unsigned long)PCPP_MAX_NUMA_NODES, 0) != 0)
+		LOG_DEBUG("Cannot bind region to NUMA node %d: %s", m_NumaNode, strerror(errno));
+
+	hugePages = false;
+	return (uint8_t*)result;
+#else
+	m_NumOfHugePageFailures++;
+	if (!m_AllowFallback)
+	{
+		LOG_ERROR("Huge pages aren't supported on this platform and falling back to regular pages is disabled");
+		return NULL;
+	}
+
+	hugePages = false;
+	return new (std::nothrow) uint8_t[size];
+#endif
+}
+
+void HugePagePacketMemoryAllocator::unmapRegion(uint8_t* start, const Region& region)
+{
+	if (region.hugePages)
+		m_HugePageBytes -= region.size;
+	else
+		m_FallbackBytes -= region.size;
+
+#if defined(LINUX)
+	munmap(start, region.size);
+#else
+	delete [] start;
+#endif
+}
+
+uint8_t* HugePagePacketMemoryAllocator::allocate(size_t size)
+{
+	if (size == 0)
+		return NULL;
+
+	size_t alignedSize = (size + PCPP_BLOCK_ALIGNMENT - 1) & ~((size_t)PCPP_BLOCK_ALIGNMENT - 1);
+
+	pthread_mutex_lock(&m_Mutex);
+
+	uint8_t* result = NULL;
+	if (alignedSize > m_RegionSize)
+	{
+		// a block larger than a region gets a mapping of its own, which is unmapped as soon as the block is freed
+		Region region;
+		region.size = (alignedSize + m_PageSize - 1) / m_PageSize * m_PageSize;
+		region.numOfBlocks = 1;
+		result = mapRegion(region.size, region.hugePages);
+		if (result != NULL)
+		{
+			(region.hugePages ? m_HugePageBytes : m_FallbackBytes) += region.size;
+			m_Regions[result] = region;
+		}
+	}
+	else
+	{
+		if (m_CurRegion == NULL || m_CurRegionOffset + alignedSize > m_RegionSize)
+		{
+			Region region;
+			region.size = m_RegionSize;
+			region.numOfBlocks = 0;
+			uint8_t* newRegion = mapRegion(region.size, region.hugePages);
+			if (newRegion != NULL)
+			{
+				(region.hugePages ? m_HugePageBytes : m_FallbackBytes) += region.size;
+				m_Regions[newRegion] = region;
+
+				// the previous region can be unmapped once it's no longer current and all of its blocks were freed
+				std::map<uint8_t*, Region>::iterator prevRegion = m_Regions.find(m_CurRegion);
+				if (prevRegion != m_Regions.end() && prevRegion->second.numOfBlocks == 0)
+				{
+					unmapRegion(prevRegion->first, prevRegion->second);
+					m_Regions.erase(prevRegion);
+				}
+
+				m_CurRegion = newRegion;
+				m_CurRegionOffset = 0;
+			}
+		}
+
+		if (m_CurRegion != NULL && m_CurRegionOffset + alignedSize <= m_RegionSize)
+		{
+			result = m_CurRegion + m_CurRegionOffset;
+			m_CurRegionOffset += alignedSize;
+			m_Regions[m_CurRegion].numOfBlocks++;
+		}
+	}
+
+	pthread_mutex_unlock(&m_Mutex);
+
+	return result;
+}
+
+void HugePagePacketMemoryAllocator::deallocate(uint8_t* memory, size_t size)
+{
+	if (memory == NULL)
+		return;
+
+	pthread_mutex_lock(&m_Mutex);
+
+	// the region of the block is the last region which starts at or before it
+	std::map<uint8_t*, Region>::iterator iter = m_Regions.upper_bound(memory);
+	if (iter != m_Regions.begin())
+		iter--;
+	if (iter == m_Regions.end() || memory < iter->first || memory >= iter->first + iter->second.size || iter->second.numOfBlocks == 0)
+	{
+		pthread_mutex_unlock(&m_Mutex);
+		LOG_ERROR("Memory wasn't allocated from this allocator");
+		return;
+	}
+
+	iter->second.numOfBlocks--;
+	if (iter->second.numOfBlocks == 0)
+	{
+		// the current region is kept and carved from its start again
+		if (iter->first == m_CurRegion)
+		{
+			m_CurRegionOffset = 0;
+		}
+		else
+		{
+			unmapRegion(iter->first, iter->second);
+			m_Regions.erase(iter);
+		}
+	}
+
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+size_t HugePagePacketMemoryAllocator::getHugePageBytes()
+{
+	pthread_mutex_lock(&m_Mutex);
+	size_t result = m_HugePageBytes;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+size_t HugePagePacketMemoryAllocator::getFallbackBytes()
+{
+	pthread_mutex_lock(&m_Mutex);
+	size_t result = m_FallbackBytes;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+uint64_t HugePagePacketMemoryAllocator::getNumOfHugePageFailures()
+{
+	pthread_mutex_lock(&m_Mutex);
+	uint64_t result = m_NumOfHugePageFailures;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+} // namespace pcpp
@@ -0,0 +1,235 @@
+#include "PacketReorderBuffer.h"
+#include "AtomicUtils.h"
+#include "TimestampClock.h"
+
+namespace pcpp
+{
+
+static inline void storeMax(volatile uint64_t* ptr, uint64_t value)
+{
+	uint64_t current = atomicLoadRelaxed(ptr);
+	while (current < value && !atomicCompareExchange(ptr, current, value))
+		current = atomicLoadRelaxed(ptr);
+}
+
+enum SlotState
+{
+	// the slot waits for the packet of its sequence number
+	SlotFree = 0,
+	// a worker claimed the slot and is writing the packet
+	SlotWriting = 1,
+	// the slot holds the packet of its sequence number
+	SlotFull = 2
+};
+
+static inline uint64_t makeState(uint64_t sequence, SlotState slotState)
+{
+	return (sequence << 2) | (uint64_t)slotState;
+}
+
+PacketReorderBuffer::PacketReorderBuffer(const PacketReorderBufferConfiguration& config, uint64_t firstSequence)
+{
+	m_WindowSize = 2;
+	while (m_WindowSize < config.windowSize)
+		m_WindowSize <<= 1;
+	m_Mask = m_WindowSize - 1;
+	m_TimeoutNs = config.timeoutNs;
+
+	m_Slots = new Slot[m_WindowSize];
+	for (uint64_t sequence = firstSequence; sequence < firstSequence + m_WindowSize; sequence++)
+	{
+		m_Slots[sequence & m_Mask].state = makeState(sequence, SlotFree);
+		m_Slots[sequence & m_Mask].packet = NULL;
+	}
+
+	m_InsertedEnd = firstSequence;
+	m_RejectedEnd = firstSequence;
+	m_NextAssigned = firstSequence;
+	m_NextSequence = firstSequence;
+	m_Waiting = false;
+	m_WaitStartNs = 0;
+	resetStats();
+}
+
+PacketReorderBuffer::~PacketReorderBuffer()
+{
+	delete [] m_Slots;
+}
+
+uint64_t PacketReorderBuffer::assignSequence(uint32_t count)
+{
+	return atomicFetchAdd(&m_NextAssigned, count);
+}
+
+PacketReorderBuffer::InsertResult PacketReorderBuffer::insert(uint64_t sequence, RawPacket* packet)
+{
+	Slot& slot = m_Slots[sequence & m_Mask];
+	uint64_t freeState = makeState(sequence, SlotFree);
+	while (true)
+	{
+		uint64_t state = atomicLoadAcquire(&slot.state);
+		if (state == freeState)
+		{
+			// the draining thread may skip the sequence number meanwhile, then the packet is late
+			if (atomicCompareExchange(&slot.state, freeState, makeState(sequence, SlotWriting)))
+				break;
+			continue;
+		}
+
+		uint64_t slotSequence = state >> 2;
+		if (slotSequence > sequence)
+		{
+			atomicFetchAdd(&m_LatePackets, 1);
+			return Late;
+		}
+
+		if (slotSequence == sequence)
+		{
+			atomicFetchAdd(&m_DuplicatePackets, 1);
+			return Duplicate;
+		}
+
+		// the slot still waits for the sequence number one window earlier
+		storeMax(&m_RejectedEnd, sequence + 1);
+		atomicFetchAdd(&m_WindowFullPackets, 1);
+		return WindowFull;
+	}
+
+	slot.packet = packet;
+	atomicStoreRelease(&slot.state, makeState(sequence, SlotFull));
+	storeMax(&m_InsertedEnd, sequence + 1);
+	return Inserted;
+}
+
+bool PacketReorderBuffer::skipMissing(uint64_t sequence)
+{
+	// fails if a worker claimed the slot since it was read
+	return atomicCompareExchange(&m_Slots[sequence & m_Mask].state, makeState(sequence, SlotFree), makeState(sequence + m_WindowSize, SlotFree));
+}
+
+size_t PacketReorderBuffer::drain(const timespec& now, RawPacket** packets, size_t maxPackets)
+{
+	uint64_t nowNs = TimestampClock::toNs(now);
+	uint64_t sequence = m_NextSequence;
+	size_t numOfPackets = 0;
+
+	while (numOfPackets < maxPackets)
+	{
+		Slot& slot = m_Slots[sequence & m_Mask];
+		uint64_t state = atomicLoadAcquire(&slot.state);
+
+		if (state == makeState(sequence, SlotFull))
+		{
+			RawPacket* packet = slot.packet;
+			slot.packet = NULL;
+			atomicStoreRelease(&slot.state, makeState(sequence + m_WindowSize, SlotFree));
+			sequence++;
+			m_Waiting = false;
+
+			if (packet != NULL)
+			{
+				packets[numOfPackets++] = packet;
+				m_ReleasedPackets++;
+			}
+			else
+				m_EmptySequences++;
+
+			continue;
+		}
+
+		// a worker is writing the packet, it's there in a moment
+		if (state != makeState(sequence, SlotFree))
+			break;
+
+		// the sequence number is missing. Skip it if a rejected packet needs the window to move, or if it was waited for long enough
+		bool skip = (sequence + m_WindowSize < atomicLoadRelaxed(&m_RejectedEnd));
+		if (!skip)
+		{
+			// nothing is held back, the packet may simply not be received yet
+			if (atomicLoadAcquire(&m_InsertedEnd) <= sequence || m_TimeoutNs == 0)
+				break;
+
+			if (!m_Waiting)
+			{
+				m_Waiting = true;
+				m_WaitStartNs = nowNs;
+				break;
+			}
+
+			// the missing sequence numbers following a skipped one were waited for as long, so they're skipped too
+			if (nowNs - m_WaitStartNs < m_TimeoutNs)
+				break;
+		}
+
+		if (!skipMissing(sequence))
+			continue;
+
+		sequence++;
+		m_SkippedSequences++;
+	}
+
+	atomicStoreRelease(&m_NextSequence, sequence);
+	return numOfPackets;
+}
+
+size_t PacketReorderBuffer::drain(RawPacket** packets, size_t maxPackets)
+{
+	return drain(TimestampClock::now(), packets, maxPackets);
+}
+
+void PacketReorderBuffer::flush(std::vector<RawPacket*>& packets)
+{
+	uint64_t sequence = m_NextSequence;
+	uint64_t end = atomicLoadAcquire(&m_InsertedEnd);
+
+	for (; sequence < end; sequence++)
+	{
+		Slot& slot = m_Slots[sequence & m_Mask];
+		if (slot.state == makeState(sequence, SlotFull))
+		{
+			if (slot.packet != NULL)
+			{
+				packets.push_back(slot.packet);
+				m_ReleasedPackets++;
+			}
+			else
+				m_EmptySequences++;
+
+			slot.packet = NULL;
+		}
+		else
+			m_SkippedSequences++;
+
+		slot.state = makeState(sequence + m_WindowSize, SlotFree);
+	}
+
+	m_Waiting = false;
+	atomicStoreRelease(&m_NextSequence, sequence);
+}
+
+uint64_t PacketReorderBuffer::getNextSequence() const
+{
+	return atomicLoadAcquire(&m_NextSequence);
+}
+
+void PacketReorderBuffer::getStats(PacketReorderBufferStats& stats) const
+{
+	stats.releasedPackets = m_ReleasedPackets;
+	stats.emptySequences = m_EmptySequences;
+	stats.latePackets = atomicLoadRelaxed(&m_LatePackets);
+	stats.duplicatePackets = atomicLoadRelaxed(&m_DuplicatePackets);
+	stats.windowFullPackets = atomicLoadRelaxed(&m_WindowFullPackets);
+	stats.skippedSequences = m_SkippedSequences;
+}
+
+void PacketReorderBuffer::resetStats()
+{
+	m_ReleasedPackets = 0;
+	m_EmptySequences = 0;
+	m_SkippedSequences = 0;
+	m_LatePackets = 0;
+	m_DuplicatePackets = 0;
+	m_WindowFullPackets = 0;
+}
+
+} // namespace pcpp
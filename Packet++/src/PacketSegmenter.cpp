@@ -0,0 +1,347 @@
+#define LOG_MODULE PacketLogModulePacket
+
+#include "PacketSegmenter.h"
+#include "Logger.h"
+#include <string.h>
+
+#define IPV4_TOTAL_LENGTH_OFFSET 2
+#define IPV4_ID_OFFSET 4
+#define IPV4_CHECKSUM_OFFSET 10
+#define IPV4_SRC_OFFSET 12
+#define IPV4_MAX_HEADER_LENGTH 60
+#define IPV6_PAYLOAD_LENGTH_OFFSET 4
+#define IPV6_SRC_OFFSET 8
+#define IPV6_HEADER_LENGTH 40
+
+#define TCP_SEQ_OFFSET 4
+#define TCP_DATA_OFFSET_OFFSET 12
+#define TCP_FLAGS_OFFSET 13
+#define TCP_CHECKSUM_OFFSET 16
+#define TCP_MIN_HEADER_LENGTH 20
+#define TCP_MAX_HEADER_LENGTH 60
+#define UDP_LENGTH_OFFSET 4
+#define UDP_CHECKSUM_OFFSET 6
+#define UDP_HEADER_LENGTH 8
+
+#define TCP_FLAG_FIN 0x01
+#define TCP_FLAG_PSH 0x08
+#define TCP_FLAG_CWR 0x80
+
+#define IP_PROTOCOL_TCP 6
+#define IP_PROTOCOL_UDP 17
+
+namespace pcpp
+{
+
+static inline uint32_t foldSum(uint32_t sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return sum;
+}
+
+static inline uint16_t readUint16(const uint8_t* data)
+{
+	return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+static inline void writeUint16(uint8_t* data, uint16_t value)
+{
+	data[0] = (uint8_t)(value >> 8);
+	data[1] = (uint8_t)value;
+}
+
+static inline uint32_t readUint32(const uint8_t* data)
+{
+	return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+static inline void writeUint32(uint8_t* data, uint32_t value)
+{
+	writeUint16(data, (uint16_t)(value >> 16));
+	writeUint16(data + 2, (uint16_t)value);
+}
+
+// sum the 16-bit words of data in network byte order, an odd last byte is the high byte of a word padded with zero
+static uint32_t sumWords(const uint8_t* data, size_t len)
+{
+	uint32_t sum = 0;
+	size_t i = 0;
+	for (; i + 1 < len; i += 2)
+		sum += readUint16(data + i);
+	if (i < len)
+		sum += (uint32_t)data[i] << 8;
+	return foldSum(sum);
+}
+
+// copy data and sum it like sumWords() in a single pass
+static uint32_t copyAndSumWords(uint8_t* dst, const uint8_t* src, size_t len)
+{
+	uint32_t sum = 0;
+	size_t i = 0;
+	for (; i + 1 < len; i += 2)
+	{
+		dst[i] = src[i];
+		dst[i + 1] = src[i + 1];
+		sum += (uint32_t)((src[i] << 8) | src[i + 1]);
+		// fold early so the sum of a 64KB payload can't overflow
+		if ((i & 0xfffe) == 0xfffe)
+			sum = foldSum(sum);
+	}
+	if (i < len)
+	{
+		dst[i] = src[i];
+		sum += (uint32_t)src[i] << 8;
+	}
+	return foldSum(sum);
+}
+
+PacketSegmenter::PacketSegmenter(Packet& packet, size_t segmentSize)
+{
+	packet.computeCalculateFields();
+	const RawPacket* rawPacket = packet.getRawPacketReadOnly();
+	m_LinkType = rawPacket->getLinkLayerType();
+	m_Timestamp = rawPacket->getPacketTimeStamp();
+	init(rawPacket->getRawData(), (size_t)rawPacket->getRawDataLen(), segmentSize);
+}
+
+PacketSegmenter::PacketSegmenter(const RawPacket& rawPacket, size_t segmentSize)
+{
+	m_LinkType = rawPacket.getLinkLayerType();
+	m_Timestamp = rawPacket.getPacketTimeStamp();
+	init(rawPacket.getRawData(), (size_t)rawPacket.getRawDataLen(), segmentSize);
+}
+
+void PacketSegmenter::init(const uint8_t* data, size_t dataLen, size_t segmentSize)
+{
+	m_Data = data;
+	m_IsTcp = false;
+	m_HasTransportChecksum = false;
+	m_HeaderLen = m_PayloadLen = 0;
+	m_SegmentSize = segmentSize;
+	m_NumOfSegments = 0;
+	m_IPv4HeaderSum = m_TransportSum = 0;
+	m_IPv4Id = 0;
+	m_TcpSequence = 0;
+	m_TcpFlags = 0;
+
+	if (!FlowKeyExtractor::extract(data, dataLen, m_LinkType, m_View) || m_View.ipVersion == 0 || m_View.isFragment ||
+			m_View.transportOffset == PacketView::NoOffset)
+	{
+		LOG_ERROR("Only unfragmented TCP or UDP packets over IPv4 or IPv6 can be segmented");
+		return;
+	}
+
+	if (segmentSize == 0)
+	{
+		LOG_ERROR("Segment size must be larger than 0");
+		return;
+	}
+
+	// the end of the IP packet, without the Ethernet padding
+	const uint8_t* ipHeader = data + m_View.networkOffset;
+	size_t ipEnd;
+	if (m_View.ipVersion == 4)
+		ipEnd = m_View.networkOffset + readUint16(ipHeader + IPV4_TOTAL_LENGTH_OFFSET);
+	else
+		ipEnd = m_View.networkOffset + IPV6_HEADER_LENGTH + readUint16(ipHeader + IPV6_PAYLOAD_LENGTH_OFFSET);
+	if (ipEnd > dataLen || ipEnd <= m_View.transportOffset)
+		ipEnd = dataLen;
+
+	const uint8_t* transportHeader = data + m_View.transportOffset;
+	size_t transportHeaderLen;
+	m_IsTcp = (m_View.ipProtocol == IP_PROTOCOL_TCP);
+	if (m_IsTcp)
+	{
+		transportHeaderLen = (transportHeader[TCP_DATA_OFFSET_OFFSET] >> 4) * 4;
+		m_HasTransportChecksum = true;
+	}
+	else
+	{
+		transportHeaderLen = UDP_HEADER_LENGTH;
+		m_HasTransportChecksum = (m_View.ipVersion == 6 || readUint16(transportHeader + UDP_CHECKSUM_OFFSET) != 0);
+	}
+
+	if (transportHeaderLen < UDP_HEADER_LENGTH || (m_IsTcp && transportHeaderLen < TCP_MIN_HEADER_LENGTH) || m_View.transportOffset + transportHeaderLen > ipEnd)
+	{
+		LOG_ERROR("The transport header of the packet is malformed");
+		m_IsTcp = false;
+		return;
+	}
+
+	m_HeaderLen = m_View.transportOffset + transportHeaderLen;
+	m_PayloadLen = ipEnd - m_HeaderLen;
+	size_t largestSegment = (m_PayloadLen < segmentSize ? m_PayloadLen : segmentSize);
+	if (m_HeaderLen - m_View.networkOffset + largestSegment > 0xffff)
+	{
+		LOG_ERROR("Segment size %d is too large for an IP packet", (int)segmentSize);
+		m_IsTcp = false;
+		return;
+	}
+
+	// sum the headers with the fields which change per segment (and the checksums) set to zero
+	uint8_t header[TCP_MAX_HEADER_LENGTH];
+	if (m_View.ipVersion == 4)
+	{
+		size_t ipHeaderLen = m_View.ipPayloadOffset - m_View.networkOffset;
+		if (ipHeaderLen > IPV4_MAX_HEADER_LENGTH)
+			ipHeaderLen = IPV4_MAX_HEADER_LENGTH;
+		memcpy(header, ipHeader, ipHeaderLen);
+		writeUint16(header + IPV4_TOTAL_LENGTH_OFFSET, 0);
+		writeUint16(header + IPV4_ID_OFFSET, 0);
+		writeUint16(header + IPV4_CHECKSUM_OFFSET, 0);
+		m_IPv4HeaderSum = sumWords(header, ipHeaderLen);
+		m_IPv4Id = readUint16(ipHeader + IPV4_ID_OFFSET);
+		m_TransportSum = sumWords(ipHeader + IPV4_SRC_OFFSET, 8);
+	}
+	else
+	{
+		m_TransportSum = sumWords(ipHeader + IPV6_SRC_OFFSET, 32);
+	}
+
+	memcpy(header, transportHeader, transportHeaderLen);
+	if (m_IsTcp)
+	{
+		m_TcpSequence = readUint32(header + TCP_SEQ_OFFSET);
+		m_TcpFlags = header[TCP_FLAGS_OFFSET];
+		writeUint32(header + TCP_SEQ_OFFSET, 0);
+		header[TCP_FLAGS_OFFSET] = 0;
+		writeUint16(header + TCP_CHECKSUM_OFFSET, 0);
+	}
+	else
+	{
+		writeUint16(header + UDP_LENGTH_OFFSET, 0);
+		writeUint16(header + UDP_CHECKSUM_OFFSET, 0);
+	}
+	m_TransportSum = foldSum(m_TransportSum + m_View.ipProtocol + sumWords(header, transportHeaderLen));
+
+	m_NumOfSegments = (m_PayloadLen == 0 ? 1 : (m_PayloadLen + segmentSize - 1) / segmentSize);
+}
+
+size_t PacketSegmenter::getSegmentLength(size_t index) const
+{
+	if (index >= m_NumOfSegments)
+		return 0;
+
+	size_t offset = index * m_SegmentSize;
+	size_t payloadLen = m_PayloadLen - offset;
+	return m_HeaderLen + (payloadLen < m_SegmentSize ? payloadLen : m_SegmentSize);
+}
+
+void PacketSegmenter::fillSegment(size_t index, uint8_t* buffer) const
+{
+	size_t payloadOffset = index * m_SegmentSize;
+	size_t payloadLen = getSegmentLength(index) - m_HeaderLen;
+
+	memcpy(buffer, m_Data, m_HeaderLen);
+	uint32_t payloadSum = copyAndSumWords(buffer + m_HeaderLen, m_Data + m_HeaderLen + payloadOffset, payloadLen);
+
+	uint8_t* ipHeader = buffer + m_View.networkOffset;
+	if (m_View.ipVersion == 4)
+	{
+		uint16_t totalLength = (uint16_t)(m_HeaderLen - m_View.networkOffset + payloadLen);
+		uint16_t ipId = (uint16_t)(m_IPv4Id + index);
+		writeUint16(ipHeader + IPV4_TOTAL_LENGTH_OFFSET, totalLength);
+		writeUint16(ipHeader + IPV4_ID_OFFSET, ipId);
+		writeUint16(ipHeader + IPV4_CHECKSUM_OFFSET, (uint16_t)~foldSum(m_IPv4HeaderSum + totalLength + ipId));
+	}
+	else
+	{
+		writeUint16(ipHeader + IPV6_PAYLOAD_LENGTH_OFFSET, (uint16_t)(m_HeaderLen - m_View.networkOffset - IPV6_HEADER_LENGTH + payloadLen));
+	}
+
+	uint8_t* transportHeader = buffer + m_View.transportOffset;
+	uint16_t transportLen = (uint16_t)(m_HeaderLen - m_View.transportOffset + payloadLen);
+	if (m_IsTcp)
+	{
+		uint32_t sequence = m_TcpSequence + (uint32_t)payloadOffset;
+		uint8_t flags = m_TcpFlags;
+		if (index + 1 < m_NumOfSegments)
+			flags &= ~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+		if (index > 0)
+			flags &= ~TCP_FLAG_CWR;
+
+		writeUint32(transportHeader + TCP_SEQ_OFFSET, sequence);
+		transportHeader[TCP_FLAGS_OFFSET] = flags;
+		uint32_t sum = m_TransportSum + transportLen + (sequence >> 16) + (sequence & 0xffff) + flags + payloadSum;
+		writeUint16(transportHeader + TCP_CHECKSUM_OFFSET, (uint16_t)~foldSum(sum));
+	}
+	else
+	{
+		writeUint16(transportHeader + UDP_LENGTH_OFFSET, transportLen);
+		if (m_HasTransportChecksum)
+		{
+			// the UDP length is in both the pseudo header and the UDP header. A computed checksum of 0 is sent as 0xffff
+			uint16_t checksum = (uint16_t)~foldSum(m_TransportSum + transportLen + transportLen + payloadSum);
+			writeUint16(transportHeader + UDP_CHECKSUM_OFFSET, (checksum == 0 ? 0xffff : checksum));
+		}
+	}
+}
+
+size_t PacketSegmenter::writeSegment(size_t index, uint8_t* buffer, size_t bufferLen) const
+{
+	size_t segmentLen = getSegmentLength(index);
+	if (segmentLen == 0 || segmentLen > bufferLen)
+		return 0;
+
+	fillSegment(index, buffer);
+	return segmentLen;
+}
+
+bool PacketSegmenter::writeSegment(size_t index, RawPacket& rawPacket) const
+{
+	size_t segmentLen = getSegmentLength(index);
+	if (segmentLen == 0)
+		return false;
+
+	// a segment is never longer than the packet, so the packet's bytes can fill the appended space until the segment is written
+	size_t curLen = (size_t)rawPacket.getRawDataLen();
+	if (curLen < segmentLen)
+	{
+		if (!rawPacket.reallocateData(segmentLen))
+			return false;
+
+		rawPacket.appendData(m_Data + curLen, segmentLen - curLen);
+	}
+	else if (curLen > segmentLen)
+	{
+		if (!rawPacket.removeData((int)segmentLen, curLen - segmentLen))
+			return false;
+	}
+
+	if ((size_t)rawPacket.getRawDataLen() != segmentLen)
+	{
+		LOG_ERROR("Couldn't resize the raw packet to %d bytes", (int)segmentLen);
+		return false;
+	}
+
+	fillSegment(index, (uint8_t*)rawPacket.getRawData());
+	return true;
+}
+
+size_t PacketSegmenter::writeSegments(RawPacket* const* rawPackets, size_t numOfPackets) const
+{
+	size_t numOfSegments = (numOfPackets < m_NumOfSegments ? numOfPackets : m_NumOfSegments);
+	for (size_t i = 0; i < numOfSegments; i++)
+	{
+		if (!writeSegment(i, *rawPackets[i]))
+			return i;
+	}
+
+	return numOfSegments;
+}
+
+size_t PacketSegmenter::writeSegments(PointerVector<RawPacket>& segments) const
+{
+	for (size_t i = 0; i < m_NumOfSegments; i++)
+	{
+		size_t segmentLen = getSegmentLength(i);
+		uint8_t* buffer = new uint8_t[segmentLen];
+		fillSegment(i, buffer);
+		segments.pushBack(new RawPacket(buffer, (int)segmentLen, m_Timestamp, true, m_LinkType));
+	}
+
+	return m_NumOfSegments;
+}
+
+} // namespace pcpp
@@ -0,0 +1,425 @@
+#define LOG_MODULE PacketLogModulePacket
+
+#include "PacketTemplate.h"
+#include "IpUtils.h"
+#include "Logger.h"
+#include <string.h>
+
+#define IPV4_TOTAL_LENGTH_OFFSET 2
+#define IPV4_ID_OFFSET 4
+#define IPV4_CHECKSUM_OFFSET 10
+#define IPV4_SRC_OFFSET 12
+#define IPV4_DST_OFFSET 16
+#define IPV6_PAYLOAD_LENGTH_OFFSET 4
+#define IPV6_SRC_OFFSET 8
+#define IPV6_DST_OFFSET 24
+#define IPV6_HEADER_LENGTH 40
+
+#define TCP_SEQ_OFFSET 4
+#define TCP_ACK_OFFSET 8
+#define TCP_DATA_OFFSET_OFFSET 12
+#define TCP_CHECKSUM_OFFSET 16
+#define UDP_LENGTH_OFFSET 4
+#define UDP_CHECKSUM_OFFSET 6
+#define UDP_HEADER_LENGTH 8
+#define ICMP_CHECKSUM_OFFSET 2
+#define ICMP_HEADER_LENGTH 8
+
+#define IP_PROTOCOL_ICMP 1
+#define IP_PROTOCOL_TCP 6
+#define IP_PROTOCOL_UDP 17
+#define IP_PROTOCOL_ICMPV6 58
+
+namespace pcpp
+{
+
+static inline uint16_t foldSum(uint32_t sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return (uint16_t)sum;
+}
+
+static inline uint16_t readUint16(const uint8_t* data)
+{
+	return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+static inline void writeUint16(uint8_t* data, uint16_t value)
+{
+	data[0] = (uint8_t)(value >> 8);
+	data[1] = (uint8_t)value;
+}
+
+// sum the 16-bit words of data[start, end) in network byte order, where start is even relative to the checksummed data and an odd last
+// byte is the high byte of a word padded with zero
+static uint32_t sumWords(const uint8_t* data, size_t start, size_t end)
+{
+	uint32_t sum = 0;
+	size_t i = start;
+	for (; i + 1 < end; i += 2)
+		sum += readUint16(data + i);
+	if (i < end)
+		sum += (uint32_t)data[i] << 8;
+	return foldSum(sum);
+}
+
+PacketTemplate::PacketTemplate(Packet& packet)
+{
+	packet.computeCalculateFields();
+	const RawPacket* rawPacket = packet.getRawPacketReadOnly();
+	m_LinkType = rawPacket->getLinkLayerType();
+	init(rawPacket->getRawData(), (size_t)rawPacket->getRawDataLen());
+}
+
+PacketTemplate::PacketTemplate(const uint8_t* data, size_t dataLen, LinkLayerType linkType)
+{
+	m_LinkType = linkType;
+	init(data, dataLen);
+}
+
+void PacketTemplate::init(const uint8_t* data, size_t dataLen)
+{
+	m_Data.assign(data, data + dataLen);
+	m_L4Offset = m_ChecksumOffset = m_PayloadOffset = PacketView::NoOffset;
+	m_HasPseudoHeader = false;
+	m_MaxPayloadLen = 0;
+	m_BaseSum = 0;
+
+	if (!FlowKeyExtractor::extract(data, dataLen, m_LinkType, m_View))
+	{
+		LOG_DEBUG("Packet template doesn't contain an IP header, only stamping the packet is supported");
+		return;
+	}
+
+	if (m_View.ipPayloadOffset == PacketView::NoOffset)
+		return;
+
+	// the end of the IP packet, without the Ethernet padding
+	const uint8_t* ipHeader = data + m_View.networkOffset;
+	size_t ipEnd;
+	if (m_View.ipVersion == 4)
+		ipEnd = m_View.networkOffset + readUint16(ipHeader + IPV4_TOTAL_LENGTH_OFFSET);
+	else
+		ipEnd = m_View.networkOffset + IPV6_HEADER_LENGTH + readUint16(ipHeader + IPV6_PAYLOAD_LENGTH_OFFSET);
+	if (ipEnd > dataLen || ipEnd <= m_View.ipPayloadOffset)
+		ipEnd = dataLen;
+
+	size_t headerLen = 0;
+	uint16_t checksumOffset = 0;
+	if (m_View.transportOffset != PacketView::NoOffset && m_View.ipProtocol == IP_PROTOCOL_TCP)
+	{
+		headerLen = (data[m_View.transportOffset + TCP_DATA_OFFSET_OFFSET] >> 4) * 4;
+		checksumOffset = TCP_CHECKSUM_OFFSET;
+		m_HasPseudoHeader = true;
+	}
+	else if (m_View.transportOffset != PacketView::NoOffset && m_View.ipProtocol == IP_PROTOCOL_UDP)
+	{
+		headerLen = UDP_HEADER_LENGTH;
+		checksumOffset = UDP_CHECKSUM_OFFSET;
+		m_HasPseudoHeader = true;
+	}
+	else if ((m_View.ipVersion == 4 && m_View.ipProtocol == IP_PROTOCOL_ICMP) || (m_View.ipVersion == 6 && m_View.ipProtocol == IP_PROTOCOL_ICMPV6))
+	{
+		headerLen = ICMP_HEADER_LENGTH;
+		checksumOffset = ICMP_CHECKSUM_OFFSET;
+		m_HasPseudoHeader = (m_View.ipVersion == 6);
+	}
+	else
+	{
+		return;
+	}
+
+	m_L4Offset = (m_View.transportOffset != PacketView::NoOffset ? m_View.transportOffset : m_View.ipPayloadOffset);
+	if (m_L4Offset + headerLen > ipEnd)
+	{
+		LOG_DEBUG("Transport header of the packet template is truncated, payload and checksums won't be maintained");
+		m_L4Offset = PacketView::NoOffset;
+		m_HasPseudoHeader = false;
+		return;
+	}
+
+	m_PayloadOffset = (uint16_t)(m_L4Offset + headerLen);
+	m_MaxPayloadLen = ipEnd - m_PayloadOffset;
+
+	// a UDP checksum of 0 over IPv4 means the sender didn't compute one, and stamped packets don't have one either
+	m_ChecksumOffset = (uint16_t)(m_L4Offset + checksumOffset);
+	if (m_View.ipVersion == 4 && m_View.ipProtocol == IP_PROTOCOL_UDP && readUint16(data + m_ChecksumOffset) == 0)
+		m_ChecksumOffset = PacketView::NoOffset;
+
+	// the sum of the transport header without the checksum and the UDP length, and of the pseudo header without the length
+	uint32_t sum = sumWords(data, m_L4Offset, m_PayloadOffset) + (uint32_t)(~readUint16(data + m_L4Offset + checksumOffset) & 0xffff);
+	if (m_View.ipProtocol == IP_PROTOCOL_UDP)
+		sum += (uint32_t)(~readUint16(data + m_L4Offset + UDP_LENGTH_OFFSET) & 0xffff);
+	if (m_HasPseudoHeader)
+	{
+		size_t addressLen = (m_View.ipVersion == 4 ? 4 : 16);
+		size_t srcOffset = m_View.networkOffset + (m_View.ipVersion == 4 ? IPV4_SRC_OFFSET : IPV6_SRC_OFFSET);
+		sum += sumWords(data, srcOffset, srcOffset + 2 * addressLen);
+		sum += m_View.ipProtocol;
+	}
+	m_BaseSum = foldSum(sum);
+
+	// the sums of all payload prefixes, so the checksum of a shorter payload is known without reading it
+	m_PayloadSums.resize(m_MaxPayloadLen + 1);
+	const uint8_t* payload = data + m_PayloadOffset;
+	uint32_t evenSum = 0;
+	m_PayloadSums[0] = 0;
+	for (size_t i = 1; i <= m_MaxPayloadLen; i++)
+	{
+		if (i % 2 == 1)
+		{
+			m_PayloadSums[i] = foldSum(evenSum + ((uint32_t)payload[i - 1] << 8));
+		}
+		else
+		{
+			evenSum = foldSum(evenSum + readUint16(payload + i - 2));
+			m_PayloadSums[i] = evenSum;
+		}
+	}
+}
+
+size_t PacketTemplate::stamp(uint8_t* buffer, size_t bufferLen) const
+{
+	if (bufferLen < m_Data.size())
+		return 0;
+
+	memcpy(buffer, &m_Data[0], m_Data.size());
+	return m_Data.size();
+}
+
+size_t PacketTemplate::stamp(uint8_t* buffer, size_t bufferLen, size_t payloadLen) const
+{
+	if (m_PayloadOffset == PacketView::NoOffset || payloadLen > m_MaxPayloadLen)
+		return 0;
+
+	if (payloadLen == m_MaxPayloadLen)
+		return stamp(buffer, bufferLen);
+
+	if (bufferLen < m_PayloadOffset + payloadLen)
+		return 0;
+
+	return stampShortened(buffer, payloadLen);
+}
+
+size_t PacketTemplate::stampShortened(uint8_t* buffer, size_t payloadLen) const
+{
+	size_t packetLen = m_PayloadOffset + payloadLen;
+	memcpy(buffer, &m_Data[0], packetLen);
+
+	uint8_t* ipHeader = buffer + m_View.networkOffset;
+	if (m_View.ipVersion == 4)
+	{
+		uint16_t oldLength = readUint16(ipHeader + IPV4_TOTAL_LENGTH_OFFSET);
+		uint16_t newLength = (uint16_t)(packetLen - m_View.networkOffset);
+		writeUint16(ipHeader + IPV4_TOTAL_LENGTH_OFFSET, newLength);
+		writeUint16(ipHeader + IPV4_CHECKSUM_OFFSET, update_checksum(readUint16(ipHeader + IPV4_CHECKSUM_OFFSET), oldLength, newLength));
+	}
+	else
+	{
+		writeUint16(ipHeader + IPV6_PAYLOAD_LENGTH_OFFSET, (uint16_t)(packetLen - m_View.networkOffset - IPV6_HEADER_LENGTH));
+	}
+
+	uint16_t l4Length = (uint16_t)(packetLen - m_L4Offset);
+	uint32_t sum = m_BaseSum + m_PayloadSums[payloadLen];
+	if (m_HasPseudoHeader)
+		sum += l4Length;
+	if (m_View.ipProtocol == IP_PROTOCOL_UDP)
+	{
+		writeUint16(buffer + m_L4Offset + UDP_LENGTH_OFFSET, l4Length);
+		sum += l4Length;
+	}
+
+	if (m_ChecksumOffset != PacketView::NoOffset)
+	{
+		uint16_t checksum = (uint16_t)~foldSum(sum);
+		if (checksum == 0 && m_View.ipProtocol == IP_PROTOCOL_UDP)
+			checksum = 0xffff;
+		writeUint16(buffer + m_ChecksumOffset, checksum);
+	}
+
+	return packetLen;
+}
+
+bool PacketTemplate::resizeRawPacket(RawPacket& rawPacket, size_t packetLen) const
+{
+	size_t curLen = (size_t)rawPacket.getRawDataLen();
+	if (curLen < packetLen)
+	{
+		if (!rawPacket.reallocateData(packetLen))
+			return false;
+
+		rawPacket.appendData(&m_Data[curLen], packetLen - curLen);
+	}
+	else if (curLen > packetLen)
+	{
+		if (!rawPacket.removeData((int)packetLen, curLen - packetLen))
+			return false;
+	}
+
+	if ((size_t)rawPacket.getRawDataLen() != packetLen)
+	{
+		LOG_ERROR("Couldn't resize the raw packet to %d bytes", (int)packetLen);
+		return false;
+	}
+
+	return true;
+}
+
+bool PacketTemplate::stamp(RawPacket& rawPacket) const
+{
+	if (!resizeRawPacket(rawPacket, m_Data.size()))
+		return false;
+
+	memcpy((uint8_t*)rawPacket.getRawData(), &m_Data[0], m_Data.size());
+	return true;
+}
+
+bool PacketTemplate::stamp(RawPacket& rawPacket, size_t payloadLen) const
+{
+	if (m_PayloadOffset == PacketView::NoOffset || payloadLen > m_MaxPayloadLen)
+		return false;
+
+	if (payloadLen == m_MaxPayloadLen)
+		return stamp(rawPacket);
+
+	if (!resizeRawPacket(rawPacket, m_PayloadOffset + payloadLen))
+		return false;
+
+	stampShortened((uint8_t*)rawPacket.getRawData(), payloadLen);
+	return true;
+}
+
+bool PacketTemplate::patch(uint8_t* packet, size_t packetLen, size_t offset, const uint8_t* data, size_t dataLen, bool inIPv4Header, bool inTransportChecksum) const
+{
+	// the sums are taken over whole words. All checksummed data starts at an even offset relative to the IP header
+	size_t start = offset - ((offset - m_View.networkOffset) % 2);
+	size_t end = offset + dataLen + ((offset + dataLen - m_View.networkOffset) % 2);
+	if (end > packetLen)
+		end = packetLen;
+
+	uint16_t oldSum = sumWords(packet, start, end);
+	memcpy(packet + offset, data, dataLen);
+	uint16_t newSum = sumWords(packet, start, end);
+
+	if (inIPv4Header)
+	{
+		uint8_t* checksum = packet + m_View.networkOffset + IPV4_CHECKSUM_OFFSET;
+		writeUint16(checksum, update_checksum(readUint16(checksum), oldSum, newSum));
+	}
+
+	if (inTransportChecksum && m_ChecksumOffset != PacketView::NoOffset)
+	{
+		uint8_t* checksum = packet + m_ChecksumOffset;
+		uint16_t newChecksum = update_checksum(readUint16(checksum), oldSum, newSum);
+		if (newChecksum == 0 && m_View.ipProtocol == IP_PROTOCOL_UDP)
+			newChecksum = 0xffff;
+		writeUint16(checksum, newChecksum);
+	}
+
+	return true;
+}
+
+bool PacketTemplate::setSrcIPv4Address(uint8_t* packet, const IPv4Address& address) const
+{
+	if (m_View.ipVersion != 4)
+		return false;
+
+	uint32_t addr = address.toInt();
+	return patch(packet, m_Data.size(), m_View.networkOffset + IPV4_SRC_OFFSET, (const uint8_t*)&addr, sizeof(addr), true, m_HasPseudoHeader);
+}
+
+bool PacketTemplate::setDstIPv4Address(uint8_t* packet, const IPv4Address& address) const
+{
+	if (m_View.ipVersion != 4)
+		return false;
+
+	uint32_t addr = address.toInt();
+	return patch(packet, m_Data.size(), m_View.networkOffset + IPV4_DST_OFFSET, (const uint8_t*)&addr, sizeof(addr), true, m_HasPseudoHeader);
+}
+
+bool PacketTemplate::setSrcIPv6Address(uint8_t* packet, const IPv6Address& address) const
+{
+	if (m_View.ipVersion != 6)
+		return false;
+
+	uint8_t addr[16];
+	address.copyTo(addr);
+	return patch(packet, m_Data.size(), m_View.networkOffset + IPV6_SRC_OFFSET, addr, sizeof(addr), false, m_HasPseudoHeader);
+}
+
+bool PacketTemplate::setDstIPv6Address(uint8_t* packet, const IPv6Address& address) const
+{
+	if (m_View.ipVersion != 6)
+		return false;
+
+	uint8_t addr[16];
+	address.copyTo(addr);
+	return patch(packet, m_Data.size(), m_View.networkOffset + IPV6_DST_OFFSET, addr, sizeof(addr), false, m_HasPseudoHeader);
+}
+
+bool PacketTemplate::setIPv4Id(uint8_t* packet, uint16_t ipId) const
+{
+	if (m_View.ipVersion != 4)
+		return false;
+
+	uint16_t value = htons(ipId);
+	return patch(packet, m_Data.size(), m_View.networkOffset + IPV4_ID_OFFSET, (const uint8_t*)&value, sizeof(value), true, false);
+}
+
+bool PacketTemplate::setSrcPort(uint8_t* packet, uint16_t port) const
+{
+	if (m_View.transportOffset == PacketView::NoOffset || m_L4Offset == PacketView::NoOffset)
+		return false;
+
+	uint16_t value = htons(port);
+	return patch(packet, m_Data.size(), m_L4Offset, (const uint8_t*)&value, sizeof(value), false, true);
+}
+
+bool PacketTemplate::setDstPort(uint8_t* packet, uint16_t port) const
+{
+	if (m_View.transportOffset == PacketView::NoOffset || m_L4Offset == PacketView::NoOffset)
+		return false;
+
+	uint16_t value = htons(port);
+	return patch(packet, m_Data.size(), m_L4Offset + sizeof(uint16_t), (const uint8_t*)&value, sizeof(value), false, true);
+}
+
+bool PacketTemplate::setTcpSequenceNumber(uint8_t* packet, uint32_t sequenceNumber) const
+{
+	if (m_L4Offset == PacketView::NoOffset || m_View.ipProtocol != IP_PROTOCOL_TCP)
+		return false;
+
+	uint32_t value = htonl(sequenceNumber);
+	return patch(packet, m_Data.size(), m_L4Offset + TCP_SEQ_OFFSET, (const uint8_t*)&value, sizeof(value), false, true);
+}
+
+bool PacketTemplate::setTcpAckNumber(uint8_t* packet, uint32_t ackNumber) const
+{
+	if (m_L4Offset == PacketView::NoOffset || m_View.ipProtocol != IP_PROTOCOL_TCP)
+		return false;
+
+	uint32_t value = htonl(ackNumber);
+	return patch(packet, m_Data.size(), m_L4Offset + TCP_ACK_OFFSET, (const uint8_t*)&value, sizeof(value), false, true);
+}
+
+bool PacketTemplate::setPayload(uint8_t* packet, size_t packetLen, size_t offset, const uint8_t* data, size_t dataLen) const
+{
+	if (m_PayloadOffset == PacketView::NoOffset || packetLen < m_PayloadOffset)
+		return false;
+
+	// Ethernet padding following the payload isn't part of it
+	size_t payloadLen = packetLen - m_PayloadOffset;
+	if (payloadLen > m_MaxPayloadLen)
+		payloadLen = m_MaxPayloadLen;
+
+	if (offset > payloadLen || dataLen > payloadLen - offset)
+	{
+		LOG_ERROR("Data exceeds the payload of the packet");
+		return false;
+	}
+
+	return patch(packet, m_PayloadOffset + payloadLen, m_PayloadOffset + offset, data, dataLen, false, true);
+}
+
+} // namespace pcpp
@@ -0,0 +1,294 @@
+#include "PacketView.h"
+#include "ProtocolRegistry.h"
+#include "EthLayer.h"
+#include "SllLayer.h"
+#include "VlanLayer.h"
+#include "IPv4Layer.h"
+#include "IPv6Layer.h"
+#include "TcpLayer.h"
+#include "UdpLayer.h"
+#include <string.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <winsock2.h>
+#elif LINUX
+#include <in.h>
+#elif MAC_OS_X
+#include <arpa/inet.h>
+#endif
+
+namespace pcpp
+{
+
+#define PCPP_MPLS_HEADER_LEN 4
+
+bool FlowKeyExtractor::extract(const RawPacket* rawPacket, PacketView& view)
+{
+	if (rawPacket == NULL)
+	{
+		memset(&view, 0, sizeof(view));
+		view.networkOffset = view.ipPayloadOffset = view.transportOffset = view.payloadOffset = PacketView::NoOffset;
+		return false;
+	}
+
+	return extract(rawPacket->getRawData(), (size_t)rawPacket->getRawDataLen(), rawPacket->getLinkLayerType(), view);
+}
+
+bool FlowKeyExtractor::extract(const uint8_t* data, size_t dataLen, LinkLayerType linkType, PacketView& view)
+{
+	memset(&view, 0, sizeof(view));
+	view.networkOffset = view.ipPayloadOffset = view.transportOffset = view.payloadOffset = PacketView::NoOffset;
+
+	if (data == NULL || dataLen == 0)
+		return false;
+
+	const ProtocolRegistry& registry = ProtocolRegistry::getInstance();
+	ProtocolType nextProtocol = UnknownProtocol;
+	size_t offset = 0;
+
+	// link layer
+	if (linkType == LINKTYPE_LINUX_SLL)
+	{
+		view.protocolTypes |= SLL;
+		if (dataLen <= sizeof(sll_header))
+			return false;
+
+		nextProtocol = registry.getProtocolByEtherType(ntohs(((sll_header*)data)->protocol_type));
+		offset = sizeof(sll_header);
+	}
+	else if (linkType == LINKTYPE_RAW || linkType == LINKTYPE_DLT_RAW1 || linkType == LINKTYPE_DLT_RAW2)
+	{
+		uint8_t ipVer = data[0] & 0xf0;
+		if (ipVer == 0x40)
+			nextProtocol = IPv4;
+		else if (ipVer == 0x60)
+			nextProtocol = IPv6;
+	}
+	else if (linkType == LINKTYPE_NULL)
+	{
+		// null/loopback isn't supported
+		return false;
+	}
+	else
+	{
+		view.protocolTypes |= Ethernet;
+		if (dataLen <= sizeof(ether_header))
+			return false;
+
+		nextProtocol = registry.getProtocolByEtherType(ntohs(((ether_header*)data)->etherType));
+		offset = sizeof(ether_header);
+	}
+
+	// VLAN tags and MPLS labels
+	while (nextProtocol == VLAN || nextProtocol == MPLS)
+	{
+		if (nextProtocol == VLAN)
+		{
+			view.protocolTypes |= VLAN;
+			if (dataLen - offset <= sizeof(vlan_header))
+				return false;
+
+			vlan_header* vlanHeader = (vlan_header*)(data + offset);
+			if (view.vlanCount == 0)
+				view.vlanId = ntohs(vlanHeader->vlan) & 0xFFF;
+			if (view.vlanCount < 0xff)
+				view.vlanCount++;
+
+			nextProtocol = registry.getProtocolByEtherType(ntohs(vlanHeader->etherType));
+			offset += sizeof(vlan_header);
+		}
+		else
+		{
+			view.protocolTypes |= MPLS;
+			if (dataLen - offset < PCPP_MPLS_HEADER_LEN + 1)
+				return false;
+
+			if (view.mplsLabelCount < 0xff)
+				view.mplsLabelCount++;
+
+			bool bottomOfStack = (data[offset + 2] & 0x01) != 0;
+			offset += PCPP_MPLS_HEADER_LEN;
+			if (bottomOfStack)
+			{
+				uint8_t nextNibble = (data[offset] & 0xF0) >> 4;
+				if (nextNibble == 4)
+					nextProtocol = IPv4;
+				else if (nextNibble == 6)
+					nextProtocol = IPv6;
+				else
+					nextProtocol = UnknownProtocol;
+			}
+		}
+	}
+
+	return extractNetworkLayer(data, dataLen, offset, nextProtocol, view);
+}
+
+bool FlowKeyExtractor::extractFromNetworkLayer(const uint8_t* data, size_t dataLen, size_t networkOffset, PacketView& view)
+{
+	// reset everything extractNetworkLayer() and extractTransportLayer() may set
+	view.protocolTypes &= ~(uint64_t)(IPv4 | IPv6 | TCP | UDP);
+	view.networkOffset = view.ipPayloadOffset = view.transportOffset = view.payloadOffset = PacketView::NoOffset;
+	view.payloadLength = 0;
+	view.ipVersion = 0;
+	view.ipProtocol = 0;
+	view.isFragment = false;
+	view.fragmentId = 0;
+	view.tcpFlags = 0;
+	view.srcPort = 0;
+	view.dstPort = 0;
+	memset(view.srcIP, 0, sizeof(view.srcIP));
+	memset(view.dstIP, 0, sizeof(view.dstIP));
+
+	if (data == NULL || networkOffset >= dataLen)
+		return false;
+
+	uint8_t ipVer = data[networkOffset] & 0xf0;
+	if (ipVer == 0x40)
+		return extractNetworkLayer(data, dataLen, networkOffset, IPv4, view);
+	else if (ipVer == 0x60)
+		return extractNetworkLayer(data, dataLen, networkOffset, IPv6, view);
+
+	return false;
+}
+
+bool FlowKeyExtractor::extractNetworkLayer(const uint8_t* data, size_t dataLen, size_t offset, ProtocolType protocol, PacketView& view)
+{
+	if (offset >= PacketView::NoOffset)
+		return false;
+
+	const ProtocolRegistry& registry = ProtocolRegistry::getInstance();
+	size_t ipLen = dataLen - offset;
+	size_t headerLen = 0;
+	ProtocolType nextProtocol = UnknownProtocol;
+
+	if (protocol == IPv4)
+	{
+		if (ipLen < sizeof(iphdr))
+			return false;
+
+		iphdr* ipHeader = (iphdr*)(data + offset);
+		view.protocolTypes |= IPv4;
+		view.networkOffset = (uint16_t)offset;
+		view.ipVersion = 4;
+		view.ipProtocol = ipHeader->protocol;
+		memcpy(view.srcIP, &ipHeader->ipSrc, sizeof(ipHeader->ipSrc));
+		memcpy(view.dstIP, &ipHeader->ipDst, sizeof(ipHeader->ipDst));
+		view.isFragment = (ntohs(ipHeader->fragmentOffset) & 0x3FFF) != 0;
+		if (view.isFragment)
+			view.fragmentId = ntohs(ipHeader->ipId);
+
+		// same as IPv4Layer: total length of 0 usually means TCP Segmentation Offload (TSO), in which case the captured length is used
+		size_t totalLen = ntohs(ipHeader->totalLength);
+		if (totalLen < ipLen && totalLen != 0)
+			ipLen = totalLen;
+
+		headerLen = ipHeader->internetHeaderLength * 4;
+		if (headerLen < sizeof(iphdr) || view.isFragment)
+			return true;
+
+		if (ipLen > headerLen && offset + headerLen < PacketView::NoOffset)
+			view.ipPayloadOffset = (uint16_t)(offset + headerLen);
+
+		nextProtocol = registry.getProtocolByIPProtocol(ipHeader->protocol);
+	}
+	else if (protocol == IPv6)
+	{
+		if (ipLen < sizeof(ip6_hdr))
+			return false;
+
+		ip6_hdr* ipHeader = (ip6_hdr*)(data + offset);
+		view.protocolTypes |= IPv6;
+		view.networkOffset = (uint16_t)offset;
+		view.ipVersion = 6;
+		memcpy(view.srcIP, ipHeader->ipSrc, sizeof(ipHeader->ipSrc));
+		memcpy(view.dstIP, ipHeader->ipDst, sizeof(ipHeader->ipDst));
+
+		// skip the extensions IPv6Layer knows
+		uint8_t nextHeader = 0;
+		size_t fragmentHeaderOffset = 0;
+		IPv6Layer::findUpperLayerProtocol(data + offset, ipLen, nextHeader, headerLen, fragmentHeaderOffset);
+		if (fragmentHeaderOffset != 0)
+		{
+			view.isFragment = true;
+			if (fragmentHeaderOffset + 8 <= ipLen)
+			{
+				uint32_t fragmentId;
+				memcpy(&fragmentId, data + offset + fragmentHeaderOffset + 4, sizeof(fragmentId));
+				view.fragmentId = ntohl(fragmentId);
+			}
+		}
+
+		view.ipProtocol = nextHeader;
+
+		size_t totalLen = ntohs(ipHeader->payloadLength) + headerLen;
+		if (totalLen < ipLen)
+			ipLen = totalLen;
+
+		if (view.isFragment)
+			return true;
+
+		if (ipLen > headerLen && offset + headerLen < PacketView::NoOffset)
+			view.ipPayloadOffset = (uint16_t)(offset + headerLen);
+
+		// IPv6Layer supports only TCP and UDP as transport layers
+		nextProtocol = registry.getProtocolByIPProtocol(nextHeader);
+		if (nextProtocol != TCP && nextProtocol != UDP)
+			return true;
+	}
+	else
+	{
+		return false;
+	}
+
+	if (ipLen <= headerLen)
+		return true;
+
+	extractTransportLayer(data, offset + headerLen, ipLen - headerLen, nextProtocol, view);
+	return true;
+}
+
+void FlowKeyExtractor::extractTransportLayer(const uint8_t* data, size_t offset, size_t len, ProtocolType protocol, PacketView& view)
+{
+	if (offset >= PacketView::NoOffset)
+		return;
+
+	size_t headerLen = 0;
+
+	if (protocol == TCP)
+	{
+		if (len < sizeof(tcphdr))
+			return;
+
+		tcphdr* tcpHeader = (tcphdr*)(data + offset);
+		view.protocolTypes |= TCP;
+		view.srcPort = ntohs(tcpHeader->portSrc);
+		view.dstPort = ntohs(tcpHeader->portDst);
+		// the flags are the 14th byte of the TCP header
+		view.tcpFlags = data[offset + 13];
+		headerLen = tcpHeader->dataOffset * 4;
+	}
+	else if (protocol == UDP)
+	{
+		if (len < sizeof(udphdr))
+			return;
+
+		udphdr* udpHeader = (udphdr*)(data + offset);
+		view.protocolTypes |= UDP;
+		view.srcPort = ntohs(udpHeader->portSrc);
+		view.dstPort = ntohs(udpHeader->portDst);
+		headerLen = sizeof(udphdr);
+	}
+	else
+	{
+		return;
+	}
+
+	view.transportOffset = (uint16_t)offset;
+	if (len > headerLen && offset + headerLen < PacketView::NoOffset)
+	{
+		view.payloadOffset = (uint16_t)(offset + headerLen);
+		view.payloadLength = (uint32_t)(len - headerLen);
+	}
+}
+
+} // namespace pcpp
@@ -0,0 +1,418 @@
+#define LOG_MODULE PacketLogModuleParallelPacketProcessor
+
+#include "ParallelPacketProcessor.h"
+#include "FlowDispatcher.h"
+#include "SystemUtils.h"
+#include "Logger.h"
+#include <string.h>
+
+namespace pcpp
+{
+
+// the packets of one algorithm call and the chunks they're split into
+struct PacketChunks
+{
+	RawPacket* const* packets;
+	size_t numOfPackets;
+	size_t chunkSize;
+
+	PacketChunks(RawPacket* const* packets, size_t numOfPackets, size_t chunkSize) :
+		packets(packets), numOfPackets(numOfPackets), chunkSize(chunkSize) {}
+
+	inline size_t getNumOfChunks() const { return (numOfPackets + chunkSize - 1) / chunkSize; }
+	inline size_t getChunkStart(size_t chunkIndex) const { return chunkIndex * chunkSize; }
+	inline size_t getChunkEnd(size_t chunkIndex) const { return ((chunkIndex + 1) * chunkSize < numOfPackets ? (chunkIndex + 1) * chunkSize : numOfPackets); }
+};
+
+struct ForEachTask
+{
+	PacketChunks chunks;
+	ParallelPacketProcessor::OnPacket onPacket;
+
+	ForEachTask(const PacketChunks& chunks, ParallelPacketProcessor::OnPacket onPacket) : chunks(chunks), onPacket(onPacket) {}
+};
+
+struct FilterTask
+{
+	PacketChunks chunks;
+	ParallelPacketProcessor::PacketPredicate predicate;
+	std::vector<uint8_t> matches;
+
+	FilterTask(const PacketChunks& chunks, ParallelPacketProcessor::PacketPredicate predicate) :
+		chunks(chunks), predicate(predicate), matches(chunks.numOfPackets, 0) {}
+};
+
+struct PartitionTask
+{
+	PacketChunks chunks;
+	size_t numOfPartitions;
+	// the partition of each packet
+	std::vector<uint32_t> packetPartitions;
+	// the number of packets of each chunk in each partition (indexed by chunk * numOfPartitions + partition), then the index in the
+	// partition the first of them is written to
+	std::vector<size_t> chunkOffsets;
+	std::vector<std::vector<size_t> >* partitions;
+
+	PartitionTask(const PacketChunks& chunks, size_t numOfPartitions, std::vector<std::vector<size_t> >* partitions) :
+		chunks(chunks), numOfPartitions(numOfPartitions), packetPartitions(chunks.numOfPackets, 0),
+		chunkOffsets(chunks.getNumOfChunks() * numOfPartitions, 0), partitions(partitions) {}
+};
+
+struct ForEachPartitionTask
+{
+	RawPacket* const* packets;
+	const std::vector<std::vector<size_t> >* partitions;
+	ParallelPacketProcessor::OnPacket onPacket;
+};
+
+static void runForEachTask(size_t taskIndex, ParallelPacketContext& context, void* taskCookie)
+{
+	ForEachTask* task = (ForEachTask*)taskCookie;
+	for (size_t i = task->chunks.getChunkStart(taskIndex); i < task->chunks.getChunkEnd(taskIndex); i++)
+		task->onPacket(task->chunks.packets[i], i, context);
+}
+
+static void runFilterTask(size_t taskIndex, ParallelPacketContext& context, void* taskCookie)
+{
+	FilterTask* task = (FilterTask*)taskCookie;
+	for (size_t i = task->chunks.getChunkStart(taskIndex); i < task->chunks.getChunkEnd(taskIndex); i++)
+		task->matches[i] = (task->predicate(task->chunks.packets[i], i, context) ? 1 : 0);
+}
+
+static void runHashTask(size_t taskIndex, ParallelPacketContext& context, void* taskCookie)
+{
+	PartitionTask* task = (PartitionTask*)taskCookie;
+	size_t* counts = &task->chunkOffsets[taskIndex * task->numOfPartitions];
+	for (size_t i = task->chunks.getChunkStart(taskIndex); i < task->chunks.getChunkEnd(taskIndex); i++)
+	{
+		// the hash is mapped to a partition the way FlowDispatcher maps it to a bucket
+		uint32_t flowHash = FlowDispatcher::getFlowHash(task->chunks.packets[i]);
+		uint32_t partition = (uint32_t)(((uint64_t)flowHash * task->numOfPartitions) >> 32);
+		task->packetPartitions[i] = partition;
+		counts[partition]++;
+	}
+}
+
+static void runScatterTask(size_t taskIndex, ParallelPacketContext& context, void* taskCookie)
+{
+	PartitionTask* task = (PartitionTask*)taskCookie;
+	size_t* offsets = &task->chunkOffsets[taskIndex * task->numOfPartitions];
+	for (size_t i = task->chunks.getChunkStart(taskIndex); i < task->chunks.getChunkEnd(taskIndex); i++)
+	{
+		uint32_t partition = task->packetPartitions[i];
+		(*task->partitions)[partition][offsets[partition]++] = i;
+	}
+}
+
+static void runForEachPartitionTask(size_t taskIndex, ParallelPacketContext& context, void* taskCookie)
+{
+	ForEachPartitionTask* task = (ForEachPartitionTask*)taskCookie;
+	const std::vector<size_t>& partition = (*task->partitions)[taskIndex];
+	for (size_t i = 0; i < partition.size(); i++)
+		task->onPacket(task->packets[partition[i]], partition[i], context);
+}
+
+
+ParallelPacketContext::ParallelPacketContext(int threadIndex, size_t layerArenaSize) :
+	m_ThreadIndex(threadIndex), m_UserCookie(NULL), m_LayerArena(layerArenaSize)
+{
+	m_Packet.setLayerArena(&m_LayerArena);
+}
+
+Packet& ParallelPacketContext::parsePacket(RawPacket* rawPacket, ProtocolType parseUntil)
+{
+	m_Packet.setRawPacket(rawPacket, false, parseUntil);
+	return m_Packet;
+}
+
+
+ParallelPacketProcessor::ParallelPacketProcessor(void* userCookie, const ParallelPacketProcessorConfiguration& config)
+{
+	int numOfThreads = (config.numOfThreads > 0 ? config.numOfThreads : getNumOfCores());
+	if (numOfThreads < 1)
+		numOfThreads = 1;
+
+	m_ChunkSize = (config.chunkSize > 0 ? config.chunkSize : 1);
+	m_NumOfStolenTasks = 0;
+	m_OnTask = NULL;
+	m_TaskCookie = NULL;
+	m_JobId = 0;
+	m_NumOfBusyThreads = 0;
+	m_StopRequested = false;
+	pthread_mutex_init(&m_Mutex, NULL);
+	pthread_cond_init(&m_JobCond, NULL);
+	pthread_cond_init(&m_DoneCond, NULL);
+
+	for (int i = 0; i < numOfThreads; i++)
+	{
+		ParallelPacketContext* context = new ParallelPacketContext(i, config.layerArenaSize);
+		context->m_UserCookie = userCookie;
+		m_Contexts.push_back(context);
+
+		TaskRange* range = new TaskRange();
+		pthread_mutex_init(&range->mutex, NULL);
+		range->next = 0;
+		range->end = 0;
+		range->numOfStolenTasks = 0;
+		m_Ranges.push_back(range);
+	}
+
+	// thread 0 is the thread calling the algorithms
+	for (int i = 1; i < numOfThreads; i++)
+	{
+		Worker* worker = new Worker();
+		worker->owner = this;
+		worker->index = i;
+		int err = pthread_create(&worker->thread, NULL, workerThreadMain, worker);
+		if (err != 0)
+		{
+			LOG_ERROR("Cannot create thread %d, working with %d threads: [%s]", i, i, strerror(err));
+			delete worker;
+			for (int j = i; j < numOfThreads; j++)
+			{
+				delete m_Contexts[j];
+				pthread_mutex_destroy(&m_Ranges[j]->mutex);
+				delete m_Ranges[j];
+			}
+			m_Contexts.resize(i);
+			m_Ranges.resize(i);
+			break;
+		}
+
+		m_Workers.push_back(worker);
+	}
+}
+
+ParallelPacketProcessor::~ParallelPacketProcessor()
+{
+	pthread_mutex_lock(&m_Mutex);
+	m_StopRequested = true;
+	pthread_cond_broadcast(&m_JobCond);
+	pthread_mutex_unlock(&m_Mutex);
+
+	for (size_t i = 0; i < m_Workers.size(); i++)
+	{
+		pthread_join(m_Workers[i]->thread, NULL);
+		delete m_Workers[i];
+	}
+
+	for (size_t i = 0; i < m_Contexts.size(); i++)
+	{
+		delete m_Contexts[i];
+		pthread_mutex_destroy(&m_Ranges[i]->mutex);
+		delete m_Ranges[i];
+	}
+
+	pthread_cond_destroy(&m_DoneCond);
+	pthread_cond_destroy(&m_JobCond);
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+void ParallelPacketProcessor::setThreadUserCookie(int threadIndex, void* userCookie)
+{
+	if (threadIndex < 0 || threadIndex >= getNumOfThreads())
+	{
+		LOG_ERROR("Thread index %d is out of range", threadIndex);
+		return;
+	}
+
+	m_Contexts[threadIndex]->m_UserCookie = userCookie;
+}
+
+bool ParallelPacketProcessor::takeTask(int threadIndex, size_t& taskIndex)
+{
+	TaskRange* range = m_Ranges[threadIndex];
+	pthread_mutex_lock(&range->mutex);
+	bool found = (range->next < range->end);
+	if (found)
+		taskIndex = range->next++;
+	pthread_mutex_unlock(&range->mutex);
+	return found;
+}
+
+bool ParallelPacketProcessor::stealTasks(int threadIndex)
+{
+	while (true)
+	{
+		// the victim is the thread with the most tasks left
+		int victim = -1;
+		size_t mostTasksLeft = 0;
+		for (int i = 0; i < getNumOfThreads(); i++)
+		{
+			if (i == threadIndex)
+				continue;
+
+			pthread_mutex_lock(&m_Ranges[i]->mutex);
+			size_t tasksLeft = m_Ranges[i]->end - m_Ranges[i]->next;
+			pthread_mutex_unlock(&m_Ranges[i]->mutex);
+			if (tasksLeft > mostTasksLeft)
+			{
+				mostTasksLeft = tasksLeft;
+				victim = i;
+			}
+		}
+
+		if (victim < 0)
+			return false;
+
+		// the victim may have taken its tasks since it was chosen, in which case another victim is looked for
+		TaskRange* victimRange = m_Ranges[victim];
+		pthread_mutex_lock(&victimRange->mutex);
+		size_t tasksLeft = victimRange->end - victimRange->next;
+		size_t numOfStolen = (tasksLeft + 1) / 2;
+		size_t stolenStart = victimRange->end - numOfStolen;
+		victimRange->end = stolenStart;
+		pthread_mutex_unlock(&victimRange->mutex);
+
+		if (numOfStolen == 0)
+			continue;
+
+		TaskRange* range = m_Ranges[threadIndex];
+		pthread_mutex_lock(&range->mutex);
+		range->next = stolenStart;
+		range->end = stolenStart + numOfStolen;
+		range->numOfStolenTasks += numOfStolen;
+		pthread_mutex_unlock(&range->mutex);
+		return true;
+	}
+}
+
+void ParallelPacketProcessor::runThreadTasks(int threadIndex)
+{
+	ParallelPacketContext& context = *m_Contexts[threadIndex];
+	size_t taskIndex;
+	do
+	{
+		while (takeTask(threadIndex, taskIndex))
+			m_OnTask(taskIndex, context, m_TaskCookie);
+	} while (stealTasks(threadIndex));
+}
+
+void* ParallelPacketProcessor::workerThreadMain(void* workerPtr)
+{
+	Worker* worker = (Worker*)workerPtr;
+	ParallelPacketProcessor* owner = worker->owner;
+	uint64_t lastJobId = 0;
+
+	pthread_mutex_lock(&owner->m_Mutex);
+	while (true)
+	{
+		while (!owner->m_StopRequested && owner->m_JobId == lastJobId)
+			pthread_cond_wait(&owner->m_JobCond, &owner->m_Mutex);
+
+		if (owner->m_StopRequested)
+			break;
+
+		lastJobId = owner->m_JobId;
+		pthread_mutex_unlock(&owner->m_Mutex);
+
+		owner->runThreadTasks(worker->index);
+
+		pthread_mutex_lock(&owner->m_Mutex);
+		if (--owner->m_NumOfBusyThreads == 0)
+			pthread_cond_signal(&owner->m_DoneCond);
+	}
+
+	pthread_mutex_unlock(&owner->m_Mutex);
+	return NULL;
+}
+
+void ParallelPacketProcessor::runTasks(size_t numOfTasks, OnTask onTask, void* taskCookie)
+{
+	if (numOfTasks == 0)
+		return;
+
+	// no thread is running tasks, so the ranges can be set without locking them. Publishing the job under m_Mutex makes them visible
+	size_t numOfThreads = m_Ranges.size();
+	for (size_t i = 0; i < numOfThreads; i++)
+	{
+		m_Ranges[i]->next = numOfTasks * i / numOfThreads;
+		m_Ranges[i]->end = numOfTasks * (i + 1) / numOfThreads;
+		m_Ranges[i]->numOfStolenTasks = 0;
+	}
+
+	m_OnTask = onTask;
+	m_TaskCookie = taskCookie;
+
+	if (!m_Workers.empty())
+	{
+		pthread_mutex_lock(&m_Mutex);
+		m_JobId++;
+		m_NumOfBusyThreads = (int)m_Workers.size();
+		pthread_cond_broadcast(&m_JobCond);
+		pthread_mutex_unlock(&m_Mutex);
+	}
+
+	runThreadTasks(0);
+
+	pthread_mutex_lock(&m_Mutex);
+	while (m_NumOfBusyThreads > 0)
+		pthread_cond_wait(&m_DoneCond, &m_Mutex);
+	pthread_mutex_unlock(&m_Mutex);
+
+	for (size_t i = 0; i < numOfThreads; i++)
+		m_NumOfStolenTasks += m_Ranges[i]->numOfStolenTasks;
+}
+
+void ParallelPacketProcessor::forEach(RawPacket* const* packets, size_t numOfPackets, OnPacket onPacket)
+{
+	ForEachTask task(PacketChunks(packets, numOfPackets, m_ChunkSize), onPacket);
+	runTasks(task.chunks.getNumOfChunks(), runForEachTask, &task);
+}
+
+size_t ParallelPacketProcessor::filter(RawPacket* const* packets, size_t numOfPackets, PacketPredicate predicate, std::vector<size_t>& matchingIndices)
+{
+	matchingIndices.clear();
+
+	FilterTask task(PacketChunks(packets, numOfPackets, m_ChunkSize), predicate);
+	runTasks(task.chunks.getNumOfChunks(), runFilterTask, &task);
+
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		if (task.matches[i])
+			matchingIndices.push_back(i);
+	}
+
+	return matchingIndices.size();
+}
+
+void ParallelPacketProcessor::partitionByFlow(RawPacket* const* packets, size_t numOfPackets, size_t numOfPartitions, std::vector<std::vector<size_t> >& partitions)
+{
+	if (numOfPartitions < 1)
+		numOfPartitions = 1;
+
+	// the partition of each packet is found in parallel, then every chunk writes its packets into the partitions from precomputed
+	// offsets, so the indices are in ascending order without sorting
+	PartitionTask task(PacketChunks(packets, numOfPackets, m_ChunkSize), numOfPartitions, &partitions);
+	size_t numOfChunks = task.chunks.getNumOfChunks();
+	runTasks(numOfChunks, runHashTask, &task);
+
+	partitions.clear();
+	partitions.resize(numOfPartitions);
+	for (size_t partition = 0; partition < numOfPartitions; partition++)
+	{
+		size_t offset = 0;
+		for (size_t chunk = 0; chunk < numOfChunks; chunk++)
+		{
+			size_t& chunkOffset = task.chunkOffsets[chunk * numOfPartitions + partition];
+			size_t count = chunkOffset;
+			chunkOffset = offset;
+			offset += count;
+		}
+
+		partitions[partition].resize(offset);
+	}
+
+	runTasks(numOfChunks, runScatterTask, &task);
+}
+
+void ParallelPacketProcessor::forEachPartition(RawPacket* const* packets, const std::vector<std::vector<size_t> >& partitions, OnPacket onPacket)
+{
+	ForEachPartitionTask task;
+	task.packets = packets;
+	task.partitions = &partitions;
+	task.onPacket = onPacket;
+	runTasks(partitions.size(), runForEachPartitionTask, &task);
+}
+
+} // namespace pcpp
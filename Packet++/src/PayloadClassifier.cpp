@@ -0,0 +1,282 @@
+#include "PayloadClassifier.h"
+#include "TcpLayer.h"
+#include "UdpLayer.h"
+#include "IPv4Layer.h"
+#include "IPv6Layer.h"
+#include "HttpLayer.h"
+#include "SSLLayer.h"
+#include "SipLayer.h"
+#include "DnsLayer.h"
+#include "RadiusLayer.h"
+#include "GtpLayer.h"
+#include "IpUtils.h"
+#include <string.h>
+
+#define DNS_HEADER_LENGTH 12
+#define DNS_MAX_RECORDS 256
+#define RADIUS_HEADER_LENGTH 20
+#define GTP_V1_HEADER_LENGTH 8
+#define TLS_MAX_RECORD_LENGTH (16384 + 2048)
+// the first line of a SIP request ends with its version, an HTTP request with the same method (OPTIONS) doesn't
+#define SIP_VERSION_STRING "SIP/2.0"
+#define MAX_FIRST_LINE_LENGTH 256
+
+namespace pcpp
+{
+
+struct PayloadSignature
+{
+	char prefix[4];
+	ProtocolType protocol;
+	bool udp;
+};
+
+// the prefixes of the text protocols. ::UnknownProtocol marks a prefix shared by HTTP and SIP
+static const PayloadSignature textSignatures[] =
+{
+	{ { 'G', 'E', 'T', ' ' }, HTTP, false },
+	{ { 'P', 'O', 'S', 'T' }, HTTP, false },
+	{ { 'H', 'E', 'A', 'D' }, HTTP, false },
+	{ { 'P', 'U', 'T', ' ' }, HTTP, false },
+	{ { 'D', 'E', 'L', 'E' }, HTTP, false },
+	{ { 'T', 'R', 'A', 'C' }, HTTP, false },
+	{ { 'C', 'O', 'N', 'N' }, HTTP, false },
+	{ { 'P', 'A', 'T', 'C' }, HTTP, false },
+	{ { 'H', 'T', 'T', 'P' }, HTTP, false },
+	{ { 'O', 'P', 'T', 'I' }, UnknownProtocol, true },
+	{ { 'I', 'N', 'V', 'I' }, SIP, true },
+	{ { 'A', 'C', 'K', ' ' }, SIP, true },
+	{ { 'B', 'Y', 'E', ' ' }, SIP, true },
+	{ { 'C', 'A', 'N', 'C' }, SIP, true },
+	{ { 'R', 'E', 'G', 'I' }, SIP, true },
+	{ { 'P', 'R', 'A', 'C' }, SIP, true },
+	{ { 'S', 'U', 'B', 'S' }, SIP, true },
+	{ { 'N', 'O', 'T', 'I' }, SIP, true },
+	{ { 'P', 'U', 'B', 'L' }, SIP, true },
+	{ { 'I', 'N', 'F', 'O' }, SIP, true },
+	{ { 'R', 'E', 'F', 'E' }, SIP, true },
+	{ { 'M', 'E', 'S', 'S' }, SIP, true },
+	{ { 'U', 'P', 'D', 'A' }, SIP, true },
+	{ { 'S', 'I', 'P', '/' }, SIP, true }
+};
+
+static bool firstLineHasSipVersion(const uint8_t* data, size_t dataLen)
+{
+	size_t lineLen = (dataLen < MAX_FIRST_LINE_LENGTH ? dataLen : MAX_FIRST_LINE_LENGTH);
+	const uint8_t* lineEnd = (const uint8_t*)memchr(data, '\r', lineLen);
+	if (lineEnd != NULL)
+		lineLen = lineEnd - data;
+
+	size_t versionLen = sizeof(SIP_VERSION_STRING) - 1;
+	return lineLen >= versionLen && memcmp(data + lineLen - versionLen, SIP_VERSION_STRING, versionLen) == 0;
+}
+
+static ProtocolType matchTextSignature(const uint8_t* data, size_t dataLen, bool isTcp, uint64_t protocols)
+{
+	if (dataLen < sizeof(textSignatures[0].prefix) || data[0] < 'A' || data[0] > 'Z')
+		return UnknownProtocol;
+
+	for (size_t i = 0; i < sizeof(textSignatures) / sizeof(textSignatures[0]); i++)
+	{
+		const PayloadSignature& signature = textSignatures[i];
+		if (memcmp(data, signature.prefix, sizeof(signature.prefix)) != 0 || (!isTcp && !signature.udp))
+			continue;
+
+		ProtocolType protocol = signature.protocol;
+		if (protocol == UnknownProtocol)
+			protocol = (firstLineHasSipVersion(data, dataLen) ? SIP : (isTcp ? HTTP : UnknownProtocol));
+
+		return ((protocols & protocol) != 0 ? protocol : UnknownProtocol);
+	}
+
+	return UnknownProtocol;
+}
+
+static bool isTlsRecord(const uint8_t* data, size_t dataLen)
+{
+	if (dataLen < sizeof(ssl_tls_record_layer))
+		return false;
+
+	// content type: change cipher spec, alert, handshake or application data. Version: SSL 3.0 to TLS 1.3
+	uint16_t recordLen = ((uint16_t)data[3] << 8) | data[4];
+	return data[0] >= 20 && data[0] <= 23 && data[1] == 3 && data[2] <= 4 && recordLen > 0 && recordLen <= TLS_MAX_RECORD_LENGTH;
+}
+
+static bool isDnsMessage(const uint8_t* data, size_t dataLen)
+{
+	if (dataLen <= DNS_HEADER_LENGTH)
+		return false;
+
+	// a standard opcode, the reserved Z bit cleared, a standard response code, one question and a sane number of records
+	uint8_t opcode = (data[2] >> 3) & 0x0f;
+	uint8_t responseCode = data[3] & 0x0f;
+	uint16_t questions = ((uint16_t)data[4] << 8) | data[5];
+	uint16_t answers = ((uint16_t)data[6] << 8) | data[7];
+	uint16_t authorities = ((uint16_t)data[8] << 8) | data[9];
+	uint16_t additionals = ((uint16_t)data[10] << 8) | data[11];
+	if (opcode > 5 || opcode == 3 || (data[3] & 0x40) != 0 || responseCode > 10 || questions != 1 ||
+			answers > DNS_MAX_RECORDS || authorities > DNS_MAX_RECORDS || additionals > DNS_MAX_RECORDS)
+		return false;
+
+	// the first label of the question name
+	uint8_t labelLen = data[DNS_HEADER_LENGTH];
+	return labelLen <= 63 && DNS_HEADER_LENGTH + 1 + (size_t)labelLen < dataLen;
+}
+
+static bool isRadiusMessage(const uint8_t* data, size_t dataLen)
+{
+	if (dataLen < RADIUS_HEADER_LENGTH)
+		return false;
+
+	// a known code (access, accounting, challenge, status, dynamic authorization) and a length which covers the whole datagram
+	uint8_t code = data[0];
+	uint16_t length = ((uint16_t)data[2] << 8) | data[3];
+	return ((code >= 1 && code <= 5) || (code >= 11 && code <= 13) || (code >= 40 && code <= 45)) && length == dataLen;
+}
+
+static bool isGtpV1Message(const uint8_t* data, size_t dataLen)
+{
+	if (dataLen < GTP_V1_HEADER_LENGTH)
+		return false;
+
+	// version 1, protocol type GTP, the reserved bit cleared and a length which covers the rest of the datagram
+	uint16_t length = ((uint16_t)data[2] << 8) | data[3];
+	return (data[0] & 0xf8) == 0x30 && (size_t)length + GTP_V1_HEADER_LENGTH == dataLen;
+}
+
+PayloadClassifier::PayloadClassifier(const PayloadClassifierConfiguration& config) :
+	m_Config(config), m_Flows(FlowTableConfiguration(config.flowCacheSize, 0, EvictLeastRecentlyUsed))
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+ProtocolType PayloadClassifier::matchSignature(const uint8_t* data, size_t dataLen, bool isTcp, uint64_t protocols)
+{
+	ProtocolType protocol = matchTextSignature(data, dataLen, isTcp, protocols);
+	if (protocol != UnknownProtocol)
+		return protocol;
+
+	if (isTcp)
+		return ((protocols & SSL) != 0 && isTlsRecord(data, dataLen) ? SSL : UnknownProtocol);
+
+	// the binary UDP protocols, from the strictest check to the loosest
+	if ((protocols & GTPv1) != 0 && isGtpV1Message(data, dataLen))
+		return GTPv1;
+	if ((protocols & Radius) != 0 && isRadiusMessage(data, dataLen))
+		return Radius;
+	if ((protocols & DNS) != 0 && isDnsMessage(data, dataLen))
+		return DNS;
+
+	return UnknownProtocol;
+}
+
+ProtocolType PayloadClassifier::classify(const FlowTuple& tuple, const uint8_t* data, size_t dataLen)
+{
+	m_Stats.packets++;
+	bool isTcp = (tuple.protocol == PACKETPP_IPPROTO_TCP);
+	if (m_Config.flowCacheSize == 0)
+		return matchSignature(data, dataLen, isTcp, m_Config.protocols);
+
+	// both directions of a flow share a verdict, so the endpoints are ordered
+	FlowTuple key = tuple;
+	int endpointOrder = memcmp(key.srcIP, key.dstIP, sizeof(key.srcIP));
+	if (endpointOrder > 0 || (endpointOrder == 0 && key.srcPort > key.dstPort))
+	{
+		memcpy(key.srcIP, tuple.dstIP, sizeof(key.srcIP));
+		memcpy(key.dstIP, tuple.srcIP, sizeof(key.dstIP));
+		key.srcPort = tuple.dstPort;
+		key.dstPort = tuple.srcPort;
+	}
+
+	FlowVerdict& verdict = m_Flows.get(key);
+	if (verdict.protocol != UnknownProtocol || verdict.attempts >= m_Config.maxAttempts)
+	{
+		m_Stats.cacheHits++;
+		return verdict.protocol;
+	}
+
+	ProtocolType protocol = matchSignature(data, dataLen, isTcp, m_Config.protocols);
+	verdict.attempts++;
+	if (protocol != UnknownProtocol)
+	{
+		verdict.protocol = protocol;
+		m_Stats.flowsDetected++;
+	}
+	else if (verdict.attempts >= m_Config.maxAttempts)
+	{
+		m_Stats.flowsUnknown++;
+	}
+
+	return protocol;
+}
+
+Layer* PayloadClassifier::createLayer(uint8_t* data, size_t dataLen, Layer* prevLayer, Packet* packet)
+{
+	FlowTuple tuple;
+	memset(&tuple, 0, sizeof(tuple));
+	if (prevLayer->getProtocol() == TCP)
+	{
+		const tcphdr* tcpHeader = (const tcphdr*)prevLayer->getData();
+		tuple.protocol = PACKETPP_IPPROTO_TCP;
+		tuple.srcPort = ntohs(tcpHeader->portSrc);
+		tuple.dstPort = ntohs(tcpHeader->portDst);
+	}
+	else
+	{
+		const udphdr* udpHeader = (const udphdr*)prevLayer->getData();
+		tuple.protocol = PACKETPP_IPPROTO_UDP;
+		tuple.srcPort = ntohs(udpHeader->portSrc);
+		tuple.dstPort = ntohs(udpHeader->portDst);
+	}
+
+	Layer* networkLayer = prevLayer->getPrevLayer();
+	if (networkLayer != NULL && networkLayer->getProtocol() == IPv4)
+	{
+		const iphdr* ipHeader = (const iphdr*)networkLayer->getData();
+		memcpy(tuple.srcIP, &ipHeader->ipSrc, sizeof(ipHeader->ipSrc));
+		memcpy(tuple.dstIP, &ipHeader->ipDst, sizeof(ipHeader->ipDst));
+		tuple.ipVersion = 4;
+	}
+	else if (networkLayer != NULL && networkLayer->getProtocol() == IPv6)
+	{
+		const ip6_hdr* ipHeader = (const ip6_hdr*)networkLayer->getData();
+		memcpy(tuple.srcIP, ipHeader->ipSrc, sizeof(ipHeader->ipSrc));
+		memcpy(tuple.dstIP, ipHeader->ipDst, sizeof(ipHeader->ipDst));
+		tuple.ipVersion = 6;
+	}
+
+	// the verdict only tells which parser to try, the payload is still verified as the port-based detection does, since not every packet
+	// of a flow starts with a message header
+	switch (classify(tuple, data, dataLen))
+	{
+	case HTTP:
+		if (HttpRequestFirstLine::parseMethod((char*)data, dataLen) != HttpRequestLayer::HttpMethodUnknown)
+			return new(packet) HttpRequestLayer(data, dataLen, prevLayer, packet);
+		if (HttpResponseFirstLine::parseStatusCode((char*)data, dataLen) != HttpResponseLayer::HttpStatusCodeUnknown)
+			return new(packet) HttpResponseLayer(data, dataLen, prevLayer, packet);
+		return NULL;
+	case SIP:
+		if (SipRequestFirstLine::parseMethod((char*)data, dataLen) != SipRequestLayer::SipMethodUnknown)
+			return new(packet) SipRequestLayer(data, dataLen, prevLayer, packet);
+		if (SipResponseFirstLine::parseStatusCode((char*)data, dataLen) != SipResponseLayer::SipStatusCodeUnknown)
+			return new(packet) SipResponseLayer(data, dataLen, prevLayer, packet);
+		return NULL;
+	case SSL:
+		return isTlsRecord(data, dataLen) ? SSLLayer::createSSLMessage(data, dataLen, prevLayer, packet) : NULL;
+	case DNS:
+		return dataLen > DNS_HEADER_LENGTH ? new(packet) DnsLayer(data, dataLen, prevLayer, packet) : NULL;
+	case Radius:
+		return RadiusLayer::isDataValid(data, dataLen) ? new(packet) RadiusLayer(data, dataLen, prevLayer, packet) : NULL;
+	case GTPv1:
+		return isGtpV1Message(data, dataLen) ? new(packet) GtpV1Layer(data, dataLen, prevLayer, packet) : NULL;
+	default:
+		return NULL;
+	}
+}
+
+void PayloadClassifier::clear()
+{
+	m_Flows.clear();
+}
+
+} // namespace pcpp
@@ -2,7 +2,6 @@
 
 #include "PayloadLayer.h"
 #include <string.h>
-#include <sstream>
 
 namespace pcpp
 {
@@ -17,10 +16,15 @@ PayloadLayer::PayloadLayer(const uint8_t* data, size_t dataLen, bool dummy) : La
 
 std::string PayloadLayer::toString()
 {
-	std::ostringstream dataLenStream;
-	dataLenStream << m_DataLen;
+	return PacketDumpWriter::layerToString(*this);
+}
 
-	return "Payload Layer, Data length: " + dataLenStream.str() + " [Bytes]";
+void PayloadLayer::dump(PacketDumpWriter& writer)
+{
+	writer.beginLayer("Payload Layer", GenericPayload);
+	writer.addNumber("Data length", "length", m_DataLen);
+	writer.appendText(" [Bytes]");
+	writer.endLayer();
 }
 
 } // namespace pcpp
@@ -0,0 +1,171 @@
+#define LOG_MODULE PacketLogModulePacket
+
+#include "ProtocolRegistry.h"
+#include "EthLayer.h"
+#include "IPv4Layer.h"
+#include "Logger.h"
+#include <string.h>
+
+namespace pcpp
+{
+
+ProtocolRegistry& ProtocolRegistry::getInstance()
+{
+	static ProtocolRegistry instance;
+	return instance;
+}
+
+ProtocolRegistry::ProtocolRegistry()
+{
+	resetToDefaults();
+}
+
+void ProtocolRegistry::resetToDefaults()
+{
+	memset(m_PortTable, 0, sizeof(m_PortTable));
+	memset(m_EtherTypeTable, NoProtocol, sizeof(m_EtherTypeTable));
+	for (int i = 0; i < 256; i++)
+		m_IPProtocolTable[i] = UnknownProtocol;
+	m_PayloadClassifier = NULL;
+
+	// DNS: DNS, mDNS, LLMNR
+	registerPort(53, DNS);
+	registerPort(5353, DNS);
+	registerPort(5355, DNS);
+
+	// HTTP
+	registerPort(80, HTTP);
+	registerPort(8080, HTTP);
+
+	// SSL/TLS
+	registerPort(0, SSL);	//default
+	registerPort(443, SSL);	//HTTPS
+	registerPort(465, SSL);	//SMTPS
+	registerPort(636, SSL);	//LDAPS
+	registerPort(989, SSL);	//FTPS - data
+	registerPort(990, SSL);	//FTPS - control
+	registerPort(992, SSL);	//Telnet over TLS/SSL
+	registerPort(993, SSL);	//IMAPS
+	registerPort(995, SSL);	//POP3S
+
+	// SIP
+	registerPort(5060, SIP);
+	registerPort(5061, SIP);
+
+	// RADIUS: authentication, accounting, dynamic authorization
+	registerPort(1812, Radius);
+	registerPort(1813, Radius);
+	registerPort(3799, Radius);
+
+	// GTP: GTP-U, GTP-C
+	registerPort(2152, GTPv1);
+	registerPort(2123, GTPv1);
+
+	// VXLAN
+	registerPort(4789, VXLAN);
+
+	registerEtherType(PCPP_ETHERTYPE_IP, IPv4);
+	registerEtherType(PCPP_ETHERTYPE_IPV6, IPv6);
+	registerEtherType(PCPP_ETHERTYPE_ARP, ARP);
+	registerEtherType(PCPP_ETHERTYPE_VLAN, VLAN);
+	registerEtherType(PCPP_ETHERTYPE_PPPOES, PPPoESession);
+	registerEtherType(PCPP_ETHERTYPE_PPPOED, PPPoEDiscovery);
+	registerEtherType(PCPP_ETHERTYPE_MPLS, MPLS);
+	registerEtherType(PCPP_ETHERTYPE_PPP, PPP_PPTP);
+
+	registerIPProtocol(PACKETPP_IPPROTO_UDP, UDP);
+	registerIPProtocol(PACKETPP_IPPROTO_TCP, TCP);
+	registerIPProtocol(PACKETPP_IPPROTO_ICMP, ICMP);
+	registerIPProtocol(PACKETPP_IPPROTO_IPIP, IPv4);
+	registerIPProtocol(PACKETPP_IPPROTO_GRE, GRE);
+	registerIPProtocol(PACKETPP_IPPROTO_IGMP, IGMP);
+}
+
+bool ProtocolRegistry::registerPort(uint16_t port, ProtocolType protocol)
+{
+	uint16_t flag = getPortProtocolFlag(protocol);
+	if (flag == 0)
+	{
+		LOG_ERROR("Protocol 0x%llX can't be registered on a port", (unsigned long long)protocol);
+		return false;
+	}
+
+	m_PortTable[port] |= flag;
+	return true;
+}
+
+bool ProtocolRegistry::unregisterPort(uint16_t port, ProtocolType protocol)
+{
+	uint16_t flag = getPortProtocolFlag(protocol);
+	if (flag == 0)
+	{
+		LOG_ERROR("Protocol 0x%llX can't be registered on a port", (unsigned long long)protocol);
+		return false;
+	}
+
+	m_PortTable[port] &= ~flag;
+	return true;
+}
+
+bool ProtocolRegistry::registerEtherType(uint16_t etherType, ProtocolType protocol)
+{
+	switch (protocol)
+	{
+	case IPv4:
+	case IPv6:
+	case ARP:
+	case VLAN:
+	case PPPoESession:
+	case PPPoEDiscovery:
+	case MPLS:
+	case PPP_PPTP:
+		m_EtherTypeTable[etherType] = getProtocolIndex(protocol);
+		return true;
+	default:
+		LOG_ERROR("Protocol 0x%llX can't be registered on an ethertype", (unsigned long long)protocol);
+		return false;
+	}
+}
+
+void ProtocolRegistry::unregisterEtherType(uint16_t etherType)
+{
+	m_EtherTypeTable[etherType] = NoProtocol;
+}
+
+bool ProtocolRegistry::registerIPProtocol(uint8_t ipProtocol, ProtocolType protocol)
+{
+	switch (protocol)
+	{
+	case TCP:
+	case UDP:
+	case ICMP:
+	case GRE:
+	case IGMP:
+	case IPv4:
+		m_IPProtocolTable[ipProtocol] = protocol;
+		return true;
+	default:
+		LOG_ERROR("Protocol 0x%llX can't be registered on an IP protocol number", (unsigned long long)protocol);
+		return false;
+	}
+}
+
+void ProtocolRegistry::unregisterIPProtocol(uint8_t ipProtocol)
+{
+	m_IPProtocolTable[ipProtocol] = UnknownProtocol;
+}
+
+uint8_t ProtocolRegistry::getProtocolIndex(ProtocolType protocol)
+{
+	uint64_t value = (uint64_t)protocol;
+	uint8_t index = 0;
+	while (value > 1)
+	{
+		value >>= 1;
+		index++;
+	}
+
+	return index;
+}
+
+} // namespace pcpp
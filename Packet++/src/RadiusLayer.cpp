@@ -16,16 +16,23 @@
 namespace pcpp
 {
 
+size_t RadiusAttributeBuilder::getRecordSize() const
+{
+	return m_RecValueLen + 2*sizeof(uint8_t);
+}
+
 RadiusAttribute RadiusAttributeBuilder::build() const
 {
-	uint8_t recSize = m_RecValueLen+2;
-	uint8_t* recordBuffer = new uint8_t[recSize];
-	memset(recordBuffer, 0, recSize);
-	recordBuffer[0] = m_RecType;
-	recordBuffer[1] = recSize;
-	if (m_RecValueLen > 0)
-		memcpy(recordBuffer+2, m_RecValue, m_RecValueLen);
+	return build(new uint8_t[getRecordSize()]);
+}
 
+RadiusAttribute RadiusAttributeBuilder::build(uint8_t* recordBuffer) const
+{
+	if (recordBuffer == NULL)
+		return RadiusAttribute(NULL);
+
+	size_t recSize = getRecordSize();
+	writeRecord(recordBuffer, recSize, (uint8_t)recSize);
 	return RadiusAttribute(recordBuffer);
 }
 
@@ -63,26 +70,22 @@ RadiusLayer::RadiusLayer(uint8_t code, uint8_t id, const std::string authenticat
 
 RadiusAttribute RadiusLayer::addAttrAt(const RadiusAttributeBuilder& attrBuilder, int offset)
 {
-	RadiusAttribute newAttr = attrBuilder.build();
-	size_t sizeToExtend = newAttr.getTotalSize();
+	size_t sizeToExtend = attrBuilder.getRecordSize();
 
 	if (!extendLayer(offset, sizeToExtend))
 	{
-		LOG_ERROR("Could not extend RadiusLayer in [%d] bytes", (int)newAttr.getTotalSize());
+		LOG_ERROR("Could not extend RadiusLayer in [%d] bytes", (int)sizeToExtend);
 		return RadiusAttribute(NULL);
 	}
 
-	memcpy(m_Data + offset, newAttr.getRecordBasePtr(), newAttr.getTotalSize());
-
-	uint8_t* newAttrPtr = m_Data + offset;
+	// the attribute is written directly into the space made for it
+	RadiusAttribute newAttr = attrBuilder.build(m_Data + offset);
 
 	m_AttributeReader.changeTLVRecordCount(1);
 
-	newAttr.purgeRecordData();
-
 	getRadiusHeader()->length = htons(m_DataLen);
 
-	return RadiusAttribute(newAttrPtr);
+	return newAttr;
 }
 
 std::string RadiusLayer::getAuthenticatorValue()
@@ -1,12 +1,23 @@
 #define LOG_MODULE PacketLogModuleRawPacket
 
 #include "RawPacket.h"
+#include "AtomicUtils.h"
+#include "RawPacketPool.h"
+#include "TimestampClock.h"
 #include <string.h>
 #include "Logger.h"
 
 namespace pcpp
 {
 
+// the reference count of a buffer shared by several instances, and the buffer itself which is freed when the count drops to 0
+struct RawPacket::SharedRawData
+{
+	volatile long refCount;
+	uint8_t* buffer;
+	RawPacketPool* pool;
+};
+
 void RawPacket::init()
 {
 	m_RawData = 0;
@@ -15,6 +26,9 @@ void RawPacket::init()
 	m_DeleteRawDataAtDestructor = true;
 	m_RawPacketSet = false;
 	m_LinkLayerType = LINKTYPE_ETHERNET;
+	m_RawDataPool = NULL;
+	m_Headroom = 0;
+	m_SharedData = NULL;
 }
 
 RawPacket::RawPacket(const uint8_t* pRawData, int rawDataLen, timeval timestamp, bool deleteRawDataAtDestructor, LinkLayerType layerType)
@@ -24,6 +38,14 @@ RawPacket::RawPacket(const uint8_t* pRawData, int rawDataLen, timeval timestamp,
 	setRawData(pRawData, rawDataLen, timestamp, layerType);
 }
 
+RawPacket::RawPacket(const uint8_t* pRawData, int rawDataLen, timespec timestamp, bool deleteRawDataAtDestructor, LinkLayerType layerType)
+{
+	init();
+	m_DeleteRawDataAtDestructor = deleteRawDataAtDestructor;
+	setRawData(pRawData, rawDataLen, TimestampClock::toTimeval(timestamp), layerType);
+	m_TimeStamp = timestamp;
+}
+
 RawPacket::RawPacket()
 {
 	init();
@@ -33,20 +55,25 @@ RawPacket::~RawPacket()
 {
 	if (m_DeleteRawDataAtDestructor)
 	{
-		delete[] m_RawData;
+		freeRawData();
 	}
 }
 
 RawPacket::RawPacket(const RawPacket& other)
 {
 	m_RawData = NULL;
+	m_RawDataPool = NULL;
+	m_SharedData = NULL;
 	copyDataFrom(other, true);
 }
 
 RawPacket& RawPacket::operator=(const RawPacket& other)
 {
-	if (m_RawData != NULL)
-		delete [] m_RawData;
+	if (this == &other)
+		return *this;
+
+	if (m_RawData != NULL && m_DeleteRawDataAtDestructor)
+		freeRawData();
 
 	m_RawPacketSet = false;
 
@@ -56,6 +83,45 @@ RawPacket& RawPacket::operator=(const RawPacket& other)
 }
 
 
+#if __cplusplus > 199711L || _MSC_VER >= 1800
+RawPacket::RawPacket(RawPacket&& other)
+{
+	init();
+	moveDataFrom(other);
+}
+
+RawPacket& RawPacket::operator=(RawPacket&& other)
+{
+	if (this == &other)
+		return *this;
+
+	if (m_RawData != NULL && m_DeleteRawDataAtDestructor)
+		freeRawData();
+
+	init();
+	moveDataFrom(other);
+
+	return *this;
+}
+#endif
+
+void RawPacket::moveDataFrom(RawPacket& other)
+{
+	m_RawData = other.m_RawData;
+	m_RawDataLen = other.m_RawDataLen;
+	m_FrameLength = other.m_FrameLength;
+	m_TimeStamp = other.m_TimeStamp;
+	m_DeleteRawDataAtDestructor = other.m_DeleteRawDataAtDestructor;
+	m_RawPacketSet = other.m_RawPacketSet;
+	m_LinkLayerType = other.m_LinkLayerType;
+	m_RawDataPool = other.m_RawDataPool;
+	m_Headroom = other.m_Headroom;
+	m_SharedData = other.m_SharedData;
+
+	// the buffer belongs to this instance now
+	other.init();
+}
+
 void RawPacket::copyDataFrom(const RawPacket& other, bool allocateData)
 {
 	if (!other.m_RawPacketSet)
@@ -68,6 +134,7 @@ void RawPacket::copyDataFrom(const RawPacket& other, bool allocateData)
 		m_DeleteRawDataAtDestructor = true;
 		m_RawData = new uint8_t[other.m_RawDataLen];
 		m_RawDataLen = other.m_RawDataLen;
+		m_Headroom = 0;
 	}
 
 	memcpy(m_RawData, other.m_RawData, other.m_RawDataLen);
@@ -83,17 +150,193 @@ bool RawPacket::setRawData(const uint8_t* pRawData, int rawDataLen, timeval time
 	m_FrameLength = frameLength;
 	if (m_RawData != 0 && m_DeleteRawDataAtDestructor)
 	{
-		delete[] m_RawData;
+		freeRawData();
+	}
+	m_RawDataPool = NULL;
+	m_Headroom = 0;
+
+	m_RawData = (uint8_t*)pRawData;
+	m_RawDataLen = rawDataLen;
+	m_TimeStamp = TimestampClock::toTimespec(timestamp);
+	m_RawPacketSet = true;
+	m_LinkLayerType = layerType;
+	return true;
+}
+
+bool RawPacket::copyRawData(const uint8_t* pRawData, int rawDataLen, timeval timestamp, RawPacketPool* pool, LinkLayerType layerType, int frameLength, size_t headroom)
+{
+	return copyRawData(pRawData, rawDataLen, TimestampClock::toTimespec(timestamp), pool, layerType, frameLength, headroom);
+}
+
+bool RawPacket::copyRawData(const uint8_t* pRawData, int rawDataLen, timespec timestamp, RawPacketPool* pool, LinkLayerType layerType, int frameLength, size_t headroom)
+{
+	if (rawDataLen < 0 || (pRawData == NULL && rawDataLen > 0))
+	{
+		LOG_ERROR("Cannot copy raw data: invalid data or length");
+		return false;
+	}
+
+	uint8_t* buffer = (pool != NULL ? pool->allocate(headroom + rawDataLen) : NULL);
+	RawPacketPool* bufferPool = (buffer != NULL ? pool : NULL);
+	if (buffer == NULL)
+		buffer = new uint8_t[headroom + rawDataLen];
+
+	memcpy(buffer + headroom, pRawData, rawDataLen);
+
+	if (m_RawData != 0 && m_DeleteRawDataAtDestructor)
+		freeRawData();
+
+	if (frameLength == -1)
+		frameLength = rawDataLen;
+
+	m_RawData = buffer + headroom;
+	m_RawDataPool = bufferPool;
+	m_Headroom = headroom;
+	m_RawDataLen = rawDataLen;
+	m_FrameLength = frameLength;
+	m_TimeStamp = timestamp;
+	m_DeleteRawDataAtDestructor = true;
+	m_RawPacketSet = true;
+	m_LinkLayerType = layerType;
+	return true;
+}
+
+bool RawPacket::setExternalRawData(const uint8_t* pRawData, int rawDataLen, timespec timestamp, LinkLayerType layerType, int frameLength)
+{
+	if (rawDataLen < 0 || (pRawData == NULL && rawDataLen > 0))
+	{
+		LOG_ERROR("Cannot set raw data: invalid data or length");
+		return false;
 	}
 
+	if (m_RawData != 0 && m_DeleteRawDataAtDestructor)
+		freeRawData();
+
+	if (frameLength == -1)
+		frameLength = rawDataLen;
+
 	m_RawData = (uint8_t*)pRawData;
+	m_RawDataPool = NULL;
+	m_Headroom = 0;
 	m_RawDataLen = rawDataLen;
+	m_FrameLength = frameLength;
 	m_TimeStamp = timestamp;
+	m_DeleteRawDataAtDestructor = false;
 	m_RawPacketSet = true;
 	m_LinkLayerType = layerType;
 	return true;
 }
 
+void RawPacket::freeRawData()
+{
+	if (m_SharedData != NULL)
+	{
+		// the last instance sharing the buffer frees it
+		if (atomicDecrement(&m_SharedData->refCount) == 0)
+		{
+			if (m_SharedData->pool != NULL)
+				m_SharedData->pool->release(m_SharedData->buffer);
+			else
+				delete[] m_SharedData->buffer;
+
+			delete m_SharedData;
+		}
+
+		m_SharedData = NULL;
+	}
+	else
+	{
+		// the buffer begins at the headroom
+		uint8_t* buffer = m_RawData - m_Headroom;
+		if (m_RawDataPool != NULL)
+			m_RawDataPool->release(buffer);
+		else
+			delete[] buffer;
+	}
+
+	m_RawData = 0;
+	m_RawDataPool = NULL;
+	m_Headroom = 0;
+}
+
+bool RawPacket::shareRawData(RawPacket& other)
+{
+	if (this == &other)
+		return true;
+
+	if (!other.m_RawPacketSet)
+	{
+		LOG_ERROR("Cannot share raw data: the other raw packet has no data");
+		return false;
+	}
+
+	// derived classes manage their buffers differently, so their data is copied
+	if (getObjectType() != other.getObjectType() || other.getObjectType() != 0)
+	{
+		if (getObjectType() != 0)
+		{
+			LOG_ERROR("Cannot share raw data into a raw packet of a derived class");
+			return false;
+		}
+
+		return copyRawData(other.m_RawData, other.m_RawDataLen, other.m_TimeStamp, NULL, other.m_LinkLayerType, other.m_FrameLength);
+	}
+
+	// data which isn't owned by the other instance may be freed or overwritten by its owner, so it's copied once to a buffer the other
+	// instance owns
+	if (!other.m_DeleteRawDataAtDestructor && !other.moveToNewBuffer(other.m_Headroom, other.m_RawDataLen))
+		return false;
+
+	if (other.m_SharedData == NULL)
+	{
+		other.m_SharedData = new SharedRawData();
+		other.m_SharedData->refCount = 1;
+		other.m_SharedData->buffer = other.m_RawData - other.m_Headroom;
+		other.m_SharedData->pool = other.m_RawDataPool;
+	}
+
+	// take the reference before releasing the current data, which may be the same buffer
+	atomicIncrement(&other.m_SharedData->refCount);
+	if (m_RawData != 0 && m_DeleteRawDataAtDestructor)
+		freeRawData();
+
+	m_RawData = other.m_RawData;
+	m_RawDataLen = other.m_RawDataLen;
+	m_FrameLength = other.m_FrameLength;
+	m_TimeStamp = other.m_TimeStamp;
+	m_LinkLayerType = other.m_LinkLayerType;
+	m_RawDataPool = other.m_RawDataPool;
+	m_Headroom = other.m_Headroom;
+	m_SharedData = other.m_SharedData;
+	m_DeleteRawDataAtDestructor = true;
+	m_RawPacketSet = true;
+	return true;
+}
+
+bool RawPacket::isRawDataShared() const
+{
+	return m_SharedData != NULL && atomicLoadAcquire(&m_SharedData->refCount) > 1;
+}
+
+bool RawPacket::unshareRawData(size_t newBufferLength)
+{
+	if (m_SharedData == NULL)
+		return true;
+
+	// if the other instances released the buffer it belongs to this instance again. Nobody else can take a reference to it meanwhile
+	if (atomicLoadAcquire(&m_SharedData->refCount) == 1)
+	{
+		delete m_SharedData;
+		m_SharedData = NULL;
+		return true;
+	}
+
+	if ((int)newBufferLength < m_RawDataLen)
+		newBufferLength = m_RawDataLen;
+
+	return moveToNewBuffer(m_Headroom, newBufferLength);
+}
+
 const uint8_t* RawPacket::getRawData() const
 {
 	return m_RawData;
@@ -121,15 +364,22 @@ int RawPacket::getFrameLength() const
 
 timeval RawPacket::getPacketTimeStamp() const
 {
-	return m_TimeStamp;
+	return TimestampClock::toTimeval(m_TimeStamp);
+}
+
+void RawPacket::setPacketTimeStamp(timeval timestamp)
+{
+	m_TimeStamp = TimestampClock::toTimespec(timestamp);
 }
 
 void RawPacket::clear()
 {
-	if (m_RawData != 0)
-		delete[] m_RawData;
+	if (m_RawData != 0 && m_DeleteRawDataAtDestructor)
+		freeRawData();
 
 	m_RawData = 0;
+	m_RawDataPool = NULL;
+	m_Headroom = 0;
 	m_RawDataLen = 0;
 	m_FrameLength = 0;
 	m_RawPacketSet = false;
@@ -137,6 +387,9 @@ void RawPacket::clear()
 
 void RawPacket::appendData(const uint8_t* dataToAppend, size_t dataToAppendLen)
 {
+	if (m_SharedData != NULL && !unshareRawData(m_RawDataLen + dataToAppendLen))
+		return;
+
 	memcpy((uint8_t*)m_RawData+m_RawDataLen, dataToAppend, dataToAppendLen);
 	m_RawDataLen += dataToAppendLen;
 	m_FrameLength = m_RawDataLen;
@@ -144,11 +397,19 @@ void RawPacket::appendData(const uint8_t* dataToAppend, size_t dataToAppendLen)
 
 void RawPacket::insertData(int atIndex, const uint8_t* dataToInsert, size_t dataToInsertLen)
 {
-	int index = m_RawDataLen-1;
-	while (index >= atIndex)
+	if (m_SharedData != NULL && !unshareRawData(m_RawDataLen + dataToInsertLen))
+		return;
+
+	if (m_Headroom >= dataToInsertLen)
+	{
+		// move the data before the index into the headroom
+		memmove(m_RawData - dataToInsertLen, m_RawData, atIndex);
+		m_RawData -= dataToInsertLen;
+		m_Headroom -= dataToInsertLen;
+	}
+	else
 	{
-		m_RawData[index+dataToInsertLen] = m_RawData[index];
-		index--;
+		memmove(m_RawData + atIndex + dataToInsertLen, m_RawData + atIndex, m_RawDataLen - atIndex);
 	}
 
 	memcpy((uint8_t*)m_RawData+atIndex, dataToInsert, dataToInsertLen);
@@ -158,6 +419,9 @@ void RawPacket::insertData(int atIndex, const uint8_t* dataToInsert, size_t data
 
 bool RawPacket::reallocateData(size_t newBufferLength)
 {
+	if (m_SharedData != NULL && !unshareRawData(newBufferLength))
+		return false;
+
 	if ((int)newBufferLength == m_RawDataLen)
 		return true;
 
@@ -167,31 +431,71 @@ bool RawPacket::reallocateData(size_t newBufferLength)
 		return false;
 	}
 
-	uint8_t* newBuffer = new uint8_t[newBufferLength];
-	memset(newBuffer, 0, newBufferLength);
-	memcpy(newBuffer, m_RawData, m_RawDataLen);
+	// buffers taken from a pool are usually larger than the data, so there may be no need to re-allocate
+	RawPacketPool* pool = (m_DeleteRawDataAtDestructor ? m_RawDataPool : NULL);
+	if (pool != NULL && m_Headroom + newBufferLength <= pool->getBufferSize(m_RawData - m_Headroom))
+	{
+		memset(m_RawData + m_RawDataLen, 0, newBufferLength - m_RawDataLen);
+		return true;
+	}
+
+	return moveToNewBuffer(m_Headroom, newBufferLength);
+}
+
+bool RawPacket::reserveHeadroom(size_t headroom, size_t newBufferLength)
+{
+	if ((int)newBufferLength < m_RawDataLen)
+		newBufferLength = m_RawDataLen;
+
+	if (headroom <= m_Headroom)
+		return true;
+
+	return moveToNewBuffer(headroom, newBufferLength);
+}
+
+bool RawPacket::moveToNewBuffer(size_t headroom, size_t newBufferLength)
+{
+	RawPacketPool* pool = (m_DeleteRawDataAtDestructor ? m_RawDataPool : NULL);
+	uint8_t* newBuffer = (pool != NULL ? pool->allocate(headroom + newBufferLength) : NULL);
+	RawPacketPool* newBufferPool = (newBuffer != NULL ? pool : NULL);
+	if (newBuffer == NULL)
+		newBuffer = new uint8_t[headroom + newBufferLength];
+
+	memset(newBuffer, 0, headroom + newBufferLength);
+	memcpy(newBuffer + headroom, m_RawData, m_RawDataLen);
 	if (m_DeleteRawDataAtDestructor)
-		delete [] m_RawData;
+		freeRawData();
 
 	m_DeleteRawDataAtDestructor = true;
-	m_RawData = newBuffer;
+	m_RawData = newBuffer + headroom;
+	m_RawDataPool = newBufferPool;
+	m_Headroom = headroom;
 
 	return true;
 }
 
 bool RawPacket::removeData(int atIndex, size_t numOfBytesToRemove)
 {
+	if (m_SharedData != NULL && !unshareRawData())
+		return false;
+
 	if ((atIndex + (int)numOfBytesToRemove) > m_RawDataLen)
 	{
 		LOG_ERROR("Remove section is out of raw packet bound");
 		return false;
 	}
 
-	int index = atIndex;
-	while (index < (m_RawDataLen - (int)numOfBytesToRemove))
+	int numOfBytesAfter = m_RawDataLen - atIndex - (int)numOfBytesToRemove;
+	if (m_Headroom > 0 && atIndex < numOfBytesAfter)
+	{
+		// move the data before the removed bytes forward and return the removed bytes to the headroom
+		memmove(m_RawData + numOfBytesToRemove, m_RawData, atIndex);
+		m_RawData += numOfBytesToRemove;
+		m_Headroom += numOfBytesToRemove;
+	}
+	else
 	{
-		m_RawData[index] = m_RawData[index+numOfBytesToRemove];
-		index++;
+		memmove(m_RawData + atIndex, m_RawData + atIndex + numOfBytesToRemove, numOfBytesAfter);
 	}
 
 	m_RawDataLen -= numOfBytesToRemove;
@@ -199,4 +503,20 @@ bool RawPacket::removeData(int atIndex, size_t numOfBytesToRemove)
 	return true;
 }
 
+bool RawPacket::truncate(int capturedLength)
+{
+	if (capturedLength < 0)
+		return false;
+
+	if (m_RawDataLen <= capturedLength)
+		return true;
+
+	int frameLength = m_FrameLength;
+	if (!removeData(capturedLength, (size_t)(m_RawDataLen - capturedLength)))
+		return false;
+
+	m_FrameLength = frameLength;
+	return true;
+}
+
 } // namespace pcpp
@@ -0,0 +1,148 @@
+#define LOG_MODULE PacketLogModuleRawPacket
+
+#include "RawPacketPool.h"
+#include "Logger.h"
+
+namespace pcpp
+{
+
+RawPacketPool::RawPacketPool(size_t smallBufferSize, size_t largeBufferSize, size_t buffersPerSlab, PacketMemoryAllocator* allocator)
+{
+	if (largeBufferSize < smallBufferSize)
+		largeBufferSize = smallBufferSize;
+
+	// keep all buffers 16-byte aligned
+	m_BufferClasses[SmallBuffer].bufferSize = (smallBufferSize + 15) & ~((size_t)15);
+	m_BufferClasses[LargeBuffer].bufferSize = (largeBufferSize + 15) & ~((size_t)15);
+
+	for (int i = 0; i < NumOfBufferClasses; i++)
+	{
+		m_BufferClasses[i].freeList = NULL;
+		m_BufferClasses[i].numOfFree = 0;
+		m_BufferClasses[i].numOfInUse = 0;
+	}
+
+	m_BuffersPerSlab = (buffersPerSlab > 0 ? buffersPerSlab : 1);
+	m_Allocator = (allocator != NULL ? allocator : PacketMemoryAllocator::getHeapAllocator());
+	pthread_mutex_init(&m_Mutex, NULL);
+}
+
+RawPacketPool::~RawPacketPool()
+{
+	if (m_BufferClasses[SmallBuffer].numOfInUse + m_BufferClasses[LargeBuffer].numOfInUse > 0)
+		LOG_DEBUG("Raw packet pool is destructed while %d buffers are still in use",
+				(int)(m_BufferClasses[SmallBuffer].numOfInUse + m_BufferClasses[LargeBuffer].numOfInUse));
+
+	for (std::vector<std::pair<uint8_t*, size_t> >::iterator iter = m_Slabs.begin(); iter != m_Slabs.end(); iter++)
+		m_Allocator->deallocate(iter->first, iter->second);
+
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+bool RawPacketPool::allocateSlab(BufferClassType bufferClass)
+{
+	BufferClass& curClass = m_BufferClasses[bufferClass];
+	size_t entrySize = sizeof(BufferHeader) + curClass.bufferSize;
+
+	uint8_t* slab = m_Allocator->allocate(entrySize * m_BuffersPerSlab);
+	if (slab == NULL)
+	{
+		LOG_ERROR("Cannot allocate a slab of %d buffers for the raw packet pool", (int)m_BuffersPerSlab);
+		return false;
+	}
+	m_Slabs.push_back(std::pair<uint8_t*, size_t>(slab, entrySize * m_BuffersPerSlab));
+
+	for (size_t i = 0; i < m_BuffersPerSlab; i++)
+	{
+		BufferHeader* header = (BufferHeader*)(slab + i * entrySize);
+		header->info.pool = this;
+		header->info.bufferClass = (uint32_t)bufferClass;
+		header->info.nextFree = curClass.freeList;
+		curClass.freeList = header;
+	}
+
+	curClass.numOfFree += m_BuffersPerSlab;
+	return true;
+}
+
+uint8_t* RawPacketPool::allocate(size_t size)
+{
+	BufferClassType bufferClass;
+	if (size <= m_BufferClasses[SmallBuffer].bufferSize)
+		bufferClass = SmallBuffer;
+	else if (size <= m_BufferClasses[LargeBuffer].bufferSize)
+		bufferClass = LargeBuffer;
+	else
+		return NULL;
+
+	pthread_mutex_lock(&m_Mutex);
+
+	BufferClass& curClass = m_BufferClasses[bufferClass];
+	if (curClass.freeList == NULL && !allocateSlab(bufferClass))
+	{
+		pthread_mutex_unlock(&m_Mutex);
+		return NULL;
+	}
+
+	BufferHeader* header = curClass.freeList;
+	curClass.freeList = header->info.nextFree;
+	curClass.numOfFree--;
+	curClass.numOfInUse++;
+
+	pthread_mutex_unlock(&m_Mutex);
+
+	return (uint8_t*)(header + 1);
+}
+
+void RawPacketPool::release(uint8_t* buffer)
+{
+	if (buffer == NULL)
+		return;
+
+	BufferHeader* header = ((BufferHeader*)buffer) - 1;
+	if (header->info.pool != this || header->info.bufferClass >= (uint32_t)NumOfBufferClasses)
+	{
+		LOG_ERROR("Buffer wasn't allocated from this pool");
+		return;
+	}
+
+	pthread_mutex_lock(&m_Mutex);
+
+	BufferClass& curClass = m_BufferClasses[header->info.bufferClass];
+	header->info.nextFree = curClass.freeList;
+	curClass.freeList = header;
+	curClass.numOfFree++;
+	curClass.numOfInUse--;
+
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+size_t RawPacketPool::getBufferSize(const uint8_t* buffer) const
+{
+	if (buffer == NULL)
+		return 0;
+
+	const BufferHeader* header = ((const BufferHeader*)buffer) - 1;
+	if (header->info.pool != this || header->info.bufferClass >= (uint32_t)NumOfBufferClasses)
+		return 0;
+
+	return m_BufferClasses[header->info.bufferClass].bufferSize;
+}
+
+size_t RawPacketPool::getNumOfBuffersInUse()
+{
+	pthread_mutex_lock(&m_Mutex);
+	size_t result = m_BufferClasses[SmallBuffer].numOfInUse + m_BufferClasses[LargeBuffer].numOfInUse;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+size_t RawPacketPool::getNumOfFreeBuffers()
+{
+	pthread_mutex_lock(&m_Mutex);
+	size_t result = m_BufferClasses[SmallBuffer].numOfFree + m_BufferClasses[LargeBuffer].numOfFree;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+} // namespace pcpp
@@ -0,0 +1,56 @@
+#include "RawPacketQueue.h"
+#include <string.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace pcpp
+{
+
+const size_t RawPacketQueue::MinBufferSize;
+
+bool RawPacketQueue::enqueueCopy(RawPacket* rawPacket, bool dropWhenFull, const volatile bool* running)
+{
+	QueuedRawPacket* queuedPacket = reserve();
+	while (queuedPacket == NULL)
+	{
+		if (dropWhenFull || !*running)
+			return false;
+
+		sleepBriefly();
+		queuedPacket = reserve();
+	}
+
+	// queue elements keep their buffers, so a buffer is allocated only the first time an element is used or when a larger packet arrives
+	int dataLen = rawPacket->getRawDataLen();
+	if (queuedPacket->bufferSize < (size_t)dataLen)
+	{
+		delete [] queuedPacket->data;
+		queuedPacket->bufferSize = ((size_t)dataLen > MinBufferSize ? (size_t)dataLen : MinBufferSize);
+		queuedPacket->data = new uint8_t[queuedPacket->bufferSize];
+	}
+
+	memcpy(queuedPacket->data, rawPacket->getRawData(), dataLen);
+	queuedPacket->dataLen = dataLen;
+	queuedPacket->frameLength = rawPacket->getFrameLength();
+	queuedPacket->timestamp = rawPacket->getPacketTimeStampNs();
+	queuedPacket->linkType = rawPacket->getLinkLayerType();
+	publish();
+	return true;
+}
+
+void RawPacketQueue::sleepBriefly()
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	Sleep(1);
+#else
+	timespec interval;
+	interval.tv_sec = 0;
+	interval.tv_nsec = 50000;
+	nanosleep(&interval, NULL);
+#endif
+}
+
+} // namespace pcpp
@@ -0,0 +1,214 @@
+#define LOG_MODULE PacketLogModuleRawPacket
+
+#include "RawPacketSlabVector.h"
+#include "Logger.h"
+#include "TimestampClock.h"
+#include <string.h>
+#include <new>
+
+namespace pcpp
+{
+
+RawPacketSlabVector::RawPacketSlabVector(size_t slabSize, size_t packetsPerBlock, PacketMemoryAllocator* allocator)
+{
+	m_SlabSize = (slabSize > 0 ? slabSize : DefaultSlabSize);
+	m_PacketsPerBlock = (packetsPerBlock > 0 ? packetsPerBlock : 1);
+	m_Allocator = (allocator != NULL ? allocator : PacketMemoryAllocator::getHeapAllocator());
+	m_CurSlab = 0;
+	m_CurSlabOffset = 0;
+	m_LargeSlabsSize = 0;
+	m_DataSize = 0;
+	m_MemoryLimit = 0;
+	m_NumOfDroppedPackets = 0;
+}
+
+RawPacketSlabVector::~RawPacketSlabVector()
+{
+	clear();
+
+	for (std::vector<uint8_t*>::iterator iter = m_PacketBlocks.begin(); iter != m_PacketBlocks.end(); iter++)
+		m_Allocator->deallocate(*iter, m_PacketsPerBlock * sizeof(RawPacket));
+
+	for (std::vector<uint8_t*>::iterator iter = m_Slabs.begin(); iter != m_Slabs.end(); iter++)
+		m_Allocator->deallocate(*iter, m_SlabSize);
+}
+
+bool RawPacketSlabVector::allocatePacketBlock()
+{
+	uint8_t* block = m_Allocator->allocate(m_PacketsPerBlock * sizeof(RawPacket));
+	if (block == NULL)
+		return false;
+
+	m_PacketBlocks.push_back(block);
+	return true;
+}
+
+bool RawPacketSlabVector::allocateSlab()
+{
+	uint8_t* slab = m_Allocator->allocate(m_SlabSize);
+	if (slab == NULL)
+		return false;
+
+	m_Slabs.push_back(slab);
+	return true;
+}
+
+uint8_t* RawPacketSlabVector::allocateData(size_t size)
+{
+	if (size > m_SlabSize)
+	{
+		uint8_t* largeSlab = m_Allocator->allocate(size);
+		if (largeSlab == NULL)
+			return NULL;
+
+		m_LargeSlabs.push_back(std::pair<uint8_t*, size_t>(largeSlab, size));
+		m_LargeSlabsSize += size;
+		return largeSlab;
+	}
+
+	// move to the next slab when the current one is full. Slabs kept by clear() are reused before new ones are allocated
+	if (m_CurSlab < m_Slabs.size() && m_CurSlabOffset + size > m_SlabSize)
+	{
+		m_CurSlab++;
+		m_CurSlabOffset = 0;
+	}
+
+	if (m_CurSlab == m_Slabs.size() && !allocateSlab())
+		return NULL;
+
+	uint8_t* result = m_Slabs[m_CurSlab] + m_CurSlabOffset;
+	m_CurSlabOffset += size;
+	return result;
+}
+
+size_t RawPacketSlabVector::getAllocationSize(size_t dataSize) const
+{
+	// the memory pushBack() would allocate for a packet of this size, following the same decisions as pushBack() and allocateData()
+	size_t result = 0;
+	if (m_Packets.size() / m_PacketsPerBlock == m_PacketBlocks.size())
+		result += m_PacketsPerBlock * sizeof(RawPacket);
+
+	if (dataSize > m_SlabSize)
+		result += dataSize;
+	else if (m_CurSlab == m_Slabs.size() || (m_CurSlabOffset + dataSize > m_SlabSize && m_CurSlab + 1 == m_Slabs.size()))
+		result += m_SlabSize;
+
+	return result;
+}
+
+RawPacket* RawPacketSlabVector::pushBack(const uint8_t* pRawData, int rawDataLen, timeval timestamp, LinkLayerType layerType, int frameLength)
+{
+	return pushBack(pRawData, rawDataLen, TimestampClock::toTimespec(timestamp), layerType, frameLength);
+}
+
+RawPacket* RawPacketSlabVector::pushBack(const uint8_t* pRawData, int rawDataLen, timespec timestamp, LinkLayerType layerType, int frameLength)
+{
+	if (rawDataLen < 0 || (pRawData == NULL && rawDataLen > 0))
+	{
+		LOG_ERROR("Cannot add packet to the vector: invalid data or length");
+		return NULL;
+	}
+
+	if (m_MemoryLimit > 0)
+	{
+		size_t allocationSize = getAllocationSize((size_t)rawDataLen);
+		if (allocationSize > 0 && getMemoryUsage() + allocationSize > m_MemoryLimit)
+		{
+			m_NumOfDroppedPackets++;
+			return NULL;
+		}
+	}
+
+	// RawPacket objects are constructed in place, packet i is in block i / m_PacketsPerBlock
+	size_t index = m_Packets.size();
+	if (index / m_PacketsPerBlock == m_PacketBlocks.size() && !allocatePacketBlock())
+	{
+		LOG_ERROR("Cannot add packet to the vector: a block of raw packets can't be allocated");
+		return NULL;
+	}
+
+	uint8_t* data = allocateData((size_t)rawDataLen);
+	if (data == NULL)
+	{
+		LOG_ERROR("Cannot add packet to the vector: a slab can't be allocated");
+		return NULL;
+	}
+
+	memcpy(data, pRawData, rawDataLen);
+	m_DataSize += rawDataLen;
+
+	uint8_t* place = m_PacketBlocks[index / m_PacketsPerBlock] + (index % m_PacketsPerBlock) * sizeof(RawPacket);
+	RawPacket* rawPacket = new (place) RawPacket(data, rawDataLen, timestamp, false, layerType);
+	if (frameLength != -1)
+	{
+		rawPacket->setRawData(data, rawDataLen, TimestampClock::toTimeval(timestamp), layerType, frameLength);
+		rawPacket->setPacketTimeStamp(timestamp);
+	}
+
+	m_Packets.push_back(rawPacket);
+	return rawPacket;
+}
+
+RawPacket* RawPacketSlabVector::pushBack(const RawPacket& rawPacket)
+{
+	if (!rawPacket.isPacketSet())
+	{
+		LOG_ERROR("Cannot add packet to the vector: raw packet has no data");
+		return NULL;
+	}
+
+	return pushBack(rawPacket.getRawDataReadOnly(), rawPacket.getRawDataLen(), rawPacket.getPacketTimeStampNs(), rawPacket.getLinkLayerType(), rawPacket.getFrameLength());
+}
+
+void RawPacketSlabVector::reserve(size_t numOfPackets)
+{
+	m_Packets.reserve(numOfPackets);
+
+	size_t numOfBlocks = (numOfPackets + m_PacketsPerBlock - 1) / m_PacketsPerBlock;
+	while (m_PacketBlocks.size() < numOfBlocks)
+	{
+		if (!allocatePacketBlock())
+			break;
+	}
+}
+
+void RawPacketSlabVector::reserveData(size_t numOfBytes)
+{
+	// space left in the current slab and in the slabs after it, which were kept by clear()
+	size_t available = 0;
+	if (m_CurSlab < m_Slabs.size())
+		available = (m_Slabs.size() - m_CurSlab) * m_SlabSize - m_CurSlabOffset;
+
+	while (available < numOfBytes)
+	{
+		if (!allocateSlab())
+			break;
+		available += m_SlabSize;
+	}
+}
+
+void RawPacketSlabVector::clear()
+{
+	// the packets don't own their data unless it was moved to a new buffer, in which case their d'tor frees it
+	for (std::vector<RawPacket*>::iterator iter = m_Packets.begin(); iter != m_Packets.end(); iter++)
+		(*iter)->~RawPacket();
+
+	m_Packets.clear();
+
+	for (std::vector<std::pair<uint8_t*, size_t> >::iterator iter = m_LargeSlabs.begin(); iter != m_LargeSlabs.end(); iter++)
+		m_Allocator->deallocate(iter->first, iter->second);
+
+	m_LargeSlabs.clear();
+	m_LargeSlabsSize = 0;
+	m_CurSlab = 0;
+	m_CurSlabOffset = 0;
+	m_DataSize = 0;
+	m_NumOfDroppedPackets = 0;
+}
+
+size_t RawPacketSlabVector::getMemoryUsage() const
+{
+	return m_PacketBlocks.size() * m_PacketsPerBlock * sizeof(RawPacket) + m_Slabs.size() * m_SlabSize + m_LargeSlabsSize;
+}
+
+} // namespace pcpp
@@ -0,0 +1,166 @@
+#include "RtpHeaderView.h"
+
+// the range of the second byte of RTCP packets (RFC 5761 section 4), which RTP packets sharing a port with RTCP mustn't use
+#define RTCP_PACKET_TYPE_FIRST 192
+#define RTCP_PACKET_TYPE_LAST  223
+
+#define RTP_VERSION 2
+
+// the SSRC of the sender and the sender information of a sender report
+#define RTCP_SENDER_REPORT_HEADER_LENGTH 28
+// the SSRC of the sender of a receiver report
+#define RTCP_RECEIVER_REPORT_HEADER_LENGTH 8
+#define RTCP_REPORT_BLOCK_LENGTH 24
+
+namespace pcpp
+{
+
+static inline uint16_t readUInt16(const uint8_t* data)
+{
+	return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+static inline bool isRtcpPacketType(uint8_t packetType)
+{
+	return packetType >= RTCP_PACKET_TYPE_FIRST && packetType <= RTCP_PACKET_TYPE_LAST;
+}
+
+bool RtpHeaderView::parse(const uint8_t* data, size_t dataLen)
+{
+	m_Data = NULL;
+	m_HeaderLength = 0;
+	m_PayloadLength = 0;
+
+	if (data == NULL || dataLen < FixedHeaderLength || (data[0] >> 6) != RTP_VERSION || isRtcpPacketType(data[1]))
+		return false;
+
+	size_t headerLength = FixedHeaderLength + (data[0] & 0x0f) * 4;
+	if (headerLength > dataLen)
+		return false;
+
+	// the extension header holds a profile-defined ID and the length of the extension in 32-bit words
+	if ((data[0] & 0x10) != 0)
+	{
+		if (headerLength + 4 > dataLen)
+			return false;
+		headerLength += 4 + readUInt16(data + headerLength + 2) * 4;
+		if (headerLength > dataLen)
+			return false;
+	}
+
+	// the last byte of the padding is the number of padding bytes, including itself
+	size_t paddingLength = 0;
+	if ((data[0] & 0x20) != 0)
+	{
+		paddingLength = data[dataLen - 1];
+		if (paddingLength == 0 || headerLength + paddingLength > dataLen)
+			return false;
+	}
+
+	m_Data = data;
+	m_HeaderLength = headerLength;
+	m_PayloadLength = dataLen - headerLength - paddingLength;
+	return true;
+}
+
+
+bool RtcpPacketView::parse(const uint8_t* data, size_t dataLen)
+{
+	m_Data = data;
+	m_DataLen = (data == NULL ? 0 : dataLen);
+	return parseAt(0);
+}
+
+bool RtcpPacketView::isRtcp(const uint8_t* data, size_t dataLen)
+{
+	return data != NULL && dataLen >= 2 && isRtcpPacketType(data[1]);
+}
+
+bool RtcpPacketView::next()
+{
+	if (m_Data == NULL || m_PacketLength == 0)
+		return false;
+
+	return parseAt(m_Offset + m_PacketLength);
+}
+
+bool RtcpPacketView::parseAt(size_t offset)
+{
+	m_Offset = offset;
+	m_PacketLength = 0;
+
+	if (offset + CommonHeaderLength > m_DataLen)
+		return false;
+
+	const uint8_t* header = m_Data + offset;
+	if ((header[0] >> 6) != RTP_VERSION || !isRtcpPacketType(header[1]))
+		return false;
+
+	// the length field is the length of the packet in 32-bit words minus one
+	size_t packetLength = ((size_t)readUInt16(header + 2) + 1) * 4;
+	if (offset + packetLength > m_DataLen)
+		return false;
+
+	m_PacketLength = packetLength;
+	return true;
+}
+
+uint32_t RtcpPacketView::getSsrc() const
+{
+	if (m_PacketLength < CommonHeaderLength + 4)
+		return 0;
+
+	return RtpHeaderView::readUInt32(m_Data + m_Offset + CommonHeaderLength);
+}
+
+bool RtcpPacketView::getSenderInfo(RtcpSenderInfo& senderInfo) const
+{
+	if (m_PacketLength < RTCP_SENDER_REPORT_HEADER_LENGTH || getPacketType() != RtcpSenderReport)
+		return false;
+
+	const uint8_t* data = m_Data + m_Offset + 8;
+	senderInfo.ntpTimestamp = ((uint64_t)RtpHeaderView::readUInt32(data) << 32) | RtpHeaderView::readUInt32(data + 4);
+	senderInfo.rtpTimestamp = RtpHeaderView::readUInt32(data + 8);
+	senderInfo.packetCount = RtpHeaderView::readUInt32(data + 12);
+	senderInfo.octetCount = RtpHeaderView::readUInt32(data + 16);
+	return true;
+}
+
+size_t RtcpPacketView::getReportBlocksOffset() const
+{
+	if (getPacketType() == RtcpSenderReport)
+		return RTCP_SENDER_REPORT_HEADER_LENGTH;
+	if (getPacketType() == RtcpReceiverReport)
+		return RTCP_RECEIVER_REPORT_HEADER_LENGTH;
+	return 0;
+}
+
+size_t RtcpPacketView::getNumOfReportBlocks() const
+{
+	size_t blocksOffset = getReportBlocksOffset();
+	if (blocksOffset == 0 || m_PacketLength < blocksOffset)
+		return 0;
+
+	size_t numOfBlocks = (m_PacketLength - blocksOffset) / RTCP_REPORT_BLOCK_LENGTH;
+	return (numOfBlocks < getCount() ? numOfBlocks : getCount());
+}
+
+bool RtcpPacketView::getReportBlock(size_t index, RtcpReportBlock& block) const
+{
+	if (index >= getNumOfReportBlocks())
+		return false;
+
+	const uint8_t* data = m_Data + m_Offset + getReportBlocksOffset() + index * RTCP_REPORT_BLOCK_LENGTH;
+	block.ssrc = RtpHeaderView::readUInt32(data);
+	block.fractionLost = data[4];
+	// the cumulative number of packets lost is a signed 24-bit number
+	uint32_t cumulativeLost = ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 8) | data[7];
+	block.cumulativeLost = (cumulativeLost & 0x800000) ? (int32_t)(cumulativeLost | 0xff000000) : (int32_t)cumulativeLost;
+	block.extendedHighestSequence = RtpHeaderView::readUInt32(data + 8);
+	block.jitter = RtpHeaderView::readUInt32(data + 12);
+	block.lastSenderReport = RtpHeaderView::readUInt32(data + 16);
+	block.delaySinceLastSenderReport = RtpHeaderView::readUInt32(data + 20);
+	return true;
+}
+
+} // namespace pcpp
@@ -0,0 +1,738 @@
+#include "RtpStreamAnalyzer.h"
+#include "FlowHash.h"
+#include "IPv4Layer.h"
+
+// RFC 3550 appendix A.1
+#define RTP_SEQ_MOD (1 << 16)
+#define RTP_MAX_DROPOUT 3000
+#define RTP_MAX_MISORDER 100
+#define RTP_MIN_SEQUENTIAL 2
+
+// the lowest payload type of the dynamic range (RFC 3551 section 3)
+#define RTP_FIRST_DYNAMIC_PAYLOAD_TYPE 96
+
+// the longest encoding name kept from an rtpmap attribute
+#define RTP_MAX_ENCODING_NAME_LEN 32
+
+namespace pcpp
+{
+
+// an encoding with its E-model impairment factors (ITU-T G.113 appendix I). Encodings without published factors are treated as G.711 with
+// packet loss concealment
+struct RtpEncoding
+{
+	const char* name;
+	double equipmentImpairment;
+	double packetLossRobustness;
+};
+
+static const RtpEncoding knownEncodings[] =
+{
+	{ "PCMU", 0, 25.1 },
+	{ "GSM", 20, 10 },
+	{ "G723", 15, 16.1 },
+	{ "DVI4", 7, 10 },
+	{ "LPC", 0, 25.1 },
+	{ "PCMA", 0, 25.1 },
+	{ "G722", 0, 25.1 },
+	{ "L16", 0, 25.1 },
+	{ "QCELP", 0, 25.1 },
+	{ "CN", 0, 25.1 },
+	{ "MPA", 0, 25.1 },
+	{ "G728", 7, 10 },
+	{ "G729", 11, 19 },
+	{ "CelB", 0, 25.1 },
+	{ "JPEG", 0, 25.1 },
+	{ "nv", 0, 25.1 },
+	{ "H261", 0, 25.1 },
+	{ "MPV", 0, 25.1 },
+	{ "MP2T", 0, 25.1 },
+	{ "H263", 0, 25.1 },
+	{ "telephone-event", 0, 25.1 },
+	{ "opus", 0, 25.1 },
+	{ "iLBC", 0, 25.1 },
+	{ "AMR", 5, 10 },
+	{ "AMR-WB", 0, 25.1 },
+	{ "speex", 0, 25.1 },
+	{ "H264", 0, 25.1 },
+	{ "VP8", 0, 25.1 },
+	{ "VP9", 0, 25.1 }
+};
+
+#define NUM_OF_KNOWN_ENCODINGS (sizeof(knownEncodings) / sizeof(knownEncodings[0]))
+
+// the static payload types of RFC 3551 section 6: the index of the encoding in knownEncodings and the clock rate
+struct StaticPayloadType
+{
+	int8_t encodingIndex;
+	uint32_t clockRate;
+};
+
+static const StaticPayloadType staticPayloadTypes[] =
+{
+	{ 0, 8000 }, { -1, 0 }, { -1, 0 }, { 1, 8000 }, { 2, 8000 }, { 3, 8000 }, { 3, 16000 }, { 4, 8000 },
+	{ 5, 8000 }, { 6, 8000 }, { 7, 44100 }, { 7, 44100 }, { 8, 8000 }, { 9, 8000 }, { 10, 90000 }, { 11, 8000 },
+	{ 3, 11025 }, { 3, 22050 }, { 12, 8000 }, { -1, 0 }, { -1, 0 }, { -1, 0 }, { -1, 0 }, { -1, 0 },
+	{ -1, 0 }, { 13, 90000 }, { 14, 90000 }, { -1, 0 }, { 15, 90000 }, { -1, 0 }, { -1, 0 }, { 16, 90000 },
+	{ 17, 90000 }, { 18, 90000 }, { 19, 90000 }
+};
+
+#define NUM_OF_STATIC_PAYLOAD_TYPES (sizeof(staticPayloadTypes) / sizeof(staticPayloadTypes[0]))
+
+static bool isStaticPayloadTypeKnown(uint8_t payloadType)
+{
+	return payloadType < NUM_OF_STATIC_PAYLOAD_TYPES && staticPayloadTypes[payloadType].encodingIndex >= 0;
+}
+
+static int8_t findEncoding(const char* name, size_t nameLen)
+{
+	for (size_t i = 0; i < NUM_OF_KNOWN_ENCODINGS; i++)
+	{
+		const char* knownName = knownEncodings[i].name;
+		if (strlen(knownName) != nameLen)
+			continue;
+
+		// encoding names are case-insensitive (RFC 4855 section 3)
+		size_t j = 0;
+		while (j < nameLen && (knownName[j] | 0x20) == (name[j] | 0x20))
+			j++;
+
+		if (j == nameLen)
+			return (int8_t)i;
+	}
+
+	return -1;
+}
+
+static inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// read the next token separated by white spaces, returns false if there are no more tokens
+static bool nextToken(const char*& data, size_t& dataLen, const char*& token, size_t& tokenLen)
+{
+	while (dataLen > 0 && isSpace(data[0]))
+	{
+		data++;
+		dataLen--;
+	}
+
+	token = data;
+	tokenLen = 0;
+	while (tokenLen < dataLen && !isSpace(data[tokenLen]))
+		tokenLen++;
+
+	data += tokenLen;
+	dataLen -= tokenLen;
+	return tokenLen > 0;
+}
+
+// parse a decimal number of up to 9 digits
+static bool parseNumber(const char* data, size_t dataLen, uint32_t& number)
+{
+	if (dataLen == 0 || dataLen > 9)
+		return false;
+
+	number = 0;
+	for (size_t i = 0; i < dataLen; i++)
+	{
+		if (data[i] < '0' || data[i] > '9')
+			return false;
+		number = number * 10 + (uint32_t)(data[i] - '0');
+	}
+
+	return true;
+}
+
+static inline bool isFieldName(HeaderField* field, char name)
+{
+	return field->getFieldNameLength() == 1 && field->getFieldNameData()[0] == name;
+}
+
+// parse a SDP media description field, e.g "audio 49170 RTP/AVP 0 8 97": its port and payload types. Media sent over TCP isn't analyzed
+static bool parseSdpMedia(HeaderField* field, uint16_t& port, uint8_t* payloadTypes, size_t& numOfPayloadTypes)
+{
+	const char* value = field->getFieldValueData();
+	size_t valueLen = field->getFieldValueLength();
+	const char* token;
+	size_t tokenLen;
+
+	if (!nextToken(value, valueLen, token, tokenLen) || !nextToken(value, valueLen, token, tokenLen))
+		return false;
+
+	// the port may be followed by a number of ports, e.g "49170/2"
+	size_t portLen = 0;
+	while (portLen < tokenLen && token[portLen] != '/')
+		portLen++;
+
+	uint32_t portNumber;
+	if (!parseNumber(token, portLen, portNumber) || portNumber == 0 || portNumber > 0xffff)
+		return false;
+
+	if (!nextToken(value, valueLen, token, tokenLen) || (tokenLen >= 3 && memcmp(token, "TCP", 3) == 0))
+		return false;
+
+	port = (uint16_t)portNumber;
+	numOfPayloadTypes = 0;
+	while (numOfPayloadTypes < RtpStreamAnalyzer::MaxPayloadTypesPerEndpoint && nextToken(value, valueLen, token, tokenLen))
+	{
+		uint32_t payloadType;
+		if (parseNumber(token, tokenLen, payloadType) && payloadType < 128)
+			payloadTypes[numOfPayloadTypes++] = (uint8_t)payloadType;
+	}
+
+	return true;
+}
+
+// parse a SDP rtpmap attribute, e.g "rtpmap:97 opus/48000/2"
+static bool parseSdpRtpMap(HeaderField* field, uint8_t& payloadType, int8_t& encodingIndex, uint32_t& clockRate)
+{
+	const char* value = field->getFieldValueData();
+	size_t valueLen = field->getFieldValueLength();
+	if (valueLen < 7 || memcmp(value, "rtpmap:", 7) != 0)
+		return false;
+
+	value += 7;
+	valueLen -= 7;
+	const char* token;
+	size_t tokenLen;
+
+	uint32_t number;
+	if (!nextToken(value, valueLen, token, tokenLen) || !parseNumber(token, tokenLen, number) || number >= 128)
+		return false;
+
+	payloadType = (uint8_t)number;
+	if (!nextToken(value, valueLen, token, tokenLen))
+		return false;
+
+	size_t nameLen = 0;
+	while (nameLen < tokenLen && token[nameLen] != '/')
+		nameLen++;
+
+	size_t rateLen = 0;
+	while (nameLen + 1 + rateLen < tokenLen && token[nameLen + 1 + rateLen] != '/')
+		rateLen++;
+
+	if (nameLen == 0 || nameLen > RTP_MAX_ENCODING_NAME_LEN || !parseNumber(token + nameLen + 1, rateLen, clockRate) || clockRate == 0)
+		return false;
+
+	encodingIndex = findEncoding(token, nameLen);
+	return true;
+}
+
+
+RtpStreamAnalyzer::RtpStreamAnalyzer(OnRtpStreamEnd onStreamEnd, void* userCookie, const RtpStreamAnalyzerConfiguration& config) :
+	m_OnStreamEnd(onStreamEnd), m_UserCookie(userCookie), m_Config(config),
+	m_Endpoints(FlowTableConfiguration(config.maxEndpoints, config.endpointTimeout, EvictLeastRecentlyUsed, NULL, config.initialCapacity)),
+	m_Streams(FlowTableConfiguration(config.maxStreams, config.streamTimeout, EvictLeastRecentlyUsed, NULL, config.initialCapacity), onStreamRemoved, this)
+{
+}
+
+void RtpStreamAnalyzer::makeEndpointKey(uint8_t ipVersion, const uint8_t* ipAddress, uint16_t port, EndpointKey& key)
+{
+	memset(&key, 0, sizeof(key));
+	memcpy(key.ipAddress, ipAddress, (ipVersion == 4 ? 4 : 16));
+	key.port = port;
+	key.ipVersion = ipVersion;
+}
+
+void RtpStreamAnalyzer::makeStreamKey(const PacketView& view, uint16_t srcPort, uint16_t dstPort, uint32_t ssrc, bool reversed, StreamKey& key)
+{
+	size_t addressLen = (view.ipVersion == 4 ? 4 : 16);
+	memset(&key, 0, sizeof(key));
+	memcpy(key.srcIP, (reversed ? view.dstIP : view.srcIP), addressLen);
+	memcpy(key.dstIP, (reversed ? view.srcIP : view.dstIP), addressLen);
+	key.srcPort = (reversed ? dstPort : srcPort);
+	key.dstPort = (reversed ? srcPort : dstPort);
+	key.ssrc = ssrc;
+	key.ipVersion = view.ipVersion;
+}
+
+bool RtpStreamAnalyzer::registerEndpoint(const SipMediaEndpoint& endpoint, void* context)
+{
+	if ((endpoint.ipVersion != 4 && endpoint.ipVersion != 6) || endpoint.port == 0)
+		return false;
+
+	EndpointKey key;
+	makeEndpointKey(endpoint.ipVersion, endpoint.ipAddress, endpoint.port, key);
+	EndpointInfo& info = m_Endpoints.get(key);
+	info.context = context;
+	info.numOfPayloadFormats = 0;
+	return true;
+}
+
+size_t RtpStreamAnalyzer::registerSdp(SdpLayer* sdpLayer, void* context)
+{
+	if (sdpLayer == NULL)
+		return 0;
+
+	// the fields are walked in order, as in SipDialogTracker: a media description is registered when the next one (or the end of the
+	// message) is reached, once its own connection field and rtpmap attributes are known
+	SipMediaEndpoint sessionEndpoint;
+	SipMediaEndpoint mediaEndpoint;
+	bool hasSessionAddress = false;
+	bool hasMediaAddress = false;
+	bool inMediaDescription = false;
+	bool hasMediaPort = false;
+	uint16_t mediaPort = 0;
+	uint8_t payloadTypes[MaxPayloadTypesPerEndpoint];
+	size_t numOfPayloadTypes = 0;
+	PayloadFormat payloadFormats[MaxPayloadTypesPerEndpoint];
+	size_t numOfRegistered = 0;
+
+	for (HeaderField* field = sdpLayer->getFirstField(); ; field = sdpLayer->getNextField(field))
+	{
+		bool endOfMedia = (field == NULL || field->isEndOfHeader() || isFieldName(field, 'm'));
+		if (endOfMedia && hasMediaPort && (hasMediaAddress || hasSessionAddress))
+		{
+			SipMediaEndpoint endpoint = (hasMediaAddress ? mediaEndpoint : sessionEndpoint);
+			endpoint.port = mediaPort;
+			if (registerEndpoint(endpoint, context))
+			{
+				EndpointKey key;
+				makeEndpointKey(endpoint.ipVersion, endpoint.ipAddress, endpoint.port, key);
+				EndpointInfo* info = m_Endpoints.find(key);
+				memcpy(info->payloadFormats, payloadFormats, numOfPayloadTypes * sizeof(PayloadFormat));
+				info->numOfPayloadFormats = numOfPayloadTypes;
+				numOfRegistered++;
+			}
+		}
+
+		if (field == NULL || field->isEndOfHeader())
+			break;
+
+		if (isFieldName(field, 'm'))
+		{
+			hasMediaPort = parseSdpMedia(field, mediaPort, payloadTypes, numOfPayloadTypes);
+			hasMediaAddress = false;
+			inMediaDescription = true;
+
+			// the payload types use their static clock rates unless an rtpmap attribute follows
+			for (size_t i = 0; hasMediaPort && i < numOfPayloadTypes; i++)
+			{
+				payloadFormats[i].payloadType = payloadTypes[i];
+				payloadFormats[i].encodingIndex = (isStaticPayloadTypeKnown(payloadTypes[i]) ? staticPayloadTypes[payloadTypes[i]].encodingIndex : -1);
+				payloadFormats[i].clockRate = (isStaticPayloadTypeKnown(payloadTypes[i]) ? staticPayloadTypes[payloadTypes[i]].clockRate : 0);
+			}
+		}
+		else if (isFieldName(field, 'c'))
+		{
+			// connection fields which precede all media descriptions are session level
+			if (!inMediaDescription)
+				hasSessionAddress = SipDialogTracker::parseSdpConnection(field, sessionEndpoint);
+			else
+				hasMediaAddress = SipDialogTracker::parseSdpConnection(field, mediaEndpoint);
+		}
+		else if (isFieldName(field, 'a') && hasMediaPort)
+		{
+			uint8_t payloadType;
+			int8_t encodingIndex;
+			uint32_t clockRate;
+			if (!parseSdpRtpMap(field, payloadType, encodingIndex, clockRate))
+				continue;
+
+			for (size_t i = 0; i < numOfPayloadTypes; i++)
+			{
+				if (payloadFormats[i].payloadType == payloadType)
+				{
+					payloadFormats[i].encodingIndex = encodingIndex;
+					payloadFormats[i].clockRate = clockRate;
+				}
+			}
+		}
+	}
+
+	return numOfRegistered;
+}
+
+bool RtpStreamAnalyzer::unregisterEndpoint(const SipMediaEndpoint& endpoint)
+{
+	if (endpoint.ipVersion != 4 && endpoint.ipVersion != 6)
+		return false;
+
+	EndpointKey key;
+	makeEndpointKey(endpoint.ipVersion, endpoint.ipAddress, endpoint.port, key);
+	return m_Endpoints.erase(key);
+}
+
+RtpStreamAnalyzer::EndpointInfo* RtpStreamAnalyzer::findEndpoint(uint8_t ipVersion, const uint8_t* ipAddress, uint16_t port)
+{
+	if (m_Endpoints.size() == 0)
+		return NULL;
+
+	EndpointKey key;
+	makeEndpointKey(ipVersion, ipAddress, port, key);
+	return m_Endpoints.find(key);
+}
+
+RtpPacketResult RtpStreamAnalyzer::processPacket(RawPacket* rawPacket)
+{
+	PacketView view;
+	if (!FlowKeyExtractor::extract(rawPacket, view))
+	{
+		setCurrentTime(rawPacket->getPacketTimeStampNs().tv_sec);
+		return RtpPacketIgnored;
+	}
+
+	return processPacket(view, rawPacket->getRawData(), (size_t)rawPacket->getRawDataLen(), rawPacket->getPacketTimeStampNs());
+}
+
+RtpPacketResult RtpStreamAnalyzer::processPacket(const PacketView& view, const uint8_t* data, size_t dataLen, const timespec& timestamp)
+{
+	setCurrentTime(timestamp.tv_sec);
+
+	if (!view.isPacketOfType(UDP) || view.payloadOffset == PacketView::NoOffset || view.payloadOffset >= dataLen)
+		return RtpPacketIgnored;
+
+	// the payload may be cut short by the capture length
+	size_t payloadLen = dataLen - view.payloadOffset;
+	if (view.payloadLength < payloadLen)
+		payloadLen = view.payloadLength;
+
+	const uint8_t* payload = data + view.payloadOffset;
+	if (RtcpPacketView::isRtcp(payload, payloadLen))
+		return processRtcp(view, payload, payloadLen);
+
+	return processRtp(view, payload, payloadLen, timestamp);
+}
+
+void RtpStreamAnalyzer::initStream(StreamState& stream, const StreamKey& key, const RtpHeaderView& rtp, const EndpointInfo* endpoint, const timespec& timestamp)
+{
+	memset(&stream, 0, sizeof(stream));
+	RtpStreamStats& stats = stream.stats;
+	stats.ipVersion = key.ipVersion;
+	memcpy(stats.srcIP, key.srcIP, sizeof(stats.srcIP));
+	memcpy(stats.dstIP, key.dstIP, sizeof(stats.dstIP));
+	stats.srcPort = key.srcPort;
+	stats.dstPort = key.dstPort;
+	stats.ssrc = key.ssrc;
+	stats.payloadType = rtp.getPayloadType();
+	stats.firstPacketTime = timestamp;
+
+	int8_t encodingIndex = -1;
+	if (isStaticPayloadTypeKnown(stats.payloadType))
+	{
+		encodingIndex = staticPayloadTypes[stats.payloadType].encodingIndex;
+		stats.clockRate = staticPayloadTypes[stats.payloadType].clockRate;
+	}
+
+	if (endpoint != NULL)
+	{
+		stats.context = endpoint->context;
+		for (size_t i = 0; i < endpoint->numOfPayloadFormats; i++)
+		{
+			if (endpoint->payloadFormats[i].payloadType == stats.payloadType)
+			{
+				encodingIndex = endpoint->payloadFormats[i].encodingIndex;
+				stats.clockRate = endpoint->payloadFormats[i].clockRate;
+				break;
+			}
+		}
+	}
+
+	stream.equipmentImpairment = 0;
+	stream.packetLossRobustness = 25.1;
+	if (encodingIndex >= 0)
+	{
+		stats.encodingName = knownEncodings[encodingIndex].name;
+		stream.equipmentImpairment = knownEncodings[encodingIndex].equipmentImpairment;
+		stream.packetLossRobustness = knownEncodings[encodingIndex].packetLossRobustness;
+	}
+
+	if (endpoint != NULL)
+		initSequence(stream, rtp.getSequenceNumber());
+	else
+	{
+		// streams which weren't announced are analyzed only after a few packets in sequence, so random UDP traffic is ignored
+		stream.maxSeq = (uint16_t)(rtp.getSequenceNumber() - 1);
+		stream.probation = RTP_MIN_SEQUENTIAL;
+	}
+}
+
+void RtpStreamAnalyzer::initSequence(StreamState& stream, uint16_t seq)
+{
+	stream.baseSeq = seq;
+	stream.maxSeq = seq;
+	stream.badSeq = RTP_SEQ_MOD + 1;
+	stream.cycles = 0;
+	stream.received = 0;
+	stream.hasTransit = false;
+}
+
+bool RtpStreamAnalyzer::updateSequence(StreamState& stream, uint16_t seq)
+{
+	uint16_t udelta = (uint16_t)(seq - stream.maxSeq);
+
+	if (stream.probation > 0)
+	{
+		if (seq == (uint16_t)(stream.maxSeq + 1))
+		{
+			stream.probation--;
+			stream.maxSeq = seq;
+			if (stream.probation == 0)
+			{
+				initSequence(stream, seq);
+				stream.received++;
+				return true;
+			}
+		}
+		else
+		{
+			stream.probation = RTP_MIN_SEQUENTIAL - 1;
+			stream.maxSeq = seq;
+		}
+
+		return false;
+	}
+
+	if (udelta < RTP_MAX_DROPOUT)
+	{
+		// in order, with a permissible gap
+		if (seq < stream.maxSeq)
+			stream.cycles += RTP_SEQ_MOD;
+		stream.maxSeq = seq;
+	}
+	else if (udelta <= RTP_SEQ_MOD - RTP_MAX_MISORDER)
+	{
+		// a very large jump. Two sequential packets after it mean the source restarted, otherwise the packet is ignored
+		if (seq != stream.badSeq)
+		{
+			stream.badSeq = (uint32_t)((seq + 1) & (RTP_SEQ_MOD - 1));
+			return false;
+		}
+
+		stream.priorExpected += stream.cycles + stream.maxSeq - stream.baseSeq + 1;
+		stream.priorReceived += stream.received;
+		stream.stats.sequenceRestarts++;
+		initSequence(stream, seq);
+	}
+	else
+	{
+		// a duplicate or reordered packet
+		stream.stats.reorderedPackets++;
+		stream.received++;
+		return false;
+	}
+
+	stream.received++;
+	return true;
+}
+
+RtpPacketResult RtpStreamAnalyzer::processRtp(const PacketView& view, const uint8_t* payload, size_t payloadLen, const timespec& timestamp)
+{
+	RtpHeaderView rtp;
+	if (!rtp.parse(payload, payloadLen))
+		return RtpPacketIgnored;
+
+	// media is usually sent from the port it's received on, so a packet may belong to the endpoint of either side
+	EndpointInfo* endpoint = findEndpoint(view.ipVersion, view.dstIP, view.dstPort);
+	if (endpoint == NULL)
+		endpoint = findEndpoint(view.ipVersion, view.srcIP, view.srcPort);
+
+	StreamKey key;
+	makeStreamKey(view, view.srcPort, view.dstPort, rtp.getSsrc(), false, key);
+
+	StreamState* stream = m_Streams.find(key);
+	if (stream == NULL)
+	{
+		if (endpoint == NULL)
+		{
+			uint8_t payloadType = rtp.getPayloadType();
+			if (!m_Config.analyzeUnregisteredStreams || view.srcPort < 1024 || view.dstPort < 1024 ||
+					(!isStaticPayloadTypeKnown(payloadType) && payloadType < RTP_FIRST_DYNAMIC_PAYLOAD_TYPE))
+				return RtpPacketIgnored;
+		}
+
+		stream = &m_Streams.get(key);
+		initStream(*stream, key, rtp, endpoint, timestamp);
+	}
+
+	RtpStreamStats& stats = stream->stats;
+	bool inOrder = updateSequence(*stream, rtp.getSequenceNumber());
+	if (stream->probation > 0)
+		return RtpPacketAnalyzed;
+
+	stats.packets++;
+	stats.payloadBytes += rtp.getPayloadLength();
+	stats.lastPacketTime = timestamp;
+
+	// the interarrival jitter (RFC 3550 appendix A.8), from packets in order of the payload type whose clock rate is known
+	if (inOrder && stats.clockRate > 0 && rtp.getPayloadType() == stats.payloadType)
+	{
+		uint64_t arrival = (uint64_t)timestamp.tv_sec * stats.clockRate + (uint64_t)timestamp.tv_nsec * stats.clockRate / 1000000000;
+		uint32_t transit = (uint32_t)arrival - rtp.getTimestamp();
+		if (stream->hasTransit)
+		{
+			int32_t delta = (int32_t)(transit - stream->lastTransit);
+			uint32_t absDelta = (uint32_t)(delta < 0 ? -delta : delta);
+			stream->jitter += absDelta - ((stream->jitter + 8) >> 4);
+
+			double jitterMs = (stream->jitter / 16.0) * 1000.0 / stats.clockRate;
+			if (jitterMs > stats.maxJitterMs)
+				stats.maxJitterMs = jitterMs;
+		}
+
+		stream->lastTransit = transit;
+		stream->hasTransit = true;
+	}
+
+	return RtpPacketAnalyzed;
+}
+
+RtpPacketResult RtpStreamAnalyzer::processRtcp(const PacketView& view, const uint8_t* payload, size_t payloadLen)
+{
+	RtcpPacketView rtcp;
+	if (!rtcp.parse(payload, payloadLen))
+		return RtpPacketIgnored;
+
+	// RTCP is sent from and to the port following the RTP port, or from and to the RTP port itself when they're multiplexed (RFC 5761)
+	uint16_t rtpSrcPort = view.srcPort & 0xfffe;
+	uint16_t rtpDstPort = view.dstPort & 0xfffe;
+	bool known = (findEndpoint(view.ipVersion, view.dstIP, rtpDstPort) != NULL || findEndpoint(view.ipVersion, view.srcIP, rtpSrcPort) != NULL);
+
+	do
+	{
+		uint8_t packetType = rtcp.getPacketType();
+		if (packetType != RtcpSenderReport && packetType != RtcpReceiverReport)
+			continue;
+
+		// the sender of a sender report sends RTP in the same direction as the report
+		StreamKey key;
+		if (packetType == RtcpSenderReport)
+		{
+			makeStreamKey(view, rtpSrcPort, rtpDstPort, rtcp.getSsrc(), false, key);
+			StreamState* stream = m_Streams.find(key);
+			if (stream != NULL)
+			{
+				stream->stats.senderReports++;
+				known = true;
+			}
+		}
+
+		// a report block describes a stream the sender of the report receives, which is sent in the opposite direction
+		for (size_t i = 0; i < rtcp.getNumOfReportBlocks(); i++)
+		{
+			RtcpReportBlock block;
+			rtcp.getReportBlock(i, block);
+			makeStreamKey(view, rtpSrcPort, rtpDstPort, block.ssrc, true, key);
+			StreamState* stream = m_Streams.find(key);
+			if (stream == NULL)
+				continue;
+
+			RtpStreamStats& stats = stream->stats;
+			stats.hasRemoteReport = true;
+			stats.remoteFractionLost = block.fractionLost / 256.0;
+			stats.remoteCumulativeLost = block.cumulativeLost;
+			stats.remoteJitterMs = (stats.clockRate > 0 ? block.jitter * 1000.0 / stats.clockRate : 0);
+			known = true;
+		}
+	} while (rtcp.next());
+
+	return (known ? RtcpPacketAnalyzed : RtpPacketIgnored);
+}
+
+double RtpStreamAnalyzer::estimateMos(double lossPercent, double delayMs, double equipmentImpairment, double packetLossRobustness)
+{
+	// the delay impairment (Id), simplified for the default echo parameters
+	double delayImpairment = 0.024 * delayMs;
+	if (delayMs > 177.3)
+		delayImpairment += 0.11 * (delayMs - 177.3);
+
+	// the effective equipment impairment (Ie-eff) for random loss
+	double effectiveImpairment = equipmentImpairment;
+	if (lossPercent > 0)
+		effectiveImpairment += (95 - equipmentImpairment) * lossPercent / (lossPercent + packetLossRobustness);
+
+	// 93.2 is the rating factor (R) of the default parameters without delay and equipment impairments
+	double rating = 93.2 - delayImpairment - effectiveImpairment;
+	if (rating <= 0)
+		return 1;
+	if (rating >= 100)
+		return 4.5;
+
+	return 1 + 0.035 * rating + rating * (rating - 60) * (100 - rating) * 7e-6;
+}
+
+void RtpStreamAnalyzer::finalizeStats(const StreamState& stream, RtpStreamStats& stats) const
+{
+	stats = stream.stats;
+	uint64_t expected = stream.priorExpected;
+	if (stream.received > 0)
+		expected += stream.cycles + stream.maxSeq - stream.baseSeq + 1;
+
+	stats.expectedPackets = expected;
+	stats.lostPackets = (int64_t)expected - (int64_t)(stream.priorReceived + stream.received);
+	stats.jitterMs = (stats.clockRate > 0 ? (stream.jitter / 16.0) * 1000.0 / stats.clockRate : 0);
+
+	double lossPercent = 0;
+	if (expected > 0 && stats.lostPackets > 0)
+		lossPercent = 100.0 * stats.lostPackets / expected;
+	stats.mos = estimateMos(lossPercent, m_Config.assumedDelayMs + 2 * stats.jitterMs, stream.equipmentImpairment, stream.packetLossRobustness);
+}
+
+void RtpStreamAnalyzer::endStream(StreamState& stream)
+{
+	// streams of unannounced traffic which never passed the probation aren't reported
+	if (m_OnStreamEnd == NULL || stream.stats.packets == 0)
+		return;
+
+	RtpStreamStats stats;
+	finalizeStats(stream, stats);
+	m_OnStreamEnd(stats, m_UserCookie);
+}
+
+void RtpStreamAnalyzer::onStreamRemoved(const StreamKey& key, StreamState& stream, FlowRemovalReason reason, void* userCookie)
+{
+	((RtpStreamAnalyzer*)userCookie)->endStream(stream);
+}
+
+void RtpStreamAnalyzer::setCurrentTime(time_t currentTime)
+{
+	if (currentTime < 0)
+		return;
+
+	m_Endpoints.advanceTime((uint64_t)currentTime);
+	m_Streams.advanceTime((uint64_t)currentTime);
+}
+
+void RtpStreamAnalyzer::getStreams(std::vector<RtpStreamStats>& streams) const
+{
+	std::vector<std::pair<StreamKey, StreamState> > entries;
+	m_Streams.getEntries(entries);
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (entries[i].second.stats.packets == 0)
+			continue;
+
+		RtpStreamStats stats;
+		finalizeStats(entries[i].second, stats);
+		streams.push_back(stats);
+	}
+}
+
+void RtpStreamAnalyzer::flush()
+{
+	std::vector<std::pair<StreamKey, StreamState> > entries;
+	m_Streams.getEntries(entries);
+	m_Streams.clear();
+	for (size_t i = 0; i < entries.size(); i++)
+		endStream(entries[i].second);
+}
+
+uint32_t RtpStreamAnalyzer::getShardHash(const PacketView& view)
+{
+	FlowTuple tuple;
+	memset(&tuple, 0, sizeof(tuple));
+	size_t addressLen = (view.ipVersion == 4 ? 4 : 16);
+	memcpy(tuple.srcIP, view.srcIP, addressLen);
+	memcpy(tuple.dstIP, view.dstIP, addressLen);
+	// RTCP ports are mapped to their RTP ports
+	tuple.srcPort = view.srcPort & 0xfffe;
+	tuple.dstPort = view.dstPort & 0xfffe;
+	tuple.protocol = PACKETPP_IPPROTO_UDP;
+	tuple.ipVersion = view.ipVersion;
+	return FlowHash::hashSymmetric(tuple);
+}
+
+} // namespace pcpp
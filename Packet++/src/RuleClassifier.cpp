@@ -0,0 +1,611 @@
+#define LOG_MODULE PacketLogModuleRuleClassifier
+
+#include "RuleClassifier.h"
+#include "AtomicUtils.h"
+#include "Logger.h"
+#include <algorithm>
+#include <map>
+#include <string.h>
+
+// a trie entry with this bit set points to a child node, otherwise it holds the index of the longest prefix covering it plus 1 (0 - none)
+#define TRIE_CHILD_FLAG 0x80000000
+#define TRIE_STRIDE 4
+#define TRIE_NODE_SIZE (1 << TRIE_STRIDE)
+#define SRC_TRIE_FIRST_STRIDE 16
+#define DST_TRIE_FIRST_STRIDE 8
+#define NO_INDEX 0xffffffff
+#define BITMAP_WORD_BITS 64
+
+namespace pcpp
+{
+
+static inline int getLowestSetBit(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(word);
+#else
+	int index = 0;
+	while ((word & 1) == 0)
+	{
+		word >>= 1;
+		index++;
+	}
+	return index;
+#endif
+}
+
+static inline uint32_t getPrefixMask(uint8_t prefixLen)
+{
+	return (prefixLen == 0 ? 0 : (0xffffffff << (32 - prefixLen)));
+}
+
+static inline uint32_t readAddress(const uint8_t* addr)
+{
+	return ((uint32_t)addr[0] << 24) | ((uint32_t)addr[1] << 16) | ((uint32_t)addr[2] << 8) | (uint32_t)addr[3];
+}
+
+static inline uint32_t addressToHostOrder(const IPv4Address& addr)
+{
+	uint32_t addrAsInt = addr.toInt();
+	return readAddress((const uint8_t*)&addrAsInt);
+}
+
+
+/**
+ * A multi-bit trie mapping an address to the longest prefix containing it. The first level is indexed by the first bits of the address and the
+ * next levels by 4 bits each. Prefixes which don't end on a level boundary are expanded to all the entries they cover (controlled prefix
+ * expansion), so a lookup is at most one memory access per level
+ */
+class ClassifierPrefixTrie
+{
+public:
+	ClassifierPrefixTrie() : m_FirstStride(0) {}
+
+	void init(int firstStride)
+	{
+		m_FirstStride = firstStride;
+		m_Entries.assign((size_t)1 << firstStride, 0);
+	}
+
+	// prefixes must be inserted by ascending length, so longer prefixes overwrite the entries of the shorter ones they're contained in
+	void insert(uint32_t prefix, uint8_t prefixLen, uint32_t value)
+	{
+		if (prefixLen <= m_FirstStride)
+		{
+			fill(prefix >> (32 - m_FirstStride), (uint32_t)1 << (m_FirstStride - prefixLen), value);
+			return;
+		}
+
+		uint32_t index = prefix >> (32 - m_FirstStride);
+		int levelEnd = m_FirstStride;
+		while (true)
+		{
+			if ((m_Entries[index] & TRIE_CHILD_FLAG) == 0)
+			{
+				// the entries of a new node inherit the prefix covering its parent entry
+				uint32_t child = (uint32_t)m_Entries.size();
+				m_Entries.resize(m_Entries.size() + TRIE_NODE_SIZE, m_Entries[index]);
+				m_Entries[index] = child | TRIE_CHILD_FLAG;
+			}
+
+			uint32_t node = m_Entries[index] & ~TRIE_CHILD_FLAG;
+			levelEnd += TRIE_STRIDE;
+			uint32_t nodeIndex = (prefix >> (32 - levelEnd)) & (TRIE_NODE_SIZE - 1);
+			if (prefixLen <= levelEnd)
+			{
+				fill(node + nodeIndex, (uint32_t)1 << (levelEnd - prefixLen), value);
+				return;
+			}
+
+			index = node + nodeIndex;
+		}
+	}
+
+	inline uint32_t lookup(uint32_t addr) const
+	{
+		uint32_t entry = m_Entries[addr >> (32 - m_FirstStride)];
+		int consumed = m_FirstStride;
+		while (entry & TRIE_CHILD_FLAG)
+		{
+			consumed += TRIE_STRIDE;
+			entry = m_Entries[(entry & ~TRIE_CHILD_FLAG) + ((addr >> (32 - consumed)) & (TRIE_NODE_SIZE - 1))];
+		}
+
+		return entry;
+	}
+
+private:
+	int m_FirstStride;
+	std::vector<uint32_t> m_Entries;
+
+	void fill(uint32_t first, uint32_t count, uint32_t value)
+	{
+		for (uint32_t i = 0; i < count; i++)
+			m_Entries[first + i] = value;
+	}
+};
+
+
+/**
+ * The elementary intervals of one field of the rules in a bitmap chunk, and for each interval a bitmap of the rules whose range contains it
+ */
+struct ClassifierIntervalField
+{
+	std::vector<uint32_t> starts;
+	std::vector<uint64_t> bitmaps;
+
+	void build(const std::vector<uint32_t>& from, const std::vector<uint32_t>& to, size_t numOfWords)
+	{
+		starts.clear();
+		starts.push_back(0);
+		for (size_t i = 0; i < from.size(); i++)
+		{
+			starts.push_back(from[i]);
+			starts.push_back(to[i] + 1);
+		}
+
+		std::sort(starts.begin(), starts.end());
+		starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+		bitmaps.assign(starts.size() * numOfWords, 0);
+		for (size_t rule = 0; rule < from.size(); rule++)
+		{
+			size_t first = std::lower_bound(starts.begin(), starts.end(), from[rule]) - starts.begin();
+			for (size_t interval = first; interval < starts.size() && starts[interval] <= to[rule]; interval++)
+				bitmaps[interval * numOfWords + rule / BITMAP_WORD_BITS] |= (uint64_t)1 << (rule % BITMAP_WORD_BITS);
+		}
+	}
+
+	inline const uint64_t* lookup(uint32_t value, size_t numOfWords) const
+	{
+		size_t interval = std::upper_bound(starts.begin(), starts.end(), value) - starts.begin() - 1;
+		return &bitmaps[interval * numOfWords];
+	}
+};
+
+
+struct RuleClassifier::RuleSet
+{
+	// a rule as it's matched: ranks are positions in the rules vector, which is sorted by priority
+	struct Rule
+	{
+		uint32_t id;
+		uint32_t dstAddress;
+		uint32_t dstMask;
+		uint16_t srcPortFrom;
+		uint16_t srcPortTo;
+		uint16_t dstPortFrom;
+		uint16_t dstPortTo;
+		uint8_t dstPrefixLen;
+		uint8_t protocol;
+		bool anyPort;
+	};
+
+	// up to PCPP_RULE_CLASSIFIER_BITMAP_CHUNK_SIZE consecutive rules of a group, bit i stands for the i-th rule of the chunk
+	struct BitmapChunk
+	{
+		size_t numOfWords;
+		ClassifierIntervalField srcPorts;
+		ClassifierIntervalField dstPorts;
+		ClassifierIntervalField protocols;
+		std::vector<uint64_t> anyPortBitmap;
+	};
+
+	// rules sharing the same prefixes, by ascending rank. Groups with chunks are matched with bitmaps, the rest one rule after the other
+	struct Group
+	{
+		uint32_t firstRank;
+		uint32_t numOfRules;
+		uint32_t firstChunk;
+		uint32_t numOfChunks;
+	};
+
+	struct PrefixNode
+	{
+		// the next shorter prefix containing this one, or NO_INDEX
+		uint32_t parent;
+		// the best rank of the rules using the prefix, used to skip prefixes which can't improve the current match
+		uint32_t minRank;
+		// the group of the rules using the prefix, or NO_INDEX. Unused for source prefixes with a destination trie
+		uint32_t group;
+		// source prefixes with many rules: the index of their destination trie, or NO_INDEX
+		uint32_t dstTrie;
+	};
+
+	struct DstTrie
+	{
+		ClassifierPrefixTrie trie;
+		uint32_t firstNode;
+	};
+
+	std::vector<Rule> rules;
+	std::vector<uint32_t> groupRanks;
+	std::vector<Group> groups;
+	std::vector<BitmapChunk> chunks;
+	ClassifierPrefixTrie srcTrie;
+	std::vector<PrefixNode> srcNodes;
+	std::vector<DstTrie> dstTries;
+	std::vector<PrefixNode> dstNodes;
+
+	bool build(const std::vector<ClassifierRule>& classifierRules);
+	uint32_t classify(const PacketView& view) const;
+
+private:
+	typedef std::map<uint64_t, std::vector<uint32_t> > PrefixMap;
+
+	static inline uint64_t getPrefixKey(uint32_t prefix, uint8_t prefixLen) { return ((uint64_t)prefixLen << 32) | prefix; }
+
+	uint32_t addGroup(const std::vector<uint32_t>& ranks, bool useBitmaps);
+	void addBitmapChunk(const uint32_t* ranks, size_t numOfRules);
+	uint32_t addPrefixNodes(const PrefixMap& prefixes, ClassifierPrefixTrie& trie, std::vector<PrefixNode>& nodes, bool isDstTrie);
+	inline uint32_t matchGroup(uint32_t groupIndex, bool isIPv4, uint32_t dstAddr, bool hasPorts, uint16_t srcPort, uint16_t dstPort, uint8_t protocol,
+			uint32_t bestRank) const;
+};
+
+struct HigherPriority
+{
+	const std::vector<ClassifierRule>& rules;
+
+	HigherPriority(const std::vector<ClassifierRule>& classifierRules) : rules(classifierRules) {}
+
+	bool operator()(uint32_t first, uint32_t second) const { return rules[first].priority > rules[second].priority; }
+};
+
+bool RuleClassifier::RuleSet::build(const std::vector<ClassifierRule>& classifierRules)
+{
+	for (size_t i = 0; i < classifierRules.size(); i++)
+	{
+		const ClassifierRule& rule = classifierRules[i];
+		if (rule.srcPrefixLen > 32 || rule.dstPrefixLen > 32)
+		{
+			LOG_ERROR("Rule #%d: prefix length is larger than 32", (int)i);
+			return false;
+		}
+
+		if (rule.srcPortFrom > rule.srcPortTo || rule.dstPortFrom > rule.dstPortTo)
+		{
+			LOG_ERROR("Rule #%d: port range lower end is higher than its upper end", (int)i);
+			return false;
+		}
+	}
+
+	// ranks are assigned by descending priority, rules with the same priority keep their order
+	std::vector<uint32_t> order(classifierRules.size());
+	for (size_t i = 0; i < classifierRules.size(); i++)
+		order[i] = (uint32_t)i;
+	std::stable_sort(order.begin(), order.end(), HigherPriority(classifierRules));
+
+	rules.resize(classifierRules.size());
+	PrefixMap srcPrefixes;
+	srcPrefixes[getPrefixKey(0, 0)];
+	for (size_t rank = 0; rank < order.size(); rank++)
+	{
+		const ClassifierRule& rule = classifierRules[order[rank]];
+		Rule& compiledRule = rules[rank];
+		compiledRule.id = rule.id;
+		compiledRule.dstPrefixLen = rule.dstPrefixLen;
+		compiledRule.dstMask = getPrefixMask(rule.dstPrefixLen);
+		compiledRule.dstAddress = addressToHostOrder(rule.dstAddress) & compiledRule.dstMask;
+		compiledRule.srcPortFrom = rule.srcPortFrom;
+		compiledRule.srcPortTo = rule.srcPortTo;
+		compiledRule.dstPortFrom = rule.dstPortFrom;
+		compiledRule.dstPortTo = rule.dstPortTo;
+		compiledRule.protocol = rule.protocol;
+		compiledRule.anyPort = (rule.srcPortFrom == 0 && rule.srcPortTo == 0xffff && rule.dstPortFrom == 0 && rule.dstPortTo == 0xffff);
+
+		uint32_t srcPrefix = addressToHostOrder(rule.srcAddress) & getPrefixMask(rule.srcPrefixLen);
+		srcPrefixes[getPrefixKey(srcPrefix, rule.srcPrefixLen)].push_back((uint32_t)rank);
+	}
+
+	srcTrie.init(SRC_TRIE_FIRST_STRIDE);
+	addPrefixNodes(srcPrefixes, srcTrie, srcNodes, false);
+
+	return true;
+}
+
+uint32_t RuleClassifier::RuleSet::addPrefixNodes(const PrefixMap& prefixes, ClassifierPrefixTrie& trie, std::vector<PrefixNode>& nodes, bool isDstTrie)
+{
+	uint32_t firstNode = (uint32_t)nodes.size();
+
+	// the map is ordered by prefix length, as the trie requires
+	for (PrefixMap::const_iterator iter = prefixes.begin(); iter != prefixes.end(); ++iter)
+	{
+		uint32_t prefix = (uint32_t)(iter->first & 0xffffffff);
+		uint8_t prefixLen = (uint8_t)(iter->first >> 32);
+		const std::vector<uint32_t>& ranks = iter->second;
+
+		PrefixNode node;
+		uint32_t parent = trie.lookup(prefix);
+		node.parent = (parent == 0 ? NO_INDEX : firstNode + parent - 1);
+		node.minRank = (ranks.empty() ? NO_INDEX : ranks[0]);
+		node.group = NO_INDEX;
+		node.dstTrie = NO_INDEX;
+
+		if (isDstTrie || ranks.size() <= PCPP_RULE_CLASSIFIER_LINEAR_THRESHOLD)
+		{
+			if (!ranks.empty())
+				node.group = addGroup(ranks, isDstTrie && ranks.size() > PCPP_RULE_CLASSIFIER_LINEAR_THRESHOLD);
+		}
+		else
+		{
+			// split the rules of a source prefix by destination prefix
+			PrefixMap dstPrefixes;
+			dstPrefixes[getPrefixKey(0, 0)];
+			for (size_t i = 0; i < ranks.size(); i++)
+			{
+				const Rule& rule = rules[ranks[i]];
+				dstPrefixes[getPrefixKey(rule.dstAddress, rule.dstPrefixLen)].push_back(ranks[i]);
+			}
+
+			DstTrie dstTrie;
+			dstTrie.trie.init(DST_TRIE_FIRST_STRIDE);
+			dstTrie.firstNode = addPrefixNodes(dstPrefixes, dstTrie.trie, dstNodes, true);
+			node.dstTrie = (uint32_t)dstTries.size();
+			dstTries.push_back(dstTrie);
+		}
+
+		trie.insert(prefix, prefixLen, (uint32_t)(nodes.size() - firstNode) + 1);
+		nodes.push_back(node);
+	}
+
+	return firstNode;
+}
+
+uint32_t RuleClassifier::RuleSet::addGroup(const std::vector<uint32_t>& ranks, bool useBitmaps)
+{
+	Group group;
+	group.firstRank = (uint32_t)groupRanks.size();
+	group.numOfRules = (uint32_t)ranks.size();
+	group.firstChunk = (uint32_t)chunks.size();
+	group.numOfChunks = 0;
+	groupRanks.insert(groupRanks.end(), ranks.begin(), ranks.end());
+
+	if (useBitmaps)
+	{
+		for (size_t first = 0; first < ranks.size(); first += PCPP_RULE_CLASSIFIER_BITMAP_CHUNK_SIZE)
+		{
+			addBitmapChunk(&ranks[first], std::min((size_t)PCPP_RULE_CLASSIFIER_BITMAP_CHUNK_SIZE, ranks.size() - first));
+			group.numOfChunks++;
+		}
+	}
+
+	groups.push_back(group);
+	return (uint32_t)groups.size() - 1;
+}
+
+void RuleClassifier::RuleSet::addBitmapChunk(const uint32_t* ranks, size_t numOfRules)
+{
+	chunks.push_back(BitmapChunk());
+	BitmapChunk& chunk = chunks.back();
+	chunk.numOfWords = (numOfRules + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+	chunk.anyPortBitmap.assign(chunk.numOfWords, 0);
+
+	std::vector<uint32_t> srcFrom, srcTo, dstFrom, dstTo, protocolFrom, protocolTo;
+	for (size_t i = 0; i < numOfRules; i++)
+	{
+		const Rule& rule = rules[ranks[i]];
+		srcFrom.push_back(rule.srcPortFrom);
+		srcTo.push_back(rule.srcPortTo);
+		dstFrom.push_back(rule.dstPortFrom);
+		dstTo.push_back(rule.dstPortTo);
+		protocolFrom.push_back(rule.protocol);
+		protocolTo.push_back(rule.protocol == 0 ? 0xff : rule.protocol);
+		if (rule.anyPort)
+			chunk.anyPortBitmap[i / BITMAP_WORD_BITS] |= (uint64_t)1 << (i % BITMAP_WORD_BITS);
+	}
+
+	chunk.srcPorts.build(srcFrom, srcTo, chunk.numOfWords);
+	chunk.dstPorts.build(dstFrom, dstTo, chunk.numOfWords);
+	chunk.protocols.build(protocolFrom, protocolTo, chunk.numOfWords);
+}
+
+inline uint32_t RuleClassifier::RuleSet::matchGroup(uint32_t groupIndex, bool isIPv4, uint32_t dstAddr, bool hasPorts, uint16_t srcPort, uint16_t dstPort,
+		uint8_t protocol, uint32_t bestRank) const
+{
+	const Group& group = groups[groupIndex];
+	const uint32_t* ranks = &groupRanks[group.firstRank];
+
+	if (group.numOfChunks == 0)
+	{
+		for (uint32_t i = 0; i < group.numOfRules && ranks[i] < bestRank; i++)
+		{
+			const Rule& rule = rules[ranks[i]];
+			if (rule.dstMask != 0 && (!isIPv4 || (dstAddr & rule.dstMask) != rule.dstAddress))
+				continue;
+			if (rule.protocol != 0 && rule.protocol != protocol)
+				continue;
+			if (!rule.anyPort && (!hasPorts || srcPort < rule.srcPortFrom || srcPort > rule.srcPortTo || dstPort < rule.dstPortFrom || dstPort > rule.dstPortTo))
+				continue;
+
+			return ranks[i];
+		}
+
+		return NO_INDEX;
+	}
+
+	// bitmap groups belong to destination prefixes, so the destination address is known to match
+	for (uint32_t chunkIndex = 0; chunkIndex < group.numOfChunks; chunkIndex++)
+	{
+		const uint32_t* chunkRanks = ranks + chunkIndex * PCPP_RULE_CLASSIFIER_BITMAP_CHUNK_SIZE;
+		if (chunkRanks[0] >= bestRank)
+			break;
+
+		const BitmapChunk& chunk = chunks[group.firstChunk + chunkIndex];
+		const uint64_t* protocolBitmap = chunk.protocols.lookup(protocol, chunk.numOfWords);
+		const uint64_t* srcPortBitmap = (hasPorts ? chunk.srcPorts.lookup(srcPort, chunk.numOfWords) : NULL);
+		const uint64_t* dstPortBitmap = (hasPorts ? chunk.dstPorts.lookup(dstPort, chunk.numOfWords) : NULL);
+
+		for (size_t word = 0; word < chunk.numOfWords; word++)
+		{
+			uint64_t matches = protocolBitmap[word];
+			if (hasPorts)
+				matches &= srcPortBitmap[word] & dstPortBitmap[word];
+			else
+				matches &= chunk.anyPortBitmap[word];
+
+			if (matches != 0)
+			{
+				uint32_t rank = chunkRanks[word * BITMAP_WORD_BITS + getLowestSetBit(matches)];
+				return (rank < bestRank ? rank : NO_INDEX);
+			}
+		}
+	}
+
+	return NO_INDEX;
+}
+
+uint32_t RuleClassifier::RuleSet::classify(const PacketView& view) const
+{
+	if (view.ipVersion != 4 && view.ipVersion != 6)
+		return NoMatch;
+
+	bool isIPv4 = (view.ipVersion == 4);
+	uint32_t srcAddr = (isIPv4 ? readAddress(view.srcIP) : 0);
+	uint32_t dstAddr = (isIPv4 ? readAddress(view.dstIP) : 0);
+	bool hasPorts = (view.transportOffset != PacketView::NoOffset);
+	uint16_t srcPort = (hasPorts ? view.srcPort : 0);
+	uint16_t dstPort = (hasPorts ? view.dstPort : 0);
+
+	uint32_t bestRank = NO_INDEX;
+
+	// IPv6 packets can only match the rules of the /0 prefixes, which are always the first nodes of their tries
+	uint32_t srcNodeIndex = (isIPv4 ? srcTrie.lookup(srcAddr) - 1 : 0);
+	while (srcNodeIndex != NO_INDEX)
+	{
+		const PrefixNode& srcNode = srcNodes[srcNodeIndex];
+		srcNodeIndex = srcNode.parent;
+		if (srcNode.minRank >= bestRank)
+			continue;
+
+		if (srcNode.dstTrie == NO_INDEX)
+		{
+			uint32_t rank = matchGroup(srcNode.group, isIPv4, dstAddr, hasPorts, srcPort, dstPort, view.ipProtocol, bestRank);
+			if (rank != NO_INDEX)
+				bestRank = rank;
+			continue;
+		}
+
+		const DstTrie& dstTrie = dstTries[srcNode.dstTrie];
+		uint32_t dstNodeIndex = dstTrie.firstNode + (isIPv4 ? dstTrie.trie.lookup(dstAddr) - 1 : 0);
+		while (dstNodeIndex != NO_INDEX)
+		{
+			const PrefixNode& dstNode = dstNodes[dstNodeIndex];
+			dstNodeIndex = dstNode.parent;
+			if (dstNode.minRank >= bestRank)
+				continue;
+
+			uint32_t rank = matchGroup(dstNode.group, isIPv4, dstAddr, hasPorts, srcPort, dstPort, view.ipProtocol, bestRank);
+			if (rank != NO_INDEX)
+				bestRank = rank;
+		}
+	}
+
+	return (bestRank == NO_INDEX ? NoMatch : rules[bestRank].id);
+}
+
+
+ClassifierRule::ClassifierRule() :
+	id(0), priority(0), srcAddress(IPv4Address::Zero), srcPrefixLen(0), dstAddress(IPv4Address::Zero), dstPrefixLen(0),
+	srcPortFrom(0), srcPortTo(0xffff), dstPortFrom(0), dstPortTo(0xffff), protocol(0)
+{
+}
+
+
+RuleClassifier::RuleClassifier()
+{
+	std::vector<ClassifierRule> noRules;
+	m_RuleSet = new RuleSet();
+	m_RuleSet->build(noRules);
+	pthread_mutex_init(&m_Mutex, NULL);
+}
+
+RuleClassifier::~RuleClassifier()
+{
+	delete m_RuleSet;
+	m_Reclaimer.reclaimAll(QuiescentStateDeleter());
+
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+bool RuleClassifier::setRules(const std::vector<ClassifierRule>& rules)
+{
+	// the new rule set is built without holding the lock, only publishing it is serialized
+	RuleSet* newRuleSet = new RuleSet();
+	if (!newRuleSet->build(rules))
+	{
+		delete newRuleSet;
+		return false;
+	}
+
+	pthread_mutex_lock(&m_Mutex);
+
+	m_Reclaimer.retire((RuleSet*)m_RuleSet);
+	atomicStorePointerRelease(&m_RuleSet, newRuleSet);
+	// readers which see the new epoch in quiescentState() see the new rule set from then on
+	m_Reclaimer.advanceEpoch();
+	m_Reclaimer.reclaim(QuiescentStateDeleter());
+
+	pthread_mutex_unlock(&m_Mutex);
+
+	LOG_DEBUG("Rule set of %d rules published", (int)rules.size());
+	return true;
+}
+
+void RuleClassifier::clearRules()
+{
+	std::vector<ClassifierRule> noRules;
+	setRules(noRules);
+}
+
+size_t RuleClassifier::getNumOfRules() const
+{
+	return atomicLoadPointerAcquire(&m_RuleSet)->rules.size();
+}
+
+uint32_t RuleClassifier::classify(const PacketView& view) const
+{
+	return atomicLoadPointerAcquire(&m_RuleSet)->classify(view);
+}
+
+void RuleClassifier::classifyBatch(const PacketView* views, size_t count, uint32_t* ruleIds) const
+{
+	// all packets of the batch are classified with the same rule set
+	const RuleSet* ruleSet = atomicLoadPointerAcquire(&m_RuleSet);
+	for (size_t i = 0; i < count; i++)
+		ruleIds[i] = ruleSet->classify(views[i]);
+}
+
+int RuleClassifier::registerReader()
+{
+	pthread_mutex_lock(&m_Mutex);
+	int readerId = m_Reclaimer.registerReader();
+	pthread_mutex_unlock(&m_Mutex);
+
+	if (readerId < 0)
+		LOG_ERROR("Cannot register reader: %d readers are already registered", PCPP_QUIESCENT_STATE_MAX_READERS);
+
+	return readerId;
+}
+
+void RuleClassifier::unregisterReader(int readerId)
+{
+	pthread_mutex_lock(&m_Mutex);
+	m_Reclaimer.unregisterReader(readerId);
+	m_Reclaimer.reclaim(QuiescentStateDeleter());
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+void RuleClassifier::quiescentState(int readerId)
+{
+	m_Reclaimer.quiescentState(readerId);
+}
+
+size_t RuleClassifier::reclaim()
+{
+	pthread_mutex_lock(&m_Mutex);
+	size_t numOfRemaining = m_Reclaimer.reclaim(QuiescentStateDeleter());
+	pthread_mutex_unlock(&m_Mutex);
+	return numOfRemaining;
+}
+
+} // namespace pcpp
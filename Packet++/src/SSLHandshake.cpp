@@ -9,7 +9,6 @@
 #endif
 #include <string.h>
 #include <sstream>
-#include <map>
 #include "Logger.h"
 #include "SSLHandshake.h"
 
@@ -347,690 +346,162 @@ static const SSLCipherSuite Cipher323 = SSLCipherSuite(0xCCAD, SSL_KEYX_DHE, SSL
 static const SSLCipherSuite Cipher324 = SSLCipherSuite(0xCCAE, SSL_KEYX_RSA, SSL_AUTH_PSK, SSL_SYM_CHACHA20_POLY1305, SSL_HASH_SHA256, "TLS_RSA_PSK_WITH_CHACHA20_POLY1305_SHA256");
 
 
-static std::map<uint16_t, SSLCipherSuite*> createCipherSuiteIdToObjectMap()
-{
-	std::map<uint16_t, SSLCipherSuite*> result;
-
-	result[0x0000] = (SSLCipherSuite*)&Cipher1;
-	result[0x0001] = (SSLCipherSuite*)&Cipher2;
-	result[0x0002] = (SSLCipherSuite*)&Cipher3;
-	result[0x0003] = (SSLCipherSuite*)&Cipher4;
-	result[0x0004] = (SSLCipherSuite*)&Cipher5;
-	result[0x0005] = (SSLCipherSuite*)&Cipher6;
-	result[0x0006] = (SSLCipherSuite*)&Cipher7;
-	result[0x0007] = (SSLCipherSuite*)&Cipher8;
-	result[0x0008] = (SSLCipherSuite*)&Cipher9;
-	result[0x0009] = (SSLCipherSuite*)&Cipher10;
-	result[0x000A] = (SSLCipherSuite*)&Cipher11;
-	result[0x000B] = (SSLCipherSuite*)&Cipher12;
-	result[0x000C] = (SSLCipherSuite*)&Cipher13;
-	result[0x000D] = (SSLCipherSuite*)&Cipher14;
-	result[0x000E] = (SSLCipherSuite*)&Cipher15;
-	result[0x000F] = (SSLCipherSuite*)&Cipher16;
-	result[0x0010] = (SSLCipherSuite*)&Cipher17;
-	result[0x0011] = (SSLCipherSuite*)&Cipher18;
-	result[0x0012] = (SSLCipherSuite*)&Cipher19;
-	result[0x0013] = (SSLCipherSuite*)&Cipher20;
-	result[0x0014] = (SSLCipherSuite*)&Cipher21;
-	result[0x0015] = (SSLCipherSuite*)&Cipher22;
-	result[0x0016] = (SSLCipherSuite*)&Cipher23;
-	result[0x0017] = (SSLCipherSuite*)&Cipher24;
-	result[0x0018] = (SSLCipherSuite*)&Cipher25;
-	result[0x0019] = (SSLCipherSuite*)&Cipher26;
-	result[0x001A] = (SSLCipherSuite*)&Cipher27;
-	result[0x001B] = (SSLCipherSuite*)&Cipher28;
-	result[0x001E] = (SSLCipherSuite*)&Cipher29;
-	result[0x001F] = (SSLCipherSuite*)&Cipher30;
-	result[0x0020] = (SSLCipherSuite*)&Cipher31;
-	result[0x0021] = (SSLCipherSuite*)&Cipher32;
-	result[0x0022] = (SSLCipherSuite*)&Cipher33;
-	result[0x0023] = (SSLCipherSuite*)&Cipher34;
-	result[0x0024] = (SSLCipherSuite*)&Cipher35;
-	result[0x0025] = (SSLCipherSuite*)&Cipher36;
-	result[0x0026] = (SSLCipherSuite*)&Cipher37;
-	result[0x0027] = (SSLCipherSuite*)&Cipher38;
-	result[0x0028] = (SSLCipherSuite*)&Cipher39;
-	result[0x0029] = (SSLCipherSuite*)&Cipher40;
-	result[0x002A] = (SSLCipherSuite*)&Cipher41;
-	result[0x002B] = (SSLCipherSuite*)&Cipher42;
-	result[0x002C] = (SSLCipherSuite*)&Cipher43;
-	result[0x002D] = (SSLCipherSuite*)&Cipher44;
-	result[0x002E] = (SSLCipherSuite*)&Cipher45;
-	result[0x002F] = (SSLCipherSuite*)&Cipher46;
-	result[0x0030] = (SSLCipherSuite*)&Cipher47;
-	result[0x0031] = (SSLCipherSuite*)&Cipher48;
-	result[0x0032] = (SSLCipherSuite*)&Cipher49;
-	result[0x0033] = (SSLCipherSuite*)&Cipher50;
-	result[0x0034] = (SSLCipherSuite*)&Cipher51;
-	result[0x0035] = (SSLCipherSuite*)&Cipher52;
-	result[0x0036] = (SSLCipherSuite*)&Cipher53;
-	result[0x0037] = (SSLCipherSuite*)&Cipher54;
-	result[0x0038] = (SSLCipherSuite*)&Cipher55;
-	result[0x0039] = (SSLCipherSuite*)&Cipher56;
-	result[0x003A] = (SSLCipherSuite*)&Cipher57;
-	result[0x003B] = (SSLCipherSuite*)&Cipher58;
-	result[0x003C] = (SSLCipherSuite*)&Cipher59;
-	result[0x003D] = (SSLCipherSuite*)&Cipher60;
-	result[0x003E] = (SSLCipherSuite*)&Cipher61;
-	result[0x003F] = (SSLCipherSuite*)&Cipher62;
-	result[0x0040] = (SSLCipherSuite*)&Cipher63;
-	result[0x0041] = (SSLCipherSuite*)&Cipher64;
-	result[0x0042] = (SSLCipherSuite*)&Cipher65;
-	result[0x0043] = (SSLCipherSuite*)&Cipher66;
-	result[0x0044] = (SSLCipherSuite*)&Cipher67;
-	result[0x0045] = (SSLCipherSuite*)&Cipher68;
-	result[0x0046] = (SSLCipherSuite*)&Cipher69;
-	result[0x0067] = (SSLCipherSuite*)&Cipher70;
-	result[0x0068] = (SSLCipherSuite*)&Cipher71;
-	result[0x0069] = (SSLCipherSuite*)&Cipher72;
-	result[0x006A] = (SSLCipherSuite*)&Cipher73;
-	result[0x006B] = (SSLCipherSuite*)&Cipher74;
-	result[0x006C] = (SSLCipherSuite*)&Cipher75;
-	result[0x006D] = (SSLCipherSuite*)&Cipher76;
-	result[0x0084] = (SSLCipherSuite*)&Cipher77;
-	result[0x0085] = (SSLCipherSuite*)&Cipher78;
-	result[0x0086] = (SSLCipherSuite*)&Cipher79;
-	result[0x0087] = (SSLCipherSuite*)&Cipher80;
-	result[0x0088] = (SSLCipherSuite*)&Cipher81;
-	result[0x0089] = (SSLCipherSuite*)&Cipher82;
-	result[0x008A] = (SSLCipherSuite*)&Cipher83;
-	result[0x008B] = (SSLCipherSuite*)&Cipher84;
-	result[0x008C] = (SSLCipherSuite*)&Cipher85;
-	result[0x008D] = (SSLCipherSuite*)&Cipher86;
-	result[0x008E] = (SSLCipherSuite*)&Cipher87;
-	result[0x008F] = (SSLCipherSuite*)&Cipher88;
-	result[0x0090] = (SSLCipherSuite*)&Cipher89;
-	result[0x0091] = (SSLCipherSuite*)&Cipher90;
-	result[0x0092] = (SSLCipherSuite*)&Cipher91;
-	result[0x0093] = (SSLCipherSuite*)&Cipher92;
-	result[0x0094] = (SSLCipherSuite*)&Cipher93;
-	result[0x0095] = (SSLCipherSuite*)&Cipher94;
-	result[0x0096] = (SSLCipherSuite*)&Cipher95;
-	result[0x0097] = (SSLCipherSuite*)&Cipher96;
-	result[0x0098] = (SSLCipherSuite*)&Cipher97;
-	result[0x0099] = (SSLCipherSuite*)&Cipher98;
-	result[0x009A] = (SSLCipherSuite*)&Cipher99;
-	result[0x009B] = (SSLCipherSuite*)&Cipher100;
-	result[0x009C] = (SSLCipherSuite*)&Cipher101;
-	result[0x009D] = (SSLCipherSuite*)&Cipher102;
-	result[0x009E] = (SSLCipherSuite*)&Cipher103;
-	result[0x009F] = (SSLCipherSuite*)&Cipher104;
-	result[0x00A0] = (SSLCipherSuite*)&Cipher105;
-	result[0x00A1] = (SSLCipherSuite*)&Cipher106;
-	result[0x00A2] = (SSLCipherSuite*)&Cipher107;
-	result[0x00A3] = (SSLCipherSuite*)&Cipher108;
-	result[0x00A4] = (SSLCipherSuite*)&Cipher109;
-	result[0x00A5] = (SSLCipherSuite*)&Cipher110;
-	result[0x00A6] = (SSLCipherSuite*)&Cipher111;
-	result[0x00A7] = (SSLCipherSuite*)&Cipher112;
-	result[0x00A8] = (SSLCipherSuite*)&Cipher113;
-	result[0x00A9] = (SSLCipherSuite*)&Cipher114;
-	result[0x00AA] = (SSLCipherSuite*)&Cipher115;
-	result[0x00AB] = (SSLCipherSuite*)&Cipher116;
-	result[0x00AC] = (SSLCipherSuite*)&Cipher117;
-	result[0x00AD] = (SSLCipherSuite*)&Cipher118;
-	result[0x00AE] = (SSLCipherSuite*)&Cipher119;
-	result[0x00AF] = (SSLCipherSuite*)&Cipher120;
-	result[0x00B0] = (SSLCipherSuite*)&Cipher121;
-	result[0x00B1] = (SSLCipherSuite*)&Cipher122;
-	result[0x00B2] = (SSLCipherSuite*)&Cipher123;
-	result[0x00B3] = (SSLCipherSuite*)&Cipher124;
-	result[0x00B4] = (SSLCipherSuite*)&Cipher125;
-	result[0x00B5] = (SSLCipherSuite*)&Cipher126;
-	result[0x00B6] = (SSLCipherSuite*)&Cipher127;
-	result[0x00B7] = (SSLCipherSuite*)&Cipher128;
-	result[0x00B8] = (SSLCipherSuite*)&Cipher129;
-	result[0x00B9] = (SSLCipherSuite*)&Cipher130;
-	result[0x00BA] = (SSLCipherSuite*)&Cipher131;
-	result[0x00BB] = (SSLCipherSuite*)&Cipher132;
-	result[0x00BC] = (SSLCipherSuite*)&Cipher133;
-	result[0x00BD] = (SSLCipherSuite*)&Cipher134;
-	result[0x00BE] = (SSLCipherSuite*)&Cipher135;
-	result[0x00BF] = (SSLCipherSuite*)&Cipher136;
-	result[0x00C0] = (SSLCipherSuite*)&Cipher137;
-	result[0x00C1] = (SSLCipherSuite*)&Cipher138;
-	result[0x00C2] = (SSLCipherSuite*)&Cipher139;
-	result[0x00C3] = (SSLCipherSuite*)&Cipher140;
-	result[0x00C4] = (SSLCipherSuite*)&Cipher141;
-	result[0x00C5] = (SSLCipherSuite*)&Cipher142;
-	result[0xC001] = (SSLCipherSuite*)&Cipher143;
-	result[0xC002] = (SSLCipherSuite*)&Cipher144;
-	result[0xC003] = (SSLCipherSuite*)&Cipher145;
-	result[0xC004] = (SSLCipherSuite*)&Cipher146;
-	result[0xC005] = (SSLCipherSuite*)&Cipher147;
-	result[0xC006] = (SSLCipherSuite*)&Cipher148;
-	result[0xC007] = (SSLCipherSuite*)&Cipher149;
-	result[0xC008] = (SSLCipherSuite*)&Cipher150;
-	result[0xC009] = (SSLCipherSuite*)&Cipher151;
-	result[0xC00A] = (SSLCipherSuite*)&Cipher152;
-	result[0xC00B] = (SSLCipherSuite*)&Cipher153;
-	result[0xC00C] = (SSLCipherSuite*)&Cipher154;
-	result[0xC00D] = (SSLCipherSuite*)&Cipher155;
-	result[0xC00E] = (SSLCipherSuite*)&Cipher156;
-	result[0xC00F] = (SSLCipherSuite*)&Cipher157;
-	result[0xC010] = (SSLCipherSuite*)&Cipher158;
-	result[0xC011] = (SSLCipherSuite*)&Cipher159;
-	result[0xC012] = (SSLCipherSuite*)&Cipher160;
-	result[0xC013] = (SSLCipherSuite*)&Cipher161;
-	result[0xC014] = (SSLCipherSuite*)&Cipher162;
-	result[0xC015] = (SSLCipherSuite*)&Cipher163;
-	result[0xC016] = (SSLCipherSuite*)&Cipher164;
-	result[0xC017] = (SSLCipherSuite*)&Cipher165;
-	result[0xC018] = (SSLCipherSuite*)&Cipher166;
-	result[0xC019] = (SSLCipherSuite*)&Cipher167;
-	result[0xC01A] = (SSLCipherSuite*)&Cipher168;
-	result[0xC01B] = (SSLCipherSuite*)&Cipher169;
-	result[0xC01C] = (SSLCipherSuite*)&Cipher170;
-	result[0xC01D] = (SSLCipherSuite*)&Cipher171;
-	result[0xC01E] = (SSLCipherSuite*)&Cipher172;
-	result[0xC01F] = (SSLCipherSuite*)&Cipher173;
-	result[0xC020] = (SSLCipherSuite*)&Cipher174;
-	result[0xC021] = (SSLCipherSuite*)&Cipher175;
-	result[0xC022] = (SSLCipherSuite*)&Cipher176;
-	result[0xC023] = (SSLCipherSuite*)&Cipher177;
-	result[0xC024] = (SSLCipherSuite*)&Cipher178;
-	result[0xC025] = (SSLCipherSuite*)&Cipher179;
-	result[0xC026] = (SSLCipherSuite*)&Cipher180;
-	result[0xC027] = (SSLCipherSuite*)&Cipher181;
-	result[0xC028] = (SSLCipherSuite*)&Cipher182;
-	result[0xC029] = (SSLCipherSuite*)&Cipher183;
-	result[0xC02A] = (SSLCipherSuite*)&Cipher184;
-	result[0xC02B] = (SSLCipherSuite*)&Cipher185;
-	result[0xC02C] = (SSLCipherSuite*)&Cipher186;
-	result[0xC02D] = (SSLCipherSuite*)&Cipher187;
-	result[0xC02E] = (SSLCipherSuite*)&Cipher188;
-	result[0xC02F] = (SSLCipherSuite*)&Cipher189;
-	result[0xC030] = (SSLCipherSuite*)&Cipher190;
-	result[0xC031] = (SSLCipherSuite*)&Cipher191;
-	result[0xC032] = (SSLCipherSuite*)&Cipher192;
-	result[0xC033] = (SSLCipherSuite*)&Cipher193;
-	result[0xC034] = (SSLCipherSuite*)&Cipher194;
-	result[0xC035] = (SSLCipherSuite*)&Cipher195;
-	result[0xC036] = (SSLCipherSuite*)&Cipher196;
-	result[0xC037] = (SSLCipherSuite*)&Cipher197;
-	result[0xC038] = (SSLCipherSuite*)&Cipher198;
-	result[0xC039] = (SSLCipherSuite*)&Cipher199;
-	result[0xC03A] = (SSLCipherSuite*)&Cipher200;
-	result[0xC03B] = (SSLCipherSuite*)&Cipher201;
-	result[0xC03C] = (SSLCipherSuite*)&Cipher202;
-	result[0xC03D] = (SSLCipherSuite*)&Cipher203;
-	result[0xC03E] = (SSLCipherSuite*)&Cipher204;
-	result[0xC03F] = (SSLCipherSuite*)&Cipher205;
-	result[0xC040] = (SSLCipherSuite*)&Cipher206;
-	result[0xC041] = (SSLCipherSuite*)&Cipher207;
-	result[0xC042] = (SSLCipherSuite*)&Cipher208;
-	result[0xC043] = (SSLCipherSuite*)&Cipher209;
-	result[0xC044] = (SSLCipherSuite*)&Cipher210;
-	result[0xC045] = (SSLCipherSuite*)&Cipher211;
-	result[0xC046] = (SSLCipherSuite*)&Cipher212;
-	result[0xC047] = (SSLCipherSuite*)&Cipher213;
-	result[0xC048] = (SSLCipherSuite*)&Cipher214;
-	result[0xC049] = (SSLCipherSuite*)&Cipher215;
-	result[0xC04A] = (SSLCipherSuite*)&Cipher216;
-	result[0xC04B] = (SSLCipherSuite*)&Cipher217;
-	result[0xC04C] = (SSLCipherSuite*)&Cipher218;
-	result[0xC04D] = (SSLCipherSuite*)&Cipher219;
-	result[0xC04E] = (SSLCipherSuite*)&Cipher220;
-	result[0xC04F] = (SSLCipherSuite*)&Cipher221;
-	result[0xC050] = (SSLCipherSuite*)&Cipher222;
-	result[0xC051] = (SSLCipherSuite*)&Cipher223;
-	result[0xC052] = (SSLCipherSuite*)&Cipher224;
-	result[0xC053] = (SSLCipherSuite*)&Cipher225;
-	result[0xC054] = (SSLCipherSuite*)&Cipher226;
-	result[0xC055] = (SSLCipherSuite*)&Cipher227;
-	result[0xC056] = (SSLCipherSuite*)&Cipher228;
-	result[0xC057] = (SSLCipherSuite*)&Cipher229;
-	result[0xC058] = (SSLCipherSuite*)&Cipher230;
-	result[0xC059] = (SSLCipherSuite*)&Cipher231;
-	result[0xC05A] = (SSLCipherSuite*)&Cipher232;
-	result[0xC05B] = (SSLCipherSuite*)&Cipher233;
-	result[0xC05C] = (SSLCipherSuite*)&Cipher234;
-	result[0xC05D] = (SSLCipherSuite*)&Cipher235;
-	result[0xC05E] = (SSLCipherSuite*)&Cipher236;
-	result[0xC05F] = (SSLCipherSuite*)&Cipher237;
-	result[0xC060] = (SSLCipherSuite*)&Cipher238;
-	result[0xC061] = (SSLCipherSuite*)&Cipher239;
-	result[0xC062] = (SSLCipherSuite*)&Cipher240;
-	result[0xC063] = (SSLCipherSuite*)&Cipher241;
-	result[0xC064] = (SSLCipherSuite*)&Cipher242;
-	result[0xC065] = (SSLCipherSuite*)&Cipher243;
-	result[0xC066] = (SSLCipherSuite*)&Cipher244;
-	result[0xC067] = (SSLCipherSuite*)&Cipher245;
-	result[0xC068] = (SSLCipherSuite*)&Cipher246;
-	result[0xC069] = (SSLCipherSuite*)&Cipher247;
-	result[0xC06A] = (SSLCipherSuite*)&Cipher248;
-	result[0xC06B] = (SSLCipherSuite*)&Cipher249;
-	result[0xC06C] = (SSLCipherSuite*)&Cipher250;
-	result[0xC06D] = (SSLCipherSuite*)&Cipher251;
-	result[0xC06E] = (SSLCipherSuite*)&Cipher252;
-	result[0xC06F] = (SSLCipherSuite*)&Cipher253;
-	result[0xC070] = (SSLCipherSuite*)&Cipher254;
-	result[0xC071] = (SSLCipherSuite*)&Cipher255;
-	result[0xC072] = (SSLCipherSuite*)&Cipher256;
-	result[0xC073] = (SSLCipherSuite*)&Cipher257;
-	result[0xC074] = (SSLCipherSuite*)&Cipher258;
-	result[0xC075] = (SSLCipherSuite*)&Cipher259;
-	result[0xC076] = (SSLCipherSuite*)&Cipher260;
-	result[0xC077] = (SSLCipherSuite*)&Cipher261;
-	result[0xC078] = (SSLCipherSuite*)&Cipher262;
-	result[0xC079] = (SSLCipherSuite*)&Cipher263;
-	result[0xC07A] = (SSLCipherSuite*)&Cipher264;
-	result[0xC07B] = (SSLCipherSuite*)&Cipher265;
-	result[0xC07C] = (SSLCipherSuite*)&Cipher266;
-	result[0xC07D] = (SSLCipherSuite*)&Cipher267;
-	result[0xC07E] = (SSLCipherSuite*)&Cipher268;
-	result[0xC07F] = (SSLCipherSuite*)&Cipher269;
-	result[0xC080] = (SSLCipherSuite*)&Cipher270;
-	result[0xC081] = (SSLCipherSuite*)&Cipher271;
-	result[0xC082] = (SSLCipherSuite*)&Cipher272;
-	result[0xC083] = (SSLCipherSuite*)&Cipher273;
-	result[0xC084] = (SSLCipherSuite*)&Cipher274;
-	result[0xC085] = (SSLCipherSuite*)&Cipher275;
-	result[0xC086] = (SSLCipherSuite*)&Cipher276;
-	result[0xC087] = (SSLCipherSuite*)&Cipher277;
-	result[0xC088] = (SSLCipherSuite*)&Cipher278;
-	result[0xC089] = (SSLCipherSuite*)&Cipher279;
-	result[0xC08A] = (SSLCipherSuite*)&Cipher280;
-	result[0xC08B] = (SSLCipherSuite*)&Cipher281;
-	result[0xC08C] = (SSLCipherSuite*)&Cipher282;
-	result[0xC08D] = (SSLCipherSuite*)&Cipher283;
-	result[0xC08E] = (SSLCipherSuite*)&Cipher284;
-	result[0xC08F] = (SSLCipherSuite*)&Cipher285;
-	result[0xC090] = (SSLCipherSuite*)&Cipher286;
-	result[0xC091] = (SSLCipherSuite*)&Cipher287;
-	result[0xC092] = (SSLCipherSuite*)&Cipher288;
-	result[0xC093] = (SSLCipherSuite*)&Cipher289;
-	result[0xC094] = (SSLCipherSuite*)&Cipher290;
-	result[0xC095] = (SSLCipherSuite*)&Cipher291;
-	result[0xC096] = (SSLCipherSuite*)&Cipher292;
-	result[0xC097] = (SSLCipherSuite*)&Cipher293;
-	result[0xC098] = (SSLCipherSuite*)&Cipher294;
-	result[0xC099] = (SSLCipherSuite*)&Cipher295;
-	result[0xC09A] = (SSLCipherSuite*)&Cipher296;
-	result[0xC09B] = (SSLCipherSuite*)&Cipher297;
-	result[0xC09C] = (SSLCipherSuite*)&Cipher298;
-	result[0xC09D] = (SSLCipherSuite*)&Cipher299;
-	result[0xC09E] = (SSLCipherSuite*)&Cipher300;
-	result[0xC09F] = (SSLCipherSuite*)&Cipher301;
-	result[0xC0A0] = (SSLCipherSuite*)&Cipher302;
-	result[0xC0A1] = (SSLCipherSuite*)&Cipher303;
-	result[0xC0A2] = (SSLCipherSuite*)&Cipher304;
-	result[0xC0A3] = (SSLCipherSuite*)&Cipher305;
-	result[0xC0A4] = (SSLCipherSuite*)&Cipher306;
-	result[0xC0A5] = (SSLCipherSuite*)&Cipher307;
-	result[0xC0A6] = (SSLCipherSuite*)&Cipher308;
-	result[0xC0A7] = (SSLCipherSuite*)&Cipher309;
-	result[0xC0A8] = (SSLCipherSuite*)&Cipher310;
-	result[0xC0A9] = (SSLCipherSuite*)&Cipher311;
-	result[0xC0AA] = (SSLCipherSuite*)&Cipher312;
-	result[0xC0AB] = (SSLCipherSuite*)&Cipher313;
-	result[0xC0AC] = (SSLCipherSuite*)&Cipher314;
-	result[0xC0AD] = (SSLCipherSuite*)&Cipher315;
-	result[0xC0AE] = (SSLCipherSuite*)&Cipher316;
-	result[0xC0AF] = (SSLCipherSuite*)&Cipher317;
-	result[0xCCA8] = (SSLCipherSuite*)&Cipher318;
-	result[0xCCA9] = (SSLCipherSuite*)&Cipher319;
-	result[0xCCAA] = (SSLCipherSuite*)&Cipher320;
-	result[0xCCAB] = (SSLCipherSuite*)&Cipher321;
-	result[0xCCAC] = (SSLCipherSuite*)&Cipher322;
-	result[0xCCAD] = (SSLCipherSuite*)&Cipher323;
-	result[0xCCAE] = (SSLCipherSuite*)&Cipher324;
-
-	return result;
-}
-
-static std::map<std::string, SSLCipherSuite*> createCipherSuiteStringToObjectMap()
-{
-	std::map<std::string, SSLCipherSuite*> result;
-
-	result["TLS_NULL_WITH_NULL_NULL"] = (SSLCipherSuite*)&Cipher1;
-	result["TLS_RSA_WITH_NULL_MD5"] = (SSLCipherSuite*)&Cipher2;
-	result["TLS_RSA_WITH_NULL_SHA"] = (SSLCipherSuite*)&Cipher3;
-	result["TLS_RSA_EXPORT_WITH_RC4_40_MD5"] = (SSLCipherSuite*)&Cipher4;
-	result["TLS_RSA_WITH_RC4_128_MD5"] = (SSLCipherSuite*)&Cipher5;
-	result["TLS_RSA_WITH_RC4_128_SHA"] = (SSLCipherSuite*)&Cipher6;
-	result["TLS_RSA_EXPORT_WITH_RC2_CBC_40_MD5"] = (SSLCipherSuite*)&Cipher7;
-	result["TLS_RSA_WITH_IDEA_CBC_SHA"] = (SSLCipherSuite*)&Cipher8;
-	result["TLS_RSA_EXPORT_WITH_DES40_CBC_SHA"] = (SSLCipherSuite*)&Cipher9;
-	result["TLS_RSA_WITH_DES_CBC_SHA"] = (SSLCipherSuite*)&Cipher10;
-	result["TLS_RSA_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher11;
-	result["TLS_DH_DSS_EXPORT_WITH_DES40_CBC_SHA"] = (SSLCipherSuite*)&Cipher12;
-	result["TLS_DH_DSS_WITH_DES_CBC_SHA"] = (SSLCipherSuite*)&Cipher13;
-	result["TLS_DH_DSS_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher14;
-	result["TLS_DH_RSA_EXPORT_WITH_DES40_CBC_SHA"] = (SSLCipherSuite*)&Cipher15;
-	result["TLS_DH_RSA_WITH_DES_CBC_SHA"] = (SSLCipherSuite*)&Cipher16;
-	result["TLS_DH_RSA_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher17;
-	result["TLS_DHE_DSS_EXPORT_WITH_DES40_CBC_SHA"] = (SSLCipherSuite*)&Cipher18;
-	result["TLS_DHE_DSS_WITH_DES_CBC_SHA"] = (SSLCipherSuite*)&Cipher19;
-	result["TLS_DHE_DSS_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher20;
-	result["TLS_DHE_RSA_EXPORT_WITH_DES40_CBC_SHA"] = (SSLCipherSuite*)&Cipher21;
-	result["TLS_DHE_RSA_WITH_DES_CBC_SHA"] = (SSLCipherSuite*)&Cipher22;
-	result["TLS_DHE_RSA_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher23;
-	result["TLS_DH_anon_EXPORT_WITH_RC4_40_MD5"] = (SSLCipherSuite*)&Cipher24;
-	result["TLS_DH_anon_WITH_RC4_128_MD5"] = (SSLCipherSuite*)&Cipher25;
-	result["TLS_DH_anon_EXPORT_WITH_DES40_CBC_SHA"] = (SSLCipherSuite*)&Cipher26;
-	result["TLS_DH_anon_WITH_DES_CBC_SHA"] = (SSLCipherSuite*)&Cipher27;
-	result["TLS_DH_anon_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher28;
-	result["TLS_KRB5_WITH_DES_CBC_SHA"] = (SSLCipherSuite*)&Cipher29;
-	result["TLS_KRB5_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher30;
-	result["TLS_KRB5_WITH_RC4_128_SHA"] = (SSLCipherSuite*)&Cipher31;
-	result["TLS_KRB5_WITH_IDEA_CBC_SHA"] = (SSLCipherSuite*)&Cipher32;
-	result["TLS_KRB5_WITH_DES_CBC_MD5"] = (SSLCipherSuite*)&Cipher33;
-	result["TLS_KRB5_WITH_3DES_EDE_CBC_MD5"] = (SSLCipherSuite*)&Cipher34;
-	result["TLS_KRB5_WITH_RC4_128_MD5"] = (SSLCipherSuite*)&Cipher35;
-	result["TLS_KRB5_WITH_IDEA_CBC_MD5"] = (SSLCipherSuite*)&Cipher36;
-	result["TLS_KRB5_EXPORT_WITH_DES_CBC_40_SHA"] = (SSLCipherSuite*)&Cipher37;
-	result["TLS_KRB5_EXPORT_WITH_RC2_CBC_40_SHA"] = (SSLCipherSuite*)&Cipher38;
-	result["TLS_KRB5_EXPORT_WITH_RC4_40_SHA"] = (SSLCipherSuite*)&Cipher39;
-	result["TLS_KRB5_EXPORT_WITH_DES_CBC_40_MD5"] = (SSLCipherSuite*)&Cipher40;
-	result["TLS_KRB5_EXPORT_WITH_RC2_CBC_40_MD5"] = (SSLCipherSuite*)&Cipher41;
-	result["TLS_KRB5_EXPORT_WITH_RC4_40_MD5"] = (SSLCipherSuite*)&Cipher42;
-	result["TLS_PSK_WITH_NULL_SHA"] = (SSLCipherSuite*)&Cipher43;
-	result["TLS_DHE_PSK_WITH_NULL_SHA"] = (SSLCipherSuite*)&Cipher44;
-	result["TLS_RSA_PSK_WITH_NULL_SHA"] = (SSLCipherSuite*)&Cipher45;
-	result["TLS_RSA_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher46;
-	result["TLS_DH_DSS_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher47;
-	result["TLS_DH_RSA_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher48;
-	result["TLS_DHE_DSS_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher49;
-	result["TLS_DHE_RSA_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher50;
-	result["TLS_DH_anon_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher51;
-	result["TLS_RSA_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher52;
-	result["TLS_DH_DSS_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher53;
-	result["TLS_DH_RSA_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher54;
-	result["TLS_DHE_DSS_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher55;
-	result["TLS_DHE_RSA_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher56;
-	result["TLS_DH_anon_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher57;
-	result["TLS_RSA_WITH_NULL_SHA256"] = (SSLCipherSuite*)&Cipher58;
-	result["TLS_RSA_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher59;
-	result["TLS_RSA_WITH_AES_256_CBC_SHA256"] = (SSLCipherSuite*)&Cipher60;
-	result["TLS_DH_DSS_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher61;
-	result["TLS_DH_RSA_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher62;
-	result["TLS_DHE_DSS_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher63;
-	result["TLS_RSA_WITH_CAMELLIA_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher64;
-	result["TLS_DH_DSS_WITH_CAMELLIA_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher65;
-	result["TLS_DH_RSA_WITH_CAMELLIA_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher66;
-	result["TLS_DHE_DSS_WITH_CAMELLIA_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher67;
-	result["TLS_DHE_RSA_WITH_CAMELLIA_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher68;
-	result["TLS_DH_anon_WITH_CAMELLIA_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher69;
-	result["TLS_DHE_RSA_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher70;
-	result["TLS_DH_DSS_WITH_AES_256_CBC_SHA256"] = (SSLCipherSuite*)&Cipher71;
-	result["TLS_DH_RSA_WITH_AES_256_CBC_SHA256"] = (SSLCipherSuite*)&Cipher72;
-	result["TLS_DHE_DSS_WITH_AES_256_CBC_SHA256"] = (SSLCipherSuite*)&Cipher73;
-	result["TLS_DHE_RSA_WITH_AES_256_CBC_SHA256"] = (SSLCipherSuite*)&Cipher74;
-	result["TLS_DH_anon_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher75;
-	result["TLS_DH_anon_WITH_AES_256_CBC_SHA256"] = (SSLCipherSuite*)&Cipher76;
-	result["TLS_RSA_WITH_CAMELLIA_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher77;
-	result["TLS_DH_DSS_WITH_CAMELLIA_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher78;
-	result["TLS_DH_RSA_WITH_CAMELLIA_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher79;
-	result["TLS_DHE_DSS_WITH_CAMELLIA_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher80;
-	result["TLS_DHE_RSA_WITH_CAMELLIA_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher81;
-	result["TLS_DH_anon_WITH_CAMELLIA_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher82;
-	result["TLS_PSK_WITH_RC4_128_SHA"] = (SSLCipherSuite*)&Cipher83;
-	result["TLS_PSK_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher84;
-	result["TLS_PSK_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher85;
-	result["TLS_PSK_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher86;
-	result["TLS_DHE_PSK_WITH_RC4_128_SHA"] = (SSLCipherSuite*)&Cipher87;
-	result["TLS_DHE_PSK_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher88;
-	result["TLS_DHE_PSK_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher89;
-	result["TLS_DHE_PSK_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher90;
-	result["TLS_RSA_PSK_WITH_RC4_128_SHA"] = (SSLCipherSuite*)&Cipher91;
-	result["TLS_RSA_PSK_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher92;
-	result["TLS_RSA_PSK_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher93;
-	result["TLS_RSA_PSK_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher94;
-	result["TLS_RSA_WITH_SEED_CBC_SHA"] = (SSLCipherSuite*)&Cipher95;
-	result["TLS_DH_DSS_WITH_SEED_CBC_SHA"] = (SSLCipherSuite*)&Cipher96;
-	result["TLS_DH_RSA_WITH_SEED_CBC_SHA"] = (SSLCipherSuite*)&Cipher97;
-	result["TLS_DHE_DSS_WITH_SEED_CBC_SHA"] = (SSLCipherSuite*)&Cipher98;
-	result["TLS_DHE_RSA_WITH_SEED_CBC_SHA"] = (SSLCipherSuite*)&Cipher99;
-	result["TLS_DH_anon_WITH_SEED_CBC_SHA"] = (SSLCipherSuite*)&Cipher100;
-	result["TLS_RSA_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher101;
-	result["TLS_RSA_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher102;
-	result["TLS_DHE_RSA_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher103;
-	result["TLS_DHE_RSA_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher104;
-	result["TLS_DH_RSA_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher105;
-	result["TLS_DH_RSA_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher106;
-	result["TLS_DHE_DSS_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher107;
-	result["TLS_DHE_DSS_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher108;
-	result["TLS_DH_DSS_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher109;
-	result["TLS_DH_DSS_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher110;
-	result["TLS_DH_anon_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher111;
-	result["TLS_DH_anon_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher112;
-	result["TLS_PSK_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher113;
-	result["TLS_PSK_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher114;
-	result["TLS_DHE_PSK_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher115;
-	result["TLS_DHE_PSK_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher116;
-	result["TLS_RSA_PSK_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher117;
-	result["TLS_RSA_PSK_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher118;
-	result["TLS_PSK_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher119;
-	result["TLS_PSK_WITH_AES_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher120;
-	result["TLS_PSK_WITH_NULL_SHA256"] = (SSLCipherSuite*)&Cipher121;
-	result["TLS_PSK_WITH_NULL_SHA384"] = (SSLCipherSuite*)&Cipher122;
-	result["TLS_DHE_PSK_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher123;
-	result["TLS_DHE_PSK_WITH_AES_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher124;
-	result["TLS_DHE_PSK_WITH_NULL_SHA256"] = (SSLCipherSuite*)&Cipher125;
-	result["TLS_DHE_PSK_WITH_NULL_SHA384"] = (SSLCipherSuite*)&Cipher126;
-	result["TLS_RSA_PSK_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher127;
-	result["TLS_RSA_PSK_WITH_AES_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher128;
-	result["TLS_RSA_PSK_WITH_NULL_SHA256"] = (SSLCipherSuite*)&Cipher129;
-	result["TLS_RSA_PSK_WITH_NULL_SHA384"] = (SSLCipherSuite*)&Cipher130;
-	result["TLS_RSA_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher131;
-	result["TLS_DH_DSS_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher132;
-	result["TLS_DH_RSA_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher133;
-	result["TLS_DHE_DSS_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher134;
-	result["TLS_DHE_RSA_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher135;
-	result["TLS_DH_anon_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher136;
-	result["TLS_RSA_WITH_CAMELLIA_256_CBC_SHA256"] = (SSLCipherSuite*)&Cipher137;
-	result["TLS_DH_DSS_WITH_CAMELLIA_256_CBC_SHA256"] = (SSLCipherSuite*)&Cipher138;
-	result["TLS_DH_RSA_WITH_CAMELLIA_256_CBC_SHA256"] = (SSLCipherSuite*)&Cipher139;
-	result["TLS_DHE_DSS_WITH_CAMELLIA_256_CBC_SHA256"] = (SSLCipherSuite*)&Cipher140;
-	result["TLS_DHE_RSA_WITH_CAMELLIA_256_CBC_SHA256"] = (SSLCipherSuite*)&Cipher141;
-	result["TLS_DH_anon_WITH_CAMELLIA_256_CBC_SHA256"] = (SSLCipherSuite*)&Cipher142;
-	result["TLS_ECDH_ECDSA_WITH_NULL_SHA"] = (SSLCipherSuite*)&Cipher143;
-	result["TLS_ECDH_ECDSA_WITH_RC4_128_SHA"] = (SSLCipherSuite*)&Cipher144;
-	result["TLS_ECDH_ECDSA_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher145;
-	result["TLS_ECDH_ECDSA_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher146;
-	result["TLS_ECDH_ECDSA_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher147;
-	result["TLS_ECDHE_ECDSA_WITH_NULL_SHA"] = (SSLCipherSuite*)&Cipher148;
-	result["TLS_ECDHE_ECDSA_WITH_RC4_128_SHA"] = (SSLCipherSuite*)&Cipher149;
-	result["TLS_ECDHE_ECDSA_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher150;
-	result["TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher151;
-	result["TLS_ECDHE_ECDSA_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher152;
-	result["TLS_ECDH_RSA_WITH_NULL_SHA"] = (SSLCipherSuite*)&Cipher153;
-	result["TLS_ECDH_RSA_WITH_RC4_128_SHA"] = (SSLCipherSuite*)&Cipher154;
-	result["TLS_ECDH_RSA_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher155;
-	result["TLS_ECDH_RSA_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher156;
-	result["TLS_ECDH_RSA_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher157;
-	result["TLS_ECDHE_RSA_WITH_NULL_SHA"] = (SSLCipherSuite*)&Cipher158;
-	result["TLS_ECDHE_RSA_WITH_RC4_128_SHA"] = (SSLCipherSuite*)&Cipher159;
-	result["TLS_ECDHE_RSA_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher160;
-	result["TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher161;
-	result["TLS_ECDHE_RSA_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher162;
-	result["TLS_ECDH_anon_WITH_NULL_SHA"] = (SSLCipherSuite*)&Cipher163;
-	result["TLS_ECDH_anon_WITH_RC4_128_SHA"] = (SSLCipherSuite*)&Cipher164;
-	result["TLS_ECDH_anon_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher165;
-	result["TLS_ECDH_anon_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher166;
-	result["TLS_ECDH_anon_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher167;
-	result["TLS_SRP_SHA_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher168;
-	result["TLS_SRP_SHA_RSA_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher169;
-	result["TLS_SRP_SHA_DSS_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher170;
-	result["TLS_SRP_SHA_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher171;
-	result["TLS_SRP_SHA_RSA_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher172;
-	result["TLS_SRP_SHA_DSS_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher173;
-	result["TLS_SRP_SHA_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher174;
-	result["TLS_SRP_SHA_RSA_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher175;
-	result["TLS_SRP_SHA_DSS_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher176;
-	result["TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher177;
-	result["TLS_ECDHE_ECDSA_WITH_AES_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher178;
-	result["TLS_ECDH_ECDSA_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher179;
-	result["TLS_ECDH_ECDSA_WITH_AES_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher180;
-	result["TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher181;
-	result["TLS_ECDHE_RSA_WITH_AES_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher182;
-	result["TLS_ECDH_RSA_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher183;
-	result["TLS_ECDH_RSA_WITH_AES_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher184;
-	result["TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher185;
-	result["TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher186;
-	result["TLS_ECDH_ECDSA_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher187;
-	result["TLS_ECDH_ECDSA_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher188;
-	result["TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher189;
-	result["TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher190;
-	result["TLS_ECDH_RSA_WITH_AES_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher191;
-	result["TLS_ECDH_RSA_WITH_AES_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher192;
-	result["TLS_ECDHE_PSK_WITH_RC4_128_SHA"] = (SSLCipherSuite*)&Cipher193;
-	result["TLS_ECDHE_PSK_WITH_3DES_EDE_CBC_SHA"] = (SSLCipherSuite*)&Cipher194;
-	result["TLS_ECDHE_PSK_WITH_AES_128_CBC_SHA"] = (SSLCipherSuite*)&Cipher195;
-	result["TLS_ECDHE_PSK_WITH_AES_256_CBC_SHA"] = (SSLCipherSuite*)&Cipher196;
-	result["TLS_ECDHE_PSK_WITH_AES_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher197;
-	result["TLS_ECDHE_PSK_WITH_AES_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher198;
-	result["TLS_ECDHE_PSK_WITH_NULL_SHA"] = (SSLCipherSuite*)&Cipher199;
-	result["TLS_ECDHE_PSK_WITH_NULL_SHA256"] = (SSLCipherSuite*)&Cipher200;
-	result["TLS_ECDHE_PSK_WITH_NULL_SHA384"] = (SSLCipherSuite*)&Cipher201;
-	result["TLS_RSA_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher202;
-	result["TLS_RSA_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher203;
-	result["TLS_DH_DSS_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher204;
-	result["TLS_DH_DSS_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher205;
-	result["TLS_DH_RSA_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher206;
-	result["TLS_DH_RSA_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher207;
-	result["TLS_DHE_DSS_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher208;
-	result["TLS_DHE_DSS_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher209;
-	result["TLS_DHE_RSA_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher210;
-	result["TLS_DHE_RSA_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher211;
-	result["TLS_DH_anon_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher212;
-	result["TLS_DH_anon_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher213;
-	result["TLS_ECDHE_ECDSA_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher214;
-	result["TLS_ECDHE_ECDSA_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher215;
-	result["TLS_ECDH_ECDSA_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher216;
-	result["TLS_ECDH_ECDSA_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher217;
-	result["TLS_ECDHE_RSA_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher218;
-	result["TLS_ECDHE_RSA_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher219;
-	result["TLS_ECDH_RSA_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher220;
-	result["TLS_ECDH_RSA_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher221;
-	result["TLS_RSA_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher222;
-	result["TLS_RSA_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher223;
-	result["TLS_DHE_RSA_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher224;
-	result["TLS_DHE_RSA_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher225;
-	result["TLS_DH_RSA_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher226;
-	result["TLS_DH_RSA_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher227;
-	result["TLS_DHE_DSS_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher228;
-	result["TLS_DHE_DSS_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher229;
-	result["TLS_DH_DSS_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher230;
-	result["TLS_DH_DSS_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher231;
-	result["TLS_DH_anon_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher232;
-	result["TLS_DH_anon_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher233;
-	result["TLS_ECDHE_ECDSA_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher234;
-	result["TLS_ECDHE_ECDSA_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher235;
-	result["TLS_ECDH_ECDSA_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher236;
-	result["TLS_ECDH_ECDSA_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher237;
-	result["TLS_ECDHE_RSA_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher238;
-	result["TLS_ECDHE_RSA_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher239;
-	result["TLS_ECDH_RSA_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher240;
-	result["TLS_ECDH_RSA_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher241;
-	result["TLS_PSK_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher242;
-	result["TLS_PSK_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher243;
-	result["TLS_DHE_PSK_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher244;
-	result["TLS_DHE_PSK_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher245;
-	result["TLS_RSA_PSK_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher246;
-	result["TLS_RSA_PSK_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher247;
-	result["TLS_PSK_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher248;
-	result["TLS_PSK_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher249;
-	result["TLS_DHE_PSK_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher250;
-	result["TLS_DHE_PSK_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher251;
-	result["TLS_RSA_PSK_WITH_ARIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher252;
-	result["TLS_RSA_PSK_WITH_ARIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher253;
-	result["TLS_ECDHE_PSK_WITH_ARIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher254;
-	result["TLS_ECDHE_PSK_WITH_ARIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher255;
-	result["TLS_ECDHE_ECDSA_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher256;
-	result["TLS_ECDHE_ECDSA_WITH_CAMELLIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher257;
-	result["TLS_ECDH_ECDSA_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher258;
-	result["TLS_ECDH_ECDSA_WITH_CAMELLIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher259;
-	result["TLS_ECDHE_RSA_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher260;
-	result["TLS_ECDHE_RSA_WITH_CAMELLIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher261;
-	result["TLS_ECDH_RSA_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher262;
-	result["TLS_ECDH_RSA_WITH_CAMELLIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher263;
-	result["TLS_RSA_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher264;
-	result["TLS_RSA_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher265;
-	result["TLS_DHE_RSA_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher266;
-	result["TLS_DHE_RSA_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher267;
-	result["TLS_DH_RSA_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher268;
-	result["TLS_DH_RSA_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher269;
-	result["TLS_DHE_DSS_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher270;
-	result["TLS_DHE_DSS_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher271;
-	result["TLS_DH_DSS_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher272;
-	result["TLS_DH_DSS_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher273;
-	result["TLS_DH_anon_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher274;
-	result["TLS_DH_anon_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher275;
-	result["TLS_ECDHE_ECDSA_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher276;
-	result["TLS_ECDHE_ECDSA_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher277;
-	result["TLS_ECDH_ECDSA_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher278;
-	result["TLS_ECDH_ECDSA_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher279;
-	result["TLS_ECDHE_RSA_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher280;
-	result["TLS_ECDHE_RSA_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher281;
-	result["TLS_ECDH_RSA_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher282;
-	result["TLS_ECDH_RSA_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher283;
-	result["TLS_PSK_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher284;
-	result["TLS_PSK_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher285;
-	result["TLS_DHE_PSK_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher286;
-	result["TLS_DHE_PSK_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher287;
-	result["TLS_RSA_PSK_WITH_CAMELLIA_128_GCM_SHA256"] = (SSLCipherSuite*)&Cipher288;
-	result["TLS_RSA_PSK_WITH_CAMELLIA_256_GCM_SHA384"] = (SSLCipherSuite*)&Cipher289;
-	result["TLS_PSK_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher290;
-	result["TLS_PSK_WITH_CAMELLIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher291;
-	result["TLS_DHE_PSK_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher292;
-	result["TLS_DHE_PSK_WITH_CAMELLIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher293;
-	result["TLS_RSA_PSK_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher294;
-	result["TLS_RSA_PSK_WITH_CAMELLIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher295;
-	result["TLS_ECDHE_PSK_WITH_CAMELLIA_128_CBC_SHA256"] = (SSLCipherSuite*)&Cipher296;
-	result["TLS_ECDHE_PSK_WITH_CAMELLIA_256_CBC_SHA384"] = (SSLCipherSuite*)&Cipher297;
-	result["TLS_RSA_WITH_AES_128_CCM"] = (SSLCipherSuite*)&Cipher298;
-	result["TLS_RSA_WITH_AES_256_CCM"] = (SSLCipherSuite*)&Cipher299;
-	result["TLS_DHE_RSA_WITH_AES_128_CCM"] = (SSLCipherSuite*)&Cipher300;
-	result["TLS_DHE_RSA_WITH_AES_256_CCM"] = (SSLCipherSuite*)&Cipher301;
-	result["TLS_RSA_WITH_AES_128_CCM_8"] = (SSLCipherSuite*)&Cipher302;
-	result["TLS_RSA_WITH_AES_256_CCM_8"] = (SSLCipherSuite*)&Cipher303;
-	result["TLS_DHE_RSA_WITH_AES_128_CCM_8"] = (SSLCipherSuite*)&Cipher304;
-	result["TLS_DHE_RSA_WITH_AES_256_CCM_8"] = (SSLCipherSuite*)&Cipher305;
-	result["TLS_PSK_WITH_AES_128_CCM"] = (SSLCipherSuite*)&Cipher306;
-	result["TLS_PSK_WITH_AES_256_CCM"] = (SSLCipherSuite*)&Cipher307;
-	result["TLS_DHE_PSK_WITH_AES_128_CCM"] = (SSLCipherSuite*)&Cipher308;
-	result["TLS_DHE_PSK_WITH_AES_256_CCM"] = (SSLCipherSuite*)&Cipher309;
-	result["TLS_PSK_WITH_AES_128_CCM_8"] = (SSLCipherSuite*)&Cipher310;
-	result["TLS_PSK_WITH_AES_256_CCM_8"] = (SSLCipherSuite*)&Cipher311;
-	result["TLS_PSK_DHE_WITH_AES_128_CCM_8"] = (SSLCipherSuite*)&Cipher312;
-	result["TLS_PSK_DHE_WITH_AES_256_CCM_8"] = (SSLCipherSuite*)&Cipher313;
-	result["TLS_ECDHE_ECDSA_WITH_AES_128_CCM"] = (SSLCipherSuite*)&Cipher314;
-	result["TLS_ECDHE_ECDSA_WITH_AES_256_CCM"] = (SSLCipherSuite*)&Cipher315;
-	result["TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8"] = (SSLCipherSuite*)&Cipher316;
-	result["TLS_ECDHE_ECDSA_WITH_AES_256_CCM_8"] = (SSLCipherSuite*)&Cipher317;
-	result["TLS_ECDHE_RSA_WITH_CHACHA20_POLY1305_SHA256"] = (SSLCipherSuite*)&Cipher318;
-	result["TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256"] = (SSLCipherSuite*)&Cipher319;
-	result["TLS_DHE_RSA_WITH_CHACHA20_POLY1305_SHA256"] = (SSLCipherSuite*)&Cipher320;
-	result["TLS_PSK_WITH_CHACHA20_POLY1305_SHA256"] = (SSLCipherSuite*)&Cipher321;
-	result["TLS_ECDHE_PSK_WITH_CHACHA20_POLY1305_SHA256"] = (SSLCipherSuite*)&Cipher322;
-	result["TLS_DHE_PSK_WITH_CHACHA20_POLY1305_SHA256"] = (SSLCipherSuite*)&Cipher323;
-	result["TLS_RSA_PSK_WITH_CHACHA20_POLY1305_SHA256"] = (SSLCipherSuite*)&Cipher324;
-
-	return result;
-}
-
-static const std::map<uint16_t, SSLCipherSuite*> CipherSuiteIdToObjectMap = createCipherSuiteIdToObjectMap();
-
-static const std::map<std::string, SSLCipherSuite*> CipherSuiteStringToObjectMap = createCipherSuiteStringToObjectMap();
+// all cipher-suites sorted by ID. The array holds only addresses so it's initialized at compile time
+static const SSLCipherSuite* const AllCipherSuites[] = {
+	&Cipher1, &Cipher2, &Cipher3, &Cipher4, &Cipher5, &Cipher6, &Cipher7, &Cipher8,
+	&Cipher9, &Cipher10, &Cipher11, &Cipher12, &Cipher13, &Cipher14, &Cipher15, &Cipher16,
+	&Cipher17, &Cipher18, &Cipher19, &Cipher20, &Cipher21, &Cipher22, &Cipher23, &Cipher24,
+	&Cipher25, &Cipher26, &Cipher27, &Cipher28, &Cipher29, &Cipher30, &Cipher31, &Cipher32,
+	&Cipher33, &Cipher34, &Cipher35, &Cipher36, &Cipher37, &Cipher38, &Cipher39, &Cipher40,
+	&Cipher41, &Cipher42, &Cipher43, &Cipher44, &Cipher45, &Cipher46, &Cipher47, &Cipher48,
+	&Cipher49, &Cipher50, &Cipher51, &Cipher52, &Cipher53, &Cipher54, &Cipher55, &Cipher56,
+	&Cipher57, &Cipher58, &Cipher59, &Cipher60, &Cipher61, &Cipher62, &Cipher63, &Cipher64,
+	&Cipher65, &Cipher66, &Cipher67, &Cipher68, &Cipher69, &Cipher70, &Cipher71, &Cipher72,
+	&Cipher73, &Cipher74, &Cipher75, &Cipher76, &Cipher77, &Cipher78, &Cipher79, &Cipher80,
+	&Cipher81, &Cipher82, &Cipher83, &Cipher84, &Cipher85, &Cipher86, &Cipher87, &Cipher88,
+	&Cipher89, &Cipher90, &Cipher91, &Cipher92, &Cipher93, &Cipher94, &Cipher95, &Cipher96,
+	&Cipher97, &Cipher98, &Cipher99, &Cipher100, &Cipher101, &Cipher102, &Cipher103, &Cipher104,
+	&Cipher105, &Cipher106, &Cipher107, &Cipher108, &Cipher109, &Cipher110, &Cipher111, &Cipher112,
+	&Cipher113, &Cipher114, &Cipher115, &Cipher116, &Cipher117, &Cipher118, &Cipher119, &Cipher120,
+	&Cipher121, &Cipher122, &Cipher123, &Cipher124, &Cipher125, &Cipher126, &Cipher127, &Cipher128,
+	&Cipher129, &Cipher130, &Cipher131, &Cipher132, &Cipher133, &Cipher134, &Cipher135, &Cipher136,
+	&Cipher137, &Cipher138, &Cipher139, &Cipher140, &Cipher141, &Cipher142, &Cipher143, &Cipher144,
+	&Cipher145, &Cipher146, &Cipher147, &Cipher148, &Cipher149, &Cipher150, &Cipher151, &Cipher152,
+	&Cipher153, &Cipher154, &Cipher155, &Cipher156, &Cipher157, &Cipher158, &Cipher159, &Cipher160,
+	&Cipher161, &Cipher162, &Cipher163, &Cipher164, &Cipher165, &Cipher166, &Cipher167, &Cipher168,
+	&Cipher169, &Cipher170, &Cipher171, &Cipher172, &Cipher173, &Cipher174, &Cipher175, &Cipher176,
+	&Cipher177, &Cipher178, &Cipher179, &Cipher180, &Cipher181, &Cipher182, &Cipher183, &Cipher184,
+	&Cipher185, &Cipher186, &Cipher187, &Cipher188, &Cipher189, &Cipher190, &Cipher191, &Cipher192,
+	&Cipher193, &Cipher194, &Cipher195, &Cipher196, &Cipher197, &Cipher198, &Cipher199, &Cipher200,
+	&Cipher201, &Cipher202, &Cipher203, &Cipher204, &Cipher205, &Cipher206, &Cipher207, &Cipher208,
+	&Cipher209, &Cipher210, &Cipher211, &Cipher212, &Cipher213, &Cipher214, &Cipher215, &Cipher216,
+	&Cipher217, &Cipher218, &Cipher219, &Cipher220, &Cipher221, &Cipher222, &Cipher223, &Cipher224,
+	&Cipher225, &Cipher226, &Cipher227, &Cipher228, &Cipher229, &Cipher230, &Cipher231, &Cipher232,
+	&Cipher233, &Cipher234, &Cipher235, &Cipher236, &Cipher237, &Cipher238, &Cipher239, &Cipher240,
+	&Cipher241, &Cipher242, &Cipher243, &Cipher244, &Cipher245, &Cipher246, &Cipher247, &Cipher248,
+	&Cipher249, &Cipher250, &Cipher251, &Cipher252, &Cipher253, &Cipher254, &Cipher255, &Cipher256,
+	&Cipher257, &Cipher258, &Cipher259, &Cipher260, &Cipher261, &Cipher262, &Cipher263, &Cipher264,
+	&Cipher265, &Cipher266, &Cipher267, &Cipher268, &Cipher269, &Cipher270, &Cipher271, &Cipher272,
+	&Cipher273, &Cipher274, &Cipher275, &Cipher276, &Cipher277, &Cipher278, &Cipher279, &Cipher280,
+	&Cipher281, &Cipher282, &Cipher283, &Cipher284, &Cipher285, &Cipher286, &Cipher287, &Cipher288,
+	&Cipher289, &Cipher290, &Cipher291, &Cipher292, &Cipher293, &Cipher294, &Cipher295, &Cipher296,
+	&Cipher297, &Cipher298, &Cipher299, &Cipher300, &Cipher301, &Cipher302, &Cipher303, &Cipher304,
+	&Cipher305, &Cipher306, &Cipher307, &Cipher308, &Cipher309, &Cipher310, &Cipher311, &Cipher312,
+	&Cipher313, &Cipher314, &Cipher315, &Cipher316, &Cipher317, &Cipher318, &Cipher319, &Cipher320,
+	&Cipher321, &Cipher322, &Cipher323, &Cipher324
+};
+
+#define NUM_OF_CIPHER_SUITES (sizeof(AllCipherSuites) / sizeof(AllCipherSuites[0]))
+// the size of the name lookup table, a power of 2 which keeps it less than half full so a lookup takes about one probe
+#define CIPHER_SUITE_NAME_TABLE_SIZE 1024
+#define NO_CIPHER_SUITE 0xFFFF
+
+static uint32_t hashCipherSuiteName(const char* name, size_t nameLen)
+{
+	// FNV-1a
+	uint32_t hash = 2166136261U;
+	for (size_t i = 0; i < nameLen; i++)
+	{
+		hash ^= (uint8_t)name[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/**
+ * Lookup tables of the cipher-suites, built once from AllCipherSuites without allocating memory. IDs in the ranges all cipher-suites
+ * are in (0x00xx, 0xC0xx and 0xCCxx) are looked up directly by their low byte, and names in an open-addressing hash table. Both hold
+ * indices into AllCipherSuites
+ */
+struct CipherSuiteLookupTables
+{
+	uint16_t byIdLowByte[3][256];
+	uint16_t byName[CIPHER_SUITE_NAME_TABLE_SIZE];
+
+	CipherSuiteLookupTables()
+	{
+		memset(byIdLowByte, 0xFF, sizeof(byIdLowByte));
+		memset(byName, 0xFF, sizeof(byName));
+
+		for (uint16_t i = 0; i < NUM_OF_CIPHER_SUITES; i++)
+		{
+			SSLCipherSuite* cipherSuite = (SSLCipherSuite*)AllCipherSuites[i];
+			int range = getIdRange(cipherSuite->getID());
+			if (range >= 0)
+				byIdLowByte[range][cipherSuite->getID() & 0xFF] = i;
+
+			std::string name = cipherSuite->asString();
+			uint32_t slot = hashCipherSuiteName(name.c_str(), name.length()) & (CIPHER_SUITE_NAME_TABLE_SIZE - 1);
+			while (byName[slot] != NO_CIPHER_SUITE)
+				slot = (slot + 1) & (CIPHER_SUITE_NAME_TABLE_SIZE - 1);
+			byName[slot] = i;
+		}
+	}
+
+	// returns the index of the range of an ID in byIdLowByte, or -1 if it's in none of them
+	static inline int getIdRange(uint16_t id)
+	{
+		switch (id >> 8)
+		{
+		case 0x00:
+			return 0;
+		case 0xC0:
+			return 1;
+		case 0xCC:
+			return 2;
+		default:
+			return -1;
+		}
+	}
+};
+
+// the tables are built on first use rather than at startup, which also guarantees the cipher-suites are initialized before them
+static const CipherSuiteLookupTables& getCipherSuiteTables()
+{
+	static const CipherSuiteLookupTables tables;
+	return tables;
+}
 
 SSLCipherSuite* SSLCipherSuite::getCipherSuiteByID(uint16_t id)
 {
-	std::map<uint16_t, SSLCipherSuite*>::const_iterator pos = CipherSuiteIdToObjectMap.find(id);
-	if (pos == CipherSuiteIdToObjectMap.end())
-	    return NULL;
-	else
-	    return pos->second;
+	int range = CipherSuiteLookupTables::getIdRange(id);
+	if (range >= 0)
+	{
+		uint16_t index = getCipherSuiteTables().byIdLowByte[range][id & 0xFF];
+		return (index != NO_CIPHER_SUITE ? (SSLCipherSuite*)AllCipherSuites[index] : NULL);
+	}
+
+	// cipher-suites outside the direct ranges, if any are added, are found by binary search
+	size_t low = 0, high = NUM_OF_CIPHER_SUITES;
+	while (low < high)
+	{
+		size_t mid = (low + high) / 2;
+		if (AllCipherSuites[mid]->m_Id < id)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low < NUM_OF_CIPHER_SUITES && AllCipherSuites[low]->m_Id == id)
+		return (SSLCipherSuite*)AllCipherSuites[low];
+
+	return NULL;
 }
 
-SSLCipherSuite* SSLCipherSuite::getCipherSuiteByName(std::string name)
+SSLCipherSuite* SSLCipherSuite::getCipherSuiteByName(const std::string& name)
 {
-	std::map<std::string, SSLCipherSuite*>::const_iterator pos = CipherSuiteStringToObjectMap.find(name);
-	if (pos == CipherSuiteStringToObjectMap.end())
-	    return NULL;
-	else
-	    return pos->second;
+	const CipherSuiteLookupTables& tables = getCipherSuiteTables();
+	uint32_t slot = hashCipherSuiteName(name.c_str(), name.length()) & (CIPHER_SUITE_NAME_TABLE_SIZE - 1);
+	for (uint16_t index = tables.byName[slot]; index != NO_CIPHER_SUITE; index = tables.byName[slot])
+	{
+		if (name == AllCipherSuites[index]->m_Name)
+			return (SSLCipherSuite*)AllCipherSuites[index];
+
+		slot = (slot + 1) & (CIPHER_SUITE_NAME_TABLE_SIZE - 1);
+	}
+
+	return NULL;
 }
 
 // --------------------
@@ -1091,6 +562,181 @@ std::string SSLServerNameIndicationExtension::getHostName()
 }
 
 
+// ----------------------------
+// SSLExtensionIterator methods
+// ----------------------------
+
+SSLExtensionIterator::SSLExtensionIterator(const uint8_t* extensionsData, size_t extensionsDataLen)
+{
+	m_Pos = extensionsData;
+	m_End = (extensionsData != NULL ? extensionsData + extensionsDataLen : NULL);
+	validate();
+}
+
+void SSLExtensionIterator::validate()
+{
+	if (m_Pos == NULL)
+		return;
+
+	// the extension header and data must be entirely in the data
+	size_t remaining = m_End - m_Pos;
+	if (remaining < 2*sizeof(uint16_t) || remaining - 2*sizeof(uint16_t) < getLength())
+		m_Pos = NULL;
+}
+
+void SSLExtensionIterator::next()
+{
+	if (m_Pos == NULL)
+		return;
+
+	m_Pos += 2*sizeof(uint16_t) + getLength();
+	validate();
+}
+
+SSLExtensionType SSLExtensionIterator::getType() const
+{
+	uint16_t typeAsInt = getTypeAsInt();
+	if (typeAsInt <= 24 || typeAsInt == 35 || typeAsInt == 65281)
+		return (SSLExtensionType)typeAsInt;
+
+	return SSL_EXT_Unknown;
+}
+
+bool SSLExtensionIterator::findType(uint16_t type)
+{
+	while (m_Pos != NULL && getTypeAsInt() != type)
+		next();
+
+	return m_Pos != NULL;
+}
+
+
+// -----------------------------------
+// SSLHandshakeMessageIterator methods
+// -----------------------------------
+
+SSLHandshakeMessageIterator::SSLHandshakeMessageIterator(const uint8_t* data, size_t dataLen)
+{
+	m_Pos = data;
+	m_Remaining = (data != NULL ? dataLen : 0);
+	updateMessageLength();
+}
+
+void SSLHandshakeMessageIterator::updateMessageLength()
+{
+	if (m_Remaining < sizeof(ssl_tls_handshake_layer))
+	{
+		m_MessageLen = 0;
+		return;
+	}
+
+	// the lengths are the ones the message objects return from getMessageLength(), so the iterator splits the data the same way
+	switch (getType())
+	{
+	case SSL_CLIENT_HELLO:
+	case SSL_SERVER_HELLO:
+	case SSL_HELLO_REQUEST:
+	case SSL_CERTIFICATE:
+	case SSL_SERVER_KEY_EXCHANGE:
+	case SSL_CERTIFICATE_REQUEST:
+	case SSL_CERTIFICATE_VERIFY:
+	case SSL_CLIENT_KEY_EXCHANGE:
+	case SSL_FINISHED:
+	case SSL_SERVER_DONE:
+	case SSL_NEW_SESSION_TICKET:
+	{
+		ssl_tls_handshake_layer* handshakeLayer = (ssl_tls_handshake_layer*)m_Pos;
+		m_MessageLen = sizeof(ssl_tls_handshake_layer) + ntohs(handshakeLayer->length2);
+		if (m_MessageLen > m_Remaining)
+			m_MessageLen = m_Remaining;
+		break;
+	}
+	default:
+		// may be an encrypted message, so its length can't be trusted
+		m_MessageLen = m_Remaining;
+	}
+}
+
+bool SSLHandshakeMessageIterator::isComplete() const
+{
+	if (m_Remaining < sizeof(ssl_tls_handshake_layer))
+		return false;
+
+	ssl_tls_handshake_layer* handshakeLayer = (ssl_tls_handshake_layer*)m_Pos;
+	return sizeof(ssl_tls_handshake_layer) + ntohs(handshakeLayer->length2) <= m_Remaining;
+}
+
+
+// reads the fields client-hello and server-hello messages have in common, up to the extensions. A client-hello has a list of
+// cipher-suites and compression methods, a server-hello a single cipher-suite and compression method. Messages without extensions
+// are valid and get an empty extension list. Returns false if the message ends before the extensions
+static bool parseHelloMessage(const uint8_t* data, size_t dataLen, bool isClientHello, uint16_t& version,
+		const uint8_t*& cipherSuites, size_t& cipherSuitesLen, const uint8_t*& extensions, size_t& extensionsLen)
+{
+	if (data == NULL || dataLen < sizeof(ssl_tls_client_server_hello))
+		return false;
+
+	ssl_tls_client_server_hello* hello = (ssl_tls_client_server_hello*)data;
+	size_t messageLen = sizeof(ssl_tls_handshake_layer) + (((size_t)hello->length1) << 16) + ntohs(hello->length2);
+	if (messageLen > dataLen)
+		messageLen = dataLen;
+
+	version = ntohs(hello->handshakeVersion);
+
+	size_t offset = sizeof(ssl_tls_client_server_hello);
+	if (offset + sizeof(uint8_t) > messageLen)
+		return false;
+	offset += sizeof(uint8_t) + data[offset]; // session ID
+
+	if (isClientHello)
+	{
+		if (offset + sizeof(uint16_t) > messageLen)
+			return false;
+		cipherSuitesLen = ((size_t)data[offset] << 8) | data[offset + 1];
+		offset += sizeof(uint16_t);
+		if (offset + cipherSuitesLen + sizeof(uint8_t) > messageLen)
+			return false;
+		cipherSuites = data + offset;
+		offset += cipherSuitesLen;
+		offset += sizeof(uint8_t) + data[offset]; // compression methods
+	}
+	else
+	{
+		cipherSuitesLen = sizeof(uint16_t);
+		cipherSuites = data + offset;
+		offset += sizeof(uint16_t) + sizeof(uint8_t); // cipher-suite and compression method
+	}
+
+	if (offset > messageLen)
+		return false;
+
+	extensions = NULL;
+	extensionsLen = 0;
+	if (offset + sizeof(uint16_t) <= messageLen)
+	{
+		extensionsLen = ((size_t)data[offset] << 8) | data[offset + 1];
+		extensions = data + offset + sizeof(uint16_t);
+		if (extensionsLen > messageLen - offset - sizeof(uint16_t))
+			extensionsLen = messageLen - offset - sizeof(uint16_t);
+	}
+
+	return true;
+}
+
+// returns the handshake messages data of a handshake record, or NULL if the data isn't a handshake record
+static const uint8_t* getHandshakeRecordData(const uint8_t* data, size_t dataLen, size_t& recordDataLen)
+{
+	if (data == NULL || dataLen < sizeof(ssl_tls_record_layer) || data[0] != SSL_HANDSHAKE)
+		return NULL;
+
+	recordDataLen = ntohs(((ssl_tls_record_layer*)data)->length);
+	if (recordDataLen > dataLen - sizeof(ssl_tls_record_layer))
+		recordDataLen = dataLen - sizeof(ssl_tls_record_layer);
+
+	return data + sizeof(ssl_tls_record_layer);
+}
+
+
 // ---------------------------
 // SSLHandshakeMessage methods
 // ---------------------------
@@ -1172,6 +818,16 @@ bool SSLHandshakeMessage::isMessageComplete()
 SSLClientHelloMessage::SSLClientHelloMessage(uint8_t* data, size_t dataLen, SSLHandshakeLayer* container)
 	: SSLHandshakeMessage(data, dataLen, container)
 {
+	// extension objects are created only when they're first accessed
+	m_ExtensionsParsed = false;
+}
+
+void SSLClientHelloMessage::parseExtensions()
+{
+	if (m_ExtensionsParsed)
+		return;
+
+	m_ExtensionsParsed = true;
 	size_t extensionLengthOffset = sizeof(ssl_tls_client_server_hello) + sizeof(uint8_t) + getSessionIDLength() + sizeof(uint16_t) + sizeof(uint16_t)*getCipherSuiteCount() + 2*sizeof(uint8_t);
 	if (extensionLengthOffset + sizeof(uint16_t) > m_DataLen)
 		return;
@@ -1257,6 +913,7 @@ uint8_t SSLClientHelloMessage::getCompressionMethodsValue()
 
 int SSLClientHelloMessage::getExtensionCount()
 {
+	parseExtensions();
 	return m_ExtensionList.size();
 }
 
@@ -1272,11 +929,13 @@ uint16_t SSLClientHelloMessage::getExtensionsLenth()
 
 SSLExtension* SSLClientHelloMessage::getExtension(int index)
 {
+	parseExtensions();
 	return m_ExtensionList.at(index);
 }
 
 SSLExtension* SSLClientHelloMessage::getExtensionOfType(uint16_t type)
 {
+	parseExtensions();
 	size_t vecSize = m_ExtensionList.size();
 	for (size_t i = 0; i < vecSize; i++)
 	{
@@ -1290,6 +949,7 @@ SSLExtension* SSLClientHelloMessage::getExtensionOfType(uint16_t type)
 
 SSLExtension* SSLClientHelloMessage::getExtensionOfType(SSLExtensionType type)
 {
+	parseExtensions();
 	size_t vecSize = m_ExtensionList.size();
 	for (size_t i = 0; i < vecSize; i++)
 	{
@@ -1301,6 +961,19 @@ SSLExtension* SSLClientHelloMessage::getExtensionOfType(SSLExtensionType type)
 	return NULL;
 }
 
+SSLExtensionIterator SSLClientHelloMessage::getExtensionIterator() const
+{
+	uint16_t version;
+	const uint8_t* cipherSuites;
+	size_t cipherSuitesLen;
+	const uint8_t* extensions;
+	size_t extensionsLen;
+	if (!parseHelloMessage(m_Data, m_DataLen, true, version, cipherSuites, cipherSuitesLen, extensions, extensionsLen))
+		return SSLExtensionIterator();
+
+	return SSLExtensionIterator(extensions, extensionsLen);
+}
+
 std::string SSLClientHelloMessage::toString()
 {
 	return "Client Hello message";
@@ -1314,6 +987,16 @@ std::string SSLClientHelloMessage::toString()
 SSLServerHelloMessage::SSLServerHelloMessage(uint8_t* data, size_t dataLen, SSLHandshakeLayer* container)
 	: SSLHandshakeMessage(data, dataLen, container)
 {
+	// extension objects are created only when they're first accessed
+	m_ExtensionsParsed = false;
+}
+
+void SSLServerHelloMessage::parseExtensions()
+{
+	if (m_ExtensionsParsed)
+		return;
+
+	m_ExtensionsParsed = true;
 	size_t extensionLengthOffset = sizeof(ssl_tls_client_server_hello) + sizeof(uint8_t) + getSessionIDLength() + sizeof(uint16_t) + sizeof(uint8_t);
 	if (extensionLengthOffset + sizeof(uint16_t) > m_DataLen)
 		return;
@@ -1386,6 +1069,7 @@ uint8_t SSLServerHelloMessage::getCompressionMethodsValue()
 
 int SSLServerHelloMessage::getExtensionCount()
 {
+	parseExtensions();
 	return m_ExtensionList.size();
 }
 
@@ -1401,6 +1085,7 @@ uint16_t SSLServerHelloMessage::getExtensionsLenth()
 
 SSLExtension* SSLServerHelloMessage::getExtension(int index)
 {
+	parseExtensions();
 	if (index < 0 || index >= (int)m_ExtensionList.size())
 		return NULL;
 
@@ -1409,6 +1094,7 @@ SSLExtension* SSLServerHelloMessage::getExtension(int index)
 
 SSLExtension* SSLServerHelloMessage::getExtensionOfType(uint16_t type)
 {
+	parseExtensions();
 	size_t vecSize = m_ExtensionList.size();
 	for (size_t i = 0; i < vecSize; i++)
 	{
@@ -1422,6 +1108,7 @@ SSLExtension* SSLServerHelloMessage::getExtensionOfType(uint16_t type)
 
 SSLExtension* SSLServerHelloMessage::getExtensionOfType(SSLExtensionType type)
 {
+	parseExtensions();
 	size_t vecSize = m_ExtensionList.size();
 	for (size_t i = 0; i < vecSize; i++)
 	{
@@ -1433,6 +1120,19 @@ SSLExtension* SSLServerHelloMessage::getExtensionOfType(SSLExtensionType type)
 	return NULL;
 }
 
+SSLExtensionIterator SSLServerHelloMessage::getExtensionIterator() const
+{
+	uint16_t version;
+	const uint8_t* cipherSuites;
+	size_t cipherSuitesLen;
+	const uint8_t* extensions;
+	size_t extensionsLen;
+	if (!parseHelloMessage(m_Data, m_DataLen, false, version, cipherSuites, cipherSuitesLen, extensions, extensionsLen))
+		return SSLExtensionIterator();
+
+	return SSLExtensionIterator(extensions, extensionsLen);
+}
+
 std::string SSLServerHelloMessage::toString()
 {
 	return "Server Hello message";
@@ -1762,4 +1462,225 @@ std::string SSLUnknownMessage::toString()
 	return "Unknown message";
 }
 
+
+// ---------------------------------
+// SSLClientHelloFingerprint methods
+// ---------------------------------
+
+static void appendDecimal(std::string& str, uint16_t value)
+{
+	char digits[5];
+	int numOfDigits = 0;
+	do
+	{
+		digits[numOfDigits++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value > 0);
+
+	while (numOfDigits > 0)
+		str += digits[--numOfDigits];
+}
+
+// appends a list of 2-byte values as decimal numbers separated by '-', leaving out GREASE values
+static void appendUInt16List(std::string& str, const uint8_t* list, size_t count)
+{
+	bool first = true;
+	for (size_t i = 0; i < count; i++)
+	{
+		uint16_t value = (uint16_t)((list[2*i] << 8) | list[2*i + 1]);
+		if (SSLClientHelloFingerprint::isGreaseValue(value))
+			continue;
+
+		if (!first)
+			str += '-';
+		appendDecimal(str, value);
+		first = false;
+	}
+}
+
+static void appendExtensionTypes(std::string& str, SSLExtensionIterator iter)
+{
+	bool first = true;
+	for (; iter.isValid(); iter.next())
+	{
+		if (SSLClientHelloFingerprint::isGreaseValue(iter.getTypeAsInt()))
+			continue;
+
+		if (!first)
+			str += '-';
+		appendDecimal(str, iter.getTypeAsInt());
+		first = false;
+	}
+}
+
+SSLClientHelloFingerprint::SSLClientHelloFingerprint()
+{
+	m_Version = 0;
+	m_CipherSuites = NULL;
+	m_CipherSuitesLen = 0;
+	m_Extensions = NULL;
+	m_ExtensionsLen = 0;
+	m_SupportedGroups = NULL;
+	m_SupportedGroupsLen = 0;
+	m_ECPointFormats = NULL;
+	m_ECPointFormatsLen = 0;
+	m_ServerName = NULL;
+	m_ServerNameLen = 0;
+}
+
+bool SSLClientHelloFingerprint::parse(const uint8_t* data, size_t dataLen)
+{
+	*this = SSLClientHelloFingerprint();
+
+	if (data == NULL || dataLen < sizeof(ssl_tls_handshake_layer) || data[0] != SSL_CLIENT_HELLO)
+		return false;
+
+	if (!parseHelloMessage(data, dataLen, true, m_Version, m_CipherSuites, m_CipherSuitesLen, m_Extensions, m_ExtensionsLen))
+	{
+		*this = SSLClientHelloFingerprint();
+		return false;
+	}
+
+	m_CipherSuitesLen &= ~(size_t)1;
+
+	for (SSLExtensionIterator iter = getExtensionIterator(); iter.isValid(); iter.next())
+	{
+		const uint8_t* extData = iter.getData();
+		size_t extLen = iter.getLength();
+
+		switch (iter.getTypeAsInt())
+		{
+		case SSL_EXT_SERVER_NAME:
+		{
+			// server name list length (2 bytes), then the first name: name type (1 byte, 0 is host name) and its length (2 bytes)
+			if (m_ServerName != NULL || extLen < 5 || extData[2] != 0)
+				break;
+
+			size_t nameLen = ((size_t)extData[3] << 8) | extData[4];
+			if (nameLen <= extLen - 5)
+			{
+				m_ServerName = (const char*)(extData + 5);
+				m_ServerNameLen = nameLen;
+			}
+			break;
+		}
+		case SSL_EXT_ELLIPTIC_CURVES:
+		{
+			if (extLen < sizeof(uint16_t))
+				break;
+
+			size_t listLen = ((size_t)extData[0] << 8) | extData[1];
+			if (listLen > extLen - sizeof(uint16_t))
+				listLen = extLen - sizeof(uint16_t);
+			m_SupportedGroups = extData + sizeof(uint16_t);
+			m_SupportedGroupsLen = listLen & ~(size_t)1;
+			break;
+		}
+		case SSL_EXT_EC_POINT_FORMATS:
+		{
+			if (extLen < sizeof(uint8_t))
+				break;
+
+			size_t listLen = extData[0];
+			if (listLen > extLen - sizeof(uint8_t))
+				listLen = extLen - sizeof(uint8_t);
+			m_ECPointFormats = extData + sizeof(uint8_t);
+			m_ECPointFormatsLen = listLen;
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool SSLClientHelloFingerprint::parseRecord(const uint8_t* data, size_t dataLen)
+{
+	size_t recordDataLen = 0;
+	const uint8_t* recordData = getHandshakeRecordData(data, dataLen, recordDataLen);
+	if (recordData == NULL)
+	{
+		*this = SSLClientHelloFingerprint();
+		return false;
+	}
+
+	return parse(recordData, recordDataLen);
+}
+
+void SSLClientHelloFingerprint::toJA3String(std::string& result) const
+{
+	result.clear();
+	appendDecimal(result, m_Version);
+	result += ',';
+	appendUInt16List(result, m_CipherSuites, getCipherSuiteCount());
+	result += ',';
+	appendExtensionTypes(result, getExtensionIterator());
+	result += ',';
+	appendUInt16List(result, m_SupportedGroups, getSupportedGroupCount());
+	result += ',';
+	for (size_t i = 0; i < m_ECPointFormatsLen; i++)
+	{
+		if (i > 0)
+			result += '-';
+		appendDecimal(result, m_ECPointFormats[i]);
+	}
+}
+
+
+// ---------------------------------
+// SSLServerHelloFingerprint methods
+// ---------------------------------
+
+SSLServerHelloFingerprint::SSLServerHelloFingerprint()
+{
+	m_Version = 0;
+	m_CipherSuite = 0;
+	m_Extensions = NULL;
+	m_ExtensionsLen = 0;
+}
+
+bool SSLServerHelloFingerprint::parse(const uint8_t* data, size_t dataLen)
+{
+	*this = SSLServerHelloFingerprint();
+
+	if (data == NULL || dataLen < sizeof(ssl_tls_handshake_layer) || data[0] != SSL_SERVER_HELLO)
+		return false;
+
+	const uint8_t* cipherSuite = NULL;
+	size_t cipherSuiteLen = 0;
+	if (!parseHelloMessage(data, dataLen, false, m_Version, cipherSuite, cipherSuiteLen, m_Extensions, m_ExtensionsLen))
+	{
+		*this = SSLServerHelloFingerprint();
+		return false;
+	}
+
+	m_CipherSuite = (uint16_t)((cipherSuite[0] << 8) | cipherSuite[1]);
+	return true;
+}
+
+bool SSLServerHelloFingerprint::parseRecord(const uint8_t* data, size_t dataLen)
+{
+	size_t recordDataLen = 0;
+	const uint8_t* recordData = getHandshakeRecordData(data, dataLen, recordDataLen);
+	if (recordData == NULL)
+	{
+		*this = SSLServerHelloFingerprint();
+		return false;
+	}
+
+	return parse(recordData, recordDataLen);
+}
+
+void SSLServerHelloFingerprint::toJA3SString(std::string& result) const
+{
+	result.clear();
+	appendDecimal(result, m_Version);
+	result += ',';
+	appendDecimal(result, m_CipherSuite);
+	result += ',';
+	appendExtensionTypes(result, getExtensionIterator());
+}
+
 } // namespace pcpp
@@ -2,6 +2,7 @@
 
 #include "Logger.h"
 #include "SSLLayer.h"
+#include "ProtocolRegistry.h"
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV) //for using ntohl, ntohs, etc.
 #include <winsock2.h>
 #elif LINUX
@@ -33,8 +34,6 @@ static std::map<uint16_t, bool> createSSLPortMap()
 	return result;
 }
 
-static const std::map<uint16_t, bool> SSLPortMap = createSSLPortMap();
-
 
 // ----------------
 // SSLLayer methods
@@ -42,8 +41,9 @@ static const std::map<uint16_t, bool> SSLPortMap = createSSLPortMap();
 
 bool SSLLayer::IsSSLMessage(uint16_t srcPort, uint16_t dstPort, uint8_t* data, size_t dataLen)
 {
-	// check the port map first
-	if (SSLPortMap.find(srcPort) == SSLPortMap.end() && SSLPortMap.find(dstPort) == SSLPortMap.end())
+	// check the registered ports first
+	const ProtocolRegistry& registry = ProtocolRegistry::getInstance();
+	if (!registry.isPortOfProtocol(srcPort, SSL) && !registry.isPortOfProtocol(dstPort, SSL))
 		return false;
 
 	if (dataLen < sizeof(ssl_tls_record_layer))
@@ -76,22 +76,22 @@ SSLLayer* SSLLayer::createSSLMessage(uint8_t* data, size_t dataLen, Layer* prevL
 	{
 		case SSL_HANDSHAKE:
 		{
-			return new SSLHandshakeLayer(data, dataLen, prevLayer, packet);
+			return new(packet) SSLHandshakeLayer(data, dataLen, prevLayer, packet);
 		}
 
 		case SSL_ALERT:
 		{
-			return new SSLAlertLayer(data, dataLen, prevLayer, packet);
+			return new(packet) SSLAlertLayer(data, dataLen, prevLayer, packet);
 		}
 
 		case SSL_CHANGE_CIPHER_SPEC:
 		{
-			return new SSLChangeCipherSpecLayer(data, dataLen, prevLayer, packet);
+			return new(packet) SSLChangeCipherSpecLayer(data, dataLen, prevLayer, packet);
 		}
 
 		case SSL_APPLICATION_DATA:
 		{
-			return new SSLApplicationDataLayer(data, dataLen, prevLayer, packet);
+			return new(packet) SSLApplicationDataLayer(data, dataLen, prevLayer, packet);
 		}
 
 		default:
@@ -120,7 +120,9 @@ std::string SSLLayer::sslVersionToString(SSLVersion ver)
 
 const std::map<uint16_t, bool>* SSLLayer::getSSLPortMap()
 {
-	return &SSLPortMap;
+	// built on first use rather than at startup
+	static const std::map<uint16_t, bool> portMap = createSSLPortMap();
+	return &portMap;
 }
 
 SSLVersion SSLLayer::getRecordVersion()
@@ -161,6 +163,7 @@ std::string SSLHandshakeLayer::toString()
 {
 	std::stringstream result;
 	result << sslVersionToString(getRecordVersion()) << " Layer, Handshake:";
+	parseMessages();
     for(size_t i = 0; i < m_MessageList.size(); i++)
     {
     	if (i == 0)
@@ -174,31 +177,44 @@ std::string SSLHandshakeLayer::toString()
 SSLHandshakeLayer::SSLHandshakeLayer(uint8_t* data, size_t dataLen, Layer* prevLayer, Packet* packet)
 	: SSLLayer(data, dataLen, prevLayer, packet)
 {
-	uint8_t* curPos = m_Data + sizeof(ssl_tls_record_layer);
-	size_t recordDataLen = ntohs(getRecordLayer()->length);
+	// message objects are created only when they're first accessed
+	m_MessagesParsed = false;
+}
+
+SSLHandshakeMessageIterator SSLHandshakeLayer::getMessageIterator() const
+{
+	size_t recordDataLen = ntohs(((ssl_tls_record_layer*)m_Data)->length);
 	if (recordDataLen > m_DataLen - sizeof(ssl_tls_record_layer))
 		recordDataLen = m_DataLen - sizeof(ssl_tls_record_layer);
 
-	size_t curPosIndex = 0;
-	while (true)
+	return SSLHandshakeMessageIterator(m_Data + sizeof(ssl_tls_record_layer), recordDataLen);
+}
+
+void SSLHandshakeLayer::parseMessages()
+{
+	if (m_MessagesParsed)
+		return;
+
+	m_MessagesParsed = true;
+	for (SSLHandshakeMessageIterator iter = getMessageIterator(); iter.isValid(); iter.next())
 	{
-		SSLHandshakeMessage* message = SSLHandshakeMessage::createHandhakeMessage(curPos, recordDataLen-curPosIndex, this);
+		SSLHandshakeMessage* message = SSLHandshakeMessage::createHandhakeMessage((uint8_t*)iter.getData(), iter.getRemainingLength(), this);
 		if (message == NULL)
 			break;
 
 		m_MessageList.pushBack(message);
-		curPos += message->getMessageLength();
-		curPosIndex += message->getMessageLength();
 	}
 }
 
 size_t SSLHandshakeLayer::getHandshakeMessagesCount()
 {
+	parseMessages();
 	return m_MessageList.size();
 }
 
 SSLHandshakeMessage* SSLHandshakeLayer::getHandshakeMessageAt(int index)
 {
+	parseMessages();
 	if (index < 0 || index >= (int)(m_MessageList.size()))
 		return NULL;
 
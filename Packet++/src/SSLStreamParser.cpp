@@ -0,0 +1,308 @@
+#define LOG_MODULE PacketLogModuleSSLStreamParser
+
+#include "SSLStreamParser.h"
+#include "Logger.h"
+#include <string.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV) //for using ntohl, ntohs, etc.
+#include <winsock2.h>
+#elif LINUX
+#include <in.h> //for using ntohl, ntohs, etc.
+#elif MAC_OS_X
+#include <arpa/inet.h> //for using ntohl, ntohs, etc.
+#endif
+
+// the maximum length of a record: 2^14 bytes of data and up to 2048 bytes of compression and encryption expansion
+#define SSL_MAX_RECORD_LENGTH (16384 + 2048)
+
+namespace pcpp
+{
+
+// reads the 3-byte length of a handshake message and returns the message length including its header
+static inline size_t getHandshakeMessageLength(const uint8_t* messageHeader)
+{
+	return sizeof(ssl_tls_handshake_layer) + (((size_t)messageHeader[1] << 16) | ((size_t)messageHeader[2] << 8) | messageHeader[3]);
+}
+
+
+// -------- Class SSLStreamParser -----------------
+
+SSLStreamParser::SSLStreamParser(OnSSLStreamEvent onEvent, void* userCookie, const SSLStreamParserConfiguration& config) :
+	m_OnEvent(onEvent), m_UserCookie(userCookie), m_Config(config), m_LastConnection(NULL), m_LastFlowKey(0)
+{
+}
+
+SSLStreamParser::~SSLStreamParser()
+{
+	clear();
+}
+
+void SSLStreamParser::clear()
+{
+	for (std::map<uint32_t, ConnectionState*>::iterator iter = m_Connections.begin(); iter != m_Connections.end(); ++iter)
+		delete iter->second;
+
+	m_Connections.clear();
+	m_LastConnection = NULL;
+}
+
+SSLStreamParser::ConnectionState* SSLStreamParser::getConnection(uint32_t flowKey)
+{
+	if (m_LastConnection != NULL && m_LastFlowKey == flowKey)
+		return m_LastConnection;
+
+	ConnectionState*& conn = m_Connections[flowKey];
+	if (conn == NULL)
+	{
+		conn = new ConnectionState();
+		for (int side = 0; side < 2; side++)
+		{
+			SideState& sideState = conn->sides[side];
+			sideState.state = ParseRecordHeader;
+			sideState.recordHeaderLen = 0;
+			sideState.recordRemaining = 0;
+			sideState.encrypted = false;
+			sideState.messageLength = 0;
+			memset(&sideState.event, 0, sizeof(sideState.event));
+			sideState.event.side = side;
+		}
+	}
+
+	m_LastConnection = conn;
+	m_LastFlowKey = flowKey;
+	return conn;
+}
+
+void SSLStreamParser::parse(int side, const TcpStreamData& tcpData)
+{
+	parse(side, tcpData.getData(), tcpData.getDataLength(), tcpData.getConnectionDataRef());
+}
+
+void SSLStreamParser::parse(int side, const uint8_t* data, size_t dataLen, const ConnectionData& connectionData)
+{
+	if (side != 0 && side != 1)
+	{
+		LOG_ERROR("Side must be 0 or 1");
+		return;
+	}
+
+	SideState& sideState = getConnection(connectionData.flowKey)->sides[side];
+	sideState.event.connectionData = &connectionData;
+	parseSide(sideState, data, dataLen);
+}
+
+void SSLStreamParser::connectionEnded(const ConnectionData& connectionData)
+{
+	std::map<uint32_t, ConnectionState*>::iterator iter = m_Connections.find(connectionData.flowKey);
+	if (iter == m_Connections.end())
+		return;
+
+	ConnectionState* conn = iter->second;
+	for (int side = 0; side < 2; side++)
+	{
+		SideState& sideState = conn->sides[side];
+		sideState.event.connectionData = &connectionData;
+		if (sideState.state == ParseRecordData || (sideState.state == ParseRecordHeader && sideState.recordHeaderLen > 0))
+			parseError(sideState, "Connection ended in the middle of a record");
+		else if (sideState.state == ParseRecordHeader && !sideState.messageBuffer.empty())
+			parseError(sideState, "Connection ended in the middle of a handshake message");
+	}
+
+	if (m_LastConnection == conn)
+		m_LastConnection = NULL;
+
+	delete conn;
+	m_Connections.erase(iter);
+}
+
+void SSLStreamParser::parseSide(SideState& sideState, const uint8_t* data, size_t dataLen)
+{
+	while (dataLen > 0)
+	{
+		switch (sideState.state)
+		{
+		case ParseError:
+			return;
+
+		case ParseRecordHeader:
+		{
+			// the header is only 5 bytes, so it's always collected in the side state
+			size_t headerBytes = sizeof(ssl_tls_record_layer) - sideState.recordHeaderLen;
+			if (headerBytes > dataLen)
+				headerBytes = dataLen;
+
+			memcpy(sideState.recordHeader + sideState.recordHeaderLen, data, headerBytes);
+			sideState.recordHeaderLen += headerBytes;
+			data += headerBytes;
+			dataLen -= headerBytes;
+
+			if (sideState.recordHeaderLen == sizeof(ssl_tls_record_layer) && !recordHeaderComplete(sideState))
+				return;
+
+			break;
+		}
+
+		case ParseRecordData:
+		{
+			size_t recordBytes = (sideState.recordRemaining < dataLen ? sideState.recordRemaining : dataLen);
+
+			// only plaintext handshake records are parsed, the data of other records is skipped
+			if (sideState.event.recordType == SSL_HANDSHAKE && !sideState.event.isEncrypted && !parseHandshakeData(sideState, data, recordBytes))
+				return;
+
+			data += recordBytes;
+			dataLen -= recordBytes;
+			sideState.recordRemaining -= recordBytes;
+			if (sideState.recordRemaining == 0)
+			{
+				sideState.state = ParseRecordHeader;
+				sideState.recordHeaderLen = 0;
+			}
+
+			break;
+		}
+		}
+	}
+}
+
+bool SSLStreamParser::recordHeaderComplete(SideState& sideState)
+{
+	ssl_tls_record_layer* recordHeader = (ssl_tls_record_layer*)sideState.recordHeader;
+	uint8_t recordType = recordHeader->recordType;
+	uint16_t recordVersion = ntohs(recordHeader->recordVersion);
+	size_t recordLength = ntohs(recordHeader->length);
+
+	if (recordType < SSL_CHANGE_CIPHER_SPEC || recordType > SSL_APPLICATION_DATA)
+	{
+		parseError(sideState, "Invalid record type");
+		return false;
+	}
+
+	if ((recordVersion >> 8) != 3)
+	{
+		parseError(sideState, "Invalid record version");
+		return false;
+	}
+
+	if (recordLength > SSL_MAX_RECORD_LENGTH)
+	{
+		parseError(sideState, "Record is too long");
+		return false;
+	}
+
+	// a handshake message may continue only in the next handshake record
+	if (recordType != SSL_HANDSHAKE && !sideState.messageBuffer.empty())
+	{
+		parseError(sideState, "Handshake message is interrupted by a record of another type");
+		return false;
+	}
+
+	SSLStreamEvent& event = sideState.event;
+	event.recordType = (SSLRecordType)recordType;
+	event.recordVersion = (SSLVersion)recordVersion;
+	event.recordLength = recordLength;
+	event.isEncrypted = (sideState.encrypted || recordType == SSL_APPLICATION_DATA);
+	reportEvent(sideState, SSLStreamRecord);
+
+	// the records after a change-cipher-spec record are encrypted with the negotiated keys
+	if (recordType == SSL_CHANGE_CIPHER_SPEC)
+		sideState.encrypted = true;
+
+	sideState.recordRemaining = recordLength;
+	if (recordLength > 0)
+		sideState.state = ParseRecordData;
+	else
+		sideState.recordHeaderLen = 0;
+
+	return true;
+}
+
+bool SSLStreamParser::parseHandshakeData(SideState& sideState, const uint8_t* data, size_t dataLen)
+{
+	while (dataLen > 0)
+	{
+		// messages which are entirely in this piece of data are reported without copying them
+		if (sideState.messageBuffer.empty() && dataLen >= sizeof(ssl_tls_handshake_layer))
+		{
+			size_t messageLength = getHandshakeMessageLength(data);
+			if (messageLength <= dataLen)
+			{
+				reportMessage(sideState, data, messageLength);
+				data += messageLength;
+				dataLen -= messageLength;
+				continue;
+			}
+		}
+
+		// keep the beginning of the message until the rest of it arrives
+		if (sideState.messageBuffer.length() < sizeof(ssl_tls_handshake_layer))
+		{
+			size_t headerBytes = sizeof(ssl_tls_handshake_layer) - sideState.messageBuffer.length();
+			if (headerBytes > dataLen)
+				headerBytes = dataLen;
+
+			sideState.messageBuffer.append((const char*)data, headerBytes);
+			data += headerBytes;
+			dataLen -= headerBytes;
+			if (sideState.messageBuffer.length() < sizeof(ssl_tls_handshake_layer))
+				return true;
+
+			sideState.messageLength = getHandshakeMessageLength((const uint8_t*)sideState.messageBuffer.data());
+			if (sideState.messageLength > m_Config.maxHandshakeMessageLength)
+			{
+				parseError(sideState, "Handshake message is too long");
+				return false;
+			}
+		}
+
+		size_t messageBytes = sideState.messageLength - sideState.messageBuffer.length();
+		if (messageBytes > dataLen)
+			messageBytes = dataLen;
+
+		sideState.messageBuffer.append((const char*)data, messageBytes);
+		data += messageBytes;
+		dataLen -= messageBytes;
+
+		if (sideState.messageBuffer.length() == sideState.messageLength)
+		{
+			reportMessage(sideState, (const uint8_t*)sideState.messageBuffer.data(), sideState.messageLength);
+			sideState.messageBuffer.clear();
+		}
+	}
+
+	return true;
+}
+
+void SSLStreamParser::reportMessage(SideState& sideState, const uint8_t* messageData, size_t messageLength)
+{
+	SSLStreamEvent& event = sideState.event;
+	event.handshakeType = (SSLHandshakeType)messageData[0];
+	event.messageData = messageData;
+	event.messageLength = messageLength;
+	event.message = NULL;
+	if (m_Config.createMessageObjects)
+		event.message = SSLHandshakeMessage::createHandhakeMessage((uint8_t*)messageData, messageLength, NULL);
+
+	reportEvent(sideState, SSLStreamHandshakeMessage);
+
+	delete event.message;
+	event.message = NULL;
+	event.messageData = NULL;
+	event.messageLength = 0;
+}
+
+void SSLStreamParser::parseError(SideState& sideState, const char* reason)
+{
+	LOG_DEBUG("Parse error on side %d: %s", sideState.event.side, reason);
+	sideState.state = ParseError;
+	sideState.messageBuffer.clear();
+	reportEvent(sideState, SSLStreamParseError);
+}
+
+void SSLStreamParser::reportEvent(SideState& sideState, SSLStreamEventType type)
+{
+	sideState.event.type = type;
+	if (m_OnEvent != NULL)
+		m_OnEvent(sideState.event, m_UserCookie);
+}
+
+} // namespace pcpp
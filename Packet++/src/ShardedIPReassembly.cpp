@@ -0,0 +1,323 @@
+#define LOG_MODULE PacketLogModuleIPReassembly
+
+#include "ShardedIPReassembly.h"
+#include "AtomicUtils.h"
+#include "PacketView.h"
+#include "FlowHash.h"
+#include "Logger.h"
+#include <string.h>
+
+namespace pcpp
+{
+
+static int getNumOfWorkers(const ShardedIPReassemblyConfiguration& config)
+{
+	return (config.numOfProducers > 0 ? config.numOfProducers : 1) + (config.numOfShards > 0 ? config.numOfShards : 1);
+}
+
+ShardedIPReassembly::ShardedIPReassembly(OnPacketReassembled onPacketReassembledCallback, void* userCookie, IPReassembly::OnFragmentsClean onFragmentsCleanCallback,
+		const ShardedIPReassemblyConfiguration& config) :
+	m_Stats(getStatsCounterNames(), getNumOfWorkers(config))
+{
+	int numOfShards = (config.numOfShards > 0 ? config.numOfShards : 1);
+	m_NumOfProducers = (config.numOfProducers > 0 ? config.numOfProducers : 1);
+	m_DropWhenFull = config.dropWhenFull;
+	m_ParseUntil = config.parseUntil;
+	m_ParseUntilLayer = config.parseUntilLayer;
+	m_OnPacketReassembled = onPacketReassembledCallback;
+	m_OnFragmentsClean = onFragmentsCleanCallback;
+	m_Running = false;
+	m_StopRequested = 0;
+	m_NumOfFlushRequests = 0;
+	pthread_mutex_init(&m_ControlMutex, NULL);
+
+	for (int i = 0; i < numOfShards; i++)
+	{
+		Shard* shard = new Shard();
+		shard->owner = this;
+		shard->index = i;
+		shard->userCookie = userCookie;
+		shard->flushRequest = 0;
+		shard->flushDone = 0;
+		// the shard's fragments clean callback forwards to the user's callback with the shard's cookie
+		shard->reassembly = new IPReassembly(onFragmentsClean, shard, config.maxPacketsToStore, config.maxMemoryBytes, config.evictionPolicy, config.fragmentTimeout);
+		for (int j = 0; j < m_NumOfProducers; j++)
+			shard->queues.push_back(new RawPacketQueue(config.queueCapacity > 0 ? config.queueCapacity : 1));
+		m_Shards.push_back(shard);
+	}
+}
+
+ShardedIPReassembly::~ShardedIPReassembly()
+{
+	stop();
+
+	for (std::vector<Shard*>::iterator iter = m_Shards.begin(); iter != m_Shards.end(); iter++)
+	{
+		Shard* shard = *iter;
+		for (std::vector<RawPacketQueue*>::iterator queueIter = shard->queues.begin(); queueIter != shard->queues.end(); queueIter++)
+			delete (*queueIter);
+		delete shard->reassembly;
+		delete shard;
+	}
+
+	pthread_mutex_destroy(&m_ControlMutex);
+}
+
+std::vector<std::string> ShardedIPReassembly::getStatsCounterNames()
+{
+	const char* names[NumOfStatsCounters] = { "packets queued", "packets dropped", "packets ignored", "packets processed", "packets reassembled", "incomplete packets dropped", "memory usage" };
+	return std::vector<std::string>(names, names + NumOfStatsCounters);
+}
+
+void ShardedIPReassembly::setShardUserCookie(int shardIndex, void* userCookie)
+{
+	if (shardIndex < 0 || shardIndex >= (int)m_Shards.size())
+	{
+		LOG_ERROR("Shard index %d is out of range", shardIndex);
+		return;
+	}
+
+	m_Shards[shardIndex]->userCookie = userCookie;
+}
+
+bool ShardedIPReassembly::start()
+{
+	pthread_mutex_lock(&m_ControlMutex);
+
+	if (m_Running)
+	{
+		pthread_mutex_unlock(&m_ControlMutex);
+		return true;
+	}
+
+	atomicStoreRelease(&m_StopRequested, 0);
+	for (size_t i = 0; i < m_Shards.size(); i++)
+	{
+		int err = pthread_create(&(m_Shards[i]->thread), NULL, shardThreadMain, m_Shards[i]);
+		if (err != 0)
+		{
+			LOG_ERROR("Cannot create the worker thread of shard %d: [%s]", (int)i, strerror(err));
+			stopThreads(i);
+			pthread_mutex_unlock(&m_ControlMutex);
+			return false;
+		}
+	}
+
+	m_Running = true;
+	pthread_mutex_unlock(&m_ControlMutex);
+	return true;
+}
+
+void ShardedIPReassembly::stop()
+{
+	pthread_mutex_lock(&m_ControlMutex);
+
+	if (m_Running)
+	{
+		stopThreads(m_Shards.size());
+		m_Running = false;
+	}
+
+	pthread_mutex_unlock(&m_ControlMutex);
+}
+
+void ShardedIPReassembly::stopThreads(size_t numOfThreads)
+{
+	atomicStoreRelease(&m_StopRequested, 1);
+	for (size_t i = 0; i < numOfThreads; i++)
+		pthread_join(m_Shards[i]->thread, NULL);
+}
+
+int ShardedIPReassembly::getShardIndex(RawPacket* rawPacket) const
+{
+	return getShardIndex(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getLinkLayerType());
+}
+
+int ShardedIPReassembly::getShardIndex(const uint8_t* data, size_t dataLen, LinkLayerType linkType) const
+{
+	PacketView view;
+	if (!FlowKeyExtractor::extract(data, dataLen, linkType, view) || !view.isFragment)
+		return -1;
+
+	FlowTuple tuple;
+	if (!FlowHash::getTuple(view, tuple))
+		return -1;
+
+	// a packet is identified by its addresses and fragment ID only. The protocol is left out because for IPv6 it's found by following the
+	// extensions, which the first fragment and the others may have differently. The fragment ID seeds a symmetric hash of the addresses
+	tuple.protocol = 0;
+	uint32_t hash = FlowHash::hashSymmetric(tuple, view.fragmentId);
+
+	// map the hash to a shard with a multiplication rather than a modulo
+	return (int)(((uint64_t)hash * m_Shards.size()) >> 32);
+}
+
+bool ShardedIPReassembly::reassemblePacket(RawPacket* rawPacket, int producerId)
+{
+	if (producerId < 0 || producerId >= m_NumOfProducers)
+	{
+		LOG_ERROR("Producer ID %d is out of range", producerId);
+		return false;
+	}
+
+	const uint8_t* data = rawPacket->getRawData();
+	int dataLen = rawPacket->getRawDataLen();
+	int shardIndex = getShardIndex(data, (size_t)dataLen, rawPacket->getLinkLayerType());
+	if (shardIndex < 0)
+	{
+		m_Stats.add(producerId, PacketsIgnored);
+		return false;
+	}
+
+	RawPacketQueue* queue = m_Shards[shardIndex]->queues[producerId];
+	if (!queue->enqueueCopy(rawPacket, m_DropWhenFull, &m_Running))
+	{
+		m_Stats.add(producerId, PacketsDropped);
+		return false;
+	}
+
+	m_Stats.add(producerId, PacketsQueued);
+	return true;
+}
+
+size_t ShardedIPReassembly::reassemblePackets(RawPacket* rawPackets, size_t numOfPackets, int producerId)
+{
+	size_t numOfQueued = 0;
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		if (reassemblePacket(&rawPackets[i], producerId))
+			numOfQueued++;
+	}
+
+	return numOfQueued;
+}
+
+void ShardedIPReassembly::flush()
+{
+	pthread_mutex_lock(&m_ControlMutex);
+
+	if (!m_Running)
+	{
+		// no shard thread uses the queues or the reassembly instances, so this thread can do their work
+		for (std::vector<Shard*>::iterator iter = m_Shards.begin(); iter != m_Shards.end(); iter++)
+		{
+			while (processQueues(*iter, MaxBurstSize) > 0)
+				;
+		}
+
+		pthread_mutex_unlock(&m_ControlMutex);
+		return;
+	}
+
+	size_t request = ++m_NumOfFlushRequests;
+	for (std::vector<Shard*>::iterator iter = m_Shards.begin(); iter != m_Shards.end(); iter++)
+		atomicStoreRelease(&((*iter)->flushRequest), request);
+
+	for (std::vector<Shard*>::iterator iter = m_Shards.begin(); iter != m_Shards.end(); iter++)
+	{
+		while (atomicLoadAcquire(&((*iter)->flushDone)) != request)
+			RawPacketQueue::sleepBriefly();
+	}
+
+	pthread_mutex_unlock(&m_ControlMutex);
+}
+
+size_t ShardedIPReassembly::processQueues(Shard* shard, size_t maxPacketsPerQueue)
+{
+	size_t numOfPackets = 0;
+	size_t numOfReassembled = 0;
+
+	for (std::vector<RawPacketQueue*>::iterator iter = shard->queues.begin(); iter != shard->queues.end(); iter++)
+	{
+		RawPacketQueue* queue = *iter;
+		for (size_t i = 0; i < maxPacketsPerQueue; i++)
+		{
+			QueuedRawPacket* queuedPacket = queue->front();
+			if (queuedPacket == NULL)
+				break;
+
+			// the raw packet points to the queued data, which stays in place until the element is popped
+			RawPacket rawPacket(queuedPacket->data, queuedPacket->dataLen, queuedPacket->timestamp, false, queuedPacket->linkType);
+			IPReassembly::ReassemblyStatus status;
+			Packet* result = shard->reassembly->processPacket(&rawPacket, status, m_ParseUntil, m_ParseUntilLayer);
+			if (status == IPReassembly::REASSEMBLED)
+			{
+				// a reassembled packet has its own data, so it stays valid after the element is popped
+				numOfReassembled++;
+				if (m_OnPacketReassembled != NULL)
+					m_OnPacketReassembled(result, shard->index, shard->userCookie);
+				else
+					delete result;
+			}
+			else
+			{
+				// only fragments are queued, so any other packet returned as is points to the queued data and is dropped here
+				delete result;
+			}
+
+			queue->pop();
+			numOfPackets++;
+		}
+	}
+
+	if (numOfPackets > 0)
+	{
+		int workerId = m_NumOfProducers + shard->index;
+		m_Stats.add(workerId, PacketsProcessed, numOfPackets);
+		m_Stats.add(workerId, PacketsReassembled, numOfReassembled);
+		m_Stats.set(workerId, MemoryUsage, shard->reassembly->getMemoryUsage());
+	}
+
+	return numOfPackets;
+}
+
+void* ShardedIPReassembly::shardThreadMain(void* shardPtr)
+{
+	Shard* shard = (Shard*)shardPtr;
+	ShardedIPReassembly* owner = shard->owner;
+	int idleRounds = 0;
+
+	while (true)
+	{
+		// the stop request is read before polling, so when it's set and a whole round finds no packets all queues are drained
+		bool stopRequested = (atomicLoadAcquire(&owner->m_StopRequested) != 0);
+
+		size_t numOfPackets = owner->processQueues(shard, MaxBurstSize);
+
+		size_t flushRequest = atomicLoadAcquire(&shard->flushRequest);
+		if (flushRequest != shard->flushDone)
+		{
+			// process what producers queued before the request, a bounded amount so producers which keep queuing can't delay it forever
+			owner->processQueues(shard, shard->queues.front()->getCapacity());
+			atomicStoreRelease(&shard->flushDone, flushRequest);
+		}
+
+		if (numOfPackets > 0)
+		{
+			idleRounds = 0;
+			continue;
+		}
+
+		if (stopRequested)
+			break;
+
+		if (idleRounds < IdleSpinRounds)
+			idleRounds++;
+		else
+			RawPacketQueue::sleepBriefly();
+	}
+
+	return NULL;
+}
+
+void ShardedIPReassembly::onFragmentsClean(const IPReassembly::PacketKey* key, void* shardPtr)
+{
+	Shard* shard = (Shard*)shardPtr;
+	ShardedIPReassembly* owner = shard->owner;
+
+	owner->m_Stats.add(owner->m_NumOfProducers + shard->index, IncompletePacketsDropped);
+	if (owner->m_OnFragmentsClean != NULL)
+		owner->m_OnFragmentsClean(key, shard->userCookie);
+}
+
+} // namespace pcpp
@@ -0,0 +1,367 @@
+#define LOG_MODULE PacketLogModuleTcpReassembly
+
+#include "ShardedTcpReassembly.h"
+#include "AtomicUtils.h"
+#include "PacketView.h"
+#include "FlowHash.h"
+#include "Logger.h"
+#include <string.h>
+
+namespace pcpp
+{
+
+static int getNumOfWorkers(const ShardedTcpReassemblyConfiguration& config)
+{
+	return (config.numOfProducers > 0 ? config.numOfProducers : 1) + (config.numOfShards > 0 ? config.numOfShards : 1);
+}
+
+ShardedTcpReassembly::ShardedTcpReassembly(TcpReassembly::OnTcpMessageReady onMessageReadyCallback, void* userCookie, TcpReassembly::OnTcpConnectionStart onConnectionStartCallback,
+		TcpReassembly::OnTcpConnectionEnd onConnectionEndCallback, const ShardedTcpReassemblyConfiguration& config) :
+	m_Stats(getStatsCounterNames(), getNumOfWorkers(config))
+{
+	m_OnMessageReadyCallback = onMessageReadyCallback;
+	m_OnMessageReadyZeroCopyCallback = NULL;
+	m_OnConnStart = onConnectionStartCallback;
+	m_OnConnEnd = onConnectionEndCallback;
+	init(userCookie, config);
+}
+
+ShardedTcpReassembly::ShardedTcpReassembly(TcpReassembly::OnTcpMessageReadyZeroCopy onMessageReadyCallback, void* userCookie, TcpReassembly::OnTcpConnectionStart onConnectionStartCallback,
+		TcpReassembly::OnTcpConnectionEnd onConnectionEndCallback, const ShardedTcpReassemblyConfiguration& config) :
+	m_Stats(getStatsCounterNames(), getNumOfWorkers(config))
+{
+	m_OnMessageReadyCallback = NULL;
+	m_OnMessageReadyZeroCopyCallback = onMessageReadyCallback;
+	m_OnConnStart = onConnectionStartCallback;
+	m_OnConnEnd = onConnectionEndCallback;
+	init(userCookie, config);
+}
+
+void ShardedTcpReassembly::init(void* userCookie, const ShardedTcpReassemblyConfiguration& config)
+{
+	int numOfShards = (config.numOfShards > 0 ? config.numOfShards : 1);
+	m_NumOfProducers = (config.numOfProducers > 0 ? config.numOfProducers : 1);
+	m_DropWhenFull = config.dropWhenFull;
+	m_Defragment = config.defragment;
+	m_Running = false;
+	m_StopRequested = 0;
+	m_NumOfCloseAllRequests = 0;
+	pthread_mutex_init(&m_ControlMutex, NULL);
+
+	for (int i = 0; i < numOfShards; i++)
+	{
+		Shard* shard = new Shard();
+		shard->owner = this;
+		shard->index = i;
+		shard->userCookie = userCookie;
+		shard->closeAllRequest = 0;
+		shard->closeAllDone = 0;
+		// the shard's callbacks forward to the user's callbacks, so the reassembly instance always delivers data without copying it
+		if (m_Defragment)
+		{
+			shard->normalizer = new StreamNormalizer(onMessageReady, shard, onConnectionStart, onConnectionEnd, config.reassemblyConfig, config.normalizerConfig);
+			shard->reassembly = &shard->normalizer->getTcpReassembly();
+		}
+		else
+		{
+			shard->normalizer = NULL;
+			shard->reassembly = new TcpReassembly(onMessageReady, shard, onConnectionStart, onConnectionEnd, config.reassemblyConfig);
+		}
+		for (int j = 0; j < m_NumOfProducers; j++)
+			shard->queues.push_back(new RawPacketQueue(config.queueCapacity > 0 ? config.queueCapacity : 1));
+		m_Shards.push_back(shard);
+	}
+}
+
+ShardedTcpReassembly::~ShardedTcpReassembly()
+{
+	stop();
+
+	for (std::vector<Shard*>::iterator iter = m_Shards.begin(); iter != m_Shards.end(); iter++)
+	{
+		Shard* shard = *iter;
+		for (std::vector<RawPacketQueue*>::iterator queueIter = shard->queues.begin(); queueIter != shard->queues.end(); queueIter++)
+			delete (*queueIter);
+		if (shard->normalizer != NULL)
+			delete shard->normalizer;
+		else
+			delete shard->reassembly;
+		delete shard;
+	}
+
+	pthread_mutex_destroy(&m_ControlMutex);
+}
+
+std::vector<std::string> ShardedTcpReassembly::getStatsCounterNames()
+{
+	const char* names[NumOfStatsCounters] = { "packets queued", "packets dropped", "packets ignored", "packets processed", "connections started", "connections ended", "out-of-order bytes" };
+	return std::vector<std::string>(names, names + NumOfStatsCounters);
+}
+
+void ShardedTcpReassembly::setShardUserCookie(int shardIndex, void* userCookie)
+{
+	if (shardIndex < 0 || shardIndex >= (int)m_Shards.size())
+	{
+		LOG_ERROR("Shard index %d is out of range", shardIndex);
+		return;
+	}
+
+	m_Shards[shardIndex]->userCookie = userCookie;
+}
+
+bool ShardedTcpReassembly::start()
+{
+	pthread_mutex_lock(&m_ControlMutex);
+
+	if (m_Running)
+	{
+		pthread_mutex_unlock(&m_ControlMutex);
+		return true;
+	}
+
+	atomicStoreRelease(&m_StopRequested, 0);
+	for (size_t i = 0; i < m_Shards.size(); i++)
+	{
+		int err = pthread_create(&(m_Shards[i]->thread), NULL, shardThreadMain, m_Shards[i]);
+		if (err != 0)
+		{
+			LOG_ERROR("Cannot create the worker thread of shard %d: [%s]", (int)i, strerror(err));
+			stopThreads(i);
+			pthread_mutex_unlock(&m_ControlMutex);
+			return false;
+		}
+	}
+
+	m_Running = true;
+	pthread_mutex_unlock(&m_ControlMutex);
+	return true;
+}
+
+void ShardedTcpReassembly::stop()
+{
+	pthread_mutex_lock(&m_ControlMutex);
+
+	if (m_Running)
+	{
+		stopThreads(m_Shards.size());
+		m_Running = false;
+	}
+
+	pthread_mutex_unlock(&m_ControlMutex);
+}
+
+void ShardedTcpReassembly::stopThreads(size_t numOfThreads)
+{
+	atomicStoreRelease(&m_StopRequested, 1);
+	for (size_t i = 0; i < numOfThreads; i++)
+		pthread_join(m_Shards[i]->thread, NULL);
+}
+
+int ShardedTcpReassembly::getShardIndex(RawPacket* rawPacket) const
+{
+	return getShardIndex(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getLinkLayerType());
+}
+
+int ShardedTcpReassembly::getShardIndex(const uint8_t* data, size_t dataLen, LinkLayerType linkType) const
+{
+	PacketView view;
+	if (!FlowKeyExtractor::extract(data, dataLen, linkType, view))
+		return -1;
+
+	uint32_t hash = 0;
+	if (m_Defragment)
+	{
+		// fragments don't carry the ports, so the packets of a connection are assigned by its IP addresses
+		if ((!view.isPacketOfType(TCP) && !view.isFragment) || !StreamNormalizer::getShardHash(view, hash))
+			return -1;
+	}
+	else
+	{
+		FlowTuple tuple;
+		if (!view.isPacketOfType(TCP) || !FlowHash::getTuple(view, tuple))
+			return -1;
+
+		hash = FlowHash::hashSymmetric(tuple);
+	}
+
+	// map the hash to a shard with a multiplication rather than a modulo
+	return (int)(((uint64_t)hash * m_Shards.size()) >> 32);
+}
+
+bool ShardedTcpReassembly::reassemblePacket(RawPacket* rawPacket, int producerId)
+{
+	if (producerId < 0 || producerId >= m_NumOfProducers)
+	{
+		LOG_ERROR("Producer ID %d is out of range", producerId);
+		return false;
+	}
+
+	const uint8_t* data = rawPacket->getRawData();
+	int dataLen = rawPacket->getRawDataLen();
+	int shardIndex = getShardIndex(data, (size_t)dataLen, rawPacket->getLinkLayerType());
+	if (shardIndex < 0)
+	{
+		m_Stats.add(producerId, PacketsIgnored);
+		return false;
+	}
+
+	RawPacketQueue* queue = m_Shards[shardIndex]->queues[producerId];
+	if (!queue->enqueueCopy(rawPacket, m_DropWhenFull, &m_Running))
+	{
+		m_Stats.add(producerId, PacketsDropped);
+		return false;
+	}
+
+	m_Stats.add(producerId, PacketsQueued);
+	return true;
+}
+
+size_t ShardedTcpReassembly::reassemblePackets(RawPacket* rawPackets, size_t numOfPackets, int producerId)
+{
+	size_t numOfQueued = 0;
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		if (reassemblePacket(&rawPackets[i], producerId))
+			numOfQueued++;
+	}
+
+	return numOfQueued;
+}
+
+void ShardedTcpReassembly::closeAllConnections()
+{
+	pthread_mutex_lock(&m_ControlMutex);
+
+	if (!m_Running)
+	{
+		// no shard thread uses the queues or the reassembly instances, so this thread can do their work
+		for (std::vector<Shard*>::iterator iter = m_Shards.begin(); iter != m_Shards.end(); iter++)
+		{
+			while (processQueues(*iter, MaxBurstSize) > 0)
+				;
+			(*iter)->reassembly->closeAllConnections();
+		}
+
+		pthread_mutex_unlock(&m_ControlMutex);
+		return;
+	}
+
+	size_t request = ++m_NumOfCloseAllRequests;
+	for (std::vector<Shard*>::iterator iter = m_Shards.begin(); iter != m_Shards.end(); iter++)
+		atomicStoreRelease(&((*iter)->closeAllRequest), request);
+
+	for (std::vector<Shard*>::iterator iter = m_Shards.begin(); iter != m_Shards.end(); iter++)
+	{
+		while (atomicLoadAcquire(&((*iter)->closeAllDone)) != request)
+			RawPacketQueue::sleepBriefly();
+	}
+
+	pthread_mutex_unlock(&m_ControlMutex);
+}
+
+size_t ShardedTcpReassembly::processQueues(Shard* shard, size_t maxPacketsPerQueue)
+{
+	size_t numOfPackets = 0;
+
+	for (std::vector<RawPacketQueue*>::iterator iter = shard->queues.begin(); iter != shard->queues.end(); iter++)
+	{
+		RawPacketQueue* queue = *iter;
+		for (size_t i = 0; i < maxPacketsPerQueue; i++)
+		{
+			QueuedRawPacket* queuedPacket = queue->front();
+			if (queuedPacket == NULL)
+				break;
+
+			// the raw packet points to the queued data, which stays in place until the element is popped
+			RawPacket rawPacket(queuedPacket->data, queuedPacket->dataLen, queuedPacket->timestamp, false, queuedPacket->linkType);
+			if (shard->normalizer != NULL)
+				shard->normalizer->processPacket(&rawPacket);
+			else
+				shard->reassembly->reassemblePacket(&rawPacket);
+			queue->pop();
+			numOfPackets++;
+		}
+	}
+
+	if (numOfPackets > 0)
+	{
+		int workerId = m_NumOfProducers + shard->index;
+		m_Stats.add(workerId, PacketsProcessed, numOfPackets);
+		m_Stats.set(workerId, OutOfOrderBytes, shard->reassembly->getOutOfOrderBytes());
+	}
+
+	return numOfPackets;
+}
+
+void* ShardedTcpReassembly::shardThreadMain(void* shardPtr)
+{
+	Shard* shard = (Shard*)shardPtr;
+	ShardedTcpReassembly* owner = shard->owner;
+	int idleRounds = 0;
+
+	while (true)
+	{
+		// the stop request is read before polling, so when it's set and a whole round finds no packets all queues are drained
+		bool stopRequested = (atomicLoadAcquire(&owner->m_StopRequested) != 0);
+
+		size_t numOfPackets = owner->processQueues(shard, MaxBurstSize);
+
+		size_t closeAllRequest = atomicLoadAcquire(&shard->closeAllRequest);
+		if (closeAllRequest != shard->closeAllDone)
+		{
+			// process what producers queued before the request, a bounded amount so producers which keep queuing can't delay it forever
+			owner->processQueues(shard, shard->queues.front()->getCapacity());
+			shard->reassembly->closeAllConnections();
+			atomicStoreRelease(&shard->closeAllDone, closeAllRequest);
+		}
+
+		if (numOfPackets > 0)
+		{
+			idleRounds = 0;
+			continue;
+		}
+
+		if (stopRequested)
+			break;
+
+		if (idleRounds < IdleSpinRounds)
+			idleRounds++;
+		else
+			RawPacketQueue::sleepBriefly();
+	}
+
+	return NULL;
+}
+
+void ShardedTcpReassembly::onMessageReady(int side, const TcpStreamData& tcpData, void* shardPtr)
+{
+	Shard* shard = (Shard*)shardPtr;
+	ShardedTcpReassembly* owner = shard->owner;
+
+	if (owner->m_OnMessageReadyZeroCopyCallback != NULL)
+		owner->m_OnMessageReadyZeroCopyCallback(side, tcpData, shard->userCookie);
+	else if (owner->m_OnMessageReadyCallback != NULL)
+		owner->m_OnMessageReadyCallback(side, tcpData, shard->userCookie);
+}
+
+void ShardedTcpReassembly::onConnectionStart(ConnectionData connectionData, void* shardPtr)
+{
+	Shard* shard = (Shard*)shardPtr;
+	ShardedTcpReassembly* owner = shard->owner;
+
+	owner->m_Stats.add(owner->m_NumOfProducers + shard->index, ConnectionsStarted);
+	if (owner->m_OnConnStart != NULL)
+		owner->m_OnConnStart(connectionData, shard->userCookie);
+}
+
+void ShardedTcpReassembly::onConnectionEnd(ConnectionData connectionData, TcpReassembly::ConnectionEndReason reason, void* shardPtr)
+{
+	Shard* shard = (Shard*)shardPtr;
+	ShardedTcpReassembly* owner = shard->owner;
+
+	owner->m_Stats.add(owner->m_NumOfProducers + shard->index, ConnectionsEnded);
+	if (owner->m_OnConnEnd != NULL)
+		owner->m_OnConnEnd(connectionData, reason, shard->userCookie);
+}
+
+} // namespace pcpp
@@ -0,0 +1,672 @@
+#define LOG_MODULE PacketLogModuleSipDialogTracker
+
+#include "SipDialogTracker.h"
+#include "Packet.h"
+#include "Logger.h"
+#include <string.h>
+#include <stdlib.h>
+
+// the compact forms of the header field names (RFC 3261 section 7.3.3)
+#define PCPP_SIP_CALL_ID_COMPACT_FIELD "i"
+#define PCPP_SIP_FROM_COMPACT_FIELD    "f"
+#define PCPP_SIP_TO_COMPACT_FIELD      "t"
+
+// the longest IPv6 address string
+#define SIP_MAX_ADDRESS_STRING_LEN 46
+
+namespace pcpp
+{
+
+static inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline char toLowerAscii(char c)
+{
+	return (c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c);
+}
+
+static void trim(const char*& data, size_t& dataLen)
+{
+	while (dataLen > 0 && isSpace(data[0]))
+	{
+		data++;
+		dataLen--;
+	}
+
+	while (dataLen > 0 && isSpace(data[dataLen - 1]))
+		dataLen--;
+}
+
+// read the next token separated by white spaces, returns false if there are no more tokens
+static bool nextToken(const char*& data, size_t& dataLen, const char*& token, size_t& tokenLen)
+{
+	while (dataLen > 0 && isSpace(data[0]))
+	{
+		data++;
+		dataLen--;
+	}
+
+	token = data;
+	tokenLen = 0;
+	while (tokenLen < dataLen && !isSpace(data[tokenLen]))
+		tokenLen++;
+
+	data += tokenLen;
+	dataLen -= tokenLen;
+	return tokenLen > 0;
+}
+
+static bool parseNumber(const char* data, size_t dataLen, uint32_t& number)
+{
+	if (dataLen == 0 || dataLen > 10)
+		return false;
+
+	uint64_t result = 0;
+	for (size_t i = 0; i < dataLen; i++)
+	{
+		if (data[i] < '0' || data[i] > '9')
+			return false;
+		result = result * 10 + (data[i] - '0');
+	}
+
+	if (result > 0xffffffff)
+		return false;
+
+	number = (uint32_t)result;
+	return true;
+}
+
+// the FNV-1a hash of the Call-ID, which is compared case sensitively
+static uint32_t hashCallId(const char* callId, size_t callIdLength)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < callIdLength; i++)
+	{
+		hash ^= (uint8_t)callId[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static uint32_t hashEndpoint(const SipMediaEndpoint& endpoint)
+{
+	uint32_t hash = 2166136261u;
+	size_t addressLen = (endpoint.ipVersion == 4 ? 4 : 16);
+	for (size_t i = 0; i < addressLen; i++)
+	{
+		hash ^= endpoint.ipAddress[i];
+		hash *= 16777619u;
+	}
+
+	hash ^= (uint8_t)(endpoint.port >> 8);
+	hash *= 16777619u;
+	hash ^= (uint8_t)endpoint.port;
+	hash *= 16777619u;
+	return hash;
+}
+
+static inline bool isEndpointEqual(const SipMediaEndpoint& first, const SipMediaEndpoint& second)
+{
+	return first.port == second.port && first.ipVersion == second.ipVersion && memcmp(first.ipAddress, second.ipAddress, sizeof(first.ipAddress)) == 0;
+}
+
+static HeaderField* getSipField(SipLayer* sipLayer, const char* fieldName, const char* compactFieldName)
+{
+	HeaderField* field = sipLayer->getFieldByName(fieldName);
+	if (field == NULL)
+		field = sipLayer->getFieldByName(compactFieldName);
+
+	return field;
+}
+
+// copy the value of the tag parameter of a From or To header, which follows the URI (parameters inside "<>" belong to the URI)
+static void extractTag(HeaderField* field, char* tag)
+{
+	if (field == NULL)
+		return;
+
+	const char* value = field->getFieldValueData();
+	size_t valueLen = field->getFieldValueLength();
+	bool inUri = false;
+
+	for (size_t i = 0; i < valueLen; i++)
+	{
+		if (value[i] == '<')
+			inUri = true;
+		else if (value[i] == '>')
+			inUri = false;
+
+		if (inUri || value[i] != ';')
+			continue;
+
+		size_t paramStart = i + 1;
+		while (paramStart < valueLen && isSpace(value[paramStart]))
+			paramStart++;
+
+		if (paramStart + 4 > valueLen || toLowerAscii(value[paramStart]) != 't' || toLowerAscii(value[paramStart + 1]) != 'a' ||
+				toLowerAscii(value[paramStart + 2]) != 'g' || value[paramStart + 3] != '=')
+			continue;
+
+		size_t tagStart = paramStart + 4;
+		size_t tagLen = 0;
+		while (tagStart + tagLen < valueLen && value[tagStart + tagLen] != ';' && value[tagStart + tagLen] != ',' && !isSpace(value[tagStart + tagLen]))
+			tagLen++;
+
+		if (tagLen > SipDialog::MaxTagLength)
+			tagLen = SipDialog::MaxTagLength;
+
+		memcpy(tag, value + tagStart, tagLen);
+		tag[tagLen] = 0;
+		return;
+	}
+}
+
+// parse a CSeq value, which is a sequence number and a method, e.g "314159 INVITE"
+static bool parseCSeq(HeaderField* field, uint32_t& cseq, SipRequestLayer::SipMethod& method)
+{
+	if (field == NULL)
+		return false;
+
+	const char* value = field->getFieldValueData();
+	size_t valueLen = field->getFieldValueLength();
+	const char* token;
+	size_t tokenLen;
+
+	if (!nextToken(value, valueLen, token, tokenLen) || !parseNumber(token, tokenLen, cseq))
+		return false;
+
+	// SipRequestFirstLine::parseMethod() expects the method to be followed by a space, as in the request line
+	char methodBuffer[16];
+	if (!nextToken(value, valueLen, token, tokenLen) || tokenLen + 1 > sizeof(methodBuffer))
+		return false;
+
+	memcpy(methodBuffer, token, tokenLen);
+	methodBuffer[tokenLen] = ' ';
+	method = SipRequestFirstLine::parseMethod(methodBuffer, tokenLen + 1);
+	return true;
+}
+
+bool SipDialogTracker::parseSdpConnection(HeaderField* field, SipMediaEndpoint& endpoint)
+{
+	const char* value = field->getFieldValueData();
+	size_t valueLen = field->getFieldValueLength();
+	const char* token;
+	size_t tokenLen;
+
+	if (!nextToken(value, valueLen, token, tokenLen) || tokenLen != 2 || memcmp(token, "IN", 2) != 0)
+		return false;
+
+	if (!nextToken(value, valueLen, token, tokenLen) || tokenLen != 3 || memcmp(token, "IP", 2) != 0 || (token[2] != '4' && token[2] != '6'))
+		return false;
+
+	uint8_t ipVersion = (uint8_t)(token[2] - '0');
+
+	// a multicast address may be followed by a TTL and a number of addresses, e.g "224.2.1.1/127/3"
+	if (!nextToken(value, valueLen, token, tokenLen))
+		return false;
+
+	size_t addressLen = 0;
+	while (addressLen < tokenLen && token[addressLen] != '/')
+		addressLen++;
+
+	if (addressLen == 0 || addressLen > SIP_MAX_ADDRESS_STRING_LEN)
+		return false;
+
+	char addressString[SIP_MAX_ADDRESS_STRING_LEN + 1];
+	memcpy(addressString, token, addressLen);
+	addressString[addressLen] = 0;
+
+	memset(&endpoint, 0, sizeof(endpoint));
+	endpoint.ipVersion = ipVersion;
+	if (ipVersion == 4)
+	{
+		IPv4Address address(addressString);
+		if (!address.isValid() || address == IPv4Address::Zero)
+			return false;
+
+		uint32_t addressAsInt = address.toInt();
+		memcpy(endpoint.ipAddress, &addressAsInt, sizeof(addressAsInt));
+	}
+	else
+	{
+		IPv6Address address(addressString);
+		if (!address.isValid() || address == IPv6Address::Zero)
+			return false;
+
+		address.copyTo(endpoint.ipAddress);
+	}
+
+	return true;
+}
+
+// parse the port of a SDP media description field, e.g "audio 49170 RTP/AVP 0". Media sent over TCP isn't tracked
+static bool parseSdpMediaPort(HeaderField* field, uint16_t& port)
+{
+	const char* value = field->getFieldValueData();
+	size_t valueLen = field->getFieldValueLength();
+	const char* token;
+	size_t tokenLen;
+
+	if (!nextToken(value, valueLen, token, tokenLen))
+		return false;
+
+	// the port may be followed by a number of ports, e.g "49170/2"
+	if (!nextToken(value, valueLen, token, tokenLen))
+		return false;
+
+	size_t portLen = 0;
+	while (portLen < tokenLen && token[portLen] != '/')
+		portLen++;
+
+	uint32_t portNumber;
+	if (!parseNumber(token, portLen, portNumber) || portNumber == 0 || portNumber > 0xffff)
+		return false;
+
+	if (!nextToken(value, valueLen, token, tokenLen) || (tokenLen >= 3 && memcmp(token, "TCP", 3) == 0))
+		return false;
+
+	port = (uint16_t)portNumber;
+	return true;
+}
+
+static inline bool isFieldName(HeaderField* field, char name)
+{
+	return field->getFieldNameLength() == 1 && field->getFieldNameData()[0] == name;
+}
+
+
+SipDialogTracker::SipDialogTracker(OnSipDialogEnd onDialogEnd, void* userCookie, const SipDialogTrackerConfiguration& config) :
+	m_OnDialogEnd(onDialogEnd), m_UserCookie(userCookie), m_Config(config), m_FreeEntries(NULL), m_CurrentTime(0), m_NumOfRejectedDialogs(0)
+{
+}
+
+SipDialogTracker::~SipDialogTracker()
+{
+	clear();
+
+	while (m_FreeEntries != NULL)
+	{
+		DialogEntry* next = m_FreeEntries->nextFree;
+		delete m_FreeEntries;
+		m_FreeEntries = next;
+	}
+}
+
+SipDialog* SipDialogTracker::processPacket(Packet& packet)
+{
+	if (packet.getRawPacket() != NULL)
+		setCurrentTime(packet.getRawPacket()->getPacketTimeStampNs().tv_sec);
+
+	SipLayer* sipLayer = NULL;
+	bool isRequest = false;
+	SipRequestLayer::SipMethod method = SipRequestLayer::SipMethodUnknown;
+	int statusCode = 0;
+
+	SipRequestLayer* request = packet.getLayerOfType<SipRequestLayer>();
+	if (request != NULL)
+	{
+		sipLayer = request;
+		isRequest = true;
+		method = request->getFirstLine()->getMethod();
+	}
+	else
+	{
+		SipResponseLayer* response = packet.getLayerOfType<SipResponseLayer>();
+		if (response == NULL)
+			return NULL;
+
+		sipLayer = response;
+		statusCode = response->getFirstLine()->getStatusCodeAsInt();
+	}
+
+	HeaderField* callIdField = getSipField(sipLayer, PCPP_SIP_CALL_ID_FIELD, PCPP_SIP_CALL_ID_COMPACT_FIELD);
+	if (callIdField == NULL)
+		return NULL;
+
+	const char* callId = callIdField->getFieldValueData();
+	size_t callIdLength = callIdField->getFieldValueLength();
+	trim(callId, callIdLength);
+	if (callIdLength == 0 || callIdLength > SipDialog::MaxCallIdLength)
+	{
+		LOG_DEBUG("SIP message with an empty Call-ID or a Call-ID longer than %d bytes isn't tracked", (int)SipDialog::MaxCallIdLength);
+		return NULL;
+	}
+
+	uint32_t hash = hashCallId(callId, callIdLength);
+	DialogEntry* entry = findDialogEntry(callId, callIdLength, hash);
+	if (entry == NULL)
+	{
+		// only INVITE requests create dialogs, other messages of unknown dialogs (e.g REGISTER or OPTIONS) are ignored
+		if (!isRequest || method != SipRequestLayer::SipINVITE)
+			return NULL;
+
+		if (m_DialogIndex.getSize() >= m_Config.maxNumOfDialogs)
+		{
+			LOG_DEBUG("Reached the maximum number of dialogs (%d), ignoring a new dialog", (int)m_Config.maxNumOfDialogs);
+			m_NumOfRejectedDialogs++;
+			return NULL;
+		}
+
+		entry = createDialog(callId, callIdLength, hash);
+	}
+
+	processSipMessage(entry, sipLayer, isRequest, method, statusCode);
+
+	SdpLayer* sdpLayer = packet.getLayerOfType<SdpLayer>();
+	if (sdpLayer != NULL)
+		addMediaEndpoints(entry, sdpLayer);
+
+	return &entry->dialog;
+}
+
+void SipDialogTracker::processSipMessage(DialogEntry* entry, SipLayer* sipLayer, bool isRequest, SipRequestLayer::SipMethod method, int statusCode)
+{
+	SipDialog& dialog = entry->dialog;
+	dialog.numOfSipMessages++;
+	dialog.lastActivityTime = m_CurrentTime;
+
+	uint32_t cseq;
+	SipRequestLayer::SipMethod cseqMethod;
+	if (parseCSeq(sipLayer->getFieldByName(PCPP_SIP_CSEQ_FIELD), cseq, cseqMethod))
+	{
+		dialog.lastCSeq = cseq;
+		dialog.lastCSeqMethod = cseqMethod;
+	}
+	else
+		cseqMethod = (isRequest ? method : SipRequestLayer::SipMethodUnknown);
+
+	if (dialog.fromTag[0] == 0)
+		extractTag(getSipField(sipLayer, PCPP_SIP_FROM_FIELD, PCPP_SIP_FROM_COMPACT_FIELD), dialog.fromTag);
+	if (dialog.toTag[0] == 0)
+		extractTag(getSipField(sipLayer, PCPP_SIP_TO_FIELD, PCPP_SIP_TO_COMPACT_FIELD), dialog.toTag);
+
+	if (isRequest)
+	{
+		if (method == SipRequestLayer::SipBYE && dialog.state != SipDialogFailed)
+			dialog.state = SipDialogTerminated;
+		else if (method == SipRequestLayer::SipCANCEL && dialog.state == SipDialogEarly)
+			dialog.state = SipDialogFailed;
+	}
+	else if (cseqMethod == SipRequestLayer::SipINVITE && dialog.state == SipDialogEarly)
+	{
+		// a failure response to a re-INVITE doesn't end a confirmed dialog
+		if (statusCode >= 200 && statusCode < 300)
+			dialog.state = SipDialogConfirmed;
+		else if (statusCode >= 300)
+			dialog.state = SipDialogFailed;
+	}
+
+	bool ended = (dialog.state == SipDialogTerminated || dialog.state == SipDialogFailed);
+	touchDialog(entry, ended ? m_Config.terminatedDialogTimeout : m_Config.dialogTimeout);
+}
+
+void SipDialogTracker::addMediaEndpoints(DialogEntry* entry, SdpLayer* sdpLayer)
+{
+	// the session level connection field applies to all media descriptions, a connection field after a media description applies only
+	// to it. The fields are walked in order, so media descriptions are added once their own connection field is known
+	SipMediaEndpoint sessionEndpoint;
+	SipMediaEndpoint mediaEndpoint;
+	bool hasSessionAddress = false;
+	bool hasMediaAddress = false;
+	bool inMediaDescription = false;
+	bool hasMediaPort = false;
+	uint16_t mediaPort = 0;
+
+	for (HeaderField* field = sdpLayer->getFirstField(); ; field = sdpLayer->getNextField(field))
+	{
+		bool endOfMedia = (field == NULL || field->isEndOfHeader() || isFieldName(field, 'm'));
+		if (endOfMedia && hasMediaPort && (hasMediaAddress || hasSessionAddress))
+		{
+			SipMediaEndpoint endpoint = (hasMediaAddress ? mediaEndpoint : sessionEndpoint);
+			endpoint.port = mediaPort;
+			addMediaEndpoint(entry, endpoint);
+		}
+
+		if (field == NULL || field->isEndOfHeader())
+			break;
+
+		if (isFieldName(field, 'm'))
+		{
+			hasMediaPort = parseSdpMediaPort(field, mediaPort);
+			hasMediaAddress = false;
+			inMediaDescription = true;
+		}
+		else if (isFieldName(field, 'c'))
+		{
+			// connection fields which precede all media descriptions are session level
+			if (!inMediaDescription)
+				hasSessionAddress = parseSdpConnection(field, sessionEndpoint);
+			else
+				hasMediaAddress = parseSdpConnection(field, mediaEndpoint);
+		}
+	}
+}
+
+void SipDialogTracker::addMediaEndpoint(DialogEntry* entry, const SipMediaEndpoint& endpoint)
+{
+	SipDialog& dialog = entry->dialog;
+
+	bool known = false;
+	for (size_t i = 0; i < dialog.numOfMediaEndpoints; i++)
+	{
+		if (isEndpointEqual(dialog.mediaEndpoints[i], endpoint))
+		{
+			known = true;
+			break;
+		}
+	}
+
+	if (!known)
+	{
+		if (dialog.numOfMediaEndpoints == SipDialog::MaxMediaEndpoints)
+		{
+			eraseEndpoint(dialog.mediaEndpoints[0], entry);
+			memmove(dialog.mediaEndpoints, dialog.mediaEndpoints + 1, (SipDialog::MaxMediaEndpoints - 1) * sizeof(SipMediaEndpoint));
+			dialog.numOfMediaEndpoints--;
+		}
+
+		dialog.mediaEndpoints[dialog.numOfMediaEndpoints++] = endpoint;
+	}
+
+	// an endpoint announced by an earlier dialog (e.g a port reused by a new call) now belongs to this dialog
+	insertEndpoint(endpoint, entry);
+}
+
+SipDialog* SipDialogTracker::classifyMediaPacket(const PacketView& view, time_t packetTime)
+{
+	setCurrentTime(packetTime);
+
+	if (m_EndpointIndex.getSize() == 0 || !view.isPacketOfType(UDP) || (view.ipVersion != 4 && view.ipVersion != 6))
+		return NULL;
+
+	size_t addressLen = (view.ipVersion == 4 ? 4 : 16);
+	SipMediaEndpoint endpoint;
+	memset(&endpoint, 0, sizeof(endpoint));
+	endpoint.ipVersion = view.ipVersion;
+
+	DialogEntry* entry = NULL;
+	for (int side = 0; side < 2 && entry == NULL; side++)
+	{
+		memcpy(endpoint.ipAddress, (side == 0 ? view.dstIP : view.srcIP), addressLen);
+		endpoint.port = (side == 0 ? view.dstPort : view.srcPort);
+		entry = findEndpoint(endpoint);
+
+		// RTCP is sent to the port following the RTP port
+		if (entry == NULL && endpoint.port > 0)
+		{
+			endpoint.port--;
+			entry = findEndpoint(endpoint);
+		}
+	}
+
+	if (entry == NULL)
+		return NULL;
+
+	SipDialog& dialog = entry->dialog;
+	dialog.numOfMediaPackets++;
+	dialog.lastActivityTime = m_CurrentTime;
+
+	// media keeps an active dialog alive, but doesn't extend the time an ended dialog is kept
+	if (dialog.state == SipDialogEarly || dialog.state == SipDialogConfirmed)
+		touchDialog(entry, m_Config.dialogTimeout);
+
+	return &dialog;
+}
+
+SipDialog* SipDialogTracker::findDialog(const char* callId, size_t callIdLength) const
+{
+	if (callId == NULL)
+		return NULL;
+
+	DialogEntry* entry = findDialogEntry(callId, callIdLength, hashCallId(callId, callIdLength));
+	return (entry != NULL ? &entry->dialog : NULL);
+}
+
+void SipDialogTracker::setCurrentTime(time_t currentTime)
+{
+	// time only moves forward, and the timers have a resolution of a second
+	if (currentTime <= m_CurrentTime)
+		return;
+
+	m_CurrentTime = currentTime;
+	m_Timers.advance((uint64_t)currentTime);
+
+	uint64_t userValue;
+	while (m_Timers.popExpired(userValue))
+	{
+		DialogEntry* entry = (DialogEntry*)(size_t)userValue;
+
+		// the timer was already removed from the wheel
+		entry->timerId = TimerWheel::InvalidTimerId;
+
+		LOG_DEBUG("Dialog with Call-ID '%s' is removed", entry->dialog.callId);
+		if (m_OnDialogEnd != NULL)
+			m_OnDialogEnd(entry->dialog, m_UserCookie);
+
+		removeDialog(entry);
+	}
+}
+
+void SipDialogTracker::clear()
+{
+	for (size_t i = 0; i < m_DialogIndex.getNumOfSlots(); i++)
+	{
+		DialogEntry* entry = m_DialogIndex.getSlot(i).entry;
+		if (entry == NULL)
+			continue;
+
+		entry->nextFree = m_FreeEntries;
+		m_FreeEntries = entry;
+	}
+
+	m_DialogIndex.clear();
+	m_EndpointIndex.clear();
+	m_Timers.clear();
+}
+
+void SipDialogTracker::touchDialog(DialogEntry* entry, uint32_t timeout)
+{
+	uint64_t expiry = (uint64_t)m_CurrentTime + timeout;
+
+	if (entry->timerId == TimerWheel::InvalidTimerId)
+		entry->timerId = m_Timers.addTimer(expiry, (uint64_t)(size_t)entry);
+	else if (m_Timers.getExpiryTick(entry->timerId) != expiry)
+		m_Timers.rescheduleTimer(entry->timerId, expiry);
+}
+
+SipDialogTracker::DialogEntry* SipDialogTracker::createDialog(const char* callId, size_t callIdLength, uint32_t hash)
+{
+	DialogEntry* entry = m_FreeEntries;
+	if (entry != NULL)
+		m_FreeEntries = entry->nextFree;
+	else
+		entry = new DialogEntry();
+
+	memset(&entry->dialog, 0, sizeof(entry->dialog));
+	memcpy(entry->dialog.callId, callId, callIdLength);
+	entry->dialog.callId[callIdLength] = 0;
+	entry->dialog.lastCSeqMethod = SipRequestLayer::SipMethodUnknown;
+	entry->dialog.state = SipDialogEarly;
+	entry->dialog.startTime = m_CurrentTime;
+	entry->callIdHash = hash;
+	entry->callIdLength = callIdLength;
+	entry->timerId = TimerWheel::InvalidTimerId;
+	entry->nextFree = NULL;
+
+	insertDialog(entry);
+	return entry;
+}
+
+void SipDialogTracker::removeDialog(DialogEntry* entry)
+{
+	if (entry->timerId != TimerWheel::InvalidTimerId)
+	{
+		m_Timers.removeTimer(entry->timerId);
+		entry->timerId = TimerWheel::InvalidTimerId;
+	}
+
+	for (size_t i = 0; i < entry->dialog.numOfMediaEndpoints; i++)
+		eraseEndpoint(entry->dialog.mediaEndpoints[i], entry);
+
+	eraseDialog(entry);
+
+	entry->nextFree = m_FreeEntries;
+	m_FreeEntries = entry;
+}
+
+bool SipDialogTracker::MatchCallId::operator()(const DialogSlot& slot) const
+{
+	// Call-IDs are compared only on a hash match
+	return slot.entry->callIdLength == callIdLength && memcmp(slot.entry->dialog.callId, callId, callIdLength) == 0;
+}
+
+SipDialogTracker::DialogEntry* SipDialogTracker::findDialogEntry(const char* callId, size_t callIdLength, uint32_t hash) const
+{
+	const DialogSlot* slot = m_DialogIndex.find(hash, MatchCallId(callId, callIdLength));
+	return (slot != NULL ? slot->entry : NULL);
+}
+
+void SipDialogTracker::insertDialog(DialogEntry* entry)
+{
+	m_DialogIndex.insert(entry->callIdHash, MatchCallId(entry->dialog.callId, entry->callIdLength)).entry = entry;
+}
+
+void SipDialogTracker::eraseDialog(DialogEntry* entry)
+{
+	DialogSlot* slot = m_DialogIndex.find(entry->callIdHash, MatchCallId(entry->dialog.callId, entry->callIdLength));
+	if (slot != NULL && slot->entry == entry)
+		m_DialogIndex.erase(slot);
+}
+
+bool SipDialogTracker::MatchEndpoint::operator()(const EndpointSlot& slot) const
+{
+	return isEndpointEqual(slot.endpoint, endpoint);
+}
+
+SipDialogTracker::DialogEntry* SipDialogTracker::findEndpoint(const SipMediaEndpoint& endpoint) const
+{
+	const EndpointSlot* slot = m_EndpointIndex.find(hashEndpoint(endpoint), MatchEndpoint(endpoint));
+	return (slot != NULL ? slot->entry : NULL);
+}
+
+void SipDialogTracker::insertEndpoint(const SipMediaEndpoint& endpoint, DialogEntry* entry)
+{
+	EndpointSlot& slot = m_EndpointIndex.insert(hashEndpoint(endpoint), MatchEndpoint(endpoint));
+	if (slot.entry == NULL)
+		slot.endpoint = endpoint;
+
+	slot.entry = entry;
+}
+
+void SipDialogTracker::eraseEndpoint(const SipMediaEndpoint& endpoint, DialogEntry* entry)
+{
+	// the endpoint may have been taken over by another dialog, in which case it stays
+	EndpointSlot* slot = m_EndpointIndex.find(hashEndpoint(endpoint), MatchEndpoint(endpoint));
+	if (slot != NULL && slot->entry == entry)
+		m_EndpointIndex.erase(slot);
+}
+
+} // namespace pcpp
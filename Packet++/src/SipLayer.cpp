@@ -4,6 +4,7 @@
 #include "SdpLayer.h"
 #include "PayloadLayer.h"
 #include "Logger.h"
+#include "GeneralUtils.h"
 #include <string.h>
 #include <algorithm>
 #include <stdlib.h>
@@ -36,9 +37,8 @@ const std::string SipMethodEnumToString[14] = {
 
 int SipLayer::getContentLength()
 {
-	std::string contentLengthFieldName(PCPP_SIP_CONTENT_LENGTH_FIELD);
-	std::transform(contentLengthFieldName.begin(), contentLengthFieldName.end(), contentLengthFieldName.begin(), ::tolower);
-	HeaderField* contentLengthField = getFieldByName(contentLengthFieldName);
+	// field names are matched case-insensitively
+	HeaderField* contentLengthField = getFieldByName(PCPP_SIP_CONTENT_LENGTH_FIELD);
 	if (contentLengthField != NULL)
 		return atoi(contentLengthField->getFieldValue().c_str());
 	return 0;
@@ -69,11 +69,11 @@ void SipLayer::parseNextLayer()
 	size_t headerLen = getHeaderLen();
 	if (getContentLength() > 0)
 	{
-		m_NextLayer = new SdpLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) SdpLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 	}
 	else
 	{
-		m_NextLayer = new PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 	}
 }
 
@@ -286,8 +286,12 @@ SipRequestLayer::SipMethod SipRequestFirstLine::parseMethod(char* data, size_t d
 
 void SipRequestFirstLine::parseVersion()
 {
-	char* data = (char*)(m_SipRequest->m_Data + m_UriOffset);
-	char* verPos = strstr(data, " SIP/");
+	// the message isn't null-terminated, so the search is bounded by its length
+	size_t searchOffset = (m_UriOffset > 0 ? (size_t)m_UriOffset : 0);
+	if (searchOffset > m_SipRequest->getDataLen())
+		searchOffset = m_SipRequest->getDataLen();
+	char* data = (char*)(m_SipRequest->m_Data + searchOffset);
+	char* verPos = (char*)findSubstring(data, m_SipRequest->getDataLen() - searchOffset, " SIP/", 5);
 	if (verPos == NULL)
 	{
 		m_Version = "";
@@ -492,7 +496,8 @@ std::string SipRequestLayer::toString()
 
 
 
-const std::string StatusCodeEnumToString[74] = {
+// string literals rather than std::strings, many of which would allocate memory at startup
+const char* const StatusCodeEnumToString[74] = {
 		"Trying",
 		"Ringing",
 		"Call is Being Forwarded",
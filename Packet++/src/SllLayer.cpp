@@ -9,6 +9,7 @@
 #include "VlanLayer.h"
 #include "PPPoELayer.h"
 #include "MplsLayer.h"
+#include "ProtocolRegistry.h"
 #include <string.h>
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 #include <winsock2.h>
@@ -66,42 +67,42 @@ void SllLayer::parseNextLayer()
 		return;
 
 	sll_header* hdr = getSllHeader();
-	switch (ntohs(hdr->protocol_type))
+	switch (ProtocolRegistry::getInstance().getProtocolByEtherType(ntohs(hdr->protocol_type)))
 	{
-	case PCPP_ETHERTYPE_IP:
-		m_NextLayer = new IPv4Layer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
+	case IPv4:
+		m_NextLayer = new(m_Packet) IPv4Layer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_IPV6:
-		m_NextLayer = new IPv6Layer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
+	case IPv6:
+		m_NextLayer = new(m_Packet) IPv6Layer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_ARP:
-		m_NextLayer = new ArpLayer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
+	case ARP:
+		m_NextLayer = new(m_Packet) ArpLayer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_VLAN:
-		m_NextLayer = new VlanLayer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
+	case VLAN:
+		m_NextLayer = new(m_Packet) VlanLayer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_PPPOES:
-		m_NextLayer = new PPPoESessionLayer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
+	case PPPoESession:
+		m_NextLayer = new(m_Packet) PPPoESessionLayer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_PPPOED:
-		m_NextLayer = new PPPoEDiscoveryLayer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
+	case PPPoEDiscovery:
+		m_NextLayer = new(m_Packet) PPPoEDiscoveryLayer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_MPLS:
-		m_NextLayer = new MplsLayer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
+	case MPLS:
+		m_NextLayer = new(m_Packet) MplsLayer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
 		break;
 	default:
-		m_NextLayer = new PayloadLayer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + sizeof(sll_header), m_DataLen - sizeof(sll_header), this, m_Packet);
 	}
 
 }
 
 void SllLayer::computeCalculateFields()
 {
-	if (m_NextLayer == NULL)
+	if (getNextLayer() == NULL)
 		return;
 
 	sll_header* hdr = getSllHeader();
-	switch (m_NextLayer->getProtocol())
+	switch (getNextLayer()->getProtocol())
 	{
 		case IPv4:
 			hdr->protocol_type = htons(PCPP_ETHERTYPE_IP);
@@ -122,7 +123,15 @@ void SllLayer::computeCalculateFields()
 
 std::string SllLayer::toString()
 {
-	return "Linux cooked header";
+	return PacketDumpWriter::layerToString(*this);
+}
+
+void SllLayer::dump(PacketDumpWriter& writer)
+{
+	writer.beginLayer("Linux cooked header", SLL);
+	writer.addNumber(NULL, "packetType", ntohs(getSllHeader()->packet_type));
+	writer.addNumber(NULL, "etherType", ntohs(getSllHeader()->protocol_type));
+	writer.endLayer();
 }
 
 } // namespace pcpp
@@ -0,0 +1,418 @@
+#define LOG_MODULE PacketLogModuleStreamCoroutine
+
+#include "StreamCoroutine.h"
+#include "Logger.h"
+#include <string.h>
+
+namespace pcpp
+{
+
+// frames are aligned to this, which suits any member of a coroutine class
+#define STREAM_COROUTINE_FRAME_ALIGNMENT 16
+
+static const uint8_t* findDelimiter(const uint8_t* data, size_t dataLen, const char* delimiter, size_t delimiterLen)
+{
+	const uint8_t* end = data + dataLen;
+	while ((size_t)(end - data) >= delimiterLen)
+	{
+		const uint8_t* candidate = (const uint8_t*)memchr(data, delimiter[0], end - data - delimiterLen + 1);
+		if (candidate == NULL)
+			return NULL;
+
+		if (memcmp(candidate + 1, delimiter + 1, delimiterLen - 1) == 0)
+			return candidate;
+
+		data = candidate + 1;
+	}
+
+	return NULL;
+}
+
+
+// ~~~~~~~~~~~~~~~~
+// ByteStreamReader
+// ~~~~~~~~~~~~~~~~
+
+ByteStreamReader::ByteStreamReader(size_t maxReadLength) :
+	m_Data(NULL), m_DataLen(0), m_Offset(0), m_Position(0), m_MaxReadLength(maxReadLength), m_BufferReturned(false), m_SkipRemaining(0),
+	m_Skipping(false), m_Ended(false), m_Overflowed(false)
+{
+}
+
+void ByteStreamReader::feed(const uint8_t* data, size_t dataLen)
+{
+	m_Data = data;
+	m_DataLen = dataLen;
+	m_Offset = 0;
+}
+
+void ByteStreamReader::releaseBuffer()
+{
+	if (m_BufferReturned)
+	{
+		m_Buffer.clear();
+		m_BufferReturned = false;
+	}
+}
+
+void ByteStreamReader::consume(size_t numOfBytes)
+{
+	m_Offset += numOfBytes;
+	m_Position += numOfBytes;
+}
+
+bool ByteStreamReader::overflow()
+{
+	if (!m_Overflowed)
+		LOG_DEBUG("A read of the stream is longer than %d bytes", (int)m_MaxReadLength);
+
+	m_Overflowed = true;
+	m_Buffer.clear();
+	return false;
+}
+
+bool ByteStreamReader::read(size_t numOfBytes, ByteStreamSlice& slice)
+{
+	releaseBuffer();
+	if (m_Overflowed)
+		return false;
+
+	if (numOfBytes > m_MaxReadLength)
+		return overflow();
+
+	size_t available = getAvailableBytes();
+	if (m_Buffer.empty() && available >= numOfBytes)
+	{
+		// the common case: the bytes are in the current piece
+		slice = ByteStreamSlice(m_Data + m_Offset, numOfBytes);
+		consume(numOfBytes);
+		return true;
+	}
+
+	size_t numToCopy = numOfBytes - m_Buffer.size();
+	if (numToCopy > available)
+		numToCopy = available;
+
+	m_Buffer.insert(m_Buffer.end(), m_Data + m_Offset, m_Data + m_Offset + numToCopy);
+	consume(numToCopy);
+	if (m_Buffer.size() < numOfBytes)
+		return false;
+
+	slice = ByteStreamSlice(&m_Buffer[0], numOfBytes);
+	m_BufferReturned = true;
+	return true;
+}
+
+bool ByteStreamReader::readUntil(const char* delimiter, size_t delimiterLen, ByteStreamSlice& slice)
+{
+	releaseBuffer();
+	if (m_Overflowed)
+		return false;
+
+	if (delimiterLen == 0)
+	{
+		slice = ByteStreamSlice();
+		return true;
+	}
+
+	const uint8_t* data = m_Data + m_Offset;
+	size_t available = getAvailableBytes();
+
+	if (m_Buffer.empty())
+	{
+		const uint8_t* found = findDelimiter(data, available, delimiter, delimiterLen);
+		if (found != NULL)
+		{
+			size_t length = found - data;
+			if (length > m_MaxReadLength)
+				return overflow();
+
+			slice = ByteStreamSlice(data, length);
+			consume(length + delimiterLen);
+			return true;
+		}
+	}
+	else
+	{
+		// the delimiter may start in the buffered bytes and end in this piece. The earliest start is checked first
+		size_t maxSplit = (m_Buffer.size() < delimiterLen - 1 ? m_Buffer.size() : delimiterLen - 1);
+		for (size_t numInBuffer = maxSplit; numInBuffer > 0; numInBuffer--)
+		{
+			size_t numInData = delimiterLen - numInBuffer;
+			if (numInData > available)
+				continue;
+
+			if (memcmp(&m_Buffer[m_Buffer.size() - numInBuffer], delimiter, numInBuffer) == 0 &&
+					memcmp(data, delimiter + numInBuffer, numInData) == 0)
+			{
+				m_Buffer.resize(m_Buffer.size() - numInBuffer);
+				consume(numInData);
+				slice = ByteStreamSlice(m_Buffer.empty() ? NULL : &m_Buffer[0], m_Buffer.size());
+				m_BufferReturned = true;
+				return true;
+			}
+		}
+
+		const uint8_t* found = findDelimiter(data, available, delimiter, delimiterLen);
+		if (found != NULL)
+		{
+			size_t length = found - data;
+			if (m_Buffer.size() + length > m_MaxReadLength)
+				return overflow();
+
+			m_Buffer.insert(m_Buffer.end(), data, found);
+			consume(length + delimiterLen);
+			slice = ByteStreamSlice(&m_Buffer[0], m_Buffer.size());
+			m_BufferReturned = true;
+			return true;
+		}
+	}
+
+	// the delimiter isn't in this piece, so keep its bytes for the next one. They may end with the first bytes of the delimiter
+	if (m_Buffer.size() + available > m_MaxReadLength + delimiterLen - 1)
+		return overflow();
+
+	m_Buffer.insert(m_Buffer.end(), data, data + available);
+	consume(available);
+	return false;
+}
+
+bool ByteStreamReader::readSome(size_t maxBytes, ByteStreamSlice& slice)
+{
+	releaseBuffer();
+	size_t available = getAvailableBytes();
+	if (m_Overflowed || available == 0 || maxBytes == 0)
+		return false;
+
+	size_t length = (available < maxBytes ? available : maxBytes);
+	slice = ByteStreamSlice(m_Data + m_Offset, length);
+	consume(length);
+	return true;
+}
+
+bool ByteStreamReader::skip(uint64_t numOfBytes)
+{
+	releaseBuffer();
+	if (!m_Skipping)
+	{
+		m_SkipRemaining = numOfBytes;
+		m_Skipping = true;
+	}
+
+	size_t available = getAvailableBytes();
+	size_t numToSkip = (m_SkipRemaining < available ? (size_t)m_SkipRemaining : available);
+	consume(numToSkip);
+	m_SkipRemaining -= numToSkip;
+	if (m_SkipRemaining > 0)
+		return false;
+
+	m_Skipping = false;
+	return true;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~
+// StreamCoroutinePool
+// ~~~~~~~~~~~~~~~~~~~
+
+StreamCoroutinePool::StreamCoroutinePool(size_t frameSize, size_t framesPerBlock) :
+	m_FramesPerBlock(framesPerBlock > 0 ? framesPerBlock : 1), m_FreeList(NULL), m_NumOfFramesInUse(0)
+{
+	if (frameSize < sizeof(void*))
+		frameSize = sizeof(void*);
+
+	m_FrameSize = (frameSize + STREAM_COROUTINE_FRAME_ALIGNMENT - 1) & ~(size_t)(STREAM_COROUTINE_FRAME_ALIGNMENT - 1);
+}
+
+StreamCoroutinePool::~StreamCoroutinePool()
+{
+	for (std::vector<uint8_t*>::iterator iter = m_Blocks.begin(); iter != m_Blocks.end(); ++iter)
+		delete [] *iter;
+}
+
+void* StreamCoroutinePool::allocate(size_t size)
+{
+	if (size > m_FrameSize)
+	{
+		LOG_ERROR("Coroutine of %d bytes doesn't fit in a frame of %d bytes", (int)size, (int)m_FrameSize);
+		return NULL;
+	}
+
+	if (m_FreeList == NULL)
+	{
+		// operator new[] returns memory aligned for any fundamental type, and the frame size keeps the following frames aligned too
+		uint8_t* block = new uint8_t[m_FrameSize * m_FramesPerBlock];
+		m_Blocks.push_back(block);
+		for (size_t i = m_FramesPerBlock; i > 0; i--)
+		{
+			void* frame = block + (i - 1) * m_FrameSize;
+			*(void**)frame = m_FreeList;
+			m_FreeList = frame;
+		}
+	}
+
+	void* frame = m_FreeList;
+	m_FreeList = *(void**)frame;
+	m_NumOfFramesInUse++;
+	return frame;
+}
+
+void StreamCoroutinePool::release(void* frame)
+{
+	if (frame == NULL)
+		return;
+
+	*(void**)frame = m_FreeList;
+	m_FreeList = frame;
+	m_NumOfFramesInUse--;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+// StreamCoroutineDispatcher
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+
+StreamCoroutineDispatcher::StreamCoroutineDispatcher(CreateStreamCoroutine createCoroutine, void* userCookie, const StreamCoroutineDispatcherConfiguration& config) :
+	m_CreateCoroutine(createCoroutine), m_UserCookie(userCookie), m_Config(config), m_Pool(config.maxCoroutineSize, config.framesPerBlock),
+	m_LastConnection(NULL), m_LastFlowKey(0), m_NumOfCoroutinesCreated(0), m_NumOfCoroutinesDone(0), m_NumOfCoroutinesFailed(0),
+	m_NumOfCoroutinesInterrupted(0)
+{
+}
+
+StreamCoroutineDispatcher::~StreamCoroutineDispatcher()
+{
+	clear();
+}
+
+void StreamCoroutineDispatcher::clear()
+{
+	for (std::map<uint32_t, ConnectionState*>::iterator iter = m_Connections.begin(); iter != m_Connections.end(); ++iter)
+	{
+		for (int side = 0; side < 2; side++)
+			destroyCoroutine(iter->second->sides[side]);
+
+		delete iter->second;
+	}
+
+	m_Connections.clear();
+	m_LastConnection = NULL;
+}
+
+StreamCoroutineDispatcher::ConnectionState* StreamCoroutineDispatcher::getConnection(uint32_t flowKey)
+{
+	if (m_LastConnection != NULL && m_LastFlowKey == flowKey)
+		return m_LastConnection;
+
+	ConnectionState*& conn = m_Connections[flowKey];
+	if (conn == NULL)
+	{
+		conn = new ConnectionState();
+		for (int side = 0; side < 2; side++)
+		{
+			SideState& sideState = conn->sides[side];
+			sideState.coroutine = NULL;
+			sideState.started = false;
+			sideState.stream.setMaxReadLength(m_Config.maxReadLength);
+		}
+	}
+
+	m_LastConnection = conn;
+	m_LastFlowKey = flowKey;
+	return conn;
+}
+
+void StreamCoroutineDispatcher::parse(int side, const TcpStreamData& tcpData)
+{
+	parse(side, tcpData.getData(), tcpData.getDataLength(), tcpData.getConnectionDataRef());
+}
+
+void StreamCoroutineDispatcher::parse(int side, const uint8_t* data, size_t dataLen, const ConnectionData& connectionData)
+{
+	if (side != 0 && side != 1)
+	{
+		LOG_ERROR("Side must be 0 or 1");
+		return;
+	}
+
+	SideState& sideState = getConnection(connectionData.flowKey)->sides[side];
+	if (!sideState.started)
+	{
+		sideState.started = true;
+		sideState.coroutine = m_CreateCoroutine(connectionData, side, m_Pool, m_UserCookie);
+		if (sideState.coroutine != NULL)
+			m_NumOfCoroutinesCreated++;
+	}
+
+	if (sideState.coroutine == NULL)
+		return;
+
+	sideState.stream.feed(data, dataLen);
+	resumeCoroutine(sideState);
+}
+
+void StreamCoroutineDispatcher::connectionEnded(const ConnectionData& connectionData)
+{
+	std::map<uint32_t, ConnectionState*>::iterator iter = m_Connections.find(connectionData.flowKey);
+	if (iter == m_Connections.end())
+		return;
+
+	ConnectionState* conn = iter->second;
+	for (int side = 0; side < 2; side++)
+	{
+		SideState& sideState = conn->sides[side];
+		if (sideState.coroutine == NULL)
+			continue;
+
+		sideState.stream.feed(NULL, 0);
+		sideState.stream.setEnded();
+		resumeCoroutine(sideState);
+	}
+
+	if (m_LastConnection == conn)
+		m_LastConnection = NULL;
+
+	delete conn;
+	m_Connections.erase(iter);
+}
+
+void StreamCoroutineDispatcher::resumeCoroutine(SideState& sideState)
+{
+	StreamCoroutineStatus status = sideState.coroutine->resume(sideState.stream);
+	if (status == StreamCoroutineSuspended)
+	{
+		if (sideState.stream.hasOverflowed())
+			m_NumOfCoroutinesFailed++;
+		else if (sideState.stream.isEnded())
+			m_NumOfCoroutinesInterrupted++;
+		else
+			return;
+	}
+	else if (status == StreamCoroutineDone)
+		m_NumOfCoroutinesDone++;
+	else
+		m_NumOfCoroutinesFailed++;
+
+	destroyCoroutine(sideState);
+}
+
+void StreamCoroutineDispatcher::destroyCoroutine(SideState& sideState)
+{
+	if (sideState.coroutine == NULL)
+		return;
+
+	sideState.coroutine->~StreamCoroutine();
+	m_Pool.release(sideState.coroutine);
+	sideState.coroutine = NULL;
+}
+
+void StreamCoroutineDispatcher::onTcpMessageReady(int side, const TcpStreamData& tcpData, void* userCookie)
+{
+	((StreamCoroutineDispatcher*)userCookie)->parse(side, tcpData);
+}
+
+void StreamCoroutineDispatcher::onTcpConnectionEnd(ConnectionData connectionData, TcpReassembly::ConnectionEndReason reason, void* userCookie)
+{
+	((StreamCoroutineDispatcher*)userCookie)->connectionEnded(connectionData);
+}
+
+} // namespace pcpp
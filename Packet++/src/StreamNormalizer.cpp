@@ -0,0 +1,97 @@
+#define LOG_MODULE PacketLogModuleTcpReassembly
+
+#include "StreamNormalizer.h"
+#include "FlowHash.h"
+
+namespace pcpp
+{
+
+StreamNormalizer::StreamNormalizer(TcpReassembly::OnTcpMessageReady onMessageReadyCallback, void* userCookie, TcpReassembly::OnTcpConnectionStart onConnectionStartCallback,
+		TcpReassembly::OnTcpConnectionEnd onConnectionEndCallback, const TcpReassemblyConfiguration& reassemblyConfig, const StreamNormalizerConfiguration& config) :
+	m_MemoryBudget(config.maxMemoryBytes != 0 ? config.maxMemoryBytes : reassemblyConfig.maxMemoryBytes),
+	m_TcpReassembly(onMessageReadyCallback, userCookie, onConnectionStartCallback, onConnectionEndCallback, reassemblyConfig),
+	m_IPReassembly(NULL, NULL, config.maxFragmentedPackets, 0, EvictLeastRecentlyUsed, config.fragmentTimeout)
+{
+	init(config);
+}
+
+StreamNormalizer::StreamNormalizer(TcpReassembly::OnTcpMessageReadyZeroCopy onMessageReadyCallback, void* userCookie, TcpReassembly::OnTcpConnectionStart onConnectionStartCallback,
+		TcpReassembly::OnTcpConnectionEnd onConnectionEndCallback, const TcpReassemblyConfiguration& reassemblyConfig, const StreamNormalizerConfiguration& config) :
+	m_MemoryBudget(config.maxMemoryBytes != 0 ? config.maxMemoryBytes : reassemblyConfig.maxMemoryBytes),
+	m_TcpReassembly(onMessageReadyCallback, userCookie, onConnectionStartCallback, onConnectionEndCallback, reassemblyConfig),
+	m_IPReassembly(NULL, NULL, config.maxFragmentedPackets, 0, EvictLeastRecentlyUsed, config.fragmentTimeout)
+{
+	init(config);
+}
+
+void StreamNormalizer::init(const StreamNormalizerConfiguration& config)
+{
+	// when the budget is exceeded each stage evicts its own state, the TCP stage after a TCP packet and the IP stage after a fragment
+	m_TcpReassembly.setMemoryBudget(&m_MemoryBudget);
+	m_IPReassembly.setMemoryBudget(&m_MemoryBudget);
+	m_IPReassembly.setRawPacketPool(config.rawPacketPool);
+}
+
+void StreamNormalizer::processPacket(RawPacket* rawPacket)
+{
+	PacketView view;
+	FlowKeyExtractor::extract(rawPacket, view);
+	processPacket(rawPacket, view);
+}
+
+void StreamNormalizer::processPacket(RawPacket* rawPacket, const PacketView& view)
+{
+	if (!view.isFragment)
+	{
+		// the IP stage keeps time with all packets, so fragmented packets whose other fragments were lost expire when no fragments arrive
+		m_IPReassembly.advanceTime(rawPacket->getPacketTimeStamp());
+		m_TcpReassembly.reassemblePacket(rawPacket, view);
+		return;
+	}
+
+	IPReassembly::ReassemblyStatus status;
+	PacketView reassembledView;
+	RawPacket* reassembledPacket = m_IPReassembly.processRawPacket(rawPacket, view, status, reassembledView);
+	if (reassembledPacket == NULL)
+		return;
+
+	// a fragment whose headers are truncated is returned as is, and is handled as any other packet
+	if (reassembledPacket == rawPacket)
+	{
+		m_TcpReassembly.reassemblePacket(rawPacket, view);
+		return;
+	}
+
+	m_TcpReassembly.reassemblePacket(reassembledPacket, reassembledView);
+
+	// returns the buffer to the pool if it was taken from one
+	delete reassembledPacket;
+}
+
+void StreamNormalizer::processPackets(RawPacket* rawPacketsArr, size_t numOfPackets)
+{
+	for (size_t i = 0; i < numOfPackets; i++)
+		processPacket(&rawPacketsArr[i]);
+}
+
+void StreamNormalizer::advanceTime(const timeval& currentTime)
+{
+	m_IPReassembly.advanceTime(currentTime);
+	m_TcpReassembly.advanceTime(currentTime);
+}
+
+bool StreamNormalizer::getShardHash(const PacketView& view, uint32_t& hash)
+{
+	FlowTuple tuple;
+	if (!FlowHash::getTuple(view, tuple))
+		return false;
+
+	// the ports and the protocol aren't known for all fragments
+	tuple.srcPort = 0;
+	tuple.dstPort = 0;
+	tuple.protocol = 0;
+	hash = FlowHash::hashSymmetric(tuple);
+	return true;
+}
+
+} // namespace pcpp
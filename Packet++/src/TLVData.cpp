@@ -80,6 +80,18 @@ void TLVRecordBuilder::init(uint8_t recType, const uint8_t* recValue, uint8_t re
 		memset(m_RecValue, 0, recValueLen);
 }
 
+void TLVRecordBuilder::writeRecord(uint8_t* recordBuffer, size_t recordSize, uint8_t recordLenFieldValue) const
+{
+	memset(recordBuffer, 0, recordSize);
+	recordBuffer[0] = m_RecType;
+	if (recordSize > 1)
+	{
+		recordBuffer[1] = recordLenFieldValue;
+		if (recordSize > 2 && m_RecValue != NULL)
+			memcpy(recordBuffer+2, m_RecValue, recordSize - 2 < m_RecValueLen ? recordSize - 2 : m_RecValueLen);
+	}
+}
+
 
 
 }
@@ -0,0 +1,387 @@
+#define LOG_MODULE PacketLogModuleTcpFlowTracker
+
+#include "TcpFlowTracker.h"
+#include "Logger.h"
+#include <string.h>
+#include <utility>
+
+#define TCP_FLAG_FIN 0x01
+#define TCP_FLAG_SYN 0x02
+#define TCP_FLAG_RST 0x04
+#define TCP_FLAG_ACK 0x10
+
+// SideState flags
+#define SIDE_SEQ_KNOWN   0x01
+#define SIDE_TIMING      0x02
+#define SIDE_SKIPPED     0x04
+#define SIDE_ZERO_WINDOW 0x08
+#define SIDE_FIN         0x10
+
+// ConnectionState flags
+#define CONN_SYN                   0x01
+#define CONN_SYN_RETRANSMITTED     0x02
+#define CONN_SYN_ACK               0x04
+#define CONN_SYN_ACK_RETRANSMITTED 0x08
+#define CONN_HANDSHAKE_ACK         0x10
+#define CONN_ENDED                 0x20
+#define CONN_REPORTED              0x40
+
+namespace pcpp
+{
+
+static inline uint32_t readUInt32(const uint8_t* data)
+{
+	return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+// sequence number comparisons which are right across wrap-around
+static inline bool seqAfter(uint32_t first, uint32_t second)
+{
+	return (int32_t)(first - second) > 0;
+}
+
+TcpFlowTracker::ConnectionState::ConnectionState()
+{
+	memset(this, 0, sizeof(ConnectionState));
+}
+
+TcpFlowTracker::TcpFlowTracker(const TcpFlowTrackerConfiguration& config, OnConnectionReported onConnectionReported, void* userCookie) :
+	m_Config(config), m_OnConnectionReported(onConnectionReported), m_UserCookie(userCookie),
+	m_Connections(FlowTableConfiguration(config.maxConnections, config.idleTimeout, EvictLeastRecentlyUsed), onConnectionRemoved, this),
+	m_CurrentTime(0)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+bool TcpFlowTracker::processPacket(const RawPacket* rawPacket)
+{
+	timespec ts = rawPacket->getPacketTimeStampNs();
+	uint64_t timestamp = (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+	return processPacket(rawPacket->getRawData(), (size_t)rawPacket->getRawDataLen(), rawPacket->getLinkLayerType(), timestamp);
+}
+
+bool TcpFlowTracker::processPacket(const uint8_t* data, size_t dataLen, LinkLayerType linkType, uint64_t timestamp)
+{
+	m_Stats.packets++;
+	advanceTime(timestamp);
+
+	PacketView view;
+	if (!FlowKeyExtractor::extract(data, dataLen, linkType, view) || !view.isPacketOfType(TCP))
+	{
+		m_Stats.nonTcpPackets++;
+		return false;
+	}
+
+	FlowTuple tuple;
+	FlowHash::getTuple(view, tuple);
+	ConnectionKey key;
+	int side = getKey(tuple, view.vlanCount > 0 ? view.vlanId : 0, key);
+
+	// FlowKeyExtractor found the fixed part of the TCP header in the data
+	const uint8_t* tcpHeader = data + view.transportOffset;
+	uint8_t tcpFlags = view.tcpFlags;
+
+	bool isNew;
+	ConnectionState& conn = m_Connections.get(key, &isNew);
+	if (!isNew && (conn.flags & CONN_ENDED) != 0 && (tcpFlags & (TCP_FLAG_SYN | TCP_FLAG_ACK)) == TCP_FLAG_SYN)
+	{
+		// a new connection reusing the tuple of a connection which ended
+		conn = ConnectionState();
+		isNew = true;
+	}
+
+	if (isNew)
+	{
+		m_Stats.connectionsCreated++;
+		conn.firstSeen = timestamp;
+		conn.clientSide = (uint8_t)side;
+	}
+
+	if (timestamp < conn.firstSeen)
+		conn.firstSeen = timestamp;
+	if (timestamp > conn.lastSeen)
+		conn.lastSeen = timestamp;
+
+	trackSegment(conn, side, tcpHeader, view.payloadLength, timestamp);
+
+	if ((conn.flags & CONN_ENDED) == 0)
+	{
+		bool reset = (tcpFlags & TCP_FLAG_RST) != 0;
+		if (reset || ((conn.sides[0].flags & SIDE_FIN) != 0 && (conn.sides[1].flags & SIDE_FIN) != 0))
+		{
+			conn.flags |= CONN_ENDED;
+			reportConnection(key, conn, reset ? TcpFlowEndRst : TcpFlowEndFin);
+			// without an idle timeout the connection would never leave the table
+			if (m_Config.idleTimeout == 0)
+				m_Connections.erase(key);
+		}
+	}
+
+	return true;
+}
+
+void TcpFlowTracker::trackSegment(ConnectionState& conn, int side, const uint8_t* tcpHeader, uint32_t payloadLength, uint64_t timestamp)
+{
+	SideState& sender = conn.sides[side];
+	SideState& receiver = conn.sides[1 - side];
+	uint32_t seq = readUInt32(tcpHeader + 4);
+	uint32_t ack = readUInt32(tcpHeader + 8);
+	uint8_t flags = tcpHeader[13];
+	uint16_t window = ((uint16_t)tcpHeader[14] << 8) | tcpHeader[15];
+	uint32_t now = (uint32_t)timestamp;
+
+	sender.metrics.packets++;
+	sender.metrics.bytes += payloadLength;
+
+	// the handshake
+	if ((flags & TCP_FLAG_SYN) != 0 && (flags & TCP_FLAG_ACK) == 0)
+	{
+		if ((conn.flags & CONN_SYN) != 0)
+		{
+			conn.flags |= CONN_SYN_RETRANSMITTED;
+		}
+		else
+		{
+			conn.flags |= CONN_SYN;
+			conn.synTime = timestamp;
+			conn.clientSide = (uint8_t)side;
+		}
+	}
+	else if ((flags & TCP_FLAG_SYN) != 0)
+	{
+		if ((conn.flags & CONN_SYN_ACK) != 0)
+		{
+			conn.flags |= CONN_SYN_ACK_RETRANSMITTED;
+		}
+		else
+		{
+			conn.flags |= CONN_SYN_ACK;
+			conn.synAckTime = timestamp;
+			// the SYN-ACK tells who the server is even if the SYN wasn't seen
+			conn.clientSide = (uint8_t)(1 - side);
+			if ((conn.flags & (CONN_SYN | CONN_SYN_RETRANSMITTED)) == CONN_SYN && timestamp >= conn.synTime)
+				conn.serverHandshakeRtt = (uint32_t)(timestamp - conn.synTime);
+		}
+	}
+	else if ((flags & TCP_FLAG_ACK) != 0 && (conn.flags & (CONN_SYN_ACK | CONN_HANDSHAKE_ACK)) == CONN_SYN_ACK && side == conn.clientSide)
+	{
+		conn.flags |= CONN_HANDSHAKE_ACK;
+		if ((conn.flags & CONN_SYN_ACK_RETRANSMITTED) == 0 && timestamp >= conn.synAckTime)
+			conn.clientHandshakeRtt = (uint32_t)(timestamp - conn.synAckTime);
+	}
+
+	// the ACK may complete the RTT sample of the other direction
+	if ((flags & TCP_FLAG_ACK) != 0 && (receiver.flags & SIDE_TIMING) != 0 && !seqAfter(receiver.timedSeq, ack))
+	{
+		uint32_t rtt = now - receiver.timedAt;
+		TcpFlowDirectionMetrics& metrics = receiver.metrics;
+		if (metrics.rttSamples == 0 || rtt < metrics.minRtt)
+			metrics.minRtt = rtt;
+		if (rtt > metrics.maxRtt)
+			metrics.maxRtt = rtt;
+		metrics.rttSum += rtt;
+		metrics.rttSamples++;
+		receiver.flags &= ~SIDE_TIMING;
+	}
+
+	// the sequence number of a RST isn't related to the data, and its window is usually 0
+	if ((flags & TCP_FLAG_RST) != 0)
+		return;
+
+	if ((flags & TCP_FLAG_SYN) == 0)
+	{
+		if (window == 0)
+		{
+			if ((sender.flags & SIDE_ZERO_WINDOW) == 0)
+				sender.metrics.zeroWindowEvents++;
+			sender.flags |= SIDE_ZERO_WINDOW;
+		}
+		else
+		{
+			sender.flags &= ~SIDE_ZERO_WINDOW;
+		}
+	}
+
+	if ((flags & TCP_FLAG_FIN) != 0)
+		sender.flags |= SIDE_FIN;
+
+	// SYN and FIN take a sequence number each
+	uint32_t segmentLength = payloadLength + ((flags & TCP_FLAG_SYN) != 0 ? 1 : 0) + ((flags & TCP_FLAG_FIN) != 0 ? 1 : 0);
+	uint32_t segmentEnd = seq + segmentLength;
+	bool newData = false;
+
+	if ((sender.flags & SIDE_SEQ_KNOWN) == 0)
+	{
+		sender.flags |= SIDE_SEQ_KNOWN;
+		sender.nextSeq = segmentEnd;
+		newData = true;
+	}
+	else if (segmentLength == 0)
+	{
+		// a pure ACK
+	}
+	else if (seq == sender.nextSeq)
+	{
+		sender.nextSeq = segmentEnd;
+		newData = true;
+	}
+	else if (seqAfter(seq, sender.nextSeq))
+	{
+		// data was skipped: lost before the capture point or reordered. The RTT sample in progress is kept, but this segment isn't timed
+		// since it isn't acknowledged before the skipped data arrives
+		sender.nextSeq = segmentEnd;
+		sender.flags |= SIDE_SKIPPED;
+		sender.skippedAt = now;
+	}
+	else if (payloadLength <= 1 && seq + 1 == sender.nextSeq && (flags & TCP_FLAG_FIN) == 0)
+	{
+		// a keep-alive, which repeats the last byte (or none) to get an ACK
+	}
+	else
+	{
+		uint32_t threshold = (sender.metrics.rttSamples > 0 ? sender.metrics.minRtt : m_Config.outOfOrderThreshold);
+		if ((sender.flags & SIDE_SKIPPED) != 0 && now - sender.skippedAt < threshold)
+			sender.metrics.outOfOrder++;
+		else
+			sender.metrics.retransmissions++;
+
+		if (seqAfter(segmentEnd, sender.nextSeq))
+			sender.nextSeq = segmentEnd;
+
+		// an ACK following a retransmission may acknowledge either copy (Karn's algorithm)
+		sender.flags &= ~SIDE_TIMING;
+	}
+
+	// the SYN is timed by the handshake
+	if (newData && payloadLength > 0 && (flags & TCP_FLAG_SYN) == 0 && (sender.flags & SIDE_TIMING) == 0)
+	{
+		sender.timedSeq = segmentEnd;
+		sender.timedAt = now;
+		sender.flags |= SIDE_TIMING;
+	}
+}
+
+void TcpFlowTracker::advanceTime(uint64_t timestamp)
+{
+	if (timestamp <= m_CurrentTime)
+		return;
+
+	m_CurrentTime = timestamp;
+	m_Connections.advanceTime(timestamp / 1000000);
+}
+
+void TcpFlowTracker::flush()
+{
+	std::vector<std::pair<ConnectionKey, ConnectionState> > connections;
+	m_Connections.getEntries(connections);
+	for (size_t i = 0; i < connections.size(); i++)
+		reportConnection(connections[i].first, connections[i].second, TcpFlowEndForced);
+
+	m_Connections.clear();
+	LOG_DEBUG("Flushed %d connections", (int)connections.size());
+}
+
+bool TcpFlowTracker::getMetrics(const FlowTuple& tuple, uint16_t vlanId, TcpFlowMetrics& metrics) const
+{
+	ConnectionKey key;
+	getKey(tuple, vlanId, key);
+	const ConnectionState* conn = m_Connections.peek(key);
+	if (conn == NULL)
+		return false;
+
+	fillMetrics(key, *conn, metrics);
+	return true;
+}
+
+void TcpFlowTracker::getAllMetrics(std::vector<TcpFlowMetrics>& metrics) const
+{
+	std::vector<std::pair<ConnectionKey, ConnectionState> > connections;
+	m_Connections.getEntries(connections);
+	metrics.reserve(metrics.size() + connections.size());
+	for (size_t i = 0; i < connections.size(); i++)
+	{
+		TcpFlowMetrics connMetrics;
+		fillMetrics(connections[i].first, connections[i].second, connMetrics);
+		metrics.push_back(connMetrics);
+	}
+}
+
+size_t TcpFlowTracker::getBytesPerConnection()
+{
+	return FlowTable<ConnectionKey, ConnectionState, ConnectionKeyHash>::getBytesPerFlow();
+}
+
+size_t TcpFlowTracker::getShardIndex(const RawPacket* rawPacket, size_t numOfShards)
+{
+	PacketView view;
+	if (numOfShards == 0 || !FlowKeyExtractor::extract(rawPacket, view) || !view.isPacketOfType(TCP))
+		return 0;
+
+	FlowTuple tuple;
+	FlowHash::getTuple(view, tuple);
+	return FlowHash::hashSymmetric(tuple) % numOfShards;
+}
+
+int TcpFlowTracker::getKey(const FlowTuple& tuple, uint16_t vlanId, ConnectionKey& key)
+{
+	key.tuple = tuple;
+	key.vlanId = vlanId;
+
+	int cmp = memcmp(tuple.srcIP, tuple.dstIP, sizeof(tuple.srcIP));
+	if (cmp < 0 || (cmp == 0 && tuple.srcPort <= tuple.dstPort))
+		return 0;
+
+	memcpy(key.tuple.srcIP, tuple.dstIP, sizeof(tuple.dstIP));
+	memcpy(key.tuple.dstIP, tuple.srcIP, sizeof(tuple.srcIP));
+	key.tuple.srcPort = tuple.dstPort;
+	key.tuple.dstPort = tuple.srcPort;
+	return 1;
+}
+
+void TcpFlowTracker::fillMetrics(const ConnectionKey& key, const ConnectionState& conn, TcpFlowMetrics& metrics)
+{
+	int clientSide = conn.clientSide;
+	metrics.tuple = key.tuple;
+	if (clientSide == 1)
+	{
+		memcpy(metrics.tuple.srcIP, key.tuple.dstIP, sizeof(key.tuple.dstIP));
+		memcpy(metrics.tuple.dstIP, key.tuple.srcIP, sizeof(key.tuple.srcIP));
+		metrics.tuple.srcPort = key.tuple.dstPort;
+		metrics.tuple.dstPort = key.tuple.srcPort;
+	}
+
+	metrics.vlanId = key.vlanId;
+	metrics.handshakeSeen = ((conn.flags & (CONN_SYN | CONN_SYN_ACK | CONN_HANDSHAKE_ACK)) == (CONN_SYN | CONN_SYN_ACK | CONN_HANDSHAKE_ACK));
+	metrics.endReason = TcpFlowEndForced;
+	metrics.firstSeen = conn.firstSeen;
+	metrics.lastSeen = conn.lastSeen;
+	metrics.serverHandshakeRtt = conn.serverHandshakeRtt;
+	metrics.clientHandshakeRtt = conn.clientHandshakeRtt;
+	metrics.clientToServer = conn.sides[clientSide].metrics;
+	metrics.serverToClient = conn.sides[1 - clientSide].metrics;
+}
+
+void TcpFlowTracker::reportConnection(const ConnectionKey& key, ConnectionState& conn, TcpFlowEndReason reason)
+{
+	// a connection which ended is reported when it ends, not again when it leaves the table
+	if ((conn.flags & CONN_REPORTED) != 0)
+		return;
+
+	conn.flags |= CONN_REPORTED;
+	m_Stats.connectionsReported++;
+	if (m_OnConnectionReported == NULL)
+		return;
+
+	TcpFlowMetrics metrics;
+	fillMetrics(key, conn, metrics);
+	metrics.endReason = reason;
+	m_OnConnectionReported(metrics, m_UserCookie);
+}
+
+void TcpFlowTracker::onConnectionRemoved(const ConnectionKey& key, ConnectionState& conn, FlowRemovalReason reason, void* userCookie)
+{
+	TcpFlowTracker* tracker = (TcpFlowTracker*)userCookie;
+	tracker->reportConnection(key, conn, reason == FlowRemovedByIdleTimeout ? TcpFlowEndIdleTimeout : TcpFlowEndEvicted);
+}
+
+} // namespace pcpp
@@ -7,10 +7,11 @@
 #include "HttpLayer.h"
 #include "SSLLayer.h"
 #include "SipLayer.h"
+#include "ProtocolRegistry.h"
+#include "PayloadClassifier.h"
 #include "IpUtils.h"
 #include "Logger.h"
 #include <string.h>
-#include <sstream>
 
 namespace pcpp
 {
@@ -35,31 +36,38 @@ TcpOptionBuilder::TcpOptionBuilder(NopEolOptionTypes optionType)
 	}
 }
 
-TcpOption TcpOptionBuilder::build() const
+size_t TcpOptionBuilder::getRecordSize() const
 {
-	size_t optionSize = m_RecValueLen + 2*sizeof(uint8_t);
-
 	if (m_RecType == (uint8_t)PCPP_TCPOPT_EOL || m_RecType == (uint8_t)PCPP_TCPOPT_NOP)
 	{
 		if (m_RecValueLen != 0)
 		{
 			LOG_ERROR("TCP NOP and TCP EOL options are 1-byte long and don't have option value. Tried to set option value of size %d", m_RecValueLen);
-			return TcpOption(NULL);
+			return 0;
 		}
 
-		optionSize = 1;
+		return 1;
 	}
 
-	uint8_t* recordBuffer = new uint8_t[optionSize];
-	memset(recordBuffer, 0, optionSize);
-	recordBuffer[0] = m_RecType;
-	if (optionSize > 1)
-	{
-		recordBuffer[1] = (uint8_t)optionSize;
-		if (optionSize > 2 && m_RecValue != NULL)
-			memcpy(recordBuffer+2, m_RecValue, m_RecValueLen);
-	}
+	return m_RecValueLen + 2*sizeof(uint8_t);
+}
+
+TcpOption TcpOptionBuilder::build() const
+{
+	size_t optionSize = getRecordSize();
+	if (optionSize == 0)
+		return TcpOption(NULL);
+
+	return build(new uint8_t[optionSize]);
+}
+
+TcpOption TcpOptionBuilder::build(uint8_t* recordBuffer) const
+{
+	size_t optionSize = getRecordSize();
+	if (optionSize == 0 || recordBuffer == NULL)
+		return TcpOption(NULL);
 
+	writeRecord(recordBuffer, optionSize, (uint8_t)optionSize);
 	return TcpOption(recordBuffer);
 }
 
@@ -170,9 +178,9 @@ bool TcpLayer::removeAllTcpOptions()
 
 TcpOption TcpLayer::addTcpOptionAt(const TcpOptionBuilder& optionBuilder, int offset)
 {
-	TcpOption newOption = optionBuilder.build();
-	if (newOption.isNull())
-		return newOption;
+	size_t sizeToExtend = optionBuilder.getRecordSize();
+	if (sizeToExtend == 0)
+		return TcpOption(NULL);
 
 	// calculate total TCP option size
 	TcpOption curOpt = getFirstTcpOption();
@@ -182,20 +190,16 @@ TcpOption TcpLayer::addTcpOptionAt(const TcpOptionBuilder& optionBuilder, int of
 		totalOptSize += curOpt.getTotalSize();
 		curOpt = getNextTcpOption(curOpt);
 	}
-	totalOptSize += newOption.getTotalSize();
-
-	size_t sizeToExtend = newOption.getTotalSize();
+	totalOptSize += sizeToExtend;
 
 	if (!extendLayer(offset, sizeToExtend))
 	{
 		LOG_ERROR("Could not extend TcpLayer in [%d] bytes", (int)sizeToExtend);
-		newOption.purgeRecordData();
 		return TcpOption(NULL);
 	}
 
-	memcpy(m_Data + offset, newOption.getRecordBasePtr(), newOption.getTotalSize());
-
-	newOption.purgeRecordData();
+	// the option is written directly into the space made for it
+	optionBuilder.build(m_Data + offset);
 
 	adjustTcpOptionTrailer(totalOptSize);
 
@@ -225,6 +229,40 @@ void TcpLayer::adjustTcpOptionTrailer(size_t totalOptSize)
 	getTcpHeader()->dataOffset = (sizeof(tcphdr) + totalOptSize + m_NumOfTrailingBytes)/4;
 }
 
+uint16_t TcpLayer::getSrcPort() const
+{
+	return ntohs(getTcpHeader()->portSrc);
+}
+
+void TcpLayer::setSrcPort(uint16_t port, bool updateChecksum)
+{
+	tcphdr* tcpHdr = getTcpHeader();
+	uint16_t newPort = htons(port);
+	if (updateChecksum)
+		tcpHdr->headerChecksum = update_checksum(tcpHdr->headerChecksum, tcpHdr->portSrc, newPort);
+	else
+		setModified();
+
+	tcpHdr->portSrc = newPort;
+}
+
+uint16_t TcpLayer::getDstPort() const
+{
+	return ntohs(getTcpHeader()->portDst);
+}
+
+void TcpLayer::setDstPort(uint16_t port, bool updateChecksum)
+{
+	tcphdr* tcpHdr = getTcpHeader();
+	uint16_t newPort = htons(port);
+	if (updateChecksum)
+		tcpHdr->headerChecksum = update_checksum(tcpHdr->headerChecksum, tcpHdr->portDst, newPort);
+	else
+		setModified();
+
+	tcpHdr->portDst = newPort;
+}
+
 uint16_t TcpLayer::calculateChecksum(bool writeResultToPacket)
 {
 	tcphdr* tcpHdr = getTcpHeader();
@@ -336,18 +374,23 @@ void TcpLayer::parseNextLayer()
 	tcphdr* tcpHder = getTcpHeader();
 	uint16_t portDst = ntohs(tcpHder->portDst);
 	uint16_t portSrc = ntohs(tcpHder->portSrc);
-	if ((HttpMessage::getHTTPPortMap()->find(portDst) != HttpMessage::getHTTPPortMap()->end()) && HttpRequestFirstLine::parseMethod((char*)(m_Data + headerLen), m_DataLen - headerLen) != HttpRequestLayer::HttpMethodUnknown)
-		m_NextLayer = new HttpRequestLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
-	else if ((HttpMessage::getHTTPPortMap()->find(portSrc) != HttpMessage::getHTTPPortMap()->end()) && HttpResponseFirstLine::parseStatusCode((char*)(m_Data + headerLen), m_DataLen - headerLen) != HttpResponseLayer::HttpStatusCodeUnknown)
-		m_NextLayer = new HttpResponseLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	const ProtocolRegistry& registry = ProtocolRegistry::getInstance();
+
+	if (registry.isPortOfProtocol(portDst, HTTP) && HttpRequestFirstLine::parseMethod((char*)(m_Data + headerLen), m_DataLen - headerLen) != HttpRequestLayer::HttpMethodUnknown)
+		m_NextLayer = new(m_Packet) HttpRequestLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	else if (registry.isPortOfProtocol(portSrc, HTTP) && HttpResponseFirstLine::parseStatusCode((char*)(m_Data + headerLen), m_DataLen - headerLen) != HttpResponseLayer::HttpStatusCodeUnknown)
+		m_NextLayer = new(m_Packet) HttpResponseLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 	else if (SSLLayer::IsSSLMessage(portSrc, portDst, m_Data + headerLen, m_DataLen - headerLen))
 		m_NextLayer = SSLLayer::createSSLMessage(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
-	else if (((portDst == 5060) || (portDst == 5061)) && (SipRequestFirstLine::parseMethod((char*)(m_Data + headerLen), m_DataLen - headerLen) != SipRequestLayer::SipMethodUnknown))
-		m_NextLayer = new SipRequestLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
-	else if (((portDst == 5060) || (portDst == 5061)) && (SipResponseFirstLine::parseStatusCode((char*)(m_Data + headerLen), m_DataLen - headerLen) != SipResponseLayer::SipStatusCodeUnknown))
-		m_NextLayer = new SipResponseLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
-	else
-		m_NextLayer = new PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	else if (registry.isPortOfProtocol(portDst, SIP) && (SipRequestFirstLine::parseMethod((char*)(m_Data + headerLen), m_DataLen - headerLen) != SipRequestLayer::SipMethodUnknown))
+		m_NextLayer = new(m_Packet) SipRequestLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	else if (registry.isPortOfProtocol(portDst, SIP) && (SipResponseFirstLine::parseStatusCode((char*)(m_Data + headerLen), m_DataLen - headerLen) != SipResponseLayer::SipStatusCodeUnknown))
+		m_NextLayer = new(m_Packet) SipResponseLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	else if (registry.getPayloadClassifier() != NULL)
+		m_NextLayer = registry.getPayloadClassifier()->createLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+
+	if (m_NextLayer == NULL)
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 }
 
 void TcpLayer::computeCalculateFields()
@@ -359,33 +402,42 @@ void TcpLayer::computeCalculateFields()
 }
 
 std::string TcpLayer::toString()
+{
+	return PacketDumpWriter::layerToString(*this);
+}
+
+void TcpLayer::dump(PacketDumpWriter& writer)
 {
 	tcphdr* hdr = getTcpHeader();
-	std::string result = "TCP Layer, ";
+	writer.beginLayer("TCP Layer", TCP);
 	if (hdr->synFlag)
 	{
 		if (hdr->ackFlag)
-			result += "[SYN, ACK], ";
+			writer.addText("[SYN, ACK]");
 		else
-			result += "[SYN], ";
+			writer.addText("[SYN]");
 	}
 	else if (hdr->finFlag)
 	{
 		if (hdr->ackFlag)
-			result += "[FIN, ACK], ";
+			writer.addText("[FIN, ACK]");
 		else
-			result += "[FIN], ";
+			writer.addText("[FIN]");
 	}
 	else if (hdr->ackFlag)
-		result += "[ACK], ";
-
-	std::ostringstream srcPortStream;
-	srcPortStream << ntohs(hdr->portSrc);
-	std::ostringstream dstPortStream;
-	dstPortStream << ntohs(hdr->portDst);
-	result += "Src port: " + srcPortStream.str() + ", Dst port: " + dstPortStream.str();
-
-	return result;
+		writer.addText("[ACK]");
+
+	writer.addNumber("Src port", "srcPort", ntohs(hdr->portSrc));
+	writer.addNumber("Dst port", "dstPort", ntohs(hdr->portDst));
+	writer.addNumber(NULL, "seq", ntohl(hdr->sequenceNumber));
+	writer.addNumber(NULL, "ack", ntohl(hdr->ackNumber));
+	writer.addBool(NULL, "syn", hdr->synFlag != 0);
+	writer.addBool(NULL, "fin", hdr->finFlag != 0);
+	writer.addBool(NULL, "rst", hdr->rstFlag != 0);
+	writer.addBool(NULL, "psh", hdr->pshFlag != 0);
+	writer.addBool(NULL, "ackFlag", hdr->ackFlag != 0);
+	writer.addNumber(NULL, "window", ntohs(hdr->windowSize));
+	writer.endLayer();
 }
 
 } // namespace pcpp
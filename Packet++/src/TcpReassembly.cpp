@@ -5,8 +5,13 @@
 #include "IPv4Layer.h"
 #include "IPv6Layer.h"
 #include "PacketUtils.h"
+#include "PacketView.h"
+#include "TcpSegmentCoalescer.h"
+#include "ProtocolRegistry.h"
 #include "IpAddress.h"
+#include "IpUtils.h"
 #include "Logger.h"
+#include "LatencyTracer.h"
 #include <sstream>
 #if defined(WIN32) || defined(PCAPPP_MINGW_ENV) //for using ntohl, ntohs, etc.
 #include <winsock2.h>
@@ -16,58 +21,9 @@
 #include <arpa/inet.h> //for using ntohl, ntohs, etc.
 #endif
 
-#define PURGE_FREQ_SECS 1
-
 namespace pcpp
 {
 
-ConnectionData::~ConnectionData()
-{
-	if (srcIP != NULL)
-		delete srcIP;
-
-	if (dstIP != NULL)
-		delete dstIP;
-}
-
-ConnectionData::ConnectionData(const ConnectionData& other)
-{
-	copyData(other);
-}
-
-ConnectionData& ConnectionData::operator=(const ConnectionData& other)
-{
-	if (srcIP != NULL)
-		delete srcIP;
-
-	if (dstIP != NULL)
-		delete dstIP;
-
-	copyData(other);
-
-	return *this;
-}
-
-void ConnectionData::copyData(const ConnectionData& other)
-{
-	if (other.srcIP != NULL)
-		srcIP = other.srcIP->clone();
-	else
-		srcIP = NULL;
-
-	if (other.dstIP != NULL)
-		dstIP = other.dstIP->clone();
-	else
-		dstIP = NULL;
-
-	flowKey = other.flowKey;
-	srcPort = other.srcPort;
-	dstPort = other.dstPort;
-	startTime = other.startTime;
-	endTime = other.endTime;
-}
-
-
 TcpStreamData::TcpStreamData()
 {
 	m_Data = NULL;
@@ -91,7 +47,7 @@ TcpStreamData::~TcpStreamData()
 	}
 }
 
-TcpStreamData::TcpStreamData(TcpStreamData& other)
+TcpStreamData::TcpStreamData(const TcpStreamData& other)
 {
 	copyData(other);
 }
@@ -124,48 +80,331 @@ void TcpStreamData::copyData(const TcpStreamData& other)
 	m_DeleteDataOnDestruction = true;
 }
 
-void TcpReassembly::TcpOneSideData::setSrcIP(IPAddress* sourrcIP)
+
+const uint32_t TcpReassembly::ConnectionInfoList::NullIndex;
+const uint32_t TcpReassembly::CheckpointMagic;
+
+// the finalizer of MurmurHash3. Flow keys are usually hashes already, but mixing them again keeps the table balanced also with keys provided by the user.
+// Each step is reversible, so different flow keys never have the same hash
+static inline uint32_t hashFlowKey(uint32_t flowKey)
+{
+	flowKey ^= flowKey >> 16;
+	flowKey *= 0x85ebca6b;
+	flowKey ^= flowKey >> 13;
+	flowKey *= 0xc2b2ae35;
+	flowKey ^= flowKey >> 16;
+	return flowKey;
+}
+
+TcpReassembly::ConnectionInfoList::ConnectionInfoList()
+{
+	m_NumOfEntries = 0;
+	m_FreeList = NullIndex;
+}
+
+TcpReassembly::ConnectionInfoList::ConnectionInfoList(const ConnectionInfoList& other)
+{
+	m_NumOfEntries = 0;
+	m_FreeList = NullIndex;
+	copyFrom(other);
+}
+
+TcpReassembly::ConnectionInfoList::~ConnectionInfoList()
+{
+	clear();
+}
+
+TcpReassembly::ConnectionInfoList& TcpReassembly::ConnectionInfoList::operator=(const ConnectionInfoList& other)
+{
+	if (this == &other)
+		return *this;
+
+	clear();
+	copyFrom(other);
+	return *this;
+}
+
+void TcpReassembly::ConnectionInfoList::copyFrom(const ConnectionInfoList& other)
+{
+	for (size_t i = 0; i < other.m_EntryBlocks.size(); i++)
+	{
+		Entry* block = new Entry[EntryBlockSize];
+		for (int j = 0; j < EntryBlockSize; j++)
+		{
+			block[j] = other.m_EntryBlocks[i][j];
+			// the reassembly state belongs to the TcpReassembly instance, a copy holds only the connection information
+			block[j].reassemblyData = NULL;
+		}
+		m_EntryBlocks.push_back(block);
+	}
+
+	m_NumOfEntries = other.m_NumOfEntries;
+	m_FreeList = other.m_FreeList;
+	m_Index = other.m_Index;
+}
+
+void TcpReassembly::ConnectionInfoList::clear()
+{
+	for (size_t i = 0; i < m_EntryBlocks.size(); i++)
+		delete [] m_EntryBlocks[i];
+
+	m_EntryBlocks.clear();
+	m_Index.clear();
+	m_NumOfEntries = 0;
+	m_FreeList = NullIndex;
+}
+
+uint32_t TcpReassembly::ConnectionInfoList::nextEntryInUse(uint32_t entryIndex) const
+{
+	while (entryIndex < m_NumOfEntries && !getEntry(entryIndex).inUse)
+		entryIndex++;
+
+	return entryIndex;
+}
+
+TcpReassembly::ConnectionInfoList::Entry* TcpReassembly::ConnectionInfoList::findEntry(uint32_t flowKey) const
+{
+	const Slot* slot = m_Index.find(hashFlowKey(flowKey));
+	if (slot == NULL)
+		return NULL;
+
+	return &getEntry(slot->entryIndex);
+}
+
+TcpReassembly::ConnectionInfoList::const_iterator TcpReassembly::ConnectionInfoList::find(uint32_t flowKey) const
 {
-	if (srcIP != NULL)
-		delete srcIP;
+	const Slot* slot = m_Index.find(hashFlowKey(flowKey));
+	if (slot == NULL)
+		return end();
+
+	return const_iterator(this, slot->entryIndex);
+}
+
+TcpReassembly::ConnectionInfoList::Entry* TcpReassembly::ConnectionInfoList::insertEntry(uint32_t flowKey)
+{
+	Slot& slot = m_Index.insert(hashFlowKey(flowKey));
+	if (!slot.isEmpty())
+		return &getEntry(slot.entryIndex);
+
+	uint32_t entryIndex;
+	if (m_FreeList != NullIndex)
+	{
+		entryIndex = m_FreeList;
+		m_FreeList = getEntry(entryIndex).nextFree;
+	}
+	else
+	{
+		if ((m_NumOfEntries & (EntryBlockSize - 1)) == 0)
+			m_EntryBlocks.push_back(new Entry[EntryBlockSize]);
+		entryIndex = m_NumOfEntries++;
+	}
+
+	Entry& entry = getEntry(entryIndex);
+	entry.value.first = flowKey;
+	entry.value.second = ConnectionData();
+	entry.reassemblyData = NULL;
+	entry.timerId = TimerWheel::InvalidTimerId;
+	entry.nextFree = NullIndex;
+	entry.inUse = true;
+
+	slot.entryIndex = entryIndex;
 
-	srcIP = sourrcIP->clone();
+	return &entry;
+}
+
+bool TcpReassembly::ConnectionInfoList::eraseEntry(uint32_t flowKey)
+{
+	Slot* slot = m_Index.find(hashFlowKey(flowKey));
+	if (slot == NULL)
+		return false;
+
+	uint32_t entryIndex = slot->entryIndex;
+	m_Index.erase(slot);
+
+	Entry& entry = getEntry(entryIndex);
+	entry.value.second = ConnectionData();
+	entry.reassemblyData = NULL;
+	entry.timerId = TimerWheel::InvalidTimerId;
+	entry.inUse = false;
+	entry.nextFree = m_FreeList;
+	m_FreeList = entryIndex;
+
+	return true;
 }
 
 
 TcpReassembly::TcpReassembly(OnTcpMessageReady onMessageReadyCallback, void* userCookie, OnTcpConnectionStart onConnectionStartCallback, OnTcpConnectionEnd onConnectionEndCallback, const TcpReassemblyConfiguration &config)
 {
 	m_OnMessageReadyCallback = onMessageReadyCallback;
+	m_OnMessageReadyZeroCopyCallback = NULL;
+	init(userCookie, onConnectionStartCallback, onConnectionEndCallback, config);
+}
+
+TcpReassembly::TcpReassembly(OnTcpMessageReadyZeroCopy onMessageReadyCallback, void* userCookie, OnTcpConnectionStart onConnectionStartCallback, OnTcpConnectionEnd onConnectionEndCallback, const TcpReassemblyConfiguration &config)
+{
+	m_OnMessageReadyCallback = NULL;
+	m_OnMessageReadyZeroCopyCallback = onMessageReadyCallback;
+	init(userCookie, onConnectionStartCallback, onConnectionEndCallback, config);
+}
+
+void TcpReassembly::init(void* userCookie, OnTcpConnectionStart onConnectionStartCallback, OnTcpConnectionEnd onConnectionEndCallback, const TcpReassemblyConfiguration &config)
+{
 	m_UserCookie = userCookie;
 	m_OnConnStart = onConnectionStartCallback;
 	m_OnConnEnd = onConnectionEndCallback;
+	m_OnConnBypassed = NULL;
 	m_ClosedConnectionDelay = (config.closedConnectionDelay > 0) ? config.closedConnectionDelay : 5;
 	m_RemoveConnInfo = config.removeConnInfo;
 	m_MaxNumToClean = (config.removeConnInfo == true && config.maxNumToClean == 0) ? 30 : config.maxNumToClean;
-	m_PurgeTimepoint = time(NULL) + PURGE_FREQ_SECS;
+	m_IdleConnectionTimeout = config.idleConnectionTimeout;
+	m_CurrentTime = 0;
+	m_OutOfOrderBytes = 0;
+	m_MaxOutOfOrderBytesPerConn = config.maxOutOfOrderBytesPerConnection;
+	m_MaxOutOfOrderBytes = config.maxOutOfOrderBytes;
+	m_OwnMemoryBudget.setMaxBytes(config.maxMemoryBytes);
+	m_MemoryBudget = &m_OwnMemoryBudget;
+	m_EvictionList.setPolicy(config.evictionPolicy);
+	m_MemoryBytes = 0;
+	m_NumOfEvictedConnections = 0;
+	m_NumOfPacketsProcessed = 0;
+	m_NumOfPayloadBytesProcessed = 0;
+	m_NumOfConnectionsStarted = 0;
+	m_NumOfOpenConnections = 0;
+	m_MaxBytesPerSide = config.maxBytesPerSide;
+	m_MaxBytesPerConnection = config.maxBytesPerConnection;
+	m_NumOfBypassedConnections = 0;
+	m_NumOfBypassedPayloadBytes = 0;
+
+	// the half-open table is allocated once, so a flood of SYN packets doesn't allocate memory
+	m_HalfOpenBucketMask = 0;
+	if (config.halfOpenTableSize > 0)
+	{
+		size_t tableSize = HalfOpenBucketSize;
+		while (tableSize < config.halfOpenTableSize)
+			tableSize <<= 1;
+		HalfOpenEntry freeEntry;
+		memset(&freeEntry, 0, sizeof(freeEntry));
+		m_HalfOpenTable.resize(tableSize, freeEntry);
+		m_HalfOpenBucketMask = tableSize / HalfOpenBucketSize - 1;
+	}
+	m_HalfOpenTimeout = (config.halfOpenTimeout > 0) ? config.halfOpenTimeout : 5;
+	m_PromoteHalfOpenOnAck = config.promoteHalfOpenOnAck;
+	m_NumOfHalfOpenConnections = 0;
+	m_NumOfPromotedConnections = 0;
+	m_NumOfExpiredHalfOpenConnections = 0;
+	m_NumOfDroppedHalfOpenConnections = 0;
 }
 
 TcpReassembly::~TcpReassembly()
 {
-	while (!m_ConnectionList.empty())
+	// free the fragment buffers of connections which are still open
+	for (uint32_t entryIndex = m_ConnectionInfo.nextEntryInUse(0); entryIndex < m_ConnectionInfo.m_NumOfEntries; entryIndex = m_ConnectionInfo.nextEntryInUse(entryIndex + 1))
 	{
-		if(m_ConnectionList.begin()->second != NULL)
-			delete m_ConnectionList.begin()->second;
-		m_ConnectionList.erase(m_ConnectionList.begin());
+		ConnectionInfoList::Entry& connEntry = m_ConnectionInfo.getEntry(entryIndex);
+		if (connEntry.reassemblyData != NULL)
+			releaseFragments(connEntry.reassemblyData);
 	}
+
+	for (std::vector<uint8_t*>::iterator iter = m_FreeFragmentBuffers.begin(); iter != m_FreeFragmentBuffers.end(); iter++)
+		delete [] (*iter);
+
+	for (std::vector<TcpReassemblyData*>::iterator iter = m_ReassemblyDataBlocks.begin(); iter != m_ReassemblyDataBlocks.end(); iter++)
+		delete [] (*iter);
+
+	// the budget may be shared with other instances which keep using it
+	m_MemoryBudget->release(m_MemoryBytes);
 }
 
-void TcpReassembly::reassemblePacket(Packet& tcpData)
+TcpReassembly::TcpReassemblyData* TcpReassembly::allocateReassemblyData()
 {
-	// automatic cleanup
-	if(m_RemoveConnInfo == true)
+	if (m_FreeReassemblyData.empty())
+		allocateReassemblyDataBlock(ReassemblyDataBlockSize);
+
+	TcpReassemblyData* tcpReassemblyData = m_FreeReassemblyData.back();
+	m_FreeReassemblyData.pop_back();
+	return tcpReassemblyData;
+}
+
+void TcpReassembly::allocateReassemblyDataBlock(size_t blockSize)
+{
+	TcpReassemblyData* block = new TcpReassemblyData[blockSize];
+	m_ReassemblyDataBlocks.push_back(block);
+	for (size_t i = blockSize; i > 0; i--)
+		m_FreeReassemblyData.push_back(block + i - 1);
+}
+
+void TcpReassembly::releaseReassemblyData(TcpReassemblyData* tcpReassemblyData)
+{
+	releaseFragments(tcpReassemblyData);
+	releaseMemory(tcpReassemblyData, ConnectionStateBytes);
+	m_EvictionList.remove(tcpReassemblyData->evictionId);
+	tcpReassemblyData->reset();
+	m_FreeReassemblyData.push_back(tcpReassemblyData);
+}
+
+void TcpReassembly::chargeMemory(TcpReassemblyData* tcpReassemblyData, size_t bytes)
+{
+	tcpReassemblyData->memoryBytes += bytes;
+	m_MemoryBytes += bytes;
+	m_MemoryBudget->charge(bytes);
+	m_EvictionList.resize(tcpReassemblyData->evictionId, tcpReassemblyData->memoryBytes);
+}
+
+void TcpReassembly::releaseMemory(TcpReassemblyData* tcpReassemblyData, size_t bytes)
+{
+	tcpReassemblyData->memoryBytes -= bytes;
+	m_MemoryBytes -= bytes;
+	m_MemoryBudget->release(bytes);
+	m_EvictionList.resize(tcpReassemblyData->evictionId, tcpReassemblyData->memoryBytes);
+}
+
+void TcpReassembly::setMemoryBudget(MemoryBudget* budget)
+{
+	if (budget == NULL)
+		budget = &m_OwnMemoryBudget;
+
+	if (budget == m_MemoryBudget)
+		return;
+
+	m_MemoryBudget->release(m_MemoryBytes);
+	budget->charge(m_MemoryBytes);
+	m_MemoryBudget = budget;
+
+	evictConnections();
+}
+
+void TcpReassembly::evictConnections()
+{
+	uint64_t flowKey;
+	while (m_MemoryBudget->isExceeded() && m_EvictionList.getVictim(flowKey))
 	{
-		if(time(NULL) >= m_PurgeTimepoint)
+		ConnectionInfoList::Entry* connEntry = m_ConnectionInfo.findEntry((uint32_t)flowKey);
+		if (connEntry == NULL || connEntry->reassemblyData == NULL)
 		{
-			purgeClosedConnections();
-			m_PurgeTimepoint = time(NULL) + PURGE_FREQ_SECS;
+			LOG_ERROR("Cannot evict flow with key 0x%X: cannot find open flow", (uint32_t)flowKey);
+			return;
 		}
+
+		LOG_DEBUG("Memory budget exceeded, evicting connection with flow key 0x%X", (uint32_t)flowKey);
+		m_NumOfEvictedConnections++;
+		m_MemoryBudget->countEviction(connEntry->reassemblyData->memoryBytes);
+		closeConnectionEntry(connEntry, TcpReassemblyConnectionClosedByMemoryBudget);
 	}
+}
+
+void TcpReassembly::reassemblePacket(Packet& tcpData)
+{
+	processPacket(tcpData);
+
+	// new connections and out-of-order data may have exceeded the memory budget. Connections are evicted only here, after the packet was fully handled
+	if (m_MemoryBudget->isExceeded())
+		evictConnections();
+}
+
+void TcpReassembly::processPacket(Packet& tcpData)
+{
+	// move the time forward to the packet's timestamp. When a new second starts this closes the idle connections and performs the automatic cleanup
+	setCurrentTime(tcpData.getRawPacket()->getPacketTimeStamp().tv_sec);
 
 	// get IP layer
 	Layer* ipLayer = NULL;
@@ -191,96 +430,208 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 		return;
 	}
 
-	// calculate the TCP payload size
-	size_t tcpPayloadSize = tcpLayer->getLayerPayloadSize();
+	TcpSegmentInfo segment;
+	if (ipLayer->getProtocol() == IPv4)
+	{
+		segment.srcIP = ((IPv4Layer*)ipLayer)->getSrcIpAddressValue();
+		segment.dstIP = ((IPv4Layer*)ipLayer)->getDstIpAddressValue();
+	}
+	else
+	{
+		segment.srcIP = ((IPv6Layer*)ipLayer)->getSrcIpAddressValue();
+		segment.dstIP = ((IPv6Layer*)ipLayer)->getDstIpAddressValue();
+	}
 
-	// calculate if this packet has FIN or RST flags
-	bool isFin = (tcpLayer->getTcpHeader()->finFlag == 1);
-	bool isRst = (tcpLayer->getTcpHeader()->rstFlag == 1);
-	bool isFinOrRst = isFin || isRst;
+	segment.tcpHeader = tcpLayer->getTcpHeader();
+	segment.payload = tcpLayer->getLayerPayload();
+	segment.payloadSize = tcpLayer->getLayerPayloadSize();
+	segment.flowKey = hash5Tuple(&tcpData);
+	segment.timestamp = tcpData.getRawPacket()->getPacketTimeStamp();
+	processSegment(segment);
+}
 
-	// ignore ACK packets or TCP packets with no payload (except for SYN, FIN or RST packets which we'll later need)
-	if (tcpPayloadSize == 0 && tcpLayer->getTcpHeader()->synFlag == 0 && !isFinOrRst)
+// computes the same flow key as hash5Tuple(Packet*) for a TCP packet found by FlowKeyExtractor, so both paths put a connection's packets in
+// the same flow: the hash covers the ports and addresses, ordered by the port values (and for IPv4 with equal ports by the addresses), and the
+// protocol byte of the IP header (for IPv6 the next header field of the fixed header)
+static uint32_t hash5Tuple(uint8_t* data, const PacketView& view)
+{
+	tcphdr* tcpHeader = (tcphdr*)(data + view.transportOffset);
+	uint16_t portSrc = tcpHeader->portSrc;
+	uint16_t portDst = tcpHeader->portDst;
+	int srcPosition = (portDst < portSrc ? 1 : 0);
+
+	ScalarBuffer<uint8_t> vec[5];
+	vec[0 + srcPosition].buffer = (uint8_t*)&portSrc;
+	vec[0 + srcPosition].len = 2;
+	vec[1 - srcPosition].buffer = (uint8_t*)&portDst;
+	vec[1 - srcPosition].len = 2;
+
+	if (view.ipVersion == 4)
+	{
+		iphdr* ipHeader = (iphdr*)(data + view.networkOffset);
+		if (portSrc == portDst && ipHeader->ipDst < ipHeader->ipSrc)
+			srcPosition = 1;
+
+		vec[2 + srcPosition].buffer = (uint8_t*)&ipHeader->ipSrc;
+		vec[2 + srcPosition].len = 4;
+		vec[3 - srcPosition].buffer = (uint8_t*)&ipHeader->ipDst;
+		vec[3 - srcPosition].len = 4;
+		vec[4].buffer = &ipHeader->protocol;
+		vec[4].len = 1;
+	}
+	else
+	{
+		// like hash5Tuple(Packet*), IPv6 addresses are ordered only by the ports
+		ip6_hdr* ipHeader = (ip6_hdr*)(data + view.networkOffset);
+		vec[2 + srcPosition].buffer = ipHeader->ipSrc;
+		vec[2 + srcPosition].len = 16;
+		vec[3 - srcPosition].buffer = ipHeader->ipDst;
+		vec[3 - srcPosition].len = 16;
+		vec[4].buffer = &ipHeader->nextHeader;
+		vec[4].len = 1;
+	}
+
+	return fnv_hash(vec, 5);
+}
+
+void TcpReassembly::processRawPacket(RawPacket* tcpRawData)
+{
+	PacketView view;
+	FlowKeyExtractor::extract(tcpRawData, view);
+	processRawPacket(tcpRawData, view);
+}
+
+void TcpReassembly::processRawPacket(RawPacket* tcpRawData, const PacketView& view)
+{
+	// move the time forward to the packet's timestamp. When a new second starts this closes the idle connections and performs the automatic cleanup
+	timeval timestamp = tcpRawData->getPacketTimeStamp();
+	setCurrentTime(timestamp.tv_sec);
+
+	if (view.ipVersion == 0)
+	{
+		// a link layer FlowKeyExtractor doesn't support (or a packet which isn't IP at all), leave it to the layer parsing
+		Packet parsedPacket(tcpRawData, false);
+		processPacket(parsedPacket);
 		return;
+	}
 
-	// if the actual TCP payload is smaller than the value written in IPV4's "total length" field then adjust tcpPayloadSize to avoid buffer overflow
-	if (tcpLayer->getLayerPayloadSize() < tcpPayloadSize)
+	if (!view.isPacketOfType(TCP))
 	{
-		LOG_DEBUG("Got a packet where actual TCP payload size is smaller then the value written in IPv4's 'total length' header. Adjusting tcpPayloadSize to avoid buffer overflow");
-		tcpPayloadSize = tcpLayer->getLayerPayloadSize();
+		// TCP may be carried inside a tunnel, which only the layer parsing decapsulates
+		const ProtocolRegistry& registry = ProtocolRegistry::getInstance();
+		bool mayBeTunnel = false;
+		if (view.isPacketOfType(UDP))
+			mayBeTunnel = registry.isPortOfProtocol(view.dstPort, VXLAN) || registry.isPortOfProtocol(view.dstPort, GTPv1) || registry.isPortOfProtocol(view.srcPort, GTPv1);
+		else if (!view.isFragment)
+			mayBeTunnel = (registry.getProtocolByIPProtocol(view.ipProtocol) & (IPv4 | IPv6 | GRE)) != 0;
+
+		if (mayBeTunnel)
+		{
+			Packet parsedPacket(tcpRawData, false);
+			processPacket(parsedPacket);
+		}
+
+		return;
 	}
 
+	uint8_t* data = (uint8_t*)tcpRawData->getRawData();
+	processTcpView(data, view, (view.payloadOffset != PacketView::NoOffset ? data + view.payloadOffset : NULL), view.payloadLength, timestamp);
+}
+
+void TcpReassembly::processTcpView(uint8_t* data, const PacketView& view, uint8_t* payload, size_t payloadSize, const timeval& timestamp)
+{
+	TcpSegmentInfo segment;
+	if (view.ipVersion == 4)
+	{
+		uint32_t srcIP, dstIP;
+		memcpy(&srcIP, view.srcIP, sizeof(srcIP));
+		memcpy(&dstIP, view.dstIP, sizeof(dstIP));
+		segment.srcIP = IPAddressValue::fromIPv4(srcIP);
+		segment.dstIP = IPAddressValue::fromIPv4(dstIP);
+	}
+	else
+	{
+		segment.srcIP = IPAddressValue::fromIPv6(view.srcIP);
+		segment.dstIP = IPAddressValue::fromIPv6(view.dstIP);
+	}
+
+	segment.tcpHeader = (const tcphdr*)(data + view.transportOffset);
+	segment.payload = payload;
+	segment.payloadSize = payloadSize;
+	segment.flowKey = hash5Tuple(data, view);
+	segment.timestamp = timestamp;
+	processSegment(segment);
+}
+
+void TcpReassembly::processSegment(const TcpSegmentInfo& segment)
+{
+	// calculate the TCP payload size
+	size_t tcpPayloadSize = segment.payloadSize;
+	m_NumOfPacketsProcessed++;
+	m_NumOfPayloadBytesProcessed += tcpPayloadSize;
+
+	// calculate if this packet has FIN or RST flags
+	bool isFin = (segment.tcpHeader->finFlag == 1);
+	bool isRst = (segment.tcpHeader->rstFlag == 1);
+	bool isFinOrRst = isFin || isRst;
+	bool isPureAck = (tcpPayloadSize == 0 && segment.tcpHeader->synFlag == 0 && !isFinOrRst);
+
+	// ignore ACK packets or TCP packets with no payload (except for SYN, FIN or RST packets which we'll later need, and ACK packets which may complete the handshake of a
+	// half-open connection)
+	if (isPureAck && (m_NumOfHalfOpenConnections == 0 || !m_PromoteHalfOpenOnAck))
+		return;
 
 	TcpReassemblyData* tcpReassemblyData = NULL;
 
-	// calculate flow key for this packet
-	uint32_t flowKey = hash5Tuple(&tcpData);
+	// the flow key for this packet
+	uint32_t flowKey = segment.flowKey;
 
-	// find the connection in the connection map
-	ConnectionList::iterator iter = m_ConnectionList.find(flowKey);
+	// find the connection in the connection table
+	ConnectionInfoList::Entry* connEntry = m_ConnectionInfo.findEntry(flowKey);
 
 	// if this packet belongs to a connection that was already closed (for example: data packet that comes after FIN), ignore it.
-	// the connection is already closed when the value of mapped type is NULL
-	if (iter != m_ConnectionList.end() && iter->second == NULL)
+	// the connection is already closed when it has no reassembly data
+	if (connEntry != NULL && connEntry->reassemblyData == NULL)
 	{
 		LOG_DEBUG("Ignoring packet of already closed flow [0x%X]", flowKey);
 		return;
 	}
 
-	// calculate packet's source and dest IP address
-	IPAddress* srcIP = NULL;
-	IPAddress* dstIP = NULL;
-	IPv4Address srcIP4Addr = IPv4Address::Zero;
-	IPv6Address srcIP6Addr = IPv6Address::Zero;
-	IPv4Address dstIP4Addr = IPv4Address::Zero;
-	IPv6Address dstIP6Addr = IPv6Address::Zero;
-	if (ipLayer->getProtocol() == IPv4)
+	// the handshake of a new connection is kept in the half-open table. The packet continues only if it promoted the connection or it's a data packet of a connection
+	// whose handshake wasn't seen
+	if (connEntry == NULL && !m_HalfOpenTable.empty())
 	{
-		srcIP4Addr = ((IPv4Layer*)ipLayer)->getSrcIpAddress();
-		srcIP = &srcIP4Addr;
-		dstIP4Addr = ((IPv4Layer*)ipLayer)->getDstIpAddress();
-		dstIP = &dstIP4Addr;
-	}
-	else if (ipLayer->getProtocol() == IPv6)
-	{
-		srcIP6Addr = ((IPv6Layer*)ipLayer)->getSrcIpAddress();
-		srcIP = &srcIP6Addr;
-		dstIP6Addr = ((IPv6Layer*)ipLayer)->getDstIpAddress();
-		dstIP = &dstIP6Addr;
+		if (!processHalfOpenSegment(segment, connEntry))
+			return;
 	}
+	else if (isPureAck)
+		return;
 
-	if (iter == m_ConnectionList.end())
-	{
-		// if it's a packet of a new connection, create a TcpReassemblyData object and add it to the active connection list
-		tcpReassemblyData = new TcpReassemblyData();
-		tcpReassemblyData->connData.setSrcIpAddress(srcIP);
-		tcpReassemblyData->connData.setDstIpAddress(dstIP);
-		tcpReassemblyData->connData.srcPort = ntohs(tcpLayer->getTcpHeader()->portSrc);
-		tcpReassemblyData->connData.dstPort = ntohs(tcpLayer->getTcpHeader()->portDst);
-		tcpReassemblyData->connData.flowKey = flowKey;
-		timeval ts = tcpData.getRawPacket()->getPacketTimeStamp();
-		tcpReassemblyData->connData.setStartTime(ts);
-
-		m_ConnectionList[flowKey] = tcpReassemblyData;
-		m_ConnectionInfo[flowKey] = tcpReassemblyData->connData;
+	// packet's source and dest IP address
+	const IPAddressValue& srcIP = segment.srcIP;
+	const IPAddressValue& dstIP = segment.dstIP;
 
-		// fire connection start callback
-		if (m_OnConnStart != NULL)
-			m_OnConnStart(tcpReassemblyData->connData, m_UserCookie);
+	if (connEntry == NULL)
+	{
+		// if it's a packet of a new connection, add it to the connection table
+		connEntry = createConnection(flowKey, srcIP, dstIP, segment.tcpHeader->portSrc, segment.tcpHeader->portDst, segment.timestamp);
+		tcpReassemblyData = connEntry->reassemblyData;
 	}
 	else // connection already exists
 	{
-		tcpReassemblyData = iter->second;
-		timeval currTime = tcpData.getRawPacket()->getPacketTimeStamp();
-		if (currTime.tv_sec > tcpReassemblyData->connData.endTime.tv_sec)
+		tcpReassemblyData = connEntry->reassemblyData;
+		m_EvictionList.touch(tcpReassemblyData->evictionId);
+		ConnectionData& connData = *tcpReassemblyData->connData;
+		const timeval& currTime = segment.timestamp;
+		if (currTime.tv_sec > connData.endTime.tv_sec)
 		{
-			tcpReassemblyData->connData.setEndTime(currTime); 
+			connData.setEndTime(currTime); 
 		}
-		else if (currTime.tv_sec == tcpReassemblyData->connData.endTime.tv_sec)
+		else if (currTime.tv_sec == connData.endTime.tv_sec)
 		{
-			if (currTime.tv_usec > tcpReassemblyData->connData.endTime.tv_usec)
+			if (currTime.tv_usec > connData.endTime.tv_usec)
 			{
-				tcpReassemblyData->connData.setEndTime(currTime);
+				connData.setEndTime(currTime);
 			}
 		}
 	}
@@ -289,7 +640,7 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 	bool first = false;
 
 	// calculate packet's source port
-	uint16_t srcPort = tcpLayer->getTcpHeader()->portSrc;
+	uint16_t srcPort = segment.tcpHeader->portSrc;
 
 	// if this is a new connection and it's the first packet we see on that connection
 	if (tcpReassemblyData->numOfSides == 0)
@@ -298,7 +649,7 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 
 		// open the first side of the connection, side index is 0
 		sideIndex = 0;
-		tcpReassemblyData->twoSides[sideIndex].setSrcIP(srcIP);
+		tcpReassemblyData->twoSides[sideIndex].srcIP = srcIP;
 		tcpReassemblyData->twoSides[sideIndex].srcPort = srcPort;
 		tcpReassemblyData->numOfSides++;
 		first = true;
@@ -307,7 +658,7 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 	else if (tcpReassemblyData->numOfSides == 1)
 	{
 		// check if packet belongs to that side
-		if (tcpReassemblyData->twoSides[0].srcIP->equals(srcIP) && tcpReassemblyData->twoSides[0].srcPort == srcPort)
+		if (tcpReassemblyData->twoSides[0].srcIP == srcIP && tcpReassemblyData->twoSides[0].srcPort == srcPort)
 		{
 			sideIndex = 0;
 		}
@@ -316,7 +667,7 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 			// this means packet belong to the second side which doesn't yet exist. Open a second side with side index 1
 			LOG_DEBUG("Setting second side of a connection");
 			sideIndex = 1;
-			tcpReassemblyData->twoSides[sideIndex].setSrcIP(srcIP);
+			tcpReassemblyData->twoSides[sideIndex].srcIP = srcIP;
 			tcpReassemblyData->twoSides[sideIndex].srcPort = srcPort;
 			tcpReassemblyData->numOfSides++;
 			first = true;
@@ -326,12 +677,12 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 	else if (tcpReassemblyData->numOfSides == 2)
 	{
 		// check if packet matches side 0
-		if (tcpReassemblyData->twoSides[0].srcIP->equals(srcIP) && tcpReassemblyData->twoSides[0].srcPort == srcPort)
+		if (tcpReassemblyData->twoSides[0].srcIP == srcIP && tcpReassemblyData->twoSides[0].srcPort == srcPort)
 		{
 			sideIndex = 0;
 		}
 		// check if packet matches side 1
-		else if (tcpReassemblyData->twoSides[1].srcIP->equals(srcIP) && tcpReassemblyData->twoSides[1].srcPort == srcPort)
+		else if (tcpReassemblyData->twoSides[1].srcIP == srcIP && tcpReassemblyData->twoSides[1].srcPort == srcPort)
 		{
 			sideIndex = 1;
 		}
@@ -356,6 +707,17 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 		return;
 	}
 
+	// a bypassed connection only waits for its FIN or RST packets. Out-of-order data left from before it was bypassed is dropped
+	if (tcpReassemblyData->bypassed)
+	{
+		m_NumOfBypassedPayloadBytes += tcpPayloadSize;
+		if (tcpReassemblyData->outOfOrderBytes > 0)
+			releaseFragments(tcpReassemblyData);
+		if (isFinOrRst)
+			handleFinOrRst(tcpReassemblyData, sideIndex, flowKey);
+		return;
+	}
+
 	// handle FIN/RST packets that don't contain additional TCP data
 	if (isFinOrRst && tcpPayloadSize == 0)
 	{
@@ -376,7 +738,7 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 	// I'm aware that there are edge cases where the situation I described above is not true, but at some point we must clean the out-of-order packet list to avoid memory leak.
 	// I decided to do what Wireshark does and clean this list when starting to see a message from the other side
 	if (!first && tcpPayloadSize > 0 && tcpReassemblyData->prevSide != -1 && tcpReassemblyData->prevSide != sideIndex &&
-			tcpReassemblyData->twoSides[tcpReassemblyData->prevSide].tcpFragmentList.size() > 0)
+			!tcpReassemblyData->twoSides[tcpReassemblyData->prevSide].tcpFragmentList.empty())
 	{
 		LOG_DEBUG("Seeing a first data packet from a different side. Previous side was %d, current side is %d", tcpReassemblyData->prevSide, sideIndex);
 		checkOutOfOrderFragments(tcpReassemblyData, tcpReassemblyData->prevSide, true);
@@ -384,7 +746,7 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 	tcpReassemblyData->prevSide = sideIndex;
 
 	// extract sequence value from packet
-	uint32_t sequence = ntohl(tcpLayer->getTcpHeader()->sequenceNumber);
+	uint32_t sequence = ntohl(segment.tcpHeader->sequenceNumber);
 
 	// if it's the first packet we see on this side of the connection
 	if (first)
@@ -393,15 +755,15 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 
 		// set initial sequence
 		tcpReassemblyData->twoSides[sideIndex].sequence = sequence + tcpPayloadSize;
-		if (tcpLayer->getTcpHeader()->synFlag != 0)
+		if (segment.tcpHeader->synFlag != 0)
 			tcpReassemblyData->twoSides[sideIndex].sequence++;
 
 		// send data to the callback
-		if (tcpPayloadSize != 0 && m_OnMessageReadyCallback != NULL)
+		if (tcpPayloadSize != 0 && hasMessageReadyCallback())
 		{
-			TcpStreamData streamData(tcpLayer->getLayerPayload(), tcpPayloadSize, tcpReassemblyData->connData);
+			TcpStreamData streamData(segment.payload, tcpPayloadSize, *tcpReassemblyData->connData);
 			streamData.setDeleteDataOnDestruction(false);
-			m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
+			notifyMessageReady(tcpReassemblyData, sideIndex, streamData);
 		}
 
 		// handle case where this packet is FIN or RST (although it's unlikely)
@@ -432,11 +794,11 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 			tcpReassemblyData->twoSides[sideIndex].sequence += tcpPayloadSize - newLength;
 
 			// send only the new data to the callback
-			if (m_OnMessageReadyCallback != NULL)
+			if (hasMessageReadyCallback())
 			{
-				TcpStreamData streamData(tcpLayer->getLayerPayload() + newLength, tcpPayloadSize - newLength, tcpReassemblyData->connData);
+				TcpStreamData streamData(segment.payload + newLength, tcpPayloadSize - newLength, *tcpReassemblyData->connData);
 				streamData.setDeleteDataOnDestruction(false);
-				m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
+				notifyMessageReady(tcpReassemblyData, sideIndex, streamData);
 			}
 		}
 
@@ -469,15 +831,15 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 		tcpReassemblyData->twoSides[sideIndex].sequence += tcpPayloadSize;
 
 		// if this is a SYN packet - add +1 to the sequence
-		if (tcpLayer->getTcpHeader()->synFlag != 0)
+		if (segment.tcpHeader->synFlag != 0)
 			tcpReassemblyData->twoSides[sideIndex].sequence++;
 
 		// send the data to the callback
-		if (m_OnMessageReadyCallback != NULL)
+		if (hasMessageReadyCallback())
 		{
-			TcpStreamData streamData(tcpLayer->getLayerPayload(), tcpPayloadSize, tcpReassemblyData->connData);
+			TcpStreamData streamData(segment.payload, tcpPayloadSize, *tcpReassemblyData->connData);
 			streamData.setDeleteDataOnDestruction(false);
-			m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
+			notifyMessageReady(tcpReassemblyData, sideIndex, streamData);
 		}
 
 		//while (checkOutOfOrderFragments(tcpReassemblyData, sideIndex)) {}
@@ -509,16 +871,21 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 			return;
 		}
 
-		// create a new TcpFragment, copy the TCP data to it and add this packet to the the out-of-order packet list
-		TcpFragment* newTcpFrag = new TcpFragment();
-		newTcpFrag->data = new uint8_t[tcpPayloadSize];
-		newTcpFrag->dataLength = tcpPayloadSize;
-		newTcpFrag->sequence = sequence;
-		memcpy(newTcpFrag->data, tcpLayer->getLayerPayload(), tcpPayloadSize);
-		tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.pushBack(newTcpFrag);
+		// copy the TCP data to a new fragment and add it to the out-of-order packet list
+		insertFragment(tcpReassemblyData, sideIndex, sequence, segment.payload, tcpPayloadSize);
 
 		LOG_DEBUG("Found out-of-order packet and added a new TCP fragment with size %d to the out-of-order list of side %d", (int)tcpPayloadSize, sideIndex);
 
+		// if too much out-of-order data is queued, stop waiting for the missing data and send what was queued on this side (and if that's not enough, on the other side)
+		bool connLimitExceeded = (m_MaxOutOfOrderBytesPerConn > 0 && tcpReassemblyData->outOfOrderBytes > m_MaxOutOfOrderBytesPerConn);
+		if (connLimitExceeded || (m_MaxOutOfOrderBytes > 0 && m_OutOfOrderBytes > m_MaxOutOfOrderBytes))
+		{
+			LOG_DEBUG("Out-of-order data limit exceeded on side %d of flow [0x%X], treating the data before the queued fragments as missing", sideIndex, flowKey);
+			checkOutOfOrderFragments(tcpReassemblyData, sideIndex, true);
+			if (connLimitExceeded && tcpReassemblyData->outOfOrderBytes > m_MaxOutOfOrderBytesPerConn)
+				checkOutOfOrderFragments(tcpReassemblyData, 1 - sideIndex, true);
+		}
+
 		// handle case where this packet is FIN or RST
 		if (isFinOrRst)
 		{
@@ -529,10 +896,325 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 	}
 }
 
+TcpReassembly::ConnectionInfoList::Entry* TcpReassembly::createConnection(uint32_t flowKey, const IPAddressValue& srcIP, const IPAddressValue& dstIP, uint16_t srcPort, uint16_t dstPort,
+		const timeval& startTime)
+{
+	// take a TcpReassemblyData object from the pool and add the connection to the connection table
+	ConnectionInfoList::Entry* connEntry = m_ConnectionInfo.insertEntry(flowKey);
+	TcpReassemblyData* tcpReassemblyData = allocateReassemblyData();
+	connEntry->reassemblyData = tcpReassemblyData;
+
+	ConnectionData& connData = connEntry->value.second;
+	connData.setSrcIpAddress(srcIP);
+	connData.setDstIpAddress(dstIP);
+	connData.srcPort = ntohs(srcPort);
+	connData.dstPort = ntohs(dstPort);
+	connData.flowKey = flowKey;
+	connData.setStartTime(startTime);
+	tcpReassemblyData->connData = &connData;
+	tcpReassemblyData->evictionId = m_EvictionList.add(flowKey, 0);
+	tcpReassemblyData->maxBytesPerSide = m_MaxBytesPerSide;
+	tcpReassemblyData->maxBytesPerConnection = m_MaxBytesPerConnection;
+	chargeMemory(tcpReassemblyData, ConnectionStateBytes);
+	m_NumOfConnectionsStarted++;
+	m_NumOfOpenConnections++;
+
+	if (m_IdleConnectionTimeout > 0)
+		connEntry->timerId = m_IdleTimers.addTimer(m_CurrentTime + m_IdleConnectionTimeout, flowKey);
+
+	// fire connection start callback
+	if (m_OnConnStart != NULL)
+		m_OnConnStart(connData, m_UserCookie);
+
+	return connEntry;
+}
+
+TcpReassembly::HalfOpenEntry* TcpReassembly::findHalfOpenEntry(uint32_t flowKey)
+{
+	HalfOpenEntry* bucket = &m_HalfOpenTable[(hashFlowKey(flowKey) & m_HalfOpenBucketMask) * HalfOpenBucketSize];
+	for (int i = 0; i < HalfOpenBucketSize; i++)
+	{
+		HalfOpenEntry& entry = bucket[i];
+		if (entry.state == HalfOpenFree || entry.flowKey != flowKey)
+			continue;
+
+		// expired entries are freed when they're found
+		if (isHalfOpenExpired(entry))
+		{
+			entry.state = HalfOpenFree;
+			m_NumOfHalfOpenConnections--;
+			m_NumOfExpiredHalfOpenConnections++;
+			return NULL;
+		}
+
+		return &entry;
+	}
+
+	return NULL;
+}
+
+TcpReassembly::HalfOpenEntry* TcpReassembly::insertHalfOpenEntry(uint32_t flowKey)
+{
+	// take a free or expired entry of the bucket, or replace the oldest one
+	HalfOpenEntry* bucket = &m_HalfOpenTable[(hashFlowKey(flowKey) & m_HalfOpenBucketMask) * HalfOpenBucketSize];
+	HalfOpenEntry* target = NULL;
+	for (int i = 0; i < HalfOpenBucketSize; i++)
+	{
+		HalfOpenEntry& entry = bucket[i];
+		if (entry.state == HalfOpenFree)
+		{
+			target = &entry;
+			m_NumOfHalfOpenConnections++;
+			break;
+		}
+
+		if (isHalfOpenExpired(entry))
+		{
+			target = &entry;
+			m_NumOfExpiredHalfOpenConnections++;
+			break;
+		}
+
+		if (target == NULL || entry.startTimeSec < target->startTimeSec ||
+				(entry.startTimeSec == target->startTimeSec && entry.startTimeUsec < target->startTimeUsec))
+			target = &entry;
+
+		if (i == HalfOpenBucketSize - 1)
+		{
+			LOG_DEBUG("Half-open table bucket is full, dropping half-open connection [0x%X]", target->flowKey);
+			m_NumOfDroppedHalfOpenConnections++;
+		}
+	}
+
+	target->flowKey = flowKey;
+	return target;
+}
+
+bool TcpReassembly::processHalfOpenSegment(const TcpSegmentInfo& segment, ConnectionInfoList::Entry*& connEntry)
+{
+	const tcphdr* tcpHeader = segment.tcpHeader;
+	uint32_t sequence = ntohl(tcpHeader->sequenceNumber);
+	uint32_t ackNumber = ntohl(tcpHeader->ackNumber);
+	bool isSyn = (tcpHeader->synFlag == 1);
+	bool isFinOrRst = (tcpHeader->finFlag == 1 || tcpHeader->rstFlag == 1);
+	bool isPureAck = (segment.payloadSize == 0 && !isSyn && !isFinOrRst);
+
+	HalfOpenEntry* halfOpen = (m_NumOfHalfOpenConnections > 0 ? findHalfOpenEntry(segment.flowKey) : NULL);
+
+	// a SYN opens a half-open connection. A retransmitted SYN keeps it, a SYN with another initial sequence number starts it over
+	if (isSyn && tcpHeader->ackFlag == 0)
+	{
+		if (halfOpen == NULL || halfOpen->clientIsn != sequence || halfOpen->clientPort != tcpHeader->portSrc)
+		{
+			if (halfOpen == NULL)
+				halfOpen = insertHalfOpenEntry(segment.flowKey);
+			halfOpen->clientIsn = sequence;
+			halfOpen->serverIsn = 0;
+			halfOpen->startTimeSec = (uint32_t)segment.timestamp.tv_sec;
+			halfOpen->startTimeUsec = (uint32_t)segment.timestamp.tv_usec;
+			halfOpen->clientPort = tcpHeader->portSrc;
+			halfOpen->state = HalfOpenSyn;
+		}
+		return false;
+	}
+
+	// without a half-open connection, a SYN-ACK or an ACK is ignored (it's backscatter or its handshake wasn't seen). Data packets open a connection as usual
+	if (halfOpen == NULL)
+		return !isSyn && !isPureAck;
+
+	// the client is the side which sent the SYN. When both ports are the same the sequence number tells the sides apart
+	bool isFromClient = (tcpHeader->portSrc == halfOpen->clientPort &&
+			(tcpHeader->portDst != halfOpen->clientPort || sequence == halfOpen->clientIsn + 1));
+
+	if (isSyn)
+	{
+		if (!isFromClient && ackNumber == halfOpen->clientIsn + 1)
+		{
+			halfOpen->serverIsn = sequence;
+			halfOpen->state = HalfOpenSynAck;
+		}
+		return false;
+	}
+
+	// a connection reset or closed before it was established never starts
+	if (isFinOrRst && segment.payloadSize == 0)
+	{
+		halfOpen->state = HalfOpenFree;
+		m_NumOfHalfOpenConnections--;
+		return false;
+	}
+
+	// the ACK completing the handshake acknowledges the SYN-ACK, if it was seen
+	if (isPureAck && (!isFromClient || sequence != halfOpen->clientIsn + 1 || (halfOpen->state == HalfOpenSynAck && ackNumber != halfOpen->serverIsn + 1)))
+		return false;
+
+	// promote the connection with the sides and sequence numbers of its handshake, so the packet continues like a packet of an existing connection
+	timeval startTime;
+	startTime.tv_sec = halfOpen->startTimeSec;
+	startTime.tv_usec = halfOpen->startTimeUsec;
+	const IPAddressValue& clientIP = (isFromClient ? segment.srcIP : segment.dstIP);
+	const IPAddressValue& serverIP = (isFromClient ? segment.dstIP : segment.srcIP);
+	uint16_t serverPort = (isFromClient ? tcpHeader->portDst : tcpHeader->portSrc);
+	HalfOpenEntry promoted = *halfOpen;
+	halfOpen->state = HalfOpenFree;
+	m_NumOfHalfOpenConnections--;
+	m_NumOfPromotedConnections++;
+
+	connEntry = createConnection(segment.flowKey, clientIP, serverIP, promoted.clientPort, serverPort, startTime);
+	TcpReassemblyData* tcpReassemblyData = connEntry->reassemblyData;
+	tcpReassemblyData->twoSides[0].srcIP = clientIP;
+	tcpReassemblyData->twoSides[0].srcPort = promoted.clientPort;
+	tcpReassemblyData->twoSides[0].sequence = promoted.clientIsn + 1;
+	tcpReassemblyData->numOfSides = 1;
+	if (promoted.state == HalfOpenSynAck)
+	{
+		tcpReassemblyData->twoSides[1].srcIP = serverIP;
+		tcpReassemblyData->twoSides[1].srcPort = serverPort;
+		tcpReassemblyData->twoSides[1].sequence = promoted.serverIsn + 1;
+		tcpReassemblyData->numOfSides = 2;
+	}
+
+	return !isPureAck;
+}
+
 void TcpReassembly::reassemblePacket(RawPacket* tcpRawData)
 {
-	Packet parsedPacket(tcpRawData, false);
-	reassemblePacket(parsedPacket);
+	processRawPacket(tcpRawData);
+
+	if (m_MemoryBudget->isExceeded())
+		evictConnections();
+}
+
+void TcpReassembly::reassemblePacket(RawPacket* tcpRawData, const PacketView& view)
+{
+	processRawPacket(tcpRawData, view);
+
+	if (m_MemoryBudget->isExceeded())
+		evictConnections();
+}
+
+void TcpReassembly::reassemblePackets(RawPacket* rawPacketsArr, size_t numOfPackets)
+{
+	for (size_t i = 0; i < numOfPackets; i++)
+		reassemblePacket(&rawPacketsArr[i]);
+}
+
+void TcpReassembly::reassembleCoalescedSegments(const TcpSegmentCoalescer& coalescer)
+{
+	for (size_t i = 0; i < coalescer.getNumOfSegments(); i++)
+	{
+		const TcpCoalescedSegment& coalescedSegment = coalescer.getSegment(i);
+		if (coalescedSegment.numOfPackets == 1)
+		{
+			reassemblePacket(coalescedSegment.packets[0]);
+			continue;
+		}
+
+		// the merged payload is processed as the payload of the first packet. The flags of the merged packets are only ACK and PSH, which
+		// the reassembly doesn't use, and the time is the time of the last packet
+		timeval timestamp = coalescedSegment.packets[coalescedSegment.numOfPackets - 1]->getPacketTimeStamp();
+		setCurrentTime(timestamp.tv_sec);
+
+		m_CoalescedPayload.resize(coalescedSegment.payloadLength);
+		coalescedSegment.copyPayload(&m_CoalescedPayload[0]);
+
+		// processSegment() counts one packet
+		m_NumOfPacketsProcessed += coalescedSegment.numOfPackets - 1;
+		uint8_t* data = (uint8_t*)coalescedSegment.packets[0]->getRawData();
+		processTcpView(data, coalescedSegment.view, &m_CoalescedPayload[0], coalescedSegment.payloadLength, timestamp);
+
+		if (m_MemoryBudget->isExceeded())
+			evictConnections();
+	}
+}
+
+void TcpReassembly::notifyMessageReady(TcpReassemblyData* tcpReassemblyData, int sideIndex, TcpStreamData& streamData)
+{
+	// the connection may have been bypassed by an earlier callback for the same packet
+	if (tcpReassemblyData->bypassed)
+		return;
+
+	// cut off the data past the byte limits of the connection
+	TcpOneSideData& sideData = tcpReassemblyData->twoSides[sideIndex];
+	uint64_t dataLength = streamData.m_DataLen;
+	if (tcpReassemblyData->maxBytesPerSide > 0 && sideData.deliveredBytes + dataLength > tcpReassemblyData->maxBytesPerSide)
+		dataLength = tcpReassemblyData->maxBytesPerSide - sideData.deliveredBytes;
+	uint64_t connDeliveredBytes = tcpReassemblyData->twoSides[0].deliveredBytes + tcpReassemblyData->twoSides[1].deliveredBytes;
+	if (tcpReassemblyData->maxBytesPerConnection > 0 && connDeliveredBytes + dataLength > tcpReassemblyData->maxBytesPerConnection)
+		dataLength = tcpReassemblyData->maxBytesPerConnection - connDeliveredBytes;
+	streamData.m_DataLen = (size_t)dataLength;
+	sideData.deliveredBytes += dataLength;
+
+	if (dataLength > 0)
+	{
+		PCPP_LATENCY_TRACE_BEGIN(callbackStart);
+
+		// in zero-copy mode the callback gets a reference to the data as is. The legacy callback gets its own copy of the data
+		if (m_OnMessageReadyZeroCopyCallback != NULL)
+			m_OnMessageReadyZeroCopyCallback(sideIndex, streamData, m_UserCookie);
+		else if (m_OnMessageReadyCallback != NULL)
+			m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
+
+		PCPP_LATENCY_TRACE_END(callbackStart, LatencyStageTcpReassemblyCallback, LatencyStageRxToTcpReassemblyCallback);
+	}
+
+	// the queued fragments aren't released here since the caller may be iterating them. They're released by checkOutOfOrderFragments() or by the next packet
+	if (isOverByteLimits(tcpReassemblyData))
+		setBypassed(tcpReassemblyData);
+}
+
+bool TcpReassembly::isOverByteLimits(const TcpReassemblyData* tcpReassemblyData)
+{
+	const TcpOneSideData* twoSides = tcpReassemblyData->twoSides;
+	if (tcpReassemblyData->maxBytesPerSide > 0 &&
+			(twoSides[0].deliveredBytes >= tcpReassemblyData->maxBytesPerSide || twoSides[1].deliveredBytes >= tcpReassemblyData->maxBytesPerSide))
+		return true;
+
+	return tcpReassemblyData->maxBytesPerConnection > 0 && twoSides[0].deliveredBytes + twoSides[1].deliveredBytes >= tcpReassemblyData->maxBytesPerConnection;
+}
+
+void TcpReassembly::setBypassed(TcpReassemblyData* tcpReassemblyData)
+{
+	if (tcpReassemblyData->bypassed)
+		return;
+
+	LOG_DEBUG("Bypassing connection with flow key 0x%X", tcpReassemblyData->connData->flowKey);
+
+	tcpReassemblyData->bypassed = true;
+	m_NumOfBypassedConnections++;
+	if (m_OnConnBypassed != NULL)
+		m_OnConnBypassed(*tcpReassemblyData->connData, m_UserCookie);
+}
+
+bool TcpReassembly::setConnectionByteLimits(uint32_t flowKey, size_t maxBytesPerSide, size_t maxBytesPerConnection)
+{
+	ConnectionInfoList::Entry* connEntry = m_ConnectionInfo.findEntry(flowKey);
+	if (connEntry == NULL || connEntry->reassemblyData == NULL)
+		return false;
+
+	TcpReassemblyData* tcpReassemblyData = connEntry->reassemblyData;
+	tcpReassemblyData->maxBytesPerSide = maxBytesPerSide;
+	tcpReassemblyData->maxBytesPerConnection = maxBytesPerConnection;
+	if (isOverByteLimits(tcpReassemblyData))
+		setBypassed(tcpReassemblyData);
+
+	return true;
+}
+
+bool TcpReassembly::bypassConnection(uint32_t flowKey)
+{
+	ConnectionInfoList::Entry* connEntry = m_ConnectionInfo.findEntry(flowKey);
+	if (connEntry == NULL || connEntry->reassemblyData == NULL)
+		return false;
+
+	setBypassed(connEntry->reassemblyData);
+	return true;
+}
+
+bool TcpReassembly::isConnectionBypassed(uint32_t flowKey) const
+{
+	const ConnectionInfoList::Entry* connEntry = m_ConnectionInfo.findEntry(flowKey);
+	return connEntry != NULL && connEntry->reassemblyData != NULL && connEntry->reassemblyData->bypassed;
 }
 
 std::string TcpReassembly::prepareMissingDataMessage(uint32_t missingDataLen)
@@ -563,177 +1245,185 @@ void TcpReassembly::handleFinOrRst(TcpReassemblyData* tcpReassemblyData, int sid
 
 void TcpReassembly::checkOutOfOrderFragments(TcpReassemblyData* tcpReassemblyData, int sideIndex, bool cleanWholeFragList)
 {
-	bool foundSomething = false;
+	TcpOneSideData& sideData = tcpReassemblyData->twoSides[sideIndex];
 
-	do
+	// fragments are sorted by sequence, so only the one with the lowest sequence has to be checked each time
+	while (!sideData.tcpFragmentList.empty())
 	{
-		LOG_DEBUG("Starting first iteration of checkOutOfOrderFragments - looking for fragments that match the current sequence or have smaller sequence");
+		// the connection was bypassed, possibly by the callback of the previous fragment, so the queued data isn't needed anymore
+		if (tcpReassemblyData->bypassed)
+		{
+			releaseFragments(tcpReassemblyData);
+			return;
+		}
 
-		int index = 0;
-		foundSomething = false;
+		TcpFragmentList::iterator fragIter = sideData.tcpFragmentList.begin();
+		uint32_t fragSequence = fragIter->first;
+		TcpFragment& curTcpFrag = fragIter->second;
 
-		do
+		// if fragment sequence matches the current sequence
+		if (fragSequence == sideData.sequence)
 		{
-			index = 0;
-			foundSomething = false;
-
-			// first fragment list iteration - go over the whole fragment list and see if can find fragments that match the current sequence
-			// or have smaller sequence but have big enough payload to get new data
-			while (index < (int)tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.size())
-			{
-				TcpFragment* curTcpFrag = tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.at(index);
+			// update sequence
+			sideData.sequence += curTcpFrag.dataLength;
 
-				// if fragment sequence matches the current sequence
-				if (curTcpFrag->sequence == tcpReassemblyData->twoSides[sideIndex].sequence)
-				{
-					// update sequence
-					tcpReassemblyData->twoSides[sideIndex].sequence += curTcpFrag->dataLength;
-					if (curTcpFrag->data != NULL)
-					{
-						LOG_DEBUG("Found an out-of-order packet matching to the current sequence with size %d on side %d. Pulling it out of the list and sending the data to the callback", (int)curTcpFrag->dataLength, sideIndex);
+			LOG_DEBUG("Found an out-of-order packet matching to the current sequence with size %d on side %d. Pulling it out of the list and sending the data to the callback", (int)curTcpFrag.dataLength, sideIndex);
 
-						// send new data to callback
+			// send new data to callback
+			if (hasMessageReadyCallback())
+			{
+				TcpStreamData streamData(curTcpFrag.data, curTcpFrag.dataLength, *tcpReassemblyData->connData);
+				streamData.setDeleteDataOnDestruction(false);
+				notifyMessageReady(tcpReassemblyData, sideIndex, streamData);
+			}
 
-						if (m_OnMessageReadyCallback != NULL)
-						{
-							TcpStreamData streamData(curTcpFrag->data, curTcpFrag->dataLength, tcpReassemblyData->connData);
-							streamData.setDeleteDataOnDestruction(false);
-							m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
-						}
-					}
+			// remove fragment from list
+			eraseFragment(tcpReassemblyData, sideIndex, fragIter);
+			continue;
+		}
 
+		// if fragment sequence has lower sequence than the current sequence
+		if (fragSequence < sideData.sequence)
+		{
+			// check if it still has new data
+			uint32_t newSequence = fragSequence + curTcpFrag.dataLength;
 
-					// remove fragment from list
-					tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.erase(tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.begin() + index);
+			// it has new data
+			if (newSequence > sideData.sequence)
+			{
+				// calculate the delta new data size
+				uint32_t newLength = sideData.sequence - fragSequence;
 
-					foundSomething = true;
+				LOG_DEBUG("Found a fragment in the out-of-order list which its sequence is lower than expected but its payload is long enough to contain new data. "
+					"Calling the callback with the new data. Fragment size is %d on side %d, new data size is %d", (int)curTcpFrag.dataLength, sideIndex, (int)(curTcpFrag.dataLength - newLength));
 
-					continue;
-				}
+				// update current sequence with the delta new data size
+				sideData.sequence += curTcpFrag.dataLength - newLength;
 
-				// if fragment sequence has lower sequence than the current sequence
-				if (curTcpFrag->sequence < tcpReassemblyData->twoSides[sideIndex].sequence)
+				// send only the new data to the callback
+				if (hasMessageReadyCallback())
 				{
-					// check if it still has new data
-					uint32_t newSequence = curTcpFrag->sequence + curTcpFrag->dataLength;
-
-					// it has new data
-					if (newSequence > tcpReassemblyData->twoSides[sideIndex].sequence)
-					{
-						// calculate the delta new data size
-						uint32_t newLength = tcpReassemblyData->twoSides[sideIndex].sequence - curTcpFrag->sequence;
-
-						LOG_DEBUG("Found a fragment in the out-of-order list which its sequence is lower than expected but its payload is long enough to contain new data. "
-							"Calling the callback with the new data. Fragment size is %d on side %d, new data size is %d", (int)curTcpFrag->dataLength, sideIndex, (int)(curTcpFrag->dataLength - newLength));
-
-						// update current sequence with the delta new data size
-						tcpReassemblyData->twoSides[sideIndex].sequence += curTcpFrag->dataLength - newLength;
-
-						// send only the new data to the callback
-						if (m_OnMessageReadyCallback != NULL)
-						{
-							TcpStreamData streamData(curTcpFrag->data + newLength, curTcpFrag->dataLength - newLength, tcpReassemblyData->connData);
-							streamData.setDeleteDataOnDestruction(false);
-							m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
-						}
-
-						foundSomething = true;
-					}
-					else
-					{
-						LOG_DEBUG("Found a fragment in the out-of-order list which doesn't contain any new data, ignoring it. Fragment size is %d on side %d", (int)curTcpFrag->dataLength, sideIndex);
-					}
-
-					// delete fragment from list
-					tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.erase(tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.begin() + index);
-
-					continue;
+					TcpStreamData streamData(curTcpFrag.data + newLength, curTcpFrag.dataLength - newLength, *tcpReassemblyData->connData);
+					streamData.setDeleteDataOnDestruction(false);
+					notifyMessageReady(tcpReassemblyData, sideIndex, streamData);
 				}
-
-				//if got to here it means the fragment has higher sequence than current sequence, increment index and continue
-				index++;
+			}
+			else
+			{
+				LOG_DEBUG("Found a fragment in the out-of-order list which doesn't contain any new data, ignoring it. Fragment size is %d on side %d", (int)curTcpFrag.dataLength, sideIndex);
 			}
 
-			// if managed to find new segment, do the search all over again
-		} while (foundSomething);
-
+			// delete fragment from list
+			eraseFragment(tcpReassemblyData, sideIndex, fragIter);
+			continue;
+		}
 
 		// if got here it means we're left only with fragments that have higher sequence than current sequence. This means out-of-order packets or
 		// missing data. If we don't want to clear the frag list yet, assume it's out-of-order and return
 		if (!cleanWholeFragList)
 			return;
 
-		LOG_DEBUG("Starting second  iteration of checkOutOfOrderFragments - handle missing data");
+		// the fragment with the closest sequence to the current one is the first in the list. Send it as the data after the missing data
 
-		// second fragment list iteration - now we're left only with fragments that have higher sequence than current sequence. This means missing data.
-		// Search for the fragment with the closest sequence to the current one
+		// calculate number of missing bytes
+		uint32_t missingDataLen = fragSequence - sideData.sequence;
 
-		uint32_t closestSequence = 0xffffffff;
-		int closestSequenceFragIndex = -1;
-		index = 0;
+		// update sequence
+		sideData.sequence = fragSequence + curTcpFrag.dataLength;
 
-		while (index < (int)tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.size())
+		// send new data to callback
+		if (hasMessageReadyCallback())
 		{
-			// extract segment at current index
-			TcpFragment* curTcpFrag = tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.at(index);
+			// prepare missing data text
+			std::string missingDataTextStr = prepareMissingDataMessage(missingDataLen);
 
-			// check if its sequence is closer than current closest sequence
-			if (curTcpFrag->sequence < closestSequence)
-			{
-				closestSequence = curTcpFrag->sequence;
-				closestSequenceFragIndex = index;
-			}
+			// add missing data text to the data that will be sent to the callback. This means that the data will look something like:
+			// "[xx bytes missing]<original_data>"
+			size_t dataWithMissingDataTextLen = missingDataTextStr.length() + curTcpFrag.dataLength;
+			uint8_t* dataWithMissingDataText = new uint8_t[dataWithMissingDataTextLen];
+			memcpy(dataWithMissingDataText, missingDataTextStr.c_str(), missingDataTextStr.length());
+			memcpy(dataWithMissingDataText + missingDataTextStr.length(), curTcpFrag.data, curTcpFrag.dataLength);
 
-			index++;
+			TcpStreamData streamData(dataWithMissingDataText, dataWithMissingDataTextLen, *tcpReassemblyData->connData);
+			notifyMessageReady(tcpReassemblyData, sideIndex, streamData);
+
+			LOG_DEBUG("Found missing data on side %d: %d byte are missing. Sending the closest fragment which is in size %d + missing text message which size is %d",
+				sideIndex, missingDataLen, (int)curTcpFrag.dataLength, (int)missingDataTextStr.length());
 		}
 
-		// this means fragment list is not empty at this stage
-		if (closestSequenceFragIndex > -1)
+		// remove fragment from list
+		eraseFragment(tcpReassemblyData, sideIndex, fragIter);
+	}
+}
+
+void TcpReassembly::insertFragment(TcpReassemblyData* tcpReassemblyData, int sideIndex, uint32_t sequence, const uint8_t* data, size_t dataLength)
+{
+	TcpFragmentList& fragList = tcpReassemblyData->twoSides[sideIndex].tcpFragmentList;
+
+	// a retransmission of a queued fragment: keep the one with the longer payload
+	TcpFragmentList::iterator fragIter = fragList.find(sequence);
+	if (fragIter != fragList.end())
+	{
+		if (fragIter->second.dataLength >= dataLength)
 		{
-			// get the fragment with the closest sequence
-			TcpFragment* curTcpFrag = tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.at(closestSequenceFragIndex);
+			LOG_DEBUG("Out-of-order packet with sequence %u is already queued on side %d, ignoring it", sequence, sideIndex);
+			return;
+		}
 
-			// calculate number of missing bytes
-			uint32_t missingDataLen = curTcpFrag->sequence - tcpReassemblyData->twoSides[sideIndex].sequence;
+		eraseFragment(tcpReassemblyData, sideIndex, fragIter);
+	}
 
-			// update sequence
-			tcpReassemblyData->twoSides[sideIndex].sequence = curTcpFrag->sequence + curTcpFrag->dataLength;
-			if (curTcpFrag->data != NULL)
-			{
-				// send new data to callback
-				if (m_OnMessageReadyCallback != NULL)
-				{
-					// prepare missing data text
-					std::string missingDataTextStr = prepareMissingDataMessage(missingDataLen);
-
-					// add missing data text to the data that will be sent to the callback. This means that the data will look something like:
-					// "[xx bytes missing]<original_data>"
-					size_t dataWithMissingDataTextLen = missingDataTextStr.length() + curTcpFrag->dataLength;
-					uint8_t* dataWithMissingDataText = new uint8_t[dataWithMissingDataTextLen];
-					memcpy(dataWithMissingDataText, missingDataTextStr.c_str(), missingDataTextStr.length());
-					memcpy(dataWithMissingDataText + missingDataTextStr.length(), curTcpFrag->data, curTcpFrag->dataLength);
-
-					//TcpStreamData streamData(curTcpFrag->data, curTcpFrag->dataLength, tcpReassemblyData->connData);
-					//streamData.setDeleteDataOnDestruction(false);
-					TcpStreamData streamData(dataWithMissingDataText, dataWithMissingDataTextLen, tcpReassemblyData->connData);
-					m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
-
-					LOG_DEBUG("Found missing data on side %d: %d byte are missing. Sending the closest fragment which is in size %d + missing text message which size is %d",
-						sideIndex, missingDataLen, (int)curTcpFrag->dataLength, (int)missingDataTextStr.length());
-				}
-			}
+	TcpFragment& newTcpFrag = fragList[sequence];
+	newTcpFrag.data = allocateFragmentBuffer(dataLength);
+	newTcpFrag.dataLength = dataLength;
+	memcpy(newTcpFrag.data, data, dataLength);
 
-			// remove fragment from list
-			tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.erase(tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.begin() + closestSequenceFragIndex);
+	tcpReassemblyData->outOfOrderBytes += dataLength;
+	m_OutOfOrderBytes += dataLength;
+	chargeMemory(tcpReassemblyData, getFragmentMemory(dataLength));
+}
 
-			LOG_DEBUG("Calling checkOutOfOrderFragments again from the start");
+void TcpReassembly::eraseFragment(TcpReassemblyData* tcpReassemblyData, int sideIndex, TcpFragmentList::iterator fragIter)
+{
+	tcpReassemblyData->outOfOrderBytes -= fragIter->second.dataLength;
+	m_OutOfOrderBytes -= fragIter->second.dataLength;
+	releaseMemory(tcpReassemblyData, getFragmentMemory(fragIter->second.dataLength));
+	releaseFragmentBuffer(fragIter->second.data, fragIter->second.dataLength);
+	tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.erase(fragIter);
+}
 
-			// call the method again from the start to do the whole search again (both iterations). 
-			// the stop condition is when the list is empty (so closestSequenceFragIndex == -1)
-			foundSomething = true;
-		}
+void TcpReassembly::releaseFragments(TcpReassemblyData* tcpReassemblyData)
+{
+	for (int sideIndex = 0; sideIndex < 2; sideIndex++)
+	{
+		TcpFragmentList& fragList = tcpReassemblyData->twoSides[sideIndex].tcpFragmentList;
+		while (!fragList.empty())
+			eraseFragment(tcpReassemblyData, sideIndex, fragList.begin());
+	}
+}
+
+uint8_t* TcpReassembly::allocateFragmentBuffer(size_t dataLength)
+{
+	if (dataLength > FragmentBufferSize)
+		return new uint8_t[dataLength];
+
+	if (m_FreeFragmentBuffers.empty())
+		return new uint8_t[FragmentBufferSize];
+
+	uint8_t* buffer = m_FreeFragmentBuffers.back();
+	m_FreeFragmentBuffers.pop_back();
+	return buffer;
+}
 
-	} while (foundSomething);
+void TcpReassembly::releaseFragmentBuffer(uint8_t* buffer, size_t dataLength)
+{
+	if (dataLength > FragmentBufferSize || m_FreeFragmentBuffers.size() >= MaxFreeFragmentBuffers)
+	{
+		delete [] buffer;
+		return;
+	}
+
+	m_FreeFragmentBuffers.push_back(buffer);
 }
 
 void TcpReassembly::closeConnection(uint32_t flowKey)
@@ -743,20 +1433,31 @@ void TcpReassembly::closeConnection(uint32_t flowKey)
 
 void TcpReassembly::closeConnectionInternal(uint32_t flowKey, ConnectionEndReason reason)
 {
-	TcpReassemblyData* tcpReassemblyData = NULL;
-	ConnectionList::iterator iter = m_ConnectionList.find(flowKey);
-	if (iter == m_ConnectionList.end())
+	ConnectionInfoList::Entry* connEntry = m_ConnectionInfo.findEntry(flowKey);
+	if (connEntry == NULL)
 	{
 		LOG_ERROR("Cannot close flow with key 0x%X: cannot find flow", flowKey);
 		return;
 	}
 
-	if (iter->second == NULL) // the connection is already closed
+	if (connEntry->reassemblyData == NULL) // the connection is already closed
 		return;
 
+	closeConnectionEntry(connEntry, reason);
+}
+
+void TcpReassembly::closeConnectionEntry(ConnectionInfoList::Entry* connEntry, ConnectionEndReason reason)
+{
+	TcpReassemblyData* tcpReassemblyData = connEntry->reassemblyData;
+	uint32_t flowKey = connEntry->value.first;
+
 	LOG_DEBUG("Closing connection with flow key 0x%X", flowKey);
 
-	tcpReassemblyData = iter->second;
+	if (connEntry->timerId != TimerWheel::InvalidTimerId)
+	{
+		m_IdleTimers.removeTimer(connEntry->timerId);
+		connEntry->timerId = TimerWheel::InvalidTimerId;
+	}
 
 	LOG_DEBUG("Calling checkOutOfOrderFragments on side 0");
 	checkOutOfOrderFragments(tcpReassemblyData, 0, true);
@@ -765,11 +1466,12 @@ void TcpReassembly::closeConnectionInternal(uint32_t flowKey, ConnectionEndReaso
 	checkOutOfOrderFragments(tcpReassemblyData, 1, true);
 
 	if (m_OnConnEnd != NULL)
-		m_OnConnEnd(tcpReassemblyData->connData, reason, m_UserCookie);
+		m_OnConnEnd(connEntry->value.second, reason, m_UserCookie);
 
-	delete tcpReassemblyData;
-	iter->second = NULL; // mark the connection as closed
-	insertIntoCleanupList(flowKey);
+	releaseReassemblyData(tcpReassemblyData);
+	connEntry->reassemblyData = NULL; // mark the connection as closed
+	m_NumOfOpenConnections--;
+	connEntry->timerId = m_CleanupTimers.addTimer(m_CurrentTime + m_ClosedConnectionDelay, flowKey);
 
 	LOG_DEBUG("Connection with flow key 0x%X is closed", flowKey);
 }
@@ -778,82 +1480,362 @@ void TcpReassembly::closeAllConnections()
 {
 	LOG_DEBUG("Closing all flows");
 
-	ConnectionList::iterator iter = m_ConnectionList.begin(), iterEnd = m_ConnectionList.end();
-	for (; iter != iterEnd; ++iter)
+	// entries don't move when connections are closed, so the table can be walked directly
+	for (uint32_t entryIndex = m_ConnectionInfo.nextEntryInUse(0); entryIndex < m_ConnectionInfo.m_NumOfEntries; entryIndex = m_ConnectionInfo.nextEntryInUse(entryIndex + 1))
 	{
-		if (iter->second == NULL) // the connection is already closed, skip it
+		ConnectionInfoList::Entry& connEntry = m_ConnectionInfo.getEntry(entryIndex);
+		if (connEntry.reassemblyData == NULL) // the connection is already closed, skip it
 			continue;
 
-		TcpReassemblyData *tcpReassemblyData = iter->second;
+		closeConnectionEntry(&connEntry, TcpReassemblyConnectionClosedManually);
+	}
+}
+
+int TcpReassembly::isConnectionOpen(const ConnectionData& connection) const
+{
+	ConnectionInfoList::Entry* connEntry = m_ConnectionInfo.findEntry(connection.flowKey);
+	if (connEntry != NULL)
+		return connEntry->reassemblyData != NULL; // If there's no reassembly data then this connection is closed
 
-		uint32_t flowKey = tcpReassemblyData->connData.flowKey;
-		LOG_DEBUG("Closing connection with flow key 0x%X", flowKey);
+	return -1;
+}
 
-		LOG_DEBUG("Calling checkOutOfOrderFragments on side 0");
-		checkOutOfOrderFragments(tcpReassemblyData, 0, true);
+uint32_t TcpReassembly::purgeClosedConnections(uint32_t maxNumToClean)
+{
+	uint32_t count = 0;
 
-		LOG_DEBUG("Calling checkOutOfOrderFragments on side 1");
-		checkOutOfOrderFragments(tcpReassemblyData, 1, true);
+	if(maxNumToClean == 0)
+		maxNumToClean = m_MaxNumToClean;
 
-		if (m_OnConnEnd != NULL)
-			m_OnConnEnd(tcpReassemblyData->connData, TcpReassemblyConnectionClosedManually, m_UserCookie);
+	// the cleanup timers of connections whose delay passed are expired in the order the connections were closed
+	uint64_t flowKey;
+	while (count < maxNumToClean && m_CleanupTimers.popExpired(flowKey))
+	{
+		m_ConnectionInfo.eraseEntry((uint32_t)flowKey);
+		count++;
+	}
 
-		delete tcpReassemblyData;
-		iter->second = NULL; // mark the connection as closed
-		insertIntoCleanupList(flowKey);
+	return count;
+}
 
-		LOG_DEBUG("Connection with flow key 0x%X is closed", flowKey);
+void TcpReassembly::advanceTime(const timeval& currentTime)
+{
+	setCurrentTime(currentTime.tv_sec);
+}
+
+void TcpReassembly::setCurrentTime(time_t currentTime)
+{
+	// time only moves forward, and the timers have a resolution of a second
+	if (currentTime <= m_CurrentTime)
+		return;
+
+	m_CurrentTime = currentTime;
+	m_IdleTimers.advance((uint64_t)currentTime);
+	m_CleanupTimers.advance((uint64_t)currentTime);
+
+	handleIdleTimers();
+
+	// automatic cleanup
+	if (m_RemoveConnInfo == true)
+		purgeClosedConnections();
+}
+
+void TcpReassembly::handleIdleTimers()
+{
+	uint64_t flowKey;
+	while (m_IdleTimers.popExpired(flowKey))
+	{
+		ConnectionInfoList::Entry* connEntry = m_ConnectionInfo.findEntry((uint32_t)flowKey);
+		if (connEntry == NULL || connEntry->reassemblyData == NULL)
+			continue;
+
+		connEntry->timerId = TimerWheel::InvalidTimerId;
+
+		// the timer isn't moved on every packet, so when it expires check when the connection was last active and set it again if the timeout didn't pass since then
+		const ConnectionData& connData = connEntry->value.second;
+		time_t lastActivity = (connData.endTime.tv_sec > connData.startTime.tv_sec ? connData.endTime.tv_sec : connData.startTime.tv_sec);
+		time_t expiryTime = lastActivity + m_IdleConnectionTimeout;
+		if (expiryTime > m_CurrentTime)
+		{
+			connEntry->timerId = m_IdleTimers.addTimer(expiryTime, flowKey);
+			continue;
+		}
+
+		LOG_DEBUG("Connection with flow key 0x%X is idle since %ld", connEntry->value.first, (long)lastActivity);
+		closeConnectionEntry(connEntry, TcpReassemblyConnectionClosedByIdleTimeout);
 	}
 }
 
-int TcpReassembly::isConnectionOpen(const ConnectionData& connection) const
+void TcpReassembly::collectMetrics(MetricsWriter& writer)
+{
+	writer.addCounter("pcpp_tcp_reassembly_packets_total", "TCP packets processed", m_NumOfPacketsProcessed);
+	writer.addCounter("pcpp_tcp_reassembly_payload_bytes_total", "TCP payload bytes processed", m_NumOfPayloadBytesProcessed);
+	writer.addCounter("pcpp_tcp_reassembly_connections_total", "TCP connections started", m_NumOfConnectionsStarted);
+	writer.addGauge("pcpp_tcp_reassembly_open_connections", "TCP connections currently open", (double)m_NumOfOpenConnections);
+	writer.addCounter("pcpp_tcp_reassembly_evicted_connections_total", "TCP connections closed because the memory budget was exceeded", m_NumOfEvictedConnections);
+	writer.addCounter("pcpp_tcp_reassembly_bypassed_connections_total", "TCP connections bypassed after reaching their byte limits or by the user", m_NumOfBypassedConnections);
+	writer.addCounter("pcpp_tcp_reassembly_bypassed_payload_bytes_total", "TCP payload bytes of bypassed connections which weren't reassembled", m_NumOfBypassedPayloadBytes);
+	writer.addGauge("pcpp_tcp_reassembly_out_of_order_bytes", "Out-of-order TCP payload bytes currently queued", (double)m_OutOfOrderBytes);
+	writer.addGauge("pcpp_tcp_reassembly_memory_bytes", "Memory taken by the open TCP connections", (double)m_MemoryBytes);
+	if (!m_HalfOpenTable.empty())
+	{
+		writer.addGauge("pcpp_tcp_reassembly_half_open_connections", "Entries in use in the TCP half-open table", (double)m_NumOfHalfOpenConnections);
+		writer.addCounter("pcpp_tcp_reassembly_promoted_connections_total", "TCP half-open connections promoted to the connection table", m_NumOfPromotedConnections);
+		writer.addCounter("pcpp_tcp_reassembly_expired_half_open_connections_total", "TCP half-open connections which expired", m_NumOfExpiredHalfOpenConnections);
+		writer.addCounter("pcpp_tcp_reassembly_dropped_half_open_connections_total", "TCP half-open connections dropped because the half-open table was full", m_NumOfDroppedHalfOpenConnections);
+	}
+}
+
+void TcpReassembly::saveState(CheckpointWriter& writer) const
 {
-	ConnectionList::const_iterator iter = m_ConnectionList.find(connection.flowKey);
-	if (iter != m_ConnectionList.end())
-		return iter->second != NULL; // If the value of mapped type is NULL then this connection is closed
+	writer.writeUInt32(CheckpointMagic);
+	writer.writeUInt16(CheckpointVersion);
+	writer.writeUInt64((uint64_t)m_CurrentTime);
+	writer.writeUInt32((uint32_t)m_ConnectionInfo.size());
 
-	return -1;
+	// most of a checkpoint is usually the out-of-order data, so reserving room for it and for the fixed part of each connection avoids reallocating the buffer
+	writer.reserve(m_ConnectionInfo.size() * 128 + m_OutOfOrderBytes);
+
+	for (uint32_t entryIndex = m_ConnectionInfo.nextEntryInUse(0); entryIndex < m_ConnectionInfo.m_NumOfEntries; entryIndex = m_ConnectionInfo.nextEntryInUse(entryIndex + 1))
+	{
+		const ConnectionInfoList::Entry& connEntry = m_ConnectionInfo.getEntry(entryIndex);
+		const ConnectionData& connData = connEntry.value.second;
+
+		writer.writeUInt32(connEntry.value.first);
+		writer.writeIPAddress(connData.srcIP);
+		writer.writeIPAddress(connData.dstIP);
+		writer.writeUInt16((uint16_t)connData.srcPort);
+		writer.writeUInt16((uint16_t)connData.dstPort);
+		writer.writeUInt64((uint64_t)connData.startTime.tv_sec);
+		writer.writeUInt32((uint32_t)connData.startTime.tv_usec);
+		writer.writeUInt64((uint64_t)connData.endTime.tv_sec);
+		writer.writeUInt32((uint32_t)connData.endTime.tv_usec);
+
+		// the idle timer of an open connection or the cleanup timer of a closed connection, 0 if it has none
+		const TcpReassemblyData* tcpReassemblyData = connEntry.reassemblyData;
+		const TimerWheel& timers = (tcpReassemblyData != NULL ? m_IdleTimers : m_CleanupTimers);
+		writer.writeUInt64(connEntry.timerId != TimerWheel::InvalidTimerId ? timers.getExpiryTick(connEntry.timerId) : 0);
+
+		writer.writeUInt8(tcpReassemblyData != NULL ? 1 : 0);
+		if (tcpReassemblyData == NULL)
+			continue;
+
+		writer.writeUInt8((uint8_t)tcpReassemblyData->numOfSides);
+		writer.writeUInt8((uint8_t)(tcpReassemblyData->prevSide + 1));
+		writer.writeUInt64(tcpReassemblyData->maxBytesPerSide);
+		writer.writeUInt64(tcpReassemblyData->maxBytesPerConnection);
+		writer.writeUInt8(tcpReassemblyData->bypassed ? 1 : 0);
+		for (int sideIndex = 0; sideIndex < 2; sideIndex++)
+		{
+			const TcpOneSideData& side = tcpReassemblyData->twoSides[sideIndex];
+			writer.writeIPAddress(side.srcIP);
+			writer.writeUInt16(side.srcPort);
+			writer.writeUInt32(side.sequence);
+			writer.writeUInt8(side.gotFinOrRst ? 1 : 0);
+			writer.writeUInt64(side.deliveredBytes);
+			writer.writeUInt32((uint32_t)side.tcpFragmentList.size());
+			for (TcpFragmentList::const_iterator fragIter = side.tcpFragmentList.begin(); fragIter != side.tcpFragmentList.end(); fragIter++)
+			{
+				writer.writeUInt32(fragIter->first);
+				writer.writeUInt32((uint32_t)fragIter->second.dataLength);
+				writer.writeBytes(fragIter->second.data, fragIter->second.dataLength);
+			}
+		}
+	}
 }
 
-void TcpReassembly::insertIntoCleanupList(uint32_t flowKey)
+bool TcpReassembly::saveState(const std::string& fileName) const
 {
-	// m_CleanupList is a map with key of type time_t (expiration time). The mapped type is a list that stores the flow keys to be cleared in certain point of time.
-	// m_CleanupList.insert inserts an empty list if the container does not already contain an element with an equivalent key,
-	// otherwise this method returns an iterator to the element that prevents insertion.
-	std::pair<CleanupList::iterator, bool> pair = m_CleanupList.insert(std::make_pair(time(NULL) + m_ClosedConnectionDelay, CleanupList::mapped_type()));
+	std::vector<uint8_t> checkpoint;
+	CheckpointWriter writer(checkpoint);
+	saveState(writer);
+
+	if (!writeCheckpointFile(fileName, checkpoint))
+	{
+		LOG_ERROR("Cannot write the checkpoint file '%s'", fileName.c_str());
+		return false;
+	}
 
-	// dereferencing of map iterator and getting the reference to list
-	CleanupList::mapped_type &keysList = pair.first->second;
-	keysList.push_back(flowKey);
+	return true;
 }
 
-uint32_t TcpReassembly::purgeClosedConnections(uint32_t maxNumToClean)
+bool TcpReassembly::restoreState(CheckpointReader& reader)
 {
-	uint32_t count = 0;
+	if (!m_ConnectionInfo.empty())
+	{
+		LOG_ERROR("Cannot restore the state of connections to an instance which already manages connections");
+		return false;
+	}
 
-	if(maxNumToClean == 0)
-		maxNumToClean = m_MaxNumToClean;
+	// the checkpoint is read once to validate it and count the open connections before anything is changed, and a second time to build the state
+	CheckpointReader validationReader = reader;
+	uint32_t magic = validationReader.readUInt32();
+	uint16_t version = validationReader.readUInt16();
+	uint64_t currentTime = validationReader.readUInt64();
+	uint32_t numOfConnections = validationReader.readUInt32();
+	if (!validationReader.isValid() || magic != CheckpointMagic || version < 1 || version > CheckpointVersion)
+	{
+		LOG_ERROR("The checkpoint doesn't contain a TcpReassembly state of a supported version");
+		return false;
+	}
+
+	size_t numOfOpenConnections = readConnections(validationReader, version, numOfConnections, false);
+	if (!validationReader.isValid())
+	{
+		LOG_ERROR("The TcpReassembly state in the checkpoint is truncated or corrupted");
+		return false;
+	}
+
+	// move the time and the timers to when the state was saved so the saved expiry times stay in the future
+	setCurrentTime((time_t)currentTime);
+
+	// size the table for all connections and allocate the state of all open connections at once, so building the state doesn't rehash or allocate per connection
+	m_ConnectionInfo.m_Index.reserve((size_t)numOfConnections);
+	if (numOfOpenConnections > m_FreeReassemblyData.size())
+		allocateReassemblyDataBlock(numOfOpenConnections - m_FreeReassemblyData.size());
+
+	reader.readUInt32();
+	reader.readUInt16();
+	reader.readUInt64();
+	reader.readUInt32();
+	readConnections(reader, version, numOfConnections, true);
+	m_NumOfOpenConnections += numOfOpenConnections;
+
+	// the saved state may not fit in the budget of this instance
+	evictConnections();
+
+	return true;
+}
+
+bool TcpReassembly::restoreState(const std::string& fileName)
+{
+	std::vector<uint8_t> checkpoint;
+	if (!readCheckpointFile(fileName, checkpoint))
+	{
+		LOG_ERROR("Cannot read the checkpoint file '%s'", fileName.c_str());
+		return false;
+	}
 
-	CleanupList::iterator iterTime = m_CleanupList.begin(), iterTimeEnd = m_CleanupList.upper_bound(time(NULL));
-	while(iterTime != iterTimeEnd && count < maxNumToClean)
+	CheckpointReader reader(checkpoint.empty() ? NULL : &checkpoint[0], checkpoint.size());
+	return restoreState(reader);
+}
+
+size_t TcpReassembly::readConnections(CheckpointReader& reader, uint16_t version, uint32_t numOfConnections, bool build)
+{
+	size_t numOfOpenConnections = 0;
+
+	for (uint32_t i = 0; i < numOfConnections && reader.isValid(); i++)
 	{
-		CleanupList::mapped_type &keysList = iterTime->second;
-		CleanupList::mapped_type::iterator iterKey = keysList.begin(), iterKeyEnd = keysList.end();
+		ConnectionData connData;
+		connData.flowKey = reader.readUInt32();
+		connData.srcIP = reader.readIPAddress();
+		connData.dstIP = reader.readIPAddress();
+		connData.srcPort = reader.readUInt16();
+		connData.dstPort = reader.readUInt16();
+		connData.startTime.tv_sec = (time_t)reader.readUInt64();
+		connData.startTime.tv_usec = (long)reader.readUInt32();
+		connData.endTime.tv_sec = (time_t)reader.readUInt64();
+		connData.endTime.tv_usec = (long)reader.readUInt32();
+		uint64_t timerExpiry = reader.readUInt64();
+		uint8_t isOpen = reader.readUInt8();
+		if (isOpen > 1)
+			reader.setFailed();
+
+		// a flow key which appears twice is kept once. It can only be found while building the state, since validating doesn't index the connections
+		ConnectionInfoList::Entry* connEntry = NULL;
+		if (build)
+		{
+			if (m_ConnectionInfo.findEntry(connData.flowKey) == NULL)
+			{
+				connEntry = m_ConnectionInfo.insertEntry(connData.flowKey);
+				connEntry->value.second = connData;
+			}
+			else
+				LOG_DEBUG("Flow key 0x%X appears in the checkpoint more than once, keeping its first state", connData.flowKey);
+		}
 
-		for(; iterKey != iterKeyEnd && count < maxNumToClean; ++count)
+		if (!isOpen)
 		{
-			m_ConnectionInfo.erase(*iterKey);
-			m_ConnectionList.erase(*iterKey);
-			keysList.erase(iterKey++);
+			if (connEntry != NULL)
+				connEntry->timerId = m_CleanupTimers.addTimer(timerExpiry != 0 ? timerExpiry : (uint64_t)m_CurrentTime + m_ClosedConnectionDelay, connData.flowKey);
+			continue;
 		}
 
-		if(keysList.empty())
-			m_CleanupList.erase(iterTime++);
-		else
-			++iterTime;
+		numOfOpenConnections++;
+
+		TcpReassemblyData* tcpReassemblyData = NULL;
+		if (connEntry != NULL)
+		{
+			tcpReassemblyData = allocateReassemblyData();
+			connEntry->reassemblyData = tcpReassemblyData;
+			tcpReassemblyData->connData = &(connEntry->value.second);
+			tcpReassemblyData->evictionId = m_EvictionList.add(connData.flowKey, 0);
+			chargeMemory(tcpReassemblyData, ConnectionStateBytes);
+
+			if (m_IdleConnectionTimeout > 0)
+				connEntry->timerId = m_IdleTimers.addTimer(timerExpiry != 0 ? timerExpiry : (uint64_t)m_CurrentTime + m_IdleConnectionTimeout, connData.flowKey);
+		}
+
+		uint8_t numOfSides = reader.readUInt8();
+		uint8_t prevSide = reader.readUInt8();
+		if (numOfSides > 2 || prevSide > 2)
+			reader.setFailed();
+
+		// connections of a version 1 checkpoint get the limits of this instance
+		uint64_t maxBytesPerSide = m_MaxBytesPerSide;
+		uint64_t maxBytesPerConnection = m_MaxBytesPerConnection;
+		uint8_t bypassed = 0;
+		if (version >= 2)
+		{
+			maxBytesPerSide = reader.readUInt64();
+			maxBytesPerConnection = reader.readUInt64();
+			bypassed = reader.readUInt8();
+			if (bypassed > 1)
+				reader.setFailed();
+		}
+
+		if (tcpReassemblyData != NULL)
+		{
+			tcpReassemblyData->numOfSides = numOfSides;
+			tcpReassemblyData->prevSide = (int)prevSide - 1;
+			tcpReassemblyData->maxBytesPerSide = maxBytesPerSide;
+			tcpReassemblyData->maxBytesPerConnection = maxBytesPerConnection;
+			tcpReassemblyData->bypassed = (bypassed != 0);
+		}
+
+		for (int sideIndex = 0; sideIndex < 2; sideIndex++)
+		{
+			IPAddressValue srcIP = reader.readIPAddress();
+			uint16_t srcPort = reader.readUInt16();
+			uint32_t sequence = reader.readUInt32();
+			uint8_t gotFinOrRst = reader.readUInt8();
+			uint64_t deliveredBytes = (version >= 2 ? reader.readUInt64() : 0);
+			uint32_t numOfFragments = reader.readUInt32();
+			if (gotFinOrRst > 1)
+				reader.setFailed();
+
+			if (tcpReassemblyData != NULL)
+			{
+				TcpOneSideData& side = tcpReassemblyData->twoSides[sideIndex];
+				side.srcIP = srcIP;
+				side.srcPort = srcPort;
+				side.sequence = sequence;
+				side.gotFinOrRst = (gotFinOrRst != 0);
+				side.deliveredBytes = deliveredBytes;
+			}
+
+			for (uint32_t j = 0; j < numOfFragments && reader.isValid(); j++)
+			{
+				uint32_t fragSequence = reader.readUInt32();
+				uint32_t dataLength = reader.readUInt32();
+				const uint8_t* data = reader.readBytes(dataLength);
+				if (tcpReassemblyData != NULL && data != NULL)
+					insertFragment(tcpReassemblyData, sideIndex, fragSequence, data, dataLength);
+			}
+		}
 	}
 
-	return count;
+	return numOfOpenConnections;
 }
 
 }
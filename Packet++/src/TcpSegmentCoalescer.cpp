@@ -0,0 +1,245 @@
+#include "TcpSegmentCoalescer.h"
+#include <string.h>
+
+#define TCP_FLAG_PSH 0x08
+#define TCP_FLAG_ACK 0x10
+
+// the smallest connection table, so tiny bursts don't resize it for every burst
+#define MIN_CONNECTION_TABLE_SIZE 64
+
+namespace pcpp
+{
+
+static inline uint32_t readUInt32(const uint8_t* data)
+{
+	return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+size_t TcpCoalescedSegment::copyPayload(uint8_t* buffer) const
+{
+	size_t offset = 0;
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		memcpy(buffer + offset, spans[i].data, spans[i].length);
+		offset += spans[i].length;
+	}
+
+	return offset;
+}
+
+TcpSegmentCoalescer::TcpSegmentCoalescer(const TcpSegmentCoalescerConfiguration& config)
+	: m_Config(config), m_ConnectionMask(0), m_NumOfMergedPackets(0)
+{
+}
+
+size_t TcpSegmentCoalescer::coalesce(RawPacket* rawPacketsArr, size_t numOfPackets)
+{
+	startBurst(numOfPackets);
+	for (size_t i = 0; i < numOfPackets; i++)
+		addPacket(&rawPacketsArr[i]);
+
+	return endBurst();
+}
+
+size_t TcpSegmentCoalescer::coalesce(RawPacket* const* rawPackets, size_t numOfPackets)
+{
+	startBurst(numOfPackets);
+	for (size_t i = 0; i < numOfPackets; i++)
+		addPacket(rawPackets[i]);
+
+	return endBurst();
+}
+
+void TcpSegmentCoalescer::startBurst(size_t numOfPackets)
+{
+	m_Segments.clear();
+	m_BurstPackets.clear();
+	m_BurstSegmentIndices.clear();
+	m_BurstSpans.clear();
+
+	// keep the table at most half full so probing stays short
+	size_t tableSize = MIN_CONNECTION_TABLE_SIZE;
+	while (tableSize < 2 * numOfPackets)
+		tableSize *= 2;
+
+	if (m_Connections.size() < tableSize)
+		m_Connections.resize(tableSize);
+
+	m_ConnectionMask = tableSize - 1;
+	for (size_t i = 0; i < tableSize; i++)
+		m_Connections[i].segmentIndex = -2;
+}
+
+TcpSegmentCoalescer::OpenSegment& TcpSegmentCoalescer::findConnection(const FlowTuple& tuple, bool& isReverse)
+{
+	uint32_t hash = FlowHash::hashSymmetric(tuple);
+	size_t index = hash & m_ConnectionMask;
+	while (true)
+	{
+		OpenSegment& slot = m_Connections[index];
+		if (slot.segmentIndex == -2)
+		{
+			slot.tuple = tuple;
+			slot.hash = hash;
+			slot.segmentIndex = -1;
+			isReverse = false;
+			return slot;
+		}
+
+		if (slot.hash == hash && slot.tuple.protocol == tuple.protocol && slot.tuple.ipVersion == tuple.ipVersion)
+		{
+			if (slot.tuple.srcPort == tuple.srcPort && slot.tuple.dstPort == tuple.dstPort &&
+					memcmp(slot.tuple.srcIP, tuple.srcIP, sizeof(tuple.srcIP)) == 0 && memcmp(slot.tuple.dstIP, tuple.dstIP, sizeof(tuple.dstIP)) == 0)
+			{
+				isReverse = false;
+				return slot;
+			}
+
+			if (slot.tuple.srcPort == tuple.dstPort && slot.tuple.dstPort == tuple.srcPort &&
+					memcmp(slot.tuple.srcIP, tuple.dstIP, sizeof(tuple.dstIP)) == 0 && memcmp(slot.tuple.dstIP, tuple.srcIP, sizeof(tuple.srcIP)) == 0)
+			{
+				isReverse = true;
+				return slot;
+			}
+		}
+
+		index = (index + 1) & m_ConnectionMask;
+	}
+}
+
+size_t TcpSegmentCoalescer::addSegment(const PacketView* view)
+{
+	m_Segments.push_back(TcpCoalescedSegment());
+	TcpCoalescedSegment& segment = m_Segments.back();
+	if (view != NULL)
+		segment.view = *view;
+	else
+		memset(&segment.view, 0, sizeof(segment.view));
+
+	segment.isViewValid = (view != NULL);
+	segment.numOfPackets = 1;
+	segment.packets = NULL;
+	segment.packetIndices = NULL;
+	segment.spans = NULL;
+	segment.sequenceNumber = 0;
+	segment.payloadLength = 0;
+
+	size_t segmentIndex = m_Segments.size() - 1;
+	m_BurstSegmentIndices.push_back(segmentIndex);
+	return segmentIndex;
+}
+
+void TcpSegmentCoalescer::addPacket(RawPacket* rawPacket)
+{
+	m_BurstPackets.push_back(rawPacket);
+	TcpPayloadSpan emptySpan = { NULL, 0 };
+	m_BurstSpans.push_back(emptySpan);
+
+	PacketView view;
+	if (!FlowKeyExtractor::extract(rawPacket, view))
+	{
+		addSegment(NULL);
+		return;
+	}
+
+	FlowTuple tuple;
+	if (!view.isPacketOfType(TCP) || view.isFragment || !FlowHash::getTuple(view, tuple))
+	{
+		addSegment(&view);
+		return;
+	}
+
+	// pure ACKs neither continue nor end a segment
+	if (view.tcpFlags == TCP_FLAG_ACK && view.payloadLength == 0)
+	{
+		addSegment(&view);
+		return;
+	}
+
+	bool isReverse;
+	OpenSegment& connection = findConnection(tuple, isReverse);
+
+	const uint8_t* data = rawPacket->getRawData();
+	bool isMergeable = (view.tcpFlags & ~(TCP_FLAG_ACK | TCP_FLAG_PSH)) == 0 && (view.tcpFlags & TCP_FLAG_ACK) != 0 &&
+			view.payloadOffset != PacketView::NoOffset && view.payloadLength > 0 && view.payloadLength <= m_Config.maxSegmentLength &&
+			(size_t)view.payloadOffset + view.payloadLength <= (size_t)rawPacket->getRawDataLen();
+	uint32_t sequence = readUInt32(data + view.transportOffset + 4);
+	bool isPush = (view.tcpFlags & TCP_FLAG_PSH) != 0;
+
+	if (isMergeable)
+	{
+		TcpPayloadSpan& span = m_BurstSpans.back();
+		span.data = data + view.payloadOffset;
+		span.length = view.payloadLength;
+	}
+
+	if (connection.segmentIndex >= 0 && !isReverse && isMergeable && sequence == connection.nextSequence)
+	{
+		TcpCoalescedSegment& segment = m_Segments[connection.segmentIndex];
+		if (segment.numOfPackets < m_Config.maxPacketsPerSegment && segment.payloadLength + view.payloadLength <= m_Config.maxSegmentLength)
+		{
+			m_BurstSegmentIndices.push_back((size_t)connection.segmentIndex);
+			segment.numOfPackets++;
+			segment.payloadLength += view.payloadLength;
+			connection.nextSequence += view.payloadLength;
+			m_NumOfMergedPackets++;
+			if (isPush)
+				connection.segmentIndex = -1;
+			return;
+		}
+	}
+
+	// the packet doesn't continue the segment of the connection, so the segment is done and the packet starts a new one
+	connection.segmentIndex = -1;
+	size_t segmentIndex = addSegment(&view);
+	if (!isMergeable)
+		return;
+
+	TcpCoalescedSegment& segment = m_Segments[segmentIndex];
+	segment.sequenceNumber = sequence;
+	segment.payloadLength = view.payloadLength;
+	if (!isPush)
+	{
+		connection.tuple = tuple;
+		connection.segmentIndex = (int)segmentIndex;
+		connection.nextSequence = sequence + view.payloadLength;
+	}
+}
+
+size_t TcpSegmentCoalescer::endBurst()
+{
+	size_t numOfPackets = m_BurstPackets.size();
+	m_SegmentPackets.resize(numOfPackets);
+	m_SegmentPacketIndices.resize(numOfPackets);
+	m_SegmentSpans.resize(numOfPackets);
+
+	// group the packets by segment: first the offset of each segment, then the packets in their order
+	m_SegmentOffsets.resize(m_Segments.size());
+	size_t offset = 0;
+	for (size_t i = 0; i < m_Segments.size(); i++)
+	{
+		m_SegmentOffsets[i] = offset;
+		offset += m_Segments[i].numOfPackets;
+	}
+
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		size_t position = m_SegmentOffsets[m_BurstSegmentIndices[i]]++;
+		m_SegmentPackets[position] = m_BurstPackets[i];
+		m_SegmentPacketIndices[position] = i;
+		m_SegmentSpans[position] = m_BurstSpans[i];
+	}
+
+	for (size_t i = 0; i < m_Segments.size(); i++)
+	{
+		TcpCoalescedSegment& segment = m_Segments[i];
+		size_t first = m_SegmentOffsets[i] - segment.numOfPackets;
+		segment.packets = &m_SegmentPackets[first];
+		segment.packetIndices = &m_SegmentPacketIndices[first];
+		segment.spans = &m_SegmentSpans[first];
+	}
+
+	return m_Segments.size();
+}
+
+} // namespace pcpp
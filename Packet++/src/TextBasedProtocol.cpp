@@ -1,9 +1,10 @@
 #include "TextBasedProtocol.h"
 #include "Logger.h"
 #include "PayloadLayer.h"
+#include "GeneralUtils.h"
 #include <string.h>
-#include <algorithm>
 #include <stdlib.h>
+#include <new>
 
 namespace pcpp
 {
@@ -23,7 +24,7 @@ size_t tbp_my_own_strnlen(const char *s, size_t n)
 
 
 TextBasedProtocolMessage::TextBasedProtocolMessage(uint8_t* data, size_t dataLen, Layer* prevLayer, Packet* packet) : Layer(data, dataLen, prevLayer, packet),
-						m_FieldList(NULL), m_LastField(NULL), m_FieldsOffset(0) {}
+						m_FieldList(NULL), m_LastField(NULL), m_FieldsOffset(0), m_ParsedFields(NULL), m_ParsedFieldsCapacity(0), m_NextInsertionIndex(0) {}
 
 TextBasedProtocolMessage::TextBasedProtocolMessage(const TextBasedProtocolMessage& other) : Layer(other)
 {
@@ -34,13 +35,7 @@ TextBasedProtocolMessage::TextBasedProtocolMessage(const TextBasedProtocolMessag
 TextBasedProtocolMessage& TextBasedProtocolMessage::operator=(const TextBasedProtocolMessage& other)
 {
 	Layer::operator=(other);
-	HeaderField* curField = m_FieldList;
-	while (curField != NULL)
-	{
-		HeaderField* temp = curField;
-		curField = curField->getNextField();
-		delete temp;
-	}
+	deleteAllFields();
 
 	copyDataFrom(other);
 
@@ -49,17 +44,24 @@ TextBasedProtocolMessage& TextBasedProtocolMessage::operator=(const TextBasedPro
 
 void TextBasedProtocolMessage::copyDataFrom(const TextBasedProtocolMessage& other)
 {
+	// the copied fields are allocated separately
+	m_ParsedFields = NULL;
+	m_ParsedFieldsCapacity = 0;
+	m_NextInsertionIndex = 0;
+
 	// copy field list
 	if (other.m_FieldList != NULL)
 	{
 		m_FieldList = new HeaderField(*(other.m_FieldList));
 		HeaderField* curField = m_FieldList;
 		curField->attachToTextBasedProtocolMessage(this, other.m_FieldList->m_NameOffsetInMessage);
+		curField->m_InsertionIndex = m_NextInsertionIndex++;
 		HeaderField* curOtherField = other.m_FieldList;
 		while (curOtherField->getNextField() != NULL)
 		{
 			HeaderField* newField = new HeaderField(*(curOtherField->getNextField()));
 			newField->attachToTextBasedProtocolMessage(this, curOtherField->getNextField()->m_NameOffsetInMessage);
+			newField->m_InsertionIndex = m_NextInsertionIndex++;
 			curField->setNextField(newField);
 			curField = curField->getNextField();
 			curOtherField = curOtherField->getNextField();
@@ -74,13 +76,6 @@ void TextBasedProtocolMessage::copyDataFrom(const TextBasedProtocolMessage& othe
 	}
 
 	m_FieldsOffset = other.m_FieldsOffset;
-
-	// copy map
-	for(HeaderField* field = m_FieldList; field != NULL; field = field->getNextField())
-	{
-		m_FieldNameToFieldMap.insert(std::pair<std::string, HeaderField*>(field->getFieldName(), field));
-	}
-
 }
 
 
@@ -89,19 +84,45 @@ void TextBasedProtocolMessage::parseFields()
 	char nameValueSeperator = getHeaderFieldNameValueSeparator();
 	bool spacesAllowedBetweenNameAndValue = spacesAllowedBetweenHeaderFieldNameAndValue();
 
-	HeaderField* firstField = new HeaderField(this, m_FieldsOffset, nameValueSeperator, spacesAllowedBetweenNameAndValue);
+	// count the header lines first so all fields are constructed in a single block. The count stops at the same places the parsing
+	// loop below stops, so it's never lower than the number of fields
+	size_t numOfLines = 1;
+	size_t lineOffset = m_FieldsOffset;
+	while (lineOffset < m_DataLen && m_Data[lineOffset] != '\r' && m_Data[lineOffset] != '\n')
+	{
+		uint8_t* lineEndPtr = (uint8_t*)memchr(m_Data + lineOffset, '\n', m_DataLen - lineOffset);
+		if (lineEndPtr == NULL)
+			break;
+
+		lineOffset = lineEndPtr - m_Data + 1;
+		if (lineOffset < m_DataLen)
+			numOfLines++;
+	}
+
+	size_t numOfParsedFields = 0;
+	if (m_ParsedFields == NULL)
+	{
+		m_ParsedFields = (HeaderField*)::operator new(numOfLines * sizeof(HeaderField));
+		m_ParsedFieldsCapacity = numOfLines;
+	}
+	else
+	{
+		// fields were already parsed into the block, the new ones are allocated separately
+		numOfParsedFields = m_ParsedFieldsCapacity;
+	}
+
+	HeaderField* firstField = (numOfParsedFields < m_ParsedFieldsCapacity ?
+			new(m_ParsedFields + numOfParsedFields++) HeaderField(this, m_FieldsOffset, nameValueSeperator, spacesAllowedBetweenNameAndValue) :
+			new HeaderField(this, m_FieldsOffset, nameValueSeperator, spacesAllowedBetweenNameAndValue));
 	LOG_DEBUG("Added new field: name='%s'; offset in packet=%d; length=%d", firstField->getFieldName().c_str(), firstField->m_NameOffsetInMessage, (int)firstField->getFieldSize());
 	LOG_DEBUG("     Field value = %s", firstField->getFieldValue().c_str());
+	firstField->m_InsertionIndex = m_NextInsertionIndex++;
 
 	if (m_FieldList == NULL)
 		m_FieldList = firstField;
 	else
 		m_FieldList->setNextField(firstField);
 
-	std::string fieldName = firstField->getFieldName();
-	std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::tolower);
-	m_FieldNameToFieldMap.insert(std::pair<std::string, HeaderField*>(fieldName, firstField));
-
 	// Last field will be empty and contain just "\n" or "\r\n". This field will mark the end of the header
 	HeaderField* curField = m_FieldList;
 	int curOffset = m_FieldsOffset;
@@ -111,20 +132,20 @@ void TextBasedProtocolMessage::parseFields()
 	while (!curField->isEndOfHeader() && curOffset + curField->getFieldSize() < m_DataLen)
 	{
 		curOffset += curField->getFieldSize();
-		HeaderField* newField = new HeaderField(this, curOffset, nameValueSeperator, spacesAllowedBetweenNameAndValue);
+		HeaderField* newField = (numOfParsedFields < m_ParsedFieldsCapacity ?
+				new(m_ParsedFields + numOfParsedFields++) HeaderField(this, curOffset, nameValueSeperator, spacesAllowedBetweenNameAndValue) :
+				new HeaderField(this, curOffset, nameValueSeperator, spacesAllowedBetweenNameAndValue));
 		if(newField->getFieldSize() > 0)
 		{
 			LOG_DEBUG("Added new field: name='%s'; offset in packet=%d; length=%d", newField->getFieldName().c_str(), newField->m_NameOffsetInMessage, (int)newField->getFieldSize());
 			LOG_DEBUG("     Field value = %s", newField->getFieldValue().c_str());
+			newField->m_InsertionIndex = m_NextInsertionIndex++;
 			curField->setNextField(newField);
 			curField = newField;
-			fieldName = newField->getFieldName();
-			std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::tolower);
-			m_FieldNameToFieldMap.insert(std::pair<std::string, HeaderField *>(fieldName, newField));
 		}
 		else
 		{
-			delete newField;
+			deleteField(newField);
 			break;
 		}
 	}
@@ -134,13 +155,32 @@ void TextBasedProtocolMessage::parseFields()
 
 
 TextBasedProtocolMessage::~TextBasedProtocolMessage()
+{
+	deleteAllFields();
+}
+
+void TextBasedProtocolMessage::deleteField(HeaderField* field)
+{
+	// fields in the parsed fields block are only destructed, the block is freed with the message
+	if (m_ParsedFields != NULL && field >= m_ParsedFields && field < m_ParsedFields + m_ParsedFieldsCapacity)
+		field->~HeaderField();
+	else
+		delete field;
+}
+
+void TextBasedProtocolMessage::deleteAllFields()
 {
 	while (m_FieldList != NULL)
 	{
 		HeaderField* temp = m_FieldList;
 		m_FieldList = m_FieldList->getNextField();
-		delete temp;
+		deleteField(temp);
 	}
+
+	m_LastField = NULL;
+	::operator delete(m_ParsedFields);
+	m_ParsedFields = NULL;
+	m_ParsedFieldsCapacity = 0;
 }
 
 
@@ -225,6 +265,7 @@ HeaderField* TextBasedProtocolMessage::insertField(HeaderField* prevField, const
 
 	// attach new field to message
 	newFieldToAdd->attachToTextBasedProtocolMessage(this, newFieldOffset);
+	newFieldToAdd->m_InsertionIndex = m_NextInsertionIndex++;
 
 	// insert field into fields link list
 	if (prevField == NULL)
@@ -242,33 +283,12 @@ HeaderField* TextBasedProtocolMessage::insertField(HeaderField* prevField, const
 	if (newFieldToAdd->getNextField() == NULL)
 		m_LastField = newFieldToAdd;
 
-	// insert the new field into name to field map
-	std::string fieldName = newFieldToAdd->getFieldName();
-	std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::tolower);
-	m_FieldNameToFieldMap.insert(std::pair<std::string, HeaderField*>(fieldName, newFieldToAdd));
-
 	return newFieldToAdd;
 }
 
-bool TextBasedProtocolMessage::removeField(std::string fieldName, int index)
+bool TextBasedProtocolMessage::removeField(const std::string& fieldName, int index)
 {
-	std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::tolower);
-
-	HeaderField* fieldToRemove = NULL;
-
-	std::pair <std::multimap<std::string,HeaderField*>::iterator, std::multimap<std::string,HeaderField*>::iterator> range;
-	range = m_FieldNameToFieldMap.equal_range(fieldName);
-	int i = 0;
-    for (std::multimap<std::string,HeaderField*>::iterator iter = range.first; iter != range.second; ++iter)
-    {
-    	if (i == index)
-    	{
-    		fieldToRemove = iter->second;
-    		break;
-    	}
-
-    	i++;
-    }
+	HeaderField* fieldToRemove = getFieldByName(fieldName, index);
 
 	if (fieldToRemove != NULL)
 		return removeField(fieldToRemove);
@@ -290,8 +310,6 @@ bool TextBasedProtocolMessage::removeField(HeaderField* fieldToRemove)
 		return false;
 	}
 
-	std::string fieldName = fieldToRemove->getFieldName();
-
 	// shorten layer and delete this field
 	if (!shortenLayer(fieldToRemove->m_NameOffsetInMessage, fieldToRemove->getFieldSize()))
 	{
@@ -337,21 +355,8 @@ bool TextBasedProtocolMessage::removeField(HeaderField* fieldToRemove)
 		}
 	}
 
-	// remove the hash entry for this field
-	std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::tolower);
-	std::pair <std::multimap<std::string,HeaderField*>::iterator, std::multimap<std::string,HeaderField*>::iterator> range;
-	range = m_FieldNameToFieldMap.equal_range(fieldName);
-    for (std::multimap<std::string,HeaderField*>::iterator iter = range.first; iter != range.second; ++iter)
-    {
-    	if (iter->second == fieldToRemove)
-    	{
-    		m_FieldNameToFieldMap.erase(iter);
-    		break;
-    	}
-    }
-
 	// finally - delete this field
-	delete fieldToRemove;
+	deleteField(fieldToRemove);
 
 	return true;
 }
@@ -375,22 +380,32 @@ void TextBasedProtocolMessage::shiftFieldsOffset(HeaderField* fromField, int num
 	}
 }
 
-HeaderField* TextBasedProtocolMessage::getFieldByName(std::string fieldName, int index) const
+HeaderField* TextBasedProtocolMessage::getFieldByName(const std::string& fieldName, int index) const
 {
-	std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::tolower);
+	uint32_t nameHash = HeaderField::hashFieldName(fieldName.c_str(), fieldName.length());
 
-	std::pair <std::multimap<std::string,HeaderField*>::const_iterator, std::multimap<std::string,HeaderField*>::const_iterator> range;
-	range = m_FieldNameToFieldMap.equal_range(fieldName);
-	int i = 0;
-	for (std::multimap<std::string,HeaderField*>::const_iterator iter = range.first; iter != range.second; ++iter)
-    {
-    	if (i == index)
-    		return iter->second;
+	// fields with the same name are counted in the order they were added to the message, which is the packet order unless fields were
+	// inserted in the middle. Each pass finds the next one, comparing the names only for fields with the same hash, so a lookup doesn't
+	// copy or lower-case any string
+	HeaderField* result = NULL;
+	for (int i = 0; i <= index; i++)
+	{
+		HeaderField* prevResult = result;
+		result = NULL;
+		for (HeaderField* curField = m_FieldList; curField != NULL; curField = curField->getNextField())
+		{
+			if (curField->m_NameHash != nameHash || (prevResult != NULL && curField->m_InsertionIndex <= prevResult->m_InsertionIndex))
+				continue;
+
+			if ((result == NULL || curField->m_InsertionIndex < result->m_InsertionIndex) && curField->isFieldNameEqual(fieldName.c_str(), fieldName.length()))
+				result = curField;
+		}
 
-    	i++;
-    }
+		if (result == NULL)
+			return NULL;
+	}
 
-    return NULL;
+	return result;
 }
 
 int TextBasedProtocolMessage::getFieldCount()
@@ -414,7 +429,7 @@ void TextBasedProtocolMessage::parseNextLayer()
 	if (m_DataLen <= headerLen)
 		return;
 
-	m_NextLayer = new PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
+	m_NextLayer = new(m_Packet) PayloadLayer(m_Data + headerLen, m_DataLen - headerLen, this, m_Packet);
 }
 
 size_t TextBasedProtocolMessage::getHeaderLen()
@@ -439,8 +454,16 @@ HeaderField::HeaderField(TextBasedProtocolMessage* TextBasedProtocolMessage, int
 		m_NameValueSeperator(nameValueSeperator), m_SpacesAllowedBetweenNameAndValue(spacesAllowedBetweenNameAndValue)
 {
 	char* fieldData = (char*)(m_TextBasedProtocolMessage->m_Data + m_NameOffsetInMessage);
-	//char* fieldEndPtr = strchr(fieldData, '\n');
-	char* fieldEndPtr = (char *)memchr(fieldData, '\n',m_TextBasedProtocolMessage->m_DataLen-(size_t)m_NameOffsetInMessage);
+	size_t remainingLen = m_TextBasedProtocolMessage->m_DataLen-(size_t)m_NameOffsetInMessage;
+	// a single pass finds the separator if it comes before the end of the line, otherwise the end of the line
+	const char delimiters[2] = { nameValueSeperator, '\n' };
+	char* fieldValuePtr = (char*)findFirstOf(fieldData, remainingLen, delimiters, 2);
+	char* fieldEndPtr = fieldValuePtr;
+	if (fieldValuePtr != NULL && *fieldValuePtr != '\n')
+		fieldEndPtr = (char*)memchr(fieldValuePtr + 1, '\n', remainingLen - (fieldValuePtr + 1 - fieldData));
+	else
+		fieldValuePtr = NULL;
+
 	if (fieldEndPtr == NULL)
 		m_FieldSize = tbp_my_own_strnlen(fieldData, m_TextBasedProtocolMessage->m_DataLen-(size_t)m_NameOffsetInMessage);
 	else
@@ -453,13 +476,12 @@ HeaderField::HeaderField(TextBasedProtocolMessage* TextBasedProtocolMessage, int
 		m_FieldValueSize = -1;
 		m_FieldNameSize = -1;
 		m_IsEndOfHeaderField = true;
+		m_NameHash = hashFieldName(NULL, 0);
 		return;
 	}
 	else
 		m_IsEndOfHeaderField = false;
 
-//	char* fieldValuePtr = strchr(fieldData, ':');
-	char* fieldValuePtr = (char *)memchr(fieldData, nameValueSeperator, m_TextBasedProtocolMessage->m_DataLen-(size_t)m_NameOffsetInMessage);
 	// could not find the position of the separator, meaning field value position is unknown
 	if (fieldValuePtr == NULL)
 	{
@@ -502,6 +524,8 @@ HeaderField::HeaderField(TextBasedProtocolMessage* TextBasedProtocolMessage, int
 			}
 		}
 	}
+
+	m_NameHash = hashFieldName(fieldData, m_FieldNameSize);
 }
 
 HeaderField::HeaderField(std::string name, std::string value, char nameValueSeperator, bool spacesAllowedBetweenNameAndValue)
@@ -547,6 +571,7 @@ void HeaderField::initNewField(std::string name, std::string value)
 		m_ValueOffsetInMessage = 0;
 	m_FieldNameSize = name.length();
 	m_FieldValueSize = value.length();
+	m_NameHash = hashFieldName(name.c_str(), name.length());
 
 	if (name != PCPP_END_OF_TEXT_BASED_PROTOCOL_HEADER)
 		m_IsEndOfHeaderField = false;
@@ -593,6 +618,22 @@ std::string HeaderField::getFieldValue() const
 	return result;
 }
 
+const char* HeaderField::getFieldNameData() const
+{
+	if (m_FieldNameSize == (size_t)-1)
+		return NULL;
+
+	return ((HeaderField*)this)->getData() + m_NameOffsetInMessage;
+}
+
+const char* HeaderField::getFieldValueData() const
+{
+	if (m_ValueOffsetInMessage == -1)
+		return NULL;
+
+	return ((HeaderField*)this)->getData() + m_ValueOffsetInMessage;
+}
+
 bool HeaderField::setFieldValue(std::string newValue)
 {
 	// Field isn't linked with any message yet
@@ -638,6 +679,21 @@ bool HeaderField::setFieldValue(std::string newValue)
 	return true;
 }
 
+uint32_t HeaderField::hashFieldName(const char* name, size_t nameLen)
+{
+	return hashIgnoreCase(name, nameLen);
+}
+
+bool HeaderField::isFieldNameEqual(const char* name, size_t nameLen)
+{
+	// the name of an end-of-header field is an empty string
+	size_t fieldNameSize = (m_FieldNameSize != (size_t)-1 ? m_FieldNameSize : 0);
+	if (fieldNameSize != nameLen)
+		return false;
+
+	return equalsIgnoreCase(getData() + m_NameOffsetInMessage, name, nameLen);
+}
+
 void HeaderField::attachToTextBasedProtocolMessage(TextBasedProtocolMessage* message, int fieldOffsetInMessage)
 {
 	if (m_TextBasedProtocolMessage != NULL && m_TextBasedProtocolMessage != message)
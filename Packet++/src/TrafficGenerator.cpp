@@ -0,0 +1,644 @@
+#define LOG_MODULE PacketLogModuleTrafficGenerator
+
+#include "TrafficGenerator.h"
+#include "Packet.h"
+#include "EthLayer.h"
+#include "IPv4Layer.h"
+#include "TcpLayer.h"
+#include "UdpLayer.h"
+#include "HttpLayer.h"
+#include "DnsLayer.h"
+#include "IpUtils.h"
+#include "Logger.h"
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <winsock2.h>
+#elif LINUX
+#include <in.h>
+#elif MAC_OS_X
+#include <arpa/inet.h>
+#endif
+
+namespace pcpp
+{
+
+#define PCPP_TRAFFIC_GEN_ETH_IPV4_LEN (sizeof(ether_header) + sizeof(iphdr))
+#define PCPP_TRAFFIC_GEN_MAX_UDP_PAYLOAD 65507
+#define PCPP_TRAFFIC_GEN_MIN_MTU 576
+#define PCPP_TRAFFIC_GEN_NUM_OF_SERVERS 16
+#define PCPP_TRAFFIC_GEN_PARETO_SHAPE 1.2
+// payloads start at an offset into the pattern so consecutive packets don't carry the same bytes
+#define PCPP_TRAFFIC_GEN_PATTERN_OFFSETS 256
+#define PCPP_IP_MORE_FRAGMENTS_FLAG 0x2000
+
+TrafficGeneratorConfiguration::TrafficGeneratorConfiguration() :
+	numOfFlows(100), maxConcurrentFlows(100),
+	flowSizeDistribution(UniformSize), minPacketsPerFlow(10), maxPacketsPerFlow(100),
+	payloadSizeDistribution(UniformSize), minPayloadSize(64), maxPayloadSize(1400),
+	tcpWeight(1), httpWeight(1), udpWeight(1), dnsWeight(1),
+	reorderPercent(0), reorderWindow(8), lossPercent(0), mtu(1500), seed(1),
+	clientNetwork(std::string("10.0.0.0")), serverNetwork(std::string("10.128.0.0")), interPacketGapUsec(10)
+{
+	startTime.tv_sec = 0;
+	startTime.tv_usec = 0;
+}
+
+
+// computes a TCP/UDP checksum over the layer and its IPv4 pseudo-header, the same way TcpLayer and UdpLayer do
+static uint16_t computeTransportChecksum(uint32_t srcIP, uint32_t dstIP, uint8_t protocol, uint8_t* data, size_t dataLen)
+{
+	uint16_t pseudoHeader[6];
+	pseudoHeader[0] = srcIP >> 16;
+	pseudoHeader[1] = srcIP & 0xFFFF;
+	pseudoHeader[2] = dstIP >> 16;
+	pseudoHeader[3] = dstIP & 0xFFFF;
+	pseudoHeader[4] = 0xffff & htons((uint16_t)dataLen);
+	pseudoHeader[5] = htons(0x00ff & protocol);
+
+	ScalarBuffer<uint16_t> vec[2];
+	vec[0].buffer = (uint16_t*)data;
+	vec[0].len = dataLen;
+	vec[1].buffer = pseudoHeader;
+	vec[1].len = 12;
+	return htons(compute_checksum(vec, 2));
+}
+
+
+TrafficGenerator::TrafficGenerator(const TrafficGeneratorConfiguration& config) : m_Config(config)
+{
+	if (m_Config.mtu < PCPP_TRAFFIC_GEN_MIN_MTU)
+	{
+		LOG_ERROR("MTU %d is too small, using %d", (int)m_Config.mtu, PCPP_TRAFFIC_GEN_MIN_MTU);
+		m_Config.mtu = PCPP_TRAFFIC_GEN_MIN_MTU;
+	}
+
+	if (m_Config.maxPayloadSize > PCPP_TRAFFIC_GEN_MAX_UDP_PAYLOAD)
+		m_Config.maxPayloadSize = PCPP_TRAFFIC_GEN_MAX_UDP_PAYLOAD;
+	if (m_Config.minPayloadSize > m_Config.maxPayloadSize)
+		m_Config.minPayloadSize = m_Config.maxPayloadSize;
+	if (m_Config.minPacketsPerFlow == 0)
+		m_Config.minPacketsPerFlow = 1;
+	if (m_Config.maxPacketsPerFlow < m_Config.minPacketsPerFlow)
+		m_Config.maxPacketsPerFlow = m_Config.minPacketsPerFlow;
+	if (m_Config.maxConcurrentFlows == 0)
+		m_Config.maxConcurrentFlows = 1;
+
+	m_TotalWeight = 0;
+	int* weights[] = { &m_Config.tcpWeight, &m_Config.httpWeight, &m_Config.udpWeight, &m_Config.dnsWeight };
+	for (size_t i = 0; i < sizeof(weights) / sizeof(weights[0]); i++)
+	{
+		if (*weights[i] < 0)
+			*weights[i] = 0;
+		m_TotalWeight += *weights[i];
+	}
+	if (m_TotalWeight == 0)
+	{
+		LOG_ERROR("All protocol weights are 0, generating TCP flows only");
+		m_Config.tcpWeight = 1;
+		m_TotalWeight = 1;
+	}
+
+	m_MaxTcpPayload = m_Config.mtu - sizeof(iphdr) - sizeof(tcphdr);
+	// all fragments except the last one carry a multiple of 8 bytes
+	m_MaxFragmentPayload = (m_Config.mtu - sizeof(iphdr)) & ~((size_t)7);
+
+	buildTemplates();
+
+	m_PayloadPattern.resize(m_Config.maxPayloadSize + PCPP_TRAFFIC_GEN_PATTERN_OFFSETS);
+	for (size_t i = 0; i < m_PayloadPattern.size(); i++)
+		m_PayloadPattern[i] = (uint8_t)('a' + i % 26);
+	// the buffer is also used for building the HTTP response header and DNS messages, which are always smaller than the MTU
+	m_DatagramBuffer.resize(sizeof(udphdr) + (m_Config.maxPayloadSize > m_Config.mtu ? m_Config.maxPayloadSize : m_Config.mtu));
+
+	// a step may generate all fragments of the largest datagram, on top of the packets waiting to be reordered and the one last returned
+	size_t maxPacketsPerStep = 1;
+	if (sizeof(iphdr) + sizeof(udphdr) + m_Config.maxPayloadSize > m_Config.mtu)
+		maxPacketsPerStep = (sizeof(udphdr) + m_Config.maxPayloadSize + m_MaxFragmentPayload - 1) / m_MaxFragmentPayload;
+	size_t numOfSlots = m_Config.reorderWindow + maxPacketsPerStep + 2;
+
+	m_SlotSize = sizeof(ether_header) + m_Config.mtu;
+	m_SlotData.resize(numOfSlots * m_SlotSize);
+	m_SlotLength.resize(numOfSlots);
+	m_Queue.resize(numOfSlots);
+	m_FreeSlots.reserve(numOfSlots);
+	m_ActiveFlows.reserve(m_Config.maxConcurrentFlows);
+
+	reset();
+}
+
+void TrafficGenerator::buildTemplates()
+{
+	MacAddress clientMac("00:50:43:11:22:33");
+	MacAddress serverMac("00:1b:21:aa:bb:cc");
+	clientMac.copyTo(m_ClientMac);
+	serverMac.copyTo(m_ServerMac);
+
+	IPv4Address clientIP(m_Config.clientNetwork);
+	IPv4Address serverIP(m_Config.serverNetwork);
+
+	Packet tcpPacket(100);
+	EthLayer tcpEthLayer(clientMac, serverMac, PCPP_ETHERTYPE_IP);
+	IPv4Layer tcpIPLayer(clientIP, serverIP);
+	tcpIPLayer.getIPv4Header()->timeToLive = 64;
+	TcpLayer tcpLayer(1024, 80);
+	tcpLayer.getTcpHeader()->windowSize = htons(65535);
+	tcpPacket.addLayer(&tcpEthLayer);
+	tcpPacket.addLayer(&tcpIPLayer);
+	tcpPacket.addLayer(&tcpLayer);
+	tcpPacket.computeCalculateFields();
+	m_TcpTemplate.assign(tcpPacket.getRawPacket()->getRawData(), tcpPacket.getRawPacket()->getRawData() + tcpPacket.getRawPacket()->getRawDataLen());
+
+	Packet udpPacket(100);
+	EthLayer udpEthLayer(clientMac, serverMac, PCPP_ETHERTYPE_IP);
+	IPv4Layer udpIPLayer(clientIP, serverIP);
+	udpIPLayer.getIPv4Header()->timeToLive = 64;
+	UdpLayer udpLayer(1024, 53);
+	udpPacket.addLayer(&udpEthLayer);
+	udpPacket.addLayer(&udpIPLayer);
+	udpPacket.addLayer(&udpLayer);
+	udpPacket.computeCalculateFields();
+	m_UdpTemplate.assign(udpPacket.getRawPacket()->getRawData(), udpPacket.getRawPacket()->getRawData() + udpPacket.getRawPacket()->getRawDataLen());
+
+	HttpRequestLayer httpRequest(HttpRequestLayer::HttpGET, "/index.html", OneDotOne);
+	httpRequest.addField(PCPP_HTTP_HOST_FIELD, "www.example.com");
+	httpRequest.addField(PCPP_HTTP_USER_AGENT_FIELD, "PcapPlusPlus");
+	httpRequest.addField(PCPP_HTTP_ACCEPT_FIELD, "*/*");
+	httpRequest.addEndOfHeader();
+	m_HttpRequest.assign(httpRequest.getData(), httpRequest.getData() + httpRequest.getDataLen());
+
+	// the Content-Length field and the end of the header are added per flow
+	HttpResponseLayer httpResponse(OneDotOne, HttpResponseLayer::Http200OK);
+	httpResponse.addField(PCPP_HTTP_SERVER_FIELD, "PcapPlusPlus");
+	httpResponse.addField(PCPP_HTTP_CONTENT_TYPE_FIELD, "application/octet-stream");
+	m_HttpResponseHeader.assign(httpResponse.getData(), httpResponse.getData() + httpResponse.getDataLen());
+
+	DnsLayer dnsQuery;
+	dnsQuery.getDnsHeader()->recursionDesired = 1;
+	dnsQuery.addQuery("www.example.com", DNS_TYPE_A, DNS_CLASS_IN);
+	m_DnsQuery.assign(dnsQuery.getData(), dnsQuery.getData() + dnsQuery.getDataLen());
+
+	DnsLayer dnsResponse;
+	dnsResponse.getDnsHeader()->queryOrResponse = 1;
+	dnsResponse.getDnsHeader()->recursionDesired = 1;
+	dnsResponse.getDnsHeader()->recursionAvailable = 1;
+	dnsResponse.addQuery("www.example.com", DNS_TYPE_A, DNS_CLASS_IN);
+	IPv4DnsResourceData answerData(IPv4Address(std::string("93.184.216.34")));
+	dnsResponse.addAnswer("www.example.com", DNS_TYPE_A, DNS_CLASS_IN, 300, &answerData);
+	m_DnsResponse.assign(dnsResponse.getData(), dnsResponse.getData() + dnsResponse.getDataLen());
+}
+
+void TrafficGenerator::reset()
+{
+	// xorshift doesn't work with a zero state
+	m_RandomState = ((uint64_t)m_Config.seed << 32) ^ 0x9E3779B97F4A7C15ULL;
+	m_ImpairmentRandomState = ((uint64_t)m_Config.seed << 32) ^ 0xD1B54A32D192ED03ULL;
+
+	m_FreeSlots.clear();
+	for (size_t i = m_SlotLength.size(); i > 0; i--)
+		m_FreeSlots.push_back(i - 1);
+	m_QueueHead = 0;
+	m_QueueCount = 0;
+	m_LastReturnedSlot = -1;
+
+	m_NumOfFlowsStarted = 0;
+	m_NumOfPacketsGenerated = 0;
+	m_NumOfPacketsDropped = 0;
+
+	m_ActiveFlows.clear();
+	while (m_ActiveFlows.size() < m_Config.maxConcurrentFlows && m_NumOfFlowsStarted < m_Config.numOfFlows)
+	{
+		m_ActiveFlows.push_back(FlowState());
+		startFlow(m_ActiveFlows.back());
+	}
+}
+
+// xorshift64*
+static uint64_t nextXorshiftRandom(uint64_t& state)
+{
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 2685821657736338717ULL;
+}
+
+// a value in [0, 100)
+static double toPercent(uint64_t random)
+{
+	return (double)(random >> 11) * (100.0 / 9007199254740992.0);
+}
+
+uint64_t TrafficGenerator::nextRandom()
+{
+	return nextXorshiftRandom(m_RandomState);
+}
+
+double TrafficGenerator::nextRandomPercent()
+{
+	return toPercent(nextRandom());
+}
+
+uint64_t TrafficGenerator::nextImpairmentRandom()
+{
+	return nextXorshiftRandom(m_ImpairmentRandomState);
+}
+
+size_t TrafficGenerator::drawSize(TrafficGeneratorConfiguration::SizeDistribution distribution, size_t minValue, size_t maxValue)
+{
+	switch (distribution)
+	{
+	case TrafficGeneratorConfiguration::UniformSize:
+		return minValue + (size_t)(nextRandom() % (maxValue - minValue + 1));
+	case TrafficGeneratorConfiguration::ParetoSize:
+	{
+		// inverse transform sampling. u is in (0, 1]
+		double u = 1.0 - nextRandomPercent() / 100.0;
+		double value = (double)(minValue > 0 ? minValue : 1) / pow(u, 1.0 / PCPP_TRAFFIC_GEN_PARETO_SHAPE);
+		return (value >= (double)maxValue ? maxValue : (size_t)value);
+	}
+	default:
+		return minValue;
+	}
+}
+
+void TrafficGenerator::startFlow(FlowState& flow)
+{
+	size_t flowIndex = m_NumOfFlowsStarted++;
+
+	int weight = (int)(nextRandom() % (uint64_t)m_TotalWeight);
+	if ((weight -= m_Config.tcpWeight) < 0)
+		flow.type = TcpFlow;
+	else if ((weight -= m_Config.httpWeight) < 0)
+		flow.type = HttpFlow;
+	else if ((weight -= m_Config.udpWeight) < 0)
+		flow.type = UdpFlow;
+	else
+		flow.type = DnsFlow;
+
+	// clients get consecutive addresses, and a new source port once all addresses were used
+	flow.clientIP = htonl(ntohl(m_Config.clientNetwork.toInt()) + 1 + (uint32_t)(flowIndex % 65534));
+	flow.clientPort = (uint16_t)(1024 + (flowIndex / 65534) % 64000);
+	flow.serverIP = htonl(ntohl(m_Config.serverNetwork.toInt()) + 1 + (uint32_t)(flowIndex % PCPP_TRAFFIC_GEN_NUM_OF_SERVERS));
+	flow.ipId = (uint16_t)nextRandom();
+	flow.dnsTransactionId = (uint16_t)nextRandom();
+	flow.clientSeq = (uint32_t)nextRandom();
+	flow.serverSeq = (uint32_t)nextRandom();
+	flow.packetsLeft = drawSize(m_Config.flowSizeDistribution, m_Config.minPacketsPerFlow, m_Config.maxPacketsPerFlow);
+	flow.bytesLeft = 0;
+
+	switch (flow.type)
+	{
+	case TcpFlow:
+		flow.serverPort = 5001;
+		flow.stage = StageSyn;
+		break;
+	case HttpFlow:
+		flow.serverPort = 80;
+		flow.stage = StageSyn;
+		for (size_t i = 0; i < flow.packetsLeft; i++)
+			flow.bytesLeft += drawSize(m_Config.payloadSizeDistribution, m_Config.minPayloadSize, m_Config.maxPayloadSize);
+		break;
+	case UdpFlow:
+		flow.serverPort = 9000;
+		flow.stage = StageData;
+		break;
+	case DnsFlow:
+		flow.serverPort = 53;
+		flow.stage = StageRequest;
+		break;
+	}
+}
+
+bool TrafficGenerator::generateNextStep()
+{
+	if (m_ActiveFlows.empty())
+		return false;
+
+	size_t flowIndex = (size_t)(nextRandom() % m_ActiveFlows.size());
+	FlowState& flow = m_ActiveFlows[flowIndex];
+	generateFlowPacket(flow);
+
+	if (flow.stage == StageDone)
+	{
+		if (m_NumOfFlowsStarted < m_Config.numOfFlows)
+			startFlow(flow);
+		else
+		{
+			flow = m_ActiveFlows.back();
+			m_ActiveFlows.pop_back();
+		}
+	}
+
+	return true;
+}
+
+void TrafficGenerator::generateFlowPacket(FlowState& flow)
+{
+	switch (flow.stage)
+	{
+	case StageSyn:
+		sendTcpPacket(flow, true, true, false, NULL, 0);
+		flow.clientSeq++;
+		flow.stage = StageSynAck;
+		break;
+
+	case StageSynAck:
+		sendTcpPacket(flow, false, true, false, NULL, 0);
+		flow.serverSeq++;
+		flow.stage = StageAck;
+		break;
+
+	case StageAck:
+		sendTcpPacket(flow, true, false, false, NULL, 0);
+		flow.stage = (flow.type == HttpFlow ? StageRequest : StageData);
+		break;
+
+	case StageRequest:
+		if (flow.type == HttpFlow)
+		{
+			sendTcpPacket(flow, true, false, false, &m_HttpRequest[0], m_HttpRequest.size());
+			flow.clientSeq += (uint32_t)m_HttpRequest.size();
+		}
+		else // DNS
+		{
+			memcpy(&m_DatagramBuffer[0], &m_DnsQuery[0], m_DnsQuery.size());
+			((dnshdr*)&m_DatagramBuffer[0])->transactionID = flow.dnsTransactionId;
+			sendUdpDatagram(flow, true, &m_DatagramBuffer[0], m_DnsQuery.size());
+		}
+		flow.stage = StageResponse;
+		break;
+
+	case StageResponse:
+		if (flow.type == HttpFlow)
+		{
+			size_t headerLen = m_HttpResponseHeader.size();
+			memcpy(&m_DatagramBuffer[0], &m_HttpResponseHeader[0], headerLen);
+			headerLen += snprintf((char*)&m_DatagramBuffer[headerLen], m_DatagramBuffer.size() - headerLen, "%s: %lu\r\n\r\n",
+					PCPP_HTTP_CONTENT_LENGTH_FIELD, (unsigned long)flow.bytesLeft);
+			sendTcpPacket(flow, false, false, false, &m_DatagramBuffer[0], headerLen);
+			flow.serverSeq += (uint32_t)headerLen;
+			flow.stage = (flow.bytesLeft > 0 ? StageData : StageClientFin);
+		}
+		else // DNS
+		{
+			memcpy(&m_DatagramBuffer[0], &m_DnsResponse[0], m_DnsResponse.size());
+			((dnshdr*)&m_DatagramBuffer[0])->transactionID = flow.dnsTransactionId;
+			sendUdpDatagram(flow, false, &m_DatagramBuffer[0], m_DnsResponse.size());
+			flow.stage = StageDone;
+		}
+		break;
+
+	case StageData:
+	{
+		if (flow.type == HttpFlow)
+		{
+			size_t payloadLen = (flow.bytesLeft < m_MaxTcpPayload ? flow.bytesLeft : m_MaxTcpPayload);
+			sendTcpPacket(flow, false, false, false, &m_PayloadPattern[flow.serverSeq % PCPP_TRAFFIC_GEN_PATTERN_OFFSETS], payloadLen);
+			flow.serverSeq += (uint32_t)payloadLen;
+			flow.bytesLeft -= payloadLen;
+			if (flow.bytesLeft == 0)
+				flow.stage = StageClientFin;
+			break;
+		}
+
+		size_t payloadLen = drawSize(m_Config.payloadSizeDistribution, m_Config.minPayloadSize, m_Config.maxPayloadSize);
+		bool fromClient = ((nextRandom() & 1) == 0);
+
+		if (flow.type == TcpFlow)
+		{
+			if (payloadLen > m_MaxTcpPayload)
+				payloadLen = m_MaxTcpPayload;
+			uint32_t& seq = (fromClient ? flow.clientSeq : flow.serverSeq);
+			sendTcpPacket(flow, fromClient, false, false, &m_PayloadPattern[seq % PCPP_TRAFFIC_GEN_PATTERN_OFFSETS], payloadLen);
+			seq += (uint32_t)payloadLen;
+		}
+		else // UDP
+			sendUdpDatagram(flow, fromClient, &m_PayloadPattern[flow.ipId % PCPP_TRAFFIC_GEN_PATTERN_OFFSETS], payloadLen);
+
+		if (--flow.packetsLeft == 0)
+			flow.stage = (flow.type == TcpFlow ? StageClientFin : StageDone);
+		break;
+	}
+
+	case StageClientFin:
+		sendTcpPacket(flow, true, false, true, NULL, 0);
+		flow.clientSeq++;
+		flow.stage = StageServerFin;
+		break;
+
+	case StageServerFin:
+		sendTcpPacket(flow, false, false, true, NULL, 0);
+		flow.serverSeq++;
+		flow.stage = StageDone;
+		break;
+
+	case StageDone:
+		break;
+	}
+}
+
+uint8_t* TrafficGenerator::allocateSlot()
+{
+	size_t slot = m_FreeSlots.back();
+	m_FreeSlots.pop_back();
+	return &m_SlotData[slot * m_SlotSize];
+}
+
+void TrafficGenerator::enqueueSlot(uint8_t* slotData, size_t length)
+{
+	size_t slot = (size_t)(slotData - &m_SlotData[0]) / m_SlotSize;
+
+	if (m_Config.lossPercent > 0 && toPercent(nextImpairmentRandom()) < m_Config.lossPercent)
+	{
+		m_FreeSlots.push_back(slot);
+		m_NumOfPacketsDropped++;
+		return;
+	}
+
+	m_SlotLength[slot] = length;
+	m_Queue[(m_QueueHead + m_QueueCount) % m_Queue.size()] = slot;
+	m_QueueCount++;
+}
+
+bool TrafficGenerator::dequeuePacket(const uint8_t*& data, size_t& length, timeval& timestamp)
+{
+	if (m_LastReturnedSlot >= 0)
+	{
+		m_FreeSlots.push_back((size_t)m_LastReturnedSlot);
+		m_LastReturnedSlot = -1;
+	}
+
+	// keep enough packets queued so the head can be swapped with any of the next reorderWindow packets
+	while (m_QueueCount <= m_Config.reorderWindow && generateNextStep()) {}
+
+	if (m_QueueCount == 0)
+		return false;
+
+	if (m_QueueCount > 1 && m_Config.reorderPercent > 0 && toPercent(nextImpairmentRandom()) < m_Config.reorderPercent)
+	{
+		size_t maxDistance = (m_QueueCount - 1 < m_Config.reorderWindow ? m_QueueCount - 1 : m_Config.reorderWindow);
+		size_t other = (m_QueueHead + 1 + (size_t)(nextImpairmentRandom() % maxDistance)) % m_Queue.size();
+		size_t tmp = m_Queue[m_QueueHead];
+		m_Queue[m_QueueHead] = m_Queue[other];
+		m_Queue[other] = tmp;
+	}
+
+	size_t slot = m_Queue[m_QueueHead];
+	m_QueueHead = (m_QueueHead + 1) % m_Queue.size();
+	m_QueueCount--;
+	m_LastReturnedSlot = (int)slot;
+
+	data = &m_SlotData[slot * m_SlotSize];
+	length = m_SlotLength[slot];
+
+	uint64_t usec = (uint64_t)m_Config.startTime.tv_usec + m_NumOfPacketsGenerated * m_Config.interPacketGapUsec;
+	timestamp.tv_sec = m_Config.startTime.tv_sec + (time_t)(usec / 1000000);
+	timestamp.tv_usec = (suseconds_t)(usec % 1000000);
+
+	m_NumOfPacketsGenerated++;
+	return true;
+}
+
+bool TrafficGenerator::getNextPacket(RawPacket& rawPacket)
+{
+	const uint8_t* data;
+	size_t length;
+	timeval timestamp;
+	if (!dequeuePacket(data, length, timestamp))
+		return false;
+
+	timespec nsecTimestamp;
+	nsecTimestamp.tv_sec = timestamp.tv_sec;
+	nsecTimestamp.tv_nsec = timestamp.tv_usec * 1000;
+	return rawPacket.setExternalRawData(data, (int)length, nsecTimestamp);
+}
+
+bool TrafficGenerator::getNextPacket(RawPacket& rawPacket, RawPacketPool* pool)
+{
+	const uint8_t* data;
+	size_t length;
+	timeval timestamp;
+	if (!dequeuePacket(data, length, timestamp))
+		return false;
+
+	return rawPacket.copyRawData(data, (int)length, timestamp, pool);
+}
+
+size_t TrafficGenerator::generateAll(std::vector<RawPacket*>& packets, RawPacketPool* pool)
+{
+	size_t numOfPackets = 0;
+	while (true)
+	{
+		RawPacket* rawPacket = new RawPacket();
+		if (!getNextPacket(*rawPacket, pool))
+		{
+			delete rawPacket;
+			break;
+		}
+
+		packets.push_back(rawPacket);
+		numOfPackets++;
+	}
+
+	return numOfPackets;
+}
+
+uint8_t* TrafficGenerator::writeEthAndIPv4(uint8_t* frame, const FlowState& flow, bool fromClient, uint8_t protocol, size_t ipPayloadLen,
+		uint16_t ipId, uint16_t fragmentOffset)
+{
+	memcpy(frame, &m_UdpTemplate[0], PCPP_TRAFFIC_GEN_ETH_IPV4_LEN);
+
+	ether_header* ethHeader = (ether_header*)frame;
+	memcpy(ethHeader->dstMac, (fromClient ? m_ServerMac : m_ClientMac), 6);
+	memcpy(ethHeader->srcMac, (fromClient ? m_ClientMac : m_ServerMac), 6);
+
+	iphdr* ipHeader = (iphdr*)(frame + sizeof(ether_header));
+	ipHeader->protocol = protocol;
+	ipHeader->totalLength = htons((uint16_t)(sizeof(iphdr) + ipPayloadLen));
+	ipHeader->ipId = htons(ipId);
+	ipHeader->fragmentOffset = fragmentOffset;
+	ipHeader->ipSrc = (fromClient ? flow.clientIP : flow.serverIP);
+	ipHeader->ipDst = (fromClient ? flow.serverIP : flow.clientIP);
+	ipHeader->headerChecksum = 0;
+	ScalarBuffer<uint16_t> scalar = { (uint16_t*)ipHeader, sizeof(iphdr) };
+	ipHeader->headerChecksum = htons(compute_checksum(&scalar, 1));
+
+	return frame + PCPP_TRAFFIC_GEN_ETH_IPV4_LEN;
+}
+
+void TrafficGenerator::sendTcpPacket(FlowState& flow, bool fromClient, bool syn, bool fin, const uint8_t* payload, size_t payloadLen)
+{
+	uint8_t* frame = allocateSlot();
+	size_t tcpLen = sizeof(tcphdr) + payloadLen;
+	uint8_t* tcpData = writeEthAndIPv4(frame, flow, fromClient, PACKETPP_IPPROTO_TCP, tcpLen, flow.ipId++, 0);
+
+	memcpy(tcpData, &m_TcpTemplate[PCPP_TRAFFIC_GEN_ETH_IPV4_LEN], sizeof(tcphdr));
+	tcphdr* tcpHeader = (tcphdr*)tcpData;
+	tcpHeader->portSrc = htons(fromClient ? flow.clientPort : flow.serverPort);
+	tcpHeader->portDst = htons(fromClient ? flow.serverPort : flow.clientPort);
+	tcpHeader->sequenceNumber = htonl(fromClient ? flow.clientSeq : flow.serverSeq);
+	// everything but the first SYN acknowledges the other side
+	bool ack = !(syn && fromClient);
+	tcpHeader->ackNumber = (ack ? htonl(fromClient ? flow.serverSeq : flow.clientSeq) : 0);
+	tcpHeader->synFlag = (syn ? 1 : 0);
+	tcpHeader->finFlag = (fin ? 1 : 0);
+	tcpHeader->ackFlag = (ack ? 1 : 0);
+	tcpHeader->pshFlag = (payloadLen > 0 ? 1 : 0);
+	tcpHeader->headerChecksum = 0;
+
+	if (payloadLen > 0)
+		memcpy(tcpData + sizeof(tcphdr), payload, payloadLen);
+
+	iphdr* ipHeader = (iphdr*)(frame + sizeof(ether_header));
+	tcpHeader->headerChecksum = computeTransportChecksum(ipHeader->ipSrc, ipHeader->ipDst, PACKETPP_IPPROTO_TCP, tcpData, tcpLen);
+
+	enqueueSlot(frame, PCPP_TRAFFIC_GEN_ETH_IPV4_LEN + tcpLen);
+}
+
+void TrafficGenerator::sendUdpDatagram(FlowState& flow, bool fromClient, const uint8_t* payload, size_t payloadLen)
+{
+	size_t udpLen = sizeof(udphdr) + payloadLen;
+	uint32_t srcIP = (fromClient ? flow.clientIP : flow.serverIP);
+	uint32_t dstIP = (fromClient ? flow.serverIP : flow.clientIP);
+	uint16_t ipId = flow.ipId++;
+
+	udphdr udpHeader;
+	memcpy(&udpHeader, &m_UdpTemplate[PCPP_TRAFFIC_GEN_ETH_IPV4_LEN], sizeof(udphdr));
+	udpHeader.portSrc = htons(fromClient ? flow.clientPort : flow.serverPort);
+	udpHeader.portDst = htons(fromClient ? flow.serverPort : flow.clientPort);
+	udpHeader.length = htons((uint16_t)udpLen);
+	udpHeader.headerChecksum = 0;
+
+	if (sizeof(iphdr) + udpLen <= m_Config.mtu)
+	{
+		uint8_t* frame = allocateSlot();
+		uint8_t* udpData = writeEthAndIPv4(frame, flow, fromClient, PACKETPP_IPPROTO_UDP, udpLen, ipId, 0);
+		memcpy(udpData, &udpHeader, sizeof(udphdr));
+		memmove(udpData + sizeof(udphdr), payload, payloadLen);
+		((udphdr*)udpData)->headerChecksum = computeTransportChecksum(srcIP, dstIP, PACKETPP_IPPROTO_UDP, udpData, udpLen);
+		enqueueSlot(frame, PCPP_TRAFFIC_GEN_ETH_IPV4_LEN + udpLen);
+		return;
+	}
+
+	// the whole datagram is needed for the checksum, so it's built before it's split into fragments
+	uint8_t* datagram = &m_DatagramBuffer[0];
+	memmove(datagram + sizeof(udphdr), payload, payloadLen);
+	memcpy(datagram, &udpHeader, sizeof(udphdr));
+	((udphdr*)datagram)->headerChecksum = computeTransportChecksum(srcIP, dstIP, PACKETPP_IPPROTO_UDP, datagram, udpLen);
+
+	for (size_t offset = 0; offset < udpLen; offset += m_MaxFragmentPayload)
+	{
+		size_t fragmentLen = (udpLen - offset < m_MaxFragmentPayload ? udpLen - offset : m_MaxFragmentPayload);
+		uint16_t fragmentOffset = (uint16_t)(offset / 8);
+		if (offset + fragmentLen < udpLen)
+			fragmentOffset |= PCPP_IP_MORE_FRAGMENTS_FLAG;
+
+		uint8_t* frame = allocateSlot();
+		uint8_t* fragmentData = writeEthAndIPv4(frame, flow, fromClient, PACKETPP_IPPROTO_UDP, fragmentLen, ipId, htons(fragmentOffset));
+		memcpy(fragmentData, datagram + offset, fragmentLen);
+		enqueueSlot(frame, PCPP_TRAFFIC_GEN_ETH_IPV4_LEN + fragmentLen);
+	}
+}
+
+} // namespace pcpp
@@ -0,0 +1,398 @@
+#define LOG_MODULE PacketLogModuleTrafficShaper
+
+#include "TrafficShaper.h"
+#include "PacketView.h"
+#include "Logger.h"
+#include "TimestampClock.h"
+#include <string.h>
+
+#define NANOSECONDS_PER_SECOND 1000000000LL
+
+namespace pcpp
+{
+
+TrafficShaperClass::TrafficShaperClass()
+{
+	id = 0;
+	priority = 0;
+	weight = 1;
+	rateBytesPerSec = 0;
+	burstBytes = 0;
+	queueLimit = 1024;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// TokenBucket struct
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+void TrafficShaper::TokenBucket::setRate(uint64_t rate, uint32_t burstBytes)
+{
+	bool wasLimited = (rateBytesPerSec != 0);
+	rateBytesPerSec = rate;
+	if (rate == 0)
+		return;
+
+	if (burstBytes == 0)
+	{
+		uint64_t defaultBurst = rate / 100;
+		if (defaultBurst < PCPP_TRAFFIC_SHAPER_QUANTUM)
+			defaultBurst = PCPP_TRAFFIC_SHAPER_QUANTUM;
+		burstBytes = (defaultBurst > 0xffffffffULL ? 0xffffffff : (uint32_t)defaultBurst);
+	}
+
+	capacity = (int64_t)burstBytes * NANOSECONDS_PER_SECOND;
+
+	// a new bucket starts full
+	if (!wasLimited || tokens > capacity)
+		tokens = capacity;
+}
+
+void TrafficShaper::TokenBucket::refill(uint64_t now)
+{
+	if (!started)
+	{
+		started = true;
+		lastUpdate = now;
+		return;
+	}
+
+	if (now <= lastUpdate)
+		return;
+
+	uint64_t elapsed = now - lastUpdate;
+	lastUpdate = now;
+	if (rateBytesPerSec == 0 || tokens >= capacity)
+		return;
+
+	// the multiplication can't overflow when the elapsed time is limited to the time it takes to fill the bucket
+	uint64_t timeToFill = (uint64_t)(capacity - tokens) / rateBytesPerSec + 1;
+	if (elapsed >= timeToFill)
+		tokens = capacity;
+	else
+	{
+		tokens += (int64_t)(elapsed * rateBytesPerSec);
+		if (tokens > capacity)
+			tokens = capacity;
+	}
+}
+
+bool TrafficShaper::TokenBucket::hasTokens(uint32_t bytes) const
+{
+	if (rateBytesPerSec == 0)
+		return true;
+
+	// a packet larger than the bucket may be sent when the bucket is full
+	return tokens >= (int64_t)bytes * NANOSECONDS_PER_SECOND || tokens >= capacity;
+}
+
+void TrafficShaper::TokenBucket::consume(uint32_t bytes)
+{
+	if (rateBytesPerSec != 0)
+		tokens -= (int64_t)bytes * NANOSECONDS_PER_SECOND;
+}
+
+uint64_t TrafficShaper::TokenBucket::getDelay(uint32_t bytes) const
+{
+	if (hasTokens(bytes))
+		return 0;
+
+	int64_t needed = (int64_t)bytes * NANOSECONDS_PER_SECOND;
+	if (needed > capacity)
+		needed = capacity;
+
+	return ((uint64_t)(needed - tokens) + rateBytesPerSec - 1) / rateBytesPerSec;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// PriorityLevel struct
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+void TrafficShaper::PriorityLevel::nextTurn()
+{
+	current++;
+	if (current >= classes.size())
+		current = 0;
+	turnStarted = false;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// TrafficShaper class
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+TrafficShaper::TrafficShaper(const std::vector<TrafficShaperClass>& classes, uint32_t defaultClassId)
+{
+	m_Valid = false;
+	m_DefaultClass = NULL;
+	m_Classifier = NULL;
+	m_NumOfQueuedPackets = 0;
+	memset(&m_PortBucket, 0, sizeof(m_PortBucket));
+	for (int i = 0; i < PCPP_TRAFFIC_SHAPER_NUM_OF_PRIORITIES; i++)
+	{
+		m_Levels[i].current = 0;
+		m_Levels[i].turnStarted = false;
+	}
+
+	for (std::vector<TrafficShaperClass>::const_iterator iter = classes.begin(); iter != classes.end(); iter++)
+	{
+		if (iter->priority >= PCPP_TRAFFIC_SHAPER_NUM_OF_PRIORITIES || iter->weight == 0)
+		{
+			LOG_ERROR("Class %u has an invalid priority (%d) or weight (%u)", iter->id, (int)iter->priority, iter->weight);
+			return;
+		}
+
+		if (m_ClassById.find(iter->id) != m_ClassById.end())
+		{
+			LOG_ERROR("Class ID %u is used by more than one class", iter->id);
+			return;
+		}
+
+		ClassState* classState = new ClassState();
+		classState->config = *iter;
+		memset(&classState->bucket, 0, sizeof(classState->bucket));
+		classState->bucket.setRate(iter->rateBytesPerSec, iter->burstBytes);
+		classState->deficit = 0;
+		memset(&classState->stats, 0, sizeof(classState->stats));
+
+		m_Classes.push_back(classState);
+		m_ClassById[iter->id] = classState;
+		m_Levels[iter->priority].classes.push_back(classState);
+	}
+
+	std::map<uint32_t, ClassState*>::iterator defaultIter = m_ClassById.find(defaultClassId);
+	if (defaultIter == m_ClassById.end())
+	{
+		LOG_ERROR("Default class ID %u isn't one of the classes", defaultClassId);
+		return;
+	}
+
+	m_DefaultClass = defaultIter->second;
+	m_Valid = true;
+}
+
+TrafficShaper::~TrafficShaper()
+{
+	for (std::vector<ClassState*>::iterator iter = m_Classes.begin(); iter != m_Classes.end(); iter++)
+		delete (*iter);
+}
+
+void TrafficShaper::setPortRate(uint64_t rateBytesPerSec, uint32_t burstBytes)
+{
+	m_PortBucket.setRate(rateBytesPerSec, burstBytes);
+}
+
+bool TrafficShaper::setClassRate(uint32_t classId, uint64_t rateBytesPerSec, uint32_t burstBytes)
+{
+	std::map<uint32_t, ClassState*>::iterator iter = m_ClassById.find(classId);
+	if (iter == m_ClassById.end())
+		return false;
+
+	iter->second->config.rateBytesPerSec = rateBytesPerSec;
+	iter->second->config.burstBytes = burstBytes;
+	iter->second->bucket.setRate(rateBytesPerSec, burstBytes);
+	return true;
+}
+
+bool TrafficShaper::enqueue(RawPacket* packet)
+{
+	uint32_t classId = RuleClassifier::NoMatch;
+	if (m_Classifier != NULL)
+	{
+		PacketView view;
+		if (FlowKeyExtractor::extract(packet, view))
+			classId = m_Classifier->classify(view);
+	}
+
+	if (classId == RuleClassifier::NoMatch)
+		classId = (m_DefaultClass != NULL ? m_DefaultClass->config.id : 0);
+
+	return enqueue(packet, classId);
+}
+
+bool TrafficShaper::enqueue(RawPacket* packet, uint32_t classId)
+{
+	if (!m_Valid || packet == NULL)
+		return false;
+
+	std::map<uint32_t, ClassState*>::iterator iter = m_ClassById.find(classId);
+	ClassState* classState = (iter != m_ClassById.end() ? iter->second : m_DefaultClass);
+
+	if (classState->queue.size() >= classState->config.queueLimit)
+	{
+		classState->stats.droppedPackets++;
+		return false;
+	}
+
+	uint32_t packetLen = (uint32_t)packet->getRawDataLen();
+	classState->queue.push_back(packet);
+	classState->stats.enqueuedPackets++;
+	classState->stats.enqueuedBytes += packetLen;
+	classState->stats.queuedPackets++;
+	classState->stats.queuedBytes += packetLen;
+	m_NumOfQueuedPackets++;
+	return true;
+}
+
+TrafficShaper::ClassState* TrafficShaper::selectClass(PriorityLevel& level, uint64_t now)
+{
+	size_t numOfClasses = level.classes.size();
+
+	// deficit round-robin: a class gets its quantum when its turn starts and is served while its deficit covers its next packet. Classes
+	// which are empty or out of tokens are skipped, and the level is done when a whole round finds no class which may send
+	size_t skippedClasses = 0;
+	while (skippedClasses < numOfClasses)
+	{
+		ClassState* classState = level.classes[level.current];
+		if (classState->queue.empty())
+		{
+			classState->deficit = 0;
+			level.nextTurn();
+			skippedClasses++;
+			continue;
+		}
+
+		uint32_t packetLen = (uint32_t)classState->queue.front()->getRawDataLen();
+		classState->bucket.refill(now);
+		if (!classState->bucket.hasTokens(packetLen))
+		{
+			level.nextTurn();
+			skippedClasses++;
+			continue;
+		}
+
+		if (!level.turnStarted)
+		{
+			classState->deficit += (uint64_t)classState->config.weight * PCPP_TRAFFIC_SHAPER_QUANTUM;
+			level.turnStarted = true;
+		}
+
+		if (classState->deficit >= packetLen)
+			return classState;
+
+		level.nextTurn();
+		skippedClasses = 0;
+	}
+
+	return NULL;
+}
+
+size_t TrafficShaper::dequeue(const timespec& now, RawPacket** packets, size_t maxPackets)
+{
+	uint64_t nowNs = toNanoseconds(now);
+	m_PortBucket.refill(nowNs);
+
+	size_t numOfPackets = 0;
+	while (numOfPackets < maxPackets && m_NumOfQueuedPackets > 0)
+	{
+		ClassState* classState = NULL;
+		for (int i = 0; i < PCPP_TRAFFIC_SHAPER_NUM_OF_PRIORITIES && classState == NULL; i++)
+			classState = selectClass(m_Levels[i], nowNs);
+
+		if (classState == NULL)
+			break;
+
+		RawPacket* packet = classState->queue.front();
+		uint32_t packetLen = (uint32_t)packet->getRawDataLen();
+		if (!m_PortBucket.hasTokens(packetLen))
+			break;
+
+		classState->queue.pop_front();
+		classState->deficit -= packetLen;
+		classState->bucket.consume(packetLen);
+		m_PortBucket.consume(packetLen);
+
+		classState->stats.sentPackets++;
+		classState->stats.sentBytes += packetLen;
+		classState->stats.queuedPackets--;
+		classState->stats.queuedBytes -= packetLen;
+		m_NumOfQueuedPackets--;
+
+		packets[numOfPackets++] = packet;
+	}
+
+	return numOfPackets;
+}
+
+size_t TrafficShaper::dequeue(RawPacket** packets, size_t maxPackets)
+{
+	return dequeue(TimestampClock::now(), packets, maxPackets);
+}
+
+uint64_t TrafficShaper::getNextSendDelay(const timespec& now)
+{
+	if (m_NumOfQueuedPackets == 0)
+		return NoPacketsQueued;
+
+	uint64_t nowNs = toNanoseconds(now);
+	m_PortBucket.refill(nowNs);
+
+	uint64_t minDelay = NoPacketsQueued;
+	for (std::vector<ClassState*>::iterator iter = m_Classes.begin(); iter != m_Classes.end(); iter++)
+	{
+		ClassState* classState = *iter;
+		if (classState->queue.empty())
+			continue;
+
+		uint32_t packetLen = (uint32_t)classState->queue.front()->getRawDataLen();
+		classState->bucket.refill(nowNs);
+		uint64_t classDelay = classState->bucket.getDelay(packetLen);
+		uint64_t portDelay = m_PortBucket.getDelay(packetLen);
+		uint64_t delay = (classDelay > portDelay ? classDelay : portDelay);
+		if (delay < minDelay)
+			minDelay = delay;
+	}
+
+	return minDelay;
+}
+
+uint64_t TrafficShaper::getNextSendDelay()
+{
+	return getNextSendDelay(TimestampClock::now());
+}
+
+void TrafficShaper::flush(std::vector<RawPacket*>& packets)
+{
+	for (std::vector<ClassState*>::iterator iter = m_Classes.begin(); iter != m_Classes.end(); iter++)
+	{
+		ClassState* classState = *iter;
+		packets.insert(packets.end(), classState->queue.begin(), classState->queue.end());
+		classState->queue.clear();
+		classState->deficit = 0;
+		classState->stats.queuedPackets = 0;
+		classState->stats.queuedBytes = 0;
+	}
+
+	m_NumOfQueuedPackets = 0;
+}
+
+bool TrafficShaper::getClassStats(uint32_t classId, TrafficShaperClassStats& stats) const
+{
+	std::map<uint32_t, ClassState*>::const_iterator iter = m_ClassById.find(classId);
+	if (iter == m_ClassById.end())
+		return false;
+
+	stats = iter->second->stats;
+	return true;
+}
+
+void TrafficShaper::clearStats()
+{
+	for (std::vector<ClassState*>::iterator iter = m_Classes.begin(); iter != m_Classes.end(); iter++)
+	{
+		TrafficShaperClassStats& stats = (*iter)->stats;
+		uint32_t queuedPackets = stats.queuedPackets;
+		uint64_t queuedBytes = stats.queuedBytes;
+		memset(&stats, 0, sizeof(stats));
+		stats.queuedPackets = queuedPackets;
+		stats.queuedBytes = queuedBytes;
+	}
+}
+
+uint64_t TrafficShaper::toNanoseconds(const timespec& time)
+{
+	return (uint64_t)time.tv_sec * NANOSECONDS_PER_SECOND + (uint64_t)time.tv_nsec;
+}
+
+} // namespace pcpp
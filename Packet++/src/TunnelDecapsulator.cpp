@@ -0,0 +1,278 @@
+#include "TunnelDecapsulator.h"
+#include "ProtocolRegistry.h"
+#include "EthLayer.h"
+#include "IPv4Layer.h"
+#include "GreLayer.h"
+#include "GtpLayer.h"
+#include "VxlanLayer.h"
+#include "PPPoELayer.h"
+#include <string.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <winsock2.h>
+#elif LINUX
+#include <in.h>
+#elif MAC_OS_X
+#include <arpa/inet.h>
+#endif
+
+namespace pcpp
+{
+
+#define PCPP_MPLS_HEADER_LEN 4
+#define PCPP_GTP_V1_GPDU_MESSAGE_TYPE 0xff
+// the GRE protocol type of Ethernet frames (Transparent Ethernet Bridging)
+#define PCPP_GRE_ETHERNET_BRIDGING 0x6558
+
+uint32_t TunnelInfo::getTunnelId() const
+{
+	if (tunnelTypes & TunnelGTPU)
+		return gtpTeid;
+	if (tunnelTypes & TunnelVXLAN)
+		return vxlanVni;
+	if (hasGreKey)
+		return greKey;
+	return 0;
+}
+
+bool TunnelDecapsulator::decapsulate(const RawPacket* rawPacket, TunnelInfo& info)
+{
+	if (rawPacket == NULL)
+		return decapsulate(NULL, 0, LINKTYPE_ETHERNET, info);
+
+	return decapsulate(rawPacket->getRawData(), (size_t)rawPacket->getRawDataLen(), rawPacket->getLinkLayerType(), info);
+}
+
+bool TunnelDecapsulator::decapsulate(const uint8_t* data, size_t dataLen, LinkLayerType linkType, TunnelInfo& info)
+{
+	memset(&info, 0, sizeof(info));
+	info.innerLinkType = linkType;
+
+	if (!FlowKeyExtractor::extract(data, dataLen, linkType, info.innerView))
+		return false;
+
+	// the offset of the packet currently described by info.innerView
+	size_t base = 0;
+
+	for (int depth = 0; depth < MaxTunnelDepth; depth++)
+	{
+		const uint8_t* curData = data + base;
+		size_t curLen = dataLen - base;
+		const PacketView& view = info.innerView;
+
+		// the identifiers are recorded in a copy, which is kept only if the inner packet contains an IP header
+		TunnelInfo candidate = info;
+		LinkLayerType innerLinkType = LINKTYPE_RAW;
+		size_t innerStart = 0;
+
+		if (view.mplsLabelCount > 0 && view.networkOffset != PacketView::NoOffset)
+		{
+			// the label stack directly precedes the network header
+			innerStart = skipMplsLabels(curData, curLen, view.networkOffset - view.mplsLabelCount * PCPP_MPLS_HEADER_LEN, candidate);
+		}
+		else if (view.isPacketOfType(UDP) && view.payloadOffset != PacketView::NoOffset)
+		{
+			innerStart = decapsulateUdp(curData, curLen, view, candidate, innerLinkType);
+		}
+		else if (!view.isFragment && view.ipPayloadOffset != PacketView::NoOffset)
+		{
+			if (view.ipProtocol == PACKETPP_IPPROTO_GRE)
+			{
+				innerStart = decapsulateGre(curData, curLen, view.ipPayloadOffset, candidate, innerLinkType);
+			}
+			else if (view.ipProtocol == PACKETPP_IPPROTO_IPIP || view.ipProtocol == PACKETPP_IPPROTO_IPV6)
+			{
+				candidate.tunnelTypes |= TunnelIPinIP;
+				innerStart = view.ipPayloadOffset;
+			}
+		}
+
+		if (innerStart == 0 || innerStart >= curLen || base + innerStart >= PacketView::NoOffset)
+			break;
+
+		if (!FlowKeyExtractor::extract(curData + innerStart, curLen - innerStart, innerLinkType, candidate.innerView))
+			break;
+
+		base += innerStart;
+		candidate.numOfTunnels++;
+		candidate.innerOffset = (uint16_t)base;
+		candidate.innerLinkType = innerLinkType;
+		info = candidate;
+	}
+
+	return true;
+}
+
+size_t TunnelDecapsulator::decapsulateUdp(const uint8_t* data, size_t dataLen, const PacketView& view, TunnelInfo& info, LinkLayerType& innerLinkType)
+{
+	const ProtocolRegistry& registry = ProtocolRegistry::getInstance();
+	size_t offset = view.payloadOffset;
+	const uint8_t* payload = data + offset;
+	size_t payloadLen = dataLen - offset;
+
+	// same as UdpLayer: VXLAN is recognized by the destination port only
+	if (registry.isPortOfProtocol(view.dstPort, VXLAN))
+	{
+		if (payloadLen <= sizeof(vxlan_header))
+			return 0;
+
+		info.tunnelTypes |= TunnelVXLAN;
+		info.vxlanVni = ((uint32_t)payload[4] << 16) | ((uint32_t)payload[5] << 8) | payload[6];
+		innerLinkType = LINKTYPE_ETHERNET;
+		return offset + sizeof(vxlan_header);
+	}
+
+	if (!registry.isPortOfProtocol(view.dstPort, GTPv1) && !registry.isPortOfProtocol(view.srcPort, GTPv1))
+		return 0;
+
+	// only GTPv1 G-PDU messages carry user packets
+	if (payloadLen < sizeof(gtpv1_header) || (payload[0] & 0xE0) != 0x20 || payload[1] != PCPP_GTP_V1_GPDU_MESSAGE_TYPE)
+		return 0;
+
+	size_t headerLen = sizeof(gtpv1_header);
+
+	// the sequence number, N-PDU number and next extension type fields exist if any of the E, S and PN flags is set
+	if ((payload[0] & 0x07) != 0)
+	{
+		headerLen += 4;
+		if (headerLen > payloadLen)
+			return 0;
+
+		uint8_t nextExtType = ((payload[0] & 0x04) != 0 ? payload[headerLen - 1] : 0);
+		while (nextExtType != 0)
+		{
+			// the extension length is in units of 4 bytes and the last byte is the next extension type
+			if (headerLen >= payloadLen)
+				return 0;
+
+			size_t extLen = payload[headerLen] * 4;
+			if (extLen == 0 || headerLen + extLen > payloadLen)
+				return 0;
+
+			nextExtType = payload[headerLen + extLen - 1];
+			headerLen += extLen;
+		}
+	}
+
+	uint32_t teid;
+	memcpy(&teid, payload + 4, sizeof(teid));
+	info.tunnelTypes |= TunnelGTPU;
+	info.gtpTeid = ntohl(teid);
+	innerLinkType = LINKTYPE_RAW;
+	return offset + headerLen;
+}
+
+size_t TunnelDecapsulator::decapsulateGre(const uint8_t* data, size_t dataLen, size_t offset, TunnelInfo& info, LinkLayerType& innerLinkType)
+{
+	if (offset + sizeof(gre_basic_header) > dataLen)
+		return 0;
+
+	const gre_basic_header* header = (const gre_basic_header*)(data + offset);
+	if (header->version > 1)
+		return 0;
+
+	// same as GreLayer::getHeaderLen(). In GREv1 the key field is the payload length followed by the call ID
+	size_t headerLen = sizeof(gre_basic_header);
+	if (header->checksumBit == 1 || header->routingBit == 1)
+		headerLen += 4;
+	size_t keyOffset = headerLen;
+	if (header->keyBit == 1)
+		headerLen += 4;
+	if (header->sequenceNumBit == 1)
+		headerLen += 4;
+	if (header->ackSequenceNumBit == 1)
+		headerLen += 4;
+
+	if (offset + headerLen >= dataLen)
+		return 0;
+
+	if (header->keyBit == 1)
+	{
+		uint32_t key;
+		memcpy(&key, data + offset + keyOffset, sizeof(key));
+		info.hasGreKey = true;
+		info.greKey = (header->version == 1 ? ntohl(key) & 0xffff : ntohl(key));
+	}
+
+	info.tunnelTypes |= TunnelGRE;
+	size_t innerStart = offset + headerLen;
+	uint16_t protocol = ntohs(header->protocol);
+
+	if (protocol == PCPP_GRE_ETHERNET_BRIDGING)
+	{
+		innerLinkType = LINKTYPE_ETHERNET;
+		return innerStart;
+	}
+
+	if (protocol == PCPP_ETHERTYPE_PPP)
+	{
+		// PPTP: a PPP header whose protocol is IPv4 or IPv6
+		if (innerStart + sizeof(ppp_pptp_header) >= dataLen)
+			return 0;
+
+		uint16_t pppProtocol = ntohs(((const ppp_pptp_header*)(data + innerStart))->protocol);
+		if (pppProtocol != PCPP_PPP_IP && pppProtocol != PCPP_PPP_IPV6)
+			return 0;
+
+		innerLinkType = LINKTYPE_RAW;
+		return innerStart + sizeof(ppp_pptp_header);
+	}
+
+	switch (ProtocolRegistry::getInstance().getProtocolByEtherType(protocol))
+	{
+	case IPv4:
+	case IPv6:
+		innerLinkType = LINKTYPE_RAW;
+		return innerStart;
+	case MPLS:
+		innerLinkType = LINKTYPE_RAW;
+		return skipMplsLabels(data, dataLen, innerStart, info);
+	default:
+		return 0;
+	}
+}
+
+size_t TunnelDecapsulator::skipMplsLabels(const uint8_t* data, size_t dataLen, size_t offset, TunnelInfo& info)
+{
+	info.mplsLabelCount = 0;
+
+	while (offset + PCPP_MPLS_HEADER_LEN <= dataLen)
+	{
+		const uint8_t* label = data + offset;
+		if (info.mplsLabelCount < TunnelInfo::MaxMplsLabels)
+			info.mplsLabels[info.mplsLabelCount] = ((uint32_t)label[0] << 12) | ((uint32_t)label[1] << 4) | (label[2] >> 4);
+		if (info.mplsLabelCount < 0xff)
+			info.mplsLabelCount++;
+
+		offset += PCPP_MPLS_HEADER_LEN;
+
+		// the bottom of stack bit
+		if ((label[2] & 0x01) != 0)
+		{
+			info.tunnelTypes |= TunnelMPLS;
+			return offset;
+		}
+	}
+
+	return 0;
+}
+
+bool TunnelDecapsulator::setInnerRawData(const RawPacket& outerPacket, const TunnelInfo& info, RawPacket& innerPacket)
+{
+	if (!outerPacket.isPacketSet() || (int)info.innerOffset >= outerPacket.getRawDataLen())
+		return false;
+
+	return innerPacket.setRawData(outerPacket.getRawData() + info.innerOffset, outerPacket.getRawDataLen() - info.innerOffset,
+			outerPacket.getPacketTimeStamp(), info.innerLinkType);
+}
+
+uint32_t TunnelDecapsulator::hashInnerFlow(const TunnelInfo& info, bool symmetric, bool includeTunnelId)
+{
+	FlowTuple tuple;
+	if (!FlowHash::getTuple(info.innerView, tuple))
+		return 0;
+
+	uint32_t seed = (includeTunnelId ? info.getTunnelId() : 0);
+	return (symmetric ? FlowHash::hashSymmetric(tuple, seed) : FlowHash::hash(tuple, seed));
+}
+
+} // namespace pcpp
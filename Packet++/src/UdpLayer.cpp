@@ -11,9 +11,10 @@
 #include "SipLayer.h"
 #include "RadiusLayer.h"
 #include "GtpLayer.h"
+#include "ProtocolRegistry.h"
+#include "PayloadClassifier.h"
 #include "Logger.h"
 #include <string.h>
-#include <sstream>
 
 namespace pcpp
 {
@@ -29,6 +30,55 @@ UdpLayer::UdpLayer(uint16_t portSrc, uint16_t portDst)
 	m_Protocol = UDP;
 }
 
+uint16_t UdpLayer::getSrcPort() const
+{
+	return ntohs(getUdpHeader()->portSrc);
+}
+
+void UdpLayer::setSrcPort(uint16_t port, bool updateChecksum)
+{
+	udphdr* udpHdr = getUdpHeader();
+	uint16_t newPort = htons(port);
+	if (updateChecksum)
+		updateChecksumForField(udpHdr->portSrc, newPort);
+	else
+		setModified();
+
+	udpHdr->portSrc = newPort;
+}
+
+uint16_t UdpLayer::getDstPort() const
+{
+	return ntohs(getUdpHeader()->portDst);
+}
+
+void UdpLayer::setDstPort(uint16_t port, bool updateChecksum)
+{
+	udphdr* udpHdr = getUdpHeader();
+	uint16_t newPort = htons(port);
+	if (updateChecksum)
+		updateChecksumForField(udpHdr->portDst, newPort);
+	else
+		setModified();
+
+	udpHdr->portDst = newPort;
+}
+
+void UdpLayer::updateChecksumForField(uint16_t oldValue, uint16_t newValue)
+{
+	udphdr* udpHdr = getUdpHeader();
+
+	// a zero checksum means the checksum isn't used
+	if (udpHdr->headerChecksum == 0)
+		return;
+
+	udpHdr->headerChecksum = update_checksum(udpHdr->headerChecksum, oldValue, newValue);
+
+	// a computed checksum of zero is transmitted as all ones
+	if (udpHdr->headerChecksum == 0)
+		udpHdr->headerChecksum = 0xffff;
+}
+
 uint16_t UdpLayer::calculateChecksum(bool writeResultToPacket)
 {
 	udphdr* udpHdr = (udphdr*)m_Data;
@@ -93,22 +143,27 @@ void UdpLayer::parseNextLayer()
 	uint8_t *udpData = m_Data + sizeof(udphdr);
 	size_t udpDataLen = m_DataLen - sizeof(udphdr);
 
+	const ProtocolRegistry& registry = ProtocolRegistry::getInstance();
+
 	if ((portSrc == 68 && portDst == 67) || (portSrc == 67 && portDst == 68) || (portSrc == 67 && portDst == 67))
-		m_NextLayer = new DhcpLayer(udpData, udpDataLen, this, m_Packet);
-	else if (portDst == 4789)
-		m_NextLayer = new VxlanLayer(udpData, udpDataLen, this, m_Packet);
-	else if ((udpDataLen >= sizeof(dnshdr)) && (DnsLayer::getDNSPortMap()->find(portDst) != DnsLayer::getDNSPortMap()->end() || DnsLayer::getDNSPortMap()->find(portSrc) != DnsLayer::getDNSPortMap()->end()))
-		m_NextLayer = new DnsLayer(udpData, udpDataLen, this, m_Packet);
-	else if ((portDst == 5060 || portDst == 5061 || portSrc == 5060 || portSrc == 5061) && (SipRequestFirstLine::parseMethod((char*)udpData, udpDataLen) != SipRequestLayer::SipMethodUnknown))
-		m_NextLayer = new SipRequestLayer(udpData, udpDataLen, this, m_Packet);
-	else if ((portDst == 5060 || portDst == 5061 || portSrc == 5060 || portSrc == 5061) && (SipResponseFirstLine::parseStatusCode((char*)udpData, udpDataLen) != SipResponseLayer::SipStatusCodeUnknown))
-		m_NextLayer = new SipResponseLayer(udpData, udpDataLen, this, m_Packet);
-	else if ((portDst == 1812 || portSrc == 1812 || portDst == 1813 || portSrc == 1813 || portDst == 3799 || portSrc == 3799) && RadiusLayer::isDataValid(udpData, udpDataLen))
-		m_NextLayer = new RadiusLayer(udpData, udpDataLen, this, m_Packet);
-	else if ((portDst == 2152 || portSrc == 2152 || portDst == 2123 || portSrc == 2123) && GtpV1Layer::isGTPv1(udpData, udpDataLen))
-		m_NextLayer = new GtpV1Layer(udpData, udpDataLen, this, m_Packet);
-	else
-		m_NextLayer = new PayloadLayer(udpData, udpDataLen, this, m_Packet);
+		m_NextLayer = new(m_Packet) DhcpLayer(udpData, udpDataLen, this, m_Packet);
+	else if (registry.isPortOfProtocol(portDst, VXLAN))
+		m_NextLayer = new(m_Packet) VxlanLayer(udpData, udpDataLen, this, m_Packet);
+	else if ((udpDataLen >= sizeof(dnshdr)) && (registry.isPortOfProtocol(portDst, DNS) || registry.isPortOfProtocol(portSrc, DNS)))
+		m_NextLayer = new(m_Packet) DnsLayer(udpData, udpDataLen, this, m_Packet);
+	else if ((registry.isPortOfProtocol(portDst, SIP) || registry.isPortOfProtocol(portSrc, SIP)) && (SipRequestFirstLine::parseMethod((char*)udpData, udpDataLen) != SipRequestLayer::SipMethodUnknown))
+		m_NextLayer = new(m_Packet) SipRequestLayer(udpData, udpDataLen, this, m_Packet);
+	else if ((registry.isPortOfProtocol(portDst, SIP) || registry.isPortOfProtocol(portSrc, SIP)) && (SipResponseFirstLine::parseStatusCode((char*)udpData, udpDataLen) != SipResponseLayer::SipStatusCodeUnknown))
+		m_NextLayer = new(m_Packet) SipResponseLayer(udpData, udpDataLen, this, m_Packet);
+	else if ((registry.isPortOfProtocol(portDst, Radius) || registry.isPortOfProtocol(portSrc, Radius)) && RadiusLayer::isDataValid(udpData, udpDataLen))
+		m_NextLayer = new(m_Packet) RadiusLayer(udpData, udpDataLen, this, m_Packet);
+	else if ((registry.isPortOfProtocol(portDst, GTPv1) || registry.isPortOfProtocol(portSrc, GTPv1)) && GtpV1Layer::isGTPv1(udpData, udpDataLen))
+		m_NextLayer = new(m_Packet) GtpV1Layer(udpData, udpDataLen, this, m_Packet);
+	else if (registry.getPayloadClassifier() != NULL)
+		m_NextLayer = registry.getPayloadClassifier()->createLayer(udpData, udpDataLen, this, m_Packet);
+
+	if (m_NextLayer == NULL)
+		m_NextLayer = new(m_Packet) PayloadLayer(udpData, udpDataLen, this, m_Packet);
 }
 
 void UdpLayer::computeCalculateFields()
@@ -120,12 +175,16 @@ void UdpLayer::computeCalculateFields()
 
 std::string UdpLayer::toString()
 {
-	std::ostringstream srcPortStream;
-	srcPortStream << ntohs(getUdpHeader()->portSrc);
-	std::ostringstream dstPortStream;
-	dstPortStream << ntohs(getUdpHeader()->portDst);
+	return PacketDumpWriter::layerToString(*this);
+}
 
-	return "UDP Layer, Src port: " + srcPortStream.str() + ", Dst port: " + dstPortStream.str();
+void UdpLayer::dump(PacketDumpWriter& writer)
+{
+	writer.beginLayer("UDP Layer", UDP);
+	writer.addNumber("Src port", "srcPort", ntohs(getUdpHeader()->portSrc));
+	writer.addNumber("Dst port", "dstPort", ntohs(getUdpHeader()->portDst));
+	writer.addNumber(NULL, "length", ntohs(getUdpHeader()->length));
+	writer.endLayer();
 }
 
 } // namespace pcpp
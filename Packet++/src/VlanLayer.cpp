@@ -7,8 +7,8 @@
 #include "ArpLayer.h"
 #include "PPPoELayer.h"
 #include "MplsLayer.h"
+#include "ProtocolRegistry.h"
 #include <string.h>
-#include <sstream>
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 #include <winsock2.h>
 #elif LINUX
@@ -63,44 +63,46 @@ void VlanLayer::parseNextLayer()
 		return;
 
 	vlan_header* hdr = getVlanHeader();
-	switch (ntohs(hdr->etherType))
+	switch (ProtocolRegistry::getInstance().getProtocolByEtherType(ntohs(hdr->etherType)))
 	{
-	case PCPP_ETHERTYPE_IP:
-		m_NextLayer = new IPv4Layer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
+	case IPv4:
+		m_NextLayer = new(m_Packet) IPv4Layer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_IPV6:
-		m_NextLayer = new IPv6Layer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
+	case IPv6:
+		m_NextLayer = new(m_Packet) IPv6Layer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_ARP:
-		m_NextLayer = new ArpLayer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
+	case ARP:
+		m_NextLayer = new(m_Packet) ArpLayer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_VLAN:
-		m_NextLayer = new VlanLayer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
+	case VLAN:
+		m_NextLayer = new(m_Packet) VlanLayer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_PPPOES:
-		m_NextLayer = new PPPoESessionLayer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
+	case PPPoESession:
+		m_NextLayer = new(m_Packet) PPPoESessionLayer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_PPPOED:
-		m_NextLayer = new PPPoEDiscoveryLayer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
+	case PPPoEDiscovery:
+		m_NextLayer = new(m_Packet) PPPoEDiscoveryLayer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
 		break;
-	case PCPP_ETHERTYPE_MPLS:
-		m_NextLayer = new MplsLayer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
+	case MPLS:
+		m_NextLayer = new(m_Packet) MplsLayer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
 		break;
 	default:
-		m_NextLayer = new PayloadLayer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
+		m_NextLayer = new(m_Packet) PayloadLayer(m_Data + sizeof(vlan_header), m_DataLen - sizeof(vlan_header), this, m_Packet);
 	}
 }
 
 std::string VlanLayer::toString()
 {
-	std::ostringstream cfiStream;
-	cfiStream << (int)getCFI();
-	std::ostringstream priStream;
-	priStream << (int)getPriority();
-	std::ostringstream idStream;
-	idStream << getVlanID();
+	return PacketDumpWriter::layerToString(*this);
+}
 
-	return "VLAN Layer, Priority: " + priStream.str() + ", Vlan ID: " + idStream.str() + ", CFI: " + cfiStream.str();
+void VlanLayer::dump(PacketDumpWriter& writer)
+{
+	writer.beginLayer("VLAN Layer", VLAN);
+	writer.addNumber("Priority", "priority", getPriority());
+	writer.addNumber("Vlan ID", "vlanId", getVlanID());
+	writer.addNumber("CFI", "cfi", getCFI());
+	writer.endLayer();
 }
 
 } // namespace pcpp
@@ -0,0 +1,217 @@
+#ifndef PCAPPP_ARROW_FILE_WRITER
+#define PCAPPP_ARROW_FILE_WRITER
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/// @file
+
+/**
+ * The default number of rows ArrowFileWriter buffers before writing them as a record batch
+ */
+#define PCPP_ARROW_DEFAULT_ROWS_PER_BATCH (64 * 1024)
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class ArrowFileWriter
+	 * Writes a table to a file in the Apache Arrow IPC file format (also known as Feather version 2), which Arrow based tools such as
+	 * pyarrow, pandas, polars, DuckDB and Spark read directly, column by column, without parsing. The writer doesn't depend on the Arrow
+	 * library: it encodes the Arrow metadata itself and supports the column types below, which is all tables of packet and flow metadata
+	 * need.<BR>
+	 * Rows are buffered column by column and written as a record batch every rowsPerBatch rows. String columns are dictionary encoded: every
+	 * distinct value is stored once in a dictionary and rows hold 32-bit indices to it, which keeps columns of highly repetitive values
+	 * (IP addresses, host names) small. The dictionaries grow for the whole file and are written when the file is closed, before its
+	 * footer, as the file format allows (which also means the file can only be read as a file and not as an Arrow stream):
+	 *
+	 *     ArrowFileWriter writer("packets.arrow");
+	 *     int lengthColumn = writer.addColumn("length", ArrowFileWriter::UInt32Column);
+	 *     int hostColumn = writer.addColumn("host", ArrowFileWriter::StringColumn, true);
+	 *     writer.open();
+	 *     writer.setValue(lengthColumn, 60);
+	 *     writer.setString(hostColumn, "example.com", 11);
+	 *     writer.endRow();
+	 *     ...
+	 *     writer.close();
+	 *
+	 * Values are stored in little endian order whatever the host is. This class isn't thread safe
+	 */
+	class ArrowFileWriter
+	{
+	public:
+
+		/**
+		 * The column types
+		 */
+		enum ColumnType
+		{
+			/** An unsigned 8-bit integer */
+			UInt8Column,
+			/** An unsigned 16-bit integer */
+			UInt16Column,
+			/** An unsigned 32-bit integer */
+			UInt32Column,
+			/** An unsigned 64-bit integer */
+			UInt64Column,
+			/** A UTC timestamp in nanoseconds since the epoch */
+			TimestampNsColumn,
+			/** A UTC timestamp in milliseconds since the epoch */
+			TimestampMsColumn,
+			/** A dictionary encoded UTF-8 string */
+			StringColumn
+		};
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] fileName The full path of the file to write. An existing file is overwritten when the writer is opened
+		 * @param[in] rowsPerBatch The number of rows in a record batch. The default is #PCPP_ARROW_DEFAULT_ROWS_PER_BATCH
+		 */
+		ArrowFileWriter(const std::string& fileName, size_t rowsPerBatch = PCPP_ARROW_DEFAULT_ROWS_PER_BATCH);
+
+		/**
+		 * A d'tor for this class. Closes the file if it's still open
+		 */
+		~ArrowFileWriter();
+
+		/**
+		 * Add a column to the table. Columns can be added only before the writer is opened
+		 * @param[in] name The column name
+		 * @param[in] type The column type
+		 * @param[in] nullable If true, rows in which the column isn't set are null. If false they're 0 (or an empty string). The default
+		 * is false
+		 * @return The index of the column, or -1 if the writer is already open (an error will be printed to log)
+		 */
+		int addColumn(const std::string& name, ColumnType type, bool nullable = false);
+
+		/**
+		 * @return The number of columns
+		 */
+		inline size_t getNumOfColumns() const { return m_Columns.size(); }
+
+		/**
+		 * Create the file and write the table schema
+		 * @return True if the file was created, false if it couldn't be created, the writer is already open or no columns were added (an
+		 * error will be printed to log)
+		 */
+		bool open();
+
+		/**
+		 * @return True if the writer is open
+		 */
+		inline bool isOpened() const { return m_File != NULL; }
+
+		/**
+		 * Set the value of a numeric or timestamp column in the current row
+		 * @param[in] column The column index returned by addColumn()
+		 * @param[in] value The value. It's truncated to the width of the column
+		 */
+		void setValue(int column, uint64_t value);
+
+		/**
+		 * Set the value of a string column in the current row
+		 * @param[in] column The column index returned by addColumn()
+		 * @param[in] value The string, which doesn't have to be null-terminated
+		 * @param[in] length The length of the string in bytes
+		 */
+		void setString(int column, const char* value, size_t length);
+
+		/**
+		 * End the current row. Columns which weren't set in the row are null or 0, depending on whether they're nullable. When the number of
+		 * buffered rows reaches the batch size they're written to the file
+		 * @return False if the writer isn't open or a record batch couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool endRow();
+
+		/**
+		 * Write the buffered rows as a record batch
+		 * @return False if the writer isn't open or the batch couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool flush();
+
+		/**
+		 * Write the buffered rows, the dictionaries and the file footer, and close the file. Nothing can be written after the writer is
+		 * closed
+		 * @return False if the writer isn't open or the file couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool close();
+
+		/**
+		 * @return The number of rows written or buffered so far
+		 */
+		inline uint64_t getNumOfRows() const { return m_NumOfRows; }
+
+		/**
+		 * @return The number of record batches written so far
+		 */
+		inline size_t getNumOfBatches() const { return m_RecordBatchBlocks.size(); }
+
+		/**
+		 * @param[in] column The column index returned by addColumn()
+		 * @return The number of distinct values of a string column, or 0 for other columns
+		 */
+		size_t getDictionarySize(int column) const;
+
+	private:
+
+		struct Column
+		{
+			std::string name;
+			ColumnType type;
+			bool nullable;
+			// the width in bytes of a value in the record batch, for string columns the width of a dictionary index
+			uint8_t width;
+			std::vector<uint8_t> values;
+			std::vector<uint8_t> validity;
+			size_t nullCount;
+			// the value of the current row and whether it was set
+			uint64_t rowValue;
+			bool rowValueSet;
+			// the dictionary of a string column: the values one after the other, the offset of each value and a hash table of the value
+			// indices (-1 for an empty slot)
+			std::vector<char> dictionaryData;
+			std::vector<int32_t> dictionaryOffsets;
+			std::vector<int32_t> dictionaryHashTable;
+		};
+
+		struct Block
+		{
+			uint64_t offset;
+			uint32_t metadataLength;
+			uint64_t bodyLength;
+		};
+
+		std::string m_FileName;
+		size_t m_RowsPerBatch;
+		FILE* m_File;
+		uint64_t m_FileOffset;
+		bool m_Closed;
+		std::vector<Column> m_Columns;
+		size_t m_NumOfBufferedRows;
+		uint64_t m_NumOfRows;
+		std::vector<Block> m_DictionaryBlocks;
+		std::vector<Block> m_RecordBatchBlocks;
+		std::vector<uint8_t> m_Metadata;
+		std::vector<uint8_t> m_Body;
+
+		int32_t findOrAddDictionaryValue(Column& column, const char* value, size_t length);
+		void growDictionaryHashTable(Column& column);
+		void buildSchema();
+		void buildFooter();
+		bool writeMessage(Block* block);
+		bool writeData(const void* data, size_t length);
+
+		// disable copy c'tor and assignment operator
+		ArrowFileWriter(const ArrowFileWriter& other);
+		ArrowFileWriter& operator=(const ArrowFileWriter& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_ARROW_FILE_WRITER */
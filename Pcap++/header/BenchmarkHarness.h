@@ -0,0 +1,280 @@
+#ifndef PCAPPP_BENCHMARK_HARNESS
+#define PCAPPP_BENCHMARK_HARNESS
+
+#include "Device.h"
+#include "PcapFilter.h"
+#include "TimestampClock.h"
+#include "HardwareCounters.h"
+#include <string>
+#include <vector>
+#ifdef PCPP_ENABLE_ITT
+#include <ittnotify.h>
+#endif
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct BenchmarkConfiguration
+	 * The benchmark mode settings of an application, usually parsed from its command line by BenchmarkHarness#extractOptions()
+	 */
+	struct BenchmarkConfiguration
+	{
+		/** Whether benchmark mode was requested */
+		bool enabled;
+		/** The number of measured iterations over the input */
+		int iterations;
+		/** The number of iterations to run before the measured ones, to warm up the caches and the branch predictors */
+		int warmupIterations;
+		/** A file to write the results to in JSON format, or an empty string for none */
+		std::string jsonOutputFile;
+		/** Whether to count CPU hardware events (cycles, instructions, cache misses and branch misses) during the measured iterations,
+		 * see HardwareCounters */
+		bool hardwareCounters;
+
+		/**
+		 * A c'tor for this struct which sets the default values: benchmark mode disabled, 10 iterations, 1 warm-up iteration, no JSON
+		 * output and no hardware counters
+		 */
+		BenchmarkConfiguration() : enabled(false), iterations(10), warmupIterations(1), hardwareCounters(false) {}
+	};
+
+
+	/**
+	 * @class BenchmarkHarness
+	 * A harness for measuring the packet processing cost of an application, shared by the example applications' --benchmark mode so they
+	 * all report the same numbers. The input file is read into memory before measuring, so disk I/O isn't measured, and then processed
+	 * a number of times. The application marks its processing stages (such as parsing and analysis) with beginStage() and endStage(),
+	 * and the report shows the time per packet of every iteration and every stage:
+	 *
+	 *     BenchmarkHarness harness("HttpAnalyzer", benchmarkConfig);
+	 *     harness.loadFile(fileName);
+	 *     int parseStage = harness.addStage("parse");
+	 *     while (harness.startIteration())
+	 *     {
+	 *         for (size_t i = 0; i < harness.getNumOfPackets(); i++)
+	 *         {
+	 *             harness.beginStage(parseStage);
+	 *             Packet packet(harness.getPacket(i));
+	 *             harness.endStage(parseStage);
+	 *             ...
+	 *         }
+	 *         harness.endIteration();
+	 *     }
+	 *     harness.printReport();
+	 *
+	 * Stages are timed with TimestampClock#readCycleCounter(), so marking a stage costs two RDTSC instructions on x86. Stages shouldn't
+	 * overlap, and the iteration time outside all stages is reported as "other".
+	 * With BenchmarkConfiguration#hardwareCounters set, CPU hardware events of the measured iterations are counted too (see
+	 * HardwareCounters) and reported per packet, which tells whether the time goes to cache misses, mispredicted branches or just
+	 * instructions. The iterations must then run on the thread that created the harness.
+	 * When PcapPlusPlus is configured with an Intel ITT installation (--itt-home, which defines PCPP_ENABLE_ITT), the measured iterations
+	 * are also wrapped in __itt_resume()/__itt_pause() and every stage is reported as an ITT task, so VTune's collection can be started
+	 * paused and the profile shows the stages on the timeline. perf and other sampling profilers need nothing more than symbols (-g)
+	 */
+	class BenchmarkHarness
+	{
+	public:
+
+		/**
+		 * Remove the benchmark options from an application's command line and parse them, so the application's own getopt_long() parsing
+		 * doesn't need to know about them. The recognized options are: --benchmark[=ITERATIONS], --benchmark-warmup=ITERATIONS,
+		 * --benchmark-json=FILE and --benchmark-hw-counters
+		 * @param[in,out] argc The number of arguments, decreased by the number of options removed
+		 * @param[in,out] argv The arguments. The options are removed and the rest are moved up keeping their order
+		 * @param[out] config The configuration to set. Its enabled flag is set if --benchmark appears
+		 * @return False if an option has an invalid value (an error is printed to log), true otherwise
+		 */
+		static bool extractOptions(int& argc, char* argv[], BenchmarkConfiguration& config);
+
+		/**
+		 * @return The usage text of the options extractOptions() recognizes, for the applications' help message
+		 */
+		static const char* getUsage();
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] appName The application name, shown in the report
+		 * @param[in] config The benchmark settings
+		 */
+		BenchmarkHarness(const std::string& appName, const BenchmarkConfiguration& config);
+
+		/**
+		 * A d'tor for this class. Frees the loaded packets
+		 */
+		~BenchmarkHarness();
+
+		/**
+		 * Read all packets of a capture file (of any format IFileReaderDevice#getReader() supports) into memory. Previously loaded
+		 * packets are freed
+		 * @param[in] fileName The file to read
+		 * @param[in] filter An optional filter to apply while reading. Only the matching packets are loaded. Default value is NULL
+		 * @return False if the file couldn't be opened or the filter couldn't be set (an error is printed to log), true otherwise
+		 */
+		bool loadFile(const std::string& fileName, GeneralFilter* filter = NULL);
+
+		/**
+		 * @return The number of packets loaded
+		 */
+		inline size_t getNumOfPackets() const { return m_Packets.size(); }
+
+		/**
+		 * @return The total length of the packets loaded in bytes
+		 */
+		inline uint64_t getNumOfBytes() const { return m_NumOfBytes; }
+
+		/**
+		 * Get a loaded packet
+		 * @param[in] index The packet index, which must be lower than getNumOfPackets()
+		 * @return The packet. It's owned by the harness
+		 */
+		inline RawPacket* getPacket(size_t index) { return m_Packets.at((int)index); }
+
+		/**
+		 * @return All loaded packets
+		 */
+		inline RawPacketVector& getPackets() { return m_Packets; }
+
+		/**
+		 * Add a processing stage
+		 * @param[in] name The stage name
+		 * @return The stage ID to pass to beginStage() and endStage()
+		 */
+		int addStage(const std::string& name);
+
+		/**
+		 * Mark the beginning of a stage
+		 * @param[in] stageId The stage ID returned by addStage()
+		 */
+		inline void beginStage(int stageId)
+		{
+#ifdef PCPP_ENABLE_ITT
+			__itt_task_begin(m_IttDomain, __itt_null, __itt_null, m_Stages[stageId].ittName);
+#endif
+			m_Stages[stageId].startCycles = TimestampClock::readCycleCounter();
+		}
+
+		/**
+		 * Mark the end of a stage. Its time is added to the stage if the current iteration is measured
+		 * @param[in] stageId The stage ID returned by addStage()
+		 */
+		inline void endStage(int stageId)
+		{
+			StageData& stage = m_Stages[stageId];
+			if (m_Measuring)
+				stage.totalCycles += TimestampClock::readCycleCounter() - stage.startCycles;
+#ifdef PCPP_ENABLE_ITT
+			__itt_task_end(m_IttDomain);
+#endif
+		}
+
+		/**
+		 * Start the next iteration over the packets
+		 * @return True if an iteration was started, false if all warm-up and measured iterations were done
+		 */
+		bool startIteration();
+
+		/**
+		 * End the current iteration
+		 */
+		void endIteration();
+
+		/**
+		 * @return True if the current iteration is measured, false if it's a warm-up iteration or no iteration is running
+		 */
+		inline bool isMeasuring() const { return m_Measuring; }
+
+		/**
+		 * @return The number of measured iterations done
+		 */
+		inline int getNumOfMeasuredIterations() const { return (int)m_IterationNs.size(); }
+
+		/**
+		 * @return The median time of the measured iterations in nanoseconds per packet, or 0 if none were done
+		 */
+		double getNsPerPacket() const;
+
+		/**
+		 * Get the time spent in a stage
+		 * @param[in] stageId The stage ID returned by addStage()
+		 * @return The mean time of the stage over the measured iterations in nanoseconds per packet, or 0 if none were done
+		 */
+		double getStageNsPerPacket(int stageId) const;
+
+		/**
+		 * @return The hardware counters summed over the measured iterations. No counter is available if hardware counters weren't
+		 * requested or couldn't be opened
+		 */
+		inline const HardwareCounterValues& getHardwareCounters() const { return m_HwCounterValues; }
+
+		/**
+		 * Print the results to stdout: the input size, the median time per packet and the throughput of the measured iterations, the
+		 * hardware counters per packet if they were counted, and a table of the stages. If a JSON output file was configured the results
+		 * are written to it too
+		 */
+		void printReport() const;
+
+		/**
+		 * Write the results to a file in JSON format
+		 * @param[in] fileName The file to write to
+		 * @return False if the file couldn't be opened (an error is printed to log), true otherwise
+		 */
+		bool writeJson(const std::string& fileName) const;
+
+		/**
+		 * @class StageScope
+		 * Marks a stage from its construction until it goes out of scope
+		 */
+		class StageScope
+		{
+		public:
+			StageScope(BenchmarkHarness& harness, int stageId) : m_Harness(harness), m_StageId(stageId) { m_Harness.beginStage(m_StageId); }
+			~StageScope() { m_Harness.endStage(m_StageId); }
+		private:
+			BenchmarkHarness& m_Harness;
+			int m_StageId;
+		};
+
+	private:
+		struct StageData
+		{
+			std::string name;
+			uint64_t startCycles;
+			uint64_t totalCycles;
+#ifdef PCPP_ENABLE_ITT
+			__itt_string_handle* ittName;
+#endif
+		};
+
+		std::string m_AppName;
+		BenchmarkConfiguration m_Config;
+		std::string m_FileName;
+		RawPacketVector m_Packets;
+		uint64_t m_NumOfBytes;
+		std::vector<StageData> m_Stages;
+		int m_IterationsStarted;
+		bool m_Measuring;
+		uint64_t m_IterationStartCycles;
+		std::vector<double> m_IterationNs;
+		HardwareCounters m_HwCounters;
+		HardwareCounterValues m_HwCounterValues;
+#ifdef PCPP_ENABLE_ITT
+		__itt_domain* m_IttDomain;
+#endif
+
+		inline uint64_t getNumOfMeasuredPackets() const { return (uint64_t)m_Packets.size() * m_IterationNs.size(); }
+
+		// disable copy c'tor and assignment operator
+		BenchmarkHarness(const BenchmarkHarness& other);
+		BenchmarkHarness& operator=(const BenchmarkHarness& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_BENCHMARK_HARNESS */
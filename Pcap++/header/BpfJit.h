@@ -0,0 +1,95 @@
+#ifndef PCAPPP_BPF_JIT
+#define PCAPPP_BPF_JIT
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * A just-in-time compiler which translates classic BPF programs into native code. It's used by BpfFilterProgram (see PcapFilter.h) to
+ * speed up software filtering of packets
+ */
+
+//Forward Declaration - used in BpfJitProgram
+struct bpf_program;
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @class BpfJitProgram
+	 * A classic BPF program (as produced by pcap_compile()) translated into native machine code, which matches packets without going through
+	 * the BPF interpreter of libpcap. The generated code behaves exactly like pcap_offline_filter(): loads outside the captured bytes and
+	 * division by a zero X register make the program return 0.<BR>
+	 * The translation is supported on x86-64 (System V and Windows calling conventions). On other architectures, or if the program contains
+	 * an instruction the interpreter wouldn't accept or executable memory can't be allocated, compile() fails and the caller should keep
+	 * using the interpreter. BpfFilterProgram does this automatically, so most users don't need this class directly.<BR>
+	 * The generated code doesn't change the object, so run() may be called by several threads in parallel
+	 */
+	class BpfJitProgram
+	{
+	public:
+		/**
+		 * A c'tor for this class which creates an empty program
+		 */
+		BpfJitProgram();
+
+		/**
+		 * A d'tor for this class, frees the generated code
+		 */
+		~BpfJitProgram();
+
+		/**
+		 * @return True if BPF programs can be translated into native code on this platform
+		 */
+		static bool isSupported();
+
+		/**
+		 * Translate a BPF program into native code, replacing the current code
+		 * @param[in] program The BPF program. It isn't referenced after this method returns
+		 * @return True if the program was translated, false if the platform isn't supported, the program is invalid or contains an
+		 * instruction which isn't supported, or executable memory couldn't be allocated
+		 */
+		bool compile(const struct bpf_program* program);
+
+		/**
+		 * Free the generated code
+		 */
+		void clear();
+
+		/**
+		 * @return True if the object holds generated code
+		 */
+		inline bool isCompiled() const { return m_Function != NULL; }
+
+		/**
+		 * Run the program on packet data. Must be called only if isCompiled() is true
+		 * @param[in] packetData A pointer to the packet data, starting at the link layer
+		 * @param[in] capturedLength The number of bytes captured
+		 * @param[in] packetLength The length of the packet on the wire
+		 * @return The return value of the BPF program, which is 0 if the packet doesn't match
+		 */
+		inline uint32_t run(const uint8_t* packetData, uint32_t capturedLength, uint32_t packetLength) const
+		{
+			return m_Function(packetData, capturedLength, packetLength);
+		}
+
+	private:
+		typedef uint32_t (*JitFunction)(const uint8_t* packetData, uint32_t capturedLength, uint32_t packetLength);
+
+		JitFunction m_Function;
+		void* m_Code;
+		size_t m_CodeSize;
+
+		// disable copy c'tor and assignment operator
+		BpfJitProgram(const BpfJitProgram& other);
+		BpfJitProgram& operator=(const BpfJitProgram& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_BPF_JIT */
@@ -0,0 +1,252 @@
+#ifndef PCAPPP_BSD_BPF_DEVICE
+#define PCAPPP_BSD_BPF_DEVICE
+
+#include "Device.h"
+#include "RawPacket.h"
+#include <pthread.h>
+#include <string>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The default size in bytes of the buffer of a BsdBpfDevice. The kernel clamps it to its maximum (the debug.bpf_maxbufsize sysctl on macOS,
+ * net.bpf.maxbufsize on FreeBSD)
+ */
+#define PCPP_BSD_BPF_DEFAULT_BUFFER_SIZE (1 << 24)
+
+/**
+ * The default time in milliseconds a read from a BsdBpfDevice waits for its buffer to fill before returning the packets captured so far
+ */
+#define PCPP_BSD_BPF_DEFAULT_READ_TIMEOUT_MS 100
+
+	class BsdBpfDevice;
+
+	/**
+	 * @typedef OnBsdBpfPacketsArriveCallback
+	 * A callback that is called with the packets of a buffer read by BsdBpfDevice
+	 * @param[in] packets An array of the captured raw packets. The packet data isn't copied, it points into the read buffer, so the packets
+	 * are valid only until the callback returns
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] device A pointer to the BsdBpfDevice instance
+	 * @param[in] userCookie A pointer to the object put by the user when packet capturing started
+	 */
+	typedef void (*OnBsdBpfPacketsArriveCallback)(RawPacket* packets, uint32_t numOfPackets, BsdBpfDevice* device, void* userCookie);
+
+	/**
+	 * @class BsdBpfDevice
+	 * A capture device for macOS and FreeBSD network interfaces which reads packets directly from a /dev/bpf device instead of going
+	 * through libpcap. The kernel copies packets into a large buffer (BIOCSBLEN), and each read() returns all packets the buffer holds. The
+	 * device hands them to the user in one callback call, with RawPackets that point into the buffer, so there's no copy and no system
+	 * call per packet. With a buffer of several megabytes each read returns thousands of packets at high rates, which is what makes
+	 * multi-Gbps capture possible on these platforms.
+	 * In immediate mode (BIOCIMMEDIATE) a read returns as soon as a packet arrives, which lowers latency but returns smaller batches at low
+	 * rates; otherwise a read returns when the buffer is full or when the read timeout expires. The kernel double-buffers, so packets keep
+	 * arriving into its second buffer while the callback processes the first one.
+	 * BPF filters are compiled with the BPFStringFilter syntax and set on the device (BIOCSETF), so filtered packets are dropped by the
+	 * kernel before they're copied to the buffer.
+	 * This device is supported on macOS and FreeBSD only, opening it on other platforms fails. Opening it requires read access to
+	 * /dev/bpf* (root, or membership in the access_bpf group on macOS)
+	 */
+	class BsdBpfDevice : public IDevice, public IFilterableDevice
+	{
+	public:
+
+		/**
+		 * @struct DeviceConfiguration
+		 * A structure for configuring BsdBpfDevice
+		 */
+		struct DeviceConfiguration
+		{
+			/** The requested size in bytes of the buffer. The kernel may use a smaller buffer, see getBufferSize() */
+			uint32_t bufferSize;
+
+			/** Whether reads return as soon as a packet arrives (BIOCIMMEDIATE), instead of when the buffer is full or the read times out */
+			bool immediateMode;
+
+			/** The time in milliseconds a read waits for the buffer to fill before returning the packets captured so far. It bounds the
+			 * capture latency when immediate mode is off and traffic is low, and how often the capture thread checks whether it was asked to
+			 * stop. It must be greater than 0
+			 */
+			uint32_t readTimeoutMs;
+
+			/** Whether the interface is put in promiscuous mode while the device is open */
+			bool promiscuous;
+
+			/** Whether packets sent by the host are captured as well as packets it receives (BIOCSSEESENT) */
+			bool seeSent;
+
+			/**
+			 * A c'tor for this struct
+			 * @param[in] bufferSize The requested size in bytes of the buffer. Default is #PCPP_BSD_BPF_DEFAULT_BUFFER_SIZE
+			 * @param[in] immediateMode Whether reads return as soon as a packet arrives. Default is false, which gives the largest batches
+			 * @param[in] readTimeoutMs The read timeout in milliseconds. Default is #PCPP_BSD_BPF_DEFAULT_READ_TIMEOUT_MS
+			 */
+			DeviceConfiguration(uint32_t bufferSize = PCPP_BSD_BPF_DEFAULT_BUFFER_SIZE, bool immediateMode = false,
+					uint32_t readTimeoutMs = PCPP_BSD_BPF_DEFAULT_READ_TIMEOUT_MS) :
+				bufferSize(bufferSize), immediateMode(immediateMode), readTimeoutMs(readTimeoutMs), promiscuous(true), seeSent(true)
+			{
+			}
+		};
+
+		/**
+		 * @struct BsdBpfStats
+		 * A container for BsdBpfDevice statistics
+		 */
+		struct BsdBpfStats
+		{
+			/** Number of packets received by the device, including the dropped ones */
+			uint64_t recv;
+			/** Number of packets dropped because the kernel buffers were full */
+			uint64_t drop;
+			/** Number of reads which returned packets */
+			uint64_t reads;
+			/** Number of packets delivered to the user */
+			uint64_t packetsDelivered;
+		};
+
+		/**
+		 * A c'tor for this class. The BPF device isn't opened until open() is called
+		 * @param[in] interfaceName The name of the network interface, for example "en0"
+		 * @param[in] config The device configuration
+		 */
+		BsdBpfDevice(const std::string& interfaceName, const DeviceConfiguration& config = DeviceConfiguration());
+
+		/**
+		 * A d'tor for this class. Stops the capture and closes the device if they're active
+		 */
+		~BsdBpfDevice();
+
+		/**
+		 * @return The name of the network interface
+		 */
+		inline const std::string& getName() const { return m_InterfaceName; }
+
+		/**
+		 * @return The device configuration
+		 */
+		inline const DeviceConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * @return The size in bytes of the buffer the kernel actually uses, or 0 if the device isn't open
+		 */
+		inline uint32_t getBufferSize() const { return m_BufferSize; }
+
+		/**
+		 * @return The link layer type of the interface, or LINKTYPE_ETHERNET if the device isn't open
+		 */
+		inline LinkLayerType getLinkType() const { return m_LinkType; }
+
+		/**
+		 * Start capturing on a new thread. Every buffer read from the device is delivered in one onPacketsArrive call
+		 * @param[in] onPacketsArrive A callback that is called with the packets of each buffer
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object. This object will be transferred to the onPacketsArrive
+		 * callback each time it is called
+		 * @return True if capture started successfully, false if the device isn't open, capture is already running, the callback is NULL
+		 * or the capture thread could not be created (relevant log error is printed in any case)
+		 */
+		bool startCapture(OnBsdBpfPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie);
+
+		/**
+		 * Stop the capture thread. It stops after the buffer it's delivering, or within the read timeout of the configuration when there's
+		 * no traffic
+		 */
+		void stopCapture();
+
+		/**
+		 * @return True if the capture thread is running
+		 */
+		inline bool captureActive() const { return m_CaptureThreadStarted; }
+
+		/**
+		 * Read a single buffer on the calling thread, for applications which run their own capture loops. It shouldn't be called while the
+		 * capture thread of startCapture() is running. The read waits up to the read timeout of the configuration
+		 * @param[in] onPacketsArrive A callback that is called with the packets of the buffer, on the calling thread
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object which is transferred to the callback
+		 * @return The number of packets delivered, 0 if no packet arrived before the timeout or -1 on error (an error is printed to log)
+		 */
+		int receiveBatch(OnBsdBpfPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie);
+
+		/**
+		 * Get the statistics of the device since it was opened
+		 * @param[out] stats The object the statistics are written to
+		 */
+		void getStatistics(BsdBpfStats& stats);
+
+		/**
+		 * Report the getStatistics() counters to a MetricsRegistry snapshot
+		 * @param[in] writer The writer to report the values to
+		 */
+		void collectMetrics(MetricsWriter& writer);
+
+		// implement abstract methods
+
+		/**
+		 * Open a free /dev/bpf device, set its buffer size, attach it to the interface and set the other options of the configuration
+		 * @return True if the device was opened, false otherwise (an error is printed to log)
+		 */
+		bool open();
+
+		/**
+		 * Stop the capture if it's running and close the BPF device
+		 */
+		void close();
+
+		using IFilterableDevice::setFilter;
+
+		/**
+		 * Compile a BPF filter for the link type of the interface and set it on the device, so the kernel drops packets which don't match
+		 * it. The device must be open
+		 * @param[in] filterAsString The filter in Berkeley Packet Filter (BPF) syntax
+		 * @return True if the filter was set, false if the device isn't open, the filter is invalid or setting it failed
+		 */
+		bool setFilter(std::string filterAsString);
+
+		/**
+		 * Replace the filter with one which accepts all packets
+		 * @return True if the filter was cleared or no filter was set, false otherwise
+		 */
+		bool clearFilter();
+
+		/**
+		 * @return True if a filter is currently set
+		 */
+		inline bool isFilterCurrentlySet() const { return m_IsFilterSet; }
+
+	private:
+
+		std::string m_InterfaceName;
+		DeviceConfiguration m_Config;
+		int m_Fd;
+		uint8_t* m_Buffer;
+		uint32_t m_BufferSize;
+		LinkLayerType m_LinkType;
+		// the packets of a buffer, which point into it. Grows to the largest number of packets read at once
+		RawPacket* m_Packets;
+		uint32_t m_PacketsCapacity;
+		BsdBpfStats m_Stats;
+		pthread_t m_CaptureThread;
+		bool m_CaptureThreadStarted;
+		volatile bool m_StopThread;
+		OnBsdBpfPacketsArriveCallback m_OnPacketsArrive;
+		void* m_OnPacketsArriveUserCookie;
+		bool m_IsFilterSet;
+
+		bool setOptions();
+		int readBuffer(OnBsdBpfPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie);
+		static void* captureThreadMain(void* devicePtr);
+
+		// disable copy c'tor and assignment operator
+		BsdBpfDevice(const BsdBpfDevice& other);
+		BsdBpfDevice& operator=(const BsdBpfDevice& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_BSD_BPF_DEVICE */
@@ -0,0 +1,98 @@
+#ifndef PCAPPP_CLUSTER_RECEIVER_DEVICE
+#define PCAPPP_CLUSTER_RECEIVER_DEVICE
+
+#include "PacketQueueDevice.h"
+#include "ClusterDistributor.h"
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class ClusterReceiverDevice
+	 * The receiving end of a ClusterDistributor on a node of the cluster. The VXLAN packets captured by any device (a PcapLiveDevice, a
+	 * DpdkDevice, an XdpDevice...) are given to decapsulateAndEnqueue(), and the original packets inside them are queued. Workers then read
+	 * them with dequeue(), dequeueBurst() or receivePackets() as from any PacketQueueDevice, so the rest of the application handles the
+	 * traffic as if it was captured on the node itself.
+	 * Packets which aren't VXLAN packets to the configured port and VNI are counted and ignored. The static onPacketArrives() and
+	 * onPacketsArriveBurst() callbacks can be given to PcapLiveDevice#startCapture() and PcapLiveDevice#startCaptureBurstMode() with the
+	 * device as the user cookie to feed it directly
+	 */
+	class ClusterReceiverDevice : public PacketQueueDevice
+	{
+	public:
+
+		/**
+		 * A VNI value which makes the device accept packets of all VNIs
+		 */
+		static const uint32_t AnyVni = 0xFFFFFFFF;
+
+		/**
+		 * A c'tor for this class. The queue isn't allocated until open() is called
+		 * @param[in] vni The VXLAN Network ID of the packets to accept, or #AnyVni to accept all of them. Default value is #AnyVni
+		 * @param[in] dstPort The destination UDP port of the VXLAN packets. Default value is 4789
+		 * @param[in] capacity The maximum number of packets in the queue. Default value is #PCPP_PACKET_QUEUE_DEFAULT_CAPACITY
+		 * @param[in] queueType The threads which may push and pop packets. Default value is MultiProducerMultiConsumer
+		 * @param[in] pool A pool to take the data buffers of the queued packets from, or NULL for allocating them on the heap. Default value
+		 * is NULL
+		 */
+		ClusterReceiverDevice(uint32_t vni = AnyVni, uint16_t dstPort = 4789, size_t capacity = PCPP_PACKET_QUEUE_DEFAULT_CAPACITY,
+				QueueType queueType = MultiProducerMultiConsumer, RawPacketPool* pool = NULL);
+
+		/**
+		 * Decapsulate received packets and queue copies of the packets inside them. Packets which don't fit in the queue are counted as
+		 * dropped (see PacketQueueDevice#getNumOfDroppedPackets())
+		 * @param[in] packets An array of received packets. The packets aren't changed
+		 * @param[in] count The number of packets in the array
+		 * @return The number of packets queued
+		 */
+		int decapsulateAndEnqueue(const RawPacket* packets, int count);
+
+		/**
+		 * Same as decapsulateAndEnqueue(const RawPacket*, int) for an array of packet pointers, as received from DpdkDevice or XdpDevice
+		 * @param[in] packets An array of received packets. The packets aren't changed
+		 * @param[in] count The number of packets in the array
+		 * @return The number of packets queued
+		 */
+		int decapsulateAndEnqueue(RawPacket** packets, int count);
+
+		/**
+		 * @return The number of received packets which were ignored because they aren't VXLAN packets to the configured port and VNI. When
+		 * producers are still pushing packets the value may already be outdated
+		 */
+		uint64_t getNumOfIgnoredPackets() const;
+
+		/**
+		 * A PcapLiveDevice#startCapture() callback which decapsulates each captured packet into the device
+		 * @param[in] packet The captured packet
+		 * @param[in] pDevice The capturing device
+		 * @param[in] userCookie A pointer to the ClusterReceiverDevice instance
+		 */
+		static void onPacketArrives(RawPacket* packet, PcapLiveDevice* pDevice, void* userCookie);
+
+		/**
+		 * A PcapLiveDevice#startCaptureBurstMode() callback which decapsulates each burst of captured packets into the device
+		 * @param[in] packets The captured packets
+		 * @param[in] numOfPackets The number of captured packets
+		 * @param[in] pDevice The capturing device
+		 * @param[in] userCookie A pointer to the ClusterReceiverDevice instance
+		 */
+		static void onPacketsArriveBurst(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* pDevice, void* userCookie);
+
+	private:
+
+		uint32_t m_Vni;
+		uint16_t m_DstPort;
+		volatile uint64_t m_IgnoredPackets;
+
+		int decapsulateAndEnqueue(const RawPacket* const* packets, const RawPacket* packetArray, int count);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_CLUSTER_RECEIVER_DEVICE */
@@ -6,6 +6,7 @@
 #include "PointerVector.h"
 #include "RawPacket.h"
 #include "PcapFilter.h"
+#include "MetricsRegistry.h"
 
 /**
 * \namespace pcpp
@@ -19,9 +20,10 @@ namespace pcpp
 	/**
 	 * @class IDevice
 	 * An abstract interface representing all packet processing devices. It stands as the root class for all devices.
+	 * All devices are metrics sources (see MetricsRegistry) reporting their packet, byte and drop counters.
 	 * This is an abstract class that cannot be instantiated
 	 */
-	class IDevice
+	class IDevice : public MetricsSource
 	{
 	protected:
 		bool m_DeviceOpened;
@@ -48,6 +50,13 @@ namespace pcpp
 		 * @return True if the file is opened, false otherwise
 		 */
 		inline bool isOpened() { return m_DeviceOpened; }
+
+		/**
+		 * Report the device counters to a MetricsRegistry snapshot. Nothing is reported while the device is closed. The default
+		 * implementation reports nothing
+		 * @param[in] writer The writer to report the values to
+		 */
+		virtual void collectMetrics(MetricsWriter& writer) {}
 	};
 
 
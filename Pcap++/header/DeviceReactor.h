@@ -0,0 +1,149 @@
+#ifndef PCAPPP_DEVICE_REACTOR
+#define PCAPPP_DEVICE_REACTOR
+
+#include "PcapLiveDevice.h"
+#include "RawSocketDevice.h"
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The default maximum number of packets DeviceReactor reads from a device each time it becomes readable
+ */
+#define PCPP_DEVICE_REACTOR_DEFAULT_BURST_SIZE 64
+
+	/**
+	 * @typedef OnReactorPacketsArriveCallback
+	 * A callback that is called by DeviceReactor with a burst of packets read from one of its devices
+	 * @param[in] packets An array of the read raw packets. The packets and their data are owned by the device and are valid only until the
+	 * callback returns
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] device A pointer to the device the packets were read from, the PcapLiveDevice or RawSocketDevice given to
+	 * DeviceReactor#addDevice()
+	 * @param[in] userCookie A pointer to the object given by the user when the device was added
+	 */
+	typedef void (*OnReactorPacketsArriveCallback)(RawPacket* packets, uint32_t numOfPackets, IDevice* device, void* userCookie);
+
+	/**
+	 * @class DeviceReactor
+	 * An event loop which drives the capture of many devices from a single thread. Instead of a capture thread per device, the selectable
+	 * file descriptors of the devices (see PcapLiveDevice#getSelectableFd() and RawSocketDevice#getSelectableFd()) are registered in an
+	 * epoll instance, and each time a device becomes readable the packets waiting on it are read without blocking (see
+	 * PcapLiveDevice#pollPackets() and RawSocketDevice#pollPackets()) and passed to the device's callback as one burst. This suits hosts
+	 * with many low-rate interfaces, where a thread per interface wastes cores and context switches; a few reactors on a few threads can
+	 * share the interfaces between them.
+	 * At most one burst is read from a device each time it's found readable, so a busy device can't starve the others, and the packets
+	 * left on it are read in the next round. The reactor runs on the thread calling run() or runOnce(), and all callbacks are called on
+	 * that thread. Devices must be opened before they're added and removed before they're closed, and mustn't be captured from in other
+	 * ways (startCapture() etc.) while they're in the reactor. Adding and removing devices should be done on the thread running the
+	 * reactor, or while it isn't running. stop() may be called from any thread, including from a callback.
+	 * This class is supported on Linux only, on other platforms adding devices fails
+	 */
+	class DeviceReactor
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] maxBurstSize The maximum number of packets read from a device each time it becomes readable. Default value is
+		 * #PCPP_DEVICE_REACTOR_DEFAULT_BURST_SIZE
+		 */
+		DeviceReactor(uint32_t maxBurstSize = PCPP_DEVICE_REACTOR_DEFAULT_BURST_SIZE);
+
+		/**
+		 * A d'tor for this class. Removes all devices, which aren't closed
+		 */
+		~DeviceReactor();
+
+		/**
+		 * Add a live device to the reactor
+		 * @param[in] device The device to add, which must be open
+		 * @param[in] onPacketsArrive The callback the packets read from the device are passed to
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object, which is passed to the callback
+		 * @return True if the device was added, false if it's NULL, not open, already in the reactor, has no selectable file descriptor
+		 * (like PcapRemoteDevice), the callback is NULL or the platform isn't Linux. In the error cases an error is printed to log
+		 */
+		bool addDevice(PcapLiveDevice* device, OnReactorPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie);
+
+		/**
+		 * Add a raw socket device to the reactor
+		 * @param[in] device The device to add, which must be open
+		 * @param[in] onPacketsArrive The callback the packets read from the device are passed to
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object, which is passed to the callback
+		 * @return True if the device was added, false if it's NULL, not open, already in the reactor, the callback is NULL or the platform
+		 * isn't Linux. In the error cases an error is printed to log
+		 */
+		bool addDevice(RawSocketDevice* device, OnReactorPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie);
+
+		/**
+		 * Remove a device from the reactor. The device isn't closed. A device may remove itself from its own callback
+		 * @param[in] device The device to remove
+		 * @return True if the device was removed, false if it isn't in the reactor
+		 */
+		bool removeDevice(IDevice* device);
+
+		/**
+		 * @return The number of devices in the reactor
+		 */
+		inline size_t getNumOfDevices() const { return m_Devices.size(); }
+
+		/**
+		 * Wait until at least one device is readable or the timeout expires, and read one burst from each readable device
+		 * @param[in] timeoutMs The maximum time to wait in milliseconds. 0 means not waiting at all, a negative value means waiting until a
+		 * device is readable or stop() is called
+		 * @return The number of packets read, or -1 if waiting failed
+		 */
+		int runOnce(int timeoutMs);
+
+		/**
+		 * Run the event loop on the calling thread, until stop() is called. If stop() was called before run() started, run() returns right
+		 * away
+		 * @return True if the loop was stopped by stop(), false if waiting failed or the platform isn't Linux
+		 */
+		bool run();
+
+		/**
+		 * Make run() return, and wake up a runOnce() call which waits. May be called from any thread, including from a callback
+		 */
+		void stop();
+
+		/**
+		 * @return The maximum number of packets read from a device each time it becomes readable
+		 */
+		inline uint32_t getMaxBurstSize() const { return m_MaxBurstSize; }
+
+	private:
+
+		struct DeviceEntry;
+
+		uint32_t m_MaxBurstSize;
+		int m_EpollFd;
+		int m_WakeupFd;
+		volatile bool m_StopRequested;
+		std::vector<DeviceEntry*> m_Devices;
+		// entries removed while the ready events are handled, which are deleted after the round
+		std::vector<DeviceEntry*> m_RemovedDevices;
+		bool m_InRound;
+
+		bool init();
+		bool addEntry(DeviceEntry* entry);
+		int pollEntry(DeviceEntry* entry);
+		void deleteRemovedEntries();
+		static void onLiveDevicePacketsArrive(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* device, void* userCookie);
+		static void onRawSocketPacketsArrive(RawPacket* packets, uint32_t numOfPackets, RawSocketDevice* device, void* userCookie);
+
+		// disable copy c'tor and assignment operator
+		DeviceReactor(const DeviceReactor& other);
+		DeviceReactor& operator=(const DeviceReactor& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DEVICE_REACTOR */
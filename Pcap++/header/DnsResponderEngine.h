@@ -0,0 +1,135 @@
+#ifndef PCAPPP_DNS_RESPONDER_ENGINE
+#define PCAPPP_DNS_RESPONDER_ENGINE
+
+#include "DnsResponder.h"
+#include "RawPacket.h"
+#include <stdint.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The maximum number of packets DnsResponderEngine receives and sends in one burst
+ */
+#define PCPP_DNS_RESPONDER_BURST_SIZE 64
+
+/**
+ * The size of the buffers DnsResponderEngine builds AF_XDP responses in. Longer packets aren't answered
+ */
+#define PCPP_DNS_RESPONDER_BUFFER_SIZE 2048
+
+	class DpdkDevice;
+	class DpdkForwarder;
+	class MBufRawPacket;
+	class XdpDevice;
+
+	/**
+	 * @struct DnsResponderEngineStats
+	 * The statistics of DnsResponderEngine. The statistics of the queries themselves are kept by the DnsResponder
+	 */
+	struct DnsResponderEngineStats
+	{
+		/** Number of packets received */
+		uint64_t rxPackets;
+		/** Number of responses sent */
+		uint64_t txPackets;
+		/** Number of responses dropped because the TX queue was full */
+		uint64_t txDrops;
+	};
+
+	/**
+	 * @class DnsResponderEngine
+	 * Runs a DnsResponder on bursts of packets received from a queue of a DpdkDevice or an XdpDevice, and sends the responses through a TX
+	 * queue of the same device. Each call to respondBurst() handles one burst:
+	 * - With DpdkDevice the queries are turned into responses in their mbufs, which move from the RX queue to the TX queue without being
+	 *   copied (using DpdkForwarder)
+	 * - With XdpDevice the packets are copied from the UMEM to buffers of the engine, turned into responses there, and sent with
+	 *   XdpDevice#sendPackets()
+	 *
+	 * Packets which aren't turned into responses are dropped, so the queue should receive only DNS traffic (for example by steering it
+	 * with DpdkDevice flow rules or an XdpDevice filter). A typical loop of a worker thread looks like this:
+	 *
+	 * @code
+	 * DnsResponder responder;
+	 * responder.addRecord("*.ads.example.com", IPv4Address(std::string("10.0.0.1")), 300);
+	 * DnsResponderEngine engine(responder, device, queueId, queueId);
+	 * while (!m_Stop)
+	 *     engine.respondBurst();
+	 * @endcode
+	 *
+	 * An engine and its responder must be used by one thread only. To respond on several queues, use an engine and a copy of the responder
+	 * for each queue
+	 */
+	class DnsResponderEngine
+	{
+	public:
+
+		/**
+		 * A c'tor for responding on a DPDK device. Available only when PcapPlusPlus is built with DPDK
+		 * @param[in] responder The responder which turns queries into responses
+		 * @param[in] device The device to receive queries from and send responses to
+		 * @param[in] rxQueueId The RX queue to receive queries from
+		 * @param[in] txQueueId The TX queue to send responses through
+		 */
+		DnsResponderEngine(DnsResponder& responder, DpdkDevice* device, uint16_t rxQueueId, uint16_t txQueueId);
+
+		/**
+		 * A c'tor for responding on an AF_XDP device
+		 * @param[in] responder The responder which turns queries into responses
+		 * @param[in] device The device to receive queries from and send responses to
+		 * @param[in] rxQueueId The RX queue to receive queries from. It mustn't be read by the capture threads of the device
+		 * @param[in] txQueueId The TX queue to send responses through
+		 */
+		DnsResponderEngine(DnsResponder& responder, XdpDevice* device, uint16_t rxQueueId, uint16_t txQueueId);
+
+		/**
+		 * A d'tor for this class
+		 */
+		~DnsResponderEngine();
+
+		/**
+		 * Receive one burst of up to #PCPP_DNS_RESPONDER_BURST_SIZE packets, turn the queries among them into responses and send them
+		 * @return The number of packets received, which may be passed to DpdkAdaptivePoller#onPoll()
+		 */
+		uint16_t respondBurst();
+
+		/**
+		 * Get the engine statistics
+		 * @param[out] stats The statistics
+		 */
+		void getStats(DnsResponderEngineStats& stats) const;
+
+		/**
+		 * Reset the engine statistics
+		 */
+		void clearStats();
+
+	private:
+
+		DnsResponder& m_Responder;
+		DpdkForwarder* m_DpdkForwarder;
+		XdpDevice* m_XdpDevice;
+		uint16_t m_RxQueueId;
+		uint16_t m_TxQueueId;
+		RawPacket m_RxPackets[PCPP_DNS_RESPONDER_BURST_SIZE];
+		RawPacket m_TxPackets[PCPP_DNS_RESPONDER_BURST_SIZE];
+		uint8_t* m_TxBuffers;
+		DnsResponderEngineStats m_Stats;
+
+		uint16_t respondXdpBurst();
+		static bool onDpdkPacket(MBufRawPacket& packet, void* userCookie);
+
+		// disable copy c'tor and assignment operator
+		DnsResponderEngine(const DnsResponderEngine& other);
+		DnsResponderEngine& operator=(const DnsResponderEngine& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DNS_RESPONDER_ENGINE */
@@ -0,0 +1,239 @@
+#ifndef PCAPPP_DPDK_ADAPTIVE_POLLER
+#define PCAPPP_DPDK_ADAPTIVE_POLLER
+
+#include <stdint.h>
+
+/**
+ * @file
+ * Adaptive polling for the cores which poll DPDK RX queues. A core which polls a queue in a busy loop uses 100% of the CPU even when no
+ * traffic arrives. DpdkAdaptivePoller lowers the power of an idle core in steps as the number of consecutive empty polls grows, and
+ * returns to busy polling as soon as a poll returns packets.
+ * For details about PcapPlusPlus support for DPDK see DpdkDevice.h file description
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	class DpdkDevice;
+
+	/**
+	 * @struct DpdkAdaptivePollingConfig
+	 * The thresholds of the idle steps of DpdkAdaptivePoller. A threshold is a number of consecutive empty polls, and a threshold of 0
+	 * disables its step
+	 */
+	struct DpdkAdaptivePollingConfig
+	{
+		/**
+		 * The number of consecutive empty polls after which the core pauses (rte_pause()) after every empty poll
+		 */
+		uint32_t emptyPollsBeforePause;
+
+		/**
+		 * The number of pause instructions executed after an empty poll in the pause step
+		 */
+		uint32_t pausesPerPoll;
+
+		/**
+		 * The number of consecutive empty polls after which the core waits in a low power state until the NIC writes the next RX
+		 * descriptor of the queue (rte_power_monitor(), which uses UMWAIT on x86). Requires DPDK 21.02 or later and a CPU and PMD which
+		 * support it, otherwise the step is skipped
+		 */
+		uint32_t emptyPollsBeforeMonitor;
+
+		/**
+		 * The maximum time in microseconds the core waits in the monitor step before polling again
+		 */
+		uint32_t monitorTimeoutUs;
+
+		/**
+		 * The number of consecutive empty polls after which the core sleeps until an RX interrupt of the queue arrives. Requires the
+		 * device to be opened with DpdkDevice::DpdkDeviceConfiguration#rxInterrupts and a PMD which supports RX interrupts, otherwise the
+		 * step is skipped
+		 */
+		uint32_t emptyPollsBeforeInterrupt;
+
+		/**
+		 * The maximum time in milliseconds the core sleeps in the interrupt step before polling again. It also bounds the time it takes a
+		 * sleeping thread to notice it was asked to stop
+		 */
+		int interruptTimeoutMs;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] emptyPollsBeforePause Consecutive empty polls before the pause step. Default value is 64
+		 * @param[in] pausesPerPoll Pause instructions after each empty poll in the pause step. Default value is 32
+		 * @param[in] emptyPollsBeforeMonitor Consecutive empty polls before the monitor step. Default value is 1024
+		 * @param[in] monitorTimeoutUs Maximum wait in the monitor step in microseconds. Default value is 100
+		 * @param[in] emptyPollsBeforeInterrupt Consecutive empty polls before the interrupt step. Default value is 16384
+		 * @param[in] interruptTimeoutMs Maximum sleep in the interrupt step in milliseconds. Default value is 10
+		 */
+		DpdkAdaptivePollingConfig(uint32_t emptyPollsBeforePause = 64, uint32_t pausesPerPoll = 32, uint32_t emptyPollsBeforeMonitor = 1024,
+				uint32_t monitorTimeoutUs = 100, uint32_t emptyPollsBeforeInterrupt = 16384, int interruptTimeoutMs = 10)
+		{
+			this->emptyPollsBeforePause = emptyPollsBeforePause;
+			this->pausesPerPoll = pausesPerPoll;
+			this->emptyPollsBeforeMonitor = emptyPollsBeforeMonitor;
+			this->monitorTimeoutUs = monitorTimeoutUs;
+			this->emptyPollsBeforeInterrupt = emptyPollsBeforeInterrupt;
+			this->interruptTimeoutMs = interruptTimeoutMs;
+		}
+	};
+
+	/**
+	 * The idle steps of DpdkAdaptivePoller
+	 */
+	enum DpdkIdleState
+	{
+		/** The queue is polled in a busy loop */
+		DpdkIdleStateBusy,
+		/** The core pauses after every empty poll */
+		DpdkIdleStatePause,
+		/** The core waits in a low power state until the NIC writes to the queue */
+		DpdkIdleStateMonitor,
+		/** The core sleeps until an RX interrupt arrives */
+		DpdkIdleStateInterrupt
+	};
+
+	/**
+	 * @struct DpdkAdaptivePollingStats
+	 * The statistics of DpdkAdaptivePoller
+	 */
+	struct DpdkAdaptivePollingStats
+	{
+		/** The current idle step */
+		DpdkIdleState idleState;
+		/** Number of polls */
+		uint64_t polls;
+		/** Number of polls which returned no packets */
+		uint64_t emptyPolls;
+		/** Number of empty polls followed by pauses */
+		uint64_t pauses;
+		/** Number of waits in the monitor step */
+		uint64_t monitorWaits;
+		/** Number of sleeps in the interrupt step */
+		uint64_t interruptWaits;
+		/** Number of sleeps in the interrupt step which were ended by an interrupt rather than by the timeout */
+		uint64_t interruptWakeups;
+		/** Number of times traffic returned after the core left busy polling */
+		uint64_t busyReturns;
+		/** TSC cycles spent pausing, waiting and sleeping */
+		uint64_t idleCycles;
+	};
+
+	/**
+	 * @class DpdkAdaptivePoller
+	 * Lowers the power a core spends polling an RX queue of a DpdkDevice while the queue is idle. The poller is told the result of every
+	 * poll with onPoll(), and after each empty poll it idles according to the number of consecutive empty polls so far, in steps of
+	 * increasing latency and decreasing power (see DpdkAdaptivePollingConfig):
+	 *    -# Busy polling, as long as traffic keeps arriving
+	 *    -# Pausing the core with rte_pause() after each empty poll
+	 *    -# Waiting in a low power state until the NIC writes the next RX descriptor (rte_power_monitor())
+	 *    -# Sleeping until an RX interrupt arrives (rte_eth_dev_rx_intr_enable())
+	 *
+	 * Steps which the DPDK version, CPU or PMD don't support are skipped. A poll which returns packets brings the poller back to busy
+	 * polling right away. A typical DpdkWorkerThread loop looks like this:
+	 *
+	 * @code
+	 * DpdkAdaptivePoller poller(dev, rxQueueId);
+	 * while (!m_Stop)
+	 * {
+	 *     uint16_t numOfPackets = dev->receivePackets(packets, MAX_RECEIVE_BURST, rxQueueId);
+	 *     poller.onPoll(numOfPackets);
+	 *     // process the packets
+	 * }
+	 * @endcode
+	 *
+	 * The capture threads of DpdkDevice use a poller per queue when enabled with DpdkDevice#setCaptureAdaptivePolling(). A poller must be
+	 * used by one thread only, which must be the thread polling the queue, as RX interrupts are registered to the calling thread
+	 */
+	class DpdkAdaptivePoller
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] device The device whose RX queue is polled
+		 * @param[in] rxQueueId The polled RX queue
+		 * @param[in] config The thresholds of the idle steps
+		 */
+		DpdkAdaptivePoller(DpdkDevice* device, uint16_t rxQueueId, const DpdkAdaptivePollingConfig& config = DpdkAdaptivePollingConfig());
+
+		/**
+		 * A d'tor for this class. Unregisters the RX interrupt of the queue if it was registered (see releaseRxInterrupt())
+		 */
+		~DpdkAdaptivePoller();
+
+		/**
+		 * Report the result of a poll of the queue. If the poll returned no packets, idle according to the number of consecutive empty
+		 * polls before returning
+		 * @param[in] numOfPacketsReceived The number of packets the poll returned
+		 */
+		inline void onPoll(uint32_t numOfPacketsReceived)
+		{
+			m_Stats.polls++;
+			if (numOfPacketsReceived > 0)
+			{
+				if (m_ConsecutiveEmptyPolls != 0)
+					onTrafficReturned();
+				return;
+			}
+
+			onEmptyPoll();
+		}
+
+		/**
+		 * @return The current idle step
+		 */
+		inline DpdkIdleState getIdleState() const { return m_Stats.idleState; }
+
+		/**
+		 * @return The thresholds of the idle steps
+		 */
+		inline const DpdkAdaptivePollingConfig& getConfig() const { return m_Config; }
+
+		/**
+		 * Get the poller statistics
+		 * @param[out] stats The statistics
+		 */
+		inline void getStats(DpdkAdaptivePollingStats& stats) const { stats = m_Stats; }
+
+		/**
+		 * Reset the poller statistics, except for the current idle step
+		 */
+		void clearStats();
+
+		/**
+		 * Unregister the RX interrupt of the queue, which is registered to the polling thread on the first sleep in the interrupt step.
+		 * Must be called by the polling thread, so a thread which stops polling should call it if the poller is destroyed by another
+		 * thread. The d'tor calls it too. The interrupt is registered again if the poller sleeps in the interrupt step later
+		 */
+		void releaseRxInterrupt();
+
+	private:
+
+		DpdkDevice* m_Device;
+		uint16_t m_RxQueueId;
+		DpdkAdaptivePollingConfig m_Config;
+		DpdkAdaptivePollingStats m_Stats;
+		uint32_t m_ConsecutiveEmptyPolls;
+		bool m_MonitorSupported;
+		bool m_InterruptSupported;
+		bool m_InterruptRegistered;
+
+		void onEmptyPoll();
+		void onTrafficReturned();
+		bool waitForInterrupt();
+		bool waitForMonitor();
+
+		// disable copy c'tor and assignment operator
+		DpdkAdaptivePoller(const DpdkAdaptivePoller& other);
+		DpdkAdaptivePoller& operator=(const DpdkAdaptivePoller& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DPDK_ADAPTIVE_POLLER */
@@ -0,0 +1,322 @@
+#ifndef PCAPPP_DPDK_CAPTURE_WRITER
+#define PCAPPP_DPDK_CAPTURE_WRITER
+
+#include "DpdkDevice.h"
+#include "DpdkDeviceList.h"
+#include "RawPacket.h"
+#include <string>
+#include <vector>
+
+struct rte_ring;
+struct rte_mbuf;
+
+/**
+ * @file
+ * Recording packets received by DPDK devices to pcap files at line rate. Converting every MBufRawPacket and writing it with
+ * PcapFileWriterDevice on the RX core costs a copy and a buffered write per packet on the core which should only receive. DpdkCaptureWriter
+ * moves the writing to dedicated writer cores: RX cores only take a reference to the mbufs of the packets and enqueue them to a ring, and
+ * the writer cores copy them into large aligned buffers which are written to disk in big sequential writes.
+ * For details about PcapPlusPlus support for DPDK see DpdkDevice.h file description
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+/**
+ * The maximum number of packets DpdkCaptureWriter dequeues from a ring in one burst
+ */
+#define PCPP_DPDK_CAPTURE_WRITER_BURST_SIZE 64
+
+/**
+ * The default number of packets each ring of DpdkCaptureWriter can hold
+ */
+#define PCPP_DPDK_CAPTURE_WRITER_DEFAULT_RING_SIZE 8192
+
+	/**
+	 * @struct DpdkCaptureWriterConfiguration
+	 * The configuration of DpdkCaptureWriter
+	 */
+	struct DpdkCaptureWriterConfiguration
+	{
+		/** The directories the files are written to. Writer N writes to directory (N % number of directories), so with a directory on each
+		 * NVMe drive and at least as many writers as drives the files are striped across the drives. If empty, the current directory is used
+		 */
+		std::vector<std::string> directories;
+
+		/** The prefix of the file names. A file is named <prefix>_<writer ID>_<file number>.pcap */
+		std::string fileNamePrefix;
+
+		/** The number of writers, each of them writes its own files and is drained by one thread at a time */
+		uint16_t numOfWriters;
+
+		/** The minimal number of packets each ring can hold. The actual capacity is rounded up to a power of 2 minus 1 */
+		uint32_t ringSize;
+
+		/** The size of the buffer of each writer, rounded up to a multiple of 4KB. The buffer is written to the file when it's full, so
+		 * it's the size of a single write */
+		size_t bufferSize;
+
+		/** The size in bytes after which a writer starts a new file. If the value is set to 0 files aren't rolled over */
+		uint64_t maxFileSize;
+
+		/** The maximum number of files each writer keeps. When a writer starts a new file and it has more files, the oldest one is deleted,
+		 * so the files form a ring of the latest captured packets. If the value is set to 0 all files are kept */
+		uint32_t maxNumOfFiles;
+
+		/** The maximum number of bytes of each packet written to the file */
+		uint32_t snapshotLength;
+
+		/** The flag indicating whether the files are written in the nanosecond pcap format */
+		bool nanosecondsPrecision;
+
+		/** The flag indicating whether the files are opened with O_DIRECT, so the written data bypasses the page cache. If a file system
+		 * doesn't support O_DIRECT the file is written through the page cache */
+		bool directIo;
+
+		/** The link layer type of the packets */
+		LinkLayerType linkLayerType;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] numOfWriters The number of writers. The default is 1
+		 * @param[in] maxFileSize The size in bytes after which a writer starts a new file, 0 means no limit. The default is 1GB
+		 * @param[in] maxNumOfFiles The maximum number of files each writer keeps, 0 means all files are kept. The default is 0
+		 */
+		DpdkCaptureWriterConfiguration(uint16_t numOfWriters = 1, uint64_t maxFileSize = 1024ULL * 1024 * 1024, uint32_t maxNumOfFiles = 0) :
+			fileNamePrefix("capture"), numOfWriters(numOfWriters), ringSize(PCPP_DPDK_CAPTURE_WRITER_DEFAULT_RING_SIZE), bufferSize(4 * 1024 * 1024),
+			maxFileSize(maxFileSize), maxNumOfFiles(maxNumOfFiles), snapshotLength(65535), nanosecondsPrecision(false), directIo(true),
+			linkLayerType(LINKTYPE_ETHERNET)
+		{
+		}
+	};
+
+	/**
+	 * @struct DpdkCaptureWriterProducerStats
+	 * The statistics of a producer of DpdkCaptureWriter
+	 */
+	struct DpdkCaptureWriterProducerStats
+	{
+		/** Number of packets the producer enqueued for writing */
+		uint64_t enqueuedPackets;
+		/** Number of packets which weren't enqueued because the ring of the producer was full or the mbuf had no headroom for the record
+		 * header. These packets aren't recorded */
+		uint64_t rejectedPackets;
+		/** Number of packets currently in the ring of the producer */
+		uint32_t pendingPackets;
+	};
+
+	/**
+	 * @struct DpdkCaptureWriterStats
+	 * The statistics of a writer of DpdkCaptureWriter
+	 */
+	struct DpdkCaptureWriterStats
+	{
+		/** Number of packets written (or buffered for writing) */
+		uint64_t writtenPackets;
+		/** Number of bytes written to files, including the file and record headers */
+		uint64_t writtenBytes;
+		/** Number of files the writer opened */
+		uint32_t numOfFiles;
+		/** Number of writes which failed. The data of a failed write is lost */
+		uint32_t writeErrors;
+	};
+
+	/**
+	 * @class DpdkCaptureWriter
+	 * Records packets of DPDK devices to pcap files on dedicated writer cores (see the file description). Each producer (an RX core)
+	 * gets a single-producer single-consumer ring, and the rings are mapped to the writers evenly: producer N is mapped to writer
+	 * (N % number of writers). recordPackets() doesn't copy packet data: it writes the pcap record header into the headroom of the mbuf
+	 * in front of the packet data, increments the reference count of the mbuf and enqueues it, so the producer keeps its packets and may
+	 * forward or free them as usual. The writer cores call drainWriter() (or run DpdkCaptureWriterThread), which copies the records of a
+	 * burst into the writer's buffer and frees the burst's references in bulk. A full buffer is written to the current file with a single
+	 * write, and with O_DIRECT only whole 4KB blocks are written, so the data goes from the buffer to the drive without passing through the
+	 * page cache.<BR>
+	 * A writer starts a new file when the current one reaches DpdkCaptureWriterConfiguration#maxFileSize, and several writers writing to
+	 * directories on different drives stripe the capture across the drives. For example, 8 RX cores recorded by 4 writers to 2 drives:
+	 *
+	 * @code
+	 * DpdkCaptureWriterConfiguration config(4);
+	 * config.directories.push_back("/mnt/nvme0/capture");
+	 * config.directories.push_back("/mnt/nvme1/capture");
+	 * DpdkCaptureWriter captureWriter(8, config);
+	 * // on RX core N
+	 * uint16_t numOfPackets = device->receivePackets(packets, 64, N);
+	 * captureWriter.recordPackets(N, packets, numOfPackets);
+	 * // on writer core W
+	 * while (!stop)
+	 *     captureWriter.drainWriter(W);
+	 * captureWriter.closeWriter(W);
+	 * @endcode
+	 *
+	 * Notice that since the mbufs are shared, headers mustn't be prepended to recorded packets (which overwrites their headroom) until they
+	 * were written. A writer must be drained by one thread at a time, although one thread may drain several writers. This class is
+	 * available on Linux only
+	 */
+	class DpdkCaptureWriter
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. Check isValid() to find out whether the rings and buffers were created
+		 * @param[in] numOfProducers The number of producer threads which record packets, each of them is given a ring
+		 * @param[in] config The configuration of the writers
+		 */
+		DpdkCaptureWriter(uint16_t numOfProducers, const DpdkCaptureWriterConfiguration& config = DpdkCaptureWriterConfiguration());
+
+		/**
+		 * A d'tor for this class. Writes the packets still in the rings and buffers, closes the files and frees the rings and buffers
+		 */
+		~DpdkCaptureWriter();
+
+		/**
+		 * @return True if the rings and buffers were created successfully, false otherwise
+		 */
+		inline bool isValid() const { return m_Valid; }
+
+		/**
+		 * @return The configuration of the writers
+		 */
+		inline const DpdkCaptureWriterConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * @return The number of producers
+		 */
+		inline uint16_t getNumOfProducers() const { return m_NumOfProducers; }
+
+		/**
+		 * @return The number of writers
+		 */
+		inline uint16_t getNumOfWriters() const { return m_NumOfWriters; }
+
+		/**
+		 * @param[in] producerId The producer ID
+		 * @return The writer the packets of the producer are written by
+		 */
+		inline uint16_t getProducerWriter(uint16_t producerId) const { return (m_NumOfWriters == 0 ? 0 : producerId % m_NumOfWriters); }
+
+		/**
+		 * Enqueue packets for recording. Must be called only by the thread of the producer. The packets stay attached to their mbufs, the
+		 * writer holds a reference of its own to each recorded mbuf
+		 * @param[in] producerId The ID of the calling producer, smaller than getNumOfProducers()
+		 * @param[in] packets An array of the packets to record. All of them must be attached to an mbuf
+		 * @param[in] count The number of packets in the array
+		 * @return The number of packets enqueued. It's smaller than count if the ring of the producer is full or some mbufs have no room for
+		 * the record header in their headroom
+		 */
+		uint16_t recordPackets(uint16_t producerId, MBufRawPacket** packets, uint16_t count);
+
+		/**
+		 * Enqueue a single packet for recording. See recordPackets()
+		 * @param[in] producerId The ID of the calling producer, smaller than getNumOfProducers()
+		 * @param[in] packet The packet to record. It must be attached to an mbuf
+		 * @return True if the packet was enqueued, false otherwise
+		 */
+		bool recordPacket(uint16_t producerId, MBufRawPacket& packet);
+
+		/**
+		 * Copy the packets enqueued by the producers mapped to a writer into its buffer, up to #PCPP_DPDK_CAPTURE_WRITER_BURST_SIZE packets
+		 * from each ring, and write the buffer to the file whenever it fills up. Must be called by one thread at a time for each writer
+		 * @param[in] writerId The writer to drain, smaller than getNumOfWriters()
+		 * @return The number of packets written
+		 */
+		uint32_t drainWriter(uint16_t writerId);
+
+		/**
+		 * Write all packets enqueued for a writer and all of its buffered data, and close its current file. The next drained packets
+		 * are written to a new file. Must be called by the thread which drains the writer
+		 * @param[in] writerId The writer to close, smaller than getNumOfWriters()
+		 */
+		void closeWriter(uint16_t writerId);
+
+		/**
+		 * Get the names of the files a writer wrote which weren't deleted, from the oldest to the newest
+		 * @param[in] writerId The writer ID
+		 * @param[out] fileNames The file names
+		 */
+		void getFileNames(uint16_t writerId, std::vector<std::string>& fileNames) const;
+
+		/**
+		 * Get the statistics of a producer
+		 * @param[in] producerId The producer ID
+		 * @param[out] stats The statistics
+		 */
+		void getProducerStats(uint16_t producerId, DpdkCaptureWriterProducerStats& stats) const;
+
+		/**
+		 * Get the statistics of a writer
+		 * @param[in] writerId The writer ID
+		 * @param[out] stats The statistics
+		 */
+		void getWriterStats(uint16_t writerId, DpdkCaptureWriterStats& stats) const;
+
+	private:
+
+		struct ProducerState;
+		struct WriterState;
+
+		DpdkCaptureWriterConfiguration m_Config;
+		uint16_t m_NumOfProducers;
+		uint16_t m_NumOfWriters;
+		bool m_Valid;
+		ProducerState* m_Producers;
+		WriterState* m_Writers;
+
+		void appendRecord(WriterState& writer, struct rte_mbuf* mBuf);
+		bool openFile(WriterState& writer);
+		void closeFile(WriterState& writer);
+		void writeBuffer(WriterState& writer, bool final);
+
+		// disable copy c'tor and assignment operator
+		DpdkCaptureWriter(const DpdkCaptureWriter& other);
+		DpdkCaptureWriter& operator=(const DpdkCaptureWriter& other);
+	};
+
+
+	/**
+	 * @class DpdkCaptureWriterThread
+	 * A worker thread which drains writers of a DpdkCaptureWriter in a loop until it's stopped, and then closes them. It's started by
+	 * DpdkDeviceList#startDpdkWorkerThreads() like other workers. Each writer should be drained by one DpdkCaptureWriterThread only
+	 */
+	class DpdkCaptureWriterThread : public DpdkWorkerThread
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] captureWriter The capture writer to drain
+		 * @param[in] writers The writers of the capture writer the thread drains
+		 */
+		DpdkCaptureWriterThread(DpdkCaptureWriter* captureWriter, const std::vector<uint16_t>& writers);
+
+		/**
+		 * Drain the writers until stop() is called, then close them
+		 * @param[in] coreId The core the thread runs on
+		 * @return False if the capture writer isn't valid, true otherwise
+		 */
+		bool run(uint32_t coreId);
+
+		/**
+		 * Stop draining the writers
+		 */
+		void stop();
+
+		/**
+		 * @return The core the thread runs on
+		 */
+		uint32_t getCoreId() { return m_CoreId; }
+
+	private:
+
+		DpdkCaptureWriter* m_CaptureWriter;
+		std::vector<uint16_t> m_Writers;
+		uint32_t m_CoreId;
+		volatile bool m_Stop;
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DPDK_CAPTURE_WRITER */
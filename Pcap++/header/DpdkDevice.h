@@ -7,6 +7,13 @@
 #include "SystemUtils.h"
 #include "Device.h"
 #include "MBufRawPacket.h"
+#include "DpdkAdaptivePoller.h"
+#include "NativeFilter.h"
+#include "PacketSampler.h"
+#include "IpAddress.h"
+#include "ProtocolType.h"
+#include <vector>
+#include <map>
 
 /**
  * @file
@@ -35,7 +42,8 @@
  * concept is that DPDK doesn't allocate mbufs on-the-fly but uses mbuf pools. These pools is allocated on application startup and
  * used throughout the application. The goal of this, of course, is increasing packet processing performance as allocating memory has
  * its cost. So pool size is important and varies between applications. For example: an application that stores packets in memory
- * has to have a large pool of mbufs so mbufs doesn't run-out. PcapPlusPlus enables to choose the pool size at startup<BR>
+ * has to have a large pool of mbufs so mbufs doesn't run-out. PcapPlusPlus enables to choose the pool size at startup, as well as the
+ * per-core cache size, the mbuf data room, the NUMA socket of the pools and sharing a pool between devices (see DpdkMBufPoolConfig)<BR>
  * <BR>
  * PcapPlusPlus main wrapper classes for DPDK are:
  *    - DpdkDevice - a class that wraps a DPDK port and provides all capabilities of receiving and sending packets to this port
@@ -57,6 +65,7 @@ struct rte_mbuf;
 struct rte_mempool;
 struct rte_eth_conf;
 struct rte_eth_dev_tx_buffer;
+struct rte_flow;
 
 /**
 * \namespace pcpp
@@ -68,6 +77,16 @@ namespace pcpp
 #define DPDK_MAX_RX_QUEUES 16
 #define DPDK_MAX_TX_QUEUES 16
 
+/**
+ * The number of buckets in the burst size histogram of DpdkDevice::RxBurstStats
+ */
+#define PCPP_DPDK_BURST_SIZE_HISTOGRAM_BUCKETS 10
+
+/**
+ * The number of buckets in the burst processing cycles histogram of DpdkDevice::RxBurstStats
+ */
+#define PCPP_DPDK_BURST_CYCLES_HISTOGRAM_BUCKETS 32
+
 	class DpdkDeviceList;
 	class DpdkDevice;
 
@@ -117,7 +136,9 @@ namespace pcpp
 
 	/**
 	 * @typedef OnDpdkPacketsArriveCallback
-	 * A callback that is called when a burst of packets are captured by DpdkDevice
+	 * A callback that is called when a burst of packets are captured by DpdkDevice. The packets and their mbufs are valid until the
+	 * callback returns, when the mbufs are freed. Packets which should be kept longer without copying them, for example to process them
+	 * on another core, are detached from their mbufs with MBufRawPacket#detachMBuf() or MBufRawPacket#detachMBufs()
 	 * @param[in] packets A pointer to an array of MBufRawPacket
 	 * @param[in] numOfPackets The length of the array
 	 * @param[in] threadId The thread/core ID who captured the packets
@@ -126,6 +147,191 @@ namespace pcpp
 	 */
 	typedef void (*OnDpdkPacketsArriveCallback)(MBufRawPacket* packets, uint32_t numOfPackets, uint8_t threadId, DpdkDevice* device, void* userCookie);
 
+	/**
+	 * @struct DpdkFlowRule
+	 * A rule which the NIC applies to received packets before they reach the RX queues (see DpdkDevice#addFlowRule()). The rule matches
+	 * packets by their header fields and steers them to an RX queue, spreads them over a group of RX queues by RSS or drops them, and can
+	 * mark them with a value the workers read with MBufRawPacket#getFlowMark(), so they don't have to classify the packets again.
+	 * The matched fields are kept in a FilterFlowRule and are best set with the setters of this struct, which take PcapPlusPlus types.
+	 * Port ranges which aren't aligned to a power of 2 are matched by several NIC rules, one for each aligned block of the range
+	 */
+	struct DpdkFlowRule
+	{
+		/**
+		 * The action the NIC takes on packets matching the rule
+		 */
+		enum FlowAction
+		{
+			/** Send the packets to the RX queue set in #queueId */
+			FlowActionQueue,
+			/** Spread the packets over the RX queues set in #rssQueues by RSS */
+			FlowActionRssGroup,
+			/** Drop the packets */
+			FlowActionDrop
+		};
+
+		/** The header fields the rule matches */
+		FilterFlowRule match;
+		/** The first port of the source port range to match. Used when the range isn't all ports, in which case match.srcPortMask must be 0 */
+		uint16_t srcPortRangeFirst;
+		/** The last port of the source port range to match */
+		uint16_t srcPortRangeLast;
+		/** The first port of the destination port range to match. Used when the range isn't all ports, in which case match.dstPortMask must be 0 */
+		uint16_t dstPortRangeFirst;
+		/** The last port of the destination port range to match */
+		uint16_t dstPortRangeLast;
+		/** The action to take on the matching packets. Default value is FlowActionQueue */
+		FlowAction action;
+		/** The RX queue of FlowActionQueue. Default value is 0 */
+		uint16_t queueId;
+		/** The RX queues of FlowActionRssGroup. If empty all opened RX queues are used */
+		std::vector<uint16_t> rssQueues;
+		/** Whether to mark the matching packets with #mark. Not applicable with FlowActionDrop. Default value is false */
+		bool setMark;
+		/** The mark the packets are marked with */
+		uint32_t mark;
+		/** The priority of the rule, where 0 is the highest. A packet matching rules of different priorities is handled by the rule of the
+		 * highest priority, while rules of the same priority shouldn't overlap. Which priorities are available depends on the PMD.
+		 * Default value is 0 */
+		uint32_t priority;
+
+		/**
+		 * A c'tor for this struct which creates a rule that matches all packets and sends them to RX queue 0
+		 */
+		DpdkFlowRule();
+
+		/**
+		 * Match packets of a protocol
+		 * @param[in] protocol The protocol: IPv4, IPv6, ARP or VLAN (matched by the EtherType), or TCP, UDP, ICMP, GRE or IGMP (matched by
+		 * the IP protocol, ICMP and IGMP also match IPv4)
+		 * @return True if the protocol can be matched, false otherwise
+		 */
+		bool setProtocol(ProtocolType protocol);
+
+		/**
+		 * Match packets whose IPv4 source address is in a subnet. This also matches IPv4
+		 * @param[in] address The address
+		 * @param[in] prefixLength The number of bits of the address to match, 32 for a single address. Default value is 32
+		 */
+		void setSrcIPv4Address(const IPv4Address& address, int prefixLength = 32);
+
+		/**
+		 * Match packets whose IPv4 destination address is in a subnet. This also matches IPv4
+		 * @param[in] address The address
+		 * @param[in] prefixLength The number of bits of the address to match, 32 for a single address. Default value is 32
+		 */
+		void setDstIPv4Address(const IPv4Address& address, int prefixLength = 32);
+
+		/**
+		 * Match packets whose source port is in a range. The protocol must also be set to TCP or UDP (see setProtocol())
+		 * @param[in] first The first port of the range
+		 * @param[in] last The last port of the range, equal to first to match a single port
+		 */
+		void setSrcPortRange(uint16_t first, uint16_t last);
+
+		/**
+		 * Match packets whose destination port is in a range. The protocol must also be set to TCP or UDP (see setProtocol())
+		 * @param[in] first The first port of the range
+		 * @param[in] last The last port of the range, equal to first to match a single port
+		 */
+		void setDstPortRange(uint16_t first, uint16_t last);
+	};
+
+	/**
+	 * @struct DpdkMBufPoolConfig
+	 * The configuration of the mbuf pools DpdkDeviceList creates for the DPDK devices on initialization (see DpdkDeviceList#initDpdk()).
+	 * By default each device gets its own pool, on the NUMA node of the device
+	 */
+	struct DpdkMBufPoolConfig
+	{
+		/**
+		 * The number of mbufs in each pool. This has to be a number which is a power of 2 minus 1, for example: 1023 (= 2^10-1)
+		 */
+		uint32_t poolSize;
+
+		/**
+		 * The number of mbufs each core keeps in its private cache of a pool, which spares most mbuf allocations and frees the access to
+		 * the shared ring of the pool. 0 disables the cache. It can't be larger than 512 (RTE_MEMPOOL_CACHE_MAX_SIZE) and poolSize must
+		 * be at least 1.5 times as large
+		 */
+		uint32_t cacheSize;
+
+		/**
+		 * The size of the data buffer of each mbuf in bytes, including the headroom (RTE_PKTMBUF_HEADROOM). 0 means DPDK's default
+		 * (RTE_MBUF_DEFAULT_BUF_SIZE), which fits a standard Ethernet frame. Packets longer than the buffer are received and stored in
+		 * chained mbufs (see MBufRawPacket)
+		 */
+		uint16_t dataRoomSize;
+
+		/**
+		 * The NUMA socket to allocate the pools on. -1 means the NUMA node of each device, or the node of the calling core if the node
+		 * of the device isn't known
+		 */
+		int socketId;
+
+		/**
+		 * If true, one pool is created per NUMA socket and shared by all devices on that socket, instead of one pool per device. A
+		 * packet received on one device can then be sent on another without being copied to the other device's pool, and the total
+		 * memory of the pools doesn't grow with the number of devices
+		 */
+		bool sharedPool;
+
+		/**
+		 * If not empty, the pools are allocated from this external malloc heap rather than from the hugepages DPDK reserved on
+		 * initialization. The heap must be created and given memory by the application after DPDK is initialized and before the
+		 * devices are (with rte_malloc_heap_create() and rte_malloc_heap_memory_add()), and socketId is ignored. Requires DPDK 18.11 or
+		 * later
+		 */
+		std::string externalHeapName;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] poolSize The number of mbufs in each pool, which must be a power of 2 minus 1
+		 * @param[in] cacheSize The size of the per-core cache of each pool. Default value is 256
+		 * @param[in] dataRoomSize The size of the data buffer of each mbuf. Default value is 0, which means DPDK's default
+		 * @param[in] socketId The NUMA socket to allocate the pools on. Default value is -1, which means the NUMA node of each device
+		 * @param[in] sharedPool Whether to share one pool between all devices on a NUMA socket. Default value is false
+		 * @param[in] externalHeapName The external malloc heap to allocate the pools from. Default value is an empty string, which means
+		 * the pools are allocated from DPDK's hugepages
+		 */
+		DpdkMBufPoolConfig(uint32_t poolSize, uint32_t cacheSize = 256, uint16_t dataRoomSize = 0, int socketId = -1, bool sharedPool = false,
+				const std::string& externalHeapName = "")
+		{
+			this->poolSize = poolSize;
+			this->cacheSize = cacheSize;
+			this->dataRoomSize = dataRoomSize;
+			this->socketId = socketId;
+			this->sharedPool = sharedPool;
+			this->externalHeapName = externalHeapName;
+		}
+	};
+
+	/**
+	 * @struct DpdkMBufPoolInfo
+	 * The configuration and usage of an mbuf pool. Returned from DpdkDevice#getMBufPoolInfo() and DpdkDeviceList#getMBufPoolsInfo()
+	 */
+	struct DpdkMBufPoolInfo
+	{
+		/** The name of the pool */
+		std::string name;
+		/** The NUMA socket the pool is allocated on, or the socket ID DPDK assigned to the external heap it's allocated from */
+		int socketId;
+		/** The number of mbufs in the pool */
+		uint32_t size;
+		/** The size of the per-core cache of the pool */
+		uint32_t cacheSize;
+		/** The size of the data buffer of each mbuf, including the headroom */
+		uint16_t dataRoomSize;
+		/** The number of mbufs which are free, including those in the per-core caches */
+		uint32_t freeMbufs;
+		/** The number of mbufs in use */
+		uint32_t mbufsInUse;
+		/** The number of free mbufs currently held in the per-core caches */
+		uint32_t cachedMbufs;
+		/** The number of devices which use the pool */
+		uint32_t numOfDevices;
+	};
+
 	/**
 	 * @class DpdkDevice
 	 * Encapsulates a DPDK port and enables receiving and sending packets using DPDK as well as getting interface info & status, packet
@@ -155,6 +361,10 @@ namespace pcpp
 	 * PCI address, PMD (poll-mode-driver) used for this port, etc. In addition it provides RX/TX statistics when receiving or sending
 	 * packets<BR>
 	 *
+	 * __Multi-process:__ a port opened by the primary process can be used by secondary processes (see
+	 * DpdkDeviceList#initDpdkSecondary()). Each process claims the RX/TX queues it works with using attachQueues(), and the packets
+	 * are received into the mbuf pools the primary process created, so they can be passed between the processes without copying<BR>
+	 *
 	 * __Known limitations:__
 	 *    - BPF filters are currently not supported by this device (as opposed to other PcapPlusPlus device types. This means that the 
 	 *      device cannot filter packets before they get to the user
@@ -165,6 +375,12 @@ namespace pcpp
 	{
 		friend class DpdkDeviceList;
 		friend class MBufRawPacket;
+		friend class DpdkAdaptivePoller;
+		friend class DpdkForwarder;
+		friend class DpdkL2Switch;
+		friend class DpdkL3Router;
+		friend class DpdkTxAggregator;
+		friend class DpdkEventRxThread;
 	public:
 
 		/**
@@ -215,6 +431,43 @@ namespace pcpp
 			RSS_NVGRE				= 0x80000
 		};
 
+		/**
+		 * An enum describing the hardware offloads DpdkDevice can enable on a port. Notice not all PMDs support all offloads, see
+		 * getSupportedOffloads(). The RX offloads report their results in the flags of each received mbuf, and the TX offloads are
+		 * requested per packet, see MBufRawPacket#getRxIPChecksumStatus(), MBufRawPacket#setTxChecksumOffload() etc.
+		 */
+		enum DpdkOffload
+		{
+			/** Validate the IPv4 header checksum of received packets */
+			OFFLOAD_RX_IPV4_CKSUM	= 0x1,
+			/** Validate the TCP checksum of received packets */
+			OFFLOAD_RX_TCP_CKSUM	= 0x2,
+			/** Validate the UDP checksum of received packets */
+			OFFLOAD_RX_UDP_CKSUM	= 0x4,
+			/** Strip the VLAN tag of received packets into the mbuf metadata */
+			OFFLOAD_RX_VLAN_STRIP	= 0x8,
+			/** Timestamp received packets with the NIC clock */
+			OFFLOAD_RX_TIMESTAMP	= 0x10,
+			/** Coalesce received TCP segments into larger packets (LRO) */
+			OFFLOAD_RX_TCP_LRO		= 0x20,
+			/** Receive packets larger than the mbuf data room into chained mbufs. Together with setMtu() it enables receiving jumbo
+			 * frames with the default mbuf size, see MBufRawPacket for handling chained mbufs */
+			OFFLOAD_RX_SCATTER		= 0x40,
+			/** Compute the IPv4 header checksum of sent packets */
+			OFFLOAD_TX_IPV4_CKSUM	= 0x100,
+			/** Compute the TCP checksum of sent packets */
+			OFFLOAD_TX_TCP_CKSUM	= 0x200,
+			/** Compute the UDP checksum of sent packets */
+			OFFLOAD_TX_UDP_CKSUM	= 0x400,
+			/** Insert a VLAN tag to sent packets from the mbuf metadata */
+			OFFLOAD_TX_VLAN_INSERT	= 0x800,
+			/** Split sent TCP packets larger than the MSS into segments (TSO) */
+			OFFLOAD_TX_TCP_TSO		= 0x1000,
+			/** Send chained mbufs, such as jumbo frames or packets with a prepended header segment (see
+			 * MBufRawPacket#prependHeaderSegment()) */
+			OFFLOAD_TX_MULTI_SEGS	= 0x2000
+		};
+
 		/**
 		 * @struct DpdkDeviceConfiguration
 		 * A struct that contains user configurable parameters for opening a DpdkDevice. All of these parameters have default values so 
@@ -261,6 +514,18 @@ namespace pcpp
 			 */
 			uint64_t rssHashFunction;
 
+			/**
+			 * The hardware offloads to enable on the port. The value is a mask composed of offloads described in DpdkOffload enum, all of
+			 * which must be supported by the PMD (see DpdkDevice#getSupportedOffloads()). Supplying a value equal to zero disables all offloads
+			 */
+			uint64_t offloads;
+
+			/**
+			 * Enable RX interrupts on the port, which DpdkAdaptivePoller uses for putting the cores polling an idle queue to sleep. Not all
+			 * PMDs support RX interrupts, and the device fails to open if they're enabled for a PMD which doesn't
+			 */
+			bool rxInterrupts;
+
 			/**
 			 * A c'tor for this struct
 			 * @param[in] receiveDescriptorsNumber An optional parameter for defining the number of RX descriptors that will be allocated for each RX queue.
@@ -273,13 +538,18 @@ namespace pcpp
 			 * @param[in] rssKey A pointer to an array holding the RSS key to use for hashing specific header of received packets. If not
 			 * specified, there is a default key defined inside DpdkDevice
 			 * @param[in] rssKeyLength The length in bytes of the array pointed by rssKey. Default value is the length of default rssKey
+			 * @param[in] offloads A mask of the hardware offloads to enable, composed of values described in DpdkOffload enum. The default
+			 * value is zero which means no offloads
+			 * @param[in] rxInterrupts Enable RX interrupts on the port (see DpdkAdaptivePoller). Default value is false
 			 */
 			DpdkDeviceConfiguration(uint16_t receiveDescriptorsNumber = 128,
 					uint16_t transmitDescriptorsNumber = 512,
 					uint16_t flushTxBufferTimeout = 100,
 					uint64_t rssHashFunction = RSS_IPV4 | RSS_IPV6,
 					uint8_t* rssKey = DpdkDevice::m_RSSKey,
-					uint8_t rssKeyLength = 40)
+					uint8_t rssKeyLength = 40,
+					uint64_t offloads = 0,
+					bool rxInterrupts = false)
 			{
 				this->receiveDescriptorsNumber = receiveDescriptorsNumber;
 				this->transmitDescriptorsNumber = transmitDescriptorsNumber;
@@ -287,6 +557,8 @@ namespace pcpp
 				this->rssKey = rssKey;
 				this->rssKeyLength = rssKeyLength;
 				this->rssHashFunction = rssHashFunction;
+				this->offloads = offloads;
+				this->rxInterrupts = rxInterrupts;
 			}
 		};
 
@@ -355,6 +627,42 @@ namespace pcpp
 			uint64_t rxMbufAlocFailed;
 		};
 
+		/**
+		 * @struct RxBurstStats
+		 * A snapshot of the burst statistics of an RX queue, which are collected while they're enabled (see setRxBurstStatsEnabled()).
+		 * Every receive call on the queue, by receivePackets() or by the capture threads, is a poll. The cycles of a burst are the TSC
+		 * cycles from the poll which returned it until the next poll of the queue, which is the time the DpdkWorkerThread polling the
+		 * queue spent processing the burst. Together these show whether the core of the queue keeps up with it
+		 */
+		struct RxBurstStats
+		{
+			/** Number of polls of the queue */
+			uint64_t polls;
+			/** Number of polls which returned no packets */
+			uint64_t emptyPolls;
+			/** The ratio of empty polls to all polls. Near 0 the queue is saturated and its core can't keep up, near 1 its core is mostly
+			 * idle */
+			double emptyPollRatio;
+			/** Number of packets received, before the software filter is applied */
+			uint64_t packets;
+			/** Number of packets the PMD reported as dropped on this queue (DPDK's rte_eth_stats::q_errors), not all PMDs report it */
+			uint64_t queueDrops;
+			/** Number of bursts whose processing cycles were measured */
+			uint64_t measuredBursts;
+			/** Average TSC cycles spent processing a burst */
+			uint64_t avgBurstCycles;
+			/** Maximum TSC cycles spent processing a burst */
+			uint64_t maxBurstCycles;
+			/** The TSC frequency in Hz, for converting cycles to time */
+			uint64_t tscHz;
+			/** Number of packets returned by polls: bucket 0 counts empty polls, bucket i counts polls which returned 2^(i-1) to
+			 * 2^i-1 packets and the last bucket also counts all larger bursts */
+			uint64_t burstSizeHistogram[PCPP_DPDK_BURST_SIZE_HISTOGRAM_BUCKETS];
+			/** Cycles spent processing bursts: bucket i counts bursts which took 2^i to 2^(i+1)-1 cycles and the last bucket also counts
+			 * all longer bursts */
+			uint64_t burstCyclesHistogram[PCPP_DPDK_BURST_CYCLES_HISTOGRAM_BUCKETS];
+		};
+
 		virtual ~DpdkDevice();
 
 		/**
@@ -388,6 +696,13 @@ namespace pcpp
 		 */
 		inline std::string getPciAddress() { return m_PciAddress; }
 
+		/**
+		 * @return The NUMA node (socket) the device is attached to, or -1 if it's not known. The mbuf mempool, RX/TX queues and TX buffers
+		 * of the device are allocated on this node, and worker threads handling the device should run on its cores (see
+		 * DpdkDeviceList#getNumaLocalWorkerCoreMask())
+		 */
+		int getNumaNode();
+
 		/**
 		 * @return The device's maximum transmission unit (MTU) in bytes
 		 */
@@ -452,7 +767,9 @@ namespace pcpp
 		 * application, please use this method
 		 * @param[out] rawPacketsArr A pointer to an array of MBufRawPacket pointers where all received packets will be written into. The array is expected to
 		 * be allocated by the user and its length should be provided in rawPacketArrLength. Number of packets received will be returned.
-		 * Notice it's the user responsibility to free the array and its content when done using it
+		 * Notice it's the user responsibility to free the array and its content when done using it. Entries which aren't NULL are reused:
+		 * the mbuf they hold is freed and the received one is bound to the same object, so receiving into the same array again and again
+		 * allocates no objects. Only NULL entries get a new MBufRawPacket
 		 * @param[out] rawPacketArrLength The length of MBufRawPacket pointers array
 		 * @param[in] rxQueueId The RX queue to receive packets from
 		 * @return The number of packets received. If an error occurred 0 will be returned and the error will be printed to log
@@ -602,17 +919,118 @@ namespace pcpp
 		bool sendPacket(Packet& packet, uint16_t txQueueId = 0, bool useTxBuffer = false);
 
 		/**
-		 * Overridden method from IPcapDevice. __BPF filters are currently not implemented for DpdkDevice__
-		 * @return Always false with a "Filters aren't supported in DPDK device" error message
+		 * Send a large TCP or UDP packet as segments whose payload is at most a given size. A TCP packet is segmented by the NIC (TSO) when
+		 * the device was opened with #OFFLOAD_TX_TCP_TSO, and also with #OFFLOAD_TX_MULTI_SEGS if the packet doesn't fit in a single mbuf.
+		 * Otherwise the packet is segmented in software by PacketSegmenter directly into mbufs allocated from the device's pool, which are
+		 * sent in bursts. Either way the segments have valid lengths and checksums, and the large packet doesn't need valid checksums
+		 * @param[in] rawPacket The large packet, an unfragmented TCP or UDP packet over IPv4 or IPv6
+		 * @param[in] segmentSize The maximum TCP or UDP payload of a segment, for TCP the MSS
+		 * @param[in] txQueueId An optional parameter which indicates to which TX queue the segments will be sent to. The default is
+		 * TX queue 0
+		 * @return The number of segments sent, or 0 if the packet can't be segmented, the device or TX queue isn't open or no segment
+		 * was sent
+		 */
+		uint16_t sendPacketSegmented(const RawPacket& rawPacket, uint16_t segmentSize, uint16_t txQueueId = 0);
+
+		/**
+		 * Set a filter on the device's RX queues, replacing the current one. When the filter can be translated into flow rules (see
+		 * GeneralFilter#toFlowRules()) it's offloaded to the NIC as rte_flow rules: packets matching the filter are spread over the opened
+		 * RX queues by RSS and the rest are dropped by the NIC. If the filter can't be translated or the PMD rejects the rules, the filter is
+		 * applied in software to every received burst: by a NativeFilterProgram if the filter can be evaluated natively (see
+		 * GeneralFilter#toNativeFilter()), which matches the headers of each packet without libpcap and is cheaper than BPF, and otherwise
+		 * the same way as setFilter(std::string) does. Offloading requires DPDK 18.05 or newer.
+		 * The filter can't be changed while capture threads are running, and it's removed when the device is closed
+		 * @param[in] filter The filter to set
+		 * @return True if the filter was set, false if the device isn't opened, capture threads are running or the filter is invalid
 		 */
 		bool setFilter(GeneralFilter& filter);
 
 		/**
-		 * Overridden method from IPcapDevice. __BPF filters are currently not implemented for DpdkDevice__
-		 * @return Always false with a "Filters aren't supported in DPDK device" error message
+		 * Set a BPF filter on the device's RX queues, replacing the current one. BPF strings aren't translated into flow rules, so the
+		 * filter is applied in software: packets which don't match it are freed right after they're received, before they're handed to the
+		 * user. The filter can't be changed while capture threads are running, and it's removed when the device is closed
+		 * @param[in] filterAsString The filter in Berkeley Packet Filter (BPF) syntax
+		 * @return True if the filter was set, false if the device isn't opened, capture threads are running or the filter is invalid
 		 */
 		bool setFilter(std::string filterAsString);
 
+		/**
+		 * Remove the current filter, destroying its flow rules if it was offloaded
+		 * @return True if the filter was removed or no filter was set, false if capture threads are running
+		 */
+		bool clearFilter();
+
+		/**
+		 * @return True if a filter is currently set
+		 */
+		inline bool isFilterCurrentlySet() const { return !m_FlowRules.empty() || m_SoftwareFilter != NULL || m_NativeFilter.isCompiled(); }
+
+		/**
+		 * @return True if the current filter is applied by the NIC through rte_flow rules, false if it's applied in software or no filter
+		 * is set
+		 */
+		inline bool isFilterOffloaded() const { return !m_FlowRules.empty(); }
+
+		/**
+		 * Sample the packets received on the device's RX queues (see PacketSampler). Sampling is applied to every received burst after the
+		 * filter, and packets which aren't sampled are freed right away. Each opened RX queue has a sampler of its own, so the rate cap is
+		 * divided evenly between them (see PacketSamplerConfiguration#divide()) and assumes RSS spreads the traffic evenly. Flow sampling
+		 * uses the RSS hash of the NIC for packets which have one, unless PacketSamplerConfiguration#useDeviceHash is false. The rate cap
+		 * uses the time each burst is received. Sampling can't be changed while capture threads are running, and it's removed when the
+		 * device is closed
+		 * @param[in] config The sampling stages
+		 * @return True if sampling was set, false if the device isn't opened or capture threads are running
+		 */
+		bool setSampling(const PacketSamplerConfiguration& config);
+
+		/**
+		 * Stop sampling packets, so all packets which pass the filter are received
+		 * @return True if sampling was removed or wasn't set, false if capture threads are running
+		 */
+		bool clearSampling();
+
+		/**
+		 * @return True if packets received by the device are sampled
+		 */
+		inline bool isSamplingSet() const { return m_RxSamplers != NULL; }
+
+		/**
+		 * Get the sampling counters of the device, summed over its RX queues
+		 * @param[out] numOfPackets The number of packets the samplers decided on since sampling was set
+		 * @param[out] numOfSampledPackets The number of packets sampled since sampling was set
+		 */
+		void getSamplingStats(uint64_t& numOfPackets, uint64_t& numOfSampledPackets) const;
+
+		/**
+		 * Add a flow rule to the NIC (see DpdkFlowRule), which steers, drops or marks the matching packets before they reach the RX queues,
+		 * so filtering and classification work is taken off the worker threads. The rule is translated into rte_flow rules (several ones
+		 * for unaligned port ranges, and one for IPv4 and one for IPv6 when it matches an IP protocol without an IP version). If the PMD
+		 * rejects one of them, the ones already created are destroyed and the rule isn't added. Flow rules require DPDK 18.05 or newer, and can't be combined with a filter
+		 * offloaded by setFilter(GeneralFilter&): they can't be added while such a filter is set, and while flow rules exist filters are
+		 * applied in software. Flow rules are removed when the device is closed
+		 * @param[in] rule The rule to add
+		 * @return The ID of the rule, which is used to remove it, or -1 if the device isn't opened, a filter is offloaded, the rule is
+		 * invalid or the PMD doesn't support it. In the error cases an error is printed to log
+		 */
+		int addFlowRule(const DpdkFlowRule& rule);
+
+		/**
+		 * Remove a flow rule from the NIC
+		 * @param[in] ruleId The ID returned by addFlowRule()
+		 * @return True if the rule was removed, false if no rule has this ID
+		 */
+		bool removeFlowRule(int ruleId);
+
+		/**
+		 * Remove all flow rules added by addFlowRule()
+		 */
+		void removeAllFlowRules();
+
+		/**
+		 * @return The number of flow rules added by addFlowRule()
+		 */
+		inline size_t getNumOfFlowRules() const { return m_SteeringRules.size(); }
+
 		/**
 		 * Open the DPDK device. Notice opening the device only makes it ready to use, it doesn't start packet capturing. This method initializes RX and TX queues,
 		 * configures the DPDK port and starts it. Call close() to close the device. The device is opened in promiscuous mode
@@ -621,10 +1039,42 @@ namespace pcpp
 		 * @param[in] config Optional parameter for defining special port configuration parameters such as number of receive/transmit descriptors. If not set the default
 		 * parameters will be set (see DpdkDeviceConfiguration)
 		 * @return True if the device was opened successfully, false if device is already opened, if RX/TX queues configuration failed or of DPDK port
-		 * configuration and startup failed
+		 * configuration and startup failed. A secondary process can't open the device and should use attachQueues() instead
 		 */
 		bool openMultiQueues(uint16_t numOfRxQueuesToOpen, uint16_t numOfTxQueuesToOpen, const DpdkDeviceConfiguration& config = DpdkDeviceConfiguration());
 
+		/**
+		 * Claim RX and TX queues of the device for the current process. In a secondary process (see DpdkDeviceList#initDpdkSecondary())
+		 * this is how the device becomes ready to use: the device must be opened by the primary process, and the first call attaches to
+		 * it. The process should only receive from and send to the queues it claimed, and the capture methods (startCaptureSingleThread(),
+		 * startCaptureMultiThreads()) read from the claimed RX queues. In the primary process the device must be opened, and claiming
+		 * queues keeps secondary processes from claiming them and makes the capture methods read only from them.<BR>
+		 * A queue stays claimed until the claiming process closes the device or exits. The method can be called again to claim more queues
+		 * @param[in] rxQueues The IDs of the RX queues to claim
+		 * @param[in] txQueues The IDs of the TX queues to claim
+		 * @return True if all queues were claimed, false if the device isn't opened, if a queue isn't opened or if a queue is claimed by
+		 * another process. If false is returned none of the queues is claimed
+		 */
+		bool attachQueues(const std::vector<uint16_t>& rxQueues, const std::vector<uint16_t>& txQueues);
+
+		/**
+		 * @param[in] rxQueueId The RX queue ID
+		 * @return The ID of the process which claimed the RX queue using attachQueues(), or 0 if the queue isn't claimed
+		 */
+		int getRxQueueOwner(uint16_t rxQueueId) const;
+
+		/**
+		 * @param[in] txQueueId The TX queue ID
+		 * @return The ID of the process which claimed the TX queue using attachQueues(), or 0 if the queue isn't claimed
+		 */
+		int getTxQueueOwner(uint16_t txQueueId) const;
+
+		/**
+		 * Get the RX queues the current process claimed using attachQueues()
+		 * @param[out] rxQueues A vector which is filled with the IDs of the claimed RX queues
+		 */
+		void getAttachedRxQueues(std::vector<uint16_t>& rxQueues) const;
+
 		/**
 		 * There are two ways to capture packets using DpdkDevice: one of them is using worker threads (see DpdkDeviceList#startDpdkWorkerThreads() ) and
 		 * the other way is setting a callback which is invoked each time a burst of packets is captured. This method implements the second way.
@@ -659,6 +1109,43 @@ namespace pcpp
 		 */
 		bool startCaptureMultiThreads(OnDpdkPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, CoreMask coreMask);
 
+		/**
+		 * Make the capture threads started by startCaptureSingleThread() and startCaptureMultiThreads() use a DpdkAdaptivePoller for
+		 * their RX queue, so they don't spin at 100% CPU while no traffic arrives. The setting applies to the next capture, the
+		 * pollers are created when capturing starts and their statistics are kept until the next capture starts
+		 * @param[in] enabled Whether capture threads poll adaptively
+		 * @param[in] config The thresholds of the idle steps of the pollers
+		 * @return True if the setting was applied, false if the device is capturing (an error is printed to log)
+		 */
+		bool setCaptureAdaptivePolling(bool enabled, const DpdkAdaptivePollingConfig& config = DpdkAdaptivePollingConfig());
+
+		/**
+		 * Get the statistics of the adaptive poller of a capture thread, including its current idle step (see
+		 * setCaptureAdaptivePolling())
+		 * @param[in] rxQueueId The RX queue the capture thread polls
+		 * @param[out] stats The poller statistics
+		 * @return True if the statistics were retrieved, false if capture threads didn't poll the queue adaptively
+		 */
+		bool getCaptureAdaptivePollingStats(uint16_t rxQueueId, DpdkAdaptivePollingStats& stats);
+
+		/**
+		 * Prefetch the packets of each received burst a number of packets ahead, as the DPDK l3fwd example does: while the packets of the
+		 * burst are bound to raw packets, the mbuf of the packet which is twice the distance ahead and the first cache line of the data of
+		 * the packet which is the distance ahead are prefetched, so the mbufs are warm when they're bound and the packet headers are in
+		 * cache when the packets are parsed. Applies to the receivePackets() overloads and to the capture threads, in which the packets
+		 * handed to the callback are prefetched this way (the callback may parse them with PacketBatch, which prefetches as well).
+		 * A distance of 3-4 packets is usually right, larger distances mostly help on slower memory. The setting applies to the next
+		 * capture and to receivePackets() calls made from now on
+		 * @param[in] prefetchDistance The number of packets to prefetch ahead, or 0 to disable prefetching. Default value is 0
+		 * @return True if the setting was applied, false if the device is capturing (an error is printed to log)
+		 */
+		bool setRxPrefetchDistance(uint16_t prefetchDistance);
+
+		/**
+		 * @return The number of packets received packets are prefetched ahead, see setRxPrefetchDistance()
+		 */
+		inline uint16_t getRxPrefetchDistance() const { return m_RxPrefetchDistance; }
+
 		/**
 		 * If device is in capture mode started by invoking startCaptureSingleThread() or startCaptureMultiThreads(), this method
 		 * will stop all capturing threads and set the device to non-capturing mode
@@ -675,6 +1162,17 @@ namespace pcpp
 		 */
 		int getAmountOfMbufsInUse();
 
+		/**
+		 * Get the configuration and usage of device's mbufs pool
+		 * @param[out] info The pool information
+		 */
+		void getMBufPoolInfo(DpdkMBufPoolInfo& info);
+
+		/**
+		 * @return True if device's mbufs pool is shared with the other devices on its NUMA socket (see DpdkMBufPoolConfig#sharedPool)
+		 */
+		inline bool isMBufPoolShared() const { return m_MBufPoolShared; }
+
 		/**
 		 * Retrieve RX/TX statistics from device
 		 * @param[out] stats A reference to a DpdkDeviceStats object where stats will be written into
@@ -686,6 +1184,57 @@ namespace pcpp
 		 */
 		void clearStatistics();
 
+		/**
+		 * Report the device statistics to a MetricsRegistry snapshot: RX and TX packets and bytes, in total and for each opened queue
+		 * (with a "queue" label), and the RX packets dropped by the H/W, erroneous packets and mbuf allocation failures. The statistics are
+		 * read from DPDK directly so the packets/bytes per second values of getStatistics() aren't affected
+		 * @param[in] writer The writer to report the values to
+		 */
+		void collectMetrics(MetricsWriter& writer);
+
+		/**
+		 * Retrieve the extended statistics of the device (DPDK xstats), which are the PMD specific counters in addition to the basic
+		 * ones returned by getStatistics(), such as per-queue and per-error-type counters
+		 * @param[out] xstats A map which is filled with the values of the extended statistics by their names. Its previous content is
+		 * cleared
+		 * @return True if the statistics were retrieved, false otherwise (an error is printed to log)
+		 */
+		bool getExtendedStatistics(std::map<std::string, uint64_t>& xstats);
+
+		/**
+		 * Clear the extended statistics of the device
+		 */
+		void clearExtendedStatistics();
+
+		/**
+		 * Enable or disable collecting burst statistics for the RX queues of the device (see RxBurstStats). When disabled receiving
+		 * packets only checks a flag. When enabled each poll reads the TSC and updates the counters of its queue, which are kept in a
+		 * separate cache line for each queue so the cores polling different queues don't contend. May be called while the queues are
+		 * polled
+		 * @param[in] enabled Whether to collect burst statistics
+		 * @return True if the setting was applied, false if allocating the counters failed (an error is printed to log)
+		 */
+		bool setRxBurstStatsEnabled(bool enabled);
+
+		/**
+		 * @return True if burst statistics are collected for the RX queues of the device, false otherwise
+		 */
+		inline bool isRxBurstStatsEnabled() const { return m_RxBurstStatsEnabled; }
+
+		/**
+		 * Get a snapshot of the burst statistics collected for an RX queue. The snapshot may be taken while the queue is polled, in
+		 * which case the counters may be a few polls apart from each other
+		 * @param[in] rxQueueId The RX queue to get the statistics of
+		 * @param[out] stats The statistics of the queue
+		 * @return True if the snapshot was taken, false if burst statistics were never enabled or rxQueueId is out of range
+		 */
+		bool getRxBurstStats(uint16_t rxQueueId, RxBurstStats& stats);
+
+		/**
+		 * Reset the burst statistics of all RX queues. If the queues are polled at the same time a few updates may be lost
+		 */
+		void clearRxBurstStats();
+
 		/**
 		 * DPDK supports an option to buffer TX packets and send them only when reaching a certain threshold. This method enables
 		 * the user to flush a TX buffer for certain TX queue and send the packets stored in it (you can read about it here:
@@ -721,6 +1270,48 @@ namespace pcpp
 		 */
 		uint64_t getSupportedRssHashFunctions();
 
+		/**
+		 * @return The number of entries of the RSS redirection table (RETA) of the device, which maps the low bits of the RSS hash of a
+		 * packet to the RX queue it's received on. 0 means the device (PMD) doesn't expose its redirection table
+		 */
+		uint16_t getRssRedirectionTableSize();
+
+		/**
+		 * Read the RSS redirection table (RETA) of the device
+		 * @param[out] table A vector which is filled with the RX queue of each entry of the table. Its previous content is cleared
+		 * @return True if the table was read, false if the device isn't opened or the PMD doesn't support reading it (an error is printed to
+		 * log)
+		 */
+		bool getRssRedirectionTable(std::vector<uint16_t>& table);
+
+		/**
+		 * Replace the RSS redirection table (RETA) of the device while it's running. Packets whose RSS hash maps to an entry are received
+		 * on the new queue of the entry from the moment the NIC applies the update, while packets already waiting in the old queue are
+		 * still received there. Only the groups of 64 entries which contain changed entries are written
+		 * @param[in] table The RX queue of each entry. Its size must be getRssRedirectionTableSize() and all queues must be opened RX queues
+		 * @return True if the table was updated, false if the device isn't opened, the table is invalid or the PMD failed to update it (an
+		 * error is printed to log)
+		 */
+		bool setRssRedirectionTable(const std::vector<uint16_t>& table);
+
+		/**
+		 * Check whether a mask of hardware offloads is supported by this device (PMD)
+		 * @param[in] offloads Offloads mask to check. This mask should be built from values in DpdkOffload enum
+		 * @return True if all offloads in this mask are supported, false otherwise
+		 */
+		bool isDeviceSupportOffloads(uint64_t offloads);
+
+		/**
+		 * @return A mask of all hardware offloads supported by this device (PMD). This mask is built from values in DpdkOffload enum.
+		 * Offloads are configured using the DPDK 18.11 API, on older DPDK versions the value is always zero
+		 */
+		uint64_t getSupportedOffloads();
+
+		/**
+		 * @return A mask of the hardware offloads enabled on the device when it was opened, built from values in DpdkOffload enum
+		 */
+		uint64_t getEnabledOffloads() const { return (m_DeviceOpened ? m_Config.offloads : 0); }
+
 
 		//overridden methods
 
@@ -733,7 +1324,9 @@ namespace pcpp
 		bool open() { return openMultiQueues(1, 1); };
 
 		/**
-		 * Close the DpdkDevice. When device is closed it's not possible work with it
+		 * Close the DpdkDevice. When device is closed it's not possible work with it. The queues the process claimed are released. In a
+		 * secondary process the port keeps running for the primary process, and in the primary process the port is stopped, so secondary
+		 * processes should stop using it first
 		 */
 		void close();
 
@@ -749,11 +1342,14 @@ namespace pcpp
 			DpdkCoreConfiguration() : RxQueueId(-1), IsCoreInUse(false) {}
 		};
 
-		DpdkDevice(int port, uint32_t mBufPoolSize);
-		bool initMemPool(struct rte_mempool*& memPool, const char* mempoolName, uint32_t mBufPoolSize);
+		DpdkDevice(int port, const DpdkMBufPoolConfig& mBufPoolConfig, struct rte_mempool* sharedMBufPool);
+		static struct rte_mempool* createMBufPool(const char* mempoolName, const DpdkMBufPoolConfig& mBufPoolConfig, int socketId);
+		static int getMBufPoolSocketId(int port, const DpdkMBufPoolConfig& mBufPoolConfig);
+		static void fillMBufPoolInfo(struct rte_mempool* mempool, DpdkMBufPoolInfo& info);
 
 		bool configurePort(uint8_t numOfRxQueues, uint8_t numOfTxQueues);
 		bool initQueues(uint8_t numOfRxQueuesToInit, uint8_t numOfTxQueuesToInit);
+		bool initTxBuffers(uint16_t numOfTxQueues);
 		bool startDevice();
 
 		static int dpdkCaptureThreadMain(void *ptr);
@@ -764,11 +1360,27 @@ namespace pcpp
 
 		void setDeviceInfo();
 
+		struct SharedPortState;
+		static bool initSharedPortStates(bool create);
+		static struct rte_mempool* lookupMBufPool(int port);
+		void publishPortState();
+		void releaseQueues();
+		void getCaptureRxQueues(std::vector<uint16_t>& rxQueues) const;
+
 		typedef rte_mbuf* (*PacketIterator)(void* packetStorage, int index);
 		uint16_t sendPacketsInner(uint16_t txQueueId, void* packetStorage, PacketIterator iter, int arrLength, bool useTxBuffer);
 
 		uint64_t convertRssHfToDpdkRssHf(uint64_t rssHF);
 		uint64_t convertDpdkRssHfToRssHf(uint64_t dpdkRssHF);
+		void convertOffloadsToDpdkOffloads(uint64_t offloads, uint64_t& dpdkRxOffloads, uint64_t& dpdkTxOffloads);
+		uint64_t convertDpdkOffloadsToOffloads(uint64_t dpdkRxOffloads, uint64_t dpdkTxOffloads);
+
+		bool createFlowRules(const std::vector<FilterFlowRule>& rules);
+		void destroyFlowRules();
+		uint16_t receiveBurst(uint16_t rxQueueId, struct rte_mbuf** mBufArray, uint16_t arrLength);
+		void updateRxBurstStats(uint16_t rxQueueId, uint16_t numOfPackets);
+		void createCapturePollers();
+		void deleteCapturePollers();
 
 		char m_DeviceName[30];
 		DpdkPMDType m_PMDType;
@@ -781,6 +1393,7 @@ namespace pcpp
 		MacAddress m_MacAddress;
 		uint16_t m_DeviceMtu;
 		struct rte_mempool* m_MBufMempool;
+		bool m_MBufPoolShared;
 		struct rte_eth_dev_tx_buffer** m_TxBuffers;
 		uint64_t m_TxBufferDrainTsc;
 		uint64_t* m_TxBufferLastDrainTsc;
@@ -798,7 +1411,31 @@ namespace pcpp
 		 // RSS key used by the NIC for load balancing the packets between cores
 		static uint8_t m_RSSKey[40];
 
+		// the state of all ports shared with the secondary processes, in a memzone allocated by the primary process
+		static SharedPortState* m_SharedPortStates;
+
 		DpdkDeviceStats m_PrevStats;
+
+		std::vector<struct rte_flow*> m_FlowRules;
+		bpf_program* m_SoftwareFilter;
+		NativeFilterProgram m_NativeFilter;
+		// the samplers of the RX queues, allocated while sampling is set
+		PacketSampler* m_RxSamplers;
+		// the rte_flow rules created for each rule added by addFlowRule(), by rule ID
+		std::map<int, std::vector<struct rte_flow*> > m_SteeringRules;
+		int m_NextSteeringRuleId;
+
+		// the burst statistics counters of each RX queue, allocated when burst statistics are enabled for the first time
+		struct RxBurstCounters;
+		RxBurstCounters* m_RxBurstCounters;
+		volatile bool m_RxBurstStatsEnabled;
+
+		bool m_CaptureAdaptivePolling;
+		DpdkAdaptivePollingConfig m_CaptureAdaptivePollingConfig;
+		// the adaptive pollers of the capture threads by RX queue, created when capturing starts
+		DpdkAdaptivePoller* m_CapturePollers[DPDK_MAX_RX_QUEUES];
+
+		uint16_t m_RxPrefetchDistance;
 	};
 
 } // namespace pcpp
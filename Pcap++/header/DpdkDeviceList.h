@@ -3,6 +3,7 @@
 
 #include "SystemUtils.h"
 #include "DpdkDevice.h"
+#include "HardwareCounters.h"
 #include "Logger.h"
 #include <vector>
 
@@ -67,6 +68,11 @@ namespace pcpp
 	 *      its startup process 
 	 *    - it contains the list of DpdkDevice instances and enables access to them
 	 *    - it has methods to start and stop worker threads. See more details in startDpdkWorkerThreads() 
+	 *
+	 * DPDK applications can run as several processes sharing the same ports and packet memory: a primary process which initializes
+	 * DPDK with initDpdk() and opens the devices, and secondary processes which initialize DPDK with initDpdkSecondary(). A secondary
+	 * process attaches to the mbuf pools of the primary and claims RX/TX queues of the opened devices using
+	 * DpdkDevice#attachQueues(), so packets are received, passed between processes (see DpdkPacketRing) and sent without being copied
 	 */
 	class DpdkDeviceList
 	{
@@ -74,16 +80,20 @@ namespace pcpp
 	private:
 		bool m_IsInitialized;
 		static bool m_IsDpdkInitialized;
-		static uint32_t m_MBufPoolSizePerDevice;
+		static bool m_IsSecondaryProcess;
+		static DpdkMBufPoolConfig m_MBufPoolConfig;
 		static CoreMask m_CoreMask;
 		std::vector<DpdkDevice*> m_DpdkDeviceList;
 		std::vector<DpdkWorkerThread*> m_WorkerThreads;
+		bool m_WorkerHwCountersEnabled;
+		HardwareCounters* m_WorkerHwCounters[MAX_NUM_OF_CORES];
 
 		DpdkDeviceList();
 
 		inline bool isInitialized() { return (m_IsInitialized && m_IsDpdkInitialized); }
-		bool initDpdkDevices(uint32_t mBufPoolSizePerDevice);
+		bool initDpdkDevices(const DpdkMBufPoolConfig& mBufPoolConfig);
 		static bool verifyHugePagesAndDpdkDriver();
+		static bool initEal(CoreMask coreMask, uint8_t masterCore, bool secondaryProcess);
 
 		static int dpdkWorkerThreadStart(void *ptr);
 	public:
@@ -99,7 +109,7 @@ namespace pcpp
 		{
 			static DpdkDeviceList instance;
 			if (!instance.isInitialized())
-				instance.initDpdkDevices(DpdkDeviceList::m_MBufPoolSizePerDevice);
+				instance.initDpdkDevices(DpdkDeviceList::m_MBufPoolConfig);
 
 			return instance;
 		}
@@ -126,6 +136,48 @@ namespace pcpp
 		 */
 		static bool initDpdk(CoreMask coreMask, uint32_t mBufPoolSizePerDevice, uint8_t masterCore = 0);
 
+		/**
+		 * Same as initDpdk(CoreMask, uint32_t, uint8_t), but with full control over the mbuf pools of the devices: the per-core cache
+		 * size, the mbuf data room size, the NUMA socket, sharing a pool between the devices of a NUMA socket and allocating the pools
+		 * from an external heap. See DpdkMBufPoolConfig for details
+		 * @param[in] coreMask The cores to initialize DPDK with
+		 * @param[in] mBufPoolConfig The configuration of the mbuf pools
+		 * @param[in] masterCore The core DPDK will use as master to control all worker thread. The default, unless set otherwise, is 0
+		 * @return True if initialization succeeded or false if huge-pages or DPDK kernel driver are not loaded, if the pool
+		 * configuration is invalid, if DPDK infra initialization failed or if DpdkDevice initialization failed
+		 */
+		static bool initDpdk(CoreMask coreMask, const DpdkMBufPoolConfig& mBufPoolConfig, uint8_t masterCore = 0);
+
+		/**
+		 * Initialize DPDK as a secondary process of an already running primary process, which initialized DPDK with initDpdk().
+		 * Instead of creating mbuf pools, the DpdkDevice instances use the pools the primary process created for them. The devices
+		 * aren't opened or configured by a secondary process: once the primary process opened a device, the secondary process claims
+		 * some of its RX/TX queues with DpdkDevice#attachQueues(). Notice the cores in the core mask must not be used by the primary
+		 * process or by other secondary processes
+		 * @param[in] coreMask The cores to initialize DPDK with
+		 * @param[in] masterCore The core DPDK will use as master to control all worker thread. The default, unless set otherwise, is 0
+		 * @return True if initialization succeeded or false if huge-pages or DPDK kernel driver are not loaded, if there is no
+		 * primary process to attach to or if the mbuf pools of the primary process can't be found
+		 */
+		static bool initDpdkSecondary(CoreMask coreMask, uint8_t masterCore = 0);
+
+		/**
+		 * @return True if DPDK was initialized as a secondary process (see initDpdkSecondary()), false otherwise
+		 */
+		static inline bool isSecondaryProcess() { return m_IsSecondaryProcess; }
+
+		/**
+		 * @return The configuration of the mbuf pools DPDK was initialized with. In a secondary process the pools are configured by the
+		 * primary process, see getMBufPoolsInfo() for their actual configuration
+		 */
+		static inline const DpdkMBufPoolConfig& getMBufPoolConfig() { return m_MBufPoolConfig; }
+
+		/**
+		 * Get the configuration and usage of all mbuf pools of the devices. A pool shared by several devices appears once
+		 * @param[out] poolsInfo A vector which is filled with the information of each pool
+		 */
+		void getMBufPoolsInfo(std::vector<DpdkMBufPoolInfo>& poolsInfo);
+
 		/**
 		 * Get a DpdkDevice by port ID
 		 * @param[in] portId The port ID
@@ -189,11 +241,52 @@ namespace pcpp
 		 */
 		bool startDpdkWorkerThreads(CoreMask coreMask, std::vector<DpdkWorkerThread*>& workerThreadsVec);
 
+		/**
+		 * Same as startDpdkWorkerThreads(CoreMask, std::vector<DpdkWorkerThread*>&), but the cores are selected automatically to be
+		 * local to the NUMA node of a device (see getNumaLocalWorkerCoreMask()), so the workers don't access the device's mbufs across
+		 * sockets. Use DpdkWorkerThread#getCoreId() to find out which core each worker runs on
+		 * @param[in] device The device the workers handle
+		 * @param[in] workerThreadsVec A vector of worker instances to run. One core is selected for each worker
+		 * @return True if all worker threads started successfully or false if DPDK isn't initialized, there aren't enough cores
+		 * initialized by DPDK (other than the master core) or if one of the worker threads couldn't be run
+		 */
+		bool startDpdkWorkerThreadsOnDeviceSocket(DpdkDevice* device, std::vector<DpdkWorkerThread*>& workerThreadsVec);
+
+		/**
+		 * Select cores for worker threads out of the cores initialized by DPDK (not including the master core), preferring cores of
+		 * a NUMA node and one core per physical core over SMT (hyperthread) siblings. See selectNumaLocalCores() for the exact order
+		 * @param[in] numaNode The NUMA node to prefer, usually DpdkDevice#getNumaNode() of the device the workers handle. If it's -1
+		 * there's no node preference
+		 * @param[in] numOfCores The number of cores to select
+		 * @return A core mask of the selected cores, which contains less than numOfCores cores if there aren't enough cores
+		 */
+		CoreMask getNumaLocalWorkerCoreMask(int numaNode, int numOfCores);
+
 		/**
 		 * Assuming worker threads are running, this method orders them to stop by calling DpdkWorkerThread#stop(). Then it waits until
 		 * they stop running
 		 */
 		void stopDpdkWorkerThreads();
+
+		/**
+		 * Count CPU hardware events (cycles, instructions, cache misses and branch misses, see HardwareCounters) of the worker threads
+		 * started from now on. The counters of each worker are opened on its core right before DpdkWorkerThread#run() is called and
+		 * stopped when it returns, so they cover the worker's whole loop. Dividing them by the number of packets the worker handled
+		 * gives the cost per packet
+		 * @param[in] enabled Whether to count hardware events
+		 */
+		inline void setWorkerHardwareCountersEnabled(bool enabled) { m_WorkerHwCountersEnabled = enabled; }
+
+		/**
+		 * Read the hardware counters of a worker thread started while hardware counters were enabled (see
+		 * setWorkerHardwareCountersEnabled()). They can be read while the worker is running, for example for periodic statistics, and
+		 * keep their values after it stopped until a new worker is started on the same core
+		 * @param[in] coreId The core the worker runs on
+		 * @param[out] result The values counted so far. No counter is available if the hardware counters couldn't be opened on the
+		 * worker's core
+		 * @return False if no worker with hardware counters was started on this core, true otherwise
+		 */
+		bool getWorkerHardwareCounters(uint32_t coreId, HardwareCounterValues& result) const;
 	};
 
 } // namespace pcpp
@@ -0,0 +1,235 @@
+#ifndef PCAPPP_DPDK_EVENT_SCHEDULER
+#define PCAPPP_DPDK_EVENT_SCHEDULER
+
+#include "DpdkDevice.h"
+#include "DpdkDeviceList.h"
+#include <vector>
+
+/**
+ * @file
+ * Flow-atomic load balancing of DPDK packet processing over a pool of worker cores, using DPDK's event device (eventdev) library.
+ * For details about PcapPlusPlus support for DPDK see DpdkDevice.h file description
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+/**
+ * The maximum number of packets an RX core or a worker core of DpdkEventScheduler handles at once
+ */
+#define PCPP_DPDK_EVENT_SCHEDULER_BURST_SIZE 32
+
+	class DpdkEventScheduler;
+
+	/**
+	 * A callback invoked by DpdkEventScheduler on a worker core with a burst of packets. All packets of a flow are delivered to one
+	 * worker at a time and in the order they were received. The packets are valid only until the callback returns: they're freed after
+	 * it, unless they were sent with DpdkDevice#sendPackets()
+	 * @param[in] packets The packets. Their timestamp is the time they were taken from the event device
+	 * @param[in] numOfPackets The number of packets
+	 * @param[in] workerId The ID of the worker, from 0 to the number of worker cores minus 1 in ascending core order. It can be used to
+	 * pick a TX queue or per-worker state
+	 * @param[in] userCookie The cookie given to DpdkEventScheduler#start()
+	 */
+	typedef void (*OnDpdkEventPacketsCallback)(MBufRawPacket* packets, uint32_t numOfPackets, uint8_t workerId, void* userCookie);
+
+	/**
+	 * @struct DpdkEventSchedulerStats
+	 * The statistics of a DpdkEventScheduler, summed over its cores
+	 */
+	struct DpdkEventSchedulerStats
+	{
+		/** Number of packets read from the RX queues */
+		uint64_t rxPackets;
+		/** Number of packets which were dropped because the event device was full */
+		uint64_t rxDrops;
+		/** Number of packets delivered to the worker callback */
+		uint64_t workerPackets;
+		/** Number of bursts delivered to the worker callback */
+		uint64_t workerBursts;
+	};
+
+	/**
+	 * @class DpdkEventRxThread
+	 * The RX core of a DpdkEventScheduler, which reads packets from RX queues and injects them into the event device. It's created by
+	 * DpdkEventScheduler#start() and shouldn't be used directly
+	 */
+	class DpdkEventRxThread : public DpdkWorkerThread
+	{
+		friend class DpdkEventScheduler;
+	public:
+		bool run(uint32_t coreId);
+		void stop();
+		uint32_t getCoreId() { return m_CoreId; }
+
+	private:
+		struct RxQueue
+		{
+			DpdkDevice* device;
+			uint16_t rxQueueId;
+		};
+
+		DpdkEventScheduler* m_Scheduler;
+		uint8_t m_PortId;
+		std::vector<RxQueue> m_RxQueues;
+		uint32_t m_CoreId;
+		volatile bool m_Stop;
+		uint64_t m_RxPackets;
+		uint64_t m_RxDrops;
+
+		DpdkEventRxThread(DpdkEventScheduler* scheduler, uint8_t portId);
+		uint32_t getFlowId(struct rte_mbuf* mBuf) const;
+	};
+
+	/**
+	 * @class DpdkEventWorkerThread
+	 * A worker core of a DpdkEventScheduler, which takes packets from the event device and passes them to the worker callback. It's
+	 * created by DpdkEventScheduler#start() and shouldn't be used directly
+	 */
+	class DpdkEventWorkerThread : public DpdkWorkerThread
+	{
+		friend class DpdkEventScheduler;
+	public:
+		bool run(uint32_t coreId);
+		void stop();
+		uint32_t getCoreId() { return m_CoreId; }
+
+	private:
+		DpdkEventScheduler* m_Scheduler;
+		uint8_t m_PortId;
+		uint8_t m_WorkerId;
+		uint32_t m_CoreId;
+		volatile bool m_Stop;
+		uint64_t m_Packets;
+		uint64_t m_Bursts;
+
+		DpdkEventWorkerThread(DpdkEventScheduler* scheduler, uint8_t portId, uint8_t workerId);
+	};
+
+	/**
+	 * @class DpdkEventScheduler
+	 * An alternative to spreading packets over worker cores with RSS (see DpdkDeviceConfiguration#rssHashFunction): RSS assigns each flow
+	 * to a fixed RX queue, so a few heavy flows can overload their cores while others stay idle. Here RX cores read the RX queues and inject
+	 * the packets into an event device as events of a flow-atomic queue, and the event device hands the flows out to the worker cores
+	 * dynamically: a flow is processed by one worker at a time, in order, but it may move to another worker when it has no packets in
+	 * flight, so the load is balanced per burst rather than per flow.<BR>
+	 * The flow of a packet is a symmetric hash of its 5-tuple (see FlowHash#hashSymmetric()), so both directions of a connection are one
+	 * flow, or optionally the RSS hash computed by the NIC. Packets without an IPv4 or IPv6 header are all one flow.<BR>
+	 * The workers get the packets through a callback with the same arguments as a capture callback (see DpdkDevice#startCaptureMultiThreads()).
+	 * A worker which sends packets should use its own TX queue, for example the one matching its worker ID.<BR>
+	 * The event device must be available to DPDK, for example a hardware event device or the software one created with the
+	 * "--vdev=event_sw0" EAL argument (see DpdkDeviceList#initDpdk()). A software event device needs a core to run its scheduling service:
+	 * the RX cores run it between bursts, so no service core has to be configured. Event devices require DPDK 18.11 or later
+	 */
+	class DpdkEventScheduler
+	{
+		friend class DpdkEventRxThread;
+		friend class DpdkEventWorkerThread;
+	public:
+
+		/**
+		 * A c'tor for this class. The event device is configured by start()
+		 * @param[in] eventDevId The ID of the event device. The default value (0) is the first one
+		 * @param[in] useNicRssHash Use the RSS hash computed by the NIC as the flow of a packet instead of hashing its headers in software.
+		 * It's cheaper, but it's usually not symmetric and it's only set when RSS is enabled on the device. Packets without one are hashed
+		 * in software. Default value is false
+		 */
+		DpdkEventScheduler(uint8_t eventDevId = 0, bool useNicRssHash = false);
+
+		/**
+		 * A d'tor for this class, stops the scheduler if it's running
+		 */
+		~DpdkEventScheduler();
+
+		/**
+		 * Add an RX queue the RX cores read packets from. The queues are divided between the RX cores in the order they were added. The
+		 * device must be opened with this queue, and it shouldn't be read by anything else while the scheduler is running
+		 * @param[in] device The device
+		 * @param[in] rxQueueId The RX queue
+		 * @return True if the queue was added, false if the scheduler is running, the device is NULL or the queue doesn't exist
+		 */
+		bool addRxQueue(DpdkDevice* device, uint16_t rxQueueId);
+
+		/**
+		 * Add all RX queues a device was opened with (see addRxQueue())
+		 * @param[in] device The device
+		 * @return True if the queues were added, false otherwise
+		 */
+		bool addDevice(DpdkDevice* device);
+
+		/**
+		 * Configure the event device and start the RX and worker cores. The cores are started with
+		 * DpdkDeviceList#startDpdkWorkerThreads(), so no other worker threads can be started while the scheduler is running
+		 * @param[in] rxCoreMask The cores which read the RX queues. There mustn't be more RX cores than RX queues
+		 * @param[in] workerCoreMask The cores which run the callback. The masks mustn't overlap and mustn't contain the master core
+		 * @param[in] onPacketsArrive The worker callback
+		 * @param[in] userCookie A pointer passed to the callback
+		 * @return True if the scheduler started, false if it's already running, no RX queues were added, the masks are invalid or the event
+		 * device couldn't be configured or doesn't support the number of cores
+		 */
+		bool start(CoreMask rxCoreMask, CoreMask workerCoreMask, OnDpdkEventPacketsCallback onPacketsArrive, void* userCookie);
+
+		/**
+		 * Stop the RX and worker cores and the event device. The packets still in the event device are freed
+		 */
+		void stop();
+
+		/**
+		 * @return True if the scheduler is running, false otherwise
+		 */
+		inline bool isRunning() const { return m_Running; }
+
+		/**
+		 * @return The ID of the event device
+		 */
+		inline uint8_t getEventDevId() const { return m_EventDevId; }
+
+		/**
+		 * @return The number of worker cores of the last start() call
+		 */
+		inline size_t getNumOfWorkers() const { return m_WorkerThreads.size(); }
+
+		/**
+		 * Get the statistics. They're updated by the cores without locking, so while the scheduler is running they may be a little behind
+		 * @param[out] stats The statistics
+		 */
+		void getStats(DpdkEventSchedulerStats& stats) const;
+
+		/**
+		 * Get the number of packets delivered to a worker, for example to see how the load is balanced
+		 * @param[in] workerId The ID of the worker
+		 * @return The number of packets, or 0 if there's no such worker
+		 */
+		uint64_t getWorkerPackets(uint8_t workerId) const;
+
+	private:
+		// marks the event device as having no scheduling service to run
+		static const uint32_t NoServiceId = 0xffffffff;
+
+		uint8_t m_EventDevId;
+		bool m_UseNicRssHash;
+		bool m_Running;
+		bool m_EventDevStarted;
+		uint32_t m_ServiceId;
+		OnDpdkEventPacketsCallback m_OnPacketsArrive;
+		void* m_UserCookie;
+		std::vector<DpdkEventRxThread::RxQueue> m_RxQueues;
+		std::vector<DpdkEventRxThread*> m_RxThreads;
+		std::vector<DpdkEventWorkerThread*> m_WorkerThreads;
+
+		bool configureEventDev(uint8_t numOfRxPorts, uint8_t numOfWorkerPorts);
+		void stopEventDev();
+		void deleteThreads();
+
+		// disable copy c'tor and assignment operator
+		DpdkEventScheduler(const DpdkEventScheduler& other);
+		DpdkEventScheduler& operator=(const DpdkEventScheduler& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DPDK_EVENT_SCHEDULER */
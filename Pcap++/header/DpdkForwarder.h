@@ -0,0 +1,198 @@
+#ifndef PCAPPP_DPDK_FORWARDER
+#define PCAPPP_DPDK_FORWARDER
+
+#include "MBufRawPacket.h"
+#include <stdint.h>
+
+/**
+ * @file
+ * A zero-copy forwarding path between DPDK and KNI devices. DpdkForwarder moves the mbufs received on a queue of one device to a TX
+ * queue of another, optionally rewriting their headers in place, without creating MBufRawPacket or Packet objects for them.
+ * For details about PcapPlusPlus support for DPDK see DpdkDevice.h file description
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+/**
+ * The maximum number of packets DpdkForwarder receives and sends in one burst
+ */
+#define PCPP_DPDK_FORWARDER_BURST_SIZE 64
+
+	class DpdkDevice;
+	class KniDevice;
+
+	/**
+	 * @typedef OnDpdkForwardPacketCallback
+	 * A callback DpdkForwarder calls for each forwarded packet, after the built-in rewrites, to inspect or rewrite it
+	 * @param[in] packet The packet, bound to its mbuf. The data may be changed in place, and bytes may be inserted to or removed from the
+	 * beginning of a packet with MBufRawPacket#insertData() and MBufRawPacket#removeData(), which use the mbuf headroom. The object is
+	 * reused for the next packet, so it mustn't be kept after the callback returns. The packet timestamp isn't set
+	 * @param[in] userCookie A pointer to the object given by the user in DpdkForwarder#setForwardCallback()
+	 * @return True to send the packet, false to drop it
+	 */
+	typedef bool (*OnDpdkForwardPacketCallback)(MBufRawPacket& packet, void* userCookie);
+
+	/**
+	 * Built-in rewrites DpdkForwarder can apply to each packet. The values are flags and may be combined. When several are set they're
+	 * applied in the order they appear here
+	 */
+	enum DpdkForwardRewrite
+	{
+		/** No rewrite */
+		DpdkForwardRewriteNone = 0,
+		/** Remove the outermost VLAN tag (TPID 0x8100 or 0x88a8) if the packet has one */
+		DpdkForwardRewritePopVlan = 0x1,
+		/** Add a VLAN tag (TPID 0x8100) with the TCI given in DpdkForwarder#setRewrite() */
+		DpdkForwardRewritePushVlan = 0x2,
+		/** Swap the source and destination MAC addresses */
+		DpdkForwardRewriteSwapMac = 0x4
+	};
+
+	/**
+	 * @struct DpdkForwarderStats
+	 * The statistics of DpdkForwarder
+	 */
+	struct DpdkForwarderStats
+	{
+		/** Number of packets received */
+		uint64_t rxPackets;
+		/** Number of packets sent */
+		uint64_t txPackets;
+		/** Number of packets dropped by the forward callback */
+		uint64_t callbackDrops;
+		/** Number of packets dropped because a rewrite couldn't be applied, for example when there was no headroom for a VLAN tag */
+		uint64_t rewriteDrops;
+		/** Number of packets dropped because the TX queue was full */
+		uint64_t txDrops;
+	};
+
+	/**
+	 * @class DpdkForwarder
+	 * Forwards packets from an RX queue of a DpdkDevice or KniDevice to a TX queue of another (or the same) DpdkDevice or KniDevice. Each
+	 * call to forwardBurst() receives a burst of mbufs, applies the built-in rewrites set with setRewrite() and the callback set with
+	 * setForwardCallback() to each of them in place, and sends them. The mbufs move from the RX queue to the TX queue as they are: no
+	 * MBufRawPacket or Packet objects are created and no data is copied, and packets the TX queue has no room for are freed rather than
+	 * retried, like the DPDK l2fwd sample application does. A typical DpdkWorkerThread loop looks like this:
+	 *
+	 * @code
+	 * DpdkForwarder forwarder(rxDevice, rxQueueId, txDevice, txQueueId);
+	 * forwarder.setRewrite(DpdkForwardRewriteSwapMac);
+	 * while (!m_Stop)
+	 *     forwarder.forwardBurst();
+	 * @endcode
+	 *
+	 * A forwarder must be used by one thread only. The RX queue mustn't be read in other ways while the forwarder is used (for example by
+	 * the capture threads of the device), and the TX queue mustn't be written by other threads
+	 */
+	class DpdkForwarder
+	{
+	public:
+
+		/**
+		 * A c'tor for forwarding between two DPDK devices
+		 * @param[in] rxDevice The device to receive packets from
+		 * @param[in] rxQueueId The RX queue to receive packets from
+		 * @param[in] txDevice The device to send packets to. May be the same as rxDevice
+		 * @param[in] txQueueId The TX queue to send packets to
+		 */
+		DpdkForwarder(DpdkDevice* rxDevice, uint16_t rxQueueId, DpdkDevice* txDevice, uint16_t txQueueId);
+
+		/**
+		 * A c'tor for forwarding from a DPDK device to a KNI device
+		 * @param[in] rxDevice The device to receive packets from
+		 * @param[in] rxQueueId The RX queue to receive packets from
+		 * @param[in] txDevice The KNI device to send packets to
+		 */
+		DpdkForwarder(DpdkDevice* rxDevice, uint16_t rxQueueId, KniDevice* txDevice);
+
+		/**
+		 * A c'tor for forwarding from a KNI device to a DPDK device
+		 * @param[in] rxDevice The KNI device to receive packets from
+		 * @param[in] txDevice The device to send packets to
+		 * @param[in] txQueueId The TX queue to send packets to
+		 */
+		DpdkForwarder(KniDevice* rxDevice, DpdkDevice* txDevice, uint16_t txQueueId);
+
+		/**
+		 * A c'tor for forwarding between two KNI devices
+		 * @param[in] rxDevice The KNI device to receive packets from
+		 * @param[in] txDevice The KNI device to send packets to
+		 */
+		DpdkForwarder(KniDevice* rxDevice, KniDevice* txDevice);
+
+		/**
+		 * Set the built-in rewrites applied to each packet
+		 * @param[in] rewriteFlags A combination of DpdkForwardRewrite values
+		 * @param[in] vlanTci The TCI (priority, DEI and VLAN ID) of the tag added by DpdkForwardRewritePushVlan. Default value is 0
+		 */
+		void setRewrite(uint32_t rewriteFlags, uint16_t vlanTci = 0);
+
+		/**
+		 * @return The built-in rewrites applied to each packet, a combination of DpdkForwardRewrite values
+		 */
+		inline uint32_t getRewrite() const { return m_RewriteFlags; }
+
+		/**
+		 * Set a callback which is called for each packet after the built-in rewrites. Packets are bound to an MBufRawPacket only while a
+		 * callback is set
+		 * @param[in] onForwardPacket The callback, or NULL to remove the current one
+		 * @param[in] onForwardPacketUserCookie A pointer to a user provided object, which is passed to the callback
+		 */
+		void setForwardCallback(OnDpdkForwardPacketCallback onForwardPacket, void* onForwardPacketUserCookie = NULL);
+
+		/**
+		 * Receive one burst of up to #PCPP_DPDK_FORWARDER_BURST_SIZE packets, rewrite them and send them
+		 * @return The number of packets received, which may be passed to DpdkAdaptivePoller#onPoll(). 0 is also returned if a device isn't
+		 * opened, a queue doesn't exist or a DpdkDevice is capturing, in which case an error is printed to log
+		 */
+		uint16_t forwardBurst();
+
+		/**
+		 * Get the forwarder statistics
+		 * @param[out] stats The statistics
+		 */
+		inline void getStats(DpdkForwarderStats& stats) const { stats = m_Stats; }
+
+		/**
+		 * Reset the forwarder statistics
+		 */
+		void clearStats();
+
+	private:
+
+		DpdkDevice* m_RxDpdkDevice;
+		KniDevice* m_RxKniDevice;
+		uint16_t m_RxQueueId;
+		DpdkDevice* m_TxDpdkDevice;
+		KniDevice* m_TxKniDevice;
+		uint16_t m_TxQueueId;
+		uint32_t m_RewriteFlags;
+		uint16_t m_VlanTci;
+		OnDpdkForwardPacketCallback m_OnForwardPacket;
+		void* m_OnForwardPacketUserCookie;
+		// the object packets are bound to while the callback is called
+		MBufRawPacket m_CallbackPacket;
+		DpdkForwarderStats m_Stats;
+		struct rte_mbuf* m_MBufArray[PCPP_DPDK_FORWARDER_BURST_SIZE];
+
+		void init(DpdkDevice* rxDpdkDevice, KniDevice* rxKniDevice, uint16_t rxQueueId, DpdkDevice* txDpdkDevice, KniDevice* txKniDevice,
+				uint16_t txQueueId);
+		bool verifyDevices();
+		uint16_t receive();
+		uint16_t send(uint16_t numOfPackets);
+		bool rewrite(struct rte_mbuf* mBuf);
+		bool callForwardCallback(struct rte_mbuf* mBuf);
+
+		// disable copy c'tor and assignment operator
+		DpdkForwarder(const DpdkForwarder& other);
+		DpdkForwarder& operator=(const DpdkForwarder& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DPDK_FORWARDER */
@@ -0,0 +1,129 @@
+#ifndef PCAPPP_DPDK_L2_SWITCH
+#define PCAPPP_DPDK_L2_SWITCH
+
+#include "MacLearningTable.h"
+#include <vector>
+#include <stdint.h>
+
+/**
+ * @file
+ * A zero-copy MAC-learning bridge between DPDK devices. DpdkL2Switch receives bursts of mbufs from a port, makes the forwarding decision
+ * of each frame with a MacLearningTable shared by all worker threads, and sends the mbufs to the ports they should go to without creating
+ * MBufRawPacket or Packet objects for them. For details about PcapPlusPlus support for DPDK see DpdkDevice.h file description
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+/**
+ * The maximum number of packets DpdkL2Switch receives in one burst
+ */
+#define PCPP_DPDK_L2_SWITCH_BURST_SIZE 64
+
+	class DpdkDevice;
+
+	/**
+	 * @struct DpdkL2SwitchStats
+	 * The statistics of DpdkL2Switch
+	 */
+	struct DpdkL2SwitchStats
+	{
+		/** Number of packets received */
+		uint64_t rxPackets;
+		/** Number of packets sent to the single port their destination was learned on */
+		uint64_t unicastPackets;
+		/** Number of packets sent to all ports except the one they were received on (broadcast, multicast and unknown destinations) */
+		uint64_t floodedPackets;
+		/** Number of packets dropped by the forwarding decision, see MacLearningTable#DropPort */
+		uint64_t filteredPackets;
+		/** Number of packets sent. A flooded packet is counted once for every port it was sent to */
+		uint64_t txPackets;
+		/** Number of packets dropped because a TX queue was full. A flooded packet is counted once for every port it wasn't sent to */
+		uint64_t txDrops;
+	};
+
+	/**
+	 * @class DpdkL2Switch
+	 * A transparent L2 bridge between the ports given in the c'tor, where the port numbers of the MacLearningTable are the indices of
+	 * the devices in the port vector. Each call to switchBurst() receives a burst of mbufs from an RX queue of one port, learns their source
+	 * addresses and looks up their destinations in the table (one bucket prefetch per frame for the whole burst), then sends each mbuf to
+	 * the port its destination was learned on. Frames which are flooded are sent to all other ports by incrementing the reference count of
+	 * their mbufs rather than copying them, and frames the TX queues have no room for are freed rather than retried.<BR>
+	 * Several workers, for example one per port, each own a DpdkL2Switch and share one MacLearningTable. Every worker sends on its own TX
+	 * queue of each port, so the devices should be opened with a TX queue per worker (see DpdkDevice#openMultiQueues()):
+	 *
+	 * @code
+	 * // worker i, running on its own core
+	 * DpdkL2Switch l2Switch(&table, ports, i);
+	 * while (!m_Stop)
+	 *     l2Switch.switchBurst(i, 0);
+	 * @endcode
+	 *
+	 * Entries which aged out should be removed by another thread calling MacLearningTable#age() regularly. A DpdkL2Switch must be used by
+	 * one thread only, the RX queues it receives from mustn't be read in other ways while it's used, and its TX queue mustn't be written
+	 * by other threads
+	 */
+	class DpdkL2Switch
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] table The forwarding database, usually shared with the other workers of the switch. It isn't owned by the switch
+		 * @param[in] ports The devices of the switch. The index of a device is its port number in the table
+		 * @param[in] txQueueId The TX queue of each device this switch sends packets on
+		 */
+		DpdkL2Switch(MacLearningTable* table, const std::vector<DpdkDevice*>& ports, uint16_t txQueueId);
+
+		/**
+		 * Receive one burst of up to #PCPP_DPDK_L2_SWITCH_BURST_SIZE packets from a port and send them to the ports they should go to
+		 * @param[in] inPort The index of the port to receive packets from
+		 * @param[in] rxQueueId The RX queue to receive packets from
+		 * @return The number of packets received, which may be passed to DpdkAdaptivePoller#onPoll(). 0 is also returned if a device isn't
+		 * opened, a queue doesn't exist or the input port is capturing, in which case an error is printed to log
+		 */
+		uint16_t switchBurst(uint16_t inPort, uint16_t rxQueueId);
+
+		/**
+		 * @return The number of ports of the switch
+		 */
+		inline uint16_t getNumOfPorts() const { return (uint16_t)m_Ports.size(); }
+
+		/**
+		 * Get the switch statistics
+		 * @param[out] stats The statistics
+		 */
+		inline void getStats(DpdkL2SwitchStats& stats) const { stats = m_Stats; }
+
+		/**
+		 * Reset the switch statistics
+		 */
+		void clearStats();
+
+	private:
+
+		MacLearningTable* m_Table;
+		std::vector<DpdkDevice*> m_Ports;
+		uint16_t m_TxQueueId;
+		DpdkL2SwitchStats m_Stats;
+		struct rte_mbuf* m_MBufArray[PCPP_DPDK_L2_SWITCH_BURST_SIZE];
+		// the mbufs to send to each port, #PCPP_DPDK_L2_SWITCH_BURST_SIZE entries per port, and how many of them each port has
+		std::vector<struct rte_mbuf*> m_TxArrays;
+		std::vector<uint16_t> m_TxCounts;
+
+		bool verifyDevices(uint16_t inPort, uint16_t rxQueueId);
+		void addToPort(uint16_t port, struct rte_mbuf* mBuf);
+		void flood(uint16_t inPort, struct rte_mbuf* mBuf);
+
+		// disable copy c'tor and assignment operator
+		DpdkL2Switch(const DpdkL2Switch& other);
+		DpdkL2Switch& operator=(const DpdkL2Switch& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DPDK_L2_SWITCH */
@@ -0,0 +1,129 @@
+#ifndef PCAPPP_DPDK_L3_ROUTER
+#define PCAPPP_DPDK_L3_ROUTER
+
+#include "L3Forwarder.h"
+#include <vector>
+#include <stdint.h>
+
+/**
+ * @file
+ * A zero-copy IPv4/IPv6 router between DPDK devices. DpdkL3Router receives bursts of mbufs from a port, routes them in place with an
+ * L3Forwarder shared by all worker threads, and sends the mbufs to their output ports without creating MBufRawPacket or Packet objects for
+ * them. For details about PcapPlusPlus support for DPDK see DpdkDevice.h file description
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+/**
+ * The maximum number of packets DpdkL3Router receives in one burst
+ */
+#define PCPP_DPDK_L3_ROUTER_BURST_SIZE 64
+
+	class DpdkDevice;
+
+	/**
+	 * @struct DpdkL3RouterStats
+	 * The statistics of DpdkL3Router. The routing decisions are counted by L3ForwarderStats
+	 */
+	struct DpdkL3RouterStats
+	{
+		/** Number of packets received */
+		uint64_t rxPackets;
+		/** Number of frames given to L3Forwarder#processHostFrame() */
+		uint64_t hostPackets;
+		/** Number of ARP and neighbor discovery frames sent by the control plane (replies and requests) */
+		uint64_t controlPackets;
+		/** Number of packets sent */
+		uint64_t txPackets;
+		/** Number of packets dropped because a TX queue was full */
+		uint64_t txDrops;
+		/** The routing decisions of the received packets */
+		L3ForwarderStats forwarderStats;
+	};
+
+	/**
+	 * @class DpdkL3Router
+	 * A router between the ports given in the c'tor, where the port numbers of the L3Forwarder are the indices of the devices in the port
+	 * vector. Each call to routeBurst() receives a burst of mbufs from an RX queue of one port and routes all of them with one call to
+	 * L3Forwarder#forwardBurst(), which looks their destinations up in bulk and rewrites them in place, then sends each mbuf to its output
+	 * port. Frames for the control plane are handled inline by L3Forwarder#processHostFrame(): the ARP or neighbor discovery frame it
+	 * returns, if any, is written over the received mbuf and sent, so the control plane doesn't allocate mbufs. Frames the TX queues have no
+	 * room for are freed rather than retried.<BR>
+	 * Several workers, for example one per port, each own a DpdkL3Router and share one L3Forwarder. Every worker sends on its own TX queue of
+	 * each port, so the devices should be opened with a TX queue per worker (see DpdkDevice#openMultiQueues()):
+	 *
+	 * @code
+	 * // worker i, running on its own core
+	 * DpdkL3Router router(&forwarder, ports, i);
+	 * while (!m_Stop)
+	 *     router.routeBurst(i, 0);
+	 * @endcode
+	 *
+	 * A DpdkL3Router must be used by one thread only, the RX queues it receives from mustn't be read in other ways while it's used, and its
+	 * TX queue mustn't be written by other threads
+	 */
+	class DpdkL3Router
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] forwarder The forwarding engine, usually shared with the other workers of the router. It isn't owned by the router
+		 * @param[in] ports The devices of the router. The index of a device is its port number in the forwarder
+		 * @param[in] txQueueId The TX queue of each device this router sends packets on
+		 */
+		DpdkL3Router(L3Forwarder* forwarder, const std::vector<DpdkDevice*>& ports, uint16_t txQueueId);
+
+		/**
+		 * Receive one burst of up to #PCPP_DPDK_L3_ROUTER_BURST_SIZE packets from a port and send them to the ports they're routed to
+		 * @param[in] inPort The index of the port to receive packets from
+		 * @param[in] rxQueueId The RX queue to receive packets from
+		 * @return The number of packets received, which may be passed to DpdkAdaptivePoller#onPoll(). 0 is also returned if a device isn't
+		 * opened, a queue doesn't exist or the input port is capturing, in which case an error is printed to log
+		 */
+		uint16_t routeBurst(uint16_t inPort, uint16_t rxQueueId);
+
+		/**
+		 * @return The number of ports of the router
+		 */
+		inline uint16_t getNumOfPorts() const { return (uint16_t)m_Ports.size(); }
+
+		/**
+		 * Get the router statistics
+		 * @param[out] stats The statistics
+		 */
+		inline void getStats(DpdkL3RouterStats& stats) const { stats = m_Stats; }
+
+		/**
+		 * Reset the router statistics
+		 */
+		void clearStats();
+
+	private:
+
+		L3Forwarder* m_Forwarder;
+		std::vector<DpdkDevice*> m_Ports;
+		uint16_t m_TxQueueId;
+		DpdkL3RouterStats m_Stats;
+		struct rte_mbuf* m_MBufArray[PCPP_DPDK_L3_ROUTER_BURST_SIZE];
+		// the mbufs to send to each port, #PCPP_DPDK_L3_ROUTER_BURST_SIZE entries per port, and how many of them each port has
+		std::vector<struct rte_mbuf*> m_TxArrays;
+		std::vector<uint16_t> m_TxCounts;
+
+		bool verifyDevices(uint16_t inPort, uint16_t rxQueueId);
+		void addToPort(uint16_t port, struct rte_mbuf* mBuf);
+		void processHostFrame(uint16_t inPort, struct rte_mbuf* mBuf, uint32_t now);
+
+		// disable copy c'tor and assignment operator
+		DpdkL3Router(const DpdkL3Router& other);
+		DpdkL3Router& operator=(const DpdkL3Router& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DPDK_L3_ROUTER */
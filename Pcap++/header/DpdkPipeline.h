@@ -0,0 +1,416 @@
+#ifndef PCAPPP_DPDK_PIPELINE
+#define PCAPPP_DPDK_PIPELINE
+
+#include "DpdkDevice.h"
+#include "DpdkDeviceList.h"
+#include <string>
+#include <vector>
+
+struct rte_ring;
+
+/**
+ * @file
+ * A framework for splitting DPDK packet processing into stages, each running on its own core. A typical pipeline has an RX stage which
+ * reads packets from a DpdkDevice, a few processing stages (classification, reassembly, analysis etc.) and a TX stage which sends the
+ * packets out. The stages are connected by rings (see DpdkPacketRing) which pass the mbufs between the cores without copying them.
+ * For details about PcapPlusPlus support for DPDK see DpdkDevice.h file description
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+/**
+ * The default maximum number of packets a pipeline stage reads and processes at once
+ */
+#define PCPP_DPDK_PIPELINE_DEFAULT_BURST_SIZE 32
+
+	/**
+	 * @class DpdkPacketRing
+	 * A lock-free queue of packets between pipeline stages, which wraps DPDK's rte_ring. Only the mbufs are passed through the ring: an
+	 * MBufRawPacket which is enqueued is detached from its mbuf, and the dequeuing side binds the mbuf to its own MBufRawPacket. The packet
+	 * timestamp travels with the mbuf. Rings are usually created by DpdkPipeline#createRing(), and they must be created after DPDK is
+	 * initialized (see DpdkDeviceList#initDpdk())<BR>
+	 * Rings live in huge page memory, so they can also pass packets between the primary DPDK process and secondary processes (see
+	 * DpdkDeviceList#initDpdkSecondary()): one process creates the ring and the other attaches to it by name
+	 */
+	class DpdkPacketRing
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. Check isValid() to find out whether the ring was created
+		 * @param[in] name A unique name for the ring
+		 * @param[in] size The requested number of packets the ring can hold. It's rounded up to a power of 2, and the actual capacity
+		 * is returned by getCapacity()
+		 * @param[in] multiProducer Whether more than one core enqueues packets to the ring
+		 * @param[in] multiConsumer Whether more than one core dequeues packets from the ring
+		 * @param[in] socketId The NUMA socket to allocate the ring on. The default value (-1) means any socket
+		 */
+		DpdkPacketRing(const std::string& name, uint32_t size, bool multiProducer = false, bool multiConsumer = false, int socketId = -1);
+
+		/**
+		 * A c'tor for attaching to a ring created by another DPDK process, for example a ring a primary process created to pass packets
+		 * to a secondary process. The producer and consumer modes are the ones the ring was created with. Check isValid() to find out
+		 * whether the ring was found
+		 * @param[in] name The name of the ring
+		 */
+		DpdkPacketRing(const std::string& name);
+
+		/**
+		 * A d'tor for this class. Frees the mbufs left in the ring and the ring itself if the ring was created by this instance. A ring
+		 * which was attached to is left untouched, as other processes may still use it
+		 */
+		~DpdkPacketRing();
+
+		/**
+		 * @return True if the ring was created successfully, false otherwise
+		 */
+		inline bool isValid() const { return m_Ring != NULL; }
+
+		/**
+		 * @return The name of the ring
+		 */
+		inline const std::string& getName() const { return m_Name; }
+
+		/**
+		 * Enqueue a burst of packets. The packets which were enqueued are detached from their mbufs, so they can be bound to other mbufs
+		 * (for example by DpdkDevice#receivePackets() or dequeueBurst()). The packets which weren't enqueued stay untouched
+		 * @param[in] packets An array of the packets to enqueue. All of them must be attached to an mbuf
+		 * @param[in] count The number of packets in the array
+		 * @return The number of packets enqueued, which are the first ones in the array. It's smaller than count if the ring is full
+		 */
+		uint32_t enqueueBurst(MBufRawPacket** packets, uint32_t count);
+
+		/**
+		 * Dequeue a burst of packets
+		 * @param[out] packets An array of packets the dequeued mbufs are bound to. A NULL entry is allocated by this method and should be
+		 * freed by the user, other entries are reused and the mbufs they're attached to are freed (unless MBufRawPacket#setFreeMbuf()
+		 * was called with false)
+		 * @param[in] maxCount The maximum number of packets to dequeue, which is the size of the array
+		 * @return The number of packets dequeued
+		 */
+		uint32_t dequeueBurst(MBufRawPacket** packets, uint32_t maxCount);
+
+		/**
+		 * @return The number of packets currently in the ring
+		 */
+		uint32_t getCount() const;
+
+		/**
+		 * @return The number of packets which can currently be enqueued
+		 */
+		uint32_t getFreeCount() const;
+
+		/**
+		 * @return The maximum number of packets the ring can hold
+		 */
+		inline uint32_t getCapacity() const { return m_Capacity; }
+
+		/**
+		 * @return True if the ring was created by this instance, false if it was attached to by name
+		 */
+		inline bool isOwner() const { return m_IsOwner; }
+
+	private:
+
+		std::string m_Name;
+		struct rte_ring* m_Ring;
+		uint32_t m_Capacity;
+		bool m_IsOwner;
+
+		// disable copy c'tor and assignment operator
+		DpdkPacketRing(const DpdkPacketRing& other);
+		DpdkPacketRing& operator=(const DpdkPacketRing& other);
+	};
+
+
+	/**
+	 * @class DpdkPipelineStage
+	 * A base class for pipeline stages. A stage reads a burst of packets from its input, which is either an RX queue of a DpdkDevice or a
+	 * DpdkPacketRing, and passes it to processPackets(), which is implemented by the child class. processPackets() hands each packet to one
+	 * of the stage outputs by calling forward(), and packets which aren't forwarded are dropped. Outputs are either rings, which connect the
+	 * stage to the next stages, or TX queues of a DpdkDevice. Packets forwarded to an output are collected and sent to it as one burst
+	 * after processPackets() returns.<BR>
+	 * When a ring output is full the stage applies back-pressure according to the output's BackPressurePolicy: it either waits until the
+	 * next stage makes room, which slows down the whole pipeline to the rate of its slowest stage, or drops the packets which don't fit,
+	 * which keeps the upstream stages running at full rate.<BR>
+	 * A stage is a DpdkWorkerThread, so it's started on its own core by DpdkPipeline (or directly by DpdkDeviceList#startDpdkWorkerThreads()).
+	 * It may also be driven from the caller's thread by calling runOnce(). Each stage keeps statistics of the packets it handled, which may be
+	 * read while it's running (see getStats())
+	 */
+	class DpdkPipelineStage : public DpdkWorkerThread
+	{
+	public:
+
+		/**
+		 * What a stage does when a ring output is full
+		 */
+		enum BackPressurePolicy
+		{
+			/** Wait until the ring has room for the packets, or until the stage is stopped */
+			BackPressureBlock,
+			/** Drop the packets which don't fit in the ring */
+			BackPressureDrop
+		};
+
+		/**
+		 * @struct DpdkPipelineStageStats
+		 * The statistics of a pipeline stage
+		 */
+		struct DpdkPipelineStageStats
+		{
+			/** The number of packets read from the input */
+			uint64_t packetsIn;
+			/** The number of packets handed to an output */
+			uint64_t packetsForwarded;
+			/** The number of packets processPackets() didn't forward */
+			uint64_t packetsDropped;
+			/** The number of forwarded packets dropped because a ring output was full (BackPressureDrop) or a TX queue didn't send them */
+			uint64_t outputDrops;
+			/** The number of times the stage waited for a full ring output (BackPressureBlock) */
+			uint64_t backPressureWaits;
+			/** The number of polls which returned packets */
+			uint64_t busyPolls;
+			/** The number of polls which returned no packets */
+			uint64_t idlePolls;
+		};
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] name The name of the stage, used in log messages
+		 * @param[in] burstSize The maximum number of packets read from the input and passed to processPackets() at once. The default value
+		 * is #PCPP_DPDK_PIPELINE_DEFAULT_BURST_SIZE
+		 */
+		DpdkPipelineStage(const std::string& name, uint32_t burstSize = PCPP_DPDK_PIPELINE_DEFAULT_BURST_SIZE);
+
+		/**
+		 * A d'tor for this class. Frees the mbufs the stage still holds
+		 */
+		virtual ~DpdkPipelineStage();
+
+		/**
+		 * Set an RX queue of a device as the stage input. The device must be opened and mustn't be captured from in other ways
+		 * @param[in] device The device to read packets from
+		 * @param[in] rxQueueId The RX queue to read packets from
+		 * @return True if the input was set, false if the device is NULL or the stage is running
+		 */
+		bool setInput(DpdkDevice* device, uint16_t rxQueueId = 0);
+
+		/**
+		 * Set a ring as the stage input
+		 * @param[in] ring The ring to dequeue packets from
+		 * @return True if the input was set, false if the ring is NULL or invalid or the stage is running
+		 */
+		bool setInput(DpdkPacketRing* ring);
+
+		/**
+		 * Add a ring output to the stage
+		 * @param[in] ring The ring to enqueue the forwarded packets to
+		 * @param[in] policy What to do when the ring is full. The default is BackPressureBlock
+		 * @return The index of the output, to be used in forward(), or -1 if the ring is NULL or invalid or the stage is running
+		 */
+		int addOutput(DpdkPacketRing* ring, BackPressurePolicy policy = BackPressureBlock);
+
+		/**
+		 * Add a TX queue of a device as a stage output
+		 * @param[in] device The device to send the forwarded packets from. It must be opened
+		 * @param[in] txQueueId The TX queue to send the forwarded packets from
+		 * @return The index of the output, to be used in forward(), or -1 if the device is NULL or the stage is running
+		 */
+		int addOutput(DpdkDevice* device, uint16_t txQueueId = 0);
+
+		/**
+		 * @return The number of outputs of the stage
+		 */
+		inline int getNumOfOutputs() const { return (int)m_Outputs.size(); }
+
+		/**
+		 * Read one burst from the input, process it and send the forwarded packets to the outputs
+		 * @return The number of packets read from the input
+		 */
+		uint32_t runOnce();
+
+		/**
+		 * Run the stage in a loop until stop() is called. This method is called by DpdkDeviceList#startDpdkWorkerThreads() on the core
+		 * assigned to the stage
+		 * @param[in] coreId The core the stage runs on
+		 * @return False if the stage has no input, true otherwise
+		 */
+		virtual bool run(uint32_t coreId);
+
+		/**
+		 * Make run() return. If the stage waits for a full ring output it stops waiting and drops the packets
+		 */
+		virtual void stop();
+
+		/**
+		 * @return The core the stage runs on
+		 */
+		virtual uint32_t getCoreId() { return m_CoreId; }
+
+		/**
+		 * @return True if run() is currently running
+		 */
+		inline bool isRunning() const { return m_Running; }
+
+		/**
+		 * @return The name of the stage
+		 */
+		inline const std::string& getName() const { return m_Name; }
+
+		/**
+		 * @return The maximum number of packets passed to processPackets() at once
+		 */
+		inline uint32_t getBurstSize() const { return m_BurstSize; }
+
+		/**
+		 * Get the statistics of the stage. When the stage is running on another core the values are updated concurrently, so they may
+		 * be slightly inconsistent with each other
+		 * @param[out] stats The statistics of the stage
+		 */
+		void getStats(DpdkPipelineStageStats& stats) const;
+
+		/**
+		 * Reset the statistics of the stage. Should be called when the stage isn't running
+		 */
+		void clearStats();
+
+	protected:
+
+		/**
+		 * Process a burst of packets read from the input. Each packet should be handed to an output with forward() or be left alone, in
+		 * which case it's dropped after this method returns. Packets may be modified before they're forwarded, for example through a
+		 * Packet object
+		 * @param[in] packets The packets read from the input
+		 * @param[in] numOfPackets The number of packets
+		 */
+		virtual void processPackets(MBufRawPacket** packets, uint32_t numOfPackets) = 0;
+
+		/**
+		 * Hand a packet to one of the stage outputs. The packet is detached from its mbuf, which is sent to the output after
+		 * processPackets() returns. Should only be called from processPackets()
+		 * @param[in] packet The packet to forward
+		 * @param[in] outputIndex The index of the output, as returned by addOutput()
+		 * @return True if the packet was forwarded, false if the output index is invalid or the packet isn't attached to an mbuf
+		 */
+		bool forward(MBufRawPacket* packet, int outputIndex);
+
+	private:
+
+		struct StageOutput;
+
+		std::string m_Name;
+		uint32_t m_BurstSize;
+		uint32_t m_CoreId;
+		volatile bool m_Stop;
+		volatile bool m_Running;
+		DpdkDevice* m_InputDevice;
+		uint16_t m_RxQueueId;
+		DpdkPacketRing* m_InputRing;
+		std::vector<MBufRawPacket*> m_InputPackets;
+		std::vector<StageOutput*> m_Outputs;
+		DpdkPipelineStageStats m_Stats;
+
+		void flushOutput(StageOutput* output);
+
+		// disable copy c'tor and assignment operator
+		DpdkPipelineStage(const DpdkPipelineStage& other);
+		DpdkPipelineStage& operator=(const DpdkPipelineStage& other);
+	};
+
+
+	/**
+	 * @class DpdkPipeline
+	 * A set of pipeline stages (see DpdkPipelineStage) and the rings connecting them, which are started and stopped together. Each stage runs
+	 * on its own core. The typical usage is:
+	 *    - create the rings with createRing()
+	 *    - create the stages, connect them to the rings and devices with DpdkPipelineStage#setInput() and DpdkPipelineStage#addOutput(), and
+	 *      add them to the pipeline with addStage(), from the first stage to the last one
+	 *    - call start(), and stop() when done
+	 *
+	 * The pipeline owns its rings but not its stages, which must outlive it (or at least be stopped before they're deleted)
+	 */
+	class DpdkPipeline
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 */
+		DpdkPipeline();
+
+		/**
+		 * A d'tor for this class. Stops the pipeline if it's running and deletes its rings
+		 */
+		~DpdkPipeline();
+
+		/**
+		 * Create a ring owned by the pipeline. See DpdkPacketRing#DpdkPacketRing() for the parameters
+		 * @return A pointer to the ring or NULL if it couldn't be created, in which case an error is printed to log
+		 */
+		DpdkPacketRing* createRing(const std::string& name, uint32_t size, bool multiProducer = false, bool multiConsumer = false, int socketId = -1);
+
+		/**
+		 * Add a stage to the pipeline. Stages should be added in the order packets flow through them, as it's the order they're stopped in
+		 * @param[in] stage The stage to add
+		 * @return True if the stage was added, false if it's NULL, already in the pipeline or the pipeline is running
+		 */
+		bool addStage(DpdkPipelineStage* stage);
+
+		/**
+		 * @return The number of stages in the pipeline
+		 */
+		inline size_t getNumOfStages() const { return m_Stages.size(); }
+
+		/**
+		 * @param[in] index The index of the stage
+		 * @return The stage in the index or NULL if the index is out of range
+		 */
+		DpdkPipelineStage* getStage(size_t index) const;
+
+		/**
+		 * Start the stages, each on one of the cores in the mask, in the order they were added
+		 * @param[in] coreMask The cores to run the stages on. It must have exactly as many cores as stages and mustn't include the DPDK
+		 * master core
+		 * @return True if all stages were started, false otherwise
+		 */
+		bool start(CoreMask coreMask);
+
+		/**
+		 * Start the stages on cores which are local to the NUMA node of a device (see DpdkDeviceList#startDpdkWorkerThreadsOnDeviceSocket())
+		 * @param[in] device The device which the cores should be local to, usually the one the pipeline reads from
+		 * @return True if all stages were started, false otherwise
+		 */
+		bool start(DpdkDevice* device);
+
+		/**
+		 * Stop the stages in the order they were added and wait for their cores to finish. Packets left in the rings stay there until the
+		 * pipeline is started again or deleted
+		 */
+		void stop();
+
+		/**
+		 * @return True if the pipeline is running
+		 */
+		inline bool isRunning() const { return m_Running; }
+
+	private:
+
+		std::vector<DpdkPipelineStage*> m_Stages;
+		std::vector<DpdkPacketRing*> m_Rings;
+		bool m_Running;
+
+		bool canStart() const;
+
+		// disable copy c'tor and assignment operator
+		DpdkPipeline(const DpdkPipeline& other);
+		DpdkPipeline& operator=(const DpdkPipeline& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DPDK_PIPELINE */
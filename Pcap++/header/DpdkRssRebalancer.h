@@ -0,0 +1,285 @@
+#ifndef PCAPPP_DPDK_RSS_REBALANCER
+#define PCAPPP_DPDK_RSS_REBALANCER
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file
+ * Load-aware rebalancing of the RSS redirection table (RETA) of a DpdkDevice. RSS spreads flows over the RX queues by a hash of their
+ * addresses and ports, and the RETA maps the low bits of the hash to a queue. When a few heavy flows hash to the same queue its core falls
+ * behind while others idle, and changing the RSS key requires restarting the device. DpdkRssRebalancer instead moves RETA entries from
+ * hot queues to cold ones while the device runs.
+ * For details about PcapPlusPlus support for DPDK see DpdkDevice.h file description
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	class DpdkDevice;
+	class MBufRawPacket;
+
+	/**
+	 * The measure of the load of an RX queue DpdkRssRebalancer balances
+	 */
+	enum DpdkRssLoadMetric
+	{
+		/** The number of packets the queue received since the previous round */
+		DpdkRssLoadPackets,
+		/** The share of the polls of the queue which returned packets since the previous round, which is how busy the core of the queue
+		 * is. Requires burst statistics to be enabled on the device (see DpdkDevice#setRxBurstStatsEnabled()) */
+		DpdkRssLoadBusyRatio
+	};
+
+	/**
+	 * @struct DpdkRssRebalancerConfig
+	 * The configuration of DpdkRssRebalancer
+	 */
+	struct DpdkRssRebalancerConfig
+	{
+		/**
+		 * The load measure to balance
+		 */
+		DpdkRssLoadMetric loadMetric;
+
+		/**
+		 * A round moves entries only if the load of the hottest queue is above this multiple of the average load of the queues
+		 */
+		double imbalanceThreshold;
+
+		/**
+		 * The maximum number of RETA entries moved in one round. Moving a few entries at a time limits the number of flows which change
+		 * queues at once
+		 */
+		uint16_t maxMovesPerRound;
+
+		/**
+		 * A round in which the queues received fewer packets than this in total doesn't move entries, as the load of a few packets says
+		 * little about the flows
+		 */
+		uint64_t minPacketsPerRound;
+
+		/**
+		 * The number of rounds after a round which moved entries in which no entries are moved, so the load of the new layout is measured
+		 * before it's changed again
+		 */
+		uint32_t cooldownRounds;
+
+		/**
+		 * The RX queues to balance the load between. Entries which point to other queues aren't moved, and entries aren't moved to them.
+		 * If empty all opened RX queues are balanced
+		 */
+		std::vector<uint16_t> rxQueues;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] loadMetric The load measure to balance. Default value is DpdkRssLoadPackets
+		 * @param[in] imbalanceThreshold The ratio of the hottest queue load to the average above which entries are moved. Default value is
+		 * 1.25
+		 * @param[in] maxMovesPerRound The maximum number of entries moved in a round. Default value is 16
+		 * @param[in] minPacketsPerRound The minimal number of packets in a round for entries to be moved. Default value is 10000
+		 * @param[in] cooldownRounds The number of rounds without moves after a round with moves. Default value is 1
+		 */
+		DpdkRssRebalancerConfig(DpdkRssLoadMetric loadMetric = DpdkRssLoadPackets, double imbalanceThreshold = 1.25, uint16_t maxMovesPerRound = 16,
+				uint64_t minPacketsPerRound = 10000, uint32_t cooldownRounds = 1)
+		{
+			this->loadMetric = loadMetric;
+			this->imbalanceThreshold = imbalanceThreshold;
+			this->maxMovesPerRound = maxMovesPerRound;
+			this->minPacketsPerRound = minPacketsPerRound;
+			this->cooldownRounds = cooldownRounds;
+		}
+	};
+
+	/**
+	 * @struct DpdkRssEntryMove
+	 * A RETA entry moved from one RX queue to another
+	 */
+	struct DpdkRssEntryMove
+	{
+		/** The index of the entry in the RETA: packets whose RSS hash modulo the RETA size is this index are moved */
+		uint16_t entry;
+		/** The RX queue the entry pointed to */
+		uint16_t fromRxQueue;
+		/** The RX queue the entry points to */
+		uint16_t toRxQueue;
+	};
+
+	/**
+	 * The phases of a move of RETA entries, reported to the OnDpdkRssMigrationCallback
+	 */
+	enum DpdkRssMigrationPhase
+	{
+		/** The entries are about to be moved. The workers of the target queues may prepare for the flows of the entries */
+		DpdkRssMigrationPrepare,
+		/** The RETA was updated. New packets of the moved entries arrive on the target queues, while packets already waiting in the
+		 * source queues are still received there */
+		DpdkRssMigrationCommitted,
+		/** Updating the RETA failed and the entries still point to their source queues */
+		DpdkRssMigrationAborted
+	};
+
+	/**
+	 * @typedef OnDpdkRssMigrationCallback
+	 * A callback DpdkRssRebalancer calls around a move of RETA entries so workers which keep per-flow state can hand it over from the source
+	 * queue to the target queue. It's called on the thread which calls DpdkRssRebalancer#rebalance()
+	 * @param[in] phase The phase of the move
+	 * @param[in] moves The moved entries
+	 * @param[in] userCookie A pointer to the object given by the user in DpdkRssRebalancer#setMigrationCallback()
+	 * @return In the DpdkRssMigrationPrepare phase, true to move the entries or false to cancel the move. Ignored in the other phases
+	 */
+	typedef bool (*OnDpdkRssMigrationCallback)(DpdkRssMigrationPhase phase, const std::vector<DpdkRssEntryMove>& moves, void* userCookie);
+
+	/**
+	 * @struct DpdkRssRebalancerStats
+	 * The statistics of DpdkRssRebalancer
+	 */
+	struct DpdkRssRebalancerStats
+	{
+		/** Number of rebalance() rounds */
+		uint64_t rounds;
+		/** Number of rounds which moved entries */
+		uint64_t rebalances;
+		/** Number of RETA entries moved */
+		uint64_t entryMoves;
+		/** Number of moves the migration callback cancelled */
+		uint64_t cancelledMoves;
+		/** Number of RETA updates which failed */
+		uint64_t failedUpdates;
+		/** The ratio of the hottest queue load to the average load in the last round which measured the load */
+		double lastImbalance;
+	};
+
+	/**
+	 * @class DpdkRssRebalancer
+	 * Rebalances the RSS redirection table (RETA) of a DpdkDevice according to the load of its RX queues. Each call to rebalance() is a
+	 * round: it measures the load of each queue since the previous round (packets received, or how busy the core polling the queue is, see
+	 * DpdkRssLoadMetric) and if the hottest queue is loaded above DpdkRssRebalancerConfig#imbalanceThreshold times the average, moves RETA
+	 * entries from the hottest queues to the coldest ones with DpdkDevice#setRssRedirectionTable().<BR>
+	 * Entries are chosen by their load. When the workers report the RSS hashes of the packets they receive with countBurst(), the load of
+	 * each entry is known and the entries whose load best closes the gap between the two queues are moved. Otherwise the load of a queue is
+	 * assumed to be spread evenly over its entries. Counting is a modulo and an increment per packet in a counter array of the queue, so
+	 * queues don't share cache lines.<BR>
+	 * A move changes the queue of all flows of an entry, so workers which keep per-flow state must hand it over. The callback set with
+	 * setMigrationCallback() is called before the RETA is updated, and may cancel the move, and again after it's updated. A typical control
+	 * thread loop looks like this:
+	 * @code
+	 * DpdkRssRebalancer rebalancer(dev);
+	 * rebalancer.setMigrationCallback(onMigration, &workers);
+	 * while (!stop)
+	 * {
+	 *     sleep(1);
+	 *     rebalancer.rebalance();
+	 * }
+	 * @endcode
+	 * rebalance() must be called by one thread only. countBurst() and countPacket() may be called by the worker of each queue concurrently
+	 */
+	class DpdkRssRebalancer
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. The device must be opened with more than one RX queue
+		 * @param[in] device The device whose RETA is rebalanced
+		 * @param[in] config The rebalancer configuration
+		 */
+		DpdkRssRebalancer(DpdkDevice* device, const DpdkRssRebalancerConfig& config = DpdkRssRebalancerConfig());
+
+		/**
+		 * Set the callback which is called around each move of RETA entries
+		 * @param[in] onMigration The callback, or NULL to remove the current one
+		 * @param[in] onMigrationUserCookie A pointer to a user provided object, which is passed to the callback
+		 */
+		void setMigrationCallback(OnDpdkRssMigrationCallback onMigration, void* onMigrationUserCookie = NULL);
+
+		/**
+		 * Count a packet for the load of its RETA entry. Must be called only by the thread which polls the queue
+		 * @param[in] rxQueueId The RX queue the packet was received on
+		 * @param[in] rssHash The RSS hash of the packet
+		 */
+		inline void countPacket(uint16_t rxQueueId, uint32_t rssHash)
+		{
+			if (m_RetaSize != 0 && rxQueueId < m_NumOfCountedQueues)
+				m_EntryPackets[(size_t)rxQueueId * m_CountersPerQueue + rssHash % m_RetaSize]++;
+		}
+
+		/**
+		 * Count a burst of packets for the load of their RETA entries, using the RSS hash the NIC stored in their mbufs. Packets without an
+		 * RSS hash aren't counted. Must be called only by the thread which polls the queue
+		 * @param[in] rxQueueId The RX queue the packets were received on
+		 * @param[in] packets The packets
+		 * @param[in] numOfPackets The number of packets
+		 */
+		void countBurst(uint16_t rxQueueId, MBufRawPacket** packets, uint16_t numOfPackets);
+
+		/**
+		 * Run a round: measure the load of the queues since the previous round and move RETA entries if they're imbalanced. The first
+		 * round only reads the RETA and starts measuring
+		 * @return The number of entries moved, or -1 if the RETA couldn't be read or updated or the load couldn't be measured (an error is
+		 * printed to log)
+		 */
+		int rebalance();
+
+		/**
+		 * Get the load of each RX queue measured in the last round
+		 * @param[out] loads A vector which is filled with the load of each RX queue ID, in the unit of DpdkRssRebalancerConfig#loadMetric.
+		 * Queues which aren't balanced have a load of 0
+		 */
+		void getQueueLoads(std::vector<double>& loads) const { loads = m_QueueLoads; }
+
+		/**
+		 * Get the RETA as the rebalancer last read or wrote it
+		 * @param[out] table The RX queue of each RETA entry
+		 */
+		void getRedirectionTable(std::vector<uint16_t>& table) const { table = m_Reta; }
+
+		/**
+		 * Get the rebalancer statistics
+		 * @param[out] stats The statistics
+		 */
+		inline void getStats(DpdkRssRebalancerStats& stats) const { stats = m_Stats; }
+
+		/**
+		 * Reset the rebalancer statistics
+		 */
+		void clearStats();
+
+	private:
+
+		DpdkDevice* m_Device;
+		DpdkRssRebalancerConfig m_Config;
+		OnDpdkRssMigrationCallback m_OnMigration;
+		void* m_OnMigrationUserCookie;
+		DpdkRssRebalancerStats m_Stats;
+		uint16_t m_RetaSize;
+		std::vector<uint16_t> m_Reta;
+		std::vector<bool> m_IsBalancedQueue;
+		uint16_t m_NumOfCountedQueues;
+		size_t m_CountersPerQueue;
+		std::vector<uint64_t> m_EntryPackets;
+		std::vector<uint64_t> m_PrevEntryPackets;
+		std::vector<uint64_t> m_PrevQueuePackets;
+		std::vector<uint64_t> m_PrevQueuePolls;
+		std::vector<uint64_t> m_PrevQueueEmptyPolls;
+		std::vector<double> m_QueueLoads;
+		bool m_Measuring;
+		uint32_t m_CooldownLeft;
+
+		bool start();
+		bool measureQueueLoads(std::vector<uint64_t>& queuePackets);
+		void measureEntryLoads(std::vector<double>& entryLoads);
+		void planMoves(std::vector<double>& entryLoads, std::vector<DpdkRssEntryMove>& moves);
+
+		// disable copy c'tor and assignment operator
+		DpdkRssRebalancer(const DpdkRssRebalancer& other);
+		DpdkRssRebalancer& operator=(const DpdkRssRebalancer& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DPDK_RSS_REBALANCER */
@@ -0,0 +1,244 @@
+#ifndef PCAPPP_DPDK_TX_AGGREGATOR
+#define PCAPPP_DPDK_TX_AGGREGATOR
+
+#include "DpdkDevice.h"
+#include "DpdkDeviceList.h"
+#include <vector>
+
+struct rte_ring;
+struct rte_mbuf;
+
+/**
+ * @file
+ * Sharing the TX queues of a DpdkDevice between more worker threads than the device has TX queues. A TX queue may be written by one
+ * thread only, so DpdkTxAggregator gives each worker a lock-free staging ring, and a TX service thread per queue drains the rings mapped
+ * to its queue into bursts sent with rte_eth_tx_burst().
+ * For details about PcapPlusPlus support for DPDK see DpdkDevice.h file description
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+/**
+ * The maximum number of packets DpdkTxAggregator sends to a TX queue in one burst
+ */
+#define PCPP_DPDK_TX_AGGREGATOR_BURST_SIZE 64
+
+/**
+ * The default number of packets each staging ring of DpdkTxAggregator can hold
+ */
+#define PCPP_DPDK_TX_AGGREGATOR_DEFAULT_RING_SIZE 1024
+
+	/**
+	 * @struct DpdkTxAggregatorWorkerStats
+	 * The statistics of a worker of DpdkTxAggregator
+	 */
+	struct DpdkTxAggregatorWorkerStats
+	{
+		/** Number of packets the worker staged for sending */
+		uint64_t stagedPackets;
+		/** Number of packets which weren't staged because the staging ring of the worker was full (back-pressure) */
+		uint64_t rejectedPackets;
+		/** Number of packets currently in the staging ring of the worker */
+		uint32_t pendingPackets;
+	};
+
+	/**
+	 * @struct DpdkTxAggregatorQueueStats
+	 * The statistics of a TX queue of DpdkTxAggregator
+	 */
+	struct DpdkTxAggregatorQueueStats
+	{
+		/** Number of packets sent to the TX queue */
+		uint64_t txPackets;
+		/** Number of bursts sent to the TX queue */
+		uint64_t txBursts;
+		/** Number of times the TX queue accepted only part of a burst (or none of it) because it was full. The rest of the burst is kept
+		 * and sent first on the next drain, so the staging rings fill up and the workers see back-pressure */
+		uint64_t txQueueFullEvents;
+		/** Number of packets the TX queue didn't accept yet, which are kept for the next drain */
+		uint32_t heldPackets;
+	};
+
+	/**
+	 * @class DpdkTxAggregator
+	 * Lets any number of worker threads send packets through the opened TX queues of a DpdkDevice without locking. Each worker gets a
+	 * single-producer single-consumer staging ring, and the rings are mapped to the TX queues evenly: worker N is mapped to TX queue
+	 * (N % number of TX queues). Workers stage packets with sendPackets(), which only enqueues the mbufs to their ring. A TX service
+	 * thread per TX queue calls drainTxQueue() (or runs DpdkTxServiceThread), which collects the packets of the rings mapped to the queue
+	 * in round-robin order, so no worker starves the others, and sends them with rte_eth_tx_burst().<BR>
+	 * Packets are never dropped by the aggregator: a burst the TX queue didn't fully accept is kept and retried before new packets are
+	 * collected, so when the NIC is slower than the workers the staging rings fill up and sendPackets() stages fewer packets. The packets
+	 * which weren't staged are left with the worker, which decides whether to retry or drop them. See DpdkTxAggregatorWorkerStats and
+	 * DpdkTxAggregatorQueueStats for the back-pressure statistics.<BR>
+	 * For example, 16 workers sharing the 4 TX queues of a VF:
+	 *
+	 * @code
+	 * DpdkTxAggregator aggregator(device, 16);
+	 * // on worker N
+	 * uint16_t staged = aggregator.sendPackets(N, packets, numOfPackets);
+	 * // on the TX service core of queue Q
+	 * while (!stop)
+	 *     aggregator.drainTxQueue(Q);
+	 * @endcode
+	 *
+	 * The device must be opened before the aggregator is created, and while it's used the TX queues mustn't be written in other ways.
+	 * A TX queue must be drained by one thread at a time, although one thread may drain several queues
+	 */
+	class DpdkTxAggregator
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. Check isValid() to find out whether the staging rings were created
+		 * @param[in] device The device to send packets to. It must be opened, and all of its opened TX queues are used
+		 * @param[in] numOfWorkers The number of worker threads which send packets, each of them is given a staging ring
+		 * @param[in] stagingRingSize The minimal number of packets each staging ring can hold. The actual capacity is rounded up to a
+		 * power of 2 minus 1. The default value is #PCPP_DPDK_TX_AGGREGATOR_DEFAULT_RING_SIZE
+		 */
+		DpdkTxAggregator(DpdkDevice* device, uint16_t numOfWorkers, uint32_t stagingRingSize = PCPP_DPDK_TX_AGGREGATOR_DEFAULT_RING_SIZE);
+
+		/**
+		 * A d'tor for this class. Frees the packets which weren't sent yet and the staging rings
+		 */
+		~DpdkTxAggregator();
+
+		/**
+		 * @return True if the staging rings were created successfully, false otherwise
+		 */
+		inline bool isValid() const { return m_Valid; }
+
+		/**
+		 * @return The device packets are sent to
+		 */
+		inline DpdkDevice* getDevice() const { return m_Device; }
+
+		/**
+		 * @return The number of workers
+		 */
+		inline uint16_t getNumOfWorkers() const { return m_NumOfWorkers; }
+
+		/**
+		 * @return The number of TX queues packets are sent to
+		 */
+		inline uint16_t getNumOfTxQueues() const { return m_NumOfTxQueues; }
+
+		/**
+		 * @param[in] workerId The worker ID
+		 * @return The TX queue the packets of the worker are sent to
+		 */
+		inline uint16_t getWorkerTxQueue(uint16_t workerId) const { return (m_NumOfTxQueues == 0 ? 0 : workerId % m_NumOfTxQueues); }
+
+		/**
+		 * Stage packets for sending. Must be called only by the thread of the worker. The packets which were staged are detached from
+		 * their mbufs, so they can be bound to other mbufs (for example by DpdkDevice#receivePackets()). The packets which weren't
+		 * staged stay untouched
+		 * @param[in] workerId The ID of the calling worker, smaller than getNumOfWorkers()
+		 * @param[in] packets An array of the packets to send. All of them must be attached to an mbuf
+		 * @param[in] count The number of packets in the array
+		 * @return The number of packets staged, which are the first ones in the array. It's smaller than count if the staging ring of
+		 * the worker is full
+		 */
+		uint16_t sendPackets(uint16_t workerId, MBufRawPacket** packets, uint16_t count);
+
+		/**
+		 * Stage a single packet for sending. See sendPackets()
+		 * @param[in] workerId The ID of the calling worker, smaller than getNumOfWorkers()
+		 * @param[in] packet The packet to send. It must be attached to an mbuf
+		 * @return True if the packet was staged, false if the staging ring of the worker is full
+		 */
+		bool sendPacket(uint16_t workerId, MBufRawPacket& packet);
+
+		/**
+		 * Send the packets staged by the workers mapped to a TX queue, up to #PCPP_DPDK_TX_AGGREGATOR_BURST_SIZE packets. Must be
+		 * called by one thread at a time for each TX queue
+		 * @param[in] txQueueId The TX queue to drain, smaller than getNumOfTxQueues()
+		 * @return The number of packets sent
+		 */
+		uint16_t drainTxQueue(uint16_t txQueueId);
+
+		/**
+		 * Get the statistics of a worker
+		 * @param[in] workerId The worker ID
+		 * @param[out] stats The statistics
+		 */
+		void getWorkerStats(uint16_t workerId, DpdkTxAggregatorWorkerStats& stats) const;
+
+		/**
+		 * Get the statistics of a TX queue
+		 * @param[in] txQueueId The TX queue ID
+		 * @param[out] stats The statistics
+		 */
+		void getTxQueueStats(uint16_t txQueueId, DpdkTxAggregatorQueueStats& stats) const;
+
+		/**
+		 * Reset the statistics of all workers and TX queues. Shouldn't be called while packets are sent
+		 */
+		void clearStats();
+
+	private:
+
+		struct WorkerState;
+		struct TxQueueState;
+
+		DpdkDevice* m_Device;
+		uint16_t m_NumOfWorkers;
+		uint16_t m_NumOfTxQueues;
+		bool m_Valid;
+		WorkerState* m_Workers;
+		TxQueueState* m_TxQueues;
+
+		// disable copy c'tor and assignment operator
+		DpdkTxAggregator(const DpdkTxAggregator& other);
+		DpdkTxAggregator& operator=(const DpdkTxAggregator& other);
+	};
+
+
+	/**
+	 * @class DpdkTxServiceThread
+	 * A worker thread which drains TX queues of a DpdkTxAggregator in a loop until it's stopped. It's started by
+	 * DpdkDeviceList#startDpdkWorkerThreads() like other workers. Each TX queue should be drained by one DpdkTxServiceThread only
+	 */
+	class DpdkTxServiceThread : public DpdkWorkerThread
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] aggregator The aggregator to drain
+		 * @param[in] txQueues The TX queues of the aggregator the thread drains
+		 */
+		DpdkTxServiceThread(DpdkTxAggregator* aggregator, const std::vector<uint16_t>& txQueues);
+
+		/**
+		 * Drain the TX queues until stop() is called
+		 * @param[in] coreId The core the thread runs on
+		 * @return False if the aggregator isn't valid, true otherwise
+		 */
+		bool run(uint32_t coreId);
+
+		/**
+		 * Stop draining the TX queues
+		 */
+		void stop();
+
+		/**
+		 * @return The core the thread runs on
+		 */
+		uint32_t getCoreId() { return m_CoreId; }
+
+	private:
+
+		DpdkTxAggregator* m_Aggregator;
+		std::vector<uint16_t> m_TxQueues;
+		uint32_t m_CoreId;
+		volatile bool m_Stop;
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DPDK_TX_AGGREGATOR */
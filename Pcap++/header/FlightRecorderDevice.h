@@ -0,0 +1,331 @@
+#ifndef PCAPPP_FLIGHT_RECORDER_DEVICE
+#define PCAPPP_FLIGHT_RECORDER_DEVICE
+
+#include "Device.h"
+#include "RawPacket.h"
+#include "PcapFilter.h"
+#include <pthread.h>
+#include <string>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The default size of the memory of a FlightRecorderDevice, in bytes
+ */
+#define PCPP_FLIGHT_RECORDER_DEFAULT_CAPACITY (256ULL * 1024 * 1024)
+
+/**
+ * The default size of a segment of a FlightRecorderDevice, which is the size of a huge page on x86
+ */
+#define PCPP_FLIGHT_RECORDER_DEFAULT_SEGMENT_SIZE (2 * 1024 * 1024)
+
+	class PcapLiveDevice;
+	class IFileWriterDevice;
+
+	/**
+	 * @struct FlightRecorderConfiguration
+	 * The configuration of a FlightRecorderDevice
+	 */
+	struct FlightRecorderConfiguration
+	{
+		/** The size of the memory packets are kept in, in bytes. It's rounded up to a whole number of segments */
+		uint64_t capacity;
+
+		/** The size of each segment in bytes. Producers append packets to a segment of their own and take the oldest segment when it's full,
+		 * so packets are overwritten a segment at a time. Packets longer than a segment are truncated
+		 */
+		uint32_t segmentSize;
+
+		/** The number of threads which record packets at the same time, each with its own producer ID. There must be at least two segments
+		 * per producer
+		 */
+		uint16_t numOfProducers;
+
+		/** The maximum age of the packets written by a dump, in seconds relative to the time the dump was triggered. Older packets which are
+		 * still in memory aren't written. If the value is set to 0 every packet in memory is written
+		 */
+		uint32_t retentionSeconds;
+
+		/** The maximum number of bytes kept of each packet. If the value is set to 0 packets are kept whole (up to the segment size) */
+		uint32_t snapshotLength;
+
+		/** The flag indicating whether the memory is allocated from huge pages (Linux only). If there aren't enough free huge pages regular
+		 * pages are used
+		 */
+		bool useHugePages;
+
+		/** The link layer type written to the files of the dumps */
+		LinkLayerType linkLayerType;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] capacity The size of the memory in bytes. Default is #PCPP_FLIGHT_RECORDER_DEFAULT_CAPACITY
+		 * @param[in] numOfProducers The number of threads which record packets. Default is 1
+		 * @param[in] retentionSeconds The maximum age of the packets written by a dump in seconds, 0 means no limit. Default is 0
+		 */
+		FlightRecorderConfiguration(uint64_t capacity = PCPP_FLIGHT_RECORDER_DEFAULT_CAPACITY, uint16_t numOfProducers = 1, uint32_t retentionSeconds = 0) :
+			capacity(capacity), segmentSize(PCPP_FLIGHT_RECORDER_DEFAULT_SEGMENT_SIZE), numOfProducers(numOfProducers),
+			retentionSeconds(retentionSeconds), snapshotLength(0), useHugePages(true), linkLayerType(LINKTYPE_ETHERNET)
+		{
+		}
+	};
+
+	/**
+	 * @struct FlightRecorderDumpRequest
+	 * What a FlightRecorderDevice dump writes and where. The time window is relative to the time the dump is triggered
+	 */
+	struct FlightRecorderDumpRequest
+	{
+		/** The file the packets are written to */
+		std::string fileName;
+
+		/** The flag indicating whether the file is written with PcapNgFileWriterDevice rather than PcapFileWriterDevice */
+		bool pcapng;
+
+		/** How many seconds before the trigger the window starts. If the value is set to 0 the window starts with the oldest packet in
+		 * memory (within FlightRecorderConfiguration#retentionSeconds)
+		 */
+		uint32_t secondsBefore;
+
+		/** How many seconds after the trigger the window ends. The dump waits until then before it writes, so packets captured after the
+		 * trigger are written as well
+		 */
+		uint32_t secondsAfter;
+
+		/** A filter the written packets must match, or NULL for writing all packets in the window. It's compiled when the dump is triggered,
+		 * so it may be changed or deleted afterwards
+		 */
+		GeneralFilter* filter;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] fileName The file the packets are written to
+		 * @param[in] secondsBefore How many seconds before the trigger the window starts, 0 means all packets in memory. Default is 0
+		 * @param[in] secondsAfter How many seconds after the trigger the window ends. Default is 0
+		 * @param[in] filter A filter the written packets must match, or NULL. Default is NULL
+		 * @param[in] pcapng Whether the file is a pcap-ng file. Default is false
+		 */
+		FlightRecorderDumpRequest(const std::string& fileName, uint32_t secondsBefore = 0, uint32_t secondsAfter = 0, GeneralFilter* filter = NULL,
+				bool pcapng = false) :
+			fileName(fileName), pcapng(pcapng), secondsBefore(secondsBefore), secondsAfter(secondsAfter), filter(filter)
+		{
+		}
+	};
+
+	/**
+	 * @struct FlightRecorderStats
+	 * The recording statistics of a FlightRecorderDevice
+	 */
+	struct FlightRecorderStats
+	{
+		/** Number of packets recorded */
+		uint64_t packets;
+		/** Number of bytes of these packets, as kept in memory */
+		uint64_t bytes;
+		/** Number of packets truncated to the snapshot length or the segment size */
+		uint64_t truncated;
+		/** Number of packets which weren't recorded because the producer couldn't take a free segment */
+		uint64_t drops;
+		/** Number of segments whose packets were overwritten by newer packets */
+		uint64_t overwrittenSegments;
+	};
+
+	/**
+	 * @struct FlightRecorderDumpResult
+	 * The outcome of a FlightRecorderDevice dump
+	 */
+	struct FlightRecorderDumpResult
+	{
+		/** The file the packets were written to */
+		std::string fileName;
+		/** True if the file was written, false if it couldn't be opened or the dump was cancelled by closing the device */
+		bool succeeded;
+		/** Number of packets written to the file */
+		uint64_t packetsWritten;
+		/** Number of packets in the window which didn't match the filter */
+		uint64_t packetsFiltered;
+		/** Number of segments which were overwritten by producers while the dump read them, so their packets weren't written */
+		uint32_t segmentsLost;
+	};
+
+	/**
+	 * @class FlightRecorderDevice
+	 * A flight recorder for traffic: it keeps the latest packets (the last gigabytes, or the last seconds of traffic which fit in them) in
+	 * memory all the time, and writes them to a file only when something triggers a dump - an alert, a filter match or an API call. The
+	 * memory is preallocated when the device is opened, from huge pages where available, and divided into fixed size segments.<BR>
+	 * Capture threads append packets without locks: each producer fills a segment of its own, and when the segment is full it takes the
+	 * segment holding the oldest packets by advancing a shared atomic counter, overwriting the packets in it. Recording never waits and
+	 * never allocates memory. A single capture thread can record directly from PcapLiveDevice#startCapture() or
+	 * PcapLiveDevice#startCaptureBurstMode() with onPacketArrives() or onPacketsArriveBurst() and the device as the user cookie.<BR>
+	 * triggerDump() starts a background thread which waits for the end of the requested time window, then copies the segments one at a time
+	 * and writes the packets of the window which match the filter of the request to a pcap or pcap-ng file. Capture doesn't pause during a
+	 * dump: a segment a producer overwrites while the dump copies it is detected and skipped, and counted in
+	 * FlightRecorderDumpResult#segmentsLost. Packets are written segment by segment, so packets of each producer are in order but packets
+	 * of different producers may interleave out of timestamp order. One dump runs at a time; its result is collected with waitForDump()
+	 */
+	class FlightRecorderDevice : public IDevice
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. The memory isn't allocated until open() is called
+		 * @param[in] config The configuration of the recorder
+		 */
+		FlightRecorderDevice(const FlightRecorderConfiguration& config = FlightRecorderConfiguration());
+
+		/**
+		 * A d'tor for this class. Closes the device if it's open
+		 */
+		~FlightRecorderDevice();
+
+		/**
+		 * @return The configuration of the recorder. The capacity is rounded up to a whole number of segments when the device is opened
+		 */
+		inline const FlightRecorderConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * @return The number of segments, or 0 if the device isn't open
+		 */
+		inline uint32_t getNumOfSegments() const { return m_NumOfSegments; }
+
+		/**
+		 * @return True if the memory was allocated from huge pages
+		 */
+		inline bool isUsingHugePages() const { return m_UsingHugePages; }
+
+		/**
+		 * Record a packet. May be called by one thread at a time for each producer ID
+		 * @param[in] rawPacket The packet
+		 * @param[in] producerId The ID of the calling producer, smaller than FlightRecorderConfiguration#numOfProducers. Default is 0
+		 * @return True if the packet was recorded, false if the device isn't open, the producer ID is invalid or the packet was dropped
+		 */
+		bool recordPacket(const RawPacket& rawPacket, uint16_t producerId = 0);
+
+		/**
+		 * Record packets. May be called by one thread at a time for each producer ID
+		 * @param[in] rawPacketsArr An array of packets
+		 * @param[in] arrLength The number of packets in the array
+		 * @param[in] producerId The ID of the calling producer, smaller than FlightRecorderConfiguration#numOfProducers. Default is 0
+		 * @return The number of packets recorded
+		 */
+		int recordPackets(const RawPacket* rawPacketsArr, int arrLength, uint16_t producerId = 0);
+
+		/**
+		 * Record the packets of a packet vector. May be called by one thread at a time for each producer ID
+		 * @param[in] rawPackets The packets
+		 * @param[in] producerId The ID of the calling producer, smaller than FlightRecorderConfiguration#numOfProducers. Default is 0
+		 * @return The number of packets recorded
+		 */
+		int recordPackets(const RawPacketVector& rawPackets, uint16_t producerId = 0);
+
+		/**
+		 * Start a dump of the packets in memory on a background thread. Recording continues while the dump runs
+		 * @param[in] request The file, time window and filter of the dump
+		 * @return True if the dump was started, false if the device isn't open, another dump is running or wasn't collected with
+		 * waitForDump(), or the filter can't be compiled (an error is printed to log)
+		 */
+		bool triggerDump(const FlightRecorderDumpRequest& request);
+
+		/**
+		 * @return True if a dump was started and didn't finish writing yet
+		 */
+		bool isDumpInProgress() const;
+
+		/**
+		 * Wait for the dump started by triggerDump() to finish and get its result. Another dump can be triggered afterwards
+		 * @param[out] result The result of the dump
+		 * @return True if a dump was started, false otherwise
+		 */
+		bool waitForDump(FlightRecorderDumpResult& result);
+
+		/**
+		 * Get the recording statistics since the device was opened. When producers are still recording the values may already be outdated
+		 * @param[out] stats The object the statistics are written to
+		 */
+		void getStatistics(FlightRecorderStats& stats) const;
+
+		/**
+		 * Report the getStatistics() counters to a MetricsRegistry snapshot: pcpp_device_rx_packets_total, pcpp_device_rx_bytes_total,
+		 * pcpp_device_rx_dropped_packets_total and pcpp_device_flight_recorder_overwritten_segments_total
+		 * @param[in] writer The writer to report the values to
+		 */
+		void collectMetrics(MetricsWriter& writer);
+
+		/**
+		 * A PcapLiveDevice#startCapture() callback which records each captured packet as producer 0
+		 * @param[in] packet The captured packet
+		 * @param[in] pDevice The capturing device
+		 * @param[in] userCookie A pointer to the FlightRecorderDevice instance
+		 */
+		static void onPacketArrives(RawPacket* packet, PcapLiveDevice* pDevice, void* userCookie);
+
+		/**
+		 * A PcapLiveDevice#startCaptureBurstMode() callback which records each burst of captured packets as producer 0
+		 * @param[in] packets The captured packets
+		 * @param[in] numOfPackets The number of captured packets
+		 * @param[in] pDevice The capturing device
+		 * @param[in] userCookie A pointer to the FlightRecorderDevice instance
+		 */
+		static void onPacketsArriveBurst(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* pDevice, void* userCookie);
+
+		// implement abstract methods
+
+		/**
+		 * Allocate the memory of the recorder
+		 * @return True if the device was opened, false if it's already open, the configuration is invalid or the memory can't be allocated
+		 * (an error is printed to log)
+		 */
+		bool open();
+
+		/**
+		 * Cancel a running dump and free the memory. No thread should record packets while the device is closed
+		 */
+		void close();
+
+	private:
+
+		struct SegmentState;
+		struct ProducerState;
+
+		FlightRecorderConfiguration m_Config;
+		uint8_t* m_Memory;
+		size_t m_MemorySize;
+		bool m_UsingHugePages;
+		uint32_t m_NumOfSegments;
+		SegmentState* m_Segments;
+		ProducerState* m_Producers;
+		// the sequence number of the next segment taken by a producer
+		volatile uint64_t m_NextSegmentSequence;
+
+		// the running dump
+		pthread_t m_DumpThread;
+		bool m_DumpStarted;
+		volatile size_t m_DumpDone;
+		volatile size_t m_CancelDump;
+		FlightRecorderDumpRequest m_DumpRequest;
+		FlightRecorderDumpResult m_DumpResult;
+		BpfFilterProgram m_DumpFilter;
+		uint64_t m_DumpStartNs;
+		uint64_t m_DumpEndNs;
+
+		bool appendPacket(const RawPacket& rawPacket, ProducerState& producer);
+		bool takeSegment(ProducerState& producer);
+		static void* dumpThreadMain(void* recorderPtr);
+		void dump();
+		bool dumpSegment(uint32_t segmentIndex, uint64_t sequence, uint8_t* copyBuffer, IFileWriterDevice* writer);
+
+		// disable copy c'tor and assignment operator
+		FlightRecorderDevice(const FlightRecorderDevice& other);
+		FlightRecorderDevice& operator=(const FlightRecorderDevice& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_FLIGHT_RECORDER_DEVICE */
@@ -121,6 +121,7 @@ namespace pcpp
 	{
 		friend class KniDeviceList;
 		friend class MBufRawPacket;
+		friend class DpdkForwarder;
 	public:
 		/**
 		 * Various link related constants for KNI device
@@ -594,6 +595,19 @@ namespace pcpp
 		 * Stop a currently running asynchronous packet capture.
 		 */
 		void stopCapture();
+		/**
+		 * @brief Receive one burst of packets in the calling thread and pass it to a callback.
+		 * This lets a thread which already runs a loop, such as a DpdkWorkerThread serving DPDK devices (see also KniWorkerThread),
+		 * serve KNI devices in the same loop instead of running a capture thread per KNI device. The callback is called only if packets
+		 * were received, and the mbufs of the burst are freed when it returns unless MBufRawPacket#setFreeMbuf(false) was called for them
+		 * (for example because they were sent). The return value of the callback is ignored.
+		 * Only one thread may poll a device at a time, and a device can't be polled while capturing.
+		 * @note Kernel requests aren't handled by this method, see handleRequests() and KniDeviceList#startRequestHandlerThread()
+		 * @param[in] onPacketArrives A callback that is called with the received burst
+		 * @param[in] onPacketArrivesUserCookie A pointer to a user provided object, which is passed to the callback
+		 * @return The number of packets received. If an error occurred 0 will be returned and the error will be printed to log
+		 */
+		uint16_t pollPackets(OnKniPacketArriveCallback onPacketArrives, void* onPacketArrivesUserCookie);
 
 		/* Device control */
 
@@ -613,6 +627,11 @@ namespace pcpp
 	private:
 		struct rte_kni* m_Device;
 		struct rte_mempool* m_MBufMempool;
+
+		// bind a received burst to the given packet objects, pass it to the callback and free the mbufs the user didn't keep
+		bool dispatchBurst(struct rte_mbuf** mBufArray, uint32_t numOfPackets, MBufRawPacket* rawPackets, timespec time,
+			OnKniPacketArriveCallback onPacketArrives, void* onPacketArrivesUserCookie);
+
 		struct KniDeviceInfo
 		{
 			LinuxNicInformationSocket soc;
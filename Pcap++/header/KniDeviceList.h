@@ -2,6 +2,8 @@
 #define PCAPPP_KNI_DEVICE_LIST
 
 #include <vector>
+#include <time.h>
+#include <pthread.h>
 
 #include "KniDevice.h"
 #include "DpdkDeviceList.h"
@@ -104,6 +106,34 @@ namespace pcpp
 		 */
 		KniDevice* getDeviceByName(const std::string& name);
 
+		/* Requests */
+
+		/**
+		 * @brief Starts one thread which handles the kernel requests of all KNI devices in the list.
+		 * Instead of a request handler thread per device (see KniDevice#startRequestHandlerThread()) the requests of all devices are
+		 * handled in batches: each time the thread wakes up it handles the pending requests of every device, then sleeps again. The
+		 * thread can be bound to a dedicated housekeeping core and run in the lowest scheduling priority (SCHED_IDLE), so it never
+		 * competes with the cores which process packets. Devices which run their own request handler thread are skipped, as the
+		 * requests of a device mustn't be handled by two threads.
+		 * Devices mustn't be created or destroyed while the thread runs.
+		 * @param[in] sleepSeconds Sleeping time between batches in seconds
+		 * @param[in] sleepNanoSeconds Sleeping time between batches in nanoseconds
+		 * @param[in] coreId The core to bind the thread to, or -1 to let the OS schedule it on any core. Default value is -1
+		 * @param[in] lowPriority Whether to run the thread in the SCHED_IDLE scheduling policy. Default value is true
+		 * @return true if the thread was started, false if it's already running, the core ID is invalid or the thread couldn't be
+		 * created (an error is printed to log)
+		 */
+		bool startRequestHandlerThread(long sleepSeconds, long sleepNanoSeconds = 0, int coreId = -1, bool lowPriority = true);
+		/**
+		 * Stops the request handler thread started by startRequestHandlerThread() and waits for it to exit. Called implicitly on
+		 * destruction
+		 */
+		void stopRequestHandlerThread();
+		/**
+		 * @return true if the request handler thread started by startRequestHandlerThread() is running
+		 */
+		inline bool isRequestHandlerThreadRunning() const { return m_RequestThreadRunning; }
+
 		/* Static information */
 
 		/**
@@ -122,6 +152,71 @@ namespace pcpp
 		std::vector<KniDevice*> m_Devices;
 		bool m_Initialized;
 		int m_KniUniqueId;
+
+		pthread_t m_RequestThread;
+		bool m_RequestThreadRunning;
+		volatile bool m_StopRequestThread;
+		struct timespec m_RequestThreadSleepTime;
+
+		static void* runRequests(void* listPointer);
+	};
+
+	/**
+	 * @class KniWorkerThread
+	 * A DpdkWorkerThread which serves a set of KNI devices in a busy loop on a DPDK core: it polls each device for bursts of packets
+	 * coming from the kernel (see KniDevice#pollPackets()) and passes them to a callback, and from time to time handles the kernel
+	 * requests of the devices. Spreading the KNI devices of an application between several workers (started with
+	 * DpdkDeviceList#startDpdkWorkerThreads()) processes the exception path to the kernel on several cores. As each KNI device has a
+	 * single RX and TX queue, a device must be served by one worker only; to spread the traffic of one port between cores create several
+	 * KNI devices for it (with the rte_kni kernel module loaded in "kthread_mode=multiple" each gets its own kernel thread, which can be
+	 * bound to a core with KniDevice#KniDeviceConfiguration#bindKthread).
+	 * Worker classes which need more than polling can call KniDevice#pollPackets() from their own DpdkWorkerThread#run() loop instead
+	 */
+	class KniWorkerThread : public DpdkWorkerThread
+	{
+	public:
+		/**
+		 * A c'tor for this class
+		 * @param[in] devices The KNI devices to serve, which must be opened before the worker runs
+		 * @param[in] onPacketArrives The callback each received burst is passed to, see KniDevice#pollPackets()
+		 * @param[in] onPacketArrivesUserCookie A pointer to a user provided object, which is passed to the callback
+		 * @param[in] loopsPerRequestCheck The number of polling rounds over all devices between two checks for kernel requests, or 0 to
+		 * leave the requests to other threads (see KniDeviceList#startRequestHandlerThread()). Handling a request runs the request
+		 * callbacks of the device on the worker core. Default value is 1024
+		 */
+		KniWorkerThread(const std::vector<KniDevice*>& devices, OnKniPacketArriveCallback onPacketArrives, void* onPacketArrivesUserCookie,
+			uint32_t loopsPerRequestCheck = 1024);
+
+		/**
+		 * Serve the devices until stop() is called
+		 * @param[in] coreId The core ID the worker is running on
+		 * @return True when stopped, or false if a device is NULL or isn't opened or the callback is NULL
+		 */
+		bool run(uint32_t coreId);
+
+		/**
+		 * Make run() return
+		 */
+		void stop();
+
+		/**
+		 * @return The core ID the worker is running on
+		 */
+		uint32_t getCoreId();
+
+		/**
+		 * @return The number of packets the worker received from all its devices
+		 */
+		inline uint64_t getNumOfPacketsReceived() const { return m_NumOfPacketsReceived; }
+
+	private:
+		std::vector<KniDevice*> m_Devices;
+		OnKniPacketArriveCallback m_OnPacketArrives;
+		void* m_OnPacketArrivesUserCookie;
+		uint32_t m_LoopsPerRequestCheck;
+		uint32_t m_CoreId;
+		volatile bool m_Stop;
+		uint64_t m_NumOfPacketsReceived;
 	};
 } // namespace pcpp
 #endif /* PCAPPP_KNI_DEVICE_LIST */
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <time.h>
 #include "Packet.h"
+#include "ChecksumVerifier.h"
 #include "PointerVector.h"
 
 struct rte_mbuf;
@@ -35,33 +36,75 @@ namespace pcpp
 	 *    - Creating MBufRawPacket from scratch (in order to send it with DpdkDevice, for example). In this case the user should call
 	 *      the init() method after constructing the object in order to allocate a new mbuf from DPDK port pool (encapsulated by DpdkDevice)
 	 *
-	 * Limitations of this class:
-	 *    - Currently chained mbufs are not supported. An mbuf has the capability to be linked to another mbuf and create a linked list
-	 *      of mbufs. This is good for Jumbo packets or other uses. MBufRawPacket doesn't support this capability so there is no way to
-	 *      access the mbufs linked to the mbuf wrapped by MBufRawPacket instance. I hope I'll be able to add this support in the future
+	 * An mbuf can be linked to other mbufs (segments) to create a chained mbuf, which is how DPDK represents packets larger than the
+	 * data room of a single mbuf: jumbo frames received with DpdkDevice#OFFLOAD_RX_SCATTER, packets coalesced by
+	 * DpdkDevice#OFFLOAD_RX_TCP_LRO, or packets a header segment was prepended to (see prependHeaderSegment()). RawPacket requires
+	 * contiguous data, so for a chained mbuf the raw data of MBufRawPacket covers only the first segment, while the frame length
+	 * (getFrameLength()) is the length of the whole packet, similar to a packet captured with a snapshot length. The rest of the
+	 * packet can be accessed in one of the following ways:
+	 *    - Scanning the segments in place with getNumOfSegments() and getSegmentData(), without copying any data
+	 *    - Calling linearize(), which makes the raw data cover the whole packet. If the first segment has enough room the segments are
+	 *      merged into it, otherwise the raw data becomes a read-only copy of the packet
+	 *
+	 * Methods which change the data of the packet (appendData(), insertData(), removeData() etc.) aren't supported for chained mbufs.
+	 * Chained mbufs are sent by DpdkDevice as they are, which requires the device to be opened with DpdkDevice#OFFLOAD_TX_MULTI_SEGS
 	 */
 	class MBufRawPacket : public RawPacket
 	{
 		friend class DpdkDevice;
 		friend class KniDevice;
+		friend class DpdkPacketRing;
+		friend class DpdkPipelineStage;
+		friend class DpdkForwarder;
+		friend class DpdkTxAggregator;
+		friend class DpdkEventWorkerThread;
 		static const int MBUF_DATA_SIZE;
 
 	protected:
 		struct rte_mbuf* m_MBuf;
 		struct rte_mempool* m_Mempool;
 		bool m_FreeMbuf;
+		// a copy of the whole packet which the raw data points to after linearize() was called for a chained mbuf it couldn't merge
+		uint8_t* m_LinearizedData;
 
-		void setMBuf(struct rte_mbuf* mBuf, timeval timestamp);
+		void setMBuf(struct rte_mbuf* mBuf, timespec timestamp);
+		// free the mbuf (unless setFreeMbuf(false) was called) and detach it, so the object can be bound to another mbuf with setMBuf()
+		void releaseMBuf();
+		// the same as releaseMBuf() for an array of packets, with the mbufs freed in bulk
+		static void releaseMBufs(MBufRawPacket* packets, uint32_t count);
 		bool init(struct rte_mempool* mempool);
 		bool initFromRawPacket(const RawPacket* rawPacket, struct rte_mempool* mempool);
+		// copy data to the mbuf, which must be empty, and chain more segments from its pool if the data doesn't fit in it
+		bool copyToSegments(const uint8_t* data, size_t dataLen);
+		// point the raw data to the first segment of the mbuf and set the frame length to the length of the whole packet
+		void updateRawDataView();
+		void freeLinearizedData();
+		bool verifySingleSegment() const;
+		// the data size of an mbuf of the pool this packet uses, which depends on the data room the pool was created with
+		int getMBufDataSize() const;
 	public:
 
+		/**
+		 * The result of a checksum validated by the NIC on receive (see DpdkDevice#OFFLOAD_RX_IPV4_CKSUM etc.)
+		 */
+		enum RxChecksumStatus
+		{
+			/** The NIC didn't validate the checksum, it should be validated in software */
+			RxChecksumUnknown,
+			/** The checksum is valid */
+			RxChecksumGood,
+			/** The checksum is invalid */
+			RxChecksumBad,
+			/** The checksum field in the packet isn't valid but the data integrity was verified (mostly by virtual devices) */
+			RxChecksumNone
+		};
+
 		/**
 		 * A default c'tor for this class. Constructs an instance of this class without an mbuf attached to it. In order to allocate
 		 * an mbuf the user should call the init() method. Without calling init() the instance of this class is not usable.
 		 * This c'tor can be used for initializing an array of MBufRawPacket (which requires an empty c'tor)
 		 */
-		MBufRawPacket() : RawPacket(), m_MBuf(NULL), m_Mempool(NULL), m_FreeMbuf(true) { m_DeleteRawDataAtDestructor = false; }
+		MBufRawPacket() : RawPacket(), m_MBuf(NULL), m_Mempool(NULL), m_FreeMbuf(true), m_LinearizedData(NULL) { m_DeleteRawDataAtDestructor = false; }
 
 		/**
 		 * A d'tor for this class. Once called it frees the mbuf attached to it (returning it back to the mbuf pool it was allocated from)
@@ -127,6 +170,56 @@ namespace pcpp
 		 */
 		inline rte_mbuf* getMBuf() { return m_MBuf; }
 
+		/**
+		 * Detach the mbuf from this object and pass its ownership to the caller, without copying the packet. This is the way to keep a
+		 * packet received in an OnDpdkPacketsArriveCallback after the callback returns, for example to queue it to another core or to hold
+		 * it for reassembly: the packets given to the callback free their mbufs when it returns, but not mbufs which were detached. The
+		 * caller frees the mbuf with rte_pktmbuf_free() or freeMBufs(), sends it, or attaches it to another MBufRawPacket with
+		 * attachMBuf(). The timestamp isn't kept in the mbuf, so it should be saved before detaching if it's needed. After detaching, this
+		 * object has no mbuf, as after clear()
+		 * @return The detached mbuf, or NULL if no mbuf is attached or if this object doesn't own its mbuf (see setFreeMbuf(), an error is
+		 * printed to log in that case)
+		 */
+		struct rte_mbuf* detachMBuf();
+
+		/**
+		 * Take another reference to the mbuf, which stays attached to this object. Unlike detachMBuf() the packet stays usable, and the mbuf
+		 * is returned to its pool only after both this object and the holder of the new reference freed it. It suits a packet which is
+		 * processed further but also kept, for example forwarded and held for reassembly. The data is shared, so it shouldn't be changed
+		 * while it has more than one reference
+		 * @return The mbuf with an incremented reference count, which the caller frees with rte_pktmbuf_free() or freeMBufs(), or NULL if no
+		 * mbuf is attached
+		 */
+		struct rte_mbuf* retainMBuf();
+
+		/**
+		 * Attach an mbuf which was detached or retained, or allocated by the user, to this object, which takes ownership of it. The packet
+		 * data isn't copied. An mbuf which was attached before is freed (unless setFreeMbuf(false) was called)
+		 * @param[in] mBuf The mbuf to attach
+		 * @param[in] timestamp The packet timestamp
+		 * @return True if the mbuf was attached, false if it's NULL (an error is printed to log)
+		 */
+		bool attachMBuf(struct rte_mbuf* mBuf, const timespec& timestamp);
+
+		/**
+		 * Detach the mbufs of an array of packets, see detachMBuf(). It's usually called in an OnDpdkPacketsArriveCallback to keep a whole
+		 * burst, for example to enqueue it to an rte_ring which is read by another core
+		 * @param[in] packets The array of packets
+		 * @param[in] count The number of packets in the array
+		 * @param[out] mBufs An array of at least count entries the detached mbufs are written to, in the order of the packets. Packets
+		 * without an mbuf of their own are skipped
+		 * @return The number of mbufs detached
+		 */
+		static uint32_t detachMBufs(MBufRawPacket* packets, uint32_t count, struct rte_mbuf** mBufs);
+
+		/**
+		 * Free detached or retained mbufs, returning them to their pools in bulk where DPDK supports it (DPDK 19.11 and later), which is
+		 * cheaper than freeing them one by one. The mbufs may belong to different pools
+		 * @param[in] mBufs The array of mbufs. NULL entries are ignored
+		 * @param[in] count The number of mbufs in the array
+		 */
+		static void freeMBufs(struct rte_mbuf** mBufs, uint32_t count);
+
 		// overridden methods
 
 		/**
@@ -146,15 +239,17 @@ namespace pcpp
 		 * Set raw data to the mbuf by copying the data to it. In order to stay compatible with the ancestor method
 		 * which takes control of the data pointer and frees it when RawPacket is destroyed, this method frees this pointer right away after
 		 * data is copied to the mbuf. So when using this method please notice that after it's called pRawData memory is free, don't
-		 * use this pointer again. In addition, if raw packet isn't initialized (mbuf is NULL), this method will call the init() method
+		 * use this pointer again. In addition, if raw packet isn't initialized (mbuf is NULL), this method will call the init() method.
+		 * If the data is larger than the mbuf data room, the mbuf is replaced by a chained mbuf allocated from the same pool, and the
+		 * raw data covers only its first segment (see the class description)
 		 * @param[in] pRawData A pointer to the new raw data
 		 * @param[in] rawDataLen The new raw data length in bytes
 		 * @param[in] timestamp The timestamp packet was received by the NIC
 		 * @param[in] layerType The link layer type for this raw data. Default is Ethernet
 		 * @param[in] frameLength When reading from pcap files, sometimes the captured length is different from the actual packet length. This parameter represents the packet
 		 * length. This parameter is optional, if not set or set to -1 it is assumed both lengths are equal
-		 * @return True if raw data was copied to the mbuf successfully, false if rawDataLen is larger than mbuf max size, if initialization
-		 * failed or if copying the data to the mbuf failed. In all of these cases an error will be printed to log
+		 * @return True if raw data was copied to the mbuf successfully, false if initialization failed or if copying the data to the mbuf
+		 * failed (for example if there aren't enough mbufs in the pool). In all of these cases an error will be printed to log
 		 */
 		bool setRawData(const uint8_t* pRawData, int rawDataLen, timeval timestamp, LinkLayerType layerType = LINKTYPE_ETHERNET, int frameLength = -1);
 
@@ -174,7 +269,9 @@ namespace pcpp
 		/**
 		 * Insert raw data at some index of the current data and shift the remaining data to the end. This method uses the
 		 * same mbuf already allocated and tries to append more space to it. Then it just copies dataToAppend at the relevant index and shifts
-		 * the remaining data to the end. If MBufRawPacket is not initialize (mbuf is NULL) or mbuf append failed an error is printed to log
+		 * the remaining data to the end. If the mbuf headroom is large enough, the space is prepended to the mbuf instead (using
+		 * rte_pktmbuf_prepend()) and only the data before the index is shifted. If MBufRawPacket is not initialize (mbuf is NULL) or mbuf
+		 * append failed an error is printed to log
 		 * @param[in] atIndex The index to insert the new data to
 		 * @param[in] dataToInsert A pointer to the new data to insert
 		 * @param[in] dataToInsertLen Length in bytes of dataToInsert
@@ -183,7 +280,8 @@ namespace pcpp
 
 		/**
 		 * Remove certain number of bytes from current raw data buffer. All data after the removed bytes will be shifted back. This method
-		 * uses the mbuf already allocated and tries to trim space from it
+		 * uses the mbuf already allocated and tries to trim space from it. If there is less data before the removed bytes than after them,
+		 * the data before them is shifted forward instead and the space is returned to the mbuf headroom (using rte_pktmbuf_adj())
 		 * @param[in] atIndex The index to start removing bytes from
 		 * @param[in] numOfBytesToRemove Number of bytes to remove
 		 * @return True if all bytes were removed successfully, or false if MBufRawPacket is not initialize (mbuf is NULL), mbuf trim
@@ -199,12 +297,174 @@ namespace pcpp
 		 */
 		bool reallocateData(size_t newBufferLength);
 
+		/**
+		 * @return The headroom of the mbuf (see rte_pktmbuf_headroom()), or 0 if MBufRawPacket is not initialized (mbuf is NULL)
+		 */
+		size_t getHeadroom() const;
+
+		/**
+		 * Make sure the mbuf has a certain headroom. No memory is allocated: if the current headroom is too small, the data is moved inside
+		 * the mbuf towards its end, which is possible only if the mbuf has a single segment and enough tailroom
+		 * @param[in] headroom The number of bytes to reserve before the data
+		 * @param[in] newBufferLength The buffer length to keep from the beginning of the data. If it's smaller than the data length, the data
+		 * length is used. Default value is 0
+		 * @return True if the mbuf has the requested headroom, false otherwise (an error is printed to log)
+		 */
+		bool reserveHeadroom(size_t headroom, size_t newBufferLength = 0);
+
 		/**
 		 * Set an indication whether to free the mbuf when done using it or not ("done using it" means setting another mbuf or class d'tor).
 		 * Default value is true.
 		 * @param[in] val The value to set. True means free the mbuf when done using it. Default it True
 		 */
 		inline void setFreeMbuf(bool val = true) { m_FreeMbuf = val; }
+
+		/**
+		 * Get the mark a flow rule of the receiving DpdkDevice set on the packet (see DpdkFlowRule#setMark)
+		 * @param[out] mark The mark of the packet, set only if the packet was marked
+		 * @return True if the packet was marked, false if it wasn't or MBufRawPacket isn't initialized (mbuf is NULL)
+		 */
+		bool getFlowMark(uint32_t& mark) const;
+
+		/**
+		 * @return The offload flags of the mbuf (DPDK's rte_mbuf::ol_flags), which hold the results of the RX offloads and the TX offloads
+		 * requested for the packet, or 0 if MBufRawPacket isn't initialized (mbuf is NULL)
+		 */
+		uint64_t getOffloadFlags() const;
+
+		/**
+		 * Set the offload flags of the mbuf (DPDK's rte_mbuf::ol_flags). This is a low-level method for offloads which aren't covered by
+		 * the other methods of this class, the user is responsible for setting the rest of the mbuf metadata the offloads require
+		 * @param[in] flags The flags to set
+		 */
+		void setOffloadFlags(uint64_t flags);
+
+		/**
+		 * @return The IPv4 header checksum status the NIC reported on receive. It's RxChecksumUnknown unless the receiving DpdkDevice
+		 * was opened with DpdkDevice#OFFLOAD_RX_IPV4_CKSUM and the packet is IPv4
+		 */
+		RxChecksumStatus getRxIPChecksumStatus() const;
+
+		/**
+		 * @return The TCP or UDP checksum status the NIC reported on receive. It's RxChecksumUnknown unless the receiving DpdkDevice
+		 * was opened with DpdkDevice#OFFLOAD_RX_TCP_CKSUM or DpdkDevice#OFFLOAD_RX_UDP_CKSUM and the packet is TCP or UDP
+		 */
+		RxChecksumStatus getRxL4ChecksumStatus() const;
+
+		/**
+		 * Load a burst of received packets into a ChecksumVerifier, passing the checksum statuses the NIC reported (see
+		 * getRxIPChecksumStatus() and getRxL4ChecksumStatus()) as hints, so only the checksums the NIC didn't validate are computed in
+		 * software. A status of RxChecksumNone is taken as valid
+		 * @param[in] verifier The verifier to load
+		 * @param[in] packets An array of pointers to the packets
+		 * @param[in] count The number of packets in the array
+		 * @return The number of packets loaded. It's smaller than count only if count exceeds ChecksumVerifier#MaxBurstSize
+		 */
+		static size_t loadChecksumVerifier(ChecksumVerifier& verifier, MBufRawPacket* const* packets, size_t count);
+
+		/**
+		 * Get the VLAN tag the NIC stripped from the packet on receive (see DpdkDevice#OFFLOAD_RX_VLAN_STRIP)
+		 * @param[out] vlanTci The TCI of the stripped VLAN tag in host byte order, set only if a tag was stripped
+		 * @return True if a VLAN tag was stripped, false otherwise
+		 */
+		bool getRxStrippedVlan(uint16_t& vlanTci) const;
+
+		/**
+		 * Get the timestamp the NIC set on the packet on receive (see DpdkDevice#OFFLOAD_RX_TIMESTAMP)
+		 * @param[out] timestamp The timestamp, in units of the NIC clock which are device specific. Set only if the packet has a timestamp
+		 * @return True if the packet has a hardware timestamp, false otherwise
+		 */
+		bool getRxHardwareTimestamp(uint64_t& timestamp) const;
+
+		/**
+		 * Request the NIC to compute the checksums of an IPv4 or IPv6 packet when it's sent, instead of computing them in software. The
+		 * packet is parsed to set the header lengths in the mbuf, and the checksum fields are prepared as the NIC expects them, so this
+		 * method should be called after all changes to the packet and replaces Packet#computeCalculateFields() for the checksums. The
+		 * sending DpdkDevice must be opened with the matching offloads (DpdkDevice#OFFLOAD_TX_IPV4_CKSUM, DpdkDevice#OFFLOAD_TX_TCP_CKSUM,
+		 * DpdkDevice#OFFLOAD_TX_UDP_CKSUM)
+		 * @param[in] ipChecksum Request the IPv4 header checksum. Ignored for IPv6 packets. Default value is true
+		 * @param[in] l4Checksum Request the TCP or UDP checksum. Default value is true
+		 * @return True if the offloads were requested, false if MBufRawPacket isn't initialized, the packet isn't IPv4 or IPv6, or the
+		 * L4 checksum was requested for a packet which isn't TCP or UDP
+		 */
+		bool setTxChecksumOffload(bool ipChecksum = true, bool l4Checksum = true);
+
+		/**
+		 * Request the NIC to split a TCP packet larger than the MSS into segments when it's sent (TSO). The NIC also computes the IPv4 and
+		 * TCP checksums of the segments. Like setTxChecksumOffload(), should be called after all changes to the packet. The sending
+		 * DpdkDevice must be opened with DpdkDevice#OFFLOAD_TX_TCP_TSO
+		 * @param[in] segmentSize The maximum TCP payload size of each segment (MSS)
+		 * @return True if TSO was requested, false if MBufRawPacket isn't initialized, the packet isn't TCP over IPv4 or IPv6 or segmentSize
+		 * is 0
+		 */
+		bool setTxTcpSegmentation(uint16_t segmentSize);
+
+		/**
+		 * Request the NIC to insert a VLAN tag to the packet when it's sent. The sending DpdkDevice must be opened with
+		 * DpdkDevice#OFFLOAD_TX_VLAN_INSERT
+		 * @param[in] vlanTci The TCI of the VLAN tag in host byte order
+		 * @return True if the tag insertion was requested, false if MBufRawPacket isn't initialized
+		 */
+		bool setTxVlanInsert(uint16_t vlanTci);
+
+		/**
+		 * Cancel all TX offloads requested for the packet
+		 */
+		void clearTxOffloads();
+
+		/**
+		 * @return The number of segments of the mbuf, which is 1 unless it's a chained mbuf, or 0 if MBufRawPacket isn't initialized
+		 * (mbuf is NULL)
+		 */
+		size_t getNumOfSegments() const;
+
+		/**
+		 * @return True if the mbuf is a chained mbuf which has more than one segment, false otherwise
+		 */
+		bool isMultiSegment() const;
+
+		/**
+		 * @return The length of the whole packet in all segments of the mbuf, or 0 if MBufRawPacket isn't initialized (mbuf is NULL)
+		 */
+		size_t getPacketLength() const;
+
+		/**
+		 * Get the data of one segment of the mbuf without copying it. Segments are reached by walking the chain from the first one, so
+		 * scanning all segments is quadratic in their number, which is small for the common cases (a 9K jumbo frame in 2K mbufs has 5
+		 * segments)
+		 * @param[in] segmentIndex The index of the segment, 0 is the first segment
+		 * @param[out] segmentLen The length of the data in the segment, set only if the segment exists
+		 * @return A pointer to the data of the segment, or NULL if MBufRawPacket isn't initialized or segmentIndex is out of range
+		 */
+		const uint8_t* getSegmentData(size_t segmentIndex, size_t& segmentLen) const;
+
+		/**
+		 * Make the raw data cover the whole packet, so it can be parsed as one. Does nothing for an mbuf with a single segment. For a
+		 * chained mbuf, if the first segment has enough room the other segments are merged into it and freed, and the packet can be
+		 * changed and sent as usual. Otherwise the raw data becomes a copy of the packet, which should be treated as read-only: changes
+		 * to it aren't reflected in the mbuf. The copy is freed when the mbuf is replaced or freed
+		 * @return True if the raw data covers the whole packet, false if MBufRawPacket isn't initialized (an error is printed to log)
+		 */
+		bool linearize();
+
+		/**
+		 * @return True if the raw data is a read-only copy of a chained mbuf made by linearize(), false otherwise
+		 */
+		inline bool isLinearizedCopy() const { return m_LinearizedData != NULL; }
+
+		/**
+		 * Prepend a header to the packet in a new segment allocated from the pool of the mbuf, which is useful for encapsulation when
+		 * the headroom of the mbuf is too small, or when the packet data shouldn't be touched. The header segment becomes the first
+		 * segment, so the raw data covers only the header afterwards (see the class description). The existing mbuf is freed along
+		 * with the header segment, so if the packet is shared (for example when encapsulating it for several destinations) its
+		 * reference count should be incremented before calling this method. Sending the packet requires the DpdkDevice to be opened
+		 * with DpdkDevice#OFFLOAD_TX_MULTI_SEGS
+		 * @param[in] header A pointer to the header data to copy to the new segment
+		 * @param[in] headerLen The header length in bytes, which must fit in one mbuf
+		 * @return True if the header segment was prepended, false if MBufRawPacket isn't initialized, allocating the segment failed or
+		 * the mbuf already has the maximum number of segments. In all of these cases an error is printed to log
+		 */
+		bool prependHeaderSegment(const uint8_t* header, size_t headerLen);
 	};
 
 	/**
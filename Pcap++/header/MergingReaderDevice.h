@@ -0,0 +1,283 @@
+#ifndef PCAPPP_MERGING_READER_DEVICE
+#define PCAPPP_MERGING_READER_DEVICE
+
+#include "PcapFileDevice.h"
+#include "RawPacketSlabVector.h"
+#include "RawPacketPool.h"
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The default number of packets MergingReaderDevice reads ahead from each input
+ */
+#define PCPP_MERGING_READER_DEFAULT_BATCH_SIZE 256
+
+	/**
+	 * @class MergingReaderDevice
+	 * A file reader device which merges the packets of several file reader devices (for example the captures of several taps, or the
+	 * files of one PcapNG session) into one stream ordered by timestamp, so a merged capture can be read like any single file, without
+	 * merging the files on disk first. The packets of each input are expected to be ordered by timestamp, as captures are.<BR>
+	 * The merge is a k-way merge: the next packet of each input is kept in a binary heap ordered by timestamp, so each packet costs
+	 * O(log N) for N inputs. Packets with the same timestamp are returned in the order of the inputs. Each input is read ahead in
+	 * batches of packets (see RawPacketSlabVector), so the files are read in runs instead of alternating between them on every packet.
+	 * Each packet keeps the link layer type of its input.<BR>
+	 * Opening the device opens the inputs which aren't open yet, and closing it closes all of them. A filter set on the device is set on
+	 * all inputs, and sampling (see IFileReaderDevice#setSampling()) applies to the merged stream. Seeking isn't supported. The inputs
+	 * must outlive the device and mustn't be read from in any other way while it's open
+	 */
+	class MergingReaderDevice : public IFileReaderDevice
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. The inputs aren't opened until open() is called
+		 * @param[in] inputs The file reader devices to merge
+		 * @param[in] batchSize The number of packets read ahead from each input at once. Default value is
+		 * #PCPP_MERGING_READER_DEFAULT_BATCH_SIZE
+		 */
+		MergingReaderDevice(const std::vector<IFileReaderDevice*>& inputs, size_t batchSize = PCPP_MERGING_READER_DEFAULT_BATCH_SIZE);
+
+		/**
+		 * A d'tor for this class. Closes the device and its inputs if they're open
+		 */
+		~MergingReaderDevice();
+
+		/**
+		 * @return The number of inputs
+		 */
+		inline size_t getNumOfInputs() const { return m_Inputs.size(); }
+
+		/**
+		 * @return The index of the input the last packet read with getNextPacket() came from, or -1 if no packet was read yet
+		 */
+		inline int getLastPacketInput() const { return m_LastPacketInput; }
+
+		// overridden methods
+
+		/**
+		 * Read the packet with the earliest timestamp among the next packets of all inputs
+		 * @param[out] rawPacket A reference for a RawPacket the packet is copied to
+		 * @return True if a packet was read, false if the device isn't opened (an error is printed to log) or all inputs reached their end
+		 */
+		bool getNextPacket(RawPacket& rawPacket);
+
+		/**
+		 * Open the inputs which aren't open yet and read the first batch of each of them
+		 * @return True if the device was opened or is already open, false if an input couldn't be opened (an error is printed to log)
+		 */
+		bool open();
+
+		/**
+		 * Close the device and all of its inputs
+		 */
+		void close();
+
+		/**
+		 * Get statistics of packets read so far. ps_recv is the number of merged packets read and ps_drop is the sum of the ps_drop
+		 * counters of the inputs
+		 * @param[out] stats The stats struct where stats are returned
+		 */
+		void getStatistics(pcap_stat& stats);
+
+		using IFileReaderDevice::setFilter;
+
+		/**
+		 * Set a filter on all inputs. Packets read ahead before the filter was set aren't filtered
+		 * @param[in] filterAsString The filter in Berkeley Packet Filter (BPF) syntax
+		 * @return True if the filter was set on all inputs, false otherwise
+		 */
+		bool setFilter(std::string filterAsString);
+
+		/**
+		 * Clear the filters of all inputs
+		 * @return True if the filters were cleared, false otherwise
+		 */
+		bool clearFilter();
+
+	private:
+
+		struct Input
+		{
+			IFileReaderDevice* reader;
+			RawPacketSlabVector batch;
+			size_t nextPacket;
+			bool endOfFile;
+		};
+
+		struct HeapEntry
+		{
+			uint64_t timestamp;
+			size_t input;
+
+			// the heap is a max-heap, so the entry with the earliest timestamp (and the lowest input index among equal timestamps)
+			// is the greatest
+			inline bool operator<(const HeapEntry& other) const
+			{
+				return timestamp > other.timestamp || (timestamp == other.timestamp && input > other.input);
+			}
+		};
+
+		std::vector<Input*> m_Inputs;
+		std::vector<HeapEntry> m_Heap;
+		size_t m_BatchSize;
+		int m_LastPacketInput;
+
+		bool pushNextPacket(size_t inputIndex);
+
+		// disable copy c'tor and assignment operator
+		MergingReaderDevice(const MergingReaderDevice& other);
+		MergingReaderDevice& operator=(const MergingReaderDevice& other);
+	};
+
+
+	/**
+	 * @class TimestampReorderMerger
+	 * Merges the packets of several live sources whose packets are each ordered by timestamp, such as the RX queues of a multi-queue
+	 * device (each polled for bursts of packets), into one stream ordered by timestamp, with a bounded reorder window.<BR>
+	 * Packets are copied in when a burst is added and held in a binary heap ordered by timestamp. A packet is released (passed to the
+	 * callback) once no source can still deliver an earlier packet: when all sources have delivered a packet at least as late, or, so an
+	 * idle source doesn't stall the others, when it's older than the newest timestamp seen by more than the reorder window. It's also
+	 * released when the number of held packets exceeds the limit. A packet which arrives after a later packet was already released is
+	 * passed to the callback right away and counted as late.<BR>
+	 * A merger isn't thread-safe; it's meant to be used by the thread which polls the sources. The merge is only as good as the
+	 * timestamps, so the sources should be timestamped by the same clock (for example by the NIC or by TimestampClock)
+	 */
+	class TimestampReorderMerger
+	{
+	public:
+
+		/**
+		 * A callback invoked with each merged packet
+		 * @param[in] packet The packet. It belongs to the merger and is valid only until the callback returns
+		 * @param[in] sourceId The source the packet was added from
+		 * @param[in] userCookie The cookie given in the c'tor
+		 */
+		typedef void (*OnMergedPacket)(RawPacket& packet, int sourceId, void* userCookie);
+
+		/**
+		 * @struct MergerStats
+		 * The statistics of a TimestampReorderMerger
+		 */
+		struct MergerStats
+		{
+			/** Number of packets released to the callback */
+			uint64_t packets;
+			/** Number of packets released because they were older than the reorder window */
+			uint64_t releasedByWindow;
+			/** Number of packets released because the merger held the maximum number of packets */
+			uint64_t releasedByLimit;
+			/** Number of packets which arrived after a later packet was released */
+			uint64_t latePackets;
+		};
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] numOfSources The number of sources, whose IDs are 0 to numOfSources-1
+		 * @param[in] reorderWindowNs The reorder window in nanoseconds
+		 * @param[in] maxPackets The maximum number of packets held
+		 * @param[in] onMergedPacket The callback to invoke with each merged packet
+		 * @param[in] userCookie A pointer passed to the callback. Default value is NULL
+		 * @param[in] pool A pool to take the data buffers of the copied packets from, or NULL for allocating them on the heap. Default
+		 * value is NULL
+		 */
+		TimestampReorderMerger(int numOfSources, uint64_t reorderWindowNs, size_t maxPackets, OnMergedPacket onMergedPacket,
+				void* userCookie = NULL, RawPacketPool* pool = NULL);
+
+		/**
+		 * A d'tor for this class. Packets which weren't released are discarded, so flush() should be called before
+		 */
+		~TimestampReorderMerger();
+
+		/**
+		 * Add a burst of packets from a source and release the packets which became ready
+		 * @param[in] sourceId The source ID
+		 * @param[in] packets The packets, ordered by timestamp. They're copied, so they can be freed or reused when the method returns
+		 * @param[in] numOfPackets The number of packets
+		 * @return False if the source ID is invalid, true otherwise
+		 */
+		bool addBurst(int sourceId, const RawPacket* packets, int numOfPackets);
+
+		/**
+		 * Same as addBurst(int, const RawPacket*, int) for bursts of packet pointers, as received from DpdkDevice#receivePackets()
+		 * @param[in] sourceId The source ID
+		 * @param[in] packets The packets, ordered by timestamp
+		 * @param[in] numOfPackets The number of packets
+		 * @return False if the source ID is invalid, true otherwise
+		 */
+		bool addBurst(int sourceId, RawPacket* const* packets, int numOfPackets);
+
+		/**
+		 * Tell the merger that a source has no packets up to a point in time, for example when its queue was polled and found empty at
+		 * the current time, so the packets of the other sources up to that time can be released without waiting for the reorder window
+		 * @param[in] sourceId The source ID
+		 * @param[in] timestampNs The time in nanoseconds, by the clock of the packet timestamps
+		 * @return False if the source ID is invalid, true otherwise
+		 */
+		bool advanceSource(int sourceId, uint64_t timestampNs);
+
+		/**
+		 * Release all held packets
+		 */
+		void flush();
+
+		/**
+		 * @return The number of packets held
+		 */
+		inline size_t getNumOfHeldPackets() const { return m_Heap.size(); }
+
+		/**
+		 * Get the statistics of the merger
+		 * @param[out] stats The statistics
+		 */
+		inline void getStatistics(MergerStats& stats) const { stats = m_Stats; }
+
+	private:
+
+		struct HeapEntry
+		{
+			uint64_t timestamp;
+			uint64_t sequence;
+			RawPacket* packet;
+			int sourceId;
+
+			// the heap is a max-heap, so the entry with the earliest timestamp (and the earliest added among equal timestamps) is the greatest
+			inline bool operator<(const HeapEntry& other) const
+			{
+				return timestamp > other.timestamp || (timestamp == other.timestamp && sequence > other.sequence);
+			}
+		};
+
+		std::vector<HeapEntry> m_Heap;
+		// the latest timestamp each source is known to have reached
+		std::vector<uint64_t> m_SourceTimestamps;
+		std::vector<RawPacket*> m_FreePackets;
+		uint64_t m_ReorderWindowNs;
+		size_t m_MaxPackets;
+		OnMergedPacket m_OnMergedPacket;
+		void* m_UserCookie;
+		RawPacketPool* m_Pool;
+		uint64_t m_NextSequence;
+		uint64_t m_NewestTimestamp;
+		uint64_t m_LastReleasedTimestamp;
+		MergerStats m_Stats;
+
+		void addPacket(int sourceId, const RawPacket& packet);
+		void releaseReadyPackets();
+		void releaseTop();
+
+		// disable copy c'tor and assignment operator
+		TimestampReorderMerger(const TimestampReorderMerger& other);
+		TimestampReorderMerger& operator=(const TimestampReorderMerger& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_MERGING_READER_DEVICE */
@@ -0,0 +1,248 @@
+#ifndef PCAPPP_MULTI_FILE_WRITER
+#define PCAPPP_MULTI_FILE_WRITER
+
+#include "RawPacket.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/// @file
+
+/**
+ * The default total size of the packets MultiFileWriter buffers for all files together
+ */
+#define PCPP_MULTI_FILE_WRITER_DEFAULT_MEMORY_BUDGET (64 * 1024 * 1024)
+
+/**
+ * The default size of the chunks MultiFileWriter buffers packets in
+ */
+#define PCPP_MULTI_FILE_WRITER_DEFAULT_CHUNK_SIZE (64 * 1024)
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct MultiFileWriterConfiguration
+	 * A structure for configuring MultiFileWriter
+	 */
+	struct MultiFileWriterConfiguration
+	{
+		/** The total size in bytes of the packets buffered for all files together. When it's reached, the file with the most buffered data
+		 * is written to the disk to make room
+		 */
+		size_t memoryBudget;
+
+		/** The size in bytes of the chunks packets are buffered in. Every file with buffered packets holds at least one chunk, so with many
+		 * files a smaller chunk makes better use of the memory budget, and a larger chunk makes fewer and larger writes
+		 */
+		size_t chunkSize;
+
+		/** The maximum number of files kept open at the same time. When it's reached, the least recently written file is closed and it's
+		 * reopened for appending when it's written again
+		 */
+		size_t maxOpenFiles;
+
+		/** The flag indicating whether the files are written in the nanosecond pcap format
+		 */
+		bool nanosecondsPrecision;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] memoryBudget The total size of the packets buffered for all files. The default is
+		 * #PCPP_MULTI_FILE_WRITER_DEFAULT_MEMORY_BUDGET
+		 * @param[in] maxOpenFiles The maximum number of files kept open at the same time. The default is 250, which is within the limits of
+		 * all OS's
+		 * @param[in] chunkSize The size of the chunks packets are buffered in. The default is #PCPP_MULTI_FILE_WRITER_DEFAULT_CHUNK_SIZE
+		 */
+		MultiFileWriterConfiguration(size_t memoryBudget = PCPP_MULTI_FILE_WRITER_DEFAULT_MEMORY_BUDGET, size_t maxOpenFiles = 250,
+				size_t chunkSize = PCPP_MULTI_FILE_WRITER_DEFAULT_CHUNK_SIZE) :
+			memoryBudget(memoryBudget), chunkSize(chunkSize), maxOpenFiles(maxOpenFiles), nanosecondsPrecision(false)
+		{
+		}
+	};
+
+
+	/**
+	 * @class MultiFileWriter
+	 * Writes packets to a large number of pcap files at the same time, such as a file per connection when splitting a capture, without
+	 * opening and closing a file for every few packets. Instead of a file writer device per file:
+	 * - Every file buffers its packets in memory, in chunks taken from a pool shared by all files. When the pool reaches the memory budget,
+	 *   the file with the most buffered data is written to the disk, which makes the fewest, largest writes for the memory used
+	 * - A bounded number of files is kept open. When a file is written and the limit is reached, the least recently written file is closed
+	 * - All chunks of a file are written with a single writev() call (on Windows a write per chunk)
+	 *
+	 * Finding the file with the most buffered data, and the least recently written file, take constant time however many files there are.
+	 * Files are created (overwriting existing files) the first time they're written to the disk, and the files which weren't written yet
+	 * are written when close() is called:
+	 *
+	 *     MultiFileWriter writer;
+	 *     int fileId = writer.addFile("connection-1.pcap");
+	 *     writer.writePacket(fileId, rawPacket);
+	 *     ...
+	 *     writer.close();
+	 *
+	 * This class isn't thread safe
+	 */
+	class MultiFileWriter
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The configuration. The default is MultiFileWriterConfiguration()
+		 */
+		MultiFileWriter(const MultiFileWriterConfiguration& config = MultiFileWriterConfiguration());
+
+		/**
+		 * A d'tor for this class. Writes all buffered packets and closes the files
+		 */
+		~MultiFileWriter();
+
+		/**
+		 * Add a file. The file isn't created until packets are written to the disk or close() is called
+		 * @param[in] fileName The full path of the file
+		 * @param[in] linkLayerType The link layer type of the file's packets. The default is Ethernet
+		 * @return The file ID to pass to writePacket(), or -1 if the writer is closed (an error will be printed to log)
+		 */
+		int addFile(const std::string& fileName, LinkLayerType linkLayerType = LINKTYPE_ETHERNET);
+
+		/**
+		 * Buffer a packet for writing to a file. This may write the file with the most buffered data to the disk to make room
+		 * @param[in] fileId The file ID returned by addFile()
+		 * @param[in] packet The packet to write
+		 * @return False if the file ID isn't valid, if the packet's link layer type isn't the file's or if writing a file to the disk failed
+		 * (an error will be printed to log), true otherwise
+		 */
+		bool writePacket(int fileId, RawPacket const& packet);
+
+		/**
+		 * Write the buffered packets of a file to the disk
+		 * @param[in] fileId The file ID returned by addFile()
+		 * @return False if the file ID isn't valid or the file couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool flush(int fileId);
+
+		/**
+		 * Write the buffered packets of all files to the disk
+		 * @return False if at least one file couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool flushAll();
+
+		/**
+		 * Write the buffered packets of all files to the disk, create the files no packets were written to and close all files. No files
+		 * can be added or written after the writer is closed
+		 * @return False if at least one file couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool close();
+
+		/**
+		 * @return The number of files added
+		 */
+		inline size_t getNumOfFiles() const { return m_Files.size(); }
+
+		/**
+		 * @param[in] fileId The file ID returned by addFile()
+		 * @return The full path of the file
+		 */
+		inline const std::string& getFileName(int fileId) const { return m_Files.at(fileId).name; }
+
+		/**
+		 * @return The number of bytes buffered for all files which weren't written to the disk yet
+		 */
+		inline uint64_t getNumOfBufferedBytes() const { return m_NumOfBufferedBytes; }
+
+		/**
+		 * @return The number of packets accepted by writePacket()
+		 */
+		inline uint64_t getNumOfPacketsWritten() const { return m_NumOfPacketsWritten; }
+
+		/**
+		 * @return The number of packets rejected by writePacket()
+		 */
+		inline uint64_t getNumOfPacketsNotWritten() const { return m_NumOfPacketsNotWritten; }
+
+		/**
+		 * @return The number of times files were opened, including reopening files for appending after they were closed
+		 */
+		inline uint64_t getNumOfFileOpens() const { return m_NumOfFileOpens; }
+
+		/**
+		 * @return The number of write system calls made
+		 */
+		inline uint64_t getNumOfWriteCalls() const { return m_NumOfWriteCalls; }
+
+	private:
+		struct Chunk
+		{
+			Chunk* next;
+			size_t len;
+			uint8_t* data;
+		};
+
+		struct FileData
+		{
+			std::string name;
+			LinkLayerType linkLayerType;
+			// the file descriptor, or -1 if the file isn't open
+			int fd;
+			// whether the file was created, so it's reopened for appending
+			bool created;
+			Chunk* firstChunk;
+			Chunk* lastChunk;
+			size_t numOfChunks;
+			uint64_t numOfBufferedBytes;
+			// the links of the open files list, most recently written first
+			int prevOpen;
+			int nextOpen;
+			// the links of the list of the files with the same number of chunks
+			int prevInBucket;
+			int nextInBucket;
+		};
+
+		MultiFileWriterConfiguration m_Config;
+		std::vector<FileData> m_Files;
+		bool m_Closed;
+
+		// the chunks which hold no packets, and the number of chunks allocated so far
+		Chunk* m_FreeChunks;
+		size_t m_NumOfChunks;
+		size_t m_MaxNumOfChunks;
+
+		// the files with buffered packets by their number of chunks, the first file in each bucket or -1 if it's empty. No bucket above
+		// m_LargestBucket holds files
+		std::vector<int> m_Buckets;
+		size_t m_LargestBucket;
+
+		// the open files, most recently written first
+		int m_OpenFilesHead;
+		int m_OpenFilesTail;
+		size_t m_NumOfOpenFiles;
+
+		uint64_t m_NumOfBufferedBytes;
+		uint64_t m_NumOfPacketsWritten;
+		uint64_t m_NumOfPacketsNotWritten;
+		uint64_t m_NumOfFileOpens;
+		uint64_t m_NumOfWriteCalls;
+
+		bool isValidFileId(int fileId) const;
+		Chunk* acquireChunk(bool& writeFailed);
+		bool appendToFile(int fileId, const uint8_t* data, size_t len);
+		void addToBucket(int fileId);
+		void removeFromBucket(int fileId);
+		bool openFile(int fileId);
+		void closeFile(int fileId);
+		void unlinkOpenFile(int fileId);
+		bool writeFile(int fileId);
+
+		// disable copy c'tor and assignment operator
+		MultiFileWriter(const MultiFileWriter& other);
+		MultiFileWriter& operator=(const MultiFileWriter& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_MULTI_FILE_WRITER */
@@ -0,0 +1,232 @@
+#ifndef PCAPPP_MULTI_INTERFACE_PCAPNG_WRITER
+#define PCAPPP_MULTI_INTERFACE_PCAPNG_WRITER
+
+#include "RawPacket.h"
+#include "SPSCQueue.h"
+#include <stdio.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The default number of packets MultiInterfacePcapNgWriter stages per interface
+ */
+#define PCPP_MULTI_INTERFACE_WRITER_DEFAULT_QUEUE_SIZE 4096
+
+	/**
+	 * @struct MultiInterfacePcapNgWriterConfiguration
+	 * A structure for configuring MultiInterfacePcapNgWriter
+	 */
+	struct MultiInterfacePcapNgWriterConfiguration
+	{
+		/** The number of packets each interface can stage before they're written. It's rounded up to a power of 2 */
+		size_t queueSize;
+
+		/** The flag indicating whether writing a packet waits when the staging queue of its interface is full, or drops the packet immediately
+		 * so the capture thread never blocks on the disk
+		 */
+		bool blockWhenFull;
+
+		/** How long a packet may wait for packets of other interfaces, expressed in milliseconds. A packet is written once every other
+		 * interface has a packet waiting, so the file is in timestamp order, or when it has waited this long, so an idle interface doesn't
+		 * hold back the others. Waiting packets are held by the I/O thread, not in the staging queues, so waiting doesn't fill the queues.
+		 * Packets of an interface staged more than this late are written out of order
+		 */
+		uint32_t mergeWindowMs;
+
+		/** How often an Interface Statistics Block is written for every interface, expressed in milliseconds. If the value is set to 0 the
+		 * blocks are written only when the file is closed
+		 */
+		uint32_t statsIntervalMs;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] queueSize The number of packets each interface can stage. The default is #PCPP_MULTI_INTERFACE_WRITER_DEFAULT_QUEUE_SIZE
+		 * @param[in] blockWhenFull The flag indicating whether writing a packet waits when the staging queue is full. The default is false
+		 * @param[in] mergeWindowMs How long a staged packet may wait for packets of other interfaces, in milliseconds. The default is 100
+		 * @param[in] statsIntervalMs How often Interface Statistics Blocks are written, in milliseconds. The default is 1000
+		 */
+		MultiInterfacePcapNgWriterConfiguration(size_t queueSize = PCPP_MULTI_INTERFACE_WRITER_DEFAULT_QUEUE_SIZE, bool blockWhenFull = false,
+				uint32_t mergeWindowMs = 100, uint32_t statsIntervalMs = 1000) :
+			queueSize(queueSize), blockWhenFull(blockWhenFull), mergeWindowMs(mergeWindowMs), statsIntervalMs(statsIntervalMs)
+		{
+		}
+	};
+
+	/**
+	 * @class MultiInterfacePcapNgWriter
+	 * A pcap-ng writer for capturing several interfaces (for example several PcapLiveDevice or DpdkDevice ports) into one file without a
+	 * lock shared by the capture threads. Every interface gets its own Interface Description Block in the file and its own single-producer
+	 * single-consumer staging queue (see pcpp#SPSCQueue), so each capture thread writes its interface's packets without ever waiting for
+	 * another thread. A single I/O thread moves the staged packets out of the queues, merges the packets of all interfaces in timestamp order
+	 * and writes them as Enhanced Packet Blocks, and periodically writes an Interface Statistics Block per interface.
+	 * Timestamps are written in nanosecond resolution. The statistics blocks hold the times the counters cover, the number of packets
+	 * received and dropped by the interface (see setInterfaceStatistics()), the number of packets dropped because the staging queue was
+	 * full and the number of packets written.
+	 * Interfaces are added before the file is opened. While the file is open, writePacket() and setInterfaceStatistics() of an interface
+	 * may be called by one thread at a time, and all capture threads must stop writing before close() is called.
+	 * Please notice files are written uncompressed, and that PcapNgFileReaderDevice reads files of up to 32 interfaces
+	 */
+	class MultiInterfacePcapNgWriter
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. The file isn't created until open() is called
+		 * @param[in] fileName The file name to write to
+		 * @param[in] config The writer configuration
+		 */
+		MultiInterfacePcapNgWriter(const char* fileName, const MultiInterfacePcapNgWriterConfiguration& config = MultiInterfacePcapNgWriterConfiguration());
+
+		/**
+		 * A d'tor for this class, closes the file if it's open
+		 */
+		~MultiInterfacePcapNgWriter();
+
+		/**
+		 * Add an interface, which gets an Interface Description Block in the file. Interfaces can only be added before the file is opened
+		 * @param[in] linkLayerType The link layer type of the interface's packets
+		 * @param[in] name The name of the interface, written as its if_name option. Nothing is written if it's empty. Default is empty
+		 * @param[in] description The description of the interface, written as its if_description option. Nothing is written if it's empty.
+		 * Default is empty
+		 * @param[in] snapshotLength The maximum number of bytes written of each packet. Default is 0, which means packets are written whole
+		 * @return The interface ID to pass to writePacket(), or -1 if the file is already open
+		 */
+		int addInterface(LinkLayerType linkLayerType, const std::string& name = "", const std::string& description = "", uint32_t snapshotLength = 0);
+
+		/**
+		 * @return The number of interfaces added
+		 */
+		inline int getNumOfInterfaces() const { return (int)m_Interfaces.size(); }
+
+		/**
+		 * Create the file, write its section header and interface description blocks and start the I/O thread
+		 * @return True if the file was opened, false if it's already open, no interfaces were added, the file can't be written or the I/O
+		 * thread couldn't be created (an error is printed to log)
+		 */
+		bool open();
+
+		/**
+		 * Write all staged packets and the final statistics blocks, stop the I/O thread and close the file. All capture threads must have
+		 * stopped writing before calling this method
+		 */
+		void close();
+
+		/**
+		 * @return True if the file is open, false otherwise
+		 */
+		inline bool isOpened() const { return m_File != NULL; }
+
+		/**
+		 * @return The name of the file
+		 */
+		inline const std::string& getFileName() const { return m_FileName; }
+
+		/**
+		 * Stage a packet of an interface for writing. The packet is copied, and written by the I/O thread. May be called by one thread at a
+		 * time per interface
+		 * @param[in] interfaceId The interface ID returned by addInterface()
+		 * @param[in] rawPacket The packet to write
+		 * @return True if the packet was staged, false if the file isn't open, the interface ID is invalid or the staging queue is full and
+		 * the writer doesn't block when full
+		 */
+		bool writePacket(int interfaceId, const RawPacket& rawPacket);
+
+		/**
+		 * Set the counters of the interface itself, for example from PcapLiveDevice#getStatistics(), which are written in its next
+		 * statistics block as the isb_ifrecv and isb_ifdrop options. May be called by the thread which writes the interface's packets
+		 * @param[in] interfaceId The interface ID returned by addInterface()
+		 * @param[in] numOfPacketsReceived The number of packets the interface received since the capture started
+		 * @param[in] numOfPacketsDropped The number of packets the interface dropped since the capture started
+		 */
+		void setInterfaceStatistics(int interfaceId, uint64_t numOfPacketsReceived, uint64_t numOfPacketsDropped);
+
+		/**
+		 * @param[in] interfaceId The interface ID returned by addInterface()
+		 * @return The number of packets of the interface dropped because its staging queue was full
+		 */
+		uint64_t getNumOfPacketsDropped(int interfaceId) const;
+
+		/**
+		 * @return The number of packets of all interfaces written to the file so far
+		 */
+		uint64_t getNumOfPacketsWritten() const;
+
+	private:
+
+		struct StagedPacket
+		{
+			// reused for every packet staged in this slot, so staging allocates only while packets grow
+			std::vector<uint8_t> data;
+			uint64_t timestamp;
+			uint32_t originalLength;
+			// when the packet was staged, by TimestampClock
+			uint64_t stagingTime;
+		};
+
+		struct Interface
+		{
+			LinkLayerType linkLayerType;
+			std::string name;
+			std::string description;
+			uint32_t snapshotLength;
+			SPSCQueue<StagedPacket>* queue;
+			// written by the capture thread of the interface
+			volatile uint64_t numOfPacketsDropped;
+			volatile uint64_t deviceNumOfPacketsReceived;
+			volatile uint64_t deviceNumOfPacketsDropped;
+			volatile size_t hasDeviceStatistics;
+			// written by the I/O thread
+			volatile uint64_t numOfPacketsWritten;
+			// the packets the I/O thread moved out of the queue and didn't write yet
+			std::deque<StagedPacket> pendingPackets;
+		};
+
+		enum
+		{
+			// the number of times the idle I/O thread polls the queues before it starts sleeping between polls
+			IdleSpinRounds = 64,
+			// the write buffer is written to the file when it reaches this size, or when the I/O thread is idle
+			WriteBufferSize = 1024 * 1024
+		};
+
+		std::string m_FileName;
+		MultiInterfacePcapNgWriterConfiguration m_Config;
+		std::vector<Interface*> m_Interfaces;
+		FILE* m_File;
+		pthread_t m_IOThread;
+		volatile size_t m_StopRequested;
+		std::vector<uint8_t> m_WriteBuffer;
+		// packet buffers of written packets, which are given back to the queues in exchange for the buffers of staged packets
+		std::vector<std::vector<uint8_t> > m_FreeBuffers;
+		bool m_WriteFailed;
+		uint64_t m_OpenTime;
+
+		static void* ioThreadMain(void* writerPtr);
+		void moveStagedPackets();
+		size_t mergePackets(bool drain);
+		void appendBlock(uint32_t blockType, const uint8_t* body, size_t bodyLen, const std::vector<uint8_t>& options);
+		void writeSectionHeader();
+		void writeInterfaceDescription(const Interface& iface);
+		void writePacketBlock(uint32_t interfaceId, const StagedPacket& packet);
+		void writeStatistics(uint32_t interfaceId, uint64_t now);
+		void flushWriteBuffer();
+
+		// disable copy c'tor and assignment operator
+		MultiInterfacePcapNgWriter(const MultiInterfacePcapNgWriter& other);
+		MultiInterfacePcapNgWriter& operator=(const MultiInterfacePcapNgWriter& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_MULTI_INTERFACE_PCAPNG_WRITER */
@@ -0,0 +1,562 @@
+#ifndef PCAPPP_NATIVE_FILTER
+#define PCAPPP_NATIVE_FILTER
+
+#include "PcapFilter.h"
+#include "PacketView.h"
+#include "HashCounters.h"
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+/**
+ * @file
+ * A filter engine which evaluates GeneralFilter trees natively, without libpcap. A filter is translated (see
+ * GeneralFilter#toNativeFilter()) into a tree of predicates over the headers FlowKeyExtractor parses (see PacketView.h), and the tree is
+ * compiled into a flat program of predicates and jumps, NativeFilterProgram, which matches packets with short-circuit evaluation.
+ * This is the software filter DpdkDevice and PfRingDevice use for filters which can't be offloaded as flow rules, and it can be used
+ * directly to filter packets of any source.
+ *
+ * When many filters are applied to the same packets, for example a filter per customer of a multi-tenant recorder, MultiFilterProgram
+ * compiles all of them together: each distinct predicate is evaluated once per packet no matter how many filters contain it, and the
+ * predicates which test a field for a value (EtherType, IP protocol, IPv4 prefix, port...) are looked up in hash tables by the field
+ * value of the packet instead of being tested one by one
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * The header field tests a native filter is built of. Each predicate is false for packets which don't contain the header its field
+	 * belongs to
+	 */
+	enum NativeFilterPredicateType
+	{
+		/** The packet contains one of the protocols in NativeFilterPredicate#protocols (see PacketView#protocolTypes) */
+		NativeFilterProtocol,
+		/** The IP version of the packet equals NativeFilterPredicate#value */
+		NativeFilterIPVersion,
+		/** The packet is an IPv4 or IPv6 packet whose IP protocol equals NativeFilterPredicate#value */
+		NativeFilterIPProtocol,
+		/** The packet is an IPv4 packet whose source address masked with NativeFilterPredicate#mask equals NativeFilterPredicate#value */
+		NativeFilterSrcIPv4,
+		/** The packet is an IPv4 packet whose destination address masked with NativeFilterPredicate#mask equals NativeFilterPredicate#value */
+		NativeFilterDstIPv4,
+		/** The packet is a TCP or UDP packet whose source port is within NativeFilterPredicate#value and NativeFilterPredicate#upperValue */
+		NativeFilterSrcPort,
+		/** The packet is a TCP or UDP packet whose destination port is within NativeFilterPredicate#value and NativeFilterPredicate#upperValue */
+		NativeFilterDstPort,
+		/** The packet is VLAN tagged and the VLAN ID of its outermost tag equals NativeFilterPredicate#value */
+		NativeFilterVlanId,
+		/** The EtherType of the Ethernet or Linux cooked capture header (not of the VLAN tags) equals NativeFilterPredicate#value */
+		NativeFilterEtherType,
+		/** The packet has an Ethernet header whose source MAC address equals NativeFilterPredicate#macAddress */
+		NativeFilterSrcMac,
+		/** The packet has an Ethernet header whose destination MAC address equals NativeFilterPredicate#macAddress */
+		NativeFilterDstMac,
+		/**
+		 * The packet is an IPv4 packet and the 16-bit field at NativeFilterPredicate#offset of its IPv4 header, compared to
+		 * NativeFilterPredicate#value with NativeFilterPredicate#op, is true
+		 */
+		NativeFilterIPv4Field,
+		/**
+		 * The packet is a TCP packet and the 16-bit field at NativeFilterPredicate#offset of its TCP header, compared to
+		 * NativeFilterPredicate#value with NativeFilterPredicate#op, is true
+		 */
+		NativeFilterTcpField,
+		/**
+		 * The packet is a UDP packet and the 16-bit field at NativeFilterPredicate#offset of its UDP header, compared to
+		 * NativeFilterPredicate#value with NativeFilterPredicate#op, is true
+		 */
+		NativeFilterUdpField,
+		/**
+		 * The packet is a TCP packet and its flags masked with NativeFilterPredicate#mask, compared to NativeFilterPredicate#value with
+		 * NativeFilterPredicate#op, is true
+		 */
+		NativeFilterTcpFlags,
+		/** The packet is an ARP packet whose opcode equals NativeFilterPredicate#value */
+		NativeFilterArpOpcode
+	};
+
+	/**
+	 * @struct NativeFilterPredicate
+	 * A test of one header field of a packet. Which of the members are used depends on the predicate type, see NativeFilterPredicateType.
+	 * Values are in host byte order, except for IPv4 addresses and masks, which are in network byte order (as returned by
+	 * IPv4Address#toInt())
+	 */
+	struct NativeFilterPredicate
+	{
+		/** The predicate type */
+		NativeFilterPredicateType type;
+		/** The operator of field comparisons */
+		FilterOperator op;
+		/** The value the field is compared to, or the lower end of a range */
+		uint32_t value;
+		/** The higher end of a range */
+		uint32_t upperValue;
+		/** The mask applied to the field before it's compared */
+		uint32_t mask;
+		/** The offset of the field from the beginning of its header */
+		uint16_t offset;
+		/** A bitmask of protocols, see ProtocolType */
+		uint64_t protocols;
+		/** A MAC address */
+		uint8_t macAddress[6];
+
+		/**
+		 * A c'tor for this struct which zeroes all members
+		 * @param[in] predicateType The predicate type. Default value is NativeFilterProtocol
+		 */
+		NativeFilterPredicate(NativeFilterPredicateType predicateType = NativeFilterProtocol);
+	};
+
+	/**
+	 * @struct NativeFilterNode
+	 * A node of a native filter tree: either a predicate or a logical operation on other nodes. Filters are translated into such trees by
+	 * GeneralFilter#toNativeFilter() and compiled by NativeFilterProgram#compile(). Like the BPF strings AndFilter and OrFilter produce, an
+	 * "and" or "or" node without children matches all packets
+	 */
+	struct NativeFilterNode
+	{
+		/**
+		 * The node types
+		 */
+		enum NodeType
+		{
+			/** A predicate, kept in #predicate */
+			PredicateNode,
+			/** A logical "and" of #children */
+			AndNode,
+			/** A logical "or" of #children */
+			OrNode,
+			/** A logical "not" of the only child */
+			NotNode
+		};
+
+		/** The node type */
+		NodeType type;
+		/** The predicate of a PredicateNode */
+		NativeFilterPredicate predicate;
+		/** The children of AndNode, OrNode and NotNode nodes */
+		std::vector<NativeFilterNode> children;
+
+		/**
+		 * A c'tor for this struct which creates an "and" node without children, which matches all packets
+		 */
+		NativeFilterNode() : type(AndNode) {}
+
+		/**
+		 * A c'tor for this struct which creates a node of a certain type without children
+		 * @param[in] nodeType The node type
+		 */
+		explicit NativeFilterNode(NodeType nodeType) : type(nodeType) {}
+
+		/**
+		 * A c'tor for this struct which creates a predicate node
+		 * @param[in] nodePredicate The predicate
+		 */
+		explicit NativeFilterNode(const NativeFilterPredicate& nodePredicate) : type(PredicateNode), predicate(nodePredicate) {}
+	};
+
+	/**
+	 * @class NativeFilterProfile
+	 * The counters of the predicates of a NativeFilterProgram, updated by the NativeFilterProgram#matchPacket() overloads which take a
+	 * profile: the number of packets each predicate was tested on, how many of them it matched and the cycles its tests took, measured on
+	 * a sample of the packets. They show which predicates are selective and which are expensive, and NativeFilterProgram#optimize()
+	 * reorders the program by them.<BR>
+	 * A profile isn't thread-safe: threads which match packets with a shared program should each use their own profile and merge them
+	 */
+	class NativeFilterProfile
+	{
+	public:
+		/**
+		 * A c'tor for this class which creates an empty profile
+		 * @param[in] sampleRate The cycles of the predicates are measured on one packet out of this number. Default value is
+		 * #PCPP_FILTER_PROFILE_DEFAULT_SAMPLE_RATE
+		 */
+		NativeFilterProfile(uint32_t sampleRate = PCPP_FILTER_PROFILE_DEFAULT_SAMPLE_RATE);
+
+		/**
+		 * Zero all counters
+		 */
+		void reset();
+
+		/**
+		 * Add the counters of another profile of the same program to the counters of this profile
+		 * @param[in] other The profile to add
+		 * @return True if the counters were added, false if the profiles have a different number of predicates
+		 */
+		bool merge(const NativeFilterProfile& other);
+
+		/**
+		 * @return The number of packets matched with the profile
+		 */
+		inline uint64_t getNumOfPackets() const { return m_NumOfPackets; }
+
+		/**
+		 * @return The number of packets which matched the program
+		 */
+		inline uint64_t getNumOfMatchedPackets() const { return m_NumOfMatchedPackets; }
+
+		/**
+		 * @return The number of predicates counted, which is the number of predicates of the program the profile was used with, or 0 if it
+		 * wasn't used yet
+		 */
+		inline size_t getNumOfPredicates() const { return m_PredicateStats.size(); }
+
+		/**
+		 * @param[in] index The index of the predicate in the program, see NativeFilterProgram#getPredicate()
+		 * @return The counters of the predicate
+		 */
+		inline const FilterNodeStats& getPredicateStats(size_t index) const { return m_PredicateStats[index]; }
+
+	private:
+		friend class NativeFilterProgram;
+
+		std::vector<FilterNodeStats> m_PredicateStats;
+		uint64_t m_NumOfPackets;
+		uint64_t m_NumOfMatchedPackets;
+		uint32_t m_SampleRate;
+		uint32_t m_SampleCountdown;
+	};
+
+	/**
+	 * @class NativeFilterProgram
+	 * A filter compiled into a flat program of predicates, each followed by a jump to the next predicate to test or to the final result.
+	 * When a filter is compiled, nested "and" and "or" nodes are merged and their children are ordered by the estimated cost and selectivity
+	 * of each predicate, so the predicates most likely to decide the result cheaply are tested first and the rest are skipped.<BR>
+	 * Packets are matched against the PacketView FlowKeyExtractor fills, plus a few fields read from the raw data at the header offsets it
+	 * found. This matches the BPF program libpcap compiles from the filter's string with the following differences, all of which follow
+	 * from matching the headers as PcapPlusPlus parses them:
+	 * - Network and transport headers which follow VLAN tags or MPLS labels are matched without having to use VlanFilter or the "vlan" BPF
+	 *   keyword. The EtherType of EtherTypeFilter and ProtoFilter(::ARP) is still the one of the Ethernet header
+	 * - Ports are matched on TCP and UDP only (BPF also matches SCTP), and not on IP fragments
+	 * - The IP protocol of IPv6 packets is the one following all extension headers
+	 *
+	 * Not all filters can be evaluated natively: BPFStringFilter and IPFilter with an IPv6 address can't, and a filter which contains
+	 * them can't either. Matching doesn't allocate memory or change the object, so a program may be shared by threads which match packets
+	 * in parallel.<BR>
+	 * When the static estimates don't fit the traffic, packets can be matched with a NativeFilterProfile to count how selective and
+	 * expensive each predicate actually is, and optimize() compiles the program again in the order the counters suggest
+	 */
+	class NativeFilterProgram
+	{
+	public:
+		/**
+		 * A c'tor for this class which creates an empty program. Use compile() to compile a filter into it
+		 */
+		NativeFilterProgram();
+
+		/**
+		 * Compile a filter into the program, replacing the current program. The program isn't affected by later changes of the filter
+		 * @param[in] filter The filter to compile
+		 * @return True if the filter was compiled, false if it (or a filter it contains) can't be evaluated natively. In that case the
+		 * program is left empty
+		 */
+		bool compile(GeneralFilter& filter);
+
+		/**
+		 * Compile a filter tree into the program, replacing the current program
+		 * @param[in] root The root of the tree
+		 * @return True if the tree was compiled, false if it's invalid (a "not" node which doesn't have exactly one child) or too large.
+		 * In that case the program is left empty
+		 */
+		bool compile(const NativeFilterNode& root);
+
+		/**
+		 * Free the program
+		 */
+		void clear();
+
+		/**
+		 * @return True if a filter is compiled into the program
+		 */
+		inline bool isCompiled() const { return m_Compiled; }
+
+		/**
+		 * @return The number of predicates in the program. A filter which matches all packets or no packet has no predicates
+		 */
+		inline size_t getNumOfPredicates() const { return m_Instructions.size(); }
+
+		/**
+		 * Get a predicate of the program. Predicates are kept in the order they're tested in when none of them is skipped
+		 * @param[in] index The index of the predicate, between 0 and getNumOfPredicates()-1
+		 * @return The predicate
+		 */
+		inline const NativeFilterPredicate& getPredicate(size_t index) const { return m_Instructions[index].predicate; }
+
+		/**
+		 * Compile the filter again, ordering the children of "and" and "or" nodes by the selectivity and cost of their predicates measured
+		 * in a profile instead of by static estimates. Predicates the profile didn't count keep their estimates. The order of the
+		 * predicates may change, so the profile should be reset before it's used with the program again
+		 * @param[in] profile A profile of this program
+		 * @return True if the program was compiled again, false if no filter is compiled or the profile wasn't used with this program
+		 */
+		bool optimize(const NativeFilterProfile& profile);
+
+		/**
+		 * Match a packet whose headers were already parsed
+		 * @param[in] view The headers of the packet, filled by FlowKeyExtractor from packetData
+		 * @param[in] packetData A pointer to the packet data, which fields that aren't kept in the view are read from
+		 * @param[in] packetDataLen The packet data length in bytes
+		 * @return True if the packet matches the program, false if it doesn't or if the program is empty
+		 */
+		bool matchPacket(const PacketView& view, const uint8_t* packetData, size_t packetDataLen) const;
+
+		/**
+		 * Match packet data with the program
+		 * @param[in] packetData A pointer to the packet data, starting at the link layer
+		 * @param[in] packetDataLen The packet data length in bytes
+		 * @param[in] linkType The link layer type of the data. Default value is LINKTYPE_ETHERNET
+		 * @return True if the packet matches the program, false if it doesn't or if the program is empty
+		 */
+		bool matchPacket(const uint8_t* packetData, size_t packetDataLen, LinkLayerType linkType = LINKTYPE_ETHERNET) const;
+
+		/**
+		 * Match a raw packet with the program
+		 * @param[in] rawPacket A pointer to the raw packet
+		 * @return True if the packet matches the program, false if it doesn't or if the program is empty
+		 */
+		bool matchPacket(const RawPacket* rawPacket) const;
+
+		/**
+		 * Match a packet whose headers were already parsed and count the tested predicates in a profile. A profile which was used with
+		 * a program of a different number of predicates is reset first
+		 * @param[in] view The headers of the packet, filled by FlowKeyExtractor from packetData
+		 * @param[in] packetData A pointer to the packet data, which fields that aren't kept in the view are read from
+		 * @param[in] packetDataLen The packet data length in bytes
+		 * @param[in,out] profile The profile to update
+		 * @return True if the packet matches the program, false if it doesn't or if the program is empty
+		 */
+		bool matchPacket(const PacketView& view, const uint8_t* packetData, size_t packetDataLen, NativeFilterProfile& profile) const;
+
+		/**
+		 * Match a raw packet with the program and count the tested predicates in a profile, see the other profiling matchPacket()
+		 * @param[in] rawPacket A pointer to the raw packet
+		 * @param[in,out] profile The profile to update
+		 * @return True if the packet matches the program, false if it doesn't or if the program is empty
+		 */
+		bool matchPacket(const RawPacket* rawPacket, NativeFilterProfile& profile) const;
+
+	private:
+		struct Instruction
+		{
+			NativeFilterPredicate predicate;
+			uint16_t jumpIfTrue;
+			uint16_t jumpIfFalse;
+		};
+
+		std::vector<Instruction> m_Instructions;
+		uint16_t m_EntryPoint;
+		bool m_Compiled;
+		NativeFilterNode m_Root;
+
+		bool compileTree(const NativeFilterNode& root, const std::vector<NativeFilterPredicate>& measuredPredicates,
+			const std::vector<FilterNodeStats>& measuredStats);
+		bool emitNode(const NativeFilterNode& node, uint16_t jumpIfTrue, uint16_t jumpIfFalse, uint16_t& entryPoint);
+
+		friend class MultiFilterProgram;
+	};
+
+	/**
+	 * @class MultiFilterMatches
+	 * The result of matching a packet with a MultiFilterProgram: the IDs of the filters the packet matched, kept as a bitset. An instance
+	 * can be reused for all packets, in which case matching doesn't allocate memory after the first packet. Threads which match packets
+	 * with a shared program should each use their own instance
+	 */
+	class MultiFilterMatches
+	{
+	public:
+		/**
+		 * A c'tor for this class which creates an empty result
+		 */
+		MultiFilterMatches() : m_NumOfMatched(0) {}
+
+		/**
+		 * @param[in] filterId A filter ID returned by MultiFilterProgram#addFilter()
+		 * @return True if the packet matched the filter
+		 */
+		inline bool isMatched(int filterId) const
+		{
+			size_t word = (size_t)filterId / 64;
+			return filterId >= 0 && word < m_Filters.size() && ((m_Filters[word] >> (filterId % 64)) & 1) != 0;
+		}
+
+		/**
+		 * @return The number of filters the packet matched
+		 */
+		inline size_t getNumOfMatched() const { return m_NumOfMatched; }
+
+		/**
+		 * Get the IDs of the filters the packet matched
+		 * @param[out] filterIds A vector which is filled with the IDs, in ascending order
+		 */
+		void getMatchedIds(std::vector<int>& filterIds) const;
+
+		/**
+		 * @return The bitset of matched filters: bit (ID % 64) of word (ID / 64) is set for each filter the packet matched
+		 */
+		inline const std::vector<uint64_t>& getBitset() const { return m_Filters; }
+
+	private:
+		friend class MultiFilterProgram;
+
+		std::vector<uint64_t> m_Filters;
+		std::vector<uint64_t> m_Predicates;
+		size_t m_NumOfMatched;
+	};
+
+	/**
+	 * @class MultiFilterProgram
+	 * A set of filters compiled into a shared decision structure, which matches a packet with all of them at once and returns the IDs of
+	 * the filters it matched (see MultiFilterMatches). It replaces matching the packet with each filter separately, whose cost grows with
+	 * the number of filters even when they test the same few fields.<BR>
+	 * Each filter is compiled as by NativeFilterProgram, and the predicates of all filters are merged into one table of distinct predicates.
+	 * For each packet:
+	 * - The headers are parsed once by FlowKeyExtractor
+	 * - The predicates which compare a field to a single value (IP version, IP protocol, EtherType, VLAN ID, ARP opcode and single ports)
+	 *   are grouped by field into a hash table from the value to the predicates, and IPv4 prefixes are grouped by prefix length into a hash
+	 *   table from the masked address to the predicates. Each group is looked up once with the field of the packet, so these predicates cost
+	 *   one lookup per field and prefix length no matter how many there are
+	 * - The other predicates (port ranges, MAC addresses, header field comparisons, TCP flags) are tested once each
+	 * - The filters are evaluated on the bitset of the predicate results. Filters which compile into the same program share it and are
+	 *   evaluated once
+	 *
+	 * So the cost of a packet depends on the number of distinct predicates and programs, not on the number of filters. Filters which can't
+	 * be evaluated natively (BPFStringFilter, IPFilter with an IPv6 address, or filters which contain them) are compiled into BPF programs
+	 * and matched one by one; their number should be kept small.<BR>
+	 * Matching doesn't change the object, so a program may be shared by threads which match packets in parallel, each with its own
+	 * MultiFilterMatches. Adding filters while other threads match packets isn't safe
+	 */
+	class MultiFilterProgram
+	{
+	public:
+		/**
+		 * A c'tor for this class which creates a program without filters
+		 */
+		MultiFilterProgram();
+
+		/**
+		 * A d'tor for this class
+		 */
+		~MultiFilterProgram();
+
+		/**
+		 * Add a filter to the program. The program isn't affected by later changes of the filter
+		 * @param[in] filter The filter to add
+		 * @param[in] linkType The link type of the packets a filter which can't be evaluated natively is compiled for. Such a filter doesn't
+		 * match packets of other link types. Default value is LINKTYPE_ETHERNET
+		 * @return The ID of the filter, which is the number of filters added before it, or -1 if the filter can't be compiled
+		 */
+		int addFilter(GeneralFilter& filter, LinkLayerType linkType = LINKTYPE_ETHERNET);
+
+		/**
+		 * Add a filter tree to the program
+		 * @param[in] root The root of the tree
+		 * @return The ID of the filter, which is the number of filters added before it, or -1 if the tree is invalid (see
+		 * NativeFilterProgram#compile(const NativeFilterNode&))
+		 */
+		int addFilter(const NativeFilterNode& root);
+
+		/**
+		 * Remove all filters
+		 */
+		void clear();
+
+		/**
+		 * @return The number of filters in the program
+		 */
+		inline size_t getNumOfFilters() const { return m_NumOfFilters; }
+
+		/**
+		 * @return The number of distinct predicates of the filters evaluated natively
+		 */
+		inline size_t getNumOfPredicates() const { return m_Predicates.size(); }
+
+		/**
+		 * @return The number of distinct programs of the filters evaluated natively, which is smaller than the number of these filters if
+		 * some of them compiled into the same program
+		 */
+		inline size_t getNumOfPrograms() const { return m_Programs.size(); }
+
+		/**
+		 * @return The number of filters which couldn't be evaluated natively and are matched with BPF
+		 */
+		inline size_t getNumOfBpfFilters() const { return m_BpfFilters.size(); }
+
+		/**
+		 * Match packet data with all filters
+		 * @param[in] packetData A pointer to the packet data, starting at the link layer
+		 * @param[in] packetDataLen The packet data length in bytes
+		 * @param[in] linkType The link layer type of the data
+		 * @param[out] matches The IDs of the filters the packet matched. Its current content is overridden
+		 * @return The number of filters the packet matched
+		 */
+		size_t matchPacket(const uint8_t* packetData, size_t packetDataLen, LinkLayerType linkType, MultiFilterMatches& matches) const;
+
+		/**
+		 * Match a raw packet with all filters
+		 * @param[in] rawPacket A pointer to the raw packet
+		 * @param[out] matches The IDs of the filters the packet matched. Its current content is overridden
+		 * @return The number of filters the packet matched
+		 */
+		size_t matchPacket(const RawPacket* rawPacket, MultiFilterMatches& matches) const;
+
+	private:
+		struct Instruction
+		{
+			uint32_t predicateIndex;
+			uint16_t jumpIfTrue;
+			uint16_t jumpIfFalse;
+		};
+
+		struct Program
+		{
+			std::vector<Instruction> instructions;
+			uint16_t entryPoint;
+			std::vector<int> filterIds;
+		};
+
+		struct PrefixTable
+		{
+			NativeFilterPredicateType type;
+			uint32_t mask;
+		};
+
+		struct BpfFilter
+		{
+			BpfFilterProgram* program;
+			int filterId;
+		};
+
+		size_t m_NumOfFilters;
+		std::vector<NativeFilterPredicate> m_Predicates;
+		// the classifier tables: the key is the table ID in the high 32 bits and the field value in the low 32 bits, the value is an index
+		// in m_PredicateLists. Exact value tables are identified by their predicate type, prefix tables by the index in m_PrefixTables plus
+		// the number of predicate types
+		FlatHashMap<uint32_t> m_Tables;
+		std::vector<std::vector<uint32_t> > m_PredicateLists;
+		uint32_t m_ExactTableTypes;
+		std::vector<PrefixTable> m_PrefixTables;
+		std::vector<uint32_t> m_TestedPredicates;
+		std::vector<Program> m_Programs;
+		std::vector<BpfFilter> m_BpfFilters;
+		// used only while adding filters, to find the index of an existing predicate or program
+		std::multimap<uint64_t, uint32_t> m_PredicateLookup;
+		std::map<std::vector<uint32_t>, size_t> m_ProgramLookup;
+
+		uint32_t addPredicate(const NativeFilterPredicate& predicate);
+		void addToTable(uint32_t tableId, uint32_t value, uint32_t predicateIndex);
+		void evaluatePredicates(const PacketView& view, const uint8_t* packetData, size_t packetDataLen, std::vector<uint64_t>& results) const;
+
+		// disable copy c'tor and assignment operator
+		MultiFilterProgram(const MultiFilterProgram& other);
+		MultiFilterProgram& operator=(const MultiFilterProgram& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_NATIVE_FILTER */
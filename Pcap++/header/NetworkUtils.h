@@ -4,6 +4,12 @@
 #include "MacAddress.h"
 #include "IpAddress.h"
 #include "PcapLiveDevice.h"
+#include "PcapFilter.h"
+#include "HashCounters.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include <pthread.h>
 
 
 /// @file
@@ -18,7 +24,8 @@ namespace pcpp
 	/**
 	 * @class NetworkUtils
 	 * This class bundles several network utilities that are very common and useful. These utilities use Pcap++ and Packet++ packet
-	 * crafting and processing capabilities. This class is a singleton and can be access by getInstance() only
+	 * crafting and processing capabilities. This class is a singleton and can be access by getInstance() only.
+	 * Each of its methods resolves a single address. For resolving many addresses at once please use ArpBatchResolver and DnsBatchResolver
 	 */
 	class NetworkUtils
 	{
@@ -85,6 +92,307 @@ namespace pcpp
 		NetworkUtils() {}
 	};
 
+	/**
+	 * @struct BatchResolverConfiguration
+	 * A structure for configuring ArpBatchResolver and DnsBatchResolver
+	 */
+	struct BatchResolverConfiguration
+	{
+		/** The maximum number of requests waiting for a response at the same time. A request is sent only when there is room for it */
+		size_t maxOutstandingRequests;
+
+		/** The maximum number of requests sent per second, including retries, or 0 for no limit */
+		uint32_t requestsPerSecond;
+
+		/** How long to wait for the response to a request, in milliseconds */
+		uint32_t timeoutMs;
+
+		/** The number of times a request is sent again when its response doesn't arrive in time, before it's reported as failed */
+		int numOfRetries;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] maxOutstandingRequests The maximum number of requests waiting for a response. The default is 256
+		 * @param[in] requestsPerSecond The maximum number of requests sent per second. The default is 1000
+		 * @param[in] timeoutMs How long to wait for a response, in milliseconds. The default is 5000
+		 * @param[in] numOfRetries The number of times a request is sent again. The default is 0
+		 */
+		BatchResolverConfiguration(size_t maxOutstandingRequests = 256, uint32_t requestsPerSecond = 1000, uint32_t timeoutMs = 5000, int numOfRetries = 0) :
+			maxOutstandingRequests(maxOutstandingRequests), requestsPerSecond(requestsPerSecond), timeoutMs(timeoutMs), numOfRetries(numOfRetries)
+		{
+		}
+	};
+
+
+	/**
+	 * @class BatchResolver
+	 * The base class of ArpBatchResolver and DnsBatchResolver, which resolve many addresses at once instead of one at a time as NetworkUtils
+	 * does. A single capture is kept running on the device for the whole batch, and requests are sent from the calling thread while the
+	 * responses to earlier requests arrive: up to BatchResolverConfiguration#maxOutstandingRequests requests wait for their responses at the
+	 * same time, and requests are sent no faster than BatchResolverConfiguration#requestsPerSecond. Outstanding requests are kept in a hash
+	 * table by the key their responses are matched with (the target IP of ARP requests and the transaction ID of DNS requests), and in a queue
+	 * by the time they were sent, so matching a response and expiring a request take constant time regardless of the batch size.
+	 * Results are delivered to a callback as they arrive, on the capture thread, or on the calling thread for requests which timed out.
+	 * Callbacks are never invoked concurrently, but they're invoked while the state of the resolver is locked, so they must be short and
+	 * mustn't call the resolver
+	 */
+	class BatchResolver
+	{
+	public:
+
+		/**
+		 * A d'tor for this class
+		 */
+		virtual ~BatchResolver();
+
+		/**
+		 * @return The number of requests sent during the last batch, including retries
+		 */
+		inline uint64_t getNumOfRequestsSent() const { return m_NumOfRequestsSent; }
+
+		/**
+		 * @return The number of requests of the last batch whose response arrived
+		 */
+		inline uint64_t getNumOfResponses() const { return m_NumOfResponses; }
+
+		/**
+		 * @return The number of requests of the last batch which got no response, after all retries
+		 */
+		inline uint64_t getNumOfTimeouts() const { return m_NumOfTimeouts; }
+
+	protected:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] device The interface to send and receive the packets on
+		 * @param[in] config The batch configuration
+		 */
+		BatchResolver(PcapLiveDevice* device, const BatchResolverConfiguration& config);
+
+		/**
+		 * Send all requests of a batch and wait for their responses. The device is opened if it isn't open, and closed at the end
+		 * @param[in] numOfRequests The number of requests in the batch
+		 * @param[in] responseFilter The filter set on the device for capturing the responses
+		 * @param[in] onResponseArrives The capture callback, which gets this instance as its cookie
+		 * @return False if the device couldn't be opened, or the filter or the capture couldn't be set (an error is printed to log), true
+		 * otherwise
+		 */
+		bool runBatch(size_t numOfRequests, GeneralFilter& responseFilter, OnPacketArrivesCallback onResponseArrives);
+
+		/**
+		 * Choose the key the response to a request will be matched with. Called with the state locked
+		 * @param[in] requestIndex The index of the request in the batch
+		 * @param[out] key The key
+		 * @return False if the request shouldn't be sent
+		 */
+		virtual bool getRequestKey(size_t requestIndex, uint64_t& key) = 0;
+
+		/**
+		 * Send a request. Called without the state locked. Packets should be sent using the TX buffer of the device, which is flushed
+		 * after each round of requests
+		 * @param[in] requestIndex The index of the request in the batch
+		 * @param[in] key The key chosen by getRequestKey()
+		 * @return True if the request was sent
+		 */
+		virtual bool sendRequest(size_t requestIndex, uint64_t key) = 0;
+
+		/**
+		 * Report a request which got no response. Called with the state locked
+		 * @param[in] requestIndex The index of the request in the batch
+		 */
+		virtual void onRequestFailed(size_t requestIndex) = 0;
+
+		/**
+		 * Lock the state shared with the capture thread
+		 */
+		void lock() { pthread_mutex_lock(&m_Mutex); }
+
+		/**
+		 * Unlock the state shared with the capture thread
+		 */
+		void unlock() { pthread_mutex_unlock(&m_Mutex); }
+
+		/**
+		 * Find an outstanding request. Must be called with the state locked
+		 * @param[in] key The key of the request
+		 * @param[out] requestIndex The index of the request in the batch
+		 * @return True if a request with this key is outstanding
+		 */
+		bool findRequest(uint64_t key, size_t& requestIndex) const;
+
+		/**
+		 * Remove an outstanding request whose response arrived and make room for the next request. Must be called with the state locked
+		 * @param[in] key The key of the request
+		 * @return The time since the request was sent, in milliseconds
+		 */
+		double completeRequest(uint64_t key);
+
+		PcapLiveDevice* m_Device;
+
+	private:
+
+		struct PendingRequest
+		{
+			size_t requestIndex;
+			uint64_t sendTimeNs;
+			uint32_t sendSeq;
+			int retriesLeft;
+
+			PendingRequest() : requestIndex(0), sendTimeNs(0), sendSeq(0), retriesLeft(0) {}
+		};
+
+		struct SentRequest
+		{
+			uint64_t key;
+			uint64_t sendTimeNs;
+			uint32_t sendSeq;
+		};
+
+		BatchResolverConfiguration m_Config;
+		pthread_mutex_t m_Mutex;
+		pthread_cond_t m_RequestCompleted;
+		FlatHashMap<PendingRequest> m_PendingRequests;
+		// outstanding requests in the order they were sent, which is the order they expire in. Entries of requests which were answered or
+		// sent again are skipped when they reach the front
+		std::deque<SentRequest> m_SentRequests;
+		// requests which timed out and should be sent again, with the number of retries they have left
+		std::deque<std::pair<size_t, int> > m_RetryRequests;
+		uint32_t m_SendSeq;
+		uint64_t m_NumOfRequestsSent;
+		uint64_t m_NumOfResponses;
+		uint64_t m_NumOfTimeouts;
+
+		void expireRequests(uint64_t nowNs);
+
+		// disable copy c'tor and assignment operator
+		BatchResolver(const BatchResolver& other);
+		BatchResolver& operator=(const BatchResolver& other);
+	};
+
+
+	/**
+	 * @class ArpBatchResolver
+	 * Resolves the MAC addresses of many IPv4 addresses, for example for scanning a subnet, by sending many ARP requests at once and matching
+	 * the ARP replies to them as they arrive (see BatchResolver)
+	 */
+	class ArpBatchResolver : public BatchResolver
+	{
+	public:
+
+		/**
+		 * @typedef OnArpResolved
+		 * A callback invoked when a request is completed
+		 * @param[in] ipAddr The IPv4 address
+		 * @param[in] macAddr The resolved MAC address, or MacAddress#Zero if no ARP reply arrived
+		 * @param[in] responseTimeMS The time it took the ARP reply to arrive, in milliseconds
+		 * @param[in] userCookie The cookie provided by the user in the c'tor
+		 */
+		typedef void (*OnArpResolved)(const IPv4Address& ipAddr, const MacAddress& macAddr, double responseTimeMS, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] device The interface to send and receive the ARP packets on
+		 * @param[in] onArpResolved The callback invoked when a request is completed
+		 * @param[in] userCookie A pointer passed to the callback. This parameter is optional, default cookie is NULL
+		 * @param[in] config The batch configuration. This parameter is optional
+		 * @param[in] sourceMac The source MAC address of the ARP requests. If it isn't set or set with MacAddress#Zero the MAC address of
+		 * the interface is used
+		 * @param[in] sourceIP The source IPv4 address of the ARP requests. If it isn't set or set with IPv4Address#Zero the IPv4 address of
+		 * the interface is used
+		 */
+		ArpBatchResolver(PcapLiveDevice* device, OnArpResolved onArpResolved, void* userCookie = NULL,
+				const BatchResolverConfiguration& config = BatchResolverConfiguration(), MacAddress sourceMac = MacAddress::Zero,
+				IPv4Address sourceIP = IPv4Address::Zero);
+
+		/**
+		 * Resolve the MAC addresses of a list of IPv4 addresses. Returns when all addresses were resolved or timed out. An address which
+		 * appears more than once in the list is resolved once
+		 * @param[in] ipAddresses The addresses to resolve
+		 * @return The number of addresses resolved, or -1 if the batch couldn't be started (an error is printed to log)
+		 */
+		int resolve(const std::vector<IPv4Address>& ipAddresses);
+
+	private:
+		OnArpResolved m_OnArpResolved;
+		void* m_UserCookie;
+		MacAddress m_SourceMac;
+		IPv4Address m_SourceIP;
+		const std::vector<IPv4Address>* m_IPAddresses;
+		// the ARP request of the current batch, in which only the target IP is changed for each request
+		Packet* m_Request;
+
+		static void onPacketArrives(RawPacket* rawPacket, PcapLiveDevice* device, void* userCookie);
+
+		bool getRequestKey(size_t requestIndex, uint64_t& key);
+		bool sendRequest(size_t requestIndex, uint64_t key);
+		void onRequestFailed(size_t requestIndex);
+	};
+
+
+	/**
+	 * @class DnsBatchResolver
+	 * Resolves the IPv4 addresses of many hostnames by sending many DNS requests at once and matching the DNS responses to them by their
+	 * transaction ID as they arrive (see BatchResolver). The DNS server and the gateway are chosen as in NetworkUtils#getIPv4Address(), and
+	 * all requests are sent from a single source port
+	 */
+	class DnsBatchResolver : public BatchResolver
+	{
+	public:
+
+		/**
+		 * @typedef OnDnsResolved
+		 * A callback invoked when a request is completed
+		 * @param[in] hostname The hostname
+		 * @param[in] ipAddr The resolved IPv4 address, or IPv4Address#Zero if no DNS response arrived or the response has no IPv4 address
+		 * for the hostname
+		 * @param[in] dnsTTL The DNS TTL of the IPv4 address, or 0 if it wasn't resolved
+		 * @param[in] responseTimeMS The time it took the DNS response to arrive, in milliseconds
+		 * @param[in] userCookie The cookie provided by the user in the c'tor
+		 */
+		typedef void (*OnDnsResolved)(const std::string& hostname, const IPv4Address& ipAddr, uint32_t dnsTTL, double responseTimeMS, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] device The interface to send and receive the packets on
+		 * @param[in] onDnsResolved The callback invoked when a request is completed
+		 * @param[in] userCookie A pointer passed to the callback. This parameter is optional, default cookie is NULL
+		 * @param[in] config The batch configuration. This parameter is optional
+		 * @param[in] dnsServerIP The DNS server to send the requests to. If it isn't set or set with IPv4Address#Zero the default DNS server
+		 * configured in the system is used
+		 * @param[in] gatewayIP The LAN gateway to send the requests through. If it isn't set or set with IPv4Address#Zero the interface's
+		 * default gateway is used
+		 */
+		DnsBatchResolver(PcapLiveDevice* device, OnDnsResolved onDnsResolved, void* userCookie = NULL,
+				const BatchResolverConfiguration& config = BatchResolverConfiguration(), IPv4Address dnsServerIP = IPv4Address::Zero,
+				IPv4Address gatewayIP = IPv4Address::Zero);
+
+		/**
+		 * Resolve the IPv4 addresses of a list of hostnames. The MAC address of the gateway is resolved first. Returns when all hostnames
+		 * were resolved or timed out
+		 * @param[in] hostnames The hostnames to resolve
+		 * @return The number of hostnames resolved to an IPv4 address, or -1 if the gateway MAC address couldn't be resolved, the DNS
+		 * server isn't valid or the batch couldn't be started (an error is printed to log)
+		 */
+		int resolve(const std::vector<std::string>& hostnames);
+
+	private:
+		OnDnsResolved m_OnDnsResolved;
+		void* m_UserCookie;
+		IPv4Address m_DnsServerIP;
+		IPv4Address m_GatewayIP;
+		MacAddress m_GatewayMac;
+		uint16_t m_SrcPort;
+		uint16_t m_NextTransactionID;
+		int m_NumOfResolved;
+		const std::vector<std::string>* m_Hostnames;
+
+		static void onPacketArrives(RawPacket* rawPacket, PcapLiveDevice* device, void* userCookie);
+
+		bool getRequestKey(size_t requestIndex, uint64_t& key);
+		bool sendRequest(size_t requestIndex, uint64_t key);
+		void onRequestFailed(size_t requestIndex);
+	};
+
 } // namespace pcpp
 
 #endif /* PCAPPP_NETWORK_UTILS */
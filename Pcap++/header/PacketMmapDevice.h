@@ -0,0 +1,304 @@
+#ifndef PCAPPP_PACKET_MMAP_DEVICE
+#define PCAPPP_PACKET_MMAP_DEVICE
+
+#include "Device.h"
+#include "RawPacket.h"
+#include <pthread.h>
+#include <string>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The default size in bytes of each block of a PacketMmapDevice RX ring
+ */
+#define PCPP_PACKET_MMAP_DEFAULT_BLOCK_SIZE (1 << 22)
+
+/**
+ * The default number of blocks of a PacketMmapDevice RX ring
+ */
+#define PCPP_PACKET_MMAP_DEFAULT_NUM_OF_BLOCKS 64
+
+/**
+ * The default frame size of a PacketMmapDevice RX ring, which is the largest packet captured whole
+ */
+#define PCPP_PACKET_MMAP_DEFAULT_FRAME_SIZE 2048
+
+/**
+ * The default time in milliseconds the kernel waits for a block to fill before handing it to PacketMmapDevice
+ */
+#define PCPP_PACKET_MMAP_DEFAULT_BLOCK_TIMEOUT_MS 10
+
+	class PacketMmapDevice;
+
+	/**
+	 * @typedef OnPacketMmapPacketsArriveCallback
+	 * A callback that is called with the packets of a ring block captured by PacketMmapDevice
+	 * @param[in] packets An array of the captured raw packets. The packet data isn't copied, it points into the ring, so the packets are valid
+	 * only until the callback returns
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] threadId The ID of the RX ring the packets were captured on, which is also the ID of the capture thread
+	 * @param[in] device A pointer to the PacketMmapDevice instance
+	 * @param[in] userCookie A pointer to the object put by the user when packet capturing started
+	 */
+	typedef void (*OnPacketMmapPacketsArriveCallback)(RawPacket* packets, uint32_t numOfPackets, uint8_t threadId, PacketMmapDevice* device, void* userCookie);
+
+	/**
+	 * @class PacketMmapDevice
+	 * A capture device for Linux network interfaces which reads packets from kernel memory mapped RX rings (PACKET_MMAP, TPACKET_V3) instead
+	 * of going through libpcap. The kernel fills whole blocks of packets in a ring shared with the process, and the device hands each block
+	 * to the user in one callback call, with RawPackets that point into the ring (no copy and no system call per packet). The block is
+	 * returned to the kernel when the callback returns.
+	 * Several RX rings can be opened, each on its own socket, joined into a PACKET_FANOUT group so the kernel spreads the packets of the
+	 * interface among them (by flow hash by default), and each ring is read by its own capture thread. BPF filters are compiled with the
+	 * BPFStringFilter syntax and attached to the sockets (SO_ATTACH_FILTER), so filtered packets are dropped by the kernel before they're
+	 * copied to the rings.
+	 * Please notice VLAN tags stripped by the NIC (VLAN RX offload) aren't part of the packet data, as with any packet socket
+	 * This device is supported on Linux only, opening it on other platforms fails. Opening it requires the CAP_NET_RAW capability (root)
+	 */
+	class PacketMmapDevice : public IDevice, public IFilterableDevice
+	{
+	public:
+
+		/**
+		 * How the kernel spreads packets among the RX rings when more than one ring is opened
+		 */
+		enum FanoutMode
+		{
+			/** By flow hash, so all packets of a flow reach the same ring (PACKET_FANOUT_HASH) */
+			FanoutHash,
+			/** Round robin (PACKET_FANOUT_LB) */
+			FanoutLoadBalance,
+			/** By the CPU the packet arrived on (PACKET_FANOUT_CPU) */
+			FanoutCpu,
+			/** By the NIC RX queue the packet arrived on (PACKET_FANOUT_QM) */
+			FanoutQueueMapping
+		};
+
+		/**
+		 * @struct DeviceConfiguration
+		 * A structure for configuring the RX rings of PacketMmapDevice
+		 */
+		struct DeviceConfiguration
+		{
+			/** The number of RX rings, each read by its own capture thread */
+			uint8_t numOfRxRings;
+
+			/** The size in bytes of each block. It must be a multiple of the page size */
+			uint32_t blockSize;
+
+			/** The number of blocks in each ring */
+			uint32_t numOfBlocks;
+
+			/** The frame size. Packets larger than the frame size (minus the packet header) are truncated. It must be a multiple of 16 and
+			 * divide blockSize
+			 */
+			uint32_t frameSize;
+
+			/** The time in milliseconds the kernel waits for a block to fill before handing it over partially full. It bounds the capture
+			 * latency when traffic is low
+			 */
+			uint32_t blockTimeoutMs;
+
+			/** How packets are spread among the rings when there's more than one */
+			FanoutMode fanoutMode;
+
+			/** The ID of the fanout group. Sockets of other devices (or processes) joining the same group on the same interface share its
+			 * packets. Default is 0, which means a group ID derived from the process ID is used
+			 */
+			uint16_t fanoutGroupId;
+
+			/** Whether the interface is put in promiscuous mode while the device is open */
+			bool promiscuous;
+
+			/**
+			 * A c'tor for this struct
+			 * @param[in] numOfRxRings The number of RX rings. Default is 1
+			 * @param[in] blockSize The size in bytes of each block. Default is #PCPP_PACKET_MMAP_DEFAULT_BLOCK_SIZE
+			 * @param[in] numOfBlocks The number of blocks in each ring. Default is #PCPP_PACKET_MMAP_DEFAULT_NUM_OF_BLOCKS
+			 * @param[in] frameSize The frame size. Default is #PCPP_PACKET_MMAP_DEFAULT_FRAME_SIZE
+			 * @param[in] fanoutMode How packets are spread among the rings. Default is FanoutHash
+			 */
+			DeviceConfiguration(uint8_t numOfRxRings = 1, uint32_t blockSize = PCPP_PACKET_MMAP_DEFAULT_BLOCK_SIZE,
+					uint32_t numOfBlocks = PCPP_PACKET_MMAP_DEFAULT_NUM_OF_BLOCKS, uint32_t frameSize = PCPP_PACKET_MMAP_DEFAULT_FRAME_SIZE,
+					FanoutMode fanoutMode = FanoutHash) :
+				numOfRxRings(numOfRxRings), blockSize(blockSize), numOfBlocks(numOfBlocks), frameSize(frameSize),
+				blockTimeoutMs(PCPP_PACKET_MMAP_DEFAULT_BLOCK_TIMEOUT_MS), fanoutMode(fanoutMode), fanoutGroupId(0), promiscuous(true)
+			{
+			}
+		};
+
+		/**
+		 * @struct PacketMmapStats
+		 * A container for PacketMmapDevice statistics
+		 */
+		struct PacketMmapStats
+		{
+			/** Number of packets received, including the dropped ones */
+			uint64_t recv;
+			/** Number of packets dropped because the ring was full */
+			uint64_t drop;
+			/** Number of times the ring was full */
+			uint64_t ringFull;
+		};
+
+		/**
+		 * A c'tor for this class. The rings aren't created until open() is called
+		 * @param[in] interfaceName The name of the network interface, for example "eth0"
+		 * @param[in] config The ring configuration
+		 */
+		PacketMmapDevice(const std::string& interfaceName, const DeviceConfiguration& config = DeviceConfiguration());
+
+		/**
+		 * A d'tor for this class. Stops the capture and closes the device if they're active
+		 */
+		~PacketMmapDevice();
+
+		/**
+		 * @return The name of the network interface
+		 */
+		inline const std::string& getName() const { return m_InterfaceName; }
+
+		/**
+		 * @return The ring configuration
+		 */
+		inline const DeviceConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * @return The number of RX rings opened, or 0 if the device isn't open
+		 */
+		inline uint8_t getNumOfOpenedRxRings() const { return m_NumOfOpenedRings; }
+
+		/**
+		 * Start capturing on all RX rings, each on a new thread. Every block the kernel hands over is delivered in one onPacketsArrive call
+		 * @param[in] onPacketsArrive A callback that is called with the packets of each block
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object. This object will be transferred to the onPacketsArrive
+		 * callback each time it is called
+		 * @return True if capture started successfully, false if the device isn't open, capture is already running, the callback is NULL
+		 * or a capture thread could not be created (relevant log error is printed in any case)
+		 */
+		bool startCapture(OnPacketMmapPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie);
+
+		/**
+		 * Stop the capture threads. Each thread stops after the block it's delivering, or within 100 milliseconds when there's no traffic
+		 */
+		void stopCapture();
+
+		/**
+		 * @return True if the capture threads are running
+		 */
+		inline bool captureActive() const { return m_CaptureThreadsStarted; }
+
+		/**
+		 * Read a single block of a ring on the calling thread, for applications which run their own capture loops. It shouldn't be called
+		 * for rings read by the capture threads of startCapture()
+		 * @param[in] ringId The ID of the ring, between 0 and getNumOfOpenedRxRings()-1
+		 * @param[in] onPacketsArrive A callback that is called with the packets of the block, on the calling thread
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object which is transferred to the callback
+		 * @param[in] timeoutMs The time in milliseconds to wait for a block. 0 means not waiting, a negative value means waiting without
+		 * a timeout
+		 * @return The number of packets delivered, 0 if no block was ready before the timeout or -1 on error (an error is printed to log)
+		 */
+		int receiveBlock(uint8_t ringId, OnPacketMmapPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, int timeoutMs);
+
+		/**
+		 * Get the statistics of a single ring since the device was opened
+		 * @param[in] ringId The ID of the ring
+		 * @param[out] stats The object the statistics are written to
+		 */
+		void getRingStatistics(uint8_t ringId, PacketMmapStats& stats);
+
+		/**
+		 * Get the statistics of all rings together since the device was opened
+		 * @param[out] stats The object the statistics are written to
+		 */
+		void getStatistics(PacketMmapStats& stats);
+
+		/**
+		 * Report the getStatistics() counters of all rings to a MetricsRegistry snapshot
+		 * @param[in] writer The writer to report the values to
+		 */
+		void collectMetrics(MetricsWriter& writer);
+
+		// implement abstract methods
+
+		/**
+		 * Create the sockets, set up and map their RX rings, bind them to the interface and join them into a fanout group
+		 * @return True if the device was opened, false otherwise (an error is printed to log)
+		 */
+		bool open();
+
+		/**
+		 * Stop the capture if it's running, unmap the rings and close the sockets
+		 */
+		void close();
+
+		using IFilterableDevice::setFilter;
+
+		/**
+		 * Compile a BPF filter and attach it to the sockets of all rings, so the kernel drops packets which don't match it. The device must
+		 * be open
+		 * @param[in] filterAsString The filter in Berkeley Packet Filter (BPF) syntax
+		 * @return True if the filter was attached to all rings, false if the device isn't open, the filter is invalid or attaching it failed
+		 */
+		bool setFilter(std::string filterAsString);
+
+		/**
+		 * Detach the filter from the sockets of all rings
+		 * @return True if the filter was detached or no filter was set, false otherwise
+		 */
+		bool clearFilter();
+
+		/**
+		 * @return True if a filter is currently set
+		 */
+		inline bool isFilterCurrentlySet() const { return m_IsFilterSet; }
+
+	private:
+
+		struct RxRing
+		{
+			int fd;
+			uint8_t* map;
+			size_t mapSize;
+			uint32_t curBlock;
+			// the packets of a block, which point into the ring. Grows to the largest block seen
+			RawPacket* packets;
+			uint32_t packetsCapacity;
+			PacketMmapStats stats;
+			pthread_t thread;
+			PacketMmapDevice* device;
+			uint8_t id;
+		};
+
+		std::string m_InterfaceName;
+		DeviceConfiguration m_Config;
+		RxRing* m_Rings;
+		uint8_t m_NumOfOpenedRings;
+		int m_InterfaceIndex;
+		bool m_CaptureThreadsStarted;
+		volatile bool m_StopThreads;
+		OnPacketMmapPacketsArriveCallback m_OnPacketsArrive;
+		void* m_OnPacketsArriveUserCookie;
+		bool m_IsFilterSet;
+
+		bool openRing(RxRing& ring);
+		void closeRing(RxRing& ring);
+		void updateRingStatistics(RxRing& ring);
+		int processBlock(RxRing& ring, OnPacketMmapPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, int timeoutMs);
+		static void* captureThreadMain(void* ringPtr);
+
+		// disable copy c'tor and assignment operator
+		PacketMmapDevice(const PacketMmapDevice& other);
+		PacketMmapDevice& operator=(const PacketMmapDevice& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_PACKET_MMAP_DEVICE */
@@ -0,0 +1,196 @@
+#ifndef PCAPPP_PACKET_QUEUE_DEVICE
+#define PCAPPP_PACKET_QUEUE_DEVICE
+
+#include "Device.h"
+#include "RawPacketPool.h"
+#include "SPSCQueue.h"
+#include "MPMCQueue.h"
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The default maximum number of packets in a PacketQueueDevice
+ */
+#define PCPP_PACKET_QUEUE_DEFAULT_CAPACITY 4096
+
+	class PcapLiveDevice;
+
+	/**
+	 * @class PacketQueueDevice
+	 * A device which hands packets from threads that capture or produce them to worker threads that process them, through a bounded
+	 * lock-free queue of RawPacket pointers (pcpp#SPSCQueue or pcpp#MPMCQueue). It's the building block of pipelined applications: a
+	 * capture thread pushes the packets it captures into the device and workers pop them, without a lock or a memory allocation on the way
+	 * (the packets themselves are copied, into buffers of a RawPacketPool when one is given).
+	 * Packets are pushed either as RawPacket objects the device takes ownership of (enqueue(), enqueueBurst()) or as packets which are
+	 * copied (copyAndEnqueue()), which is what capture callbacks need since the packets they get are valid only until they return. The
+	 * static onPacketArrives() and onPacketsArriveBurst() callbacks can be given to PcapLiveDevice#startCapture() and
+	 * PcapLiveDevice#startCaptureBurstMode() with the device as the user cookie to feed it directly.
+	 * Popped packets are owned by the caller, which should delete them (returning their buffers to the pool, if any).
+	 * When the queue is full pushed packets are dropped, and the number of dropped packets is counted.
+	 * The queue type chooses how many threads may push and pop: with SingleProducerSingleConsumer only one thread may push and only one
+	 * may pop, which is the cheapest; MultiProducerMultiConsumer allows any number of both
+	 */
+	class PacketQueueDevice : public IDevice
+	{
+	public:
+
+		/**
+		 * The threads which may push and pop packets
+		 */
+		enum QueueType
+		{
+			/** One producer thread and one consumer thread (pcpp#SPSCQueue) */
+			SingleProducerSingleConsumer,
+			/** Any number of producer and consumer threads (pcpp#MPMCQueue) */
+			MultiProducerMultiConsumer
+		};
+
+		/**
+		 * A c'tor for this class. The queue isn't allocated until open() is called
+		 * @param[in] capacity The maximum number of packets in the queue, rounded up to a power of 2. Default value is
+		 * #PCPP_PACKET_QUEUE_DEFAULT_CAPACITY
+		 * @param[in] queueType The threads which may push and pop packets. Default value is MultiProducerMultiConsumer
+		 * @param[in] pool A pool to take the data buffers of packets copied by copyAndEnqueue() from, or NULL for allocating them on the
+		 * heap. The pool must outlive all packets popped from the device. Default value is NULL
+		 */
+		PacketQueueDevice(size_t capacity = PCPP_PACKET_QUEUE_DEFAULT_CAPACITY, QueueType queueType = MultiProducerMultiConsumer, RawPacketPool* pool = NULL);
+
+		/**
+		 * A d'tor for this class. Closes the device, deleting the packets which weren't popped
+		 */
+		~PacketQueueDevice();
+
+		/**
+		 * Push a packet to the queue. On success the device takes ownership of the packet
+		 * @param[in] packet The packet to push, which must be allocated with new
+		 * @return True if the packet was pushed, false if the device isn't open or the queue is full. In that case the packet is still owned
+		 * by the caller, and it's counted as dropped
+		 */
+		bool enqueue(RawPacket* packet);
+
+		/**
+		 * Push several packets to the queue at once. The device takes ownership of the packets which were pushed
+		 * @param[in] packets An array of packets to push, which must be allocated with new
+		 * @param[in] count The number of packets in the array
+		 * @return The number of packets pushed, which are always the first ones. The rest are still owned by the caller, and they're counted
+		 * as dropped
+		 */
+		int enqueueBurst(RawPacket** packets, int count);
+
+		/**
+		 * Copy packets and push the copies to the queue. The data of the copies is taken from the device's pool if one was given. Packets
+		 * which don't fit in the queue aren't copied, and they're counted as dropped
+		 * @param[in] packets An array of packets to copy. The packets aren't changed
+		 * @param[in] count The number of packets in the array
+		 * @return The number of packets pushed
+		 */
+		int copyAndEnqueue(const RawPacket* packets, int count);
+
+		/**
+		 * Pop the oldest packet from the queue. The caller owns the packet and should delete it
+		 * @return The packet, or NULL if the queue is empty or the device isn't open
+		 */
+		RawPacket* dequeue();
+
+		/**
+		 * Pop up to maxCount of the oldest packets from the queue. The caller owns the packets and should delete them
+		 * @param[out] packets An array of at least maxCount pointers the packets are written to
+		 * @param[in] maxCount The maximum number of packets to pop
+		 * @return The number of packets popped, 0 if the queue is empty or the device isn't open
+		 */
+		int dequeueBurst(RawPacket** packets, int maxCount);
+
+		/**
+		 * Pop up to maxCount of the oldest packets from the queue into a packet vector, which takes ownership of them
+		 * @param[out] packetVec The vector the packets are added to. Its current content isn't cleared
+		 * @param[in] maxCount The maximum number of packets to pop
+		 * @return The number of packets popped, 0 if the queue is empty or the device isn't open
+		 */
+		int receivePackets(RawPacketVector& packetVec, int maxCount);
+
+		/**
+		 * @return The number of packets in the queue. When called while other threads work on the device the value may already be outdated
+		 */
+		size_t getNumOfQueuedPackets() const;
+
+		/**
+		 * @return The maximum number of packets in the queue
+		 */
+		inline size_t getCapacity() const { return m_Capacity; }
+
+		/**
+		 * @return The threads which may push and pop packets
+		 */
+		inline QueueType getQueueType() const { return m_QueueType; }
+
+		/**
+		 * @return The number of packets dropped since the device was opened because the queue was full. When producers are still pushing
+		 * packets the value may already be outdated
+		 */
+		uint64_t getNumOfDroppedPackets() const;
+
+		/**
+		 * Report the number of queued and dropped packets to a MetricsRegistry snapshot: pcpp_device_queued_packets and
+		 * pcpp_device_rx_dropped_packets_total
+		 * @param[in] writer The writer to report the values to
+		 */
+		void collectMetrics(MetricsWriter& writer);
+
+		/**
+		 * A PcapLiveDevice#startCapture() callback which copies each captured packet into the device
+		 * @param[in] packet The captured packet
+		 * @param[in] pDevice The capturing device
+		 * @param[in] userCookie A pointer to the PacketQueueDevice instance
+		 */
+		static void onPacketArrives(RawPacket* packet, PcapLiveDevice* pDevice, void* userCookie);
+
+		/**
+		 * A PcapLiveDevice#startCaptureBurstMode() callback which copies each burst of captured packets into the device
+		 * @param[in] packets The captured packets
+		 * @param[in] numOfPackets The number of captured packets
+		 * @param[in] pDevice The capturing device
+		 * @param[in] userCookie A pointer to the PacketQueueDevice instance
+		 */
+		static void onPacketsArriveBurst(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* pDevice, void* userCookie);
+
+		// implement abstract methods
+
+		/**
+		 * Allocate the queue
+		 * @return True if the device was opened or is already open
+		 */
+		bool open();
+
+		/**
+		 * Free the queue, deleting the packets which weren't popped. No thread should push or pop packets while the device is closed
+		 */
+		void close();
+
+	private:
+
+		size_t m_Capacity;
+		QueueType m_QueueType;
+		RawPacketPool* m_Pool;
+		SPSCQueue<RawPacket*>* m_SPSCQueue;
+		MPMCQueue<RawPacket*>* m_MPMCQueue;
+		volatile uint64_t m_DroppedPackets;
+
+		size_t push(RawPacket** packets, size_t count);
+		size_t pop(RawPacket** packets, size_t maxCount);
+		void addDroppedPackets(uint64_t count);
+
+		// disable copy c'tor and assignment operator
+		PacketQueueDevice(const PacketQueueDevice& other);
+		PacketQueueDevice& operator=(const PacketQueueDevice& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_PACKET_QUEUE_DEVICE */
@@ -0,0 +1,251 @@
+#ifndef PCAPPP_PACKET_REPLAYER
+#define PCAPPP_PACKET_REPLAYER
+
+#include "PcapFileDevice.h"
+#include "PcapLiveDevice.h"
+#include "RawPacketSlabVector.h"
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The default number of packets PacketReplayer hands to the sender at once when it's behind schedule
+ */
+#define PCPP_REPLAYER_DEFAULT_BURST_SIZE 32
+
+	/**
+	 * @struct PacketReplayConfiguration
+	 * A structure for configuring PacketReplayer
+	 */
+	struct PacketReplayConfiguration
+	{
+		/**
+		 * How the send time of each packet is scheduled
+		 */
+		enum PacingMode
+		{
+			/** Keep the gaps between the original timestamps of the packets, divided by #speedMultiplier */
+			OriginalTiming,
+			/** Send #packetsPerSecond packets per second, evenly spaced */
+			FixedPacketRate,
+			/** Send #bitsPerSecond bits of packet data per second, each packet spaced by its own length */
+			FixedBitRate,
+			/** Send as fast as the sender accepts packets */
+			TopSpeed
+		};
+
+		/** How the send time of each packet is scheduled */
+		PacingMode pacingMode;
+
+		/** In OriginalTiming mode: the factor the replay is faster than the capture by, for example 2.0 replays at twice the original rate */
+		double speedMultiplier;
+
+		/** In FixedPacketRate mode: the number of packets sent per second */
+		uint64_t packetsPerSecond;
+
+		/** In FixedBitRate mode: the number of bits of packet data sent per second (Ethernet preamble and inter-frame gap not included) */
+		uint64_t bitsPerSecond;
+
+		/** The number of times the packets are replayed. If the value is set to 0 they're replayed until stop() is called */
+		uint32_t numOfLoops;
+
+		/** The maximum number of packets handed to the sender at once. Packets are gathered into a burst only when their send time has
+		 * already come, so a larger burst doesn't delay any packet
+		 */
+		size_t burstSize;
+
+		/** The value added to the source IP address of IP packets in every loop after the first, so each loop looks like different flows. For
+		 * IPv6 packets it's added to the last 32 bits of the address. Checksums are updated accordingly. Default is 0 (not rewritten)
+		 */
+		uint32_t srcIPIncrementPerLoop;
+
+		/** Same as #srcIPIncrementPerLoop, for the destination IP address. Please notice the TCP or UDP checksum of a packet which is an IP
+		 * fragment isn't updated when its addresses are rewritten
+		 */
+		uint32_t dstIPIncrementPerLoop;
+
+		/** The value added to the source port of TCP and UDP packets in every loop after the first. Default is 0 (not rewritten) */
+		uint16_t srcPortIncrementPerLoop;
+
+		/** Same as #srcPortIncrementPerLoop, for the destination port */
+		uint16_t dstPortIncrementPerLoop;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] pacingMode How the send time of each packet is scheduled. The default is OriginalTiming
+		 * @param[in] numOfLoops The number of times the packets are replayed, 0 for replaying until stop() is called. The default is 1
+		 * @param[in] burstSize The maximum number of packets handed to the sender at once. The default is #PCPP_REPLAYER_DEFAULT_BURST_SIZE
+		 */
+		PacketReplayConfiguration(PacingMode pacingMode = OriginalTiming, uint32_t numOfLoops = 1, size_t burstSize = PCPP_REPLAYER_DEFAULT_BURST_SIZE) :
+			pacingMode(pacingMode), speedMultiplier(1.0), packetsPerSecond(0), bitsPerSecond(0), numOfLoops(numOfLoops), burstSize(burstSize),
+			srcIPIncrementPerLoop(0), dstIPIncrementPerLoop(0), srcPortIncrementPerLoop(0), dstPortIncrementPerLoop(0)
+		{
+		}
+	};
+
+	/**
+	 * @class PacketReplayer
+	 * Replays packets through any device able to send them, with accurate pacing. The packets are loaded into memory before the replay
+	 * (see RawPacketSlabVector), so the replay never waits for the disk, and the send time of each packet is calculated from the replay
+	 * start time and the configured pacing, not from the previous packet, so delays don't accumulate. The replaying thread busy-waits on
+	 * the TSC based TimestampClock until the send time of the next packet comes, which paces packets far more accurately than sleeping (only
+	 * gaps longer than a couple of milliseconds are partially slept). When the sender can't keep up, packets whose send time has passed are
+	 * handed to it in bursts.
+	 * The packets are sent by a callback, which makes any device usable: a PcapLiveDevice can be used directly with replay(PcapLiveDevice&),
+	 * and for a DpdkDevice, PfRingDevice or RawSocketDevice the callback calls the device's send method.
+	 * In every loop after the first the IP addresses and ports of the packets can be shifted, so each loop generates new flows (see
+	 * PacketReplayConfiguration). The packets are rewritten in place right before they're sent, with incremental checksum updates
+	 */
+	class PacketReplayer
+	{
+	public:
+
+		/**
+		 * The callback invoked for sending a burst of packets
+		 * @param[in] packets An array of the packets to send
+		 * @param[in] numOfPackets The number of packets in the array
+		 * @param[in] userCookie A pointer to the cookie provided by the user in replay()
+		 * @return The number of packets sent. If it's smaller than numOfPackets the rest of the packets are counted as failed, and aren't
+		 * sent again
+		 */
+		typedef int (*OnSendPackets)(RawPacket** packets, int numOfPackets, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The replay configuration
+		 */
+		PacketReplayer(const PacketReplayConfiguration& config = PacketReplayConfiguration());
+
+		/**
+		 * Load all packets of a file into memory, after the packets already loaded. The file is opened and closed by this method
+		 * @param[in] fileName The pcap or pcap-ng file
+		 * @return True if the file was loaded, false if it couldn't be opened (an error is printed to log)
+		 */
+		bool loadFile(const char* fileName);
+
+		/**
+		 * Load the remaining packets of an open reader device into memory, after the packets already loaded
+		 * @param[in] reader The reader device
+		 * @return The number of packets loaded
+		 */
+		int loadPackets(IFileReaderDevice& reader);
+
+		/**
+		 * Add a packet to replay after the packets already loaded. The packet is copied
+		 * @param[in] rawPacket The packet to add
+		 * @return True if the packet was added, false if it has no data
+		 */
+		bool addPacket(const RawPacket& rawPacket);
+
+		/**
+		 * Remove all loaded packets
+		 */
+		void clear();
+
+		/**
+		 * @return The number of loaded packets
+		 */
+		inline size_t getNumOfPackets() const { return m_Packets.size(); }
+
+		/**
+		 * @return The replay configuration
+		 */
+		inline const PacketReplayConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * Replay the loaded packets through a callback. The method returns when all loops were replayed or stop() was called
+		 * @param[in] onSendPackets The callback that sends a burst of packets
+		 * @param[in] userCookie A pointer to a user provided object passed to the callback
+		 * @return True if the replay completed or was stopped, false if there are no packets or the configuration is invalid (an error is
+		 * printed to log)
+		 */
+		bool replay(OnSendPackets onSendPackets, void* userCookie);
+
+		/**
+		 * Replay the loaded packets through a live device, which has to be opened. Same as replay(OnSendPackets, void*)
+		 * @param[in] device The device to send the packets through
+		 * @return True if the replay completed or was stopped, false otherwise
+		 */
+		bool replay(PcapLiveDevice& device);
+
+		/**
+		 * Stop a replay which runs in another thread. The replay returns after the burst it's sending
+		 */
+		inline void stop() { m_StopRequested = true; }
+
+		/**
+		 * @return The number of packets sent by the last replay
+		 */
+		inline uint64_t getNumOfPacketsSent() const { return m_NumOfPacketsSent; }
+
+		/**
+		 * @return The number of bytes of packet data sent by the last replay
+		 */
+		inline uint64_t getNumOfBytesSent() const { return m_NumOfBytesSent; }
+
+		/**
+		 * @return The number of packets the sender failed to send in the last replay
+		 */
+		inline uint64_t getNumOfPacketsFailed() const { return m_NumOfPacketsFailed; }
+
+		/**
+		 * @return The number of loops the last replay completed
+		 */
+		inline uint32_t getNumOfLoopsCompleted() const { return m_NumOfLoopsCompleted; }
+
+		/**
+		 * @return The duration of the last replay in nanoseconds
+		 */
+		inline uint64_t getReplayDurationNs() const { return m_ReplayDurationNs; }
+
+	private:
+
+		// where the addresses and ports of a packet are, and their original values as stored in the packet
+		struct RewriteInfo
+		{
+			uint16_t networkOffset;
+			uint16_t transportOffset;
+			uint8_t ipVersion;
+			uint8_t ipProtocol;
+			uint32_t srcIP;
+			uint32_t dstIP;
+			uint16_t srcPort;
+			uint16_t dstPort;
+		};
+
+		PacketReplayConfiguration m_Config;
+		RawPacketSlabVector m_Packets;
+		// the original timestamp of each packet in nanoseconds
+		std::vector<uint64_t> m_Timestamps;
+		std::vector<RewriteInfo> m_RewriteInfo;
+		volatile bool m_StopRequested;
+		uint64_t m_NumOfPacketsSent;
+		uint64_t m_NumOfBytesSent;
+		uint64_t m_NumOfPacketsFailed;
+		uint32_t m_NumOfLoopsCompleted;
+		uint64_t m_ReplayDurationNs;
+
+		void addPacketInfo(const RawPacket* rawPacket);
+		bool isRewriteEnabled() const;
+		void rewritePacket(size_t packetIndex, uint32_t loop);
+		uint64_t getLoopDurationNs() const;
+		void sendBurst(RawPacket** burst, int burstLen, OnSendPackets onSendPackets, void* userCookie);
+		void waitUntil(uint64_t timeNs);
+
+		static int sendThroughLiveDevice(RawPacket** packets, int numOfPackets, void* device);
+
+		// disable copy c'tor and assignment operator
+		PacketReplayer(const PacketReplayer& other);
+		PacketReplayer& operator=(const PacketReplayer& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_PACKET_REPLAYER */
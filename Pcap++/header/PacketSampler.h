@@ -0,0 +1,193 @@
+#ifndef PCAPPP_PACKET_SAMPLER
+#define PCAPPP_PACKET_SAMPLER
+
+#include "RawPacket.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file
+ * Packet sampling applied by capture devices right after packets are received, before RawPacket objects are built for them, so
+ * packets which aren't sampled cost only the sampling decision. It's supported by PcapLiveDevice, DpdkDevice, PfRingDevice and the file
+ * reader devices (see IFileReaderDevice), which take a PacketSamplerConfiguration in their setSampling() method
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @struct PacketSamplerConfiguration
+	 * The sampling stages of a PacketSampler. A packet is sampled if it passes all enabled stages, which are applied in the order of the
+	 * members: flow sampling first, then 1-in-N sampling of the packets of the sampled flows, then the rate cap
+	 */
+	struct PacketSamplerConfiguration
+	{
+		/**
+		 * Sample the packets of one flow out of this number, by the symmetric hash of the flow 5-tuple (see FlowHash#hashSymmetric()), so
+		 * either all packets of a flow in both directions are sampled or none of them. Packets which aren't TCP or UDP over IP belong
+		 * to a single flow whose hash is 0, which is always sampled. 0 and 1 disable this stage
+		 */
+		uint32_t flowSamplingRate;
+		/**
+		 * Sample one packet out of this number: the first packet which passes flow sampling and then every N-th one, so the sample is
+		 * deterministic for a given input. 0 and 1 disable this stage
+		 */
+		uint32_t packetSamplingRate;
+		/**
+		 * The maximum average number of packets sampled per second, enforced by a token bucket over the packet timestamps. 0 disables this
+		 * stage
+		 */
+		uint64_t maxPacketsPerSecond;
+		/**
+		 * The size of the token bucket: the number of packets which may be sampled back to back above maxPacketsPerSecond after a quiet
+		 * period. 0 sets it to 1/100 of maxPacketsPerSecond, or 1 if that's lower
+		 */
+		uint32_t maxBurstSize;
+		/**
+		 * If true and the device provides a flow hash of its own, such as the RSS hash of DpdkDevice, flow sampling uses it instead of
+		 * parsing and hashing the packet headers. It's cheaper, but both directions of a flow are sampled together only if the device
+		 * calculates a symmetric hash
+		 */
+		bool useDeviceHash;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] flowSampling The value of #flowSamplingRate. Default value is 1
+		 * @param[in] packetSampling The value of #packetSamplingRate. Default value is 1
+		 * @param[in] maxPps The value of #maxPacketsPerSecond. Default value is 0
+		 * @param[in] burstSize The value of #maxBurstSize. Default value is 0
+		 * @param[in] deviceHash The value of #useDeviceHash. Default value is true
+		 */
+		PacketSamplerConfiguration(uint32_t flowSampling = 1, uint32_t packetSampling = 1, uint64_t maxPps = 0, uint32_t burstSize = 0, bool deviceHash = true) :
+			flowSamplingRate(flowSampling), packetSamplingRate(packetSampling), maxPacketsPerSecond(maxPps), maxBurstSize(burstSize), useDeviceHash(deviceHash) {}
+
+		/**
+		 * Get the configuration of one of several samplers which sample parts of the same traffic in parallel, such as the RX queues of
+		 * a device: the rate cap is divided between them and the other stages are the same
+		 * @param[in] numOfParts The number of samplers
+		 * @return The configuration of each sampler
+		 */
+		PacketSamplerConfiguration divide(int numOfParts) const;
+	};
+
+	/**
+	 * @class PacketSampler
+	 * Decides which packets are sampled by the stages of a PacketSamplerConfiguration. The decision is made from the packet data, before
+	 * a RawPacket is built, and the headers are parsed (by FlowKeyExtractor) only when flow sampling is enabled and no device hash is
+	 * given. A sampler keeps the state of its stages and isn't thread-safe, so devices keep one for each RX queue or capture thread
+	 */
+	class PacketSampler
+	{
+	public:
+		/**
+		 * A c'tor for this class which creates a sampler which samples all packets
+		 */
+		PacketSampler();
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The sampling stages
+		 */
+		explicit PacketSampler(const PacketSamplerConfiguration& config);
+
+		/**
+		 * Replace the sampling stages. The state of the stages and the counters are reset
+		 * @param[in] config The sampling stages
+		 */
+		void setConfiguration(const PacketSamplerConfiguration& config);
+
+		/**
+		 * @return The sampling stages
+		 */
+		inline const PacketSamplerConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * @return True if at least one sampling stage is enabled, false if all packets are sampled
+		 */
+		inline bool isEnabled() const { return m_Enabled; }
+
+		/**
+		 * Reset the state of the stages and the counters
+		 */
+		void reset();
+
+		/**
+		 * Decide whether to sample a packet
+		 * @param[in] packetData A pointer to the packet data, starting at the link layer
+		 * @param[in] packetDataLen The packet data length in bytes
+		 * @param[in] linkType The link layer type of the data
+		 * @param[in] timestampNs The packet timestamp (or the current time) in nanoseconds, used by the rate cap
+		 * @return True if the packet is sampled
+		 */
+		bool samplePacket(const uint8_t* packetData, size_t packetDataLen, LinkLayerType linkType, uint64_t timestampNs);
+
+		/**
+		 * Decide whether to sample a packet whose flow hash was already calculated, usually by the device which received it
+		 * @param[in] flowHash The flow hash of the packet
+		 * @param[in] timestampNs The packet timestamp (or the current time) in nanoseconds, used by the rate cap
+		 * @return True if the packet is sampled
+		 */
+		bool samplePacket(uint32_t flowHash, uint64_t timestampNs);
+
+		/**
+		 * Decide whether to sample a packet, using a flow hash calculated by the device if one is given and the configuration allows it
+		 * (see PacketSamplerConfiguration#useDeviceHash), and otherwise the hash of the packet headers
+		 * @param[in] packetData A pointer to the packet data, starting at the link layer
+		 * @param[in] packetDataLen The packet data length in bytes
+		 * @param[in] linkType The link layer type of the data
+		 * @param[in] timestampNs The packet timestamp (or the current time) in nanoseconds, used by the rate cap
+		 * @param[in] hasDeviceHash True if the device calculated a flow hash for the packet
+		 * @param[in] deviceHash The hash the device calculated
+		 * @return True if the packet is sampled
+		 */
+		inline bool samplePacket(const uint8_t* packetData, size_t packetDataLen, LinkLayerType linkType, uint64_t timestampNs, bool hasDeviceHash, uint32_t deviceHash)
+		{
+			if (hasDeviceHash && m_Config.useDeviceHash)
+				return samplePacket(deviceHash, timestampNs);
+			return samplePacket(packetData, packetDataLen, linkType, timestampNs);
+		}
+
+		/**
+		 * @return The number of packets the sampler decided on since it was configured or reset
+		 */
+		inline uint64_t getNumOfPackets() const { return m_NumOfPackets; }
+
+		/**
+		 * @return The number of packets sampled since the sampler was configured or reset
+		 */
+		inline uint64_t getNumOfSampledPackets() const { return m_NumOfSampledPackets; }
+
+		/**
+		 * Calculate the hash flow sampling uses for a packet: the symmetric hash of its 5-tuple, or 0 if it isn't TCP or UDP over IP
+		 * @param[in] packetData A pointer to the packet data, starting at the link layer
+		 * @param[in] packetDataLen The packet data length in bytes
+		 * @param[in] linkType The link layer type of the data
+		 * @return The hash
+		 */
+		static uint32_t getFlowHash(const uint8_t* packetData, size_t packetDataLen, LinkLayerType linkType);
+
+	private:
+		PacketSamplerConfiguration m_Config;
+		bool m_Enabled;
+		// flows whose hash is below the threshold are sampled
+		uint64_t m_FlowHashThreshold;
+		uint32_t m_PacketCountdown;
+		// the token bucket is kept as the theoretical arrival time of the next packet (GCRA), in 1/256 nanoseconds since the first packet
+		uint64_t m_PacketIntervalFixed;
+		uint64_t m_BurstToleranceFixed;
+		uint64_t m_NextArrivalFixed;
+		uint64_t m_FirstTimestampNs;
+		bool m_RateCapStarted;
+		uint64_t m_NumOfPackets;
+		uint64_t m_NumOfSampledPackets;
+
+		bool passRateCap(uint64_t timestampNs);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_PACKET_SAMPLER */
@@ -0,0 +1,302 @@
+#ifndef PCAPPP_PACKET_TABLE_WRITER
+#define PCAPPP_PACKET_TABLE_WRITER
+
+#include "ArrowFileWriter.h"
+#include "FlowMeter.h"
+#include "RawPacket.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+
+/// @file
+
+/**
+ * The maximum length of the strings of a PacketRecord (DNS query name, HTTP host and TLS server name). Longer strings are truncated
+ */
+#define PCPP_PACKET_RECORD_MAX_STRING_LEN 255
+
+/**
+ * The maximum length of the HTTP method of a PacketRecord
+ */
+#define PCPP_PACKET_RECORD_MAX_METHOD_LEN 15
+
+/**
+ * The number of records a worker of PacketTableWriter#writePackets() extracts before adding them to the table
+ */
+#define PCPP_PACKET_TABLE_WORKER_BATCH_SIZE 1024
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	class IFileReaderDevice;
+	class PcapFileIndex;
+
+	/**
+	 * @struct PacketRecord
+	 * The metadata of a packet which makes a row of the table PacketTableWriter writes. It's filled by PacketTableWriter#extractRecord()
+	 * without creating Layer objects. Strings aren't null-terminated, and a string whose length is 0 is missing from the packet
+	 */
+	struct PacketRecord
+	{
+		/** The packet timestamp in nanoseconds since the epoch */
+		uint64_t timestampNs;
+		/** The length of the packet on the wire */
+		uint32_t length;
+		/** The length of the captured data */
+		uint32_t capturedLength;
+		/** The IP version (4 or 6), or 0 if the packet doesn't contain an IP header */
+		uint8_t ipVersion;
+		/** The IP protocol of the data following the IP header, or 0 if the packet doesn't contain an IP header */
+		uint8_t ipProtocol;
+		/** The TCP flags byte, or 0 if the packet isn't TCP */
+		uint8_t tcpFlags;
+		/** The VLAN ID of the outermost VLAN tag, or 0 if the packet has no VLAN tag */
+		uint16_t vlanId;
+		/** The source port, or 0 if the packet isn't TCP or UDP */
+		uint16_t srcPort;
+		/** The destination port, or 0 if the packet isn't TCP or UDP */
+		uint16_t dstPort;
+		/** The length of the TCP or UDP payload, or 0 if the packet isn't TCP or UDP */
+		uint32_t payloadLength;
+		/** The source IP address in network byte order. For IPv4 only the first 4 bytes are used */
+		uint8_t srcIP[16];
+		/** The destination IP address in network byte order. For IPv4 only the first 4 bytes are used */
+		uint8_t dstIP[16];
+		/** The name of the first query of a DNS message (a UDP packet from or to port 53 or 5353) */
+		char dnsQuery[PCPP_PACKET_RECORD_MAX_STRING_LEN];
+		/** The length of #dnsQuery */
+		uint16_t dnsQueryLength;
+		/** The method of an HTTP request (a TCP payload starting with a request line) */
+		char httpMethod[PCPP_PACKET_RECORD_MAX_METHOD_LEN];
+		/** The length of #httpMethod */
+		uint16_t httpMethodLength;
+		/** The value of the Host header of an HTTP request, if it's in the same packet as the request line */
+		char httpHost[PCPP_PACKET_RECORD_MAX_STRING_LEN];
+		/** The length of #httpHost */
+		uint16_t httpHostLength;
+		/** The server name indication of a TLS client-hello message which starts the TCP payload */
+		char tlsServerName[PCPP_PACKET_RECORD_MAX_STRING_LEN];
+		/** The length of #tlsServerName */
+		uint16_t tlsServerNameLength;
+	};
+
+
+	/**
+	 * @class PacketTableWriter
+	 * Exports the metadata of packets as a table in an Arrow IPC (Feather version 2) file, to be analyzed by Arrow based tools such as
+	 * pandas, polars or DuckDB (see ArrowFileWriter). Each packet is a row with these columns:
+	 * - timestamp (UTC timestamp in nanoseconds), length and captured_length
+	 * - ip_version, src_ip and dst_ip (strings, null for packets without an IP header), ip_protocol, src_port, dst_port, tcp_flags,
+	 *   vlan_id and payload_length (0 when the packet doesn't have them)
+	 * - dns_query, http_method, http_host and tls_sni (strings, null when the packet doesn't have them)
+	 *
+	 * Fields are read by FlowKeyExtractor and by allocation-free parsers of the payload (DnsMessageView, SSLClientHelloFingerprint), without
+	 * creating Layer objects. All string columns are dictionary encoded.<BR>
+	 * Packets can be added one by one, for example from the callback of a live device, or read from a file reader device. An indexed file
+	 * (see PcapFileIndex) can be read by several worker threads which extract the fields in parallel, in which case the rows aren't in file
+	 * order (they can be sorted by timestamp by the analysis tool). The methods which add rows are thread safe
+	 */
+	class PacketTableWriter
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] fileName The full path of the file to write. An existing file is overwritten when the writer is opened
+		 * @param[in] rowsPerBatch The number of rows in a record batch. The default is #PCPP_ARROW_DEFAULT_ROWS_PER_BATCH
+		 */
+		PacketTableWriter(const std::string& fileName, size_t rowsPerBatch = PCPP_ARROW_DEFAULT_ROWS_PER_BATCH);
+
+		/**
+		 * A d'tor for this class. Closes the file if it's still open
+		 */
+		~PacketTableWriter();
+
+		/**
+		 * Create the file
+		 * @return True if the file was created, false otherwise (an error will be printed to log)
+		 */
+		bool open();
+
+		/**
+		 * Write the buffered rows and the dictionaries and close the file
+		 * @return False if the writer isn't open or the file couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool close();
+
+		/**
+		 * Fill a record from a raw packet
+		 * @param[in] rawPacket The packet
+		 * @param[out] record The record to fill. All its fields are overwritten
+		 */
+		static void extractRecord(const RawPacket& rawPacket, PacketRecord& record);
+
+		/**
+		 * Add a row to the table
+		 * @param[in] record The row
+		 * @return False if the writer isn't open or a record batch couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool writeRecord(const PacketRecord& record);
+
+		/**
+		 * Add rows to the table at once, which takes the writer's lock once
+		 * @param[in] records The rows
+		 * @param[in] numOfRecords The number of rows
+		 * @return False if the writer isn't open or a record batch couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool writeRecords(const PacketRecord* records, size_t numOfRecords);
+
+		/**
+		 * Extract the fields of a packet and add them as a row to the table
+		 * @param[in] rawPacket The packet
+		 * @return False if the writer isn't open or a record batch couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool writePacket(const RawPacket& rawPacket);
+
+		/**
+		 * Add all packets of an open file reader device, in file order
+		 * @param[in] reader The reader to read the packets from
+		 * @return False if the writer isn't open or a record batch couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool writePackets(IFileReaderDevice& reader);
+
+		/**
+		 * Add all packets of an indexed file, reading them and extracting their fields in several worker threads (see
+		 * ParallelPcapFileReader). Each worker adds its rows in batches of #PCPP_PACKET_TABLE_WORKER_BATCH_SIZE, so the rows aren't in file
+		 * order
+		 * @param[in] index The index of the file
+		 * @param[in] numOfWorkers The number of worker threads
+		 * @return False if the writer isn't open, the file couldn't be read or a record batch couldn't be written (an error will be
+		 * printed to log), true otherwise
+		 */
+		bool writePackets(const PcapFileIndex& index, int numOfWorkers);
+
+		/**
+		 * @return The number of rows added so far
+		 */
+		uint64_t getNumOfRows();
+
+	private:
+		ArrowFileWriter m_Writer;
+		pthread_mutex_t m_Mutex;
+		bool m_WriteFailed;
+		int m_TimestampColumn;
+		int m_LengthColumn;
+		int m_CapturedLengthColumn;
+		int m_IPVersionColumn;
+		int m_SrcIPColumn;
+		int m_DstIPColumn;
+		int m_IPProtocolColumn;
+		int m_SrcPortColumn;
+		int m_DstPortColumn;
+		int m_TcpFlagsColumn;
+		int m_VlanIdColumn;
+		int m_PayloadLengthColumn;
+		int m_DnsQueryColumn;
+		int m_HttpMethodColumn;
+		int m_HttpHostColumn;
+		int m_TlsServerNameColumn;
+
+		bool addRow(const PacketRecord& record);
+		static void onPacketRead(RawPacket& rawPacket, uint64_t packetNumber, int workerIndex, void* userCookie);
+
+		// disable copy c'tor and assignment operator
+		PacketTableWriter(const PacketTableWriter& other);
+		PacketTableWriter& operator=(const PacketTableWriter& other);
+	};
+
+
+	/**
+	 * @class FlowTableWriter
+	 * Exports flow records (usually exported by a FlowMeter) as a table in an Arrow IPC (Feather version 2) file. Each flow is a row with
+	 * the columns src_ip, dst_ip (strings), src_port, dst_port, ip_protocol, vlan_id, tunnel_id, mpls_label, tos, tcp_flags, end_reason
+	 * (see ::FlowEndReason), packets, bytes, first_seen and last_seen (UTC timestamps in milliseconds). It can be connected to a FlowMeter
+	 * directly:
+	 *
+	 *     FlowTableWriter flowWriter("flows.arrow");
+	 *     flowWriter.open();
+	 *     FlowMeter meter(FlowMeterConfiguration(), FlowTableWriter::onFlowExported, &flowWriter);
+	 *     ...
+	 *     meter.flush();
+	 *     flowWriter.close();
+	 *
+	 * writeFlowRecord() is thread safe
+	 */
+	class FlowTableWriter
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] fileName The full path of the file to write. An existing file is overwritten when the writer is opened
+		 * @param[in] rowsPerBatch The number of rows in a record batch. The default is #PCPP_ARROW_DEFAULT_ROWS_PER_BATCH
+		 */
+		FlowTableWriter(const std::string& fileName, size_t rowsPerBatch = PCPP_ARROW_DEFAULT_ROWS_PER_BATCH);
+
+		/**
+		 * A d'tor for this class. Closes the file if it's still open
+		 */
+		~FlowTableWriter();
+
+		/**
+		 * Create the file
+		 * @return True if the file was created, false otherwise (an error will be printed to log)
+		 */
+		bool open();
+
+		/**
+		 * Write the buffered rows and the dictionaries and close the file
+		 * @return False if the writer isn't open or the file couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool close();
+
+		/**
+		 * Add a flow as a row to the table
+		 * @param[in] record The flow record
+		 * @return False if the writer isn't open or a record batch couldn't be written (an error will be printed to log), true otherwise
+		 */
+		bool writeFlowRecord(const FlowRecord& record);
+
+		/**
+		 * A FlowMeter export callback which adds the flow to the table. The cookie must be a pointer to an open FlowTableWriter
+		 * @param[in] record The flow record
+		 * @param[in] userCookie A pointer to the FlowTableWriter
+		 */
+		static void onFlowExported(const FlowRecord& record, void* userCookie);
+
+		/**
+		 * @return The number of rows added so far
+		 */
+		uint64_t getNumOfRows();
+
+	private:
+		ArrowFileWriter m_Writer;
+		pthread_mutex_t m_Mutex;
+		int m_SrcIPColumn;
+		int m_DstIPColumn;
+		int m_SrcPortColumn;
+		int m_DstPortColumn;
+		int m_IPProtocolColumn;
+		int m_VlanIdColumn;
+		int m_TunnelIdColumn;
+		int m_MplsLabelColumn;
+		int m_TosColumn;
+		int m_TcpFlagsColumn;
+		int m_EndReasonColumn;
+		int m_PacketsColumn;
+		int m_BytesColumn;
+		int m_FirstSeenColumn;
+		int m_LastSeenColumn;
+
+		// disable copy c'tor and assignment operator
+		FlowTableWriter(const FlowTableWriter& other);
+		FlowTableWriter& operator=(const FlowTableWriter& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_PACKET_TABLE_WRITER */
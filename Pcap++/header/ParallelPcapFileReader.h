@@ -0,0 +1,113 @@
+#ifndef PCAPPP_PARALLEL_PCAP_FILE_READER
+#define PCAPPP_PARALLEL_PCAP_FILE_READER
+
+#include "PcapFileIndex.h"
+#include <pthread.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The default number of packets ParallelPcapFileReader reads at once in ordered mode
+ */
+#define PCPP_PARALLEL_READER_DEFAULT_BATCH_SIZE 1024
+
+	/**
+	 * @class ParallelPcapFileReader
+	 * Reads the packets of an indexed pcap or pcap-ng file (see PcapFileIndex) in several worker threads and hands them to a callback. There
+	 * are two modes of reading:
+	 * - Unordered: the packets are split into one contiguous range per worker and each worker reads and hands over its range in file order.
+	 *   The callback is called by all workers concurrently, each packet with its number in the file, so results can be merged in file
+	 *   order if needed. This is the mode for processing which is independent per packet or per worker
+	 * - Ordered: the packets are split into batches which are assigned to the workers in turns. The workers read their batches in parallel
+	 *   but hand them over one batch at a time in file order, so the callback is called for all packets in the order of the file, never
+	 *   concurrently. This is the mode for processing which needs the global order, such as TCP reassembly, while still reading in parallel
+	 *
+	 * In both modes packets keep their original timestamps. The raw packet passed to the callback points to the buffer of the worker and
+	 * is valid only during the callback; a packet which has to be kept must be copied
+	 */
+	class ParallelPcapFileReader
+	{
+	public:
+
+		/**
+		 * The callback invoked for each packet read
+		 * @param[in] rawPacket The packet. It's valid only during the callback
+		 * @param[in] packetNumber The number of the packet in the file, starting at 0
+		 * @param[in] workerIndex The index of the worker which read the packet
+		 * @param[in] userCookie A pointer to the cookie provided by the user in read()
+		 */
+		typedef void (*OnPacketRead)(RawPacket& rawPacket, uint64_t packetNumber, int workerIndex, void* userCookie);
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] index The index of the file to read. It must outlive this instance
+		 */
+		ParallelPcapFileReader(const PcapFileIndex& index);
+
+		/**
+		 * Read all packets of the file. The method returns when all workers are done
+		 * @param[in] onPacketRead The callback invoked for each packet
+		 * @param[in] userCookie A pointer to a user provided object passed to the callback
+		 * @param[in] numOfWorkers The number of worker threads. If it's larger than the number of packets fewer workers are used
+		 * @param[in] preserveOrder If set to true the packets are handed over in file order (see the ordered mode above). Default value is false
+		 * @param[in] batchSize The number of packets a worker reads at once in ordered mode. Default value is
+		 * #PCPP_PARALLEL_READER_DEFAULT_BATCH_SIZE
+		 * @return True if all packets were read, false if the arguments are invalid, a worker couldn't be started or a packet couldn't be
+		 * read (an error is printed to log). When a packet can't be read the other workers stop as well
+		 */
+		bool read(OnPacketRead onPacketRead, void* userCookie, int numOfWorkers, bool preserveOrder = false, size_t batchSize = PCPP_PARALLEL_READER_DEFAULT_BATCH_SIZE);
+
+		/**
+		 * @return The number of packets read and handed to the callback by the last call to read()
+		 */
+		inline uint64_t getNumOfPacketsRead() const { return m_NumOfPacketsRead; }
+
+	private:
+
+		struct Worker
+		{
+			ParallelPcapFileReader* reader;
+			int workerIndex;
+			// the range of packets of the worker in unordered mode
+			uint64_t firstPacket;
+			uint64_t endPacket;
+			uint64_t numOfPacketsRead;
+			pthread_t thread;
+		};
+
+		const PcapFileIndex& m_Index;
+		OnPacketRead m_OnPacketRead;
+		void* m_UserCookie;
+		int m_NumOfWorkers;
+		bool m_PreserveOrder;
+		size_t m_BatchSize;
+		uint64_t m_NumOfPacketsRead;
+		// ordered mode: the batch whose turn it is to be handed over, and whether a worker failed
+		uint64_t m_NextBatch;
+		bool m_Failed;
+		pthread_mutex_t m_Mutex;
+		pthread_cond_t m_TurnChanged;
+
+		static void* workerThreadMain(void* worker);
+		void readRange(Worker& worker);
+		void readBatches(Worker& worker);
+		bool waitForTurn(uint64_t batch);
+		void endTurn();
+		void setFailed();
+		bool hasFailed();
+
+		// disable copy c'tor and assignment operator
+		ParallelPcapFileReader(const ParallelPcapFileReader& other);
+		ParallelPcapFileReader& operator=(const ParallelPcapFileReader& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_PARALLEL_PCAP_FILE_READER */
@@ -0,0 +1,242 @@
+#ifndef PCAPPP_PCAP_AUTO_TUNER
+#define PCAPPP_PCAP_AUTO_TUNER
+
+#include <stdint.h>
+
+/**
+ * @file
+ * Automatic tuning of the kernel buffer size, the packet buffer timeout and (on WinPcap) the minimum amount of data copied to the
+ * application, of pcap-based live devices. It's supported by PcapLiveDevice and WinPcapLiveDevice, which take a PcapAutoTunerConfiguration
+ * in their setAutoTuning() method
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @struct PcapAutoTunerSettings
+	 * The values a PcapAutoTuner tunes
+	 */
+	struct PcapAutoTunerSettings
+	{
+		/** The kernel buffer size in bytes (see PcapLiveDevice#DeviceConfiguration#packetBufferSize) */
+		int bufferSize;
+		/** The packet buffer timeout in milliseconds (see PcapLiveDevice#DeviceConfiguration#packetBufferTimeoutMs) */
+		int timeoutMs;
+		/** The minimum amount of data in bytes the kernel buffer holds before a read returns (see
+		 * WinPcapLiveDevice#setMinAmountOfDataToCopyFromKernelToApplication()), or 0 if it isn't tuned
+		 */
+		int minToCopy;
+	};
+
+
+	/**
+	 * @struct PcapAutoTunerConfiguration
+	 * The bounds and the pace of a PcapAutoTuner. Each value is tuned between its minimum and its maximum, and a value whose minimum equals
+	 * its maximum is fixed
+	 */
+	struct PcapAutoTunerConfiguration
+	{
+		/** The smallest kernel buffer size in bytes. It's also the size used when the device was opened with the OS default size */
+		int minBufferSize;
+		/** The largest kernel buffer size in bytes. 0 disables auto-tuning */
+		int maxBufferSize;
+		/** The shortest packet buffer timeout in milliseconds */
+		int minTimeoutMs;
+		/** The longest packet buffer timeout in milliseconds */
+		int maxTimeoutMs;
+		/** The smallest minimum amount of data to copy in bytes. Relevant for WinPcapLiveDevice only, 0 leaves it unchanged */
+		int minMinToCopy;
+		/** The largest minimum amount of data to copy in bytes. Relevant for WinPcapLiveDevice only, 0 leaves it unchanged */
+		int maxMinToCopy;
+		/** The time in milliseconds between two evaluations of the drop counters and the batch sizes */
+		uint32_t evaluationIntervalMs;
+		/** The fraction of the packets received in an interval which may be dropped without making the tuner react. 0 means any drop */
+		double maxDropRatio;
+		/** The number of consecutive intervals without drops after which the timeout and the minimum amount of data to copy are lowered,
+		 * if the batches are small
+		 */
+		uint32_t quietIntervalsBeforeDecrease;
+		/** The average number of packets per pcap_dispatch() call below which the batches are considered small, so latency can be lowered
+		 * without the risk of drops
+		 */
+		uint32_t smallBatchSize;
+		/** The number of intervals after a change of the buffer size or the timeout in which no other change is made. On libpcap these
+		 * changes reopen the capture handle, so this bounds how often that happens
+		 */
+		uint32_t cooldownIntervals;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] minBufferSize The smallest kernel buffer size in bytes. Default value is 2MB
+		 * @param[in] maxBufferSize The largest kernel buffer size in bytes. Default value is 256MB
+		 * @param[in] minTimeoutMs The shortest packet buffer timeout in milliseconds. Default value is 1
+		 * @param[in] maxTimeoutMs The longest packet buffer timeout in milliseconds. Default value is 100
+		 */
+		PcapAutoTunerConfiguration(int minBufferSize = 2 * 1024 * 1024, int maxBufferSize = 256 * 1024 * 1024, int minTimeoutMs = 1, int maxTimeoutMs = 100) :
+			minBufferSize(minBufferSize), maxBufferSize(maxBufferSize), minTimeoutMs(minTimeoutMs), maxTimeoutMs(maxTimeoutMs),
+			minMinToCopy(0), maxMinToCopy(0), evaluationIntervalMs(1000), maxDropRatio(0), quietIntervalsBeforeDecrease(30),
+			smallBatchSize(8), cooldownIntervals(5) {}
+	};
+
+
+	/**
+	 * @struct PcapAutoTunerStats
+	 * The decisions of a PcapAutoTuner
+	 */
+	struct PcapAutoTunerStats
+	{
+		/** Number of intervals evaluated */
+		uint64_t evaluations;
+		/** Number of intervals in which packets were dropped beyond PcapAutoTunerConfiguration#maxDropRatio */
+		uint64_t intervalsWithDrops;
+		/** Number of intervals with drops in which all values were already at their maximum, so nothing could be changed */
+		uint64_t intervalsWithDropsAtLimits;
+		/** Number of times the buffer size was increased */
+		uint64_t bufferIncreases;
+		/** Number of times the timeout was increased */
+		uint64_t timeoutIncreases;
+		/** Number of times the timeout was decreased */
+		uint64_t timeoutDecreases;
+		/** Number of times the minimum amount of data to copy was increased */
+		uint64_t minToCopyIncreases;
+		/** Number of times the minimum amount of data to copy was decreased */
+		uint64_t minToCopyDecreases;
+		/** The packets dropped in the last interval evaluated */
+		uint64_t lastIntervalDrops;
+		/** The average number of packets per pcap_dispatch() call in the last interval evaluated */
+		double lastAverageBatchSize;
+		/** The current values */
+		PcapAutoTunerSettings settings;
+	};
+
+
+	/**
+	 * @class PcapAutoTuner
+	 * Tunes the kernel buffer size, the packet buffer timeout and the minimum amount of data to copy of a live device by watching its drop
+	 * counters and the number of packets each pcap_dispatch() call returns:
+	 * - When packets are dropped, the buffer size is doubled, up to its maximum. When the buffer is already at its maximum, the timeout and the
+	 *   minimum amount of data to copy are doubled instead, so the application is woken up less often and reads larger batches
+	 * - After PcapAutoTunerConfiguration#quietIntervalsBeforeDecrease intervals without drops in which the batches were small, the timeout and
+	 *   the minimum amount of data to copy are halved, down to their minimum, which lowers the latency when traffic is low. The buffer size
+	 *   isn't decreased, since a smaller buffer saves memory but risks drops on the next traffic burst
+	 *
+	 * After changing the buffer size or the timeout the tuner waits PcapAutoTunerConfiguration#cooldownIntervals before making another change,
+	 * so the effect of a change is measured before the next one and a device isn't reconfigured continuously. All values stay within their
+	 * configured bounds, so a tuner can run indefinitely.<BR>
+	 * The tuner only makes decisions; the device applies them (see PcapLiveDevice#setAutoTuning()). It holds no global state and isn't
+	 * thread-safe, so each device has its own tuner, used by its capture thread
+	 */
+	class PcapAutoTuner
+	{
+	public:
+
+		/**
+		 * The values changed by an evaluation, returned by evaluate() as a bitmask
+		 */
+		enum Change
+		{
+			/** No value was changed */
+			NoChange = 0,
+			/** The buffer size was changed */
+			BufferSizeChanged = 1,
+			/** The timeout was changed */
+			TimeoutChanged = 2,
+			/** The minimum amount of data to copy was changed */
+			MinToCopyChanged = 4
+		};
+
+		/**
+		 * A c'tor for this class. The tuner is disabled until configure() is called
+		 */
+		PcapAutoTuner();
+
+		/**
+		 * Enable the tuner and set its bounds. The statistics and the counters are reset
+		 * @param[in] config The bounds and the pace of the tuner
+		 * @param[in] initialSettings The values the device currently uses. Values outside of the bounds are clamped to them, and a buffer size
+		 * or timeout of 0 or less (the OS default) is replaced with the minimum
+		 */
+		void configure(const PcapAutoTunerConfiguration& config, const PcapAutoTunerSettings& initialSettings);
+
+		/**
+		 * Disable the tuner
+		 */
+		void disable();
+
+		/**
+		 * @return True if the tuner was configured with a non-zero maximum buffer size
+		 */
+		inline bool isEnabled() const { return m_Config.maxBufferSize > 0; }
+
+		/**
+		 * @return The bounds and the pace of the tuner
+		 */
+		inline const PcapAutoTunerConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * Record the number of packets returned by a pcap_dispatch() call. Calls which returned no packets (the timeout expired) aren't counted
+		 * @param[in] numOfPackets The return value of pcap_dispatch()
+		 */
+		inline void onDispatch(int numOfPackets)
+		{
+			if (numOfPackets <= 0)
+				return;
+			m_IntervalPackets += (uint64_t)numOfPackets;
+			m_IntervalDispatches++;
+		}
+
+		/**
+		 * @param[in] nowMs The current time in milliseconds
+		 * @return True if the evaluation interval passed since the previous evaluation
+		 */
+		inline bool isEvaluationDue(uint64_t nowMs) const { return nowMs - m_LastEvaluationMs >= m_Config.evaluationIntervalMs; }
+
+		/**
+		 * Evaluate the interval which ended and decide whether to change the values. The first evaluation after configure() or
+		 * resetCounters() only records the counters
+		 * @param[in] nowMs The current time in milliseconds
+		 * @param[in] numOfReceived The number of packets the device received so far (pcap_stat#ps_recv)
+		 * @param[in] numOfDropped The number of packets the device dropped so far (pcap_stat#ps_drop plus pcap_stat#ps_ifdrop)
+		 * @return A bitmask of the Change values the device should apply. The new values are returned by getSettings()
+		 */
+		int evaluate(uint64_t nowMs, uint64_t numOfReceived, uint64_t numOfDropped);
+
+		/**
+		 * Restart counting from the next evaluation, for example after the capture handle was replaced and its counters started from 0
+		 */
+		void resetCounters();
+
+		/**
+		 * @return The current values
+		 */
+		inline const PcapAutoTunerSettings& getSettings() const { return m_Settings; }
+
+		/**
+		 * Get the decisions of the tuner since it was configured
+		 * @param[out] stats The statistics
+		 */
+		void getStats(PcapAutoTunerStats& stats) const;
+
+	private:
+
+		PcapAutoTunerConfiguration m_Config;
+		PcapAutoTunerSettings m_Settings;
+		PcapAutoTunerStats m_Stats;
+		bool m_HasBaseline;
+		uint64_t m_LastReceived;
+		uint64_t m_LastDropped;
+		uint64_t m_LastEvaluationMs;
+		uint64_t m_IntervalPackets;
+		uint64_t m_IntervalDispatches;
+		uint32_t m_QuietIntervals;
+		uint32_t m_CooldownIntervals;
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_PCAP_AUTO_TUNER */
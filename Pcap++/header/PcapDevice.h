@@ -52,6 +52,13 @@ namespace pcpp
 		 */
 		virtual void getStatistics(pcap_stat& stats) = 0;
 
+		/**
+		 * Report the getStatistics() counters to a MetricsRegistry snapshot: pcpp_device_rx_packets_total,
+		 * pcpp_device_rx_dropped_packets_total and pcpp_device_rx_if_dropped_packets_total
+		 * @param[in] writer The writer to report the values to
+		 */
+		virtual void collectMetrics(MetricsWriter& writer);
+
 		/**
 		 * A static method for retreiving pcap lib (libpcap/WinPcap/etc.) version information. This method is actually
 		 * a wrapper for [pcap_lib_version()](https://www.tcpdump.org/manpages/pcap_lib_version.3pcap.html)
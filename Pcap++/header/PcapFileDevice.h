@@ -2,7 +2,15 @@
 #define PCAPPP_FILE_DEVICE
 
 #include "PcapDevice.h"
+#include "PcapFilter.h"
 #include "RawPacket.h"
+#include "RawPacketPool.h"
+#include "RawPacketSlabVector.h"
+#include "PcapFileIndex.h"
+#include "PcapFileSummary.h"
+#include "PacketSampler.h"
+#include <stdio.h>
+#include <pthread.h>
 
 /// @file
 
@@ -51,6 +59,9 @@ namespace pcpp
 	protected:
 		uint32_t m_NumOfPacketsRead;
 		uint32_t m_NumOfPacketsNotParsed;
+		RawPacketPool* m_RawPacketPool;
+		PcapFileIndex* m_Index;
+		PacketSampler m_Sampler;
 
 		/**
 		 * A constructor for this class that gets the pcap full path file name to open. Notice that after calling this constructor the file
@@ -59,12 +70,28 @@ namespace pcpp
 		 */
 		IFileReaderDevice(const char* fileName);
 
+		/**
+		 * Move the opened file to a record, so the next packet read is the packet of this record. Readers which support seeking override
+		 * this method, the default implementation fails
+		 * @param[in] offset The file offset of a packet record, or the file size for moving to the end of the file
+		 * @return True if the file was moved to the record, false otherwise
+		 */
+		virtual bool seekToOffset(uint64_t offset);
+
+		bool prepareIndex();
+
+		// readers call it for each packet record which passes the filter, and skip the ones which aren't sampled
+		inline bool isPacketSampled(const uint8_t* packetData, uint32_t packetDataLen, LinkLayerType linkType, uint64_t timestampNs)
+		{
+			return !m_Sampler.isEnabled() || m_Sampler.samplePacket(packetData, packetDataLen, linkType, timestampNs);
+		}
+
 	public:
 
 		/**
 		 * A destructor for this class
 		 */
-		virtual ~IFileReaderDevice() {}
+		virtual ~IFileReaderDevice();
 
 		/**
 		* @return The file size in bytes
@@ -82,6 +109,86 @@ namespace pcpp
 		 */
 		int getNextPackets(RawPacketVector& packetVec, int numOfPacketsToRead = -1);
 
+		/**
+		 * Read the next N packets into a RawPacketSlabVector. Packets are copied into the vector's slabs, so unlike reading into a
+		 * RawPacketVector no memory is allocated per packet. This is the preferred way of loading large files into memory
+		 * @param[out] packetVec The slab vector to add packets to
+		 * @param[in] numOfPacketsToRead Number of packets to read. If value <0 all remaining packets in the file will be read into the
+		 * vector (this is the default value)
+		 * @return The number of packets actually read
+		 */
+		int getNextPackets(RawPacketSlabVector& packetVec, int numOfPacketsToRead = -1);
+
+		/**
+		 * Set a pool to take the raw data buffers of packets read from the file from, instead of allocating a new buffer on the heap for
+		 * each packet (see RawPacket#copyRawData()). Please notice the pool must outlive all packets read while it was set
+		 * @param[in] pool The pool to use, or NULL for allocating buffers on the heap (which is the default)
+		 */
+		inline void setRawPacketPool(RawPacketPool* pool) { m_RawPacketPool = pool; }
+
+		/**
+		 * @return The pool raw data buffers are taken from, or NULL if buffers are allocated on the heap
+		 */
+		inline RawPacketPool* getRawPacketPool() const { return m_RawPacketPool; }
+
+		/**
+		 * Sample the packets read from the file (see PacketSampler): packets which aren't sampled are skipped before they're copied to a
+		 * RawPacket, the same way packets which don't match the filter are. The rate cap uses the packet timestamps, so it limits the
+		 * packets per second of capture time rather than of reading time. Setting sampling resets the sampler, seeking doesn't
+		 * @param[in] config The sampling stages
+		 */
+		inline void setSampling(const PacketSamplerConfiguration& config) { m_Sampler.setConfiguration(config); }
+
+		/**
+		 * Stop sampling the packets read from the file
+		 */
+		inline void clearSampling() { m_Sampler.setConfiguration(PacketSamplerConfiguration()); }
+
+		/**
+		 * @return The sampler of the packets read from the file, which holds the sampling counters
+		 */
+		inline const PacketSampler& getSampler() const { return m_Sampler; }
+
+		/**
+		 * Load the index used for seeking (see seekToPacket() and seekToTime()) from a sidecar file saved by PcapFileIndex#save(). If no index
+		 * is loaded, the first seek loads it from the default sidecar file of the file or builds it by scanning the file once (see
+		 * PcapFileIndex#loadOrBuild())
+		 * @param[in] indexFileName The sidecar file name
+		 * @return True if the index was loaded, false if it can't be read or was built for another file
+		 */
+		bool loadIndex(const std::string& indexFileName);
+
+		/**
+		 * @return The index used for seeking, or NULL if it wasn't loaded or built yet
+		 */
+		inline const PcapFileIndex* getIndex() const { return m_Index; }
+
+		/**
+		 * Move the opened file to a packet, so the next packet read is this packet. Seeking is supported by PcapFileReaderDevice,
+		 * PcapNgFileReaderDevice (for uncompressed files), MmapPcapFileReaderDevice and BufferedPcapFileReaderDevice
+		 * @param[in] packetNumber The number of the packet in the file, starting at 0. The number of packets in the file moves to the end of
+		 * the file
+		 * @return True if the file was moved to the packet, false if the file isn't opened, the reader doesn't support seeking, the file can't be
+		 * indexed or the number is out of range
+		 */
+		bool seekToPacket(uint64_t packetNumber);
+
+		/**
+		 * Move the opened file to the first packet at or after a point in time, so "packets between T1 and T2" are read by seeking to T1 and
+		 * reading until a packet later than T2. The packet is found with the sparse time index of the file (see
+		 * PcapFileIndex#findPacketByTime()) and the file is moved to its end if all packets are earlier
+		 * @param[in] timestamp The point in time
+		 * @return True if the file was moved, false if the file isn't opened, the reader doesn't support seeking or the file can't be indexed
+		 */
+		bool seekToTime(const timespec& timestamp);
+
+		/**
+		 * Same as seekToTime(const timespec&), for a point in time of microsecond precision
+		 * @param[in] timestamp The point in time
+		 * @return True if the file was moved, false otherwise
+		 */
+		bool seekToTime(const timeval& timestamp);
+
 		/**
 		 * A static method that creates an instance of the reader best fit to read the file. It decides by the file extension: for .pcapng
 		 * files it returns an instance of PcapNgFileReaderDevice and for all other extensions it returns an instance of PcapFileReaderDevice
@@ -105,6 +212,9 @@ namespace pcpp
 		PcapFileReaderDevice(const PcapFileReaderDevice& other);
 		PcapFileReaderDevice& operator=(const PcapFileReaderDevice& other);
 
+	protected:
+		bool seekToOffset(uint64_t offset);
+
 	public:
 		/**
 		 * A constructor for this class that gets the pcap full path file name to open. Notice that after calling this constructor the file
@@ -151,15 +261,18 @@ namespace pcpp
 
 	/**
 	 * @class PcapNgFileReaderDevice
-	 * A class for opening a pcap-ng file in read-only mode. This class enable to open the file and read all packets, packet-by-packet
+	 * A class for opening a pcap-ng file in read-only mode. This class enable to open the file and read all packets, packet-by-packet.
+	 * The file is read in large chunks into a buffer and packet blocks are parsed in place: other blocks are skipped without being parsed,
+	 * and the options of a packet block are scanned only when its comment is requested. Packets are copied from the buffer into the raw
+	 * packets, unless the device is created in zero-copy mode where the raw packets point into the buffer (see the c'tor)
 	 */
 	class PcapNgFileReaderDevice : public IFileReaderDevice
 	{
 	private:
 		void* m_LightPcapNg;
-		struct bpf_program m_Bpf;
-		bool m_BpfInitialized;
-		int m_BpfLinkType;
+		int m_NumOfDecompressionWorkers;
+		bool m_ZeroCopy;
+		BpfFilterProgram m_BpfProgram;
 		std::string m_CurFilter;
 
 		// private copy c'tor
@@ -167,14 +280,26 @@ namespace pcpp
 		PcapNgFileReaderDevice& operator=(const PcapNgFileReaderDevice& other);
 
 		bool matchPacketWithFilter(const uint8_t* packetData, size_t packetLen, timeval packetTimestamp, uint16_t linkType);
+		bool readNextPacket(RawPacket& rawPacket, std::string* packetComment);
+
+	protected:
+		bool seekToOffset(uint64_t offset);
 
 	public:
 		/**
 		 * A constructor for this class that gets the pcap-ng full path file name to open. Notice that after calling this constructor the file
 		 * isn't opened yet, so reading packets will fail. For opening the file call open()
 		 * @param[in] fileName The full path of the file to read
+		 * @param[in] numOfDecompressionWorkers The number of threads decompressing a compressed file ahead of reading it. Files written
+		 * by PcapNgFileWriterDevice with compression workers consist of independent frames which are decompressed in parallel, other
+		 * compressed files are decompressed by the reading thread. Use 0 to always decompress in the reading thread. Default is 0
+		 * @param[in] zeroCopy If set to true packets aren't copied: the raw packets returned by getNextPacket() point to the packet data in
+		 * the read buffer and don't own it (see RawPacket#setExternalRawData()), so they're valid only until the next packet is read, the file
+		 * is seeked or closed. This mode is meant for processing packets one by one, packets which have to be kept must be copied, for example
+		 * by reading with getNextPackets(RawPacketSlabVector&, int). Reading into a RawPacketVector copies the packets regardless. Default
+		 * value is false
 		 */
-		PcapNgFileReaderDevice(const char* fileName);
+		PcapNgFileReaderDevice(const char* fileName, int numOfDecompressionWorkers = 0, bool zeroCopy = false);
 
 		/**
 		 * A destructor for this class
@@ -223,6 +348,18 @@ namespace pcpp
 		 */
 		bool getNextPacket(RawPacket& rawPacket, std::string& packetComment);
 
+		using IFileReaderDevice::getNextPackets;
+
+		/**
+		 * Read the next N packets into a raw packet vector. The packets are copied into the raw packets also in zero-copy mode, since they
+		 * have to stay valid after the next packet is read
+		 * @param[out] packetVec The raw packet vector to read packets into
+		 * @param[in] numOfPacketsToRead Number of packets to read. If value <0 all remaining packets in the file will be read into the
+		 * raw packet vector (this is the default value)
+		 * @return The number of packets actually read
+		 */
+		int getNextPackets(RawPacketVector& packetVec, int numOfPacketsToRead = -1);
+
 		//overridden methods
 
 		/**
@@ -260,6 +397,334 @@ namespace pcpp
 	};
 
 
+/**
+ * The default number of bytes MmapPcapFileReaderDevice asks the kernel to read ahead of the packets being read
+ */
+#define PCPP_MMAP_READER_DEFAULT_READ_AHEAD_SIZE (8 * 1024 * 1024)
+
+	/**
+	 * @class MmapPcapFileReaderDevice
+	 * A class for reading a pcap file by mapping it to memory instead of reading it through libpcap. Packets aren't copied: the raw packets
+	 * returned by getNextPacket() point directly to the packet data in the mapped file, which makes reading large files considerably faster.
+	 * This has a few implications:
+	 * - The data of a raw packet read by this device is valid only while the file is open. A raw packet which has to outlive the device
+	 *   must be copied, for example with RawPacket#copyRawData() or by reading with getNextPackets(RawPacketSlabVector&, int)
+	 * - The file is mapped privately, so modifying the data of a raw packet (e.g by editing a Packet wrapping it) changes a private copy of
+	 *   the modified memory page, never the file
+	 * - The kernel is told the file is read sequentially and is asked to read a configurable number of bytes ahead of the packets being
+	 *   read, optionally into huge pages where the kernel supports them for file mappings
+	 *
+	 * Both the microsecond and the nanosecond pcap formats of either byte order are supported. Filters are matched in user space with the
+	 * compiled BPF program, as in PcapNgFileReaderDevice. Memory mapping is implemented for Linux and MacOS only, on other
+	 * platforms open() fails
+	 */
+	class MmapPcapFileReaderDevice : public IFileReaderDevice
+	{
+	private:
+		uint8_t* m_MappedData;
+		size_t m_MappedLen;
+		size_t m_Offset;
+		size_t m_ReadAheadSize;
+		size_t m_ReadAheadOffset;
+		bool m_UseHugePages;
+		bool m_SwapBytes;
+		bool m_NanosecondPrecision;
+		uint32_t m_SnapshotLength;
+		LinkLayerType m_PcapLinkLayerType;
+		BpfFilterProgram m_BpfProgram;
+		std::string m_CurFilter;
+
+		// private copy c'tor
+		MmapPcapFileReaderDevice(const MmapPcapFileReaderDevice& other);
+		MmapPcapFileReaderDevice& operator=(const MmapPcapFileReaderDevice& other);
+
+		bool matchPacketWithFilter(const uint8_t* packetData, uint32_t capturedLen, uint32_t packetLen, timeval packetTimestamp);
+		uint32_t readUInt32(size_t offset) const;
+		void readAhead();
+
+	protected:
+		bool seekToOffset(uint64_t offset);
+
+	public:
+		/**
+		 * A constructor for this class that gets the pcap full path file name to open. Notice that after calling this constructor the file
+		 * isn't opened yet, so reading packets will fail. For opening the file call open()
+		 * @param[in] fileName The full path of the file to read
+		 * @param[in] readAheadSize The number of bytes the kernel is asked to read ahead of the packets being read. 0 leaves read-ahead to the
+		 * kernel's defaults for sequential access. Default value is #PCPP_MMAP_READER_DEFAULT_READ_AHEAD_SIZE
+		 * @param[in] useHugePages If set to true the kernel is asked to back the mapping with huge pages, which reduces the page faults and TLB
+		 * misses of reading large files. It requires kernel support for huge pages in file mappings and is ignored otherwise. Default value
+		 * is false
+		 */
+		MmapPcapFileReaderDevice(const char* fileName, size_t readAheadSize = PCPP_MMAP_READER_DEFAULT_READ_AHEAD_SIZE, bool useHugePages = false);
+
+		/**
+		 * A destructor for this class
+		 */
+		virtual ~MmapPcapFileReaderDevice() { close(); }
+
+		/**
+		 * @return The link layer type of this file
+		 */
+		LinkLayerType getLinkLayerType() const { return m_PcapLinkLayerType; }
+
+		/**
+		 * @return The snapshot length of this file, as written in its header
+		 */
+		uint32_t getSnapshotLength() const { return m_SnapshotLength; }
+
+		//overridden methods
+
+		/**
+		 * Read the next packet from the file. Before using this method please verify the file is opened using open(). The raw packet points
+		 * to the packet data in the mapped file and doesn't own it (see RawPacket#setExternalRawData()), so it's valid until the file is closed
+		 * @param[out] rawPacket A reference for an empty RawPacket where the packet will be set
+		 * @return True if a packet was read successfully. False will be returned if the file isn't opened (also, an error log will be printed),
+		 * if reached end-of-file or if the next packet record is truncated (also, an error log will be printed)
+		 */
+		bool getNextPacket(RawPacket& rawPacket);
+
+		/**
+		 * Open the file name which path was specified in the constructor in a read-only mode and map it to memory
+		 * @return True if file was opened successfully or if file is already opened. False if opening or mapping the file failed for some
+		 * reason (for example: file path does not exist or the file isn't a pcap file)
+		 */
+		bool open();
+
+		/**
+		 * Get statistics of packets read so far. In the pcap_stat struct, only ps_recv member is relevant. The rest of the members will contain 0
+		 * @param[out] stats The stats struct where stats are returned
+		 */
+		void getStatistics(pcap_stat& stats);
+
+		/**
+		 * Set a filter for the reader device. Only packets that match the filter will be received
+		 * @param[in] filterAsString The filter to be set in Berkeley Packet Filter (BPF) syntax (http://biot.com/capstats/bpf.html)
+		 * @return True if filter set successfully, false otherwise
+		 */
+		bool setFilter(std::string filterAsString);
+
+		/**
+		 * Unmap and close the file. Raw packets read from the file can't be used after it's closed
+		 */
+		void close();
+	};
+
+
+/**
+ * The default size of the buffer BufferedPcapFileReaderDevice reads the file into
+ */
+#define PCPP_BUFFERED_READER_DEFAULT_BUFFER_SIZE (1024 * 1024)
+
+	// waits for changes of a followed file, defined in PcapFileDevice.cpp
+	class FileChangeWatcher;
+
+	/**
+	 * @struct PcapFileFollowConfiguration
+	 * A structure for configuring the follow mode of BufferedPcapFileReaderDevice (see BufferedPcapFileReaderDevice#setFollowMode())
+	 */
+	struct PcapFileFollowConfiguration
+	{
+		/** How long reading waits at the end of the file for more packets, in milliseconds. When it passes without a new packet the reading
+		 * methods return as at the end of a file, and they can be called again to keep following. A negative value waits until
+		 * BufferedPcapFileReaderDevice#stopFollowing() is called
+		 */
+		int waitTimeoutMs;
+
+		/** The flag indicating whether reading moves on to the next file of a sequence when the writer does. The next file is named as the
+		 * current one with its sequence number, the digits before the extension, incremented, as RotatingFileWriterDevice names its files
+		 * (capture_000001.pcap follows capture_000000.pcap). Reading moves on once the current file was read to its end and the next file
+		 * has packets
+		 */
+		bool followRotation;
+
+		/** How long the current file must stay unchanged after the next file of the sequence has packets before reading moves on, in
+		 * milliseconds. It covers writers which flush the end of a file after they started writing the next one, as RotatingFileWriterDevice
+		 * does when it closes the previous file in the background
+		 */
+		uint32_t rotationDelayMs;
+
+		/** The longest time between checks of the file while waiting, in milliseconds. Where change notifications are available (inotify on
+		 * Linux, kqueue on macOS and FreeBSD) reading wakes up as soon as the file or its directory changes and the checks are only a
+		 * fallback, for example for network file systems which don't notify. Elsewhere the file is polled at this interval
+		 */
+		uint32_t pollIntervalMs;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] waitTimeoutMs How long reading waits at the end of the file in milliseconds, a negative value waits until stopped. The
+		 * default is -1
+		 * @param[in] followRotation The flag indicating whether reading moves on to the next file of a sequence. The default is false
+		 */
+		PcapFileFollowConfiguration(int waitTimeoutMs = -1, bool followRotation = false) :
+			waitTimeoutMs(waitTimeoutMs), followRotation(followRotation), rotationDelayMs(200), pollIntervalMs(100)
+		{
+		}
+	};
+
+	/**
+	 * @class BufferedPcapFileReaderDevice
+	 * A class for reading a pcap file without libpcap. The file is read in large chunks into a buffer and the packet records are parsed
+	 * directly from the buffer, which saves the per-packet function calls and copies of reading through libpcap and reads large files
+	 * considerably faster. Packets are copied from the buffer into the raw packets, into buffers of the raw packet pool if one is set (see
+	 * setRawPacketPool()), so unlike MmapPcapFileReaderDevice the raw packets are valid after the file is closed. Reading into a
+	 * RawPacketVector has a dedicated loop which parses the buffer without a virtual call per packet.
+	 *
+	 * Both the microsecond and the nanosecond pcap formats of either byte order are supported, on all platforms. Unlike PcapFileReaderDevice,
+	 * pcap-ng files can't be read with this class. Filters are matched in user space with the compiled BPF program, as in
+	 * PcapNgFileReaderDevice.
+	 *
+	 * In follow mode (see setFollowMode()) the device reads a file which another process is still writing, like "tail -f": at the end of
+	 * the file reading waits for more packets instead of returning, a record which was only partly written is read once the rest of it is,
+	 * and reading continues to the next file when the writer rotates files. A file which is replaced or truncated is read again from its
+	 * start
+	 */
+	class BufferedPcapFileReaderDevice : public IFileReaderDevice
+	{
+	private:
+		FILE* m_File;
+		uint8_t* m_Buffer;
+		size_t m_BufferSize;
+		size_t m_BufferLen;
+		size_t m_BufferOffset;
+		// the file offset of the first byte of the buffer
+		uint64_t m_BufferFileOffset;
+		uint64_t m_FileSize;
+		bool m_SwapBytes;
+		bool m_NanosecondPrecision;
+		uint32_t m_SnapshotLength;
+		LinkLayerType m_PcapLinkLayerType;
+		BpfFilterProgram m_BpfProgram;
+		std::string m_CurFilter;
+		// the follow mode state
+		bool m_Following;
+		volatile bool m_StopFollowing;
+		PcapFileFollowConfiguration m_FollowConfig;
+		FileChangeWatcher* m_Watcher;
+		uint32_t m_NumOfRotations;
+		// when the next file of the sequence was first seen with packets, and the size of the current file then
+		uint64_t m_NextFileSeenTime;
+		uint64_t m_NextFileSeenSize;
+
+		// private copy c'tor
+		BufferedPcapFileReaderDevice(const BufferedPcapFileReaderDevice& other);
+		BufferedPcapFileReaderDevice& operator=(const BufferedPcapFileReaderDevice& other);
+
+		bool matchPacketWithFilter(const uint8_t* packetData, uint32_t capturedLen, uint32_t packetLen, timeval packetTimestamp);
+		uint32_t readUInt32(size_t offset) const;
+		bool fillBuffer(size_t neededLen);
+		bool readNextRecord(RawPacket& rawPacket);
+		bool openFile();
+		bool switchToFile(const std::string& fileName);
+		bool waitForData();
+
+	protected:
+		bool seekToOffset(uint64_t offset);
+
+	public:
+		/**
+		 * A constructor for this class that gets the pcap full path file name to open. Notice that after calling this constructor the file
+		 * isn't opened yet, so reading packets will fail. For opening the file call open()
+		 * @param[in] fileName The full path of the file to read
+		 * @param[in] bufferSize The size of the buffer the file is read into. A record larger than the buffer grows it. Default value is
+		 * #PCPP_BUFFERED_READER_DEFAULT_BUFFER_SIZE
+		 */
+		BufferedPcapFileReaderDevice(const char* fileName, size_t bufferSize = PCPP_BUFFERED_READER_DEFAULT_BUFFER_SIZE);
+
+		/**
+		 * A destructor for this class
+		 */
+		virtual ~BufferedPcapFileReaderDevice();
+
+		/**
+		 * @return The link layer type of this file
+		 */
+		LinkLayerType getLinkLayerType() const { return m_PcapLinkLayerType; }
+
+		/**
+		 * @return The snapshot length of this file, as written in its header
+		 */
+		uint32_t getSnapshotLength() const { return m_SnapshotLength; }
+
+		using IFileReaderDevice::getNextPackets;
+
+		/**
+		 * Read the next N packets into a raw packet vector. Records are parsed from the buffer in a single loop, and packet data is copied
+		 * into buffers of the raw packet pool if one is set
+		 * @param[out] packetVec The raw packet vector to read packets into
+		 * @param[in] numOfPacketsToRead Number of packets to read. If value <0 all remaining packets in the file will be read into the
+		 * raw packet vector (this is the default value)
+		 * @return The number of packets actually read
+		 */
+		int getNextPackets(RawPacketVector& packetVec, int numOfPacketsToRead = -1);
+
+		//overridden methods
+
+		/**
+		 * Read the next packet from the file. Before using this method please verify the file is opened using open()
+		 * @param[out] rawPacket A reference for an empty RawPacket where the packet will be written
+		 * @return True if a packet was read successfully. False will be returned if the file isn't opened (also, an error log will be printed),
+		 * if reached end-of-file or if the next packet record is truncated (also, an error log will be printed). In follow mode a truncated
+		 * record is waited for, and false is returned if no packet was written until the wait timeout or stopFollowing()
+		 */
+		bool getNextPacket(RawPacket& rawPacket);
+
+		/**
+		 * Read the file in follow mode: at the end of the file wait for the writer to add packets instead of returning, according to the
+		 * configuration. The mode may be set before or after the file is opened, and it's kept when the file is closed and opened again
+		 * @param[in] config The follow mode configuration
+		 */
+		void setFollowMode(const PcapFileFollowConfiguration& config);
+
+		/**
+		 * Stop following the file: reading returns at the end of the file without waiting, as it does when not in follow mode
+		 */
+		void clearFollowMode();
+
+		/**
+		 * @return True if the device is in follow mode
+		 */
+		inline bool isFollowing() const { return m_Following; }
+
+		/**
+		 * Wake up a reader waiting for packets and make it return, and make later reads return at the end of the file without waiting until
+		 * setFollowMode() is called again. This method may be called from any thread, for example to stop a reading thread on shutdown
+		 */
+		void stopFollowing();
+
+		/**
+		 * @return The number of times reading moved on to the next file of a sequence in follow mode. getFileName() returns the name of the
+		 * file currently read
+		 */
+		inline uint32_t getNumOfRotations() const { return m_NumOfRotations; }
+
+		/**
+		 * Open the file name which path was specified in the constructor in a read-only mode and read its file header
+		 * @return True if file was opened successfully or if file is already opened. False if opening the file failed for some reason (for
+		 * example: file path does not exist or the file isn't a pcap file)
+		 */
+		bool open();
+
+		/**
+		 * Get statistics of packets read so far. In the pcap_stat struct, only ps_recv member is relevant. The rest of the members will contain 0
+		 * @param[out] stats The stats struct where stats are returned
+		 */
+		void getStatistics(pcap_stat& stats);
+
+		/**
+		 * Set a filter for the reader device. Only packets that match the filter will be received
+		 * @param[in] filterAsString The filter to be set in Berkeley Packet Filter (BPF) syntax (http://biot.com/capstats/bpf.html)
+		 * @return True if filter set successfully, false otherwise
+		 */
+		bool setFilter(std::string filterAsString);
+
+		/**
+		 * Close the file
+		 */
+		void close();
+	};
+
+
 	/**
 	 * @class IFileWriterDevice
 	 * An abstract class (cannot be instantiated, has a private c'tor) which is the parent class for file writer devices
@@ -269,15 +734,36 @@ namespace pcpp
 	protected:
 		uint32_t m_NumOfPacketsWritten;
 		uint32_t m_NumOfPacketsNotWritten;
+		PcapFileSummary* m_Summary;
 
 		IFileWriterDevice(const char* fileName);
 
+		/**
+		 * Start the summary of the file when it's opened, if summaries are enabled. In append mode the summary of the packets already in
+		 * the file is loaded from its sidecar file or, if it can't be loaded, built by reading the file. Called by open() before the file
+		 * is opened
+		 * @param[in] appendMode Whether the file is opened in append mode
+		 */
+		void startSummary(bool appendMode);
+
+		/**
+		 * Add a packet written to the file to its summary, if summaries are enabled
+		 * @param[in] packet The packet written
+		 */
+		inline void addToSummary(RawPacket const& packet) { if (m_Summary != NULL) m_Summary->addPacket(packet); }
+
+		/**
+		 * Save the summary of the file to its sidecar file, if summaries are enabled. Called by close() after the file is closed, so the
+		 * summary records the final size and modification time of the file
+		 */
+		void saveSummary();
+
 	public:
 
 		/**
 		 * A destructor for this class
 		 */
-		virtual ~IFileWriterDevice() {}
+		virtual ~IFileWriterDevice();
 
 		virtual bool writePacket(RawPacket const& packet) = 0;
 
@@ -285,6 +771,27 @@ namespace pcpp
 
 		using IFileDevice::open;
 		virtual bool open(bool appendMode) = 0;
+
+		/**
+		 * Enable or disable the summary of the file (see PcapFileSummary). When it's enabled, the packets written are added to the summary,
+		 * which is saved next to the file (see PcapFileSummary#getDefaultSummaryFileName()) when the device is closed, so searches can skip
+		 * the file without reading it
+		 * @param[in] enabled Whether to build the summary
+		 * @return True if the setting was changed, false if the device is open (an error will be printed to log)
+		 */
+		bool setSummaryEnabled(bool enabled);
+
+		/**
+		 * @return The summary of the packets written, or NULL if summaries aren't enabled
+		 */
+		inline const PcapFileSummary* getSummary() const { return m_Summary; }
+
+		/**
+		 * Report the number of packets written and not written to a MetricsRegistry snapshot: pcpp_device_written_packets_total and
+		 * pcpp_device_write_failed_packets_total
+		 * @param[in] writer The writer to report the values to
+		 */
+		virtual void collectMetrics(MetricsWriter& writer);
 	};
 
 
@@ -300,6 +807,7 @@ namespace pcpp
 		pcap_dumper_t* m_PcapDumpHandler;
 		LinkLayerType m_PcapLinkLayerType;
 		bool m_AppendMode;
+		bool m_NanosecondsPrecision;
 		FILE* m_File;
 
 		// private copy c'tor
@@ -314,8 +822,12 @@ namespace pcpp
 		 * constructor the file isn't opened yet, so writing packets will fail. For opening the file call open()
 		 * @param[in] fileName The full path of the file
 		 * @param[in] linkLayerType The link layer type all packet in this file will be based on. The default is Ethernet
+		 * @param[in] nanosecondsPrecision If true the file is written in the nanosecond pcap format and packet timestamps are written in
+		 * nanosecond resolution, otherwise the classic microsecond format is used. Writing nanosecond files requires libpcap 1.5.0 or
+		 * newer, with older versions (and WinPcap) the file is written in microseconds. When a file is opened in append mode its own
+		 * precision is used regardless of this parameter. The default is false
 		 */
-		PcapFileWriterDevice(const char* fileName, LinkLayerType linkLayerType = LINKTYPE_ETHERNET);
+		PcapFileWriterDevice(const char* fileName, LinkLayerType linkLayerType = LINKTYPE_ETHERNET, bool nanosecondsPrecision = false);
 
 		/**
 		 * A destructor for this class
@@ -341,6 +853,12 @@ namespace pcpp
 		 */
 		bool writePackets(const RawPacketVector& packets);
 
+		/**
+		 * @return True if packet timestamps are written in nanosecond resolution, false if they're written in microseconds. The value is
+		 * final only after the file is opened, see the c'tor
+		 */
+		inline bool isNanosecondsPrecision() const { return m_NanosecondsPrecision; }
+
 		//override methods
 
 		/**
@@ -375,6 +893,193 @@ namespace pcpp
 		virtual void getStatistics(pcap_stat& stats);
 	};
 
+/**
+ * The default size in bytes of each of the two buffers of BufferedPcapFileWriterDevice
+ */
+#define PCPP_BUFFERED_WRITER_DEFAULT_BUFFER_SIZE (8 * 1024 * 1024)
+
+	/**
+	 * @struct BufferedPcapFileWriterConfiguration
+	 * A structure for configuring BufferedPcapFileWriterDevice
+	 */
+	struct BufferedPcapFileWriterConfiguration
+	{
+		/**
+		 * When the data written to the file is forced from the OS cache to the disk
+		 */
+		enum SyncPolicy
+		{
+			/** Never, the OS writes its cache back to the disk whenever it chooses */
+			SyncNever,
+			/** When the file is closed */
+			SyncOnClose,
+			/** After every buffer written, which limits the data lost in a system crash to the buffers in memory at the cost of throughput */
+			SyncEveryFlush
+		};
+
+		/** The size in bytes of each of the two buffers packets are copied to. A packet whose record is larger than a buffer can't be written
+		 */
+		size_t bufferSize;
+
+		/** The flag indicating whether writing a packet waits when both buffers are full, or drops the packet immediately so the capture
+		 * thread never blocks on the disk
+		 */
+		bool blockWhenFull;
+
+		/** How long packets may stay in a partially filled buffer before it's written, expressed in milliseconds. If the value is set to 0
+		 * a buffer is written only when it's full, when flush() is called or when the file is closed
+		 */
+		uint32_t flushIntervalMs;
+
+		/** When the data written is forced to the disk
+		 */
+		SyncPolicy syncPolicy;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] bufferSize The size of each of the two buffers. The default is #PCPP_BUFFERED_WRITER_DEFAULT_BUFFER_SIZE
+		 * @param[in] blockWhenFull The flag indicating whether writing a packet waits when both buffers are full. The default is false
+		 * @param[in] flushIntervalMs How long packets may stay in a partially filled buffer, in milliseconds. The default is 1000
+		 * @param[in] syncPolicy When the data written is forced to the disk. The default is SyncOnClose
+		 */
+		BufferedPcapFileWriterConfiguration(size_t bufferSize = PCPP_BUFFERED_WRITER_DEFAULT_BUFFER_SIZE, bool blockWhenFull = false, uint32_t flushIntervalMs = 1000, SyncPolicy syncPolicy = SyncOnClose) :
+			bufferSize(bufferSize), blockWhenFull(blockWhenFull), flushIntervalMs(flushIntervalMs), syncPolicy(syncPolicy)
+		{
+		}
+	};
+
+
+	/**
+	 * @class BufferedPcapFileWriterDevice
+	 * A class for writing pcap files at high packet rates, for example when capturing to disk. Instead of writing every packet to the file
+	 * as PcapFileWriterDevice does, packet records are copied into one of two large buffers, and a full buffer is written to the file in a
+	 * single write by a flusher thread while packets are copied into the other one. The thread calling writePacket() therefore only copies
+	 * memory and never waits for the disk, unless both buffers are full and the device is configured to wait (see
+	 * BufferedPcapFileWriterConfiguration).
+	 * The file is written without libpcap in the pcap format of the machine's byte order, in the microsecond or the nanosecond format. Packets
+	 * are in the file only once their buffer was written: when it's full, after the flush interval, on flush() or when the file is closed
+	 */
+	class BufferedPcapFileWriterDevice : public IFileWriterDevice
+	{
+	private:
+		struct Buffer
+		{
+			uint8_t* data;
+			size_t len;
+			uint32_t numOfPackets;
+		};
+
+		BufferedPcapFileWriterConfiguration m_Config;
+		LinkLayerType m_PcapLinkLayerType;
+		bool m_NanosecondsPrecision;
+		FILE* m_File;
+		Buffer m_Buffers[2];
+		// the buffer packets are copied to. The other buffer is written by the flusher thread when a flush is pending
+		int m_ActiveBuffer;
+		bool m_FlushPending;
+		bool m_StopRequested;
+		bool m_WriteFailed;
+		pthread_t m_FlusherThread;
+		pthread_mutex_t m_Mutex;
+		pthread_cond_t m_FlushRequested;
+		pthread_cond_t m_FlushDone;
+
+		// private copy c'tor
+		BufferedPcapFileWriterDevice(const BufferedPcapFileWriterDevice& other);
+		BufferedPcapFileWriterDevice& operator=(const BufferedPcapFileWriterDevice& other);
+
+		static void* flusherThreadMain(void* device);
+		bool submitActiveBuffer(bool wait);
+		bool writeBuffer(const Buffer& buffer);
+		bool syncFile();
+		bool openFile(bool appendMode);
+		void closeFile();
+
+	public:
+		/**
+		 * A constructor for this class that gets the pcap full path file name to open for writing or create. Notice that after calling this
+		 * constructor the file isn't opened yet, so writing packets will fail. For opening the file call open()
+		 * @param[in] fileName The full path of the file
+		 * @param[in] linkLayerType The link layer type all packet in this file will be based on. The default is Ethernet
+		 * @param[in] nanosecondsPrecision If true the file is written in the nanosecond pcap format, otherwise the classic microsecond format
+		 * is used. When a file is opened in append mode its own precision is used regardless of this parameter. The default is false
+		 * @param[in] config The buffering configuration. The default is BufferedPcapFileWriterConfiguration()
+		 */
+		BufferedPcapFileWriterDevice(const char* fileName, LinkLayerType linkLayerType = LINKTYPE_ETHERNET, bool nanosecondsPrecision = false,
+				const BufferedPcapFileWriterConfiguration& config = BufferedPcapFileWriterConfiguration());
+
+		/**
+		 * A destructor for this class, closes the file if it's open
+		 */
+		~BufferedPcapFileWriterDevice() { close(); }
+
+		/**
+		 * Copy a RawPacket to the buffer, it's written to the file later by the flusher thread. Before using this method please verify the
+		 * file is opened using open(). This method may be called from one thread at a time and won't change the written packet
+		 * @param[in] packet A reference for an existing RawPcket to write to the file
+		 * @return True if the packet was copied to the buffer. False will be returned if the file isn't opened or the packet link layer type
+		 * is different than the one defined for the file (in both cases, an error will be printed to log), if the packet is larger than a
+		 * buffer, if both buffers are full and the device doesn't wait for the flusher thread, or if writing to the file failed before
+		 */
+		bool writePacket(RawPacket const& packet);
+
+		/**
+		 * Copy multiple RawPackets to the buffer, see writePacket()
+		 * @param[in] packets A reference for an existing RawPcketVector, all of its packets will be written to the file
+		 * @return True if all packets were copied to the buffer, false if at least one of them wasn't
+		 */
+		bool writePackets(const RawPacketVector& packets);
+
+		/**
+		 * Write the packets copied so far to the file and wait until they're written. If the sync policy is SyncEveryFlush they're forced
+		 * to the disk as well
+		 * @return True if all buffers were written successfully, false if the file isn't opened or writing to it failed
+		 */
+		bool flush();
+
+		/**
+		 * @return True if packet timestamps are written in nanosecond resolution, false if they're written in microseconds. The value is
+		 * final only after the file is opened, see the c'tor
+		 */
+		inline bool isNanosecondsPrecision() const { return m_NanosecondsPrecision; }
+
+		//override methods
+
+		/**
+		 * Open the file in a write mode and start the flusher thread. If file doesn't exist, it will be created. If it does exist it will be
+		 * overwritten, meaning all its current content will be deleted
+		 * @return True if file was opened/created successfully or if file is already opened. False if opening the file, allocating the
+		 * buffers or starting the flusher thread failed (an error will be printed to log)
+		 */
+		virtual bool open();
+
+		/**
+		 * Same as open(), but enables to open the file in append mode in which packets will be appended to the file
+		 * instead of overwrite its current content. In append mode file must exist, otherwise opening will fail
+		 * @param[in] appendMode A boolean indicating whether to open the file in append mode or not. If set to false
+		 * this method will act exactly like open(). If set to true, file will be opened in append mode
+		 * @return True of managed to open the file successfully. In case appendMode is set to true, false will be returned
+		 * if file wasn't found or couldn't be read, if file type is not pcap of the machine's byte order, or if link type specified in c'tor
+		 * is different from current file link type. In case appendMode is set to false, please refer to open() for return values
+		 */
+		bool open(bool appendMode);
+
+		/**
+		 * Write the packets in the buffers, stop the flusher thread and close the file. If the sync policy isn't SyncNever the file is
+		 * forced to the disk before it's closed
+		 */
+		virtual void close();
+
+		/**
+		 * Get statistics of the packets written so far. ps_recv is the number of packets written to the file and ps_drop is the number of
+		 * packets which weren't written, either because writePacket() failed or because writing their buffer to the file failed. Packets
+		 * still in the buffers aren't counted in either, call flush() first to count all packets copied so far. ps_ifdrop is always 0
+		 * @param[out] stats The stats struct where stats are returned
+		 */
+		virtual void getStatistics(pcap_stat& stats);
+	};
+
+
 
 	/**
 	 * @class PcapNgFileWriterDevice
@@ -388,9 +1093,8 @@ namespace pcpp
 	private:
 		void* m_LightPcapNg;
 		int m_CompressionLevel;
-		struct bpf_program m_Bpf;
-		bool m_BpfInitialized;
-		int m_BpfLinkType;
+		int m_NumOfCompressionWorkers;
+		BpfFilterProgram m_BpfProgram;
 		std::string m_CurFilter;
 
 		// private copy c'tor
@@ -406,8 +1110,11 @@ namespace pcpp
 		 * constructor the file isn't opened yet, so writing packets will fail. For opening the file call open()
 		 * @param[in] fileName The full path of the file
 		 * @param[in] compressionLevel The compression level to use when writing the file, use 0 to disable compression or 10 for max compression. Default is 0 
+		 * @param[in] numOfCompressionWorkers The number of threads compressing the file. If it's not 0, packets are gathered into frames
+		 * of about 1MB which are compressed by the workers while the next frames are written, and the frames are written to the file in
+		 * order. Use 0 to compress in the writing thread. It's ignored if compression is disabled. Default is 0
 		 */
-		PcapNgFileWriterDevice(const char* fileName, int compressionLevel = 0);
+		PcapNgFileWriterDevice(const char* fileName, int compressionLevel = 0, int numOfCompressionWorkers = 0);
 
 		/**
 		 * A destructor for this class
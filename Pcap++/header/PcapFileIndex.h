@@ -0,0 +1,228 @@
+#ifndef PCAPPP_PCAP_FILE_INDEX
+#define PCAPPP_PCAP_FILE_INDEX
+
+#include "RawPacket.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class PcapFileIndex
+	 * An index of the packet records of a pcap or pcap-ng file: the file offset of every packet and, for pcap-ng files, the interface it was
+	 * captured on. Building the index scans the record headers of the file once. Once built, any packet can be read directly by its number,
+	 * and the file can be split into ranges of packets which are read in parallel (see ParallelPcapFileReader).
+	 * The index also holds a sparse time index: the latest timestamp up to every block of #TimeIndexInterval packets, which finds the packets
+	 * of a time window without reading the file from its beginning (see findPacketByTime()).
+	 * The index can be saved to a sidecar file next to the capture and loaded instead of scanning the file again. The sidecar file holds the
+	 * size of the capture it was built for and isn't loaded for a capture of another size.
+	 * Pcap files of the microsecond and nanosecond formats and of both byte orders are supported. In pcap-ng files enhanced, simple and
+	 * obsolete packet blocks are indexed, of all sections and interfaces, with the link type and timestamp resolution of their interface
+	 */
+	class PcapFileIndex
+	{
+		friend class PcapFlowIndex;
+
+	public:
+
+		/**
+		 * @class PacketReader
+		 * Reads packets of an indexed file by their number. Each instance has its own file handle and buffer, so several instances can read
+		 * the same file in parallel. Reading packets in increasing order of their numbers reads the file sequentially
+		 */
+		class PacketReader
+		{
+		public:
+
+			/**
+			 * A c'tor for this class. The file isn't opened until open() is called
+			 * @param[in] index The index of the file. It must outlive this instance
+			 */
+			PacketReader(const PcapFileIndex& index);
+
+			/**
+			 * A d'tor for this class, closes the file
+			 */
+			~PacketReader();
+
+			/**
+			 * Open the indexed file for reading
+			 * @return True if the file was opened, false otherwise
+			 */
+			bool open();
+
+			/**
+			 * Close the file
+			 */
+			void close();
+
+			/**
+			 * Read a packet. The raw packet points to the buffer of this instance (see RawPacket#setExternalRawData()), so it's valid until
+			 * the next packet is read or this instance is closed
+			 * @param[in] packetNumber The number of the packet in the file, starting at 0
+			 * @param[out] rawPacket The raw packet to set
+			 * @return True if the packet was read, false if the number is out of range, the file isn't open or the record couldn't be read
+			 */
+			bool readPacket(uint64_t packetNumber, RawPacket& rawPacket);
+
+			/**
+			 * Read the packet whose record begins at a file offset, for callers which keep the offsets of the packets they need (see
+			 * PcapFlowIndex). The raw packet points to the buffer of this instance, as in readPacket()
+			 * @param[in] offset The file offset of the record, as returned by PcapFileIndex#getPacketOffset()
+			 * @param[in] interfaceIndex The index of the pcap-ng interface the packet was captured on, 0 for pcap files
+			 * @param[out] rawPacket The raw packet to set
+			 * @return True if the packet was read, false if the interface doesn't exist, the file isn't open or the record couldn't be read
+			 */
+			bool readPacketAt(uint64_t offset, uint32_t interfaceIndex, RawPacket& rawPacket);
+
+		private:
+			const PcapFileIndex& m_Index;
+			FILE* m_File;
+			uint64_t m_FilePosition;
+			std::vector<uint8_t> m_Buffer;
+
+			// disable copy c'tor and assignment operator
+			PacketReader(const PacketReader& other);
+			PacketReader& operator=(const PacketReader& other);
+		};
+
+		/**
+		 * The number of packets in each block of the sparse time index
+		 */
+		static const uint64_t TimeIndexInterval = 256;
+
+		/**
+		 * A c'tor for this class, which creates an empty index
+		 */
+		PcapFileIndex();
+
+		/**
+		 * Build the index of a file by scanning its record headers. A record truncated at the end of the file isn't indexed
+		 * @param[in] fileName The pcap or pcap-ng file
+		 * @return True if the file was indexed, false if it can't be read or isn't a pcap or pcap-ng file
+		 */
+		bool build(const std::string& fileName);
+
+		/**
+		 * Save the index to a sidecar file
+		 * @param[in] indexFileName The sidecar file name
+		 * @return True if the index was saved, false otherwise
+		 */
+		bool save(const std::string& indexFileName) const;
+
+		/**
+		 * Load an index saved by save()
+		 * @param[in] indexFileName The sidecar file name
+		 * @param[in] fileName The pcap or pcap-ng file the index was built for
+		 * @return True if the index was loaded, false if the sidecar file can't be read, is invalid or was built for a file of another size
+		 */
+		bool load(const std::string& indexFileName, const std::string& fileName);
+
+		/**
+		 * Load the index of a file from its default sidecar file (see getDefaultIndexFileName()) or, if it can't be loaded, build the index
+		 * and try to save it there for the next time
+		 * @param[in] fileName The pcap or pcap-ng file
+		 * @return True if the index was loaded or built, false otherwise
+		 */
+		bool loadOrBuild(const std::string& fileName);
+
+		/**
+		 * @param[in] fileName A pcap or pcap-ng file name
+		 * @return The default sidecar file name of the index of the file, which is the file name with a ".pidx" suffix
+		 */
+		static std::string getDefaultIndexFileName(const std::string& fileName);
+
+		/**
+		 * @return The name of the indexed file
+		 */
+		inline const std::string& getFileName() const { return m_FileName; }
+
+		/**
+		 * @return True if the indexed file is a pcap-ng file, false if it's a pcap file
+		 */
+		inline bool isPcapNg() const { return m_IsPcapNg; }
+
+		/**
+		 * @return The number of packets in the index
+		 */
+		inline uint64_t getNumOfPackets() const { return m_PacketOffsets.size(); }
+
+		/**
+		 * @param[in] packetNumber The number of a packet in the file, starting at 0. It must be smaller than getNumOfPackets()
+		 * @return The file offset of the packet's record
+		 */
+		inline uint64_t getPacketOffset(uint64_t packetNumber) const { return m_PacketOffsets[packetNumber]; }
+
+		/**
+		 * @param[in] packetNumber The number of a packet in the file, starting at 0. It must be smaller than getNumOfPackets()
+		 * @return The index of the pcap-ng interface the packet was captured on, 0 for pcap files
+		 */
+		inline uint32_t getPacketInterface(uint64_t packetNumber) const { return (m_IsPcapNg ? m_PacketInterfaces[packetNumber] : 0); }
+
+		/**
+		 * @return The size of the indexed file
+		 */
+		inline uint64_t getFileSize() const { return m_FileSize; }
+
+		/**
+		 * @param[in] packetNumber The number of a packet in the file, starting at 0. It must be smaller than getNumOfPackets()
+		 * @return The link layer type of the packet
+		 */
+		LinkLayerType getLinkLayerType(uint64_t packetNumber) const;
+
+		/**
+		 * Find the first packet at or after a point in time. The block of the sparse time index the packet is in is found without reading the
+		 * file, then at most #TimeIndexInterval packets of this block are read to find the packet itself. Timestamps of captures aren't always
+		 * in order, so the packet found is the first packet at which the latest timestamp so far reaches the point in time: all packets before
+		 * it are earlier. Packets of pcap-ng simple packet blocks have no timestamp and are considered earlier than any point in time
+		 * @param[in] timestamp The point in time
+		 * @param[out] packetNumber The number of the packet found, or getNumOfPackets() if all packets are earlier
+		 * @return True if the packet was found, false if the file couldn't be read
+		 */
+		bool findPacketByTime(const timespec& timestamp, uint64_t& packetNumber) const;
+
+	private:
+
+		// an interface of a pcap-ng file, or the single interface of a pcap file
+		struct InterfaceInfo
+		{
+			uint16_t linkType;
+			uint32_t snapLen;
+			// the number of timestamp units in a second
+			uint64_t tsUnitsPerSec;
+			// the interface belongs to a section written in the other byte order
+			bool swapBytes;
+		};
+
+		// identifies a sidecar file and the version of its format
+		static const uint32_t IndexFileMagic = 0x58444950;
+		static const uint16_t IndexFileVersion = 2;
+
+		std::string m_FileName;
+		uint64_t m_FileSize;
+		bool m_IsPcapNg;
+		std::vector<InterfaceInfo> m_Interfaces;
+		std::vector<uint64_t> m_PacketOffsets;
+		// the interface of each packet of a pcap-ng file, empty for pcap files
+		std::vector<uint32_t> m_PacketInterfaces;
+		// the latest timestamp, in nanoseconds, up to the last packet of each block of TimeIndexInterval packets
+		std::vector<uint64_t> m_TimeIndex;
+
+		void clear();
+		void addPacketTimestamp(uint64_t timestamp);
+		bool buildPcap(FILE* file);
+		bool buildPcapNg(FILE* file);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_PCAP_FILE_INDEX */
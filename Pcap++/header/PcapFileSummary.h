@@ -0,0 +1,258 @@
+#ifndef PCAPPP_PCAP_FILE_SUMMARY
+#define PCAPPP_PCAP_FILE_SUMMARY
+
+#include "RawPacket.h"
+#include "IpAddress.h"
+#include "NativeFilter.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/// @file
+
+/**
+ * The default number of counters of each of the IP address Bloom filters of PcapFileSummary
+ */
+#define PCPP_FILE_SUMMARY_DEFAULT_BLOOM_FILTER_SIZE 8192
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class PcapFileSummary
+	 * A compact summary of the packets of a capture file, which tells whether a search may match any of its packets without reading them.
+	 * Searches over many files can skip most of them by their summaries and read only the files which may hold matching packets:
+	 * - The earliest and the latest packet timestamps
+	 * - A bitmask of the protocols found in the packets (see PacketView#protocolTypes) and the number of packets which aren't IPv4 or IPv6
+	 * - The IP protocols, the TCP and UDP source and destination ports and the VLAN IDs found, each in an exact bitmap
+	 * - The lowest and the highest IPv4 source and destination addresses, for subnet queries
+	 * - Counting Bloom filters of the source and the destination IPv4 and IPv6 addresses. A counter is incremented by every packet whose
+	 *   address maps to it (up to 255), so the smallest counter of an address is also an upper bound on the number of its packets
+	 *
+	 * The headers are parsed by FlowKeyExtractor, so the addresses and ports are the ones of the outer IP header and the transport header
+	 * following it, the same ones NativeFilterProgram matches.<BR>
+	 * A summary answers "no packet can match" or "some packet may match", never wrongly "no packet can match": mayMatch() evaluates a
+	 * GeneralFilter tree (see GeneralFilter#toNativeFilter()) over the summary, and predicates the summary can't decide may match.<BR>
+	 * Summaries are built by reading a file (build()) or by the file writer devices while they write it (see
+	 * IFileWriterDevice#setSummaryEnabled()), and are saved to a sidecar file next to the capture. The sidecar file holds the size and the
+	 * modification time of the capture it was built for and isn't loaded for another version of the capture
+	 */
+	class PcapFileSummary
+	{
+	public:
+
+		/**
+		 * A c'tor for this class, which creates an empty summary
+		 * @param[in] bloomFilterSize The number of counters of each of the IP address Bloom filters. Larger filters make fewer false
+		 * positives for files of many addresses. The default is #PCPP_FILE_SUMMARY_DEFAULT_BLOOM_FILTER_SIZE, which keeps the false
+		 * positives around 1% up to about 650 different addresses in each direction
+		 */
+		PcapFileSummary(size_t bloomFilterSize = PCPP_FILE_SUMMARY_DEFAULT_BLOOM_FILTER_SIZE);
+
+		/**
+		 * Remove all packets from the summary and forget the version of the file it was built for
+		 */
+		void clear();
+
+		/**
+		 * Add a packet to the summary
+		 * @param[in] rawPacket The packet to add
+		 */
+		void addPacket(RawPacket const& rawPacket);
+
+		/**
+		 * Add the packets of another summary, such as the summary of another part of the same file
+		 * @param[in] other The summary to add
+		 * @return True if the summary was added, false if its Bloom filters are of another size
+		 */
+		bool merge(const PcapFileSummary& other);
+
+		/**
+		 * Build the summary of a file by reading all its packets. The version of the file is taken before it's read, so packets appended to
+		 * the file while it's read make the saved summary stale rather than wrong
+		 * @param[in] fileName The pcap or pcap-ng file
+		 * @return True if the file was read, false if it can't be opened
+		 */
+		bool build(const std::string& fileName);
+
+		/**
+		 * Save the summary to a sidecar file
+		 * @param[in] summaryFileName The sidecar file name
+		 * @return True if the summary was saved, false otherwise
+		 */
+		bool save(const std::string& summaryFileName) const;
+
+		/**
+		 * Load a summary saved by save()
+		 * @param[in] summaryFileName The sidecar file name
+		 * @param[in] fileName The pcap or pcap-ng file the summary was built for
+		 * @return True if the summary was loaded, false if the sidecar file can't be read, is invalid or was built for a file of another
+		 * size or modification time
+		 */
+		bool load(const std::string& summaryFileName, const std::string& fileName);
+
+		/**
+		 * Load the summary of a file from its default sidecar file (see getDefaultSummaryFileName()) or, if it can't be loaded, build the
+		 * summary and try to save it there for the next time
+		 * @param[in] fileName The pcap or pcap-ng file
+		 * @return True if the summary was loaded or built, false otherwise
+		 */
+		bool loadOrBuild(const std::string& fileName);
+
+		/**
+		 * @param[in] fileName A pcap or pcap-ng file name
+		 * @return The default sidecar file name of the summary of the file, which is the file name with a ".psum" suffix
+		 */
+		static std::string getDefaultSummaryFileName(const std::string& fileName);
+
+		/**
+		 * Get the version of a file as summaries record it
+		 * @param[in] fileName The file name
+		 * @param[out] fileSize The size of the file
+		 * @param[out] modificationTime The modification time of the file, in seconds since the epoch
+		 * @return True if the file exists, false otherwise
+		 */
+		static bool getFileVersion(const std::string& fileName, uint64_t& fileSize, int64_t& modificationTime);
+
+		/**
+		 * Set the version of the file the summary describes, which is saved with it. build() sets it, and so should code which adds the
+		 * packets of a file by itself, before it reads the file
+		 * @param[in] fileSize The size of the file
+		 * @param[in] modificationTime The modification time of the file, in seconds since the epoch
+		 */
+		void setFileVersion(uint64_t fileSize, int64_t modificationTime);
+
+		/**
+		 * Check whether any packet of the file may match a filter
+		 * @param[in] filter The filter. Filters which can't be translated to a native filter tree (see GeneralFilter#toNativeFilter()),
+		 * such as BPFStringFilter, may match any file which has packets
+		 * @return False if no packet of the file can match the filter, true if some packet may match
+		 */
+		bool mayMatch(GeneralFilter& filter) const;
+
+		/**
+		 * Check whether any packet of the file may match a native filter tree. "and" nodes can't match if one of their children can't, "or"
+		 * nodes if none of their children can, and "not" nodes may always match
+		 * @param[in] root The root of the tree
+		 * @return False if no packet of the file can match the tree, true if some packet may match
+		 */
+		bool mayMatch(const NativeFilterNode& root) const;
+
+		/**
+		 * Check whether any packet of the file may be in a time window
+		 * @param[in] from The beginning of the window
+		 * @param[in] to The end of the window, which isn't part of it
+		 * @return False if all packets of the file are outside the window, true otherwise
+		 */
+		bool overlapsTimeRange(const timespec& from, const timespec& to) const;
+
+		/**
+		 * Check whether any packet of the file may have an IP address
+		 * @param[in] address An IPv4 or IPv6 address
+		 * @param[in] direction Whether to look for the address as the source address, the destination address or either of them. The
+		 * default is ::SRC_OR_DST
+		 * @return False if no packet has the address, true if some packet may have it
+		 */
+		bool mayContainIPAddress(const IPAddressValue& address, Direction direction = SRC_OR_DST) const;
+
+		/**
+		 * Get an upper bound on the number of packets of an IP address
+		 * @param[in] address An IPv4 or IPv6 address
+		 * @param[in] direction Whether to count the address as the source address, the destination address or either of them. The default
+		 * is ::SRC_OR_DST
+		 * @return At least the number of packets which have the address. The counters saturate at 255 per direction, so 255 means "255 or
+		 * more"
+		 */
+		uint32_t getMaxNumOfPackets(const IPAddressValue& address, Direction direction = SRC_OR_DST) const;
+
+		/**
+		 * Check whether any TCP or UDP packet of the file has a port within a range
+		 * @param[in] fromPort The lowest port of the range
+		 * @param[in] toPort The highest port of the range
+		 * @param[in] direction Whether to look for the source port, the destination port or either of them. The default is ::SRC_OR_DST
+		 * @return True if some packet has such a port, false otherwise
+		 */
+		bool containsPort(uint16_t fromPort, uint16_t toPort, Direction direction = SRC_OR_DST) const;
+
+		/**
+		 * @param[in] ipProtocol An IP protocol number
+		 * @return True if some IPv4 or IPv6 packet carries this protocol, false otherwise
+		 */
+		inline bool containsIPProtocol(uint8_t ipProtocol) const { return (m_IPProtocols[ipProtocol / 8] & (1 << (ipProtocol % 8))) != 0; }
+
+		/**
+		 * @param[in] vlanId A VLAN ID
+		 * @return True if some packet is tagged with this VLAN ID in its outermost VLAN tag, false otherwise
+		 */
+		inline bool containsVlanId(uint16_t vlanId) const { return (m_VlanIds[(vlanId & 0xfff) / 8] & (1 << (vlanId % 8))) != 0; }
+
+		/**
+		 * @return The number of packets in the summary
+		 */
+		inline uint64_t getNumOfPackets() const { return m_NumOfPackets; }
+
+		/**
+		 * @return The number of packets which aren't IPv4 or IPv6 packets, such as ARP packets
+		 */
+		inline uint64_t getNumOfNonIPPackets() const { return m_NumOfNonIPPackets; }
+
+		/**
+		 * @return A bitmask of the protocols found in the packets, see PacketView#protocolTypes
+		 */
+		inline uint64_t getProtocolTypes() const { return m_ProtocolTypes; }
+
+		/**
+		 * @return The earliest packet timestamp, or 0 if the summary has no packets
+		 */
+		timespec getFirstTimestamp() const;
+
+		/**
+		 * @return The latest packet timestamp, or 0 if the summary has no packets
+		 */
+		timespec getLastTimestamp() const;
+
+		/**
+		 * @return The number of counters of each of the IP address Bloom filters
+		 */
+		inline size_t getBloomFilterSize() const { return m_SrcIPFilter.size(); }
+
+	private:
+		// identifies a sidecar file and the version of its format
+		static const uint32_t SummaryFileMagic = 0x4d555350;
+		static const uint16_t SummaryFileVersion = 1;
+		static const int NumOfHashes = 3;
+
+		uint64_t m_FileSize;
+		int64_t m_ModificationTime;
+		uint64_t m_NumOfPackets;
+		uint64_t m_NumOfNonIPPackets;
+		// in nanoseconds
+		uint64_t m_FirstTimestamp;
+		uint64_t m_LastTimestamp;
+		uint64_t m_ProtocolTypes;
+		// in host byte order. The lowest address is larger than the highest one if the summary has no IPv4 packets
+		uint32_t m_MinSrcIPv4;
+		uint32_t m_MaxSrcIPv4;
+		uint32_t m_MinDstIPv4;
+		uint32_t m_MaxDstIPv4;
+		uint8_t m_IPProtocols[256 / 8];
+		uint8_t m_VlanIds[4096 / 8];
+		std::vector<uint8_t> m_SrcPorts;
+		std::vector<uint8_t> m_DstPorts;
+		std::vector<uint8_t> m_SrcIPFilter;
+		std::vector<uint8_t> m_DstIPFilter;
+
+		void getBloomFilterCounters(const uint8_t* address, size_t addressLen, size_t* counters) const;
+		void addToBloomFilter(std::vector<uint8_t>& filter, const uint8_t* address, size_t addressLen);
+		uint32_t getBloomFilterCount(const std::vector<uint8_t>& filter, const IPAddressValue& address) const;
+		bool mayMatchPredicate(const NativeFilterPredicate& predicate) const;
+		bool mayMatchNode(const NativeFilterNode& node) const;
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_PCAP_FILE_SUMMARY */
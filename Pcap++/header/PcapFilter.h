@@ -7,6 +7,8 @@
 #include "ProtocolType.h"
 #include <stdint.h>
 #include "ArpLayer.h"
+#include "RawPacket.h"
+#include "BpfJit.h"
 
 //Forward Declaration - used in GeneralFilter
 struct bpf_program;
@@ -35,6 +37,7 @@ namespace pcpp
 {
 	//Forward Declartation - used in GeneralFilter
 	class RawPacket;
+	struct NativeFilterNode;
 
 	/**
 	 * An enum that contains direction (source or destination)
@@ -70,23 +73,249 @@ namespace pcpp
 	} FilterOperator;
 
 
+/**
+ * The maximum number of flow rules a filter is translated into by GeneralFilter#toFlowRules()
+ */
+#define PCPP_MAX_FILTER_FLOW_RULES 64
+
+	/**
+	 * @struct FilterFlowRule
+	 * A filter expressed as a match on a fixed set of header fields, which is the form NICs and kernels can apply before packets reach
+	 * the application: rte_flow rules in DpdkDevice, PF_RING filtering rules in PfRingDevice and the XDP program of XdpDevice.
+	 * Each field has a value and a mask, and a packet matches the rule if the bits set in the mask are equal in the packet and in the value
+	 * for every field. A field whose mask is 0 matches all packets, while a field whose mask isn't 0 matches only packets that have
+	 * this field (for example, an IP protocol field never matches ARP packets). Rules which match IPv4 addresses always match the IPv4
+	 * EtherType, and rules which match ports always match the TCP, UDP or SCTP protocol.
+	 * A filter is translated into a list of rules (see GeneralFilter#toFlowRules()) and a packet matches the filter if it matches at least
+	 * one of them
+	 */
+	struct FilterFlowRule
+	{
+		/** The EtherType of the Ethernet header, in host byte order */
+		uint16_t etherType;
+		/** The mask of the EtherType */
+		uint16_t etherTypeMask;
+		/** The protocol field of IPv4 or the next header field of IPv6 */
+		uint8_t ipProtocol;
+		/** The mask of the IP protocol */
+		uint8_t ipProtocolMask;
+		/** The IPv4 source address, in network byte order (as returned by IPv4Address#toInt()) */
+		uint32_t srcIPv4Address;
+		/** The mask of the IPv4 source address, in network byte order */
+		uint32_t srcIPv4Mask;
+		/** The IPv4 destination address, in network byte order (as returned by IPv4Address#toInt()) */
+		uint32_t dstIPv4Address;
+		/** The mask of the IPv4 destination address, in network byte order */
+		uint32_t dstIPv4Mask;
+		/** The TCP, UDP or SCTP source port, in host byte order */
+		uint16_t srcPort;
+		/** The mask of the source port */
+		uint16_t srcPortMask;
+		/** The TCP, UDP or SCTP destination port, in host byte order */
+		uint16_t dstPort;
+		/** The mask of the destination port */
+		uint16_t dstPortMask;
+
+		/**
+		 * A c'tor for this struct which creates a rule matching all packets
+		 */
+		FilterFlowRule();
+
+		/**
+		 * Narrow the rule so it matches only packets which also match another rule
+		 * @param[in] other The other rule
+		 * @return True if the rules were merged, false if no packet can match both of them. In that case this rule isn't changed
+		 */
+		bool mergeWith(const FilterFlowRule& other);
+
+		/**
+		 * @return True if the rule matches all packets, meaning all of its masks are 0
+		 */
+		bool isMatchAll() const;
+	};
+
+
+/**
+ * The default snapshot length BPF programs are compiled with
+ */
+#define PCPP_BPF_DEFAULT_SNAPLEN 65535
+
+/**
+ * The default number of packets filter profiles (see NativeFilterProfile and BpfFilterProfile) measure the cycles of one packet out of
+ */
+#define PCPP_FILTER_PROFILE_DEFAULT_SAMPLE_RATE 64
+
+	/**
+	 * @struct FilterNodeStats
+	 * The counters a filter profile (see NativeFilterProfile and BpfFilterProfile) keeps for one node of a filter: the number of packets
+	 * the node was evaluated on, how many of them it matched, and the cycles its evaluations took (see TimestampClock#readCycleCounter()).
+	 * Reading the cycle counter costs about as much as evaluating a simple predicate, so cycles are measured only on a sample of the
+	 * packets, which are counted in #sampled
+	 */
+	struct FilterNodeStats
+	{
+		/** The number of packets the node was evaluated on */
+		uint64_t evaluated;
+		/** The number of packets the node matched */
+		uint64_t matched;
+		/** The number of evaluations whose cycles were measured */
+		uint64_t sampled;
+		/** The total cycles of the measured evaluations */
+		uint64_t cycles;
+
+		/**
+		 * A c'tor for this struct which zeroes all counters
+		 */
+		FilterNodeStats() : evaluated(0), matched(0), sampled(0), cycles(0) {}
+
+		/**
+		 * @return The share of the evaluations which matched, or 0 if the node wasn't evaluated
+		 */
+		double getMatchRatio() const { return (evaluated > 0 ? (double)matched / (double)evaluated : 0.0); }
+
+		/**
+		 * @return The average cycles of a measured evaluation, or 0 if no evaluation was measured
+		 */
+		double getAverageCycles() const { return (sampled > 0 ? (double)cycles / (double)sampled : 0.0); }
+	};
+
+	/**
+	 * @class BpfFilterProgram
+	 * A BPF filter compiled once into a frozen program for a given link type and snapshot length. Matching a packet with a compiled program
+	 * doesn't allocate memory and doesn't change the object, so one program may be shared by threads which match packets in parallel, as
+	 * long as none of them calls compile() or clear() at the same time.<BR>
+	 * Where supported (see BpfJitProgram) the program is also translated into native code, and packets are matched by running it instead
+	 * of the BPF interpreter of libpcap. Programs which can't be translated are matched by the interpreter, with the same results
+	 */
+	class BpfFilterProgram
+	{
+	public:
+		/**
+		 * A c'tor for this class which creates an empty program. Use compile() to compile a filter into it
+		 */
+		BpfFilterProgram();
+
+		/**
+		 * A d'tor for this class, frees the program
+		 */
+		~BpfFilterProgram();
+
+		/**
+		 * Compile a filter into the program, replacing the current program
+		 * @param[in] filterAsString The filter in BPF syntax
+		 * @param[in] linkType The link type of the packets the program is matched with. Default value is LINKTYPE_ETHERNET
+		 * @param[in] snapshotLength The snapshot length of the packets the program is matched with. Default value is
+		 * #PCPP_BPF_DEFAULT_SNAPLEN
+		 * @return True if the filter was compiled, false if it's invalid. In that case the program is left empty
+		 */
+		bool compile(const std::string& filterAsString, LinkLayerType linkType = LINKTYPE_ETHERNET, int snapshotLength = PCPP_BPF_DEFAULT_SNAPLEN);
+
+		/**
+		 * Free the program
+		 */
+		void clear();
+
+		/**
+		 * @return True if a filter is compiled into the program
+		 */
+		inline bool isCompiled() const { return m_Program != NULL; }
+
+		/**
+		 * @return The filter compiled into the program, or an empty string if there isn't one
+		 */
+		inline const std::string& getFilterString() const { return m_FilterString; }
+
+		/**
+		 * @return The link type the program was compiled for
+		 */
+		inline LinkLayerType getLinkType() const { return m_LinkType; }
+
+		/**
+		 * @return True if the program was translated into native code, false if packets are matched by the BPF interpreter
+		 */
+		inline bool isJitCompiled() const { return m_JitProgram.isCompiled(); }
+
+		/**
+		 * Enable or disable the translation of programs into native code for all programs compiled from now on. It's enabled by default
+		 * where supported, and may be disabled to compare results with the BPF interpreter
+		 * @param[in] enabled Whether to translate programs into native code
+		 */
+		static void setJitEnabled(bool enabled);
+
+		/**
+		 * @return True if programs compiled from now on are translated into native code, which requires the translation to be enabled and
+		 * supported on this platform
+		 */
+		static bool isJitEnabled();
+
+		/**
+		 * Match packet data with the program
+		 * @param[in] packetData A pointer to the packet data, starting at the link layer
+		 * @param[in] capturedLength The number of bytes captured
+		 * @param[in] packetLength The length of the packet on the wire
+		 * @return True if the packet matches the program, false if it doesn't or if the program is empty
+		 */
+		bool matchPacket(const uint8_t* packetData, uint32_t capturedLength, uint32_t packetLength) const;
+
+		/**
+		 * Match a raw packet with the program. The link type of the packet isn't checked
+		 * @param[in] rawPacket A pointer to the raw packet
+		 * @return True if the packet matches the program, false if it doesn't or if the program is empty
+		 */
+		bool matchPacket(const RawPacket* rawPacket) const;
+
+	private:
+		bpf_program* m_Program;
+		BpfJitProgram m_JitProgram;
+		std::string m_FilterString;
+		LinkLayerType m_LinkType;
+
+		// disable copy c'tor and assignment operator
+		BpfFilterProgram(const BpfFilterProgram& other);
+		BpfFilterProgram& operator=(const BpfFilterProgram& other);
+	};
+
+
 	/**
 	 * @class GeneralFilter
 	 * The base class for all filter classes. This class is virtual and abstract, hence cannot be instantiated.<BR>
+	 * A filter keeps the BPF program it was last compiled into, and compiles it again only after the filter (or a filter it contains) was
+	 * changed, or when it's matched with packets of another link type.<BR>
 	 * For deeper understanding of the filter concept please refer to PcapFilter.h
 	 */
 	class GeneralFilter
 	{
 	protected:
-		bpf_program* m_program;
-		std::string m_lastProgramString;
+		BpfFilterProgram m_Program;
+		uint32_t m_ProgramVersion;
+		uint32_t m_Version;
 
 		/**
 		* Free the held program and any resources allocated for it.
 		*/
 		void freeProgram();
 
+		/**
+		 * Mark the filter as changed, so the program is compiled again before the next match. Called by every method which changes the
+		 * filter
+		 */
+		void invalidateProgram();
+
+		/**
+		 * Compile the filter into the held program if it changed since it was compiled or if it was compiled for another link type
+		 * @param[in] linkType The link type to compile the filter for
+		 * @return True if the held program is valid, false if the filter can't be compiled
+		 */
+		bool updateProgram(LinkLayerType linkType);
+
 	public:
+		/**
+		 * Get the version of the filter, which changes every time the filter or a filter it contains is changed. Filters which contain other
+		 * filters override this method to take the version of the contained filters into account
+		 * @return The version of the filter
+		 */
+		virtual uint32_t getVersion() const { return m_Version; }
+
 		/**
 		 * A method that parses the class instance into BPF string format
 		 * @param[out] result An empty string that the parsing will be written into. If the string isn't empty, its content will be overridden
@@ -94,12 +323,44 @@ namespace pcpp
 		virtual void parseToString(std::string& result) = 0;
 
 		/**
-		* Match a raw packet with a given BPF filter.
+		 * Translate the filter into flow rules which NICs and kernels can apply (see FilterFlowRule). Devices that can push filters down
+		 * use this method to decide whether a filter can be offloaded and fall back to BPF otherwise. The default implementation returns
+		 * false; it's implemented by IPFilter (IPv4 addresses only), PortFilter, EtherTypeFilter, ProtoFilter, AndFilter and OrFilter
+		 * @param[out] rules The rules the filter is translated into. A packet matches the filter if it matches at least one of the rules,
+		 * so an empty list means no packet matches. The current content of the vector is cleared
+		 * @return True if the filter was translated, false if it can't be expressed as at most #PCPP_MAX_FILTER_FLOW_RULES flow rules
+		 */
+		virtual bool toFlowRules(std::vector<FilterFlowRule>& rules);
+
+		/**
+		 * Translate the filter into a tree of predicates over the headers FlowKeyExtractor parses, which NativeFilterProgram compiles and
+		 * matches packets with without libpcap (see NativeFilter.h). The default implementation returns false; it's implemented by all
+		 * filters except BPFStringFilter, and by IPFilter for IPv4 addresses only
+		 * @param[out] node The root of the tree the filter is translated into. Its current content is overridden
+		 * @return True if the filter was translated, false if it (or a filter it contains) can't be evaluated natively
+		 */
+		virtual bool toNativeFilter(NativeFilterNode& node);
+
+		/**
+		* Match a raw packet with a given BPF filter. The filter is compiled for the link type of the packet on the first call, and compiled
+		* again only if the filter was changed or a packet of another link type is matched. This method isn't thread-safe: threads which
+		* match packets in parallel should share a program created with compile() instead
 		* @param[in] rawPacket A pointer to the raw packet to match the BPF filter with
 		* @return True if a raw packet matches the BPF filter or false otherwise
 		*/
 		bool matchPacketWithFilter(RawPacket* rawPacket);
 
+		/**
+		 * Compile the filter into a frozen program, which isn't affected by later changes of the filter and can be shared by threads which
+		 * match packets in parallel
+		 * @param[out] program The program to compile the filter into
+		 * @param[in] linkType The link type of the packets the program is matched with. Default value is LINKTYPE_ETHERNET
+		 * @param[in] snapshotLength The snapshot length of the packets the program is matched with. Default value is
+		 * #PCPP_BPF_DEFAULT_SNAPLEN
+		 * @return True if the filter was compiled, false otherwise
+		 */
+		bool compile(BpfFilterProgram& program, LinkLayerType linkType = LINKTYPE_ETHERNET, int snapshotLength = PCPP_BPF_DEFAULT_SNAPLEN);
+
 		GeneralFilter();
 
 		/**
@@ -155,7 +416,7 @@ namespace pcpp
 		 * Set the direction for the filter (source or destination)
 		 * @param[in] dir The direction
 		 */
-		void setDirection(Direction dir) { m_Dir = dir; }
+		void setDirection(Direction dir) { m_Dir = dir; invalidateProgram(); }
 	};
 
 
@@ -178,7 +439,7 @@ namespace pcpp
 		 * Set the operator for the filter
 		 * @param[in] op The operator to set
 		 */
-		void setOperator(FilterOperator op) { m_Operator = op; }
+		void setOperator(FilterOperator op) { m_Operator = op; invalidateProgram(); }
 	};
 
 
@@ -197,6 +458,7 @@ namespace pcpp
 		int m_Len;
 		void convertToIPAddressWithMask(std::string& ipAddrmodified, std::string& mask);
 		void convertToIPAddressWithLen(std::string& ipAddrmodified, int& len);
+		bool getIPv4AddressAndMask(uint32_t& ipAddress, uint32_t& mask);
 	public:
 		/**
 		 * The basic constructor that creates the filter from an IPv4 address and direction (source or destination)
@@ -230,24 +492,28 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toFlowRules(std::vector<FilterFlowRule>& rules);
+
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set the IPv4 address
 		 * @param[in] ipAddress The IPv4 address to build the filter with. If this address is not a valid IPv4 address an error will be
 		 * written to log and parsing this filter will fail
 		 */
-		void setAddr(const std::string& ipAddress) { m_Address = ipAddress; }
+		void setAddr(const std::string& ipAddress) { m_Address = ipAddress; invalidateProgram(); }
 
 		/**
 		 * Set the IPv4 mask
 		 * @param[in] ipv4Mask The mask to use. Mask should also be in a valid IPv4 format (i.e x.x.x.x), otherwise parsing this filter will fail
 		 */
-		void setMask(const std::string& ipv4Mask) { m_IPv4Mask = ipv4Mask; m_Len = 0; }
+		void setMask(const std::string& ipv4Mask) { m_IPv4Mask = ipv4Mask; m_Len = 0; invalidateProgram(); }
 
 		/**
 		 * Set the subnet
 		 * @param[in] len The subnet to use (e.g "/24")
 		 */
-		void setLen(int len) { m_IPv4Mask = ""; m_Len = len; }
+		void setLen(int len) { m_IPv4Mask = ""; m_Len = len; invalidateProgram(); }
 	};
 
 
@@ -272,11 +538,13 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set the IP ID to filter
 		 * @param[in] ipID The IP ID to filter
 		 */
-		void setIpID(uint16_t ipID) { m_IpID = ipID; }
+		void setIpID(uint16_t ipID) { m_IpID = ipID; invalidateProgram(); }
 	};
 
 
@@ -301,11 +569,13 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set the total length value
 		 * @param[in] totalLength The total length value to filter
 		 */
-		void setTotalLength(uint16_t totalLength) { m_TotalLength = totalLength; }
+		void setTotalLength(uint16_t totalLength) { m_TotalLength = totalLength; invalidateProgram(); }
 	};
 
 
@@ -330,11 +600,15 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toFlowRules(std::vector<FilterFlowRule>& rules);
+
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set the port
 		 * @param[in] port The port to create the filter with
 		 */
-		void setPort(uint16_t port) { portToString(port); }
+		void setPort(uint16_t port) { portToString(port); invalidateProgram(); }
 	};
 
 
@@ -361,17 +635,19 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set the lower end of the port range
 		 * @param[in] fromPort The lower end of the port range
 		 */
-		void setFromPort(uint16_t fromPort) { m_FromPort = fromPort; }
+		void setFromPort(uint16_t fromPort) { m_FromPort = fromPort; invalidateProgram(); }
 
 		/**
 		 * Set the higher end of the port range
 		 * @param[in] toPort The higher end of the port range
 		 */
-		void setToPort(uint16_t toPort) { m_ToPort = toPort; }
+		void setToPort(uint16_t toPort) { m_ToPort = toPort; invalidateProgram(); }
 	};
 
 
@@ -395,11 +671,13 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set the MAC address
 		 * @param[in] address The MAC address to use for filtering
 		 */
-		void setMacAddress(MacAddress address) { m_MacAddress = address; }
+		void setMacAddress(MacAddress address) { m_MacAddress = address; invalidateProgram(); }
 	};
 
 
@@ -423,11 +701,15 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toFlowRules(std::vector<FilterFlowRule>& rules);
+
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set the EtherType value
 		 * @param[in] etherType The EtherType value to create the filter with
 		 */
-		void setEtherType(uint16_t etherType) { m_EtherType = etherType; }
+		void setEtherType(uint16_t etherType) { m_EtherType = etherType; invalidateProgram(); }
 	};
 
 
@@ -461,7 +743,7 @@ namespace pcpp
 		 * Add filter to the and condition
 		 * @param[in] filter The filter to add
 		 */
-		void addFilter(GeneralFilter* filter) { m_FilterList.push_back(filter); }
+		void addFilter(GeneralFilter* filter) { m_FilterList.push_back(filter); invalidateProgram(); }
 
 		/**
 		 * Remove the current filters and set new ones
@@ -469,7 +751,18 @@ namespace pcpp
 		 */
 		void setFilters(std::vector<GeneralFilter*>& filters);
 
+		/**
+		 * @return The filters of the and condition
+		 */
+		const std::vector<GeneralFilter*>& getFilters() const { return m_FilterList; }
+
 		void parseToString(std::string& result);
+
+		bool toFlowRules(std::vector<FilterFlowRule>& rules);
+
+		bool toNativeFilter(NativeFilterNode& node);
+
+		uint32_t getVersion() const;
 	};
 
 
@@ -503,9 +796,20 @@ namespace pcpp
 		 * Add filter to the or condition
 		 * @param[in] filter The filter to add
 		 */
-		void addFilter(GeneralFilter* filter) { m_FilterList.push_back(filter); }
+		void addFilter(GeneralFilter* filter) { m_FilterList.push_back(filter); invalidateProgram(); }
+
+		/**
+		 * @return The filters of the or condition
+		 */
+		const std::vector<GeneralFilter*>& getFilters() const { return m_FilterList; }
 
 		void parseToString(std::string& result);
+
+		bool toFlowRules(std::vector<FilterFlowRule>& rules);
+
+		bool toNativeFilter(NativeFilterNode& node);
+
+		uint32_t getVersion() const;
 	};
 
 
@@ -528,11 +832,20 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set a filter to create an inverse filter from
 		 * @param[in] filterToInverse A pointer to filter which the created filter be the inverse of
 		 */
-		void setFilter(GeneralFilter* filterToInverse) { m_FilterToInverse = filterToInverse; }
+		void setFilter(GeneralFilter* filterToInverse) { m_FilterToInverse = filterToInverse; invalidateProgram(); }
+
+		/**
+		 * @return The filter this filter is the inverse of
+		 */
+		GeneralFilter* getFilter() const { return m_FilterToInverse; }
+
+		uint32_t getVersion() const;
 	};
 
 
@@ -558,12 +871,16 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toFlowRules(std::vector<FilterFlowRule>& rules);
+
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set the protocol to filter with
 		 * @param[in] proto The protocol to filter, only packets matching this protocol will be received. Please note not all protocols are
 		 * supported. List of supported protocols is found in the class description
 		 */
-		void setProto(ProtocolType proto) { m_Proto = proto; }
+		void setProto(ProtocolType proto) { m_Proto = proto; invalidateProgram(); }
 	};
 
 
@@ -587,11 +904,13 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set the ARP opcode
 		 * @param[in] opCode The ARP opcode: ::ARP_REQUEST or ::ARP_REPLY
 		 */
-		void setOpCode(ArpOpcode opCode) { m_OpCode = opCode; }
+		void setOpCode(ArpOpcode opCode) { m_OpCode = opCode; invalidateProgram(); }
 	};
 
 
@@ -615,11 +934,13 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set the VLAN ID of the filter
 		 * @param[in] vlanId The VLAN ID to use for the filter
 		 */
-		void setVlanID(uint16_t vlanId) { m_VlanID = vlanId; }
+		void setVlanID(uint16_t vlanId) { m_VlanID = vlanId; invalidateProgram(); }
 	};
 
 
@@ -681,9 +1002,11 @@ namespace pcpp
 		 * following value for example: TcpFlagsFilter::tcpSyn | TcpFlagsFilter::tcpAck | TcpFlagsFilter::tcpUrg
 		 * @param[in] matchOption The match option: TcpFlagsFilter::MatchAll or TcpFlagsFilter::MatchOneAtLeast
 		 */
-		void setTcpFlagsBitMask(uint8_t tcpFlagBitMask, MatchOptions matchOption) { m_TcpFlagsBitMask = tcpFlagBitMask; m_MatchOption = matchOption; }
+		void setTcpFlagsBitMask(uint8_t tcpFlagBitMask, MatchOptions matchOption) { m_TcpFlagsBitMask = tcpFlagBitMask; m_MatchOption = matchOption; invalidateProgram(); }
 
 		void parseToString(std::string& result);
+
+		bool toNativeFilter(NativeFilterNode& node);
 	};
 
 
@@ -708,11 +1031,13 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set window-size value
 		 * @param[in] windowSize The window-size value that will be used in the filter
 		 */
-		void setWindowSize(uint16_t windowSize) { m_WindowSize = windowSize; }
+		void setWindowSize(uint16_t windowSize) { m_WindowSize = windowSize; invalidateProgram(); }
 	};
 
 
@@ -737,11 +1062,132 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool toNativeFilter(NativeFilterNode& node);
+
 		/**
 		 * Set legnth value
 		 * @param[in] legnth The legnth value that will be used in the filter
 		 */
-		void setLength(uint16_t legnth) { m_Length = legnth; }
+		void setLength(uint16_t legnth) { m_Length = legnth; invalidateProgram(); }
+	};
+
+
+
+	/**
+	 * @class BpfFilterProfile
+	 * Profiles the BPF evaluation of a filter node by node. Each filter in the tree which isn't an AndFilter, OrFilter or NotFilter is
+	 * compiled into a BpfFilterProgram of its own, and packets are matched by evaluating the tree with short-circuiting, like the program
+	 * compiled from the whole filter does, so a node is counted only on packets its result was needed for. The result is the same as
+	 * matching the whole filter, but running a program per node is slower, so this class is meant for measuring filters on a sample of
+	 * the traffic, not for filtering it.<BR>
+	 * The counters show which sub-filters are selective and which are expensive, for ordering the filters of AndFilter and OrFilter so
+	 * the cheap and decisive ones come first, or for pushing them down to the device. Filters which can be evaluated natively can be
+	 * profiled with NativeFilterProfile instead, which measures the program actually used for filtering. This class isn't thread-safe
+	 */
+	class BpfFilterProfile
+	{
+	public:
+		/**
+		 * A c'tor for this class which creates an empty profile. Use compile() to compile a filter into it
+		 * @param[in] sampleRate The cycles of the nodes are measured on one packet out of this number. Default value is
+		 * #PCPP_FILTER_PROFILE_DEFAULT_SAMPLE_RATE
+		 */
+		BpfFilterProfile(uint32_t sampleRate = PCPP_FILTER_PROFILE_DEFAULT_SAMPLE_RATE);
+
+		/**
+		 * A d'tor for this class, frees the programs of the nodes
+		 */
+		~BpfFilterProfile();
+
+		/**
+		 * Compile each node of a filter into its own program, replacing the current nodes and counters. The nodes are numbered in
+		 * pre-order: the filter itself is node 0, and the filters an AndFilter, OrFilter or NotFilter contains follow it in their order
+		 * @param[in] filter The filter to compile
+		 * @param[in] linkType The link type of the packets the filter is matched with. Default value is LINKTYPE_ETHERNET
+		 * @param[in] snapshotLength The snapshot length of the packets the filter is matched with. Default value is
+		 * #PCPP_BPF_DEFAULT_SNAPLEN
+		 * @return True if all nodes were compiled, false otherwise. In that case the profile is left empty
+		 */
+		bool compile(GeneralFilter& filter, LinkLayerType linkType = LINKTYPE_ETHERNET, int snapshotLength = PCPP_BPF_DEFAULT_SNAPLEN);
+
+		/**
+		 * Free the nodes and their counters
+		 */
+		void clear();
+
+		/**
+		 * Zero the counters of all nodes
+		 */
+		void resetStats();
+
+		/**
+		 * Match packet data with the filter and count the evaluated nodes
+		 * @param[in] packetData A pointer to the packet data, starting at the link layer
+		 * @param[in] capturedLength The number of bytes captured
+		 * @param[in] packetLength The length of the packet on the wire
+		 * @return True if the packet matches the filter, false if it doesn't or if no filter is compiled
+		 */
+		bool matchPacket(const uint8_t* packetData, uint32_t capturedLength, uint32_t packetLength);
+
+		/**
+		 * Match a raw packet with the filter and count the evaluated nodes. The link type of the packet isn't checked
+		 * @param[in] rawPacket A pointer to the raw packet
+		 * @return True if the packet matches the filter, false if it doesn't or if no filter is compiled
+		 */
+		bool matchPacket(const RawPacket* rawPacket);
+
+		/**
+		 * @return The number of nodes of the compiled filter, 0 if no filter is compiled
+		 */
+		inline size_t getNumOfNodes() const { return m_Nodes.size(); }
+
+		/**
+		 * @param[in] nodeIndex The index of the node, see compile()
+		 * @return The counters of the node. Those of node 0 count all matched packets
+		 */
+		inline const FilterNodeStats& getNodeStats(size_t nodeIndex) const { return m_Nodes[nodeIndex].stats; }
+
+		/**
+		 * @param[in] nodeIndex The index of the node, see compile()
+		 * @return The node filter in BPF syntax
+		 */
+		inline const std::string& getNodeFilterString(size_t nodeIndex) const { return m_Nodes[nodeIndex].filterString; }
+
+		/**
+		 * @param[in] nodeIndex The index of the node, see compile()
+		 * @return The index of the AndFilter, OrFilter or NotFilter node which contains the node, or -1 for node 0
+		 */
+		inline int getNodeParent(size_t nodeIndex) const { return m_Nodes[nodeIndex].parent; }
+
+	private:
+		enum NodeType
+		{
+			LeafNode,
+			AndNode,
+			OrNode,
+			NotNode
+		};
+
+		struct Node
+		{
+			NodeType type;
+			int parent;
+			std::vector<size_t> children;
+			BpfFilterProgram* program;
+			std::string filterString;
+			FilterNodeStats stats;
+		};
+
+		std::vector<Node> m_Nodes;
+		uint32_t m_SampleRate;
+		uint32_t m_SampleCountdown;
+
+		bool addNode(GeneralFilter* filter, int parent, LinkLayerType linkType, int snapshotLength);
+		bool evaluateNode(size_t nodeIndex, const uint8_t* packetData, uint32_t capturedLength, uint32_t packetLength, bool sample);
+
+		// disable copy c'tor and assignment operator
+		BpfFilterProfile(const BpfFilterProfile& other);
+		BpfFilterProfile& operator=(const BpfFilterProfile& other);
 	};
 
 } // namespace pcpp
@@ -0,0 +1,152 @@
+#ifndef PCAPPP_PCAP_FLOW_INDEX
+#define PCAPPP_PCAP_FLOW_INDEX
+
+#include "PcapFileIndex.h"
+#include "FlowHash.h"
+#include "PointerVector.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class PcapFlowIndex
+	 * A per-flow index of a pcap or pcap-ng file, which extracts the packets of one flow from a large capture without reading the rest of it.
+	 * The index is a sidecar file built by one pass over the capture (see build()), which holds the file offsets of the packets of every
+	 * bidirectional flow (5-tuple with the endpoints ordered, so both directions are one flow). Packets without an IPv4 or IPv6 header aren't
+	 * indexed.<BR>
+	 * The sidecar file is a sorted file: the offsets of all flows, each flow as one run of delta-encoded variable-length numbers, followed by
+	 * a directory of fixed-size entries sorted by flow key. open() reads only the header of the sidecar file, and finding a flow is a binary
+	 * search over the directory on disk, so looking a flow up reads a few dozen small records regardless of the size of the capture, and
+	 * extracting it reads only its own packets. Like PcapFileIndex, the sidecar file holds the size of the capture it was built for and isn't
+	 * opened for a capture of another size.<BR>
+	 * An instance holds an open file handle and a read buffer, so it should be used by one thread at a time. Several instances may use the
+	 * same sidecar file in parallel
+	 */
+	class PcapFlowIndex
+	{
+	public:
+
+		/**
+		 * A c'tor for this class, which creates a closed index
+		 */
+		PcapFlowIndex();
+
+		/**
+		 * A d'tor for this class, closes the index
+		 */
+		~PcapFlowIndex();
+
+		/**
+		 * Build the flow index of an indexed capture by reading all its packets once, and write it to a sidecar file. The flows are collected
+		 * in memory before they're written, which takes a few bytes per packet and about 150 bytes per flow
+		 * @param[in] fileIndex The packet index of the capture (see PcapFileIndex#build() and PcapFileIndex#loadOrBuild())
+		 * @param[in] flowIndexFileName The sidecar file name
+		 * @return True if the index was written, false if the capture couldn't be read or the sidecar file couldn't be written
+		 */
+		static bool build(const PcapFileIndex& fileIndex, const std::string& flowIndexFileName);
+
+		/**
+		 * Open a sidecar file written by build()
+		 * @param[in] flowIndexFileName The sidecar file name
+		 * @param[in] fileName The pcap or pcap-ng file the index was built for
+		 * @return True if the index was opened, false if the sidecar file can't be read, is invalid or was built for a file of another size
+		 */
+		bool open(const std::string& flowIndexFileName, const std::string& fileName);
+
+		/**
+		 * Open the flow index of a file from its default sidecar file (see getDefaultIndexFileName()) or, if it can't be opened, build it
+		 * there first. The packet index needed for building is loaded or built with PcapFileIndex#loadOrBuild()
+		 * @param[in] fileName The pcap or pcap-ng file
+		 * @return True if the index was opened, false otherwise
+		 */
+		bool openOrBuild(const std::string& fileName);
+
+		/**
+		 * Close the index
+		 */
+		void close();
+
+		/**
+		 * @return True if the index is open, false otherwise
+		 */
+		inline bool isOpened() const { return m_IndexFile != NULL; }
+
+		/**
+		 * @param[in] fileName A pcap or pcap-ng file name
+		 * @return The default sidecar file name of the flow index of the file, which is the file name with a ".fidx" suffix
+		 */
+		static std::string getDefaultIndexFileName(const std::string& fileName);
+
+		/**
+		 * @return The number of flows in the index, or 0 if it isn't open
+		 */
+		inline uint64_t getNumOfFlows() const { return m_NumOfFlows; }
+
+		/**
+		 * Find the packets of a flow
+		 * @param[in] tuple The 5-tuple of the flow in either direction (see FlowHash#getTuple())
+		 * @param[out] packetOffsets The file offsets of the packets of the flow in file order, see PcapFileIndex#getPacketOffset(). The
+		 * vector is cleared first
+		 * @return True if the lookup succeeded, including when the flow isn't in the index (packetOffsets is then empty), false if the
+		 * index isn't open or the sidecar file couldn't be read
+		 */
+		bool findFlow(const FlowTuple& tuple, std::vector<uint64_t>& packetOffsets);
+
+		/**
+		 * Read the packets of a flow from the capture
+		 * @param[in] tuple The 5-tuple of the flow in either direction (see FlowHash#getTuple())
+		 * @param[out] packets The packets of the flow in file order, which are copies owned by the vector. The vector isn't cleared first
+		 * @return True if the packets were read, including when the flow isn't in the index, false if the index isn't open or the sidecar
+		 * file or the capture couldn't be read
+		 */
+		bool readFlow(const FlowTuple& tuple, PointerVector<RawPacket>& packets);
+
+		/**
+		 * Get the 5-tuple of every flow in the index, for example to list the flows of a capture. This reads the whole directory
+		 * @param[out] flows The tuples, with the endpoints ordered as in the index. The vector is cleared first
+		 * @return True if the directory was read, false if the index isn't open or the sidecar file couldn't be read
+		 */
+		bool getFlows(std::vector<FlowTuple>& flows);
+
+	private:
+
+		// identifies a sidecar file and the version of its format
+		static const uint32_t IndexFileMagic = 0x58444946;
+		static const uint16_t IndexFileVersion = 1;
+
+		// the packed form of a flow key, whose byte order is the order of the directory
+		static const size_t KeyLength = 38;
+		// a directory entry: the key, the number of packets and the offset and length of the run of the flow
+		static const size_t DirectoryEntryLength = KeyLength + 8 + 8 + 4;
+
+		// the capture, with the interfaces of the sidecar file but no packet offsets
+		PcapFileIndex m_FileInfo;
+		PcapFileIndex::PacketReader* m_PacketReader;
+		FILE* m_IndexFile;
+		uint64_t m_NumOfFlows;
+		uint64_t m_DirectoryOffset;
+		std::vector<uint8_t> m_Buffer;
+
+		static void packKey(const FlowTuple& tuple, uint8_t* key);
+		static void unpackKey(const uint8_t* key, FlowTuple& tuple);
+		bool readDirectoryEntry(uint64_t entryNumber, uint8_t* entry);
+		bool findFlowEntries(const FlowTuple& tuple, std::vector<uint64_t>& packetOffsets, std::vector<uint32_t>& packetInterfaces);
+
+		// disable copy c'tor and assignment operator
+		PcapFlowIndex(const PcapFlowIndex& other);
+		PcapFlowIndex& operator=(const PcapFlowIndex& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_PCAP_FLOW_INDEX */
@@ -7,6 +7,11 @@
 #include <string.h>
 #include "IpAddress.h"
 #include "Packet.h"
+#include "RawPacketPool.h"
+#include "RawPacketSlabVector.h"
+#include "SystemUtils.h"
+#include "PacketSampler.h"
+#include "PcapAutoTuner.h"
 
 
 /// @file
@@ -29,6 +34,27 @@ namespace pcpp
 	 */
 	typedef void (*OnPacketArrivesCallback)(RawPacket* pPacket, PcapLiveDevice* pDevice, void* userCookie);
 
+	/**
+	 * @typedef OnPacketsArriveBurstCallback
+	 * A callback that is called with a burst of packets captured by PcapLiveDevice in burst mode (see PcapLiveDevice#startCaptureBurstMode())
+	 * @param[in] packets An array of the captured raw packets. The packets and their data are owned by the device and are valid only until
+	 * the callback returns
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] pDevice A pointer to the PcapLiveDevice instance
+	 * @param[in] userCookie A pointer to the object put by the user when packet capturing stared
+	 */
+	typedef void (*OnPacketsArriveBurstCallback)(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* pDevice, void* userCookie);
+
+	/**
+	 * @typedef OnPacketArrivesMultiThreadCallback
+	 * A callback that is called when a packet is captured by one of the capture threads of PcapLiveDevice#startCaptureMultiThread()
+	 * @param[in] pPacket A pointer to the raw packet. The packet data is valid only until the callback returns
+	 * @param[in] threadId The ID of the capture thread the packet was captured on, between 0 and the number of threads minus 1
+	 * @param[in] pDevice A pointer to the PcapLiveDevice instance
+	 * @param[in] userCookie A pointer to the object put by the user when packet capturing stared
+	 */
+	typedef void (*OnPacketArrivesMultiThreadCallback)(RawPacket* pPacket, uint8_t threadId, PcapLiveDevice* pDevice, void* userCookie);
+
 	/**
 	 * @typedef OnPacketArrivesStopBlocking
 	 * A callback that is called when a packet is captured by PcapLiveDevice
@@ -52,6 +78,29 @@ namespace pcpp
 	typedef void* (*ThreadStart)(void*);
 
 	struct PcapThread;
+	struct PcapFanoutThread;
+
+/**
+ * The default maximum number of packets delivered at once by PcapLiveDevice in burst mode
+ */
+#define PCPP_LIVE_DEVICE_DEFAULT_BURST_SIZE 64
+
+/**
+ * The maximum number of capture threads of PcapLiveDevice#startCaptureMultiThread()
+ */
+#define PCPP_LIVE_DEVICE_MAX_CAPTURE_THREADS 64
+
+/**
+ * The number of packets the TX buffer of PcapLiveDevice holds, and the maximum number of packets PcapLiveDevice hands to the OS in one
+ * batch
+ */
+#define PCPP_LIVE_DEVICE_TX_BUFFER_SIZE 64
+
+/**
+ * The default timeout in microseconds after which PcapLiveDevice#flushTxBuffer() flushes the TX buffer when asked to flush only if the
+ * timeout expired
+ */
+#define PCPP_LIVE_DEVICE_DEFAULT_TX_BUFFER_FLUSH_TIMEOUT 100
 
 	/**
 	 * @class PcapLiveDevice
@@ -88,6 +137,11 @@ namespace pcpp
 		std::vector<pcap_addr_t> m_Addresses;
 		MacAddress m_MacAddress;
 		IPv4Address m_DefaultGateway;
+		// whether the MTU, MAC address and default gateway were fetched from the OS. They're fetched on first access unless the c'tor
+		// was asked to fetch them
+		bool m_DeviceMtuFetched;
+		bool m_MacAddressFetched;
+		bool m_DefaultGatewayFetched;
 		PcapThread* m_CaptureThread;
 		bool m_CaptureThreadStarted;
 		PcapThread* m_StatsThread;
@@ -99,12 +153,30 @@ namespace pcpp
 		void* m_cbOnStatsUpdateUserCookie;
 		OnPacketArrivesStopBlocking m_cbOnPacketArrivesBlockingMode;
 		void* m_cbOnPacketArrivesBlockingModeUserCookie;
+		OnPacketsArriveBurstCallback m_cbOnPacketsArriveBurst;
+		void* m_cbOnPacketsArriveBurstUserCookie;
+		// the packets of the current burst, and the buffer their data is copied to, one slot of the snapshot length per packet
+		RawPacket* m_BurstPackets;
+		uint8_t* m_BurstData;
+		uint32_t m_BurstCapacity;
+		uint32_t m_MaxBurstSize;
+		uint32_t m_BurstLen;
 		int m_IntervalToUpdateStats;
 		RawPacketVector* m_CapturedPackets;
+		RawPacketSlabVector* m_CapturedSlabPackets;
+		RawPacketPool* m_RawPacketPool;
 		bool m_CaptureCallbackMode;
 		LinkLayerType m_LinkType;
-
-		// c'tor is not public, there should be only one for every interface (created by PcapLiveDeviceList)
+		// whether the capture handle was put in non-blocking mode by pollPackets()
+		bool m_NonBlockingMode;
+		// the packets buffered by sending with useTxBuffer, their data is stored back to back in m_TxBufferData
+		std::vector<uint8_t> m_TxBufferData;
+		int m_TxBufferLengths[PCPP_LIVE_DEVICE_TX_BUFFER_SIZE];
+		int m_TxBufferCount;
+		uint64_t m_TxBufferLastFlushNs;
+
+		// c'tor is not public, there should be only one for every interface (created by PcapLiveDeviceList). Attributes which aren't
+		// calculated in the c'tor are fetched on first access
 		PcapLiveDevice(pcap_if_t* pInterface, bool calculateMTU, bool calculateMacAddress, bool calculateDefaultGateway);
 		// copy c'tor is not public
 		PcapLiveDevice( const PcapLiveDevice& other );
@@ -118,8 +190,29 @@ namespace pcpp
 		static void onPacketArrives(uint8_t *user, const struct pcap_pkthdr *pkthdr, const uint8_t *packet);
 		static void onPacketArrivesNoCallback(uint8_t *user, const struct pcap_pkthdr *pkthdr, const uint8_t *packet);
 		static void onPacketArrivesBlockingMode(uint8_t *user, const struct pcap_pkthdr *pkthdr, const uint8_t *packet);
+		static void onPacketArrivesBurstMode(uint8_t *user, const struct pcap_pkthdr *pkthdr, const uint8_t *packet);
+		static void onPacketArrivesMultiThread(uint8_t *user, const struct pcap_pkthdr *pkthdr, const uint8_t *packet);
+		static void* fanoutThreadMain(void *ptr);
+		void closeFanoutHandles();
+		void deliverBurst();
+		void allocateBurstBuffers(uint32_t maxBurstSize);
+		bool setNonBlockingMode(bool nonBlocking);
 		std::string printThreadId(PcapThread* id);
 		virtual ThreadStart getCaptureThreadStart();
+		typedef void (*PacketDataIterator)(const void* packetStorage, int index, const uint8_t*& packetData, int& packetDataLength);
+		int sendPacketsInner(const void* packetStorage, PacketDataIterator iter, int arrLength, bool useTxBuffer);
+		bool isPacketSendable(int packetDataLength);
+
+		/**
+		 * Send a batch of packets which were already checked to be sendable. On Linux the packets are sent with sendmmsg() on the socket of
+		 * the send handle, a single system call for up to #PCPP_LIVE_DEVICE_TX_BUFFER_SIZE packets, and on other platforms with
+		 * pcap_sendpacket() one by one. WinPcapLiveDevice overrides it to send the batch in a single pcap_sendqueue
+		 * @param[in] packetsData The data of the packets
+		 * @param[in] packetsLengths The lengths of the packets
+		 * @param[in] count The number of packets
+		 * @return The number of packets sent successfully
+		 */
+		virtual int sendPacketBatch(const uint8_t* const* packetsData, const int* packetsLengths, int count);
 	public:
 
 		/**
@@ -162,6 +255,20 @@ namespace pcpp
 		};
 
 
+		/**
+		 * How the kernel spreads the packets of the interface among the capture threads of startCaptureMultiThread()
+		 */
+		enum FanoutMode
+		{
+			/** By flow hash, so all packets of a flow reach the same thread (PACKET_FANOUT_HASH) */
+			FanoutHash,
+			/** Round robin (PACKET_FANOUT_LB) */
+			FanoutLoadBalance,
+			/** By the CPU the packet arrived on (PACKET_FANOUT_CPU) */
+			FanoutCpu
+		};
+
+
 		/**
 		 * @struct DeviceConfiguration
 		 * A struct that contains user configurable parameters for opening a device. All parameters have default values so
@@ -194,6 +301,14 @@ namespace pcpp
 		    	*/
 			PcapDirection direction;
 
+			/**
+			 * The timeout in microseconds after which flushTxBuffer() flushes the TX buffer when asked to flush only if the timeout
+			 * expired. Sending with the TX buffer flushes it the same way after buffering the packets, so this is also the longest
+			 * time a buffered packet waits as long as packets keep being sent. The default value is
+			 * #PCPP_LIVE_DEVICE_DEFAULT_TX_BUFFER_FLUSH_TIMEOUT
+			 */
+			uint32_t flushTxBufferTimeout;
+
 			/**
 			 * A c'tor for this struct
 			 * @param[in] mode The mode to open the device: promiscuous or non-promiscuous. Default value is promiscuous
@@ -203,13 +318,17 @@ namespace pcpp
 			 * (varies between different OS's)
 			 * @param[in] direction Direction for capturing packtes. Default value is INOUT which means capture both incoming
 			 * and outgoing packets (not all platforms support this)
+			 * @param[in] flushTxBufferTimeout The TX buffer flush timeout in microseconds. Default value is
+			 * #PCPP_LIVE_DEVICE_DEFAULT_TX_BUFFER_FLUSH_TIMEOUT
 			 */
-			DeviceConfiguration(DeviceMode mode = Promiscuous, int packetBufferTimeoutMs = 0, int packetBufferSize = 0, PcapDirection direction = PCPP_INOUT)
+			DeviceConfiguration(DeviceMode mode = Promiscuous, int packetBufferTimeoutMs = 0, int packetBufferSize = 0, PcapDirection direction = PCPP_INOUT,
+					uint32_t flushTxBufferTimeout = PCPP_LIVE_DEVICE_DEFAULT_TX_BUFFER_FLUSH_TIMEOUT)
 			{
 				this->mode = mode;
 				this->packetBufferTimeoutMs = packetBufferTimeoutMs;
 				this->packetBufferSize = packetBufferSize;
 				this->direction = PCPP_INOUT;
+				this->flushTxBufferTimeout = flushTxBufferTimeout;
 			}
 		};
 
@@ -242,7 +361,7 @@ namespace pcpp
 		/**
 		 * @return The device's maximum transmission unit (MTU) in bytes
 		 */
-		virtual inline uint16_t getMtu() { return m_DeviceMtu; }
+		virtual inline uint16_t getMtu() { if (!m_DeviceMtuFetched) setDeviceMtu(); return m_DeviceMtu; }
 
 		/**
 		 * @return The device's link layer type
@@ -256,7 +375,7 @@ namespace pcpp
 		/**
 		 * @return The MAC address for this interface
 		 */
-		virtual inline MacAddress getMacAddress() { return m_MacAddress; }
+		virtual inline MacAddress getMacAddress() { if (!m_MacAddressFetched) setDeviceMacAddress(); return m_MacAddress; }
 
 		/**
 		 * @return The IPv4 address for this interface. If multiple IPv4 addresses are defined for this interface, the first will be picked.
@@ -351,6 +470,106 @@ namespace pcpp
 		 */
 		virtual bool startCapture(RawPacketVector& capturedPacketsVector);
 
+		/**
+		 * Same as startCapture(RawPacketVector&), but captured packets are copied into a RawPacketSlabVector, which stores packets
+		 * contiguously and doesn't allocate memory for every captured packet. The pool set by setRawPacketPool() isn't used in this mode.
+		 * For short captures into memory the vector's slabs and packet blocks can be allocated before the capture starts
+		 * (RawPacketSlabVector#reserve() and RawPacketSlabVector#reserveData(), which clearing the vector keeps), so capturing never waits
+		 * for the allocator, and a memory limit can be set on the vector (RawPacketSlabVector#setMemoryLimit()): packets beyond it are
+		 * dropped and counted by the vector (RawPacketSlabVector#getNumOfDroppedPackets())
+		 * @param[in] capturedPacketsVector A reference to the slab vector to add captured packets to. It's cleared when the capture starts
+		 * @return True if capture started successfully, false if (relevant log error is printed in any case):
+		 * - Capture is already running
+		 * - Device is not opened
+		 * - Capture thread could not be created
+		 */
+		virtual bool startCapture(RawPacketSlabVector& capturedPacketsVector);
+
+		/**
+		 * Start capturing packets on this network interface (device) in burst mode. Packets are delivered in bursts, the same way DpdkDevice
+		 * and PfRingDevice deliver them, so the same processing code can serve all device types and handle a whole batch per call: all
+		 * packets read by one libpcap dispatch (up to maxBurstSize) are gathered into a preallocated RawPacket array, and the onPacketsArrive
+		 * callback is called once with the whole array. libpcap only guarantees packet data until its per-packet callback returns (with
+		 * TPACKET ring buffers the frame is handed back to the kernel right after it), so the data of each packet is copied to a preallocated
+		 * buffer; no memory is allocated and no RawPacket is constructed while capturing.
+		 * The capture is done on a new thread created by this method, and stops when stopCapture() is called. This method must be called
+		 * after the device is opened (i.e the open() method was called), otherwise an error will be returned.
+		 * @param[in] onPacketsArrive A callback that is called with each burst of captured packets
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object. This object will be transferred to the onPacketsArrive
+		 * callback each time it is called
+		 * @param[in] maxBurstSize The maximum number of packets delivered in one callback call. Default value is
+		 * #PCPP_LIVE_DEVICE_DEFAULT_BURST_SIZE
+		 * @param[in] intervalInSecondsToUpdateStats The interval in seconds to activate periodic stats collection. Default value is 0, which
+		 * means stats aren't collected
+		 * @param[in] onStatsUpdate A callback that will be called each time intervalInSecondsToUpdateStats expires and stats are collected.
+		 * Default value is NULL
+		 * @param[in] onStatsUpdateUserCookie A pointer to a user provided object. This object will be transferred to the onStatsUpdate callback
+		 * each time it is called. Default value is NULL
+		 * @return True if capture started successfully, false if (relevant log error is printed in any case):
+		 * - Capture is already running
+		 * - Device is not opened
+		 * - The callback is NULL or maxBurstSize is 0
+		 * - Capture thread could not be created
+		 * - Stats collection thread could not be created
+		 */
+		virtual bool startCaptureBurstMode(OnPacketsArriveBurstCallback onPacketsArrive, void* onPacketsArriveUserCookie,
+				uint32_t maxBurstSize = PCPP_LIVE_DEVICE_DEFAULT_BURST_SIZE, int intervalInSecondsToUpdateStats = 0,
+				OnStatsUpdateCallback onStatsUpdate = NULL, void* onStatsUpdateUserCookie = NULL);
+
+		/**
+		 * Start capturing packets on this network interface (device) with several threads, to spread the capture of a busy interface among
+		 * cores the way PfRingDevice and DpdkDevice do. A new libpcap handle is opened on the interface for each thread (with the
+		 * configuration the device was opened with and the filter currently set on it), and all handles are joined into one PACKET_FANOUT
+		 * group, so the kernel hands each packet to exactly one of them according to fanoutMode. Each handle is read by its own thread, which
+		 * is pinned to a core of coreMask if given.
+		 * While this capture runs packets are captured by the threads' handles only, stopCapture() stops the threads and closes the handles.
+		 * The statistics of each thread can be read with getThreadStatistics(), getStatistics() returns the sum of all threads.
+		 * This method is supported on Linux only, on other platforms it fails
+		 * @param[in] numOfThreads The number of capture threads, between 1 and #PCPP_LIVE_DEVICE_MAX_CAPTURE_THREADS
+		 * @param[in] onPacketArrives A callback that is called on the capturing thread each time a packet is captured
+		 * @param[in] onPacketArrivesUserCookie A pointer to a user provided object. This object will be transferred to the onPacketArrives
+		 * callback each time it is called, from all threads
+		 * @param[in] coreMask The cores to pin the threads to. Thread i is pinned to the i-th core of the mask (wrapping around if there are
+		 * more threads than cores). Default value is 0, which means the threads aren't pinned
+		 * @param[in] fanoutMode How packets are spread among the threads. Default value is FanoutHash
+		 * @return True if capture started successfully, false if (relevant log error is printed in any case):
+		 * - Capture is already running
+		 * - Device is not opened
+		 * - The callback is NULL or numOfThreads is out of range
+		 * - A handle could not be opened or could not join the fanout group
+		 * - A capture thread could not be created or pinned
+		 */
+		virtual bool startCaptureMultiThread(uint8_t numOfThreads, OnPacketArrivesMultiThreadCallback onPacketArrives, void* onPacketArrivesUserCookie,
+				CoreMask coreMask = 0, FanoutMode fanoutMode = FanoutHash);
+
+		/**
+		 * @return The number of threads of the last capture started with startCaptureMultiThread(), or 0 if there wasn't one since the
+		 * device was opened
+		 */
+		inline uint8_t getNumOfCaptureThreads() const { return m_NumOfFanoutThreads; }
+
+		/**
+		 * Get the statistics of a single capture thread of startCaptureMultiThread(). While the capture runs the statistics are read from the
+		 * thread's handle, after it's stopped the statistics the handle had when it was closed are returned
+		 * @param[in] threadId The ID of the thread, between 0 and getNumOfCaptureThreads()-1
+		 * @param[out] stats The object the statistics are written to
+		 * @return True if the statistics were read, false if threadId is out of range
+		 */
+		bool getThreadStatistics(uint8_t threadId, pcap_stat& stats);
+
+		/**
+		 * Set a pool to take the raw data buffers of packets captured by startCapture(RawPacketVector&) from, instead of allocating a new
+		 * buffer on the heap for each packet (see RawPacket#copyRawData()). Please notice the pool must outlive all captured packets.
+		 * This method should be called before starting the capture
+		 * @param[in] pool The pool to use, or NULL for allocating buffers on the heap (which is the default)
+		 */
+		inline void setRawPacketPool(RawPacketPool* pool) { m_RawPacketPool = pool; }
+
+		/**
+		 * @return The pool raw data buffers of captured packets are taken from, or NULL if buffers are allocated on the heap
+		 */
+		inline RawPacketPool* getRawPacketPool() const { return m_RawPacketPool; }
+
 		/**
 		 * Start capturing packets on this network interface (device) in blocking mode, meaning this method blocks and won't return until
 		 * the user frees the blocking (via onPacketArrives callback) or until a user defined timeout expires.
@@ -372,6 +591,29 @@ namespace pcpp
 		 */
 		virtual int startCaptureBlockingMode(OnPacketArrivesStopBlocking onPacketArrives, void* userCookie, int timeout);
 
+		/**
+		 * Get a file descriptor which becomes readable when packets arrive on the device, for waiting on many devices at once with select(),
+		 * poll() or epoll and reading them with pollPackets() on the same thread (see DeviceReactor)
+		 * @return The selectable file descriptor of the capture handle, or -1 if the device isn't open or the platform doesn't provide one
+		 * (Windows)
+		 */
+		virtual int getSelectableFd() const;
+
+		/**
+		 * Read the packets already waiting on the device without blocking, and pass them to a callback as one burst. Unlike the capture
+		 * methods no thread is created, so one thread can drive many devices by calling this method when their selectable file descriptors
+		 * (see getSelectableFd()) become readable. The first call puts the capture handle in non-blocking mode, and starting a capture puts
+		 * it back in blocking mode. Polling isn't allowed while a capture is running
+		 * @param[in] onPacketsArrive A callback that is called with the packets read, if any. The packets and their data are owned by the
+		 * device and are valid only until the callback returns
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object. This object will be transferred to the callback
+		 * @param[in] maxBurstSize The maximum number of packets to read. Default value is #PCPP_LIVE_DEVICE_DEFAULT_BURST_SIZE
+		 * @return The number of packets read, 0 if no packets were waiting, or -1 if the device isn't open, a capture is running, the
+		 * callback is NULL, maxBurstSize is 0 or reading failed. In the error cases an error is printed to log
+		 */
+		virtual int pollPackets(OnPacketsArriveBurstCallback onPacketsArrive, void* onPacketsArriveUserCookie,
+				uint32_t maxBurstSize = PCPP_LIVE_DEVICE_DEFAULT_BURST_SIZE);
+
 		/**
 		 * Stop a currently running packet capture. This method terminates gracefully both packet capture thread and periodic stats collection
 		 * thread (both if exist)
@@ -388,74 +630,124 @@ namespace pcpp
 		 * Send a RawPacket to the network
 		 * @param[in] rawPacket A reference to the raw packet to send. This method treats the raw packet as read-only, it doesn't change anything
 		 * in it
-		 * @return True if packet was sent successfully. False will be returned in the following cases (relevant log error is printed in any case):
+		 * @param[in] useTxBuffer A flag which indicates whether to use the TX buffer mechanism or not. To read more about it please refer to
+		 * flushTxBuffer(). Default value is false (don't use this mechanism)
+		 * @return True if packet was sent successfully, or buffered if useTxBuffer is set. False will be returned in the following cases
+		 * (relevant log error is printed in any case):
 		 * - Device is not opened
 		 * - Packet length is 0
 		 * - Packet length is larger than device MTU
 		 * - Packet could not be sent due to some error in libpcap/WinPcap
 		 */
-		bool sendPacket(RawPacket const& rawPacket);
+		bool sendPacket(RawPacket const& rawPacket, bool useTxBuffer = false);
 
 		/**
 		 * Send a buffer containing packet raw data (including all layers) to the network
 		 * @param[in] packetData The buffer containing the packet raw data
 		 * @param[in] packetDataLength The length of the buffer
-		 * @return True if packet was sent successfully. False will be returned in the following cases (relevant log error is printed in any case):
+		 * @param[in] useTxBuffer A flag which indicates whether to use the TX buffer mechanism or not. To read more about it please refer to
+		 * flushTxBuffer(). Default value is false (don't use this mechanism)
+		 * @return True if packet was sent successfully, or buffered if useTxBuffer is set. False will be returned in the following cases
+		 * (relevant log error is printed in any case):
 		 * - Device is not opened
 		 * - Packet length is 0
 		 * - Packet length is larger than device MTU
 		 * - Packet could not be sent due to some error in libpcap/WinPcap
 		 */
-		bool sendPacket(const uint8_t* packetData, int packetDataLength);
+		bool sendPacket(const uint8_t* packetData, int packetDataLength, bool useTxBuffer = false);
 
 		/**
 		 * Send a parsed Packet to the network
 		 * @param[in] packet A pointer to the packet to send. This method treats the packet as read-only, it doesn't change anything in it
-		 * @return True if packet was sent successfully. False will be returned in the following cases (relevant log error is printed in any case):
+		 * @param[in] useTxBuffer A flag which indicates whether to use the TX buffer mechanism or not. To read more about it please refer to
+		 * flushTxBuffer(). Default value is false (don't use this mechanism)
+		 * @return True if packet was sent successfully, or buffered if useTxBuffer is set. False will be returned in the following cases
+		 * (relevant log error is printed in any case):
 		 * - Device is not opened
 		 * - Packet length is 0
 		 * - Packet length is larger than device MTU
 		 * - Packet could not be sent due to some error in libpcap/WinPcap
 		 */
-		bool sendPacket(Packet* packet);
+		bool sendPacket(Packet* packet, bool useTxBuffer = false);
 
 		/**
-		 * Send an array of RawPacket objects to the network
+		 * Send an array of RawPacket objects to the network. The packets are handed to the OS in batches of up to
+		 * #PCPP_LIVE_DEVICE_TX_BUFFER_SIZE packets, each batch in a single system call where the platform allows it (sendmmsg() on Linux,
+		 * a pcap_sendqueue on WinPcap/Npcap), instead of a pcap_sendpacket() call per packet
 		 * @param[in] rawPacketsArr The array of RawPacket objects to send. This method treats all packets as read-only, it doesn't change anything
 		 * in them
 		 * @param[in] arrLength The length of the array
-		 * @return The number of packets sent successfully. Sending a packet can fail if:
+		 * @param[in] useTxBuffer A flag which indicates whether to use the TX buffer mechanism or not. To read more about it please refer to
+		 * flushTxBuffer(). Default value is false (don't use this mechanism)
+		 * @return The number of packets sent successfully, or buffered if useTxBuffer is set. Sending a packet can fail if:
 		 * - Device is not opened. In this case no packets will be sent, return value will be 0
 		 * - Packet length is 0
 		 * - Packet length is larger than device MTU
 		 * - Packet could not be sent due to some error in libpcap/WinPcap
 		 */
-		virtual int sendPackets(RawPacket* rawPacketsArr, int arrLength);
+		virtual int sendPackets(RawPacket* rawPacketsArr, int arrLength, bool useTxBuffer = false);
 
 		/**
-		 * Send an array of pointers to Packet objects to the network
+		 * Send an array of pointers to Packet objects to the network. The packets are sent in batches like in
+		 * sendPackets(RawPacket*, int, bool)
 		 * @param[in] packetsArr The array of pointers to Packet objects to send. This method treats all packets as read-only, it doesn't change
 		 * anything in them
 		 * @param[in] arrLength The length of the array
-		 * @return The number of packets sent successfully. Sending a packet can fail if:
+		 * @param[in] useTxBuffer A flag which indicates whether to use the TX buffer mechanism or not. To read more about it please refer to
+		 * flushTxBuffer(). Default value is false (don't use this mechanism)
+		 * @return The number of packets sent successfully, or buffered if useTxBuffer is set. Sending a packet can fail if:
 		 * - Device is not opened. In this case no packets will be sent, return value will be 0
 		 * - Packet length is 0
 		 * - Packet length is larger than device MTU
 		 * - Packet could not be sent due to some error in libpcap/WinPcap
 		 */
-		virtual int sendPackets(Packet** packetsArr, int arrLength);
+		virtual int sendPackets(Packet** packetsArr, int arrLength, bool useTxBuffer = false);
 
 		/**
-		 * Send a vector of pointers to RawPacket objects to the network
+		 * Send a vector of pointers to RawPacket objects to the network. The packets are sent in batches like in
+		 * sendPackets(RawPacket*, int, bool)
 		 * @param[in] rawPackets The array of pointers to RawPacket objects to send. This method treats all packets as read-only, it doesn't change
 		 * anything in them
-		 * @return The number of packets sent successfully. Sending a packet can fail if:
+		 * @param[in] useTxBuffer A flag which indicates whether to use the TX buffer mechanism or not. To read more about it please refer to
+		 * flushTxBuffer(). Default value is false (don't use this mechanism)
+		 * @return The number of packets sent successfully, or buffered if useTxBuffer is set. Sending a packet can fail if:
 		 * - Device is not opened. In this case no packets will be sent, return value will be 0
 		 * - Packet length is 0
 		 * - Packet length is larger than device MTU
 		 * - Packet could not be sent due to some error in libpcap/WinPcap
 		 */
-		virtual int sendPackets(const RawPacketVector& rawPackets);
+		virtual int sendPackets(const RawPacketVector& rawPackets, bool useTxBuffer = false);
+
+		/**
+		 * Send all raw packets of a RawPacketSlabVector to the network. The packets are sent in batches like in
+		 * sendPackets(RawPacket*, int, bool)
+		 * @param[in] rawPackets The packets to send. This method treats all packets as read-only, it doesn't change anything in them
+		 * @param[in] useTxBuffer A flag which indicates whether to use the TX buffer mechanism or not. To read more about it please refer to
+		 * flushTxBuffer(). Default value is false (don't use this mechanism)
+		 * @return The number of packets sent successfully, or buffered if useTxBuffer is set. Sending a packet can fail for the same reasons
+		 * as in sendPackets(const RawPacketVector&, bool)
+		 */
+		virtual int sendPackets(const RawPacketSlabVector& rawPackets, bool useTxBuffer = false);
+
+		/**
+		 * The send methods have an option to buffer packets instead of sending them right away (useTxBuffer). The packets are copied into a
+		 * TX buffer of #PCPP_LIVE_DEVICE_TX_BUFFER_SIZE packets, which is sent as one batch (see sendPackets(RawPacket*, int, bool)) when it
+		 * fills up, so applications which send packets one by one get the throughput of batched sending. A send with useTxBuffer also
+		 * flushes the buffer if the timeout set in DeviceConfiguration#flushTxBufferTimeout passed since the last flush, and a send without
+		 * the TX buffer flushes it first so the packets go out in order. The buffer is flushed when the device is closed.
+		 * When sending stops for a while buffered packets wait until the next flush, so the usage of this method can be in the main loop
+		 * where you can call it once every a couple of iterations
+		 * @param[in] flushOnlyIfTimeoutExpired When set to true, flush will happen only if the timeout defined in
+		 * DeviceConfiguration#flushTxBufferTimeout expired since the last flush. If set to false flush will happen immediately. Default
+		 * value is false
+		 * @return The number of packets sent after buffer was flushed
+		 */
+		int flushTxBuffer(bool flushOnlyIfTimeoutExpired = false);
+
+		/**
+		 * @return The number of packets waiting in the TX buffer
+		 */
+		inline int getNumOfBufferedTxPackets() const { return m_TxBufferCount; }
 
 
 		// implement abstract methods
@@ -481,8 +773,107 @@ namespace pcpp
 
 		virtual void getStatistics(pcap_stat& stats);
 
+		using IPcapDevice::setFilter;
+
+		/**
+		 * Set a filter for the device. The filter is also set on the handles of a running startCaptureMultiThread() capture, and on the handles
+		 * of the next ones
+		 * @param[in] filterAsString The filter to be set in Berkeley Packet Filter (BPF) syntax (http://biot.com/capstats/bpf.html)
+		 * @return True if filter set successfully, false otherwise
+		 */
+		virtual bool setFilter(std::string filterAsString);
+
+		/**
+		 * Sample the captured packets (see PacketSampler). Sampling is applied in the capture callbacks before a RawPacket is built, so
+		 * packets which aren't sampled are never delivered, stored in the captured packets vector or copied to a burst. It applies to all
+		 * capture modes; the rate cap uses the packet timestamps and, in startCaptureMultiThread(), is divided evenly between the capture
+		 * threads (see PacketSamplerConfiguration#divide()). Notice the sampling is done after the packets are copied from the kernel, so
+		 * it saves processing but not capture buffer space. Sampling can't be changed while the device is capturing
+		 * @param[in] config The sampling stages
+		 * @return True if sampling was set, false if the device is capturing
+		 */
+		bool setSampling(const PacketSamplerConfiguration& config);
+
+		/**
+		 * Stop sampling the captured packets
+		 * @return True if sampling was removed or wasn't set, false if the device is capturing
+		 */
+		bool clearSampling();
+
+		/**
+		 * @return True if the captured packets are sampled
+		 */
+		inline bool isSamplingSet() const { return m_Sampler.isEnabled(); }
+
+		/**
+		 * Get the sampling counters of the device: the ones of single-thread captures since sampling was set, and the ones of the capture
+		 * threads of the last startCaptureMultiThread() capture
+		 * @param[out] numOfPackets The number of packets the samplers decided on
+		 * @param[out] numOfSampledPackets The number of packets sampled
+		 */
+		void getSamplingStats(uint64_t& numOfPackets, uint64_t& numOfSampledPackets) const;
+
+		/**
+		 * Tune the kernel buffer size and the packet buffer timeout (and on WinPcap the minimum amount of data to copy) automatically while
+		 * capturing, within the bounds of the configuration (see PcapAutoTuner). The capture thread of startCapture() and
+		 * startCaptureBurstMode() counts the packets of each dispatch and evaluates the drop counters every
+		 * PcapAutoTunerConfiguration#evaluationIntervalMs. libpcap sets the buffer size and the timeout only when a handle is activated, so
+		 * to change them the capture thread opens a new handle with the new values and the current filter, and replaces the current
+		 * handle between two dispatches. The packets left in the buffer of the replaced handle are lost, which is why changes are rate
+		 * limited by PcapAutoTunerConfiguration#cooldownIntervals. getStatistics() keeps counting across replaced handles.
+		 * Auto-tuning doesn't apply to startCaptureMultiThread(), startCaptureBlockingMode() and pollPackets(), and can't be changed while
+		 * the device is capturing
+		 * @param[in] config The bounds and the pace of the tuning
+		 * @return True if auto-tuning was set, false if the device is capturing or the maximum buffer size in the configuration is 0
+		 */
+		bool setAutoTuning(const PcapAutoTunerConfiguration& config);
+
+		/**
+		 * Stop tuning the device automatically. The values chosen so far are kept until the device is reopened
+		 * @return True if auto-tuning was removed or wasn't set, false if the device is capturing
+		 */
+		bool clearAutoTuning();
+
+		/**
+		 * @return True if the device is tuned automatically
+		 */
+		inline bool isAutoTuningSet() const { return m_AutoTuner.isEnabled(); }
+
+		/**
+		 * Get the decisions of the auto-tuning since it was set, and the values currently used
+		 * @param[out] stats The statistics
+		 */
+		inline void getAutoTuningStats(PcapAutoTunerStats& stats) const { m_AutoTuner.getStats(stats); }
+
 	protected:
+		DeviceConfiguration m_DeviceConfig;
+		std::string m_FilterAsString;
+		// the capture threads of startCaptureMultiThread() and their handles
+		PcapFanoutThread* m_FanoutThreads;
+		uint8_t m_NumOfFanoutThreads;
+		bool m_FanoutThreadsStarted;
+		OnPacketArrivesMultiThreadCallback m_cbOnPacketArrivesMultiThread;
+		void* m_cbOnPacketArrivesMultiThreadUserCookie;
+		// the sampler of the capture modes which use a single handle, and the ones of the capture threads of startCaptureMultiThread()
+		PacketSampler m_Sampler;
+		std::vector<PacketSampler> m_FanoutSamplers;
+		PcapAutoTuner m_AutoTuner;
+		// the receive handle replaced by the last auto-tuning change, which is closed when the next one is replaced, and the statistics
+		// of all replaced handles
+		pcap_t* m_RetiredPcapDescriptor;
+		pcap_stat m_RetiredHandlesStats;
+
 		pcap_t* doOpen(const DeviceConfiguration& config);
+		void autoTune(int numOfPackets);
+
+		/**
+		 * Apply the values the auto-tuner changed. It's called on the capture thread between two dispatches. PcapLiveDevice replaces the
+		 * receive handle when the buffer size or the timeout changed, WinPcapLiveDevice changes the buffer size and the minimum amount of
+		 * data to copy of the current handle
+		 * @param[in] changes A bitmask of PcapAutoTuner#Change values
+		 * @return True if the values were applied, false otherwise
+		 */
+		virtual bool applyAutoTuning(int changes);
 	};
 
 } // namespace pcpp
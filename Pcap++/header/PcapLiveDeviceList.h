@@ -20,7 +20,9 @@ namespace pcpp
 	 * @class PcapLiveDeviceList
 	 * A singleton class that creates, stores and provides access to all PcapLiveDevice (on Linux) or WinPcapLiveDevice (on Windows) instances. All live
 	 * devices are initialized on startup and wrap the network interfaces installed on the machine. This class enables access to them through
-	 * their IP addresses or get a vector of all of them so the user can search them in some other way
+	 * their IP addresses or get a vector of all of them so the user can search them in some other way.
+	 * To keep startup fast, the attributes which require querying the OS (MTU, MAC address and default gateway of each device) and the DNS
+	 * server list are fetched on first access rather than when the devices are enumerated
 	 */
 	class PcapLiveDeviceList
 	{
@@ -28,6 +30,7 @@ namespace pcpp
 		std::vector<PcapLiveDevice*> m_LiveDeviceList;
 
 		std::vector<IPv4Address> m_DnsServers;
+		bool m_DnsServersFetched;
 
 		// private c'tor
 		PcapLiveDeviceList();
@@ -93,7 +96,7 @@ namespace pcpp
 
 		/**
 		 * @return A list of all DNS servers defined for this machine. If this list is empty it means no DNS servers were defined or they
-		 * couldn't be extracted from some reason
+		 * couldn't be extracted from some reason. The list is fetched on the first call (on Linux this runs nmcli)
 		 */
 		std::vector<IPv4Address>& getDnsServers();
 
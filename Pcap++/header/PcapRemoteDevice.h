@@ -137,6 +137,14 @@ namespace pcpp
 		 */
 		virtual bool open();
 
+		/**
+		 * Same as PcapLiveDevice#pollPackets(), but since remote capture handles can't be put in non-blocking mode the packets are read one
+		 * by one until a read finds no packet, so the method may wait up to the read timeout of the device (250ms) when no packets arrive.
+		 * Remote devices have no selectable file descriptor, so they can't be added to a DeviceReactor
+		 */
+		virtual int pollPackets(OnPacketsArriveBurstCallback onPacketsArrive, void* onPacketsArriveUserCookie,
+				uint32_t maxBurstSize = PCPP_LIVE_DEVICE_DEFAULT_BURST_SIZE);
+
 		void getStatistics(pcap_stat& stats);
 	};
 
@@ -5,6 +5,8 @@
 #include "MacAddress.h"
 #include "SystemUtils.h"
 #include "Packet.h"
+#include "NativeFilter.h"
+#include "PacketSampler.h"
 #include <pthread.h>
 
 /// @file
@@ -20,6 +22,27 @@ typedef struct __pfring pfring;
 namespace pcpp
 {
 
+/**
+ * The default maximum number of packets a PfRingDevice capture thread receives at once and delivers in one callback call
+ */
+#define PCPP_PF_RING_DEFAULT_BURST_SIZE 32
+
+/**
+ * The default number of ZC buffers PfRingDevice#openZeroCopy() allocates for each queue it opens. They must cover the NIC ring of the queue
+ */
+#define PCPP_PF_RING_ZC_DEFAULT_BUFFERS_PER_QUEUE 32768
+
+/**
+ * The default length of each ZC buffer allocated by PfRingDevice#openZeroCopy(), which is the largest packet received or sent
+ */
+#define PCPP_PF_RING_ZC_DEFAULT_BUFFER_LEN 1536
+
+/**
+ * The default timeout in microseconds after which PfRingDevice#flushTxQueue() flushes the TX queue of a channel when asked to flush only
+ * if the timeout expired
+ */
+#define PCPP_PF_RING_DEFAULT_TX_FLUSH_TIMEOUT 100
+
 	class PfRingDevice;
 
 	typedef void (*OnPfRingPacketsArriveCallback)(RawPacket* packets, uint32_t numOfPackets, uint8_t threadId, PfRingDevice* device, void* userCookie);
@@ -27,7 +50,12 @@ namespace pcpp
 
 	/**
 	 * @class PfRingDevice
-	 * A class representing a PF_RING port
+	 * A class representing a PF_RING port.<BR>
+	 * The device can be opened in standard mode with open() or openMultiRxChannels(), or in ZC (zero-copy) mode with openZeroCopy(),
+	 * which requires a PF_RING ZC license and a ZC driver. In ZC mode the NIC writes the packets to buffers of a ZC cluster mapped to
+	 * this process; capture threads receive them in bursts and deliver them to the callback without copying, and sent packets are copied
+	 * once to ZC buffers and handed to the NIC in bursts. In standard mode, capture threads started by startCaptureMultiThread() also
+	 * deliver the packets in bursts, while startCaptureSingleThread() delivers them one by one without copying
 	 */
 	class PfRingDevice : public IDevice, public IFilterableDevice
 	{
@@ -38,13 +66,31 @@ namespace pcpp
 		{
 			pthread_t RxThread;
 			pfring* Channel;
+			int ZcQueueIndex;
 			bool IsInUse;
 			bool IsAffinitySet;
+			// configured by the capture thread when it starts, so it's only touched by that thread while capturing
+			PacketSampler Sampler;
 
 			CoreConfiguration();
 			void clear();
 		};
 
+		struct TxChannelState
+		{
+			uint64_t LastFlushNs;
+			uint32_t NumOfPendingPackets;
+			// each channel may be used by a different sender thread, so the states are kept in different cache lines
+			char Padding[64 - sizeof(uint64_t) - sizeof(uint32_t)];
+		};
+
+		struct ZcQueue
+		{
+			// pfring_zc_queue* and pfring_zc_pkt_buff** (which are defined in pfring_zc.h)
+			void* Queue;
+			void** PacketHandles;
+		};
+
 		pfring** m_PfRingDescriptors;
 		uint8_t m_NumOfOpenedRxChannels;
 		char m_DeviceName[30];
@@ -58,11 +104,31 @@ namespace pcpp
 		bool m_ReentrantMode;
 		bool m_HwClockEnabled;
 		bool m_IsFilterCurrentlySet;
+		bool m_IsFilterOffloaded;
+		uint16_t m_NumOfFilteringRules;
+		NativeFilterProgram m_NativeFilter;
+		PacketSamplerConfiguration m_SamplingConfig;
+		bool m_IsSamplingSet;
+		uint32_t m_BurstSize;
+		uint32_t m_RxPrefetchDistance;
+		// pfring_zc_cluster* (defined in pfring_zc.h), NULL if the device isn't opened in ZC mode
+		void* m_ZcCluster;
+		std::vector<ZcQueue> m_ZcRxQueues;
+		ZcQueue m_ZcTxQueue;
+		uint32_t m_ZcBufferLen;
+		uint32_t m_NumOfPendingZcTxPackets;
+		TxChannelState* m_TxChannelStates;
+		uint32_t m_TxFlushTimeout;
 
 		PfRingDevice(const char* deviceName);
 
 		bool initCoreConfigurationByCoreMask(CoreMask coreMask);
 		static void* captureThreadMain(void *ptr);
+		void captureBursts(pfring* ring, int coreId);
+		void captureZeroCopy(int coreId);
+
+		std::string getInterfaceName();
+		void closeZeroCopy();
 
 		int openSingleRxChannel(const char* deviceName, pfring** ring);
 
@@ -75,6 +141,16 @@ namespace pcpp
 		void setPfRingDeviceAttributes();
 
 		bool sendData(const uint8_t* packetData, int packetDataLength, bool flushTxQueues);
+		bool sendDataOnRing(pfring* ring, const uint8_t* packetData, int packetDataLength, bool flushTxQueues);
+
+		typedef void (*PacketDataIterator)(const void* packetStorage, int index, const uint8_t*& packetData, int& packetDataLength);
+		int sendPacketsOnChannel(const void* packetStorage, PacketDataIterator iter, int arrLength, uint8_t channelId, bool flushTxQueue);
+		bool sendDataZeroCopy(const uint8_t* packetData, int packetDataLength, bool flushTxQueues);
+		uint32_t flushZeroCopyTx();
+		uint32_t flushTxQueues();
+
+		bool setFilteringRules(const std::vector<FilterFlowRule>& rules);
+		bool removeFilteringRules();
 	public:
 
 		/**
@@ -104,6 +180,33 @@ namespace pcpp
 			uint64_t drop;
 		};
 
+		/**
+		 * @struct PfRingZcConfiguration
+		 * A structure for configuring the ZC (zero-copy) mode of PfRingDevice, see openZeroCopy()
+		 */
+		struct PfRingZcConfiguration
+		{
+			/** The ID of the ZC cluster to create. It must be unique among the ZC clusters running on the machine */
+			int clusterId;
+			/** The number of RX queues to open, which are the NIC RX queues 0 to numOfRxQueues-1. If it's 1 the interface is opened as a
+			 * single queue (for example "zc:eth1"), otherwise each queue is opened by its ID (for example "zc:eth1@0", "zc:eth1@1", ...) */
+			uint8_t numOfRxQueues;
+			/** Whether to open a TX queue for sending packets. Default value is true */
+			bool openTx;
+			/** The maximum number of packets a capture thread receives at once and delivers in one callback call, which is also the
+			 * number of packets sent to the NIC at once. Default value is #PCPP_PF_RING_DEFAULT_BURST_SIZE */
+			uint32_t burstSize;
+			/** The number of buffers allocated for each opened queue. Default value is #PCPP_PF_RING_ZC_DEFAULT_BUFFERS_PER_QUEUE */
+			uint32_t numOfBuffersPerQueue;
+			/** The length of each buffer, which is the largest packet received or sent. Default value is #PCPP_PF_RING_ZC_DEFAULT_BUFFER_LEN */
+			uint32_t bufferLen;
+
+			/**
+			 * A c'tor for this struct which sets the default values and opens a single RX queue and a TX queue in cluster 1
+			 */
+			PfRingZcConfiguration();
+		};
+
 		/**
 		 * A destructor for PfRingDevice class
 		 */
@@ -142,7 +245,7 @@ namespace pcpp
 
 
 		/**
-		 * Start single-threaded capturing with callback. Works with open() or openSingleRxChannel().
+		 * Start single-threaded capturing with callback. Works with open(), openSingleRxChannel() or openZeroCopy() with a single RX queue.
 		 * @param[in] onPacketsArrive A callback to call whenever a packet arrives
 		 * @param[in] onPacketsArriveUserCookie A cookie that will be delivered to onPacketsArrive callback on every packet
 		 * @return True if this action succeeds, false otherwise
@@ -150,7 +253,7 @@ namespace pcpp
 		bool startCaptureSingleThread(OnPfRingPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie);
 
 		/**
-		 * Start multi-threaded (multi-core) capturing with callback. Works with openMultiRxChannels().
+		 * Start multi-threaded (multi-core) capturing with callback. Works with openMultiRxChannels() or openZeroCopy().
 		 * This method will return an error if the number of opened channels is different than the number of threads/cores
 		 * requested
 		 * @param[in] onPacketsArrive A callback to call whenever a packet arrives
@@ -160,6 +263,21 @@ namespace pcpp
 		 */
 		bool startCaptureMultiThread(OnPfRingPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, CoreMask coreMask);
 
+		/**
+		 * Same as startCaptureMultiThread(OnPfRingPacketsArriveCallback, void*, CoreMask), but a core is selected automatically for each
+		 * opened RX channel. Cores local to the NUMA node of the NIC (see getNumaNode()) are preferred, and physical cores are preferred
+		 * over SMT (hyperthread) siblings (see selectNumaLocalCores())
+		 * @param[in] onPacketsArrive A callback to call whenever a packet arrives
+		 * @param[in] onPacketsArriveUserCookie A cookie that will be delivered to onPacketsArrive callback on every packet
+		 * @return True if this action succeeds, false otherwise
+		 */
+		bool startCaptureMultiThread(OnPfRingPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie);
+
+		/**
+		 * @return The NUMA node the NIC behind this interface is attached to, or -1 if it's not known
+		 */
+		int getNumaNode();
+
 		/**
 		 * Stops capturing packets (works will all type of startCapture*)
 		 */
@@ -198,6 +316,27 @@ namespace pcpp
 		 */
 		bool openMultiRxChannels(uint8_t numOfRxChannelsToOpen, ChannelDistribution dist);
 
+		/**
+		 * Opens the device in ZC (zero-copy) mode: creates a ZC cluster on the NUMA node of the NIC and opens the requested RX queues and
+		 * optionally a TX queue through it. Each RX queue counts as an opened RX channel, so capturing works the same way as in standard
+		 * mode. Please notice:
+		 * - The packets delivered to the capture callback point to ZC buffers which are returned to the NIC when the next burst is received,
+		 *   so they're valid only until the callback returns
+		 * - Filters are applied natively in the capture threads (see setFilter(GeneralFilter&)), BPF filters and PF_RING filtering rules
+		 *   aren't supported in this mode
+		 * - Sent packets are queued in ZC buffers and handed to the NIC when #PfRingZcConfiguration#burstSize packets are queued or
+		 *   when the TX queue is flushed (after sendPacket() and at the end of sendPackets()). The TX queue may be used by one thread at a time
+		 * - The device name may be given with or without the "zc:" prefix
+		 * @param[in] config The ZC configuration
+		 * @return True if this action succeeds, false otherwise
+		 */
+		bool openZeroCopy(const PfRingZcConfiguration& config);
+
+		/**
+		 * @return True if the device is opened in ZC (zero-copy) mode (see openZeroCopy())
+		 */
+		inline bool isZeroCopy() const { return m_ZcCluster != NULL; }
+
 		/**
 		 * Gets the number of RX channels currently open. RX channels aren't necessary interface's RX queues
 		 * because in some cases the user asks to open several channels on the same queue. For example: if the user uses
@@ -239,12 +378,24 @@ namespace pcpp
 		 */
 		void getStatistics(PfRingStats& stats);
 
+		/**
+		 * Report the getStatistics() counters to a MetricsRegistry snapshot: pcpp_device_rx_packets_total and
+		 * pcpp_device_rx_dropped_packets_total
+		 * @param[in] writer The writer to report the values to
+		 */
+		void collectMetrics(MetricsWriter& writer);
+
 		/**
 		 * Return true if filter is currently set
 		 * @return True if filter is currently set, false otherwise
 		 */
 		bool isFilterCurrentlySet();
 
+		/**
+		 * @return True if the current filter is applied by PF_RING filtering rules, false if it's applied as a BPF filter or no filter is set
+		 */
+		inline bool isFilterOffloaded() const { return m_IsFilterOffloaded; }
+
 		/**
 		 * Send a raw packet. This packet must be fully specified (the MAC address up)
 		 * and it will be transmitted as-is without any further manipulation.
@@ -312,6 +463,55 @@ namespace pcpp
 		 */
 		int sendPackets(const RawPacketVector& rawPackets);
 
+		/**
+		 * Send raw packets through the ring of one of the opened RX channels, so threads sending through different channels don't share
+		 * any state and need no locking. The packets are queued without flushing the TX queue, and the MTU is read once for the whole
+		 * batch. If flushTxQueue is set the TX queue is flushed at the end of the batch, otherwise the queued packets are sent when
+		 * flushTxQueue(uint8_t, bool) is called, or at the end of a later batch on the same channel once the flush timeout (see
+		 * setTxFlushTimeout()) expired. Sending stops at the first packet which can't be sent, for example because it's longer than the
+		 * MTU or the write buffer stays full. This method isn't supported in ZC mode, please use sendPackets(const RawPacket*, int) instead
+		 * @param[in] rawPacketsArr The RawPacket array
+		 * @param[in] arrLength RawPacket array length
+		 * @param[in] channelId The index of the opened RX channel to send through, between 0 and getNumOfOpenedRxChannels()-1
+		 * @param[in] flushTxQueue Whether to flush the TX queue at the end of the batch. Default value is true
+		 * @return Number of packets that were sent (or queued if flushTxQueue isn't set)
+		 */
+		int sendPackets(const RawPacket* rawPacketsArr, int arrLength, uint8_t channelId, bool flushTxQueue = true);
+
+		/**
+		 * Send packets through the ring of one of the opened RX channels, the same way as
+		 * sendPackets(const RawPacket*, int, uint8_t, bool) does
+		 * @param[in] packetsArr An array of pointers to Packet objects
+		 * @param[in] arrLength Packet pointers array length
+		 * @param[in] channelId The index of the opened RX channel to send through, between 0 and getNumOfOpenedRxChannels()-1
+		 * @param[in] flushTxQueue Whether to flush the TX queue at the end of the batch. Default value is true
+		 * @return Number of packets that were sent (or queued if flushTxQueue isn't set)
+		 */
+		int sendPackets(const Packet** packetsArr, int arrLength, uint8_t channelId, bool flushTxQueue = true);
+
+		/**
+		 * Flush the TX queue of one of the opened RX channels, sending the packets queued by
+		 * sendPackets(const RawPacket*, int, uint8_t, bool) with flushTxQueue unset. Should be called by the thread sending through this
+		 * channel, for example once every few iterations of its main loop
+		 * @param[in] channelId The index of the opened RX channel
+		 * @param[in] flushOnlyIfTimeoutExpired When set to true, the TX queue is flushed only if the flush timeout (see
+		 * setTxFlushTimeout()) expired since the last flush. Default value is false
+		 * @return True if the TX queue was flushed or there was nothing to flush, false if the channel isn't opened or the timeout didn't
+		 * expire yet
+		 */
+		bool flushTxQueue(uint8_t channelId, bool flushOnlyIfTimeoutExpired = false);
+
+		/**
+		 * Set the timeout after which packets queued by sendPackets(const RawPacket*, int, uint8_t, bool) are flushed
+		 * @param[in] timeoutUsec The timeout in microseconds. Default value is #PCPP_PF_RING_DEFAULT_TX_FLUSH_TIMEOUT
+		 */
+		inline void setTxFlushTimeout(uint32_t timeoutUsec) { m_TxFlushTimeout = timeoutUsec; }
+
+		/**
+		 * @return The timeout in microseconds after which queued packets are flushed (see setTxFlushTimeout())
+		 */
+		inline uint32_t getTxFlushTimeout() const { return m_TxFlushTimeout; }
+
 
 		// implement abstract methods
 
@@ -328,19 +528,78 @@ namespace pcpp
 		 */
 		void close();
 
-		using IFilterableDevice::setFilter;
+		/**
+		 * Sets a filter to the device, replacing the current one. When the filter can be translated into flow rules (see
+		 * GeneralFilter#toFlowRules()) and PF_RING supports all of them, it's set as PF_RING filtering rules on all open RX channels with a
+		 * default policy of dropping packets which don't match any rule. PF_RING evaluates these rules in the kernel module against the
+		 * headers it already parses, so it's cheaper than running a BPF program on each packet. Otherwise, if the device isn't capturing
+		 * and the filter can be evaluated natively (see GeneralFilter#toNativeFilter()), it's matched by a NativeFilterProgram in the
+		 * capture threads, which doesn't require PF_RING to be built with BPF support. Otherwise the filter is set as a BPF filter, the same
+		 * way as setFilter(std::string) does. Notice PF_RING filtering rules don't match an EtherType by itself, so for example
+		 * ProtoFilter(IPv4) is matched natively or set as a BPF filter
+		 * @param[in] filter The filter to set
+		 * @return True if the filter was set, false otherwise
+		 */
+		bool setFilter(GeneralFilter& filter);
 
 		/**
-		 * Sets a BPF filter to the device
+		 * Sets a BPF filter to the device. Not supported if the device is opened in ZC mode
 		 * @param[in] filterAsString The BPF filter in string format
 		 */
 		bool setFilter(std::string filterAsString);
 
 		/**
-		 * Remove a filter if currently set
+		 * Remove a filter if currently set. A filter matched natively (see setFilter(GeneralFilter&)) can't be removed while the device is
+		 * capturing
 		 * @return True if filter was removed successfully or if no filter was set, false otherwise
 		 */
 		bool clearFilter();
+
+		/**
+		 * Sample the packets received by the capture threads (see PacketSampler). Sampling is applied after the filter, right after each
+		 * packet is received and before a RawPacket is built for it, so packets which aren't sampled are never delivered to the callback.
+		 * Each capture thread has a sampler of its own, so the rate cap is divided evenly between the open RX channels (see
+		 * PacketSamplerConfiguration#divide()). In ZC mode flow sampling uses the hash the NIC calculated for the packet when there is one
+		 * and the rate cap uses the time each burst is received, otherwise the packet headers are hashed and the rate cap uses the packet
+		 * timestamps. Sampling can't be changed while the device is capturing, and it's applied from the next capture
+		 * @param[in] config The sampling stages
+		 * @return True if sampling was set, false if the device is capturing
+		 */
+		bool setSampling(const PacketSamplerConfiguration& config);
+
+		/**
+		 * Stop sampling packets, so all packets which pass the filter are delivered
+		 * @return True if sampling was removed or wasn't set, false if the device is capturing
+		 */
+		bool clearSampling();
+
+		/**
+		 * @return True if packets received by the capture threads are sampled
+		 */
+		inline bool isSamplingSet() const { return m_IsSamplingSet; }
+
+		/**
+		 * Get the sampling counters of the current (or last) capture, summed over the capture threads
+		 * @param[out] numOfPackets The number of packets the samplers decided on
+		 * @param[out] numOfSampledPackets The number of packets sampled
+		 */
+		void getSamplingStats(uint64_t& numOfPackets, uint64_t& numOfSampledPackets) const;
+
+		/**
+		 * Prefetch the packets of each burst received in ZC mode a number of packets ahead: while the packets of the burst are filtered and
+		 * bound to raw packets, the buffer handle of the packet which is twice the distance ahead and the first cache line of the data of
+		 * the packet which is the distance ahead are prefetched, so the packet headers are in cache when they're filtered and parsed. Out of
+		 * ZC mode packets are copied to the burst as they're received so their data is already in cache and the setting has no effect.
+		 * The setting can't be changed while the device is capturing, and it applies from the next capture
+		 * @param[in] prefetchDistance The number of packets to prefetch ahead, or 0 to disable prefetching. Default value is 0
+		 * @return True if the setting was applied, false if the device is capturing
+		 */
+		bool setRxPrefetchDistance(uint32_t prefetchDistance);
+
+		/**
+		 * @return The number of packets received packets are prefetched ahead in ZC mode, see setRxPrefetchDistance()
+		 */
+		inline uint32_t getRxPrefetchDistance() const { return m_RxPrefetchDistance; }
 	};
 
 } // namespace pcpp
@@ -0,0 +1,134 @@
+#ifndef PCAPPP_PREFETCHING_FILE_READER
+#define PCAPPP_PREFETCHING_FILE_READER
+
+#include "PcapFileDevice.h"
+#include "RawPacketSlabVector.h"
+#include "SPSCQueue.h"
+#include <pthread.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The default number of packets PrefetchingFileReader reads into each batch
+ */
+#define PCPP_PREFETCHING_READER_DEFAULT_BATCH_SIZE 1024
+
+/**
+ * The default number of batches PrefetchingFileReader keeps
+ */
+#define PCPP_PREFETCHING_READER_DEFAULT_NUM_OF_BATCHES 4
+
+	/**
+	 * @class PrefetchingFileReader
+	 * Reads packets from a file reader device (any IFileReaderDevice) ahead of their processing, in a background thread, so reading the file
+	 * overlaps with processing its packets instead of blocking the processing thread on every read.
+	 * The background thread reads batches of packets into a bounded single-producer single-consumer queue (pcpp#SPSCQueue) of batches, and
+	 * the processing thread takes the packets of ready batches with getNextBatch() or getNextPacket(). Each batch is a RawPacketSlabVector
+	 * which is allocated once and reused after the processing thread is done with it, so after the first batches were read no memory is
+	 * allocated. When all batches are full the background thread waits for the processing thread, so at most a fixed number of packets is
+	 * held in memory.
+	 * The reader device has to be open, and its filter (if any) set, before start() is called. While prefetching the reader device belongs to
+	 * the background thread and mustn't be used in any other way. The packets returned are valid until the batch they're in is released,
+	 * which is when the next batch is taken or prefetching is stopped; a packet which has to be kept longer must be copied
+	 */
+	class PrefetchingFileReader
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. Prefetching doesn't begin until start() is called
+		 * @param[in] reader The file reader device to read from. It must outlive this instance
+		 * @param[in] batchSize The number of packets in each batch. Default value is #PCPP_PREFETCHING_READER_DEFAULT_BATCH_SIZE
+		 * @param[in] numOfBatches The number of batches, including the batch being processed. It's rounded up to a power of 2. Default value
+		 * is #PCPP_PREFETCHING_READER_DEFAULT_NUM_OF_BATCHES
+		 */
+		PrefetchingFileReader(IFileReaderDevice& reader, size_t batchSize = PCPP_PREFETCHING_READER_DEFAULT_BATCH_SIZE,
+				size_t numOfBatches = PCPP_PREFETCHING_READER_DEFAULT_NUM_OF_BATCHES);
+
+		/**
+		 * A d'tor for this class, stops prefetching if it's running
+		 */
+		~PrefetchingFileReader();
+
+		/**
+		 * Start reading packets in the background thread, from the current position of the reader device
+		 * @return True if the thread was started, false if prefetching is already running, the reader device isn't open or the thread couldn't
+		 * be created (an error is printed to log)
+		 */
+		bool start();
+
+		/**
+		 * Stop reading packets and wait for the background thread to exit. Packets which were read and not taken yet are dropped, and the
+		 * reader device is left at the position the background thread reached. Does nothing if prefetching isn't running
+		 */
+		void stop();
+
+		/**
+		 * @return True if prefetching was started and not stopped yet, even if the background thread already reached the end of the file
+		 */
+		inline bool isRunning() const { return m_Running; }
+
+		/**
+		 * Take the next batch of packets, waiting for the background thread if no batch is ready yet. The previous batch is released, so its
+		 * packets are invalid from now on
+		 * @return The batch, which holds at least one packet, or NULL if prefetching isn't running or all packets of the file were taken
+		 */
+		RawPacketSlabVector* getNextBatch();
+
+		/**
+		 * Take the next packet, waiting for the background thread if no batch is ready yet. Taking the first packet of a batch releases the
+		 * previous batch (see getNextBatch()), so a packet is valid until the packet at the same position of the next batch is taken
+		 * @return The packet, or NULL if prefetching isn't running or all packets of the file were taken
+		 */
+		RawPacket* getNextPacket();
+
+		/**
+		 * @return The number of packets taken by getNextBatch() and getNextPacket() since prefetching was started
+		 */
+		inline uint64_t getNumOfPacketsTaken() const { return m_NumOfPacketsTaken; }
+
+	private:
+
+		struct Batch
+		{
+			RawPacketSlabVector packets;
+			// set on the last batch the background thread reads, which may be empty
+			bool endOfFile;
+		};
+
+		enum
+		{
+			// the number of times an idle thread polls the queue before it starts sleeping between polls
+			IdleSpinRounds = 64
+		};
+
+		IFileReaderDevice& m_Reader;
+		size_t m_BatchSize;
+		SPSCQueue<Batch> m_Queue;
+		bool m_Running;
+		volatile size_t m_StopRequested;
+		pthread_t m_PrefetchThread;
+		// the batch being taken, which stays in the queue until the next one is taken
+		Batch* m_CurBatch;
+		size_t m_CurPacket;
+		bool m_EndOfFile;
+		uint64_t m_NumOfPacketsTaken;
+
+		static void* prefetchThreadMain(void* readerPtr);
+		void releaseCurBatch();
+
+		// disable copy c'tor and assignment operator
+		PrefetchingFileReader(const PrefetchingFileReader& other);
+		PrefetchingFileReader& operator=(const PrefetchingFileReader& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_PREFETCHING_FILE_READER */
@@ -5,6 +5,7 @@
 
 #include "IpAddress.h"
 #include "Device.h"
+#include "RawPacketPool.h"
 
 /**
 * \namespace pcpp
@@ -12,6 +13,24 @@
 */
 namespace pcpp
 {
+	/**
+	 * The maximum number of packets RawSocketDevice receives or sends with a single system call
+	 */
+#define PCPP_RAW_SOCKET_MAX_BATCH_SIZE 64
+
+	class RawSocketDevice;
+
+	/**
+	 * @typedef OnRawSocketPacketsArriveCallback
+	 * A callback that is called with a burst of packets received by RawSocketDevice#pollPackets()
+	 * @param[in] packets An array of the received raw packets. The packets and their data are owned by the device and are valid only until
+	 * the callback returns
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] device A pointer to the RawSocketDevice instance
+	 * @param[in] userCookie A pointer to the object given by the user to RawSocketDevice#pollPackets()
+	 */
+	typedef void (*OnRawSocketPacketsArriveCallback)(RawPacket* packets, uint32_t numOfPackets, RawSocketDevice* device, void* userCookie);
+
 	/**
 	 * @class RawSocketDevice
 	 * A class that wraps the raw socket functionality. A raw socket is a network socket that allows direct sending and receiving
@@ -98,9 +117,9 @@ namespace pcpp
 		RecvPacketResult receivePacket(RawPacket& rawPacket, bool blocking = true, int timeout = -1);
 
 		/**
-		 * Receive packets into a packet vector for a certain amount of time. This method starts a timer and invokes the
-		 * receivePacket() method in blocking mode repeatedly until the timeout expires. All packets received successfully are
-		 * put into a packet vector
+		 * Receive packets into a packet vector for a certain amount of time. This method starts a timer and receives packets in
+		 * blocking mode repeatedly until the timeout expires. All packets received successfully are put into a packet vector. On Linux
+		 * the packets are received in batches with receivePacketBatch(), on other platforms one by one with receivePacket()
 		 * @param[out] packetVec The packet vector to add the received packet to
 		 * @param[in] timeout Timeout in seconds to receive packets on the raw socket
 		 * @param[out] failedRecv Number of receive attempts that failed
@@ -108,6 +127,59 @@ namespace pcpp
 		 */
 		int receivePackets(RawPacketVector& packetVec, int timeout, int& failedRecv);
 
+		/**
+		 * Receive a batch of packets with a single system call (recvmmsg). In blocking mode the method waits for the first packet (or
+		 * until the timeout expires) and then takes the packets already queued on the socket without waiting further, so it returns as
+		 * soon as there's something to return. The packets are timestamped by the kernel when they arrive (SO_TIMESTAMPNS) rather than
+		 * when they're read. The packets are received into buffers kept by the device and copied into buffers of their exact size, taken
+		 * from the pool set by setRawPacketPool() if there is one.
+		 * This method is only supported on Linux. Using it from other platforms will return -1 with a corresponding error log message
+		 * @param[out] packetVec The packet vector to add the received packets to
+		 * @param[in] maxNumOfPackets The maximum number of packets to receive. Values larger than #PCPP_RAW_SOCKET_MAX_BATCH_SIZE are
+		 * treated as #PCPP_RAW_SOCKET_MAX_BATCH_SIZE. Default value is #PCPP_RAW_SOCKET_MAX_BATCH_SIZE
+		 * @param[in] blocking Indicates whether to wait for the first packet or return immediately. Default value is blocking
+		 * @param[in] timeout When in blocking mode, specifies the timeout [in seconds] to wait for the first packet. Zero or negative values
+		 * mean no timeout. The default value is no timeout
+		 * @return The number of packets received, 0 if the timeout expired or no packets were queued in non-blocking mode, or -1 if an error
+		 * occurred such as device is not opened or the receive operation returned some error (a log message will be printed)
+		 */
+		int receivePacketBatch(RawPacketVector& packetVec, int maxNumOfPackets = PCPP_RAW_SOCKET_MAX_BATCH_SIZE, bool blocking = true, int timeout = -1);
+
+		/**
+		 * Receive the packets already queued on the socket without blocking and without copying them, and pass them to a callback as one
+		 * burst. One thread can drive many devices by calling this method when their selectable file descriptors (see getSelectableFd())
+		 * become readable (see DeviceReactor). Like receivePacketBatch() the packets are received with a single system call and timestamped
+		 * by the kernel.
+		 * This method is only supported on Linux. Using it from other platforms will return -1 with a corresponding error log message
+		 * @param[in] onPacketsArrive A callback that is called with the packets received, if any. The packets and their data are owned by
+		 * the device and are valid only until the callback returns
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object. This object will be transferred to the callback
+		 * @param[in] maxBurstSize The maximum number of packets to receive. Values larger than #PCPP_RAW_SOCKET_MAX_BATCH_SIZE are treated as
+		 * #PCPP_RAW_SOCKET_MAX_BATCH_SIZE. Default value is #PCPP_RAW_SOCKET_MAX_BATCH_SIZE
+		 * @return The number of packets received, 0 if no packets were queued, or -1 if an error occurred such as device is not opened, the
+		 * callback is NULL or the receive operation returned some error (a log message will be printed)
+		 */
+		int pollPackets(OnRawSocketPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, int maxBurstSize = PCPP_RAW_SOCKET_MAX_BATCH_SIZE);
+
+		/**
+		 * @return The file descriptor of the raw socket, which becomes readable when packets arrive, for waiting on many devices at once
+		 * with select(), poll() or epoll. Returns -1 if the device isn't open or on platforms other than Linux
+		 */
+		int getSelectableFd() const;
+
+		/**
+		 * Set a pool to take the raw data buffers of received packets from. When a pool is set, packets are received into a buffer kept by
+		 * the device and copied into a pool buffer of the right size, instead of allocating a new maximum-sized buffer on the heap for each
+		 * packet. Please notice the pool must outlive all received packets
+		 * @param[in] pool The pool to use, or NULL for allocating buffers on the heap (which is the default)
+		 */
+		inline void setRawPacketPool(RawPacketPool* pool) { m_RawPacketPool = pool; }
+
+		/**
+		 * @return The pool raw data buffers of received packets are taken from, or NULL if buffers are allocated on the heap
+		 */
+		inline RawPacketPool* getRawPacketPool() const { return m_RawPacketPool; }
+
 		/**
 		 * Send an Ethernet packet to the network. L2 protocols other than Ethernet are not supported in raw sockets.
 		 * The entire packet is sent as is, including the original Ethernet and IP data.
@@ -122,6 +194,7 @@ namespace pcpp
 		/**
 		 * Send a set of Ethernet packets to the network. L2 protocols other than Ethernet are not supported by raw sockets.
 		 * The entire packet is sent as is, including the original Ethernet and IP data.
+		 * On Linux the packets are sent in batches of up to #PCPP_RAW_SOCKET_MAX_BATCH_SIZE packets with a single system call (sendmmsg).
 		 * This method is only supported in Linux as Windows doesn't allow sending packets from raw sockets. Using it from
 		 * other platforms will return "false" with an appropriate error log message
 		 * @param[in] packetVec The set of packets to send
@@ -155,9 +228,16 @@ namespace pcpp
 		SocketFamily m_SockFamily;
 		void* m_Socket;
 		IPAddress* m_InterfaceIP;
+		RawPacketPool* m_RawPacketPool;
+		char* m_ReceiveBuffer;
 
 		RecvPacketResult getError(int& errorCode);
 
+		// get a buffer to receive a packet into and free it or hand it over to a raw packet after the packet was received
+		char* allocateReceiveBuffer();
+		void freeReceiveBuffer(char* buffer);
+		void setReceivedData(RawPacket& rawPacket, char* buffer, int bufferLen, LinkLayerType linkType);
+
 	};
 }
 
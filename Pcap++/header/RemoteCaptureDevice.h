@@ -0,0 +1,581 @@
+#ifndef PCAPPP_REMOTE_CAPTURE_DEVICE
+#define PCAPPP_REMOTE_CAPTURE_DEVICE
+
+#include "Device.h"
+#include "RawPacket.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+/// @file
+
+/**
+ * The default port a RemoteCaptureDevice listens on and a RemoteCaptureSender sends to
+ */
+#define PCPP_REMOTE_CAPTURE_DEFAULT_PORT 2003
+
+/**
+ * The size in bytes of the header of every batch frame
+ */
+#define PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE 28
+
+/**
+ * The size in bytes of the record header which precedes the data of every packet in a batch
+ */
+#define PCPP_REMOTE_CAPTURE_PACKET_HEADER_SIZE 16
+
+/**
+ * The largest batch frame sent over UDP, so a frame fits in a single datagram
+ */
+#define PCPP_REMOTE_CAPTURE_MAX_UDP_FRAME_SIZE 65000
+
+/**
+ * The largest batch frame a RemoteCaptureDevice accepts over TCP. Larger frames are treated as a corrupted stream
+ */
+#define PCPP_REMOTE_CAPTURE_MAX_TCP_FRAME_SIZE (16 * 1024 * 1024)
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	class PcapLiveDevice;
+	class RemoteCaptureDevice;
+
+	/**
+	 * The data channel of a remote capture
+	 */
+	enum RemoteCaptureTransport
+	{
+		/** Every batch is sent in a single UDP datagram. Batches lost on the way are counted by the receiver but not retransmitted */
+		RemoteCaptureTransportUdp,
+		/** Batches are sent over a TCP connection, so none are lost, and a slow receiver slows down the sender */
+		RemoteCaptureTransportTcp
+	};
+
+	/**
+	 * The compression of the packet data of a batch
+	 */
+	enum RemoteCaptureCompression
+	{
+		/** Batches are sent uncompressed */
+		RemoteCaptureNoCompression = 0,
+		/** Batches are compressed with zstd. Available only when PcapPlusPlus is built with USE_Z_STD */
+		RemoteCaptureZstdCompression = 1
+	};
+
+	/**
+	 * @struct RemoteCaptureConfiguration
+	 * A structure for configuring RemoteCaptureSender
+	 */
+	struct RemoteCaptureConfiguration
+	{
+		/** The data channel batches are sent over */
+		RemoteCaptureTransport transport;
+
+		/** The compression of the batches */
+		RemoteCaptureCompression compression;
+
+		/** The zstd compression level, between 1 (fastest) and 22. It's ignored if the batches aren't compressed */
+		int compressionLevel;
+
+		/** The number of packets after which a batch is sent */
+		uint32_t maxBatchPackets;
+
+		/** The size in bytes of a batch, including its header, after which it's sent. Over UDP it's capped at
+		 * #PCPP_REMOTE_CAPTURE_MAX_UDP_FRAME_SIZE and over TCP at #PCPP_REMOTE_CAPTURE_MAX_TCP_FRAME_SIZE. Packets larger than a batch
+		 * are truncated to fit
+		 */
+		uint32_t maxBatchSize;
+
+		/** The longest time in milliseconds a packet waits in a batch before the batch is sent, which bounds the capture latency when
+		 * traffic is low. 0 means batches are sent only when they're full or when flush() is called
+		 */
+		uint32_t maxBatchLatencyMs;
+
+		/** The ID of the stream, which tells the receiver apart the captures of several interfaces or agents */
+		uint16_t streamId;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] transport The data channel. Default is TCP
+		 * @param[in] compression The compression of the batches. Default is no compression
+		 * @param[in] maxBatchPackets The number of packets after which a batch is sent. Default is 1024
+		 * @param[in] maxBatchSize The size in bytes after which a batch is sent. Default is #PCPP_REMOTE_CAPTURE_MAX_UDP_FRAME_SIZE
+		 * @param[in] maxBatchLatencyMs The longest time a packet waits in a batch. Default is 10 milliseconds
+		 */
+		RemoteCaptureConfiguration(RemoteCaptureTransport transport = RemoteCaptureTransportTcp,
+				RemoteCaptureCompression compression = RemoteCaptureNoCompression, uint32_t maxBatchPackets = 1024,
+				uint32_t maxBatchSize = PCPP_REMOTE_CAPTURE_MAX_UDP_FRAME_SIZE, uint32_t maxBatchLatencyMs = 10) :
+			transport(transport), compression(compression), compressionLevel(3), maxBatchPackets(maxBatchPackets),
+			maxBatchSize(maxBatchSize), maxBatchLatencyMs(maxBatchLatencyMs), streamId(0)
+		{
+		}
+	};
+
+	/**
+	 * @struct RemoteCaptureStreamStats
+	 * The statistics of a remote capture stream, as counted by its sender or by the receiver
+	 */
+	struct RemoteCaptureStreamStats
+	{
+		/** The ID of the stream */
+		uint16_t streamId;
+		/** Number of batches sent or received */
+		uint64_t batches;
+		/** Number of packets sent or received */
+		uint64_t packets;
+		/** Number of bytes of packet data sent or received, before compression */
+		uint64_t packetBytes;
+		/** Number of bytes sent or received on the data channel, including the frame and packet headers */
+		uint64_t wireBytes;
+		/** Sender: number of packets in batches which couldn't be sent. Receiver: number of batches missing from the sequence (UDP only) */
+		uint64_t lost;
+		/** Sender: number of packets truncated to fit in a batch. Receiver: number of frames which couldn't be decoded */
+		uint64_t errors;
+	};
+
+	/**
+	 * @struct RemoteCaptureFrameHeader
+	 * The header of a batch frame, in host byte order. On the wire every frame starts with a #PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE bytes
+	 * header in network byte order: magic (4 bytes), version (1), compression (1), stream ID (2), sequence (4), number of packets (4),
+	 * link type (2), reserved (2), payload length (4) and uncompressed payload length (4). The payload is a record per packet: timestamp
+	 * seconds (4), timestamp nanoseconds (4), captured length (4), original length (4) and the captured data
+	 */
+	struct RemoteCaptureFrameHeader
+	{
+		/** The compression of the payload */
+		RemoteCaptureCompression compression;
+		/** The ID of the stream the batch belongs to */
+		uint16_t streamId;
+		/** The sequence number of the batch in its stream, starting from 0 */
+		uint32_t sequence;
+		/** The number of packets in the batch */
+		uint32_t numOfPackets;
+		/** The link layer type of the packets */
+		LinkLayerType linkType;
+		/** The length in bytes of the payload which follows the header */
+		uint32_t payloadLength;
+		/** The length in bytes of the payload after decompression */
+		uint32_t uncompressedLength;
+	};
+
+	/**
+	 * @class RemoteCaptureBatch
+	 * Builds the batch frames sent by RemoteCaptureSender. Packets are appended to an uncompressed payload and encode() creates the frame
+	 * from it, so the batch can be reused for the next packets. It isn't thread-safe
+	 */
+	class RemoteCaptureBatch
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] maxFrameSize The largest frame in bytes, including its header, the batch builds
+		 * @param[in] streamId The ID of the stream written to the frames
+		 * @param[in] linkType The link layer type of the packets
+		 */
+		RemoteCaptureBatch(uint32_t maxFrameSize, uint16_t streamId = 0, LinkLayerType linkType = LINKTYPE_ETHERNET);
+
+		/**
+		 * Add a packet to the batch. A packet which doesn't fit in an empty batch is truncated to fit, keeping its original length
+		 * @param[in] packet The packet to add
+		 * @param[out] truncated Set to true if the packet was truncated, false otherwise
+		 * @return False if the packet doesn't fit in the remaining space of the batch (it isn't added), true otherwise
+		 */
+		bool addPacket(const RawPacket& packet, bool& truncated);
+
+		/**
+		 * Create a frame from the packets of the batch and empty the batch. If compression doesn't make the payload smaller, the frame is
+		 * sent uncompressed
+		 * @param[in] sequence The sequence number written to the frame
+		 * @param[in] compression The compression of the payload
+		 * @param[in] compressionLevel The zstd compression level
+		 * @param[out] frame The frame. Its previous content is replaced
+		 * @return False if the requested compression isn't available in this build (an error is printed to log), true otherwise
+		 */
+		bool encode(uint32_t sequence, RemoteCaptureCompression compression, int compressionLevel, std::vector<uint8_t>& frame);
+
+		/**
+		 * Empty the batch
+		 */
+		void clear();
+
+		/**
+		 * @return The number of packets in the batch
+		 */
+		inline uint32_t getNumOfPackets() const { return m_NumOfPackets; }
+
+		/**
+		 * @return The number of bytes of packet data in the batch, excluding the packet headers
+		 */
+		inline uint64_t getPacketBytes() const { return m_PacketBytes; }
+
+		/**
+		 * @return True if the batch holds no packets
+		 */
+		inline bool isEmpty() const { return m_NumOfPackets == 0; }
+
+		/**
+		 * @return True if the requested compression is available in this build
+		 */
+		static bool isCompressionSupported(RemoteCaptureCompression compression);
+
+	private:
+		uint32_t m_MaxFrameSize;
+		uint16_t m_StreamId;
+		LinkLayerType m_LinkType;
+		std::vector<uint8_t> m_Payload;
+		uint32_t m_NumOfPackets;
+		uint64_t m_PacketBytes;
+	};
+
+	/**
+	 * @class RemoteCaptureBatchDecoder
+	 * Decodes the batch frames received by RemoteCaptureDevice into RawPackets which point into the decoded payload, so packet data isn't
+	 * copied. The packets are valid until the next frame is decoded. It isn't thread-safe
+	 */
+	class RemoteCaptureBatchDecoder
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 */
+		RemoteCaptureBatchDecoder();
+
+		/**
+		 * A d'tor for this class
+		 */
+		~RemoteCaptureBatchDecoder();
+
+		/**
+		 * Parse and validate a frame header
+		 * @param[in] data The received data, which must hold at least #PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE bytes
+		 * @param[in] dataLen The length of the data in bytes
+		 * @param[out] header The parsed header
+		 * @return False if the data is too short or doesn't start with a valid frame header, true otherwise
+		 */
+		static bool parseHeader(const uint8_t* data, size_t dataLen, RemoteCaptureFrameHeader& header);
+
+		/**
+		 * Decode a frame
+		 * @param[in] frame The frame, starting with its header
+		 * @param[in] frameLen The length of the frame in bytes
+		 * @return False if the frame is invalid or compressed with a compression unavailable in this build, true otherwise
+		 */
+		bool decode(const uint8_t* frame, size_t frameLen);
+
+		/**
+		 * @return The header of the last frame decoded
+		 */
+		inline const RemoteCaptureFrameHeader& getHeader() const { return m_Header; }
+
+		/**
+		 * @return The packets of the last frame decoded
+		 */
+		inline RawPacket* getPackets() const { return m_Packets; }
+
+		/**
+		 * @return The number of packets of the last frame decoded
+		 */
+		inline uint32_t getNumOfPackets() const { return m_NumOfPackets; }
+
+	private:
+		RemoteCaptureFrameHeader m_Header;
+		std::vector<uint8_t> m_Decompressed;
+		RawPacket* m_Packets;
+		uint32_t m_PacketsCapacity;
+		uint32_t m_NumOfPackets;
+
+		// disable copy c'tor and assignment operator
+		RemoteCaptureBatchDecoder(const RemoteCaptureBatchDecoder& other);
+		RemoteCaptureBatchDecoder& operator=(const RemoteCaptureBatchDecoder& other);
+	};
+
+	/**
+	 * @class RemoteCaptureSender
+	 * The sending side of a remote capture. Packets are gathered into batches which are sent to a RemoteCaptureDevice when they reach the
+	 * configured number of packets or size, or when their first packet waited the configured latency. Sending a batch instead of a packet
+	 * costs a system call and a frame header per batch, and compression lowers the bandwidth when the link to the receiver is the bottleneck.
+	 * A RemoteCaptureSender fed by a PcapLiveDevice (see RemoteCaptureAgent) is a remote capture agent which replaces rpcapd and its
+	 * per-packet protocol overhead.<BR>
+	 * sendPacket() and flush() may be called from one thread while a background thread sends the batches whose latency expired
+	 */
+	class RemoteCaptureSender
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The configuration of the stream
+		 */
+		RemoteCaptureSender(const RemoteCaptureConfiguration& config = RemoteCaptureConfiguration());
+
+		/**
+		 * A d'tor for this class. Sends the pending batch and disconnects
+		 */
+		~RemoteCaptureSender();
+
+		/**
+		 * Connect to a RemoteCaptureDevice. Over UDP the datagrams are sent to the address, over TCP a connection is made
+		 * @param[in] address The IPv4 address of the receiver
+		 * @param[in] port The port of the receiver. Default is #PCPP_REMOTE_CAPTURE_DEFAULT_PORT
+		 * @param[in] linkType The link layer type of the packets which will be sent. Default is LINKTYPE_ETHERNET
+		 * @return False if already connected, the configuration is invalid, the address is invalid or the connection failed (an error is
+		 * printed to log), true otherwise
+		 */
+		bool connect(const std::string& address, uint16_t port = PCPP_REMOTE_CAPTURE_DEFAULT_PORT, LinkLayerType linkType = LINKTYPE_ETHERNET);
+
+		/**
+		 * Send the pending batch, stop the latency thread and close the connection
+		 */
+		void disconnect();
+
+		/**
+		 * @return True if connected
+		 */
+		inline bool isConnected() const { return m_Socket >= 0; }
+
+		/**
+		 * Add a packet to the current batch, and send the batch if it's full
+		 * @param[in] packet The packet to send
+		 * @return False if not connected or a batch couldn't be sent (an error is printed to log), true otherwise
+		 */
+		bool sendPacket(const RawPacket& packet);
+
+		/**
+		 * Send the current batch even if it isn't full
+		 * @return False if not connected or the batch couldn't be sent (an error is printed to log), true otherwise
+		 */
+		bool flush();
+
+		/**
+		 * @return The configuration of the stream
+		 */
+		inline const RemoteCaptureConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * Get the statistics of the stream since the sender connected
+		 * @param[out] stats The statistics
+		 */
+		void getStats(RemoteCaptureStreamStats& stats);
+
+		/**
+		 * A PcapLiveDevice callback which sends the captured packets through a RemoteCaptureSender. Pass it to
+		 * PcapLiveDevice#startCapture() with the sender as the user cookie
+		 * @param[in] packet The captured packet
+		 * @param[in] device The capturing device
+		 * @param[in] senderPtr A pointer to the RemoteCaptureSender
+		 */
+		static void onPacketArrives(RawPacket* packet, PcapLiveDevice* device, void* senderPtr);
+
+	private:
+		RemoteCaptureConfiguration m_Config;
+		int m_Socket;
+		RemoteCaptureBatch* m_Batch;
+		std::vector<uint8_t> m_Frame;
+		uint32_t m_Sequence;
+		uint64_t m_BatchStartMs;
+		RemoteCaptureStreamStats m_Stats;
+		pthread_mutex_t m_Mutex;
+		pthread_cond_t m_StopCond;
+		pthread_t m_LatencyThread;
+		bool m_LatencyThreadStarted;
+		bool m_StopRequested;
+
+		bool sendBatch();
+		static void* latencyThreadMain(void* senderPtr);
+
+		// disable copy c'tor and assignment operator
+		RemoteCaptureSender(const RemoteCaptureSender& other);
+		RemoteCaptureSender& operator=(const RemoteCaptureSender& other);
+	};
+
+	/**
+	 * @class RemoteCaptureAgent
+	 * A remote capture agent built from a PcapLiveDevice and a RemoteCaptureSender: it captures on a local interface and streams the packets
+	 * in batches to a RemoteCaptureDevice, as rpcapd does for PcapRemoteDevice but without its per-packet overhead:
+	 *
+	 *     RemoteCaptureAgent agent(RemoteCaptureConfiguration(RemoteCaptureTransportTcp));
+	 *     agent.start(liveDevice, "10.0.0.1");
+	 *     ...
+	 *     agent.stop();
+	 */
+	class RemoteCaptureAgent
+	{
+	public:
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] config The configuration of the stream
+		 */
+		RemoteCaptureAgent(const RemoteCaptureConfiguration& config = RemoteCaptureConfiguration());
+
+		/**
+		 * A d'tor for this class. Stops the agent if it's running
+		 */
+		~RemoteCaptureAgent();
+
+		/**
+		 * Open the device if it isn't open, connect to the receiver and start capturing
+		 * @param[in] device The device to capture on
+		 * @param[in] address The IPv4 address of the receiver
+		 * @param[in] port The port of the receiver. Default is #PCPP_REMOTE_CAPTURE_DEFAULT_PORT
+		 * @return False if the agent is already running, the device couldn't be opened, the connection failed or the capture couldn't be
+		 * started (an error is printed to log), true otherwise
+		 */
+		bool start(PcapLiveDevice* device, const std::string& address, uint16_t port = PCPP_REMOTE_CAPTURE_DEFAULT_PORT);
+
+		/**
+		 * Stop capturing, send the pending batch and disconnect. The device is closed if start() opened it
+		 */
+		void stop();
+
+		/**
+		 * @return True if the agent is running
+		 */
+		inline bool isRunning() const { return m_Device != NULL; }
+
+		/**
+		 * @return The sender of the agent, for its statistics
+		 */
+		inline RemoteCaptureSender& getSender() { return m_Sender; }
+
+	private:
+		RemoteCaptureSender m_Sender;
+		PcapLiveDevice* m_Device;
+		bool m_OpenedDevice;
+
+		// disable copy c'tor and assignment operator
+		RemoteCaptureAgent(const RemoteCaptureAgent& other);
+		RemoteCaptureAgent& operator=(const RemoteCaptureAgent& other);
+	};
+
+	/**
+	 * @typedef OnRemoteCapturePacketsArriveCallback
+	 * A callback that is called with the packets of every batch a RemoteCaptureDevice receives
+	 * @param[in] packets An array of the received raw packets. The packet data isn't copied, so the packets are valid only until the
+	 * callback returns
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] streamId The ID of the stream the batch belongs to
+	 * @param[in] device A pointer to the RemoteCaptureDevice instance
+	 * @param[in] userCookie A pointer to the object put by the user when packet capturing started
+	 */
+	typedef void (*OnRemoteCapturePacketsArriveCallback)(RawPacket* packets, uint32_t numOfPackets, uint16_t streamId, RemoteCaptureDevice* device, void* userCookie);
+
+	/**
+	 * @class RemoteCaptureDevice
+	 * The receiving side of a remote capture. It listens for the batches of RemoteCaptureSenders (usually RemoteCaptureAgents running on
+	 * remote machines) and hands every batch to the user in one callback call on a capture thread. Over TCP it accepts several agents at
+	 * once. Statistics are kept per stream, and over UDP missing sequence numbers count the batches lost on the way.<BR>
+	 * Unlike PcapRemoteDevice it isn't limited to Windows, and the remote side runs a pcpp agent instead of rpcapd
+	 */
+	class RemoteCaptureDevice : public IDevice
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. Nothing is opened until open() is called
+		 * @param[in] transport The data channel to listen on
+		 * @param[in] port The port to listen on. Default is #PCPP_REMOTE_CAPTURE_DEFAULT_PORT. If it's 0 a free port is chosen, see getPort()
+		 * @param[in] bindAddress The IPv4 address to listen on. Default is all addresses
+		 */
+		RemoteCaptureDevice(RemoteCaptureTransport transport, uint16_t port = PCPP_REMOTE_CAPTURE_DEFAULT_PORT,
+				const std::string& bindAddress = "0.0.0.0");
+
+		/**
+		 * A d'tor for this class. Stops the capture and closes the device if they're active
+		 */
+		~RemoteCaptureDevice();
+
+		/**
+		 * @return The port the device listens on, which is the chosen port if 0 was requested and the device is open
+		 */
+		inline uint16_t getPort() const { return m_Port; }
+
+		/**
+		 * Start receiving on a new thread
+		 * @param[in] onPacketsArrive A callback that is called with the packets of every batch
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object which is transferred to the callback
+		 * @return False if the device isn't open, capture is already running, the callback is NULL or the thread couldn't be created (an
+		 * error is printed to log), true otherwise
+		 */
+		bool startCapture(OnRemoteCapturePacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie);
+
+		/**
+		 * Stop the capture thread
+		 */
+		void stopCapture();
+
+		/**
+		 * @return True if the capture thread is running
+		 */
+		inline bool captureActive() const { return m_CaptureThreadStarted; }
+
+		/**
+		 * Get the statistics of every stream received since the device was opened
+		 * @param[out] stats The statistics, a value per stream ordered by stream ID. Its previous content is replaced
+		 */
+		void getStreamStats(std::vector<RemoteCaptureStreamStats>& stats);
+
+		/**
+		 * @return The number of TCP connections currently open
+		 */
+		size_t getNumOfConnections();
+
+		// implement abstract methods
+
+		/**
+		 * Create the listening socket
+		 * @return False if the socket couldn't be created or bound (an error is printed to log), true otherwise
+		 */
+		bool open();
+
+		/**
+		 * Stop the capture if it's running and close all sockets
+		 */
+		void close();
+
+	private:
+		struct Connection
+		{
+			int socket;
+			std::vector<uint8_t> buffer;
+			size_t length;
+		};
+
+		RemoteCaptureTransport m_Transport;
+		uint16_t m_Port;
+		std::string m_BindAddress;
+		int m_Socket;
+		std::vector<Connection*> m_Connections;
+		std::vector<uint8_t> m_DatagramBuffer;
+		RemoteCaptureBatchDecoder m_Decoder;
+		std::map<uint16_t, RemoteCaptureStreamStats> m_StreamStats;
+		std::map<uint16_t, uint32_t> m_NextSequence;
+		pthread_mutex_t m_StatsMutex;
+		pthread_t m_CaptureThread;
+		bool m_CaptureThreadStarted;
+		volatile bool m_StopThread;
+		OnRemoteCapturePacketsArriveCallback m_OnPacketsArrive;
+		void* m_OnPacketsArriveUserCookie;
+
+		void handleFrame(const uint8_t* frame, size_t frameLen);
+		void receiveDatagram();
+		bool receiveFromConnection(Connection* conn);
+		void closeConnections();
+		static void* captureThreadMain(void* devicePtr);
+
+		// disable copy c'tor and assignment operator
+		RemoteCaptureDevice(const RemoteCaptureDevice& other);
+		RemoteCaptureDevice& operator=(const RemoteCaptureDevice& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_REMOTE_CAPTURE_DEVICE */
@@ -0,0 +1,209 @@
+#ifndef PCAPPP_ROTATING_FILE_WRITER_DEVICE
+#define PCAPPP_ROTATING_FILE_WRITER_DEVICE
+
+#include "PcapFileDevice.h"
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct RotatingFileWriterConfiguration
+	 * A structure for configuring RotatingFileWriterDevice
+	 */
+	struct RotatingFileWriterConfiguration
+	{
+		/** The flag indicating whether the files are written in the pcap-ng format. Otherwise they're written in the pcap format by
+		 * BufferedPcapFileWriterDevice
+		 */
+		bool pcapNg;
+
+		/** The size in bytes after which a new file is started. The size of a file is estimated from the packet records written to it, so
+		 * it's the size of a compressed pcap-ng file before compression. If the value is set to 0 files aren't rolled over by size
+		 */
+		uint64_t maxFileSize;
+
+		/** How long a file may span, expressed in seconds of packet time. A new file is started for the first packet whose timestamp is this
+		 * long after the first packet of the current file. If the value is set to 0 files aren't rolled over by time
+		 */
+		uint32_t maxFileDuration;
+
+		/** The maximum number of files kept. When a new file is started and there are more files, the oldest one is deleted, so the files
+		 * form a ring of the latest captured packets. If the value is set to 0 all files are kept
+		 */
+		uint32_t maxNumOfFiles;
+
+		/** The link layer type of the packets of pcap files. It's ignored for pcap-ng files, which hold the link layer type of every packet
+		 */
+		LinkLayerType linkLayerType;
+
+		/** The flag indicating whether pcap files are written in the nanosecond format, see BufferedPcapFileWriterDevice
+		 */
+		bool nanosecondsPrecision;
+
+		/** The compression level of pcap-ng files, see PcapNgFileWriterDevice
+		 */
+		int compressionLevel;
+
+		/** The flag indicating whether the disk space of a new file is reserved up front according to maxFileSize, so writing a file doesn't
+		 * fragment it or fail midway when the disk fills up. It's implemented on Linux for file systems which support fallocate() and
+		 * ignored otherwise
+		 */
+		bool preallocate;
+
+		/** The buffering configuration of pcap files, see BufferedPcapFileWriterDevice
+		 */
+		BufferedPcapFileWriterConfiguration bufferConfig;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] maxFileSize The size in bytes after which a new file is started, 0 means no limit. The default is 0
+		 * @param[in] maxFileDuration How long a file may span in seconds of packet time, 0 means no limit. The default is 0
+		 * @param[in] maxNumOfFiles The maximum number of files kept, 0 means all files are kept. The default is 0
+		 * @param[in] pcapNg The flag indicating whether the files are written in the pcap-ng format. The default is false
+		 * @param[in] linkLayerType The link layer type of the packets of pcap files. The default is Ethernet
+		 */
+		RotatingFileWriterConfiguration(uint64_t maxFileSize = 0, uint32_t maxFileDuration = 0, uint32_t maxNumOfFiles = 0, bool pcapNg = false,
+				LinkLayerType linkLayerType = LINKTYPE_ETHERNET) :
+			pcapNg(pcapNg), maxFileSize(maxFileSize), maxFileDuration(maxFileDuration), maxNumOfFiles(maxNumOfFiles), linkLayerType(linkLayerType),
+			nanosecondsPrecision(false), compressionLevel(0), preallocate(false)
+		{
+		}
+	};
+
+
+	/**
+	 * @class RotatingFileWriterDevice
+	 * A file writer device for long running captures, similar to the -C, -G and -W options of tcpdump. Packets are written to a sequence of
+	 * files, and a new file is started when the current one reaches a size or spans a time period. Optionally only the latest files are
+	 * kept, so a capture can run indefinitely in a bounded amount of disk space.
+	 * The files are named after the file name given to the c'tor with a sequence number appended before the extension, for example
+	 * capture_000000.pcap, capture_000001.pcap and so on for "capture.pcap".
+	 * Rolling over to a new file never waits for the disk: a housekeeping thread opens (and preallocates) the next file in advance, and
+	 * closes the previous file and deletes the oldest file in the ring after the rollover. The thread calling writePacket() only waits if
+	 * the next file isn't open yet when it's needed, which happens when files are rolled over faster than they can be created.
+	 * When summaries are enabled (see IFileWriterDevice#setSummaryEnabled()) every file of the sequence is saved with its own summary, which
+	 * is deleted with the file
+	 */
+	class RotatingFileWriterDevice : public IFileWriterDevice
+	{
+	private:
+		RotatingFileWriterConfiguration m_Config;
+		std::string m_FilePrefix;
+		std::string m_FileExtension;
+		IFileWriterDevice* m_CurrentWriter;
+		std::string m_CurrentFileName;
+		uint64_t m_CurrentFileSize;
+		uint32_t m_CurrentFileNumOfPackets;
+		time_t m_CurrentFileStartTime;
+		uint32_t m_NextFileNumber;
+		// the files written so far which weren't deleted, the current one included
+		std::deque<std::string> m_FileNames;
+
+		// the state shared with the housekeeping thread
+		pthread_t m_HousekeepingThread;
+		pthread_mutex_t m_Mutex;
+		pthread_cond_t m_WorkAvailable;
+		pthread_cond_t m_NextWriterReady;
+		IFileWriterDevice* m_NextWriter;
+		std::string m_NextFileName;
+		bool m_PrepareRequested;
+		bool m_PrepareFailed;
+		std::vector<IFileWriterDevice*> m_WritersToClose;
+		std::vector<std::string> m_FilesToDelete;
+		bool m_StopRequested;
+
+		// private copy c'tor
+		RotatingFileWriterDevice(const RotatingFileWriterDevice& other);
+		RotatingFileWriterDevice& operator=(const RotatingFileWriterDevice& other);
+
+		static void* housekeepingThreadMain(void* device);
+		std::string getFileName(uint32_t fileNumber) const;
+		IFileWriterDevice* openWriter(const std::string& fileName);
+		void closeWriter(IFileWriterDevice* writer);
+		bool rollOver();
+		void requestNextWriter();
+
+	public:
+		/**
+		 * A constructor for this class. Notice that after calling this constructor no file is opened yet, so writing packets will fail. For
+		 * opening the first file call open()
+		 * @param[in] fileName The full path of the files, which is used as a template for their names (see the class description)
+		 * @param[in] config The rollover configuration. The default is RotatingFileWriterConfiguration(), which writes a single pcap file
+		 */
+		RotatingFileWriterDevice(const char* fileName, const RotatingFileWriterConfiguration& config = RotatingFileWriterConfiguration());
+
+		/**
+		 * A destructor for this class, closes the current file if it's open
+		 */
+		~RotatingFileWriterDevice() { close(); }
+
+		/**
+		 * Write a RawPacket to the current file, after starting a new file if the packet doesn't fit in the current one. Before using this
+		 * method please verify the device is opened using open(). This method may be called from one thread at a time
+		 * @param[in] packet A reference for an existing RawPcket to write
+		 * @return True if the packet was written successfully. False will be returned if the device isn't opened, if a new file couldn't be
+		 * opened or if the file writer device failed writing the packet (in the first two cases, an error will be printed to log)
+		 */
+		bool writePacket(RawPacket const& packet);
+
+		/**
+		 * Write multiple RawPackets, see writePacket()
+		 * @param[in] packets A reference for an existing RawPcketVector, all of its packets will be written
+		 * @return True if all packets were written successfully, false if at least one of them wasn't
+		 */
+		bool writePackets(const RawPacketVector& packets);
+
+		/**
+		 * @return The name of the file packets are currently written to, or an empty string if the device isn't opened
+		 */
+		inline const std::string& getCurrentFileName() const { return m_CurrentFileName; }
+
+		/**
+		 * @return The names of the files written so far which weren't deleted, oldest first. The current file is the last one
+		 */
+		std::vector<std::string> getFileNames() const;
+
+		//override methods
+
+		/**
+		 * Open the first file and start the housekeeping thread. Existing files with the names of the sequence are overwritten
+		 * @return True if the device was opened successfully or if it's already opened. False if opening the first file or starting the
+		 * housekeeping thread failed (an error will be printed to log)
+		 */
+		virtual bool open();
+
+		/**
+		 * Appending isn't supported, every file of the sequence is created
+		 * @param[in] appendMode If set to false this method will act exactly like open()
+		 * @return False if appendMode is true (an error will be printed to log), otherwise see open()
+		 */
+		bool open(bool appendMode);
+
+		/**
+		 * Close the current file and stop the housekeeping thread after it closed the previous files
+		 */
+		virtual void close();
+
+		/**
+		 * Get statistics of the packets written so far to all files, as reported by the file writer devices of the files (see
+		 * BufferedPcapFileWriterDevice#getStatistics() and PcapNgFileWriterDevice#getStatistics()). Packets which were rejected by
+		 * writePacket() before reaching a file are counted in ps_drop. Files being closed by the housekeeping thread are counted once
+		 * they're closed
+		 * @param[out] stats The stats struct where stats are returned
+		 */
+		virtual void getStatistics(pcap_stat& stats);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_ROTATING_FILE_WRITER_DEVICE */
@@ -0,0 +1,329 @@
+#ifndef PCAPPP_SHARED_MEMORY_RING_DEVICE
+#define PCAPPP_SHARED_MEMORY_RING_DEVICE
+
+#include "Device.h"
+#include "RawPacket.h"
+#include <string>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The default number of packet slots of a shared memory ring
+ */
+#define PCPP_SHARED_RING_DEFAULT_NUM_OF_SLOTS 65536
+
+/**
+ * The default slot size of a shared memory ring, which is the largest packet stored whole
+ */
+#define PCPP_SHARED_RING_DEFAULT_SLOT_SIZE 2048
+
+/**
+ * The default maximum number of readers attached to a shared memory ring at once
+ */
+#define PCPP_SHARED_RING_DEFAULT_MAX_READERS 8
+
+	class PcapLiveDevice;
+
+	/**
+	 * @struct SharedMemoryRingConfiguration
+	 * The configuration of a shared memory packet ring, see SharedMemoryRingWriterDevice
+	 */
+	struct SharedMemoryRingConfiguration
+	{
+		/** The name of the ring. Writer and readers find the ring by its name, which is the name of a POSIX shared memory object
+		 * (see shm_open()) or of a file in hugePageDirectory. It should start with a '/' when hugePageDirectory is empty
+		 */
+		std::string name;
+
+		/** The directory of a mounted hugetlbfs file system (for example "/dev/hugepages") the ring is created in, so it's backed by huge
+		 * pages. Empty means a regular POSIX shared memory object
+		 */
+		std::string hugePageDirectory;
+
+		/** The number of packet slots, rounded up to a power of 2. Only the writer uses it, readers take it from the ring */
+		uint32_t numOfSlots;
+
+		/** The size of each slot in bytes. Longer packets are truncated. Only the writer uses it */
+		uint32_t slotSize;
+
+		/** The maximum number of readers attached at once. Only the writer uses it */
+		uint16_t maxReaders;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] name The name of the ring
+		 * @param[in] numOfSlots The number of packet slots. Default is #PCPP_SHARED_RING_DEFAULT_NUM_OF_SLOTS
+		 * @param[in] slotSize The size of each slot in bytes. Default is #PCPP_SHARED_RING_DEFAULT_SLOT_SIZE
+		 * @param[in] maxReaders The maximum number of readers. Default is #PCPP_SHARED_RING_DEFAULT_MAX_READERS
+		 */
+		SharedMemoryRingConfiguration(const std::string& name, uint32_t numOfSlots = PCPP_SHARED_RING_DEFAULT_NUM_OF_SLOTS,
+				uint32_t slotSize = PCPP_SHARED_RING_DEFAULT_SLOT_SIZE, uint16_t maxReaders = PCPP_SHARED_RING_DEFAULT_MAX_READERS) :
+			name(name), numOfSlots(numOfSlots), slotSize(slotSize), maxReaders(maxReaders)
+		{
+		}
+	};
+
+
+	/**
+	 * @struct SharedMemoryRingStats
+	 * The statistics of a SharedMemoryRingWriterDevice or a SharedMemoryRingReaderDevice
+	 */
+	struct SharedMemoryRingStats
+	{
+		/** Number of packets written to the ring (writer) or received from it (reader) */
+		uint64_t packets;
+		/** Number of bytes of these packets, as stored in the ring */
+		uint64_t bytes;
+		/** Writer: number of packets dropped because the slot they should be written to was held by a reader. Reader: number of packets
+		 * overwritten by the writer before the reader got to them
+		 */
+		uint64_t drops;
+		/** Writer only: number of packets truncated to the slot size */
+		uint64_t truncated;
+	};
+
+
+	/**
+	 * @class SharedMemoryRingWriterDevice
+	 * The writer side of a ring of packets in shared memory, for sharing the packets one process captures with other processes
+	 * (SharedMemoryRingReaderDevice) without copying them to each process. A capture process usually writes the bursts it captures, for
+	 * example by passing onPacketsArriveBurst() to PcapLiveDevice#startCaptureBurstMode(), and each reader process reads all of them at
+	 * its own pace.<BR>
+	 * The ring is a POSIX shared memory object, or a file on a hugetlbfs mount so it's backed by huge pages (see
+	 * SharedMemoryRingConfiguration#hugePageDirectory). It has a fixed number of fixed size slots, each holding the timestamp, the lengths
+	 * and the data of one packet. The writer never waits for readers: every reader has its own read position, and a reader which falls
+	 * more than the ring size behind loses the oldest packets, which it counts as drops, without affecting the other readers. The only
+	 * packets the writer doesn't overwrite are the ones a reader is holding (the last burst it received, see
+	 * SharedMemoryRingReaderDevice#receivePackets()); when the next slot is held the writer drops the packet and counts it.<BR>
+	 * A ring has a single writer. Opening the writer creates the ring, replacing a ring with the same name left by a writer which didn't
+	 * close it, and closing the writer removes the name, so readers attached to it read the packets which are left and then see that the
+	 * writer is gone (SharedMemoryRingReaderDevice#isWriterClosed()). Readers can attach and detach at any time while the writer is open.
+	 * A writer isn't thread-safe.<BR>
+	 * This device is supported on Linux only, opening it on other platforms fails
+	 */
+	class SharedMemoryRingWriterDevice : public IDevice
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. The ring isn't created until open() is called
+		 * @param[in] config The configuration of the ring
+		 */
+		SharedMemoryRingWriterDevice(const SharedMemoryRingConfiguration& config);
+
+		/**
+		 * A d'tor for this class. Closes the device if it's open
+		 */
+		~SharedMemoryRingWriterDevice();
+
+		/**
+		 * @return The configuration of the ring. The number of slots is rounded up to a power of 2 when the device is opened
+		 */
+		inline const SharedMemoryRingConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * Write a packet to the ring
+		 * @param[in] rawPacket The packet
+		 * @return True if the packet was written, false if the device isn't open or the packet was dropped
+		 */
+		bool sendPacket(const RawPacket& rawPacket);
+
+		/**
+		 * Write packets to the ring and publish them to the readers together
+		 * @param[in] rawPacketsArr An array of packets
+		 * @param[in] arrLength The number of packets in the array
+		 * @return The number of packets written
+		 */
+		int sendPackets(const RawPacket* rawPacketsArr, int arrLength);
+
+		/**
+		 * Write the packets of a packet vector to the ring and publish them to the readers together
+		 * @param[in] rawPackets The packets
+		 * @return The number of packets written
+		 */
+		int sendPackets(const RawPacketVector& rawPackets);
+
+		/**
+		 * @return The number of readers attached to the ring, or 0 if the device isn't open
+		 */
+		int getNumOfReaders() const;
+
+		/**
+		 * Get the statistics of the writer since the device was opened
+		 * @param[out] stats The object the statistics are written to
+		 */
+		void getStatistics(SharedMemoryRingStats& stats) const;
+
+		/**
+		 * Report the getStatistics() counters to a MetricsRegistry snapshot: pcpp_device_tx_packets_total, pcpp_device_tx_bytes_total,
+		 * pcpp_device_tx_dropped_packets_total and pcpp_device_shared_ring_readers
+		 * @param[in] writer The writer to report the values to
+		 */
+		void collectMetrics(MetricsWriter& writer);
+
+		/**
+		 * A PcapLiveDevice#startCapture() callback which writes each captured packet to the ring
+		 * @param[in] packet The captured packet
+		 * @param[in] pDevice The capturing device
+		 * @param[in] userCookie A pointer to the SharedMemoryRingWriterDevice instance
+		 */
+		static void onPacketArrives(RawPacket* packet, PcapLiveDevice* pDevice, void* userCookie);
+
+		/**
+		 * A PcapLiveDevice#startCaptureBurstMode() callback which writes each burst of captured packets to the ring
+		 * @param[in] packets The captured packets
+		 * @param[in] numOfPackets The number of captured packets
+		 * @param[in] pDevice The capturing device
+		 * @param[in] userCookie A pointer to the SharedMemoryRingWriterDevice instance
+		 */
+		static void onPacketsArriveBurst(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* pDevice, void* userCookie);
+
+		// implement abstract methods
+
+		/**
+		 * Create the ring and map it
+		 * @return True if the device was opened, false otherwise (an error is printed to log)
+		 */
+		bool open();
+
+		/**
+		 * Mark the ring as closed for the readers, unmap it and remove its name
+		 */
+		void close();
+
+	private:
+
+		SharedMemoryRingConfiguration m_Config;
+		uint8_t* m_Map;
+		size_t m_MapSize;
+		// the index of the next packet, which is published to the readers after each send call
+		uint64_t m_WriteIndex;
+		SharedMemoryRingStats m_Stats;
+
+		bool writePacket(const RawPacket& rawPacket);
+		bool isSlotHeld(uint64_t packetIndex);
+		void publish();
+
+		// disable copy c'tor and assignment operator
+		SharedMemoryRingWriterDevice(const SharedMemoryRingWriterDevice& other);
+		SharedMemoryRingWriterDevice& operator=(const SharedMemoryRingWriterDevice& other);
+	};
+
+
+	/**
+	 * @class SharedMemoryRingReaderDevice
+	 * The reader side of a ring of packets in shared memory created by a SharedMemoryRingWriterDevice, usually in another process. Opening
+	 * the device attaches it to the ring as one of its readers, starting with the next packet the writer writes. The packets are received
+	 * in bursts of RawPackets whose data points into the ring (no copy); the reader holds the slots of the last burst, so the writer
+	 * doesn't overwrite them, until the next receivePackets() call, releasePackets() or close().<BR>
+	 * Each reader has its own read position and statistics: when it falls behind by more than the ring size the packets it missed are
+	 * counted as drops (see getStatistics()) and it continues from the middle of the ring, skipping the oldest packets which the writer
+	 * is about to overwrite. The readers don't affect each other, except a
+	 * reader which holds a burst too long makes the writer drop packets once it wraps around the ring. A reader which dies while holding a
+	 * burst is detached by the writer when it gets there.<BR>
+	 * A reader isn't thread-safe. This device is supported on Linux only, opening it on other platforms fails
+	 */
+	class SharedMemoryRingReaderDevice : public IDevice
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. The device isn't attached to the ring until open() is called
+		 * @param[in] name The name of the ring, as in SharedMemoryRingConfiguration#name
+		 * @param[in] hugePageDirectory The hugetlbfs directory of the ring, as in SharedMemoryRingConfiguration#hugePageDirectory. Default
+		 * is an empty string, for a POSIX shared memory object
+		 */
+		SharedMemoryRingReaderDevice(const std::string& name, const std::string& hugePageDirectory = "");
+
+		/**
+		 * A d'tor for this class. Detaches from the ring if the device is open
+		 */
+		~SharedMemoryRingReaderDevice();
+
+		/**
+		 * @return The name of the ring
+		 */
+		inline const std::string& getName() const { return m_Name; }
+
+		/**
+		 * Receive the next packets. The slots of the burst received by the previous call are released first
+		 * @param[out] packets Set to an array of the received packets, which belongs to the device. The packets point into the ring and are
+		 * valid until the next call, releasePackets() or close()
+		 * @param[in] maxCount The maximum number of packets to receive, which is capped at a quarter of the ring size
+		 * @param[in] timeoutMs The time in milliseconds to wait for packets when there are none. 0 means not waiting, a negative value means
+		 * waiting until packets arrive or the writer closes the ring. Default is 0
+		 * @return The number of packets received, 0 if no packets arrived before the timeout or -1 if the device isn't open
+		 */
+		int receivePackets(RawPacket*& packets, int maxCount, int timeoutMs = 0);
+
+		/**
+		 * Release the slots of the last received burst, so the writer can reuse them. The packets of the burst aren't valid anymore
+		 */
+		void releasePackets();
+
+		/**
+		 * @return True if the writer closed the ring. Packets left in the ring can still be received
+		 */
+		bool isWriterClosed() const;
+
+		/**
+		 * @return The number of slots of the ring, or 0 if the device isn't open
+		 */
+		uint32_t getNumOfSlots() const;
+
+		/**
+		 * Get the statistics of the reader since the device was opened
+		 * @param[out] stats The object the statistics are written to
+		 */
+		void getStatistics(SharedMemoryRingStats& stats) const;
+
+		/**
+		 * Report the getStatistics() counters to a MetricsRegistry snapshot: pcpp_device_rx_packets_total, pcpp_device_rx_bytes_total and
+		 * pcpp_device_rx_dropped_packets_total
+		 * @param[in] writer The writer to report the values to
+		 */
+		void collectMetrics(MetricsWriter& writer);
+
+		// implement abstract methods
+
+		/**
+		 * Map the ring and attach to it as a reader
+		 * @return True if the device was opened, false if the ring doesn't exist, isn't valid or has the maximum number of readers (an
+		 * error is printed to log)
+		 */
+		bool open();
+
+		/**
+		 * Detach from the ring and unmap it
+		 */
+		void close();
+
+	private:
+
+		std::string m_Name;
+		std::string m_HugePageDirectory;
+		uint8_t* m_Map;
+		size_t m_MapSize;
+		int m_ReaderId;
+		uint64_t m_ReadIndex;
+		RawPacket* m_Packets;
+		int m_PacketsCapacity;
+		SharedMemoryRingStats m_Stats;
+
+		int readPackets(int maxCount);
+
+		// disable copy c'tor and assignment operator
+		SharedMemoryRingReaderDevice(const SharedMemoryRingReaderDevice& other);
+		SharedMemoryRingReaderDevice& operator=(const SharedMemoryRingReaderDevice& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_SHARED_MEMORY_RING_DEVICE */
@@ -0,0 +1,384 @@
+#ifndef PCAPPP_STREAM_SINK
+#define PCAPPP_STREAM_SINK
+
+#include "FixedLRUList.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+/// @file
+
+/**
+ * The default total size of the data StreamSink buffers for all streams together
+ */
+#define PCPP_STREAM_SINK_DEFAULT_MEMORY_BUDGET (64 * 1024 * 1024)
+
+/**
+ * The default size of the chunks StreamSink buffers data in
+ */
+#define PCPP_STREAM_SINK_DEFAULT_CHUNK_SIZE (16 * 1024)
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct StreamSinkConfiguration
+	 * A structure for configuring StreamSink
+	 */
+	struct StreamSinkConfiguration
+	{
+		/** The total size in bytes of the data buffered for all streams together, including the data handed to the I/O thread and not written
+		 * yet. When it's reached, writing waits until the I/O thread writes some of it
+		 */
+		size_t memoryBudget;
+
+		/** The size in bytes of the chunks data is buffered in. Every stream with buffered data holds at least one chunk, so with many
+		 * streams a smaller chunk makes better use of the memory budget, and a larger chunk makes fewer and larger writes
+		 */
+		size_t chunkSize;
+
+		/** The maximum number of stream files kept open at the same time. When it's reached, the least recently written file is closed and
+		 * it's reopened for appending when it's written again. Not used when the streams are written to a container file
+		 */
+		size_t maxOpenFiles;
+
+		/** The flag indicating whether the data is written by an I/O thread, so write() doesn't wait for the disk unless the memory budget
+		 * is used up, or by the thread calling write()
+		 */
+		bool asynchronous;
+
+		/** The name of a container file to write all streams to, with an index of the streams at its end (see StreamContainerReader). If
+		 * it's empty every stream is written to a file of its own
+		 */
+		std::string containerFileName;
+
+		/**
+		 * A c'tor for this struct
+		 * @param[in] memoryBudget The total size of the data buffered for all streams. The default is #PCPP_STREAM_SINK_DEFAULT_MEMORY_BUDGET
+		 * @param[in] maxOpenFiles The maximum number of stream files kept open at the same time. The default is 250, which is within the
+		 * limits of all OS's
+		 * @param[in] chunkSize The size of the chunks data is buffered in. The default is #PCPP_STREAM_SINK_DEFAULT_CHUNK_SIZE
+		 * @param[in] asynchronous The flag indicating whether the data is written by an I/O thread. The default is true
+		 */
+		StreamSinkConfiguration(size_t memoryBudget = PCPP_STREAM_SINK_DEFAULT_MEMORY_BUDGET, size_t maxOpenFiles = 250,
+				size_t chunkSize = PCPP_STREAM_SINK_DEFAULT_CHUNK_SIZE, bool asynchronous = true) :
+			memoryBudget(memoryBudget), chunkSize(chunkSize), maxOpenFiles(maxOpenFiles), asynchronous(asynchronous)
+		{
+		}
+	};
+
+
+	/**
+	 * @class StreamSink
+	 * Writes the data of a large number of byte streams, such as the reassembled data of TCP connections, to a file per stream or to a
+	 * single container file, without opening and closing a file for every few bytes:
+	 * - Every stream buffers its data in chunks taken from a pool shared by all streams. When three quarters of the memory budget are
+	 *   buffered, the stream with the most buffered data is handed to the I/O thread, so the writes are few and large and the disk is kept
+	 *   busy while the rest of the budget fills
+	 * - The I/O thread writes all chunks of a stream with a single writev() call (on Windows a write per chunk) and returns them to the pool
+	 * - A bounded number of stream files is kept open. When a file is written and the limit is reached, the least recently written file is
+	 *   closed (see FixedLRUList)
+	 * - In container mode all streams are appended to one file as records of a stream ID and its data, and the index of the streams is
+	 *   written at the end of the file when it's closed. This creates one file instead of a file per stream, so the file system isn't asked
+	 *   to create millions of small files
+	 *
+	 * Finding the stream with the most buffered data and the least recently written file take constant time however many streams there
+	 * are. Files are created (overwriting existing files) the first time they're written to the disk, and the files of streams which weren't
+	 * written yet are created when the stream is ended or the sink is closed:
+	 *
+	 *     StreamSink sink;
+	 *     sink.open();
+	 *     int streamId = sink.addStream("connection-1.txt");
+	 *     sink.write(streamId, data, dataLen);
+	 *     ...
+	 *     sink.endStream(streamId);
+	 *     sink.close();
+	 *
+	 * All methods must be called by a single thread. When writing asynchronously, errors of the I/O thread are printed to log when they
+	 * happen and are reported by the next flushAll() or close()
+	 */
+	class StreamSink
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. Nothing is written until open() is called
+		 * @param[in] config The configuration. The default is StreamSinkConfiguration()
+		 */
+		StreamSink(const StreamSinkConfiguration& config = StreamSinkConfiguration());
+
+		/**
+		 * A d'tor for this class. Writes all buffered data and closes the files
+		 */
+		~StreamSink();
+
+		/**
+		 * Create the container file, if one is configured, and start the I/O thread
+		 * @return False if the sink is already open, the container file can't be created or the I/O thread can't be started (an error will
+		 * be printed to log), true otherwise
+		 */
+		bool open();
+
+		/**
+		 * Write all buffered data, create the files of streams no data was written to, write the index of the container file, stop the I/O
+		 * thread and close all files
+		 * @return False if some data couldn't be written since the sink was opened (an error was printed to log), true otherwise
+		 */
+		bool close();
+
+		/**
+		 * @return True if the sink is open, false otherwise
+		 */
+		inline bool isOpened() const { return m_Opened; }
+
+		/**
+		 * Add a stream. Its file isn't created until its data is written to the disk or it's ended
+		 * @param[in] name The full path of the stream file, or the name of the stream in the container file
+		 * @return The stream ID to pass to write(), or -1 if the sink isn't open (an error will be printed to log)
+		 */
+		int addStream(const std::string& name);
+
+		/**
+		 * Buffer data for writing to a stream. This may hand the stream with the most buffered data to the I/O thread, and wait for room
+		 * if the memory budget is used up
+		 * @param[in] streamId The stream ID returned by addStream()
+		 * @param[in] data The data to write
+		 * @param[in] dataLen The data length in bytes
+		 * @return False if the stream ID isn't valid, the stream was ended or, when writing synchronously, writing to the disk failed (an
+		 * error will be printed to log), true otherwise
+		 */
+		bool write(int streamId, const uint8_t* data, size_t dataLen);
+
+		/**
+		 * Write the buffered data of a stream and close its file. No more data can be written to the stream
+		 * @param[in] streamId The stream ID returned by addStream()
+		 * @return False if the stream ID isn't valid or the stream was already ended (an error will be printed to log), or if writing
+		 * synchronously failed, true otherwise
+		 */
+		bool endStream(int streamId);
+
+		/**
+		 * Write the buffered data of all streams to the disk and wait until it's written
+		 * @return False if some data couldn't be written since the sink was opened (an error was printed to log), true otherwise
+		 */
+		bool flushAll();
+
+		/**
+		 * @return The number of streams added
+		 */
+		inline size_t getNumOfStreams() const { return m_Streams.size(); }
+
+		/**
+		 * @return The number of bytes accepted by write()
+		 */
+		inline uint64_t getNumOfBytesAccepted() const { return m_NumOfBytesAccepted; }
+
+		/**
+		 * @return The number of bytes written to the disk so far, excluding the record headers and the index of the container file
+		 */
+		uint64_t getNumOfBytesWritten() const;
+
+		/**
+		 * @return The number of times stream files were opened, including reopening files for appending after they were closed
+		 */
+		uint64_t getNumOfFileOpens() const;
+
+		/**
+		 * @return The number of write system calls made
+		 */
+		uint64_t getNumOfWriteCalls() const;
+
+	private:
+		struct Chunk
+		{
+			Chunk* next;
+			size_t len;
+			uint8_t* data;
+		};
+
+		// the buffered data of a stream, owned by the thread calling write()
+		struct StreamBuffer
+		{
+			Chunk* firstChunk;
+			Chunk* lastChunk;
+			size_t numOfChunks;
+			bool ended;
+			// the links of the list of the streams with the same number of chunks
+			int prevInBucket;
+			int nextInBucket;
+		};
+
+		// the file of a stream, owned by the I/O thread
+		struct StreamFile
+		{
+			std::string name;
+			// the file descriptor, or -1 if the file isn't open
+			int fd;
+			// whether the file was created, so it's reopened for appending
+			bool created;
+			// in container mode, the offset and the length of every record of the stream
+			std::vector<std::pair<uint64_t, uint64_t> > records;
+			uint64_t length;
+		};
+
+		struct Request
+		{
+			enum Type { AddStream, WriteStream, EndStream };
+
+			Type type;
+			int streamId;
+			Chunk* firstChunk;
+			std::string name;
+		};
+
+		struct Statistics
+		{
+			uint64_t numOfBytesWritten;
+			uint64_t numOfFileOpens;
+			uint64_t numOfWriteCalls;
+			uint64_t numOfWriteErrors;
+		};
+
+		StreamSinkConfiguration m_Config;
+		bool m_Opened;
+
+		// the state of the thread calling write(): the buffered streams, by their number of chunks in buckets as in MultiFileWriter, and
+		// the free chunks taken from the pool
+		std::vector<StreamBuffer> m_Streams;
+		std::vector<int> m_Buckets;
+		size_t m_LargestBucket;
+		Chunk* m_LocalFreeChunks;
+		size_t m_NumOfBufferedChunks;
+		size_t m_HandOffThreshold;
+		uint64_t m_NumOfBytesAccepted;
+
+		// the state shared with the I/O thread, guarded by the mutex
+		mutable pthread_mutex_t m_Mutex;
+		pthread_cond_t m_WorkAvailable;
+		pthread_cond_t m_WorkDone;
+		std::vector<Request> m_Requests;
+		size_t m_NumOfPendingRequests;
+		Chunk* m_FreeChunks;
+		size_t m_NumOfChunks;
+		size_t m_MaxNumOfChunks;
+		bool m_StopRequested;
+		Statistics m_Stats;
+
+		// the state of the I/O thread, or of the thread calling write() when writing synchronously
+		pthread_t m_IOThread;
+		std::vector<StreamFile> m_Files;
+		FixedLRUList<int> m_OpenFiles;
+		int m_ContainerFd;
+		uint64_t m_ContainerOffset;
+		Statistics m_IOStats;
+
+		static void* ioThreadMain(void* sinkPtr);
+		static void freeChunks(Chunk* chunks);
+		Chunk* acquireChunk();
+		void addToBucket(int streamId);
+		void removeFromBucket(int streamId);
+		void handOff(int streamId, bool endStream);
+		void submitRequest(Request& request);
+		Chunk* processRequest(Request& request);
+		void releaseChunks(Chunk* chunks);
+		bool openFile(int streamId);
+		void closeFile(int streamId);
+		bool writeChunks(int streamId, Chunk* chunks);
+		bool writeContainerIndex();
+
+		// disable copy c'tor and assignment operator
+		StreamSink(const StreamSink& other);
+		StreamSink& operator=(const StreamSink& other);
+	};
+
+
+	/**
+	 * @class StreamContainerReader
+	 * Reads the streams of a container file written by StreamSink. The index at the end of the file is read when it's opened, and every
+	 * stream is read from its records
+	 */
+	class StreamContainerReader
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. The file isn't read until open() is called
+		 * @param[in] fileName The container file name
+		 */
+		StreamContainerReader(const std::string& fileName);
+
+		/**
+		 * A d'tor for this class, closes the file if it's open
+		 */
+		~StreamContainerReader();
+
+		/**
+		 * Open the container file and read its index
+		 * @return False if the file can't be opened or isn't a complete container file (an error will be printed to log), true otherwise
+		 */
+		bool open();
+
+		/**
+		 * Close the container file
+		 */
+		void close();
+
+		/**
+		 * @return The number of streams in the container file
+		 */
+		inline size_t getNumOfStreams() const { return m_Streams.size(); }
+
+		/**
+		 * @param[in] streamIndex The index of the stream, from 0 to getNumOfStreams() - 1
+		 * @return The name the stream was added with
+		 */
+		inline const std::string& getStreamName(size_t streamIndex) const { return m_Streams.at(streamIndex).name; }
+
+		/**
+		 * @param[in] streamIndex The index of the stream, from 0 to getNumOfStreams() - 1
+		 * @return The length of the stream data in bytes
+		 */
+		inline uint64_t getStreamLength(size_t streamIndex) const { return m_Streams.at(streamIndex).length; }
+
+		/**
+		 * Find a stream by its name
+		 * @param[in] name The name the stream was added with
+		 * @return The index of the first stream of this name, or -1 if there is no such stream
+		 */
+		int findStream(const std::string& name) const;
+
+		/**
+		 * Read the data of a stream
+		 * @param[in] streamIndex The index of the stream, from 0 to getNumOfStreams() - 1
+		 * @param[out] data The data of the stream
+		 * @return False if the file isn't open, the index isn't valid or the data can't be read (an error will be printed to log), true
+		 * otherwise
+		 */
+		bool readStream(size_t streamIndex, std::vector<uint8_t>& data);
+
+	private:
+		struct StreamIndex
+		{
+			std::string name;
+			uint64_t length;
+			std::vector<std::pair<uint64_t, uint64_t> > records;
+		};
+
+		std::string m_FileName;
+		FILE* m_File;
+		std::vector<StreamIndex> m_Streams;
+
+		// disable copy c'tor and assignment operator
+		StreamContainerReader(const StreamContainerReader& other);
+		StreamContainerReader& operator=(const StreamContainerReader& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_STREAM_SINK */
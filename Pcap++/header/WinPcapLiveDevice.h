@@ -32,14 +32,18 @@ namespace pcpp
 		WinPcapLiveDevice( const WinPcapLiveDevice& other );
 		WinPcapLiveDevice& operator=(const WinPcapLiveDevice& other);
 
+		// sends the batch in a single pcap_sendqueue
+		virtual int sendPacketBatch(const uint8_t* const* packetsData, const int* packetsLengths, int count);
+		// changes the buffer size and the minimum amount of data to copy of the current handle, only a new timeout needs a new handle
+		virtual bool applyAutoTuning(int changes);
+
 	public:
 		virtual LiveDeviceType getDeviceType() { return WinPcapDevice; }
 
 		bool startCapture(OnPacketArrivesCallback onPacketArrives, void* onPacketArrivesUserCookie, int intervalInSecondsToUpdateStats, OnStatsUpdateCallback onStatsUpdate, void* onStatsUpdateUsrrCookie);
 		bool startCapture(int intervalInSecondsToUpdateStats, OnStatsUpdateCallback onStatsUpdate, void* onStatsUpdateUserCookie);
 		bool startCapture(RawPacketVector& capturedPacketsVector) { return PcapLiveDevice::startCapture(capturedPacketsVector); }
-
-		virtual int sendPackets(RawPacket* rawPacketsArr, int arrLength);
+		bool startCapture(RawPacketSlabVector& capturedPacketsVector) { return PcapLiveDevice::startCapture(capturedPacketsVector); }
 
 		/**
 		 * WinPcap has an ability (that doesn't exist in libpcap) to change the minimum amount of data in the kernel buffer that causes a read
@@ -0,0 +1,415 @@
+#ifndef PCAPPP_XDP_DEVICE
+#define PCAPPP_XDP_DEVICE
+
+#include "Device.h"
+#include "RawPacket.h"
+#include "SystemUtils.h"
+#include <pthread.h>
+#include <string>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+/**
+ * The default number of descriptors of each ring of an XdpDevice queue (fill, completion, RX and TX rings)
+ */
+#define PCPP_XDP_DEFAULT_RING_SIZE 2048
+
+/**
+ * The default size of each frame of the UMEM (the packet buffer area) of an XdpDevice queue, which is the largest packet received or sent
+ */
+#define PCPP_XDP_DEFAULT_FRAME_SIZE 4096
+
+/**
+ * The maximum number of packets an XdpDevice capture thread receives at once and delivers in one callback call
+ */
+#define PCPP_XDP_MAX_CAPTURE_BURST 64
+
+	class XdpDevice;
+
+	/**
+	 * @typedef OnXdpPacketsArriveCallback
+	 * A callback that is called with the packets received by an XdpDevice capture thread
+	 * @param[in] packets An array of the received raw packets. The packet data isn't copied, it points into the UMEM of the queue, so the
+	 * packets are valid only until the callback returns
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] threadId The ID of the queue the packets were received on, which is also the ID of the capture thread
+	 * @param[in] device A pointer to the XdpDevice instance
+	 * @param[in] userCookie A pointer to the object put by the user when packet capturing started
+	 */
+	typedef void (*OnXdpPacketsArriveCallback)(RawPacket* packets, uint32_t numOfPackets, uint8_t threadId, XdpDevice* device, void* userCookie);
+
+	/**
+	 * @class XdpDevice
+	 * A device for receiving and sending packets on Linux network interfaces through AF_XDP sockets. An XDP program attached to the interface
+	 * redirects the packets of each opened NIC RX queue to an AF_XDP socket, which places them in the UMEM (a packet buffer area shared
+	 * with the kernel) of that queue. Where the driver supports it, the NIC writes the packets directly to the UMEM (zero-copy mode),
+	 * otherwise the kernel copies them (copy mode). Unlike DpdkDevice and PfRingDevice the interface stays owned by the kernel: packets of
+	 * queues which aren't opened, and packets arriving while no socket is open, continue to the kernel network stack.<BR>
+	 * Packets are received in bursts with receivePackets(), which doesn't copy them, or by capture threads (one per queue, pinned to cores)
+	 * started with startCapture(). Packets are sent in bursts with sendPackets(), which copies them to the UMEM.<BR>
+	 * Each queue may be used by one thread at a time. Please notice:
+	 * - The interface can't have another XDP program attached while the device is open
+	 * - To receive all packets of the interface all its RX queues must be opened, or the NIC must be set to spread packets only among
+	 *   the opened queues (for example with "ethtool -L eth0 combined 4")
+	 * - The packets have no hardware timestamps, they're timestamped when they're received by the application
+	 * - Filters which can be translated into flow rules (see GeneralFilter#toFlowRules()) are compiled into the XDP program, so packets
+	 *   which don't match them aren't redirected to the sockets at all and continue to the kernel network stack. Other filters are applied
+	 *   to the received packets in software
+	 * - Linux 5.4 or later is required, and opening the device requires the CAP_NET_ADMIN and CAP_NET_RAW capabilities (root)
+	 * - This device is supported on Linux only, opening it on other platforms fails
+	 */
+	class XdpDevice : public IDevice, public IFilterableDevice
+	{
+	public:
+
+		/**
+		 * How the XDP program is attached to the interface
+		 */
+		enum AttachMode
+		{
+			/** In the driver if it supports XDP, otherwise in the generic (SKB) path */
+			AttachAuto,
+			/** In the driver (native XDP). Opening the device fails if the driver doesn't support XDP */
+			AttachDriver,
+			/** In the generic (SKB) path, which works with any driver but is slower */
+			AttachGeneric
+		};
+
+		/**
+		 * How the AF_XDP sockets receive and send packets
+		 */
+		enum BindMode
+		{
+			/** Zero-copy if the driver supports it, otherwise copy */
+			BindAuto,
+			/** Zero-copy. Opening the device fails if the driver doesn't support it */
+			BindZeroCopy,
+			/** Copy */
+			BindCopy
+		};
+
+		/**
+		 * @struct XdpDeviceConfiguration
+		 * A structure for configuring XdpDevice
+		 */
+		struct XdpDeviceConfiguration
+		{
+			/** The number of queues to open, which are the NIC RX/TX queues 0 to numOfQueues-1. Each queue gets its own socket and UMEM */
+			uint8_t numOfQueues;
+
+			/** The number of descriptors of each of the fill, completion, RX and TX rings. It must be a power of 2. The UMEM of each queue
+			 * has twice this number of frames, half for receiving and half for sending
+			 */
+			uint32_t ringSize;
+
+			/** The size of each UMEM frame. It must be a power of 2 between 2048 and the page size */
+			uint32_t frameSize;
+
+			/** How the XDP program is attached to the interface */
+			AttachMode attachMode;
+
+			/** Whether the sockets use zero-copy mode */
+			BindMode bindMode;
+
+			/**
+			 * A c'tor for this struct
+			 * @param[in] numOfQueues The number of queues to open. Default is 1
+			 * @param[in] ringSize The number of descriptors of each ring. Default is #PCPP_XDP_DEFAULT_RING_SIZE
+			 * @param[in] frameSize The size of each UMEM frame. Default is #PCPP_XDP_DEFAULT_FRAME_SIZE
+			 * @param[in] attachMode How the XDP program is attached. Default is AttachAuto
+			 * @param[in] bindMode Whether the sockets use zero-copy mode. Default is BindAuto
+			 */
+			XdpDeviceConfiguration(uint8_t numOfQueues = 1, uint32_t ringSize = PCPP_XDP_DEFAULT_RING_SIZE, uint32_t frameSize = PCPP_XDP_DEFAULT_FRAME_SIZE,
+					AttachMode attachMode = AttachAuto, BindMode bindMode = BindAuto) :
+				numOfQueues(numOfQueues), ringSize(ringSize), frameSize(frameSize), attachMode(attachMode), bindMode(bindMode)
+			{
+			}
+		};
+
+		/**
+		 * @struct XdpStats
+		 * A container for XdpDevice statistics
+		 */
+		struct XdpStats
+		{
+			/** Number of packets received by the application */
+			uint64_t rxPackets;
+			/** Number of bytes received by the application */
+			uint64_t rxBytes;
+			/** Number of packets sent by the application */
+			uint64_t txPackets;
+			/** Number of bytes sent by the application */
+			uint64_t txBytes;
+			/** Number of packets the socket dropped, mostly because the RX ring was full or no UMEM frame was free */
+			uint64_t rxDropped;
+			/** Number of invalid RX descriptors */
+			uint64_t rxInvalidDescs;
+			/** Number of invalid TX descriptors */
+			uint64_t txInvalidDescs;
+		};
+
+		/**
+		 * A c'tor for this class. Nothing is set up until open() is called
+		 * @param[in] interfaceName The name of the network interface, for example "eth0"
+		 * @param[in] config The device configuration
+		 */
+		XdpDevice(const std::string& interfaceName, const XdpDeviceConfiguration& config = XdpDeviceConfiguration());
+
+		/**
+		 * A d'tor for this class. Stops the capture and closes the device if they're active
+		 */
+		~XdpDevice();
+
+		/**
+		 * @return The name of the network interface
+		 */
+		inline const std::string& getName() const { return m_InterfaceName; }
+
+		/**
+		 * @return The device configuration
+		 */
+		inline const XdpDeviceConfiguration& getConfiguration() const { return m_Config; }
+
+		/**
+		 * @return The number of queues opened, or 0 if the device isn't open
+		 */
+		inline uint8_t getNumOfOpenedQueues() const { return m_NumOfOpenedQueues; }
+
+		/**
+		 * @return True if the XDP program is attached in the driver (native XDP), false if it's attached in the generic path or the device
+		 * isn't open
+		 */
+		inline bool isDriverMode() const { return m_DriverMode; }
+
+		/**
+		 * @return True if all opened queues are in zero-copy mode, false otherwise
+		 */
+		bool isZeroCopy() const;
+
+		/**
+		 * Receive a burst of packets from an RX queue. The packets aren't copied, they point into the UMEM of the queue and are valid until the
+		 * next call to this method for the same queue, after which their frames are given back to the kernel. This method doesn't wait for
+		 * packets, it returns what the queue holds. It shouldn't be called for queues read by the capture threads of startCapture()
+		 * @param[in] rawPacketsArr An array of RawPacket objects the received packets are set to. The objects are reused by every call
+		 * @param[in] rawPacketArrLength The length of the array, which is the maximum number of packets received
+		 * @param[in] rxQueueId The ID of the queue to receive from
+		 * @return The number of packets received. 0 is returned if the queue is empty, the device isn't open or the queue ID is invalid
+		 * (an error is printed to log for the last two)
+		 */
+		uint16_t receivePackets(RawPacket* rawPacketsArr, uint16_t rawPacketArrLength, uint16_t rxQueueId);
+
+		/**
+		 * Send a burst of packets through a TX queue. The packets are copied to the UMEM of the queue, so they can be reused once the method
+		 * returns. Packets are sent from the beginning of the array until the TX ring or the free frames run out, or until a packet larger
+		 * than the frame size
+		 * @param[in] rawPacketsArr An array of the packets to send
+		 * @param[in] arrLength The number of packets in the array
+		 * @param[in] txQueueId The ID of the queue to send through. Default is 0
+		 * @return The number of packets sent, which are the first packets of the array
+		 */
+		uint16_t sendPackets(const RawPacket* rawPacketsArr, uint16_t arrLength, uint16_t txQueueId = 0);
+
+		/**
+		 * Send a burst of packets through a TX queue. See sendPackets(const RawPacket*, uint16_t, uint16_t)
+		 * @param[in] rawPackets A vector of the packets to send
+		 * @param[in] txQueueId The ID of the queue to send through. Default is 0
+		 * @return The number of packets sent, which are the first packets of the vector
+		 */
+		uint16_t sendPackets(const RawPacketVector& rawPackets, uint16_t txQueueId = 0);
+
+		/**
+		 * Send a single packet through a TX queue
+		 * @param[in] rawPacket The packet to send
+		 * @param[in] txQueueId The ID of the queue to send through. Default is 0
+		 * @return True if the packet was sent, false otherwise
+		 */
+		bool sendPacket(const RawPacket& rawPacket, uint16_t txQueueId = 0);
+
+		/**
+		 * Start capturing on all opened queues, each on a new thread pinned to one of the cores in the core mask. Queues are assigned to the
+		 * cores in ascending core ID order. Received packets are delivered in bursts of up to #PCPP_XDP_MAX_CAPTURE_BURST packets
+		 * @param[in] onPacketsArrive A callback that is called with each burst of packets
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object. This object will be transferred to the onPacketsArrive
+		 * callback each time it is called
+		 * @param[in] coreMask The cores to run the capture threads on. It must have exactly one core per opened queue
+		 * @return True if capture started successfully, false if the device isn't open, capture is already running, the callback is NULL,
+		 * the core mask doesn't match the number of queues or a capture thread could not be created (relevant log error is printed in any
+		 * case)
+		 */
+		bool startCapture(OnXdpPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, CoreMask coreMask);
+
+		/**
+		 * Start capturing on all opened queues, with the capture threads pinned to cores of the NUMA node of the interface, one core per
+		 * physical core over SMT (hyperthread) siblings (see selectNumaLocalCores())
+		 * @param[in] onPacketsArrive A callback that is called with each burst of packets
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object which is transferred to the callback
+		 * @return True if capture started successfully, false otherwise (relevant log error is printed in any case)
+		 */
+		bool startCapture(OnXdpPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie);
+
+		/**
+		 * Stop the capture threads. Each thread stops after the burst it's delivering, or within 100 milliseconds when there's no traffic
+		 */
+		void stopCapture();
+
+		/**
+		 * @return True if the capture threads are running
+		 */
+		inline bool captureActive() const { return m_CaptureThreadsStarted; }
+
+		/**
+		 * Set a filter on all opened queues, replacing the current one. When the filter can be translated into flow rules (see
+		 * GeneralFilter#toFlowRules()) it's compiled into the XDP program, which is replaced atomically: packets matching the filter are
+		 * redirected to the sockets and the rest continue to the kernel network stack. Otherwise the filter is applied in software, the same
+		 * way as setFilter(std::string) does. The filter can't be changed while the capture threads are running, and it's removed when the
+		 * device is closed
+		 * @param[in] filter The filter to set
+		 * @return True if the filter was set, false if the device isn't open, the capture threads are running or the filter is invalid
+		 */
+		bool setFilter(GeneralFilter& filter);
+
+		/**
+		 * Set a BPF filter on all opened queues, replacing the current one. BPF strings aren't compiled into the XDP program, so the filter
+		 * is applied to the received packets in software, and the frames of packets which don't match it are given back to the kernel
+		 * without being returned. The filter can't be changed while the capture threads are running, and it's removed when the device is
+		 * closed
+		 * @param[in] filterAsString The filter in Berkeley Packet Filter (BPF) syntax
+		 * @return True if the filter was set, false if the device isn't open, the capture threads are running or the filter is invalid
+		 */
+		bool setFilter(std::string filterAsString);
+
+		/**
+		 * Remove the current filter, restoring the XDP program which redirects all packets if the filter was compiled into it
+		 * @return True if the filter was removed or no filter was set, false if the capture threads are running or the XDP program couldn't
+		 * be restored
+		 */
+		bool clearFilter();
+
+		/**
+		 * @return True if a filter is currently set
+		 */
+		inline bool isFilterCurrentlySet() const { return m_IsFilterOffloaded || m_SoftwareFilter != NULL; }
+
+		/**
+		 * @return True if the current filter is compiled into the XDP program, false if it's applied in software or no filter is set
+		 */
+		inline bool isFilterOffloaded() const { return m_IsFilterOffloaded; }
+
+		/**
+		 * Get the statistics of a single queue since the device was opened
+		 * @param[in] queueId The ID of the queue
+		 * @param[out] stats The object the statistics are written to
+		 */
+		void getQueueStatistics(uint8_t queueId, XdpStats& stats);
+
+		/**
+		 * Get the statistics of all queues together since the device was opened
+		 * @param[out] stats The object the statistics are written to
+		 */
+		void getStatistics(XdpStats& stats);
+
+		/**
+		 * Report the getStatistics() counters of all queues to a MetricsRegistry snapshot
+		 * @param[in] writer The writer to report the values to
+		 */
+		void collectMetrics(MetricsWriter& writer);
+
+		// implement abstract methods
+
+		/**
+		 * Load the XDP program and attach it to the interface, and create the sockets, UMEMs and rings of all queues
+		 * @return True if the device was opened, false otherwise (an error is printed to log)
+		 */
+		bool open();
+
+		/**
+		 * Stop the capture if it's running, detach the XDP program from the interface and close the sockets
+		 */
+		void close();
+
+	private:
+
+		// a ring shared with the kernel. The producer and consumer indexes run freely and are masked to get the descriptor position
+		struct XdpRing
+		{
+			uint32_t* producer;
+			uint32_t* consumer;
+			uint32_t* flags;
+			void* descs;
+			void* map;
+			size_t mapSize;
+		};
+
+		struct XdpQueue
+		{
+			int fd;
+			uint8_t* umem;
+			size_t umemSize;
+			XdpRing fillRing;
+			XdpRing completionRing;
+			XdpRing rxRing;
+			XdpRing txRing;
+			bool zeroCopy;
+			// frames of the packets last returned by receivePackets(), given back to the fill ring on the next call
+			uint64_t* heldFrames;
+			uint32_t numOfHeldFrames;
+			// TX frames which aren't in the TX ring or the completion ring
+			uint64_t* freeTxFrames;
+			uint32_t numOfFreeTxFrames;
+			RawPacket* capturePackets;
+			XdpStats stats;
+			pthread_t thread;
+			int coreId;
+			XdpDevice* device;
+			uint8_t id;
+		};
+
+		std::string m_InterfaceName;
+		XdpDeviceConfiguration m_Config;
+		XdpQueue* m_Queues;
+		uint8_t m_NumOfOpenedQueues;
+		int m_InterfaceIndex;
+		int m_XskMapFd;
+		int m_ProgramFd;
+		bool m_ProgramAttached;
+		bool m_DriverMode;
+		bool m_CaptureThreadsStarted;
+		volatile bool m_StopThreads;
+		OnXdpPacketsArriveCallback m_OnPacketsArrive;
+		void* m_OnPacketsArriveUserCookie;
+		BPFStringFilter* m_SoftwareFilter;
+		bool m_IsFilterOffloaded;
+
+		bool loadProgram();
+		int loadXdpProgram(const std::vector<FilterFlowRule>* rules);
+		bool replaceProgram(const std::vector<FilterFlowRule>* rules);
+		void freeSoftwareFilter();
+		bool attachProgram(bool driverMode);
+		void detachProgram();
+		bool openQueue(XdpQueue& queue);
+		void closeQueue(XdpQueue& queue);
+		bool mapRing(XdpQueue& queue, XdpRing& ring, uint64_t offset, const void* ringOffsets, size_t descSize);
+		void refillQueue(XdpQueue& queue);
+		void reclaimTxFrames(XdpQueue& queue);
+		XdpQueue* getQueue(uint16_t queueId);
+		uint16_t receivePacketsFromQueue(XdpQueue& queue, RawPacket* rawPacketsArr, uint16_t rawPacketArrLength);
+		uint32_t prepareSend(XdpQueue& queue, uint32_t numOfPackets);
+		bool writeTxDescriptor(XdpQueue& queue, const RawPacket& rawPacket, uint32_t index);
+		void commitSend(XdpQueue& queue, uint32_t numOfPackets);
+		static void* captureThreadMain(void* queuePtr);
+
+		// disable copy c'tor and assignment operator
+		XdpDevice(const XdpDevice& other);
+		XdpDevice& operator=(const XdpDevice& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_XDP_DEVICE */
@@ -0,0 +1,742 @@
+#define LOG_MODULE PcapLogModuleArrowFileWriter
+
+#include "ArrowFileWriter.h"
+#include "Logger.h"
+#include <string.h>
+
+namespace pcpp
+{
+
+// values of the Arrow metadata enums and unions, see Schema.fbs, Message.fbs and File.fbs of the Arrow format
+#define ARROW_METADATA_VERSION_V5 4
+#define ARROW_MESSAGE_SCHEMA 1
+#define ARROW_MESSAGE_DICTIONARY_BATCH 2
+#define ARROW_MESSAGE_RECORD_BATCH 3
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_UTF8 5
+#define ARROW_TYPE_TIMESTAMP 10
+#define ARROW_TIME_UNIT_MILLISECOND 1
+#define ARROW_TIME_UNIT_NANOSECOND 3
+
+// the magic string a file starts and ends with, padded to 8 bytes at the beginning of the file
+static const char ArrowMagic[8] = { 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+#define ARROW_MAGIC_LEN 6
+
+// the marker preceding the length of every message
+#define ARROW_CONTINUATION_MARKER 0xffffffff
+
+#define ARROW_DICTIONARY_INITIAL_HASH_TABLE_SIZE 1024
+
+static inline size_t alignTo8(size_t value)
+{
+	return (value + 7) & ~((size_t)7);
+}
+
+static inline void putLittleEndian(std::vector<uint8_t>& buffer, uint64_t value, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		buffer.push_back((uint8_t)(value >> (8 * i)));
+}
+
+static inline void setLittleEndian(uint8_t* data, uint64_t value, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		data[i] = (uint8_t)(value >> (8 * i));
+}
+
+// FNV-1a
+static inline uint32_t hashString(const char* value, size_t length)
+{
+	uint32_t hash = 2166136261U;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= (uint8_t)value[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+
+// A minimal FlatBuffers encoder for the Arrow metadata. Unlike the FlatBuffers library it builds the buffer front to back: a table is
+// written before the objects it references and their offsets are set once they're written (FlatBuffers offsets always point forward).
+// Every table is preceded by its own vtable, and table fields are aligned to their size relative to the beginning of the buffer
+class FlatBufferBuilder
+{
+public:
+	enum { MaxFields = 8 };
+
+	FlatBufferBuilder(std::vector<uint8_t>& buffer) : m_Buffer(buffer), m_NumOfFields(0)
+	{
+		m_Buffer.clear();
+		// the offset of the root table, set by setRoot()
+		putLittleEndian(m_Buffer, 0, 4);
+	}
+
+	inline size_t getPosition() const { return m_Buffer.size(); }
+
+	inline void put(uint64_t value, size_t size) { putLittleEndian(m_Buffer, value, size); }
+
+	inline void startTable() { m_NumOfFields = 0; }
+
+	inline void addScalar(int id, uint64_t value, uint8_t size) { addField(id, value, size); }
+
+	// an offset field, set with setOffset() once the object it references is written
+	inline void addOffset(int id) { addField(id, 0, 4); }
+
+	// write the table and its vtable, and return the table position. The positions of the fields are available through
+	// getFieldPosition() until the next table is written
+	size_t endTable()
+	{
+		int numOfSlots = 0;
+		for (int i = 0; i < m_NumOfFields; i++)
+		{
+			if (m_Fields[i].id + 1 > numOfSlots)
+				numOfSlots = m_Fields[i].id + 1;
+		}
+
+		// the table follows the vtable, and its fields follow the offset to the vtable from the largest to the smallest
+		alignTo(2);
+		size_t vtablePos = m_Buffer.size();
+		size_t vtableSize = 4 + 2 * numOfSlots;
+		size_t tablePos = (vtablePos + vtableSize + 3) & ~((size_t)3);
+
+		uint16_t fieldOffsets[MaxFields];
+		memset(fieldOffsets, 0, sizeof(fieldOffsets));
+		size_t tableSize = 4;
+		for (uint8_t size = 8; size > 0; size /= 2)
+		{
+			for (int i = 0; i < m_NumOfFields; i++)
+			{
+				if (m_Fields[i].size != size)
+					continue;
+				while ((tablePos + tableSize) % size != 0)
+					tableSize++;
+				fieldOffsets[m_Fields[i].id] = (uint16_t)tableSize;
+				tableSize += size;
+			}
+		}
+
+		put(vtableSize, 2);
+		put(tableSize, 2);
+		for (int i = 0; i < numOfSlots; i++)
+			put(fieldOffsets[i], 2);
+
+		alignTo(4);
+		put(tablePos - vtablePos, 4);
+		m_Buffer.resize(tablePos + tableSize, 0);
+		for (int i = 0; i < m_NumOfFields; i++)
+		{
+			m_FieldPositions[m_Fields[i].id] = tablePos + fieldOffsets[m_Fields[i].id];
+			setLittleEndian(&m_Buffer[m_FieldPositions[m_Fields[i].id]], m_Fields[i].value, m_Fields[i].size);
+		}
+
+		return tablePos;
+	}
+
+	inline size_t getFieldPosition(int id) const { return m_FieldPositions[id]; }
+
+	inline void setOffset(size_t fieldPosition, size_t objectPosition)
+	{
+		setLittleEndian(&m_Buffer[fieldPosition], objectPosition - fieldPosition, 4);
+	}
+
+	inline void setRoot(size_t tablePosition) { setOffset(0, tablePosition); }
+
+	size_t addString(const std::string& value)
+	{
+		alignTo(4);
+		size_t pos = m_Buffer.size();
+		put(value.length(), 4);
+		m_Buffer.insert(m_Buffer.end(), value.begin(), value.end());
+		m_Buffer.push_back(0);
+		return pos;
+	}
+
+	// start a vector of scalars, structs or offsets: its length is written and the caller puts the elements right after it
+	size_t startVector(size_t numOfElements, size_t elementAlignment)
+	{
+		alignTo(4);
+		while ((m_Buffer.size() + 4) % elementAlignment != 0)
+			m_Buffer.push_back(0);
+		size_t pos = m_Buffer.size();
+		put(numOfElements, 4);
+		return pos;
+	}
+
+	inline void alignTo(size_t alignment)
+	{
+		while (m_Buffer.size() % alignment != 0)
+			m_Buffer.push_back(0);
+	}
+
+private:
+	struct Field
+	{
+		int id;
+		uint64_t value;
+		uint8_t size;
+	};
+
+	std::vector<uint8_t>& m_Buffer;
+	Field m_Fields[MaxFields];
+	int m_NumOfFields;
+	size_t m_FieldPositions[MaxFields];
+
+	inline void addField(int id, uint64_t value, uint8_t size)
+	{
+		m_Fields[m_NumOfFields].id = id;
+		m_Fields[m_NumOfFields].value = value;
+		m_Fields[m_NumOfFields].size = size;
+		m_NumOfFields++;
+	}
+};
+
+
+// an Int type table
+static size_t writeIntType(FlatBufferBuilder& builder, int bitWidth, bool isSigned)
+{
+	builder.startTable();
+	builder.addScalar(0, bitWidth, 4);
+	builder.addScalar(1, isSigned ? 1 : 0, 1);
+	return builder.endTable();
+}
+
+// the column descriptions the schema is written from
+struct ArrowField
+{
+	const std::string* name;
+	ArrowFileWriter::ColumnType type;
+	bool nullable;
+
+	ArrowField(const std::string& name, ArrowFileWriter::ColumnType type, bool nullable) : name(&name), type(type), nullable(nullable) {}
+};
+
+// a Field table. The type of a dictionary encoded column is the type of its values, and its indices are described by the dictionary
+// encoding, whose ID is the column index
+static size_t writeField(FlatBufferBuilder& builder, const ArrowField& field, size_t columnIndex)
+{
+	bool isString = (field.type == ArrowFileWriter::StringColumn);
+	bool isTimestamp = (field.type == ArrowFileWriter::TimestampNsColumn || field.type == ArrowFileWriter::TimestampMsColumn);
+
+	builder.startTable();
+	builder.addOffset(0);
+	builder.addScalar(1, field.nullable ? 1 : 0, 1);
+	builder.addScalar(2, isString ? ARROW_TYPE_UTF8 : (isTimestamp ? ARROW_TYPE_TIMESTAMP : ARROW_TYPE_INT), 1);
+	builder.addOffset(3);
+	if (isString)
+		builder.addOffset(4);
+	builder.addOffset(5);
+	size_t fieldPos = builder.endTable();
+	size_t nameFieldPos = builder.getFieldPosition(0);
+	size_t typeFieldPos = builder.getFieldPosition(3);
+	size_t dictionaryFieldPos = (isString ? builder.getFieldPosition(4) : 0);
+	size_t childrenFieldPos = builder.getFieldPosition(5);
+
+	builder.setOffset(nameFieldPos, builder.addString(*field.name));
+
+	size_t typePos;
+	if (isString)
+	{
+		// Utf8 has no fields
+		builder.startTable();
+		typePos = builder.endTable();
+	}
+	else if (isTimestamp)
+	{
+		builder.startTable();
+		builder.addScalar(0, field.type == ArrowFileWriter::TimestampNsColumn ? ARROW_TIME_UNIT_NANOSECOND : ARROW_TIME_UNIT_MILLISECOND, 2);
+		builder.addOffset(1);
+		typePos = builder.endTable();
+		size_t timezoneFieldPos = builder.getFieldPosition(1);
+		builder.setOffset(timezoneFieldPos, builder.addString("UTC"));
+	}
+	else
+	{
+		int bitWidth = (field.type == ArrowFileWriter::UInt8Column ? 8 : (field.type == ArrowFileWriter::UInt16Column ? 16 :
+				(field.type == ArrowFileWriter::UInt32Column ? 32 : 64)));
+		typePos = writeIntType(builder, bitWidth, false);
+	}
+	builder.setOffset(typeFieldPos, typePos);
+
+	if (isString)
+	{
+		builder.startTable();
+		builder.addScalar(0, columnIndex, 8);
+		builder.addOffset(1);
+		builder.addScalar(2, 0, 1);
+		size_t dictionaryPos = builder.endTable();
+		size_t indexTypeFieldPos = builder.getFieldPosition(1);
+		builder.setOffset(dictionaryFieldPos, dictionaryPos);
+		builder.setOffset(indexTypeFieldPos, writeIntType(builder, 32, true));
+	}
+
+	// readers require the children vector even for types which have no children
+	builder.setOffset(childrenFieldPos, builder.startVector(0, 4));
+
+	return fieldPos;
+}
+
+// a Schema table
+static size_t writeSchema(FlatBufferBuilder& builder, const std::vector<ArrowField>& fields)
+{
+	builder.startTable();
+	// little endian
+	builder.addScalar(0, 0, 2);
+	builder.addOffset(1);
+	size_t schemaPos = builder.endTable();
+	size_t fieldsFieldPos = builder.getFieldPosition(1);
+
+	size_t vectorPos = builder.startVector(fields.size(), 4);
+	for (size_t i = 0; i < fields.size(); i++)
+		builder.put(0, 4);
+	builder.setOffset(fieldsFieldPos, vectorPos);
+
+	for (size_t i = 0; i < fields.size(); i++)
+		builder.setOffset(vectorPos + 4 + 4 * i, writeField(builder, fields[i], i));
+
+	return schemaPos;
+}
+
+// a RecordBatch table with its field nodes and buffers, each given as pairs of values
+static size_t writeRecordBatch(FlatBufferBuilder& builder, uint64_t length, const std::vector<uint64_t>& nodes, const std::vector<uint64_t>& buffers)
+{
+	builder.startTable();
+	builder.addScalar(0, length, 8);
+	builder.addOffset(1);
+	builder.addOffset(2);
+	size_t recordBatchPos = builder.endTable();
+	size_t nodesFieldPos = builder.getFieldPosition(1);
+	size_t buffersFieldPos = builder.getFieldPosition(2);
+
+	size_t vectorPos = builder.startVector(nodes.size() / 2, 8);
+	for (size_t i = 0; i < nodes.size(); i++)
+		builder.put(nodes[i], 8);
+	builder.setOffset(nodesFieldPos, vectorPos);
+
+	vectorPos = builder.startVector(buffers.size() / 2, 8);
+	for (size_t i = 0; i < buffers.size(); i++)
+		builder.put(buffers[i], 8);
+	builder.setOffset(buffersFieldPos, vectorPos);
+
+	return recordBatchPos;
+}
+
+// a Message table whose header is written by the caller right after it. Returns the position of the header offset field
+static size_t writeMessageTable(FlatBufferBuilder& builder, uint8_t headerType, uint64_t bodyLength)
+{
+	builder.startTable();
+	builder.addScalar(0, ARROW_METADATA_VERSION_V5, 2);
+	builder.addScalar(1, headerType, 1);
+	builder.addOffset(2);
+	builder.addScalar(3, bodyLength, 8);
+	builder.setRoot(builder.endTable());
+	return builder.getFieldPosition(2);
+}
+
+// append a buffer to a message body, padded to 8 bytes, and add its offset and length to the buffer list of a record batch
+static void addBodyBuffer(std::vector<uint8_t>& body, std::vector<uint64_t>& buffers, const void* data, size_t length)
+{
+	buffers.push_back(body.size());
+	buffers.push_back(length);
+	if (length > 0)
+		body.insert(body.end(), (const uint8_t*)data, (const uint8_t*)data + length);
+	body.resize(alignTo8(body.size()), 0);
+}
+
+
+ArrowFileWriter::ArrowFileWriter(const std::string& fileName, size_t rowsPerBatch) :
+		m_FileName(fileName), m_RowsPerBatch(rowsPerBatch > 0 ? rowsPerBatch : 1), m_File(NULL), m_FileOffset(0), m_Closed(false),
+		m_NumOfBufferedRows(0), m_NumOfRows(0)
+{
+}
+
+ArrowFileWriter::~ArrowFileWriter()
+{
+	if (m_File != NULL)
+		close();
+}
+
+int ArrowFileWriter::addColumn(const std::string& name, ColumnType type, bool nullable)
+{
+	if (m_File != NULL || m_Closed)
+	{
+		LOG_ERROR("Columns can't be added after the writer is opened");
+		return -1;
+	}
+
+	Column column;
+	column.name = name;
+	column.type = type;
+	column.nullable = nullable;
+	switch (type)
+	{
+	case UInt8Column:
+		column.width = 1;
+		break;
+	case UInt16Column:
+		column.width = 2;
+		break;
+	case UInt32Column:
+	case StringColumn:
+		column.width = 4;
+		break;
+	default:
+		column.width = 8;
+		break;
+	}
+	column.nullCount = 0;
+	column.rowValue = 0;
+	column.rowValueSet = false;
+	if (type == StringColumn)
+	{
+		column.dictionaryOffsets.push_back(0);
+		column.dictionaryHashTable.resize(ARROW_DICTIONARY_INITIAL_HASH_TABLE_SIZE, -1);
+	}
+
+	m_Columns.push_back(column);
+	return (int)m_Columns.size() - 1;
+}
+
+size_t ArrowFileWriter::getDictionarySize(int column) const
+{
+	if (column < 0 || column >= (int)m_Columns.size() || m_Columns[column].type != StringColumn)
+		return 0;
+
+	return m_Columns[column].dictionaryOffsets.size() - 1;
+}
+
+bool ArrowFileWriter::open()
+{
+	if (m_File != NULL || m_Closed)
+	{
+		LOG_ERROR("Writer for '%s' was already opened", m_FileName.c_str());
+		return false;
+	}
+
+	if (m_Columns.empty())
+	{
+		LOG_ERROR("Can't open writer for '%s' without columns", m_FileName.c_str());
+		return false;
+	}
+
+	m_File = fopen(m_FileName.c_str(), "wb");
+	if (m_File == NULL)
+	{
+		LOG_ERROR("Couldn't create file '%s'", m_FileName.c_str());
+		return false;
+	}
+
+	m_FileOffset = 0;
+	if (!writeData(ArrowMagic, sizeof(ArrowMagic)))
+		return false;
+
+	// the schema message has no body
+	buildSchema();
+	m_Body.clear();
+	return writeMessage(NULL);
+}
+
+void ArrowFileWriter::setValue(int column, uint64_t value)
+{
+	if (column < 0 || column >= (int)m_Columns.size() || m_Columns[column].type == StringColumn)
+		return;
+
+	m_Columns[column].rowValue = value;
+	m_Columns[column].rowValueSet = true;
+}
+
+void ArrowFileWriter::setString(int column, const char* value, size_t length)
+{
+	if (column < 0 || column >= (int)m_Columns.size() || m_Columns[column].type != StringColumn)
+		return;
+
+	int32_t index = findOrAddDictionaryValue(m_Columns[column], value, length);
+	if (index < 0)
+		return;
+
+	m_Columns[column].rowValue = (uint64_t)index;
+	m_Columns[column].rowValueSet = true;
+}
+
+int32_t ArrowFileWriter::findOrAddDictionaryValue(Column& column, const char* value, size_t length)
+{
+	size_t mask = column.dictionaryHashTable.size() - 1;
+	size_t slot = hashString(value, length) & mask;
+	while (column.dictionaryHashTable[slot] >= 0)
+	{
+		int32_t index = column.dictionaryHashTable[slot];
+		size_t valueOffset = (size_t)column.dictionaryOffsets[index];
+		size_t valueLength = (size_t)column.dictionaryOffsets[index + 1] - valueOffset;
+		if (valueLength == length && (length == 0 || memcmp(&column.dictionaryData[valueOffset], value, length) == 0))
+			return index;
+		slot = (slot + 1) & mask;
+	}
+
+	// Arrow string offsets are 32-bit
+	if (column.dictionaryData.size() + length > 0x7fffffff)
+	{
+		LOG_ERROR("Dictionary of column '%s' exceeds the maximum size", column.name.c_str());
+		return -1;
+	}
+
+	int32_t index = (int32_t)column.dictionaryOffsets.size() - 1;
+	column.dictionaryData.insert(column.dictionaryData.end(), value, value + length);
+	column.dictionaryOffsets.push_back((int32_t)column.dictionaryData.size());
+	column.dictionaryHashTable[slot] = index;
+
+	if ((size_t)(index + 1) * 2 > column.dictionaryHashTable.size())
+		growDictionaryHashTable(column);
+
+	return index;
+}
+
+void ArrowFileWriter::growDictionaryHashTable(Column& column)
+{
+	column.dictionaryHashTable.assign(column.dictionaryHashTable.size() * 2, -1);
+	size_t mask = column.dictionaryHashTable.size() - 1;
+	size_t numOfValues = column.dictionaryOffsets.size() - 1;
+	for (size_t index = 0; index < numOfValues; index++)
+	{
+		const char* value = column.dictionaryData.empty() ? "" : &column.dictionaryData[column.dictionaryOffsets[index]];
+		size_t slot = hashString(value, column.dictionaryOffsets[index + 1] - column.dictionaryOffsets[index]) & mask;
+		while (column.dictionaryHashTable[slot] >= 0)
+			slot = (slot + 1) & mask;
+		column.dictionaryHashTable[slot] = (int32_t)index;
+	}
+}
+
+bool ArrowFileWriter::endRow()
+{
+	if (m_File == NULL)
+	{
+		LOG_ERROR("Writer for '%s' isn't open", m_FileName.c_str());
+		return false;
+	}
+
+	for (std::vector<Column>::iterator iter = m_Columns.begin(); iter != m_Columns.end(); iter++)
+	{
+		Column& column = *iter;
+		bool isValid = column.rowValueSet || !column.nullable;
+		uint64_t value = column.rowValue;
+		if (!column.rowValueSet)
+			value = (column.type == StringColumn && !column.nullable ? (uint64_t)findOrAddDictionaryValue(column, "", 0) : 0);
+
+		putLittleEndian(column.values, value, column.width);
+
+		if (m_NumOfBufferedRows % 8 == 0)
+			column.validity.push_back(0);
+		if (isValid)
+			column.validity.back() |= (uint8_t)(1 << (m_NumOfBufferedRows % 8));
+		else
+			column.nullCount++;
+
+		column.rowValue = 0;
+		column.rowValueSet = false;
+	}
+
+	m_NumOfBufferedRows++;
+	m_NumOfRows++;
+	if (m_NumOfBufferedRows >= m_RowsPerBatch)
+		return flush();
+
+	return true;
+}
+
+bool ArrowFileWriter::flush()
+{
+	if (m_File == NULL)
+	{
+		LOG_ERROR("Writer for '%s' isn't open", m_FileName.c_str());
+		return false;
+	}
+
+	if (m_NumOfBufferedRows == 0)
+		return true;
+
+	// a validity buffer is needed only if the column has nulls
+	std::vector<uint64_t> nodes, buffers;
+	m_Body.clear();
+	for (std::vector<Column>::iterator iter = m_Columns.begin(); iter != m_Columns.end(); iter++)
+	{
+		nodes.push_back(m_NumOfBufferedRows);
+		nodes.push_back(iter->nullCount);
+		addBodyBuffer(m_Body, buffers, iter->validity.empty() ? NULL : &iter->validity[0], iter->nullCount > 0 ? iter->validity.size() : 0);
+		addBodyBuffer(m_Body, buffers, &iter->values[0], iter->values.size());
+	}
+
+	FlatBufferBuilder builder(m_Metadata);
+	size_t headerFieldPos = writeMessageTable(builder, ARROW_MESSAGE_RECORD_BATCH, m_Body.size());
+	builder.setOffset(headerFieldPos, writeRecordBatch(builder, m_NumOfBufferedRows, nodes, buffers));
+
+	for (std::vector<Column>::iterator iter = m_Columns.begin(); iter != m_Columns.end(); iter++)
+	{
+		iter->values.clear();
+		iter->validity.clear();
+		iter->nullCount = 0;
+	}
+	m_NumOfBufferedRows = 0;
+
+	Block block;
+	if (!writeMessage(&block))
+		return false;
+
+	m_RecordBatchBlocks.push_back(block);
+	return true;
+}
+
+bool ArrowFileWriter::close()
+{
+	if (m_File == NULL)
+	{
+		LOG_ERROR("Writer for '%s' isn't open", m_FileName.c_str());
+		return false;
+	}
+
+	bool result = flush();
+
+	// the dictionaries, which are complete only now. The file format lets them follow the record batches which use them
+	for (size_t i = 0; result && i < m_Columns.size(); i++)
+	{
+		Column& column = m_Columns[i];
+		if (column.type != StringColumn)
+			continue;
+
+		size_t numOfValues = column.dictionaryOffsets.size() - 1;
+		std::vector<uint64_t> nodes, buffers;
+		nodes.push_back(numOfValues);
+		nodes.push_back(0);
+		m_Body.clear();
+		addBodyBuffer(m_Body, buffers, NULL, 0);
+		std::vector<uint8_t> offsets;
+		offsets.reserve(column.dictionaryOffsets.size() * 4);
+		for (std::vector<int32_t>::iterator iter = column.dictionaryOffsets.begin(); iter != column.dictionaryOffsets.end(); iter++)
+			putLittleEndian(offsets, (uint32_t)*iter, 4);
+		addBodyBuffer(m_Body, buffers, &offsets[0], offsets.size());
+		addBodyBuffer(m_Body, buffers, column.dictionaryData.empty() ? NULL : &column.dictionaryData[0], column.dictionaryData.size());
+
+		FlatBufferBuilder builder(m_Metadata);
+		size_t headerFieldPos = writeMessageTable(builder, ARROW_MESSAGE_DICTIONARY_BATCH, m_Body.size());
+		builder.startTable();
+		builder.addScalar(0, i, 8);
+		builder.addOffset(1);
+		builder.addScalar(2, 0, 1);
+		size_t dictionaryBatchPos = builder.endTable();
+		size_t dataFieldPos = builder.getFieldPosition(1);
+		builder.setOffset(headerFieldPos, dictionaryBatchPos);
+		builder.setOffset(dataFieldPos, writeRecordBatch(builder, numOfValues, nodes, buffers));
+
+		Block block;
+		result = writeMessage(&block);
+		if (result)
+			m_DictionaryBlocks.push_back(block);
+	}
+
+	if (result)
+	{
+		// the end-of-stream marker, the footer, its length and the magic string
+		std::vector<uint8_t> trailer;
+		putLittleEndian(trailer, ARROW_CONTINUATION_MARKER, 4);
+		putLittleEndian(trailer, 0, 4);
+		result = writeData(&trailer[0], trailer.size());
+	}
+
+	if (result)
+	{
+		buildFooter();
+		std::vector<uint8_t> footerLength;
+		putLittleEndian(footerLength, m_Metadata.size(), 4);
+		result = writeData(&m_Metadata[0], m_Metadata.size()) && writeData(&footerLength[0], footerLength.size()) &&
+				writeData(ArrowMagic, ARROW_MAGIC_LEN);
+	}
+
+	if (fclose(m_File) != 0 && result)
+	{
+		LOG_ERROR("Couldn't close file '%s'", m_FileName.c_str());
+		result = false;
+	}
+
+	m_File = NULL;
+	m_Closed = true;
+	return result;
+}
+
+void ArrowFileWriter::buildSchema()
+{
+	std::vector<ArrowField> fields;
+	for (std::vector<Column>::iterator iter = m_Columns.begin(); iter != m_Columns.end(); iter++)
+		fields.push_back(ArrowField(iter->name, iter->type, iter->nullable));
+
+	FlatBufferBuilder builder(m_Metadata);
+	size_t headerFieldPos = writeMessageTable(builder, ARROW_MESSAGE_SCHEMA, 0);
+	builder.setOffset(headerFieldPos, writeSchema(builder, fields));
+}
+
+void ArrowFileWriter::buildFooter()
+{
+	std::vector<ArrowField> fields;
+	for (std::vector<Column>::iterator iter = m_Columns.begin(); iter != m_Columns.end(); iter++)
+		fields.push_back(ArrowField(iter->name, iter->type, iter->nullable));
+
+	FlatBufferBuilder builder(m_Metadata);
+	builder.startTable();
+	builder.addScalar(0, ARROW_METADATA_VERSION_V5, 2);
+	builder.addOffset(1);
+	builder.addOffset(2);
+	builder.addOffset(3);
+	size_t footerPos = builder.endTable();
+	size_t schemaFieldPos = builder.getFieldPosition(1);
+	size_t dictionariesFieldPos = builder.getFieldPosition(2);
+	size_t recordBatchesFieldPos = builder.getFieldPosition(3);
+	builder.setRoot(footerPos);
+	builder.setOffset(schemaFieldPos, writeSchema(builder, fields));
+
+	// Block structs: the offset, the metadata length (padded to 8 bytes) and the body length
+	for (int i = 0; i < 2; i++)
+	{
+		const std::vector<Block>& blocks = (i == 0 ? m_DictionaryBlocks : m_RecordBatchBlocks);
+		size_t vectorPos = builder.startVector(blocks.size(), 8);
+		for (std::vector<Block>::const_iterator iter = blocks.begin(); iter != blocks.end(); iter++)
+		{
+			builder.put(iter->offset, 8);
+			builder.put(iter->metadataLength, 4);
+			builder.put(0, 4);
+			builder.put(iter->bodyLength, 8);
+		}
+		builder.setOffset(i == 0 ? dictionariesFieldPos : recordBatchesFieldPos, vectorPos);
+	}
+}
+
+bool ArrowFileWriter::writeData(const void* data, size_t length)
+{
+	if (length > 0 && fwrite(data, 1, length, m_File) != length)
+	{
+		LOG_ERROR("Couldn't write to file '%s'", m_FileName.c_str());
+		return false;
+	}
+
+	m_FileOffset += length;
+	return true;
+}
+
+bool ArrowFileWriter::writeMessage(Block* block)
+{
+	// the metadata is padded so the body starts at a multiple of 8 bytes
+	size_t metadataLength = alignTo8(m_Metadata.size());
+	m_Metadata.resize(metadataLength, 0);
+
+	std::vector<uint8_t> prefix;
+	putLittleEndian(prefix, ARROW_CONTINUATION_MARKER, 4);
+	putLittleEndian(prefix, metadataLength, 4);
+
+	if (block != NULL)
+	{
+		block->offset = m_FileOffset;
+		block->metadataLength = (uint32_t)(prefix.size() + metadataLength);
+		block->bodyLength = m_Body.size();
+	}
+
+	return writeData(&prefix[0], prefix.size()) && writeData(&m_Metadata[0], m_Metadata.size()) &&
+			(m_Body.empty() || writeData(&m_Body[0], m_Body.size()));
+}
+
+} // namespace pcpp
@@ -0,0 +1,358 @@
+#define LOG_MODULE PcapLogModuleBenchmarkHarness
+
+#include "BenchmarkHarness.h"
+#include "PcapFileDevice.h"
+#include "LatencyTracer.h"
+#include "TablePrinter.h"
+#include "Logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+namespace pcpp
+{
+
+// parse a positive number of iterations, return -1 if the value isn't valid
+static int parseIterations(const char* value, bool allowZero)
+{
+	char* end = NULL;
+	long result = strtol(value, &end, 10);
+	if (end == value || *end != '\0' || result < (allowZero ? 0 : 1) || result > 1000000)
+		return -1;
+
+	return (int)result;
+}
+
+bool BenchmarkHarness::extractOptions(int& argc, char* argv[], BenchmarkConfiguration& config)
+{
+	int newArgc = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+
+		// stop at "--" like getopt does, the rest are non-option arguments
+		if (strcmp(arg, "--") == 0)
+		{
+			for (; i < argc; i++)
+				argv[newArgc++] = argv[i];
+			break;
+		}
+
+		if (strcmp(arg, "--benchmark") == 0)
+		{
+			config.enabled = true;
+		}
+		else if (strncmp(arg, "--benchmark=", 12) == 0)
+		{
+			int iterations = parseIterations(arg + 12, false);
+			if (iterations < 0)
+			{
+				LOG_ERROR("Invalid number of benchmark iterations: '%s'", arg + 12);
+				return false;
+			}
+			config.enabled = true;
+			config.iterations = iterations;
+		}
+		else if (strncmp(arg, "--benchmark-warmup=", 19) == 0)
+		{
+			int iterations = parseIterations(arg + 19, true);
+			if (iterations < 0)
+			{
+				LOG_ERROR("Invalid number of benchmark warm-up iterations: '%s'", arg + 19);
+				return false;
+			}
+			config.warmupIterations = iterations;
+		}
+		else if (strncmp(arg, "--benchmark-json=", 17) == 0)
+		{
+			if (arg[17] == '\0')
+			{
+				LOG_ERROR("Benchmark JSON output file name is empty");
+				return false;
+			}
+			config.jsonOutputFile = arg + 17;
+		}
+		else if (strcmp(arg, "--benchmark-hw-counters") == 0)
+		{
+			config.hardwareCounters = true;
+		}
+		else
+		{
+			argv[newArgc++] = argv[i];
+		}
+	}
+
+	argc = newArgc;
+	if (argc > 0)
+		argv[argc] = NULL;
+
+	return true;
+}
+
+const char* BenchmarkHarness::getUsage()
+{
+	return
+		"    --benchmark[=ITERATIONS]      : Benchmark mode: read the input file into memory and process it ITERATIONS times (default 10),\n"
+		"                                    then print the time per packet of every processing stage. No output files are written\n"
+		"    --benchmark-warmup=ITERATIONS : The number of iterations to run before measuring (default 1)\n"
+		"    --benchmark-json=FILE         : Write the benchmark results to FILE in JSON format\n"
+		"    --benchmark-hw-counters       : Count CPU hardware events (cycles, instructions, cache misses, branch misses) with perf_event\n"
+		"                                    and report them per packet. Requires Linux and access to the hardware counters\n";
+}
+
+BenchmarkHarness::BenchmarkHarness(const std::string& appName, const BenchmarkConfiguration& config) :
+	m_AppName(appName), m_Config(config), m_NumOfBytes(0), m_IterationsStarted(0), m_Measuring(false), m_IterationStartCycles(0)
+{
+	if (m_Config.hardwareCounters && !m_HwCounters.open())
+		LOG_ERROR("Hardware counters aren't available, running the benchmark without them");
+
+#ifdef PCPP_ENABLE_ITT
+	m_IttDomain = __itt_domain_create(appName.c_str());
+	// the collection is started paused and resumed only for the measured iterations
+	__itt_pause();
+#endif
+}
+
+BenchmarkHarness::~BenchmarkHarness()
+{
+}
+
+bool BenchmarkHarness::loadFile(const std::string& fileName, GeneralFilter* filter)
+{
+	m_Packets.clear();
+	m_NumOfBytes = 0;
+	m_FileName = fileName;
+
+	IFileReaderDevice* reader = IFileReaderDevice::getReader(fileName.c_str());
+	if (!reader->open())
+	{
+		LOG_ERROR("Cannot open input file '%s'", fileName.c_str());
+		delete reader;
+		return false;
+	}
+
+	if (filter != NULL && !reader->setFilter(*filter))
+	{
+		LOG_ERROR("Cannot set filter on input file '%s'", fileName.c_str());
+		reader->close();
+		delete reader;
+		return false;
+	}
+
+	reader->getNextPackets(m_Packets);
+	reader->close();
+	delete reader;
+
+	for (RawPacketVector::ConstVectorIterator iter = m_Packets.begin(); iter != m_Packets.end(); iter++)
+		m_NumOfBytes += (*iter)->getRawDataLen();
+
+	return true;
+}
+
+int BenchmarkHarness::addStage(const std::string& name)
+{
+	StageData stage;
+	stage.name = name;
+	stage.startCycles = 0;
+	stage.totalCycles = 0;
+#ifdef PCPP_ENABLE_ITT
+	stage.ittName = __itt_string_handle_create(name.c_str());
+#endif
+	m_Stages.push_back(stage);
+	return (int)m_Stages.size() - 1;
+}
+
+bool BenchmarkHarness::startIteration()
+{
+	if (m_IterationsStarted >= m_Config.warmupIterations + m_Config.iterations)
+		return false;
+
+	m_Measuring = (m_IterationsStarted >= m_Config.warmupIterations);
+	m_IterationsStarted++;
+
+#ifdef PCPP_ENABLE_ITT
+	if (m_Measuring)
+		__itt_resume();
+#endif
+
+	if (m_Measuring && m_HwCounters.isOpen())
+		m_HwCounters.start();
+
+	m_IterationStartCycles = TimestampClock::readCycleCounter();
+	return true;
+}
+
+void BenchmarkHarness::endIteration()
+{
+	uint64_t cycles = TimestampClock::readCycleCounter() - m_IterationStartCycles;
+
+	if (!m_Measuring)
+		return;
+
+	if (m_HwCounters.isOpen())
+	{
+		m_HwCounters.stop();
+		HardwareCounterValues iterationValues;
+		m_HwCounters.read(iterationValues);
+		m_HwCounterValues += iterationValues;
+	}
+
+#ifdef PCPP_ENABLE_ITT
+	__itt_pause();
+#endif
+
+	m_IterationNs.push_back(LatencyTracer::cyclesToNs(cycles));
+	m_Measuring = false;
+}
+
+double BenchmarkHarness::getNsPerPacket() const
+{
+	if (m_IterationNs.empty() || m_Packets.size() == 0)
+		return 0;
+
+	std::vector<double> sorted(m_IterationNs);
+	std::sort(sorted.begin(), sorted.end());
+	return sorted[sorted.size() / 2] / (double)m_Packets.size();
+}
+
+double BenchmarkHarness::getStageNsPerPacket(int stageId) const
+{
+	if (m_IterationNs.empty() || m_Packets.size() == 0 || stageId < 0 || stageId >= (int)m_Stages.size())
+		return 0;
+
+	return LatencyTracer::cyclesToNs(m_Stages[stageId].totalCycles) / (double)m_IterationNs.size() / (double)m_Packets.size();
+}
+
+void BenchmarkHarness::printReport() const
+{
+	double nsPerPacket = getNsPerPacket();
+	double meanBytesPerPacket = (m_Packets.size() > 0 ? (double)m_NumOfBytes / (double)m_Packets.size() : 0);
+
+	printf("\n%s benchmark\n", m_AppName.c_str());
+	printf("Input:               %s\n", m_FileName.c_str());
+	printf("Packets:             %d (%llu bytes)\n", (int)m_Packets.size(), (unsigned long long)m_NumOfBytes);
+	printf("Iterations:          %d measured, %d warm-up\n", getNumOfMeasuredIterations(), m_Config.warmupIterations);
+	printf("Median time/packet:  %.1f ns\n", nsPerPacket);
+	printf("Throughput:          %.3f Mpps, %.3f Gbps\n",
+			(nsPerPacket > 0 ? 1000.0 / nsPerPacket : 0),
+			(nsPerPacket > 0 ? meanBytesPerPacket * 8 / nsPerPacket : 0));
+	if (m_HwCounterValues.isAnyAvailable())
+		printf("Per packet:          %s\n", HardwareCounters::toString(m_HwCounterValues, getNumOfMeasuredPackets()).c_str());
+	printf("\n");
+
+	if (!m_Stages.empty() && getNumOfMeasuredIterations() > 0)
+	{
+		std::vector<std::string> columnNames;
+		columnNames.push_back("Stage");
+		columnNames.push_back("ns/packet");
+		columnNames.push_back("% of time");
+		std::vector<int> columnWidths;
+		columnWidths.push_back(20);
+		columnWidths.push_back(12);
+		columnWidths.push_back(10);
+		TablePrinter printer(columnNames, columnWidths);
+
+		double meanNsPerPacket = 0;
+		for (size_t i = 0; i < m_IterationNs.size(); i++)
+			meanNsPerPacket += m_IterationNs[i];
+		meanNsPerPacket /= (double)m_IterationNs.size() * (double)(m_Packets.size() > 0 ? m_Packets.size() : 1);
+
+		double stagesNsPerPacket = 0;
+		char nsStr[32], percentStr[32];
+		for (int i = 0; i < (int)m_Stages.size(); i++)
+		{
+			double stageNs = getStageNsPerPacket(i);
+			stagesNsPerPacket += stageNs;
+			snprintf(nsStr, sizeof(nsStr), "%.1f", stageNs);
+			snprintf(percentStr, sizeof(percentStr), "%.1f", (meanNsPerPacket > 0 ? stageNs * 100 / meanNsPerPacket : 0));
+			const char* values[] = { m_Stages[i].name.c_str(), nsStr, percentStr };
+			printer.printRow(values, 3);
+		}
+
+		double otherNs = std::max(meanNsPerPacket - stagesNsPerPacket, 0.0);
+		snprintf(nsStr, sizeof(nsStr), "%.1f", otherNs);
+		snprintf(percentStr, sizeof(percentStr), "%.1f", (meanNsPerPacket > 0 ? otherNs * 100 / meanNsPerPacket : 0));
+		const char* values[] = { "other", nsStr, percentStr };
+		printer.printRow(values, 3);
+		printer.closeTable();
+	}
+
+	if (!m_Config.jsonOutputFile.empty() && writeJson(m_Config.jsonOutputFile))
+		printf("\nResults written to '%s'\n", m_Config.jsonOutputFile.c_str());
+}
+
+// escape a string for a JSON string value
+static std::string jsonEscape(const std::string& str)
+{
+	std::string result;
+	for (size_t i = 0; i < str.size(); i++)
+	{
+		char c = str[i];
+		if (c == '"' || c == '\\')
+		{
+			result += '\\';
+			result += c;
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+			result += escaped;
+		}
+		else
+			result += c;
+	}
+
+	return result;
+}
+
+bool BenchmarkHarness::writeJson(const std::string& fileName) const
+{
+	FILE* file = fopen(fileName.c_str(), "w");
+	if (file == NULL)
+	{
+		LOG_ERROR("Cannot open benchmark JSON output file '%s'", fileName.c_str());
+		return false;
+	}
+
+	double nsPerPacket = getNsPerPacket();
+	fprintf(file, "{\n");
+	fprintf(file, "  \"application\": \"%s\",\n", jsonEscape(m_AppName).c_str());
+	fprintf(file, "  \"input\": \"%s\",\n", jsonEscape(m_FileName).c_str());
+	fprintf(file, "  \"packets\": %d,\n", (int)m_Packets.size());
+	fprintf(file, "  \"bytes\": %llu,\n", (unsigned long long)m_NumOfBytes);
+	fprintf(file, "  \"iterations\": %d,\n", getNumOfMeasuredIterations());
+	fprintf(file, "  \"warmup_iterations\": %d,\n", m_Config.warmupIterations);
+	fprintf(file, "  \"ns_per_packet\": %.3f,\n", nsPerPacket);
+	fprintf(file, "  \"mpps\": %.6f,\n", (nsPerPacket > 0 ? 1000.0 / nsPerPacket : 0));
+	if (m_HwCounterValues.isAnyAvailable())
+	{
+		fprintf(file, "  \"hw_counters_per_packet\": {");
+		bool first = true;
+		for (int i = 0; i < NumOfHwCounterTypes; i++)
+		{
+			double perPacket = m_HwCounterValues.getPerUnit((HardwareCounterType)i, getNumOfMeasuredPackets());
+			if (perPacket < 0)
+				continue;
+			fprintf(file, "%s \"%s\": %.3f", (first ? "" : ","), HardwareCounterValues::getName((HardwareCounterType)i), perPacket);
+			first = false;
+		}
+		if (m_HwCounterValues.getInstructionsPerCycle() >= 0)
+			fprintf(file, ", \"ipc\": %.3f", m_HwCounterValues.getInstructionsPerCycle());
+		fprintf(file, " },\n");
+	}
+	fprintf(file, "  \"stages\": [");
+	for (int i = 0; i < (int)m_Stages.size(); i++)
+	{
+		fprintf(file, "%s\n    { \"name\": \"%s\", \"ns_per_packet\": %.3f }", (i > 0 ? "," : ""),
+				jsonEscape(m_Stages[i].name).c_str(), getStageNsPerPacket(i));
+	}
+	fprintf(file, "%s]\n", (m_Stages.empty() ? "" : "\n  "));
+	fprintf(file, "}\n");
+	fclose(file);
+
+	return true;
+}
+
+} // namespace pcpp
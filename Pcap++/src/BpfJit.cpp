@@ -0,0 +1,624 @@
+#include "BpfJit.h"
+#include <pcap.h>
+#include <string.h>
+#include <vector>
+#if defined(WIN32) || defined(WINx64)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BPF_JIT_X86_64
+#endif
+
+// the longest program the compiler accepts, as the kernel BPF verifier does
+#define BPF_JIT_MAX_INSNS 4096
+
+namespace pcpp
+{
+
+#ifdef BPF_JIT_X86_64
+
+/**
+ * Register allocation of the generated code:
+ * - eax: the A register
+ * - ebx: the X register
+ * - rdi: the packet data
+ * - rsi: the captured length (zero-extended)
+ * - ecx, edx: scratch registers
+ * - [rsp, rsp+64): the scratch memory M[]
+ * - [rsp+64]: the packet length
+ */
+#define BPF_JIT_STACK_SIZE 72
+#define BPF_JIT_PACKET_LEN_OFFSET 64
+
+// x86 condition codes of the two-byte conditional jumps (0F 8x)
+#define X86_JB 0x82
+#define X86_JAE 0x83
+#define X86_JE 0x84
+#define X86_JNE 0x85
+#define X86_JBE 0x86
+#define X86_JA 0x87
+
+// the generated code is built in a buffer, and jumps to BPF instructions and to the common exits are resolved when it's complete
+class BpfX86Emitter
+{
+public:
+	std::vector<uint8_t> code;
+
+	BpfX86Emitter(uint32_t numOfInsns) : m_NumOfInsns(numOfInsns), m_Labels(numOfInsns + 2, 0)
+	{
+		code.reserve(numOfInsns * 16 + 64);
+	}
+
+	// the targets of jumps besides BPF instructions
+	inline uint32_t retZeroTarget() const { return m_NumOfInsns; }
+	inline uint32_t epilogueTarget() const { return m_NumOfInsns + 1; }
+
+	inline void setLabel(uint32_t target) { m_Labels[target] = code.size(); }
+
+	inline void emit1(uint8_t b1) { code.push_back(b1); }
+	inline void emit2(uint8_t b1, uint8_t b2) { emit1(b1); emit1(b2); }
+	inline void emit3(uint8_t b1, uint8_t b2, uint8_t b3) { emit2(b1, b2); emit1(b3); }
+	inline void emit4(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4) { emit2(b1, b2); emit2(b3, b4); }
+
+	inline void emitImm32(uint32_t value)
+	{
+		emit4((uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24));
+	}
+
+	// jmp rel32
+	void emitJump(uint32_t target)
+	{
+		emit1(0xE9);
+		addFixup(target);
+	}
+
+	// jcc rel32
+	void emitJumpIf(uint8_t conditionCode, uint32_t target)
+	{
+		emit2(0x0F, conditionCode);
+		addFixup(target);
+	}
+
+	void resolveJumps()
+	{
+		for (size_t i = 0; i < m_Fixups.size(); i++)
+		{
+			size_t position = m_Fixups[i].position;
+			uint32_t rel = (uint32_t)(m_Labels[m_Fixups[i].target] - (position + 4));
+			code[position] = (uint8_t)rel;
+			code[position + 1] = (uint8_t)(rel >> 8);
+			code[position + 2] = (uint8_t)(rel >> 16);
+			code[position + 3] = (uint8_t)(rel >> 24);
+		}
+	}
+
+private:
+	struct Fixup
+	{
+		size_t position;
+		uint32_t target;
+	};
+
+	uint32_t m_NumOfInsns;
+	std::vector<size_t> m_Labels;
+	std::vector<Fixup> m_Fixups;
+
+	void addFixup(uint32_t target)
+	{
+		Fixup fixup;
+		fixup.position = code.size();
+		fixup.target = target;
+		m_Fixups.push_back(fixup);
+		emitImm32(0);
+	}
+};
+
+static void emitPrologue(BpfX86Emitter& e, bool clearMemory)
+{
+	e.emit1(0x53);                                // push rbx
+#if defined(WIN32) || defined(WINx64)
+	e.emit1(0x57);                                // push rdi
+	e.emit1(0x56);                                // push rsi
+	e.emit3(0x48, 0x89, 0xCF);                    // mov rdi, rcx
+	e.emit2(0x89, 0xD6);                          // mov esi, edx
+	e.emit4(0x48, 0x83, 0xEC, BPF_JIT_STACK_SIZE);   // sub rsp, BPF_JIT_STACK_SIZE
+	e.emit4(0x44, 0x89, 0x44, 0x24);              // mov [rsp+BPF_JIT_PACKET_LEN_OFFSET], r8d
+	e.emit1(BPF_JIT_PACKET_LEN_OFFSET);
+#else
+	e.emit2(0x89, 0xF6);                          // mov esi, esi
+	e.emit4(0x48, 0x83, 0xEC, BPF_JIT_STACK_SIZE);   // sub rsp, BPF_JIT_STACK_SIZE
+	e.emit4(0x89, 0x54, 0x24, BPF_JIT_PACKET_LEN_OFFSET);   // mov [rsp+BPF_JIT_PACKET_LEN_OFFSET], edx
+#endif
+	e.emit2(0x31, 0xC0);                          // xor eax, eax
+	e.emit2(0x31, 0xDB);                          // xor ebx, ebx
+
+	if (clearMemory)
+	{
+		for (uint8_t offset = 0; offset < BPF_MEMWORDS * 4; offset += 8)
+		{
+			e.emit4(0x48, 0x89, 0x44, 0x24);          // mov [rsp+offset], rax
+			e.emit1(offset);
+		}
+	}
+}
+
+static void emitEpilogue(BpfX86Emitter& e)
+{
+	e.emit4(0x48, 0x83, 0xC4, BPF_JIT_STACK_SIZE);   // add rsp, BPF_JIT_STACK_SIZE
+#if defined(WIN32) || defined(WINx64)
+	e.emit1(0x5E);                                // pop rsi
+	e.emit1(0x5F);                                // pop rdi
+#endif
+	e.emit1(0x5B);                                // pop rbx
+	e.emit1(0xC3);                                // ret
+}
+
+// load the byte-swapped value at [rdi+k] into eax after checking it's within the captured bytes
+static void emitAbsoluteLoad(BpfX86Emitter& e, uint32_t size, uint32_t k)
+{
+	// packets are shorter than 2GB, so a load beyond that always fails the bounds check
+	if (k > 0x7FFFFFFF - size)
+	{
+		e.emitJump(e.retZeroTarget());
+		return;
+	}
+
+	e.emit2(0x81, 0xFE);                          // cmp esi, k+size
+	e.emitImm32(k + size);
+	e.emitJumpIf(X86_JB, e.retZeroTarget());
+
+	switch (size)
+	{
+	case 4:
+		e.emit2(0x8B, 0x87);                      // mov eax, [rdi+k]
+		e.emitImm32(k);
+		e.emit2(0x0F, 0xC8);                      // bswap eax
+		break;
+	case 2:
+		e.emit3(0x0F, 0xB7, 0x87);                // movzx eax, word [rdi+k]
+		e.emitImm32(k);
+		e.emit4(0x66, 0xC1, 0xC0, 0x08);          // rol ax, 8
+		break;
+	default:
+		e.emit3(0x0F, 0xB6, 0x87);                // movzx eax, byte [rdi+k]
+		e.emitImm32(k);
+		break;
+	}
+}
+
+// load the byte-swapped value at [rdi+X+k] into eax after checking it's within the captured bytes. The offset is computed in 64 bits so
+// it can't wrap around
+static void emitIndirectLoad(BpfX86Emitter& e, uint32_t size, uint32_t k)
+{
+	e.emit2(0x89, 0xD9);                          // mov ecx, ebx
+	e.emit1(0xBA);                                // mov edx, k
+	e.emitImm32(k);
+	e.emit3(0x48, 0x01, 0xD1);                    // add rcx, rdx
+	e.emit4(0x48, 0x8D, 0x51, (uint8_t)size);     // lea rdx, [rcx+size]
+	e.emit3(0x48, 0x39, 0xF2);                    // cmp rdx, rsi
+	e.emitJumpIf(X86_JA, e.retZeroTarget());
+
+	switch (size)
+	{
+	case 4:
+		e.emit3(0x8B, 0x04, 0x0F);                // mov eax, [rdi+rcx]
+		e.emit2(0x0F, 0xC8);                      // bswap eax
+		break;
+	case 2:
+		e.emit4(0x0F, 0xB7, 0x04, 0x0F);          // movzx eax, word [rdi+rcx]
+		e.emit4(0x66, 0xC1, 0xC0, 0x08);          // rol ax, 8
+		break;
+	default:
+		e.emit4(0x0F, 0xB6, 0x04, 0x0F);          // movzx eax, byte [rdi+rcx]
+		break;
+	}
+}
+
+// X = (P[k] & 0xf) << 2
+static void emitLoadHeaderLength(BpfX86Emitter& e, uint32_t k)
+{
+	if (k > 0x7FFFFFFE)
+	{
+		e.emitJump(e.retZeroTarget());
+		return;
+	}
+
+	e.emit2(0x81, 0xFE);                          // cmp esi, k+1
+	e.emitImm32(k + 1);
+	e.emitJumpIf(X86_JB, e.retZeroTarget());
+	e.emit3(0x0F, 0xB6, 0x9F);                    // movzx ebx, byte [rdi+k]
+	e.emitImm32(k);
+	e.emit3(0x83, 0xE3, 0x0F);                    // and ebx, 0xf
+	e.emit3(0xC1, 0xE3, 0x02);                    // shl ebx, 2
+}
+
+// A <<= X or A >>= X, where shifting by 32 bits or more makes A 0
+static void emitShiftByX(BpfX86Emitter& e, uint8_t shiftModRm)
+{
+	e.emit3(0x83, 0xFB, 0x20);                    // cmp ebx, 32
+	e.emit2(0x72, 0x04);                          // jb +4
+	e.emit2(0x31, 0xC0);                          // xor eax, eax
+	e.emit2(0xEB, 0x04);                          // jmp +4
+	e.emit2(0x89, 0xD9);                          // mov ecx, ebx
+	e.emit2(0xD3, shiftModRm);                    // shl/shr eax, cl
+}
+
+// A /= X or A %= X, where a zero X makes the program return 0
+static void emitDivideByX(BpfX86Emitter& e, bool modulo)
+{
+	e.emit2(0x85, 0xDB);                          // test ebx, ebx
+	e.emitJumpIf(X86_JE, e.retZeroTarget());
+	e.emit2(0x31, 0xD2);                          // xor edx, edx
+	e.emit2(0xF7, 0xF3);                          // div ebx
+	if (modulo)
+		e.emit2(0x89, 0xD0);                      // mov eax, edx
+}
+
+static void emitDivideByK(BpfX86Emitter& e, uint32_t k, bool modulo)
+{
+	e.emit1(0xB9);                                // mov ecx, k
+	e.emitImm32(k);
+	e.emit2(0x31, 0xD2);                          // xor edx, edx
+	e.emit2(0xF7, 0xF1);                          // div ecx
+	if (modulo)
+		e.emit2(0x89, 0xD0);                      // mov eax, edx
+}
+
+// the flags were set by a compare, so jump to the true or false target
+static void emitConditionalJump(BpfX86Emitter& e, uint8_t trueCondition, uint8_t falseCondition, uint32_t pc, const struct bpf_insn& insn)
+{
+	uint32_t trueTarget = pc + 1 + insn.jt;
+	uint32_t falseTarget = pc + 1 + insn.jf;
+
+	if (insn.jt == insn.jf)
+	{
+		if (insn.jt != 0)
+			e.emitJump(trueTarget);
+	}
+	else if (insn.jt == 0)
+		e.emitJumpIf(falseCondition, falseTarget);
+	else
+	{
+		e.emitJumpIf(trueCondition, trueTarget);
+		if (insn.jf != 0)
+			e.emitJump(falseTarget);
+	}
+}
+
+static inline bool isMemIndexValid(uint32_t k)
+{
+	return k < BPF_MEMWORDS;
+}
+
+// translate the program, accepting exactly the instructions the libpcap interpreter executes
+static bool generateX86Code(const struct bpf_insn* insns, uint32_t numOfInsns, std::vector<uint8_t>& code)
+{
+	// programs which read the scratch memory get it zeroed, so they never see values left on the stack
+	bool readsMemory = false;
+	for (uint32_t pc = 0; pc < numOfInsns; pc++)
+	{
+		if (insns[pc].code == (BPF_LD|BPF_MEM) || insns[pc].code == (BPF_LDX|BPF_MEM))
+			readsMemory = true;
+	}
+
+	BpfX86Emitter e(numOfInsns);
+	emitPrologue(e, readsMemory);
+
+	for (uint32_t pc = 0; pc < numOfInsns; pc++)
+	{
+		const struct bpf_insn& insn = insns[pc];
+		uint32_t k = insn.k;
+		bool isLast = (pc == numOfInsns - 1);
+		e.setLabel(pc);
+
+		// jump targets must be inside the program
+		if (BPF_CLASS(insn.code) == BPF_JMP)
+		{
+			uint32_t remaining = numOfInsns - pc - 1;
+			if (BPF_OP(insn.code) == BPF_JA ? k >= remaining : (insn.jt >= remaining || insn.jf >= remaining))
+				return false;
+		}
+
+		switch (insn.code)
+		{
+		case BPF_RET|BPF_K:
+			e.emit1(0xB8);                        // mov eax, k
+			e.emitImm32(k);
+			if (!isLast)
+				e.emitJump(e.epilogueTarget());
+			break;
+		case BPF_RET|BPF_A:
+			if (!isLast)
+				e.emitJump(e.epilogueTarget());
+			break;
+
+		case BPF_LD|BPF_W|BPF_ABS:
+			emitAbsoluteLoad(e, 4, k);
+			break;
+		case BPF_LD|BPF_H|BPF_ABS:
+			emitAbsoluteLoad(e, 2, k);
+			break;
+		case BPF_LD|BPF_B|BPF_ABS:
+			emitAbsoluteLoad(e, 1, k);
+			break;
+		case BPF_LD|BPF_W|BPF_IND:
+			emitIndirectLoad(e, 4, k);
+			break;
+		case BPF_LD|BPF_H|BPF_IND:
+			emitIndirectLoad(e, 2, k);
+			break;
+		case BPF_LD|BPF_B|BPF_IND:
+			emitIndirectLoad(e, 1, k);
+			break;
+		case BPF_LDX|BPF_MSH|BPF_B:
+			emitLoadHeaderLength(e, k);
+			break;
+		case BPF_LD|BPF_W|BPF_LEN:
+			e.emit4(0x8B, 0x44, 0x24, BPF_JIT_PACKET_LEN_OFFSET);   // mov eax, [rsp+BPF_JIT_PACKET_LEN_OFFSET]
+			break;
+		case BPF_LDX|BPF_W|BPF_LEN:
+			e.emit4(0x8B, 0x5C, 0x24, BPF_JIT_PACKET_LEN_OFFSET);   // mov ebx, [rsp+BPF_JIT_PACKET_LEN_OFFSET]
+			break;
+		case BPF_LD|BPF_IMM:
+			e.emit1(0xB8);                        // mov eax, k
+			e.emitImm32(k);
+			break;
+		case BPF_LDX|BPF_IMM:
+			e.emit1(0xBB);                        // mov ebx, k
+			e.emitImm32(k);
+			break;
+		case BPF_LD|BPF_MEM:
+			if (!isMemIndexValid(k))
+				return false;
+			e.emit4(0x8B, 0x44, 0x24, (uint8_t)(k * 4));   // mov eax, [rsp+k*4]
+			break;
+		case BPF_LDX|BPF_MEM:
+			if (!isMemIndexValid(k))
+				return false;
+			e.emit4(0x8B, 0x5C, 0x24, (uint8_t)(k * 4));   // mov ebx, [rsp+k*4]
+			break;
+		case BPF_ST:
+			if (!isMemIndexValid(k))
+				return false;
+			e.emit4(0x89, 0x44, 0x24, (uint8_t)(k * 4));   // mov [rsp+k*4], eax
+			break;
+		case BPF_STX:
+			if (!isMemIndexValid(k))
+				return false;
+			e.emit4(0x89, 0x5C, 0x24, (uint8_t)(k * 4));   // mov [rsp+k*4], ebx
+			break;
+
+		case BPF_ALU|BPF_ADD|BPF_K:
+			e.emit1(0x05);                        // add eax, k
+			e.emitImm32(k);
+			break;
+		case BPF_ALU|BPF_SUB|BPF_K:
+			e.emit1(0x2D);                        // sub eax, k
+			e.emitImm32(k);
+			break;
+		case BPF_ALU|BPF_MUL|BPF_K:
+			e.emit2(0x69, 0xC0);                  // imul eax, eax, k
+			e.emitImm32(k);
+			break;
+		case BPF_ALU|BPF_DIV|BPF_K:
+			if (k == 0)
+				return false;
+			emitDivideByK(e, k, false);
+			break;
+		case BPF_ALU|BPF_MOD|BPF_K:
+			if (k == 0)
+				return false;
+			emitDivideByK(e, k, true);
+			break;
+		case BPF_ALU|BPF_AND|BPF_K:
+			e.emit1(0x25);                        // and eax, k
+			e.emitImm32(k);
+			break;
+		case BPF_ALU|BPF_OR|BPF_K:
+			e.emit1(0x0D);                        // or eax, k
+			e.emitImm32(k);
+			break;
+		case BPF_ALU|BPF_XOR|BPF_K:
+			e.emit1(0x35);                        // xor eax, k
+			e.emitImm32(k);
+			break;
+		case BPF_ALU|BPF_LSH|BPF_K:
+			if (k >= 32)
+				return false;
+			e.emit3(0xC1, 0xE0, (uint8_t)k);      // shl eax, k
+			break;
+		case BPF_ALU|BPF_RSH|BPF_K:
+			if (k >= 32)
+				return false;
+			e.emit3(0xC1, 0xE8, (uint8_t)k);      // shr eax, k
+			break;
+		case BPF_ALU|BPF_ADD|BPF_X:
+			e.emit2(0x01, 0xD8);                  // add eax, ebx
+			break;
+		case BPF_ALU|BPF_SUB|BPF_X:
+			e.emit2(0x29, 0xD8);                  // sub eax, ebx
+			break;
+		case BPF_ALU|BPF_MUL|BPF_X:
+			e.emit3(0x0F, 0xAF, 0xC3);            // imul eax, ebx
+			break;
+		case BPF_ALU|BPF_DIV|BPF_X:
+			emitDivideByX(e, false);
+			break;
+		case BPF_ALU|BPF_MOD|BPF_X:
+			emitDivideByX(e, true);
+			break;
+		case BPF_ALU|BPF_AND|BPF_X:
+			e.emit2(0x21, 0xD8);                  // and eax, ebx
+			break;
+		case BPF_ALU|BPF_OR|BPF_X:
+			e.emit2(0x09, 0xD8);                  // or eax, ebx
+			break;
+		case BPF_ALU|BPF_XOR|BPF_X:
+			e.emit2(0x31, 0xD8);                  // xor eax, ebx
+			break;
+		case BPF_ALU|BPF_LSH|BPF_X:
+			emitShiftByX(e, 0xE0);
+			break;
+		case BPF_ALU|BPF_RSH|BPF_X:
+			emitShiftByX(e, 0xE8);
+			break;
+		case BPF_ALU|BPF_NEG:
+			e.emit2(0xF7, 0xD8);                  // neg eax
+			break;
+
+		case BPF_JMP|BPF_JA:
+			if (k != 0)
+				e.emitJump(pc + 1 + k);
+			break;
+		case BPF_JMP|BPF_JEQ|BPF_K:
+			e.emit1(0x3D);                        // cmp eax, k
+			e.emitImm32(k);
+			emitConditionalJump(e, X86_JE, X86_JNE, pc, insn);
+			break;
+		case BPF_JMP|BPF_JGT|BPF_K:
+			e.emit1(0x3D);                        // cmp eax, k
+			e.emitImm32(k);
+			emitConditionalJump(e, X86_JA, X86_JBE, pc, insn);
+			break;
+		case BPF_JMP|BPF_JGE|BPF_K:
+			e.emit1(0x3D);                        // cmp eax, k
+			e.emitImm32(k);
+			emitConditionalJump(e, X86_JAE, X86_JB, pc, insn);
+			break;
+		case BPF_JMP|BPF_JSET|BPF_K:
+			e.emit1(0xA9);                        // test eax, k
+			e.emitImm32(k);
+			emitConditionalJump(e, X86_JNE, X86_JE, pc, insn);
+			break;
+		case BPF_JMP|BPF_JEQ|BPF_X:
+			e.emit2(0x39, 0xD8);                  // cmp eax, ebx
+			emitConditionalJump(e, X86_JE, X86_JNE, pc, insn);
+			break;
+		case BPF_JMP|BPF_JGT|BPF_X:
+			e.emit2(0x39, 0xD8);                  // cmp eax, ebx
+			emitConditionalJump(e, X86_JA, X86_JBE, pc, insn);
+			break;
+		case BPF_JMP|BPF_JGE|BPF_X:
+			e.emit2(0x39, 0xD8);                  // cmp eax, ebx
+			emitConditionalJump(e, X86_JAE, X86_JB, pc, insn);
+			break;
+		case BPF_JMP|BPF_JSET|BPF_X:
+			e.emit2(0x85, 0xD8);                  // test eax, ebx
+			emitConditionalJump(e, X86_JNE, X86_JE, pc, insn);
+			break;
+
+		case BPF_MISC|BPF_TAX:
+			e.emit2(0x89, 0xC3);                  // mov ebx, eax
+			break;
+		case BPF_MISC|BPF_TXA:
+			e.emit2(0x89, 0xD8);                  // mov eax, ebx
+			break;
+
+		default:
+			return false;
+		}
+	}
+
+	// like the interpreter, don't run past the end of the program
+	if (BPF_CLASS(insns[numOfInsns - 1].code) != BPF_RET)
+		return false;
+
+	e.setLabel(e.epilogueTarget());
+	emitEpilogue(e);
+	e.setLabel(e.retZeroTarget());
+	e.emit2(0x31, 0xC0);                          // xor eax, eax
+	e.emitJump(e.epilogueTarget());
+
+	e.resolveJumps();
+	code.swap(e.code);
+	return true;
+}
+
+#endif // BPF_JIT_X86_64
+
+BpfJitProgram::BpfJitProgram() : m_Function(NULL), m_Code(NULL), m_CodeSize(0)
+{
+}
+
+BpfJitProgram::~BpfJitProgram()
+{
+	clear();
+}
+
+bool BpfJitProgram::isSupported()
+{
+#ifdef BPF_JIT_X86_64
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool BpfJitProgram::compile(const struct bpf_program* program)
+{
+	clear();
+
+#ifdef BPF_JIT_X86_64
+	if (program == NULL || program->bf_insns == NULL || program->bf_len == 0 || program->bf_len > BPF_JIT_MAX_INSNS)
+		return false;
+
+	std::vector<uint8_t> code;
+	if (!generateX86Code(program->bf_insns, program->bf_len, code))
+		return false;
+
+	// the code is written to writable memory which is then made executable, so no page is ever writable and executable at once
+#if defined(WIN32) || defined(WINx64)
+	void* memory = VirtualAlloc(NULL, code.size(), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (memory == NULL)
+		return false;
+
+	memcpy(memory, &code[0], code.size());
+	DWORD oldProtection;
+	if (!VirtualProtect(memory, code.size(), PAGE_EXECUTE_READ, &oldProtection))
+	{
+		VirtualFree(memory, 0, MEM_RELEASE);
+		return false;
+	}
+#else
+	void* memory = mmap(NULL, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (memory == MAP_FAILED)
+		return false;
+
+	memcpy(memory, &code[0], code.size());
+	if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC) != 0)
+	{
+		munmap(memory, code.size());
+		return false;
+	}
+#endif
+
+	m_Code = memory;
+	m_CodeSize = code.size();
+	m_Function = reinterpret_cast<JitFunction>(m_Code);
+	return true;
+#else
+	(void)program;
+	return false;
+#endif
+}
+
+void BpfJitProgram::clear()
+{
+	if (m_Code == NULL)
+		return;
+
+#if defined(WIN32) || defined(WINx64)
+	VirtualFree(m_Code, 0, MEM_RELEASE);
+#else
+	munmap(m_Code, m_CodeSize);
+#endif
+
+	m_Code = NULL;
+	m_CodeSize = 0;
+	m_Function = NULL;
+}
+
+} // namespace pcpp
@@ -0,0 +1,450 @@
+#define LOG_MODULE PcapLogModuleBsdBpfDevice
+
+#include "BsdBpfDevice.h"
+#include "PcapFilter.h"
+#include "Logger.h"
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#if defined(MAC_OS_X) || defined(FREEBSD)
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <net/bpf.h>
+#include <pcap.h>
+#endif
+
+// the highest N of the /dev/bpfN devices tried when looking for a free one. FreeBSD clones a new device on each open of /dev/bpf
+#define MAX_NUM_OF_BPF_DEVICES 256
+
+namespace pcpp
+{
+
+BsdBpfDevice::BsdBpfDevice(const std::string& interfaceName, const DeviceConfiguration& config) :
+	m_InterfaceName(interfaceName), m_Config(config)
+{
+	m_Fd = -1;
+	m_Buffer = NULL;
+	m_BufferSize = 0;
+	m_LinkType = LINKTYPE_ETHERNET;
+	m_Packets = NULL;
+	m_PacketsCapacity = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_CaptureThreadStarted = false;
+	m_StopThread = false;
+	m_OnPacketsArrive = NULL;
+	m_OnPacketsArriveUserCookie = NULL;
+	m_IsFilterSet = false;
+}
+
+BsdBpfDevice::~BsdBpfDevice()
+{
+	close();
+}
+
+bool BsdBpfDevice::open()
+{
+#if defined(MAC_OS_X) || defined(FREEBSD)
+
+	if (m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' already opened", m_InterfaceName.c_str());
+		return false;
+	}
+
+	if (m_Config.bufferSize == 0 || m_Config.readTimeoutMs == 0)
+	{
+		LOG_ERROR("Invalid configuration for device '%s': the buffer size and the read timeout must be greater than 0", m_InterfaceName.c_str());
+		return false;
+	}
+
+	m_Fd = ::open("/dev/bpf", O_RDONLY);
+	for (int i = 0; m_Fd < 0 && i < MAX_NUM_OF_BPF_DEVICES; i++)
+	{
+		char bpfDeviceName[16];
+		snprintf(bpfDeviceName, sizeof(bpfDeviceName), "/dev/bpf%d", i);
+		m_Fd = ::open(bpfDeviceName, O_RDONLY);
+		// a missing device means there are no more devices to try
+		if (m_Fd < 0 && errno != EBUSY)
+			break;
+	}
+
+	if (m_Fd < 0)
+	{
+		LOG_ERROR("Cannot open a BPF device for device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	if (!setOptions())
+	{
+		::close(m_Fd);
+		m_Fd = -1;
+		m_BufferSize = 0;
+		return false;
+	}
+
+	m_Buffer = new uint8_t[m_BufferSize];
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_DeviceOpened = true;
+	LOG_DEBUG("Device '%s' opened with a buffer of %u bytes", m_InterfaceName.c_str(), m_BufferSize);
+	return true;
+
+#else
+
+	LOG_ERROR("BsdBpfDevice is supported on macOS and FreeBSD only");
+	return false;
+
+#endif
+}
+
+bool BsdBpfDevice::setOptions()
+{
+#if defined(MAC_OS_X) || defined(FREEBSD)
+
+	// the buffer size can be set only before the device is attached to an interface. The kernel clamps it to its maximum
+	u_int bufferSize = m_Config.bufferSize;
+	if (ioctl(m_Fd, BIOCSBLEN, &bufferSize) < 0)
+	{
+		LOG_ERROR("Cannot set buffer size of %u bytes for device '%s', error was: %d", m_Config.bufferSize, m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	ifreq ifr;
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, m_InterfaceName.c_str(), sizeof(ifr.ifr_name) - 1);
+	if (ioctl(m_Fd, BIOCSETIF, &ifr) < 0)
+	{
+		LOG_ERROR("Cannot attach BPF device to interface '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	if (ioctl(m_Fd, BIOCGBLEN, &bufferSize) < 0)
+	{
+		LOG_ERROR("Cannot read buffer size of device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+	m_BufferSize = bufferSize;
+	if (m_BufferSize < m_Config.bufferSize)
+		LOG_DEBUG("Buffer of device '%s' was clamped by the kernel to %u bytes", m_InterfaceName.c_str(), m_BufferSize);
+
+	u_int enable = 1;
+	if (m_Config.immediateMode && ioctl(m_Fd, BIOCIMMEDIATE, &enable) < 0)
+	{
+		LOG_ERROR("Cannot set immediate mode for device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	u_int seeSent = (m_Config.seeSent ? 1 : 0);
+	if (ioctl(m_Fd, BIOCSSEESENT, &seeSent) < 0)
+	{
+		LOG_ERROR("Cannot set whether sent packets are captured for device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	timeval readTimeout;
+	readTimeout.tv_sec = m_Config.readTimeoutMs / 1000;
+	readTimeout.tv_usec = (m_Config.readTimeoutMs % 1000) * 1000;
+	if (ioctl(m_Fd, BIOCSRTIMEOUT, &readTimeout) < 0)
+	{
+		LOG_ERROR("Cannot set read timeout for device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	// promiscuous mode is a property of the BPF device, so it ends when the device is closed
+	if (m_Config.promiscuous && ioctl(m_Fd, BIOCPROMISC, NULL) < 0)
+	{
+		LOG_ERROR("Cannot set device '%s' to promiscuous mode, error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	// DLT values of the link types PcapPlusPlus supports are the same as their LINKTYPE values
+	u_int dlt;
+	if (ioctl(m_Fd, BIOCGDLT, &dlt) < 0)
+	{
+		LOG_ERROR("Cannot read link type of device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+	m_LinkType = (LinkLayerType)dlt;
+
+	return true;
+
+#else
+
+	return false;
+
+#endif
+}
+
+void BsdBpfDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	stopCapture();
+
+#if defined(MAC_OS_X) || defined(FREEBSD)
+	::close(m_Fd);
+#endif
+
+	m_Fd = -1;
+	delete [] m_Buffer;
+	m_Buffer = NULL;
+	m_BufferSize = 0;
+	delete [] m_Packets;
+	m_Packets = NULL;
+	m_PacketsCapacity = 0;
+	m_LinkType = LINKTYPE_ETHERNET;
+	m_IsFilterSet = false;
+	m_DeviceOpened = false;
+	LOG_DEBUG("Device '%s' closed", m_InterfaceName.c_str());
+}
+
+int BsdBpfDevice::readBuffer(OnBsdBpfPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie)
+{
+#if defined(MAC_OS_X) || defined(FREEBSD)
+
+	// a read must use the size of the kernel buffer, and returns the contents of a whole kernel buffer
+	ssize_t len = read(m_Fd, m_Buffer, m_BufferSize);
+	if (len < 0)
+	{
+		if (errno == EINTR || errno == EAGAIN)
+			return 0;
+
+		LOG_ERROR("Cannot read from device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return -1;
+	}
+
+	// the packets are counted first, so the packets array is grown once and the packets are set only once
+	uint8_t* bufferEnd = m_Buffer + len;
+	uint32_t numOfPackets = 0;
+	for (uint8_t* cur = m_Buffer; cur + sizeof(bpf_hdr) <= bufferEnd; numOfPackets++)
+	{
+		bpf_hdr* header = (bpf_hdr*)cur;
+		if (cur + header->bh_hdrlen + header->bh_caplen > bufferEnd)
+			break;
+		cur += BPF_WORDALIGN(header->bh_hdrlen + header->bh_caplen);
+	}
+
+	if (numOfPackets == 0)
+		return 0;
+
+	if (numOfPackets > m_PacketsCapacity)
+	{
+		delete [] m_Packets;
+		m_Packets = new RawPacket[numOfPackets];
+		m_PacketsCapacity = numOfPackets;
+	}
+
+	uint8_t* cur = m_Buffer;
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		bpf_hdr* header = (bpf_hdr*)cur;
+		timespec timestamp;
+		timestamp.tv_sec = header->bh_tstamp.tv_sec;
+		timestamp.tv_nsec = header->bh_tstamp.tv_usec * 1000;
+		m_Packets[i].setExternalRawData(cur + header->bh_hdrlen, (int)header->bh_caplen, timestamp, m_LinkType, (int)header->bh_datalen);
+		cur += BPF_WORDALIGN(header->bh_hdrlen + header->bh_caplen);
+	}
+
+	m_Stats.reads++;
+	m_Stats.packetsDelivered += numOfPackets;
+	onPacketsArrive(m_Packets, numOfPackets, this, onPacketsArriveUserCookie);
+
+	return (int)numOfPackets;
+
+#else
+
+	LOG_ERROR("BsdBpfDevice is supported on macOS and FreeBSD only");
+	return -1;
+
+#endif
+}
+
+int BsdBpfDevice::receiveBatch(OnBsdBpfPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened", m_InterfaceName.c_str());
+		return -1;
+	}
+
+	if (onPacketsArrive == NULL)
+	{
+		LOG_ERROR("No callback given for receiving packets on device '%s'", m_InterfaceName.c_str());
+		return -1;
+	}
+
+	return readBuffer(onPacketsArrive, onPacketsArriveUserCookie);
+}
+
+void* BsdBpfDevice::captureThreadMain(void* devicePtr)
+{
+	BsdBpfDevice* device = (BsdBpfDevice*)devicePtr;
+
+	LOG_DEBUG("Started capture thread for device '%s'", device->m_InterfaceName.c_str());
+	while (!device->m_StopThread)
+	{
+		if (device->readBuffer(device->m_OnPacketsArrive, device->m_OnPacketsArriveUserCookie) < 0)
+			break;
+	}
+	LOG_DEBUG("Ended capture thread for device '%s'", device->m_InterfaceName.c_str());
+
+	return NULL;
+}
+
+bool BsdBpfDevice::startCapture(OnBsdBpfPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened", m_InterfaceName.c_str());
+		return false;
+	}
+
+	if (m_CaptureThreadStarted)
+	{
+		LOG_ERROR("Device '%s' already capturing", m_InterfaceName.c_str());
+		return false;
+	}
+
+	if (onPacketsArrive == NULL)
+	{
+		LOG_ERROR("No callback given for capturing on device '%s'", m_InterfaceName.c_str());
+		return false;
+	}
+
+	m_OnPacketsArrive = onPacketsArrive;
+	m_OnPacketsArriveUserCookie = onPacketsArriveUserCookie;
+	m_StopThread = false;
+
+	int err = pthread_create(&m_CaptureThread, NULL, captureThreadMain, this);
+	if (err != 0)
+	{
+		LOG_ERROR("Cannot create capture thread for device '%s': [%s]", m_InterfaceName.c_str(), strerror(err));
+		return false;
+	}
+
+	m_CaptureThreadStarted = true;
+	LOG_DEBUG("Capturing started on device '%s'", m_InterfaceName.c_str());
+	return true;
+}
+
+void BsdBpfDevice::stopCapture()
+{
+	if (!m_CaptureThreadStarted)
+		return;
+
+	m_StopThread = true;
+	pthread_join(m_CaptureThread, NULL);
+
+	m_CaptureThreadStarted = false;
+	m_StopThread = false;
+	LOG_DEBUG("Capturing stopped on device '%s'", m_InterfaceName.c_str());
+}
+
+void BsdBpfDevice::getStatistics(BsdBpfStats& stats)
+{
+	if (!m_DeviceOpened)
+	{
+		memset(&stats, 0, sizeof(stats));
+		return;
+	}
+
+#if defined(MAC_OS_X) || defined(FREEBSD)
+	// the kernel counters aren't reset when they're read
+	bpf_stat kernelStats;
+	if (ioctl(m_Fd, BIOCGSTATS, &kernelStats) < 0)
+		LOG_ERROR("Cannot read statistics of device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+	else
+	{
+		m_Stats.recv = kernelStats.bs_recv;
+		m_Stats.drop = kernelStats.bs_drop;
+	}
+#endif
+
+	stats = m_Stats;
+}
+
+void BsdBpfDevice::collectMetrics(MetricsWriter& writer)
+{
+	if (!m_DeviceOpened)
+		return;
+
+	BsdBpfStats stats;
+	getStatistics(stats);
+	writer.addCounter("pcpp_device_rx_packets_total", "Packets received by the device", stats.recv);
+	writer.addCounter("pcpp_device_rx_dropped_packets_total", "Packets dropped by the device", stats.drop);
+	writer.addCounter("pcpp_device_rx_batches_total", "Buffers read from the device", stats.reads);
+}
+
+bool BsdBpfDevice::setFilter(std::string filterAsString)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened", m_InterfaceName.c_str());
+		return false;
+	}
+
+	BPFStringFilter filter(filterAsString);
+	if (!filter.verifyFilter())
+	{
+		LOG_ERROR("Filter '%s' is invalid", filterAsString.c_str());
+		return false;
+	}
+
+#if defined(MAC_OS_X) || defined(FREEBSD)
+
+	bpf_program program;
+	if (pcap_compile_nopcap(65535, m_LinkType, &program, filterAsString.c_str(), 1, PCAP_NETMASK_UNKNOWN) < 0)
+	{
+		LOG_ERROR("Cannot compile filter '%s'", filterAsString.c_str());
+		return false;
+	}
+
+	// setting a filter also discards the packets in the kernel buffers, which weren't filtered by it
+	bool result = (ioctl(m_Fd, BIOCSETF, &program) == 0);
+	pcap_freecode(&program);
+
+	if (!result)
+	{
+		LOG_ERROR("Cannot set filter '%s' on device '%s', error was: %d", filterAsString.c_str(), m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	m_IsFilterSet = true;
+	LOG_DEBUG("Successfully set filter '%s'", filterAsString.c_str());
+	return true;
+
+#else
+
+	return false;
+
+#endif
+}
+
+bool BsdBpfDevice::clearFilter()
+{
+	if (!m_IsFilterSet)
+		return true;
+
+#if defined(MAC_OS_X) || defined(FREEBSD)
+	// BPF devices have no way to remove a filter, so it's replaced with a filter which accepts whole packets
+	bpf_insn acceptAll = BPF_STMT(BPF_RET | BPF_K, (u_int)-1);
+	bpf_program program;
+	program.bf_len = 1;
+	program.bf_insns = &acceptAll;
+	if (ioctl(m_Fd, BIOCSETF, &program) < 0)
+	{
+		LOG_ERROR("Cannot clear filter of device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+#endif
+
+	m_IsFilterSet = false;
+	return true;
+}
+
+} // namespace pcpp
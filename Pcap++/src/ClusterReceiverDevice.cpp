@@ -0,0 +1,91 @@
+#include "ClusterReceiverDevice.h"
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+// the number of packets decapsulateAndEnqueue() decapsulates before queueing them
+#define DECAPSULATE_BATCH_SIZE 64
+
+namespace pcpp
+{
+
+const uint32_t ClusterReceiverDevice::AnyVni;
+
+ClusterReceiverDevice::ClusterReceiverDevice(uint32_t vni, uint16_t dstPort, size_t capacity, QueueType queueType, RawPacketPool* pool) :
+	PacketQueueDevice(capacity, queueType, pool), m_Vni(vni), m_DstPort(dstPort), m_IgnoredPackets(0)
+{
+}
+
+int ClusterReceiverDevice::decapsulateAndEnqueue(const RawPacket* packets, int count)
+{
+	return decapsulateAndEnqueue(NULL, packets, count);
+}
+
+int ClusterReceiverDevice::decapsulateAndEnqueue(RawPacket** packets, int count)
+{
+	return decapsulateAndEnqueue((const RawPacket* const*)packets, NULL, count);
+}
+
+int ClusterReceiverDevice::decapsulateAndEnqueue(const RawPacket* const* packets, const RawPacket* packetArray, int count)
+{
+	// the inner packets point into the received packets, and copyAndEnqueue() copies them into the queue
+	RawPacket innerPackets[DECAPSULATE_BATCH_SIZE];
+	int numOfInner = 0;
+	int numOfQueued = 0;
+	uint64_t numOfIgnored = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		const RawPacket& packet = (packets != NULL ? *packets[i] : packetArray[i]);
+		uint32_t vni;
+		if (!ClusterDistributor::decapsulate(packet, innerPackets[numOfInner], vni, m_DstPort) || (m_Vni != AnyVni && vni != m_Vni))
+		{
+			numOfIgnored++;
+			continue;
+		}
+
+		numOfInner++;
+		if (numOfInner == DECAPSULATE_BATCH_SIZE)
+		{
+			numOfQueued += copyAndEnqueue(innerPackets, numOfInner);
+			numOfInner = 0;
+		}
+	}
+
+	if (numOfInner > 0)
+		numOfQueued += copyAndEnqueue(innerPackets, numOfInner);
+
+	if (numOfIgnored > 0)
+	{
+#if defined(_MSC_VER)
+		InterlockedExchangeAdd64((volatile LONGLONG*)&m_IgnoredPackets, (LONGLONG)numOfIgnored);
+#else
+		__atomic_fetch_add(&m_IgnoredPackets, numOfIgnored, __ATOMIC_RELAXED);
+#endif
+	}
+
+	return numOfQueued;
+}
+
+uint64_t ClusterReceiverDevice::getNumOfIgnoredPackets() const
+{
+#if defined(_MSC_VER)
+	return (uint64_t)InterlockedCompareExchange64((volatile LONGLONG*)&m_IgnoredPackets, 0, 0);
+#else
+	return __atomic_load_n(&m_IgnoredPackets, __ATOMIC_RELAXED);
+#endif
+}
+
+void ClusterReceiverDevice::onPacketArrives(RawPacket* packet, PcapLiveDevice* pDevice, void* userCookie)
+{
+	ClusterReceiverDevice* pThis = (ClusterReceiverDevice*)userCookie;
+	pThis->decapsulateAndEnqueue(packet, 1);
+}
+
+void ClusterReceiverDevice::onPacketsArriveBurst(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* pDevice, void* userCookie)
+{
+	ClusterReceiverDevice* pThis = (ClusterReceiverDevice*)userCookie;
+	pThis->decapsulateAndEnqueue(packets, (int)numOfPackets);
+}
+
+} // namespace pcpp
@@ -0,0 +1,329 @@
+#define LOG_MODULE PcapLogModuleDeviceReactor
+
+#include "DeviceReactor.h"
+#include "Logger.h"
+#include <string.h>
+#include <errno.h>
+#ifdef LINUX
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+// the maximum number of ready devices handled in one round
+#define MAX_EVENTS_PER_ROUND 64
+
+namespace pcpp
+{
+
+struct DeviceReactor::DeviceEntry
+{
+	IDevice* device;
+	PcapLiveDevice* liveDevice;
+	RawSocketDevice* rawSocketDevice;
+	int fd;
+	OnReactorPacketsArriveCallback onPacketsArrive;
+	void* onPacketsArriveUserCookie;
+	bool removed;
+};
+
+DeviceReactor::DeviceReactor(uint32_t maxBurstSize)
+{
+	m_MaxBurstSize = (maxBurstSize == 0 ? PCPP_DEVICE_REACTOR_DEFAULT_BURST_SIZE : maxBurstSize);
+	m_EpollFd = -1;
+	m_WakeupFd = -1;
+	m_StopRequested = false;
+	m_InRound = false;
+	init();
+}
+
+DeviceReactor::~DeviceReactor()
+{
+	for (std::vector<DeviceEntry*>::iterator iter = m_Devices.begin(); iter != m_Devices.end(); ++iter)
+		delete *iter;
+	m_Devices.clear();
+	deleteRemovedEntries();
+
+#ifdef LINUX
+	if (m_EpollFd >= 0)
+		::close(m_EpollFd);
+	if (m_WakeupFd >= 0)
+		::close(m_WakeupFd);
+#endif
+}
+
+bool DeviceReactor::init()
+{
+#ifdef LINUX
+
+	if (m_EpollFd >= 0)
+		return true;
+
+	m_EpollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (m_EpollFd < 0)
+	{
+		LOG_ERROR("Cannot create epoll instance, error was: %s", strerror(errno));
+		return false;
+	}
+
+	// stop() writes to the event fd to wake up a waiting round
+	m_WakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_WakeupFd < 0)
+	{
+		LOG_ERROR("Cannot create event fd, error was: %s", strerror(errno));
+		::close(m_EpollFd);
+		m_EpollFd = -1;
+		return false;
+	}
+
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if (epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, m_WakeupFd, &event) != 0)
+	{
+		LOG_ERROR("Cannot add event fd to epoll instance, error was: %s", strerror(errno));
+		::close(m_WakeupFd);
+		::close(m_EpollFd);
+		m_WakeupFd = -1;
+		m_EpollFd = -1;
+		return false;
+	}
+
+	return true;
+
+#else
+
+	LOG_ERROR("DeviceReactor is supported on Linux only");
+	return false;
+
+#endif
+}
+
+bool DeviceReactor::addEntry(DeviceEntry* entry)
+{
+	if (entry->onPacketsArrive == NULL)
+	{
+		LOG_ERROR("Cannot add a device without a callback");
+		return false;
+	}
+
+	for (std::vector<DeviceEntry*>::iterator iter = m_Devices.begin(); iter != m_Devices.end(); ++iter)
+	{
+		if ((*iter)->device == entry->device)
+		{
+			LOG_ERROR("Device already added to the reactor");
+			return false;
+		}
+	}
+
+	if (entry->fd < 0)
+	{
+		LOG_ERROR("Device has no selectable file descriptor");
+		return false;
+	}
+
+	if (!init())
+		return false;
+
+#ifdef LINUX
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = entry;
+	if (epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, entry->fd, &event) != 0)
+	{
+		LOG_ERROR("Cannot add device to epoll instance, error was: %s", strerror(errno));
+		return false;
+	}
+#endif
+
+	m_Devices.push_back(entry);
+	LOG_DEBUG("Device added to the reactor, %d devices", (int)m_Devices.size());
+	return true;
+}
+
+bool DeviceReactor::addDevice(PcapLiveDevice* device, OnReactorPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie)
+{
+	if (device == NULL || !device->isOpened())
+	{
+		LOG_ERROR("Cannot add a NULL or closed device to the reactor");
+		return false;
+	}
+
+	DeviceEntry* entry = new DeviceEntry();
+	entry->device = device;
+	entry->liveDevice = device;
+	entry->rawSocketDevice = NULL;
+	entry->fd = device->getSelectableFd();
+	entry->onPacketsArrive = onPacketsArrive;
+	entry->onPacketsArriveUserCookie = onPacketsArriveUserCookie;
+	entry->removed = false;
+	if (!addEntry(entry))
+	{
+		delete entry;
+		return false;
+	}
+
+	return true;
+}
+
+bool DeviceReactor::addDevice(RawSocketDevice* device, OnReactorPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie)
+{
+	if (device == NULL || !device->isOpened())
+	{
+		LOG_ERROR("Cannot add a NULL or closed device to the reactor");
+		return false;
+	}
+
+	DeviceEntry* entry = new DeviceEntry();
+	entry->device = device;
+	entry->liveDevice = NULL;
+	entry->rawSocketDevice = device;
+	entry->fd = device->getSelectableFd();
+	entry->onPacketsArrive = onPacketsArrive;
+	entry->onPacketsArriveUserCookie = onPacketsArriveUserCookie;
+	entry->removed = false;
+	if (!addEntry(entry))
+	{
+		delete entry;
+		return false;
+	}
+
+	return true;
+}
+
+bool DeviceReactor::removeDevice(IDevice* device)
+{
+	for (std::vector<DeviceEntry*>::iterator iter = m_Devices.begin(); iter != m_Devices.end(); ++iter)
+	{
+		DeviceEntry* entry = *iter;
+		if (entry->device != device)
+			continue;
+
+#ifdef LINUX
+		epoll_ctl(m_EpollFd, EPOLL_CTL_DEL, entry->fd, NULL);
+#endif
+		m_Devices.erase(iter);
+
+		// the entry may still be referenced by the ready events of the current round
+		entry->removed = true;
+		if (m_InRound)
+			m_RemovedDevices.push_back(entry);
+		else
+			delete entry;
+
+		LOG_DEBUG("Device removed from the reactor, %d devices", (int)m_Devices.size());
+		return true;
+	}
+
+	return false;
+}
+
+void DeviceReactor::deleteRemovedEntries()
+{
+	for (std::vector<DeviceEntry*>::iterator iter = m_RemovedDevices.begin(); iter != m_RemovedDevices.end(); ++iter)
+		delete *iter;
+	m_RemovedDevices.clear();
+}
+
+void DeviceReactor::onLiveDevicePacketsArrive(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* device, void* userCookie)
+{
+	DeviceEntry* entry = (DeviceEntry*)userCookie;
+	entry->onPacketsArrive(packets, numOfPackets, entry->device, entry->onPacketsArriveUserCookie);
+}
+
+void DeviceReactor::onRawSocketPacketsArrive(RawPacket* packets, uint32_t numOfPackets, RawSocketDevice* device, void* userCookie)
+{
+	DeviceEntry* entry = (DeviceEntry*)userCookie;
+	entry->onPacketsArrive(packets, numOfPackets, entry->device, entry->onPacketsArriveUserCookie);
+}
+
+int DeviceReactor::pollEntry(DeviceEntry* entry)
+{
+	if (entry->liveDevice != NULL)
+		return entry->liveDevice->pollPackets(&onLiveDevicePacketsArrive, entry, m_MaxBurstSize);
+
+	return entry->rawSocketDevice->pollPackets(&onRawSocketPacketsArrive, entry, (int)m_MaxBurstSize);
+}
+
+int DeviceReactor::runOnce(int timeoutMs)
+{
+#ifdef LINUX
+
+	// retry if creating the epoll instance in the c'tor failed
+	if (!init())
+		return -1;
+
+	epoll_event events[MAX_EVENTS_PER_ROUND];
+	int numOfEvents = epoll_wait(m_EpollFd, events, MAX_EVENTS_PER_ROUND, timeoutMs);
+	if (numOfEvents < 0)
+	{
+		if (errno == EINTR)
+			return 0;
+
+		LOG_ERROR("Waiting for devices failed, error was: %s", strerror(errno));
+		return -1;
+	}
+
+	int numOfPackets = 0;
+	m_InRound = true;
+	for (int i = 0; i < numOfEvents; i++)
+	{
+		DeviceEntry* entry = (DeviceEntry*)events[i].data.ptr;
+		if (entry == NULL)
+		{
+			uint64_t value;
+			if (read(m_WakeupFd, &value, sizeof(value)) < 0)
+				LOG_DEBUG("Reading the event fd failed, error was: %s", strerror(errno));
+			continue;
+		}
+
+		// a callback may have removed the device in this round
+		if (entry->removed)
+			continue;
+
+		int result = pollEntry(entry);
+		if (result > 0)
+			numOfPackets += result;
+	}
+	m_InRound = false;
+	deleteRemovedEntries();
+
+	return numOfPackets;
+
+#else
+
+	LOG_ERROR("DeviceReactor is supported on Linux only");
+	return -1;
+
+#endif
+}
+
+bool DeviceReactor::run()
+{
+	while (!m_StopRequested)
+	{
+		if (runOnce(-1) < 0)
+			return false;
+	}
+
+	m_StopRequested = false;
+	return true;
+}
+
+void DeviceReactor::stop()
+{
+	m_StopRequested = true;
+
+#ifdef LINUX
+	if (m_WakeupFd >= 0)
+	{
+		uint64_t value = 1;
+		if (write(m_WakeupFd, &value, sizeof(value)) < 0)
+			LOG_DEBUG("Writing to the event fd failed, error was: %s", strerror(errno));
+	}
+#endif
+}
+
+} // namespace pcpp
@@ -0,0 +1,127 @@
+#define LOG_MODULE PcapLogModuleDnsResponderEngine
+
+#include "DnsResponderEngine.h"
+#include "XdpDevice.h"
+#include "Logger.h"
+#ifdef USE_DPDK
+#include "DpdkForwarder.h"
+#include "DpdkDevice.h"
+#endif
+#include <string.h>
+
+namespace pcpp
+{
+
+#ifdef USE_DPDK
+
+DnsResponderEngine::DnsResponderEngine(DnsResponder& responder, DpdkDevice* device, uint16_t rxQueueId, uint16_t txQueueId) :
+	m_Responder(responder), m_XdpDevice(NULL), m_RxQueueId(rxQueueId), m_TxQueueId(txQueueId), m_TxBuffers(NULL)
+{
+	// MAC addresses are swapped by the responder, so the forwarder doesn't rewrite the packets itself
+	m_DpdkForwarder = new DpdkForwarder(device, rxQueueId, device, txQueueId);
+	m_DpdkForwarder->setForwardCallback(onDpdkPacket, this);
+	clearStats();
+}
+
+bool DnsResponderEngine::onDpdkPacket(MBufRawPacket& packet, void* userCookie)
+{
+	DnsResponderEngine* engine = (DnsResponderEngine*)userCookie;
+	// the mbuf limits the response length, a response which doesn't fit in it is detected by the responder
+	return engine->m_Responder.processPacket(packet, 0xffff) == DnsResponder::Responded;
+}
+
+#endif // USE_DPDK
+
+DnsResponderEngine::DnsResponderEngine(DnsResponder& responder, XdpDevice* device, uint16_t rxQueueId, uint16_t txQueueId) :
+	m_Responder(responder), m_DpdkForwarder(NULL), m_XdpDevice(device), m_RxQueueId(rxQueueId), m_TxQueueId(txQueueId)
+{
+	m_TxBuffers = new uint8_t[PCPP_DNS_RESPONDER_BURST_SIZE * PCPP_DNS_RESPONDER_BUFFER_SIZE];
+	clearStats();
+}
+
+DnsResponderEngine::~DnsResponderEngine()
+{
+#ifdef USE_DPDK
+	delete m_DpdkForwarder;
+#endif
+	delete [] m_TxBuffers;
+}
+
+uint16_t DnsResponderEngine::respondBurst()
+{
+#ifdef USE_DPDK
+	if (m_DpdkForwarder != NULL)
+		return m_DpdkForwarder->forwardBurst();
+#endif
+
+	if (m_XdpDevice != NULL)
+		return respondXdpBurst();
+
+	LOG_ERROR("DnsResponderEngine has no device");
+	return 0;
+}
+
+uint16_t DnsResponderEngine::respondXdpBurst()
+{
+	uint16_t numOfPackets = m_XdpDevice->receivePackets(m_RxPackets, PCPP_DNS_RESPONDER_BURST_SIZE, m_RxQueueId);
+	if (numOfPackets == 0)
+		return 0;
+
+	// the received packets point into the UMEM, which is given back to the kernel on the next receive, so the responses are built in
+	// buffers of the engine
+	uint16_t numOfResponses = 0;
+	for (uint16_t i = 0; i < numOfPackets; i++)
+	{
+		const RawPacket& rawPacket = m_RxPackets[i];
+		uint8_t* buffer = m_TxBuffers + numOfResponses * PCPP_DNS_RESPONDER_BUFFER_SIZE;
+		size_t dataLen = (size_t)rawPacket.getRawDataLen();
+		if (dataLen > PCPP_DNS_RESPONDER_BUFFER_SIZE)
+			dataLen = PCPP_DNS_RESPONDER_BUFFER_SIZE;
+
+		memcpy(buffer, rawPacket.getRawData(), dataLen);
+		if (m_Responder.processPacket(buffer, dataLen, PCPP_DNS_RESPONDER_BUFFER_SIZE) != DnsResponder::Responded)
+			continue;
+
+		m_TxPackets[numOfResponses].setExternalRawData(buffer, (int)dataLen, rawPacket.getPacketTimeStampNs(), LINKTYPE_ETHERNET);
+		numOfResponses++;
+	}
+
+	uint16_t numOfSent = 0;
+	if (numOfResponses > 0)
+		numOfSent = m_XdpDevice->sendPackets(m_TxPackets, numOfResponses, m_TxQueueId);
+
+	m_Stats.rxPackets += numOfPackets;
+	m_Stats.txPackets += numOfSent;
+	m_Stats.txDrops += numOfResponses - numOfSent;
+
+	return numOfPackets;
+}
+
+void DnsResponderEngine::getStats(DnsResponderEngineStats& stats) const
+{
+#ifdef USE_DPDK
+	if (m_DpdkForwarder != NULL)
+	{
+		DpdkForwarderStats forwarderStats;
+		m_DpdkForwarder->getStats(forwarderStats);
+		stats.rxPackets = forwarderStats.rxPackets;
+		stats.txPackets = forwarderStats.txPackets;
+		stats.txDrops = forwarderStats.txDrops;
+		return;
+	}
+#endif
+
+	stats = m_Stats;
+}
+
+void DnsResponderEngine::clearStats()
+{
+#ifdef USE_DPDK
+	if (m_DpdkForwarder != NULL)
+		m_DpdkForwarder->clearStats();
+#endif
+
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+} // namespace pcpp
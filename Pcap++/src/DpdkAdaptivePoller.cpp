@@ -0,0 +1,181 @@
+#ifdef USE_DPDK
+
+#define LOG_MODULE PcapLogModuleDpdkAdaptivePoller
+
+#define __STDC_LIMIT_MACROS
+
+#include "DpdkAdaptivePoller.h"
+#include "DpdkDevice.h"
+#include "Logger.h"
+#include "rte_version.h"
+#include "rte_config.h"
+#include "rte_ethdev.h"
+#include "rte_interrupts.h"
+#include "rte_cycles.h"
+#include "rte_pause.h"
+// waiting for a write to the RX ring with rte_power_monitor() is available since DPDK 21.02
+#if (RTE_VER_YEAR > 21) || (RTE_VER_YEAR == 21 && RTE_VER_MONTH >= 2)
+#define DPDK_POWER_MONITOR_SUPPORTED
+#include "rte_cpuflags.h"
+#include "rte_power_intrinsics.h"
+#endif
+#include <string.h>
+#include <errno.h>
+
+namespace pcpp
+{
+
+DpdkAdaptivePoller::DpdkAdaptivePoller(DpdkDevice* device, uint16_t rxQueueId, const DpdkAdaptivePollingConfig& config) :
+	m_Device(device), m_RxQueueId(rxQueueId), m_Config(config), m_ConsecutiveEmptyPolls(0), m_InterruptRegistered(false)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_Stats.idleState = DpdkIdleStateBusy;
+
+	m_MonitorSupported = false;
+#ifdef DPDK_POWER_MONITOR_SUPPORTED
+	struct rte_cpu_intrinsics intrinsics;
+	rte_cpu_get_intrinsics_support(&intrinsics);
+	m_MonitorSupported = (intrinsics.power_monitor != 0);
+#endif
+
+	// RX interrupts are available only if they were enabled when the device was opened
+	m_InterruptSupported = (device != NULL && device->m_Config.rxInterrupts);
+}
+
+DpdkAdaptivePoller::~DpdkAdaptivePoller()
+{
+	releaseRxInterrupt();
+}
+
+void DpdkAdaptivePoller::releaseRxInterrupt()
+{
+	if (!m_InterruptRegistered)
+		return;
+
+	rte_eth_dev_rx_intr_ctl_q(m_Device->getDeviceId(), m_RxQueueId, RTE_EPOLL_PER_THREAD, RTE_INTR_EVENT_DEL, NULL);
+	m_InterruptRegistered = false;
+}
+
+void DpdkAdaptivePoller::clearStats()
+{
+	DpdkIdleState idleState = m_Stats.idleState;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_Stats.idleState = idleState;
+}
+
+void DpdkAdaptivePoller::onTrafficReturned()
+{
+	if (m_Stats.idleState != DpdkIdleStateBusy)
+		m_Stats.busyReturns++;
+
+	m_ConsecutiveEmptyPolls = 0;
+	m_Stats.idleState = DpdkIdleStateBusy;
+}
+
+void DpdkAdaptivePoller::onEmptyPoll()
+{
+	m_Stats.emptyPolls++;
+	if (m_ConsecutiveEmptyPolls < UINT32_MAX)
+		m_ConsecutiveEmptyPolls++;
+
+	// the deepest step the empty polls reached is tried first, and a step which isn't available falls back to the one before it
+	if (m_Config.emptyPollsBeforeInterrupt != 0 && m_ConsecutiveEmptyPolls >= m_Config.emptyPollsBeforeInterrupt && waitForInterrupt())
+		return;
+
+	if (m_Config.emptyPollsBeforeMonitor != 0 && m_ConsecutiveEmptyPolls >= m_Config.emptyPollsBeforeMonitor && waitForMonitor())
+		return;
+
+	if (m_Config.emptyPollsBeforePause != 0 && m_ConsecutiveEmptyPolls >= m_Config.emptyPollsBeforePause)
+	{
+		uint64_t startTsc = rte_rdtsc();
+		for (uint32_t i = 0; i < m_Config.pausesPerPoll; i++)
+			rte_pause();
+
+		m_Stats.idleState = DpdkIdleStatePause;
+		m_Stats.pauses++;
+		m_Stats.idleCycles += rte_rdtsc() - startTsc;
+	}
+}
+
+bool DpdkAdaptivePoller::waitForMonitor()
+{
+#ifdef DPDK_POWER_MONITOR_SUPPORTED
+	if (!m_MonitorSupported)
+		return false;
+
+	// the monitored address is the next RX descriptor, so it's fetched again before each wait
+	struct rte_power_monitor_cond monitorCondition;
+	if (rte_eth_get_monitor_addr(m_Device->getDeviceId(), m_RxQueueId, &monitorCondition) != 0)
+	{
+		LOG_DEBUG("PMD doesn't support monitoring RX queue %d, the monitor step is disabled", m_RxQueueId);
+		m_MonitorSupported = false;
+		return false;
+	}
+
+	uint64_t startTsc = rte_rdtsc();
+	uint64_t timeoutTsc = rte_get_tsc_hz() / 1000000 * m_Config.monitorTimeoutUs;
+	if (rte_power_monitor(&monitorCondition, startTsc + timeoutTsc) != 0)
+	{
+		m_MonitorSupported = false;
+		return false;
+	}
+
+	m_Stats.idleState = DpdkIdleStateMonitor;
+	m_Stats.monitorWaits++;
+	m_Stats.idleCycles += rte_rdtsc() - startTsc;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool DpdkAdaptivePoller::waitForInterrupt()
+{
+	if (!m_InterruptSupported)
+		return false;
+
+	uint16_t portId = (uint16_t)m_Device->getDeviceId();
+
+	// the interrupt is registered to the epoll instance of the polling thread, so it's done on the first sleep rather than in the c'tor
+	if (!m_InterruptRegistered)
+	{
+		int res = rte_eth_dev_rx_intr_ctl_q(portId, m_RxQueueId, RTE_EPOLL_PER_THREAD, RTE_INTR_EVENT_ADD, NULL);
+		if (res != 0)
+		{
+			LOG_DEBUG("Cannot register RX interrupt of queue %d, error code: %d. The interrupt step is disabled", m_RxQueueId, res);
+			m_InterruptSupported = false;
+			return false;
+		}
+
+		m_InterruptRegistered = true;
+	}
+
+	if (rte_eth_dev_rx_intr_enable(portId, m_RxQueueId) != 0)
+	{
+		LOG_DEBUG("Cannot enable RX interrupt of queue %d. The interrupt step is disabled", m_RxQueueId);
+		m_InterruptSupported = false;
+		return false;
+	}
+
+	uint64_t startTsc = rte_rdtsc();
+
+	// packets which arrived after the last poll but before the interrupt was enabled don't raise it
+	if ((int)rte_eth_rx_queue_count(portId, m_RxQueueId) <= 0)
+	{
+		struct rte_epoll_event event;
+		int numOfEvents = rte_epoll_wait(RTE_EPOLL_PER_THREAD, &event, 1, m_Config.interruptTimeoutMs);
+		if (numOfEvents > 0)
+			m_Stats.interruptWakeups++;
+	}
+
+	rte_eth_dev_rx_intr_disable(portId, m_RxQueueId);
+
+	m_Stats.idleState = DpdkIdleStateInterrupt;
+	m_Stats.interruptWaits++;
+	m_Stats.idleCycles += rte_rdtsc() - startTsc;
+	return true;
+}
+
+} // namespace pcpp
+
+#endif /* USE_DPDK */
@@ -0,0 +1,577 @@
+#ifdef USE_DPDK
+
+#define LOG_MODULE PcapLogModuleDpdkCaptureWriter
+
+#include "DpdkCaptureWriter.h"
+#include "MBufRawPacket.h"
+#include "Logger.h"
+#include "rte_version.h"
+#include "rte_config.h"
+#include "rte_mbuf.h"
+#include "rte_ring.h"
+#include "rte_malloc.h"
+#include "rte_memcpy.h"
+#include "rte_prefetch.h"
+#include "rte_errno.h"
+#include "rte_branch_prediction.h"
+#include <deque>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// the enqueue and dequeue functions have an extra out parameter since DPDK 17.05
+#if (RTE_VER_YEAR > 17) || (RTE_VER_YEAR == 17 && RTE_VER_MONTH >= 5)
+#define RING_ENQUEUE_BURST(ring, objs, count) rte_ring_enqueue_burst(ring, objs, count, NULL)
+#define RING_DEQUEUE_BURST(ring, objs, count) rte_ring_dequeue_burst(ring, objs, count, NULL)
+#else
+#define RING_ENQUEUE_BURST(ring, objs, count) rte_ring_enqueue_burst(ring, objs, count)
+#define RING_DEQUEUE_BURST(ring, objs, count) rte_ring_dequeue_burst(ring, objs, count)
+#endif
+
+// the block size O_DIRECT writes must be aligned to
+#define DIRECT_IO_BLOCK_SIZE 4096
+
+#define PCAP_MAGIC_MICROSECONDS 0xa1b2c3d4
+#define PCAP_MAGIC_NANOSECONDS 0xa1b23c4d
+
+namespace pcpp
+{
+
+// the pcap file header and record header, in the byte order of the host as the magic number tells readers
+struct PcapFileHeader
+{
+	uint32_t magic;
+	uint16_t versionMajor;
+	uint16_t versionMinor;
+	int32_t thisZone;
+	uint32_t sigFigs;
+	uint32_t snapLength;
+	uint32_t linkType;
+};
+
+struct PcapRecordHeader
+{
+	uint32_t timestampSeconds;
+	uint32_t timestampFraction;
+	uint32_t capturedLength;
+	uint32_t originalLength;
+};
+
+// the state of each producer is written by one thread only, and is cache aligned so threads don't share cache lines
+struct DpdkCaptureWriter::ProducerState
+{
+	struct rte_ring* ring;
+	uint64_t enqueuedPackets;
+	uint64_t rejectedPackets;
+} __rte_cache_aligned;
+
+struct DpdkCaptureWriter::WriterState
+{
+	uint16_t id;
+	// the producers mapped to the writer
+	uint16_t* producers;
+	uint16_t numOfProducers;
+	// the producer whose ring is read first on the next drain, so all producers get the same share of the writer
+	uint16_t nextProducer;
+	// the buffer is aligned to DIRECT_IO_BLOCK_SIZE for O_DIRECT writes
+	uint8_t* buffer;
+	size_t bufferSize;
+	size_t bufferUsed;
+	int fd;
+	bool isDirect;
+	// the size of the current file including the buffered data
+	uint64_t fileSize;
+	uint32_t nextFileNumber;
+	std::deque<std::string> fileNames;
+	DpdkCaptureWriterStats stats;
+
+	WriterState() : id(0), producers(NULL), numOfProducers(0), nextProducer(0), buffer(NULL), bufferSize(0), bufferUsed(0), fd(-1),
+		isDirect(false), fileSize(0), nextFileNumber(0)
+	{
+		memset(&stats, 0, sizeof(stats));
+	}
+};
+
+// used for giving the rings of each capture writer unique names
+static uint32_t captureWriterCounter = 0;
+
+static inline void freeMBufs(struct rte_mbuf** mBufs, unsigned int count)
+{
+#if (RTE_VER_YEAR > 19) || (RTE_VER_YEAR == 19 && RTE_VER_MONTH >= 11)
+	rte_pktmbuf_free_bulk(mBufs, count);
+#else
+	for (unsigned int i = 0; i < count; i++)
+		rte_pktmbuf_free(mBufs[i]);
+#endif
+}
+
+// add a value to the reference counts of all segments of an mbuf, as rte_pktmbuf_free() decrements the reference count of each segment
+static inline void updateRefCount(struct rte_mbuf* mBuf, int16_t value)
+{
+	for (struct rte_mbuf* segment = mBuf; segment != NULL; segment = segment->next)
+		rte_mbuf_refcnt_update(segment, value);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DpdkCaptureWriter class
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+DpdkCaptureWriter::DpdkCaptureWriter(uint16_t numOfProducers, const DpdkCaptureWriterConfiguration& config) : m_Config(config)
+{
+	m_NumOfProducers = 0;
+	m_NumOfWriters = 0;
+	m_Valid = false;
+	m_Producers = NULL;
+	m_Writers = NULL;
+
+	if (numOfProducers == 0 || config.numOfWriters == 0 || config.ringSize == 0)
+	{
+		LOG_ERROR("Number of producers, number of writers and ring size must be larger than 0");
+		return;
+	}
+
+	if (config.snapshotLength == 0)
+	{
+		LOG_ERROR("Snapshot length must be larger than 0");
+		return;
+	}
+
+	m_Producers = (ProducerState*)rte_zmalloc("capture_writer_producers", sizeof(ProducerState) * numOfProducers, RTE_CACHE_LINE_SIZE);
+	if (m_Producers == NULL)
+	{
+		LOG_ERROR("Couldn't allocate the state of the capture writer");
+		return;
+	}
+
+	m_NumOfProducers = numOfProducers;
+	m_Writers = new WriterState[config.numOfWriters];
+	m_NumOfWriters = config.numOfWriters;
+
+	// an rte_ring of size N holds up to N-1 objects
+	uint32_t ringSize = rte_align32pow2(config.ringSize + 1);
+	uint32_t captureWriterId = captureWriterCounter++;
+	for (uint16_t i = 0; i < numOfProducers; i++)
+	{
+		char ringName[RTE_RING_NAMESIZE];
+		snprintf(ringName, sizeof(ringName), "pcpp_capw%u_%u", captureWriterId, (unsigned int)i);
+		m_Producers[i].ring = rte_ring_create(ringName, ringSize, SOCKET_ID_ANY, RING_F_SP_ENQ | RING_F_SC_DEQ);
+		if (m_Producers[i].ring == NULL)
+		{
+			LOG_ERROR("Couldn't create ring '%s' of size %d, error was: %s", ringName, (int)ringSize, rte_strerror(rte_errno));
+			return;
+		}
+	}
+
+	// the buffer holds at least one record of the largest size after the unaligned tail of the previous write
+	size_t minBufferSize = sizeof(PcapFileHeader) + sizeof(PcapRecordHeader) + config.snapshotLength + DIRECT_IO_BLOCK_SIZE;
+	size_t bufferSize = (config.bufferSize > minBufferSize ? config.bufferSize : minBufferSize);
+	bufferSize = (bufferSize + DIRECT_IO_BLOCK_SIZE - 1) & ~((size_t)DIRECT_IO_BLOCK_SIZE - 1);
+
+	// each producer is mapped to one writer and each writer has at least one producer if there are enough producers
+	for (uint16_t writerId = 0; writerId < m_NumOfWriters; writerId++)
+	{
+		WriterState& writer = m_Writers[writerId];
+		writer.id = writerId;
+
+		void* buffer = NULL;
+		if (posix_memalign(&buffer, DIRECT_IO_BLOCK_SIZE, bufferSize) != 0)
+		{
+			LOG_ERROR("Couldn't allocate a buffer of %d bytes for writer %d", (int)bufferSize, (int)writerId);
+			return;
+		}
+		writer.buffer = (uint8_t*)buffer;
+		writer.bufferSize = bufferSize;
+
+		uint16_t numOfWriterProducers = (numOfProducers / m_NumOfWriters) + (writerId < numOfProducers % m_NumOfWriters ? 1 : 0);
+		if (numOfWriterProducers == 0)
+			continue;
+
+		writer.producers = new uint16_t[numOfWriterProducers];
+		for (uint16_t producerId = writerId; producerId < numOfProducers; producerId += m_NumOfWriters)
+			writer.producers[writer.numOfProducers++] = producerId;
+	}
+
+	m_Valid = true;
+	LOG_DEBUG("Created a capture writer of %d producers and %d writers", (int)m_NumOfProducers, (int)m_NumOfWriters);
+}
+
+DpdkCaptureWriter::~DpdkCaptureWriter()
+{
+	if (m_Writers != NULL)
+	{
+		for (uint16_t i = 0; i < m_NumOfWriters; i++)
+		{
+			if (m_Valid)
+				closeWriter(i);
+
+			free(m_Writers[i].buffer);
+			delete [] m_Writers[i].producers;
+		}
+
+		delete [] m_Writers;
+	}
+
+	if (m_Producers != NULL)
+	{
+		for (uint16_t i = 0; i < m_NumOfProducers; i++)
+		{
+			if (m_Producers[i].ring == NULL)
+				continue;
+
+			// rings of an invalid capture writer weren't drained
+			struct rte_mbuf* mBufs[PCPP_DPDK_CAPTURE_WRITER_BURST_SIZE];
+			unsigned int numOfMBufs = 0;
+			while ((numOfMBufs = RING_DEQUEUE_BURST(m_Producers[i].ring, (void**)mBufs, PCPP_DPDK_CAPTURE_WRITER_BURST_SIZE)) > 0)
+				freeMBufs(mBufs, numOfMBufs);
+
+			rte_ring_free(m_Producers[i].ring);
+		}
+
+		rte_free(m_Producers);
+	}
+}
+
+uint16_t DpdkCaptureWriter::recordPackets(uint16_t producerId, MBufRawPacket** packets, uint16_t count)
+{
+	if (unlikely(!m_Valid || producerId >= m_NumOfProducers))
+	{
+		LOG_ERROR("Capture writer isn't valid or producer %d doesn't exist", (int)producerId);
+		return 0;
+	}
+
+	ProducerState& producer = m_Producers[producerId];
+	uint16_t numOfEnqueued = 0;
+	uint16_t index = 0;
+	while (index < count)
+	{
+		struct rte_mbuf* mBufs[PCPP_DPDK_CAPTURE_WRITER_BURST_SIZE];
+		uint16_t batchSize = 0;
+		for (; index < count && batchSize < PCPP_DPDK_CAPTURE_WRITER_BURST_SIZE; index++)
+		{
+			struct rte_mbuf* mBuf = packets[index]->getMBuf();
+			if (unlikely(mBuf == NULL || rte_pktmbuf_headroom(mBuf) < sizeof(PcapRecordHeader)))
+			{
+				producer.rejectedPackets++;
+				continue;
+			}
+
+			// the record header is written in front of the packet data, so the writer copies the whole record from the mbuf
+			timespec timestamp = packets[index]->getPacketTimeStampNs();
+			PcapRecordHeader recordHeader;
+			recordHeader.timestampSeconds = (uint32_t)timestamp.tv_sec;
+			recordHeader.timestampFraction = (uint32_t)(m_Config.nanosecondsPrecision ? timestamp.tv_nsec : timestamp.tv_nsec / 1000);
+			recordHeader.originalLength = rte_pktmbuf_pkt_len(mBuf);
+			recordHeader.capturedLength = (recordHeader.originalLength < m_Config.snapshotLength ? recordHeader.originalLength : m_Config.snapshotLength);
+			memcpy(rte_pktmbuf_mtod(mBuf, uint8_t*) - sizeof(PcapRecordHeader), &recordHeader, sizeof(PcapRecordHeader));
+
+			updateRefCount(mBuf, 1);
+			mBufs[batchSize++] = mBuf;
+		}
+
+		if (batchSize == 0)
+			continue;
+
+		uint16_t enqueued = (uint16_t)RING_ENQUEUE_BURST(producer.ring, (void**)mBufs, batchSize);
+		for (uint16_t i = enqueued; i < batchSize; i++)
+			updateRefCount(mBufs[i], -1);
+
+		numOfEnqueued += enqueued;
+		producer.enqueuedPackets += enqueued;
+		producer.rejectedPackets += batchSize - enqueued;
+
+		// the ring is full, the rest of the packets aren't recorded
+		if (enqueued < batchSize)
+		{
+			producer.rejectedPackets += count - index;
+			break;
+		}
+	}
+
+	return numOfEnqueued;
+}
+
+bool DpdkCaptureWriter::recordPacket(uint16_t producerId, MBufRawPacket& packet)
+{
+	MBufRawPacket* packetPtr = &packet;
+	return recordPackets(producerId, &packetPtr, 1) == 1;
+}
+
+uint32_t DpdkCaptureWriter::drainWriter(uint16_t writerId)
+{
+	if (unlikely(!m_Valid || writerId >= m_NumOfWriters))
+	{
+		LOG_ERROR("Capture writer isn't valid or writer %d doesn't exist", (int)writerId);
+		return 0;
+	}
+
+	WriterState& writer = m_Writers[writerId];
+	uint32_t numOfWritten = 0;
+	for (uint16_t i = 0; i < writer.numOfProducers; i++)
+	{
+		uint16_t producerIndex = writer.nextProducer + i;
+		if (producerIndex >= writer.numOfProducers)
+			producerIndex -= writer.numOfProducers;
+
+		struct rte_mbuf* mBufs[PCPP_DPDK_CAPTURE_WRITER_BURST_SIZE];
+		unsigned int numOfMBufs = RING_DEQUEUE_BURST(m_Producers[writer.producers[producerIndex]].ring, (void**)mBufs,
+				PCPP_DPDK_CAPTURE_WRITER_BURST_SIZE);
+		for (unsigned int j = 0; j < numOfMBufs; j++)
+		{
+			if (j + 1 < numOfMBufs)
+				rte_prefetch0(rte_pktmbuf_mtod(mBufs[j + 1], uint8_t*) - sizeof(PcapRecordHeader));
+			appendRecord(writer, mBufs[j]);
+		}
+
+		freeMBufs(mBufs, numOfMBufs);
+		numOfWritten += numOfMBufs;
+	}
+
+	if (writer.numOfProducers > 0 && ++writer.nextProducer >= writer.numOfProducers)
+		writer.nextProducer = 0;
+
+	return numOfWritten;
+}
+
+void DpdkCaptureWriter::closeWriter(uint16_t writerId)
+{
+	if (!m_Valid || writerId >= m_NumOfWriters)
+		return;
+
+	while (drainWriter(writerId) > 0)
+		;
+
+	WriterState& writer = m_Writers[writerId];
+	if (writer.fd >= 0)
+		closeFile(writer);
+}
+
+void DpdkCaptureWriter::appendRecord(WriterState& writer, struct rte_mbuf* mBuf)
+{
+	const uint8_t* record = rte_pktmbuf_mtod(mBuf, uint8_t*) - sizeof(PcapRecordHeader);
+	PcapRecordHeader recordHeader;
+	memcpy(&recordHeader, record, sizeof(PcapRecordHeader));
+	size_t recordLen = sizeof(PcapRecordHeader) + recordHeader.capturedLength;
+
+	if (writer.fd >= 0 && m_Config.maxFileSize > 0 && writer.fileSize > sizeof(PcapFileHeader) &&
+			writer.fileSize + recordLen > m_Config.maxFileSize)
+		closeFile(writer);
+
+	if (writer.fd < 0 && !openFile(writer))
+		return;
+
+	if (writer.bufferUsed + recordLen > writer.bufferSize)
+		writeBuffer(writer, false);
+
+	// the record header and the data of the first segment are contiguous in the mbuf
+	uint8_t* dest = writer.buffer + writer.bufferUsed;
+	size_t firstLen = sizeof(PcapRecordHeader) + (rte_pktmbuf_data_len(mBuf) < recordHeader.capturedLength ? rte_pktmbuf_data_len(mBuf) : recordHeader.capturedLength);
+	rte_memcpy(dest, record, firstLen);
+	size_t copied = firstLen;
+	for (struct rte_mbuf* segment = mBuf->next; segment != NULL && copied < recordLen; segment = segment->next)
+	{
+		size_t segmentLen = (rte_pktmbuf_data_len(segment) < recordLen - copied ? rte_pktmbuf_data_len(segment) : recordLen - copied);
+		rte_memcpy(dest + copied, rte_pktmbuf_mtod(segment, uint8_t*), segmentLen);
+		copied += segmentLen;
+	}
+
+	writer.bufferUsed += recordLen;
+	writer.fileSize += recordLen;
+	writer.stats.writtenPackets++;
+}
+
+bool DpdkCaptureWriter::openFile(WriterState& writer)
+{
+	const std::string directory = (m_Config.directories.empty() ? std::string(".") : m_Config.directories[writer.id % m_Config.directories.size()]);
+	char fileNumber[32];
+	snprintf(fileNumber, sizeof(fileNumber), "_%u_%06u.pcap", (unsigned int)writer.id, writer.nextFileNumber++);
+	std::string fileName = directory + "/" + m_Config.fileNamePrefix + fileNumber;
+
+	writer.isDirect = false;
+	writer.fd = -1;
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+	if (m_Config.directIo)
+	{
+		writer.fd = ::open(fileName.c_str(), flags | O_DIRECT, 0644);
+		if (writer.fd >= 0)
+			writer.isDirect = true;
+		else if (errno == EINVAL)
+			LOG_DEBUG("File system of '%s' doesn't support O_DIRECT, writing through the page cache", fileName.c_str());
+	}
+#endif
+
+	if (writer.fd < 0)
+		writer.fd = ::open(fileName.c_str(), flags, 0644);
+
+	if (writer.fd < 0)
+	{
+		LOG_ERROR("Cannot open file '%s' of writer %d, error was: %d", fileName.c_str(), (int)writer.id, errno);
+		writer.stats.writeErrors++;
+		return false;
+	}
+
+	PcapFileHeader fileHeader;
+	fileHeader.magic = (m_Config.nanosecondsPrecision ? PCAP_MAGIC_NANOSECONDS : PCAP_MAGIC_MICROSECONDS);
+	fileHeader.versionMajor = 2;
+	fileHeader.versionMinor = 4;
+	fileHeader.thisZone = 0;
+	fileHeader.sigFigs = 0;
+	fileHeader.snapLength = m_Config.snapshotLength;
+	fileHeader.linkType = (uint32_t)m_Config.linkLayerType;
+	memcpy(writer.buffer, &fileHeader, sizeof(fileHeader));
+	writer.bufferUsed = sizeof(fileHeader);
+	writer.fileSize = sizeof(fileHeader);
+	writer.stats.numOfFiles++;
+
+	writer.fileNames.push_back(fileName);
+	if (m_Config.maxNumOfFiles > 0 && writer.fileNames.size() > m_Config.maxNumOfFiles)
+	{
+		if (unlink(writer.fileNames.front().c_str()) != 0)
+			LOG_DEBUG("Cannot delete file '%s', error was: %d", writer.fileNames.front().c_str(), errno);
+		writer.fileNames.pop_front();
+	}
+
+	LOG_DEBUG("Writer %d opened file '%s'%s", (int)writer.id, fileName.c_str(), (writer.isDirect ? " with O_DIRECT" : ""));
+	return true;
+}
+
+void DpdkCaptureWriter::closeFile(WriterState& writer)
+{
+	writeBuffer(writer, true);
+
+	// the last O_DIRECT write is padded to a whole block, which is cut off here
+	if (writer.isDirect && ftruncate(writer.fd, (off_t)writer.fileSize) != 0)
+		LOG_ERROR("Cannot truncate file '%s' to its size, error was: %d", writer.fileNames.back().c_str(), errno);
+
+	::close(writer.fd);
+	writer.fd = -1;
+	writer.bufferUsed = 0;
+}
+
+void DpdkCaptureWriter::writeBuffer(WriterState& writer, bool final)
+{
+	if (writer.fd < 0 || writer.bufferUsed == 0)
+		return;
+
+	// O_DIRECT writes whole blocks: the unaligned tail is kept for the next write, and the last write of a file is padded
+	size_t writeLen = writer.bufferUsed;
+	if (writer.isDirect)
+	{
+		if (final)
+		{
+			writeLen = (writer.bufferUsed + DIRECT_IO_BLOCK_SIZE - 1) & ~((size_t)DIRECT_IO_BLOCK_SIZE - 1);
+			memset(writer.buffer + writer.bufferUsed, 0, writeLen - writer.bufferUsed);
+		}
+		else
+		{
+			writeLen = writer.bufferUsed & ~((size_t)DIRECT_IO_BLOCK_SIZE - 1);
+			if (writeLen == 0)
+				return;
+		}
+	}
+
+	size_t dataLen = (writeLen < writer.bufferUsed ? writeLen : writer.bufferUsed);
+	size_t offset = 0;
+	while (offset < writeLen)
+	{
+		ssize_t written = ::write(writer.fd, writer.buffer + offset, writeLen - offset);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			LOG_ERROR("Writer %d failed to write %d bytes, error was: %d", (int)writer.id, (int)(writeLen - offset), errno);
+			writer.stats.writeErrors++;
+			break;
+		}
+
+		offset += (size_t)written;
+	}
+
+	writer.stats.writtenBytes += (offset < dataLen ? offset : dataLen);
+
+	if (writeLen < writer.bufferUsed)
+		memmove(writer.buffer, writer.buffer + writeLen, writer.bufferUsed - writeLen);
+	writer.bufferUsed -= dataLen;
+}
+
+void DpdkCaptureWriter::getFileNames(uint16_t writerId, std::vector<std::string>& fileNames) const
+{
+	fileNames.clear();
+	if (!m_Valid || writerId >= m_NumOfWriters)
+		return;
+
+	fileNames.assign(m_Writers[writerId].fileNames.begin(), m_Writers[writerId].fileNames.end());
+}
+
+void DpdkCaptureWriter::getProducerStats(uint16_t producerId, DpdkCaptureWriterProducerStats& stats) const
+{
+	memset(&stats, 0, sizeof(stats));
+	if (!m_Valid || producerId >= m_NumOfProducers)
+		return;
+
+	stats.enqueuedPackets = m_Producers[producerId].enqueuedPackets;
+	stats.rejectedPackets = m_Producers[producerId].rejectedPackets;
+	stats.pendingPackets = rte_ring_count(m_Producers[producerId].ring);
+}
+
+void DpdkCaptureWriter::getWriterStats(uint16_t writerId, DpdkCaptureWriterStats& stats) const
+{
+	memset(&stats, 0, sizeof(stats));
+	if (!m_Valid || writerId >= m_NumOfWriters)
+		return;
+
+	stats = m_Writers[writerId].stats;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DpdkCaptureWriterThread class
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+DpdkCaptureWriterThread::DpdkCaptureWriterThread(DpdkCaptureWriter* captureWriter, const std::vector<uint16_t>& writers)
+{
+	m_CaptureWriter = captureWriter;
+	m_Writers = writers;
+	m_CoreId = MAX_NUM_OF_CORES + 1;
+	m_Stop = true;
+}
+
+bool DpdkCaptureWriterThread::run(uint32_t coreId)
+{
+	m_CoreId = coreId;
+
+	if (m_CaptureWriter == NULL || !m_CaptureWriter->isValid())
+	{
+		LOG_ERROR("Capture writer thread on core %d has no valid capture writer", (int)coreId);
+		return false;
+	}
+
+	m_Stop = false;
+	LOG_DEBUG("Capture writer thread started on core %d", (int)coreId);
+
+	while (!m_Stop)
+	{
+		for (std::vector<uint16_t>::const_iterator iter = m_Writers.begin(); iter != m_Writers.end(); iter++)
+			m_CaptureWriter->drainWriter(*iter);
+	}
+
+	for (std::vector<uint16_t>::const_iterator iter = m_Writers.begin(); iter != m_Writers.end(); iter++)
+		m_CaptureWriter->closeWriter(*iter);
+
+	LOG_DEBUG("Capture writer thread on core %d stopped", (int)coreId);
+	return true;
+}
+
+void DpdkCaptureWriterThread::stop()
+{
+	m_Stop = true;
+}
+
+} // namespace pcpp
+
+#endif /* USE_DPDK */
@@ -8,6 +8,8 @@
 #include "DpdkDevice.h"
 #include "DpdkDeviceList.h"
 #include "Logger.h"
+#include "TimestampClock.h"
+#include "LatencyTracer.h"
 #include "rte_version.h"
 #if (RTE_VER_YEAR > 17) || (RTE_VER_YEAR == 17 && RTE_VER_MONTH >= 11)
 #include "rte_bus_pci.h"
@@ -15,16 +17,49 @@
 #include "rte_pci.h"
 #include "rte_config.h"
 #include "rte_ethdev.h"
+#include "rte_mbuf.h"
 #include "rte_errno.h"
 #include "rte_malloc.h"
+#include "rte_memzone.h"
+#include "rte_atomic.h"
 #include "rte_cycles.h"
+#include "rte_prefetch.h"
+// the rte_flow RSS action has its current layout since DPDK 18.05, filters aren't offloaded on older versions
+#if (RTE_VER_YEAR > 18) || (RTE_VER_YEAR == 18 && RTE_VER_MONTH >= 5)
+#define DPDK_FLOW_RULES_SUPPORTED
+#include "rte_flow.h"
+#endif
+// hardware offloads are configured with the per-port offloads API which replaced the rxmode bit-fields in DPDK 18.11
+#if (RTE_VER_YEAR > 18) || (RTE_VER_YEAR == 18 && RTE_VER_MONTH >= 11)
+#define DPDK_OFFLOADS_SUPPORTED
+#endif
+// the size of the groups the RSS redirection table is accessed in was renamed in DPDK 21.11
+#ifdef RTE_ETH_RETA_GROUP_SIZE
+#define DPDK_RETA_GROUP_SIZE RTE_ETH_RETA_GROUP_SIZE
+#else
+#define DPDK_RETA_GROUP_SIZE RTE_RETA_GROUP_SIZE
+#endif
+#include "EthLayer.h"
+#include "IPv4Layer.h"
+#include "PacketSegmenter.h"
+#include "EndianPortable.h"
+#include <pcap.h>
 #include <string>
 #include <stdint.h>
 #include <unistd.h>
+#include <signal.h>
+#include <errno.h>
 
 #define MAX_BURST_SIZE 64
 
-#define MEMPOOL_CACHE_SIZE 256
+#define SOFTWARE_FILTER_SNAPLEN 65535
+
+// the flag of mbufs which carry the RSS hash was renamed in DPDK 21.11
+#ifdef RTE_MBUF_F_RX_RSS_HASH
+#define MBUF_RX_RSS_HASH RTE_MBUF_F_RX_RSS_HASH
+#else
+#define MBUF_RX_RSS_HASH PKT_RX_RSS_HASH
+#endif
 
 namespace pcpp
 {
@@ -52,7 +87,33 @@ uint8_t DpdkDevice::m_RSSKey[40] = {
 		0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A,
 	};
 
-DpdkDevice::DpdkDevice(int port, uint32_t mBufPoolSize)
+// the socket to allocate the device's memory on: the device's NUMA node if it's known, otherwise the node of the calling core
+static int getDeviceAllocationSocketId(int portId)
+{
+	int socketId = rte_eth_dev_socket_id((uint8_t) portId);
+	return (socketId >= 0 ? socketId : (int)rte_socket_id());
+}
+
+// the name of the memzone which holds the state of the ports shared with secondary processes
+#define SHARED_PORT_STATES_MEMZONE_NAME "pcpp_shared_port_states"
+
+// the state of a port shared between the primary process and the secondary processes. It's written by the primary process, except
+// for the queue owners which are claimed by all processes
+struct DpdkDevice::SharedPortState
+{
+	char mBufPoolName[RTE_MEMPOOL_NAMESIZE];
+	uint8_t mBufPoolShared;
+	volatile uint64_t enabledOffloads;
+	volatile uint16_t numOfRxQueuesOpened;
+	volatile uint16_t numOfTxQueuesOpened;
+	// the ID of the process which claimed each queue, or 0 if the queue isn't claimed
+	rte_atomic32_t rxQueueOwners[DPDK_MAX_RX_QUEUES];
+	rte_atomic32_t txQueueOwners[DPDK_MAX_RX_QUEUES];
+};
+
+DpdkDevice::SharedPortState* DpdkDevice::m_SharedPortStates = NULL;
+
+DpdkDevice::DpdkDevice(int port, const DpdkMBufPoolConfig& mBufPoolConfig, struct rte_mempool* sharedMBufPool)
 	: m_Id(port), m_MacAddress(MacAddress::Zero)
 {
 	snprintf((char*)m_DeviceName, 30, "DPDK_%d", m_Id);
@@ -69,12 +130,33 @@ DpdkDevice::DpdkDevice(int port, uint32_t mBufPoolSize)
 
 	rte_eth_dev_get_mtu((uint8_t) m_Id, &m_DeviceMtu);
 
-	char mBufMemPoolName[32];
-	sprintf(mBufMemPoolName, "MBufMemPool%d", m_Id);
-	if (!initMemPool(m_MBufMempool, mBufMemPoolName, mBufPoolSize))
+	m_MBufPoolShared = (sharedMBufPool != NULL);
+	if (m_MBufPoolShared)
 	{
-		LOG_ERROR("Could not initialize mBuf mempool. Device not initialized");
-		return;
+		m_MBufMempool = sharedMBufPool;
+	}
+	else
+	{
+		char mBufMemPoolName[32];
+		sprintf(mBufMemPoolName, "MBufMemPool%d", m_Id);
+		m_MBufMempool = createMBufPool(mBufMemPoolName, mBufPoolConfig, getMBufPoolSocketId(m_Id, mBufPoolConfig));
+		if (m_MBufMempool == NULL)
+		{
+			LOG_ERROR("Could not initialize mBuf mempool. Device not initialized");
+			return;
+		}
+	}
+
+	if (DpdkDeviceList::isSecondaryProcess())
+	{
+		// the pool was created by the primary process, so it's shared only if the primary process shares it between devices
+		m_MBufPoolShared = (m_SharedPortStates[m_Id].mBufPoolShared != 0);
+	}
+	else if (m_SharedPortStates != NULL)
+	{
+		SharedPortState& portState = m_SharedPortStates[m_Id];
+		snprintf(portState.mBufPoolName, sizeof(portState.mBufPoolName), "%s", m_MBufMempool->name);
+		portState.mBufPoolShared = (m_MBufPoolShared ? 1 : 0);
 	}
 
 	m_NumOfRxQueuesOpened = 0;
@@ -87,6 +169,18 @@ DpdkDevice::DpdkDevice(int port, uint32_t mBufPoolSize)
 	m_TxBuffers = NULL;
 	m_TxBufferLastDrainTsc = NULL;
 
+	m_SoftwareFilter = NULL;
+	m_RxSamplers = NULL;
+	m_NextSteeringRuleId = 0;
+
+	m_RxBurstCounters = NULL;
+	m_RxBurstStatsEnabled = false;
+
+	m_CaptureAdaptivePolling = false;
+	memset(m_CapturePollers, 0, sizeof(m_CapturePollers));
+
+	m_RxPrefetchDistance = 0;
+
 	m_DeviceOpened = false;
 	m_WasOpened = false;
 	m_StopThread = true;
@@ -99,6 +193,20 @@ DpdkDevice::~DpdkDevice()
 
 	if (m_TxBufferLastDrainTsc != NULL)
 		delete [] m_TxBufferLastDrainTsc;
+
+	if (m_SoftwareFilter != NULL)
+	{
+		pcap_freecode(m_SoftwareFilter);
+		delete m_SoftwareFilter;
+	}
+
+	if (m_RxBurstCounters != NULL)
+		rte_free(m_RxBurstCounters);
+
+	if (m_RxSamplers != NULL)
+		delete [] m_RxSamplers;
+
+	deleteCapturePollers();
 }
 
 uint32_t DpdkDevice::getCurrentCoreId()
@@ -128,6 +236,12 @@ bool DpdkDevice::openMultiQueues(uint16_t numOfRxQueuesToOpen, uint16_t numOfTxQ
 		return false;
 	}
 
+	if (DpdkDeviceList::isSecondaryProcess())
+	{
+		LOG_ERROR("Device [%s] can't be opened by a secondary process, its queues should be claimed using attachQueues()", m_DeviceName);
+		return false;
+	}
+
 	// There is a VMXNET3 limitation that when opening a device with a certain number of RX+TX queues
 	// it's impossible to close it and open it again with a larger number of RX+TX queues. So for this
 	// PMD I made a patch to open the device in the first time with maximum RX & TX queue, close it
@@ -165,6 +279,7 @@ bool DpdkDevice::openMultiQueues(uint16_t numOfRxQueuesToOpen, uint16_t numOfTxQ
 	rte_eth_stats_reset(m_Id);
 
 	m_DeviceOpened = true;
+	publishPortState();
 	return m_DeviceOpened;
 }
 
@@ -177,12 +292,250 @@ void DpdkDevice::close()
 		return;
 	}
 	stopCapture();
+	clearFilter();
+	clearSampling();
+	removeAllFlowRules();
 	clearCoreConfiguration();
+	releaseQueues();
 	m_NumOfRxQueuesOpened = 0;
 	m_NumOfTxQueuesOpened = 0;
+
+	if (DpdkDeviceList::isSecondaryProcess())
+	{
+		// the port belongs to the primary process which keeps it running
+		LOG_DEBUG("Detached from device [%s]", m_DeviceName);
+		m_DeviceOpened = false;
+		return;
+	}
+
+	m_DeviceOpened = false;
+	publishPortState();
 	rte_eth_dev_stop(m_Id);
 	LOG_DEBUG("Called rte_eth_dev_stop for device [%s]", m_DeviceName);
-	m_DeviceOpened = false;
+}
+
+
+bool DpdkDevice::initSharedPortStates(bool create)
+{
+	const struct rte_memzone* memzone = NULL;
+	if (create)
+	{
+		memzone = rte_memzone_reserve(SHARED_PORT_STATES_MEMZONE_NAME, sizeof(SharedPortState) * RTE_MAX_ETHPORTS, SOCKET_ID_ANY, 0);
+		if (memzone != NULL)
+			memset(memzone->addr, 0, sizeof(SharedPortState) * RTE_MAX_ETHPORTS);
+	}
+	else
+		memzone = rte_memzone_lookup(SHARED_PORT_STATES_MEMZONE_NAME);
+
+	if (memzone == NULL)
+	{
+		LOG_ERROR("Couldn't %s the shared state of the DPDK ports: %s", (create ? "allocate" : "find"), rte_strerror(rte_errno));
+		return false;
+	}
+
+	m_SharedPortStates = (SharedPortState*)memzone->addr;
+	return true;
+}
+
+struct rte_mempool* DpdkDevice::lookupMBufPool(int port)
+{
+	if (m_SharedPortStates == NULL || port >= RTE_MAX_ETHPORTS || m_SharedPortStates[port].mBufPoolName[0] == '\0')
+	{
+		LOG_ERROR("Port %d wasn't initialized by the primary process", port);
+		return NULL;
+	}
+
+	struct rte_mempool* mempool = rte_mempool_lookup(m_SharedPortStates[port].mBufPoolName);
+	if (mempool == NULL)
+	{
+		LOG_ERROR("Couldn't find packets memory pool %s of port %d: %s", m_SharedPortStates[port].mBufPoolName, port, rte_strerror(rte_errno));
+		return NULL;
+	}
+
+	return mempool;
+}
+
+void DpdkDevice::publishPortState()
+{
+	if (m_SharedPortStates == NULL)
+		return;
+
+	SharedPortState& portState = m_SharedPortStates[m_Id];
+	if (m_DeviceOpened)
+	{
+		// the queue numbers tell secondary processes the port is ready, so they're written last
+		portState.enabledOffloads = m_Config.offloads;
+		rte_smp_wmb();
+		portState.numOfRxQueuesOpened = m_NumOfRxQueuesOpened;
+		portState.numOfTxQueuesOpened = m_NumOfTxQueuesOpened;
+		return;
+	}
+
+	// the queues are gone, so are the claims of all processes
+	portState.numOfRxQueuesOpened = 0;
+	portState.numOfTxQueuesOpened = 0;
+	for (int i = 0; i < DPDK_MAX_RX_QUEUES; i++)
+	{
+		rte_atomic32_clear(&portState.rxQueueOwners[i]);
+		rte_atomic32_clear(&portState.txQueueOwners[i]);
+	}
+}
+
+// claims a queue for the process unless another process which is still running claimed it. currentOwner is set to the owner
+// before the claim, so it equals the process ID if the process already claimed the queue
+static bool claimQueue(rte_atomic32_t* owner, int32_t processId, int32_t& currentOwner)
+{
+	while (true)
+	{
+		currentOwner = rte_atomic32_read(owner);
+		if (currentOwner == processId)
+			return true;
+
+		// the claims of processes which exited without detaching are taken over
+		if (currentOwner != 0 && (kill((pid_t)currentOwner, 0) == 0 || errno != ESRCH))
+			return false;
+
+		if (rte_atomic32_cmpset((volatile uint32_t*)&owner->cnt, (uint32_t)currentOwner, (uint32_t)processId))
+			return true;
+	}
+}
+
+static void releaseQueueClaims(const std::vector<rte_atomic32_t*>& owners, int32_t processId)
+{
+	for (std::vector<rte_atomic32_t*>::const_iterator iter = owners.begin(); iter != owners.end(); iter++)
+		rte_atomic32_cmpset((volatile uint32_t*)&(*iter)->cnt, (uint32_t)processId, 0);
+}
+
+bool DpdkDevice::attachQueues(const std::vector<uint16_t>& rxQueues, const std::vector<uint16_t>& txQueues)
+{
+	if (m_SharedPortStates == NULL)
+	{
+		LOG_ERROR("The state of the DPDK ports isn't shared, queues can't be claimed");
+		return false;
+	}
+
+	bool isSecondaryProcess = DpdkDeviceList::isSecondaryProcess();
+	if (!isSecondaryProcess && !m_DeviceOpened)
+	{
+		LOG_ERROR("Device [%s] not opened", m_DeviceName);
+		return false;
+	}
+
+	SharedPortState& portState = m_SharedPortStates[m_Id];
+	uint16_t numOfRxQueues = portState.numOfRxQueuesOpened;
+	uint16_t numOfTxQueues = portState.numOfTxQueuesOpened;
+	rte_smp_rmb();
+	if (numOfRxQueues == 0 && numOfTxQueues == 0)
+	{
+		LOG_ERROR("Device [%s] isn't opened by the primary process", m_DeviceName);
+		return false;
+	}
+
+	for (std::vector<uint16_t>::const_iterator iter = rxQueues.begin(); iter != rxQueues.end(); iter++)
+	{
+		if (*iter >= numOfRxQueues || *iter >= DPDK_MAX_RX_QUEUES)
+		{
+			LOG_ERROR("RX queue %d doesn't exist, device [%s] has %d RX queues opened", (int)*iter, m_DeviceName, (int)numOfRxQueues);
+			return false;
+		}
+	}
+
+	for (std::vector<uint16_t>::const_iterator iter = txQueues.begin(); iter != txQueues.end(); iter++)
+	{
+		if (*iter >= numOfTxQueues || *iter >= DPDK_MAX_RX_QUEUES)
+		{
+			LOG_ERROR("TX queue %d doesn't exist, device [%s] has %d TX queues opened", (int)*iter, m_DeviceName, (int)numOfTxQueues);
+			return false;
+		}
+	}
+
+	// a secondary process has its own TX buffers for the queues of the port
+	if (isSecondaryProcess && !m_DeviceOpened && !initTxBuffers(numOfTxQueues))
+		return false;
+
+	int32_t processId = (int32_t)getpid();
+	std::vector<rte_atomic32_t*> newClaims;
+	for (size_t i = 0; i < rxQueues.size() + txQueues.size(); i++)
+	{
+		bool isRxQueue = (i < rxQueues.size());
+		uint16_t queueId = (isRxQueue ? rxQueues[i] : txQueues[i - rxQueues.size()]);
+		rte_atomic32_t* owner = (isRxQueue ? &portState.rxQueueOwners[queueId] : &portState.txQueueOwners[queueId]);
+		int32_t currentOwner = 0;
+		if (!claimQueue(owner, processId, currentOwner))
+		{
+			LOG_ERROR("%s queue %d of device [%s] is claimed by process %d", (isRxQueue ? "RX" : "TX"), (int)queueId, m_DeviceName, (int)currentOwner);
+			releaseQueueClaims(newClaims, processId);
+			return false;
+		}
+
+		if (currentOwner != processId)
+			newClaims.push_back(owner);
+	}
+
+	if (isSecondaryProcess && !m_DeviceOpened)
+	{
+		m_Config = DpdkDeviceConfiguration();
+		m_Config.offloads = portState.enabledOffloads;
+		m_NumOfRxQueuesOpened = numOfRxQueues;
+		m_NumOfTxQueuesOpened = numOfTxQueues;
+		clearCoreConfiguration();
+		m_DeviceOpened = true;
+		LOG_DEBUG("Attached to device [%s] which has %d RX queues and %d TX queues opened", m_DeviceName, (int)numOfRxQueues, (int)numOfTxQueues);
+	}
+
+	return true;
+}
+
+void DpdkDevice::releaseQueues()
+{
+	if (m_SharedPortStates == NULL)
+		return;
+
+	SharedPortState& portState = m_SharedPortStates[m_Id];
+	uint32_t processId = (uint32_t)getpid();
+	for (int i = 0; i < DPDK_MAX_RX_QUEUES; i++)
+	{
+		rte_atomic32_cmpset((volatile uint32_t*)&portState.rxQueueOwners[i].cnt, processId, 0);
+		rte_atomic32_cmpset((volatile uint32_t*)&portState.txQueueOwners[i].cnt, processId, 0);
+	}
+}
+
+int DpdkDevice::getRxQueueOwner(uint16_t rxQueueId) const
+{
+	if (m_SharedPortStates == NULL || rxQueueId >= DPDK_MAX_RX_QUEUES)
+		return 0;
+
+	return (int)rte_atomic32_read(&m_SharedPortStates[m_Id].rxQueueOwners[rxQueueId]);
+}
+
+int DpdkDevice::getTxQueueOwner(uint16_t txQueueId) const
+{
+	if (m_SharedPortStates == NULL || txQueueId >= DPDK_MAX_RX_QUEUES)
+		return 0;
+
+	return (int)rte_atomic32_read(&m_SharedPortStates[m_Id].txQueueOwners[txQueueId]);
+}
+
+void DpdkDevice::getAttachedRxQueues(std::vector<uint16_t>& rxQueues) const
+{
+	rxQueues.clear();
+	int processId = (int)getpid();
+	for (uint16_t i = 0; i < m_NumOfRxQueuesOpened && i < DPDK_MAX_RX_QUEUES; i++)
+	{
+		if (getRxQueueOwner(i) == processId)
+			rxQueues.push_back(i);
+	}
+}
+
+void DpdkDevice::getCaptureRxQueues(std::vector<uint16_t>& rxQueues) const
+{
+	// capture threads read from the queues the process claimed. The primary process reads from all queues if it didn't claim any
+	getAttachedRxQueues(rxQueues);
+	if (!rxQueues.empty() || DpdkDeviceList::isSecondaryProcess())
+		return;
+
+	for (uint16_t i = 0; i < m_NumOfRxQueuesOpened; i++)
+		rxQueues.push_back(i);
 }
 
 
@@ -213,6 +566,12 @@ bool DpdkDevice::configurePort(uint8_t numOfRxQueues, uint8_t numOfTxQueues)
 		return false;
 	}
 
+	if (m_Config.offloads != 0 && !isDeviceSupportOffloads(m_Config.offloads))
+	{
+		LOG_ERROR("PMD '%s' doesn't support the requested offloads 0x%X, the supported offloads are 0x%X", m_PMDName.c_str(), (uint32_t)m_Config.offloads, (uint32_t)getSupportedOffloads());
+		return false;
+	}
+
 	// verify num of RX queues is power of 2
 	bool isRxQueuePowerOfTwo = !(numOfRxQueues == 0) && !(numOfRxQueues & (numOfRxQueues - 1));
 	if (!isRxQueuePowerOfTwo)
@@ -235,6 +594,10 @@ bool DpdkDevice::configurePort(uint8_t numOfRxQueues, uint8_t numOfTxQueues)
 	portConf.rx_adv_conf.rss_conf.rss_key = m_Config.rssKey;
 	portConf.rx_adv_conf.rss_conf.rss_key_len = m_Config.rssKeyLength;
 	portConf.rx_adv_conf.rss_conf.rss_hf = convertRssHfToDpdkRssHf(m_Config.rssHashFunction);
+#ifdef DPDK_OFFLOADS_SUPPORTED
+	convertOffloadsToDpdkOffloads(m_Config.offloads, portConf.rxmode.offloads, portConf.txmode.offloads);
+#endif
+	portConf.intr_conf.rxq = (m_Config.rxInterrupts ? 1 : 0);
 
 	int res = rte_eth_dev_configure((uint8_t) m_Id, numOfRxQueues, numOfTxQueues, &portConf);
 	if (res < 0)
@@ -267,7 +630,7 @@ bool DpdkDevice::initQueues(uint8_t numOfRxQueuesToInit, uint8_t numOfTxQueuesTo
 	for (uint8_t i = 0; i < numOfRxQueuesToInit; i++)
 	{
 		int ret = rte_eth_rx_queue_setup((uint8_t) m_Id, i,
-				m_Config.receiveDescriptorsNumber, 0,
+				m_Config.receiveDescriptorsNumber, getDeviceAllocationSocketId(m_Id),
 				NULL, m_MBufMempool);
 
 		if (ret < 0)
@@ -283,7 +646,7 @@ bool DpdkDevice::initQueues(uint8_t numOfRxQueuesToInit, uint8_t numOfTxQueuesTo
 	{
 		int ret = rte_eth_tx_queue_setup((uint8_t) m_Id, i,
 				m_Config.transmitDescriptorsNumber,
-					0, NULL);
+					getDeviceAllocationSocketId(m_Id), NULL);
 		if (ret < 0)
 		{
 			LOG_ERROR("Failed to init TX queue #%d for port %d. Error was: '%s' [Error code: %d]", i, m_Id, rte_strerror(ret), ret);
@@ -291,19 +654,29 @@ bool DpdkDevice::initQueues(uint8_t numOfRxQueuesToInit, uint8_t numOfTxQueuesTo
 		}
 	}
 
+	if (!initTxBuffers(numOfTxQueuesToInit))
+		return false;
+
+	LOG_DEBUG("Successfully initialized %d TX queues for device [%s]", numOfTxQueuesToInit, m_DeviceName);
+
+	return true;
+}
+
+bool DpdkDevice::initTxBuffers(uint16_t numOfTxQueues)
+{
 	if (m_TxBuffers != NULL)
 		delete [] m_TxBuffers;
 
 	if (m_TxBufferLastDrainTsc != NULL)
 		delete [] m_TxBufferLastDrainTsc;
 
-	m_TxBuffers = new rte_eth_dev_tx_buffer*[numOfTxQueuesToInit];
-	m_TxBufferLastDrainTsc = new uint64_t[numOfTxQueuesToInit];
-	memset(m_TxBufferLastDrainTsc, 0, sizeof(uint64_t)*numOfTxQueuesToInit);
+	m_TxBuffers = new rte_eth_dev_tx_buffer*[numOfTxQueues];
+	m_TxBufferLastDrainTsc = new uint64_t[numOfTxQueues];
+	memset(m_TxBufferLastDrainTsc, 0, sizeof(uint64_t)*numOfTxQueues);
 
-	for (uint8_t i = 0; i < numOfTxQueuesToInit; i++)
+	for (uint16_t i = 0; i < numOfTxQueues; i++)
 	{
-		m_TxBuffers[i] = (rte_eth_dev_tx_buffer*)rte_zmalloc_socket("tx_buffer", RTE_ETH_TX_BUFFER_SIZE(MAX_BURST_SIZE), 0, rte_eth_dev_socket_id(m_Id));
+		m_TxBuffers[i] = (rte_eth_dev_tx_buffer*)rte_zmalloc_socket("tx_buffer", RTE_ETH_TX_BUFFER_SIZE(MAX_BURST_SIZE), 0, getDeviceAllocationSocketId(m_Id));
 
 		if (m_TxBuffers[i] == NULL)
 		{
@@ -322,31 +695,81 @@ bool DpdkDevice::initQueues(uint8_t numOfRxQueuesToInit, uint8_t numOfTxQueuesTo
 
 	m_TxBufferDrainTsc = (rte_get_tsc_hz() + US_PER_S - 1) / US_PER_S * m_Config.flushTxBufferTimeout;
 
-	memset(m_TxBufferLastDrainTsc, 0, sizeof(uint64_t)*numOfTxQueuesToInit);
-
-	LOG_DEBUG("Successfully initialized %d TX queues for device [%s]", numOfTxQueuesToInit, m_DeviceName);
+	memset(m_TxBufferLastDrainTsc, 0, sizeof(uint64_t)*numOfTxQueues);
 
 	return true;
 }
 
 
-bool DpdkDevice::initMemPool(struct rte_mempool*& memPool, const char* mempoolName, uint32_t mBufPoolSize)
+int DpdkDevice::getMBufPoolSocketId(int port, const DpdkMBufPoolConfig& mBufPoolConfig)
+{
+	// by default the mbuf pool is created on the NIC's NUMA node so both the NIC and the worker threads access mbufs locally
+	if (mBufPoolConfig.socketId >= 0)
+		return mBufPoolConfig.socketId;
+
+	return getDeviceAllocationSocketId(port);
+}
+
+struct rte_mempool* DpdkDevice::createMBufPool(const char* mempoolName, const DpdkMBufPoolConfig& mBufPoolConfig, int socketId)
 {
-    bool ret = false;
+	if (!mBufPoolConfig.externalHeapName.empty())
+	{
+		// the memory of an external heap is allocated through the socket ID DPDK assigned to the heap
+#if (RTE_VER_YEAR > 18) || (RTE_VER_YEAR == 18 && RTE_VER_MONTH >= 11)
+		socketId = rte_malloc_heap_get_socket(mBufPoolConfig.externalHeapName.c_str());
+		if (socketId < 0)
+		{
+			LOG_ERROR("Cannot find external heap '%s' for packets memory pool %s", mBufPoolConfig.externalHeapName.c_str(), mempoolName);
+			return NULL;
+		}
+#else
+		LOG_ERROR("External heaps for packets memory pools are supported since DPDK 18.11");
+		return NULL;
+#endif
+	}
 
-    // create mbuf pool
-    memPool = rte_pktmbuf_pool_create(mempoolName, mBufPoolSize, MEMPOOL_CACHE_SIZE, 0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	uint16_t dataRoomSize = (mBufPoolConfig.dataRoomSize != 0 ? mBufPoolConfig.dataRoomSize : (uint16_t)RTE_MBUF_DEFAULT_BUF_SIZE);
 
-    if (memPool == NULL)
+	struct rte_mempool* mempool = rte_pktmbuf_pool_create(mempoolName, mBufPoolConfig.poolSize, mBufPoolConfig.cacheSize, 0, dataRoomSize, socketId);
+	if (mempool == NULL)
 	{
-		LOG_ERROR("Failed to create packets memory pool for port %d, pool name: %s", m_Id, mempoolName);
+		LOG_ERROR("Failed to create packets memory pool %s on socket %d: %s", mempoolName, socketId, rte_strerror(rte_errno));
+		return NULL;
 	}
-	else
+
+	LOG_DEBUG("Successfully initialized packets pool %s of size [%d], cache size [%d] and data room [%d] on socket %d", mempoolName,
+			mBufPoolConfig.poolSize, mBufPoolConfig.cacheSize, (int)dataRoomSize, socketId);
+	return mempool;
+}
+
+void DpdkDevice::fillMBufPoolInfo(struct rte_mempool* mempool, DpdkMBufPoolInfo& info)
+{
+	info.name = mempool->name;
+	info.socketId = mempool->socket_id;
+	info.size = mempool->size;
+	info.cacheSize = mempool->cache_size;
+	info.dataRoomSize = rte_pktmbuf_data_room_size(mempool);
+	info.freeMbufs = rte_mempool_avail_count(mempool);
+	info.mbufsInUse = rte_mempool_in_use_count(mempool);
+
+	// the caches are read without synchronization, so the count is a snapshot which may be slightly off while cores use the pool
+	info.cachedMbufs = 0;
+	if (mempool->cache_size != 0)
 	{
-		LOG_DEBUG("Successfully initialized packets pool of size [%d] for device [%s]", mBufPoolSize, m_DeviceName);
-		ret = true;
+		for (unsigned int lcoreId = 0; lcoreId < RTE_MAX_LCORE; lcoreId++)
+			info.cachedMbufs += mempool->local_cache[lcoreId].len;
 	}
-    return ret;
+
+	info.numOfDevices = 0;
+}
+
+int DpdkDevice::getNumaNode()
+{
+	int socketId = rte_eth_dev_socket_id((uint8_t) m_Id);
+	if (socketId >= 0)
+		return socketId;
+
+	return getPciDeviceNumaNode(m_PciAddress);
 }
 
 bool DpdkDevice::startDevice()
@@ -532,15 +955,18 @@ bool DpdkDevice::startCaptureSingleThread(OnDpdkPacketsArriveCallback onPacketsA
 		return false;
 	}
 
-	if (m_NumOfRxQueuesOpened != 1)
+	std::vector<uint16_t> rxQueues;
+	getCaptureRxQueues(rxQueues);
+	if (rxQueues.size() != 1)
 	{
-		LOG_ERROR("Cannot start capturing on a single thread when more than 1 RX queue is opened");
+		LOG_ERROR("Cannot start capturing on a single thread when more than 1 RX queue is opened or claimed");
 		return false;
 	}
 
 	LOG_DEBUG("Trying to start capturing on a single thread for device [%s]", m_DeviceName);
 
 	clearCoreConfiguration();
+	createCapturePollers();
 
 	m_OnPacketsArriveCallback = onPacketsArrive;
 	m_OnPacketsArriveUserCookie = onPacketsArriveUserCookie;
@@ -553,7 +979,7 @@ bool DpdkDevice::startCaptureSingleThread(OnDpdkPacketsArriveCallback onPacketsA
     		continue;
 
     	m_CoreConfiguration[coreId].IsCoreInUse = true;
-    	m_CoreConfiguration[coreId].RxQueueId = 0;
+    	m_CoreConfiguration[coreId].RxQueueId = rxQueues[0];
 
     	LOG_DEBUG("Trying to start capturing on core %d", coreId);
     	int err = rte_eal_remote_launch(dpdkCaptureThreadMain, (void*)this, coreId);
@@ -583,22 +1009,26 @@ bool DpdkDevice::startCaptureMultiThreads(OnDpdkPacketsArriveCallback onPacketsA
 	if (!initCoreConfigurationByCoreMask(coreMask))
 		return false;
 
-	if (m_NumOfRxQueuesOpened != getCoresInUseCount())
+	std::vector<uint16_t> rxQueues;
+	getCaptureRxQueues(rxQueues);
+	if ((int)rxQueues.size() != getCoresInUseCount())
 	{
-		LOG_ERROR("Cannot use a different number of queues and cores. Opened %d queues but set %d cores in core mask", m_NumOfRxQueuesOpened, getCoresInUseCount());
+		LOG_ERROR("Cannot use a different number of queues and cores. Opened or claimed %d queues but set %d cores in core mask", (int)rxQueues.size(), getCoresInUseCount());
 		clearCoreConfiguration();
 		return false;
 	}
 
+	createCapturePollers();
+
 	m_StopThread = false;
-	int rxQueue = 0;
+	size_t rxQueue = 0;
 	for (int coreId = 0; coreId < MAX_NUM_OF_CORES; coreId++)
 	{
 		if (!m_CoreConfiguration[coreId].IsCoreInUse)
 			continue;
 
 		// create a new thread
-		m_CoreConfiguration[coreId].RxQueueId = rxQueue++;
+		m_CoreConfiguration[coreId].RxQueueId = rxQueues[rxQueue++];
 		int err = rte_eal_remote_launch(dpdkCaptureThreadMain, (void*)this, coreId);
 		if (err != 0)
 		{
@@ -629,6 +1059,79 @@ void DpdkDevice::stopCapture()
 	LOG_DEBUG("All capturing threads stopped");
 }
 
+bool DpdkDevice::setCaptureAdaptivePolling(bool enabled, const DpdkAdaptivePollingConfig& config)
+{
+	if (!m_StopThread)
+	{
+		LOG_ERROR("Cannot change adaptive polling of device [%s] while it's capturing", m_DeviceName);
+		return false;
+	}
+
+	m_CaptureAdaptivePolling = enabled;
+	m_CaptureAdaptivePollingConfig = config;
+	return true;
+}
+
+bool DpdkDevice::setRxPrefetchDistance(uint16_t prefetchDistance)
+{
+	if (!m_StopThread)
+	{
+		LOG_ERROR("Cannot change RX prefetch distance of device [%s] while it's capturing", m_DeviceName);
+		return false;
+	}
+
+	m_RxPrefetchDistance = prefetchDistance;
+	return true;
+}
+
+bool DpdkDevice::getCaptureAdaptivePollingStats(uint16_t rxQueueId, DpdkAdaptivePollingStats& stats)
+{
+	if (rxQueueId >= DPDK_MAX_RX_QUEUES || m_CapturePollers[rxQueueId] == NULL)
+		return false;
+
+	m_CapturePollers[rxQueueId]->getStats(stats);
+	return true;
+}
+
+void DpdkDevice::createCapturePollers()
+{
+	deleteCapturePollers();
+
+	if (!m_CaptureAdaptivePolling)
+		return;
+
+	for (int i = 0; i < m_NumOfRxQueuesOpened && i < DPDK_MAX_RX_QUEUES; i++)
+		m_CapturePollers[i] = new DpdkAdaptivePoller(this, i, m_CaptureAdaptivePollingConfig);
+}
+
+void DpdkDevice::deleteCapturePollers()
+{
+	for (int i = 0; i < DPDK_MAX_RX_QUEUES; i++)
+	{
+		delete m_CapturePollers[i];
+		m_CapturePollers[i] = NULL;
+	}
+}
+
+// The prefetch pipeline of a received burst: the data pointer of a packet is read from its mbuf, so mbufs are fetched twice the distance
+// ahead and the first cache line of the data once the distance ahead. Call with index 0 before binding the first packet and then before
+// binding each packet
+static inline void prefetchRxBurst(struct rte_mbuf** mBufArray, uint32_t index, uint32_t numOfPkts, uint32_t prefetchDistance)
+{
+	if (index == 0)
+	{
+		for (uint32_t i = 0; i < 2 * prefetchDistance && i < numOfPkts; i++)
+			rte_prefetch0(mBufArray[i]);
+		for (uint32_t i = 0; i < prefetchDistance && i < numOfPkts; i++)
+			rte_prefetch0(rte_pktmbuf_mtod(mBufArray[i], void*));
+	}
+
+	if (index + 2 * prefetchDistance < numOfPkts)
+		rte_prefetch0(mBufArray[index + 2 * prefetchDistance]);
+	if (index + prefetchDistance < numOfPkts)
+		rte_prefetch0(rte_pktmbuf_mtod(mBufArray[index + prefetchDistance], void*));
+}
+
 int DpdkDevice::dpdkCaptureThreadMain(void *ptr)
 {
 	DpdkDevice* pThis = (DpdkDevice*)ptr;
@@ -644,29 +1147,51 @@ int DpdkDevice::dpdkCaptureThreadMain(void *ptr)
 	LOG_DEBUG("Starting capture thread %d", coreId);
 
 	int queueId = pThis->m_CoreConfiguration[coreId].RxQueueId;
+	DpdkAdaptivePoller* poller = (queueId < DPDK_MAX_RX_QUEUES ? pThis->m_CapturePollers[queueId] : NULL);
+
+	// the packets of the queue are constructed once and bound to the mbufs of each burst in place
+	MBufRawPacket rawPackets[MAX_BURST_SIZE];
+
+	uint32_t prefetchDistance = pThis->m_RxPrefetchDistance;
 
 	while (likely(!pThis->m_StopThread))
 	{
-		uint32_t numOfPktsReceived = rte_eth_rx_burst(pThis->m_Id, queueId, mBufArray, MAX_BURST_SIZE);
+		uint32_t numOfPktsReceived = pThis->receiveBurst(queueId, mBufArray, MAX_BURST_SIZE);
+
+		if (poller != NULL)
+			poller->onPoll(numOfPktsReceived);
 
 		if (unlikely(numOfPktsReceived == 0))
 			continue;
 
-		timeval time;
-		gettimeofday(&time, NULL);
-
-		if (likely(pThis->m_OnPacketsArriveCallback != NULL))
+		// the callback is set after the threads start, drop what arrives before it
+		if (unlikely(pThis->m_OnPacketsArriveCallback == NULL))
 		{
-			MBufRawPacket rawPackets[MAX_BURST_SIZE];
 			for (uint32_t index = 0; index < numOfPktsReceived; ++index)
-			{
-				rawPackets[index].setMBuf(mBufArray[index], time);
-			}
+				rte_pktmbuf_free(mBufArray[index]);
+			continue;
+		}
 
-			pThis->m_OnPacketsArriveCallback(rawPackets, numOfPktsReceived, coreId, pThis, pThis->m_OnPacketsArriveUserCookie);
+		timespec time = TimestampClock::now();
+
+		for (uint32_t index = 0; index < numOfPktsReceived; ++index)
+		{
+			if (prefetchDistance > 0)
+				prefetchRxBurst(mBufArray, index, numOfPktsReceived, prefetchDistance);
+
+			rawPackets[index].setMBuf(mBufArray[index], time);
 		}
+
+		pThis->m_OnPacketsArriveCallback(rawPackets, numOfPktsReceived, coreId, pThis, pThis->m_OnPacketsArriveUserCookie);
+
+		// return the mbufs to the pool right away rather than when the packets are bound again, except those the callback detached
+		MBufRawPacket::releaseMBufs(rawPackets, numOfPktsReceived);
 	}
 
+	// the RX interrupt of the poller is registered to this thread
+	if (poller != NULL)
+		poller->releaseRxInterrupt();
+
 	LOG_DEBUG("Exiting capture thread %d", coreId);
 
 	return 0;
@@ -726,19 +1251,983 @@ void DpdkDevice::clearStatistics()
 	memset(&m_PrevStats, 0 ,sizeof(m_PrevStats));
 }
 
-
-bool DpdkDevice::setFilter(GeneralFilter& filter)
+void DpdkDevice::collectMetrics(MetricsWriter& writer)
 {
-	//TODO: I think DPDK supports filters
-	LOG_ERROR("Filters aren't supported in DPDK device");
-	return false;
-}
+	if (!m_DeviceOpened)
+		return;
+
+	struct rte_eth_stats rteStats;
+	if (rte_eth_stats_get(m_Id, &rteStats) != 0)
+		return;
+
+	writer.addCounter("pcpp_device_rx_packets_total", "Packets received by the device", rteStats.ipackets);
+	writer.addCounter("pcpp_device_rx_bytes_total", "Bytes received by the device", rteStats.ibytes);
+	writer.addCounter("pcpp_device_tx_packets_total", "Packets sent by the device", rteStats.opackets);
+	writer.addCounter("pcpp_device_tx_bytes_total", "Bytes sent by the device", rteStats.obytes);
+	writer.addCounter("pcpp_device_rx_dropped_packets_total", "Packets dropped by the device", rteStats.imissed);
+	writer.addCounter("pcpp_device_rx_errors_total", "Erroneous packets received by the device", rteStats.ierrors);
+	writer.addCounter("pcpp_device_rx_mbuf_alloc_failures_total", "RX mbuf allocation failures", rteStats.rx_nombuf);
+
+	char queueLabel[32];
+	int numRxQs = std::min<int>(m_NumOfRxQueuesOpened, RTE_ETHDEV_QUEUE_STAT_CNTRS);
+	for (int i = 0; i < numRxQs; i++)
+	{
+		snprintf(queueLabel, sizeof(queueLabel), "queue=\"%d\"", i);
+		writer.addCounter("pcpp_device_rx_queue_packets_total", "Packets received by an RX queue", rteStats.q_ipackets[i], queueLabel);
+		writer.addCounter("pcpp_device_rx_queue_bytes_total", "Bytes received by an RX queue", rteStats.q_ibytes[i], queueLabel);
+	}
+
+	int numTxQs = std::min<int>(m_NumOfTxQueuesOpened, RTE_ETHDEV_QUEUE_STAT_CNTRS);
+	for (int i = 0; i < numTxQs; i++)
+	{
+		snprintf(queueLabel, sizeof(queueLabel), "queue=\"%d\"", i);
+		writer.addCounter("pcpp_device_tx_queue_packets_total", "Packets sent by a TX queue", rteStats.q_opackets[i], queueLabel);
+		writer.addCounter("pcpp_device_tx_queue_bytes_total", "Bytes sent by a TX queue", rteStats.q_obytes[i], queueLabel);
+	}
+}
+
+bool DpdkDevice::getExtendedStatistics(std::map<std::string, uint64_t>& xstats)
+{
+	xstats.clear();
+
+	int numOfXstats = rte_eth_xstats_get_names(m_Id, NULL, 0);
+	if (numOfXstats < 0)
+	{
+		LOG_ERROR("Cannot get the number of extended statistics of device [%s]. Error was: '%s' [Error code: %d]", m_DeviceName, rte_strerror(-numOfXstats), numOfXstats);
+		return false;
+	}
+
+	if (numOfXstats == 0)
+		return true;
+
+	std::vector<struct rte_eth_xstat_name> names(numOfXstats);
+	std::vector<struct rte_eth_xstat> values(numOfXstats);
+	if (rte_eth_xstats_get_names(m_Id, &names[0], numOfXstats) != numOfXstats || rte_eth_xstats_get(m_Id, &values[0], numOfXstats) != numOfXstats)
+	{
+		LOG_ERROR("Cannot get the extended statistics of device [%s]", m_DeviceName);
+		return false;
+	}
+
+	for (int i = 0; i < numOfXstats; i++)
+	{
+		if (values[i].id < (uint64_t)numOfXstats)
+			xstats[names[values[i].id].name] = values[i].value;
+	}
+
+	return true;
+}
+
+void DpdkDevice::clearExtendedStatistics()
+{
+	rte_eth_xstats_reset(m_Id);
+}
+
+struct DpdkDevice::RxBurstCounters
+{
+	uint64_t polls;
+	uint64_t emptyPolls;
+	uint64_t packets;
+	uint64_t measuredBursts;
+	uint64_t totalBurstCycles;
+	uint64_t maxBurstCycles;
+	// the TSC when the last poll returned packets, or 0 if it returned none
+	uint64_t lastBurstTsc;
+	uint64_t burstSizeHistogram[PCPP_DPDK_BURST_SIZE_HISTOGRAM_BUCKETS];
+	uint64_t burstCyclesHistogram[PCPP_DPDK_BURST_CYCLES_HISTOGRAM_BUCKETS];
+} __rte_cache_aligned;
+
+// the index of the highest set bit, which is the histogram bucket of a value, limited to the last bucket
+static inline int getHistogramBucket(uint64_t value, int numOfBuckets)
+{
+	int bucket = 0;
+	while (value > 1 && bucket < numOfBuckets - 1)
+	{
+		value >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+bool DpdkDevice::setRxBurstStatsEnabled(bool enabled)
+{
+	if (enabled && m_RxBurstCounters == NULL)
+	{
+		// the counters are never freed while the device exists, so a queue which is being polled never sees them disappear
+		m_RxBurstCounters = (RxBurstCounters*)rte_zmalloc_socket("rx_burst_stats", sizeof(RxBurstCounters) * DPDK_MAX_RX_QUEUES, RTE_CACHE_LINE_SIZE, getDeviceAllocationSocketId(m_Id));
+		if (m_RxBurstCounters == NULL)
+		{
+			LOG_ERROR("Couldn't allocate RX burst statistics for device [%s]", m_DeviceName);
+			return false;
+		}
+	}
+
+	m_RxBurstStatsEnabled = enabled;
+	return true;
+}
+
+void DpdkDevice::updateRxBurstStats(uint16_t rxQueueId, uint16_t numOfPackets)
+{
+	if (unlikely(rxQueueId >= DPDK_MAX_RX_QUEUES))
+		return;
+
+	RxBurstCounters& counters = m_RxBurstCounters[rxQueueId];
+	uint64_t curTsc = rte_rdtsc();
+
+	if (counters.lastBurstTsc != 0)
+	{
+		uint64_t burstCycles = curTsc - counters.lastBurstTsc;
+		counters.measuredBursts++;
+		counters.totalBurstCycles += burstCycles;
+		if (burstCycles > counters.maxBurstCycles)
+			counters.maxBurstCycles = burstCycles;
+		counters.burstCyclesHistogram[getHistogramBucket(burstCycles, PCPP_DPDK_BURST_CYCLES_HISTOGRAM_BUCKETS)]++;
+	}
+
+	counters.polls++;
+	counters.packets += numOfPackets;
+
+	if (numOfPackets == 0)
+	{
+		counters.emptyPolls++;
+		counters.burstSizeHistogram[0]++;
+		counters.lastBurstTsc = 0;
+		return;
+	}
+
+	counters.burstSizeHistogram[getHistogramBucket(numOfPackets, PCPP_DPDK_BURST_SIZE_HISTOGRAM_BUCKETS - 1) + 1]++;
+	counters.lastBurstTsc = curTsc;
+}
+
+bool DpdkDevice::getRxBurstStats(uint16_t rxQueueId, RxBurstStats& stats)
+{
+	if (m_RxBurstCounters == NULL || rxQueueId >= DPDK_MAX_RX_QUEUES)
+		return false;
+
+	const RxBurstCounters& counters = m_RxBurstCounters[rxQueueId];
+	stats.polls = counters.polls;
+	stats.emptyPolls = counters.emptyPolls;
+	stats.emptyPollRatio = (stats.polls > 0 ? (double)stats.emptyPolls / (double)stats.polls : 0);
+	stats.packets = counters.packets;
+	stats.measuredBursts = counters.measuredBursts;
+	stats.avgBurstCycles = (stats.measuredBursts > 0 ? counters.totalBurstCycles / stats.measuredBursts : 0);
+	stats.maxBurstCycles = counters.maxBurstCycles;
+	stats.tscHz = rte_get_tsc_hz();
+	memcpy(stats.burstSizeHistogram, counters.burstSizeHistogram, sizeof(stats.burstSizeHistogram));
+	memcpy(stats.burstCyclesHistogram, counters.burstCyclesHistogram, sizeof(stats.burstCyclesHistogram));
+
+	stats.queueDrops = 0;
+	if (rxQueueId < RTE_ETHDEV_QUEUE_STAT_CNTRS)
+	{
+		struct rte_eth_stats rteStats;
+		memset(&rteStats, 0, sizeof(rteStats));
+		rte_eth_stats_get(m_Id, &rteStats);
+		stats.queueDrops = rteStats.q_errors[rxQueueId];
+	}
+
+	return true;
+}
+
+void DpdkDevice::clearRxBurstStats()
+{
+	if (m_RxBurstCounters != NULL)
+		memset(m_RxBurstCounters, 0, sizeof(RxBurstCounters) * DPDK_MAX_RX_QUEUES);
+}
+
+
+#ifdef DPDK_FLOW_RULES_SUPPORTED
+
+// create an rte_flow rule matching a filter flow rule, whose EtherType is given separately as rules which match the IP protocol or ports
+// but not the EtherType are created for both IPv4 and IPv6
+static struct rte_flow* createFlowRule(uint16_t portId, const FilterFlowRule& rule, uint16_t etherType, uint16_t etherTypeMask,
+		const struct rte_flow_attr& attr, const struct rte_flow_action* actions)
+{
+	struct rte_flow_item_eth ethSpec, ethMask;
+	struct rte_flow_item_ipv4 ipv4Spec, ipv4Mask;
+	struct rte_flow_item_ipv6 ipv6Spec, ipv6Mask;
+	struct rte_flow_item_tcp tcpSpec, tcpMask;
+	struct rte_flow_item_udp udpSpec, udpMask;
+	struct rte_flow_item_sctp sctpSpec, sctpMask;
+	memset(&ethSpec, 0, sizeof(ethSpec));
+	memset(&ethMask, 0, sizeof(ethMask));
+	memset(&ipv4Spec, 0, sizeof(ipv4Spec));
+	memset(&ipv4Mask, 0, sizeof(ipv4Mask));
+	memset(&ipv6Spec, 0, sizeof(ipv6Spec));
+	memset(&ipv6Mask, 0, sizeof(ipv6Mask));
+	memset(&tcpSpec, 0, sizeof(tcpSpec));
+	memset(&tcpMask, 0, sizeof(tcpMask));
+	memset(&udpSpec, 0, sizeof(udpSpec));
+	memset(&udpMask, 0, sizeof(udpMask));
+	memset(&sctpSpec, 0, sizeof(sctpSpec));
+	memset(&sctpMask, 0, sizeof(sctpMask));
+
+	struct rte_flow_item pattern[4];
+	memset(pattern, 0, sizeof(pattern));
+	int numOfItems = 0;
+
+	pattern[numOfItems].type = RTE_FLOW_ITEM_TYPE_ETH;
+	if (etherTypeMask != 0)
+	{
+		ethSpec.type = rte_cpu_to_be_16(etherType);
+		ethMask.type = rte_cpu_to_be_16(etherTypeMask);
+		pattern[numOfItems].spec = &ethSpec;
+		pattern[numOfItems].mask = &ethMask;
+	}
+	numOfItems++;
+
+	// TCP, UDP and SCTP are matched by an L4 item which also carries the ports, other protocols by the protocol field of the IP item
+	bool hasL4Item = (rule.ipProtocolMask == 0xff && (rule.ipProtocol == PACKETPP_IPPROTO_TCP || rule.ipProtocol == PACKETPP_IPPROTO_UDP ||
+			rule.ipProtocol == PACKETPP_IPPROTO_SCTP));
+	uint8_t ipProtocolMask = (hasL4Item ? 0 : rule.ipProtocolMask);
+
+	if (etherTypeMask == 0xffff && etherType == PCPP_ETHERTYPE_IP)
+	{
+		pattern[numOfItems].type = RTE_FLOW_ITEM_TYPE_IPV4;
+		ipv4Spec.hdr.src_addr = rule.srcIPv4Address;
+		ipv4Mask.hdr.src_addr = rule.srcIPv4Mask;
+		ipv4Spec.hdr.dst_addr = rule.dstIPv4Address;
+		ipv4Mask.hdr.dst_addr = rule.dstIPv4Mask;
+		ipv4Spec.hdr.next_proto_id = rule.ipProtocol & ipProtocolMask;
+		ipv4Mask.hdr.next_proto_id = ipProtocolMask;
+		if (rule.srcIPv4Mask != 0 || rule.dstIPv4Mask != 0 || ipProtocolMask != 0)
+		{
+			pattern[numOfItems].spec = &ipv4Spec;
+			pattern[numOfItems].mask = &ipv4Mask;
+		}
+		numOfItems++;
+	}
+	else if (etherTypeMask == 0xffff && etherType == PCPP_ETHERTYPE_IPV6)
+	{
+		pattern[numOfItems].type = RTE_FLOW_ITEM_TYPE_IPV6;
+		ipv6Spec.hdr.proto = rule.ipProtocol & ipProtocolMask;
+		ipv6Mask.hdr.proto = ipProtocolMask;
+		if (ipProtocolMask != 0)
+		{
+			pattern[numOfItems].spec = &ipv6Spec;
+			pattern[numOfItems].mask = &ipv6Mask;
+		}
+		numOfItems++;
+	}
+	else if (rule.ipProtocolMask != 0)
+	{
+		LOG_DEBUG("Flow rule matches the IP protocol of a packet which isn't IP");
+		return NULL;
+	}
+
+	if (hasL4Item)
+	{
+		const void* spec = NULL;
+		const void* mask = NULL;
+		switch (rule.ipProtocol)
+		{
+		case PACKETPP_IPPROTO_TCP:
+			pattern[numOfItems].type = RTE_FLOW_ITEM_TYPE_TCP;
+			tcpSpec.hdr.src_port = rte_cpu_to_be_16(rule.srcPort & rule.srcPortMask);
+			tcpMask.hdr.src_port = rte_cpu_to_be_16(rule.srcPortMask);
+			tcpSpec.hdr.dst_port = rte_cpu_to_be_16(rule.dstPort & rule.dstPortMask);
+			tcpMask.hdr.dst_port = rte_cpu_to_be_16(rule.dstPortMask);
+			spec = &tcpSpec;
+			mask = &tcpMask;
+			break;
+		case PACKETPP_IPPROTO_UDP:
+			pattern[numOfItems].type = RTE_FLOW_ITEM_TYPE_UDP;
+			udpSpec.hdr.src_port = rte_cpu_to_be_16(rule.srcPort & rule.srcPortMask);
+			udpMask.hdr.src_port = rte_cpu_to_be_16(rule.srcPortMask);
+			udpSpec.hdr.dst_port = rte_cpu_to_be_16(rule.dstPort & rule.dstPortMask);
+			udpMask.hdr.dst_port = rte_cpu_to_be_16(rule.dstPortMask);
+			spec = &udpSpec;
+			mask = &udpMask;
+			break;
+		default:
+			pattern[numOfItems].type = RTE_FLOW_ITEM_TYPE_SCTP;
+			sctpSpec.hdr.src_port = rte_cpu_to_be_16(rule.srcPort & rule.srcPortMask);
+			sctpMask.hdr.src_port = rte_cpu_to_be_16(rule.srcPortMask);
+			sctpSpec.hdr.dst_port = rte_cpu_to_be_16(rule.dstPort & rule.dstPortMask);
+			sctpMask.hdr.dst_port = rte_cpu_to_be_16(rule.dstPortMask);
+			spec = &sctpSpec;
+			mask = &sctpMask;
+			break;
+		}
+
+		if (rule.srcPortMask != 0 || rule.dstPortMask != 0)
+		{
+			pattern[numOfItems].spec = spec;
+			pattern[numOfItems].mask = mask;
+		}
+		numOfItems++;
+	}
+
+	pattern[numOfItems].type = RTE_FLOW_ITEM_TYPE_END;
+
+	struct rte_flow_error error;
+	memset(&error, 0, sizeof(error));
+	if (rte_flow_validate(portId, &attr, pattern, actions, &error) != 0)
+	{
+		LOG_DEBUG("Flow rule isn't supported by port %d: %s", portId, (error.message != NULL ? error.message : "unknown error"));
+		return NULL;
+	}
+
+	struct rte_flow* flow = rte_flow_create(portId, &attr, pattern, actions, &error);
+	if (flow == NULL)
+		LOG_DEBUG("Cannot create flow rule on port %d: %s", portId, (error.message != NULL ? error.message : "unknown error"));
+	return flow;
+}
+
+#endif
+
+bool DpdkDevice::createFlowRules(const std::vector<FilterFlowRule>& rules)
+{
+#ifdef DPDK_FLOW_RULES_SUPPORTED
+
+	// packets matching the rules are spread over the opened RX queues the same way RSS spreads them without rules
+	uint16_t queues[DPDK_MAX_RX_QUEUES];
+	for (uint16_t i = 0; i < m_NumOfRxQueuesOpened; i++)
+		queues[i] = i;
+
+	struct rte_flow_action_rss rss;
+	memset(&rss, 0, sizeof(rss));
+	rss.func = RTE_ETH_HASH_FUNCTION_DEFAULT;
+	rss.types = convertRssHfToDpdkRssHf(m_Config.rssHashFunction);
+	rss.key_len = m_Config.rssKeyLength;
+	rss.key = m_Config.rssKey;
+	rss.queue_num = m_NumOfRxQueuesOpened;
+	rss.queue = queues;
+
+	struct rte_flow_action_queue queue;
+	memset(&queue, 0, sizeof(queue));
+	queue.index = 0;
+
+	struct rte_flow_action actions[2];
+	memset(actions, 0, sizeof(actions));
+	if (m_NumOfRxQueuesOpened > 1 && rss.types != 0)
+	{
+		actions[0].type = RTE_FLOW_ACTION_TYPE_RSS;
+		actions[0].conf = &rss;
+	}
+	else
+	{
+		actions[0].type = RTE_FLOW_ACTION_TYPE_QUEUE;
+		actions[0].conf = &queue;
+	}
+	actions[1].type = RTE_FLOW_ACTION_TYPE_END;
+
+	struct rte_flow_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.ingress = 1;
+	attr.priority = 0;
+
+	for (std::vector<FilterFlowRule>::const_iterator rule = rules.begin(); rule != rules.end(); ++rule)
+	{
+		// a rule matching an IP protocol with an EtherType which isn't IP matches no packet
+		bool isIpRule = (rule->ipProtocolMask != 0 || rule->srcPortMask != 0 || rule->dstPortMask != 0);
+		if (isIpRule && rule->etherTypeMask != 0 &&
+				!(rule->etherTypeMask == 0xffff && (rule->etherType == PCPP_ETHERTYPE_IP || rule->etherType == PCPP_ETHERTYPE_IPV6)))
+			continue;
+
+		if (isIpRule && rule->etherTypeMask == 0)
+		{
+			struct rte_flow* ipv4Flow = createFlowRule(m_Id, *rule, PCPP_ETHERTYPE_IP, 0xffff, attr, actions);
+			if (ipv4Flow != NULL)
+				m_FlowRules.push_back(ipv4Flow);
+			struct rte_flow* ipv6Flow = createFlowRule(m_Id, *rule, PCPP_ETHERTYPE_IPV6, 0xffff, attr, actions);
+			if (ipv6Flow != NULL)
+				m_FlowRules.push_back(ipv6Flow);
+			if (ipv4Flow == NULL || ipv6Flow == NULL)
+			{
+				destroyFlowRules();
+				return false;
+			}
+		}
+		else
+		{
+			struct rte_flow* flow = createFlowRule(m_Id, *rule, rule->etherType, rule->etherTypeMask, attr, actions);
+			if (flow == NULL)
+			{
+				destroyFlowRules();
+				return false;
+			}
+			m_FlowRules.push_back(flow);
+		}
+	}
+
+	// packets which don't match any rule are dropped by a catch-all rule of a lower priority
+	struct rte_flow_item dropPattern[2];
+	memset(dropPattern, 0, sizeof(dropPattern));
+	dropPattern[0].type = RTE_FLOW_ITEM_TYPE_ETH;
+	dropPattern[1].type = RTE_FLOW_ITEM_TYPE_END;
+
+	struct rte_flow_action dropActions[2];
+	memset(dropActions, 0, sizeof(dropActions));
+	dropActions[0].type = RTE_FLOW_ACTION_TYPE_DROP;
+	dropActions[1].type = RTE_FLOW_ACTION_TYPE_END;
+
+	attr.priority = 1;
+
+	struct rte_flow_error error;
+	memset(&error, 0, sizeof(error));
+	struct rte_flow* dropFlow = NULL;
+	if (rte_flow_validate(m_Id, &attr, dropPattern, dropActions, &error) == 0)
+		dropFlow = rte_flow_create(m_Id, &attr, dropPattern, dropActions, &error);
+	if (dropFlow == NULL)
+	{
+		LOG_DEBUG("Cannot create catch-all drop rule on device [%s]: %s", m_DeviceName, (error.message != NULL ? error.message : "unknown error"));
+		destroyFlowRules();
+		return false;
+	}
+	m_FlowRules.push_back(dropFlow);
+
+	return true;
+
+#else
+
+	return false;
+
+#endif
+}
+
+void DpdkDevice::destroyFlowRules()
+{
+#ifdef DPDK_FLOW_RULES_SUPPORTED
+	for (std::vector<struct rte_flow*>::iterator flow = m_FlowRules.begin(); flow != m_FlowRules.end(); ++flow)
+	{
+		struct rte_flow_error error;
+		if (rte_flow_destroy(m_Id, *flow, &error) != 0)
+			LOG_ERROR("Cannot destroy flow rule on device [%s]: %s", m_DeviceName, (error.message != NULL ? error.message : "unknown error"));
+	}
+#endif
+
+	m_FlowRules.clear();
+}
+
+DpdkFlowRule::DpdkFlowRule()
+{
+	srcPortRangeFirst = 0;
+	srcPortRangeLast = 0xffff;
+	dstPortRangeFirst = 0;
+	dstPortRangeLast = 0xffff;
+	action = FlowActionQueue;
+	queueId = 0;
+	setMark = false;
+	mark = 0;
+	priority = 0;
+}
+
+bool DpdkFlowRule::setProtocol(ProtocolType protocol)
+{
+	switch (protocol)
+	{
+	case IPv4:
+		match.etherType = PCPP_ETHERTYPE_IP;
+		break;
+	case IPv6:
+		match.etherType = PCPP_ETHERTYPE_IPV6;
+		break;
+	case ARP:
+		match.etherType = PCPP_ETHERTYPE_ARP;
+		break;
+	case VLAN:
+		match.etherType = PCPP_ETHERTYPE_VLAN;
+		break;
+	case TCP:
+	case UDP:
+	case GRE:
+		match.ipProtocol = (protocol == TCP ? PACKETPP_IPPROTO_TCP : (protocol == UDP ? PACKETPP_IPPROTO_UDP : PACKETPP_IPPROTO_GRE));
+		match.ipProtocolMask = 0xff;
+		return true;
+	case ICMP:
+	case IGMP:
+		match.etherType = PCPP_ETHERTYPE_IP;
+		match.etherTypeMask = 0xffff;
+		match.ipProtocol = (protocol == ICMP ? PACKETPP_IPPROTO_ICMP : PACKETPP_IPPROTO_IGMP);
+		match.ipProtocolMask = 0xff;
+		return true;
+	default:
+		LOG_ERROR("Flow rules can't match protocol 0x%llX", (unsigned long long)protocol);
+		return false;
+	}
+
+	match.etherTypeMask = 0xffff;
+	return true;
+}
+
+// the mask of an IPv4 prefix in network byte order
+static uint32_t ipv4PrefixMask(int prefixLength)
+{
+	if (prefixLength <= 0)
+		return 0;
+	if (prefixLength >= 32)
+		return 0xffffffff;
+	return htobe32(0xffffffff << (32 - prefixLength));
+}
+
+void DpdkFlowRule::setSrcIPv4Address(const IPv4Address& address, int prefixLength)
+{
+	match.etherType = PCPP_ETHERTYPE_IP;
+	match.etherTypeMask = 0xffff;
+	match.srcIPv4Mask = ipv4PrefixMask(prefixLength);
+	match.srcIPv4Address = address.toInt() & match.srcIPv4Mask;
+}
+
+void DpdkFlowRule::setDstIPv4Address(const IPv4Address& address, int prefixLength)
+{
+	match.etherType = PCPP_ETHERTYPE_IP;
+	match.etherTypeMask = 0xffff;
+	match.dstIPv4Mask = ipv4PrefixMask(prefixLength);
+	match.dstIPv4Address = address.toInt() & match.dstIPv4Mask;
+}
+
+void DpdkFlowRule::setSrcPortRange(uint16_t first, uint16_t last)
+{
+	match.srcPort = 0;
+	match.srcPortMask = 0;
+	srcPortRangeFirst = first;
+	srcPortRangeLast = last;
+}
+
+void DpdkFlowRule::setDstPortRange(uint16_t first, uint16_t last)
+{
+	match.dstPort = 0;
+	match.dstPortMask = 0;
+	dstPortRangeFirst = first;
+	dstPortRangeLast = last;
+}
+
+#ifdef DPDK_FLOW_RULES_SUPPORTED
+
+// the maximum number of rte_flow rules a single flow rule is translated into
+#define MAX_FLOWS_PER_STEERING_RULE 64
+
+// split a port range into blocks aligned to a power of 2, each matched by a value and a mask
+static void portRangeToBlocks(uint16_t first, uint16_t last, std::vector<std::pair<uint16_t, uint16_t> >& blocks)
+{
+	uint32_t port = first;
+	while (port <= last)
+	{
+		// the largest aligned block which starts at the port and ends within the range
+		uint32_t blockSize = 1;
+		while (blockSize < 0x10000 && (port & (blockSize * 2 - 1)) == 0 && port + blockSize * 2 - 1 <= last)
+			blockSize *= 2;
+
+		blocks.push_back(std::pair<uint16_t, uint16_t>((uint16_t)port, (uint16_t)~(blockSize - 1)));
+		port += blockSize;
+	}
+}
+
+static void destroyFlows(uint16_t portId, std::vector<struct rte_flow*>& flows, const char* deviceName)
+{
+	for (std::vector<struct rte_flow*>::iterator flow = flows.begin(); flow != flows.end(); ++flow)
+	{
+		struct rte_flow_error error;
+		if (rte_flow_destroy(portId, *flow, &error) != 0)
+			LOG_ERROR("Cannot destroy flow rule on device [%s]: %s", deviceName, (error.message != NULL ? error.message : "unknown error"));
+	}
+
+	flows.clear();
+}
+
+#endif
+
+int DpdkDevice::addFlowRule(const DpdkFlowRule& rule)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device not opened");
+		return -1;
+	}
+
+	if (isFilterOffloaded())
+	{
+		LOG_ERROR("Cannot add flow rules to device [%s] while a filter is offloaded to it", m_DeviceName);
+		return -1;
+	}
+
+#ifdef DPDK_FLOW_RULES_SUPPORTED
+
+	const FilterFlowRule& match = rule.match;
+	bool hasSrcPortRange = (rule.srcPortRangeFirst != 0 || rule.srcPortRangeLast != 0xffff);
+	bool hasDstPortRange = (rule.dstPortRangeFirst != 0 || rule.dstPortRangeLast != 0xffff);
+	if (rule.srcPortRangeFirst > rule.srcPortRangeLast || rule.dstPortRangeFirst > rule.dstPortRangeLast)
+	{
+		LOG_ERROR("Flow rule port range is invalid");
+		return -1;
+	}
+
+	if ((hasSrcPortRange && match.srcPortMask != 0) || (hasDstPortRange && match.dstPortMask != 0))
+	{
+		LOG_ERROR("Flow rule matches both a port and a port range");
+		return -1;
+	}
+
+	bool matchesPorts = (hasSrcPortRange || hasDstPortRange || match.srcPortMask != 0 || match.dstPortMask != 0);
+	if (matchesPorts && !(match.ipProtocolMask == 0xff && (match.ipProtocol == PACKETPP_IPPROTO_TCP || match.ipProtocol == PACKETPP_IPPROTO_UDP ||
+			match.ipProtocol == PACKETPP_IPPROTO_SCTP)))
+	{
+		LOG_ERROR("Flow rule matches ports but its protocol isn't TCP, UDP or SCTP");
+		return -1;
+	}
+
+	if ((match.srcIPv4Mask != 0 || match.dstIPv4Mask != 0) && !(match.etherTypeMask == 0xffff && match.etherType == PCPP_ETHERTYPE_IP))
+	{
+		LOG_ERROR("Flow rule matches IPv4 addresses but not the IPv4 EtherType");
+		return -1;
+	}
+
+	struct rte_flow_action_queue queue;
+	memset(&queue, 0, sizeof(queue));
+	struct rte_flow_action_rss rss;
+	memset(&rss, 0, sizeof(rss));
+	uint16_t rssQueues[DPDK_MAX_RX_QUEUES];
+	struct rte_flow_action_mark mark;
+	memset(&mark, 0, sizeof(mark));
+
+	struct rte_flow_action actions[3];
+	memset(actions, 0, sizeof(actions));
+	int numOfActions = 0;
+
+	switch (rule.action)
+	{
+	case DpdkFlowRule::FlowActionQueue:
+		if (rule.queueId >= m_NumOfRxQueuesOpened)
+		{
+			LOG_ERROR("RX queue %d isn't opened on device [%s]", rule.queueId, m_DeviceName);
+			return -1;
+		}
+		queue.index = rule.queueId;
+		actions[numOfActions].type = RTE_FLOW_ACTION_TYPE_QUEUE;
+		actions[numOfActions++].conf = &queue;
+		break;
+	case DpdkFlowRule::FlowActionRssGroup:
+	{
+		size_t numOfQueues = (rule.rssQueues.empty() ? m_NumOfRxQueuesOpened : rule.rssQueues.size());
+		if (numOfQueues > DPDK_MAX_RX_QUEUES)
+		{
+			LOG_ERROR("Flow rule RSS group has more than %d queues", DPDK_MAX_RX_QUEUES);
+			return -1;
+		}
+		for (size_t i = 0; i < numOfQueues; i++)
+		{
+			rssQueues[i] = (rule.rssQueues.empty() ? (uint16_t)i : rule.rssQueues[i]);
+			if (rssQueues[i] >= m_NumOfRxQueuesOpened)
+			{
+				LOG_ERROR("RX queue %d isn't opened on device [%s]", rssQueues[i], m_DeviceName);
+				return -1;
+			}
+		}
+		rss.func = RTE_ETH_HASH_FUNCTION_DEFAULT;
+		rss.types = convertRssHfToDpdkRssHf(m_Config.rssHashFunction);
+		rss.key_len = m_Config.rssKeyLength;
+		rss.key = m_Config.rssKey;
+		rss.queue_num = numOfQueues;
+		rss.queue = rssQueues;
+		actions[numOfActions].type = RTE_FLOW_ACTION_TYPE_RSS;
+		actions[numOfActions++].conf = &rss;
+		break;
+	}
+	case DpdkFlowRule::FlowActionDrop:
+		actions[numOfActions++].type = RTE_FLOW_ACTION_TYPE_DROP;
+		break;
+	}
+
+	if (rule.setMark && rule.action != DpdkFlowRule::FlowActionDrop)
+	{
+		mark.id = rule.mark;
+		actions[numOfActions].type = RTE_FLOW_ACTION_TYPE_MARK;
+		actions[numOfActions++].conf = &mark;
+	}
+	actions[numOfActions].type = RTE_FLOW_ACTION_TYPE_END;
+
+	struct rte_flow_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.ingress = 1;
+	attr.priority = rule.priority;
+
+	std::vector<std::pair<uint16_t, uint16_t> > srcPortBlocks;
+	std::vector<std::pair<uint16_t, uint16_t> > dstPortBlocks;
+	if (hasSrcPortRange)
+		portRangeToBlocks(rule.srcPortRangeFirst, rule.srcPortRangeLast, srcPortBlocks);
+	else
+		srcPortBlocks.push_back(std::pair<uint16_t, uint16_t>(match.srcPort, match.srcPortMask));
+	if (hasDstPortRange)
+		portRangeToBlocks(rule.dstPortRangeFirst, rule.dstPortRangeLast, dstPortBlocks);
+	else
+		dstPortBlocks.push_back(std::pair<uint16_t, uint16_t>(match.dstPort, match.dstPortMask));
+
+	// a rule matching an IP protocol without an IP version is created for both versions
+	std::vector<uint16_t> etherTypes;
+	uint16_t etherTypeMask = match.etherTypeMask;
+	if ((match.ipProtocolMask != 0 || matchesPorts) && match.etherTypeMask == 0)
+	{
+		etherTypes.push_back(PCPP_ETHERTYPE_IP);
+		etherTypes.push_back(PCPP_ETHERTYPE_IPV6);
+		etherTypeMask = 0xffff;
+	}
+	else
+		etherTypes.push_back(match.etherType);
+
+	size_t numOfFlows = srcPortBlocks.size() * dstPortBlocks.size() * etherTypes.size();
+	if (numOfFlows > MAX_FLOWS_PER_STEERING_RULE)
+	{
+		LOG_ERROR("Flow rule needs %d NIC rules, more than the maximum of %d. Please narrow or align its port ranges", (int)numOfFlows,
+				MAX_FLOWS_PER_STEERING_RULE);
+		return -1;
+	}
+
+	std::vector<struct rte_flow*> flows;
+	for (size_t i = 0; i < srcPortBlocks.size(); i++)
+	{
+		for (size_t j = 0; j < dstPortBlocks.size(); j++)
+		{
+			for (size_t k = 0; k < etherTypes.size(); k++)
+			{
+				FilterFlowRule flowRule = match;
+				flowRule.srcPort = srcPortBlocks[i].first;
+				flowRule.srcPortMask = srcPortBlocks[i].second;
+				flowRule.dstPort = dstPortBlocks[j].first;
+				flowRule.dstPortMask = dstPortBlocks[j].second;
+
+				struct rte_flow* flow = createFlowRule(m_Id, flowRule, etherTypes[k], etherTypeMask, attr, actions);
+				if (flow == NULL)
+				{
+					LOG_ERROR("Flow rule isn't supported by device [%s]", m_DeviceName);
+					destroyFlows(m_Id, flows, m_DeviceName);
+					return -1;
+				}
+				flows.push_back(flow);
+			}
+		}
+	}
+
+	int ruleId = m_NextSteeringRuleId++;
+	m_SteeringRules[ruleId] = flows;
+	LOG_DEBUG("Flow rule #%d added to device [%s] as %d NIC rules", ruleId, m_DeviceName, (int)flows.size());
+	return ruleId;
+
+#else
+
+	LOG_ERROR("Flow rules require DPDK 18.05 or newer");
+	return -1;
+
+#endif
+}
+
+bool DpdkDevice::removeFlowRule(int ruleId)
+{
+	std::map<int, std::vector<struct rte_flow*> >::iterator iter = m_SteeringRules.find(ruleId);
+	if (iter == m_SteeringRules.end())
+		return false;
+
+#ifdef DPDK_FLOW_RULES_SUPPORTED
+	destroyFlows(m_Id, iter->second, m_DeviceName);
+#endif
+	m_SteeringRules.erase(iter);
+	return true;
+}
+
+void DpdkDevice::removeAllFlowRules()
+{
+#ifdef DPDK_FLOW_RULES_SUPPORTED
+	for (std::map<int, std::vector<struct rte_flow*> >::iterator iter = m_SteeringRules.begin(); iter != m_SteeringRules.end(); ++iter)
+		destroyFlows(m_Id, iter->second, m_DeviceName);
+#endif
+
+	m_SteeringRules.clear();
+}
+
+bool DpdkDevice::setFilter(GeneralFilter& filter)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device not opened");
+		return false;
+	}
+
+	if (!m_StopThread)
+	{
+		LOG_ERROR("Cannot set a filter on device [%s] while capturing", m_DeviceName);
+		return false;
+	}
+
+	std::string filterAsString;
+	filter.parseToString(filterAsString);
+
+	// the rules of an offloaded filter would conflict with the flow rules
+	std::vector<FilterFlowRule> rules;
+	if (m_SteeringRules.empty() && filter.toFlowRules(rules))
+	{
+		clearFilter();
+		if (createFlowRules(rules))
+		{
+			LOG_DEBUG("Filter '%s' offloaded to device [%s] as %d flow rules", filterAsString.c_str(), m_DeviceName, (int)m_FlowRules.size());
+			return true;
+		}
+
+		LOG_DEBUG("Cannot offload filter '%s' to device [%s], filtering in software", filterAsString.c_str(), m_DeviceName);
+	}
+
+	NativeFilterProgram nativeFilter;
+	if (nativeFilter.compile(filter))
+	{
+		clearFilter();
+		m_NativeFilter = nativeFilter;
+		LOG_DEBUG("Filter '%s' set on device [%s] as a native filter of %d predicates", filterAsString.c_str(), m_DeviceName, (int)m_NativeFilter.getNumOfPredicates());
+		return true;
+	}
+
+	return setFilter(filterAsString);
+}
 
 bool DpdkDevice::setFilter(std::string filterAsString)
 {
-	//TODO: I think DPDK supports filters
-	LOG_ERROR("Filters aren't supported in DPDK device");
-	return false;
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device not opened");
+		return false;
+	}
+
+	if (!m_StopThread)
+	{
+		LOG_ERROR("Cannot set a filter on device [%s] while capturing", m_DeviceName);
+		return false;
+	}
+
+	bpf_program* program = new bpf_program();
+	if (pcap_compile_nopcap(SOFTWARE_FILTER_SNAPLEN, LINKTYPE_ETHERNET, program, filterAsString.c_str(), 1, 0) < 0)
+	{
+		LOG_ERROR("Filter '%s' is invalid", filterAsString.c_str());
+		delete program;
+		return false;
+	}
+
+	clearFilter();
+	m_SoftwareFilter = program;
+
+	LOG_DEBUG("Filter '%s' set on device [%s] in software", filterAsString.c_str(), m_DeviceName);
+	return true;
+}
+
+bool DpdkDevice::clearFilter()
+{
+	if (!m_StopThread)
+	{
+		LOG_ERROR("Cannot clear the filter of device [%s] while capturing", m_DeviceName);
+		return false;
+	}
+
+	destroyFlowRules();
+
+	if (m_SoftwareFilter != NULL)
+	{
+		pcap_freecode(m_SoftwareFilter);
+		delete m_SoftwareFilter;
+		m_SoftwareFilter = NULL;
+	}
+
+	m_NativeFilter.clear();
+
+	return true;
+}
+
+bool DpdkDevice::setSampling(const PacketSamplerConfiguration& config)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device not opened");
+		return false;
+	}
+
+	if (!m_StopThread)
+	{
+		LOG_ERROR("Cannot set sampling on device [%s] while capturing", m_DeviceName);
+		return false;
+	}
+
+	PacketSampler* samplers = new PacketSampler[DPDK_MAX_RX_QUEUES];
+	PacketSamplerConfiguration queueConfig = config.divide(m_NumOfRxQueuesOpened);
+	for (int i = 0; i < DPDK_MAX_RX_QUEUES; i++)
+		samplers[i].setConfiguration(queueConfig);
+
+	clearSampling();
+	m_RxSamplers = samplers;
+
+	LOG_DEBUG("Sampling set on device [%s] for %d RX queues", m_DeviceName, (int)m_NumOfRxQueuesOpened);
+	return true;
+}
+
+bool DpdkDevice::clearSampling()
+{
+	if (!m_StopThread)
+	{
+		LOG_ERROR("Cannot clear the sampling of device [%s] while capturing", m_DeviceName);
+		return false;
+	}
+
+	if (m_RxSamplers != NULL)
+	{
+		delete [] m_RxSamplers;
+		m_RxSamplers = NULL;
+	}
+
+	return true;
+}
+
+void DpdkDevice::getSamplingStats(uint64_t& numOfPackets, uint64_t& numOfSampledPackets) const
+{
+	numOfPackets = 0;
+	numOfSampledPackets = 0;
+	if (m_RxSamplers == NULL)
+		return;
+
+	for (int i = 0; i < DPDK_MAX_RX_QUEUES; i++)
+	{
+		numOfPackets += m_RxSamplers[i].getNumOfPackets();
+		numOfSampledPackets += m_RxSamplers[i].getNumOfSampledPackets();
+	}
+}
+
+uint16_t DpdkDevice::receiveBurst(uint16_t rxQueueId, struct rte_mbuf** mBufArray, uint16_t arrLength)
+{
+	uint16_t numOfPackets = rte_eth_rx_burst(m_Id, rxQueueId, mBufArray, arrLength);
+	if (numOfPackets > 0)
+		PCPP_LATENCY_TRACE_RX();
+	if (unlikely(m_RxBurstStatsEnabled))
+		updateRxBurstStats(rxQueueId, numOfPackets);
+
+	bool nativeFilter = m_NativeFilter.isCompiled();
+	PacketSampler* sampler = (m_RxSamplers != NULL && rxQueueId < DPDK_MAX_RX_QUEUES ? &m_RxSamplers[rxQueueId] : NULL);
+	if (likely(m_SoftwareFilter == NULL && !nativeFilter && sampler == NULL) || numOfPackets == 0)
+		return numOfPackets;
+
+	// the rate cap of the sampler uses the same time for all packets of the burst
+	uint64_t burstTimeNs = (sampler != NULL ? TimestampClock::nowNs() : 0);
+
+	// packets which don't match the filter or aren't sampled are freed, and the rest are moved to the beginning of the array
+	struct pcap_pkthdr pktHdr;
+	memset(&pktHdr, 0, sizeof(pktHdr));
+	uint16_t numOfMatchedPackets = 0;
+	for (uint16_t i = 0; i < numOfPackets; i++)
+	{
+		struct rte_mbuf* mBuf = mBufArray[i];
+		bool match = true;
+		if (nativeFilter)
+			match = m_NativeFilter.matchPacket(rte_pktmbuf_mtod(mBuf, const uint8_t*), rte_pktmbuf_data_len(mBuf));
+		else if (m_SoftwareFilter != NULL)
+		{
+			pktHdr.caplen = rte_pktmbuf_data_len(mBuf);
+			pktHdr.len = rte_pktmbuf_pkt_len(mBuf);
+			match = (pcap_offline_filter(m_SoftwareFilter, &pktHdr, rte_pktmbuf_mtod(mBuf, const u_char*)) != 0);
+		}
+
+		if (match && sampler != NULL)
+			match = sampler->samplePacket(rte_pktmbuf_mtod(mBuf, const uint8_t*), rte_pktmbuf_data_len(mBuf), LINKTYPE_ETHERNET, burstTimeNs,
+					(mBuf->ol_flags & MBUF_RX_RSS_HASH) != 0, mBuf->hash.rss);
+
+		if (match)
+			mBufArray[numOfMatchedPackets++] = mBuf;
+		else
+			rte_pktmbuf_free(mBuf);
+	}
+
+	return numOfMatchedPackets;
 }
 
 uint16_t DpdkDevice::receivePackets(MBufRawPacketVector& rawPacketsArr, uint16_t rxQueueId)
@@ -762,7 +2251,7 @@ uint16_t DpdkDevice::receivePackets(MBufRawPacketVector& rawPacketsArr, uint16_t
 	}
 
 	struct rte_mbuf* mBufArray[MAX_BURST_SIZE];
-	uint32_t numOfPktsReceived  = rte_eth_rx_burst(m_Id, rxQueueId, mBufArray, MAX_BURST_SIZE);
+	uint32_t numOfPktsReceived  = receiveBurst(rxQueueId, mBufArray, MAX_BURST_SIZE);
 
 	//the following line trashes the log with many messages. Uncomment only if necessary
 	//LOG_DEBUG("Captured %d packets", numOfPktsReceived);
@@ -772,11 +2261,15 @@ uint16_t DpdkDevice::receivePackets(MBufRawPacketVector& rawPacketsArr, uint16_t
 		return 0;
 	}
 
-	timeval time;
-	gettimeofday(&time, NULL);
+	timespec time = TimestampClock::now();
+
+	uint32_t prefetchDistance = m_RxPrefetchDistance;
 
 	for (uint32_t index = 0; index < numOfPktsReceived; ++index)
 	{
+		if (prefetchDistance > 0)
+			prefetchRxBurst(mBufArray, index, numOfPktsReceived, prefetchDistance);
+
 		struct rte_mbuf* mBuf = mBufArray[index];
 		MBufRawPacket* newRawPacket = new MBufRawPacket();
 		newRawPacket->setMBuf(mBuf, time);
@@ -813,7 +2306,7 @@ uint16_t DpdkDevice::receivePackets(MBufRawPacket** rawPacketsArr, uint16_t rawP
 	}
 
 	struct rte_mbuf* mBufArray[rawPacketArrLength];
-	uint16_t packetsReceived = rte_eth_rx_burst(m_Id, rxQueueId, mBufArray, rawPacketArrLength);
+	uint16_t packetsReceived = receiveBurst(rxQueueId, mBufArray, rawPacketArrLength);
 	//LOG_DEBUG("Captured %d packets", rawPacketArrLength);
 
 	if (unlikely(packetsReceived <= 0))
@@ -821,11 +2314,15 @@ uint16_t DpdkDevice::receivePackets(MBufRawPacket** rawPacketsArr, uint16_t rawP
 		return 0;
 	}
 
-	timeval time;
-	gettimeofday(&time, NULL);
+	timespec time = TimestampClock::now();
+
+	uint32_t prefetchDistance = m_RxPrefetchDistance;
 
 	for (size_t index = 0; index < packetsReceived; ++index)
 	{
+		if (prefetchDistance > 0)
+			prefetchRxBurst(mBufArray, index, packetsReceived, prefetchDistance);
+
 		struct rte_mbuf* mBuf = mBufArray[index];
 		if (rawPacketsArr[index] == NULL)
 			rawPacketsArr[index] = new MBufRawPacket();
@@ -857,7 +2354,7 @@ uint16_t DpdkDevice::receivePackets(Packet** packetsArr, uint16_t packetsArrLeng
 	}
 
 	struct rte_mbuf* mBufArray[packetsArrLength];
-	uint16_t packetsReceived = rte_eth_rx_burst(m_Id, rxQueueId, mBufArray, packetsArrLength);
+	uint16_t packetsReceived = receiveBurst(rxQueueId, mBufArray, packetsArrLength);
 	//LOG_DEBUG("Captured %d packets", packetsArrLength);
 
 	if (unlikely(packetsReceived <= 0))
@@ -865,11 +2362,15 @@ uint16_t DpdkDevice::receivePackets(Packet** packetsArr, uint16_t packetsArrLeng
 		return 0;
 	}
 
-	timeval time;
-	gettimeofday(&time, NULL);
+	timespec time = TimestampClock::now();
+
+	uint32_t prefetchDistance = m_RxPrefetchDistance;
 
 	for (size_t index = 0; index < packetsReceived; ++index)
 	{
+		if (prefetchDistance > 0)
+			prefetchRxBurst(mBufArray, index, packetsReceived, prefetchDistance);
+
 		struct rte_mbuf* mBuf = mBufArray[index];
 		MBufRawPacket* newRawPacket = new MBufRawPacket();
 		newRawPacket->setMBuf(mBuf, time);
@@ -940,6 +2441,8 @@ uint16_t DpdkDevice::sendPacketsInner(uint16_t txQueueId, void* packetStorage, P
 		return 0;
 	}
 
+	PCPP_LATENCY_TRACE_BEGIN(txStart);
+
 	rte_mbuf* mBufArr[MAX_BURST_SIZE];
 
 	int packetIndex = 0;
@@ -988,6 +2491,8 @@ uint16_t DpdkDevice::sendPacketsInner(uint16_t txQueueId, void* packetStorage, P
 		packetsSent += rte_eth_tx_burst(m_Id, txQueueId, mBufArr, mBufArrIndex);
 	}
 
+	PCPP_LATENCY_TRACE_END(txStart, LatencyStageTx, LatencyStageRxToTx);
+
 	return packetsSent;
 }
 
@@ -1141,6 +2646,56 @@ bool DpdkDevice::sendPacket(Packet& packet, uint16_t txQueueId, bool useTxBuffer
 	return sendPacket(*(packet.getRawPacket()), txQueueId);
 }
 
+uint16_t DpdkDevice::sendPacketSegmented(const RawPacket& rawPacket, uint16_t segmentSize, uint16_t txQueueId)
+{
+	PacketSegmenter segmenter(rawPacket, segmentSize);
+	if (!segmenter.isValid())
+		return 0;
+
+	size_t numOfSegments = segmenter.getNumOfSegments();
+	uint64_t offloads = getEnabledOffloads();
+	if (numOfSegments > 1 && segmenter.isTcp() && (offloads & OFFLOAD_TX_TCP_TSO) != 0)
+	{
+		// a packet which doesn't fit in one mbuf is copied into a chained mbuf, which only devices opened with multi-segment TX can send
+		MBufRawPacket mbufRawPacket;
+		if (mbufRawPacket.initFromRawPacket(&rawPacket, this) && (!mbufRawPacket.isMultiSegment() || (offloads & OFFLOAD_TX_MULTI_SEGS) != 0))
+		{
+			if (!mbufRawPacket.setTxTcpSegmentation(segmentSize))
+				return 0;
+
+			return (sendPacket(mbufRawPacket, txQueueId) ? (uint16_t)numOfSegments : 0);
+		}
+	}
+
+	uint16_t numOfSegmentsSent = 0;
+	size_t segmentIndex = 0;
+	while (segmentIndex < numOfSegments)
+	{
+		MBufRawPacket mbufRawPackets[MAX_BURST_SIZE];
+		MBufRawPacket* mbufRawPacketPtrs[MAX_BURST_SIZE];
+		uint16_t burstSize = 0;
+		while (burstSize < MAX_BURST_SIZE && segmentIndex < numOfSegments)
+		{
+			if (!mbufRawPackets[burstSize].init(this) || !segmenter.writeSegment(segmentIndex, mbufRawPackets[burstSize]))
+				break;
+
+			mbufRawPacketPtrs[burstSize] = &mbufRawPackets[burstSize];
+			burstSize++;
+			segmentIndex++;
+		}
+
+		if (burstSize == 0)
+			break;
+
+		uint16_t burstSent = sendPackets(mbufRawPacketPtrs, burstSize, txQueueId);
+		numOfSegmentsSent += burstSent;
+		if (burstSent < burstSize)
+			break;
+	}
+
+	return numOfSegmentsSent;
+}
+
 int DpdkDevice::getAmountOfFreeMbufs()
 {
 	return (int)rte_mempool_avail_count(m_MBufMempool);
@@ -1151,6 +2706,22 @@ int DpdkDevice::getAmountOfMbufsInUse()
 	return (int)rte_mempool_in_use_count(m_MBufMempool);
 }
 
+void DpdkDevice::getMBufPoolInfo(DpdkMBufPoolInfo& info)
+{
+	fillMBufPoolInfo(m_MBufMempool, info);
+	info.numOfDevices = 1;
+	if (!m_MBufPoolShared)
+		return;
+
+	info.numOfDevices = 0;
+	const std::vector<DpdkDevice*>& devices = DpdkDeviceList::getInstance().getDpdkDeviceList();
+	for (std::vector<DpdkDevice*>::const_iterator iter = devices.begin(); iter != devices.end(); iter++)
+	{
+		if ((*iter)->m_MBufMempool == m_MBufMempool)
+			info.numOfDevices++;
+	}
+}
+
 uint64_t DpdkDevice::convertRssHfToDpdkRssHf(uint64_t rssHF)
 {
 	if (rssHF == (uint64_t)-1)
@@ -1315,6 +2886,213 @@ uint64_t DpdkDevice::getSupportedRssHashFunctions()
 	return convertDpdkRssHfToRssHf(devInfo.flow_type_rss_offloads);
 }
 
+uint16_t DpdkDevice::getRssRedirectionTableSize()
+{
+	rte_eth_dev_info devInfo;
+	rte_eth_dev_info_get(m_Id, &devInfo);
+
+	return devInfo.reta_size;
+}
+
+bool DpdkDevice::getRssRedirectionTable(std::vector<uint16_t>& table)
+{
+	table.clear();
+
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened", m_DeviceName);
+		return false;
+	}
+
+	uint16_t retaSize = getRssRedirectionTableSize();
+	if (retaSize == 0)
+	{
+		LOG_ERROR("Device '%s' doesn't expose an RSS redirection table", m_DeviceName);
+		return false;
+	}
+
+	// the table is accessed in groups of 64 entries, each with a mask of the entries to read or write
+	size_t numOfGroups = (retaSize + DPDK_RETA_GROUP_SIZE - 1) / DPDK_RETA_GROUP_SIZE;
+	std::vector<rte_eth_rss_reta_entry64> retaConf(numOfGroups);
+	memset(&retaConf[0], 0, numOfGroups * sizeof(rte_eth_rss_reta_entry64));
+	for (size_t i = 0; i < numOfGroups; i++)
+		retaConf[i].mask = UINT64_MAX;
+
+	int res = rte_eth_dev_rss_reta_query(m_Id, &retaConf[0], retaSize);
+	if (res != 0)
+	{
+		LOG_ERROR("Cannot read the RSS redirection table of device '%s': error %d", m_DeviceName, res);
+		return false;
+	}
+
+	table.resize(retaSize);
+	for (uint16_t i = 0; i < retaSize; i++)
+		table[i] = retaConf[i / DPDK_RETA_GROUP_SIZE].reta[i % DPDK_RETA_GROUP_SIZE];
+
+	return true;
+}
+
+bool DpdkDevice::setRssRedirectionTable(const std::vector<uint16_t>& table)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened", m_DeviceName);
+		return false;
+	}
+
+	uint16_t retaSize = getRssRedirectionTableSize();
+	if (retaSize == 0 || table.size() != retaSize)
+	{
+		LOG_ERROR("The RSS redirection table of device '%s' has %d entries, got %d", m_DeviceName, (int)retaSize, (int)table.size());
+		return false;
+	}
+
+	std::vector<uint16_t> currentTable;
+	if (!getRssRedirectionTable(currentTable))
+		return false;
+
+	size_t numOfGroups = (retaSize + DPDK_RETA_GROUP_SIZE - 1) / DPDK_RETA_GROUP_SIZE;
+	std::vector<rte_eth_rss_reta_entry64> retaConf(numOfGroups);
+	memset(&retaConf[0], 0, numOfGroups * sizeof(rte_eth_rss_reta_entry64));
+	bool changed = false;
+	for (uint16_t i = 0; i < retaSize; i++)
+	{
+		if (table[i] >= m_NumOfRxQueuesOpened)
+		{
+			LOG_ERROR("Entry %d of the RSS redirection table points to RX queue %d which isn't opened", (int)i, (int)table[i]);
+			return false;
+		}
+
+		if (table[i] == currentTable[i])
+			continue;
+
+		retaConf[i / DPDK_RETA_GROUP_SIZE].mask |= ((uint64_t)1 << (i % DPDK_RETA_GROUP_SIZE));
+		retaConf[i / DPDK_RETA_GROUP_SIZE].reta[i % DPDK_RETA_GROUP_SIZE] = table[i];
+		changed = true;
+	}
+
+	if (!changed)
+		return true;
+
+	int res = rte_eth_dev_rss_reta_update(m_Id, &retaConf[0], retaSize);
+	if (res != 0)
+	{
+		LOG_ERROR("Cannot update the RSS redirection table of device '%s': error %d", m_DeviceName, res);
+		return false;
+	}
+
+	LOG_DEBUG("Updated the RSS redirection table of device '%s'", m_DeviceName);
+	return true;
+}
+
+void DpdkDevice::convertOffloadsToDpdkOffloads(uint64_t offloads, uint64_t& dpdkRxOffloads, uint64_t& dpdkTxOffloads)
+{
+	dpdkRxOffloads = 0;
+	dpdkTxOffloads = 0;
+
+#ifdef DPDK_OFFLOADS_SUPPORTED
+	if ((offloads & OFFLOAD_RX_IPV4_CKSUM) != 0)
+		dpdkRxOffloads |= DEV_RX_OFFLOAD_IPV4_CKSUM;
+
+	if ((offloads & OFFLOAD_RX_TCP_CKSUM) != 0)
+		dpdkRxOffloads |= DEV_RX_OFFLOAD_TCP_CKSUM;
+
+	if ((offloads & OFFLOAD_RX_UDP_CKSUM) != 0)
+		dpdkRxOffloads |= DEV_RX_OFFLOAD_UDP_CKSUM;
+
+	if ((offloads & OFFLOAD_RX_VLAN_STRIP) != 0)
+		dpdkRxOffloads |= DEV_RX_OFFLOAD_VLAN_STRIP;
+
+	if ((offloads & OFFLOAD_RX_TIMESTAMP) != 0)
+		dpdkRxOffloads |= DEV_RX_OFFLOAD_TIMESTAMP;
+
+	if ((offloads & OFFLOAD_RX_TCP_LRO) != 0)
+		dpdkRxOffloads |= DEV_RX_OFFLOAD_TCP_LRO;
+
+	if ((offloads & OFFLOAD_RX_SCATTER) != 0)
+		dpdkRxOffloads |= DEV_RX_OFFLOAD_SCATTER;
+
+	if ((offloads & OFFLOAD_TX_IPV4_CKSUM) != 0)
+		dpdkTxOffloads |= DEV_TX_OFFLOAD_IPV4_CKSUM;
+
+	if ((offloads & OFFLOAD_TX_TCP_CKSUM) != 0)
+		dpdkTxOffloads |= DEV_TX_OFFLOAD_TCP_CKSUM;
+
+	if ((offloads & OFFLOAD_TX_UDP_CKSUM) != 0)
+		dpdkTxOffloads |= DEV_TX_OFFLOAD_UDP_CKSUM;
+
+	if ((offloads & OFFLOAD_TX_VLAN_INSERT) != 0)
+		dpdkTxOffloads |= DEV_TX_OFFLOAD_VLAN_INSERT;
+
+	if ((offloads & OFFLOAD_TX_TCP_TSO) != 0)
+		dpdkTxOffloads |= DEV_TX_OFFLOAD_TCP_TSO;
+
+	if ((offloads & OFFLOAD_TX_MULTI_SEGS) != 0)
+		dpdkTxOffloads |= DEV_TX_OFFLOAD_MULTI_SEGS;
+#endif
+}
+
+uint64_t DpdkDevice::convertDpdkOffloadsToOffloads(uint64_t dpdkRxOffloads, uint64_t dpdkTxOffloads)
+{
+	uint64_t offloads = 0;
+
+#ifdef DPDK_OFFLOADS_SUPPORTED
+	if ((dpdkRxOffloads & DEV_RX_OFFLOAD_IPV4_CKSUM) != 0)
+		offloads |= OFFLOAD_RX_IPV4_CKSUM;
+
+	if ((dpdkRxOffloads & DEV_RX_OFFLOAD_TCP_CKSUM) != 0)
+		offloads |= OFFLOAD_RX_TCP_CKSUM;
+
+	if ((dpdkRxOffloads & DEV_RX_OFFLOAD_UDP_CKSUM) != 0)
+		offloads |= OFFLOAD_RX_UDP_CKSUM;
+
+	if ((dpdkRxOffloads & DEV_RX_OFFLOAD_VLAN_STRIP) != 0)
+		offloads |= OFFLOAD_RX_VLAN_STRIP;
+
+	if ((dpdkRxOffloads & DEV_RX_OFFLOAD_TIMESTAMP) != 0)
+		offloads |= OFFLOAD_RX_TIMESTAMP;
+
+	if ((dpdkRxOffloads & DEV_RX_OFFLOAD_TCP_LRO) != 0)
+		offloads |= OFFLOAD_RX_TCP_LRO;
+
+	if ((dpdkRxOffloads & DEV_RX_OFFLOAD_SCATTER) != 0)
+		offloads |= OFFLOAD_RX_SCATTER;
+
+	if ((dpdkTxOffloads & DEV_TX_OFFLOAD_IPV4_CKSUM) != 0)
+		offloads |= OFFLOAD_TX_IPV4_CKSUM;
+
+	if ((dpdkTxOffloads & DEV_TX_OFFLOAD_TCP_CKSUM) != 0)
+		offloads |= OFFLOAD_TX_TCP_CKSUM;
+
+	if ((dpdkTxOffloads & DEV_TX_OFFLOAD_UDP_CKSUM) != 0)
+		offloads |= OFFLOAD_TX_UDP_CKSUM;
+
+	if ((dpdkTxOffloads & DEV_TX_OFFLOAD_VLAN_INSERT) != 0)
+		offloads |= OFFLOAD_TX_VLAN_INSERT;
+
+	if ((dpdkTxOffloads & DEV_TX_OFFLOAD_TCP_TSO) != 0)
+		offloads |= OFFLOAD_TX_TCP_TSO;
+
+	if ((dpdkTxOffloads & DEV_TX_OFFLOAD_MULTI_SEGS) != 0)
+		offloads |= OFFLOAD_TX_MULTI_SEGS;
+#endif
+
+	return offloads;
+}
+
+bool DpdkDevice::isDeviceSupportOffloads(uint64_t offloads)
+{
+	return ((getSupportedOffloads() & offloads) == offloads);
+}
+
+uint64_t DpdkDevice::getSupportedOffloads()
+{
+	rte_eth_dev_info devInfo;
+	rte_eth_dev_info_get(m_Id, &devInfo);
+
+	return convertDpdkOffloadsToOffloads(devInfo.rx_offload_capa, devInfo.tx_offload_capa);
+}
+
 
 } // namespace pcpp
 
@@ -37,6 +37,7 @@
 #include <sstream>
 #include <iomanip>
 #include <string>
+#include <map>
 #include <algorithm>
 #include <unistd.h>
 
@@ -44,12 +45,16 @@ namespace pcpp
 {
 
 bool DpdkDeviceList::m_IsDpdkInitialized = false;
+bool DpdkDeviceList::m_IsSecondaryProcess = false;
 CoreMask DpdkDeviceList::m_CoreMask = 0;
-uint32_t DpdkDeviceList::m_MBufPoolSizePerDevice = 0;
+DpdkMBufPoolConfig DpdkDeviceList::m_MBufPoolConfig(0);
 
 DpdkDeviceList::DpdkDeviceList()
 {
 	m_IsInitialized = false;
+	m_WorkerHwCountersEnabled = false;
+	for (int i = 0; i < MAX_NUM_OF_CORES; i++)
+		m_WorkerHwCounters[i] = NULL;
 }
 
 DpdkDeviceList::~DpdkDeviceList()
@@ -60,21 +65,25 @@ DpdkDeviceList::~DpdkDeviceList()
 	}
 
 	m_DpdkDeviceList.clear();
-}
 
-const uint32_t initDpdkArgc = 7;
-const uint32_t maxArgLen = 20;
-char** initDpdkArgv;
+	for (int i = 0; i < MAX_NUM_OF_CORES; i++)
+		delete m_WorkerHwCounters[i];
+}
 
 bool DpdkDeviceList::initDpdk(CoreMask coreMask, uint32_t mBufPoolSizePerDevice, uint8_t masterCore)
+{
+	return initDpdk(coreMask, DpdkMBufPoolConfig(mBufPoolSizePerDevice), masterCore);
+}
+
+bool DpdkDeviceList::initDpdk(CoreMask coreMask, const DpdkMBufPoolConfig& mBufPoolConfig, uint8_t masterCore)
 {
 	if (m_IsDpdkInitialized)
 	{
-		if (coreMask == m_CoreMask)
+		if (coreMask == m_CoreMask && !m_IsSecondaryProcess)
 			return true;
 		else
 		{
-			LOG_ERROR("Trying to re-initialize DPDK with a different core mask");
+			LOG_ERROR("Trying to re-initialize DPDK with a different core mask or process type");
 			return false;
 		}
 	}
@@ -84,66 +93,129 @@ bool DpdkDeviceList::initDpdk(CoreMask coreMask, uint32_t mBufPoolSizePerDevice,
 		return false;
 	}
 
-	// verify mBufPoolSizePerDevice is power of 2 minus 1
-	bool isPoolSizePowerOfTwoMinusOne = !(mBufPoolSizePerDevice == 0) && !((mBufPoolSizePerDevice+1) & (mBufPoolSizePerDevice));
+	// verify the pool size is power of 2 minus 1
+	uint32_t mBufPoolSize = mBufPoolConfig.poolSize;
+	bool isPoolSizePowerOfTwoMinusOne = !(mBufPoolSize == 0) && !((mBufPoolSize+1) & (mBufPoolSize));
 	if (!isPoolSizePowerOfTwoMinusOne)
 	{
-		LOG_ERROR("mBuf pool size must be a power of two minus one: n = (2^q - 1). It's currently: %d", mBufPoolSizePerDevice);
+		LOG_ERROR("mBuf pool size must be a power of two minus one: n = (2^q - 1). It's currently: %d", mBufPoolSize);
+		return false;
+	}
+
+	// DPDK flushes a per-core cache when it grows to 1.5 times its size, so the pool must be able to fill it that far
+	if (mBufPoolConfig.cacheSize > RTE_MEMPOOL_CACHE_MAX_SIZE || (uint64_t)mBufPoolConfig.cacheSize * 3 / 2 > mBufPoolSize)
+	{
+		LOG_ERROR("mBuf pool cache size must be at most %d and at most 2/3 of the pool size. It's currently: %d", RTE_MEMPOOL_CACHE_MAX_SIZE,
+				mBufPoolConfig.cacheSize);
+		return false;
+	}
+
+	if (mBufPoolConfig.dataRoomSize != 0 && mBufPoolConfig.dataRoomSize <= RTE_PKTMBUF_HEADROOM)
+	{
+		LOG_ERROR("mBuf data room size must be larger than the mBuf headroom (%d). It's currently: %d", RTE_PKTMBUF_HEADROOM,
+				(int)mBufPoolConfig.dataRoomSize);
 		return false;
 	}
 
 
-	std::stringstream dpdkParamsStream;
-	dpdkParamsStream << "pcapplusplusapp ";
-	dpdkParamsStream << "-n ";
-	dpdkParamsStream << "2 ";
-	dpdkParamsStream << "-c ";
-	dpdkParamsStream << "0x" << std::hex << std::setw(2) << std::setfill('0') << coreMask << " ";
-	dpdkParamsStream << "--master-lcore ";
-	dpdkParamsStream << (int)masterCore;
+	if (!initEal(coreMask, masterCore, false))
+		return false;
+
+	// publish the state secondary processes need for attaching to the devices. It's not mandatory for working with the devices
+	if (!DpdkDevice::initSharedPortStates(true))
+		LOG_ERROR("Secondary processes won't be able to attach to the DPDK devices");
 
-	std::string dpdkParamsArray[initDpdkArgc];
-	initDpdkArgv = new char*[initDpdkArgc];
-	uint32_t i = 0;
-    while (dpdkParamsStream.good() && i < initDpdkArgc){
-    	dpdkParamsStream >> dpdkParamsArray[i];
-    	initDpdkArgv[i] = new char[maxArgLen];
-    	strcpy(initDpdkArgv[i], dpdkParamsArray[i].c_str());
-        i++;
-    }
+	m_CoreMask = coreMask;
+	m_IsDpdkInitialized = true;
 
-    char* lastParam = initDpdkArgv[i-1];
+	m_MBufPoolConfig = mBufPoolConfig;
+	DpdkDeviceList::getInstance().setDpdkLogLevel(LoggerPP::Normal);
+	return DpdkDeviceList::getInstance().initDpdkDevices(m_MBufPoolConfig);
+}
 
-	for (i = 0; i < initDpdkArgc; i++)
+bool DpdkDeviceList::initDpdkSecondary(CoreMask coreMask, uint8_t masterCore)
+{
+	if (m_IsDpdkInitialized)
 	{
-		LOG_DEBUG("DPDK initialization params: %s", initDpdkArgv[i]);
+		if (coreMask == m_CoreMask && m_IsSecondaryProcess)
+			return true;
+		else
+		{
+			LOG_ERROR("Trying to re-initialize DPDK with a different core mask or process type");
+			return false;
+		}
 	}
 
-	optind = 1;
-	// init the EAL
-	int ret = rte_eal_init(initDpdkArgc, (char**)initDpdkArgv);
-	if (ret < 0) {
-		LOG_ERROR("failed to init the DPDK EAL");
+	if (!verifyHugePagesAndDpdkDriver())
+	{
 		return false;
 	}
 
-	for (i = 0; i < initDpdkArgc-1; i++)
+	if (!initEal(coreMask, masterCore, true))
+		return false;
+
+	if (!DpdkDevice::initSharedPortStates(false))
 	{
-		delete [] initDpdkArgv[i];
+		LOG_ERROR("Couldn't find the DPDK devices state of the primary process, is the primary process running PcapPlusPlus?");
+		return false;
 	}
-	delete [] lastParam;
-
-	delete [] initDpdkArgv;
 
 	m_CoreMask = coreMask;
 	m_IsDpdkInitialized = true;
+	m_IsSecondaryProcess = true;
 
-	m_MBufPoolSizePerDevice = mBufPoolSizePerDevice;
 	DpdkDeviceList::getInstance().setDpdkLogLevel(LoggerPP::Normal);
-	return DpdkDeviceList::getInstance().initDpdkDevices(m_MBufPoolSizePerDevice);
+	return DpdkDeviceList::getInstance().initDpdkDevices(m_MBufPoolConfig);
 }
 
-bool DpdkDeviceList::initDpdkDevices(uint32_t mBufPoolSizePerDevice)
+bool DpdkDeviceList::initEal(CoreMask coreMask, uint8_t masterCore, bool secondaryProcess)
+{
+	std::stringstream coreMaskStream;
+	coreMaskStream << "0x" << std::hex << std::setw(2) << std::setfill('0') << coreMask;
+	std::stringstream masterCoreStream;
+	masterCoreStream << (int)masterCore;
+
+	std::vector<std::string> dpdkParams;
+	dpdkParams.push_back("pcapplusplusapp");
+	dpdkParams.push_back("-n");
+	dpdkParams.push_back("2");
+	dpdkParams.push_back("-c");
+	dpdkParams.push_back(coreMaskStream.str());
+	dpdkParams.push_back("--master-lcore");
+	dpdkParams.push_back(masterCoreStream.str());
+	if (secondaryProcess)
+		dpdkParams.push_back("--proc-type=secondary");
+
+	// rte_eal_init() may reorder the argv entries, so the strings are freed through a copy of the pointers
+	int initDpdkArgc = (int)dpdkParams.size();
+	char** initDpdkArgv = new char*[initDpdkArgc];
+	std::vector<char*> paramsToFree;
+	for (int i = 0; i < initDpdkArgc; i++)
+	{
+		initDpdkArgv[i] = new char[dpdkParams[i].length() + 1];
+		strcpy(initDpdkArgv[i], dpdkParams[i].c_str());
+		paramsToFree.push_back(initDpdkArgv[i]);
+		LOG_DEBUG("DPDK initialization params: %s", initDpdkArgv[i]);
+	}
+
+	optind = 1;
+	// init the EAL
+	int ret = rte_eal_init(initDpdkArgc, initDpdkArgv);
+
+	for (std::vector<char*>::iterator iter = paramsToFree.begin(); iter != paramsToFree.end(); iter++)
+		delete [] (*iter);
+	delete [] initDpdkArgv;
+
+	if (ret < 0)
+	{
+		LOG_ERROR("failed to init the DPDK EAL");
+		return false;
+	}
+
+	return true;
+}
+
+bool DpdkDeviceList::initDpdkDevices(const DpdkMBufPoolConfig& mBufPoolConfig)
 {
 	if (!m_IsDpdkInitialized)
 	{
@@ -168,10 +240,53 @@ bool DpdkDeviceList::initDpdkDevices(uint32_t mBufPoolSizePerDevice)
 
 	LOG_DEBUG("Found %d DPDK ports. Constructing DpdkDevice for each one", numOfPorts);
 
+	// the pools shared by the devices of each NUMA socket, created when the first device of the socket is initialized
+	std::map<int, struct rte_mempool*> sharedMBufPools;
+
 	// Initialize a DpdkDevice per port
 	for (int i = 0; i < numOfPorts; i++)
 	{
-		DpdkDevice* newDevice = new DpdkDevice(i, mBufPoolSizePerDevice);
+		struct rte_mempool* sharedMBufPool = NULL;
+		if (m_IsSecondaryProcess)
+		{
+			// a secondary process uses the pool the primary process created for the device
+			sharedMBufPool = DpdkDevice::lookupMBufPool(i);
+			if (sharedMBufPool == NULL)
+			{
+				for (std::vector<DpdkDevice*>::iterator iter = m_DpdkDeviceList.begin(); iter != m_DpdkDeviceList.end(); iter++)
+					delete (*iter);
+				m_DpdkDeviceList.clear();
+				return false;
+			}
+		}
+		else if (mBufPoolConfig.sharedPool)
+		{
+			// all devices share one pool when it's allocated from an external heap, as the heap has a single socket ID
+			int socketId = (mBufPoolConfig.externalHeapName.empty() ? DpdkDevice::getMBufPoolSocketId(i, mBufPoolConfig) : SOCKET_ID_ANY);
+			std::map<int, struct rte_mempool*>::iterator poolIter = sharedMBufPools.find(socketId);
+			if (poolIter != sharedMBufPools.end())
+			{
+				sharedMBufPool = poolIter->second;
+			}
+			else
+			{
+				char mBufMemPoolName[32];
+				sprintf(mBufMemPoolName, "MBufMemPoolShared%d", (int)sharedMBufPools.size());
+				sharedMBufPool = DpdkDevice::createMBufPool(mBufMemPoolName, mBufPoolConfig, socketId);
+				if (sharedMBufPool == NULL)
+				{
+					LOG_ERROR("Could not initialize the shared mBuf mempool of socket %d", socketId);
+					for (std::vector<DpdkDevice*>::iterator iter = m_DpdkDeviceList.begin(); iter != m_DpdkDeviceList.end(); iter++)
+						delete (*iter);
+					m_DpdkDeviceList.clear();
+					return false;
+				}
+
+				sharedMBufPools[socketId] = sharedMBufPool;
+			}
+		}
+
+		DpdkDevice* newDevice = new DpdkDevice(i, mBufPoolConfig, sharedMBufPool);
 		LOG_DEBUG("DpdkDevice #%d: Name='%s', PCI-slot='%s', PMD='%s', MAC Addr='%s'",
 				i,
 				newDevice->getDeviceName().c_str(),
@@ -218,6 +333,33 @@ DpdkDevice* DpdkDeviceList::getDeviceByPciAddress(const std::string& pciAddr)
 	return NULL;
 }
 
+void DpdkDeviceList::getMBufPoolsInfo(std::vector<DpdkMBufPoolInfo>& poolsInfo)
+{
+	poolsInfo.clear();
+
+	// the index of each pool in poolsInfo, so a shared pool is reported once with the number of its devices
+	std::map<struct rte_mempool*, size_t> poolIndexes;
+	for (std::vector<DpdkDevice*>::iterator iter = m_DpdkDeviceList.begin(); iter != m_DpdkDeviceList.end(); iter++)
+	{
+		struct rte_mempool* mempool = (*iter)->m_MBufMempool;
+		if (mempool == NULL)
+			continue;
+
+		std::map<struct rte_mempool*, size_t>::iterator poolIter = poolIndexes.find(mempool);
+		if (poolIter != poolIndexes.end())
+		{
+			poolsInfo[poolIter->second].numOfDevices++;
+			continue;
+		}
+
+		DpdkMBufPoolInfo info;
+		DpdkDevice::fillMBufPoolInfo(mempool, info);
+		info.numOfDevices = 1;
+		poolIndexes[mempool] = poolsInfo.size();
+		poolsInfo.push_back(info);
+	}
+}
+
 bool DpdkDeviceList::verifyHugePagesAndDpdkDriver()
 {
 	std::string execResult = executeShellCommand("cat /proc/meminfo | grep -s HugePages_Total | awk '{print $2}'");
@@ -289,7 +431,18 @@ bool DpdkDeviceList::writeDpdkLogToFile(FILE* logFile)
 int DpdkDeviceList::dpdkWorkerThreadStart(void *ptr)
 {
 	DpdkWorkerThread* workerThread = (DpdkWorkerThread*)ptr;
-	workerThread->run(rte_lcore_id());
+	uint32_t coreId = rte_lcore_id();
+
+	// hardware counters count the thread which opens them, so they're opened here on the worker's core
+	HardwareCounters* hwCounters = (coreId < MAX_NUM_OF_CORES ? getInstance().m_WorkerHwCounters[coreId] : NULL);
+	if (hwCounters != NULL && hwCounters->open())
+		hwCounters->start();
+
+	workerThread->run(coreId);
+
+	if (hwCounters != NULL && hwCounters->isOpen())
+		hwCounters->stop();
+
 	return 0;
 }
 
@@ -350,6 +503,13 @@ bool DpdkDeviceList::startDpdkWorkerThreads(CoreMask coreMask, std::vector<DpdkW
 			continue;
 		}
 
+		// the counters of a worker which still runs on this core are in use, launching on it fails anyway
+		if (rte_eal_get_lcore_state(core.Id) != RUNNING)
+		{
+			delete m_WorkerHwCounters[core.Id];
+			m_WorkerHwCounters[core.Id] = (m_WorkerHwCountersEnabled ? new HardwareCounters() : NULL);
+		}
+
 		int err = rte_eal_remote_launch(dpdkWorkerThreadStart, *iter, core.Id);
 		if (err != 0)
 		{
@@ -371,6 +531,56 @@ bool DpdkDeviceList::startDpdkWorkerThreads(CoreMask coreMask, std::vector<DpdkW
 	return true;
 }
 
+bool DpdkDeviceList::startDpdkWorkerThreadsOnDeviceSocket(DpdkDevice* device, std::vector<DpdkWorkerThread*>& workerThreadsVec)
+{
+	if (!isInitialized())
+	{
+		LOG_ERROR("DpdkDeviceList not initialized");
+		return false;
+	}
+
+	if (device == NULL)
+	{
+		LOG_ERROR("Device is NULL");
+		return false;
+	}
+
+	int numaNode = device->getNumaNode();
+	CoreMask coreMask = getNumaLocalWorkerCoreMask(numaNode, (int)workerThreadsVec.size());
+
+	std::vector<SystemCore> cores;
+	createCoreVectorFromCoreMask(coreMask, cores);
+	if (cores.size() < workerThreadsVec.size())
+	{
+		LOG_ERROR("Not enough cores initialized by DPDK for %d worker threads, only %d cores are available", (int)workerThreadsVec.size(), (int)cores.size());
+		return false;
+	}
+
+	LOG_DEBUG("Selected core mask 0x%X for %d worker threads of device [%s] on NUMA node %d", coreMask, (int)workerThreadsVec.size(), device->getDeviceName().c_str(), numaNode);
+
+	return startDpdkWorkerThreads(coreMask, workerThreadsVec);
+}
+
+CoreMask DpdkDeviceList::getNumaLocalWorkerCoreMask(int numaNode, int numOfCores)
+{
+	if (!isInitialized())
+	{
+		LOG_ERROR("DpdkDeviceList not initialized");
+		return 0;
+	}
+
+	CoreMask availableCores = 0;
+	for (int coreId = 0; coreId < MAX_NUM_OF_CORES; coreId++)
+	{
+		if (rte_lcore_is_enabled(coreId))
+			availableCores |= SystemCores::IdToSystemCore[coreId].Mask;
+	}
+
+	availableCores &= ~getDpdkMasterCore().Mask;
+
+	return selectNumaLocalCores(numaNode, numOfCores, availableCores);
+}
+
 void DpdkDeviceList::stopDpdkWorkerThreads()
 {
 	if (m_WorkerThreads.empty())
@@ -389,6 +599,16 @@ void DpdkDeviceList::stopDpdkWorkerThreads()
 	LOG_DEBUG("All worker threads stopped");
 }
 
+bool DpdkDeviceList::getWorkerHardwareCounters(uint32_t coreId, HardwareCounterValues& result) const
+{
+	result.clear();
+	if (coreId >= MAX_NUM_OF_CORES || m_WorkerHwCounters[coreId] == NULL)
+		return false;
+
+	m_WorkerHwCounters[coreId]->read(result);
+	return true;
+}
+
 } // namespace pcpp
 
 #endif /* USE_DPDK */
@@ -0,0 +1,541 @@
+#ifdef USE_DPDK
+
+#define LOG_MODULE PcapLogModuleDpdkEventScheduler
+
+#include "DpdkEventScheduler.h"
+#include "PacketView.h"
+#include "FlowHash.h"
+#include "TimestampClock.h"
+#include "Logger.h"
+#include "rte_version.h"
+#include "rte_config.h"
+#include "rte_mbuf.h"
+#include "rte_launch.h"
+#include "rte_lcore.h"
+#include "rte_errno.h"
+#if (RTE_VER_YEAR > 18) || (RTE_VER_YEAR == 18 && RTE_VER_MONTH >= 11)
+#define DPDK_EVENTDEV_SUPPORTED
+#include "rte_eventdev.h"
+#include "rte_service.h"
+#endif
+#include <string.h>
+
+// the mbuf offload flags were renamed in DPDK 21.11
+#ifdef RTE_MBUF_F_RX_RSS_HASH
+#define MBUF_RX_RSS_HASH RTE_MBUF_F_RX_RSS_HASH
+#else
+#define MBUF_RX_RSS_HASH PKT_RX_RSS_HASH
+#endif
+
+// event devices take a 20-bit flow ID
+#define EVENT_FLOW_ID_MASK 0xfffff
+
+// the number of flows the atomic queue tracks, which is also the default of the software event device
+#define EVENT_QUEUE_NUM_OF_FLOWS 1024
+
+namespace pcpp
+{
+
+#ifdef DPDK_EVENTDEV_SUPPORTED
+// called by rte_event_dev_stop() for each event still in the device
+static void flushEvent(uint8_t eventDevId, struct rte_event event, void* arg)
+{
+	if (event.mbuf != NULL)
+		rte_pktmbuf_free(event.mbuf);
+}
+#endif
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DpdkEventRxThread class
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+DpdkEventRxThread::DpdkEventRxThread(DpdkEventScheduler* scheduler, uint8_t portId) :
+	m_Scheduler(scheduler), m_PortId(portId), m_CoreId(MAX_NUM_OF_CORES + 1), m_Stop(true), m_RxPackets(0), m_RxDrops(0)
+{
+}
+
+uint32_t DpdkEventRxThread::getFlowId(struct rte_mbuf* mBuf) const
+{
+	if (m_Scheduler->m_UseNicRssHash && (mBuf->ol_flags & MBUF_RX_RSS_HASH) != 0)
+		return mBuf->hash.rss & EVENT_FLOW_ID_MASK;
+
+	PacketView view;
+	FlowTuple tuple;
+	if (!FlowKeyExtractor::extract(rte_pktmbuf_mtod(mBuf, const uint8_t*), rte_pktmbuf_data_len(mBuf), LINKTYPE_ETHERNET, view) ||
+			!FlowHash::getTuple(view, tuple))
+		return 0;
+
+	return FlowHash::hashSymmetric(tuple) & EVENT_FLOW_ID_MASK;
+}
+
+bool DpdkEventRxThread::run(uint32_t coreId)
+{
+	m_CoreId = coreId;
+	m_Stop = false;
+
+#ifdef DPDK_EVENTDEV_SUPPORTED
+	uint8_t eventDevId = m_Scheduler->m_EventDevId;
+	uint32_t serviceId = m_Scheduler->m_ServiceId;
+	struct rte_mbuf* mBufArray[PCPP_DPDK_EVENT_SCHEDULER_BURST_SIZE];
+	struct rte_event events[PCPP_DPDK_EVENT_SCHEDULER_BURST_SIZE];
+	size_t queueIndex = 0;
+
+	LOG_DEBUG("RX thread started on core %d with event port %d", (int)coreId, (int)m_PortId);
+
+	while (!m_Stop)
+	{
+		// a software event device schedules only when some core runs its service
+		if (serviceId != DpdkEventScheduler::NoServiceId)
+			rte_service_run_iter_on_app_lcore(serviceId, 1);
+
+		RxQueue& rxQueue = m_RxQueues[queueIndex];
+		queueIndex = (queueIndex + 1 < m_RxQueues.size() ? queueIndex + 1 : 0);
+
+		uint16_t numOfPackets = rxQueue.device->receiveBurst(rxQueue.rxQueueId, mBufArray, PCPP_DPDK_EVENT_SCHEDULER_BURST_SIZE);
+		if (numOfPackets == 0)
+			continue;
+
+		for (uint16_t i = 0; i < numOfPackets; i++)
+		{
+			events[i].event = 0;
+			events[i].flow_id = getFlowId(mBufArray[i]);
+			events[i].op = RTE_EVENT_OP_NEW;
+			events[i].sched_type = RTE_SCHED_TYPE_ATOMIC;
+			events[i].queue_id = 0;
+			events[i].event_type = RTE_EVENT_TYPE_ETHDEV;
+			events[i].sub_event_type = 0;
+			events[i].priority = RTE_EVENT_DEV_PRIORITY_NORMAL;
+			events[i].mbuf = mBufArray[i];
+		}
+
+		uint16_t numOfEnqueued = rte_event_enqueue_burst(eventDevId, m_PortId, events, numOfPackets);
+
+		// the event device is full (it refuses new events above the port's threshold), drop the rest of the burst
+		for (uint16_t i = numOfEnqueued; i < numOfPackets; i++)
+			rte_pktmbuf_free(mBufArray[i]);
+
+		m_RxPackets += numOfPackets;
+		m_RxDrops += numOfPackets - numOfEnqueued;
+	}
+
+	LOG_DEBUG("RX thread on core %d stopped", (int)coreId);
+	return true;
+#else
+	LOG_ERROR("Event devices require DPDK 18.11 or later");
+	return false;
+#endif
+}
+
+void DpdkEventRxThread::stop()
+{
+	m_Stop = true;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DpdkEventWorkerThread class
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+DpdkEventWorkerThread::DpdkEventWorkerThread(DpdkEventScheduler* scheduler, uint8_t portId, uint8_t workerId) :
+	m_Scheduler(scheduler), m_PortId(portId), m_WorkerId(workerId), m_CoreId(MAX_NUM_OF_CORES + 1), m_Stop(true), m_Packets(0), m_Bursts(0)
+{
+}
+
+bool DpdkEventWorkerThread::run(uint32_t coreId)
+{
+	m_CoreId = coreId;
+	m_Stop = false;
+
+#ifdef DPDK_EVENTDEV_SUPPORTED
+	uint8_t eventDevId = m_Scheduler->m_EventDevId;
+	OnDpdkEventPacketsCallback onPacketsArrive = m_Scheduler->m_OnPacketsArrive;
+	void* userCookie = m_Scheduler->m_UserCookie;
+	MBufRawPacket rawPackets[PCPP_DPDK_EVENT_SCHEDULER_BURST_SIZE];
+	struct rte_event events[PCPP_DPDK_EVENT_SCHEDULER_BURST_SIZE];
+	uint16_t numOfEvents = 0;
+
+	LOG_DEBUG("Worker #%d started on core %d with event port %d", (int)m_WorkerId, (int)coreId, (int)m_PortId);
+
+	while (!m_Stop)
+	{
+		// dequeueing releases the flows of the previous burst, so they may be scheduled to other workers
+		numOfEvents = rte_event_dequeue_burst(eventDevId, m_PortId, events, PCPP_DPDK_EVENT_SCHEDULER_BURST_SIZE, 0);
+		if (numOfEvents == 0)
+			continue;
+
+		timespec time = TimestampClock::now();
+		for (uint16_t i = 0; i < numOfEvents; i++)
+			rawPackets[i].setMBuf(events[i].mbuf, time);
+
+		onPacketsArrive(rawPackets, numOfEvents, m_WorkerId, userCookie);
+
+		for (uint16_t i = 0; i < numOfEvents; i++)
+			rawPackets[i].releaseMBuf();
+
+		m_Packets += numOfEvents;
+		m_Bursts++;
+	}
+
+	// release the flows of the last burst explicitly, since there's no next dequeue
+	if (numOfEvents > 0)
+	{
+		for (uint16_t i = 0; i < numOfEvents; i++)
+			events[i].op = RTE_EVENT_OP_RELEASE;
+		rte_event_enqueue_burst(eventDevId, m_PortId, events, numOfEvents);
+	}
+
+	LOG_DEBUG("Worker #%d on core %d stopped", (int)m_WorkerId, (int)coreId);
+	return true;
+#else
+	LOG_ERROR("Event devices require DPDK 18.11 or later");
+	return false;
+#endif
+}
+
+void DpdkEventWorkerThread::stop()
+{
+	m_Stop = true;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DpdkEventScheduler class
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+DpdkEventScheduler::DpdkEventScheduler(uint8_t eventDevId, bool useNicRssHash) :
+	m_EventDevId(eventDevId), m_UseNicRssHash(useNicRssHash), m_Running(false), m_EventDevStarted(false), m_ServiceId(NoServiceId),
+	m_OnPacketsArrive(NULL), m_UserCookie(NULL)
+{
+}
+
+DpdkEventScheduler::~DpdkEventScheduler()
+{
+	stop();
+	deleteThreads();
+}
+
+bool DpdkEventScheduler::addRxQueue(DpdkDevice* device, uint16_t rxQueueId)
+{
+	if (m_Running)
+	{
+		LOG_ERROR("Cannot add an RX queue while the scheduler is running");
+		return false;
+	}
+
+	if (device == NULL)
+	{
+		LOG_ERROR("Device is NULL");
+		return false;
+	}
+
+	if (rxQueueId >= device->getNumOfOpenedRxQueues())
+	{
+		LOG_ERROR("RX queue %d doesn't exist on device '%s'", (int)rxQueueId, device->getDeviceName().c_str());
+		return false;
+	}
+
+	for (std::vector<DpdkEventRxThread::RxQueue>::iterator iter = m_RxQueues.begin(); iter != m_RxQueues.end(); ++iter)
+	{
+		if (iter->device == device && iter->rxQueueId == rxQueueId)
+		{
+			LOG_ERROR("RX queue %d of device '%s' was already added", (int)rxQueueId, device->getDeviceName().c_str());
+			return false;
+		}
+	}
+
+	DpdkEventRxThread::RxQueue rxQueue;
+	rxQueue.device = device;
+	rxQueue.rxQueueId = rxQueueId;
+	m_RxQueues.push_back(rxQueue);
+	return true;
+}
+
+bool DpdkEventScheduler::addDevice(DpdkDevice* device)
+{
+	if (device == NULL)
+	{
+		LOG_ERROR("Device is NULL");
+		return false;
+	}
+
+	if (device->getNumOfOpenedRxQueues() == 0)
+	{
+		LOG_ERROR("Device '%s' has no opened RX queues", device->getDeviceName().c_str());
+		return false;
+	}
+
+	for (uint16_t i = 0; i < device->getNumOfOpenedRxQueues(); i++)
+	{
+		if (!addRxQueue(device, i))
+			return false;
+	}
+
+	return true;
+}
+
+bool DpdkEventScheduler::configureEventDev(uint8_t numOfRxPorts, uint8_t numOfWorkerPorts)
+{
+#ifdef DPDK_EVENTDEV_SUPPORTED
+	if (m_EventDevId >= rte_event_dev_count())
+	{
+		LOG_ERROR("Event device %d doesn't exist. A software event device can be created with the '--vdev=event_sw0' EAL argument", (int)m_EventDevId);
+		return false;
+	}
+
+	struct rte_event_dev_info info;
+	if (rte_event_dev_info_get(m_EventDevId, &info) < 0)
+	{
+		LOG_ERROR("Cannot get the info of event device %d", (int)m_EventDevId);
+		return false;
+	}
+
+	uint8_t numOfPorts = numOfRxPorts + numOfWorkerPorts;
+	if (numOfPorts > info.max_event_ports)
+	{
+		LOG_ERROR("Event device %d supports %d ports, but %d RX cores and %d workers were requested",
+				(int)m_EventDevId, (int)info.max_event_ports, (int)numOfRxPorts, (int)numOfWorkerPorts);
+		return false;
+	}
+
+	struct rte_event_dev_config config;
+	memset(&config, 0, sizeof(config));
+	config.dequeue_timeout_ns = info.min_dequeue_timeout_ns;
+	config.nb_events_limit = (info.max_num_events > 0 ? info.max_num_events : 4096);
+	config.nb_event_queues = 1;
+	config.nb_event_ports = numOfPorts;
+	config.nb_event_queue_flows = (info.max_event_queue_flows < EVENT_QUEUE_NUM_OF_FLOWS ? info.max_event_queue_flows : EVENT_QUEUE_NUM_OF_FLOWS);
+	config.nb_event_port_dequeue_depth = info.max_event_port_dequeue_depth;
+	config.nb_event_port_enqueue_depth = info.max_event_port_enqueue_depth;
+
+	int ret = rte_event_dev_configure(m_EventDevId, &config);
+	if (ret < 0)
+	{
+		LOG_ERROR("Cannot configure event device %d, error %d", (int)m_EventDevId, ret);
+		return false;
+	}
+
+	struct rte_event_queue_conf queueConf;
+	rte_event_queue_default_conf_get(m_EventDevId, 0, &queueConf);
+	queueConf.schedule_type = RTE_SCHED_TYPE_ATOMIC;
+	queueConf.nb_atomic_flows = config.nb_event_queue_flows;
+	queueConf.priority = RTE_EVENT_DEV_PRIORITY_NORMAL;
+	ret = rte_event_queue_setup(m_EventDevId, 0, &queueConf);
+	if (ret < 0)
+	{
+		LOG_ERROR("Cannot set up the queue of event device %d, error %d", (int)m_EventDevId, ret);
+		return false;
+	}
+
+	for (uint8_t port = 0; port < numOfPorts; port++)
+	{
+		struct rte_event_port_conf portConf;
+		rte_event_port_default_conf_get(m_EventDevId, port, &portConf);
+		ret = rte_event_port_setup(m_EventDevId, port, &portConf);
+		if (ret < 0)
+		{
+			LOG_ERROR("Cannot set up port %d of event device %d, error %d", (int)port, (int)m_EventDevId, ret);
+			return false;
+		}
+
+		// the RX ports only enqueue, so only the worker ports are linked to the queue
+		if (port < numOfRxPorts)
+			continue;
+
+		uint8_t queueId = 0;
+		if (rte_event_port_link(m_EventDevId, port, &queueId, NULL, 1) != 1)
+		{
+			LOG_ERROR("Cannot link port %d of event device %d to its queue", (int)port, (int)m_EventDevId);
+			return false;
+		}
+	}
+
+	rte_event_dev_stop_flush_callback_register(m_EventDevId, flushEvent, NULL);
+
+	m_ServiceId = NoServiceId;
+	uint32_t serviceId;
+	if (rte_event_dev_service_id_get(m_EventDevId, &serviceId) == 0)
+	{
+		// let the RX cores run the scheduling service even though it isn't mapped to a service core
+		rte_service_runstate_set(serviceId, 1);
+		rte_service_set_runstate_mapped_check(serviceId, 0);
+		m_ServiceId = serviceId;
+	}
+
+	ret = rte_event_dev_start(m_EventDevId);
+	if (ret < 0)
+	{
+		LOG_ERROR("Cannot start event device %d, error %d", (int)m_EventDevId, ret);
+		return false;
+	}
+
+	m_EventDevStarted = true;
+	return true;
+#else
+	LOG_ERROR("Event devices require DPDK 18.11 or later");
+	return false;
+#endif
+}
+
+void DpdkEventScheduler::stopEventDev()
+{
+#ifdef DPDK_EVENTDEV_SUPPORTED
+	if (m_EventDevStarted)
+		rte_event_dev_stop(m_EventDevId);
+#endif
+	m_EventDevStarted = false;
+}
+
+void DpdkEventScheduler::deleteThreads()
+{
+	for (std::vector<DpdkEventRxThread*>::iterator iter = m_RxThreads.begin(); iter != m_RxThreads.end(); ++iter)
+		delete *iter;
+	for (std::vector<DpdkEventWorkerThread*>::iterator iter = m_WorkerThreads.begin(); iter != m_WorkerThreads.end(); ++iter)
+		delete *iter;
+
+	m_RxThreads.clear();
+	m_WorkerThreads.clear();
+}
+
+bool DpdkEventScheduler::start(CoreMask rxCoreMask, CoreMask workerCoreMask, OnDpdkEventPacketsCallback onPacketsArrive, void* userCookie)
+{
+	if (m_Running)
+	{
+		LOG_ERROR("Scheduler is already running");
+		return false;
+	}
+
+	if (onPacketsArrive == NULL)
+	{
+		LOG_ERROR("Worker callback is NULL");
+		return false;
+	}
+
+	if (m_RxQueues.empty())
+	{
+		LOG_ERROR("No RX queues were added");
+		return false;
+	}
+
+	if ((rxCoreMask & workerCoreMask) != 0)
+	{
+		LOG_ERROR("RX core mask and worker core mask overlap");
+		return false;
+	}
+
+	size_t numOfRxCores = 0;
+	size_t numOfWorkerCores = 0;
+	for (int coreId = 0; coreId < MAX_NUM_OF_CORES; coreId++)
+	{
+		if (rxCoreMask & SystemCores::IdToSystemCore[coreId].Mask)
+			numOfRxCores++;
+		if (workerCoreMask & SystemCores::IdToSystemCore[coreId].Mask)
+			numOfWorkerCores++;
+	}
+
+	if (numOfRxCores == 0 || numOfWorkerCores == 0)
+	{
+		LOG_ERROR("At least one RX core and one worker core are needed");
+		return false;
+	}
+
+	if (numOfRxCores > m_RxQueues.size())
+	{
+		LOG_ERROR("There are %d RX cores but only %d RX queues", (int)numOfRxCores, (int)m_RxQueues.size());
+		return false;
+	}
+
+	deleteThreads();
+	m_OnPacketsArrive = onPacketsArrive;
+	m_UserCookie = userCookie;
+
+	if (!configureEventDev((uint8_t)numOfRxCores, (uint8_t)numOfWorkerCores))
+	{
+		stopEventDev();
+		return false;
+	}
+
+	// RX cores use the first event ports and workers the rest
+	for (size_t i = 0; i < numOfRxCores; i++)
+		m_RxThreads.push_back(new DpdkEventRxThread(this, (uint8_t)i));
+	for (size_t i = 0; i < numOfWorkerCores; i++)
+		m_WorkerThreads.push_back(new DpdkEventWorkerThread(this, (uint8_t)(numOfRxCores + i), (uint8_t)i));
+
+	for (size_t i = 0; i < m_RxQueues.size(); i++)
+		m_RxThreads[i % numOfRxCores]->m_RxQueues.push_back(m_RxQueues[i]);
+
+	// DpdkDeviceList starts the threads on the cores of the mask in ascending order, so order them by their cores
+	std::vector<DpdkWorkerThread*> workerThreads;
+	size_t rxIndex = 0;
+	size_t workerIndex = 0;
+	for (int coreId = 0; coreId < MAX_NUM_OF_CORES; coreId++)
+	{
+		if (rxCoreMask & SystemCores::IdToSystemCore[coreId].Mask)
+			workerThreads.push_back(m_RxThreads[rxIndex++]);
+		else if (workerCoreMask & SystemCores::IdToSystemCore[coreId].Mask)
+			workerThreads.push_back(m_WorkerThreads[workerIndex++]);
+	}
+
+	if (!DpdkDeviceList::getInstance().startDpdkWorkerThreads(rxCoreMask | workerCoreMask, workerThreads))
+	{
+		stopEventDev();
+		deleteThreads();
+		return false;
+	}
+
+	LOG_DEBUG("Scheduler started with %d RX cores and %d workers on event device %d", (int)numOfRxCores, (int)numOfWorkerCores, (int)m_EventDevId);
+	m_Running = true;
+	return true;
+}
+
+void DpdkEventScheduler::stop()
+{
+	if (!m_Running)
+		return;
+
+	// stop the RX cores first, so no packets are injected after the workers stopped taking them
+	for (std::vector<DpdkEventRxThread*>::iterator iter = m_RxThreads.begin(); iter != m_RxThreads.end(); ++iter)
+	{
+		(*iter)->stop();
+		rte_eal_wait_lcore((*iter)->getCoreId());
+	}
+
+	for (std::vector<DpdkEventWorkerThread*>::iterator iter = m_WorkerThreads.begin(); iter != m_WorkerThreads.end(); ++iter)
+	{
+		(*iter)->stop();
+		rte_eal_wait_lcore((*iter)->getCoreId());
+	}
+
+	// packets still in the event device are freed by flushEvent()
+	stopEventDev();
+	m_Running = false;
+	LOG_DEBUG("Scheduler stopped");
+}
+
+void DpdkEventScheduler::getStats(DpdkEventSchedulerStats& stats) const
+{
+	memset(&stats, 0, sizeof(stats));
+	for (std::vector<DpdkEventRxThread*>::const_iterator iter = m_RxThreads.begin(); iter != m_RxThreads.end(); ++iter)
+	{
+		stats.rxPackets += (*iter)->m_RxPackets;
+		stats.rxDrops += (*iter)->m_RxDrops;
+	}
+
+	for (std::vector<DpdkEventWorkerThread*>::const_iterator iter = m_WorkerThreads.begin(); iter != m_WorkerThreads.end(); ++iter)
+	{
+		stats.workerPackets += (*iter)->m_Packets;
+		stats.workerBursts += (*iter)->m_Bursts;
+	}
+}
+
+uint64_t DpdkEventScheduler::getWorkerPackets(uint8_t workerId) const
+{
+	if (workerId >= m_WorkerThreads.size())
+		return 0;
+
+	return m_WorkerThreads[workerId]->m_Packets;
+}
+
+} // namespace pcpp
+
+#endif /* USE_DPDK */
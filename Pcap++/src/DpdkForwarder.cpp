@@ -0,0 +1,275 @@
+#ifdef USE_DPDK
+
+#define LOG_MODULE PcapLogModuleDpdkForwarder
+
+#include "DpdkForwarder.h"
+#include "DpdkDevice.h"
+#include "KniDevice.h"
+#include "Logger.h"
+#include "rte_config.h"
+#include "rte_mbuf.h"
+#include "rte_ethdev.h"
+#include "rte_kni.h"
+#include "rte_branch_prediction.h"
+#include <string.h>
+
+// the offset of the EtherType (or the TPID of the first VLAN tag) in an Ethernet header
+#define ETHER_TYPE_OFFSET 12
+#define VLAN_TAG_LEN 4
+#define ETHER_TYPE_VLAN 0x8100
+#define ETHER_TYPE_QINQ 0x88a8
+
+namespace pcpp
+{
+
+DpdkForwarder::DpdkForwarder(DpdkDevice* rxDevice, uint16_t rxQueueId, DpdkDevice* txDevice, uint16_t txQueueId)
+{
+	init(rxDevice, NULL, rxQueueId, txDevice, NULL, txQueueId);
+}
+
+DpdkForwarder::DpdkForwarder(DpdkDevice* rxDevice, uint16_t rxQueueId, KniDevice* txDevice)
+{
+	init(rxDevice, NULL, rxQueueId, NULL, txDevice, 0);
+}
+
+DpdkForwarder::DpdkForwarder(KniDevice* rxDevice, DpdkDevice* txDevice, uint16_t txQueueId)
+{
+	init(NULL, rxDevice, 0, txDevice, NULL, txQueueId);
+}
+
+DpdkForwarder::DpdkForwarder(KniDevice* rxDevice, KniDevice* txDevice)
+{
+	init(NULL, rxDevice, 0, NULL, txDevice, 0);
+}
+
+void DpdkForwarder::init(DpdkDevice* rxDpdkDevice, KniDevice* rxKniDevice, uint16_t rxQueueId, DpdkDevice* txDpdkDevice, KniDevice* txKniDevice,
+		uint16_t txQueueId)
+{
+	m_RxDpdkDevice = rxDpdkDevice;
+	m_RxKniDevice = rxKniDevice;
+	m_RxQueueId = rxQueueId;
+	m_TxDpdkDevice = txDpdkDevice;
+	m_TxKniDevice = txKniDevice;
+	m_TxQueueId = txQueueId;
+	m_RewriteFlags = DpdkForwardRewriteNone;
+	m_VlanTci = 0;
+	m_OnForwardPacket = NULL;
+	m_OnForwardPacketUserCookie = NULL;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+void DpdkForwarder::setRewrite(uint32_t rewriteFlags, uint16_t vlanTci)
+{
+	m_RewriteFlags = rewriteFlags;
+	m_VlanTci = vlanTci;
+}
+
+void DpdkForwarder::setForwardCallback(OnDpdkForwardPacketCallback onForwardPacket, void* onForwardPacketUserCookie)
+{
+	m_OnForwardPacket = onForwardPacket;
+	m_OnForwardPacketUserCookie = onForwardPacketUserCookie;
+}
+
+void DpdkForwarder::clearStats()
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+bool DpdkForwarder::verifyDevices()
+{
+	if (m_RxDpdkDevice == NULL && m_RxKniDevice == NULL)
+	{
+		LOG_ERROR("RX device is NULL");
+		return false;
+	}
+
+	if (m_TxDpdkDevice == NULL && m_TxKniDevice == NULL)
+	{
+		LOG_ERROR("TX device is NULL");
+		return false;
+	}
+
+	if (m_RxDpdkDevice != NULL)
+	{
+		if (!m_RxDpdkDevice->m_DeviceOpened)
+		{
+			LOG_ERROR("Device '%s' not opened!", m_RxDpdkDevice->m_DeviceName);
+			return false;
+		}
+
+		if (!m_RxDpdkDevice->m_StopThread)
+		{
+			LOG_ERROR("DpdkDevice capture mode is currently running. Cannot forward packets in parallel");
+			return false;
+		}
+
+		if (m_RxQueueId >= m_RxDpdkDevice->m_NumOfRxQueuesOpened)
+		{
+			LOG_ERROR("RX queue %d isn't opened in device", m_RxQueueId);
+			return false;
+		}
+	}
+	else if (!m_RxKniDevice->m_DeviceOpened)
+	{
+		LOG_ERROR("KNI device \"%s\" is not opened", m_RxKniDevice->m_DeviceInfo.name.c_str());
+		return false;
+	}
+
+	if (m_TxDpdkDevice != NULL)
+	{
+		if (!m_TxDpdkDevice->m_DeviceOpened)
+		{
+			LOG_ERROR("Device '%s' not opened!", m_TxDpdkDevice->m_DeviceName);
+			return false;
+		}
+
+		if (m_TxQueueId >= m_TxDpdkDevice->m_NumOfTxQueuesOpened)
+		{
+			LOG_ERROR("TX queue %d isn't opened in device", m_TxQueueId);
+			return false;
+		}
+	}
+	else if (!m_TxKniDevice->m_DeviceOpened)
+	{
+		LOG_ERROR("KNI device \"%s\" is not opened", m_TxKniDevice->m_DeviceInfo.name.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+uint16_t DpdkForwarder::receive()
+{
+	// the DPDK device path goes through receiveBurst() so the software filter and burst statistics of the device still apply
+	if (m_RxDpdkDevice != NULL)
+		return m_RxDpdkDevice->receiveBurst(m_RxQueueId, m_MBufArray, PCPP_DPDK_FORWARDER_BURST_SIZE);
+
+	return (uint16_t)rte_kni_rx_burst(m_RxKniDevice->m_Device, m_MBufArray, PCPP_DPDK_FORWARDER_BURST_SIZE);
+}
+
+uint16_t DpdkForwarder::send(uint16_t numOfPackets)
+{
+	if (m_TxDpdkDevice != NULL)
+		return rte_eth_tx_burst(m_TxDpdkDevice->m_Id, m_TxQueueId, m_MBufArray, numOfPackets);
+
+	return (uint16_t)rte_kni_tx_burst(m_TxKniDevice->m_Device, m_MBufArray, numOfPackets);
+}
+
+bool DpdkForwarder::rewrite(struct rte_mbuf* mBuf)
+{
+	if (m_RewriteFlags & DpdkForwardRewritePopVlan)
+	{
+		uint8_t* data = rte_pktmbuf_mtod(mBuf, uint8_t*);
+		if (rte_pktmbuf_data_len(mBuf) >= ETHER_TYPE_OFFSET + VLAN_TAG_LEN + 2)
+		{
+			uint16_t tpid = (uint16_t)((data[ETHER_TYPE_OFFSET] << 8) | data[ETHER_TYPE_OFFSET + 1]);
+			if (tpid == ETHER_TYPE_VLAN || tpid == ETHER_TYPE_QINQ)
+			{
+				// move the MAC addresses over the tag and return its space to the headroom
+				memmove(data + VLAN_TAG_LEN, data, ETHER_TYPE_OFFSET);
+				rte_pktmbuf_adj(mBuf, VLAN_TAG_LEN);
+			}
+		}
+	}
+
+	if (m_RewriteFlags & DpdkForwardRewritePushVlan)
+	{
+		if (rte_pktmbuf_data_len(mBuf) < ETHER_TYPE_OFFSET)
+			return false;
+
+		uint8_t* data = (uint8_t*)rte_pktmbuf_prepend(mBuf, VLAN_TAG_LEN);
+		if (data == NULL)
+			return false;
+
+		memmove(data, data + VLAN_TAG_LEN, ETHER_TYPE_OFFSET);
+		data[ETHER_TYPE_OFFSET] = (uint8_t)(ETHER_TYPE_VLAN >> 8);
+		data[ETHER_TYPE_OFFSET + 1] = (uint8_t)(ETHER_TYPE_VLAN & 0xff);
+		data[ETHER_TYPE_OFFSET + 2] = (uint8_t)(m_VlanTci >> 8);
+		data[ETHER_TYPE_OFFSET + 3] = (uint8_t)(m_VlanTci & 0xff);
+	}
+
+	if (m_RewriteFlags & DpdkForwardRewriteSwapMac)
+	{
+		if (rte_pktmbuf_data_len(mBuf) < ETHER_TYPE_OFFSET)
+			return false;
+
+		uint8_t* data = rte_pktmbuf_mtod(mBuf, uint8_t*);
+		uint8_t tmpMac[6];
+		memcpy(tmpMac, data, 6);
+		memcpy(data, data + 6, 6);
+		memcpy(data + 6, tmpMac, 6);
+	}
+
+	return true;
+}
+
+bool DpdkForwarder::callForwardCallback(struct rte_mbuf* mBuf)
+{
+	timespec timestamp;
+	timestamp.tv_sec = 0;
+	timestamp.tv_nsec = 0;
+
+	// the packet object only borrows the mbuf, which stays owned by the forwarder
+	m_CallbackPacket.setMBuf(mBuf, timestamp);
+	m_CallbackPacket.setFreeMbuf(false);
+	bool sendPacket = m_OnForwardPacket(m_CallbackPacket, m_OnForwardPacketUserCookie);
+	m_CallbackPacket.setFreeMbuf(false);
+	m_CallbackPacket.releaseMBuf();
+
+	return sendPacket;
+}
+
+uint16_t DpdkForwarder::forwardBurst()
+{
+	if (unlikely(!verifyDevices()))
+		return 0;
+
+	uint16_t numOfPacketsReceived = receive();
+	if (numOfPacketsReceived == 0)
+		return 0;
+
+	m_Stats.rxPackets += numOfPacketsReceived;
+
+	uint16_t numOfPacketsToSend = numOfPacketsReceived;
+	if (m_RewriteFlags != DpdkForwardRewriteNone || m_OnForwardPacket != NULL)
+	{
+		// dropped packets are freed, and the rest are moved to the beginning of the array
+		numOfPacketsToSend = 0;
+		for (uint16_t i = 0; i < numOfPacketsReceived; i++)
+		{
+			struct rte_mbuf* mBuf = m_MBufArray[i];
+			if (unlikely(!rewrite(mBuf)))
+			{
+				m_Stats.rewriteDrops++;
+				rte_pktmbuf_free(mBuf);
+				continue;
+			}
+
+			if (m_OnForwardPacket != NULL && !callForwardCallback(mBuf))
+			{
+				m_Stats.callbackDrops++;
+				rte_pktmbuf_free(mBuf);
+				continue;
+			}
+
+			m_MBufArray[numOfPacketsToSend++] = mBuf;
+		}
+	}
+
+	uint16_t numOfPacketsSent = 0;
+	if (numOfPacketsToSend > 0)
+		numOfPacketsSent = send(numOfPacketsToSend);
+
+	// packets the TX queue had no room for are dropped
+	for (uint16_t i = numOfPacketsSent; i < numOfPacketsToSend; i++)
+		rte_pktmbuf_free(m_MBufArray[i]);
+
+	m_Stats.txPackets += numOfPacketsSent;
+	m_Stats.txDrops += numOfPacketsToSend - numOfPacketsSent;
+
+	return numOfPacketsReceived;
+}
+
+} // namespace pcpp
+
+#endif /* USE_DPDK */
@@ -0,0 +1,178 @@
+#ifdef USE_DPDK
+
+#define LOG_MODULE PcapLogModuleDpdkL2Switch
+
+#include "DpdkL2Switch.h"
+#include "DpdkDevice.h"
+#include "TimestampClock.h"
+#include "Logger.h"
+#include "rte_config.h"
+#include "rte_mbuf.h"
+#include "rte_ethdev.h"
+#include "rte_branch_prediction.h"
+#include <string.h>
+
+namespace pcpp
+{
+
+DpdkL2Switch::DpdkL2Switch(MacLearningTable* table, const std::vector<DpdkDevice*>& ports, uint16_t txQueueId) :
+	m_Table(table), m_Ports(ports), m_TxQueueId(txQueueId),
+	m_TxArrays(ports.size() * PCPP_DPDK_L2_SWITCH_BURST_SIZE), m_TxCounts(ports.size(), 0)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+void DpdkL2Switch::clearStats()
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+bool DpdkL2Switch::verifyDevices(uint16_t inPort, uint16_t rxQueueId)
+{
+	if (m_Table == NULL)
+	{
+		LOG_ERROR("MAC learning table is NULL");
+		return false;
+	}
+
+	if (inPort >= m_Ports.size() || m_Ports.size() > MacLearningTable::MaxPort)
+	{
+		LOG_ERROR("Port %d doesn't exist", inPort);
+		return false;
+	}
+
+	for (size_t i = 0; i < m_Ports.size(); i++)
+	{
+		DpdkDevice* device = m_Ports[i];
+		if (device == NULL)
+		{
+			LOG_ERROR("Device of port %d is NULL", (int)i);
+			return false;
+		}
+
+		if (!device->m_DeviceOpened)
+		{
+			LOG_ERROR("Device '%s' not opened!", device->m_DeviceName);
+			return false;
+		}
+
+		if (m_TxQueueId >= device->m_NumOfTxQueuesOpened)
+		{
+			LOG_ERROR("TX queue %d isn't opened in device '%s'", m_TxQueueId, device->m_DeviceName);
+			return false;
+		}
+	}
+
+	DpdkDevice* rxDevice = m_Ports[inPort];
+	if (!rxDevice->m_StopThread)
+	{
+		LOG_ERROR("DpdkDevice capture mode is currently running. Cannot switch packets in parallel");
+		return false;
+	}
+
+	if (rxQueueId >= rxDevice->m_NumOfRxQueuesOpened)
+	{
+		LOG_ERROR("RX queue %d isn't opened in device '%s'", rxQueueId, rxDevice->m_DeviceName);
+		return false;
+	}
+
+	return true;
+}
+
+void DpdkL2Switch::addToPort(uint16_t port, struct rte_mbuf* mBuf)
+{
+	m_TxArrays[port * PCPP_DPDK_L2_SWITCH_BURST_SIZE + m_TxCounts[port]] = mBuf;
+	m_TxCounts[port]++;
+}
+
+void DpdkL2Switch::flood(uint16_t inPort, struct rte_mbuf* mBuf)
+{
+	uint16_t numOfTargets = (uint16_t)(m_Ports.size() - 1);
+	if (numOfTargets == 0)
+	{
+		rte_pktmbuf_free(mBuf);
+		return;
+	}
+
+	// every port gets a reference to the same mbuf, each of them frees one when the packet was sent or dropped
+	if (numOfTargets > 1)
+	{
+		for (struct rte_mbuf* segment = mBuf; segment != NULL; segment = segment->next)
+			rte_mbuf_refcnt_update(segment, (int16_t)(numOfTargets - 1));
+	}
+
+	for (uint16_t port = 0; port < m_Ports.size(); port++)
+	{
+		if (port != inPort)
+			addToPort(port, mBuf);
+	}
+}
+
+uint16_t DpdkL2Switch::switchBurst(uint16_t inPort, uint16_t rxQueueId)
+{
+	if (unlikely(!verifyDevices(inPort, rxQueueId)))
+		return 0;
+
+	// receiveBurst() keeps the software filter and burst statistics of the device
+	uint16_t numOfPacketsReceived = m_Ports[inPort]->receiveBurst(rxQueueId, m_MBufArray, PCPP_DPDK_L2_SWITCH_BURST_SIZE);
+	if (numOfPacketsReceived == 0)
+		return 0;
+
+	m_Stats.rxPackets += numOfPacketsReceived;
+
+	const uint8_t* frames[PCPP_DPDK_L2_SWITCH_BURST_SIZE];
+	uint16_t frameLengths[PCPP_DPDK_L2_SWITCH_BURST_SIZE];
+	uint16_t outPorts[PCPP_DPDK_L2_SWITCH_BURST_SIZE];
+	for (uint16_t i = 0; i < numOfPacketsReceived; i++)
+	{
+		frames[i] = rte_pktmbuf_mtod(m_MBufArray[i], const uint8_t*);
+		frameLengths[i] = rte_pktmbuf_data_len(m_MBufArray[i]);
+	}
+
+	uint32_t now = (uint32_t)(TimestampClock::nowNs() / 1000000000ULL);
+	m_Table->switchBurst(frames, frameLengths, numOfPacketsReceived, inPort, now, outPorts);
+
+	for (uint16_t i = 0; i < numOfPacketsReceived; i++)
+	{
+		uint16_t outPort = outPorts[i];
+		if (outPort == MacLearningTable::FloodPort)
+		{
+			m_Stats.floodedPackets++;
+			flood(inPort, m_MBufArray[i]);
+		}
+		else if (outPort < m_Ports.size())
+		{
+			m_Stats.unicastPackets++;
+			addToPort(outPort, m_MBufArray[i]);
+		}
+		else
+		{
+			m_Stats.filteredPackets++;
+			rte_pktmbuf_free(m_MBufArray[i]);
+		}
+	}
+
+	for (uint16_t port = 0; port < m_Ports.size(); port++)
+	{
+		uint16_t numOfPacketsToSend = m_TxCounts[port];
+		if (numOfPacketsToSend == 0)
+			continue;
+
+		struct rte_mbuf** txArray = &m_TxArrays[port * PCPP_DPDK_L2_SWITCH_BURST_SIZE];
+		uint16_t numOfPacketsSent = rte_eth_tx_burst(m_Ports[port]->m_Id, m_TxQueueId, txArray, numOfPacketsToSend);
+
+		// packets the TX queue had no room for are dropped
+		for (uint16_t i = numOfPacketsSent; i < numOfPacketsToSend; i++)
+			rte_pktmbuf_free(txArray[i]);
+
+		m_Stats.txPackets += numOfPacketsSent;
+		m_Stats.txDrops += numOfPacketsToSend - numOfPacketsSent;
+		m_TxCounts[port] = 0;
+	}
+
+	return numOfPacketsReceived;
+}
+
+} // namespace pcpp
+
+#endif /* USE_DPDK */
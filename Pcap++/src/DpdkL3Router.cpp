@@ -0,0 +1,179 @@
+#ifdef USE_DPDK
+
+#define LOG_MODULE PcapLogModuleDpdkL3Router
+
+#include "DpdkL3Router.h"
+#include "DpdkDevice.h"
+#include "TimestampClock.h"
+#include "Logger.h"
+#include "rte_config.h"
+#include "rte_mbuf.h"
+#include "rte_ethdev.h"
+#include "rte_branch_prediction.h"
+#include <string.h>
+
+namespace pcpp
+{
+
+DpdkL3Router::DpdkL3Router(L3Forwarder* forwarder, const std::vector<DpdkDevice*>& ports, uint16_t txQueueId) :
+	m_Forwarder(forwarder), m_Ports(ports), m_TxQueueId(txQueueId),
+	m_TxArrays(ports.size() * PCPP_DPDK_L3_ROUTER_BURST_SIZE), m_TxCounts(ports.size(), 0)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+void DpdkL3Router::clearStats()
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+bool DpdkL3Router::verifyDevices(uint16_t inPort, uint16_t rxQueueId)
+{
+	if (m_Forwarder == NULL)
+	{
+		LOG_ERROR("L3 forwarder is NULL");
+		return false;
+	}
+
+	if (inPort >= m_Ports.size() || m_Ports.size() > m_Forwarder->getNumOfPorts())
+	{
+		LOG_ERROR("Port %d doesn't exist or the forwarder has fewer ports than the router", inPort);
+		return false;
+	}
+
+	for (size_t i = 0; i < m_Ports.size(); i++)
+	{
+		DpdkDevice* device = m_Ports[i];
+		if (device == NULL)
+		{
+			LOG_ERROR("Device of port %d is NULL", (int)i);
+			return false;
+		}
+
+		if (!device->m_DeviceOpened)
+		{
+			LOG_ERROR("Device '%s' not opened!", device->m_DeviceName);
+			return false;
+		}
+
+		if (m_TxQueueId >= device->m_NumOfTxQueuesOpened)
+		{
+			LOG_ERROR("TX queue %d isn't opened in device '%s'", m_TxQueueId, device->m_DeviceName);
+			return false;
+		}
+	}
+
+	DpdkDevice* rxDevice = m_Ports[inPort];
+	if (!rxDevice->m_StopThread)
+	{
+		LOG_ERROR("DpdkDevice capture mode is currently running. Cannot route packets in parallel");
+		return false;
+	}
+
+	if (rxQueueId >= rxDevice->m_NumOfRxQueuesOpened)
+	{
+		LOG_ERROR("RX queue %d isn't opened in device '%s'", rxQueueId, rxDevice->m_DeviceName);
+		return false;
+	}
+
+	return true;
+}
+
+void DpdkL3Router::addToPort(uint16_t port, struct rte_mbuf* mBuf)
+{
+	m_TxArrays[port * PCPP_DPDK_L3_ROUTER_BURST_SIZE + m_TxCounts[port]] = mBuf;
+	m_TxCounts[port]++;
+}
+
+void DpdkL3Router::processHostFrame(uint16_t inPort, struct rte_mbuf* mBuf, uint32_t now)
+{
+	m_Stats.hostPackets++;
+
+	uint8_t reply[L3Forwarder::MaxReplyLength];
+	uint16_t replyPort = 0;
+	size_t replyLength = m_Forwarder->processHostFrame(rte_pktmbuf_mtod(mBuf, const uint8_t*), rte_pktmbuf_data_len(mBuf), inPort, now,
+			reply, replyPort);
+
+	// the reply is written over the received frame, which is possible when its mbuf is a single segment which isn't shared
+	if (replyLength == 0 || replyPort >= m_Ports.size() || mBuf->nb_segs != 1 || rte_mbuf_refcnt_read(mBuf) != 1)
+	{
+		rte_pktmbuf_free(mBuf);
+		return;
+	}
+
+	rte_pktmbuf_reset(mBuf);
+	char* data = rte_pktmbuf_append(mBuf, (uint16_t)replyLength);
+	if (data == NULL)
+	{
+		rte_pktmbuf_free(mBuf);
+		return;
+	}
+
+	memcpy(data, reply, replyLength);
+	m_Stats.controlPackets++;
+	addToPort(replyPort, mBuf);
+}
+
+uint16_t DpdkL3Router::routeBurst(uint16_t inPort, uint16_t rxQueueId)
+{
+	if (unlikely(!verifyDevices(inPort, rxQueueId)))
+		return 0;
+
+	// receiveBurst() keeps the software filter and burst statistics of the device
+	uint16_t numOfPacketsReceived = m_Ports[inPort]->receiveBurst(rxQueueId, m_MBufArray, PCPP_DPDK_L3_ROUTER_BURST_SIZE);
+	if (numOfPacketsReceived == 0)
+		return 0;
+
+	m_Stats.rxPackets += numOfPacketsReceived;
+
+	uint8_t* frames[PCPP_DPDK_L3_ROUTER_BURST_SIZE];
+	uint16_t frameLengths[PCPP_DPDK_L3_ROUTER_BURST_SIZE];
+	uint16_t outPorts[PCPP_DPDK_L3_ROUTER_BURST_SIZE];
+	for (uint16_t i = 0; i < numOfPacketsReceived; i++)
+	{
+		frames[i] = rte_pktmbuf_mtod(m_MBufArray[i], uint8_t*);
+		frameLengths[i] = rte_pktmbuf_data_len(m_MBufArray[i]);
+	}
+
+	m_Forwarder->forwardBurst(frames, frameLengths, numOfPacketsReceived, inPort, outPorts, &m_Stats.forwarderStats);
+
+	uint32_t now = 0;
+	for (uint16_t i = 0; i < numOfPacketsReceived; i++)
+	{
+		uint16_t outPort = outPorts[i];
+		if (outPort < m_Ports.size())
+			addToPort(outPort, m_MBufArray[i]);
+		else if (outPort == L3Forwarder::HostPort)
+		{
+			if (now == 0)
+				now = (uint32_t)(TimestampClock::nowNs() / 1000000000ULL);
+			processHostFrame(inPort, m_MBufArray[i], now);
+		}
+		else
+			rte_pktmbuf_free(m_MBufArray[i]);
+	}
+
+	for (uint16_t port = 0; port < m_Ports.size(); port++)
+	{
+		uint16_t numOfPacketsToSend = m_TxCounts[port];
+		if (numOfPacketsToSend == 0)
+			continue;
+
+		struct rte_mbuf** txArray = &m_TxArrays[port * PCPP_DPDK_L3_ROUTER_BURST_SIZE];
+		uint16_t numOfPacketsSent = rte_eth_tx_burst(m_Ports[port]->m_Id, m_TxQueueId, txArray, numOfPacketsToSend);
+
+		// packets the TX queue had no room for are dropped
+		for (uint16_t i = numOfPacketsSent; i < numOfPacketsToSend; i++)
+			rte_pktmbuf_free(txArray[i]);
+
+		m_Stats.txPackets += numOfPacketsSent;
+		m_Stats.txDrops += numOfPacketsToSend - numOfPacketsSent;
+		m_TxCounts[port] = 0;
+	}
+
+	return numOfPacketsReceived;
+}
+
+} // namespace pcpp
+
+#endif /* USE_DPDK */
@@ -0,0 +1,651 @@
+#ifdef USE_DPDK
+
+#define LOG_MODULE PcapLogModuleDpdkPipeline
+
+#include "DpdkPipeline.h"
+#include "Logger.h"
+#include "rte_version.h"
+#include "rte_config.h"
+#include "rte_mbuf.h"
+#include "rte_ring.h"
+#include "rte_launch.h"
+#include "rte_lcore.h"
+#include "rte_cycles.h"
+#include "rte_errno.h"
+#if (RTE_VER_YEAR > 20) || (RTE_VER_YEAR == 20 && RTE_VER_MONTH >= 11)
+// the mbuf user data field was removed in DPDK 20.11, the timestamp is kept in a dynamic field instead
+#define DPDK_MBUF_DYNFIELD_TIMESTAMP
+#include "rte_mbuf_dyn.h"
+#endif
+#include <string.h>
+
+// the enqueue and dequeue functions have an extra out parameter since DPDK 17.05
+#if (RTE_VER_YEAR > 17) || (RTE_VER_YEAR == 17 && RTE_VER_MONTH >= 5)
+#define RING_ENQUEUE_BURST(ring, objs, count) rte_ring_enqueue_burst(ring, objs, count, NULL)
+#define RING_DEQUEUE_BURST(ring, objs, count) rte_ring_dequeue_burst(ring, objs, count, NULL)
+#else
+#define RING_ENQUEUE_BURST(ring, objs, count) rte_ring_enqueue_burst(ring, objs, count)
+#define RING_DEQUEUE_BURST(ring, objs, count) rte_ring_dequeue_burst(ring, objs, count)
+#endif
+
+// the maximum number of packets a stage and a ring handle at once
+#define MAX_PIPELINE_BURST_SIZE 256
+
+namespace pcpp
+{
+
+#ifdef DPDK_MBUF_DYNFIELD_TIMESTAMP
+static int timestampDynfieldOffset = -1;
+#endif
+
+static bool registerTimestampField()
+{
+#ifdef DPDK_MBUF_DYNFIELD_TIMESTAMP
+	if (timestampDynfieldOffset >= 0)
+		return true;
+
+	static const struct rte_mbuf_dynfield timestampDynfieldDesc = { "pcpp_dynfield_pipeline_timestamp", sizeof(uint64_t), __alignof__(uint64_t), 0 };
+	timestampDynfieldOffset = rte_mbuf_dynfield_register(&timestampDynfieldDesc);
+	if (timestampDynfieldOffset < 0)
+	{
+		LOG_ERROR("Couldn't register an mbuf field for the packet timestamp");
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+static inline void setMBufTimestamp(struct rte_mbuf* mBuf, const timespec& timestamp)
+{
+	uint64_t timestampNs = (uint64_t)timestamp.tv_sec * 1000000000ULL + (uint64_t)timestamp.tv_nsec;
+#ifdef DPDK_MBUF_DYNFIELD_TIMESTAMP
+	*RTE_MBUF_DYNFIELD(mBuf, timestampDynfieldOffset, uint64_t*) = timestampNs;
+#else
+	mBuf->udata64 = timestampNs;
+#endif
+}
+
+static inline timespec getMBufTimestamp(struct rte_mbuf* mBuf)
+{
+#ifdef DPDK_MBUF_DYNFIELD_TIMESTAMP
+	uint64_t timestampNs = *RTE_MBUF_DYNFIELD(mBuf, timestampDynfieldOffset, uint64_t*);
+#else
+	uint64_t timestampNs = mBuf->udata64;
+#endif
+	timespec timestamp;
+	timestamp.tv_sec = (time_t)(timestampNs / 1000000000ULL);
+	timestamp.tv_nsec = (long)(timestampNs % 1000000000ULL);
+	return timestamp;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DpdkPacketRing class
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+DpdkPacketRing::DpdkPacketRing(const std::string& name, uint32_t size, bool multiProducer, bool multiConsumer, int socketId)
+{
+	m_Name = name;
+	m_Ring = NULL;
+	m_Capacity = 0;
+	m_IsOwner = true;
+
+	if (size == 0)
+	{
+		LOG_ERROR("Cannot create ring '%s' with size 0", name.c_str());
+		return;
+	}
+
+	if (!registerTimestampField())
+		return;
+
+	// an rte_ring of size N holds up to N-1 objects
+	uint32_t ringSize = rte_align32pow2(size + 1);
+	unsigned int flags = (multiProducer ? 0 : RING_F_SP_ENQ) | (multiConsumer ? 0 : RING_F_SC_DEQ);
+	m_Ring = rte_ring_create(name.c_str(), ringSize, (socketId < 0 ? SOCKET_ID_ANY : socketId), flags);
+	if (m_Ring == NULL)
+	{
+		LOG_ERROR("Couldn't create ring '%s' of size %d, error was: %s", name.c_str(), (int)ringSize, rte_strerror(rte_errno));
+		return;
+	}
+
+	m_Capacity = ringSize - 1;
+	LOG_DEBUG("Ring '%s' created with a capacity of %d packets", name.c_str(), (int)m_Capacity);
+}
+
+DpdkPacketRing::DpdkPacketRing(const std::string& name)
+{
+	m_Name = name;
+	m_Ring = NULL;
+	m_Capacity = 0;
+	m_IsOwner = false;
+
+	// the field is registered by name, so all processes get the same offset
+	if (!registerTimestampField())
+		return;
+
+	m_Ring = rte_ring_lookup(name.c_str());
+	if (m_Ring == NULL)
+	{
+		LOG_ERROR("Couldn't find ring '%s', error was: %s", name.c_str(), rte_strerror(rte_errno));
+		return;
+	}
+
+#if (RTE_VER_YEAR > 17) || (RTE_VER_YEAR == 17 && RTE_VER_MONTH >= 5)
+	m_Capacity = rte_ring_get_capacity(m_Ring);
+#else
+	m_Capacity = m_Ring->prod.mask;
+#endif
+	LOG_DEBUG("Attached to ring '%s' with a capacity of %d packets", name.c_str(), (int)m_Capacity);
+}
+
+DpdkPacketRing::~DpdkPacketRing()
+{
+	if (m_Ring == NULL || !m_IsOwner)
+		return;
+
+	void* mBufs[MAX_PIPELINE_BURST_SIZE];
+	uint32_t numOfMBufs = 0;
+	while ((numOfMBufs = RING_DEQUEUE_BURST(m_Ring, mBufs, MAX_PIPELINE_BURST_SIZE)) > 0)
+	{
+		for (uint32_t i = 0; i < numOfMBufs; i++)
+			rte_pktmbuf_free((struct rte_mbuf*)mBufs[i]);
+	}
+
+	rte_ring_free(m_Ring);
+}
+
+uint32_t DpdkPacketRing::enqueueBurst(MBufRawPacket** packets, uint32_t count)
+{
+	if (unlikely(m_Ring == NULL))
+	{
+		LOG_ERROR("Ring '%s' wasn't created", m_Name.c_str());
+		return 0;
+	}
+
+	uint32_t numOfEnqueued = 0;
+	while (numOfEnqueued < count)
+	{
+		void* mBufs[MAX_PIPELINE_BURST_SIZE];
+		uint32_t batchSize = (count - numOfEnqueued < MAX_PIPELINE_BURST_SIZE ? count - numOfEnqueued : MAX_PIPELINE_BURST_SIZE);
+		for (uint32_t i = 0; i < batchSize; i++)
+		{
+			MBufRawPacket* packet = packets[numOfEnqueued + i];
+			setMBufTimestamp(packet->m_MBuf, packet->m_TimeStamp);
+			mBufs[i] = packet->m_MBuf;
+		}
+
+		uint32_t enqueued = RING_ENQUEUE_BURST(m_Ring, mBufs, batchSize);
+
+		// the ring owns the enqueued mbufs now
+		for (uint32_t i = 0; i < enqueued; i++)
+		{
+			MBufRawPacket* packet = packets[numOfEnqueued + i];
+			packet->m_MBuf = NULL;
+			packet->m_FreeMbuf = true;
+		}
+
+		numOfEnqueued += enqueued;
+		if (enqueued < batchSize)
+			break;
+	}
+
+	return numOfEnqueued;
+}
+
+uint32_t DpdkPacketRing::dequeueBurst(MBufRawPacket** packets, uint32_t maxCount)
+{
+	if (unlikely(m_Ring == NULL))
+	{
+		LOG_ERROR("Ring '%s' wasn't created", m_Name.c_str());
+		return 0;
+	}
+
+	uint32_t numOfDequeued = 0;
+	while (numOfDequeued < maxCount)
+	{
+		void* mBufs[MAX_PIPELINE_BURST_SIZE];
+		uint32_t batchSize = (maxCount - numOfDequeued < MAX_PIPELINE_BURST_SIZE ? maxCount - numOfDequeued : MAX_PIPELINE_BURST_SIZE);
+		uint32_t dequeued = RING_DEQUEUE_BURST(m_Ring, mBufs, batchSize);
+		for (uint32_t i = 0; i < dequeued; i++)
+		{
+			struct rte_mbuf* mBuf = (struct rte_mbuf*)mBufs[i];
+			MBufRawPacket*& packet = packets[numOfDequeued + i];
+			if (packet == NULL)
+				packet = new MBufRawPacket();
+
+			packet->setMBuf(mBuf, getMBufTimestamp(mBuf));
+		}
+
+		numOfDequeued += dequeued;
+		if (dequeued < batchSize)
+			break;
+	}
+
+	return numOfDequeued;
+}
+
+uint32_t DpdkPacketRing::getCount() const
+{
+	if (m_Ring == NULL)
+		return 0;
+
+	return rte_ring_count(m_Ring);
+}
+
+uint32_t DpdkPacketRing::getFreeCount() const
+{
+	if (m_Ring == NULL)
+		return 0;
+
+	return rte_ring_free_count(m_Ring);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DpdkPipelineStage class
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+struct DpdkPipelineStage::StageOutput
+{
+	DpdkPacketRing* ring;
+	BackPressurePolicy policy;
+	DpdkDevice* device;
+	uint16_t txQueueId;
+	// the packets forwarded in the current burst, which are bound to the mbufs handed to forward()
+	std::vector<MBufRawPacket*> packets;
+	uint32_t numOfPackets;
+};
+
+DpdkPipelineStage::DpdkPipelineStage(const std::string& name, uint32_t burstSize)
+{
+	m_Name = name;
+	m_BurstSize = burstSize;
+	if (m_BurstSize == 0)
+		m_BurstSize = PCPP_DPDK_PIPELINE_DEFAULT_BURST_SIZE;
+	if (m_BurstSize > MAX_PIPELINE_BURST_SIZE)
+		m_BurstSize = MAX_PIPELINE_BURST_SIZE;
+
+	m_CoreId = MAX_NUM_OF_CORES + 1;
+	m_Stop = true;
+	m_Running = false;
+	m_InputDevice = NULL;
+	m_RxQueueId = 0;
+	m_InputRing = NULL;
+	m_InputPackets.resize(m_BurstSize, NULL);
+	clearStats();
+}
+
+DpdkPipelineStage::~DpdkPipelineStage()
+{
+	for (std::vector<MBufRawPacket*>::iterator iter = m_InputPackets.begin(); iter != m_InputPackets.end(); ++iter)
+		delete *iter;
+
+	for (std::vector<StageOutput*>::iterator iter = m_Outputs.begin(); iter != m_Outputs.end(); ++iter)
+	{
+		for (std::vector<MBufRawPacket*>::iterator packetIter = (*iter)->packets.begin(); packetIter != (*iter)->packets.end(); ++packetIter)
+			delete *packetIter;
+		delete *iter;
+	}
+}
+
+bool DpdkPipelineStage::setInput(DpdkDevice* device, uint16_t rxQueueId)
+{
+	if (device == NULL)
+	{
+		LOG_ERROR("Stage '%s': input device is NULL", m_Name.c_str());
+		return false;
+	}
+
+	if (m_Running)
+	{
+		LOG_ERROR("Stage '%s': cannot set the input while the stage is running", m_Name.c_str());
+		return false;
+	}
+
+	m_InputDevice = device;
+	m_RxQueueId = rxQueueId;
+	m_InputRing = NULL;
+	return true;
+}
+
+bool DpdkPipelineStage::setInput(DpdkPacketRing* ring)
+{
+	if (ring == NULL || !ring->isValid())
+	{
+		LOG_ERROR("Stage '%s': input ring is NULL or wasn't created", m_Name.c_str());
+		return false;
+	}
+
+	if (m_Running)
+	{
+		LOG_ERROR("Stage '%s': cannot set the input while the stage is running", m_Name.c_str());
+		return false;
+	}
+
+	m_InputRing = ring;
+	m_InputDevice = NULL;
+	return true;
+}
+
+int DpdkPipelineStage::addOutput(DpdkPacketRing* ring, BackPressurePolicy policy)
+{
+	if (ring == NULL || !ring->isValid())
+	{
+		LOG_ERROR("Stage '%s': output ring is NULL or wasn't created", m_Name.c_str());
+		return -1;
+	}
+
+	if (m_Running)
+	{
+		LOG_ERROR("Stage '%s': cannot add an output while the stage is running", m_Name.c_str());
+		return -1;
+	}
+
+	StageOutput* output = new StageOutput();
+	output->ring = ring;
+	output->policy = policy;
+	output->device = NULL;
+	output->txQueueId = 0;
+	output->numOfPackets = 0;
+	for (uint32_t i = 0; i < m_BurstSize; i++)
+		output->packets.push_back(new MBufRawPacket());
+
+	m_Outputs.push_back(output);
+	return (int)m_Outputs.size() - 1;
+}
+
+int DpdkPipelineStage::addOutput(DpdkDevice* device, uint16_t txQueueId)
+{
+	if (device == NULL)
+	{
+		LOG_ERROR("Stage '%s': output device is NULL", m_Name.c_str());
+		return -1;
+	}
+
+	if (m_Running)
+	{
+		LOG_ERROR("Stage '%s': cannot add an output while the stage is running", m_Name.c_str());
+		return -1;
+	}
+
+	StageOutput* output = new StageOutput();
+	output->ring = NULL;
+	output->policy = BackPressureDrop;
+	output->device = device;
+	output->txQueueId = txQueueId;
+	output->numOfPackets = 0;
+	for (uint32_t i = 0; i < m_BurstSize; i++)
+		output->packets.push_back(new MBufRawPacket());
+
+	m_Outputs.push_back(output);
+	return (int)m_Outputs.size() - 1;
+}
+
+bool DpdkPipelineStage::forward(MBufRawPacket* packet, int outputIndex)
+{
+	if (unlikely(outputIndex < 0 || outputIndex >= (int)m_Outputs.size()))
+	{
+		LOG_ERROR("Stage '%s': output #%d doesn't exist", m_Name.c_str(), outputIndex);
+		return false;
+	}
+
+	if (unlikely(packet == NULL || packet->m_MBuf == NULL))
+		return false;
+
+	StageOutput* output = m_Outputs[outputIndex];
+
+	// each input packet is forwarded at most once, so this only happens if processPackets() forwards packets of its own
+	if (unlikely(output->numOfPackets == m_BurstSize))
+		flushOutput(output);
+
+	// move the mbuf to the output, the packet is dropped by the caller if it wasn't attached to an mbuf
+	MBufRawPacket* outputPacket = output->packets[output->numOfPackets++];
+	outputPacket->setMBuf(packet->m_MBuf, packet->m_TimeStamp);
+	outputPacket->m_FreeMbuf = packet->m_FreeMbuf;
+	packet->m_MBuf = NULL;
+	packet->m_FreeMbuf = true;
+	return true;
+}
+
+void DpdkPipelineStage::flushOutput(StageOutput* output)
+{
+	uint32_t numOfPackets = output->numOfPackets;
+	if (numOfPackets == 0)
+		return;
+
+	MBufRawPacket** packets = &output->packets[0];
+	uint32_t numOfSent = 0;
+
+	if (output->ring != NULL)
+	{
+		while (true)
+		{
+			numOfSent += output->ring->enqueueBurst(packets + numOfSent, numOfPackets - numOfSent);
+			if (numOfSent == numOfPackets || output->policy == BackPressureDrop || m_Stop)
+				break;
+
+			// wait for the next stage to make room in the ring
+			m_Stats.backPressureWaits++;
+			rte_pause();
+		}
+	}
+	else
+	{
+		// sendPackets() marks the mbufs it sent as not to be freed, so releasing them below only detaches them
+		numOfSent = output->device->sendPackets(packets, (uint16_t)numOfPackets, output->txQueueId);
+	}
+
+	// free the mbufs which weren't sent
+	for (uint32_t i = 0; i < numOfPackets; i++)
+		packets[i]->releaseMBuf();
+
+	m_Stats.packetsForwarded += numOfSent;
+	m_Stats.outputDrops += numOfPackets - numOfSent;
+	output->numOfPackets = 0;
+}
+
+uint32_t DpdkPipelineStage::runOnce()
+{
+	MBufRawPacket** packets = &m_InputPackets[0];
+	uint32_t numOfPackets = 0;
+	if (m_InputDevice != NULL)
+		numOfPackets = m_InputDevice->receivePackets(packets, (uint16_t)m_BurstSize, m_RxQueueId);
+	else if (m_InputRing != NULL)
+		numOfPackets = m_InputRing->dequeueBurst(packets, m_BurstSize);
+
+	if (numOfPackets == 0)
+	{
+		m_Stats.idlePolls++;
+		return 0;
+	}
+
+	m_Stats.busyPolls++;
+	m_Stats.packetsIn += numOfPackets;
+
+	processPackets(packets, numOfPackets);
+
+	// drop the packets which weren't forwarded
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		if (packets[i]->m_MBuf != NULL)
+		{
+			packets[i]->releaseMBuf();
+			m_Stats.packetsDropped++;
+		}
+	}
+
+	for (std::vector<StageOutput*>::iterator iter = m_Outputs.begin(); iter != m_Outputs.end(); ++iter)
+		flushOutput(*iter);
+
+	return numOfPackets;
+}
+
+bool DpdkPipelineStage::run(uint32_t coreId)
+{
+	m_CoreId = coreId;
+
+	if (m_InputDevice == NULL && m_InputRing == NULL)
+	{
+		LOG_ERROR("Stage '%s' has no input", m_Name.c_str());
+		return false;
+	}
+
+	m_Stop = false;
+	m_Running = true;
+	LOG_DEBUG("Stage '%s' started on core %d", m_Name.c_str(), (int)coreId);
+
+	while (!m_Stop)
+		runOnce();
+
+	m_Running = false;
+	LOG_DEBUG("Stage '%s' stopped", m_Name.c_str());
+	return true;
+}
+
+void DpdkPipelineStage::stop()
+{
+	m_Stop = true;
+}
+
+void DpdkPipelineStage::getStats(DpdkPipelineStageStats& stats) const
+{
+	stats = m_Stats;
+}
+
+void DpdkPipelineStage::clearStats()
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DpdkPipeline class
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+DpdkPipeline::DpdkPipeline()
+{
+	m_Running = false;
+}
+
+DpdkPipeline::~DpdkPipeline()
+{
+	if (m_Running)
+		stop();
+
+	for (std::vector<DpdkPacketRing*>::iterator iter = m_Rings.begin(); iter != m_Rings.end(); ++iter)
+		delete *iter;
+}
+
+DpdkPacketRing* DpdkPipeline::createRing(const std::string& name, uint32_t size, bool multiProducer, bool multiConsumer, int socketId)
+{
+	DpdkPacketRing* ring = new DpdkPacketRing(name, size, multiProducer, multiConsumer, socketId);
+	if (!ring->isValid())
+	{
+		delete ring;
+		return NULL;
+	}
+
+	m_Rings.push_back(ring);
+	return ring;
+}
+
+bool DpdkPipeline::addStage(DpdkPipelineStage* stage)
+{
+	if (stage == NULL)
+	{
+		LOG_ERROR("Stage is NULL");
+		return false;
+	}
+
+	if (m_Running)
+	{
+		LOG_ERROR("Cannot add a stage while the pipeline is running");
+		return false;
+	}
+
+	for (std::vector<DpdkPipelineStage*>::iterator iter = m_Stages.begin(); iter != m_Stages.end(); ++iter)
+	{
+		if (*iter == stage)
+		{
+			LOG_ERROR("Stage '%s' is already in the pipeline", stage->getName().c_str());
+			return false;
+		}
+	}
+
+	m_Stages.push_back(stage);
+	return true;
+}
+
+DpdkPipelineStage* DpdkPipeline::getStage(size_t index) const
+{
+	if (index >= m_Stages.size())
+		return NULL;
+
+	return m_Stages[index];
+}
+
+bool DpdkPipeline::canStart() const
+{
+	if (m_Running)
+	{
+		LOG_ERROR("Pipeline is already running");
+		return false;
+	}
+
+	if (m_Stages.empty())
+	{
+		LOG_ERROR("Pipeline has no stages");
+		return false;
+	}
+
+	return true;
+}
+
+bool DpdkPipeline::start(CoreMask coreMask)
+{
+	if (!canStart())
+		return false;
+
+	std::vector<DpdkWorkerThread*> workerThreads(m_Stages.begin(), m_Stages.end());
+	if (!DpdkDeviceList::getInstance().startDpdkWorkerThreads(coreMask, workerThreads))
+		return false;
+
+	m_Running = true;
+	return true;
+}
+
+bool DpdkPipeline::start(DpdkDevice* device)
+{
+	if (!canStart())
+		return false;
+
+	std::vector<DpdkWorkerThread*> workerThreads(m_Stages.begin(), m_Stages.end());
+	if (!DpdkDeviceList::getInstance().startDpdkWorkerThreadsOnDeviceSocket(device, workerThreads))
+		return false;
+
+	m_Running = true;
+	return true;
+}
+
+void DpdkPipeline::stop()
+{
+	if (!m_Running)
+		return;
+
+	// stopping the stages from the first one lets a stage waiting for a full ring output give up when it's stopped, instead of waiting
+	// for a next stage which was already stopped
+	for (std::vector<DpdkPipelineStage*>::iterator iter = m_Stages.begin(); iter != m_Stages.end(); ++iter)
+	{
+		(*iter)->stop();
+		rte_eal_wait_lcore((*iter)->getCoreId());
+		LOG_DEBUG("Stage '%s' on core [%d] stopped", (*iter)->getName().c_str(), (int)(*iter)->getCoreId());
+	}
+
+	m_Running = false;
+}
+
+} // namespace pcpp
+
+#endif /* USE_DPDK */
@@ -0,0 +1,365 @@
+#ifdef USE_DPDK
+
+#define LOG_MODULE PcapLogModuleDpdkRssRebalancer
+
+#define __STDC_LIMIT_MACROS
+
+#include "DpdkRssRebalancer.h"
+#include "DpdkDevice.h"
+#include "MBufRawPacket.h"
+#include "Logger.h"
+#include "rte_config.h"
+#include "rte_ethdev.h"
+#include "rte_mbuf.h"
+#include <string.h>
+
+// the mbuf flag of a valid RSS hash was renamed in DPDK 21.11
+#ifdef RTE_MBUF_F_RX_RSS_HASH
+#define DPDK_RX_RSS_HASH_FLAG RTE_MBUF_F_RX_RSS_HASH
+#else
+#define DPDK_RX_RSS_HASH_FLAG PKT_RX_RSS_HASH
+#endif
+
+// the counters of each queue start on their own cache line
+#define COUNTERS_PER_CACHE_LINE 8
+
+namespace pcpp
+{
+
+DpdkRssRebalancer::DpdkRssRebalancer(DpdkDevice* device, const DpdkRssRebalancerConfig& config) :
+	m_Device(device), m_Config(config), m_OnMigration(NULL), m_OnMigrationUserCookie(NULL), m_Measuring(false), m_CooldownLeft(0)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+
+	m_RetaSize = (device != NULL ? device->getRssRedirectionTableSize() : 0);
+	m_NumOfCountedQueues = (device != NULL ? device->getNumOfOpenedRxQueues() : 0);
+	m_CountersPerQueue = (m_RetaSize + COUNTERS_PER_CACHE_LINE - 1) / COUNTERS_PER_CACHE_LINE * COUNTERS_PER_CACHE_LINE;
+	m_EntryPackets.assign((size_t)m_NumOfCountedQueues * m_CountersPerQueue, 0);
+}
+
+void DpdkRssRebalancer::setMigrationCallback(OnDpdkRssMigrationCallback onMigration, void* onMigrationUserCookie)
+{
+	m_OnMigration = onMigration;
+	m_OnMigrationUserCookie = onMigrationUserCookie;
+}
+
+void DpdkRssRebalancer::countBurst(uint16_t rxQueueId, MBufRawPacket** packets, uint16_t numOfPackets)
+{
+	for (uint16_t i = 0; i < numOfPackets; i++)
+	{
+		rte_mbuf* mbuf = packets[i]->getMBuf();
+		if (mbuf != NULL && (mbuf->ol_flags & DPDK_RX_RSS_HASH_FLAG) != 0)
+			countPacket(rxQueueId, mbuf->hash.rss);
+	}
+}
+
+void DpdkRssRebalancer::clearStats()
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+bool DpdkRssRebalancer::start()
+{
+	if (m_Device == NULL)
+	{
+		LOG_ERROR("No device to rebalance");
+		return false;
+	}
+
+	if (m_RetaSize == 0 || !m_Device->getRssRedirectionTable(m_Reta))
+		return false;
+
+	uint16_t numOfRxQueues = m_Device->getNumOfOpenedRxQueues();
+	m_IsBalancedQueue.assign(numOfRxQueues, m_Config.rxQueues.empty());
+	for (std::vector<uint16_t>::const_iterator iter = m_Config.rxQueues.begin(); iter != m_Config.rxQueues.end(); iter++)
+	{
+		if (*iter >= numOfRxQueues)
+		{
+			LOG_ERROR("RX queue %d isn't opened", (int)*iter);
+			return false;
+		}
+
+		m_IsBalancedQueue[*iter] = true;
+	}
+
+	m_PrevQueuePackets.assign(numOfRxQueues, 0);
+	m_PrevQueuePolls.assign(numOfRxQueues, 0);
+	m_PrevQueueEmptyPolls.assign(numOfRxQueues, 0);
+	m_QueueLoads.assign(numOfRxQueues, 0);
+	m_PrevEntryPackets = m_EntryPackets;
+
+	// the first measurement only sets the baseline of the counters
+	std::vector<uint64_t> queuePackets;
+	if (!measureQueueLoads(queuePackets))
+		return false;
+
+	m_Measuring = true;
+	LOG_DEBUG("Rebalancing the %d entries of the RSS redirection table of device '%s'", (int)m_RetaSize, m_Device->getDeviceName().c_str());
+	return true;
+}
+
+// counters which went back were cleared since the previous round
+static inline uint64_t counterDelta(uint64_t current, uint64_t previous)
+{
+	return (current >= previous ? current - previous : current);
+}
+
+bool DpdkRssRebalancer::measureQueueLoads(std::vector<uint64_t>& queuePackets)
+{
+	size_t numOfRxQueues = m_IsBalancedQueue.size();
+	queuePackets.assign(numOfRxQueues, 0);
+
+	// burst statistics count all queues in software and also measure how busy their cores are. Otherwise the per-queue counters of the
+	// NIC are used, which DPDK keeps for the first RTE_ETHDEV_QUEUE_STAT_CNTRS queues only
+	bool useBurstStats = m_Device->isRxBurstStatsEnabled();
+	if (!useBurstStats && m_Config.loadMetric == DpdkRssLoadBusyRatio)
+	{
+		LOG_ERROR("Balancing the busy ratio of the queues requires burst statistics to be enabled on device '%s'", m_Device->getDeviceName().c_str());
+		return false;
+	}
+
+	rte_eth_stats ethStats;
+	if (!useBurstStats && rte_eth_stats_get(m_Device->getDeviceId(), &ethStats) != 0)
+	{
+		LOG_ERROR("Cannot read the statistics of device '%s'", m_Device->getDeviceName().c_str());
+		return false;
+	}
+
+	for (size_t i = 0; i < numOfRxQueues; i++)
+	{
+		m_QueueLoads[i] = 0;
+		if (!m_IsBalancedQueue[i])
+			continue;
+
+		uint64_t packets = 0;
+		if (useBurstStats)
+		{
+			DpdkDevice::RxBurstStats burstStats;
+			if (!m_Device->getRxBurstStats((uint16_t)i, burstStats))
+				return false;
+
+			packets = burstStats.packets;
+			uint64_t polls = counterDelta(burstStats.polls, m_PrevQueuePolls[i]);
+			uint64_t emptyPolls = counterDelta(burstStats.emptyPolls, m_PrevQueueEmptyPolls[i]);
+			m_PrevQueuePolls[i] = burstStats.polls;
+			m_PrevQueueEmptyPolls[i] = burstStats.emptyPolls;
+			if (m_Config.loadMetric == DpdkRssLoadBusyRatio && polls > 0 && emptyPolls <= polls)
+				m_QueueLoads[i] = (double)(polls - emptyPolls) / polls;
+		}
+		else
+		{
+			if (i >= RTE_ETHDEV_QUEUE_STAT_CNTRS)
+			{
+				LOG_ERROR("DPDK doesn't count the packets of RX queue %d, enable burst statistics on device '%s' to balance it", (int)i,
+						m_Device->getDeviceName().c_str());
+				return false;
+			}
+
+			packets = ethStats.q_ipackets[i];
+		}
+
+		queuePackets[i] = counterDelta(packets, m_PrevQueuePackets[i]);
+		m_PrevQueuePackets[i] = packets;
+		if (m_Config.loadMetric == DpdkRssLoadPackets)
+			m_QueueLoads[i] = (double)queuePackets[i];
+	}
+
+	return true;
+}
+
+void DpdkRssRebalancer::measureEntryLoads(std::vector<double>& entryLoads)
+{
+	size_t numOfRxQueues = m_IsBalancedQueue.size();
+
+	// the packets counted for each entry since the previous round, by all queues since packets of a moved entry may still arrive on its
+	// previous queue
+	std::vector<uint64_t> entryPackets(m_RetaSize, 0);
+	for (size_t queue = 0; queue < m_NumOfCountedQueues; queue++)
+	{
+		for (uint16_t entry = 0; entry < m_RetaSize; entry++)
+		{
+			size_t index = queue * m_CountersPerQueue + entry;
+			uint64_t packets = m_EntryPackets[index];
+			entryPackets[entry] += counterDelta(packets, m_PrevEntryPackets[index]);
+			m_PrevEntryPackets[index] = packets;
+		}
+	}
+
+	std::vector<uint64_t> countedQueuePackets(numOfRxQueues, 0);
+	std::vector<uint32_t> numOfQueueEntries(numOfRxQueues, 0);
+	for (uint16_t entry = 0; entry < m_RetaSize; entry++)
+	{
+		uint16_t queue = m_Reta[entry];
+		if (queue < numOfRxQueues)
+		{
+			countedQueuePackets[queue] += entryPackets[entry];
+			numOfQueueEntries[queue]++;
+		}
+	}
+
+	// the load of a queue is split between its entries by the packets counted for them, or evenly if the workers don't count packets
+	entryLoads.assign(m_RetaSize, 0);
+	for (uint16_t entry = 0; entry < m_RetaSize; entry++)
+	{
+		uint16_t queue = m_Reta[entry];
+		if (queue >= numOfRxQueues || !m_IsBalancedQueue[queue])
+			continue;
+
+		if (countedQueuePackets[queue] > 0)
+			entryLoads[entry] = m_QueueLoads[queue] * entryPackets[entry] / countedQueuePackets[queue];
+		else
+			entryLoads[entry] = m_QueueLoads[queue] / numOfQueueEntries[queue];
+	}
+}
+
+void DpdkRssRebalancer::planMoves(std::vector<double>& entryLoads, std::vector<DpdkRssEntryMove>& moves)
+{
+	size_t numOfRxQueues = m_IsBalancedQueue.size();
+	std::vector<double> loads(m_QueueLoads);
+	double totalLoad = 0;
+	size_t numOfBalancedQueues = 0;
+	for (size_t i = 0; i < numOfRxQueues; i++)
+	{
+		if (m_IsBalancedQueue[i])
+		{
+			totalLoad += loads[i];
+			numOfBalancedQueues++;
+		}
+	}
+
+	if (numOfBalancedQueues < 2 || totalLoad <= 0)
+		return;
+
+	double averageLoad = totalLoad / numOfBalancedQueues;
+	std::vector<bool> moved(m_RetaSize, false);
+	while (moves.size() < m_Config.maxMovesPerRound)
+	{
+		int hottest = -1, coldest = -1;
+		for (size_t i = 0; i < numOfRxQueues; i++)
+		{
+			if (!m_IsBalancedQueue[i])
+				continue;
+			if (hottest < 0 || loads[i] > loads[hottest])
+				hottest = (int)i;
+			if (coldest < 0 || loads[i] < loads[coldest])
+				coldest = (int)i;
+		}
+
+		if (loads[hottest] <= m_Config.imbalanceThreshold * averageLoad)
+			break;
+
+		// the entry whose load is closest to half the gap narrows it the most, and an entry as loaded as the gap would only swap the two
+		// queues
+		double gap = loads[hottest] - loads[coldest];
+		int bestEntry = -1;
+		double bestDistance = 0;
+		for (uint16_t entry = 0; entry < m_RetaSize; entry++)
+		{
+			if (m_Reta[entry] != hottest || moved[entry] || entryLoads[entry] <= 0 || entryLoads[entry] >= gap)
+				continue;
+
+			double distance = (entryLoads[entry] > gap / 2 ? entryLoads[entry] - gap / 2 : gap / 2 - entryLoads[entry]);
+			if (bestEntry < 0 || distance < bestDistance)
+			{
+				bestEntry = entry;
+				bestDistance = distance;
+			}
+		}
+
+		if (bestEntry < 0)
+			break;
+
+		DpdkRssEntryMove move;
+		move.entry = (uint16_t)bestEntry;
+		move.fromRxQueue = (uint16_t)hottest;
+		move.toRxQueue = (uint16_t)coldest;
+		moves.push_back(move);
+
+		moved[bestEntry] = true;
+		m_Reta[bestEntry] = (uint16_t)coldest;
+		loads[hottest] -= entryLoads[bestEntry];
+		loads[coldest] += entryLoads[bestEntry];
+	}
+}
+
+int DpdkRssRebalancer::rebalance()
+{
+	if (!m_Measuring)
+		return (start() ? 0 : -1);
+
+	m_Stats.rounds++;
+
+	// the RETA is read every round in case it was changed by others
+	if (!m_Device->getRssRedirectionTable(m_Reta))
+		return -1;
+
+	std::vector<uint64_t> queuePackets;
+	if (!measureQueueLoads(queuePackets))
+		return -1;
+
+	std::vector<double> entryLoads;
+	measureEntryLoads(entryLoads);
+
+	uint64_t totalPackets = 0;
+	double totalLoad = 0, maxLoad = 0;
+	size_t numOfBalancedQueues = 0;
+	for (size_t i = 0; i < m_IsBalancedQueue.size(); i++)
+	{
+		if (!m_IsBalancedQueue[i])
+			continue;
+
+		totalPackets += queuePackets[i];
+		totalLoad += m_QueueLoads[i];
+		if (m_QueueLoads[i] > maxLoad)
+			maxLoad = m_QueueLoads[i];
+		numOfBalancedQueues++;
+	}
+
+	if (totalPackets < m_Config.minPacketsPerRound || totalLoad <= 0)
+		return 0;
+
+	m_Stats.lastImbalance = maxLoad / (totalLoad / numOfBalancedQueues);
+
+	if (m_CooldownLeft > 0)
+	{
+		m_CooldownLeft--;
+		return 0;
+	}
+
+	std::vector<uint16_t> prevReta(m_Reta);
+	std::vector<DpdkRssEntryMove> moves;
+	planMoves(entryLoads, moves);
+	if (moves.empty())
+		return 0;
+
+	if (m_OnMigration != NULL && !m_OnMigration(DpdkRssMigrationPrepare, moves, m_OnMigrationUserCookie))
+	{
+		m_Stats.cancelledMoves++;
+		m_Reta = prevReta;
+		return 0;
+	}
+
+	if (!m_Device->setRssRedirectionTable(m_Reta))
+	{
+		m_Stats.failedUpdates++;
+		m_Reta = prevReta;
+		if (m_OnMigration != NULL)
+			m_OnMigration(DpdkRssMigrationAborted, moves, m_OnMigrationUserCookie);
+		return -1;
+	}
+
+	m_Stats.rebalances++;
+	m_Stats.entryMoves += moves.size();
+	m_CooldownLeft = m_Config.cooldownRounds;
+	LOG_DEBUG("Moved %d RSS redirection table entries of device '%s', imbalance was %.2f", (int)moves.size(),
+			m_Device->getDeviceName().c_str(), m_Stats.lastImbalance);
+
+	if (m_OnMigration != NULL)
+		m_OnMigration(DpdkRssMigrationCommitted, moves, m_OnMigrationUserCookie);
+
+	return (int)moves.size();
+}
+
+} // namespace pcpp
+
+#endif /* USE_DPDK */
@@ -0,0 +1,347 @@
+#ifdef USE_DPDK
+
+#define LOG_MODULE PcapLogModuleDpdkTxAggregator
+
+#include "DpdkTxAggregator.h"
+#include "MBufRawPacket.h"
+#include "Logger.h"
+#include "rte_version.h"
+#include "rte_config.h"
+#include "rte_mbuf.h"
+#include "rte_ring.h"
+#include "rte_ethdev.h"
+#include "rte_malloc.h"
+#include "rte_errno.h"
+#include "rte_branch_prediction.h"
+#include <stdio.h>
+#include <string.h>
+
+// the enqueue and dequeue functions have an extra out parameter since DPDK 17.05
+#if (RTE_VER_YEAR > 17) || (RTE_VER_YEAR == 17 && RTE_VER_MONTH >= 5)
+#define RING_ENQUEUE_BURST(ring, objs, count) rte_ring_enqueue_burst(ring, objs, count, NULL)
+#define RING_DEQUEUE_BURST(ring, objs, count) rte_ring_dequeue_burst(ring, objs, count, NULL)
+#else
+#define RING_ENQUEUE_BURST(ring, objs, count) rte_ring_enqueue_burst(ring, objs, count)
+#define RING_DEQUEUE_BURST(ring, objs, count) rte_ring_dequeue_burst(ring, objs, count)
+#endif
+
+namespace pcpp
+{
+
+// the state of each worker and TX queue is written by one thread only, and is cache aligned so threads don't share cache lines
+struct DpdkTxAggregator::WorkerState
+{
+	struct rte_ring* ring;
+	uint64_t stagedPackets;
+	uint64_t rejectedPackets;
+} __rte_cache_aligned;
+
+struct DpdkTxAggregator::TxQueueState
+{
+	// the workers mapped to the queue
+	uint16_t* workers;
+	uint16_t numOfWorkers;
+	// the worker whose ring is read first on the next drain, so all workers get the same share of the queue
+	uint16_t nextWorker;
+	// the packets of the last burst the queue didn't accept, which are sent before new packets are collected
+	struct rte_mbuf* heldMBufs[PCPP_DPDK_TX_AGGREGATOR_BURST_SIZE];
+	uint16_t heldOffset;
+	uint16_t numOfHeld;
+	uint64_t txPackets;
+	uint64_t txBursts;
+	uint64_t txQueueFullEvents;
+} __rte_cache_aligned;
+
+// used for giving the staging rings of each aggregator unique names
+static uint32_t aggregatorCounter = 0;
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DpdkTxAggregator class
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+DpdkTxAggregator::DpdkTxAggregator(DpdkDevice* device, uint16_t numOfWorkers, uint32_t stagingRingSize)
+{
+	m_Device = device;
+	m_NumOfWorkers = 0;
+	m_NumOfTxQueues = 0;
+	m_Valid = false;
+	m_Workers = NULL;
+	m_TxQueues = NULL;
+
+	if (device == NULL || !device->isOpened())
+	{
+		LOG_ERROR("Device is NULL or isn't opened");
+		return;
+	}
+
+	if (device->getNumOfOpenedTxQueues() == 0)
+	{
+		LOG_ERROR("Device [%s] has no TX queues opened", device->getDeviceName().c_str());
+		return;
+	}
+
+	if (numOfWorkers == 0 || stagingRingSize == 0)
+	{
+		LOG_ERROR("Number of workers and staging ring size must be larger than 0");
+		return;
+	}
+
+	int socketId = device->getNumaNode();
+	if (socketId < 0)
+		socketId = SOCKET_ID_ANY;
+
+	m_Workers = (WorkerState*)rte_zmalloc_socket("tx_aggregator_workers", sizeof(WorkerState) * numOfWorkers, RTE_CACHE_LINE_SIZE, socketId);
+	m_TxQueues = (TxQueueState*)rte_zmalloc_socket("tx_aggregator_queues", sizeof(TxQueueState) * device->getNumOfOpenedTxQueues(),
+			RTE_CACHE_LINE_SIZE, socketId);
+	if (m_Workers == NULL || m_TxQueues == NULL)
+	{
+		LOG_ERROR("Couldn't allocate the state of the TX aggregator of device [%s]", device->getDeviceName().c_str());
+		return;
+	}
+
+	m_NumOfWorkers = numOfWorkers;
+	m_NumOfTxQueues = device->getNumOfOpenedTxQueues();
+
+	// an rte_ring of size N holds up to N-1 objects
+	uint32_t ringSize = rte_align32pow2(stagingRingSize + 1);
+	uint32_t aggregatorId = aggregatorCounter++;
+	for (uint16_t i = 0; i < numOfWorkers; i++)
+	{
+		char ringName[RTE_RING_NAMESIZE];
+		snprintf(ringName, sizeof(ringName), "pcpp_txagg%u_%u", aggregatorId, (unsigned int)i);
+		m_Workers[i].ring = rte_ring_create(ringName, ringSize, socketId, RING_F_SP_ENQ | RING_F_SC_DEQ);
+		if (m_Workers[i].ring == NULL)
+		{
+			LOG_ERROR("Couldn't create staging ring '%s' of size %d, error was: %s", ringName, (int)ringSize, rte_strerror(rte_errno));
+			return;
+		}
+	}
+
+	// each worker is mapped to one TX queue and each TX queue has at least one worker if there are enough workers
+	for (uint16_t txQueueId = 0; txQueueId < m_NumOfTxQueues; txQueueId++)
+	{
+		TxQueueState& txQueue = m_TxQueues[txQueueId];
+		uint16_t numOfQueueWorkers = (numOfWorkers / m_NumOfTxQueues) + (txQueueId < numOfWorkers % m_NumOfTxQueues ? 1 : 0);
+		if (numOfQueueWorkers == 0)
+			continue;
+
+		txQueue.workers = new uint16_t[numOfQueueWorkers];
+		for (uint16_t workerId = txQueueId; workerId < numOfWorkers; workerId += m_NumOfTxQueues)
+			txQueue.workers[txQueue.numOfWorkers++] = workerId;
+	}
+
+	m_Valid = true;
+	LOG_DEBUG("Created a TX aggregator of %d workers for %d TX queues of device [%s]", (int)m_NumOfWorkers, (int)m_NumOfTxQueues,
+			device->getDeviceName().c_str());
+}
+
+DpdkTxAggregator::~DpdkTxAggregator()
+{
+	if (m_TxQueues != NULL)
+	{
+		for (uint16_t i = 0; i < m_NumOfTxQueues; i++)
+		{
+			TxQueueState& txQueue = m_TxQueues[i];
+			for (uint16_t j = txQueue.heldOffset; j < txQueue.heldOffset + txQueue.numOfHeld; j++)
+				rte_pktmbuf_free(txQueue.heldMBufs[j]);
+
+			delete [] txQueue.workers;
+		}
+
+		rte_free(m_TxQueues);
+	}
+
+	if (m_Workers != NULL)
+	{
+		for (uint16_t i = 0; i < m_NumOfWorkers; i++)
+		{
+			if (m_Workers[i].ring == NULL)
+				continue;
+
+			void* mBufs[PCPP_DPDK_TX_AGGREGATOR_BURST_SIZE];
+			uint32_t numOfMBufs = 0;
+			while ((numOfMBufs = RING_DEQUEUE_BURST(m_Workers[i].ring, mBufs, PCPP_DPDK_TX_AGGREGATOR_BURST_SIZE)) > 0)
+			{
+				for (uint32_t j = 0; j < numOfMBufs; j++)
+					rte_pktmbuf_free((struct rte_mbuf*)mBufs[j]);
+			}
+
+			rte_ring_free(m_Workers[i].ring);
+		}
+
+		rte_free(m_Workers);
+	}
+}
+
+uint16_t DpdkTxAggregator::sendPackets(uint16_t workerId, MBufRawPacket** packets, uint16_t count)
+{
+	if (unlikely(!m_Valid || workerId >= m_NumOfWorkers))
+	{
+		LOG_ERROR("TX aggregator isn't valid or worker %d doesn't exist", (int)workerId);
+		return 0;
+	}
+
+	WorkerState& worker = m_Workers[workerId];
+	uint16_t numOfStaged = 0;
+	while (numOfStaged < count)
+	{
+		void* mBufs[PCPP_DPDK_TX_AGGREGATOR_BURST_SIZE];
+		uint16_t batchSize = (count - numOfStaged < PCPP_DPDK_TX_AGGREGATOR_BURST_SIZE ? count - numOfStaged : PCPP_DPDK_TX_AGGREGATOR_BURST_SIZE);
+		for (uint16_t i = 0; i < batchSize; i++)
+			mBufs[i] = packets[numOfStaged + i]->m_MBuf;
+
+		uint16_t staged = (uint16_t)RING_ENQUEUE_BURST(worker.ring, mBufs, batchSize);
+
+		// the ring owns the staged mbufs now
+		for (uint16_t i = 0; i < staged; i++)
+		{
+			MBufRawPacket* packet = packets[numOfStaged + i];
+			packet->m_MBuf = NULL;
+			packet->m_FreeMbuf = true;
+		}
+
+		numOfStaged += staged;
+		if (staged < batchSize)
+			break;
+	}
+
+	worker.stagedPackets += numOfStaged;
+	worker.rejectedPackets += count - numOfStaged;
+	return numOfStaged;
+}
+
+bool DpdkTxAggregator::sendPacket(uint16_t workerId, MBufRawPacket& packet)
+{
+	MBufRawPacket* packetPtr = &packet;
+	return sendPackets(workerId, &packetPtr, 1) == 1;
+}
+
+uint16_t DpdkTxAggregator::drainTxQueue(uint16_t txQueueId)
+{
+	if (unlikely(!m_Valid || txQueueId >= m_NumOfTxQueues))
+	{
+		LOG_ERROR("TX aggregator isn't valid or TX queue %d doesn't exist", (int)txQueueId);
+		return 0;
+	}
+
+	TxQueueState& txQueue = m_TxQueues[txQueueId];
+
+	// collect a burst in round-robin order, unless the previous burst wasn't fully sent
+	if (txQueue.numOfHeld == 0)
+	{
+		txQueue.heldOffset = 0;
+		for (uint16_t i = 0; i < txQueue.numOfWorkers && txQueue.numOfHeld < PCPP_DPDK_TX_AGGREGATOR_BURST_SIZE; i++)
+		{
+			uint16_t workerIndex = txQueue.nextWorker + i;
+			if (workerIndex >= txQueue.numOfWorkers)
+				workerIndex -= txQueue.numOfWorkers;
+
+			txQueue.numOfHeld += (uint16_t)RING_DEQUEUE_BURST(m_Workers[txQueue.workers[workerIndex]].ring,
+					(void**)(txQueue.heldMBufs + txQueue.numOfHeld), PCPP_DPDK_TX_AGGREGATOR_BURST_SIZE - txQueue.numOfHeld);
+		}
+
+		if (++txQueue.nextWorker >= txQueue.numOfWorkers)
+			txQueue.nextWorker = 0;
+
+		if (txQueue.numOfHeld == 0)
+			return 0;
+	}
+
+	uint16_t numOfSent = rte_eth_tx_burst(m_Device->m_Id, txQueueId, txQueue.heldMBufs + txQueue.heldOffset, txQueue.numOfHeld);
+	txQueue.txPackets += numOfSent;
+	txQueue.txBursts++;
+	if (numOfSent < txQueue.numOfHeld)
+		txQueue.txQueueFullEvents++;
+
+	txQueue.heldOffset += numOfSent;
+	txQueue.numOfHeld -= numOfSent;
+	return numOfSent;
+}
+
+void DpdkTxAggregator::getWorkerStats(uint16_t workerId, DpdkTxAggregatorWorkerStats& stats) const
+{
+	memset(&stats, 0, sizeof(stats));
+	if (!m_Valid || workerId >= m_NumOfWorkers)
+		return;
+
+	stats.stagedPackets = m_Workers[workerId].stagedPackets;
+	stats.rejectedPackets = m_Workers[workerId].rejectedPackets;
+	stats.pendingPackets = rte_ring_count(m_Workers[workerId].ring);
+}
+
+void DpdkTxAggregator::getTxQueueStats(uint16_t txQueueId, DpdkTxAggregatorQueueStats& stats) const
+{
+	memset(&stats, 0, sizeof(stats));
+	if (!m_Valid || txQueueId >= m_NumOfTxQueues)
+		return;
+
+	stats.txPackets = m_TxQueues[txQueueId].txPackets;
+	stats.txBursts = m_TxQueues[txQueueId].txBursts;
+	stats.txQueueFullEvents = m_TxQueues[txQueueId].txQueueFullEvents;
+	stats.heldPackets = m_TxQueues[txQueueId].numOfHeld;
+}
+
+void DpdkTxAggregator::clearStats()
+{
+	if (!m_Valid)
+		return;
+
+	for (uint16_t i = 0; i < m_NumOfWorkers; i++)
+	{
+		m_Workers[i].stagedPackets = 0;
+		m_Workers[i].rejectedPackets = 0;
+	}
+
+	for (uint16_t i = 0; i < m_NumOfTxQueues; i++)
+	{
+		m_TxQueues[i].txPackets = 0;
+		m_TxQueues[i].txBursts = 0;
+		m_TxQueues[i].txQueueFullEvents = 0;
+	}
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DpdkTxServiceThread class
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+DpdkTxServiceThread::DpdkTxServiceThread(DpdkTxAggregator* aggregator, const std::vector<uint16_t>& txQueues)
+{
+	m_Aggregator = aggregator;
+	m_TxQueues = txQueues;
+	m_CoreId = MAX_NUM_OF_CORES + 1;
+	m_Stop = true;
+}
+
+bool DpdkTxServiceThread::run(uint32_t coreId)
+{
+	m_CoreId = coreId;
+
+	if (m_Aggregator == NULL || !m_Aggregator->isValid())
+	{
+		LOG_ERROR("TX service thread on core %d has no valid aggregator", (int)coreId);
+		return false;
+	}
+
+	m_Stop = false;
+	LOG_DEBUG("TX service thread started on core %d", (int)coreId);
+
+	while (!m_Stop)
+	{
+		for (std::vector<uint16_t>::const_iterator iter = m_TxQueues.begin(); iter != m_TxQueues.end(); iter++)
+			m_Aggregator->drainTxQueue(*iter);
+	}
+
+	LOG_DEBUG("TX service thread on core %d stopped", (int)coreId);
+	return true;
+}
+
+void DpdkTxServiceThread::stop()
+{
+	m_Stop = true;
+}
+
+} // namespace pcpp
+
+#endif /* USE_DPDK */
@@ -0,0 +1,587 @@
+#define LOG_MODULE PcapLogModuleFlightRecorderDevice
+
+#include "FlightRecorderDevice.h"
+#include "AtomicUtils.h"
+#include "PcapFileDevice.h"
+#include "TimestampClock.h"
+#include "Logger.h"
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <algorithm>
+#include <vector>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#ifdef LINUX
+#include <sys/mman.h>
+#endif
+
+#define FLIGHT_RECORDER_CACHE_LINE_SIZE 64
+
+// records start at 8 byte offsets in their segment
+#define RECORD_ALIGNMENT 8
+
+// the size huge page backed memory is rounded up to
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// how often a dump waiting for the end of its time window checks whether it was cancelled
+#define DUMP_WAIT_INTERVAL_MS 10
+
+namespace pcpp
+{
+
+// each packet is kept in its segment as this header followed by its data
+struct FlightRecordHeader
+{
+	int64_t timestampSec;
+	uint32_t timestampNsec;
+	uint32_t capturedLength;
+	uint32_t frameLength;
+	uint16_t linkType;
+	uint16_t reserved;
+};
+
+// the sequence is 2*n+1 while the segment is the n-th segment taken by a producer and the producer appends to it, and 2*n+2 once the
+// producer moved on to another segment. It's 0 for a segment which was never taken. The packets of a segment are overwritten only when
+// its sequence changes to a higher n, so a dump which sees the same n before and after copying a segment copied valid packets
+struct FlightRecorderDevice::SegmentState
+{
+	volatile uint64_t sequence;
+	// the length of the complete records, published after each record
+	volatile uint64_t usedBytes;
+	volatile uint64_t minTimestampNs;
+	volatile uint64_t maxTimestampNs;
+	uint8_t padding[FLIGHT_RECORDER_CACHE_LINE_SIZE - 32];
+};
+
+// written by the producer thread only. The counters are read by other threads
+struct FlightRecorderDevice::ProducerState
+{
+	int64_t segmentIndex;
+	uint64_t sequence;
+	uint64_t usedBytes;
+	volatile uint64_t packets;
+	volatile uint64_t bytes;
+	volatile uint64_t truncated;
+	volatile uint64_t drops;
+	volatile uint64_t overwrittenSegments;
+	uint8_t padding[FLIGHT_RECORDER_CACHE_LINE_SIZE];
+};
+
+static void sleepMs(uint32_t milliseconds)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	Sleep(milliseconds);
+#else
+	timespec interval;
+	interval.tv_sec = milliseconds / 1000;
+	interval.tv_nsec = (long)(milliseconds % 1000) * 1000000;
+	nanosleep(&interval, NULL);
+#endif
+}
+
+static inline size_t getRecordLength(uint32_t capturedLength)
+{
+	return (sizeof(FlightRecordHeader) + capturedLength + RECORD_ALIGNMENT - 1) & ~(size_t)(RECORD_ALIGNMENT - 1);
+}
+
+// the number of the segment taken, for both sequence values of a segment
+static inline uint64_t getSegmentNumber(uint64_t sequence)
+{
+	return (sequence - 1) / 2;
+}
+
+FlightRecorderDevice::FlightRecorderDevice(const FlightRecorderConfiguration& config) : m_Config(config), m_DumpRequest("")
+{
+	m_Memory = NULL;
+	m_MemorySize = 0;
+	m_UsingHugePages = false;
+	m_NumOfSegments = 0;
+	m_Segments = NULL;
+	m_Producers = NULL;
+	m_NextSegmentSequence = 0;
+	m_DumpStarted = false;
+	m_DumpDone = 0;
+	m_CancelDump = 0;
+	m_DumpStartNs = 0;
+	m_DumpEndNs = 0;
+	m_DumpResult.succeeded = false;
+	m_DumpResult.packetsWritten = 0;
+	m_DumpResult.packetsFiltered = 0;
+	m_DumpResult.segmentsLost = 0;
+}
+
+FlightRecorderDevice::~FlightRecorderDevice()
+{
+	close();
+}
+
+bool FlightRecorderDevice::open()
+{
+	if (m_DeviceOpened)
+	{
+		LOG_ERROR("Flight recorder already opened");
+		return false;
+	}
+
+	m_Config.segmentSize = (m_Config.segmentSize + RECORD_ALIGNMENT - 1) & ~(uint32_t)(RECORD_ALIGNMENT - 1);
+	if (m_Config.numOfProducers == 0 || m_Config.segmentSize < getRecordLength(64))
+	{
+		LOG_ERROR("Invalid flight recorder configuration: there must be at least one producer and segments of at least %d bytes",
+				(int)getRecordLength(64));
+		return false;
+	}
+
+	uint64_t numOfSegments = (m_Config.capacity + m_Config.segmentSize - 1) / m_Config.segmentSize;
+	// each producer holds a segment, so with fewer segments producers would overwrite the packets of the segments they just left
+	if (numOfSegments < 2 * (uint64_t)m_Config.numOfProducers || numOfSegments > 0xFFFFFFFF)
+	{
+		LOG_ERROR("Invalid flight recorder capacity: %d segments for %d producers, there must be at least two segments per producer",
+				(int)numOfSegments, (int)m_Config.numOfProducers);
+		return false;
+	}
+
+	m_Config.capacity = numOfSegments * m_Config.segmentSize;
+	m_MemorySize = (size_t)m_Config.capacity;
+	m_UsingHugePages = false;
+
+#ifdef LINUX
+	// the memory is populated when it's mapped, so recording doesn't take page faults
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+	flags |= MAP_POPULATE;
+#endif
+	void* memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	if (m_Config.useHugePages)
+	{
+		size_t hugePagesSize = (m_MemorySize + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+		memory = mmap(NULL, hugePagesSize, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED)
+		{
+			m_MemorySize = hugePagesSize;
+			m_UsingHugePages = true;
+		}
+		else
+			LOG_DEBUG("Cannot allocate %d bytes of huge pages for the flight recorder (%s), using regular pages", (int)hugePagesSize, strerror(errno));
+	}
+#endif
+	if (memory == MAP_FAILED)
+		memory = mmap(NULL, m_MemorySize, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+	if (memory == MAP_FAILED)
+	{
+		LOG_ERROR("Cannot allocate %d bytes for the flight recorder: %s", (int)m_MemorySize, strerror(errno));
+		m_MemorySize = 0;
+		return false;
+	}
+
+	m_Memory = (uint8_t*)memory;
+#else
+	m_Memory = (uint8_t*)malloc(m_MemorySize);
+	if (m_Memory == NULL)
+	{
+		LOG_ERROR("Cannot allocate %d bytes for the flight recorder", (int)m_MemorySize);
+		m_MemorySize = 0;
+		return false;
+	}
+
+	// touch the memory so recording doesn't take page faults
+	memset(m_Memory, 0, m_MemorySize);
+#endif
+
+	m_NumOfSegments = (uint32_t)numOfSegments;
+	m_Segments = new SegmentState[m_NumOfSegments];
+	memset(m_Segments, 0, sizeof(SegmentState) * m_NumOfSegments);
+	m_Producers = new ProducerState[m_Config.numOfProducers];
+	memset(m_Producers, 0, sizeof(ProducerState) * m_Config.numOfProducers);
+	for (uint16_t i = 0; i < m_Config.numOfProducers; i++)
+		m_Producers[i].segmentIndex = -1;
+
+	m_NextSegmentSequence = 0;
+	m_DumpStarted = false;
+	m_DeviceOpened = true;
+	LOG_DEBUG("Flight recorder opened with %d segments of %d bytes%s", (int)m_NumOfSegments, (int)m_Config.segmentSize,
+			(m_UsingHugePages ? " in huge pages" : ""));
+	return true;
+}
+
+void FlightRecorderDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	if (m_DumpStarted)
+	{
+		atomicStoreRelease(&m_CancelDump, 1);
+		pthread_join(m_DumpThread, NULL);
+		m_DumpStarted = false;
+	}
+
+#ifdef LINUX
+	munmap(m_Memory, m_MemorySize);
+#else
+	free(m_Memory);
+#endif
+
+	delete [] m_Segments;
+	delete [] m_Producers;
+	m_Memory = NULL;
+	m_MemorySize = 0;
+	m_Segments = NULL;
+	m_Producers = NULL;
+	m_NumOfSegments = 0;
+	m_UsingHugePages = false;
+	m_DeviceOpened = false;
+	LOG_DEBUG("Flight recorder closed");
+}
+
+bool FlightRecorderDevice::recordPacket(const RawPacket& rawPacket, uint16_t producerId)
+{
+	return recordPackets(&rawPacket, 1, producerId) == 1;
+}
+
+int FlightRecorderDevice::recordPackets(const RawPacket* rawPacketsArr, int arrLength, uint16_t producerId)
+{
+	if (!m_DeviceOpened || producerId >= m_Config.numOfProducers)
+	{
+		LOG_ERROR("Flight recorder isn't opened or producer %d doesn't exist", (int)producerId);
+		return 0;
+	}
+
+	ProducerState& producer = m_Producers[producerId];
+	int packetsRecorded = 0;
+	for (int i = 0; i < arrLength; i++)
+	{
+		if (appendPacket(rawPacketsArr[i], producer))
+			packetsRecorded++;
+	}
+
+	return packetsRecorded;
+}
+
+int FlightRecorderDevice::recordPackets(const RawPacketVector& rawPackets, uint16_t producerId)
+{
+	if (!m_DeviceOpened || producerId >= m_Config.numOfProducers)
+	{
+		LOG_ERROR("Flight recorder isn't opened or producer %d doesn't exist", (int)producerId);
+		return 0;
+	}
+
+	ProducerState& producer = m_Producers[producerId];
+	int packetsRecorded = 0;
+	for (RawPacketVector::ConstVectorIterator iter = rawPackets.begin(); iter != rawPackets.end(); iter++)
+	{
+		if (appendPacket(**iter, producer))
+			packetsRecorded++;
+	}
+
+	return packetsRecorded;
+}
+
+bool FlightRecorderDevice::appendPacket(const RawPacket& rawPacket, ProducerState& producer)
+{
+	uint32_t dataLen = (uint32_t)rawPacket.getRawDataLen();
+	uint32_t capturedLength = dataLen;
+	if (m_Config.snapshotLength > 0 && capturedLength > m_Config.snapshotLength)
+		capturedLength = m_Config.snapshotLength;
+	if (capturedLength > m_Config.segmentSize - sizeof(FlightRecordHeader))
+		capturedLength = m_Config.segmentSize - sizeof(FlightRecordHeader);
+
+	size_t recordLen = getRecordLength(capturedLength);
+	if ((producer.segmentIndex < 0 || producer.usedBytes + recordLen > m_Config.segmentSize) && !takeSegment(producer))
+	{
+		atomicStoreRelaxed(&producer.drops, producer.drops + 1);
+		return false;
+	}
+
+	timespec timestamp = rawPacket.getPacketTimeStampNs();
+	FlightRecordHeader header;
+	header.timestampSec = (int64_t)timestamp.tv_sec;
+	header.timestampNsec = (uint32_t)timestamp.tv_nsec;
+	header.capturedLength = capturedLength;
+	header.frameLength = (uint32_t)rawPacket.getFrameLength();
+	header.linkType = (uint16_t)rawPacket.getLinkLayerType();
+	header.reserved = 0;
+
+	uint8_t* record = m_Memory + (size_t)producer.segmentIndex * m_Config.segmentSize + producer.usedBytes;
+	memcpy(record, &header, sizeof(header));
+	memcpy(record + sizeof(header), rawPacket.getRawData(), capturedLength);
+
+	// the timestamp range lets a dump skip segments outside its window. It's published with the record
+	SegmentState& segment = m_Segments[producer.segmentIndex];
+	uint64_t timestampNs = (uint64_t)timestamp.tv_sec * 1000000000 + timestamp.tv_nsec;
+	if (producer.usedBytes == 0 || timestampNs < segment.minTimestampNs)
+		segment.minTimestampNs = timestampNs;
+	if (producer.usedBytes == 0 || timestampNs > segment.maxTimestampNs)
+		segment.maxTimestampNs = timestampNs;
+
+	producer.usedBytes += recordLen;
+	atomicStoreRelease(&segment.usedBytes, producer.usedBytes);
+
+	atomicStoreRelaxed(&producer.packets, producer.packets + 1);
+	atomicStoreRelaxed(&producer.bytes, producer.bytes + capturedLength);
+	if (capturedLength < dataLen)
+		atomicStoreRelaxed(&producer.truncated, producer.truncated + 1);
+
+	return true;
+}
+
+bool FlightRecorderDevice::takeSegment(ProducerState& producer)
+{
+	if (producer.segmentIndex >= 0)
+	{
+		atomicStoreRelease(&m_Segments[producer.segmentIndex].sequence, 2 * producer.sequence + 2);
+		producer.segmentIndex = -1;
+	}
+
+	// the segment after the last taken one holds the oldest packets. It's skipped if another producer still appends to it, or if a
+	// producer which advanced the counter later already took it
+	for (uint32_t attempt = 0; attempt < m_NumOfSegments; attempt++)
+	{
+		uint64_t segmentNumber = atomicFetchAdd(&m_NextSegmentSequence, 1);
+		uint32_t segmentIndex = (uint32_t)(segmentNumber % m_NumOfSegments);
+		SegmentState& segment = m_Segments[segmentIndex];
+		uint64_t sequence = atomicLoadAcquire(&segment.sequence);
+		if ((sequence & 1) != 0 || sequence > 2 * segmentNumber)
+			continue;
+
+		if (!atomicCompareExchange(&segment.sequence, sequence, 2 * segmentNumber + 1))
+			continue;
+
+		if (sequence != 0)
+			atomicStoreRelaxed(&producer.overwrittenSegments, producer.overwrittenSegments + 1);
+
+		atomicStoreRelease(&segment.usedBytes, 0);
+		producer.segmentIndex = segmentIndex;
+		producer.sequence = segmentNumber;
+		producer.usedBytes = 0;
+		return true;
+	}
+
+	return false;
+}
+
+bool FlightRecorderDevice::triggerDump(const FlightRecorderDumpRequest& request)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Flight recorder isn't opened");
+		return false;
+	}
+
+	if (m_DumpStarted)
+	{
+		LOG_ERROR("A flight recorder dump is already running or its result wasn't collected with waitForDump()");
+		return false;
+	}
+
+	m_DumpFilter.clear();
+	if (request.filter != NULL && !request.filter->compile(m_DumpFilter, m_Config.linkLayerType))
+	{
+		LOG_ERROR("Cannot compile the filter of the flight recorder dump");
+		return false;
+	}
+
+	uint64_t triggerTime = TimestampClock::nowNs();
+	uint64_t windowBefore = 0;
+	if (request.secondsBefore > 0)
+		windowBefore = (uint64_t)request.secondsBefore * 1000000000;
+	if (m_Config.retentionSeconds > 0 && (windowBefore == 0 || (uint64_t)m_Config.retentionSeconds * 1000000000 < windowBefore))
+		windowBefore = (uint64_t)m_Config.retentionSeconds * 1000000000;
+
+	m_DumpStartNs = (windowBefore > 0 && windowBefore < triggerTime ? triggerTime - windowBefore : 0);
+	m_DumpEndNs = triggerTime + (uint64_t)request.secondsAfter * 1000000000;
+	m_DumpRequest = request;
+	m_DumpResult.fileName = request.fileName;
+	m_DumpResult.succeeded = false;
+	m_DumpResult.packetsWritten = 0;
+	m_DumpResult.packetsFiltered = 0;
+	m_DumpResult.segmentsLost = 0;
+	m_DumpDone = 0;
+	m_CancelDump = 0;
+
+	int err = pthread_create(&m_DumpThread, NULL, dumpThreadMain, this);
+	if (err != 0)
+	{
+		LOG_ERROR("Cannot create the flight recorder dump thread: [%s]", strerror(err));
+		return false;
+	}
+
+	m_DumpStarted = true;
+	LOG_DEBUG("Flight recorder dump to '%s' triggered", request.fileName.c_str());
+	return true;
+}
+
+bool FlightRecorderDevice::isDumpInProgress() const
+{
+	return m_DumpStarted && atomicLoadAcquire(&m_DumpDone) == 0;
+}
+
+bool FlightRecorderDevice::waitForDump(FlightRecorderDumpResult& result)
+{
+	if (!m_DumpStarted)
+		return false;
+
+	pthread_join(m_DumpThread, NULL);
+	m_DumpStarted = false;
+	result = m_DumpResult;
+	return true;
+}
+
+void* FlightRecorderDevice::dumpThreadMain(void* recorderPtr)
+{
+	FlightRecorderDevice* self = (FlightRecorderDevice*)recorderPtr;
+	self->dump();
+	atomicStoreRelease(&self->m_DumpDone, 1);
+	return NULL;
+}
+
+void FlightRecorderDevice::dump()
+{
+	while (TimestampClock::nowNs() < m_DumpEndNs)
+	{
+		if (atomicLoadAcquire(&m_CancelDump) != 0)
+			return;
+
+		sleepMs(DUMP_WAIT_INTERVAL_MS);
+	}
+
+	IFileWriterDevice* writer = NULL;
+	if (m_DumpRequest.pcapng)
+		writer = new PcapNgFileWriterDevice(m_DumpRequest.fileName.c_str());
+	else
+		writer = new PcapFileWriterDevice(m_DumpRequest.fileName.c_str(), m_Config.linkLayerType, true);
+
+	if (!writer->open())
+	{
+		LOG_ERROR("Cannot open '%s' for the flight recorder dump", m_DumpRequest.fileName.c_str());
+		delete writer;
+		return;
+	}
+
+	// the segments are written from the oldest to the newest
+	std::vector<std::pair<uint64_t, uint32_t> > segments;
+	segments.reserve(m_NumOfSegments);
+	for (uint32_t i = 0; i < m_NumOfSegments; i++)
+	{
+		uint64_t sequence = atomicLoadAcquire(&m_Segments[i].sequence);
+		if (sequence != 0)
+			segments.push_back(std::pair<uint64_t, uint32_t>(sequence, i));
+	}
+
+	std::sort(segments.begin(), segments.end());
+
+	std::vector<uint8_t> copyBuffer(m_Config.segmentSize);
+	bool cancelled = false;
+	for (std::vector<std::pair<uint64_t, uint32_t> >::const_iterator iter = segments.begin(); iter != segments.end(); iter++)
+	{
+		if (atomicLoadAcquire(&m_CancelDump) != 0)
+		{
+			cancelled = true;
+			break;
+		}
+
+		if (!dumpSegment(iter->second, iter->first, &copyBuffer[0], writer))
+			m_DumpResult.segmentsLost++;
+	}
+
+	writer->close();
+	delete writer;
+	m_DumpResult.succeeded = !cancelled;
+	LOG_DEBUG("Flight recorder dump to '%s' wrote %d packets, %d segments were lost", m_DumpRequest.fileName.c_str(),
+			(int)m_DumpResult.packetsWritten, (int)m_DumpResult.segmentsLost);
+}
+
+bool FlightRecorderDevice::dumpSegment(uint32_t segmentIndex, uint64_t sequence, uint8_t* copyBuffer, IFileWriterDevice* writer)
+{
+	// the segment is copied like a seqlock: its packets are valid if it wasn't taken again before or while they were copied
+	SegmentState& segment = m_Segments[segmentIndex];
+	uint64_t segmentNumber = getSegmentNumber(sequence);
+	if (getSegmentNumber(atomicLoadAcquire(&segment.sequence)) != segmentNumber)
+		return false;
+
+	size_t usedBytes = (size_t)atomicLoadAcquire(&segment.usedBytes);
+	if (usedBytes == 0 || segment.maxTimestampNs < m_DumpStartNs || segment.minTimestampNs > m_DumpEndNs)
+		return true;
+
+	memcpy(copyBuffer, m_Memory + (size_t)segmentIndex * m_Config.segmentSize, usedBytes);
+	atomicAcquireFence();
+	if (getSegmentNumber(atomicLoadAcquire(&segment.sequence)) != segmentNumber)
+		return false;
+
+	RawPacket rawPacket;
+	size_t offset = 0;
+	while (offset + sizeof(FlightRecordHeader) <= usedBytes)
+	{
+		FlightRecordHeader header;
+		memcpy(&header, copyBuffer + offset, sizeof(header));
+		uint64_t timestampNs = (uint64_t)header.timestampSec * 1000000000 + header.timestampNsec;
+		if (timestampNs >= m_DumpStartNs && timestampNs <= m_DumpEndNs)
+		{
+			const uint8_t* data = copyBuffer + offset + sizeof(FlightRecordHeader);
+			if (m_DumpFilter.isCompiled() && !m_DumpFilter.matchPacket(data, header.capturedLength, header.frameLength))
+				m_DumpResult.packetsFiltered++;
+			else
+			{
+				timespec timestamp;
+				timestamp.tv_sec = (time_t)header.timestampSec;
+				timestamp.tv_nsec = (long)header.timestampNsec;
+				rawPacket.setExternalRawData(data, (int)header.capturedLength, timestamp, (LinkLayerType)header.linkType, (int)header.frameLength);
+				if (writer->writePacket(rawPacket))
+					m_DumpResult.packetsWritten++;
+			}
+		}
+
+		offset += getRecordLength(header.capturedLength);
+	}
+
+	return true;
+}
+
+void FlightRecorderDevice::getStatistics(FlightRecorderStats& stats) const
+{
+	memset(&stats, 0, sizeof(stats));
+	if (!m_DeviceOpened)
+		return;
+
+	for (uint16_t i = 0; i < m_Config.numOfProducers; i++)
+	{
+		stats.packets += atomicLoadRelaxed(&m_Producers[i].packets);
+		stats.bytes += atomicLoadRelaxed(&m_Producers[i].bytes);
+		stats.truncated += atomicLoadRelaxed(&m_Producers[i].truncated);
+		stats.drops += atomicLoadRelaxed(&m_Producers[i].drops);
+		stats.overwrittenSegments += atomicLoadRelaxed(&m_Producers[i].overwrittenSegments);
+	}
+}
+
+void FlightRecorderDevice::collectMetrics(MetricsWriter& writer)
+{
+	if (!m_DeviceOpened)
+		return;
+
+	FlightRecorderStats stats;
+	getStatistics(stats);
+	writer.addCounter("pcpp_device_rx_packets_total", "Packets recorded by the flight recorder", stats.packets);
+	writer.addCounter("pcpp_device_rx_bytes_total", "Bytes recorded by the flight recorder", stats.bytes);
+	writer.addCounter("pcpp_device_rx_dropped_packets_total", "Packets the flight recorder couldn't record", stats.drops);
+	writer.addCounter("pcpp_device_flight_recorder_overwritten_segments_total", "Segments whose packets were overwritten by newer packets",
+			stats.overwrittenSegments);
+}
+
+void FlightRecorderDevice::onPacketArrives(RawPacket* packet, PcapLiveDevice* pDevice, void* userCookie)
+{
+	FlightRecorderDevice* pThis = (FlightRecorderDevice*)userCookie;
+	pThis->recordPackets(packet, 1);
+}
+
+void FlightRecorderDevice::onPacketsArriveBurst(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* pDevice, void* userCookie)
+{
+	FlightRecorderDevice* pThis = (FlightRecorderDevice*)userCookie;
+	pThis->recordPackets(packets, (int)numOfPackets);
+}
+
+} // namespace pcpp
@@ -5,6 +5,7 @@
 #include "KniDevice.h"
 #include "Logger.h"
 #include "SystemUtils.h"
+#include "TimestampClock.h"
 
 #include <unistd.h>
 #include <time.h>
@@ -508,8 +509,7 @@ uint16_t KniDevice::receivePackets(MBufRawPacketVector& rawPacketsArr)
 		return 0;
 	}
 
-	timeval time;
-	gettimeofday(&time, NULL);
+	timespec time = TimestampClock::now();
 
 	for (uint32_t index = 0; index < numOfPktsReceived; ++index)
 	{
@@ -554,8 +554,7 @@ uint16_t KniDevice::receivePackets(MBufRawPacket** rawPacketsArr, uint16_t rawPa
 		return 0;
 	}
 
-	timeval time;
-	gettimeofday(&time, NULL);
+	timespec time = TimestampClock::now();
 
 	for (size_t index = 0; index < packetsReceived; ++index)
 	{
@@ -597,8 +596,7 @@ uint16_t KniDevice::receivePackets(Packet** packetsArr, uint16_t packetsArrLengt
 		return 0;
 	}
 
-	timeval time;
-	gettimeofday(&time, NULL);
+	timespec time = TimestampClock::now();
 
 	for (size_t index = 0; index < packetsReceived; ++index)
 	{
@@ -830,6 +828,8 @@ void* KniDevice::KniCapturing::runCapture(void* devicePointer)
 	void* userCookie = device->m_Capturing.userCookie;
 	struct rte_mbuf* mBufArray[MAX_BURST_SIZE];
 	struct rte_kni* kni = device->m_Device;
+	// the packet objects are reused for every burst rather than constructed and destroyed per burst
+	MBufRawPacket rawPackets[MAX_BURST_SIZE];
 
 	LOG_DEBUG("Starting KNI capture thread for device \"%s\"", device->m_DeviceInfo.name.c_str());
 
@@ -842,25 +842,73 @@ void* KniDevice::KniCapturing::runCapture(void* devicePointer)
 			continue;
 		}
 
-		timeval time;
-		gettimeofday(&time, NULL);
+		timespec time = TimestampClock::now();
 
-		if (likely(callback != NULL))
-		{
-			MBufRawPacket rawPackets[MAX_BURST_SIZE];
-			for (uint32_t index = 0; index < numOfPktsReceived; ++index)
-			{
-				rawPackets[index].setMBuf(mBufArray[index], time);
-			}
+		if (!device->dispatchBurst(mBufArray, numOfPktsReceived, rawPackets, time, callback, userCookie))
+			break;
 
-			if (!callback(rawPackets, numOfPktsReceived, device, userCookie))
-				break;
-		}
 		pthread_testcancel();
 	}
 	return NULL;
 }
 
+bool KniDevice::dispatchBurst(struct rte_mbuf** mBufArray, uint32_t numOfPackets, MBufRawPacket* rawPackets, timespec time,
+	OnKniPacketArriveCallback onPacketArrives, void* onPacketArrivesUserCookie)
+{
+	if (unlikely(onPacketArrives == NULL))
+	{
+		for (uint32_t index = 0; index < numOfPackets; ++index)
+			rte_pktmbuf_free(mBufArray[index]);
+		return true;
+	}
+
+	for (uint32_t index = 0; index < numOfPackets; ++index)
+	{
+		rawPackets[index].setMBuf(mBufArray[index], time);
+	}
+
+	bool continueCapture = onPacketArrives(rawPackets, numOfPackets, this, onPacketArrivesUserCookie);
+
+	for (uint32_t index = 0; index < numOfPackets; ++index)
+	{
+		rawPackets[index].releaseMBuf();
+	}
+
+	return continueCapture;
+}
+
+uint16_t KniDevice::pollPackets(OnKniPacketArriveCallback onPacketArrives, void* onPacketArrivesUserCookie)
+{
+	if (unlikely(!m_DeviceOpened))
+	{
+		LOG_ERROR("KNI device \"%s\" is not opened", m_DeviceInfo.name.c_str());
+		return 0;
+	}
+	if (unlikely(m_Capturing.isRunning()))
+	{
+		LOG_ERROR(
+			"KNI device \"%s\" capture mode is currently running. "
+			"Cannot poll packets in parallel",
+			m_DeviceInfo.name.c_str()
+		);
+		return 0;
+	}
+	if (unlikely(onPacketArrives == NULL))
+	{
+		LOG_ERROR("Attempt to poll KNI device \"%s\" without callback", m_DeviceInfo.name.c_str());
+		return 0;
+	}
+
+	struct rte_mbuf* mBufArray[MAX_BURST_SIZE];
+	uint32_t numOfPktsReceived = rte_kni_rx_burst(m_Device, mBufArray, MAX_BURST_SIZE);
+	if (numOfPktsReceived == 0)
+		return 0;
+
+	MBufRawPacket rawPackets[MAX_BURST_SIZE];
+	dispatchBurst(mBufArray, numOfPktsReceived, rawPackets, TimestampClock::now(), onPacketArrives, onPacketArrivesUserCookie);
+	return (uint16_t)numOfPktsReceived;
+}
+
 void KniDevice::KniCapturing::cleanup()
 {
 	if (thread)
@@ -936,6 +984,7 @@ int KniDevice::startCaptureBlockingMode(
 	}
 
 	struct rte_mbuf* mBufArray[MAX_BURST_SIZE];
+	MBufRawPacket rawPackets[MAX_BURST_SIZE];
 
 	if (timeout <= 0)
 	{
@@ -944,16 +993,8 @@ int KniDevice::startCaptureBlockingMode(
 			uint32_t numOfPktsReceived = rte_kni_rx_burst(m_Device, mBufArray, MAX_BURST_SIZE);
 			if (likely(numOfPktsReceived != 0))
 			{
-				MBufRawPacket rawPackets[MAX_BURST_SIZE];
-				timeval time;
-				gettimeofday(&time, NULL);
-
-				for (uint32_t index = 0; index < numOfPktsReceived; ++index)
-				{
-					rawPackets[index].setMBuf(mBufArray[index], time);
-				}
-
-				if (!m_Capturing.callback(rawPackets, numOfPktsReceived, this, m_Capturing.userCookie))
+				timespec time = TimestampClock::now();
+				if (!dispatchBurst(mBufArray, numOfPktsReceived, rawPackets, time, m_Capturing.callback, m_Capturing.userCookie))
 					return 1;
 			}
 		}
@@ -970,17 +1011,11 @@ int KniDevice::startCaptureBlockingMode(
 			uint32_t numOfPktsReceived = rte_kni_rx_burst(m_Device, mBufArray, MAX_BURST_SIZE);
 			if (likely(numOfPktsReceived != 0))
 			{
-				MBufRawPacket rawPackets[MAX_BURST_SIZE];
-				timeval time;
+				timespec time;
 				time.tv_sec = curTimeSec;
-				time.tv_usec = curTimeNSec / 1000;
-
-				for (uint32_t index = 0; index < numOfPktsReceived; ++index)
-				{
-					rawPackets[index].setMBuf(mBufArray[index], time);
-				}
+				time.tv_nsec = curTimeNSec;
 
-				if (!m_Capturing.callback(rawPackets, numOfPktsReceived, this, m_Capturing.userCookie))
+				if (!dispatchBurst(mBufArray, numOfPktsReceived, rawPackets, time, m_Capturing.callback, m_Capturing.userCookie))
 					return 1;
 			}
 		}
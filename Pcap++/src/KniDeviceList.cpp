@@ -4,6 +4,8 @@
 
 #include <inttypes.h>
 #include <algorithm>
+#include <sched.h>
+#include <string.h>
 
 #include "KniDeviceList.h"
 #include "Logger.h"
@@ -41,8 +43,11 @@ static inline bool checkKniDriver()
 
 KniDeviceList::KniDeviceList() :
 	m_Devices(),
-	m_Initialized(true), m_KniUniqueId(0)
+	m_Initialized(true), m_KniUniqueId(0),
+	m_RequestThread(), m_RequestThreadRunning(false), m_StopRequestThread(false)
 {
+	m_RequestThreadSleepTime.tv_sec = 0;
+	m_RequestThreadSleepTime.tv_nsec = 0;
 	m_Devices.reserve(MAX_KNI_DEVICES);
 	if (!checkKniDriver())
 	{
@@ -67,6 +72,7 @@ KniDeviceList::KniDeviceList() :
 
 KniDeviceList::~KniDeviceList()
 {
+	stopRequestHandlerThread();
 	for (size_t i = 0; i < m_Devices.size(); ++i)
 		delete m_Devices[i];
 	rte_kni_close();
@@ -151,6 +157,84 @@ KniDevice* KniDeviceList::getDeviceByName(const std::string& name)
 	return kniDevice = NULL;
 }
 
+void* KniDeviceList::runRequests(void* listPointer)
+{
+	KniDeviceList* list = (KniDeviceList*)listPointer;
+	while (!list->m_StopRequestThread)
+	{
+		for (size_t i = 0; i < list->m_Devices.size(); ++i)
+		{
+			KniDevice* kniDevice = list->m_Devices[i];
+			// devices with their own request thread are served by it
+			if (kniDevice->m_Requests.thread == NULL)
+				rte_kni_handle_request(kniDevice->m_Device);
+		}
+		nanosleep(&list->m_RequestThreadSleepTime, NULL);
+	}
+	return NULL;
+}
+
+bool KniDeviceList::startRequestHandlerThread(long sleepSeconds, long sleepNanoSeconds, int coreId, bool lowPriority)
+{
+	if (!isInitialized())
+		return false;
+	if (m_RequestThreadRunning)
+	{
+		LOG_ERROR("KNI request thread of the device list is already started");
+		return false;
+	}
+	if (coreId >= CPU_SETSIZE)
+	{
+		LOG_ERROR("Core ID %d is out of range", coreId);
+		return false;
+	}
+	m_RequestThreadSleepTime.tv_sec = sleepSeconds;
+	m_RequestThreadSleepTime.tv_nsec = sleepNanoSeconds;
+	m_StopRequestThread = false;
+	int err = pthread_create(&m_RequestThread, NULL, runRequests, (void*)this);
+	if (err != 0)
+	{
+		const char* errs = strerror(err);
+		LOG_ERROR("KNI can't start pthread. pthread_create returned an error: %s", errs);
+		return false;
+	}
+	m_RequestThreadRunning = true;
+
+	// binding and scheduling only affect how the requests are served, so a failure isn't fatal
+	if (coreId >= 0)
+	{
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(coreId, &cpuSet);
+		err = pthread_setaffinity_np(m_RequestThread, sizeof(cpuSet), &cpuSet);
+		if (err != 0)
+			LOG_ERROR("KNI can't bind request thread to core %d. pthread_setaffinity_np returned an error: %s", coreId, strerror(err));
+	}
+	if (lowPriority)
+	{
+		struct sched_param schedParam;
+		memset(&schedParam, 0, sizeof(schedParam));
+		err = pthread_setschedparam(m_RequestThread, SCHED_IDLE, &schedParam);
+		if (err != 0)
+			LOG_DEBUG("KNI can't set SCHED_IDLE policy for request thread. pthread_setschedparam returned an error: %s", strerror(err));
+	}
+	return true;
+}
+
+void KniDeviceList::stopRequestHandlerThread()
+{
+	if (!m_RequestThreadRunning)
+	{
+		LOG_DEBUG("Attempt to stop not running KNI request thread of the device list");
+		return;
+	}
+	m_StopRequestThread = true;
+	int err = pthread_join(m_RequestThread, NULL);
+	if (err != 0)
+		LOG_DEBUG("KNI failed to join pthread. pthread_join returned an error: %s", strerror(err));
+	m_RequestThreadRunning = false;
+}
+
 KniDeviceList::KniCallbackVersion KniDeviceList::callbackVersion()
 {
 	#if RTE_VERSION >= RTE_VERSION_NUM(17, 11, 0, 0)
@@ -179,5 +263,63 @@ bool KniDeviceList::isCallbackSupported(const KniCallbackType cbType)
 	}
 	return false;
 }
+
+/**
+ * =====================
+ * Class KniWorkerThread
+ * =====================
+ */
+
+KniWorkerThread::KniWorkerThread(const std::vector<KniDevice*>& devices, OnKniPacketArriveCallback onPacketArrives,
+	void* onPacketArrivesUserCookie, uint32_t loopsPerRequestCheck) :
+	m_Devices(devices), m_OnPacketArrives(onPacketArrives), m_OnPacketArrivesUserCookie(onPacketArrivesUserCookie),
+	m_LoopsPerRequestCheck(loopsPerRequestCheck), m_CoreId(MAX_NUM_OF_CORES+1), m_Stop(true), m_NumOfPacketsReceived(0)
+{
+}
+
+bool KniWorkerThread::run(uint32_t coreId)
+{
+	m_CoreId = coreId;
+	m_Stop = false;
+	if (m_OnPacketArrives == NULL)
+	{
+		LOG_ERROR("Packet arrive callback is NULL");
+		return false;
+	}
+	for (size_t i = 0; i < m_Devices.size(); ++i)
+	{
+		if (m_Devices[i] == NULL || !m_Devices[i]->isOpened())
+		{
+			LOG_ERROR("KNI device #%d of worker on core %d is NULL or not opened", (int)i, (int)coreId);
+			return false;
+		}
+	}
+
+	uint32_t loopsSinceRequestCheck = 0;
+	while (!m_Stop)
+	{
+		for (size_t i = 0; i < m_Devices.size(); ++i)
+			m_NumOfPacketsReceived += m_Devices[i]->pollPackets(m_OnPacketArrives, m_OnPacketArrivesUserCookie);
+
+		if (m_LoopsPerRequestCheck != 0 && ++loopsSinceRequestCheck >= m_LoopsPerRequestCheck)
+		{
+			loopsSinceRequestCheck = 0;
+			for (size_t i = 0; i < m_Devices.size(); ++i)
+				m_Devices[i]->handleRequests();
+		}
+	}
+	return true;
+}
+
+void KniWorkerThread::stop()
+{
+	m_Stop = true;
+}
+
+uint32_t KniWorkerThread::getCoreId()
+{
+	return m_CoreId;
+}
+
 } // namespace pcpp
 #endif /* defined(USE_DPDK) && defined(LINUX) */
\ No newline at end of file
@@ -8,11 +8,18 @@
 #include "rte_mbuf.h"
 #include "rte_mempool.h"
 #include "rte_errno.h"
+#include "rte_version.h"
 
 #include "MBufRawPacket.h"
 #include "Logger.h"
 #include "DpdkDevice.h"
 #include "KniDevice.h"
+#include "TimestampClock.h"
+#include "IPv4Layer.h"
+#include "IPv6Layer.h"
+#include "TcpLayer.h"
+#include "UdpLayer.h"
+#include "IpUtils.h"
 
 #include <string>
 #include <stdint.h>
@@ -22,6 +29,59 @@
 #	define MBUF_DATA_SIZE_DEFINE RTE_MBUF_DEFAULT_DATAROOM
 #endif
 
+// the maximum number of mbufs releaseMBufs() frees at once
+#define MAX_BULK_FREE_SIZE 64
+
+// the offload flags are used as they're defined since DPDK 18.11, in which DpdkDevice can enable hardware offloads
+#if (RTE_VER_YEAR > 18) || (RTE_VER_YEAR == 18 && RTE_VER_MONTH >= 11)
+#define DPDK_OFFLOADS_SUPPORTED
+// the flags were renamed in DPDK 21.11
+#ifdef RTE_MBUF_F_RX_IP_CKSUM_MASK
+#	define MBUF_RX_IP_CKSUM_MASK RTE_MBUF_F_RX_IP_CKSUM_MASK
+#	define MBUF_RX_IP_CKSUM_GOOD RTE_MBUF_F_RX_IP_CKSUM_GOOD
+#	define MBUF_RX_IP_CKSUM_BAD RTE_MBUF_F_RX_IP_CKSUM_BAD
+#	define MBUF_RX_IP_CKSUM_NONE RTE_MBUF_F_RX_IP_CKSUM_NONE
+#	define MBUF_RX_L4_CKSUM_MASK RTE_MBUF_F_RX_L4_CKSUM_MASK
+#	define MBUF_RX_L4_CKSUM_GOOD RTE_MBUF_F_RX_L4_CKSUM_GOOD
+#	define MBUF_RX_L4_CKSUM_BAD RTE_MBUF_F_RX_L4_CKSUM_BAD
+#	define MBUF_RX_L4_CKSUM_NONE RTE_MBUF_F_RX_L4_CKSUM_NONE
+#	define MBUF_RX_VLAN_STRIPPED RTE_MBUF_F_RX_VLAN_STRIPPED
+#	define MBUF_TX_IPV4 RTE_MBUF_F_TX_IPV4
+#	define MBUF_TX_IPV6 RTE_MBUF_F_TX_IPV6
+#	define MBUF_TX_IP_CKSUM RTE_MBUF_F_TX_IP_CKSUM
+#	define MBUF_TX_L4_MASK RTE_MBUF_F_TX_L4_MASK
+#	define MBUF_TX_TCP_CKSUM RTE_MBUF_F_TX_TCP_CKSUM
+#	define MBUF_TX_UDP_CKSUM RTE_MBUF_F_TX_UDP_CKSUM
+#	define MBUF_TX_TCP_SEG RTE_MBUF_F_TX_TCP_SEG
+#	define MBUF_TX_VLAN RTE_MBUF_F_TX_VLAN
+#	define MBUF_TX_OFFLOAD_MASK RTE_MBUF_F_TX_OFFLOAD_MASK
+#else
+#	define MBUF_RX_IP_CKSUM_MASK PKT_RX_IP_CKSUM_MASK
+#	define MBUF_RX_IP_CKSUM_GOOD PKT_RX_IP_CKSUM_GOOD
+#	define MBUF_RX_IP_CKSUM_BAD PKT_RX_IP_CKSUM_BAD
+#	define MBUF_RX_IP_CKSUM_NONE PKT_RX_IP_CKSUM_NONE
+#	define MBUF_RX_L4_CKSUM_MASK PKT_RX_L4_CKSUM_MASK
+#	define MBUF_RX_L4_CKSUM_GOOD PKT_RX_L4_CKSUM_GOOD
+#	define MBUF_RX_L4_CKSUM_BAD PKT_RX_L4_CKSUM_BAD
+#	define MBUF_RX_L4_CKSUM_NONE PKT_RX_L4_CKSUM_NONE
+#	define MBUF_RX_VLAN_STRIPPED PKT_RX_VLAN_STRIPPED
+#	define MBUF_TX_IPV4 PKT_TX_IPV4
+#	define MBUF_TX_IPV6 PKT_TX_IPV6
+#	define MBUF_TX_IP_CKSUM PKT_TX_IP_CKSUM
+#	define MBUF_TX_L4_MASK PKT_TX_L4_MASK
+#	define MBUF_TX_TCP_CKSUM PKT_TX_TCP_CKSUM
+#	define MBUF_TX_UDP_CKSUM PKT_TX_UDP_CKSUM
+#	define MBUF_TX_TCP_SEG PKT_TX_TCP_SEG
+#	define MBUF_TX_VLAN PKT_TX_VLAN_PKT
+#	define MBUF_TX_OFFLOAD_MASK PKT_TX_OFFLOAD_MASK
+#endif
+// the RX timestamp moved from an mbuf field to a dynamic field in DPDK 20.11
+#if (RTE_VER_YEAR > 20) || (RTE_VER_YEAR == 20 && RTE_VER_MONTH >= 11)
+#define DPDK_MBUF_DYNFIELD_RX_TIMESTAMP
+#include "rte_mbuf_dyn.h"
+#endif
+#endif
+
 namespace pcpp
 {
 
@@ -39,6 +99,8 @@ MBufRawPacket::~MBufRawPacket()
 	{
 		rte_pktmbuf_free(m_MBuf);
 	}
+
+	freeLinearizedData();
 }
 
 bool MBufRawPacket::init(struct rte_mempool* mempool)
@@ -83,6 +145,19 @@ bool MBufRawPacket::initFromRawPacket(const RawPacket* rawPacket, struct rte_mem
 
 	m_RawPacketSet = false;
 
+	// packets larger than the mbuf data room are copied to a chained mbuf
+	if (rawPacket->getRawDataLen() > (int)rte_pktmbuf_tailroom(m_MBuf))
+	{
+		if (!copyToSegments(rawPacket->getRawData(), rawPacket->getRawDataLen()))
+			return false;
+
+		updateRawDataView();
+		m_TimeStamp = rawPacket->getPacketTimeStampNs();
+		m_LinkLayerType = rawPacket->getLinkLayerType();
+		m_RawPacketSet = true;
+		return true;
+	}
+
 	// mbuf is allocated with length of 0, need to adjust it to the size of other
 	if (rte_pktmbuf_append(m_MBuf, rawPacket->getRawDataLen()) == NULL)
 	{
@@ -116,6 +191,7 @@ MBufRawPacket::MBufRawPacket(const MBufRawPacket& other)
 	m_RawPacketSet = false;
 	m_RawData = NULL;
 	m_Mempool = other.m_Mempool;
+	m_LinearizedData = NULL;
 
 	rte_mbuf* newMbuf = rte_pktmbuf_alloc(m_Mempool);
 	if (newMbuf == NULL)
@@ -146,6 +222,9 @@ MBufRawPacket& MBufRawPacket::operator=(const MBufRawPacket& other)
 		return *this;
 	}
 
+	if (!verifySingleSegment())
+		return *this;
+
 	// adjust the size of the mbuf to the new data
 	if (m_RawDataLen < other.m_RawDataLen)
 	{
@@ -173,10 +252,27 @@ MBufRawPacket& MBufRawPacket::operator=(const MBufRawPacket& other)
 
 bool MBufRawPacket::setRawData(const uint8_t* pRawData, int rawDataLen, timeval timestamp, LinkLayerType layerType, int frameLength)
 {
-	if (rawDataLen > MBUF_DATA_SIZE)
+	if (rawDataLen > getMBufDataSize() || isMultiSegment())
 	{
-		LOG_ERROR("Cannot set raw data which length is larger than mBuf max size. mBuf max length: %d; requested length: %d", MBUF_DATA_SIZE, rawDataLen);
-		return false;
+		// the data is copied to a new mbuf, which is chained if the data doesn't fit in one mbuf
+		struct rte_mempool* mempool = (m_Mempool != NULL ? m_Mempool : (m_MBuf != NULL ? m_MBuf->pool : NULL));
+		releaseMBuf();
+		if (!init(mempool) || !copyToSegments(pRawData, rawDataLen))
+		{
+			LOG_ERROR("Couldn't copy %d bytes to a new mBuf", rawDataLen);
+			delete [] pRawData;
+			return false;
+		}
+
+		updateRawDataView();
+		delete [] pRawData;
+		setPacketTimeStamp(timestamp);
+		m_RawPacketSet = true;
+		m_LinkLayerType = layerType;
+		if (frameLength > rawDataLen)
+			m_FrameLength = frameLength;
+
+		return true;
 	}
 
 	if (m_MBuf == NULL)
@@ -210,7 +306,7 @@ bool MBufRawPacket::setRawData(const uint8_t* pRawData, int rawDataLen, timeval
 	m_RawDataLen = rte_pktmbuf_pkt_len(m_MBuf);
 	memcpy(m_RawData, pRawData, m_RawDataLen);
 	delete [] pRawData;
-	m_TimeStamp = timestamp;
+	setPacketTimeStamp(timestamp);
 	m_RawPacketSet = true;
 	m_FrameLength = frameLength;
 	m_LinkLayerType = layerType;
@@ -227,6 +323,7 @@ void MBufRawPacket::clear()
 
 	m_MBuf = NULL;
 
+	freeLinearizedData();
 	m_RawData = NULL;
 
 	RawPacket::clear();
@@ -240,6 +337,9 @@ void MBufRawPacket::appendData(const uint8_t* dataToAppend, size_t dataToAppendL
 		return; //TODO: need to return false here or something
 	}
 
+	if (!verifySingleSegment())
+		return; //TODO: need to return false here or something
+
 	char* startOfNewlyAppendedData = rte_pktmbuf_append(m_MBuf, dataToAppendLen);
 	if (startOfNewlyAppendedData == NULL)
 	{
@@ -260,6 +360,29 @@ void MBufRawPacket::insertData(int atIndex, const uint8_t* dataToInsert, size_t
 		return; //TODO: need to return false here or something
 	}
 
+	if (!verifySingleSegment())
+		return; //TODO: need to return false here or something
+
+	if (rte_pktmbuf_headroom(m_MBuf) >= dataToInsertLen)
+	{
+		// prepend the space and move only the data before the index
+		uint8_t* newStart = (uint8_t*)rte_pktmbuf_prepend(m_MBuf, dataToInsertLen);
+		if (newStart == NULL)
+		{
+			LOG_ERROR("Couldn't prepend %d bytes to RawPacket", (int)dataToInsertLen);
+			return; //TODO: need to return false here or something
+		}
+
+		memmove(newStart, m_RawData, atIndex);
+		memcpy(newStart + atIndex, dataToInsert, dataToInsertLen);
+		m_RawData = newStart;
+		m_RawDataLen += dataToInsertLen;
+		m_FrameLength = m_RawDataLen;
+
+		LOG_DEBUG("Inserted %d bytes to MBufRawPacket headroom", (int)dataToInsertLen);
+		return;
+	}
+
 	char* startOfNewlyAppendedData = rte_pktmbuf_append(m_MBuf, dataToInsertLen);
 	if (startOfNewlyAppendedData == NULL)
 	{
@@ -280,6 +403,34 @@ bool MBufRawPacket::removeData(int atIndex, size_t numOfBytesToRemove)
 		return false;
 	}
 
+	if (!verifySingleSegment())
+		return false;
+
+	if ((atIndex + (int)numOfBytesToRemove) > m_RawDataLen)
+	{
+		LOG_ERROR("Remove section is out of raw packet bound");
+		return false;
+	}
+
+	if (atIndex < m_RawDataLen - atIndex - (int)numOfBytesToRemove)
+	{
+		// move the data before the removed bytes forward and return the space to the headroom
+		memmove(m_RawData + numOfBytesToRemove, m_RawData, atIndex);
+		uint8_t* newStart = (uint8_t*)rte_pktmbuf_adj(m_MBuf, numOfBytesToRemove);
+		if (newStart == NULL)
+		{
+			LOG_ERROR("Couldn't adjust the mBuf");
+			return false;
+		}
+
+		m_RawData = newStart;
+		m_RawDataLen -= numOfBytesToRemove;
+		m_FrameLength = m_RawDataLen;
+
+		LOG_DEBUG("Removed %d bytes from the beginning of MBufRawPacket", (int)numOfBytesToRemove);
+		return true;
+	}
+
 	if (!RawPacket::removeData(atIndex, numOfBytesToRemove))
 		return false;
 
@@ -302,9 +453,10 @@ bool MBufRawPacket::reallocateData(size_t newBufferLength)
 		return false;
 	}
 
-	if (newBufferLength > MBUF_DATA_SIZE)
+	int mBufDataSize = getMBufDataSize();
+	if ((int)newBufferLength > mBufDataSize)
 	{
-		LOG_ERROR("Cannot reallocate mBuf raw packet to a size larger than mBuf data. mBuf max length: %d; requested length: %d", MBUF_DATA_SIZE, (int)newBufferLength);
+		LOG_ERROR("Cannot reallocate mBuf raw packet to a size larger than mBuf data. mBuf max length: %d; requested length: %d", mBufDataSize, (int)newBufferLength);
 		return false;
 	}
 
@@ -313,7 +465,45 @@ bool MBufRawPacket::reallocateData(size_t newBufferLength)
 	return true;
 }
 
-void MBufRawPacket::setMBuf(struct rte_mbuf* mBuf, timeval timestamp)
+size_t MBufRawPacket::getHeadroom() const
+{
+	if (m_MBuf == NULL)
+		return 0;
+
+	return rte_pktmbuf_headroom(m_MBuf);
+}
+
+bool MBufRawPacket::reserveHeadroom(size_t headroom, size_t newBufferLength)
+{
+	if (m_MBuf == NULL)
+	{
+		LOG_ERROR("MBufRawPacket not initialized. Please call the init() method");
+		return false;
+	}
+
+	size_t curHeadroom = rte_pktmbuf_headroom(m_MBuf);
+	if (headroom <= curHeadroom)
+		return true;
+
+	if ((int)newBufferLength < m_RawDataLen)
+		newBufferLength = m_RawDataLen;
+
+	// the data can be moved only inside the first (and only) segment
+	if (m_MBuf->nb_segs != 1 || headroom + newBufferLength > curHeadroom + rte_pktmbuf_data_len(m_MBuf) + rte_pktmbuf_tailroom(m_MBuf))
+	{
+		LOG_ERROR("Cannot reserve %d bytes of headroom - not enough room in mBuf", (int)headroom);
+		return false;
+	}
+
+	uint8_t* newStart = (uint8_t*)m_MBuf->buf_addr + headroom;
+	memmove(newStart, m_RawData, m_RawDataLen);
+	m_MBuf->data_off = (uint16_t)headroom;
+	m_RawData = newStart;
+
+	return true;
+}
+
+void MBufRawPacket::setMBuf(struct rte_mbuf* mBuf, timespec timestamp)
 {
 	if (m_MBuf != NULL && m_FreeMbuf)
 		rte_pktmbuf_free(m_MBuf);
@@ -325,7 +515,623 @@ void MBufRawPacket::setMBuf(struct rte_mbuf* mBuf, timeval timestamp)
 	}
 
 	m_MBuf = mBuf;
-	RawPacket::setRawData(rte_pktmbuf_mtod(mBuf, const uint8_t*), rte_pktmbuf_pkt_len(mBuf), timestamp, LINKTYPE_ETHERNET);
+	freeLinearizedData();
+	// the raw data of a chained mbuf covers only its first segment
+	RawPacket::setRawData(rte_pktmbuf_mtod(mBuf, const uint8_t*), rte_pktmbuf_data_len(mBuf), TimestampClock::toTimeval(timestamp), LINKTYPE_ETHERNET, rte_pktmbuf_pkt_len(mBuf));
+	m_TimeStamp = timestamp;
+}
+
+bool MBufRawPacket::getFlowMark(uint32_t& mark) const
+{
+	// the flag was renamed in DPDK 21.11
+#ifdef RTE_MBUF_F_RX_FDIR_ID
+	uint64_t markFlag = RTE_MBUF_F_RX_FDIR_ID;
+#else
+	uint64_t markFlag = PKT_RX_FDIR_ID;
+#endif
+
+	if (m_MBuf == NULL || (m_MBuf->ol_flags & markFlag) == 0)
+		return false;
+
+	mark = m_MBuf->hash.fdir.hi;
+	return true;
+}
+
+uint64_t MBufRawPacket::getOffloadFlags() const
+{
+	if (m_MBuf == NULL)
+		return 0;
+
+	return m_MBuf->ol_flags;
+}
+
+void MBufRawPacket::setOffloadFlags(uint64_t flags)
+{
+	if (m_MBuf == NULL)
+	{
+		LOG_ERROR("MBufRawPacket not initialized. Please call the init() method");
+		return;
+	}
+
+	m_MBuf->ol_flags = flags;
+}
+
+MBufRawPacket::RxChecksumStatus MBufRawPacket::getRxIPChecksumStatus() const
+{
+#ifdef DPDK_OFFLOADS_SUPPORTED
+	if (m_MBuf == NULL)
+		return RxChecksumUnknown;
+
+	uint64_t status = m_MBuf->ol_flags & MBUF_RX_IP_CKSUM_MASK;
+	if (status == MBUF_RX_IP_CKSUM_GOOD)
+		return RxChecksumGood;
+	if (status == MBUF_RX_IP_CKSUM_BAD)
+		return RxChecksumBad;
+	if (status == MBUF_RX_IP_CKSUM_NONE)
+		return RxChecksumNone;
+#endif
+
+	return RxChecksumUnknown;
+}
+
+MBufRawPacket::RxChecksumStatus MBufRawPacket::getRxL4ChecksumStatus() const
+{
+#ifdef DPDK_OFFLOADS_SUPPORTED
+	if (m_MBuf == NULL)
+		return RxChecksumUnknown;
+
+	uint64_t status = m_MBuf->ol_flags & MBUF_RX_L4_CKSUM_MASK;
+	if (status == MBUF_RX_L4_CKSUM_GOOD)
+		return RxChecksumGood;
+	if (status == MBUF_RX_L4_CKSUM_BAD)
+		return RxChecksumBad;
+	if (status == MBUF_RX_L4_CKSUM_NONE)
+		return RxChecksumNone;
+#endif
+
+	return RxChecksumUnknown;
+}
+
+static ChecksumVerifier::ChecksumHint rxChecksumStatusToHint(MBufRawPacket::RxChecksumStatus status)
+{
+	switch (status)
+	{
+	case MBufRawPacket::RxChecksumGood:
+	case MBufRawPacket::RxChecksumNone:
+		return ChecksumVerifier::ChecksumHintGood;
+	case MBufRawPacket::RxChecksumBad:
+		return ChecksumVerifier::ChecksumHintBad;
+	default:
+		return ChecksumVerifier::ChecksumHintUnknown;
+	}
+}
+
+size_t MBufRawPacket::loadChecksumVerifier(ChecksumVerifier& verifier, MBufRawPacket* const* packets, size_t count)
+{
+	RawPacket* rawPackets[ChecksumVerifier::MaxBurstSize];
+	if (count > ChecksumVerifier::MaxBurstSize)
+		count = ChecksumVerifier::MaxBurstSize;
+
+	for (size_t i = 0; i < count; i++)
+		rawPackets[i] = packets[i];
+
+	count = verifier.load(rawPackets, count);
+	for (size_t i = 0; i < count; i++)
+		verifier.setHints(i, rxChecksumStatusToHint(packets[i]->getRxIPChecksumStatus()), rxChecksumStatusToHint(packets[i]->getRxL4ChecksumStatus()));
+
+	return count;
+}
+
+bool MBufRawPacket::getRxStrippedVlan(uint16_t& vlanTci) const
+{
+#ifdef DPDK_OFFLOADS_SUPPORTED
+	if (m_MBuf == NULL || (m_MBuf->ol_flags & MBUF_RX_VLAN_STRIPPED) == 0)
+		return false;
+
+	vlanTci = m_MBuf->vlan_tci;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool MBufRawPacket::getRxHardwareTimestamp(uint64_t& timestamp) const
+{
+#ifdef DPDK_OFFLOADS_SUPPORTED
+	if (m_MBuf == NULL)
+		return false;
+
+#ifdef DPDK_MBUF_DYNFIELD_RX_TIMESTAMP
+	// the PMD registers the timestamp field when the offload is enabled, look it up until it's found
+	static int timestampOffset = -1;
+	static uint64_t timestampFlag = 0;
+	if (timestampOffset < 0)
+	{
+		int flagBit = rte_mbuf_dynflag_lookup(RTE_MBUF_DYNFLAG_RX_TIMESTAMP_NAME, NULL);
+		if (flagBit < 0)
+			return false;
+
+		timestampFlag = (1ULL << flagBit);
+		timestampOffset = rte_mbuf_dynfield_lookup(RTE_MBUF_DYNFIELD_TIMESTAMP_NAME, NULL);
+		if (timestampOffset < 0)
+			return false;
+	}
+
+	if ((m_MBuf->ol_flags & timestampFlag) == 0)
+		return false;
+
+	timestamp = *RTE_MBUF_DYNFIELD(m_MBuf, timestampOffset, uint64_t*);
+#else
+	if ((m_MBuf->ol_flags & PKT_RX_TIMESTAMP) == 0)
+		return false;
+
+	timestamp = m_MBuf->timestamp;
+#endif
+	return true;
+#else
+	return false;
+#endif
+}
+
+#ifdef DPDK_OFFLOADS_SUPPORTED
+// the sum of the TCP/UDP pseudo header, which the NIC expects in the checksum field when it computes the checksum. When the packet is
+// segmented by the NIC the length isn't included
+static uint16_t computePseudoHeaderSum(Layer* ipLayer, bool isIPv4, uint8_t protocol, uint16_t l4Length)
+{
+	uint16_t pseudoHeader[18];
+	ScalarBuffer<uint16_t> vec;
+	vec.buffer = pseudoHeader;
+
+	if (isIPv4)
+	{
+		iphdr* ipHdr = ((IPv4Layer*)ipLayer)->getIPv4Header();
+		memcpy(pseudoHeader, &ipHdr->ipSrc, 4);
+		memcpy(pseudoHeader + 2, &ipHdr->ipDst, 4);
+		pseudoHeader[4] = htons(l4Length);
+		pseudoHeader[5] = htons((uint16_t)protocol);
+		vec.len = 12;
+	}
+	else
+	{
+		ip6_hdr* ipHdr = ((IPv6Layer*)ipLayer)->getIPv6Header();
+		memcpy(pseudoHeader, ipHdr->ipSrc, 16);
+		memcpy(pseudoHeader + 8, ipHdr->ipDst, 16);
+		pseudoHeader[16] = htons(l4Length);
+		pseudoHeader[17] = htons((uint16_t)protocol);
+		vec.len = 36;
+	}
+
+	// compute_checksum() returns the complement of the sum
+	return (uint16_t)~compute_checksum(&vec, 1);
+}
+
+static bool requestTxOffloads(MBufRawPacket* rawPacket, bool ipChecksum, bool l4Checksum, uint16_t segmentSize)
+{
+	struct rte_mbuf* mBuf = rawPacket->getMBuf();
+	if (mBuf == NULL)
+	{
+		LOG_ERROR("MBufRawPacket not initialized. Please call the init() method");
+		return false;
+	}
+
+	Packet packet(rawPacket, false, UnknownProtocol, OsiModelTransportLayer);
+
+	bool isIPv4 = true;
+	Layer* ipLayer = packet.getLayerOfType<IPv4Layer>();
+	if (ipLayer == NULL)
+	{
+		isIPv4 = false;
+		ipLayer = packet.getLayerOfType<IPv6Layer>();
+	}
+
+	if (ipLayer == NULL)
+	{
+		LOG_ERROR("Cannot offload checksums of a packet which isn't IPv4 or IPv6");
+		return false;
+	}
+
+	bool isTso = (segmentSize > 0);
+	TcpLayer* tcpLayer = packet.getLayerOfType<TcpLayer>();
+	UdpLayer* udpLayer = (isTso ? NULL : packet.getLayerOfType<UdpLayer>());
+	Layer* l4Layer = (tcpLayer != NULL ? (Layer*)tcpLayer : (Layer*)udpLayer);
+	if ((l4Checksum || isTso) && l4Layer == NULL)
+	{
+		LOG_ERROR("Cannot offload the L4 checksum or segmentation of a packet which isn't %s", (isTso ? "TCP" : "TCP or UDP"));
+		return false;
+	}
+
+	uint64_t flags = mBuf->ol_flags & ~(MBUF_TX_IPV4 | MBUF_TX_IPV6 | MBUF_TX_IP_CKSUM | MBUF_TX_L4_MASK | MBUF_TX_TCP_SEG);
+	mBuf->l2_len = ipLayer->getData() - rawPacket->getRawData();
+	mBuf->l3_len = (l4Layer != NULL ? l4Layer->getData() - ipLayer->getData() : ipLayer->getHeaderLen());
+	flags |= (isIPv4 ? MBUF_TX_IPV4 : MBUF_TX_IPV6);
+
+	// the NIC computes the IPv4 header checksum over a zero checksum field
+	if (isIPv4 && (ipChecksum || isTso))
+	{
+		flags |= MBUF_TX_IP_CKSUM;
+		((IPv4Layer*)ipLayer)->getIPv4Header()->headerChecksum = 0;
+	}
+
+	if (isTso)
+	{
+		flags |= MBUF_TX_TCP_SEG;
+		mBuf->l4_len = tcpLayer->getHeaderLen();
+		mBuf->tso_segsz = segmentSize;
+		tcpLayer->getTcpHeader()->headerChecksum = htons(computePseudoHeaderSum(ipLayer, isIPv4, PACKETPP_IPPROTO_TCP, 0));
+	}
+	else if (l4Checksum && tcpLayer != NULL)
+	{
+		flags |= MBUF_TX_TCP_CKSUM;
+		tcpLayer->getTcpHeader()->headerChecksum = htons(computePseudoHeaderSum(ipLayer, isIPv4, PACKETPP_IPPROTO_TCP, (uint16_t)tcpLayer->getDataLen()));
+	}
+	else if (l4Checksum)
+	{
+		flags |= MBUF_TX_UDP_CKSUM;
+		udpLayer->getUdpHeader()->headerChecksum = htons(computePseudoHeaderSum(ipLayer, isIPv4, PACKETPP_IPPROTO_UDP, (uint16_t)udpLayer->getDataLen()));
+	}
+
+	mBuf->ol_flags = flags;
+	return true;
+}
+#endif
+
+bool MBufRawPacket::setTxChecksumOffload(bool ipChecksum, bool l4Checksum)
+{
+#ifdef DPDK_OFFLOADS_SUPPORTED
+	return requestTxOffloads(this, ipChecksum, l4Checksum, 0);
+#else
+	LOG_ERROR("Hardware offloads require DPDK 18.11 or later");
+	return false;
+#endif
+}
+
+bool MBufRawPacket::setTxTcpSegmentation(uint16_t segmentSize)
+{
+	if (segmentSize == 0)
+	{
+		LOG_ERROR("Segment size must be larger than 0");
+		return false;
+	}
+
+#ifdef DPDK_OFFLOADS_SUPPORTED
+	return requestTxOffloads(this, true, true, segmentSize);
+#else
+	LOG_ERROR("Hardware offloads require DPDK 18.11 or later");
+	return false;
+#endif
+}
+
+bool MBufRawPacket::setTxVlanInsert(uint16_t vlanTci)
+{
+#ifdef DPDK_OFFLOADS_SUPPORTED
+	if (m_MBuf == NULL)
+	{
+		LOG_ERROR("MBufRawPacket not initialized. Please call the init() method");
+		return false;
+	}
+
+	m_MBuf->vlan_tci = vlanTci;
+	m_MBuf->ol_flags |= MBUF_TX_VLAN;
+	return true;
+#else
+	LOG_ERROR("Hardware offloads require DPDK 18.11 or later");
+	return false;
+#endif
+}
+
+void MBufRawPacket::clearTxOffloads()
+{
+#ifdef DPDK_OFFLOADS_SUPPORTED
+	if (m_MBuf != NULL)
+		m_MBuf->ol_flags &= ~MBUF_TX_OFFLOAD_MASK;
+#endif
+}
+
+void MBufRawPacket::releaseMBuf()
+{
+	if (m_MBuf != NULL && m_FreeMbuf)
+		rte_pktmbuf_free(m_MBuf);
+
+	m_MBuf = NULL;
+	m_FreeMbuf = true;
+	freeLinearizedData();
+}
+
+void MBufRawPacket::releaseMBufs(MBufRawPacket* packets, uint32_t count)
+{
+	struct rte_mbuf* mBufs[MAX_BULK_FREE_SIZE];
+	uint32_t numOfMBufs = 0;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		MBufRawPacket& packet = packets[i];
+		if (packet.m_MBuf != NULL && packet.m_FreeMbuf)
+		{
+			mBufs[numOfMBufs++] = packet.m_MBuf;
+			if (numOfMBufs == MAX_BULK_FREE_SIZE)
+			{
+				freeMBufs(mBufs, numOfMBufs);
+				numOfMBufs = 0;
+			}
+		}
+
+		packet.m_MBuf = NULL;
+		packet.m_FreeMbuf = true;
+		packet.freeLinearizedData();
+	}
+
+	freeMBufs(mBufs, numOfMBufs);
+}
+
+struct rte_mbuf* MBufRawPacket::detachMBuf()
+{
+	if (m_MBuf == NULL)
+		return NULL;
+
+	if (!m_FreeMbuf)
+	{
+		LOG_ERROR("The mbuf isn't owned by the packet, so it can't be detached");
+		return NULL;
+	}
+
+	// clear() doesn't free the mbuf once it's detached
+	struct rte_mbuf* mBuf = m_MBuf;
+	m_MBuf = NULL;
+	clear();
+	return mBuf;
+}
+
+struct rte_mbuf* MBufRawPacket::retainMBuf()
+{
+	if (m_MBuf == NULL)
+		return NULL;
+
+	// rte_pktmbuf_free() decrements the reference count of each segment, so all of them get the new reference
+	for (struct rte_mbuf* segment = m_MBuf; segment != NULL; segment = segment->next)
+		rte_mbuf_refcnt_update(segment, 1);
+
+	return m_MBuf;
+}
+
+bool MBufRawPacket::attachMBuf(struct rte_mbuf* mBuf, const timespec& timestamp)
+{
+	if (mBuf == NULL)
+	{
+		LOG_ERROR("mbuf to attach is NULL");
+		return false;
+	}
+
+	setMBuf(mBuf, timestamp);
+	m_FreeMbuf = true;
+	return true;
+}
+
+uint32_t MBufRawPacket::detachMBufs(MBufRawPacket* packets, uint32_t count, struct rte_mbuf** mBufs)
+{
+	uint32_t numOfDetached = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (packets[i].m_MBuf == NULL || !packets[i].m_FreeMbuf)
+			continue;
+
+		mBufs[numOfDetached++] = packets[i].detachMBuf();
+	}
+
+	return numOfDetached;
+}
+
+void MBufRawPacket::freeMBufs(struct rte_mbuf** mBufs, uint32_t count)
+{
+#if (RTE_VER_YEAR > 19) || (RTE_VER_YEAR == 19 && RTE_VER_MONTH >= 11)
+	rte_pktmbuf_free_bulk(mBufs, count);
+#else
+	for (uint32_t i = 0; i < count; i++)
+		rte_pktmbuf_free(mBufs[i]);
+#endif
+}
+
+int MBufRawPacket::getMBufDataSize() const
+{
+	struct rte_mempool* mempool = (m_MBuf != NULL ? m_MBuf->pool : m_Mempool);
+	if (mempool == NULL)
+		return MBUF_DATA_SIZE;
+
+	return (int)rte_pktmbuf_data_room_size(mempool) - RTE_PKTMBUF_HEADROOM;
+}
+
+void MBufRawPacket::freeLinearizedData()
+{
+	if (m_LinearizedData == NULL)
+		return;
+
+	if (m_RawData == m_LinearizedData)
+	{
+		m_RawData = NULL;
+		m_RawDataLen = 0;
+	}
+
+	delete [] m_LinearizedData;
+	m_LinearizedData = NULL;
+}
+
+void MBufRawPacket::updateRawDataView()
+{
+	freeLinearizedData();
+	m_RawData = rte_pktmbuf_mtod(m_MBuf, uint8_t*);
+	m_RawDataLen = rte_pktmbuf_data_len(m_MBuf);
+	m_FrameLength = rte_pktmbuf_pkt_len(m_MBuf);
+}
+
+bool MBufRawPacket::verifySingleSegment() const
+{
+	if (m_MBuf != NULL && m_MBuf->nb_segs != 1)
+	{
+		LOG_ERROR("Changing the data of a chained mBuf isn't supported");
+		return false;
+	}
+
+	return true;
+}
+
+bool MBufRawPacket::copyToSegments(const uint8_t* data, size_t dataLen)
+{
+	struct rte_mbuf* segment = m_MBuf;
+	size_t offset = 0;
+	while (true)
+	{
+		size_t segmentLen = dataLen - offset;
+		if (segmentLen > rte_pktmbuf_tailroom(segment))
+			segmentLen = rte_pktmbuf_tailroom(segment);
+
+		char* segmentData = rte_pktmbuf_append(segment, (uint16_t)segmentLen);
+		if (segmentData == NULL)
+		{
+			LOG_ERROR("Couldn't append %d bytes to mBuf segment", (int)segmentLen);
+			if (segment != m_MBuf)
+				rte_pktmbuf_free(segment);
+			return false;
+		}
+
+		memcpy(segmentData, data + offset, segmentLen);
+		offset += segmentLen;
+
+		if (segment != m_MBuf && rte_pktmbuf_chain(m_MBuf, segment) != 0)
+		{
+			LOG_ERROR("Couldn't chain another segment to mBuf, it has too many segments");
+			rte_pktmbuf_free(segment);
+			return false;
+		}
+
+		if (offset == dataLen)
+			return true;
+
+		segment = rte_pktmbuf_alloc(m_MBuf->pool);
+		if (segment == NULL)
+		{
+			LOG_ERROR("Couldn't allocate mBuf segment");
+			return false;
+		}
+	}
+}
+
+size_t MBufRawPacket::getNumOfSegments() const
+{
+	if (m_MBuf == NULL)
+		return 0;
+
+	return m_MBuf->nb_segs;
+}
+
+bool MBufRawPacket::isMultiSegment() const
+{
+	return m_MBuf != NULL && m_MBuf->nb_segs > 1;
+}
+
+size_t MBufRawPacket::getPacketLength() const
+{
+	if (m_MBuf == NULL)
+		return 0;
+
+	return rte_pktmbuf_pkt_len(m_MBuf);
+}
+
+const uint8_t* MBufRawPacket::getSegmentData(size_t segmentIndex, size_t& segmentLen) const
+{
+	struct rte_mbuf* segment = m_MBuf;
+	for (size_t i = 0; i < segmentIndex && segment != NULL; i++)
+		segment = segment->next;
+
+	if (segment == NULL)
+		return NULL;
+
+	segmentLen = rte_pktmbuf_data_len(segment);
+	return rte_pktmbuf_mtod(segment, const uint8_t*);
+}
+
+bool MBufRawPacket::linearize()
+{
+	if (m_MBuf == NULL)
+	{
+		LOG_ERROR("MBufRawPacket not initialized. Please call the init() method");
+		return false;
+	}
+
+	if (m_MBuf->nb_segs == 1 || m_LinearizedData != NULL)
+		return true;
+
+	// merging the segments into the first one is possible only if it has enough room for the whole packet
+	if (rte_pktmbuf_linearize(m_MBuf) == 0)
+	{
+		updateRawDataView();
+		LOG_DEBUG("Merged the segments of MBufRawPacket into its first segment");
+		return true;
+	}
+
+	uint32_t packetLen = rte_pktmbuf_pkt_len(m_MBuf);
+	uint8_t* linearizedData = new uint8_t[packetLen];
+	size_t offset = 0;
+	for (struct rte_mbuf* segment = m_MBuf; segment != NULL; segment = segment->next)
+	{
+		memcpy(linearizedData + offset, rte_pktmbuf_mtod(segment, const uint8_t*), rte_pktmbuf_data_len(segment));
+		offset += rte_pktmbuf_data_len(segment);
+	}
+
+	m_LinearizedData = linearizedData;
+	m_RawData = linearizedData;
+	m_RawDataLen = (int)packetLen;
+	m_FrameLength = (int)packetLen;
+
+	LOG_DEBUG("Copied %d segments of MBufRawPacket to a linear buffer", (int)m_MBuf->nb_segs);
+	return true;
+}
+
+bool MBufRawPacket::prependHeaderSegment(const uint8_t* header, size_t headerLen)
+{
+	if (m_MBuf == NULL)
+	{
+		LOG_ERROR("MBufRawPacket not initialized. Please call the init() method");
+		return false;
+	}
+
+	int mBufDataSize = getMBufDataSize();
+	if (headerLen > (size_t)mBufDataSize)
+	{
+		LOG_ERROR("Cannot prepend a header segment of %d bytes, it's larger than mBuf max size %d", (int)headerLen, mBufDataSize);
+		return false;
+	}
+
+	struct rte_mbuf* headerSegment = rte_pktmbuf_alloc(m_Mempool != NULL ? m_Mempool : m_MBuf->pool);
+	if (headerSegment == NULL)
+	{
+		LOG_ERROR("Couldn't allocate mBuf for the header segment");
+		return false;
+	}
+
+	char* headerData = rte_pktmbuf_append(headerSegment, (uint16_t)headerLen);
+	if (headerData == NULL)
+	{
+		LOG_ERROR("Couldn't append %d bytes to the header segment - not enough room in mBuf", (int)headerLen);
+		rte_pktmbuf_free(headerSegment);
+		return false;
+	}
+
+	memcpy(headerData, header, headerLen);
+
+	// the packet metadata is kept in the first segment
+	headerSegment->port = m_MBuf->port;
+
+	if (rte_pktmbuf_chain(headerSegment, m_MBuf) != 0)
+	{
+		LOG_ERROR("Couldn't chain the header segment to mBuf, it has too many segments");
+		rte_pktmbuf_free(headerSegment);
+		return false;
+	}
+
+	m_MBuf = headerSegment;
+	updateRawDataView();
+
+	LOG_DEBUG("Prepended a header segment of %d bytes to MBufRawPacket", (int)headerLen);
+	return true;
 }
 
 } // namespace pcpp
@@ -0,0 +1,370 @@
+#define LOG_MODULE PcapLogModuleMergingReaderDevice
+
+#include "MergingReaderDevice.h"
+#include "TimestampClock.h"
+#include "Logger.h"
+#include <string.h>
+#include <algorithm>
+
+namespace pcpp
+{
+
+// ~~~~~~~~~~~~~~~~~~~
+// MergingReaderDevice
+// ~~~~~~~~~~~~~~~~~~~
+
+MergingReaderDevice::MergingReaderDevice(const std::vector<IFileReaderDevice*>& inputs, size_t batchSize) : IFileReaderDevice("")
+{
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		Input* input = new Input();
+		input->reader = inputs[i];
+		input->nextPacket = 0;
+		input->endOfFile = false;
+		m_Inputs.push_back(input);
+	}
+
+	m_BatchSize = (batchSize > 0 ? batchSize : 1);
+	m_LastPacketInput = -1;
+}
+
+MergingReaderDevice::~MergingReaderDevice()
+{
+	close();
+	for (size_t i = 0; i < m_Inputs.size(); i++)
+		delete m_Inputs[i];
+}
+
+bool MergingReaderDevice::open()
+{
+	if (m_DeviceOpened)
+	{
+		LOG_DEBUG("Merging reader device already opened");
+		return true;
+	}
+
+	for (size_t i = 0; i < m_Inputs.size(); i++)
+	{
+		IFileReaderDevice* reader = m_Inputs[i]->reader;
+		if (!reader->isOpened() && !reader->open())
+		{
+			LOG_ERROR("Cannot open input #%d ('%s') of the merging reader device", (int)i, reader->getFileName().c_str());
+			for (size_t j = 0; j < m_Inputs.size(); j++)
+				m_Inputs[j]->reader->close();
+			return false;
+		}
+	}
+
+	m_Heap.clear();
+	for (size_t i = 0; i < m_Inputs.size(); i++)
+	{
+		m_Inputs[i]->batch.clear();
+		m_Inputs[i]->nextPacket = 0;
+		m_Inputs[i]->endOfFile = false;
+		pushNextPacket(i);
+	}
+
+	m_NumOfPacketsRead = 0;
+	m_LastPacketInput = -1;
+	m_DeviceOpened = true;
+	LOG_DEBUG("Merging reader device opened with %d inputs", (int)m_Inputs.size());
+	return true;
+}
+
+void MergingReaderDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	for (size_t i = 0; i < m_Inputs.size(); i++)
+	{
+		m_Inputs[i]->reader->close();
+		m_Inputs[i]->batch.clear();
+	}
+
+	m_Heap.clear();
+	m_DeviceOpened = false;
+	LOG_DEBUG("Merging reader device closed");
+}
+
+bool MergingReaderDevice::pushNextPacket(size_t inputIndex)
+{
+	Input* input = m_Inputs[inputIndex];
+	if (input->nextPacket >= input->batch.size())
+	{
+		if (input->endOfFile)
+			return false;
+
+		input->batch.clear();
+		input->nextPacket = 0;
+		if (input->reader->getNextPackets(input->batch, (int)m_BatchSize) < (int)m_BatchSize)
+			input->endOfFile = true;
+
+		if (input->batch.size() == 0)
+			return false;
+	}
+
+	HeapEntry entry;
+	entry.timestamp = TimestampClock::toNs(input->batch.at((int)input->nextPacket)->getPacketTimeStampNs());
+	entry.input = inputIndex;
+	m_Heap.push_back(entry);
+	std::push_heap(m_Heap.begin(), m_Heap.end());
+	return true;
+}
+
+bool MergingReaderDevice::getNextPacket(RawPacket& rawPacket)
+{
+	rawPacket.clear();
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Merging reader device not opened");
+		return false;
+	}
+
+	while (!m_Heap.empty())
+	{
+		std::pop_heap(m_Heap.begin(), m_Heap.end());
+		size_t inputIndex = m_Heap.back().input;
+		m_Heap.pop_back();
+
+		Input* input = m_Inputs[inputIndex];
+		const RawPacket* packet = input->batch.at((int)input->nextPacket);
+		input->nextPacket++;
+
+		bool sampled = isPacketSampled(packet->getRawData(), (uint32_t)packet->getRawDataLen(), packet->getLinkLayerType(),
+				TimestampClock::toNs(packet->getPacketTimeStampNs()));
+		bool copied = sampled && rawPacket.copyRawData(packet->getRawData(), packet->getRawDataLen(), packet->getPacketTimeStampNs(),
+				m_RawPacketPool, packet->getLinkLayerType(), packet->getFrameLength());
+
+		// the packet is copied before the batch it's in may be replaced by the next one
+		pushNextPacket(inputIndex);
+
+		if (!sampled)
+			continue;
+
+		if (!copied)
+		{
+			LOG_ERROR("Couldn't copy packet data to raw packet");
+			return false;
+		}
+
+		m_LastPacketInput = (int)inputIndex;
+		m_NumOfPacketsRead++;
+		return true;
+	}
+
+	LOG_DEBUG("All inputs of the merging reader device reached their end");
+	return false;
+}
+
+void MergingReaderDevice::getStatistics(pcap_stat& stats)
+{
+	stats.ps_recv = m_NumOfPacketsRead;
+	stats.ps_drop = 0;
+	stats.ps_ifdrop = 0;
+	for (size_t i = 0; i < m_Inputs.size(); i++)
+	{
+		pcap_stat inputStats;
+		m_Inputs[i]->reader->getStatistics(inputStats);
+		stats.ps_drop += inputStats.ps_drop;
+	}
+}
+
+bool MergingReaderDevice::setFilter(std::string filterAsString)
+{
+	for (size_t i = 0; i < m_Inputs.size(); i++)
+	{
+		if (!m_Inputs[i]->reader->setFilter(filterAsString))
+		{
+			LOG_ERROR("Couldn't set the filter on input #%d of the merging reader device", (int)i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool MergingReaderDevice::clearFilter()
+{
+	bool result = true;
+	for (size_t i = 0; i < m_Inputs.size(); i++)
+		result = m_Inputs[i]->reader->clearFilter() && result;
+
+	return result;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+// TimestampReorderMerger
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+TimestampReorderMerger::TimestampReorderMerger(int numOfSources, uint64_t reorderWindowNs, size_t maxPackets, OnMergedPacket onMergedPacket,
+		void* userCookie, RawPacketPool* pool) :
+	m_SourceTimestamps(numOfSources > 0 ? numOfSources : 0, 0), m_ReorderWindowNs(reorderWindowNs), m_MaxPackets(maxPackets > 0 ? maxPackets : 1),
+	m_OnMergedPacket(onMergedPacket), m_UserCookie(userCookie), m_Pool(pool)
+{
+	m_NextSequence = 0;
+	m_NewestTimestamp = 0;
+	m_LastReleasedTimestamp = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+TimestampReorderMerger::~TimestampReorderMerger()
+{
+	for (size_t i = 0; i < m_Heap.size(); i++)
+		delete m_Heap[i].packet;
+
+	for (size_t i = 0; i < m_FreePackets.size(); i++)
+		delete m_FreePackets[i];
+}
+
+bool TimestampReorderMerger::addBurst(int sourceId, const RawPacket* packets, int numOfPackets)
+{
+	if (sourceId < 0 || sourceId >= (int)m_SourceTimestamps.size())
+	{
+		LOG_ERROR("Invalid source ID %d", sourceId);
+		return false;
+	}
+
+	for (int i = 0; i < numOfPackets; i++)
+		addPacket(sourceId, packets[i]);
+
+	releaseReadyPackets();
+	return true;
+}
+
+bool TimestampReorderMerger::addBurst(int sourceId, RawPacket* const* packets, int numOfPackets)
+{
+	if (sourceId < 0 || sourceId >= (int)m_SourceTimestamps.size())
+	{
+		LOG_ERROR("Invalid source ID %d", sourceId);
+		return false;
+	}
+
+	for (int i = 0; i < numOfPackets; i++)
+		addPacket(sourceId, *packets[i]);
+
+	releaseReadyPackets();
+	return true;
+}
+
+bool TimestampReorderMerger::advanceSource(int sourceId, uint64_t timestampNs)
+{
+	if (sourceId < 0 || sourceId >= (int)m_SourceTimestamps.size())
+	{
+		LOG_ERROR("Invalid source ID %d", sourceId);
+		return false;
+	}
+
+	if (timestampNs > m_SourceTimestamps[sourceId])
+		m_SourceTimestamps[sourceId] = timestampNs;
+
+	releaseReadyPackets();
+	return true;
+}
+
+void TimestampReorderMerger::addPacket(int sourceId, const RawPacket& packet)
+{
+	uint64_t timestamp = TimestampClock::toNs(packet.getPacketTimeStampNs());
+	if (timestamp > m_SourceTimestamps[sourceId])
+		m_SourceTimestamps[sourceId] = timestamp;
+	if (timestamp > m_NewestTimestamp)
+		m_NewestTimestamp = timestamp;
+
+	// a packet earlier than a released packet can't be put in order anymore
+	if (m_Stats.packets > 0 && timestamp < m_LastReleasedTimestamp)
+	{
+		RawPacket latePacket;
+		if (latePacket.copyRawData(packet.getRawData(), packet.getRawDataLen(), packet.getPacketTimeStampNs(), m_Pool,
+				packet.getLinkLayerType(), packet.getFrameLength()))
+		{
+			m_Stats.latePackets++;
+			m_Stats.packets++;
+			m_OnMergedPacket(latePacket, sourceId, m_UserCookie);
+		}
+
+		return;
+	}
+
+	RawPacket* heldPacket;
+	if (m_FreePackets.empty())
+	{
+		heldPacket = new RawPacket();
+	}
+	else
+	{
+		heldPacket = m_FreePackets.back();
+		m_FreePackets.pop_back();
+	}
+
+	if (!heldPacket->copyRawData(packet.getRawData(), packet.getRawDataLen(), packet.getPacketTimeStampNs(), m_Pool,
+			packet.getLinkLayerType(), packet.getFrameLength()))
+	{
+		LOG_ERROR("Couldn't copy packet data to raw packet");
+		m_FreePackets.push_back(heldPacket);
+		return;
+	}
+
+	HeapEntry entry;
+	entry.timestamp = timestamp;
+	entry.sequence = m_NextSequence++;
+	entry.packet = heldPacket;
+	entry.sourceId = sourceId;
+	m_Heap.push_back(entry);
+	std::push_heap(m_Heap.begin(), m_Heap.end());
+
+	if (m_Heap.size() > m_MaxPackets)
+	{
+		m_Stats.releasedByLimit++;
+		releaseTop();
+	}
+}
+
+void TimestampReorderMerger::releaseReadyPackets()
+{
+	// no source can deliver a packet earlier than the time all sources reached
+	uint64_t allSourcesTimestamp = m_NewestTimestamp;
+	for (size_t i = 0; i < m_SourceTimestamps.size(); i++)
+	{
+		if (m_SourceTimestamps[i] < allSourcesTimestamp)
+			allSourcesTimestamp = m_SourceTimestamps[i];
+	}
+
+	while (!m_Heap.empty())
+	{
+		uint64_t timestamp = m_Heap.front().timestamp;
+		if (timestamp <= allSourcesTimestamp)
+		{
+			releaseTop();
+		}
+		else if (m_NewestTimestamp - timestamp > m_ReorderWindowNs)
+		{
+			m_Stats.releasedByWindow++;
+			releaseTop();
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+void TimestampReorderMerger::releaseTop()
+{
+	std::pop_heap(m_Heap.begin(), m_Heap.end());
+	HeapEntry entry = m_Heap.back();
+	m_Heap.pop_back();
+
+	m_LastReleasedTimestamp = entry.timestamp;
+	m_Stats.packets++;
+	m_OnMergedPacket(*entry.packet, entry.sourceId, m_UserCookie);
+	m_FreePackets.push_back(entry.packet);
+}
+
+void TimestampReorderMerger::flush()
+{
+	while (!m_Heap.empty())
+		releaseTop();
+}
+
+} // namespace pcpp
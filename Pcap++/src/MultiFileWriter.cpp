@@ -0,0 +1,484 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include "MultiFileWriter.h"
+#include "Logger.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+// the maximum number of chunks written by a single writev() call, well below IOV_MAX of all OS's
+#define PCPP_MULTI_FILE_WRITER_MAX_SEGMENTS 64
+
+namespace pcpp
+{
+
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+// Windows has no writev(), the segments are written one by one
+struct iovec
+{
+	void* iov_base;
+	size_t iov_len;
+};
+#endif
+
+// the magic numbers of microsecond and nanosecond resolution pcap files
+#define PCPP_PCAP_MAGIC_MICROSECONDS 0xa1b2c3d4
+#define PCPP_PCAP_MAGIC_NANOSECONDS 0xa1b23c4d
+
+struct multi_file_pcap_header
+{
+	uint32_t magic;
+	uint16_t version_major;
+	uint16_t version_minor;
+	int32_t thiszone;
+	uint32_t sigfigs;
+	uint32_t snaplen;
+	uint32_t linktype;
+};
+
+struct multi_file_packet_header
+{
+	uint32_t tv_sec;
+	uint32_t tv_usec;
+	uint32_t caplen;
+	uint32_t len;
+};
+
+// write all segments, continuing after partial writes. Returns false on an error
+static bool writeSegments(int fd, iovec* segments, int numOfSegments, uint64_t& numOfWriteCalls)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	for (int i = 0; i < numOfSegments; i++)
+	{
+		uint8_t* data = (uint8_t*)segments[i].iov_base;
+		size_t len = segments[i].iov_len;
+		while (len > 0)
+		{
+			int written = _write(fd, data, (unsigned int)len);
+			numOfWriteCalls++;
+			if (written < 0)
+				return false;
+			data += written;
+			len -= (size_t)written;
+		}
+	}
+
+	return true;
+#else
+	while (numOfSegments > 0)
+	{
+		ssize_t written = writev(fd, segments, numOfSegments);
+		numOfWriteCalls++;
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		// skip the segments which were written completely, and the written part of the next one
+		size_t remaining = (size_t)written;
+		while (numOfSegments > 0 && remaining >= segments->iov_len)
+		{
+			remaining -= segments->iov_len;
+			segments++;
+			numOfSegments--;
+		}
+
+		if (numOfSegments > 0)
+		{
+			segments->iov_base = (uint8_t*)segments->iov_base + remaining;
+			segments->iov_len -= remaining;
+		}
+	}
+
+	return true;
+#endif
+}
+
+MultiFileWriter::MultiFileWriter(const MultiFileWriterConfiguration& config) : m_Config(config)
+{
+	if (m_Config.chunkSize == 0)
+		m_Config.chunkSize = PCPP_MULTI_FILE_WRITER_DEFAULT_CHUNK_SIZE;
+	if (m_Config.maxOpenFiles == 0)
+		m_Config.maxOpenFiles = 1;
+
+	m_Closed = false;
+	m_FreeChunks = NULL;
+	m_NumOfChunks = 0;
+	m_MaxNumOfChunks = m_Config.memoryBudget / m_Config.chunkSize;
+	if (m_MaxNumOfChunks == 0)
+		m_MaxNumOfChunks = 1;
+	m_Buckets.resize(m_MaxNumOfChunks + 1, -1);
+	m_LargestBucket = 0;
+	m_OpenFilesHead = -1;
+	m_OpenFilesTail = -1;
+	m_NumOfOpenFiles = 0;
+	m_NumOfBufferedBytes = 0;
+	m_NumOfPacketsWritten = 0;
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfFileOpens = 0;
+	m_NumOfWriteCalls = 0;
+}
+
+MultiFileWriter::~MultiFileWriter()
+{
+	close();
+
+	// all chunks are returned to the free list when the files are written, even if writing failed
+	while (m_FreeChunks != NULL)
+	{
+		Chunk* next = m_FreeChunks->next;
+		delete [] (uint8_t*)m_FreeChunks;
+		m_FreeChunks = next;
+	}
+}
+
+bool MultiFileWriter::isValidFileId(int fileId) const
+{
+	return !m_Closed && fileId >= 0 && (size_t)fileId < m_Files.size();
+}
+
+int MultiFileWriter::addFile(const std::string& fileName, LinkLayerType linkLayerType)
+{
+	if (m_Closed)
+	{
+		LOG_ERROR("Cannot add file '%s', the writer is closed", fileName.c_str());
+		return -1;
+	}
+
+	FileData file;
+	file.name = fileName;
+	file.linkLayerType = linkLayerType;
+	file.fd = -1;
+	file.created = false;
+	file.firstChunk = NULL;
+	file.lastChunk = NULL;
+	file.numOfChunks = 0;
+	file.numOfBufferedBytes = 0;
+	file.prevOpen = -1;
+	file.nextOpen = -1;
+	file.prevInBucket = -1;
+	file.nextInBucket = -1;
+	m_Files.push_back(file);
+
+	return (int)m_Files.size() - 1;
+}
+
+bool MultiFileWriter::writePacket(int fileId, RawPacket const& packet)
+{
+	if (!isValidFileId(fileId))
+	{
+		LOG_ERROR("Invalid file ID %d", fileId);
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	if (packet.getLinkLayerType() != m_Files[fileId].linkLayerType)
+	{
+		LOG_ERROR("Cannot write a packet with a different link layer type to file '%s'", m_Files[fileId].name.c_str());
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	// in nanosecond files the tv_usec field holds nanoseconds
+	timespec ts = packet.getPacketTimeStampNs();
+	multi_file_packet_header pktHdr;
+	pktHdr.tv_sec = (uint32_t)ts.tv_sec;
+	pktHdr.tv_usec = (uint32_t)(m_Config.nanosecondsPrecision ? ts.tv_nsec : ts.tv_nsec / 1000);
+	pktHdr.caplen = (uint32_t)((RawPacket&)packet).getRawDataLen();
+	pktHdr.len = (uint32_t)((RawPacket&)packet).getFrameLength();
+
+	// making room may write other files to the disk. If that fails the packet is still buffered, but the failure is reported
+	bool result = appendToFile(fileId, (const uint8_t*)&pktHdr, sizeof(pktHdr));
+	result = appendToFile(fileId, ((RawPacket&)packet).getRawData(), pktHdr.caplen) && result;
+	m_NumOfPacketsWritten++;
+
+	return result;
+}
+
+bool MultiFileWriter::flush(int fileId)
+{
+	if (!isValidFileId(fileId))
+	{
+		LOG_ERROR("Invalid file ID %d", fileId);
+		return false;
+	}
+
+	return writeFile(fileId);
+}
+
+bool MultiFileWriter::flushAll()
+{
+	if (m_Closed)
+		return true;
+
+	bool result = true;
+	for (size_t i = 0; i < m_Files.size(); i++)
+	{
+		if (m_Files[i].numOfChunks > 0 && !writeFile((int)i))
+			result = false;
+	}
+
+	return result;
+}
+
+bool MultiFileWriter::close()
+{
+	if (m_Closed)
+		return true;
+
+	// files which weren't created yet are created too, even if no packets were written to them
+	bool result = true;
+	for (size_t i = 0; i < m_Files.size(); i++)
+	{
+		if (!writeFile((int)i))
+			result = false;
+	}
+
+	while (m_OpenFilesHead != -1)
+		closeFile(m_OpenFilesHead);
+
+	m_Closed = true;
+	return result;
+}
+
+MultiFileWriter::Chunk* MultiFileWriter::acquireChunk(bool& writeFailed)
+{
+	if (m_FreeChunks == NULL)
+	{
+		if (m_NumOfChunks < m_MaxNumOfChunks)
+		{
+			uint8_t* memory = new uint8_t[sizeof(Chunk) + m_Config.chunkSize];
+			Chunk* chunk = (Chunk*)memory;
+			chunk->data = memory + sizeof(Chunk);
+			m_NumOfChunks++;
+			return chunk;
+		}
+
+		// all chunks are used, so at least one file holds chunks. The file with the most chunks is written to make room
+		while (m_LargestBucket > 0 && m_Buckets[m_LargestBucket] == -1)
+			m_LargestBucket--;
+
+		if (!writeFile(m_Buckets[m_LargestBucket]))
+			writeFailed = true;
+	}
+
+	Chunk* chunk = m_FreeChunks;
+	m_FreeChunks = chunk->next;
+	return chunk;
+}
+
+bool MultiFileWriter::appendToFile(int fileId, const uint8_t* data, size_t len)
+{
+	bool writeFailed = false;
+	while (len > 0)
+	{
+		if (m_Files[fileId].lastChunk == NULL || m_Files[fileId].lastChunk->len == m_Config.chunkSize)
+		{
+			// this may write the file itself to the disk, so its chunks are looked at only after it
+			Chunk* chunk = acquireChunk(writeFailed);
+			chunk->next = NULL;
+			chunk->len = 0;
+
+			FileData& file = m_Files[fileId];
+			if (file.numOfChunks > 0)
+				removeFromBucket(fileId);
+			if (file.lastChunk == NULL)
+				file.firstChunk = chunk;
+			else
+				file.lastChunk->next = chunk;
+			file.lastChunk = chunk;
+			file.numOfChunks++;
+			addToBucket(fileId);
+		}
+
+		FileData& file = m_Files[fileId];
+		size_t toCopy = m_Config.chunkSize - file.lastChunk->len;
+		if (toCopy > len)
+			toCopy = len;
+		memcpy(file.lastChunk->data + file.lastChunk->len, data, toCopy);
+		file.lastChunk->len += toCopy;
+		file.numOfBufferedBytes += toCopy;
+		m_NumOfBufferedBytes += toCopy;
+		data += toCopy;
+		len -= toCopy;
+	}
+
+	return !writeFailed;
+}
+
+void MultiFileWriter::addToBucket(int fileId)
+{
+	FileData& file = m_Files[fileId];
+	size_t bucket = file.numOfChunks;
+	file.prevInBucket = -1;
+	file.nextInBucket = m_Buckets[bucket];
+	if (file.nextInBucket != -1)
+		m_Files[file.nextInBucket].prevInBucket = fileId;
+	m_Buckets[bucket] = fileId;
+
+	if (bucket > m_LargestBucket)
+		m_LargestBucket = bucket;
+}
+
+void MultiFileWriter::removeFromBucket(int fileId)
+{
+	FileData& file = m_Files[fileId];
+	if (file.prevInBucket != -1)
+		m_Files[file.prevInBucket].nextInBucket = file.nextInBucket;
+	else
+		m_Buckets[file.numOfChunks] = file.nextInBucket;
+	if (file.nextInBucket != -1)
+		m_Files[file.nextInBucket].prevInBucket = file.prevInBucket;
+
+	file.prevInBucket = -1;
+	file.nextInBucket = -1;
+}
+
+bool MultiFileWriter::openFile(int fileId)
+{
+	if (m_Files[fileId].fd >= 0)
+	{
+		// move the file to the head of the open files list
+		unlinkOpenFile(fileId);
+	}
+	else
+	{
+		if (m_NumOfOpenFiles >= m_Config.maxOpenFiles)
+			closeFile(m_OpenFilesTail);
+
+		FileData& file = m_Files[fileId];
+		int flags = (file.created ? O_WRONLY | O_APPEND : O_WRONLY | O_CREAT | O_TRUNC);
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+		file.fd = _open(file.name.c_str(), flags | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+		file.fd = ::open(file.name.c_str(), flags, 0644);
+#endif
+		if (file.fd < 0)
+		{
+			LOG_ERROR("Cannot open '%s' for writing, error was: %d", file.name.c_str(), errno);
+			return false;
+		}
+
+		m_NumOfFileOpens++;
+		m_NumOfOpenFiles++;
+	}
+
+	FileData& file = m_Files[fileId];
+	file.prevOpen = -1;
+	file.nextOpen = m_OpenFilesHead;
+	if (m_OpenFilesHead != -1)
+		m_Files[m_OpenFilesHead].prevOpen = fileId;
+	m_OpenFilesHead = fileId;
+	if (m_OpenFilesTail == -1)
+		m_OpenFilesTail = fileId;
+
+	return true;
+}
+
+void MultiFileWriter::unlinkOpenFile(int fileId)
+{
+	FileData& file = m_Files[fileId];
+	if (file.prevOpen != -1)
+		m_Files[file.prevOpen].nextOpen = file.nextOpen;
+	else
+		m_OpenFilesHead = file.nextOpen;
+	if (file.nextOpen != -1)
+		m_Files[file.nextOpen].prevOpen = file.prevOpen;
+	else
+		m_OpenFilesTail = file.prevOpen;
+
+	file.prevOpen = -1;
+	file.nextOpen = -1;
+}
+
+void MultiFileWriter::closeFile(int fileId)
+{
+	unlinkOpenFile(fileId);
+
+	FileData& file = m_Files[fileId];
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	_close(file.fd);
+#else
+	::close(file.fd);
+#endif
+	file.fd = -1;
+	m_NumOfOpenFiles--;
+}
+
+bool MultiFileWriter::writeFile(int fileId)
+{
+	if (m_Files[fileId].numOfChunks == 0 && m_Files[fileId].created)
+		return true;
+
+	// the file header is written when the file is created
+	bool writeHeader = !m_Files[fileId].created;
+	bool result = openFile(fileId);
+
+	FileData& file = m_Files[fileId];
+	if (result)
+	{
+		file.created = true;
+
+		multi_file_pcap_header pcapFileHeader;
+		iovec segments[PCPP_MULTI_FILE_WRITER_MAX_SEGMENTS];
+		int numOfSegments = 0;
+		if (writeHeader)
+		{
+			pcapFileHeader.magic = (m_Config.nanosecondsPrecision ? PCPP_PCAP_MAGIC_NANOSECONDS : PCPP_PCAP_MAGIC_MICROSECONDS);
+			pcapFileHeader.version_major = 2;
+			pcapFileHeader.version_minor = 4;
+			pcapFileHeader.thiszone = 0;
+			pcapFileHeader.sigfigs = 0;
+			pcapFileHeader.snaplen = PCPP_MAX_PACKET_SIZE;
+			pcapFileHeader.linktype = (uint32_t)file.linkLayerType;
+			segments[0].iov_base = &pcapFileHeader;
+			segments[0].iov_len = sizeof(pcapFileHeader);
+			numOfSegments = 1;
+		}
+
+		for (Chunk* chunk = file.firstChunk; chunk != NULL && result; chunk = chunk->next)
+		{
+			segments[numOfSegments].iov_base = chunk->data;
+			segments[numOfSegments].iov_len = chunk->len;
+			numOfSegments++;
+
+			if (numOfSegments == PCPP_MULTI_FILE_WRITER_MAX_SEGMENTS || chunk->next == NULL)
+			{
+				result = writeSegments(file.fd, segments, numOfSegments, m_NumOfWriteCalls);
+				numOfSegments = 0;
+			}
+		}
+
+		if (numOfSegments > 0)
+			result = writeSegments(file.fd, segments, numOfSegments, m_NumOfWriteCalls);
+
+		if (!result)
+			LOG_ERROR("Cannot write to file '%s', error was: %d", file.name.c_str(), errno);
+	}
+
+	// the chunks are released even if writing failed, so a failing file doesn't hold the memory budget
+	if (file.numOfChunks > 0)
+	{
+		removeFromBucket(fileId);
+		file.lastChunk->next = m_FreeChunks;
+		m_FreeChunks = file.firstChunk;
+		file.firstChunk = NULL;
+		file.lastChunk = NULL;
+		file.numOfChunks = 0;
+		m_NumOfBufferedBytes -= file.numOfBufferedBytes;
+		file.numOfBufferedBytes = 0;
+	}
+
+	return result;
+}
+
+} // namespace pcpp
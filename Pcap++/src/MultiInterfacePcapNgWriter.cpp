@@ -0,0 +1,513 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include "MultiInterfacePcapNgWriter.h"
+#include "AtomicUtils.h"
+#include "TimestampClock.h"
+#include "PcapPlusPlusVersion.h"
+#include "Logger.h"
+#include <string.h>
+#include <errno.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// pcap-ng block types
+#define PCAPNG_SECTION_HEADER_BLOCK 0x0A0D0D0A
+#define PCAPNG_INTERFACE_DESCRIPTION_BLOCK 0x00000001
+#define PCAPNG_INTERFACE_STATISTICS_BLOCK 0x00000005
+#define PCAPNG_ENHANCED_PACKET_BLOCK 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+
+// pcap-ng option codes
+#define PCAPNG_OPT_ENDOFOPT 0
+#define PCAPNG_OPT_SHB_USERAPPL 4
+#define PCAPNG_OPT_IF_NAME 2
+#define PCAPNG_OPT_IF_DESCRIPTION 3
+#define PCAPNG_OPT_IF_TSRESOL 9
+#define PCAPNG_OPT_ISB_STARTTIME 2
+#define PCAPNG_OPT_ISB_ENDTIME 3
+#define PCAPNG_OPT_ISB_IFRECV 4
+#define PCAPNG_OPT_ISB_IFDROP 5
+#define PCAPNG_OPT_ISB_OSDROP 7
+#define PCAPNG_OPT_ISB_USRDELIV 8
+
+// the maximum number of packets written in one round of the I/O thread, so statistics blocks are written on time
+#define MAX_PACKETS_PER_MERGE_ROUND 1024
+
+namespace pcpp
+{
+
+// used by the idle I/O thread and by capture threads waiting for room in a full queue
+static void sleepBriefly()
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	Sleep(1);
+#else
+	timespec interval;
+	interval.tv_sec = 0;
+	interval.tv_nsec = 50000;
+	nanosleep(&interval, NULL);
+#endif
+}
+
+template<typename T>
+static inline void appendValue(std::vector<uint8_t>& buffer, T value)
+{
+	size_t offset = buffer.size();
+	buffer.resize(offset + sizeof(T));
+	memcpy(&buffer[offset], &value, sizeof(T));
+}
+
+// a timestamp is written as its high 32 bits followed by its low 32 bits
+static inline void appendTimestamp(std::vector<uint8_t>& buffer, uint64_t timestamp)
+{
+	appendValue<uint32_t>(buffer, (uint32_t)(timestamp >> 32));
+	appendValue<uint32_t>(buffer, (uint32_t)(timestamp & 0xFFFFFFFF));
+}
+
+static void appendOption(std::vector<uint8_t>& options, uint16_t code, const void* value, size_t len)
+{
+	appendValue<uint16_t>(options, code);
+	appendValue<uint16_t>(options, (uint16_t)len);
+	size_t offset = options.size();
+	// option values are padded to 32 bits
+	options.resize(offset + ((len + 3) & ~(size_t)3), 0);
+	memcpy(&options[offset], value, len);
+}
+
+static void appendCounterOption(std::vector<uint8_t>& options, uint16_t code, uint64_t value)
+{
+	appendOption(options, code, &value, sizeof(value));
+}
+
+MultiInterfacePcapNgWriter::MultiInterfacePcapNgWriter(const char* fileName, const MultiInterfacePcapNgWriterConfiguration& config) :
+	m_FileName(fileName), m_Config(config)
+{
+	m_File = NULL;
+	m_StopRequested = 0;
+	m_WriteFailed = false;
+	m_OpenTime = 0;
+}
+
+MultiInterfacePcapNgWriter::~MultiInterfacePcapNgWriter()
+{
+	close();
+
+	for (std::vector<Interface*>::iterator iter = m_Interfaces.begin(); iter != m_Interfaces.end(); iter++)
+	{
+		delete (*iter)->queue;
+		delete *iter;
+	}
+}
+
+int MultiInterfacePcapNgWriter::addInterface(LinkLayerType linkLayerType, const std::string& name, const std::string& description, uint32_t snapshotLength)
+{
+	if (m_File != NULL)
+	{
+		LOG_ERROR("Interfaces can't be added to '%s' after it was opened", m_FileName.c_str());
+		return -1;
+	}
+
+	Interface* iface = new Interface();
+	iface->linkLayerType = linkLayerType;
+	iface->name = name;
+	iface->description = description;
+	iface->snapshotLength = snapshotLength;
+	iface->queue = new SPSCQueue<StagedPacket>(m_Config.queueSize > 0 ? m_Config.queueSize : 1);
+	iface->numOfPacketsDropped = 0;
+	iface->deviceNumOfPacketsReceived = 0;
+	iface->deviceNumOfPacketsDropped = 0;
+	iface->hasDeviceStatistics = 0;
+	iface->numOfPacketsWritten = 0;
+	m_Interfaces.push_back(iface);
+
+	return (int)m_Interfaces.size() - 1;
+}
+
+bool MultiInterfacePcapNgWriter::open()
+{
+	if (m_File != NULL)
+	{
+		LOG_ERROR("File '%s' is already opened", m_FileName.c_str());
+		return false;
+	}
+
+	if (m_Interfaces.empty())
+	{
+		LOG_ERROR("Cannot open '%s': no interfaces were added", m_FileName.c_str());
+		return false;
+	}
+
+	m_File = fopen(m_FileName.c_str(), "wb");
+	if (m_File == NULL)
+	{
+		LOG_ERROR("Cannot open '%s' for writing, error was: %d", m_FileName.c_str(), errno);
+		return false;
+	}
+
+	m_StopRequested = 0;
+	m_WriteFailed = false;
+	m_WriteBuffer.reserve(WriteBufferSize + PCPP_MAX_PACKET_SIZE);
+	m_OpenTime = TimestampClock::nowNs();
+	for (std::vector<Interface*>::iterator iter = m_Interfaces.begin(); iter != m_Interfaces.end(); iter++)
+	{
+		(*iter)->numOfPacketsDropped = 0;
+		(*iter)->hasDeviceStatistics = 0;
+		(*iter)->numOfPacketsWritten = 0;
+	}
+
+	writeSectionHeader();
+	for (std::vector<Interface*>::iterator iter = m_Interfaces.begin(); iter != m_Interfaces.end(); iter++)
+		writeInterfaceDescription(**iter);
+	flushWriteBuffer();
+
+	if (m_WriteFailed)
+	{
+		fclose(m_File);
+		m_File = NULL;
+		return false;
+	}
+
+	int err = pthread_create(&m_IOThread, NULL, ioThreadMain, this);
+	if (err != 0)
+	{
+		LOG_ERROR("Cannot create I/O thread: [%s]", strerror(err));
+		fclose(m_File);
+		m_File = NULL;
+		return false;
+	}
+
+	LOG_DEBUG("File writer for '%s' opened with %d interfaces", m_FileName.c_str(), (int)m_Interfaces.size());
+	return true;
+}
+
+void MultiInterfacePcapNgWriter::close()
+{
+	if (m_File == NULL)
+		return;
+
+	atomicStoreRelease(&m_StopRequested, 1);
+	pthread_join(m_IOThread, NULL);
+
+	fclose(m_File);
+	m_File = NULL;
+	LOG_DEBUG("File writer closed for file '%s'", m_FileName.c_str());
+}
+
+bool MultiInterfacePcapNgWriter::writePacket(int interfaceId, const RawPacket& rawPacket)
+{
+	if (m_File == NULL || interfaceId < 0 || interfaceId >= (int)m_Interfaces.size())
+		return false;
+
+	Interface* iface = m_Interfaces[interfaceId];
+	StagedPacket* slot = iface->queue->reserve();
+	while (slot == NULL)
+	{
+		if (!m_Config.blockWhenFull)
+		{
+			atomicStoreRelaxed(&iface->numOfPacketsDropped, iface->numOfPacketsDropped + 1);
+			return false;
+		}
+
+		sleepBriefly();
+		slot = iface->queue->reserve();
+	}
+
+	size_t len = (size_t)rawPacket.getRawDataLen();
+	if (iface->snapshotLength > 0 && len > iface->snapshotLength)
+		len = iface->snapshotLength;
+
+	slot->data.assign(rawPacket.getRawData(), rawPacket.getRawData() + len);
+	timespec timestamp = rawPacket.getPacketTimeStampNs();
+	slot->timestamp = (uint64_t)timestamp.tv_sec * 1000000000 + timestamp.tv_nsec;
+	slot->originalLength = (uint32_t)rawPacket.getFrameLength();
+	slot->stagingTime = TimestampClock::nowNs();
+	iface->queue->publish();
+
+	return true;
+}
+
+void MultiInterfacePcapNgWriter::setInterfaceStatistics(int interfaceId, uint64_t numOfPacketsReceived, uint64_t numOfPacketsDropped)
+{
+	if (interfaceId < 0 || interfaceId >= (int)m_Interfaces.size())
+		return;
+
+	Interface* iface = m_Interfaces[interfaceId];
+	atomicStoreRelaxed(&iface->deviceNumOfPacketsReceived, numOfPacketsReceived);
+	atomicStoreRelaxed(&iface->deviceNumOfPacketsDropped, numOfPacketsDropped);
+	atomicStoreRelease(&iface->hasDeviceStatistics, 1);
+}
+
+uint64_t MultiInterfacePcapNgWriter::getNumOfPacketsDropped(int interfaceId) const
+{
+	if (interfaceId < 0 || interfaceId >= (int)m_Interfaces.size())
+		return 0;
+
+	return atomicLoadRelaxed(&m_Interfaces[interfaceId]->numOfPacketsDropped);
+}
+
+uint64_t MultiInterfacePcapNgWriter::getNumOfPacketsWritten() const
+{
+	uint64_t result = 0;
+	for (std::vector<Interface*>::const_iterator iter = m_Interfaces.begin(); iter != m_Interfaces.end(); iter++)
+		result += atomicLoadRelaxed(&(*iter)->numOfPacketsWritten);
+
+	return result;
+}
+
+void* MultiInterfacePcapNgWriter::ioThreadMain(void* writerPtr)
+{
+	MultiInterfacePcapNgWriter* self = (MultiInterfacePcapNgWriter*)writerPtr;
+	uint64_t statsInterval = (uint64_t)self->m_Config.statsIntervalMs * 1000000;
+	uint64_t nextStatsTime = self->m_OpenTime + statsInterval;
+	int idleRounds = 0;
+
+	while (true)
+	{
+		// the stop request is read before merging, so when it's set and a whole round writes nothing all packets were written
+		bool stopRequested = (atomicLoadAcquire(&self->m_StopRequested) != 0);
+
+		size_t numOfPacketsWritten = self->mergePackets(stopRequested);
+
+		if (statsInterval > 0)
+		{
+			uint64_t now = TimestampClock::nowNs();
+			if (now >= nextStatsTime)
+			{
+				for (size_t i = 0; i < self->m_Interfaces.size(); i++)
+					self->writeStatistics((uint32_t)i, now);
+				nextStatsTime = now + statsInterval;
+			}
+		}
+
+		if (numOfPacketsWritten > 0)
+		{
+			idleRounds = 0;
+			continue;
+		}
+
+		if (stopRequested)
+			break;
+
+		// when the capture pauses the blocks written so far reach the file, so it's readable while the capture runs
+		if (idleRounds == 0)
+		{
+			self->flushWriteBuffer();
+			fflush(self->m_File);
+		}
+
+		if (idleRounds < IdleSpinRounds)
+			idleRounds++;
+		else
+			sleepBriefly();
+	}
+
+	uint64_t now = TimestampClock::nowNs();
+	for (size_t i = 0; i < self->m_Interfaces.size(); i++)
+		self->writeStatistics((uint32_t)i, now);
+	self->flushWriteBuffer();
+
+	return NULL;
+}
+
+void MultiInterfacePcapNgWriter::moveStagedPackets()
+{
+	for (std::vector<Interface*>::iterator iter = m_Interfaces.begin(); iter != m_Interfaces.end(); iter++)
+	{
+		Interface* iface = *iter;
+		StagedPacket* slot = iface->queue->front();
+		while (slot != NULL)
+		{
+			// the packet data is swapped rather than copied, and the slot gets the buffer of an already written packet
+			iface->pendingPackets.push_back(StagedPacket());
+			StagedPacket& pending = iface->pendingPackets.back();
+			pending.data.swap(slot->data);
+			if (!m_FreeBuffers.empty())
+			{
+				slot->data.swap(m_FreeBuffers.back());
+				m_FreeBuffers.pop_back();
+			}
+			pending.timestamp = slot->timestamp;
+			pending.originalLength = slot->originalLength;
+			pending.stagingTime = slot->stagingTime;
+
+			iface->queue->pop();
+			slot = iface->queue->front();
+		}
+	}
+}
+
+size_t MultiInterfacePcapNgWriter::mergePackets(bool drain)
+{
+	uint64_t mergeWindow = (uint64_t)m_Config.mergeWindowMs * 1000000;
+	size_t numOfPacketsWritten = 0;
+
+	moveStagedPackets();
+
+	while (numOfPacketsWritten < MAX_PACKETS_PER_MERGE_ROUND)
+	{
+		// the earliest of the oldest pending packets of all interfaces
+		Interface* earliestInterface = NULL;
+		uint32_t earliestInterfaceId = 0;
+		bool hasIdleInterface = false;
+		for (size_t i = 0; i < m_Interfaces.size(); i++)
+		{
+			Interface* iface = m_Interfaces[i];
+			if (iface->pendingPackets.empty())
+			{
+				hasIdleInterface = true;
+				continue;
+			}
+
+			if (earliestInterface == NULL || iface->pendingPackets.front().timestamp < earliestInterface->pendingPackets.front().timestamp)
+			{
+				earliestInterface = iface;
+				earliestInterfaceId = (uint32_t)i;
+			}
+		}
+
+		if (earliestInterface == NULL)
+			break;
+
+		StagedPacket& packet = earliestInterface->pendingPackets.front();
+
+		// an interface with no pending packets may still stage an earlier packet, unless the packet already waited for the whole window
+		if (hasIdleInterface && !drain && TimestampClock::nowNs() < packet.stagingTime + mergeWindow)
+			break;
+
+		writePacketBlock(earliestInterfaceId, packet);
+		// the free buffers are capped at the size of one queue, so a burst doesn't keep its memory after it's written
+		if (m_FreeBuffers.size() < m_Config.queueSize)
+		{
+			m_FreeBuffers.push_back(std::vector<uint8_t>());
+			m_FreeBuffers.back().swap(packet.data);
+		}
+		earliestInterface->pendingPackets.pop_front();
+		atomicStoreRelaxed(&earliestInterface->numOfPacketsWritten, earliestInterface->numOfPacketsWritten + 1);
+		numOfPacketsWritten++;
+	}
+
+	return numOfPacketsWritten;
+}
+
+void MultiInterfacePcapNgWriter::appendBlock(uint32_t blockType, const uint8_t* body, size_t bodyLen, const std::vector<uint8_t>& options)
+{
+	// the block type, the total length at both ends, the body and the options, which end with an opt_endofopt option
+	uint32_t totalLength = (uint32_t)(3 * sizeof(uint32_t) + bodyLen + options.size() + (options.empty() ? 0 : sizeof(uint32_t)));
+
+	appendValue<uint32_t>(m_WriteBuffer, blockType);
+	appendValue<uint32_t>(m_WriteBuffer, totalLength);
+	m_WriteBuffer.insert(m_WriteBuffer.end(), body, body + bodyLen);
+	if (!options.empty())
+	{
+		m_WriteBuffer.insert(m_WriteBuffer.end(), options.begin(), options.end());
+		appendValue<uint16_t>(m_WriteBuffer, PCAPNG_OPT_ENDOFOPT);
+		appendValue<uint16_t>(m_WriteBuffer, 0);
+	}
+	appendValue<uint32_t>(m_WriteBuffer, totalLength);
+
+	if (m_WriteBuffer.size() >= WriteBufferSize)
+		flushWriteBuffer();
+}
+
+void MultiInterfacePcapNgWriter::writeSectionHeader()
+{
+	std::vector<uint8_t> body;
+	appendValue<uint32_t>(body, PCAPNG_BYTE_ORDER_MAGIC);
+	appendValue<uint16_t>(body, 1);
+	appendValue<uint16_t>(body, 0);
+	// the section length isn't known in advance
+	appendValue<int64_t>(body, -1);
+
+	std::vector<uint8_t> options;
+	std::string userApp = "PcapPlusPlus " + getPcapPlusPlusVersion();
+	appendOption(options, PCAPNG_OPT_SHB_USERAPPL, userApp.c_str(), userApp.length());
+
+	appendBlock(PCAPNG_SECTION_HEADER_BLOCK, &body[0], body.size(), options);
+}
+
+void MultiInterfacePcapNgWriter::writeInterfaceDescription(const Interface& iface)
+{
+	std::vector<uint8_t> body;
+	appendValue<uint16_t>(body, (uint16_t)iface.linkLayerType);
+	appendValue<uint16_t>(body, 0);
+	appendValue<uint32_t>(body, iface.snapshotLength);
+
+	std::vector<uint8_t> options;
+	if (!iface.name.empty())
+		appendOption(options, PCAPNG_OPT_IF_NAME, iface.name.c_str(), iface.name.length());
+	if (!iface.description.empty())
+		appendOption(options, PCAPNG_OPT_IF_DESCRIPTION, iface.description.c_str(), iface.description.length());
+	// timestamps are in nanoseconds (10^-9 seconds)
+	uint8_t tsResolution = 9;
+	appendOption(options, PCAPNG_OPT_IF_TSRESOL, &tsResolution, sizeof(tsResolution));
+
+	appendBlock(PCAPNG_INTERFACE_DESCRIPTION_BLOCK, &body[0], body.size(), options);
+}
+
+void MultiInterfacePcapNgWriter::writePacketBlock(uint32_t interfaceId, const StagedPacket& packet)
+{
+	uint32_t capturedLength = (uint32_t)packet.data.size();
+	uint32_t paddedLength = (capturedLength + 3) & ~(uint32_t)3;
+	uint32_t totalLength = 8 * sizeof(uint32_t) + paddedLength;
+
+	appendValue<uint32_t>(m_WriteBuffer, PCAPNG_ENHANCED_PACKET_BLOCK);
+	appendValue<uint32_t>(m_WriteBuffer, totalLength);
+	appendValue<uint32_t>(m_WriteBuffer, interfaceId);
+	appendTimestamp(m_WriteBuffer, packet.timestamp);
+	appendValue<uint32_t>(m_WriteBuffer, capturedLength);
+	appendValue<uint32_t>(m_WriteBuffer, packet.originalLength);
+	size_t offset = m_WriteBuffer.size();
+	m_WriteBuffer.resize(offset + paddedLength, 0);
+	if (capturedLength > 0)
+		memcpy(&m_WriteBuffer[offset], &packet.data[0], capturedLength);
+	appendValue<uint32_t>(m_WriteBuffer, totalLength);
+
+	if (m_WriteBuffer.size() >= WriteBufferSize)
+		flushWriteBuffer();
+}
+
+void MultiInterfacePcapNgWriter::writeStatistics(uint32_t interfaceId, uint64_t now)
+{
+	Interface* iface = m_Interfaces[interfaceId];
+
+	std::vector<uint8_t> body;
+	appendValue<uint32_t>(body, interfaceId);
+	appendTimestamp(body, now);
+
+	std::vector<uint8_t> options;
+	std::vector<uint8_t> timestamp;
+	appendTimestamp(timestamp, m_OpenTime);
+	appendOption(options, PCAPNG_OPT_ISB_STARTTIME, &timestamp[0], timestamp.size());
+	timestamp.clear();
+	appendTimestamp(timestamp, now);
+	appendOption(options, PCAPNG_OPT_ISB_ENDTIME, &timestamp[0], timestamp.size());
+	if (atomicLoadAcquire(&iface->hasDeviceStatistics) != 0)
+	{
+		appendCounterOption(options, PCAPNG_OPT_ISB_IFRECV, atomicLoadRelaxed(&iface->deviceNumOfPacketsReceived));
+		appendCounterOption(options, PCAPNG_OPT_ISB_IFDROP, atomicLoadRelaxed(&iface->deviceNumOfPacketsDropped));
+	}
+	appendCounterOption(options, PCAPNG_OPT_ISB_OSDROP, atomicLoadRelaxed(&iface->numOfPacketsDropped));
+	appendCounterOption(options, PCAPNG_OPT_ISB_USRDELIV, iface->numOfPacketsWritten);
+
+	appendBlock(PCAPNG_INTERFACE_STATISTICS_BLOCK, &body[0], body.size(), options);
+}
+
+void MultiInterfacePcapNgWriter::flushWriteBuffer()
+{
+	if (m_WriteBuffer.empty())
+		return;
+
+	// after a failure the blocks are dropped, so the capture keeps running and the error is reported once
+	if (!m_WriteFailed && fwrite(&m_WriteBuffer[0], 1, m_WriteBuffer.size(), m_File) != m_WriteBuffer.size())
+	{
+		LOG_ERROR("Cannot write to file '%s', error was: %d", m_FileName.c_str(), errno);
+		m_WriteFailed = true;
+	}
+
+	m_WriteBuffer.clear();
+}
+
+} // namespace pcpp
@@ -0,0 +1,1030 @@
+#include "NativeFilter.h"
+#include "RawPacket.h"
+#include "EthLayer.h"
+#include "IPv4Layer.h"
+#include "TimestampClock.h"
+#include <string.h>
+#include <algorithm>
+
+// jump targets which end the program instead of pointing to an instruction
+#define NATIVE_FILTER_ACCEPT 0xffff
+#define NATIVE_FILTER_REJECT 0xfffe
+#define NATIVE_FILTER_MAX_INSTRUCTIONS 0xfff0
+
+#define ETHER_HEADER_LEN 14
+#define SLL_HEADER_LEN 16
+#define ETHER_TYPE_OFFSET 12
+#define SLL_PROTOCOL_OFFSET 14
+#define ARP_OPCODE_OFFSET 7
+
+// MultiFilterProgram classifier tables of exact values are identified by the predicate type, and IPv4 prefix tables by their index plus
+// this base
+#define MULTI_FILTER_PREFIX_TABLE_BASE 32
+
+namespace pcpp
+{
+
+NativeFilterPredicate::NativeFilterPredicate(NativeFilterPredicateType predicateType) :
+	type(predicateType), op(EQUALS), value(0), upperValue(0), mask(0), offset(0), protocols(0)
+{
+	memset(macAddress, 0, sizeof(macAddress));
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Ordering the tree by the estimated cost and selectivity of each node
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+struct NodeEstimate
+{
+	// the average number of predicates tested to evaluate the node
+	double cost;
+	// the estimated probability of a packet to match the node
+	double matchProbability;
+};
+
+static int countBits(uint32_t value)
+{
+	int count = 0;
+	for (; value != 0; value &= value - 1)
+		count++;
+	return count;
+}
+
+// static guesses of how common each field value is in typical traffic. They only decide the order predicates are tested in, so they
+// don't need to be accurate
+static NodeEstimate estimatePredicate(const NativeFilterPredicate& predicate)
+{
+	NodeEstimate estimate;
+	estimate.cost = 1.0;
+	estimate.matchProbability = 0.5;
+
+	switch (predicate.type)
+	{
+	case NativeFilterProtocol:
+		estimate.matchProbability = ((predicate.protocols & (Ethernet | IPv4 | TCP)) != 0 ? 0.8 : 0.2);
+		break;
+	case NativeFilterIPVersion:
+		estimate.matchProbability = (predicate.value == 4 ? 0.8 : 0.1);
+		break;
+	case NativeFilterIPProtocol:
+		if (predicate.value == PACKETPP_IPPROTO_TCP)
+			estimate.matchProbability = 0.6;
+		else if (predicate.value == PACKETPP_IPPROTO_UDP)
+			estimate.matchProbability = 0.3;
+		else
+			estimate.matchProbability = 0.05;
+		break;
+	case NativeFilterSrcIPv4:
+	case NativeFilterDstIPv4:
+	{
+		// every 4 masked bits make a match half as likely
+		double probability = 1.0;
+		for (int i = countBits(predicate.mask) / 4; i > 0; i--)
+			probability /= 2;
+		estimate.matchProbability = std::max(probability, 0.001);
+		break;
+	}
+	case NativeFilterSrcPort:
+	case NativeFilterDstPort:
+	{
+		double rangeSize = (predicate.upperValue >= predicate.value ? predicate.upperValue - predicate.value + 1.0 : 1.0);
+		estimate.matchProbability = std::min(std::max(rangeSize / 65536.0, 0.02), 1.0);
+		break;
+	}
+	case NativeFilterVlanId:
+	case NativeFilterArpOpcode:
+		estimate.matchProbability = 0.02;
+		break;
+	case NativeFilterEtherType:
+		estimate.cost = 2.0;
+		estimate.matchProbability = (predicate.value == PCPP_ETHERTYPE_IP ? 0.8 : 0.1);
+		break;
+	case NativeFilterSrcMac:
+	case NativeFilterDstMac:
+		estimate.cost = 2.0;
+		estimate.matchProbability = 0.05;
+		break;
+	case NativeFilterIPv4Field:
+	case NativeFilterTcpField:
+	case NativeFilterUdpField:
+	case NativeFilterTcpFlags:
+		estimate.cost = 2.0;
+		if (predicate.op == EQUALS)
+			estimate.matchProbability = 0.05;
+		else if (predicate.op == NOT_EQUALS)
+			estimate.matchProbability = 0.95;
+		break;
+	}
+
+	return estimate;
+}
+
+// the predicates a profile counted and their estimates by the counters, used instead of the static guesses
+struct MeasuredEstimates
+{
+	const std::vector<NativeFilterPredicate>* predicates;
+	std::vector<NodeEstimate> estimates;
+};
+
+static bool isSamePredicate(const NativeFilterPredicate& first, const NativeFilterPredicate& second)
+{
+	return first.type == second.type && first.op == second.op && first.value == second.value && first.upperValue == second.upperValue &&
+		first.mask == second.mask && first.offset == second.offset && first.protocols == second.protocols &&
+		memcmp(first.macAddress, second.macAddress, sizeof(first.macAddress)) == 0;
+}
+
+// the measured match ratio replaces the guessed probability, and the measured cycles replace the cost relative to the average cycles
+// of all measured predicates, which keeps them on the same scale as the guessed costs
+static void calculateMeasuredEstimates(const std::vector<FilterNodeStats>& stats, MeasuredEstimates& measured)
+{
+	double totalCycles = 0.0;
+	int numOfSampled = 0;
+	for (size_t i = 0; i < stats.size(); i++)
+	{
+		if (stats[i].sampled > 0)
+		{
+			totalCycles += stats[i].getAverageCycles();
+			numOfSampled++;
+		}
+	}
+
+	double averageCycles = (numOfSampled > 0 ? totalCycles / numOfSampled : 0.0);
+
+	measured.estimates.clear();
+	for (size_t i = 0; i < stats.size(); i++)
+	{
+		NodeEstimate estimate = estimatePredicate((*measured.predicates)[i]);
+		if (stats[i].evaluated > 0)
+			estimate.matchProbability = stats[i].getMatchRatio();
+		if (stats[i].sampled > 0 && averageCycles > 0.0)
+			estimate.cost = std::max(stats[i].getAverageCycles() / averageCycles, 0.01);
+		measured.estimates.push_back(estimate);
+	}
+}
+
+static NodeEstimate estimatePredicate(const NativeFilterPredicate& predicate, const MeasuredEstimates& measured)
+{
+	for (size_t i = 0; i < measured.estimates.size(); i++)
+	{
+		if (isSamePredicate((*measured.predicates)[i], predicate))
+			return measured.estimates[i];
+	}
+
+	return estimatePredicate(predicate);
+}
+
+// the order of the children of an "and" node which minimizes the average cost tests first the children whose cost per chance of
+// failing is lowest, and for an "or" node the ones whose cost per chance of matching is lowest
+static double orderingKey(const NodeEstimate& estimate, bool andNode)
+{
+	double decisiveProbability = (andNode ? 1.0 - estimate.matchProbability : estimate.matchProbability);
+	if (decisiveProbability <= 0.0)
+		return 1e300;
+
+	return estimate.cost / decisiveProbability;
+}
+
+// a child of the same logical operation as its parent is replaced by its own children
+static void appendMergedChildren(NativeFilterNode::NodeType parentType, const NativeFilterNode& child, std::vector<NativeFilterNode>& children)
+{
+	if (child.type != parentType || child.children.empty())
+	{
+		children.push_back(child);
+		return;
+	}
+
+	for (size_t i = 0; i < child.children.size(); i++)
+		appendMergedChildren(parentType, child.children[i], children);
+}
+
+// merge nested nodes of the same logical operation, order the children of every node and return the node estimate
+static NodeEstimate optimizeNode(NativeFilterNode& node, const MeasuredEstimates& measured)
+{
+	if (node.type == NativeFilterNode::PredicateNode)
+		return estimatePredicate(node.predicate, measured);
+
+	if (node.type == NativeFilterNode::NotNode)
+	{
+		NodeEstimate estimate = optimizeNode(node.children.front(), measured);
+		estimate.matchProbability = 1.0 - estimate.matchProbability;
+		return estimate;
+	}
+
+	bool andNode = (node.type == NativeFilterNode::AndNode);
+
+	std::vector<NativeFilterNode> children;
+	for (size_t i = 0; i < node.children.size(); i++)
+		appendMergedChildren(node.type, node.children[i], children);
+
+	std::vector<std::pair<double, size_t> > order;
+	std::vector<NodeEstimate> estimates;
+	for (size_t i = 0; i < children.size(); i++)
+	{
+		estimates.push_back(optimizeNode(children[i], measured));
+		order.push_back(std::make_pair(orderingKey(estimates.back(), andNode), i));
+	}
+
+	std::stable_sort(order.begin(), order.end());
+
+	// each child is evaluated only if all the children before it didn't decide the result
+	NodeEstimate estimate;
+	estimate.cost = 0.0;
+	double undecidedProbability = 1.0;
+	node.children.clear();
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const NodeEstimate& childEstimate = estimates[order[i].second];
+		node.children.push_back(children[order[i].second]);
+		estimate.cost += undecidedProbability * childEstimate.cost;
+		undecidedProbability *= (andNode ? childEstimate.matchProbability : 1.0 - childEstimate.matchProbability);
+	}
+
+	estimate.matchProbability = (andNode ? undecidedProbability : 1.0 - undecidedProbability);
+	return estimate;
+}
+
+static bool verifyNode(const NativeFilterNode& node)
+{
+	if (node.type == NativeFilterNode::NotNode && node.children.size() != 1)
+		return false;
+
+	for (std::vector<NativeFilterNode>::const_iterator it = node.children.begin(); it != node.children.end(); ++it)
+	{
+		if (!verifyNode(*it))
+			return false;
+	}
+
+	return true;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Matching packets
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static inline uint16_t readField16(const uint8_t* data, size_t dataLen, uint16_t headerOffset, uint16_t fieldOffset, bool& found)
+{
+	size_t offset = (size_t)headerOffset + fieldOffset;
+	found = (headerOffset != PacketView::NoOffset && offset + 2 <= dataLen);
+	if (!found)
+		return 0;
+
+	return (uint16_t)((data[offset] << 8) | data[offset + 1]);
+}
+
+static inline bool compareField(uint32_t field, FilterOperator op, uint32_t value)
+{
+	switch (op)
+	{
+	case EQUALS:
+		return field == value;
+	case NOT_EQUALS:
+		return field != value;
+	case GREATER_THAN:
+		return field > value;
+	case GREATER_OR_EQUAL:
+		return field >= value;
+	case LESS_THAN:
+		return field < value;
+	case LESS_OR_EQUAL:
+		return field <= value;
+	default:
+		return false;
+	}
+}
+
+// the offset of the link layer EtherType, or 0 if the packet doesn't have a complete Ethernet or Linux cooked capture header
+static inline size_t getEtherTypeOffset(const PacketView& view, size_t dataLen)
+{
+	if (view.isPacketOfType(Ethernet))
+		return (dataLen >= ETHER_HEADER_LEN ? ETHER_TYPE_OFFSET : 0);
+
+	if (view.isPacketOfType(SLL))
+		return (dataLen >= SLL_HEADER_LEN ? SLL_PROTOCOL_OFFSET : 0);
+
+	return 0;
+}
+
+static inline bool matchIPv4Address(const uint8_t* address, const NativeFilterPredicate& predicate)
+{
+	uint32_t addrAsInt;
+	memcpy(&addrAsInt, address, sizeof(addrAsInt));
+	return (addrAsInt & predicate.mask) == predicate.value;
+}
+
+static bool matchPredicate(const NativeFilterPredicate& predicate, const PacketView& view, const uint8_t* data, size_t dataLen)
+{
+	bool found = false;
+	uint16_t field = 0;
+
+	switch (predicate.type)
+	{
+	case NativeFilterProtocol:
+		return (view.protocolTypes & predicate.protocols) != 0;
+
+	case NativeFilterIPVersion:
+		return view.ipVersion == predicate.value;
+
+	case NativeFilterIPProtocol:
+		return view.ipVersion != 0 && view.ipProtocol == predicate.value;
+
+	case NativeFilterSrcIPv4:
+		return view.ipVersion == 4 && matchIPv4Address(view.srcIP, predicate);
+
+	case NativeFilterDstIPv4:
+		return view.ipVersion == 4 && matchIPv4Address(view.dstIP, predicate);
+
+	case NativeFilterSrcPort:
+		return view.isPacketOfType((ProtocolType)(TCP | UDP)) && view.srcPort >= predicate.value && view.srcPort <= predicate.upperValue;
+
+	case NativeFilterDstPort:
+		return view.isPacketOfType((ProtocolType)(TCP | UDP)) && view.dstPort >= predicate.value && view.dstPort <= predicate.upperValue;
+
+	case NativeFilterVlanId:
+		return view.vlanCount > 0 && view.vlanId == predicate.value;
+
+	case NativeFilterEtherType:
+	{
+		size_t offset = getEtherTypeOffset(view, dataLen);
+		return offset != 0 && (uint32_t)((data[offset] << 8) | data[offset + 1]) == predicate.value;
+	}
+
+	case NativeFilterSrcMac:
+		return view.isPacketOfType(Ethernet) && dataLen >= ETHER_HEADER_LEN && memcmp(data + 6, predicate.macAddress, 6) == 0;
+
+	case NativeFilterDstMac:
+		return view.isPacketOfType(Ethernet) && dataLen >= ETHER_HEADER_LEN && memcmp(data, predicate.macAddress, 6) == 0;
+
+	case NativeFilterIPv4Field:
+		if (view.ipVersion != 4)
+			return false;
+		field = readField16(data, dataLen, view.networkOffset, predicate.offset, found);
+		return found && compareField(field, predicate.op, predicate.value);
+
+	case NativeFilterTcpField:
+		if (!view.isPacketOfType(TCP))
+			return false;
+		field = readField16(data, dataLen, view.transportOffset, predicate.offset, found);
+		return found && compareField(field, predicate.op, predicate.value);
+
+	case NativeFilterUdpField:
+		if (!view.isPacketOfType(UDP))
+			return false;
+		field = readField16(data, dataLen, view.transportOffset, predicate.offset, found);
+		return found && compareField(field, predicate.op, predicate.value);
+
+	case NativeFilterTcpFlags:
+		return view.isPacketOfType(TCP) && compareField(view.tcpFlags & predicate.mask, predicate.op, predicate.value);
+
+	case NativeFilterArpOpcode:
+	{
+		size_t offset = getEtherTypeOffset(view, dataLen);
+		if (offset == 0 || ((data[offset] << 8) | data[offset + 1]) != PCPP_ETHERTYPE_ARP)
+			return false;
+
+		// the ARP header follows the EtherType
+		size_t opcodeOffset = offset + 2 + ARP_OPCODE_OFFSET;
+		return opcodeOffset < dataLen && data[opcodeOffset] == predicate.value;
+	}
+	}
+
+	return false;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// NativeFilterProgram
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// NativeFilterProfile
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+NativeFilterProfile::NativeFilterProfile(uint32_t sampleRate) : m_NumOfPackets(0), m_NumOfMatchedPackets(0)
+{
+	m_SampleRate = (sampleRate > 0 ? sampleRate : 1);
+	m_SampleCountdown = 1;
+}
+
+void NativeFilterProfile::reset()
+{
+	for (std::vector<FilterNodeStats>::iterator it = m_PredicateStats.begin(); it != m_PredicateStats.end(); ++it)
+		*it = FilterNodeStats();
+
+	m_NumOfPackets = 0;
+	m_NumOfMatchedPackets = 0;
+	m_SampleCountdown = 1;
+}
+
+bool NativeFilterProfile::merge(const NativeFilterProfile& other)
+{
+	if (m_PredicateStats.empty() && m_NumOfPackets == 0)
+		m_PredicateStats.resize(other.m_PredicateStats.size());
+	else if (other.m_PredicateStats.size() != m_PredicateStats.size())
+		return false;
+
+	for (size_t i = 0; i < m_PredicateStats.size(); i++)
+	{
+		m_PredicateStats[i].evaluated += other.m_PredicateStats[i].evaluated;
+		m_PredicateStats[i].matched += other.m_PredicateStats[i].matched;
+		m_PredicateStats[i].sampled += other.m_PredicateStats[i].sampled;
+		m_PredicateStats[i].cycles += other.m_PredicateStats[i].cycles;
+	}
+
+	m_NumOfPackets += other.m_NumOfPackets;
+	m_NumOfMatchedPackets += other.m_NumOfMatchedPackets;
+	return true;
+}
+
+
+NativeFilterProgram::NativeFilterProgram() : m_EntryPoint(NATIVE_FILTER_REJECT), m_Compiled(false)
+{
+}
+
+bool NativeFilterProgram::compile(GeneralFilter& filter)
+{
+	clear();
+
+	NativeFilterNode root;
+	if (!filter.toNativeFilter(root))
+		return false;
+
+	return compile(root);
+}
+
+bool NativeFilterProgram::compile(const NativeFilterNode& root)
+{
+	return compileTree(root, std::vector<NativeFilterPredicate>(), std::vector<FilterNodeStats>());
+}
+
+bool NativeFilterProgram::optimize(const NativeFilterProfile& profile)
+{
+	if (!m_Compiled || profile.getNumOfPredicates() != m_Instructions.size())
+		return false;
+
+	// a predicate may appear more than once in the program, in that case its counters are summed
+	std::vector<NativeFilterPredicate> measuredPredicates;
+	std::vector<FilterNodeStats> measuredStats;
+	for (size_t i = 0; i < m_Instructions.size(); i++)
+	{
+		size_t index = 0;
+		while (index < measuredPredicates.size() && !isSamePredicate(measuredPredicates[index], m_Instructions[i].predicate))
+			index++;
+
+		if (index == measuredPredicates.size())
+		{
+			measuredPredicates.push_back(m_Instructions[i].predicate);
+			measuredStats.push_back(FilterNodeStats());
+		}
+
+		const FilterNodeStats& stats = profile.getPredicateStats(i);
+		measuredStats[index].evaluated += stats.evaluated;
+		measuredStats[index].matched += stats.matched;
+		measuredStats[index].sampled += stats.sampled;
+		measuredStats[index].cycles += stats.cycles;
+	}
+
+	// compileTree() clears the program, so it's given a copy of the tree
+	NativeFilterNode root = m_Root;
+	return compileTree(root, measuredPredicates, measuredStats);
+}
+
+bool NativeFilterProgram::compileTree(const NativeFilterNode& root, const std::vector<NativeFilterPredicate>& measuredPredicates,
+	const std::vector<FilterNodeStats>& measuredStats)
+{
+	clear();
+
+	if (!verifyNode(root))
+		return false;
+
+	MeasuredEstimates measured;
+	measured.predicates = &measuredPredicates;
+	calculateMeasuredEstimates(measuredStats, measured);
+
+	NativeFilterNode optimizedRoot = root;
+	optimizeNode(optimizedRoot, measured);
+
+	// the program is emitted backwards: a node is emitted after the nodes it jumps to, so their indices are known
+	uint16_t entryPoint;
+	if (!emitNode(optimizedRoot, NATIVE_FILTER_ACCEPT, NATIVE_FILTER_REJECT, entryPoint))
+	{
+		m_Instructions.clear();
+		return false;
+	}
+
+	// reverse the program so it starts with the entry point and all jumps are forward
+	uint16_t lastIndex = (uint16_t)(m_Instructions.size() - 1);
+	std::reverse(m_Instructions.begin(), m_Instructions.end());
+	for (std::vector<Instruction>::iterator it = m_Instructions.begin(); it != m_Instructions.end(); ++it)
+	{
+		if (it->jumpIfTrue < NATIVE_FILTER_MAX_INSTRUCTIONS)
+			it->jumpIfTrue = lastIndex - it->jumpIfTrue;
+		if (it->jumpIfFalse < NATIVE_FILTER_MAX_INSTRUCTIONS)
+			it->jumpIfFalse = lastIndex - it->jumpIfFalse;
+	}
+
+	m_EntryPoint = (entryPoint < NATIVE_FILTER_MAX_INSTRUCTIONS ? (uint16_t)(lastIndex - entryPoint) : entryPoint);
+	m_Root = root;
+	m_Compiled = true;
+	return true;
+}
+
+bool NativeFilterProgram::emitNode(const NativeFilterNode& node, uint16_t jumpIfTrue, uint16_t jumpIfFalse, uint16_t& entryPoint)
+{
+	switch (node.type)
+	{
+	case NativeFilterNode::PredicateNode:
+	{
+		if (m_Instructions.size() >= NATIVE_FILTER_MAX_INSTRUCTIONS)
+			return false;
+
+		Instruction instruction;
+		instruction.predicate = node.predicate;
+		instruction.jumpIfTrue = jumpIfTrue;
+		instruction.jumpIfFalse = jumpIfFalse;
+		m_Instructions.push_back(instruction);
+		entryPoint = (uint16_t)(m_Instructions.size() - 1);
+		return true;
+	}
+
+	case NativeFilterNode::NotNode:
+		return emitNode(node.children.front(), jumpIfFalse, jumpIfTrue, entryPoint);
+
+	default:
+	{
+		// like the BPF string of an empty AndFilter or OrFilter, a node without children matches all packets
+		if (node.children.empty())
+		{
+			entryPoint = jumpIfTrue;
+			return true;
+		}
+
+		// each child continues to the child after it when it doesn't decide the result, so the children are emitted from the last one,
+		// which decides the result by itself
+		bool andNode = (node.type == NativeFilterNode::AndNode);
+		entryPoint = (andNode ? jumpIfTrue : jumpIfFalse);
+		for (std::vector<NativeFilterNode>::const_reverse_iterator it = node.children.rbegin(); it != node.children.rend(); ++it)
+		{
+			uint16_t next = entryPoint;
+			if (!emitNode(*it, (andNode ? next : jumpIfTrue), (andNode ? jumpIfFalse : next), entryPoint))
+				return false;
+		}
+
+		return true;
+	}
+	}
+}
+
+void NativeFilterProgram::clear()
+{
+	m_Instructions.clear();
+	m_EntryPoint = NATIVE_FILTER_REJECT;
+	m_Compiled = false;
+	m_Root = NativeFilterNode();
+}
+
+bool NativeFilterProgram::matchPacket(const PacketView& view, const uint8_t* packetData, size_t packetDataLen) const
+{
+	uint16_t index = m_EntryPoint;
+	while (index < NATIVE_FILTER_MAX_INSTRUCTIONS)
+	{
+		const Instruction& instruction = m_Instructions[index];
+		index = (matchPredicate(instruction.predicate, view, packetData, packetDataLen) ? instruction.jumpIfTrue : instruction.jumpIfFalse);
+	}
+
+	return index == NATIVE_FILTER_ACCEPT;
+}
+
+bool NativeFilterProgram::matchPacket(const uint8_t* packetData, size_t packetDataLen, LinkLayerType linkType) const
+{
+	if (!m_Compiled)
+		return false;
+
+	// filters which match all packets or no packet don't need the headers
+	if (m_Instructions.empty())
+		return m_EntryPoint == NATIVE_FILTER_ACCEPT;
+
+	PacketView view;
+	FlowKeyExtractor::extract(packetData, packetDataLen, linkType, view);
+	return matchPacket(view, packetData, packetDataLen);
+}
+
+bool NativeFilterProgram::matchPacket(const RawPacket* rawPacket) const
+{
+	if (rawPacket == NULL)
+		return false;
+
+	return matchPacket(rawPacket->getRawData(), (size_t)rawPacket->getRawDataLen(), rawPacket->getLinkLayerType());
+}
+
+bool NativeFilterProgram::matchPacket(const PacketView& view, const uint8_t* packetData, size_t packetDataLen, NativeFilterProfile& profile) const
+{
+	if (profile.m_PredicateStats.size() != m_Instructions.size())
+	{
+		profile.m_PredicateStats.resize(m_Instructions.size());
+		profile.reset();
+	}
+
+	bool sample = (--profile.m_SampleCountdown == 0);
+	if (sample)
+		profile.m_SampleCountdown = profile.m_SampleRate;
+
+	uint16_t index = m_EntryPoint;
+	while (index < NATIVE_FILTER_MAX_INSTRUCTIONS)
+	{
+		const Instruction& instruction = m_Instructions[index];
+		FilterNodeStats& stats = profile.m_PredicateStats[index];
+
+		bool matched;
+		if (sample)
+		{
+			uint64_t startCycles = TimestampClock::readCycleCounter();
+			matched = matchPredicate(instruction.predicate, view, packetData, packetDataLen);
+			stats.cycles += TimestampClock::readCycleCounter() - startCycles;
+			stats.sampled++;
+		}
+		else
+			matched = matchPredicate(instruction.predicate, view, packetData, packetDataLen);
+
+		stats.evaluated++;
+		if (matched)
+			stats.matched++;
+
+		index = (matched ? instruction.jumpIfTrue : instruction.jumpIfFalse);
+	}
+
+	profile.m_NumOfPackets++;
+	if (index != NATIVE_FILTER_ACCEPT)
+		return false;
+
+	profile.m_NumOfMatchedPackets++;
+	return true;
+}
+
+bool NativeFilterProgram::matchPacket(const RawPacket* rawPacket, NativeFilterProfile& profile) const
+{
+	if (rawPacket == NULL || !m_Compiled)
+		return false;
+
+	const uint8_t* packetData = rawPacket->getRawData();
+	size_t packetDataLen = (size_t)rawPacket->getRawDataLen();
+
+	// filters which match all packets or no packet don't need the headers
+	PacketView view;
+	if (!m_Instructions.empty())
+		FlowKeyExtractor::extract(packetData, packetDataLen, rawPacket->getLinkLayerType(), view);
+
+	return matchPacket(view, packetData, packetDataLen, profile);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// MultiFilterProgram
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static inline void setBit(std::vector<uint64_t>& bits, size_t index)
+{
+	bits[index / 64] |= ((uint64_t)1 << (index % 64));
+}
+
+static inline bool isBitSet(const std::vector<uint64_t>& bits, size_t index)
+{
+	return ((bits[index / 64] >> (index % 64)) & 1) != 0;
+}
+
+static inline uint64_t getTableKey(uint32_t tableId, uint32_t value)
+{
+	return ((uint64_t)tableId << 32) | value;
+}
+
+void MultiFilterMatches::getMatchedIds(std::vector<int>& filterIds) const
+{
+	filterIds.clear();
+	for (size_t word = 0; word < m_Filters.size(); word++)
+	{
+		uint64_t bits = m_Filters[word];
+		for (int bit = 0; bits != 0; bit++, bits >>= 1)
+		{
+			if (bits & 1)
+				filterIds.push_back((int)(word * 64 + bit));
+		}
+	}
+}
+
+MultiFilterProgram::MultiFilterProgram() : m_NumOfFilters(0), m_ExactTableTypes(0)
+{
+}
+
+MultiFilterProgram::~MultiFilterProgram()
+{
+	clear();
+}
+
+void MultiFilterProgram::clear()
+{
+	for (std::vector<BpfFilter>::iterator iter = m_BpfFilters.begin(); iter != m_BpfFilters.end(); iter++)
+		delete iter->program;
+
+	m_NumOfFilters = 0;
+	m_Predicates.clear();
+	m_Tables.clear();
+	m_PredicateLists.clear();
+	m_ExactTableTypes = 0;
+	m_PrefixTables.clear();
+	m_TestedPredicates.clear();
+	m_Programs.clear();
+	m_BpfFilters.clear();
+	m_PredicateLookup.clear();
+	m_ProgramLookup.clear();
+}
+
+int MultiFilterProgram::addFilter(GeneralFilter& filter, LinkLayerType linkType)
+{
+	NativeFilterNode root;
+	if (filter.toNativeFilter(root))
+	{
+		int filterId = addFilter(root);
+		if (filterId >= 0)
+			return filterId;
+	}
+
+	// the filter (or a filter it contains) has no native equivalent, so it's matched with its own BPF program
+	std::string filterAsString;
+	filter.parseToString(filterAsString);
+	BpfFilterProgram* program = new BpfFilterProgram();
+	if (!program->compile(filterAsString, linkType))
+	{
+		delete program;
+		return -1;
+	}
+
+	BpfFilter bpfFilter;
+	bpfFilter.program = program;
+	bpfFilter.filterId = (int)m_NumOfFilters++;
+	m_BpfFilters.push_back(bpfFilter);
+	return bpfFilter.filterId;
+}
+
+int MultiFilterProgram::addFilter(const NativeFilterNode& root)
+{
+	NativeFilterProgram nativeProgram;
+	if (!nativeProgram.compile(root))
+		return -1;
+
+	// the program is keyed by its entry point and instructions, with predicates replaced by their shared indices, so filters which
+	// compile into the same instructions share one program
+	Program program;
+	program.entryPoint = nativeProgram.m_EntryPoint;
+	std::vector<uint32_t> programKey;
+	programKey.push_back(program.entryPoint);
+	for (std::vector<NativeFilterProgram::Instruction>::const_iterator iter = nativeProgram.m_Instructions.begin();
+			iter != nativeProgram.m_Instructions.end(); iter++)
+	{
+		Instruction instruction;
+		instruction.predicateIndex = addPredicate(iter->predicate);
+		instruction.jumpIfTrue = iter->jumpIfTrue;
+		instruction.jumpIfFalse = iter->jumpIfFalse;
+		program.instructions.push_back(instruction);
+
+		programKey.push_back(instruction.predicateIndex);
+		programKey.push_back(((uint32_t)instruction.jumpIfTrue << 16) | instruction.jumpIfFalse);
+	}
+
+	int filterId = (int)m_NumOfFilters++;
+	std::map<std::vector<uint32_t>, size_t>::const_iterator existing = m_ProgramLookup.find(programKey);
+	if (existing != m_ProgramLookup.end())
+	{
+		m_Programs[existing->second].filterIds.push_back(filterId);
+		return filterId;
+	}
+
+	program.filterIds.push_back(filterId);
+	m_ProgramLookup[programKey] = m_Programs.size();
+	m_Programs.push_back(program);
+	return filterId;
+}
+
+uint32_t MultiFilterProgram::addPredicate(const NativeFilterPredicate& predicate)
+{
+	uint64_t lookupKey = getTableKey((uint32_t)predicate.type, predicate.value);
+	std::pair<std::multimap<uint64_t, uint32_t>::const_iterator, std::multimap<uint64_t, uint32_t>::const_iterator> candidates =
+		m_PredicateLookup.equal_range(lookupKey);
+	for (std::multimap<uint64_t, uint32_t>::const_iterator iter = candidates.first; iter != candidates.second; iter++)
+	{
+		if (isSamePredicate(m_Predicates[iter->second], predicate))
+			return iter->second;
+	}
+
+	uint32_t predicateIndex = (uint32_t)m_Predicates.size();
+	m_Predicates.push_back(predicate);
+	m_PredicateLookup.insert(std::make_pair(lookupKey, predicateIndex));
+
+	switch (predicate.type)
+	{
+	case NativeFilterIPVersion:
+	case NativeFilterIPProtocol:
+	case NativeFilterVlanId:
+	case NativeFilterEtherType:
+	case NativeFilterArpOpcode:
+		addToTable((uint32_t)predicate.type, predicate.value, predicateIndex);
+		return predicateIndex;
+
+	case NativeFilterSrcPort:
+	case NativeFilterDstPort:
+		// only single ports are looked up, ranges are tested
+		if (predicate.value == predicate.upperValue)
+		{
+			addToTable((uint32_t)predicate.type, predicate.value, predicateIndex);
+			return predicateIndex;
+		}
+		break;
+
+	case NativeFilterSrcIPv4:
+	case NativeFilterDstIPv4:
+	{
+		size_t tableIndex = 0;
+		while (tableIndex < m_PrefixTables.size() &&
+				(m_PrefixTables[tableIndex].type != predicate.type || m_PrefixTables[tableIndex].mask != predicate.mask))
+			tableIndex++;
+
+		if (tableIndex == m_PrefixTables.size())
+		{
+			PrefixTable prefixTable;
+			prefixTable.type = predicate.type;
+			prefixTable.mask = predicate.mask;
+			m_PrefixTables.push_back(prefixTable);
+		}
+
+		addToTable(MULTI_FILTER_PREFIX_TABLE_BASE + (uint32_t)tableIndex, predicate.value, predicateIndex);
+		return predicateIndex;
+	}
+
+	default:
+		break;
+	}
+
+	m_TestedPredicates.push_back(predicateIndex);
+	return predicateIndex;
+}
+
+void MultiFilterProgram::addToTable(uint32_t tableId, uint32_t value, uint32_t predicateIndex)
+{
+	if (tableId < MULTI_FILTER_PREFIX_TABLE_BASE)
+		m_ExactTableTypes |= ((uint32_t)1 << tableId);
+
+	bool isNew = false;
+	uint32_t& listIndex = m_Tables.get(getTableKey(tableId, value), &isNew);
+	if (isNew)
+	{
+		listIndex = (uint32_t)m_PredicateLists.size();
+		m_PredicateLists.push_back(std::vector<uint32_t>());
+	}
+
+	m_PredicateLists[listIndex].push_back(predicateIndex);
+}
+
+void MultiFilterProgram::evaluatePredicates(const PacketView& view, const uint8_t* packetData, size_t packetDataLen,
+	std::vector<uint64_t>& results) const
+{
+	// the values the exact tables are looked up with, following the conditions matchPredicate() checks before comparing the field
+	uint32_t lookupTypes[8];
+	uint32_t lookupValues[8];
+	size_t numOfLookups = 0;
+
+	lookupTypes[numOfLookups] = NativeFilterIPVersion;
+	lookupValues[numOfLookups++] = view.ipVersion;
+
+	if (view.ipVersion != 0)
+	{
+		lookupTypes[numOfLookups] = NativeFilterIPProtocol;
+		lookupValues[numOfLookups++] = view.ipProtocol;
+	}
+
+	if (view.vlanCount > 0)
+	{
+		lookupTypes[numOfLookups] = NativeFilterVlanId;
+		lookupValues[numOfLookups++] = view.vlanId;
+	}
+
+	if (view.isPacketOfType((ProtocolType)(TCP | UDP)))
+	{
+		lookupTypes[numOfLookups] = NativeFilterSrcPort;
+		lookupValues[numOfLookups++] = view.srcPort;
+		lookupTypes[numOfLookups] = NativeFilterDstPort;
+		lookupValues[numOfLookups++] = view.dstPort;
+	}
+
+	size_t etherTypeOffset = getEtherTypeOffset(view, packetDataLen);
+	if (etherTypeOffset != 0)
+	{
+		uint16_t etherType = (uint16_t)((packetData[etherTypeOffset] << 8) | packetData[etherTypeOffset + 1]);
+		lookupTypes[numOfLookups] = NativeFilterEtherType;
+		lookupValues[numOfLookups++] = etherType;
+
+		size_t opcodeOffset = etherTypeOffset + 2 + ARP_OPCODE_OFFSET;
+		if (etherType == PCPP_ETHERTYPE_ARP && opcodeOffset < packetDataLen)
+		{
+			lookupTypes[numOfLookups] = NativeFilterArpOpcode;
+			lookupValues[numOfLookups++] = packetData[opcodeOffset];
+		}
+	}
+
+	for (size_t i = 0; i < numOfLookups; i++)
+	{
+		if ((m_ExactTableTypes & ((uint32_t)1 << lookupTypes[i])) == 0)
+			continue;
+
+		const uint32_t* listIndex = m_Tables.find(getTableKey(lookupTypes[i], lookupValues[i]));
+		if (listIndex == NULL)
+			continue;
+
+		const std::vector<uint32_t>& predicateList = m_PredicateLists[*listIndex];
+		for (std::vector<uint32_t>::const_iterator iter = predicateList.begin(); iter != predicateList.end(); iter++)
+			setBit(results, *iter);
+	}
+
+	if (view.ipVersion == 4)
+	{
+		for (size_t tableIndex = 0; tableIndex < m_PrefixTables.size(); tableIndex++)
+		{
+			const PrefixTable& prefixTable = m_PrefixTables[tableIndex];
+			uint32_t address;
+			memcpy(&address, (prefixTable.type == NativeFilterSrcIPv4 ? view.srcIP : view.dstIP), sizeof(address));
+
+			const uint32_t* listIndex = m_Tables.find(getTableKey(MULTI_FILTER_PREFIX_TABLE_BASE + (uint32_t)tableIndex, address & prefixTable.mask));
+			if (listIndex == NULL)
+				continue;
+
+			const std::vector<uint32_t>& predicateList = m_PredicateLists[*listIndex];
+			for (std::vector<uint32_t>::const_iterator iter = predicateList.begin(); iter != predicateList.end(); iter++)
+				setBit(results, *iter);
+		}
+	}
+
+	for (std::vector<uint32_t>::const_iterator iter = m_TestedPredicates.begin(); iter != m_TestedPredicates.end(); iter++)
+	{
+		if (matchPredicate(m_Predicates[*iter], view, packetData, packetDataLen))
+			setBit(results, *iter);
+	}
+}
+
+size_t MultiFilterProgram::matchPacket(const uint8_t* packetData, size_t packetDataLen, LinkLayerType linkType, MultiFilterMatches& matches) const
+{
+	matches.m_Filters.assign((m_NumOfFilters + 63) / 64, 0);
+	matches.m_NumOfMatched = 0;
+
+	if (!m_Programs.empty())
+	{
+		matches.m_Predicates.assign((m_Predicates.size() + 63) / 64, 0);
+		if (!m_Predicates.empty())
+		{
+			PacketView view;
+			FlowKeyExtractor::extract(packetData, packetDataLen, linkType, view);
+			evaluatePredicates(view, packetData, packetDataLen, matches.m_Predicates);
+		}
+
+		for (std::vector<Program>::const_iterator program = m_Programs.begin(); program != m_Programs.end(); program++)
+		{
+			uint16_t index = program->entryPoint;
+			while (index < NATIVE_FILTER_MAX_INSTRUCTIONS)
+			{
+				const Instruction& instruction = program->instructions[index];
+				index = (isBitSet(matches.m_Predicates, instruction.predicateIndex) ? instruction.jumpIfTrue : instruction.jumpIfFalse);
+			}
+
+			if (index != NATIVE_FILTER_ACCEPT)
+				continue;
+
+			for (std::vector<int>::const_iterator filterId = program->filterIds.begin(); filterId != program->filterIds.end(); filterId++)
+				setBit(matches.m_Filters, (size_t)*filterId);
+			matches.m_NumOfMatched += program->filterIds.size();
+		}
+	}
+
+	for (std::vector<BpfFilter>::const_iterator iter = m_BpfFilters.begin(); iter != m_BpfFilters.end(); iter++)
+	{
+		if (iter->program->getLinkType() == linkType &&
+				iter->program->matchPacket(packetData, (uint32_t)packetDataLen, (uint32_t)packetDataLen))
+		{
+			setBit(matches.m_Filters, (size_t)iter->filterId);
+			matches.m_NumOfMatched++;
+		}
+	}
+
+	return matches.m_NumOfMatched;
+}
+
+size_t MultiFilterProgram::matchPacket(const RawPacket* rawPacket, MultiFilterMatches& matches) const
+{
+	if (rawPacket == NULL)
+	{
+		matches.m_Filters.assign((m_NumOfFilters + 63) / 64, 0);
+		matches.m_NumOfMatched = 0;
+		return 0;
+	}
+
+	return matchPacket(rawPacket->getRawData(), (size_t)rawPacket->getRawDataLen(), rawPacket->getLinkLayerType(), matches);
+}
+
+} // namespace pcpp
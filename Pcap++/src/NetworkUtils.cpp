@@ -1,6 +1,7 @@
 #define LOG_MODULE NetworkUtils
 
 #include <stdlib.h>
+#include <algorithm>
 #include <pthread.h>
 #include "Logger.h"
 #include "Packet.h"
@@ -10,6 +11,7 @@
 #include "UdpLayer.h"
 #include "DnsLayer.h"
 #include "PcapFilter.h"
+#include "TimestampClock.h"
 #include "NetworkUtils.h"
 #ifdef LINUX //for using ntohl, ntohs, etc.
 #include <in.h>
@@ -227,62 +229,36 @@ struct DNSRecievedData
 	double dnsResponseTime;
 };
 
-static void dnsResponseRecieved(RawPacket* rawPacket, PcapLiveDevice* device, void* userCookie)
+// find the IPv4 resolving of a hostname in a DNS response. Returns NULL if the response doesn't have one
+static DnsResource* findIPv4Answer(DnsLayer* dnsResponseLayer, const std::string& hostname)
 {
-	// extract timestamp of packet
-	clock_t recieveTime = clock();
-
-	// get data from the main thread
-	DNSRecievedData* data = (DNSRecievedData*)userCookie;
-
-	// parse the response packet
-	Packet packet(rawPacket);
-
-	// verify that it's an DNS packet (although it must be because DNS port filter was set on the interface)
-	if (!packet.isPacketOfType(DNS))
-		return;
-
-	// extract the DNS layer from the packet
-	DnsLayer* dnsResponseLayer = packet.getLayerOfType<DnsLayer>();
-	if (dnsResponseLayer == NULL)
-		return;
-
-	// verify it's the right DNS response
-	if (dnsResponseLayer->getDnsHeader()->queryOrResponse != 1 /* DNS response */
-			|| dnsResponseLayer->getDnsHeader()->numberOfAnswers < htons(1)
-			|| dnsResponseLayer->getDnsHeader()->transactionID != htons(data->transactionID))
-	{
-		return;
-	}
-
 	// DNS resolving can be recursive as many DNS responses contain multiple answers with recursive canonical names (CNAME) for
 	// the hostname. For example: a DNS response for www.a.com can have multiple answers:
 	//- First with CNAME: www.a.com -> www.b.com
 	//- Second with CNAME: www.b.com -> www.c.com
 	//- Third with resolving: www.c.com -> 1.1.1.1
-	// So the search must be recursive until an IPv4 resolving is found or until no hostname or canonical name are found (and then return)
+	// So the search must be recursive until an IPv4 resolving is found or until no hostname or canonical name are found (and then return).
+	// Each answer can be followed once, so a loop of canonical names ends the search too
 
-	std::string hostToFind = data->hostname;
+	std::string hostToFind = hostname;
 
-	DnsResource* dnsAnswer = NULL;
-
-	while (true)
+	for (size_t i = 0; i <= dnsResponseLayer->getAnswerCount(); i++)
 	{
-		dnsAnswer = dnsResponseLayer->getAnswer(hostToFind, true);
+		DnsResource* dnsAnswer = dnsResponseLayer->getAnswer(hostToFind, true);
 
 		// if response doesn't contain hostname or cname - return
 		if (dnsAnswer == NULL)
 		{
 			LOG_DEBUG("DNS answer doesn't contain hostname '%s'", hostToFind.c_str());
-			return;
+			return NULL;
 		}
 
 		DnsType dnsType = dnsAnswer->getDnsType();
-		// if answer contains IPv4 resolving - break the loop and return the IP address
+		// if answer contains IPv4 resolving - return it
 		if (dnsType == DNS_TYPE_A)
 		{
 			LOG_DEBUG("Found IPv4 resolving for hostname '%s'", hostToFind.c_str());
-			break;
+			return dnsAnswer;
 		}
 		// if answer contains a cname - continue to search this cname in the packet - hopefully find the IP resolving
 		else if (dnsType == DNS_TYPE_CNAME)
@@ -294,9 +270,46 @@ static void dnsResponseRecieved(RawPacket* rawPacket, PcapLiveDevice* device, vo
 		else
 		{
 			LOG_DEBUG("Got a DNS response with type which is not A or CNAME");
-			return;
+			return NULL;
 		}
 	}
+
+	return NULL;
+}
+
+
+static void dnsResponseRecieved(RawPacket* rawPacket, PcapLiveDevice* device, void* userCookie)
+{
+	// extract timestamp of packet
+	clock_t recieveTime = clock();
+
+	// get data from the main thread
+	DNSRecievedData* data = (DNSRecievedData*)userCookie;
+
+	// parse the response packet
+	Packet packet(rawPacket);
+
+	// verify that it's an DNS packet (although it must be because DNS port filter was set on the interface)
+	if (!packet.isPacketOfType(DNS))
+		return;
+
+	// extract the DNS layer from the packet
+	DnsLayer* dnsResponseLayer = packet.getLayerOfType<DnsLayer>();
+	if (dnsResponseLayer == NULL)
+		return;
+
+	// verify it's the right DNS response
+	if (dnsResponseLayer->getDnsHeader()->queryOrResponse != 1 /* DNS response */
+			|| dnsResponseLayer->getDnsHeader()->numberOfAnswers < htons(1)
+			|| dnsResponseLayer->getDnsHeader()->transactionID != htons(data->transactionID))
+	{
+		return;
+	}
+
+	DnsResource* dnsAnswer = findIPv4Answer(dnsResponseLayer, data->hostname);
+	if (dnsAnswer == NULL)
+		return;
+
 	// if we got here it means an IPv4 resolving was found
 
 	// measure response time
@@ -481,4 +494,470 @@ IPv4Address NetworkUtils::getIPv4Address(std::string hostname, PcapLiveDevice* d
 	return result;
 }
 
+
+BatchResolver::BatchResolver(PcapLiveDevice* device, const BatchResolverConfiguration& config) :
+		m_Device(device), m_Config(config), m_SendSeq(0), m_NumOfRequestsSent(0), m_NumOfResponses(0), m_NumOfTimeouts(0)
+{
+	if (m_Config.maxOutstandingRequests == 0)
+		m_Config.maxOutstandingRequests = 1;
+
+	pthread_mutex_init(&m_Mutex, NULL);
+	pthread_cond_init(&m_RequestCompleted, NULL);
+}
+
+
+BatchResolver::~BatchResolver()
+{
+	pthread_mutex_destroy(&m_Mutex);
+	pthread_cond_destroy(&m_RequestCompleted);
+}
+
+
+bool BatchResolver::findRequest(uint64_t key, size_t& requestIndex) const
+{
+	const PendingRequest* request = m_PendingRequests.find(key);
+	if (request == NULL)
+		return false;
+
+	requestIndex = request->requestIndex;
+	return true;
+}
+
+
+double BatchResolver::completeRequest(uint64_t key)
+{
+	PendingRequest* request = m_PendingRequests.find(key);
+	if (request == NULL)
+		return 0;
+
+	double responseTimeMS = (TimestampClock::nowNs() - request->sendTimeNs) / 1000000.0;
+	m_PendingRequests.erase(key);
+	m_NumOfResponses++;
+
+	// wake the sending thread, which may be waiting for room for more requests
+	pthread_cond_signal(&m_RequestCompleted);
+
+	return responseTimeMS;
+}
+
+
+void BatchResolver::expireRequests(uint64_t nowNs)
+{
+	uint64_t timeoutNs = (uint64_t)m_Config.timeoutMs * 1000000;
+
+	while (!m_SentRequests.empty() && m_SentRequests.front().sendTimeNs + timeoutNs <= nowNs)
+	{
+		SentRequest sent = m_SentRequests.front();
+		m_SentRequests.pop_front();
+
+		// skip requests which were answered, and old entries of requests which were sent again
+		PendingRequest* request = m_PendingRequests.find(sent.key);
+		if (request == NULL || request->sendSeq != sent.sendSeq)
+			continue;
+
+		size_t requestIndex = request->requestIndex;
+		int retriesLeft = request->retriesLeft;
+		m_PendingRequests.erase(sent.key);
+
+		if (retriesLeft > 0)
+		{
+			m_RetryRequests.push_back(std::pair<size_t, int>(requestIndex, retriesLeft - 1));
+		}
+		else
+		{
+			m_NumOfTimeouts++;
+			onRequestFailed(requestIndex);
+		}
+	}
+}
+
+
+bool BatchResolver::runBatch(size_t numOfRequests, GeneralFilter& responseFilter, OnPacketArrivesCallback onResponseArrives)
+{
+	m_PendingRequests.clear();
+	m_PendingRequests.reserve(m_Config.maxOutstandingRequests);
+	m_SentRequests.clear();
+	m_RetryRequests.clear();
+	m_NumOfRequestsSent = 0;
+	m_NumOfResponses = 0;
+	m_NumOfTimeouts = 0;
+
+	// open the device if not already opened
+	bool closeDeviceAtTheEnd = false;
+	if (!m_Device->isOpened())
+	{
+		closeDeviceAtTheEnd = true;
+		if (!m_Device->open())
+		{
+			LOG_ERROR("Cannot open device");
+			return false;
+		}
+	}
+
+	if (!m_Device->setFilter(responseFilter))
+	{
+		LOG_ERROR("Couldn't set response filter for device");
+		if (closeDeviceAtTheEnd)
+			m_Device->close();
+		return false;
+	}
+
+	// the capture runs for the whole batch
+	if (!m_Device->startCapture(onResponseArrives, this))
+	{
+		LOG_ERROR("Couldn't start capturing on device");
+		if (closeDeviceAtTheEnd)
+			m_Device->close();
+		else
+			m_Device->clearFilter();
+		return false;
+	}
+
+	std::vector<std::pair<size_t, uint64_t> > requestsToSend;
+	size_t nextRequest = 0;
+	uint64_t startTimeNs = TimestampClock::nowNs();
+
+	lock();
+
+	while (nextRequest < numOfRequests || !m_RetryRequests.empty() || m_PendingRequests.size() > 0)
+	{
+		uint64_t nowNs = TimestampClock::nowNs();
+
+		expireRequests(nowNs);
+
+		// the number of requests the rate limit allows to have been sent by now
+		uint64_t allowedRequests = (uint64_t)-1;
+		if (m_Config.requestsPerSecond > 0)
+			allowedRequests = 1 + (nowNs - startTimeNs) * m_Config.requestsPerSecond / 1000000000;
+
+		// choose the requests to send in this round. Retries are sent first
+		requestsToSend.clear();
+		while (m_PendingRequests.size() < m_Config.maxOutstandingRequests && m_NumOfRequestsSent < allowedRequests &&
+				(nextRequest < numOfRequests || !m_RetryRequests.empty()))
+		{
+			size_t requestIndex;
+			int retriesLeft;
+			if (!m_RetryRequests.empty())
+			{
+				requestIndex = m_RetryRequests.front().first;
+				retriesLeft = m_RetryRequests.front().second;
+				m_RetryRequests.pop_front();
+			}
+			else
+			{
+				requestIndex = nextRequest++;
+				retriesLeft = m_Config.numOfRetries;
+			}
+
+			uint64_t key;
+			if (!getRequestKey(requestIndex, key))
+				continue;
+
+			// the request is outstanding before it's sent, so its response can't arrive before it's found
+			PendingRequest& request = m_PendingRequests[key];
+			request.requestIndex = requestIndex;
+			request.sendTimeNs = nowNs;
+			request.sendSeq = ++m_SendSeq;
+			request.retriesLeft = retriesLeft;
+
+			SentRequest sent = { key, nowNs, m_SendSeq };
+			m_SentRequests.push_back(sent);
+
+			requestsToSend.push_back(std::pair<size_t, uint64_t>(requestIndex, key));
+			m_NumOfRequestsSent++;
+		}
+
+		unlock();
+
+		// a request which couldn't be sent isn't removed, it simply times out
+		for (std::vector<std::pair<size_t, uint64_t> >::iterator iter = requestsToSend.begin(); iter != requestsToSend.end(); iter++)
+			sendRequest(iter->first, iter->second);
+		if (!requestsToSend.empty())
+			m_Device->flushTxBuffer();
+
+		lock();
+
+		if (nextRequest >= numOfRequests && m_RetryRequests.empty() && m_PendingRequests.size() == 0)
+			break;
+
+		// wait until a response makes room for more requests, the oldest request times out or the rate limit allows the next request
+		uint64_t waitNs = 100000000;
+		if (!m_SentRequests.empty())
+		{
+			uint64_t expiryNs = m_SentRequests.front().sendTimeNs + (uint64_t)m_Config.timeoutMs * 1000000;
+			nowNs = TimestampClock::nowNs();
+			waitNs = std::min<uint64_t>(waitNs, expiryNs > nowNs ? expiryNs - nowNs : 0);
+		}
+		if (m_Config.requestsPerSecond > 0 && m_PendingRequests.size() < m_Config.maxOutstandingRequests &&
+				(nextRequest < numOfRequests || !m_RetryRequests.empty()))
+		{
+			waitNs = std::min<uint64_t>(waitNs, 1000000000 / m_Config.requestsPerSecond);
+		}
+
+		if (waitNs > 0)
+		{
+			struct timeval now;
+			gettimeofday(&now, NULL);
+			uint64_t deadlineNs = (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_usec * 1000 + waitNs;
+			timespec deadline;
+			deadline.tv_sec = (time_t)(deadlineNs / 1000000000);
+			deadline.tv_nsec = (long)(deadlineNs % 1000000000);
+			pthread_cond_timedwait(&m_RequestCompleted, &m_Mutex, &deadline);
+		}
+	}
+
+	unlock();
+
+	m_Device->stopCapture();
+
+	if (closeDeviceAtTheEnd)
+		m_Device->close();
+	else
+		m_Device->clearFilter();
+
+	return true;
+}
+
+
+ArpBatchResolver::ArpBatchResolver(PcapLiveDevice* device, OnArpResolved onArpResolved, void* userCookie,
+		const BatchResolverConfiguration& config, MacAddress sourceMac, IPv4Address sourceIP) :
+		BatchResolver(device, config), m_OnArpResolved(onArpResolved), m_UserCookie(userCookie), m_SourceMac(sourceMac), m_SourceIP(sourceIP),
+		m_IPAddresses(NULL), m_Request(NULL)
+{
+}
+
+
+int ArpBatchResolver::resolve(const std::vector<IPv4Address>& ipAddresses)
+{
+	MacAddress sourceMac = (m_SourceMac == MacAddress::Zero ? m_Device->getMacAddress() : m_SourceMac);
+	IPv4Address sourceIP = (m_SourceIP == IPv4Address::Zero ? m_Device->getIPv4Address() : m_SourceIP);
+
+	// all requests are sent from a single packet in which only the target IP changes
+	MacAddress destMac(0xff, 0xff, 0xff, 0xff, 0xff, 0xff);
+	EthLayer ethLayer(sourceMac, destMac);
+	ArpLayer arpLayer(ARP_REQUEST, sourceMac, destMac, sourceIP, IPv4Address::Zero);
+
+	Packet arpRequest(100);
+	if (!arpRequest.addLayer(&ethLayer) || !arpRequest.addLayer(&arpLayer))
+	{
+		LOG_ERROR("Couldn't build ARP request");
+		return -1;
+	}
+
+	arpRequest.computeCalculateFields();
+
+	// an address which appears more than once is resolved once
+	std::vector<IPv4Address> uniqueIPAddresses;
+	uniqueIPAddresses.reserve(ipAddresses.size());
+	FlatHashMap<bool> addressesSeen;
+	for (std::vector<IPv4Address>::const_iterator iter = ipAddresses.begin(); iter != ipAddresses.end(); iter++)
+	{
+		bool isNew;
+		addressesSeen.get(iter->toInt(), &isNew);
+		if (isNew)
+			uniqueIPAddresses.push_back(*iter);
+	}
+
+	m_IPAddresses = &uniqueIPAddresses;
+	m_Request = &arpRequest;
+
+	ArpFilter arpFilter(ARP_REPLY);
+	bool success = runBatch(uniqueIPAddresses.size(), arpFilter, onPacketArrives);
+
+	m_IPAddresses = NULL;
+	m_Request = NULL;
+
+	return success ? (int)getNumOfResponses() : -1;
+}
+
+
+void ArpBatchResolver::onPacketArrives(RawPacket* rawPacket, PcapLiveDevice* device, void* userCookie)
+{
+	ArpBatchResolver* resolver = static_cast<ArpBatchResolver*>((BatchResolver*)userCookie);
+
+	Packet packet(rawPacket);
+	ArpLayer* arpReplyLayer = packet.getLayerOfType<ArpLayer>();
+	if (arpReplyLayer == NULL)
+		return;
+
+	if (arpReplyLayer->getArpHeader()->hardwareType != htons(1) /* Ethernet */
+			|| arpReplyLayer->getArpHeader()->protocolType != htons(PCPP_ETHERTYPE_IP))
+		return;
+
+	// the reply is matched with the request by the sender IP, which is the target IP of the request
+	IPv4Address senderIP = arpReplyLayer->getSenderIpAddr();
+
+	resolver->lock();
+
+	size_t requestIndex;
+	if (resolver->findRequest(senderIP.toInt(), requestIndex))
+	{
+		double responseTimeMS = resolver->completeRequest(senderIP.toInt());
+		resolver->m_OnArpResolved(senderIP, arpReplyLayer->getSenderMacAddress(), responseTimeMS, resolver->m_UserCookie);
+	}
+
+	resolver->unlock();
+}
+
+
+bool ArpBatchResolver::getRequestKey(size_t requestIndex, uint64_t& key)
+{
+	key = m_IPAddresses->at(requestIndex).toInt();
+	return true;
+}
+
+
+bool ArpBatchResolver::sendRequest(size_t requestIndex, uint64_t key)
+{
+	// only the sending thread uses the request packet
+	ArpLayer* arpLayer = m_Request->getLayerOfType<ArpLayer>();
+	arpLayer->getArpHeader()->targetIpAddr = m_IPAddresses->at(requestIndex).toInt();
+
+	return m_Device->sendPacket(m_Request, true);
+}
+
+
+void ArpBatchResolver::onRequestFailed(size_t requestIndex)
+{
+	m_OnArpResolved(m_IPAddresses->at(requestIndex), MacAddress::Zero, 0, m_UserCookie);
+}
+
+
+DnsBatchResolver::DnsBatchResolver(PcapLiveDevice* device, OnDnsResolved onDnsResolved, void* userCookie,
+		const BatchResolverConfiguration& config, IPv4Address dnsServerIP, IPv4Address gatewayIP) :
+		BatchResolver(device, BatchResolverConfiguration(std::min<size_t>(config.maxOutstandingRequests, 65535), config.requestsPerSecond,
+				config.timeoutMs, config.numOfRetries)),
+		m_OnDnsResolved(onDnsResolved), m_UserCookie(userCookie), m_DnsServerIP(dnsServerIP), m_GatewayIP(gatewayIP),
+		m_GatewayMac(MacAddress::Zero), m_SrcPort(0), m_NextTransactionID(0), m_NumOfResolved(0), m_Hostnames(NULL)
+{
+}
+
+
+int DnsBatchResolver::resolve(const std::vector<std::string>& hostnames)
+{
+	// resolve the gateway MAC address first, before the capture of the batch is started
+	IPv4Address gatewayIP = (m_GatewayIP == IPv4Address::Zero ? m_Device->getDefaultGateway() : m_GatewayIP);
+	if (!gatewayIP.isValid() || gatewayIP == IPv4Address::Zero)
+	{
+		LOG_ERROR("Gateway address isn't valid or couldn't find default gateway");
+		return -1;
+	}
+
+	double arpResTime;
+	m_GatewayMac = NetworkUtils::getInstance().getMacAddress(gatewayIP, m_Device, arpResTime);
+	if (m_GatewayMac == MacAddress::Zero)
+	{
+		LOG_ERROR("Couldn't resolve gateway MAC address");
+		return -1;
+	}
+
+	if (m_DnsServerIP == IPv4Address::Zero && m_Device->getDnsServers().size() > 0)
+		m_DnsServerIP = m_Device->getDnsServers().at(0);
+
+	if (!m_DnsServerIP.isValid())
+	{
+		LOG_ERROR("DNS server IP isn't valid");
+		return -1;
+	}
+
+	// all requests are sent from a single source port >= 10000, and only the responses sent to it are captured
+	int srcPortLowest = 10000;
+	int srcPortRange = 65535 - srcPortLowest;
+	m_SrcPort = (rand() % srcPortRange) + srcPortLowest;
+	m_NextTransactionID = rand() % 65535;
+	m_NumOfResolved = 0;
+	m_Hostnames = &hostnames;
+
+	PortFilter srcPortFilter(DNS_PORT, SRC);
+	PortFilter dstPortFilter(m_SrcPort, DST);
+	AndFilter dnsResponseFilter;
+	dnsResponseFilter.addFilter(&srcPortFilter);
+	dnsResponseFilter.addFilter(&dstPortFilter);
+
+	bool success = runBatch(hostnames.size(), dnsResponseFilter, onPacketArrives);
+
+	m_Hostnames = NULL;
+
+	return success ? m_NumOfResolved : -1;
+}
+
+
+void DnsBatchResolver::onPacketArrives(RawPacket* rawPacket, PcapLiveDevice* device, void* userCookie)
+{
+	DnsBatchResolver* resolver = static_cast<DnsBatchResolver*>((BatchResolver*)userCookie);
+
+	Packet packet(rawPacket);
+	DnsLayer* dnsResponseLayer = packet.getLayerOfType<DnsLayer>();
+	if (dnsResponseLayer == NULL || dnsResponseLayer->getDnsHeader()->queryOrResponse != 1 /* DNS response */)
+		return;
+
+	uint16_t transactionID = ntohs(dnsResponseLayer->getDnsHeader()->transactionID);
+
+	resolver->lock();
+
+	size_t requestIndex;
+	if (resolver->findRequest(transactionID, requestIndex))
+	{
+		// any response completes the request, including responses without an IPv4 address for the hostname (for example when the
+		// hostname doesn't exist)
+		const std::string& hostname = resolver->m_Hostnames->at(requestIndex);
+		DnsResource* dnsAnswer = findIPv4Answer(dnsResponseLayer, hostname);
+
+		double responseTimeMS = resolver->completeRequest(transactionID);
+		if (dnsAnswer != NULL)
+		{
+			resolver->m_NumOfResolved++;
+			resolver->m_OnDnsResolved(hostname, dnsAnswer->getData()->castAs<IPv4DnsResourceData>()->getIpAddress(), dnsAnswer->getTTL(),
+					responseTimeMS, resolver->m_UserCookie);
+		}
+		else
+		{
+			resolver->m_OnDnsResolved(hostname, IPv4Address::Zero, 0, responseTimeMS, resolver->m_UserCookie);
+		}
+	}
+
+	resolver->unlock();
+}
+
+
+bool DnsBatchResolver::getRequestKey(size_t requestIndex, uint64_t& key)
+{
+	// transaction IDs are given in turn, skipping the IDs of outstanding requests. There are at most 65535 of them, so a free ID exists
+	size_t otherRequestIndex;
+	while (findRequest(m_NextTransactionID, otherRequestIndex))
+		m_NextTransactionID++;
+
+	key = m_NextTransactionID++;
+	return true;
+}
+
+
+bool DnsBatchResolver::sendRequest(size_t requestIndex, uint64_t key)
+{
+	Packet dnsRequest(100);
+	EthLayer ethLayer(m_Device->getMacAddress(), m_GatewayMac, PCPP_ETHERTYPE_IP);
+	IPv4Layer ipLayer(m_Device->getIPv4Address(), m_DnsServerIP);
+	ipLayer.getIPv4Header()->timeToLive = 128;
+	UdpLayer udpLayer(m_SrcPort, DNS_PORT);
+	DnsLayer dnsLayer;
+	dnsLayer.getDnsHeader()->transactionID = htons((uint16_t)key);
+	dnsLayer.addQuery(m_Hostnames->at(requestIndex), DNS_TYPE_A, DNS_CLASS_IN);
+
+	if (!dnsRequest.addLayer(&ethLayer) || !dnsRequest.addLayer(&ipLayer) || !dnsRequest.addLayer(&udpLayer) || !dnsRequest.addLayer(&dnsLayer))
+	{
+		LOG_ERROR("Couldn't construct DNS query for '%s'", m_Hostnames->at(requestIndex).c_str());
+		return false;
+	}
+
+	dnsRequest.computeCalculateFields();
+
+	return m_Device->sendPacket(&dnsRequest, true);
+}
+
+
+void DnsBatchResolver::onRequestFailed(size_t requestIndex)
+{
+	m_OnDnsResolved(m_Hostnames->at(requestIndex), IPv4Address::Zero, 0, 0, m_UserCookie);
+}
+
 } // namespace pcpp
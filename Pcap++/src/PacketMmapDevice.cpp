@@ -0,0 +1,536 @@
+#define LOG_MODULE PcapLogModulePacketMmapDevice
+
+#include "PacketMmapDevice.h"
+#include "PcapFilter.h"
+#include "Logger.h"
+#include <string.h>
+#include <errno.h>
+#ifdef LINUX
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+#include <pcap.h>
+#endif
+
+// how long a capture thread waits for a block before checking whether it was asked to stop. The kernel doesn't hand over empty blocks
+#define CAPTURE_THREAD_POLL_TIMEOUT_MS 100
+
+namespace pcpp
+{
+
+PacketMmapDevice::PacketMmapDevice(const std::string& interfaceName, const DeviceConfiguration& config) :
+	m_InterfaceName(interfaceName), m_Config(config)
+{
+	m_Rings = NULL;
+	m_NumOfOpenedRings = 0;
+	m_InterfaceIndex = -1;
+	m_CaptureThreadsStarted = false;
+	m_StopThreads = false;
+	m_OnPacketsArrive = NULL;
+	m_OnPacketsArriveUserCookie = NULL;
+	m_IsFilterSet = false;
+}
+
+PacketMmapDevice::~PacketMmapDevice()
+{
+	close();
+}
+
+bool PacketMmapDevice::open()
+{
+#ifdef LINUX
+
+	if (m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' already opened", m_InterfaceName.c_str());
+		return false;
+	}
+
+	if (m_Config.numOfRxRings == 0 || m_Config.numOfBlocks == 0 || m_Config.frameSize == 0 || m_Config.blockSize < m_Config.frameSize ||
+			m_Config.blockSize % m_Config.frameSize != 0 || m_Config.blockSize % getpagesize() != 0)
+	{
+		LOG_ERROR("Invalid ring configuration for device '%s': the block size must be a multiple of the page size and of the frame size",
+				m_InterfaceName.c_str());
+		return false;
+	}
+
+	m_InterfaceIndex = (int)if_nametoindex(m_InterfaceName.c_str());
+	if (m_InterfaceIndex == 0)
+	{
+		LOG_ERROR("Cannot find interface '%s'", m_InterfaceName.c_str());
+		return false;
+	}
+
+	m_Rings = new RxRing[m_Config.numOfRxRings];
+	for (m_NumOfOpenedRings = 0; m_NumOfOpenedRings < m_Config.numOfRxRings; m_NumOfOpenedRings++)
+	{
+		RxRing& ring = m_Rings[m_NumOfOpenedRings];
+		ring.id = m_NumOfOpenedRings;
+		ring.device = this;
+		if (!openRing(ring))
+		{
+			for (uint8_t i = 0; i < m_NumOfOpenedRings; i++)
+				closeRing(m_Rings[i]);
+			delete [] m_Rings;
+			m_Rings = NULL;
+			m_NumOfOpenedRings = 0;
+			return false;
+		}
+	}
+
+	m_DeviceOpened = true;
+	LOG_DEBUG("Device '%s' opened with %d RX rings", m_InterfaceName.c_str(), (int)m_NumOfOpenedRings);
+	return true;
+
+#else
+
+	LOG_ERROR("PacketMmapDevice is supported on Linux only");
+	return false;
+
+#endif
+}
+
+void PacketMmapDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	stopCapture();
+
+	for (uint8_t i = 0; i < m_NumOfOpenedRings; i++)
+		closeRing(m_Rings[i]);
+	delete [] m_Rings;
+	m_Rings = NULL;
+	m_NumOfOpenedRings = 0;
+	m_IsFilterSet = false;
+	m_DeviceOpened = false;
+	LOG_DEBUG("Device '%s' closed", m_InterfaceName.c_str());
+}
+
+bool PacketMmapDevice::openRing(RxRing& ring)
+{
+	ring.fd = -1;
+	ring.map = NULL;
+	ring.mapSize = 0;
+	ring.curBlock = 0;
+	ring.packets = NULL;
+	ring.packetsCapacity = 0;
+	memset(&ring.stats, 0, sizeof(ring.stats));
+
+#ifdef LINUX
+
+	// the socket is bound to the interface only after the ring is set up, so it doesn't receive packets of all interfaces meanwhile
+	ring.fd = socket(AF_PACKET, SOCK_RAW, 0);
+	if (ring.fd < 0)
+	{
+		LOG_ERROR("Cannot create packet socket for device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	int version = TPACKET_V3;
+	if (setsockopt(ring.fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+	{
+		LOG_ERROR("TPACKET_V3 isn't supported by the kernel, error was: %d", errno);
+		closeRing(ring);
+		return false;
+	}
+
+	tpacket_req3 req;
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = m_Config.blockSize;
+	req.tp_block_nr = m_Config.numOfBlocks;
+	req.tp_frame_size = m_Config.frameSize;
+	req.tp_frame_nr = (m_Config.blockSize / m_Config.frameSize) * m_Config.numOfBlocks;
+	req.tp_retire_blk_tov = m_Config.blockTimeoutMs;
+	req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+	if (setsockopt(ring.fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+	{
+		LOG_ERROR("Cannot set up RX ring of %u blocks of %u bytes for device '%s', error was: %d", m_Config.numOfBlocks, m_Config.blockSize,
+				m_InterfaceName.c_str(), errno);
+		closeRing(ring);
+		return false;
+	}
+
+	ring.mapSize = (size_t)m_Config.blockSize * m_Config.numOfBlocks;
+	void* map = mmap(NULL, ring.mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, ring.fd, 0);
+	if (map == MAP_FAILED)
+	{
+		LOG_ERROR("Cannot map RX ring for device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		ring.mapSize = 0;
+		closeRing(ring);
+		return false;
+	}
+	ring.map = (uint8_t*)map;
+
+	sockaddr_ll addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sll_family = AF_PACKET;
+	addr.sll_protocol = htons(ETH_P_ALL);
+	addr.sll_ifindex = m_InterfaceIndex;
+	if (bind(ring.fd, (sockaddr*)&addr, sizeof(addr)) < 0)
+	{
+		LOG_ERROR("Cannot bind packet socket to device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		closeRing(ring);
+		return false;
+	}
+
+	if (m_Config.numOfRxRings > 1 || m_Config.fanoutGroupId != 0)
+	{
+		int fanoutType = PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG;
+		switch (m_Config.fanoutMode)
+		{
+		case FanoutLoadBalance:
+			fanoutType = PACKET_FANOUT_LB;
+			break;
+		case FanoutCpu:
+			fanoutType = PACKET_FANOUT_CPU;
+			break;
+		case FanoutQueueMapping:
+			fanoutType = PACKET_FANOUT_QM;
+			break;
+		default:
+			break;
+		}
+
+		uint16_t groupId = (m_Config.fanoutGroupId != 0 ? m_Config.fanoutGroupId : (uint16_t)getpid());
+		int fanoutArg = (int)groupId | (fanoutType << 16);
+		if (setsockopt(ring.fd, SOL_PACKET, PACKET_FANOUT, &fanoutArg, sizeof(fanoutArg)) < 0)
+		{
+			LOG_ERROR("Cannot join fanout group %d on device '%s', error was: %d", (int)groupId, m_InterfaceName.c_str(), errno);
+			closeRing(ring);
+			return false;
+		}
+	}
+
+	// promiscuous mode is a membership of the socket, so it ends when the socket is closed
+	if (m_Config.promiscuous && ring.id == 0)
+	{
+		packet_mreq mreq;
+		memset(&mreq, 0, sizeof(mreq));
+		mreq.mr_ifindex = m_InterfaceIndex;
+		mreq.mr_type = PACKET_MR_PROMISC;
+		if (setsockopt(ring.fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+		{
+			LOG_ERROR("Cannot set device '%s' to promiscuous mode, error was: %d", m_InterfaceName.c_str(), errno);
+			closeRing(ring);
+			return false;
+		}
+	}
+
+	return true;
+
+#else
+
+	return false;
+
+#endif
+}
+
+void PacketMmapDevice::closeRing(RxRing& ring)
+{
+#ifdef LINUX
+	if (ring.map != NULL)
+		munmap(ring.map, ring.mapSize);
+	if (ring.fd >= 0)
+		::close(ring.fd);
+#endif
+
+	ring.map = NULL;
+	ring.fd = -1;
+	delete [] ring.packets;
+	ring.packets = NULL;
+	ring.packetsCapacity = 0;
+}
+
+int PacketMmapDevice::processBlock(RxRing& ring, OnPacketMmapPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, int timeoutMs)
+{
+#ifdef LINUX
+
+	tpacket_block_desc* block = (tpacket_block_desc*)(ring.map + (size_t)ring.curBlock * m_Config.blockSize);
+	if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0)
+	{
+		if (timeoutMs == 0)
+			return 0;
+
+		pollfd pfd;
+		pfd.fd = ring.fd;
+		pfd.events = POLLIN | POLLERR;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, timeoutMs) < 0 && errno != EINTR)
+		{
+			LOG_ERROR("Cannot poll RX ring %d of device '%s', error was: %d", (int)ring.id, m_InterfaceName.c_str(), errno);
+			return -1;
+		}
+
+		if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0)
+			return 0;
+	}
+
+	uint32_t numOfPackets = block->hdr.bh1.num_pkts;
+	if (numOfPackets > ring.packetsCapacity)
+	{
+		delete [] ring.packets;
+		ring.packets = new RawPacket[numOfPackets];
+		ring.packetsCapacity = numOfPackets;
+	}
+
+	// the packets point into the block, which stays owned by this process until it's released below
+	tpacket3_hdr* packetHeader = (tpacket3_hdr*)((uint8_t*)block + block->hdr.bh1.offset_to_first_pkt);
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		timespec timestamp;
+		timestamp.tv_sec = packetHeader->tp_sec;
+		timestamp.tv_nsec = packetHeader->tp_nsec;
+		ring.packets[i].setExternalRawData((uint8_t*)packetHeader + packetHeader->tp_mac, (int)packetHeader->tp_snaplen, timestamp,
+				LINKTYPE_ETHERNET, (int)packetHeader->tp_len);
+		packetHeader = (tpacket3_hdr*)((uint8_t*)packetHeader + packetHeader->tp_next_offset);
+	}
+
+	if (numOfPackets > 0)
+		onPacketsArrive(ring.packets, numOfPackets, ring.id, this, onPacketsArriveUserCookie);
+
+	__atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+	ring.curBlock = (ring.curBlock + 1) % m_Config.numOfBlocks;
+
+	return (int)numOfPackets;
+
+#else
+
+	LOG_ERROR("PacketMmapDevice is supported on Linux only");
+	return -1;
+
+#endif
+}
+
+int PacketMmapDevice::receiveBlock(uint8_t ringId, OnPacketMmapPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, int timeoutMs)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened", m_InterfaceName.c_str());
+		return -1;
+	}
+
+	if (ringId >= m_NumOfOpenedRings || onPacketsArrive == NULL)
+	{
+		LOG_ERROR("Invalid ring ID %d or no callback given", (int)ringId);
+		return -1;
+	}
+
+	return processBlock(m_Rings[ringId], onPacketsArrive, onPacketsArriveUserCookie, timeoutMs);
+}
+
+void* PacketMmapDevice::captureThreadMain(void* ringPtr)
+{
+	RxRing* ring = (RxRing*)ringPtr;
+	PacketMmapDevice* device = ring->device;
+
+	LOG_DEBUG("Started capture thread for RX ring %d of device '%s'", (int)ring->id, device->m_InterfaceName.c_str());
+	while (!device->m_StopThreads)
+	{
+		if (device->processBlock(*ring, device->m_OnPacketsArrive, device->m_OnPacketsArriveUserCookie, CAPTURE_THREAD_POLL_TIMEOUT_MS) < 0)
+			break;
+	}
+	LOG_DEBUG("Ended capture thread for RX ring %d of device '%s'", (int)ring->id, device->m_InterfaceName.c_str());
+
+	return NULL;
+}
+
+bool PacketMmapDevice::startCapture(OnPacketMmapPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened", m_InterfaceName.c_str());
+		return false;
+	}
+
+	if (m_CaptureThreadsStarted)
+	{
+		LOG_ERROR("Device '%s' already capturing", m_InterfaceName.c_str());
+		return false;
+	}
+
+	if (onPacketsArrive == NULL)
+	{
+		LOG_ERROR("No callback given for capturing on device '%s'", m_InterfaceName.c_str());
+		return false;
+	}
+
+	m_OnPacketsArrive = onPacketsArrive;
+	m_OnPacketsArriveUserCookie = onPacketsArriveUserCookie;
+	m_StopThreads = false;
+
+	for (uint8_t i = 0; i < m_NumOfOpenedRings; i++)
+	{
+		int err = pthread_create(&m_Rings[i].thread, NULL, captureThreadMain, &m_Rings[i]);
+		if (err != 0)
+		{
+			LOG_ERROR("Cannot create capture thread for RX ring %d of device '%s': [%s]", (int)i, m_InterfaceName.c_str(), strerror(err));
+			m_StopThreads = true;
+			for (uint8_t j = 0; j < i; j++)
+				pthread_join(m_Rings[j].thread, NULL);
+			m_StopThreads = false;
+			return false;
+		}
+	}
+
+	m_CaptureThreadsStarted = true;
+	LOG_DEBUG("Capturing started on device '%s'", m_InterfaceName.c_str());
+	return true;
+}
+
+void PacketMmapDevice::stopCapture()
+{
+	if (!m_CaptureThreadsStarted)
+		return;
+
+	m_StopThreads = true;
+	for (uint8_t i = 0; i < m_NumOfOpenedRings; i++)
+		pthread_join(m_Rings[i].thread, NULL);
+
+	m_CaptureThreadsStarted = false;
+	m_StopThreads = false;
+	LOG_DEBUG("Capturing stopped on device '%s'", m_InterfaceName.c_str());
+}
+
+void PacketMmapDevice::updateRingStatistics(RxRing& ring)
+{
+#ifdef LINUX
+	// the kernel resets its counters every time they're read, so they're accumulated here
+	tpacket_stats_v3 kernelStats;
+	socklen_t len = sizeof(kernelStats);
+	if (getsockopt(ring.fd, SOL_PACKET, PACKET_STATISTICS, &kernelStats, &len) < 0)
+	{
+		LOG_ERROR("Cannot read statistics of RX ring %d of device '%s', error was: %d", (int)ring.id, m_InterfaceName.c_str(), errno);
+		return;
+	}
+
+	ring.stats.recv += kernelStats.tp_packets;
+	ring.stats.drop += kernelStats.tp_drops;
+	ring.stats.ringFull += kernelStats.tp_freeze_q_cnt;
+#endif
+}
+
+void PacketMmapDevice::getRingStatistics(uint8_t ringId, PacketMmapStats& stats)
+{
+	memset(&stats, 0, sizeof(stats));
+	if (!m_DeviceOpened || ringId >= m_NumOfOpenedRings)
+		return;
+
+	updateRingStatistics(m_Rings[ringId]);
+	stats = m_Rings[ringId].stats;
+}
+
+void PacketMmapDevice::getStatistics(PacketMmapStats& stats)
+{
+	memset(&stats, 0, sizeof(stats));
+	for (uint8_t i = 0; i < m_NumOfOpenedRings; i++)
+	{
+		PacketMmapStats ringStats;
+		getRingStatistics(i, ringStats);
+		stats.recv += ringStats.recv;
+		stats.drop += ringStats.drop;
+		stats.ringFull += ringStats.ringFull;
+	}
+}
+
+void PacketMmapDevice::collectMetrics(MetricsWriter& writer)
+{
+	if (!m_DeviceOpened)
+		return;
+
+	PacketMmapStats stats;
+	getStatistics(stats);
+	writer.addCounter("pcpp_device_rx_packets_total", "Packets received by the device", stats.recv);
+	writer.addCounter("pcpp_device_rx_dropped_packets_total", "Packets dropped by the device", stats.drop);
+	writer.addCounter("pcpp_device_ring_full_total", "Times an RX ring was full", stats.ringFull);
+}
+
+bool PacketMmapDevice::setFilter(std::string filterAsString)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened", m_InterfaceName.c_str());
+		return false;
+	}
+
+	BPFStringFilter filter(filterAsString);
+	if (!filter.verifyFilter())
+	{
+		LOG_ERROR("Filter '%s' is invalid", filterAsString.c_str());
+		return false;
+	}
+
+#ifdef LINUX
+
+	bpf_program program;
+	if (pcap_compile_nopcap(65535, LINKTYPE_ETHERNET, &program, filterAsString.c_str(), 1, PCAP_NETMASK_UNKNOWN) < 0)
+	{
+		LOG_ERROR("Cannot compile filter '%s'", filterAsString.c_str());
+		return false;
+	}
+
+	// the classic BPF instructions libpcap compiles have the same layout as the kernel's
+	sock_fprog kernelProgram;
+	kernelProgram.len = (unsigned short)program.bf_len;
+	kernelProgram.filter = (sock_filter*)program.bf_insns;
+
+	bool result = true;
+	for (uint8_t i = 0; i < m_NumOfOpenedRings; i++)
+	{
+		if (setsockopt(m_Rings[i].fd, SOL_SOCKET, SO_ATTACH_FILTER, &kernelProgram, sizeof(kernelProgram)) < 0)
+		{
+			LOG_ERROR("Cannot attach filter '%s' to RX ring %d of device '%s', error was: %d", filterAsString.c_str(), (int)i,
+					m_InterfaceName.c_str(), errno);
+			result = false;
+			break;
+		}
+	}
+	pcap_freecode(&program);
+
+	if (!result)
+	{
+		m_IsFilterSet = true;
+		clearFilter();
+		return false;
+	}
+
+	m_IsFilterSet = true;
+	LOG_DEBUG("Successfully set filter '%s'", filterAsString.c_str());
+	return true;
+
+#else
+
+	return false;
+
+#endif
+}
+
+bool PacketMmapDevice::clearFilter()
+{
+	if (!m_IsFilterSet)
+		return true;
+
+#ifdef LINUX
+	int dummy = 0;
+	for (uint8_t i = 0; i < m_NumOfOpenedRings; i++)
+	{
+		// a ring the filter wasn't attached to (when attaching failed on another ring) returns ENOENT
+		if (setsockopt(m_Rings[i].fd, SOL_SOCKET, SO_DETACH_FILTER, &dummy, sizeof(dummy)) < 0 && errno != ENOENT)
+		{
+			LOG_ERROR("Cannot detach filter from RX ring %d of device '%s', error was: %d", (int)i, m_InterfaceName.c_str(), errno);
+			return false;
+		}
+	}
+#endif
+
+	m_IsFilterSet = false;
+	return true;
+}
+
+} // namespace pcpp
@@ -0,0 +1,239 @@
+#define LOG_MODULE PcapLogModulePacketQueueDevice
+
+#include "PacketQueueDevice.h"
+#include "Logger.h"
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+// the number of packets copyAndEnqueue() copies before pushing them
+#define COPY_BATCH_SIZE 64
+
+namespace pcpp
+{
+
+PacketQueueDevice::PacketQueueDevice(size_t capacity, QueueType queueType, RawPacketPool* pool)
+{
+	m_Capacity = capacity;
+	m_QueueType = queueType;
+	m_Pool = pool;
+	m_SPSCQueue = NULL;
+	m_MPMCQueue = NULL;
+	m_DroppedPackets = 0;
+}
+
+PacketQueueDevice::~PacketQueueDevice()
+{
+	close();
+}
+
+bool PacketQueueDevice::open()
+{
+	if (m_DeviceOpened)
+	{
+		LOG_DEBUG("Packet queue device already opened");
+		return true;
+	}
+
+	if (m_QueueType == SingleProducerSingleConsumer)
+	{
+		m_SPSCQueue = new SPSCQueue<RawPacket*>(m_Capacity);
+		m_Capacity = m_SPSCQueue->getCapacity();
+	}
+	else
+	{
+		m_MPMCQueue = new MPMCQueue<RawPacket*>(m_Capacity);
+		m_Capacity = m_MPMCQueue->getCapacity();
+	}
+
+	m_DroppedPackets = 0;
+	m_DeviceOpened = true;
+	LOG_DEBUG("Packet queue device opened with a capacity of %d packets", (int)m_Capacity);
+	return true;
+}
+
+void PacketQueueDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	RawPacket* packets[COPY_BATCH_SIZE];
+	size_t numOfPackets = 0;
+	while ((numOfPackets = pop(packets, COPY_BATCH_SIZE)) > 0)
+	{
+		for (size_t i = 0; i < numOfPackets; i++)
+			delete packets[i];
+	}
+
+	delete m_SPSCQueue;
+	delete m_MPMCQueue;
+	m_SPSCQueue = NULL;
+	m_MPMCQueue = NULL;
+	m_DeviceOpened = false;
+	LOG_DEBUG("Packet queue device closed");
+}
+
+size_t PacketQueueDevice::push(RawPacket** packets, size_t count)
+{
+	size_t pushed = (m_SPSCQueue != NULL ? m_SPSCQueue->pushBulk(packets, count) : m_MPMCQueue->pushBulk(packets, count));
+	if (pushed < count)
+		addDroppedPackets(count - pushed);
+	return pushed;
+}
+
+size_t PacketQueueDevice::pop(RawPacket** packets, size_t maxCount)
+{
+	return (m_SPSCQueue != NULL ? m_SPSCQueue->popBulk(packets, maxCount) : m_MPMCQueue->popBulk(packets, maxCount));
+}
+
+void PacketQueueDevice::addDroppedPackets(uint64_t count)
+{
+#if defined(_MSC_VER)
+	InterlockedExchangeAdd64((volatile LONGLONG*)&m_DroppedPackets, (LONGLONG)count);
+#else
+	__atomic_fetch_add(&m_DroppedPackets, count, __ATOMIC_RELAXED);
+#endif
+}
+
+uint64_t PacketQueueDevice::getNumOfDroppedPackets() const
+{
+#if defined(_MSC_VER)
+	return (uint64_t)InterlockedCompareExchange64((volatile LONGLONG*)&m_DroppedPackets, 0, 0);
+#else
+	return __atomic_load_n(&m_DroppedPackets, __ATOMIC_RELAXED);
+#endif
+}
+
+bool PacketQueueDevice::enqueue(RawPacket* packet)
+{
+	return enqueueBurst(&packet, 1) == 1;
+}
+
+int PacketQueueDevice::enqueueBurst(RawPacket** packets, int count)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Packet queue device not opened");
+		return 0;
+	}
+
+	if (count <= 0)
+		return 0;
+
+	return (int)push(packets, (size_t)count);
+}
+
+int PacketQueueDevice::copyAndEnqueue(const RawPacket* packets, int count)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Packet queue device not opened");
+		return 0;
+	}
+
+	int numOfPushed = 0;
+	for (int first = 0; first < count; first += COPY_BATCH_SIZE)
+	{
+		int batchSize = (count - first < COPY_BATCH_SIZE ? count - first : COPY_BATCH_SIZE);
+
+		// don't copy packets which can't be pushed anyway. With several producers the free space may shrink until the copies are pushed,
+		// in which case the copies which weren't pushed are deleted
+		size_t freeSpace = m_Capacity - getNumOfQueuedPackets();
+		if ((size_t)batchSize > freeSpace)
+		{
+			addDroppedPackets(count - first - freeSpace);
+			batchSize = (int)freeSpace;
+			count = first + batchSize;
+		}
+
+		RawPacket* copies[COPY_BATCH_SIZE];
+		for (int i = 0; i < batchSize; i++)
+		{
+			const RawPacket& packet = packets[first + i];
+			copies[i] = new RawPacket();
+			copies[i]->copyRawData(packet.getRawData(), packet.getRawDataLen(), packet.getPacketTimeStampNs(), m_Pool,
+					packet.getLinkLayerType(), packet.getFrameLength());
+		}
+
+		int pushed = (int)push(copies, (size_t)batchSize);
+		for (int i = pushed; i < batchSize; i++)
+			delete copies[i];
+
+		numOfPushed += pushed;
+	}
+
+	return numOfPushed;
+}
+
+RawPacket* PacketQueueDevice::dequeue()
+{
+	RawPacket* packet = NULL;
+	if (dequeueBurst(&packet, 1) == 0)
+		return NULL;
+	return packet;
+}
+
+int PacketQueueDevice::dequeueBurst(RawPacket** packets, int maxCount)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Packet queue device not opened");
+		return 0;
+	}
+
+	if (maxCount <= 0)
+		return 0;
+
+	return (int)pop(packets, (size_t)maxCount);
+}
+
+int PacketQueueDevice::receivePackets(RawPacketVector& packetVec, int maxCount)
+{
+	RawPacket* packets[COPY_BATCH_SIZE];
+	int numOfPackets = 0;
+	while (numOfPackets < maxCount)
+	{
+		int batchSize = (maxCount - numOfPackets < COPY_BATCH_SIZE ? maxCount - numOfPackets : COPY_BATCH_SIZE);
+		int popped = dequeueBurst(packets, batchSize);
+		for (int i = 0; i < popped; i++)
+			packetVec.pushBack(packets[i]);
+
+		numOfPackets += popped;
+		if (popped < batchSize)
+			break;
+	}
+
+	return numOfPackets;
+}
+
+size_t PacketQueueDevice::getNumOfQueuedPackets() const
+{
+	if (m_SPSCQueue != NULL)
+		return m_SPSCQueue->size();
+	if (m_MPMCQueue != NULL)
+		return m_MPMCQueue->size();
+	return 0;
+}
+
+void PacketQueueDevice::collectMetrics(MetricsWriter& writer)
+{
+	if (!m_DeviceOpened)
+		return;
+
+	writer.addGauge("pcpp_device_queued_packets", "Packets waiting in the queue", (double)getNumOfQueuedPackets());
+	writer.addCounter("pcpp_device_rx_dropped_packets_total", "Packets dropped because the queue was full", getNumOfDroppedPackets());
+}
+
+void PacketQueueDevice::onPacketArrives(RawPacket* packet, PcapLiveDevice* pDevice, void* userCookie)
+{
+	PacketQueueDevice* pThis = (PacketQueueDevice*)userCookie;
+	pThis->copyAndEnqueue(packet, 1);
+}
+
+void PacketQueueDevice::onPacketsArriveBurst(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* pDevice, void* userCookie)
+{
+	PacketQueueDevice* pThis = (PacketQueueDevice*)userCookie;
+	pThis->copyAndEnqueue(packets, (int)numOfPackets);
+}
+
+} // namespace pcpp
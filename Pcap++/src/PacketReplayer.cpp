@@ -0,0 +1,373 @@
+#define LOG_MODULE PcapLogModuleLiveDevice
+
+#include "PacketReplayer.h"
+#include "PacketView.h"
+#include "TimestampClock.h"
+#include "IpUtils.h"
+#include "IPv4Layer.h"
+#include "Logger.h"
+#include <string.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// gaps longer than this are partially slept instead of busy-waited
+#define REPLAYER_SLEEP_THRESHOLD_NS 2000000
+// how long before the send time a sleep ends, which leaves room for the inaccuracy of the OS timer
+#define REPLAYER_SLEEP_MARGIN_NS 1000000
+
+namespace pcpp
+{
+
+static void sleepNs(uint64_t durationNs)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	Sleep((DWORD)(durationNs / 1000000));
+#else
+	timespec interval;
+	interval.tv_sec = durationNs / 1000000000;
+	interval.tv_nsec = durationNs % 1000000000;
+	nanosleep(&interval, NULL);
+#endif
+}
+
+PacketReplayer::PacketReplayer(const PacketReplayConfiguration& config) : m_Config(config)
+{
+	m_StopRequested = false;
+	m_NumOfPacketsSent = 0;
+	m_NumOfBytesSent = 0;
+	m_NumOfPacketsFailed = 0;
+	m_NumOfLoopsCompleted = 0;
+	m_ReplayDurationNs = 0;
+}
+
+bool PacketReplayer::loadFile(const char* fileName)
+{
+	IFileReaderDevice* reader = IFileReaderDevice::getReader(fileName);
+	if (!reader->open())
+	{
+		LOG_ERROR("Cannot open file '%s' for replay", fileName);
+		delete reader;
+		return false;
+	}
+
+	loadPackets(*reader);
+	reader->close();
+	delete reader;
+	return true;
+}
+
+int PacketReplayer::loadPackets(IFileReaderDevice& reader)
+{
+	size_t firstNewPacket = m_Packets.size();
+	int numOfPacketsLoaded = reader.getNextPackets(m_Packets);
+
+	for (size_t i = firstNewPacket; i < m_Packets.size(); i++)
+		addPacketInfo(m_Packets.at((int)i));
+
+	return numOfPacketsLoaded;
+}
+
+bool PacketReplayer::addPacket(const RawPacket& rawPacket)
+{
+	RawPacket* newPacket = m_Packets.pushBack(rawPacket);
+	if (newPacket == NULL)
+		return false;
+
+	addPacketInfo(newPacket);
+	return true;
+}
+
+void PacketReplayer::clear()
+{
+	m_Packets.clear();
+	m_Timestamps.clear();
+	m_RewriteInfo.clear();
+}
+
+void PacketReplayer::addPacketInfo(const RawPacket* rawPacket)
+{
+	timespec timestamp = rawPacket->getPacketTimeStampNs();
+	m_Timestamps.push_back((uint64_t)timestamp.tv_sec * 1000000000 + timestamp.tv_nsec);
+
+	RewriteInfo info;
+	memset(&info, 0, sizeof(info));
+	PacketView view;
+	if (FlowKeyExtractor::extract(rawPacket, view) && (view.ipVersion == 4 || view.ipVersion == 6))
+	{
+		info.ipVersion = view.ipVersion;
+		info.networkOffset = view.networkOffset;
+		info.transportOffset = view.transportOffset;
+		if (view.transportOffset != PacketView::NoOffset)
+			info.ipProtocol = view.ipProtocol;
+
+		// only the last 32 bits of IPv6 addresses are rewritten
+		const uint8_t* data = rawPacket->getRawData();
+		size_t srcIPOffset = info.networkOffset + (info.ipVersion == 4 ? 12 : 20);
+		size_t dstIPOffset = info.networkOffset + (info.ipVersion == 4 ? 16 : 36);
+		memcpy(&info.srcIP, data + srcIPOffset, sizeof(info.srcIP));
+		memcpy(&info.dstIP, data + dstIPOffset, sizeof(info.dstIP));
+		if (info.ipProtocol != 0)
+		{
+			memcpy(&info.srcPort, data + info.transportOffset, sizeof(info.srcPort));
+			memcpy(&info.dstPort, data + info.transportOffset + 2, sizeof(info.dstPort));
+		}
+	}
+
+	m_RewriteInfo.push_back(info);
+}
+
+bool PacketReplayer::isRewriteEnabled() const
+{
+	return m_Config.srcIPIncrementPerLoop != 0 || m_Config.dstIPIncrementPerLoop != 0 ||
+			m_Config.srcPortIncrementPerLoop != 0 || m_Config.dstPortIncrementPerLoop != 0;
+}
+
+void PacketReplayer::rewritePacket(size_t packetIndex, uint32_t loop)
+{
+	const RewriteInfo& info = m_RewriteInfo[packetIndex];
+	if (info.ipVersion == 0)
+		return;
+
+	// the packets belong to the slab vector of this instance, so they're modified in place
+	uint8_t* data = (uint8_t*)m_Packets.at((int)packetIndex)->getRawData();
+
+	// the checksum of the IPv4 header, and of the TCP or UDP header which covers the addresses in its pseudo-header
+	uint16_t* ipChecksum = (info.ipVersion == 4 ? (uint16_t*)(data + info.networkOffset + 10) : NULL);
+	uint16_t* l4Checksum = NULL;
+	if (info.ipProtocol == PACKETPP_IPPROTO_TCP)
+		l4Checksum = (uint16_t*)(data + info.transportOffset + 16);
+	else if (info.ipProtocol == PACKETPP_IPPROTO_UDP && *(uint16_t*)(data + info.transportOffset + 6) != 0)
+		l4Checksum = (uint16_t*)(data + info.transportOffset + 6);
+
+	uint32_t* ipFields[2] = { (uint32_t*)(data + info.networkOffset + (info.ipVersion == 4 ? 12 : 20)),
+			(uint32_t*)(data + info.networkOffset + (info.ipVersion == 4 ? 16 : 36)) };
+	uint32_t newIPs[2] = { htonl(ntohl(info.srcIP) + loop * m_Config.srcIPIncrementPerLoop),
+			htonl(ntohl(info.dstIP) + loop * m_Config.dstIPIncrementPerLoop) };
+	for (int i = 0; i < 2; i++)
+	{
+		uint32_t oldIP = *ipFields[i];
+		if (oldIP == newIPs[i])
+			continue;
+
+		*ipFields[i] = newIPs[i];
+		if (ipChecksum != NULL)
+			*ipChecksum = update_checksum(*ipChecksum, oldIP, newIPs[i]);
+		if (l4Checksum != NULL)
+			*l4Checksum = update_checksum(*l4Checksum, oldIP, newIPs[i]);
+	}
+
+	if (info.ipProtocol == 0)
+		return;
+
+	uint16_t* portFields[2] = { (uint16_t*)(data + info.transportOffset), (uint16_t*)(data + info.transportOffset + 2) };
+	uint16_t newPorts[2] = { htons((uint16_t)(ntohs(info.srcPort) + loop * m_Config.srcPortIncrementPerLoop)),
+			htons((uint16_t)(ntohs(info.dstPort) + loop * m_Config.dstPortIncrementPerLoop)) };
+	for (int i = 0; i < 2; i++)
+	{
+		uint16_t oldPort = *portFields[i];
+		if (oldPort == newPorts[i])
+			continue;
+
+		*portFields[i] = newPorts[i];
+		if (l4Checksum != NULL)
+			*l4Checksum = update_checksum(*l4Checksum, oldPort, newPorts[i]);
+	}
+
+	// a UDP checksum of 0 means there is no checksum, so a computed 0 is sent as its equivalent 0xffff
+	if (info.ipProtocol == PACKETPP_IPPROTO_UDP && l4Checksum != NULL && *l4Checksum == 0)
+		*l4Checksum = 0xffff;
+}
+
+uint64_t PacketReplayer::getLoopDurationNs() const
+{
+	// the next loop starts one average gap after the last packet, so the loops keep the rate of the capture
+	uint64_t first = m_Timestamps.front();
+	uint64_t last = first;
+	for (std::vector<uint64_t>::const_iterator iter = m_Timestamps.begin(); iter != m_Timestamps.end(); iter++)
+	{
+		if (*iter > last)
+			last = *iter;
+	}
+
+	uint64_t duration = last - first;
+	if (m_Timestamps.size() > 1)
+		duration += duration / (m_Timestamps.size() - 1);
+
+	return duration;
+}
+
+void PacketReplayer::sendBurst(RawPacket** burst, int burstLen, OnSendPackets onSendPackets, void* userCookie)
+{
+	int numOfPacketsSent = onSendPackets(burst, burstLen, userCookie);
+	if (numOfPacketsSent < 0)
+		numOfPacketsSent = 0;
+	else if (numOfPacketsSent > burstLen)
+		numOfPacketsSent = burstLen;
+
+	for (int i = 0; i < numOfPacketsSent; i++)
+		m_NumOfBytesSent += burst[i]->getRawDataLen();
+
+	m_NumOfPacketsSent += numOfPacketsSent;
+	m_NumOfPacketsFailed += burstLen - numOfPacketsSent;
+}
+
+void PacketReplayer::waitUntil(uint64_t timeNs)
+{
+	while (!m_StopRequested)
+	{
+		uint64_t now = TimestampClock::nowNs();
+		if (now >= timeNs)
+			return;
+
+		if (timeNs - now > REPLAYER_SLEEP_THRESHOLD_NS)
+			sleepNs(timeNs - now - REPLAYER_SLEEP_MARGIN_NS);
+	}
+}
+
+bool PacketReplayer::replay(OnSendPackets onSendPackets, void* userCookie)
+{
+	m_NumOfPacketsSent = 0;
+	m_NumOfBytesSent = 0;
+	m_NumOfPacketsFailed = 0;
+	m_NumOfLoopsCompleted = 0;
+	m_ReplayDurationNs = 0;
+
+	if (onSendPackets == NULL)
+	{
+		LOG_ERROR("A callback for sending packets is required");
+		return false;
+	}
+
+	if (m_Packets.size() == 0)
+	{
+		LOG_ERROR("No packets were loaded for replay");
+		return false;
+	}
+
+	if (m_Config.burstSize == 0 ||
+			(m_Config.pacingMode == PacketReplayConfiguration::OriginalTiming && m_Config.speedMultiplier <= 0) ||
+			(m_Config.pacingMode == PacketReplayConfiguration::FixedPacketRate && m_Config.packetsPerSecond == 0) ||
+			(m_Config.pacingMode == PacketReplayConfiguration::FixedBitRate && m_Config.bitsPerSecond == 0))
+	{
+		LOG_ERROR("Invalid replay configuration: the burst size and the rate of the pacing mode must be larger than 0");
+		return false;
+	}
+
+	m_StopRequested = false;
+	bool rewrite = isRewriteEnabled();
+	uint64_t firstTimestamp = m_Timestamps.front();
+	uint64_t loopDuration = (m_Config.pacingMode == PacketReplayConfiguration::OriginalTiming ? getLoopDurationNs() : 0);
+	double packetIntervalNs = (m_Config.pacingMode == PacketReplayConfiguration::FixedPacketRate ? 1e9 / m_Config.packetsPerSecond : 0);
+	double byteIntervalNs = (m_Config.pacingMode == PacketReplayConfiguration::FixedBitRate ? 8e9 / m_Config.bitsPerSecond : 0);
+
+	std::vector<RawPacket*> burst(m_Config.burstSize);
+	int burstLen = 0;
+	// the send time of the next packet relative to the start of the replay, in the fixed rate modes
+	double nextSendOffset = 0;
+	size_t numOfPackets = m_Packets.size();
+	uint64_t startTime = TimestampClock::nowNs();
+
+	for (uint32_t loop = 0; (m_Config.numOfLoops == 0 || loop < m_Config.numOfLoops) && !m_StopRequested; loop++)
+	{
+		for (size_t i = 0; i < numOfPackets && !m_StopRequested; i++)
+		{
+			RawPacket* rawPacket = m_Packets.at((int)i);
+
+			uint64_t sendTime = startTime;
+			switch (m_Config.pacingMode)
+			{
+			case PacketReplayConfiguration::OriginalTiming:
+			{
+				// timestamps aren't always in order, a packet earlier than the first one of its loop is sent right away
+				double offset = ((double)loop * loopDuration + (double)m_Timestamps[i] - (double)firstTimestamp) / m_Config.speedMultiplier;
+				if (offset > 0)
+					sendTime += (uint64_t)offset;
+				break;
+			}
+			case PacketReplayConfiguration::FixedPacketRate:
+				sendTime += (uint64_t)nextSendOffset;
+				nextSendOffset += packetIntervalNs;
+				break;
+			case PacketReplayConfiguration::FixedBitRate:
+				sendTime += (uint64_t)nextSendOffset;
+				nextSendOffset += byteIntervalNs * rawPacket->getRawDataLen();
+				break;
+			default:
+				break;
+			}
+
+			if (sendTime > startTime && TimestampClock::nowNs() < sendTime)
+			{
+				// the packets gathered so far are due, they shouldn't wait for this one
+				if (burstLen > 0)
+				{
+					sendBurst(&burst[0], burstLen, onSendPackets, userCookie);
+					burstLen = 0;
+				}
+
+				waitUntil(sendTime);
+				if (m_StopRequested)
+					break;
+			}
+
+			if (rewrite)
+				rewritePacket(i, loop);
+
+			burst[burstLen++] = rawPacket;
+			if (burstLen == (int)m_Config.burstSize)
+			{
+				sendBurst(&burst[0], burstLen, onSendPackets, userCookie);
+				burstLen = 0;
+			}
+		}
+
+		if (burstLen > 0)
+		{
+			sendBurst(&burst[0], burstLen, onSendPackets, userCookie);
+			burstLen = 0;
+		}
+
+		if (!m_StopRequested)
+			m_NumOfLoopsCompleted++;
+	}
+
+	m_ReplayDurationNs = TimestampClock::nowNs() - startTime;
+
+	// the packets are left as they were loaded, so the next replay starts from the original addresses
+	if (rewrite)
+	{
+		for (size_t i = 0; i < numOfPackets; i++)
+			rewritePacket(i, 0);
+	}
+
+	return true;
+}
+
+int PacketReplayer::sendThroughLiveDevice(RawPacket** packets, int numOfPackets, void* device)
+{
+	PcapLiveDevice* liveDevice = (PcapLiveDevice*)device;
+	int numOfPacketsSent = 0;
+	for (int i = 0; i < numOfPackets; i++)
+	{
+		if (liveDevice->sendPacket(*packets[i]))
+			numOfPacketsSent++;
+	}
+
+	return numOfPacketsSent;
+}
+
+bool PacketReplayer::replay(PcapLiveDevice& device)
+{
+	if (!device.isOpened())
+	{
+		LOG_ERROR("Device '%s' isn't opened", device.getName());
+		return false;
+	}
+
+	return replay(sendThroughLiveDevice, &device);
+}
+
+} // namespace pcpp
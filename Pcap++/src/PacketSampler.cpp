@@ -0,0 +1,145 @@
+#define LOG_MODULE PcapLogModulePacketSampler
+
+#include "PacketSampler.h"
+#include "PacketView.h"
+#include "FlowHash.h"
+#include "Logger.h"
+
+// the number of fractional bits of the rate cap time values
+#define PACKET_SAMPLER_TIME_SHIFT 8
+
+namespace pcpp
+{
+
+PacketSamplerConfiguration PacketSamplerConfiguration::divide(int numOfParts) const
+{
+	PacketSamplerConfiguration result = *this;
+	if (numOfParts <= 1)
+		return result;
+
+	if (maxPacketsPerSecond > 0)
+	{
+		result.maxPacketsPerSecond = maxPacketsPerSecond / numOfParts;
+		if (result.maxPacketsPerSecond == 0)
+			result.maxPacketsPerSecond = 1;
+	}
+
+	if (maxBurstSize > 0)
+	{
+		result.maxBurstSize = maxBurstSize / numOfParts;
+		if (result.maxBurstSize == 0)
+			result.maxBurstSize = 1;
+	}
+
+	return result;
+}
+
+PacketSampler::PacketSampler()
+{
+	setConfiguration(PacketSamplerConfiguration());
+}
+
+PacketSampler::PacketSampler(const PacketSamplerConfiguration& config)
+{
+	setConfiguration(config);
+}
+
+void PacketSampler::setConfiguration(const PacketSamplerConfiguration& config)
+{
+	m_Config = config;
+	m_Enabled = (config.flowSamplingRate > 1 || config.packetSamplingRate > 1 || config.maxPacketsPerSecond > 0);
+
+	m_FlowHashThreshold = (config.flowSamplingRate > 1 ? (0x100000000ULL / config.flowSamplingRate) : 0x100000000ULL);
+
+	if (config.maxPacketsPerSecond > 0)
+	{
+		uint64_t burstSize = config.maxBurstSize;
+		if (burstSize == 0)
+			burstSize = config.maxPacketsPerSecond / 100;
+		if (burstSize == 0)
+			burstSize = 1;
+
+		m_PacketIntervalFixed = (1000000000ULL << PACKET_SAMPLER_TIME_SHIFT) / config.maxPacketsPerSecond;
+		if (m_PacketIntervalFixed == 0)
+			m_PacketIntervalFixed = 1;
+		m_BurstToleranceFixed = (burstSize - 1) * m_PacketIntervalFixed;
+
+		LOG_DEBUG("Rate cap of %llu packets per second with a burst of %llu packets", (unsigned long long)config.maxPacketsPerSecond, (unsigned long long)burstSize);
+	}
+	else
+	{
+		m_PacketIntervalFixed = 0;
+		m_BurstToleranceFixed = 0;
+	}
+
+	reset();
+}
+
+void PacketSampler::reset()
+{
+	m_PacketCountdown = 1;
+	m_NextArrivalFixed = 0;
+	m_FirstTimestampNs = 0;
+	m_RateCapStarted = false;
+	m_NumOfPackets = 0;
+	m_NumOfSampledPackets = 0;
+}
+
+uint32_t PacketSampler::getFlowHash(const uint8_t* packetData, size_t packetDataLen, LinkLayerType linkType)
+{
+	PacketView view;
+	FlowTuple tuple;
+	if (!FlowKeyExtractor::extract(packetData, packetDataLen, linkType, view) || !FlowHash::getTuple(view, tuple))
+		return 0;
+
+	return FlowHash::hashSymmetric(tuple);
+}
+
+bool PacketSampler::samplePacket(const uint8_t* packetData, size_t packetDataLen, LinkLayerType linkType, uint64_t timestampNs)
+{
+	// the headers are parsed only if the flow hash is needed
+	uint32_t flowHash = (m_Config.flowSamplingRate > 1 ? getFlowHash(packetData, packetDataLen, linkType) : 0);
+	return samplePacket(flowHash, timestampNs);
+}
+
+bool PacketSampler::samplePacket(uint32_t flowHash, uint64_t timestampNs)
+{
+	m_NumOfPackets++;
+
+	if ((uint64_t)flowHash >= m_FlowHashThreshold)
+		return false;
+
+	if (m_Config.packetSamplingRate > 1)
+	{
+		if (--m_PacketCountdown > 0)
+			return false;
+		m_PacketCountdown = m_Config.packetSamplingRate;
+	}
+
+	if (m_PacketIntervalFixed > 0 && !passRateCap(timestampNs))
+		return false;
+
+	m_NumOfSampledPackets++;
+	return true;
+}
+
+bool PacketSampler::passRateCap(uint64_t timestampNs)
+{
+	if (!m_RateCapStarted)
+	{
+		m_FirstTimestampNs = timestampNs;
+		m_RateCapStarted = true;
+	}
+
+	// timestamps which go back in time (possible with per-burst or out-of-order timestamps) count as the first one
+	uint64_t now = (timestampNs > m_FirstTimestampNs ? (timestampNs - m_FirstTimestampNs) << PACKET_SAMPLER_TIME_SHIFT : 0);
+
+	// a packet conforms if it doesn't arrive earlier than its theoretical arrival time minus the burst tolerance
+	if (m_NextArrivalFixed > m_BurstToleranceFixed && now < m_NextArrivalFixed - m_BurstToleranceFixed)
+		return false;
+
+	m_NextArrivalFixed = (now > m_NextArrivalFixed ? now : m_NextArrivalFixed) + m_PacketIntervalFixed;
+	return true;
+}
+
+} // namespace pcpp
@@ -0,0 +1,414 @@
+#define LOG_MODULE PcapLogModuleArrowFileWriter
+
+#include "PacketTableWriter.h"
+#include "PacketView.h"
+#include "DnsMessageView.h"
+#include "HttpLayer.h"
+#include "SSLHandshake.h"
+#include "IpAddress.h"
+#include "PcapFileDevice.h"
+#include "ParallelPcapFileReader.h"
+#include "Logger.h"
+#include <string.h>
+#include <ctype.h>
+#include <vector>
+
+namespace pcpp
+{
+
+#define DNS_PORT 53
+#define MDNS_PORT 5353
+
+// format an IP address of a record or a flow tuple, return its length
+static size_t formatIPAddress(uint8_t ipVersion, const uint8_t* address, char* buffer, size_t bufferLen)
+{
+	if (ipVersion == 4)
+	{
+		uint32_t addrAsInt;
+		memcpy(&addrAsInt, address, sizeof(addrAsInt));
+		return IPv4Address(addrAsInt).toString(buffer, bufferLen);
+	}
+
+	return IPv6Address((uint8_t*)address).toString(buffer, bufferLen);
+}
+
+static inline void copyString(const char* value, size_t length, char* buffer, size_t bufferLen, uint16_t& resultLength)
+{
+	if (length > bufferLen)
+		length = bufferLen;
+	memcpy(buffer, value, length);
+	resultLength = (uint16_t)length;
+}
+
+// the method and the Host header of an HTTP request whose request line starts the payload
+static void extractHttpRequest(const uint8_t* payload, size_t payloadLen, PacketRecord& record)
+{
+	if (HttpRequestFirstLine::parseMethod((char*)payload, payloadLen) == HttpRequestLayer::HttpMethodUnknown)
+		return;
+
+	const char* data = (const char*)payload;
+	const char* end = data + payloadLen;
+	const char* methodEnd = (const char*)memchr(data, ' ', payloadLen);
+	copyString(data, methodEnd - data, record.httpMethod, sizeof(record.httpMethod), record.httpMethodLength);
+
+	// the header lines follow the request line, up to an empty line
+	const char* line = (const char*)memchr(data, '\n', payloadLen);
+	while (line != NULL && ++line < end)
+	{
+		const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+		if (lineEnd == NULL)
+			lineEnd = end;
+
+		size_t lineLen = lineEnd - line;
+		if (lineLen > 0 && line[lineLen - 1] == '\r')
+			lineLen--;
+		if (lineLen == 0)
+			break;
+
+		if (lineLen > 5 && strncasecmp(line, "host:", 5) == 0)
+		{
+			const char* value = line + 5;
+			const char* valueEnd = line + lineLen;
+			while (value < valueEnd && isspace((unsigned char)*value))
+				value++;
+			while (valueEnd > value && isspace((unsigned char)valueEnd[-1]))
+				valueEnd--;
+			copyString(value, valueEnd - value, record.httpHost, sizeof(record.httpHost), record.httpHostLength);
+			break;
+		}
+
+		line = (lineEnd < end ? lineEnd : NULL);
+	}
+}
+
+
+PacketTableWriter::PacketTableWriter(const std::string& fileName, size_t rowsPerBatch) : m_Writer(fileName, rowsPerBatch), m_WriteFailed(false)
+{
+	pthread_mutex_init(&m_Mutex, NULL);
+
+	m_TimestampColumn = m_Writer.addColumn("timestamp", ArrowFileWriter::TimestampNsColumn);
+	m_LengthColumn = m_Writer.addColumn("length", ArrowFileWriter::UInt32Column);
+	m_CapturedLengthColumn = m_Writer.addColumn("captured_length", ArrowFileWriter::UInt32Column);
+	m_IPVersionColumn = m_Writer.addColumn("ip_version", ArrowFileWriter::UInt8Column);
+	m_SrcIPColumn = m_Writer.addColumn("src_ip", ArrowFileWriter::StringColumn, true);
+	m_DstIPColumn = m_Writer.addColumn("dst_ip", ArrowFileWriter::StringColumn, true);
+	m_IPProtocolColumn = m_Writer.addColumn("ip_protocol", ArrowFileWriter::UInt8Column);
+	m_SrcPortColumn = m_Writer.addColumn("src_port", ArrowFileWriter::UInt16Column);
+	m_DstPortColumn = m_Writer.addColumn("dst_port", ArrowFileWriter::UInt16Column);
+	m_TcpFlagsColumn = m_Writer.addColumn("tcp_flags", ArrowFileWriter::UInt8Column);
+	m_VlanIdColumn = m_Writer.addColumn("vlan_id", ArrowFileWriter::UInt16Column);
+	m_PayloadLengthColumn = m_Writer.addColumn("payload_length", ArrowFileWriter::UInt32Column);
+	m_DnsQueryColumn = m_Writer.addColumn("dns_query", ArrowFileWriter::StringColumn, true);
+	m_HttpMethodColumn = m_Writer.addColumn("http_method", ArrowFileWriter::StringColumn, true);
+	m_HttpHostColumn = m_Writer.addColumn("http_host", ArrowFileWriter::StringColumn, true);
+	m_TlsServerNameColumn = m_Writer.addColumn("tls_sni", ArrowFileWriter::StringColumn, true);
+}
+
+PacketTableWriter::~PacketTableWriter()
+{
+	if (m_Writer.isOpened())
+		m_Writer.close();
+
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+bool PacketTableWriter::open()
+{
+	m_WriteFailed = false;
+	return m_Writer.open();
+}
+
+bool PacketTableWriter::close()
+{
+	pthread_mutex_lock(&m_Mutex);
+	bool result = m_Writer.close();
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+uint64_t PacketTableWriter::getNumOfRows()
+{
+	pthread_mutex_lock(&m_Mutex);
+	uint64_t result = m_Writer.getNumOfRows();
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+void PacketTableWriter::extractRecord(const RawPacket& rawPacket, PacketRecord& record)
+{
+	timespec timestamp = rawPacket.getPacketTimeStampNs();
+	record.timestampNs = (uint64_t)timestamp.tv_sec * 1000000000ULL + (uint64_t)timestamp.tv_nsec;
+	record.length = (uint32_t)rawPacket.getFrameLength();
+	record.capturedLength = (uint32_t)rawPacket.getRawDataLen();
+	record.dnsQueryLength = 0;
+	record.httpMethodLength = 0;
+	record.httpHostLength = 0;
+	record.tlsServerNameLength = 0;
+
+	PacketView view;
+	if (!FlowKeyExtractor::extract(&rawPacket, view))
+	{
+		record.ipVersion = 0;
+		record.ipProtocol = 0;
+		record.tcpFlags = 0;
+		record.vlanId = (view.vlanCount > 0 ? view.vlanId : 0);
+		record.srcPort = 0;
+		record.dstPort = 0;
+		record.payloadLength = 0;
+		return;
+	}
+
+	bool isTcp = view.isPacketOfType(TCP);
+	bool isUdp = view.isPacketOfType(UDP);
+	record.ipVersion = view.ipVersion;
+	record.ipProtocol = view.ipProtocol;
+	record.tcpFlags = (isTcp ? view.tcpFlags : 0);
+	record.vlanId = (view.vlanCount > 0 ? view.vlanId : 0);
+	record.srcPort = (isTcp || isUdp ? view.srcPort : 0);
+	record.dstPort = (isTcp || isUdp ? view.dstPort : 0);
+	record.payloadLength = (isTcp || isUdp ? view.payloadLength : 0);
+	memcpy(record.srcIP, view.srcIP, sizeof(record.srcIP));
+	memcpy(record.dstIP, view.dstIP, sizeof(record.dstIP));
+
+	if (view.payloadOffset == PacketView::NoOffset || view.payloadLength == 0 || view.payloadOffset >= rawPacket.getRawDataLen())
+		return;
+
+	// the payload length excludes Ethernet padding, but it's taken from the IP header so it may exceed the captured data
+	const uint8_t* payload = rawPacket.getRawData() + view.payloadOffset;
+	size_t payloadLen = (size_t)rawPacket.getRawDataLen() - view.payloadOffset;
+	if (view.payloadLength < payloadLen)
+		payloadLen = view.payloadLength;
+
+	if (isUdp)
+	{
+		if (record.srcPort != DNS_PORT && record.dstPort != DNS_PORT && record.srcPort != MDNS_PORT && record.dstPort != MDNS_PORT)
+			return;
+
+		DnsMessageView dnsView;
+		if (!dnsView.parse(payload, payloadLen) || dnsView.getRecordCount() == 0 || dnsView.getSection(0) != DnsQueryType)
+			return;
+
+		char name[PCPP_PACKET_RECORD_MAX_STRING_LEN + 1];
+		size_t nameLen = 0;
+		if (dnsView.getName(0, name, sizeof(name), &nameLen))
+			copyString(name, nameLen, record.dnsQuery, sizeof(record.dnsQuery), record.dnsQueryLength);
+	}
+	else if (isTcp)
+	{
+		// a TLS handshake record starts with its content type (22)
+		if (payload[0] == 22)
+		{
+			SSLClientHelloFingerprint clientHello;
+			if (clientHello.parseRecord(payload, payloadLen) && clientHello.getServerName() != NULL)
+				copyString(clientHello.getServerName(), clientHello.getServerNameLength(), record.tlsServerName, sizeof(record.tlsServerName),
+						record.tlsServerNameLength);
+		}
+		else
+			extractHttpRequest(payload, payloadLen, record);
+	}
+}
+
+bool PacketTableWriter::addRow(const PacketRecord& record)
+{
+	m_Writer.setValue(m_TimestampColumn, record.timestampNs);
+	m_Writer.setValue(m_LengthColumn, record.length);
+	m_Writer.setValue(m_CapturedLengthColumn, record.capturedLength);
+	m_Writer.setValue(m_IPVersionColumn, record.ipVersion);
+	if (record.ipVersion != 0)
+	{
+		char address[MAX_ADDR_STRING_LEN];
+		size_t addressLen = formatIPAddress(record.ipVersion, record.srcIP, address, sizeof(address));
+		m_Writer.setString(m_SrcIPColumn, address, addressLen);
+		addressLen = formatIPAddress(record.ipVersion, record.dstIP, address, sizeof(address));
+		m_Writer.setString(m_DstIPColumn, address, addressLen);
+	}
+	m_Writer.setValue(m_IPProtocolColumn, record.ipProtocol);
+	m_Writer.setValue(m_SrcPortColumn, record.srcPort);
+	m_Writer.setValue(m_DstPortColumn, record.dstPort);
+	m_Writer.setValue(m_TcpFlagsColumn, record.tcpFlags);
+	m_Writer.setValue(m_VlanIdColumn, record.vlanId);
+	m_Writer.setValue(m_PayloadLengthColumn, record.payloadLength);
+	if (record.dnsQueryLength > 0)
+		m_Writer.setString(m_DnsQueryColumn, record.dnsQuery, record.dnsQueryLength);
+	if (record.httpMethodLength > 0)
+		m_Writer.setString(m_HttpMethodColumn, record.httpMethod, record.httpMethodLength);
+	if (record.httpHostLength > 0)
+		m_Writer.setString(m_HttpHostColumn, record.httpHost, record.httpHostLength);
+	if (record.tlsServerNameLength > 0)
+		m_Writer.setString(m_TlsServerNameColumn, record.tlsServerName, record.tlsServerNameLength);
+
+	return m_Writer.endRow();
+}
+
+bool PacketTableWriter::writeRecord(const PacketRecord& record)
+{
+	return writeRecords(&record, 1);
+}
+
+bool PacketTableWriter::writeRecords(const PacketRecord* records, size_t numOfRecords)
+{
+	bool result = true;
+	pthread_mutex_lock(&m_Mutex);
+	for (size_t i = 0; i < numOfRecords && result; i++)
+		result = addRow(records[i]);
+	if (!result)
+		m_WriteFailed = true;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+bool PacketTableWriter::writePacket(const RawPacket& rawPacket)
+{
+	PacketRecord record;
+	extractRecord(rawPacket, record);
+	return writeRecords(&record, 1);
+}
+
+bool PacketTableWriter::writePackets(IFileReaderDevice& reader)
+{
+	RawPacket rawPacket;
+	while (reader.getNextPacket(rawPacket))
+	{
+		if (!writePacket(rawPacket))
+			return false;
+	}
+
+	return true;
+}
+
+// the state of the workers of writePackets(): every worker extracts records into its own batch
+struct PacketTableWorkers
+{
+	PacketTableWriter* writer;
+	std::vector<std::vector<PacketRecord> > batches;
+};
+
+void PacketTableWriter::onPacketRead(RawPacket& rawPacket, uint64_t packetNumber, int workerIndex, void* userCookie)
+{
+	PacketTableWorkers* workers = (PacketTableWorkers*)userCookie;
+	std::vector<PacketRecord>& batch = workers->batches[workerIndex];
+
+	batch.resize(batch.size() + 1);
+	extractRecord(rawPacket, batch.back());
+	if (batch.size() == PCPP_PACKET_TABLE_WORKER_BATCH_SIZE)
+	{
+		// a failure is recorded by writeRecords() and reported when all workers are done
+		workers->writer->writeRecords(&batch[0], batch.size());
+		batch.clear();
+	}
+}
+
+bool PacketTableWriter::writePackets(const PcapFileIndex& index, int numOfWorkers)
+{
+	if (numOfWorkers <= 0)
+	{
+		LOG_ERROR("Number of workers must be positive");
+		return false;
+	}
+
+	PacketTableWorkers workers;
+	workers.writer = this;
+	workers.batches.resize(numOfWorkers);
+	for (int i = 0; i < numOfWorkers; i++)
+		workers.batches[i].reserve(PCPP_PACKET_TABLE_WORKER_BATCH_SIZE);
+
+	ParallelPcapFileReader reader(index);
+	bool result = reader.read(onPacketRead, &workers, numOfWorkers);
+
+	for (int i = 0; i < numOfWorkers; i++)
+	{
+		if (!workers.batches[i].empty())
+			writeRecords(&workers.batches[i][0], workers.batches[i].size());
+	}
+
+	pthread_mutex_lock(&m_Mutex);
+	result = result && !m_WriteFailed;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+
+FlowTableWriter::FlowTableWriter(const std::string& fileName, size_t rowsPerBatch) : m_Writer(fileName, rowsPerBatch)
+{
+	pthread_mutex_init(&m_Mutex, NULL);
+
+	m_SrcIPColumn = m_Writer.addColumn("src_ip", ArrowFileWriter::StringColumn);
+	m_DstIPColumn = m_Writer.addColumn("dst_ip", ArrowFileWriter::StringColumn);
+	m_SrcPortColumn = m_Writer.addColumn("src_port", ArrowFileWriter::UInt16Column);
+	m_DstPortColumn = m_Writer.addColumn("dst_port", ArrowFileWriter::UInt16Column);
+	m_IPProtocolColumn = m_Writer.addColumn("ip_protocol", ArrowFileWriter::UInt8Column);
+	m_VlanIdColumn = m_Writer.addColumn("vlan_id", ArrowFileWriter::UInt16Column);
+	m_TunnelIdColumn = m_Writer.addColumn("tunnel_id", ArrowFileWriter::UInt32Column);
+	m_MplsLabelColumn = m_Writer.addColumn("mpls_label", ArrowFileWriter::UInt32Column);
+	m_TosColumn = m_Writer.addColumn("tos", ArrowFileWriter::UInt8Column);
+	m_TcpFlagsColumn = m_Writer.addColumn("tcp_flags", ArrowFileWriter::UInt8Column);
+	m_EndReasonColumn = m_Writer.addColumn("end_reason", ArrowFileWriter::UInt8Column);
+	m_PacketsColumn = m_Writer.addColumn("packets", ArrowFileWriter::UInt64Column);
+	m_BytesColumn = m_Writer.addColumn("bytes", ArrowFileWriter::UInt64Column);
+	m_FirstSeenColumn = m_Writer.addColumn("first_seen", ArrowFileWriter::TimestampMsColumn);
+	m_LastSeenColumn = m_Writer.addColumn("last_seen", ArrowFileWriter::TimestampMsColumn);
+}
+
+FlowTableWriter::~FlowTableWriter()
+{
+	if (m_Writer.isOpened())
+		m_Writer.close();
+
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+bool FlowTableWriter::open()
+{
+	return m_Writer.open();
+}
+
+bool FlowTableWriter::close()
+{
+	pthread_mutex_lock(&m_Mutex);
+	bool result = m_Writer.close();
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+uint64_t FlowTableWriter::getNumOfRows()
+{
+	pthread_mutex_lock(&m_Mutex);
+	uint64_t result = m_Writer.getNumOfRows();
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+bool FlowTableWriter::writeFlowRecord(const FlowRecord& record)
+{
+	char address[MAX_ADDR_STRING_LEN];
+
+	pthread_mutex_lock(&m_Mutex);
+	size_t addressLen = formatIPAddress(record.tuple.ipVersion, record.tuple.srcIP, address, sizeof(address));
+	m_Writer.setString(m_SrcIPColumn, address, addressLen);
+	addressLen = formatIPAddress(record.tuple.ipVersion, record.tuple.dstIP, address, sizeof(address));
+	m_Writer.setString(m_DstIPColumn, address, addressLen);
+	m_Writer.setValue(m_SrcPortColumn, record.tuple.srcPort);
+	m_Writer.setValue(m_DstPortColumn, record.tuple.dstPort);
+	m_Writer.setValue(m_IPProtocolColumn, record.tuple.protocol);
+	m_Writer.setValue(m_VlanIdColumn, record.vlanId);
+	m_Writer.setValue(m_TunnelIdColumn, record.tunnelId);
+	m_Writer.setValue(m_MplsLabelColumn, record.mplsLabel);
+	m_Writer.setValue(m_TosColumn, record.tos);
+	m_Writer.setValue(m_TcpFlagsColumn, record.tcpFlags);
+	m_Writer.setValue(m_EndReasonColumn, (uint64_t)record.endReason);
+	m_Writer.setValue(m_PacketsColumn, record.packets);
+	m_Writer.setValue(m_BytesColumn, record.bytes);
+	m_Writer.setValue(m_FirstSeenColumn, record.firstSeen);
+	m_Writer.setValue(m_LastSeenColumn, record.lastSeen);
+	bool result = m_Writer.endRow();
+	pthread_mutex_unlock(&m_Mutex);
+
+	return result;
+}
+
+void FlowTableWriter::onFlowExported(const FlowRecord& record, void* userCookie)
+{
+	((FlowTableWriter*)userCookie)->writeFlowRecord(record);
+}
+
+} // namespace pcpp
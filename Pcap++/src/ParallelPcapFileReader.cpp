@@ -0,0 +1,202 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include "ParallelPcapFileReader.h"
+#include "RawPacketSlabVector.h"
+#include "Logger.h"
+#include <string.h>
+#include <vector>
+
+namespace pcpp
+{
+
+ParallelPcapFileReader::ParallelPcapFileReader(const PcapFileIndex& index) : m_Index(index)
+{
+	m_OnPacketRead = NULL;
+	m_UserCookie = NULL;
+	m_NumOfWorkers = 0;
+	m_PreserveOrder = false;
+	m_BatchSize = PCPP_PARALLEL_READER_DEFAULT_BATCH_SIZE;
+	m_NumOfPacketsRead = 0;
+	m_NextBatch = 0;
+	m_Failed = false;
+}
+
+bool ParallelPcapFileReader::read(OnPacketRead onPacketRead, void* userCookie, int numOfWorkers, bool preserveOrder, size_t batchSize)
+{
+	m_NumOfPacketsRead = 0;
+
+	if (onPacketRead == NULL || numOfWorkers <= 0 || batchSize == 0)
+	{
+		LOG_ERROR("Invalid arguments: a callback, at least one worker and a non-zero batch size are required");
+		return false;
+	}
+
+	uint64_t numOfPackets = m_Index.getNumOfPackets();
+	if (numOfPackets == 0)
+		return true;
+
+	// there is no point in workers which have nothing to read
+	uint64_t numOfUnits = (preserveOrder ? (numOfPackets + batchSize - 1) / batchSize : numOfPackets);
+	if ((uint64_t)numOfWorkers > numOfUnits)
+		numOfWorkers = (int)numOfUnits;
+
+	m_OnPacketRead = onPacketRead;
+	m_UserCookie = userCookie;
+	m_NumOfWorkers = numOfWorkers;
+	m_PreserveOrder = preserveOrder;
+	m_BatchSize = batchSize;
+	m_NextBatch = 0;
+	m_Failed = false;
+	pthread_mutex_init(&m_Mutex, NULL);
+	pthread_cond_init(&m_TurnChanged, NULL);
+
+	std::vector<Worker> workers(numOfWorkers);
+	int numOfThreads = 0;
+	for (int i = 0; i < numOfWorkers; i++)
+	{
+		Worker& worker = workers[i];
+		worker.reader = this;
+		worker.workerIndex = i;
+		worker.firstPacket = numOfPackets * i / numOfWorkers;
+		worker.endPacket = numOfPackets * (i + 1) / numOfWorkers;
+		worker.numOfPacketsRead = 0;
+
+		int err = pthread_create(&worker.thread, NULL, workerThreadMain, &worker);
+		if (err != 0)
+		{
+			LOG_ERROR("Cannot create worker thread #%d: [%s]", i, strerror(err));
+			setFailed();
+			break;
+		}
+
+		numOfThreads++;
+	}
+
+	for (int i = 0; i < numOfThreads; i++)
+	{
+		pthread_join(workers[i].thread, NULL);
+		m_NumOfPacketsRead += workers[i].numOfPacketsRead;
+	}
+
+	pthread_cond_destroy(&m_TurnChanged);
+	pthread_mutex_destroy(&m_Mutex);
+
+	return !m_Failed;
+}
+
+void* ParallelPcapFileReader::workerThreadMain(void* worker)
+{
+	Worker* self = (Worker*)worker;
+	if (self->reader->m_PreserveOrder)
+		self->reader->readBatches(*self);
+	else
+		self->reader->readRange(*self);
+
+	return NULL;
+}
+
+void ParallelPcapFileReader::readRange(Worker& worker)
+{
+	PcapFileIndex::PacketReader packetReader(m_Index);
+	if (!packetReader.open())
+	{
+		setFailed();
+		return;
+	}
+
+	RawPacket rawPacket;
+	for (uint64_t packetNumber = worker.firstPacket; packetNumber < worker.endPacket; packetNumber++)
+	{
+		// checking for a failure of another worker once per batch keeps the mutex out of the way of reading
+		if ((packetNumber - worker.firstPacket) % m_BatchSize == 0 && hasFailed())
+			return;
+
+		if (!packetReader.readPacket(packetNumber, rawPacket))
+		{
+			setFailed();
+			return;
+		}
+
+		m_OnPacketRead(rawPacket, packetNumber, worker.workerIndex, m_UserCookie);
+		worker.numOfPacketsRead++;
+	}
+}
+
+void ParallelPcapFileReader::readBatches(Worker& worker)
+{
+	PcapFileIndex::PacketReader packetReader(m_Index);
+	if (!packetReader.open())
+	{
+		setFailed();
+		return;
+	}
+
+	// each batch is copied out of the reader's buffer so the next batch can be read while waiting for the turn of this one
+	uint64_t numOfPackets = m_Index.getNumOfPackets();
+	uint64_t numOfBatches = (numOfPackets + m_BatchSize - 1) / m_BatchSize;
+	RawPacketSlabVector batchPackets;
+	RawPacket rawPacket;
+	for (uint64_t batch = worker.workerIndex; batch < numOfBatches; batch += m_NumOfWorkers)
+	{
+		uint64_t firstPacket = batch * m_BatchSize;
+		uint64_t endPacket = (firstPacket + m_BatchSize < numOfPackets ? firstPacket + m_BatchSize : numOfPackets);
+		batchPackets.clear();
+		for (uint64_t packetNumber = firstPacket; packetNumber < endPacket; packetNumber++)
+		{
+			if (!packetReader.readPacket(packetNumber, rawPacket))
+			{
+				setFailed();
+				return;
+			}
+
+			batchPackets.pushBack(rawPacket);
+		}
+
+		if (!waitForTurn(batch))
+			return;
+
+		uint64_t packetNumber = firstPacket;
+		for (RawPacketSlabVector::VectorIterator iter = batchPackets.begin(); iter != batchPackets.end(); iter++, packetNumber++)
+			m_OnPacketRead(**iter, packetNumber, worker.workerIndex, m_UserCookie);
+		worker.numOfPacketsRead += batchPackets.size();
+
+		endTurn();
+	}
+}
+
+bool ParallelPcapFileReader::waitForTurn(uint64_t batch)
+{
+	pthread_mutex_lock(&m_Mutex);
+	while (m_NextBatch != batch && !m_Failed)
+		pthread_cond_wait(&m_TurnChanged, &m_Mutex);
+	bool result = !m_Failed;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+void ParallelPcapFileReader::endTurn()
+{
+	pthread_mutex_lock(&m_Mutex);
+	m_NextBatch++;
+	pthread_cond_broadcast(&m_TurnChanged);
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+void ParallelPcapFileReader::setFailed()
+{
+	// waiting workers are woken up so they stop instead of waiting for a batch which will never be handed over
+	pthread_mutex_lock(&m_Mutex);
+	m_Failed = true;
+	pthread_cond_broadcast(&m_TurnChanged);
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+bool ParallelPcapFileReader::hasFailed()
+{
+	pthread_mutex_lock(&m_Mutex);
+	bool result = m_Failed;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+} // namespace pcpp
@@ -0,0 +1,172 @@
+#include "PcapAutoTuner.h"
+#include <string.h>
+
+namespace pcpp
+{
+
+static inline int clampValue(int value, int minValue, int maxValue)
+{
+	if (value < minValue)
+		return minValue;
+	if (value > maxValue)
+		return maxValue;
+	return value;
+}
+
+// doubles a value up to its maximum, a value of 0 grows to 1 so it can keep doubling
+static inline bool increaseValue(int& value, int maxValue)
+{
+	if (value >= maxValue)
+		return false;
+	value = (value > maxValue / 2 ? maxValue : (value > 0 ? value * 2 : 1));
+	return true;
+}
+
+static inline bool decreaseValue(int& value, int minValue)
+{
+	if (value <= minValue)
+		return false;
+	value = (value / 2 < minValue ? minValue : value / 2);
+	return true;
+}
+
+PcapAutoTuner::PcapAutoTuner()
+{
+	disable();
+}
+
+void PcapAutoTuner::configure(const PcapAutoTunerConfiguration& config, const PcapAutoTunerSettings& initialSettings)
+{
+	m_Config = config;
+	if (m_Config.maxBufferSize < m_Config.minBufferSize)
+		m_Config.maxBufferSize = m_Config.minBufferSize;
+	if (m_Config.maxTimeoutMs < m_Config.minTimeoutMs)
+		m_Config.maxTimeoutMs = m_Config.minTimeoutMs;
+	if (m_Config.maxMinToCopy < m_Config.minMinToCopy)
+		m_Config.maxMinToCopy = m_Config.minMinToCopy;
+
+	m_Settings.bufferSize = (initialSettings.bufferSize <= 0 ? m_Config.minBufferSize :
+			clampValue(initialSettings.bufferSize, m_Config.minBufferSize, m_Config.maxBufferSize));
+	m_Settings.timeoutMs = (initialSettings.timeoutMs <= 0 ? m_Config.minTimeoutMs :
+			clampValue(initialSettings.timeoutMs, m_Config.minTimeoutMs, m_Config.maxTimeoutMs));
+	m_Settings.minToCopy = (m_Config.maxMinToCopy == 0 ? initialSettings.minToCopy :
+			clampValue(initialSettings.minToCopy, m_Config.minMinToCopy, m_Config.maxMinToCopy));
+
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_LastEvaluationMs = 0;
+	m_QuietIntervals = 0;
+	m_CooldownIntervals = 0;
+	resetCounters();
+}
+
+void PcapAutoTuner::disable()
+{
+	m_Config = PcapAutoTunerConfiguration(0, 0);
+	memset(&m_Settings, 0, sizeof(m_Settings));
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_LastEvaluationMs = 0;
+	m_QuietIntervals = 0;
+	m_CooldownIntervals = 0;
+	resetCounters();
+}
+
+void PcapAutoTuner::resetCounters()
+{
+	m_HasBaseline = false;
+	m_LastReceived = 0;
+	m_LastDropped = 0;
+	m_IntervalPackets = 0;
+	m_IntervalDispatches = 0;
+}
+
+int PcapAutoTuner::evaluate(uint64_t nowMs, uint64_t numOfReceived, uint64_t numOfDropped)
+{
+	if (!isEnabled())
+		return NoChange;
+
+	uint64_t intervalPackets = m_IntervalPackets;
+	uint64_t intervalDispatches = m_IntervalDispatches;
+	m_IntervalPackets = 0;
+	m_IntervalDispatches = 0;
+	m_LastEvaluationMs = nowMs;
+
+	// the counters of a new handle start from 0, and the 32-bit counters of pcap_stat wrap around
+	if (!m_HasBaseline || numOfReceived < m_LastReceived || numOfDropped < m_LastDropped)
+	{
+		m_HasBaseline = true;
+		m_LastReceived = numOfReceived;
+		m_LastDropped = numOfDropped;
+		return NoChange;
+	}
+
+	uint64_t received = numOfReceived - m_LastReceived;
+	uint64_t dropped = numOfDropped - m_LastDropped;
+	m_LastReceived = numOfReceived;
+	m_LastDropped = numOfDropped;
+
+	m_Stats.evaluations++;
+	m_Stats.lastIntervalDrops = dropped;
+	m_Stats.lastAverageBatchSize = (intervalDispatches > 0 ? (double)intervalPackets / (double)intervalDispatches : 0);
+
+	// the drops of the interval in which a change was made were mostly caused before the change
+	if (m_CooldownIntervals > 0)
+	{
+		m_CooldownIntervals--;
+		return NoChange;
+	}
+
+	int changes = NoChange;
+	if (dropped > 0 && (double)dropped > m_Config.maxDropRatio * (double)received)
+	{
+		m_Stats.intervalsWithDrops++;
+		m_QuietIntervals = 0;
+		if (increaseValue(m_Settings.bufferSize, m_Config.maxBufferSize))
+		{
+			changes |= BufferSizeChanged;
+			m_Stats.bufferIncreases++;
+		}
+		else
+		{
+			// the buffer can't grow anymore, so the application is woken up less often and reads larger batches
+			if (m_Config.maxMinToCopy > 0 && increaseValue(m_Settings.minToCopy, m_Config.maxMinToCopy))
+			{
+				changes |= MinToCopyChanged;
+				m_Stats.minToCopyIncreases++;
+			}
+			if (increaseValue(m_Settings.timeoutMs, m_Config.maxTimeoutMs))
+			{
+				changes |= TimeoutChanged;
+				m_Stats.timeoutIncreases++;
+			}
+			if (changes == NoChange)
+				m_Stats.intervalsWithDropsAtLimits++;
+		}
+	}
+	else if (++m_QuietIntervals >= m_Config.quietIntervalsBeforeDecrease && m_Stats.lastAverageBatchSize < (double)m_Config.smallBatchSize)
+	{
+		m_QuietIntervals = 0;
+		if (m_Config.maxMinToCopy > 0 && decreaseValue(m_Settings.minToCopy, m_Config.minMinToCopy))
+		{
+			changes |= MinToCopyChanged;
+			m_Stats.minToCopyDecreases++;
+		}
+		if (decreaseValue(m_Settings.timeoutMs, m_Config.minTimeoutMs))
+		{
+			changes |= TimeoutChanged;
+			m_Stats.timeoutDecreases++;
+		}
+	}
+
+	if ((changes & (BufferSizeChanged | TimeoutChanged)) != 0)
+		m_CooldownIntervals = m_Config.cooldownIntervals;
+
+	return changes;
+}
+
+void PcapAutoTuner::getStats(PcapAutoTunerStats& stats) const
+{
+	stats = m_Stats;
+	stats.settings = m_Settings;
+}
+
+} // namespace pcpp
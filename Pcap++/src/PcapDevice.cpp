@@ -2,6 +2,7 @@
 #include "PcapFilter.h"
 #include "Logger.h"
 #include <pcap.h>
+#include <pthread.h>
 
 namespace pcpp
 {
@@ -59,38 +60,24 @@ bool IPcapDevice::clearFilter()
 
 bool IPcapDevice::verifyFilter(std::string filterAsString)
 {
-	struct bpf_program prog;
-	LOG_DEBUG("Compiling the filter '%s'", filterAsString.c_str());
-	if (pcap_compile_nopcap(9000, pcpp::LINKTYPE_ETHERNET, &prog, filterAsString.c_str(), 1, 0) < 0)
-	{
-		return false;
-	}
-
-	return true;
+	BpfFilterProgram program;
+	return program.compile(filterAsString);
 }
 
 bool IPcapDevice::matchPacketWithFilter(std::string filterAsString, RawPacket* rawPacket)
 {
-	static std::string curFilter = "";
-	static struct bpf_program prog;
-	if (curFilter != filterAsString)
-	{
-		LOG_DEBUG("Compiling the filter '%s'", filterAsString.c_str());
-		pcap_freecode(&prog);
-		if (pcap_compile_nopcap(9000, pcpp::LINKTYPE_ETHERNET, &prog, filterAsString.c_str(), 1, 0) < 0)
-		{
-			return false;
-		}
-
-		curFilter = filterAsString;
-	}
-
-	struct pcap_pkthdr pktHdr;
-	pktHdr.caplen = rawPacket->getRawDataLen();
-	pktHdr.len = rawPacket->getRawDataLen();
-	pktHdr.ts = rawPacket->getPacketTimeStamp();
-
-	return (pcap_offline_filter(&prog, &pktHdr, rawPacket->getRawData()) != 0);
+	// the last program is shared by all callers, so it's guarded against threads matching with different filters
+	static BpfFilterProgram program;
+	static pthread_mutex_t programMutex = PTHREAD_MUTEX_INITIALIZER;
+
+	pthread_mutex_lock(&programMutex);
+	bool result = false;
+	if ((program.isCompiled() && program.getFilterString() == filterAsString && program.getLinkType() == rawPacket->getLinkLayerType()) ||
+			program.compile(filterAsString, rawPacket->getLinkLayerType()))
+		result = program.matchPacket(rawPacket);
+	pthread_mutex_unlock(&programMutex);
+
+	return result;
 }
 
 bool IPcapDevice::matchPacketWithFilter(GeneralFilter& filter, RawPacket* rawPacket)
@@ -98,6 +85,18 @@ bool IPcapDevice::matchPacketWithFilter(GeneralFilter& filter, RawPacket* rawPac
 	return filter.matchPacketWithFilter(rawPacket);
 }
 
+void IPcapDevice::collectMetrics(MetricsWriter& writer)
+{
+	if (!m_DeviceOpened)
+		return;
+
+	pcap_stat stats;
+	getStatistics(stats);
+	writer.addCounter("pcpp_device_rx_packets_total", "Packets received by the device", stats.ps_recv);
+	writer.addCounter("pcpp_device_rx_dropped_packets_total", "Packets dropped by the device", stats.ps_drop);
+	writer.addCounter("pcpp_device_rx_if_dropped_packets_total", "Packets dropped by the network interface", stats.ps_ifdrop);
+}
+
 std::string IPcapDevice::getPcapLibVersionInfo()
 {
 	return std::string(pcap_lib_version());
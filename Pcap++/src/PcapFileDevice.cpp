@@ -5,12 +5,50 @@
 #include "PcapFileDevice.h"
 #include "light_pcapng_ext.h"
 #include "Logger.h"
+#include "TimestampClock.h"
 #include <string.h>
 #include <fstream>
+#include <new>
+#include "SystemUtils.h"
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <io.h>
+#else
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+#if defined(LINUX) || defined(MAC_OS_X)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#if defined(LINUX)
+#include <sys/inotify.h>
+#include <poll.h>
+#elif defined(MAC_OS_X) || defined(FREEBSD)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/event.h>
+#elif defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <windows.h>
+#include <sys/stat.h>
+#endif
 
 namespace pcpp
 {
 
+// the magic numbers of microsecond and nanosecond resolution pcap files
+#define PCPP_PCAP_MAGIC_MICROSECONDS 0xa1b2c3d4
+#define PCPP_PCAP_MAGIC_NANOSECONDS 0xa1b23c4d
+// the magic numbers as read on a host of the other byte order than the host which wrote the file
+#define PCPP_PCAP_MAGIC_MICROSECONDS_SWAPPED 0xd4c3b2a1
+#define PCPP_PCAP_MAGIC_NANOSECONDS_SWAPPED 0x4d3cb2a1
+
+// the largest record length a followed file is waited for with, unless its snapshot length is larger. It's the maximum snapshot length of
+// libpcap, so longer records are corrupted rather than not written yet
+#define PCPP_FOLLOW_MAX_RECORD_LEN 262144
+
 struct pcap_file_header
 {
     uint32_t magic;
@@ -72,6 +110,13 @@ IFileReaderDevice::IFileReaderDevice(const char* fileName) : IFileDevice(fileNam
 {
 	m_NumOfPacketsNotParsed = 0;
 	m_NumOfPacketsRead = 0;
+	m_RawPacketPool = NULL;
+	m_Index = NULL;
+}
+
+IFileReaderDevice::~IFileReaderDevice()
+{
+	delete m_Index;
 }
 
 IFileReaderDevice* IFileReaderDevice::getReader(const char* fileName)
@@ -113,6 +158,115 @@ int IFileReaderDevice::getNextPackets(RawPacketVector& packetVec, int numOfPacke
 	return numOfPacketsRead;
 }
 
+int IFileReaderDevice::getNextPackets(RawPacketSlabVector& packetVec, int numOfPacketsToRead)
+{
+	// each packet is read into the same raw packet and then copied to the vector. If there's no user pool the read buffers are taken from
+	// a local pool, so the buffer of the previous packet is reused instead of allocating a buffer per packet
+	RawPacketPool localPool;
+	RawPacketPool* origPool = m_RawPacketPool;
+	if (m_RawPacketPool == NULL)
+		m_RawPacketPool = &localPool;
+
+	int numOfPacketsRead = 0;
+	{
+		RawPacket rawPacket;
+		for (; numOfPacketsToRead < 0 || numOfPacketsRead < numOfPacketsToRead; numOfPacketsRead++)
+		{
+			if (!getNextPacket(rawPacket))
+				break;
+
+			if (packetVec.pushBack(rawPacket) == NULL)
+				break;
+		}
+	}
+
+	m_RawPacketPool = origPool;
+	return numOfPacketsRead;
+}
+
+
+bool IFileReaderDevice::seekToOffset(uint64_t offset)
+{
+	LOG_ERROR("Seeking isn't supported by the reader of file '%s'", m_FileName);
+	return false;
+}
+
+bool IFileReaderDevice::prepareIndex()
+{
+	if (m_Index != NULL)
+		return true;
+
+	m_Index = new PcapFileIndex();
+	if (!m_Index->loadOrBuild(m_FileName))
+	{
+		LOG_ERROR("Cannot index file '%s' for seeking", m_FileName);
+		delete m_Index;
+		m_Index = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+bool IFileReaderDevice::loadIndex(const std::string& indexFileName)
+{
+	PcapFileIndex* index = new PcapFileIndex();
+	if (!index->load(indexFileName, m_FileName))
+	{
+		LOG_ERROR("Cannot load index file '%s' of file '%s'", indexFileName.c_str(), m_FileName);
+		delete index;
+		return false;
+	}
+
+	delete m_Index;
+	m_Index = index;
+	return true;
+}
+
+bool IFileReaderDevice::seekToPacket(uint64_t packetNumber)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("File device '%s' not opened", m_FileName);
+		return false;
+	}
+
+	if (!prepareIndex())
+		return false;
+
+	if (packetNumber > m_Index->getNumOfPackets())
+	{
+		LOG_ERROR("Cannot seek to packet #%llu of file '%s', which has %llu packets", (unsigned long long)packetNumber, m_FileName, (unsigned long long)m_Index->getNumOfPackets());
+		return false;
+	}
+
+	uint64_t offset = (packetNumber < m_Index->getNumOfPackets() ? m_Index->getPacketOffset(packetNumber) : m_Index->getFileSize());
+	return seekToOffset(offset);
+}
+
+bool IFileReaderDevice::seekToTime(const timespec& timestamp)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("File device '%s' not opened", m_FileName);
+		return false;
+	}
+
+	uint64_t packetNumber = 0;
+	if (!prepareIndex() || !m_Index->findPacketByTime(timestamp, packetNumber))
+		return false;
+
+	return seekToPacket(packetNumber);
+}
+
+bool IFileReaderDevice::seekToTime(const timeval& timestamp)
+{
+	timespec ts;
+	ts.tv_sec = timestamp.tv_sec;
+	ts.tv_nsec = timestamp.tv_usec * 1000;
+	return seekToTime(ts);
+}
+
 
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // PcapFileReaderDevice members
@@ -140,7 +294,12 @@ bool PcapFileReaderDevice::open()
 	}
 
 	char errbuf[PCAP_ERRBUF_SIZE];
+#ifdef PCAP_TSTAMP_PRECISION_NANO
+	// timestamps of microsecond files are converted to nanoseconds by libpcap, so nanoseconds are never lost
+	m_PcapDescriptor = pcap_open_offline_with_tstamp_precision(m_FileName, PCAP_TSTAMP_PRECISION_NANO, errbuf);
+#else
 	m_PcapDescriptor = pcap_open_offline(m_FileName, errbuf);
+#endif
 	if (m_PcapDescriptor == NULL)
 	{
 		LOG_ERROR("Cannot open file reader device for filename '%s': %s", m_FileName, errbuf);
@@ -155,6 +314,21 @@ bool PcapFileReaderDevice::open()
 	return true;
 }
 
+bool PcapFileReaderDevice::seekToOffset(uint64_t offset)
+{
+	// libpcap reads the records of a file sequentially from its stdio stream, so moving the stream moves the next record read
+	FILE* file = pcap_file(m_PcapDescriptor);
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	bool result = (file != NULL && _fseeki64(file, (__int64)offset, SEEK_SET) == 0);
+#else
+	bool result = (file != NULL && fseeko(file, (off_t)offset, SEEK_SET) == 0);
+#endif
+	if (!result)
+		LOG_ERROR("Cannot seek to offset %llu of file '%s'", (unsigned long long)offset, m_FileName);
+
+	return result;
+}
+
 void PcapFileReaderDevice::getStatistics(pcap_stat& stats)
 {
 	stats.ps_recv = m_NumOfPacketsRead;
@@ -172,16 +346,27 @@ bool PcapFileReaderDevice::getNextPacket(RawPacket& rawPacket)
 		return false;
 	}
 	pcap_pkthdr pkthdr;
-	const uint8_t* pPacketData = pcap_next(m_PcapDescriptor, &pkthdr);
-	if (pPacketData == NULL)
+	const uint8_t* pPacketData = NULL;
+	timespec ts;
+	do
 	{
-		LOG_DEBUG("Packet could not be read. Probably end-of-file");
-		return false;
-	}
+		pPacketData = pcap_next(m_PcapDescriptor, &pkthdr);
+		if (pPacketData == NULL)
+		{
+			LOG_DEBUG("Packet could not be read. Probably end-of-file");
+			return false;
+		}
 
-	uint8_t* pMyPacketData = new uint8_t[pkthdr.caplen];
-	memcpy(pMyPacketData, pPacketData, pkthdr.caplen);
-	if (!rawPacket.setRawData(pMyPacketData, pkthdr.caplen, pkthdr.ts, static_cast<LinkLayerType>(m_PcapLinkLayerType), pkthdr.len))
+		ts.tv_sec = pkthdr.ts.tv_sec;
+#ifdef PCAP_TSTAMP_PRECISION_NANO
+		// in nanosecond precision tv_usec holds nanoseconds
+		ts.tv_nsec = pkthdr.ts.tv_usec;
+#else
+		ts.tv_nsec = pkthdr.ts.tv_usec * 1000;
+#endif
+	} while (!isPacketSampled(pPacketData, pkthdr.caplen, m_PcapLinkLayerType, TimestampClock::toNs(ts)));
+
+	if (!rawPacket.copyRawData(pPacketData, pkthdr.caplen, ts, m_RawPacketPool, static_cast<LinkLayerType>(m_PcapLinkLayerType), pkthdr.len))
 	{
 		LOG_ERROR("Couldn't set data to raw packet");
 		return false;
@@ -195,12 +380,12 @@ bool PcapFileReaderDevice::getNextPacket(RawPacket& rawPacket)
 // PcapNgFileReaderDevice members
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-PcapNgFileReaderDevice::PcapNgFileReaderDevice(const char* fileName) : IFileReaderDevice(fileName)
+PcapNgFileReaderDevice::PcapNgFileReaderDevice(const char* fileName, int numOfDecompressionWorkers, bool zeroCopy) : IFileReaderDevice(fileName)
 {
 	m_LightPcapNg = NULL;
+	m_NumOfDecompressionWorkers = numOfDecompressionWorkers;
+	m_ZeroCopy = zeroCopy;
 	m_CurFilter = "";
-	m_BpfLinkType = -1;
-	m_BpfInitialized = false;
 }
 
 bool PcapNgFileReaderDevice::matchPacketWithFilter(const uint8_t* packetData, size_t packetLen, timeval packetTimestamp, uint16_t linkType)
@@ -208,28 +393,27 @@ bool PcapNgFileReaderDevice::matchPacketWithFilter(const uint8_t* packetData, si
 	if (m_CurFilter == "")
 		return true;
 
-	int linkTypeAsInt = (int)linkType;
+	LinkLayerType linkLayerType = (LinkLayerType)linkType;
 
-	if (m_BpfLinkType != linkTypeAsInt)
+	if (!m_BpfProgram.isCompiled() || m_BpfProgram.getLinkType() != linkLayerType)
 	{
-		LOG_DEBUG("Compiling the filter '%s' for link type %d", m_CurFilter.c_str(), linkTypeAsInt);
-		if (m_BpfInitialized)
-			pcap_freecode(&m_Bpf);
-		if (pcap_compile_nopcap(9000, linkTypeAsInt, &m_Bpf, m_CurFilter.c_str(), 1, 0) < 0)
-		{
-			m_BpfInitialized = false;
+		LOG_DEBUG("Compiling the filter '%s' for link type %d", m_CurFilter.c_str(), (int)linkLayerType);
+		if (!m_BpfProgram.compile(m_CurFilter, linkLayerType))
 			return false;
-		}
+	}
+
+	return m_BpfProgram.matchPacket(packetData, (uint32_t)packetLen, (uint32_t)packetLen);
+}
 
-		m_BpfLinkType = linkTypeAsInt;
-		m_BpfInitialized = true;
+bool PcapNgFileReaderDevice::seekToOffset(uint64_t offset)
+{
+	if (light_pcapng_seek((light_pcapng_t*)m_LightPcapNg, (long)offset) != 0)
+	{
+		LOG_ERROR("Cannot seek to offset %llu of pcapng file '%s'. Compressed files can't be seeked", (unsigned long long)offset, m_FileName);
+		return false;
 	}
 
-	struct pcap_pkthdr pktHdr;
-	pktHdr.caplen = packetLen;
-	pktHdr.len = packetLen;
-	pktHdr.ts = packetTimestamp;
-	return (pcap_offline_filter(&m_Bpf, &pktHdr, packetData) != 0);
+	return true;
 }
 
 bool PcapNgFileReaderDevice::open()
@@ -243,7 +427,7 @@ bool PcapNgFileReaderDevice::open()
 		return true;
 	}
 
-	m_LightPcapNg = light_pcapng_open_read(m_FileName, LIGHT_FALSE);
+	m_LightPcapNg = light_pcapng_open_read_parallel(m_FileName, LIGHT_FALSE, m_NumOfDecompressionWorkers);
 	if (m_LightPcapNg == NULL)
 	{
 		LOG_ERROR("Cannot open pcapng reader device for filename '%s'", m_FileName);
@@ -256,10 +440,11 @@ bool PcapNgFileReaderDevice::open()
 	return true;
 }
 
-bool PcapNgFileReaderDevice::getNextPacket(RawPacket& rawPacket, std::string& packetComment)
+bool PcapNgFileReaderDevice::readNextPacket(RawPacket& rawPacket, std::string* packetComment)
 {
 	rawPacket.clear();
-	packetComment = "";
+	if (packetComment != NULL)
+		*packetComment = "";
 
 	if (m_LightPcapNg == NULL)
 	{
@@ -269,41 +454,61 @@ bool PcapNgFileReaderDevice::getNextPacket(RawPacket& rawPacket, std::string& pa
 
 	light_packet_header pktHeader;
 	const uint8_t* pktData = NULL;
+	light_boolean readComment = (packetComment != NULL ? LIGHT_TRUE : LIGHT_FALSE);
 
-	if (!light_get_next_packet((light_pcapng_t*)m_LightPcapNg, &pktHeader, &pktData))
-	{
-		LOG_DEBUG("Packet could not be read. Probably end-of-file");
-		return false;
-	}
-
-	while (!matchPacketWithFilter(pktData, pktHeader.captured_length, pktHeader.timestamp, pktHeader.data_link))
+	do
 	{
-		if (!light_get_next_packet((light_pcapng_t*)m_LightPcapNg, &pktHeader, &pktData))
+		if (!light_get_next_packet_buffered((light_pcapng_t*)m_LightPcapNg, &pktHeader, &pktData, readComment))
 		{
 			LOG_DEBUG("Packet could not be read. Probably end-of-file");
 			return false;
 		}
+	} while (!matchPacketWithFilter(pktData, pktHeader.captured_length, pktHeader.timestamp, pktHeader.data_link) ||
+			!isPacketSampled(pktData, pktHeader.captured_length, static_cast<LinkLayerType>(pktHeader.data_link), TimestampClock::toNs(pktHeader.timestamp)));
+
+	bool packetSet;
+	if (m_ZeroCopy)
+	{
+		timespec ts;
+		ts.tv_sec = pktHeader.timestamp.tv_sec;
+		ts.tv_nsec = pktHeader.timestamp.tv_usec * 1000;
+		packetSet = rawPacket.setExternalRawData(pktData, pktHeader.captured_length, ts, static_cast<LinkLayerType>(pktHeader.data_link), pktHeader.original_length);
+	}
+	else
+	{
+		packetSet = rawPacket.copyRawData(pktData, pktHeader.captured_length, pktHeader.timestamp, m_RawPacketPool, static_cast<LinkLayerType>(pktHeader.data_link), pktHeader.original_length);
 	}
 
-	uint8_t* myPacketData = new uint8_t[pktHeader.captured_length];
-	memcpy(myPacketData, pktData, pktHeader.captured_length);
-	if (!rawPacket.setRawData(myPacketData, pktHeader.captured_length, pktHeader.timestamp, static_cast<LinkLayerType>(pktHeader.data_link), pktHeader.original_length))
+	if (!packetSet)
 	{
 		LOG_ERROR("Couldn't set data to raw packet");
 		return false;
 	}
 
-	if (pktHeader.comment != NULL && pktHeader.comment_length > 0)
-		packetComment = std::string(pktHeader.comment, pktHeader.comment_length);
+	if (packetComment != NULL && pktHeader.comment != NULL && pktHeader.comment_length > 0)
+		*packetComment = std::string(pktHeader.comment, pktHeader.comment_length);
 
 	m_NumOfPacketsRead++;
 	return true;
 }
 
+bool PcapNgFileReaderDevice::getNextPacket(RawPacket& rawPacket, std::string& packetComment)
+{
+	return readNextPacket(rawPacket, &packetComment);
+}
+
 bool PcapNgFileReaderDevice::getNextPacket(RawPacket& rawPacket)
 {
-	std::string temp;
-	return getNextPacket(rawPacket, temp);
+	return readNextPacket(rawPacket, NULL);
+}
+
+int PcapNgFileReaderDevice::getNextPackets(RawPacketVector& packetVec, int numOfPacketsToRead)
+{
+	bool zeroCopy = m_ZeroCopy;
+	m_ZeroCopy = false;
+	int numOfPacketsRead = IFileReaderDevice::getNextPackets(packetVec, numOfPacketsToRead);
+	m_ZeroCopy = zeroCopy;
+	return numOfPacketsRead;
 }
 
 void PcapNgFileReaderDevice::getStatistics(pcap_stat& stats)
@@ -324,7 +529,7 @@ bool PcapNgFileReaderDevice::setFilter(std::string filterAsString)
 	pcap_freecode(&prog);
 
 	m_CurFilter = filterAsString;
-	m_BpfLinkType = -1;
+	m_BpfProgram.clear();
 	return true;
 }
 
@@ -334,8 +539,7 @@ void PcapNgFileReaderDevice::close()
 		return;
 
 	light_pcapng_close((light_pcapng_t*)m_LightPcapNg);
-	if (m_BpfInitialized)
-		pcap_freecode(&m_Bpf);
+	m_BpfProgram.clear();
 	m_LightPcapNg = NULL;
 	m_DeviceOpened = false;
 	LOG_DEBUG("File reader closed for file '%s'", m_FileName);
@@ -411,174 +615,1230 @@ std::string PcapNgFileReaderDevice::getCaptureFileComment()
 }
 
 
-// ~~~~~~~~~~~~~~~~~~~~~~~~~
-// IFileWriterDevice members
-// ~~~~~~~~~~~~~~~~~~~~~~~~~
-
-IFileWriterDevice:: IFileWriterDevice(const char* fileName) : IFileDevice(fileName)
-{
-	m_NumOfPacketsNotWritten = 0;
-	m_NumOfPacketsWritten = 0;
-}
-
-
-// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// PcapFileWriterDevice members
-// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// MmapPcapFileReaderDevice members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-PcapFileWriterDevice::PcapFileWriterDevice(const char* fileName, LinkLayerType linkLayerType) : IFileWriterDevice(fileName)
+MmapPcapFileReaderDevice::MmapPcapFileReaderDevice(const char* fileName, size_t readAheadSize, bool useHugePages) : IFileReaderDevice(fileName)
 {
-	m_PcapDumpHandler = NULL;
-	m_NumOfPacketsNotWritten = 0;
-	m_NumOfPacketsWritten = 0;
-	m_PcapLinkLayerType = linkLayerType;
-	m_AppendMode = false;
-	m_File = NULL;
+	m_MappedData = NULL;
+	m_MappedLen = 0;
+	m_Offset = 0;
+	m_ReadAheadSize = readAheadSize;
+	m_ReadAheadOffset = 0;
+	m_UseHugePages = useHugePages;
+	m_SwapBytes = false;
+	m_NanosecondPrecision = false;
+	m_SnapshotLength = 0;
+	m_PcapLinkLayerType = LINKTYPE_ETHERNET;
+	m_CurFilter = "";
 }
 
-PcapFileWriterDevice::~PcapFileWriterDevice()
+uint32_t MmapPcapFileReaderDevice::readUInt32(size_t offset) const
 {
+	// headers in the mapped file aren't necessarily aligned
+	uint32_t value;
+	memcpy(&value, m_MappedData + offset, sizeof(value));
+	if (m_SwapBytes)
+		value = (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
 
+	return value;
 }
 
-void PcapFileWriterDevice::closeFile()
+void MmapPcapFileReaderDevice::readAhead()
 {
-	if (m_AppendMode && m_File != NULL)
-	{
-		fclose(m_File);
-		m_File = NULL;
-	}
+#if defined(LINUX) || defined(MAC_OS_X)
+	// the next window is requested when reading reaches the middle of the current one, so it's read while the packets before it are processed
+	if (m_ReadAheadSize == 0 || m_ReadAheadOffset >= m_MappedLen || m_Offset + m_ReadAheadSize / 2 < m_ReadAheadOffset)
+		return;
+
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	size_t start = (m_ReadAheadOffset > m_Offset ? m_ReadAheadOffset : m_Offset);
+	start -= start % pageSize;
+	size_t len = (m_MappedLen - start < m_ReadAheadSize ? m_MappedLen - start : m_ReadAheadSize);
+	madvise(m_MappedData + start, len, MADV_WILLNEED);
+	m_ReadAheadOffset = start + len;
+#endif
 }
 
-bool PcapFileWriterDevice::writePacket(RawPacket const& packet)
+bool MmapPcapFileReaderDevice::seekToOffset(uint64_t offset)
 {
-	if ((!m_AppendMode && m_PcapDescriptor == NULL) || (m_PcapDumpHandler == NULL))
-	{
-		LOG_ERROR("Device not opened");
-		m_NumOfPacketsNotWritten++;
-		return false;
-	}
-
-	if (packet.getLinkLayerType() != m_PcapLinkLayerType)
+	if (offset > m_MappedLen)
 	{
-		LOG_ERROR("Cannot write a packet with a different link layer type");
-		m_NumOfPacketsNotWritten++;
+		LOG_ERROR("Cannot seek to offset %llu of file '%s'", (unsigned long long)offset, m_FileName);
 		return false;
 	}
 
-	pcap_pkthdr pktHdr;
-	pktHdr.caplen = ((RawPacket&)packet).getRawDataLen();
-	pktHdr.len = ((RawPacket&)packet).getFrameLength();
-	pktHdr.ts = ((RawPacket&)packet).getPacketTimeStamp();
-	if (!m_AppendMode)
-		pcap_dump((uint8_t*)m_PcapDumpHandler, &pktHdr, ((RawPacket&)packet).getRawData());
-	else
-	{
-		// Below are actually the lines run by pcap_dump. The reason I had to put them instead pcap_dump is that on Windows using WinPcap
-		// you can't pass pointers between libraries compiled with different compilers. In this case - PcapPlusPlus and WinPcap weren't
-		// compiled with the same compiler so it's impossible to fopen a file in PcapPlusPlus, pass the pointer to WinPcap and use the
-		// FILE* pointer there. Doing this throws an exception. So the only option when implementing append to pcap is to write all relevant
-		// WinPcap code that handles opening/closing/writing to pcap files inside PcapPlusPlus code
-
-		// the reason to create this packet_header struct is timeval has different sizes in 32-bit and 64-bit systems,
-		// but pcap format uses the 32-bit timeval version, so we need to align timeval to that
-		packet_header pktHdrTemp;
-		pktHdrTemp.tv_sec = pktHdr.ts.tv_sec;
-		pktHdrTemp.tv_usec = pktHdr.ts.tv_usec;
-		pktHdrTemp.caplen = pktHdr.caplen;
-		pktHdrTemp.len = pktHdr.len;
-		fwrite(&pktHdrTemp, sizeof(pktHdrTemp), 1, m_File);
-		fwrite(((RawPacket&)packet).getRawData(), pktHdrTemp.caplen, 1, m_File);
-	}
-	LOG_DEBUG("Packet written successfully to '%s'", m_FileName);
-	m_NumOfPacketsWritten++;
+	// read-ahead restarts from the new offset
+	m_Offset = (size_t)offset;
+	m_ReadAheadOffset = m_Offset;
+	readAhead();
 	return true;
 }
 
-bool PcapFileWriterDevice::writePackets(const RawPacketVector& packets)
+bool MmapPcapFileReaderDevice::matchPacketWithFilter(const uint8_t* packetData, uint32_t capturedLen, uint32_t packetLen, timeval packetTimestamp)
 {
-	for (RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+	if (m_CurFilter == "")
+		return true;
+
+	LinkLayerType linkLayerType = (LinkLayerType)m_PcapLinkLayerType;
+
+	if (!m_BpfProgram.isCompiled() || m_BpfProgram.getLinkType() != linkLayerType)
 	{
-		if (!writePacket(**iter))
+		LOG_DEBUG("Compiling the filter '%s' for link type %d", m_CurFilter.c_str(), (int)linkLayerType);
+		if (!m_BpfProgram.compile(m_CurFilter, linkLayerType, m_SnapshotLength > 0 ? (int)m_SnapshotLength : 65535))
 			return false;
 	}
 
-	return true;
+	return m_BpfProgram.matchPacket(packetData, (uint32_t)capturedLen, (uint32_t)packetLen);
 }
 
-bool PcapFileWriterDevice::open()
+bool MmapPcapFileReaderDevice::open()
 {
-	if (m_PcapDescriptor != NULL)
+	m_NumOfPacketsRead = 0;
+	m_NumOfPacketsNotParsed = 0;
+
+	if (m_MappedData != NULL)
 	{
-		LOG_DEBUG("Pcap descriptor already opened. Nothing to do");
+		LOG_DEBUG("File already mapped. Nothing to do");
 		return true;
 	}
 
-	switch(m_PcapLinkLayerType)
+#if defined(LINUX) || defined(MAC_OS_X)
+	int fd = ::open(m_FileName, O_RDONLY);
+	if (fd < 0)
 	{
-		case LINKTYPE_RAW:
-		case LINKTYPE_DLT_RAW2:
-			LOG_ERROR("The only Raw IP link type supported in libpcap/WinPcap is LINKTYPE_DLT_RAW1, please use that instead");
-			return false;
-		default:
-			break;
+		LOG_ERROR("Cannot open file reader device for filename '%s': %s", m_FileName, strerror(errno));
+		m_DeviceOpened = false;
+		return false;
 	}
 
-	m_NumOfPacketsNotWritten = 0;
-	m_NumOfPacketsWritten = 0;
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(pcap_file_header))
+	{
+		LOG_ERROR("Cannot open file reader device for filename '%s': the file is too short to be a pcap file", m_FileName);
+		::close(fd);
+		m_DeviceOpened = false;
+		return false;
+	}
 
-	m_PcapDescriptor = pcap_open_dead(m_PcapLinkLayerType, PCPP_MAX_PACKET_SIZE);
-	if (m_PcapDescriptor == NULL)
+	// the mapping is private and writable, so a packet edited in place changes a private copy of its page and never the file
+	size_t mappedLen = (size_t)fileStat.st_size;
+	void* mappedData = mmap(NULL, mappedLen, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	// the mapping keeps its own reference to the file
+	::close(fd);
+	if (mappedData == MAP_FAILED)
 	{
-		LOG_ERROR("Error opening file writer device for file '%s': pcap_open_dead returned NULL", m_FileName);
+		LOG_ERROR("Cannot map file '%s' to memory: %s", m_FileName, strerror(errno));
 		m_DeviceOpened = false;
 		return false;
 	}
 
+	m_MappedData = (uint8_t*)mappedData;
+	m_MappedLen = mappedLen;
 
-	m_PcapDumpHandler = pcap_dump_open(m_PcapDescriptor, m_FileName);
-	if (m_PcapDumpHandler == NULL)
+	// a file written on a host of the other byte order has a byte-swapped magic number and headers
+	uint32_t magic;
+	memcpy(&magic, m_MappedData, sizeof(magic));
+	m_SwapBytes = (magic == PCPP_PCAP_MAGIC_MICROSECONDS_SWAPPED || magic == PCPP_PCAP_MAGIC_NANOSECONDS_SWAPPED);
+	if (!m_SwapBytes && magic != PCPP_PCAP_MAGIC_MICROSECONDS && magic != PCPP_PCAP_MAGIC_NANOSECONDS)
 	{
-		LOG_ERROR("Error opening file writer device for file '%s': pcap_dump_open returned NULL with error: '%s'",
-				m_FileName, pcap_geterr(m_PcapDescriptor));
+		LOG_ERROR("Cannot open file reader device for filename '%s': not a pcap file or an unsupported pcap format", m_FileName);
+		munmap(m_MappedData, m_MappedLen);
+		m_MappedData = NULL;
+		m_MappedLen = 0;
 		m_DeviceOpened = false;
 		return false;
 	}
 
+	m_NanosecondPrecision = (readUInt32(0) == PCPP_PCAP_MAGIC_NANOSECONDS);
+	m_SnapshotLength = readUInt32(16);
+	// the upper bits of the link type field may hold FCS information
+	m_PcapLinkLayerType = static_cast<LinkLayerType>(readUInt32(20) & 0x0FFFFFFF);
+	m_Offset = sizeof(pcap_file_header);
+	m_ReadAheadOffset = 0;
+
+	madvise(m_MappedData, m_MappedLen, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	if (m_UseHugePages && madvise(m_MappedData, m_MappedLen, MADV_HUGEPAGE) != 0)
+		LOG_DEBUG("Huge pages aren't supported for the mapping of file '%s'", m_FileName);
+#endif
+	readAhead();
+
+	LOG_DEBUG("Successfully opened and mapped file reader device for filename '%s'", m_FileName);
 	m_DeviceOpened = true;
-	LOG_DEBUG("File writer device for file '%s' opened successfully", m_FileName);
 	return true;
+#else
+	LOG_ERROR("Cannot open file reader device for filename '%s': memory-mapped reading isn't supported on this platform", m_FileName);
+	m_DeviceOpened = false;
+	return false;
+#endif
 }
 
-void PcapFileWriterDevice::close()
+bool MmapPcapFileReaderDevice::getNextPacket(RawPacket& rawPacket)
 {
-	if (!m_AppendMode && pcap_dump_flush(m_PcapDumpHandler) == -1)
+	rawPacket.clear();
+	if (m_MappedData == NULL)
 	{
-		LOG_ERROR("Error while flushing the packets to file");
+		LOG_ERROR("File device '%s' not opened", m_FileName);
+		return false;
 	}
-	// in append mode it's impossible to use pcap_dump_flush, see comment above pcap_dump
-	else if (m_AppendMode && fflush(m_File) == EOF)
+
+	while (true)
 	{
-		LOG_ERROR("Error while flushing the packets to file");
-	}
+		size_t remainingLen = m_MappedLen - m_Offset;
+		if (remainingLen == 0)
+		{
+			LOG_DEBUG("Packet could not be read. Probably end-of-file");
+			return false;
+		}
 
-	IFileDevice::close();
+		if (remainingLen < sizeof(packet_header) || readUInt32(m_Offset + 8) > remainingLen - sizeof(packet_header))
+		{
+			LOG_ERROR("Packet record at offset %llu of file '%s' is truncated", (unsigned long long)m_Offset, m_FileName);
+			return false;
+		}
 
-	if (!m_AppendMode)
-		pcap_dump_close(m_PcapDumpHandler);
-	else
-		// in append mode it's impossible to use pcap_dump_close, see comment above pcap_dump
-		fclose(m_File);
+		uint32_t tsSec = readUInt32(m_Offset);
+		uint32_t tsFraction = readUInt32(m_Offset + 4);
+		uint32_t capturedLen = readUInt32(m_Offset + 8);
+		uint32_t packetLen = readUInt32(m_Offset + 12);
+		const uint8_t* packetData = m_MappedData + m_Offset + sizeof(packet_header);
+		m_Offset += sizeof(packet_header) + capturedLen;
+		readAhead();
 
-	m_PcapDumpHandler = NULL;
-	m_File = NULL;
-	LOG_DEBUG("File writer closed for file '%s'", m_FileName);
-}
+		timespec ts;
+		ts.tv_sec = tsSec;
+		ts.tv_nsec = (m_NanosecondPrecision ? tsFraction : tsFraction * 1000);
 
-void PcapFileWriterDevice::getStatistics(pcap_stat& stats)
-{
-	stats.ps_recv = m_NumOfPacketsWritten;
-	stats.ps_drop = m_NumOfPacketsNotWritten;
+		if (m_CurFilter != "")
+		{
+			timeval tv;
+			tv.tv_sec = ts.tv_sec;
+			tv.tv_usec = ts.tv_nsec / 1000;
+			if (!matchPacketWithFilter(packetData, capturedLen, packetLen, tv))
+				continue;
+		}
+
+		if (!isPacketSampled(packetData, capturedLen, m_PcapLinkLayerType, TimestampClock::toNs(ts)))
+			continue;
+
+		if (!rawPacket.setExternalRawData(packetData, (int)capturedLen, ts, m_PcapLinkLayerType, (int)packetLen))
+		{
+			LOG_ERROR("Couldn't set data to raw packet");
+			return false;
+		}
+
+		m_NumOfPacketsRead++;
+		return true;
+	}
+}
+
+void MmapPcapFileReaderDevice::getStatistics(pcap_stat& stats)
+{
+	stats.ps_recv = m_NumOfPacketsRead;
+	stats.ps_drop = m_NumOfPacketsNotParsed;
+	stats.ps_ifdrop = 0;
+	LOG_DEBUG("Statistics received for mmap reader device for filename '%s'", m_FileName);
+}
+
+bool MmapPcapFileReaderDevice::setFilter(std::string filterAsString)
+{
+	struct bpf_program prog;
+	if (pcap_compile_nopcap(9000, 1, &prog, filterAsString.c_str(), 1, 0) < 0)
+	{
+		return false;
+	}
+	pcap_freecode(&prog);
+
+	m_CurFilter = filterAsString;
+	m_BpfProgram.clear();
+	return true;
+}
+
+void MmapPcapFileReaderDevice::close()
+{
+	if (m_MappedData == NULL)
+		return;
+
+#if defined(LINUX) || defined(MAC_OS_X)
+	munmap(m_MappedData, m_MappedLen);
+#endif
+	m_MappedData = NULL;
+	m_MappedLen = 0;
+	m_Offset = 0;
+	m_ReadAheadOffset = 0;
+	m_BpfProgram.clear();
+	m_DeviceOpened = false;
+	LOG_DEBUG("File reader closed for file '%s'", m_FileName);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+// FileChangeWatcher members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+
+/**
+ * Waits for changes of a followed file and of its directory, where the files which replace it or follow it in a sequence are created.
+ * It uses inotify on Linux and kqueue on macOS and FreeBSD, and only sleeps elsewhere or if they fail, in which case the caller's checks
+ * find the changes
+ */
+class FileChangeWatcher
+{
+public:
+	FileChangeWatcher(const char* fileName);
+	~FileChangeWatcher();
+
+	// watch a newly opened file, which kqueue needs a descriptor of
+	void watchFile(FILE* file);
+	// return when a change may have happened, wakeUp() was called or the timeout passed
+	void wait(uint32_t timeoutMs);
+	void wakeUp();
+
+private:
+#if defined(LINUX) || defined(MAC_OS_X) || defined(FREEBSD)
+	// the inotify or kqueue descriptor, or -1 if they couldn't be used
+	int m_NotifyFd;
+	int m_DirFd;
+	int m_WakeUpPipe[2];
+
+	void drainWakeUpPipe();
+#endif
+};
+
+#if defined(LINUX) || defined(MAC_OS_X) || defined(FREEBSD)
+
+FileChangeWatcher::FileChangeWatcher(const char* fileName) : m_NotifyFd(-1), m_DirFd(-1)
+{
+	std::string dirName(fileName);
+	size_t slashPos = dirName.find_last_of('/');
+	dirName = (slashPos == std::string::npos ? "." : (slashPos == 0 ? "/" : dirName.substr(0, slashPos)));
+
+	if (pipe(m_WakeUpPipe) == 0)
+	{
+		fcntl(m_WakeUpPipe[0], F_SETFL, fcntl(m_WakeUpPipe[0], F_GETFL) | O_NONBLOCK);
+		fcntl(m_WakeUpPipe[1], F_SETFL, fcntl(m_WakeUpPipe[1], F_GETFL) | O_NONBLOCK);
+	}
+	else
+	{
+		m_WakeUpPipe[0] = -1;
+		m_WakeUpPipe[1] = -1;
+	}
+
+#if defined(LINUX)
+	// the directory watch also reports writes to the files in it, so the file itself doesn't need a watch
+	m_NotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_NotifyFd >= 0 && inotify_add_watch(m_NotifyFd, dirName.c_str(),
+			IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0)
+	{
+		::close(m_NotifyFd);
+		m_NotifyFd = -1;
+	}
+#else
+	m_NotifyFd = kqueue();
+	m_DirFd = ::open(dirName.c_str(), O_RDONLY);
+	if (m_NotifyFd >= 0 && m_DirFd >= 0)
+	{
+		struct kevent changes[2];
+		int numOfChanges = 0;
+		EV_SET(&changes[numOfChanges++], m_DirFd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE, 0, NULL);
+		if (m_WakeUpPipe[0] >= 0)
+			EV_SET(&changes[numOfChanges++], m_WakeUpPipe[0], EVFILT_READ, EV_ADD | EV_CLEAR, 0, 0, NULL);
+		kevent(m_NotifyFd, changes, numOfChanges, NULL, 0, NULL);
+	}
+#endif
+
+	if (m_NotifyFd < 0)
+		LOG_DEBUG("Cannot watch directory '%s' for changes, polling it instead", dirName.c_str());
+}
+
+FileChangeWatcher::~FileChangeWatcher()
+{
+	if (m_NotifyFd >= 0)
+		::close(m_NotifyFd);
+	if (m_DirFd >= 0)
+		::close(m_DirFd);
+	if (m_WakeUpPipe[0] >= 0)
+	{
+		::close(m_WakeUpPipe[0]);
+		::close(m_WakeUpPipe[1]);
+	}
+}
+
+void FileChangeWatcher::watchFile(FILE* file)
+{
+#if defined(LINUX)
+	(void)file;
+#else
+	// the event is removed when the file is closed
+	if (m_NotifyFd < 0 || file == NULL)
+		return;
+
+	struct kevent change;
+	EV_SET(&change, fileno(file), EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE | NOTE_EXTEND | NOTE_DELETE | NOTE_RENAME, 0, NULL);
+	kevent(m_NotifyFd, &change, 1, NULL, 0, NULL);
+#endif
+}
+
+void FileChangeWatcher::drainWakeUpPipe()
+{
+	char buffer[64];
+	if (m_WakeUpPipe[0] >= 0)
+		while (read(m_WakeUpPipe[0], buffer, sizeof(buffer)) > 0) {}
+}
+
+void FileChangeWatcher::wait(uint32_t timeoutMs)
+{
+#if defined(LINUX)
+	pollfd fds[2];
+	int numOfFds = 0;
+	if (m_NotifyFd >= 0)
+	{
+		fds[numOfFds].fd = m_NotifyFd;
+		fds[numOfFds++].events = POLLIN;
+	}
+	if (m_WakeUpPipe[0] >= 0)
+	{
+		fds[numOfFds].fd = m_WakeUpPipe[0];
+		fds[numOfFds++].events = POLLIN;
+	}
+
+	if (poll(fds, numOfFds, (int)timeoutMs) > 0 && m_NotifyFd >= 0)
+	{
+		// the events only wake the reader up, which then checks the files
+		char events[4096];
+		while (read(m_NotifyFd, events, sizeof(events)) > 0) {}
+	}
+#else
+	if (m_NotifyFd >= 0)
+	{
+		struct kevent events[4];
+		timespec timeout;
+		timeout.tv_sec = timeoutMs / 1000;
+		timeout.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+		kevent(m_NotifyFd, NULL, 0, events, 4, &timeout);
+	}
+	else
+		usleep(timeoutMs * 1000);
+#endif
+
+	drainWakeUpPipe();
+}
+
+void FileChangeWatcher::wakeUp()
+{
+	if (m_WakeUpPipe[1] >= 0)
+	{
+		char byte = 0;
+		if (write(m_WakeUpPipe[1], &byte, 1) < 0)
+			LOG_DEBUG("Cannot wake up the file watcher");
+	}
+}
+
+#else
+
+FileChangeWatcher::FileChangeWatcher(const char* fileName)
+{
+}
+
+FileChangeWatcher::~FileChangeWatcher()
+{
+}
+
+void FileChangeWatcher::watchFile(FILE* file)
+{
+}
+
+void FileChangeWatcher::wait(uint32_t timeoutMs)
+{
+	Sleep(timeoutMs);
+}
+
+void FileChangeWatcher::wakeUp()
+{
+}
+
+#endif
+
+// the size of an open file, which may have grown since it was opened
+static uint64_t getOpenedFileSize(FILE* file)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	struct _stati64 fileStat;
+	if (_fstati64(_fileno(file), &fileStat) != 0)
+		return 0;
+#else
+	struct stat fileStat;
+	if (fstat(fileno(file), &fileStat) != 0)
+		return 0;
+#endif
+	return (uint64_t)fileStat.st_size;
+}
+
+// the size of a file by its name, or 0 if it doesn't exist
+static uint64_t getFileSizeByName(const std::string& fileName)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	struct _stati64 fileStat;
+	if (_stati64(fileName.c_str(), &fileStat) != 0)
+		return 0;
+#else
+	struct stat fileStat;
+	if (stat(fileName.c_str(), &fileStat) != 0)
+		return 0;
+#endif
+	return (uint64_t)fileStat.st_size;
+}
+
+// whether the name of an open file now refers to another file, which replaced it
+static bool isFileReplaced(FILE* file, const char* fileName)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	// files can't be replaced while they're open
+	return false;
+#else
+	struct stat openedStat, namedStat;
+	if (fstat(fileno(file), &openedStat) != 0 || stat(fileName, &namedStat) != 0)
+		return false;
+	return openedStat.st_ino != namedStat.st_ino || openedStat.st_dev != namedStat.st_dev;
+#endif
+}
+
+// the name of the file which follows a file in a sequence, which is its name with the number before the extension incremented, or an
+// empty string if the name doesn't end with a number
+static std::string getNextSequenceFileName(const std::string& fileName)
+{
+	size_t nameStart = fileName.find_last_of("/\\");
+	nameStart = (nameStart == std::string::npos ? 0 : nameStart + 1);
+	size_t numberEnd = fileName.find_last_of('.');
+	if (numberEnd == std::string::npos || numberEnd < nameStart)
+		numberEnd = fileName.size();
+
+	size_t numberStart = numberEnd;
+	while (numberStart > nameStart && fileName[numberStart - 1] >= '0' && fileName[numberStart - 1] <= '9')
+		numberStart--;
+	if (numberStart == numberEnd)
+		return "";
+
+	// the number keeps its width, and grows a digit only when all of its digits are 9
+	std::string nextFileName = fileName;
+	size_t digit = numberEnd;
+	while (digit > numberStart && nextFileName[digit - 1] == '9')
+		nextFileName[--digit] = '0';
+	if (digit > numberStart)
+		nextFileName[digit - 1]++;
+	else
+		nextFileName.insert(numberStart, "1");
+
+	return nextFileName;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// BufferedPcapFileReaderDevice members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+BufferedPcapFileReaderDevice::BufferedPcapFileReaderDevice(const char* fileName, size_t bufferSize) : IFileReaderDevice(fileName)
+{
+	m_File = NULL;
+	m_Buffer = NULL;
+	// the buffer holds at least the file header
+	m_BufferSize = (bufferSize < sizeof(pcap_file_header) ? sizeof(pcap_file_header) : bufferSize);
+	m_BufferLen = 0;
+	m_BufferOffset = 0;
+	m_BufferFileOffset = 0;
+	m_FileSize = 0;
+	m_SwapBytes = false;
+	m_NanosecondPrecision = false;
+	m_SnapshotLength = 0;
+	m_PcapLinkLayerType = LINKTYPE_ETHERNET;
+	m_CurFilter = "";
+	m_Following = false;
+	m_StopFollowing = false;
+	m_Watcher = NULL;
+	m_NumOfRotations = 0;
+	m_NextFileSeenTime = 0;
+	m_NextFileSeenSize = 0;
+}
+
+BufferedPcapFileReaderDevice::~BufferedPcapFileReaderDevice()
+{
+	close();
+	delete m_Watcher;
+	delete [] m_Buffer;
+}
+
+uint32_t BufferedPcapFileReaderDevice::readUInt32(size_t offset) const
+{
+	// records in the buffer aren't necessarily aligned
+	uint32_t value;
+	memcpy(&value, m_Buffer + offset, sizeof(value));
+	if (m_SwapBytes)
+		value = (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+
+	return value;
+}
+
+bool BufferedPcapFileReaderDevice::fillBuffer(size_t neededLen)
+{
+	size_t availableLen = m_BufferLen - m_BufferOffset;
+	if (availableLen >= neededLen)
+		return true;
+
+	// the unparsed data moves to the start of the buffer, which grows if a record doesn't fit in it
+	if (neededLen > m_BufferSize)
+	{
+		uint8_t* newBuffer = new uint8_t[neededLen];
+		memcpy(newBuffer, m_Buffer + m_BufferOffset, availableLen);
+		delete [] m_Buffer;
+		m_Buffer = newBuffer;
+		m_BufferSize = neededLen;
+	}
+	else if (m_BufferOffset > 0)
+		memmove(m_Buffer, m_Buffer + m_BufferOffset, availableLen);
+
+	m_BufferFileOffset += m_BufferOffset;
+	m_BufferLen = availableLen;
+	m_BufferOffset = 0;
+
+	// a followed file may have grown since the last read reached its end
+	clearerr(m_File);
+	while (m_BufferLen < neededLen)
+	{
+		size_t bytesRead = fread(m_Buffer + m_BufferLen, 1, m_BufferSize - m_BufferLen, m_File);
+		if (bytesRead == 0)
+			break;
+		m_BufferLen += bytesRead;
+	}
+
+	return m_BufferLen >= neededLen;
+}
+
+bool BufferedPcapFileReaderDevice::seekToOffset(uint64_t offset)
+{
+	// a record already in the buffer is reached without reading the file again
+	if (offset >= m_BufferFileOffset && offset <= m_BufferFileOffset + m_BufferLen)
+	{
+		m_BufferOffset = (size_t)(offset - m_BufferFileOffset);
+		return true;
+	}
+
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	bool result = (_fseeki64(m_File, (__int64)offset, SEEK_SET) == 0);
+#else
+	bool result = (fseeko(m_File, (off_t)offset, SEEK_SET) == 0);
+#endif
+	if (!result)
+	{
+		LOG_ERROR("Cannot seek to offset %llu of file '%s'", (unsigned long long)offset, m_FileName);
+		return false;
+	}
+
+	m_BufferFileOffset = offset;
+	m_BufferLen = 0;
+	m_BufferOffset = 0;
+	return true;
+}
+
+bool BufferedPcapFileReaderDevice::matchPacketWithFilter(const uint8_t* packetData, uint32_t capturedLen, uint32_t packetLen, timeval packetTimestamp)
+{
+	if (m_CurFilter == "")
+		return true;
+
+	LinkLayerType linkLayerType = (LinkLayerType)m_PcapLinkLayerType;
+
+	if (!m_BpfProgram.isCompiled() || m_BpfProgram.getLinkType() != linkLayerType)
+	{
+		LOG_DEBUG("Compiling the filter '%s' for link type %d", m_CurFilter.c_str(), (int)linkLayerType);
+		if (!m_BpfProgram.compile(m_CurFilter, linkLayerType, m_SnapshotLength > 0 ? (int)m_SnapshotLength : 65535))
+			return false;
+	}
+
+	return m_BpfProgram.matchPacket(packetData, (uint32_t)capturedLen, (uint32_t)packetLen);
+}
+
+bool BufferedPcapFileReaderDevice::open()
+{
+	m_NumOfPacketsRead = 0;
+	m_NumOfPacketsNotParsed = 0;
+
+	if (m_File != NULL)
+	{
+		LOG_DEBUG("File already opened. Nothing to do");
+		return true;
+	}
+
+	m_NumOfRotations = 0;
+	return openFile();
+}
+
+bool BufferedPcapFileReaderDevice::openFile()
+{
+	m_NextFileSeenTime = 0;
+	m_File = fopen(m_FileName, "rb");
+	if (m_File == NULL)
+	{
+		LOG_ERROR("Cannot open file reader device for filename '%s': %s", m_FileName, strerror(errno));
+		m_DeviceOpened = false;
+		return false;
+	}
+
+	// the file is read in chunks of the buffer's size straight into the buffer, so stdio buffering would only add a copy
+	setvbuf(m_File, NULL, _IONBF, 0);
+	if (m_Buffer == NULL)
+		m_Buffer = new uint8_t[m_BufferSize];
+	m_BufferLen = 0;
+	m_BufferOffset = 0;
+	m_BufferFileOffset = 0;
+	m_FileSize = getFileSize();
+
+	uint32_t magic = 0;
+	if (fillBuffer(sizeof(pcap_file_header)))
+		memcpy(&magic, m_Buffer, sizeof(magic));
+
+	// a file written on a host of the other byte order has a byte-swapped magic number and headers
+	m_SwapBytes = (magic == PCPP_PCAP_MAGIC_MICROSECONDS_SWAPPED || magic == PCPP_PCAP_MAGIC_NANOSECONDS_SWAPPED);
+	if (!m_SwapBytes && magic != PCPP_PCAP_MAGIC_MICROSECONDS && magic != PCPP_PCAP_MAGIC_NANOSECONDS)
+	{
+		LOG_ERROR("Cannot open file reader device for filename '%s': not a pcap file or an unsupported pcap format", m_FileName);
+		fclose(m_File);
+		m_File = NULL;
+		m_DeviceOpened = false;
+		return false;
+	}
+
+	m_NanosecondPrecision = (readUInt32(0) == PCPP_PCAP_MAGIC_NANOSECONDS);
+	m_SnapshotLength = readUInt32(16);
+	// the upper bits of the link type field may hold FCS information
+	m_PcapLinkLayerType = static_cast<LinkLayerType>(readUInt32(20) & 0x0FFFFFFF);
+	m_BufferOffset = sizeof(pcap_file_header);
+
+	if (m_Watcher != NULL)
+		m_Watcher->watchFile(m_File);
+
+	LOG_DEBUG("Successfully opened file reader device for filename '%s'", m_FileName);
+	m_DeviceOpened = true;
+	return true;
+}
+
+bool BufferedPcapFileReaderDevice::switchToFile(const std::string& fileName)
+{
+	if (m_BufferOffset < m_BufferLen)
+		LOG_ERROR("Packet record at offset %llu of file '%s' is truncated", (unsigned long long)(m_BufferFileOffset + m_BufferOffset), m_FileName);
+
+	fclose(m_File);
+	m_File = NULL;
+	m_DeviceOpened = false;
+
+	if (fileName != m_FileName)
+	{
+		delete [] m_FileName;
+		m_FileName = new char[fileName.size() + 1];
+		strcpy(m_FileName, fileName.c_str());
+	}
+
+	// the index of the previous file doesn't apply to the new one
+	delete m_Index;
+	m_Index = NULL;
+
+	LOG_DEBUG("Following file '%s'", m_FileName);
+	return openFile();
+}
+
+bool BufferedPcapFileReaderDevice::waitForData()
+{
+	uint64_t startTime = TimestampClock::nowNs();
+
+	while (!m_StopFollowing)
+	{
+		// a record is waited for if its data isn't in the file yet, so it's tried again as soon as the file grows
+		uint64_t readOffset = m_BufferFileOffset + m_BufferLen;
+		if (m_FileSize < readOffset)
+			m_FileSize = readOffset;
+		uint64_t fileSize = getOpenedFileSize(m_File);
+		if (fileSize > m_FileSize)
+		{
+			m_FileSize = fileSize;
+			m_NextFileSeenTime = 0;
+			return true;
+		}
+
+		// a truncated or replaced file is read from its start, once the writer wrote its file header
+		bool replaced = (fileSize < readOffset || isFileReplaced(m_File, m_FileName));
+		if (replaced && getFileSizeByName(m_FileName) >= sizeof(pcap_file_header))
+		{
+			LOG_DEBUG("File '%s' was replaced or truncated, reading it from its start", m_FileName);
+			return switchToFile(m_FileName);
+		}
+
+		uint64_t now = TimestampClock::nowNs();
+		uint32_t waitMs = m_FollowConfig.pollIntervalMs;
+
+		// the writer moved on when the next file has packets, and it's done with the current file when it stays unchanged for a while
+		std::string nextFileName = (m_FollowConfig.followRotation && !replaced ? getNextSequenceFileName(m_FileName) : "");
+		if (!nextFileName.empty() && getFileSizeByName(nextFileName) > sizeof(pcap_file_header))
+		{
+			if (m_NextFileSeenTime == 0 || m_NextFileSeenSize != fileSize)
+			{
+				m_NextFileSeenTime = now;
+				m_NextFileSeenSize = fileSize;
+			}
+
+			uint64_t rotationElapsedMs = (now - m_NextFileSeenTime) / 1000000;
+			if (rotationElapsedMs >= m_FollowConfig.rotationDelayMs)
+			{
+				if (!switchToFile(nextFileName))
+					return false;
+				m_NumOfRotations++;
+				return true;
+			}
+
+			if (m_FollowConfig.rotationDelayMs - rotationElapsedMs < waitMs)
+				waitMs = (uint32_t)(m_FollowConfig.rotationDelayMs - rotationElapsedMs);
+		}
+
+		if (m_FollowConfig.waitTimeoutMs >= 0)
+		{
+			uint64_t elapsedMs = (now - startTime) / 1000000;
+			if (elapsedMs >= (uint64_t)m_FollowConfig.waitTimeoutMs)
+				return false;
+			if ((uint64_t)m_FollowConfig.waitTimeoutMs - elapsedMs < waitMs)
+				waitMs = (uint32_t)(m_FollowConfig.waitTimeoutMs - elapsedMs);
+		}
+
+		m_Watcher->wait(waitMs > 0 ? waitMs : 1);
+	}
+
+	return false;
+}
+
+void BufferedPcapFileReaderDevice::setFollowMode(const PcapFileFollowConfiguration& config)
+{
+	m_FollowConfig = config;
+	if (m_FollowConfig.pollIntervalMs == 0)
+		m_FollowConfig.pollIntervalMs = 1;
+
+	if (m_Watcher == NULL)
+	{
+		m_Watcher = new FileChangeWatcher(m_FileName);
+		m_Watcher->watchFile(m_File);
+	}
+
+	m_StopFollowing = false;
+	m_NextFileSeenTime = 0;
+	m_Following = true;
+}
+
+void BufferedPcapFileReaderDevice::clearFollowMode()
+{
+	m_Following = false;
+	delete m_Watcher;
+	m_Watcher = NULL;
+}
+
+void BufferedPcapFileReaderDevice::stopFollowing()
+{
+	m_StopFollowing = true;
+	if (m_Watcher != NULL)
+		m_Watcher->wakeUp();
+}
+
+bool BufferedPcapFileReaderDevice::readNextRecord(RawPacket& rawPacket)
+{
+	while (true)
+	{
+		if (!fillBuffer(sizeof(packet_header)))
+		{
+			// in follow mode the end of the file, or a record header the writer didn't finish, is where more packets are waited for
+			if (m_Following && !m_StopFollowing)
+			{
+				if (waitForData())
+					continue;
+				return false;
+			}
+
+			if (m_BufferLen == m_BufferOffset)
+			{
+				LOG_DEBUG("Packet could not be read. Probably end-of-file");
+				return false;
+			}
+
+			LOG_ERROR("Packet record at offset %llu of file '%s' is truncated", (unsigned long long)(m_BufferFileOffset + m_BufferOffset), m_FileName);
+			return false;
+		}
+
+		// a corrupted length isn't trusted to grow the buffer beyond the rest of the file
+		uint32_t capturedLen = readUInt32(m_BufferOffset + 8);
+		uint64_t remainingLen = m_FileSize - (m_BufferFileOffset + m_BufferOffset);
+		if (sizeof(packet_header) + (uint64_t)capturedLen > remainingLen || !fillBuffer(sizeof(packet_header) + capturedLen))
+		{
+			// a record which is still being written is waited for, unless its length is corrupted
+			if (m_Following && !m_StopFollowing && (capturedLen <= PCPP_FOLLOW_MAX_RECORD_LEN || capturedLen <= m_SnapshotLength))
+			{
+				if (waitForData())
+					continue;
+				return false;
+			}
+
+			LOG_ERROR("Packet record at offset %llu of file '%s' is truncated", (unsigned long long)(m_BufferFileOffset + m_BufferOffset), m_FileName);
+			return false;
+		}
+
+		uint32_t tsSec = readUInt32(m_BufferOffset);
+		uint32_t tsFraction = readUInt32(m_BufferOffset + 4);
+		uint32_t packetLen = readUInt32(m_BufferOffset + 12);
+		const uint8_t* packetData = m_Buffer + m_BufferOffset + sizeof(packet_header);
+		m_BufferOffset += sizeof(packet_header) + capturedLen;
+
+		timespec ts;
+		ts.tv_sec = tsSec;
+		ts.tv_nsec = (m_NanosecondPrecision ? tsFraction : tsFraction * 1000);
+
+		if (m_CurFilter != "")
+		{
+			timeval tv;
+			tv.tv_sec = ts.tv_sec;
+			tv.tv_usec = ts.tv_nsec / 1000;
+			if (!matchPacketWithFilter(packetData, capturedLen, packetLen, tv))
+				continue;
+		}
+
+		if (!isPacketSampled(packetData, capturedLen, m_PcapLinkLayerType, TimestampClock::toNs(ts)))
+			continue;
+
+		if (!rawPacket.copyRawData(packetData, (int)capturedLen, ts, m_RawPacketPool, m_PcapLinkLayerType, (int)packetLen))
+		{
+			LOG_ERROR("Couldn't set data to raw packet");
+			return false;
+		}
+
+		m_NumOfPacketsRead++;
+		return true;
+	}
+}
+
+bool BufferedPcapFileReaderDevice::getNextPacket(RawPacket& rawPacket)
+{
+	rawPacket.clear();
+	if (m_File == NULL)
+	{
+		LOG_ERROR("File device '%s' not opened", m_FileName);
+		return false;
+	}
+
+	return readNextRecord(rawPacket);
+}
+
+int BufferedPcapFileReaderDevice::getNextPackets(RawPacketVector& packetVec, int numOfPacketsToRead)
+{
+	if (m_File == NULL)
+	{
+		LOG_ERROR("File device '%s' not opened", m_FileName);
+		return 0;
+	}
+
+	int numOfPacketsRead = 0;
+	for (; numOfPacketsToRead < 0 || numOfPacketsRead < numOfPacketsToRead; numOfPacketsRead++)
+	{
+		RawPacket* newPacket = new RawPacket();
+		if (!readNextRecord(*newPacket))
+		{
+			delete newPacket;
+			break;
+		}
+
+		packetVec.pushBack(newPacket);
+	}
+
+	return numOfPacketsRead;
+}
+
+void BufferedPcapFileReaderDevice::getStatistics(pcap_stat& stats)
+{
+	stats.ps_recv = m_NumOfPacketsRead;
+	stats.ps_drop = m_NumOfPacketsNotParsed;
+	stats.ps_ifdrop = 0;
+	LOG_DEBUG("Statistics received for buffered reader device for filename '%s'", m_FileName);
+}
+
+bool BufferedPcapFileReaderDevice::setFilter(std::string filterAsString)
+{
+	struct bpf_program prog;
+	if (pcap_compile_nopcap(9000, 1, &prog, filterAsString.c_str(), 1, 0) < 0)
+	{
+		return false;
+	}
+	pcap_freecode(&prog);
+
+	m_CurFilter = filterAsString;
+	m_BpfProgram.clear();
+	return true;
+}
+
+void BufferedPcapFileReaderDevice::close()
+{
+	if (m_File == NULL)
+		return;
+
+	fclose(m_File);
+	m_File = NULL;
+	m_BufferLen = 0;
+	m_BufferOffset = 0;
+	m_BufferFileOffset = 0;
+	m_BpfProgram.clear();
+	m_DeviceOpened = false;
+	LOG_DEBUG("File reader closed for file '%s'", m_FileName);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+// IFileWriterDevice members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+
+IFileWriterDevice:: IFileWriterDevice(const char* fileName) : IFileDevice(fileName)
+{
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfPacketsWritten = 0;
+	m_Summary = NULL;
+}
+
+IFileWriterDevice::~IFileWriterDevice()
+{
+	delete m_Summary;
+}
+
+bool IFileWriterDevice::setSummaryEnabled(bool enabled)
+{
+	if (m_DeviceOpened)
+	{
+		LOG_ERROR("Cannot enable or disable the summary of file '%s' while it's open", m_FileName);
+		return false;
+	}
+
+	if (!enabled)
+	{
+		delete m_Summary;
+		m_Summary = NULL;
+	}
+	else if (m_Summary == NULL)
+		m_Summary = new PcapFileSummary();
+
+	return true;
+}
+
+void IFileWriterDevice::startSummary(bool appendMode)
+{
+	if (m_Summary == NULL)
+		return;
+
+	m_Summary->clear();
+	if (appendMode && !m_Summary->loadOrBuild(m_FileName))
+		LOG_DEBUG("Cannot summarize the packets already in file '%s'", m_FileName);
+}
+
+void IFileWriterDevice::saveSummary()
+{
+	if (m_Summary == NULL)
+		return;
+
+	uint64_t fileSize;
+	int64_t modificationTime;
+	if (!PcapFileSummary::getFileVersion(m_FileName, fileSize, modificationTime))
+	{
+		LOG_ERROR("Cannot save the summary of file '%s', the file can't be found", m_FileName);
+		return;
+	}
+
+	m_Summary->setFileVersion(fileSize, modificationTime);
+	m_Summary->save(PcapFileSummary::getDefaultSummaryFileName(m_FileName));
+}
+
+void IFileWriterDevice::collectMetrics(MetricsWriter& writer)
+{
+	if (!m_DeviceOpened)
+		return;
+
+	pcap_stat stats;
+	getStatistics(stats);
+	writer.addCounter("pcpp_device_written_packets_total", "Packets written to the file", stats.ps_recv);
+	writer.addCounter("pcpp_device_write_failed_packets_total", "Packets which couldn't be written to the file", stats.ps_drop);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// PcapFileWriterDevice members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+PcapFileWriterDevice::PcapFileWriterDevice(const char* fileName, LinkLayerType linkLayerType, bool nanosecondsPrecision) : IFileWriterDevice(fileName)
+{
+	m_PcapDumpHandler = NULL;
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfPacketsWritten = 0;
+	m_PcapLinkLayerType = linkLayerType;
+	m_AppendMode = false;
+	m_NanosecondsPrecision = nanosecondsPrecision;
+	m_File = NULL;
+}
+
+PcapFileWriterDevice::~PcapFileWriterDevice()
+{
+
+}
+
+void PcapFileWriterDevice::closeFile()
+{
+	if (m_AppendMode && m_File != NULL)
+	{
+		fclose(m_File);
+		m_File = NULL;
+	}
+}
+
+bool PcapFileWriterDevice::writePacket(RawPacket const& packet)
+{
+	if ((!m_AppendMode && m_PcapDescriptor == NULL) || (m_PcapDumpHandler == NULL))
+	{
+		LOG_ERROR("Device not opened");
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	if (packet.getLinkLayerType() != m_PcapLinkLayerType)
+	{
+		LOG_ERROR("Cannot write a packet with a different link layer type");
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	// in nanosecond files the tv_usec field holds nanoseconds
+	timespec ts = packet.getPacketTimeStampNs();
+	pcap_pkthdr pktHdr;
+	pktHdr.caplen = ((RawPacket&)packet).getRawDataLen();
+	pktHdr.len = ((RawPacket&)packet).getFrameLength();
+	pktHdr.ts.tv_sec = ts.tv_sec;
+	pktHdr.ts.tv_usec = (m_NanosecondsPrecision ? ts.tv_nsec : ts.tv_nsec / 1000);
+	if (!m_AppendMode)
+		pcap_dump((uint8_t*)m_PcapDumpHandler, &pktHdr, ((RawPacket&)packet).getRawData());
+	else
+	{
+		// Below are actually the lines run by pcap_dump. The reason I had to put them instead pcap_dump is that on Windows using WinPcap
+		// you can't pass pointers between libraries compiled with different compilers. In this case - PcapPlusPlus and WinPcap weren't
+		// compiled with the same compiler so it's impossible to fopen a file in PcapPlusPlus, pass the pointer to WinPcap and use the
+		// FILE* pointer there. Doing this throws an exception. So the only option when implementing append to pcap is to write all relevant
+		// WinPcap code that handles opening/closing/writing to pcap files inside PcapPlusPlus code
+
+		// the reason to create this packet_header struct is timeval has different sizes in 32-bit and 64-bit systems,
+		// but pcap format uses the 32-bit timeval version, so we need to align timeval to that
+		packet_header pktHdrTemp;
+		pktHdrTemp.tv_sec = pktHdr.ts.tv_sec;
+		pktHdrTemp.tv_usec = pktHdr.ts.tv_usec;
+		pktHdrTemp.caplen = pktHdr.caplen;
+		pktHdrTemp.len = pktHdr.len;
+		fwrite(&pktHdrTemp, sizeof(pktHdrTemp), 1, m_File);
+		fwrite(((RawPacket&)packet).getRawData(), pktHdrTemp.caplen, 1, m_File);
+	}
+	LOG_DEBUG("Packet written successfully to '%s'", m_FileName);
+	addToSummary(packet);
+	m_NumOfPacketsWritten++;
+	return true;
+}
+
+bool PcapFileWriterDevice::writePackets(const RawPacketVector& packets)
+{
+	for (RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+	{
+		if (!writePacket(**iter))
+			return false;
+	}
+
+	return true;
+}
+
+bool PcapFileWriterDevice::open()
+{
+	if (m_PcapDescriptor != NULL)
+	{
+		LOG_DEBUG("Pcap descriptor already opened. Nothing to do");
+		return true;
+	}
+
+	switch(m_PcapLinkLayerType)
+	{
+		case LINKTYPE_RAW:
+		case LINKTYPE_DLT_RAW2:
+			LOG_ERROR("The only Raw IP link type supported in libpcap/WinPcap is LINKTYPE_DLT_RAW1, please use that instead");
+			return false;
+		default:
+			break;
+	}
+
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfPacketsWritten = 0;
+	startSummary(false);
+
+#ifdef PCAP_TSTAMP_PRECISION_NANO
+	m_PcapDescriptor = pcap_open_dead_with_tstamp_precision(m_PcapLinkLayerType, PCPP_MAX_PACKET_SIZE,
+			m_NanosecondsPrecision ? PCAP_TSTAMP_PRECISION_NANO : PCAP_TSTAMP_PRECISION_MICRO);
+#else
+	if (m_NanosecondsPrecision)
+	{
+		LOG_DEBUG("Nanosecond precision isn't supported by this libpcap version, writing file '%s' in microseconds", m_FileName);
+		m_NanosecondsPrecision = false;
+	}
+	m_PcapDescriptor = pcap_open_dead(m_PcapLinkLayerType, PCPP_MAX_PACKET_SIZE);
+#endif
+	if (m_PcapDescriptor == NULL)
+	{
+		LOG_ERROR("Error opening file writer device for file '%s': pcap_open_dead returned NULL", m_FileName);
+		m_DeviceOpened = false;
+		return false;
+	}
+
+
+	m_PcapDumpHandler = pcap_dump_open(m_PcapDescriptor, m_FileName);
+	if (m_PcapDumpHandler == NULL)
+	{
+		LOG_ERROR("Error opening file writer device for file '%s': pcap_dump_open returned NULL with error: '%s'",
+				m_FileName, pcap_geterr(m_PcapDescriptor));
+		m_DeviceOpened = false;
+		return false;
+	}
+
+	m_DeviceOpened = true;
+	LOG_DEBUG("File writer device for file '%s' opened successfully", m_FileName);
+	return true;
+}
+
+void PcapFileWriterDevice::close()
+{
+	if (!m_AppendMode && pcap_dump_flush(m_PcapDumpHandler) == -1)
+	{
+		LOG_ERROR("Error while flushing the packets to file");
+	}
+	// in append mode it's impossible to use pcap_dump_flush, see comment above pcap_dump
+	else if (m_AppendMode && fflush(m_File) == EOF)
+	{
+		LOG_ERROR("Error while flushing the packets to file");
+	}
+
+	IFileDevice::close();
+
+	if (!m_AppendMode)
+		pcap_dump_close(m_PcapDumpHandler);
+	else
+		// in append mode it's impossible to use pcap_dump_close, see comment above pcap_dump
+		fclose(m_File);
+
+	m_PcapDumpHandler = NULL;
+	m_File = NULL;
+	saveSummary();
+	LOG_DEBUG("File writer closed for file '%s'", m_FileName);
+}
+
+void PcapFileWriterDevice::getStatistics(pcap_stat& stats)
+{
+	stats.ps_recv = m_NumOfPacketsWritten;
+	stats.ps_drop = m_NumOfPacketsNotWritten;
 	stats.ps_ifdrop = 0;
 	LOG_DEBUG("Statistics received for writer device for filename '%s'", m_FileName);
 }
@@ -589,6 +1849,7 @@ bool PcapFileWriterDevice::open(bool appendMode)
 		return open();
 
 	m_AppendMode = appendMode;
+	startSummary(true);
 
 #if !defined(WIN32) && !defined(WINx64)
 	m_File = fopen(m_FileName, "r+");
@@ -615,6 +1876,16 @@ bool PcapFileWriterDevice::open(bool appendMode)
 		return false;
 	}
 
+	if (pcapFileHeader.magic != PCPP_PCAP_MAGIC_MICROSECONDS && pcapFileHeader.magic != PCPP_PCAP_MAGIC_NANOSECONDS)
+	{
+		LOG_ERROR("Cannot append to '%s': not a pcap file or the file isn't in the machine's byte order", m_FileName);
+		closeFile();
+		return false;
+	}
+
+	// the packets are written in the precision of the file
+	m_NanosecondsPrecision = (pcapFileHeader.magic == PCPP_PCAP_MAGIC_NANOSECONDS);
+
 	LinkLayerType linkLayerType = static_cast<LinkLayerType>(pcapFileHeader.linktype);
 	if (linkLayerType != m_PcapLinkLayerType)
 	{
@@ -638,17 +1909,419 @@ bool PcapFileWriterDevice::open(bool appendMode)
 }
 
 
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// BufferedPcapFileWriterDevice members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+BufferedPcapFileWriterDevice::BufferedPcapFileWriterDevice(const char* fileName, LinkLayerType linkLayerType, bool nanosecondsPrecision,
+		const BufferedPcapFileWriterConfiguration& config) : IFileWriterDevice(fileName), m_Config(config)
+{
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfPacketsWritten = 0;
+	m_PcapLinkLayerType = linkLayerType;
+	m_NanosecondsPrecision = nanosecondsPrecision;
+	m_File = NULL;
+	for (int i = 0; i < 2; i++)
+	{
+		m_Buffers[i].data = NULL;
+		m_Buffers[i].len = 0;
+		m_Buffers[i].numOfPackets = 0;
+	}
+	m_ActiveBuffer = 0;
+	m_FlushPending = false;
+	m_StopRequested = false;
+	m_WriteFailed = false;
+}
+
+bool BufferedPcapFileWriterDevice::writePacket(RawPacket const& packet)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device not opened");
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	if (packet.getLinkLayerType() != m_PcapLinkLayerType)
+	{
+		LOG_ERROR("Cannot write a packet with a different link layer type");
+		pthread_mutex_lock(&m_Mutex);
+		m_NumOfPacketsNotWritten++;
+		pthread_mutex_unlock(&m_Mutex);
+		return false;
+	}
+
+	// in nanosecond files the tv_usec field holds nanoseconds
+	timespec ts = packet.getPacketTimeStampNs();
+	packet_header pktHdr;
+	pktHdr.tv_sec = (uint32_t)ts.tv_sec;
+	pktHdr.tv_usec = (uint32_t)(m_NanosecondsPrecision ? ts.tv_nsec : ts.tv_nsec / 1000);
+	pktHdr.caplen = (uint32_t)((RawPacket&)packet).getRawDataLen();
+	pktHdr.len = (uint32_t)((RawPacket&)packet).getFrameLength();
+	size_t recordLen = sizeof(pktHdr) + pktHdr.caplen;
+
+	pthread_mutex_lock(&m_Mutex);
+
+	// when the active buffer is full it's handed to the flusher thread, which has to be done with the other buffer first
+	bool result = (recordLen <= m_Config.bufferSize && !m_WriteFailed);
+	if (result && m_Buffers[m_ActiveBuffer].len + recordLen > m_Config.bufferSize)
+		result = submitActiveBuffer(m_Config.blockWhenFull) && !m_WriteFailed;
+
+	if (!result)
+	{
+		m_NumOfPacketsNotWritten++;
+		pthread_mutex_unlock(&m_Mutex);
+		return false;
+	}
+
+	Buffer& buffer = m_Buffers[m_ActiveBuffer];
+	memcpy(buffer.data + buffer.len, &pktHdr, sizeof(pktHdr));
+	memcpy(buffer.data + buffer.len + sizeof(pktHdr), ((RawPacket&)packet).getRawData(), pktHdr.caplen);
+	buffer.len += recordLen;
+	buffer.numOfPackets++;
+	addToSummary(packet);
+
+	pthread_mutex_unlock(&m_Mutex);
+	return true;
+}
+
+bool BufferedPcapFileWriterDevice::writePackets(const RawPacketVector& packets)
+{
+	bool result = true;
+	for (RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+	{
+		if (!writePacket(**iter))
+			result = false;
+	}
+
+	return result;
+}
+
+bool BufferedPcapFileWriterDevice::submitActiveBuffer(bool wait)
+{
+	// the mutex is held by the caller
+	while (m_FlushPending)
+	{
+		if (!wait)
+			return false;
+		pthread_cond_wait(&m_FlushDone, &m_Mutex);
+	}
+
+	// the other buffer was emptied by the flusher thread
+	m_ActiveBuffer = 1 - m_ActiveBuffer;
+	m_FlushPending = true;
+	pthread_cond_signal(&m_FlushRequested);
+	return true;
+}
+
+bool BufferedPcapFileWriterDevice::flush()
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device not opened");
+		return false;
+	}
+
+	pthread_mutex_lock(&m_Mutex);
+	if (m_Buffers[m_ActiveBuffer].len > 0)
+		submitActiveBuffer(true);
+	while (m_FlushPending)
+		pthread_cond_wait(&m_FlushDone, &m_Mutex);
+	bool result = !m_WriteFailed;
+	pthread_mutex_unlock(&m_Mutex);
+
+	return result;
+}
+
+bool BufferedPcapFileWriterDevice::writeBuffer(const Buffer& buffer)
+{
+	// the whole buffer is written at once and passed on to the OS, so packets reach the file within the flush interval
+	if (fwrite(buffer.data, 1, buffer.len, m_File) != buffer.len || fflush(m_File) != 0)
+	{
+		LOG_ERROR("Cannot write to file '%s', error was: %d", m_FileName, errno);
+		return false;
+	}
+
+	if (m_Config.syncPolicy == BufferedPcapFileWriterConfiguration::SyncEveryFlush)
+		return syncFile();
+
+	return true;
+}
+
+bool BufferedPcapFileWriterDevice::syncFile()
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	int result = _commit(_fileno(m_File));
+#else
+	int result = fsync(fileno(m_File));
+#endif
+	if (result != 0)
+	{
+		LOG_ERROR("Cannot sync file '%s' to the disk, error was: %d", m_FileName, errno);
+		return false;
+	}
+
+	return true;
+}
+
+void* BufferedPcapFileWriterDevice::flusherThreadMain(void* device)
+{
+	BufferedPcapFileWriterDevice* self = (BufferedPcapFileWriterDevice*)device;
+
+	pthread_mutex_lock(&self->m_Mutex);
+	bool intervalElapsed = false;
+	while (true)
+	{
+		// a partially filled buffer is written when the interval elapses and when the device is closed
+		if (!self->m_FlushPending && (intervalElapsed || self->m_StopRequested) && self->m_Buffers[self->m_ActiveBuffer].len > 0)
+			self->submitActiveBuffer(false);
+		intervalElapsed = false;
+
+		if (self->m_FlushPending)
+		{
+			// the buffer is written without the mutex, so packets keep being copied to the active buffer meanwhile
+			Buffer& buffer = self->m_Buffers[1 - self->m_ActiveBuffer];
+			bool failed = self->m_WriteFailed;
+			pthread_mutex_unlock(&self->m_Mutex);
+
+			bool written = (!failed && self->writeBuffer(buffer));
+
+			pthread_mutex_lock(&self->m_Mutex);
+			if (written)
+				self->m_NumOfPacketsWritten += buffer.numOfPackets;
+			else
+			{
+				self->m_NumOfPacketsNotWritten += buffer.numOfPackets;
+				self->m_WriteFailed = true;
+			}
+			buffer.len = 0;
+			buffer.numOfPackets = 0;
+			self->m_FlushPending = false;
+			pthread_cond_broadcast(&self->m_FlushDone);
+			continue;
+		}
+
+		if (self->m_StopRequested)
+			break;
+
+		if (self->m_Config.flushIntervalMs == 0)
+		{
+			pthread_cond_wait(&self->m_FlushRequested, &self->m_Mutex);
+			continue;
+		}
+
+		// wait on the system clock, which pthread_cond_timedwait() uses by default
+		timeval now;
+		gettimeofday(&now, NULL);
+		uint64_t deadlineNs = (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_usec * 1000 + (uint64_t)self->m_Config.flushIntervalMs * 1000000;
+		timespec deadline;
+		deadline.tv_sec = (time_t)(deadlineNs / 1000000000);
+		deadline.tv_nsec = (long)(deadlineNs % 1000000000);
+		intervalElapsed = (pthread_cond_timedwait(&self->m_FlushRequested, &self->m_Mutex, &deadline) == ETIMEDOUT);
+	}
+	pthread_mutex_unlock(&self->m_Mutex);
+
+	return NULL;
+}
+
+bool BufferedPcapFileWriterDevice::open()
+{
+	return open(false);
+}
+
+bool BufferedPcapFileWriterDevice::openFile(bool appendMode)
+{
+	if (!appendMode)
+	{
+		m_File = fopen(m_FileName, "wb");
+		if (m_File == NULL)
+		{
+			LOG_ERROR("Cannot open '%s' for writing, error was: %d", m_FileName, errno);
+			return false;
+		}
+
+		pcap_file_header pcapFileHeader;
+		pcapFileHeader.magic = (m_NanosecondsPrecision ? PCPP_PCAP_MAGIC_NANOSECONDS : PCPP_PCAP_MAGIC_MICROSECONDS);
+		pcapFileHeader.version_major = 2;
+		pcapFileHeader.version_minor = 4;
+		pcapFileHeader.thiszone = 0;
+		pcapFileHeader.sigfigs = 0;
+		pcapFileHeader.snaplen = PCPP_MAX_PACKET_SIZE;
+		pcapFileHeader.linktype = (uint32_t)m_PcapLinkLayerType;
+		if (fwrite(&pcapFileHeader, sizeof(pcapFileHeader), 1, m_File) != 1)
+		{
+			LOG_ERROR("Cannot write pcap header to file '%s', error was: %d", m_FileName, errno);
+			closeFile();
+			return false;
+		}
+
+		return true;
+	}
+
+	m_File = fopen(m_FileName, "rb+");
+	if (m_File == NULL)
+	{
+		LOG_ERROR("Cannot open '%s' for reading and writing", m_FileName);
+		return false;
+	}
+
+	pcap_file_header pcapFileHeader;
+	if (fread(&pcapFileHeader, 1, sizeof(pcapFileHeader), m_File) != sizeof(pcapFileHeader))
+	{
+		LOG_ERROR("Cannot read pcap header from file '%s'", m_FileName);
+		closeFile();
+		return false;
+	}
+
+	if (pcapFileHeader.magic != PCPP_PCAP_MAGIC_MICROSECONDS && pcapFileHeader.magic != PCPP_PCAP_MAGIC_NANOSECONDS)
+	{
+		LOG_ERROR("Cannot append to '%s': not a pcap file or the file isn't in the machine's byte order", m_FileName);
+		closeFile();
+		return false;
+	}
+
+	// the packets are written in the precision of the file
+	m_NanosecondsPrecision = (pcapFileHeader.magic == PCPP_PCAP_MAGIC_NANOSECONDS);
+
+	LinkLayerType linkLayerType = static_cast<LinkLayerType>(pcapFileHeader.linktype);
+	if (linkLayerType != m_PcapLinkLayerType)
+	{
+		LOG_ERROR("Pcap file has a different link layer type than the one chosen in BufferedPcapFileWriterDevice c'tor, %d, %d", linkLayerType, m_PcapLinkLayerType);
+		closeFile();
+		return false;
+	}
+
+	if (fseek(m_File, 0, SEEK_END) == -1)
+	{
+		LOG_ERROR("Cannot read pcap file '%s' to it's end, error was: %d", m_FileName, errno);
+		closeFile();
+		return false;
+	}
+
+	return true;
+}
+
+void BufferedPcapFileWriterDevice::closeFile()
+{
+	if (m_File != NULL)
+	{
+		fclose(m_File);
+		m_File = NULL;
+	}
+
+	for (int i = 0; i < 2; i++)
+	{
+		delete [] m_Buffers[i].data;
+		m_Buffers[i].data = NULL;
+		m_Buffers[i].len = 0;
+		m_Buffers[i].numOfPackets = 0;
+	}
+}
+
+bool BufferedPcapFileWriterDevice::open(bool appendMode)
+{
+	if (m_DeviceOpened)
+	{
+		LOG_DEBUG("File '%s' already opened. Nothing to do", m_FileName);
+		return true;
+	}
+
+	if (m_Config.bufferSize < sizeof(packet_header))
+	{
+		LOG_ERROR("The buffer size of file '%s' is too small to hold a packet", m_FileName);
+		return false;
+	}
+
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfPacketsWritten = 0;
+	startSummary(appendMode);
+
+	if (!openFile(appendMode))
+		return false;
+
+	for (int i = 0; i < 2; i++)
+	{
+		m_Buffers[i].data = new (std::nothrow) uint8_t[m_Config.bufferSize];
+		if (m_Buffers[i].data == NULL)
+		{
+			LOG_ERROR("Cannot allocate the buffers of file '%s'", m_FileName);
+			closeFile();
+			return false;
+		}
+	}
+
+	m_ActiveBuffer = 0;
+	m_FlushPending = false;
+	m_StopRequested = false;
+	m_WriteFailed = false;
+	pthread_mutex_init(&m_Mutex, NULL);
+	pthread_cond_init(&m_FlushRequested, NULL);
+	pthread_cond_init(&m_FlushDone, NULL);
+
+	int err = pthread_create(&m_FlusherThread, NULL, flusherThreadMain, this);
+	if (err != 0)
+	{
+		LOG_ERROR("Cannot create the flusher thread of file '%s': [%s]", m_FileName, strerror(err));
+		pthread_cond_destroy(&m_FlushDone);
+		pthread_cond_destroy(&m_FlushRequested);
+		pthread_mutex_destroy(&m_Mutex);
+		closeFile();
+		return false;
+	}
+
+	m_DeviceOpened = true;
+	LOG_DEBUG("Buffered file writer device for file '%s' opened successfully", m_FileName);
+	return true;
+}
+
+void BufferedPcapFileWriterDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	// the flusher thread writes what's left in the buffers before it exits
+	pthread_mutex_lock(&m_Mutex);
+	m_StopRequested = true;
+	pthread_cond_signal(&m_FlushRequested);
+	pthread_mutex_unlock(&m_Mutex);
+	pthread_join(m_FlusherThread, NULL);
+
+	if (m_Config.syncPolicy != BufferedPcapFileWriterConfiguration::SyncNever && !m_WriteFailed)
+		syncFile();
+
+	pthread_cond_destroy(&m_FlushDone);
+	pthread_cond_destroy(&m_FlushRequested);
+	pthread_mutex_destroy(&m_Mutex);
+	closeFile();
+
+	IFileDevice::close();
+	saveSummary();
+	LOG_DEBUG("Buffered file writer closed for file '%s'", m_FileName);
+}
+
+void BufferedPcapFileWriterDevice::getStatistics(pcap_stat& stats)
+{
+	if (m_DeviceOpened)
+		pthread_mutex_lock(&m_Mutex);
+	stats.ps_recv = m_NumOfPacketsWritten;
+	stats.ps_drop = m_NumOfPacketsNotWritten;
+	stats.ps_ifdrop = 0;
+	if (m_DeviceOpened)
+		pthread_mutex_unlock(&m_Mutex);
+	LOG_DEBUG("Statistics received for buffered writer device for filename '%s'", m_FileName);
+}
+
+
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // PcapNgFileWriterDevice members
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-PcapNgFileWriterDevice::PcapNgFileWriterDevice(const char* fileName, int compressionLevel) : IFileWriterDevice(fileName)
+PcapNgFileWriterDevice::PcapNgFileWriterDevice(const char* fileName, int compressionLevel, int numOfCompressionWorkers) : IFileWriterDevice(fileName)
 {
 	m_LightPcapNg = NULL;
 	m_CompressionLevel = compressionLevel;
+	m_NumOfCompressionWorkers = numOfCompressionWorkers;
 	m_CurFilter = "";
-	m_BpfLinkType = -1;
-	m_BpfInitialized = false;
 }
 
 bool PcapNgFileWriterDevice::matchPacketWithFilter(const uint8_t* packetData, size_t packetLen, timeval packetTimestamp, uint16_t linkType)
@@ -656,28 +2329,16 @@ bool PcapNgFileWriterDevice::matchPacketWithFilter(const uint8_t* packetData, si
 	if (m_CurFilter == "")
 		return true;
 
-	int linkTypeAsInt = (int)linkType;
+	LinkLayerType linkLayerType = (LinkLayerType)linkType;
 
-	if (m_BpfLinkType != linkTypeAsInt)
+	if (!m_BpfProgram.isCompiled() || m_BpfProgram.getLinkType() != linkLayerType)
 	{
-		LOG_DEBUG("Compiling the filter '%s' for link type %d", m_CurFilter.c_str(), linkTypeAsInt);
-		if (m_BpfInitialized)
-			pcap_freecode(&m_Bpf);
-		if (pcap_compile_nopcap(9000, linkTypeAsInt, &m_Bpf, m_CurFilter.c_str(), 1, 0) < 0)
-		{
-			m_BpfInitialized = false;
+		LOG_DEBUG("Compiling the filter '%s' for link type %d", m_CurFilter.c_str(), (int)linkLayerType);
+		if (!m_BpfProgram.compile(m_CurFilter, linkLayerType))
 			return false;
-		}
-
-		m_BpfLinkType = linkTypeAsInt;
-		m_BpfInitialized = true;
 	}
 
-	struct pcap_pkthdr pktHdr;
-	pktHdr.caplen = packetLen;
-	pktHdr.len = packetLen;
-	pktHdr.ts = packetTimestamp;
-	return (pcap_offline_filter(&m_Bpf, &pktHdr, packetData) != 0);
+	return m_BpfProgram.matchPacket(packetData, (uint32_t)packetLen, (uint32_t)packetLen);
 }
 
 bool PcapNgFileWriterDevice::open(const char* os, const char* hardware, const char* captureApp, const char* fileComment)
@@ -690,10 +2351,11 @@ bool PcapNgFileWriterDevice::open(const char* os, const char* hardware, const ch
 
 	m_NumOfPacketsNotWritten = 0;
 	m_NumOfPacketsWritten = 0;
+	startSummary(false);
 
 	light_pcapng_file_info* info = light_create_file_info(os, hardware, captureApp, fileComment);
 
-	m_LightPcapNg = light_pcapng_open_write(m_FileName, info, m_CompressionLevel);
+	m_LightPcapNg = light_pcapng_open_write_parallel(m_FileName, info, m_CompressionLevel, m_NumOfCompressionWorkers);
 	if (m_LightPcapNg == NULL)
 	{
 		LOG_ERROR("Error opening file writer device for file '%s': light_pcapng_open_write returned NULL", m_FileName);
@@ -742,6 +2404,7 @@ bool PcapNgFileWriterDevice::writePacket(RawPacket const& packet, const char* co
 	}
 
 	light_write_packet((light_pcapng_t*)m_LightPcapNg, &pktHeader, pktData);
+	addToSummary(packet);
 	m_NumOfPacketsWritten++;
 	return true;
 }
@@ -772,10 +2435,11 @@ bool PcapNgFileWriterDevice::open()
 
 	m_NumOfPacketsNotWritten = 0;
 	m_NumOfPacketsWritten = 0;
+	startSummary(false);
 
 	light_pcapng_file_info* info = light_create_default_file_info();
 
-	m_LightPcapNg = light_pcapng_open_write(m_FileName, info, m_CompressionLevel);
+	m_LightPcapNg = light_pcapng_open_write_parallel(m_FileName, info, m_CompressionLevel, m_NumOfCompressionWorkers);
 	if (m_LightPcapNg == NULL)
 	{
 		LOG_ERROR("Error opening file writer device for file '%s': light_pcapng_open_write returned NULL", m_FileName);
@@ -798,6 +2462,7 @@ bool PcapNgFileWriterDevice::open(bool appendMode)
 
 	m_NumOfPacketsNotWritten = 0;
 	m_NumOfPacketsWritten = 0;
+	startSummary(true);
 
 	m_LightPcapNg = light_pcapng_open_append(m_FileName);
 	if (m_LightPcapNg == NULL)
@@ -821,6 +2486,7 @@ void PcapNgFileWriterDevice::close()
 	light_pcapng_close((light_pcapng_t*)m_LightPcapNg);
 	m_LightPcapNg = NULL;
 	m_DeviceOpened = false;
+	saveSummary();
 	LOG_DEBUG("File writer closed for file '%s'", m_FileName);
 }
 
@@ -842,7 +2508,7 @@ bool PcapNgFileWriterDevice::setFilter(std::string filterAsString)
 	pcap_freecode(&prog);
 
 	m_CurFilter = filterAsString;
-	m_BpfLinkType = -1;
+	m_BpfProgram.clear();
 	return true;
 }
 
@@ -0,0 +1,699 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include "PcapFileIndex.h"
+#include "StateCheckpoint.h"
+#include "Logger.h"
+#include <string.h>
+#include <algorithm>
+
+namespace pcpp
+{
+
+// the magic numbers of pcap files as read on a host of the same and of the other byte order than the host which wrote the file
+#define PCPP_INDEX_PCAP_MAGIC_MICROSECONDS 0xa1b2c3d4
+#define PCPP_INDEX_PCAP_MAGIC_NANOSECONDS 0xa1b23c4d
+#define PCPP_INDEX_PCAP_MAGIC_MICROSECONDS_SWAPPED 0xd4c3b2a1
+#define PCPP_INDEX_PCAP_MAGIC_NANOSECONDS_SWAPPED 0x4d3cb2a1
+
+// pcap-ng block types and the byte-order magic of the section header block
+#define PCPP_PCAPNG_SECTION_HEADER_BLOCK 0x0A0D0D0A
+#define PCPP_PCAPNG_INTERFACE_BLOCK 0x00000001
+#define PCPP_PCAPNG_OBSOLETE_PACKET_BLOCK 0x00000002
+#define PCPP_PCAPNG_SIMPLE_PACKET_BLOCK 0x00000003
+#define PCPP_PCAPNG_ENHANCED_PACKET_BLOCK 0x00000006
+#define PCPP_PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCPP_PCAPNG_BYTE_ORDER_MAGIC_SWAPPED 0x4D3C2B1A
+#define PCPP_PCAPNG_OPTION_TSRESOL 9
+
+static const size_t PcapFileHeaderLen = 24;
+static const size_t PcapRecordHeaderLen = 16;
+static const size_t PcapNgBlockHeaderLen = 8;
+static const uint64_t NanosecondsPerSec = 1000000000;
+
+static inline uint32_t readUInt32(const uint8_t* data, bool swapBytes)
+{
+	// headers read from the file aren't necessarily aligned
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	if (swapBytes)
+		value = (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+
+	return value;
+}
+
+static inline uint16_t readUInt16(const uint8_t* data, bool swapBytes)
+{
+	uint16_t value;
+	memcpy(&value, data, sizeof(value));
+	if (swapBytes)
+		value = (uint16_t)((value >> 8) | (value << 8));
+
+	return value;
+}
+
+static bool seekFile(FILE* file, uint64_t offset)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool readFileSize(FILE* file, uint64_t& fileSize)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	if (_fseeki64(file, 0, SEEK_END) != 0)
+		return false;
+	__int64 size = _ftelli64(file);
+#else
+	if (fseeko(file, 0, SEEK_END) != 0)
+		return false;
+	off_t size = ftello(file);
+#endif
+	if (size < 0)
+		return false;
+
+	fileSize = (uint64_t)size;
+	return seekFile(file, 0);
+}
+
+// convert a timestamp in units of a given resolution to nanoseconds
+static timespec toTimespec(uint64_t timestamp, uint64_t unitsPerSec)
+{
+	timespec ts;
+	ts.tv_sec = (time_t)(timestamp / unitsPerSec);
+	uint64_t fraction = timestamp % unitsPerSec;
+	if (NanosecondsPerSec % unitsPerSec == 0)
+		ts.tv_nsec = (long)(fraction * (NanosecondsPerSec / unitsPerSec));
+	else if (unitsPerSec % NanosecondsPerSec == 0)
+		ts.tv_nsec = (long)(fraction / (unitsPerSec / NanosecondsPerSec));
+	else
+		ts.tv_nsec = (long)((long double)fraction * NanosecondsPerSec / unitsPerSec);
+
+	return ts;
+}
+
+static inline uint64_t toNanoseconds(const timespec& ts)
+{
+	return (uint64_t)ts.tv_sec * NanosecondsPerSec + (uint64_t)ts.tv_nsec;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~
+// PcapFileIndex members
+// ~~~~~~~~~~~~~~~~~~~~~~
+
+PcapFileIndex::PcapFileIndex()
+{
+	m_FileSize = 0;
+	m_IsPcapNg = false;
+}
+
+void PcapFileIndex::clear()
+{
+	m_FileName = "";
+	m_FileSize = 0;
+	m_IsPcapNg = false;
+	m_Interfaces.clear();
+	m_PacketOffsets.clear();
+	m_PacketInterfaces.clear();
+	m_TimeIndex.clear();
+}
+
+void PcapFileIndex::addPacketTimestamp(uint64_t timestamp)
+{
+	// called for the last indexed packet. Entries are running maximums, so they never decrease and can be binary searched
+	size_t block = (size_t)((m_PacketOffsets.size() - 1) / TimeIndexInterval);
+	if (block == m_TimeIndex.size())
+		m_TimeIndex.push_back(m_TimeIndex.empty() ? timestamp : std::max(m_TimeIndex.back(), timestamp));
+	else if (timestamp > m_TimeIndex.back())
+		m_TimeIndex.back() = timestamp;
+}
+
+LinkLayerType PcapFileIndex::getLinkLayerType(uint64_t packetNumber) const
+{
+	uint32_t interfaceIndex = (m_IsPcapNg ? m_PacketInterfaces[packetNumber] : 0);
+	return static_cast<LinkLayerType>(m_Interfaces[interfaceIndex].linkType);
+}
+
+std::string PcapFileIndex::getDefaultIndexFileName(const std::string& fileName)
+{
+	return fileName + ".pidx";
+}
+
+bool PcapFileIndex::build(const std::string& fileName)
+{
+	clear();
+
+	FILE* file = fopen(fileName.c_str(), "rb");
+	if (file == NULL)
+	{
+		LOG_ERROR("Cannot open file '%s' for indexing", fileName.c_str());
+		return false;
+	}
+
+	uint8_t magic[4];
+	if (!readFileSize(file, m_FileSize) || fread(magic, 1, sizeof(magic), file) != sizeof(magic) || !seekFile(file, 0))
+	{
+		LOG_ERROR("Cannot read file '%s' for indexing", fileName.c_str());
+		fclose(file);
+		return false;
+	}
+
+	m_FileName = fileName;
+	m_IsPcapNg = (readUInt32(magic, false) == PCPP_PCAPNG_SECTION_HEADER_BLOCK);
+	bool result = (m_IsPcapNg ? buildPcapNg(file) : buildPcap(file));
+	fclose(file);
+
+	if (!result)
+	{
+		LOG_ERROR("File '%s' isn't a pcap or pcap-ng file or its format isn't supported", fileName.c_str());
+		clear();
+		return false;
+	}
+
+	LOG_DEBUG("Indexed %llu packets of file '%s'", (unsigned long long)m_PacketOffsets.size(), fileName.c_str());
+	return true;
+}
+
+bool PcapFileIndex::buildPcap(FILE* file)
+{
+	uint8_t fileHeader[PcapFileHeaderLen];
+	if (fread(fileHeader, 1, sizeof(fileHeader), file) != sizeof(fileHeader))
+		return false;
+
+	uint32_t magic = readUInt32(fileHeader, false);
+	InterfaceInfo interface;
+	interface.swapBytes = (magic == PCPP_INDEX_PCAP_MAGIC_MICROSECONDS_SWAPPED || magic == PCPP_INDEX_PCAP_MAGIC_NANOSECONDS_SWAPPED);
+	if (!interface.swapBytes && magic != PCPP_INDEX_PCAP_MAGIC_MICROSECONDS && magic != PCPP_INDEX_PCAP_MAGIC_NANOSECONDS)
+		return false;
+
+	interface.tsUnitsPerSec = (readUInt32(fileHeader, interface.swapBytes) == PCPP_INDEX_PCAP_MAGIC_NANOSECONDS ? NanosecondsPerSec : 1000000);
+	interface.snapLen = readUInt32(fileHeader + 16, interface.swapBytes);
+	// the upper bits of the link type field may hold FCS information
+	interface.linkType = (uint16_t)(readUInt32(fileHeader + 20, interface.swapBytes) & 0xFFFF);
+	m_Interfaces.push_back(interface);
+
+	// only the record headers are read, the packet data is skipped
+	uint64_t offset = PcapFileHeaderLen;
+	uint8_t recordHeader[PcapRecordHeaderLen];
+	while (offset + PcapRecordHeaderLen <= m_FileSize)
+	{
+		if (!seekFile(file, offset) || fread(recordHeader, 1, sizeof(recordHeader), file) != sizeof(recordHeader))
+			return false;
+
+		uint64_t recordLen = PcapRecordHeaderLen + readUInt32(recordHeader + 8, interface.swapBytes);
+		if (offset + recordLen > m_FileSize)
+			break;
+
+		m_PacketOffsets.push_back(offset);
+		uint64_t fraction = readUInt32(recordHeader + 4, interface.swapBytes);
+		addPacketTimestamp(toNanoseconds(toTimespec((uint64_t)readUInt32(recordHeader, interface.swapBytes) * interface.tsUnitsPerSec + fraction, interface.tsUnitsPerSec)));
+		offset += recordLen;
+	}
+
+	if (offset != m_FileSize)
+		LOG_DEBUG("The last record of file '%s' is truncated and isn't indexed", m_FileName.c_str());
+
+	return true;
+}
+
+bool PcapFileIndex::buildPcapNg(FILE* file)
+{
+	uint64_t offset = 0;
+	bool swapBytes = false;
+	// interfaces are numbered per section, the index numbers them across the file
+	uint32_t sectionFirstInterface = 0;
+	std::vector<uint8_t> blockData;
+	// enough for the interface id and the timestamp of enhanced and obsolete packet blocks
+	uint8_t blockHeader[PcapNgBlockHeaderLen + 12];
+
+	while (offset + PcapNgBlockHeaderLen <= m_FileSize)
+	{
+		size_t headerLen = (size_t)std::min<uint64_t>(sizeof(blockHeader), m_FileSize - offset);
+		if (!seekFile(file, offset) || fread(blockHeader, 1, headerLen, file) != headerLen)
+			return false;
+
+		// the section header block sets the byte order of the section, its type reads the same in both orders
+		uint32_t blockType = readUInt32(blockHeader, swapBytes);
+		if (blockType == PCPP_PCAPNG_SECTION_HEADER_BLOCK)
+		{
+			uint32_t byteOrderMagic = (headerLen >= PcapNgBlockHeaderLen + 4 ? readUInt32(blockHeader + PcapNgBlockHeaderLen, false) : 0);
+			if (byteOrderMagic != PCPP_PCAPNG_BYTE_ORDER_MAGIC && byteOrderMagic != PCPP_PCAPNG_BYTE_ORDER_MAGIC_SWAPPED)
+				return (offset > 0);
+
+			swapBytes = (byteOrderMagic == PCPP_PCAPNG_BYTE_ORDER_MAGIC_SWAPPED);
+			sectionFirstInterface = (uint32_t)m_Interfaces.size();
+		}
+		else if (offset == 0)
+			return false;
+
+		uint32_t blockLen = readUInt32(blockHeader + 4, swapBytes);
+		if (blockLen < PcapNgBlockHeaderLen + 4 || blockLen % 4 != 0 || offset + blockLen > m_FileSize)
+			break;
+
+		if (blockType == PCPP_PCAPNG_INTERFACE_BLOCK)
+		{
+			// the link type, the snapshot length and the timestamp resolution option
+			blockData.resize(blockLen - PcapNgBlockHeaderLen);
+			if (!seekFile(file, offset + PcapNgBlockHeaderLen) || fread(&blockData[0], 1, blockData.size(), file) != blockData.size())
+				return false;
+
+			InterfaceInfo interface;
+			interface.swapBytes = swapBytes;
+			interface.linkType = (blockData.size() >= 8 ? readUInt16(&blockData[0], swapBytes) : 0);
+			interface.snapLen = (blockData.size() >= 8 ? readUInt32(&blockData[4], swapBytes) : 0);
+			interface.tsUnitsPerSec = 1000000;
+			size_t optionOffset = 8;
+			while (optionOffset + 4 <= blockData.size() - 4)
+			{
+				uint16_t optionCode = readUInt16(&blockData[optionOffset], swapBytes);
+				uint16_t optionLen = readUInt16(&blockData[optionOffset + 2], swapBytes);
+				if (optionCode == 0 || optionOffset + 4 + optionLen > blockData.size() - 4)
+					break;
+
+				if (optionCode == PCPP_PCAPNG_OPTION_TSRESOL && optionLen == 1)
+				{
+					// the resolution is a negative power of 10, or of 2 if the most significant bit is set
+					uint8_t resolution = blockData[optionOffset + 4];
+					uint8_t exponent = resolution & 0x7F;
+					uint64_t unitsPerSec = 1;
+					for (uint8_t i = 0; i < exponent && unitsPerSec <= (uint64_t)-1 / 10; i++)
+						unitsPerSec *= ((resolution & 0x80) ? 2 : 10);
+					interface.tsUnitsPerSec = unitsPerSec;
+				}
+
+				optionOffset += 4 + ((optionLen + 3) & ~3);
+			}
+
+			m_Interfaces.push_back(interface);
+		}
+		else if (blockType == PCPP_PCAPNG_ENHANCED_PACKET_BLOCK || blockType == PCPP_PCAPNG_OBSOLETE_PACKET_BLOCK || blockType == PCPP_PCAPNG_SIMPLE_PACKET_BLOCK)
+		{
+			uint32_t interfaceId = 0;
+			bool hasTimestamp = (blockType != PCPP_PCAPNG_SIMPLE_PACKET_BLOCK && headerLen == sizeof(blockHeader));
+			if (blockType == PCPP_PCAPNG_ENHANCED_PACKET_BLOCK && hasTimestamp)
+				interfaceId = readUInt32(blockHeader + PcapNgBlockHeaderLen, swapBytes);
+			else if (blockType == PCPP_PCAPNG_OBSOLETE_PACKET_BLOCK && hasTimestamp)
+				interfaceId = readUInt16(blockHeader + PcapNgBlockHeaderLen, swapBytes);
+
+			// a packet of an interface which wasn't described isn't indexed, it can't be interpreted
+			if ((uint64_t)sectionFirstInterface + interfaceId < m_Interfaces.size())
+			{
+				m_PacketOffsets.push_back(offset);
+				m_PacketInterfaces.push_back(sectionFirstInterface + interfaceId);
+				uint64_t timestamp = 0;
+				if (hasTimestamp)
+				{
+					timestamp = ((uint64_t)readUInt32(blockHeader + PcapNgBlockHeaderLen + 4, swapBytes) << 32) | readUInt32(blockHeader + PcapNgBlockHeaderLen + 8, swapBytes);
+					timestamp = toNanoseconds(toTimespec(timestamp, m_Interfaces[sectionFirstInterface + interfaceId].tsUnitsPerSec));
+				}
+				addPacketTimestamp(timestamp);
+			}
+			else
+				LOG_DEBUG("Packet block at offset %llu of file '%s' belongs to an unknown interface and isn't indexed", (unsigned long long)offset, m_FileName.c_str());
+		}
+
+		offset += blockLen;
+	}
+
+	if (offset != m_FileSize)
+		LOG_DEBUG("The last block of file '%s' is truncated and isn't indexed", m_FileName.c_str());
+
+	return true;
+}
+
+bool PcapFileIndex::save(const std::string& indexFileName) const
+{
+	std::vector<uint8_t> indexData;
+	CheckpointWriter writer(indexData);
+	writer.reserve(64 + m_PacketOffsets.size() * (m_IsPcapNg ? 8 : 4) + m_TimeIndex.size() * 8);
+
+	writer.writeUInt32(IndexFileMagic);
+	writer.writeUInt16(IndexFileVersion);
+	writer.writeUInt64(m_FileSize);
+	writer.writeUInt8(m_IsPcapNg ? 1 : 0);
+	writer.writeUInt32((uint32_t)m_Interfaces.size());
+	for (std::vector<InterfaceInfo>::const_iterator iter = m_Interfaces.begin(); iter != m_Interfaces.end(); iter++)
+	{
+		writer.writeUInt16(iter->linkType);
+		writer.writeUInt32(iter->snapLen);
+		writer.writeUInt64(iter->tsUnitsPerSec);
+		writer.writeUInt8(iter->swapBytes ? 1 : 0);
+	}
+
+	// offsets are written as the distance from the previous record, which fits in 32 bits unless large non-packet blocks are skipped
+	writer.writeUInt64(m_PacketOffsets.size());
+	uint64_t prevOffset = 0;
+	for (size_t i = 0; i < m_PacketOffsets.size(); i++)
+	{
+		uint64_t delta = m_PacketOffsets[i] - prevOffset;
+		if (delta < 0xFFFFFFFF)
+			writer.writeUInt32((uint32_t)delta);
+		else
+		{
+			writer.writeUInt32(0xFFFFFFFF);
+			writer.writeUInt64(m_PacketOffsets[i]);
+		}
+		prevOffset = m_PacketOffsets[i];
+
+		if (m_IsPcapNg)
+			writer.writeUInt32(m_PacketInterfaces[i]);
+	}
+
+	writer.writeUInt64(m_TimeIndex.size());
+	for (std::vector<uint64_t>::const_iterator iter = m_TimeIndex.begin(); iter != m_TimeIndex.end(); iter++)
+		writer.writeUInt64(*iter);
+
+	if (!writeCheckpointFile(indexFileName, indexData))
+	{
+		LOG_ERROR("Cannot write the index file '%s'", indexFileName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool PcapFileIndex::load(const std::string& indexFileName, const std::string& fileName)
+{
+	clear();
+
+	std::vector<uint8_t> indexData;
+	if (!readCheckpointFile(indexFileName, indexData))
+	{
+		LOG_DEBUG("Cannot read the index file '%s'", indexFileName.c_str());
+		return false;
+	}
+
+	FILE* file = fopen(fileName.c_str(), "rb");
+	uint64_t fileSize = 0;
+	bool gotFileSize = (file != NULL && readFileSize(file, fileSize));
+	if (file != NULL)
+		fclose(file);
+	if (!gotFileSize)
+	{
+		LOG_ERROR("Cannot read the size of file '%s'", fileName.c_str());
+		return false;
+	}
+
+	CheckpointReader reader(indexData.empty() ? NULL : &indexData[0], indexData.size());
+	uint32_t magic = reader.readUInt32();
+	uint16_t version = reader.readUInt16();
+	uint64_t indexedFileSize = reader.readUInt64();
+	if (!reader.isValid() || magic != IndexFileMagic || version != IndexFileVersion)
+	{
+		LOG_ERROR("'%s' isn't an index file of a supported version", indexFileName.c_str());
+		return false;
+	}
+
+	if (indexedFileSize != fileSize)
+	{
+		LOG_DEBUG("The index file '%s' was built for another version of file '%s'", indexFileName.c_str(), fileName.c_str());
+		return false;
+	}
+
+	uint8_t isPcapNg = reader.readUInt8();
+	uint32_t numOfInterfaces = reader.readUInt32();
+	if (isPcapNg > 1 || numOfInterfaces == 0 || numOfInterfaces > reader.getRemainingBytes())
+		reader.setFailed();
+
+	for (uint32_t i = 0; i < numOfInterfaces && reader.isValid(); i++)
+	{
+		InterfaceInfo interface;
+		interface.linkType = reader.readUInt16();
+		interface.snapLen = reader.readUInt32();
+		interface.tsUnitsPerSec = reader.readUInt64();
+		uint8_t swapBytes = reader.readUInt8();
+		interface.swapBytes = (swapBytes != 0);
+		if (interface.tsUnitsPerSec == 0 || swapBytes > 1)
+			reader.setFailed();
+		m_Interfaces.push_back(interface);
+	}
+
+	// every packet takes at least 4 bytes, so a corrupted count doesn't allocate more than the size of the index file
+	uint64_t numOfPackets = reader.readUInt64();
+	if (numOfPackets > reader.getRemainingBytes() / 4)
+		reader.setFailed();
+
+	if (reader.isValid())
+	{
+		m_PacketOffsets.reserve((size_t)numOfPackets);
+		if (isPcapNg)
+			m_PacketInterfaces.reserve((size_t)numOfPackets);
+	}
+
+	uint64_t offset = 0;
+	for (uint64_t i = 0; i < numOfPackets && reader.isValid(); i++)
+	{
+		uint32_t delta = reader.readUInt32();
+		uint64_t nextOffset = (delta == 0xFFFFFFFF ? reader.readUInt64() : offset + delta);
+		// offsets increase and records begin after the file header
+		if ((i > 0 && nextOffset <= offset) || nextOffset >= fileSize)
+			reader.setFailed();
+		offset = nextOffset;
+		m_PacketOffsets.push_back(offset);
+
+		if (isPcapNg)
+		{
+			uint32_t interfaceIndex = reader.readUInt32();
+			if (interfaceIndex >= numOfInterfaces)
+				reader.setFailed();
+			m_PacketInterfaces.push_back(interfaceIndex);
+		}
+	}
+
+	// there's an entry per block of packets, and entries never decrease
+	uint64_t timeIndexSize = reader.readUInt64();
+	if (timeIndexSize != (numOfPackets + TimeIndexInterval - 1) / TimeIndexInterval || timeIndexSize > reader.getRemainingBytes() / 8)
+		reader.setFailed();
+
+	if (reader.isValid())
+		m_TimeIndex.reserve((size_t)timeIndexSize);
+
+	for (uint64_t i = 0; i < timeIndexSize && reader.isValid(); i++)
+	{
+		uint64_t timestamp = reader.readUInt64();
+		if (!m_TimeIndex.empty() && timestamp < m_TimeIndex.back())
+			reader.setFailed();
+		m_TimeIndex.push_back(timestamp);
+	}
+
+	if (!reader.isValid())
+	{
+		LOG_ERROR("The index file '%s' is truncated or corrupted", indexFileName.c_str());
+		clear();
+		return false;
+	}
+
+	m_FileName = fileName;
+	m_FileSize = fileSize;
+	m_IsPcapNg = (isPcapNg != 0);
+	return true;
+}
+
+bool PcapFileIndex::findPacketByTime(const timespec& timestamp, uint64_t& packetNumber) const
+{
+	uint64_t target = toNanoseconds(timestamp);
+	std::vector<uint64_t>::const_iterator blockIter = std::lower_bound(m_TimeIndex.begin(), m_TimeIndex.end(), target);
+	if (blockIter == m_TimeIndex.end())
+	{
+		packetNumber = getNumOfPackets();
+		return true;
+	}
+
+	// the latest timestamp reaches the target within this block, so one of its packets is the first to reach it
+	uint64_t block = (uint64_t)(blockIter - m_TimeIndex.begin());
+	uint64_t latestTimestamp = (block > 0 ? *(blockIter - 1) : 0);
+	uint64_t blockEnd = std::min<uint64_t>((block + 1) * TimeIndexInterval, getNumOfPackets());
+	PacketReader packetReader(*this);
+	if (!packetReader.open())
+		return false;
+
+	RawPacket rawPacket;
+	for (uint64_t i = block * TimeIndexInterval; i < blockEnd; i++)
+	{
+		if (!packetReader.readPacket(i, rawPacket))
+			return false;
+
+		latestTimestamp = std::max(latestTimestamp, toNanoseconds(rawPacket.getPacketTimeStampNs()));
+		if (latestTimestamp >= target)
+		{
+			packetNumber = i;
+			return true;
+		}
+	}
+
+	// the file doesn't match the index
+	LOG_ERROR("Packet timestamps of file '%s' don't match its index", m_FileName.c_str());
+	return false;
+}
+
+bool PcapFileIndex::loadOrBuild(const std::string& fileName)
+{
+	std::string indexFileName = getDefaultIndexFileName(fileName);
+	if (load(indexFileName, fileName))
+		return true;
+
+	if (!build(fileName))
+		return false;
+
+	// the index is still usable if it can't be saved, for example when the file is in a read-only directory
+	if (!save(indexFileName))
+		LOG_DEBUG("The index of file '%s' is used without saving it", fileName.c_str());
+
+	return true;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// PcapFileIndex::PacketReader members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+PcapFileIndex::PacketReader::PacketReader(const PcapFileIndex& index) : m_Index(index)
+{
+	m_File = NULL;
+	m_FilePosition = 0;
+}
+
+PcapFileIndex::PacketReader::~PacketReader()
+{
+	close();
+}
+
+bool PcapFileIndex::PacketReader::open()
+{
+	if (m_File != NULL)
+		return true;
+
+	m_File = fopen(m_Index.getFileName().c_str(), "rb");
+	if (m_File == NULL)
+	{
+		LOG_ERROR("Cannot open indexed file '%s'", m_Index.getFileName().c_str());
+		return false;
+	}
+
+	m_FilePosition = 0;
+	return true;
+}
+
+void PcapFileIndex::PacketReader::close()
+{
+	if (m_File == NULL)
+		return;
+
+	fclose(m_File);
+	m_File = NULL;
+}
+
+bool PcapFileIndex::PacketReader::readPacket(uint64_t packetNumber, RawPacket& rawPacket)
+{
+	rawPacket.clear();
+	if (packetNumber >= m_Index.getNumOfPackets())
+	{
+		LOG_ERROR("Packet #%llu is out of the range of the index", (unsigned long long)packetNumber);
+		return false;
+	}
+
+	uint32_t interfaceIndex = (m_Index.m_IsPcapNg ? m_Index.m_PacketInterfaces[packetNumber] : 0);
+	return readPacketAt(m_Index.m_PacketOffsets[packetNumber], interfaceIndex, rawPacket);
+}
+
+bool PcapFileIndex::PacketReader::readPacketAt(uint64_t offset, uint32_t interfaceIndex, RawPacket& rawPacket)
+{
+	rawPacket.clear();
+	if (m_File == NULL)
+	{
+		LOG_ERROR("Indexed file '%s' not opened", m_Index.getFileName().c_str());
+		return false;
+	}
+
+	if (interfaceIndex >= m_Index.m_Interfaces.size())
+	{
+		LOG_ERROR("Interface #%u doesn't exist in file '%s'", interfaceIndex, m_Index.getFileName().c_str());
+		return false;
+	}
+
+	// packets read in order are read sequentially, seeking would drop the read buffer of the file
+	const InterfaceInfo& interface = m_Index.m_Interfaces[interfaceIndex];
+	if (m_FilePosition != offset && !seekFile(m_File, offset))
+	{
+		m_FilePosition = (uint64_t)-1;
+		LOG_ERROR("Cannot seek to the packet at offset %llu of file '%s'", (unsigned long long)offset, m_Index.getFileName().c_str());
+		return false;
+	}
+
+	// the record header is read first, then the rest of the record which is the packet data or the rest of the block
+	size_t headerLen = (m_Index.m_IsPcapNg ? PcapNgBlockHeaderLen : PcapRecordHeaderLen);
+	uint8_t header[PcapRecordHeaderLen];
+	bool result = (fread(header, 1, headerLen, m_File) == headerLen);
+	uint32_t bodyLen = 0;
+	if (result)
+	{
+		bodyLen = (m_Index.m_IsPcapNg ? readUInt32(header + 4, interface.swapBytes) - (uint32_t)PcapNgBlockHeaderLen : readUInt32(header + 8, interface.swapBytes));
+		if (m_Buffer.size() < bodyLen)
+			m_Buffer.resize(bodyLen);
+		result = (bodyLen == 0 || fread(&m_Buffer[0], 1, bodyLen, m_File) == bodyLen);
+	}
+
+	if (!result)
+	{
+		m_FilePosition = (uint64_t)-1;
+		LOG_ERROR("Cannot read the packet at offset %llu of file '%s'", (unsigned long long)offset, m_Index.getFileName().c_str());
+		return false;
+	}
+
+	m_FilePosition = offset + headerLen + bodyLen;
+
+	const uint8_t* data = (bodyLen > 0 ? &m_Buffer[0] : NULL);
+	uint32_t capturedLen = 0;
+	uint32_t packetLen = 0;
+	timespec ts;
+	size_t dataOffset = 0;
+
+	if (!m_Index.m_IsPcapNg)
+	{
+		capturedLen = bodyLen;
+		packetLen = readUInt32(header + 12, interface.swapBytes);
+		uint64_t fraction = readUInt32(header + 4, interface.swapBytes);
+		ts = toTimespec((uint64_t)readUInt32(header, interface.swapBytes) * interface.tsUnitsPerSec + fraction, interface.tsUnitsPerSec);
+	}
+	else
+	{
+		// the body ends with the repeated block length
+		uint32_t blockType = readUInt32(header, interface.swapBytes);
+		size_t maxDataLen = 0;
+		if (blockType == PCPP_PCAPNG_SIMPLE_PACKET_BLOCK && bodyLen >= 8)
+		{
+			packetLen = readUInt32(data, interface.swapBytes);
+			dataOffset = 4;
+			maxDataLen = bodyLen - 8;
+			capturedLen = packetLen;
+			if (interface.snapLen > 0 && capturedLen > interface.snapLen)
+				capturedLen = interface.snapLen;
+			if (capturedLen > maxDataLen)
+				capturedLen = (uint32_t)maxDataLen;
+			ts.tv_sec = 0;
+			ts.tv_nsec = 0;
+		}
+		else if ((blockType == PCPP_PCAPNG_ENHANCED_PACKET_BLOCK || blockType == PCPP_PCAPNG_OBSOLETE_PACKET_BLOCK) && bodyLen >= 24)
+		{
+			uint64_t timestamp = ((uint64_t)readUInt32(data + 4, interface.swapBytes) << 32) | readUInt32(data + 8, interface.swapBytes);
+			ts = toTimespec(timestamp, interface.tsUnitsPerSec);
+			capturedLen = readUInt32(data + 12, interface.swapBytes);
+			packetLen = readUInt32(data + 16, interface.swapBytes);
+			dataOffset = 20;
+			maxDataLen = bodyLen - 24;
+		}
+
+		if (dataOffset == 0 || capturedLen > maxDataLen)
+		{
+			LOG_ERROR("The packet at offset %llu of file '%s' is malformed", (unsigned long long)offset, m_Index.getFileName().c_str());
+			return false;
+		}
+	}
+
+	return rawPacket.setExternalRawData(data + dataOffset, (int)capturedLen, ts, static_cast<LinkLayerType>(interface.linkType), (int)packetLen);
+}
+
+} // namespace pcpp
@@ -0,0 +1,551 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include "PcapFileSummary.h"
+#include "PcapFileDevice.h"
+#include "PacketView.h"
+#include "StateCheckpoint.h"
+#include "Logger.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <algorithm>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV) //for using ntohl, ntohs, etc.
+#include <winsock2.h>
+#elif LINUX
+#include <in.h> //for using ntohl, ntohs, etc.
+#elif MAC_OS_X
+#include <arpa/inet.h> //for using ntohl, ntohs, etc.
+#endif
+
+namespace pcpp
+{
+
+static const uint64_t NanosecondsPerSec = 1000000000;
+static const size_t PortBitmapSize = 65536 / 8;
+
+static inline uint64_t toNanoseconds(const timespec& ts)
+{
+	return (uint64_t)ts.tv_sec * NanosecondsPerSec + (uint64_t)ts.tv_nsec;
+}
+
+static inline timespec toTimespec(uint64_t timestamp)
+{
+	timespec ts;
+	ts.tv_sec = (time_t)(timestamp / NanosecondsPerSec);
+	ts.tv_nsec = (long)(timestamp % NanosecondsPerSec);
+	return ts;
+}
+
+static inline void setBit(uint8_t* bitmap, uint32_t bit)
+{
+	bitmap[bit / 8] |= (uint8_t)(1 << (bit % 8));
+}
+
+static bool containsBitInRange(const std::vector<uint8_t>& bitmap, uint32_t fromBit, uint32_t toBit)
+{
+	for (uint32_t bit = fromBit; bit <= toBit; bit++)
+	{
+		// skip whole bytes without set bits
+		if (bit % 8 == 0 && bitmap[bit / 8] == 0 && bit + 7 <= toBit)
+		{
+			bit += 7;
+			continue;
+		}
+
+		if ((bitmap[bit / 8] & (1 << (bit % 8))) != 0)
+			return true;
+	}
+
+	return false;
+}
+
+PcapFileSummary::PcapFileSummary(size_t bloomFilterSize) :
+	m_SrcPorts(PortBitmapSize), m_DstPorts(PortBitmapSize), m_SrcIPFilter(bloomFilterSize > 0 ? bloomFilterSize : 1),
+	m_DstIPFilter(bloomFilterSize > 0 ? bloomFilterSize : 1)
+{
+	clear();
+}
+
+void PcapFileSummary::clear()
+{
+	m_FileSize = 0;
+	m_ModificationTime = 0;
+	m_NumOfPackets = 0;
+	m_NumOfNonIPPackets = 0;
+	m_FirstTimestamp = (uint64_t)-1;
+	m_LastTimestamp = 0;
+	m_ProtocolTypes = 0;
+	m_MinSrcIPv4 = 0xffffffff;
+	m_MaxSrcIPv4 = 0;
+	m_MinDstIPv4 = 0xffffffff;
+	m_MaxDstIPv4 = 0;
+	memset(m_IPProtocols, 0, sizeof(m_IPProtocols));
+	memset(m_VlanIds, 0, sizeof(m_VlanIds));
+	std::fill(m_SrcPorts.begin(), m_SrcPorts.end(), 0);
+	std::fill(m_DstPorts.begin(), m_DstPorts.end(), 0);
+	std::fill(m_SrcIPFilter.begin(), m_SrcIPFilter.end(), 0);
+	std::fill(m_DstIPFilter.begin(), m_DstIPFilter.end(), 0);
+}
+
+void PcapFileSummary::addPacket(RawPacket const& rawPacket)
+{
+	uint64_t timestamp = toNanoseconds(rawPacket.getPacketTimeStampNs());
+	if (timestamp < m_FirstTimestamp)
+		m_FirstTimestamp = timestamp;
+	if (timestamp > m_LastTimestamp)
+		m_LastTimestamp = timestamp;
+	m_NumOfPackets++;
+
+	PacketView view;
+	if (!FlowKeyExtractor::extract(&rawPacket, view))
+	{
+		m_NumOfNonIPPackets++;
+		return;
+	}
+
+	m_ProtocolTypes |= view.protocolTypes;
+	if (view.vlanCount > 0)
+		setBit(m_VlanIds, view.vlanId & 0xfff);
+
+	if (view.ipVersion == 0)
+	{
+		m_NumOfNonIPPackets++;
+		return;
+	}
+
+	setBit(m_IPProtocols, view.ipProtocol);
+	size_t addressLen = (view.ipVersion == 4 ? 4 : 16);
+	addToBloomFilter(m_SrcIPFilter, view.srcIP, addressLen);
+	addToBloomFilter(m_DstIPFilter, view.dstIP, addressLen);
+
+	if (view.ipVersion == 4)
+	{
+		uint32_t srcIP = ntohl(view.getSrcIPv4Address().toInt());
+		uint32_t dstIP = ntohl(view.getDstIPv4Address().toInt());
+		m_MinSrcIPv4 = std::min(m_MinSrcIPv4, srcIP);
+		m_MaxSrcIPv4 = std::max(m_MaxSrcIPv4, srcIP);
+		m_MinDstIPv4 = std::min(m_MinDstIPv4, dstIP);
+		m_MaxDstIPv4 = std::max(m_MaxDstIPv4, dstIP);
+	}
+
+	if (view.isPacketOfType((ProtocolType)(TCP | UDP)))
+	{
+		setBit(&m_SrcPorts[0], view.srcPort);
+		setBit(&m_DstPorts[0], view.dstPort);
+	}
+}
+
+bool PcapFileSummary::merge(const PcapFileSummary& other)
+{
+	if (other.getBloomFilterSize() != getBloomFilterSize())
+	{
+		LOG_ERROR("Cannot merge summaries of different Bloom filter sizes");
+		return false;
+	}
+
+	m_NumOfPackets += other.m_NumOfPackets;
+	m_NumOfNonIPPackets += other.m_NumOfNonIPPackets;
+	m_FirstTimestamp = std::min(m_FirstTimestamp, other.m_FirstTimestamp);
+	m_LastTimestamp = std::max(m_LastTimestamp, other.m_LastTimestamp);
+	m_ProtocolTypes |= other.m_ProtocolTypes;
+	m_MinSrcIPv4 = std::min(m_MinSrcIPv4, other.m_MinSrcIPv4);
+	m_MaxSrcIPv4 = std::max(m_MaxSrcIPv4, other.m_MaxSrcIPv4);
+	m_MinDstIPv4 = std::min(m_MinDstIPv4, other.m_MinDstIPv4);
+	m_MaxDstIPv4 = std::max(m_MaxDstIPv4, other.m_MaxDstIPv4);
+
+	for (size_t i = 0; i < sizeof(m_IPProtocols); i++)
+		m_IPProtocols[i] |= other.m_IPProtocols[i];
+	for (size_t i = 0; i < sizeof(m_VlanIds); i++)
+		m_VlanIds[i] |= other.m_VlanIds[i];
+	for (size_t i = 0; i < PortBitmapSize; i++)
+	{
+		m_SrcPorts[i] |= other.m_SrcPorts[i];
+		m_DstPorts[i] |= other.m_DstPorts[i];
+	}
+
+	for (size_t i = 0; i < m_SrcIPFilter.size(); i++)
+	{
+		m_SrcIPFilter[i] = (uint8_t)std::min(255, m_SrcIPFilter[i] + other.m_SrcIPFilter[i]);
+		m_DstIPFilter[i] = (uint8_t)std::min(255, m_DstIPFilter[i] + other.m_DstIPFilter[i]);
+	}
+
+	return true;
+}
+
+bool PcapFileSummary::build(const std::string& fileName)
+{
+	clear();
+
+	uint64_t fileSize;
+	int64_t modificationTime;
+	if (!getFileVersion(fileName, fileSize, modificationTime))
+	{
+		LOG_ERROR("Cannot find file '%s'", fileName.c_str());
+		return false;
+	}
+
+	IFileReaderDevice* reader = IFileReaderDevice::getReader(fileName.c_str());
+	if (!reader->open())
+	{
+		LOG_ERROR("Cannot open file '%s' for reading", fileName.c_str());
+		delete reader;
+		return false;
+	}
+
+	RawPacket rawPacket;
+	while (reader->getNextPacket(rawPacket))
+		addPacket(rawPacket);
+
+	reader->close();
+	delete reader;
+
+	setFileVersion(fileSize, modificationTime);
+	return true;
+}
+
+bool PcapFileSummary::save(const std::string& summaryFileName) const
+{
+	std::vector<uint8_t> summaryData;
+	CheckpointWriter writer(summaryData);
+	writer.reserve(128 + sizeof(m_IPProtocols) + sizeof(m_VlanIds) + 2 * PortBitmapSize + 2 * m_SrcIPFilter.size());
+
+	writer.writeUInt32(SummaryFileMagic);
+	writer.writeUInt16(SummaryFileVersion);
+	writer.writeUInt64(m_FileSize);
+	writer.writeUInt64((uint64_t)m_ModificationTime);
+	writer.writeUInt64(m_NumOfPackets);
+	writer.writeUInt64(m_NumOfNonIPPackets);
+	writer.writeUInt64(m_FirstTimestamp);
+	writer.writeUInt64(m_LastTimestamp);
+	writer.writeUInt64(m_ProtocolTypes);
+	writer.writeUInt32(m_MinSrcIPv4);
+	writer.writeUInt32(m_MaxSrcIPv4);
+	writer.writeUInt32(m_MinDstIPv4);
+	writer.writeUInt32(m_MaxDstIPv4);
+	writer.writeBytes(m_IPProtocols, sizeof(m_IPProtocols));
+	writer.writeBytes(m_VlanIds, sizeof(m_VlanIds));
+	writer.writeBytes(&m_SrcPorts[0], PortBitmapSize);
+	writer.writeBytes(&m_DstPorts[0], PortBitmapSize);
+	writer.writeUInt32((uint32_t)m_SrcIPFilter.size());
+	writer.writeBytes(&m_SrcIPFilter[0], m_SrcIPFilter.size());
+	writer.writeBytes(&m_DstIPFilter[0], m_DstIPFilter.size());
+
+	if (!writeCheckpointFile(summaryFileName, summaryData))
+	{
+		LOG_ERROR("Cannot write the summary file '%s'", summaryFileName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool PcapFileSummary::load(const std::string& summaryFileName, const std::string& fileName)
+{
+	clear();
+
+	std::vector<uint8_t> summaryData;
+	if (!readCheckpointFile(summaryFileName, summaryData))
+	{
+		LOG_DEBUG("Cannot read the summary file '%s'", summaryFileName.c_str());
+		return false;
+	}
+
+	uint64_t fileSize;
+	int64_t modificationTime;
+	if (!getFileVersion(fileName, fileSize, modificationTime))
+	{
+		LOG_ERROR("Cannot find file '%s'", fileName.c_str());
+		return false;
+	}
+
+	CheckpointReader reader(summaryData.empty() ? NULL : &summaryData[0], summaryData.size());
+	uint32_t magic = reader.readUInt32();
+	uint16_t version = reader.readUInt16();
+	uint64_t summarizedFileSize = reader.readUInt64();
+	int64_t summarizedModificationTime = (int64_t)reader.readUInt64();
+	if (!reader.isValid() || magic != SummaryFileMagic || version != SummaryFileVersion)
+	{
+		LOG_ERROR("'%s' isn't a summary file of a supported version", summaryFileName.c_str());
+		return false;
+	}
+
+	if (summarizedFileSize != fileSize || summarizedModificationTime != modificationTime)
+	{
+		LOG_DEBUG("The summary file '%s' was built for another version of file '%s'", summaryFileName.c_str(), fileName.c_str());
+		return false;
+	}
+
+	m_NumOfPackets = reader.readUInt64();
+	m_NumOfNonIPPackets = reader.readUInt64();
+	m_FirstTimestamp = reader.readUInt64();
+	m_LastTimestamp = reader.readUInt64();
+	m_ProtocolTypes = reader.readUInt64();
+	m_MinSrcIPv4 = reader.readUInt32();
+	m_MaxSrcIPv4 = reader.readUInt32();
+	m_MinDstIPv4 = reader.readUInt32();
+	m_MaxDstIPv4 = reader.readUInt32();
+
+	const uint8_t* ipProtocols = reader.readBytes(sizeof(m_IPProtocols));
+	const uint8_t* vlanIds = reader.readBytes(sizeof(m_VlanIds));
+	const uint8_t* srcPorts = reader.readBytes(PortBitmapSize);
+	const uint8_t* dstPorts = reader.readBytes(PortBitmapSize);
+	uint32_t bloomFilterSize = reader.readUInt32();
+	if (bloomFilterSize == 0 || bloomFilterSize > reader.getRemainingBytes() / 2)
+		reader.setFailed();
+	const uint8_t* srcIPFilter = (reader.isValid() ? reader.readBytes(bloomFilterSize) : NULL);
+	const uint8_t* dstIPFilter = (reader.isValid() ? reader.readBytes(bloomFilterSize) : NULL);
+	if (m_NumOfNonIPPackets > m_NumOfPackets)
+		reader.setFailed();
+
+	if (!reader.isValid())
+	{
+		LOG_ERROR("The summary file '%s' is truncated or corrupted", summaryFileName.c_str());
+		clear();
+		return false;
+	}
+
+	memcpy(m_IPProtocols, ipProtocols, sizeof(m_IPProtocols));
+	memcpy(m_VlanIds, vlanIds, sizeof(m_VlanIds));
+	m_SrcPorts.assign(srcPorts, srcPorts + PortBitmapSize);
+	m_DstPorts.assign(dstPorts, dstPorts + PortBitmapSize);
+	m_SrcIPFilter.assign(srcIPFilter, srcIPFilter + bloomFilterSize);
+	m_DstIPFilter.assign(dstIPFilter, dstIPFilter + bloomFilterSize);
+	setFileVersion(fileSize, modificationTime);
+	return true;
+}
+
+bool PcapFileSummary::loadOrBuild(const std::string& fileName)
+{
+	std::string summaryFileName = getDefaultSummaryFileName(fileName);
+	if (load(summaryFileName, fileName))
+		return true;
+
+	if (!build(fileName))
+		return false;
+
+	// the summary is still usable if it can't be saved, for example when the file is in a read-only directory
+	if (!save(summaryFileName))
+		LOG_DEBUG("The summary of file '%s' is used without saving it", fileName.c_str());
+
+	return true;
+}
+
+std::string PcapFileSummary::getDefaultSummaryFileName(const std::string& fileName)
+{
+	return fileName + ".psum";
+}
+
+bool PcapFileSummary::getFileVersion(const std::string& fileName, uint64_t& fileSize, int64_t& modificationTime)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	struct _stat64 fileStat;
+	if (_stat64(fileName.c_str(), &fileStat) != 0)
+		return false;
+#else
+	struct stat fileStat;
+	if (stat(fileName.c_str(), &fileStat) != 0)
+		return false;
+#endif
+
+	fileSize = (uint64_t)fileStat.st_size;
+	modificationTime = (int64_t)fileStat.st_mtime;
+	return true;
+}
+
+void PcapFileSummary::setFileVersion(uint64_t fileSize, int64_t modificationTime)
+{
+	m_FileSize = fileSize;
+	m_ModificationTime = modificationTime;
+}
+
+bool PcapFileSummary::mayMatch(GeneralFilter& filter) const
+{
+	NativeFilterNode root;
+	if (!filter.toNativeFilter(root))
+		return m_NumOfPackets > 0;
+
+	return mayMatch(root);
+}
+
+bool PcapFileSummary::mayMatch(const NativeFilterNode& root) const
+{
+	return m_NumOfPackets > 0 && mayMatchNode(root);
+}
+
+bool PcapFileSummary::overlapsTimeRange(const timespec& from, const timespec& to) const
+{
+	return m_NumOfPackets > 0 && m_FirstTimestamp < toNanoseconds(to) && m_LastTimestamp >= toNanoseconds(from);
+}
+
+bool PcapFileSummary::mayContainIPAddress(const IPAddressValue& address, Direction direction) const
+{
+	if (!address.isValid())
+		return false;
+
+	if (direction != DST && getBloomFilterCount(m_SrcIPFilter, address) > 0)
+		return true;
+
+	return direction != SRC && getBloomFilterCount(m_DstIPFilter, address) > 0;
+}
+
+uint32_t PcapFileSummary::getMaxNumOfPackets(const IPAddressValue& address, Direction direction) const
+{
+	if (!address.isValid())
+		return 0;
+
+	uint32_t result = 0;
+	if (direction != DST)
+		result += getBloomFilterCount(m_SrcIPFilter, address);
+	if (direction != SRC)
+		result += getBloomFilterCount(m_DstIPFilter, address);
+
+	return result;
+}
+
+bool PcapFileSummary::containsPort(uint16_t fromPort, uint16_t toPort, Direction direction) const
+{
+	if (fromPort > toPort)
+		return false;
+
+	if (direction != DST && containsBitInRange(m_SrcPorts, fromPort, toPort))
+		return true;
+
+	return direction != SRC && containsBitInRange(m_DstPorts, fromPort, toPort);
+}
+
+timespec PcapFileSummary::getFirstTimestamp() const
+{
+	return toTimespec(m_NumOfPackets > 0 ? m_FirstTimestamp : 0);
+}
+
+timespec PcapFileSummary::getLastTimestamp() const
+{
+	return toTimespec(m_NumOfPackets > 0 ? m_LastTimestamp : 0);
+}
+
+void PcapFileSummary::getBloomFilterCounters(const uint8_t* address, size_t addressLen, size_t* counters) const
+{
+	// FNV-1a of the address, whose length tells IPv4 and IPv6 addresses apart, split into two halves for double hashing
+	uint64_t hash = 14695981039346656037ULL;
+	hash = (hash ^ addressLen) * 1099511628211ULL;
+	for (size_t i = 0; i < addressLen; i++)
+		hash = (hash ^ address[i]) * 1099511628211ULL;
+
+	uint32_t hash1 = (uint32_t)hash;
+	uint32_t hash2 = (uint32_t)(hash >> 32) | 1;
+	for (int i = 0; i < NumOfHashes; i++)
+		counters[i] = (size_t)((hash1 + (uint32_t)i * hash2) % m_SrcIPFilter.size());
+}
+
+void PcapFileSummary::addToBloomFilter(std::vector<uint8_t>& filter, const uint8_t* address, size_t addressLen)
+{
+	size_t counters[NumOfHashes];
+	getBloomFilterCounters(address, addressLen, counters);
+	for (int i = 0; i < NumOfHashes; i++)
+	{
+		// an address may map to the same counter more than once, which is counted once
+		if ((i == 1 && counters[1] == counters[0]) || (i == 2 && (counters[2] == counters[0] || counters[2] == counters[1])))
+			continue;
+
+		if (filter[counters[i]] < 255)
+			filter[counters[i]]++;
+	}
+}
+
+uint32_t PcapFileSummary::getBloomFilterCount(const std::vector<uint8_t>& filter, const IPAddressValue& address) const
+{
+	size_t counters[NumOfHashes];
+	getBloomFilterCounters(address.getBytes(), address.getLength(), counters);
+	uint32_t result = 255;
+	for (int i = 0; i < NumOfHashes; i++)
+		result = std::min(result, (uint32_t)filter[counters[i]]);
+
+	return result;
+}
+
+bool PcapFileSummary::mayMatchPredicate(const NativeFilterPredicate& predicate) const
+{
+	switch (predicate.type)
+	{
+	case NativeFilterProtocol:
+		return (m_ProtocolTypes & predicate.protocols) != 0;
+
+	case NativeFilterIPVersion:
+		if (predicate.value == 4)
+			return (m_ProtocolTypes & IPv4) != 0;
+		if (predicate.value == 6)
+			return (m_ProtocolTypes & IPv6) != 0;
+		return true;
+
+	case NativeFilterIPProtocol:
+		return predicate.value < 256 && containsIPProtocol((uint8_t)predicate.value);
+
+	case NativeFilterSrcIPv4:
+	case NativeFilterDstIPv4:
+	{
+		bool isSrc = (predicate.type == NativeFilterSrcIPv4);
+		if (predicate.mask == 0xffffffff)
+		{
+			IPAddressValue address = IPAddressValue::fromIPv4(predicate.value);
+			return mayContainIPAddress(address, isSrc ? SRC : DST);
+		}
+
+		// the addresses which match a masked address are between the address with all unmasked bits cleared and the address with all of
+		// them set
+		uint32_t mask = ntohl(predicate.mask);
+		uint32_t lowest = ntohl(predicate.value) & mask;
+		uint32_t highest = lowest | ~mask;
+		uint32_t minIP = (isSrc ? m_MinSrcIPv4 : m_MinDstIPv4);
+		uint32_t maxIP = (isSrc ? m_MaxSrcIPv4 : m_MaxDstIPv4);
+		return minIP <= maxIP && lowest <= maxIP && highest >= minIP;
+	}
+
+	case NativeFilterSrcPort:
+	case NativeFilterDstPort:
+		return predicate.value <= 0xffff && containsPort((uint16_t)predicate.value, (uint16_t)std::min<uint32_t>(predicate.upperValue, 0xffff),
+				predicate.type == NativeFilterSrcPort ? SRC : DST);
+
+	case NativeFilterVlanId:
+		return predicate.value < 4096 && containsVlanId((uint16_t)predicate.value);
+
+	case NativeFilterArpOpcode:
+		return m_NumOfNonIPPackets > 0;
+
+	default:
+		// the summary doesn't hold the fields of the other predicates
+		return true;
+	}
+}
+
+bool PcapFileSummary::mayMatchNode(const NativeFilterNode& node) const
+{
+	switch (node.type)
+	{
+	case NativeFilterNode::PredicateNode:
+		return mayMatchPredicate(node.predicate);
+
+	case NativeFilterNode::AndNode:
+		for (std::vector<NativeFilterNode>::const_iterator iter = node.children.begin(); iter != node.children.end(); iter++)
+		{
+			if (!mayMatchNode(*iter))
+				return false;
+		}
+		return true;
+
+	case NativeFilterNode::OrNode:
+		if (node.children.empty())
+			return true;
+		for (std::vector<NativeFilterNode>::const_iterator iter = node.children.begin(); iter != node.children.end(); iter++)
+		{
+			if (mayMatchNode(*iter))
+				return true;
+		}
+		return false;
+
+	default:
+		// the summary doesn't tell whether all packets match a filter, so the negation of any filter may match
+		return true;
+	}
+}
+
+} // namespace pcpp
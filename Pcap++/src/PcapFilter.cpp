@@ -1,61 +1,219 @@
 #define LOG_MODULE PcapLogModuleLiveDevice
 
 #include "PcapFilter.h"
+#include "NativeFilter.h"
 #include "Logger.h"
+#include "TimestampClock.h"
 #include "IPv4Layer.h"
+#include "EthLayer.h"
 #include <sstream>
+#include <stdlib.h>
 #if defined(WIN32) || defined(WINx64) //for using ntohl, ntohs, etc.
 #include <winsock2.h>
 #elif LINUX
 #include <in.h>
 #endif
 #include <pcap.h>
+#include <pthread.h>
 #include "RawPacket.h"
 
 namespace pcpp
 {
 
-GeneralFilter::GeneralFilter() : m_program(NULL)
+FilterFlowRule::FilterFlowRule()
+{
+	etherType = 0;
+	etherTypeMask = 0;
+	ipProtocol = 0;
+	ipProtocolMask = 0;
+	srcIPv4Address = 0;
+	srcIPv4Mask = 0;
+	dstIPv4Address = 0;
+	dstIPv4Mask = 0;
+	srcPort = 0;
+	srcPortMask = 0;
+	dstPort = 0;
+	dstPortMask = 0;
+}
+
+// merge one field of two rules: the bits both masks cover must be equal, and the merged field covers the bits of both masks
+template<typename T>
+static bool mergeFlowRuleField(T& value, T& mask, T otherValue, T otherMask)
+{
+	if (((value ^ otherValue) & mask & otherMask) != 0)
+		return false;
+
+	value = (T)((value & mask) | (otherValue & otherMask));
+	mask = (T)(mask | otherMask);
+	return true;
+}
+
+bool FilterFlowRule::mergeWith(const FilterFlowRule& other)
+{
+	FilterFlowRule merged = *this;
+	if (!mergeFlowRuleField(merged.etherType, merged.etherTypeMask, other.etherType, other.etherTypeMask) ||
+			!mergeFlowRuleField(merged.ipProtocol, merged.ipProtocolMask, other.ipProtocol, other.ipProtocolMask) ||
+			!mergeFlowRuleField(merged.srcIPv4Address, merged.srcIPv4Mask, other.srcIPv4Address, other.srcIPv4Mask) ||
+			!mergeFlowRuleField(merged.dstIPv4Address, merged.dstIPv4Mask, other.dstIPv4Address, other.dstIPv4Mask) ||
+			!mergeFlowRuleField(merged.srcPort, merged.srcPortMask, other.srcPort, other.srcPortMask) ||
+			!mergeFlowRuleField(merged.dstPort, merged.dstPortMask, other.dstPort, other.dstPortMask))
+		return false;
+
+	*this = merged;
+	return true;
+}
+
+bool FilterFlowRule::isMatchAll() const
+{
+	return etherTypeMask == 0 && ipProtocolMask == 0 && srcIPv4Mask == 0 && dstIPv4Mask == 0 && srcPortMask == 0 && dstPortMask == 0;
+}
+
+// older libpcap versions compile filters with a global parser, so compilation is serialized
+static pthread_mutex_t g_CompileMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool g_BpfJitEnabled = true;
+
+// every change of any filter takes the next version, so a filter which contains other filters is changed if the highest version among
+// them grew
+static uint32_t g_LastFilterVersion = 0;
+
+BpfFilterProgram::BpfFilterProgram() : m_Program(NULL), m_LinkType(LINKTYPE_ETHERNET)
 {}
 
-bool GeneralFilter::matchPacketWithFilter(RawPacket* rawPacket)
+BpfFilterProgram::~BpfFilterProgram()
 {
-	std::string filterStr;
-	parseToString(filterStr);
+	clear();
+}
+
+bool BpfFilterProgram::compile(const std::string& filterAsString, LinkLayerType linkType, int snapshotLength)
+{
+	clear();
 
-	if (m_program == NULL || m_lastProgramString != filterStr)
+	bpf_program* program = new bpf_program();
+	LOG_DEBUG("Compiling the filter '%s'", filterAsString.c_str());
+	pthread_mutex_lock(&g_CompileMutex);
+	int res = pcap_compile_nopcap(snapshotLength, linkType, program, filterAsString.c_str(), 1, 0);
+	pthread_mutex_unlock(&g_CompileMutex);
+	if (res < 0)
 	{
-		freeProgram();
+		delete program;
+		return false;
+	}
 
-		m_program = new bpf_program();
+	m_Program = program;
+	m_FilterString = filterAsString;
+	m_LinkType = linkType;
 
-		LOG_DEBUG("Compiling the filter '%s'", filterStr.c_str());
-		if (pcap_compile_nopcap(9000, pcpp::LINKTYPE_ETHERNET, m_program, filterStr.c_str(), 1, 0) < 0)
-		{
-			//Filter not valid so delete member
-			freeProgram();
-			return false;
-		}
-		m_lastProgramString = filterStr;
-	}
+	if (isJitEnabled() && !m_JitProgram.compile(m_Program))
+		LOG_DEBUG("Filter '%s' can't be translated into native code, matching it with the BPF interpreter", filterAsString.c_str());
+
+	return true;
+}
+
+void BpfFilterProgram::clear()
+{
+	if (m_Program == NULL)
+		return;
+
+	m_JitProgram.clear();
+	pcap_freecode(m_Program);
+	delete m_Program;
+	m_Program = NULL;
+	m_FilterString.clear();
+}
 
+void BpfFilterProgram::setJitEnabled(bool enabled)
+{
+	g_BpfJitEnabled = enabled;
+}
+
+bool BpfFilterProgram::isJitEnabled()
+{
+	return g_BpfJitEnabled && BpfJitProgram::isSupported();
+}
+
+bool BpfFilterProgram::matchPacket(const uint8_t* packetData, uint32_t capturedLength, uint32_t packetLength) const
+{
+	if (m_JitProgram.isCompiled())
+		return (m_JitProgram.run(packetData, capturedLength, packetLength) != 0);
+
+	if (m_Program == NULL)
+		return false;
+
+	// the timestamp isn't used by BPF programs
 	struct pcap_pkthdr pktHdr;
-	pktHdr.caplen = rawPacket->getRawDataLen();
-	pktHdr.len = rawPacket->getRawDataLen();
-	pktHdr.ts = rawPacket->getPacketTimeStamp();
+	pktHdr.caplen = capturedLength;
+	pktHdr.len = packetLength;
+	pktHdr.ts.tv_sec = 0;
+	pktHdr.ts.tv_usec = 0;
 
-	return (pcap_offline_filter(m_program, &pktHdr, rawPacket->getRawData()) != 0);
+	return (pcap_offline_filter(m_Program, &pktHdr, packetData) != 0);
 }
 
-void GeneralFilter::freeProgram()
+bool BpfFilterProgram::matchPacket(const RawPacket* rawPacket) const
+{
+	return matchPacket(rawPacket->getRawData(), (uint32_t)rawPacket->getRawDataLen(), (uint32_t)rawPacket->getRawDataLen());
+}
+
+GeneralFilter::GeneralFilter() : m_ProgramVersion(0)
+{
+	m_Version = ++g_LastFilterVersion;
+}
+
+bool GeneralFilter::toFlowRules(std::vector<FilterFlowRule>& rules)
+{
+	rules.clear();
+	return false;
+}
+
+bool GeneralFilter::toNativeFilter(NativeFilterNode& node)
 {
-	if (m_program)
+	node = NativeFilterNode();
+	return false;
+}
+
+void GeneralFilter::invalidateProgram()
+{
+	m_Version = ++g_LastFilterVersion;
+}
+
+bool GeneralFilter::updateProgram(LinkLayerType linkType)
+{
+	uint32_t version = getVersion();
+	if (m_Program.isCompiled() && m_ProgramVersion == version && m_Program.getLinkType() == linkType)
+		return true;
+
+	std::string filterStr;
+	parseToString(filterStr);
+	if (!m_Program.compile(filterStr, linkType))
 	{
-		pcap_freecode(m_program);
-		delete m_program;
-		m_program = NULL;
-		m_lastProgramString.clear();
+		m_ProgramVersion = 0;
+		return false;
 	}
+
+	m_ProgramVersion = version;
+	return true;
+}
+
+bool GeneralFilter::matchPacketWithFilter(RawPacket* rawPacket)
+{
+	if (!updateProgram(rawPacket->getLinkLayerType()))
+		return false;
+
+	return m_Program.matchPacket(rawPacket);
+}
+
+bool GeneralFilter::compile(BpfFilterProgram& program, LinkLayerType linkType, int snapshotLength)
+{
+	std::string filterStr;
+	parseToString(filterStr);
+	return program.compile(filterStr, linkType, snapshotLength);
+}
+
+void GeneralFilter::freeProgram()
+{
+	m_Program.clear();
+	m_ProgramVersion = 0;
 }
 
 GeneralFilter::~GeneralFilter()
@@ -80,22 +238,46 @@ void BPFStringFilter::parseToString(std::string& result)
 bool BPFStringFilter::verifyFilter()
 {
 	//If filter has been built before it must be valid
-	if (m_program)
+	if (m_Program.isCompiled())
 		return true;
 
-	m_program = new bpf_program();
-	LOG_DEBUG("Compiling the filter '%s'", m_filterStr.c_str());
-	if (pcap_compile_nopcap(9000, pcpp::LINKTYPE_ETHERNET, m_program, m_filterStr.c_str(), 1, 0) < 0)
-	{
-		//Filter not valid so delete member
-		freeProgram();
+	if (!m_Program.compile(m_filterStr))
 		return false;
-	}
-	m_lastProgramString = m_filterStr;
 
+	// the filter string never changes, so the program is valid until it's compiled for another link type
+	m_ProgramVersion = getVersion();
 	return true;
 }
 
+// translate a filter with a direction into its source predicate, its destination predicate, or both with logical "or" between them
+static void directionToNativeFilter(Direction dir, const NativeFilterPredicate& srcPredicate, NativeFilterPredicateType dstType,
+		NativeFilterNode& node)
+{
+	NativeFilterPredicate dstPredicate = srcPredicate;
+	dstPredicate.type = dstType;
+
+	if (dir == SRC)
+		node = NativeFilterNode(srcPredicate);
+	else if (dir == DST)
+		node = NativeFilterNode(dstPredicate);
+	else
+	{
+		node = NativeFilterNode(NativeFilterNode::OrNode);
+		node.children.push_back(NativeFilterNode(srcPredicate));
+		node.children.push_back(NativeFilterNode(dstPredicate));
+	}
+}
+
+// translate a filter which compares a header field into a predicate
+static void fieldToNativeFilter(NativeFilterPredicateType type, uint16_t offset, FilterOperator op, uint32_t value, NativeFilterNode& node)
+{
+	NativeFilterPredicate predicate(type);
+	predicate.offset = offset;
+	predicate.op = op;
+	predicate.value = value;
+	node = NativeFilterNode(predicate);
+}
+
 void IFilterWithDirection::parseDirection(std::string& directionAsString)
 {
 	switch (m_Dir)
@@ -232,6 +414,77 @@ void IPFilter::parseToString(std::string& result)
 	}
 }
 
+bool IPFilter::getIPv4AddressAndMask(uint32_t& ipAddress, uint32_t& mask)
+{
+	IPv4Address ipAddr(m_Address);
+	if (!ipAddr.isValid())
+		return false;
+
+	mask = 0xffffffff;
+	if (m_IPv4Mask != "")
+	{
+		IPv4Address maskAsAddr(m_IPv4Mask);
+		if (!maskAsAddr.isValid())
+			return false;
+		mask = maskAsAddr.toInt();
+	}
+	else if (m_Len > 0)
+	{
+		if (m_Len > 32)
+			return false;
+		mask = htonl(0xffffffff << (32 - m_Len));
+	}
+
+	ipAddress = ipAddr.toInt() & mask;
+	return true;
+}
+
+bool IPFilter::toFlowRules(std::vector<FilterFlowRule>& rules)
+{
+	rules.clear();
+
+	// flow rules match IPv4 addresses only
+	uint32_t ipAddr, mask;
+	if (!getIPv4AddressAndMask(ipAddr, mask))
+		return false;
+
+	FilterFlowRule rule;
+	rule.etherType = PCPP_ETHERTYPE_IP;
+	rule.etherTypeMask = 0xffff;
+
+	if (getDir() != DST)
+	{
+		FilterFlowRule srcRule = rule;
+		srcRule.srcIPv4Address = ipAddr;
+		srcRule.srcIPv4Mask = mask;
+		rules.push_back(srcRule);
+	}
+
+	if (getDir() != SRC)
+	{
+		FilterFlowRule dstRule = rule;
+		dstRule.dstIPv4Address = ipAddr;
+		dstRule.dstIPv4Mask = mask;
+		rules.push_back(dstRule);
+	}
+
+	return true;
+}
+
+bool IPFilter::toNativeFilter(NativeFilterNode& node)
+{
+	// like the BPF string, which starts with "ip", only IPv4 addresses are matched
+	uint32_t ipAddr, mask;
+	if (!getIPv4AddressAndMask(ipAddr, mask))
+		return false;
+
+	NativeFilterPredicate predicate(NativeFilterSrcIPv4);
+	predicate.value = ipAddr;
+	predicate.mask = mask;
+	directionToNativeFilter(getDir(), predicate, NativeFilterDstIPv4, node);
+	return true;
+}
+
 void IPv4IDFilter::parseToString(std::string& result)
 {
 	std::string op = parseOperator();
@@ -240,6 +493,12 @@ void IPv4IDFilter::parseToString(std::string& result)
 	result = "ip[4:2] " + op + " " + stream.str();
 }
 
+bool IPv4IDFilter::toNativeFilter(NativeFilterNode& node)
+{
+	fieldToNativeFilter(NativeFilterIPv4Field, 4, getOperator(), m_IpID, node);
+	return true;
+}
+
 void IPv4TotalLengthFilter::parseToString(std::string& result)
 {
 	std::string op = parseOperator();
@@ -248,6 +507,12 @@ void IPv4TotalLengthFilter::parseToString(std::string& result)
 	result = "ip[2:2] " + op + " " + stream.str();
 }
 
+bool IPv4TotalLengthFilter::toNativeFilter(NativeFilterNode& node)
+{
+	fieldToNativeFilter(NativeFilterIPv4Field, 2, getOperator(), m_TotalLength, node);
+	return true;
+}
+
 void PortFilter::portToString(uint16_t portAsInt)
 {
 	std::ostringstream stream;
@@ -267,6 +532,47 @@ void PortFilter::parseToString(std::string& result)
 	result = dir + " port " + m_Port;
 }
 
+bool PortFilter::toFlowRules(std::vector<FilterFlowRule>& rules)
+{
+	rules.clear();
+
+	// like BPF, match the port of TCP, UDP and SCTP
+	uint16_t port = (uint16_t)atoi(m_Port.c_str());
+	uint8_t protocols[] = { PACKETPP_IPPROTO_TCP, PACKETPP_IPPROTO_UDP, PACKETPP_IPPROTO_SCTP };
+	for (size_t i = 0; i < sizeof(protocols) / sizeof(protocols[0]); i++)
+	{
+		FilterFlowRule rule;
+		rule.ipProtocol = protocols[i];
+		rule.ipProtocolMask = 0xff;
+
+		if (getDir() != DST)
+		{
+			FilterFlowRule srcRule = rule;
+			srcRule.srcPort = port;
+			srcRule.srcPortMask = 0xffff;
+			rules.push_back(srcRule);
+		}
+
+		if (getDir() != SRC)
+		{
+			FilterFlowRule dstRule = rule;
+			dstRule.dstPort = port;
+			dstRule.dstPortMask = 0xffff;
+			rules.push_back(dstRule);
+		}
+	}
+
+	return true;
+}
+
+bool PortFilter::toNativeFilter(NativeFilterNode& node)
+{
+	NativeFilterPredicate predicate(NativeFilterSrcPort);
+	predicate.value = predicate.upperValue = (uint16_t)atoi(m_Port.c_str());
+	directionToNativeFilter(getDir(), predicate, NativeFilterDstPort, node);
+	return true;
+}
+
 void PortRangeFilter::parseToString(std::string& result)
 {
 	std::string dir;
@@ -280,6 +586,16 @@ void PortRangeFilter::parseToString(std::string& result)
 	result = dir + " portrange " + fromPortStream.str() + "-" + toPortStream.str();
 }
 
+bool PortRangeFilter::toNativeFilter(NativeFilterNode& node)
+{
+	// like libpcap, a range whose ends are reversed is matched from the lower end to the higher one
+	NativeFilterPredicate predicate(NativeFilterSrcPort);
+	predicate.value = (m_FromPort < m_ToPort ? m_FromPort : m_ToPort);
+	predicate.upperValue = (m_FromPort < m_ToPort ? m_ToPort : m_FromPort);
+	directionToNativeFilter(getDir(), predicate, NativeFilterDstPort, node);
+	return true;
+}
+
 void MacAddressFilter::parseToString(std::string& result)
 {
 	if (getDir() != SRC_OR_DST)
@@ -292,6 +608,14 @@ void MacAddressFilter::parseToString(std::string& result)
 		result = "ether host " + m_MacAddress.toString();
 }
 
+bool MacAddressFilter::toNativeFilter(NativeFilterNode& node)
+{
+	NativeFilterPredicate predicate(NativeFilterSrcMac);
+	m_MacAddress.copyTo(predicate.macAddress);
+	directionToNativeFilter(getDir(), predicate, NativeFilterDstMac, node);
+	return true;
+}
+
 void EtherTypeFilter::parseToString(std::string& result)
 {
 	std::ostringstream stream;
@@ -299,6 +623,25 @@ void EtherTypeFilter::parseToString(std::string& result)
 	result = "ether proto " + stream.str();
 }
 
+bool EtherTypeFilter::toFlowRules(std::vector<FilterFlowRule>& rules)
+{
+	rules.clear();
+
+	FilterFlowRule rule;
+	rule.etherType = m_EtherType;
+	rule.etherTypeMask = 0xffff;
+	rules.push_back(rule);
+	return true;
+}
+
+bool EtherTypeFilter::toNativeFilter(NativeFilterNode& node)
+{
+	NativeFilterPredicate predicate(NativeFilterEtherType);
+	predicate.value = m_EtherType;
+	node = NativeFilterNode(predicate);
+	return true;
+}
+
 AndFilter::AndFilter(std::vector<GeneralFilter*>& filters)
 {
 	for(std::vector<GeneralFilter*>::iterator it = filters.begin(); it != filters.end(); ++it)
@@ -315,6 +658,21 @@ void AndFilter::setFilters(std::vector<GeneralFilter*>& filters)
 	{
 		m_FilterList.push_back(*it);
 	}
+
+	invalidateProgram();
+}
+
+uint32_t AndFilter::getVersion() const
+{
+	uint32_t version = m_Version;
+	for(std::vector<GeneralFilter*>::const_iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		uint32_t innerVersion = (*it)->getVersion();
+		if (innerVersion > version)
+			version = innerVersion;
+	}
+
+	return version;
 }
 
 void AndFilter::parseToString(std::string& result)
@@ -332,6 +690,60 @@ void AndFilter::parseToString(std::string& result)
 	}
 }
 
+bool AndFilter::toFlowRules(std::vector<FilterFlowRule>& rules)
+{
+	// an empty filter matches all packets, and each inner filter narrows the rules matched so far by merging them with its own rules.
+	// Merged rules no packet can match are dropped
+	rules.clear();
+	rules.push_back(FilterFlowRule());
+
+	for(std::vector<GeneralFilter*>::iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		std::vector<FilterFlowRule> innerRules;
+		if (!(*it)->toFlowRules(innerRules))
+		{
+			rules.clear();
+			return false;
+		}
+
+		std::vector<FilterFlowRule> mergedRules;
+		for (std::vector<FilterFlowRule>::iterator rule = rules.begin(); rule != rules.end(); ++rule)
+		{
+			for (std::vector<FilterFlowRule>::iterator innerRule = innerRules.begin(); innerRule != innerRules.end(); ++innerRule)
+			{
+				FilterFlowRule mergedRule = *rule;
+				if (!mergedRule.mergeWith(*innerRule))
+					continue;
+
+				if (mergedRules.size() == PCPP_MAX_FILTER_FLOW_RULES)
+				{
+					rules.clear();
+					return false;
+				}
+
+				mergedRules.push_back(mergedRule);
+			}
+		}
+
+		rules.swap(mergedRules);
+	}
+
+	return true;
+}
+
+bool AndFilter::toNativeFilter(NativeFilterNode& node)
+{
+	node = NativeFilterNode(NativeFilterNode::AndNode);
+	for(std::vector<GeneralFilter*>::iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		node.children.push_back(NativeFilterNode());
+		if (!(*it)->toNativeFilter(node.children.back()))
+			return false;
+	}
+
+	return true;
+}
+
 OrFilter::OrFilter(std::vector<GeneralFilter*>& filters)
 {
 	for(std::vector<GeneralFilter*>::iterator it = filters.begin(); it != filters.end(); ++it)
@@ -340,6 +752,19 @@ OrFilter::OrFilter(std::vector<GeneralFilter*>& filters)
 	}
 }
 
+uint32_t OrFilter::getVersion() const
+{
+	uint32_t version = m_Version;
+	for(std::vector<GeneralFilter*>::const_iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		uint32_t innerVersion = (*it)->getVersion();
+		if (innerVersion > version)
+			version = innerVersion;
+	}
+
+	return version;
+}
+
 void OrFilter::parseToString(std::string& result)
 {
 	result = "";
@@ -355,6 +780,45 @@ void OrFilter::parseToString(std::string& result)
 	}
 }
 
+bool OrFilter::toFlowRules(std::vector<FilterFlowRule>& rules)
+{
+	rules.clear();
+
+	// an empty filter matches all packets
+	if (m_FilterList.empty())
+	{
+		rules.push_back(FilterFlowRule());
+		return true;
+	}
+
+	for(std::vector<GeneralFilter*>::iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		std::vector<FilterFlowRule> innerRules;
+		if (!(*it)->toFlowRules(innerRules) || rules.size() + innerRules.size() > PCPP_MAX_FILTER_FLOW_RULES)
+		{
+			rules.clear();
+			return false;
+		}
+
+		rules.insert(rules.end(), innerRules.begin(), innerRules.end());
+	}
+
+	return true;
+}
+
+bool OrFilter::toNativeFilter(NativeFilterNode& node)
+{
+	node = NativeFilterNode(NativeFilterNode::OrNode);
+	for(std::vector<GeneralFilter*>::iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		node.children.push_back(NativeFilterNode());
+		if (!(*it)->toNativeFilter(node.children.back()))
+			return false;
+	}
+
+	return true;
+}
+
 void NotFilter::parseToString(std::string& result)
 {
 	std::string innerFilterAsString;
@@ -362,6 +826,22 @@ void NotFilter::parseToString(std::string& result)
 	result = "not (" + innerFilterAsString + ")";
 }
 
+bool NotFilter::toNativeFilter(NativeFilterNode& node)
+{
+	if (m_FilterToInverse == NULL)
+		return false;
+
+	node = NativeFilterNode(NativeFilterNode::NotNode);
+	node.children.push_back(NativeFilterNode());
+	return m_FilterToInverse->toNativeFilter(node.children.back());
+}
+
+uint32_t NotFilter::getVersion() const
+{
+	uint32_t innerVersion = m_FilterToInverse->getVersion();
+	return (innerVersion > m_Version ? innerVersion : m_Version);
+}
+
 void ProtoFilter::parseToString(std::string& result)
 {
 	result = "";
@@ -406,6 +886,110 @@ void ProtoFilter::parseToString(std::string& result)
 	}
 }
 
+bool ProtoFilter::toFlowRules(std::vector<FilterFlowRule>& rules)
+{
+	rules.clear();
+
+	// the rules match what the BPF keywords parseToString() produces match: "icmp" is IPv4 only while "tcp", "udp" and "proto" match
+	// both IPv4 and IPv6
+	FilterFlowRule rule;
+	switch (m_Proto)
+	{
+	case TCP:
+		rule.ipProtocol = PACKETPP_IPPROTO_TCP;
+		break;
+	case UDP:
+		rule.ipProtocol = PACKETPP_IPPROTO_UDP;
+		break;
+	case ICMP:
+		rule.etherType = PCPP_ETHERTYPE_IP;
+		rule.ipProtocol = PACKETPP_IPPROTO_ICMP;
+		break;
+	case GRE:
+		rule.ipProtocol = PACKETPP_IPPROTO_GRE;
+		break;
+	case IGMP:
+		rule.ipProtocol = PACKETPP_IPPROTO_IGMP;
+		break;
+	case IPv4:
+		rule.etherType = PCPP_ETHERTYPE_IP;
+		break;
+	case IPv6:
+		rule.etherType = PCPP_ETHERTYPE_IPV6;
+		break;
+	case ARP:
+		rule.etherType = PCPP_ETHERTYPE_ARP;
+		break;
+	case Ethernet:
+		break;
+	default:
+		// VLAN tags shift the headers after them, which flow rules can't follow
+		return false;
+	}
+
+	if (rule.etherType != 0)
+		rule.etherTypeMask = 0xffff;
+	if (rule.ipProtocol != 0)
+		rule.ipProtocolMask = 0xff;
+
+	rules.push_back(rule);
+	return true;
+}
+
+bool ProtoFilter::toNativeFilter(NativeFilterNode& node)
+{
+	// like the BPF keywords parseToString() produces, "icmp" matches IPv4 only while "tcp", "udp" and "proto" match both IPv4 and
+	// IPv6
+	NativeFilterPredicate predicate(NativeFilterIPProtocol);
+	switch (m_Proto)
+	{
+	case TCP:
+		predicate.value = PACKETPP_IPPROTO_TCP;
+		break;
+	case UDP:
+		predicate.value = PACKETPP_IPPROTO_UDP;
+		break;
+	case GRE:
+		predicate.value = PACKETPP_IPPROTO_GRE;
+		break;
+	case IGMP:
+		predicate.value = PACKETPP_IPPROTO_IGMP;
+		break;
+	case ICMP:
+	{
+		NativeFilterPredicate ipVersionPredicate(NativeFilterIPVersion);
+		ipVersionPredicate.value = 4;
+		predicate.value = PACKETPP_IPPROTO_ICMP;
+		node = NativeFilterNode(NativeFilterNode::AndNode);
+		node.children.push_back(NativeFilterNode(ipVersionPredicate));
+		node.children.push_back(NativeFilterNode(predicate));
+		return true;
+	}
+	case IPv4:
+		predicate.type = NativeFilterIPVersion;
+		predicate.value = 4;
+		break;
+	case IPv6:
+		predicate.type = NativeFilterIPVersion;
+		predicate.value = 6;
+		break;
+	case ARP:
+		predicate.type = NativeFilterEtherType;
+		predicate.value = PCPP_ETHERTYPE_ARP;
+		break;
+	case VLAN:
+	case Ethernet:
+		predicate.type = NativeFilterProtocol;
+		predicate.protocols = m_Proto;
+		break;
+	default:
+		return false;
+	}
+
+	node = NativeFilterNode(predicate);
+	return true;
+}
+
 void ArpFilter::parseToString(std::string& result)
 {
 	std::ostringstream sstream;
@@ -413,6 +997,14 @@ void ArpFilter::parseToString(std::string& result)
 	result += sstream.str();
 }
 
+bool ArpFilter::toNativeFilter(NativeFilterNode& node)
+{
+	NativeFilterPredicate predicate(NativeFilterArpOpcode);
+	predicate.value = m_OpCode;
+	node = NativeFilterNode(predicate);
+	return true;
+}
+
 void VlanFilter::parseToString(std::string& result)
 {
 	std::ostringstream stream;
@@ -420,6 +1012,14 @@ void VlanFilter::parseToString(std::string& result)
 	result = "vlan " + stream.str();
 }
 
+bool VlanFilter::toNativeFilter(NativeFilterNode& node)
+{
+	NativeFilterPredicate predicate(NativeFilterVlanId);
+	predicate.value = m_VlanID;
+	node = NativeFilterNode(predicate);
+	return true;
+}
+
 void TcpFlagsFilter::parseToString(std::string& result)
 {
 	result = "";
@@ -454,6 +1054,32 @@ void TcpFlagsFilter::parseToString(std::string& result)
 	}
 }
 
+bool TcpFlagsFilter::toNativeFilter(NativeFilterNode& node)
+{
+	// like the empty BPF string parseToString() produces, a filter without flags matches all packets
+	if (m_TcpFlagsBitMask == 0)
+	{
+		node = NativeFilterNode();
+		return true;
+	}
+
+	NativeFilterPredicate predicate(NativeFilterTcpFlags);
+	predicate.mask = m_TcpFlagsBitMask;
+	if (m_MatchOption == MatchOneAtLeast)
+	{
+		predicate.op = NOT_EQUALS;
+		predicate.value = 0;
+	}
+	else //m_MatchOption == MatchAll
+	{
+		predicate.op = EQUALS;
+		predicate.value = m_TcpFlagsBitMask;
+	}
+
+	node = NativeFilterNode(predicate);
+	return true;
+}
+
 void TcpWindowSizeFilter::parseToString(std::string& result)
 {
 	std::ostringstream stream;
@@ -461,6 +1087,12 @@ void TcpWindowSizeFilter::parseToString(std::string& result)
 	result = "tcp[14:2] " + parseOperator() + " " + stream.str();
 }
 
+bool TcpWindowSizeFilter::toNativeFilter(NativeFilterNode& node)
+{
+	fieldToNativeFilter(NativeFilterTcpField, 14, getOperator(), m_WindowSize, node);
+	return true;
+}
+
 void UdpLengthFilter::parseToString(std::string& result)
 {
 	std::ostringstream stream;
@@ -468,4 +1100,175 @@ void UdpLengthFilter::parseToString(std::string& result)
 	result = "udp[4:2] " + parseOperator() + " " + stream.str();
 }
 
+bool UdpLengthFilter::toNativeFilter(NativeFilterNode& node)
+{
+	fieldToNativeFilter(NativeFilterUdpField, 4, getOperator(), m_Length, node);
+	return true;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// BpfFilterProfile
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+BpfFilterProfile::BpfFilterProfile(uint32_t sampleRate)
+{
+	m_SampleRate = (sampleRate > 0 ? sampleRate : 1);
+	m_SampleCountdown = 1;
+}
+
+BpfFilterProfile::~BpfFilterProfile()
+{
+	clear();
+}
+
+bool BpfFilterProfile::compile(GeneralFilter& filter, LinkLayerType linkType, int snapshotLength)
+{
+	clear();
+
+	if (!addNode(&filter, -1, linkType, snapshotLength))
+	{
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool BpfFilterProfile::addNode(GeneralFilter* filter, int parent, LinkLayerType linkType, int snapshotLength)
+{
+	if (filter == NULL)
+	{
+		LOG_ERROR("Cannot profile a filter which contains a NULL filter");
+		return false;
+	}
+
+	size_t nodeIndex = m_Nodes.size();
+	m_Nodes.push_back(Node());
+	m_Nodes[nodeIndex].type = LeafNode;
+	m_Nodes[nodeIndex].parent = parent;
+	m_Nodes[nodeIndex].program = NULL;
+	filter->parseToString(m_Nodes[nodeIndex].filterString);
+	if (parent >= 0)
+		m_Nodes[parent].children.push_back(nodeIndex);
+
+	std::vector<GeneralFilter*> children;
+	if (AndFilter* andFilter = dynamic_cast<AndFilter*>(filter))
+	{
+		m_Nodes[nodeIndex].type = AndNode;
+		children = andFilter->getFilters();
+	}
+	else if (OrFilter* orFilter = dynamic_cast<OrFilter*>(filter))
+	{
+		m_Nodes[nodeIndex].type = OrNode;
+		children = orFilter->getFilters();
+	}
+	else if (NotFilter* notFilter = dynamic_cast<NotFilter*>(filter))
+	{
+		m_Nodes[nodeIndex].type = NotNode;
+		children.push_back(notFilter->getFilter());
+	}
+
+	if (m_Nodes[nodeIndex].type != LeafNode)
+	{
+		for (std::vector<GeneralFilter*>::iterator iter = children.begin(); iter != children.end(); iter++)
+		{
+			if (!addNode(*iter, (int)nodeIndex, linkType, snapshotLength))
+				return false;
+		}
+
+		return true;
+	}
+
+	BpfFilterProgram* program = new BpfFilterProgram();
+	m_Nodes[nodeIndex].program = program;
+	if (!program->compile(m_Nodes[nodeIndex].filterString, linkType, snapshotLength))
+	{
+		LOG_ERROR("Cannot compile the profiled filter '%s'", m_Nodes[nodeIndex].filterString.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+void BpfFilterProfile::clear()
+{
+	for (std::vector<Node>::iterator iter = m_Nodes.begin(); iter != m_Nodes.end(); iter++)
+		delete iter->program;
+
+	m_Nodes.clear();
+	m_SampleCountdown = 1;
+}
+
+void BpfFilterProfile::resetStats()
+{
+	for (std::vector<Node>::iterator iter = m_Nodes.begin(); iter != m_Nodes.end(); iter++)
+		iter->stats = FilterNodeStats();
+
+	m_SampleCountdown = 1;
+}
+
+bool BpfFilterProfile::evaluateNode(size_t nodeIndex, const uint8_t* packetData, uint32_t capturedLength, uint32_t packetLength, bool sample)
+{
+	Node& node = m_Nodes[nodeIndex];
+	uint64_t startCycles = (sample ? TimestampClock::readCycleCounter() : 0);
+
+	bool result;
+	switch (node.type)
+	{
+	case LeafNode:
+		result = node.program->matchPacket(packetData, capturedLength, packetLength);
+		break;
+
+	case NotNode:
+		result = !evaluateNode(node.children.front(), packetData, capturedLength, packetLength, sample);
+		break;
+
+	default:
+	{
+		// like the BPF string of an empty AndFilter or OrFilter, a node without children matches all packets. Otherwise the children are
+		// evaluated until one decides the result
+		bool andNode = (node.type == AndNode);
+		result = true;
+		for (size_t i = 0; i < node.children.size(); i++)
+		{
+			result = evaluateNode(node.children[i], packetData, capturedLength, packetLength, sample);
+			if (result != andNode)
+				break;
+		}
+		break;
+	}
+	}
+
+	// evaluating the children doesn't add nodes, so the reference is still valid
+	if (sample)
+	{
+		node.stats.cycles += TimestampClock::readCycleCounter() - startCycles;
+		node.stats.sampled++;
+	}
+
+	node.stats.evaluated++;
+	if (result)
+		node.stats.matched++;
+
+	return result;
+}
+
+bool BpfFilterProfile::matchPacket(const uint8_t* packetData, uint32_t capturedLength, uint32_t packetLength)
+{
+	if (m_Nodes.empty())
+		return false;
+
+	bool sample = (--m_SampleCountdown == 0);
+	if (sample)
+		m_SampleCountdown = m_SampleRate;
+
+	return evaluateNode(0, packetData, capturedLength, packetLength, sample);
+}
+
+bool BpfFilterProfile::matchPacket(const RawPacket* rawPacket)
+{
+	return matchPacket(rawPacket->getRawData(), (uint32_t)rawPacket->getRawDataLen(), (uint32_t)rawPacket->getRawDataLen());
+}
+
 } // namespace pcpp
@@ -0,0 +1,553 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include "PcapFlowIndex.h"
+#include "PacketView.h"
+#include "StateCheckpoint.h"
+#include "Logger.h"
+#include <string.h>
+#include <map>
+
+namespace pcpp
+{
+
+// the length of the header of a sidecar file up to its interfaces, and of each interface
+static const size_t IndexFileHeaderLen = 4 + 2 + 8 + 1 + 4;
+static const size_t IndexFileInterfaceLen = 2 + 4 + 8 + 1;
+// the number of directory entries read at once when all of them are read
+static const uint64_t DirectoryEntriesPerRead = 1024;
+
+static bool seekFile(FILE* file, uint64_t offset)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool readFileSize(FILE* file, uint64_t& fileSize)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	if (_fseeki64(file, 0, SEEK_END) != 0)
+		return false;
+	__int64 size = _ftelli64(file);
+#else
+	if (fseeko(file, 0, SEEK_END) != 0)
+		return false;
+	off_t size = ftello(file);
+#endif
+	if (size < 0)
+		return false;
+
+	fileSize = (uint64_t)size;
+	return seekFile(file, 0);
+}
+
+// order the endpoints of a tuple so both directions of a flow get the same key
+static void normalizeTuple(FlowTuple& tuple)
+{
+	int cmp = memcmp(tuple.srcIP, tuple.dstIP, sizeof(tuple.srcIP));
+	if (cmp < 0 || (cmp == 0 && tuple.srcPort <= tuple.dstPort))
+		return;
+
+	uint8_t ip[16];
+	memcpy(ip, tuple.srcIP, sizeof(ip));
+	memcpy(tuple.srcIP, tuple.dstIP, sizeof(ip));
+	memcpy(tuple.dstIP, ip, sizeof(ip));
+	uint16_t port = tuple.srcPort;
+	tuple.srcPort = tuple.dstPort;
+	tuple.dstPort = port;
+}
+
+// unsigned LEB128: 7 bits per byte, the high bit marks that more bytes follow
+static void writeVarInt(std::vector<uint8_t>& buffer, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		buffer.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back((uint8_t)value);
+}
+
+static bool readVarInt(const uint8_t* data, size_t dataLen, size_t& offset, uint64_t& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64 && offset < dataLen; shift += 7)
+	{
+		uint8_t byte = data[offset++];
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+namespace
+{
+
+// a flow key packed in the byte order of the directory
+struct PackedFlowKey
+{
+	uint8_t bytes[38];
+
+	bool operator<(const PackedFlowKey& other) const { return memcmp(bytes, other.bytes, sizeof(bytes)) < 0; }
+};
+
+// the packets of a flow collected while the index is built
+struct FlowRun
+{
+	uint64_t numOfPackets;
+	uint64_t lastOffset;
+	std::vector<uint8_t> run;
+
+	FlowRun() : numOfPackets(0), lastOffset(0) {}
+};
+
+} // namespace
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~
+// PcapFlowIndex members
+// ~~~~~~~~~~~~~~~~~~~~~~
+
+PcapFlowIndex::PcapFlowIndex()
+{
+	m_PacketReader = NULL;
+	m_IndexFile = NULL;
+	m_NumOfFlows = 0;
+	m_DirectoryOffset = 0;
+}
+
+PcapFlowIndex::~PcapFlowIndex()
+{
+	close();
+}
+
+std::string PcapFlowIndex::getDefaultIndexFileName(const std::string& fileName)
+{
+	return fileName + ".fidx";
+}
+
+void PcapFlowIndex::packKey(const FlowTuple& tuple, uint8_t* key)
+{
+	// ports are written in network byte order so the byte order of keys is the order of their fields
+	memcpy(key, tuple.srcIP, 16);
+	memcpy(key + 16, tuple.dstIP, 16);
+	key[32] = (uint8_t)(tuple.srcPort >> 8);
+	key[33] = (uint8_t)(tuple.srcPort & 0xFF);
+	key[34] = (uint8_t)(tuple.dstPort >> 8);
+	key[35] = (uint8_t)(tuple.dstPort & 0xFF);
+	key[36] = tuple.protocol;
+	key[37] = tuple.ipVersion;
+}
+
+void PcapFlowIndex::unpackKey(const uint8_t* key, FlowTuple& tuple)
+{
+	memcpy(tuple.srcIP, key, 16);
+	memcpy(tuple.dstIP, key + 16, 16);
+	tuple.srcPort = (uint16_t)((key[32] << 8) | key[33]);
+	tuple.dstPort = (uint16_t)((key[34] << 8) | key[35]);
+	tuple.protocol = key[36];
+	tuple.ipVersion = key[37];
+}
+
+bool PcapFlowIndex::build(const PcapFileIndex& fileIndex, const std::string& flowIndexFileName)
+{
+	PcapFileIndex::PacketReader packetReader(fileIndex);
+	if (!packetReader.open())
+		return false;
+
+	// the runs hold the distance of every packet from the previous packet of the flow, followed by its interface for pcap-ng files
+	std::map<PackedFlowKey, FlowRun> flows;
+	RawPacket rawPacket;
+	PacketView view;
+	FlowTuple tuple;
+	PackedFlowKey key;
+	for (uint64_t i = 0; i < fileIndex.getNumOfPackets(); i++)
+	{
+		if (!packetReader.readPacket(i, rawPacket))
+			return false;
+
+		if (!FlowKeyExtractor::extract(&rawPacket, view) || !FlowHash::getTuple(view, tuple))
+			continue;
+
+		normalizeTuple(tuple);
+		packKey(tuple, key.bytes);
+		FlowRun& flow = flows[key];
+		uint64_t offset = fileIndex.getPacketOffset(i);
+		writeVarInt(flow.run, offset - flow.lastOffset);
+		if (fileIndex.isPcapNg())
+			writeVarInt(flow.run, fileIndex.getPacketInterface(i));
+		flow.lastOffset = offset;
+		flow.numOfPackets++;
+	}
+
+	packetReader.close();
+
+	std::vector<uint8_t> header;
+	CheckpointWriter headerWriter(header);
+	headerWriter.writeUInt32(IndexFileMagic);
+	headerWriter.writeUInt16(IndexFileVersion);
+	headerWriter.writeUInt64(fileIndex.m_FileSize);
+	headerWriter.writeUInt8(fileIndex.m_IsPcapNg ? 1 : 0);
+	headerWriter.writeUInt32((uint32_t)fileIndex.m_Interfaces.size());
+	for (std::vector<PcapFileIndex::InterfaceInfo>::const_iterator iter = fileIndex.m_Interfaces.begin(); iter != fileIndex.m_Interfaces.end(); iter++)
+	{
+		headerWriter.writeUInt16(iter->linkType);
+		headerWriter.writeUInt32(iter->snapLen);
+		headerWriter.writeUInt64(iter->tsUnitsPerSec);
+		headerWriter.writeUInt8(iter->swapBytes ? 1 : 0);
+	}
+
+	uint64_t runsLength = 0;
+	for (std::map<PackedFlowKey, FlowRun>::const_iterator iter = flows.begin(); iter != flows.end(); iter++)
+		runsLength += iter->second.run.size();
+
+	headerWriter.writeUInt64(flows.size());
+	headerWriter.writeUInt64(header.size() + 8 + runsLength);
+
+	FILE* file = fopen(flowIndexFileName.c_str(), "wb");
+	if (file == NULL)
+	{
+		LOG_ERROR("Cannot open the flow index file '%s' for writing", flowIndexFileName.c_str());
+		return false;
+	}
+
+	bool result = (fwrite(&header[0], 1, header.size(), file) == header.size());
+	for (std::map<PackedFlowKey, FlowRun>::const_iterator iter = flows.begin(); result && iter != flows.end(); iter++)
+		result = (fwrite(&iter->second.run[0], 1, iter->second.run.size(), file) == iter->second.run.size());
+
+	// the map is ordered by key, so the directory is written sorted
+	std::vector<uint8_t> directory;
+	CheckpointWriter directoryWriter(directory);
+	uint64_t runOffset = header.size();
+	for (std::map<PackedFlowKey, FlowRun>::const_iterator iter = flows.begin(); result && iter != flows.end(); iter++)
+	{
+		directoryWriter.writeBytes(iter->first.bytes, KeyLength);
+		directoryWriter.writeUInt64(iter->second.numOfPackets);
+		directoryWriter.writeUInt64(runOffset);
+		directoryWriter.writeUInt32((uint32_t)iter->second.run.size());
+		runOffset += iter->second.run.size();
+
+		if (directory.size() >= DirectoryEntriesPerRead * DirectoryEntryLength)
+		{
+			result = (fwrite(&directory[0], 1, directory.size(), file) == directory.size());
+			directory.clear();
+		}
+	}
+
+	if (result && !directory.empty())
+		result = (fwrite(&directory[0], 1, directory.size(), file) == directory.size());
+
+	if (fclose(file) != 0)
+		result = false;
+
+	if (!result)
+	{
+		LOG_ERROR("Cannot write the flow index file '%s'", flowIndexFileName.c_str());
+		remove(flowIndexFileName.c_str());
+		return false;
+	}
+
+	LOG_DEBUG("Indexed %llu flows of file '%s'", (unsigned long long)flows.size(), fileIndex.getFileName().c_str());
+	return true;
+}
+
+bool PcapFlowIndex::open(const std::string& flowIndexFileName, const std::string& fileName)
+{
+	close();
+
+	FILE* file = fopen(fileName.c_str(), "rb");
+	uint64_t fileSize = 0;
+	bool gotFileSize = (file != NULL && readFileSize(file, fileSize));
+	if (file != NULL)
+		fclose(file);
+	if (!gotFileSize)
+	{
+		LOG_ERROR("Cannot read the size of file '%s'", fileName.c_str());
+		return false;
+	}
+
+	FILE* indexFile = fopen(flowIndexFileName.c_str(), "rb");
+	uint64_t indexFileSize = 0;
+	if (indexFile == NULL || !readFileSize(indexFile, indexFileSize))
+	{
+		LOG_DEBUG("Cannot read the flow index file '%s'", flowIndexFileName.c_str());
+		if (indexFile != NULL)
+			fclose(indexFile);
+		return false;
+	}
+
+	uint8_t header[IndexFileHeaderLen];
+	bool result = (fread(header, 1, sizeof(header), indexFile) == sizeof(header));
+	CheckpointReader reader(header, sizeof(header));
+	uint32_t magic = reader.readUInt32();
+	uint16_t version = reader.readUInt16();
+	uint64_t indexedFileSize = reader.readUInt64();
+	uint8_t isPcapNg = reader.readUInt8();
+	uint32_t numOfInterfaces = reader.readUInt32();
+	if (!result || magic != IndexFileMagic || version != IndexFileVersion || isPcapNg > 1)
+	{
+		LOG_ERROR("'%s' isn't a flow index file of a supported version", flowIndexFileName.c_str());
+		fclose(indexFile);
+		return false;
+	}
+
+	if (indexedFileSize != fileSize)
+	{
+		LOG_DEBUG("The flow index file '%s' was built for another version of file '%s'", flowIndexFileName.c_str(), fileName.c_str());
+		fclose(indexFile);
+		return false;
+	}
+
+	// the interfaces and the flow count and directory offset which follow them
+	std::vector<uint8_t> rest;
+	if (numOfInterfaces == 0 || numOfInterfaces > indexFileSize / IndexFileInterfaceLen)
+		result = false;
+	else
+	{
+		rest.resize(numOfInterfaces * IndexFileInterfaceLen + 16);
+		result = (fread(&rest[0], 1, rest.size(), indexFile) == rest.size());
+	}
+
+	std::vector<PcapFileIndex::InterfaceInfo> interfaces;
+	CheckpointReader restReader(rest.empty() ? NULL : &rest[0], rest.size());
+	for (uint32_t i = 0; result && i < numOfInterfaces; i++)
+	{
+		PcapFileIndex::InterfaceInfo interface;
+		interface.linkType = restReader.readUInt16();
+		interface.snapLen = restReader.readUInt32();
+		interface.tsUnitsPerSec = restReader.readUInt64();
+		uint8_t swapBytes = restReader.readUInt8();
+		interface.swapBytes = (swapBytes != 0);
+		if (interface.tsUnitsPerSec == 0 || swapBytes > 1)
+			result = false;
+		interfaces.push_back(interface);
+	}
+
+	uint64_t numOfFlows = restReader.readUInt64();
+	uint64_t directoryOffset = restReader.readUInt64();
+	uint64_t headerLen = IndexFileHeaderLen + rest.size();
+	// the directory takes the end of the file
+	if (!restReader.isValid() || directoryOffset < headerLen || directoryOffset > indexFileSize ||
+			(indexFileSize - directoryOffset) / DirectoryEntryLength != numOfFlows || (indexFileSize - directoryOffset) % DirectoryEntryLength != 0)
+		result = false;
+
+	if (!result)
+	{
+		LOG_ERROR("The flow index file '%s' is truncated or corrupted", flowIndexFileName.c_str());
+		fclose(indexFile);
+		return false;
+	}
+
+	m_FileInfo.clear();
+	m_FileInfo.m_FileName = fileName;
+	m_FileInfo.m_FileSize = fileSize;
+	m_FileInfo.m_IsPcapNg = (isPcapNg != 0);
+	m_FileInfo.m_Interfaces = interfaces;
+	m_PacketReader = new PcapFileIndex::PacketReader(m_FileInfo);
+	m_IndexFile = indexFile;
+	m_NumOfFlows = numOfFlows;
+	m_DirectoryOffset = directoryOffset;
+	return true;
+}
+
+bool PcapFlowIndex::openOrBuild(const std::string& fileName)
+{
+	std::string flowIndexFileName = getDefaultIndexFileName(fileName);
+	if (open(flowIndexFileName, fileName))
+		return true;
+
+	PcapFileIndex fileIndex;
+	if (!fileIndex.loadOrBuild(fileName) || !build(fileIndex, flowIndexFileName))
+		return false;
+
+	return open(flowIndexFileName, fileName);
+}
+
+void PcapFlowIndex::close()
+{
+	if (m_PacketReader != NULL)
+	{
+		delete m_PacketReader;
+		m_PacketReader = NULL;
+	}
+
+	if (m_IndexFile != NULL)
+	{
+		fclose(m_IndexFile);
+		m_IndexFile = NULL;
+	}
+
+	m_FileInfo.clear();
+	m_NumOfFlows = 0;
+	m_DirectoryOffset = 0;
+}
+
+bool PcapFlowIndex::readDirectoryEntry(uint64_t entryNumber, uint8_t* entry)
+{
+	if (!seekFile(m_IndexFile, m_DirectoryOffset + entryNumber * DirectoryEntryLength) ||
+			fread(entry, 1, DirectoryEntryLength, m_IndexFile) != DirectoryEntryLength)
+	{
+		LOG_ERROR("Cannot read the directory of the flow index of file '%s'", m_FileInfo.getFileName().c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool PcapFlowIndex::findFlowEntries(const FlowTuple& tuple, std::vector<uint64_t>& packetOffsets, std::vector<uint32_t>& packetInterfaces)
+{
+	packetOffsets.clear();
+	packetInterfaces.clear();
+	if (m_IndexFile == NULL)
+	{
+		LOG_ERROR("Flow index not opened");
+		return false;
+	}
+
+	FlowTuple normalizedTuple = tuple;
+	normalizeTuple(normalizedTuple);
+	uint8_t key[KeyLength];
+	packKey(normalizedTuple, key);
+
+	// binary search of the directory on disk
+	uint8_t entry[DirectoryEntryLength];
+	uint64_t low = 0;
+	uint64_t high = m_NumOfFlows;
+	bool found = false;
+	while (low < high)
+	{
+		uint64_t middle = low + (high - low) / 2;
+		if (!readDirectoryEntry(middle, entry))
+			return false;
+
+		int cmp = memcmp(entry, key, KeyLength);
+		if (cmp == 0)
+		{
+			found = true;
+			break;
+		}
+
+		if (cmp < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	if (!found)
+		return true;
+
+	CheckpointReader entryReader(entry + KeyLength, DirectoryEntryLength - KeyLength);
+	uint64_t numOfPackets = entryReader.readUInt64();
+	uint64_t runOffset = entryReader.readUInt64();
+	uint32_t runLength = entryReader.readUInt32();
+	// every packet takes at least one byte of its run
+	bool result = (numOfPackets <= runLength && runOffset + runLength <= m_DirectoryOffset);
+	if (result)
+	{
+		m_Buffer.resize(runLength);
+		result = (runLength == 0 || (seekFile(m_IndexFile, runOffset) && fread(&m_Buffer[0], 1, runLength, m_IndexFile) == runLength));
+	}
+
+	size_t position = 0;
+	uint64_t offset = 0;
+	const uint8_t* run = (runLength > 0 ? &m_Buffer[0] : NULL);
+	packetOffsets.reserve((size_t)numOfPackets);
+	for (uint64_t i = 0; result && i < numOfPackets; i++)
+	{
+		uint64_t delta = 0;
+		uint64_t interfaceIndex = 0;
+		result = readVarInt(run, runLength, position, delta) && (i == 0 || delta > 0);
+		if (result && m_FileInfo.isPcapNg())
+			result = readVarInt(run, runLength, position, interfaceIndex) && interfaceIndex < m_FileInfo.m_Interfaces.size();
+
+		offset += delta;
+		packetOffsets.push_back(offset);
+		packetInterfaces.push_back((uint32_t)interfaceIndex);
+	}
+
+	if (!result || position != runLength)
+	{
+		LOG_ERROR("The flow index of file '%s' is corrupted", m_FileInfo.getFileName().c_str());
+		packetOffsets.clear();
+		packetInterfaces.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool PcapFlowIndex::findFlow(const FlowTuple& tuple, std::vector<uint64_t>& packetOffsets)
+{
+	std::vector<uint32_t> packetInterfaces;
+	return findFlowEntries(tuple, packetOffsets, packetInterfaces);
+}
+
+bool PcapFlowIndex::readFlow(const FlowTuple& tuple, PointerVector<RawPacket>& packets)
+{
+	std::vector<uint64_t> packetOffsets;
+	std::vector<uint32_t> packetInterfaces;
+	if (!findFlowEntries(tuple, packetOffsets, packetInterfaces))
+		return false;
+
+	if (packetOffsets.empty())
+		return true;
+
+	if (!m_PacketReader->open())
+		return false;
+
+	// the offsets are in file order, so the packets are read with forward seeks only
+	RawPacket rawPacket;
+	for (size_t i = 0; i < packetOffsets.size(); i++)
+	{
+		if (!m_PacketReader->readPacketAt(packetOffsets[i], packetInterfaces[i], rawPacket))
+			return false;
+
+		packets.pushBack(new RawPacket(rawPacket));
+	}
+
+	return true;
+}
+
+bool PcapFlowIndex::getFlows(std::vector<FlowTuple>& flows)
+{
+	flows.clear();
+	if (m_IndexFile == NULL)
+	{
+		LOG_ERROR("Flow index not opened");
+		return false;
+	}
+
+	if (!seekFile(m_IndexFile, m_DirectoryOffset))
+	{
+		LOG_ERROR("Cannot read the directory of the flow index of file '%s'", m_FileInfo.getFileName().c_str());
+		return false;
+	}
+
+	flows.reserve((size_t)m_NumOfFlows);
+	for (uint64_t first = 0; first < m_NumOfFlows; first += DirectoryEntriesPerRead)
+	{
+		uint64_t numOfEntries = (m_NumOfFlows - first < DirectoryEntriesPerRead ? m_NumOfFlows - first : DirectoryEntriesPerRead);
+		m_Buffer.resize((size_t)(numOfEntries * DirectoryEntryLength));
+		if (fread(&m_Buffer[0], 1, m_Buffer.size(), m_IndexFile) != m_Buffer.size())
+		{
+			LOG_ERROR("Cannot read the directory of the flow index of file '%s'", m_FileInfo.getFileName().c_str());
+			flows.clear();
+			return false;
+		}
+
+		for (uint64_t i = 0; i < numOfEntries; i++)
+		{
+			FlowTuple tuple;
+			unpackKey(&m_Buffer[(size_t)(i * DirectoryEntryLength)], tuple);
+			flows.push_back(tuple);
+		}
+	}
+
+	return true;
+}
+
+} // namespace pcpp
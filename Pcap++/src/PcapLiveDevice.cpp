@@ -10,7 +10,10 @@
 #include "Logger.h"
 #include "PlatformSpecificUtils.h"
 #include "SystemUtils.h"
+#include "TimestampClock.h"
+#include "LatencyTracer.h"
 #include <string.h>
+#include <utility>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -28,6 +31,11 @@
 #ifdef MAC_OS_X
 #include <net/if_dl.h>
 #endif
+#ifdef LINUX
+#include <errno.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#endif
 
 // On Mac OS X timeout of -1 causes pcap_open_live to fail so value of 1ms is set here.
 // On Linux and Windows this is not the case so we keep the -1 value
@@ -47,6 +55,17 @@ struct PcapThread
 	pthread_t pthread;
 };
 
+struct PcapFanoutThread
+{
+	pcap_t* pcap;
+	pthread_t pthread;
+	bool threadStarted;
+	// the statistics of the handle when it was closed
+	pcap_stat lastStats;
+	PcapLiveDevice* device;
+	uint8_t threadId;
+};
+
 #ifdef HAS_SET_DIRECTION_ENABLED
 static pcap_direction_t directionTypeMap(PcapLiveDevice::PcapDirection direction)
 {
@@ -59,6 +78,16 @@ static pcap_direction_t directionTypeMap(PcapLiveDevice::PcapDirection direction
 }
 #endif
 
+static bool setHandleFilter(pcap_t* pcap, const std::string& filterAsString)
+{
+	struct bpf_program prog;
+	if (pcap_compile(pcap, &prog, filterAsString.c_str(), 1, 0) < 0)
+		return false;
+
+	bool result = (pcap_setfilter(pcap, &prog) == 0);
+	pcap_freecode(&prog);
+	return result;
+}
 
 
 PcapLiveDevice::PcapLiveDevice(pcap_if_t* pInterface, bool calculateMTU, bool calculateMacAddress, bool calculateDefaultGateway) : IPcapDevice(),
@@ -68,6 +97,9 @@ PcapLiveDevice::PcapLiveDevice(pcap_if_t* pInterface, bool calculateMTU, bool ca
 	m_Name = NULL;
 	m_Description = NULL;
 	m_DeviceMtu = 0;
+	m_DeviceMtuFetched = false;
+	m_MacAddressFetched = false;
+	m_DefaultGatewayFetched = false;
 	m_LinkType = LINKTYPE_ETHERNET;
 
 	m_IsLoopback = (pInterface->flags & 0x1) == PCAP_IF_LOOPBACK;
@@ -113,7 +145,6 @@ PcapLiveDevice::PcapLiveDevice(pcap_if_t* pInterface, bool calculateMTU, bool ca
 	//init all other members
 	m_CaptureThreadStarted = false;
 	m_StatsThreadStarted = false;
-	m_IsLoopback = false;
 	m_StopThread = false;
 	m_CaptureThread = new PcapThread();
 	m_StatsThread = new PcapThread();
@@ -123,11 +154,30 @@ PcapLiveDevice::PcapLiveDevice(pcap_if_t* pInterface, bool calculateMTU, bool ca
 	m_cbOnStatsUpdate = NULL;
 	m_cbOnPacketArrivesBlockingMode = NULL;
 	m_cbOnPacketArrivesBlockingModeUserCookie = NULL;
+	m_cbOnPacketsArriveBurst = NULL;
+	m_cbOnPacketsArriveBurstUserCookie = NULL;
+	m_BurstPackets = NULL;
+	m_BurstData = NULL;
+	m_BurstCapacity = 0;
+	m_MaxBurstSize = 0;
+	m_BurstLen = 0;
 	m_IntervalToUpdateStats = 0;
 	m_cbOnPacketArrivesUserCookie = NULL;
 	m_cbOnStatsUpdateUserCookie = NULL;
 	m_CaptureCallbackMode = true;
 	m_CapturedPackets = NULL;
+	m_CapturedSlabPackets = NULL;
+	m_RawPacketPool = NULL;
+	m_FanoutThreads = NULL;
+	m_NumOfFanoutThreads = 0;
+	m_FanoutThreadsStarted = false;
+	m_cbOnPacketArrivesMultiThread = NULL;
+	m_cbOnPacketArrivesMultiThreadUserCookie = NULL;
+	m_NonBlockingMode = false;
+	m_TxBufferCount = 0;
+	m_TxBufferLastFlushNs = 0;
+	m_RetiredPcapDescriptor = NULL;
+	memset(&m_RetiredHandlesStats, 0, sizeof(m_RetiredHandlesStats));
 	if (calculateMacAddress)
 	{
 		setDeviceMacAddress();
@@ -136,6 +186,11 @@ PcapLiveDevice::PcapLiveDevice(pcap_if_t* pInterface, bool calculateMTU, bool ca
 	}
 }
 
+static inline bool isPacketSampled(PacketSampler& sampler, const struct pcap_pkthdr *pkthdr, const uint8_t *packet, LinkLayerType linkType)
+{
+	return !sampler.isEnabled() || sampler.samplePacket(packet, pkthdr->caplen, linkType, TimestampClock::toNs(pkthdr->ts));
+}
+
 void PcapLiveDevice::onPacketArrives(uint8_t *user, const struct pcap_pkthdr *pkthdr, const uint8_t *packet)
 {
 	PcapLiveDevice* pThis = (PcapLiveDevice*)user;
@@ -145,6 +200,11 @@ void PcapLiveDevice::onPacketArrives(uint8_t *user, const struct pcap_pkthdr *pk
 		return;
 	}
 
+	if (!isPacketSampled(pThis->m_Sampler, pkthdr, packet, pThis->getLinkType()))
+		return;
+
+	PCPP_LATENCY_TRACE_RX();
+
 	RawPacket rawPacket(packet, pkthdr->caplen, pkthdr->ts, false, pThis->getLinkType());
 
 	if (pThis->m_cbOnPacketArrives != NULL)
@@ -160,9 +220,17 @@ void PcapLiveDevice::onPacketArrivesNoCallback(uint8_t *user, const struct pcap_
 		return;
 	}
 
-	uint8_t* packetData = new uint8_t[pkthdr->caplen];
-	memcpy(packetData, packet, pkthdr->caplen);
-	RawPacket* rawPacketPtr = new RawPacket(packetData, pkthdr->caplen, pkthdr->ts, true, pThis->getLinkType());
+	if (!isPacketSampled(pThis->m_Sampler, pkthdr, packet, pThis->getLinkType()))
+		return;
+
+	if (pThis->m_CapturedSlabPackets != NULL)
+	{
+		pThis->m_CapturedSlabPackets->pushBack(packet, pkthdr->caplen, pkthdr->ts, pThis->getLinkType(), pkthdr->len);
+		return;
+	}
+
+	RawPacket* rawPacketPtr = new RawPacket();
+	rawPacketPtr->copyRawData(packet, pkthdr->caplen, pkthdr->ts, pThis->m_RawPacketPool, pThis->getLinkType());
 	pThis->m_CapturedPackets->pushBack(rawPacketPtr);
 }
 
@@ -175,6 +243,11 @@ void PcapLiveDevice::onPacketArrivesBlockingMode(uint8_t *user, const struct pca
 		return;
 	}
 
+	if (!isPacketSampled(pThis->m_Sampler, pkthdr, packet, pThis->getLinkType()))
+		return;
+
+	PCPP_LATENCY_TRACE_RX();
+
 	RawPacket rawPacket(packet, pkthdr->caplen, pkthdr->ts, false, pThis->getLinkType());
 
 	if (pThis->m_cbOnPacketArrivesBlockingMode != NULL)
@@ -182,6 +255,94 @@ void PcapLiveDevice::onPacketArrivesBlockingMode(uint8_t *user, const struct pca
 			pThis->m_StopThread = true;
 }
 
+void PcapLiveDevice::onPacketArrivesBurstMode(uint8_t *user, const struct pcap_pkthdr *pkthdr, const uint8_t *packet)
+{
+	PcapLiveDevice* pThis = (PcapLiveDevice*)user;
+	if (pThis == NULL)
+	{
+		LOG_ERROR("Unable to extract PcapLiveDevice instance");
+		return;
+	}
+
+	if (!isPacketSampled(pThis->m_Sampler, pkthdr, packet, pThis->getLinkType()))
+		return;
+
+	// the latency of a burst is measured from the arrival of its first packet
+	if (pThis->m_BurstLen == 0)
+		PCPP_LATENCY_TRACE_RX();
+
+	// the packet data is only valid until this callback returns, so it's copied to the packet's slot in the burst buffer
+	uint32_t capLen = (pkthdr->caplen < (uint32_t)DEFAULT_SNAPLEN ? pkthdr->caplen : (uint32_t)DEFAULT_SNAPLEN);
+	uint8_t* slot = pThis->m_BurstData + (size_t)pThis->m_BurstLen * DEFAULT_SNAPLEN;
+	memcpy(slot, packet, capLen);
+
+	timespec timestamp;
+	timestamp.tv_sec = pkthdr->ts.tv_sec;
+	timestamp.tv_nsec = pkthdr->ts.tv_usec * 1000;
+	pThis->m_BurstPackets[pThis->m_BurstLen].setExternalRawData(slot, (int)capLen, timestamp, pThis->getLinkType(), (int)pkthdr->len);
+	pThis->m_BurstLen++;
+
+	if (pThis->m_BurstLen == pThis->m_MaxBurstSize)
+		pThis->deliverBurst();
+}
+
+void PcapLiveDevice::onPacketArrivesMultiThread(uint8_t *user, const struct pcap_pkthdr *pkthdr, const uint8_t *packet)
+{
+	PcapFanoutThread* fanoutThread = (PcapFanoutThread*)user;
+	if (fanoutThread == NULL)
+	{
+		LOG_ERROR("Unable to extract capture thread context");
+		return;
+	}
+
+	PcapLiveDevice* pThis = fanoutThread->device;
+	if (!isPacketSampled(pThis->m_FanoutSamplers[fanoutThread->threadId], pkthdr, packet, pThis->getLinkType()))
+		return;
+
+	PCPP_LATENCY_TRACE_RX();
+
+	RawPacket rawPacket(packet, pkthdr->caplen, pkthdr->ts, false, pThis->getLinkType());
+	pThis->m_cbOnPacketArrivesMultiThread(&rawPacket, fanoutThread->threadId, pThis, pThis->m_cbOnPacketArrivesMultiThreadUserCookie);
+}
+
+void PcapLiveDevice::deliverBurst()
+{
+	if (m_BurstLen == 0)
+		return;
+
+	m_cbOnPacketsArriveBurst(m_BurstPackets, m_BurstLen, this, m_cbOnPacketsArriveBurstUserCookie);
+	m_BurstLen = 0;
+}
+
+void PcapLiveDevice::allocateBurstBuffers(uint32_t maxBurstSize)
+{
+	// the burst buffers are kept between captures and only grow
+	if (maxBurstSize <= m_BurstCapacity)
+		return;
+
+	delete [] m_BurstPackets;
+	delete [] m_BurstData;
+	m_BurstPackets = new RawPacket[maxBurstSize];
+	m_BurstData = new uint8_t[(size_t)maxBurstSize * DEFAULT_SNAPLEN];
+	m_BurstCapacity = maxBurstSize;
+}
+
+bool PcapLiveDevice::setNonBlockingMode(bool nonBlocking)
+{
+	if (m_NonBlockingMode == nonBlocking)
+		return true;
+
+	char errbuf[PCAP_ERRBUF_SIZE] = {'\0'};
+	if (pcap_setnonblock(m_PcapDescriptor, (nonBlocking ? 1 : 0), errbuf) < 0)
+	{
+		LOG_ERROR("Cannot set %s mode on device '%s': %s", (nonBlocking ? "non-blocking" : "blocking"), m_Name, errbuf);
+		return false;
+	}
+
+	m_NonBlockingMode = nonBlocking;
+	return true;
+}
+
 void* PcapLiveDevice::captureThreadMain(void *ptr)
 {
 	PcapLiveDevice* pThis = (PcapLiveDevice*)ptr;
@@ -192,21 +353,51 @@ void* PcapLiveDevice::captureThreadMain(void *ptr)
 	}
 
 	LOG_DEBUG("Started capture thread for device '%s'", pThis->m_Name);
-	if (pThis->m_CaptureCallbackMode)
+	if (pThis->m_cbOnPacketsArriveBurst != NULL)
 	{
+		// each dispatch reads at most one burst, which is delivered when the dispatch returns
 		while (!pThis->m_StopThread)
-			pcap_dispatch(pThis->m_PcapDescriptor, -1, onPacketArrives, (uint8_t*)pThis);
+		{
+			int numOfPackets = pcap_dispatch(pThis->m_PcapDescriptor, (int)pThis->m_MaxBurstSize, onPacketArrivesBurstMode, (uint8_t*)pThis);
+			pThis->deliverBurst();
+			if (pThis->m_AutoTuner.isEnabled())
+				pThis->autoTune(numOfPackets);
+		}
+	}
+	else if (pThis->m_CaptureCallbackMode)
+	{
+		while (!pThis->m_StopThread)
+		{
+			int numOfPackets = pcap_dispatch(pThis->m_PcapDescriptor, -1, onPacketArrives, (uint8_t*)pThis);
+			if (pThis->m_AutoTuner.isEnabled())
+				pThis->autoTune(numOfPackets);
+		}
 	}
 	else
 	{
 		while (!pThis->m_StopThread)
-			pcap_dispatch(pThis->m_PcapDescriptor, 100, onPacketArrivesNoCallback, (uint8_t*)pThis);
-
+		{
+			int numOfPackets = pcap_dispatch(pThis->m_PcapDescriptor, 100, onPacketArrivesNoCallback, (uint8_t*)pThis);
+			if (pThis->m_AutoTuner.isEnabled())
+				pThis->autoTune(numOfPackets);
+		}
 	}
 	LOG_DEBUG("Ended capture thread for device '%s'", pThis->m_Name);
 	return 0;
 }
 
+void* PcapLiveDevice::fanoutThreadMain(void *ptr)
+{
+	PcapFanoutThread* fanoutThread = (PcapFanoutThread*)ptr;
+	PcapLiveDevice* pThis = fanoutThread->device;
+
+	LOG_DEBUG("Started capture thread #%d for device '%s'", (int)fanoutThread->threadId, pThis->m_Name);
+	while (!pThis->m_StopThread)
+		pcap_dispatch(fanoutThread->pcap, -1, onPacketArrivesMultiThread, (uint8_t*)fanoutThread);
+	LOG_DEBUG("Ended capture thread #%d for device '%s'", (int)fanoutThread->threadId, pThis->m_Name);
+	return 0;
+}
+
 void* PcapLiveDevice::statsThreadMain(void *ptr)
 {
 	PcapLiveDevice* pThis = (PcapLiveDevice*)ptr;
@@ -321,8 +512,15 @@ pcap_t* PcapLiveDevice::doOpen(const DeviceConfiguration& config)
 
 bool PcapLiveDevice::open(const DeviceConfiguration& config)
 {
+	// kept for opening the handles of multi-thread capture
+	m_DeviceConfig = config;
+	m_FilterAsString = "";
 	m_PcapDescriptor = doOpen(config);
 	m_PcapSendDescriptor = doOpen(config);
+	m_NonBlockingMode = false;
+	m_TxBufferCount = 0;
+	m_TxBufferData.clear();
+	memset(&m_RetiredHandlesStats, 0, sizeof(m_RetiredHandlesStats));
 	if (m_PcapDescriptor == NULL || m_PcapSendDescriptor == NULL)
 	{
 		m_DeviceOpened = false;
@@ -350,6 +548,23 @@ void PcapLiveDevice::close()
 		return;
 	}
 
+	if (m_FanoutThreadsStarted)
+		stopCapture();
+	closeFanoutHandles();
+	delete [] m_FanoutThreads;
+	m_FanoutThreads = NULL;
+	m_NumOfFanoutThreads = 0;
+
+	// send the packets left in the TX buffer
+	if (m_PcapSendDescriptor != NULL)
+		flushTxBuffer();
+
+	if (m_RetiredPcapDescriptor != NULL)
+	{
+		pcap_close(m_RetiredPcapDescriptor);
+		m_RetiredPcapDescriptor = NULL;
+	}
+
 	bool sameDescriptor = (m_PcapDescriptor == m_PcapSendDescriptor);
 	pcap_close(m_PcapDescriptor);
 	LOG_DEBUG("Receive pcap descriptor closed");
@@ -381,6 +596,9 @@ bool PcapLiveDevice::startCapture(OnPacketArrivesCallback onPacketArrives, void*
 		return false;
 	}
 
+	if (!setNonBlockingMode(false))
+		return false;
+
 	m_CaptureCallbackMode = true;
 	m_cbOnPacketArrives = onPacketArrives;
 	m_cbOnPacketArrivesUserCookie = onPacketArrivesUserCookie;
@@ -410,17 +628,232 @@ bool PcapLiveDevice::startCapture(OnPacketArrivesCallback onPacketArrives, void*
 	return true;
 }
 
+bool PcapLiveDevice::startCaptureBurstMode(OnPacketsArriveBurstCallback onPacketsArrive, void* onPacketsArriveUserCookie, uint32_t maxBurstSize,
+		int intervalInSecondsToUpdateStats, OnStatsUpdateCallback onStatsUpdate, void* onStatsUpdateUserCookie)
+{
+	if (m_CaptureThreadStarted || m_PcapDescriptor == NULL)
+	{
+		LOG_ERROR("Device '%s' already capturing or not opened", m_Name);
+		return false;
+	}
+
+	if (onPacketsArrive == NULL || maxBurstSize == 0)
+	{
+		LOG_ERROR("Burst mode capture on device '%s' needs a callback and a burst size larger than 0", m_Name);
+		return false;
+	}
+
+	allocateBurstBuffers(maxBurstSize);
+	m_MaxBurstSize = maxBurstSize;
+	m_BurstLen = 0;
+	m_cbOnPacketsArriveBurst = onPacketsArrive;
+	m_cbOnPacketsArriveBurstUserCookie = onPacketsArriveUserCookie;
+
+	if (!startCapture(NULL, NULL, intervalInSecondsToUpdateStats, onStatsUpdate, onStatsUpdateUserCookie))
+	{
+		if (!m_CaptureThreadStarted)
+			m_cbOnPacketsArriveBurst = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+bool PcapLiveDevice::startCaptureMultiThread(uint8_t numOfThreads, OnPacketArrivesMultiThreadCallback onPacketArrives, void* onPacketArrivesUserCookie,
+		CoreMask coreMask, FanoutMode fanoutMode)
+{
+#ifdef LINUX
+	if (m_CaptureThreadStarted || m_PcapDescriptor == NULL)
+	{
+		LOG_ERROR("Device '%s' already capturing or not opened", m_Name);
+		return false;
+	}
+
+	if (onPacketArrives == NULL || numOfThreads == 0 || numOfThreads > PCPP_LIVE_DEVICE_MAX_CAPTURE_THREADS)
+	{
+		LOG_ERROR("Multi-thread capture on device '%s' needs a callback and between 1 and %d threads", m_Name, PCPP_LIVE_DEVICE_MAX_CAPTURE_THREADS);
+		return false;
+	}
+
+	std::vector<SystemCore> cores;
+	createCoreVectorFromCoreMask(coreMask, cores);
+
+	int fanoutType = PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG;
+	switch (fanoutMode)
+	{
+	case FanoutLoadBalance:
+		fanoutType = PACKET_FANOUT_LB;
+		break;
+	case FanoutCpu:
+		fanoutType = PACKET_FANOUT_CPU;
+		break;
+	default:
+		break;
+	}
+
+	// fanout groups are matched by ID only, so the interface index is mixed in to keep devices of the same process in separate groups
+	uint16_t groupId = (uint16_t)(getpid() ^ (if_nametoindex(m_Name) << 8));
+	int fanoutArg = (int)groupId | (fanoutType << 16);
+
+	// handles of a previous capture are kept for their statistics until a new capture starts
+	delete [] m_FanoutThreads;
+	m_FanoutThreads = new PcapFanoutThread[numOfThreads];
+	memset(m_FanoutThreads, 0, sizeof(PcapFanoutThread) * numOfThreads);
+	m_NumOfFanoutThreads = numOfThreads;
+	m_FanoutSamplers.assign(numOfThreads, PacketSampler(m_Sampler.getConfiguration().divide(numOfThreads)));
+
+	for (uint8_t i = 0; i < numOfThreads; i++)
+	{
+		PcapFanoutThread& fanoutThread = m_FanoutThreads[i];
+		fanoutThread.device = this;
+		fanoutThread.threadId = i;
+		fanoutThread.pcap = doOpen(m_DeviceConfig);
+		if (fanoutThread.pcap == NULL)
+		{
+			LOG_ERROR("Cannot open handle #%d of device '%s'", (int)i, m_Name);
+			closeFanoutHandles();
+			return false;
+		}
+
+		if (setsockopt(pcap_fileno(fanoutThread.pcap), SOL_PACKET, PACKET_FANOUT, &fanoutArg, sizeof(fanoutArg)) < 0)
+		{
+			LOG_ERROR("Cannot join fanout group %d on device '%s', error was: %d", (int)groupId, m_Name, errno);
+			closeFanoutHandles();
+			return false;
+		}
+
+		if (!m_FilterAsString.empty() && !setHandleFilter(fanoutThread.pcap, m_FilterAsString))
+		{
+			LOG_ERROR("Cannot set filter on handle #%d of device '%s': %s", (int)i, m_Name, pcap_geterr(fanoutThread.pcap));
+			closeFanoutHandles();
+			return false;
+		}
+	}
+
+	m_cbOnPacketArrivesMultiThread = onPacketArrives;
+	m_cbOnPacketArrivesMultiThreadUserCookie = onPacketArrivesUserCookie;
+	m_StopThread = false;
+
+	for (uint8_t i = 0; i < numOfThreads; i++)
+	{
+		PcapFanoutThread& fanoutThread = m_FanoutThreads[i];
+		int err = pthread_create(&fanoutThread.pthread, NULL, &fanoutThreadMain, (void*)&fanoutThread);
+		if (err == 0)
+		{
+			fanoutThread.threadStarted = true;
+			if (!cores.empty())
+			{
+				cpu_set_t cpuset;
+				CPU_ZERO(&cpuset);
+				CPU_SET(cores[i % cores.size()].Id, &cpuset);
+				err = pthread_setaffinity_np(fanoutThread.pthread, sizeof(cpu_set_t), &cpuset);
+			}
+		}
+
+		if (err != 0)
+		{
+			LOG_ERROR("Cannot create or pin capture thread #%d for device '%s': [%s]", (int)i, m_Name, strerror(err));
+			m_FanoutThreadsStarted = true;
+			m_CaptureThreadStarted = true;
+			stopCapture();
+			return false;
+		}
+	}
+
+	m_FanoutThreadsStarted = true;
+	m_CaptureThreadStarted = true;
+	LOG_DEBUG("Successfully created %d capture threads for device '%s'", (int)numOfThreads, m_Name);
+
+	return true;
+#else
+	LOG_ERROR("Multi-thread capture is supported on Linux only");
+	return false;
+#endif
+}
+
+void PcapLiveDevice::closeFanoutHandles()
+{
+	for (uint8_t i = 0; i < m_NumOfFanoutThreads; i++)
+	{
+		PcapFanoutThread& fanoutThread = m_FanoutThreads[i];
+		if (fanoutThread.pcap == NULL)
+			continue;
+
+		if (pcap_stats(fanoutThread.pcap, &fanoutThread.lastStats) < 0)
+			memset(&fanoutThread.lastStats, 0, sizeof(pcap_stat));
+		pcap_close(fanoutThread.pcap);
+		fanoutThread.pcap = NULL;
+	}
+}
+
+bool PcapLiveDevice::getThreadStatistics(uint8_t threadId, pcap_stat& stats)
+{
+	if (threadId >= m_NumOfFanoutThreads)
+	{
+		LOG_ERROR("Device '%s' has no capture thread #%d", m_Name, (int)threadId);
+		return false;
+	}
+
+	PcapFanoutThread& fanoutThread = m_FanoutThreads[threadId];
+	if (fanoutThread.pcap == NULL)
+	{
+		stats = fanoutThread.lastStats;
+		return true;
+	}
+
+	if (pcap_stats(fanoutThread.pcap, &stats) < 0)
+	{
+		LOG_ERROR("Error getting statistics of capture thread #%d of device '%s'", (int)threadId, m_Name);
+		return false;
+	}
+
+	return true;
+}
+
 bool PcapLiveDevice::startCapture(RawPacketVector& capturedPacketsVector)
 {
+	if (m_CaptureThreadStarted || m_PcapDescriptor == NULL)
+	{
+		LOG_ERROR("Device '%s' already capturing or not opened", m_Name);
+		return false;
+	}
+
+	if (!setNonBlockingMode(false))
+		return false;
+
 	m_CapturedPackets = &capturedPacketsVector;
 	m_CapturedPackets->clear();
+	m_CapturedSlabPackets = NULL;
 
+	m_CaptureCallbackMode = false;
+	int err = pthread_create(&(m_CaptureThread->pthread), NULL, getCaptureThreadStart(), (void*)this);
+	if (err != 0)
+	{
+		LOG_ERROR("Cannot create LiveCapture thread for device '%s': [%s]", m_Name, strerror(err));
+		return false;
+	}
+	m_CaptureThreadStarted = true;
+	LOG_DEBUG("Successfully created capture thread for device '%s'. Thread id: %s", m_Name, printThreadId(m_CaptureThread).c_str());
+
+	return true;
+}
+
+
+bool PcapLiveDevice::startCapture(RawPacketSlabVector& capturedPacketsVector)
+{
 	if (m_CaptureThreadStarted || m_PcapDescriptor == NULL)
 	{
 		LOG_ERROR("Device '%s' already capturing or not opened", m_Name);
 		return false;
 	}
 
+	if (!setNonBlockingMode(false))
+		return false;
+
+	m_CapturedSlabPackets = &capturedPacketsVector;
+	m_CapturedSlabPackets->clear();
+	m_CapturedPackets = NULL;
+
 	m_CaptureCallbackMode = false;
 	int err = pthread_create(&(m_CaptureThread->pthread), NULL, getCaptureThreadStart(), (void*)this);
 	if (err != 0)
@@ -443,6 +876,9 @@ int PcapLiveDevice::startCaptureBlockingMode(OnPacketArrivesStopBlocking onPacke
 		return 0;
 	}
 
+	if (!setNonBlockingMode(false))
+		return 0;
+
 	m_cbOnPacketArrives = NULL;
 	m_cbOnStatsUpdate = NULL;
 	m_cbOnPacketArrivesUserCookie = NULL;
@@ -489,6 +925,199 @@ int PcapLiveDevice::startCaptureBlockingMode(OnPacketArrivesStopBlocking onPacke
 	return 1;
 }
 
+int PcapLiveDevice::getSelectableFd() const
+{
+	if (m_PcapDescriptor == NULL)
+		return -1;
+
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	return -1;
+#else
+	return pcap_get_selectable_fd(m_PcapDescriptor);
+#endif
+}
+
+int PcapLiveDevice::pollPackets(OnPacketsArriveBurstCallback onPacketsArrive, void* onPacketsArriveUserCookie, uint32_t maxBurstSize)
+{
+	if (m_CaptureThreadStarted || m_PcapDescriptor == NULL)
+	{
+		LOG_ERROR("Device '%s' is capturing or not opened", m_Name);
+		return -1;
+	}
+
+	if (onPacketsArrive == NULL || maxBurstSize == 0)
+	{
+		LOG_ERROR("Polling device '%s' needs a callback and a burst size larger than 0", m_Name);
+		return -1;
+	}
+
+	if (!setNonBlockingMode(true))
+		return -1;
+
+	allocateBurstBuffers(maxBurstSize);
+	m_MaxBurstSize = maxBurstSize;
+	m_BurstLen = 0;
+	m_cbOnPacketsArriveBurst = onPacketsArrive;
+	m_cbOnPacketsArriveBurstUserCookie = onPacketsArriveUserCookie;
+
+	// in non-blocking mode the dispatch returns right away with the packets already in the capture buffer
+	int numOfPackets = pcap_dispatch(m_PcapDescriptor, (int)maxBurstSize, onPacketArrivesBurstMode, (uint8_t*)this);
+	deliverBurst();
+
+	m_cbOnPacketsArriveBurst = NULL;
+	m_cbOnPacketsArriveBurstUserCookie = NULL;
+
+	if (numOfPackets < 0)
+	{
+		LOG_ERROR("Error polling device '%s': %s", m_Name, pcap_geterr(m_PcapDescriptor));
+		return -1;
+	}
+
+	return numOfPackets;
+}
+
+bool PcapLiveDevice::setSampling(const PacketSamplerConfiguration& config)
+{
+	if (m_CaptureThreadStarted)
+	{
+		LOG_ERROR("Cannot set sampling on device '%s' while capturing", m_Name);
+		return false;
+	}
+
+	m_Sampler.setConfiguration(config);
+	LOG_DEBUG("Sampling set on device '%s'", m_Name);
+	return true;
+}
+
+bool PcapLiveDevice::clearSampling()
+{
+	if (m_CaptureThreadStarted)
+	{
+		LOG_ERROR("Cannot remove sampling from device '%s' while capturing", m_Name);
+		return false;
+	}
+
+	m_Sampler.setConfiguration(PacketSamplerConfiguration());
+	m_FanoutSamplers.clear();
+	return true;
+}
+
+void PcapLiveDevice::getSamplingStats(uint64_t& numOfPackets, uint64_t& numOfSampledPackets) const
+{
+	numOfPackets = m_Sampler.getNumOfPackets();
+	numOfSampledPackets = m_Sampler.getNumOfSampledPackets();
+	for (size_t i = 0; i < m_FanoutSamplers.size(); i++)
+	{
+		numOfPackets += m_FanoutSamplers[i].getNumOfPackets();
+		numOfSampledPackets += m_FanoutSamplers[i].getNumOfSampledPackets();
+	}
+}
+
+bool PcapLiveDevice::setAutoTuning(const PcapAutoTunerConfiguration& config)
+{
+	if (m_CaptureThreadStarted)
+	{
+		LOG_ERROR("Cannot set auto-tuning on device '%s' while capturing", m_Name);
+		return false;
+	}
+
+	if (config.maxBufferSize <= 0)
+	{
+		LOG_ERROR("Cannot set auto-tuning on device '%s': the maximum buffer size must be greater than 0", m_Name);
+		return false;
+	}
+
+	PcapAutoTunerSettings settings;
+	settings.bufferSize = m_DeviceConfig.packetBufferSize;
+	settings.timeoutMs = m_DeviceConfig.packetBufferTimeoutMs;
+	settings.minToCopy = 0;
+	m_AutoTuner.configure(config, settings);
+
+	// the minimum amount of data to copy isn't set when a handle is opened, so it's applied right away
+	if (m_DeviceOpened && m_AutoTuner.getSettings().minToCopy > 0)
+		applyAutoTuning(PcapAutoTuner::MinToCopyChanged);
+
+	LOG_DEBUG("Auto-tuning set on device '%s'", m_Name);
+	return true;
+}
+
+bool PcapLiveDevice::clearAutoTuning()
+{
+	if (m_CaptureThreadStarted)
+	{
+		LOG_ERROR("Cannot remove auto-tuning from device '%s' while capturing", m_Name);
+		return false;
+	}
+
+	m_AutoTuner.disable();
+	return true;
+}
+
+void PcapLiveDevice::autoTune(int numOfPackets)
+{
+	m_AutoTuner.onDispatch(numOfPackets);
+	uint64_t nowMs = TimestampClock::nowNs() / 1000000;
+	if (!m_AutoTuner.isEvaluationDue(nowMs))
+		return;
+
+	pcap_stat stats;
+	if (pcap_stats(m_PcapDescriptor, &stats) < 0)
+	{
+		// the next evaluation starts counting again
+		m_AutoTuner.resetCounters();
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	int changes = m_AutoTuner.evaluate(nowMs, stats.ps_recv, (uint64_t)stats.ps_drop + stats.ps_ifdrop);
+	if (changes == PcapAutoTuner::NoChange)
+		return;
+
+	const PcapAutoTunerSettings& settings = m_AutoTuner.getSettings();
+	LOG_DEBUG("Auto-tuning device '%s': buffer size %d, timeout %dms, min to copy %d", m_Name, settings.bufferSize, settings.timeoutMs,
+			settings.minToCopy);
+	applyAutoTuning(changes);
+}
+
+bool PcapLiveDevice::applyAutoTuning(int changes)
+{
+	if ((changes & (PcapAutoTuner::BufferSizeChanged | PcapAutoTuner::TimeoutChanged)) == 0)
+		return true;
+
+	DeviceConfiguration config = m_DeviceConfig;
+	config.packetBufferSize = m_AutoTuner.getSettings().bufferSize;
+	config.packetBufferTimeoutMs = m_AutoTuner.getSettings().timeoutMs;
+	pcap_t* pcap = doOpen(config);
+	if (pcap == NULL)
+	{
+		LOG_ERROR("Cannot open a new handle for auto-tuning device '%s', the current handle is kept", m_Name);
+		return false;
+	}
+
+	if (!m_FilterAsString.empty() && !setHandleFilter(pcap, m_FilterAsString))
+	{
+		LOG_ERROR("Cannot set filter on the new handle for auto-tuning device '%s': %s", m_Name, pcap_geterr(pcap));
+		pcap_close(pcap);
+		return false;
+	}
+
+	pcap_stat stats;
+	if (pcap_stats(m_PcapDescriptor, &stats) == 0)
+	{
+		m_RetiredHandlesStats.ps_recv += stats.ps_recv;
+		m_RetiredHandlesStats.ps_drop += stats.ps_drop;
+		m_RetiredHandlesStats.ps_ifdrop += stats.ps_ifdrop;
+	}
+
+	// the stats thread may be reading the statistics of the replaced handle, so it's closed only when the next one is replaced
+	if (m_RetiredPcapDescriptor != NULL)
+		pcap_close(m_RetiredPcapDescriptor);
+	m_RetiredPcapDescriptor = m_PcapDescriptor;
+	m_PcapDescriptor = pcap;
+	m_DeviceConfig = config;
+	m_AutoTuner.resetCounters();
+	return true;
+}
+
 void PcapLiveDevice::stopCapture()
 {
 	// in blocking mode stop capture isn't relevant
@@ -496,7 +1125,26 @@ void PcapLiveDevice::stopCapture()
 		return;
 
 	m_StopThread = true;
-	if (m_CaptureThreadStarted)
+	if (m_FanoutThreadsStarted)
+	{
+		LOG_DEBUG("Stopping capture threads, waiting for them to join...");
+		for (uint8_t i = 0; i < m_NumOfFanoutThreads; i++)
+		{
+			PcapFanoutThread& fanoutThread = m_FanoutThreads[i];
+			if (!fanoutThread.threadStarted)
+				continue;
+
+			pcap_breakloop(fanoutThread.pcap);
+			pthread_join(fanoutThread.pthread, NULL);
+			fanoutThread.threadStarted = false;
+		}
+		closeFanoutHandles();
+		m_FanoutThreadsStarted = false;
+		m_CaptureThreadStarted = false;
+		m_cbOnPacketArrivesMultiThread = NULL;
+		m_cbOnPacketArrivesMultiThreadUserCookie = NULL;
+	}
+	else if (m_CaptureThreadStarted)
 	{
 		LOG_DEBUG("Stopping capture thread, waiting for it to join...");
 		pthread_join(m_CaptureThread->pthread, NULL);
@@ -511,6 +1159,9 @@ void PcapLiveDevice::stopCapture()
 		LOG_DEBUG("Stats thread stopped for device '%s'", m_Name);
 	}
 
+	m_cbOnPacketsArriveBurst = NULL;
+	m_cbOnPacketsArriveBurstUserCookie = NULL;
+
 	PCAP_SLEEP(1);
 	m_StopThread = false;
 }
@@ -522,88 +1173,304 @@ bool PcapLiveDevice::captureActive()
 
 void PcapLiveDevice::getStatistics(pcap_stat& stats)
 {
+	if (m_FanoutThreadsStarted)
+	{
+		memset(&stats, 0, sizeof(pcap_stat));
+		for (uint8_t i = 0; i < m_NumOfFanoutThreads; i++)
+		{
+			pcap_stat threadStats;
+			if (!getThreadStatistics(i, threadStats))
+				continue;
+			stats.ps_recv += threadStats.ps_recv;
+			stats.ps_drop += threadStats.ps_drop;
+			stats.ps_ifdrop += threadStats.ps_ifdrop;
+		}
+		return;
+	}
+
 	if(pcap_stats(m_PcapDescriptor, &stats) < 0)
 	{
 		LOG_ERROR("Error getting statistics from live device '%s'", m_Name);
+		return;
 	}
-}
 
-bool PcapLiveDevice::sendPacket(RawPacket const& rawPacket)
-{
-	return sendPacket(((RawPacket&)rawPacket).getRawData(), ((RawPacket&)rawPacket).getRawDataLen());
+	// the handles replaced by auto-tuning counted the packets captured before them
+	stats.ps_recv += m_RetiredHandlesStats.ps_recv;
+	stats.ps_drop += m_RetiredHandlesStats.ps_drop;
+	stats.ps_ifdrop += m_RetiredHandlesStats.ps_ifdrop;
 }
 
-bool PcapLiveDevice::sendPacket(const uint8_t* packetData, int packetDataLength)
+bool PcapLiveDevice::setFilter(std::string filterAsString)
 {
-	if (!m_DeviceOpened)
-	{
-		LOG_ERROR("Device '%s' not opened!", m_Name);
+	if (!IPcapDevice::setFilter(filterAsString))
 		return false;
-	}
 
-	if (packetDataLength == 0)
+	m_FilterAsString = filterAsString;
+
+	if (m_FanoutThreadsStarted)
 	{
-		LOG_ERROR("Trying to send a packet with length 0");
-		return false;
+		for (uint8_t i = 0; i < m_NumOfFanoutThreads; i++)
+		{
+			pcap_t* pcap = m_FanoutThreads[i].pcap;
+			if (!setHandleFilter(pcap, filterAsString))
+			{
+				LOG_ERROR("Cannot set filter on capture thread #%d of device '%s': %s", (int)i, m_Name, pcap_geterr(pcap));
+				return false;
+			}
+		}
 	}
 
-	if (packetDataLength > m_DeviceMtu)
+	return true;
+}
+
+static void getPacketDataFromRawPacketArray(const void* packetStorage, int index, const uint8_t*& packetData, int& packetDataLength)
+{
+	const RawPacket& rawPacket = ((const RawPacket*)packetStorage)[index];
+	packetData = rawPacket.getRawData();
+	packetDataLength = rawPacket.getRawDataLen();
+}
+
+static void getPacketDataFromPacketArray(const void* packetStorage, int index, const uint8_t*& packetData, int& packetDataLength)
+{
+	const RawPacket* rawPacket = ((Packet* const*)packetStorage)[index]->getRawPacketReadOnly();
+	packetData = rawPacket->getRawData();
+	packetDataLength = rawPacket->getRawDataLen();
+}
+
+static void getPacketDataFromRawPacketPtrArray(const void* packetStorage, int index, const uint8_t*& packetData, int& packetDataLength)
+{
+	const RawPacket* rawPacket = ((const RawPacket* const*)packetStorage)[index];
+	packetData = rawPacket->getRawData();
+	packetDataLength = rawPacket->getRawDataLen();
+}
+
+static void getPacketDataFromBuffer(const void* packetStorage, int index, const uint8_t*& packetData, int& packetDataLength)
+{
+	const std::pair<const uint8_t*, int>* buffer = (const std::pair<const uint8_t*, int>*)packetStorage;
+	packetData = buffer->first;
+	packetDataLength = buffer->second;
+}
+
+bool PcapLiveDevice::isPacketSendable(int packetDataLength)
+{
+	if (packetDataLength == 0)
 	{
-		LOG_ERROR("Packet length [%d] is larger than device MTU [%d]\n", packetDataLength, m_DeviceMtu);
+		LOG_ERROR("Trying to send a packet with length 0");
 		return false;
 	}
 
-	if (pcap_sendpacket(m_PcapSendDescriptor, packetData, packetDataLength) == -1)
+	if (packetDataLength > getMtu())
 	{
-		LOG_ERROR("Error sending packet: %s\n", pcap_geterr(m_PcapSendDescriptor));
+		LOG_ERROR("Packet length [%d] is larger than device MTU [%d]\n", packetDataLength, getMtu());
 		return false;
 	}
 
-	LOG_DEBUG("Packet sent successfully. Packet length: %d", packetDataLength);
 	return true;
 }
 
-bool PcapLiveDevice::sendPacket(Packet* packet)
+int PcapLiveDevice::sendPacketBatch(const uint8_t* const* packetsData, const int* packetsLengths, int count)
 {
-	RawPacket* rawPacket = packet->getRawPacket();
-	return sendPacket(*rawPacket);
+	int packetsSent = 0;
+
+#ifdef LINUX
+	// pcap_sendpacket() is a send() on the packet socket of the handle, so a batch can go out in a single sendmmsg() on that socket.
+	// A single packet is still sent by libpcap, which knows the handles it can't send on
+	int fd = pcap_get_selectable_fd(m_PcapSendDescriptor);
+	if (fd >= 0 && count > 1)
+	{
+		struct mmsghdr messages[PCPP_LIVE_DEVICE_TX_BUFFER_SIZE];
+		struct iovec iovecs[PCPP_LIVE_DEVICE_TX_BUFFER_SIZE];
+		int first = 0;
+		while (first < count)
+		{
+			int batchSize = (count - first < PCPP_LIVE_DEVICE_TX_BUFFER_SIZE ? count - first : PCPP_LIVE_DEVICE_TX_BUFFER_SIZE);
+			memset(messages, 0, sizeof(struct mmsghdr) * batchSize);
+			for (int i = 0; i < batchSize; i++)
+			{
+				iovecs[i].iov_base = (void*)packetsData[first + i];
+				iovecs[i].iov_len = packetsLengths[first + i];
+				messages[i].msg_hdr.msg_iov = &iovecs[i];
+				messages[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			int result = sendmmsg(fd, messages, batchSize, 0);
+			if (result <= 0)
+			{
+				if (result < 0 && errno == EINTR)
+					continue;
+
+				// the first packet of the batch failed, skip it and send the rest
+				LOG_ERROR("Error sending packet: %s\n", strerror(errno));
+				first++;
+				continue;
+			}
+
+			packetsSent += result;
+			first += result;
+		}
+
+		return packetsSent;
+	}
+#endif
+
+	for (int i = 0; i < count; i++)
+	{
+		if (pcap_sendpacket(m_PcapSendDescriptor, packetsData[i], packetsLengths[i]) == -1)
+		{
+			LOG_ERROR("Error sending packet: %s\n", pcap_geterr(m_PcapSendDescriptor));
+			continue;
+		}
+
+		packetsSent++;
+	}
+
+	return packetsSent;
 }
 
-int PcapLiveDevice::sendPackets(RawPacket* rawPacketsArr, int arrLength)
+int PcapLiveDevice::sendPacketsInner(const void* packetStorage, PacketDataIterator iter, int arrLength, bool useTxBuffer)
 {
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened!", m_Name);
+		return 0;
+	}
+
+	// keep the order of the packets, the buffered ones were sent first
+	if (!useTxBuffer && m_TxBufferCount > 0)
+		flushTxBuffer();
+
+	PCPP_LATENCY_TRACE_BEGIN(txStart);
+
+	const uint8_t* batchData[PCPP_LIVE_DEVICE_TX_BUFFER_SIZE];
+	int batchLengths[PCPP_LIVE_DEVICE_TX_BUFFER_SIZE];
+	int batchSize = 0;
 	int packetsSent = 0;
+
 	for (int i = 0; i < arrLength; i++)
 	{
-		if (sendPacket(rawPacketsArr[i]))
+		const uint8_t* packetData = NULL;
+		int packetDataLength = 0;
+		iter(packetStorage, i, packetData, packetDataLength);
+		if (!isPacketSendable(packetDataLength))
+			continue;
+
+		if (useTxBuffer)
+		{
+			if (m_TxBufferCount == PCPP_LIVE_DEVICE_TX_BUFFER_SIZE)
+				flushTxBuffer();
+
+			m_TxBufferData.insert(m_TxBufferData.end(), packetData, packetData + packetDataLength);
+			m_TxBufferLengths[m_TxBufferCount++] = packetDataLength;
 			packetsSent++;
+			continue;
+		}
+
+		batchData[batchSize] = packetData;
+		batchLengths[batchSize] = packetDataLength;
+		if (++batchSize == PCPP_LIVE_DEVICE_TX_BUFFER_SIZE)
+		{
+			packetsSent += sendPacketBatch(batchData, batchLengths, batchSize);
+			batchSize = 0;
+		}
 	}
 
-	LOG_DEBUG("%d packets sent successfully. %d packets not sent", packetsSent, arrLength-packetsSent);
+	if (useTxBuffer)
+		flushTxBuffer(true);
+	else if (batchSize > 0)
+		packetsSent += sendPacketBatch(batchData, batchLengths, batchSize);
+
+	PCPP_LATENCY_TRACE_END(txStart, LatencyStageTx, LatencyStageRxToTx);
+
 	return packetsSent;
 }
 
-int PcapLiveDevice::sendPackets(Packet** packetsArr, int arrLength)
+int PcapLiveDevice::flushTxBuffer(bool flushOnlyIfTimeoutExpired)
 {
-	int packetsSent = 0;
-	for (int i = 0; i < arrLength; i++)
+	uint64_t now = TimestampClock::nowNs();
+	if (flushOnlyIfTimeoutExpired && now - m_TxBufferLastFlushNs < (uint64_t)m_DeviceConfig.flushTxBufferTimeout * 1000)
+		return 0;
+
+	m_TxBufferLastFlushNs = now;
+	if (m_TxBufferCount == 0)
+		return 0;
+
+	const uint8_t* packetsData[PCPP_LIVE_DEVICE_TX_BUFFER_SIZE];
+	const uint8_t* packetData = &m_TxBufferData[0];
+	for (int i = 0; i < m_TxBufferCount; i++)
 	{
-		if (sendPacket(packetsArr[i]))
-			packetsSent++;
+		packetsData[i] = packetData;
+		packetData += m_TxBufferLengths[i];
 	}
 
+	int packetsSent = sendPacketBatch(packetsData, m_TxBufferLengths, m_TxBufferCount);
+	LOG_DEBUG("TX buffer flushed, %d packets sent successfully. %d packets not sent", packetsSent, m_TxBufferCount - packetsSent);
+	m_TxBufferCount = 0;
+	m_TxBufferData.clear();
+	return packetsSent;
+}
+
+bool PcapLiveDevice::sendPacket(RawPacket const& rawPacket, bool useTxBuffer)
+{
+	return sendPacketsInner(&rawPacket, getPacketDataFromRawPacketArray, 1, useTxBuffer) == 1;
+}
+
+bool PcapLiveDevice::sendPacket(const uint8_t* packetData, int packetDataLength, bool useTxBuffer)
+{
+	std::pair<const uint8_t*, int> buffer(packetData, packetDataLength);
+	bool packetSent = (sendPacketsInner(&buffer, getPacketDataFromBuffer, 1, useTxBuffer) == 1);
+	if (packetSent)
+		LOG_DEBUG("Packet sent successfully. Packet length: %d", packetDataLength);
+	return packetSent;
+}
+
+bool PcapLiveDevice::sendPacket(Packet* packet, bool useTxBuffer)
+{
+	return sendPacketsInner(&packet, getPacketDataFromPacketArray, 1, useTxBuffer) == 1;
+}
+
+int PcapLiveDevice::sendPackets(RawPacket* rawPacketsArr, int arrLength, bool useTxBuffer)
+{
+	int packetsSent = sendPacketsInner(rawPacketsArr, getPacketDataFromRawPacketArray, arrLength, useTxBuffer);
+	LOG_DEBUG("%d packets sent successfully. %d packets not sent", packetsSent, arrLength-packetsSent);
+	return packetsSent;
+}
+
+int PcapLiveDevice::sendPackets(Packet** packetsArr, int arrLength, bool useTxBuffer)
+{
+	int packetsSent = sendPacketsInner(packetsArr, getPacketDataFromPacketArray, arrLength, useTxBuffer);
 	LOG_DEBUG("%d packets sent successfully. %d packets not sent", packetsSent, arrLength-packetsSent);
 	return packetsSent;
 }
 
-int PcapLiveDevice::sendPackets(const RawPacketVector& rawPackets)
+int PcapLiveDevice::sendPackets(const RawPacketVector& rawPackets, bool useTxBuffer)
 {
 	int packetsSent = 0;
-	for (RawPacketVector::ConstVectorIterator iter = rawPackets.begin(); iter != rawPackets.end(); iter++)
+	if (rawPackets.size() > 0)
+		packetsSent = sendPacketsInner(&(*rawPackets.begin()), getPacketDataFromRawPacketPtrArray, (int)rawPackets.size(), useTxBuffer);
+
+	LOG_DEBUG("%d packets sent successfully. %d packets not sent", packetsSent, (int)rawPackets.size()-packetsSent);
+	return packetsSent;
+}
+
+int PcapLiveDevice::sendPackets(const RawPacketSlabVector& rawPackets, bool useTxBuffer)
+{
+	// the slab vector isn't contiguous, so its packets are collected in batches first
+	const RawPacket* batch[PCPP_LIVE_DEVICE_TX_BUFFER_SIZE];
+	int batchSize = 0;
+	int packetsSent = 0;
+	for (RawPacketSlabVector::ConstVectorIterator iter = rawPackets.begin(); iter != rawPackets.end(); iter++)
 	{
-		if (sendPacket(**iter))
-			packetsSent++;
+		batch[batchSize++] = *iter;
+		if (batchSize == PCPP_LIVE_DEVICE_TX_BUFFER_SIZE)
+		{
+			packetsSent += sendPacketsInner(batch, getPacketDataFromRawPacketPtrArray, batchSize, useTxBuffer);
+			batchSize = 0;
+		}
 	}
 
+	if (batchSize > 0)
+		packetsSent += sendPacketsInner(batch, getPacketDataFromRawPacketPtrArray, batchSize, useTxBuffer);
+
 	LOG_DEBUG("%d packets sent successfully. %d packets not sent", packetsSent, (int)rawPackets.size()-packetsSent);
 	return packetsSent;
 }
@@ -625,6 +1492,8 @@ std::string PcapLiveDevice::printThreadId(PcapThread* id)
 
 void PcapLiveDevice::setDeviceMtu()
 {
+	m_DeviceMtuFetched = true;
+
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 
 	if (m_IsLoopback)
@@ -687,6 +1556,8 @@ void PcapLiveDevice::setDeviceMtu()
 
 void PcapLiveDevice::setDeviceMacAddress()
 {
+	m_MacAddressFetched = true;
+
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 
 	LPADAPTER adapter = PacketOpenAdapter((char*)m_Name);
@@ -774,6 +1645,8 @@ void PcapLiveDevice::setDeviceMacAddress()
 
 void PcapLiveDevice::setDefaultGateway()
 {
+	m_DefaultGatewayFetched = true;
+
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 	ULONG outBufLen = sizeof (IP_ADAPTER_INFO);
 	uint8_t* buffer = new uint8_t[outBufLen];
@@ -882,6 +1755,9 @@ IPv4Address PcapLiveDevice::getIPv4Address()
 
 IPv4Address PcapLiveDevice::getDefaultGateway()
 {
+	if (!m_DefaultGatewayFetched)
+		setDefaultGateway();
+
 	return m_DefaultGateway;
 }
 
@@ -903,6 +1779,9 @@ PcapLiveDevice::~PcapLiveDevice()
 		delete [] m_Description;
 	delete m_CaptureThread;
 	delete m_StatsThread;
+	delete [] m_BurstPackets;
+	delete [] m_BurstData;
+	delete [] m_FanoutThreads;
 }
 
 } // namespace pcpp
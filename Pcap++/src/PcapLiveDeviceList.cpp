@@ -18,7 +18,7 @@
 namespace pcpp
 {
 
-PcapLiveDeviceList::PcapLiveDeviceList()
+PcapLiveDeviceList::PcapLiveDeviceList() : m_DnsServersFetched(false)
 {
 	init();
 }
@@ -47,23 +47,24 @@ void PcapLiveDeviceList::init()
 	pcap_if_t* currInterface = interfaceList;
 	while (currInterface != NULL)
 	{
+		// the MTU, MAC address and default gateway are fetched on first access
 #ifdef WIN32
-		PcapLiveDevice* dev = new WinPcapLiveDevice(currInterface, true, true, true);
+		PcapLiveDevice* dev = new WinPcapLiveDevice(currInterface, false, false, false);
 #else //LINUX, MAC_OSX
-		PcapLiveDevice* dev = new PcapLiveDevice(currInterface, true, true, true);
+		PcapLiveDevice* dev = new PcapLiveDevice(currInterface, false, false, false);
 #endif
 		currInterface = currInterface->next;
 		m_LiveDeviceList.insert(m_LiveDeviceList.end(), dev);
 	}
 
-	setDnsServers();
-
 	LOG_DEBUG("Freeing live device data");
 	pcap_freealldevs(interfaceList);
 }
 
 void PcapLiveDeviceList::setDnsServers()
 {
+	m_DnsServersFetched = true;
+
 #if defined(WIN32) || defined(WINx64)
 	FIXED_INFO * fixedInfo;
 	ULONG    ulOutBufLen;
@@ -283,6 +284,9 @@ PcapLiveDevice* PcapLiveDeviceList::getPcapLiveDeviceByIp(IPv6Address ip6Addr)
 
 std::vector<IPv4Address>& PcapLiveDeviceList::getDnsServers()
 {
+	if (!m_DnsServersFetched)
+		setDnsServers();
+
 	return m_DnsServers;
 }
 
@@ -323,6 +327,7 @@ void PcapLiveDeviceList::reset()
 
 	m_LiveDeviceList.clear();
 	m_DnsServers.clear();
+	m_DnsServersFetched = false;
 
 	init();
 }
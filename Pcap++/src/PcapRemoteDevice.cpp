@@ -24,6 +24,10 @@ PcapRemoteDevice::PcapRemoteDevice(pcap_if_t* iface, PcapRemoteAuthentication* r
 {
 	LOG_DEBUG("MTU calculation isn't supported for remote devices. Setting MTU to 1514");
 	m_DeviceMtu = 1514;
+	// none of the attributes can be fetched from the local machine
+	m_DeviceMtuFetched = true;
+	m_MacAddressFetched = true;
+	m_DefaultGatewayFetched = true;
 	m_RemoteMachineIpAddress = remoteMachineIP;
 	m_RemoteMachinePort = remoteMachinePort;
 	m_RemoteAuthentication = remoteAuthentication;
@@ -84,7 +88,19 @@ void* PcapRemoteDevice::remoteDeviceCaptureThreadMain(void *ptr)
 	pcap_pkthdr* pkthdr;
 	const uint8_t* pktData;
 
-	if (pThis->m_CaptureCallbackMode)
+	if (pThis->m_cbOnPacketsArriveBurst != NULL)
+	{
+		// a burst is delivered when it's full or when no packet arrived before the read timeout
+		while (!pThis->m_StopThread)
+		{
+			if (pcap_next_ex(pThis->m_PcapDescriptor, &pkthdr, &pktData) > 0)
+				onPacketArrivesBurstMode((uint8_t*)pThis, pkthdr, pktData);
+			else
+				pThis->deliverBurst();
+		}
+		pThis->deliverBurst();
+	}
+	else if (pThis->m_CaptureCallbackMode)
 	{
 		while (!pThis->m_StopThread)
 		{
@@ -109,6 +125,49 @@ ThreadStart PcapRemoteDevice::getCaptureThreadStart()
 	return &remoteDeviceCaptureThreadMain;
 }
 
+int PcapRemoteDevice::pollPackets(OnPacketsArriveBurstCallback onPacketsArrive, void* onPacketsArriveUserCookie, uint32_t maxBurstSize)
+{
+	if (m_CaptureThreadStarted || m_PcapDescriptor == NULL)
+	{
+		LOG_ERROR("Device '%s' is capturing or not opened", m_Name);
+		return -1;
+	}
+
+	if (onPacketsArrive == NULL || maxBurstSize == 0)
+	{
+		LOG_ERROR("Polling device '%s' needs a callback and a burst size larger than 0", m_Name);
+		return -1;
+	}
+
+	allocateBurstBuffers(maxBurstSize);
+	m_MaxBurstSize = maxBurstSize;
+	m_BurstLen = 0;
+	m_cbOnPacketsArriveBurst = onPacketsArrive;
+	m_cbOnPacketsArriveBurstUserCookie = onPacketsArriveUserCookie;
+
+	pcap_pkthdr* pkthdr;
+	const uint8_t* pktData;
+	int numOfPackets = 0;
+	int result = 0;
+	while ((uint32_t)numOfPackets < maxBurstSize && (result = pcap_next_ex(m_PcapDescriptor, &pkthdr, &pktData)) > 0)
+	{
+		onPacketArrivesBurstMode((uint8_t*)this, pkthdr, pktData);
+		numOfPackets++;
+	}
+	deliverBurst();
+
+	m_cbOnPacketsArriveBurst = NULL;
+	m_cbOnPacketsArriveBurstUserCookie = NULL;
+
+	if (result < 0)
+	{
+		LOG_ERROR("Error polling device '%s': %s", m_Name, pcap_geterr(m_PcapDescriptor));
+		return -1;
+	}
+
+	return numOfPackets;
+}
+
 void PcapRemoteDevice::getStatistics(pcap_stat& stats)
 {
 	int allocatedMemory;
@@ -5,14 +5,26 @@
 #include "PfRingDevice.h"
 #include "EthLayer.h"
 #include "VlanLayer.h"
+#include "IPv4Layer.h"
 #include "Logger.h"
 #include "PlatformSpecificUtils.h"
+#include "TimestampClock.h"
 #include <errno.h>
+#include <sstream>
 #include <pfring.h>
+#include <pfring_zc.h>
 
 
 #define DEFAULT_PF_RING_SNAPLEN 1600
 
+#define MAX_TRIES 5
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PCPP_PF_RING_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PCPP_PF_RING_PREFETCH(addr)
+#endif
+
 namespace pcpp
 {
 
@@ -30,14 +42,28 @@ PfRingDevice::PfRingDevice(const char* deviceName) : m_MacAddress(MacAddress::Ze
 	m_HwClockEnabled = false;
 	m_DeviceMTU = 0;
 	m_IsFilterCurrentlySet = false;
+	m_IsFilterOffloaded = false;
+	m_NumOfFilteringRules = 0;
+	m_IsSamplingSet = false;
+	m_BurstSize = PCPP_PF_RING_DEFAULT_BURST_SIZE;
+	m_RxPrefetchDistance = 0;
+	m_ZcCluster = NULL;
+	m_ZcTxQueue.Queue = NULL;
+	m_ZcTxQueue.PacketHandles = NULL;
+	m_ZcBufferLen = 0;
+	m_NumOfPendingZcTxPackets = 0;
+	m_TxFlushTimeout = PCPP_PF_RING_DEFAULT_TX_FLUSH_TIMEOUT;
 
 	m_PfRingDescriptors = new pfring*[MAX_NUM_RX_CHANNELS];
+	m_TxChannelStates = new TxChannelState[MAX_NUM_RX_CHANNELS];
+	memset(m_TxChannelStates, 0, sizeof(TxChannelState) * MAX_NUM_RX_CHANNELS);
 }
 
 PfRingDevice::~PfRingDevice()
 {
 	close();
 	delete [] m_PfRingDescriptors;
+	delete [] m_TxChannelStates;
 }
 
 
@@ -307,9 +333,144 @@ bool PfRingDevice::openMultiRxChannels(uint8_t numOfRxChannelsToOpen, ChannelDis
 	return true;
 }
 
+bool PfRingDevice::openZeroCopy(const PfRingZcConfiguration& config)
+{
+	if (m_DeviceOpened)
+	{
+		LOG_ERROR("Device already opened");
+		return false;
+	}
+
+	if (config.numOfRxQueues == 0 && !config.openTx)
+	{
+		LOG_ERROR("At least one RX queue or a TX queue must be opened");
+		return false;
+	}
+
+	if (config.burstSize == 0 || config.numOfBuffersPerQueue == 0 || config.bufferLen == 0)
+	{
+		LOG_ERROR("Burst size, number of buffers per queue and buffer length must be larger than 0");
+		return false;
+	}
+
+	// read the MAC address, interface index and MTU through a standard ring before the interface is taken by the ZC cluster
+	setPfRingDeviceAttributes();
+
+	// each queue needs buffers for the NIC ring and for the packet handles the application holds
+	uint32_t numOfQueues = config.numOfRxQueues + (config.openTx ? 1 : 0);
+	uint32_t totalNumOfBuffers = numOfQueues * (config.numOfBuffersPerQueue + config.burstSize);
+
+	int numaNode = getNumaNode();
+	pfring_zc_cluster* cluster = pfring_zc_create_cluster(config.clusterId, config.bufferLen, 0, totalNumOfBuffers, (numaNode < 0 ? 0 : numaNode), NULL, 0);
+	if (cluster == NULL)
+	{
+		LOG_ERROR("Couldn't create ZC cluster %d for device [%s]: %s. Please make sure hugepages are set and no other cluster uses this ID",
+				config.clusterId, m_DeviceName, strerror(errno));
+		return false;
+	}
+
+	m_ZcCluster = cluster;
+	m_ZcBufferLen = config.bufferLen;
+	m_BurstSize = config.burstSize;
+
+	std::string zcDeviceName = "zc:" + getInterfaceName();
+	uint32_t zcFlags = (m_HwClockEnabled ? PF_RING_ZC_DEVICE_HW_TIMESTAMP : PF_RING_ZC_DEVICE_SW_TIMESTAMP);
+
+	for (int i = 0; i < config.numOfRxQueues; i++)
+	{
+		std::stringstream queueName;
+		queueName << zcDeviceName;
+		if (config.numOfRxQueues > 1)
+			queueName << "@" << i;
+
+		ZcQueue rxQueue;
+		rxQueue.Queue = pfring_zc_open_device(cluster, queueName.str().c_str(), rx_only, zcFlags);
+		rxQueue.PacketHandles = NULL;
+		if (rxQueue.Queue == NULL)
+		{
+			LOG_ERROR("Couldn't open ZC RX queue [%s]: %s", queueName.str().c_str(), strerror(errno));
+			closeZeroCopy();
+			return false;
+		}
+
+		m_ZcRxQueues.push_back(rxQueue);
+
+		// the capture thread of this queue swaps these handles with the received buffers on each burst
+		pfring_zc_pkt_buff** packetHandles = new pfring_zc_pkt_buff*[m_BurstSize];
+		m_ZcRxQueues.back().PacketHandles = (void**)packetHandles;
+		for (uint32_t j = 0; j < m_BurstSize; j++)
+		{
+			packetHandles[j] = pfring_zc_get_packet_handle(cluster);
+			if (packetHandles[j] == NULL)
+			{
+				LOG_ERROR("Couldn't get a ZC packet handle for RX queue [%s], there are too few buffers", queueName.str().c_str());
+				closeZeroCopy();
+				return false;
+			}
+		}
+
+		LOG_DEBUG("Opened ZC RX queue [%s]", queueName.str().c_str());
+	}
+
+	if (config.openTx)
+	{
+		std::string queueName = zcDeviceName + (config.numOfRxQueues > 1 ? "@0" : "");
+		m_ZcTxQueue.Queue = pfring_zc_open_device(cluster, queueName.c_str(), tx_only, 0);
+		if (m_ZcTxQueue.Queue == NULL)
+		{
+			LOG_ERROR("Couldn't open ZC TX queue [%s]: %s", queueName.c_str(), strerror(errno));
+			closeZeroCopy();
+			return false;
+		}
+
+		pfring_zc_pkt_buff** packetHandles = new pfring_zc_pkt_buff*[m_BurstSize];
+		m_ZcTxQueue.PacketHandles = (void**)packetHandles;
+		for (uint32_t j = 0; j < m_BurstSize; j++)
+		{
+			packetHandles[j] = pfring_zc_get_packet_handle(cluster);
+			if (packetHandles[j] == NULL)
+			{
+				LOG_ERROR("Couldn't get a ZC packet handle for TX queue [%s], there are too few buffers", queueName.c_str());
+				closeZeroCopy();
+				return false;
+			}
+		}
+
+		LOG_DEBUG("Opened ZC TX queue [%s]", queueName.c_str());
+	}
+
+	m_NumOfOpenedRxChannels = config.numOfRxQueues;
+	m_NumOfPendingZcTxPackets = 0;
+	m_DeviceOpened = true;
+	LOG_DEBUG("Device [%s] opened in ZC mode with %d RX queues in cluster %d", m_DeviceName, (int)config.numOfRxQueues, config.clusterId);
+	return true;
+}
+
+
+void PfRingDevice::closeZeroCopy()
+{
+	// destroying the cluster closes its queues and frees all buffers, including the ones held by the packet handles
+	if (m_ZcCluster != NULL)
+		pfring_zc_destroy_cluster((pfring_zc_cluster*)m_ZcCluster);
+
+	for (size_t i = 0; i < m_ZcRxQueues.size(); i++)
+		delete [] (pfring_zc_pkt_buff**)m_ZcRxQueues[i].PacketHandles;
+	m_ZcRxQueues.clear();
+
+	delete [] (pfring_zc_pkt_buff**)m_ZcTxQueue.PacketHandles;
+	m_ZcTxQueue.Queue = NULL;
+	m_ZcTxQueue.PacketHandles = NULL;
+
+	m_ZcCluster = NULL;
+	m_ZcBufferLen = 0;
+	m_NumOfPendingZcTxPackets = 0;
+	m_BurstSize = PCPP_PF_RING_DEFAULT_BURST_SIZE;
+}
+
+
 uint8_t PfRingDevice::getTotalNumOfRxChannels()
 {
-	if (m_NumOfOpenedRxChannels > 0)
+	if (m_NumOfOpenedRxChannels > 0 && m_ZcCluster == NULL)
 	{
 		uint8_t res = pfring_get_num_rx_channels(m_PfRingDescriptors[0]);
 		return res;
@@ -318,6 +479,11 @@ uint8_t PfRingDevice::getTotalNumOfRxChannels()
 	{
 		uint32_t flags = PF_RING_PROMISC | PF_RING_REENTRANT | PF_RING_HW_TIMESTAMP | PF_RING_DNA_SYMMETRIC_RSS;
 		pfring* ring = pfring_open(m_DeviceName, DEFAULT_PF_RING_SNAPLEN, flags);
+		if (ring == NULL)
+		{
+			LOG_ERROR("Couldn't open a ring on device [%s] to read the number of RX channels", m_DeviceName);
+			return 0;
+		}
 		uint8_t res = pfring_get_num_rx_channels(ring);
 		pfring_close(ring);
 		return res;
@@ -331,6 +497,169 @@ SystemCore PfRingDevice::getCurrentCoreId()
 }
 
 
+// convert a flow rule to a PF_RING filtering rule. PF_RING rules compare the addresses and ports the kernel module parsed in host byte
+// order, treat a zero protocol, address or port as "any" and can't match the EtherType alone, so rules which need that aren't converted
+static bool convertToPfRingRule(const FilterFlowRule& rule, filtering_rule& pfRingRule)
+{
+	bool hasIPv4Address = (rule.srcIPv4Mask != 0 || rule.dstIPv4Mask != 0);
+	if (rule.etherTypeMask != 0 && !(rule.etherTypeMask == 0xffff && rule.etherType == PCPP_ETHERTYPE_IP && hasIPv4Address))
+		return false;
+
+	if (rule.ipProtocolMask != 0)
+	{
+		if (rule.ipProtocolMask != 0xff || rule.ipProtocol == 0)
+			return false;
+		pfRingRule.core_fields.proto = rule.ipProtocol;
+	}
+
+	pfRingRule.core_fields.shost.v4 = ntohl(rule.srcIPv4Address & rule.srcIPv4Mask);
+	pfRingRule.core_fields.shost_mask.v4 = ntohl(rule.srcIPv4Mask);
+	pfRingRule.core_fields.dhost.v4 = ntohl(rule.dstIPv4Address & rule.dstIPv4Mask);
+	pfRingRule.core_fields.dhost_mask.v4 = ntohl(rule.dstIPv4Mask);
+
+	// PF_RING parses the ports of TCP and UDP only
+	if (rule.srcPortMask != 0 || rule.dstPortMask != 0)
+	{
+		if (rule.ipProtocolMask == 0 || (rule.ipProtocol != PACKETPP_IPPROTO_TCP && rule.ipProtocol != PACKETPP_IPPROTO_UDP))
+			return false;
+	}
+
+	if (rule.srcPortMask != 0)
+	{
+		if (rule.srcPortMask != 0xffff || rule.srcPort == 0)
+			return false;
+		pfRingRule.core_fields.sport_low = rule.srcPort;
+		pfRingRule.core_fields.sport_high = rule.srcPort;
+	}
+
+	if (rule.dstPortMask != 0)
+	{
+		if (rule.dstPortMask != 0xffff || rule.dstPort == 0)
+			return false;
+		pfRingRule.core_fields.dport_low = rule.dstPort;
+		pfRingRule.core_fields.dport_high = rule.dstPort;
+	}
+
+	return true;
+}
+
+
+bool PfRingDevice::setFilteringRules(const std::vector<FilterFlowRule>& rules)
+{
+	std::vector<filtering_rule> pfRingRules;
+	for (std::vector<FilterFlowRule>::const_iterator rule = rules.begin(); rule != rules.end(); ++rule)
+	{
+		// a rule matching an IP protocol with an EtherType which isn't IP matches no packet
+		bool isIpRule = (rule->ipProtocolMask != 0 || rule->srcPortMask != 0 || rule->dstPortMask != 0);
+		if (isIpRule && rule->etherTypeMask != 0 &&
+				!(rule->etherTypeMask == 0xffff && (rule->etherType == PCPP_ETHERTYPE_IP || rule->etherType == PCPP_ETHERTYPE_IPV6)))
+			continue;
+
+		filtering_rule pfRingRule;
+		memset(&pfRingRule, 0, sizeof(pfRingRule));
+		// rules are evaluated by ascending ID
+		pfRingRule.rule_id = (uint16_t)(pfRingRules.size() + 1);
+		pfRingRule.rule_action = forward_packet_and_stop_rule_evaluation;
+		if (!convertToPfRingRule(*rule, pfRingRule))
+			return false;
+
+		pfRingRules.push_back(pfRingRule);
+	}
+
+	m_NumOfFilteringRules = (uint16_t)pfRingRules.size();
+	for (int i = 0; i < m_NumOfOpenedRxChannels; i++)
+	{
+		for (size_t j = 0; j < pfRingRules.size(); j++)
+		{
+			if (pfring_add_filtering_rule(m_PfRingDescriptors[i], &pfRingRules[j]) < 0)
+			{
+				LOG_DEBUG("Couldn't add filtering rule #%d to RX channel #%d", (int)pfRingRules[j].rule_id, i);
+				removeFilteringRules();
+				return false;
+			}
+		}
+
+		// packets which don't match any rule are dropped
+		if (pfring_toggle_filtering_policy(m_PfRingDescriptors[i], 0) < 0)
+		{
+			LOG_DEBUG("Couldn't set the filtering policy of RX channel #%d", i);
+			removeFilteringRules();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool PfRingDevice::removeFilteringRules()
+{
+	bool result = true;
+	for (int i = 0; i < m_NumOfOpenedRxChannels; i++)
+	{
+		// rules which weren't added to the channel are ignored
+		for (uint16_t ruleId = 1; ruleId <= m_NumOfFilteringRules; ruleId++)
+			pfring_remove_filtering_rule(m_PfRingDescriptors[i], ruleId);
+
+		if (pfring_toggle_filtering_policy(m_PfRingDescriptors[i], 1) < 0)
+		{
+			LOG_ERROR("Couldn't reset the filtering policy of RX channel #%d", i);
+			result = false;
+		}
+	}
+
+	m_NumOfFilteringRules = 0;
+	return result;
+}
+
+
+bool PfRingDevice::setFilter(GeneralFilter& filter)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device not opened");
+		return false;
+	}
+
+	std::string filterAsString;
+	filter.parseToString(filterAsString);
+
+	// PF_RING filtering rules are set on standard rings, in ZC mode packets are filtered natively
+	std::vector<FilterFlowRule> rules;
+	if (m_ZcCluster == NULL && filter.toFlowRules(rules))
+	{
+		if (!clearFilter())
+			return false;
+
+		if (setFilteringRules(rules))
+		{
+			m_IsFilterCurrentlySet = true;
+			m_IsFilterOffloaded = true;
+			LOG_DEBUG("Successfully set filter '%s' as %d PF_RING filtering rules", filterAsString.c_str(), (int)m_NumOfFilteringRules);
+			return true;
+		}
+
+		LOG_DEBUG("Filter '%s' can't be set as PF_RING filtering rules", filterAsString.c_str());
+	}
+
+	// the capture threads read the native filter without locking, so it's set only while they aren't running
+	NativeFilterProgram nativeFilter;
+	if (m_StopThread && nativeFilter.compile(filter))
+	{
+		if (!clearFilter())
+			return false;
+
+		m_NativeFilter = nativeFilter;
+		m_IsFilterCurrentlySet = true;
+		LOG_DEBUG("Successfully set filter '%s' as a native filter of %d predicates", filterAsString.c_str(), (int)m_NativeFilter.getNumOfPredicates());
+		return true;
+	}
+
+	LOG_DEBUG("Setting filter '%s' as a BPF filter", filterAsString.c_str());
+	return setFilter(filterAsString);
+}
+
+
 bool PfRingDevice::setFilter(std::string filterAsString)
 {
 	if (!m_DeviceOpened)
@@ -339,6 +668,15 @@ bool PfRingDevice::setFilter(std::string filterAsString)
 		return false;
 	}
 
+	if (m_ZcCluster != NULL)
+	{
+		LOG_ERROR("BPF filters aren't supported in ZC mode, only filters which can be matched natively");
+		return false;
+	}
+
+	if ((m_IsFilterOffloaded || m_NativeFilter.isCompiled()) && !clearFilter())
+		return false;
+
 	for (int i = 0; i < m_NumOfOpenedRxChannels; i++)
 	{
 		int res = pfring_set_bpf_filter(m_PfRingDescriptors[i], (char*)filterAsString.c_str());
@@ -364,6 +702,31 @@ bool PfRingDevice::clearFilter()
 	if (!m_IsFilterCurrentlySet)
 		return true;
 
+	if (m_IsFilterOffloaded)
+	{
+		if (!removeFilteringRules())
+			return false;
+
+		m_IsFilterCurrentlySet = false;
+		m_IsFilterOffloaded = false;
+		LOG_DEBUG("Successfully removed filtering rules from all open RX channels");
+		return true;
+	}
+
+	if (m_NativeFilter.isCompiled())
+	{
+		if (!m_StopThread)
+		{
+			LOG_ERROR("Cannot remove a native filter while capturing");
+			return false;
+		}
+
+		m_NativeFilter.clear();
+		m_IsFilterCurrentlySet = false;
+		LOG_DEBUG("Successfully removed native filter");
+		return true;
+	}
+
 	for (int i = 0; i < m_NumOfOpenedRxChannels; i++)
 	{
 		int res = pfring_remove_bpf_filter(m_PfRingDescriptors[i]);
@@ -387,14 +750,88 @@ bool PfRingDevice::isFilterCurrentlySet()
 }
 
 
+bool PfRingDevice::setSampling(const PacketSamplerConfiguration& config)
+{
+	if (!m_StopThread)
+	{
+		LOG_ERROR("Cannot set sampling while capturing");
+		return false;
+	}
+
+	m_SamplingConfig = config;
+	m_IsSamplingSet = true;
+	LOG_DEBUG("Sampling set on device [%s]", m_DeviceName);
+	return true;
+}
+
+
+bool PfRingDevice::clearSampling()
+{
+	if (!m_StopThread)
+	{
+		LOG_ERROR("Cannot remove sampling while capturing");
+		return false;
+	}
+
+	m_SamplingConfig = PacketSamplerConfiguration();
+	m_IsSamplingSet = false;
+	return true;
+}
+
+
+void PfRingDevice::getSamplingStats(uint64_t& numOfPackets, uint64_t& numOfSampledPackets) const
+{
+	numOfPackets = 0;
+	numOfSampledPackets = 0;
+	for (int coreId = 0; coreId < MAX_NUM_OF_CORES; coreId++)
+	{
+		if (!m_CoreConfiguration[coreId].IsInUse)
+			continue;
+
+		numOfPackets += m_CoreConfiguration[coreId].Sampler.getNumOfPackets();
+		numOfSampledPackets += m_CoreConfiguration[coreId].Sampler.getNumOfSampledPackets();
+	}
+}
+
+
+bool PfRingDevice::setRxPrefetchDistance(uint32_t prefetchDistance)
+{
+	if (!m_StopThread)
+	{
+		LOG_ERROR("Cannot change RX prefetch distance while capturing");
+		return false;
+	}
+
+	m_RxPrefetchDistance = prefetchDistance;
+	return true;
+}
+
+
 void PfRingDevice::close()
 {
-	for (int i = 0; i < m_NumOfOpenedRxChannels; i++)
-		pfring_close(m_PfRingDescriptors[i]);
+	if (m_ZcCluster != NULL)
+	{
+		if (m_NumOfPendingZcTxPackets > 0)
+			flushZeroCopyTx();
+		closeZeroCopy();
+	}
+	else
+	{
+		for (int i = 0; i < m_NumOfOpenedRxChannels; i++)
+		{
+			if (m_TxChannelStates[i].NumOfPendingPackets > 0)
+				pfring_flush_tx_packets(m_PfRingDescriptors[i]);
+			pfring_close(m_PfRingDescriptors[i]);
+		}
+		memset(m_TxChannelStates, 0, sizeof(TxChannelState) * MAX_NUM_RX_CHANNELS);
+	}
 	m_DeviceOpened = false;
 	clearCoreConfiguration();
 	m_NumOfOpenedRxChannels = 0;
+	m_NativeFilter.clear();
 	m_IsFilterCurrentlySet = false;
+	m_IsFilterOffloaded = false;
+	m_NumOfFilteringRules = 0;
 	LOG_DEBUG("Device [%s] closed", m_DeviceName);
 }
 
@@ -455,7 +892,10 @@ bool PfRingDevice::startCaptureMultiThread(OnPfRingPacketsArriveCallback onPacke
 		m_OnPacketsArriveUserCookie = onPacketsArriveUserCookie;
 
 		// create a new thread
-		m_CoreConfiguration[coreId].Channel = m_PfRingDescriptors[rxChannel++];
+		if (m_ZcCluster != NULL)
+			m_CoreConfiguration[coreId].ZcQueueIndex = rxChannel++;
+		else
+			m_CoreConfiguration[coreId].Channel = m_PfRingDescriptors[rxChannel++];
 		int err = pthread_create(&(m_CoreConfiguration[coreId].RxThread), NULL, captureThreadMain, (void*)this);
 		if (err != 0)
 		{
@@ -480,6 +920,33 @@ bool PfRingDevice::startCaptureMultiThread(OnPfRingPacketsArriveCallback onPacke
 	return true;
 }
 
+bool PfRingDevice::startCaptureMultiThread(OnPfRingPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie)
+{
+	int numaNode = getNumaNode();
+	CoreMask coreMask = selectNumaLocalCores(numaNode, m_NumOfOpenedRxChannels);
+	LOG_DEBUG("Selected core mask 0x%X for %d RX channels of device [%s] on NUMA node %d", coreMask, m_NumOfOpenedRxChannels, m_DeviceName, numaNode);
+	return startCaptureMultiThread(onPacketsArrive, onPacketsArriveUserCookie, coreMask);
+}
+
+std::string PfRingDevice::getInterfaceName()
+{
+	// strip the ZC prefix and the channel suffix from the device name to get the interface name ("zc:eth1@2" -> "eth1")
+	std::string interfaceName(m_DeviceName);
+	if (interfaceName.compare(0, 3, "zc:") == 0)
+		interfaceName = interfaceName.substr(3);
+
+	size_t channelPos = interfaceName.find('@');
+	if (channelPos != std::string::npos)
+		interfaceName = interfaceName.substr(0, channelPos);
+
+	return interfaceName;
+}
+
+int PfRingDevice::getNumaNode()
+{
+	return getNetworkInterfaceNumaNode(getInterfaceName());
+}
+
 bool PfRingDevice::startCaptureSingleThread(OnPfRingPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie)
 {
 	if (!m_StopThread)
@@ -521,7 +988,10 @@ bool PfRingDevice::startCaptureSingleThread(OnPfRingPacketsArriveCallback onPack
         if (CPU_ISSET(i, &cpuset))
         {
         	m_CoreConfiguration[i].IsInUse = true;
-        	m_CoreConfiguration[i].Channel = m_PfRingDescriptors[0];
+        	if (m_ZcCluster != NULL)
+        		m_CoreConfiguration[i].ZcQueueIndex = 0;
+        	else
+        		m_CoreConfiguration[i].Channel = m_PfRingDescriptors[0];
         	m_CoreConfiguration[i].RxThread = newThread;
         	m_CoreConfiguration[i].IsAffinitySet = false;
         }
@@ -554,6 +1024,16 @@ void* PfRingDevice::captureThreadMain(void *ptr)
 
 	LOG_DEBUG("Starting capture thread %d", coreId);
 
+	PacketSampler& sampler = device->m_CoreConfiguration[coreId].Sampler;
+	sampler.setConfiguration(device->m_IsSamplingSet ? device->m_SamplingConfig.divide(device->m_NumOfOpenedRxChannels) : PacketSamplerConfiguration());
+
+	if (device->m_ZcCluster != NULL)
+	{
+		device->captureZeroCopy(coreId);
+		LOG_DEBUG("Exiting capture thread %d", coreId);
+		return (void*)NULL;
+	}
+
 	ring = device->m_CoreConfiguration[coreId].Channel;
 
 	if (ring == NULL)
@@ -562,21 +1042,22 @@ void* PfRingDevice::captureThreadMain(void *ptr)
 		return (void*)NULL;
 	}
 
+	// in multi-threaded mode flag PF_RING_REENTRANT is set, and this flag doesn't work with zero copy
+	// so the packets are copied anyway, and they're copied to a burst of buffers which is delivered at once
+	if (device->m_ReentrantMode)
+	{
+		device->captureBursts(ring, coreId);
+		LOG_DEBUG("Exiting capture thread %d", coreId);
+		return (void*)NULL;
+	}
+
 	while (!device->m_StopThread)
 	{
-		// if buffer is NULL PF_RING avoids copy of the data
+		// if buffer is NULL PF_RING avoids copy of the data. The data is valid only until the next pfring_recv call, so packets
+		// are delivered one by one
 		uint8_t* buffer = NULL;
 		uint32_t bufferLen = 0;
 
-		// in multi-threaded mode flag PF_RING_REENTRANT is set, and this flag doesn't work with zero copy
-		// so I need to allocate a buffer and set buffer to point to it
-		if (device->m_ReentrantMode)
-		{
-			uint8_t tempBuffer[PCPP_MAX_PACKET_SIZE];
-			buffer = tempBuffer;
-			bufferLen = PCPP_MAX_PACKET_SIZE;
-		}
-
 		struct pfring_pkthdr pktHdr;
 		int recvRes = pfring_recv(ring, &buffer, bufferLen, &pktHdr, 0);
 		if (recvRes > 0)
@@ -589,6 +1070,12 @@ void* PfRingDevice::captureThreadMain(void *ptr)
 //				continue;
 //			}
 
+			if (device->m_NativeFilter.isCompiled() && !device->m_NativeFilter.matchPacket(buffer, pktHdr.caplen))
+				continue;
+
+			if (sampler.isEnabled() && !sampler.samplePacket(buffer, pktHdr.caplen, LINKTYPE_ETHERNET, TimestampClock::toNs(pktHdr.ts)))
+				continue;
+
 			RawPacket rawPacket(buffer, pktHdr.caplen, pktHdr.ts, false);
 			device->m_OnPacketsArriveCallback(&rawPacket, 1, coreId, device, device->m_OnPacketsArriveUserCookie);
 		}
@@ -602,11 +1089,143 @@ void* PfRingDevice::captureThreadMain(void *ptr)
 	return (void*)NULL;
 }
 
+void PfRingDevice::captureBursts(pfring* ring, int coreId)
+{
+	// the ring is opened with a snaplen of DEFAULT_PF_RING_SNAPLEN so no packet is longer than that
+	uint8_t* buffers = new uint8_t[m_BurstSize * DEFAULT_PF_RING_SNAPLEN];
+	RawPacket* rawPackets = new RawPacket[m_BurstSize];
+	PacketSampler& sampler = m_CoreConfiguration[coreId].Sampler;
+
+	while (!m_StopThread)
+	{
+		uint32_t numOfPackets = 0;
+		while (numOfPackets < m_BurstSize)
+		{
+			uint8_t* buffer = buffers + numOfPackets * DEFAULT_PF_RING_SNAPLEN;
+			struct pfring_pkthdr pktHdr;
+			int recvRes = pfring_recv(ring, &buffer, DEFAULT_PF_RING_SNAPLEN, &pktHdr, 0);
+			if (recvRes <= 0)
+			{
+				if (recvRes < 0)
+					LOG_ERROR("pfring_recv returned an error: [Err=%d]", recvRes);
+				break;
+			}
+
+			int capLen = (pktHdr.caplen < DEFAULT_PF_RING_SNAPLEN ? (int)pktHdr.caplen : DEFAULT_PF_RING_SNAPLEN);
+			if (m_NativeFilter.isCompiled() && !m_NativeFilter.matchPacket(buffer, capLen))
+				continue;
+
+			if (sampler.isEnabled() && !sampler.samplePacket(buffer, capLen, LINKTYPE_ETHERNET, TimestampClock::toNs(pktHdr.ts)))
+				continue;
+
+			timespec timestamp;
+			timestamp.tv_sec = pktHdr.ts.tv_sec;
+			timestamp.tv_nsec = pktHdr.ts.tv_usec * 1000;
+			rawPackets[numOfPackets].setExternalRawData(buffer, capLen, timestamp, LINKTYPE_ETHERNET, (int)pktHdr.len);
+			numOfPackets++;
+		}
+
+		// deliver what was received as soon as the ring is empty rather than waiting for a full burst
+		if (numOfPackets > 0)
+			m_OnPacketsArriveCallback(rawPackets, numOfPackets, coreId, this, m_OnPacketsArriveUserCookie);
+	}
+
+	delete [] rawPackets;
+	delete [] buffers;
+}
+
+void PfRingDevice::captureZeroCopy(int coreId)
+{
+	int queueIndex = m_CoreConfiguration[coreId].ZcQueueIndex;
+	if (queueIndex < 0 || queueIndex >= (int)m_ZcRxQueues.size())
+	{
+		LOG_ERROR("Couldn't find ZC queue for core %d. Exiting capture thread", coreId);
+		return;
+	}
+
+	pfring_zc_queue* queue = (pfring_zc_queue*)m_ZcRxQueues[queueIndex].Queue;
+	pfring_zc_pkt_buff** packetHandles = (pfring_zc_pkt_buff**)m_ZcRxQueues[queueIndex].PacketHandles;
+	RawPacket* rawPackets = new RawPacket[m_BurstSize];
+	PacketSampler& sampler = m_CoreConfiguration[coreId].Sampler;
+	int prefetchDistance = (int)m_RxPrefetchDistance;
+
+	while (!m_StopThread)
+	{
+		// the received buffers are swapped into the handles, and the buffers the handles held before go back to the NIC ring. So the
+		// packets point to the buffers until the next burst is received
+		int recvRes = pfring_zc_recv_pkt_burst(queue, packetHandles, m_BurstSize, 0);
+		if (recvRes <= 0)
+		{
+			if (recvRes < 0)
+				LOG_ERROR("pfring_zc_recv_pkt_burst returned an error: [Err=%d]", recvRes);
+			continue;
+		}
+
+		// packet timestamps are set only if the NIC supports them, so the rate cap of the sampler uses the time of the burst
+		uint64_t burstTimeNs = (sampler.isEnabled() ? TimestampClock::nowNs() : 0);
+
+		// the data address is calculated from the buffer handle, so handles are fetched twice the distance ahead and the data once the
+		// distance ahead
+		if (prefetchDistance > 0)
+		{
+			for (int i = 0; i < 2 * prefetchDistance && i < recvRes; i++)
+				PCPP_PF_RING_PREFETCH(packetHandles[i]);
+			for (int i = 0; i < prefetchDistance && i < recvRes; i++)
+				PCPP_PF_RING_PREFETCH(pfring_zc_pkt_buff_data(packetHandles[i], queue));
+		}
+
+		uint32_t numOfPackets = 0;
+		for (int i = 0; i < recvRes; i++)
+		{
+			if (prefetchDistance > 0)
+			{
+				if (i + 2 * prefetchDistance < recvRes)
+					PCPP_PF_RING_PREFETCH(packetHandles[i + 2 * prefetchDistance]);
+				if (i + prefetchDistance < recvRes)
+					PCPP_PF_RING_PREFETCH(pfring_zc_pkt_buff_data(packetHandles[i + prefetchDistance], queue));
+			}
+
+			const uint8_t* data = pfring_zc_pkt_buff_data(packetHandles[i], queue);
+			int dataLen = packetHandles[i]->len;
+			if (m_NativeFilter.isCompiled() && !m_NativeFilter.matchPacket(data, dataLen))
+				continue;
+
+			if (sampler.isEnabled() && !sampler.samplePacket(data, dataLen, LINKTYPE_ETHERNET, burstTimeNs, packetHandles[i]->hash != 0, packetHandles[i]->hash))
+				continue;
+
+			timespec timestamp;
+			timestamp.tv_sec = packetHandles[i]->ts.tv_sec;
+			timestamp.tv_nsec = packetHandles[i]->ts.tv_nsec;
+			rawPackets[numOfPackets].setExternalRawData(data, dataLen, timestamp, LINKTYPE_ETHERNET);
+			numOfPackets++;
+		}
+
+		if (numOfPackets > 0)
+			m_OnPacketsArriveCallback(rawPackets, numOfPackets, coreId, this, m_OnPacketsArriveUserCookie);
+	}
+
+	delete [] rawPackets;
+}
+
 void PfRingDevice::getThreadStatistics(SystemCore core, PfRingStats& stats)
 {
 	pfring* ring = NULL;
 	uint8_t coreId = core.Id;
 
+	int zcQueueIndex = m_CoreConfiguration[coreId].ZcQueueIndex;
+	if (m_ZcCluster != NULL && zcQueueIndex >= 0 && zcQueueIndex < (int)m_ZcRxQueues.size())
+	{
+		pfring_zc_stat zcStats;
+		if (pfring_zc_stats((pfring_zc_queue*)m_ZcRxQueues[zcQueueIndex].Queue, &zcStats) < 0)
+		{
+			LOG_ERROR("Can't retrieve statistics for core [%d], pfring_zc_stats failed", coreId);
+			return;
+		}
+		stats.drop = (uint64_t)zcStats.drop;
+		stats.recv = (uint64_t)zcStats.recv;
+		return;
+	}
+
 	ring = m_CoreConfiguration[coreId].Channel;
 
 	if (ring != NULL)
@@ -651,6 +1270,17 @@ void PfRingDevice::getStatistics(PfRingStats& stats)
 	}
 }
 
+void PfRingDevice::collectMetrics(MetricsWriter& writer)
+{
+	if (!m_DeviceOpened)
+		return;
+
+	PfRingStats stats;
+	getStatistics(stats);
+	writer.addCounter("pcpp_device_rx_packets_total", "Packets received by the device", stats.recv);
+	writer.addCounter("pcpp_device_rx_dropped_packets_total", "Packets dropped by the device", stats.drop);
+}
+
 void PfRingDevice::clearCoreConfiguration()
 {
 	for (int i = 0; i < MAX_NUM_OF_CORES; i++)
@@ -674,7 +1304,7 @@ void PfRingDevice::setPfRingDeviceAttributes()
 
 	pfring* ring = NULL;
 	bool closeRing = false;
-	if (m_NumOfOpenedRxChannels > 0)
+	if (m_NumOfOpenedRxChannels > 0 && m_ZcCluster == NULL)
 		ring = m_PfRingDescriptors[0];
 	else
 	{
@@ -731,20 +1361,26 @@ bool PfRingDevice::sendData(const uint8_t* packetData, int packetDataLength, boo
 		return false;
 	}
 
-	uint8_t flushTxAsUint = (flushTxQueues? 1 : 0);
+	if (m_ZcCluster != NULL)
+		return sendDataZeroCopy(packetData, packetDataLength, flushTxQueues);
+
+	// don't allow sending of data larger than the MTU, otherwise pfring_send will fail
+	if (packetDataLength > m_DeviceMTU)
+		packetDataLength = m_DeviceMTU;
+
+	// if the device is opened, m_PfRingDescriptors[0] will always be set and enables
+	return sendDataOnRing(m_PfRingDescriptors[0], packetData, packetDataLength, flushTxQueues);
+}
 
-	#define MAX_TRIES 5
+bool PfRingDevice::sendDataOnRing(pfring* ring, const uint8_t* packetData, int packetDataLength, bool flushTxQueues)
+{
+	uint8_t flushTxAsUint = (flushTxQueues? 1 : 0);
 
 	int tries = 0;
 	int res = 0;
 	while (tries < MAX_TRIES)
 	{
-		// don't allow sending of data larger than the MTU, otherwise pfring_send will fail
-		if (packetDataLength > m_DeviceMTU)
-			packetDataLength = m_DeviceMTU;
-
-		// if the device is opened, m_PfRingDescriptors[0] will always be set and enables
-		res = pfring_send(m_PfRingDescriptors[0], (char*)packetData, packetDataLength, flushTxAsUint);
+		res = pfring_send(ring, (char*)packetData, packetDataLength, flushTxAsUint);
 
 		// res == -1 means it's an error coming from "sendto" which is the Linux API PF_RING is using to send packets
 		// errno == ENOBUFS means write buffer is full. PF_RING driver expects the userspace to handle this case
@@ -782,6 +1418,187 @@ bool PfRingDevice::sendData(const uint8_t* packetData, int packetDataLength, boo
 	return true;
 }
 
+static void getPacketDataFromRawPacketArray(const void* packetStorage, int index, const uint8_t*& packetData, int& packetDataLength)
+{
+	const RawPacket& rawPacket = ((const RawPacket*)packetStorage)[index];
+	packetData = rawPacket.getRawDataReadOnly();
+	packetDataLength = rawPacket.getRawDataLen();
+}
+
+static void getPacketDataFromPacketArray(const void* packetStorage, int index, const uint8_t*& packetData, int& packetDataLength)
+{
+	const RawPacket* rawPacket = ((const Packet* const*)packetStorage)[index]->getRawPacketReadOnly();
+	packetData = rawPacket->getRawDataReadOnly();
+	packetDataLength = rawPacket->getRawDataLen();
+}
+
+int PfRingDevice::sendPacketsOnChannel(const void* packetStorage, PacketDataIterator iter, int arrLength, uint8_t channelId, bool flushTxQueue)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device is not opened. Cannot send packets");
+		return 0;
+	}
+
+	if (m_ZcCluster != NULL)
+	{
+		LOG_ERROR("Sending through a specific channel isn't supported in ZC mode");
+		return 0;
+	}
+
+	if (channelId >= m_NumOfOpenedRxChannels)
+	{
+		LOG_ERROR("Channel %d isn't opened, only %d channels are opened", (int)channelId, (int)m_NumOfOpenedRxChannels);
+		return 0;
+	}
+
+	pfring* ring = m_PfRingDescriptors[channelId];
+	TxChannelState& state = m_TxChannelStates[channelId];
+	int mtu = getMtu();
+
+	int packetsSent = 0;
+	for (int i = 0; i < arrLength; i++)
+	{
+		const uint8_t* packetData = NULL;
+		int packetDataLength = 0;
+		iter(packetStorage, i, packetData, packetDataLength);
+
+		if (packetDataLength > mtu)
+		{
+			LOG_ERROR("Packet #%d is %d bytes long, which is larger than the MTU (%d bytes)", i, packetDataLength, mtu);
+			break;
+		}
+
+		if (!sendDataOnRing(ring, packetData, packetDataLength, false))
+			break;
+
+		packetsSent++;
+	}
+
+	state.NumOfPendingPackets += (uint32_t)packetsSent;
+
+	// flush at the end of the batch if asked, or if packets of earlier batches waited longer than the timeout
+	if (flushTxQueue)
+		this->flushTxQueue(channelId, false);
+	else if (state.NumOfPendingPackets > 0)
+		this->flushTxQueue(channelId, true);
+
+	LOG_DEBUG("%d out of %d packets were sent successfully through channel %d", packetsSent, arrLength, (int)channelId);
+
+	return packetsSent;
+}
+
+int PfRingDevice::sendPackets(const RawPacket* rawPacketsArr, int arrLength, uint8_t channelId, bool flushTxQueue)
+{
+	return sendPacketsOnChannel(rawPacketsArr, getPacketDataFromRawPacketArray, arrLength, channelId, flushTxQueue);
+}
+
+int PfRingDevice::sendPackets(const Packet** packetsArr, int arrLength, uint8_t channelId, bool flushTxQueue)
+{
+	return sendPacketsOnChannel(packetsArr, getPacketDataFromPacketArray, arrLength, channelId, flushTxQueue);
+}
+
+bool PfRingDevice::flushTxQueue(uint8_t channelId, bool flushOnlyIfTimeoutExpired)
+{
+	if (!m_DeviceOpened || m_ZcCluster != NULL || channelId >= m_NumOfOpenedRxChannels)
+	{
+		LOG_ERROR("Channel %d isn't opened in standard mode, cannot flush its TX queue", (int)channelId);
+		return false;
+	}
+
+	TxChannelState& state = m_TxChannelStates[channelId];
+	uint64_t now = TimestampClock::nowNs();
+	if (flushOnlyIfTimeoutExpired && now - state.LastFlushNs < (uint64_t)m_TxFlushTimeout * 1000)
+		return false;
+
+	state.LastFlushNs = now;
+	if (state.NumOfPendingPackets == 0)
+		return true;
+
+	// The following method isn't supported in PF_RING aware drivers, probably only in DNA and ZC
+	pfring_flush_tx_packets(m_PfRingDescriptors[channelId]);
+	state.NumOfPendingPackets = 0;
+	return true;
+}
+
+bool PfRingDevice::sendDataZeroCopy(const uint8_t* packetData, int packetDataLength, bool flushTxQueues)
+{
+	if (m_ZcTxQueue.Queue == NULL)
+	{
+		LOG_ERROR("Device was opened in ZC mode without a TX queue. Cannot send packets");
+		return false;
+	}
+
+	if (packetDataLength <= 0 || (uint32_t)packetDataLength > m_ZcBufferLen)
+	{
+		LOG_ERROR("Cannot send a packet of %d bytes, ZC buffers are %d bytes long", packetDataLength, (int)m_ZcBufferLen);
+		return false;
+	}
+
+	// make room for the packet if a full burst is pending
+	if (m_NumOfPendingZcTxPackets == m_BurstSize && flushZeroCopyTx() > 0)
+		return false;
+
+	pfring_zc_pkt_buff* packetHandle = ((pfring_zc_pkt_buff**)m_ZcTxQueue.PacketHandles)[m_NumOfPendingZcTxPackets];
+	memcpy(pfring_zc_pkt_buff_data(packetHandle, (pfring_zc_queue*)m_ZcTxQueue.Queue), packetData, packetDataLength);
+	packetHandle->len = (uint16_t)packetDataLength;
+	m_NumOfPendingZcTxPackets++;
+
+	if (flushTxQueues || m_NumOfPendingZcTxPackets == m_BurstSize)
+		return flushZeroCopyTx() == 0;
+
+	return true;
+}
+
+uint32_t PfRingDevice::flushZeroCopyTx()
+{
+	pfring_zc_queue* queue = (pfring_zc_queue*)m_ZcTxQueue.Queue;
+	pfring_zc_pkt_buff** packetHandles = (pfring_zc_pkt_buff**)m_ZcTxQueue.PacketHandles;
+
+	// the buffers of the sent packets are swapped with free buffers, so the handles can be filled again right away
+	uint32_t numOfPacketsSent = 0;
+	int tries = 0;
+	while (numOfPacketsSent < m_NumOfPendingZcTxPackets && tries < MAX_TRIES)
+	{
+		int res = pfring_zc_send_pkt_burst(queue, packetHandles + numOfPacketsSent, m_NumOfPendingZcTxPackets - numOfPacketsSent, 1);
+		if (res < 0)
+		{
+			LOG_ERROR("pfring_zc_send_pkt_burst returned an error: [Err=%d]", res);
+			break;
+		}
+
+		if (res == 0)
+		{
+			tries++;
+			LOG_DEBUG("Try #%d: ZC TX queue is full. Sleeping 20 usec and trying again", tries);
+			usleep(20);
+		}
+
+		numOfPacketsSent += (uint32_t)res;
+	}
+
+	uint32_t numOfPacketsNotSent = m_NumOfPendingZcTxPackets - numOfPacketsSent;
+	if (numOfPacketsNotSent > 0)
+		LOG_ERROR("Couldn't send %d out of %d packets queued for the ZC TX queue", (int)numOfPacketsNotSent, (int)m_NumOfPendingZcTxPackets);
+
+	m_NumOfPendingZcTxPackets = 0;
+	return numOfPacketsNotSent;
+}
+
+uint32_t PfRingDevice::flushTxQueues()
+{
+	if (m_ZcCluster != NULL)
+	{
+		if (m_ZcTxQueue.Queue == NULL || m_NumOfPendingZcTxPackets == 0)
+			return 0;
+		return flushZeroCopyTx();
+	}
+
+	// The following method isn't supported in PF_RING aware drivers, probably only in DNA and ZC
+	pfring_flush_tx_packets(m_PfRingDescriptors[0]);
+	return 0;
+}
+
 bool PfRingDevice::sendPacket(const uint8_t* packetData, int packetDataLength)
 {
 	return sendData(packetData, packetDataLength, true);
@@ -811,8 +1628,8 @@ int PfRingDevice::sendPackets(const RawPacket* rawPacketsArr, int arrLength)
 			packetsSent++;
 	}
 
-	// The following method isn't supported in PF_RING aware drivers, probably only in DNA and ZC
-	pfring_flush_tx_packets(m_PfRingDescriptors[0]);
+	// packets still queued in ZC mode are sent now, the ones which couldn't be sent aren't counted
+	packetsSent -= (int)flushTxQueues();
 
 	LOG_DEBUG("%d out of %d raw packets were sent successfully", packetsSent, arrLength);
 
@@ -830,8 +1647,8 @@ int PfRingDevice::sendPackets(const Packet** packetsArr, int arrLength)
 			packetsSent++;
 	}
 
-	// The following method isn't supported in PF_RING aware drivers, probably only in DNA and ZC
-	pfring_flush_tx_packets(m_PfRingDescriptors[0]);
+	// packets still queued in ZC mode are sent now, the ones which couldn't be sent aren't counted
+	packetsSent -= (int)flushTxQueues();
 
 	LOG_DEBUG("%d out of %d packets were sent successfully", packetsSent, arrLength);
 
@@ -849,8 +1666,8 @@ int PfRingDevice::sendPackets(const RawPacketVector& rawPackets)
 			packetsSent++;
 	}
 
-	// The following method isn't supported in PF_RING aware drivers, probably only in DNA and ZC
-	pfring_flush_tx_packets(m_PfRingDescriptors[0]);
+	// packets still queued in ZC mode are sent now, the ones which couldn't be sent aren't counted
+	packetsSent -= (int)flushTxQueues();
 
 	LOG_DEBUG("%d out of %d raw packets were sent successfully", packetsSent, (int)rawPackets.size());
 
@@ -858,7 +1675,7 @@ int PfRingDevice::sendPackets(const RawPacketVector& rawPackets)
 }
 
 PfRingDevice::CoreConfiguration::CoreConfiguration()
-	: RxThread(0), Channel(NULL), IsInUse(false), IsAffinitySet(true)
+	: RxThread(0), Channel(NULL), ZcQueueIndex(-1), IsInUse(false), IsAffinitySet(true)
 {
 }
 
@@ -866,6 +1683,7 @@ void PfRingDevice::CoreConfiguration::clear()
 {
 	RxThread = 0;
 	Channel = NULL;
+	ZcQueueIndex = -1;
 	IsInUse = false;
 	IsAffinitySet = true;
 }
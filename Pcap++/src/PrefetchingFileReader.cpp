@@ -0,0 +1,187 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include "PrefetchingFileReader.h"
+#include "AtomicUtils.h"
+#include "Logger.h"
+#include <string.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace pcpp
+{
+
+// used by the background thread waiting for a free batch and by the processing thread waiting for a ready one
+static void sleepBriefly()
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	Sleep(1);
+#else
+	timespec interval;
+	interval.tv_sec = 0;
+	interval.tv_nsec = 50000;
+	nanosleep(&interval, NULL);
+#endif
+}
+
+PrefetchingFileReader::PrefetchingFileReader(IFileReaderDevice& reader, size_t batchSize, size_t numOfBatches) :
+	m_Reader(reader), m_Queue(numOfBatches > 1 ? numOfBatches : 2)
+{
+	// one batch is always held by the processing thread, so at least 2 are needed to read ahead
+	m_BatchSize = (batchSize > 0 ? batchSize : 1);
+	m_Running = false;
+	m_StopRequested = 0;
+	m_CurBatch = NULL;
+	m_CurPacket = 0;
+	m_EndOfFile = false;
+	m_NumOfPacketsTaken = 0;
+}
+
+PrefetchingFileReader::~PrefetchingFileReader()
+{
+	stop();
+}
+
+bool PrefetchingFileReader::start()
+{
+	if (m_Running)
+	{
+		LOG_ERROR("Prefetching is already running");
+		return false;
+	}
+
+	if (!m_Reader.isOpened())
+	{
+		LOG_ERROR("The reader device must be opened before prefetching starts");
+		return false;
+	}
+
+	m_StopRequested = 0;
+	m_CurBatch = NULL;
+	m_CurPacket = 0;
+	m_EndOfFile = false;
+	m_NumOfPacketsTaken = 0;
+
+	int err = pthread_create(&m_PrefetchThread, NULL, prefetchThreadMain, this);
+	if (err != 0)
+	{
+		LOG_ERROR("Cannot create prefetch thread: [%s]", strerror(err));
+		return false;
+	}
+
+	m_Running = true;
+	return true;
+}
+
+void PrefetchingFileReader::stop()
+{
+	if (!m_Running)
+		return;
+
+	atomicStoreRelease(&m_StopRequested, 1);
+	pthread_join(m_PrefetchThread, NULL);
+
+	// the background thread is gone, so this thread can release the batches it read as well. The queue is left empty for the next start()
+	m_CurBatch = NULL;
+	while (m_Queue.front() != NULL)
+		m_Queue.pop();
+
+	m_Running = false;
+}
+
+void* PrefetchingFileReader::prefetchThreadMain(void* readerPtr)
+{
+	PrefetchingFileReader* self = (PrefetchingFileReader*)readerPtr;
+	int idleRounds = 0;
+
+	while (atomicLoadAcquire(&self->m_StopRequested) == 0)
+	{
+		Batch* batch = self->m_Queue.reserve();
+		if (batch == NULL)
+		{
+			if (idleRounds < IdleSpinRounds)
+				idleRounds++;
+			else
+				sleepBriefly();
+			continue;
+		}
+
+		idleRounds = 0;
+
+		// the batch was released by the processing thread, so its packets can be dropped and its memory reused
+		batch->packets.clear();
+		int numOfPacketsRead = self->m_Reader.getNextPackets(batch->packets, (int)self->m_BatchSize);
+		batch->endOfFile = ((size_t)numOfPacketsRead < self->m_BatchSize);
+		self->m_Queue.publish();
+
+		if (batch->endOfFile)
+			break;
+	}
+
+	return NULL;
+}
+
+void PrefetchingFileReader::releaseCurBatch()
+{
+	if (m_CurBatch == NULL)
+		return;
+
+	m_CurBatch = NULL;
+	m_Queue.pop();
+}
+
+RawPacketSlabVector* PrefetchingFileReader::getNextBatch()
+{
+	if (!m_Running)
+		return NULL;
+
+	releaseCurBatch();
+
+	int idleRounds = 0;
+	while (!m_EndOfFile)
+	{
+		Batch* batch = m_Queue.front();
+		if (batch == NULL)
+		{
+			if (idleRounds < IdleSpinRounds)
+				idleRounds++;
+			else
+				sleepBriefly();
+			continue;
+		}
+
+		m_EndOfFile = batch->endOfFile;
+		if (batch->packets.size() == 0)
+		{
+			m_Queue.pop();
+			continue;
+		}
+
+		m_CurBatch = batch;
+		m_CurPacket = batch->packets.size();
+		m_NumOfPacketsTaken += batch->packets.size();
+		return &batch->packets;
+	}
+
+	return NULL;
+}
+
+RawPacket* PrefetchingFileReader::getNextPacket()
+{
+	if (m_CurBatch == NULL || m_CurPacket >= m_CurBatch->packets.size())
+	{
+		if (getNextBatch() == NULL)
+			return NULL;
+
+		m_CurPacket = 0;
+		// getNextBatch() counts the whole batch as taken, while here packets are counted one at a time
+		m_NumOfPacketsTaken -= m_CurBatch->packets.size();
+	}
+
+	m_NumOfPacketsTaken++;
+	return m_CurBatch->packets.at((int)m_CurPacket++);
+}
+
+} // namespace pcpp
@@ -11,11 +11,13 @@
 #include <netpacket/packet.h>
 #include <ifaddrs.h>
 #include <net/if.h>
+#include <sys/socket.h>
 #endif
 #include <string.h>
 #include "Logger.h"
 #include "IpUtils.h"
 #include "SystemUtils.h"
+#include "TimestampClock.h"
 #include "Packet.h"
 #include "EthLayer.h"
 
@@ -61,6 +63,84 @@ bool WinSockInitializer::m_IsInitialized = false;
 
 #endif // defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 
+#ifdef LINUX
+
+// the messages of recvmmsg() and sendmmsg() calls, which are allocated when the socket is opened and reused by all calls
+struct MessageBatch
+{
+	mmsghdr messages[PCPP_RAW_SOCKET_MAX_BATCH_SIZE];
+	iovec iovecs[PCPP_RAW_SOCKET_MAX_BATCH_SIZE];
+	char control[PCPP_RAW_SOCKET_MAX_BATCH_SIZE][CMSG_SPACE(sizeof(timespec))];
+	// a buffer of RAW_SOCKET_BUFFER_LEN bytes per message, allocated on the first batch receive
+	char* receiveBuffers;
+	// the packets pollPackets() passes to its callback, which point to the receive buffers
+	RawPacket packets[PCPP_RAW_SOCKET_MAX_BATCH_SIZE];
+
+	MessageBatch() : receiveBuffers(NULL) {}
+	~MessageBatch() { delete [] receiveBuffers; }
+};
+
+// set blocking or non-blocking mode and the receive timeout on a socket
+static bool setReceiveMode(int fd, bool blocking, int timeout)
+{
+	// value of 0 timeout means disabling timeout
+	if (timeout < 0)
+		timeout = 0;
+
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (flags == -1)
+	{
+		LOG_ERROR("Cannot get socket flags");
+		return false;
+	}
+	flags = (blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+	if (fcntl(fd, F_SETFL, flags) != 0)
+	{
+		LOG_ERROR("Cannot set socket non-blocking flag");
+		return false;
+	}
+
+	struct timeval timeoutVal;
+	timeoutVal.tv_sec = timeout;
+	timeoutVal.tv_usec = 0;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutVal, sizeof(timeoutVal));
+	return true;
+}
+
+// receive up to maxNumOfPackets messages into the receive buffers of the batch with a single recvmmsg() call
+static int receiveMessageBatch(int fd, MessageBatch& batch, int maxNumOfPackets, int flags)
+{
+	if (batch.receiveBuffers == NULL)
+		batch.receiveBuffers = new char[PCPP_RAW_SOCKET_MAX_BATCH_SIZE * RAW_SOCKET_BUFFER_LEN];
+
+	for (int i = 0; i < maxNumOfPackets; i++)
+	{
+		batch.iovecs[i].iov_base = batch.receiveBuffers + i * RAW_SOCKET_BUFFER_LEN;
+		batch.iovecs[i].iov_len = RAW_SOCKET_BUFFER_LEN;
+		memset(&batch.messages[i], 0, sizeof(mmsghdr));
+		batch.messages[i].msg_hdr.msg_iov = &batch.iovecs[i];
+		batch.messages[i].msg_hdr.msg_iovlen = 1;
+		batch.messages[i].msg_hdr.msg_control = batch.control[i];
+		batch.messages[i].msg_hdr.msg_controllen = sizeof(batch.control[i]);
+	}
+
+	return recvmmsg(fd, batch.messages, maxNumOfPackets, flags, NULL);
+}
+
+// get the kernel timestamp of a received message, or the given time if it has none
+static timespec getMessageTimestamp(mmsghdr& message, const timespec& receiveTime)
+{
+	timespec time = receiveTime;
+	for (cmsghdr* cmsg = CMSG_FIRSTHDR(&message.msg_hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&message.msg_hdr, cmsg))
+	{
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+			memcpy(&time, CMSG_DATA(cmsg), sizeof(timespec));
+	}
+	return time;
+}
+
+#endif
+
 struct SocketContainer
 {
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
@@ -69,10 +149,11 @@ struct SocketContainer
 	int fd;
 	int interfaceIndex;
 	std::string interfaceName;
+	MessageBatch batch;
 #endif
 };
 
-RawSocketDevice::RawSocketDevice(const IPAddress& interfaceIP) : IDevice(), m_Socket(NULL)
+RawSocketDevice::RawSocketDevice(const IPAddress& interfaceIP) : IDevice(), m_Socket(NULL), m_RawPacketPool(NULL), m_ReceiveBuffer(NULL)
 {
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 
@@ -100,6 +181,44 @@ RawSocketDevice::~RawSocketDevice()
 
 	if (m_InterfaceIP != NULL)
 		delete m_InterfaceIP;
+
+	if (m_ReceiveBuffer != NULL)
+		delete [] m_ReceiveBuffer;
+}
+
+char* RawSocketDevice::allocateReceiveBuffer()
+{
+	if (m_RawPacketPool != NULL)
+	{
+		// the data is copied into a pool buffer once its length is known, so the same receive buffer can be used for all packets
+		if (m_ReceiveBuffer == NULL)
+			m_ReceiveBuffer = new char[RAW_SOCKET_BUFFER_LEN];
+
+		return m_ReceiveBuffer;
+	}
+
+	char* buffer = new char[RAW_SOCKET_BUFFER_LEN];
+	memset(buffer, 0, RAW_SOCKET_BUFFER_LEN);
+	return buffer;
+}
+
+void RawSocketDevice::freeReceiveBuffer(char* buffer)
+{
+	if (buffer != m_ReceiveBuffer)
+		delete [] buffer;
+}
+
+void RawSocketDevice::setReceivedData(RawPacket& rawPacket, char* buffer, int bufferLen, LinkLayerType linkType)
+{
+	timespec time = TimestampClock::now();
+
+	if (buffer == m_ReceiveBuffer)
+		rawPacket.copyRawData((const uint8_t*)buffer, bufferLen, time, m_RawPacketPool, linkType);
+	else
+	{
+		rawPacket.setRawData((const uint8_t*)buffer, bufferLen, TimestampClock::toTimeval(time), linkType);
+		rawPacket.setPacketTimeStamp(time);
+	}
 }
 
 RawSocketDevice::RecvPacketResult RawSocketDevice::receivePacket(RawPacket& rawPacket, bool blocking, int timeout)
@@ -113,8 +232,7 @@ RawSocketDevice::RecvPacketResult RawSocketDevice::receivePacket(RawPacket& rawP
 	}
 
 	SOCKET fd = ((SocketContainer*)m_Socket)->fd;
-	char* buffer = new char[RAW_SOCKET_BUFFER_LEN];
-	memset(buffer, 0, RAW_SOCKET_BUFFER_LEN);
+	char* buffer = allocateReceiveBuffer();
 
 	// value of 0 timeout means disabling timeout
 	if (timeout < 0)
@@ -130,7 +248,7 @@ RawSocketDevice::RecvPacketResult RawSocketDevice::receivePacket(RawPacket& rawP
 	int bufferLen = recv(fd, buffer, RAW_SOCKET_BUFFER_LEN, 0);
 	if (bufferLen < 0)
 	{
-		delete [] buffer;
+		freeReceiveBuffer(buffer);
 		int errorCode = 0;
 		RecvPacketResult error = getError(errorCode);
 
@@ -142,14 +260,12 @@ RawSocketDevice::RecvPacketResult RawSocketDevice::receivePacket(RawPacket& rawP
 
 	if (bufferLen > 0)
 	{
-		timeval time;
-		gettimeofday(&time, NULL);
-		rawPacket.setRawData((const uint8_t*)buffer, bufferLen, time, LINKTYPE_DLT_RAW1);
+		setReceivedData(rawPacket, buffer, bufferLen, LINKTYPE_DLT_RAW1);
 		return RecvSuccess;
 	}
 
 	LOG_ERROR("Buffer length is zero");
-	delete [] buffer;
+	freeReceiveBuffer(buffer);
 	return RecvError;
 
 #elif LINUX
@@ -161,37 +277,14 @@ RawSocketDevice::RecvPacketResult RawSocketDevice::receivePacket(RawPacket& rawP
 	}
 
 	int fd = ((SocketContainer*)m_Socket)->fd;
-	char* buffer = new char[RAW_SOCKET_BUFFER_LEN];
-	memset(buffer, 0, RAW_SOCKET_BUFFER_LEN);
-
-	// value of 0 timeout means disabling timeout
-	if (timeout < 0)
-		timeout = 0;
-
-	// set blocking or non-blocking flag
-	int flags = fcntl(fd, F_GETFL, 0);
-	if (flags == -1)
-	{
-		LOG_ERROR("Cannot get socket flags");
-		return RecvError;
-	} 
-	flags = (blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
-	if (fcntl(fd, F_SETFL, flags) != 0)
-	{
-		LOG_ERROR("Cannot set socket non-blocking flag");
+	if (!setReceiveMode(fd, blocking, timeout))
 		return RecvError;
-	}
-
-	// set timeout on socket
-	struct timeval timeoutVal;
-	timeoutVal.tv_sec = timeout;
-	timeoutVal.tv_usec = 0;
-	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutVal, sizeof(timeoutVal));
 
+	char* buffer = allocateReceiveBuffer();
 	int bufferLen = recv(fd, buffer, RAW_SOCKET_BUFFER_LEN, 0);
 	if (bufferLen < 0)
 	{
-		delete [] buffer;
+		freeReceiveBuffer(buffer);
 		int errorCode = errno;
 		RecvPacketResult error = getError(errorCode);
 
@@ -203,14 +296,12 @@ RawSocketDevice::RecvPacketResult RawSocketDevice::receivePacket(RawPacket& rawP
 
 	if (bufferLen > 0)
 	{
-		timeval time;
-		gettimeofday(&time, NULL);
-		rawPacket.setRawData((const uint8_t*)buffer, bufferLen, time, LINKTYPE_ETHERNET);
+		setReceivedData(rawPacket, buffer, bufferLen, LINKTYPE_ETHERNET);
 		return RecvSuccess;
 	}
 
 	LOG_ERROR("Buffer length is zero");
-	delete [] buffer;
+	freeReceiveBuffer(buffer);
 	return RecvError;
 
 #else
@@ -239,6 +330,13 @@ int RawSocketDevice::receivePackets(RawPacketVector& packetVec, int timeout, int
 
 	while (curSec < timeoutSec)
 	{
+#ifdef LINUX
+		int batchCount = receivePacketBatch(packetVec, PCPP_RAW_SOCKET_MAX_BATCH_SIZE, true, timeoutSec-curSec);
+		if (batchCount > 0)
+			packetCount += batchCount;
+		else
+			failedRecv++;
+#else
 		RawPacket* rawPacket = new RawPacket();
 		if (receivePacket(*rawPacket, true, timeoutSec-curSec) == RecvSuccess)
 		{
@@ -250,6 +348,7 @@ int RawSocketDevice::receivePackets(RawPacketVector& packetVec, int timeout, int
 			failedRecv++;
 			delete rawPacket;
 		}
+#endif
 
 		clockGetTime(curSec, curNsec);
 	}
@@ -257,6 +356,131 @@ int RawSocketDevice::receivePackets(RawPacketVector& packetVec, int timeout, int
 	return packetCount;
 }
 
+int RawSocketDevice::receivePacketBatch(RawPacketVector& packetVec, int maxNumOfPackets, bool blocking, int timeout)
+{
+#ifdef LINUX
+
+	if (!isOpened())
+	{
+		LOG_ERROR("Device is not open");
+		return -1;
+	}
+
+	if (maxNumOfPackets <= 0)
+		return 0;
+	if (maxNumOfPackets > PCPP_RAW_SOCKET_MAX_BATCH_SIZE)
+		maxNumOfPackets = PCPP_RAW_SOCKET_MAX_BATCH_SIZE;
+
+	SocketContainer* sockContainer = (SocketContainer*)m_Socket;
+	if (!setReceiveMode(sockContainer->fd, blocking, timeout))
+		return -1;
+
+	MessageBatch& batch = sockContainer->batch;
+
+	// in blocking mode only the first packet is waited for, the ones after it are taken only if they're already queued
+	int numOfPackets = receiveMessageBatch(sockContainer->fd, batch, maxNumOfPackets, (blocking ? MSG_WAITFORONE : MSG_DONTWAIT));
+	if (numOfPackets < 0)
+	{
+		int errorCode = errno;
+		if (getError(errorCode) == RecvError)
+		{
+			LOG_ERROR("Error reading from recvmmsg. Error code is %d", errorCode);
+			return -1;
+		}
+
+		return 0;
+	}
+
+	// used for packets without a kernel timestamp
+	timespec receiveTime = TimestampClock::now();
+
+	for (int i = 0; i < numOfPackets; i++)
+	{
+		timespec time = getMessageTimestamp(batch.messages[i], receiveTime);
+		RawPacket* rawPacket = new RawPacket();
+		rawPacket->copyRawData((const uint8_t*)batch.iovecs[i].iov_base, (int)batch.messages[i].msg_len, time, m_RawPacketPool, LINKTYPE_ETHERNET);
+		packetVec.pushBack(rawPacket);
+	}
+
+	return numOfPackets;
+
+#else
+
+	LOG_ERROR("Receiving packet batches is supported on Linux only");
+	return -1;
+
+#endif
+}
+
+int RawSocketDevice::pollPackets(OnRawSocketPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, int maxBurstSize)
+{
+#ifdef LINUX
+
+	if (!isOpened())
+	{
+		LOG_ERROR("Device is not open");
+		return -1;
+	}
+
+	if (onPacketsArrive == NULL)
+	{
+		LOG_ERROR("Polling needs a callback");
+		return -1;
+	}
+
+	if (maxBurstSize <= 0)
+		return 0;
+	if (maxBurstSize > PCPP_RAW_SOCKET_MAX_BATCH_SIZE)
+		maxBurstSize = PCPP_RAW_SOCKET_MAX_BATCH_SIZE;
+
+	// MSG_DONTWAIT makes this single call non-blocking, regardless of the mode receivePacket() or receivePacketBatch() left the socket in
+	SocketContainer* sockContainer = (SocketContainer*)m_Socket;
+	MessageBatch& batch = sockContainer->batch;
+	int numOfPackets = receiveMessageBatch(sockContainer->fd, batch, maxBurstSize, MSG_DONTWAIT);
+	if (numOfPackets < 0)
+	{
+		int errorCode = errno;
+		if (getError(errorCode) == RecvError)
+		{
+			LOG_ERROR("Error reading from recvmmsg. Error code is %d", errorCode);
+			return -1;
+		}
+
+		return 0;
+	}
+
+	if (numOfPackets == 0)
+		return 0;
+
+	timespec receiveTime = TimestampClock::now();
+	for (int i = 0; i < numOfPackets; i++)
+	{
+		timespec time = getMessageTimestamp(batch.messages[i], receiveTime);
+		batch.packets[i].setExternalRawData((const uint8_t*)batch.iovecs[i].iov_base, (int)batch.messages[i].msg_len, time, LINKTYPE_ETHERNET);
+	}
+
+	onPacketsArrive(batch.packets, (uint32_t)numOfPackets, this, onPacketsArriveUserCookie);
+	return numOfPackets;
+
+#else
+
+	LOG_ERROR("Polling raw sockets is supported on Linux only");
+	return -1;
+
+#endif
+}
+
+int RawSocketDevice::getSelectableFd() const
+{
+#ifdef LINUX
+	if (m_Socket == NULL)
+		return -1;
+	return ((SocketContainer*)m_Socket)->fd;
+#else
+	return -1;
+#endif
+}
+
 bool RawSocketDevice::sendPacket(const RawPacket* rawPacket)
 {
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
@@ -323,37 +547,57 @@ int RawSocketDevice::sendPackets(const RawPacketVector& packetVec)
 		return 0;
 	}
 
-	int fd = ((SocketContainer*)m_Socket)->fd;
+	SocketContainer* sockContainer = (SocketContainer*)m_Socket;
+	MessageBatch& batch = sockContainer->batch;
 
+	// the packets hold their Ethernet header, so the address only selects the interface and is shared by all messages
 	sockaddr_ll addr;
 	memset(&addr, 0, sizeof(struct sockaddr_ll));
 	addr.sll_family = htons(PF_PACKET);
 	addr.sll_protocol = htons(ETH_P_ALL);
 	addr.sll_halen = 6;
-	addr.sll_ifindex = ((SocketContainer*)m_Socket)->interfaceIndex;
+	addr.sll_ifindex = sockContainer->interfaceIndex;
 
 	int sendCount = 0;
 
-	for (RawPacketVector::ConstVectorIterator iter = packetVec.begin(); iter != packetVec.end(); iter++)
+	RawPacketVector::ConstVectorIterator iter = packetVec.begin();
+	while (iter != packetVec.end())
 	{
-		Packet packet(*iter, OsiModelDataLinkLayer);
-		if (!packet.isPacketOfType(pcpp::Ethernet))
+		unsigned int batchLen = 0;
+		for (; iter != packetVec.end() && batchLen < PCPP_RAW_SOCKET_MAX_BATCH_SIZE; iter++)
 		{
-			LOG_DEBUG("Can't send non-Ethernet packets");
-			continue;
-		}
+			Packet packet(*iter, OsiModelDataLinkLayer);
+			if (!packet.isPacketOfType(pcpp::Ethernet))
+			{
+				LOG_DEBUG("Can't send non-Ethernet packets");
+				continue;
+			}
 
-		EthLayer* ethLayer = packet.getLayerOfType<EthLayer>();
-		MacAddress dstMac = ethLayer->getDestMac();
-		dstMac.copyTo((uint8_t*)&(addr.sll_addr));
+			batch.iovecs[batchLen].iov_base = (void*)(*iter)->getRawData();
+			batch.iovecs[batchLen].iov_len = (*iter)->getRawDataLen();
+			memset(&batch.messages[batchLen], 0, sizeof(mmsghdr));
+			batch.messages[batchLen].msg_hdr.msg_name = &addr;
+			batch.messages[batchLen].msg_hdr.msg_namelen = sizeof(addr);
+			batch.messages[batchLen].msg_hdr.msg_iov = &batch.iovecs[batchLen];
+			batch.messages[batchLen].msg_hdr.msg_iovlen = 1;
+			batchLen++;
+		}
 
-		if (::sendto(fd, (*iter)->getRawData(), (*iter)->getRawDataLen(), 0, (struct sockaddr*)&addr, sizeof(addr)) == -1)
+		// sendmmsg() stops at the first packet it fails to send, which is skipped like a failed packet sent on its own
+		unsigned int batchSent = 0;
+		while (batchSent < batchLen)
 		{
-			LOG_DEBUG("Failed to send packet. Error was: '%s'", strerror(errno));
-			continue;
-		}
+			int res = sendmmsg(sockContainer->fd, batch.messages + batchSent, batchLen - batchSent, 0);
+			if (res <= 0)
+			{
+				LOG_DEBUG("Failed to send packet. Error was: '%s'", strerror(errno));
+				batchSent++;
+				continue;
+			}
 
-		sendCount++;
+			batchSent += res;
+			sendCount += res;
+		}
 	}
 
 	return sendCount;
@@ -516,6 +760,11 @@ bool RawSocketDevice::open()
 		return false;		
 	}
 
+	// have the kernel timestamp received packets, which receivePacketBatch() reads
+	int enableTimestamps = 1;
+	if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &enableTimestamps, sizeof(enableTimestamps)) == -1)
+		LOG_DEBUG("Cannot enable kernel timestamps on raw socket, packets will be timestamped when they're read");
+
 	m_Socket = new SocketContainer();
 	((SocketContainer*)m_Socket)->fd = fd;
 	((SocketContainer*)m_Socket)->interfaceIndex = ifaceIndex;
@@ -0,0 +1,992 @@
+#define LOG_MODULE PcapLogModuleRemoteCaptureDevice
+
+#include "RemoteCaptureDevice.h"
+#include "PcapLiveDevice.h"
+#include "TimestampClock.h"
+#include "EndianPortable.h"
+#include "Logger.h"
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define PCPP_CLOSE_SOCKET closesocket
+#else
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#define PCPP_CLOSE_SOCKET ::close
+#endif
+#ifdef USE_Z_STD
+#include <zstd.h>
+#endif
+
+// "PCPR" in ASCII
+#define PCPP_REMOTE_CAPTURE_MAGIC 0x50435052
+#define PCPP_REMOTE_CAPTURE_VERSION 1
+// how often the capture thread of RemoteCaptureDevice checks whether it should stop
+#define PCPP_REMOTE_CAPTURE_POLL_MS 100
+// the kernel receive buffer requested for the data channel, so bursts of batches aren't dropped while a callback runs
+#define PCPP_REMOTE_CAPTURE_SOCKET_BUFFER_SIZE (8 * 1024 * 1024)
+
+namespace pcpp
+{
+
+static inline void writeUint16(uint8_t* ptr, uint16_t value)
+{
+	value = htobe16(value);
+	memcpy(ptr, &value, sizeof(value));
+}
+
+static inline void writeUint32(uint8_t* ptr, uint32_t value)
+{
+	value = htobe32(value);
+	memcpy(ptr, &value, sizeof(value));
+}
+
+static inline uint16_t readUint16(const uint8_t* ptr)
+{
+	uint16_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return be16toh(value);
+}
+
+static inline uint32_t readUint32(const uint8_t* ptr)
+{
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return be32toh(value);
+}
+
+static inline uint64_t nowMs()
+{
+	return TimestampClock::nowNs() / 1000000;
+}
+
+static bool initWinSock()
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		LOG_ERROR("Couldn't initialize Winsock");
+		return false;
+	}
+#endif
+	return true;
+}
+
+static void cleanupWinSock()
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	WSACleanup();
+#endif
+}
+
+static bool makeAddress(const std::string& address, uint16_t port, sockaddr_in& addr)
+{
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = inet_addr(address.c_str());
+	return addr.sin_addr.s_addr != INADDR_NONE || address == "255.255.255.255";
+}
+
+static uint32_t maxFrameSizeOf(const RemoteCaptureConfiguration& config)
+{
+	uint32_t limit = (config.transport == RemoteCaptureTransportUdp ? PCPP_REMOTE_CAPTURE_MAX_UDP_FRAME_SIZE : PCPP_REMOTE_CAPTURE_MAX_TCP_FRAME_SIZE);
+	return std::min(config.maxBatchSize, limit);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~
+// RemoteCaptureBatch
+// ~~~~~~~~~~~~~~~~~~
+
+RemoteCaptureBatch::RemoteCaptureBatch(uint32_t maxFrameSize, uint16_t streamId, LinkLayerType linkType)
+{
+	m_MaxFrameSize = maxFrameSize;
+	m_StreamId = streamId;
+	m_LinkType = linkType;
+	m_Payload.reserve(maxFrameSize);
+	clear();
+}
+
+void RemoteCaptureBatch::clear()
+{
+	m_Payload.clear();
+	m_NumOfPackets = 0;
+	m_PacketBytes = 0;
+}
+
+bool RemoteCaptureBatch::addPacket(const RawPacket& packet, bool& truncated)
+{
+	truncated = false;
+	size_t used = PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE + m_Payload.size() + PCPP_REMOTE_CAPTURE_PACKET_HEADER_SIZE;
+	if (used >= m_MaxFrameSize)
+		return false;
+
+	size_t capLen = (size_t)packet.getRawDataLen();
+	if (used + capLen > m_MaxFrameSize)
+	{
+		if (!isEmpty())
+			return false;
+		capLen = m_MaxFrameSize - used;
+		truncated = true;
+	}
+
+	size_t offset = m_Payload.size();
+	m_Payload.resize(offset + PCPP_REMOTE_CAPTURE_PACKET_HEADER_SIZE + capLen);
+	uint8_t* record = &m_Payload[offset];
+	timespec timestamp = packet.getPacketTimeStampNs();
+	writeUint32(record, (uint32_t)timestamp.tv_sec);
+	writeUint32(record + 4, (uint32_t)timestamp.tv_nsec);
+	writeUint32(record + 8, (uint32_t)capLen);
+	writeUint32(record + 12, (uint32_t)packet.getFrameLength());
+	if (capLen > 0)
+		memcpy(record + PCPP_REMOTE_CAPTURE_PACKET_HEADER_SIZE, packet.getRawData(), capLen);
+
+	m_NumOfPackets++;
+	m_PacketBytes += capLen;
+	return true;
+}
+
+bool RemoteCaptureBatch::isCompressionSupported(RemoteCaptureCompression compression)
+{
+	if (compression == RemoteCaptureNoCompression)
+		return true;
+#ifdef USE_Z_STD
+	return compression == RemoteCaptureZstdCompression;
+#else
+	return false;
+#endif
+}
+
+bool RemoteCaptureBatch::encode(uint32_t sequence, RemoteCaptureCompression compression, int compressionLevel, std::vector<uint8_t>& frame)
+{
+	if (!isCompressionSupported(compression))
+	{
+		LOG_ERROR("Compression %d isn't supported by this build of PcapPlusPlus", (int)compression);
+		return false;
+	}
+
+	uint32_t payloadLength = (uint32_t)m_Payload.size();
+	RemoteCaptureCompression usedCompression = RemoteCaptureNoCompression;
+	frame.resize(PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE + m_Payload.size());
+
+#ifdef USE_Z_STD
+	if (compression == RemoteCaptureZstdCompression && !m_Payload.empty())
+	{
+		frame.resize(PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE + std::max(m_Payload.size(), ZSTD_compressBound(m_Payload.size())));
+		size_t result = ZSTD_compress(&frame[PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE], frame.size() - PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE,
+				&m_Payload[0], m_Payload.size(), compressionLevel);
+		// incompressible data (for example encrypted traffic) is sent as is, so a frame is never larger than the batch
+		if (!ZSTD_isError(result) && result < m_Payload.size())
+		{
+			payloadLength = (uint32_t)result;
+			usedCompression = RemoteCaptureZstdCompression;
+		}
+		frame.resize(PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE + payloadLength);
+	}
+#else
+	(void)compressionLevel;
+#endif
+
+	if (usedCompression == RemoteCaptureNoCompression && !m_Payload.empty())
+		memcpy(&frame[PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE], &m_Payload[0], m_Payload.size());
+
+	uint8_t* header = &frame[0];
+	writeUint32(header, PCPP_REMOTE_CAPTURE_MAGIC);
+	header[4] = PCPP_REMOTE_CAPTURE_VERSION;
+	header[5] = (uint8_t)usedCompression;
+	writeUint16(header + 6, m_StreamId);
+	writeUint32(header + 8, sequence);
+	writeUint32(header + 12, m_NumOfPackets);
+	writeUint16(header + 16, (uint16_t)m_LinkType);
+	writeUint16(header + 18, 0);
+	writeUint32(header + 20, payloadLength);
+	writeUint32(header + 24, (uint32_t)m_Payload.size());
+
+	clear();
+	return true;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+// RemoteCaptureBatchDecoder
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+
+RemoteCaptureBatchDecoder::RemoteCaptureBatchDecoder()
+{
+	memset(&m_Header, 0, sizeof(m_Header));
+	m_Packets = NULL;
+	m_PacketsCapacity = 0;
+	m_NumOfPackets = 0;
+}
+
+RemoteCaptureBatchDecoder::~RemoteCaptureBatchDecoder()
+{
+	delete [] m_Packets;
+}
+
+bool RemoteCaptureBatchDecoder::parseHeader(const uint8_t* data, size_t dataLen, RemoteCaptureFrameHeader& header)
+{
+	if (data == NULL || dataLen < PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE)
+		return false;
+
+	if (readUint32(data) != PCPP_REMOTE_CAPTURE_MAGIC || data[4] != PCPP_REMOTE_CAPTURE_VERSION)
+		return false;
+
+	if (data[5] != RemoteCaptureNoCompression && data[5] != RemoteCaptureZstdCompression)
+		return false;
+
+	header.compression = (RemoteCaptureCompression)data[5];
+	header.streamId = readUint16(data + 6);
+	header.sequence = readUint32(data + 8);
+	header.numOfPackets = readUint32(data + 12);
+	header.linkType = (LinkLayerType)readUint16(data + 16);
+	header.payloadLength = readUint32(data + 20);
+	header.uncompressedLength = readUint32(data + 24);
+
+	// every packet takes at least its record header, which also bounds the number of RawPackets a corrupted frame can allocate
+	if ((uint64_t)header.numOfPackets * PCPP_REMOTE_CAPTURE_PACKET_HEADER_SIZE > header.uncompressedLength ||
+			header.uncompressedLength > PCPP_REMOTE_CAPTURE_MAX_TCP_FRAME_SIZE)
+		return false;
+
+	return header.compression != RemoteCaptureNoCompression || header.payloadLength == header.uncompressedLength;
+}
+
+bool RemoteCaptureBatchDecoder::decode(const uint8_t* frame, size_t frameLen)
+{
+	m_NumOfPackets = 0;
+
+	RemoteCaptureFrameHeader header;
+	if (!parseHeader(frame, frameLen, header) || frameLen < PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE + (size_t)header.payloadLength)
+		return false;
+
+	const uint8_t* payload = frame + PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE;
+	if (header.compression == RemoteCaptureZstdCompression)
+	{
+#ifdef USE_Z_STD
+		m_Decompressed.resize(header.uncompressedLength);
+		size_t result = ZSTD_decompress(&m_Decompressed[0], m_Decompressed.size(), payload, header.payloadLength);
+		if (ZSTD_isError(result) || result != header.uncompressedLength)
+			return false;
+		payload = &m_Decompressed[0];
+#else
+		return false;
+#endif
+	}
+
+	if (header.numOfPackets > m_PacketsCapacity)
+	{
+		delete [] m_Packets;
+		m_Packets = new RawPacket[header.numOfPackets];
+		m_PacketsCapacity = header.numOfPackets;
+	}
+
+	size_t offset = 0;
+	for (uint32_t i = 0; i < header.numOfPackets; i++)
+	{
+		if (header.uncompressedLength - offset < PCPP_REMOTE_CAPTURE_PACKET_HEADER_SIZE)
+			return false;
+
+		const uint8_t* record = payload + offset;
+		uint32_t capLen = readUint32(record + 8);
+		if (header.uncompressedLength - offset - PCPP_REMOTE_CAPTURE_PACKET_HEADER_SIZE < capLen)
+			return false;
+
+		timespec timestamp;
+		timestamp.tv_sec = (time_t)readUint32(record);
+		timestamp.tv_nsec = (long)readUint32(record + 4);
+		m_Packets[i].setExternalRawData(record + PCPP_REMOTE_CAPTURE_PACKET_HEADER_SIZE, (int)capLen, timestamp, header.linkType,
+				(int)readUint32(record + 12));
+		offset += PCPP_REMOTE_CAPTURE_PACKET_HEADER_SIZE + capLen;
+	}
+
+	if (offset != header.uncompressedLength)
+		return false;
+
+	m_Header = header;
+	m_NumOfPackets = header.numOfPackets;
+	return true;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~
+// RemoteCaptureSender
+// ~~~~~~~~~~~~~~~~~~~
+
+RemoteCaptureSender::RemoteCaptureSender(const RemoteCaptureConfiguration& config)
+{
+	m_Config = config;
+	m_Socket = -1;
+	m_Batch = NULL;
+	m_Sequence = 0;
+	m_BatchStartMs = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_LatencyThreadStarted = false;
+	m_StopRequested = false;
+	pthread_mutex_init(&m_Mutex, NULL);
+	pthread_cond_init(&m_StopCond, NULL);
+}
+
+RemoteCaptureSender::~RemoteCaptureSender()
+{
+	disconnect();
+	pthread_cond_destroy(&m_StopCond);
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+bool RemoteCaptureSender::connect(const std::string& address, uint16_t port, LinkLayerType linkType)
+{
+	if (isConnected())
+	{
+		LOG_ERROR("Remote capture sender is already connected");
+		return false;
+	}
+
+	if (m_Config.maxBatchPackets == 0 || maxFrameSizeOf(m_Config) <= PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE + PCPP_REMOTE_CAPTURE_PACKET_HEADER_SIZE)
+	{
+		LOG_ERROR("Remote capture batches must hold at least one packet");
+		return false;
+	}
+
+	if (!RemoteCaptureBatch::isCompressionSupported(m_Config.compression))
+	{
+		LOG_ERROR("Compression %d isn't supported by this build of PcapPlusPlus", (int)m_Config.compression);
+		return false;
+	}
+
+	sockaddr_in addr;
+	if (!makeAddress(address, port, addr))
+	{
+		LOG_ERROR("Remote capture receiver address '%s' isn't a valid IPv4 address", address.c_str());
+		return false;
+	}
+
+	if (!initWinSock())
+		return false;
+
+	bool tcp = (m_Config.transport == RemoteCaptureTransportTcp);
+	int sock = (int)socket(AF_INET, (tcp ? SOCK_STREAM : SOCK_DGRAM), (tcp ? IPPROTO_TCP : IPPROTO_UDP));
+	if (sock < 0)
+	{
+		LOG_ERROR("Couldn't create the remote capture socket");
+		cleanupWinSock();
+		return false;
+	}
+
+	// a connected UDP socket sends with send() and reports ICMP errors of the receiver
+	if (::connect(sock, (sockaddr*)&addr, sizeof(addr)) != 0)
+	{
+		LOG_ERROR("Couldn't connect to the remote capture receiver %s:%d", address.c_str(), (int)port);
+		PCPP_CLOSE_SOCKET(sock);
+		cleanupWinSock();
+		return false;
+	}
+
+	if (tcp)
+	{
+		// batches are already as large as they should be, so they're sent right away
+		int noDelay = 1;
+		setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+	}
+
+	m_Batch = new RemoteCaptureBatch(maxFrameSizeOf(m_Config), m_Config.streamId, linkType);
+	m_Sequence = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_Stats.streamId = m_Config.streamId;
+	m_Socket = sock;
+
+	if (m_Config.maxBatchLatencyMs > 0)
+	{
+		m_StopRequested = false;
+		if (pthread_create(&m_LatencyThread, NULL, latencyThreadMain, this) != 0)
+		{
+			LOG_ERROR("Couldn't create the remote capture latency thread");
+			disconnect();
+			return false;
+		}
+		m_LatencyThreadStarted = true;
+	}
+
+	LOG_DEBUG("Remote capture sender of stream %d connected to %s:%d", (int)m_Config.streamId, address.c_str(), (int)port);
+	return true;
+}
+
+void RemoteCaptureSender::disconnect()
+{
+	if (!isConnected())
+		return;
+
+	if (m_LatencyThreadStarted)
+	{
+		pthread_mutex_lock(&m_Mutex);
+		m_StopRequested = true;
+		pthread_cond_signal(&m_StopCond);
+		pthread_mutex_unlock(&m_Mutex);
+		pthread_join(m_LatencyThread, NULL);
+		m_LatencyThreadStarted = false;
+	}
+
+	flush();
+
+	PCPP_CLOSE_SOCKET(m_Socket);
+	m_Socket = -1;
+	delete m_Batch;
+	m_Batch = NULL;
+	cleanupWinSock();
+}
+
+// must be called with m_Mutex locked
+bool RemoteCaptureSender::sendBatch()
+{
+	if (m_Batch->isEmpty())
+		return true;
+
+	uint32_t numOfPackets = m_Batch->getNumOfPackets();
+	uint64_t packetBytes = m_Batch->getPacketBytes();
+	if (!m_Batch->encode(m_Sequence, m_Config.compression, m_Config.compressionLevel, m_Frame))
+	{
+		m_Stats.lost += numOfPackets;
+		return false;
+	}
+
+	// the sequence advances even if sending fails, so the receiver sees the gap
+	m_Sequence++;
+
+	size_t sent = 0;
+	while (sent < m_Frame.size())
+	{
+		int result = (int)send(m_Socket, (const char*)&m_Frame[sent], (int)(m_Frame.size() - sent), 0);
+		if (result < 0 && errno == EINTR)
+			continue;
+		if (result <= 0)
+		{
+			LOG_ERROR("Couldn't send a batch of %d packets of stream %d", (int)numOfPackets, (int)m_Config.streamId);
+			m_Stats.lost += numOfPackets;
+			return false;
+		}
+		sent += (size_t)result;
+	}
+
+	m_Stats.batches++;
+	m_Stats.packets += numOfPackets;
+	m_Stats.packetBytes += packetBytes;
+	m_Stats.wireBytes += m_Frame.size();
+	return true;
+}
+
+bool RemoteCaptureSender::sendPacket(const RawPacket& packet)
+{
+	if (!isConnected())
+	{
+		LOG_ERROR("Remote capture sender isn't connected");
+		return false;
+	}
+
+	bool result = true;
+	bool truncated;
+	pthread_mutex_lock(&m_Mutex);
+
+	if (!m_Batch->addPacket(packet, truncated))
+	{
+		result = sendBatch();
+		// if the batch couldn't be encoded it's still full
+		if (!m_Batch->addPacket(packet, truncated))
+		{
+			m_Stats.lost++;
+			pthread_mutex_unlock(&m_Mutex);
+			return false;
+		}
+	}
+
+	if (truncated)
+		m_Stats.errors++;
+
+	if (m_Batch->getNumOfPackets() == 1)
+		m_BatchStartMs = nowMs();
+
+	if (m_Batch->getNumOfPackets() >= m_Config.maxBatchPackets)
+		result = sendBatch() && result;
+
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+bool RemoteCaptureSender::flush()
+{
+	if (!isConnected())
+	{
+		LOG_ERROR("Remote capture sender isn't connected");
+		return false;
+	}
+
+	pthread_mutex_lock(&m_Mutex);
+	bool result = sendBatch();
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+void RemoteCaptureSender::getStats(RemoteCaptureStreamStats& stats)
+{
+	pthread_mutex_lock(&m_Mutex);
+	stats = m_Stats;
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+void RemoteCaptureSender::onPacketArrives(RawPacket* packet, PcapLiveDevice* device, void* senderPtr)
+{
+	((RemoteCaptureSender*)senderPtr)->sendPacket(*packet);
+}
+
+void* RemoteCaptureSender::latencyThreadMain(void* senderPtr)
+{
+	RemoteCaptureSender* self = (RemoteCaptureSender*)senderPtr;
+	// checking twice per latency period keeps a packet from waiting more than 1.5 times the latency
+	uint32_t checkIntervalMs = std::max(self->m_Config.maxBatchLatencyMs / 2, (uint32_t)1);
+
+	pthread_mutex_lock(&self->m_Mutex);
+	while (!self->m_StopRequested)
+	{
+		if (!self->m_Batch->isEmpty() && nowMs() - self->m_BatchStartMs >= self->m_Config.maxBatchLatencyMs)
+			self->sendBatch();
+
+		// wait on the system clock, which pthread_cond_timedwait() uses by default
+		timeval now;
+		gettimeofday(&now, NULL);
+		uint64_t deadlineNs = (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_usec * 1000 + (uint64_t)checkIntervalMs * 1000000;
+		timespec deadline;
+		deadline.tv_sec = (time_t)(deadlineNs / 1000000000);
+		deadline.tv_nsec = (long)(deadlineNs % 1000000000);
+		pthread_cond_timedwait(&self->m_StopCond, &self->m_Mutex, &deadline);
+	}
+	pthread_mutex_unlock(&self->m_Mutex);
+
+	return NULL;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~
+// RemoteCaptureAgent
+// ~~~~~~~~~~~~~~~~~~
+
+RemoteCaptureAgent::RemoteCaptureAgent(const RemoteCaptureConfiguration& config) : m_Sender(config)
+{
+	m_Device = NULL;
+	m_OpenedDevice = false;
+}
+
+RemoteCaptureAgent::~RemoteCaptureAgent()
+{
+	stop();
+}
+
+bool RemoteCaptureAgent::start(PcapLiveDevice* device, const std::string& address, uint16_t port)
+{
+	if (isRunning())
+	{
+		LOG_ERROR("Remote capture agent is already running");
+		return false;
+	}
+
+	if (device == NULL)
+	{
+		LOG_ERROR("Remote capture agent device is NULL");
+		return false;
+	}
+
+	bool openedDevice = false;
+	if (!device->isOpened())
+	{
+		if (!device->open())
+		{
+			LOG_ERROR("Couldn't open device '%s' for the remote capture agent", device->getName());
+			return false;
+		}
+		openedDevice = true;
+	}
+
+	if (!m_Sender.connect(address, port, device->getLinkType()))
+	{
+		if (openedDevice)
+			device->close();
+		return false;
+	}
+
+	if (!device->startCapture(RemoteCaptureSender::onPacketArrives, &m_Sender))
+	{
+		LOG_ERROR("Couldn't start capturing on device '%s' for the remote capture agent", device->getName());
+		m_Sender.disconnect();
+		if (openedDevice)
+			device->close();
+		return false;
+	}
+
+	m_Device = device;
+	m_OpenedDevice = openedDevice;
+	return true;
+}
+
+void RemoteCaptureAgent::stop()
+{
+	if (!isRunning())
+		return;
+
+	m_Device->stopCapture();
+	m_Sender.disconnect();
+	if (m_OpenedDevice)
+		m_Device->close();
+
+	m_Device = NULL;
+	m_OpenedDevice = false;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~
+// RemoteCaptureDevice
+// ~~~~~~~~~~~~~~~~~~~
+
+RemoteCaptureDevice::RemoteCaptureDevice(RemoteCaptureTransport transport, uint16_t port, const std::string& bindAddress)
+{
+	m_Transport = transport;
+	m_Port = port;
+	m_BindAddress = bindAddress;
+	m_Socket = -1;
+	m_CaptureThreadStarted = false;
+	m_StopThread = false;
+	m_OnPacketsArrive = NULL;
+	m_OnPacketsArriveUserCookie = NULL;
+	pthread_mutex_init(&m_StatsMutex, NULL);
+}
+
+RemoteCaptureDevice::~RemoteCaptureDevice()
+{
+	close();
+	pthread_mutex_destroy(&m_StatsMutex);
+}
+
+bool RemoteCaptureDevice::open()
+{
+	if (m_DeviceOpened)
+	{
+		LOG_ERROR("Remote capture device is already open");
+		return false;
+	}
+
+	sockaddr_in addr;
+	if (!makeAddress(m_BindAddress, m_Port, addr))
+	{
+		LOG_ERROR("Remote capture bind address '%s' isn't a valid IPv4 address", m_BindAddress.c_str());
+		return false;
+	}
+
+	if (!initWinSock())
+		return false;
+
+	bool tcp = (m_Transport == RemoteCaptureTransportTcp);
+	m_Socket = (int)socket(AF_INET, (tcp ? SOCK_STREAM : SOCK_DGRAM), (tcp ? IPPROTO_TCP : IPPROTO_UDP));
+	if (m_Socket < 0)
+	{
+		LOG_ERROR("Couldn't create the remote capture socket");
+		cleanupWinSock();
+		return false;
+	}
+
+	int reuseAddr = 1;
+	setsockopt(m_Socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuseAddr, sizeof(reuseAddr));
+	if (!tcp)
+	{
+		int bufferSize = PCPP_REMOTE_CAPTURE_SOCKET_BUFFER_SIZE;
+		setsockopt(m_Socket, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferSize, sizeof(bufferSize));
+	}
+
+	if (bind(m_Socket, (sockaddr*)&addr, sizeof(addr)) != 0 || (tcp && listen(m_Socket, 16) != 0))
+	{
+		LOG_ERROR("Couldn't listen on %s:%d for remote captures", m_BindAddress.c_str(), (int)m_Port);
+		PCPP_CLOSE_SOCKET(m_Socket);
+		m_Socket = -1;
+		cleanupWinSock();
+		return false;
+	}
+
+	// find the chosen port when port 0 was requested
+	socklen_t addrLen = sizeof(addr);
+	if (getsockname(m_Socket, (sockaddr*)&addr, &addrLen) == 0)
+		m_Port = ntohs(addr.sin_port);
+
+	if (!tcp)
+		m_DatagramBuffer.resize(PCPP_REMOTE_CAPTURE_MAX_UDP_FRAME_SIZE + 1);
+
+	pthread_mutex_lock(&m_StatsMutex);
+	m_StreamStats.clear();
+	m_NextSequence.clear();
+	pthread_mutex_unlock(&m_StatsMutex);
+
+	m_DeviceOpened = true;
+	return true;
+}
+
+void RemoteCaptureDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	stopCapture();
+	closeConnections();
+	PCPP_CLOSE_SOCKET(m_Socket);
+	m_Socket = -1;
+	cleanupWinSock();
+	m_DeviceOpened = false;
+}
+
+void RemoteCaptureDevice::closeConnections()
+{
+	pthread_mutex_lock(&m_StatsMutex);
+	for (std::vector<Connection*>::iterator iter = m_Connections.begin(); iter != m_Connections.end(); iter++)
+	{
+		PCPP_CLOSE_SOCKET((*iter)->socket);
+		delete *iter;
+	}
+	m_Connections.clear();
+	pthread_mutex_unlock(&m_StatsMutex);
+}
+
+bool RemoteCaptureDevice::startCapture(OnRemoteCapturePacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Remote capture device isn't open");
+		return false;
+	}
+
+	if (m_CaptureThreadStarted)
+	{
+		LOG_ERROR("Remote capture is already running");
+		return false;
+	}
+
+	if (onPacketsArrive == NULL)
+	{
+		LOG_ERROR("Remote capture callback is NULL");
+		return false;
+	}
+
+	m_OnPacketsArrive = onPacketsArrive;
+	m_OnPacketsArriveUserCookie = onPacketsArriveUserCookie;
+	m_StopThread = false;
+	if (pthread_create(&m_CaptureThread, NULL, captureThreadMain, this) != 0)
+	{
+		LOG_ERROR("Couldn't create the remote capture thread");
+		return false;
+	}
+
+	m_CaptureThreadStarted = true;
+	return true;
+}
+
+void RemoteCaptureDevice::stopCapture()
+{
+	if (!m_CaptureThreadStarted)
+		return;
+
+	m_StopThread = true;
+	pthread_join(m_CaptureThread, NULL);
+	m_CaptureThreadStarted = false;
+}
+
+void RemoteCaptureDevice::getStreamStats(std::vector<RemoteCaptureStreamStats>& stats)
+{
+	stats.clear();
+	pthread_mutex_lock(&m_StatsMutex);
+	for (std::map<uint16_t, RemoteCaptureStreamStats>::const_iterator iter = m_StreamStats.begin(); iter != m_StreamStats.end(); iter++)
+		stats.push_back(iter->second);
+	pthread_mutex_unlock(&m_StatsMutex);
+}
+
+size_t RemoteCaptureDevice::getNumOfConnections()
+{
+	pthread_mutex_lock(&m_StatsMutex);
+	size_t result = m_Connections.size();
+	pthread_mutex_unlock(&m_StatsMutex);
+	return result;
+}
+
+void RemoteCaptureDevice::handleFrame(const uint8_t* frame, size_t frameLen)
+{
+	bool decoded = m_Decoder.decode(frame, frameLen);
+
+	RemoteCaptureFrameHeader header;
+	bool validHeader = RemoteCaptureBatchDecoder::parseHeader(frame, frameLen, header);
+
+	pthread_mutex_lock(&m_StatsMutex);
+	if (!validHeader)
+	{
+		// a frame which isn't a remote capture frame is counted in stream 0
+		header.streamId = 0;
+		header.sequence = 0;
+	}
+
+	RemoteCaptureStreamStats& stats = m_StreamStats[header.streamId];
+	stats.streamId = header.streamId;
+	stats.wireBytes += frameLen;
+	if (!decoded)
+		stats.errors++;
+	else
+	{
+		std::map<uint16_t, uint32_t>::iterator next = m_NextSequence.find(header.streamId);
+		// batches which arrive late (UDP reordering) were already counted as lost, so the count may be slightly high
+		if (next != m_NextSequence.end() && (int32_t)(header.sequence - next->second) > 0)
+			stats.lost += header.sequence - next->second;
+		if (next == m_NextSequence.end() || (int32_t)(header.sequence - next->second) >= 0)
+			m_NextSequence[header.streamId] = header.sequence + 1;
+
+		stats.batches++;
+		stats.packets += m_Decoder.getNumOfPackets();
+		for (uint32_t i = 0; i < m_Decoder.getNumOfPackets(); i++)
+			stats.packetBytes += (uint64_t)m_Decoder.getPackets()[i].getRawDataLen();
+	}
+	pthread_mutex_unlock(&m_StatsMutex);
+
+	if (decoded && m_Decoder.getNumOfPackets() > 0)
+		m_OnPacketsArrive(m_Decoder.getPackets(), m_Decoder.getNumOfPackets(), header.streamId, this, m_OnPacketsArriveUserCookie);
+}
+
+void RemoteCaptureDevice::receiveDatagram()
+{
+	int len = (int)recv(m_Socket, (char*)&m_DatagramBuffer[0], (int)m_DatagramBuffer.size(), 0);
+	if (len <= 0)
+		return;
+
+	handleFrame(&m_DatagramBuffer[0], (size_t)len);
+}
+
+bool RemoteCaptureDevice::receiveFromConnection(Connection* conn)
+{
+	if (conn->buffer.size() - conn->length < PCPP_REMOTE_CAPTURE_MAX_UDP_FRAME_SIZE)
+		conn->buffer.resize(conn->length + PCPP_REMOTE_CAPTURE_MAX_UDP_FRAME_SIZE);
+
+	int len = (int)recv(conn->socket, (char*)&conn->buffer[conn->length], (int)(conn->buffer.size() - conn->length), 0);
+	if (len <= 0)
+		return false;
+	conn->length += (size_t)len;
+
+	// deliver all complete frames in the buffer
+	size_t offset = 0;
+	while (conn->length - offset >= PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE)
+	{
+		RemoteCaptureFrameHeader header;
+		if (!RemoteCaptureBatchDecoder::parseHeader(&conn->buffer[offset], conn->length - offset, header) ||
+				header.payloadLength > PCPP_REMOTE_CAPTURE_MAX_TCP_FRAME_SIZE)
+		{
+			// the stream is out of sync and there's no way to find the next frame
+			LOG_ERROR("Received an invalid remote capture frame, closing the connection");
+			handleFrame(&conn->buffer[offset], conn->length - offset);
+			return false;
+		}
+
+		size_t frameLen = PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE + header.payloadLength;
+		if (conn->length - offset < frameLen)
+		{
+			if (conn->buffer.size() < frameLen)
+				conn->buffer.resize(frameLen);
+			break;
+		}
+
+		handleFrame(&conn->buffer[offset], frameLen);
+		offset += frameLen;
+	}
+
+	if (offset > 0)
+	{
+		memmove(&conn->buffer[0], &conn->buffer[offset], conn->length - offset);
+		conn->length -= offset;
+	}
+
+	return true;
+}
+
+void* RemoteCaptureDevice::captureThreadMain(void* devicePtr)
+{
+	RemoteCaptureDevice* self = (RemoteCaptureDevice*)devicePtr;
+	bool tcp = (self->m_Transport == RemoteCaptureTransportTcp);
+
+	while (!self->m_StopThread)
+	{
+		// all sockets are polled with a timeout so stopCapture() doesn't need to wake up a blocked recv()
+		fd_set readSet;
+		FD_ZERO(&readSet);
+		FD_SET(self->m_Socket, &readSet);
+		int maxSocket = self->m_Socket;
+		for (std::vector<Connection*>::iterator iter = self->m_Connections.begin(); iter != self->m_Connections.end(); iter++)
+		{
+			FD_SET((*iter)->socket, &readSet);
+			maxSocket = std::max(maxSocket, (*iter)->socket);
+		}
+
+		timeval timeout;
+		timeout.tv_sec = 0;
+		timeout.tv_usec = PCPP_REMOTE_CAPTURE_POLL_MS * 1000;
+		if (select(maxSocket + 1, &readSet, NULL, NULL, &timeout) <= 0)
+			continue;
+
+		if (!tcp)
+		{
+			self->receiveDatagram();
+			continue;
+		}
+
+		for (size_t i = 0; i < self->m_Connections.size(); )
+		{
+			Connection* conn = self->m_Connections[i];
+			if (!FD_ISSET(conn->socket, &readSet) || self->receiveFromConnection(conn))
+			{
+				i++;
+				continue;
+			}
+
+			pthread_mutex_lock(&self->m_StatsMutex);
+			self->m_Connections.erase(self->m_Connections.begin() + i);
+			pthread_mutex_unlock(&self->m_StatsMutex);
+			PCPP_CLOSE_SOCKET(conn->socket);
+			delete conn;
+		}
+
+		if (FD_ISSET(self->m_Socket, &readSet))
+		{
+			int connSocket = (int)accept(self->m_Socket, NULL, NULL);
+			if (connSocket < 0)
+				continue;
+
+			// select() can't watch sockets beyond FD_SETSIZE
+#if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV)
+			if (connSocket >= FD_SETSIZE)
+			{
+				LOG_ERROR("Too many open sockets to accept another remote capture connection");
+				PCPP_CLOSE_SOCKET(connSocket);
+				continue;
+			}
+#endif
+
+			int bufferSize = PCPP_REMOTE_CAPTURE_SOCKET_BUFFER_SIZE;
+			setsockopt(connSocket, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferSize, sizeof(bufferSize));
+
+			Connection* conn = new Connection();
+			conn->socket = connSocket;
+			conn->length = 0;
+			pthread_mutex_lock(&self->m_StatsMutex);
+			self->m_Connections.push_back(conn);
+			pthread_mutex_unlock(&self->m_StatsMutex);
+		}
+	}
+
+	return NULL;
+}
+
+} // namespace pcpp
@@ -0,0 +1,374 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include "RotatingFileWriterDevice.h"
+#include "Logger.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#ifdef LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace pcpp
+{
+
+// the sizes of the packet records, used for estimating the size of a file
+static const uint64_t PcapFileHeaderSize = 24;
+static const uint64_t PcapRecordHeaderSize = 16;
+static const uint64_t PcapNgPacketBlockOverhead = 32;
+
+RotatingFileWriterDevice::RotatingFileWriterDevice(const char* fileName, const RotatingFileWriterConfiguration& config) : IFileWriterDevice(fileName), m_Config(config)
+{
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfPacketsWritten = 0;
+	m_CurrentWriter = NULL;
+	m_CurrentFileSize = 0;
+	m_CurrentFileNumOfPackets = 0;
+	m_CurrentFileStartTime = 0;
+	m_NextFileNumber = 0;
+	m_NextWriter = NULL;
+	m_PrepareRequested = false;
+	m_PrepareFailed = false;
+	m_StopRequested = false;
+
+	// the sequence number is inserted before the extension, if the file name has one
+	m_FilePrefix = fileName;
+	size_t dotPos = m_FilePrefix.find_last_of('.');
+	size_t separatorPos = m_FilePrefix.find_last_of("/\\");
+	if (dotPos != std::string::npos && (separatorPos == std::string::npos || dotPos > separatorPos + 1))
+	{
+		m_FileExtension = m_FilePrefix.substr(dotPos);
+		m_FilePrefix.erase(dotPos);
+	}
+}
+
+std::string RotatingFileWriterDevice::getFileName(uint32_t fileNumber) const
+{
+	char sequenceNumber[16];
+	snprintf(sequenceNumber, sizeof(sequenceNumber), "_%06u", fileNumber);
+	return m_FilePrefix + sequenceNumber + m_FileExtension;
+}
+
+std::vector<std::string> RotatingFileWriterDevice::getFileNames() const
+{
+	return std::vector<std::string>(m_FileNames.begin(), m_FileNames.end());
+}
+
+IFileWriterDevice* RotatingFileWriterDevice::openWriter(const std::string& fileName)
+{
+	IFileWriterDevice* writer;
+	if (m_Config.pcapNg)
+		writer = new PcapNgFileWriterDevice(fileName.c_str(), m_Config.compressionLevel);
+	else
+		writer = new BufferedPcapFileWriterDevice(fileName.c_str(), m_Config.linkLayerType, m_Config.nanosecondsPrecision, m_Config.bufferConfig);
+
+	// every file of the sequence gets its own summary
+	if (m_Summary != NULL)
+		writer->setSummaryEnabled(true);
+
+	if (!writer->open())
+	{
+		LOG_ERROR("Cannot open file '%s' of the rotating file writer", fileName.c_str());
+		delete writer;
+		return NULL;
+	}
+
+#if defined(LINUX) && defined(FALLOC_FL_KEEP_SIZE)
+	if (m_Config.preallocate && m_Config.maxFileSize > 0)
+	{
+		// the space is reserved without changing the file size, so a file closed before it's full doesn't end with zeros
+		int fd = ::open(fileName.c_str(), O_WRONLY);
+		if (fd < 0 || fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)m_Config.maxFileSize) != 0)
+			LOG_DEBUG("Cannot preallocate file '%s', error was: %d", fileName.c_str(), errno);
+		if (fd >= 0)
+			::close(fd);
+	}
+#endif
+
+	return writer;
+}
+
+void RotatingFileWriterDevice::closeWriter(IFileWriterDevice* writer)
+{
+	writer->close();
+
+	pcap_stat stats;
+	writer->getStatistics(stats);
+	pthread_mutex_lock(&m_Mutex);
+	m_NumOfPacketsWritten += stats.ps_recv;
+	m_NumOfPacketsNotWritten += stats.ps_drop;
+	pthread_mutex_unlock(&m_Mutex);
+
+	delete writer;
+}
+
+void RotatingFileWriterDevice::requestNextWriter()
+{
+	// the mutex is held by the caller
+	m_NextFileName = getFileName(m_NextFileNumber++);
+	m_PrepareRequested = true;
+	pthread_cond_signal(&m_WorkAvailable);
+}
+
+bool RotatingFileWriterDevice::rollOver()
+{
+	pthread_mutex_lock(&m_Mutex);
+
+	// after the next file failed to open the current file is kept until a retry succeeds, without waiting for every retry
+	while (m_PrepareRequested && !m_PrepareFailed)
+		pthread_cond_wait(&m_NextWriterReady, &m_Mutex);
+
+	if (m_NextWriter == NULL)
+	{
+		if (!m_PrepareRequested)
+		{
+			m_PrepareRequested = true;
+			pthread_cond_signal(&m_WorkAvailable);
+		}
+		pthread_mutex_unlock(&m_Mutex);
+		return false;
+	}
+
+	m_WritersToClose.push_back(m_CurrentWriter);
+	m_CurrentWriter = m_NextWriter;
+	m_CurrentFileName = m_NextFileName;
+	m_NextWriter = NULL;
+	m_FileNames.push_back(m_CurrentFileName);
+	if (m_Config.maxNumOfFiles > 0 && m_FileNames.size() > m_Config.maxNumOfFiles)
+	{
+		m_FilesToDelete.push_back(m_FileNames.front());
+		m_FileNames.pop_front();
+	}
+	requestNextWriter();
+
+	pthread_mutex_unlock(&m_Mutex);
+
+	m_CurrentFileSize = (m_Config.pcapNg ? 0 : PcapFileHeaderSize);
+	m_CurrentFileNumOfPackets = 0;
+	LOG_DEBUG("Rotating file writer rolled over to file '%s'", m_CurrentFileName.c_str());
+	return true;
+}
+
+void* RotatingFileWriterDevice::housekeepingThreadMain(void* device)
+{
+	RotatingFileWriterDevice* self = (RotatingFileWriterDevice*)device;
+
+	// preparing the next file comes first since a rollover may be waiting for it. Files are closed before files are deleted, so a file is
+	// never deleted while it's open
+	pthread_mutex_lock(&self->m_Mutex);
+	while (true)
+	{
+		if (self->m_PrepareRequested && self->m_NextWriter == NULL)
+		{
+			std::string fileName = self->m_NextFileName;
+			pthread_mutex_unlock(&self->m_Mutex);
+			IFileWriterDevice* writer = self->openWriter(fileName);
+			pthread_mutex_lock(&self->m_Mutex);
+
+			self->m_NextWriter = writer;
+			self->m_PrepareFailed = (writer == NULL);
+			self->m_PrepareRequested = false;
+			pthread_cond_broadcast(&self->m_NextWriterReady);
+			continue;
+		}
+
+		if (!self->m_WritersToClose.empty())
+		{
+			std::vector<IFileWriterDevice*> writersToClose;
+			writersToClose.swap(self->m_WritersToClose);
+			pthread_mutex_unlock(&self->m_Mutex);
+			for (std::vector<IFileWriterDevice*>::iterator iter = writersToClose.begin(); iter != writersToClose.end(); iter++)
+				self->closeWriter(*iter);
+			pthread_mutex_lock(&self->m_Mutex);
+			continue;
+		}
+
+		if (!self->m_FilesToDelete.empty())
+		{
+			std::vector<std::string> filesToDelete;
+			filesToDelete.swap(self->m_FilesToDelete);
+			pthread_mutex_unlock(&self->m_Mutex);
+			for (std::vector<std::string>::iterator iter = filesToDelete.begin(); iter != filesToDelete.end(); iter++)
+			{
+				if (remove(iter->c_str()) != 0)
+					LOG_ERROR("Cannot delete file '%s' of the rotating file writer, error was: %d", iter->c_str(), errno);
+				if (self->m_Summary != NULL)
+					remove(PcapFileSummary::getDefaultSummaryFileName(*iter).c_str());
+			}
+			pthread_mutex_lock(&self->m_Mutex);
+			continue;
+		}
+
+		if (self->m_StopRequested)
+			break;
+
+		pthread_cond_wait(&self->m_WorkAvailable, &self->m_Mutex);
+	}
+	pthread_mutex_unlock(&self->m_Mutex);
+
+	return NULL;
+}
+
+bool RotatingFileWriterDevice::writePacket(RawPacket const& packet)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device not opened");
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	uint64_t capturedLen = (uint64_t)((RawPacket&)packet).getRawDataLen();
+	uint64_t recordLen = (m_Config.pcapNg ? PcapNgPacketBlockOverhead + ((capturedLen + 3) & ~(uint64_t)3) : PcapRecordHeaderSize + capturedLen);
+	time_t packetTime = packet.getPacketTimeStampNs().tv_sec;
+
+	if (m_CurrentFileNumOfPackets > 0 &&
+			((m_Config.maxFileSize > 0 && m_CurrentFileSize + recordLen > m_Config.maxFileSize) ||
+			(m_Config.maxFileDuration > 0 && packetTime - m_CurrentFileStartTime >= (time_t)m_Config.maxFileDuration)))
+		rollOver();
+
+	if (m_CurrentFileNumOfPackets == 0)
+		m_CurrentFileStartTime = packetTime;
+
+	// packets the file writer device doesn't write are counted in its statistics
+	if (!m_CurrentWriter->writePacket(packet))
+		return false;
+
+	m_CurrentFileSize += recordLen;
+	m_CurrentFileNumOfPackets++;
+	return true;
+}
+
+bool RotatingFileWriterDevice::writePackets(const RawPacketVector& packets)
+{
+	bool result = true;
+	for (RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+	{
+		if (!writePacket(**iter))
+			result = false;
+	}
+
+	return result;
+}
+
+bool RotatingFileWriterDevice::open()
+{
+	if (m_DeviceOpened)
+	{
+		LOG_DEBUG("Rotating file writer '%s' already opened. Nothing to do", m_FileName);
+		return true;
+	}
+
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfPacketsWritten = 0;
+	m_FileNames.clear();
+	m_NextFileNumber = 0;
+
+	std::string fileName = getFileName(m_NextFileNumber++);
+	m_CurrentWriter = openWriter(fileName);
+	if (m_CurrentWriter == NULL)
+		return false;
+
+	m_CurrentFileName = fileName;
+	m_FileNames.push_back(fileName);
+	m_CurrentFileSize = (m_Config.pcapNg ? 0 : PcapFileHeaderSize);
+	m_CurrentFileNumOfPackets = 0;
+	m_NextWriter = NULL;
+	m_PrepareRequested = false;
+	m_PrepareFailed = false;
+	m_StopRequested = false;
+	pthread_mutex_init(&m_Mutex, NULL);
+	pthread_cond_init(&m_WorkAvailable, NULL);
+	pthread_cond_init(&m_NextWriterReady, NULL);
+
+	int err = pthread_create(&m_HousekeepingThread, NULL, housekeepingThreadMain, this);
+	if (err != 0)
+	{
+		LOG_ERROR("Cannot create the housekeeping thread of rotating file writer '%s': [%s]", m_FileName, strerror(err));
+		closeWriter(m_CurrentWriter);
+		m_CurrentWriter = NULL;
+		m_CurrentFileName = "";
+		pthread_cond_destroy(&m_NextWriterReady);
+		pthread_cond_destroy(&m_WorkAvailable);
+		pthread_mutex_destroy(&m_Mutex);
+		return false;
+	}
+
+	// the next file is opened in advance only if there will be one
+	if (m_Config.maxFileSize > 0 || m_Config.maxFileDuration > 0)
+	{
+		pthread_mutex_lock(&m_Mutex);
+		requestNextWriter();
+		pthread_mutex_unlock(&m_Mutex);
+	}
+
+	m_DeviceOpened = true;
+	LOG_DEBUG("Rotating file writer '%s' opened successfully", m_FileName);
+	return true;
+}
+
+bool RotatingFileWriterDevice::open(bool appendMode)
+{
+	if (!appendMode)
+		return open();
+
+	LOG_ERROR("Rotating file writer '%s' can't be opened in append mode", m_FileName);
+	return false;
+}
+
+void RotatingFileWriterDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	// the housekeeping thread closes the previous files before it exits
+	pthread_mutex_lock(&m_Mutex);
+	m_StopRequested = true;
+	pthread_cond_signal(&m_WorkAvailable);
+	pthread_mutex_unlock(&m_Mutex);
+	pthread_join(m_HousekeepingThread, NULL);
+
+	closeWriter(m_CurrentWriter);
+	m_CurrentWriter = NULL;
+
+	// the next file was opened in advance but never written, so it isn't kept
+	if (m_NextWriter != NULL)
+	{
+		closeWriter(m_NextWriter);
+		m_NextWriter = NULL;
+		remove(m_NextFileName.c_str());
+		if (m_Summary != NULL)
+			remove(PcapFileSummary::getDefaultSummaryFileName(m_NextFileName).c_str());
+	}
+
+	pthread_cond_destroy(&m_NextWriterReady);
+	pthread_cond_destroy(&m_WorkAvailable);
+	pthread_mutex_destroy(&m_Mutex);
+
+	m_CurrentFileName = "";
+	IFileDevice::close();
+	LOG_DEBUG("Rotating file writer '%s' closed", m_FileName);
+}
+
+void RotatingFileWriterDevice::getStatistics(pcap_stat& stats)
+{
+	if (m_DeviceOpened)
+		pthread_mutex_lock(&m_Mutex);
+
+	stats.ps_recv = m_NumOfPacketsWritten;
+	stats.ps_drop = m_NumOfPacketsNotWritten;
+	stats.ps_ifdrop = 0;
+	if (m_CurrentWriter != NULL)
+	{
+		pcap_stat currentFileStats;
+		m_CurrentWriter->getStatistics(currentFileStats);
+		stats.ps_recv += currentFileStats.ps_recv;
+		stats.ps_drop += currentFileStats.ps_drop;
+	}
+
+	if (m_DeviceOpened)
+		pthread_mutex_unlock(&m_Mutex);
+}
+
+} // namespace pcpp
@@ -0,0 +1,712 @@
+#define LOG_MODULE PcapLogModuleSharedMemoryRingDevice
+
+#include "SharedMemoryRingDevice.h"
+#include "Logger.h"
+#include <string.h>
+#include <errno.h>
+#ifdef LINUX
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#endif
+
+#define RING_MAGIC 0x50435252
+#define RING_VERSION 1
+#define RING_CACHE_LINE_SIZE 64
+
+// how long a reader waiting for packets sleeps between checks of the write index
+#define READER_POLL_INTERVAL_US 50
+
+// reader entry states: a reader claims a free entry, sets it up and then marks it active
+#define READER_FREE 0
+#define READER_CLAIMED 1
+#define READER_ACTIVE 2
+
+namespace pcpp
+{
+
+// the ring starts with this header, followed by the reader entries and the slots, each aligned to a cache line. All processes must
+// have the same layout, so the fields have fixed sizes
+struct SharedRingHeader
+{
+	volatile uint32_t magic;
+	uint32_t version;
+	uint32_t numOfSlots;
+	uint32_t slotSize;
+	uint32_t slotStride;
+	uint32_t maxReaders;
+	volatile uint32_t writerClosed;
+	uint32_t reserved;
+	uint64_t slotsOffset;
+	uint8_t padding1[RING_CACHE_LINE_SIZE - 40];
+	// the number of packets published, which is the index of the next packet
+	volatile uint64_t writeIndex;
+	uint8_t padding2[RING_CACHE_LINE_SIZE - 8];
+};
+
+// a reader holds the packets in [holdStart, holdEnd), which the writer doesn't overwrite
+struct SharedRingReader
+{
+	volatile uint32_t state;
+	int32_t pid;
+	volatile uint64_t holdStart;
+	volatile uint64_t holdEnd;
+	uint8_t padding[RING_CACHE_LINE_SIZE - 24];
+};
+
+// the packet data follows the slot header. The sequence is 2*index+1 while packet #index is written and 2*index+2 once it's complete,
+// so a reader can tell whether a slot still holds the packet it expects
+struct SharedRingSlot
+{
+	volatile uint64_t sequence;
+	int64_t timestampSec;
+	int64_t timestampNsec;
+	uint32_t dataLen;
+	uint32_t frameLen;
+	uint16_t linkType;
+	uint8_t padding[6];
+};
+
+static inline size_t alignToCacheLine(size_t size)
+{
+	return (size + RING_CACHE_LINE_SIZE - 1) & ~(size_t)(RING_CACHE_LINE_SIZE - 1);
+}
+
+static inline SharedRingHeader* getRingHeader(uint8_t* map)
+{
+	return (SharedRingHeader*)map;
+}
+
+static inline SharedRingReader* getRingReader(uint8_t* map, uint32_t readerId)
+{
+	return (SharedRingReader*)(map + sizeof(SharedRingHeader)) + readerId;
+}
+
+static inline SharedRingSlot* getRingSlot(uint8_t* map, uint64_t packetIndex)
+{
+	SharedRingHeader* header = getRingHeader(map);
+	return (SharedRingSlot*)(map + header->slotsOffset + (size_t)(packetIndex & (header->numOfSlots - 1)) * header->slotStride);
+}
+
+#ifdef LINUX
+
+static inline uint64_t atomicLoad(const volatile uint64_t* value) { return __atomic_load_n(value, __ATOMIC_SEQ_CST); }
+static inline void atomicStore(volatile uint64_t* value, uint64_t newValue) { __atomic_store_n(value, newValue, __ATOMIC_SEQ_CST); }
+static inline uint32_t atomicLoad(const volatile uint32_t* value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+static inline void atomicStore(volatile uint32_t* value, uint32_t newValue) { __atomic_store_n(value, newValue, __ATOMIC_RELEASE); }
+static inline bool atomicCompareExchange(volatile uint32_t* value, uint32_t expected, uint32_t newValue)
+{
+	return __atomic_compare_exchange_n(value, &expected, newValue, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+// open the file of the ring: a POSIX shared memory object, or a file in the hugetlbfs directory
+static int openRingFile(const std::string& name, const std::string& hugePageDirectory, int flags)
+{
+	if (hugePageDirectory.empty())
+		return shm_open(name.c_str(), flags, 0660);
+
+	std::string path = hugePageDirectory + "/" + (name.size() > 0 && name[0] == '/' ? name.substr(1) : name);
+	return ::open(path.c_str(), flags, 0660);
+}
+
+static void removeRingFile(const std::string& name, const std::string& hugePageDirectory)
+{
+	if (hugePageDirectory.empty())
+	{
+		shm_unlink(name.c_str());
+		return;
+	}
+
+	std::string path = hugePageDirectory + "/" + (name.size() > 0 && name[0] == '/' ? name.substr(1) : name);
+	unlink(path.c_str());
+}
+
+#endif // LINUX
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// SharedMemoryRingWriterDevice
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+SharedMemoryRingWriterDevice::SharedMemoryRingWriterDevice(const SharedMemoryRingConfiguration& config) : m_Config(config)
+{
+	m_Map = NULL;
+	m_MapSize = 0;
+	m_WriteIndex = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+SharedMemoryRingWriterDevice::~SharedMemoryRingWriterDevice()
+{
+	close();
+}
+
+bool SharedMemoryRingWriterDevice::open()
+{
+#ifdef LINUX
+
+	if (m_DeviceOpened)
+	{
+		LOG_ERROR("Shared memory ring '%s' already opened", m_Config.name.c_str());
+		return false;
+	}
+
+	if (m_Config.numOfSlots < 2 || m_Config.numOfSlots > 0x80000000 || m_Config.slotSize == 0 || m_Config.maxReaders == 0)
+	{
+		LOG_ERROR("Invalid configuration for shared memory ring '%s'", m_Config.name.c_str());
+		return false;
+	}
+
+	uint32_t numOfSlots = 1;
+	while (numOfSlots < m_Config.numOfSlots)
+		numOfSlots <<= 1;
+	m_Config.numOfSlots = numOfSlots;
+
+	size_t slotStride = alignToCacheLine(sizeof(SharedRingSlot) + m_Config.slotSize);
+	size_t slotsOffset = sizeof(SharedRingHeader) + (size_t)m_Config.maxReaders * sizeof(SharedRingReader);
+	size_t ringSize = slotsOffset + (size_t)numOfSlots * slotStride;
+
+	// a ring left by a writer which didn't close it is replaced. Readers still attached to it keep their mapping
+	removeRingFile(m_Config.name, m_Config.hugePageDirectory);
+	int fd = openRingFile(m_Config.name, m_Config.hugePageDirectory, O_RDWR | O_CREAT | O_EXCL);
+	if (fd < 0)
+	{
+		LOG_ERROR("Cannot create shared memory ring '%s': %s", m_Config.name.c_str(), strerror(errno));
+		return false;
+	}
+
+	// the size of a file on hugetlbfs must be a multiple of the huge page size, which is the block size of the file system
+	size_t pageSize = (size_t)getpagesize();
+	struct statfs fsStats;
+	if (!m_Config.hugePageDirectory.empty() && fstatfs(fd, &fsStats) == 0 && fsStats.f_bsize > 0)
+		pageSize = (size_t)fsStats.f_bsize;
+	m_MapSize = (ringSize + pageSize - 1) / pageSize * pageSize;
+
+	if (ftruncate(fd, (off_t)m_MapSize) != 0)
+	{
+		LOG_ERROR("Cannot set the size of shared memory ring '%s' to %d bytes: %s", m_Config.name.c_str(), (int)m_MapSize, strerror(errno));
+		::close(fd);
+		removeRingFile(m_Config.name, m_Config.hugePageDirectory);
+		return false;
+	}
+
+	void* map = mmap(NULL, m_MapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+	{
+		LOG_ERROR("Cannot map shared memory ring '%s': %s", m_Config.name.c_str(), strerror(errno));
+		removeRingFile(m_Config.name, m_Config.hugePageDirectory);
+		return false;
+	}
+
+	// the new file is zeroed, so all reader entries are free and no slot holds a packet. Readers check the magic number last
+	m_Map = (uint8_t*)map;
+	SharedRingHeader* header = getRingHeader(m_Map);
+	header->version = RING_VERSION;
+	header->numOfSlots = numOfSlots;
+	header->slotSize = m_Config.slotSize;
+	header->slotStride = (uint32_t)slotStride;
+	header->maxReaders = m_Config.maxReaders;
+	header->slotsOffset = slotsOffset;
+	atomicStore(&header->magic, (uint32_t)RING_MAGIC);
+
+	m_WriteIndex = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_DeviceOpened = true;
+	LOG_DEBUG("Shared memory ring '%s' opened with %d slots of %d bytes", m_Config.name.c_str(), (int)numOfSlots, (int)m_Config.slotSize);
+	return true;
+
+#else
+
+	LOG_ERROR("Shared memory rings are supported on Linux only");
+	return false;
+
+#endif // LINUX
+}
+
+void SharedMemoryRingWriterDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+#ifdef LINUX
+	atomicStore(&getRingHeader(m_Map)->writerClosed, 1);
+	munmap(m_Map, m_MapSize);
+	removeRingFile(m_Config.name, m_Config.hugePageDirectory);
+#endif
+
+	m_Map = NULL;
+	m_MapSize = 0;
+	m_DeviceOpened = false;
+	LOG_DEBUG("Shared memory ring '%s' closed", m_Config.name.c_str());
+}
+
+bool SharedMemoryRingWriterDevice::sendPacket(const RawPacket& rawPacket)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Shared memory ring '%s' isn't opened", m_Config.name.c_str());
+		return false;
+	}
+
+	bool written = writePacket(rawPacket);
+	publish();
+	return written;
+}
+
+int SharedMemoryRingWriterDevice::sendPackets(const RawPacket* rawPacketsArr, int arrLength)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Shared memory ring '%s' isn't opened", m_Config.name.c_str());
+		return 0;
+	}
+
+	int packetsWritten = 0;
+	for (int i = 0; i < arrLength; i++)
+	{
+		if (writePacket(rawPacketsArr[i]))
+			packetsWritten++;
+	}
+
+	publish();
+	return packetsWritten;
+}
+
+int SharedMemoryRingWriterDevice::sendPackets(const RawPacketVector& rawPackets)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Shared memory ring '%s' isn't opened", m_Config.name.c_str());
+		return 0;
+	}
+
+	int packetsWritten = 0;
+	for (RawPacketVector::ConstVectorIterator iter = rawPackets.begin(); iter != rawPackets.end(); iter++)
+	{
+		if (writePacket(**iter))
+			packetsWritten++;
+	}
+
+	publish();
+	return packetsWritten;
+}
+
+bool SharedMemoryRingWriterDevice::writePacket(const RawPacket& rawPacket)
+{
+#ifdef LINUX
+
+	uint64_t packetIndex = m_WriteIndex;
+	SharedRingSlot* slot = getRingSlot(m_Map, packetIndex);
+	atomicStore(&slot->sequence, 2 * packetIndex + 1);
+
+	// the slot is marked as being written before the holds are checked, and a reader marks its hold before it checks the slots, so
+	// either the writer sees the hold or the reader sees the slot changing
+	if (packetIndex >= m_Config.numOfSlots && isSlotHeld(packetIndex - m_Config.numOfSlots))
+	{
+		atomicStore(&slot->sequence, 2 * (packetIndex - m_Config.numOfSlots) + 2);
+		m_Stats.drops++;
+		return false;
+	}
+
+	uint32_t dataLen = (uint32_t)rawPacket.getRawDataLen();
+	if (dataLen > m_Config.slotSize)
+	{
+		dataLen = m_Config.slotSize;
+		m_Stats.truncated++;
+	}
+
+	timespec timestamp = rawPacket.getPacketTimeStampNs();
+	slot->timestampSec = (int64_t)timestamp.tv_sec;
+	slot->timestampNsec = (int64_t)timestamp.tv_nsec;
+	slot->dataLen = dataLen;
+	slot->frameLen = (uint32_t)rawPacket.getFrameLength();
+	slot->linkType = (uint16_t)rawPacket.getLinkLayerType();
+	memcpy((uint8_t*)slot + sizeof(SharedRingSlot), rawPacket.getRawData(), dataLen);
+	__atomic_store_n(&slot->sequence, 2 * packetIndex + 2, __ATOMIC_RELEASE);
+
+	m_WriteIndex++;
+	m_Stats.packets++;
+	m_Stats.bytes += dataLen;
+	return true;
+
+#else
+	return false;
+#endif // LINUX
+}
+
+bool SharedMemoryRingWriterDevice::isSlotHeld(uint64_t packetIndex)
+{
+#ifdef LINUX
+
+	for (uint32_t readerId = 0; readerId < m_Config.maxReaders; readerId++)
+	{
+		SharedRingReader* reader = getRingReader(m_Map, readerId);
+		if (atomicLoad(&reader->state) != READER_ACTIVE)
+			continue;
+
+		if (packetIndex < atomicLoad(&reader->holdStart) || packetIndex >= atomicLoad(&reader->holdEnd))
+			continue;
+
+		// a reader which died while holding packets would stop the writer, so it's detached
+		if (kill((pid_t)reader->pid, 0) != 0 && errno == ESRCH)
+		{
+			LOG_DEBUG("Detaching reader %d of shared memory ring '%s' whose process %d doesn't exist", (int)readerId, m_Config.name.c_str(), (int)reader->pid);
+			atomicStore(&reader->holdEnd, 0);
+			atomicStore(&reader->holdStart, 0);
+			atomicCompareExchange(&reader->state, READER_ACTIVE, READER_FREE);
+			continue;
+		}
+
+		return true;
+	}
+
+#endif // LINUX
+
+	return false;
+}
+
+void SharedMemoryRingWriterDevice::publish()
+{
+#ifdef LINUX
+	__atomic_store_n(&getRingHeader(m_Map)->writeIndex, m_WriteIndex, __ATOMIC_RELEASE);
+#endif
+}
+
+int SharedMemoryRingWriterDevice::getNumOfReaders() const
+{
+	if (!m_DeviceOpened)
+		return 0;
+
+	int numOfReaders = 0;
+#ifdef LINUX
+	for (uint32_t readerId = 0; readerId < m_Config.maxReaders; readerId++)
+	{
+		if (atomicLoad(&getRingReader(m_Map, readerId)->state) == READER_ACTIVE)
+			numOfReaders++;
+	}
+#endif
+
+	return numOfReaders;
+}
+
+void SharedMemoryRingWriterDevice::getStatistics(SharedMemoryRingStats& stats) const
+{
+	stats = m_Stats;
+}
+
+void SharedMemoryRingWriterDevice::collectMetrics(MetricsWriter& writer)
+{
+	if (!m_DeviceOpened)
+		return;
+
+	writer.addCounter("pcpp_device_tx_packets_total", "Packets written to the shared memory ring", m_Stats.packets);
+	writer.addCounter("pcpp_device_tx_bytes_total", "Bytes written to the shared memory ring", m_Stats.bytes);
+	writer.addCounter("pcpp_device_tx_dropped_packets_total", "Packets dropped because their slot was held by a reader", m_Stats.drops);
+	writer.addGauge("pcpp_device_shared_ring_readers", "Readers attached to the shared memory ring", (double)getNumOfReaders());
+}
+
+void SharedMemoryRingWriterDevice::onPacketArrives(RawPacket* packet, PcapLiveDevice* pDevice, void* userCookie)
+{
+	SharedMemoryRingWriterDevice* pThis = (SharedMemoryRingWriterDevice*)userCookie;
+	pThis->sendPackets(packet, 1);
+}
+
+void SharedMemoryRingWriterDevice::onPacketsArriveBurst(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* pDevice, void* userCookie)
+{
+	SharedMemoryRingWriterDevice* pThis = (SharedMemoryRingWriterDevice*)userCookie;
+	pThis->sendPackets(packets, (int)numOfPackets);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// SharedMemoryRingReaderDevice
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+SharedMemoryRingReaderDevice::SharedMemoryRingReaderDevice(const std::string& name, const std::string& hugePageDirectory) :
+	m_Name(name), m_HugePageDirectory(hugePageDirectory)
+{
+	m_Map = NULL;
+	m_MapSize = 0;
+	m_ReaderId = -1;
+	m_ReadIndex = 0;
+	m_Packets = NULL;
+	m_PacketsCapacity = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+SharedMemoryRingReaderDevice::~SharedMemoryRingReaderDevice()
+{
+	close();
+}
+
+bool SharedMemoryRingReaderDevice::open()
+{
+#ifdef LINUX
+
+	if (m_DeviceOpened)
+	{
+		LOG_ERROR("Shared memory ring '%s' already opened", m_Name.c_str());
+		return false;
+	}
+
+	int fd = openRingFile(m_Name, m_HugePageDirectory, O_RDWR);
+	if (fd < 0)
+	{
+		LOG_ERROR("Cannot open shared memory ring '%s': %s", m_Name.c_str(), strerror(errno));
+		return false;
+	}
+
+	struct stat fileStats;
+	if (fstat(fd, &fileStats) != 0 || (size_t)fileStats.st_size < sizeof(SharedRingHeader))
+	{
+		LOG_ERROR("Shared memory ring '%s' isn't valid", m_Name.c_str());
+		::close(fd);
+		return false;
+	}
+
+	m_MapSize = (size_t)fileStats.st_size;
+	void* map = mmap(NULL, m_MapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+	{
+		LOG_ERROR("Cannot map shared memory ring '%s': %s", m_Name.c_str(), strerror(errno));
+		return false;
+	}
+
+	m_Map = (uint8_t*)map;
+	SharedRingHeader* header = getRingHeader(m_Map);
+	if (atomicLoad(&header->magic) != RING_MAGIC || header->version != RING_VERSION || header->numOfSlots == 0 ||
+			(header->numOfSlots & (header->numOfSlots - 1)) != 0 ||
+			header->slotsOffset + (uint64_t)header->numOfSlots * header->slotStride > m_MapSize)
+	{
+		LOG_ERROR("Shared memory ring '%s' isn't valid or isn't initialized yet", m_Name.c_str());
+		munmap(m_Map, m_MapSize);
+		m_Map = NULL;
+		return false;
+	}
+
+	m_ReaderId = -1;
+	for (uint32_t readerId = 0; readerId < header->maxReaders; readerId++)
+	{
+		SharedRingReader* reader = getRingReader(m_Map, readerId);
+		if (atomicCompareExchange(&reader->state, READER_FREE, READER_CLAIMED))
+		{
+			reader->pid = (int32_t)getpid();
+			atomicStore(&reader->holdEnd, 0);
+			atomicStore(&reader->holdStart, 0);
+			atomicStore(&reader->state, READER_ACTIVE);
+			m_ReaderId = (int)readerId;
+			break;
+		}
+	}
+
+	if (m_ReaderId < 0)
+	{
+		LOG_ERROR("Shared memory ring '%s' already has the maximum number of readers (%d)", m_Name.c_str(), (int)header->maxReaders);
+		munmap(m_Map, m_MapSize);
+		m_Map = NULL;
+		return false;
+	}
+
+	// a burst holds at most a quarter of the ring, so the writer has room to continue while it's processed
+	m_PacketsCapacity = (int)(header->numOfSlots / 4 > 0 ? header->numOfSlots / 4 : 1);
+	m_Packets = new RawPacket[m_PacketsCapacity];
+	m_ReadIndex = atomicLoad(&header->writeIndex);
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_DeviceOpened = true;
+	LOG_DEBUG("Attached to shared memory ring '%s' as reader %d", m_Name.c_str(), m_ReaderId);
+	return true;
+
+#else
+
+	LOG_ERROR("Shared memory rings are supported on Linux only");
+	return false;
+
+#endif // LINUX
+}
+
+void SharedMemoryRingReaderDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+#ifdef LINUX
+	SharedRingReader* reader = getRingReader(m_Map, (uint32_t)m_ReaderId);
+	atomicStore(&reader->holdEnd, 0);
+	atomicStore(&reader->holdStart, 0);
+	atomicStore(&reader->state, READER_FREE);
+	munmap(m_Map, m_MapSize);
+#endif
+
+	delete [] m_Packets;
+	m_Packets = NULL;
+	m_PacketsCapacity = 0;
+	m_Map = NULL;
+	m_MapSize = 0;
+	m_ReaderId = -1;
+	m_DeviceOpened = false;
+	LOG_DEBUG("Detached from shared memory ring '%s'", m_Name.c_str());
+}
+
+void SharedMemoryRingReaderDevice::releasePackets()
+{
+	if (!m_DeviceOpened)
+		return;
+
+#ifdef LINUX
+	SharedRingReader* reader = getRingReader(m_Map, (uint32_t)m_ReaderId);
+	atomicStore(&reader->holdEnd, 0);
+	atomicStore(&reader->holdStart, 0);
+#endif
+}
+
+int SharedMemoryRingReaderDevice::receivePackets(RawPacket*& packets, int maxCount, int timeoutMs)
+{
+	packets = m_Packets;
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Shared memory ring '%s' isn't opened", m_Name.c_str());
+		return -1;
+	}
+
+	releasePackets();
+	if (maxCount <= 0)
+		return 0;
+
+	int numOfPackets = readPackets(maxCount);
+	if (numOfPackets > 0 || timeoutMs == 0)
+		return numOfPackets;
+
+#ifdef LINUX
+	timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (numOfPackets == 0 && !isWriterClosed())
+	{
+		if (timeoutMs > 0)
+		{
+			timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			int64_t elapsedMs = (int64_t)(now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+			if (elapsedMs >= timeoutMs)
+				break;
+		}
+
+		usleep(READER_POLL_INTERVAL_US);
+		numOfPackets = readPackets(maxCount);
+	}
+
+	// packets written right before the writer closed the ring
+	if (numOfPackets == 0)
+		numOfPackets = readPackets(maxCount);
+#endif
+
+	return numOfPackets;
+}
+
+int SharedMemoryRingReaderDevice::readPackets(int maxCount)
+{
+#ifdef LINUX
+
+	SharedRingHeader* header = getRingHeader(m_Map);
+	SharedRingReader* reader = getRingReader(m_Map, (uint32_t)m_ReaderId);
+	uint64_t numOfSlots = header->numOfSlots;
+	if (maxCount > m_PacketsCapacity)
+		maxCount = m_PacketsCapacity;
+
+	while (true)
+	{
+		uint64_t writeIndex = __atomic_load_n(&header->writeIndex, __ATOMIC_ACQUIRE);
+		if (m_ReadIndex >= writeIndex)
+			return 0;
+
+		// packets more than the ring size behind were overwritten. The reader continues from the middle of the ring, since the oldest
+		// packets are the next ones to be overwritten and holding them would make the writer drop packets
+		if (writeIndex - m_ReadIndex > numOfSlots)
+		{
+			m_Stats.drops += writeIndex - numOfSlots / 2 - m_ReadIndex;
+			m_ReadIndex = writeIndex - numOfSlots / 2;
+		}
+
+		uint64_t endIndex = m_ReadIndex + (uint64_t)maxCount;
+		if (endIndex > writeIndex)
+			endIndex = writeIndex;
+
+		// hold the packets, then check the writer didn't start overwriting them before it could see the hold. It writes the slots in
+		// order, so the packets before the last overwritten one are gone as well
+		atomicStore(&reader->holdStart, m_ReadIndex);
+		atomicStore(&reader->holdEnd, endIndex);
+		uint64_t firstValidIndex = m_ReadIndex;
+		for (uint64_t packetIndex = m_ReadIndex; packetIndex < endIndex; packetIndex++)
+		{
+			if (atomicLoad(&getRingSlot(m_Map, packetIndex)->sequence) != 2 * packetIndex + 2)
+				firstValidIndex = packetIndex + 1;
+		}
+
+		if (firstValidIndex != m_ReadIndex)
+		{
+			m_Stats.drops += firstValidIndex - m_ReadIndex;
+			m_ReadIndex = firstValidIndex;
+			continue;
+		}
+
+		int numOfPackets = 0;
+		for (uint64_t packetIndex = m_ReadIndex; packetIndex < endIndex; packetIndex++, numOfPackets++)
+		{
+			SharedRingSlot* slot = getRingSlot(m_Map, packetIndex);
+			timespec timestamp;
+			timestamp.tv_sec = (time_t)slot->timestampSec;
+			timestamp.tv_nsec = (long)slot->timestampNsec;
+			m_Packets[numOfPackets].setExternalRawData((uint8_t*)slot + sizeof(SharedRingSlot), (int)slot->dataLen, timestamp,
+					(LinkLayerType)slot->linkType, (int)slot->frameLen);
+			m_Stats.bytes += slot->dataLen;
+		}
+
+		m_ReadIndex = endIndex;
+		m_Stats.packets += (uint64_t)numOfPackets;
+		return numOfPackets;
+	}
+
+#else
+	return 0;
+#endif // LINUX
+}
+
+bool SharedMemoryRingReaderDevice::isWriterClosed() const
+{
+#ifdef LINUX
+	if (m_DeviceOpened)
+		return atomicLoad(&getRingHeader(m_Map)->writerClosed) != 0;
+#endif
+
+	return true;
+}
+
+uint32_t SharedMemoryRingReaderDevice::getNumOfSlots() const
+{
+	if (!m_DeviceOpened)
+		return 0;
+
+	return getRingHeader(m_Map)->numOfSlots;
+}
+
+void SharedMemoryRingReaderDevice::getStatistics(SharedMemoryRingStats& stats) const
+{
+	stats = m_Stats;
+}
+
+void SharedMemoryRingReaderDevice::collectMetrics(MetricsWriter& writer)
+{
+	if (!m_DeviceOpened)
+		return;
+
+	writer.addCounter("pcpp_device_rx_packets_total", "Packets received from the shared memory ring", m_Stats.packets);
+	writer.addCounter("pcpp_device_rx_bytes_total", "Bytes received from the shared memory ring", m_Stats.bytes);
+	writer.addCounter("pcpp_device_rx_dropped_packets_total", "Packets overwritten before the reader received them", m_Stats.drops);
+}
+
+} // namespace pcpp
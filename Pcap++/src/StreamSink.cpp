@@ -0,0 +1,950 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include "StreamSink.h"
+#include "StateCheckpoint.h"
+#include "Logger.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+// the maximum number of chunks written by a single writev() call, well below IOV_MAX of all OS's
+#define PCPP_STREAM_SINK_MAX_SEGMENTS 64
+
+// the magic numbers of the header and the trailer of container files, and of their index
+#define PCPP_STREAM_CONTAINER_MAGIC 0x4b535350
+#define PCPP_STREAM_CONTAINER_INDEX_MAGIC 0x58444953
+#define PCPP_STREAM_CONTAINER_VERSION 1
+
+namespace pcpp
+{
+
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+// Windows has no writev(), the segments are written one by one
+struct iovec
+{
+	void* iov_base;
+	size_t iov_len;
+};
+#endif
+
+// the header of a container file: the magic number, the version and a reserved field
+static const size_t ContainerHeaderLen = 8;
+// the header of a container record: the stream ID and the data length
+static const size_t ContainerRecordHeaderLen = 12;
+// the trailer of a container file: the offset of the index and the magic number
+static const size_t ContainerTrailerLen = 12;
+
+// write all segments, continuing after partial writes. Returns false on an error
+static bool writeSegments(int fd, iovec* segments, int numOfSegments, uint64_t& numOfWriteCalls)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	for (int i = 0; i < numOfSegments; i++)
+	{
+		uint8_t* data = (uint8_t*)segments[i].iov_base;
+		size_t len = segments[i].iov_len;
+		while (len > 0)
+		{
+			int written = _write(fd, data, (unsigned int)len);
+			numOfWriteCalls++;
+			if (written < 0)
+				return false;
+			data += written;
+			len -= (size_t)written;
+		}
+	}
+
+	return true;
+#else
+	while (numOfSegments > 0)
+	{
+		ssize_t written = writev(fd, segments, numOfSegments);
+		numOfWriteCalls++;
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		// skip the segments which were written completely, and the written part of the next one
+		size_t remaining = (size_t)written;
+		while (numOfSegments > 0 && remaining >= segments->iov_len)
+		{
+			remaining -= segments->iov_len;
+			segments++;
+			numOfSegments--;
+		}
+
+		if (numOfSegments > 0)
+		{
+			segments->iov_base = (uint8_t*)segments->iov_base + remaining;
+			segments->iov_len -= remaining;
+		}
+	}
+
+	return true;
+#endif
+}
+
+static int openFileForWriting(const std::string& fileName, bool append)
+{
+	int flags = (append ? O_WRONLY | O_APPEND : O_WRONLY | O_CREAT | O_TRUNC);
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	return _open(fileName.c_str(), flags | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+	return ::open(fileName.c_str(), flags, 0644);
+#endif
+}
+
+static void closeFileDescriptor(int fd)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	_close(fd);
+#else
+	::close(fd);
+#endif
+}
+
+StreamSink::StreamSink(const StreamSinkConfiguration& config) :
+	m_Config(config), m_OpenFiles(config.maxOpenFiles > 0 ? config.maxOpenFiles : 1)
+{
+	if (m_Config.chunkSize == 0)
+		m_Config.chunkSize = PCPP_STREAM_SINK_DEFAULT_CHUNK_SIZE;
+
+	m_MaxNumOfChunks = m_Config.memoryBudget / m_Config.chunkSize;
+	if (m_MaxNumOfChunks == 0)
+		m_MaxNumOfChunks = 1;
+
+	// when writing asynchronously the largest stream is handed to the I/O thread before the budget is used up, so the I/O thread writes
+	// while the rest of the budget fills. When writing synchronously the budget is used up first, which makes the fewest writes
+	m_HandOffThreshold = (m_Config.asynchronous ? m_MaxNumOfChunks - m_MaxNumOfChunks / 4 : m_MaxNumOfChunks);
+
+	m_Opened = false;
+	m_LargestBucket = 0;
+	m_LocalFreeChunks = NULL;
+	m_NumOfBufferedChunks = 0;
+	m_NumOfBytesAccepted = 0;
+	m_NumOfPendingRequests = 0;
+	m_FreeChunks = NULL;
+	m_NumOfChunks = 0;
+	m_StopRequested = false;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	memset(&m_IOStats, 0, sizeof(m_IOStats));
+	m_ContainerFd = -1;
+	m_ContainerOffset = 0;
+
+	pthread_mutex_init(&m_Mutex, NULL);
+	pthread_cond_init(&m_WorkAvailable, NULL);
+	pthread_cond_init(&m_WorkDone, NULL);
+}
+
+StreamSink::~StreamSink()
+{
+	close();
+
+	pthread_cond_destroy(&m_WorkDone);
+	pthread_cond_destroy(&m_WorkAvailable);
+	pthread_mutex_destroy(&m_Mutex);
+}
+
+bool StreamSink::open()
+{
+	if (m_Opened)
+	{
+		LOG_ERROR("Stream sink is already opened");
+		return false;
+	}
+
+	m_Streams.clear();
+	m_Files.clear();
+	m_OpenFiles.clear();
+	m_Buckets.assign(m_MaxNumOfChunks + 1, -1);
+	m_LargestBucket = 0;
+	m_NumOfBufferedChunks = 0;
+	m_NumOfBytesAccepted = 0;
+	m_NumOfPendingRequests = 0;
+	m_StopRequested = false;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	memset(&m_IOStats, 0, sizeof(m_IOStats));
+
+	if (!m_Config.containerFileName.empty())
+	{
+		m_ContainerFd = openFileForWriting(m_Config.containerFileName, false);
+		if (m_ContainerFd < 0)
+		{
+			LOG_ERROR("Cannot open '%s' for writing, error was: %d", m_Config.containerFileName.c_str(), errno);
+			return false;
+		}
+
+		std::vector<uint8_t> header;
+		CheckpointWriter writer(header);
+		writer.writeUInt32(PCPP_STREAM_CONTAINER_MAGIC);
+		writer.writeUInt16(PCPP_STREAM_CONTAINER_VERSION);
+		writer.writeUInt16(0);
+		iovec segment;
+		segment.iov_base = &header[0];
+		segment.iov_len = header.size();
+		if (!writeSegments(m_ContainerFd, &segment, 1, m_IOStats.numOfWriteCalls))
+		{
+			LOG_ERROR("Cannot write to file '%s', error was: %d", m_Config.containerFileName.c_str(), errno);
+			closeFileDescriptor(m_ContainerFd);
+			m_ContainerFd = -1;
+			return false;
+		}
+
+		m_ContainerOffset = ContainerHeaderLen;
+	}
+
+	if (m_Config.asynchronous)
+	{
+		int err = pthread_create(&m_IOThread, NULL, ioThreadMain, this);
+		if (err != 0)
+		{
+			LOG_ERROR("Cannot create I/O thread: [%s]", strerror(err));
+			if (m_ContainerFd >= 0)
+			{
+				closeFileDescriptor(m_ContainerFd);
+				m_ContainerFd = -1;
+			}
+			return false;
+		}
+	}
+
+	m_Opened = true;
+	return true;
+}
+
+bool StreamSink::close()
+{
+	if (!m_Opened)
+		return true;
+
+	// ending the streams creates the files of streams which weren't written yet
+	for (size_t i = 0; i < m_Streams.size(); i++)
+	{
+		if (!m_Streams[i].ended)
+		{
+			handOff((int)i, true);
+			m_Streams[i].ended = true;
+		}
+	}
+
+	if (m_Config.asynchronous)
+	{
+		pthread_mutex_lock(&m_Mutex);
+		m_StopRequested = true;
+		pthread_cond_signal(&m_WorkAvailable);
+		pthread_mutex_unlock(&m_Mutex);
+		pthread_join(m_IOThread, NULL);
+	}
+
+	// the I/O thread stopped, so its state belongs to this thread now
+	if (m_ContainerFd >= 0)
+	{
+		if (!writeContainerIndex())
+			m_IOStats.numOfWriteErrors++;
+		closeFileDescriptor(m_ContainerFd);
+		m_ContainerFd = -1;
+	}
+
+	pthread_mutex_lock(&m_Mutex);
+	m_Stats = m_IOStats;
+	freeChunks(m_FreeChunks);
+	m_FreeChunks = NULL;
+	m_NumOfChunks = 0;
+	pthread_mutex_unlock(&m_Mutex);
+
+	freeChunks(m_LocalFreeChunks);
+	m_LocalFreeChunks = NULL;
+
+	m_Opened = false;
+	return m_IOStats.numOfWriteErrors == 0;
+}
+
+int StreamSink::addStream(const std::string& name)
+{
+	if (!m_Opened)
+	{
+		LOG_ERROR("Cannot add stream '%s', the stream sink isn't opened", name.c_str());
+		return -1;
+	}
+
+	StreamBuffer stream;
+	stream.firstChunk = NULL;
+	stream.lastChunk = NULL;
+	stream.numOfChunks = 0;
+	stream.ended = false;
+	stream.prevInBucket = -1;
+	stream.nextInBucket = -1;
+	m_Streams.push_back(stream);
+
+	Request request;
+	request.type = Request::AddStream;
+	request.streamId = (int)m_Streams.size() - 1;
+	request.firstChunk = NULL;
+	request.name = name;
+	submitRequest(request);
+
+	return request.streamId;
+}
+
+bool StreamSink::write(int streamId, const uint8_t* data, size_t dataLen)
+{
+	if (!m_Opened || streamId < 0 || (size_t)streamId >= m_Streams.size())
+	{
+		LOG_ERROR("Invalid stream ID %d", streamId);
+		return false;
+	}
+
+	if (m_Streams[streamId].ended)
+	{
+		LOG_ERROR("Cannot write to stream %d, it was ended", streamId);
+		return false;
+	}
+
+	// when writing synchronously the I/O state belongs to this thread
+	uint64_t numOfWriteErrors = (m_Config.asynchronous ? 0 : m_IOStats.numOfWriteErrors);
+	m_NumOfBytesAccepted += dataLen;
+
+	while (dataLen > 0)
+	{
+		if (m_Streams[streamId].lastChunk == NULL || m_Streams[streamId].lastChunk->len == m_Config.chunkSize)
+		{
+			// this may hand the stream itself to the I/O thread, so its chunks are looked at only after it
+			Chunk* chunk = acquireChunk();
+			chunk->next = NULL;
+			chunk->len = 0;
+
+			StreamBuffer& stream = m_Streams[streamId];
+			if (stream.numOfChunks > 0)
+				removeFromBucket(streamId);
+			if (stream.lastChunk == NULL)
+				stream.firstChunk = chunk;
+			else
+				stream.lastChunk->next = chunk;
+			stream.lastChunk = chunk;
+			stream.numOfChunks++;
+			m_NumOfBufferedChunks++;
+			addToBucket(streamId);
+		}
+
+		StreamBuffer& stream = m_Streams[streamId];
+		size_t toCopy = m_Config.chunkSize - stream.lastChunk->len;
+		if (toCopy > dataLen)
+			toCopy = dataLen;
+		memcpy(stream.lastChunk->data + stream.lastChunk->len, data, toCopy);
+		stream.lastChunk->len += toCopy;
+		data += toCopy;
+		dataLen -= toCopy;
+	}
+
+	return m_Config.asynchronous || m_IOStats.numOfWriteErrors == numOfWriteErrors;
+}
+
+bool StreamSink::endStream(int streamId)
+{
+	if (!m_Opened || streamId < 0 || (size_t)streamId >= m_Streams.size())
+	{
+		LOG_ERROR("Invalid stream ID %d", streamId);
+		return false;
+	}
+
+	if (m_Streams[streamId].ended)
+	{
+		LOG_ERROR("Stream %d was already ended", streamId);
+		return false;
+	}
+
+	uint64_t numOfWriteErrors = (m_Config.asynchronous ? 0 : m_IOStats.numOfWriteErrors);
+	handOff(streamId, true);
+	m_Streams[streamId].ended = true;
+
+	return m_Config.asynchronous || m_IOStats.numOfWriteErrors == numOfWriteErrors;
+}
+
+bool StreamSink::flushAll()
+{
+	if (!m_Opened)
+		return true;
+
+	for (size_t bucket = m_LargestBucket; bucket > 0; bucket--)
+	{
+		while (m_Buckets[bucket] != -1)
+			handOff(m_Buckets[bucket], false);
+	}
+	m_LargestBucket = 0;
+
+	pthread_mutex_lock(&m_Mutex);
+	while (m_NumOfPendingRequests > 0)
+		pthread_cond_wait(&m_WorkDone, &m_Mutex);
+	bool result = (m_Stats.numOfWriteErrors == 0);
+	pthread_mutex_unlock(&m_Mutex);
+
+	return result;
+}
+
+uint64_t StreamSink::getNumOfBytesWritten() const
+{
+	pthread_mutex_lock(&m_Mutex);
+	uint64_t result = m_Stats.numOfBytesWritten;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+uint64_t StreamSink::getNumOfFileOpens() const
+{
+	pthread_mutex_lock(&m_Mutex);
+	uint64_t result = m_Stats.numOfFileOpens;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+uint64_t StreamSink::getNumOfWriteCalls() const
+{
+	pthread_mutex_lock(&m_Mutex);
+	uint64_t result = m_Stats.numOfWriteCalls;
+	pthread_mutex_unlock(&m_Mutex);
+	return result;
+}
+
+void* StreamSink::ioThreadMain(void* sinkPtr)
+{
+	StreamSink* self = (StreamSink*)sinkPtr;
+	std::vector<Request> requests;
+
+	pthread_mutex_lock(&self->m_Mutex);
+	while (true)
+	{
+		while (self->m_Requests.empty() && !self->m_StopRequested)
+			pthread_cond_wait(&self->m_WorkAvailable, &self->m_Mutex);
+
+		// the sink is closed after all requests were submitted, so there is nothing left to do
+		if (self->m_Requests.empty())
+			break;
+
+		// the requests are processed without the mutex, so data keeps being buffered and handed over meanwhile
+		requests.swap(self->m_Requests);
+		pthread_mutex_unlock(&self->m_Mutex);
+
+		Chunk* writtenChunks = NULL;
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			Chunk* chunks = self->processRequest(requests[i]);
+			if (chunks == NULL)
+				continue;
+
+			Chunk* lastChunk = chunks;
+			while (lastChunk->next != NULL)
+				lastChunk = lastChunk->next;
+			lastChunk->next = writtenChunks;
+			writtenChunks = chunks;
+		}
+
+		size_t numOfRequests = requests.size();
+		requests.clear();
+
+		pthread_mutex_lock(&self->m_Mutex);
+		if (writtenChunks != NULL)
+		{
+			Chunk* lastChunk = writtenChunks;
+			while (lastChunk->next != NULL)
+				lastChunk = lastChunk->next;
+			lastChunk->next = self->m_FreeChunks;
+			self->m_FreeChunks = writtenChunks;
+		}
+		self->m_NumOfPendingRequests -= numOfRequests;
+		self->m_Stats = self->m_IOStats;
+		pthread_cond_broadcast(&self->m_WorkDone);
+	}
+	pthread_mutex_unlock(&self->m_Mutex);
+
+	return NULL;
+}
+
+StreamSink::Chunk* StreamSink::acquireChunk()
+{
+	if (m_NumOfBufferedChunks >= m_HandOffThreshold)
+	{
+		// at least one stream holds chunks, the one with the most chunks is handed over
+		while (m_LargestBucket > 0 && m_Buckets[m_LargestBucket] == -1)
+			m_LargestBucket--;
+
+		if (m_LargestBucket > 0)
+			handOff(m_Buckets[m_LargestBucket], false);
+	}
+
+	if (m_LocalFreeChunks == NULL)
+	{
+		// all free chunks are taken at once, so the mutex is taken once every few chunks. When the budget is used up, some chunks were
+		// handed over and are returned by the I/O thread when they're written
+		pthread_mutex_lock(&m_Mutex);
+		while (m_FreeChunks == NULL && m_NumOfChunks >= m_MaxNumOfChunks)
+			pthread_cond_wait(&m_WorkDone, &m_Mutex);
+
+		if (m_FreeChunks != NULL)
+		{
+			m_LocalFreeChunks = m_FreeChunks;
+			m_FreeChunks = NULL;
+			pthread_mutex_unlock(&m_Mutex);
+		}
+		else
+		{
+			m_NumOfChunks++;
+			pthread_mutex_unlock(&m_Mutex);
+
+			uint8_t* memory = new uint8_t[sizeof(Chunk) + m_Config.chunkSize];
+			Chunk* chunk = (Chunk*)memory;
+			chunk->data = memory + sizeof(Chunk);
+			return chunk;
+		}
+	}
+
+	Chunk* chunk = m_LocalFreeChunks;
+	m_LocalFreeChunks = chunk->next;
+	return chunk;
+}
+
+void StreamSink::freeChunks(Chunk* chunks)
+{
+	while (chunks != NULL)
+	{
+		Chunk* next = chunks->next;
+		delete [] (uint8_t*)chunks;
+		chunks = next;
+	}
+}
+
+void StreamSink::addToBucket(int streamId)
+{
+	StreamBuffer& stream = m_Streams[streamId];
+	size_t bucket = stream.numOfChunks;
+	stream.prevInBucket = -1;
+	stream.nextInBucket = m_Buckets[bucket];
+	if (stream.nextInBucket != -1)
+		m_Streams[stream.nextInBucket].prevInBucket = streamId;
+	m_Buckets[bucket] = streamId;
+
+	if (bucket > m_LargestBucket)
+		m_LargestBucket = bucket;
+}
+
+void StreamSink::removeFromBucket(int streamId)
+{
+	StreamBuffer& stream = m_Streams[streamId];
+	if (stream.prevInBucket != -1)
+		m_Streams[stream.prevInBucket].nextInBucket = stream.nextInBucket;
+	else
+		m_Buckets[stream.numOfChunks] = stream.nextInBucket;
+	if (stream.nextInBucket != -1)
+		m_Streams[stream.nextInBucket].prevInBucket = stream.prevInBucket;
+
+	stream.prevInBucket = -1;
+	stream.nextInBucket = -1;
+}
+
+void StreamSink::handOff(int streamId, bool endStream)
+{
+	StreamBuffer& stream = m_Streams[streamId];
+	if (stream.numOfChunks == 0 && !endStream)
+		return;
+
+	Request request;
+	request.type = (endStream ? Request::EndStream : Request::WriteStream);
+	request.streamId = streamId;
+	request.firstChunk = stream.firstChunk;
+
+	if (stream.numOfChunks > 0)
+	{
+		removeFromBucket(streamId);
+		m_NumOfBufferedChunks -= stream.numOfChunks;
+		stream.firstChunk = NULL;
+		stream.lastChunk = NULL;
+		stream.numOfChunks = 0;
+	}
+
+	submitRequest(request);
+}
+
+void StreamSink::submitRequest(Request& request)
+{
+	if (!m_Config.asynchronous)
+	{
+		releaseChunks(processRequest(request));
+		return;
+	}
+
+	pthread_mutex_lock(&m_Mutex);
+	m_Requests.push_back(Request());
+	Request& queued = m_Requests.back();
+	queued.type = request.type;
+	queued.streamId = request.streamId;
+	queued.firstChunk = request.firstChunk;
+	queued.name.swap(request.name);
+	m_NumOfPendingRequests++;
+	pthread_cond_signal(&m_WorkAvailable);
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+StreamSink::Chunk* StreamSink::processRequest(Request& request)
+{
+	switch (request.type)
+	{
+	case Request::AddStream:
+	{
+		m_Files.push_back(StreamFile());
+		StreamFile& file = m_Files.back();
+		file.name.swap(request.name);
+		file.fd = -1;
+		file.created = false;
+		file.length = 0;
+		return NULL;
+	}
+
+	case Request::WriteStream:
+		writeChunks(request.streamId, request.firstChunk);
+		return request.firstChunk;
+
+	case Request::EndStream:
+		writeChunks(request.streamId, request.firstChunk);
+		if (m_Files[request.streamId].fd >= 0)
+		{
+			m_OpenFiles.eraseElement(request.streamId);
+			closeFile(request.streamId);
+		}
+		return request.firstChunk;
+	}
+
+	return NULL;
+}
+
+void StreamSink::releaseChunks(Chunk* chunks)
+{
+	pthread_mutex_lock(&m_Mutex);
+	if (chunks != NULL)
+	{
+		Chunk* lastChunk = chunks;
+		while (lastChunk->next != NULL)
+			lastChunk = lastChunk->next;
+		lastChunk->next = m_FreeChunks;
+		m_FreeChunks = chunks;
+	}
+	m_Stats = m_IOStats;
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+bool StreamSink::openFile(int streamId)
+{
+	if (m_Files[streamId].fd >= 0)
+	{
+		// make the file the most recently written one
+		m_OpenFiles.put(streamId);
+		return true;
+	}
+
+	// the least recently written file is closed before the file is opened, so no more than the limit are open at any time
+	int evictedStreamId;
+	if (m_OpenFiles.put(streamId, &evictedStreamId))
+		closeFile(evictedStreamId);
+
+	StreamFile& file = m_Files[streamId];
+	file.fd = openFileForWriting(file.name, file.created);
+	if (file.fd < 0)
+	{
+		LOG_ERROR("Cannot open '%s' for writing, error was: %d", file.name.c_str(), errno);
+		m_OpenFiles.eraseElement(streamId);
+		return false;
+	}
+
+	file.created = true;
+	m_IOStats.numOfFileOpens++;
+	return true;
+}
+
+void StreamSink::closeFile(int streamId)
+{
+	closeFileDescriptor(m_Files[streamId].fd);
+	m_Files[streamId].fd = -1;
+}
+
+bool StreamSink::writeChunks(int streamId, Chunk* chunks)
+{
+	StreamFile& file = m_Files[streamId];
+	bool inContainer = (m_ContainerFd >= 0);
+	if (chunks == NULL && (file.created || inContainer))
+		return true;
+
+	// after a container write fails the offsets of the following records aren't known, so nothing more is written to it
+	if (inContainer && m_IOStats.numOfWriteErrors > 0)
+	{
+		m_IOStats.numOfWriteErrors++;
+		return false;
+	}
+
+	if (!inContainer && !openFile(streamId))
+	{
+		m_IOStats.numOfWriteErrors++;
+		return false;
+	}
+
+	int fd = (inContainer ? m_ContainerFd : file.fd);
+	uint64_t dataLen = 0;
+	for (Chunk* chunk = chunks; chunk != NULL; chunk = chunk->next)
+		dataLen += chunk->len;
+
+	iovec segments[PCPP_STREAM_SINK_MAX_SEGMENTS];
+	int numOfSegments = 0;
+	std::vector<uint8_t> recordHeader;
+	if (inContainer)
+	{
+		CheckpointWriter writer(recordHeader);
+		writer.writeUInt32((uint32_t)streamId);
+		writer.writeUInt64(dataLen);
+		segments[0].iov_base = &recordHeader[0];
+		segments[0].iov_len = recordHeader.size();
+		numOfSegments = 1;
+	}
+
+	bool result = true;
+	for (Chunk* chunk = chunks; chunk != NULL && result; chunk = chunk->next)
+	{
+		segments[numOfSegments].iov_base = chunk->data;
+		segments[numOfSegments].iov_len = chunk->len;
+		numOfSegments++;
+
+		if (numOfSegments == PCPP_STREAM_SINK_MAX_SEGMENTS || chunk->next == NULL)
+		{
+			result = writeSegments(fd, segments, numOfSegments, m_IOStats.numOfWriteCalls);
+			numOfSegments = 0;
+		}
+	}
+
+	if (!result)
+	{
+		LOG_ERROR("Cannot write to file '%s', error was: %d", (inContainer ? m_Config.containerFileName.c_str() : file.name.c_str()), errno);
+		m_IOStats.numOfWriteErrors++;
+		return false;
+	}
+
+	if (inContainer)
+	{
+		file.records.push_back(std::make_pair(m_ContainerOffset + ContainerRecordHeaderLen, dataLen));
+		m_ContainerOffset += ContainerRecordHeaderLen + dataLen;
+	}
+	file.length += dataLen;
+	m_IOStats.numOfBytesWritten += dataLen;
+
+	return true;
+}
+
+bool StreamSink::writeContainerIndex()
+{
+	if (m_IOStats.numOfWriteErrors > 0)
+		return false;
+
+	// the index lists the records of every stream, and the trailer points at the index
+	std::vector<uint8_t> index;
+	CheckpointWriter writer(index);
+	writer.writeUInt32(PCPP_STREAM_CONTAINER_INDEX_MAGIC);
+	writer.writeUInt32((uint32_t)m_Files.size());
+	for (std::vector<StreamFile>::const_iterator iter = m_Files.begin(); iter != m_Files.end(); iter++)
+	{
+		writer.writeUInt32((uint32_t)iter->name.length());
+		writer.writeBytes((const uint8_t*)iter->name.data(), iter->name.length());
+		writer.writeUInt64(iter->length);
+		writer.writeUInt32((uint32_t)iter->records.size());
+		for (size_t i = 0; i < iter->records.size(); i++)
+		{
+			writer.writeUInt64(iter->records[i].first);
+			writer.writeUInt64(iter->records[i].second);
+		}
+	}
+	writer.writeUInt64(m_ContainerOffset);
+	writer.writeUInt32(PCPP_STREAM_CONTAINER_MAGIC);
+
+	iovec segment;
+	segment.iov_base = &index[0];
+	segment.iov_len = index.size();
+	if (!writeSegments(m_ContainerFd, &segment, 1, m_IOStats.numOfWriteCalls))
+	{
+		LOG_ERROR("Cannot write the index of file '%s', error was: %d", m_Config.containerFileName.c_str(), errno);
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool seekFile(FILE* file, uint64_t offset)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool readFileSize(FILE* file, uint64_t& fileSize)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	if (_fseeki64(file, 0, SEEK_END) != 0)
+		return false;
+	__int64 size = _ftelli64(file);
+#else
+	if (fseeko(file, 0, SEEK_END) != 0)
+		return false;
+	off_t size = ftello(file);
+#endif
+	if (size < 0)
+		return false;
+
+	fileSize = (uint64_t)size;
+	return seekFile(file, 0);
+}
+
+StreamContainerReader::StreamContainerReader(const std::string& fileName) : m_FileName(fileName)
+{
+	m_File = NULL;
+}
+
+StreamContainerReader::~StreamContainerReader()
+{
+	close();
+}
+
+bool StreamContainerReader::open()
+{
+	close();
+
+	m_File = fopen(m_FileName.c_str(), "rb");
+	if (m_File == NULL)
+	{
+		LOG_ERROR("Cannot open '%s' for reading, error was: %d", m_FileName.c_str(), errno);
+		return false;
+	}
+
+	// the header and the trailer are checked before the index is read
+	uint64_t fileSize = 0;
+	uint8_t header[ContainerHeaderLen];
+	uint8_t trailer[ContainerTrailerLen];
+	bool valid = readFileSize(m_File, fileSize) && fileSize >= ContainerHeaderLen + ContainerTrailerLen &&
+			fread(header, 1, sizeof(header), m_File) == sizeof(header) && seekFile(m_File, fileSize - ContainerTrailerLen) &&
+			fread(trailer, 1, sizeof(trailer), m_File) == sizeof(trailer);
+
+	uint64_t indexOffset = 0;
+	if (valid)
+	{
+		CheckpointReader headerReader(header, sizeof(header));
+		CheckpointReader trailerReader(trailer, sizeof(trailer));
+		valid = headerReader.readUInt32() == PCPP_STREAM_CONTAINER_MAGIC && headerReader.readUInt16() == PCPP_STREAM_CONTAINER_VERSION;
+		indexOffset = trailerReader.readUInt64();
+		valid = valid && trailerReader.readUInt32() == PCPP_STREAM_CONTAINER_MAGIC && indexOffset >= ContainerHeaderLen &&
+				indexOffset <= fileSize - ContainerTrailerLen;
+	}
+
+	std::vector<uint8_t> index;
+	if (valid)
+	{
+		index.resize((size_t)(fileSize - ContainerTrailerLen - indexOffset));
+		valid = !index.empty() && seekFile(m_File, indexOffset) && fread(&index[0], 1, index.size(), m_File) == index.size();
+	}
+
+	if (valid)
+	{
+		CheckpointReader reader(&index[0], index.size());
+		valid = (reader.readUInt32() == PCPP_STREAM_CONTAINER_INDEX_MAGIC);
+		uint32_t numOfStreams = reader.readUInt32();
+		for (uint32_t i = 0; i < numOfStreams && valid && reader.isValid(); i++)
+		{
+			m_Streams.push_back(StreamIndex());
+			StreamIndex& stream = m_Streams.back();
+			uint32_t nameLen = reader.readUInt32();
+			const uint8_t* name = reader.readBytes(nameLen);
+			if (name != NULL)
+				stream.name.assign((const char*)name, nameLen);
+			stream.length = reader.readUInt64();
+			uint32_t numOfRecords = reader.readUInt32();
+			uint64_t recordsLength = 0;
+			for (uint32_t j = 0; j < numOfRecords && reader.isValid(); j++)
+			{
+				uint64_t offset = reader.readUInt64();
+				uint64_t len = reader.readUInt64();
+				if (offset > indexOffset || len > indexOffset - offset)
+					reader.setFailed();
+				stream.records.push_back(std::make_pair(offset, len));
+				recordsLength += len;
+			}
+
+			valid = (recordsLength == stream.length);
+		}
+
+		valid = valid && reader.isValid();
+	}
+
+	if (!valid)
+	{
+		LOG_ERROR("File '%s' isn't a complete stream container file", m_FileName.c_str());
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void StreamContainerReader::close()
+{
+	if (m_File != NULL)
+	{
+		fclose(m_File);
+		m_File = NULL;
+	}
+
+	m_Streams.clear();
+}
+
+int StreamContainerReader::findStream(const std::string& name) const
+{
+	for (size_t i = 0; i < m_Streams.size(); i++)
+	{
+		if (m_Streams[i].name == name)
+			return (int)i;
+	}
+
+	return -1;
+}
+
+bool StreamContainerReader::readStream(size_t streamIndex, std::vector<uint8_t>& data)
+{
+	if (m_File == NULL || streamIndex >= m_Streams.size())
+	{
+		LOG_ERROR("Cannot read stream %d of '%s'", (int)streamIndex, m_FileName.c_str());
+		return false;
+	}
+
+	const StreamIndex& stream = m_Streams[streamIndex];
+	data.resize((size_t)stream.length);
+	size_t offset = 0;
+	for (size_t i = 0; i < stream.records.size(); i++)
+	{
+		size_t len = (size_t)stream.records[i].second;
+		if (len == 0)
+			continue;
+
+		if (!seekFile(m_File, stream.records[i].first) || fread(&data[offset], 1, len, m_File) != len)
+		{
+			LOG_ERROR("Cannot read stream '%s' of '%s', error was: %d", stream.name.c_str(), m_FileName.c_str(), errno);
+			return false;
+		}
+		offset += len;
+	}
+
+	return true;
+}
+
+} // namespace pcpp
@@ -37,55 +37,60 @@ bool WinPcapLiveDevice::startCapture(int intervalInSecondsToUpdateStats, OnStats
     return PcapLiveDevice::startCapture(intervalInSecondsToUpdateStats, onStatsUpdate, onStatsUpdateUserCookie);
 }
 
-int WinPcapLiveDevice::sendPackets(RawPacket* rawPacketsArr, int arrLength)
+int WinPcapLiveDevice::sendPacketBatch(const uint8_t* const* packetsData, const int* packetsLengths, int count)
 {
 	int dataSize = 0;
-	int packetsSent = 0;
-	for (int i = 0; i < arrLength; i++)
-		dataSize += rawPacketsArr[i].getRawDataLen();
-
-	pcap_send_queue* sendQueue = pcap_sendqueue_alloc(dataSize + arrLength*sizeof(pcap_pkthdr));
-	LOG_DEBUG("Allocated send queue of size %d", dataSize + arrLength*sizeof(pcap_pkthdr));
-	struct pcap_pkthdr* packetHeader = new struct pcap_pkthdr[arrLength];
-	for (int i = 0; i < arrLength; i++)
+	for (int i = 0; i < count; i++)
+		dataSize += packetsLengths[i] + sizeof(pcap_pkthdr);
+
+	pcap_send_queue* sendQueue = pcap_sendqueue_alloc(dataSize);
+	if (sendQueue == NULL)
+	{
+		LOG_ERROR("Cannot allocate send queue of size %d", dataSize);
+		return 0;
+	}
+	LOG_DEBUG("Allocated send queue of size %d", dataSize);
+
+	struct pcap_pkthdr packetHeader;
+	memset(&packetHeader, 0, sizeof(packetHeader));
+	int packetsQueued = 0;
+	for (int i = 0; i < count; i++)
 	{
-		packetHeader[i].caplen = rawPacketsArr[i].getRawDataLen();
-		packetHeader[i].len = rawPacketsArr[i].getRawDataLen();
-		packetHeader[i].ts = rawPacketsArr[i].getPacketTimeStamp();
-		if (pcap_sendqueue_queue(sendQueue, &packetHeader[i], rawPacketsArr[i].getRawData()) == -1)
+		packetHeader.caplen = packetsLengths[i];
+		packetHeader.len = packetsLengths[i];
+		if (pcap_sendqueue_queue(sendQueue, &packetHeader, packetsData[i]) == -1)
 		{
 			LOG_ERROR("pcap_send_queue is too small for all packets. Sending only %d packets", i);
 			break;
 		}
-		packetsSent++;
+		packetsQueued++;
 	}
-	
-	LOG_DEBUG("%d packets were queued successfully", packetsSent);
 
+	LOG_DEBUG("%d packets were queued successfully", packetsQueued);
+
+	int packetsSent = packetsQueued;
 	int res;
-	if ((res = pcap_sendqueue_transmit(m_PcapDescriptor, sendQueue, 0)) < (int)(sendQueue->len))
-    {
-        LOG_ERROR("An error occurred sending the packets: %s. Only %d bytes were sent\n", pcap_geterr(m_PcapDescriptor), res);
-        packetsSent = 0;
-        dataSize = 0;
-    	for (int i = 0; i < arrLength; i++)
-    	{
-    		dataSize += rawPacketsArr[i].getRawDataLen();
-    		//printf("dataSize = %d\n", dataSize);
-    		if (dataSize > res)
-    		{
-    			return packetsSent;
-    		}
-    		packetsSent++;
-    	}
-    	return packetsSent;
-    }
-	LOG_DEBUG("Packets were sent successfully");
+	if ((res = pcap_sendqueue_transmit(m_PcapSendDescriptor, sendQueue, 0)) < (int)(sendQueue->len))
+	{
+		LOG_ERROR("An error occurred sending the packets: %s. Only %d bytes were sent\n", pcap_geterr(m_PcapSendDescriptor), res);
+
+		// count the packets which fit entirely in the bytes sent
+		packetsSent = 0;
+		int bytesQueued = 0;
+		for (int i = 0; i < packetsQueued; i++)
+		{
+			bytesQueued += packetsLengths[i] + sizeof(pcap_pkthdr);
+			if (bytesQueued > res)
+				break;
+			packetsSent++;
+		}
+	}
+	else
+		LOG_DEBUG("Packets were sent successfully");
 
 	pcap_sendqueue_destroy(sendQueue);
 	LOG_DEBUG("Send queue destroyed");
 
-	delete[] packetHeader;
 	return packetsSent;
 }
 
@@ -106,6 +111,32 @@ bool WinPcapLiveDevice::setMinAmountOfDataToCopyFromKernelToApplication(int size
 	return true;
 }
 
+bool WinPcapLiveDevice::applyAutoTuning(int changes)
+{
+	const PcapAutoTunerSettings& settings = m_AutoTuner.getSettings();
+	if ((changes & PcapAutoTuner::TimeoutChanged) != 0)
+	{
+		// the new handle is opened with the new buffer size, but with the default minimum amount of data to copy
+		if (!PcapLiveDevice::applyAutoTuning(changes))
+			return false;
+		changes |= PcapAutoTuner::MinToCopyChanged;
+	}
+	else if ((changes & PcapAutoTuner::BufferSizeChanged) != 0)
+	{
+		if (pcap_setbuff(m_PcapDescriptor, settings.bufferSize) != 0)
+		{
+			LOG_ERROR("pcap_setbuff failed");
+			return false;
+		}
+		m_DeviceConfig.packetBufferSize = settings.bufferSize;
+	}
+
+	if ((changes & PcapAutoTuner::MinToCopyChanged) != 0 && settings.minToCopy > 0)
+		return setMinAmountOfDataToCopyFromKernelToApplication(settings.minToCopy);
+
+	return true;
+}
+
 } // namespace pcpp
 
 #endif // WIN32 || WINx64 || PCAPPP_MINGW_ENV
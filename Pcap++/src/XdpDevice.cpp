@@ -0,0 +1,1293 @@
+#define LOG_MODULE PcapLogModuleXdpDevice
+
+#include "XdpDevice.h"
+#include "Logger.h"
+#include "EthLayer.h"
+#include "IPv4Layer.h"
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#ifdef LINUX
+#include <unistd.h>
+#include <stddef.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <net/if.h>
+#include <linux/if_xdp.h>
+#include <linux/if_link.h>
+#include <linux/bpf.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif
+
+// how long a capture thread waits for packets before checking whether it was asked to stop
+#define CAPTURE_THREAD_POLL_TIMEOUT_MS 100
+
+namespace pcpp
+{
+
+#ifdef LINUX
+
+static int bpfSyscall(int cmd, bpf_attr& attr)
+{
+	return (int)syscall(__NR_bpf, cmd, &attr, sizeof(attr));
+}
+
+// attach an XDP program to an interface, or detach the attached one if programFd is -1, through an RTM_SETLINK netlink request
+static int setInterfaceXdpProgram(int interfaceIndex, int programFd, uint32_t flags)
+{
+	struct
+	{
+		nlmsghdr header;
+		ifinfomsg ifinfo;
+		char attributes[64];
+	} request;
+
+	memset(&request, 0, sizeof(request));
+	request.header.nlmsg_len = NLMSG_LENGTH(sizeof(ifinfomsg));
+	request.header.nlmsg_type = RTM_SETLINK;
+	request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+	request.header.nlmsg_seq = 1;
+	request.ifinfo.ifi_family = AF_UNSPEC;
+	request.ifinfo.ifi_index = interfaceIndex;
+
+	// IFLA_XDP is a nested attribute holding the program fd and the attach flags
+	rtattr* xdpAttr = (rtattr*)((char*)&request + NLMSG_ALIGN(request.header.nlmsg_len));
+	xdpAttr->rta_type = IFLA_XDP | NLA_F_NESTED;
+	xdpAttr->rta_len = RTA_LENGTH(0);
+
+	rtattr* fdAttr = (rtattr*)((char*)xdpAttr + xdpAttr->rta_len);
+	fdAttr->rta_type = IFLA_XDP_FD;
+	fdAttr->rta_len = RTA_LENGTH(sizeof(int));
+	memcpy(RTA_DATA(fdAttr), &programFd, sizeof(int));
+	xdpAttr->rta_len += RTA_ALIGN(fdAttr->rta_len);
+
+	rtattr* flagsAttr = (rtattr*)((char*)xdpAttr + xdpAttr->rta_len);
+	flagsAttr->rta_type = IFLA_XDP_FLAGS;
+	flagsAttr->rta_len = RTA_LENGTH(sizeof(uint32_t));
+	memcpy(RTA_DATA(flagsAttr), &flags, sizeof(uint32_t));
+	xdpAttr->rta_len += RTA_ALIGN(flagsAttr->rta_len);
+
+	request.header.nlmsg_len = NLMSG_ALIGN(request.header.nlmsg_len) + xdpAttr->rta_len;
+
+	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+	if (fd < 0)
+		return -errno;
+
+	sockaddr_nl kernelAddr;
+	memset(&kernelAddr, 0, sizeof(kernelAddr));
+	kernelAddr.nl_family = AF_NETLINK;
+	if (sendto(fd, &request, request.header.nlmsg_len, 0, (sockaddr*)&kernelAddr, sizeof(kernelAddr)) < 0)
+	{
+		int err = -errno;
+		::close(fd);
+		return err;
+	}
+
+	char response[4096];
+	int responseLen = (int)recv(fd, response, sizeof(response), 0);
+	int result = (responseLen < 0 ? -errno : -EPROTO);
+	::close(fd);
+
+	// the request is acknowledged with an error message whose error code is 0 on success
+	nlmsghdr* responseHeader = (nlmsghdr*)response;
+	if (responseLen > 0 && NLMSG_OK(responseHeader, (unsigned int)responseLen) && responseHeader->nlmsg_type == NLMSG_ERROR)
+		result = ((nlmsgerr*)NLMSG_DATA(responseHeader))->error;
+
+	return result;
+}
+
+static bpf_insn makeBpfInsn(uint8_t code, uint8_t dstReg, uint8_t srcReg, int16_t offset, int32_t imm)
+{
+	bpf_insn insn;
+	memset(&insn, 0, sizeof(insn));
+	insn.code = code;
+	insn.dst_reg = dstReg;
+	insn.src_reg = srcReg;
+	insn.off = offset;
+	insn.imm = imm;
+	return insn;
+}
+
+// point the jumps at the given instructions to the next instruction to be added
+static void resolveBpfJumps(std::vector<bpf_insn>& program, std::vector<size_t>& jumps)
+{
+	for (std::vector<size_t>::iterator jump = jumps.begin(); jump != jumps.end(); ++jump)
+		program[*jump].off = (int16_t)(program.size() - *jump - 1);
+	jumps.clear();
+}
+
+// the header fields the filter part of the program extracts to the stack, at these offsets from the frame pointer
+enum
+{
+	FilterFieldEtherType = -4,
+	FilterFieldIpProtocol = -8,
+	FilterFieldSrcIPv4 = -12,
+	FilterFieldDstIPv4 = -16,
+	FilterFieldSrcPort = -20,
+	FilterFieldDstPort = -24
+};
+
+// the fields the packet has, kept in a register
+enum
+{
+	FilterHasEtherType = 0x1,
+	FilterHasIpProtocol = 0x2,
+	FilterHasIPv4Addresses = 0x4,
+	FilterHasPorts = 0x8
+};
+
+// add a comparison of a field to a rule value to the program, which jumps to the next rule if they're not equal
+static void addBpfFieldMatch(std::vector<bpf_insn>& program, std::vector<size_t>& nextRuleJumps, int16_t field, uint32_t value, uint32_t mask)
+{
+	if (mask == 0)
+		return;
+
+	// 32-bit operations zero-extend their result, so unlike the 64-bit ones they don't sign-extend values with the top bit set
+	program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_0, BPF_REG_10, field, 0));
+	program.push_back(makeBpfInsn(BPF_ALU | BPF_AND | BPF_K, BPF_REG_0, 0, 0, (int32_t)mask));
+	program.push_back(makeBpfInsn(BPF_ALU | BPF_MOV | BPF_K, BPF_REG_1, 0, 0, (int32_t)(value & mask)));
+	nextRuleJumps.push_back(program.size());
+	program.push_back(makeBpfInsn(BPF_JMP | BPF_JNE | BPF_X, BPF_REG_0, BPF_REG_1, 0, 0));
+}
+
+// build an XDP program which redirects the packets to the socket of their queue in the XSKMAP. If rules are given, only packets matching
+// one of them are redirected and the rest are passed to the kernel network stack
+static void buildXdpProgram(int xskMapFd, const std::vector<FilterFlowRule>* rules, std::vector<bpf_insn>& program)
+{
+	program.clear();
+
+	// r6 = ctx
+	program.push_back(makeBpfInsn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0));
+
+	std::vector<size_t> redirectJumps;
+
+	if (rules != NULL)
+	{
+		std::vector<size_t> rulesJumps;
+		std::vector<size_t> ipv4Jumps;
+		std::vector<size_t> ipv4PortsJumps;
+		std::vector<size_t> ipv6PortsJumps;
+
+		// clear the fields on the stack, r7 holds the fields the packet has
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, 0));
+		for (int16_t field = FilterFieldEtherType; field >= FilterFieldDstPort; field -= 4)
+			program.push_back(makeBpfInsn(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_0, field, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_7, 0, 0, 0));
+
+		// r2 = data, r3 = data_end
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6, (int16_t)offsetof(xdp_md, data), 0));
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_6, (int16_t)offsetof(xdp_md, data_end), 0));
+
+		// Ethernet: the EtherType at offset 12
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, 14));
+		rulesJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 0, 0));
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_0, BPF_REG_2, 12, 0));
+		program.push_back(makeBpfInsn(BPF_ALU | BPF_END | BPF_TO_BE, BPF_REG_0, 0, 0, 16));
+		program.push_back(makeBpfInsn(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_0, FilterFieldEtherType, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_OR | BPF_K, BPF_REG_7, 0, 0, FilterHasEtherType));
+		ipv4Jumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 0, PCPP_ETHERTYPE_IP));
+		rulesJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_0, 0, 0, PCPP_ETHERTYPE_IPV6));
+
+		// IPv6: the next header at offset 20 and the ports at offset 54 (extension headers aren't followed)
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, 54));
+		rulesJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 0, 0));
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_0, BPF_REG_2, 20, 0));
+		program.push_back(makeBpfInsn(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_0, FilterFieldIpProtocol, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_OR | BPF_K, BPF_REG_7, 0, 0, FilterHasIpProtocol));
+		ipv6PortsJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 0, PACKETPP_IPPROTO_TCP));
+		ipv6PortsJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 0, PACKETPP_IPPROTO_UDP));
+		rulesJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_0, 0, 0, PACKETPP_IPPROTO_SCTP));
+		resolveBpfJumps(program, ipv6PortsJumps);
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, 58));
+		rulesJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 0, 0));
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_0, BPF_REG_2, 54, 0));
+		program.push_back(makeBpfInsn(BPF_ALU | BPF_END | BPF_TO_BE, BPF_REG_0, 0, 0, 16));
+		program.push_back(makeBpfInsn(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_0, FilterFieldSrcPort, 0));
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_0, BPF_REG_2, 56, 0));
+		program.push_back(makeBpfInsn(BPF_ALU | BPF_END | BPF_TO_BE, BPF_REG_0, 0, 0, 16));
+		program.push_back(makeBpfInsn(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_0, FilterFieldDstPort, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_OR | BPF_K, BPF_REG_7, 0, 0, FilterHasPorts));
+		rulesJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JA, 0, 0, 0, 0));
+
+		// IPv4: the protocol at offset 23, the addresses at offsets 26 and 30 and the ports after the options
+		resolveBpfJumps(program, ipv4Jumps);
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, 34));
+		rulesJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 0, 0));
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_0, BPF_REG_2, 23, 0));
+		program.push_back(makeBpfInsn(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_0, FilterFieldIpProtocol, 0));
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_1, BPF_REG_2, 26, 0));
+		program.push_back(makeBpfInsn(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_1, FilterFieldSrcIPv4, 0));
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_1, BPF_REG_2, 30, 0));
+		program.push_back(makeBpfInsn(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_1, FilterFieldDstIPv4, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_OR | BPF_K, BPF_REG_7, 0, 0, FilterHasIpProtocol | FilterHasIPv4Addresses));
+		// only the first fragment has the ports
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_1, BPF_REG_2, 20, 0));
+		program.push_back(makeBpfInsn(BPF_ALU | BPF_END | BPF_TO_BE, BPF_REG_1, 0, 0, 16));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_1, 0, 0, 0x1fff));
+		rulesJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_1, 0, 0, 0));
+		ipv4PortsJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 0, PACKETPP_IPPROTO_TCP));
+		ipv4PortsJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 0, PACKETPP_IPPROTO_UDP));
+		rulesJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_0, 0, 0, PACKETPP_IPPROTO_SCTP));
+		resolveBpfJumps(program, ipv4PortsJumps);
+		// r2 += the header length
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_1, BPF_REG_2, 14, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_1, 0, 0, 0x0f));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_LSH | BPF_K, BPF_REG_1, 0, 0, 2));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_ADD | BPF_X, BPF_REG_2, BPF_REG_1, 0, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, 18));
+		rulesJumps.push_back(program.size());
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 0, 0));
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_0, BPF_REG_2, 14, 0));
+		program.push_back(makeBpfInsn(BPF_ALU | BPF_END | BPF_TO_BE, BPF_REG_0, 0, 0, 16));
+		program.push_back(makeBpfInsn(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_0, FilterFieldSrcPort, 0));
+		program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_0, BPF_REG_2, 16, 0));
+		program.push_back(makeBpfInsn(BPF_ALU | BPF_END | BPF_TO_BE, BPF_REG_0, 0, 0, 16));
+		program.push_back(makeBpfInsn(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_0, FilterFieldDstPort, 0));
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_OR | BPF_K, BPF_REG_7, 0, 0, FilterHasPorts));
+
+		// the rules: a rule matches if the packet has all the fields it matches and they're equal to the rule values
+		resolveBpfJumps(program, rulesJumps);
+		for (std::vector<FilterFlowRule>::const_iterator rule = rules->begin(); rule != rules->end(); ++rule)
+		{
+			std::vector<size_t> nextRuleJumps;
+
+			int32_t requiredFields = (rule->etherTypeMask != 0 ? FilterHasEtherType : 0) |
+					(rule->ipProtocolMask != 0 ? FilterHasIpProtocol : 0) |
+					(rule->srcIPv4Mask != 0 || rule->dstIPv4Mask != 0 ? FilterHasIPv4Addresses : 0) |
+					(rule->srcPortMask != 0 || rule->dstPortMask != 0 ? FilterHasPorts : 0);
+			if (requiredFields != 0)
+			{
+				program.push_back(makeBpfInsn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_0, BPF_REG_7, 0, 0));
+				program.push_back(makeBpfInsn(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_0, 0, 0, requiredFields));
+				nextRuleJumps.push_back(program.size());
+				program.push_back(makeBpfInsn(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_0, 0, 0, requiredFields));
+			}
+
+			addBpfFieldMatch(program, nextRuleJumps, FilterFieldEtherType, rule->etherType, rule->etherTypeMask);
+			addBpfFieldMatch(program, nextRuleJumps, FilterFieldIpProtocol, rule->ipProtocol, rule->ipProtocolMask);
+			addBpfFieldMatch(program, nextRuleJumps, FilterFieldSrcIPv4, rule->srcIPv4Address, rule->srcIPv4Mask);
+			addBpfFieldMatch(program, nextRuleJumps, FilterFieldDstIPv4, rule->dstIPv4Address, rule->dstIPv4Mask);
+			addBpfFieldMatch(program, nextRuleJumps, FilterFieldSrcPort, rule->srcPort, rule->srcPortMask);
+			addBpfFieldMatch(program, nextRuleJumps, FilterFieldDstPort, rule->dstPort, rule->dstPortMask);
+
+			redirectJumps.push_back(program.size());
+			program.push_back(makeBpfInsn(BPF_JMP | BPF_JA, 0, 0, 0, 0));
+			resolveBpfJumps(program, nextRuleJumps);
+		}
+
+		// no rule matched
+		program.push_back(makeBpfInsn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS));
+		program.push_back(makeBpfInsn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+	}
+
+	// return bpf_redirect_map(&xsks_map, ctx->rx_queue_index, XDP_PASS);
+	// packets of queues without a socket go to the kernel network stack (the fallback action in the flags requires Linux 5.3)
+	resolveBpfJumps(program, redirectJumps);
+	program.push_back(makeBpfInsn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6, (int16_t)offsetof(xdp_md, rx_queue_index), 0));
+	program.push_back(makeBpfInsn(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, xskMapFd));
+	program.push_back(makeBpfInsn(0, 0, 0, 0, 0));
+	program.push_back(makeBpfInsn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS));
+	program.push_back(makeBpfInsn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map));
+	program.push_back(makeBpfInsn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+}
+
+#endif
+
+XdpDevice::XdpDevice(const std::string& interfaceName, const XdpDeviceConfiguration& config) :
+	m_InterfaceName(interfaceName), m_Config(config)
+{
+	m_Queues = NULL;
+	m_NumOfOpenedQueues = 0;
+	m_InterfaceIndex = -1;
+	m_XskMapFd = -1;
+	m_ProgramFd = -1;
+	m_ProgramAttached = false;
+	m_DriverMode = false;
+	m_CaptureThreadsStarted = false;
+	m_StopThreads = false;
+	m_OnPacketsArrive = NULL;
+	m_OnPacketsArriveUserCookie = NULL;
+	m_SoftwareFilter = NULL;
+	m_IsFilterOffloaded = false;
+}
+
+XdpDevice::~XdpDevice()
+{
+	close();
+}
+
+bool XdpDevice::open()
+{
+#ifdef LINUX
+
+	if (m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' already opened", m_InterfaceName.c_str());
+		return false;
+	}
+
+	uint32_t frameSize = m_Config.frameSize;
+	uint32_t ringSize = m_Config.ringSize;
+	if (m_Config.numOfQueues == 0 || ringSize == 0 || (ringSize & (ringSize - 1)) != 0 || frameSize < 2048 ||
+			(frameSize & (frameSize - 1)) != 0 || frameSize > (uint32_t)getpagesize())
+	{
+		LOG_ERROR("Invalid configuration for device '%s': the ring size must be a power of 2 and the frame size a power of 2 between 2048 "
+				"and the page size", m_InterfaceName.c_str());
+		return false;
+	}
+
+	m_InterfaceIndex = (int)if_nametoindex(m_InterfaceName.c_str());
+	if (m_InterfaceIndex == 0)
+	{
+		LOG_ERROR("Cannot find interface '%s'", m_InterfaceName.c_str());
+		return false;
+	}
+
+	if (!loadProgram())
+	{
+		close();
+		return false;
+	}
+
+	bool attached = false;
+	if (m_Config.attachMode != AttachGeneric)
+		attached = attachProgram(true);
+	if (!attached && m_Config.attachMode != AttachDriver)
+		attached = attachProgram(false);
+	if (!attached)
+	{
+		close();
+		return false;
+	}
+
+	// the device is marked as opened so close() cleans up the queues opened so far if a queue fails
+	m_DeviceOpened = true;
+	m_Queues = new XdpQueue[m_Config.numOfQueues];
+	for (m_NumOfOpenedQueues = 0; m_NumOfOpenedQueues < m_Config.numOfQueues; m_NumOfOpenedQueues++)
+	{
+		XdpQueue& queue = m_Queues[m_NumOfOpenedQueues];
+		queue.id = m_NumOfOpenedQueues;
+		queue.device = this;
+		if (!openQueue(queue))
+		{
+			closeQueue(queue);
+			close();
+			return false;
+		}
+	}
+
+	LOG_DEBUG("Device '%s' opened with %d queues in %s mode, %s", m_InterfaceName.c_str(), (int)m_NumOfOpenedQueues,
+			(m_DriverMode ? "driver" : "generic"), (isZeroCopy() ? "zero-copy" : "copy"));
+	return true;
+
+#else
+
+	LOG_ERROR("XdpDevice is supported on Linux only");
+	return false;
+
+#endif
+}
+
+void XdpDevice::close()
+{
+	stopCapture();
+
+	for (uint8_t i = 0; i < m_NumOfOpenedQueues; i++)
+		closeQueue(m_Queues[i]);
+	delete [] m_Queues;
+	m_Queues = NULL;
+	m_NumOfOpenedQueues = 0;
+
+	detachProgram();
+
+#ifdef LINUX
+	if (m_ProgramFd >= 0)
+		::close(m_ProgramFd);
+	if (m_XskMapFd >= 0)
+		::close(m_XskMapFd);
+#endif
+	m_ProgramFd = -1;
+	m_XskMapFd = -1;
+
+	freeSoftwareFilter();
+	m_IsFilterOffloaded = false;
+
+	if (m_DeviceOpened)
+		LOG_DEBUG("Device '%s' closed", m_InterfaceName.c_str());
+	m_DeviceOpened = false;
+}
+
+bool XdpDevice::loadProgram()
+{
+#ifdef LINUX
+
+	// the sockets are registered in an XSKMAP by queue ID, which the program redirects the packets of each queue to
+	bpf_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.map_type = BPF_MAP_TYPE_XSKMAP;
+	attr.key_size = sizeof(uint32_t);
+	attr.value_size = sizeof(int);
+	attr.max_entries = m_Config.numOfQueues;
+	m_XskMapFd = bpfSyscall(BPF_MAP_CREATE, attr);
+	if (m_XskMapFd < 0)
+	{
+		LOG_ERROR("Cannot create XSKMAP for device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	m_ProgramFd = loadXdpProgram(NULL);
+	return m_ProgramFd >= 0;
+
+#else
+
+	return false;
+
+#endif
+}
+
+int XdpDevice::loadXdpProgram(const std::vector<FilterFlowRule>* rules)
+{
+#ifdef LINUX
+
+	std::vector<bpf_insn> program;
+	buildXdpProgram(m_XskMapFd, rules, program);
+	static const char license[] = "Dual BSD/GPL";
+
+	bpf_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.prog_type = BPF_PROG_TYPE_XDP;
+	attr.insns = (uint64_t)(uintptr_t)&program[0];
+	attr.insn_cnt = (uint32_t)program.size();
+	attr.license = (uint64_t)(uintptr_t)license;
+	int programFd = bpfSyscall(BPF_PROG_LOAD, attr);
+	if (programFd < 0)
+		LOG_ERROR("Cannot load XDP program for device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+
+	return programFd;
+
+#else
+
+	return -1;
+
+#endif
+}
+
+bool XdpDevice::replaceProgram(const std::vector<FilterFlowRule>* rules)
+{
+#ifdef LINUX
+
+	int programFd = loadXdpProgram(rules);
+	if (programFd < 0)
+		return false;
+
+	// without XDP_FLAGS_UPDATE_IF_NOEXIST the attached program is replaced atomically, so no packet is missed or handled by neither program
+	int err = setInterfaceXdpProgram(m_InterfaceIndex, programFd, (m_DriverMode ? XDP_FLAGS_DRV_MODE : XDP_FLAGS_SKB_MODE));
+	if (err != 0)
+	{
+		LOG_ERROR("Cannot replace XDP program of device '%s', error was: %d", m_InterfaceName.c_str(), -err);
+		::close(programFd);
+		return false;
+	}
+
+	::close(m_ProgramFd);
+	m_ProgramFd = programFd;
+	return true;
+
+#else
+
+	return false;
+
+#endif
+}
+
+void XdpDevice::freeSoftwareFilter()
+{
+	if (m_SoftwareFilter == NULL)
+		return;
+
+	delete m_SoftwareFilter;
+	m_SoftwareFilter = NULL;
+}
+
+bool XdpDevice::setFilter(GeneralFilter& filter)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened", m_InterfaceName.c_str());
+		return false;
+	}
+
+	if (captureActive())
+	{
+		LOG_ERROR("Cannot set a filter on device '%s' while capture threads are running", m_InterfaceName.c_str());
+		return false;
+	}
+
+	std::vector<FilterFlowRule> rules;
+	if (filter.toFlowRules(rules) && replaceProgram(&rules))
+	{
+		freeSoftwareFilter();
+		m_IsFilterOffloaded = true;
+		LOG_DEBUG("Filter compiled into the XDP program of device '%s' as %d rules", m_InterfaceName.c_str(), (int)rules.size());
+		return true;
+	}
+
+	std::string filterAsString;
+	filter.parseToString(filterAsString);
+	LOG_DEBUG("Filter can't be compiled into the XDP program of device '%s', applying it in software", m_InterfaceName.c_str());
+	return setFilter(filterAsString);
+}
+
+bool XdpDevice::setFilter(std::string filterAsString)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened", m_InterfaceName.c_str());
+		return false;
+	}
+
+	if (captureActive())
+	{
+		LOG_ERROR("Cannot set a filter on device '%s' while capture threads are running", m_InterfaceName.c_str());
+		return false;
+	}
+
+	// the XDP program can't load the BPF filter, which uses the packet socket dialect, so the received packets are matched in software
+	BPFStringFilter* filter = new BPFStringFilter(filterAsString);
+	if (!filter->verifyFilter())
+	{
+		LOG_ERROR("Cannot compile filter '%s' for device '%s'", filterAsString.c_str(), m_InterfaceName.c_str());
+		delete filter;
+		return false;
+	}
+
+	if (m_IsFilterOffloaded)
+	{
+		if (!replaceProgram(NULL))
+		{
+			delete filter;
+			return false;
+		}
+
+		m_IsFilterOffloaded = false;
+	}
+
+	freeSoftwareFilter();
+	m_SoftwareFilter = filter;
+	LOG_DEBUG("Filter '%s' set on device '%s' in software", filterAsString.c_str(), m_InterfaceName.c_str());
+	return true;
+}
+
+bool XdpDevice::clearFilter()
+{
+	if (captureActive())
+	{
+		LOG_ERROR("Cannot clear the filter of device '%s' while capture threads are running", m_InterfaceName.c_str());
+		return false;
+	}
+
+	if (m_IsFilterOffloaded)
+	{
+		if (!replaceProgram(NULL))
+			return false;
+
+		m_IsFilterOffloaded = false;
+	}
+
+	freeSoftwareFilter();
+	return true;
+}
+
+bool XdpDevice::attachProgram(bool driverMode)
+{
+#ifdef LINUX
+
+	uint32_t flags = XDP_FLAGS_UPDATE_IF_NOEXIST | (driverMode ? XDP_FLAGS_DRV_MODE : XDP_FLAGS_SKB_MODE);
+	int err = setInterfaceXdpProgram(m_InterfaceIndex, m_ProgramFd, flags);
+	if (err != 0)
+	{
+		if (err == -EBUSY || err == -EEXIST)
+			LOG_ERROR("Device '%s' already has an XDP program attached", m_InterfaceName.c_str());
+		else if (driverMode && m_Config.attachMode == AttachAuto)
+			LOG_DEBUG("Cannot attach XDP program in driver mode to device '%s', error was: %d. Trying generic mode", m_InterfaceName.c_str(), -err);
+		else
+			LOG_ERROR("Cannot attach XDP program in %s mode to device '%s', error was: %d", (driverMode ? "driver" : "generic"),
+					m_InterfaceName.c_str(), -err);
+		return false;
+	}
+
+	m_ProgramAttached = true;
+	m_DriverMode = driverMode;
+	return true;
+
+#else
+
+	return false;
+
+#endif
+}
+
+void XdpDevice::detachProgram()
+{
+	if (!m_ProgramAttached)
+		return;
+
+#ifdef LINUX
+	int err = setInterfaceXdpProgram(m_InterfaceIndex, -1, (m_DriverMode ? XDP_FLAGS_DRV_MODE : XDP_FLAGS_SKB_MODE));
+	if (err != 0)
+		LOG_ERROR("Cannot detach XDP program from device '%s', error was: %d", m_InterfaceName.c_str(), -err);
+#endif
+
+	m_ProgramAttached = false;
+	m_DriverMode = false;
+}
+
+bool XdpDevice::mapRing(XdpQueue& queue, XdpRing& ring, uint64_t offset, const void* ringOffsets, size_t descSize)
+{
+#ifdef LINUX
+
+	const xdp_ring_offset* offsets = (const xdp_ring_offset*)ringOffsets;
+	size_t mapSize = offsets->desc + m_Config.ringSize * descSize;
+	void* map = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, queue.fd, offset);
+	if (map == MAP_FAILED)
+	{
+		LOG_ERROR("Cannot map ring of queue %d of device '%s', error was: %d", (int)queue.id, m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	ring.map = map;
+	ring.mapSize = mapSize;
+	ring.producer = (uint32_t*)((uint8_t*)map + offsets->producer);
+	ring.consumer = (uint32_t*)((uint8_t*)map + offsets->consumer);
+	ring.flags = (uint32_t*)((uint8_t*)map + offsets->flags);
+	ring.descs = (uint8_t*)map + offsets->desc;
+	return true;
+
+#else
+
+	return false;
+
+#endif
+}
+
+bool XdpDevice::openQueue(XdpQueue& queue)
+{
+	queue.fd = -1;
+	queue.umem = NULL;
+	queue.umemSize = 0;
+	memset(&queue.fillRing, 0, sizeof(XdpRing));
+	memset(&queue.completionRing, 0, sizeof(XdpRing));
+	memset(&queue.rxRing, 0, sizeof(XdpRing));
+	memset(&queue.txRing, 0, sizeof(XdpRing));
+	queue.zeroCopy = false;
+	queue.heldFrames = NULL;
+	queue.numOfHeldFrames = 0;
+	queue.freeTxFrames = NULL;
+	queue.numOfFreeTxFrames = 0;
+	queue.capturePackets = NULL;
+	memset(&queue.stats, 0, sizeof(queue.stats));
+	queue.coreId = -1;
+
+#ifdef LINUX
+
+	uint32_t ringSize = m_Config.ringSize;
+	uint32_t frameSize = m_Config.frameSize;
+
+	queue.fd = socket(AF_XDP, SOCK_RAW, 0);
+	if (queue.fd < 0)
+	{
+		LOG_ERROR("Cannot create AF_XDP socket for device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	// the first half of the UMEM frames is for receiving and the second half for sending
+	queue.umemSize = (size_t)ringSize * 2 * frameSize;
+	void* umem = mmap(NULL, queue.umemSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if (umem == MAP_FAILED)
+	{
+		LOG_ERROR("Cannot allocate UMEM of %d bytes for device '%s', error was: %d", (int)queue.umemSize, m_InterfaceName.c_str(), errno);
+		queue.umemSize = 0;
+		return false;
+	}
+	queue.umem = (uint8_t*)umem;
+
+	xdp_umem_reg umemReg;
+	memset(&umemReg, 0, sizeof(umemReg));
+	umemReg.addr = (uint64_t)(uintptr_t)queue.umem;
+	umemReg.len = queue.umemSize;
+	umemReg.chunk_size = frameSize;
+	umemReg.headroom = 0;
+	if (setsockopt(queue.fd, SOL_XDP, XDP_UMEM_REG, &umemReg, sizeof(umemReg)) < 0)
+	{
+		LOG_ERROR("Cannot register UMEM for device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	int ringOptions[] = { XDP_UMEM_FILL_RING, XDP_UMEM_COMPLETION_RING, XDP_RX_RING, XDP_TX_RING };
+	for (size_t i = 0; i < sizeof(ringOptions) / sizeof(ringOptions[0]); i++)
+	{
+		if (setsockopt(queue.fd, SOL_XDP, ringOptions[i], &ringSize, sizeof(ringSize)) < 0)
+		{
+			LOG_ERROR("Cannot set ring size %u for device '%s', error was: %d", ringSize, m_InterfaceName.c_str(), errno);
+			return false;
+		}
+	}
+
+	xdp_mmap_offsets offsets;
+	socklen_t offsetsLen = sizeof(offsets);
+	if (getsockopt(queue.fd, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &offsetsLen) < 0)
+	{
+		LOG_ERROR("Cannot get ring offsets for device '%s', error was: %d", m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	if (!mapRing(queue, queue.fillRing, XDP_UMEM_PGOFF_FILL_RING, &offsets.fr, sizeof(uint64_t)) ||
+			!mapRing(queue, queue.completionRing, XDP_UMEM_PGOFF_COMPLETION_RING, &offsets.cr, sizeof(uint64_t)) ||
+			!mapRing(queue, queue.rxRing, XDP_PGOFF_RX_RING, &offsets.rx, sizeof(xdp_desc)) ||
+			!mapRing(queue, queue.txRing, XDP_PGOFF_TX_RING, &offsets.tx, sizeof(xdp_desc)))
+		return false;
+
+	// give all RX frames to the kernel, and keep all TX frames until packets are sent
+	queue.heldFrames = new uint64_t[ringSize];
+	for (uint32_t i = 0; i < ringSize; i++)
+		queue.heldFrames[i] = (uint64_t)i * frameSize;
+	queue.numOfHeldFrames = ringSize;
+	refillQueue(queue);
+
+	queue.freeTxFrames = new uint64_t[ringSize];
+	for (uint32_t i = 0; i < ringSize; i++)
+		queue.freeTxFrames[i] = (uint64_t)(ringSize + i) * frameSize;
+	queue.numOfFreeTxFrames = ringSize;
+
+	queue.capturePackets = new RawPacket[PCPP_XDP_MAX_CAPTURE_BURST];
+
+	sockaddr_xdp addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sxdp_family = AF_XDP;
+	addr.sxdp_ifindex = m_InterfaceIndex;
+	addr.sxdp_queue_id = queue.id;
+
+	// zero-copy is of no use when the program runs in the generic path, where packets are copied anyway
+	bool tryZeroCopy = (m_Config.bindMode == BindZeroCopy || (m_Config.bindMode == BindAuto && m_DriverMode));
+	int bindResult = -1;
+	if (tryZeroCopy)
+	{
+		addr.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+		bindResult = bind(queue.fd, (sockaddr*)&addr, sizeof(addr));
+		if (bindResult < 0 && m_Config.bindMode == BindZeroCopy)
+		{
+			LOG_ERROR("Cannot bind queue %d of device '%s' in zero-copy mode, error was: %d", (int)queue.id, m_InterfaceName.c_str(), errno);
+			return false;
+		}
+	}
+
+	if (bindResult < 0)
+	{
+		addr.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+		if (bind(queue.fd, (sockaddr*)&addr, sizeof(addr)) < 0)
+		{
+			LOG_ERROR("Cannot bind queue %d of device '%s', error was: %d", (int)queue.id, m_InterfaceName.c_str(), errno);
+			return false;
+		}
+	}
+
+	xdp_options options;
+	socklen_t optionsLen = sizeof(options);
+	if (getsockopt(queue.fd, SOL_XDP, XDP_OPTIONS, &options, &optionsLen) == 0)
+		queue.zeroCopy = ((options.flags & XDP_OPTIONS_ZEROCOPY) != 0);
+
+	uint32_t key = queue.id;
+	bpf_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.map_fd = m_XskMapFd;
+	attr.key = (uint64_t)(uintptr_t)&key;
+	attr.value = (uint64_t)(uintptr_t)&queue.fd;
+	attr.flags = BPF_ANY;
+	if (bpfSyscall(BPF_MAP_UPDATE_ELEM, attr) < 0)
+	{
+		LOG_ERROR("Cannot register queue %d of device '%s' in the XSKMAP, error was: %d", (int)queue.id, m_InterfaceName.c_str(), errno);
+		return false;
+	}
+
+	return true;
+
+#else
+
+	return false;
+
+#endif
+}
+
+void XdpDevice::closeQueue(XdpQueue& queue)
+{
+#ifdef LINUX
+	XdpRing* rings[] = { &queue.fillRing, &queue.completionRing, &queue.rxRing, &queue.txRing };
+	for (size_t i = 0; i < sizeof(rings) / sizeof(rings[0]); i++)
+	{
+		if (rings[i]->map != NULL)
+			munmap(rings[i]->map, rings[i]->mapSize);
+		rings[i]->map = NULL;
+	}
+
+	// closing the socket removes it from the XSKMAP
+	if (queue.fd >= 0)
+		::close(queue.fd);
+	if (queue.umem != NULL)
+		munmap(queue.umem, queue.umemSize);
+#endif
+
+	queue.fd = -1;
+	queue.umem = NULL;
+	delete [] queue.heldFrames;
+	queue.heldFrames = NULL;
+	delete [] queue.freeTxFrames;
+	queue.freeTxFrames = NULL;
+	delete [] queue.capturePackets;
+	queue.capturePackets = NULL;
+}
+
+bool XdpDevice::isZeroCopy() const
+{
+	if (m_NumOfOpenedQueues == 0)
+		return false;
+
+	for (uint8_t i = 0; i < m_NumOfOpenedQueues; i++)
+	{
+		if (!m_Queues[i].zeroCopy)
+			return false;
+	}
+
+	return true;
+}
+
+XdpDevice::XdpQueue* XdpDevice::getQueue(uint16_t queueId)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened", m_InterfaceName.c_str());
+		return NULL;
+	}
+
+	if (queueId >= m_NumOfOpenedQueues)
+	{
+		LOG_ERROR("Queue %d isn't opened on device '%s'", (int)queueId, m_InterfaceName.c_str());
+		return NULL;
+	}
+
+	return &m_Queues[queueId];
+}
+
+void XdpDevice::refillQueue(XdpQueue& queue)
+{
+#ifdef LINUX
+
+	if (queue.numOfHeldFrames == 0)
+		return;
+
+	// the fill ring always has room for the held frames, as it's as large as the number of RX frames
+	uint32_t mask = m_Config.ringSize - 1;
+	uint32_t producer = *queue.fillRing.producer;
+	uint64_t* descs = (uint64_t*)queue.fillRing.descs;
+	for (uint32_t i = 0; i < queue.numOfHeldFrames; i++)
+		descs[(producer + i) & mask] = queue.heldFrames[i];
+
+	__atomic_store_n(queue.fillRing.producer, producer + queue.numOfHeldFrames, __ATOMIC_RELEASE);
+	queue.numOfHeldFrames = 0;
+
+#endif
+}
+
+uint16_t XdpDevice::receivePacketsFromQueue(XdpQueue& queue, RawPacket* rawPacketsArr, uint16_t rawPacketArrLength)
+{
+#ifdef LINUX
+
+	refillQueue(queue);
+
+	uint32_t consumer = *queue.rxRing.consumer;
+	uint32_t numOfPackets = __atomic_load_n(queue.rxRing.producer, __ATOMIC_ACQUIRE) - consumer;
+	if (numOfPackets == 0)
+	{
+		// with need-wakeup the driver stops polling the fill ring when it runs dry, and has to be woken up
+		if ((*queue.fillRing.flags & XDP_RING_NEED_WAKEUP) != 0)
+			recvfrom(queue.fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+		return 0;
+	}
+
+	if (numOfPackets > rawPacketArrLength)
+		numOfPackets = rawPacketArrLength;
+
+	timespec timestamp;
+	clock_gettime(CLOCK_REALTIME, &timestamp);
+
+	uint32_t mask = m_Config.ringSize - 1;
+	uint64_t frameMask = ~((uint64_t)m_Config.frameSize - 1);
+	xdp_desc* descs = (xdp_desc*)queue.rxRing.descs;
+	uint64_t numOfBytes = 0;
+	uint32_t numOfMatched = 0;
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		const xdp_desc& desc = descs[(consumer + i) & mask];
+		// the address points past the headroom of the frame, the frame itself is given back to the fill ring. Frames of packets which
+		// don't match the software filter are given back without returning the packets
+		queue.heldFrames[i] = desc.addr & frameMask;
+		RawPacket& rawPacket = rawPacketsArr[numOfMatched];
+		rawPacket.setExternalRawData(queue.umem + desc.addr, (int)desc.len, timestamp, LINKTYPE_ETHERNET, (int)desc.len);
+		if (m_SoftwareFilter != NULL && !m_SoftwareFilter->matchPacketWithFilter(&rawPacket))
+			continue;
+
+		numOfMatched++;
+		numOfBytes += desc.len;
+	}
+
+	__atomic_store_n(queue.rxRing.consumer, consumer + numOfPackets, __ATOMIC_RELEASE);
+	queue.numOfHeldFrames = numOfPackets;
+	queue.stats.rxPackets += numOfMatched;
+	queue.stats.rxBytes += numOfBytes;
+
+	return (uint16_t)numOfMatched;
+
+#else
+
+	return 0;
+
+#endif
+}
+
+uint16_t XdpDevice::receivePackets(RawPacket* rawPacketsArr, uint16_t rawPacketArrLength, uint16_t rxQueueId)
+{
+	XdpQueue* queue = getQueue(rxQueueId);
+	if (queue == NULL)
+		return 0;
+
+	if (rawPacketsArr == NULL)
+	{
+		LOG_ERROR("Provided address of array to store packets is NULL");
+		return 0;
+	}
+
+	return receivePacketsFromQueue(*queue, rawPacketsArr, rawPacketArrLength);
+}
+
+void XdpDevice::reclaimTxFrames(XdpQueue& queue)
+{
+#ifdef LINUX
+
+	uint32_t consumer = *queue.completionRing.consumer;
+	uint32_t numOfCompleted = __atomic_load_n(queue.completionRing.producer, __ATOMIC_ACQUIRE) - consumer;
+	if (numOfCompleted == 0)
+		return;
+
+	uint32_t mask = m_Config.ringSize - 1;
+	uint64_t* descs = (uint64_t*)queue.completionRing.descs;
+	for (uint32_t i = 0; i < numOfCompleted; i++)
+		queue.freeTxFrames[queue.numOfFreeTxFrames++] = descs[(consumer + i) & mask];
+
+	__atomic_store_n(queue.completionRing.consumer, consumer + numOfCompleted, __ATOMIC_RELEASE);
+
+#endif
+}
+
+uint32_t XdpDevice::prepareSend(XdpQueue& queue, uint32_t numOfPackets)
+{
+	reclaimTxFrames(queue);
+
+	// the TX ring always has room for the free frames, as it's as large as the number of TX frames
+	if (numOfPackets > queue.numOfFreeTxFrames)
+		numOfPackets = queue.numOfFreeTxFrames;
+
+	return numOfPackets;
+}
+
+bool XdpDevice::writeTxDescriptor(XdpQueue& queue, const RawPacket& rawPacket, uint32_t index)
+{
+#ifdef LINUX
+
+	uint32_t len = (uint32_t)rawPacket.getRawDataLen();
+	if (len > m_Config.frameSize)
+	{
+		LOG_ERROR("Cannot send a packet of %u bytes on device '%s', it's larger than the frame size (%u)", len, m_InterfaceName.c_str(),
+				m_Config.frameSize);
+		return false;
+	}
+
+	uint64_t frame = queue.freeTxFrames[--queue.numOfFreeTxFrames];
+	memcpy(queue.umem + frame, rawPacket.getRawData(), len);
+
+	xdp_desc& desc = ((xdp_desc*)queue.txRing.descs)[(*queue.txRing.producer + index) & (m_Config.ringSize - 1)];
+	desc.addr = frame;
+	desc.len = len;
+	desc.options = 0;
+	queue.stats.txBytes += len;
+	return true;
+
+#else
+
+	return false;
+
+#endif
+}
+
+void XdpDevice::commitSend(XdpQueue& queue, uint32_t numOfPackets)
+{
+#ifdef LINUX
+
+	if (numOfPackets > 0)
+	{
+		__atomic_store_n(queue.txRing.producer, *queue.txRing.producer + numOfPackets, __ATOMIC_RELEASE);
+		queue.stats.txPackets += numOfPackets;
+	}
+
+	// in copy mode, and in zero-copy mode when the driver asks for it, packets are sent only when the kernel is kicked. Sending is kicked
+	// also when nothing was written but the frames ran out, so they're completed and can be reclaimed on the next call
+	if ((numOfPackets > 0 || queue.numOfFreeTxFrames == 0) && (*queue.txRing.flags & XDP_RING_NEED_WAKEUP) != 0)
+	{
+		if (sendto(queue.fd, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0 && errno != EAGAIN && errno != EBUSY && errno != ENOBUFS && errno != ENETDOWN)
+			LOG_ERROR("Cannot kick TX of queue %d of device '%s', error was: %d", (int)queue.id, m_InterfaceName.c_str(), errno);
+	}
+
+#endif
+}
+
+uint16_t XdpDevice::sendPackets(const RawPacket* rawPacketsArr, uint16_t arrLength, uint16_t txQueueId)
+{
+	XdpQueue* queue = getQueue(txQueueId);
+	if (queue == NULL)
+		return 0;
+
+	uint32_t numOfPacketsToSend = prepareSend(*queue, arrLength);
+	uint32_t numOfPacketsSent = 0;
+	while (numOfPacketsSent < numOfPacketsToSend && writeTxDescriptor(*queue, rawPacketsArr[numOfPacketsSent], numOfPacketsSent))
+		numOfPacketsSent++;
+
+	commitSend(*queue, numOfPacketsSent);
+	return (uint16_t)numOfPacketsSent;
+}
+
+uint16_t XdpDevice::sendPackets(const RawPacketVector& rawPackets, uint16_t txQueueId)
+{
+	XdpQueue* queue = getQueue(txQueueId);
+	if (queue == NULL)
+		return 0;
+
+	uint32_t numOfPackets = (rawPackets.size() > 0xFFFF ? 0xFFFF : (uint32_t)rawPackets.size());
+	uint32_t numOfPacketsToSend = prepareSend(*queue, numOfPackets);
+	uint32_t numOfPacketsSent = 0;
+	for (RawPacketVector::ConstVectorIterator iter = rawPackets.begin(); numOfPacketsSent < numOfPacketsToSend; iter++)
+	{
+		if (!writeTxDescriptor(*queue, **iter, numOfPacketsSent))
+			break;
+		numOfPacketsSent++;
+	}
+
+	commitSend(*queue, numOfPacketsSent);
+	return (uint16_t)numOfPacketsSent;
+}
+
+bool XdpDevice::sendPacket(const RawPacket& rawPacket, uint16_t txQueueId)
+{
+	return sendPackets(&rawPacket, 1, txQueueId) == 1;
+}
+
+void* XdpDevice::captureThreadMain(void* queuePtr)
+{
+	XdpQueue* queue = (XdpQueue*)queuePtr;
+	XdpDevice* device = queue->device;
+
+	LOG_DEBUG("Started capture thread for queue %d of device '%s' on core %d", (int)queue->id, device->m_InterfaceName.c_str(), queue->coreId);
+	while (!device->m_StopThreads)
+	{
+		uint16_t numOfPackets = device->receivePacketsFromQueue(*queue, queue->capturePackets, PCPP_XDP_MAX_CAPTURE_BURST);
+		if (numOfPackets > 0)
+		{
+			device->m_OnPacketsArrive(queue->capturePackets, numOfPackets, queue->id, device, device->m_OnPacketsArriveUserCookie);
+			continue;
+		}
+
+#ifdef LINUX
+		pollfd pfd;
+		pfd.fd = queue->fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, CAPTURE_THREAD_POLL_TIMEOUT_MS) < 0 && errno != EINTR)
+		{
+			LOG_ERROR("Cannot poll queue %d of device '%s', error was: %d", (int)queue->id, device->m_InterfaceName.c_str(), errno);
+			break;
+		}
+#endif
+	}
+	LOG_DEBUG("Ended capture thread for queue %d of device '%s'", (int)queue->id, device->m_InterfaceName.c_str());
+
+	return NULL;
+}
+
+bool XdpDevice::startCapture(OnXdpPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, CoreMask coreMask)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened", m_InterfaceName.c_str());
+		return false;
+	}
+
+	if (m_CaptureThreadsStarted)
+	{
+		LOG_ERROR("Device '%s' already capturing", m_InterfaceName.c_str());
+		return false;
+	}
+
+	if (onPacketsArrive == NULL)
+	{
+		LOG_ERROR("No callback given for capturing on device '%s'", m_InterfaceName.c_str());
+		return false;
+	}
+
+	std::vector<SystemCore> cores;
+	createCoreVectorFromCoreMask(coreMask, cores);
+	if (cores.size() != m_NumOfOpenedQueues)
+	{
+		LOG_ERROR("Cannot use a different number of queues and cores. Opened %d queues but set %d cores in core mask", (int)m_NumOfOpenedQueues,
+				(int)cores.size());
+		return false;
+	}
+
+	m_OnPacketsArrive = onPacketsArrive;
+	m_OnPacketsArriveUserCookie = onPacketsArriveUserCookie;
+	m_StopThreads = false;
+
+	for (uint8_t i = 0; i < m_NumOfOpenedQueues; i++)
+	{
+		m_Queues[i].coreId = cores[i].Id;
+		int numOfThreadsCreated = i;
+		int err = pthread_create(&m_Queues[i].thread, NULL, captureThreadMain, &m_Queues[i]);
+		if (err != 0)
+			LOG_ERROR("Cannot create capture thread for queue %d of device '%s': [%s]", (int)i, m_InterfaceName.c_str(), strerror(err));
+#ifdef LINUX
+		else
+		{
+			numOfThreadsCreated++;
+			cpu_set_t cpuset;
+			CPU_ZERO(&cpuset);
+			CPU_SET(cores[i].Id, &cpuset);
+			if ((err = pthread_setaffinity_np(m_Queues[i].thread, sizeof(cpu_set_t), &cpuset)) != 0)
+				LOG_ERROR("Error while binding thread to core %d: errno=%i", cores[i].Id, err);
+		}
+#endif
+
+		if (err != 0)
+		{
+			m_StopThreads = true;
+			for (int j = 0; j < numOfThreadsCreated; j++)
+				pthread_join(m_Queues[j].thread, NULL);
+			m_StopThreads = false;
+			return false;
+		}
+	}
+
+	m_CaptureThreadsStarted = true;
+	LOG_DEBUG("Capturing started on device '%s'", m_InterfaceName.c_str());
+	return true;
+}
+
+bool XdpDevice::startCapture(OnXdpPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie)
+{
+	int numaNode = getNetworkInterfaceNumaNode(m_InterfaceName);
+	CoreMask coreMask = selectNumaLocalCores(numaNode, m_NumOfOpenedQueues);
+	LOG_DEBUG("Selected core mask 0x%X for %d queues of device '%s' on NUMA node %d", coreMask, (int)m_NumOfOpenedQueues, m_InterfaceName.c_str(), numaNode);
+	return startCapture(onPacketsArrive, onPacketsArriveUserCookie, coreMask);
+}
+
+void XdpDevice::stopCapture()
+{
+	if (!m_CaptureThreadsStarted)
+		return;
+
+	m_StopThreads = true;
+	for (uint8_t i = 0; i < m_NumOfOpenedQueues; i++)
+		pthread_join(m_Queues[i].thread, NULL);
+
+	m_CaptureThreadsStarted = false;
+	m_StopThreads = false;
+	LOG_DEBUG("Capturing stopped on device '%s'", m_InterfaceName.c_str());
+}
+
+void XdpDevice::getQueueStatistics(uint8_t queueId, XdpStats& stats)
+{
+	memset(&stats, 0, sizeof(stats));
+	if (!m_DeviceOpened || queueId >= m_NumOfOpenedQueues)
+		return;
+
+	XdpQueue& queue = m_Queues[queueId];
+	stats = queue.stats;
+
+#ifdef LINUX
+	// kernels older than 5.9 fill only the first three counters
+	xdp_statistics kernelStats;
+	memset(&kernelStats, 0, sizeof(kernelStats));
+	socklen_t len = sizeof(kernelStats);
+	if (getsockopt(queue.fd, SOL_XDP, XDP_STATISTICS, &kernelStats, &len) < 0)
+	{
+		LOG_ERROR("Cannot read statistics of queue %d of device '%s', error was: %d", (int)queueId, m_InterfaceName.c_str(), errno);
+		return;
+	}
+
+	stats.rxDropped = kernelStats.rx_dropped + kernelStats.rx_ring_full;
+	stats.rxInvalidDescs = kernelStats.rx_invalid_descs;
+	stats.txInvalidDescs = kernelStats.tx_invalid_descs;
+#endif
+}
+
+void XdpDevice::getStatistics(XdpStats& stats)
+{
+	memset(&stats, 0, sizeof(stats));
+	for (uint8_t i = 0; i < m_NumOfOpenedQueues; i++)
+	{
+		XdpStats queueStats;
+		getQueueStatistics(i, queueStats);
+		stats.rxPackets += queueStats.rxPackets;
+		stats.rxBytes += queueStats.rxBytes;
+		stats.txPackets += queueStats.txPackets;
+		stats.txBytes += queueStats.txBytes;
+		stats.rxDropped += queueStats.rxDropped;
+		stats.rxInvalidDescs += queueStats.rxInvalidDescs;
+		stats.txInvalidDescs += queueStats.txInvalidDescs;
+	}
+}
+
+void XdpDevice::collectMetrics(MetricsWriter& writer)
+{
+	if (!m_DeviceOpened)
+		return;
+
+	XdpStats stats;
+	getStatistics(stats);
+	writer.addCounter("pcpp_device_rx_packets_total", "Packets received by the device", stats.rxPackets);
+	writer.addCounter("pcpp_device_rx_bytes_total", "Bytes received by the device", stats.rxBytes);
+	writer.addCounter("pcpp_device_tx_packets_total", "Packets sent by the device", stats.txPackets);
+	writer.addCounter("pcpp_device_tx_bytes_total", "Bytes sent by the device", stats.txBytes);
+	writer.addCounter("pcpp_device_rx_dropped_packets_total", "Packets dropped by the device", stats.rxDropped);
+	writer.addCounter("pcpp_device_invalid_descriptors_total", "Invalid RX and TX descriptors", stats.rxInvalidDescs + stats.txInvalidDescs);
+}
+
+} // namespace pcpp
@@ -13,6 +13,8 @@
 #include <HttpLayer.h>
 #include <PPPoELayer.h>
 #include <DnsLayer.h>
+#include <DnsMessageView.h>
+#include <DnsResponder.h>
 #include <MplsLayer.h>
 #include <IcmpLayer.h>
 #include <GreLayer.h>
@@ -23,10 +25,71 @@
 #include <VxlanLayer.h>
 #include <SipLayer.h>
 #include <SdpLayer.h>
+#include <SipDialogTracker.h>
+#include <RtpHeaderView.h>
+#include <RtpStreamAnalyzer.h>
 #include <PacketTrailerLayer.h>
+#include <PacketBatch.h>
+#include <ProtocolRegistry.h>
+#include <PacketView.h>
+#include <RawPacketPool.h>
+#include <RawPacketSlabVector.h>
+#include <PacketMemoryAllocator.h>
+#include <PointerVector.h>
+#include <FlowHash.h>
+#include <FlowTable.h>
+#include <FlowMeter.h>
+#include <FlowExporter.h>
+#include <TcpFlowTracker.h>
+#include <GtpSessionTable.h>
+#include <TrafficShaper.h>
+#include <CaptureCutoff.h>
+#include <MacLearningTable.h>
+#include <PacketTemplate.h>
+#include <PacketSegmenter.h>
+#include <PacketDeduplicator.h>
+#include <PayloadClassifier.h>
+#include <StaticPacket.h>
+#include <TunnelDecapsulator.h>
+#include <RuleClassifier.h>
+#include <DomainMatcher.h>
+#include <HeavyHitterBypass.h>
+#include <ClusterDistributor.h>
+#include <PacketReorderBuffer.h>
+#include <LpmTable.h>
+#include <L3Forwarder.h>
+#include <ChecksumVerifier.h>
+#include <StreamNormalizer.h>
+#include <MultiPatternMatcher.h>
+#include <HttpStreamParser.h>
+#include <SSLStreamParser.h>
+#include <StreamCoroutine.h>
+#include <FlowDispatcher.h>
+#include <ParallelPacketProcessor.h>
+#include <TcpSegmentCoalescer.h>
+#include <FixedLRUList.h>
+#include <LRUList.h>
+#include <TimestampClock.h>
+#include <LatencyTracer.h>
+#include <StatsReporter.h>
+#include <MetricsRegistry.h>
+#include <HardwareCounters.h>
+#include <HashCounters.h>
+#include <TimerWheel.h>
+#include <TcpReassembly.h>
+#include <ShardedTcpReassembly.h>
+#include <ShardedIPReassembly.h>
+#include <SPSCQueue.h>
+#include <MPMCQueue.h>
+#include <MemoryBudget.h>
+#include <IPReassembly.h>
+#include <TrafficGenerator.h>
+#include <PlatformSpecificUtils.h>
 #include <RadiusLayer.h>
 #include <GtpLayer.h>
 #include <IpAddress.h>
+#include <IpUtils.h>
+#include <GeneralUtils.h>
 #include <fstream>
 #include <stdlib.h>
 #include "PcppTestFramework.h"
@@ -34,14 +97,20 @@
 #include <sstream>
 #include <string.h>
 #include <getopt.h>
+#include <utility>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sched.h>
 #ifdef WIN32
 #include <winsock2.h>
 #else
 #include <in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #endif
-#ifdef _MSC_VER
 #include <SystemUtils.h>
-#endif
 
 // For debug purpose only
 // #include <pcap.h>
@@ -1320,6 +1389,86 @@ PTF_TEST_CASE(Ipv6ExtensionsTest)
 
 }
 
+PTF_TEST_CASE(Ipv6ExtensionChainTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	int buffer1Length = 0;
+	uint8_t* buffer1 = readFileIntoBuffer("PacketExamples/ipv6_options_multi.dat", buffer1Length);
+	PTF_ASSERT_NOT_NULL(buffer1);
+	RawPacket rawPacket1((const uint8_t*)buffer1, buffer1Length, time, true);
+
+	int buffer2Length = 0;
+	uint8_t* buffer2 = readFileIntoBuffer("PacketExamples/IPv6Frag1.dat", buffer2Length);
+	PTF_ASSERT_NOT_NULL(buffer2);
+	RawPacket rawPacket2((const uint8_t*)buffer2, buffer2Length, time, true);
+
+	// the chain is read from the inline types and offsets, before any extension object is created
+	Packet multiExtPacket(&rawPacket1);
+	IPv6Layer* ipv6Layer = multiExtPacket.getLayerOfType<IPv6Layer>();
+	PTF_ASSERT_NOT_NULL(ipv6Layer);
+	PTF_ASSERT_EQUAL(ipv6Layer->getExtensionCount(), 4, size);
+	PTF_ASSERT_EQUAL(ipv6Layer->getExtensionType(0), IPv6Extension::IPv6HopByHop, enum);
+	PTF_ASSERT_EQUAL(ipv6Layer->getExtensionType(1), IPv6Extension::IPv6Destination, enum);
+	PTF_ASSERT_EQUAL(ipv6Layer->getExtensionType(2), IPv6Extension::IPv6Routing, enum);
+	PTF_ASSERT_EQUAL(ipv6Layer->getExtensionType(3), IPv6Extension::IPv6AuthenticationHdr, enum);
+	PTF_ASSERT_EQUAL(ipv6Layer->getExtensionType(4), IPv6Extension::IPv6ExtensionUnknown, enum);
+	PTF_ASSERT_EQUAL(ipv6Layer->getUpperLayerProtocol(), 89, u8);
+	PTF_ASSERT_EQUAL(ipv6Layer->getHeaderLen(), 104, size);
+	PTF_ASSERT_FALSE(ipv6Layer->isFragment());
+	PTF_ASSERT_NULL(ipv6Layer->getFragmentationHeader());
+	PTF_ASSERT_EQUAL(ipv6Layer->toString(), "IPv6 Layer, Src: fe80::2, Dst: ff02::5, Options=[Hop-By-Hop,Destination,Routing,Authentication]", string);
+
+	// the static walk gives the same result
+	uint8_t protocol = 0;
+	size_t headerLen = 0;
+	size_t fragmentHeaderOffset = 0;
+	PTF_ASSERT_TRUE(IPv6Layer::findUpperLayerProtocol(ipv6Layer->getData(), ipv6Layer->getDataLen(), protocol, headerLen, fragmentHeaderOffset));
+	PTF_ASSERT_EQUAL(protocol, 89, u8);
+	PTF_ASSERT_EQUAL(headerLen, 104, size);
+	PTF_ASSERT_EQUAL(fragmentHeaderOffset, 0, size);
+	PTF_ASSERT_FALSE(IPv6Layer::findUpperLayerProtocol(ipv6Layer->getData(), 39, protocol, headerLen, fragmentHeaderOffset));
+
+	// the extension objects are created on demand and match the inline data
+	IPv6RoutingHeader* routingExt = ipv6Layer->getExtensionOfType<IPv6RoutingHeader>();
+	PTF_ASSERT_NOT_NULL(routingExt);
+	PTF_ASSERT_EQUAL(routingExt->getRoutingHeader()->routingType, 0, u8);
+	PTF_ASSERT_NOT_NULL(ipv6Layer->getExtensionOfType<IPv6AuthenticationHeader>());
+
+	// adding and removing extensions keeps the inline data up to date
+	ipv6Layer->removeAllExtensions();
+	PTF_ASSERT_EQUAL(ipv6Layer->getExtensionCount(), 0, size);
+	PTF_ASSERT_EQUAL(ipv6Layer->getUpperLayerProtocol(), 89, u8);
+	PTF_ASSERT_EQUAL(ipv6Layer->getHeaderLen(), 40, size);
+
+	IPv6FragmentationHeader fragHeader(0x1234, 16, true);
+	PTF_ASSERT_NOT_NULL(ipv6Layer->addExtension<IPv6FragmentationHeader>(fragHeader));
+	PTF_ASSERT_EQUAL(ipv6Layer->getExtensionCount(), 1, size);
+	PTF_ASSERT_EQUAL(ipv6Layer->getExtensionType(0), IPv6Extension::IPv6Fragmentation, enum);
+	PTF_ASSERT_EQUAL(ipv6Layer->getUpperLayerProtocol(), 89, u8);
+	PTF_ASSERT_TRUE(ipv6Layer->isFragment());
+	PTF_ASSERT_NOT_NULL(ipv6Layer->getFragmentationHeader());
+	PTF_ASSERT_EQUAL(ntohl(ipv6Layer->getFragmentationHeader()->id), 0x1234, u32);
+
+	// a fragment
+	Packet fragPacket(&rawPacket2);
+	ipv6Layer = fragPacket.getLayerOfType<IPv6Layer>();
+	PTF_ASSERT_NOT_NULL(ipv6Layer);
+	PTF_ASSERT_TRUE(ipv6Layer->isFragment());
+	PTF_ASSERT_EQUAL(ipv6Layer->getExtensionCount(), 1, size);
+	PTF_ASSERT_EQUAL(ipv6Layer->getUpperLayerProtocol(), PACKETPP_IPPROTO_UDP, u8);
+	IPv6FragmentationHeader::ipv6_frag_header* fragHdr = ipv6Layer->getFragmentationHeader();
+	PTF_ASSERT_NOT_NULL(fragHdr);
+	PTF_ASSERT_EQUAL(ntohl(fragHdr->id), 0xf88eb466, u32);
+	PTF_ASSERT_TRUE(fragHdr == ipv6Layer->getExtensionOfType<IPv6FragmentationHeader>()->getFragHeader());
+
+	PTF_ASSERT_TRUE(IPv6Layer::findUpperLayerProtocol(ipv6Layer->getData(), ipv6Layer->getDataLen(), protocol, headerLen, fragmentHeaderOffset));
+	PTF_ASSERT_EQUAL(protocol, PACKETPP_IPPROTO_UDP, u8);
+	PTF_ASSERT_EQUAL(headerLen, 48, size);
+	PTF_ASSERT_EQUAL(fragmentHeaderOffset, 40, size);
+}
+
 PTF_TEST_CASE(TcpPacketNoOptionsParsing)
 {
 	int bufferLength = 0;
@@ -3188,6 +3337,280 @@ PTF_TEST_CASE(DnsLayerRemoveResourceTest)
 
 }
 
+PTF_TEST_CASE(DnsMessageViewTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/Dns1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet dnsPacket(&rawPacket);
+	DnsLayer* dnsLayer = dnsPacket.getLayerOfType<DnsLayer>();
+	PTF_ASSERT_NOT_NULL(dnsLayer);
+
+	DnsMessageView view;
+	PTF_ASSERT_TRUE(view.parse(dnsLayer->getData(), dnsLayer->getDataLen()));
+	PTF_ASSERT_TRUE(view.isComplete());
+	PTF_ASSERT_EQUAL(ntohs(view.getDnsHeader()->transactionID), 0x2d6d, u16);
+	PTF_ASSERT_EQUAL(view.getRecordCount(), dnsLayer->getQueryCount() + dnsLayer->getAnswerCount() + dnsLayer->getAuthorityCount() + dnsLayer->getAdditionalRecordCount(), size);
+
+	char name[256];
+	size_t nameLen = 0;
+	PTF_ASSERT_EQUAL(view.getSection(0), DnsQueryType, enum);
+	PTF_ASSERT_EQUAL(view.getDnsType(0), DNS_TYPE_A, enum);
+	PTF_ASSERT_EQUAL(view.getTTL(0), 0, u32);
+	PTF_ASSERT_NULL(view.getData(0));
+	PTF_ASSERT_TRUE(view.getName(0, name, sizeof(name), &nameLen));
+	PTF_ASSERT_EQUAL(std::string(name), "www.google-analytics.com", string);
+	PTF_ASSERT_EQUAL(nameLen, 24, size);
+	PTF_ASSERT_TRUE(view.isNameEqual(0, "www.google-analytics.com"));
+	PTF_ASSERT_TRUE(view.isNameEqual(0, "WWW.Google-Analytics.com."));
+	PTF_ASSERT_FALSE(view.isNameEqual(0, "www.google-analytics"));
+	PTF_ASSERT_FALSE(view.isNameEqual(0, "www.google-analytics.co"));
+	PTF_ASSERT_FALSE(view.isNameEqual(0, "www.google-analytics.com.il"));
+
+	// the answer name is a compression pointer to the query name
+	PTF_ASSERT_EQUAL(view.getSection(1), DnsAnswerType, enum);
+	PTF_ASSERT_EQUAL(view.getDnsType(1), DNS_TYPE_CNAME, enum);
+	PTF_ASSERT_EQUAL(view.getDnsClass(1), DNS_CLASS_IN, enum);
+	PTF_ASSERT_EQUAL(view.getTTL(1), 57008, u32);
+	PTF_ASSERT_EQUAL(view.getDataLength(1), 32, size);
+	PTF_ASSERT_TRUE(view.isNameEqual(1, "www.google-analytics.com"));
+	PTF_ASSERT_TRUE(view.decodeName(view.getDataOffset(1), name, sizeof(name)));
+	PTF_ASSERT_EQUAL(std::string(name), "www-google-analytics.l.google.com", string);
+	PTF_ASSERT_TRUE(view.isNameEqualAtOffset(view.getDataOffset(1), "www-google-analytics.l.google.com"));
+
+	// names which don't fit in the buffer aren't decoded
+	PTF_ASSERT_FALSE(view.decodeName(view.getDataOffset(1), name, 10));
+	PTF_ASSERT_EQUAL(std::string(name), "", string);
+
+	PTF_ASSERT_EQUAL(view.findRecord(DnsAnswerType, "www-google-analytics.l.google.com"), 2, int);
+	PTF_ASSERT_EQUAL(view.findRecord(DnsAuthorityType, "www-google-analytics.l.google.com"), -1, int);
+	DnsResource* answer = dnsLayer->getNextAnswer(dnsLayer->getFirstAnswer());
+	PTF_ASSERT_EQUAL(view.getDnsType(2), DNS_TYPE_A, enum);
+	PTF_ASSERT_EQUAL(view.getDataLength(2), 4, size);
+	uint32_t answerAddr = answer->getData().castAs<IPv4DnsResourceData>()->getIpAddress().toInt();
+	PTF_ASSERT_TRUE(memcmp(view.getData(2), &answerAddr, 4) == 0);
+
+	// a root name and the additional section
+	int buffer2Length = 0;
+	uint8_t* buffer2 = readFileIntoBuffer("PacketExamples/Dns3.dat", buffer2Length);
+	PTF_ASSERT_NOT_NULL(buffer2);
+	RawPacket rawPacket2((const uint8_t*)buffer2, buffer2Length, time, true);
+	Packet dnsPacket2(&rawPacket2);
+	dnsLayer = dnsPacket2.getLayerOfType<DnsLayer>();
+	PTF_ASSERT_NOT_NULL(dnsLayer);
+	PTF_ASSERT_TRUE(view.parse(dnsLayer->getData(), dnsLayer->getDataLen()));
+	PTF_ASSERT_TRUE(view.isComplete());
+	PTF_ASSERT_EQUAL(view.getRecordCount(), 5, size);
+	PTF_ASSERT_EQUAL(view.getSection(2), DnsAuthorityType, enum);
+	PTF_ASSERT_EQUAL(view.getDnsType(3), DNS_TYPE_AAAA, enum);
+	PTF_ASSERT_EQUAL(view.getTTL(3), 120, u32);
+	PTF_ASSERT_EQUAL(view.getDataLength(3), 16, size);
+	PTF_ASSERT_EQUAL(view.getSection(4), DnsAdditionalType, enum);
+	PTF_ASSERT_EQUAL(view.getDnsType(4), DNS_TYPE_OPT, enum);
+	PTF_ASSERT_EQUAL(view.getTTL(4), 0x1194, u32);
+	PTF_ASSERT_TRUE(view.getName(4, name, sizeof(name), &nameLen));
+	PTF_ASSERT_EQUAL(nameLen, 0, size);
+	PTF_ASSERT_TRUE(view.isNameEqual(4, ""));
+	PTF_ASSERT_TRUE(view.isNameEqual(4, "."));
+	PTF_ASSERT_EQUAL(view.findRecord(DnsAuthorityType, "yaels-iphone.local"), 2, int);
+
+	// malformed messages: a compression pointer loop and a record which exceeds the data
+	uint8_t loopMsg[] = { 0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x01, 'a', 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01 };
+	PTF_ASSERT_TRUE(view.parse(loopMsg, sizeof(loopMsg)));
+	PTF_ASSERT_TRUE(view.isComplete());
+	PTF_ASSERT_EQUAL(view.getRecordCount(), 1, size);
+	PTF_ASSERT_FALSE(view.getName(0, name, sizeof(name)));
+	PTF_ASSERT_FALSE(view.isNameEqual(0, "a.a.a"));
+
+	PTF_ASSERT_TRUE(view.parse(loopMsg, sizeof(loopMsg) - 1));
+	PTF_ASSERT_FALSE(view.isComplete());
+	PTF_ASSERT_EQUAL(view.getRecordCount(), 0, size);
+	PTF_ASSERT_FALSE(view.parse(loopMsg, sizeof(dnshdr) - 1));
+	PTF_ASSERT_NULL(view.getDnsHeader());
+} // DnsMessageViewTest
+
+
+PTF_TEST_CASE(DnsResponderTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	DnsResponder responder;
+	PTF_ASSERT_TRUE(responder.addRecord("www.Example.com", IPv4Address(std::string("10.0.0.1")), 300));
+	PTF_ASSERT_TRUE(responder.addRecord("www.example.com.", IPv6Address(std::string("2001:db8::1")), 600));
+	PTF_ASSERT_TRUE(responder.addRecord("*.ads.example.net", IPv4Address(std::string("10.0.0.2")), 60));
+	PTF_ASSERT_FALSE(responder.addRecord("WWW.example.com", IPv4Address(std::string("10.0.0.3")), 300));
+	PTF_ASSERT_FALSE(responder.addRecord("bad..name", IPv4Address(std::string("10.0.0.3")), 300));
+	PTF_ASSERT_EQUAL(responder.getRecordCount(), 3, size);
+
+	// build queries the way a resolver would, with an EDNS OPT record, and check the responses against a full recompute of the fields
+	const char* names[] = { "WWW.example.COM", "www.example.com", "ab.ads.example.net", "ads.example.net", "other.com" };
+	const DnsType types[] = { DNS_TYPE_A, DNS_TYPE_AAAA, DNS_TYPE_A, DNS_TYPE_A, DNS_TYPE_A };
+	const DnsResponder::Result results[] = { DnsResponder::Responded, DnsResponder::Responded, DnsResponder::Responded,
+			DnsResponder::NoMatch, DnsResponder::NoMatch };
+	for (int i = 0; i < 5; i++)
+	{
+		for (int ipVersion = 4; ipVersion <= 6; ipVersion += 2)
+		{
+			Packet query(100);
+			EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"));
+			VlanLayer vlanLayer(100, false, 0, (ipVersion == 4 ? PCPP_ETHERTYPE_IP : PCPP_ETHERTYPE_IPV6));
+			IPv4Layer ip4Layer(IPv4Address(std::string("192.168.1.10")), IPv4Address(std::string("192.168.1.1")));
+			ip4Layer.getIPv4Header()->timeToLive = 63;
+			IPv6Layer ip6Layer(IPv6Address(std::string("fe80::10")), IPv6Address(std::string("fe80::1")));
+			UdpLayer udpLayer(40000 + i, 53);
+			DnsLayer dnsLayer;
+			dnsLayer.getDnsHeader()->transactionID = htons(0x1000 + i);
+			dnsLayer.getDnsHeader()->recursionDesired = 1;
+			PTF_ASSERT_NOT_NULL(dnsLayer.addQuery(names[i], types[i], DNS_CLASS_IN));
+			uint8_t optionData[] = { 0x00, 0x0a, 0x00, 0x01, 0x7f };
+			GenericDnsResourceData optData(optionData, sizeof(optionData) - (ipVersion == 4 ? 1 : 0));
+			PTF_ASSERT_NOT_NULL(dnsLayer.addAdditionalRecord("", DNS_TYPE_OPT, 4096, 0, &optData));
+			query.addLayer(&ethLayer);
+			if (i == 1)
+				query.addLayer(&vlanLayer);
+			else
+				ethLayer.getEthHeader()->etherType = htons(ipVersion == 4 ? PCPP_ETHERTYPE_IP : PCPP_ETHERTYPE_IPV6);
+			query.addLayer(ipVersion == 4 ? (Layer*)&ip4Layer : (Layer*)&ip6Layer);
+			query.addLayer(&udpLayer);
+			query.addLayer(&dnsLayer);
+			query.computeCalculateFields();
+
+			uint8_t buffer[256];
+			size_t queryLen = query.getRawPacket()->getRawDataLen();
+			memcpy(buffer, query.getRawPacket()->getRawData(), queryLen);
+			size_t dataLen = queryLen;
+			PTF_ASSERT_EQUAL(responder.processPacket(buffer, dataLen, sizeof(buffer)), results[i], enum);
+			if (results[i] != DnsResponder::Responded)
+			{
+				PTF_ASSERT_EQUAL(dataLen, queryLen, size);
+				PTF_ASSERT_TRUE(memcmp(buffer, query.getRawPacket()->getRawData(), queryLen) == 0);
+				continue;
+			}
+
+			// responses which don't fit aren't built
+			size_t shortLen = queryLen;
+			uint8_t shortBuffer[256];
+			memcpy(shortBuffer, query.getRawPacket()->getRawData(), queryLen);
+			PTF_ASSERT_EQUAL(responder.processPacket(shortBuffer, shortLen, dataLen - 1), DnsResponder::NoRoom, enum);
+
+			RawPacket rawResponse(buffer, (int)dataLen, time, false);
+			Packet response(&rawResponse);
+			PTF_ASSERT_TRUE(response.isPacketOfType(DNS));
+			PTF_ASSERT_EQUAL(response.getLayerOfType<EthLayer>()->getSourceMac(), MacAddress("aa:bb:cc:dd:ee:02"), object);
+			PTF_ASSERT_EQUAL(response.getLayerOfType<UdpLayer>()->getSrcPort(), 53, u16);
+			PTF_ASSERT_EQUAL(response.getLayerOfType<UdpLayer>()->getDstPort(), 40000 + i, u16);
+			DnsLayer* responseDns = response.getLayerOfType<DnsLayer>();
+			PTF_ASSERT_NOT_NULL(responseDns);
+			PTF_ASSERT_EQUAL(ntohs(responseDns->getDnsHeader()->transactionID), 0x1000 + i, u16);
+			PTF_ASSERT_EQUAL(responseDns->getDnsHeader()->queryOrResponse, 1, u8);
+			PTF_ASSERT_EQUAL(responseDns->getDnsHeader()->recursionDesired, 1, u8);
+			PTF_ASSERT_EQUAL(responseDns->getAnswerCount(), 1, size);
+			PTF_ASSERT_EQUAL(responseDns->getAdditionalRecordCount(), 0, size);
+			DnsResource* answer = responseDns->getFirstAnswer();
+			PTF_ASSERT_NOT_NULL(answer);
+			PTF_ASSERT_EQUAL(answer->getName(), names[i], string);
+			PTF_ASSERT_EQUAL(answer->getDnsType(), types[i], enum);
+			if (types[i] == DNS_TYPE_A)
+			{
+				PTF_ASSERT_EQUAL(answer->getData()->toString(), (i == 0 ? "10.0.0.1" : "10.0.0.2"), string);
+				PTF_ASSERT_EQUAL(answer->getTTL(), (i == 0 ? 300 : 60), u32);
+			}
+			else
+			{
+				PTF_ASSERT_EQUAL(answer->getData()->toString(), "2001:db8::1", string);
+				PTF_ASSERT_EQUAL(answer->getTTL(), 600, u32);
+			}
+
+			// the incrementally updated checksums and lengths must be the same as computed ones
+			UdpLayer* responseUdp = response.getLayerOfType<UdpLayer>();
+			uint16_t udpChecksum = responseUdp->getUdpHeader()->headerChecksum;
+			uint16_t udpLength = responseUdp->getUdpHeader()->length;
+			uint16_t ipChecksum = 0;
+			uint16_t ipLength = 0;
+			if (ipVersion == 4)
+			{
+				IPv4Layer* responseIp = response.getLayerOfType<IPv4Layer>();
+				PTF_ASSERT_EQUAL(responseIp->getSrcIpAddress(), IPv4Address(std::string("192.168.1.1")), object);
+				PTF_ASSERT_EQUAL(responseIp->getIPv4Header()->timeToLive, 64, u8);
+				ipChecksum = responseIp->getIPv4Header()->headerChecksum;
+				ipLength = responseIp->getIPv4Header()->totalLength;
+			}
+			else
+			{
+				IPv6Layer* responseIp = response.getLayerOfType<IPv6Layer>();
+				PTF_ASSERT_EQUAL(responseIp->getSrcIpAddress(), IPv6Address(std::string("fe80::1")), object);
+				ipLength = responseIp->getIPv6Header()->payloadLength;
+			}
+			response.computeCalculateFields();
+			PTF_ASSERT_EQUAL(responseUdp->getUdpHeader()->headerChecksum, udpChecksum, u16);
+			PTF_ASSERT_EQUAL(responseUdp->getUdpHeader()->length, udpLength, u16);
+			if (ipVersion == 4)
+			{
+				PTF_ASSERT_EQUAL(response.getLayerOfType<IPv4Layer>()->getIPv4Header()->headerChecksum, ipChecksum, u16);
+				PTF_ASSERT_EQUAL(response.getLayerOfType<IPv4Layer>()->getIPv4Header()->totalLength, ipLength, u16);
+			}
+			else
+				PTF_ASSERT_EQUAL(response.getLayerOfType<IPv6Layer>()->getIPv6Header()->payloadLength, ipLength, u16);
+
+			// a response isn't a query
+			PTF_ASSERT_EQUAL(responder.processPacket(buffer, dataLen, sizeof(buffer)), DnsResponder::Ignored, enum);
+		}
+	}
+
+	DnsResponderStats stats;
+	responder.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.queries, 16, int);
+	PTF_ASSERT_EQUAL((int)stats.responses, 6, int);
+	PTF_ASSERT_EQUAL((int)stats.noMatch, 4, int);
+	PTF_ASSERT_EQUAL((int)stats.noRoom, 6, int);
+	PTF_ASSERT_EQUAL((int)stats.ignored, 6, int);
+	PTF_ASSERT_EQUAL((int)responder.getRecordHits(0), 2, int);
+	PTF_ASSERT_EQUAL((int)responder.getRecordHits(2), 2, int);
+
+	// a default answer, and responding in a raw packet which grows
+	PTF_ASSERT_TRUE(responder.addRecord("*", IPv4Address(std::string("10.0.0.9")), 5));
+	int bufferLength = 0;
+	uint8_t* dnsResponse = readFileIntoBuffer("PacketExamples/Dns1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(dnsResponse);
+	RawPacket rawDnsResponse((const uint8_t*)dnsResponse, bufferLength, time, true);
+	PTF_ASSERT_EQUAL(responder.processPacket(rawDnsResponse, 1500), DnsResponder::Ignored, enum);
+
+	Packet query(100);
+	EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"), PCPP_ETHERTYPE_IP);
+	IPv4Layer ip4Layer(IPv4Address(std::string("192.168.1.10")), IPv4Address(std::string("192.168.1.1")));
+	UdpLayer udpLayer(40000, 53);
+	DnsLayer dnsLayer;
+	dnsLayer.addQuery("anything.org", DNS_TYPE_A, DNS_CLASS_IN);
+	query.addLayer(&ethLayer);
+	query.addLayer(&ip4Layer);
+	query.addLayer(&udpLayer);
+	query.addLayer(&dnsLayer);
+	query.computeCalculateFields();
+	size_t queryLen = query.getRawPacket()->getRawDataLen();
+	uint8_t* rawData = new uint8_t[queryLen + DnsResponder::MaxResponseGrowth];
+	memcpy(rawData, query.getRawPacket()->getRawData(), queryLen);
+	RawPacket rawQuery(rawData, (int)queryLen, time, true);
+	PTF_ASSERT_EQUAL(responder.processPacket(rawQuery, queryLen + DnsResponder::MaxResponseGrowth), DnsResponder::Responded, enum);
+	PTF_ASSERT_EQUAL(rawQuery.getRawDataLen(), (int)queryLen + 16, int);
+	Packet response(&rawQuery);
+	PTF_ASSERT_EQUAL(response.getLayerOfType<DnsLayer>()->getFirstAnswer()->getData()->toString(), "10.0.0.9", string);
+	PTF_ASSERT_EQUAL((int)responder.getRecordHits(3), 1, int);
+
+	responder.clearStats();
+	responder.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.queries, 0, int);
+	PTF_ASSERT_EQUAL((int)responder.getRecordHits(0), 0, int);
+	responder.clearRecords();
+	PTF_ASSERT_EQUAL(responder.getRecordCount(), 0, size);
+} // DnsResponderTest
+
+
 PTF_TEST_CASE(MplsLayerTest)
 {
 	int buffer1Length = 0;
@@ -5012,6 +5435,148 @@ PTF_TEST_CASE(SSLNewSessionTicketParseTest)
 
 }
 
+PTF_TEST_CASE(SSLCipherSuiteLookupTest)
+{
+	// one cipher-suite from each ID range
+	uint16_t ids[] = { 0x002F, 0x0035, 0xC02F, 0xCCA8 };
+	const char* names[] = { "TLS_RSA_WITH_AES_128_CBC_SHA", "TLS_RSA_WITH_AES_256_CBC_SHA", "TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256", "TLS_ECDHE_RSA_WITH_CHACHA20_POLY1305_SHA256" };
+	for (int i = 0; i < 4; i++)
+	{
+		SSLCipherSuite* cipherSuite = SSLCipherSuite::getCipherSuiteByID(ids[i]);
+		PTF_ASSERT_NOT_NULL(cipherSuite);
+		PTF_ASSERT_EQUAL(cipherSuite->getID(), ids[i], u16);
+		PTF_ASSERT_EQUAL(cipherSuite->asString(), std::string(names[i]), object);
+		PTF_ASSERT_TRUE(SSLCipherSuite::getCipherSuiteByName(names[i]) == cipherSuite);
+	}
+
+	PTF_ASSERT_EQUAL(SSLCipherSuite::getCipherSuiteByID(0xCCA8)->getKeyExchangeAlg(), SSL_KEYX_ECDHE, enum);
+	PTF_ASSERT_EQUAL(SSLCipherSuite::getCipherSuiteByID(0xCCA8)->getSymKeyAlg(), SSL_SYM_CHACHA20_POLY1305, enum);
+
+	// unknown IDs inside and outside the ID ranges, and unknown names
+	PTF_ASSERT_NULL(SSLCipherSuite::getCipherSuiteByID(0x00FE));
+	PTF_ASSERT_NULL(SSLCipherSuite::getCipherSuiteByID(0xC0FF));
+	PTF_ASSERT_NULL(SSLCipherSuite::getCipherSuiteByID(0x1301));
+	PTF_ASSERT_NULL(SSLCipherSuite::getCipherSuiteByID(0xFFFF));
+	PTF_ASSERT_NULL(SSLCipherSuite::getCipherSuiteByName("TLS_RSA_WITH_AES_128_CBC_SHA1"));
+	PTF_ASSERT_NULL(SSLCipherSuite::getCipherSuiteByName(""));
+} // SSLCipherSuiteLookupTest
+
+
+
+PTF_TEST_CASE(SSLFingerprintTest)
+{
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/SSL-ClientHello1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+
+	timeval time;
+	gettimeofday(&time, NULL);
+	RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet clientHelloPacket(&rawPacket);
+
+	SSLHandshakeLayer* handshakeLayer = clientHelloPacket.getLayerOfType<SSLHandshakeLayer>();
+	PTF_ASSERT_NOT_NULL(handshakeLayer);
+
+	// the message iterator doesn't create the message objects
+	SSLHandshakeMessageIterator msgIter = handshakeLayer->getMessageIterator();
+	PTF_ASSERT_TRUE(msgIter.isValid());
+	PTF_ASSERT_EQUAL(msgIter.getType(), SSL_CLIENT_HELLO, enum);
+	PTF_ASSERT_TRUE(msgIter.isComplete());
+	PTF_ASSERT_EQUAL(msgIter.getLength(), 183, size);
+	msgIter.next();
+	PTF_ASSERT_FALSE(msgIter.isValid());
+
+	// JA3 fields read straight from the TCP payload
+	TcpLayer* tcpLayer = clientHelloPacket.getLayerOfType<TcpLayer>();
+	SSLClientHelloFingerprint clientFingerprint;
+	PTF_ASSERT_TRUE(clientFingerprint.parseRecord(tcpLayer->getLayerPayload(), tcpLayer->getLayerPayloadSize()));
+	PTF_ASSERT_EQUAL(clientFingerprint.getVersion(), 0x0303, u16);
+	PTF_ASSERT_EQUAL(clientFingerprint.getCipherSuiteCount(), 11, size);
+	PTF_ASSERT_EQUAL(clientFingerprint.getCipherSuiteID(0), 0xc02b, u16);
+	PTF_ASSERT_EQUAL(clientFingerprint.getSupportedGroupCount(), 3, size);
+	PTF_ASSERT_EQUAL(clientFingerprint.getECPointFormatCount(), 1, size);
+	PTF_ASSERT_EQUAL(std::string(clientFingerprint.getServerName(), clientFingerprint.getServerNameLength()), "www.google.com", string);
+	std::string ja3;
+	clientFingerprint.toJA3String(ja3);
+	PTF_ASSERT_EQUAL(ja3, "771,49195-49199-49162-49161-49171-49172-51-57-47-53-10,0-65281-10-11-35-13172-16-5-13,23-24-25,0", string);
+
+	// the extension iterator sees the same extensions as the extension objects, which are created only now
+	SSLClientHelloMessage* clientHelloMessage = handshakeLayer->getHandshakeMessageOfType<SSLClientHelloMessage>();
+	PTF_ASSERT_NOT_NULL(clientHelloMessage);
+	int extIndex = 0;
+	for (SSLExtensionIterator extIter = clientHelloMessage->getExtensionIterator(); extIter.isValid(); extIter.next(), extIndex++)
+	{
+		SSLExtension* ext = clientHelloMessage->getExtension(extIndex);
+		PTF_ASSERT_NOT_NULL(ext);
+		PTF_ASSERT_EQUAL(extIter.getTypeAsInt(), ext->getTypeAsInt(), u16);
+		PTF_ASSERT_EQUAL(extIter.getLength(), ext->getLength(), u16);
+		PTF_ASSERT_TRUE(extIter.getData() == ext->getData());
+	}
+	PTF_ASSERT_EQUAL(extIndex, clientHelloMessage->getExtensionCount(), int);
+
+	SSLExtensionIterator sniIter = clientHelloMessage->getExtensionIterator();
+	PTF_ASSERT_TRUE(sniIter.findType(SSL_EXT_SERVER_NAME));
+	PTF_ASSERT_EQUAL(sniIter.getType(), SSL_EXT_SERVER_NAME, enum);
+	PTF_ASSERT_FALSE(sniIter.findType(SSL_EXT_HEARTBEAT));
+
+	// a truncated message isn't fingerprinted
+	PTF_ASSERT_FALSE(clientFingerprint.parse(msgIter.getData(), 50));
+	PTF_ASSERT_EQUAL(clientFingerprint.getCipherSuiteCount(), 0, size);
+
+	// JA3S of a server-hello
+	int buffer2Length = 0;
+	uint8_t* buffer2 = readFileIntoBuffer("PacketExamples/SSL-MultipleRecords1.dat", buffer2Length);
+	PTF_ASSERT_NOT_NULL(buffer2);
+	RawPacket rawPacket2((const uint8_t*)buffer2, buffer2Length, time, true);
+	Packet serverHelloPacket(&rawPacket2);
+
+	tcpLayer = serverHelloPacket.getLayerOfType<TcpLayer>();
+	SSLServerHelloFingerprint serverFingerprint;
+	PTF_ASSERT_FALSE(clientFingerprint.parseRecord(tcpLayer->getLayerPayload(), tcpLayer->getLayerPayloadSize()));
+	PTF_ASSERT_TRUE(serverFingerprint.parseRecord(tcpLayer->getLayerPayload(), tcpLayer->getLayerPayloadSize()));
+	PTF_ASSERT_EQUAL(serverFingerprint.getCipherSuiteID(), 0xc02b, u16);
+	std::string ja3s;
+	serverFingerprint.toJA3SString(ja3s);
+	PTF_ASSERT_EQUAL(ja3s, "771,49195,65281-16-11", string);
+
+	// the third handshake layer has 2 hello-request messages and an encrypted one which spans the rest of the layer
+	handshakeLayer = serverHelloPacket.getLayerOfType<SSLHandshakeLayer>();
+	handshakeLayer = serverHelloPacket.getNextLayerOfType<SSLHandshakeLayer>(handshakeLayer);
+	PTF_ASSERT_NOT_NULL(handshakeLayer);
+	SSLHandshakeType expectedTypes[3] = { SSL_HELLO_REQUEST, SSL_HELLO_REQUEST, SSL_HANDSHAKE_UNKNOWN };
+	size_t expectedLengths[3] = { 4, 4, 32 };
+	int msgIndex = 0;
+	for (msgIter = handshakeLayer->getMessageIterator(); msgIter.isValid(); msgIter.next(), msgIndex++)
+	{
+		PTF_ASSERT_TRUE(msgIndex < 3);
+		// the iterator returns the raw type byte, the message object maps unknown types to SSL_HANDSHAKE_UNKNOWN
+		PTF_ASSERT_EQUAL(handshakeLayer->getHandshakeMessageAt(msgIndex)->getHandshakeType(), expectedTypes[msgIndex], enum);
+		PTF_ASSERT_TRUE(handshakeLayer->getHandshakeMessageAt(msgIndex)->getMessageLength() == msgIter.getLength());
+		PTF_ASSERT_EQUAL(msgIter.getLength(), expectedLengths[msgIndex], size);
+	}
+	PTF_ASSERT_EQUAL(msgIndex, 3, int);
+	PTF_ASSERT_EQUAL(handshakeLayer->getHandshakeMessagesCount(), 3, size);
+
+	// GREASE values are left out of the JA3 string
+	uint8_t greaseClientHello[] = {
+		0x16, 0x03, 0x01, 0x00, 0x47,
+		0x01, 0x00, 0x00, 0x43, 0x03, 0x03,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0x00,
+		0x00, 0x06, 0x0a, 0x0a, 0x13, 0x01, 0x13, 0x02,
+		0x01, 0x00,
+		0x00, 0x14,
+		0x1a, 0x1a, 0x00, 0x00,
+		0x00, 0x0a, 0x00, 0x06, 0x00, 0x04, 0x2a, 0x2a, 0x00, 0x1d,
+		0x00, 0x0b, 0x00, 0x02, 0x01, 0x00 };
+	PTF_ASSERT_TRUE(clientFingerprint.parseRecord(greaseClientHello, sizeof(greaseClientHello)));
+	PTF_ASSERT_NULL(clientFingerprint.getServerName());
+	clientFingerprint.toJA3String(ja3);
+	PTF_ASSERT_EQUAL(ja3, "771,4865-4866,10-11,29,0", string);
+} // SSLFingerprintTest
+
+
+
 PTF_TEST_CASE(SllPacketParsingTest)
 {
 	int buffer1Length = 0;
@@ -5363,6 +5928,92 @@ PTF_TEST_CASE(DhcpEditTest)
 
 }
 
+PTF_TEST_CASE(TLVRecordIndexTest)
+{
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/Dhcp4.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+
+	timeval time;
+	gettimeofday(&time, NULL);
+	RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true);
+
+	Packet dhcpPacket(&rawPacket);
+	DhcpLayer* dhcpLayer = dhcpPacket.getLayerOfType<DhcpLayer>();
+	PTF_ASSERT_NOT_NULL(dhcpLayer);
+
+	// the indexed lookup finds the same (first) record of each type as a linear scan
+	size_t numOfOptions = 0;
+	for (DhcpOption opt = dhcpLayer->getFirstOptionData(); !opt.isNull(); opt = dhcpLayer->getNextOptionData(opt))
+	{
+		DhcpOption firstOfType = dhcpLayer->getFirstOptionData();
+		while (firstOfType.getType() != opt.getType())
+			firstOfType = dhcpLayer->getNextOptionData(firstOfType);
+
+		PTF_ASSERT_TRUE(dhcpLayer->getOptionData((DhcpOptionTypes)opt.getType()).getRecordBasePtr() == firstOfType.getRecordBasePtr());
+		numOfOptions++;
+	}
+	PTF_ASSERT_EQUAL(dhcpLayer->getOptionsCount(), numOfOptions, size);
+	PTF_ASSERT_TRUE(dhcpLayer->getOptionData(DHCPOPT_IRC_SERVER).isNull());
+
+	// the index is rebuilt after options are removed and added
+	PTF_ASSERT_FALSE(dhcpLayer->getOptionData(DHCPOPT_TFTP_SERVER_NAME).isNull());
+	PTF_ASSERT_TRUE(dhcpLayer->removeOption(DHCPOPT_TFTP_SERVER_NAME));
+	PTF_ASSERT_TRUE(dhcpLayer->getOptionData(DHCPOPT_TFTP_SERVER_NAME).isNull());
+	PTF_ASSERT_EQUAL(dhcpLayer->getOptionsCount(), numOfOptions - 1, size);
+
+	IPv4Address router(std::string("192.168.2.1"));
+	DhcpOption newOpt = dhcpLayer->addOptionAfter(DhcpOptionBuilder(DHCPOPT_ROUTERS, router), DHCPOPT_SUBNET_MASK);
+	PTF_ASSERT_FALSE(newOpt.isNull());
+	PTF_ASSERT_TRUE(dhcpLayer->getOptionData(DHCPOPT_ROUTERS).getRecordBasePtr() == newOpt.getRecordBasePtr());
+	PTF_ASSERT_TRUE(dhcpLayer->getOptionData(DHCPOPT_ROUTERS).getValueAsIpAddr() == router);
+	PTF_ASSERT_EQUAL(dhcpLayer->getOptionsCount(), numOfOptions, size);
+
+	// records beyond the index are still found and counted
+	const size_t numOfRecords = TLVRecordReader<DhcpOption>::MaxIndexedRecords + 8;
+	uint8_t records[numOfRecords * 3];
+	for (size_t i = 0; i < numOfRecords; i++)
+	{
+		records[i * 3] = (uint8_t)(i + 1);
+		records[i * 3 + 1] = 1;
+		records[i * 3 + 2] = (uint8_t)i;
+	}
+
+	TLVRecordReader<DhcpOption> reader;
+	DhcpOption lastRecord = reader.getTLVRecord((uint8_t)numOfRecords, records, sizeof(records));
+	PTF_ASSERT_TRUE(lastRecord.getRecordBasePtr() == records + (numOfRecords - 1) * 3);
+	PTF_ASSERT_TRUE(reader.getTLVRecord(1, records, sizeof(records)).getRecordBasePtr() == records);
+	PTF_ASSERT_TRUE(reader.getTLVRecord(0xfe, records, sizeof(records)).isNull());
+	PTF_ASSERT_EQUAL(reader.getTLVRecordCount(records, sizeof(records)), numOfRecords, size);
+
+	// the index of a copied reader stays valid since it keeps offsets
+	TLVRecordReader<DhcpOption> readerCopy(reader);
+	PTF_ASSERT_TRUE(readerCopy.getTLVRecord(5, records, sizeof(records)).getRecordBasePtr() == records + 4 * 3);
+
+	// building into a buffer gives the same record as building a new one
+	DhcpOptionBuilder builder(DHCPOPT_ROUTERS, router);
+	PTF_ASSERT_EQUAL(builder.getRecordSize(), 6, size);
+	uint8_t recordBuffer[6];
+	DhcpOption inPlace = builder.build(recordBuffer);
+	DhcpOption allocated = builder.build();
+	PTF_ASSERT_TRUE(inPlace.getRecordBasePtr() == recordBuffer);
+	PTF_ASSERT_EQUAL(memcmp(recordBuffer, allocated.getRecordBasePtr(), 6), 0, int);
+	allocated.purgeRecordData();
+
+	PTF_ASSERT_EQUAL(DhcpOptionBuilder(DHCPOPT_END, NULL, 0).getRecordSize(), 1, size);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(DhcpOptionBuilder(DHCPOPT_END, recordBuffer, 2).getRecordSize(), 0, size);
+	PTF_ASSERT_TRUE(DhcpOptionBuilder(DHCPOPT_END, recordBuffer, 2).build(recordBuffer).isNull());
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT_EQUAL(TcpOptionBuilder(TcpOptionBuilder::NOP).getRecordSize(), 1, size);
+	IPv4OptionBuilder ipv4Builder(IPV4OPT_RouterAlert, (uint16_t)0);
+	PTF_ASSERT_EQUAL(ipv4Builder.getRecordSize(), 4, size);
+	uint8_t ipv4Buffer[4];
+	PTF_ASSERT_EQUAL(ipv4Builder.build(ipv4Buffer).getTotalSize(), 4, size);
+	PTF_ASSERT_EQUAL(ipv4Buffer[1], 4, u8);
+}
+
 PTF_TEST_CASE(NullLoopbackTest)
 {
 	int buffer1Length = 0;
@@ -6669,6 +7320,494 @@ PTF_TEST_CASE(SdpLayerEditTest)
 }
 
 
+PTF_TEST_CASE(TextBasedProtocolFieldLookupTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/sip_req1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+
+	RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet sipPacket(&rawPacket);
+
+	SipRequestLayer* sipLayer = sipPacket.getLayerOfType<SipRequestLayer>();
+	PTF_ASSERT_NOT_NULL(sipLayer);
+
+	// lookups are case insensitive and fields with the same name are counted in packet order
+	HeaderField* firstVia = sipLayer->getFieldByName(PCPP_SIP_VIA_FIELD);
+	HeaderField* secondVia = sipLayer->getFieldByName(PCPP_SIP_VIA_FIELD, 1);
+	PTF_ASSERT_NOT_NULL(firstVia);
+	PTF_ASSERT_NOT_NULL(secondVia);
+	PTF_ASSERT_TRUE(firstVia == sipLayer->getFirstField());
+	PTF_ASSERT_TRUE(sipLayer->getFieldByName("VIA") == firstVia);
+	PTF_ASSERT_TRUE(sipLayer->getFieldByName("vIa", 1) == secondVia);
+	PTF_ASSERT_NULL(sipLayer->getFieldByName("via", 2));
+	PTF_ASSERT_TRUE(sipLayer->getFieldByName("call-id") == sipLayer->getFieldByName(PCPP_SIP_CALL_ID_FIELD));
+	PTF_ASSERT_NULL(sipLayer->getFieldByName("Vi"));
+	PTF_ASSERT_NULL(sipLayer->getFieldByName("Viaa"));
+	PTF_ASSERT_NULL(sipLayer->getFieldByName("Call_ID"));
+
+	// a copied layer has its own fields
+	SipRequestLayer sipLayerCopy(*sipLayer);
+	PTF_ASSERT_EQUAL(sipLayerCopy.getFieldCount(), sipLayer->getFieldCount(), int);
+	PTF_ASSERT_NOT_NULL(sipLayerCopy.getFieldByName("via", 1));
+	PTF_ASSERT_TRUE(sipLayerCopy.getFieldByName("via", 1) != secondVia);
+	PTF_ASSERT_TRUE(sipLayerCopy.getFieldByName("via", 1)->getFieldValue() == secondVia->getFieldValue());
+
+	// removing and adding fields keeps the lookups in sync
+	std::string secondViaValue = secondVia->getFieldValue();
+	PTF_ASSERT_TRUE(sipLayer->removeField("VIA"));
+	PTF_ASSERT_TRUE(sipLayer->getFieldByName(PCPP_SIP_VIA_FIELD) == secondVia);
+	PTF_ASSERT_TRUE(sipLayer->getFieldByName(PCPP_SIP_VIA_FIELD)->getFieldValue() == secondViaValue);
+	PTF_ASSERT_NULL(sipLayer->getFieldByName(PCPP_SIP_VIA_FIELD, 1));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(sipLayer->removeField("via", 1));
+	LoggerPP::getInstance().enableErrors();
+
+	HeaderField* newField = sipLayer->insertField(sipLayer->getFieldByName(PCPP_SIP_CALL_ID_FIELD), "X-Test-Field", "1");
+	PTF_ASSERT_NOT_NULL(newField);
+	PTF_ASSERT_TRUE(sipLayer->getFieldByName("x-test-field") == newField);
+	PTF_ASSERT_TRUE(sipLayer->removeField(newField));
+	PTF_ASSERT_NULL(sipLayer->getFieldByName("X-TEST-FIELD"));
+	PTF_ASSERT_TRUE(sipLayer->getFieldByName(PCPP_SIP_CALL_ID_FIELD)->getFieldValue() == "12013223@200.57.7.195");
+}
+
+
+struct SipDialogEndStats
+{
+	int numOfEndedDialogs;
+	std::string lastCallId;
+	SipDialogState lastState;
+
+	SipDialogEndStats() : numOfEndedDialogs(0), lastState(SipDialogEarly) {}
+};
+
+static void onSipDialogEnd(const SipDialog& dialog, void* userCookie)
+{
+	SipDialogEndStats* stats = (SipDialogEndStats*)userCookie;
+	stats->numOfEndedDialogs++;
+	stats->lastCallId = dialog.callId;
+	stats->lastState = dialog.state;
+}
+
+static void setSipMediaView(PacketView& view, const char* srcIP, uint16_t srcPort, const char* dstIP, uint16_t dstPort)
+{
+	memset(&view, 0, sizeof(view));
+	view.protocolTypes = IPv4 | UDP;
+	view.ipVersion = 4;
+	view.ipProtocol = PACKETPP_IPPROTO_UDP;
+	uint32_t srcAddr = IPv4Address(srcIP).toInt();
+	uint32_t dstAddr = IPv4Address(dstIP).toInt();
+	memcpy(view.srcIP, &srcAddr, sizeof(srcAddr));
+	memcpy(view.dstIP, &dstAddr, sizeof(dstAddr));
+	view.srcPort = srcPort;
+	view.dstPort = dstPort;
+}
+
+PTF_TEST_CASE(SipDialogTrackerTest)
+{
+	timeval time;
+	time.tv_sec = 1000000;
+	time.tv_usec = 0;
+
+	const char* fileNames[] = { "sip_req1.dat", "sip_resp1.dat", "sip_resp2.dat", "sip_resp3.dat", "sip_resp4.dat", "sip_req2.dat", "sip_req1.dat", "sip_req1.dat" };
+	RawPacket* rawPackets[8];
+	for (int i = 0; i < 8; i++)
+	{
+		int bufferLength = 0;
+		uint8_t* buffer = readFileIntoBuffer((std::string("PacketExamples/") + fileNames[i]).c_str(), bufferLength);
+		PTF_ASSERT_NOT_NULL(buffer);
+		rawPackets[i] = new RawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	}
+
+	Packet invite(rawPackets[0]);
+	Packet trying(rawPackets[1]);
+	Packet ringing(rawPackets[2]);
+	Packet ok(rawPackets[3]);
+	Packet registerResponse(rawPackets[4]);
+	Packet cancelOfOtherCall(rawPackets[5]);
+
+	// a BYE of the call and an INVITE of another call, made of copies of the INVITE
+	Packet bye(rawPackets[6]);
+	SipRequestLayer* byeLayer = bye.getLayerOfType<SipRequestLayer>();
+	PTF_ASSERT_NOT_NULL(byeLayer);
+	PTF_ASSERT_TRUE(byeLayer->getFirstLine()->setMethod(SipRequestLayer::SipBYE));
+	PTF_ASSERT_TRUE(byeLayer->getFieldByName(PCPP_SIP_CSEQ_FIELD)->setFieldValue("2 BYE"));
+	Packet otherInvite(rawPackets[7]);
+	PTF_ASSERT_TRUE(otherInvite.getLayerOfType<SipRequestLayer>()->getFieldByName(PCPP_SIP_CALL_ID_FIELD)->setFieldValue("other-call@200.57.7.195"));
+
+	SipDialogEndStats stats;
+	SipDialogTracker tracker(onSipDialogEnd, &stats);
+
+	// messages of dialogs which weren't created by an INVITE aren't tracked
+	PTF_ASSERT_NULL(tracker.processPacket(trying));
+	PTF_ASSERT_NULL(tracker.processPacket(registerResponse));
+	PTF_ASSERT_NULL(tracker.processPacket(cancelOfOtherCall));
+	PTF_ASSERT_EQUAL(tracker.getNumOfDialogs(), 0, size);
+
+	SipDialog* dialog = tracker.processPacket(invite);
+	PTF_ASSERT_NOT_NULL(dialog);
+	PTF_ASSERT_EQUAL(std::string(dialog->callId), "12013223@200.57.7.195", string);
+	PTF_ASSERT_EQUAL(std::string(dialog->fromTag), "GR52RWG346-34", string);
+	PTF_ASSERT_EQUAL(std::string(dialog->toTag), "", string);
+	PTF_ASSERT_EQUAL(dialog->state, SipDialogEarly, enum);
+	PTF_ASSERT_EQUAL(dialog->lastCSeq, 1, u32);
+	PTF_ASSERT_EQUAL(dialog->lastCSeqMethod, SipRequestLayer::SipINVITE, enum);
+	PTF_ASSERT_EQUAL(dialog->startTime, 1000000, int);
+	PTF_ASSERT_EQUAL(dialog->numOfMediaEndpoints, 1, size);
+	PTF_ASSERT_EQUAL(dialog->mediaEndpoints[0].ipVersion, 4, u8);
+	PTF_ASSERT_EQUAL(dialog->mediaEndpoints[0].port, 40376, u16);
+	PTF_ASSERT_EQUAL(IPv4Address(*(uint32_t*)dialog->mediaEndpoints[0].ipAddress).toString(), "200.57.7.196", string);
+
+	PTF_ASSERT_TRUE(tracker.processPacket(trying) == dialog);
+	PTF_ASSERT_TRUE(tracker.processPacket(ringing) == dialog);
+	PTF_ASSERT_EQUAL(std::string(dialog->toTag), "298852044", string);
+	PTF_ASSERT_EQUAL(dialog->state, SipDialogEarly, enum);
+
+	// the 200 OK confirms the dialog and announces the media endpoint of the other party
+	time.tv_sec = 1000001;
+	rawPackets[3]->setPacketTimeStamp(time);
+	PTF_ASSERT_TRUE(tracker.processPacket(ok) == dialog);
+	PTF_ASSERT_EQUAL(dialog->state, SipDialogConfirmed, enum);
+	PTF_ASSERT_EQUAL(dialog->numOfSipMessages, 4, u32);
+	PTF_ASSERT_EQUAL(dialog->lastActivityTime, 1000001, int);
+	PTF_ASSERT_EQUAL(dialog->numOfMediaEndpoints, 2, size);
+	PTF_ASSERT_EQUAL(dialog->mediaEndpoints[1].port, 8000, u16);
+	PTF_ASSERT_EQUAL(tracker.getNumOfMediaEndpoints(), 2, size);
+	PTF_ASSERT_TRUE(tracker.findDialog("12013223@200.57.7.195", 21) == dialog);
+	PTF_ASSERT_NULL(tracker.findDialog("12013223@200.57.7.19", 20));
+
+	// media packets are classified by their destination, then by their source, and RTCP by the port following the RTP port
+	PacketView view;
+	setSipMediaView(view, "10.0.0.1", 5000, "200.57.7.204", 8000);
+	PTF_ASSERT_TRUE(tracker.classifyMediaPacket(view, 1000010) == dialog);
+	setSipMediaView(view, "10.0.0.1", 5001, "200.57.7.204", 8001);
+	PTF_ASSERT_TRUE(tracker.classifyMediaPacket(view, 1000010) == dialog);
+	setSipMediaView(view, "200.57.7.196", 40376, "10.0.0.1", 5000);
+	PTF_ASSERT_TRUE(tracker.classifyMediaPacket(view, 1000010) == dialog);
+	setSipMediaView(view, "10.0.0.1", 5000, "200.57.7.204", 8002);
+	PTF_ASSERT_NULL(tracker.classifyMediaPacket(view, 1000010));
+	setSipMediaView(view, "10.0.0.1", 5000, "200.57.7.196", 8000);
+	PTF_ASSERT_NULL(tracker.classifyMediaPacket(view, 1000010));
+	view.protocolTypes = IPv4 | TCP;
+	view.dstIP[3] = 204;
+	PTF_ASSERT_NULL(tracker.classifyMediaPacket(view, 1000010));
+	PTF_ASSERT_EQUAL((int)dialog->numOfMediaPackets, 3, int);
+	PTF_ASSERT_EQUAL(dialog->lastActivityTime, 1000010, int);
+
+	// the BYE ends the dialog, which is kept for the terminated dialog timeout
+	time.tv_sec = 1000020;
+	rawPackets[6]->setPacketTimeStamp(time);
+	PTF_ASSERT_TRUE(tracker.processPacket(bye) == dialog);
+	PTF_ASSERT_EQUAL(dialog->state, SipDialogTerminated, enum);
+	PTF_ASSERT_EQUAL(dialog->lastCSeq, 2, u32);
+	PTF_ASSERT_EQUAL(dialog->lastCSeqMethod, SipRequestLayer::SipBYE, enum);
+	tracker.setCurrentTime(1000051);
+	PTF_ASSERT_EQUAL(tracker.getNumOfDialogs(), 1, size);
+	PTF_ASSERT_EQUAL(stats.numOfEndedDialogs, 0, int);
+	tracker.setCurrentTime(1000052);
+	PTF_ASSERT_EQUAL(tracker.getNumOfDialogs(), 0, size);
+	PTF_ASSERT_EQUAL(tracker.getNumOfMediaEndpoints(), 0, size);
+	PTF_ASSERT_EQUAL(stats.numOfEndedDialogs, 1, int);
+	PTF_ASSERT_EQUAL(stats.lastCallId, "12013223@200.57.7.195", string);
+	PTF_ASSERT_EQUAL(stats.lastState, SipDialogTerminated, enum);
+	setSipMediaView(view, "10.0.0.1", 5000, "200.57.7.204", 8000);
+	PTF_ASSERT_NULL(tracker.classifyMediaPacket(view, 1000052));
+
+	// an active dialog times out when it has neither SIP messages nor media, and the maximum number of dialogs is kept
+	SipDialogTracker limitedTracker(onSipDialogEnd, &stats, SipDialogTrackerConfiguration(1, 10, 5));
+	time.tv_sec = 1000100;
+	rawPackets[0]->setPacketTimeStamp(time);
+	rawPackets[7]->setPacketTimeStamp(time);
+	dialog = limitedTracker.processPacket(invite);
+	PTF_ASSERT_NOT_NULL(dialog);
+	PTF_ASSERT_NULL(limitedTracker.processPacket(otherInvite));
+	PTF_ASSERT_EQUAL((int)limitedTracker.getNumOfRejectedDialogs(), 1, int);
+	setSipMediaView(view, "200.57.7.204", 8000, "200.57.7.196", 40376);
+	PTF_ASSERT_TRUE(limitedTracker.classifyMediaPacket(view, 1000108) == dialog);
+	limitedTracker.setCurrentTime(1000117);
+	PTF_ASSERT_EQUAL(limitedTracker.getNumOfDialogs(), 1, size);
+	limitedTracker.setCurrentTime(1000118);
+	PTF_ASSERT_EQUAL(limitedTracker.getNumOfDialogs(), 0, size);
+	PTF_ASSERT_EQUAL(stats.numOfEndedDialogs, 2, int);
+	PTF_ASSERT_EQUAL(stats.lastState, SipDialogEarly, enum);
+
+	// once a dialog is removed a new one can be tracked, and its Call-ID is compared in full
+	dialog = limitedTracker.processPacket(otherInvite);
+	PTF_ASSERT_NOT_NULL(dialog);
+	PTF_ASSERT_EQUAL(std::string(dialog->callId), "other-call@200.57.7.195", string);
+	PTF_ASSERT_NULL(limitedTracker.findDialog("12013223@200.57.7.195", 21));
+	limitedTracker.clear();
+	PTF_ASSERT_EQUAL(limitedTracker.getNumOfDialogs(), 0, size);
+	PTF_ASSERT_EQUAL(limitedTracker.getNumOfMediaEndpoints(), 0, size);
+	PTF_ASSERT_EQUAL(stats.numOfEndedDialogs, 2, int);
+
+	for (int i = 0; i < 8; i++)
+		delete rawPackets[i];
+}
+
+
+struct RtpStreamEndStats
+{
+	std::vector<RtpStreamStats> endedStreams;
+};
+
+static void onRtpStreamEnd(const RtpStreamStats& stream, void* userCookie)
+{
+	((RtpStreamEndStats*)userCookie)->endedStreams.push_back(stream);
+}
+
+static size_t makeRtpPacket(uint8_t* buffer, uint8_t payloadType, uint16_t seq, uint32_t timestamp, uint32_t ssrc)
+{
+	memset(buffer, 0, 172);
+	buffer[0] = 0x80;
+	buffer[1] = payloadType;
+	buffer[2] = (uint8_t)(seq >> 8);
+	buffer[3] = (uint8_t)seq;
+	uint32_t timestampBE = htonl(timestamp);
+	uint32_t ssrcBE = htonl(ssrc);
+	memcpy(buffer + 4, &timestampBE, 4);
+	memcpy(buffer + 8, &ssrcBE, 4);
+	return 172;
+}
+
+// send an RTP packet of 160 payload bytes whose arrival time is 20ms per sequence number after the base time, plus a delay
+static RtpPacketResult sendRtpPacket(RtpStreamAnalyzer& analyzer, PacketView& view, uint8_t payloadType, uint16_t seq, uint32_t ssrc, long delayMs)
+{
+	uint8_t buffer[172];
+	size_t bufferLen = makeRtpPacket(buffer, payloadType, seq, seq * 160, ssrc);
+	view.payloadOffset = 0;
+	view.payloadLength = (uint16_t)bufferLen;
+	timespec timestamp;
+	timestamp.tv_sec = 1000000 + (seq * 20 + delayMs) / 1000;
+	timestamp.tv_nsec = ((seq * 20 + delayMs) % 1000) * 1000000;
+	return analyzer.processPacket(view, buffer, bufferLen, timestamp);
+}
+
+static const RtpStreamStats* findRtpStream(const std::vector<RtpStreamStats>& streams, uint32_t ssrc)
+{
+	for (size_t i = 0; i < streams.size(); i++)
+	{
+		if (streams[i].ssrc == ssrc)
+			return &streams[i];
+	}
+
+	return NULL;
+}
+
+PTF_TEST_CASE(RtpStreamAnalyzerTest)
+{
+	// an RTP header with a CSRC, a header extension of one word and 4 bytes of padding
+	uint8_t rtpData[] = { 0xb1, 0x88, 0x12, 0x34, 0x00, 0x00, 0x03, 0x20, 0xde, 0xad, 0xbe, 0xef, 0x01, 0x02, 0x03, 0x04,
+			0xbe, 0xde, 0x00, 0x01, 0x10, 0x20, 0x30, 0x40, 0xaa, 0xbb, 0x00, 0x00, 0x00, 0x04 };
+	RtpHeaderView rtp;
+	PTF_ASSERT_TRUE(rtp.parse(rtpData, sizeof(rtpData)));
+	PTF_ASSERT_TRUE(rtp.hasPadding());
+	PTF_ASSERT_TRUE(rtp.hasExtension());
+	PTF_ASSERT_TRUE(rtp.getMarker());
+	PTF_ASSERT_EQUAL(rtp.getCsrcCount(), 1, u8);
+	PTF_ASSERT_EQUAL(rtp.getPayloadType(), 8, u8);
+	PTF_ASSERT_EQUAL(rtp.getSequenceNumber(), 0x1234, u16);
+	PTF_ASSERT_EQUAL(rtp.getTimestamp(), 800, u32);
+	PTF_ASSERT_EQUAL(rtp.getSsrc(), 0xdeadbeef, u32);
+	PTF_ASSERT_EQUAL(rtp.getCsrc(0), 0x01020304, u32);
+	PTF_ASSERT_EQUAL(rtp.getHeaderLength(), 24, size);
+	PTF_ASSERT_EQUAL(rtp.getPayloadLength(), 2, size);
+	PTF_ASSERT_EQUAL(rtp.getPayload()[0], 0xaa, u8);
+
+	// a wrong version, a truncated extension, too much padding and an RTCP packet type aren't RTP
+	PTF_ASSERT_FALSE(rtp.parse(rtpData, 11));
+	PTF_ASSERT_FALSE(rtp.parse(rtpData, 22));
+	rtpData[29] = 20;
+	PTF_ASSERT_FALSE(rtp.parse(rtpData, sizeof(rtpData)));
+	rtpData[0] = 0x40;
+	PTF_ASSERT_FALSE(rtp.parse(rtpData, sizeof(rtpData)));
+	rtpData[0] = 0x80;
+	rtpData[1] = 0xc8;
+	PTF_ASSERT_FALSE(rtp.parse(rtpData, sizeof(rtpData)));
+	PTF_ASSERT_TRUE(RtcpPacketView::isRtcp(rtpData, sizeof(rtpData)));
+
+	// a compound RTCP packet: a sender report of SSRC 0x1234 with a report block on SSRC 0x5678, followed by a source description
+	uint8_t rtcpData[] = { 0x81, 0xc8, 0x00, 0x0c, 0x00, 0x00, 0x12, 0x34, 0x00, 0x00, 0x00, 0x01, 0x80, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x03, 0x20, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x05, 0xa0,
+			0x00, 0x00, 0x56, 0x78, 0x40, 0x00, 0x00, 0x02, 0x00, 0x01, 0x00, 0x10, 0x00, 0x00, 0x00, 0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x81, 0xca, 0x00, 0x02, 0x00, 0x00, 0x12, 0x34, 0x00, 0x00, 0x00, 0x00 };
+	RtcpPacketView rtcp;
+	PTF_ASSERT_TRUE(rtcp.parse(rtcpData, sizeof(rtcpData)));
+	PTF_ASSERT_EQUAL(rtcp.getPacketType(), RtcpSenderReport, u8);
+	PTF_ASSERT_EQUAL(rtcp.getCount(), 1, u8);
+	PTF_ASSERT_EQUAL(rtcp.getPacketLength(), 52, size);
+	PTF_ASSERT_EQUAL(rtcp.getSsrc(), 0x1234, u32);
+	RtcpSenderInfo senderInfo;
+	PTF_ASSERT_TRUE(rtcp.getSenderInfo(senderInfo));
+	PTF_ASSERT_TRUE(senderInfo.ntpTimestamp == 0x180000000ULL);
+	PTF_ASSERT_EQUAL(senderInfo.rtpTimestamp, 800, u32);
+	PTF_ASSERT_EQUAL(senderInfo.packetCount, 9, u32);
+	PTF_ASSERT_EQUAL(senderInfo.octetCount, 1440, u32);
+	PTF_ASSERT_EQUAL(rtcp.getNumOfReportBlocks(), 1, size);
+	RtcpReportBlock block;
+	PTF_ASSERT_TRUE(rtcp.getReportBlock(0, block));
+	PTF_ASSERT_FALSE(rtcp.getReportBlock(1, block));
+	PTF_ASSERT_EQUAL(block.ssrc, 0x5678, u32);
+	PTF_ASSERT_EQUAL(block.fractionLost, 64, u8);
+	PTF_ASSERT_EQUAL(block.cumulativeLost, 2, int);
+	PTF_ASSERT_EQUAL(block.extendedHighestSequence, 0x10010, u32);
+	PTF_ASSERT_EQUAL(block.jitter, 80, u32);
+	PTF_ASSERT_TRUE(rtcp.next());
+	PTF_ASSERT_EQUAL(rtcp.getPacketType(), RtcpSourceDescription, u8);
+	PTF_ASSERT_EQUAL(rtcp.getNumOfReportBlocks(), 0, size);
+	PTF_ASSERT_FALSE(rtcp.getSenderInfo(senderInfo));
+	PTF_ASSERT_FALSE(rtcp.next());
+	PTF_ASSERT_FALSE(rtcp.parse(rtcpData, 51));
+
+	// the media endpoint is registered from the SDP of the 200 OK, which announces 200.57.7.204:8000 with PCMA, PCMU and others
+	timeval time;
+	time.tv_sec = 1000000;
+	time.tv_usec = 0;
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/sip_resp3.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket okRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet ok(&okRawPacket);
+
+	RtpStreamEndStats endStats;
+	int callContext = 0;
+	RtpStreamAnalyzer analyzer(onRtpStreamEnd, &endStats);
+	analyzer.setCurrentTime(1000000);
+	PTF_ASSERT_EQUAL(analyzer.registerSdp(ok.getLayerOfType<SdpLayer>(), &callContext), 1, size);
+	PTF_ASSERT_EQUAL(analyzer.getNumOfEndpoints(), 1, size);
+
+	// a PCMA stream to the endpoint, with a reordered packet, a lost packet and a late packet
+	PacketView view;
+	setSipMediaView(view, "10.0.0.1", 5000, "200.57.7.204", 8000);
+	uint16_t sentSeqs[] = { 100, 101, 102, 104, 103, 105, 107, 108 };
+	for (size_t i = 0; i < sizeof(sentSeqs) / sizeof(sentSeqs[0]); i++)
+		PTF_ASSERT_EQUAL(sendRtpPacket(analyzer, view, 8, sentSeqs[i], 0x1234, 0), RtpPacketAnalyzed, enum);
+	PTF_ASSERT_EQUAL(sendRtpPacket(analyzer, view, 8, 109, 0x1234, 40), RtpPacketAnalyzed, enum);
+
+	// a PCMU stream from the endpoint, which is known by its source
+	setSipMediaView(view, "200.57.7.204", 8000, "10.0.0.1", 5000);
+	for (uint16_t seq = 500; seq < 503; seq++)
+		PTF_ASSERT_EQUAL(sendRtpPacket(analyzer, view, 0, seq, 0x5678, 0), RtpPacketAnalyzed, enum);
+	PTF_ASSERT_EQUAL(analyzer.getNumOfStreams(), 2, size);
+
+	// packets of other endpoints aren't analyzed
+	setSipMediaView(view, "10.0.0.1", 5000, "200.57.7.204", 8002);
+	PTF_ASSERT_EQUAL(sendRtpPacket(analyzer, view, 8, 100, 0x1234, 0), RtpPacketIgnored, enum);
+	view.protocolTypes = IPv4 | TCP;
+	view.dstPort = 8000;
+	PTF_ASSERT_EQUAL(sendRtpPacket(analyzer, view, 8, 100, 0x1234, 0), RtpPacketIgnored, enum);
+
+	// the sender report of the first stream, sent to the RTCP port, reports on the second stream
+	setSipMediaView(view, "10.0.0.1", 5001, "200.57.7.204", 8001);
+	view.payloadOffset = 0;
+	view.payloadLength = sizeof(rtcpData);
+	timespec timestamp;
+	timestamp.tv_sec = 1000001;
+	timestamp.tv_nsec = 0;
+	PTF_ASSERT_EQUAL(analyzer.processPacket(view, rtcpData, sizeof(rtcpData), timestamp), RtcpPacketAnalyzed, enum);
+	setSipMediaView(view, "10.0.0.2", 5001, "10.0.0.3", 8001);
+	view.payloadOffset = 0;
+	view.payloadLength = sizeof(rtcpData);
+	PTF_ASSERT_EQUAL(analyzer.processPacket(view, rtcpData, sizeof(rtcpData), timestamp), RtpPacketIgnored, enum);
+
+	std::vector<RtpStreamStats> streams;
+	analyzer.getStreams(streams);
+	PTF_ASSERT_EQUAL(streams.size(), 2, size);
+	const RtpStreamStats* stream = findRtpStream(streams, 0x1234);
+	PTF_ASSERT_NOT_NULL(stream);
+	PTF_ASSERT_EQUAL(stream->srcPort, 5000, u16);
+	PTF_ASSERT_EQUAL(stream->dstPort, 8000, u16);
+	PTF_ASSERT_EQUAL(IPv4Address(*(uint32_t*)stream->dstIP).toString(), "200.57.7.204", string);
+	PTF_ASSERT_TRUE(stream->context == &callContext);
+	PTF_ASSERT_EQUAL(std::string(stream->encodingName), "PCMA", string);
+	PTF_ASSERT_EQUAL(stream->clockRate, 8000, u32);
+	PTF_ASSERT_EQUAL((int)stream->packets, 9, int);
+	PTF_ASSERT_EQUAL((int)stream->payloadBytes, 1440, int);
+	PTF_ASSERT_EQUAL((int)stream->expectedPackets, 10, int);
+	PTF_ASSERT_EQUAL((int)stream->lostPackets, 1, int);
+	PTF_ASSERT_EQUAL((int)stream->reorderedPackets, 1, int);
+	PTF_ASSERT_EQUAL(stream->sequenceRestarts, 0, u32);
+	// the late packet adds its 40ms (320 timestamp units) of transit difference to the jitter, which is 1/16 of it
+	PTF_ASSERT_TRUE(stream->jitterMs > 2.49 && stream->jitterMs < 2.51);
+	PTF_ASSERT_TRUE(stream->maxJitterMs > 2.49 && stream->maxJitterMs < 2.51);
+	PTF_ASSERT_EQUAL(stream->senderReports, 1, u32);
+	PTF_ASSERT_FALSE(stream->hasRemoteReport);
+	PTF_ASSERT_TRUE(stream->mos > 3.0 && stream->mos < RtpStreamAnalyzer::estimateMos(0, 50, 0, 25.1));
+
+	stream = findRtpStream(streams, 0x5678);
+	PTF_ASSERT_NOT_NULL(stream);
+	PTF_ASSERT_TRUE(stream->context == &callContext);
+	PTF_ASSERT_EQUAL(std::string(stream->encodingName), "PCMU", string);
+	PTF_ASSERT_EQUAL((int)stream->packets, 3, int);
+	PTF_ASSERT_EQUAL((int)stream->lostPackets, 0, int);
+	PTF_ASSERT_TRUE(stream->jitterMs == 0);
+	PTF_ASSERT_EQUAL(stream->senderReports, 0, u32);
+	PTF_ASSERT_TRUE(stream->hasRemoteReport);
+	PTF_ASSERT_TRUE(stream->remoteFractionLost == 0.25);
+	PTF_ASSERT_EQUAL(stream->remoteCumulativeLost, 2, int);
+	PTF_ASSERT_TRUE(stream->remoteJitterMs == 10);
+
+	// the E-model scores G.711 without loss and delay close to its maximum, and loss lowers it
+	double mos = RtpStreamAnalyzer::estimateMos(0, 0, 0, 25.1);
+	PTF_ASSERT_TRUE(mos > 4.4 && mos < 4.5);
+	PTF_ASSERT_TRUE(RtpStreamAnalyzer::estimateMos(5, 0, 0, 25.1) < mos);
+	PTF_ASSERT_TRUE(RtpStreamAnalyzer::estimateMos(5, 0, 11, 19) < RtpStreamAnalyzer::estimateMos(5, 0, 0, 25.1));
+
+	// RTP and RTCP of both directions are sent to the same shard
+	PacketView otherView;
+	setSipMediaView(view, "10.0.0.1", 5000, "200.57.7.204", 8000);
+	setSipMediaView(otherView, "200.57.7.204", 8001, "10.0.0.1", 5001);
+	PTF_ASSERT_EQUAL(RtpStreamAnalyzer::getShardHash(view), RtpStreamAnalyzer::getShardHash(otherView), u32);
+
+	// the streams end when they time out
+	analyzer.setCurrentTime(1000100);
+	PTF_ASSERT_EQUAL(analyzer.getNumOfStreams(), 0, size);
+	PTF_ASSERT_EQUAL(endStats.endedStreams.size(), 2, size);
+	stream = findRtpStream(endStats.endedStreams, 0x1234);
+	PTF_ASSERT_NOT_NULL(stream);
+	PTF_ASSERT_EQUAL((int)stream->lostPackets, 1, int);
+
+	// unregistered endpoints are analyzed only when configured, and after 2 packets in sequence
+	SipMediaEndpoint endpoint;
+	memset(&endpoint, 0, sizeof(endpoint));
+	endpoint.ipVersion = 4;
+	uint32_t endpointAddr = IPv4Address("200.57.7.204").toInt();
+	memcpy(endpoint.ipAddress, &endpointAddr, sizeof(endpointAddr));
+	endpoint.port = 8000;
+	PTF_ASSERT_TRUE(analyzer.unregisterEndpoint(endpoint));
+	PTF_ASSERT_FALSE(analyzer.unregisterEndpoint(endpoint));
+	PTF_ASSERT_EQUAL(analyzer.getNumOfEndpoints(), 0, size);
+	PTF_ASSERT_EQUAL(sendRtpPacket(analyzer, view, 8, 200, 0x1234, 0), RtpPacketIgnored, enum);
+
+	RtpStreamAnalyzer probingAnalyzer(onRtpStreamEnd, &endStats, RtpStreamAnalyzerConfiguration(100, 60, 3600, true));
+	setSipMediaView(view, "10.0.0.1", 5000, "10.0.0.2", 53);
+	PTF_ASSERT_EQUAL(sendRtpPacket(probingAnalyzer, view, 8, 1, 0x99, 0), RtpPacketIgnored, enum);
+	setSipMediaView(view, "10.0.0.1", 5000, "10.0.0.2", 6000);
+	PTF_ASSERT_EQUAL(sendRtpPacket(probingAnalyzer, view, 8, 1, 0x99, 0), RtpPacketAnalyzed, enum);
+	streams.clear();
+	probingAnalyzer.getStreams(streams);
+	PTF_ASSERT_EQUAL(streams.size(), 0, size);
+	PTF_ASSERT_EQUAL(sendRtpPacket(probingAnalyzer, view, 8, 2, 0x99, 0), RtpPacketAnalyzed, enum);
+	PTF_ASSERT_EQUAL(sendRtpPacket(probingAnalyzer, view, 8, 3, 0x99, 0), RtpPacketAnalyzed, enum);
+	probingAnalyzer.getStreams(streams);
+	PTF_ASSERT_EQUAL(streams.size(), 1, size);
+	PTF_ASSERT_NULL(streams[0].context);
+	PTF_ASSERT_EQUAL((int)streams[0].packets, 2, int);
+	PTF_ASSERT_EQUAL((int)streams[0].expectedPackets, 2, int);
+
+	// flush ends the streams which passed the probation
+	PTF_ASSERT_EQUAL(sendRtpPacket(probingAnalyzer, view, 8, 7, 0x98, 0), RtpPacketAnalyzed, enum);
+	PTF_ASSERT_EQUAL(probingAnalyzer.getNumOfStreams(), 2, size);
+	probingAnalyzer.flush();
+	PTF_ASSERT_EQUAL(probingAnalyzer.getNumOfStreams(), 0, size);
+	PTF_ASSERT_EQUAL(endStats.endedStreams.size(), 3, size);
+	PTF_ASSERT_EQUAL(endStats.endedStreams[2].ssrc, 0x99, u32);
+}
+
+
 PTF_TEST_CASE(PacketTrailerTest)
 {
 	timeval time;
@@ -7409,82 +8548,10416 @@ PTF_TEST_CASE(GtpLayerEditTest)
 }
 
 
-static struct option PacketTestOptions[] =
+PTF_TEST_CASE(LayerArenaTest)
 {
-	{"tags",  required_argument, 0, 't'},
-	{"mem-verbose", no_argument, 0, 'm' },
-	{"skip-mem-leak-check", no_argument, 0, 's' },
-	{0, 0, 0, 0}
-};
+	timeval time;
+	gettimeofday(&time, NULL);
 
-void print_usage()
-{
-    printf("Usage: Packet++Test [-t tags] [-m] [-s]\n\n"
-    		"Flags:\n"
-    		"-t                       A list of semicolon separated tags for tests to run\n"
-			"-m --mem-verbose         Output information about each memory allocation and deallocation\n"			
-            "-s --skip-mem-leak-check Skip memory leak check\n"
-    		);
-}
+	int buffer1Length = 0;
+	uint8_t* buffer1 = readFileIntoBuffer("PacketExamples/TwoHttpResponses1.dat", buffer1Length);
+	PTF_ASSERT_NOT_NULL(buffer1);
+
+	int buffer2Length = 0;
+	uint8_t* buffer2 = readFileIntoBuffer("PacketExamples/Dns1.dat", buffer2Length);
+	PTF_ASSERT_NOT_NULL(buffer2);
 
+	RawPacket rawPacket1((const uint8_t*)buffer1, buffer1Length, time, true);
+	RawPacket rawPacket2((const uint8_t*)buffer2, buffer2Length, time, true);
 
-int main(int argc, char* argv[]) {
+	Packet refPacket1(&rawPacket1);
+	Packet refPacket2(&rawPacket2);
 
-	int optionIndex = 0;
-	char opt = 0;
-	std::string userTags = "", configTags = "";
-	bool memVerbose = false;
-	bool skipMemLeakCheck = false;
+	size_t numOfLayers1 = 0, numOfLayers2 = 0;
+	for (Layer* curLayer = refPacket1.getFirstLayer(); curLayer != NULL; curLayer = curLayer->getNextLayer())
+		numOfLayers1++;
+	for (Layer* curLayer = refPacket2.getFirstLayer(); curLayer != NULL; curLayer = curLayer->getNextLayer())
+		numOfLayers2++;
 
-	while((opt = getopt_long (argc, argv, "mst:", PacketTestOptions, &optionIndex)) != -1)
+	LayerArena arena;
+	Packet* packet = new Packet();
+	packet->setLayerArena(&arena);
+	PTF_ASSERT_TRUE(packet->getLayerArena() == &arena);
+
+	// parse the same packets multiple times, each time the arena should be rewound and reused
+	for (int i = 0; i < 3; i++)
 	{
-		switch (opt)
+		packet->setRawPacket(&rawPacket1, false);
+		PTF_ASSERT_TRUE(packet->isPacketOfType(HTTPResponse));
+		PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), numOfLayers1, size);
+		size_t usedSize = arena.getUsedSize();
+		PTF_ASSERT_TRUE(usedSize > 0);
+		PTF_ASSERT_TRUE(packet->toString(false) == refPacket1.toString(false));
+		for (Layer* curLayer = packet->getFirstLayer(); curLayer != NULL; curLayer = curLayer->getNextLayer())
 		{
-			case 0:
-				break;
-			case 't':
-				userTags = optarg;
-				break;
-			case 's':
-				skipMemLeakCheck = true;
-				break;
-			case 'm':
-				memVerbose = true;
-				break;				
-				
-			default:
-				print_usage();
-				exit(1);
+			PTF_ASSERT_TRUE(arena.contains(curLayer));
 		}
+
+		packet->setRawPacket(&rawPacket2, false);
+		PTF_ASSERT_TRUE(packet->isPacketOfType(DNS));
+		PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), numOfLayers2, size);
+		PTF_ASSERT_TRUE(packet->toString(false) == refPacket2.toString(false));
 	}
 
-	printf("PcapPlusPlus version: %s\n", getPcapPlusPlusVersionFull().c_str());
-	printf("Built: %s\n", getBuildDateTime().c_str());
-	printf("Built from: %s\n", getGitInfo().c_str());
+	// layers added by the user are not allocated from the arena
+	PayloadLayer* newPayload = new PayloadLayer(buffer1, 10, false);
+	PTF_ASSERT_FALSE(arena.contains(newPayload));
+	PTF_ASSERT_TRUE(packet->addLayer(newPayload, true));
+
+	// removing a layer returns it to the arena
+	PTF_ASSERT_TRUE(packet->removeLayer(DNS));
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), numOfLayers2 - 1, size);
+
+	// detached layers stay valid after the packet is re-parsed and the arena isn't rewound until they're freed
+	Layer* detachedLayer = packet->detachLayer(UDP);
+	PTF_ASSERT_NOT_NULL(detachedLayer);
+	PTF_ASSERT_TRUE(arena.contains(detachedLayer));
+	packet->setRawPacket(&rawPacket1, false);
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), numOfLayers1 + 1, size);
+	PTF_ASSERT_EQUAL(detachedLayer->getProtocol(), UDP, enum);
+	delete detachedLayer;
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), numOfLayers1, size);
+
+	// when the arena is full layers are allocated on the heap
+	LayerArena tinyArena(64);
+	Packet packet2(&rawPacket1);
+	packet2.setLayerArena(&tinyArena);
+	packet2.setRawPacket(&rawPacket1, false);
+	PTF_ASSERT_TRUE(packet2.toString(false) == refPacket1.toString(false));
+	PTF_ASSERT_FALSE(tinyArena.contains(packet2.getLastLayer()));
+
+	// an arena owned by the packet outlives it as long as detached layers exist
+	Packet* packet3 = new Packet(&rawPacket1);
+	packet3->setLayerArena(new LayerArena(), true);
+	packet3->setRawPacket(&rawPacket1, false);
+	Layer* payloadLayer = packet3->detachLayer(GenericPayload);
+	PTF_ASSERT_NOT_NULL(payloadLayer);
+	delete packet3;
+	PTF_ASSERT_EQUAL(payloadLayer->getProtocol(), GenericPayload, enum);
+	delete payloadLayer;
+
+	delete packet;
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), 0, size);
+	PTF_ASSERT_EQUAL(arena.getUsedSize(), 0, size);
+}
 
-	#ifdef NDEBUG
-	skipMemLeakCheck = true;
-	printf("Disabling memory leak check in MSVC Release builds due to caching logic in stream objects that looks like a memory leak:\n");
-	printf("     https://github.com/cpputest/cpputest/issues/786#issuecomment-148921958\n");
-	#endif
-	
-	if (skipMemLeakCheck)
-	{
-		if (configTags != "")
-			configTags += ";";
 
-		configTags += "skip_mem_leak_check";
-		printf("Skipping memory leak check for all test cases\n");
+template<class TLayer>
+TLayer* getNextLayerOfTypeUsingDynamicCast(Layer* curLayer)
+{
+	while (curLayer != NULL && dynamic_cast<TLayer*>(curLayer) == NULL)
+		curLayer = curLayer->getNextLayer();
+
+	return (TLayer*)curLayer;
+}
+
+#define PTF_ASSERT_LAYER_LOOKUP(packet, LayerClass) \
+	PTF_ASSERT_TRUE(packet.getLayerOfType<LayerClass>() == getNextLayerOfTypeUsingDynamicCast<LayerClass>(packet.getFirstLayer())); \
+	for (Layer* afterLayer = packet.getFirstLayer(); afterLayer != NULL; afterLayer = afterLayer->getNextLayer()) \
+	{ \
+		PTF_ASSERT_TRUE(packet.getNextLayerOfType<LayerClass>(afterLayer) == getNextLayerOfTypeUsingDynamicCast<LayerClass>(afterLayer->getNextLayer())); \
 	}
 
-	if (memVerbose)
+PTF_TEST_CASE(LayerLookupByProtocolTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	const char* packetFiles[] = {
+			"PacketExamples/TwoHttpResponses1.dat",
+			"PacketExamples/TwoHttpRequests1.dat",
+			"PacketExamples/ArpRequestWithVlan.dat",
+			"PacketExamples/GREv0_1.dat",
+			"PacketExamples/GREv1_1.dat",
+			"PacketExamples/IGMPv1_1.dat",
+			"PacketExamples/IGMPv2_1.dat",
+			"PacketExamples/igmpv3_query.dat",
+			"PacketExamples/sip_req1.dat",
+			"PacketExamples/sip_resp1.dat",
+			"PacketExamples/SSL-ClientHello1.dat",
+			"PacketExamples/PPPoESession1.dat",
+			"PacketExamples/PPPoEDiscovery1.dat",
+			"PacketExamples/packet_trailer_ipv4.dat",
+			"PacketExamples/gtp-u1.dat",
+			"PacketExamples/Vxlan1.dat",
+			"PacketExamples/Dhcp1.dat",
+			"PacketExamples/radius_1.dat",
+			"PacketExamples/MplsPackets1.dat"
+	};
+
+	for (size_t i = 0; i < sizeof(packetFiles)/sizeof(packetFiles[0]); i++)
 	{
-		if (configTags != "")
-			configTags += ";";
+		int bufferLength = 0;
+		uint8_t* buffer = readFileIntoBuffer(packetFiles[i], bufferLength);
+		PTF_ASSERT_NOT_NULL(buffer);
 
-		configTags += "mem_leak_check_verbose";
-		printf("Turning on verbose information on memory allocations\n");
-	}
+		RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true);
+		Packet packet(&rawPacket);
+
+		PTF_ASSERT_LAYER_LOOKUP(packet, EthLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, VlanLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, ArpLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, MplsLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, PPPoELayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, PPPoESessionLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, PPPoEDiscoveryLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, IPv4Layer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, IPv6Layer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, GreLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, GREv0Layer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, GREv1Layer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, PPP_PPTPLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, IgmpLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, IgmpV1Layer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, IgmpV2Layer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, IgmpV3QueryLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, TcpLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, UdpLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, GtpV1Layer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, VxlanLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, TextBasedProtocolMessage);
+		PTF_ASSERT_LAYER_LOOKUP(packet, HttpMessage);
+		PTF_ASSERT_LAYER_LOOKUP(packet, HttpRequestLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, HttpResponseLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, SipLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, SipRequestLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, SipResponseLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, SdpLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, SSLLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, SSLHandshakeLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, DhcpLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, RadiusLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, PayloadLayer);
+		PTF_ASSERT_LAYER_LOOKUP(packet, PacketTrailerLayer);
+
+		for (Layer* curLayer = packet.getFirstLayer(); curLayer != NULL; curLayer = curLayer->getNextLayer())
+		{
+			Layer* firstLayerOfProtocol = packet.getFirstLayer();
+			while (firstLayerOfProtocol->getProtocol() != curLayer->getProtocol())
+				firstLayerOfProtocol = firstLayerOfProtocol->getNextLayer();
+
+			PTF_ASSERT_TRUE(packet.getLayerOfType(curLayer->getProtocol()) == firstLayerOfProtocol);
+		}
+	}
+
+	// the index should be kept up-to-date when layers are inserted or removed
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/GREv0_1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+
+	RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet grePacket(&rawPacket);
+
+	IPv4Layer* outerIPLayer = grePacket.getLayerOfType<IPv4Layer>();
+	PTF_ASSERT_NOT_NULL(outerIPLayer);
+	IPv4Layer* innerIPLayer = grePacket.getNextLayerOfType<IPv4Layer>(outerIPLayer);
+	PTF_ASSERT_NOT_NULL(innerIPLayer);
+	PTF_ASSERT_TRUE(grePacket.getLayerOfType(IPv4) == outerIPLayer);
+
+	PTF_ASSERT_TRUE(grePacket.removeLayer(IPv4));
+	PTF_ASSERT_TRUE(grePacket.getLayerOfType<IPv4Layer>() == innerIPLayer);
+	PTF_ASSERT_TRUE(grePacket.getLayerOfType(IPv4) == innerIPLayer);
+	PTF_ASSERT_TRUE(grePacket.isPacketOfType(IPv4));
+
+	IPv4Layer* newIPLayer = new IPv4Layer(IPv4Address(std::string("1.1.1.1")), IPv4Address(std::string("2.2.2.2")));
+	PTF_ASSERT_TRUE(grePacket.insertLayer(grePacket.getFirstLayer(), newIPLayer, true));
+	PTF_ASSERT_TRUE(grePacket.getLayerOfType<IPv4Layer>() == newIPLayer);
+	PTF_ASSERT_TRUE(grePacket.getNextLayerOfType<IPv4Layer>(newIPLayer) == innerIPLayer);
+
+	Packet copiedPacket(grePacket);
+	PTF_ASSERT_NOT_NULL(copiedPacket.getLayerOfType<IPv4Layer>());
+	PTF_ASSERT_TRUE(copiedPacket.getLayerOfType<IPv4Layer>() == getNextLayerOfTypeUsingDynamicCast<IPv4Layer>(copiedPacket.getFirstLayer()));
+	PTF_ASSERT_TRUE(copiedPacket.getLayerOfType<GreLayer>() == getNextLayerOfTypeUsingDynamicCast<GreLayer>(copiedPacket.getFirstLayer()));
+
+	PTF_ASSERT_TRUE(grePacket.removeLayer(IPv4));
+	PTF_ASSERT_TRUE(grePacket.removeLayer(IPv4));
+	PTF_ASSERT_NULL(grePacket.getLayerOfType<IPv4Layer>());
+	PTF_ASSERT_NULL(grePacket.getLayerOfType(IPv4));
+	PTF_ASSERT_FALSE(grePacket.isPacketOfType(IPv4));
+	PTF_ASSERT_NOT_NULL(grePacket.getLayerOfType<GreLayer>());
+} // LayerLookupByProtocolTest
+
+
+PTF_TEST_CASE(LazyParsingTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TwoHttpResponses1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+
+	RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet refPacket(&rawPacket);
+
+	// use a layer arena to count how many layers were parsed
+	LayerArena arena;
+	Packet packet;
+	packet.setLayerArena(&arena);
+	PTF_ASSERT_FALSE(packet.isLazyParsing());
+	packet.setLazyParsing(true);
+	PTF_ASSERT_TRUE(packet.isLazyParsing());
+
+	// only the first layer is parsed at first
+	packet.setRawPacket(&rawPacket, false);
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), 1, size);
+	PTF_ASSERT_NOT_NULL(packet.getLayerOfType<EthLayer>());
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), 1, size);
+
+	// layers are parsed as they're reached
+	IPv4Layer* ipLayer = packet.getLayerOfType<IPv4Layer>();
+	PTF_ASSERT_NOT_NULL(ipLayer);
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), 2, size);
+	PTF_ASSERT_TRUE(packet.isPacketOfType(IPv4));
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), 2, size);
+	PTF_ASSERT_TRUE(packet.getFirstLayer()->getNextLayer() == ipLayer);
+	PTF_ASSERT_TRUE(ipLayer->getNextLayer() != NULL);
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), 3, size);
+	PTF_ASSERT_TRUE(packet.isPacketOfType(TCP));
+	PTF_ASSERT_TRUE(packet.getLayerOfType(TCP) == ipLayer->getNextLayer());
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), 3, size);
+	HttpResponseLayer* httpLayer = packet.getLayerOfType<HttpResponseLayer>();
+	PTF_ASSERT_NOT_NULL(httpLayer);
+	PTF_ASSERT_EQUAL(httpLayer->getFirstLine()->getStatusCode(), HttpResponseLayer::Http200OK, enum);
+
+	// searching for a protocol that doesn't exist parses the whole packet
+	PTF_ASSERT_FALSE(packet.isPacketOfType(DNS));
+	size_t numOfLayers = arena.getNumOfLiveAllocations();
+	PTF_ASSERT_NULL(packet.getLayerOfType<UdpLayer>());
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), numOfLayers, size);
+	PTF_ASSERT_TRUE(packet.getLastLayer()->getProtocol() == refPacket.getLastLayer()->getProtocol());
+	PTF_ASSERT_TRUE(packet.toString(false) == refPacket.toString(false));
+
+	// getLastLayer() and toString() parse the whole packet
+	packet.setRawPacket(&rawPacket, false);
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), 1, size);
+	PTF_ASSERT_TRUE(packet.getLastLayer()->getProtocol() == refPacket.getLastLayer()->getProtocol());
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), numOfLayers, size);
+	packet.setRawPacket(&rawPacket, false);
+	PTF_ASSERT_TRUE(packet.toString(false) == refPacket.toString(false));
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), numOfLayers, size);
+
+	// parse limits are kept in lazy parsing mode
+	packet.setRawPacket(&rawPacket, false, TCP);
+	PTF_ASSERT_NOT_NULL(packet.getLayerOfType<TcpLayer>());
+	PTF_ASSERT_NULL(packet.getLayerOfType<HttpResponseLayer>());
+	PTF_ASSERT_EQUAL(packet.getLastLayer()->getProtocol(), TCP, enum);
+	packet.setRawPacket(&rawPacket, false, UnknownProtocol, OsiModelNetworkLayer);
+	PTF_ASSERT_NULL(packet.getLayerOfType<TcpLayer>());
+	PTF_ASSERT_EQUAL(packet.getLastLayer()->getProtocol(), IPv4, enum);
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), 2, size);
+
+	// editing a lazily parsed packet parses the rest of it first
+	RawPacket rawPacketCopy(rawPacket);
+	packet.setRawPacket(&rawPacketCopy, false);
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), 1, size);
+	PTF_ASSERT_TRUE(packet.removeFirstLayer());
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), numOfLayers - 1, size);
+	PTF_ASSERT_EQUAL(packet.getFirstLayer()->getProtocol(), IPv4, enum);
+	PTF_ASSERT_TRUE(packet.isPacketOfType(HTTPResponse));
+
+	// destructing a lazily parsed packet doesn't parse it
+	packet.setRawPacket(&rawPacket, false);
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), 1, size);
+	packet.setLazyParsing(false);
+	packet.setRawPacket(&rawPacket, false);
+	PTF_ASSERT_EQUAL(arena.getNumOfLiveAllocations(), numOfLayers, size);
+	PTF_ASSERT_TRUE(packet.isPacketOfType(HTTPResponse));
+} // LazyParsingTest
+
+
+PTF_TEST_CASE(PacketBatchTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	const char* packetFiles[] = {
+			"PacketExamples/TwoHttpResponses1.dat",
+			"PacketExamples/Dns1.dat",
+			"PacketExamples/ArpRequestWithVlan.dat",
+			"PacketExamples/GREv0_1.dat",
+			"PacketExamples/IPv6UdpPacket.dat",
+			"PacketExamples/packet_trailer_ipv4.dat"
+	};
+
+	const size_t numOfPackets = sizeof(packetFiles)/sizeof(packetFiles[0]);
+	RawPacket* rawPackets[numOfPackets];
+	Packet* refPackets[numOfPackets];
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		int bufferLength = 0;
+		uint8_t* buffer = readFileIntoBuffer(packetFiles[i], bufferLength);
+		PTF_ASSERT_NOT_NULL(buffer);
+		rawPackets[i] = new RawPacket((const uint8_t*)buffer, bufferLength, time, true);
+		refPackets[i] = new Packet(rawPackets[i]);
+	}
+
+	PacketBatch batch(numOfPackets - 1);
+	PTF_ASSERT_EQUAL(batch.getCapacity(), numOfPackets - 1, size);
+	PTF_ASSERT_EQUAL(batch.getCount(), 0, size);
+	PTF_ASSERT_NULL(batch.getPacket(0));
+
+	PTF_ASSERT_EQUAL(batch.getPrefetchDistance(), PacketBatch::DefaultPrefetchDistance, size);
+
+	// the batch is parsed a few times to make sure it's reused correctly, with prefetching disabled, a short distance and a distance
+	// beyond the batch
+	const size_t prefetchDistances[] = { 0, 1, numOfPackets * 2 };
+	for (int round = 0; round < 3; round++)
+	{
+		batch.setPrefetchDistance(prefetchDistances[round]);
+		PTF_ASSERT_EQUAL(batch.getPrefetchDistance(), prefetchDistances[round], size);
+
+		// packets beyond the batch capacity aren't parsed
+		PTF_ASSERT_EQUAL(batch.parse(rawPackets, numOfPackets), numOfPackets - 1, size);
+		PTF_ASSERT_EQUAL(batch.getCount(), numOfPackets - 1, size);
+		PTF_ASSERT_NULL(batch.getPacket(numOfPackets - 1));
+
+		const uint64_t* protocolTypes = batch.getProtocolTypes();
+		const uint16_t* networkLayerOffsets = batch.getNetworkLayerOffsets();
+		const uint16_t* transportLayerOffsets = batch.getTransportLayerOffsets();
+
+		// TCP packet - HTTP isn't parsed by the batch
+		PTF_ASSERT_TRUE(protocolTypes[0] == (uint64_t)(Ethernet | IPv4 | TCP));
+		PTF_ASSERT_EQUAL(networkLayerOffsets[0], 14, u16);
+		PTF_ASSERT_EQUAL(transportLayerOffsets[0], 34, u16);
+
+		// UDP packet - DNS isn't parsed by the batch
+		PTF_ASSERT_TRUE(protocolTypes[1] == (uint64_t)(Ethernet | IPv4 | UDP));
+		PTF_ASSERT_EQUAL(networkLayerOffsets[1], 14, u16);
+		PTF_ASSERT_EQUAL(transportLayerOffsets[1], 34, u16);
+
+		// non-IP packet
+		PTF_ASSERT_TRUE(protocolTypes[2] == (uint64_t)(Ethernet | VLAN | ARP));
+		PTF_ASSERT_EQUAL(networkLayerOffsets[2], PacketBatch::NoOffset, u16);
+		PTF_ASSERT_EQUAL(transportLayerOffsets[2], PacketBatch::NoOffset, u16);
+
+		// tunneled packet - the network layer offset is of the outer IP header
+		PTF_ASSERT_TRUE((protocolTypes[3] & GREv0) != 0);
+		PTF_ASSERT_EQUAL(networkLayerOffsets[3], 14, u16);
+		Layer* innerTransportLayer = refPackets[3]->getFirstLayer();
+		while (innerTransportLayer != NULL && (innerTransportLayer->getProtocol() & (TCP | UDP)) == 0)
+			innerTransportLayer = innerTransportLayer->getNextLayer();
+		uint16_t expectedTransportLayerOffset = PacketBatch::NoOffset;
+		if (innerTransportLayer != NULL)
+			expectedTransportLayerOffset = (uint16_t)(innerTransportLayer->getData() - rawPackets[3]->getRawData());
+		PTF_ASSERT_EQUAL(transportLayerOffsets[3], expectedTransportLayerOffset, u16);
+
+		PTF_ASSERT_TRUE(protocolTypes[4] == (uint64_t)(Ethernet | IPv6 | UDP));
+		PTF_ASSERT_EQUAL(networkLayerOffsets[4], 14, u16);
+		PTF_ASSERT_EQUAL(transportLayerOffsets[4], 54, u16);
+
+		// the full packet view is the same as a regular packet
+		for (size_t i = 0; i < batch.getCount(); i++)
+		{
+			PTF_ASSERT_TRUE(batch.getRawPacket(i) == rawPackets[i]);
+			PTF_ASSERT_TRUE(batch.getPacket(i)->toString(false) == refPackets[i]->toString(false));
+		}
+
+		PTF_ASSERT_TRUE(batch.getPacket(0)->isPacketOfType(HTTPResponse));
+		PTF_ASSERT_TRUE(batch.getPacket(1)->isPacketOfType(DNS));
+	}
+
+	// parse a smaller batch
+	PTF_ASSERT_EQUAL(batch.parse(&rawPackets[5], 1, OsiModelLayerUnknown), 1, size);
+	PTF_ASSERT_EQUAL(batch.getCount(), 1, size);
+	PTF_ASSERT_TRUE((batch.getProtocolTypes()[0] & PacketTrailer) != 0);
+	PTF_ASSERT_NULL(batch.getPacket(1));
+
+	batch.clear();
+	PTF_ASSERT_EQUAL(batch.getCount(), 0, size);
+	PTF_ASSERT_NULL(batch.getPacket(0));
+	PTF_ASSERT_NULL(batch.getRawPacket(0));
+
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		delete refPackets[i];
+		delete rawPackets[i];
+	}
+} // PacketBatchTest
+
+
+PTF_TEST_CASE(ProtocolRegistryTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	ProtocolRegistry& registry = ProtocolRegistry::getInstance();
+
+	PTF_ASSERT_TRUE(registry.isPortOfProtocol(80, HTTP));
+	PTF_ASSERT_TRUE(registry.isPortOfProtocol(80, HTTPRequest));
+	PTF_ASSERT_FALSE(registry.isPortOfProtocol(80, SSL));
+	PTF_ASSERT_TRUE(registry.isPortOfProtocol(53, DNS));
+	PTF_ASSERT_FALSE(registry.isPortOfProtocol(8081, HTTP));
+	PTF_ASSERT_EQUAL(registry.getProtocolByEtherType(PCPP_ETHERTYPE_VLAN), VLAN, enum);
+	PTF_ASSERT_EQUAL(registry.getProtocolByEtherType(0x88a8), UnknownProtocol, enum);
+	PTF_ASSERT_EQUAL(registry.getProtocolByIPProtocol(PACKETPP_IPPROTO_TCP), TCP, enum);
+	PTF_ASSERT_EQUAL(registry.getProtocolByIPProtocol(PACKETPP_IPPROTO_GRE), GRE, enum);
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(registry.registerPort(8081, TCP));
+	PTF_ASSERT_FALSE(registry.registerEtherType(0x88a8, TCP));
+	PTF_ASSERT_FALSE(registry.registerIPProtocol(200, HTTP));
+	LoggerPP::getInstance().enableErrors();
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TwoHttpRequests1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket httpRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+
+	// move the HTTP request to a port which isn't registered as HTTP
+	Packet httpPacket(&httpRawPacket);
+	PTF_ASSERT_TRUE(httpPacket.isPacketOfType(HTTPRequest));
+	httpPacket.getLayerOfType<TcpLayer>()->getTcpHeader()->portDst = htons(8081);
+	httpPacket.setRawPacket(&httpRawPacket, false);
+	PTF_ASSERT_FALSE(httpPacket.isPacketOfType(HTTPRequest));
+	PTF_ASSERT_NOT_NULL(httpPacket.getLayerOfType<PayloadLayer>());
+
+	PTF_ASSERT_TRUE(registry.registerPort(8081, HTTP));
+	PTF_ASSERT_TRUE(registry.isPortOfProtocol(8081, HTTP));
+	httpPacket.setRawPacket(&httpRawPacket, false);
+	PTF_ASSERT_TRUE(httpPacket.isPacketOfType(HTTPRequest));
+	PTF_ASSERT_NOT_NULL(httpPacket.getLayerOfType<HttpRequestLayer>());
+
+	// a port can be registered for more than one protocol
+	PTF_ASSERT_TRUE(registry.registerPort(8081, SSL));
+	PTF_ASSERT_TRUE(registry.isPortOfProtocol(8081, SSL));
+	PTF_ASSERT_TRUE(registry.unregisterPort(8081, SSL));
+	PTF_ASSERT_FALSE(registry.isPortOfProtocol(8081, SSL));
+	PTF_ASSERT_TRUE(registry.isPortOfProtocol(8081, HTTP));
+
+	// unregister a default port
+	PTF_ASSERT_TRUE(registry.unregisterPort(8081, HTTP));
+	PTF_ASSERT_TRUE(registry.unregisterPort(80, HTTP));
+	httpPacket.getLayerOfType<TcpLayer>()->getTcpHeader()->portDst = htons(80);
+	httpPacket.setRawPacket(&httpRawPacket, false);
+	PTF_ASSERT_FALSE(httpPacket.isPacketOfType(HTTPRequest));
+
+	// parse 802.1ad (QinQ) outer tags as VLAN
+	buffer = readFileIntoBuffer("PacketExamples/ArpRequestWithVlan.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket vlanRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet vlanPacket(&vlanRawPacket);
+	PTF_ASSERT_TRUE(vlanPacket.isPacketOfType(VLAN));
+	vlanPacket.getLayerOfType<EthLayer>()->getEthHeader()->etherType = htons(0x88a8);
+	vlanPacket.setRawPacket(&vlanRawPacket, false);
+	PTF_ASSERT_FALSE(vlanPacket.isPacketOfType(VLAN));
+	PTF_ASSERT_FALSE(vlanPacket.isPacketOfType(ARP));
+
+	PTF_ASSERT_TRUE(registry.registerEtherType(0x88a8, VLAN));
+	vlanPacket.setRawPacket(&vlanRawPacket, false);
+	PTF_ASSERT_TRUE(vlanPacket.isPacketOfType(VLAN));
+	PTF_ASSERT_TRUE(vlanPacket.isPacketOfType(ARP));
+
+	registry.unregisterEtherType(PCPP_ETHERTYPE_ARP);
+	vlanPacket.setRawPacket(&vlanRawPacket, false);
+	PTF_ASSERT_TRUE(vlanPacket.isPacketOfType(VLAN));
+	PTF_ASSERT_FALSE(vlanPacket.isPacketOfType(ARP));
+
+	registry.resetToDefaults();
+	PTF_ASSERT_TRUE(registry.isPortOfProtocol(80, HTTP));
+	PTF_ASSERT_FALSE(registry.isPortOfProtocol(8081, HTTP));
+	PTF_ASSERT_EQUAL(registry.getProtocolByEtherType(0x88a8), UnknownProtocol, enum);
+	PTF_ASSERT_EQUAL(registry.getProtocolByEtherType(PCPP_ETHERTYPE_ARP), ARP, enum);
+	httpPacket.setRawPacket(&httpRawPacket, false);
+	PTF_ASSERT_TRUE(httpPacket.isPacketOfType(HTTPRequest));
+	vlanPacket.setRawPacket(&vlanRawPacket, false);
+	PTF_ASSERT_FALSE(vlanPacket.isPacketOfType(VLAN));
+} // ProtocolRegistryTest
+
+
+PTF_TEST_CASE(PacketViewTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	struct PacketViewTestFile
+	{
+		const char* fileName;
+		LinkLayerType linkType;
+	};
+
+	PacketViewTestFile testFiles[] = {
+			{ "PacketExamples/TcpPacketWithOptions.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/TwoHttpRequests1.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/UdpPacket.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/Dns1.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/ArpRequestWithVlan.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/IcmpPacket.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/IPv4Option1.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/IPv4-TSO.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/IPv4Frag1.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/IPv4Frag2.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/IPv6UdpPacket.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/IPv6Frag1.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/ipv6_options_multi.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/ipv6_options_ah.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/ipv6_options_routing1.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/MplsPackets1.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/MplsPackets2.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/GREv0_1.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/Vxlan1.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/gtp-u-ipv6.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/PPPoESession1.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/packet_trailer_ipv6.dat", LINKTYPE_ETHERNET },
+			{ "PacketExamples/SllPacket.dat", LINKTYPE_LINUX_SLL },
+			{ "PacketExamples/SllPacket2.dat", LINKTYPE_LINUX_SLL }
+	};
+
+	for (size_t i = 0; i < sizeof(testFiles)/sizeof(testFiles[0]); i++)
+	{
+		const char* fileName = testFiles[i].fileName;
+		int bufferLength = 0;
+		uint8_t* buffer = readFileIntoBuffer(fileName, bufferLength);
+		PTF_ASSERT(buffer != NULL, "cannot read file '%s'", fileName);
+		RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true, testFiles[i].linkType);
+		Packet packet(&rawPacket);
+
+		PacketView view;
+		bool hasNetworkLayer = FlowKeyExtractor::extract(&rawPacket, view);
+
+		// walk the layers the same way FlowKeyExtractor does to get the expected values
+		uint64_t expectedProtocols = UnknownProtocol;
+		int expectedVlanCount = 0, expectedMplsCount = 0;
+		VlanLayer* firstVlanLayer = NULL;
+		Layer* networkLayer = NULL;
+		Layer* curLayer = packet.getFirstLayer();
+		while (curLayer != NULL)
+		{
+			ProtocolType protocol = curLayer->getProtocol();
+			if (protocol == Ethernet || protocol == SLL)
+				expectedProtocols |= protocol;
+			else if (protocol == VLAN)
+			{
+				expectedProtocols |= protocol;
+				expectedVlanCount++;
+				if (firstVlanLayer == NULL)
+					firstVlanLayer = (VlanLayer*)curLayer;
+			}
+			else if (protocol == MPLS)
+			{
+				expectedProtocols |= protocol;
+				expectedMplsCount++;
+			}
+			else if (protocol == IPv4 || protocol == IPv6)
+			{
+				expectedProtocols |= protocol;
+				networkLayer = curLayer;
+				break;
+			}
+			else
+				break;
+
+			curLayer = curLayer->getNextLayer();
+		}
+
+		Layer* transportLayer = NULL;
+		if (networkLayer != NULL && networkLayer->getNextLayer() != NULL && (networkLayer->getNextLayer()->getProtocol() & (TCP | UDP)) != 0)
+		{
+			transportLayer = networkLayer->getNextLayer();
+			expectedProtocols |= transportLayer->getProtocol();
+		}
+
+		PTF_ASSERT(hasNetworkLayer == (networkLayer != NULL), "%s: network layer detection mismatch", fileName);
+		PTF_ASSERT(view.protocolTypes == expectedProtocols, "%s: protocol types mismatch: 0x%llX != 0x%llX", fileName,
+				(unsigned long long)view.protocolTypes, (unsigned long long)expectedProtocols);
+		PTF_ASSERT(view.vlanCount == expectedVlanCount, "%s: VLAN count mismatch", fileName);
+		PTF_ASSERT(view.mplsLabelCount == expectedMplsCount, "%s: MPLS label count mismatch", fileName);
+		if (firstVlanLayer != NULL)
+		{
+			PTF_ASSERT(view.vlanId == firstVlanLayer->getVlanID(), "%s: VLAN ID mismatch", fileName);
+		}
+
+		if (networkLayer == NULL)
+		{
+			PTF_ASSERT(view.networkOffset == PacketView::NoOffset, "%s: unexpected network offset", fileName);
+			PTF_ASSERT(view.transportOffset == PacketView::NoOffset, "%s: unexpected transport offset", fileName);
+			continue;
+		}
+
+		PTF_ASSERT(view.networkOffset == networkLayer->getData() - rawPacket.getRawData(), "%s: network offset mismatch", fileName);
+		if (networkLayer->getProtocol() == IPv4)
+		{
+			IPv4Layer* ipLayer = (IPv4Layer*)networkLayer;
+			PTF_ASSERT(view.ipVersion == 4, "%s: IP version mismatch", fileName);
+			PTF_ASSERT(view.getSrcIPv4Address() == ipLayer->getSrcIpAddress(), "%s: source IP mismatch", fileName);
+			PTF_ASSERT(view.getDstIPv4Address() == ipLayer->getDstIpAddress(), "%s: destination IP mismatch", fileName);
+			PTF_ASSERT(view.ipProtocol == ipLayer->getIPv4Header()->protocol, "%s: IP protocol mismatch", fileName);
+			PTF_ASSERT(view.isFragment == ipLayer->isFragment(), "%s: fragment mismatch", fileName);
+			PTF_ASSERT(!view.isFragment || view.fragmentId == ntohs(ipLayer->getIPv4Header()->ipId), "%s: fragment ID mismatch", fileName);
+		}
+		else
+		{
+			IPv6Layer* ipLayer = (IPv6Layer*)networkLayer;
+			PTF_ASSERT(view.ipVersion == 6, "%s: IP version mismatch", fileName);
+			PTF_ASSERT(view.getSrcIPv6Address() == ipLayer->getSrcIpAddress(), "%s: source IP mismatch", fileName);
+			PTF_ASSERT(view.getDstIPv6Address() == ipLayer->getDstIpAddress(), "%s: destination IP mismatch", fileName);
+			PTF_ASSERT(view.isFragment == (ipLayer->getExtensionOfType<IPv6FragmentationHeader>() != NULL), "%s: fragment mismatch", fileName);
+			PTF_ASSERT(!view.isFragment || view.fragmentId == ntohl(ipLayer->getExtensionOfType<IPv6FragmentationHeader>()->getFragHeader()->id), "%s: fragment ID mismatch", fileName);
+		}
+
+		if (transportLayer == NULL)
+		{
+			PTF_ASSERT(view.transportOffset == PacketView::NoOffset, "%s: unexpected transport offset", fileName);
+			continue;
+		}
+
+		PTF_ASSERT(view.transportOffset == transportLayer->getData() - rawPacket.getRawData(), "%s: transport offset mismatch", fileName);
+		PTF_ASSERT(view.ipPayloadOffset == view.transportOffset, "%s: IP payload offset mismatch", fileName);
+		if (transportLayer->getNextLayer() != NULL)
+		{
+			PTF_ASSERT(view.payloadOffset == transportLayer->getNextLayer()->getData() - rawPacket.getRawData(), "%s: payload offset mismatch", fileName);
+			PTF_ASSERT(view.payloadLength == transportLayer->getLayerPayloadSize(), "%s: payload length mismatch", fileName);
+		}
+		else
+		{
+			PTF_ASSERT(view.payloadOffset == PacketView::NoOffset, "%s: unexpected payload offset", fileName);
+			PTF_ASSERT(view.payloadLength == 0, "%s: unexpected payload length", fileName);
+		}
+
+		if (transportLayer->getProtocol() == TCP)
+		{
+			tcphdr* tcpHeader = ((TcpLayer*)transportLayer)->getTcpHeader();
+			PTF_ASSERT(view.srcPort == ntohs(tcpHeader->portSrc), "%s: source port mismatch", fileName);
+			PTF_ASSERT(view.dstPort == ntohs(tcpHeader->portDst), "%s: destination port mismatch", fileName);
+			PTF_ASSERT(((view.tcpFlags & 0x02) != 0) == (tcpHeader->synFlag == 1), "%s: SYN flag mismatch", fileName);
+			PTF_ASSERT(((view.tcpFlags & 0x10) != 0) == (tcpHeader->ackFlag == 1), "%s: ACK flag mismatch", fileName);
+			PTF_ASSERT(((view.tcpFlags & 0x08) != 0) == (tcpHeader->pshFlag == 1), "%s: PSH flag mismatch", fileName);
+			PTF_ASSERT(((view.tcpFlags & 0x01) != 0) == (tcpHeader->finFlag == 1), "%s: FIN flag mismatch", fileName);
+		}
+		else
+		{
+			udphdr* udpHeader = ((UdpLayer*)transportLayer)->getUdpHeader();
+			PTF_ASSERT(view.srcPort == ntohs(udpHeader->portSrc), "%s: source port mismatch", fileName);
+			PTF_ASSERT(view.dstPort == ntohs(udpHeader->portDst), "%s: destination port mismatch", fileName);
+		}
+	}
+
+	// raw IP link type
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TcpPacketWithOptions.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	PacketView ethView, rawIPView;
+	PTF_ASSERT_TRUE(FlowKeyExtractor::extract(buffer, bufferLength, LINKTYPE_ETHERNET, ethView));
+	PTF_ASSERT_TRUE(FlowKeyExtractor::extract(buffer + sizeof(ether_header), bufferLength - sizeof(ether_header), LINKTYPE_RAW, rawIPView));
+	PTF_ASSERT_TRUE(rawIPView.isPacketOfType(IPv4));
+	PTF_ASSERT_TRUE(rawIPView.isPacketOfType(TCP));
+	PTF_ASSERT_FALSE(rawIPView.isPacketOfType(Ethernet));
+	PTF_ASSERT_EQUAL(rawIPView.networkOffset, 0, u16);
+	PTF_ASSERT_EQUAL(rawIPView.transportOffset + sizeof(ether_header), ethView.transportOffset, size);
+	PTF_ASSERT_EQUAL(rawIPView.ipPayloadOffset, rawIPView.transportOffset, u16);
+	PTF_ASSERT_EQUAL(rawIPView.srcPort, ethView.srcPort, u16);
+	PTF_ASSERT_EQUAL(rawIPView.tcpFlags, ethView.tcpFlags, u8);
+
+	// truncated and unsupported packets
+	PTF_ASSERT_FALSE(FlowKeyExtractor::extract(buffer, sizeof(ether_header) + 10, LINKTYPE_ETHERNET, ethView));
+	PTF_ASSERT_TRUE(ethView.isPacketOfType(Ethernet));
+	PTF_ASSERT_EQUAL(ethView.networkOffset, PacketView::NoOffset, u16);
+	PTF_ASSERT_TRUE(FlowKeyExtractor::extract(buffer, sizeof(ether_header) + sizeof(iphdr) + 10, LINKTYPE_ETHERNET, ethView));
+	PTF_ASSERT_TRUE(ethView.isPacketOfType(IPv4));
+	PTF_ASSERT_FALSE(ethView.isPacketOfType(TCP));
+	PTF_ASSERT_EQUAL(ethView.transportOffset, PacketView::NoOffset, u16);
+	PTF_ASSERT_EQUAL(ethView.ipPayloadOffset, sizeof(ether_header) + sizeof(iphdr), u16);
+	PTF_ASSERT_FALSE(FlowKeyExtractor::extract(buffer, bufferLength, LINKTYPE_NULL, ethView));
+	PTF_ASSERT_FALSE(FlowKeyExtractor::extract(NULL, ethView));
+	PTF_ASSERT_TRUE(ethView.protocolTypes == UnknownProtocol);
+	delete [] buffer;
+} // PacketViewTest
+
+
+PTF_TEST_CASE(RawPacketPoolTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	RawPacketPool pool(256, 1024, 4);
+	PTF_ASSERT_EQUAL(pool.getSmallBufferSize(), 256, size);
+	PTF_ASSERT_EQUAL(pool.getLargeBufferSize(), 1024, size);
+	PTF_ASSERT_EQUAL(pool.getNumOfFreeBuffers(), 0, size);
+
+	// buffers are taken from the smallest buffer class that fits
+	uint8_t* smallBuffer = pool.allocate(100);
+	PTF_ASSERT_NOT_NULL(smallBuffer);
+	PTF_ASSERT_EQUAL(pool.getBufferSize(smallBuffer), 256, size);
+	uint8_t* largeBuffer = pool.allocate(257);
+	PTF_ASSERT_NOT_NULL(largeBuffer);
+	PTF_ASSERT_EQUAL(pool.getBufferSize(largeBuffer), 1024, size);
+	PTF_ASSERT_NULL(pool.allocate(1025));
+	PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 2, size);
+	PTF_ASSERT_EQUAL(pool.getNumOfFreeBuffers(), 6, size);
+
+	// released buffers are reused
+	pool.release(smallBuffer);
+	PTF_ASSERT_TRUE(pool.allocate(200) == smallBuffer);
+	pool.release(smallBuffer);
+	pool.release(largeBuffer);
+	PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 0, size);
+	PTF_ASSERT_EQUAL(pool.getNumOfFreeBuffers(), 8, size);
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TcpPacketWithOptions.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+
+	{
+		RawPacket rawPacket;
+		PTF_ASSERT_TRUE(rawPacket.copyRawData(buffer, bufferLength, time, &pool));
+		PTF_ASSERT_TRUE(rawPacket.getRawDataPool() == &pool);
+		PTF_ASSERT_TRUE(rawPacket.getRawData() != buffer);
+		PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), bufferLength, int);
+		PTF_ASSERT_EQUAL(rawPacket.getFrameLength(), bufferLength, int);
+		PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), buffer, bufferLength);
+		PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 1, size);
+
+		// growing the data within the pool buffer doesn't re-allocate it
+		const uint8_t* origRawData = rawPacket.getRawData();
+		PTF_ASSERT_TRUE(rawPacket.reallocateData(pool.getBufferSize(origRawData)));
+		PTF_ASSERT_TRUE(rawPacket.getRawData() == origRawData);
+		PTF_ASSERT_TRUE(rawPacket.getRawDataPool() == &pool);
+		PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 1, size);
+		Packet packet(&rawPacket);
+		PTF_ASSERT_TRUE(packet.isPacketOfType(TCP));
+
+		// growing beyond the pool buffers moves the data to the heap
+		int rawDataLen = rawPacket.getRawDataLen();
+		PTF_ASSERT_TRUE(rawPacket.reallocateData(2000));
+		PTF_ASSERT_NULL(rawPacket.getRawDataPool());
+		PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 0, size);
+		PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), rawDataLen, int);
+
+		// setting new data returns the pool buffer
+		PTF_ASSERT_TRUE(rawPacket.copyRawData(buffer, 60, time, &pool, LINKTYPE_ETHERNET, bufferLength));
+		PTF_ASSERT_EQUAL(pool.getBufferSize(rawPacket.getRawData()), 256, size);
+		PTF_ASSERT_EQUAL(rawPacket.getFrameLength(), bufferLength, int);
+		PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 1, size);
+		RawPacket rawPacketCopy(rawPacket);
+		PTF_ASSERT_NULL(rawPacketCopy.getRawDataPool());
+		rawPacket.clear();
+		PTF_ASSERT_NULL(rawPacket.getRawDataPool());
+		PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 0, size);
+
+		PTF_ASSERT_TRUE(rawPacket.copyRawData(buffer, bufferLength, time, &pool));
+		PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 1, size);
+
+		// data too large for the pool is allocated on the heap
+		RawPacket largeRawPacket;
+		uint8_t largeData[1100];
+		memset(largeData, 0, sizeof(largeData));
+		PTF_ASSERT_TRUE(largeRawPacket.copyRawData(largeData, sizeof(largeData), time, &pool));
+		PTF_ASSERT_NULL(largeRawPacket.getRawDataPool());
+		PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 1, size);
+	}
+
+	PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 0, size);
+	delete [] buffer;
+} // RawPacketPoolTest
+
+
+PTF_TEST_CASE(PacketMemoryAllocatorTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	// huge pages are usually not reserved on test machines, so the allocator may fall back to regular pages. Either way the memory is usable
+	HugePagePacketMemoryAllocator allocator(HugePage2MB, -1, 4 * 1024 * 1024);
+	PTF_ASSERT_EQUAL(allocator.getPageSize(), 2 * 1024 * 1024, size);
+	PTF_ASSERT_EQUAL(allocator.getRegionSize(), 4 * 1024 * 1024, size);
+	PTF_ASSERT_EQUAL(allocator.getHugePageBytes() + allocator.getFallbackBytes(), 0, size);
+
+	// blocks are carved out of a single region and aligned to a cache line
+	uint8_t* block1 = allocator.allocate(1000);
+	uint8_t* block2 = allocator.allocate(1000);
+	PTF_ASSERT_NOT_NULL(block1);
+	PTF_ASSERT_NOT_NULL(block2);
+	PTF_ASSERT_EQUAL((int)(block2 - block1), 1024, int);
+	PTF_ASSERT_EQUAL((int)((size_t)block1 % 64), 0, int);
+	memset(block1, 0xab, 1000);
+	memset(block2, 0xcd, 1000);
+	PTF_ASSERT_EQUAL(allocator.getHugePageBytes() + allocator.getFallbackBytes(), 4 * 1024 * 1024, size);
+
+	// a block larger than a region gets a mapping of its own which is unmapped when it's freed
+	uint8_t* largeBlock = allocator.allocate(5 * 1024 * 1024);
+	PTF_ASSERT_NOT_NULL(largeBlock);
+	PTF_ASSERT_EQUAL(allocator.getHugePageBytes() + allocator.getFallbackBytes(), 10 * 1024 * 1024, size);
+	allocator.deallocate(largeBlock, 5 * 1024 * 1024);
+	PTF_ASSERT_EQUAL(allocator.getHugePageBytes() + allocator.getFallbackBytes(), 4 * 1024 * 1024, size);
+
+	// the current region is reused from its start when all of its blocks are freed
+	allocator.deallocate(block1, 1000);
+	allocator.deallocate(block2, 1000);
+	PTF_ASSERT_TRUE(allocator.allocate(100) == block1);
+	allocator.deallocate(block1, 100);
+
+	// pools and slab vectors take their slabs from the allocator
+	{
+		RawPacketPool pool(2048, 9216, 256, &allocator);
+		RawPacket rawPacket;
+		uint8_t data[1500];
+		memset(data, 0x11, sizeof(data));
+		PTF_ASSERT_TRUE(rawPacket.copyRawData(data, sizeof(data), time, &pool));
+		PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 1, size);
+		PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), data, sizeof(data));
+
+		RawPacketSlabVector slabVec(1024 * 1024, 1024, &allocator);
+		for (int i = 0; i < 2000; i++)
+			PTF_ASSERT_NOT_NULL(slabVec.pushBack(data, sizeof(data), time));
+		PTF_ASSERT_EQUAL(slabVec.size(), 2000, size);
+		PTF_ASSERT_BUF_COMPARE(slabVec.at(1999)->getRawData(), data, sizeof(data));
+		PTF_ASSERT_TRUE(allocator.getHugePageBytes() + allocator.getFallbackBytes() >= slabVec.getMemoryUsage());
+		rawPacket.clear();
+	}
+
+	// without the fallback, memory which can't be mapped with huge pages isn't allocated. The region is too large to be reserved
+	HugePagePacketMemoryAllocator strictAllocator(HugePage1GB, -1, (size_t)1024 * 1024 * 1024 * 1024, false);
+	LoggerPP::getInstance().supressErrors();
+	RawPacketSlabVector strictSlabVec(1024, 16, &strictAllocator);
+	uint8_t data[100];
+	memset(data, 0, sizeof(data));
+	PTF_ASSERT_NULL(strictSlabVec.pushBack(data, sizeof(data), time));
+	RawPacketPool strictPool(256, 1024, 4, &strictAllocator);
+	PTF_ASSERT_NULL(strictPool.allocate(100));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL(strictAllocator.getHugePageBytes() + strictAllocator.getFallbackBytes(), 0, size);
+	PTF_ASSERT_TRUE(strictAllocator.getNumOfHugePageFailures() > 0);
+} // PacketMemoryAllocatorTest
+
+
+PTF_TEST_CASE(MoveSemanticsTest)
+{
+#if __cplusplus > 199711L || _MSC_VER >= 1800
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TcpPacketWithOptions.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+
+	// RawPacket: the buffer is moved, not copied
+	RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	RawPacket movedRawPacket(std::move(rawPacket));
+	PTF_ASSERT_TRUE(movedRawPacket.getRawData() == buffer);
+	PTF_ASSERT_EQUAL(movedRawPacket.getRawDataLen(), bufferLength, int);
+	PTF_ASSERT_TRUE(movedRawPacket.isPacketSet());
+	PTF_ASSERT_NULL(rawPacket.getRawData());
+	PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), 0, int);
+	PTF_ASSERT_FALSE(rawPacket.isPacketSet());
+
+	// pool buffers move with the raw packet and are returned to the pool only once
+	RawPacketPool pool(256, 1024, 4);
+	{
+		RawPacket pooledRawPacket;
+		PTF_ASSERT_TRUE(pooledRawPacket.copyRawData(buffer, bufferLength, time, &pool));
+		const uint8_t* pooledData = pooledRawPacket.getRawData();
+		RawPacket assignedRawPacket;
+		assignedRawPacket = std::move(pooledRawPacket);
+		PTF_ASSERT_TRUE(assignedRawPacket.getRawData() == pooledData);
+		PTF_ASSERT_TRUE(assignedRawPacket.getRawDataPool() == &pool);
+		PTF_ASSERT_NULL(pooledRawPacket.getRawDataPool());
+		PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 1, size);
+	}
+	PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 0, size);
+
+	// Packet: layers move with the packet and aren't re-parsed
+	Packet referencePacket(&movedRawPacket);
+
+	Packet lazyPacket;
+	lazyPacket.setLazyParsing(true);
+	lazyPacket.setRawPacket(&movedRawPacket, false);
+	Layer* firstLayer = lazyPacket.getFirstLayer();
+	PTF_ASSERT_NOT_NULL(firstLayer);
+
+	Packet movedPacket(std::move(lazyPacket));
+	PTF_ASSERT_NULL(lazyPacket.getRawPacket());
+	PTF_ASSERT_NULL(lazyPacket.getFirstLayer());
+	PTF_ASSERT_NULL(lazyPacket.getLastLayer());
+	PTF_ASSERT_FALSE(lazyPacket.isPacketOfType(Ethernet));
+	PTF_ASSERT_TRUE(movedPacket.getRawPacket() == &movedRawPacket);
+	PTF_ASSERT_TRUE(movedPacket.getFirstLayer() == firstLayer);
+	PTF_ASSERT_TRUE(movedPacket.isLazyParsing());
+
+	// the rest of the layers are parsed on demand by the new packet
+	Layer* curLayer = movedPacket.getFirstLayer();
+	Layer* referenceLayer = referencePacket.getFirstLayer();
+	while (curLayer != NULL && referenceLayer != NULL)
+	{
+		PTF_ASSERT_EQUAL(curLayer->getProtocol(), referenceLayer->getProtocol(), enum);
+		PTF_ASSERT_TRUE(curLayer->getData() == referenceLayer->getData());
+		curLayer = curLayer->getNextLayer();
+		referenceLayer = referenceLayer->getNextLayer();
+	}
+	PTF_ASSERT_NULL(curLayer);
+	PTF_ASSERT_NULL(referenceLayer);
+	PTF_ASSERT_NOT_NULL(movedPacket.getLayerOfType<TcpLayer>());
+
+	// the moved layers extend the packet they were moved to
+	TcpLayer* tcpLayer = movedPacket.getLayerOfType<TcpLayer>();
+	size_t tcpHeaderLen = tcpLayer->getHeaderLen();
+	PTF_ASSERT_TRUE(tcpLayer->addTcpOption(TcpOptionBuilder(TcpOptionBuilder::NOP)).isNotNull());
+	PTF_ASSERT_EQUAL(tcpLayer->getHeaderLen(), tcpHeaderLen + 4, size);
+	PTF_ASSERT_EQUAL(movedRawPacket.getRawDataLen(), bufferLength + 4, int);
+
+	Packet assignedPacket;
+	assignedPacket = std::move(movedPacket);
+	PTF_ASSERT_NULL(movedPacket.getRawPacket());
+	PTF_ASSERT_TRUE(assignedPacket.getLayerOfType<TcpLayer>() == tcpLayer);
+	PTF_ASSERT_TRUE(assignedPacket.isPacketOfType(TCP));
+
+	// a packet that owns its raw packet passes the ownership on
+	Packet* ownerPacket = new Packet(100);
+	RawPacket* ownedRawPacket = ownerPacket->getRawPacket();
+	Packet newOwnerPacket(std::move(*ownerPacket));
+	delete ownerPacket;
+	PTF_ASSERT_TRUE(newOwnerPacket.getRawPacket() == ownedRawPacket);
+	EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:ff"), MacAddress("11:22:33:44:55:66"));
+	PTF_ASSERT_TRUE(newOwnerPacket.addLayer(&ethLayer));
+	PTF_ASSERT_EQUAL(ownedRawPacket->getRawDataLen(), (int)sizeof(ether_header), int);
+
+	// PointerVector
+	PointerVector<RawPacket> rawPacketVec;
+	rawPacketVec.pushBack(new RawPacket());
+	rawPacketVec.pushBack(new RawPacket());
+	RawPacket* firstElement = rawPacketVec.front();
+
+	PointerVector<RawPacket> movedVec(std::move(rawPacketVec));
+	PTF_ASSERT_EQUAL(rawPacketVec.size(), 0, size);
+	PTF_ASSERT_EQUAL(movedVec.size(), 2, size);
+	PTF_ASSERT_TRUE(movedVec.front() == firstElement);
+
+	std::vector<RawPacket*> released;
+	movedVec.release(released);
+	PTF_ASSERT_EQUAL(movedVec.size(), 0, size);
+	PTF_ASSERT_EQUAL(released.size(), 2, size);
+	PTF_ASSERT_TRUE(released.front() == firstElement);
+
+	PointerVector<RawPacket> adoptingVec;
+	adoptingVec.pushBack(new RawPacket());
+	adoptingVec.adopt(released);
+	PTF_ASSERT_EQUAL(released.size(), 0, size);
+	PTF_ASSERT_EQUAL(adoptingVec.size(), 3, size);
+	PTF_ASSERT_TRUE(adoptingVec.at(1) == firstElement);
+
+	movedVec.adopt(adoptingVec);
+	PTF_ASSERT_EQUAL(adoptingVec.size(), 0, size);
+	PTF_ASSERT_EQUAL(movedVec.size(), 3, size);
+
+	adoptingVec.swap(movedVec);
+	PTF_ASSERT_EQUAL(movedVec.size(), 0, size);
+	PTF_ASSERT_EQUAL(adoptingVec.size(), 3, size);
+
+	movedVec.pushBack(new RawPacket());
+	movedVec = std::move(adoptingVec);
+	PTF_ASSERT_EQUAL(movedVec.size(), 3, size);
+	PTF_ASSERT_EQUAL(adoptingVec.size(), 0, size);
+#endif
+} // MoveSemanticsTest
+
+
+PTF_TEST_CASE(RawPacketHeadroomTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TcpPacketWithOptions.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+
+	// RawPacket: inserting into the headroom moves only the data before the insertion point
+	RawPacket rawPacket;
+	PTF_ASSERT_TRUE(rawPacket.copyRawData(buffer, bufferLength, time, NULL, LINKTYPE_ETHERNET, -1, 16));
+	PTF_ASSERT_EQUAL(rawPacket.getHeadroom(), 16, size);
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), buffer, bufferLength);
+	const uint8_t* origData = rawPacket.getRawData();
+	uint8_t dataToInsert[4] = { 0x01, 0x02, 0x03, 0x04 };
+	rawPacket.insertData(6, dataToInsert, 4);
+	PTF_ASSERT_TRUE(rawPacket.getRawData() == origData - 4);
+	PTF_ASSERT_EQUAL(rawPacket.getHeadroom(), 12, size);
+	PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), bufferLength + 4, int);
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), buffer, 6);
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData() + 6, dataToInsert, 4);
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData() + 10, buffer + 6, bufferLength - 6);
+
+	// removing data close to the beginning returns it to the headroom
+	PTF_ASSERT_TRUE(rawPacket.removeData(6, 4));
+	PTF_ASSERT_TRUE(rawPacket.getRawData() == origData);
+	PTF_ASSERT_EQUAL(rawPacket.getHeadroom(), 16, size);
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), buffer, bufferLength);
+
+	// removing data close to the end shifts the rest of the data
+	PTF_ASSERT_TRUE(rawPacket.removeData(bufferLength - 10, 4));
+	PTF_ASSERT_TRUE(rawPacket.getRawData() == origData);
+	PTF_ASSERT_EQUAL(rawPacket.getHeadroom(), 16, size);
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData() + bufferLength - 10, buffer + bufferLength - 6, 6);
+
+	// reserving headroom in a packet without headroom copies the data once
+	RawPacket noHeadroomRawPacket(buffer, bufferLength, time, false);
+	PTF_ASSERT_EQUAL(noHeadroomRawPacket.getHeadroom(), 0, size);
+	PTF_ASSERT_TRUE(noHeadroomRawPacket.reserveHeadroom(32));
+	PTF_ASSERT_EQUAL(noHeadroomRawPacket.getHeadroom(), 32, size);
+	PTF_ASSERT_TRUE(noHeadroomRawPacket.getRawData() != buffer);
+	PTF_ASSERT_BUF_COMPARE(noHeadroomRawPacket.getRawData(), buffer, bufferLength);
+	origData = noHeadroomRawPacket.getRawData();
+	PTF_ASSERT_TRUE(noHeadroomRawPacket.reserveHeadroom(20));
+	PTF_ASSERT_TRUE(noHeadroomRawPacket.getRawData() == origData);
+	PTF_ASSERT_TRUE(noHeadroomRawPacket.reallocateData(bufferLength + 100));
+	PTF_ASSERT_EQUAL(noHeadroomRawPacket.getHeadroom(), 32, size);
+	PTF_ASSERT_BUF_COMPARE(noHeadroomRawPacket.getRawData(), buffer, bufferLength);
+
+	// pool buffers keep the headroom when they're returned and reused
+	RawPacketPool pool(256, 1024, 4);
+	{
+		RawPacket pooledRawPacket;
+		PTF_ASSERT_TRUE(pooledRawPacket.copyRawData(buffer, bufferLength, time, &pool, LINKTYPE_ETHERNET, -1, 64));
+		PTF_ASSERT_EQUAL(pooledRawPacket.getHeadroom(), 64, size);
+		PTF_ASSERT_TRUE(pooledRawPacket.getRawDataPool() == &pool);
+		PTF_ASSERT_TRUE(pooledRawPacket.reallocateData(pool.getLargeBufferSize() - 64));
+		PTF_ASSERT_TRUE(pooledRawPacket.getRawDataPool() == &pool);
+		PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 1, size);
+	}
+	PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 0, size);
+
+	// Packet: pushing encapsulation headers in front of the packet uses the headroom
+	RawPacket referenceRawPacket(buffer, bufferLength, time, false);
+	Packet referencePacket(&referenceRawPacket);
+
+	RawPacket encapRawPacket(buffer, bufferLength, time, false);
+	Packet encapPacket(&encapRawPacket);
+	PTF_ASSERT_TRUE(encapPacket.reserveHeadroom(64));
+	PTF_ASSERT_EQUAL(encapRawPacket.getHeadroom(), 64, size);
+	origData = encapRawPacket.getRawData();
+	PTF_ASSERT_TRUE(encapPacket.getFirstLayer()->getData() == origData);
+
+	EthLayer* ethLayer = encapPacket.getLayerOfType<EthLayer>();
+	VlanLayer vlanLayer(100, false, 1, PCPP_ETHERTYPE_IP);
+	PTF_ASSERT_TRUE(encapPacket.insertLayer(ethLayer, &vlanLayer));
+	VlanLayer refVlanLayer(100, false, 1, PCPP_ETHERTYPE_IP);
+	PTF_ASSERT_TRUE(referencePacket.insertLayer(referencePacket.getLayerOfType<EthLayer>(), &refVlanLayer));
+
+	PTF_ASSERT_TRUE(encapRawPacket.getRawData() == origData - sizeof(vlan_header));
+	PTF_ASSERT_EQUAL(encapRawPacket.getHeadroom(), 64 - sizeof(vlan_header), size);
+	PTF_ASSERT_EQUAL(encapRawPacket.getRawDataLen(), referenceRawPacket.getRawDataLen(), int);
+	PTF_ASSERT_BUF_COMPARE(encapRawPacket.getRawData(), referenceRawPacket.getRawData(), referenceRawPacket.getRawDataLen());
+	PTF_ASSERT_TRUE(encapPacket.getFirstLayer()->getData() == encapRawPacket.getRawData());
+	PTF_ASSERT_TRUE(encapPacket.getLayerOfType<VlanLayer>()->getData() == encapRawPacket.getRawData() + sizeof(ether_header));
+	PTF_ASSERT_EQUAL(encapPacket.getLayerOfType<IPv4Layer>()->getDataLen(), referencePacket.getLayerOfType<IPv4Layer>()->getDataLen(), size);
+
+	MplsLayer mplsLayer(16, 64, 0, true);
+	PTF_ASSERT_TRUE(encapPacket.insertLayer(encapPacket.getLayerOfType<VlanLayer>(), &mplsLayer));
+	PTF_ASSERT_EQUAL(encapRawPacket.getHeadroom(), 64 - sizeof(vlan_header) - 4, size);
+	PTF_ASSERT_TRUE(encapPacket.isPacketOfType(MPLS));
+
+	// a header inserted when the headroom is exhausted grows the buffer as before
+	PTF_ASSERT_TRUE(encapPacket.detachLayer(&mplsLayer));
+	PTF_ASSERT_EQUAL(encapRawPacket.getHeadroom(), 64 - sizeof(vlan_header), size);
+	PTF_ASSERT_TRUE(encapPacket.removeLayer(VLAN));
+	PTF_ASSERT_EQUAL(encapRawPacket.getHeadroom(), 64, size);
+	PTF_ASSERT_TRUE(encapRawPacket.getRawData() == origData);
+	PTF_ASSERT_BUF_COMPARE(encapRawPacket.getRawData(), buffer, bufferLength);
+	PTF_ASSERT_FALSE(encapPacket.isPacketOfType(VLAN));
+
+	PayloadLayer payloadLayer(buffer, 100, false);
+	PTF_ASSERT_TRUE(encapPacket.insertLayer(ethLayer, &payloadLayer));
+	PTF_ASSERT_EQUAL(encapRawPacket.getRawDataLen(), bufferLength + 100, int);
+	PTF_ASSERT_BUF_COMPARE(encapRawPacket.getRawData() + sizeof(ether_header), buffer, 100);
+	PTF_ASSERT_BUF_COMPARE(encapRawPacket.getRawData() + sizeof(ether_header) + 100, buffer + sizeof(ether_header), bufferLength - sizeof(ether_header));
+	PTF_ASSERT_TRUE(encapPacket.detachLayer(&payloadLayer));
+
+	delete [] buffer;
+} // RawPacketHeadroomTest
+
+
+PTF_TEST_CASE(IncrementalChecksumTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	// update_checksum() gives the same result as computing the checksum again
+	uint16_t words[4] = { htons(0x4500), htons(0x0073), htons(0x1c46), htons(0x4000) };
+	ScalarBuffer<uint16_t> scalar = { words, sizeof(words) };
+	uint16_t checksum = htons(compute_checksum(&scalar, 1));
+	uint16_t oldWord = words[2];
+	words[2] = htons(0xabcd);
+	scalar.buffer = words;
+	PTF_ASSERT_EQUAL(update_checksum(checksum, oldWord, words[2]), htons(compute_checksum(&scalar, 1)), u16);
+
+	// TCP over IPv4: rewrite addresses, TTL and ports
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TcpPacketWithOptions.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket tcpRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet tcpPacket(&tcpRawPacket);
+	tcpPacket.computeCalculateFields();
+
+	IPv4Layer* ipLayer = tcpPacket.getLayerOfType<IPv4Layer>();
+	TcpLayer* tcpLayer = tcpPacket.getLayerOfType<TcpLayer>();
+	PTF_ASSERT_NOT_NULL(ipLayer);
+	PTF_ASSERT_NOT_NULL(tcpLayer);
+	uint16_t origIPChecksum = ipLayer->getIPv4Header()->headerChecksum;
+	uint16_t origTcpChecksum = tcpLayer->getTcpHeader()->headerChecksum;
+
+	ipLayer->setSrcIpAddress(IPv4Address(std::string("10.1.2.3")), true);
+	ipLayer->setDstIpAddress(IPv4Address(std::string("192.168.200.201")), true);
+	ipLayer->setTimeToLive(ipLayer->getTimeToLive() - 1, true);
+	tcpLayer->setSrcPort(12345, true);
+	tcpLayer->setDstPort(8080, true);
+	PTF_ASSERT_EQUAL(ipLayer->getSrcIpAddress().toString(), "10.1.2.3", string);
+	PTF_ASSERT_EQUAL(tcpLayer->getSrcPort(), 12345, u16);
+	PTF_ASSERT_EQUAL(tcpLayer->getDstPort(), 8080, u16);
+	PTF_ASSERT_TRUE(ipLayer->getIPv4Header()->headerChecksum != origIPChecksum);
+	PTF_ASSERT_TRUE(tcpLayer->getTcpHeader()->headerChecksum != origTcpChecksum);
+
+	// cross-check against a full re-calculation
+	PTF_ASSERT_EQUAL(tcpLayer->getTcpHeader()->headerChecksum, htons(tcpLayer->calculateChecksum(false)), u16);
+	Packet tcpPacketCopy(tcpPacket);
+	tcpPacketCopy.computeCalculateFields();
+	PTF_ASSERT_EQUAL(tcpPacketCopy.getRawPacket()->getRawDataLen(), tcpRawPacket.getRawDataLen(), int);
+	PTF_ASSERT_BUF_COMPARE(tcpPacketCopy.getRawPacket()->getRawData(), tcpRawPacket.getRawData(), tcpRawPacket.getRawDataLen());
+
+	// without the flag the checksums aren't touched
+	uint16_t ipChecksum = ipLayer->getIPv4Header()->headerChecksum;
+	ipLayer->setTimeToLive(1);
+	tcpLayer->setDstPort(443);
+	PTF_ASSERT_EQUAL(ipLayer->getIPv4Header()->headerChecksum, ipChecksum, u16);
+	PTF_ASSERT_TRUE(tcpLayer->getTcpHeader()->headerChecksum != htons(tcpLayer->calculateChecksum(false)));
+
+	// UDP over IPv4
+	buffer = readFileIntoBuffer("PacketExamples/Dns1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket udpRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet udpPacket(&udpRawPacket);
+	udpPacket.computeCalculateFields();
+
+	ipLayer = udpPacket.getLayerOfType<IPv4Layer>();
+	UdpLayer* udpLayer = udpPacket.getLayerOfType<UdpLayer>();
+	PTF_ASSERT_NOT_NULL(ipLayer);
+	PTF_ASSERT_NOT_NULL(udpLayer);
+	PTF_ASSERT_TRUE(udpLayer->getUdpHeader()->headerChecksum != 0);
+
+	ipLayer->setDstIpAddress(IPv4Address(std::string("1.1.1.1")), true);
+	udpLayer->setSrcPort(5353, true);
+	udpLayer->setDstPort(53, true);
+	PTF_ASSERT_EQUAL(udpLayer->getSrcPort(), 5353, u16);
+	PTF_ASSERT_EQUAL(udpLayer->getUdpHeader()->headerChecksum, htons(udpLayer->calculateChecksum(false)), u16);
+	Packet udpPacketCopy(udpPacket);
+	udpPacketCopy.computeCalculateFields();
+	PTF_ASSERT_BUF_COMPARE(udpPacketCopy.getRawPacket()->getRawData(), udpRawPacket.getRawData(), udpRawPacket.getRawDataLen());
+
+	// a zero UDP checksum means no checksum and stays zero
+	udpLayer->getUdpHeader()->headerChecksum = 0;
+	udpLayer->setSrcPort(1000, true);
+	ipLayer->setSrcIpAddress(IPv4Address(std::string("2.2.2.2")), true);
+	PTF_ASSERT_EQUAL(udpLayer->getUdpHeader()->headerChecksum, 0, u16);
+} // IncrementalChecksumTest
+
+
+PTF_TEST_CASE(ModifiedLayersTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TcpPacketWithOptions.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet packet(&rawPacket);
+	packet.computeCalculateFields();
+
+	// parsed layers aren't modified
+	EthLayer* ethLayer = packet.getLayerOfType<EthLayer>();
+	IPv4Layer* ipLayer = packet.getLayerOfType<IPv4Layer>();
+	TcpLayer* tcpLayer = packet.getLayerOfType<TcpLayer>();
+	PTF_ASSERT_NOT_NULL(ethLayer);
+	PTF_ASSERT_NOT_NULL(ipLayer);
+	PTF_ASSERT_NOT_NULL(tcpLayer);
+	PTF_ASSERT_FALSE(ethLayer->isModified());
+	PTF_ASSERT_FALSE(ipLayer->isModified());
+	PTF_ASSERT_FALSE(tcpLayer->isModified());
+
+	// a wrong TCP checksum written through the header pointer isn't tracked, so computing only the modified layers keeps it
+	uint16_t tcpChecksum = tcpLayer->getTcpHeader()->headerChecksum;
+	tcpLayer->getTcpHeader()->headerChecksum = tcpChecksum + 1;
+	ipLayer->setTimeToLive(10);
+	PTF_ASSERT_TRUE(ipLayer->isModified());
+	PTF_ASSERT_FALSE(tcpLayer->isModified());
+	packet.computeCalculateFields(true);
+	PTF_ASSERT_FALSE(ipLayer->isModified());
+	uint16_t ipChecksum = ipLayer->getIPv4Header()->headerChecksum;
+	ipLayer->computeCalculateFields();
+	PTF_ASSERT_EQUAL(ipLayer->getIPv4Header()->headerChecksum, ipChecksum, u16);
+	PTF_ASSERT_EQUAL(tcpLayer->getTcpHeader()->headerChecksum, tcpChecksum + 1, u16);
+
+	// marking the layer computes it, as do the setters which don't update the checksum
+	tcpLayer->setModified();
+	packet.computeCalculateFields(true);
+	PTF_ASSERT_EQUAL(tcpLayer->getTcpHeader()->headerChecksum, tcpChecksum, u16);
+
+	tcpLayer->setDstPort(443);
+	PTF_ASSERT_TRUE(tcpLayer->isModified());
+	PTF_ASSERT_FALSE(ipLayer->isModified());
+	packet.computeCalculateFields(true);
+	PTF_ASSERT_EQUAL(tcpLayer->getTcpHeader()->headerChecksum, htons(tcpLayer->calculateChecksum(false)), u16);
+
+	// an address change marks the TCP layer too since the address is part of its checksum, an incremental update marks nothing
+	ipLayer->setSrcIpAddress(IPv4Address(std::string("10.1.2.3")));
+	PTF_ASSERT_TRUE(ipLayer->isModified());
+	PTF_ASSERT_TRUE(tcpLayer->isModified());
+	packet.computeCalculateFields(true);
+	PTF_ASSERT_EQUAL(tcpLayer->getTcpHeader()->headerChecksum, htons(tcpLayer->calculateChecksum(false)), u16);
+	ipLayer->setDstIpAddress(IPv4Address(std::string("10.3.2.1")), true);
+	PTF_ASSERT_FALSE(ipLayer->isModified());
+	PTF_ASSERT_FALSE(tcpLayer->isModified());
+
+	// a full computation unmarks all layers
+	ipLayer->setTimeToLive(20);
+	packet.computeCalculateFields();
+	PTF_ASSERT_FALSE(ipLayer->isModified());
+
+	// inserting a layer marks the previous layer, and a modified payload causes all layers before it to be computed
+	VlanLayer* vlanLayer = new VlanLayer(100, false, 0, PCPP_ETHERTYPE_IP);
+	PTF_ASSERT_TRUE(packet.insertLayer(ethLayer, vlanLayer, true));
+	PTF_ASSERT_TRUE(ethLayer->isModified());
+	PTF_ASSERT_TRUE(vlanLayer->isModified());
+	packet.computeCalculateFields(true);
+	PTF_ASSERT_EQUAL(ethLayer->getEthHeader()->etherType, htons(PCPP_ETHERTYPE_VLAN), u16);
+	PTF_ASSERT_FALSE(vlanLayer->isModified());
+
+	Layer* lastLayer = packet.getLastLayer();
+	PTF_ASSERT_TRUE(lastLayer != tcpLayer);
+	lastLayer->getData()[0] ^= 0xff;
+	lastLayer->setModified();
+	ipLayer->getIPv4Header()->headerChecksum = 0;
+	packet.computeCalculateFields(true);
+	PTF_ASSERT_EQUAL(tcpLayer->getTcpHeader()->headerChecksum, htons(tcpLayer->calculateChecksum(false)), u16);
+	PTF_ASSERT_TRUE(ipLayer->getIPv4Header()->headerChecksum != 0);
+
+	// extending a layer marks it
+	PTF_ASSERT_TRUE(packet.removeLayer(VLAN));
+	PTF_ASSERT_TRUE(ethLayer->isModified());
+	packet.computeCalculateFields(true);
+	PTF_ASSERT_EQUAL(ethLayer->getEthHeader()->etherType, htons(PCPP_ETHERTYPE_IP), u16);
+	size_t ipTotalLen = ntohs(ipLayer->getIPv4Header()->totalLength);
+	PTF_ASSERT_TRUE(ipLayer->addOption(IPv4OptionBuilder(IPV4OPT_RouterAlert, (uint16_t)0)).isNotNull());
+	PTF_ASSERT_TRUE(ipLayer->isModified());
+	packet.computeCalculateFields(true);
+	PTF_ASSERT_EQUAL(ntohs(ipLayer->getIPv4Header()->totalLength), ipTotalLen + 4, size);
+
+	// layers created by the user are modified until they're computed
+	EthLayer newEthLayer(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"));
+	PTF_ASSERT_TRUE(newEthLayer.isModified());
+} // ModifiedLayersTest
+
+
+
+PTF_TEST_CASE(PacketCloneTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TcpPacketWithOptions.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket* rawPacket = new RawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet* packet = new Packet(rawPacket, true);
+
+	// clones share the raw data and are parsed lazily from it
+	Packet* clone1 = packet->clone();
+	Packet* clone2 = packet->clone();
+	PTF_ASSERT_NOT_NULL(clone1);
+	PTF_ASSERT_NOT_NULL(clone2);
+	PTF_ASSERT_TRUE(rawPacket->isRawDataShared());
+	PTF_ASSERT_TRUE(clone1->getRawPacket()->isRawDataShared());
+	PTF_ASSERT_TRUE(clone1->getRawPacket()->getRawData() == rawPacket->getRawData());
+	PTF_ASSERT_TRUE(clone2->getRawPacket()->getRawData() == rawPacket->getRawData());
+	PTF_ASSERT_EQUAL(clone1->getRawPacket()->getRawDataLen(), bufferLength, int);
+	PTF_ASSERT_TRUE(clone1->isPacketOfType(TCP));
+	TcpLayer* cloneTcpLayer = clone1->getLayerOfType<TcpLayer>();
+	PTF_ASSERT_NOT_NULL(cloneTcpLayer);
+	PTF_ASSERT_TRUE(cloneTcpLayer->getTcpHeader() == packet->getLayerOfType<TcpLayer>()->getTcpHeader());
+
+	// the data outlives the packet it was cloned from
+	delete packet;
+	PTF_ASSERT_TRUE(clone1->getRawPacket()->isRawDataShared());
+	PTF_ASSERT_EQUAL(clone1->getLayerOfType<TcpLayer>()->getSrcPort(), clone2->getLayerOfType<TcpLayer>()->getSrcPort(), u16);
+
+	// structural changes copy the shared data first
+	const uint8_t* sharedData = clone2->getRawPacket()->getRawData();
+	IPv4Layer* ipLayer = clone1->getLayerOfType<IPv4Layer>();
+	PTF_ASSERT_NOT_NULL(ipLayer);
+	VlanLayer vlanLayer(100, 0, 0, PCPP_ETHERTYPE_IP);
+	PTF_ASSERT_TRUE(clone1->insertLayer(clone1->getFirstLayer(), &vlanLayer));
+	PTF_ASSERT_TRUE(clone1->getRawPacket()->getRawData() != sharedData);
+	PTF_ASSERT_FALSE(clone1->getRawPacket()->isRawDataShared());
+	PTF_ASSERT_FALSE(clone2->getRawPacket()->isRawDataShared());
+	PTF_ASSERT_EQUAL(clone1->getRawPacket()->getRawDataLen(), bufferLength + 4, int);
+	PTF_ASSERT_EQUAL(clone2->getRawPacket()->getRawDataLen(), bufferLength, int);
+	PTF_ASSERT_TRUE(clone2->getRawPacket()->getRawData() == sharedData);
+	PTF_ASSERT_TRUE(clone1->isPacketOfType(VLAN));
+	PTF_ASSERT_FALSE(clone2->isPacketOfType(VLAN));
+	PTF_ASSERT_TRUE(ipLayer->getData() == clone1->getRawPacket()->getRawData() + 18);
+	PTF_ASSERT_TRUE(clone2->getRawPacket()->getRawData() + 14 == clone2->getLayerOfType<IPv4Layer>()->getData());
+
+	// a packet whose data isn't shared anymore owns it again
+	PTF_ASSERT_TRUE(clone2->unshareRawData());
+	PTF_ASSERT_TRUE(clone2->getRawPacket()->getRawData() == sharedData);
+	delete clone1;
+
+	// fields are written after unsharing the data
+	Packet* clone3 = clone2->clone();
+	PTF_ASSERT_NOT_NULL(clone3);
+	TcpLayer* tcpLayer = clone3->getLayerOfType<TcpLayer>();
+	PTF_ASSERT_NOT_NULL(tcpLayer);
+	uint16_t srcPort = tcpLayer->getSrcPort();
+	PTF_ASSERT_TRUE(clone3->unshareRawData());
+	PTF_ASSERT_FALSE(clone2->getRawPacket()->isRawDataShared());
+	PTF_ASSERT_TRUE(clone3->getRawPacket()->getRawData() != sharedData);
+	tcpLayer->getTcpHeader()->portSrc = htons(srcPort + 1);
+	PTF_ASSERT_EQUAL(clone3->getLayerOfType<TcpLayer>()->getSrcPort(), srcPort + 1, u16);
+	PTF_ASSERT_EQUAL(clone2->getLayerOfType<TcpLayer>()->getSrcPort(), srcPort, u16);
+	delete clone3;
+	delete clone2;
+
+	// external data is copied once, and the packet keeps its layers
+	RawPacket externalRawPacket;
+	uint8_t* externalBuffer = readFileIntoBuffer("PacketExamples/TcpPacketWithOptions.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(externalBuffer);
+	PTF_ASSERT_TRUE(externalRawPacket.setExternalRawData(externalBuffer, bufferLength, TimestampClock::now()));
+	Packet externalPacket(&externalRawPacket);
+	IPv4Layer* externalIpLayer = externalPacket.getLayerOfType<IPv4Layer>();
+	PTF_ASSERT_NOT_NULL(externalIpLayer);
+	Packet* externalClone = externalPacket.clone();
+	PTF_ASSERT_NOT_NULL(externalClone);
+	PTF_ASSERT_TRUE(externalRawPacket.getRawData() != externalBuffer);
+	PTF_ASSERT_TRUE(externalClone->getRawPacket()->getRawData() == externalRawPacket.getRawData());
+	PTF_ASSERT_TRUE(externalIpLayer->getData() == externalRawPacket.getRawData() + 14);
+	PTF_ASSERT_BUF_COMPARE(externalRawPacket.getRawData(), externalBuffer, bufferLength);
+	delete externalClone;
+	PTF_ASSERT_FALSE(externalRawPacket.isRawDataShared());
+	delete [] externalBuffer;
+
+	// a packet without raw data can't be cloned
+	Packet emptyPacket((RawPacket*)NULL);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_NULL(emptyPacket.clone());
+	LoggerPP::getInstance().enableErrors();
+} // PacketCloneTest
+
+
+PTF_TEST_CASE(ChecksumKernelTest)
+{
+	// compare compute_checksum() (which uses the best kernel for this CPU) with a plain word-by-word sum, for all lengths up to a jumbo
+	// frame and for unaligned buffers
+	const size_t maxLen = 9100;
+	uint8_t* data = new uint8_t[maxLen + 4];
+	srand(1);
+	for (size_t i = 0; i < maxLen + 4; i++)
+		data[i] = (uint8_t)rand();
+
+	// all ones maximizes the sum of each lane
+	uint8_t* ones = new uint8_t[maxLen];
+	memset(ones, 0xff, maxLen);
+
+	for (size_t offset = 0; offset < 4; offset++)
+	{
+		for (size_t len = 0; len <= maxLen; len += (len < 300 ? 1 : 97))
+		{
+			uint8_t* buffers[2] = { data + offset, ones };
+			for (int b = 0; b < 2; b++)
+			{
+				const uint8_t* buf = buffers[b];
+				uint32_t refSum = 0;
+				for (size_t i = 0; i + 1 < len; i += 2)
+				{
+					uint16_t word;
+					memcpy(&word, buf + i, sizeof(word));
+					refSum += word;
+					refSum = (refSum & 0xffff) + (refSum >> 16);
+				}
+				if (len & 1)
+				{
+					refSum += buf[len - 1];
+					refSum = (refSum & 0xffff) + (refSum >> 16);
+				}
+				uint16_t refChecksum = (uint16_t)~ntohs((uint16_t)refSum);
+
+				ScalarBuffer<uint16_t> scalar = { (uint16_t*)buf, len };
+				PTF_ASSERT(compute_checksum(&scalar, 1) == refChecksum, "Checksum mismatch for length %d, offset %d", (int)len, (int)offset);
+			}
+		}
+	}
+
+	// several buffers are summed as one
+	ScalarBuffer<uint16_t> vec[2] = { { (uint16_t*)data, 1500 }, { (uint16_t*)(data + 1500), 20 } };
+	ScalarBuffer<uint16_t> whole = { (uint16_t*)data, 1520 };
+	PTF_ASSERT_EQUAL(compute_checksum(vec, 2), compute_checksum(&whole, 1), u16);
+
+	delete [] data;
+	delete [] ones;
+} // ChecksumKernelTest
+
+
+PTF_TEST_CASE(StringKernelTest)
+{
+	// compare the kernels (the best ones for this CPU) with plain byte-by-byte versions, for all lengths and alignments around the vector sizes
+	const size_t maxLen = 300;
+	char* data = new char[maxLen + 4];
+	srand(1);
+	for (size_t i = 0; i < maxLen + 4; i++)
+		data[i] = (char)rand();
+
+	// hex encoding and decoding
+	for (size_t offset = 0; offset < 4; offset++)
+	{
+		for (size_t len = 0; len <= maxLen; len++)
+		{
+			const uint8_t* bytes = (const uint8_t*)data + offset;
+			std::string hex = byteArrayToHexString(bytes, len);
+			PTF_ASSERT_EQUAL(hex.length(), len * 2, size);
+			bool hexMatches = true;
+			for (size_t i = 0; i < len && hexMatches; i++)
+			{
+				char expected[3];
+				snprintf(expected, sizeof(expected), "%02x", bytes[i]);
+				hexMatches = (hex[2*i] == expected[0] && hex[2*i + 1] == expected[1]);
+			}
+			PTF_ASSERT(hexMatches, "Hex string mismatch for length %d, offset %d", (int)len, (int)offset);
+
+			// decoding accepts upper case letters too
+			if (len % 3 == 0)
+				std::transform(hex.begin(), hex.end(), hex.begin(), ::toupper);
+			uint8_t decoded[maxLen];
+			PTF_ASSERT_EQUAL(hexStringToByteArray(hex, decoded, maxLen), len, size);
+			PTF_ASSERT_BUF_COMPARE(decoded, bytes, len);
+		}
+	}
+
+	uint8_t decoded[40];
+	std::string hex = byteArrayToHexString((const uint8_t*)data, 40);
+	PTF_ASSERT_EQUAL(byteArrayToHexString((const uint8_t*)data, 40, 10), hex.substr(0, 20), string);
+	// a string longer than the array is truncated
+	PTF_ASSERT_EQUAL(hexStringToByteArray(hex, decoded, 20), 20, size);
+	PTF_ASSERT_BUF_COMPARE(decoded, data, 20);
+	// an illegal character anywhere in a vector, and an odd length, fail the conversion
+	LoggerPP::getInstance().supressErrors();
+	const char illegalChars[] = { 'g', 'G', '/', ':', '@', '`', ' ', '\0' };
+	for (size_t pos = 0; pos < 80; pos += 7)
+	{
+		std::string illegalHex = hex;
+		illegalHex[pos] = illegalChars[pos % sizeof(illegalChars)];
+		PTF_ASSERT_EQUAL(hexStringToByteArray(illegalHex, decoded, 40), 0, size);
+		PTF_ASSERT_EQUAL(decoded[0], 0, u8);
+	}
+	PTF_ASSERT_EQUAL(hexStringToByteArray(hex.substr(1), decoded, 40), 0, size);
+	LoggerPP::getInstance().enableErrors();
+
+	// findFirstOf() and findSubstring(), with the match at every position
+	char text[maxLen + 32];
+	for (size_t len = 1; len <= maxLen; len++)
+	{
+		for (size_t pos = 0; pos < len; pos += (len < 80 ? 1 : 13))
+		{
+			memset(text, 'a', sizeof(text));
+			text[pos] = ':';
+			if (pos + 5 < len)
+				text[pos + 5] = '\n';
+			PTF_ASSERT_TRUE(findFirstOf(text, len, "\r\n:", 3) == text + pos);
+			PTF_ASSERT_TRUE(findFirstOf(text, len, "\r\n", 2) == (pos + 5 < len ? text + pos + 5 : NULL));
+			PTF_ASSERT_TRUE(findFirstOf(text, pos, "\r\n:", 3) == NULL);
+
+			memset(text, 'a', sizeof(text));
+			// partial matches before the match
+			if (pos >= 4)
+				memcpy(text + pos - 4, " HT", 3);
+			if (pos + 6 <= len)
+			{
+				memcpy(text + pos, " HTTP/", 6);
+				PTF_ASSERT_TRUE(findSubstring(text, len, " HTTP/", 6) == text + pos);
+				// the match must end before the end of the buffer
+				PTF_ASSERT_TRUE(findSubstring(text, pos + 5, " HTTP/", 6) == NULL);
+			}
+			else
+				PTF_ASSERT_TRUE(findSubstring(text, len, " HTTP/", 6) == NULL);
+		}
+	}
+	PTF_ASSERT_TRUE(findFirstOf(text, 0, ":", 1) == NULL);
+	// more characters than the vector kernels handle
+	const char* letters = "abcdefghijklmnopqrstuvwxyz";
+	PTF_ASSERT_TRUE(findFirstOf(letters, 26, "98765z", 6) == letters + 25);
+	PTF_ASSERT_TRUE(findSubstring(letters, 26, "", 0) == letters);
+	PTF_ASSERT_TRUE(findSubstring(letters, 3, "abcd", 4) == NULL);
+
+	// case-insensitive compare and hash
+	const char* upper = "CONTENT-LENGTH: X-Forwarded-For [@`{]";
+	const char* lower = "content-length: x-forwarded-for [@`{]";
+	size_t caseLen = strlen(upper);
+	for (size_t len = 0; len <= caseLen; len++)
+	{
+		PTF_ASSERT_TRUE(equalsIgnoreCase(upper, lower, len));
+		PTF_ASSERT_EQUAL(hashIgnoreCase(upper, len), hashIgnoreCase(lower, len), u32);
+	}
+	// '@' and '[' are next to the letters but aren't letters, and neither are bytes with the high bit set
+	PTF_ASSERT_FALSE(equalsIgnoreCase("ab@[cdefgh", "ab`{cdefgh", 10));
+	PTF_ASSERT_FALSE(equalsIgnoreCase("abcdefgh\xc1", "abcdefgh\xe1", 9));
+	PTF_ASSERT_FALSE(equalsIgnoreCase("abcdefgh\xc1xxxxxxx", "abcdefgh\xe1xxxxxxx", 16));
+	PTF_ASSERT_FALSE(equalsIgnoreCase("Host", "Hose", 4));
+	PTF_ASSERT_TRUE(hashIgnoreCase("Host", 4) != hashIgnoreCase("Hose", 4));
+	PTF_ASSERT_TRUE(hashIgnoreCase("a", 1) != hashIgnoreCase("a\0", 2));
+
+	delete [] data;
+} // StringKernelTest
+
+
+PTF_TEST_CASE(FlowHashTest)
+{
+	// the verification suite of the Microsoft RSS specification
+	uint8_t rssKey[40] = {
+			0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+			0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+			0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa
+	};
+
+	FlowTuple ipv4Tuple;
+	memset(&ipv4Tuple, 0, sizeof(ipv4Tuple));
+	uint32_t srcIPv4 = IPv4Address(std::string("66.9.149.187")).toInt();
+	uint32_t dstIPv4 = IPv4Address(std::string("161.142.100.80")).toInt();
+	memcpy(ipv4Tuple.srcIP, &srcIPv4, 4);
+	memcpy(ipv4Tuple.dstIP, &dstIPv4, 4);
+	ipv4Tuple.srcPort = 2794;
+	ipv4Tuple.dstPort = 1766;
+	ipv4Tuple.protocol = PACKETPP_IPPROTO_TCP;
+	ipv4Tuple.ipVersion = 4;
+	PTF_ASSERT_EQUAL(FlowHash::hashToeplitz(ipv4Tuple, true, rssKey, sizeof(rssKey)), 0x51ccc178, hex);
+	PTF_ASSERT_EQUAL(FlowHash::hashToeplitz(ipv4Tuple, false, rssKey, sizeof(rssKey)), 0x323e8fc2, hex);
+
+	FlowTuple ipv6Tuple;
+	memset(&ipv6Tuple, 0, sizeof(ipv6Tuple));
+	IPv6Address(std::string("3ffe:2501:200:1fff::7")).copyTo(ipv6Tuple.srcIP);
+	IPv6Address(std::string("3ffe:2501:200:3::1")).copyTo(ipv6Tuple.dstIP);
+	ipv6Tuple.srcPort = 2794;
+	ipv6Tuple.dstPort = 1766;
+	ipv6Tuple.protocol = PACKETPP_IPPROTO_TCP;
+	ipv6Tuple.ipVersion = 6;
+	PTF_ASSERT_EQUAL(FlowHash::hashToeplitz(ipv6Tuple, true, rssKey, sizeof(rssKey)), 0x40207d3d, hex);
+	PTF_ASSERT_EQUAL(FlowHash::hashToeplitz(ipv6Tuple, false, rssKey, sizeof(rssKey)), 0x2cc18cd5, hex);
+
+	// key too short for the input
+	PTF_ASSERT_EQUAL(FlowHash::hashToeplitz(ipv6Tuple, true, rssKey, 36), 0, u32);
+
+	// reverse direction tuples
+	FlowTuple ipv4ReverseTuple = ipv4Tuple;
+	memcpy(ipv4ReverseTuple.srcIP, ipv4Tuple.dstIP, 16);
+	memcpy(ipv4ReverseTuple.dstIP, ipv4Tuple.srcIP, 16);
+	ipv4ReverseTuple.srcPort = ipv4Tuple.dstPort;
+	ipv4ReverseTuple.dstPort = ipv4Tuple.srcPort;
+	FlowTuple ipv6ReverseTuple = ipv6Tuple;
+	memcpy(ipv6ReverseTuple.srcIP, ipv6Tuple.dstIP, 16);
+	memcpy(ipv6ReverseTuple.dstIP, ipv6Tuple.srcIP, 16);
+	ipv6ReverseTuple.srcPort = ipv6Tuple.dstPort;
+	ipv6ReverseTuple.dstPort = ipv6Tuple.srcPort;
+
+	// the default RSS key gives a symmetric Toeplitz hash
+	PTF_ASSERT_EQUAL(FlowHash::hashToeplitz(ipv4Tuple), FlowHash::hashToeplitz(ipv4ReverseTuple), hex);
+	PTF_ASSERT_EQUAL(FlowHash::hashToeplitz(ipv6Tuple), FlowHash::hashToeplitz(ipv6ReverseTuple), hex);
+
+	// CRC32C hashes
+	PTF_ASSERT(FlowHash::hash(ipv4Tuple) != FlowHash::hash(ipv4ReverseTuple), "Hash values are equal");
+	PTF_ASSERT(FlowHash::hash(ipv4Tuple) != FlowHash::hash(ipv4Tuple, 1), "Hash values are equal");
+	PTF_ASSERT_EQUAL(FlowHash::hashSymmetric(ipv4Tuple), FlowHash::hashSymmetric(ipv4ReverseTuple), hex);
+	PTF_ASSERT_EQUAL(FlowHash::hashSymmetric(ipv6Tuple, 7), FlowHash::hashSymmetric(ipv6ReverseTuple, 7), hex);
+	PTF_ASSERT(FlowHash::hashSymmetric(ipv4Tuple) != FlowHash::hashSymmetric(ipv6Tuple), "Hash values are equal");
+
+	// the hash value doesn't depend on the CPU or the platform
+	PTF_ASSERT_EQUAL(FlowHash::hash(ipv4Tuple), 0xed1d051c, hex);
+	PTF_ASSERT_EQUAL(FlowHash::hash(ipv6Tuple), 0x229884a0, hex);
+
+	// same port on both sides: the IP addresses decide the order
+	FlowTuple samePortTuple = ipv4Tuple;
+	samePortTuple.dstPort = samePortTuple.srcPort;
+	FlowTuple samePortReverseTuple = ipv4ReverseTuple;
+	samePortReverseTuple.srcPort = samePortReverseTuple.dstPort;
+	PTF_ASSERT_EQUAL(FlowHash::hashSymmetric(samePortTuple), FlowHash::hashSymmetric(samePortReverseTuple), hex);
+
+	// batch
+	FlowTuple tuples[] = { ipv4Tuple, ipv4ReverseTuple, ipv6Tuple, ipv6ReverseTuple, samePortTuple };
+	size_t numOfTuples = sizeof(tuples)/sizeof(tuples[0]);
+	uint32_t hashes[sizeof(tuples)/sizeof(tuples[0])];
+	FlowHash::hashBatch(tuples, numOfTuples, hashes, false, 3);
+	for (size_t i = 0; i < numOfTuples; i++)
+	{
+		PTF_ASSERT_EQUAL(hashes[i], FlowHash::hash(tuples[i], 3), hex);
+	}
+	FlowHash::hashBatch(tuples, numOfTuples, hashes, true);
+	for (size_t i = 0; i < numOfTuples; i++)
+	{
+		PTF_ASSERT_EQUAL(hashes[i], FlowHash::hashSymmetric(tuples[i]), hex);
+	}
+
+	// tuples from packets
+	timeval time;
+	gettimeofday(&time, NULL);
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TcpPacketWithOptions.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket tcpRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet tcpPacket(&tcpRawPacket);
+
+	PacketView view;
+	FlowTuple tcpTuple;
+	PTF_ASSERT_TRUE(FlowKeyExtractor::extract(&tcpRawPacket, view));
+	PTF_ASSERT_TRUE(FlowHash::getTuple(view, tcpTuple));
+	IPv4Layer* ipLayer = tcpPacket.getLayerOfType<IPv4Layer>();
+	TcpLayer* tcpLayer = tcpPacket.getLayerOfType<TcpLayer>();
+	PTF_ASSERT_NOT_NULL(ipLayer);
+	PTF_ASSERT_NOT_NULL(tcpLayer);
+	PTF_ASSERT_BUF_COMPARE(tcpTuple.srcIP, &ipLayer->getIPv4Header()->ipSrc, 4);
+	PTF_ASSERT_BUF_COMPARE(tcpTuple.dstIP, &ipLayer->getIPv4Header()->ipDst, 4);
+	PTF_ASSERT_EQUAL(tcpTuple.srcPort, tcpLayer->getSrcPort(), u16);
+	PTF_ASSERT_EQUAL(tcpTuple.dstPort, tcpLayer->getDstPort(), u16);
+	PTF_ASSERT_EQUAL(tcpTuple.protocol, PACKETPP_IPPROTO_TCP, u8);
+	PTF_ASSERT_EQUAL(tcpTuple.ipVersion, 4, u8);
+
+	buffer = readFileIntoBuffer("PacketExamples/IcmpPacket.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket icmpRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	FlowTuple icmpTuple;
+	FlowKeyExtractor::extract(&icmpRawPacket, view);
+	PTF_ASSERT_TRUE(FlowHash::getTuple(view, icmpTuple));
+	PTF_ASSERT_EQUAL(icmpTuple.srcPort, 0, u16);
+	PTF_ASSERT_EQUAL(icmpTuple.dstPort, 0, u16);
+	PTF_ASSERT_EQUAL(icmpTuple.protocol, PACKETPP_IPPROTO_ICMP, u8);
+
+	buffer = readFileIntoBuffer("PacketExamples/ArpRequestWithVlan.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket arpRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	FlowTuple arpTuple;
+	FlowKeyExtractor::extract(&arpRawPacket, view);
+	PTF_ASSERT_FALSE(FlowHash::getTuple(view, arpTuple));
+}
+
+PTF_TEST_CASE(TunnelDecapsulatorTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	// GTP-U with 2 extension headers, compared to the layers of the same packet
+	int buffer1Length = 0;
+	uint8_t* buffer1 = readFileIntoBuffer("PacketExamples/gtp-u-2ext.dat", buffer1Length);
+	PTF_ASSERT_NOT_NULL(buffer1);
+	RawPacket rawPacket1((const uint8_t*)buffer1, buffer1Length, time, true);
+	Packet gtpPacket(&rawPacket1);
+	GtpV1Layer* gtpLayer = gtpPacket.getLayerOfType<GtpV1Layer>();
+	PTF_ASSERT_NOT_NULL(gtpLayer);
+
+	TunnelInfo info;
+	PTF_ASSERT_TRUE(TunnelDecapsulator::decapsulate(&rawPacket1, info));
+	PTF_ASSERT_EQUAL(info.tunnelTypes, TunnelGTPU, u32);
+	PTF_ASSERT_EQUAL(info.numOfTunnels, 1, u8);
+	PTF_ASSERT_EQUAL(info.gtpTeid, be32toh(gtpLayer->getHeader()->teid), u32);
+	PTF_ASSERT_EQUAL(info.getTunnelId(), 1, u32);
+	PTF_ASSERT_EQUAL(info.innerLinkType, LINKTYPE_RAW, enum);
+	PTF_ASSERT_EQUAL((size_t)info.innerOffset, (size_t)(gtpLayer->getNextLayer()->getData() - rawPacket1.getRawData()), size);
+	PTF_ASSERT_EQUAL(info.innerView.ipVersion, 4, u8);
+	PTF_ASSERT_EQUAL(info.innerView.ipProtocol, PACKETPP_IPPROTO_ICMP, u8);
+	PTF_ASSERT_EQUAL(info.innerView.networkOffset, 0, u16);
+	PTF_ASSERT_EQUAL(info.innerView.getSrcIPv4Address().toString(), "202.11.40.158", string);
+
+	// the inner packet as a raw packet which points into the outer one
+	RawPacket innerRawPacket(NULL, 0, time, false);
+	PTF_ASSERT_TRUE(TunnelDecapsulator::setInnerRawData(rawPacket1, info, innerRawPacket));
+	PTF_ASSERT_TRUE(innerRawPacket.getRawData() == rawPacket1.getRawData() + info.innerOffset);
+	Packet innerPacket(&innerRawPacket);
+	PTF_ASSERT_EQUAL(innerPacket.getFirstLayer()->getProtocol(), IPv4, enum);
+	PTF_ASSERT_TRUE(innerPacket.isPacketOfType(ICMP));
+	PTF_ASSERT_FALSE(innerPacket.isPacketOfType(GTPv1));
+
+	// the tunnel ID is the hash seed
+	FlowTuple innerTuple;
+	PTF_ASSERT_TRUE(TunnelDecapsulator::getInnerTuple(info, innerTuple));
+	PTF_ASSERT_EQUAL(TunnelDecapsulator::hashInnerFlow(info), FlowHash::hash(innerTuple, 1), u32);
+	PTF_ASSERT_EQUAL(TunnelDecapsulator::hashInnerFlow(info, true, false), FlowHash::hashSymmetric(innerTuple), u32);
+
+	// GTP-U carrying IPv6
+	int buffer2Length = 0;
+	uint8_t* buffer2 = readFileIntoBuffer("PacketExamples/gtp-u-ipv6.dat", buffer2Length);
+	PTF_ASSERT_NOT_NULL(buffer2);
+	RawPacket rawPacket2((const uint8_t*)buffer2, buffer2Length, time, true);
+	PTF_ASSERT_TRUE(TunnelDecapsulator::decapsulate(&rawPacket2, info));
+	PTF_ASSERT_EQUAL(info.tunnelTypes, TunnelGTPU, u32);
+	PTF_ASSERT_EQUAL(info.gtpTeid, 2327461905UL, u32);
+	PTF_ASSERT_EQUAL(info.innerView.ipVersion, 6, u8);
+	PTF_ASSERT_EQUAL(info.innerView.srcPort, 53, u16);
+	PTF_ASSERT_EQUAL(info.innerView.dstPort, 2396, u16);
+
+	// GTP-C messages don't carry user packets, so the packet describes itself
+	int buffer3Length = 0;
+	uint8_t* buffer3 = readFileIntoBuffer("PacketExamples/gtp-c1.dat", buffer3Length);
+	PTF_ASSERT_NOT_NULL(buffer3);
+	RawPacket rawPacket3((const uint8_t*)buffer3, buffer3Length, time, true);
+	PTF_ASSERT_TRUE(TunnelDecapsulator::decapsulate(&rawPacket3, info));
+	PTF_ASSERT_EQUAL(info.tunnelTypes, TunnelNone, u32);
+	PTF_ASSERT_EQUAL(info.numOfTunnels, 0, u8);
+	PTF_ASSERT_EQUAL(info.innerOffset, 0, u16);
+	PTF_ASSERT_EQUAL(info.innerLinkType, LINKTYPE_ETHERNET, enum);
+	PTF_ASSERT_EQUAL(info.innerView.srcPort, 2123, u16);
+
+	// VXLAN
+	int buffer4Length = 0;
+	uint8_t* buffer4 = readFileIntoBuffer("PacketExamples/Vxlan1.dat", buffer4Length);
+	PTF_ASSERT_NOT_NULL(buffer4);
+	RawPacket rawPacket4((const uint8_t*)buffer4, buffer4Length, time, true);
+	Packet vxlanPacket(&rawPacket4);
+	VxlanLayer* vxlanLayer = vxlanPacket.getLayerOfType<VxlanLayer>();
+	PTF_ASSERT_NOT_NULL(vxlanLayer);
+	PTF_ASSERT_TRUE(TunnelDecapsulator::decapsulate(&rawPacket4, info));
+	PTF_ASSERT_EQUAL(info.tunnelTypes, TunnelVXLAN, u32);
+	PTF_ASSERT_EQUAL(info.vxlanVni, vxlanLayer->getVNI(), u32);
+	PTF_ASSERT_EQUAL(info.getTunnelId(), vxlanLayer->getVNI(), u32);
+	PTF_ASSERT_EQUAL(info.innerLinkType, LINKTYPE_ETHERNET, enum);
+	PTF_ASSERT_EQUAL((size_t)info.innerOffset, (size_t)(vxlanLayer->getNextLayer()->getData() - rawPacket4.getRawData()), size);
+	PTF_ASSERT_TRUE(info.innerView.isPacketOfType(Ethernet));
+	PTF_ASSERT_EQUAL(info.innerView.getDstIPv4Address().toString(), "192.168.203.5", string);
+
+	// GRE inside GRE
+	int buffer5Length = 0;
+	uint8_t* buffer5 = readFileIntoBuffer("PacketExamples/GREv0_2.dat", buffer5Length);
+	PTF_ASSERT_NOT_NULL(buffer5);
+	RawPacket rawPacket5((const uint8_t*)buffer5, buffer5Length, time, true);
+	PTF_ASSERT_TRUE(TunnelDecapsulator::decapsulate(&rawPacket5, info));
+	PTF_ASSERT_EQUAL(info.tunnelTypes, TunnelGRE, u32);
+	PTF_ASSERT_EQUAL(info.numOfTunnels, 2, u8);
+	PTF_ASSERT_FALSE(info.hasGreKey);
+	PTF_ASSERT_EQUAL(info.innerView.getSrcIPv4Address().toString(), "3.3.3.2", string);
+	PTF_ASSERT_EQUAL(info.innerView.dstPort, 520, u16);
+
+	// PPTP (GREv1) inside IPv4 inside IPv6: the GREv1 key is the call ID
+	int buffer6Length = 0;
+	uint8_t* buffer6 = readFileIntoBuffer("PacketExamples/GREv1_2.dat", buffer6Length);
+	PTF_ASSERT_NOT_NULL(buffer6);
+	RawPacket rawPacket6((const uint8_t*)buffer6, buffer6Length, time, true);
+	Packet greV1Packet(&rawPacket6);
+	GREv1Layer* greV1Layer = greV1Packet.getLayerOfType<GREv1Layer>();
+	PTF_ASSERT_NOT_NULL(greV1Layer);
+	PTF_ASSERT_TRUE(TunnelDecapsulator::decapsulate(&rawPacket6, info));
+	PTF_ASSERT_EQUAL(info.tunnelTypes, (uint32_t)(TunnelGRE | TunnelIPinIP), u32);
+	PTF_ASSERT_EQUAL(info.numOfTunnels, 2, u8);
+	PTF_ASSERT_TRUE(info.hasGreKey);
+	PTF_ASSERT_EQUAL(info.greKey, ntohs(greV1Layer->getGreHeader()->callID), u32);
+	PTF_ASSERT_EQUAL(info.innerView.getSrcIPv4Address().toString(), "8.8.8.8", string);
+	PTF_ASSERT_EQUAL(info.innerView.srcPort, 53, u16);
+
+	// an MPLS label in the link layer headers
+	int buffer7Length = 0;
+	uint8_t* buffer7 = readFileIntoBuffer("PacketExamples/MplsPackets1.dat", buffer7Length);
+	PTF_ASSERT_NOT_NULL(buffer7);
+	RawPacket rawPacket7((const uint8_t*)buffer7, buffer7Length, time, true);
+	PTF_ASSERT_TRUE(TunnelDecapsulator::decapsulate(&rawPacket7, info));
+	PTF_ASSERT_EQUAL(info.tunnelTypes, TunnelMPLS, u32);
+	PTF_ASSERT_EQUAL(info.mplsLabelCount, 1, u8);
+	PTF_ASSERT_EQUAL(info.mplsLabels[0], 16000, u32);
+	PTF_ASSERT_EQUAL(info.innerLinkType, LINKTYPE_RAW, enum);
+	PTF_ASSERT_EQUAL(info.innerView.networkOffset, 0, u16);
+	PTF_ASSERT_EQUAL(info.innerView.dstPort, 80, u16);
+
+	// truncated GTP-U: the extension headers exceed the data
+	PTF_ASSERT_TRUE(TunnelDecapsulator::decapsulate(buffer1, 58, LINKTYPE_ETHERNET, info));
+	PTF_ASSERT_EQUAL(info.tunnelTypes, TunnelNone, u32);
+	PTF_ASSERT_EQUAL(info.innerView.dstPort, 2152, u16);
+} // TunnelDecapsulatorTest
+
+
+struct FixedLRUListEvictionCounter
+{
+	int numOfEvictions;
+	uint32_t lastEvicted;
+};
+
+static void onFixedLRUListElementEvicted(const uint32_t& element, void* userCookie)
+{
+	FixedLRUListEvictionCounter* counter = (FixedLRUListEvictionCounter*)userCookie;
+	counter->numOfEvictions++;
+	counter->lastEvicted = element;
+}
+
+struct StringLRUHash
+{
+	uint32_t operator()(const std::string& element) const
+	{
+		return (uint32_t)element.length() * 31 + (element.empty() ? 0 : (uint32_t)element[0]);
+	}
+};
+
+PTF_TEST_CASE(FixedLRUListTest)
+{
+	FixedLRUListEvictionCounter counter;
+	counter.numOfEvictions = 0;
+	counter.lastEvicted = 0;
+
+	FixedLRUList<uint32_t> lruList(3, onFixedLRUListElementEvicted, &counter);
+	uint32_t evicted = 0;
+	PTF_ASSERT_FALSE(lruList.put(1, &evicted));
+	PTF_ASSERT_FALSE(lruList.put(2, &evicted));
+	PTF_ASSERT_FALSE(lruList.put(3, &evicted));
+	PTF_ASSERT_EQUAL(lruList.getSize(), 3, size);
+	PTF_ASSERT_EQUAL(lruList.getMRUElement(), 3, u32);
+	PTF_ASSERT_EQUAL(lruList.getLRUElement(), 1, u32);
+
+	// touching an existing element doesn't evict anything
+	PTF_ASSERT_FALSE(lruList.put(1, &evicted));
+	PTF_ASSERT_EQUAL(lruList.getMRUElement(), 1, u32);
+	PTF_ASSERT_EQUAL(lruList.getLRUElement(), 2, u32);
+
+	PTF_ASSERT_TRUE(lruList.put(4, &evicted));
+	PTF_ASSERT_EQUAL(evicted, 2, u32);
+	PTF_ASSERT_EQUAL(counter.numOfEvictions, 1, int);
+	PTF_ASSERT_EQUAL(counter.lastEvicted, 2, u32);
+	PTF_ASSERT_FALSE(lruList.contains(2));
+	PTF_ASSERT_TRUE(lruList.contains(4));
+	PTF_ASSERT_EQUAL(lruList.getSize(), 3, size);
+
+	PTF_ASSERT_TRUE(lruList.eraseElement(3));
+	PTF_ASSERT_FALSE(lruList.eraseElement(3));
+	PTF_ASSERT_EQUAL(lruList.getSize(), 2, size);
+	PTF_ASSERT_EQUAL(lruList.getLRUElement(), 1, u32);
+	PTF_ASSERT_FALSE(lruList.put(5));
+	PTF_ASSERT_TRUE(lruList.put(6));
+	PTF_ASSERT_EQUAL(counter.numOfEvictions, 2, int);
+	PTF_ASSERT_EQUAL(counter.lastEvicted, 1, u32);
+
+	lruList.clear();
+	PTF_ASSERT_EQUAL(lruList.getSize(), 0, size);
+	PTF_ASSERT_FALSE(lruList.contains(6));
+	PTF_ASSERT_FALSE(lruList.put(6));
+	PTF_ASSERT_EQUAL(lruList.getMRUElement(), 6, u32);
+
+	// a list with a max size of 0 evicts every element put in it, as LRUList does
+	FixedLRUList<uint32_t> emptyList(0);
+	PTF_ASSERT_TRUE(emptyList.put(7, &evicted));
+	PTF_ASSERT_EQUAL(evicted, 7, u32);
+	PTF_ASSERT_EQUAL(emptyList.getSize(), 0, size);
+
+	// elements with custom hash functors, with many collisions
+	FixedLRUList<std::string, StringLRUHash> stringList(2);
+	std::string evictedString;
+	stringList.put("abc");
+	stringList.put("acd");
+	PTF_ASSERT_TRUE(stringList.put("aef", &evictedString));
+	PTF_ASSERT_EQUAL(evictedString, "abc", string);
+	PTF_ASSERT_TRUE(stringList.contains("acd"));
+	PTF_ASSERT_TRUE(stringList.contains("aef"));
+	PTF_ASSERT_FALSE(stringList.contains("abc"));
+
+	// compare with LRUList on a long sequence of operations, with enough elements to make the hash table grow and wrap around
+	size_t maxSize = 1000;
+	FixedLRUList<uint32_t> fixedList(maxSize);
+	LRUList<uint32_t> referenceList(maxSize);
+	uint32_t seed = 12345;
+	for (int i = 0; i < 50000; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		uint32_t element = (seed >> 8) % 3000;
+		if ((seed & 0xff) < 40)
+		{
+			bool existed = fixedList.contains(element);
+			PTF_ASSERT_EQUAL(fixedList.eraseElement(element), existed, enum);
+			referenceList.eraseElement(element);
+		}
+		else
+		{
+			uint32_t fixedEvicted = 0;
+			bool fixedRes = fixedList.put(element, &fixedEvicted);
+			uint32_t* referenceEvicted = referenceList.put(element);
+			PTF_ASSERT_EQUAL(fixedRes, (referenceEvicted != NULL), enum);
+			if (referenceEvicted != NULL)
+			{
+				PTF_ASSERT_EQUAL(fixedEvicted, *referenceEvicted, u32);
+				delete referenceEvicted;
+			}
+		}
+
+		PTF_ASSERT_EQUAL(fixedList.getSize(), referenceList.getSize(), size);
+		if (fixedList.getSize() > 0)
+		{
+			PTF_ASSERT_EQUAL(fixedList.getMRUElement(), referenceList.getMRUElement(), u32);
+			PTF_ASSERT_EQUAL(fixedList.getLRUElement(), referenceList.getLRUElement(), u32);
+		}
+	}
+
+	fixedList.reserve(maxSize * 10);
+	PTF_ASSERT_EQUAL(fixedList.getSize(), referenceList.getSize(), size);
+	PTF_ASSERT_EQUAL(fixedList.getLRUElement(), referenceList.getLRUElement(), u32);
+}
+
+
+PTF_TEST_CASE(IPAddressValueTest)
+{
+	PTF_ASSERT_EQUAL(sizeof(IPAddressValue), 17, size);
+
+	IPAddressValue invalidAddr;
+	PTF_ASSERT_FALSE(invalidAddr.isValid());
+	PTF_ASSERT_EQUAL(invalidAddr.getLength(), 0, size);
+	PTF_ASSERT_EQUAL(invalidAddr.toString(), "", string);
+	PTF_ASSERT_FALSE(IPAddressValue::fromString("999.1.1.1").isValid());
+	PTF_ASSERT_FALSE(IPAddressValue(IPv4Address(std::string("999.1.1.1"))).isValid());
+	PTF_ASSERT_FALSE(IPAddressValue((const IPAddress*)NULL).isValid());
+
+	// IPv4
+	IPv4Address ip4Addr(std::string("10.0.200.255"));
+	IPAddressValue ip4Value(ip4Addr);
+	PTF_ASSERT_TRUE(ip4Value.isValid());
+	PTF_ASSERT_TRUE(ip4Value.isIPv4());
+	PTF_ASSERT_FALSE(ip4Value.isIPv6());
+	PTF_ASSERT_EQUAL(ip4Value.getType(), IPAddress::IPv4AddressType, enum);
+	PTF_ASSERT_EQUAL(ip4Value.getLength(), 4, size);
+	PTF_ASSERT_EQUAL(ip4Value.toIPv4Int(), ip4Addr.toInt(), u32);
+	PTF_ASSERT_EQUAL(ip4Value.toString(), "10.0.200.255", string);
+	PTF_ASSERT_TRUE(ip4Value.toIPv4Address() == ip4Addr);
+	PTF_ASSERT_TRUE(ip4Value == IPAddressValue::fromIPv4(ip4Addr.toInt()));
+	PTF_ASSERT_TRUE(ip4Value == IPAddressValue::fromString("10.0.200.255"));
+	PTF_ASSERT_TRUE(ip4Value == IPAddressValue((const IPAddress*)&ip4Addr));
+	PTF_ASSERT_EQUAL(ip4Value.toIPv6Address().isValid(), IPv6Address::Zero.isValid(), enum);
+
+	char buffer[MAX_ADDR_STRING_LEN];
+	PTF_ASSERT_EQUAL(ip4Value.toString(buffer, sizeof(buffer)), 12, size);
+	PTF_ASSERT_EQUAL(std::string(buffer), "10.0.200.255", string);
+	PTF_ASSERT_EQUAL(ip4Value.toString(buffer, 10), 0, size);
+
+	// the fast IPv4 formatting should match inet_ntop for all octet values
+	for (int i = 0; i < 256; i++)
+	{
+		uint8_t bytes[4] = { (uint8_t)i, (uint8_t)(255 - i), (uint8_t)(i / 3), (uint8_t)(i % 10) };
+		uint32_t addrAsInt;
+		memcpy(&addrAsInt, bytes, 4);
+		PTF_ASSERT_EQUAL(IPAddressValue::fromIPv4(addrAsInt).toString(), IPv4Address(addrAsInt).toString(), string);
+	}
+
+	// IPv6
+	IPv6Address ip6Addr(std::string("2001:db8::ff00:42:8329"));
+	IPAddressValue ip6Value(ip6Addr);
+	PTF_ASSERT_TRUE(ip6Value.isIPv6());
+	PTF_ASSERT_EQUAL(ip6Value.getType(), IPAddress::IPv6AddressType, enum);
+	PTF_ASSERT_EQUAL(ip6Value.getLength(), 16, size);
+	PTF_ASSERT_EQUAL(ip6Value.toString(), ip6Addr.toString(), string);
+	PTF_ASSERT_TRUE(ip6Value.toIPv6Address() == ip6Addr);
+	PTF_ASSERT_TRUE(ip6Value == IPAddressValue::fromString("2001:db8::ff00:42:8329"));
+	PTF_ASSERT_TRUE(ip6Value == IPAddressValue((const IPAddress*)&ip6Addr));
+	uint8_t ip6Bytes[16];
+	ip6Addr.copyTo(ip6Bytes);
+	PTF_ASSERT_BUF_COMPARE(ip6Value.getBytes(), ip6Bytes, 16);
+	PTF_ASSERT_TRUE(ip6Value == IPAddressValue::fromIPv6(ip6Bytes));
+	PTF_ASSERT_EQUAL(ip6Value.toIPv4Int(), 0, u32);
+
+	IPAddress::Ptr_t ip6Ptr = ip6Value.toIPAddress();
+	PTF_ASSERT_NOT_NULL(ip6Ptr.get());
+	PTF_ASSERT_TRUE(ip6Ptr->equals(&ip6Addr));
+	PTF_ASSERT_NULL(invalidAddr.toIPAddress().get());
+
+	// comparison, ordering and hashing
+	IPAddressValue ip4Value2 = IPAddressValue::fromString("10.0.201.0");
+	PTF_ASSERT_TRUE(ip4Value != ip4Value2);
+	PTF_ASSERT_TRUE(ip4Value < ip4Value2);
+	PTF_ASSERT_FALSE(ip4Value2 < ip4Value);
+	PTF_ASSERT_TRUE(ip4Value2 < ip6Value);
+	PTF_ASSERT_TRUE(invalidAddr < ip4Value);
+	PTF_ASSERT_TRUE(ip4Value != ip6Value);
+	PTF_ASSERT_EQUAL(ip4Value.hash(), IPAddressValue::fromIPv4(ip4Addr.toInt()).hash(), u32);
+	PTF_ASSERT(ip4Value.hash() != ip4Value2.hash(), "Hash values are equal");
+
+	std::map<IPAddressValue, int> addrMap;
+	addrMap[ip6Value] = 3;
+	addrMap[ip4Value2] = 2;
+	addrMap[ip4Value] = 1;
+	addrMap[IPAddressValue::fromString("10.0.200.255")] = 4;
+	PTF_ASSERT_EQUAL(addrMap.size(), 3, size);
+	PTF_ASSERT_EQUAL(addrMap.begin()->second, 4, int);
+
+	// IP layers
+	timeval time;
+	gettimeofday(&time, NULL);
+	int bufferLength = 0;
+	uint8_t* buffer4 = readFileIntoBuffer("PacketExamples/TcpPacketWithOptions.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer4);
+	RawPacket rawPacket4((const uint8_t*)buffer4, bufferLength, time, true);
+	Packet packet4(&rawPacket4);
+	IPv4Layer* ip4Layer = packet4.getLayerOfType<IPv4Layer>();
+	PTF_ASSERT_NOT_NULL(ip4Layer);
+	PTF_ASSERT_TRUE(ip4Layer->getSrcIpAddressValue() == IPAddressValue(ip4Layer->getSrcIpAddress()));
+	PTF_ASSERT_TRUE(ip4Layer->getDstIpAddressValue() == IPAddressValue(ip4Layer->getDstIpAddress()));
+
+	uint8_t* buffer6 = readFileIntoBuffer("PacketExamples/IPv6UdpPacket.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer6);
+	RawPacket rawPacket6((const uint8_t*)buffer6, bufferLength, time, true);
+	Packet packet6(&rawPacket6);
+	IPv6Layer* ip6Layer = packet6.getLayerOfType<IPv6Layer>();
+	PTF_ASSERT_NOT_NULL(ip6Layer);
+	PTF_ASSERT_TRUE(ip6Layer->getSrcIpAddressValue() == IPAddressValue(ip6Layer->getSrcIpAddress()));
+	PTF_ASSERT_EQUAL(ip6Layer->getDstIpAddressValue().toString(), ip6Layer->getDstIpAddress().toString(), string);
+}
+
+
+static void* asyncLoggerTestThread(void*)
+{
+	for (int i = 0; i < 50; i++)
+		LoggerPP::getInstance().logAsync(LoggerPP::Debug, "Async logging test message from a worker thread\n");
+
+	return NULL;
+}
+
+PTF_TEST_CASE(LoggerAsyncTest)
+{
+	LoggerPP& logger = LoggerPP::getInstance();
+	PTF_ASSERT_FALSE(LoggerPP::isAsyncLoggingEnabled());
+	PTF_ASSERT_TRUE(logger.startAsyncLogging(16, 60000));
+	PTF_ASSERT_TRUE(LoggerPP::isAsyncLoggingEnabled());
+
+	// identical messages are printed once, the rest are counted as repetitions
+	for (int i = 0; i < 100; i++)
+		logger.logAsync(LoggerPP::Debug, "Async logging test message\n");
+	PTF_ASSERT_EQUAL(logger.getNumOfSuppressedRepeats(), 99, size);
+
+	pthread_t worker;
+	PTF_ASSERT_EQUAL(pthread_create(&worker, NULL, asyncLoggerTestThread, NULL), 0, int);
+	pthread_join(worker, NULL);
+	PTF_ASSERT_EQUAL(logger.getNumOfDroppedMessages(), 0, size);
+
+	logger.stopAsyncLogging();
+	PTF_ASSERT_FALSE(LoggerPP::isAsyncLoggingEnabled());
+	PTF_ASSERT_EQUAL(logger.getNumOfSuppressedRepeats(), 148, size);
+} // LoggerAsyncTest
+
+
+PTF_TEST_CASE(RawPacketSlabVectorTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TcpPacketWithOptions.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+
+	RawPacketSlabVector slabVec(4096, 4);
+	PTF_ASSERT_EQUAL(slabVec.size(), 0, size);
+	PTF_ASSERT_EQUAL(slabVec.getMemoryUsage(), 0, size);
+
+	for (int i = 0; i < 10; i++)
+	{
+		RawPacket* rawPacket = slabVec.pushBack(buffer, bufferLength, time, LINKTYPE_ETHERNET, bufferLength + i);
+		PTF_ASSERT_NOT_NULL(rawPacket);
+		PTF_ASSERT_TRUE(rawPacket->getRawData() != buffer);
+		PTF_ASSERT_EQUAL(rawPacket->getFrameLength(), bufferLength + i, int);
+	}
+
+	PTF_ASSERT_EQUAL(slabVec.size(), 10, size);
+	PTF_ASSERT_EQUAL(slabVec.getDataSize(), 10 * (size_t)bufferLength, size);
+	PTF_ASSERT_EQUAL(slabVec.getMemoryUsage(), 3 * 4 * sizeof(RawPacket) + (10 * (size_t)bufferLength / (4096 / bufferLength * bufferLength) + 1) * 4096, size);
+
+	// raw packets of the same block are contiguous and data of the same slab is back-to-back
+	PTF_ASSERT_TRUE(slabVec.at(1) == slabVec.at(0) + 1);
+	PTF_ASSERT_TRUE(slabVec.at(3) == slabVec.at(2) + 1);
+	PTF_ASSERT_TRUE(slabVec.at(1)->getRawData() == slabVec.at(0)->getRawData() + bufferLength);
+
+	int packetCount = 0;
+	for (RawPacketSlabVector::ConstVectorIterator iter = slabVec.begin(); iter != slabVec.end(); iter++)
+	{
+		PTF_ASSERT_EQUAL((*iter)->getRawDataLen(), bufferLength, int);
+		PTF_ASSERT_BUF_COMPARE((*iter)->getRawData(), buffer, bufferLength);
+		packetCount++;
+	}
+	PTF_ASSERT_EQUAL(packetCount, 10, int);
+
+	// a packet which needs more space moves to a buffer of its own without affecting the other packets
+	Packet tcpPacket(slabVec.at(0));
+	PTF_ASSERT_TRUE(tcpPacket.isPacketOfType(TCP));
+	PayloadLayer payload((const uint8_t*)"abcd", 4, false);
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&payload));
+	PTF_ASSERT_EQUAL(slabVec.at(0)->getRawDataLen(), bufferLength + 4, int);
+	PTF_ASSERT_BUF_COMPARE(slabVec.at(1)->getRawData(), buffer, bufferLength);
+
+	// packets larger than the slab size get a slab of their own
+	uint8_t largeData[5000];
+	memset(largeData, 0xab, sizeof(largeData));
+	RawPacket largePacket(largeData, sizeof(largeData), time, false);
+	size_t memoryUsage = slabVec.getMemoryUsage();
+	RawPacket* largePacketCopy = slabVec.pushBack(largePacket);
+	PTF_ASSERT_NOT_NULL(largePacketCopy);
+	PTF_ASSERT_BUF_COMPARE(largePacketCopy->getRawData(), largeData, sizeof(largeData));
+	PTF_ASSERT_EQUAL(slabVec.getMemoryUsage(), memoryUsage + sizeof(largeData), size);
+
+	// clearing a raw packet which doesn't own its data doesn't free it
+	largePacket.clear();
+	PTF_ASSERT_FALSE(largePacket.isPacketSet());
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_NULL(slabVec.pushBack(largePacket));
+	PTF_ASSERT_NULL(slabVec.pushBack(NULL, 10, time));
+	LoggerPP::getInstance().enableErrors();
+
+	// clear() keeps the blocks and slabs for reuse (except for the large packet slab)
+	slabVec.clear();
+	PTF_ASSERT_EQUAL(slabVec.size(), 0, size);
+	PTF_ASSERT_EQUAL(slabVec.getDataSize(), 0, size);
+	PTF_ASSERT_EQUAL(slabVec.getMemoryUsage(), memoryUsage, size);
+	slabVec.reserve(20);
+	PTF_ASSERT_EQUAL(slabVec.getMemoryUsage(), memoryUsage + 2 * 4 * sizeof(RawPacket), size);
+	for (int i = 0; i < 10; i++)
+		PTF_ASSERT_NOT_NULL(slabVec.pushBack(buffer, bufferLength, time));
+	PTF_ASSERT_EQUAL(slabVec.getMemoryUsage(), memoryUsage + 2 * 4 * sizeof(RawPacket), size);
+
+	// memory allocated in advance is used regardless of the memory limit, packets which need more memory are dropped and counted
+	RawPacketSlabVector limitedVec(4096, 4);
+	limitedVec.reserve(8);
+	limitedVec.reserveData(2 * 4096);
+	size_t reservedMemory = limitedVec.getMemoryUsage();
+	PTF_ASSERT_EQUAL(reservedMemory, 2 * 4 * sizeof(RawPacket) + 2 * 4096, size);
+	limitedVec.setMemoryLimit(reservedMemory);
+	PTF_ASSERT_EQUAL(limitedVec.getMemoryLimit(), reservedMemory, size);
+	int expectedPackets = (2 * (4096 / bufferLength) < 8 ? 2 * (4096 / bufferLength) : 8);
+	int addedPackets = 0;
+	for (int i = 0; i < 20; i++)
+	{
+		if (limitedVec.pushBack(buffer, bufferLength, time) != NULL)
+			addedPackets++;
+	}
+	PTF_ASSERT_EQUAL(addedPackets, expectedPackets, int);
+	PTF_ASSERT_EQUAL((int)limitedVec.getNumOfDroppedPackets(), 20 - expectedPackets, int);
+	PTF_ASSERT_EQUAL(limitedVec.getMemoryUsage(), reservedMemory, size);
+
+	// clear() resets the drop counter, and without a limit the vector grows again
+	limitedVec.clear();
+	PTF_ASSERT_EQUAL((int)limitedVec.getNumOfDroppedPackets(), 0, int);
+	limitedVec.setMemoryLimit(0);
+	for (int i = 0; i < 20; i++)
+		PTF_ASSERT_NOT_NULL(limitedVec.pushBack(buffer, bufferLength, time));
+	PTF_ASSERT_TRUE(limitedVec.getMemoryUsage() > reservedMemory);
+
+	delete [] buffer;
+} // RawPacketSlabVectorTest
+
+
+PTF_TEST_CASE(CoreTopologyTest)
+{
+	PTF_ASSERT_EQUAL(createCoreMaskFromCpuList("0-3,8,10-11"), 0xD0F, hex);
+	PTF_ASSERT_EQUAL(createCoreMaskFromCpuList("5\n"), 0x20, hex);
+	PTF_ASSERT_EQUAL(createCoreMaskFromCpuList("30-40"), 0xC0000000, hex);
+	PTF_ASSERT_EQUAL(createCoreMaskFromCpuList(""), 0, hex);
+	PTF_ASSERT_EQUAL(createCoreMaskFromCpuList("3-1"), 0, hex);
+	PTF_ASSERT_EQUAL(createCoreMaskFromCpuList("1,a"), 0, hex);
+
+	CoreMask allCores = getCoreMaskForAllMachineCores();
+	PTF_ASSERT_TRUE(getNumOfNumaNodes() >= 1);
+	PTF_ASSERT_EQUAL(getCoreNumaNode(-1), -1, int);
+	PTF_ASSERT_EQUAL(getCoreNumaNode(MAX_NUM_OF_CORES), -1, int);
+	PTF_ASSERT_EQUAL(getSmtSiblingsCoreMask(MAX_NUM_OF_CORES), 0, hex);
+	PTF_ASSERT_EQUAL(getNumaNodeCoreMask(-1), 0, hex);
+	PTF_ASSERT_EQUAL(getPciDeviceNumaNode("ffff:ff:1f.7"), -1, int);
+	PTF_ASSERT_EQUAL(getNetworkInterfaceNumaNode("../cpu0"), -1, int);
+
+	// every core belongs to a node which contains it, and to an SMT siblings group which contains it
+	CoreMask coresOfAllNodes = 0;
+	for (int coreId = 0; coreId < getNumOfCores() && coreId < MAX_NUM_OF_CORES; coreId++)
+	{
+		CoreMask coreMask = SystemCores::IdToSystemCore[coreId].Mask;
+		int numaNode = getCoreNumaNode(coreId);
+		PTF_ASSERT_TRUE(numaNode >= 0);
+		PTF_ASSERT_TRUE((getNumaNodeCoreMask(numaNode) & coreMask) != 0);
+		PTF_ASSERT_TRUE((getSmtSiblingsCoreMask(coreId) & coreMask) != 0);
+		coresOfAllNodes |= getNumaNodeCoreMask(numaNode);
+	}
+	PTF_ASSERT_EQUAL(coresOfAllNodes, allCores, hex);
+
+	// cores of the requested node come first, and only one core of each physical core is selected while there are enough physical cores
+	int numaNode = getCoreNumaNode(0);
+	CoreMask nodeCores = getNumaNodeCoreMask(numaNode);
+	CoreMask selected = selectNumaLocalCores(numaNode, 1);
+	PTF_ASSERT_EQUAL(selected, 0x1, hex);
+	selected = selectNumaLocalCores(numaNode, 32);
+	PTF_ASSERT_EQUAL(selected, allCores, hex);
+	selected = selectNumaLocalCores(-1, 2, 0x5);
+	PTF_ASSERT_EQUAL(selected, 0x5, hex);
+	PTF_ASSERT_EQUAL(selectNumaLocalCores(numaNode, 4, 0), 0, hex);
+
+	int numOfPhysicalCores = 0;
+	CoreMask coveredBySiblings = 0;
+	for (int coreId = 0; coreId < MAX_NUM_OF_CORES; coreId++)
+	{
+		CoreMask coreMask = SystemCores::IdToSystemCore[coreId].Mask;
+		if (!(nodeCores & coreMask) || (coveredBySiblings & coreMask))
+			continue;
+
+		numOfPhysicalCores++;
+		coveredBySiblings |= getSmtSiblingsCoreMask(coreId);
+	}
+
+	selected = selectNumaLocalCores(numaNode, numOfPhysicalCores);
+	PTF_ASSERT_EQUAL((selected & ~nodeCores), 0, hex);
+	for (int coreId = 0; coreId < MAX_NUM_OF_CORES; coreId++)
+	{
+		if (selected & SystemCores::IdToSystemCore[coreId].Mask)
+			PTF_ASSERT_EQUAL((getSmtSiblingsCoreMask(coreId) & selected), SystemCores::IdToSystemCore[coreId].Mask, hex);
+	}
+} // CoreTopologyTest
+
+
+PTF_TEST_CASE(TimestampClockTest)
+{
+	// the clock agrees with the system clock and doesn't go backwards
+	timeval sysTime;
+	gettimeofday(&sysTime, NULL);
+	uint64_t sysTimeNs = (uint64_t)sysTime.tv_sec * 1000000000 + (uint64_t)sysTime.tv_usec * 1000;
+	uint64_t clockNs = TimestampClock::nowNs();
+	uint64_t diff = (clockNs > sysTimeNs ? clockNs - sysTimeNs : sysTimeNs - clockNs);
+	PTF_ASSERT_TRUE(diff < 50000000);
+
+	uint64_t prevNs = TimestampClock::nowNs();
+	for (int i = 0; i < 1000; i++)
+	{
+		uint64_t curNs = TimestampClock::nowNs();
+		PTF_ASSERT_TRUE(curNs >= prevNs);
+		prevNs = curNs;
+	}
+
+	timespec now = TimestampClock::now();
+	PTF_ASSERT_TRUE(now.tv_nsec >= 0 && now.tv_nsec < 1000000000);
+	PTF_ASSERT_EQUAL((TimestampClock::isTscBased()), (TimestampClock::getTscFrequency() > 0), object);
+
+	TimestampClock::recalibrate();
+	PTF_ASSERT_TRUE(TimestampClock::nowNs() >= prevNs);
+
+	timespec ts;
+	ts.tv_sec = 1500000000;
+	ts.tv_nsec = 123456789;
+	timeval tv = TimestampClock::toTimeval(ts);
+	PTF_ASSERT_EQUAL((int)tv.tv_usec, 123456, int);
+	PTF_ASSERT_EQUAL((long)TimestampClock::toTimespec(tv).tv_nsec, 123456000, object);
+
+	// raw packets keep nanoseconds, and the timeval API truncates them
+	uint8_t data[20];
+	memset(data, 0xaa, sizeof(data));
+	RawPacket rawPacket(data, sizeof(data), ts, false);
+	PTF_ASSERT_EQUAL((long)rawPacket.getPacketTimeStampNs().tv_nsec, 123456789, object);
+	PTF_ASSERT_EQUAL((int)rawPacket.getPacketTimeStamp().tv_usec, 123456, int);
+
+	RawPacket copy(rawPacket);
+	PTF_ASSERT_EQUAL((long)copy.getPacketTimeStampNs().tv_nsec, 123456789, object);
+
+	copy.setPacketTimeStamp(tv);
+	PTF_ASSERT_EQUAL((long)copy.getPacketTimeStampNs().tv_nsec, 123456000, object);
+
+	RawPacket copied;
+	PTF_ASSERT_TRUE(copied.copyRawData(data, sizeof(data), ts, NULL));
+	PTF_ASSERT_EQUAL((int)copied.getPacketTimeStampNs().tv_sec, 1500000000, int);
+	PTF_ASSERT_EQUAL((long)copied.getPacketTimeStampNs().tv_nsec, 123456789, object);
+
+	RawPacketSlabVector slabVec(64);
+	PTF_ASSERT_NOT_NULL(slabVec.pushBack(rawPacket));
+	PTF_ASSERT_EQUAL((long)slabVec.at(0)->getPacketTimeStampNs().tv_nsec, 123456789, object);
+
+	// a new packet is timestamped with the current time
+	Packet packet(100);
+	uint64_t packetNs = (uint64_t)packet.getRawPacket()->getPacketTimeStampNs().tv_sec * 1000000000 + (uint64_t)packet.getRawPacket()->getPacketTimeStampNs().tv_nsec;
+	PTF_ASSERT_TRUE(packetNs >= prevNs);
+} // TimestampClockTest
+
+
+PTF_TEST_CASE(AddressFormattingTest)
+{
+	char buffer[MAX_ADDR_STRING_LEN];
+	char expected[MAX_ADDR_STRING_LEN];
+
+	// the formatters and parsers agree with inet_ntop() and inet_pton()
+	uint8_t addr[16];
+	uint8_t parsed[16];
+	srand(1);
+	for (int i = 0; i < 2000; i++)
+	{
+		for (int j = 0; j < 16; j++)
+			addr[j] = (uint8_t)rand();
+
+		// create runs of zero groups and IPv4-mapped addresses
+		if (i % 2 == 0)
+		{
+			int start = (i / 2) % 14;
+			int len = 2 + (i / 4) % 12;
+			memset(addr + start, 0, (len < 16 - start ? len : 16 - start));
+		}
+		if (i % 50 == 0)
+		{
+			memset(addr, 0, 10);
+			addr[10] = addr[11] = (i % 100 == 0 ? 0xff : 0);
+		}
+
+		PTF_ASSERT_NOT_NULL(inet_ntop(AF_INET6, addr, expected, sizeof(expected)));
+		size_t len = format_ipv6_address(addr, buffer, sizeof(buffer));
+		PTF_ASSERT_EQUAL(std::string(buffer), std::string(expected), string);
+		PTF_ASSERT_EQUAL(len, strlen(expected), size);
+		PTF_ASSERT_TRUE(parse_ipv6_address(buffer, len, parsed));
+		PTF_ASSERT_BUF_COMPARE(parsed, addr, 16);
+
+		PTF_ASSERT_NOT_NULL(inet_ntop(AF_INET, addr, expected, sizeof(expected)));
+		len = format_ipv4_address(addr, buffer, sizeof(buffer));
+		PTF_ASSERT_EQUAL(std::string(buffer), std::string(expected), string);
+		PTF_ASSERT_TRUE(parse_ipv4_address(buffer, len, parsed));
+		PTF_ASSERT_BUF_COMPARE(parsed, addr, 4);
+	}
+
+	memset(addr, 0, sizeof(addr));
+	PTF_ASSERT_EQUAL(format_ipv6_address(addr, buffer, sizeof(buffer)), 2, size);
+	PTF_ASSERT_EQUAL(std::string(buffer), "::", string);
+	PTF_ASSERT_EQUAL(format_ipv6_address(addr, buffer, 39), 0, size);
+	PTF_ASSERT_EQUAL(format_ipv4_address(addr, buffer, 15), 0, size);
+
+	const char* ipv6Strings[] = { "::", "::1", "1::", "fe80::1:2", "2001:DB8:0:0:8:800:200C:417A", "::ffff:10.0.0.1", "::10.0.0.1",
+		"1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7::", "::2:3:4:5:6:7:8", "1:2:3:4:5:6:1.2.3.4", "1:2:3:4:5:6:7:8:9", "1:2:3:4:5:6:7", ":", ":::",
+		"1::2::3", "1:", ":1", "12345::", "1::g", "1:2:3:4:5:6:7:1.2.3.4", "::1.2.3", "::256.1.1.1", "1::2:", "", "::01.2.3.4" };
+	for (size_t i = 0; i < sizeof(ipv6Strings) / sizeof(ipv6Strings[0]); i++)
+	{
+		memset(addr, 0xaa, sizeof(addr));
+		memset(parsed, 0xaa, sizeof(parsed));
+		bool expectedResult = (inet_pton(AF_INET6, ipv6Strings[i], addr) == 1);
+		PTF_ASSERT_EQUAL(parse_ipv6_address(ipv6Strings[i], strlen(ipv6Strings[i]), parsed), expectedResult, object);
+		PTF_ASSERT_BUF_COMPARE(parsed, addr, 16);
+	}
+
+	const char* ipv4Strings[] = { "0.0.0.0", "255.255.255.255", "10.0.0.1", "256.0.0.1", "1.2.3", "1.2.3.4.5", "1.2.3.", ".1.2.3",
+		"01.2.3.4", "1.2.3.4 ", "1..2.3", "a.b.c.d", "" };
+	for (size_t i = 0; i < sizeof(ipv4Strings) / sizeof(ipv4Strings[0]); i++)
+	{
+		memset(addr, 0xaa, sizeof(addr));
+		memset(parsed, 0xaa, sizeof(parsed));
+		bool expectedResult = (inet_pton(AF_INET, ipv4Strings[i], addr) == 1);
+		PTF_ASSERT_EQUAL(parse_ipv4_address(ipv4Strings[i], strlen(ipv4Strings[i]), parsed), expectedResult, object);
+		PTF_ASSERT_BUF_COMPARE(parsed, addr, 4);
+	}
+
+	// strings don't have to be null-terminated
+	const char* text = "10.1.2.3,2001:db8::1";
+	PTF_ASSERT_TRUE(parse_ipv4_address(text, 8, parsed));
+	PTF_ASSERT_EQUAL(IPv4Address(*(uint32_t*)parsed), IPv4Address("10.1.2.3"), object);
+	IPAddressValue value = IPAddressValue::fromString(text + 9, 11);
+	PTF_ASSERT_TRUE(value.isIPv6());
+	PTF_ASSERT_EQUAL(value.toString(buffer, sizeof(buffer)), 11, size);
+	PTF_ASSERT_EQUAL(std::string(buffer), "2001:db8::1", string);
+	PTF_ASSERT_FALSE(IPAddressValue::fromString(text, 9).isValid());
+
+	IPv4Address ip4Addr("192.168.100.1");
+	PTF_ASSERT_EQUAL(ip4Addr.toString(buffer, sizeof(buffer)), 13, size);
+	PTF_ASSERT_EQUAL(std::string(buffer), "192.168.100.1", string);
+	PTF_ASSERT_EQUAL(ip4Addr.toString(buffer, 13), 0, size);
+	PTF_ASSERT_EQUAL(IPv4Address("1.2.3.256").toString(buffer, sizeof(buffer)), 0, size);
+
+	// MAC addresses
+	MacAddress macAddr(0x00, 0x1a, 0x2b, 0x3c, 0xd4, 0xef);
+	char macBuffer[MAX_MAC_STRING_LEN];
+	PTF_ASSERT_EQUAL(macAddr.toString(macBuffer, sizeof(macBuffer)), 17, size);
+	PTF_ASSERT_EQUAL(std::string(macBuffer), "00:1a:2b:3c:d4:ef", string);
+	PTF_ASSERT_EQUAL(macAddr.toString(macBuffer, sizeof(macBuffer) - 1), 0, size);
+	PTF_ASSERT_EQUAL(macAddr.toString(), "00:1a:2b:3c:d4:ef", string);
+
+	MacAddress parsedMac;
+	PTF_ASSERT_TRUE(MacAddress::parse("00:1A:2b:3C:d4:EF,", 17, parsedMac));
+	PTF_ASSERT_EQUAL(parsedMac, macAddr, object);
+	PTF_ASSERT_TRUE(MacAddress::parse("00-1a-2b-3c-d4-ef", 17, parsedMac));
+	PTF_ASSERT_EQUAL(parsedMac, macAddr, object);
+	PTF_ASSERT_FALSE(MacAddress::parse("00:1a-2b:3c:d4:ef", 17, parsedMac));
+	PTF_ASSERT_FALSE(MacAddress::parse("00:1a:2b:3c:d4:eg", 17, parsedMac));
+	PTF_ASSERT_FALSE(MacAddress::parse("00:1a:2b:3c:d4:ef", 16, parsedMac));
+	PTF_ASSERT_FALSE(MacAddress::parse("001a2b3cd4ef", 12, parsedMac));
+	PTF_ASSERT_EQUAL(parsedMac, macAddr, object);
+	PTF_ASSERT_TRUE(MacAddress("00-1a-2b-3c-d4-ef").isValid());
+	PTF_ASSERT_TRUE(MacAddress("00:1a:2b:3c:d4:ef:").isValid());
+	PTF_ASSERT_EQUAL(MacAddress("00.1a.2b.3c.d4.ef"), macAddr, object);
+	PTF_ASSERT_FALSE(MacAddress::parse("00.1a.2b.3c.d4.ef", 17, parsedMac));
+	PTF_ASSERT_FALSE(MacAddress("00:1a:2b:3c:d4:ef:0").isValid());
+	PTF_ASSERT_FALSE(MacAddress("00:1a:2b:3c:d4:e").isValid());
+} // AddressFormattingTest
+
+
+class TestStatsSink : public StatsSink
+{
+public:
+	std::vector<uint64_t> lastTotals;
+	std::vector<uint64_t> lastDeltas;
+	int numOfWrites;
+
+	TestStatsSink() : numOfWrites(0) {}
+
+	void write(const StatsSnapshot& snapshot)
+	{
+		lastTotals.assign(snapshot.totals, snapshot.totals + snapshot.counters->getNumOfCounters());
+		lastDeltas.assign(snapshot.deltas, snapshot.deltas + snapshot.counters->getNumOfCounters());
+		numOfWrites++;
+	}
+};
+
+struct StatsWorkerArgs
+{
+	StatsCounters* counters;
+	int workerId;
+};
+
+static void* statsWorkerMain(void* argsPtr)
+{
+	StatsWorkerArgs* args = (StatsWorkerArgs*)argsPtr;
+	for (int i = 0; i < 100000; i++)
+	{
+		args->counters->add(args->workerId, 0);
+		args->counters->add(args->workerId, 1, 64);
+	}
+	args->counters->set(args->workerId, 2, 7);
+	return NULL;
+}
+
+PTF_TEST_CASE(StatsReporterTest)
+{
+	std::vector<std::string> names;
+	names.push_back("packets");
+	names.push_back("bytes");
+	names.push_back("queue \"len\"");
+
+	StatsCounters counters(names, 2);
+	PTF_ASSERT_EQUAL(counters.getNumOfCounters(), 3, int);
+	PTF_ASSERT_EQUAL(counters.getNumOfWorkers(), 2, int);
+	PTF_ASSERT_EQUAL(counters.getCounterId("bytes"), 1, int);
+	PTF_ASSERT_EQUAL(counters.getCounterId("none"), -1, int);
+
+	StatsReporter reporter(counters);
+	TestStatsSink testSink;
+	reporter.addSink(&testSink);
+
+	// workers update their counters concurrently with a running reporter
+	PTF_ASSERT_TRUE(reporter.start(5));
+	PTF_ASSERT_TRUE(reporter.isRunning());
+	pthread_t threads[2];
+	StatsWorkerArgs args[2];
+	for (int i = 0; i < 2; i++)
+	{
+		args[i].counters = &counters;
+		args[i].workerId = i;
+		PTF_ASSERT_EQUAL(pthread_create(&threads[i], NULL, statsWorkerMain, &args[i]), 0, int);
+	}
+	for (int i = 0; i < 2; i++)
+		pthread_join(threads[i], NULL);
+
+	reporter.stop();
+	PTF_ASSERT_FALSE(reporter.isRunning());
+	PTF_ASSERT_TRUE(reporter.getNumOfReports() >= 1);
+	PTF_ASSERT_EQUAL((int)reporter.getNumOfReports(), testSink.numOfWrites, int);
+	PTF_ASSERT_EQUAL((size_t)testSink.lastTotals[0], 200000, size);
+	PTF_ASSERT_EQUAL((size_t)testSink.lastTotals[1], 200000 * 64, size);
+	PTF_ASSERT_EQUAL((size_t)testSink.lastTotals[2], 14, size);
+	PTF_ASSERT_EQUAL((size_t)counters.get(1, 0), 100000, size);
+
+	uint64_t totals[3];
+	counters.aggregate(totals);
+	PTF_ASSERT_EQUAL((size_t)totals[1], 200000 * 64, size);
+
+	// deltas are relative to the previous report
+	counters.add(0, 0, 5);
+	reporter.report();
+	PTF_ASSERT_EQUAL((size_t)testSink.lastDeltas[0], 5, size);
+	PTF_ASSERT_EQUAL((size_t)testSink.lastDeltas[1], 0, size);
+	counters.reset();
+	reporter.report();
+	PTF_ASSERT_EQUAL((size_t)testSink.lastTotals[0], 0, size);
+	PTF_ASSERT_EQUAL((size_t)testSink.lastDeltas[0], 0, size);
+
+	// CSV and JSON lines output
+	counters.add(1, 0, 3);
+	counters.add(0, 1, 192);
+	FILE* csvFile = tmpfile();
+	FILE* jsonFile = tmpfile();
+	PTF_ASSERT_NOT_NULL(csvFile);
+	PTF_ASSERT_NOT_NULL(jsonFile);
+	{
+		CsvStatsSink csvSink(csvFile);
+		JsonLinesStatsSink jsonSink(jsonFile);
+		StatsReporter fileReporter(counters);
+		fileReporter.addSink(&csvSink);
+		fileReporter.addSink(&jsonSink);
+		fileReporter.report();
+		fileReporter.report();
+	}
+
+	char line[512];
+	rewind(csvFile);
+	PTF_ASSERT_NOT_NULL(fgets(line, sizeof(line), csvFile));
+	PTF_ASSERT_EQUAL(std::string(line), "timestamp,packets,bytes,queue \"len\"\n", string);
+	PTF_ASSERT_NOT_NULL(fgets(line, sizeof(line), csvFile));
+	PTF_ASSERT_TRUE(strstr(line, ",3,192,0\n") != NULL);
+	PTF_ASSERT_NOT_NULL(fgets(line, sizeof(line), csvFile));
+	PTF_ASSERT_NULL(fgets(line, sizeof(line), csvFile));
+	fclose(csvFile);
+
+	rewind(jsonFile);
+	PTF_ASSERT_NOT_NULL(fgets(line, sizeof(line), jsonFile));
+	PTF_ASSERT_TRUE(strncmp(line, "{\"timestamp\":", 13) == 0);
+	PTF_ASSERT_TRUE(strstr(line, "\"totals\":{\"packets\":3,\"bytes\":192,\"queue \\\"len\\\"\":0},\"rates\":{\"packets\":") != NULL);
+	PTF_ASSERT_TRUE(strstr(line, "}}\n") != NULL);
+	PTF_ASSERT_NOT_NULL(fgets(line, sizeof(line), jsonFile));
+	PTF_ASSERT_TRUE(strstr(line, "\"rates\":{\"packets\":0.00,\"bytes\":0.00,\"queue \\\"len\\\"\":0.00}}") != NULL);
+	fclose(jsonFile);
+} // StatsReporterTest
+
+
+struct TcpReassemblyTableStats
+{
+	int numOfConnStarted;
+	int numOfConnEnded;
+	int numOfMessages;
+	std::vector<uint32_t> flowKeys;
+
+	TcpReassemblyTableStats() : numOfConnStarted(0), numOfConnEnded(0), numOfMessages(0) {}
+};
+
+static void tcpReassemblyTableMsgReady(int side, TcpStreamData tcpData, void* userCookie)
+{
+	((TcpReassemblyTableStats*)userCookie)->numOfMessages++;
+}
+
+static void tcpReassemblyTableConnStart(ConnectionData connectionData, void* userCookie)
+{
+	TcpReassemblyTableStats* stats = (TcpReassemblyTableStats*)userCookie;
+	stats->numOfConnStarted++;
+	stats->flowKeys.push_back(connectionData.flowKey);
+}
+
+static void tcpReassemblyTableConnEnd(ConnectionData connectionData, TcpReassembly::ConnectionEndReason reason, void* userCookie)
+{
+	((TcpReassemblyTableStats*)userCookie)->numOfConnEnded++;
+}
+
+// feed a data packet of connection number connIndex from the client side
+static void tcpReassemblyTableFeed(TcpReassembly& tcpReassembly, int connIndex, uint32_t sequence, bool fin)
+{
+	Packet packet(100);
+	EthLayer ethLayer(MacAddress("00:00:00:00:00:01"), MacAddress("00:00:00:00:00:02"), PCPP_ETHERTYPE_IP);
+	IPv4Layer ipLayer(IPv4Address((uint32_t)htonl(0x0a000000 + connIndex / 1000)), IPv4Address(std::string("10.1.1.1")));
+	ipLayer.getIPv4Header()->timeToLive = 64;
+	TcpLayer tcpLayer((uint16_t)(10000 + connIndex % 1000), (uint16_t)80);
+	tcpLayer.getTcpHeader()->sequenceNumber = htonl(sequence);
+	tcpLayer.getTcpHeader()->finFlag = (fin ? 1 : 0);
+	uint8_t data[10] = { 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j' };
+	PayloadLayer payloadLayer(data, sizeof(data), false);
+	packet.addLayer(&ethLayer);
+	packet.addLayer(&ipLayer);
+	packet.addLayer(&tcpLayer);
+	packet.addLayer(&payloadLayer);
+	packet.computeCalculateFields();
+	tcpReassembly.reassemblePacket(packet);
+}
+
+PTF_TEST_CASE(TcpReassemblyConnectionTableTest)
+{
+	const int numOfConns = 3000;
+	TcpReassemblyTableStats stats;
+	// the packets are timestamped with the current time, so use a delay the test doesn't reach by itself
+	TcpReassemblyConfiguration config(true, 10, 0xFFFFFFFF);
+	TcpReassembly tcpReassembly(tcpReassemblyTableMsgReady, &stats, tcpReassemblyTableConnStart, tcpReassemblyTableConnEnd, config);
+
+	// enough connections for the table to be rehashed several times and span a few entry blocks
+	for (int i = 0; i < numOfConns; i++)
+		tcpReassemblyTableFeed(tcpReassembly, i, 1000, false);
+	for (int i = 0; i < numOfConns; i++)
+		tcpReassemblyTableFeed(tcpReassembly, i, 1010, false);
+
+	PTF_ASSERT_EQUAL(stats.numOfConnStarted, numOfConns, int);
+	PTF_ASSERT_EQUAL(stats.numOfMessages, 2 * numOfConns, int);
+
+	const TcpReassembly::ConnectionInfoList& connections = tcpReassembly.getConnectionInformation();
+	PTF_ASSERT_EQUAL(connections.size(), (size_t)numOfConns, size);
+	PTF_ASSERT_FALSE(connections.empty());
+
+	// every connection is found by its flow key and iterating visits each one once
+	std::map<uint32_t, int> visited;
+	for (TcpReassembly::ConnectionInfoList::const_iterator iter = connections.begin(); iter != connections.end(); iter++)
+	{
+		PTF_ASSERT_EQUAL(iter->first, iter->second.flowKey, u32);
+		visited[iter->first]++;
+	}
+	PTF_ASSERT_EQUAL(visited.size(), (size_t)numOfConns, size);
+
+	for (int i = 0; i < numOfConns; i++)
+	{
+		TcpReassembly::ConnectionInfoList::const_iterator iter = connections.find(stats.flowKeys[i]);
+		PTF_ASSERT_TRUE(iter != connections.end());
+		PTF_ASSERT_EQUAL(iter->second.dstPort, 80, size);
+		PTF_ASSERT_EQUAL(iter->second.srcPort, (size_t)(10000 + i % 1000), size);
+		PTF_ASSERT_EQUAL(visited[stats.flowKeys[i]], 1, int);
+		PTF_ASSERT_TRUE(tcpReassembly.isConnectionOpen(iter->second) > 0);
+	}
+
+	ConnectionData dummyConn;
+	dummyConn.flowKey = 0x12345678;
+	if (connections.count(dummyConn.flowKey) == 0)
+	{
+		PTF_ASSERT_TRUE(connections.find(dummyConn.flowKey) == connections.end());
+		PTF_ASSERT_TRUE(tcpReassembly.isConnectionOpen(dummyConn) < 0);
+	}
+
+	// close every other connection manually and by FIN packets
+	for (int i = 0; i < numOfConns; i += 4)
+		tcpReassembly.closeConnection(stats.flowKeys[i]);
+	for (int i = 2; i < numOfConns; i += 4)
+	{
+		tcpReassemblyTableFeed(tcpReassembly, i, 1020, true);
+		ConnectionData reverse = connections.find(stats.flowKeys[i])->second;
+		Packet packet(100);
+		EthLayer ethLayer(MacAddress("00:00:00:00:00:02"), MacAddress("00:00:00:00:00:01"), PCPP_ETHERTYPE_IP);
+		IPv4Layer ipLayer(reverse.dstIP.toIPv4Address(), reverse.srcIP.toIPv4Address());
+		TcpLayer tcpLayer((uint16_t)80, (uint16_t)reverse.srcPort);
+		tcpLayer.getTcpHeader()->finFlag = 1;
+		packet.addLayer(&ethLayer);
+		packet.addLayer(&ipLayer);
+		packet.addLayer(&tcpLayer);
+		packet.computeCalculateFields();
+		tcpReassembly.reassemblePacket(packet);
+	}
+	PTF_ASSERT_EQUAL(stats.numOfConnEnded, numOfConns / 2, int);
+	PTF_ASSERT_EQUAL(connections.size(), (size_t)numOfConns, size);
+
+	for (int i = 0; i < numOfConns; i++)
+	{
+		int isOpen = tcpReassembly.isConnectionOpen(connections.find(stats.flowKeys[i])->second);
+		PTF_ASSERT_EQUAL(isOpen, (i % 2 == 0 ? 0 : 1), int);
+	}
+
+	// data of closed connections is ignored, new connections reuse the pooled reassembly data
+	int prevNumOfMessages = stats.numOfMessages;
+	tcpReassemblyTableFeed(tcpReassembly, 0, 1020, false);
+	PTF_ASSERT_EQUAL(stats.numOfMessages, prevNumOfMessages, int);
+	tcpReassemblyTableFeed(tcpReassembly, numOfConns, 1000, false);
+	PTF_ASSERT_EQUAL(stats.numOfConnStarted, numOfConns + 1, int);
+	PTF_ASSERT_EQUAL(stats.numOfMessages, prevNumOfMessages + 1, int);
+
+	// a copy is a snapshot that stays valid after purging
+	TcpReassembly::ConnectionInfoList snapshot = connections;
+	PTF_ASSERT_EQUAL(snapshot.size(), (size_t)(numOfConns + 1), size);
+
+	// closed connections are cleaned up automatically once their delay passes in packet time
+	timeval afterDelay = TimestampClock::nowTimeval();
+	afterDelay.tv_sec += 11;
+	tcpReassembly.advanceTime(afterDelay);
+	PTF_ASSERT_EQUAL(connections.size(), (size_t)(numOfConns / 2 + 1), size);
+	PTF_ASSERT_EQUAL(tcpReassembly.purgeClosedConnections(), 0, u32);
+	PTF_ASSERT_EQUAL(snapshot.size(), (size_t)(numOfConns + 1), size);
+
+	for (int i = 0; i < numOfConns; i++)
+	{
+		PTF_ASSERT_TRUE(snapshot.find(stats.flowKeys[i]) != snapshot.end());
+		TcpReassembly::ConnectionInfoList::const_iterator iter = connections.find(stats.flowKeys[i]);
+		if (i % 2 == 0)
+		{
+			PTF_ASSERT_TRUE(iter == connections.end());
+		}
+		else
+		{
+			PTF_ASSERT_TRUE(iter != connections.end());
+			PTF_ASSERT_EQUAL(iter->second.flowKey, stats.flowKeys[i], u32);
+		}
+	}
+
+	// a purged connection which is seen again is a new connection
+	tcpReassemblyTableFeed(tcpReassembly, 0, 2000, false);
+	PTF_ASSERT_EQUAL(stats.numOfConnStarted, numOfConns + 2, int);
+	PTF_ASSERT_TRUE(connections.find(stats.flowKeys[0]) != connections.end());
+
+	tcpReassembly.closeAllConnections();
+	PTF_ASSERT_EQUAL(stats.numOfConnEnded, numOfConns / 2 + numOfConns / 2 + 2, int);
+	for (TcpReassembly::ConnectionInfoList::const_iterator iter = connections.begin(); iter != connections.end(); ++iter)
+		PTF_ASSERT_EQUAL(tcpReassembly.isConnectionOpen(iter->second), 0, int);
+}
+
+
+struct TcpReassemblyZeroCopyStats
+{
+	std::string reassembledData;
+	std::vector<const uint8_t*> dataPointers;
+	TcpStreamData* firstMessage;
+
+	TcpReassemblyZeroCopyStats() : firstMessage(NULL) {}
+};
+
+static void tcpReassemblyZeroCopyMsgReady(int side, const TcpStreamData& tcpData, void* userCookie)
+{
+	TcpReassemblyZeroCopyStats* stats = (TcpReassemblyZeroCopyStats*)userCookie;
+	stats->reassembledData += std::string((char*)tcpData.getData(), tcpData.getDataLength());
+	stats->dataPointers.push_back(tcpData.getData());
+	if (stats->firstMessage == NULL)
+		stats->firstMessage = new TcpStreamData(tcpData);
+}
+
+static void tcpReassemblyCopyMsgReady(int side, TcpStreamData tcpData, void* userCookie)
+{
+	TcpReassemblyZeroCopyStats* stats = (TcpReassemblyZeroCopyStats*)userCookie;
+	stats->reassembledData += std::string((char*)tcpData.getData(), tcpData.getDataLength());
+	stats->dataPointers.push_back(tcpData.getData());
+}
+
+// create a raw packet of a connection between 10.0.0.1:clientPort and 10.0.0.2:80 (2001:db8::1 and 2001:db8::2 if ipv6 is set), sent by
+// the client or by the server. The TCP flags are a string of 'S' (SYN), 'A' (ACK), 'P' (PSH), 'R' (RST) and 'F' (FIN)
+static RawPacket* tcpReassemblyZeroCopyCreatePacket(uint32_t sequence, const char* data, uint16_t clientPort = 12345, bool fromServer = false,
+		const char* flags = "", uint32_t ackNumber = 0, bool ipv6 = false)
+{
+	Packet packet(100);
+	EthLayer ethLayer(MacAddress("00:00:00:00:00:01"), MacAddress("00:00:00:00:00:02"), ipv6 ? PCPP_ETHERTYPE_IPV6 : PCPP_ETHERTYPE_IP);
+	IPv4Address clientIPv4(std::string("10.0.0.1"));
+	IPv4Address serverIPv4(std::string("10.0.0.2"));
+	IPv6Address clientIPv6(std::string("2001:db8::1"));
+	IPv6Address serverIPv6(std::string("2001:db8::2"));
+	IPv4Layer ipv4Layer(fromServer ? serverIPv4 : clientIPv4, fromServer ? clientIPv4 : serverIPv4);
+	ipv4Layer.getIPv4Header()->timeToLive = 64;
+	IPv6Layer ipv6Layer(fromServer ? serverIPv6 : clientIPv6, fromServer ? clientIPv6 : serverIPv6);
+	ipv6Layer.getIPv6Header()->hopLimit = 64;
+	TcpLayer tcpLayer(fromServer ? (uint16_t)80 : clientPort, fromServer ? clientPort : (uint16_t)80);
+	tcphdr* tcpHeader = tcpLayer.getTcpHeader();
+	tcpHeader->sequenceNumber = htonl(sequence);
+	tcpHeader->ackNumber = htonl(ackNumber);
+	tcpHeader->synFlag = (strchr(flags, 'S') != NULL);
+	tcpHeader->ackFlag = (strchr(flags, 'A') != NULL);
+	tcpHeader->pshFlag = (strchr(flags, 'P') != NULL);
+	tcpHeader->rstFlag = (strchr(flags, 'R') != NULL);
+	tcpHeader->finFlag = (strchr(flags, 'F') != NULL);
+	PayloadLayer payloadLayer((const uint8_t*)data, strlen(data), false);
+	packet.addLayer(&ethLayer);
+	if (ipv6)
+		packet.addLayer(&ipv6Layer);
+	else
+		packet.addLayer(&ipv4Layer);
+	packet.addLayer(&tcpLayer);
+	if (strlen(data) > 0)
+		packet.addLayer(&payloadLayer);
+	packet.computeCalculateFields();
+	return new RawPacket(*packet.getRawPacket());
+}
+
+PTF_TEST_CASE(TcpReassemblyZeroCopyTest)
+{
+	// the second packet arrives after the third, so it's delivered from the stored out-of-order fragment
+	RawPacket* rawPackets[3];
+	rawPackets[0] = tcpReassemblyZeroCopyCreatePacket(1000, "abcd");
+	rawPackets[1] = tcpReassemblyZeroCopyCreatePacket(1008, "ijkl");
+	rawPackets[2] = tcpReassemblyZeroCopyCreatePacket(1004, "efgh");
+	const size_t payloadOffset = sizeof(ether_header) + sizeof(iphdr) + sizeof(tcphdr);
+
+	TcpReassemblyZeroCopyStats zeroCopyStats;
+	TcpReassembly zeroCopyReassembly(tcpReassemblyZeroCopyMsgReady, &zeroCopyStats);
+	for (int i = 0; i < 3; i++)
+		zeroCopyReassembly.reassemblePacket(rawPackets[i]);
+
+	PTF_ASSERT_EQUAL(zeroCopyStats.reassembledData, "abcdefghijkl", string);
+	PTF_ASSERT_EQUAL(zeroCopyStats.dataPointers.size(), 3, size);
+	// in-order data points directly to the packets' payload, the out-of-order data was copied when it was stored
+	PTF_ASSERT_TRUE(zeroCopyStats.dataPointers[0] == rawPackets[0]->getRawData() + payloadOffset);
+	PTF_ASSERT_TRUE(zeroCopyStats.dataPointers[1] == rawPackets[2]->getRawData() + payloadOffset);
+	PTF_ASSERT_TRUE(zeroCopyStats.dataPointers[2] != rawPackets[1]->getRawData() + payloadOffset);
+
+	// the copying callback gets the same data in buffers of its own
+	TcpReassemblyZeroCopyStats copyStats;
+	TcpReassembly copyReassembly(tcpReassemblyCopyMsgReady, &copyStats);
+	for (int i = 0; i < 3; i++)
+		copyReassembly.reassemblePacket(rawPackets[i]);
+
+	PTF_ASSERT_EQUAL(copyStats.reassembledData, "abcdefghijkl", string);
+	PTF_ASSERT_EQUAL(copyStats.dataPointers.size(), 3, size);
+	PTF_ASSERT_TRUE(copyStats.dataPointers[0] != rawPackets[0]->getRawData() + payloadOffset);
+
+	// the copy taken in the zero-copy callback owns its buffer and stays valid
+	PTF_ASSERT_NOT_NULL(zeroCopyStats.firstMessage);
+	PTF_ASSERT_TRUE(zeroCopyStats.firstMessage->getData() != zeroCopyStats.dataPointers[0]);
+	PTF_ASSERT_EQUAL(zeroCopyStats.firstMessage->getDataLength(), 4, size);
+	PTF_ASSERT_BUF_COMPARE(zeroCopyStats.firstMessage->getData(), "abcd", 4);
+	delete zeroCopyStats.firstMessage;
+
+	for (int i = 0; i < 3; i++)
+		delete rawPackets[i];
+}
+
+
+static void tcpReassemblyFeedAndDelete(TcpReassembly& tcpReassembly, RawPacket* rawPacket)
+{
+	tcpReassembly.reassemblePacket(rawPacket);
+	delete rawPacket;
+}
+
+static void tcpReassemblySetPacketTime(RawPacket* rawPacket, time_t packetTime)
+{
+	timeval timestamp;
+	timestamp.tv_sec = packetTime;
+	timestamp.tv_usec = 0;
+	rawPacket->setPacketTimeStamp(timestamp);
+}
+
+// feed a packet with a timestamp of packetTime seconds
+static void tcpReassemblyFeedAndDelete(TcpReassembly& tcpReassembly, RawPacket* rawPacket, time_t packetTime)
+{
+	tcpReassemblySetPacketTime(rawPacket, packetTime);
+	tcpReassemblyFeedAndDelete(tcpReassembly, rawPacket);
+}
+
+PTF_TEST_CASE(TcpReassemblyOutOfOrderTest)
+{
+	// heavy reordering: all segments after the first arrive in reverse order
+	std::string expectedData;
+	TcpReassemblyZeroCopyStats reorderStats;
+	TcpReassembly reorderReassembly(tcpReassemblyZeroCopyMsgReady, &reorderStats);
+	const int numOfSegments = 500;
+	char segment[5];
+	for (int i = 0; i < numOfSegments; i++)
+	{
+		snprintf(segment, sizeof(segment), "%04d", i);
+		expectedData += segment;
+	}
+	tcpReassemblyFeedAndDelete(reorderReassembly, tcpReassemblyZeroCopyCreatePacket(1000, "0000"));
+	for (int i = numOfSegments - 1; i > 0; i--)
+	{
+		snprintf(segment, sizeof(segment), "%04d", i);
+		tcpReassemblyFeedAndDelete(reorderReassembly, tcpReassemblyZeroCopyCreatePacket(1000 + 4 * i, segment));
+		if (i > 1)
+			PTF_ASSERT_EQUAL(reorderReassembly.getOutOfOrderBytes(), (size_t)(4 * (numOfSegments - i)), size);
+	}
+	PTF_ASSERT_EQUAL(reorderStats.reassembledData, expectedData, string);
+	PTF_ASSERT_EQUAL(reorderStats.dataPointers.size(), (size_t)numOfSegments, size);
+	PTF_ASSERT_EQUAL(reorderReassembly.getOutOfOrderBytes(), 0, size);
+	delete reorderStats.firstMessage;
+
+	// a retransmitted out-of-order segment replaces the queued one only if it's longer, and data already seen is dropped
+	TcpReassemblyZeroCopyStats retransmitStats;
+	TcpReassembly retransmitReassembly(tcpReassemblyZeroCopyMsgReady, &retransmitStats);
+	tcpReassemblyFeedAndDelete(retransmitReassembly, tcpReassemblyZeroCopyCreatePacket(1000, "abcd"));
+	tcpReassemblyFeedAndDelete(retransmitReassembly, tcpReassemblyZeroCopyCreatePacket(1008, "ij"));
+	tcpReassemblyFeedAndDelete(retransmitReassembly, tcpReassemblyZeroCopyCreatePacket(1008, "ijkl"));
+	tcpReassemblyFeedAndDelete(retransmitReassembly, tcpReassemblyZeroCopyCreatePacket(1008, "ijk"));
+	PTF_ASSERT_EQUAL(retransmitReassembly.getOutOfOrderBytes(), 4, size);
+	tcpReassemblyFeedAndDelete(retransmitReassembly, tcpReassemblyZeroCopyCreatePacket(1010, "klmn"));
+	PTF_ASSERT_EQUAL(retransmitReassembly.getOutOfOrderBytes(), 8, size);
+	tcpReassemblyFeedAndDelete(retransmitReassembly, tcpReassemblyZeroCopyCreatePacket(1004, "efgh"));
+	PTF_ASSERT_EQUAL(retransmitStats.reassembledData, "abcdefghijklmn", string);
+	PTF_ASSERT_EQUAL(retransmitReassembly.getOutOfOrderBytes(), 0, size);
+	delete retransmitStats.firstMessage;
+
+	// the per-connection limit: when it's exceeded the queued data is sent as if the data before it is missing
+	TcpReassemblyZeroCopyStats connLimitStats;
+	TcpReassembly connLimitReassembly(tcpReassemblyZeroCopyMsgReady, &connLimitStats, NULL, NULL, TcpReassemblyConfiguration(true, 5, 30, 8, 0));
+	tcpReassemblyFeedAndDelete(connLimitReassembly, tcpReassemblyZeroCopyCreatePacket(1000, "abcd"));
+	tcpReassemblyFeedAndDelete(connLimitReassembly, tcpReassemblyZeroCopyCreatePacket(1008, "ijkl"));
+	tcpReassemblyFeedAndDelete(connLimitReassembly, tcpReassemblyZeroCopyCreatePacket(1012, "mnop"));
+	PTF_ASSERT_EQUAL(connLimitReassembly.getOutOfOrderBytes(), 8, size);
+	PTF_ASSERT_EQUAL(connLimitStats.reassembledData, "abcd", string);
+	tcpReassemblyFeedAndDelete(connLimitReassembly, tcpReassemblyZeroCopyCreatePacket(1016, "qrst"));
+	PTF_ASSERT_EQUAL(connLimitReassembly.getOutOfOrderBytes(), 0, size);
+	PTF_ASSERT_EQUAL(connLimitStats.reassembledData, "abcd[4 bytes missing]ijklmnopqrst", string);
+	// the missing data arrives too late and is ignored, data after it is in order
+	tcpReassemblyFeedAndDelete(connLimitReassembly, tcpReassemblyZeroCopyCreatePacket(1004, "efgh"));
+	tcpReassemblyFeedAndDelete(connLimitReassembly, tcpReassemblyZeroCopyCreatePacket(1020, "uvwx"));
+	PTF_ASSERT_EQUAL(connLimitStats.reassembledData, "abcd[4 bytes missing]ijklmnopqrstuvwx", string);
+	delete connLimitStats.firstMessage;
+
+	// the global limit: only the connection which exceeds it is affected
+	TcpReassemblyZeroCopyStats globalLimitStats;
+	TcpReassembly globalLimitReassembly(tcpReassemblyZeroCopyMsgReady, &globalLimitStats, NULL, NULL, TcpReassemblyConfiguration(true, 5, 30, 0, 6));
+	tcpReassemblyFeedAndDelete(globalLimitReassembly, tcpReassemblyZeroCopyCreatePacket(1000, "abcd", 1111));
+	tcpReassemblyFeedAndDelete(globalLimitReassembly, tcpReassemblyZeroCopyCreatePacket(2000, "ABCD", 2222));
+	tcpReassemblyFeedAndDelete(globalLimitReassembly, tcpReassemblyZeroCopyCreatePacket(1008, "ijkl", 1111));
+	PTF_ASSERT_EQUAL(globalLimitReassembly.getOutOfOrderBytes(), 4, size);
+	tcpReassemblyFeedAndDelete(globalLimitReassembly, tcpReassemblyZeroCopyCreatePacket(2008, "IJKL", 2222));
+	PTF_ASSERT_EQUAL(globalLimitReassembly.getOutOfOrderBytes(), 4, size);
+	PTF_ASSERT_EQUAL(globalLimitStats.reassembledData, "abcdABCD[4 bytes missing]IJKL", string);
+	tcpReassemblyFeedAndDelete(globalLimitReassembly, tcpReassemblyZeroCopyCreatePacket(1004, "efgh", 1111));
+	PTF_ASSERT_EQUAL(globalLimitReassembly.getOutOfOrderBytes(), 0, size);
+	PTF_ASSERT_EQUAL(globalLimitStats.reassembledData, "abcdABCD[4 bytes missing]IJKLefghijkl", string);
+	delete globalLimitStats.firstMessage;
+
+	// queued fragments of connections which are still open are freed with the instance
+	TcpReassemblyZeroCopyStats openStats;
+	TcpReassembly* openReassembly = new TcpReassembly(tcpReassemblyZeroCopyMsgReady, &openStats);
+	tcpReassemblyFeedAndDelete(*openReassembly, tcpReassemblyZeroCopyCreatePacket(1000, "abcd"));
+	tcpReassemblyFeedAndDelete(*openReassembly, tcpReassemblyZeroCopyCreatePacket(1008, "ijkl"));
+	std::string largeSegment(3000, 'x');
+	tcpReassemblyFeedAndDelete(*openReassembly, tcpReassemblyZeroCopyCreatePacket(1100, largeSegment.c_str()));
+	PTF_ASSERT_EQUAL(openReassembly->getOutOfOrderBytes(), 3004, size);
+	delete openReassembly;
+	delete openStats.firstMessage;
+}
+
+
+struct TcpSegmentCoalescerStats
+{
+	// the data of each side of each connection, so the order of the connections doesn't matter
+	std::map<std::pair<uint32_t, int>, std::string> data;
+	int numOfMessages;
+
+	TcpSegmentCoalescerStats() : numOfMessages(0) {}
+};
+
+static void tcpSegmentCoalescerMsgReady(int side, const TcpStreamData& tcpData, void* userCookie)
+{
+	TcpSegmentCoalescerStats* stats = (TcpSegmentCoalescerStats*)userCookie;
+	stats->data[std::make_pair(tcpData.getConnectionDataRef().flowKey, side)] += std::string((char*)tcpData.getData(), tcpData.getDataLength());
+	stats->numOfMessages++;
+}
+
+PTF_TEST_CASE(TcpSegmentCoalescerTest)
+{
+	// two interleaved client connections (ports 1111 and 2222) sending bulk data
+	const size_t numOfPackets = 11;
+	RawPacket* rawPackets[numOfPackets];
+	rawPackets[0] = tcpReassemblyZeroCopyCreatePacket(1000, "abcd", 1111, false, "A");
+	rawPackets[1] = tcpReassemblyZeroCopyCreatePacket(5000, "ABCD", 2222, false, "A");
+	rawPackets[2] = tcpReassemblyZeroCopyCreatePacket(1004, "efgh", 1111, false, "A");
+	// a pure ACK of the server doesn't end the segment of 1111
+	rawPackets[3] = tcpReassemblyZeroCopyCreatePacket(7000, "", 1111, true, "A");
+	// PSH is the last packet of a segment
+	rawPackets[4] = tcpReassemblyZeroCopyCreatePacket(1008, "ijkl", 1111, false, "AP");
+	rawPackets[5] = tcpReassemblyZeroCopyCreatePacket(1012, "mnop", 1111, false, "A");
+	rawPackets[6] = tcpReassemblyZeroCopyCreatePacket(5004, "EFGH", 2222, false, "A");
+	// data of the server ends the segment of 2222, and data of the client ends the segment of the server
+	rawPackets[7] = tcpReassemblyZeroCopyCreatePacket(9000, "resp", 2222, true, "A");
+	rawPackets[8] = tcpReassemblyZeroCopyCreatePacket(5008, "IJKL", 2222, false, "A");
+	// a gap in the sequence numbers starts a new segment, and FIN is left alone
+	rawPackets[9] = tcpReassemblyZeroCopyCreatePacket(1020, "uvwx", 1111, false, "A");
+	rawPackets[10] = tcpReassemblyZeroCopyCreatePacket(1024, "", 1111, false, "AF");
+	const size_t payloadOffset = sizeof(ether_header) + sizeof(iphdr) + sizeof(tcphdr);
+
+	TcpSegmentCoalescer coalescer;
+	PTF_ASSERT_EQUAL(coalescer.coalesce(rawPackets, numOfPackets), 8, size);
+	PTF_ASSERT_EQUAL(coalescer.getNumOfSegments(), 8, size);
+	PTF_ASSERT_EQUAL((int)coalescer.getNumOfMergedPackets(), 3, int);
+
+	const size_t expectedFirstPackets[] = { 0, 1, 3, 5, 7, 8, 9, 10 };
+	const size_t expectedNumOfPackets[] = { 3, 2, 1, 1, 1, 1, 1, 1 };
+	for (size_t i = 0; i < coalescer.getNumOfSegments(); i++)
+	{
+		const TcpCoalescedSegment& segment = coalescer.getSegment(i);
+		PTF_ASSERT_EQUAL(segment.packetIndices[0], expectedFirstPackets[i], size);
+		PTF_ASSERT_EQUAL(segment.numOfPackets, expectedNumOfPackets[i], size);
+		PTF_ASSERT_TRUE(segment.isViewValid);
+		PTF_ASSERT_TRUE(segment.packets[0] == rawPackets[expectedFirstPackets[i]]);
+	}
+
+	// the merged payload points into the original packets
+	const TcpCoalescedSegment& firstSegment = coalescer.getSegment(0);
+	PTF_ASSERT_EQUAL(firstSegment.packetIndices[1], 2, size);
+	PTF_ASSERT_EQUAL(firstSegment.packetIndices[2], 4, size);
+	PTF_ASSERT_EQUAL(firstSegment.sequenceNumber, 1000, u32);
+	PTF_ASSERT_EQUAL(firstSegment.payloadLength, 12, size);
+	for (size_t i = 0; i < firstSegment.numOfPackets; i++)
+	{
+		PTF_ASSERT_TRUE(firstSegment.spans[i].data == firstSegment.packets[i]->getRawData() + payloadOffset);
+		PTF_ASSERT_EQUAL(firstSegment.spans[i].length, 4, size);
+	}
+	uint8_t payload[12];
+	PTF_ASSERT_EQUAL(firstSegment.copyPayload(payload), 12, size);
+	PTF_ASSERT_BUF_COMPARE(payload, "abcdefghijkl", 12);
+	PTF_ASSERT_EQUAL(coalescer.getSegment(1).packetIndices[1], 6, size);
+	PTF_ASSERT_EQUAL(coalescer.getSegment(1).payloadLength, 8, size);
+
+	// the reassembly of the coalesced burst has the same results as the reassembly of the packets, with fewer messages
+	TcpSegmentCoalescerStats packetStats;
+	TcpReassembly packetReassembly(tcpSegmentCoalescerMsgReady, &packetStats);
+	for (size_t i = 0; i < numOfPackets; i++)
+		packetReassembly.reassemblePacket(rawPackets[i]);
+
+	TcpSegmentCoalescerStats coalescedStats;
+	TcpReassembly coalescedReassembly(tcpSegmentCoalescerMsgReady, &coalescedStats);
+	coalescedReassembly.reassembleCoalescedSegments(coalescer);
+
+	PTF_ASSERT_TRUE(coalescedStats.data == packetStats.data);
+	PTF_ASSERT_EQUAL(packetStats.numOfMessages, 9, int);
+	PTF_ASSERT_EQUAL(coalescedStats.numOfMessages, 6, int);
+	PTF_ASSERT_EQUAL((int)coalescedReassembly.getNumOfPacketsProcessed(), (int)packetReassembly.getNumOfPacketsProcessed(), int);
+	PTF_ASSERT_EQUAL((int)coalescedReassembly.getNumOfPayloadBytesProcessed(), (int)packetReassembly.getNumOfPayloadBytesProcessed(), int);
+	PTF_ASSERT_EQUAL(coalescedReassembly.getConnectionInformation().size(), 2, size);
+
+	// the limits of a segment, with the burst given as an array of pointers
+	TcpSegmentCoalescer limitedCoalescer(TcpSegmentCoalescerConfiguration(2, 65535));
+	PTF_ASSERT_EQUAL(limitedCoalescer.coalesce(rawPackets, 3), 2, size);
+	PTF_ASSERT_EQUAL(limitedCoalescer.getSegment(0).numOfPackets, 2, size);
+	PTF_ASSERT_EQUAL(limitedCoalescer.getSegment(1).numOfPackets, 1, size);
+	TcpSegmentCoalescer shortCoalescer(TcpSegmentCoalescerConfiguration(64, 6));
+	PTF_ASSERT_EQUAL(shortCoalescer.coalesce(rawPackets, 3), 3, size);
+
+	// a burst of packets in an array of objects, which also resets the segments of the previous burst
+	RawPacket packetArr[3] = { *rawPackets[0], *rawPackets[2], *rawPackets[4] };
+	PTF_ASSERT_EQUAL(coalescer.coalesce(packetArr, 3), 1, size);
+	PTF_ASSERT_EQUAL(coalescer.getSegment(0).payloadLength, 12, size);
+	PTF_ASSERT_EQUAL(coalescer.coalesce(packetArr, 0), 0, size);
+
+	for (size_t i = 0; i < numOfPackets; i++)
+		delete rawPackets[i];
+}
+
+
+PTF_TEST_CASE(TimerWheelTest)
+{
+	TimerWheel wheel(100);
+	PTF_ASSERT_EQUAL(wheel.getCurrentTick(), 100, u32);
+
+	// a timer which isn't later than the current time is expired right away
+	uint32_t pastTimer = wheel.addTimer(50, 1);
+	PTF_ASSERT_TRUE(pastTimer != TimerWheel::InvalidTimerId);
+	PTF_ASSERT_EQUAL(wheel.getNumOfTimers(), 1, size);
+	PTF_ASSERT_EQUAL(wheel.getNumOfExpiredTimers(), 1, size);
+	uint64_t userValue = 0;
+	PTF_ASSERT_TRUE(wheel.popExpired(userValue));
+	PTF_ASSERT_EQUAL(userValue, 1, u32);
+	PTF_ASSERT_FALSE(wheel.popExpired(userValue));
+	PTF_ASSERT_EQUAL(wheel.getNumOfTimers(), 0, size);
+
+	// timers on all levels and beyond the range of the wheel
+	const uint64_t farExpiry = 100 + ((uint64_t)1 << 24) + 10;
+	wheel.addTimer(101, 101);
+	wheel.addTimer(105, 105);
+	uint32_t timerToReschedule = wheel.addTimer(164, 164);
+	uint32_t timerToRemove = wheel.addTimer(200, 200);
+	wheel.addTimer(5000, 5000);
+	wheel.addTimer(farExpiry, farExpiry);
+	PTF_ASSERT_EQUAL(wheel.getNumOfTimers(), 6, size);
+	PTF_ASSERT_EQUAL(wheel.getUserValue(timerToRemove), 200, u32);
+	PTF_ASSERT_EQUAL(wheel.getExpiryTick(timerToReschedule), 164, u32);
+
+	wheel.advance(104);
+	PTF_ASSERT_EQUAL(wheel.getNumOfExpiredTimers(), 1, size);
+	PTF_ASSERT_TRUE(wheel.popExpired(userValue));
+	PTF_ASSERT_EQUAL(userValue, 101, u32);
+	PTF_ASSERT_FALSE(wheel.popExpired(userValue));
+
+	// earlier times are ignored
+	wheel.advance(50);
+	PTF_ASSERT_EQUAL(wheel.getCurrentTick(), 104, u32);
+
+	wheel.advance(105);
+	PTF_ASSERT_TRUE(wheel.popExpired(userValue));
+	PTF_ASSERT_EQUAL(userValue, 105, u32);
+
+	wheel.removeTimer(timerToRemove);
+	wheel.rescheduleTimer(timerToReschedule, 300);
+	PTF_ASSERT_EQUAL(wheel.getNumOfTimers(), 3, size);
+
+	// expired timers are popped in the order they expired in
+	wheel.advance(1000000);
+	PTF_ASSERT_EQUAL(wheel.getCurrentTick(), 1000000, u32);
+	PTF_ASSERT_EQUAL(wheel.getNumOfExpiredTimers(), 2, size);
+	PTF_ASSERT_TRUE(wheel.popExpired(userValue));
+	PTF_ASSERT_EQUAL(userValue, 164, u32);
+	PTF_ASSERT_TRUE(wheel.popExpired(userValue));
+	PTF_ASSERT_EQUAL(userValue, 5000, u32);
+	PTF_ASSERT_FALSE(wheel.popExpired(userValue));
+
+	wheel.advance(farExpiry - 1);
+	PTF_ASSERT_EQUAL(wheel.getNumOfExpiredTimers(), 0, size);
+	wheel.advance(farExpiry);
+	PTF_ASSERT_TRUE(wheel.popExpired(userValue));
+	PTF_ASSERT_EQUAL(userValue, farExpiry, u32);
+	PTF_ASSERT_EQUAL(wheel.getNumOfTimers(), 0, size);
+
+	// compare random timers and advances with the expected expiry
+	srand(1);
+	std::multiset<uint64_t> pendingExpiries;
+	std::vector<uint32_t> timerIds;
+	for (int round = 0; round < 200; round++)
+	{
+		for (int i = 0; i < 50; i++)
+		{
+			uint64_t expiry = wheel.getCurrentTick() + 1 + (uint64_t)(rand() % (i % 2 == 0 ? 100 : 300000));
+			timerIds.push_back(wheel.addTimer(expiry, expiry));
+			pendingExpiries.insert(expiry);
+		}
+
+		// remove some timers which didn't expire
+		while (timerIds.size() > 20)
+		{
+			uint32_t timerId = timerIds.back();
+			timerIds.pop_back();
+			if (rand() % 4 == 0 && wheel.getExpiryTick(timerId) > wheel.getCurrentTick() + 1)
+			{
+				pendingExpiries.erase(pendingExpiries.find(wheel.getExpiryTick(timerId)));
+				wheel.removeTimer(timerId);
+			}
+		}
+		timerIds.clear();
+
+		uint64_t newTick = wheel.getCurrentTick() + 1 + (uint64_t)(rand() % (round % 3 == 0 ? 20000 : 80));
+		wheel.advance(newTick);
+
+		uint64_t prevExpiry = 0;
+		while (wheel.popExpired(userValue))
+		{
+			PTF_ASSERT_TRUE(userValue <= newTick);
+			PTF_ASSERT_TRUE(userValue >= prevExpiry);
+			prevExpiry = userValue;
+			std::multiset<uint64_t>::iterator iter = pendingExpiries.find(userValue);
+			PTF_ASSERT_TRUE(iter != pendingExpiries.end());
+			pendingExpiries.erase(iter);
+		}
+
+		PTF_ASSERT_TRUE(pendingExpiries.empty() || *pendingExpiries.begin() > newTick);
+		PTF_ASSERT_EQUAL(wheel.getNumOfTimers(), pendingExpiries.size(), size);
+	}
+
+	wheel.clear();
+	PTF_ASSERT_EQUAL(wheel.getNumOfTimers(), 0, size);
+	PTF_ASSERT_FALSE(wheel.popExpired(userValue));
+} // TimerWheelTest
+
+
+struct TcpReassemblyIdleStats
+{
+	int numOfMessages;
+	// the end reason of each connection by its source port
+	std::map<uint16_t, TcpReassembly::ConnectionEndReason> endReasons;
+
+	TcpReassemblyIdleStats() : numOfMessages(0) {}
+};
+
+static void tcpReassemblyIdleMsgReady(int side, const TcpStreamData& tcpData, void* userCookie)
+{
+	((TcpReassemblyIdleStats*)userCookie)->numOfMessages++;
+}
+
+static void tcpReassemblyIdleConnEnd(ConnectionData connectionData, TcpReassembly::ConnectionEndReason reason, void* userCookie)
+{
+	((TcpReassemblyIdleStats*)userCookie)->endReasons[connectionData.srcPort] = reason;
+}
+
+// feed a tcpReassemblyZeroCopyCreatePacket() packet with a timestamp of packetTime seconds
+static void tcpReassemblyIdleFeed(TcpReassembly& tcpReassembly, uint16_t srcPort, uint32_t sequence, time_t packetTime, const char* data = "abcd")
+{
+	tcpReassemblyFeedAndDelete(tcpReassembly, tcpReassemblyZeroCopyCreatePacket(sequence, data, srcPort), packetTime);
+}
+
+PTF_TEST_CASE(TcpReassemblyIdleTimeoutTest)
+{
+	TcpReassemblyIdleStats stats;
+	TcpReassemblyConfiguration config(true, 5, 30, 0, 0, 10);
+	TcpReassembly tcpReassembly(tcpReassemblyIdleMsgReady, &stats, NULL, tcpReassemblyIdleConnEnd, config);
+	const TcpReassembly::ConnectionInfoList& connections = tcpReassembly.getConnectionInformation();
+
+	tcpReassemblyIdleFeed(tcpReassembly, 1000, 1000, 1000);
+	tcpReassemblyIdleFeed(tcpReassembly, 2000, 1000, 1000);
+	tcpReassemblyIdleFeed(tcpReassembly, 3000, 1000, 1000);
+	tcpReassemblyIdleFeed(tcpReassembly, 1000, 1004, 1008);
+	PTF_ASSERT_EQUAL(stats.numOfMessages, 4, int);
+	PTF_ASSERT_EQUAL(connections.size(), 3, size);
+	PTF_ASSERT_TRUE(stats.endReasons.empty());
+
+	// a connection closed before its timeout isn't ended again when the timeout passes
+	for (TcpReassembly::ConnectionInfoList::const_iterator iter = connections.begin(); iter != connections.end(); ++iter)
+	{
+		if (iter->second.srcPort == 3000)
+		{
+			tcpReassembly.closeConnection(iter->first);
+			break;
+		}
+	}
+	PTF_ASSERT_EQUAL(stats.endReasons.size(), 1, size);
+	PTF_ASSERT_EQUAL(stats.endReasons[3000], TcpReassembly::TcpReassemblyConnectionClosedManually, enum);
+
+	// the idle connection is closed by the time of the next packet, the active one is kept open
+	tcpReassemblyIdleFeed(tcpReassembly, 1000, 1008, 1011);
+	PTF_ASSERT_EQUAL(stats.numOfMessages, 5, int);
+	PTF_ASSERT_EQUAL(stats.endReasons.size(), 2, size);
+	PTF_ASSERT_EQUAL(stats.endReasons[2000], TcpReassembly::TcpReassemblyConnectionClosedByIdleTimeout, enum);
+	PTF_ASSERT_EQUAL(stats.endReasons[3000], TcpReassembly::TcpReassemblyConnectionClosedManually, enum);
+	PTF_ASSERT_TRUE(stats.endReasons.find(1000) == stats.endReasons.end());
+	PTF_ASSERT_EQUAL(connections.size(), 3, size);
+
+	// the active connection times out 10 seconds after its last packet, without another packet
+	timeval currentTime;
+	currentTime.tv_sec = 1020;
+	currentTime.tv_usec = 0;
+	tcpReassembly.advanceTime(currentTime);
+	PTF_ASSERT_TRUE(stats.endReasons.find(1000) == stats.endReasons.end());
+	// the connection closed manually at 1008 was cleaned up 5 seconds later, the idle one closed at 1011 too
+	PTF_ASSERT_EQUAL(connections.size(), 1, size);
+	currentTime.tv_sec = 1021;
+	tcpReassembly.advanceTime(currentTime);
+	PTF_ASSERT_EQUAL(stats.endReasons[1000], TcpReassembly::TcpReassemblyConnectionClosedByIdleTimeout, enum);
+
+	// the closed connections are cleaned up 5 seconds after they were closed
+	timeval cleanupTime;
+	cleanupTime.tv_sec = 1030;
+	cleanupTime.tv_usec = 0;
+	tcpReassembly.advanceTime(cleanupTime);
+	PTF_ASSERT_EQUAL(stats.endReasons.size(), 3, size);
+	PTF_ASSERT_EQUAL(connections.size(), 0, size);
+
+	// idle connections aren't closed when no timeout is set
+	TcpReassemblyIdleStats noTimeoutStats;
+	TcpReassembly noTimeoutReassembly(tcpReassemblyIdleMsgReady, &noTimeoutStats, NULL, tcpReassemblyIdleConnEnd);
+	tcpReassemblyIdleFeed(noTimeoutReassembly, 1000, 1000, 1000);
+	tcpReassemblyIdleFeed(noTimeoutReassembly, 2000, 1000, 1000000);
+	PTF_ASSERT_TRUE(noTimeoutStats.endReasons.empty());
+	PTF_ASSERT_EQUAL(noTimeoutReassembly.getConnectionInformation().size(), 2, size);
+} // TcpReassemblyIdleTimeoutTest
+
+
+struct SPSCQueueTestProducer
+{
+	SPSCQueue<uint32_t>* queue;
+	uint32_t numOfValues;
+};
+
+static void* spscQueueTestProducerMain(void* producerPtr)
+{
+	SPSCQueueTestProducer* producer = (SPSCQueueTestProducer*)producerPtr;
+	for (uint32_t value = 0; value < producer->numOfValues; value++)
+	{
+		while (!producer->queue->push(value))
+			sched_yield();
+	}
+
+	return NULL;
+}
+
+PTF_TEST_CASE(SPSCQueueTest)
+{
+	// the capacity is rounded up to a power of 2
+	SPSCQueue<uint32_t> queue(100);
+	PTF_ASSERT_EQUAL(queue.getCapacity(), 128, size);
+	PTF_ASSERT_TRUE(queue.empty());
+	PTF_ASSERT_NULL(queue.front());
+
+	for (uint32_t i = 0; i < 128; i++)
+		PTF_ASSERT_TRUE(queue.push(i));
+	PTF_ASSERT_FALSE(queue.push(128));
+	PTF_ASSERT_NULL(queue.reserve());
+	PTF_ASSERT_EQUAL(queue.size(), 128, size);
+
+	uint32_t value = 0;
+	PTF_ASSERT_TRUE(queue.pop(value));
+	PTF_ASSERT_EQUAL(value, 0, u32);
+
+	// writing and reading in place
+	uint32_t* slot = queue.reserve();
+	PTF_ASSERT_NOT_NULL(slot);
+	*slot = 1000;
+	queue.publish();
+	PTF_ASSERT_NULL(queue.reserve());
+
+	for (uint32_t i = 1; i < 128; i++)
+	{
+		PTF_ASSERT_NOT_NULL(queue.front());
+		PTF_ASSERT_EQUAL(*queue.front(), i, u32);
+		queue.pop();
+	}
+	PTF_ASSERT_TRUE(queue.pop(value));
+	PTF_ASSERT_EQUAL(value, 1000, u32);
+	PTF_ASSERT_FALSE(queue.pop(value));
+	PTF_ASSERT_TRUE(queue.empty());
+
+	// bulk push and pop stop at the queue's capacity and contents
+	uint32_t values[200];
+	for (uint32_t i = 0; i < 200; i++)
+		values[i] = i;
+	PTF_ASSERT_EQUAL(queue.pushBulk(values, 100), 100, size);
+	PTF_ASSERT_EQUAL(queue.pushBulk(values + 100, 100), 28, size);
+	PTF_ASSERT_EQUAL(queue.pushBulk(values, 1), 0, size);
+	uint32_t poppedValues[200];
+	PTF_ASSERT_EQUAL(queue.popBulk(poppedValues, 50), 50, size);
+	PTF_ASSERT_EQUAL(queue.popBulk(poppedValues + 50, 150), 78, size);
+	PTF_ASSERT_EQUAL(queue.popBulk(poppedValues, 1), 0, size);
+	for (uint32_t i = 0; i < 128; i++)
+		PTF_ASSERT_EQUAL(poppedValues[i], i, u32);
+
+	// values passed between threads arrive complete and in order
+	SPSCQueue<uint32_t> threadQueue(64);
+	SPSCQueueTestProducer producer;
+	producer.queue = &threadQueue;
+	producer.numOfValues = 200000;
+	pthread_t producerThread;
+	PTF_ASSERT_EQUAL(pthread_create(&producerThread, NULL, spscQueueTestProducerMain, &producer), 0, int);
+
+	uint32_t expectedValue = 0;
+	bool inOrder = true;
+	while (expectedValue < producer.numOfValues)
+	{
+		if (!threadQueue.pop(value))
+		{
+			sched_yield();
+			continue;
+		}
+
+		if (value != expectedValue)
+			inOrder = false;
+		expectedValue++;
+	}
+	pthread_join(producerThread, NULL);
+
+	PTF_ASSERT_TRUE(inOrder);
+	PTF_ASSERT_TRUE(threadQueue.empty());
+} // SPSCQueueTest
+
+
+struct MPMCQueueTestThread
+{
+	MPMCQueue<uint32_t>* queue;
+	uint32_t producerId;
+	uint32_t numOfValues;
+	// consumer side: the number of times each value was popped by this consumer, and whether the values of each producer were popped in order
+	uint32_t* popCount;
+	uint32_t lastValue[4];
+	bool inOrder;
+	volatile bool* producersDone;
+};
+
+static void* mpmcQueueTestProducerMain(void* threadPtr)
+{
+	MPMCQueueTestThread* producer = (MPMCQueueTestThread*)threadPtr;
+	// values carry the producer ID in the top bits, and are pushed in bursts of up to 8
+	uint32_t burst[8];
+	uint32_t value = 0;
+	while (value < producer->numOfValues)
+	{
+		uint32_t burstSize = 0;
+		while (burstSize < 8 && value + burstSize < producer->numOfValues)
+		{
+			burst[burstSize] = (producer->producerId << 24) | (value + burstSize);
+			burstSize++;
+		}
+
+		size_t pushed = producer->queue->pushBulk(burst, burstSize);
+		if (pushed == 0)
+			sched_yield();
+		value += (uint32_t)pushed;
+	}
+
+	return NULL;
+}
+
+static void* mpmcQueueTestConsumerMain(void* threadPtr)
+{
+	MPMCQueueTestThread* consumer = (MPMCQueueTestThread*)threadPtr;
+	uint32_t burst[8];
+	while (true)
+	{
+		size_t popped = consumer->queue->popBulk(burst, 8);
+		if (popped == 0)
+		{
+			if (*consumer->producersDone && consumer->queue->empty())
+				break;
+			sched_yield();
+			continue;
+		}
+
+		for (size_t i = 0; i < popped; i++)
+		{
+			uint32_t producerId = burst[i] >> 24;
+			uint32_t value = burst[i] & 0xffffff;
+			consumer->popCount[producerId * consumer->numOfValues + value]++;
+			if (consumer->lastValue[producerId] != 0xffffffff && value <= consumer->lastValue[producerId])
+				consumer->inOrder = false;
+			consumer->lastValue[producerId] = value;
+		}
+	}
+
+	return NULL;
+}
+
+PTF_TEST_CASE(MPMCQueueTest)
+{
+	// the capacity is rounded up to a power of 2
+	MPMCQueue<uint32_t> queue(100);
+	PTF_ASSERT_EQUAL(queue.getCapacity(), 128, size);
+	PTF_ASSERT_TRUE(queue.empty());
+
+	uint32_t value = 0;
+	PTF_ASSERT_FALSE(queue.pop(value));
+	for (uint32_t i = 0; i < 128; i++)
+		PTF_ASSERT_TRUE(queue.push(i));
+	PTF_ASSERT_FALSE(queue.push(128));
+	PTF_ASSERT_EQUAL(queue.size(), 128, size);
+	for (uint32_t i = 0; i < 128; i++)
+	{
+		PTF_ASSERT_TRUE(queue.pop(value));
+		PTF_ASSERT_EQUAL(value, i, u32);
+	}
+	PTF_ASSERT_FALSE(queue.pop(value));
+
+	// bulk push and pop stop at the queue's capacity and contents, also after the indices wrapped around
+	uint32_t values[200];
+	for (uint32_t i = 0; i < 200; i++)
+		values[i] = i;
+	PTF_ASSERT_EQUAL(queue.pushBulk(values, 100), 100, size);
+	PTF_ASSERT_EQUAL(queue.pushBulk(values + 100, 100), 28, size);
+	uint32_t poppedValues[200];
+	PTF_ASSERT_EQUAL(queue.popBulk(poppedValues, 50), 50, size);
+	PTF_ASSERT_EQUAL(queue.pushBulk(values + 128, 72), 50, size);
+	PTF_ASSERT_EQUAL(queue.popBulk(poppedValues + 50, 200), 128, size);
+	PTF_ASSERT_EQUAL(queue.popBulk(poppedValues, 1), 0, size);
+	for (uint32_t i = 0; i < 178; i++)
+		PTF_ASSERT_EQUAL(poppedValues[i], i, u32);
+	PTF_ASSERT_TRUE(queue.empty());
+
+	// values of 4 producers passed to 4 consumers arrive exactly once, and the values of each producer arrive at each consumer in order
+	MPMCQueue<uint32_t> threadQueue(64);
+	const uint32_t numOfValues = 50000;
+	std::vector<uint32_t> popCount[4];
+	volatile bool producersDone = false;
+	MPMCQueueTestThread producers[4];
+	MPMCQueueTestThread consumers[4];
+	pthread_t producerThreads[4];
+	pthread_t consumerThreads[4];
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		MPMCQueueTestThread* threads[2] = { &producers[i], &consumers[i] };
+		for (int j = 0; j < 2; j++)
+		{
+			threads[j]->queue = &threadQueue;
+			threads[j]->producerId = i;
+			threads[j]->numOfValues = numOfValues;
+			threads[j]->popCount = NULL;
+			memset(threads[j]->lastValue, 0xff, sizeof(threads[j]->lastValue));
+			threads[j]->inOrder = true;
+			threads[j]->producersDone = &producersDone;
+		}
+		popCount[i].resize(4 * numOfValues, 0);
+		consumers[i].popCount = &popCount[i][0];
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		PTF_ASSERT_EQUAL(pthread_create(&consumerThreads[i], NULL, mpmcQueueTestConsumerMain, &consumers[i]), 0, int);
+		PTF_ASSERT_EQUAL(pthread_create(&producerThreads[i], NULL, mpmcQueueTestProducerMain, &producers[i]), 0, int);
+	}
+	for (int i = 0; i < 4; i++)
+		pthread_join(producerThreads[i], NULL);
+	producersDone = true;
+	for (int i = 0; i < 4; i++)
+		pthread_join(consumerThreads[i], NULL);
+
+	for (int i = 0; i < 4; i++)
+		PTF_ASSERT_TRUE(consumers[i].inOrder);
+	bool allPoppedOnce = true;
+	for (size_t i = 0; i < 4 * numOfValues; i++)
+	{
+		if (popCount[0][i] + popCount[1][i] + popCount[2][i] + popCount[3][i] != 1)
+			allPoppedOnce = false;
+	}
+	PTF_ASSERT_TRUE(allPoppedOnce);
+	PTF_ASSERT_TRUE(threadQueue.empty());
+} // MPMCQueueTest
+
+
+struct ShardedTcpReassemblyShardStats
+{
+	// the reassembled data of each connection by its source port
+	std::map<uint16_t, std::string> reassembledData;
+	int numOfConnEnded;
+
+	ShardedTcpReassemblyShardStats() : numOfConnEnded(0) {}
+};
+
+static void shardedTcpReassemblyMsgReady(int side, const TcpStreamData& tcpData, void* userCookie)
+{
+	ShardedTcpReassemblyShardStats* stats = (ShardedTcpReassemblyShardStats*)userCookie;
+	stats->reassembledData[tcpData.getConnectionData().srcPort] += std::string((const char*)tcpData.getData(), tcpData.getDataLength());
+}
+
+static void shardedTcpReassemblyConnEnd(ConnectionData connectionData, TcpReassembly::ConnectionEndReason reason, void* userCookie)
+{
+	((ShardedTcpReassemblyShardStats*)userCookie)->numOfConnEnded++;
+}
+
+struct ShardedTcpReassemblyProducer
+{
+	ShardedTcpReassembly* reassembly;
+	int producerId;
+	std::vector<RawPacket*> packets;
+	size_t numOfQueued;
+};
+
+static void* shardedTcpReassemblyProducerMain(void* producerPtr)
+{
+	ShardedTcpReassemblyProducer* producer = (ShardedTcpReassemblyProducer*)producerPtr;
+	producer->numOfQueued = 0;
+	for (std::vector<RawPacket*>::iterator iter = producer->packets.begin(); iter != producer->packets.end(); iter++)
+	{
+		if (producer->reassembly->reassemblePacket(*iter, producer->producerId))
+			producer->numOfQueued++;
+	}
+
+	return NULL;
+}
+
+PTF_TEST_CASE(ShardedTcpReassemblyTest)
+{
+	const int numOfShards = 4;
+	const int numOfProducers = 2;
+	const int numOfConns = 200;
+	const int numOfSegments = 5;
+
+	// small queues so producers have to wait for the shards
+	ShardedTcpReassemblyShardStats shardStats[numOfShards];
+	ShardedTcpReassemblyConfiguration config(numOfShards, numOfProducers, 16);
+	ShardedTcpReassembly reassembly(shardedTcpReassemblyMsgReady, NULL, NULL, shardedTcpReassemblyConnEnd, config);
+	PTF_ASSERT_EQUAL(reassembly.getNumOfShards(), numOfShards, int);
+	PTF_ASSERT_EQUAL(reassembly.getNumOfProducers(), numOfProducers, int);
+	for (int i = 0; i < numOfShards; i++)
+		reassembly.setShardUserCookie(i, &shardStats[i]);
+
+	ShardedTcpReassemblyProducer producers[numOfProducers];
+	std::map<uint16_t, std::string> expectedData;
+	std::map<uint16_t, int> expectedShard;
+	char segment[9];
+	for (int conn = 0; conn < numOfConns; conn++)
+	{
+		uint16_t srcPort = (uint16_t)(20000 + conn);
+		for (int seg = 0; seg < numOfSegments; seg++)
+		{
+			snprintf(segment, sizeof(segment), "c%03ds%03d", conn, seg);
+			expectedData[srcPort] += segment;
+			RawPacket* rawPacket = tcpReassemblyZeroCopyCreatePacket(1000 + 8 * seg, segment, srcPort);
+			if (seg == 0)
+				expectedShard[srcPort] = reassembly.getShardIndex(rawPacket);
+			producers[conn % numOfProducers].packets.push_back(rawPacket);
+		}
+	}
+
+	PTF_ASSERT_TRUE(reassembly.start());
+	PTF_ASSERT_TRUE(reassembly.isRunning());
+
+	pthread_t producerThreads[numOfProducers];
+	for (int i = 0; i < numOfProducers; i++)
+	{
+		producers[i].reassembly = &reassembly;
+		producers[i].producerId = i;
+		PTF_ASSERT_EQUAL(pthread_create(&producerThreads[i], NULL, shardedTcpReassemblyProducerMain, &producers[i]), 0, int);
+	}
+	for (int i = 0; i < numOfProducers; i++)
+		pthread_join(producerThreads[i], NULL);
+
+	for (int i = 0; i < numOfProducers; i++)
+		PTF_ASSERT_EQUAL(producers[i].numOfQueued, producers[i].packets.size(), size);
+
+	// packets which aren't TCP and invalid producer IDs are rejected
+	Packet udpPacket(100);
+	EthLayer ethLayer(MacAddress("00:00:00:00:00:01"), MacAddress("00:00:00:00:00:02"), PCPP_ETHERTYPE_IP);
+	IPv4Layer ipLayer(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	UdpLayer udpLayer(1234, 53);
+	udpPacket.addLayer(&ethLayer);
+	udpPacket.addLayer(&ipLayer);
+	udpPacket.addLayer(&udpLayer);
+	udpPacket.computeCalculateFields();
+	PTF_ASSERT_EQUAL(reassembly.getShardIndex(udpPacket.getRawPacket()), -1, int);
+	PTF_ASSERT_FALSE(reassembly.reassemblePacket(udpPacket.getRawPacket(), 0));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(reassembly.reassemblePacket(producers[0].packets[0], numOfProducers));
+	LoggerPP::getInstance().enableErrors();
+
+	reassembly.closeAllConnections();
+
+	// each connection was reassembled completely by the shard its hash maps to
+	int numOfConnEnded = 0;
+	size_t numOfConnsSeen = 0;
+	for (int i = 0; i < numOfShards; i++)
+	{
+		numOfConnEnded += shardStats[i].numOfConnEnded;
+		numOfConnsSeen += shardStats[i].reassembledData.size();
+		for (std::map<uint16_t, std::string>::iterator iter = shardStats[i].reassembledData.begin(); iter != shardStats[i].reassembledData.end(); iter++)
+		{
+			PTF_ASSERT_EQUAL(expectedShard[iter->first], i, int);
+			PTF_ASSERT_EQUAL(iter->second, expectedData[iter->first], string);
+		}
+	}
+	PTF_ASSERT_EQUAL(numOfConnEnded, numOfConns, int);
+	PTF_ASSERT_EQUAL(numOfConnsSeen, (size_t)numOfConns, size);
+
+	uint64_t totals[ShardedTcpReassembly::NumOfStatsCounters];
+	reassembly.getStatsCounters().aggregate(totals);
+	PTF_ASSERT_EQUAL(totals[ShardedTcpReassembly::PacketsQueued], (uint64_t)(numOfConns * numOfSegments), u32);
+	PTF_ASSERT_EQUAL(totals[ShardedTcpReassembly::PacketsProcessed], (uint64_t)(numOfConns * numOfSegments), u32);
+	PTF_ASSERT_EQUAL(totals[ShardedTcpReassembly::PacketsIgnored], 1, u32);
+	PTF_ASSERT_EQUAL(totals[ShardedTcpReassembly::PacketsDropped], 0, u32);
+	PTF_ASSERT_EQUAL(totals[ShardedTcpReassembly::ConnectionsStarted], (uint64_t)numOfConns, u32);
+	PTF_ASSERT_EQUAL(totals[ShardedTcpReassembly::ConnectionsEnded], (uint64_t)numOfConns, u32);
+
+	reassembly.stop();
+	PTF_ASSERT_FALSE(reassembly.isRunning());
+
+	// without worker threads packets are dropped when the queue is full, and closing all connections processes the queued ones
+	ShardedTcpReassemblyShardStats stoppedStats;
+	ShardedTcpReassemblyConfiguration stoppedConfig(1, 1, 2);
+	ShardedTcpReassembly stoppedReassembly(shardedTcpReassemblyMsgReady, &stoppedStats, NULL, shardedTcpReassemblyConnEnd, stoppedConfig);
+	PTF_ASSERT_TRUE(stoppedReassembly.reassemblePacket(producers[0].packets[0]));
+	PTF_ASSERT_TRUE(stoppedReassembly.reassemblePacket(producers[0].packets[1]));
+	PTF_ASSERT_FALSE(stoppedReassembly.reassemblePacket(producers[0].packets[2]));
+	stoppedReassembly.getStatsCounters().aggregate(totals);
+	PTF_ASSERT_EQUAL(totals[ShardedTcpReassembly::PacketsDropped], 1, u32);
+	PTF_ASSERT_TRUE(stoppedStats.reassembledData.empty());
+	stoppedReassembly.closeAllConnections();
+	PTF_ASSERT_EQUAL(stoppedStats.numOfConnEnded, 1, int);
+	PTF_ASSERT_EQUAL(stoppedStats.reassembledData[20000], "c000s000c000s001", string);
+
+	for (int i = 0; i < numOfProducers; i++)
+	{
+		for (std::vector<RawPacket*>::iterator iter = producers[i].packets.begin(); iter != producers[i].packets.end(); iter++)
+			delete (*iter);
+	}
+} // ShardedTcpReassemblyTest
+
+
+PTF_TEST_CASE(MemoryBudgetTest)
+{
+	MemoryBudget budget(1000);
+	budget.charge(600);
+	budget.charge(300);
+	PTF_ASSERT_FALSE(budget.isExceeded());
+	budget.charge(200);
+	PTF_ASSERT_TRUE(budget.isExceeded());
+	PTF_ASSERT_EQUAL(budget.getUsedBytes(), 1100, size);
+	budget.release(600);
+	PTF_ASSERT_FALSE(budget.isExceeded());
+	PTF_ASSERT_EQUAL(budget.getUsedBytes(), 500, size);
+	PTF_ASSERT_EQUAL(budget.getPeakBytes(), 1100, size);
+	budget.countEviction(600);
+	PTF_ASSERT_EQUAL(budget.getNumOfEvictions(), 1, u32);
+	PTF_ASSERT_EQUAL(budget.getEvictedBytes(), 600, u32);
+	budget.setMaxBytes(0);
+	budget.charge(10000);
+	PTF_ASSERT_FALSE(budget.isExceeded());
+
+	uint64_t victim = 0;
+
+	// least recently used: touched items go to the end of the list
+	EvictionList lruList(EvictLeastRecentlyUsed);
+	PTF_ASSERT_FALSE(lruList.getVictim(victim));
+	uint32_t lruIds[3];
+	for (int i = 0; i < 3; i++)
+		lruIds[i] = lruList.add(i, 100);
+	lruList.touch(lruIds[0]);
+	PTF_ASSERT_TRUE(lruList.getVictim(victim));
+	PTF_ASSERT_EQUAL(victim, 1, u32);
+	lruList.remove(lruIds[1]);
+	PTF_ASSERT_TRUE(lruList.getVictim(victim));
+	PTF_ASSERT_EQUAL(victim, 2, u32);
+	PTF_ASSERT_EQUAL(lruList.getNumOfItems(), 2, size);
+	PTF_ASSERT_EQUAL(lruList.getTotalBytes(), 200, size);
+	// the node of a removed item is reused
+	PTF_ASSERT_EQUAL(lruList.add(3, 100), lruIds[1], u32);
+
+	// oldest first: touching doesn't change the order
+	EvictionList oldestList(EvictOldestFirst);
+	uint32_t oldestIds[3];
+	for (int i = 0; i < 3; i++)
+		oldestIds[i] = oldestList.add(i, 100);
+	oldestList.touch(oldestIds[0]);
+	PTF_ASSERT_TRUE(oldestList.getVictim(victim));
+	PTF_ASSERT_EQUAL(victim, 0, u32);
+
+	// largest first: items are ordered by the power of 2 of their size, and the oldest of the largest is the victim
+	EvictionList largestList(EvictLargestFirst);
+	uint32_t largestIds[4];
+	largestIds[0] = largestList.add(0, 100);
+	largestIds[1] = largestList.add(1, 5000);
+	largestIds[2] = largestList.add(2, 300);
+	largestIds[3] = largestList.add(3, 4100);
+	PTF_ASSERT_TRUE(largestList.getVictim(victim));
+	PTF_ASSERT_EQUAL(victim, 1, u32);
+	largestList.resize(largestIds[1], 50);
+	PTF_ASSERT_TRUE(largestList.getVictim(victim));
+	PTF_ASSERT_EQUAL(victim, 3, u32);
+	largestList.resize(largestIds[0], 1000000);
+	PTF_ASSERT_TRUE(largestList.getVictim(victim));
+	PTF_ASSERT_EQUAL(victim, 0, u32);
+	PTF_ASSERT_EQUAL(largestList.getTotalBytes(), 1000000 + 50 + 300 + 4100, size);
+	largestList.remove(largestIds[0]);
+	largestList.remove(largestIds[3]);
+	PTF_ASSERT_TRUE(largestList.getVictim(victim));
+	PTF_ASSERT_EQUAL(victim, 2, u32);
+	largestList.remove(largestIds[2]);
+	largestList.remove(largestIds[1]);
+	PTF_ASSERT_FALSE(largestList.getVictim(victim));
+
+	// changing the policy re-orders the items
+	oldestList.resize(oldestIds[2], 10000);
+	oldestList.setPolicy(EvictLargestFirst);
+	PTF_ASSERT_TRUE(oldestList.getVictim(victim));
+	PTF_ASSERT_EQUAL(victim, 2, u32);
+	oldestList.clear();
+	PTF_ASSERT_FALSE(oldestList.getVictim(victim));
+	PTF_ASSERT_EQUAL(oldestList.getNumOfItems(), 0, size);
+} // MemoryBudgetTest
+
+
+PTF_TEST_CASE(TcpReassemblyMemoryBudgetTest)
+{
+	// the memory of a connection and of an out-of-order fragment, as charged by an instance without a limit
+	TcpReassemblyIdleStats unlimitedStats;
+	TcpReassembly unlimitedReassembly(tcpReassemblyIdleMsgReady, &unlimitedStats, NULL, tcpReassemblyIdleConnEnd);
+	PTF_ASSERT_EQUAL(unlimitedReassembly.getMemoryUsage(), 0, size);
+	tcpReassemblyIdleFeed(unlimitedReassembly, 1000, 1000, 1000);
+	size_t connBytes = unlimitedReassembly.getMemoryUsage();
+	PTF_ASSERT_TRUE(connBytes > 0);
+	tcpReassemblyIdleFeed(unlimitedReassembly, 1000, 2000, 1000);
+	size_t fragBytes = unlimitedReassembly.getMemoryUsage() - connBytes;
+	PTF_ASSERT_TRUE(fragBytes > 4);
+	PTF_ASSERT_EQUAL(unlimitedReassembly.getMemoryBudget()->getUsedBytes(), connBytes + fragBytes, size);
+	unlimitedReassembly.closeAllConnections();
+	PTF_ASSERT_EQUAL(unlimitedReassembly.getMemoryUsage(), 0, size);
+	PTF_ASSERT_EQUAL(unlimitedReassembly.getNumOfEvictedConnections(), 0, u32);
+
+	// least recently used: the connection which saw a packet last is kept
+	TcpReassemblyIdleStats lruStats;
+	TcpReassemblyConfiguration lruConfig(true, 5, 30, 0, 0, 0, 3 * connBytes, EvictLeastRecentlyUsed);
+	TcpReassembly lruReassembly(tcpReassemblyIdleMsgReady, &lruStats, NULL, tcpReassemblyIdleConnEnd, lruConfig);
+	tcpReassemblyIdleFeed(lruReassembly, 1000, 1000, 1000);
+	tcpReassemblyIdleFeed(lruReassembly, 2000, 1000, 1000);
+	tcpReassemblyIdleFeed(lruReassembly, 3000, 1000, 1000);
+	tcpReassemblyIdleFeed(lruReassembly, 1000, 1004, 1000);
+	PTF_ASSERT_TRUE(lruStats.endReasons.empty());
+	tcpReassemblyIdleFeed(lruReassembly, 4000, 1000, 1000);
+	PTF_ASSERT_EQUAL(lruStats.endReasons.size(), 1, size);
+	PTF_ASSERT_EQUAL(lruStats.endReasons[2000], TcpReassembly::TcpReassemblyConnectionClosedByMemoryBudget, enum);
+	PTF_ASSERT_EQUAL(lruReassembly.getNumOfEvictedConnections(), 1, u32);
+	PTF_ASSERT_EQUAL(lruReassembly.getMemoryUsage(), 3 * connBytes, size);
+	PTF_ASSERT_EQUAL(lruReassembly.getMemoryBudget()->getNumOfEvictions(), 1, u32);
+	PTF_ASSERT_EQUAL(lruReassembly.getMemoryBudget()->getPeakBytes(), 4 * connBytes, size);
+
+	// oldest first: the connection opened first is closed even if it's active
+	TcpReassemblyIdleStats oldestStats;
+	TcpReassemblyConfiguration oldestConfig(true, 5, 30, 0, 0, 0, 3 * connBytes, EvictOldestFirst);
+	TcpReassembly oldestReassembly(tcpReassemblyIdleMsgReady, &oldestStats, NULL, tcpReassemblyIdleConnEnd, oldestConfig);
+	tcpReassemblyIdleFeed(oldestReassembly, 1000, 1000, 1000);
+	tcpReassemblyIdleFeed(oldestReassembly, 2000, 1000, 1000);
+	tcpReassemblyIdleFeed(oldestReassembly, 3000, 1000, 1000);
+	tcpReassemblyIdleFeed(oldestReassembly, 1000, 1004, 1000);
+	tcpReassemblyIdleFeed(oldestReassembly, 4000, 1000, 1000);
+	PTF_ASSERT_EQUAL(oldestStats.endReasons.size(), 1, size);
+	PTF_ASSERT_EQUAL(oldestStats.endReasons[1000], TcpReassembly::TcpReassemblyConnectionClosedByMemoryBudget, enum);
+
+	// largest first: the connection with queued out-of-order data is closed and its data is sent to the user first
+	TcpReassemblyIdleStats largestStats;
+	TcpReassemblyConfiguration largestConfig(true, 5, 30, 0, 0, 0, 3 * connBytes + fragBytes, EvictLargestFirst);
+	TcpReassembly largestReassembly(tcpReassemblyIdleMsgReady, &largestStats, NULL, tcpReassemblyIdleConnEnd, largestConfig);
+	tcpReassemblyIdleFeed(largestReassembly, 1000, 1000, 1000);
+	tcpReassemblyIdleFeed(largestReassembly, 2000, 1000, 1000);
+	tcpReassemblyIdleFeed(largestReassembly, 3000, 1000, 1000);
+	tcpReassemblyIdleFeed(largestReassembly, 2000, 2000, 1000);
+	PTF_ASSERT_EQUAL(largestStats.numOfMessages, 3, int);
+	PTF_ASSERT_TRUE(largestStats.endReasons.empty());
+	tcpReassemblyIdleFeed(largestReassembly, 4000, 1000, 1000);
+	PTF_ASSERT_EQUAL(largestStats.endReasons.size(), 1, size);
+	PTF_ASSERT_EQUAL(largestStats.endReasons[2000], TcpReassembly::TcpReassemblyConnectionClosedByMemoryBudget, enum);
+	PTF_ASSERT_EQUAL(largestStats.numOfMessages, 5, int);
+	PTF_ASSERT_EQUAL(largestReassembly.getMemoryUsage(), 3 * connBytes, size);
+	PTF_ASSERT_EQUAL(largestReassembly.getOutOfOrderBytes(), 0, size);
+
+	// instances sharing a budget are limited together, and the one which exceeds it evicts its own connections
+	MemoryBudget sharedBudget;
+	TcpReassemblyIdleStats firstStats, secondStats;
+	TcpReassembly firstReassembly(tcpReassemblyIdleMsgReady, &firstStats, NULL, tcpReassemblyIdleConnEnd);
+	TcpReassembly* secondReassembly = new TcpReassembly(tcpReassemblyIdleMsgReady, &secondStats, NULL, tcpReassemblyIdleConnEnd);
+	tcpReassemblyIdleFeed(firstReassembly, 1000, 1000, 1000);
+	firstReassembly.setMemoryBudget(&sharedBudget);
+	secondReassembly->setMemoryBudget(&sharedBudget);
+	PTF_ASSERT_EQUAL(sharedBudget.getUsedBytes(), connBytes, size);
+	PTF_ASSERT_EQUAL(firstReassembly.getMemoryBudget()->getUsedBytes(), connBytes, size);
+	tcpReassemblyIdleFeed(*secondReassembly, 2000, 1000, 1000);
+	tcpReassemblyIdleFeed(*secondReassembly, 3000, 1000, 1000);
+	PTF_ASSERT_EQUAL(sharedBudget.getUsedBytes(), 3 * connBytes, size);
+	sharedBudget.setMaxBytes(2 * connBytes);
+	tcpReassemblyIdleFeed(*secondReassembly, 4000, 1000, 1000);
+	PTF_ASSERT_TRUE(firstStats.endReasons.empty());
+	PTF_ASSERT_EQUAL(secondStats.endReasons.size(), 2, size);
+	PTF_ASSERT_EQUAL(secondStats.endReasons[2000], TcpReassembly::TcpReassemblyConnectionClosedByMemoryBudget, enum);
+	PTF_ASSERT_EQUAL(secondStats.endReasons[3000], TcpReassembly::TcpReassemblyConnectionClosedByMemoryBudget, enum);
+	PTF_ASSERT_EQUAL(sharedBudget.getUsedBytes(), 2 * connBytes, size);
+	// a destroyed instance releases what it charged, and going back to the own budget takes the memory along
+	delete secondReassembly;
+	PTF_ASSERT_EQUAL(sharedBudget.getUsedBytes(), connBytes, size);
+	firstReassembly.setMemoryBudget(NULL);
+	PTF_ASSERT_EQUAL(sharedBudget.getUsedBytes(), 0, size);
+	PTF_ASSERT_EQUAL(firstReassembly.getMemoryBudget()->getUsedBytes(), connBytes, size);
+} // TcpReassemblyMemoryBudgetTest
+
+
+static RawPacket* ipReassemblyBudgetCreateFragment(uint16_t ipId, uint16_t fragmentOffset, bool moreFragments, size_t dataLen)
+{
+	Packet packet(100 + dataLen);
+	EthLayer ethLayer(MacAddress("00:00:00:00:00:01"), MacAddress("00:00:00:00:00:02"), PCPP_ETHERTYPE_IP);
+	IPv4Layer ipLayer(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	ipLayer.getIPv4Header()->timeToLive = 64;
+	ipLayer.getIPv4Header()->ipId = htons(ipId);
+	std::vector<uint8_t> data(dataLen, (uint8_t)ipId);
+	PayloadLayer payloadLayer(&data[0], dataLen, false);
+	packet.addLayer(&ethLayer);
+	packet.addLayer(&ipLayer);
+	packet.addLayer(&payloadLayer);
+	packet.computeCalculateFields();
+	ipLayer.getIPv4Header()->fragmentOffset = htons(fragmentOffset / 8) | (moreFragments ? PCPP_IP_MORE_FRAGMENTS : 0);
+	return new RawPacket(*packet.getRawPacket());
+}
+
+// feed a fragment and return the IP reassembly status
+static IPReassembly::ReassemblyStatus ipReassemblyBudgetFeed(IPReassembly& ipReassembly, uint16_t ipId, uint16_t fragmentOffset, bool moreFragments, size_t dataLen)
+{
+	RawPacket* fragment = ipReassemblyBudgetCreateFragment(ipId, fragmentOffset, moreFragments, dataLen);
+	IPReassembly::ReassemblyStatus status;
+	delete ipReassembly.processPacket(fragment, status);
+	delete fragment;
+	return status;
+}
+
+static void ipReassemblyBudgetFragmentsClean(const IPReassembly::PacketKey* key, void* userCookie)
+{
+	((std::vector<uint16_t>*)userCookie)->push_back(((const IPReassembly::IPv4PacketKey*)key)->getIpID());
+}
+
+PTF_TEST_CASE(IPReassemblyMemoryBudgetTest)
+{
+	// the memory of a packet after its first fragment, as charged by an instance without a limit
+	IPReassembly unlimitedReassembly;
+	PTF_ASSERT_EQUAL(ipReassemblyBudgetFeed(unlimitedReassembly, 1, 0, true, 64), IPReassembly::FIRST_FRAGMENT, enum);
+	size_t packetBytes = unlimitedReassembly.getMemoryUsage();
+	PTF_ASSERT_TRUE(packetBytes > 64);
+	PTF_ASSERT_EQUAL(ipReassemblyBudgetFeed(unlimitedReassembly, 1, 128, true, 64), IPReassembly::OUT_OF_ORDER_FRAGMENT, enum);
+	PTF_ASSERT_TRUE(unlimitedReassembly.getMemoryUsage() > packetBytes + 64);
+	PTF_ASSERT_EQUAL(ipReassemblyBudgetFeed(unlimitedReassembly, 1, 64, true, 64), IPReassembly::FRAGMENT, enum);
+	PTF_ASSERT_EQUAL(ipReassemblyBudgetFeed(unlimitedReassembly, 1, 192, false, 64), IPReassembly::REASSEMBLED, enum);
+	PTF_ASSERT_EQUAL(unlimitedReassembly.getMemoryUsage(), 0, size);
+	PTF_ASSERT_TRUE(unlimitedReassembly.getMemoryBudget()->getPeakBytes() > packetBytes);
+
+	// least recently used: the packet which got a fragment last is kept
+	std::vector<uint16_t> lruDropped;
+	IPReassembly lruReassembly(ipReassemblyBudgetFragmentsClean, &lruDropped, PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE, 2 * packetBytes + packetBytes / 2);
+	ipReassemblyBudgetFeed(lruReassembly, 1, 0, true, 64);
+	ipReassemblyBudgetFeed(lruReassembly, 2, 0, true, 64);
+	ipReassemblyBudgetFeed(lruReassembly, 1, 64, true, 8);
+	PTF_ASSERT_TRUE(lruDropped.empty());
+	ipReassemblyBudgetFeed(lruReassembly, 3, 0, true, 64);
+	PTF_ASSERT_EQUAL(lruDropped.size(), 1, size);
+	PTF_ASSERT_EQUAL(lruDropped[0], 2, u16);
+	PTF_ASSERT_EQUAL(lruReassembly.getNumOfEvictedPackets(), 1, u32);
+	PTF_ASSERT_EQUAL(lruReassembly.getCurrentCapacity(), 2, size);
+	PTF_ASSERT_FALSE(lruReassembly.getMemoryBudget()->isExceeded());
+	PTF_ASSERT_EQUAL(ipReassemblyBudgetFeed(lruReassembly, 1, 72, false, 8), IPReassembly::REASSEMBLED, enum);
+
+	// oldest first
+	std::vector<uint16_t> oldestDropped;
+	IPReassembly oldestReassembly(ipReassemblyBudgetFragmentsClean, &oldestDropped, PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE, 2 * packetBytes + packetBytes / 2, EvictOldestFirst);
+	ipReassemblyBudgetFeed(oldestReassembly, 1, 0, true, 64);
+	ipReassemblyBudgetFeed(oldestReassembly, 2, 0, true, 64);
+	ipReassemblyBudgetFeed(oldestReassembly, 1, 64, true, 8);
+	ipReassemblyBudgetFeed(oldestReassembly, 3, 0, true, 64);
+	PTF_ASSERT_EQUAL(oldestDropped.size(), 1, size);
+	PTF_ASSERT_EQUAL(oldestDropped[0], 1, u16);
+
+	// largest first: the packet with a large out-of-order fragment is dropped
+	std::vector<uint16_t> largestDropped;
+	MemoryBudget largestBudget;
+	IPReassembly largestReassembly(ipReassemblyBudgetFragmentsClean, &largestDropped, PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE, 0, EvictLargestFirst);
+	largestReassembly.setMemoryBudget(&largestBudget);
+	ipReassemblyBudgetFeed(largestReassembly, 1, 0, true, 64);
+	ipReassemblyBudgetFeed(largestReassembly, 2, 0, true, 64);
+	ipReassemblyBudgetFeed(largestReassembly, 2, 1024, true, 1024);
+	ipReassemblyBudgetFeed(largestReassembly, 3, 0, true, 64);
+	largestBudget.setMaxBytes(largestBudget.getUsedBytes() + packetBytes / 2);
+	PTF_ASSERT_TRUE(largestDropped.empty());
+	ipReassemblyBudgetFeed(largestReassembly, 4, 0, true, 64);
+	PTF_ASSERT_EQUAL(largestDropped.size(), 1, size);
+	PTF_ASSERT_EQUAL(largestDropped[0], 2, u16);
+	PTF_ASSERT_EQUAL(largestReassembly.getMemoryUsage(), 3 * packetBytes, size);
+
+	// a budget shared with TcpReassembly
+	MemoryBudget sharedBudget;
+	TcpReassemblyIdleStats tcpStats;
+	TcpReassembly tcpReassembly(tcpReassemblyIdleMsgReady, &tcpStats, NULL, tcpReassemblyIdleConnEnd);
+	tcpReassembly.setMemoryBudget(&sharedBudget);
+	largestReassembly.setMemoryBudget(&sharedBudget);
+	tcpReassemblyIdleFeed(tcpReassembly, 1000, 1000, 1000);
+	PTF_ASSERT_EQUAL(sharedBudget.getUsedBytes(), tcpReassembly.getMemoryUsage() + largestReassembly.getMemoryUsage(), size);
+	PTF_ASSERT_EQUAL(largestReassembly.getMemoryBudget()->getUsedBytes(), sharedBudget.getUsedBytes(), size);
+	largestReassembly.removePacket(IPReassembly::IPv4PacketKey(1, IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2"))));
+	PTF_ASSERT_EQUAL(largestReassembly.getMemoryUsage(), 2 * packetBytes, size);
+	PTF_ASSERT_EQUAL(sharedBudget.getUsedBytes(), tcpReassembly.getMemoryUsage() + 2 * packetBytes, size);
+	largestReassembly.setMemoryBudget(NULL);
+	PTF_ASSERT_EQUAL(sharedBudget.getUsedBytes(), tcpReassembly.getMemoryUsage(), size);
+} // IPReassemblyMemoryBudgetTest
+
+
+// create a fragment of a packet whose data bytes are their offset in the packet, with or without an IPv4 option
+static RawPacket* ipReassemblyInPlaceCreateFragment(uint16_t fragmentOffset, bool moreFragments, size_t dataLen, bool withOption)
+{
+	Packet packet(100 + dataLen);
+	EthLayer ethLayer(MacAddress("00:00:00:00:00:01"), MacAddress("00:00:00:00:00:02"), PCPP_ETHERTYPE_IP);
+	IPv4Layer ipLayer(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	ipLayer.getIPv4Header()->timeToLive = 64;
+	ipLayer.getIPv4Header()->ipId = htons(7);
+	std::vector<uint8_t> data(dataLen);
+	for (size_t i = 0; i < dataLen; i++)
+		data[i] = (uint8_t)(fragmentOffset + i);
+	PayloadLayer payloadLayer(&data[0], dataLen, false);
+	packet.addLayer(&ethLayer);
+	packet.addLayer(&ipLayer);
+	packet.addLayer(&payloadLayer);
+	if (withOption)
+		ipLayer.addOption(IPv4OptionBuilder(IPV4OPT_RouterAlert, (uint16_t)0));
+	packet.computeCalculateFields();
+	ipLayer.getIPv4Header()->fragmentOffset = htons(fragmentOffset / 8) | (moreFragments ? PCPP_IP_MORE_FRAGMENTS : 0);
+	return new RawPacket(*packet.getRawPacket());
+}
+
+// check the IP payload of a reassembled packet holds the bytes of each offset
+static bool ipReassemblyInPlaceCheckData(Packet* packet, size_t dataLen)
+{
+	IPv4Layer* ipLayer = packet->getLayerOfType<IPv4Layer>();
+	if (ipLayer == NULL || ipLayer->getLayerPayloadSize() != dataLen)
+		return false;
+
+	for (size_t i = 0; i < dataLen; i++)
+	{
+		if (ipLayer->getLayerPayload()[i] != (uint8_t)i)
+			return false;
+	}
+
+	return true;
+}
+
+PTF_TEST_CASE(IPReassemblyInPlaceTest)
+{
+	IPReassembly ipReassembly;
+	IPReassembly::ReassemblyStatus status;
+
+	// fragments arriving in reverse order are copied straight to their place in the reassembly buffer
+	RawPacket* fragments[3];
+	fragments[0] = ipReassemblyInPlaceCreateFragment(0, true, 64, false);
+	fragments[1] = ipReassemblyInPlaceCreateFragment(64, true, 64, false);
+	fragments[2] = ipReassemblyInPlaceCreateFragment(128, false, 40, false);
+	PTF_ASSERT_NULL(ipReassembly.processPacket(fragments[2], status));
+	PTF_ASSERT_EQUAL(status, IPReassembly::OUT_OF_ORDER_FRAGMENT, enum);
+	PTF_ASSERT_NULL(ipReassembly.processPacket(fragments[1], status));
+	PTF_ASSERT_EQUAL(status, IPReassembly::OUT_OF_ORDER_FRAGMENT, enum);
+	Packet* reassembledPacket = ipReassembly.processPacket(fragments[0], status);
+	PTF_ASSERT_EQUAL(status, IPReassembly::REASSEMBLED, enum);
+	PTF_ASSERT_NOT_NULL(reassembledPacket);
+	PTF_ASSERT_EQUAL(reassembledPacket->getRawPacket()->getRawDataLen(), 14 + 20 + 168, int);
+	IPv4Layer* ipLayer = reassembledPacket->getLayerOfType<IPv4Layer>();
+	PTF_ASSERT_EQUAL(ntohs(ipLayer->getIPv4Header()->totalLength), 20 + 168, u16);
+	PTF_ASSERT_FALSE(ipLayer->isFragment());
+	PTF_ASSERT_TRUE(ipReassemblyInPlaceCheckData(reassembledPacket, 168));
+	delete reassembledPacket;
+	PTF_ASSERT_EQUAL(ipReassembly.getCurrentCapacity(), 0, size);
+	PTF_ASSERT_EQUAL(ipReassembly.getMemoryUsage(), 0, size);
+	for (int i = 0; i < 3; i++)
+		delete fragments[i];
+
+	// the first fragment has longer headers than the out-of-order fragment the buffer was allocated for, so the data moves after them
+	fragments[0] = ipReassemblyInPlaceCreateFragment(0, true, 64, true);
+	fragments[1] = ipReassemblyInPlaceCreateFragment(64, false, 40, false);
+	PTF_ASSERT_NULL(ipReassembly.processPacket(fragments[1], status));
+	PTF_ASSERT_EQUAL(status, IPReassembly::OUT_OF_ORDER_FRAGMENT, enum);
+	reassembledPacket = ipReassembly.processPacket(fragments[0], status);
+	PTF_ASSERT_EQUAL(status, IPReassembly::REASSEMBLED, enum);
+	PTF_ASSERT_NOT_NULL(reassembledPacket);
+	PTF_ASSERT_EQUAL(reassembledPacket->getRawPacket()->getRawDataLen(), 14 + 24 + 104, int);
+	ipLayer = reassembledPacket->getLayerOfType<IPv4Layer>();
+	PTF_ASSERT_EQUAL(ipLayer->getHeaderLen(), 24, size);
+	PTF_ASSERT_EQUAL(ntohs(ipLayer->getIPv4Header()->totalLength), 24 + 104, u16);
+	PTF_ASSERT_TRUE(ipReassemblyInPlaceCheckData(reassembledPacket, 104));
+	delete reassembledPacket;
+	delete fragments[0];
+	delete fragments[1];
+
+	// a partially reassembled packet holds only the data received in order
+	fragments[0] = ipReassemblyInPlaceCreateFragment(0, true, 64, false);
+	fragments[1] = ipReassemblyInPlaceCreateFragment(64, true, 64, false);
+	fragments[2] = ipReassemblyInPlaceCreateFragment(128, false, 40, false);
+	PTF_ASSERT_NULL(ipReassembly.processPacket(fragments[0], status));
+	PTF_ASSERT_EQUAL(status, IPReassembly::FIRST_FRAGMENT, enum);
+	PTF_ASSERT_NULL(ipReassembly.processPacket(fragments[2], status));
+	PTF_ASSERT_EQUAL(status, IPReassembly::OUT_OF_ORDER_FRAGMENT, enum);
+	IPReassembly::IPv4PacketKey key(7, IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	Packet* partialPacket = ipReassembly.getCurrentPacket(key);
+	PTF_ASSERT_NOT_NULL(partialPacket);
+	PTF_ASSERT_EQUAL(partialPacket->getRawPacket()->getRawDataLen(), 14 + 20 + 64, int);
+	PTF_ASSERT_TRUE(ipReassemblyInPlaceCheckData(partialPacket, 64));
+	delete partialPacket;
+	reassembledPacket = ipReassembly.processPacket(fragments[1], status);
+	PTF_ASSERT_EQUAL(status, IPReassembly::REASSEMBLED, enum);
+	PTF_ASSERT_TRUE(ipReassemblyInPlaceCheckData(reassembledPacket, 168));
+	delete reassembledPacket;
+	for (int i = 0; i < 3; i++)
+		delete fragments[i];
+
+	// a non-fragment given as a RawPacket is returned parsed as deep as requested
+	fragments[0] = ipReassemblyInPlaceCreateFragment(0, false, 40, false);
+	Packet* nonFragment = ipReassembly.processPacket(fragments[0], status);
+	PTF_ASSERT_EQUAL(status, IPReassembly::NON_FRAGMENT, enum);
+	PTF_ASSERT_NOT_NULL(nonFragment);
+	PTF_ASSERT_NOT_NULL(nonFragment->getLayerOfType<PayloadLayer>());
+	delete nonFragment;
+	nonFragment = ipReassembly.processPacket(fragments[0], status, UnknownProtocol, OsiModelDataLinkLayer);
+	PTF_ASSERT_EQUAL(status, IPReassembly::NON_IP_PACKET, enum);
+	PTF_ASSERT_NOT_NULL(nonFragment);
+	delete nonFragment;
+	delete fragments[0];
+
+	// with a pool the reassembly buffer is taken from it and becomes the data of the reassembled packet
+	RawPacketPool pool;
+	ipReassembly.setRawPacketPool(&pool);
+	fragments[0] = ipReassemblyInPlaceCreateFragment(0, true, 64, false);
+	fragments[1] = ipReassemblyInPlaceCreateFragment(64, false, 40, false);
+	PTF_ASSERT_NULL(ipReassembly.processPacket(fragments[0], status));
+	reassembledPacket = ipReassembly.processPacket(fragments[1], status);
+	PTF_ASSERT_EQUAL(status, IPReassembly::REASSEMBLED, enum);
+	PTF_ASSERT_TRUE(ipReassemblyInPlaceCheckData(reassembledPacket, 104));
+	PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 1, size);
+	delete reassembledPacket;
+	PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 0, size);
+	ipReassembly.setRawPacketPool(NULL);
+	delete fragments[0];
+	delete fragments[1];
+} // IPReassemblyInPlaceTest
+
+
+// feed a fragment with a timestamp and return the IP reassembly status
+static IPReassembly::ReassemblyStatus ipReassemblyTimeoutFeed(IPReassembly& ipReassembly, uint16_t ipId, uint16_t fragmentOffset, bool moreFragments, time_t timestamp)
+{
+	RawPacket* fragment = ipReassemblyBudgetCreateFragment(ipId, fragmentOffset, moreFragments, 64);
+	timeval packetTime;
+	packetTime.tv_sec = timestamp;
+	packetTime.tv_usec = 0;
+	fragment->setPacketTimeStamp(packetTime);
+	IPReassembly::ReassemblyStatus status;
+	delete ipReassembly.processPacket(fragment, status);
+	delete fragment;
+	return status;
+}
+
+PTF_TEST_CASE(IPReassemblyTimeoutTest)
+{
+	std::vector<uint16_t> expired;
+	IPReassembly ipReassembly(ipReassemblyBudgetFragmentsClean, &expired, PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE, 0, EvictLeastRecentlyUsed, 30);
+	PTF_ASSERT_EQUAL(ipReassembly.getFragmentTimeout(), 30, u32);
+
+	// the timeout counts from the first fragment, following fragments don't move it
+	PTF_ASSERT_EQUAL(ipReassemblyTimeoutFeed(ipReassembly, 1, 0, true, 100), IPReassembly::FIRST_FRAGMENT, enum);
+	PTF_ASSERT_EQUAL(ipReassemblyTimeoutFeed(ipReassembly, 2, 0, true, 110), IPReassembly::FIRST_FRAGMENT, enum);
+	PTF_ASSERT_EQUAL(ipReassemblyTimeoutFeed(ipReassembly, 1, 64, true, 125), IPReassembly::FRAGMENT, enum);
+	PTF_ASSERT_TRUE(expired.empty());
+	PTF_ASSERT_EQUAL(ipReassemblyTimeoutFeed(ipReassembly, 3, 0, true, 131), IPReassembly::FIRST_FRAGMENT, enum);
+	PTF_ASSERT_EQUAL(expired.size(), 1, size);
+	PTF_ASSERT_EQUAL(expired[0], 1, u16);
+	PTF_ASSERT_EQUAL(ipReassembly.getNumOfExpiredPackets(), 1, u32);
+	PTF_ASSERT_EQUAL(ipReassembly.getCurrentCapacity(), 2, size);
+
+	// a late fragment of an expired packet begins a new one
+	PTF_ASSERT_EQUAL(ipReassemblyTimeoutFeed(ipReassembly, 1, 128, false, 131), IPReassembly::OUT_OF_ORDER_FRAGMENT, enum);
+	PTF_ASSERT_EQUAL(ipReassembly.getCurrentCapacity(), 3, size);
+
+	// time moves forward without fragments, and earlier times are ignored
+	timeval currentTime;
+	currentTime.tv_sec = 141;
+	currentTime.tv_usec = 0;
+	ipReassembly.advanceTime(currentTime);
+	PTF_ASSERT_EQUAL(expired.size(), 2, size);
+	PTF_ASSERT_EQUAL(expired[1], 2, u16);
+	currentTime.tv_sec = 50;
+	ipReassembly.advanceTime(currentTime);
+	PTF_ASSERT_EQUAL(ipReassembly.getCurrentCapacity(), 2, size);
+
+	// a reassembled packet doesn't expire
+	PTF_ASSERT_EQUAL(ipReassemblyTimeoutFeed(ipReassembly, 3, 64, false, 150), IPReassembly::REASSEMBLED, enum);
+	currentTime.tv_sec = 200;
+	ipReassembly.advanceTime(currentTime);
+	PTF_ASSERT_EQUAL(expired.size(), 3, size);
+	PTF_ASSERT_EQUAL(expired[2], 1, u16);
+	PTF_ASSERT_EQUAL(ipReassembly.getNumOfExpiredPackets(), 3, u32);
+	PTF_ASSERT_EQUAL(ipReassembly.getCurrentCapacity(), 0, size);
+	PTF_ASSERT_EQUAL(ipReassembly.getMemoryUsage(), 0, size);
+
+	// without a timeout fragments far apart are still reassembled
+	IPReassembly noTimeoutReassembly;
+	PTF_ASSERT_EQUAL(noTimeoutReassembly.getFragmentTimeout(), 0, u32);
+	PTF_ASSERT_EQUAL(ipReassemblyTimeoutFeed(noTimeoutReassembly, 1, 0, true, 100), IPReassembly::FIRST_FRAGMENT, enum);
+	PTF_ASSERT_EQUAL(ipReassemblyTimeoutFeed(noTimeoutReassembly, 1, 64, false, 100000), IPReassembly::REASSEMBLED, enum);
+	PTF_ASSERT_EQUAL(noTimeoutReassembly.getNumOfExpiredPackets(), 0, u32);
+} // IPReassemblyTimeoutTest
+
+
+struct ShardedIPReassemblyShardStats
+{
+	// the payload length of each reassembled packet by its IP ID
+	std::map<uint16_t, size_t> reassembledPackets;
+	bool dataValid;
+
+	ShardedIPReassemblyShardStats() : dataValid(true) {}
+};
+
+static void shardedIPReassemblyPacketReassembled(Packet* reassembledPacket, int shardIndex, void* userCookie)
+{
+	ShardedIPReassemblyShardStats* stats = (ShardedIPReassemblyShardStats*)userCookie;
+	IPv4Layer* ipLayer = reassembledPacket->getLayerOfType<IPv4Layer>();
+	uint16_t ipId = ntohs(ipLayer->getIPv4Header()->ipId);
+	size_t payloadLen = ipLayer->getLayerPayloadSize();
+	for (size_t i = 0; i < payloadLen; i++)
+	{
+		if (ipLayer->getLayerPayload()[i] != (uint8_t)ipId)
+			stats->dataValid = false;
+	}
+
+	stats->reassembledPackets[ipId] = payloadLen;
+	delete reassembledPacket;
+}
+
+struct ShardedIPReassemblyProducer
+{
+	ShardedIPReassembly* reassembly;
+	int producerId;
+	std::vector<RawPacket*> packets;
+	size_t numOfQueued;
+};
+
+static void* shardedIPReassemblyProducerMain(void* producerPtr)
+{
+	ShardedIPReassemblyProducer* producer = (ShardedIPReassemblyProducer*)producerPtr;
+	producer->numOfQueued = 0;
+	for (std::vector<RawPacket*>::iterator iter = producer->packets.begin(); iter != producer->packets.end(); iter++)
+	{
+		if (producer->reassembly->reassemblePacket(*iter, producer->producerId))
+			producer->numOfQueued++;
+	}
+
+	return NULL;
+}
+
+PTF_TEST_CASE(ShardedIPReassemblyTest)
+{
+	const int numOfShards = 4;
+	const int numOfProducers = 2;
+	const int numOfPackets = 200;
+	const int numOfFragments = 3;
+
+	// small queues so producers have to wait for the shards
+	ShardedIPReassemblyShardStats shardStats[numOfShards];
+	ShardedIPReassemblyConfiguration config(numOfShards, numOfProducers, 16);
+	ShardedIPReassembly reassembly(shardedIPReassemblyPacketReassembled, NULL, NULL, config);
+	PTF_ASSERT_EQUAL(reassembly.getNumOfShards(), numOfShards, int);
+	PTF_ASSERT_EQUAL(reassembly.getNumOfProducers(), numOfProducers, int);
+	for (int i = 0; i < numOfShards; i++)
+		reassembly.setShardUserCookie(i, &shardStats[i]);
+
+	// the fragments of each packet are split between the producers, so they may reach the shard in any order
+	ShardedIPReassemblyProducer producers[numOfProducers];
+	std::map<uint16_t, int> expectedShard;
+	std::vector<int> numOfPacketsPerShard(numOfShards, 0);
+	for (int packet = 0; packet < numOfPackets; packet++)
+	{
+		uint16_t ipId = (uint16_t)(1000 + packet);
+		for (int frag = 0; frag < numOfFragments; frag++)
+		{
+			RawPacket* fragment = ipReassemblyBudgetCreateFragment(ipId, (uint16_t)(frag * 64), frag < numOfFragments - 1, 64);
+			int shardIndex = reassembly.getShardIndex(fragment);
+			if (frag == 0)
+			{
+				expectedShard[ipId] = shardIndex;
+				numOfPacketsPerShard[shardIndex]++;
+			}
+			PTF_ASSERT_EQUAL(shardIndex, expectedShard[ipId], int);
+			producers[(packet + frag) % numOfProducers].packets.push_back(fragment);
+		}
+	}
+
+	// packets are spread over all shards
+	for (int i = 0; i < numOfShards; i++)
+		PTF_ASSERT_TRUE(numOfPacketsPerShard[i] > 0);
+
+	// the hash is symmetric: a fragment with swapped addresses belongs to the same shard
+	RawPacket swappedFragment(*producers[0].packets[0]);
+	iphdr* swappedHeader = (iphdr*)(swappedFragment.getRawData() + sizeof(ether_header));
+	uint32_t srcIP = swappedHeader->ipSrc;
+	swappedHeader->ipSrc = swappedHeader->ipDst;
+	swappedHeader->ipDst = srcIP;
+	PTF_ASSERT_EQUAL(reassembly.getShardIndex(&swappedFragment), reassembly.getShardIndex(producers[0].packets[0]), int);
+
+	PTF_ASSERT_TRUE(reassembly.start());
+	PTF_ASSERT_TRUE(reassembly.isRunning());
+
+	pthread_t producerThreads[numOfProducers];
+	for (int i = 0; i < numOfProducers; i++)
+	{
+		producers[i].reassembly = &reassembly;
+		producers[i].producerId = i;
+		PTF_ASSERT_EQUAL(pthread_create(&producerThreads[i], NULL, shardedIPReassemblyProducerMain, &producers[i]), 0, int);
+	}
+	for (int i = 0; i < numOfProducers; i++)
+		pthread_join(producerThreads[i], NULL);
+
+	for (int i = 0; i < numOfProducers; i++)
+		PTF_ASSERT_EQUAL(producers[i].numOfQueued, producers[i].packets.size(), size);
+
+	// packets which aren't fragments and invalid producer IDs are rejected
+	RawPacket* nonFragment = ipReassemblyBudgetCreateFragment(1, 0, false, 64);
+	PTF_ASSERT_EQUAL(reassembly.getShardIndex(nonFragment), -1, int);
+	PTF_ASSERT_FALSE(reassembly.reassemblePacket(nonFragment, 0));
+	delete nonFragment;
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(reassembly.reassemblePacket(producers[0].packets[0], numOfProducers));
+	LoggerPP::getInstance().enableErrors();
+
+	reassembly.flush();
+
+	// each packet was reassembled completely by the shard its hash maps to
+	size_t numOfReassembled = 0;
+	for (int i = 0; i < numOfShards; i++)
+	{
+		PTF_ASSERT_TRUE(shardStats[i].dataValid);
+		numOfReassembled += shardStats[i].reassembledPackets.size();
+		for (std::map<uint16_t, size_t>::iterator iter = shardStats[i].reassembledPackets.begin(); iter != shardStats[i].reassembledPackets.end(); iter++)
+		{
+			PTF_ASSERT_EQUAL(expectedShard[iter->first], i, int);
+			PTF_ASSERT_EQUAL(iter->second, (size_t)(64 * numOfFragments), size);
+		}
+	}
+	PTF_ASSERT_EQUAL(numOfReassembled, (size_t)numOfPackets, size);
+
+	uint64_t totals[ShardedIPReassembly::NumOfStatsCounters];
+	reassembly.getStatsCounters().aggregate(totals);
+	PTF_ASSERT_EQUAL(totals[ShardedIPReassembly::PacketsQueued], (uint64_t)(numOfPackets * numOfFragments), u32);
+	PTF_ASSERT_EQUAL(totals[ShardedIPReassembly::PacketsProcessed], (uint64_t)(numOfPackets * numOfFragments), u32);
+	PTF_ASSERT_EQUAL(totals[ShardedIPReassembly::PacketsReassembled], (uint64_t)numOfPackets, u32);
+	PTF_ASSERT_EQUAL(totals[ShardedIPReassembly::PacketsIgnored], 1, u32);
+	PTF_ASSERT_EQUAL(totals[ShardedIPReassembly::MemoryUsage], 0, u32);
+
+	reassembly.stop();
+	PTF_ASSERT_FALSE(reassembly.isRunning());
+
+	// when the threads aren't running fragments are rejected unless the queue has room, and flush() processes them on the calling thread
+	PTF_ASSERT_TRUE(reassembly.reassemblePacket(producers[0].packets[0], 0));
+	reassembly.flush();
+	reassembly.getStatsCounters().aggregate(totals);
+	PTF_ASSERT_EQUAL(totals[ShardedIPReassembly::PacketsProcessed], (uint64_t)(numOfPackets * numOfFragments + 1), u32);
+	PTF_ASSERT_TRUE(totals[ShardedIPReassembly::MemoryUsage] > 0);
+
+	for (int i = 0; i < numOfProducers; i++)
+	{
+		for (std::vector<RawPacket*>::iterator iter = producers[i].packets.begin(); iter != producers[i].packets.end(); iter++)
+			delete (*iter);
+	}
+} // ShardedIPReassemblyTest
+
+
+static void tcpReassemblyCheckpointMsgReady(int side, const TcpStreamData& tcpData, void* userCookie)
+{
+	*((std::string*)userCookie) += std::string((char*)tcpData.getData(), tcpData.getDataLength());
+}
+
+PTF_TEST_CASE(TcpReassemblyCheckpointTest)
+{
+	// an open connection with out-of-order data and a closed connection waiting to be cleaned up
+	std::string originalData;
+	TcpReassemblyConfiguration config(true, 5, 30, 0, 0, 10);
+	TcpReassembly original(tcpReassemblyCheckpointMsgReady, &originalData, NULL, NULL, config);
+	tcpReassemblyIdleFeed(original, 1000, 1000, 1000, "abcd");
+	tcpReassemblyIdleFeed(original, 1000, 1008, 1000, "ijkl");
+	tcpReassemblyIdleFeed(original, 2000, 1000, 1000, "ABCD");
+	const TcpReassembly::ConnectionInfoList& originalConnections = original.getConnectionInformation();
+	for (TcpReassembly::ConnectionInfoList::const_iterator iter = originalConnections.begin(); iter != originalConnections.end(); ++iter)
+	{
+		if (iter->second.srcPort == 2000)
+		{
+			original.closeConnection(iter->first);
+			break;
+		}
+	}
+	PTF_ASSERT_EQUAL(originalData, "abcdABCD", string);
+
+	// the state is saved twice to one buffer and restored by two instances one after the other
+	std::vector<uint8_t> checkpoint;
+	CheckpointWriter writer(checkpoint);
+	original.saveState(writer);
+	size_t stateLen = writer.getSize();
+	original.saveState(writer);
+	PTF_ASSERT_EQUAL(writer.getSize(), 2 * stateLen, size);
+
+	std::string restoredData;
+	std::string secondData;
+	TcpReassembly restored(tcpReassemblyCheckpointMsgReady, &restoredData, NULL, NULL, config);
+	TcpReassembly second(tcpReassemblyCheckpointMsgReady, &secondData, NULL, NULL, config);
+	CheckpointReader reader(&checkpoint[0], checkpoint.size());
+	PTF_ASSERT_TRUE(restored.restoreState(reader));
+	PTF_ASSERT_EQUAL(reader.getOffset(), stateLen, size);
+	PTF_ASSERT_TRUE(second.restoreState(reader));
+	PTF_ASSERT_EQUAL(reader.getRemainingBytes(), 0, size);
+
+	const TcpReassembly::ConnectionInfoList& connections = restored.getConnectionInformation();
+	PTF_ASSERT_EQUAL(connections.size(), 2, size);
+	PTF_ASSERT_EQUAL(restored.getOutOfOrderBytes(), original.getOutOfOrderBytes(), size);
+	for (TcpReassembly::ConnectionInfoList::const_iterator iter = connections.begin(); iter != connections.end(); ++iter)
+	{
+		const ConnectionData* originalConn = originalConnections.find(iter->first) != originalConnections.end() ? &originalConnections.find(iter->first)->second : NULL;
+		PTF_ASSERT_NOT_NULL(originalConn);
+		PTF_ASSERT_TRUE(iter->second.srcIP == originalConn->srcIP);
+		PTF_ASSERT_EQUAL(iter->second.srcPort, originalConn->srcPort, u16);
+		PTF_ASSERT_EQUAL(iter->second.startTime.tv_sec, originalConn->startTime.tv_sec, int);
+		PTF_ASSERT_EQUAL(restored.isConnectionOpen(iter->second), (iter->second.srcPort == 1000 ? 1 : 0), int);
+	}
+
+	// the missing segment completes the connection in the restored instance as it does in the original one
+	tcpReassemblyIdleFeed(original, 1000, 1004, 1002, "efgh");
+	tcpReassemblyIdleFeed(restored, 1000, 1004, 1002, "efgh");
+	tcpReassemblyIdleFeed(second, 1000, 1004, 1002, "efgh");
+	PTF_ASSERT_EQUAL(originalData, "abcdABCDefghijkl", string);
+	PTF_ASSERT_EQUAL(restoredData, "efghijkl", string);
+	PTF_ASSERT_EQUAL(secondData, "efghijkl", string);
+
+	// the timers keep their expiry times: the closed connection is cleaned up 5 seconds after it was closed, the open one after 10 idle seconds
+	timeval currentTime;
+	currentTime.tv_sec = 1006;
+	currentTime.tv_usec = 0;
+	restored.advanceTime(currentTime);
+	PTF_ASSERT_EQUAL(connections.size(), 1, size);
+	PTF_ASSERT_EQUAL(restored.isConnectionOpen(connections.begin()->second), 1, int);
+	currentTime.tv_sec = 1013;
+	restored.advanceTime(currentTime);
+	PTF_ASSERT_EQUAL(restored.isConnectionOpen(connections.begin()->second), 0, int);
+
+	// a state can't be restored to an instance which already manages connections, and an invalid checkpoint changes nothing
+	LoggerPP::getInstance().supressErrors();
+	CheckpointReader nonEmptyReader(&checkpoint[0], stateLen);
+	PTF_ASSERT_FALSE(second.restoreState(nonEmptyReader));
+
+	std::string invalidData;
+	TcpReassembly invalid(tcpReassemblyCheckpointMsgReady, &invalidData, NULL, NULL, config);
+	CheckpointReader truncatedReader(&checkpoint[0], stateLen - 1);
+	PTF_ASSERT_FALSE(invalid.restoreState(truncatedReader));
+	PTF_ASSERT_EQUAL(invalid.getConnectionInformation().size(), 0, size);
+	std::vector<uint8_t> corrupted(checkpoint.begin(), checkpoint.begin() + stateLen);
+	corrupted[0] ^= 0xFF;
+	CheckpointReader corruptedReader(&corrupted[0], corrupted.size());
+	PTF_ASSERT_FALSE(invalid.restoreState(corruptedReader));
+	PTF_ASSERT_FALSE(invalid.restoreState(std::string("NoSuchDirectory/TcpReassemblyCheckpoint.bin")));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL(invalid.getConnectionInformation().size(), 0, size);
+
+	// saving to a file and restoring from it
+	std::string fileName = "TcpReassemblyCheckpoint.bin";
+	PTF_ASSERT_TRUE(second.saveState(fileName));
+	PTF_ASSERT_TRUE(invalid.restoreState(fileName));
+	remove(fileName.c_str());
+	PTF_ASSERT_EQUAL(invalid.getConnectionInformation().size(), second.getConnectionInformation().size(), size);
+} // TcpReassemblyCheckpointTest
+
+struct TcpReassemblyByteLimitStats
+{
+	std::string data;
+	std::vector<uint32_t> bypassedFlowKeys;
+	TcpReassembly* reassembly;
+	size_t callbackLimit;
+
+	TcpReassemblyByteLimitStats() : reassembly(NULL), callbackLimit(0) {}
+};
+
+static void tcpReassemblyByteLimitMsgReady(int side, const TcpStreamData& tcpData, void* userCookie)
+{
+	TcpReassemblyByteLimitStats* stats = (TcpReassemblyByteLimitStats*)userCookie;
+	stats->data += std::string((char*)tcpData.getData(), tcpData.getDataLength());
+
+	// the callback may lower the limits of the connection it's called for
+	if (stats->reassembly != NULL && stats->callbackLimit > 0)
+		stats->reassembly->setConnectionByteLimits(tcpData.getConnectionData().flowKey, 0, stats->callbackLimit);
+}
+
+static void tcpReassemblyByteLimitBypassed(const ConnectionData& connectionData, void* userCookie)
+{
+	((TcpReassemblyByteLimitStats*)userCookie)->bypassedFlowKeys.push_back(connectionData.flowKey);
+}
+
+static uint32_t tcpReassemblyByteLimitFlowKey(const TcpReassembly& tcpReassembly, uint16_t srcPort)
+{
+	const TcpReassembly::ConnectionInfoList& connections = tcpReassembly.getConnectionInformation();
+	for (TcpReassembly::ConnectionInfoList::const_iterator iter = connections.begin(); iter != connections.end(); ++iter)
+	{
+		if (iter->second.srcPort == srcPort)
+			return iter->first;
+	}
+
+	return 0;
+}
+
+// create a FIN packet of the client side or of the server side of a tcpReassemblyZeroCopyCreatePacket() connection
+static RawPacket* tcpReassemblyByteLimitFinPacket(uint32_t sequence, const char* data, uint16_t clientPort, bool fromServer)
+{
+	RawPacket* rawPacket = tcpReassemblyZeroCopyCreatePacket(sequence, data, clientPort);
+	Packet packet(rawPacket);
+	TcpLayer* tcpLayer = packet.getLayerOfType<TcpLayer>();
+	tcpLayer->getTcpHeader()->finFlag = 1;
+	if (fromServer)
+	{
+		iphdr* ipHeader = packet.getLayerOfType<IPv4Layer>()->getIPv4Header();
+		uint32_t srcIP = ipHeader->ipSrc;
+		ipHeader->ipSrc = ipHeader->ipDst;
+		ipHeader->ipDst = srcIP;
+		tcpLayer->getTcpHeader()->portSrc = htons(80);
+		tcpLayer->getTcpHeader()->portDst = htons(clientPort);
+	}
+
+	return rawPacket;
+}
+
+PTF_TEST_CASE(TcpReassemblyByteLimitTest)
+{
+	// the data of a side is cut off at its limit and the connection is bypassed
+	TcpReassemblyByteLimitStats stats;
+	TcpReassemblyConfiguration config(true, 5, 30, 0, 0, 0, 0, EvictLeastRecentlyUsed, 6);
+	TcpReassembly reassembly(tcpReassemblyByteLimitMsgReady, &stats, NULL, NULL, config);
+	reassembly.setOnConnectionBypassedCallback(tcpReassemblyByteLimitBypassed);
+	tcpReassemblyIdleFeed(reassembly, 1000, 1000, 1000, "abcd");
+	uint32_t flowKey = tcpReassemblyByteLimitFlowKey(reassembly, 1000);
+	PTF_ASSERT_FALSE(reassembly.isConnectionBypassed(flowKey));
+	tcpReassemblyIdleFeed(reassembly, 1000, 1004, 1000, "efgh");
+	PTF_ASSERT_EQUAL(stats.data, "abcdef", string);
+	PTF_ASSERT_TRUE(reassembly.isConnectionBypassed(flowKey));
+	PTF_ASSERT_EQUAL(stats.bypassedFlowKeys.size(), 1, size);
+	PTF_ASSERT_EQUAL(stats.bypassedFlowKeys[0], flowKey, u32);
+
+	// the packets of a bypassed connection are only counted, and the FIN packets of both sides still close it
+	tcpReassemblyIdleFeed(reassembly, 1000, 1008, 1000, "ijkl");
+	tcpReassemblyFeedAndDelete(reassembly, tcpReassemblyByteLimitFinPacket(1012, "mnop", 1000, false));
+	PTF_ASSERT_EQUAL(reassembly.isConnectionOpen(reassembly.getConnectionInformation().find(flowKey)->second), 1, int);
+	tcpReassemblyFeedAndDelete(reassembly, tcpReassemblyByteLimitFinPacket(5000, "qrst", 1000, true));
+	PTF_ASSERT_EQUAL(stats.data, "abcdef", string);
+	PTF_ASSERT_EQUAL(reassembly.getNumOfBypassedConnections(), 1, u32);
+	PTF_ASSERT_EQUAL(reassembly.getNumOfBypassedPayloadBytes(), 12, u32);
+	PTF_ASSERT_EQUAL(reassembly.isConnectionOpen(reassembly.getConnectionInformation().find(flowKey)->second), 0, int);
+	PTF_ASSERT_FALSE(reassembly.bypassConnection(flowKey));
+	PTF_ASSERT_FALSE(reassembly.setConnectionByteLimits(0x1234, 1, 1));
+	PTF_ASSERT_FALSE(reassembly.isConnectionBypassed(0x1234));
+
+	// a connection bypassed by the user drops its out-of-order data
+	TcpReassemblyByteLimitStats userStats;
+	TcpReassembly userReassembly(tcpReassemblyByteLimitMsgReady, &userStats);
+	tcpReassemblyIdleFeed(userReassembly, 2000, 1000, 1000, "abcd");
+	tcpReassemblyIdleFeed(userReassembly, 2000, 1008, 1000, "ijkl");
+	PTF_ASSERT_EQUAL(userReassembly.getOutOfOrderBytes(), 4, size);
+	PTF_ASSERT_TRUE(userReassembly.bypassConnection(tcpReassemblyByteLimitFlowKey(userReassembly, 2000)));
+	tcpReassemblyIdleFeed(userReassembly, 2000, 1004, 1000, "efgh");
+	PTF_ASSERT_EQUAL(userStats.data, "abcd", string);
+	PTF_ASSERT_EQUAL(userReassembly.getOutOfOrderBytes(), 0, size);
+	PTF_ASSERT_EQUAL(userReassembly.getNumOfBypassedConnections(), 1, u32);
+
+	// lowering the limit from the callback stops the delivery of the queued fragments which follow
+	TcpReassemblyByteLimitStats callbackStats;
+	TcpReassembly callbackReassembly(tcpReassemblyByteLimitMsgReady, &callbackStats);
+	callbackStats.reassembly = &callbackReassembly;
+	tcpReassemblyIdleFeed(callbackReassembly, 3000, 1000, 1000, "abcd");
+	tcpReassemblyIdleFeed(callbackReassembly, 3000, 1008, 1000, "ijkl");
+	callbackStats.callbackLimit = 6;
+	tcpReassemblyIdleFeed(callbackReassembly, 3000, 1004, 1000, "efgh");
+	PTF_ASSERT_EQUAL(callbackStats.data, "abcdefgh", string);
+	PTF_ASSERT_TRUE(callbackReassembly.isConnectionBypassed(tcpReassemblyByteLimitFlowKey(callbackReassembly, 3000)));
+	PTF_ASSERT_EQUAL(callbackReassembly.getOutOfOrderBytes(), 0, size);
+
+	// the limits, the delivered bytes and the bypass flag are saved with the state
+	TcpReassemblyByteLimitStats originalStats;
+	TcpReassembly original(tcpReassemblyByteLimitMsgReady, &originalStats);
+	tcpReassemblyIdleFeed(original, 4000, 1000, 1000, "abcd");
+	tcpReassemblyIdleFeed(original, 5000, 1000, 1000, "abcd");
+	PTF_ASSERT_TRUE(original.setConnectionByteLimits(tcpReassemblyByteLimitFlowKey(original, 4000), 0, 6));
+	PTF_ASSERT_TRUE(original.bypassConnection(tcpReassemblyByteLimitFlowKey(original, 5000)));
+
+	std::vector<uint8_t> checkpoint;
+	CheckpointWriter writer(checkpoint);
+	original.saveState(writer);
+	TcpReassemblyByteLimitStats restoredStats;
+	TcpReassembly restored(tcpReassemblyByteLimitMsgReady, &restoredStats);
+	CheckpointReader reader(&checkpoint[0], checkpoint.size());
+	PTF_ASSERT_TRUE(restored.restoreState(reader));
+	PTF_ASSERT_FALSE(restored.isConnectionBypassed(tcpReassemblyByteLimitFlowKey(restored, 4000)));
+	PTF_ASSERT_TRUE(restored.isConnectionBypassed(tcpReassemblyByteLimitFlowKey(restored, 5000)));
+	tcpReassemblyIdleFeed(restored, 4000, 1004, 1001, "efgh");
+	tcpReassemblyIdleFeed(restored, 5000, 1004, 1001, "efgh");
+	PTF_ASSERT_EQUAL(restoredStats.data, "ef", string);
+	PTF_ASSERT_TRUE(restored.isConnectionBypassed(tcpReassemblyByteLimitFlowKey(restored, 4000)));
+} // TcpReassemblyByteLimitTest
+
+struct TcpReassemblyHalfOpenStats
+{
+	std::string data;
+	std::vector<ConnectionData> startedConnections;
+};
+
+static void tcpReassemblyHalfOpenMsgReady(int side, TcpStreamData tcpData, void* userCookie)
+{
+	((TcpReassemblyHalfOpenStats*)userCookie)->data += std::string((char*)tcpData.getData(), tcpData.getDataLength());
+}
+
+static void tcpReassemblyHalfOpenConnStart(ConnectionData connectionData, void* userCookie)
+{
+	((TcpReassemblyHalfOpenStats*)userCookie)->startedConnections.push_back(connectionData);
+}
+
+// feed a packet of the client side or of the server side of a connection between 10.0.0.1:clientPort and 10.0.0.2:80
+static void tcpReassemblyHalfOpenFeed(TcpReassembly& tcpReassembly, uint16_t clientPort, bool fromServer, const char* flags, uint32_t sequence, uint32_t ackNumber,
+		const char* data, time_t packetTime)
+{
+	tcpReassemblyFeedAndDelete(tcpReassembly, tcpReassemblyZeroCopyCreatePacket(sequence, data, clientPort, fromServer, flags, ackNumber), packetTime);
+}
+
+PTF_TEST_CASE(TcpReassemblyHalfOpenTest)
+{
+	// the handshake is kept in the half-open table, and the connection starts when the ACK of the SYN-ACK arrives
+	TcpReassemblyHalfOpenStats stats;
+	TcpReassemblyConfiguration config(true, 5, 30, 0, 0, 0, 0, EvictLeastRecentlyUsed, 0, 0, 8, 3);
+	TcpReassembly reassembly(tcpReassemblyHalfOpenMsgReady, &stats, tcpReassemblyHalfOpenConnStart, NULL, config);
+	tcpReassemblyHalfOpenFeed(reassembly, 1000, false, "S", 100, 0, "", 10);
+	tcpReassemblyHalfOpenFeed(reassembly, 1000, false, "S", 100, 0, "", 10);
+	PTF_ASSERT_EQUAL(reassembly.getNumOfHalfOpenConnections(), 1, size);
+	tcpReassemblyHalfOpenFeed(reassembly, 1000, true, "SA", 500, 101, "", 11);
+	PTF_ASSERT_EQUAL(reassembly.getConnectionInformation().size(), 0, size);
+	PTF_ASSERT_EQUAL(stats.startedConnections.size(), 0, size);
+	tcpReassemblyHalfOpenFeed(reassembly, 1000, false, "A", 101, 501, "", 11);
+	PTF_ASSERT_EQUAL(reassembly.getNumOfHalfOpenConnections(), 0, size);
+	PTF_ASSERT_EQUAL(reassembly.getNumOfPromotedConnections(), 1, u32);
+	PTF_ASSERT_EQUAL(stats.startedConnections.size(), 1, size);
+	PTF_ASSERT_EQUAL(stats.startedConnections[0].srcPort, 1000, u16);
+	PTF_ASSERT_EQUAL(stats.startedConnections[0].dstPort, 80, u16);
+	PTF_ASSERT_EQUAL(stats.startedConnections[0].srcIP.toString(), "10.0.0.1", string);
+	PTF_ASSERT_EQUAL((int)stats.startedConnections[0].startTime.tv_sec, 10, int);
+
+	// the sequence numbers of both sides are taken from the handshake
+	tcpReassemblyHalfOpenFeed(reassembly, 1000, false, "A", 105, 501, "efgh", 12);
+	tcpReassemblyHalfOpenFeed(reassembly, 1000, false, "A", 101, 501, "abcd", 12);
+	tcpReassemblyHalfOpenFeed(reassembly, 1000, true, "A", 501, 109, "wxyz", 12);
+	PTF_ASSERT_EQUAL(stats.data, "abcdefghwxyz", string);
+
+	// a flood of SYN packets takes no more than the half-open table, and doesn't start connections
+	for (uint16_t port = 2000; port < 2020; port++)
+		tcpReassemblyHalfOpenFeed(reassembly, port, false, "S", port, 0, "", 13);
+	PTF_ASSERT_TRUE(reassembly.getNumOfHalfOpenConnections() <= 8);
+	PTF_ASSERT_EQUAL(reassembly.getNumOfHalfOpenConnections() + reassembly.getNumOfDroppedHalfOpenConnections(), 20, size);
+	PTF_ASSERT_EQUAL(reassembly.getConnectionInformation().size(), 1, size);
+	PTF_ASSERT_EQUAL(stats.startedConnections.size(), 1, size);
+	PTF_ASSERT_EQUAL(reassembly.getNumOfConnectionsStarted(), 1, u32);
+
+	// half-open connections expire, and an ACK arriving after that doesn't start the connection
+	TcpReassemblyHalfOpenStats expiryStats;
+	TcpReassembly expiryReassembly(tcpReassemblyHalfOpenMsgReady, &expiryStats, tcpReassemblyHalfOpenConnStart, NULL, config);
+	tcpReassemblyHalfOpenFeed(expiryReassembly, 1000, false, "S", 100, 0, "", 10);
+	tcpReassemblyHalfOpenFeed(expiryReassembly, 1000, true, "SA", 500, 101, "", 10);
+	tcpReassemblyHalfOpenFeed(expiryReassembly, 1000, false, "A", 101, 501, "", 13);
+	PTF_ASSERT_EQUAL(expiryReassembly.getNumOfHalfOpenConnections(), 0, size);
+	PTF_ASSERT_EQUAL(expiryReassembly.getNumOfExpiredHalfOpenConnections(), 1, u32);
+	PTF_ASSERT_EQUAL(expiryStats.startedConnections.size(), 0, size);
+
+	// a reset connection is removed from the table, and SYN-ACK or ACK packets without a SYN are ignored
+	tcpReassemblyHalfOpenFeed(expiryReassembly, 1001, false, "S", 100, 0, "", 20);
+	tcpReassemblyHalfOpenFeed(expiryReassembly, 1001, true, "RA", 0, 101, "", 20);
+	PTF_ASSERT_EQUAL(expiryReassembly.getNumOfHalfOpenConnections(), 0, size);
+	tcpReassemblyHalfOpenFeed(expiryReassembly, 1001, false, "A", 101, 1, "", 20);
+	tcpReassemblyHalfOpenFeed(expiryReassembly, 1002, true, "SA", 500, 101, "", 20);
+	tcpReassemblyHalfOpenFeed(expiryReassembly, 1002, false, "A", 101, 501, "", 20);
+	PTF_ASSERT_EQUAL(expiryStats.startedConnections.size(), 0, size);
+	PTF_ASSERT_EQUAL(expiryReassembly.getConnectionInformation().size(), 0, size);
+
+	// data of a connection whose handshake wasn't seen opens it as without the half-open table
+	tcpReassemblyHalfOpenFeed(expiryReassembly, 1003, false, "A", 100, 1, "abcd", 20);
+	PTF_ASSERT_EQUAL(expiryStats.startedConnections.size(), 1, size);
+	PTF_ASSERT_EQUAL(expiryStats.data, "abcd", string);
+
+	// connections may be promoted only by their first data
+	TcpReassemblyHalfOpenStats dataStats;
+	TcpReassemblyConfiguration dataConfig(true, 5, 30, 0, 0, 0, 0, EvictLeastRecentlyUsed, 0, 0, 8, 3, false);
+	TcpReassembly dataReassembly(tcpReassemblyHalfOpenMsgReady, &dataStats, tcpReassemblyHalfOpenConnStart, NULL, dataConfig);
+	tcpReassemblyHalfOpenFeed(dataReassembly, 1000, false, "S", 100, 0, "", 10);
+	tcpReassemblyHalfOpenFeed(dataReassembly, 1000, true, "SA", 500, 101, "", 10);
+	tcpReassemblyHalfOpenFeed(dataReassembly, 1000, false, "A", 101, 501, "", 10);
+	PTF_ASSERT_EQUAL(dataStats.startedConnections.size(), 0, size);
+	PTF_ASSERT_EQUAL(dataReassembly.getNumOfHalfOpenConnections(), 1, size);
+	tcpReassemblyHalfOpenFeed(dataReassembly, 1000, true, "A", 501, 101, "wxyz", 11);
+	PTF_ASSERT_EQUAL(dataStats.startedConnections.size(), 1, size);
+	PTF_ASSERT_EQUAL(dataStats.startedConnections[0].srcPort, 1000, u16);
+	tcpReassemblyHalfOpenFeed(dataReassembly, 1000, false, "A", 101, 505, "abcd", 11);
+	PTF_ASSERT_EQUAL(dataStats.data, "wxyzabcd", string);
+	PTF_ASSERT_EQUAL(dataReassembly.getNumOfPromotedConnections(), 1, u32);
+} // TcpReassemblyHalfOpenTest
+
+
+// feed a fragment with a timestamp and return the reassembled packet, if any
+static Packet* ipReassemblyCheckpointFeed(IPReassembly& ipReassembly, uint16_t ipId, uint16_t fragmentOffset, bool moreFragments, time_t timestamp, IPReassembly::ReassemblyStatus& status)
+{
+	RawPacket* fragment = ipReassemblyBudgetCreateFragment(ipId, fragmentOffset, moreFragments, 64);
+	timeval packetTime;
+	packetTime.tv_sec = timestamp;
+	packetTime.tv_usec = 0;
+	fragment->setPacketTimeStamp(packetTime);
+	Packet* result = ipReassembly.processPacket(fragment, status);
+	delete fragment;
+	return result;
+}
+
+PTF_TEST_CASE(IPReassemblyCheckpointTest)
+{
+	// a packet with an out-of-order fragment, a packet without its first fragment and a packet with its first fragment only
+	IPReassembly::ReassemblyStatus status;
+	IPReassembly original(NULL, NULL, PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE, 0, EvictLeastRecentlyUsed, 30);
+	ipReassemblyCheckpointFeed(original, 1, 0, true, 100, status);
+	ipReassemblyCheckpointFeed(original, 1, 128, true, 100, status);
+	ipReassemblyCheckpointFeed(original, 2, 64, true, 105, status);
+	ipReassemblyCheckpointFeed(original, 3, 0, true, 100, status);
+	PTF_ASSERT_EQUAL(status, IPReassembly::FIRST_FRAGMENT, enum);
+	PTF_ASSERT_EQUAL(original.getCurrentCapacity(), 3, size);
+
+	std::vector<uint8_t> checkpoint;
+	CheckpointWriter writer(checkpoint);
+	original.saveState(writer);
+
+	std::vector<uint16_t> dropped;
+	IPReassembly restored(ipReassemblyBudgetFragmentsClean, &dropped, PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE, 0, EvictLeastRecentlyUsed, 30);
+	CheckpointReader reader(&checkpoint[0], checkpoint.size());
+	PTF_ASSERT_TRUE(restored.restoreState(reader));
+	PTF_ASSERT_EQUAL(reader.getRemainingBytes(), 0, size);
+	PTF_ASSERT_EQUAL(restored.getCurrentCapacity(), 3, size);
+	// the restored buffers are only as large as their data
+	PTF_ASSERT_TRUE(restored.getMemoryUsage() > 0 && restored.getMemoryUsage() <= original.getMemoryUsage());
+
+	// the partial packet is the same in both instances
+	IPReassembly::IPv4PacketKey key(1, IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	Packet* originalPartial = original.getCurrentPacket(key);
+	Packet* restoredPartial = restored.getCurrentPacket(key);
+	PTF_ASSERT_NOT_NULL(originalPartial);
+	PTF_ASSERT_NOT_NULL(restoredPartial);
+	PTF_ASSERT_EQUAL(restoredPartial->getRawPacket()->getRawDataLen(), originalPartial->getRawPacket()->getRawDataLen(), int);
+	PTF_ASSERT_BUF_COMPARE(restoredPartial->getRawPacket()->getRawData(), originalPartial->getRawPacket()->getRawData(), originalPartial->getRawPacket()->getRawDataLen());
+	delete originalPartial;
+	delete restoredPartial;
+
+	// the remaining fragments complete the packets in the restored instance as they do in the original one
+	const uint16_t ipIds[2] = { 1, 2 };
+	for (int i = 0; i < 2; i++)
+	{
+		uint16_t ipId = ipIds[i];
+		Packet* originalPacket = NULL;
+		Packet* restoredPacket = NULL;
+		if (ipId == 1)
+		{
+			delete ipReassemblyCheckpointFeed(original, 1, 64, true, 110, status);
+			delete ipReassemblyCheckpointFeed(restored, 1, 64, true, 110, status);
+			originalPacket = ipReassemblyCheckpointFeed(original, 1, 192, false, 110, status);
+			restoredPacket = ipReassemblyCheckpointFeed(restored, 1, 192, false, 110, status);
+		}
+		else
+		{
+			delete ipReassemblyCheckpointFeed(original, 2, 128, false, 110, status);
+			delete ipReassemblyCheckpointFeed(restored, 2, 128, false, 110, status);
+			originalPacket = ipReassemblyCheckpointFeed(original, 2, 0, true, 110, status);
+			restoredPacket = ipReassemblyCheckpointFeed(restored, 2, 0, true, 110, status);
+		}
+		PTF_ASSERT_EQUAL(status, IPReassembly::REASSEMBLED, enum);
+		PTF_ASSERT_NOT_NULL(originalPacket);
+		PTF_ASSERT_NOT_NULL(restoredPacket);
+		PTF_ASSERT_EQUAL(restoredPacket->getRawPacket()->getRawDataLen(), originalPacket->getRawPacket()->getRawDataLen(), int);
+		PTF_ASSERT_BUF_COMPARE(restoredPacket->getRawPacket()->getRawData(), originalPacket->getRawPacket()->getRawData(), originalPacket->getRawPacket()->getRawDataLen());
+		delete originalPacket;
+		delete restoredPacket;
+	}
+
+	// the reassembly timeout still counts from the first fragment which arrived before the checkpoint, when the time was 105
+	timeval currentTime;
+	currentTime.tv_sec = 134;
+	currentTime.tv_usec = 0;
+	restored.advanceTime(currentTime);
+	PTF_ASSERT_EQUAL(restored.getCurrentCapacity(), 1, size);
+	currentTime.tv_sec = 136;
+	restored.advanceTime(currentTime);
+	PTF_ASSERT_EQUAL(restored.getCurrentCapacity(), 0, size);
+	PTF_ASSERT_EQUAL(restored.getNumOfExpiredPackets(), 1, u32);
+	PTF_ASSERT_EQUAL(dropped.size(), 1, size);
+	PTF_ASSERT_EQUAL(dropped[0], 3, u16);
+
+	// a state can't be restored to an instance which already reassembles packets, and an invalid checkpoint changes nothing
+	LoggerPP::getInstance().supressErrors();
+	CheckpointReader nonEmptyReader(&checkpoint[0], checkpoint.size());
+	PTF_ASSERT_FALSE(original.restoreState(nonEmptyReader));
+
+	IPReassembly invalid;
+	CheckpointReader truncatedReader(&checkpoint[0], checkpoint.size() - 1);
+	PTF_ASSERT_FALSE(invalid.restoreState(truncatedReader));
+	std::vector<uint8_t> corrupted(checkpoint);
+	corrupted[4] ^= 0xFF;
+	CheckpointReader corruptedReader(&corrupted[0], corrupted.size());
+	PTF_ASSERT_FALSE(invalid.restoreState(corruptedReader));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL(invalid.getCurrentCapacity(), 0, size);
+	PTF_ASSERT_EQUAL(invalid.getMemoryUsage(), 0, size);
+
+	// saving to a file and restoring from it, to an instance with room for one packet only
+	IPReassembly fileOriginal;
+	ipReassemblyCheckpointFeed(fileOriginal, 4, 0, true, 100, status);
+	ipReassemblyCheckpointFeed(fileOriginal, 5, 0, true, 100, status);
+	std::string fileName = "IPReassemblyCheckpoint.bin";
+	PTF_ASSERT_TRUE(fileOriginal.saveState(fileName));
+	std::vector<uint16_t> fileDropped;
+	IPReassembly fileRestored(ipReassemblyBudgetFragmentsClean, &fileDropped, 1);
+	PTF_ASSERT_TRUE(fileRestored.restoreState(fileName));
+	remove(fileName.c_str());
+	PTF_ASSERT_EQUAL(fileRestored.getCurrentCapacity(), 1, size);
+	PTF_ASSERT_EQUAL(fileDropped.size(), 1, size);
+} // IPReassemblyCheckpointTest
+
+static void fillRuleClassifierView(PacketView& view, const char* srcIP, const char* dstIP, uint8_t protocol, int srcPort, int dstPort)
+{
+	memset(&view, 0, sizeof(view));
+	view.ipVersion = 4;
+	view.ipProtocol = protocol;
+	view.transportOffset = PacketView::NoOffset;
+	uint32_t srcAddr = IPv4Address(std::string(srcIP)).toInt();
+	uint32_t dstAddr = IPv4Address(std::string(dstIP)).toInt();
+	memcpy(view.srcIP, &srcAddr, 4);
+	memcpy(view.dstIP, &dstAddr, 4);
+	if (srcPort >= 0)
+	{
+		view.transportOffset = 34;
+		view.srcPort = (uint16_t)srcPort;
+		view.dstPort = (uint16_t)dstPort;
+	}
+}
+
+static bool ruleClassifierRuleMatches(const ClassifierRule& rule, const PacketView& view)
+{
+	if (rule.srcPrefixLen > 0 || rule.dstPrefixLen > 0)
+	{
+		if (view.ipVersion != 4)
+			return false;
+
+		uint32_t srcMask = (rule.srcPrefixLen == 0 ? 0 : htonl(0xffffffff << (32 - rule.srcPrefixLen)));
+		uint32_t dstMask = (rule.dstPrefixLen == 0 ? 0 : htonl(0xffffffff << (32 - rule.dstPrefixLen)));
+		if ((view.getSrcIPv4Address().toInt() & srcMask) != (rule.srcAddress.toInt() & srcMask) ||
+				(view.getDstIPv4Address().toInt() & dstMask) != (rule.dstAddress.toInt() & dstMask))
+			return false;
+	}
+
+	if (rule.protocol != 0 && rule.protocol != view.ipProtocol)
+		return false;
+
+	if (rule.srcPortFrom == 0 && rule.srcPortTo == 0xffff && rule.dstPortFrom == 0 && rule.dstPortTo == 0xffff)
+		return true;
+
+	return view.transportOffset != PacketView::NoOffset && view.srcPort >= rule.srcPortFrom && view.srcPort <= rule.srcPortTo &&
+			view.dstPort >= rule.dstPortFrom && view.dstPort <= rule.dstPortTo;
+}
+
+PTF_TEST_CASE(RuleClassifierTest)
+{
+	std::vector<ClassifierRule> rules;
+	ClassifierRule rule;
+
+	// block a /8 with a lower priority /16 exception inside it
+	rule.id = 1;
+	rule.priority = 10;
+	rule.srcAddress = IPv4Address(std::string("10.0.0.0"));
+	rule.srcPrefixLen = 8;
+	rules.push_back(rule);
+
+	rule.id = 2;
+	rule.priority = 5;
+	rule.srcAddress = IPv4Address(std::string("10.1.0.0"));
+	rule.srcPrefixLen = 16;
+	rules.push_back(rule);
+
+	// TCP to port 80-90 of a /24, from anywhere
+	rule = ClassifierRule();
+	rule.id = 3;
+	rule.priority = 20;
+	rule.dstAddress = IPv4Address(std::string("192.168.1.0"));
+	rule.dstPrefixLen = 24;
+	rule.dstPortFrom = 80;
+	rule.dstPortTo = 90;
+	rule.protocol = PACKETPP_IPPROTO_TCP;
+	rules.push_back(rule);
+
+	// a single host pair
+	rule = ClassifierRule();
+	rule.id = 4;
+	rule.srcAddress = IPv4Address(std::string("172.16.5.4"));
+	rule.srcPrefixLen = 32;
+	rule.dstAddress = IPv4Address(std::string("8.8.8.8"));
+	rule.dstPrefixLen = 32;
+	rules.push_back(rule);
+
+	RuleClassifier classifier;
+	PacketView view;
+	fillRuleClassifierView(view, "10.1.2.3", "1.1.1.1", PACKETPP_IPPROTO_UDP, 1000, 53);
+	PTF_ASSERT_EQUAL(classifier.classify(view), RuleClassifier::NoMatch, u32);
+
+	PTF_ASSERT_TRUE(classifier.setRules(rules));
+	PTF_ASSERT_EQUAL(classifier.getNumOfRules(), 4, size);
+	PTF_ASSERT_EQUAL(classifier.classify(view), 1, u32);
+	fillRuleClassifierView(view, "10.1.2.3", "192.168.1.7", PACKETPP_IPPROTO_TCP, 1000, 85);
+	PTF_ASSERT_EQUAL(classifier.classify(view), 3, u32);
+	fillRuleClassifierView(view, "11.1.2.3", "192.168.1.7", PACKETPP_IPPROTO_TCP, 1000, 91);
+	PTF_ASSERT_EQUAL(classifier.classify(view), RuleClassifier::NoMatch, u32);
+	// port ranges match only packets with a transport header
+	fillRuleClassifierView(view, "11.1.2.3", "192.168.1.7", PACKETPP_IPPROTO_TCP, -1, -1);
+	PTF_ASSERT_EQUAL(classifier.classify(view), RuleClassifier::NoMatch, u32);
+	fillRuleClassifierView(view, "172.16.5.4", "8.8.8.8", PACKETPP_IPPROTO_ICMP, -1, -1);
+	PTF_ASSERT_EQUAL(classifier.classify(view), 4, u32);
+	fillRuleClassifierView(view, "172.16.5.4", "8.8.8.9", PACKETPP_IPPROTO_ICMP, -1, -1);
+	PTF_ASSERT_EQUAL(classifier.classify(view), RuleClassifier::NoMatch, u32);
+
+	// IPv6 packets match only rules without prefixes
+	view.ipVersion = 6;
+	PTF_ASSERT_EQUAL(classifier.classify(view), RuleClassifier::NoMatch, u32);
+	rule = ClassifierRule();
+	rule.id = 5;
+	rule.priority = -1;
+	rules.push_back(rule);
+	PTF_ASSERT_TRUE(classifier.setRules(rules));
+	PTF_ASSERT_EQUAL(classifier.classify(view), 5, u32);
+
+	// invalid rules keep the current rule set
+	rule.srcPrefixLen = 33;
+	std::vector<ClassifierRule> invalidRules(1, rule);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(classifier.setRules(invalidRules));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL(classifier.getNumOfRules(), 5, size);
+
+	// compare a large rule set, which uses the destination tries and port bitmaps, with a linear search
+	srand(1);
+	rules.clear();
+	const char* bases[] = { "10.0.0.0", "10.20.0.0", "172.16.0.0", "192.168.0.0" };
+	for (int i = 0; i < 3000; i++)
+	{
+		rule = ClassifierRule();
+		rule.id = (uint32_t)i;
+		rule.priority = rand() % 4;
+		uint32_t srcAddr = IPv4Address(std::string(bases[rand() % 4])).toInt() ^ htonl((uint32_t)rand() & 0xffff);
+		uint32_t dstAddr = IPv4Address(std::string(bases[rand() % 4])).toInt() ^ htonl((uint32_t)rand() & 0xffff);
+		rule.srcAddress = IPv4Address(srcAddr);
+		rule.dstAddress = IPv4Address(dstAddr);
+		rule.srcPrefixLen = (uint8_t)(i % 2 == 0 ? 0 : 8 + rand() % 25);
+		rule.dstPrefixLen = (uint8_t)(rand() % 3 == 0 ? 0 : 8 + rand() % 25);
+		if (rand() % 2)
+		{
+			rule.dstPortFrom = (uint16_t)(rand() % 100);
+			rule.dstPortTo = (uint16_t)(rule.dstPortFrom + rand() % 20);
+		}
+		if (rand() % 2)
+			rule.protocol = (rand() % 2 ? PACKETPP_IPPROTO_TCP : PACKETPP_IPPROTO_UDP);
+		rules.push_back(rule);
+	}
+
+	PTF_ASSERT_TRUE(classifier.setRules(rules));
+	for (int i = 0; i < 2000; i++)
+	{
+		const ClassifierRule& baseRule = rules[rand() % rules.size()];
+		memset(&view, 0, sizeof(view));
+		view.ipVersion = 4;
+		view.ipProtocol = (rand() % 2 ? PACKETPP_IPPROTO_TCP : PACKETPP_IPPROTO_UDP);
+		uint32_t srcAddr = baseRule.srcAddress.toInt() ^ htonl((uint32_t)rand() & 0xff);
+		uint32_t dstAddr = baseRule.dstAddress.toInt() ^ htonl((uint32_t)rand() & 0xff);
+		memcpy(view.srcIP, &srcAddr, 4);
+		memcpy(view.dstIP, &dstAddr, 4);
+		view.transportOffset = 34;
+		view.srcPort = (uint16_t)(rand() % 1000);
+		view.dstPort = (uint16_t)(rand() % 130);
+
+		uint32_t expected = RuleClassifier::NoMatch;
+		int expectedPriority = 0;
+		for (size_t j = 0; j < rules.size(); j++)
+		{
+			if (ruleClassifierRuleMatches(rules[j], view) && (expected == RuleClassifier::NoMatch || rules[j].priority > expectedPriority))
+			{
+				expected = rules[j].id;
+				expectedPriority = rules[j].priority;
+			}
+		}
+
+		PTF_ASSERT_EQUAL(classifier.classify(view), expected, u32);
+	}
+
+	// replaced rule sets are freed once all registered readers passed a quiescent state
+	RuleClassifier rcuClassifier;
+	int readerId = rcuClassifier.registerReader();
+	PTF_ASSERT_TRUE(readerId >= 0);
+	PTF_ASSERT_TRUE(rcuClassifier.setRules(rules));
+	PTF_ASSERT_TRUE(rcuClassifier.setRules(rules));
+	PTF_ASSERT_EQUAL(rcuClassifier.reclaim(), 2, size);
+	rcuClassifier.quiescentState(readerId);
+	PTF_ASSERT_EQUAL(rcuClassifier.reclaim(), 0, size);
+	rcuClassifier.clearRules();
+	PTF_ASSERT_EQUAL(rcuClassifier.getNumOfRules(), 0, size);
+	PTF_ASSERT_EQUAL(rcuClassifier.reclaim(), 1, size);
+	rcuClassifier.unregisterReader(readerId);
+	PTF_ASSERT_EQUAL(rcuClassifier.reclaim(), 0, size);
+} // RuleClassifierTest
+
+struct PatternMatchRecord
+{
+	uint32_t patternId;
+	uint64_t endOffset;
+	int side;
+};
+
+static bool multiPatternMatcherOnMatch(uint32_t patternId, uint64_t endOffset, void* userCookie)
+{
+	PatternMatchRecord record = { patternId, endOffset, -1 };
+	((std::vector<PatternMatchRecord>*)userCookie)->push_back(record);
+	return true;
+}
+
+static bool multiPatternMatcherStopOnMatch(uint32_t patternId, uint64_t endOffset, void* userCookie)
+{
+	multiPatternMatcherOnMatch(patternId, endOffset, userCookie);
+	return false;
+}
+
+static bool tcpStreamPatternScannerOnMatch(uint32_t patternId, uint64_t endOffset, int side, const ConnectionData& connectionData, void* userCookie)
+{
+	PatternMatchRecord record = { patternId, endOffset, side };
+	((std::vector<PatternMatchRecord>*)userCookie)->push_back(record);
+	return true;
+}
+
+PTF_TEST_CASE(MultiPatternMatcherTest)
+{
+	MultiPatternMatcher matcher;
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(matcher.compile());
+	PTF_ASSERT_FALSE(matcher.addPattern(std::string(""), 0));
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT_TRUE(matcher.addPattern(std::string("he"), 1));
+	PTF_ASSERT_TRUE(matcher.addPattern(std::string("she"), 2));
+	PTF_ASSERT_TRUE(matcher.addPattern(std::string("his"), 3));
+	PTF_ASSERT_TRUE(matcher.addPattern(std::string("hers"), 4));
+	PTF_ASSERT_TRUE(matcher.addPattern(std::string("USER"), 5, true));
+	PTF_ASSERT_FALSE(matcher.isCompiled());
+	PTF_ASSERT_TRUE(matcher.compile());
+	PTF_ASSERT_TRUE(matcher.isCompiled());
+	PTF_ASSERT_EQUAL(matcher.getNumOfPatterns(), 5, size);
+
+	// the case-sensitive matches are reported first, and matches ending at the same offset from the longest to the shortest
+	std::string text = "ushers and user";
+	std::vector<PatternMatchRecord> matches;
+	PTF_ASSERT_EQUAL(matcher.scan((const uint8_t*)text.data(), text.size(), multiPatternMatcherOnMatch, &matches), 4, size);
+	PTF_ASSERT_EQUAL(matches.size(), 4, size);
+	PTF_ASSERT_EQUAL(matches[0].patternId, 2, u32);
+	PTF_ASSERT_EQUAL(matches[0].endOffset, 4, u32);
+	PTF_ASSERT_EQUAL(matches[1].patternId, 1, u32);
+	PTF_ASSERT_EQUAL(matches[1].endOffset, 4, u32);
+	PTF_ASSERT_EQUAL(matches[2].patternId, 4, u32);
+	PTF_ASSERT_EQUAL(matches[2].endOffset, 6, u32);
+	PTF_ASSERT_EQUAL(matches[3].patternId, 5, u32);
+	PTF_ASSERT_EQUAL(matches[3].endOffset, 15, u32);
+
+	PTF_ASSERT_EQUAL(matcher.scan((const uint8_t*)text.data(), text.size(), NULL), 4, size);
+	matches.clear();
+	PTF_ASSERT_EQUAL(matcher.scan((const uint8_t*)text.data(), text.size(), multiPatternMatcherStopOnMatch, &matches), 1, size);
+	PTF_ASSERT_EQUAL(matches.size(), 1, size);
+
+	// matches split between pieces of a stream
+	const char* pieces[] = { "us", "hers and us", "Er" };
+	PatternStreamState streamState;
+	matches.clear();
+	for (int i = 0; i < 3; i++)
+		matcher.scanStream(streamState, (const uint8_t*)pieces[i], strlen(pieces[i]), multiPatternMatcherOnMatch, &matches);
+	PTF_ASSERT_EQUAL(matches.size(), 4, size);
+	PTF_ASSERT_EQUAL(matches[0].endOffset, 4, u32);
+	PTF_ASSERT_EQUAL(matches[2].endOffset, 6, u32);
+	PTF_ASSERT_EQUAL(matches[3].patternId, 5, u32);
+	PTF_ASSERT_EQUAL(matches[3].endOffset, 15, u32);
+	PTF_ASSERT_EQUAL(streamState.offset, 15, u32);
+
+	// layer payload
+	MultiPatternMatcher httpMatcher;
+	PTF_ASSERT_TRUE(httpMatcher.addPattern(std::string("/admin"), 10));
+	PTF_ASSERT_TRUE(httpMatcher.compile());
+
+	Packet packet(100);
+	EthLayer ethLayer(MacAddress("00:50:43:11:22:33"), MacAddress("aa:bb:cc:dd:ee:ff"));
+	IPv4Layer ipLayer(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	TcpLayer tcpLayer(40000, 80);
+	std::string request = "GET /admin HTTP/1.1\r\n";
+	PayloadLayer payloadLayer((const uint8_t*)request.data(), request.size(), false);
+	PTF_ASSERT_TRUE(packet.addLayer(&ethLayer));
+	PTF_ASSERT_TRUE(packet.addLayer(&ipLayer));
+	PTF_ASSERT_TRUE(packet.addLayer(&tcpLayer));
+	PTF_ASSERT_TRUE(packet.addLayer(&payloadLayer));
+	matches.clear();
+	PTF_ASSERT_EQUAL(httpMatcher.scanLayerPayload(packet.getLayerOfType<TcpLayer>(), multiPatternMatcherOnMatch, &matches), 1, size);
+	PTF_ASSERT_EQUAL(matches[0].endOffset, 10, u32);
+	PTF_ASSERT_EQUAL(httpMatcher.scanLayerPayload(packet.getLayerOfType<IPv4Layer>(), NULL), 1, size);
+
+	// each side of a TCP connection is a separate stream
+	std::vector<PatternMatchRecord> tcpMatches;
+	TcpStreamPatternScanner tcpScanner(httpMatcher, tcpStreamPatternScannerOnMatch, &tcpMatches);
+	ConnectionData connectionData;
+	connectionData.flowKey = 0x1234;
+	const char* sidePieces[] = { "GET /adm", "in /adm", "in HTTP/1.1", "in" };
+	int sides[] = { 0, 1, 0, 1 };
+	for (int i = 0; i < 4; i++)
+	{
+		// TcpStreamData frees the data it was created with
+		uint8_t* pieceData = new uint8_t[strlen(sidePieces[i])];
+		memcpy(pieceData, sidePieces[i], strlen(sidePieces[i]));
+		TcpStreamData tcpData(pieceData, strlen(sidePieces[i]), connectionData);
+		tcpScanner.scan(sides[i], tcpData);
+	}
+
+	PTF_ASSERT_EQUAL(tcpScanner.getNumOfConnections(), 1, size);
+	PTF_ASSERT_EQUAL(tcpMatches.size(), 2, size);
+	PTF_ASSERT_EQUAL(tcpMatches[0].side, 0, int);
+	PTF_ASSERT_EQUAL(tcpMatches[0].endOffset, 10, u32);
+	PTF_ASSERT_EQUAL(tcpMatches[1].side, 1, int);
+	PTF_ASSERT_EQUAL(tcpMatches[1].endOffset, 9, u32);
+	tcpScanner.connectionEnded(connectionData);
+	PTF_ASSERT_EQUAL(tcpScanner.getNumOfConnections(), 0, size);
+} // MultiPatternMatcherTest
+
+struct FlowDispatcherWorkerStats
+{
+	// the number of packets of each flow, by the flow's client port
+	std::map<uint16_t, int> packetsPerFlow;
+	int numOfNonIPPackets;
+	uint32_t maxBurst;
+
+	FlowDispatcherWorkerStats() : numOfNonIPPackets(0), maxBurst(0) {}
+};
+
+static void flowDispatcherOnPackets(RawPacket* packets, uint32_t numOfPackets, int workerIndex, FlowDispatcher* dispatcher, void* userCookie)
+{
+	FlowDispatcherWorkerStats* stats = (FlowDispatcherWorkerStats*)userCookie;
+	if (numOfPackets > stats->maxBurst)
+		stats->maxBurst = numOfPackets;
+
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		Packet packet(&packets[i], false, UDP);
+		UdpLayer* udpLayer = packet.getLayerOfType<UdpLayer>();
+		if (udpLayer == NULL)
+		{
+			stats->numOfNonIPPackets++;
+			continue;
+		}
+
+		uint16_t srcPort = ntohs(udpLayer->getUdpHeader()->portSrc);
+		uint16_t dstPort = ntohs(udpLayer->getUdpHeader()->portDst);
+		stats->packetsPerFlow[srcPort > dstPort ? srcPort : dstPort]++;
+	}
+}
+
+static Packet* flowDispatcherCreatePacket(const std::string& srcIP, const std::string& dstIP, uint16_t srcPort, uint16_t dstPort)
+{
+	Packet* packet = new Packet(100);
+	packet->addLayer(new EthLayer(MacAddress("00:00:00:00:00:01"), MacAddress("00:00:00:00:00:02"), PCPP_ETHERTYPE_IP), true);
+	packet->addLayer(new IPv4Layer((IPv4Address(srcIP)), (IPv4Address(dstIP))), true);
+	packet->addLayer(new UdpLayer(srcPort, dstPort), true);
+	packet->computeCalculateFields();
+	return packet;
+}
+
+PTF_TEST_CASE(FlowDispatcherTest)
+{
+	const int numOfWorkers = 4;
+	const int numOfFlows = 100;
+	const int numOfRounds = 10;
+
+	// both directions of each flow, plus a non-IP packet
+	std::vector<Packet*> packets;
+	for (int flow = 0; flow < numOfFlows; flow++)
+	{
+		uint16_t clientPort = (uint16_t)(30000 + flow);
+		packets.push_back(flowDispatcherCreatePacket("10.0.0.1", "10.0.1.1", clientPort, 53));
+		packets.push_back(flowDispatcherCreatePacket("10.0.1.1", "10.0.0.1", 53, clientPort));
+	}
+	Packet* arpPacket = new Packet(100);
+	EthLayer arpEthLayer(MacAddress("00:00:00:00:00:01"), MacAddress("ff:ff:ff:ff:ff:ff"), PCPP_ETHERTYPE_ARP);
+	ArpLayer arpLayer(ARP_REQUEST, MacAddress("00:00:00:00:00:01"), MacAddress("00:00:00:00:00:00"), IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	arpPacket->addLayer(&arpEthLayer);
+	arpPacket->addLayer(&arpLayer);
+	arpPacket->computeCalculateFields();
+	packets.push_back(arpPacket);
+
+	RawPacket* rawPackets = new RawPacket[packets.size()];
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		RawPacket* rawPacket = packets[i]->getRawPacket();
+		rawPackets[i].setExternalRawData(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getPacketTimeStampNs());
+	}
+
+	// the hash is symmetric and non-IP packets get hash 0
+	PTF_ASSERT_EQUAL(FlowDispatcher::getFlowHash(&rawPackets[0]), FlowDispatcher::getFlowHash(&rawPackets[1]), u32);
+	PTF_ASSERT_EQUAL(FlowDispatcher::getFlowHash(arpPacket->getRawPacket()), 0, u32);
+
+	// small queues so the dispatching thread has to wait for the workers
+	FlowDispatcherWorkerStats workerStats[numOfWorkers];
+	FlowDispatcherConfiguration config(numOfWorkers, 16, false, 8);
+	FlowDispatcher dispatcher(flowDispatcherOnPackets, NULL, config);
+	PTF_ASSERT_EQUAL(dispatcher.getNumOfWorkers(), numOfWorkers, int);
+	PTF_ASSERT_EQUAL(dispatcher.getIndirectionTable().size(), 128, size);
+	for (int i = 0; i < numOfWorkers; i++)
+		dispatcher.setWorkerUserCookie(i, &workerStats[i]);
+
+	std::map<uint16_t, int> expectedWorker;
+	for (int flow = 0; flow < numOfFlows; flow++)
+	{
+		expectedWorker[(uint16_t)(30000 + flow)] = dispatcher.getWorkerIndex(&rawPackets[2 * flow]);
+		PTF_ASSERT_EQUAL(dispatcher.getWorkerIndex(&rawPackets[2 * flow + 1]), expectedWorker[(uint16_t)(30000 + flow)], int);
+	}
+
+	PTF_ASSERT_TRUE(dispatcher.start());
+	PTF_ASSERT_TRUE(dispatcher.isRunning());
+	for (int round = 0; round < numOfRounds; round++)
+		PTF_ASSERT_EQUAL(dispatcher.dispatchPackets(rawPackets, packets.size()), packets.size(), size);
+	PTF_ASSERT_TRUE(dispatcher.dispatchPacket(&rawPackets[0]));
+	dispatcher.stop();
+	PTF_ASSERT_FALSE(dispatcher.isRunning());
+
+	// all packets of a flow, in both directions, were processed by the worker its hash maps to
+	size_t numOfFlowsSeen = 0;
+	int numOfNonIPPackets = 0;
+	for (int i = 0; i < numOfWorkers; i++)
+	{
+		PTF_ASSERT_TRUE(workerStats[i].maxBurst <= 8);
+		numOfNonIPPackets += workerStats[i].numOfNonIPPackets;
+		numOfFlowsSeen += workerStats[i].packetsPerFlow.size();
+		for (std::map<uint16_t, int>::iterator iter = workerStats[i].packetsPerFlow.begin(); iter != workerStats[i].packetsPerFlow.end(); iter++)
+		{
+			PTF_ASSERT_EQUAL(expectedWorker[iter->first], i, int);
+			PTF_ASSERT_EQUAL(iter->second, 2 * numOfRounds + (iter->first == 30000 ? 1 : 0), int);
+		}
+	}
+	PTF_ASSERT_EQUAL(numOfFlowsSeen, (size_t)numOfFlows, size);
+	PTF_ASSERT_EQUAL(numOfNonIPPackets, numOfRounds, int);
+	PTF_ASSERT_EQUAL(workerStats[dispatcher.getIndirectionTable()[0]].numOfNonIPPackets, numOfRounds, int);
+
+	uint64_t totals[FlowDispatcher::NumOfStatsCounters];
+	dispatcher.getStatsCounters().aggregate(totals);
+	PTF_ASSERT_EQUAL(totals[FlowDispatcher::PacketsDispatched], (uint64_t)(numOfRounds * packets.size() + 1), u32);
+	PTF_ASSERT_EQUAL(totals[FlowDispatcher::PacketsProcessed], (uint64_t)(numOfRounds * packets.size() + 1), u32);
+	PTF_ASSERT_EQUAL(totals[FlowDispatcher::PacketsDropped], 0, u32);
+
+	// the indirection table must have the same size and valid worker indices
+	std::vector<int> table(dispatcher.getIndirectionTable().size(), 0);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(dispatcher.setIndirectionTable(std::vector<int>(3, 0)));
+	table[5] = numOfWorkers;
+	PTF_ASSERT_FALSE(dispatcher.setIndirectionTable(table));
+	LoggerPP::getInstance().enableErrors();
+	table[5] = 0;
+
+	// with all buckets on one worker, rebalancing spreads the load of the packets dispatched since between the workers. Without
+	// worker threads packets are queued until the queues are full
+	PTF_ASSERT_TRUE(dispatcher.setIndirectionTable(table));
+	for (int i = 0; i < numOfWorkers; i++)
+		workerStats[i] = FlowDispatcherWorkerStats();
+	FlowDispatcherConfiguration stoppedConfig(numOfWorkers, 1024);
+	FlowDispatcher stoppedDispatcher(flowDispatcherOnPackets, NULL, stoppedConfig);
+	for (int i = 0; i < numOfWorkers; i++)
+		stoppedDispatcher.setWorkerUserCookie(i, &workerStats[i]);
+	PTF_ASSERT_TRUE(stoppedDispatcher.setIndirectionTable(table));
+	PTF_ASSERT_EQUAL(stoppedDispatcher.dispatchPackets(rawPackets, packets.size() - 1), packets.size() - 1, size);
+	size_t numOfMoved = stoppedDispatcher.rebalance();
+	PTF_ASSERT_TRUE(numOfMoved > 0);
+	std::vector<int> bucketsPerWorker(numOfWorkers, 0);
+	for (size_t i = 0; i < stoppedDispatcher.getIndirectionTable().size(); i++)
+		bucketsPerWorker[stoppedDispatcher.getIndirectionTable()[i]]++;
+	for (int i = 0; i < numOfWorkers; i++)
+		PTF_ASSERT_TRUE(bucketsPerWorker[i] > 0);
+	stoppedDispatcher.getStatsCounters().aggregate(totals);
+	PTF_ASSERT_EQUAL(totals[FlowDispatcher::BucketsMoved], (uint64_t)numOfMoved, u32);
+
+	// no packets were dispatched since, so there's nothing to move
+	PTF_ASSERT_EQUAL(stoppedDispatcher.rebalance(), 0, size);
+
+	// the packets queued before the rebalance are processed by the worker they were queued for, the next ones by all workers
+	PTF_ASSERT_TRUE(stoppedDispatcher.start());
+	stoppedDispatcher.stop();
+	PTF_ASSERT_EQUAL(workerStats[0].packetsPerFlow.size(), (size_t)numOfFlows, size);
+	for (int i = 0; i < numOfWorkers; i++)
+		workerStats[i] = FlowDispatcherWorkerStats();
+	PTF_ASSERT_EQUAL(stoppedDispatcher.dispatchPackets(rawPackets, packets.size() - 1), packets.size() - 1, size);
+	PTF_ASSERT_TRUE(stoppedDispatcher.start());
+	stoppedDispatcher.stop();
+	for (int i = 0; i < numOfWorkers; i++)
+		PTF_ASSERT_FALSE(workerStats[i].packetsPerFlow.empty());
+
+	delete [] rawPackets;
+	for (size_t i = 0; i < packets.size(); i++)
+		delete packets[i];
+} // FlowDispatcherTest
+
+struct ParallelThreadStats
+{
+	int numOfPackets;
+	int numOfUdpPackets;
+	// the thread which processed each packet, shared by all threads
+	std::vector<int>* packetThreads;
+
+	ParallelThreadStats() : numOfPackets(0), numOfUdpPackets(0), packetThreads(NULL) {}
+};
+
+static void parallelCountPacket(RawPacket* rawPacket, size_t packetIndex, ParallelPacketContext& context)
+{
+	ParallelThreadStats* stats = (ParallelThreadStats*)context.getUserCookie();
+	stats->numOfPackets++;
+	if (context.parsePacket(rawPacket, UDP).isPacketOfType(UDP))
+		stats->numOfUdpPackets++;
+	(*stats->packetThreads)[packetIndex] = context.getThreadIndex();
+}
+
+static bool parallelIsUdpPacket(RawPacket* rawPacket, size_t packetIndex, ParallelPacketContext& context)
+{
+	return context.parsePacket(rawPacket, UDP).isPacketOfType(UDP);
+}
+
+// sums the UDP ports and collects the packet indices, whose order shows the accumulators are merged in chunk order
+struct ParallelPortSum
+{
+	uint64_t portSum;
+	std::vector<size_t> packetIndices;
+
+	ParallelPortSum() : portSum(0) {}
+};
+
+struct ParallelPortSumReducer
+{
+	void accumulate(ParallelPortSum& accumulator, RawPacket* rawPacket, size_t packetIndex, ParallelPacketContext& context)
+	{
+		UdpLayer* udpLayer = context.parsePacket(rawPacket).getLayerOfType<UdpLayer>();
+		if (udpLayer != NULL)
+			accumulator.portSum += ntohs(udpLayer->getUdpHeader()->portSrc) + ntohs(udpLayer->getUdpHeader()->portDst);
+		accumulator.packetIndices.push_back(packetIndex);
+	}
+
+	void merge(ParallelPortSum& accumulator, const ParallelPortSum& other)
+	{
+		accumulator.portSum += other.portSum;
+		accumulator.packetIndices.insert(accumulator.packetIndices.end(), other.packetIndices.begin(), other.packetIndices.end());
+	}
+};
+
+static void parallelSlowTask(size_t taskIndex, ParallelPacketContext& context, void* taskCookie)
+{
+	// the tasks of thread 0 are slow, so the other thread runs out of tasks and steals some of them
+	if (taskIndex < 50)
+	{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+		Sleep(1);
+#else
+		timespec interval;
+		interval.tv_sec = 0;
+		interval.tv_nsec = 1000000;
+		nanosleep(&interval, NULL);
+#endif
+	}
+	// each task runs on one thread only, so the counters aren't shared
+	((int*)taskCookie)[taskIndex]++;
+}
+
+PTF_TEST_CASE(ParallelPacketProcessorTest)
+{
+	const int numOfThreads = 4;
+	const int numOfFlows = 50;
+
+	// both directions of each flow, with a non-IP packet every 10 flows
+	PointerVector<RawPacket> rawPackets;
+	RawPacketSlabVector slabPackets;
+	for (int flow = 0; flow < numOfFlows; flow++)
+	{
+		uint16_t clientPort = (uint16_t)(30000 + flow);
+		Packet* packets[2] = { flowDispatcherCreatePacket("10.0.0.1", "10.0.1.1", clientPort, 53),
+				flowDispatcherCreatePacket("10.0.1.1", "10.0.0.1", 53, clientPort) };
+		for (int i = 0; i < 2; i++)
+		{
+			rawPackets.pushBack(new RawPacket(*packets[i]->getRawPacket()));
+			PTF_ASSERT_NOT_NULL(slabPackets.pushBack(*packets[i]->getRawPacket()));
+			delete packets[i];
+		}
+
+		if (flow % 10 == 0)
+		{
+			Packet arpPacket(100);
+			EthLayer arpEthLayer(MacAddress("00:00:00:00:00:01"), MacAddress("ff:ff:ff:ff:ff:ff"), PCPP_ETHERTYPE_ARP);
+			ArpLayer arpLayer(ARP_REQUEST, MacAddress("00:00:00:00:00:01"), MacAddress("00:00:00:00:00:00"), IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+			arpPacket.addLayer(&arpEthLayer);
+			arpPacket.addLayer(&arpLayer);
+			arpPacket.computeCalculateFields();
+			rawPackets.pushBack(new RawPacket(*arpPacket.getRawPacket()));
+			arpPacket.detachLayer(&arpLayer);
+			arpPacket.detachLayer(&arpEthLayer);
+		}
+	}
+	size_t numOfPackets = rawPackets.size();
+	PTF_ASSERT_EQUAL(numOfPackets, 2 * numOfFlows + 5, size);
+
+	// small chunks, so there are many more tasks than threads
+	ParallelThreadStats threadStats[numOfThreads];
+	std::vector<int> packetThreads(numOfPackets, -1);
+	ParallelPacketProcessor processor(NULL, ParallelPacketProcessorConfiguration(numOfThreads, 4));
+	PTF_ASSERT_EQUAL(processor.getNumOfThreads(), numOfThreads, int);
+	PTF_ASSERT_EQUAL(processor.getChunkSize(), 4, size);
+	for (int i = 0; i < numOfThreads; i++)
+	{
+		threadStats[i].packetThreads = &packetThreads;
+		processor.setThreadUserCookie(i, &threadStats[i]);
+	}
+
+	// every packet is processed exactly once
+	processor.forEach(rawPackets, parallelCountPacket);
+	int totalPackets = 0;
+	int totalUdpPackets = 0;
+	for (int i = 0; i < numOfThreads; i++)
+	{
+		totalPackets += threadStats[i].numOfPackets;
+		totalUdpPackets += threadStats[i].numOfUdpPackets;
+	}
+	PTF_ASSERT_EQUAL(totalPackets, (int)numOfPackets, int);
+	PTF_ASSERT_EQUAL(totalUdpPackets, 2 * numOfFlows, int);
+	for (size_t i = 0; i < numOfPackets; i++)
+		PTF_ASSERT_TRUE(packetThreads[i] >= 0 && packetThreads[i] < numOfThreads);
+
+	// the contiguous container is processed the same way
+	for (int i = 0; i < numOfThreads; i++)
+		threadStats[i].numOfPackets = 0;
+	processor.forEach(slabPackets, parallelCountPacket);
+	totalPackets = 0;
+	for (int i = 0; i < numOfThreads; i++)
+		totalPackets += threadStats[i].numOfPackets;
+	PTF_ASSERT_EQUAL(totalPackets, 2 * numOfFlows, int);
+
+	// the accumulators are merged in chunk order, so the packet indices come out in order
+	ParallelPortSumReducer reducer;
+	ParallelPortSum portSum = processor.transformReduce(rawPackets, ParallelPortSum(), reducer);
+	uint64_t expectedPortSum = 0;
+	for (int flow = 0; flow < numOfFlows; flow++)
+		expectedPortSum += 2 * (30000 + flow + 53);
+	PTF_ASSERT_TRUE(portSum.portSum == expectedPortSum);
+	PTF_ASSERT_EQUAL(portSum.packetIndices.size(), numOfPackets, size);
+	for (size_t i = 0; i < numOfPackets; i++)
+		PTF_ASSERT_EQUAL(portSum.packetIndices[i], i, size);
+	ParallelPortSum slabPortSum = processor.transformReduce(slabPackets, ParallelPortSum(), reducer);
+	PTF_ASSERT_TRUE(slabPortSum.portSum == expectedPortSum);
+
+	// the matching indices are in order
+	std::vector<size_t> matchingIndices;
+	PTF_ASSERT_EQUAL(processor.filter(rawPackets, parallelIsUdpPacket, matchingIndices), 2 * numOfFlows, size);
+	PTF_ASSERT_EQUAL(matchingIndices.size(), 2 * numOfFlows, size);
+	for (size_t i = 1; i < matchingIndices.size(); i++)
+		PTF_ASSERT_TRUE(matchingIndices[i - 1] < matchingIndices[i]);
+	PTF_ASSERT_EQUAL(matchingIndices[1], 1, size);
+	PTF_ASSERT_EQUAL(matchingIndices[2], 3, size);
+	PTF_ASSERT_EQUAL(processor.filter(slabPackets, parallelIsUdpPacket, matchingIndices), 2 * numOfFlows, size);
+	PTF_ASSERT_EQUAL(matchingIndices[2], 2, size);
+
+	// both directions of a flow are in the same partition, and non-IP packets are in partition 0
+	const size_t numOfPartitions = 16;
+	std::vector<std::vector<size_t> > partitions;
+	processor.partitionByFlow(rawPackets, numOfPartitions, partitions);
+	PTF_ASSERT_EQUAL(partitions.size(), numOfPartitions, size);
+	std::vector<int> packetPartitions(numOfPackets, -1);
+	size_t numOfPartitionedPackets = 0;
+	for (size_t partition = 0; partition < numOfPartitions; partition++)
+	{
+		numOfPartitionedPackets += partitions[partition].size();
+		for (size_t i = 0; i < partitions[partition].size(); i++)
+		{
+			if (i > 0)
+				PTF_ASSERT_TRUE(partitions[partition][i - 1] < partitions[partition][i]);
+			packetPartitions[partitions[partition][i]] = (int)partition;
+		}
+	}
+	PTF_ASSERT_EQUAL(numOfPartitionedPackets, numOfPackets, size);
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		RawPacket* rawPacket = rawPackets.at(i);
+		uint32_t expectedPartition = (uint32_t)(((uint64_t)FlowDispatcher::getFlowHash(rawPacket) * numOfPartitions) >> 32);
+		PTF_ASSERT_EQUAL(packetPartitions[i], (int)expectedPartition, int);
+	}
+	PTF_ASSERT_EQUAL(packetPartitions[0], packetPartitions[1], int);
+	PTF_ASSERT_EQUAL(packetPartitions[2], 0, int);
+
+	// all packets of a partition are processed by one thread
+	processor.forEachPartition(rawPackets, partitions, parallelCountPacket);
+	for (size_t partition = 0; partition < numOfPartitions; partition++)
+	{
+		for (size_t i = 1; i < partitions[partition].size(); i++)
+			PTF_ASSERT_EQUAL(packetThreads[partitions[partition][i]], packetThreads[partitions[partition][0]], int);
+	}
+	std::vector<std::vector<size_t> > slabPartitions;
+	processor.partitionByFlow(slabPackets, numOfPartitions, slabPartitions);
+	numOfPartitionedPackets = 0;
+	for (size_t partition = 0; partition < numOfPartitions; partition++)
+		numOfPartitionedPackets += slabPartitions[partition].size();
+	PTF_ASSERT_EQUAL(numOfPartitionedPackets, 2 * numOfFlows, size);
+
+	// a thread which runs out of tasks steals from the thread with the most tasks left
+	ParallelPacketProcessor twoThreads(NULL, ParallelPacketProcessorConfiguration(2));
+	int taskRuns[100];
+	memset(taskRuns, 0, sizeof(taskRuns));
+	twoThreads.runTasks(100, parallelSlowTask, taskRuns);
+	for (int i = 0; i < 100; i++)
+		PTF_ASSERT_EQUAL(taskRuns[i], 1, int);
+	PTF_ASSERT_TRUE(twoThreads.getNumOfStolenTasks() > 0);
+
+	// a single thread runs everything on the calling thread, and empty inputs do nothing
+	ParallelPacketProcessor singleThread(&threadStats[0], ParallelPacketProcessorConfiguration(1, 1000));
+	threadStats[0].numOfPackets = 0;
+	singleThread.forEach(rawPackets, parallelCountPacket);
+	PTF_ASSERT_EQUAL(threadStats[0].numOfPackets, (int)numOfPackets, int);
+	PTF_ASSERT_EQUAL(packetThreads[numOfPackets - 1], 0, int);
+	PointerVector<RawPacket> noPackets;
+	singleThread.forEach(noPackets, parallelCountPacket);
+	PTF_ASSERT_EQUAL(singleThread.filter(noPackets, parallelIsUdpPacket, matchingIndices), 0, size);
+	singleThread.partitionByFlow(noPackets, 0, partitions);
+	PTF_ASSERT_EQUAL(partitions.size(), 1, size);
+	PTF_ASSERT_EQUAL(partitions[0].size(), 0, size);
+	PTF_ASSERT_EQUAL(threadStats[0].numOfPackets, (int)numOfPackets, int);
+} // ParallelPacketProcessorTest
+
+
+struct HttpStreamParserTestLog
+{
+	std::string events;
+	std::string body;
+};
+
+static void onHttpStreamEvent(const HttpStreamEvent& event, void* userCookie)
+{
+	HttpStreamParserTestLog* log = (HttpStreamParserTestLog*)userCookie;
+	std::stringstream stream;
+	switch (event.type)
+	{
+	case HttpStreamRequestLine:
+		stream << "R" << event.side << ":" << event.method << ":" << event.uri.toString() << ";";
+		break;
+	case HttpStreamStatusLine:
+		stream << "S" << event.side << ":" << event.statusCode << ":" << event.method << ":" << event.reasonPhrase.toString() << ";";
+		break;
+	case HttpStreamHeaderField:
+		stream << "H:" << event.fieldName.toString() << "=" << event.fieldValue.toString() << (event.isTrailer ? "(t)" : "") << ";";
+		break;
+	case HttpStreamHeadersComplete:
+		stream << "E:" << event.contentLength << ":" << event.isChunked << ";";
+		break;
+	case HttpStreamBodyData:
+		log->body += event.bodyData.toString();
+		break;
+	case HttpStreamMessageComplete:
+		stream << "C:" << log->body << ":" << event.bodyLength << ";";
+		log->body.clear();
+		break;
+	case HttpStreamParseError:
+		stream << "X" << event.side << ";";
+		break;
+	}
+
+	log->events += stream.str();
+}
+
+PTF_TEST_CASE(HttpStreamParserTest)
+{
+	std::string requests =
+			"GET /index.html HTTP/1.1\r\nHost: example.com\r\n\r\n"
+			"HEAD /head HTTP/1.1\r\nHost: example.com\r\n\r\n"
+			"POST /form HTTP/1.1\r\nContent-Length: 11\r\nHost:   example.com  \r\n\r\nhello=world"
+			"\r\nGET /stream HTTP/1.0\r\n\r\n";
+	std::string responses =
+			"HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nHELLO"
+			"HTTP/1.1 200 OK\r\nContent-Length: 1000\r\n\r\n"
+			"HTTP/1.1 100 Continue\r\n\r\n"
+			"HTTP/1.1 201 Created\r\nTransfer-Encoding: chunked\r\n\r\n4;ext=1\r\nWiki\r\n5\r\npedia\r\n0\r\nX-Trailer: yes\r\n\r\n"
+			"HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n\n"
+			"until close";
+
+	std::string expectedEvents =
+			"R0:0:/index.html;H:Host=example.com;E:-1:0;C::0;"
+			"R0:1:/head;H:Host=example.com;E:-1:0;C::0;"
+			"R0:2:/form;H:Content-Length=11;H:Host=example.com;E:11:0;C:hello=world:11;"
+			"R0:0:/stream;E:-1:0;C::0;"
+			"S1:200:0:OK;H:Content-Length=5;E:5:0;C:HELLO:5;"
+			"S1:200:1:OK;H:Content-Length=1000;E:1000:0;C::0;"
+			"S1:100:2:Continue;E:-1:0;C::0;"
+			"S1:201:2:Created;H:Transfer-Encoding=chunked;E:-1:1;H:X-Trailer=yes(t);C:Wikipedia:9;"
+			"S1:200:0:OK;H:Content-Type=text/plain;E:-1:0;"
+			"C:until close:11;";
+
+	ConnectionData connData;
+	connData.flowKey = 0x1234;
+
+	// the events don't depend on how the streams are split between pieces of data
+	size_t pieceSizes[] = { 1, 2, 3, 7, 64, 100000 };
+	for (size_t i = 0; i < sizeof(pieceSizes) / sizeof(size_t); i++)
+	{
+		HttpStreamParserTestLog log;
+		HttpStreamParser parser(onHttpStreamEvent, &log);
+
+		for (size_t offset = 0; offset < requests.length(); offset += pieceSizes[i])
+			parser.parse(0, (const uint8_t*)requests.c_str() + offset, std::min(pieceSizes[i], requests.length() - offset), connData);
+		for (size_t offset = 0; offset < responses.length(); offset += pieceSizes[i])
+			parser.parse(1, (const uint8_t*)responses.c_str() + offset, std::min(pieceSizes[i], responses.length() - offset), connData);
+
+		PTF_ASSERT_EQUAL(parser.getNumOfConnections(), 1, size);
+		parser.connectionEnded(connData);
+		PTF_ASSERT_EQUAL(parser.getNumOfConnections(), 0, size);
+		PTF_ASSERT_EQUAL(log.events, expectedEvents, string);
+	}
+
+	// bodies aren't reported if not requested, but their length is counted
+	{
+		HttpStreamParserTestLog log;
+		HttpStreamParser parser(onHttpStreamEvent, &log, HttpStreamParserConfiguration(16384, false));
+		std::string request = "POST /form HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n";
+		parser.parse(0, (const uint8_t*)request.c_str(), request.length(), connData);
+		PTF_ASSERT_EQUAL(log.events, "R0:2:/form;H:Transfer-Encoding=gzip, chunked;E:-1:1;C::3;", string);
+	}
+
+	// data which isn't HTTP, lines which are too long and connections which end in the middle of a message are errors
+	{
+		HttpStreamParserTestLog log;
+		HttpStreamParser parser(onHttpStreamEvent, &log, HttpStreamParserConfiguration(32));
+		std::string nonHttp = "SSH-2.0-OpenSSH_7.4\r\n";
+		std::string longLine = "GET /" + std::string(100, 'a') + " HTTP/1.1\r\n\r\n";
+		std::string truncated = "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n12345";
+
+		parser.parse(0, (const uint8_t*)nonHttp.c_str(), nonHttp.length(), connData);
+		parser.parse(0, (const uint8_t*)nonHttp.c_str(), nonHttp.length(), connData);
+		PTF_ASSERT_EQUAL(log.events, "X0;", string);
+		parser.connectionEnded(connData);
+		PTF_ASSERT_EQUAL(log.events, "X0;", string);
+
+		log.events.clear();
+		parser.parse(0, (const uint8_t*)longLine.c_str(), longLine.length(), connData);
+		PTF_ASSERT_EQUAL(log.events, "X0;", string);
+		parser.connectionEnded(connData);
+
+		log.events.clear();
+		parser.parse(1, (const uint8_t*)truncated.c_str(), truncated.length(), connData);
+		parser.connectionEnded(connData);
+		PTF_ASSERT_EQUAL(log.events, "S1:200:9:OK;H:Content-Length=10;E:10:0;X1;", string);
+	}
+
+	// after a protocol switch the rest of the connection is ignored
+	{
+		HttpStreamParserTestLog log;
+		HttpStreamParser parser(onHttpStreamEvent, &log);
+		std::string request = "GET /chat HTTP/1.1\r\nUpgrade: websocket\r\n\r\n";
+		std::string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n\r\n\x81\x05hello";
+		std::string frame = "\x81\x05world";
+		parser.parse(0, (const uint8_t*)request.c_str(), request.length(), connData);
+		parser.parse(1, (const uint8_t*)response.c_str(), response.length(), connData);
+		parser.parse(0, (const uint8_t*)frame.c_str(), frame.length(), connData);
+		parser.connectionEnded(connData);
+		PTF_ASSERT_EQUAL(log.events, "R0:0:/chat;H:Upgrade=websocket;E:-1:0;C::0;S1:101:0:Switching Protocols;H:Upgrade=websocket;E:-1:0;C::0;", string);
+	}
+} // HttpStreamParserTest
+
+static void onSSLStreamEvent(const SSLStreamEvent& event, void* userCookie)
+{
+	std::string* log = (std::string*)userCookie;
+	std::stringstream stream;
+	switch (event.type)
+	{
+	case SSLStreamRecord:
+		stream << "R" << event.side << ":" << (int)event.recordType << ":" << event.recordLength << (event.isEncrypted ? "e" : "") << ";";
+		break;
+	case SSLStreamHandshakeMessage:
+		stream << "M" << (int)event.handshakeType << ":" << event.messageLength;
+		if (event.message != NULL && event.message->getHandshakeType() == SSL_CERTIFICATE)
+		{
+			SSLCertificateMessage* certMessage = (SSLCertificateMessage*)event.message;
+			stream << ":" << certMessage->getNumOfCertificates();
+			for (int i = 0; i < certMessage->getNumOfCertificates(); i++)
+				stream << ":" << certMessage->getCertificate(i)->getDataLength() << (certMessage->getCertificate(i)->allDataExists() ? "" : "p");
+		}
+		else if (event.message != NULL && event.message->getHandshakeType() == SSL_CLIENT_HELLO)
+			stream << ":" << ((SSLClientHelloMessage*)event.message)->getCipherSuiteCount();
+		stream << ";";
+		break;
+	case SSLStreamParseError:
+		stream << "X" << event.side << ";";
+		break;
+	}
+
+	*log += stream.str();
+}
+
+static void appendSSLRecord(std::string& stream, uint8_t recordType, const std::string& recordData)
+{
+	stream += (char)recordType;
+	stream += "\x03\x03";
+	stream += (char)(recordData.length() >> 8);
+	stream += (char)(recordData.length() & 0xff);
+	stream += recordData;
+}
+
+static std::string createSSLLength(size_t length)
+{
+	std::string result;
+	result += (char)(length >> 16);
+	result += (char)((length >> 8) & 0xff);
+	result += (char)(length & 0xff);
+	return result;
+}
+
+PTF_TEST_CASE(SSLStreamParserTest)
+{
+	// the client sends a client-hello in one record
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/SSL-ClientHello1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	timeval time;
+	gettimeofday(&time, NULL);
+	RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet clientHelloPacket(&rawPacket);
+	TcpLayer* tcpLayer = clientHelloPacket.getLayerOfType<TcpLayer>();
+	std::string clientStream((const char*)tcpLayer->getLayerPayload(), tcpLayer->getLayerPayloadSize());
+
+	// the server sends a certificate message with 2 certificates, split between 2 records, then a server-hello-done, a
+	// change-cipher-spec, an encrypted finished message and application data
+	std::string certificates = createSSLLength(1500) + std::string(1500, 'a') + createSSLLength(700) + std::string(700, 'b');
+	std::string certMessage = std::string("\x0b") + createSSLLength(certificates.length() + 3) + createSSLLength(certificates.length()) + certificates;
+	std::string serverStream;
+	appendSSLRecord(serverStream, SSL_HANDSHAKE, certMessage.substr(0, 1000));
+	appendSSLRecord(serverStream, SSL_HANDSHAKE, certMessage.substr(1000) + std::string("\x0e\x00\x00\x00", 4));
+	appendSSLRecord(serverStream, SSL_CHANGE_CIPHER_SPEC, "\x01");
+	appendSSLRecord(serverStream, SSL_HANDSHAKE, std::string(40, 'x'));
+	appendSSLRecord(serverStream, SSL_APPLICATION_DATA, std::string(100, 'y'));
+
+	std::string expectedEvents =
+			"R0:22:183;M1:183:11;"
+			"R1:22:1000;R1:22:1217;M11:2213:2:1500:700;M14:4;R1:20:1;R1:22:40e;R1:23:100e;";
+
+	ConnectionData connData;
+	connData.flowKey = 0x1234;
+
+	// the events don't depend on how the streams are split between pieces of data
+	size_t pieceSizes[] = { 1, 2, 3, 7, 64, 100000 };
+	for (size_t i = 0; i < sizeof(pieceSizes) / sizeof(size_t); i++)
+	{
+		std::string log;
+		SSLStreamParser parser(onSSLStreamEvent, &log);
+
+		for (size_t offset = 0; offset < clientStream.length(); offset += pieceSizes[i])
+			parser.parse(0, (const uint8_t*)clientStream.c_str() + offset, std::min(pieceSizes[i], clientStream.length() - offset), connData);
+		for (size_t offset = 0; offset < serverStream.length(); offset += pieceSizes[i])
+			parser.parse(1, (const uint8_t*)serverStream.c_str() + offset, std::min(pieceSizes[i], serverStream.length() - offset), connData);
+
+		PTF_ASSERT_EQUAL(parser.getNumOfConnections(), 1, size);
+		parser.connectionEnded(connData);
+		PTF_ASSERT_EQUAL(parser.getNumOfConnections(), 0, size);
+		PTF_ASSERT_EQUAL(log, expectedEvents, string);
+	}
+
+	// without message objects only the raw messages are reported
+	{
+		std::string log;
+		SSLStreamParser parser(onSSLStreamEvent, &log, SSLStreamParserConfiguration(65536, false));
+		parser.parse(1, (const uint8_t*)serverStream.c_str(), serverStream.length(), connData);
+		PTF_ASSERT_EQUAL(log, "R1:22:1000;R1:22:1217;M11:2213;M14:4;R1:20:1;R1:22:40e;R1:23:100e;", string);
+	}
+
+	// data which isn't SSL/TLS, messages which are too long and connections which end in the middle of a message are errors
+	{
+		std::string log;
+		SSLStreamParser parser(onSSLStreamEvent, &log, SSLStreamParserConfiguration(1024));
+		std::string nonSSL = "SSH-2.0-OpenSSH_7.4\r\n";
+		parser.parse(0, (const uint8_t*)nonSSL.c_str(), nonSSL.length(), connData);
+		parser.parse(0, (const uint8_t*)clientStream.c_str(), clientStream.length(), connData);
+		PTF_ASSERT_EQUAL(log, "X0;", string);
+
+		parser.parse(1, (const uint8_t*)serverStream.c_str(), serverStream.length(), connData);
+		PTF_ASSERT_EQUAL(log, "X0;R1:22:1000;X1;", string);
+		parser.connectionEnded(connData);
+		PTF_ASSERT_EQUAL(log, "X0;R1:22:1000;X1;", string);
+
+		log.clear();
+		parser.parse(1, (const uint8_t*)serverStream.c_str(), 1005, connData);
+		parser.connectionEnded(connData);
+		PTF_ASSERT_EQUAL(log, "R1:22:1000;X1;", string);
+
+		log.clear();
+		parser.parse(0, (const uint8_t*)clientStream.c_str(), 100, connData);
+		parser.connectionEnded(connData);
+		PTF_ASSERT_EQUAL(log, "R0:22:183;X0;", string);
+	}
+} // SSLStreamParserTest
+
+// a line based test protocol: "BODY n" is followed by n bytes, "SKIP n" by n skipped bytes, "UNTIL" by bytes up to "|||" and "REST" by bytes
+// up to the end of the stream
+class TestLineCoroutine : public StreamCoroutine
+{
+public:
+	TestLineCoroutine(std::string* log) : m_Log(log), m_Number(0) {}
+
+	~TestLineCoroutine() { *m_Log += "~;"; }
+
+	StreamCoroutineStatus resume(ByteStreamReader& stream)
+	{
+		PCPP_STREAM_COROUTINE_BEGIN;
+		while (true)
+		{
+			PCPP_STREAM_AWAIT(stream.readUntil("\r\n", 2, m_Slice) || stream.isEnded());
+			if (stream.isEnded())
+				break;
+
+			m_Line.assign((const char*)m_Slice.data, m_Slice.length);
+			if (m_Line == "QUIT")
+				break;
+			if (m_Line == "BAD")
+				PCPP_STREAM_COROUTINE_FAIL;
+
+			if (m_Line.compare(0, 5, "BODY ") == 0)
+			{
+				m_Number = atoi(m_Line.c_str() + 5);
+				PCPP_STREAM_AWAIT(stream.read(m_Number, m_Slice));
+				*m_Log += "B:" + std::string((const char*)m_Slice.data, m_Slice.length) + ";";
+			}
+			else if (m_Line.compare(0, 5, "SKIP ") == 0)
+			{
+				m_Number = atoi(m_Line.c_str() + 5);
+				PCPP_STREAM_AWAIT(stream.skip(m_Number));
+				std::stringstream position;
+				position << "S:" << stream.getPosition() << ";";
+				*m_Log += position.str();
+			}
+			else if (m_Line == "UNTIL")
+			{
+				PCPP_STREAM_AWAIT(stream.readUntil("|||", 3, m_Slice));
+				*m_Log += "U:" + std::string((const char*)m_Slice.data, m_Slice.length) + ";";
+			}
+			else if (m_Line == "REST")
+			{
+				m_Line.clear();
+				while (true)
+				{
+					PCPP_STREAM_AWAIT(stream.readSome(4, m_Slice) || stream.isEnded());
+					if (stream.isEnded())
+						break;
+					m_Line.append((const char*)m_Slice.data, m_Slice.length);
+				}
+				*m_Log += "R:" + m_Line + ";";
+				break;
+			}
+			else
+				*m_Log += "L:" + m_Line + ";";
+		}
+		PCPP_STREAM_COROUTINE_END;
+	}
+
+private:
+	std::string* m_Log;
+	ByteStreamSlice m_Slice;
+	std::string m_Line;
+	size_t m_Number;
+};
+
+static StreamCoroutine* createTestLineCoroutine(const ConnectionData& connectionData, int side, StreamCoroutinePool& pool, void* userCookie)
+{
+	if (side != 0)
+		return NULL;
+
+	return pool.create<TestLineCoroutine>((std::string*)userCookie);
+}
+
+PTF_TEST_CASE(StreamCoroutineTest)
+{
+	std::string stream = "HELLO\r\nBODY 5\r\nabcdeSKIP 10\r\n0123456789UNTIL\r\nx||y|||LINE2\r\nREST\r\ntail data";
+	std::string sideOneStream = "BAD\r\n";
+	ConnectionData connData;
+	connData.flowKey = 0x1234;
+
+	// the coroutine sees the same stream however it's split between pieces of data
+	size_t pieceSizes[] = { 1, 2, 3, 7, 64, 100000 };
+	for (size_t i = 0; i < sizeof(pieceSizes) / sizeof(size_t); i++)
+	{
+		std::string log;
+		StreamCoroutineDispatcher dispatcher(createTestLineCoroutine, &log);
+		for (size_t offset = 0; offset < stream.length(); offset += pieceSizes[i])
+		{
+			dispatcher.parse(0, (const uint8_t*)stream.c_str() + offset, std::min(pieceSizes[i], stream.length() - offset), connData);
+			dispatcher.parse(1, (const uint8_t*)sideOneStream.c_str(), sideOneStream.length(), connData);
+		}
+
+		PTF_ASSERT_EQUAL(log, "L:HELLO;B:abcde;S:39;U:x||y;L:LINE2;", string);
+		PTF_ASSERT_EQUAL(dispatcher.getNumOfRunningCoroutines(), 1, size);
+		dispatcher.connectionEnded(connData);
+		PTF_ASSERT_EQUAL(log, "L:HELLO;B:abcde;S:39;U:x||y;L:LINE2;R:tail data;~;", string);
+		PTF_ASSERT_EQUAL(dispatcher.getNumOfConnections(), 0, size);
+		PTF_ASSERT_EQUAL(dispatcher.getNumOfRunningCoroutines(), 0, size);
+		PTF_ASSERT_TRUE(dispatcher.getNumOfCoroutinesCreated() == 1);
+		PTF_ASSERT_TRUE(dispatcher.getNumOfCoroutinesDone() == 1);
+	}
+
+	// coroutines which finish, fail, overflow or wait when the connection ends are destroyed and the rest of the stream is ignored
+	{
+		std::string log;
+		StreamCoroutineDispatcher dispatcher(createTestLineCoroutine, &log, StreamCoroutineDispatcherConfiguration(256, 4, 16));
+		std::string quit = "QUIT\r\nHELLO\r\n";
+		std::string bad = "HELLO\r\nBAD\r\nHELLO\r\n";
+		std::string longLine = "HELLO\r\n0123456789abcdefg\r\n";
+		std::string truncated = "BODY 10\r\n12345";
+		ConnectionData connections[4];
+		for (int i = 0; i < 4; i++)
+			connections[i].flowKey = i + 1;
+
+		dispatcher.parse(0, (const uint8_t*)quit.c_str(), quit.length(), connections[0]);
+		dispatcher.parse(0, (const uint8_t*)quit.c_str(), quit.length(), connections[0]);
+		dispatcher.parse(0, (const uint8_t*)bad.c_str(), bad.length(), connections[1]);
+		dispatcher.parse(0, (const uint8_t*)longLine.c_str(), longLine.length(), connections[2]);
+		dispatcher.parse(0, (const uint8_t*)truncated.c_str(), truncated.length(), connections[3]);
+		PTF_ASSERT_EQUAL(log, "~;L:HELLO;~;L:HELLO;~;", string);
+		PTF_ASSERT_EQUAL(dispatcher.getNumOfConnections(), 4, size);
+		PTF_ASSERT_EQUAL(dispatcher.getNumOfRunningCoroutines(), 1, size);
+		PTF_ASSERT_EQUAL(dispatcher.getPool().getNumOfFrames(), 4, size);
+
+		for (int i = 0; i < 4; i++)
+			dispatcher.connectionEnded(connections[i]);
+		PTF_ASSERT_EQUAL(log, "~;L:HELLO;~;L:HELLO;~;~;", string);
+		PTF_ASSERT_TRUE(dispatcher.getNumOfCoroutinesCreated() == 4);
+		PTF_ASSERT_TRUE(dispatcher.getNumOfCoroutinesDone() == 1);
+		PTF_ASSERT_TRUE(dispatcher.getNumOfCoroutinesFailed() == 2);
+		PTF_ASSERT_TRUE(dispatcher.getNumOfCoroutinesInterrupted() == 1);
+
+		// frames are reused
+		for (int i = 0; i < 4; i++)
+			dispatcher.parse(0, (const uint8_t*)truncated.c_str(), truncated.length(), connections[i]);
+		PTF_ASSERT_EQUAL(dispatcher.getNumOfRunningCoroutines(), 4, size);
+		PTF_ASSERT_EQUAL(dispatcher.getPool().getNumOfFrames(), 4, size);
+		dispatcher.clear();
+		PTF_ASSERT_EQUAL(dispatcher.getNumOfRunningCoroutines(), 0, size);
+		PTF_ASSERT_EQUAL(dispatcher.getNumOfConnections(), 0, size);
+	}
+
+	// a coroutine which doesn't fit in a frame isn't created
+	{
+		std::string log;
+		StreamCoroutineDispatcher dispatcher(createTestLineCoroutine, &log, StreamCoroutineDispatcherConfiguration(8));
+		pcpp::LoggerPP::getInstance().supressErrors();
+		dispatcher.parse(0, (const uint8_t*)stream.c_str(), stream.length(), connData);
+		pcpp::LoggerPP::getInstance().enableErrors();
+		PTF_ASSERT_TRUE(dispatcher.getNumOfCoroutinesCreated() == 0);
+		PTF_ASSERT_EQUAL(log, "", string);
+	}
+
+	// the dispatcher can take TcpReassembly callbacks directly
+	{
+		std::string log;
+		StreamCoroutineDispatcher dispatcher(createTestLineCoroutine, &log);
+		TcpReassembly reassembly(StreamCoroutineDispatcher::onTcpMessageReady, &dispatcher, NULL, StreamCoroutineDispatcher::onTcpConnectionEnd);
+		PTF_ASSERT_EQUAL(reassembly.getNumOfOpenConnections(), 0, size);
+	}
+} // StreamCoroutineTest
+
+
+static void allocationBudgetMsgReady(int side, const TcpStreamData& tcpData, void* userCookie)
+{
+	*(size_t*)userCookie += tcpData.getDataLength();
+}
+
+PTF_TEST_CASE(AllocationBudgetTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TwoHttpResponses1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true);
+
+	// the scope counts allocations and bytes, and isn't affected by memory being freed
+	MemPlumberAllocationScope scope;
+	PTF_ASSERT_EQUAL(scope.getAllocationCount(), 0, int);
+	uint8_t* tmp = new uint8_t[100];
+	delete [] tmp;
+	PTF_ASSERT_EQUAL(scope.getAllocationCount(), 1, int);
+	PTF_ASSERT_EQUAL(scope.getAllocationSize(), 100, int);
+	scope.reset();
+	PTF_ASSERT_EQUAL(scope.getAllocationCount(), 0, int);
+	PTF_ASSERT_EQUAL(scope.getAllocationSize(), 0, int);
+
+	// parsing a packet up to TCP allocates one object per layer (Eth, IPv4, TCP)
+	PTF_ASSERT_MAX_ALLOCATIONS(Packet packet(&rawPacket, TCP), 3);
+
+	// re-parsing into a packet with a layer arena doesn't allocate the layers. The HTTP layer still allocates its first line
+	// and header fields
+	LayerArena arena;
+	Packet arenaPacket;
+	arenaPacket.setLayerArena(&arena);
+	arenaPacket.setRawPacket(&rawPacket, false);
+	PTF_ASSERT_MAX_ALLOCATIONS(arenaPacket.setRawPacket(&rawPacket, false, TCP), 0);
+	scope.reset();
+	for (int i = 0; i < 100; i++)
+		arenaPacket.setRawPacket(&rawPacket, false, TCP);
+	PTF_ASSERT_MAX_ALLOCATIONS_IN_SCOPE(scope, 0);
+
+	// in-order data on an established connection is delivered without buffering. The only allocations are the layers of the
+	// Packet each segment is parsed into (Eth, IPv4, TCP and payload)
+	std::vector<RawPacket*> segments;
+	uint8_t data[100];
+	memset(data, 'a', sizeof(data));
+	for (int i = 0; i < 20; i++)
+	{
+		Packet packet(200);
+		EthLayer ethLayer(MacAddress("00:00:00:00:00:01"), MacAddress("00:00:00:00:00:02"), PCPP_ETHERTYPE_IP);
+		IPv4Layer ipLayer(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+		ipLayer.getIPv4Header()->timeToLive = 64;
+		TcpLayer tcpLayer((uint16_t)12345, (uint16_t)80);
+		tcpLayer.getTcpHeader()->sequenceNumber = htonl(1000 + i * sizeof(data));
+		tcpLayer.getTcpHeader()->ackFlag = 1;
+		PayloadLayer payloadLayer(data, sizeof(data), false);
+		packet.addLayer(&ethLayer);
+		packet.addLayer(&ipLayer);
+		packet.addLayer(&tcpLayer);
+		packet.addLayer(&payloadLayer);
+		packet.computeCalculateFields();
+		segments.push_back(new RawPacket(*packet.getRawPacket()));
+	}
+
+	size_t reassembledBytes = 0;
+	TcpReassembly tcpReassembly(allocationBudgetMsgReady, &reassembledBytes);
+	tcpReassembly.reassemblePacket(segments[0]);
+	scope.reset();
+	for (size_t i = 1; i < segments.size(); i++)
+		tcpReassembly.reassemblePacket(segments[i]);
+	PTF_ASSERT_MAX_ALLOCATIONS_IN_SCOPE(scope, (segments.size() - 1) * 4);
+	PTF_ASSERT_EQUAL(reassembledBytes, segments.size() * sizeof(data), size);
+
+	tcpReassembly.closeAllConnections();
+	for (size_t i = 0; i < segments.size(); i++)
+		delete segments[i];
+} // AllocationBudgetTest
+
+
+struct TrafficGeneratorTcpStats
+{
+	int numOfConnStarted;
+	int numOfConnEnded;
+	size_t numOfBytes;
+
+	TrafficGeneratorTcpStats() : numOfConnStarted(0), numOfConnEnded(0), numOfBytes(0) {}
+};
+
+static void trafficGeneratorMsgReady(int side, const TcpStreamData& tcpData, void* userCookie)
+{
+	((TrafficGeneratorTcpStats*)userCookie)->numOfBytes += tcpData.getDataLength();
+}
+
+static void trafficGeneratorConnStart(ConnectionData connectionData, void* userCookie)
+{
+	((TrafficGeneratorTcpStats*)userCookie)->numOfConnStarted++;
+}
+
+static void trafficGeneratorConnEnd(ConnectionData connectionData, TcpReassembly::ConnectionEndReason reason, void* userCookie)
+{
+	if (reason == TcpReassembly::TcpReassemblyConnectionClosedByFIN_RST)
+		((TrafficGeneratorTcpStats*)userCookie)->numOfConnEnded++;
+}
+
+PTF_TEST_CASE(TrafficGeneratorTest)
+{
+	TrafficGeneratorConfiguration config;
+	config.numOfFlows = 40;
+	config.maxConcurrentFlows = 8;
+	config.minPacketsPerFlow = 2;
+	config.maxPacketsPerFlow = 10;
+	config.minPayloadSize = 10;
+	// UDP datagrams larger than the MTU are fragmented
+	config.maxPayloadSize = 4000;
+	config.seed = 7;
+	config.startTime.tv_sec = 1000;
+
+	TrafficGenerator generator(config);
+	std::vector<RawPacket*> packets;
+	size_t numOfPackets = generator.generateAll(packets);
+	PTF_ASSERT_EQUAL(packets.size(), numOfPackets, size);
+	PTF_ASSERT_TRUE(numOfPackets > 100);
+	PTF_ASSERT_EQUAL(generator.getNumOfFlowsStarted(), 40, size);
+	PTF_ASSERT_EQUAL(generator.getNumOfPacketsGenerated(), (uint64_t)numOfPackets, u32);
+	PTF_ASSERT_EQUAL(generator.getNumOfPacketsDropped(), 0, u32);
+	PTF_ASSERT_FALSE(generator.getNextPacket(*packets[0], NULL));
+
+	// timestamps are consecutive
+	PTF_ASSERT_EQUAL(packets[0]->getPacketTimeStamp().tv_sec, 1000, int);
+	PTF_ASSERT_EQUAL(packets[0]->getPacketTimeStamp().tv_usec, 0, int);
+	PTF_ASSERT_EQUAL(packets[1]->getPacketTimeStamp().tv_usec, 10, int);
+
+	// all packets are valid: the lengths and checksums are the same as the ones the layers calculate
+	int numOfTcp = 0, numOfHttpRequests = 0, numOfHttpResponses = 0, numOfDns = 0, numOfFragments = 0;
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		PTF_ASSERT_TRUE(packets[i]->getRawDataLen() <= 1514);
+		Packet packet(packets[i]);
+		IPv4Layer* ipLayer = packet.getLayerOfType<IPv4Layer>();
+		PTF_ASSERT_NOT_NULL(ipLayer);
+		if (ipLayer->isFragment())
+		{
+			numOfFragments++;
+			continue;
+		}
+
+		numOfTcp += (packet.isPacketOfType(TCP) ? 1 : 0);
+		numOfHttpRequests += (packet.isPacketOfType(HTTPRequest) ? 1 : 0);
+		numOfHttpResponses += (packet.isPacketOfType(HTTPResponse) ? 1 : 0);
+		numOfDns += (packet.isPacketOfType(DNS) ? 1 : 0);
+
+		RawPacket copy(*packets[i]);
+		Packet copyPacket(&copy);
+		copyPacket.computeCalculateFields();
+		PTF_ASSERT_BUF_COMPARE(copy.getRawData(), packets[i]->getRawData(), packets[i]->getRawDataLen());
+	}
+	PTF_ASSERT_TRUE(numOfTcp > 0);
+	PTF_ASSERT_TRUE(numOfHttpRequests > 0);
+	PTF_ASSERT_EQUAL(numOfHttpResponses, numOfHttpRequests, int);
+	PTF_ASSERT_TRUE(numOfDns > 0 && numOfDns % 2 == 0);
+	PTF_ASSERT_TRUE(numOfFragments > 0);
+
+	// TCP flows are complete connections which close with FIN packets
+	TrafficGeneratorTcpStats tcpStats;
+	TcpReassembly tcpReassembly(trafficGeneratorMsgReady, &tcpStats, trafficGeneratorConnStart, trafficGeneratorConnEnd);
+	for (size_t i = 0; i < numOfPackets; i++)
+		tcpReassembly.reassemblePacket(packets[i]);
+	PTF_ASSERT_TRUE(tcpStats.numOfConnStarted > 0);
+	PTF_ASSERT_EQUAL(tcpStats.numOfConnEnded, tcpStats.numOfConnStarted, int);
+	PTF_ASSERT_TRUE(tcpStats.numOfBytes > 0);
+
+	// fragments are reassembled into valid UDP datagrams
+	IPReassembly ipReassembly;
+	int numOfReassembled = 0;
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		IPReassembly::ReassemblyStatus status;
+		Packet* result = ipReassembly.processPacket(packets[i], status);
+		if (status == IPReassembly::REASSEMBLED)
+		{
+			numOfReassembled++;
+			UdpLayer* udpLayer = result->getLayerOfType<UdpLayer>();
+			PTF_ASSERT_NOT_NULL(udpLayer);
+			uint16_t checksum = udpLayer->getUdpHeader()->headerChecksum;
+			PTF_ASSERT_EQUAL(ntohs(checksum), udpLayer->calculateChecksum(false), u16);
+		}
+		delete result;
+	}
+	PTF_ASSERT_TRUE(numOfReassembled > 0);
+	PTF_ASSERT_EQUAL(ipReassembly.getCurrentCapacity(), 0, size);
+
+	// the same configuration generates the same packets, and doesn't allocate memory when the packets aren't copied
+	generator.reset();
+	RawPacket rawPacket;
+	MemPlumberAllocationScope scope;
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		PTF_ASSERT_TRUE(generator.getNextPacket(rawPacket));
+		PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), packets[i]->getRawDataLen(), int);
+		PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), packets[i]->getRawData(), rawPacket.getRawDataLen());
+	}
+	PTF_ASSERT_FALSE(generator.getNextPacket(rawPacket));
+	PTF_ASSERT_MAX_ALLOCATIONS_IN_SCOPE(scope, 0);
+
+	// loss drops packets and reordering changes the order but not the packets
+	config.lossPercent = 10;
+	TrafficGenerator lossyGenerator(config);
+	std::vector<RawPacket*> lossyPackets;
+	lossyGenerator.generateAll(lossyPackets);
+	PTF_ASSERT_TRUE(lossyGenerator.getNumOfPacketsDropped() > 0);
+	PTF_ASSERT_TRUE(lossyPackets.size() < numOfPackets);
+
+	config.lossPercent = 0;
+	config.reorderPercent = 30;
+	TrafficGenerator reorderGenerator(config);
+	std::vector<RawPacket*> reorderedPackets;
+	reorderGenerator.generateAll(reorderedPackets);
+	PTF_ASSERT_EQUAL(reorderedPackets.size(), numOfPackets, size);
+	int numOfMoved = 0;
+	size_t totalBytes = 0, reorderedTotalBytes = 0;
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		if (reorderedPackets[i]->getRawDataLen() != packets[i]->getRawDataLen() ||
+				memcmp(reorderedPackets[i]->getRawData(), packets[i]->getRawData(), packets[i]->getRawDataLen()) != 0)
+			numOfMoved++;
+		totalBytes += packets[i]->getRawDataLen();
+		reorderedTotalBytes += reorderedPackets[i]->getRawDataLen();
+	}
+	PTF_ASSERT_TRUE(numOfMoved > 0);
+	PTF_ASSERT_EQUAL(reorderedTotalBytes, totalBytes, size);
+
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		delete packets[i];
+		delete reorderedPackets[i];
+	}
+	for (size_t i = 0; i < lossyPackets.size(); i++)
+		delete lossyPackets[i];
+} // TrafficGeneratorTest
+
+
+
+static void* latencyTracerTestThread(void*)
+{
+	// a thread which didn't receive packets doesn't record the time since RX
+	pcpp::LatencyTracer::recordStage(pcpp::LatencyStageFirstUserStage, 500, 1000, pcpp::LatencyStageFirstUserStage + 1);
+	return NULL;
+}
+
+PTF_TEST_CASE(LatencyTracerTest)
+{
+	LatencyHistogram* histogram = new LatencyHistogram();
+	PTF_ASSERT_EQUAL(histogram->getCount(), 0, u32);
+	PTF_ASSERT_EQUAL(histogram->getMin(), 0, u32);
+	PTF_ASSERT_EQUAL(histogram->getValueAtPercentile(99), 0, u32);
+
+	// every value falls inside its bucket, and large values are counted with ~3% precision
+	uint64_t values[] = { 0, 1, 63, 64, 65, 100, 1000, 12345, 1000000, 123456789, 1ULL << 47 };
+	for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+	{
+		size_t bucket = LatencyHistogram::getBucketIndex(values[i]);
+		PTF_ASSERT_TRUE(bucket < PCPP_LATENCY_HISTOGRAM_NUM_OF_BUCKETS);
+		PTF_ASSERT_TRUE(LatencyHistogram::getBucketLowestValue(bucket) <= values[i]);
+		PTF_ASSERT_TRUE(LatencyHistogram::getBucketHighestValue(bucket) >= values[i]);
+		uint64_t width = LatencyHistogram::getBucketHighestValue(bucket) - LatencyHistogram::getBucketLowestValue(bucket);
+		PTF_ASSERT_TRUE(width <= values[i] / 32);
+	}
+	PTF_ASSERT_EQUAL(LatencyHistogram::getBucketIndex((uint64_t)-1), PCPP_LATENCY_HISTOGRAM_NUM_OF_BUCKETS - 1, size);
+
+	for (uint64_t value = 0; value < 1000; value++)
+		histogram->record(value);
+
+	PTF_ASSERT_EQUAL(histogram->getCount(), 1000, u32);
+	PTF_ASSERT_EQUAL(histogram->getMin(), 0, u32);
+	PTF_ASSERT_EQUAL(histogram->getMax(), 999, u32);
+	PTF_ASSERT_TRUE(histogram->getMean() > 499.4 && histogram->getMean() < 499.6);
+	uint64_t median = histogram->getValueAtPercentile(50);
+	PTF_ASSERT_TRUE(median >= 499 && median <= 499 + 499 / 32);
+	uint64_t p99 = histogram->getValueAtPercentile(99);
+	PTF_ASSERT_TRUE(p99 >= 989 && p99 <= 999);
+	PTF_ASSERT_EQUAL(histogram->getValueAtPercentile(100), 999, u32);
+
+	LatencyHistogram* other = new LatencyHistogram();
+	other->record(1000000);
+	histogram->merge(*other);
+	PTF_ASSERT_EQUAL(histogram->getCount(), 1001, u32);
+	PTF_ASSERT_EQUAL(histogram->getMax(), 1000000, u32);
+	PTF_ASSERT_EQUAL(histogram->getValueAtPercentile(100), 1000000, u32);
+	histogram->reset();
+	PTF_ASSERT_EQUAL(histogram->getCount(), 0, u32);
+	PTF_ASSERT_EQUAL(histogram->getMax(), 0, u32);
+
+	// stages are recorded into the histograms of the current thread
+#ifdef PCPP_ENABLE_LATENCY_TRACING
+	PTF_ASSERT_TRUE(LatencyTracer::isTracingCompiledIn());
+#else
+	PTF_ASSERT_FALSE(LatencyTracer::isTracingCompiledIn());
+#endif
+	LatencyTracer::reset();
+	const int stage = LatencyStageFirstUserStage;
+	const int sinceRxStage = LatencyStageFirstUserStage + 1;
+	PTF_ASSERT_TRUE(LatencyTracer::setStageName(stage, "test-stage"));
+	PTF_ASSERT_EQUAL(std::string(LatencyTracer::getStageName(stage)), "test-stage", string);
+	PTF_ASSERT_EQUAL(std::string(LatencyTracer::getStageName(LatencyStageParse)), "parse", string);
+	PTF_ASSERT_FALSE(LatencyTracer::setStageName(PCPP_LATENCY_TRACER_MAX_STAGES, "out-of-range"));
+
+	LatencyTracer::markRx(1000);
+	LatencyTracer::recordStage(stage, 1100, 1250, sinceRxStage);
+	// time going backwards is counted as 0
+	LatencyTracer::recordStage(stage, 2000, 1900);
+
+	int threadIndex = LatencyTracer::getCurrentThreadIndex();
+	PTF_ASSERT_TRUE(threadIndex >= 0 && threadIndex < LatencyTracer::getNumOfThreads());
+	const LatencyHistogram* stageHistogram = LatencyTracer::getThreadHistogram(threadIndex, stage);
+	PTF_ASSERT_NOT_NULL(stageHistogram);
+	PTF_ASSERT_EQUAL(stageHistogram->getCount(), 2, u32);
+	PTF_ASSERT_EQUAL(stageHistogram->getMin(), 0, u32);
+	PTF_ASSERT_EQUAL(stageHistogram->getMax(), 150, u32);
+	PTF_ASSERT_EQUAL(LatencyTracer::getThreadHistogram(threadIndex, sinceRxStage)->getMax(), 250, u32);
+	PTF_ASSERT_NULL(LatencyTracer::getThreadHistogram(LatencyTracer::getNumOfThreads(), stage));
+	PTF_ASSERT_NULL(LatencyTracer::getThreadHistogram(threadIndex, PCPP_LATENCY_TRACER_MAX_STAGES));
+
+	PTF_ASSERT_TRUE(LatencyTracer::getAggregatedHistogram(sinceRxStage, *histogram));
+	PTF_ASSERT_EQUAL(histogram->getCount(), 1, u32);
+	PTF_ASSERT_FALSE(LatencyTracer::getAggregatedHistogram(-1, *histogram));
+
+	// a stage recorded on another thread gets the histograms of that thread
+	pthread_t thread;
+	PTF_ASSERT_EQUAL(pthread_create(&thread, NULL, latencyTracerTestThread, NULL), 0, int);
+	pthread_join(thread, NULL);
+	PTF_ASSERT_TRUE(LatencyTracer::getNumOfThreads() >= 2);
+	PTF_ASSERT_TRUE(LatencyTracer::getAggregatedHistogram(stage, *histogram));
+	PTF_ASSERT_EQUAL(histogram->getCount(), 3, u32);
+	PTF_ASSERT_EQUAL(histogram->getMax(), 500, u32);
+	PTF_ASSERT_EQUAL(stageHistogram->getCount(), 2, u32);
+
+	PTF_ASSERT_TRUE(LatencyTracer::cyclesToNs(0) == 0);
+	PTF_ASSERT_TRUE(LatencyTracer::cyclesToNs(1000000) > 0);
+
+	LatencyTracer::reset();
+	PTF_ASSERT_EQUAL(stageHistogram->getCount(), 0, u32);
+	LatencyTracer::setStageName(stage, NULL);
+
+	delete histogram;
+	delete other;
+} // LatencyTracerTest
+
+
+class TestMetricsSource : public MetricsSource
+{
+public:
+	uint64_t packets;
+	double queueLen;
+
+	TestMetricsSource() : packets(0), queueLen(0) {}
+
+	void collectMetrics(MetricsWriter& writer)
+	{
+		writer.addCounter("test_packets_total", "Test packets", packets);
+		writer.addGauge("test_queue_length", "Test queue\nlength", queueLen, "queue=\"0\"");
+	}
+};
+
+// send an HTTP request to the exporter and return the whole response
+static std::string metricsHttpGet(uint16_t port, const std::string& path)
+{
+	int sock = (int)socket(AF_INET, SOCK_STREAM, 0);
+	if (sock < 0)
+		return "";
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	std::string response;
+	if (connect(sock, (sockaddr*)&addr, sizeof(addr)) == 0)
+	{
+		std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+		send(sock, request.c_str(), (int)request.length(), 0);
+		char buffer[1024];
+		int len;
+		while ((len = (int)recv(sock, buffer, sizeof(buffer), 0)) > 0)
+			response.append(buffer, len);
+	}
+
+#ifdef WIN32
+	closesocket(sock);
+#else
+	close(sock);
+#endif
+	return response;
+}
+
+PTF_TEST_CASE(MetricsRegistryTest)
+{
+	PTF_ASSERT_EQUAL(MetricsRegistry::createLabel("device", "eth\"0\"\\"), "device=\"eth\\\"0\\\"\\\\\"", string);
+	PTF_ASSERT_EQUAL(MetricsRegistry::sanitizeName("1st rx-packets:total"), "_st_rx_packets:total", string);
+
+	MetricsRegistry registry;
+	TestMetricsSource source1, source2;
+	PTF_ASSERT_TRUE(registry.addSource(&source1, MetricsRegistry::createLabel("device", "a")));
+	PTF_ASSERT_TRUE(registry.addSource(&source2, MetricsRegistry::createLabel("device", "b")));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(registry.addSource(&source1));
+	PTF_ASSERT_FALSE(registry.addSource(NULL));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL(registry.getNumOfSources(), 2, size);
+
+	source1.packets = 10;
+	source2.packets = 12345678901ULL;
+	source2.queueLen = 2.5;
+	MetricsSnapshot snapshot;
+	registry.snapshot(snapshot);
+	PTF_ASSERT_EQUAL(snapshot.values.size(), 4, size);
+	const MetricValue* value = snapshot.find("test_packets_total", "device=\"b\"");
+	PTF_ASSERT_NOT_NULL(value);
+	PTF_ASSERT_EQUAL(value->type, MetricCounter, enum);
+	PTF_ASSERT_TRUE(value->value == 12345678901.0);
+	value = snapshot.find("test_queue_length", "device=\"a\",queue=\"0\"");
+	PTF_ASSERT_NOT_NULL(value);
+	PTF_ASSERT_EQUAL(value->type, MetricGauge, enum);
+	PTF_ASSERT_NULL(snapshot.find("test_packets_total"));
+
+	// the values of each metric are grouped under one HELP and TYPE line
+	std::string text;
+	snapshot.toPrometheusText(text);
+	PTF_ASSERT_EQUAL(text,
+			"# HELP test_packets_total Test packets\n"
+			"# TYPE test_packets_total counter\n"
+			"test_packets_total{device=\"a\"} 10\n"
+			"test_packets_total{device=\"b\"} 12345678901\n"
+			"# HELP test_queue_length Test queue\\nlength\n"
+			"# TYPE test_queue_length gauge\n"
+			"test_queue_length{device=\"a\",queue=\"0\"} 0\n"
+			"test_queue_length{device=\"b\",queue=\"0\"} 2.5\n", string);
+
+	PTF_ASSERT_TRUE(registry.removeSource(&source2));
+	PTF_ASSERT_FALSE(registry.removeSource(&source2));
+	registry.snapshot(snapshot);
+	PTF_ASSERT_EQUAL(snapshot.values.size(), 2, size);
+
+	// StatsCounters report their totals over all workers
+	std::vector<std::string> names;
+	names.push_back("rx packets");
+	names.push_back("queue_len");
+	StatsCounters counters(names, 2);
+	counters.setMetricType(1, MetricGauge);
+	counters.add(0, 0, 3);
+	counters.add(1, 0, 4);
+	counters.set(1, 1, 9);
+	PTF_ASSERT_TRUE(registry.addSource(&counters));
+
+	// the engines report the counters they keep while processing packets
+	TrafficGeneratorConfiguration config;
+	config.numOfFlows = 20;
+	config.minPayloadSize = 10;
+	config.maxPayloadSize = 4000;
+	config.seed = 3;
+	config.startTime.tv_sec = 1000;
+	TrafficGenerator generator(config);
+	TcpReassemblyTableStats tcpStats;
+	TcpReassembly tcpReassembly(tcpReassemblyTableMsgReady, &tcpStats, tcpReassemblyTableConnStart, tcpReassemblyTableConnEnd);
+	IPReassembly ipReassembly;
+	PTF_ASSERT_TRUE(registry.addSource(&tcpReassembly, MetricsRegistry::createLabel("engine", "tcp")));
+	PTF_ASSERT_TRUE(registry.addSource(&ipReassembly, MetricsRegistry::createLabel("engine", "ip")));
+
+	RawPacket rawPacket;
+	while (generator.getNextPacket(rawPacket))
+	{
+		Packet packet(&rawPacket);
+		tcpReassembly.reassemblePacket(packet);
+		IPReassembly::ReassemblyStatus status;
+		Packet* reassembled = ipReassembly.processPacket(&packet, status);
+		if (reassembled != &packet)
+			delete reassembled;
+	}
+
+	registry.snapshot(snapshot);
+	PTF_ASSERT_TRUE(snapshot.find("rx_packets_total")->value == 7.0);
+	PTF_ASSERT_EQUAL(snapshot.find("queue_len")->type, MetricGauge, enum);
+	PTF_ASSERT_TRUE(snapshot.find("queue_len")->value == 9.0);
+
+	PTF_ASSERT_TRUE(tcpStats.numOfConnStarted > 0);
+	PTF_ASSERT_TRUE(snapshot.find("pcpp_tcp_reassembly_connections_total", "engine=\"tcp\"")->value == (double)tcpStats.numOfConnStarted);
+	PTF_ASSERT_TRUE(snapshot.find("pcpp_tcp_reassembly_open_connections", "engine=\"tcp\"")->value == (double)(tcpStats.numOfConnStarted - tcpStats.numOfConnEnded));
+	PTF_ASSERT_TRUE(snapshot.find("pcpp_tcp_reassembly_packets_total", "engine=\"tcp\"")->value == (double)tcpReassembly.getNumOfPacketsProcessed());
+	PTF_ASSERT_TRUE(tcpReassembly.getNumOfPayloadBytesProcessed() > 0);
+	tcpReassembly.closeAllConnections();
+	PTF_ASSERT_EQUAL(tcpReassembly.getNumOfOpenConnections(), 0, size);
+
+	PTF_ASSERT_TRUE(ipReassembly.getNumOfPacketsReassembled() > 0);
+	PTF_ASSERT_TRUE(ipReassembly.getNumOfFragmentsProcessed() > ipReassembly.getNumOfPacketsReassembled());
+	PTF_ASSERT_TRUE(snapshot.find("pcpp_ip_reassembly_reassembled_packets_total", "engine=\"ip\"")->value == (double)ipReassembly.getNumOfPacketsReassembled());
+	PTF_ASSERT_TRUE(snapshot.find("pcpp_ip_reassembly_pending_packets", "engine=\"ip\"")->value == 0.0);
+	PTF_ASSERT_EQUAL(ipReassembly.getNumOfMalformedFragments(), 0, u32);
+
+	// the exporter serves the registry over HTTP from its own thread
+	MetricsHttpExporter exporter(registry);
+	PTF_ASSERT_TRUE(exporter.start(0, "127.0.0.1"));
+	PTF_ASSERT_TRUE(exporter.isRunning());
+	PTF_ASSERT_TRUE(exporter.getPort() != 0);
+	std::string response = metricsHttpGet(exporter.getPort(), "/metrics");
+	PTF_ASSERT_TRUE(response.find("HTTP/1.1 200 OK\r\n") == 0);
+	PTF_ASSERT_TRUE(response.find("Content-Type: text/plain; version=0.0.4") != std::string::npos);
+	PTF_ASSERT_TRUE(response.find("\r\n\r\n# HELP test_packets_total Test packets\n") != std::string::npos);
+	PTF_ASSERT_TRUE(response.find("\nrx_packets_total 7\n") != std::string::npos);
+	PTF_ASSERT_TRUE(response.find("\n# TYPE pcpp_tcp_reassembly_open_connections gauge\npcpp_tcp_reassembly_open_connections{engine=\"tcp\"} 0\n") != std::string::npos);
+	response = metricsHttpGet(exporter.getPort(), "/other");
+	PTF_ASSERT_TRUE(response.find("HTTP/1.1 404 Not Found\r\n") == 0);
+	PTF_ASSERT_EQUAL(exporter.getNumOfRequests(), 2, u32);
+	exporter.stop();
+	PTF_ASSERT_FALSE(exporter.isRunning());
+	PTF_ASSERT_EQUAL(exporter.getPort(), 0, u16);
+
+	registry.removeSource(&counters);
+	registry.removeSource(&tcpReassembly);
+	registry.removeSource(&ipReassembly);
+} // MetricsRegistryTest
+
+
+
+// the performance tests' workloads store their results here so the compiler can't optimize their work away
+static volatile uint64_t perfTestSink = 0;
+
+/**
+ * A set of packets generated by TrafficGenerator for the performance tests, parsed ahead of time for workloads which don't measure
+ * parsing
+ */
+struct PerfTestPackets
+{
+	std::vector<RawPacket*> rawPackets;
+	std::vector<Packet*> parsedPackets;
+
+	PerfTestPackets(const TrafficGeneratorConfiguration& config)
+	{
+		TrafficGenerator generator(config);
+		generator.generateAll(rawPackets);
+		for (size_t i = 0; i < rawPackets.size(); i++)
+			parsedPackets.push_back(new Packet(rawPackets[i]));
+	}
+
+	~PerfTestPackets()
+	{
+		for (size_t i = 0; i < rawPackets.size(); i++)
+		{
+			delete parsedPackets[i];
+			delete rawPackets[i];
+		}
+	}
+};
+
+static TrafficGeneratorConfiguration getPerfTestTrafficConfig()
+{
+	TrafficGeneratorConfiguration config;
+	config.numOfFlows = 200;
+	config.maxConcurrentFlows = 50;
+	config.minPacketsPerFlow = 5;
+	config.maxPacketsPerFlow = 20;
+	config.maxPayloadSize = 1400;
+	config.seed = 17;
+	return config;
+}
+
+static void perfParseWorkload(void* cookie)
+{
+	PerfTestPackets* packets = (PerfTestPackets*)cookie;
+	uint64_t sum = 0;
+	for (size_t i = 0; i < packets->rawPackets.size(); i++)
+	{
+		Packet packet(packets->rawPackets[i]);
+		sum += packet.getLastLayer()->getProtocol();
+	}
+	perfTestSink = sum;
+}
+
+static void perfChecksumWorkload(void* cookie)
+{
+	PerfTestPackets* packets = (PerfTestPackets*)cookie;
+	uint64_t sum = 0;
+	for (size_t i = 0; i < packets->parsedPackets.size(); i++)
+	{
+		Packet* packet = packets->parsedPackets[i];
+		IPv4Layer* ipLayer = packet->getLayerOfType<IPv4Layer>();
+		if (ipLayer == NULL)
+			continue;
+
+		ScalarBuffer<uint16_t> ipHeader;
+		ipHeader.buffer = (uint16_t*)ipLayer->getData();
+		ipHeader.len = ipLayer->getHeaderLen();
+		sum += compute_checksum(&ipHeader, 1);
+
+		TcpLayer* tcpLayer = packet->getLayerOfType<TcpLayer>();
+		if (tcpLayer != NULL)
+		{
+			sum += tcpLayer->calculateChecksum(false);
+			continue;
+		}
+
+		UdpLayer* udpLayer = packet->getLayerOfType<UdpLayer>();
+		if (udpLayer != NULL)
+			sum += udpLayer->calculateChecksum(false);
+	}
+	perfTestSink = sum;
+}
+
+static void perfTcpReassemblyMsgReady(int side, const TcpStreamData& tcpData, void* userCookie)
+{
+	*(uint64_t*)userCookie += tcpData.getDataLength();
+}
+
+static void perfTcpReassemblyWorkload(void* cookie)
+{
+	PerfTestPackets* packets = (PerfTestPackets*)cookie;
+	uint64_t numOfBytes = 0;
+	TcpReassembly tcpReassembly(perfTcpReassemblyMsgReady, &numOfBytes);
+	for (size_t i = 0; i < packets->parsedPackets.size(); i++)
+		tcpReassembly.reassemblePacket(*packets->parsedPackets[i]);
+	tcpReassembly.closeAllConnections();
+	perfTestSink = numOfBytes;
+}
+
+static void perfIPReassemblyWorkload(void* cookie)
+{
+	PerfTestPackets* packets = (PerfTestPackets*)cookie;
+	uint64_t numOfPackets = 0;
+	IPReassembly ipReassembly;
+	IPReassembly::ReassemblyStatus status;
+	for (size_t i = 0; i < packets->parsedPackets.size(); i++)
+	{
+		Packet* result = ipReassembly.processPacket(packets->parsedPackets[i], status);
+		if (status == IPReassembly::REASSEMBLED)
+		{
+			numOfPackets++;
+			delete result;
+		}
+	}
+	perfTestSink = numOfPackets;
+}
+
+
+// the baselines below are the ratios measured with an optimized (-O2) build plus some headroom
+PTF_TEST_CASE(ParsePerfTest)
+{
+	PerfTestPackets packets(getPerfTestTrafficConfig());
+	PTF_ASSERT_PERF("parse", perfParseWorkload, &packets, 0.07);
+} // ParsePerfTest
+
+
+
+PTF_TEST_CASE(ChecksumPerfTest)
+{
+	PerfTestPackets packets(getPerfTestTrafficConfig());
+	PTF_ASSERT_PERF("checksum", perfChecksumWorkload, &packets, 0.13);
+} // ChecksumPerfTest
+
+
+
+PTF_TEST_CASE(TcpReassemblyPerfTest)
+{
+	TrafficGeneratorConfiguration config = getPerfTestTrafficConfig();
+	config.udpWeight = 0;
+	config.dnsWeight = 0;
+	PerfTestPackets packets(config);
+	PTF_ASSERT_PERF("tcp_reassembly", perfTcpReassemblyWorkload, &packets, 0.1);
+} // TcpReassemblyPerfTest
+
+
+
+PTF_TEST_CASE(IPReassemblyPerfTest)
+{
+	// UDP datagrams of up to 8000 bytes, most of which are sent in several fragments
+	TrafficGeneratorConfiguration config = getPerfTestTrafficConfig();
+	config.tcpWeight = 0;
+	config.httpWeight = 0;
+	config.dnsWeight = 0;
+	config.minPayloadSize = 1000;
+	config.maxPayloadSize = 8000;
+	PerfTestPackets packets(config);
+	PTF_ASSERT_PERF("ip_reassembly", perfIPReassemblyWorkload, &packets, 0.62);
+} // IPReassemblyPerfTest
+
+
+
+PTF_TEST_CASE(HardwareCountersTest)
+{
+	// adding values: an empty instance takes the other's availability, otherwise only counters available in both stay available
+	HardwareCounterValues sum;
+	PTF_ASSERT_FALSE(sum.isAnyAvailable());
+	PTF_ASSERT_TRUE(sum.getPerUnit(HwCounterCycles, 10) == -1);
+	PTF_ASSERT_TRUE(sum.getInstructionsPerCycle() == -1);
+	PTF_ASSERT_EQUAL(HardwareCounters::toString(sum, 10), "", string);
+
+	HardwareCounterValues values;
+	values.values[HwCounterCycles] = 2000;
+	values.available[HwCounterCycles] = true;
+	values.values[HwCounterInstructions] = 3000;
+	values.available[HwCounterInstructions] = true;
+	values.values[HwCounterLLCMisses] = 10;
+	values.available[HwCounterLLCMisses] = true;
+	sum += values;
+	PTF_ASSERT_TRUE(sum.isAnyAvailable());
+	PTF_ASSERT_TRUE(sum.values[HwCounterCycles] == 2000);
+	PTF_ASSERT_TRUE(sum.available[HwCounterLLCMisses]);
+	PTF_ASSERT_FALSE(sum.available[HwCounterBranchMisses]);
+
+	values.available[HwCounterLLCMisses] = false;
+	sum += values;
+	PTF_ASSERT_TRUE(sum.values[HwCounterCycles] == 4000);
+	PTF_ASSERT_TRUE(sum.values[HwCounterInstructions] == 6000);
+	PTF_ASSERT_FALSE(sum.available[HwCounterLLCMisses]);
+	PTF_ASSERT_TRUE(sum.getPerUnit(HwCounterCycles, 10) == 400);
+	PTF_ASSERT_TRUE(sum.getPerUnit(HwCounterCycles, 0) == -1);
+	PTF_ASSERT_TRUE(sum.getPerUnit(HwCounterLLCMisses, 10) == -1);
+	PTF_ASSERT_TRUE(sum.getInstructionsPerCycle() == 1.5);
+	PTF_ASSERT_EQUAL(HardwareCounters::toString(sum, 10), "400.0 cycles 600.0 instructions 1.50 IPC", string);
+	PTF_ASSERT_EQUAL(std::string(HardwareCounterValues::getName(HwCounterL1DataMisses)), "l1d-misses", string);
+
+	sum.clear();
+	PTF_ASSERT_FALSE(sum.isAnyAvailable());
+	PTF_ASSERT_TRUE(sum.values[HwCounterCycles] == 0);
+
+	// counting the events of real code works only where the kernel and the CPU expose hardware counters, which virtual machines
+	// often don't
+	HardwareCounters counters;
+	PTF_ASSERT_FALSE(counters.isOpen());
+	HardwareCounterValues result;
+	PTF_ASSERT_FALSE(counters.read(result));
+	LoggerPP::getInstance().supressErrors();
+	bool opened = counters.open();
+	LoggerPP::getInstance().enableErrors();
+	if (!opened)
+	{
+		PTF_PRINT_VERBOSE("Hardware counters aren't available on this machine");
+		PTF_ASSERT_FALSE(counters.isOpen());
+		return;
+	}
+
+	PTF_ASSERT_TRUE(counters.isOpen());
+	counters.start();
+	uint64_t checksum = 0;
+	for (uint64_t i = 0; i < 1000000; i++)
+		checksum += i * i;
+	counters.stop();
+	perfTestSink = checksum;
+	PTF_ASSERT_TRUE(counters.read(result));
+	PTF_ASSERT_TRUE(result.isAnyAvailable());
+	if (result.available[HwCounterInstructions])
+		PTF_ASSERT_TRUE(result.values[HwCounterInstructions] >= 1000000);
+
+	counters.close();
+	PTF_ASSERT_FALSE(counters.isOpen());
+} // HardwareCountersTest
+
+
+
+PTF_TEST_CASE(HashCountersTest)
+{
+	// interned strings are found by pointer and length, without null termination
+	StringTable table;
+	const char* text = "example.com:8080";
+	uint32_t id = table.intern(text, 11);
+	PTF_ASSERT_EQUAL(id, 0, u32);
+	PTF_ASSERT_EQUAL(table.intern(std::string("example.com")), 0, u32);
+	PTF_ASSERT_EQUAL(table.intern("pcapplusplus.com", 16), 1, u32);
+	PTF_ASSERT_EQUAL(table.find(text, 16), StringTable::NotFound, u32);
+	PTF_ASSERT_EQUAL(table.getString(0), "example.com", string);
+	PTF_ASSERT_EQUAL(table.size(), 2, size);
+	for (int i = 0; i < 1000; i++)
+	{
+		std::stringstream name;
+		name << "host" << i;
+		PTF_ASSERT_EQUAL(table.intern(name.str()), (uint32_t)i + 2, u32);
+	}
+	PTF_ASSERT_EQUAL(table.find("host500", 7), 502, u32);
+	PTF_ASSERT_TRUE(table.reassign(502, "other.org", 9, hashString("other.org", 9)));
+	PTF_ASSERT_EQUAL(table.find("host500", 7), StringTable::NotFound, u32);
+	PTF_ASSERT_EQUAL(table.find("other.org", 9), 502, u32);
+	PTF_ASSERT_FALSE(table.reassign(3, "other.org", 9, hashString("other.org", 9)));
+	for (int i = 0; i < 1000; i++)
+	{
+		std::stringstream name;
+		name << "host" << i;
+		PTF_ASSERT_EQUAL(table.find(name.str().data(), name.str().length()), (i == 500 ? StringTable::NotFound : (uint32_t)i + 2), u32);
+	}
+
+	StringTable boundedTable(2);
+	boundedTable.intern("a", 1);
+	boundedTable.intern("b", 1);
+	PTF_ASSERT_EQUAL(boundedTable.intern("c", 1), StringTable::NotFound, u32);
+	PTF_ASSERT_EQUAL(boundedTable.intern("b", 1), 1, u32);
+
+	// inserting and erasing keys in an open-addressing map
+	FlatHashMap<int> map;
+	PTF_ASSERT_NULL(map.find(7));
+	for (int i = 0; i < 5000; i++)
+		map[(uint64_t)i * 16] = i;
+	PTF_ASSERT_EQUAL(map.size(), 5000, size);
+	bool isNew = true;
+	PTF_ASSERT_EQUAL(map.get(16 * 10, &isNew), 10, int);
+	PTF_ASSERT_FALSE(isNew);
+	for (int i = 0; i < 5000; i += 2)
+		PTF_ASSERT_TRUE(map.erase((uint64_t)i * 16));
+	PTF_ASSERT_FALSE(map.erase(0));
+	PTF_ASSERT_EQUAL(map.size(), 2500, size);
+	for (int i = 0; i < 5000; i++)
+	{
+		int* value = map.find((uint64_t)i * 16);
+		if (i % 2 == 0)
+		{
+			PTF_ASSERT_NULL(value);
+		}
+		else
+		{
+			PTF_ASSERT_NOT_NULL(value);
+			PTF_ASSERT_EQUAL(*value, i, int);
+		}
+	}
+
+	// counting and merging keys
+	HashCounter ports;
+	ports.add(443, 5);
+	ports.add(80);
+	ports.add(8443, 5);
+	HashCounter otherPorts;
+	otherPorts.add(80, 10);
+	ports.merge(otherPorts);
+	PTF_ASSERT_EQUAL(ports.getCount(80), 11, int);
+	PTF_ASSERT_EQUAL(ports.getCount(22), 0, int);
+	PTF_ASSERT_EQUAL(ports.getTotalCount(), 21, int);
+	std::vector<std::pair<uint64_t, uint64_t> > sortedPorts;
+	ports.getSortedCounts(sortedPorts);
+	PTF_ASSERT_EQUAL(sortedPorts.size(), 3, size);
+	PTF_ASSERT_EQUAL(sortedPorts[0].first, 80, int);
+	PTF_ASSERT_EQUAL(sortedPorts[1].first, 443, int);
+	PTF_ASSERT_EQUAL(sortedPorts[2].first, 8443, int);
+	ports.getSortedCounts(sortedPorts, 1);
+	PTF_ASSERT_EQUAL(sortedPorts.size(), 1, size);
+
+	// estimates of a Count-Min sketch are upper bounds
+	CountMinSketch sketch(256, 4);
+	PTF_ASSERT_EQUAL(sketch.getWidth(), 256, size);
+	for (uint64_t key = 0; key < 1000; key++)
+		sketch.add(hashInteger(key), key % 10 + 1);
+	CountMinSketch otherSketch(256, 4);
+	otherSketch.add(hashInteger(5), 100);
+	PTF_ASSERT_TRUE(sketch.merge(otherSketch));
+	PTF_ASSERT_FALSE(sketch.merge(CountMinSketch(128, 4)));
+	PTF_ASSERT_TRUE(sketch.estimate(hashInteger(5)) >= 106);
+	for (uint64_t key = 0; key < 1000; key++)
+		PTF_ASSERT_TRUE(sketch.estimate(hashInteger(key)) >= key % 10 + 1);
+
+	// HyperLogLog estimates within a few percent, and merged sketches count each key once
+	HyperLogLog hll;
+	HyperLogLog otherHll;
+	PTF_ASSERT_EQUAL(hll.estimate(), 0, int);
+	for (uint64_t key = 0; key < 100; key++)
+		hll.add(hashInteger(key));
+	PTF_ASSERT_TRUE(hll.estimate() >= 98 && hll.estimate() <= 102);
+	for (uint64_t key = 0; key < 100000; key++)
+	{
+		if (key < 60000)
+			hll.add(hashInteger(key));
+		if (key >= 40000)
+			otherHll.add(hashInteger(key));
+	}
+	PTF_ASSERT_TRUE(hll.merge(otherHll));
+	PTF_ASSERT_FALSE(hll.merge(HyperLogLog(10)));
+	PTF_ASSERT_TRUE(hll.estimate() >= 95000 && hll.estimate() <= 105000);
+
+	// exact string counts merged from two "threads"
+	StringCounter hostnames;
+	StringCounter otherHostnames;
+	hostnames.add(std::string("a.com"), 5);
+	hostnames.add(std::string("b.com"));
+	hostnames.add("b.com", 5, 3);
+	otherHostnames.add(std::string("c.com"), 2);
+	otherHostnames.add("b.com:443", 5, 2);
+	hostnames.merge(otherHostnames);
+	PTF_ASSERT_FALSE(hostnames.isBounded());
+	PTF_ASSERT_EQUAL(hostnames.size(), 3, size);
+	PTF_ASSERT_EQUAL(hostnames.getNumOfDistinctStrings(), 3, int);
+	PTF_ASSERT_EQUAL(hostnames.getTotalCount(), 13, int);
+	PTF_ASSERT_EQUAL(hostnames.getCount("b.com"), 6, int);
+	PTF_ASSERT_EQUAL(hostnames.getCount("d.com"), 0, int);
+	std::vector<std::pair<std::string, uint64_t> > sortedHostnames;
+	hostnames.getSortedCounts(sortedHostnames);
+	PTF_ASSERT_EQUAL(sortedHostnames.size(), 3, size);
+	PTF_ASSERT_EQUAL(sortedHostnames[0].first, "b.com", string);
+	PTF_ASSERT_EQUAL(sortedHostnames[1].first, "a.com", string);
+	PTF_ASSERT_EQUAL(sortedHostnames[2].first, "c.com", string);
+	PTF_ASSERT_EQUAL((int)sortedHostnames[2].second, 2, int);
+
+	// a bounded counter keeps the most frequent strings among many rare ones
+	StringCounter topHostnames(10);
+	PTF_ASSERT_TRUE(topHostnames.isBounded());
+	for (int i = 0; i < 20000; i++)
+	{
+		std::stringstream name;
+		if (i % 4 == 0)
+			name << "popular" << (i / 4) % 5 << ".com";
+		else
+			name << "rare" << i << ".com";
+		topHostnames.add(name.str());
+	}
+	PTF_ASSERT_EQUAL(topHostnames.size(), 10, size);
+	PTF_ASSERT_EQUAL(topHostnames.getTotalCount(), 20000, int);
+	PTF_ASSERT_TRUE(topHostnames.getNumOfDistinctStrings() >= 14000 && topHostnames.getNumOfDistinctStrings() <= 16000);
+	topHostnames.getSortedCounts(sortedHostnames, 5);
+	PTF_ASSERT_EQUAL(sortedHostnames.size(), 5, size);
+	std::set<std::string> topNames;
+	for (size_t i = 0; i < sortedHostnames.size(); i++)
+	{
+		topNames.insert(sortedHostnames[i].first);
+		PTF_ASSERT_TRUE(sortedHostnames[i].second >= 1000);
+	}
+	for (int i = 0; i < 5; i++)
+	{
+		std::stringstream name;
+		name << "popular" << i << ".com";
+		PTF_ASSERT_TRUE(topNames.find(name.str()) != topNames.end());
+	}
+
+	topHostnames.clear();
+	PTF_ASSERT_EQUAL(topHostnames.size(), 0, size);
+	PTF_ASSERT_EQUAL(topHostnames.getNumOfDistinctStrings(), 0, int);
+} // HashCountersTest
+
+
+struct FlowTableTestRemoved
+{
+	std::vector<uint32_t> keys;
+	std::vector<int> values;
+	std::vector<FlowRemovalReason> reasons;
+};
+
+static void flowTableTestOnRemoved(const uint32_t& key, int& value, FlowRemovalReason reason, void* userCookie)
+{
+	FlowTableTestRemoved* removed = (FlowTableTestRemoved*)userCookie;
+	removed->keys.push_back(key);
+	removed->values.push_back(value);
+	removed->reasons.push_back(reason);
+}
+
+PTF_TEST_CASE(FlowTableTest)
+{
+	// random inserts, lookups and erasures give the same results as std::map, also while the table grows
+	FlowTable<uint32_t, int> table;
+	std::map<uint32_t, int> expected;
+	srand(7);
+	for (int i = 0; i < 50000; i++)
+	{
+		uint32_t key = (uint32_t)(rand() % 4096);
+		int op = rand() % 3;
+		if (op == 0)
+		{
+			bool isNew = false;
+			bool expectedIsNew = (expected.find(key) == expected.end());
+			table.get(key, &isNew) = i;
+			PTF_ASSERT_EQUAL(isNew, expectedIsNew, int);
+			expected[key] = i;
+		}
+		else if (op == 1)
+		{
+			bool expectedErased = (expected.erase(key) == 1);
+			PTF_ASSERT_EQUAL(table.erase(key), expectedErased, int);
+		}
+		else
+		{
+			int* value = table.find(key);
+			std::map<uint32_t, int>::iterator iter = expected.find(key);
+			PTF_ASSERT_TRUE((value == NULL) == (iter == expected.end()));
+			if (value != NULL)
+				PTF_ASSERT_EQUAL(*value, iter->second, int);
+		}
+	}
+	PTF_ASSERT_EQUAL(table.size(), expected.size(), size);
+	std::vector<std::pair<uint32_t, int> > entries;
+	table.getEntries(entries);
+	std::sort(entries.begin(), entries.end());
+	std::vector<std::pair<uint32_t, int> > expectedEntries(expected.begin(), expected.end());
+	PTF_ASSERT_TRUE(entries == expectedEntries);
+
+	// bulk lookups find the same flows as single lookups, including keys which aren't in the table
+	uint32_t bulkKeys[40];
+	int* bulkValues[40];
+	for (int i = 0; i < 40; i++)
+		bulkKeys[i] = (uint32_t)(i * 100);
+	table.findBulk(bulkKeys, 40, bulkValues);
+	for (int i = 0; i < 40; i++)
+	{
+		int* value = table.find(bulkKeys[i]);
+		PTF_ASSERT_TRUE(bulkValues[i] == value);
+	}
+
+	table.clear();
+	PTF_ASSERT_EQUAL(table.size(), 0, size);
+	PTF_ASSERT_TRUE(table.find(bulkKeys[0]) == NULL);
+	table.findBulk(bulkKeys, 40, bulkValues);
+	PTF_ASSERT_TRUE(bulkValues[0] == NULL && bulkValues[39] == NULL);
+
+	// flows not looked up for the idle timeout are removed when the time moves forward
+	FlowTableTestRemoved removed;
+	FlowTable<uint32_t, int> idleTable(FlowTableConfiguration(0, 10), flowTableTestOnRemoved, &removed);
+	idleTable.get(1) = 100;
+	idleTable.get(2) = 200;
+	idleTable.advanceTime(5);
+	idleTable.get(3) = 300;
+	PTF_ASSERT_TRUE(idleTable.find(1) != NULL);
+	idleTable.advanceTime(10);
+	PTF_ASSERT_EQUAL(idleTable.size(), 2, size);
+	PTF_ASSERT_EQUAL(removed.keys.size(), 1, size);
+	PTF_ASSERT_EQUAL(removed.keys[0], 2, u32);
+	PTF_ASSERT_EQUAL(removed.values[0], 200, int);
+	PTF_ASSERT_EQUAL(removed.reasons[0], FlowRemovedByIdleTimeout, enum);
+	PTF_ASSERT_TRUE(idleTable.peek(1) != NULL);
+	// peek() doesn't mark the flow as used
+	idleTable.advanceTime(14);
+	PTF_ASSERT_EQUAL(idleTable.size(), 2, size);
+	idleTable.advanceTime(15);
+	PTF_ASSERT_EQUAL(idleTable.size(), 0, size);
+	PTF_ASSERT_EQUAL(removed.keys.size(), 3, size);
+	PTF_ASSERT_EQUAL(idleTable.getNumOfTimeouts(), 3, u32);
+	PTF_ASSERT_EQUAL(idleTable.getCurrentTime(), 15, u32);
+
+	// a full table evicts the least recently used flow, and never the flow being inserted
+	removed = FlowTableTestRemoved();
+	FlowTable<uint32_t, int> lruTable(FlowTableConfiguration(3), flowTableTestOnRemoved, &removed);
+	lruTable[1] = 1;
+	lruTable[2] = 2;
+	lruTable[3] = 3;
+	PTF_ASSERT_TRUE(lruTable.find(1) != NULL);
+	lruTable[4] = 4;
+	PTF_ASSERT_EQUAL(lruTable.size(), 3, size);
+	PTF_ASSERT_TRUE(lruTable.peek(2) == NULL);
+	PTF_ASSERT_EQUAL(removed.keys.size(), 1, size);
+	PTF_ASSERT_EQUAL(removed.keys[0], 2, u32);
+	PTF_ASSERT_EQUAL(removed.reasons[0], FlowRemovedByEviction, enum);
+	PTF_ASSERT_EQUAL(lruTable.getNumOfEvictions(), 1, u32);
+
+	// with the oldest-first policy lookups don't change the order
+	FlowTable<uint32_t, int> fifoTable(FlowTableConfiguration(2, 0, EvictOldestFirst));
+	fifoTable[1] = 1;
+	fifoTable[2] = 2;
+	PTF_ASSERT_TRUE(fifoTable.find(1) != NULL);
+	fifoTable[3] = 3;
+	PTF_ASSERT_TRUE(fifoTable.peek(1) == NULL);
+	PTF_ASSERT_TRUE(fifoTable.peek(2) != NULL);
+
+	// flows are charged to a memory budget, and when it's exceeded the least recently used flows are evicted
+	size_t bytesPerFlow = FlowTable<uint32_t, int>::getBytesPerFlow();
+	MemoryBudget budget(bytesPerFlow * 5 / 2);
+	{
+		FlowTable<uint32_t, int> budgetTable(FlowTableConfiguration(0, 0, EvictLeastRecentlyUsed, &budget));
+		budgetTable[1] = 1;
+		budgetTable[2] = 2;
+		PTF_ASSERT_EQUAL(budget.getUsedBytes(), 2 * bytesPerFlow, size);
+		budgetTable[3] = 3;
+		PTF_ASSERT_EQUAL(budgetTable.size(), 2, size);
+		PTF_ASSERT_TRUE(budgetTable.peek(1) == NULL);
+		PTF_ASSERT_EQUAL(budget.getNumOfEvictions(), 1, u32);
+		budgetTable.erase(2);
+		PTF_ASSERT_EQUAL(budget.getUsedBytes(), bytesPerFlow, size);
+	}
+	PTF_ASSERT_EQUAL(budget.getUsedBytes(), 0, size);
+
+	// 5-tuple keys
+	FlowTable<FlowTuple, int> tupleTable;
+	FlowTuple tuple;
+	memset(&tuple, 0, sizeof(tuple));
+	tuple.ipVersion = 4;
+	tuple.protocol = PACKETPP_IPPROTO_TCP;
+	tuple.dstPort = 80;
+	for (int i = 0; i < 1000; i++)
+	{
+		tuple.srcPort = (uint16_t)(1024 + i);
+		tupleTable[tuple] = i;
+	}
+	PTF_ASSERT_EQUAL(tupleTable.size(), 1000, size);
+	tuple.srcPort = 1024 + 500;
+	PTF_ASSERT_TRUE(tupleTable.find(tuple) != NULL);
+	PTF_ASSERT_EQUAL(*tupleTable.find(tuple), 500, int);
+	tuple.ipVersion = 6;
+	PTF_ASSERT_TRUE(tupleTable.find(tuple) == NULL);
+
+	// each flow of a sharded table is kept in the shard its key maps to
+	ShardedFlowTable<uint32_t, int> shardedTable(4);
+	PTF_ASSERT_EQUAL(shardedTable.getNumOfShards(), 4, size);
+	int shardSizes[4] = { 0, 0, 0, 0 };
+	for (uint32_t key = 0; key < 1000; key++)
+	{
+		shardedTable.getShardOf(key)[key] = (int)key;
+		shardSizes[shardedTable.getShardIndex(key)]++;
+	}
+	PTF_ASSERT_EQUAL(shardedTable.size(), 1000, size);
+	for (int i = 0; i < 4; i++)
+	{
+		PTF_ASSERT_EQUAL(shardedTable.getShard(i).size(), (size_t)shardSizes[i], size);
+		PTF_ASSERT_TRUE(shardSizes[i] > 150);
+	}
+	PTF_ASSERT_TRUE(shardedTable.getShard(shardedTable.getShardIndex(123)).peek(123) != NULL);
+} // FlowTableTest
+
+
+// builds an Ethernet / IPv4 or IPv6 / TCP or UDP packet for FlowMeterTest, optionally with a VLAN tag
+static void flowMeterTestPacket(uint8_t* buffer, size_t& len, int ipVersion, const char* srcIP, const char* dstIP, uint16_t srcPort, uint16_t dstPort,
+		bool isTcp, uint8_t tcpFlags, uint16_t vlanId, size_t payloadLen)
+{
+	Packet packet(200);
+	uint16_t etherType = (ipVersion == 4 ? PCPP_ETHERTYPE_IP : PCPP_ETHERTYPE_IPV6);
+	EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"), vlanId != 0 ? PCPP_ETHERTYPE_VLAN : etherType);
+	VlanLayer vlanLayer(vlanId, false, 0, etherType);
+	IPv4Layer ip4Layer(IPv4Address(std::string(ipVersion == 4 ? srcIP : "0.0.0.0")), IPv4Address(std::string(ipVersion == 4 ? dstIP : "0.0.0.0")));
+	ip4Layer.getIPv4Header()->typeOfService = 0x28;
+	IPv6Layer ip6Layer(IPv6Address(std::string(ipVersion == 6 ? srcIP : "::")), IPv6Address(std::string(ipVersion == 6 ? dstIP : "::")));
+	TcpLayer tcpLayer(srcPort, dstPort);
+	((uint8_t*)tcpLayer.getTcpHeader())[13] = tcpFlags;
+	UdpLayer udpLayer(srcPort, dstPort);
+	uint8_t payload[100];
+	memset(payload, 0x55, sizeof(payload));
+	PayloadLayer payloadLayer(payload, payloadLen, false);
+
+	packet.addLayer(&ethLayer);
+	if (vlanId != 0)
+		packet.addLayer(&vlanLayer);
+	packet.addLayer(ipVersion == 4 ? (Layer*)&ip4Layer : (Layer*)&ip6Layer);
+	packet.addLayer(isTcp ? (Layer*)&tcpLayer : (Layer*)&udpLayer);
+	if (payloadLen > 0)
+		packet.addLayer(&payloadLayer);
+	packet.computeCalculateFields();
+
+	len = packet.getRawPacket()->getRawDataLen();
+	memcpy(buffer, packet.getRawPacket()->getRawData(), len);
+}
+
+static void flowMeterTestOnExported(const FlowRecord& record, void* userCookie)
+{
+	((std::vector<FlowRecord>*)userCookie)->push_back(record);
+}
+
+PTF_TEST_CASE(FlowMeterTest)
+{
+	uint8_t buffer[256];
+	size_t len;
+	std::vector<FlowRecord> records;
+
+	FlowMeterConfiguration config(10, 60, 0, true, false);
+	FlowMeter meter(config, flowMeterTestOnExported, &records);
+
+	// a UDP flow with a VLAN tag: 3 packets of 20 + 8 + 50 bytes
+	for (int i = 0; i < 3; i++)
+	{
+		flowMeterTestPacket(buffer, len, 4, "10.0.0.1", "10.0.0.2", 1000, 53, false, 0, 100, 50);
+		PTF_ASSERT_TRUE(meter.processPacket(buffer, len, LINKTYPE_ETHERNET, 1000000 + i * 1000));
+	}
+
+	// a TCP flow which ends with a FIN
+	const uint8_t tcpFlags[] = { 0x02, 0x10, 0x18, 0x11 };
+	for (int i = 0; i < 4; i++)
+	{
+		flowMeterTestPacket(buffer, len, 4, "10.0.0.3", "10.0.0.4", 40000, 80, true, tcpFlags[i], 0, i == 2 ? 10 : 0);
+		PTF_ASSERT_TRUE(meter.processPacket(buffer, len, LINKTYPE_ETHERNET, 1000500 + i * 100));
+	}
+
+	PTF_ASSERT_EQUAL(records.size(), 1, size);
+	PTF_ASSERT_EQUAL(records[0].endReason, FlowEndDetected, enum);
+	PTF_ASSERT_EQUAL((int)records[0].packets, 4, int);
+	PTF_ASSERT_EQUAL((int)records[0].bytes, 4 * 40 + 10, int);
+	PTF_ASSERT_EQUAL(records[0].tcpFlags, 0x1b, u8);
+	PTF_ASSERT_EQUAL(records[0].tuple.srcPort, 40000, u16);
+	PTF_ASSERT_EQUAL(records[0].tuple.protocol, PACKETPP_IPPROTO_TCP, u8);
+	PTF_ASSERT_EQUAL((int)records[0].firstSeen, 1000500, int);
+	PTF_ASSERT_EQUAL((int)records[0].lastSeen, 1000800, int);
+	PTF_ASSERT_EQUAL(meter.getNumOfFlows(), 1, size);
+
+	// a packet without an IP header isn't metered
+	uint8_t arpPacket[60];
+	memset(arpPacket, 0, sizeof(arpPacket));
+	arpPacket[12] = 0x08;
+	arpPacket[13] = 0x06;
+	PTF_ASSERT_FALSE(meter.processPacket(arpPacket, sizeof(arpPacket), LINKTYPE_ETHERNET, 1002000));
+
+	// the UDP flow times out 10 seconds after its last packet
+	meter.advanceTime(1011000);
+	PTF_ASSERT_EQUAL(records.size(), 1, size);
+	meter.advanceTime(1013000);
+	PTF_ASSERT_EQUAL(records.size(), 2, size);
+	PTF_ASSERT_EQUAL(records[1].endReason, FlowEndIdleTimeout, enum);
+	PTF_ASSERT_EQUAL((int)records[1].packets, 3, int);
+	PTF_ASSERT_EQUAL((int)records[1].bytes, 3 * 78, int);
+	PTF_ASSERT_EQUAL(records[1].vlanId, 100, u16);
+	PTF_ASSERT_EQUAL(records[1].tos, 0x28, u8);
+	PTF_ASSERT_EQUAL(records[1].tcpFlags, 0, u8);
+	PTF_ASSERT_EQUAL(records[1].tuple.dstPort, 53, u16);
+	PTF_ASSERT_EQUAL(records[1].tuple.srcIP[3], 1, u8);
+	PTF_ASSERT_EQUAL((int)records[1].firstSeen, 1000000, int);
+	PTF_ASSERT_EQUAL((int)records[1].lastSeen, 1002000, int);
+	PTF_ASSERT_EQUAL(meter.getNumOfFlows(), 0, size);
+
+	// a long-lived flow is exported every 60 seconds and goes on
+	for (int i = 0; i <= 13; i++)
+	{
+		flowMeterTestPacket(buffer, len, 6, "2001:db8::1", "2001:db8::2", 5000, 5001, false, 0, 0, 0);
+		PTF_ASSERT_TRUE(meter.processPacket(buffer, len, LINKTYPE_ETHERNET, 2000000 + i * 5000));
+	}
+	PTF_ASSERT_EQUAL(records.size(), 3, size);
+	PTF_ASSERT_EQUAL(records[2].endReason, FlowEndActiveTimeout, enum);
+	PTF_ASSERT_EQUAL((int)records[2].packets, 12, int);
+	PTF_ASSERT_EQUAL((int)records[2].bytes, 12 * 48, int);
+	PTF_ASSERT_EQUAL(records[2].tuple.ipVersion, 6, u8);
+	PTF_ASSERT_EQUAL((int)records[2].lastSeen, 2055000, int);
+
+	meter.flush();
+	PTF_ASSERT_EQUAL(records.size(), 4, size);
+	PTF_ASSERT_EQUAL(records[3].endReason, FlowEndForced, enum);
+	PTF_ASSERT_EQUAL((int)records[3].packets, 2, int);
+	PTF_ASSERT_EQUAL((int)records[3].firstSeen, 2060000, int);
+	PTF_ASSERT_EQUAL(meter.getNumOfFlows(), 0, size);
+
+	FlowMeterStats stats;
+	meter.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.packets, 3 + 4 + 1 + 14, int);
+	PTF_ASSERT_EQUAL((int)stats.nonIpPackets, 1, int);
+	PTF_ASSERT_EQUAL((int)stats.flowsCreated, 3, int);
+	PTF_ASSERT_EQUAL((int)stats.recordsExported, 4, int);
+
+	// when the table is full the least recently seen flow is evicted
+	records.clear();
+	FlowMeter smallMeter(FlowMeterConfiguration(10, 60, 2), flowMeterTestOnExported, &records);
+	for (int i = 0; i < 3; i++)
+	{
+		flowMeterTestPacket(buffer, len, 4, "10.0.0.1", "10.0.0.2", 1000 + i, 53, false, 0, 0, 0);
+		PTF_ASSERT_TRUE(smallMeter.processPacket(buffer, len, LINKTYPE_ETHERNET, 1000000));
+	}
+	PTF_ASSERT_EQUAL(records.size(), 1, size);
+	PTF_ASSERT_EQUAL(records[0].endReason, FlowEndLackOfResources, enum);
+	PTF_ASSERT_EQUAL(records[0].tuple.srcPort, 1000, u16);
+
+	// with tunnel decapsulation a VXLAN packet is metered by its inner headers and its VNI
+	records.clear();
+	FlowMeter tunnelMeter(FlowMeterConfiguration(10, 60, 0, true, true), flowMeterTestOnExported, &records);
+	size_t innerLen;
+	uint8_t inner[256];
+	flowMeterTestPacket(inner, innerLen, 4, "192.168.0.1", "192.168.0.2", 7000, 7001, false, 0, 0, 20);
+	Packet vxlanPacket(300);
+	EthLayer outerEth(MacAddress("aa:bb:cc:dd:ee:03"), MacAddress("aa:bb:cc:dd:ee:04"), PCPP_ETHERTYPE_IP);
+	IPv4Layer outerIp(IPv4Address(std::string("172.16.0.1")), IPv4Address(std::string("172.16.0.2")));
+	UdpLayer outerUdp(12345, 4789);
+	VxlanLayer vxlanLayer(1234);
+	PayloadLayer innerPayload(inner, innerLen, false);
+	vxlanPacket.addLayer(&outerEth);
+	vxlanPacket.addLayer(&outerIp);
+	vxlanPacket.addLayer(&outerUdp);
+	vxlanPacket.addLayer(&vxlanLayer);
+	vxlanPacket.addLayer(&innerPayload);
+	vxlanPacket.computeCalculateFields();
+	PTF_ASSERT_TRUE(tunnelMeter.processPacket(vxlanPacket.getRawPacket()->getRawData(), vxlanPacket.getRawPacket()->getRawDataLen(), LINKTYPE_ETHERNET, 1000000));
+	tunnelMeter.flush();
+	PTF_ASSERT_EQUAL(records.size(), 1, size);
+	PTF_ASSERT_EQUAL(records[0].tunnelId, 1234, u32);
+	PTF_ASSERT_EQUAL(records[0].tuple.srcPort, 7000, u16);
+	PTF_ASSERT_EQUAL((int)records[0].bytes, 20 + 8 + 20, int);
+} // FlowMeterTest
+
+
+static void flowExporterTestOnPacket(RawPacket& packet, void* userCookie)
+{
+	std::vector<std::vector<uint8_t> >* packets = (std::vector<std::vector<uint8_t> >*)userCookie;
+	packets->push_back(std::vector<uint8_t>(packet.getRawData(), packet.getRawData() + packet.getRawDataLen()));
+}
+
+static uint16_t flowExporterTestRead16(const uint8_t* data)
+{
+	return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+static uint32_t flowExporterTestRead32(const uint8_t* data)
+{
+	return ((uint32_t)flowExporterTestRead16(data) << 16) | flowExporterTestRead16(data + 2);
+}
+
+PTF_TEST_CASE(FlowExporterTest)
+{
+	FlowRecord record;
+	memset(&record, 0, sizeof(record));
+	record.tuple.ipVersion = 4;
+	record.tuple.protocol = PACKETPP_IPPROTO_TCP;
+	record.tuple.srcIP[0] = 10;
+	record.tuple.srcIP[3] = 1;
+	record.tuple.dstIP[0] = 10;
+	record.tuple.dstIP[3] = 2;
+	record.tuple.srcPort = 40000;
+	record.tuple.dstPort = 443;
+	record.vlanId = 100;
+	record.mplsLabel = 0x12345;
+	record.tunnelId = 7;
+	record.tos = 0x28;
+	record.tcpFlags = 0x1b;
+	record.endReason = FlowEndDetected;
+	record.packets = 10;
+	record.bytes = 5000;
+	record.firstSeen = 1600000000000ULL;
+	record.lastSeen = 1600000001500ULL;
+
+	FlowExporterConfiguration config(FlowExportIPFIX, MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"),
+			IPv4Address(std::string("192.168.1.1")), IPv4Address(std::string("192.168.1.2")), 4739, 42);
+	config.maxMessageLength = 512;
+	std::vector<std::vector<uint8_t> > packets;
+	FlowExporter exporter(config, flowExporterTestOnPacket, &packets);
+
+	// an IPFIX record is 57 bytes, so a 512 byte message has room for the header (16), the templates (132), a set header and 6 records
+	for (int i = 0; i < 8; i++)
+	{
+		record.packets = 10 + i;
+		exporter.exportRecord(record);
+	}
+	PTF_ASSERT_EQUAL(packets.size(), 1, size);
+	exporter.flush();
+	PTF_ASSERT_EQUAL(packets.size(), 2, size);
+	exporter.flush();
+	PTF_ASSERT_EQUAL(packets.size(), 2, size);
+
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		// the headers and checksums are the same the layers compute
+		timeval time = { 0, 0 };
+		RawPacket rawPacket(&packets[i][0], (int)packets[i].size(), time, false);
+		Packet packet(&rawPacket);
+		PTF_ASSERT_TRUE(packet.isPacketOfType(UDP));
+		UdpLayer* udpLayer = packet.getLayerOfType<UdpLayer>();
+		IPv4Layer* ipLayer = packet.getLayerOfType<IPv4Layer>();
+		PTF_ASSERT_EQUAL(udpLayer->getUdpHeader()->portDst, htons(4739), u16);
+		PTF_ASSERT_EQUAL(ipLayer->getDstIpAddress().toString(), "192.168.1.2", string);
+		uint16_t udpChecksum = udpLayer->getUdpHeader()->headerChecksum;
+		uint16_t ipChecksum = ipLayer->getIPv4Header()->headerChecksum;
+		uint16_t ipLength = ipLayer->getIPv4Header()->totalLength;
+		packet.computeCalculateFields();
+		PTF_ASSERT_EQUAL(udpLayer->getUdpHeader()->headerChecksum, udpChecksum, u16);
+		PTF_ASSERT_EQUAL(ipLayer->getIPv4Header()->headerChecksum, ipChecksum, u16);
+		PTF_ASSERT_EQUAL(ipLayer->getIPv4Header()->totalLength, ipLength, u16);
+
+		const uint8_t* message = &packets[i][FlowExporter::HeadersLength];
+		size_t messageLen = packets[i].size() - FlowExporter::HeadersLength;
+		PTF_ASSERT_EQUAL(flowExporterTestRead16(message), 10, u16);
+		PTF_ASSERT_EQUAL(flowExporterTestRead16(message + 2), messageLen, u16);
+		PTF_ASSERT_EQUAL(flowExporterTestRead32(message + 4), 1600000001, u32);
+		PTF_ASSERT_EQUAL(flowExporterTestRead32(message + 8), (i == 0 ? 0 : 6), u32);
+		PTF_ASSERT_EQUAL(flowExporterTestRead32(message + 12), 42, u32);
+	}
+
+	// the first message has the template set and a data set of 6 records, the second only a data set of 2 records
+	const uint8_t* message = &packets[0][FlowExporter::HeadersLength];
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(message + 16), 2, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(message + 18), 132, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(message + 20), 256, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(message + 22), 15, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(message + 24), 8, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(message + 26), 4, u16);
+	const uint8_t* dataSet = message + 16 + 132;
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(dataSet), 256, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(dataSet + 2), 4 + 6 * 57 + 2, u16);
+	const uint8_t* data = dataSet + 4;
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(data), 0x0a000001, u32);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(data + 4), 0x0a000002, u32);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(data + 8), 40000, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(data + 10), 443, u16);
+	PTF_ASSERT_EQUAL(data[12], PACKETPP_IPPROTO_TCP, u8);
+	PTF_ASSERT_EQUAL(data[13], 0x28, u8);
+	PTF_ASSERT_EQUAL(data[14], 0x1b, u8);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(data + 15), 100, u16);
+	int mplsLabel = (data[17] << 12) | (data[18] << 4) | (data[19] >> 4);
+	PTF_ASSERT_EQUAL(mplsLabel, 0x12345, int);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(data + 20), 7, u32);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(data + 28), 10, u32);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(data + 36), 5000, u32);
+	uint32_t flowStartLow = (uint32_t)1600000000000ULL;
+	uint32_t flowEndLow = (uint32_t)1600000001500ULL;
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(data + 44), flowStartLow, u32);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(data + 52), flowEndLow, u32);
+	PTF_ASSERT_EQUAL(data[56], FlowEndDetected, u8);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(data + 57 + 28), 11, u32);
+
+	const uint8_t* secondMessage = &packets[1][FlowExporter::HeadersLength];
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(secondMessage + 16), 256, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(secondMessage + 18), 4 + 2 * 57 + 2, u16);
+
+	FlowExporterStats stats;
+	exporter.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.packets, 2, int);
+	PTF_ASSERT_EQUAL((int)stats.records, 8, int);
+	PTF_ASSERT_EQUAL((int)stats.templates, 1, int);
+
+	// NetFlow v9 with an IPv6 record, exported through a FlowMeter. The times are relative to the system init time
+	packets.clear();
+	FlowExporterConfiguration v9Config(FlowExportNetFlowV9, MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"),
+			IPv4Address(std::string("192.168.1.1")), IPv4Address(std::string("192.168.1.2")), 2055, 3);
+	v9Config.systemInitTime = 1600000000000ULL - 5000;
+	FlowExporter v9Exporter(v9Config, flowExporterTestOnPacket, &packets);
+	FlowMeter meter(FlowMeterConfiguration(), FlowExporter::onFlowExported, &v9Exporter);
+	uint8_t buffer[256];
+	size_t len;
+	flowMeterTestPacket(buffer, len, 6, "2001:db8::1", "2001:db8::2", 5000, 53, false, 0, 0, 12);
+	PTF_ASSERT_TRUE(meter.processPacket(buffer, len, LINKTYPE_ETHERNET, 1600000000000ULL));
+	PTF_ASSERT_TRUE(meter.processPacket(buffer, len, LINKTYPE_ETHERNET, 1600000000250ULL));
+	meter.flush();
+	v9Exporter.flush();
+	PTF_ASSERT_EQUAL(packets.size(), 1, size);
+
+	message = &packets[0][FlowExporter::HeadersLength];
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(message), 9, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(message + 2), 3, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(message + 4), 5250, u32);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(message + 12), 0, u32);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(message + 16), 3, u32);
+	// the template set has id 0, and the IPv6 template has FIRST_SWITCHED and LAST_SWITCHED of 4 bytes
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(message + 20), 0, u16);
+	size_t templateSetLen = flowExporterTestRead16(message + 22);
+	PTF_ASSERT_EQUAL(templateSetLen, 132, size);
+	const uint8_t* v6Template = message + 24 + 64;
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(v6Template), 257, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(v6Template + 4 + 12 * 4), 22, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(v6Template + 4 + 12 * 4 + 2), 4, u16);
+	dataSet = message + 20 + templateSetLen;
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(dataSet), 257, u16);
+	// IPv6 record: 16 + 16 + 2 + 2 + 1 + 1 + 1 + 2 + 3 + 4 + 8 + 8 + 4 + 4 + 1 = 73 bytes, padded to 76 with the set header
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(dataSet + 2), 4 + 73 + 3, u16);
+	data = dataSet + 4;
+	PTF_ASSERT_EQUAL(data[0], 0x20, u8);
+	PTF_ASSERT_EQUAL(data[31], 0x02, u8);
+	PTF_ASSERT_EQUAL(flowExporterTestRead16(data + 34), 53, u16);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(data + 52), 2, u32);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(data + 60), 2 * (40 + 8 + 12), u32);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(data + 64), 5000, u32);
+	PTF_ASSERT_EQUAL(flowExporterTestRead32(data + 68), 5250, u32);
+	PTF_ASSERT_EQUAL(data[72], FlowEndForced, u8);
+} // FlowExporterTest
+
+
+// parse a stamped packet, compute all its fields and check nothing changed, which means the lengths and checksums the template patched
+// are the ones Packet would compute
+static bool packetTemplateTestIsConsistent(const uint8_t* data, size_t dataLen)
+{
+	uint8_t* copy = new uint8_t[dataLen];
+	memcpy(copy, data, dataLen);
+	timeval time;
+	gettimeofday(&time, NULL);
+	RawPacket rawPacket(copy, (int)dataLen, time, true);
+	Packet packet(&rawPacket);
+	packet.computeCalculateFields();
+	return memcmp(rawPacket.getRawData(), data, dataLen) == 0;
+}
+
+PTF_TEST_CASE(PacketTemplateTest)
+{
+	uint8_t payload[101];
+	for (size_t i = 0; i < sizeof(payload); i++)
+		payload[i] = (uint8_t)(i * 7 + 3);
+
+	// Ethernet / IPv4 / UDP with an odd payload length
+	EthLayer udpEth(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"));
+	IPv4Layer udpIp(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	udpIp.getIPv4Header()->timeToLive = 64;
+	UdpLayer udpLayer(1000, 2000);
+	PayloadLayer udpPayload(payload, sizeof(payload), false);
+	Packet udpPacket(100);
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&udpEth));
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&udpIp));
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&udpLayer));
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&udpPayload));
+
+	PacketTemplate udpTemplate(udpPacket);
+	PTF_ASSERT_EQUAL(udpTemplate.getLength(), 14 + 20 + 8 + sizeof(payload), size);
+	PTF_ASSERT_EQUAL(udpTemplate.getPayloadOffset(), 42, u16);
+	PTF_ASSERT_EQUAL(udpTemplate.getMaxPayloadLength(), sizeof(payload), size);
+	PTF_ASSERT_TRUE(udpTemplate.getView().isPacketOfType(UDP));
+
+	uint8_t buffer[256];
+	PTF_ASSERT_EQUAL(udpTemplate.stamp(buffer, 100), 0, size);
+	PTF_ASSERT_EQUAL(udpTemplate.stamp(buffer, sizeof(buffer)), udpTemplate.getLength(), size);
+	PTF_ASSERT_BUF_COMPARE(buffer, udpTemplate.getData(), udpTemplate.getLength());
+	PTF_ASSERT_EQUAL(udpTemplate.stamp(buffer, sizeof(buffer), sizeof(payload) + 1), 0, size);
+
+	// all payload lengths, shorter ones with patched fields
+	for (size_t payloadLen = 0; payloadLen <= sizeof(payload); payloadLen++)
+	{
+		size_t len = udpTemplate.stamp(buffer, sizeof(buffer), payloadLen);
+		PTF_ASSERT_EQUAL(len, 42 + payloadLen, size);
+		PTF_ASSERT_TRUE(packetTemplateTestIsConsistent(buffer, len));
+
+		PTF_ASSERT_TRUE(udpTemplate.setSrcIPv4Address(buffer, IPv4Address((uint32_t)(0x0100000a + payloadLen * 0x10000))));
+		PTF_ASSERT_TRUE(udpTemplate.setDstPort(buffer, (uint16_t)(53 + payloadLen * 311)));
+		PTF_ASSERT_TRUE(udpTemplate.setIPv4Id(buffer, (uint16_t)(payloadLen * 1009)));
+		if (payloadLen > 2)
+		{
+			uint8_t data[3] = { 0xde, 0xad, (uint8_t)payloadLen };
+			PTF_ASSERT_TRUE(udpTemplate.setPayload(buffer, len, payloadLen - 3, data, sizeof(data)));
+			LoggerPP::getInstance().supressErrors();
+			PTF_ASSERT_FALSE(udpTemplate.setPayload(buffer, len, payloadLen - 2, data, sizeof(data)));
+			LoggerPP::getInstance().enableErrors();
+		}
+		PTF_ASSERT_TRUE(packetTemplateTestIsConsistent(buffer, len));
+	}
+
+	size_t len = udpTemplate.stamp(buffer, sizeof(buffer), 10);
+	PTF_ASSERT_FALSE(udpTemplate.setSrcIPv6Address(buffer, IPv6Address(std::string("2001:db8::1"))));
+	PTF_ASSERT_FALSE(udpTemplate.setTcpSequenceNumber(buffer, 1));
+	Packet udpStamped(new RawPacket(buffer, (int)len, udpPacket.getRawPacket()->getPacketTimeStamp(), false), true);
+	PTF_ASSERT_EQUAL(udpStamped.getLayerOfType<UdpLayer>()->getUdpHeader()->length, htons(18), u16);
+	PTF_ASSERT_EQUAL(udpStamped.getLayerOfType<IPv4Layer>()->getIPv4Header()->totalLength, htons(38), u16);
+
+	// Ethernet / VLAN / IPv6 / TCP, stamped into a raw packet which grows and shrinks
+	EthLayer tcpEth(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"));
+	VlanLayer tcpVlan(100, false, 0, PCPP_ETHERTYPE_IPV6);
+	IPv6Layer tcpIp(IPv6Address(std::string("2001:db8::1")), IPv6Address(std::string("2001:db8::2")));
+	tcpIp.getIPv6Header()->hopLimit = 64;
+	TcpLayer tcpLayer(40000, 443);
+	tcpLayer.getTcpHeader()->ackFlag = 1;
+	tcpLayer.getTcpHeader()->windowSize = htons(1024);
+	PayloadLayer tcpPayload(payload, 64, false);
+	Packet tcpPacket(200);
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&tcpEth));
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&tcpVlan));
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&tcpIp));
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&tcpLayer));
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&tcpPayload));
+
+	PacketTemplate tcpTemplate(tcpPacket);
+	PTF_ASSERT_EQUAL(tcpTemplate.getPayloadOffset(), 18 + 40 + 20, u16);
+	PTF_ASSERT_EQUAL(tcpTemplate.getMaxPayloadLength(), 64, size);
+
+	timeval time;
+	gettimeofday(&time, NULL);
+	uint8_t* initialData = new uint8_t[10];
+	memset(initialData, 0, 10);
+	RawPacket rawPacket(initialData, 10, time, true);
+	PTF_ASSERT_TRUE(tcpTemplate.stamp(rawPacket));
+	PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), (int)tcpTemplate.getLength(), int);
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), tcpTemplate.getData(), tcpTemplate.getLength());
+
+	PTF_ASSERT_TRUE(tcpTemplate.stamp(rawPacket, 15));
+	PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), 78 + 15, int);
+	uint8_t* stamped = (uint8_t*)rawPacket.getRawData();
+	PTF_ASSERT_TRUE(tcpTemplate.setSrcIPv6Address(stamped, IPv6Address(std::string("fe80::1234:5678"))));
+	PTF_ASSERT_TRUE(tcpTemplate.setDstIPv6Address(stamped, IPv6Address(std::string("2001:db8::ffff"))));
+	PTF_ASSERT_TRUE(tcpTemplate.setSrcPort(stamped, 12345));
+	PTF_ASSERT_TRUE(tcpTemplate.setTcpSequenceNumber(stamped, 0xdeadbeef));
+	PTF_ASSERT_TRUE(tcpTemplate.setTcpAckNumber(stamped, 0x01020304));
+	PTF_ASSERT_FALSE(tcpTemplate.setSrcIPv4Address(stamped, IPv4Address(std::string("1.1.1.1"))));
+	PTF_ASSERT_FALSE(tcpTemplate.setIPv4Id(stamped, 1));
+	PTF_ASSERT_TRUE(packetTemplateTestIsConsistent(stamped, 78 + 15));
+
+	Packet tcpStamped(&rawPacket);
+	TcpLayer* stampedTcp = tcpStamped.getLayerOfType<TcpLayer>();
+	PTF_ASSERT_NOT_NULL(stampedTcp);
+	PTF_ASSERT_EQUAL(ntohl(stampedTcp->getTcpHeader()->sequenceNumber), 0xdeadbeef, u32);
+	PTF_ASSERT_EQUAL(stampedTcp->getSrcPort(), 12345, u16);
+	PTF_ASSERT_EQUAL(tcpStamped.getLayerOfType<IPv6Layer>()->getSrcIpAddress().toString(), "fe80::1234:5678", string);
+	PTF_ASSERT_EQUAL(tcpStamped.getLayerOfType<VlanLayer>()->getVlanID(), 100, u16);
+
+	PTF_ASSERT_TRUE(tcpTemplate.stamp(rawPacket, 64));
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), tcpTemplate.getData(), tcpTemplate.getLength());
+
+	// ICMP echo request: the checksum has no pseudo header and the payload follows the first 8 bytes
+	EthLayer icmpEth(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"));
+	IPv4Layer icmpIp(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	icmpIp.getIPv4Header()->timeToLive = 64;
+	IcmpLayer icmpLayer;
+	PTF_ASSERT_NOT_NULL(icmpLayer.setEchoRequestData(7, 1, 0x0102030405060708ULL, payload, 32));
+	Packet icmpPacket(100);
+	PTF_ASSERT_TRUE(icmpPacket.addLayer(&icmpEth));
+	PTF_ASSERT_TRUE(icmpPacket.addLayer(&icmpIp));
+	PTF_ASSERT_TRUE(icmpPacket.addLayer(&icmpLayer));
+
+	PacketTemplate icmpTemplate(icmpPacket);
+	PTF_ASSERT_EQUAL(icmpTemplate.getPayloadOffset(), 42, u16);
+	PTF_ASSERT_EQUAL(icmpTemplate.getMaxPayloadLength(), 8 + 32, size);
+	PTF_ASSERT_FALSE(icmpTemplate.setSrcPort(buffer, 1));
+	for (size_t payloadLen = 8; payloadLen <= 40; payloadLen += 5)
+	{
+		len = icmpTemplate.stamp(buffer, sizeof(buffer), payloadLen);
+		PTF_ASSERT_EQUAL(len, 42 + payloadLen, size);
+		PTF_ASSERT_TRUE(icmpTemplate.setDstIPv4Address(buffer, IPv4Address(std::string("192.168.0.77"))));
+		uint8_t data[2] = { 0x55, (uint8_t)payloadLen };
+		PTF_ASSERT_TRUE(icmpTemplate.setPayload(buffer, len, 1, data, sizeof(data)));
+		PTF_ASSERT_TRUE(packetTemplateTestIsConsistent(buffer, len));
+	}
+
+	// a template which isn't an IP packet can only be stamped
+	uint8_t arpData[42];
+	memset(arpData, 0, sizeof(arpData));
+	arpData[12] = 0x08;
+	arpData[13] = 0x06;
+	PacketTemplate arpTemplate(arpData, sizeof(arpData));
+	PTF_ASSERT_EQUAL(arpTemplate.getPayloadOffset(), PacketView::NoOffset, u16);
+	PTF_ASSERT_EQUAL(arpTemplate.stamp(buffer, sizeof(buffer)), sizeof(arpData), size);
+	PTF_ASSERT_EQUAL(arpTemplate.stamp(buffer, sizeof(buffer), 0), 0, size);
+	PTF_ASSERT_FALSE(arpTemplate.setDstPort(buffer, 1));
+} // PacketTemplateTest
+
+
+PTF_TEST_CASE(PacketSegmenterTest)
+{
+	uint8_t payload[5000];
+	for (size_t i = 0; i < sizeof(payload); i++)
+		payload[i] = (uint8_t)(i * 13 + 5);
+
+	// Ethernet / IPv4 / TCP with FIN, PSH and CWR, split into 3 full segments and a shorter one
+	EthLayer tcpEth(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"));
+	IPv4Layer tcpIp(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	tcpIp.getIPv4Header()->timeToLive = 64;
+	tcpIp.getIPv4Header()->ipId = htons(0xfffe);
+	TcpLayer tcpLayer(40000, 80);
+	tcpLayer.getTcpHeader()->sequenceNumber = htonl(0xfffff000);
+	tcpLayer.getTcpHeader()->ackFlag = 1;
+	tcpLayer.getTcpHeader()->pshFlag = 1;
+	tcpLayer.getTcpHeader()->finFlag = 1;
+	tcpLayer.getTcpHeader()->cwrFlag = 1;
+	PayloadLayer tcpPayload(payload, sizeof(payload), false);
+	Packet tcpPacket(6000);
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&tcpEth));
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&tcpIp));
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&tcpLayer));
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&tcpPayload));
+
+	PacketSegmenter tcpSegmenter(tcpPacket, 1460);
+	PTF_ASSERT_TRUE(tcpSegmenter.isValid());
+	PTF_ASSERT_TRUE(tcpSegmenter.isTcp());
+	PTF_ASSERT_EQUAL(tcpSegmenter.getHeaderLength(), 54, size);
+	PTF_ASSERT_EQUAL(tcpSegmenter.getPayloadLength(), sizeof(payload), size);
+	PTF_ASSERT_EQUAL(tcpSegmenter.getNumOfSegments(), 4, size);
+	PTF_ASSERT_EQUAL(tcpSegmenter.getSegmentLength(0), 54 + 1460, size);
+	PTF_ASSERT_EQUAL(tcpSegmenter.getSegmentLength(3), 54 + 620, size);
+	PTF_ASSERT_EQUAL(tcpSegmenter.getSegmentLength(4), 0, size);
+
+	uint8_t buffer[2000];
+	PTF_ASSERT_EQUAL(tcpSegmenter.writeSegment(0, buffer, 1000), 0, size);
+	PTF_ASSERT_EQUAL(tcpSegmenter.writeSegment(4, buffer, sizeof(buffer)), 0, size);
+	for (size_t i = 0; i < tcpSegmenter.getNumOfSegments(); i++)
+	{
+		size_t len = tcpSegmenter.writeSegment(i, buffer, sizeof(buffer));
+		PTF_ASSERT_EQUAL(len, tcpSegmenter.getSegmentLength(i), size);
+		PTF_ASSERT_TRUE(packetTemplateTestIsConsistent(buffer, len));
+		PTF_ASSERT_BUF_COMPARE(buffer + 54, payload + i * 1460, len - 54);
+
+		tcphdr* tcpHeader = (tcphdr*)(buffer + 34);
+		iphdr* ipHeader = (iphdr*)(buffer + 14);
+		PTF_ASSERT_EQUAL(ntohl(tcpHeader->sequenceNumber), (uint32_t)(0xfffff000 + i * 1460), u32);
+		PTF_ASSERT_EQUAL(ntohs(ipHeader->ipId), (uint16_t)(0xfffe + i), u16);
+		PTF_ASSERT_EQUAL(ntohs(ipHeader->totalLength), (uint16_t)(len - 14), u16);
+		PTF_ASSERT_EQUAL(tcpHeader->ackFlag, 1, u8);
+		PTF_ASSERT_EQUAL(tcpHeader->finFlag, (i == 3 ? 1 : 0), u8);
+		PTF_ASSERT_EQUAL(tcpHeader->pshFlag, (i == 3 ? 1 : 0), u8);
+		PTF_ASSERT_EQUAL(tcpHeader->cwrFlag, (i == 0 ? 1 : 0), u8);
+	}
+
+	// new raw packets, and existing raw packets which grow or shrink
+	PointerVector<RawPacket> tcpSegments;
+	PTF_ASSERT_EQUAL(tcpSegmenter.writeSegments(tcpSegments), 4, size);
+	PTF_ASSERT_EQUAL(tcpSegments.size(), 4, size);
+	RawPacket existing[2] = { *tcpSegments.at(3), *tcpSegments.at(0) };
+	RawPacket* existingPtrs[2] = { &existing[0], &existing[1] };
+	PTF_ASSERT_EQUAL(tcpSegmenter.writeSegments(existingPtrs, 2), 2, size);
+	for (int i = 0; i < 2; i++)
+	{
+		PTF_ASSERT_EQUAL(existing[i].getRawDataLen(), tcpSegments.at(i)->getRawDataLen(), int);
+		PTF_ASSERT_BUF_COMPARE(existing[i].getRawData(), tcpSegments.at(i)->getRawData(), existing[i].getRawDataLen());
+	}
+
+	// Ethernet / IPv6 / UDP with an odd segment size, so segments start at odd payload offsets
+	EthLayer udpEth(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"));
+	IPv6Layer udpIp(IPv6Address(std::string("2001:db8::1")), IPv6Address(std::string("2001:db8::2")));
+	udpIp.getIPv6Header()->hopLimit = 64;
+	UdpLayer udpLayer(1000, 443);
+	PayloadLayer udpPayload(payload, 1001, false);
+	Packet udpPacket(1200);
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&udpEth));
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&udpIp));
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&udpLayer));
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&udpPayload));
+
+	PacketSegmenter udpSegmenter(udpPacket, 333);
+	PTF_ASSERT_FALSE(udpSegmenter.isTcp());
+	PTF_ASSERT_EQUAL(udpSegmenter.getNumOfSegments(), 4, size);
+	for (size_t i = 0; i < udpSegmenter.getNumOfSegments(); i++)
+	{
+		size_t len = udpSegmenter.writeSegment(i, buffer, sizeof(buffer));
+		PTF_ASSERT_EQUAL(len, 62 + (i < 3 ? 333 : 2), size);
+		PTF_ASSERT_TRUE(packetTemplateTestIsConsistent(buffer, len));
+		PTF_ASSERT_EQUAL(ntohs(((udphdr*)(buffer + 54))->length), (uint16_t)(len - 54), u16);
+	}
+
+	// a UDP checksum of 0 over IPv4 stays 0, and a payload not larger than the segment size is a single segment
+	EthLayer zeroEth(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"));
+	IPv4Layer zeroIp(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	UdpLayer zeroUdp(1000, 2000);
+	PayloadLayer zeroPayload(payload, 100, false);
+	Packet zeroPacket(200);
+	PTF_ASSERT_TRUE(zeroPacket.addLayer(&zeroEth));
+	PTF_ASSERT_TRUE(zeroPacket.addLayer(&zeroIp));
+	PTF_ASSERT_TRUE(zeroPacket.addLayer(&zeroUdp));
+	PTF_ASSERT_TRUE(zeroPacket.addLayer(&zeroPayload));
+	zeroPacket.computeCalculateFields();
+	zeroUdp.getUdpHeader()->headerChecksum = 0;
+	PacketSegmenter zeroSegmenter(*zeroPacket.getRawPacket(), 60);
+	PTF_ASSERT_EQUAL(zeroSegmenter.getNumOfSegments(), 2, size);
+	PTF_ASSERT_EQUAL(zeroSegmenter.writeSegment(1, buffer, sizeof(buffer)), 42 + 40, size);
+	PTF_ASSERT_EQUAL(((udphdr*)(buffer + 34))->headerChecksum, 0, u16);
+	PacketSegmenter singleSegmenter(*zeroPacket.getRawPacket(), 100);
+	PTF_ASSERT_EQUAL(singleSegmenter.getNumOfSegments(), 1, size);
+	PTF_ASSERT_EQUAL(singleSegmenter.writeSegment(0, buffer, sizeof(buffer)), 142, size);
+
+	// packets which can't be segmented
+	LoggerPP::getInstance().supressErrors();
+	PacketSegmenter zeroSizeSegmenter(tcpPacket, 0);
+	PTF_ASSERT_FALSE(zeroSizeSegmenter.isValid());
+	PTF_ASSERT_EQUAL(zeroSizeSegmenter.getNumOfSegments(), 0, size);
+	EthLayer arpEth(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("ff:ff:ff:ff:ff:ff"), PCPP_ETHERTYPE_ARP);
+	ArpLayer arpLayer(ARP_REQUEST, MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("00:00:00:00:00:00"), IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	Packet arpPacket(100);
+	PTF_ASSERT_TRUE(arpPacket.addLayer(&arpEth));
+	PTF_ASSERT_TRUE(arpPacket.addLayer(&arpLayer));
+	PacketSegmenter arpSegmenter(arpPacket, 1000);
+	PTF_ASSERT_FALSE(arpSegmenter.isValid());
+	PTF_ASSERT_FALSE(arpSegmenter.writeSegment(0, *tcpSegments.at(0)));
+	LoggerPP::getInstance().enableErrors();
+} // PacketSegmenterTest
+
+
+PTF_TEST_CASE(PacketDeduplicatorTest)
+{
+	uint8_t packetA[256], packetB[256], packetC[256];
+	size_t lenA, lenB, lenC;
+
+	// the same UDP packet as captured before and after a router: different MAC addresses and VLAN tag, lower TTL and another checksum
+	flowMeterTestPacket(packetA, lenA, 4, "10.0.0.1", "10.0.0.2", 1000, 53, false, 0, 100, 50);
+	flowMeterTestPacket(packetB, lenB, 4, "10.0.0.1", "10.0.0.2", 1000, 53, false, 0, 0, 50);
+	packetB[0] = 0x02;
+	packetB[14 + 8]--;
+	packetB[14 + 10] ^= 0xff;
+	flowMeterTestPacket(packetC, lenC, 4, "10.0.0.1", "10.0.0.2", 1000, 53, false, 0, 0, 50);
+	packetC[lenC - 1] = 0x66;
+
+	bool isIP = false;
+	PTF_ASSERT_TRUE(PacketDeduplicator::hashPacket(packetA, lenA, LINKTYPE_ETHERNET, 64, &isIP) ==
+			PacketDeduplicator::hashPacket(packetB, lenB, LINKTYPE_ETHERNET, 64));
+	PTF_ASSERT_TRUE(isIP);
+	PTF_ASSERT_TRUE(PacketDeduplicator::hashPacket(packetA, lenA, LINKTYPE_ETHERNET, 64) !=
+			PacketDeduplicator::hashPacket(packetC, lenC, LINKTYPE_ETHERNET, 64));
+	// a difference beyond the payload prefix isn't part of the identity
+	PTF_ASSERT_TRUE(PacketDeduplicator::hashPacket(packetA, lenA, LINKTYPE_ETHERNET, 20) ==
+			PacketDeduplicator::hashPacket(packetC, lenC, LINKTYPE_ETHERNET, 20));
+
+	PacketDeduplicator dedup(PacketDeduplicatorConfiguration(100));
+	PTF_ASSERT_FALSE(dedup.isDuplicate(packetA, lenA, LINKTYPE_ETHERNET, 1000));
+	PTF_ASSERT_TRUE(dedup.isDuplicate(packetB, lenB, LINKTYPE_ETHERNET, 1010));
+	PTF_ASSERT_FALSE(dedup.isDuplicate(packetC, lenC, LINKTYPE_ETHERNET, 1020));
+	// a copy processed a little out of timestamp order is still a duplicate
+	PTF_ASSERT_TRUE(dedup.isDuplicate(packetC, lenC, LINKTYPE_ETHERNET, 1005));
+	PTF_ASSERT_EQUAL(dedup.getNumOfEntries(), 2, size);
+
+	// padding and trailers after the IP packet aren't part of the identity
+	uint8_t paddedPacket[256];
+	memcpy(paddedPacket, packetA, lenA);
+	memset(paddedPacket + lenA, 0xee, 8);
+	PTF_ASSERT_TRUE(dedup.isDuplicate(paddedPacket, lenA + 8, LINKTYPE_ETHERNET, 1050));
+
+	// the window is counted from the first copy, so a packet seen again after it ends (a retransmission) isn't a duplicate
+	PTF_ASSERT_FALSE(dedup.isDuplicate(packetB, lenB, LINKTYPE_ETHERNET, 1101));
+	PTF_ASSERT_TRUE(dedup.isDuplicate(packetA, lenA, LINKTYPE_ETHERNET, 1150));
+
+	// packets without an IP header are identified by all of their bytes
+	uint8_t arpPacket[60];
+	memset(arpPacket, 0, sizeof(arpPacket));
+	arpPacket[12] = 0x08;
+	arpPacket[13] = 0x06;
+	PTF_ASSERT_FALSE(dedup.isDuplicate(arpPacket, sizeof(arpPacket), LINKTYPE_ETHERNET, 1200));
+	PTF_ASSERT_TRUE(dedup.isDuplicate(arpPacket, sizeof(arpPacket), LINKTYPE_ETHERNET, 1201));
+	arpPacket[0] = 0xff;
+	PTF_ASSERT_FALSE(dedup.isDuplicate(arpPacket, sizeof(arpPacket), LINKTYPE_ETHERNET, 1202));
+
+	// packets are forgotten once their window ends
+	PTF_ASSERT_FALSE(dedup.isDuplicate(packetC, lenC, LINKTYPE_ETHERNET, 5000));
+	PTF_ASSERT_EQUAL(dedup.getNumOfEntries(), 1, size);
+
+	PacketDeduplicatorStats stats;
+	dedup.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.packets, 11, int);
+	PTF_ASSERT_EQUAL((int)stats.duplicates, 5, int);
+	PTF_ASSERT_EQUAL((int)stats.nonIpPackets, 3, int);
+	PTF_ASSERT_EQUAL((int)stats.evictions, 0, int);
+
+	dedup.clear();
+	PTF_ASSERT_EQUAL(dedup.getNumOfEntries(), 0, size);
+	PTF_ASSERT_FALSE(dedup.isDuplicate(packetC, lenC, LINKTYPE_ETHERNET, 5001));
+
+	// the number of remembered packets is bounded, the first seen is forgotten first
+	PacketDeduplicator smallDedup(PacketDeduplicatorConfiguration(1000000, 2));
+	PTF_ASSERT_FALSE(smallDedup.isDuplicate(packetA, lenA, LINKTYPE_ETHERNET, 1000));
+	PTF_ASSERT_FALSE(smallDedup.isDuplicate(packetC, lenC, LINKTYPE_ETHERNET, 1001));
+	PTF_ASSERT_FALSE(smallDedup.isDuplicate(arpPacket, sizeof(arpPacket), LINKTYPE_ETHERNET, 1002));
+	PTF_ASSERT_EQUAL(smallDedup.getNumOfEntries(), 2, size);
+	PTF_ASSERT_TRUE(smallDedup.isDuplicate(packetC, lenC, LINKTYPE_ETHERNET, 1003));
+	PTF_ASSERT_FALSE(smallDedup.isDuplicate(packetA, lenA, LINKTYPE_ETHERNET, 1004));
+	smallDedup.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.evictions, 2, int);
+
+	// a burst is reordered so the packets which aren't duplicates come first
+	PacketDeduplicator burstDedup;
+	timeval tv = { 1, 0 };
+	RawPacket rawA(packetA, (int)lenA, tv, false);
+	RawPacket rawB(packetB, (int)lenB, tv, false);
+	RawPacket rawC(packetC, (int)lenC, tv, false);
+	RawPacket rawA2(packetA, (int)lenA, tv, false);
+	RawPacket* burst[4] = { &rawA, &rawB, &rawC, &rawA2 };
+	PTF_ASSERT_EQUAL(burstDedup.filterBurst(burst, 4), 2, int);
+	PTF_ASSERT_TRUE(burst[0] == &rawA);
+	PTF_ASSERT_TRUE(burst[1] == &rawC);
+	PTF_ASSERT_TRUE((burst[2] == &rawB && burst[3] == &rawA2) || (burst[2] == &rawA2 && burst[3] == &rawB));
+	PTF_ASSERT_TRUE(burstDedup.isDuplicate(&rawB));
+} // PacketDeduplicatorTest
+
+// builds an Ethernet / IPv4 / TCP or UDP packet with a payload, parses it and returns the protocols of the parsed packet
+static uint64_t payloadClassifierTestParse(const char* srcIP, const char* dstIP, uint16_t srcPort, uint16_t dstPort, bool isTcp,
+		const char* payload, size_t payloadLen)
+{
+	Packet packet(300);
+	EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"), PCPP_ETHERTYPE_IP);
+	IPv4Layer ipLayer((IPv4Address(srcIP)), IPv4Address(dstIP));
+	TcpLayer tcpLayer(srcPort, dstPort);
+	UdpLayer udpLayer(srcPort, dstPort);
+	PayloadLayer payloadLayer((const uint8_t*)payload, payloadLen, false);
+	packet.addLayer(&ethLayer);
+	packet.addLayer(&ipLayer);
+	packet.addLayer(isTcp ? (Layer*)&tcpLayer : (Layer*)&udpLayer);
+	packet.addLayer(&payloadLayer);
+	packet.computeCalculateFields();
+
+	timeval time = { 0, 0 };
+	RawPacket rawPacket(packet.getRawPacket()->getRawData(), packet.getRawPacket()->getRawDataLen(), time, false);
+	Packet parsedPacket(&rawPacket);
+	uint64_t protocols = 0;
+	for (Layer* layer = parsedPacket.getFirstLayer(); layer != NULL; layer = layer->getNextLayer())
+		protocols |= layer->getProtocol();
+	return protocols;
+}
+
+PTF_TEST_CASE(PayloadClassifierTest)
+{
+	const char httpRequest[] = "GET /index.html HTTP/1.1\r\nHost: www.example.com\r\n\r\n";
+	const char httpResponse[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+	const char httpOptions[] = "OPTIONS * HTTP/1.1\r\nHost: www.example.com\r\n\r\n";
+	const char sipOptions[] = "OPTIONS sip:bob@example.com SIP/2.0\r\nCSeq: 1 OPTIONS\r\n\r\n";
+	const char sipInvite[] = "INVITE sip:bob@example.com SIP/2.0\r\nCSeq: 1 INVITE\r\n\r\n";
+	const char tlsRecord[] = "\x17\x03\x03\x00\x08\x01\x02\x03\x04\x05\x06\x07\x08";
+	const char dnsQuery[] = "\x12\x34\x01\x00\x00\x01\x00\x00\x00\x00\x00\x00\x03www\x07" "example\x03" "com\x00\x00\x01\x00\x01";
+	const char radiusRequest[] = "\x01\x01\x00\x14\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f";
+	const char gtpPacket[] = "\x30\xff\x00\x04\x00\x00\x00\x01\x45\x00\x00\x00";
+	const char garbage[] = "\x9c\x01\x77\x10\xfe\x00\x00\x00\x00\x00\x00\x00\x00\x13\x55\x66";
+
+	// signatures
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)httpRequest, sizeof(httpRequest) - 1, true), HTTP, enum);
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)httpResponse, sizeof(httpResponse) - 1, true), HTTP, enum);
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)httpRequest, sizeof(httpRequest) - 1, false), UnknownProtocol, enum);
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)httpOptions, sizeof(httpOptions) - 1, true), HTTP, enum);
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)sipOptions, sizeof(sipOptions) - 1, true), SIP, enum);
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)sipInvite, sizeof(sipInvite) - 1, false), SIP, enum);
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)tlsRecord, sizeof(tlsRecord) - 1, true), SSL, enum);
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)tlsRecord, sizeof(tlsRecord) - 1, false), UnknownProtocol, enum);
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)dnsQuery, sizeof(dnsQuery) - 1, false), DNS, enum);
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)radiusRequest, sizeof(radiusRequest) - 1, false), Radius, enum);
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)gtpPacket, sizeof(gtpPacket) - 1, false), GTPv1, enum);
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)garbage, sizeof(garbage) - 1, true), UnknownProtocol, enum);
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)garbage, sizeof(garbage) - 1, false), UnknownProtocol, enum);
+	// a protocol which isn't in the mask isn't detected
+	PTF_ASSERT_EQUAL(PayloadClassifier::matchSignature((const uint8_t*)tlsRecord, sizeof(tlsRecord) - 1, true, HTTP), UnknownProtocol, enum);
+
+	// without a classifier protocols on unregistered ports are parsed as payload
+	ProtocolRegistry& registry = ProtocolRegistry::getInstance();
+	PTF_ASSERT_TRUE(registry.getPayloadClassifier() == NULL);
+	uint64_t protocols = payloadClassifierTestParse("10.0.0.1", "10.0.0.2", 40000, 8443, true, tlsRecord, sizeof(tlsRecord) - 1);
+	PTF_ASSERT_TRUE((protocols & (SSL | GenericPayload)) == GenericPayload);
+
+	PayloadClassifier classifier(PayloadClassifierConfiguration(HTTP | SSL | SIP | DNS | Radius | GTPv1, 100, 2));
+	registry.setPayloadClassifier(&classifier);
+	PTF_ASSERT_TRUE(registry.getPayloadClassifier() == &classifier);
+
+	protocols = payloadClassifierTestParse("10.0.0.1", "10.0.0.2", 40000, 8443, true, tlsRecord, sizeof(tlsRecord) - 1);
+	PTF_ASSERT_TRUE((protocols & (SSL | GenericPayload)) == SSL);
+	// the other direction of the flow uses the cached verdict, data which isn't a TLS record is still parsed as payload
+	protocols = payloadClassifierTestParse("10.0.0.2", "10.0.0.1", 8443, 40000, true, tlsRecord, sizeof(tlsRecord) - 1);
+	PTF_ASSERT_TRUE((protocols & (SSL | GenericPayload)) == SSL);
+	protocols = payloadClassifierTestParse("10.0.0.2", "10.0.0.1", 8443, 40000, true, garbage, sizeof(garbage) - 1);
+	PTF_ASSERT_TRUE((protocols & (SSL | GenericPayload)) == GenericPayload);
+
+	protocols = payloadClassifierTestParse("10.0.0.1", "10.0.0.2", 40001, 8090, true, httpRequest, sizeof(httpRequest) - 1);
+	PTF_ASSERT_TRUE((protocols & (HTTP | GenericPayload)) == HTTPRequest);
+	protocols = payloadClassifierTestParse("10.0.0.2", "10.0.0.1", 8090, 40001, true, httpResponse, sizeof(httpResponse) - 1);
+	PTF_ASSERT_TRUE((protocols & (HTTP | GenericPayload)) == HTTPResponse);
+
+	protocols = payloadClassifierTestParse("10.0.0.1", "10.0.0.2", 40002, 5300, false, dnsQuery, sizeof(dnsQuery) - 1);
+	PTF_ASSERT_TRUE((protocols & (DNS | GenericPayload)) == DNS);
+	protocols = payloadClassifierTestParse("10.0.0.1", "10.0.0.2", 40003, 9999, false, gtpPacket, sizeof(gtpPacket) - 1);
+	PTF_ASSERT_TRUE((protocols & (GTPv1 | GenericPayload)) == GTPv1);
+
+	// a flow which didn't match in its first packets is marked as unknown
+	for (int i = 0; i < 2; i++)
+	{
+		protocols = payloadClassifierTestParse("10.0.0.1", "10.0.0.2", 40004, 7000, true, garbage, sizeof(garbage) - 1);
+		PTF_ASSERT_TRUE((protocols & GenericPayload) == GenericPayload);
+	}
+	protocols = payloadClassifierTestParse("10.0.0.1", "10.0.0.2", 40004, 7000, true, httpRequest, sizeof(httpRequest) - 1);
+	PTF_ASSERT_TRUE((protocols & (HTTP | GenericPayload)) == GenericPayload);
+
+	// registered ports are still detected by the port table
+	protocols = payloadClassifierTestParse("10.0.0.1", "10.0.0.2", 40005, 80, true, httpRequest, sizeof(httpRequest) - 1);
+	PTF_ASSERT_TRUE((protocols & (HTTP | GenericPayload)) == HTTPRequest);
+
+	PTF_ASSERT_EQUAL(classifier.getNumOfFlows(), 5, size);
+	PayloadClassifierStats stats;
+	classifier.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.packets, 10, int);
+	PTF_ASSERT_EQUAL((int)stats.cacheHits, 4, int);
+	PTF_ASSERT_EQUAL((int)stats.flowsDetected, 4, int);
+	PTF_ASSERT_EQUAL((int)stats.flowsUnknown, 1, int);
+
+	classifier.clear();
+	PTF_ASSERT_EQUAL(classifier.getNumOfFlows(), 0, size);
+
+	// a classifier without a cache matches every packet
+	PayloadClassifier uncachedClassifier(PayloadClassifierConfiguration(DNS, 0));
+	FlowTuple tuple;
+	memset(&tuple, 0, sizeof(tuple));
+	tuple.protocol = PACKETPP_IPPROTO_UDP;
+	PTF_ASSERT_EQUAL(uncachedClassifier.classify(tuple, (const uint8_t*)dnsQuery, sizeof(dnsQuery) - 1), DNS, enum);
+	PTF_ASSERT_EQUAL(uncachedClassifier.classify(tuple, (const uint8_t*)gtpPacket, sizeof(gtpPacket) - 1), UnknownProtocol, enum);
+	PTF_ASSERT_EQUAL(uncachedClassifier.getNumOfFlows(), 0, size);
+
+	registry.resetToDefaults();
+	PTF_ASSERT_TRUE(registry.getPayloadClassifier() == NULL);
+} // PayloadClassifierTest
+
+
+
+PTF_TEST_CASE(StaticPacketTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TcpPacketWithOptions.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket tcpRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet tcpPacket(&tcpRawPacket);
+
+	// a stack which matches: offsets, header lengths and header fields are the ones the generic parser finds
+	typedef StaticPacket<EthLayer, IPv4Layer, TcpLayer> TcpStack;
+	TcpStack tcpStack;
+	PTF_ASSERT_EQUAL((int)TcpStack::NumOfLayers, 3, int);
+	PTF_ASSERT_TRUE(tcpStack.parse(&tcpRawPacket));
+	PTF_ASSERT_TRUE(tcpStack.isMatched());
+	PTF_ASSERT_NULL(tcpStack.getFallbackPacket());
+	TcpLayer* tcpLayer = tcpPacket.getLayerOfType<TcpLayer>();
+	PTF_ASSERT_NOT_NULL(tcpLayer);
+	PTF_ASSERT_TRUE((uint8_t*)tcpStack.get<TcpLayer>() == tcpLayer->getData());
+	PTF_ASSERT_EQUAL(tcpStack.getOffset<TcpLayer>(), (size_t)(tcpLayer->getData() - tcpRawPacket.getRawData()), size);
+	PTF_ASSERT_EQUAL(tcpStack.getHeaderLen<TcpLayer>(), tcpLayer->getHeaderLen(), size);
+	PTF_ASSERT_EQUAL(tcpStack.getHeaderLen<IPv4Layer>(), tcpPacket.getLayerOfType<IPv4Layer>()->getHeaderLen(), size);
+	PTF_ASSERT_EQUAL(tcpStack.get<TcpLayer>()->portSrc, tcpLayer->getTcpHeader()->portSrc, u16);
+	PTF_ASSERT_EQUAL(tcpStack.get<IPv4Layer>()->ipDst, tcpPacket.getLayerOfType<IPv4Layer>()->getIPv4Header()->ipDst, u32);
+	PTF_ASSERT_EQUAL(tcpStack.get<EthLayer>()->etherType, htons(PCPP_ETHERTYPE_IP), u16);
+	PTF_ASSERT_TRUE(tcpStack.getPayload() == tcpLayer->getData() + tcpLayer->getHeaderLen());
+	PTF_ASSERT_EQUAL(tcpStack.getPayloadLen(), tcpLayer->getLayerPayloadSize(), size);
+
+	// a stack which doesn't match falls back to the generic parser, and matches again when the next packet does
+	StaticPacket<EthLayer, IPv4Layer, UdpLayer> udpStack;
+	PTF_ASSERT_FALSE(udpStack.parse(&tcpRawPacket));
+	PTF_ASSERT_FALSE(udpStack.isMatched());
+	PTF_ASSERT_NOT_NULL(udpStack.getFallbackPacket());
+	PTF_ASSERT_TRUE(udpStack.getFallbackPacket()->isPacketOfType(TCP));
+
+	// a stack starting with IPv4Layer doesn't match an Ethernet packet
+	StaticPacket<IPv4Layer, TcpLayer> rawIPStack;
+	PTF_ASSERT_FALSE(rawIPStack.parse(&tcpRawPacket));
+	PTF_ASSERT_TRUE(rawIPStack.parse((uint8_t*)tcpRawPacket.getRawData() + sizeof(ether_header), tcpRawPacket.getRawDataLen() - sizeof(ether_header)));
+	PTF_ASSERT_EQUAL(rawIPStack.getOffset<TcpLayer>(), tcpStack.getOffset<TcpLayer>() - sizeof(ether_header), size);
+
+	// truncated data doesn't match
+	PTF_ASSERT_FALSE(tcpStack.parse((uint8_t*)tcpRawPacket.getRawData(), tcpStack.getOffset<TcpLayer>() + sizeof(tcphdr) - 1));
+
+	// GTP-U with extension headers and an inner IPv4 header
+	buffer = readFileIntoBuffer("PacketExamples/gtp-u-2ext.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket gtpRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet gtpPacket(&gtpRawPacket);
+	GtpV1Layer* gtpLayer = gtpPacket.getLayerOfType<GtpV1Layer>();
+	PTF_ASSERT_NOT_NULL(gtpLayer);
+	IPv4Layer* innerIPLayer = gtpPacket.getNextLayerOfType<IPv4Layer>(gtpLayer);
+	PTF_ASSERT_NOT_NULL(innerIPLayer);
+
+	StaticPacket<EthLayer, IPv4Layer, UdpLayer, GtpV1Layer, IPv4Layer> gtpStack;
+	PTF_ASSERT_TRUE(gtpStack.parse(&gtpRawPacket));
+	PTF_ASSERT_TRUE((uint8_t*)gtpStack.get<GtpV1Layer>() == gtpLayer->getData());
+	PTF_ASSERT_EQUAL(gtpStack.getHeaderLen<GtpV1Layer>(), gtpLayer->getHeaderLen(), size);
+	PTF_ASSERT_EQUAL(gtpStack.get<GtpV1Layer>()->teid, gtpLayer->getHeader()->teid, u32);
+	PTF_ASSERT_TRUE((uint8_t*)gtpStack.get<IPv4Layer>() == gtpPacket.getLayerOfType<IPv4Layer>()->getData());
+	iphdr* innerIPHeader = gtpStack.get<IPv4Layer, 1>();
+	PTF_ASSERT_TRUE((uint8_t*)innerIPHeader == innerIPLayer->getData());
+	PTF_ASSERT_EQUAL(gtpStack.getPayloadLen(), innerIPLayer->getLayerPayloadSize(), size);
+
+	// a GTP stack doesn't match a plain UDP packet on other ports, and a TCP stack doesn't match a GTP packet
+	PTF_ASSERT_FALSE(tcpStack.parse(&gtpRawPacket));
+	PTF_ASSERT_TRUE(tcpStack.getFallbackPacket()->isPacketOfType(GTP));
+
+	// double VLAN tags
+	buffer = readFileIntoBuffer("PacketExamples/ArpRequestWithVlan.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket vlanRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+
+	StaticPacket<EthLayer, VlanLayer, VlanLayer> vlanStack;
+	PTF_ASSERT_TRUE(vlanStack.parse(&vlanRawPacket));
+	PTF_ASSERT_EQUAL(vlanStack.getOffset<VlanLayer>(), sizeof(ether_header), size);
+	vlan_header* innerVlanHeader = vlanStack.get<VlanLayer, 1>();
+	PTF_ASSERT_EQUAL(innerVlanHeader->etherType, htons(PCPP_ETHERTYPE_ARP), u16);
+	StaticPacket<EthLayer, VlanLayer, VlanLayer, IPv4Layer> vlanIPStack;
+	PTF_ASSERT_FALSE(vlanIPStack.parse(&vlanRawPacket));
+	PTF_ASSERT_TRUE(vlanIPStack.getFallbackPacket()->isPacketOfType(ARP));
+	PTF_ASSERT_FALSE(vlanStack.parse(&tcpRawPacket));
+} // StaticPacketTest
+
+
+
+PTF_TEST_CASE(PacketDumpWriterTest)
+{
+	timeval time;
+	time.tv_sec = 1500000000;
+	time.tv_usec = 123456;
+
+	// the text format is the same as Packet::toStringList(), for layers which implement dump() and for those which don't
+	const char* fileNames[] = { "PacketExamples/ArpRequestPacket.dat", "PacketExamples/IcmpEchoRequest.dat", "PacketExamples/IPv6Frag1.dat",
+			"PacketExamples/MplsPackets1.dat", "PacketExamples/IPv4Frag2.dat", "PacketExamples/TcpPacketWithOptions.dat",
+			"PacketExamples/IPv6UdpPacket.dat", "PacketExamples/Dns1.dat" };
+	std::string buffer;
+	PacketDumpWriter textWriter(buffer);
+	textWriter.setTimeAsLocalTime(false);
+	for (size_t i = 0; i < sizeof(fileNames) / sizeof(fileNames[0]); i++)
+	{
+		int bufferLength = 0;
+		uint8_t* rawData = readFileIntoBuffer(fileNames[i], bufferLength);
+		PTF_ASSERT_NOT_NULL(rawData);
+		RawPacket rawPacket((const uint8_t*)rawData, bufferLength, time, true);
+		Packet packet(&rawPacket);
+
+		std::vector<std::string> stringList;
+		packet.toStringList(stringList, false);
+		std::string expected, expectedIndented;
+		for (std::vector<std::string>::iterator iter = stringList.begin(); iter != stringList.end(); iter++)
+		{
+			expected += *iter + "\n";
+			expectedIndented += "  " + *iter + "\n";
+		}
+		PTF_ASSERT_EQUAL(packet.toString(false), expected, string);
+
+		buffer.clear();
+		textWriter.setIndent("  ");
+		textWriter.writePacket(packet);
+		PTF_ASSERT_EQUAL(buffer, expectedIndented, string);
+
+		buffer.clear();
+		textWriter.setIndent(NULL);
+		textWriter.writeLayer(*packet.getLastLayer());
+		PTF_ASSERT_EQUAL(buffer, packet.getLastLayer()->toString() + "\n", string);
+	}
+
+	// JSON lines
+	int bufferLength = 0;
+	uint8_t* rawData = readFileIntoBuffer("PacketExamples/ArpRequestPacket.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(rawData);
+	RawPacket arpRawPacket((const uint8_t*)rawData, bufferLength, time, true);
+	Packet arpPacket(&arpRawPacket);
+	buffer.clear();
+	PacketDumpWriter jsonWriter(buffer, PacketDumpWriter::JsonLinesFormat);
+	PTF_ASSERT_EQUAL(jsonWriter.getFormat(), PacketDumpWriter::JsonLinesFormat, enum);
+	jsonWriter.writePacket(arpPacket);
+	PTF_ASSERT_EQUAL(buffer, std::string("{\"length\":42,\"timestamp\":1500000000.123456000,\"layers\":["
+			"{\"layer\":\"eth\",\"src\":\"6c:f0:49:b2:de:6e\",\"dst\":\"ff:ff:ff:ff:ff:ff\",\"etherType\":2054},"
+			"{\"layer\":\"arp\",\"opcode\":\"request\",\"senderIp\":\"10.0.0.1\",\"senderMac\":\"6c:f0:49:b2:de:6e\",\"targetIp\":\"10.0.0.138\"}]}\n"), string);
+
+	// layers without dump() are written as an escaped summary
+	rawData = readFileIntoBuffer("PacketExamples/MplsPackets1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(rawData);
+	RawPacket mplsRawPacket((const uint8_t*)rawData, bufferLength, time, true);
+	Packet mplsPacket(&mplsRawPacket);
+	buffer.clear();
+	jsonWriter.writePacket(mplsPacket);
+	PTF_ASSERT_TRUE(buffer.find("{\"layer\":\"mpls\",\"label\":16000,\"exp\":0,\"ttl\":126,\"bottomOfStack\":true}") != std::string::npos);
+	PTF_ASSERT_TRUE(buffer.find("{\"layer\":\"http_request\",\"summary\":\"HTTP request, GET /i/?tid=199&hash=8ktxrl&subid=0 HTTP/1.1\"}]}\n") != std::string::npos);
+
+	// writing the same packet to a cleared buffer doesn't grow it
+	size_t capacity = buffer.capacity();
+	for (int i = 0; i < 10; i++)
+	{
+		buffer.clear();
+		jsonWriter.writePacket(mplsPacket);
+	}
+	PTF_ASSERT_EQUAL(buffer.capacity(), capacity, size);
+
+	PTF_ASSERT_EQUAL(std::string(PacketDumpWriter::getProtocolName(IPv6)), "ipv6", string);
+	PTF_ASSERT_EQUAL(std::string(PacketDumpWriter::getProtocolName(UnknownProtocol)), "unknown", string);
+} // PacketDumpWriterTest
+
+
+// builds an Ethernet / IPv4 / TCP packet for TcpFlowTrackerTest
+static void tcpFlowTrackerTestPacket(uint8_t* buffer, size_t& len, const char* srcIP, const char* dstIP, uint16_t srcPort, uint16_t dstPort,
+		uint8_t tcpFlags, uint32_t seq, uint32_t ack, uint16_t window, size_t payloadLen)
+{
+	Packet packet(200);
+	EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"), PCPP_ETHERTYPE_IP);
+	IPv4Layer ipLayer((IPv4Address(srcIP)), IPv4Address(dstIP));
+	TcpLayer tcpLayer(srcPort, dstPort);
+	tcpLayer.getTcpHeader()->sequenceNumber = htonl(seq);
+	tcpLayer.getTcpHeader()->ackNumber = htonl(ack);
+	tcpLayer.getTcpHeader()->windowSize = htons(window);
+	((uint8_t*)tcpLayer.getTcpHeader())[13] = tcpFlags;
+	uint8_t payload[100];
+	memset(payload, 0x55, sizeof(payload));
+	PayloadLayer payloadLayer(payload, payloadLen, false);
+
+	packet.addLayer(&ethLayer);
+	packet.addLayer(&ipLayer);
+	packet.addLayer(&tcpLayer);
+	if (payloadLen > 0)
+		packet.addLayer(&payloadLayer);
+	packet.computeCalculateFields();
+
+	len = packet.getRawPacket()->getRawDataLen();
+	memcpy(buffer, packet.getRawPacket()->getRawData(), len);
+}
+
+static void tcpFlowTrackerTestOnReported(const TcpFlowMetrics& metrics, void* userCookie)
+{
+	((std::vector<TcpFlowMetrics>*)userCookie)->push_back(metrics);
+}
+
+PTF_TEST_CASE(TcpFlowTrackerTest)
+{
+	uint8_t buffer[256];
+	size_t len;
+	std::vector<TcpFlowMetrics> reports;
+	const uint64_t startTime = 1000000000;
+
+	TcpFlowTracker tracker(TcpFlowTrackerConfiguration(10), tcpFlowTrackerTestOnReported, &reports);
+
+	// a connection with a handshake, RTT samples, a retransmission, an out-of-order segment and zero windows, which ends with FINs.
+	// Each step is: from client, TCP flags, sequence number, ACK number, window, payload length and time
+	struct Step { bool fromClient; uint8_t flags; uint32_t seq; uint32_t ack; uint16_t window; size_t payloadLen; uint32_t time; };
+	const Step steps[] = {
+			{ true,  0x02, 1000, 0,    1000, 0,   0 },     // SYN
+			{ false, 0x12, 5000, 1001, 1000, 0,   10000 }, // SYN-ACK
+			{ true,  0x10, 1001, 5001, 1000, 0,   12000 }, // ACK completing the handshake
+			{ true,  0x18, 1001, 5001, 1000, 100, 13000 }, // data which is timed
+			{ false, 0x10, 5001, 1101, 1000, 0,   23000 }, // its ACK, an RTT of 10ms
+			{ false, 0x18, 5001, 1101, 1000, 50,  24000 }, // data which is timed
+			{ true,  0x10, 1101, 5051, 1000, 0,   26000 }, // its ACK, an RTT of 2ms
+			{ true,  0x18, 1101, 5051, 1000, 100, 27000 }, // data
+			{ true,  0x18, 1101, 5051, 1000, 100, 28000 }, // the same data again
+			{ true,  0x18, 1301, 5051, 1000, 100, 29000 }, // data skipping 100 bytes
+			{ true,  0x18, 1201, 5051, 1000, 100, 30000 }, // the skipped data shortly after
+			{ false, 0x10, 5051, 1401, 0,    0,   31000 }, // a zero window
+			{ false, 0x10, 5051, 1401, 0,    0,   32000 }, // the zero window goes on
+			{ false, 0x10, 5051, 1401, 1000, 0,   33000 },
+			{ false, 0x10, 5051, 1401, 0,    0,   34000 }, // a second zero window
+			{ true,  0x11, 1401, 5051, 1000, 0,   40000 }, // FIN
+			{ false, 0x11, 5051, 1402, 1000, 0,   41000 }, // FIN
+			{ true,  0x10, 1402, 5052, 1000, 0,   42000 }  // the last ACK
+	};
+	const size_t numOfSteps = sizeof(steps) / sizeof(steps[0]);
+
+	for (size_t i = 0; i < numOfSteps; i++)
+	{
+		const Step& step = steps[i];
+		tcpFlowTrackerTestPacket(buffer, len, step.fromClient ? "10.0.0.1" : "10.0.0.2", step.fromClient ? "10.0.0.2" : "10.0.0.1",
+				step.fromClient ? 40000 : 80, step.fromClient ? 80 : 40000, step.flags, step.seq, step.ack, step.window, step.payloadLen);
+		PTF_ASSERT_TRUE(tracker.processPacket(buffer, len, LINKTYPE_ETHERNET, startTime + step.time));
+		PTF_ASSERT_EQUAL(reports.size(), (size_t)(i >= numOfSteps - 2 ? 1 : 0), size);
+	}
+
+	// the last ACK doesn't start a new connection
+	PTF_ASSERT_EQUAL(tracker.getNumOfConnections(), 1, size);
+
+	TcpFlowMetrics& metrics = reports[0];
+	PTF_ASSERT_EQUAL(metrics.endReason, TcpFlowEndFin, enum);
+	PTF_ASSERT_TRUE(metrics.handshakeSeen);
+	PTF_ASSERT_EQUAL(metrics.tuple.srcPort, 40000, u16);
+	PTF_ASSERT_EQUAL(metrics.tuple.dstPort, 80, u16);
+	PTF_ASSERT_EQUAL(metrics.tuple.srcIP[3], 1, u8);
+	PTF_ASSERT_EQUAL(metrics.serverHandshakeRtt, 10000, u32);
+	PTF_ASSERT_EQUAL(metrics.clientHandshakeRtt, 2000, u32);
+	PTF_ASSERT_EQUAL(metrics.getHandshakeRtt(), 12000, u32);
+	PTF_ASSERT_EQUAL((int)metrics.firstSeen, (int)startTime, int);
+	PTF_ASSERT_EQUAL((int)metrics.getDuration(), 41000, int);
+	PTF_ASSERT_EQUAL(metrics.clientToServer.packets, 9, u32);
+	PTF_ASSERT_EQUAL((int)metrics.clientToServer.bytes, 500, int);
+	PTF_ASSERT_EQUAL(metrics.clientToServer.retransmissions, 1, u32);
+	PTF_ASSERT_EQUAL(metrics.clientToServer.outOfOrder, 1, u32);
+	PTF_ASSERT_EQUAL(metrics.clientToServer.zeroWindowEvents, 0, u32);
+	PTF_ASSERT_EQUAL(metrics.clientToServer.rttSamples, 1, u32);
+	PTF_ASSERT_EQUAL(metrics.clientToServer.getAverageRtt(), 10000, u32);
+	PTF_ASSERT_EQUAL(metrics.serverToClient.packets, 8, u32);
+	PTF_ASSERT_EQUAL((int)metrics.serverToClient.bytes, 50, int);
+	PTF_ASSERT_EQUAL(metrics.serverToClient.retransmissions, 0, u32);
+	PTF_ASSERT_EQUAL(metrics.serverToClient.zeroWindowEvents, 2, u32);
+	PTF_ASSERT_EQUAL(metrics.serverToClient.rttSamples, 1, u32);
+	PTF_ASSERT_EQUAL(metrics.serverToClient.minRtt, 2000, u32);
+	PTF_ASSERT_EQUAL(metrics.serverToClient.maxRtt, 2000, u32);
+	PTF_ASSERT_TRUE(metrics.getThroughput(true) > 97560.0 && metrics.getThroughput(true) < 97561.0);
+
+	// the connection can be looked up by either direction until it leaves the table
+	TcpFlowMetrics current;
+	PTF_ASSERT_TRUE(tracker.getMetrics(metrics.tuple, 0, current));
+	PTF_ASSERT_EQUAL(current.clientToServer.packets, 10, u32);
+	FlowTuple reversedTuple = metrics.tuple;
+	memcpy(reversedTuple.srcIP, metrics.tuple.dstIP, sizeof(reversedTuple.srcIP));
+	memcpy(reversedTuple.dstIP, metrics.tuple.srcIP, sizeof(reversedTuple.dstIP));
+	reversedTuple.srcPort = metrics.tuple.dstPort;
+	reversedTuple.dstPort = metrics.tuple.srcPort;
+	PTF_ASSERT_TRUE(tracker.getMetrics(reversedTuple, 0, current));
+	PTF_ASSERT_EQUAL(current.tuple.srcPort, 40000, u16);
+	PTF_ASSERT_FALSE(tracker.getMetrics(reversedTuple, 1, current));
+
+	// a connection seen from the middle, with a keep-alive, which ends with a RST. Its client is the side of the first packet
+	tcpFlowTrackerTestPacket(buffer, len, "10.0.0.4", "10.0.0.3", 6000, 5000, 0x18, 100, 200, 1000, 10);
+	PTF_ASSERT_TRUE(tracker.processPacket(buffer, len, LINKTYPE_ETHERNET, startTime + 50000));
+	tcpFlowTrackerTestPacket(buffer, len, "10.0.0.4", "10.0.0.3", 6000, 5000, 0x10, 109, 200, 1000, 1);
+	PTF_ASSERT_TRUE(tracker.processPacket(buffer, len, LINKTYPE_ETHERNET, startTime + 60000));
+	tcpFlowTrackerTestPacket(buffer, len, "10.0.0.3", "10.0.0.4", 5000, 6000, 0x04, 200, 0, 0, 0);
+	PTF_ASSERT_TRUE(tracker.processPacket(buffer, len, LINKTYPE_ETHERNET, startTime + 70000));
+	PTF_ASSERT_EQUAL(reports.size(), 2, size);
+	PTF_ASSERT_EQUAL(reports[1].endReason, TcpFlowEndRst, enum);
+	PTF_ASSERT_FALSE(reports[1].handshakeSeen);
+	PTF_ASSERT_EQUAL(reports[1].tuple.srcPort, 6000, u16);
+	PTF_ASSERT_EQUAL(reports[1].clientToServer.retransmissions, 0, u32);
+	PTF_ASSERT_EQUAL((int)reports[1].clientToServer.bytes, 11, int);
+	PTF_ASSERT_EQUAL(reports[1].serverToClient.zeroWindowEvents, 0, u32);
+	PTF_ASSERT_EQUAL(reports[1].getHandshakeRtt(), 0, u32);
+
+	// a SYN reusing the tuple of the connection which ended starts a new connection
+	tcpFlowTrackerTestPacket(buffer, len, "10.0.0.3", "10.0.0.4", 5000, 6000, 0x02, 7000, 0, 1000, 0);
+	PTF_ASSERT_TRUE(tracker.processPacket(buffer, len, LINKTYPE_ETHERNET, startTime + 80000));
+	PTF_ASSERT_EQUAL(tracker.getNumOfConnections(), 2, size);
+
+	// a packet without a TCP header isn't tracked
+	flowMeterTestPacket(buffer, len, 4, "10.0.0.1", "10.0.0.2", 1000, 53, false, 0, 0, 10);
+	PTF_ASSERT_FALSE(tracker.processPacket(buffer, len, LINKTYPE_ETHERNET, startTime + 90000));
+
+	// connections time out 10 seconds after their last packet. Connections which ended aren't reported again
+	tracker.advanceTime(startTime + 12000000);
+	PTF_ASSERT_EQUAL(tracker.getNumOfConnections(), 0, size);
+	PTF_ASSERT_EQUAL(reports.size(), 3, size);
+	PTF_ASSERT_EQUAL(reports[2].endReason, TcpFlowEndIdleTimeout, enum);
+	PTF_ASSERT_EQUAL(reports[2].tuple.srcPort, 5000, u16);
+	PTF_ASSERT_EQUAL(reports[2].clientToServer.packets, 1, u32);
+
+	TcpFlowTrackerStats stats;
+	tracker.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.packets, (int)numOfSteps + 5, int);
+	PTF_ASSERT_EQUAL((int)stats.nonTcpPackets, 1, int);
+	PTF_ASSERT_EQUAL((int)stats.connectionsCreated, 3, int);
+	PTF_ASSERT_EQUAL((int)stats.connectionsReported, 3, int);
+
+	// when the table is full the least recently seen connection is evicted, and flush() reports the rest
+	reports.clear();
+	TcpFlowTracker smallTracker(TcpFlowTrackerConfiguration(10, 1), tcpFlowTrackerTestOnReported, &reports);
+	for (int i = 0; i < 2; i++)
+	{
+		tcpFlowTrackerTestPacket(buffer, len, "10.0.0.1", "10.0.0.2", 1000 + i, 80, 0x02, 0, 0, 1000, 0);
+		PTF_ASSERT_TRUE(smallTracker.processPacket(buffer, len, LINKTYPE_ETHERNET, startTime));
+	}
+	PTF_ASSERT_EQUAL(reports.size(), 1, size);
+	PTF_ASSERT_EQUAL(reports[0].endReason, TcpFlowEndEvicted, enum);
+	PTF_ASSERT_EQUAL(reports[0].tuple.srcPort, 1000, u16);
+	std::vector<TcpFlowMetrics> allMetrics;
+	smallTracker.getAllMetrics(allMetrics);
+	PTF_ASSERT_EQUAL(allMetrics.size(), 1, size);
+	PTF_ASSERT_EQUAL(allMetrics[0].tuple.srcPort, 1001, u16);
+	smallTracker.flush();
+	PTF_ASSERT_EQUAL(reports.size(), 2, size);
+	PTF_ASSERT_EQUAL(reports[1].endReason, TcpFlowEndForced, enum);
+	PTF_ASSERT_EQUAL(smallTracker.getNumOfConnections(), 0, size);
+
+	// both directions of a connection are assigned to the same shard
+	timeval time;
+	gettimeofday(&time, NULL);
+	tcpFlowTrackerTestPacket(buffer, len, "10.0.0.1", "10.0.0.2", 40000, 80, 0x10, 0, 0, 1000, 0);
+	RawPacket clientPacket(buffer, (int)len, time, false);
+	uint8_t reverseBuffer[256];
+	size_t reverseLen;
+	tcpFlowTrackerTestPacket(reverseBuffer, reverseLen, "10.0.0.2", "10.0.0.1", 80, 40000, 0x10, 0, 0, 1000, 0);
+	RawPacket serverPacket(reverseBuffer, (int)reverseLen, time, false);
+	PTF_ASSERT_EQUAL(TcpFlowTracker::getShardIndex(&clientPacket, 4), TcpFlowTracker::getShardIndex(&serverPacket, 4), size);
+	PTF_ASSERT_TRUE(TcpFlowTracker::getShardIndex(&clientPacket, 4) < 4);
+	PTF_ASSERT_TRUE(TcpFlowTracker::getBytesPerConnection() > 0);
+} // TcpFlowTrackerTest
+
+
+// builds an Ethernet / IPv4 / UDP / GTPv1 packet and gives it to the table, for GtpSessionTableTest
+static const GtpSession* gtpSessionTableTestProcess(GtpSessionTable& table, const char* srcIP, const char* dstIP, uint8_t messageType, uint32_t teid,
+		uint16_t seq, const uint8_t* payload, size_t payloadLen, time_t time, GtpSessionDirection* direction = NULL)
+{
+	bool isUserPlane = (messageType == GtpV1_GPDU);
+	Packet packet(300);
+	EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:01"), MacAddress("aa:bb:cc:dd:ee:02"), PCPP_ETHERTYPE_IP);
+	IPv4Layer ipLayer((IPv4Address(srcIP)), IPv4Address(dstIP));
+	UdpLayer udpLayer(isUserPlane ? 2152 : 2123, isUserPlane ? 2152 : 2123);
+	GtpV1Layer gtpLayer((GtpV1MessageType)messageType, teid, !isUserPlane, seq, false, 0);
+	PayloadLayer payloadLayer(payload, payloadLen, false);
+
+	packet.addLayer(&ethLayer);
+	packet.addLayer(&ipLayer);
+	packet.addLayer(&udpLayer);
+	packet.addLayer(&gtpLayer);
+	packet.addLayer(&payloadLayer);
+	packet.computeCalculateFields();
+
+	timeval timestamp;
+	timestamp.tv_sec = time;
+	timestamp.tv_usec = 0;
+	RawPacket rawPacket(packet.getRawPacket()->getRawData(), packet.getRawPacket()->getRawDataLen(), timestamp, false);
+	return table.processPacket(&rawPacket, direction);
+}
+
+static void gtpSessionTableTestOnEnd(const GtpSession& session, GtpSessionEndReason reason, void* userCookie)
+{
+	((std::vector<std::pair<uint64_t, GtpSessionEndReason> >*)userCookie)->push_back(std::make_pair(session.sessionId, reason));
+}
+
+PTF_TEST_CASE(GtpSessionTableTest)
+{
+	std::vector<std::pair<uint64_t, GtpSessionEndReason> > ended;
+	GtpSessionTable table(gtpSessionTableTestOnEnd, &ended, GtpSessionTableConfiguration(1, 100, 30));
+	const time_t startTime = 1000000;
+	GtpSessionDirection direction;
+	uint8_t userData[100];
+	// the message types of 3GPP TS 29.060, which GtpV1MessageType numbers differently
+	const uint8_t createRequestType = 16, createResponseType = 17, updateRequestType = 18, updateResponseType = 19, deleteRequestType = 20,
+			deleteResponseType = 21;
+	memset(userData, 0x45, sizeof(userData));
+
+	int readerId = table.registerReader();
+	PTF_ASSERT_TRUE(readerId >= 0);
+
+	// a Create PDP Context Request of the SGSN (control plane 10.1.1.1, user plane 10.1.1.2) with the IMSI 001010123456789, data TEID
+	// 0x1001, control TEID 0x2001, NSAPI 5, a dynamic IPv4 end user address and the 2 GSN addresses
+	const uint8_t createRequest[] = {
+			0x02, 0x00, 0x01, 0x01, 0x21, 0x43, 0x65, 0x87, 0xf9,
+			0x10, 0x00, 0x00, 0x10, 0x01,
+			0x11, 0x00, 0x00, 0x20, 0x01,
+			0x14, 0x05,
+			0x80, 0x00, 0x02, 0xf1, 0x21,
+			0x85, 0x00, 0x04, 10, 1, 1, 1,
+			0x85, 0x00, 0x04, 10, 1, 1, 2 };
+	// the GGSN (control plane 10.2.2.1, user plane 10.2.2.2) accepts it with data TEID 0x3001, control TEID 0x4001 and the address 192.168.0.5
+	const uint8_t createResponse[] = {
+			0x01, 0x80,
+			0x10, 0x00, 0x00, 0x30, 0x01,
+			0x11, 0x00, 0x00, 0x40, 0x01,
+			0x80, 0x00, 0x06, 0xf1, 0x21, 192, 168, 0, 5,
+			0x85, 0x00, 0x04, 10, 2, 2, 1,
+			0x85, 0x00, 0x04, 10, 2, 2, 2 };
+
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.1.1.1", "10.2.2.1", createRequestType, 0, 1, createRequest, sizeof(createRequest), startTime));
+	PTF_ASSERT_EQUAL(table.getNumOfPendingRequests(), 1, size);
+	PTF_ASSERT_EQUAL(table.getNumOfSessions(), 0, size);
+
+	// a response with another sequence number doesn't match the request
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.2.2.1", "10.1.1.1", createResponseType, 0x2001, 2, createResponse, sizeof(createResponse), startTime));
+	PTF_ASSERT_EQUAL(table.getNumOfSessions(), 0, size);
+
+	const GtpSession* session = gtpSessionTableTestProcess(table, "10.2.2.1", "10.1.1.1", createResponseType, 0x2001, 1, createResponse, sizeof(createResponse), startTime);
+	PTF_ASSERT_NOT_NULL(session);
+	PTF_ASSERT_EQUAL(table.getNumOfSessions(), 1, size);
+	PTF_ASSERT_EQUAL(table.getNumOfPendingRequests(), 0, size);
+	uint64_t firstSessionId = session->sessionId;
+	PTF_ASSERT_EQUAL(std::string(session->imsi), "001010123456789", string);
+	PTF_ASSERT_EQUAL(session->nsapi, 5, u8);
+	PTF_ASSERT_EQUAL(session->endUserIpVersion, 4, u8);
+	PTF_ASSERT_EQUAL(session->endUserAddress[0], 192, u8);
+	PTF_ASSERT_EQUAL(session->endUserAddress[3], 5, u8);
+	PTF_ASSERT_EQUAL(session->sgsnControl.teid, 0x2001, u32);
+	PTF_ASSERT_EQUAL(session->sgsnControl.ipAddress[3], 1, u8);
+	PTF_ASSERT_EQUAL(session->sgsnUserPlane.teid, 0x1001, u32);
+	PTF_ASSERT_EQUAL(session->sgsnUserPlane.ipAddress[3], 2, u8);
+	PTF_ASSERT_EQUAL(session->ggsnControl.teid, 0x4001, u32);
+	PTF_ASSERT_EQUAL(session->ggsnUserPlane.teid, 0x3001, u32);
+	PTF_ASSERT_EQUAL(session->ggsnUserPlane.ipAddress[3], 2, u8);
+
+	// user plane packets are classified by the TEID and the GSN they're sent to
+	PTF_ASSERT_TRUE(gtpSessionTableTestProcess(table, "10.1.1.2", "10.2.2.2", GtpV1_GPDU, 0x3001, 0, userData, 100, startTime + 1, &direction) == session);
+	PTF_ASSERT_EQUAL(direction, GtpSessionUplink, enum);
+	PTF_ASSERT_TRUE(gtpSessionTableTestProcess(table, "10.2.2.2", "10.1.1.2", GtpV1_GPDU, 0x1001, 0, userData, 60, startTime + 1, &direction) == session);
+	PTF_ASSERT_EQUAL(direction, GtpSessionDownlink, enum);
+	PTF_ASSERT_TRUE(gtpSessionTableTestProcess(table, "10.2.2.2", "10.1.1.2", GtpV1_GPDU, 0x1001, 0, userData, 40, startTime + 2) == session);
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.1.1.2", "10.2.2.2", GtpV1_GPDU, 0x3002, 0, userData, 100, startTime + 2));
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.1.1.2", "10.2.2.3", GtpV1_GPDU, 0x3001, 0, userData, 100, startTime + 2));
+	// a GTP-U packet to the control plane TEID isn't classified
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.1.1.1", "10.2.2.1", GtpV1_GPDU, 0x4001, 0, userData, 100, startTime + 2));
+	PTF_ASSERT_EQUAL((int)session->uplinkPackets, 1, int);
+	PTF_ASSERT_EQUAL((int)session->uplinkBytes, 100, int);
+	PTF_ASSERT_EQUAL((int)session->downlinkPackets, 2, int);
+	PTF_ASSERT_EQUAL((int)session->downlinkBytes, 100, int);
+	PTF_ASSERT_EQUAL((int)session->lastActivityTime, (int)startTime + 2, int);
+
+	uint8_t ggsnAddress[4] = { 10, 2, 2, 2 };
+	PTF_ASSERT_TRUE(table.findSession(0x3001, 4, ggsnAddress, &direction) == session);
+	PTF_ASSERT_EQUAL(direction, GtpSessionUplink, enum);
+	PTF_ASSERT_NULL(table.findSession(0x4001, 4, ggsnAddress));
+
+	// the SGSN moves the user plane to 10.1.1.3 with data TEID 0x1002, over the control tunnel of the GGSN
+	const uint8_t updateRequest[] = {
+			0x10, 0x00, 0x00, 0x10, 0x02,
+			0x11, 0x00, 0x00, 0x20, 0x01,
+			0x14, 0x05,
+			0x85, 0x00, 0x04, 10, 1, 1, 1,
+			0x85, 0x00, 0x04, 10, 1, 1, 3 };
+	const uint8_t updateResponse[] = {
+			0x01, 0x80,
+			0x10, 0x00, 0x00, 0x30, 0x01,
+			0x85, 0x00, 0x04, 10, 2, 2, 1,
+			0x85, 0x00, 0x04, 10, 2, 2, 2 };
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.1.1.1", "10.2.2.1", updateRequestType, 0x4001, 3, updateRequest, sizeof(updateRequest), startTime + 3));
+	PTF_ASSERT_TRUE(gtpSessionTableTestProcess(table, "10.2.2.1", "10.1.1.1", updateResponseType, 0x2001, 3, updateResponse, sizeof(updateResponse), startTime + 3) == session);
+	PTF_ASSERT_EQUAL(session->sgsnUserPlane.teid, 0x1002, u32);
+	PTF_ASSERT_EQUAL(session->sgsnUserPlane.ipAddress[3], 3, u8);
+	PTF_ASSERT_EQUAL(session->ggsnUserPlane.teid, 0x3001, u32);
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.2.2.2", "10.1.1.2", GtpV1_GPDU, 0x1001, 0, userData, 40, startTime + 4));
+	PTF_ASSERT_TRUE(gtpSessionTableTestProcess(table, "10.2.2.2", "10.1.1.3", GtpV1_GPDU, 0x1002, 0, userData, 40, startTime + 4) == session);
+	PTF_ASSERT_TRUE(gtpSessionTableTestProcess(table, "10.1.1.3", "10.2.2.2", GtpV1_GPDU, 0x3001, 0, userData, 40, startTime + 4) == session);
+	PTF_ASSERT_EQUAL((int)session->downlinkPackets, 3, int);
+
+	std::vector<GtpSession> sessions;
+	table.getAllSessions(sessions);
+	PTF_ASSERT_EQUAL(sessions.size(), 1, size);
+	PTF_ASSERT_EQUAL((int)sessions[0].sessionId, (int)firstSessionId, int);
+
+	// the SGSN deletes the session. The reader still holds the session, so it isn't reclaimed until it passes a quiescent state
+	const uint8_t deleteRequest[] = { 0x14, 0x05 };
+	const uint8_t deleteResponse[] = { 0x01, 0x80 };
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.1.1.1", "10.2.2.1", deleteRequestType, 0x4001, 4, deleteRequest, sizeof(deleteRequest), startTime + 5));
+	PTF_ASSERT_EQUAL(table.getNumOfSessions(), 1, size);
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.2.2.1", "10.1.1.1", deleteResponseType, 0x2001, 4, deleteResponse, sizeof(deleteResponse), startTime + 5));
+	PTF_ASSERT_EQUAL(table.getNumOfSessions(), 0, size);
+	PTF_ASSERT_EQUAL(ended.size(), 1, size);
+	PTF_ASSERT_EQUAL((int)ended[0].first, (int)firstSessionId, int);
+	PTF_ASSERT_EQUAL(ended[0].second, GtpSessionDeleted, enum);
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.1.1.3", "10.2.2.2", GtpV1_GPDU, 0x3001, 0, userData, 40, startTime + 5));
+	PTF_ASSERT_EQUAL(table.reclaim(), 1, size);
+	table.quiescentState(readerId);
+	PTF_ASSERT_EQUAL(table.reclaim(), 0, size);
+
+	// a second session. A third one is rejected since the table is full
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.1.1.1", "10.2.2.1", createRequestType, 0, 5, createRequest, sizeof(createRequest), startTime + 10));
+	session = gtpSessionTableTestProcess(table, "10.2.2.1", "10.1.1.1", createResponseType, 0x2001, 5, createResponse, sizeof(createResponse), startTime + 10);
+	PTF_ASSERT_NOT_NULL(session);
+	uint64_t secondSessionId = session->sessionId;
+	PTF_ASSERT_TRUE(secondSessionId != firstSessionId);
+
+	uint8_t otherCreateResponse[sizeof(createResponse)];
+	memcpy(otherCreateResponse, createResponse, sizeof(createResponse));
+	otherCreateResponse[6] = 0x02;
+	otherCreateResponse[11] = 0x02;
+	uint8_t otherCreateRequest[sizeof(createRequest)];
+	memcpy(otherCreateRequest, createRequest, sizeof(createRequest));
+	otherCreateRequest[13] = 0x03;
+	otherCreateRequest[18] = 0x03;
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.1.1.1", "10.2.2.1", createRequestType, 0, 6, otherCreateRequest, sizeof(otherCreateRequest), startTime + 11));
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.2.2.1", "10.1.1.1", createResponseType, 0x2003, 6, otherCreateResponse, sizeof(otherCreateResponse), startTime + 11));
+	PTF_ASSERT_EQUAL((int)table.getNumOfRejectedSessions(), 1, int);
+	PTF_ASSERT_EQUAL(table.getNumOfSessions(), 1, size);
+
+	// a new session with the SGSN TEIDs of the second session replaces it
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.1.1.1", "10.2.2.1", createRequestType, 0, 7, createRequest, sizeof(createRequest), startTime + 12));
+	session = gtpSessionTableTestProcess(table, "10.2.2.1", "10.1.1.1", createResponseType, 0x2001, 7, otherCreateResponse, sizeof(otherCreateResponse), startTime + 12);
+	PTF_ASSERT_NOT_NULL(session);
+	PTF_ASSERT_EQUAL(session->ggsnUserPlane.teid, 0x3002, u32);
+	PTF_ASSERT_EQUAL(table.getNumOfSessions(), 1, size);
+	PTF_ASSERT_EQUAL(ended.size(), 2, size);
+	PTF_ASSERT_EQUAL((int)ended[1].first, (int)secondSessionId, int);
+	PTF_ASSERT_EQUAL(ended[1].second, GtpSessionReplaced, enum);
+	uint64_t thirdSessionId = session->sessionId;
+
+	// user plane activity postpones the timeout, although it doesn't move the timer
+	PTF_ASSERT_NOT_NULL(gtpSessionTableTestProcess(table, "10.1.1.2", "10.2.2.2", GtpV1_GPDU, 0x3002, 0, userData, 100, startTime + 50));
+	table.quiescentState(readerId);
+	table.setCurrentTime(startTime + 120);
+	PTF_ASSERT_EQUAL(table.getNumOfSessions(), 1, size);
+	table.setCurrentTime(startTime + 151);
+	PTF_ASSERT_EQUAL(table.getNumOfSessions(), 0, size);
+	PTF_ASSERT_EQUAL(ended.size(), 3, size);
+	PTF_ASSERT_EQUAL((int)ended[2].first, (int)thirdSessionId, int);
+	PTF_ASSERT_EQUAL(ended[2].second, GtpSessionTimedOut, enum);
+
+	// requests without a response time out
+	PTF_ASSERT_NULL(gtpSessionTableTestProcess(table, "10.1.1.1", "10.2.2.1", createRequestType, 0, 8, createRequest, sizeof(createRequest), startTime + 200));
+	PTF_ASSERT_EQUAL(table.getNumOfPendingRequests(), 1, size);
+	table.setCurrentTime(startTime + 220);
+	PTF_ASSERT_EQUAL(table.getNumOfPendingRequests(), 1, size);
+	table.setCurrentTime(startTime + 231);
+	PTF_ASSERT_EQUAL(table.getNumOfPendingRequests(), 0, size);
+
+	table.unregisterReader(readerId);
+	PTF_ASSERT_EQUAL(table.reclaim(), 0, size);
+} // GtpSessionTableTest
+
+
+static RawPacket* trafficShaperTestPacket(const char* srcIP, size_t len)
+{
+	EthLayer ethLayer(MacAddress("00:11:22:33:44:55"), MacAddress("66:77:88:99:aa:bb"));
+	IPv4Layer ipLayer(IPv4Address(std::string(srcIP)), IPv4Address(std::string("10.0.0.1")));
+	ipLayer.getIPv4Header()->timeToLive = 64;
+	UdpLayer udpLayer(1000, 2000);
+	uint8_t payload[1500];
+	memset(payload, 0, sizeof(payload));
+	PayloadLayer payloadLayer(payload, len - 42, false);
+
+	Packet packet(len);
+	packet.addLayer(&ethLayer);
+	packet.addLayer(&ipLayer);
+	packet.addLayer(&udpLayer);
+	packet.addLayer(&payloadLayer);
+	packet.computeCalculateFields();
+
+	uint8_t* data = new uint8_t[len];
+	memcpy(data, packet.getRawPacket()->getRawData(), len);
+	timespec timestamp = { 0, 0 };
+	return new RawPacket(data, (int)len, timestamp, true);
+}
+
+static timespec trafficShaperTestTime(uint64_t ns)
+{
+	timespec time;
+	time.tv_sec = (time_t)(ns / 1000000000ULL);
+	time.tv_nsec = (long)(ns % 1000000000ULL);
+	return time;
+}
+
+PTF_TEST_CASE(TrafficShaperTest)
+{
+	std::vector<TrafficShaperClass> classes;
+	TrafficShaperClass trafficClass;
+	RawPacket* packets[100];
+	std::vector<RawPacket*> flushed;
+	TrafficShaperClassStats stats;
+	const uint64_t startTime = 1000000000ULL;
+
+	// invalid configurations
+	LoggerPP::getInstance().supressErrors();
+	trafficClass.id = 1;
+	classes.push_back(trafficClass);
+	classes.push_back(trafficClass);
+	TrafficShaper duplicateIds(classes, 1);
+	PTF_ASSERT_FALSE(duplicateIds.isValid());
+	classes.pop_back();
+	TrafficShaper unknownDefault(classes, 2);
+	PTF_ASSERT_FALSE(unknownDefault.isValid());
+	RawPacket* packet = trafficShaperTestPacket("10.1.1.1", 100);
+	PTF_ASSERT_FALSE(unknownDefault.enqueue(packet));
+	delete packet;
+	trafficClass.weight = 0;
+	classes[0] = trafficClass;
+	TrafficShaper zeroWeight(classes, 1);
+	PTF_ASSERT_FALSE(zeroWeight.isValid());
+	LoggerPP::getInstance().enableErrors();
+
+	// strict priority: class 1 is always served before class 2, which is the default class
+	classes.clear();
+	trafficClass = TrafficShaperClass();
+	trafficClass.id = 1;
+	trafficClass.priority = 0;
+	classes.push_back(trafficClass);
+	trafficClass.id = 2;
+	trafficClass.priority = 1;
+	classes.push_back(trafficClass);
+	{
+		TrafficShaper shaper(classes, 2);
+		PTF_ASSERT_TRUE(shaper.isValid());
+		PTF_ASSERT_TRUE(shaper.getNextSendDelay(trafficShaperTestTime(startTime)) == TrafficShaper::NoPacketsQueued);
+
+		RawPacket* lowPriority[3];
+		RawPacket* highPriority[2];
+		for (int i = 0; i < 3; i++)
+		{
+			lowPriority[i] = trafficShaperTestPacket("10.1.1.1", 200);
+			PTF_ASSERT_TRUE(shaper.enqueue(lowPriority[i]));
+		}
+		for (int i = 0; i < 2; i++)
+		{
+			highPriority[i] = trafficShaperTestPacket("10.1.1.1", 200);
+			PTF_ASSERT_TRUE(shaper.enqueue(highPriority[i], 1));
+		}
+		PTF_ASSERT_EQUAL(shaper.getNumOfQueuedPackets(), 5, size);
+		PTF_ASSERT_EQUAL((int)shaper.getNextSendDelay(trafficShaperTestTime(startTime)), 0, int);
+
+		PTF_ASSERT_EQUAL(shaper.dequeue(trafficShaperTestTime(startTime), packets, 100), 5, size);
+		PTF_ASSERT_TRUE(packets[0] == highPriority[0]);
+		PTF_ASSERT_TRUE(packets[1] == highPriority[1]);
+		PTF_ASSERT_TRUE(packets[2] == lowPriority[0]);
+		PTF_ASSERT_TRUE(packets[3] == lowPriority[1]);
+		PTF_ASSERT_TRUE(packets[4] == lowPriority[2]);
+		PTF_ASSERT_EQUAL(shaper.getNumOfQueuedPackets(), 0, size);
+		for (int i = 0; i < 5; i++)
+			delete packets[i];
+
+		PTF_ASSERT_TRUE(shaper.getClassStats(1, stats));
+		PTF_ASSERT_EQUAL((int)stats.sentPackets, 2, int);
+		PTF_ASSERT_EQUAL((int)stats.sentBytes, 400, int);
+		PTF_ASSERT_EQUAL(stats.queuedPackets, 0, u32);
+		PTF_ASSERT_TRUE(shaper.getClassStats(2, stats));
+		PTF_ASSERT_EQUAL((int)stats.enqueuedPackets, 3, int);
+		PTF_ASSERT_EQUAL((int)stats.sentPackets, 3, int);
+		PTF_ASSERT_FALSE(shaper.getClassStats(3, stats));
+
+		// the classifier chooses the class, and packets which don't match any rule go to the default class
+		std::vector<ClassifierRule> rules;
+		ClassifierRule rule;
+		rule.id = 1;
+		rule.srcAddress = IPv4Address(std::string("10.1.0.0"));
+		rule.srcPrefixLen = 16;
+		rules.push_back(rule);
+		RuleClassifier classifier;
+		PTF_ASSERT_TRUE(classifier.setRules(rules));
+		shaper.setClassifier(&classifier);
+		PTF_ASSERT_TRUE(shaper.enqueue(trafficShaperTestPacket("10.2.1.1", 100)));
+		PTF_ASSERT_TRUE(shaper.enqueue(trafficShaperTestPacket("10.1.1.1", 100)));
+		PTF_ASSERT_TRUE(shaper.getClassStats(1, stats));
+		PTF_ASSERT_EQUAL(stats.queuedPackets, 1, u32);
+		PTF_ASSERT_EQUAL((int)stats.queuedBytes, 100, int);
+		PTF_ASSERT_TRUE(shaper.getClassStats(2, stats));
+		PTF_ASSERT_EQUAL(stats.queuedPackets, 1, u32);
+
+		// clearing the statistics keeps the queue counters
+		shaper.clearStats();
+		PTF_ASSERT_TRUE(shaper.getClassStats(2, stats));
+		PTF_ASSERT_EQUAL((int)stats.enqueuedPackets, 0, int);
+		PTF_ASSERT_EQUAL((int)stats.sentPackets, 0, int);
+		PTF_ASSERT_EQUAL(stats.queuedPackets, 1, u32);
+
+		shaper.flush(flushed);
+		PTF_ASSERT_EQUAL(flushed.size(), 2, size);
+		PTF_ASSERT_EQUAL(shaper.getNumOfQueuedPackets(), 0, size);
+		PTF_ASSERT_EQUAL(shaper.dequeue(trafficShaperTestTime(startTime), packets, 100), 0, size);
+		for (size_t i = 0; i < flushed.size(); i++)
+			delete flushed[i];
+		flushed.clear();
+	}
+
+	// weighted sharing: class 20 has 3 times the weight of class 10, and the queue of class 10 holds only 30 packets
+	classes.clear();
+	trafficClass = TrafficShaperClass();
+	trafficClass.id = 10;
+	trafficClass.weight = 1;
+	trafficClass.queueLimit = 30;
+	classes.push_back(trafficClass);
+	trafficClass.id = 20;
+	trafficClass.weight = 3;
+	trafficClass.queueLimit = 1024;
+	classes.push_back(trafficClass);
+	{
+		TrafficShaper shaper(classes, 10);
+		for (int i = 0; i < 30; i++)
+		{
+			PTF_ASSERT_TRUE(shaper.enqueue(trafficShaperTestPacket("10.1.1.1", 1000), 10));
+			PTF_ASSERT_TRUE(shaper.enqueue(trafficShaperTestPacket("10.1.1.1", 1000), 20));
+		}
+		packet = trafficShaperTestPacket("10.1.1.1", 1000);
+		PTF_ASSERT_FALSE(shaper.enqueue(packet, 10));
+		delete packet;
+		// packets of an unknown class go to the default class
+		packet = trafficShaperTestPacket("10.1.1.1", 1000);
+		PTF_ASSERT_FALSE(shaper.enqueue(packet, 30));
+		delete packet;
+		PTF_ASSERT_TRUE(shaper.getClassStats(10, stats));
+		PTF_ASSERT_EQUAL((int)stats.droppedPackets, 2, int);
+		PTF_ASSERT_EQUAL(stats.queuedPackets, 30, u32);
+
+		PTF_ASSERT_EQUAL(shaper.dequeue(trafficShaperTestTime(startTime), packets, 24), 24, size);
+		for (int i = 0; i < 24; i++)
+			delete packets[i];
+		TrafficShaperClassStats otherStats;
+		PTF_ASSERT_TRUE(shaper.getClassStats(10, stats));
+		PTF_ASSERT_TRUE(shaper.getClassStats(20, otherStats));
+		PTF_ASSERT_EQUAL((int)stats.sentPackets, 6, int);
+		PTF_ASSERT_EQUAL((int)otherStats.sentPackets, 18, int);
+
+		shaper.flush(flushed);
+		PTF_ASSERT_EQUAL(flushed.size(), 36, size);
+		for (size_t i = 0; i < flushed.size(); i++)
+			delete flushed[i];
+		flushed.clear();
+	}
+
+	// rate limiting: class 1 may send 100,000 bytes per second with a bucket of 2000 bytes, and class 2 isn't limited
+	classes.clear();
+	trafficClass = TrafficShaperClass();
+	trafficClass.id = 1;
+	trafficClass.rateBytesPerSec = 100000;
+	trafficClass.burstBytes = 2000;
+	classes.push_back(trafficClass);
+	trafficClass.id = 2;
+	trafficClass.rateBytesPerSec = 0;
+	trafficClass.burstBytes = 0;
+	classes.push_back(trafficClass);
+	{
+		TrafficShaper shaper(classes, 1);
+		for (int i = 0; i < 5; i++)
+			PTF_ASSERT_TRUE(shaper.enqueue(trafficShaperTestPacket("10.1.1.1", 1000)));
+
+		// the bucket starts full, so 2 packets are sent right away and the next one has to wait 10ms
+		PTF_ASSERT_EQUAL(shaper.dequeue(trafficShaperTestTime(startTime), packets, 100), 2, size);
+		delete packets[0];
+		delete packets[1];
+		PTF_ASSERT_EQUAL((int)shaper.getNextSendDelay(trafficShaperTestTime(startTime)), 10000000, int);
+		PTF_ASSERT_EQUAL(shaper.dequeue(trafficShaperTestTime(startTime + 5000000), packets, 100), 0, size);
+		PTF_ASSERT_EQUAL((int)shaper.getNextSendDelay(trafficShaperTestTime(startTime + 5000000)), 5000000, int);
+
+		// a class which is out of tokens doesn't hold back the other classes
+		RawPacket* unlimitedPacket = trafficShaperTestPacket("10.1.1.1", 1000);
+		PTF_ASSERT_TRUE(shaper.enqueue(unlimitedPacket, 2));
+		PTF_ASSERT_EQUAL((int)shaper.getNextSendDelay(trafficShaperTestTime(startTime + 5000000)), 0, int);
+		PTF_ASSERT_EQUAL(shaper.dequeue(trafficShaperTestTime(startTime + 5000000), packets, 100), 1, size);
+		PTF_ASSERT_TRUE(packets[0] == unlimitedPacket);
+		delete packets[0];
+
+		PTF_ASSERT_EQUAL(shaper.dequeue(trafficShaperTestTime(startTime + 10000000), packets, 100), 1, size);
+		delete packets[0];
+		PTF_ASSERT_EQUAL(shaper.dequeue(trafficShaperTestTime(startTime + 30000000), packets, 100), 2, size);
+		delete packets[0];
+		delete packets[1];
+		PTF_ASSERT_EQUAL(shaper.getNumOfQueuedPackets(), 0, size);
+
+		// the port rate limits all classes together
+		shaper.setPortRate(50000, 1000);
+		PTF_ASSERT_TRUE(shaper.setClassRate(1, 0));
+		PTF_ASSERT_FALSE(shaper.setClassRate(3, 0));
+		for (int i = 0; i < 2; i++)
+		{
+			PTF_ASSERT_TRUE(shaper.enqueue(trafficShaperTestPacket("10.1.1.1", 1000), 1));
+			PTF_ASSERT_TRUE(shaper.enqueue(trafficShaperTestPacket("10.1.1.1", 1000), 2));
+		}
+		PTF_ASSERT_EQUAL(shaper.dequeue(trafficShaperTestTime(startTime + 40000000), packets, 100), 1, size);
+		delete packets[0];
+		PTF_ASSERT_EQUAL((int)shaper.getNextSendDelay(trafficShaperTestTime(startTime + 40000000)), 20000000, int);
+		PTF_ASSERT_EQUAL(shaper.dequeue(trafficShaperTestTime(startTime + 60000000), packets, 100), 1, size);
+		delete packets[0];
+
+		shaper.flush(flushed);
+		PTF_ASSERT_EQUAL(flushed.size(), 2, size);
+		for (size_t i = 0; i < flushed.size(); i++)
+			delete flushed[i];
+		flushed.clear();
+	}
+} // TrafficShaperTest
+
+
+static RawPacket* captureCutoffTestPacket(const char* srcIP, const char* dstIP, uint16_t srcPort, uint16_t dstPort, bool isTcp, bool isSyn,
+		size_t payloadLen, time_t timestamp)
+{
+	EthLayer ethLayer(MacAddress("00:11:22:33:44:55"), MacAddress("66:77:88:99:aa:bb"));
+	IPv4Address srcAddr(srcIP);
+	IPv4Address dstAddr(dstIP);
+	IPv4Layer ipLayer(srcAddr, dstAddr);
+	ipLayer.getIPv4Header()->timeToLive = 64;
+	TcpLayer tcpLayer(srcPort, dstPort);
+	tcpLayer.getTcpHeader()->synFlag = (isSyn ? 1 : 0);
+	tcpLayer.getTcpHeader()->ackFlag = (isSyn ? 0 : 1);
+	UdpLayer udpLayer(srcPort, dstPort);
+	uint8_t payload[1500];
+	memset(payload, 0x42, sizeof(payload));
+	PayloadLayer payloadLayer(payload, payloadLen, false);
+
+	Packet packet(100);
+	packet.addLayer(&ethLayer);
+	packet.addLayer(&ipLayer);
+	if (isTcp)
+		packet.addLayer(&tcpLayer);
+	else
+		packet.addLayer(&udpLayer);
+	packet.addLayer(&payloadLayer);
+	packet.computeCalculateFields();
+
+	int len = packet.getRawPacket()->getRawDataLen();
+	uint8_t* data = new uint8_t[len];
+	memcpy(data, packet.getRawPacket()->getRawData(), len);
+	timespec ts = { timestamp, 0 };
+	return new RawPacket(data, len, ts, true);
+}
+
+PTF_TEST_CASE(CaptureCutoffTest)
+{
+	CaptureCutoffStats stats;
+
+	// flows are truncated after 1000 bytes, and DNS flows are exempt
+	CaptureCutoff cutoff(CaptureCutoffConfiguration(1000, 0, CutoffTruncate, 4, 30));
+	std::vector<ClassifierRule> rules;
+	ClassifierRule rule;
+	rule.id = 1;
+	rule.dstPortFrom = 53;
+	rule.dstPortTo = 53;
+	rules.push_back(rule);
+	RuleClassifier exemptions;
+	PTF_ASSERT_TRUE(exemptions.setRules(rules));
+	cutoff.setExemptions(&exemptions);
+
+	// both directions of a TCP flow share one budget: the first 3 packets (1362 bytes) start below the limit
+	RawPacket* packets[8];
+	packets[0] = captureCutoffTestPacket("10.0.0.1", "10.0.0.2", 40000, 80, true, true, 400, 100);
+	packets[1] = captureCutoffTestPacket("10.0.0.2", "10.0.0.1", 80, 40000, true, false, 400, 100);
+	packets[2] = captureCutoffTestPacket("10.0.0.1", "10.0.0.2", 40000, 80, true, false, 400, 101);
+	packets[3] = captureCutoffTestPacket("10.0.0.2", "10.0.0.1", 80, 40000, true, false, 400, 101);
+	packets[4] = captureCutoffTestPacket("10.0.0.1", "10.0.0.2", 40000, 80, true, false, 0, 101);
+	PTF_ASSERT_EQUAL(packets[0]->getRawDataLen(), 454, int);
+	PTF_ASSERT_EQUAL(cutoff.process(packets[0]), CutoffPacketKept, enum);
+	PTF_ASSERT_EQUAL(cutoff.process(packets[1]), CutoffPacketKept, enum);
+	PTF_ASSERT_EQUAL(cutoff.process(packets[2]), CutoffPacketKept, enum);
+	PTF_ASSERT_EQUAL(cutoff.getNumOfFlows(), 1, size);
+	PTF_ASSERT_EQUAL(packets[2]->getRawDataLen(), 454, int);
+
+	// past the cut-off the headers and 4 bytes of payload are kept, with the original frame length
+	PTF_ASSERT_EQUAL(cutoff.process(packets[3]), CutoffPacketTruncated, enum);
+	PTF_ASSERT_EQUAL(packets[3]->getRawDataLen(), 58, int);
+	PTF_ASSERT_EQUAL(packets[3]->getFrameLength(), 454, int);
+	Packet truncatedPacket(packets[3]);
+	PTF_ASSERT_TRUE(truncatedPacket.isPacketOfType(TCP));
+	PTF_ASSERT_EQUAL(truncatedPacket.getLayerOfType<TcpLayer>()->getSrcPort(), 80, u16);
+	// a packet without payload is only headers, so nothing is cut
+	PTF_ASSERT_EQUAL(cutoff.process(packets[4]), CutoffPacketTruncated, enum);
+	PTF_ASSERT_EQUAL(packets[4]->getRawDataLen(), 54, int);
+
+	// a SYN starts the flow over
+	packets[5] = captureCutoffTestPacket("10.0.0.1", "10.0.0.2", 40000, 80, true, true, 400, 102);
+	PTF_ASSERT_EQUAL(cutoff.process(packets[5]), CutoffPacketKept, enum);
+
+	// exempt flows are never cut, whichever direction is seen first
+	for (int i = 0; i < 5; i++)
+	{
+		RawPacket* dnsPacket = captureCutoffTestPacket("10.0.0.53", "10.0.0.1", 53, 5000, false, false, 500, 102);
+		PTF_ASSERT_EQUAL(cutoff.process(dnsPacket), CutoffPacketKept, enum);
+		PTF_ASSERT_EQUAL(dnsPacket->getRawDataLen(), 542, int);
+		delete dnsPacket;
+	}
+
+	// packets without an IP header are always kept
+	EthLayer ethLayer(MacAddress("00:11:22:33:44:55"), MacAddress("ff:ff:ff:ff:ff:ff"));
+	ArpLayer arpLayer(ARP_REQUEST, MacAddress("00:11:22:33:44:55"), MacAddress("00:00:00:00:00:00"), IPv4Address(std::string("10.0.0.1")),
+			IPv4Address(std::string("10.0.0.2")));
+	Packet arpPacket(100);
+	arpPacket.addLayer(&ethLayer);
+	arpPacket.addLayer(&arpLayer);
+	arpPacket.computeCalculateFields();
+	timespec arpTimestamp = { 102, 0 };
+	RawPacket arpRawPacket(arpPacket.getRawPacket()->getRawData(), arpPacket.getRawPacket()->getRawDataLen(), arpTimestamp, false);
+	PTF_ASSERT_EQUAL(cutoff.process(&arpRawPacket), CutoffPacketKept, enum);
+
+	// a flow idle longer than the timeout is forgotten and recorded in full again
+	packets[6] = captureCutoffTestPacket("10.0.0.2", "10.0.0.1", 80, 40000, true, false, 400, 102);
+	packets[7] = captureCutoffTestPacket("10.0.0.2", "10.0.0.1", 80, 40000, true, false, 400, 102);
+	PTF_ASSERT_EQUAL(cutoff.process(packets[6]), CutoffPacketKept, enum);
+	PTF_ASSERT_EQUAL(cutoff.process(packets[7]), CutoffPacketKept, enum);
+	PTF_ASSERT_EQUAL(cutoff.getNumOfFlows(), 2, size);
+	delete packets[7];
+	packets[7] = captureCutoffTestPacket("10.0.0.2", "10.0.0.1", 80, 40000, true, false, 400, 102);
+	PTF_ASSERT_EQUAL(cutoff.process(packets[7]), CutoffPacketTruncated, enum);
+	delete packets[7];
+	packets[7] = captureCutoffTestPacket("10.0.0.2", "10.0.0.1", 80, 40000, true, false, 400, 200);
+	PTF_ASSERT_EQUAL(cutoff.process(packets[7]), CutoffPacketKept, enum);
+
+	cutoff.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.packets, 16, int);
+	PTF_ASSERT_EQUAL((int)stats.keptPackets, 13, int);
+	PTF_ASSERT_EQUAL((int)stats.truncatedPackets, 3, int);
+	PTF_ASSERT_EQUAL((int)stats.droppedPackets, 0, int);
+	PTF_ASSERT_EQUAL((int)stats.exemptPackets, 5, int);
+	PTF_ASSERT_EQUAL((int)stats.nonIpPackets, 1, int);
+	PTF_ASSERT_EQUAL((int)stats.bytes - (int)stats.outputBytes, 396 + 396, int);
+
+	for (int i = 0; i < 8; i++)
+		delete packets[i];
+
+	// in drop mode a burst is reordered so the packets to record come first
+	CaptureCutoff dropCutoff(CaptureCutoffConfiguration(0, 2, CutoffDrop));
+	for (int i = 0; i < 6; i++)
+		packets[i] = captureCutoffTestPacket("10.0.0.1", "10.0.0.2", 40000 + (i % 2), 80, false, false, 100, 100);
+	RawPacket* original[6];
+	memcpy(original, packets, sizeof(original));
+	PTF_ASSERT_EQUAL(dropCutoff.filterBurst(packets, 6), 4, int);
+	PTF_ASSERT_TRUE(packets[0] == original[0]);
+	PTF_ASSERT_TRUE(packets[1] == original[1]);
+	PTF_ASSERT_TRUE(packets[2] == original[2]);
+	PTF_ASSERT_TRUE(packets[3] == original[3]);
+	PTF_ASSERT_EQUAL(packets[4]->getRawDataLen(), 142, int);
+	dropCutoff.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.droppedPackets, 2, int);
+	PTF_ASSERT_EQUAL(dropCutoff.getNumOfFlows(), 2, size);
+
+	// clearing forgets the flows
+	dropCutoff.clear();
+	PTF_ASSERT_EQUAL(dropCutoff.getNumOfFlows(), 0, size);
+	PTF_ASSERT_EQUAL(dropCutoff.process(packets[4]), CutoffPacketKept, enum);
+
+	for (int i = 0; i < 6; i++)
+		delete packets[i];
+} // CaptureCutoffTest
+
+
+static void macLearningTestFrame(uint8_t* frame, const char* dstMac, const char* srcMac, int vlanId)
+{
+	memset(frame, 0, 64);
+	MacAddress(dstMac).copyTo(frame);
+	MacAddress(srcMac).copyTo(frame + 6);
+	if (vlanId < 0)
+	{
+		frame[12] = 0x08;
+		return;
+	}
+
+	frame[12] = 0x81;
+	frame[14] = (uint8_t)(vlanId >> 8);
+	frame[15] = (uint8_t)(vlanId & 0xff);
+	frame[16] = 0x08;
+}
+
+struct MacLearningTestWorkerArgs
+{
+	MacLearningTable* table;
+	uint16_t port;
+	int numOfMisses;
+};
+
+static void* macLearningTestWorkerMain(void* cookie)
+{
+	MacLearningTestWorkerArgs* args = (MacLearningTestWorkerArgs*)cookie;
+	uint8_t mac[6] = { 0x02, 0, 0, 0, 0, 0 };
+	mac[1] = (uint8_t)args->port;
+	for (int round = 0; round < 10; round++)
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			mac[4] = (uint8_t)(i >> 8);
+			mac[5] = (uint8_t)(i & 0xff);
+			args->table->learn(MacAddress(mac), 0, args->port, 1000 + round);
+			if (args->table->lookup(MacAddress(mac), 0, 1000 + round) != args->port)
+				args->numOfMisses++;
+		}
+	}
+
+	return NULL;
+}
+
+PTF_TEST_CASE(MacLearningTableTest)
+{
+	MacLearningTable table(1000, 300);
+	PTF_ASSERT_TRUE(table.getCapacity() >= 2000);
+	MacLearningTableStats stats;
+	uint8_t frame[64];
+	const uint32_t now = 100000;
+
+	// an unknown destination is flooded, and the source is learned
+	macLearningTestFrame(frame, "00:00:00:00:00:02", "00:00:00:00:00:01", -1);
+	PTF_ASSERT_EQUAL(table.switchFrame(frame, 64, 1, now), MacLearningTable::FloodPort, u16);
+	PTF_ASSERT_EQUAL(table.getNumOfEntries(), 1, size);
+	PTF_ASSERT_EQUAL(table.lookup(MacAddress("00:00:00:00:00:01"), 0, now), 1, u16);
+
+	// the reply goes to the learned port, and frames to a station on the port they came from are filtered
+	macLearningTestFrame(frame, "00:00:00:00:00:01", "00:00:00:00:00:02", -1);
+	PTF_ASSERT_EQUAL(table.switchFrame(frame, 64, 2, now), 1, u16);
+	macLearningTestFrame(frame, "00:00:00:00:00:02", "00:00:00:00:00:01", -1);
+	PTF_ASSERT_EQUAL(table.switchFrame(frame, 64, 1, now), 2, u16);
+	macLearningTestFrame(frame, "00:00:00:00:00:02", "00:00:00:00:00:03", -1);
+	PTF_ASSERT_EQUAL(table.switchFrame(frame, 64, 2, now), MacLearningTable::DropPort, u16);
+
+	// broadcast and multicast destinations are flooded, multicast sources and short frames are dropped
+	macLearningTestFrame(frame, "ff:ff:ff:ff:ff:ff", "00:00:00:00:00:01", -1);
+	PTF_ASSERT_EQUAL(table.switchFrame(frame, 64, 1, now), MacLearningTable::FloodPort, u16);
+	macLearningTestFrame(frame, "01:00:5e:00:00:01", "00:00:00:00:00:01", -1);
+	PTF_ASSERT_EQUAL(table.switchFrame(frame, 64, 1, now), MacLearningTable::FloodPort, u16);
+	macLearningTestFrame(frame, "00:00:00:00:00:01", "01:00:5e:00:00:01", -1);
+	PTF_ASSERT_EQUAL(table.switchFrame(frame, 64, 2, now), MacLearningTable::DropPort, u16);
+	PTF_ASSERT_EQUAL(table.switchFrame(frame, 13, 2, now), MacLearningTable::DropPort, u16);
+	PTF_ASSERT_EQUAL(table.getNumOfEntries(), 3, size);
+
+	// VLANs are separate address spaces
+	macLearningTestFrame(frame, "00:00:00:00:00:02", "00:00:00:00:00:01", 10);
+	PTF_ASSERT_EQUAL(table.switchFrame(frame, 64, 3, now), MacLearningTable::FloodPort, u16);
+	PTF_ASSERT_EQUAL(table.lookup(MacAddress("00:00:00:00:00:01"), 10, now), 3, u16);
+	PTF_ASSERT_EQUAL(table.lookup(MacAddress("00:00:00:00:00:01"), 0, now), 1, u16);
+	PTF_ASSERT_EQUAL(table.lookup(MacAddress("00:00:00:00:00:01"), 20, now), MacLearningTable::FloodPort, u16);
+
+	// a station which moved is learned on its new port
+	table.learn(MacAddress("00:00:00:00:00:01"), 0, 4, now + 1);
+	PTF_ASSERT_EQUAL(table.lookup(MacAddress("00:00:00:00:00:01"), 0, now + 1), 4, u16);
+	table.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.learnedEntries, 4, int);
+	PTF_ASSERT_EQUAL((int)stats.movedEntries, 1, int);
+
+	// bursts of raw packets
+	RawPacket* packets[3];
+	const char* srcMacs[3] = { "00:00:00:00:00:01", "00:00:00:00:00:02", "00:00:00:00:00:05" };
+	for (int i = 0; i < 3; i++)
+	{
+		uint8_t* data = new uint8_t[64];
+		macLearningTestFrame(data, "00:00:00:00:00:03", srcMacs[i], -1);
+		timespec timestamp = { 0, 0 };
+		packets[i] = new RawPacket(data, 64, timestamp, true);
+	}
+	uint16_t outPorts[3];
+	table.switchBurst(packets, 3, 5, now + 2, outPorts);
+	PTF_ASSERT_EQUAL(outPorts[0], 2, u16);
+	PTF_ASSERT_EQUAL(outPorts[1], 2, u16);
+	PTF_ASSERT_EQUAL(outPorts[2], 2, u16);
+	PTF_ASSERT_EQUAL(table.lookup(MacAddress("00:00:00:00:00:05"), 0, now + 2), 5, u16);
+	PTF_ASSERT_EQUAL(table.lookup(MacAddress("00:00:00:00:00:02"), 0, now + 2), 5, u16);
+	for (int i = 0; i < 3; i++)
+		delete packets[i];
+
+	// entries which weren't seen for longer than the aging time are ignored, then removed
+	table.learn(MacAddress("00:00:00:00:00:05"), 0, 5, now + 200);
+	PTF_ASSERT_EQUAL(table.lookup(MacAddress("00:00:00:00:00:03"), 0, now + 300), 2, u16);
+	PTF_ASSERT_EQUAL(table.lookup(MacAddress("00:00:00:00:00:03"), 0, now + 301), MacLearningTable::FloodPort, u16);
+	PTF_ASSERT_EQUAL(table.getNumOfEntries(), 5, size);
+	PTF_ASSERT_EQUAL(table.age(now + 400), 4, size);
+	PTF_ASSERT_EQUAL(table.getNumOfEntries(), 1, size);
+	PTF_ASSERT_EQUAL(table.lookup(MacAddress("00:00:00:00:00:05"), 0, now + 400), 5, u16);
+
+	// removing the entries of a port
+	table.learn(MacAddress("00:00:00:00:00:06"), 0, 6, now + 400);
+	table.learn(MacAddress("00:00:00:00:00:07"), 0, 6, now + 400);
+	PTF_ASSERT_EQUAL(table.flushPort(6), 2, size);
+	PTF_ASSERT_EQUAL(table.lookup(MacAddress("00:00:00:00:00:06"), 0, now + 400), MacLearningTable::FloodPort, u16);
+	table.clear();
+	PTF_ASSERT_EQUAL(table.getNumOfEntries(), 0, size);
+
+	// a full bucket replaces its least recently seen entry
+	MacLearningTable smallTable(4);
+	PTF_ASSERT_EQUAL(smallTable.getCapacity(), PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE, size);
+	uint8_t mac[6] = { 0x02, 0, 0, 0, 0, 0 };
+	for (int i = 0; i < PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE; i++)
+	{
+		mac[5] = (uint8_t)i;
+		smallTable.learn(MacAddress(mac), 0, 1, now + (i == 3 ? 0 : 10));
+	}
+	mac[5] = 100;
+	smallTable.learn(MacAddress(mac), 0, 2, now + 20);
+	PTF_ASSERT_EQUAL(smallTable.getNumOfEntries(), PCPP_MAC_LEARNING_TABLE_BUCKET_SIZE, size);
+	PTF_ASSERT_EQUAL(smallTable.lookup(MacAddress(mac), 0, now + 20), 2, u16);
+	mac[5] = 3;
+	PTF_ASSERT_EQUAL(smallTable.lookup(MacAddress(mac), 0, now + 20), MacLearningTable::FloodPort, u16);
+	smallTable.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.evictedEntries, 1, int);
+
+	// workers learn and look up their own stations concurrently
+	MacLearningTable sharedTable(16384);
+	pthread_t threads[4];
+	MacLearningTestWorkerArgs args[4];
+	for (int i = 0; i < 4; i++)
+	{
+		args[i].table = &sharedTable;
+		args[i].port = (uint16_t)i;
+		args[i].numOfMisses = 0;
+		PTF_ASSERT_EQUAL(pthread_create(&threads[i], NULL, macLearningTestWorkerMain, &args[i]), 0, int);
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		pthread_join(threads[i], NULL);
+		PTF_ASSERT_EQUAL(args[i].numOfMisses, 0, int);
+	}
+	PTF_ASSERT_EQUAL(sharedTable.getNumOfEntries(), 4000, size);
+	sharedTable.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.learnedEntries, 4000, int);
+	PTF_ASSERT_EQUAL((int)stats.evictedEntries, 0, int);
+} // MacLearningTableTest
+
+PTF_TEST_CASE(DomainMatcherTest)
+{
+	DomainMatcher matcher;
+	PTF_ASSERT_EQUAL(matcher.match("www.example.com"), DomainMatcher::NoMatch, u32);
+
+	std::vector<DomainRule> rules;
+	rules.push_back(DomainRule("example.com", 1));
+	rules.push_back(DomainRule("ads.example.com", 2));
+	rules.push_back(DomainRule("exact.org", 3, DomainMatchExact));
+	rules.push_back(DomainRule("*.wild.net", 4));
+	rules.push_back(DomainRule("Tracker.IO.", 5));
+	PTF_ASSERT_TRUE(matcher.setRules(rules));
+	PTF_ASSERT_EQUAL(matcher.getNumOfDomains(), 5, size);
+	PTF_ASSERT_TRUE(matcher.getMemoryUsage() > 0);
+
+	// suffix rules match the domain and its subdomains, the longest matching domain wins
+	PTF_ASSERT_EQUAL(matcher.match("example.com"), 1, u32);
+	PTF_ASSERT_EQUAL(matcher.match("www.example.com"), 1, u32);
+	PTF_ASSERT_EQUAL(matcher.match("ads.example.com"), 2, u32);
+	PTF_ASSERT_EQUAL(matcher.match("x.y.ads.example.com"), 2, u32);
+	PTF_ASSERT_EQUAL(matcher.match("badexample.com"), DomainMatcher::NoMatch, u32);
+	PTF_ASSERT_EQUAL(matcher.match("com"), DomainMatcher::NoMatch, u32);
+
+	// exact and wildcard rules
+	PTF_ASSERT_EQUAL(matcher.match("exact.org"), 3, u32);
+	PTF_ASSERT_EQUAL(matcher.match("www.exact.org"), DomainMatcher::NoMatch, u32);
+	PTF_ASSERT_EQUAL(matcher.match("wild.net"), DomainMatcher::NoMatch, u32);
+	PTF_ASSERT_EQUAL(matcher.match("a.wild.net"), 4, u32);
+	PTF_ASSERT_EQUAL(matcher.match("a.b.wild.net"), 4, u32);
+
+	// case and the trailing dot are ignored, invalid names don't match
+	PTF_ASSERT_EQUAL(matcher.match("WWW.Tracker.io"), 5, u32);
+	PTF_ASSERT_EQUAL(matcher.match("www.EXAMPLE.com."), 1, u32);
+	PTF_ASSERT_EQUAL(matcher.match(""), DomainMatcher::NoMatch, u32);
+	PTF_ASSERT_EQUAL(matcher.match("www..example.com"), DomainMatcher::NoMatch, u32);
+	PTF_ASSERT_EQUAL(matcher.match(std::string(64, 'a') + ".example.com"), DomainMatcher::NoMatch, u32);
+
+	std::string names[4] = { "ads.example.com", "exact.org", "unknown.com", "b.wild.net" };
+	uint32_t ids[4];
+	matcher.matchBatch(names, 4, ids);
+	PTF_ASSERT_EQUAL(ids[0], 2, u32);
+	PTF_ASSERT_EQUAL(ids[1], 3, u32);
+	PTF_ASSERT_EQUAL(ids[2], DomainMatcher::NoMatch, u32);
+	PTF_ASSERT_EQUAL(ids[3], 4, u32);
+
+	// wire format names, with a compression pointer to a name at offset 2
+	const uint8_t message[] = {
+		0, 0,
+		7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+		3, 'A', 'd', 's', 0xc0, 2,
+		3, 'f', 'o', 'o', 0xc0, 15,
+		0xc0, 27 };
+	PTF_ASSERT_EQUAL(matcher.matchWireName(message, sizeof(message), 2), 1, u32);
+	PTF_ASSERT_EQUAL(matcher.matchWireName(message, sizeof(message), 15), 2, u32);
+	PTF_ASSERT_EQUAL(matcher.matchWireName(message, sizeof(message), 21), 2, u32);
+	// a pointer loop and a name running past the message
+	PTF_ASSERT_EQUAL(matcher.matchWireName(message, sizeof(message), 27), DomainMatcher::NoMatch, u32);
+	PTF_ASSERT_EQUAL(matcher.matchWireName(message, 10, 2), DomainMatcher::NoMatch, u32);
+
+	// names of DNS, TLS and HTTP layers
+	DnsLayer dnsLayer;
+	dnsLayer.addQuery("www.google.com", DNS_TYPE_A, DNS_CLASS_IN);
+	PTF_ASSERT_EQUAL(matcher.matchDns(dnsLayer), DomainMatcher::NoMatch, u32);
+	dnsLayer.addQuery("cdn.ads.example.com", DNS_TYPE_A, DNS_CLASS_IN);
+	PTF_ASSERT_EQUAL(matcher.matchDns(dnsLayer), 2, u32);
+
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/SSL-ClientHello1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	timeval time;
+	gettimeofday(&time, NULL);
+	RawPacket sslRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet sslPacket(&sslRawPacket);
+	SSLHandshakeLayer* handshakeLayer = sslPacket.getLayerOfType<SSLHandshakeLayer>();
+	PTF_ASSERT_NOT_NULL(handshakeLayer);
+	PTF_ASSERT_EQUAL(matcher.matchSni(*handshakeLayer), DomainMatcher::NoMatch, u32);
+
+	buffer = readFileIntoBuffer("PacketExamples/TwoHttpRequests1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	RawPacket httpRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet httpPacket(&httpRawPacket);
+	HttpRequestLayer* httpLayer = httpPacket.getLayerOfType<HttpRequestLayer>();
+	PTF_ASSERT_NOT_NULL(httpLayer);
+	PTF_ASSERT_EQUAL(matcher.matchHttpHost(*httpLayer), DomainMatcher::NoMatch, u32);
+
+	rules.push_back(DomainRule("google.com", 6));
+	rules.push_back(DomainRule("co.il", 7));
+	rules.push_back(DomainRule("", 8));
+	// an invalid domain fails the whole list and keeps the current one
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(matcher.setRules(rules));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL(matcher.getNumOfDomains(), 5, size);
+	rules.pop_back();
+
+	// replacing the list while a reader is registered keeps the old list until the reader passes a quiescent state
+	int readerId = matcher.registerReader();
+	PTF_ASSERT_TRUE(readerId >= 0);
+	PTF_ASSERT_TRUE(matcher.setRules(rules));
+	PTF_ASSERT_EQUAL(matcher.reclaim(), 1, size);
+	matcher.quiescentState(readerId);
+	PTF_ASSERT_EQUAL(matcher.reclaim(), 0, size);
+	matcher.unregisterReader(readerId);
+
+	PTF_ASSERT_EQUAL(matcher.getNumOfDomains(), 7, size);
+	PTF_ASSERT_EQUAL(matcher.matchSni(*handshakeLayer), 6, u32);
+	PTF_ASSERT_EQUAL(matcher.matchHttpHost(*httpLayer), 7, u32);
+	httpLayer->getFieldByName(PCPP_HTTP_HOST_FIELD)->setFieldValue("www.ynet.co.il:8080");
+	PTF_ASSERT_EQUAL(matcher.matchHttpHost(*httpLayer), 7, u32);
+	httpLayer->getFieldByName(PCPP_HTTP_HOST_FIELD)->setFieldValue("[::1]:8080");
+	PTF_ASSERT_EQUAL(matcher.matchHttpHost(*httpLayer), DomainMatcher::NoMatch, u32);
+
+	matcher.clearRules();
+	PTF_ASSERT_EQUAL(matcher.getNumOfDomains(), 0, size);
+	PTF_ASSERT_EQUAL(matcher.match("www.example.com"), DomainMatcher::NoMatch, u32);
+} // DomainMatcherTest
+
+struct HeavyHitterBypassTestState
+{
+	bool accept;
+	int numOfPromotions;
+	int numOfEnds;
+	BypassEndReason lastEndReason;
+	int lastRuleId;
+	uint64_t lastPackets;
+};
+
+static bool heavyHitterBypassTestOnPromoted(const FlowTuple& tuple, BypassedFlow& flow, void* userCookie)
+{
+	HeavyHitterBypassTestState* state = (HeavyHitterBypassTestState*)userCookie;
+	state->numOfPromotions++;
+	flow.offloadRuleId = 7;
+	return state->accept;
+}
+
+static void heavyHitterBypassTestOnEnded(const FlowTuple& tuple, const BypassedFlow& flow, BypassEndReason reason, void* userCookie)
+{
+	HeavyHitterBypassTestState* state = (HeavyHitterBypassTestState*)userCookie;
+	state->numOfEnds++;
+	state->lastEndReason = reason;
+	state->lastRuleId = flow.offloadRuleId;
+	state->lastPackets = flow.packets;
+}
+
+PTF_TEST_CASE(HeavyHitterBypassTest)
+{
+	uint8_t forward[256], reverse[256], light[256], tcpData[256], tcpFin[256];
+	size_t forwardLen, reverseLen, lightLen, tcpDataLen, tcpFinLen;
+	flowMeterTestPacket(forward, forwardLen, 4, "10.0.0.1", "10.0.0.2", 1000, 2000, false, 0, 0, 100);
+	flowMeterTestPacket(reverse, reverseLen, 4, "10.0.0.2", "10.0.0.1", 2000, 1000, false, 0, 0, 100);
+	flowMeterTestPacket(light, lightLen, 4, "10.0.0.3", "10.0.0.4", 3000, 4000, false, 0, 0, 100);
+	flowMeterTestPacket(tcpData, tcpDataLen, 6, "2001:db8::1", "2001:db8::2", 5000, 80, true, 0x10, 0, 100);
+	flowMeterTestPacket(tcpFin, tcpFinLen, 6, "2001:db8::2", "2001:db8::1", 80, 5000, true, 0x11, 0, 0);
+	PTF_ASSERT_EQUAL(forwardLen, reverseLen, size);
+
+	HeavyHitterBypassTestState state;
+	memset(&state, 0, sizeof(state));
+	state.accept = true;
+	state.lastRuleId = -1;
+
+	// a flow is promoted by the packet which brings both of its directions to the threshold, and its next packets are bypassed
+	HeavyHitterBypass bypass(HeavyHitterBypassConfiguration(forwardLen * 8, 1, 5, 0, 1024, 4, true), heavyHitterBypassTestOnPromoted,
+			heavyHitterBypassTestOnEnded, &state);
+	for (int i = 0; i < 8; i++)
+	{
+		PTF_ASSERT_FALSE(bypass.process(i % 2 == 0 ? forward : reverse, forwardLen, LINKTYPE_ETHERNET, 10));
+	}
+	PTF_ASSERT_EQUAL(state.numOfPromotions, 1, int);
+	PTF_ASSERT_EQUAL(bypass.getNumOfBypassedFlows(), 1, size);
+	PTF_ASSERT_TRUE(bypass.process(reverse, reverseLen, LINKTYPE_ETHERNET, 10));
+	PTF_ASSERT_TRUE(bypass.process(forward, forwardLen, LINKTYPE_ETHERNET, 11));
+	PTF_ASSERT_FALSE(bypass.process(light, lightLen, LINKTYPE_ETHERNET, 11));
+
+	PacketView view;
+	FlowTuple forwardTuple, lightTuple;
+	PTF_ASSERT_TRUE(FlowKeyExtractor::extract(forward, forwardLen, LINKTYPE_ETHERNET, view));
+	PTF_ASSERT_TRUE(FlowHash::getTuple(view, forwardTuple));
+	PTF_ASSERT_TRUE(FlowKeyExtractor::extract(light, lightLen, LINKTYPE_ETHERNET, view));
+	PTF_ASSERT_TRUE(FlowHash::getTuple(view, lightTuple));
+	const BypassedFlow* flow = bypass.getBypassedFlow(forwardTuple);
+	PTF_ASSERT_NOT_NULL(flow);
+	PTF_ASSERT_EQUAL((int)flow->packets, 2, int);
+	PTF_ASSERT_EQUAL((size_t)flow->bytes, forwardLen * 2, size);
+	PTF_ASSERT_EQUAL((int)flow->bypassTime, 10, int);
+	PTF_ASSERT_TRUE(flow->estimatedBytes >= forwardLen * 8);
+	PTF_ASSERT_EQUAL(flow->offloadRuleId, 7, int);
+	PTF_ASSERT_NULL(bypass.getBypassedFlow(lightTuple));
+
+	// packets which aren't IP don't belong to any flow
+	uint8_t arpPacket[60];
+	memset(arpPacket, 0, sizeof(arpPacket));
+	arpPacket[12] = 0x08;
+	arpPacket[13] = 0x06;
+	PTF_ASSERT_FALSE(bypass.process(arpPacket, sizeof(arpPacket), LINKTYPE_ETHERNET, 11));
+
+	// an idle flow stops being bypassed
+	PTF_ASSERT_FALSE(bypass.process(light, lightLen, LINKTYPE_ETHERNET, 20));
+	PTF_ASSERT_EQUAL(bypass.getNumOfBypassedFlows(), 0, size);
+	PTF_ASSERT_EQUAL(state.numOfEnds, 1, int);
+	PTF_ASSERT_EQUAL(state.lastEndReason, BypassEndedByIdleTimeout, enum);
+	PTF_ASSERT_EQUAL(state.lastRuleId, 7, int);
+	PTF_ASSERT_EQUAL((int)state.lastPackets, 2, int);
+	PTF_ASSERT_FALSE(bypass.process(forward, forwardLen, LINKTYPE_ETHERNET, 20));
+
+	// flows bypassed by the user, in either direction
+	PTF_ASSERT_TRUE(bypass.addBypass(lightTuple, 3));
+	PTF_ASSERT_FALSE(bypass.addBypass(lightTuple));
+	PTF_ASSERT_TRUE(bypass.process(light, lightLen, LINKTYPE_ETHERNET, 20));
+	PTF_ASSERT_TRUE(bypass.removeBypass(lightTuple));
+	PTF_ASSERT_FALSE(bypass.removeBypass(lightTuple));
+	PTF_ASSERT_EQUAL(state.lastEndReason, BypassEndedByUser, enum);
+	PTF_ASSERT_EQUAL(state.lastRuleId, 3, int);
+	PTF_ASSERT_FALSE(bypass.process(light, lightLen, LINKTYPE_ETHERNET, 20));
+
+	// a TCP FIN is bypassed but ends the bypass of its connection. The IPv6 packets are longer, so fewer of them reach the threshold
+	for (int i = 0; i < 7; i++)
+	{
+		PTF_ASSERT_FALSE(bypass.process(tcpData, tcpDataLen, LINKTYPE_ETHERNET, 30));
+	}
+	PTF_ASSERT_EQUAL(bypass.getNumOfBypassedFlows(), 1, size);
+	PTF_ASSERT_TRUE(bypass.process(tcpData, tcpDataLen, LINKTYPE_ETHERNET, 30));
+	PTF_ASSERT_TRUE(bypass.process(tcpFin, tcpFinLen, LINKTYPE_ETHERNET, 30));
+	PTF_ASSERT_EQUAL(bypass.getNumOfBypassedFlows(), 0, size);
+	PTF_ASSERT_EQUAL(state.lastEndReason, BypassEndedByTcpClose, enum);
+	PTF_ASSERT_EQUAL((int)state.lastPackets, 2, int);
+	PTF_ASSERT_FALSE(bypass.process(tcpData, tcpDataLen, LINKTYPE_ETHERNET, 30));
+
+	HeavyHitterBypassStats stats;
+	bypass.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.packets, 26, int);
+	PTF_ASSERT_EQUAL((int)stats.bypassedPackets, 5, int);
+	PTF_ASSERT_EQUAL((int)stats.nonFlowPackets, 1, int);
+	PTF_ASSERT_EQUAL((int)stats.promotions, 3, int);
+	PTF_ASSERT_EQUAL((int)stats.refusedPromotions, 0, int);
+	PTF_ASSERT_EQUAL((int)stats.bypassEnds, 3, int);
+
+	// a refused flow isn't offered again until the next window
+	memset(&state, 0, sizeof(state));
+	HeavyHitterBypass refusingBypass(HeavyHitterBypassConfiguration(forwardLen * 2), heavyHitterBypassTestOnPromoted, NULL, &state);
+	for (int i = 0; i < 5; i++)
+	{
+		PTF_ASSERT_FALSE(refusingBypass.process(forward, forwardLen, LINKTYPE_ETHERNET, 10));
+	}
+	PTF_ASSERT_EQUAL(state.numOfPromotions, 1, int);
+	PTF_ASSERT_FALSE(refusingBypass.process(forward, forwardLen, LINKTYPE_ETHERNET, 11));
+	PTF_ASSERT_FALSE(refusingBypass.process(forward, forwardLen, LINKTYPE_ETHERNET, 11));
+	PTF_ASSERT_EQUAL(state.numOfPromotions, 2, int);
+	refusingBypass.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.refusedPromotions, 2, int);
+	PTF_ASSERT_EQUAL(refusingBypass.getNumOfBypassedFlows(), 0, size);
+
+	// a burst is reordered so the packets to process come first
+	HeavyHitterBypass burstBypass(HeavyHitterBypassConfiguration(forwardLen * 2));
+	timeval tv = { 1, 0 };
+	RawPacket rawForward(forward, (int)forwardLen, tv, false);
+	RawPacket rawReverse(reverse, (int)reverseLen, tv, false);
+	RawPacket rawLight(light, (int)lightLen, tv, false);
+	RawPacket rawForward2(forward, (int)forwardLen, tv, false);
+	RawPacket* burst[4] = { &rawForward, &rawReverse, &rawLight, &rawForward2 };
+	PTF_ASSERT_EQUAL(burstBypass.filterBurst(burst, 4), 3, int);
+	PTF_ASSERT_TRUE(burst[0] == &rawForward);
+	PTF_ASSERT_TRUE(burst[1] == &rawReverse);
+	PTF_ASSERT_TRUE(burst[2] == &rawLight);
+	PTF_ASSERT_TRUE(burst[3] == &rawForward2);
+
+	burstBypass.clear();
+	PTF_ASSERT_EQUAL(burstBypass.getNumOfBypassedFlows(), 0, size);
+	PTF_ASSERT_FALSE(burstBypass.process(&rawForward));
+} // HeavyHitterBypassTest
+
+struct ClusterDistributorTestState
+{
+	int numOfBatches;
+	std::vector<uint32_t> nodeIds;
+	std::vector<std::vector<uint8_t> > packets;
+};
+
+static void clusterDistributorTestOnBatch(const ClusterNode& node, RawPacket* packets, uint32_t numOfPackets, void* userCookie)
+{
+	ClusterDistributorTestState* state = (ClusterDistributorTestState*)userCookie;
+	state->numOfBatches++;
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		state->nodeIds.push_back(node.nodeId);
+		state->packets.push_back(std::vector<uint8_t>(packets[i].getRawData(), packets[i].getRawData() + packets[i].getRawDataLen()));
+	}
+}
+
+PTF_TEST_CASE(ClusterDistributorTest)
+{
+	ClusterDistributorTestState state;
+	state.numOfBatches = 0;
+	ClusterDistributorConfiguration config(MacAddress("00:00:00:00:00:01"), IPv4Address(std::string("192.168.0.1")), 100);
+	config.batchSize = 4;
+	ClusterDistributor distributor(config, clusterDistributorTestOnBatch, &state);
+
+	// packets aren't distributed before the cluster has nodes
+	uint8_t buffer[256];
+	size_t len;
+	timeval tv = { 1, 0 };
+	flowMeterTestPacket(buffer, len, 4, "10.0.0.1", "10.0.0.2", 1000, 2000, false, 0, 0, 20);
+	RawPacket noNodePacket(buffer, (int)len, tv, false);
+	PTF_ASSERT_FALSE(distributor.distributePacket(&noNodePacket));
+	PTF_ASSERT_NULL(distributor.getNode(0));
+
+	for (uint32_t nodeId = 1; nodeId <= 3; nodeId++)
+	{
+		std::stringstream nodeIP;
+		nodeIP << "192.168.1." << nodeId;
+		PTF_ASSERT_TRUE(distributor.addNode(ClusterNode(nodeId, MacAddress("00:00:00:00:01:00"), IPv4Address(nodeIP.str()))));
+	}
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(distributor.addNode(ClusterNode(2, MacAddress("00:00:00:00:01:00"), IPv4Address(std::string("192.168.1.9")))));
+	PTF_ASSERT_FALSE(distributor.addNode(ClusterNode(9, MacAddress("00:00:00:00:01:00"), IPv4Address(std::string("192.168.1.9")), 0)));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL(distributor.getNumOfNodes(), 3, size);
+
+	// both directions of a flow go to the same node, and the flows are spread over all nodes
+	const int numOfFlows = 150;
+	std::vector<std::vector<uint8_t> > originals;
+	std::vector<uint32_t> flowNodes;
+	int flowsPerNode[4] = { 0, 0, 0, 0 };
+	for (int i = 0; i < numOfFlows; i++)
+	{
+		uint8_t reverse[256];
+		size_t reverseLen;
+		flowMeterTestPacket(buffer, len, 4, "10.0.0.1", "10.0.0.2", (uint16_t)(10000 + i), 80, true, 0x10, 0, 20);
+		flowMeterTestPacket(reverse, reverseLen, 4, "10.0.0.2", "10.0.0.1", 80, (uint16_t)(10000 + i), true, 0x10, 0, 30);
+		RawPacket forwardPacket(buffer, (int)len, tv, false);
+		RawPacket reversePacket(reverse, (int)reverseLen, tv, false);
+		uint32_t forwardHash = distributor.getFlowHash(&forwardPacket);
+		PTF_ASSERT_EQUAL(forwardHash, distributor.getFlowHash(&reversePacket), u32);
+
+		uint32_t nodeId = distributor.getNode(forwardHash)->nodeId;
+		flowNodes.push_back(nodeId);
+		flowsPerNode[nodeId]++;
+		RawPacket* burst[2] = { &forwardPacket, &reversePacket };
+		PTF_ASSERT_EQUAL(distributor.distributePackets(burst, 2), 2, size);
+		originals.push_back(std::vector<uint8_t>(buffer, buffer + len));
+		originals.push_back(std::vector<uint8_t>(reverse, reverse + reverseLen));
+	}
+	for (int nodeId = 1; nodeId <= 3; nodeId++)
+		PTF_ASSERT_TRUE(flowsPerNode[nodeId] > numOfFlows / 6);
+
+	// full batches were sent as they filled up, the rest are sent by flush()
+	PTF_ASSERT_EQUAL(state.packets.size(), (size_t)(state.numOfBatches * 4), size);
+	distributor.flush();
+	PTF_ASSERT_EQUAL(state.packets.size(), (size_t)(numOfFlows * 2), size);
+	ClusterDistributorStats stats;
+	distributor.getStats(stats);
+	PTF_ASSERT_EQUAL(stats.packets, (uint64_t)(numOfFlows * 2 + 1), u32);
+	PTF_ASSERT_EQUAL(stats.distributedPackets, (uint64_t)(numOfFlows * 2), u32);
+	PTF_ASSERT_EQUAL(stats.noNodePackets, 1, u32);
+	PTF_ASSERT_EQUAL(stats.batches, (uint64_t)state.numOfBatches, u32);
+
+	// each packet is a valid VXLAN packet to its node, and decapsulating it gives the original packet
+	std::map<std::vector<uint8_t>, uint32_t> packetNodes;
+	for (size_t i = 0; i < state.packets.size(); i++)
+	{
+		RawPacket outerPacket(&state.packets[i][0], (int)state.packets[i].size(), tv, false);
+		Packet parsedPacket(&outerPacket);
+		PTF_ASSERT_TRUE(parsedPacket.isPacketOfType(VXLAN));
+		IPv4Layer* ipLayer = parsedPacket.getLayerOfType<IPv4Layer>();
+		std::stringstream nodeIP;
+		nodeIP << "192.168.1." << state.nodeIds[i];
+		PTF_ASSERT_EQUAL(ipLayer->getDstIpAddress().toString(), nodeIP.str(), string);
+		uint16_t checksum = ipLayer->getIPv4Header()->headerChecksum;
+		ipLayer->computeCalculateFields();
+		PTF_ASSERT_EQUAL(ipLayer->getIPv4Header()->headerChecksum, checksum, u16);
+		PTF_ASSERT_EQUAL(parsedPacket.getLayerOfType<UdpLayer>()->getDstPort(), 4789, u16);
+		PTF_ASSERT_EQUAL(parsedPacket.getLayerOfType<VxlanLayer>()->getVNI(), 100, u32);
+
+		RawPacket innerPacket;
+		uint32_t vni = 0;
+		PTF_ASSERT_TRUE(ClusterDistributor::decapsulate(outerPacket, innerPacket, vni));
+		PTF_ASSERT_EQUAL(vni, 100, u32);
+		packetNodes[std::vector<uint8_t>(innerPacket.getRawData(), innerPacket.getRawData() + innerPacket.getRawDataLen())] = state.nodeIds[i];
+		PTF_ASSERT_FALSE(ClusterDistributor::decapsulate(outerPacket, innerPacket, vni, 4790));
+	}
+	for (size_t i = 0; i < originals.size(); i++)
+	{
+		PTF_ASSERT_TRUE(packetNodes.find(originals[i]) != packetNodes.end());
+		PTF_ASSERT_EQUAL(packetNodes[originals[i]], flowNodes[i / 2], u32);
+	}
+	RawPacket notDecapsulated;
+	uint32_t notDecapsulatedVni;
+	PTF_ASSERT_FALSE(ClusterDistributor::decapsulate(noNodePacket, notDecapsulated, notDecapsulatedVni));
+
+	// removing a node moves only its own flows, and adding a node moves flows only to it
+	PTF_ASSERT_TRUE(distributor.removeNode(2));
+	PTF_ASSERT_FALSE(distributor.removeNode(2));
+	PTF_ASSERT_TRUE(distributor.addNode(ClusterNode(4, MacAddress("00:00:00:00:01:00"), IPv4Address(std::string("192.168.1.4")))));
+	int numOfMoved = 0;
+	for (int i = 0; i < numOfFlows; i++)
+	{
+		flowMeterTestPacket(buffer, len, 4, "10.0.0.1", "10.0.0.2", (uint16_t)(10000 + i), 80, true, 0x10, 0, 20);
+		RawPacket packet(buffer, (int)len, tv, false);
+		uint32_t nodeId = distributor.getNode(distributor.getFlowHash(&packet))->nodeId;
+		if (flowNodes[i] == 2)
+		{
+			PTF_ASSERT_TRUE(nodeId != 2);
+		}
+		else if (nodeId != flowNodes[i])
+		{
+			PTF_ASSERT_EQUAL(nodeId, 4, u32);
+			numOfMoved++;
+		}
+	}
+	PTF_ASSERT_TRUE(numOfMoved > 0);
+	PTF_ASSERT_TRUE(numOfMoved < numOfFlows / 2);
+
+	// a tunneled packet is hashed by its inner flow
+	flowMeterTestPacket(buffer, len, 4, "10.0.0.1", "10.0.0.2", 10000, 80, true, 0x10, 0, 20);
+	RawPacket innerPacket(buffer, (int)len, tv, false);
+	Packet tunneledPacket(200);
+	EthLayer ethLayer(MacAddress("00:00:00:00:00:0a"), MacAddress("00:00:00:00:00:0b"), PCPP_ETHERTYPE_IP);
+	IPv4Layer ipLayer(IPv4Address(std::string("172.16.0.1")), IPv4Address(std::string("172.16.0.2")));
+	UdpLayer udpLayer(1234, 4789);
+	VxlanLayer vxlanLayer(5);
+	PayloadLayer innerLayer(buffer, len, false);
+	tunneledPacket.addLayer(&ethLayer);
+	tunneledPacket.addLayer(&ipLayer);
+	tunneledPacket.addLayer(&udpLayer);
+	tunneledPacket.addLayer(&vxlanLayer);
+	tunneledPacket.addLayer(&innerLayer);
+	tunneledPacket.computeCalculateFields();
+	PTF_ASSERT_EQUAL(distributor.getFlowHash(tunneledPacket.getRawPacket()), distributor.getFlowHash(&innerPacket), u32);
+	ClusterDistributorConfiguration outerConfig(config);
+	outerConfig.hashInnerFlow = false;
+	ClusterDistributor outerDistributor(outerConfig, clusterDistributorTestOnBatch, &state);
+	PTF_ASSERT_TRUE(outerDistributor.getFlowHash(tunneledPacket.getRawPacket()) != outerDistributor.getFlowHash(&innerPacket));
+
+	// only Ethernet packets which fit in the batch buffers are distributed
+	RawPacket rawIPPacket(buffer + sizeof(ether_header), (int)(len - sizeof(ether_header)), tv, false, LINKTYPE_RAW);
+	PTF_ASSERT_FALSE(distributor.distributePacket(&rawIPPacket));
+	distributor.getStats(stats);
+	PTF_ASSERT_EQUAL(stats.unsupportedPackets, 1, u32);
+} // ClusterDistributorTest
+
+
+struct PacketReorderBufferTestWorker
+{
+	PacketReorderBuffer* buffer;
+	RawPacket* packets;
+	uint32_t workerId;
+	uint32_t numOfWorkers;
+	uint32_t numOfPackets;
+};
+
+static void* packetReorderBufferTestWorkerMain(void* workerPtr)
+{
+	PacketReorderBufferTestWorker* worker = (PacketReorderBufferTestWorker*)workerPtr;
+	for (uint32_t sequence = worker->workerId; sequence < worker->numOfPackets; sequence += worker->numOfWorkers)
+	{
+		worker->buffer->insert(sequence, &worker->packets[sequence]);
+		// workers run at different paces, so the packets arrive out of order
+		if (sequence % (64 * (worker->workerId + 1)) == 0)
+			sched_yield();
+	}
+
+	return NULL;
+}
+
+PTF_TEST_CASE(PacketReorderBufferTest)
+{
+	RawPacket packets[16];
+	RawPacket* drained[16];
+	PacketReorderBufferStats stats;
+	timespec now = { 1, 0 };
+
+	// the window is rounded up to a power of 2, and sequence numbers are assigned consecutively
+	PacketReorderBuffer buffer(PacketReorderBufferConfiguration(5, 1000));
+	PTF_ASSERT_EQUAL(buffer.getWindowSize(), 8, size);
+	PTF_ASSERT_EQUAL((int)buffer.assignSequence(), 0, int);
+	PTF_ASSERT_EQUAL((int)buffer.assignSequence(3), 1, int);
+	PTF_ASSERT_EQUAL((int)buffer.assignSequence(), 4, int);
+
+	// packets are held until the packets before them arrive
+	PTF_ASSERT_EQUAL(buffer.insert(2, &packets[2]), PacketReorderBuffer::Inserted, enum);
+	PTF_ASSERT_EQUAL(buffer.insert(1, &packets[1]), PacketReorderBuffer::Inserted, enum);
+	PTF_ASSERT_EQUAL(buffer.drain(now, drained, 16), 0, size);
+	PTF_ASSERT_EQUAL(buffer.insert(0, &packets[0]), PacketReorderBuffer::Inserted, enum);
+	PTF_ASSERT_EQUAL(buffer.drain(now, drained, 2), 2, size);
+	PTF_ASSERT_EQUAL(buffer.drain(now, drained + 2, 16), 1, size);
+	for (int i = 0; i < 3; i++)
+		PTF_ASSERT_TRUE(drained[i] == &packets[i]);
+	PTF_ASSERT_EQUAL((int)buffer.getNextSequence(), 3, int);
+
+	// released sequence numbers are late, and a sequence number is inserted only once
+	PTF_ASSERT_EQUAL(buffer.insert(1, &packets[1]), PacketReorderBuffer::Late, enum);
+	PTF_ASSERT_EQUAL(buffer.insert(4, &packets[4]), PacketReorderBuffer::Inserted, enum);
+	PTF_ASSERT_EQUAL(buffer.insert(4, &packets[4]), PacketReorderBuffer::Duplicate, enum);
+
+	// a packet beyond the window makes the next drain skip the missing sequence numbers holding the window, until it fits
+	PTF_ASSERT_EQUAL(buffer.insert(11, &packets[11]), PacketReorderBuffer::WindowFull, enum);
+	PTF_ASSERT_EQUAL(buffer.drain(now, drained, 16), 1, size);
+	PTF_ASSERT_TRUE(drained[0] == &packets[4]);
+	PTF_ASSERT_EQUAL((int)buffer.getNextSequence(), 5, int);
+	PTF_ASSERT_EQUAL(buffer.insert(11, &packets[11]), PacketReorderBuffer::Inserted, enum);
+	PTF_ASSERT_EQUAL(buffer.insert(3, &packets[3]), PacketReorderBuffer::Late, enum);
+
+	// a missing sequence number is skipped after it was waited for the timeout. A sequence number inserted without a packet is released
+	// without waiting, and the missing ones right after a skipped one are skipped together
+	PTF_ASSERT_EQUAL(buffer.insert(6, NULL), PacketReorderBuffer::Inserted, enum);
+	PTF_ASSERT_EQUAL(buffer.drain(now, drained, 16), 0, size);
+	now.tv_nsec = 500;
+	PTF_ASSERT_EQUAL(buffer.drain(now, drained, 16), 0, size);
+	now.tv_nsec = 1000;
+	PTF_ASSERT_EQUAL(buffer.drain(now, drained, 16), 0, size);
+	PTF_ASSERT_EQUAL((int)buffer.getNextSequence(), 7, int);
+	now.tv_nsec = 1999;
+	PTF_ASSERT_EQUAL(buffer.drain(now, drained, 16), 0, size);
+	now.tv_nsec = 2000;
+	PTF_ASSERT_EQUAL(buffer.drain(now, drained, 16), 1, size);
+	PTF_ASSERT_TRUE(drained[0] == &packets[11]);
+	PTF_ASSERT_EQUAL((int)buffer.getNextSequence(), 12, int);
+
+	// nothing is skipped when no later packet waits
+	now.tv_sec = 10;
+	PTF_ASSERT_EQUAL(buffer.drain(now, drained, 16), 0, size);
+	now.tv_sec = 20;
+	PTF_ASSERT_EQUAL(buffer.drain(now, drained, 16), 0, size);
+	PTF_ASSERT_EQUAL((int)buffer.getNextSequence(), 12, int);
+
+	// flush releases everything inserted, skipping the missing sequence numbers
+	PTF_ASSERT_EQUAL(buffer.insert(15, &packets[15]), PacketReorderBuffer::Inserted, enum);
+	PTF_ASSERT_EQUAL(buffer.insert(13, &packets[13]), PacketReorderBuffer::Inserted, enum);
+	std::vector<RawPacket*> flushed;
+	buffer.flush(flushed);
+	PTF_ASSERT_EQUAL(flushed.size(), 2, size);
+	PTF_ASSERT_TRUE(flushed[0] == &packets[13]);
+	PTF_ASSERT_TRUE(flushed[1] == &packets[15]);
+	PTF_ASSERT_EQUAL((int)buffer.getNextSequence(), 16, int);
+
+	buffer.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.releasedPackets, 7, int);
+	PTF_ASSERT_EQUAL((int)stats.emptySequences, 1, int);
+	PTF_ASSERT_EQUAL((int)stats.latePackets, 2, int);
+	PTF_ASSERT_EQUAL((int)stats.duplicatePackets, 1, int);
+	PTF_ASSERT_EQUAL((int)stats.windowFullPackets, 1, int);
+	PTF_ASSERT_EQUAL((int)stats.skippedSequences, 8, int);
+	buffer.resetStats();
+	buffer.getStats(stats);
+	PTF_ASSERT_EQUAL((int)(stats.releasedPackets + stats.latePackets + stats.skippedSequences), 0, int);
+
+	// without a timeout a missing sequence number is waited for until the window is full, and numbering may start anywhere
+	PacketReorderBuffer noTimeoutBuffer(PacketReorderBufferConfiguration(4, 0), 1000);
+	PTF_ASSERT_EQUAL((int)noTimeoutBuffer.assignSequence(), 1000, int);
+	PTF_ASSERT_EQUAL(noTimeoutBuffer.insert(1001, &packets[1]), PacketReorderBuffer::Inserted, enum);
+	now.tv_sec = 100;
+	PTF_ASSERT_EQUAL(noTimeoutBuffer.drain(now, drained, 16), 0, size);
+	now.tv_sec = 200;
+	PTF_ASSERT_EQUAL(noTimeoutBuffer.drain(now, drained, 16), 0, size);
+	PTF_ASSERT_EQUAL(noTimeoutBuffer.insert(1000, &packets[0]), PacketReorderBuffer::Inserted, enum);
+	PTF_ASSERT_EQUAL(noTimeoutBuffer.drain(now, drained, 16), 2, size);
+	PTF_ASSERT_TRUE(drained[0] == &packets[0]);
+	PTF_ASSERT_TRUE(drained[1] == &packets[1]);
+
+	// packets inserted by 4 workers in any order are drained exactly once and in sequence order
+	const uint32_t numOfPackets = 20000;
+	RawPacket* threadPackets = new RawPacket[numOfPackets];
+	PacketReorderBuffer threadBuffer(PacketReorderBufferConfiguration(numOfPackets, 0));
+	PacketReorderBufferTestWorker workers[4];
+	pthread_t workerThreads[4];
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		workers[i].buffer = &threadBuffer;
+		workers[i].packets = threadPackets;
+		workers[i].workerId = i;
+		workers[i].numOfWorkers = 4;
+		workers[i].numOfPackets = numOfPackets;
+		PTF_ASSERT_EQUAL(pthread_create(&workerThreads[i], NULL, packetReorderBufferTestWorkerMain, &workers[i]), 0, int);
+	}
+
+	uint32_t numOfDrained = 0;
+	bool inOrder = true;
+	while (numOfDrained < numOfPackets)
+	{
+		size_t count = threadBuffer.drain(drained, 16);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (drained[i] != &threadPackets[numOfDrained])
+				inOrder = false;
+			numOfDrained++;
+		}
+		if (count == 0)
+			sched_yield();
+	}
+
+	for (int i = 0; i < 4; i++)
+		pthread_join(workerThreads[i], NULL);
+
+	PTF_ASSERT_TRUE(inOrder);
+	threadBuffer.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.releasedPackets, (int)numOfPackets, int);
+	PTF_ASSERT_EQUAL((int)(stats.latePackets + stats.duplicatePackets + stats.windowFullPackets + stats.skippedSequences), 0, int);
+	delete [] threadPackets;
+} // PacketReorderBufferTest
+
+
+PTF_TEST_CASE(LpmTableTest)
+{
+	IPv4LpmTable ipv4Table(4);
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("10.1.2.3")).toInt()), LpmTrie::NoRoute, u32);
+
+	// the longest prefix wins, whatever the order the prefixes were added in
+	PTF_ASSERT_TRUE(ipv4Table.add(IPv4Address(std::string("10.1.2.0")), 28, 3));
+	PTF_ASSERT_TRUE(ipv4Table.add(IPv4Address(std::string("10.0.0.0")), 8, 1));
+	PTF_ASSERT_TRUE(ipv4Table.add(IPv4Address(std::string("10.1.0.0")), 16, 2));
+	PTF_ASSERT_TRUE(ipv4Table.add(IPv4Address(std::string("10.1.2.5")), 32, 4));
+	PTF_ASSERT_TRUE(ipv4Table.add(IPv4Address(std::string("0.0.0.0")), 0, 0));
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("10.1.2.3")).toInt()), 3, u32);
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("10.1.2.5")).toInt()), 4, u32);
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("10.1.2.16")).toInt()), 2, u32);
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("10.1.3.1")).toInt()), 2, u32);
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("10.2.0.1")).toInt()), 1, u32);
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("11.0.0.1")).toInt()), 0, u32);
+	PTF_ASSERT_EQUAL(ipv4Table.getNumOfPrefixes(), 5, size);
+	PTF_ASSERT_EQUAL(ipv4Table.getNumOfGroups(), 1, u32);
+
+	uint32_t value;
+	PTF_ASSERT_TRUE(ipv4Table.find(IPv4Address(std::string("10.1.255.255")), 16, value));
+	PTF_ASSERT_EQUAL(value, 2, u32);
+	PTF_ASSERT_FALSE(ipv4Table.find(IPv4Address(std::string("10.1.0.0")), 17, value));
+
+	// invalid prefix lengths and values are rejected
+	PTF_ASSERT_FALSE(ipv4Table.add(IPv4Address(std::string("10.0.0.0")), 33, 1));
+	PTF_ASSERT_FALSE(ipv4Table.add(IPv4Address(std::string("10.0.0.0")), 8, LpmTrie::MaxValue + 1));
+
+	// addresses of a removed prefix match the longest shorter prefix
+	PTF_ASSERT_TRUE(ipv4Table.remove(IPv4Address(std::string("10.1.0.0")), 16));
+	PTF_ASSERT_FALSE(ipv4Table.remove(IPv4Address(std::string("10.1.0.0")), 16));
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("10.1.3.1")).toInt()), 1, u32);
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("10.1.2.16")).toInt()), 1, u32);
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("10.1.2.3")).toInt()), 3, u32);
+	PTF_ASSERT_TRUE(ipv4Table.remove(IPv4Address(std::string("10.1.2.0")), 28));
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("10.1.2.3")).toInt()), 1, u32);
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("10.1.2.5")).toInt()), 4, u32);
+
+	// the table has no free groups for a prefix longer than 24 bits under a 5th /24
+	PTF_ASSERT_TRUE(ipv4Table.add(IPv4Address(std::string("20.0.1.0")), 25, 5));
+	PTF_ASSERT_TRUE(ipv4Table.add(IPv4Address(std::string("20.0.2.0")), 25, 5));
+	PTF_ASSERT_TRUE(ipv4Table.add(IPv4Address(std::string("20.0.3.0")), 25, 5));
+	PTF_ASSERT_FALSE(ipv4Table.add(IPv4Address(std::string("20.0.4.0")), 25, 5));
+	PTF_ASSERT_EQUAL(ipv4Table.getNumOfGroups(), 4, u32);
+
+	// bulk lookups return the same values as single lookups
+	uint32_t addresses[40];
+	uint32_t values[40];
+	for (int i = 0; i < 40; i++)
+	{
+		uint8_t bytes[4] = { (uint8_t)(i % 2 == 0 ? 10 : 20), 0, (uint8_t)(i % 5), (uint8_t)(i * 6) };
+		memcpy(&addresses[i], bytes, sizeof(uint32_t));
+	}
+	ipv4Table.lookupBulk(addresses, values, 40);
+	for (int i = 0; i < 40; i++)
+		PTF_ASSERT_EQUAL(values[i], ipv4Table.lookup(addresses[i]), u32);
+
+	ipv4Table.clear();
+	PTF_ASSERT_EQUAL(ipv4Table.getNumOfPrefixes(), 0, size);
+	PTF_ASSERT_EQUAL(ipv4Table.getNumOfGroups(), 0, u32);
+	PTF_ASSERT_EQUAL(ipv4Table.lookup(IPv4Address(std::string("10.1.2.5")).toInt()), LpmTrie::NoRoute, u32);
+
+	IPv6LpmTable ipv6Table(64);
+	PTF_ASSERT_TRUE(ipv6Table.add(IPv6Address(std::string("2001:db8::")), 32, 1));
+	PTF_ASSERT_TRUE(ipv6Table.add(IPv6Address(std::string("2001:db8:1::")), 48, 2));
+	PTF_ASSERT_TRUE(ipv6Table.add(IPv6Address(std::string("2001:db8:1:2::")), 63, 3));
+	PTF_ASSERT_TRUE(ipv6Table.add(IPv6Address(std::string("2001:db8:1:2::1")), 128, 4));
+	PTF_ASSERT_TRUE(ipv6Table.add(IPv6Address(std::string("2000::")), 3, 5));
+
+	uint8_t ipv6Addresses[6][16];
+	IPv6Address(std::string("2001:db8:1:2::1")).copyTo(ipv6Addresses[0]);
+	IPv6Address(std::string("2001:db8:1:2::2")).copyTo(ipv6Addresses[1]);
+	IPv6Address(std::string("2001:db8:1:3::1")).copyTo(ipv6Addresses[2]);
+	IPv6Address(std::string("2001:db8:1:4::1")).copyTo(ipv6Addresses[3]);
+	IPv6Address(std::string("2001:db8:2::1")).copyTo(ipv6Addresses[4]);
+	IPv6Address(std::string("fe80::1")).copyTo(ipv6Addresses[5]);
+	uint32_t expectedValues[6] = { 4, 3, 3, 2, 1, LpmTrie::NoRoute };
+	const uint8_t* ipv6AddressPtrs[6];
+	for (int i = 0; i < 6; i++)
+	{
+		PTF_ASSERT_EQUAL(ipv6Table.lookup(ipv6Addresses[i]), expectedValues[i], u32);
+		ipv6AddressPtrs[i] = ipv6Addresses[i];
+	}
+	ipv6Table.lookupBulk(ipv6AddressPtrs, values, 6);
+	for (int i = 0; i < 6; i++)
+		PTF_ASSERT_EQUAL(values[i], expectedValues[i], u32);
+
+	PTF_ASSERT_TRUE(ipv6Table.remove(IPv6Address(std::string("2001:db8:1::")), 48));
+	PTF_ASSERT_EQUAL(ipv6Table.lookup(ipv6Addresses[3]), 1, u32);
+	PTF_ASSERT_EQUAL(ipv6Table.lookup(ipv6Addresses[1]), 3, u32);
+	PTF_ASSERT_TRUE(ipv6Table.remove(IPv6Address(std::string("2001:db8::")), 32));
+	PTF_ASSERT_EQUAL(ipv6Table.lookup(ipv6Addresses[3]), 5, u32);
+	PTF_ASSERT_EQUAL(ipv6Table.lookup(ipv6Addresses[0]), 4, u32);
+} // LpmTableTest
+
+
+static size_t buildL3ForwarderTestFrame(uint8_t* buffer, const std::string& dstMac, const std::string& srcAddress, const std::string& dstAddress,
+		uint8_t ttl)
+{
+	Packet packet(100);
+	MacAddress dstMacAddress(dstMac);
+	EthLayer ethLayer(MacAddress("00:00:00:00:aa:01"), dstMacAddress);
+	UdpLayer udpLayer(1000, 2000);
+	bool isIPv6 = (srcAddress.find(':') != std::string::npos);
+	IPv4Layer ipv4Layer;
+	IPv6Layer ipv6Layer;
+	packet.addLayer(&ethLayer);
+	if (isIPv6)
+	{
+		IPv6Address(srcAddress).copyTo(ipv6Layer.getIPv6Header()->ipSrc);
+		IPv6Address(dstAddress).copyTo(ipv6Layer.getIPv6Header()->ipDst);
+		ipv6Layer.getIPv6Header()->hopLimit = ttl;
+		packet.addLayer(&ipv6Layer);
+	}
+	else
+	{
+		ipv4Layer.setSrcIpAddress(IPv4Address(srcAddress));
+		ipv4Layer.setDstIpAddress(IPv4Address(dstAddress));
+		ipv4Layer.getIPv4Header()->timeToLive = ttl;
+		packet.addLayer(&ipv4Layer);
+	}
+	packet.addLayer(&udpLayer);
+	packet.computeCalculateFields();
+
+	size_t frameLength = packet.getRawPacket()->getRawDataLen();
+	memcpy(buffer, packet.getRawPacket()->getRawData(), frameLength);
+	return frameLength;
+}
+
+static size_t buildL3ForwarderTestArp(uint8_t* buffer, ArpOpcode opcode, const std::string& dstMac, const std::string& senderMac,
+		const std::string& senderAddress, const std::string& targetAddress)
+{
+	Packet packet(100);
+	MacAddress senderMacAddress(senderMac);
+	MacAddress dstMacAddress(dstMac);
+	EthLayer ethLayer(senderMacAddress, dstMacAddress);
+	ArpLayer arpLayer(opcode, senderMacAddress, MacAddress("00:00:00:00:00:00"), IPv4Address(senderAddress), IPv4Address(targetAddress));
+	packet.addLayer(&ethLayer);
+	packet.addLayer(&arpLayer);
+	packet.computeCalculateFields();
+
+	size_t frameLength = packet.getRawPacket()->getRawDataLen();
+	memcpy(buffer, packet.getRawPacket()->getRawData(), frameLength);
+	return frameLength;
+}
+
+PTF_TEST_CASE(L3ForwarderTest)
+{
+	uint8_t frame[200];
+	uint8_t reply[L3Forwarder::MaxReplyLength];
+	uint16_t replyPort = 0;
+	L3ForwarderStats stats;
+	memset(&stats, 0, sizeof(stats));
+	MacAddress macAddress("00:00:00:00:00:00");
+
+	L3Forwarder forwarder(2, 16);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(forwarder.addPortAddress(0, IPv4Address(std::string("10.0.1.1")), 24));
+	PTF_ASSERT_TRUE(forwarder.setPort(0, MacAddress("00:00:00:00:00:10")));
+	PTF_ASSERT_TRUE(forwarder.setPort(1, MacAddress("00:00:00:00:00:11")));
+	PTF_ASSERT_FALSE(forwarder.setPort(2, MacAddress("00:00:00:00:00:12")));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_TRUE(forwarder.addPortAddress(0, IPv4Address(std::string("10.0.1.1")), 24));
+	PTF_ASSERT_TRUE(forwarder.addPortAddress(1, IPv4Address(std::string("10.0.2.1")), 24));
+	PTF_ASSERT_TRUE(forwarder.addPortAddress(0, IPv6Address(std::string("2001:db8:1::1")), 64));
+	PTF_ASSERT_TRUE(forwarder.addPortAddress(1, IPv6Address(std::string("2001:db8:2::1")), 64));
+	PTF_ASSERT_TRUE(forwarder.addRoute(IPv4Address(std::string("192.168.0.0")), 16, IPv4Address(std::string("10.0.2.254")), 1));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(forwarder.addRoute(IPv4Address(std::string("192.169.0.0")), 16, IPv4Address(std::string("10.0.2.254")), 2));
+	LoggerPP::getInstance().enableErrors();
+
+	// a packet to a gateway whose MAC address isn't known goes to the control plane, which sends an ARP request for the gateway once a second
+	size_t frameLength = buildL3ForwarderTestFrame(frame, "00:00:00:00:00:10", "10.0.1.5", "192.168.1.1", 64);
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(frame, frameLength, 0, &stats), L3Forwarder::HostPort, u16);
+	PTF_ASSERT_EQUAL((int)stats.unresolvedPackets, 1, int);
+	PTF_ASSERT_EQUAL(forwarder.processHostFrame(frame, frameLength, 0, 5, reply, replyPort), 42, size);
+	PTF_ASSERT_EQUAL(replyPort, 1, u16);
+	RawPacket arpRequestRawPacket(reply, 42, timeval(), false);
+	Packet arpRequest(&arpRequestRawPacket);
+	ArpLayer* arpLayer = arpRequest.getLayerOfType<ArpLayer>();
+	PTF_ASSERT_TRUE(arpLayer != NULL);
+	PTF_ASSERT_EQUAL(ntohs(arpLayer->getArpHeader()->opcode), ARP_REQUEST, u16);
+	PTF_ASSERT_EQUAL(arpLayer->getTargetIpAddr().toString(), "10.0.2.254", string);
+	PTF_ASSERT_EQUAL(arpLayer->getSenderIpAddr().toString(), "10.0.2.1", string);
+	PTF_ASSERT_EQUAL(arpLayer->getSenderMacAddress().toString(), "00:00:00:00:00:11", string);
+	PTF_ASSERT_EQUAL(arpRequest.getLayerOfType<EthLayer>()->getDestMac().toString(), "ff:ff:ff:ff:ff:ff", string);
+	PTF_ASSERT_EQUAL(forwarder.processHostFrame(frame, frameLength, 0, 5, reply, replyPort), 0, size);
+	PTF_ASSERT_FALSE(forwarder.getNeighbor(IPv4Address(std::string("10.0.2.254")), macAddress));
+
+	// the ARP reply of the gateway resolves the next hop, and packets through it are forwarded with a decremented TTL and a valid checksum
+	size_t arpLength = buildL3ForwarderTestArp(reply, ARP_REPLY, "00:00:00:00:00:11", "00:00:00:00:bb:fe", "10.0.2.254", "10.0.2.1");
+	PTF_ASSERT_EQUAL(forwarder.processHostFrame(reply, arpLength, 1, 5, reply, replyPort), 0, size);
+	PTF_ASSERT_TRUE(forwarder.getNeighbor(IPv4Address(std::string("10.0.2.254")), macAddress));
+	PTF_ASSERT_EQUAL(macAddress.toString(), "00:00:00:00:bb:fe", string);
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(frame, frameLength, 0, &stats), 1, u16);
+	PTF_ASSERT_EQUAL((int)stats.forwardedIPv4Packets, 1, int);
+	PTF_ASSERT_EQUAL(MacAddress(frame).toString(), "00:00:00:00:bb:fe", string);
+	PTF_ASSERT_EQUAL(MacAddress(frame + 6).toString(), "00:00:00:00:00:11", string);
+	PTF_ASSERT_EQUAL(((iphdr*)(frame + sizeof(ether_header)))->timeToLive, 63, int);
+	ScalarBuffer<uint16_t> ipHeader;
+	ipHeader.buffer = (uint16_t*)(frame + sizeof(ether_header));
+	ipHeader.len = sizeof(iphdr);
+	PTF_ASSERT_EQUAL(compute_checksum(&ipHeader, 1), 0, u16);
+
+	// expired TTLs, destinations without a route, frames to other MAC addresses and packets to the router itself aren't forwarded
+	frameLength = buildL3ForwarderTestFrame(frame, "00:00:00:00:00:10", "10.0.1.5", "192.168.1.1", 1);
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(frame, frameLength, 0, &stats), L3Forwarder::DropPort, u16);
+	PTF_ASSERT_EQUAL(((iphdr*)(frame + sizeof(ether_header)))->timeToLive, 1, int);
+	frameLength = buildL3ForwarderTestFrame(frame, "00:00:00:00:00:10", "10.0.1.5", "8.8.8.8", 64);
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(frame, frameLength, 0, &stats), L3Forwarder::DropPort, u16);
+	frameLength = buildL3ForwarderTestFrame(frame, "00:00:00:00:00:20", "10.0.1.5", "192.168.1.1", 64);
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(frame, frameLength, 0, &stats), L3Forwarder::DropPort, u16);
+	frameLength = buildL3ForwarderTestFrame(frame, "00:00:00:00:00:10", "10.0.1.5", "10.0.2.1", 64);
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(frame, frameLength, 0, &stats), L3Forwarder::HostPort, u16);
+	PTF_ASSERT_EQUAL((int)stats.ttlExceededPackets, 1, int);
+	PTF_ASSERT_EQUAL((int)stats.noRoutePackets, 1, int);
+	PTF_ASSERT_EQUAL((int)stats.filteredPackets, 1, int);
+	PTF_ASSERT_EQUAL((int)stats.localPackets, 1, int);
+
+	// ARP requests for the addresses of the router are answered, and their senders on connected subnets get host routes
+	arpLength = buildL3ForwarderTestArp(frame, ARP_REQUEST, "ff:ff:ff:ff:ff:ff", "00:00:00:00:aa:05", "10.0.1.5", "10.0.1.1");
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(frame, arpLength, 0, &stats), L3Forwarder::HostPort, u16);
+	PTF_ASSERT_EQUAL(forwarder.processHostFrame(frame, arpLength, 0, 6, reply, replyPort), 42, size);
+	PTF_ASSERT_EQUAL(replyPort, 0, u16);
+	RawPacket arpReplyRawPacket(reply, 42, timeval(), false);
+	Packet arpReply(&arpReplyRawPacket);
+	arpLayer = arpReply.getLayerOfType<ArpLayer>();
+	PTF_ASSERT_EQUAL(ntohs(arpLayer->getArpHeader()->opcode), ARP_REPLY, u16);
+	PTF_ASSERT_EQUAL(arpLayer->getSenderIpAddr().toString(), "10.0.1.1", string);
+	PTF_ASSERT_EQUAL(arpLayer->getSenderMacAddress().toString(), "00:00:00:00:00:10", string);
+	PTF_ASSERT_EQUAL(arpLayer->getTargetMacAddress().toString(), "00:00:00:00:aa:05", string);
+	uint32_t nextHop;
+	PTF_ASSERT_TRUE(forwarder.getIPv4Table().find(IPv4Address(std::string("10.0.1.5")), 32, nextHop));
+
+	frameLength = buildL3ForwarderTestFrame(frame, "00:00:00:00:00:11", "192.168.1.1", "10.0.1.5", 64);
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(frame, frameLength, 1, &stats), 0, u16);
+	PTF_ASSERT_EQUAL(MacAddress(frame).toString(), "00:00:00:00:aa:05", string);
+
+	// a host on a connected subnet which wasn't learned is asked for with an ARP request for its own address
+	frameLength = buildL3ForwarderTestFrame(frame, "00:00:00:00:00:11", "192.168.1.1", "10.0.1.6", 64);
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(frame, frameLength, 1, &stats), L3Forwarder::HostPort, u16);
+	PTF_ASSERT_EQUAL(forwarder.processHostFrame(frame, frameLength, 1, 6, reply, replyPort), 42, size);
+	PTF_ASSERT_EQUAL(replyPort, 0, u16);
+	PTF_ASSERT_EQUAL(((arphdr*)(reply + sizeof(ether_header)))->targetIpAddr, IPv4Address(std::string("10.0.1.6")).toInt(), u32);
+
+	// ARP frames from hosts the router doesn't talk to aren't learned
+	arpLength = buildL3ForwarderTestArp(frame, ARP_REQUEST, "ff:ff:ff:ff:ff:ff", "00:00:00:00:cc:01", "172.16.0.1", "172.16.0.2");
+	PTF_ASSERT_EQUAL(forwarder.processHostFrame(frame, arpLength, 0, 6, reply, replyPort), 0, size);
+	PTF_ASSERT_FALSE(forwarder.getNeighbor(IPv4Address(std::string("172.16.0.1")), macAddress));
+
+	// a neighbor solicitation for an IPv6 address of the router is answered with a neighbor advertisement
+	uint8_t solicitation[86];
+	memset(solicitation, 0, sizeof(solicitation));
+	uint8_t solicitationHeader[14] = { 0x33, 0x33, 0xff, 0, 0, 0x01, 0, 0, 0, 0, 0xaa, 0x15, 0x86, 0xdd };
+	memcpy(solicitation, solicitationHeader, sizeof(solicitationHeader));
+	ip6_hdr* ipv6Header = (ip6_hdr*)(solicitation + sizeof(ether_header));
+	ipv6Header->ipVersion = 6;
+	ipv6Header->payloadLength = htons(32);
+	ipv6Header->nextHeader = PACKETPP_IPPROTO_ICMPV6;
+	ipv6Header->hopLimit = 255;
+	IPv6Address(std::string("2001:db8:1::15")).copyTo(ipv6Header->ipSrc);
+	IPv6Address(std::string("ff02::1:ff00:1")).copyTo(ipv6Header->ipDst);
+	uint8_t* icmpHeader = solicitation + sizeof(ether_header) + sizeof(ip6_hdr);
+	icmpHeader[0] = 135;
+	IPv6Address(std::string("2001:db8:1::1")).copyTo(icmpHeader + 8);
+	uint8_t sourceLinkLayerOption[8] = { 1, 1, 0, 0, 0, 0, 0xaa, 0x15 };
+	memcpy(icmpHeader + 24, sourceLinkLayerOption, sizeof(sourceLinkLayerOption));
+
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(solicitation, sizeof(solicitation), 0, &stats), L3Forwarder::HostPort, u16);
+	PTF_ASSERT_EQUAL(forwarder.processHostFrame(solicitation, sizeof(solicitation), 0, 6, reply, replyPort), 86, size);
+	PTF_ASSERT_EQUAL(replyPort, 0, u16);
+	PTF_ASSERT_EQUAL(MacAddress(reply).toString(), "00:00:00:00:aa:15", string);
+	ip6_hdr* replyHeader = (ip6_hdr*)(reply + sizeof(ether_header));
+	PTF_ASSERT_EQUAL(IPv6Address(replyHeader->ipSrc).toString(), "2001:db8:1::1", string);
+	PTF_ASSERT_EQUAL(IPv6Address(replyHeader->ipDst).toString(), "2001:db8:1::15", string);
+	uint8_t* replyIcmpHeader = reply + sizeof(ether_header) + sizeof(ip6_hdr);
+	PTF_ASSERT_EQUAL(replyIcmpHeader[0], 136, int);
+	PTF_ASSERT_EQUAL(replyIcmpHeader[4], 0xe0, int);
+	PTF_ASSERT_EQUAL(MacAddress(replyIcmpHeader + 26).toString(), "00:00:00:00:00:10", string);
+	uint16_t pseudoHeader[20];
+	memcpy(pseudoHeader, replyHeader->ipSrc, 32);
+	pseudoHeader[16] = 0;
+	pseudoHeader[17] = htons(32);
+	pseudoHeader[18] = 0;
+	pseudoHeader[19] = htons(PACKETPP_IPPROTO_ICMPV6);
+	ScalarBuffer<uint16_t> icmpVec[2];
+	icmpVec[0].buffer = pseudoHeader;
+	icmpVec[0].len = sizeof(pseudoHeader);
+	icmpVec[1].buffer = (uint16_t*)replyIcmpHeader;
+	icmpVec[1].len = 32;
+	PTF_ASSERT_EQUAL(compute_checksum(icmpVec, 2), 0, u16);
+
+	// the solicitation taught the router the MAC address of its sender, so IPv6 packets to it are forwarded with a decremented hop limit
+	PTF_ASSERT_TRUE(forwarder.getNeighbor(IPv6Address(std::string("2001:db8:1::15")), macAddress));
+	frameLength = buildL3ForwarderTestFrame(frame, "00:00:00:00:00:11", "2001:db8:2::5", "2001:db8:1::15", 64);
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(frame, frameLength, 1, &stats), 0, u16);
+	PTF_ASSERT_EQUAL(((ip6_hdr*)(frame + sizeof(ether_header)))->hopLimit, 63, int);
+	PTF_ASSERT_EQUAL(MacAddress(frame).toString(), "00:00:00:00:aa:15", string);
+	PTF_ASSERT_EQUAL((int)stats.forwardedIPv6Packets, 1, int);
+
+	// an unknown IPv6 host is asked for with a neighbor solicitation to its solicited-node multicast address
+	frameLength = buildL3ForwarderTestFrame(frame, "00:00:00:00:00:10", "2001:db8:1::15", "2001:db8:2::1234:5678", 64);
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(frame, frameLength, 0, &stats), L3Forwarder::HostPort, u16);
+	PTF_ASSERT_EQUAL(forwarder.processHostFrame(frame, frameLength, 0, 6, reply, replyPort), 86, size);
+	PTF_ASSERT_EQUAL(replyPort, 1, u16);
+	PTF_ASSERT_EQUAL(MacAddress(reply).toString(), "33:33:ff:34:56:78", string);
+	PTF_ASSERT_EQUAL(IPv6Address(replyHeader->ipSrc).toString(), "2001:db8:2::1", string);
+	PTF_ASSERT_EQUAL(IPv6Address(replyHeader->ipDst).toString(), "ff02::1:ff34:5678", string);
+	PTF_ASSERT_EQUAL(replyIcmpHeader[0], 135, int);
+
+	// a burst mixing IPv4 and IPv6 packets gets the same decisions as single frames
+	uint8_t burstFrames[4][100];
+	uint8_t* burstFramePtrs[4];
+	uint16_t burstFrameLengths[4];
+	uint16_t outPorts[4];
+	burstFrameLengths[0] = buildL3ForwarderTestFrame(burstFrames[0], "00:00:00:00:00:10", "10.0.1.5", "192.168.7.7", 64);
+	burstFrameLengths[1] = buildL3ForwarderTestFrame(burstFrames[1], "00:00:00:00:00:10", "2001:db8:1::15", "2001:db9::1", 64);
+	burstFrameLengths[2] = buildL3ForwarderTestFrame(burstFrames[2], "00:00:00:00:00:10", "10.0.1.5", "10.0.1.1", 64);
+	burstFrameLengths[3] = buildL3ForwarderTestFrame(burstFrames[3], "00:00:00:00:00:11", "2001:db8:2::5", "2001:db8:1::15", 64);
+	for (int i = 0; i < 4; i++)
+		burstFramePtrs[i] = burstFrames[i];
+	forwarder.forwardBurst(burstFramePtrs, burstFrameLengths, 4, 0, outPorts);
+	PTF_ASSERT_EQUAL(outPorts[0], 1, u16);
+	PTF_ASSERT_EQUAL(outPorts[1], L3Forwarder::DropPort, u16);
+	PTF_ASSERT_EQUAL(outPorts[2], L3Forwarder::HostPort, u16);
+	PTF_ASSERT_EQUAL(outPorts[3], L3Forwarder::DropPort, u16);
+
+	// removing the route drops its packets
+	PTF_ASSERT_TRUE(forwarder.removeRoute(IPv4Address(std::string("192.168.0.0")), 16));
+	PTF_ASSERT_FALSE(forwarder.removeRoute(IPv4Address(std::string("192.168.0.0")), 16));
+	frameLength = buildL3ForwarderTestFrame(frame, "00:00:00:00:00:10", "10.0.1.5", "192.168.1.1", 64);
+	PTF_ASSERT_EQUAL(forwarder.forwardFrame(frame, frameLength, 0, &stats), L3Forwarder::DropPort, u16);
+} // L3ForwarderTest
+
+
+// create an Ethernet packet with an IPv4 or IPv6 header followed by a TCP or UDP header, with all checksums computed
+static RawPacket* checksumVerifierCreatePacket(bool ipv6, bool tcp, const char* payload, bool withVlan = false, bool withIPOption = false)
+{
+	Packet packet(200);
+	EthLayer ethLayer(MacAddress("00:00:00:00:00:01"), MacAddress("00:00:00:00:00:02"), withVlan ? PCPP_ETHERTYPE_VLAN : (ipv6 ? PCPP_ETHERTYPE_IPV6 : PCPP_ETHERTYPE_IP));
+	VlanLayer vlanLayer(100, false, 0, ipv6 ? PCPP_ETHERTYPE_IPV6 : PCPP_ETHERTYPE_IP);
+	IPv4Layer ipv4Layer(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	ipv4Layer.getIPv4Header()->timeToLive = 64;
+	IPv6Layer ipv6Layer(IPv6Address(std::string("2001:db8::1")), IPv6Address(std::string("2001:db8::2")));
+	TcpLayer tcpLayer(1234, 80);
+	UdpLayer udpLayer(1234, 53);
+	PayloadLayer payloadLayer((const uint8_t*)payload, strlen(payload), false);
+
+	packet.addLayer(&ethLayer);
+	if (withVlan)
+		packet.addLayer(&vlanLayer);
+	if (ipv6)
+		packet.addLayer(&ipv6Layer);
+	else
+		packet.addLayer(&ipv4Layer);
+	if (tcp)
+		packet.addLayer(&tcpLayer);
+	else
+		packet.addLayer(&udpLayer);
+	packet.addLayer(&payloadLayer);
+	if (withIPOption)
+		ipv4Layer.addOption(IPv4OptionBuilder(IPV4OPT_RouterAlert, (uint16_t)0));
+	packet.computeCalculateFields();
+
+	return new RawPacket(*packet.getRawPacket());
+}
+
+PTF_TEST_CASE(ChecksumVerifierTest)
+{
+	std::vector<RawPacket*> basePackets;
+	// 0: valid IPv4 TCP packet with an odd payload length
+	basePackets.push_back(checksumVerifierCreatePacket(false, true, "hello"));
+	// 1: valid IPv4 UDP packet
+	basePackets.push_back(checksumVerifierCreatePacket(false, false, "abcdef"));
+	// 2: IPv4 TCP packet with an invalid IPv4 header checksum
+	basePackets.push_back(checksumVerifierCreatePacket(false, true, "hello"));
+	((uint8_t*)basePackets[2]->getRawData())[14 + 10] ^= 0x01;
+	// 3: IPv4 TCP packet with an invalid TCP checksum
+	basePackets.push_back(checksumVerifierCreatePacket(false, true, "hello"));
+	((uint8_t*)basePackets[3]->getRawData())[basePackets[3]->getRawDataLen() - 1] ^= 0x01;
+	// 4: ARP packet, which has no checksums
+	{
+		Packet arpPacket(100);
+		MacAddress srcMac("00:00:00:00:00:01");
+		EthLayer ethLayer(srcMac, MacAddress("ff:ff:ff:ff:ff:ff"), PCPP_ETHERTYPE_ARP);
+		ArpLayer arpLayer(ARP_REQUEST, srcMac, MacAddress("00:00:00:00:00:00"), IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+		arpPacket.addLayer(&ethLayer);
+		arpPacket.addLayer(&arpLayer);
+		basePackets.push_back(new RawPacket(*arpPacket.getRawPacket()));
+	}
+	// 5: valid IPv6 UDP packet
+	basePackets.push_back(checksumVerifierCreatePacket(true, false, "xyz"));
+	// 6: IPv6 TCP packet with an invalid TCP checksum
+	basePackets.push_back(checksumVerifierCreatePacket(true, true, "hello"));
+	((uint8_t*)basePackets[6]->getRawData())[basePackets[6]->getRawDataLen() - 1] ^= 0x01;
+	// 7: IPv4 UDP packet without a checksum
+	basePackets.push_back(checksumVerifierCreatePacket(false, false, "abcdef"));
+	((uint8_t*)basePackets[7]->getRawData())[14 + 20 + 6] = 0;
+	((uint8_t*)basePackets[7]->getRawData())[14 + 20 + 7] = 0;
+	// 8: valid IPv4 TCP packet with a VLAN tag and an IPv4 option
+	basePackets.push_back(checksumVerifierCreatePacket(false, true, "hello", true, true));
+	// 9: the same with a change in the IPv4 option, which invalidates the IPv4 header checksum
+	basePackets.push_back(checksumVerifierCreatePacket(false, true, "hello", true, true));
+	((uint8_t*)basePackets[9]->getRawData())[18 + 22] ^= 0x01;
+	// 10: IPv4 fragment, whose TCP checksum can't be verified
+	basePackets.push_back(checksumVerifierCreatePacket(false, true, "hello"));
+	{
+		iphdr* ipHeader = (iphdr*)(basePackets[10]->getRawData() + 14);
+		ipHeader->fragmentOffset = htons(0x2000);
+		ipHeader->headerChecksum = 0;
+		ScalarBuffer<uint16_t> scalar = { (uint16_t*)ipHeader, sizeof(iphdr) };
+		ipHeader->headerChecksum = htons(compute_checksum(&scalar, 1));
+	}
+	// 11: IPv4 TCP packet whose end wasn't captured
+	basePackets.push_back(checksumVerifierCreatePacket(false, true, "hello"));
+	PTF_ASSERT_TRUE(basePackets[11]->removeData(basePackets[11]->getRawDataLen() - 2, 2));
+
+	// whether each base packet has an IPv4 header checksum and a TCP/UDP checksum to verify, and whether they're valid
+	const bool ipChecked[] = { true, true, true, true, false, false, false, true, true, true, true, true };
+	const bool ipValid[] = { true, true, false, true, true, true, true, true, true, false, true, true };
+	const bool l4Checked[] = { true, true, true, true, false, true, true, false, true, true, false, false };
+	const bool l4Valid[] = { true, true, true, false, true, true, false, true, true, true, true, true };
+
+	// a burst of 40 packets covers all the kernels: 16 packets at a time, 8 at a time and the rest one by one
+	const size_t burstSize = 40;
+	RawPacket* burst[burstSize];
+	uint64_t expectedIPChecked = 0, expectedIPPassed = 0, expectedL4Checked = 0, expectedL4Passed = 0;
+	for (size_t i = 0; i < burstSize; i++)
+	{
+		size_t base = i % basePackets.size();
+		burst[i] = basePackets[base];
+		uint64_t bit = (uint64_t)1 << i;
+		expectedIPChecked |= (ipChecked[base] ? bit : 0);
+		expectedIPPassed |= (ipValid[base] ? bit : 0);
+		expectedL4Checked |= (l4Checked[base] ? bit : 0);
+		expectedL4Passed |= (l4Valid[base] ? bit : 0);
+	}
+
+	ChecksumVerifier verifier;
+	PTF_ASSERT_EQUAL(verifier.getCount(), 0, size);
+	PTF_ASSERT_TRUE(verifier.verifyIPv4HeaderChecksums() == 0);
+	PTF_ASSERT_EQUAL(verifier.load(burst, burstSize), burstSize, size);
+	PTF_ASSERT_EQUAL(verifier.getCount(), burstSize, size);
+	PTF_ASSERT_TRUE(verifier.getLoadedMask() == (((uint64_t)1 << burstSize) - 1));
+
+	uint64_t checked = 0;
+	PTF_ASSERT_TRUE(verifier.verifyIPv4HeaderChecksums(&checked) == expectedIPPassed);
+	PTF_ASSERT_TRUE(checked == expectedIPChecked);
+	PTF_ASSERT_TRUE(verifier.verifyL4Checksums(&checked) == expectedL4Passed);
+	PTF_ASSERT_TRUE(checked == expectedL4Checked);
+
+	// checksums with hints aren't computed
+	verifier.setHints(0, ChecksumVerifier::ChecksumHintBad, ChecksumVerifier::ChecksumHintBad);
+	verifier.setHints(2, ChecksumVerifier::ChecksumHintGood, ChecksumVerifier::ChecksumHintUnknown);
+	verifier.setHints(3, ChecksumVerifier::ChecksumHintUnknown, ChecksumVerifier::ChecksumHintGood);
+	verifier.setHints(4, ChecksumVerifier::ChecksumHintBad, ChecksumVerifier::ChecksumHintBad);
+	verifier.setHints(burstSize, ChecksumVerifier::ChecksumHintBad, ChecksumVerifier::ChecksumHintBad);
+	PTF_ASSERT_TRUE(verifier.verifyIPv4HeaderChecksums(&checked) == ((expectedIPPassed & ~(uint64_t)1) | 4));
+	PTF_ASSERT_TRUE(checked == expectedIPChecked);
+	PTF_ASSERT_TRUE(verifier.verifyL4Checksums(&checked) == ((expectedL4Passed & ~(uint64_t)1) | 8));
+	PTF_ASSERT_TRUE(checked == expectedL4Checked);
+
+	// loading another burst resets the hints, and bursts are limited to 64 packets
+	RawPacket* largeBurst[70];
+	for (size_t i = 0; i < 70; i++)
+		largeBurst[i] = basePackets[1];
+	PTF_ASSERT_EQUAL(verifier.load(largeBurst, 70), 64, size);
+	PTF_ASSERT_TRUE(verifier.getLoadedMask() == ~(uint64_t)0);
+	PTF_ASSERT_TRUE(verifier.verifyIPv4HeaderChecksums(&checked) == ~(uint64_t)0);
+	PTF_ASSERT_TRUE(checked == ~(uint64_t)0);
+	PTF_ASSERT_TRUE(verifier.verifyL4Checksums() == ~(uint64_t)0);
+
+	for (size_t i = 0; i < basePackets.size(); i++)
+		delete basePackets[i];
+} // ChecksumVerifierTest
+
+
+struct StreamNormalizerStats
+{
+	// the data of each connection side, by flow key and side
+	std::map<uint64_t, std::string> data;
+	std::vector<ConnectionData> startedConnections;
+};
+
+static void streamNormalizerMsgReady(int side, TcpStreamData tcpData, void* userCookie)
+{
+	StreamNormalizerStats* stats = (StreamNormalizerStats*)userCookie;
+	stats->data[(uint64_t)tcpData.getConnectionData().flowKey * 2 + side].append((const char*)tcpData.getData(), tcpData.getDataLength());
+}
+
+static void streamNormalizerConnStart(ConnectionData connectionData, void* userCookie)
+{
+	((StreamNormalizerStats*)userCookie)->startedConnections.push_back(connectionData);
+}
+
+// create a tcpReassemblyZeroCopyCreatePacket() packet of a connection from client port 3000, with a timestamp of 10 seconds. The payload
+// bytes depend on their sequence numbers
+static RawPacket* streamNormalizerCreatePacket(bool ipv6, bool fromServer, const char* flags, uint32_t sequence, size_t payloadLen)
+{
+	std::string payload(payloadLen, 'a');
+	for (size_t i = 0; i < payloadLen; i++)
+		payload[i] = (char)('a' + (sequence + i) % 26);
+	RawPacket* rawPacket = tcpReassemblyZeroCopyCreatePacket(sequence, payload.c_str(), 3000, fromServer, flags, 0, ipv6);
+	tcpReassemblySetPacketTime(rawPacket, 10);
+	return rawPacket;
+}
+
+// split the IP payload of a packet created by streamNormalizerCreatePacket() into fragments of fragmentSize bytes (a multiple of 8)
+static void streamNormalizerFragment(const RawPacket* packet, bool ipv6, size_t fragmentSize, std::vector<RawPacket*>& fragments)
+{
+	const uint8_t* data = packet->getRawData();
+	size_t headersLen = sizeof(ether_header) + (ipv6 ? sizeof(ip6_hdr) : sizeof(iphdr));
+	size_t fragHeaderLen = (ipv6 ? sizeof(IPv6FragmentationHeader::ipv6_frag_header) : 0);
+	size_t ipPayloadLen = packet->getRawDataLen() - headersLen;
+	for (size_t offset = 0; offset < ipPayloadLen; offset += fragmentSize)
+	{
+		size_t chunkLen = std::min(fragmentSize, ipPayloadLen - offset);
+		bool moreFragments = (offset + chunkLen < ipPayloadLen);
+		size_t fragmentLen = headersLen + fragHeaderLen + chunkLen;
+		uint8_t* fragmentData = new uint8_t[fragmentLen];
+		memcpy(fragmentData, data, headersLen);
+		memcpy(fragmentData + headersLen + fragHeaderLen, data + headersLen + offset, chunkLen);
+		if (ipv6)
+		{
+			ip6_hdr* ipHeader = (ip6_hdr*)(fragmentData + sizeof(ether_header));
+			ipHeader->nextHeader = PACKETPP_IPPROTO_FRAGMENT;
+			ipHeader->payloadLength = htons((uint16_t)(fragHeaderLen + chunkLen));
+			IPv6FragmentationHeader::ipv6_frag_header* fragHeader = (IPv6FragmentationHeader::ipv6_frag_header*)(fragmentData + headersLen);
+			fragHeader->nextHeader = PACKETPP_IPPROTO_TCP;
+			fragHeader->headerLen = 0;
+			fragHeader->fragOffsetAndFlags = htons((uint16_t)(offset | (moreFragments ? 1 : 0)));
+			fragHeader->id = htonl(0x12345678);
+		}
+		else
+		{
+			iphdr* ipHeader = (iphdr*)(fragmentData + sizeof(ether_header));
+			ipHeader->totalLength = htons((uint16_t)(sizeof(iphdr) + chunkLen));
+			ipHeader->fragmentOffset = htons((uint16_t)((offset / 8) | (moreFragments ? 0x2000 : 0)));
+			ipHeader->headerChecksum = 0;
+			ScalarBuffer<uint16_t> scalar = { (uint16_t*)ipHeader, sizeof(iphdr) };
+			ipHeader->headerChecksum = htons(compute_checksum(&scalar, 1));
+		}
+
+		fragments.push_back(new RawPacket(fragmentData, (int)fragmentLen, packet->getPacketTimeStamp(), true));
+	}
+}
+
+// feed the packets of a connection to a functor. If fragment is set the first data packet of each side is fragmented, and the fragments of
+// the client's packet arrive in reverse order
+template<typename Feed>
+static void streamNormalizerFeedConnection(bool ipv6, bool fragment, Feed& feed)
+{
+	std::vector<RawPacket*> packets;
+	packets.push_back(streamNormalizerCreatePacket(ipv6, false, "S", 100, 0));
+	packets.push_back(streamNormalizerCreatePacket(ipv6, true, "SA", 500, 0));
+	RawPacket* clientData = streamNormalizerCreatePacket(ipv6, false, "A", 101, 1000);
+	RawPacket* serverData = streamNormalizerCreatePacket(ipv6, true, "A", 501, 700);
+	if (fragment)
+	{
+		std::vector<RawPacket*> fragments;
+		streamNormalizerFragment(clientData, ipv6, 400, fragments);
+		packets.insert(packets.end(), fragments.rbegin(), fragments.rend());
+		fragments.clear();
+		streamNormalizerFragment(serverData, ipv6, 256, fragments);
+		packets.insert(packets.end(), fragments.begin(), fragments.end());
+		delete clientData;
+		delete serverData;
+	}
+	else
+	{
+		packets.push_back(clientData);
+		packets.push_back(serverData);
+	}
+	packets.push_back(streamNormalizerCreatePacket(ipv6, false, "A", 1101, 30));
+	packets.push_back(streamNormalizerCreatePacket(ipv6, false, "FA", 1131, 0));
+	packets.push_back(streamNormalizerCreatePacket(ipv6, true, "FA", 1201, 0));
+
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		feed(packets[i]);
+		delete packets[i];
+	}
+}
+
+struct StreamNormalizerFeed
+{
+	StreamNormalizer* normalizer;
+	void operator()(RawPacket* rawPacket) { normalizer->processPacket(rawPacket); }
+};
+
+struct StreamNormalizerTcpFeed
+{
+	TcpReassembly* reassembly;
+	void operator()(RawPacket* rawPacket) { reassembly->reassemblePacket(rawPacket); }
+};
+
+struct StreamNormalizerShardedFeed
+{
+	ShardedTcpReassembly* reassembly;
+	void operator()(RawPacket* rawPacket) { reassembly->reassemblePacket(rawPacket); }
+};
+
+PTF_TEST_CASE(StreamNormalizerTest)
+{
+	// the reassembled packet is built without parsing it: its raw data is the same as that of the packet before it was fragmented
+	for (int ipVersion = 4; ipVersion <= 6; ipVersion += 2)
+	{
+		bool ipv6 = (ipVersion == 6);
+		IPReassembly ipReassembly;
+		RawPacket* original = streamNormalizerCreatePacket(ipv6, false, "A", 101, 1000);
+		std::vector<RawPacket*> fragments;
+		streamNormalizerFragment(original, ipv6, 400, fragments);
+		PTF_ASSERT_EQUAL(fragments.size(), 3, size);
+
+		IPReassembly::ReassemblyStatus status;
+		PacketView view;
+		PacketView reassembledView;
+		RawPacket* reassembled = NULL;
+		for (size_t i = 0; i < fragments.size(); i++)
+		{
+			PTF_ASSERT_TRUE(FlowKeyExtractor::extract(fragments[i], view));
+			PTF_ASSERT_TRUE(view.isFragment);
+			reassembled = ipReassembly.processRawPacket(fragments[i], view, status, reassembledView);
+			if (i < fragments.size() - 1)
+				PTF_ASSERT_NULL(reassembled);
+		}
+
+		PTF_ASSERT_EQUAL(status, IPReassembly::REASSEMBLED, enum);
+		PTF_ASSERT_NOT_NULL(reassembled);
+		PTF_ASSERT_EQUAL(reassembled->getRawDataLen(), original->getRawDataLen(), int);
+		PTF_ASSERT_BUF_COMPARE(reassembled->getRawData(), original->getRawData(), original->getRawDataLen());
+		PTF_ASSERT_EQUAL(ipReassembly.getNumOfPacketsReassembled(), 1, u32);
+		PTF_ASSERT_EQUAL(ipReassembly.getNumOfFragmentsProcessed(), 3, u32);
+
+		// the view of the reassembled packet is the view of the original packet
+		PacketView originalView;
+		FlowKeyExtractor::extract(original, originalView);
+		PTF_ASSERT_FALSE(reassembledView.isFragment);
+		PTF_ASSERT_TRUE(reassembledView.isPacketOfType(TCP));
+		PTF_ASSERT_EQUAL(reassembledView.networkOffset, originalView.networkOffset, u16);
+		PTF_ASSERT_EQUAL(reassembledView.transportOffset, originalView.transportOffset, u16);
+		PTF_ASSERT_EQUAL(reassembledView.payloadOffset, originalView.payloadOffset, u16);
+		PTF_ASSERT_EQUAL(reassembledView.payloadLength, 1000, u32);
+		PTF_ASSERT_EQUAL(reassembledView.srcPort, 3000, u16);
+		PTF_ASSERT_TRUE(reassembledView.protocolTypes == originalView.protocolTypes);
+		delete reassembled;
+
+		// a packet which isn't a fragment is returned as is
+		PTF_ASSERT_TRUE(FlowKeyExtractor::extract(original, view));
+		PTF_ASSERT_TRUE(ipReassembly.processRawPacket(original, view, status, reassembledView) == original);
+		PTF_ASSERT_EQUAL(status, IPReassembly::NON_FRAGMENT, enum);
+
+		// fragments given as RawPacket and as Packet belong to the same packet
+		Packet firstFragment(fragments[0]);
+		PTF_ASSERT_NULL(ipReassembly.processPacket(&firstFragment, status));
+		PTF_ASSERT_EQUAL(status, IPReassembly::FIRST_FRAGMENT, enum);
+		FlowKeyExtractor::extract(fragments[1], view);
+		PTF_ASSERT_NULL(ipReassembly.processRawPacket(fragments[1], view, status, reassembledView));
+		Packet* reassembledPacket = ipReassembly.processPacket(fragments[2], status);
+		PTF_ASSERT_EQUAL(status, IPReassembly::REASSEMBLED, enum);
+		PTF_ASSERT_NOT_NULL(reassembledPacket);
+		PTF_ASSERT_EQUAL(reassembledPacket->getRawPacket()->getRawDataLen(), original->getRawDataLen(), int);
+		PTF_ASSERT_BUF_COMPARE(reassembledPacket->getRawPacket()->getRawData(), original->getRawData(), original->getRawDataLen());
+		delete reassembledPacket;
+		PTF_ASSERT_EQUAL(ipReassembly.getCurrentCapacity(), 0, size);
+
+		for (size_t i = 0; i < fragments.size(); i++)
+			delete fragments[i];
+		delete original;
+	}
+
+	// fragmented connections reach the stream callbacks with the same data and flow keys as connections which weren't fragmented
+	for (int ipVersion = 4; ipVersion <= 6; ipVersion += 2)
+	{
+		bool ipv6 = (ipVersion == 6);
+		StreamNormalizerStats expected;
+		TcpReassembly reassembly(streamNormalizerMsgReady, &expected, streamNormalizerConnStart);
+		StreamNormalizerTcpFeed tcpFeed = { &reassembly };
+		streamNormalizerFeedConnection(ipv6, false, tcpFeed);
+		PTF_ASSERT_EQUAL(expected.startedConnections.size(), 1, size);
+		PTF_ASSERT_EQUAL(expected.data.size(), 2, size);
+
+		RawPacketPool pool;
+		StreamNormalizerStats stats;
+		StreamNormalizer normalizer(streamNormalizerMsgReady, &stats, streamNormalizerConnStart, NULL, TcpReassemblyConfiguration(),
+				StreamNormalizerConfiguration(PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE, 30, 0, &pool));
+		StreamNormalizerFeed feed = { &normalizer };
+		streamNormalizerFeedConnection(ipv6, true, feed);
+		PTF_ASSERT_EQUAL(stats.startedConnections.size(), 1, size);
+		PTF_ASSERT_EQUAL(stats.startedConnections[0].flowKey, expected.startedConnections[0].flowKey, u32);
+		PTF_ASSERT_EQUAL(stats.startedConnections[0].srcPort, 3000, u16);
+		PTF_ASSERT_TRUE(stats.data == expected.data);
+		std::string clientData = stats.data[(uint64_t)expected.startedConnections[0].flowKey * 2];
+		PTF_ASSERT_EQUAL(clientData.size(), 1030, size);
+		PTF_ASSERT_EQUAL(clientData.substr(0, 4), "xyza", string);
+		PTF_ASSERT_EQUAL(normalizer.getIPReassembly().getNumOfPacketsReassembled(), 2, u32);
+		PTF_ASSERT_EQUAL(normalizer.getIPReassembly().getNumOfFragmentsProcessed(), 3 + 3, u32);
+		PTF_ASSERT_EQUAL(normalizer.getTcpReassembly().getConnectionInformation().size(), 1, size);
+
+		// the buffers of the reassembled packets went back to the pool, and both stages are charged to one budget
+		PTF_ASSERT_EQUAL(pool.getNumOfBuffersInUse(), 0, size);
+		PTF_ASSERT_EQUAL(normalizer.getIPReassembly().getMemoryUsage(), 0, size);
+		PTF_ASSERT_TRUE(normalizer.getTcpReassembly().getMemoryBudget() == &normalizer.getMemoryBudget());
+		PTF_ASSERT_TRUE(normalizer.getIPReassembly().getMemoryBudget() == &normalizer.getMemoryBudget());
+	}
+
+	// all fragments and TCP packets of a connection have the same shard hash in both directions
+	std::vector<RawPacket*> packets;
+	packets.push_back(streamNormalizerCreatePacket(false, false, "S", 100, 0));
+	packets.push_back(streamNormalizerCreatePacket(false, true, "SA", 500, 0));
+	RawPacket* fragmentedPacket = streamNormalizerCreatePacket(false, false, "A", 101, 1000);
+	streamNormalizerFragment(fragmentedPacket, false, 400, packets);
+	delete fragmentedPacket;
+	uint32_t firstHash = 0;
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		PacketView view;
+		FlowKeyExtractor::extract(packets[i], view);
+		uint32_t hash = 0;
+		PTF_ASSERT_TRUE(StreamNormalizer::getShardHash(view, hash));
+		if (i == 0)
+			firstHash = hash;
+		PTF_ASSERT_EQUAL(hash, firstHash, u32);
+		delete packets[i];
+	}
+
+	// a sharded reassembly which defragments delivers the same data. The packets are processed on this thread by closeAllConnections()
+	for (int ipVersion = 4; ipVersion <= 6; ipVersion += 2)
+	{
+		bool ipv6 = (ipVersion == 6);
+		StreamNormalizerStats expected;
+		TcpReassembly reassembly(streamNormalizerMsgReady, &expected, streamNormalizerConnStart);
+		StreamNormalizerTcpFeed tcpFeed = { &reassembly };
+		streamNormalizerFeedConnection(ipv6, false, tcpFeed);
+
+		StreamNormalizerStats stats;
+		ShardedTcpReassemblyConfiguration config(4);
+		config.defragment = true;
+		ShardedTcpReassembly shardedReassembly(streamNormalizerMsgReady, &stats, streamNormalizerConnStart, NULL, config);
+		StreamNormalizerShardedFeed shardedFeed = { &shardedReassembly };
+		streamNormalizerFeedConnection(ipv6, true, shardedFeed);
+		uint64_t totals[ShardedTcpReassembly::NumOfStatsCounters];
+		shardedReassembly.getStatsCounters().aggregate(totals);
+		PTF_ASSERT_EQUAL(totals[ShardedTcpReassembly::PacketsIgnored], 0, u32);
+		shardedReassembly.closeAllConnections();
+		PTF_ASSERT_EQUAL(stats.startedConnections.size(), 1, size);
+		PTF_ASSERT_EQUAL(stats.startedConnections[0].flowKey, expected.startedConnections[0].flowKey, u32);
+		PTF_ASSERT_TRUE(stats.data == expected.data);
+
+		// without defragmenting the fragments aren't TCP packets and are ignored
+		StreamNormalizerStats tcpOnlyStats;
+		ShardedTcpReassembly tcpOnlyReassembly(streamNormalizerMsgReady, &tcpOnlyStats, streamNormalizerConnStart, NULL, ShardedTcpReassemblyConfiguration(4));
+		StreamNormalizerShardedFeed tcpOnlyFeed = { &tcpOnlyReassembly };
+		streamNormalizerFeedConnection(ipv6, true, tcpOnlyFeed);
+		tcpOnlyReassembly.getStatsCounters().aggregate(totals);
+		PTF_ASSERT_EQUAL(totals[ShardedTcpReassembly::PacketsIgnored], 3 + 3, u32);
+		tcpOnlyReassembly.closeAllConnections();
+	}
+} // StreamNormalizerTest
+
+
+
+static struct option PacketTestOptions[] =
+{
+	{"tags",  required_argument, 0, 't'},
+	{"mem-verbose", no_argument, 0, 'm' },
+	{"skip-mem-leak-check", no_argument, 0, 's' },
+	{0, 0, 0, 0}
+};
+
+void print_usage()
+{
+    printf("Usage: Packet++Test [-t tags] [-m] [-s]\n\n"
+    		"Flags:\n"
+    		"-t                       A list of semicolon separated tags for tests to run\n"
+			"-m --mem-verbose         Output information about each memory allocation and deallocation\n"			
+            "-s --skip-mem-leak-check Skip memory leak check\n"
+    		);
+}
+
+
+int main(int argc, char* argv[]) {
+
+	int optionIndex = 0;
+	char opt = 0;
+	std::string userTags = "", configTags = "";
+	bool memVerbose = false;
+	bool skipMemLeakCheck = false;
+
+	while((opt = getopt_long (argc, argv, "mst:", PacketTestOptions, &optionIndex)) != -1)
+	{
+		switch (opt)
+		{
+			case 0:
+				break;
+			case 't':
+				userTags = optarg;
+				break;
+			case 's':
+				skipMemLeakCheck = true;
+				break;
+			case 'm':
+				memVerbose = true;
+				break;				
+				
+			default:
+				print_usage();
+				exit(1);
+		}
+	}
+
+	printf("PcapPlusPlus version: %s\n", getPcapPlusPlusVersionFull().c_str());
+	printf("Built: %s\n", getBuildDateTime().c_str());
+	printf("Built from: %s\n", getGitInfo().c_str());
+
+	#ifdef NDEBUG
+	skipMemLeakCheck = true;
+	printf("Disabling memory leak check in MSVC Release builds due to caching logic in stream objects that looks like a memory leak:\n");
+	printf("     https://github.com/cpputest/cpputest/issues/786#issuecomment-148921958\n");
+	#endif
+	
+	if (skipMemLeakCheck)
+	{
+		if (configTags != "")
+			configTags += ";";
+
+		configTags += "skip_mem_leak_check";
+		printf("Skipping memory leak check for all test cases\n");
+	}
+
+	if (memVerbose)
+	{
+		if (configTags != "")
+			configTags += ";";
+
+		configTags += "mem_leak_check_verbose";
+		printf("Turning on verbose information on memory allocations\n");
+	}
+
+	// when the library is built with latency tracing its histograms are allocated the first time a packet is parsed, which would be
+	// reported as a leak of the first test
+	LatencyTracer::registerCurrentThread();
 
 	PTF_START_RUNNING_TESTS(userTags, configTags);
 
@@ -7501,6 +18974,7 @@ int main(int argc, char* argv[]) {
 	PTF_RUN_TEST(Ipv4UdpChecksum, "ipv4");
 	PTF_RUN_TEST(Ipv6UdpPacketParseAndCreate, "ipv6");
 	PTF_RUN_TEST(Ipv6ExtensionsTest, "ipv6");
+	PTF_RUN_TEST(Ipv6ExtensionChainTest, "ipv6");
 	PTF_RUN_TEST(TcpPacketNoOptionsParsing, "tcp");
 	PTF_RUN_TEST(TcpPacketWithOptionsParsing, "tcp");
 	PTF_RUN_TEST(TcpPacketWithOptionsParsing2, "tcp");
@@ -7524,6 +18998,8 @@ int main(int argc, char* argv[]) {
 	PTF_RUN_TEST(DnsLayerResourceCreationTest, "dns");
 	PTF_RUN_TEST(DnsLayerEditTest, "dns");
 	PTF_RUN_TEST(DnsLayerRemoveResourceTest, "dns");
+	PTF_RUN_TEST(DnsMessageViewTest, "dns");
+	PTF_RUN_TEST(DnsResponderTest, "dns");
 	PTF_RUN_TEST(MplsLayerTest, "mpls");
 	PTF_RUN_TEST(CopyLayerAndPacketTest, "copy_layer");
 	PTF_RUN_TEST(IcmpParsingTest, "icmp");
@@ -7541,11 +19017,14 @@ int main(int argc, char* argv[]) {
 	PTF_RUN_TEST(SSLMultipleRecordParsing4Test, "ssl");
 	PTF_RUN_TEST(SSLPartialCertificateParseTest, "ssl");
 	PTF_RUN_TEST(SSLNewSessionTicketParseTest, "ssl");
+	PTF_RUN_TEST(SSLCipherSuiteLookupTest, "ssl");
+	PTF_RUN_TEST(SSLFingerprintTest, "ssl");
 	PTF_RUN_TEST(SllPacketParsingTest, "sll");
 	PTF_RUN_TEST(SllPacketCreationTest, "sll");
 	PTF_RUN_TEST(DhcpParsingTest, "dhcp");
 	PTF_RUN_TEST(DhcpCreationTest, "dhcp");
 	PTF_RUN_TEST(DhcpEditTest, "dhcp");
+	PTF_RUN_TEST(TLVRecordIndexTest, "dhcp;tlv");
 	PTF_RUN_TEST(NullLoopbackTest, "null_loopback");
 	PTF_RUN_TEST(IgmpParsingTest, "igmp");
 	PTF_RUN_TEST(IgmpCreateAndEditTest, "igmp");
@@ -7563,6 +19042,9 @@ int main(int argc, char* argv[]) {
 	PTF_RUN_TEST(SdpLayerParsingTest, "sdp");
 	PTF_RUN_TEST(SdpLayerCreationTest, "sdp");
 	PTF_RUN_TEST(SdpLayerEditTest, "sdp");
+	PTF_RUN_TEST(TextBasedProtocolFieldLookupTest, "sip;http;sdp");
+	PTF_RUN_TEST(SipDialogTrackerTest, "sip;sdp");
+	PTF_RUN_TEST(RtpStreamAnalyzerTest, "rtp;sip;sdp");
 	PTF_RUN_TEST(PacketTrailerTest, "sdp");
 	PTF_RUN_TEST(RadiusLayerParsingTest, "radius");
 	PTF_RUN_TEST(RadiusLayerCreationTest, "radius");
@@ -7570,6 +19052,89 @@ int main(int argc, char* argv[]) {
 	PTF_RUN_TEST(GtpLayerParsingTest, "gtp");
 	PTF_RUN_TEST(GtpLayerCreationTest, "gtp");
 	PTF_RUN_TEST(GtpLayerEditTest, "gtp");
+	PTF_RUN_TEST(LayerArenaTest, "packet;layer_arena");
+	PTF_RUN_TEST(LayerLookupByProtocolTest, "packet;layer_lookup");
+	PTF_RUN_TEST(LazyParsingTest, "packet;lazy_parsing");
+	PTF_RUN_TEST(PacketBatchTest, "packet;packet_batch");
+	PTF_RUN_TEST(ProtocolRegistryTest, "packet;protocol_registry");
+	PTF_RUN_TEST(PacketViewTest, "packet;packet_view");
+	PTF_RUN_TEST(RawPacketPoolTest, "packet;raw_packet_pool");
+	PTF_RUN_TEST(PacketMemoryAllocatorTest, "packet;raw_packet_pool;huge_pages");
+	PTF_RUN_TEST(MoveSemanticsTest, "packet;move");
+	PTF_RUN_TEST(RawPacketHeadroomTest, "packet;headroom");
+	PTF_RUN_TEST(IncrementalChecksumTest, "packet;checksum");
+	PTF_RUN_TEST(ModifiedLayersTest, "packet;checksum;modified_layers");
+	PTF_RUN_TEST(PacketCloneTest, "packet;clone");
+	PTF_RUN_TEST(ChecksumKernelTest, "packet;checksum");
+	PTF_RUN_TEST(StringKernelTest, "packet;string_kernels");
+	PTF_RUN_TEST(FlowHashTest, "packet;flow_hash");
+	PTF_RUN_TEST(TunnelDecapsulatorTest, "packet;tunnel");
+	PTF_RUN_TEST(FixedLRUListTest, "packet;lru");
+	PTF_RUN_TEST(IPAddressValueTest, "packet;ip_address");
+	PTF_RUN_TEST(LoggerAsyncTest, "packet;logger");
+	PTF_RUN_TEST(RawPacketSlabVectorTest, "packet;raw_packet_slab_vector");
+	PTF_RUN_TEST(CoreTopologyTest, "packet;system_utils");
+	PTF_RUN_TEST(TimestampClockTest, "packet;timestamp_clock");
+	PTF_RUN_TEST(AddressFormattingTest, "packet;ip_address");
+	PTF_RUN_TEST(StatsReporterTest, "packet;stats_reporter");
+	PTF_RUN_TEST(TcpReassemblyConnectionTableTest, "packet;tcp_reassembly");
+	PTF_RUN_TEST(TcpReassemblyZeroCopyTest, "packet;tcp_reassembly");
+	PTF_RUN_TEST(TcpReassemblyOutOfOrderTest, "packet;tcp_reassembly");
+	PTF_RUN_TEST(TcpSegmentCoalescerTest, "packet;tcp_reassembly;coalescer");
+	PTF_RUN_TEST(TimerWheelTest, "packet;timer_wheel");
+	PTF_RUN_TEST(TcpReassemblyIdleTimeoutTest, "packet;tcp_reassembly");
+	PTF_RUN_TEST(SPSCQueueTest, "packet;spsc_queue");
+	PTF_RUN_TEST(MPMCQueueTest, "packet;mpmc_queue");
+	PTF_RUN_TEST(ShardedTcpReassemblyTest, "packet;tcp_reassembly;sharded_tcp_reassembly;skip_mem_leak_check");
+	PTF_RUN_TEST(MemoryBudgetTest, "packet;memory_budget");
+	PTF_RUN_TEST(TcpReassemblyMemoryBudgetTest, "packet;tcp_reassembly;memory_budget");
+	PTF_RUN_TEST(IPReassemblyMemoryBudgetTest, "packet;ip_reassembly;memory_budget");
+	PTF_RUN_TEST(IPReassemblyInPlaceTest, "packet;ip_reassembly");
+	PTF_RUN_TEST(IPReassemblyTimeoutTest, "packet;ip_reassembly");
+	PTF_RUN_TEST(ShardedIPReassemblyTest, "packet;ip_reassembly;sharded_ip_reassembly;skip_mem_leak_check");
+	PTF_RUN_TEST(TcpReassemblyCheckpointTest, "packet;tcp_reassembly;checkpoint");
+	PTF_RUN_TEST(TcpReassemblyByteLimitTest, "packet;tcp_reassembly");
+	PTF_RUN_TEST(TcpReassemblyHalfOpenTest, "packet;tcp_reassembly;half_open");
+	PTF_RUN_TEST(IPReassemblyCheckpointTest, "packet;ip_reassembly;checkpoint");
+	PTF_RUN_TEST(RuleClassifierTest, "packet;rule_classifier");
+	PTF_RUN_TEST(MultiPatternMatcherTest, "packet;pattern_matcher");
+	PTF_RUN_TEST(FlowDispatcherTest, "packet;flow_dispatcher;skip_mem_leak_check");
+	PTF_RUN_TEST(ParallelPacketProcessorTest, "packet;parallel;skip_mem_leak_check");
+	PTF_RUN_TEST(HttpStreamParserTest, "packet;http;http_stream_parser");
+	PTF_RUN_TEST(SSLStreamParserTest, "packet;ssl;ssl_stream_parser");
+	PTF_RUN_TEST(StreamCoroutineTest, "packet;stream_coroutine");
+	PTF_RUN_TEST(AllocationBudgetTest, "packet;allocation_budget");
+	PTF_RUN_TEST(TrafficGeneratorTest, "packet;traffic_generator");
+	PTF_RUN_TEST(LatencyTracerTest, "packet;latency_tracer;skip_mem_leak_check");
+	PTF_RUN_TEST(MetricsRegistryTest, "packet;metrics_registry");
+	PTF_RUN_TEST(ParsePerfTest, "perf;perf_parse;skip_mem_leak_check");
+	PTF_RUN_TEST(ChecksumPerfTest, "perf;perf_checksum;skip_mem_leak_check");
+	PTF_RUN_TEST(TcpReassemblyPerfTest, "perf;perf_tcp_reassembly;skip_mem_leak_check");
+	PTF_RUN_TEST(IPReassemblyPerfTest, "perf;perf_ip_reassembly;skip_mem_leak_check");
+	PTF_RUN_TEST(HardwareCountersTest, "packet;hw_counters");
+	PTF_RUN_TEST(HashCountersTest, "packet;hash_counters");
+	PTF_RUN_TEST(FlowTableTest, "packet;flow_table");
+	PTF_RUN_TEST(FlowMeterTest, "packet;flow_meter");
+	PTF_RUN_TEST(FlowExporterTest, "packet;flow_meter;flow_exporter");
+	PTF_RUN_TEST(PacketTemplateTest, "packet;packet_template");
+	PTF_RUN_TEST(PacketSegmenterTest, "packet;packet_segmenter");
+	PTF_RUN_TEST(PacketDeduplicatorTest, "packet;dedup");
+	PTF_RUN_TEST(PayloadClassifierTest, "packet;payload_classifier");
+	PTF_RUN_TEST(StaticPacketTest, "packet;static_packet");
+	PTF_RUN_TEST(PacketDumpWriterTest, "packet;packet_dump_writer");
+	PTF_RUN_TEST(TcpFlowTrackerTest, "packet;tcp_flow_tracker");
+	PTF_RUN_TEST(GtpSessionTableTest, "packet;gtp;gtp_session_table");
+	PTF_RUN_TEST(TrafficShaperTest, "packet;traffic_shaper");
+	PTF_RUN_TEST(CaptureCutoffTest, "packet;capture_cutoff");
+	PTF_RUN_TEST(MacLearningTableTest, "packet;mac_learning_table");
+	PTF_RUN_TEST(DomainMatcherTest, "packet;domain_matcher");
+	PTF_RUN_TEST(HeavyHitterBypassTest, "packet;heavy_hitter");
+	PTF_RUN_TEST(ClusterDistributorTest, "packet;cluster_distributor");
+	PTF_RUN_TEST(PacketReorderBufferTest, "packet;reorder_buffer");
+	PTF_RUN_TEST(LpmTableTest, "packet;lpm_table");
+	PTF_RUN_TEST(L3ForwarderTest, "packet;l3_forwarder");
+	PTF_RUN_TEST(ChecksumVerifierTest, "packet;checksum_verifier");
+	PTF_RUN_TEST(StreamNormalizerTest, "packet;tcp_reassembly;ip_reassembly;stream_normalizer");
 
 	PTF_END_RUNNING_TESTS;
 }
@@ -19,6 +19,19 @@
 #include <TcpReassembly.h>
 #include <IPReassembly.h>
 #include <PcapFileDevice.h>
+#include <PcapFileIndex.h>
+#include <PcapFlowIndex.h>
+#include <PcapFileSummary.h>
+#include <PacketTableWriter.h>
+#include <ParallelPcapFileReader.h>
+#include <RotatingFileWriterDevice.h>
+#include <PrefetchingFileReader.h>
+#include <PacketReplayer.h>
+#include <PacketSampler.h>
+#include <PcapAutoTuner.h>
+#include <MultiInterfacePcapNgWriter.h>
+#include <MultiFileWriter.h>
+#include <StreamSink.h>
 #include <PcapLiveDeviceList.h>
 #include <WinPcapLiveDevice.h>
 #include <PcapLiveDevice.h>
@@ -32,17 +45,33 @@
 #include <string>
 #include <vector>
 #include <PcapFilter.h>
+#include <NativeFilter.h>
 #include <PlatformSpecificUtils.h>
 #include <PcapPlusPlusVersion.h>
 #include <getopt.h>
 #include <stdlib.h>
 #include <SystemUtils.h>
+#include <TimestampClock.h>
 #include <DpdkDeviceList.h>
 #include <DpdkDevice.h>
+#include <DpdkPipeline.h>
+#include <DpdkForwarder.h>
 #include <KniDevice.h>
 #include <KniDeviceList.h>
 #include <NetworkUtils.h>
 #include <RawSocketDevice.h>
+#include <PacketMmapDevice.h>
+#include <XdpDevice.h>
+#include <BsdBpfDevice.h>
+#include <RemoteCaptureDevice.h>
+#include <PacketQueueDevice.h>
+#include <SharedMemoryRingDevice.h>
+#include <FlightRecorderDevice.h>
+#include <MergingReaderDevice.h>
+#include <DeviceReactor.h>
+#include <LatencyTracer.h>
+#include <MetricsRegistry.h>
+#include <BenchmarkHarness.h>
 #include "PcppTestFramework.h"
 #if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV)  //for using ntohl, ntohs, etc.
 #include <in.h>
@@ -385,6 +414,38 @@ public:
 	bool threadRanAndStopped() { return m_RanAndStopped; }
 };
 
+#ifdef USE_DPDK
+class DpdkTestPipelineStage : public DpdkPipelineStage
+{
+private:
+	int m_OutputIndex;
+	ProtocolType m_Protocol;
+	int m_PacketCount;
+public:
+	DpdkTestPipelineStage(const std::string& name, ProtocolType protocol) : DpdkPipelineStage(name), m_OutputIndex(-1), m_Protocol(protocol), m_PacketCount(0) {}
+
+	void setOutputIndex(int outputIndex) { m_OutputIndex = outputIndex; }
+
+	int getPacketCount() { return m_PacketCount; }
+
+protected:
+	// forward the packets of the protocol and drop the others. A stage without an output only counts the packets
+	void processPackets(MBufRawPacket** packets, uint32_t numOfPackets)
+	{
+		for (uint32_t i = 0; i < numOfPackets; i++)
+		{
+			Packet packet(packets[i]);
+			if (m_Protocol != UnknownProtocol && !packet.isPacketOfType(m_Protocol))
+				continue;
+
+			m_PacketCount++;
+			if (m_OutputIndex >= 0)
+				forward(packets[i], m_OutputIndex);
+		}
+	}
+};
+#endif
+
 #ifdef LINUX
 struct KniRequestsCallbacksMock
 {
@@ -833,6 +894,26 @@ PTF_TEST_CASE(TestPcapFileReadWrite)
     PTF_ASSERT(packetVec.size() == 4631, "Bulk read: num of packets in vec isn't 4631");
 
     closeAndValidateFileDevice(ptfResult, &readerDev2);
+
+    // read all packets in a bulk into a slab vector and compare with the packets read before
+    PcapFileReaderDevice readerDev3(EXAMPLE_PCAP_PATH);
+    openAndValidateFileDevice(ptfResult, &readerDev3);
+
+    RawPacketSlabVector slabVec(65536);
+    numOfPacketsRead = readerDev3.getNextPackets(slabVec);
+    PTF_ASSERT(numOfPacketsRead == 4631, "Slab vector bulk read: num of packets read isn't 4631");
+    PTF_ASSERT(slabVec.size() == 4631, "Slab vector bulk read: num of packets in vec isn't 4631");
+    PTF_ASSERT(slabVec.getMemoryUsage() < slabVec.getDataSize() + slabVec.size() * sizeof(RawPacket) + 2 * 65536 + RawPacketSlabVector::DefaultPacketsPerBlock * sizeof(RawPacket),
+    		"Slab vector uses more memory than expected: %d", (int)slabVec.getMemoryUsage());
+
+    RawPacketVector::ConstVectorIterator origIter = packetVec.begin();
+    for (RawPacketSlabVector::ConstVectorIterator iter = slabVec.begin(); iter != slabVec.end(); iter++, origIter++)
+    {
+    	PTF_ASSERT((*iter)->getRawDataLen() == (*origIter)->getRawDataLen(), "Slab vector packet length is different");
+    	PTF_ASSERT(memcmp((*iter)->getRawData(), (*origIter)->getRawData(), (*iter)->getRawDataLen()) == 0, "Slab vector packet data is different");
+    }
+
+    closeAndValidateFileDevice(ptfResult, &readerDev3);
 }
 
 PTF_TEST_CASE(TestPcapSllFileReadWrite)
@@ -977,21 +1058,2647 @@ PTF_TEST_CASE(TestPcapFileAppend)
 	    readerDev.close();
 	}
 
-	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_WRITE_PATH);
-	PTF_ASSERT(readerDev.open(), "cannot open reader device to read result file");
-	int counter = 0;
-	RawPacket rawPacket;
-    while (readerDev.getNextPacket(rawPacket))
-    	counter++;
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_WRITE_PATH);
+	PTF_ASSERT(readerDev.open(), "cannot open reader device to read result file");
+	int counter = 0;
+	RawPacket rawPacket;
+    while (readerDev.getNextPacket(rawPacket))
+    	counter++;
+
+    PTF_ASSERT(counter == (4631*5), "Number of read packets different than expected. Read: %d, expected: %d", counter, 4631*6);
+
+    LoggerPP::getInstance().supressErrors();
+    PcapFileWriterDevice writerDev2(EXAMPLE_PCAP_WRITE_PATH, LINKTYPE_LINUX_SLL);
+    PTF_ASSERT(writerDev2.open(true) == false, "Managed to open file in append mode even though link layer types are different");
+    LoggerPP::getInstance().enableErrors();
+
+}
+
+PTF_TEST_CASE(TestBufferedPcapFileWriter)
+{
+	// small buffers, so the file is written in many buffers while packets are copied
+	BufferedPcapFileWriterConfiguration config(64 * 1024, true, 0, BufferedPcapFileWriterConfiguration::SyncEveryFlush);
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	BufferedPcapFileWriterDevice writerDev(EXAMPLE_PCAP_WRITE_PATH, LINKTYPE_ETHERNET, false, config);
+	PTF_ASSERT(readerDev.open(), "cannot open reader device");
+	PTF_ASSERT(writerDev.open(), "cannot open buffered writer device");
+
+	RawPacket rawPacket;
+	int packetCount = 0;
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		PTF_ASSERT(writerDev.writePacket(rawPacket), "cannot write packet #%d", packetCount);
+		packetCount++;
+	}
+	readerDev.close();
+
+	pcap_stat stats;
+	PTF_ASSERT_TRUE(writerDev.flush());
+	writerDev.getStatistics(stats);
+	PTF_ASSERT_EQUAL((int)stats.ps_recv, packetCount, int);
+	PTF_ASSERT_EQUAL((int)stats.ps_drop, 0, int);
+	writerDev.close();
+
+	// the file holds the same packets as the original one
+	PcapFileReaderDevice originalReaderDev(EXAMPLE_PCAP_PATH);
+	PcapFileReaderDevice writtenReaderDev(EXAMPLE_PCAP_WRITE_PATH);
+	PTF_ASSERT(originalReaderDev.open(), "cannot open reader device");
+	PTF_ASSERT(writtenReaderDev.open(), "cannot open reader device of the written file");
+	RawPacket writtenRawPacket;
+	int writtenCount = 0;
+	while (originalReaderDev.getNextPacket(rawPacket))
+	{
+		PTF_ASSERT(writtenReaderDev.getNextPacket(writtenRawPacket), "written file ended after %d packets", writtenCount);
+		PTF_ASSERT_EQUAL(writtenRawPacket.getRawDataLen(), rawPacket.getRawDataLen(), int);
+		PTF_ASSERT_EQUAL(writtenRawPacket.getFrameLength(), rawPacket.getFrameLength(), int);
+		PTF_ASSERT_BUF_COMPARE(writtenRawPacket.getRawData(), rawPacket.getRawData(), rawPacket.getRawDataLen());
+		PTF_ASSERT_TRUE(writtenRawPacket.getPacketTimeStamp().tv_sec == rawPacket.getPacketTimeStamp().tv_sec);
+		PTF_ASSERT_TRUE(writtenRawPacket.getPacketTimeStamp().tv_usec == rawPacket.getPacketTimeStamp().tv_usec);
+		writtenCount++;
+	}
+	PTF_ASSERT_FALSE(writtenReaderDev.getNextPacket(writtenRawPacket));
+	originalReaderDev.close();
+	writtenReaderDev.close();
+
+	// in append mode the packets are written after the existing ones, and closing the file writes what's left in the buffers
+	PcapFileReaderDevice appendReaderDev(EXAMPLE_PCAP_PATH);
+	BufferedPcapFileWriterDevice appendWriterDev(EXAMPLE_PCAP_WRITE_PATH, LINKTYPE_ETHERNET, false, config);
+	PTF_ASSERT(appendReaderDev.open(), "cannot open reader device");
+	PTF_ASSERT(appendWriterDev.open(true), "cannot open buffered writer device in append mode");
+	RawPacketVector packetVec;
+	appendReaderDev.getNextPackets(packetVec);
+	PTF_ASSERT_TRUE(appendWriterDev.writePackets(packetVec));
+	appendReaderDev.close();
+	appendWriterDev.close();
+	appendWriterDev.getStatistics(stats);
+	PTF_ASSERT_EQUAL((int)stats.ps_recv, packetCount, int);
+
+	PcapFileReaderDevice appendedReaderDev(EXAMPLE_PCAP_WRITE_PATH);
+	PTF_ASSERT(appendedReaderDev.open(), "cannot open reader device of the appended file");
+	int appendedCount = 0;
+	while (appendedReaderDev.getNextPacket(rawPacket))
+		appendedCount++;
+	PTF_ASSERT_EQUAL(appendedCount, 2 * packetCount, int);
+	appendedReaderDev.close();
+
+	// packets larger than a buffer aren't written and are counted as dropped
+	BufferedPcapFileWriterDevice smallBufferWriterDev(EXAMPLE_PCAP_WRITE_PATH, LINKTYPE_ETHERNET, false, BufferedPcapFileWriterConfiguration(200, true));
+	PTF_ASSERT(smallBufferWriterDev.open(), "cannot open buffered writer device");
+	int smallPacketCount = 0;
+	for (RawPacketVector::VectorIterator iter = packetVec.begin(); iter != packetVec.end(); iter++)
+	{
+		bool fits = ((*iter)->getRawDataLen() + 16 <= 200);
+		PTF_ASSERT_TRUE(smallBufferWriterDev.writePacket(**iter) == fits);
+		if (fits)
+			smallPacketCount++;
+	}
+	smallBufferWriterDev.close();
+	smallBufferWriterDev.getStatistics(stats);
+	PTF_ASSERT_EQUAL((int)stats.ps_recv, smallPacketCount, int);
+	PTF_ASSERT_EQUAL((int)stats.ps_drop, packetCount - smallPacketCount, int);
+
+	LoggerPP::getInstance().supressErrors();
+	BufferedPcapFileWriterDevice otherLinkTypeWriterDev(EXAMPLE_PCAP_WRITE_PATH, LINKTYPE_LINUX_SLL);
+	PTF_ASSERT_FALSE(otherLinkTypeWriterDev.open(true));
+	PTF_ASSERT_FALSE(otherLinkTypeWriterDev.writePacket(rawPacket));
+	LoggerPP::getInstance().enableErrors();
+}
+
+PTF_TEST_CASE(TestRotatingFileWriter)
+{
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(readerDev.open(), "cannot open reader device");
+	RawPacketVector packetVec;
+	int packetCount = readerDev.getNextPackets(packetVec);
+	readerDev.close();
+
+	// files are rolled over by size and only the last 3 are kept
+	RotatingFileWriterDevice sizeWriterDev("PcapExamples/rotating.pcap", RotatingFileWriterConfiguration(500 * 1024, 0, 3));
+	PTF_ASSERT(sizeWriterDev.open(), "cannot open rotating writer device");
+	PTF_ASSERT_TRUE(sizeWriterDev.getCurrentFileName() == "PcapExamples/rotating_000000.pcap");
+	PTF_ASSERT_TRUE(sizeWriterDev.writePackets(packetVec));
+	std::vector<std::string> fileNames = sizeWriterDev.getFileNames();
+	PTF_ASSERT_EQUAL(fileNames.size(), 3, size);
+	PTF_ASSERT_TRUE(fileNames.back() == sizeWriterDev.getCurrentFileName());
+	sizeWriterDev.close();
+
+	pcap_stat stats;
+	sizeWriterDev.getStatistics(stats);
+	PTF_ASSERT_EQUAL((int)stats.ps_recv, packetCount, int);
+	PTF_ASSERT_EQUAL((int)stats.ps_drop, 0, int);
+
+	// the kept files hold the last packets, the earlier files were deleted
+	int keptPacketCount = 0;
+	RawPacket rawPacket;
+	for (std::vector<std::string>::iterator iter = fileNames.begin(); iter != fileNames.end(); iter++)
+	{
+		PcapFileReaderDevice keptReaderDev(iter->c_str());
+		PTF_ASSERT(keptReaderDev.open(), "cannot open file '%s'", iter->c_str());
+		while (keptReaderDev.getNextPacket(rawPacket))
+			keptPacketCount++;
+		keptReaderDev.close();
+		PTF_ASSERT_TRUE(std::ifstream(iter->c_str(), std::ios::binary | std::ios::ate).tellg() <= 500 * 1024);
+	}
+	PTF_ASSERT_TRUE(keptPacketCount > 0 && keptPacketCount < packetCount);
+	PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), packetVec.at(packetCount - 1)->getRawDataLen(), int);
+	PTF_ASSERT_FALSE(std::ifstream("PcapExamples/rotating_000000.pcap").good());
+	for (std::vector<std::string>::iterator iter = fileNames.begin(); iter != fileNames.end(); iter++)
+		remove(iter->c_str());
+
+	// files are rolled over by packet time and all of them are kept
+	RotatingFileWriterDevice timeWriterDev("PcapExamples/rotating.pcapng", RotatingFileWriterConfiguration(0, 3, 0, true));
+	PTF_ASSERT(timeWriterDev.open(), "cannot open rotating writer device");
+	PTF_ASSERT_TRUE(timeWriterDev.writePackets(packetVec));
+	fileNames = timeWriterDev.getFileNames();
+	timeWriterDev.close();
+	PTF_ASSERT_TRUE(fileNames.size() > 1);
+
+	int writtenPacketCount = 0;
+	for (std::vector<std::string>::iterator iter = fileNames.begin(); iter != fileNames.end(); iter++)
+	{
+		PcapNgFileReaderDevice timeReaderDev(iter->c_str());
+		PTF_ASSERT(timeReaderDev.open(), "cannot open file '%s'", iter->c_str());
+		PTF_ASSERT_TRUE(timeReaderDev.getNextPacket(rawPacket));
+		time_t firstPacketTime = rawPacket.getPacketTimeStamp().tv_sec;
+		writtenPacketCount++;
+		while (timeReaderDev.getNextPacket(rawPacket))
+		{
+			PTF_ASSERT_TRUE(rawPacket.getPacketTimeStamp().tv_sec - firstPacketTime < 3);
+			writtenPacketCount++;
+		}
+		timeReaderDev.close();
+		remove(iter->c_str());
+	}
+	PTF_ASSERT_EQUAL(writtenPacketCount, packetCount, int);
+
+	LoggerPP::getInstance().supressErrors();
+	RotatingFileWriterDevice appendWriterDev("PcapExamples/rotating.pcap");
+	PTF_ASSERT_FALSE(appendWriterDev.open(true));
+	PTF_ASSERT_FALSE(appendWriterDev.writePacket(rawPacket));
+	LoggerPP::getInstance().enableErrors();
+}
+
+PTF_TEST_CASE(TestPcapFileNanoPrecision)
+{
+	uint8_t data[64];
+	memset(data, 0xab, sizeof(data));
+	timespec ts;
+	ts.tv_sec = 1500000000;
+	ts.tv_nsec = 123456789;
+	RawPacket rawPacket(data, sizeof(data), ts, false);
+
+	PcapFileWriterDevice writerDev(EXAMPLE_PCAP_WRITE_PATH, LINKTYPE_ETHERNET, true);
+	PTF_ASSERT(writerDev.open(), "Cannot open writer dev");
+	PTF_ASSERT(writerDev.writePacket(rawPacket), "Cannot write packet");
+	writerDev.close();
+	bool nanoWritten = writerDev.isNanosecondsPrecision();
+
+	// appending keeps the precision of the file
+	PcapFileWriterDevice appendDev(EXAMPLE_PCAP_WRITE_PATH);
+	PTF_ASSERT(appendDev.open(true), "Cannot open the pcap file in append mode");
+	PTF_ASSERT(appendDev.isNanosecondsPrecision() == nanoWritten, "Append mode didn't adopt the precision of the file");
+	PTF_ASSERT(appendDev.writePacket(rawPacket), "Cannot append packet");
+	appendDev.close();
+
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_WRITE_PATH);
+	PTF_ASSERT(readerDev.open(), "cannot open reader device");
+	RawPacket readPacket;
+	int counter = 0;
+	while (readerDev.getNextPacket(readPacket))
+	{
+		timespec readTs = readPacket.getPacketTimeStampNs();
+		PTF_ASSERT(readTs.tv_sec == ts.tv_sec, "Packet #%d: wrong seconds %d", counter, (int)readTs.tv_sec);
+		PTF_ASSERT(readTs.tv_nsec == (nanoWritten ? ts.tv_nsec : 123456000), "Packet #%d: wrong nanoseconds %d", counter, (int)readTs.tv_nsec);
+		PTF_ASSERT(readPacket.getRawDataLen() == (int)sizeof(data), "Packet #%d: wrong length", counter);
+		counter++;
+	}
+	readerDev.close();
+	PTF_ASSERT(counter == 2, "Read %d packets instead of 2", counter);
+}
+
+PTF_TEST_CASE(TestMmapPcapFileReader)
+{
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	MmapPcapFileReaderDevice mmapReaderDev(EXAMPLE_PCAP_PATH, 64 * 1024);
+	PTF_ASSERT(readerDev.open(), "cannot open reader device");
+	PTF_ASSERT(mmapReaderDev.open(), "cannot open mmap reader device");
+	PTF_ASSERT_EQUAL(mmapReaderDev.getLinkLayerType(), readerDev.getLinkLayerType(), enum);
+
+	// the mmap reader returns the same packets, pointing to the mapped file instead of copying them
+	RawPacket rawPacket;
+	RawPacket mmapRawPacket;
+	int packetCount = 0;
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		PTF_ASSERT(mmapReaderDev.getNextPacket(mmapRawPacket), "mmap reader stopped after %d packets", packetCount);
+		PTF_ASSERT_EQUAL(mmapRawPacket.getRawDataLen(), rawPacket.getRawDataLen(), int);
+		PTF_ASSERT_EQUAL(mmapRawPacket.getFrameLength(), rawPacket.getFrameLength(), int);
+		PTF_ASSERT_BUF_COMPARE(mmapRawPacket.getRawData(), rawPacket.getRawData(), rawPacket.getRawDataLen());
+		PTF_ASSERT_TRUE(mmapRawPacket.getPacketTimeStampNs().tv_sec == rawPacket.getPacketTimeStampNs().tv_sec);
+		PTF_ASSERT_TRUE(mmapRawPacket.getPacketTimeStampNs().tv_nsec == rawPacket.getPacketTimeStampNs().tv_nsec);
+		packetCount++;
+	}
+	PTF_ASSERT_FALSE(mmapReaderDev.getNextPacket(mmapRawPacket));
+
+	pcap_stat stats;
+	mmapReaderDev.getStatistics(stats);
+	PTF_ASSERT_EQUAL((int)stats.ps_recv, packetCount, int);
+	readerDev.close();
+	mmapReaderDev.close();
+
+	// the packets read into a vector stay valid until the file is closed
+	MmapPcapFileReaderDevice vectorReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(vectorReaderDev.open(), "cannot open mmap reader device");
+	RawPacketVector packetVec;
+	PTF_ASSERT_EQUAL(vectorReaderDev.getNextPackets(packetVec), packetCount, int);
+	int tcpCount = 0;
+	for (RawPacketVector::VectorIterator iter = packetVec.begin(); iter != packetVec.end(); iter++)
+	{
+		Packet packet(*iter);
+		if (packet.isPacketOfType(TCP))
+			tcpCount++;
+	}
+	packetVec.clear();
+	vectorReaderDev.close();
+
+	// filters are matched in user space
+	MmapPcapFileReaderDevice filterReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(filterReaderDev.setFilter("tcp"), "cannot set filter");
+	PTF_ASSERT(filterReaderDev.open(), "cannot open mmap reader device");
+	int filteredCount = 0;
+	while (filterReaderDev.getNextPacket(mmapRawPacket))
+		filteredCount++;
+	PTF_ASSERT_EQUAL(filteredCount, tcpCount, int);
+	filterReaderDev.close();
+
+	// a file which isn't a pcap file isn't opened
+	LoggerPP::getInstance().supressErrors();
+	MmapPcapFileReaderDevice pcapNgReaderDev(EXAMPLE_PCAPNG_PATH);
+	PTF_ASSERT_FALSE(pcapNgReaderDev.open());
+	MmapPcapFileReaderDevice notExistReaderDev("PcapExamples/not_exist.pcap");
+	PTF_ASSERT_FALSE(notExistReaderDev.open());
+	LoggerPP::getInstance().enableErrors();
+}
+
+static void swapUInt32InPlace(std::vector<uint8_t>& data, size_t offset)
+{
+	std::swap(data[offset], data[offset + 3]);
+	std::swap(data[offset + 1], data[offset + 2]);
+}
+
+PTF_TEST_CASE(TestBufferedPcapFileReader)
+{
+	// a buffer smaller than some records makes the reader refill and grow it
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	BufferedPcapFileReaderDevice bufferedReaderDev(EXAMPLE_PCAP_PATH, 1000);
+	PTF_ASSERT(readerDev.open(), "cannot open reader device");
+	PTF_ASSERT(bufferedReaderDev.open(), "cannot open buffered reader device");
+	PTF_ASSERT_EQUAL(bufferedReaderDev.getLinkLayerType(), readerDev.getLinkLayerType(), enum);
+
+	RawPacketPool pool;
+	bufferedReaderDev.setRawPacketPool(&pool);
+	RawPacket rawPacket;
+	RawPacket bufferedRawPacket;
+	int packetCount = 0;
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		PTF_ASSERT(bufferedReaderDev.getNextPacket(bufferedRawPacket), "buffered reader stopped after %d packets", packetCount);
+		PTF_ASSERT_EQUAL(bufferedRawPacket.getRawDataLen(), rawPacket.getRawDataLen(), int);
+		PTF_ASSERT_EQUAL(bufferedRawPacket.getFrameLength(), rawPacket.getFrameLength(), int);
+		PTF_ASSERT_BUF_COMPARE(bufferedRawPacket.getRawData(), rawPacket.getRawData(), rawPacket.getRawDataLen());
+		PTF_ASSERT_TRUE(bufferedRawPacket.getPacketTimeStampNs().tv_sec == rawPacket.getPacketTimeStampNs().tv_sec);
+		PTF_ASSERT_TRUE(bufferedRawPacket.getPacketTimeStampNs().tv_nsec == rawPacket.getPacketTimeStampNs().tv_nsec);
+		packetCount++;
+	}
+	PTF_ASSERT_FALSE(bufferedReaderDev.getNextPacket(bufferedRawPacket));
+
+	pcap_stat stats;
+	bufferedReaderDev.getStatistics(stats);
+	PTF_ASSERT_EQUAL((int)stats.ps_recv, packetCount, int);
+	bufferedRawPacket.clear();
+	readerDev.close();
+	bufferedReaderDev.close();
+
+	// packets are copied, so the packets read into a vector outlive the device
+	RawPacketVector packetVec;
+	int tcpCount = 0;
+	{
+		BufferedPcapFileReaderDevice vectorReaderDev(EXAMPLE_PCAP_PATH);
+		PTF_ASSERT(vectorReaderDev.open(), "cannot open buffered reader device");
+		PTF_ASSERT_EQUAL(vectorReaderDev.getNextPackets(packetVec, 10), 10, int);
+		PTF_ASSERT_EQUAL(vectorReaderDev.getNextPackets(packetVec), packetCount - 10, int);
+	}
+	for (RawPacketVector::VectorIterator iter = packetVec.begin(); iter != packetVec.end(); iter++)
+	{
+		Packet packet(*iter);
+		if (packet.isPacketOfType(TCP))
+			tcpCount++;
+	}
+
+	// filters are matched in user space
+	BufferedPcapFileReaderDevice filterReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(filterReaderDev.setFilter("tcp"), "cannot set filter");
+	PTF_ASSERT(filterReaderDev.open(), "cannot open buffered reader device");
+	int filteredCount = 0;
+	while (filterReaderDev.getNextPacket(bufferedRawPacket))
+		filteredCount++;
+	PTF_ASSERT_EQUAL(filteredCount, tcpCount, int);
+	filterReaderDev.close();
+
+	// a file written on a host of the other byte order has its headers byte-swapped
+	std::ifstream fileStream(EXAMPLE_PCAP_PATH, std::ifstream::binary);
+	std::vector<uint8_t> fileData((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+	fileStream.close();
+	std::swap(fileData[4], fileData[5]);
+	std::swap(fileData[6], fileData[7]);
+	for (size_t offset = 8; offset < 24; offset += 4)
+		swapUInt32InPlace(fileData, offset);
+	swapUInt32InPlace(fileData, 0);
+	for (size_t offset = 24; offset + 16 <= fileData.size(); )
+	{
+		uint32_t capturedLen;
+		memcpy(&capturedLen, &fileData[offset + 8], sizeof(capturedLen));
+		for (size_t field = 0; field < 16; field += 4)
+			swapUInt32InPlace(fileData, offset + field);
+		offset += 16 + capturedLen;
+	}
+	const char* swappedFileName = "PcapExamples/example_swapped.pcap";
+	FILE* swappedFile = fopen(swappedFileName, "wb");
+	PTF_ASSERT_TRUE(swappedFile != NULL);
+	fwrite(&fileData[0], 1, fileData.size(), swappedFile);
+	fclose(swappedFile);
+
+	BufferedPcapFileReaderDevice swappedReaderDev(swappedFileName);
+	PTF_ASSERT(swappedReaderDev.open(), "cannot open byte-swapped file");
+	PTF_ASSERT_EQUAL(swappedReaderDev.getLinkLayerType(), LINKTYPE_ETHERNET, enum);
+	int swappedCount = 0;
+	for (RawPacketVector::VectorIterator iter = packetVec.begin(); iter != packetVec.end(); iter++, swappedCount++)
+	{
+		PTF_ASSERT(swappedReaderDev.getNextPacket(bufferedRawPacket), "byte-swapped reader stopped after %d packets", swappedCount);
+		PTF_ASSERT_EQUAL(bufferedRawPacket.getRawDataLen(), (*iter)->getRawDataLen(), int);
+		PTF_ASSERT_TRUE(bufferedRawPacket.getPacketTimeStampNs().tv_sec == (*iter)->getPacketTimeStampNs().tv_sec);
+	}
+	PTF_ASSERT_FALSE(swappedReaderDev.getNextPacket(bufferedRawPacket));
+	swappedReaderDev.close();
+	remove(swappedFileName);
+	packetVec.clear();
+
+	// a file which isn't a pcap file isn't opened
+	LoggerPP::getInstance().supressErrors();
+	BufferedPcapFileReaderDevice pcapNgReaderDev(EXAMPLE_PCAPNG_PATH);
+	PTF_ASSERT_FALSE(pcapNgReaderDev.open());
+	BufferedPcapFileReaderDevice notExistReaderDev("PcapExamples/not_exist.pcap");
+	PTF_ASSERT_FALSE(notExistReaderDev.open());
+	LoggerPP::getInstance().enableErrors();
+}
+
+static void appendFileBytes(const char* fileName, const std::vector<uint8_t>& data, size_t from, size_t to, bool truncate = false)
+{
+	FILE* file = fopen(fileName, truncate ? "wb" : "ab");
+	fwrite(&data[from], 1, to - from, file);
+	fclose(file);
+}
+
+PTF_TEST_CASE(TestBufferedPcapFileFollow)
+{
+	// the example file is written in steps, as a capturing process would write it
+	std::ifstream fileStream(EXAMPLE_PCAP_PATH, std::ifstream::binary);
+	std::vector<uint8_t> fileData((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+	fileStream.close();
+	std::vector<size_t> recordOffsets;
+	for (size_t offset = 24; offset + 16 <= fileData.size() && recordOffsets.size() < 30; )
+	{
+		recordOffsets.push_back(offset);
+		uint32_t capturedLen;
+		memcpy(&capturedLen, &fileData[offset + 8], sizeof(capturedLen));
+		offset += 16 + capturedLen;
+	}
+	PTF_ASSERT_EQUAL((int)recordOffsets.size(), 30, int);
+
+	const char* fileName = "PcapExamples/follow_000000.pcap";
+	const char* nextFileName = "PcapExamples/follow_000001.pcap";
+	remove(nextFileName);
+	appendFileBytes(fileName, fileData, 0, recordOffsets[10], true);
+
+	BufferedPcapFileReaderDevice readerDev(fileName, 1000);
+	PcapFileFollowConfiguration config(20, true);
+	config.rotationDelayMs = 0;
+	readerDev.setFollowMode(config);
+	PTF_ASSERT_TRUE(readerDev.isFollowing());
+	PTF_ASSERT(readerDev.open(), "cannot open followed file");
+	RawPacketVector packetVec;
+	PTF_ASSERT_EQUAL(readerDev.getNextPackets(packetVec), 10, int);
+
+	// a record which is partly written is read once it's complete
+	RawPacket rawPacket;
+	appendFileBytes(fileName, fileData, recordOffsets[10], recordOffsets[10] + 20);
+	PTF_ASSERT_FALSE(readerDev.getNextPacket(rawPacket));
+	appendFileBytes(fileName, fileData, recordOffsets[10] + 20, recordOffsets[12]);
+	PTF_ASSERT_TRUE(readerDev.getNextPacket(rawPacket));
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), &fileData[recordOffsets[10] + 16], rawPacket.getRawDataLen());
+	PTF_ASSERT_TRUE(readerDev.getNextPacket(rawPacket));
+	PTF_ASSERT_FALSE(readerDev.getNextPacket(rawPacket));
+
+	// the next file of the sequence is followed once it has packets
+	appendFileBytes(nextFileName, fileData, 0, 24, true);
+	PTF_ASSERT_FALSE(readerDev.getNextPacket(rawPacket));
+	PTF_ASSERT_EQUAL(readerDev.getNumOfRotations(), 0, u32);
+	appendFileBytes(nextFileName, fileData, recordOffsets[20], recordOffsets[25]);
+	PTF_ASSERT_TRUE(readerDev.getNextPacket(rawPacket));
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), &fileData[recordOffsets[20] + 16], rawPacket.getRawDataLen());
+	PTF_ASSERT_EQUAL(readerDev.getNumOfRotations(), 1, u32);
+	PTF_ASSERT_EQUAL(readerDev.getFileName(), std::string(nextFileName), string);
+
+	// a file which is rewritten is read from its start
+	packetVec.clear();
+	PTF_ASSERT_EQUAL(readerDev.getNextPackets(packetVec), 4, int);
+	appendFileBytes(nextFileName, fileData, 0, recordOffsets[2], true);
+	PTF_ASSERT_TRUE(readerDev.getNextPacket(rawPacket));
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), &fileData[recordOffsets[0] + 16], rawPacket.getRawDataLen());
+
+	// stopping makes reading return at the end of the file without waiting
+	config.waitTimeoutMs = -1;
+	readerDev.setFollowMode(config);
+	PTF_ASSERT_TRUE(readerDev.getNextPacket(rawPacket));
+	readerDev.stopFollowing();
+	PTF_ASSERT_FALSE(readerDev.getNextPacket(rawPacket));
+	readerDev.clearFollowMode();
+	PTF_ASSERT_FALSE(readerDev.isFollowing());
+	readerDev.close();
+
+	remove(fileName);
+	remove(nextFileName);
+}
+
+PTF_TEST_CASE(TestPrefetchingFileReader)
+{
+	// the packets of every file reader device are read ahead in batches, small batches make the threads wait for each other
+	const char* fileNames[] = { EXAMPLE_PCAP_PATH, EXAMPLE_PCAPNG_PATH };
+	for (size_t i = 0; i < sizeof(fileNames) / sizeof(fileNames[0]); i++)
+	{
+		IFileReaderDevice* readerDev = IFileReaderDevice::getReader(fileNames[i]);
+		PTF_ASSERT(readerDev->open(), "cannot open reader device of '%s'", fileNames[i]);
+		RawPacketVector packetVec;
+		readerDev->getNextPackets(packetVec);
+		PTF_ASSERT_TRUE(packetVec.size() > 0);
+		readerDev->close();
+
+		PTF_ASSERT(readerDev->open(), "cannot reopen reader device of '%s'", fileNames[i]);
+		PrefetchingFileReader prefetchingReader(*readerDev, 7, 2);
+		PTF_ASSERT_TRUE(prefetchingReader.start());
+		PTF_ASSERT_TRUE(prefetchingReader.isRunning());
+		LoggerPP::getInstance().supressErrors();
+		PTF_ASSERT_FALSE(prefetchingReader.start());
+		LoggerPP::getInstance().enableErrors();
+
+		size_t packetCount = 0;
+		RawPacket* rawPacket;
+		while ((rawPacket = prefetchingReader.getNextPacket()) != NULL)
+		{
+			PTF_ASSERT_TRUE(packetCount < packetVec.size());
+			RawPacket* expectedPacket = packetVec.at(packetCount);
+			PTF_ASSERT_EQUAL(rawPacket->getRawDataLen(), expectedPacket->getRawDataLen(), int);
+			PTF_ASSERT_BUF_COMPARE(rawPacket->getRawData(), expectedPacket->getRawData(), expectedPacket->getRawDataLen());
+			PTF_ASSERT_TRUE(rawPacket->getPacketTimeStampNs().tv_sec == expectedPacket->getPacketTimeStampNs().tv_sec);
+			PTF_ASSERT_TRUE(rawPacket->getPacketTimeStampNs().tv_nsec == expectedPacket->getPacketTimeStampNs().tv_nsec);
+			packetCount++;
+		}
+		PTF_ASSERT_EQUAL(packetCount, packetVec.size(), size);
+		PTF_ASSERT_EQUAL((size_t)prefetchingReader.getNumOfPacketsTaken(), packetVec.size(), size);
+		PTF_ASSERT_TRUE(prefetchingReader.getNextPacket() == NULL);
+		PTF_ASSERT_TRUE(prefetchingReader.getNextBatch() == NULL);
+		prefetchingReader.stop();
+		PTF_ASSERT_FALSE(prefetchingReader.isRunning());
+		readerDev->close();
+
+		// taking whole batches, stopping in the middle of the file and starting again continues from where the background thread stopped
+		PTF_ASSERT(readerDev->open(), "cannot reopen reader device of '%s'", fileNames[i]);
+		PrefetchingFileReader batchReader(*readerDev, 10);
+		PTF_ASSERT_TRUE(batchReader.start());
+		RawPacketSlabVector* batch = batchReader.getNextBatch();
+		PTF_ASSERT_TRUE(batch != NULL);
+		PTF_ASSERT_EQUAL(batch->size(), (size_t)10, size);
+		PTF_ASSERT_BUF_COMPARE(batch->front()->getRawData(), packetVec.front()->getRawData(), packetVec.front()->getRawDataLen());
+		batchReader.stop();
+		PTF_ASSERT_TRUE(batchReader.getNextBatch() == NULL);
+		pcap_stat stats;
+		readerDev->getStatistics(stats);
+		size_t numOfPacketsRead = stats.ps_recv;
+		PTF_ASSERT_TRUE(numOfPacketsRead >= 10 && numOfPacketsRead < packetVec.size());
+
+		PTF_ASSERT_TRUE(batchReader.start());
+		packetCount = numOfPacketsRead;
+		while ((batch = batchReader.getNextBatch()) != NULL)
+		{
+			PTF_ASSERT_TRUE(batch->size() > 0 && batch->size() <= 10);
+			PTF_ASSERT_EQUAL(batch->front()->getRawDataLen(), packetVec.at(packetCount)->getRawDataLen(), int);
+			packetCount += batch->size();
+		}
+		PTF_ASSERT_EQUAL(packetCount, packetVec.size(), size);
+		batchReader.stop();
+		readerDev->close();
+
+		// the reader device has to be opened first
+		LoggerPP::getInstance().supressErrors();
+		PTF_ASSERT_FALSE(batchReader.start());
+		LoggerPP::getInstance().enableErrors();
+
+		delete readerDev;
+	}
+}
+
+struct MergedPacketsCookie
+{
+	std::vector<uint64_t> timestamps;
+	std::vector<int> sourceIds;
+};
+
+static void onMergedPacket(RawPacket& packet, int sourceId, void* userCookie)
+{
+	MergedPacketsCookie* cookie = (MergedPacketsCookie*)userCookie;
+	cookie->timestamps.push_back(TimestampClock::toNs(packet.getPacketTimeStampNs()));
+	cookie->sourceIds.push_back(sourceId);
+}
+
+PTF_TEST_CASE(TestMergingReaderDevice)
+{
+	// merging a file with itself returns each packet twice, packets with the same timestamp are returned in the order of the inputs
+	PcapFileReaderDevice singleReader(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(singleReader.open());
+	RawPacketVector packetVec;
+	singleReader.getNextPackets(packetVec);
+	singleReader.close();
+
+	PcapFileReaderDevice reader1(EXAMPLE_PCAP_PATH);
+	PcapFileReaderDevice reader2(EXAMPLE_PCAP_PATH);
+	std::vector<IFileReaderDevice*> inputs;
+	inputs.push_back(&reader1);
+	inputs.push_back(&reader2);
+	MergingReaderDevice mergingReader(inputs, 7);
+	PTF_ASSERT_EQUAL(mergingReader.getNumOfInputs(), (size_t)2, size);
+	PTF_ASSERT_EQUAL(mergingReader.getLastPacketInput(), -1, int);
+	PTF_ASSERT_TRUE(mergingReader.open());
+	PTF_ASSERT_TRUE(reader1.isOpened());
+	PTF_ASSERT_TRUE(reader2.isOpened());
+
+	RawPacket rawPacket;
+	size_t packetCount = 0;
+	size_t packetsPerInput[2] = { 0, 0 };
+	while (mergingReader.getNextPacket(rawPacket))
+	{
+		RawPacket* expectedPacket = packetVec.at(packetCount / 2);
+		PTF_ASSERT_TRUE(rawPacket.getPacketTimeStampNs().tv_sec == expectedPacket->getPacketTimeStampNs().tv_sec);
+		PTF_ASSERT_TRUE(rawPacket.getPacketTimeStampNs().tv_nsec == expectedPacket->getPacketTimeStampNs().tv_nsec);
+		int input = mergingReader.getLastPacketInput();
+		PTF_ASSERT_TRUE(input == 0 || input == 1);
+		RawPacket* inputPacket = packetVec.at(packetsPerInput[input]);
+		PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), inputPacket->getRawDataLen(), int);
+		PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), inputPacket->getRawData(), inputPacket->getRawDataLen());
+		packetsPerInput[input]++;
+		packetCount++;
+	}
+	PTF_ASSERT_EQUAL(packetsPerInput[0], packetVec.size(), size);
+	PTF_ASSERT_EQUAL(packetCount, 2 * packetVec.size(), size);
+	pcap_stat stats;
+	mergingReader.getStatistics(stats);
+	PTF_ASSERT_EQUAL((size_t)stats.ps_recv, 2 * packetVec.size(), size);
+	mergingReader.close();
+	PTF_ASSERT_FALSE(reader1.isOpened());
+	PTF_ASSERT_FALSE(reader2.isOpened());
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(mergingReader.getNextPacket(rawPacket));
+	LoggerPP::getInstance().enableErrors();
+
+	// a filter set on the merging reader applies to all inputs
+	PTF_ASSERT_TRUE(singleReader.open());
+	PTF_ASSERT_TRUE(singleReader.setFilter("tcp"));
+	int filteredCount = 0;
+	while (singleReader.getNextPacket(rawPacket))
+		filteredCount++;
+	singleReader.close();
+	PTF_ASSERT_TRUE(filteredCount > 0 && filteredCount < (int)packetVec.size());
+
+	PTF_ASSERT_TRUE(mergingReader.open());
+	PTF_ASSERT_TRUE(mergingReader.setFilter("tcp"));
+	packetCount = 0;
+	while (mergingReader.getNextPacket(rawPacket))
+		packetCount++;
+	// the first batch of each input was read before the filter was set
+	PTF_ASSERT_TRUE(packetCount >= 2 * (size_t)filteredCount && packetCount <= 2 * (size_t)filteredCount + 14);
+	PTF_ASSERT_TRUE(mergingReader.clearFilter());
+	mergingReader.close();
+
+	// merging two different files interleaves their packets by timestamp
+	PcapFileReaderDevice reader3(EXAMPLE2_PCAP_PATH);
+	PTF_ASSERT_TRUE(reader3.open());
+	RawPacketVector packetVec2;
+	reader3.getNextPackets(packetVec2);
+	reader3.close();
+
+	inputs.clear();
+	inputs.push_back(&reader3);
+	inputs.push_back(&reader1);
+	MergingReaderDevice mergingReader2(inputs);
+	PTF_ASSERT_TRUE(mergingReader2.open());
+	packetCount = 0;
+	packetsPerInput[0] = packetsPerInput[1] = 0;
+	uint64_t prevTimestamp = 0;
+	while (mergingReader2.getNextPacket(rawPacket))
+	{
+		uint64_t timestamp = TimestampClock::toNs(rawPacket.getPacketTimeStampNs());
+		PTF_ASSERT_TRUE(timestamp >= prevTimestamp);
+		prevTimestamp = timestamp;
+		packetsPerInput[mergingReader2.getLastPacketInput()]++;
+		packetCount++;
+	}
+	PTF_ASSERT_EQUAL(packetsPerInput[0], packetVec2.size(), size);
+	PTF_ASSERT_EQUAL(packetsPerInput[1], packetVec.size(), size);
+	PTF_ASSERT_EQUAL(packetCount, packetVec.size() + packetVec2.size(), size);
+	mergingReader2.close();
+
+	// live sources are merged with a bounded reorder window
+	RawPacket packets[4];
+	uint8_t data[60];
+	memset(data, 0, sizeof(data));
+	const uint64_t second = 1000000000ULL;
+	MergedPacketsCookie cookie;
+	TimestampReorderMerger merger(2, 10 * second, 100, onMergedPacket, &cookie);
+
+	for (int i = 0; i < 4; i++)
+	{
+		timespec ts = { 100 + 2 * i, 0 };
+		packets[i].setExternalRawData(data, sizeof(data), ts);
+	}
+	PTF_ASSERT_TRUE(merger.addBurst(0, packets, 4));
+	// source 1 hasn't delivered anything yet, so nothing can be released
+	PTF_ASSERT_EQUAL(merger.getNumOfHeldPackets(), (size_t)4, size);
+	PTF_ASSERT_EQUAL(cookie.timestamps.size(), (size_t)0, size);
+
+	for (int i = 0; i < 2; i++)
+	{
+		timespec ts = { 101 + 2 * i, 0 };
+		packets[i].setExternalRawData(data, sizeof(data), ts);
+	}
+	RawPacket* packetPtrs[2] = { &packets[0], &packets[1] };
+	PTF_ASSERT_TRUE(merger.addBurst(1, packetPtrs, 2));
+	// packets up to 103s can be released, both sources reached it
+	PTF_ASSERT_EQUAL(cookie.timestamps.size(), (size_t)4, size);
+	PTF_ASSERT_EQUAL(cookie.sourceIds[0], 0, int);
+	PTF_ASSERT_EQUAL(cookie.sourceIds[1], 1, int);
+	PTF_ASSERT_EQUAL(cookie.sourceIds[2], 0, int);
+	PTF_ASSERT_EQUAL(cookie.sourceIds[3], 1, int);
+	PTF_ASSERT_EQUAL(merger.getNumOfHeldPackets(), (size_t)2, size);
+
+	// an idle source lets the other one's packets through once they're older than the window
+	PTF_ASSERT_TRUE(merger.advanceSource(1, 104 * second));
+	PTF_ASSERT_EQUAL(cookie.timestamps.size(), (size_t)5, size);
+	timespec ts = { 120, 0 };
+	packets[0].setExternalRawData(data, sizeof(data), ts);
+	PTF_ASSERT_TRUE(merger.addBurst(0, packets, 1));
+	PTF_ASSERT_EQUAL(cookie.timestamps.size(), (size_t)6, size);
+	PTF_ASSERT_EQUAL(merger.getNumOfHeldPackets(), (size_t)1, size);
+
+	// a packet of source 1 earlier than the released packets is passed on right away
+	ts.tv_sec = 105;
+	packets[0].setExternalRawData(data, sizeof(data), ts);
+	PTF_ASSERT_TRUE(merger.addBurst(1, packets, 1));
+	PTF_ASSERT_EQUAL(cookie.timestamps.size(), (size_t)7, size);
+	PTF_ASSERT_TRUE(cookie.timestamps.back() == 105 * second);
+
+	merger.flush();
+	PTF_ASSERT_EQUAL(merger.getNumOfHeldPackets(), (size_t)0, size);
+	PTF_ASSERT_EQUAL(cookie.timestamps.size(), (size_t)8, size);
+	PTF_ASSERT_TRUE(cookie.timestamps.back() == 120 * second);
+
+	TimestampReorderMerger::MergerStats mergerStats;
+	merger.getStatistics(mergerStats);
+	PTF_ASSERT_EQUAL((size_t)mergerStats.packets, (size_t)8, size);
+	PTF_ASSERT_EQUAL((size_t)mergerStats.releasedByWindow, (size_t)1, size);
+	PTF_ASSERT_EQUAL((size_t)mergerStats.releasedByLimit, (size_t)0, size);
+	PTF_ASSERT_EQUAL((size_t)mergerStats.latePackets, (size_t)1, size);
+
+	// the maximum number of held packets releases the earliest ones
+	MergedPacketsCookie limitCookie;
+	TimestampReorderMerger limitedMerger(2, 10 * second, 2, onMergedPacket, &limitCookie);
+	for (int i = 0; i < 4; i++)
+	{
+		timespec packetTs = { 100 + i, 0 };
+		packets[i].setExternalRawData(data, sizeof(data), packetTs);
+	}
+	PTF_ASSERT_TRUE(limitedMerger.addBurst(0, packets, 4));
+	PTF_ASSERT_EQUAL(limitCookie.timestamps.size(), (size_t)2, size);
+	PTF_ASSERT_TRUE(limitCookie.timestamps[0] == 100 * second);
+	PTF_ASSERT_EQUAL(limitedMerger.getNumOfHeldPackets(), (size_t)2, size);
+	limitedMerger.getStatistics(mergerStats);
+	PTF_ASSERT_EQUAL((size_t)mergerStats.releasedByLimit, (size_t)2, size);
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(limitedMerger.addBurst(2, packets, 1));
+	LoggerPP::getInstance().enableErrors();
+	limitedMerger.flush();
+}
+
+struct ReplayCookie
+{
+	RawPacketVector sentPackets;
+	std::vector<uint64_t> sendTimes;
+	int maxPacketsPerBurst;
+	int numOfBursts;
+};
+
+static int onReplaySendPackets(RawPacket** packets, int numOfPackets, void* userCookie)
+{
+	ReplayCookie* cookie = (ReplayCookie*)userCookie;
+	uint64_t now = TimestampClock::nowNs();
+	for (int i = 0; i < numOfPackets; i++)
+	{
+		cookie->sentPackets.pushBack(new RawPacket(*packets[i]));
+		cookie->sendTimes.push_back(now);
+	}
+
+	cookie->maxPacketsPerBurst = std::max(cookie->maxPacketsPerBurst, numOfPackets);
+	cookie->numOfBursts++;
+	// the last packet of every burst fails to be sent
+	return numOfPackets - 1;
+}
+
+PTF_TEST_CASE(TestPacketReplayer)
+{
+	// top speed, several loops with IP and port rewriting
+	PacketReplayConfiguration config(PacketReplayConfiguration::TopSpeed, 3, 8);
+	config.srcIPIncrementPerLoop = 0x100;
+	config.dstPortIncrementPerLoop = 1000;
+	PacketReplayer replayer(config);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(replayer.replay(onReplaySendPackets, NULL));
+	PTF_ASSERT_FALSE(replayer.loadFile("PcapExamples/not_exist.pcap"));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_TRUE(replayer.loadFile(EXAMPLE_PCAP_PATH));
+	size_t numOfPackets = replayer.getNumOfPackets();
+	PTF_ASSERT_TRUE(numOfPackets > 100);
+
+	ReplayCookie cookie;
+	cookie.maxPacketsPerBurst = 0;
+	cookie.numOfBursts = 0;
+	PTF_ASSERT_TRUE(replayer.replay(onReplaySendPackets, &cookie));
+	PTF_ASSERT_EQUAL(cookie.sentPackets.size(), 3 * numOfPackets, size);
+	PTF_ASSERT_EQUAL(cookie.maxPacketsPerBurst, 8, int);
+	PTF_ASSERT_EQUAL(replayer.getNumOfLoopsCompleted(), 3, u32);
+	PTF_ASSERT_EQUAL((int)replayer.getNumOfPacketsFailed(), cookie.numOfBursts, int);
+	PTF_ASSERT_EQUAL((size_t)(replayer.getNumOfPacketsSent() + replayer.getNumOfPacketsFailed()), 3 * numOfPackets, size);
+
+	int numOfRewrittenPackets = 0;
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		RawPacket* origRawPacket = cookie.sentPackets.at((int)i);
+		RawPacket* rewrittenRawPacket = cookie.sentPackets.at((int)(2 * numOfPackets + i));
+		PTF_ASSERT_EQUAL(rewrittenRawPacket->getRawDataLen(), origRawPacket->getRawDataLen(), int);
+		Packet origPacket(origRawPacket);
+		Packet rewrittenPacket(rewrittenRawPacket);
+		IPv4Layer* origIPLayer = origPacket.getLayerOfType<IPv4Layer>();
+		IPv4Layer* rewrittenIPLayer = rewrittenPacket.getLayerOfType<IPv4Layer>();
+		if (origIPLayer == NULL || origIPLayer->isFragment())
+			continue;
+
+		PTF_ASSERT_EQUAL(ntohl(rewrittenIPLayer->getSrcIpAddress().toInt()), ntohl(origIPLayer->getSrcIpAddress().toInt()) + 0x200, u32);
+		PTF_ASSERT_TRUE(rewrittenIPLayer->getDstIpAddress() == origIPLayer->getDstIpAddress());
+
+		// the incrementally updated checksums are the same as the computed ones
+		uint16_t ipChecksum = rewrittenIPLayer->getIPv4Header()->headerChecksum;
+		rewrittenIPLayer->computeCalculateFields();
+		PTF_ASSERT_EQUAL(rewrittenIPLayer->getIPv4Header()->headerChecksum, ipChecksum, u16);
+
+		TcpLayer* origTcpLayer = origPacket.getLayerOfType<TcpLayer>();
+		TcpLayer* rewrittenTcpLayer = rewrittenPacket.getLayerOfType<TcpLayer>();
+		if (origTcpLayer == NULL || origPacket.getRawPacket()->getFrameLength() != origPacket.getRawPacket()->getRawDataLen())
+			continue;
+
+		PTF_ASSERT_EQUAL(ntohs(rewrittenTcpLayer->getTcpHeader()->portDst), (uint16_t)(ntohs(origTcpLayer->getTcpHeader()->portDst) + 2000), u16);
+		PTF_ASSERT_EQUAL(rewrittenTcpLayer->getTcpHeader()->portSrc, origTcpLayer->getTcpHeader()->portSrc, u16);
+		uint16_t origTcpChecksum = origTcpLayer->getTcpHeader()->headerChecksum;
+		origTcpLayer->computeCalculateFields();
+		if (origTcpLayer->getTcpHeader()->headerChecksum != origTcpChecksum)
+			continue;
+
+		uint16_t tcpChecksum = rewrittenTcpLayer->getTcpHeader()->headerChecksum;
+		rewrittenTcpLayer->computeCalculateFields();
+		PTF_ASSERT_EQUAL(rewrittenTcpLayer->getTcpHeader()->headerChecksum, tcpChecksum, u16);
+		numOfRewrittenPackets++;
+	}
+	PTF_ASSERT_TRUE(numOfRewrittenPackets > 0);
+
+	// the loaded packets are restored after the replay
+	ReplayCookie secondCookie;
+	secondCookie.maxPacketsPerBurst = 0;
+	secondCookie.numOfBursts = 0;
+	PTF_ASSERT_TRUE(replayer.replay(onReplaySendPackets, &secondCookie));
+	PTF_ASSERT_BUF_COMPARE(secondCookie.sentPackets.front()->getRawData(), cookie.sentPackets.front()->getRawData(), cookie.sentPackets.front()->getRawDataLen());
+
+	// original timing: packets 1ms apart, replayed twice as fast in 2 loops. The first packet is sent a little after the replay starts, so
+	// the gaps are measured with a small tolerance
+	PacketReplayConfiguration timingConfig(PacketReplayConfiguration::OriginalTiming, 2, 1);
+	timingConfig.speedMultiplier = 2.0;
+	PacketReplayer timingReplayer(timingConfig);
+	RawPacket* firstRawPacket = cookie.sentPackets.front();
+	for (int i = 0; i < 10; i++)
+	{
+		RawPacket rawPacket(*firstRawPacket);
+		timespec timestamp;
+		timestamp.tv_sec = 1000;
+		timestamp.tv_nsec = i * 1000000;
+		rawPacket.setPacketTimeStamp(timestamp);
+		PTF_ASSERT_TRUE(timingReplayer.addPacket(rawPacket));
+	}
+
+	ReplayCookie timingCookie;
+	timingCookie.maxPacketsPerBurst = 0;
+	timingCookie.numOfBursts = 0;
+	PTF_ASSERT_TRUE(timingReplayer.replay(onReplaySendPackets, &timingCookie));
+	PTF_ASSERT_EQUAL(timingCookie.sendTimes.size(), (size_t)20, size);
+	for (size_t i = 1; i < timingCookie.sendTimes.size(); i++)
+		PTF_ASSERT_TRUE(timingCookie.sendTimes[i] - timingCookie.sendTimes[0] + 50000 >= i * 500000);
+	PTF_ASSERT_TRUE(timingReplayer.getReplayDurationNs() >= 19 * 500000);
+
+	// fixed packet rate: 20 packets at 4000 packets per second take at least 19 * 250us
+	PacketReplayConfiguration rateConfig(PacketReplayConfiguration::FixedPacketRate, 2);
+	rateConfig.packetsPerSecond = 4000;
+	PacketReplayer rateReplayer(rateConfig);
+	for (int i = 0; i < 10; i++)
+		rateReplayer.addPacket(*firstRawPacket);
+	ReplayCookie rateCookie;
+	rateCookie.maxPacketsPerBurst = 0;
+	rateCookie.numOfBursts = 0;
+	PTF_ASSERT_TRUE(rateReplayer.replay(onReplaySendPackets, &rateCookie));
+	PTF_ASSERT_EQUAL(rateCookie.sendTimes.size(), (size_t)20, size);
+	PTF_ASSERT_TRUE(rateCookie.sendTimes.back() - rateCookie.sendTimes.front() + 50000 >= 19 * 250000);
+
+	// a rate mode without a rate is invalid
+	PacketReplayer invalidReplayer(PacketReplayConfiguration(PacketReplayConfiguration::FixedBitRate));
+	invalidReplayer.addPacket(*firstRawPacket);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(invalidReplayer.replay(onReplaySendPackets, &rateCookie));
+	LoggerPP::getInstance().enableErrors();
+}
+
+struct MultiInterfaceWriterCookie
+{
+	MultiInterfacePcapNgWriter* writer;
+	RawPacketVector* packets;
+	int interfaceId;
+	int numOfInterfaces;
+	int numOfPacketsStaged;
+};
+
+static void* multiInterfaceWriterThread(void* cookiePtr)
+{
+	MultiInterfaceWriterCookie* cookie = (MultiInterfaceWriterCookie*)cookiePtr;
+	cookie->numOfPacketsStaged = 0;
+	for (size_t i = cookie->interfaceId; i < cookie->packets->size(); i += cookie->numOfInterfaces)
+	{
+		if (cookie->writer->writePacket(cookie->interfaceId, *cookie->packets->at((int)i)))
+			cookie->numOfPacketsStaged++;
+	}
+
+	cookie->writer->setInterfaceStatistics(cookie->interfaceId, cookie->numOfPacketsStaged + 5, 5);
+	return NULL;
+}
+
+PTF_TEST_CASE(TestMultiInterfacePcapNgWriter)
+{
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	RawPacketVector packetVec;
+	readerDev.getNextPackets(packetVec);
+	readerDev.close();
+	PTF_ASSERT_TRUE(packetVec.size() > 0);
+
+	bool inputSorted = true;
+	size_t expectedDataLen = 0;
+	for (size_t i = 0; i < packetVec.size(); i++)
+	{
+		RawPacket* rawPacket = packetVec.at((int)i);
+		// the packets of the third interface are cut to its snapshot length
+		expectedDataLen += (i % 3 == 2 && rawPacket->getRawDataLen() > 64 ? 64 : rawPacket->getRawDataLen());
+		if (i > 0)
+		{
+			timespec prev = packetVec.at((int)i - 1)->getPacketTimeStampNs();
+			timespec cur = rawPacket->getPacketTimeStampNs();
+			if (prev.tv_sec > cur.tv_sec || (prev.tv_sec == cur.tv_sec && prev.tv_nsec > cur.tv_nsec))
+				inputSorted = false;
+		}
+	}
+
+	// three capture threads, each writing every third packet through its own interface
+	MultiInterfacePcapNgWriter writer(EXAMPLE_PCAPNG_WRITE_PATH, MultiInterfacePcapNgWriterConfiguration(16, true, 10, 0));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(writer.open());
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL(writer.addInterface(LINKTYPE_ETHERNET, "eth0", "first port"), 0, int);
+	PTF_ASSERT_EQUAL(writer.addInterface(LINKTYPE_ETHERNET, "eth1"), 1, int);
+	PTF_ASSERT_EQUAL(writer.addInterface(LINKTYPE_ETHERNET, "", "", 64), 2, int);
+	PTF_ASSERT_EQUAL(writer.getNumOfInterfaces(), 3, int);
+	PTF_ASSERT_FALSE(writer.writePacket(0, *packetVec.front()));
+	PTF_ASSERT_TRUE(writer.open());
+	PTF_ASSERT_TRUE(writer.isOpened());
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(writer.addInterface(LINKTYPE_ETHERNET), -1, int);
+	PTF_ASSERT_FALSE(writer.open());
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_FALSE(writer.writePacket(3, *packetVec.front()));
+
+	MultiInterfaceWriterCookie cookies[3];
+	pthread_t threads[3];
+	for (int i = 0; i < 3; i++)
+	{
+		cookies[i].writer = &writer;
+		cookies[i].packets = &packetVec;
+		cookies[i].interfaceId = i;
+		cookies[i].numOfInterfaces = 3;
+		PTF_ASSERT_EQUAL(pthread_create(&threads[i], NULL, multiInterfaceWriterThread, &cookies[i]), 0, int);
+	}
+	for (int i = 0; i < 3; i++)
+		pthread_join(threads[i], NULL);
+
+	writer.close();
+	PTF_ASSERT_FALSE(writer.isOpened());
+	PTF_ASSERT_EQUAL(cookies[0].numOfPacketsStaged + cookies[1].numOfPacketsStaged + cookies[2].numOfPacketsStaged, (int)packetVec.size(), int);
+	PTF_ASSERT_EQUAL((size_t)writer.getNumOfPacketsWritten(), packetVec.size(), size);
+	PTF_ASSERT_EQUAL((int)writer.getNumOfPacketsDropped(0), 0, int);
+
+	// all packets are read back, in timestamp order when they were captured in order
+	PcapNgFileReaderDevice pcapNgReaderDev(EXAMPLE_PCAPNG_WRITE_PATH);
+	PTF_ASSERT_TRUE(pcapNgReaderDev.open());
+	PTF_ASSERT_TRUE(pcapNgReaderDev.getCaptureApplication().find("PcapPlusPlus") == 0);
+	RawPacket rawPacket;
+	size_t packetCount = 0;
+	size_t dataLen = 0;
+	timespec prevTimestamp = { 0, 0 };
+	while (pcapNgReaderDev.getNextPacket(rawPacket))
+	{
+		timespec timestamp = rawPacket.getPacketTimeStampNs();
+		if (inputSorted)
+			PTF_ASSERT_TRUE(timestamp.tv_sec > prevTimestamp.tv_sec || (timestamp.tv_sec == prevTimestamp.tv_sec && timestamp.tv_nsec >= prevTimestamp.tv_nsec));
+		prevTimestamp = timestamp;
+		dataLen += rawPacket.getRawDataLen();
+		packetCount++;
+	}
+	pcapNgReaderDev.close();
+	PTF_ASSERT_EQUAL(packetCount, packetVec.size(), size);
+	PTF_ASSERT_EQUAL(dataLen, expectedDataLen, size);
+
+	// the file has an interface description block and a final statistics block per interface
+	FILE* file = fopen(EXAMPLE_PCAPNG_WRITE_PATH, "rb");
+	PTF_ASSERT_TRUE(file != NULL);
+	int blockCounts[7] = { 0 };
+	uint32_t blockHeader[2];
+	while (fread(blockHeader, sizeof(uint32_t), 2, file) == 2)
+	{
+		if (blockHeader[0] < 7)
+			blockCounts[blockHeader[0]]++;
+		fseek(file, blockHeader[1] - 2 * sizeof(uint32_t), SEEK_CUR);
+	}
+	fclose(file);
+	PTF_ASSERT_EQUAL(blockCounts[1], 3, int);
+	PTF_ASSERT_EQUAL(blockCounts[5], 3, int);
+	PTF_ASSERT_EQUAL(blockCounts[6], (int)packetVec.size(), int);
+
+	// when the writer doesn't block every packet is either written or counted as dropped
+	MultiInterfacePcapNgWriter droppingWriter(EXAMPLE_PCAPNG_WRITE_PATH, MultiInterfacePcapNgWriterConfiguration(2, false, 10, 1));
+	PTF_ASSERT_EQUAL(droppingWriter.addInterface(LINKTYPE_ETHERNET), 0, int);
+	PTF_ASSERT_TRUE(droppingWriter.open());
+	int numOfPacketsStaged = 0;
+	for (int i = 0; i < (int)packetVec.size(); i++)
+	{
+		if (droppingWriter.writePacket(0, *packetVec.at(i)))
+			numOfPacketsStaged++;
+	}
+	droppingWriter.close();
+	PTF_ASSERT_EQUAL((int)droppingWriter.getNumOfPacketsWritten(), numOfPacketsStaged, int);
+	PTF_ASSERT_EQUAL((int)droppingWriter.getNumOfPacketsDropped(0), (int)packetVec.size() - numOfPacketsStaged, int);
+}
+
+PTF_TEST_CASE(TestMultiFileWriter)
+{
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	RawPacketVector packetVec;
+	int packetCount = readerDev.getNextPackets(packetVec);
+	readerDev.close();
+
+	// packets are spread over more files than are kept open, with a memory budget that forces the largest files out early
+	const int numOfFiles = 20;
+	MultiFileWriter writer(MultiFileWriterConfiguration(64 * 1024, 4, 4096));
+	for (int i = 0; i < numOfFiles; i++)
+	{
+		std::stringstream fileName;
+		fileName << "PcapExamples/multi_file_" << i << ".pcap";
+		PTF_ASSERT_EQUAL(writer.addFile(fileName.str()), i, int);
+	}
+	PTF_ASSERT_EQUAL((int)writer.getNumOfFiles(), numOfFiles, int);
+
+	std::vector<int> expectedPacketCounts(numOfFiles, 0);
+	std::vector<uint32_t> lastPacketLengths(numOfFiles, 0);
+	for (int i = 0; i < packetCount; i++)
+	{
+		// the last file is left empty
+		int fileId = (i * 7) % (numOfFiles - 1);
+		PTF_ASSERT_TRUE(writer.writePacket(fileId, *packetVec.at(i)));
+		expectedPacketCounts[fileId]++;
+		lastPacketLengths[fileId] = packetVec.at(i)->getRawDataLen();
+		PTF_ASSERT_TRUE(writer.getNumOfBufferedBytes() <= 64 * 1024);
+	}
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(writer.writePacket(numOfFiles, *packetVec.front()));
+	PTF_ASSERT_FALSE(writer.writePacket(-1, *packetVec.front()));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL((int)writer.getNumOfPacketsWritten(), packetCount, int);
+	PTF_ASSERT_EQUAL((int)writer.getNumOfPacketsNotWritten(), 2, int);
+
+	PTF_ASSERT_TRUE(writer.close());
+	PTF_ASSERT_EQUAL((int)writer.getNumOfBufferedBytes(), 0, int);
+	PTF_ASSERT_TRUE(writer.getNumOfFileOpens() >= (uint64_t)numOfFiles);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(writer.addFile("PcapExamples/multi_file_closed.pcap"), -1, int);
+	PTF_ASSERT_FALSE(writer.writePacket(0, *packetVec.front()));
+	LoggerPP::getInstance().enableErrors();
+
+	// every file holds its packets in order, including the files which were closed and reopened for appending
+	int readPacketCount = 0;
+	RawPacket rawPacket;
+	for (int i = 0; i < numOfFiles; i++)
+	{
+		PcapFileReaderDevice fileReaderDev(writer.getFileName(i).c_str());
+		PTF_ASSERT(fileReaderDev.open(), "cannot open file '%s'", writer.getFileName(i).c_str());
+		int filePacketCount = 0;
+		while (fileReaderDev.getNextPacket(rawPacket))
+			filePacketCount++;
+		fileReaderDev.close();
+		PTF_ASSERT_EQUAL(filePacketCount, expectedPacketCounts[i], int);
+		if (filePacketCount > 0)
+			PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), (int)lastPacketLengths[i], int);
+		readPacketCount += filePacketCount;
+		remove(writer.getFileName(i).c_str());
+	}
+	PTF_ASSERT_EQUAL(readPacketCount, packetCount, int);
+}
+
+// write the payloads of the packets of a file to streams, each packet to the stream of its number modulo the number of streams
+static bool writePayloadStreams(StreamSink& sink, RawPacketVector& packetVec, int numOfStreams, std::vector<std::string>& expectedData)
+{
+	for (int i = 0; i < (int)packetVec.size(); i++)
+	{
+		// the last stream is left empty
+		int streamId = i % (numOfStreams - 1);
+		RawPacket* rawPacket = packetVec.at(i);
+		if (!sink.write(streamId, rawPacket->getRawData(), rawPacket->getRawDataLen()))
+			return false;
+		expectedData[streamId].append((const char*)rawPacket->getRawData(), rawPacket->getRawDataLen());
+	}
+
+	return true;
+}
+
+PTF_TEST_CASE(TestStreamSink)
+{
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	RawPacketVector packetVec;
+	readerDev.getNextPackets(packetVec);
+	readerDev.close();
+
+	// the streams are written by the I/O thread, with more streams than open files and a memory budget that hands streams over early
+	const int numOfStreams = 20;
+	StreamSink sink(StreamSinkConfiguration(64 * 1024, 4, 4096));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(sink.addStream("PcapExamples/stream_closed.txt"), -1, int);
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_TRUE(sink.open());
+	std::vector<std::string> fileNames;
+	for (int i = 0; i < numOfStreams; i++)
+	{
+		std::stringstream fileName;
+		fileName << "PcapExamples/stream_" << i << ".txt";
+		fileNames.push_back(fileName.str());
+		PTF_ASSERT_EQUAL(sink.addStream(fileName.str()), i, int);
+	}
+
+	std::vector<std::string> expectedData(numOfStreams);
+	PTF_ASSERT_TRUE(writePayloadStreams(sink, packetVec, numOfStreams, expectedData));
+	PTF_ASSERT_TRUE(sink.endStream(0));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(sink.write(0, packetVec.front()->getRawData(), 1));
+	PTF_ASSERT_FALSE(sink.endStream(0));
+	PTF_ASSERT_FALSE(sink.write(numOfStreams, packetVec.front()->getRawData(), 1));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_TRUE(sink.flushAll());
+	uint64_t numOfBytesAccepted = sink.getNumOfBytesAccepted();
+	PTF_ASSERT_TRUE(sink.getNumOfBytesWritten() == numOfBytesAccepted);
+	PTF_ASSERT_TRUE(sink.close());
+	PTF_ASSERT_TRUE(sink.getNumOfFileOpens() > (uint64_t)numOfStreams);
+
+	// every file holds the data of its stream in order, including the files which were closed and reopened for appending
+	for (int i = 0; i < numOfStreams; i++)
+	{
+		std::ifstream file(fileNames[i].c_str(), std::ios_base::binary);
+		PTF_ASSERT(file.is_open(), "cannot open file '%s'", fileNames[i].c_str());
+		std::stringstream fileData;
+		fileData << file.rdbuf();
+		file.close();
+		PTF_ASSERT_TRUE(fileData.str() == expectedData[i]);
+		remove(fileNames[i].c_str());
+	}
+
+	// in container mode, written synchronously, all streams are written to one file and read back by its index
+	StreamSinkConfiguration containerConfig(64 * 1024, 4, 4096, false);
+	containerConfig.containerFileName = "PcapExamples/streams.container";
+	StreamSink containerSink(containerConfig);
+	PTF_ASSERT_TRUE(containerSink.open());
+	for (int i = 0; i < numOfStreams; i++)
+		PTF_ASSERT_EQUAL(containerSink.addStream(fileNames[i]), i, int);
+	std::vector<std::string> expectedContainerData(numOfStreams);
+	PTF_ASSERT_TRUE(writePayloadStreams(containerSink, packetVec, numOfStreams, expectedContainerData));
+	PTF_ASSERT_TRUE(containerSink.close());
+	PTF_ASSERT_EQUAL((int)containerSink.getNumOfFileOpens(), 0, int);
+
+	StreamContainerReader containerReader("PcapExamples/streams.container");
+	PTF_ASSERT_TRUE(containerReader.open());
+	PTF_ASSERT_EQUAL((int)containerReader.getNumOfStreams(), numOfStreams, int);
+	std::vector<uint8_t> streamData;
+	for (int i = 0; i < numOfStreams; i++)
+	{
+		PTF_ASSERT_EQUAL(containerReader.findStream(fileNames[i]), i, int);
+		PTF_ASSERT_EQUAL((size_t)containerReader.getStreamLength(i), expectedContainerData[i].length(), size);
+		PTF_ASSERT_TRUE(containerReader.readStream(i, streamData));
+		PTF_ASSERT_TRUE(std::string(streamData.begin(), streamData.end()) == expectedContainerData[i]);
+	}
+	PTF_ASSERT_EQUAL(containerReader.findStream("PcapExamples/stream_none.txt"), -1, int);
+	containerReader.close();
+
+	// a file which isn't a complete container isn't read
+	LoggerPP::getInstance().supressErrors();
+	StreamContainerReader invalidReader(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_FALSE(invalidReader.open());
+	LoggerPP::getInstance().enableErrors();
+	remove("PcapExamples/streams.container");
+}
+
+struct ParallelReadCookie
+{
+	std::vector<int> timesRead;
+	std::vector<uint32_t> packetLengths;
+	uint64_t nextPacketNumber;
+	bool outOfOrder;
+};
+
+static void parallelPacketReadCallback(RawPacket& rawPacket, uint64_t packetNumber, int workerIndex, void* userCookie)
+{
+	// in unordered mode each packet number is handed to a single worker, so the slots are written without locking
+	ParallelReadCookie* cookie = (ParallelReadCookie*)userCookie;
+	cookie->timesRead[packetNumber]++;
+	cookie->packetLengths[packetNumber] = rawPacket.getRawDataLen();
+}
+
+static void orderedPacketReadCallback(RawPacket& rawPacket, uint64_t packetNumber, int workerIndex, void* userCookie)
+{
+	ParallelReadCookie* cookie = (ParallelReadCookie*)userCookie;
+	if (packetNumber != cookie->nextPacketNumber)
+		cookie->outOfOrder = true;
+	cookie->nextPacketNumber = packetNumber + 1;
+	parallelPacketReadCallback(rawPacket, packetNumber, workerIndex, userCookie);
+}
+
+struct PacketQueueDeviceTestProducer
+{
+	PacketQueueDevice* device;
+	RawPacketVector* packets;
+};
+
+static void* packetQueueDeviceTestProducerMain(void* producerPtr)
+{
+	PacketQueueDeviceTestProducer* producer = (PacketQueueDeviceTestProducer*)producerPtr;
+	RawPacketVector::ConstVectorIterator iter = producer->packets->begin();
+	while (iter != producer->packets->end())
+	{
+		if (producer->device->copyAndEnqueue(*iter, 1) == 1)
+			++iter;
+		else
+			sched_yield();
+	}
+
+	return NULL;
+}
+
+PTF_TEST_CASE(TestPacketQueueDevice)
+{
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	RawPacketVector packetVec;
+	readerDev.getNextPackets(packetVec);
+	readerDev.close();
+	PTF_ASSERT_TRUE(packetVec.size() > 100);
+
+	// a device which isn't open doesn't pass packets
+	PacketQueueDevice closedDev(64);
+	RawPacket* packet = NULL;
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(closedDev.enqueue(packetVec.front()));
+	PTF_ASSERT_NULL(closedDev.dequeue());
+	LoggerPP::getInstance().enableErrors();
+
+	// packets which don't fit in the queue are dropped and counted, packets are copied into pool buffers
+	RawPacketPool pool;
+	PacketQueueDevice spscDev(50, PacketQueueDevice::SingleProducerSingleConsumer, &pool);
+	PTF_ASSERT_TRUE(spscDev.open());
+	PTF_ASSERT_EQUAL(spscDev.getCapacity(), 64, size);
+	RawPacket packetArr[100];
+	for (int i = 0; i < 100; i++)
+		packetArr[i].setExternalRawData(packetVec.at(i)->getRawData(), packetVec.at(i)->getRawDataLen(), packetVec.at(i)->getPacketTimeStampNs(),
+				packetVec.at(i)->getLinkLayerType(), packetVec.at(i)->getFrameLength());
+	PTF_ASSERT_EQUAL(spscDev.copyAndEnqueue(packetArr, 100), 64, int);
+	PTF_ASSERT_EQUAL(spscDev.getNumOfQueuedPackets(), 64, size);
+	PTF_ASSERT_EQUAL((int)spscDev.getNumOfDroppedPackets(), 36, int);
+	RawPacket* poppedPackets[100];
+	PTF_ASSERT_EQUAL(spscDev.dequeueBurst(poppedPackets, 100), 64, int);
+	for (int i = 0; i < 64; i++)
+	{
+		PTF_ASSERT_EQUAL(poppedPackets[i]->getRawDataLen(), packetVec.at(i)->getRawDataLen(), int);
+		PTF_ASSERT_BUF_COMPARE(poppedPackets[i]->getRawData(), packetVec.at(i)->getRawData(), packetVec.at(i)->getRawDataLen());
+		PTF_ASSERT_TRUE(poppedPackets[i]->getRawDataPool() == &pool);
+		delete poppedPackets[i];
+	}
+	PTF_ASSERT_NULL(spscDev.dequeue());
+
+	// packets pushed by the caller are owned by the device until they're popped, and the ones left are deleted on close
+	packet = new RawPacket(*packetVec.front());
+	PTF_ASSERT_TRUE(spscDev.enqueue(packet));
+	PTF_ASSERT_TRUE(spscDev.dequeue() == packet);
+	delete packet;
+	PTF_ASSERT_TRUE(spscDev.enqueue(new RawPacket(*packetVec.front())));
+	spscDev.close();
+	PTF_ASSERT_EQUAL(spscDev.getNumOfQueuedPackets(), 0, size);
+
+	// packets passed from a producer thread arrive complete and in order
+	PacketQueueDevice mpmcDev(32);
+	PTF_ASSERT_TRUE(mpmcDev.open());
+	PTF_ASSERT_EQUAL(mpmcDev.getQueueType(), PacketQueueDevice::MultiProducerMultiConsumer, enum);
+	PacketQueueDeviceTestProducer producer;
+	producer.device = &mpmcDev;
+	producer.packets = &packetVec;
+	pthread_t producerThread;
+	PTF_ASSERT_EQUAL(pthread_create(&producerThread, NULL, packetQueueDeviceTestProducerMain, &producer), 0, int);
+	RawPacketVector receivedPackets;
+	while (receivedPackets.size() < packetVec.size())
+	{
+		if (mpmcDev.receivePackets(receivedPackets, 16) == 0)
+			sched_yield();
+	}
+	pthread_join(producerThread, NULL);
+
+	bool allPacketsEqual = true;
+	for (size_t i = 0; i < packetVec.size(); i++)
+	{
+		RawPacket* sent = packetVec.at((int)i);
+		RawPacket* received = receivedPackets.at((int)i);
+		if (sent->getRawDataLen() != received->getRawDataLen() || memcmp(sent->getRawData(), received->getRawData(), sent->getRawDataLen()) != 0)
+			allPacketsEqual = false;
+	}
+	PTF_ASSERT_TRUE(allPacketsEqual);
+	PTF_ASSERT_EQUAL(mpmcDev.getNumOfQueuedPackets(), 0, size);
+	mpmcDev.close();
+}
+
+PTF_TEST_CASE(TestSharedMemoryRingDevice)
+{
+#ifdef LINUX
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	RawPacketVector packetVec;
+	readerDev.getNextPackets(packetVec);
+	readerDev.close();
+	PTF_ASSERT_TRUE(packetVec.size() > 100);
+	RawPacket packetArr[64];
+	for (int i = 0; i < 64; i++)
+		packetArr[i].setExternalRawData(packetVec.at(i)->getRawData(), packetVec.at(i)->getRawDataLen(), packetVec.at(i)->getPacketTimeStampNs(),
+				packetVec.at(i)->getLinkLayerType(), packetVec.at(i)->getFrameLength());
+
+	// readers can't attach to a ring which doesn't exist
+	SharedMemoryRingReaderDevice noRingDev("/pcpp_test_no_such_ring");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(noRingDev.open());
+	LoggerPP::getInstance().enableErrors();
+
+	SharedMemoryRingWriterDevice writerDev(SharedMemoryRingConfiguration("/pcpp_test_ring", 60, 1500, 2));
+	PTF_ASSERT_TRUE(writerDev.open());
+	PTF_ASSERT_EQUAL(writerDev.getConfiguration().numOfSlots, 64, u32);
+	SharedMemoryRingReaderDevice readerDev1("/pcpp_test_ring");
+	SharedMemoryRingReaderDevice readerDev2("/pcpp_test_ring");
+	SharedMemoryRingReaderDevice readerDev3("/pcpp_test_ring");
+	PTF_ASSERT_TRUE(readerDev1.open());
+	PTF_ASSERT_TRUE(readerDev2.open());
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(readerDev3.open());
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL(writerDev.getNumOfReaders(), 2, int);
+	PTF_ASSERT_EQUAL(readerDev1.getNumOfSlots(), 64, u32);
+
+	// each reader receives all packets, pointing into the ring
+	RawPacket* packets = NULL;
+	PTF_ASSERT_EQUAL(readerDev1.receivePackets(packets, 16), 0, int);
+	PTF_ASSERT_EQUAL(writerDev.sendPackets(packetArr, 64), 64, int);
+	SharedMemoryRingStats stats;
+	writerDev.getStatistics(stats);
+	PTF_ASSERT_EQUAL((int)stats.packets, 64, int);
+	PTF_ASSERT_EQUAL((int)stats.truncated, 0, int);
+	PTF_ASSERT_EQUAL((int)stats.drops, 0, int);
+	for (int i = 0; i < 64; i += 16)
+	{
+		PTF_ASSERT_EQUAL(readerDev1.receivePackets(packets, 16), 16, int);
+		for (int j = 0; j < 16; j++)
+		{
+			RawPacket* sent = packetVec.at(i + j);
+			PTF_ASSERT_EQUAL(packets[j].getRawDataLen(), sent->getRawDataLen(), int);
+			PTF_ASSERT_BUF_COMPARE(packets[j].getRawData(), sent->getRawData(), sent->getRawDataLen());
+			PTF_ASSERT_EQUAL((int)packets[j].getPacketTimeStampNs().tv_sec, (int)sent->getPacketTimeStampNs().tv_sec, int);
+			PTF_ASSERT_EQUAL(packets[j].getLinkLayerType(), sent->getLinkLayerType(), enum);
+		}
+	}
+	readerDev1.releasePackets();
+
+	// the slots of a burst a reader holds aren't overwritten, so the writer drops packets when it gets to them
+	PTF_ASSERT_EQUAL(readerDev2.receivePackets(packets, 100), 16, int);
+	const uint8_t* heldData = packets[0].getRawData();
+	PTF_ASSERT_FALSE(writerDev.sendPacket(packetArr[1]));
+	writerDev.getStatistics(stats);
+	PTF_ASSERT_EQUAL((int)stats.drops, 1, int);
+	PTF_ASSERT_TRUE(packets[0].getRawData() == heldData);
+	PTF_ASSERT_BUF_COMPARE(packets[0].getRawData(), packetVec.at(0)->getRawData(), packetVec.at(0)->getRawDataLen());
+	readerDev2.releasePackets();
+	PTF_ASSERT_EQUAL(writerDev.sendPackets(packetArr, 40), 40, int);
+
+	// a reader which fell behind by more than the ring size counts the overwritten packets as drops
+	int received = 0;
+	int numOfPackets;
+	while ((numOfPackets = readerDev2.receivePackets(packets, 16)) > 0)
+		received += numOfPackets;
+	readerDev2.getStatistics(stats);
+	PTF_ASSERT_EQUAL(received, 32, int);
+	PTF_ASSERT_EQUAL((int)stats.packets, 48, int);
+	PTF_ASSERT_EQUAL((int)stats.drops, 56, int);
+	readerDev1.getStatistics(stats);
+	PTF_ASSERT_EQUAL((int)stats.drops, 0, int);
+	PTF_ASSERT_EQUAL(readerDev1.receivePackets(packets, 64), 16, int);
+	PTF_ASSERT_EQUAL(readerDev1.receivePackets(packets, 64), 16, int);
+	PTF_ASSERT_EQUAL(readerDev1.receivePackets(packets, 64), 8, int);
+	PTF_ASSERT_BUF_COMPARE(packets[7].getRawData(), packetVec.at(39)->getRawData(), packetVec.at(39)->getRawDataLen());
+
+	// packets longer than a slot are truncated
+	SharedMemoryRingWriterDevice smallSlotsDev(SharedMemoryRingConfiguration("/pcpp_test_small_ring", 16, 64, 1));
+	PTF_ASSERT_TRUE(smallSlotsDev.open());
+	SharedMemoryRingReaderDevice smallSlotsReaderDev("/pcpp_test_small_ring");
+	PTF_ASSERT_TRUE(smallSlotsReaderDev.open());
+	PTF_ASSERT_TRUE(smallSlotsDev.sendPacket(*packetVec.front()));
+	smallSlotsDev.getStatistics(stats);
+	PTF_ASSERT_EQUAL((int)stats.truncated, 1, int);
+	PTF_ASSERT_EQUAL(smallSlotsReaderDev.receivePackets(packets, 4), 1, int);
+	PTF_ASSERT_EQUAL(packets[0].getRawDataLen(), 64, int);
+	PTF_ASSERT_EQUAL(packets[0].getFrameLength(), packetVec.front()->getFrameLength(), int);
+	smallSlotsReaderDev.close();
+	smallSlotsDev.close();
+
+	// readers see the writer closing the ring after the packets left in it
+	PTF_ASSERT_TRUE(writerDev.sendPacket(*packetVec.front()));
+	PTF_ASSERT_FALSE(readerDev1.isWriterClosed());
+	writerDev.close();
+	PTF_ASSERT_TRUE(readerDev1.isWriterClosed());
+	PTF_ASSERT_EQUAL(readerDev1.receivePackets(packets, 16, -1), 1, int);
+	PTF_ASSERT_EQUAL(readerDev1.receivePackets(packets, 16, -1), 0, int);
+	readerDev1.close();
+	readerDev2.close();
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(readerDev1.receivePackets(packets, 16), -1, int);
+	PTF_ASSERT_FALSE(readerDev1.open());
+	LoggerPP::getInstance().enableErrors();
+#else
+	PTF_SKIP_TEST("SharedMemoryRingDevice is supported on Linux only");
+#endif
+}
+
+PTF_TEST_CASE(TestFlightRecorderDevice)
+{
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	RawPacketVector packetVec;
+	readerDev.getNextPackets(packetVec);
+	readerDev.close();
+	PTF_ASSERT_TRUE(packetVec.size() > 100);
+
+	// there must be at least two segments per producer
+	FlightRecorderConfiguration config(4 * 4096, 3);
+	config.segmentSize = 4096;
+	config.useHugePages = false;
+	FlightRecorderDevice invalidDev(config);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(invalidDev.open());
+	PTF_ASSERT_FALSE(invalidDev.recordPacket(*packetVec.front()));
+	PTF_ASSERT_FALSE(invalidDev.triggerDump(FlightRecorderDumpRequest(EXAMPLE_PCAP_WRITE_PATH)));
+	LoggerPP::getInstance().enableErrors();
+
+	// when all packets fit in memory a dump writes all of them in order
+	config.capacity = 16 * 1024 * 1024;
+	config.segmentSize = 64 * 1024;
+	config.numOfProducers = 2;
+	FlightRecorderDevice recorderDev(config);
+	PTF_ASSERT_TRUE(recorderDev.open());
+	PTF_ASSERT_EQUAL(recorderDev.getNumOfSegments(), 256, u32);
+	PTF_ASSERT_EQUAL(recorderDev.recordPackets(packetVec), (int)packetVec.size(), int);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(recorderDev.recordPacket(*packetVec.front(), 2));
+	LoggerPP::getInstance().enableErrors();
+	FlightRecorderStats stats;
+	recorderDev.getStatistics(stats);
+	PTF_ASSERT_EQUAL((int)stats.packets, (int)packetVec.size(), int);
+	PTF_ASSERT_EQUAL((int)stats.drops, 0, int);
+	PTF_ASSERT_EQUAL((int)stats.overwrittenSegments, 0, int);
+
+	FlightRecorderDumpResult result;
+	PTF_ASSERT_FALSE(recorderDev.waitForDump(result));
+	PTF_ASSERT_TRUE(recorderDev.triggerDump(FlightRecorderDumpRequest(EXAMPLE_PCAP_WRITE_PATH)));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(recorderDev.triggerDump(FlightRecorderDumpRequest(EXAMPLE_PCAP_WRITE_PATH)));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_TRUE(recorderDev.waitForDump(result));
+	PTF_ASSERT_FALSE(recorderDev.isDumpInProgress());
+	PTF_ASSERT_TRUE(result.succeeded);
+	PTF_ASSERT_EQUAL((int)result.packetsWritten, (int)packetVec.size(), int);
+	PTF_ASSERT_EQUAL((int)result.segmentsLost, 0, int);
+
+	PcapFileReaderDevice dumpReaderDev(EXAMPLE_PCAP_WRITE_PATH);
+	PTF_ASSERT_TRUE(dumpReaderDev.open());
+	RawPacketVector dumpedVec;
+	dumpReaderDev.getNextPackets(dumpedVec);
+	dumpReaderDev.close();
+	PTF_ASSERT_EQUAL(dumpedVec.size(), packetVec.size(), size);
+	for (size_t i = 0; i < packetVec.size(); i += 50)
+	{
+		PTF_ASSERT_EQUAL(dumpedVec.at(i)->getRawDataLen(), packetVec.at(i)->getRawDataLen(), int);
+		PTF_ASSERT_BUF_COMPARE(dumpedVec.at(i)->getRawData(), packetVec.at(i)->getRawData(), packetVec.at(i)->getRawDataLen());
+		PTF_ASSERT_EQUAL((int)dumpedVec.at(i)->getPacketTimeStampNs().tv_sec, (int)packetVec.at(i)->getPacketTimeStampNs().tv_sec, int);
+	}
+
+	// a filtered dump to a pcap-ng file writes only the matching packets, and recording continues while it runs
+	ProtoFilter tcpFilter(TCP);
+	int numOfTcpPackets = 0;
+	for (RawPacketVector::ConstVectorIterator iter = packetVec.begin(); iter != packetVec.end(); iter++)
+	{
+		if (tcpFilter.matchPacketWithFilter(*iter))
+			numOfTcpPackets++;
+	}
+	PTF_ASSERT_TRUE(numOfTcpPackets > 0 && numOfTcpPackets < (int)packetVec.size());
+
+	PTF_ASSERT_TRUE(recorderDev.triggerDump(FlightRecorderDumpRequest(EXAMPLE_PCAPNG_WRITE_PATH, 0, 0, &tcpFilter, true)));
+	PTF_ASSERT_EQUAL(recorderDev.recordPackets(packetVec, 1), (int)packetVec.size(), int);
+	PTF_ASSERT_TRUE(recorderDev.waitForDump(result));
+	PTF_ASSERT_TRUE(result.succeeded);
+	PTF_ASSERT_TRUE((int)result.packetsWritten >= numOfTcpPackets && (int)result.packetsWritten <= 2 * numOfTcpPackets);
+
+	PcapNgFileReaderDevice dumpNgReaderDev(EXAMPLE_PCAPNG_WRITE_PATH);
+	PTF_ASSERT_TRUE(dumpNgReaderDev.open());
+	dumpedVec.clear();
+	dumpNgReaderDev.getNextPackets(dumpedVec);
+	dumpNgReaderDev.close();
+	PTF_ASSERT_EQUAL((int)dumpedVec.size(), (int)result.packetsWritten, int);
+	recorderDev.close();
+
+	// when memory is full the oldest segments are overwritten, so a dump writes the latest packets
+	config.capacity = 4 * 4096;
+	config.segmentSize = 4096;
+	config.numOfProducers = 1;
+	FlightRecorderDevice smallRecorderDev(config);
+	PTF_ASSERT_TRUE(smallRecorderDev.open());
+	PTF_ASSERT_EQUAL(smallRecorderDev.recordPackets(packetVec), (int)packetVec.size(), int);
+	smallRecorderDev.getStatistics(stats);
+	PTF_ASSERT_TRUE(stats.overwrittenSegments > 0);
+	PTF_ASSERT_TRUE(smallRecorderDev.triggerDump(FlightRecorderDumpRequest(EXAMPLE_PCAP_WRITE_PATH)));
+	PTF_ASSERT_TRUE(smallRecorderDev.waitForDump(result));
+	PTF_ASSERT_TRUE(result.packetsWritten > 0 && (int)result.packetsWritten < (int)packetVec.size());
+
+	PcapFileReaderDevice smallDumpReaderDev(EXAMPLE_PCAP_WRITE_PATH);
+	PTF_ASSERT_TRUE(smallDumpReaderDev.open());
+	dumpedVec.clear();
+	smallDumpReaderDev.getNextPackets(dumpedVec);
+	smallDumpReaderDev.close();
+	PTF_ASSERT_EQUAL((int)dumpedVec.size(), (int)result.packetsWritten, int);
+	PTF_ASSERT_BUF_COMPARE(dumpedVec.at(dumpedVec.size() - 1)->getRawData(), packetVec.at(packetVec.size() - 1)->getRawData(), packetVec.at(packetVec.size() - 1)->getRawDataLen());
+	size_t firstDumped = packetVec.size() - dumpedVec.size();
+	PTF_ASSERT_BUF_COMPARE(dumpedVec.front()->getRawData(), packetVec.at(firstDumped)->getRawData(), packetVec.at(firstDumped)->getRawDataLen());
+	smallRecorderDev.close();
+}
+
+PTF_TEST_CASE(TestDeviceMetrics)
+{
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PcapFileWriterDevice writerDev(EXAMPLE_PCAP_WRITE_PATH);
+	PacketQueueDevice queueDev(16);
+	MetricsRegistry registry;
+	PTF_ASSERT_TRUE(registry.addSource(&readerDev, MetricsRegistry::createLabel("device", "reader")));
+	PTF_ASSERT_TRUE(registry.addSource(&writerDev, MetricsRegistry::createLabel("device", "writer")));
+	PTF_ASSERT_TRUE(registry.addSource(&queueDev, MetricsRegistry::createLabel("device", "queue")));
+
+	// closed devices don't report anything
+	MetricsSnapshot snapshot;
+	registry.snapshot(snapshot);
+	PTF_ASSERT_EQUAL(snapshot.values.size(), 0, size);
+
+	PTF_ASSERT_TRUE(readerDev.open());
+	PTF_ASSERT_TRUE(writerDev.open());
+	PTF_ASSERT_TRUE(queueDev.open());
+	RawPacket rawPacket;
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		writerDev.writePacket(rawPacket);
+		queueDev.copyAndEnqueue(&rawPacket, 1);
+	}
+
+	registry.snapshot(snapshot);
+	const MetricValue* value = snapshot.find("pcpp_device_rx_packets_total", "device=\"reader\"");
+	PTF_ASSERT_NOT_NULL(value);
+	PTF_ASSERT_EQUAL((int)value->value, 4631, int);
+	PTF_ASSERT_EQUAL((int)snapshot.find("pcpp_device_rx_dropped_packets_total", "device=\"reader\"")->value, 0, int);
+	PTF_ASSERT_EQUAL((int)snapshot.find("pcpp_device_written_packets_total", "device=\"writer\"")->value, 4631, int);
+	int queueCapacity = (int)queueDev.getCapacity();
+	PTF_ASSERT_EQUAL((int)snapshot.find("pcpp_device_queued_packets", "device=\"queue\"")->value, queueCapacity, int);
+	PTF_ASSERT_EQUAL((int)snapshot.find("pcpp_device_rx_dropped_packets_total", "device=\"queue\"")->value, 4631 - queueCapacity, int);
+
+	std::string text;
+	snapshot.toPrometheusText(text);
+	PTF_ASSERT_TRUE(text.find("# TYPE pcpp_device_rx_dropped_packets_total counter\npcpp_device_rx_dropped_packets_total{device=\"reader\"} 0\n"
+			"pcpp_device_rx_dropped_packets_total{device=\"queue\"} ") != std::string::npos);
+
+	readerDev.close();
+	writerDev.close();
+	queueDev.close();
+}
+
+PTF_TEST_CASE(TestBenchmarkHarness)
+{
+	// the benchmark options are removed and the rest keep their order
+	char arg0[] = "app", arg1[] = "-f", arg2[] = "file.pcap", arg3[] = "--benchmark=3", arg4[] = "--benchmark-warmup=0",
+			arg5[] = "--benchmark-json=out.json", arg6[] = "-v";
+	char* argv[] = { arg0, arg1, arg3, arg2, arg4, arg5, arg6, NULL };
+	int argc = 7;
+	BenchmarkConfiguration config;
+	PTF_ASSERT_FALSE(config.enabled);
+	PTF_ASSERT_TRUE(BenchmarkHarness::extractOptions(argc, argv, config));
+	PTF_ASSERT_EQUAL(argc, 4, int);
+	PTF_ASSERT_EQUAL(std::string(argv[1]), "-f", string);
+	PTF_ASSERT_EQUAL(std::string(argv[2]), "file.pcap", string);
+	PTF_ASSERT_EQUAL(std::string(argv[3]), "-v", string);
+	PTF_ASSERT_NULL(argv[4]);
+	PTF_ASSERT_TRUE(config.enabled);
+	PTF_ASSERT_EQUAL(config.iterations, 3, int);
+	PTF_ASSERT_EQUAL(config.warmupIterations, 0, int);
+	PTF_ASSERT_EQUAL(config.jsonOutputFile, "out.json", string);
+
+	char badArg[] = "--benchmark=none";
+	char* badArgv[] = { arg0, badArg, NULL };
+	int badArgc = 2;
+	BenchmarkConfiguration badConfig;
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(BenchmarkHarness::extractOptions(badArgc, badArgv, badConfig));
+	LoggerPP::getInstance().enableErrors();
+
+	// read the file into memory, with and without a filter
+	config.warmupIterations = 1;
+	config.jsonOutputFile = "";
+	BenchmarkHarness harness("TestBenchmarkHarness", config);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(harness.loadFile("PcapExamples/no_such_file.pcap"));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_TRUE(harness.loadFile(EXAMPLE_PCAP_PATH));
+	PTF_ASSERT_EQUAL(harness.getNumOfPackets(), 4631, size);
+	PTF_ASSERT_TRUE(harness.getNumOfBytes() > 0);
+	ProtoFilter tcpFilter(TCP);
+	PTF_ASSERT_TRUE(harness.loadFile(EXAMPLE_PCAP_PATH, &tcpFilter));
+	PTF_ASSERT_TRUE(harness.getNumOfPackets() > 0 && harness.getNumOfPackets() < 4631);
+
+	// run the warm-up iteration and the measured ones
+	int parseStage = harness.addStage("parse");
+	int countStage = harness.addStage("count");
+	PTF_ASSERT_EQUAL(parseStage, 0, int);
+	PTF_ASSERT_EQUAL(countStage, 1, int);
+	int numOfIterations = 0;
+	int numOfMeasuredIterations = 0;
+	size_t numOfTcpPackets = 0;
+	while (harness.startIteration())
+	{
+		numOfIterations++;
+		if (harness.isMeasuring())
+			numOfMeasuredIterations++;
+
+		numOfTcpPackets = 0;
+		for (size_t i = 0; i < harness.getNumOfPackets(); i++)
+		{
+			harness.beginStage(parseStage);
+			Packet packet(harness.getPacket(i));
+			harness.endStage(parseStage);
+
+			BenchmarkHarness::StageScope countScope(harness, countStage);
+			if (packet.isPacketOfType(TCP))
+				numOfTcpPackets++;
+		}
+		harness.endIteration();
+		PTF_ASSERT_FALSE(harness.isMeasuring());
+	}
+
+	PTF_ASSERT_EQUAL(numOfIterations, 4, int);
+	PTF_ASSERT_EQUAL(numOfMeasuredIterations, 3, int);
+	PTF_ASSERT_EQUAL(harness.getNumOfMeasuredIterations(), 3, int);
+	PTF_ASSERT_EQUAL(numOfTcpPackets, harness.getNumOfPackets(), size);
+	PTF_ASSERT_FALSE(harness.startIteration());
+	PTF_ASSERT_TRUE(harness.getNsPerPacket() > 0);
+	PTF_ASSERT_TRUE(harness.getStageNsPerPacket(parseStage) > 0);
+	PTF_ASSERT_TRUE(harness.getStageNsPerPacket(5) == 0);
+}
+
+struct FilterPerfTestData
+{
+	RawPacketVector* packets;
+	GeneralFilter* bpfFilter;
+	NativeFilterProgram* nativeFilter;
+	int matched;
+};
+
+static void bpfFilterPerfWorkload(void* cookie)
+{
+	FilterPerfTestData* data = (FilterPerfTestData*)cookie;
+	int matched = 0;
+	for (RawPacketVector::VectorIterator iter = data->packets->begin(); iter != data->packets->end(); iter++)
+	{
+		if (data->bpfFilter->matchPacketWithFilter(*iter))
+			matched++;
+	}
+	data->matched = matched;
+}
+
+static void nativeFilterPerfWorkload(void* cookie)
+{
+	FilterPerfTestData* data = (FilterPerfTestData*)cookie;
+	int matched = 0;
+	for (RawPacketVector::VectorIterator iter = data->packets->begin(); iter != data->packets->end(); iter++)
+	{
+		if (data->nativeFilter->matchPacket(*iter))
+			matched++;
+	}
+	data->matched = matched;
+}
+
+PTF_TEST_CASE(TestFilterMatchingPerf)
+{
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(readerDev.open(), "cannot open reader device");
+	RawPacketVector packets;
+	readerDev.getNextPackets(packets);
+	readerDev.close();
+
+	// TCP packets to or from port 80 whose IPv4 total length is above 100 bytes
+	AndFilter filter;
+	ProtoFilter tcpFilter(TCP);
+	PortFilter portFilter(80, SRC_OR_DST);
+	IPv4TotalLengthFilter lengthFilter(100, GREATER_THAN);
+	filter.addFilter(&tcpFilter);
+	filter.addFilter(&portFilter);
+	filter.addFilter(&lengthFilter);
+
+	NativeFilterProgram nativeFilter;
+	PTF_ASSERT_TRUE(nativeFilter.compile(filter));
+
+	FilterPerfTestData data;
+	data.packets = &packets;
+	data.bpfFilter = &filter;
+	data.nativeFilter = &nativeFilter;
+
+	// these baselines were estimated from the Packet++ workloads rather than measured, as this suite needs a libpcap build
+	PTF_ASSERT_PERF("bpf_filter", bpfFilterPerfWorkload, &data, 0.15);
+	int bpfMatched = data.matched;
+	PTF_ASSERT_PERF("native_filter", nativeFilterPerfWorkload, &data, 0.08);
+	PTF_ASSERT_EQUAL(data.matched, bpfMatched, int);
+	PTF_ASSERT_TRUE(bpfMatched > 0);
+}
+
+PTF_TEST_CASE(TestPcapFileIndex)
+{
+	PcapFileIndex index;
+	PTF_ASSERT(index.build(EXAMPLE_PCAP_PATH), "cannot build the index of the pcap file");
+	PTF_ASSERT_FALSE(index.isPcapNg());
+
+	// the indexed packets are the packets the file reader reads
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(readerDev.open(), "cannot open reader device");
+	PcapFileIndex::PacketReader packetReader(index);
+	PTF_ASSERT(packetReader.open(), "cannot open packet reader");
+	RawPacket rawPacket;
+	RawPacket indexedRawPacket;
+	std::vector<uint32_t> packetLengths;
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		PTF_ASSERT(packetReader.readPacket(packetLengths.size(), indexedRawPacket), "cannot read packet #%d", (int)packetLengths.size());
+		PTF_ASSERT_EQUAL(indexedRawPacket.getRawDataLen(), rawPacket.getRawDataLen(), int);
+		PTF_ASSERT_EQUAL(indexedRawPacket.getFrameLength(), rawPacket.getFrameLength(), int);
+		PTF_ASSERT_BUF_COMPARE(indexedRawPacket.getRawData(), rawPacket.getRawData(), rawPacket.getRawDataLen());
+		PTF_ASSERT_TRUE(indexedRawPacket.getPacketTimeStampNs().tv_sec == rawPacket.getPacketTimeStampNs().tv_sec);
+		PTF_ASSERT_TRUE(indexedRawPacket.getPacketTimeStampNs().tv_nsec == rawPacket.getPacketTimeStampNs().tv_nsec);
+		packetLengths.push_back(rawPacket.getRawDataLen());
+	}
+	readerDev.close();
+	PTF_ASSERT_EQUAL((size_t)index.getNumOfPackets(), packetLengths.size(), size);
+	PTF_ASSERT_EQUAL(index.getLinkLayerType(0), LINKTYPE_ETHERNET, enum);
+
+	// packets can be read in any order
+	size_t lastPacket = packetLengths.size() - 1;
+	PTF_ASSERT_TRUE(packetReader.readPacket(lastPacket, indexedRawPacket));
+	PTF_ASSERT_EQUAL((uint32_t)indexedRawPacket.getRawDataLen(), packetLengths[lastPacket], u32);
+	PTF_ASSERT_TRUE(packetReader.readPacket(0, indexedRawPacket));
+	PTF_ASSERT_EQUAL((uint32_t)indexedRawPacket.getRawDataLen(), packetLengths[0], u32);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(packetReader.readPacket(packetLengths.size(), indexedRawPacket));
+	LoggerPP::getInstance().enableErrors();
+	packetReader.close();
+
+	// a saved index is loaded only for the file it was built for
+	std::string indexFileName = PcapFileIndex::getDefaultIndexFileName(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(index.save(indexFileName), "cannot save the index");
+	PcapFileIndex loadedIndex;
+	PTF_ASSERT(loadedIndex.load(indexFileName, EXAMPLE_PCAP_PATH), "cannot load the index");
+	PTF_ASSERT_EQUAL((size_t)loadedIndex.getNumOfPackets(), packetLengths.size(), size);
+	PTF_ASSERT_TRUE(loadedIndex.getPacketOffset(lastPacket) == index.getPacketOffset(lastPacket));
+	PTF_ASSERT_FALSE(loadedIndex.load(indexFileName, EXAMPLE2_PCAP_PATH));
+	PTF_ASSERT(loadedIndex.loadOrBuild(EXAMPLE_PCAP_PATH), "cannot load the index from its default file");
+	PTF_ASSERT_EQUAL((size_t)loadedIndex.getNumOfPackets(), packetLengths.size(), size);
+
+	// unordered parallel reading hands every packet over once
+	ParallelReadCookie cookie;
+	ParallelPcapFileReader parallelReader(loadedIndex);
+	cookie.timesRead.assign(packetLengths.size(), 0);
+	cookie.packetLengths.assign(packetLengths.size(), 0);
+	PTF_ASSERT(parallelReader.read(parallelPacketReadCallback, &cookie, 4), "unordered parallel read failed");
+	PTF_ASSERT_EQUAL((size_t)parallelReader.getNumOfPacketsRead(), packetLengths.size(), size);
+	PTF_ASSERT_TRUE(std::count(cookie.timesRead.begin(), cookie.timesRead.end(), 1) == (int)packetLengths.size());
+	PTF_ASSERT_TRUE(cookie.packetLengths == packetLengths);
+
+	// ordered parallel reading hands the packets over in file order
+	cookie.timesRead.assign(packetLengths.size(), 0);
+	cookie.packetLengths.assign(packetLengths.size(), 0);
+	cookie.nextPacketNumber = 0;
+	cookie.outOfOrder = false;
+	PTF_ASSERT(parallelReader.read(orderedPacketReadCallback, &cookie, 3, true, 100), "ordered parallel read failed");
+	PTF_ASSERT_EQUAL((size_t)parallelReader.getNumOfPacketsRead(), packetLengths.size(), size);
+	PTF_ASSERT_FALSE(cookie.outOfOrder);
+	PTF_ASSERT_EQUAL((size_t)cookie.nextPacketNumber, packetLengths.size(), size);
+	PTF_ASSERT_TRUE(cookie.packetLengths == packetLengths);
+
+	// pcap-ng packets of all interfaces are indexed
+	PcapFileIndex pcapNgIndex;
+	PTF_ASSERT(pcapNgIndex.build(EXAMPLE_PCAPNG_PATH), "cannot build the index of the pcap-ng file");
+	PTF_ASSERT_TRUE(pcapNgIndex.isPcapNg());
+	PcapNgFileReaderDevice pcapNgReaderDev(EXAMPLE_PCAPNG_PATH);
+	PTF_ASSERT(pcapNgReaderDev.open(), "cannot open pcap-ng reader device");
+	PcapFileIndex::PacketReader pcapNgPacketReader(pcapNgIndex);
+	PTF_ASSERT(pcapNgPacketReader.open(), "cannot open pcap-ng packet reader");
+	uint64_t pcapNgPacketCount = 0;
+	while (pcapNgReaderDev.getNextPacket(rawPacket))
+	{
+		PTF_ASSERT(pcapNgPacketReader.readPacket(pcapNgPacketCount, indexedRawPacket), "cannot read pcap-ng packet #%d", (int)pcapNgPacketCount);
+		PTF_ASSERT_EQUAL(indexedRawPacket.getRawDataLen(), rawPacket.getRawDataLen(), int);
+		PTF_ASSERT_EQUAL(indexedRawPacket.getLinkLayerType(), rawPacket.getLinkLayerType(), enum);
+		PTF_ASSERT_BUF_COMPARE(indexedRawPacket.getRawData(), rawPacket.getRawData(), rawPacket.getRawDataLen());
+		PTF_ASSERT_TRUE(indexedRawPacket.getPacketTimeStampNs().tv_sec == rawPacket.getPacketTimeStampNs().tv_sec);
+		pcapNgPacketCount++;
+	}
+	pcapNgReaderDev.close();
+	PTF_ASSERT_EQUAL((int)pcapNgIndex.getNumOfPackets(), (int)pcapNgPacketCount, int);
+
+	// a file which isn't a capture isn't indexed
+	LoggerPP::getInstance().supressErrors();
+	PcapFileIndex invalidIndex;
+	PTF_ASSERT_FALSE(invalidIndex.build("PcapExamples/not_exist.pcap"));
+	PTF_ASSERT_FALSE(invalidIndex.build(indexFileName));
+	LoggerPP::getInstance().enableErrors();
+	remove(indexFileName.c_str());
+}
+
+static bool getPacketFlowTuple(RawPacket& rawPacket, FlowTuple& tuple)
+{
+	PacketView view;
+	return FlowKeyExtractor::extract(&rawPacket, view) && FlowHash::getTuple(view, tuple);
+}
+
+static FlowTuple reverseFlowTuple(const FlowTuple& tuple)
+{
+	FlowTuple reversed = tuple;
+	memcpy(reversed.srcIP, tuple.dstIP, sizeof(reversed.srcIP));
+	memcpy(reversed.dstIP, tuple.srcIP, sizeof(reversed.dstIP));
+	reversed.srcPort = tuple.dstPort;
+	reversed.dstPort = tuple.srcPort;
+	return reversed;
+}
+
+PTF_TEST_CASE(TestPcapFlowIndex)
+{
+	std::string flowIndexFileName = PcapFlowIndex::getDefaultIndexFileName(EXAMPLE_PCAP_PATH);
+	std::string indexFileName = PcapFileIndex::getDefaultIndexFileName(EXAMPLE_PCAP_PATH);
+	remove(flowIndexFileName.c_str());
+	PcapFlowIndex flowIndex;
+	PTF_ASSERT(flowIndex.openOrBuild(EXAMPLE_PCAP_PATH), "cannot build the flow index of the pcap file");
+	PTF_ASSERT_TRUE(flowIndex.isOpened());
+	std::vector<FlowTuple> flows;
+	PTF_ASSERT_TRUE(flowIndex.getFlows(flows));
+	PTF_ASSERT_TRUE(flows.size() > 1);
+	PTF_ASSERT_TRUE(flowIndex.getNumOfFlows() == flows.size());
+
+	// the packets of a flow are the packets of both directions the file reader reads, in file order
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(readerDev.open(), "cannot open reader device");
+	RawPacket rawPacket;
+	FlowTuple flowTuple;
+	bool foundTcpPacket = false;
+	while (!foundTcpPacket && readerDev.getNextPacket(rawPacket))
+		foundTcpPacket = (getPacketFlowTuple(rawPacket, flowTuple) && flowTuple.protocol == PACKETPP_IPPROTO_TCP);
+	PTF_ASSERT_TRUE(foundTcpPacket);
+	readerDev.close();
+
+	FlowTuple reversedFlowTuple = reverseFlowTuple(flowTuple);
+	std::vector<RawPacket*> expectedPackets;
+	PTF_ASSERT(readerDev.open(), "cannot open reader device for the second time");
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		FlowTuple tuple;
+		if (getPacketFlowTuple(rawPacket, tuple) && (tuple == flowTuple || tuple == reversedFlowTuple))
+			expectedPackets.push_back(new RawPacket(rawPacket));
+	}
+	readerDev.close();
+
+	PointerVector<RawPacket> flowPackets;
+	PTF_ASSERT(flowIndex.readFlow(flowTuple, flowPackets), "cannot read the flow");
+	PTF_ASSERT_EQUAL(flowPackets.size(), expectedPackets.size(), size);
+	for (size_t i = 0; i < expectedPackets.size(); i++)
+	{
+		RawPacket* flowPacket = flowPackets.at((int)i);
+		PTF_ASSERT_EQUAL(flowPacket->getRawDataLen(), expectedPackets[i]->getRawDataLen(), int);
+		PTF_ASSERT_BUF_COMPARE(flowPacket->getRawData(), expectedPackets[i]->getRawData(), expectedPackets[i]->getRawDataLen());
+		PTF_ASSERT_TRUE(flowPacket->getPacketTimeStampNs().tv_sec == expectedPackets[i]->getPacketTimeStampNs().tv_sec);
+		delete expectedPackets[i];
+	}
+
+	// a flow is found by its tuple in either direction, and an unknown flow has no packets
+	std::vector<uint64_t> packetOffsets;
+	PTF_ASSERT_TRUE(flowIndex.findFlow(reversedFlowTuple, packetOffsets));
+	PTF_ASSERT_EQUAL(packetOffsets.size(), expectedPackets.size(), size);
+	FlowTuple unknownFlowTuple = flowTuple;
+	unknownFlowTuple.srcPort++;
+	unknownFlowTuple.dstPort++;
+	PTF_ASSERT_TRUE(flowIndex.findFlow(unknownFlowTuple, packetOffsets));
+	PTF_ASSERT_TRUE(packetOffsets.empty());
+
+	// all IP packets of the file belong to exactly one flow
+	uint64_t numOfFlowPackets = 0;
+	for (std::vector<FlowTuple>::iterator iter = flows.begin(); iter != flows.end(); iter++)
+	{
+		PTF_ASSERT_TRUE(flowIndex.findFlow(*iter, packetOffsets));
+		numOfFlowPackets += packetOffsets.size();
+	}
+	PcapFileIndex fileIndex;
+	PTF_ASSERT(fileIndex.load(indexFileName, EXAMPLE_PCAP_PATH), "cannot load the packet index");
+	PTF_ASSERT_EQUAL((int)numOfFlowPackets, (int)fileIndex.getNumOfPackets(), int);
+	flowIndex.close();
+	PTF_ASSERT_FALSE(flowIndex.isOpened());
+
+	// the sidecar file is opened only for the file it was built for
+	PTF_ASSERT(flowIndex.open(flowIndexFileName, EXAMPLE_PCAP_PATH), "cannot open the flow index");
+	PTF_ASSERT_FALSE(flowIndex.open(flowIndexFileName, EXAMPLE2_PCAP_PATH));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(flowIndex.open(indexFileName, EXAMPLE_PCAP_PATH));
+	PTF_ASSERT_FALSE(flowIndex.findFlow(flowTuple, packetOffsets));
+	LoggerPP::getInstance().enableErrors();
+
+	// pcap-ng packets of all interfaces are indexed
+	std::string pcapNgFlowIndexFileName = PcapFlowIndex::getDefaultIndexFileName(EXAMPLE_PCAPNG_PATH);
+	PcapFileIndex pcapNgIndex;
+	PTF_ASSERT(pcapNgIndex.build(EXAMPLE_PCAPNG_PATH), "cannot build the index of the pcap-ng file");
+	PTF_ASSERT(PcapFlowIndex::build(pcapNgIndex, pcapNgFlowIndexFileName), "cannot build the flow index of the pcap-ng file");
+	PTF_ASSERT(flowIndex.open(pcapNgFlowIndexFileName, EXAMPLE_PCAPNG_PATH), "cannot open the flow index of the pcap-ng file");
+	PTF_ASSERT_TRUE(flowIndex.getFlows(flows));
+	PcapNgFileReaderDevice pcapNgReaderDev(EXAMPLE_PCAPNG_PATH);
+	PTF_ASSERT(pcapNgReaderDev.open(), "cannot open pcap-ng reader device");
+	int numOfIpPackets = 0;
+	while (pcapNgReaderDev.getNextPacket(rawPacket))
+	{
+		FlowTuple tuple;
+		if (getPacketFlowTuple(rawPacket, tuple))
+			numOfIpPackets++;
+	}
+	pcapNgReaderDev.close();
+	size_t numOfPcapNgFlowPackets = 0;
+	for (std::vector<FlowTuple>::iterator iter = flows.begin(); iter != flows.end(); iter++)
+	{
+		flowPackets.clear();
+		PTF_ASSERT_TRUE(flowIndex.readFlow(*iter, flowPackets));
+		numOfPcapNgFlowPackets += flowPackets.size();
+	}
+	PTF_ASSERT_EQUAL((int)numOfPcapNgFlowPackets, numOfIpPackets, int);
+	flowIndex.close();
+
+	remove(flowIndexFileName.c_str());
+	remove(indexFileName.c_str());
+	remove(pcapNgFlowIndexFileName.c_str());
+}
+
+PTF_TEST_CASE(TestPcapFileSummary)
+{
+	PcapFileSummary summary;
+	PTF_ASSERT(summary.build(EXAMPLE_PCAP_PATH), "cannot build the summary of the pcap file");
+
+	// take an address and a port the file has from its first TCP packet
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(readerDev.open(), "cannot open reader device");
+	RawPacket rawPacket;
+	int packetCount = 0;
+	std::string srcAddress;
+	uint16_t dstPort = 0;
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		packetCount++;
+		Packet packet(&rawPacket);
+		if (srcAddress.empty() && packet.isPacketOfType(TCP) && packet.isPacketOfType(IPv4))
+		{
+			srcAddress = packet.getLayerOfType<IPv4Layer>()->getSrcIpAddress().toString();
+			dstPort = ntohs(packet.getLayerOfType<TcpLayer>()->getTcpHeader()->portDst);
+		}
+	}
+	readerDev.close();
+	PTF_ASSERT_FALSE(srcAddress.empty());
+	PTF_ASSERT_EQUAL((int)summary.getNumOfPackets(), packetCount, int);
+	PTF_ASSERT_TRUE(summary.getFirstTimestamp().tv_sec <= summary.getLastTimestamp().tv_sec);
+
+	// addresses and ports the file has may match, ones it doesn't have can't
+	IPAddressValue presentAddress = IPAddressValue::fromString(srcAddress);
+	IPAddressValue absentAddress = IPAddressValue::fromString("1.2.3.4");
+	PTF_ASSERT_TRUE(presentAddress.isValid());
+	PTF_ASSERT_TRUE(summary.mayContainIPAddress(presentAddress, SRC));
+	PTF_ASSERT_FALSE(summary.mayContainIPAddress(absentAddress));
+	PTF_ASSERT_TRUE(summary.getMaxNumOfPackets(presentAddress, SRC) > 0);
+	PTF_ASSERT_TRUE(summary.containsPort(dstPort, dstPort, DST));
+	PTF_ASSERT_TRUE(summary.containsIPProtocol(PACKETPP_IPPROTO_TCP));
+
+	IPFilter presentFilter(srcAddress, SRC);
+	IPFilter absentFilter("1.2.3.4", SRC_OR_DST);
+	PortFilter portFilter(dstPort, DST);
+	PTF_ASSERT_TRUE(summary.mayMatch(presentFilter));
+	PTF_ASSERT_FALSE(summary.mayMatch(absentFilter));
+	PTF_ASSERT_TRUE(summary.mayMatch(portFilter));
+
+	// "and" can't match if a condition can't, "or" if none can, "not" may always match
+	AndFilter andFilter;
+	andFilter.addFilter(&presentFilter);
+	andFilter.addFilter(&absentFilter);
+	PTF_ASSERT_FALSE(summary.mayMatch(andFilter));
+	OrFilter orFilter;
+	orFilter.addFilter(&absentFilter);
+	orFilter.addFilter(&portFilter);
+	PTF_ASSERT_TRUE(summary.mayMatch(orFilter));
+	NotFilter notFilter(&presentFilter);
+	PTF_ASSERT_TRUE(summary.mayMatch(notFilter));
+	BPFStringFilter bpfFilter("host 1.2.3.4");
+	PTF_ASSERT_TRUE(summary.mayMatch(bpfFilter));
+
+	// the time window is checked against the first and the last timestamps
+	timespec from = summary.getLastTimestamp();
+	from.tv_sec++;
+	timespec to = from;
+	to.tv_sec++;
+	PTF_ASSERT_FALSE(summary.overlapsTimeRange(from, to));
+	PTF_ASSERT_TRUE(summary.overlapsTimeRange(summary.getFirstTimestamp(), to));
+
+	// a saved summary is loaded only for the file it was built for
+	std::string summaryFileName = PcapFileSummary::getDefaultSummaryFileName(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(summary.save(summaryFileName), "cannot save the summary");
+	PcapFileSummary loadedSummary;
+	PTF_ASSERT(loadedSummary.load(summaryFileName, EXAMPLE_PCAP_PATH), "cannot load the summary");
+	PTF_ASSERT_EQUAL((int)loadedSummary.getNumOfPackets(), packetCount, int);
+	PTF_ASSERT_FALSE(loadedSummary.mayMatch(absentFilter));
+	PTF_ASSERT_TRUE(loadedSummary.mayMatch(presentFilter));
+	PTF_ASSERT_FALSE(loadedSummary.load(summaryFileName, EXAMPLE2_PCAP_PATH));
+	remove(summaryFileName.c_str());
+
+	// a writer with summaries enabled saves the summary of the file it writes
+	PcapFileWriterDevice writerDev("PcapExamples/summary_output.pcap");
+	PTF_ASSERT_TRUE(writerDev.setSummaryEnabled(true));
+	PTF_ASSERT(writerDev.open(), "cannot open writer device");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(writerDev.setSummaryEnabled(false));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT(readerDev.open(), "cannot reopen reader device");
+	while (readerDev.getNextPacket(rawPacket))
+		PTF_ASSERT_TRUE(writerDev.writePacket(rawPacket));
+	readerDev.close();
+	PTF_ASSERT_EQUAL((int)writerDev.getSummary()->getNumOfPackets(), packetCount, int);
+	writerDev.close();
+	PcapFileSummary writtenSummary;
+	std::string writtenSummaryFileName = PcapFileSummary::getDefaultSummaryFileName("PcapExamples/summary_output.pcap");
+	PTF_ASSERT(writtenSummary.load(writtenSummaryFileName, "PcapExamples/summary_output.pcap"), "cannot load the summary of the written file");
+	PTF_ASSERT_EQUAL((int)writtenSummary.getNumOfPackets(), packetCount, int);
+	PTF_ASSERT_TRUE(writtenSummary.mayMatch(presentFilter));
+	PTF_ASSERT_FALSE(writtenSummary.mayMatch(absentFilter));
+	remove(writtenSummaryFileName.c_str());
+	remove("PcapExamples/summary_output.pcap");
+
+	// a file which isn't a capture isn't summarized
+	LoggerPP::getInstance().supressErrors();
+	PcapFileSummary invalidSummary;
+	PTF_ASSERT_FALSE(invalidSummary.build("PcapExamples/not_exist.pcap"));
+	LoggerPP::getInstance().enableErrors();
+}
+
+PTF_TEST_CASE(TestFileReaderSeek)
+{
+	// read the whole file once to know what each seek should return
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(readerDev.open(), "cannot open reader device");
+	RawPacket rawPacket;
+	std::vector<int> packetLengths;
+	std::vector<timespec> timestamps;
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		packetLengths.push_back(rawPacket.getRawDataLen());
+		timestamps.push_back(rawPacket.getPacketTimeStampNs());
+	}
+
+	// seeking builds the index on the first call
+	size_t middle = packetLengths.size() / 2;
+	PTF_ASSERT_TRUE(readerDev.getIndex() == NULL);
+	PTF_ASSERT(readerDev.seekToPacket(middle), "cannot seek to packet #%d", (int)middle);
+	PTF_ASSERT_TRUE(readerDev.getIndex() != NULL);
+	PTF_ASSERT_TRUE(readerDev.getNextPacket(rawPacket));
+	PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), packetLengths[middle], int);
+	PTF_ASSERT_TRUE(readerDev.seekToPacket(0));
+	PTF_ASSERT_TRUE(readerDev.getNextPacket(rawPacket));
+	PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), packetLengths[0], int);
+	PTF_ASSERT_TRUE(readerDev.seekToPacket(packetLengths.size()));
+	PTF_ASSERT_FALSE(readerDev.getNextPacket(rawPacket));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(readerDev.seekToPacket(packetLengths.size() + 1));
+	LoggerPP::getInstance().enableErrors();
+
+	// seeking to the timestamp of a packet reaches the first packet from which on the latest timestamp isn't earlier
+	size_t target = packetLengths.size() * 3 / 4;
+	size_t expected = 0;
+	for (timespec latest = timestamps[0]; expected < target; expected++)
+	{
+		if (timestamps[expected].tv_sec > latest.tv_sec || (timestamps[expected].tv_sec == latest.tv_sec && timestamps[expected].tv_nsec > latest.tv_nsec))
+			latest = timestamps[expected];
+		if (latest.tv_sec > timestamps[target].tv_sec || (latest.tv_sec == timestamps[target].tv_sec && latest.tv_nsec >= timestamps[target].tv_nsec))
+			break;
+	}
+	PTF_ASSERT(readerDev.seekToTime(timestamps[target]), "cannot seek to the time of packet #%d", (int)target);
+	PTF_ASSERT_TRUE(readerDev.getNextPacket(rawPacket));
+	PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), packetLengths[expected], int);
+	PTF_ASSERT_TRUE(rawPacket.getPacketTimeStampNs().tv_sec == timestamps[expected].tv_sec);
+	PTF_ASSERT_TRUE(rawPacket.getPacketTimeStampNs().tv_nsec == timestamps[expected].tv_nsec);
+	timeval afterLastPacket;
+	afterLastPacket.tv_sec = timestamps.back().tv_sec + 1000;
+	afterLastPacket.tv_usec = 0;
+	PTF_ASSERT_TRUE(readerDev.seekToTime(afterLastPacket));
+	PTF_ASSERT_FALSE(readerDev.getNextPacket(rawPacket));
+	readerDev.close();
+
+	// a reader of the same file loads the index saved by the first seek
+	std::string indexFileName = PcapFileIndex::getDefaultIndexFileName(EXAMPLE_PCAP_PATH);
+	MmapPcapFileReaderDevice mmapReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(mmapReaderDev.open(), "cannot open mmap reader device");
+	PTF_ASSERT(mmapReaderDev.loadIndex(indexFileName), "cannot load the index");
+	PTF_ASSERT(mmapReaderDev.seekToPacket(middle), "cannot seek mmap reader to packet #%d", (int)middle);
+	PTF_ASSERT_TRUE(mmapReaderDev.getNextPacket(rawPacket));
+	PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), packetLengths[middle], int);
+	mmapReaderDev.close();
+	remove(indexFileName.c_str());
+
+	// pcap-ng packets read after a seek are matched with interfaces described before the seek position
+	PcapNgFileReaderDevice pcapNgReaderDev(EXAMPLE_PCAPNG_PATH);
+	PTF_ASSERT(pcapNgReaderDev.open(), "cannot open pcap-ng reader device");
+	std::vector<RawPacket*> pcapNgPackets;
+	while (pcapNgReaderDev.getNextPacket(rawPacket))
+		pcapNgPackets.push_back(new RawPacket(rawPacket));
+	pcapNgReaderDev.close();
+
+	PcapNgFileReaderDevice pcapNgSeekDev(EXAMPLE_PCAPNG_PATH);
+	PTF_ASSERT(pcapNgSeekDev.open(), "cannot open pcap-ng reader device");
+	size_t lastPcapNgPacket = pcapNgPackets.size() - 1;
+	PTF_ASSERT(pcapNgSeekDev.seekToPacket(lastPcapNgPacket), "cannot seek to pcap-ng packet #%d", (int)lastPcapNgPacket);
+	PTF_ASSERT_TRUE(pcapNgSeekDev.getNextPacket(rawPacket));
+	PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), pcapNgPackets[lastPcapNgPacket]->getRawDataLen(), int);
+	PTF_ASSERT_EQUAL(rawPacket.getLinkLayerType(), pcapNgPackets[lastPcapNgPacket]->getLinkLayerType(), enum);
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), pcapNgPackets[lastPcapNgPacket]->getRawData(), rawPacket.getRawDataLen());
+	PTF_ASSERT_TRUE(pcapNgSeekDev.seekToPacket(0));
+	for (size_t i = 0; i < pcapNgPackets.size(); i++)
+	{
+		PTF_ASSERT(pcapNgSeekDev.getNextPacket(rawPacket), "cannot read pcap-ng packet #%d after seeking back", (int)i);
+		PTF_ASSERT_EQUAL(rawPacket.getLinkLayerType(), pcapNgPackets[i]->getLinkLayerType(), enum);
+		PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), pcapNgPackets[i]->getRawDataLen(), int);
+	}
+	PTF_ASSERT_FALSE(pcapNgSeekDev.getNextPacket(rawPacket));
+	pcapNgSeekDev.close();
+	for (size_t i = 0; i < pcapNgPackets.size(); i++)
+		delete pcapNgPackets[i];
+	remove(PcapFileIndex::getDefaultIndexFileName(EXAMPLE_PCAPNG_PATH).c_str());
+
+	// seeking requires an opened file
+	PcapFileReaderDevice closedReaderDev(EXAMPLE_PCAP_PATH);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(closedReaderDev.seekToPacket(0));
+	LoggerPP::getInstance().enableErrors();
+}
+
+static bool isArrowFile(const std::string& fileName)
+{
+	FILE* file = fopen(fileName.c_str(), "rb");
+	if (file == NULL)
+		return false;
+
+	char header[8];
+	char trailer[6];
+	bool result = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+			fseek(file, -(long)sizeof(trailer), SEEK_END) == 0 &&
+			fread(trailer, 1, sizeof(trailer), file) == sizeof(trailer) &&
+			memcmp(header, "ARROW1\0\0", sizeof(header)) == 0 &&
+			memcmp(trailer, "ARROW1", sizeof(trailer)) == 0;
+	fclose(file);
+	return result;
+}
+
+PTF_TEST_CASE(TestPacketTableWriter)
+{
+	std::string packetTableFileName = "PcapExamples/packets.arrow";
+	std::string flowTableFileName = "PcapExamples/flows.arrow";
+
+	// the fields of a packet are extracted without parsing its layers
+	PcapFileReaderDevice readerDev("PcapExamples/4KHttpRequests.pcap");
+	PTF_ASSERT(readerDev.open(), "cannot open reader device");
+	RawPacket rawPacket;
+	PTF_ASSERT(readerDev.getNextPacket(rawPacket), "cannot read the first packet");
+	PacketRecord record;
+	PacketTableWriter::extractRecord(rawPacket, record);
+	PTF_ASSERT_EQUAL(record.length, 504, u32);
+	PTF_ASSERT_EQUAL(record.ipVersion, 4, u8);
+	PTF_ASSERT_EQUAL(record.ipProtocol, PACKETPP_IPPROTO_TCP, u8);
+	PTF_ASSERT_EQUAL(record.srcPort, 60399, u16);
+	PTF_ASSERT_EQUAL(record.dstPort, 80, u16);
+	PTF_ASSERT_EQUAL(record.payloadLength, 450, u32);
+	PTF_ASSERT_EQUAL(std::string(record.httpMethod, record.httpMethodLength), "GET", string);
+	PTF_ASSERT_EQUAL(std::string(record.httpHost, record.httpHostLength), "go.ynet.co.il", string);
+	PTF_ASSERT_EQUAL(record.dnsQueryLength, 0, u16);
+	PTF_ASSERT_EQUAL(record.tlsServerNameLength, 0, u16);
+	PTF_ASSERT_TRUE(record.timestampNs == 1413745931455999000ULL);
+
+	// all packets of a reader device are written in small record batches
+	readerDev.close();
+	PTF_ASSERT(readerDev.open(), "cannot reopen reader device");
+	PacketTableWriter packetWriter(packetTableFileName, 100);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(packetWriter.writePacket(rawPacket));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT(packetWriter.open(), "cannot open packet table writer");
+	PTF_ASSERT(packetWriter.writePackets(readerDev), "cannot write the packets of the reader device");
+	PTF_ASSERT_TRUE(packetWriter.getNumOfRows() == 385);
+	PTF_ASSERT(packetWriter.close(), "cannot close packet table writer");
+	readerDev.close();
+	PTF_ASSERT_TRUE(isArrowFile(packetTableFileName));
+
+	// the packets of an indexed file are written by worker threads
+	PcapFileIndex index;
+	PTF_ASSERT(index.build(EXAMPLE_PCAP_PATH), "cannot build the index of the pcap file");
+	PacketTableWriter parallelWriter(packetTableFileName);
+	PTF_ASSERT(parallelWriter.open(), "cannot open packet table writer");
+	PTF_ASSERT(parallelWriter.writePackets(index, 4), "cannot write the packets of the indexed file");
+	PTF_ASSERT_TRUE(parallelWriter.getNumOfRows() == index.getNumOfPackets());
+	PTF_ASSERT(parallelWriter.close(), "cannot close packet table writer");
+	PTF_ASSERT_TRUE(isArrowFile(packetTableFileName));
+
+	// string columns keep each distinct value once
+	ArrowFileWriter arrowWriter(packetTableFileName, 2);
+	int hostColumn = arrowWriter.addColumn("host", ArrowFileWriter::StringColumn, true);
+	int lengthColumn = arrowWriter.addColumn("length", ArrowFileWriter::UInt32Column);
+	PTF_ASSERT(arrowWriter.open(), "cannot open arrow writer");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(arrowWriter.addColumn("late", ArrowFileWriter::UInt8Column), -1, int);
+	LoggerPP::getInstance().enableErrors();
+	const char* hosts[] = { "a.com", "b.com", "a.com", NULL, "b.com" };
+	for (int i = 0; i < 5; i++)
+	{
+		if (hosts[i] != NULL)
+			arrowWriter.setString(hostColumn, hosts[i], strlen(hosts[i]));
+		arrowWriter.setValue(lengthColumn, 60 + i);
+		PTF_ASSERT_TRUE(arrowWriter.endRow());
+	}
+	PTF_ASSERT_EQUAL(arrowWriter.getDictionarySize(hostColumn), 2, size);
+	PTF_ASSERT_EQUAL(arrowWriter.getDictionarySize(lengthColumn), 0, size);
+	PTF_ASSERT_EQUAL(arrowWriter.getNumOfBatches(), 2, size);
+	PTF_ASSERT(arrowWriter.close(), "cannot close arrow writer");
+	PTF_ASSERT_EQUAL(arrowWriter.getNumOfBatches(), 3, size);
+	PTF_ASSERT_TRUE(arrowWriter.getNumOfRows() == 5);
+	PTF_ASSERT_TRUE(isArrowFile(packetTableFileName));
+
+	// the flows of a flow meter are exported to a flow table
+	FlowTableWriter flowWriter(flowTableFileName);
+	PTF_ASSERT(flowWriter.open(), "cannot open flow table writer");
+	FlowMeter meter(FlowMeterConfiguration(), FlowTableWriter::onFlowExported, &flowWriter);
+	PTF_ASSERT(readerDev.open(), "cannot reopen reader device");
+	while (readerDev.getNextPacket(rawPacket))
+		meter.processPacket(&rawPacket);
+	readerDev.close();
+	meter.flush();
+	FlowMeterStats stats;
+	meter.getStats(stats);
+	PTF_ASSERT_TRUE(flowWriter.getNumOfRows() == stats.recordsExported);
+	PTF_ASSERT_TRUE(flowWriter.getNumOfRows() > 0);
+	PTF_ASSERT(flowWriter.close(), "cannot close flow table writer");
+	PTF_ASSERT_TRUE(isArrowFile(flowTableFileName));
+
+	remove(packetTableFileName.c_str());
+	remove(flowTableFileName.c_str());
+}
+
+PTF_TEST_CASE(TestPacketSampler)
+{
+	PcapFileReaderDevice fileReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(fileReaderDev.open(), "Cannot open file '%s'", EXAMPLE_PCAP_PATH);
+	RawPacketVector rawPacketVec;
+	fileReaderDev.getNextPackets(rawPacketVec);
+	fileReaderDev.close();
+	int numOfPackets = (int)rawPacketVec.size();
+
+	// a sampler without stages samples all packets
+	PacketSampler sampler;
+	PTF_ASSERT_FALSE(sampler.isEnabled());
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+		PTF_ASSERT_TRUE(sampler.samplePacket((*iter)->getRawData(), (*iter)->getRawDataLen(), (*iter)->getLinkLayerType(), 0));
+	PTF_ASSERT_EQUAL((int)sampler.getNumOfSampledPackets(), numOfPackets, int);
+
+	// 1-in-N sampling takes the first packet and then every N-th one
+	sampler.setConfiguration(PacketSamplerConfiguration(1, 3));
+	PTF_ASSERT_TRUE(sampler.isEnabled());
+	PTF_ASSERT_EQUAL((int)sampler.getNumOfPackets(), 0, int);
+	int packetIndex = 0;
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++, packetIndex++)
+	{
+		bool sampled = sampler.samplePacket((*iter)->getRawData(), (*iter)->getRawDataLen(), (*iter)->getLinkLayerType(), 0);
+		PTF_ASSERT(sampled == (packetIndex % 3 == 0), "Packet #%d sampling is wrong", packetIndex);
+	}
+	PTF_ASSERT_EQUAL((int)sampler.getNumOfPackets(), numOfPackets, int);
+	PTF_ASSERT_EQUAL((int)sampler.getNumOfSampledPackets(), (numOfPackets + 2) / 3, int);
+
+	// flow sampling samples all packets of a flow in both directions or none of them, and always samples non-IP packets
+	sampler.setConfiguration(PacketSamplerConfiguration(4));
+	std::map<uint32_t, bool> flowDecisions;
+	int numOfSampledByFlow = 0;
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+	{
+		uint32_t flowHash = PacketSampler::getFlowHash((*iter)->getRawData(), (*iter)->getRawDataLen(), (*iter)->getLinkLayerType());
+		bool sampled = sampler.samplePacket((*iter)->getRawData(), (*iter)->getRawDataLen(), (*iter)->getLinkLayerType(), 0);
+		if (flowHash == 0)
+			PTF_ASSERT_TRUE(sampled);
+		std::map<uint32_t, bool>::iterator decision = flowDecisions.find(flowHash);
+		if (decision == flowDecisions.end())
+			flowDecisions[flowHash] = sampled;
+		else
+			PTF_ASSERT(decision->second == sampled, "Flow with hash 0x%X was sampled for some of its packets only", flowHash);
+		if (sampled)
+			numOfSampledByFlow++;
+	}
+	PTF_ASSERT(numOfSampledByFlow > 0 && numOfSampledByFlow < numOfPackets, "Flow sampling sampled %d packets out of %d", numOfSampledByFlow, numOfPackets);
+
+	// the rate cap allows a burst and then one packet per interval
+	sampler.setConfiguration(PacketSamplerConfiguration(1, 1, 1000, 10));
+	int numOfSampled = 0;
+	for (int i = 0; i < 100; i++)
+		if (sampler.samplePacket((uint32_t)0, 5000000000ULL))
+			numOfSampled++;
+	PTF_ASSERT_EQUAL(numOfSampled, 10, int);
+	PTF_ASSERT_FALSE(sampler.samplePacket((uint32_t)0, 5000000500ULL));
+	PTF_ASSERT_TRUE(sampler.samplePacket((uint32_t)0, 5001000000ULL));
+	PTF_ASSERT_FALSE(sampler.samplePacket((uint32_t)0, 5001000000ULL));
+	numOfSampled = 0;
+	for (int i = 0; i < 100; i++)
+		if (sampler.samplePacket((uint32_t)0, 7000000000ULL))
+			numOfSampled++;
+	PTF_ASSERT_EQUAL(numOfSampled, 10, int);
+
+	// the rate cap of parallel samplers is divided between them
+	PacketSamplerConfiguration dividedConfig = PacketSamplerConfiguration(2, 3, 1000, 10).divide(4);
+	PTF_ASSERT_EQUAL((int)dividedConfig.maxPacketsPerSecond, 250, int);
+	PTF_ASSERT_EQUAL((int)dividedConfig.maxBurstSize, 2, int);
+	PTF_ASSERT_EQUAL((int)dividedConfig.flowSamplingRate, 2, int);
+	PTF_ASSERT_EQUAL((int)dividedConfig.packetSamplingRate, 3, int);
+
+	// file readers skip packets which aren't sampled, and return the same packets as sampling the whole file
+	PcapFileReaderDevice sampledReaderDev(EXAMPLE_PCAP_PATH);
+	BufferedPcapFileReaderDevice sampledBufferedReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(sampledReaderDev.open(), "Cannot open file '%s'", EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(sampledBufferedReaderDev.open(), "Cannot open file '%s'", EXAMPLE_PCAP_PATH);
+	sampledReaderDev.setSampling(PacketSamplerConfiguration(4));
+	sampledBufferedReaderDev.setSampling(PacketSamplerConfiguration(4));
+	RawPacket rawPacket;
+	RawPacket bufferedRawPacket;
+	int numOfSampledRead = 0;
+	while (sampledReaderDev.getNextPacket(rawPacket))
+	{
+		PTF_ASSERT(sampledBufferedReaderDev.getNextPacket(bufferedRawPacket), "Buffered reader stopped after %d sampled packets", numOfSampledRead);
+		PTF_ASSERT_EQUAL(bufferedRawPacket.getRawDataLen(), rawPacket.getRawDataLen(), int);
+		PTF_ASSERT_BUF_COMPARE(bufferedRawPacket.getRawData(), rawPacket.getRawData(), rawPacket.getRawDataLen());
+		numOfSampledRead++;
+	}
+	PTF_ASSERT_FALSE(sampledBufferedReaderDev.getNextPacket(bufferedRawPacket));
+	PTF_ASSERT_EQUAL(numOfSampledRead, numOfSampledByFlow, int);
+	PTF_ASSERT_EQUAL((int)sampledReaderDev.getSampler().getNumOfPackets(), numOfPackets, int);
+	PTF_ASSERT_EQUAL((int)sampledReaderDev.getSampler().getNumOfSampledPackets(), numOfSampledByFlow, int);
+
+	// clearing the sampling reads all packets again
+	sampledReaderDev.close();
+	PTF_ASSERT(sampledReaderDev.open(), "Cannot reopen file '%s'", EXAMPLE_PCAP_PATH);
+	sampledReaderDev.clearSampling();
+	RawPacketVector allPacketsVec;
+	PTF_ASSERT_EQUAL(sampledReaderDev.getNextPackets(allPacketsVec), numOfPackets, int);
+	sampledReaderDev.close();
+	sampledBufferedReaderDev.close();
+}
+
+
+PTF_TEST_CASE(TestPcapAutoTuner)
+{
+	PcapAutoTuner tuner;
+	PTF_ASSERT_FALSE(tuner.isEnabled());
+	PTF_ASSERT_EQUAL(tuner.evaluate(0, 100, 10), (int)PcapAutoTuner::NoChange, int);
+
+	PcapAutoTunerConfiguration config(1000, 8000, 1, 16);
+	config.minMinToCopy = 4000;
+	config.maxMinToCopy = 64000;
+	config.evaluationIntervalMs = 100;
+	config.quietIntervalsBeforeDecrease = 3;
+	config.cooldownIntervals = 1;
+
+	// the OS default buffer size and timeout start at the minimum, other values are clamped to the bounds
+	PcapAutoTunerSettings initialSettings;
+	initialSettings.bufferSize = 0;
+	initialSettings.timeoutMs = 1000;
+	initialSettings.minToCopy = 16000;
+	tuner.configure(config, initialSettings);
+	PTF_ASSERT_TRUE(tuner.isEnabled());
+	PTF_ASSERT_EQUAL(tuner.getSettings().bufferSize, 1000, int);
+	PTF_ASSERT_EQUAL(tuner.getSettings().timeoutMs, 16, int);
+	PTF_ASSERT_EQUAL(tuner.getSettings().minToCopy, 16000, int);
+
+	// the first evaluation only records the counters
+	PTF_ASSERT_TRUE(tuner.isEvaluationDue(1000));
+	PTF_ASSERT_EQUAL(tuner.evaluate(1000, 100, 0), (int)PcapAutoTuner::NoChange, int);
+	PTF_ASSERT_FALSE(tuner.isEvaluationDue(1050));
+	PTF_ASSERT_TRUE(tuner.isEvaluationDue(1100));
+
+	// drops double the buffer, and after a change the next interval is skipped
+	uint64_t now = 1100;
+	uint64_t received = 200;
+	uint64_t dropped = 5;
+	PTF_ASSERT_EQUAL(tuner.evaluate(now, received, dropped), (int)PcapAutoTuner::BufferSizeChanged, int);
+	PTF_ASSERT_EQUAL(tuner.getSettings().bufferSize, 2000, int);
+	now += 100; received += 100; dropped += 5;
+	PTF_ASSERT_EQUAL(tuner.evaluate(now, received, dropped), (int)PcapAutoTuner::NoChange, int);
+	now += 100; received += 100; dropped += 5;
+	PTF_ASSERT_EQUAL(tuner.evaluate(now, received, dropped), (int)PcapAutoTuner::BufferSizeChanged, int);
+	PTF_ASSERT_EQUAL(tuner.getSettings().bufferSize, 4000, int);
+	now += 100; received += 100; dropped += 5;
+	tuner.evaluate(now, received, dropped);
+	now += 100; received += 100; dropped += 5;
+	PTF_ASSERT_EQUAL(tuner.evaluate(now, received, dropped), (int)PcapAutoTuner::BufferSizeChanged, int);
+	PTF_ASSERT_EQUAL(tuner.getSettings().bufferSize, 8000, int);
+
+	// at the largest buffer the timeout and the minimum amount of data to copy grow until they reach their maximum
+	now += 100; received += 100; dropped += 5;
+	tuner.evaluate(now, received, dropped);
+	now += 100; received += 100; dropped += 5;
+	PTF_ASSERT_EQUAL(tuner.evaluate(now, received, dropped), (int)PcapAutoTuner::MinToCopyChanged, int);
+	PTF_ASSERT_EQUAL(tuner.getSettings().minToCopy, 32000, int);
+	PTF_ASSERT_EQUAL(tuner.getSettings().timeoutMs, 16, int);
+	now += 100; received += 100; dropped += 5;
+	PTF_ASSERT_EQUAL(tuner.evaluate(now, received, dropped), (int)PcapAutoTuner::MinToCopyChanged, int);
+	PTF_ASSERT_EQUAL(tuner.getSettings().minToCopy, 64000, int);
+	now += 100; received += 100; dropped += 5;
+	PTF_ASSERT_EQUAL(tuner.evaluate(now, received, dropped), (int)PcapAutoTuner::NoChange, int);
+
+	PcapAutoTunerStats stats;
+	tuner.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.bufferIncreases, 3, int);
+	PTF_ASSERT_EQUAL((int)stats.minToCopyIncreases, 2, int);
+	PTF_ASSERT_EQUAL((int)stats.timeoutIncreases, 0, int);
+	PTF_ASSERT_EQUAL((int)stats.intervalsWithDropsAtLimits, 1, int);
+	PTF_ASSERT_EQUAL((int)stats.lastIntervalDrops, 5, int);
+	PTF_ASSERT_EQUAL(stats.settings.bufferSize, 8000, int);
+
+	// drops within the allowed ratio are ignored, and quiet intervals with small batches lower the latency values
+	tuner.configure(config, tuner.getSettings());
+	tuner.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.evaluations, 0, int);
+	config.maxDropRatio = 0.1;
+	tuner.configure(config, tuner.getSettings());
+	now += 100;
+	tuner.evaluate(now, received, dropped);
+	for (int i = 0; i < 2; i++)
+	{
+		tuner.onDispatch(2);
+		tuner.onDispatch(0);
+		now += 100; received += 100; dropped += 1;
+		PTF_ASSERT_EQUAL(tuner.evaluate(now, received, dropped), (int)PcapAutoTuner::NoChange, int);
+	}
+	tuner.onDispatch(2);
+	now += 100; received += 100; dropped += 1;
+	PTF_ASSERT_EQUAL(tuner.evaluate(now, received, dropped), (int)(PcapAutoTuner::TimeoutChanged | PcapAutoTuner::MinToCopyChanged), int);
+	PTF_ASSERT_EQUAL(tuner.getSettings().timeoutMs, 8, int);
+	PTF_ASSERT_EQUAL(tuner.getSettings().minToCopy, 32000, int);
+	PTF_ASSERT_EQUAL(tuner.getSettings().bufferSize, 8000, int);
+	tuner.getStats(stats);
+	PTF_ASSERT_EQUAL((int)stats.intervalsWithDrops, 0, int);
+	PTF_ASSERT_TRUE(stats.lastAverageBatchSize == 2.0);
+
+	// large batches keep the latency values
+	for (int i = 0; i < 10; i++)
+	{
+		tuner.onDispatch(100);
+		now += 100; received += 100;
+		PTF_ASSERT_EQUAL(tuner.evaluate(now, received, dropped), (int)PcapAutoTuner::NoChange, int);
+	}
+
+	// counters which went back (a new handle) start a new baseline
+	now += 100;
+	PTF_ASSERT_EQUAL(tuner.evaluate(now, 10, 10), (int)PcapAutoTuner::NoChange, int);
+	now += 100;
+	PTF_ASSERT_EQUAL(tuner.evaluate(now, 20, 20), (int)(PcapAutoTuner::TimeoutChanged | PcapAutoTuner::MinToCopyChanged), int);
+
+	tuner.disable();
+	PTF_ASSERT_FALSE(tuner.isEnabled());
+} // TestPcapAutoTuner
+
+struct RemoteCaptureCookie
+{
+	RawPacketVector* expectedPackets;
+	int packetCount;
+	int batchCount;
+	int mismatchCount;
+	uint16_t streamId;
+};
+
+static void remoteCapturePacketsArrive(RawPacket* packets, uint32_t numOfPackets, uint16_t streamId, RemoteCaptureDevice* device, void* userCookie)
+{
+	RemoteCaptureCookie* cookie = (RemoteCaptureCookie*)userCookie;
+	cookie->batchCount++;
+	cookie->streamId = streamId;
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		RawPacket* expected = cookie->expectedPackets->at(cookie->packetCount++);
+		if (packets[i].getRawDataLen() != expected->getRawDataLen() ||
+				memcmp(packets[i].getRawData(), expected->getRawData(), expected->getRawDataLen()) != 0 ||
+				packets[i].getPacketTimeStampNs().tv_sec != expected->getPacketTimeStampNs().tv_sec ||
+				packets[i].getPacketTimeStampNs().tv_nsec != expected->getPacketTimeStampNs().tv_nsec)
+			cookie->mismatchCount++;
+	}
+}
+
+PTF_TEST_CASE(TestRemoteCaptureTransport)
+{
+	PcapFileReaderDevice reader(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(reader.open());
+	RawPacketVector packets;
+	PTF_ASSERT_EQUAL(reader.getNextPackets(packets, 200), 200, int);
+	reader.close();
+
+	// a batch is encoded to a frame and decoded back without copying the packets
+	RemoteCaptureBatch batch(PCPP_REMOTE_CAPTURE_MAX_UDP_FRAME_SIZE, 7, LINKTYPE_ETHERNET);
+	bool truncated = true;
+	int numOfPacketsInBatch = 0;
+	while (batch.addPacket(*packets.at(numOfPacketsInBatch), truncated))
+	{
+		PTF_ASSERT_FALSE(truncated);
+		numOfPacketsInBatch++;
+	}
+	PTF_ASSERT_TRUE(numOfPacketsInBatch > 10);
+	PTF_ASSERT_EQUAL((int)batch.getNumOfPackets(), numOfPacketsInBatch, int);
+
+	std::vector<uint8_t> frame;
+	PTF_ASSERT_TRUE(batch.encode(12, RemoteCaptureNoCompression, 0, frame));
+	PTF_ASSERT_TRUE(batch.isEmpty());
+	PTF_ASSERT_TRUE(frame.size() <= PCPP_REMOTE_CAPTURE_MAX_UDP_FRAME_SIZE);
+
+	RemoteCaptureBatchDecoder decoder;
+	PTF_ASSERT_TRUE(decoder.decode(&frame[0], frame.size()));
+	PTF_ASSERT_EQUAL(decoder.getHeader().streamId, 7, u16);
+	PTF_ASSERT_EQUAL(decoder.getHeader().sequence, 12, u32);
+	PTF_ASSERT_EQUAL(decoder.getHeader().linkType, LINKTYPE_ETHERNET, enum);
+	PTF_ASSERT_EQUAL((int)decoder.getNumOfPackets(), numOfPacketsInBatch, int);
+	for (int i = 0; i < numOfPacketsInBatch; i++)
+	{
+		RawPacket& decodedPacket = decoder.getPackets()[i];
+		PTF_ASSERT_EQUAL(decodedPacket.getRawDataLen(), packets.at(i)->getRawDataLen(), int);
+		PTF_ASSERT_EQUAL(decodedPacket.getFrameLength(), packets.at(i)->getFrameLength(), int);
+		PTF_ASSERT_BUF_COMPARE(decodedPacket.getRawData(), packets.at(i)->getRawData(), packets.at(i)->getRawDataLen());
+		PTF_ASSERT_TRUE(decodedPacket.getRawData() >= &frame[0] && decodedPacket.getRawData() < &frame[0] + frame.size());
+	}
+
+	// incomplete and corrupted frames are rejected
+	PTF_ASSERT_FALSE(decoder.decode(&frame[0], frame.size() - 1));
+	PTF_ASSERT_FALSE(decoder.decode(&frame[0], PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE - 1));
+	frame[0] ^= 0xff;
+	PTF_ASSERT_FALSE(decoder.decode(&frame[0], frame.size()));
+	RemoteCaptureFrameHeader header;
+	PTF_ASSERT_FALSE(RemoteCaptureBatchDecoder::parseHeader(&frame[0], frame.size(), header));
+
+	// a packet larger than an empty batch is truncated and keeps its original length
+	RemoteCaptureBatch smallBatch(PCPP_REMOTE_CAPTURE_FRAME_HEADER_SIZE + PCPP_REMOTE_CAPTURE_PACKET_HEADER_SIZE + 20);
+	PTF_ASSERT_TRUE(packets.at(0)->getRawDataLen() > 20);
+	PTF_ASSERT_TRUE(smallBatch.addPacket(*packets.at(0), truncated));
+	PTF_ASSERT_TRUE(truncated);
+	PTF_ASSERT_FALSE(smallBatch.addPacket(*packets.at(1), truncated));
+	PTF_ASSERT_TRUE(smallBatch.encode(0, RemoteCaptureNoCompression, 0, frame));
+	PTF_ASSERT_TRUE(decoder.decode(&frame[0], frame.size()));
+	PTF_ASSERT_EQUAL(decoder.getPackets()[0].getRawDataLen(), 20, int);
+	PTF_ASSERT_EQUAL(decoder.getPackets()[0].getFrameLength(), packets.at(0)->getFrameLength(), int);
+
+#ifdef USE_Z_STD
+	for (int i = 0; i < 10; i++)
+		PTF_ASSERT_TRUE(batch.addPacket(*packets.at(i), truncated));
+	PTF_ASSERT_TRUE(batch.encode(1, RemoteCaptureZstdCompression, 3, frame));
+	PTF_ASSERT_TRUE(decoder.decode(&frame[0], frame.size()));
+	PTF_ASSERT_EQUAL((int)decoder.getNumOfPackets(), 10, int);
+	PTF_ASSERT_BUF_COMPARE(decoder.getPackets()[9].getRawData(), packets.at(9)->getRawData(), packets.at(9)->getRawDataLen());
+#else
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(RemoteCaptureBatch::isCompressionSupported(RemoteCaptureZstdCompression));
+	PTF_ASSERT_FALSE(batch.encode(1, RemoteCaptureZstdCompression, 3, frame));
+	RemoteCaptureSender zstdSender(RemoteCaptureConfiguration(RemoteCaptureTransportTcp, RemoteCaptureZstdCompression));
+	PTF_ASSERT_FALSE(zstdSender.connect("127.0.0.1"));
+	LoggerPP::getInstance().enableErrors();
+#endif
+
+	// send the packets from a sender to a device on the loopback interface, over TCP and over UDP
+	RemoteCaptureTransport transports[] = { RemoteCaptureTransportTcp, RemoteCaptureTransportUdp };
+	for (int transportIndex = 0; transportIndex < 2; transportIndex++)
+	{
+		RemoteCaptureDevice device(transports[transportIndex], 0, "127.0.0.1");
+		PTF_ASSERT_TRUE(device.open());
+		PTF_ASSERT_TRUE(device.getPort() != 0);
+
+		RemoteCaptureCookie cookie;
+		cookie.expectedPackets = &packets;
+		cookie.packetCount = 0;
+		cookie.batchCount = 0;
+		cookie.mismatchCount = 0;
+		cookie.streamId = 0;
+		PTF_ASSERT_TRUE(device.startCapture(remoteCapturePacketsArrive, &cookie));
+
+		RemoteCaptureConfiguration config(transports[transportIndex], RemoteCaptureNoCompression, 10);
+		config.streamId = 5;
+		config.maxBatchLatencyMs = 0;
+		RemoteCaptureSender sender(config);
+		PTF_ASSERT_TRUE(sender.connect("127.0.0.1", device.getPort()));
+		for (RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+			PTF_ASSERT_TRUE(sender.sendPacket(**iter));
+		sender.disconnect();
+
+		RemoteCaptureStreamStats senderStats;
+		sender.getStats(senderStats);
+		PTF_ASSERT_EQUAL(senderStats.streamId, 5, u16);
+		PTF_ASSERT_TRUE(senderStats.batches == 20);
+		PTF_ASSERT_TRUE(senderStats.packets == 200);
+		PTF_ASSERT_TRUE(senderStats.lost == 0);
+
+		for (int i = 0; i < 5 && cookie.packetCount < 200; i++)
+			PCAP_SLEEP(1);
+		device.stopCapture();
 
-    PTF_ASSERT(counter == (4631*5), "Number of read packets different than expected. Read: %d, expected: %d", counter, 4631*6);
+		PTF_ASSERT_EQUAL(cookie.packetCount, 200, int);
+		PTF_ASSERT_EQUAL(cookie.batchCount, 20, int);
+		PTF_ASSERT_EQUAL(cookie.mismatchCount, 0, int);
+		PTF_ASSERT_EQUAL(cookie.streamId, 5, u16);
 
-    LoggerPP::getInstance().supressErrors();
-    PcapFileWriterDevice writerDev2(EXAMPLE_PCAP_WRITE_PATH, LINKTYPE_LINUX_SLL);
-    PTF_ASSERT(writerDev2.open(true) == false, "Managed to open file in append mode even though link layer types are different");
-    LoggerPP::getInstance().enableErrors();
+		std::vector<RemoteCaptureStreamStats> receiverStats;
+		device.getStreamStats(receiverStats);
+		PTF_ASSERT_EQUAL(receiverStats.size(), 1, size);
+		PTF_ASSERT_EQUAL(receiverStats[0].streamId, 5, u16);
+		PTF_ASSERT_TRUE(receiverStats[0].packets == 200);
+		PTF_ASSERT_TRUE(receiverStats[0].packetBytes == senderStats.packetBytes);
+		PTF_ASSERT_TRUE(receiverStats[0].wireBytes == senderStats.wireBytes);
+		PTF_ASSERT_TRUE(receiverStats[0].lost == 0);
+		PTF_ASSERT_TRUE(receiverStats[0].errors == 0);
 
-}
+		device.close();
+	}
+} // TestRemoteCaptureTransport
 
 PTF_TEST_CASE(TestPcapNgFileReadWrite)
 {
@@ -1310,6 +4017,91 @@ PTF_TEST_CASE(TestPcapNgFileReadWriteAdv)
 	writerDev2.close();
 }
 
+PTF_TEST_CASE(TestPcapNgFileZeroCopyRead)
+{
+	// the zero-copy reader returns the same packets and link types as the copying reader, pointing to its read buffer
+	PcapNgFileReaderDevice readerDev(EXAMPLE_PCAPNG_PATH);
+	PcapNgFileReaderDevice zeroCopyReaderDev(EXAMPLE_PCAPNG_PATH, 0, true);
+	PTF_ASSERT(readerDev.open(), "cannot open reader device");
+	PTF_ASSERT(zeroCopyReaderDev.open(), "cannot open zero-copy reader device");
+
+	RawPacket rawPacket;
+	RawPacket zeroCopyRawPacket;
+	int packetCount = 0;
+	int nullLinkLayerCount = 0;
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		PTF_ASSERT(zeroCopyReaderDev.getNextPacket(zeroCopyRawPacket), "zero-copy reader stopped after %d packets", packetCount);
+		PTF_ASSERT_EQUAL(zeroCopyRawPacket.getLinkLayerType(), rawPacket.getLinkLayerType(), enum);
+		PTF_ASSERT_EQUAL(zeroCopyRawPacket.getRawDataLen(), rawPacket.getRawDataLen(), int);
+		PTF_ASSERT_EQUAL(zeroCopyRawPacket.getFrameLength(), rawPacket.getFrameLength(), int);
+		PTF_ASSERT_BUF_COMPARE(zeroCopyRawPacket.getRawData(), rawPacket.getRawData(), rawPacket.getRawDataLen());
+		PTF_ASSERT_TRUE(zeroCopyRawPacket.getPacketTimeStamp().tv_sec == rawPacket.getPacketTimeStamp().tv_sec);
+		PTF_ASSERT_TRUE(zeroCopyRawPacket.getPacketTimeStamp().tv_usec == rawPacket.getPacketTimeStamp().tv_usec);
+		if (zeroCopyRawPacket.getLinkLayerType() == LINKTYPE_NULL)
+			nullLinkLayerCount++;
+		packetCount++;
+	}
+	PTF_ASSERT_FALSE(zeroCopyReaderDev.getNextPacket(zeroCopyRawPacket));
+	PTF_ASSERT_EQUAL(packetCount, 64, int);
+	PTF_ASSERT_EQUAL(nullLinkLayerCount, 2, int);
+
+	pcap_stat stats;
+	zeroCopyReaderDev.getStatistics(stats);
+	PTF_ASSERT_EQUAL((int)stats.ps_recv, packetCount, int);
+	readerDev.close();
+
+	// packets read into a vector are copied, so they stay valid after the file is closed
+	PTF_ASSERT_TRUE(zeroCopyReaderDev.seekToPacket(0));
+	RawPacketVector packetVec;
+	PTF_ASSERT_EQUAL(zeroCopyReaderDev.getNextPackets(packetVec), packetCount, int);
+	zeroCopyReaderDev.close();
+	int ipCount = 0;
+	for (RawPacketVector::VectorIterator iter = packetVec.begin(); iter != packetVec.end(); iter++)
+	{
+		Packet packet(*iter);
+		if (packet.isPacketOfType(IPv4))
+			ipCount++;
+	}
+	PTF_ASSERT_EQUAL(ipCount, 64, int);
+
+	// comments are read only by the overload which returns them
+	PcapNgFileReaderDevice commentReaderDev(EXAMPLE2_PCAPNG_PATH);
+	PcapNgFileReaderDevice zeroCopyCommentReaderDev(EXAMPLE2_PCAPNG_PATH, 0, true);
+	PTF_ASSERT(commentReaderDev.open(), "cannot open reader device");
+	PTF_ASSERT(zeroCopyCommentReaderDev.open(), "cannot open zero-copy reader device");
+	std::string comment;
+	std::string zeroCopyComment;
+	packetCount = 0;
+	int commentCount = 0;
+	while (commentReaderDev.getNextPacket(rawPacket, comment))
+	{
+		PTF_ASSERT(zeroCopyCommentReaderDev.getNextPacket(zeroCopyRawPacket, zeroCopyComment), "zero-copy reader stopped after %d packets", packetCount);
+		PTF_ASSERT_EQUAL(zeroCopyRawPacket.getRawDataLen(), rawPacket.getRawDataLen(), int);
+		PTF_ASSERT_BUF_COMPARE(zeroCopyRawPacket.getRawData(), rawPacket.getRawData(), rawPacket.getRawDataLen());
+		PTF_ASSERT_EQUAL(zeroCopyComment, comment, string);
+		if (comment != "")
+			commentCount++;
+		packetCount++;
+	}
+	PTF_ASSERT_EQUAL(packetCount, 159, int);
+	PTF_ASSERT_EQUAL(commentCount, 100, int);
+
+	// seeking back discards the buffered blocks
+	PTF_ASSERT_TRUE(zeroCopyCommentReaderDev.seekToPacket(10));
+	PTF_ASSERT_TRUE(zeroCopyCommentReaderDev.getNextPacket(zeroCopyRawPacket));
+	commentReaderDev.close();
+	PTF_ASSERT_TRUE(commentReaderDev.open());
+	for (int i = 0; i <= 10; i++)
+		PTF_ASSERT_TRUE(commentReaderDev.getNextPacket(rawPacket));
+	PTF_ASSERT_EQUAL(zeroCopyRawPacket.getRawDataLen(), rawPacket.getRawDataLen(), int);
+	PTF_ASSERT_BUF_COMPARE(zeroCopyRawPacket.getRawData(), rawPacket.getRawData(), rawPacket.getRawDataLen());
+	commentReaderDev.close();
+	zeroCopyCommentReaderDev.close();
+	remove(PcapFileIndex::getDefaultIndexFileName(EXAMPLE_PCAPNG_PATH).c_str());
+	remove(PcapFileIndex::getDefaultIndexFileName(EXAMPLE2_PCAPNG_PATH).c_str());
+}
+
 PTF_TEST_CASE(TestPcapLiveDeviceList)
 {
     vector<PcapLiveDevice*> devList = PcapLiveDeviceList::getInstance().getPcapLiveDevicesList();
@@ -1435,6 +4227,273 @@ PTF_TEST_CASE(TestPcapLiveDeviceStatsMode)
     liveDev->close();
 }
 
+struct BurstCaptureCookie
+{
+	int packetCount;
+	int burstCount;
+	uint32_t maxBurstSize;
+	bool allPacketsSet;
+};
+
+static void packetsArriveBurst(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* pDevice, void* userCookie)
+{
+	BurstCaptureCookie* cookie = (BurstCaptureCookie*)userCookie;
+	cookie->packetCount += numOfPackets;
+	cookie->burstCount++;
+	if (numOfPackets > cookie->maxBurstSize)
+		cookie->maxBurstSize = numOfPackets;
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		if (!packets[i].isPacketSet() || packets[i].getRawDataLen() <= 0 || packets[i].getLinkLayerType() != pDevice->getLinkType())
+			cookie->allPacketsSet = false;
+	}
+}
+
+PTF_TEST_CASE(TestPcapLiveDeviceBurstMode)
+{
+	PcapLiveDevice* liveDev = PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(PcapGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT(liveDev != NULL, "Device used in this test %s doesn't exist", PcapGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT(liveDev->open(), "Cannot open live device");
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureBurstMode(NULL, NULL));
+	PTF_ASSERT_FALSE(liveDev->startCaptureBurstMode(&packetsArriveBurst, NULL, 0));
+	LoggerPP::getInstance().enableErrors();
+
+	BurstCaptureCookie cookie;
+	cookie.packetCount = 0;
+	cookie.burstCount = 0;
+	cookie.maxBurstSize = 0;
+	cookie.allPacketsSet = true;
+	int numOfTimeStatsWereInvoked = 0;
+	PTF_ASSERT(liveDev->startCaptureBurstMode(&packetsArriveBurst, &cookie, 8, 1, &statsUpdate, (void*)&numOfTimeStatsWereInvoked), "Cannot start capture");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureBurstMode(&packetsArriveBurst, &cookie));
+	LoggerPP::getInstance().enableErrors();
+	sendURLRequest("www.ebay.com");
+	PCAP_SLEEP(5);
+	liveDev->stopCapture();
+	PTF_ASSERT(cookie.packetCount > 0, "No packets were captured");
+	PTF_ASSERT_TRUE(cookie.burstCount > 0 && cookie.burstCount <= cookie.packetCount);
+	PTF_ASSERT_TRUE(cookie.maxBurstSize <= 8);
+	PTF_ASSERT_TRUE(cookie.allPacketsSet);
+	PTF_ASSERT(numOfTimeStatsWereInvoked >= 4, "Stat callback was called less than expected: %d", numOfTimeStatsWereInvoked);
+
+	// a regular capture after a burst mode capture calls the per-packet callback again
+	int packetCount = 0;
+	int burstPacketCount = cookie.packetCount;
+	PTF_ASSERT(liveDev->startCapture(&packetArrives, (void*)&packetCount), "Cannot start capture");
+	sendURLRequest("www.ebay.com");
+	PCAP_SLEEP(2);
+	liveDev->stopCapture();
+	PTF_ASSERT(packetCount > 0, "No packets were captured");
+	PTF_ASSERT_EQUAL(cookie.packetCount, burstPacketCount, int);
+	liveDev->close();
+}
+
+struct ReactorCaptureCookie
+{
+	IDevice* liveDevice;
+	IDevice* rawSocketDevice;
+	int livePacketCount;
+	int rawSocketPacketCount;
+	uint32_t maxBurstSize;
+	bool allPacketsSet;
+};
+
+static void reactorPacketsArrive(RawPacket* packets, uint32_t numOfPackets, IDevice* device, void* userCookie)
+{
+	ReactorCaptureCookie* cookie = (ReactorCaptureCookie*)userCookie;
+	if (device == cookie->liveDevice)
+		cookie->livePacketCount += numOfPackets;
+	else if (device == cookie->rawSocketDevice)
+		cookie->rawSocketPacketCount += numOfPackets;
+	else
+		cookie->allPacketsSet = false;
+
+	if (numOfPackets > cookie->maxBurstSize)
+		cookie->maxBurstSize = numOfPackets;
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		if (!packets[i].isPacketSet() || packets[i].getRawDataLen() <= 0)
+			cookie->allPacketsSet = false;
+	}
+}
+
+PTF_TEST_CASE(TestDeviceReactor)
+{
+	PcapLiveDevice* liveDev = PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(PcapGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT(liveDev != NULL, "Device used in this test %s doesn't exist", PcapGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT(liveDev->open(), "Cannot open live device");
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(liveDev->pollPackets(NULL, NULL), -1, int);
+	PTF_ASSERT_EQUAL(liveDev->pollPackets(&packetsArriveBurst, NULL, 0), -1, int);
+	LoggerPP::getInstance().enableErrors();
+
+	// poll the device directly, without a capture thread
+	BurstCaptureCookie pollCookie;
+	pollCookie.packetCount = 0;
+	pollCookie.burstCount = 0;
+	pollCookie.maxBurstSize = 0;
+	pollCookie.allPacketsSet = true;
+	sendURLRequest("www.ebay.com");
+	for (int i = 0; i < 5 && pollCookie.packetCount == 0; i++)
+	{
+		PCAP_SLEEP(1);
+		PTF_ASSERT_TRUE(liveDev->pollPackets(&packetsArriveBurst, &pollCookie, 8) >= 0);
+	}
+	PTF_ASSERT(pollCookie.packetCount > 0, "No packets were polled");
+	PTF_ASSERT_TRUE(pollCookie.maxBurstSize <= 8);
+	PTF_ASSERT_TRUE(pollCookie.allPacketsSet);
+
+	ReactorCaptureCookie cookie;
+	memset(&cookie, 0, sizeof(cookie));
+	cookie.allPacketsSet = true;
+	cookie.liveDevice = liveDev;
+
+#ifdef LINUX
+	PTF_ASSERT_TRUE(liveDev->getSelectableFd() >= 0);
+
+	DeviceReactor reactor(8);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(reactor.addDevice((PcapLiveDevice*)NULL, &reactorPacketsArrive, &cookie));
+	PTF_ASSERT_FALSE(reactor.addDevice(liveDev, NULL, NULL));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_TRUE(reactor.addDevice(liveDev, &reactorPacketsArrive, &cookie));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(reactor.addDevice(liveDev, &reactorPacketsArrive, &cookie));
+	LoggerPP::getInstance().enableErrors();
+
+	IPAddress::Ptr_t ipAddr = IPAddress::fromString(PcapGlobalArgs.ipToSendReceivePackets);
+	RawSocketDevice rawSock(*(ipAddr.get()));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(reactor.addDevice(&rawSock, &reactorPacketsArrive, &cookie));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT(rawSock.open(), "Couldn't open raw socket");
+	PTF_ASSERT_TRUE(rawSock.getSelectableFd() >= 0);
+	cookie.rawSocketDevice = &rawSock;
+	PTF_ASSERT_TRUE(reactor.addDevice(&rawSock, &reactorPacketsArrive, &cookie));
+	PTF_ASSERT_EQUAL(reactor.getNumOfDevices(), 2, size);
+
+	sendURLRequest("www.ebay.com");
+	for (int i = 0; i < 50 && (cookie.livePacketCount == 0 || cookie.rawSocketPacketCount == 0); i++)
+		PTF_ASSERT_TRUE(reactor.runOnce(100) >= 0);
+	PTF_ASSERT(cookie.livePacketCount > 0, "No packets were read from the live device");
+	PTF_ASSERT(cookie.rawSocketPacketCount > 0, "No packets were read from the raw socket");
+	PTF_ASSERT_TRUE(cookie.maxBurstSize <= 8);
+	PTF_ASSERT_TRUE(cookie.allPacketsSet);
+
+	// stop() before run() makes it return right away
+	reactor.stop();
+	PTF_ASSERT_TRUE(reactor.run());
+
+	PTF_ASSERT_TRUE(reactor.removeDevice(&rawSock));
+	PTF_ASSERT_FALSE(reactor.removeDevice(&rawSock));
+	PTF_ASSERT_TRUE(reactor.removeDevice(liveDev));
+	PTF_ASSERT_EQUAL(reactor.getNumOfDevices(), 0, size);
+	rawSock.close();
+#else
+	DeviceReactor reactor;
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(reactor.addDevice(liveDev, &reactorPacketsArrive, &cookie));
+	LoggerPP::getInstance().enableErrors();
+#endif
+
+	// a regular capture after polling puts the device back in blocking mode
+	int packetCount = 0;
+	PTF_ASSERT(liveDev->startCapture(&packetArrives, (void*)&packetCount), "Cannot start capture");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(liveDev->pollPackets(&packetsArriveBurst, &pollCookie), -1, int);
+	LoggerPP::getInstance().enableErrors();
+	sendURLRequest("www.ebay.com");
+	PCAP_SLEEP(2);
+	liveDev->stopCapture();
+	PTF_ASSERT(packetCount > 0, "No packets were captured");
+	liveDev->close();
+}
+
+struct MultiThreadCaptureCookie
+{
+	int packetCount[4];
+	bool allPacketsSet;
+};
+
+static void packetArrivesMultiThread(RawPacket* pPacket, uint8_t threadId, PcapLiveDevice* pDevice, void* userCookie)
+{
+	MultiThreadCaptureCookie* cookie = (MultiThreadCaptureCookie*)userCookie;
+	if (threadId >= 4 || !pPacket->isPacketSet() || pPacket->getLinkLayerType() != pDevice->getLinkType())
+	{
+		cookie->allPacketsSet = false;
+		return;
+	}
+	cookie->packetCount[threadId]++;
+}
+
+PTF_TEST_CASE(TestPcapLiveDeviceMultiThread)
+{
+	PcapLiveDevice* liveDev = PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(PcapGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT(liveDev != NULL, "Device used in this test %s doesn't exist", PcapGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT(liveDev->open(), "Cannot open live device");
+
+	MultiThreadCaptureCookie cookie;
+	memset(&cookie, 0, sizeof(cookie));
+	cookie.allPacketsSet = true;
+
+#ifdef LINUX
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureMultiThread(4, NULL, NULL));
+	PTF_ASSERT_FALSE(liveDev->startCaptureMultiThread(0, &packetArrivesMultiThread, &cookie));
+	PTF_ASSERT_FALSE(liveDev->startCaptureMultiThread(PCPP_LIVE_DEVICE_MAX_CAPTURE_THREADS + 1, &packetArrivesMultiThread, &cookie));
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT(liveDev->startCaptureMultiThread(4, &packetArrivesMultiThread, &cookie, getCoreMaskForAllMachineCores(), PcapLiveDevice::FanoutLoadBalance),
+			"Cannot start multi-thread capture");
+	PTF_ASSERT_TRUE(liveDev->captureActive());
+	PTF_ASSERT_EQUAL(liveDev->getNumOfCaptureThreads(), 4, u8);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureMultiThread(4, &packetArrivesMultiThread, &cookie));
+	PTF_ASSERT_FALSE(liveDev->startCapture(&packetArrives, NULL));
+	LoggerPP::getInstance().enableErrors();
+	sendURLRequest("www.ebay.com");
+	PCAP_SLEEP(5);
+	liveDev->stopCapture();
+	PTF_ASSERT_FALSE(liveDev->captureActive());
+	PTF_ASSERT_TRUE(cookie.allPacketsSet);
+
+	// packets are spread round robin, so all threads capture and the per-thread statistics add up to the captured packets
+	int totalPacketCount = 0;
+	uint32_t totalRecv = 0;
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		PTF_ASSERT(cookie.packetCount[i] > 0, "No packets were captured on thread #%d", (int)i);
+		totalPacketCount += cookie.packetCount[i];
+		pcap_stat threadStats;
+		PTF_ASSERT_TRUE(liveDev->getThreadStatistics(i, threadStats));
+		totalRecv += threadStats.ps_recv;
+	}
+	PTF_ASSERT(totalRecv >= (uint32_t)totalPacketCount, "Threads received %d packets but captured %d", (int)totalRecv, totalPacketCount);
+	pcap_stat threadStats;
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->getThreadStatistics(4, threadStats));
+	LoggerPP::getInstance().enableErrors();
+
+	// a regular capture works after a multi-thread capture
+	int packetCount = 0;
+	PTF_ASSERT(liveDev->startCapture(&packetArrives, (void*)&packetCount), "Cannot start capture");
+	sendURLRequest("www.ebay.com");
+	PCAP_SLEEP(2);
+	liveDev->stopCapture();
+	PTF_ASSERT(packetCount > 0, "No packets were captured");
+#else
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureMultiThread(4, &packetArrivesMultiThread, &cookie));
+	LoggerPP::getInstance().enableErrors();
+#endif
+
+	liveDev->close();
+}
+
 PTF_TEST_CASE(TestPcapLiveDeviceBlockingMode)
 {
 	// open device
@@ -1753,24 +4812,435 @@ PTF_TEST_CASE(TestPcapFilters_General_BPFStr)
 	fileReaderDev.getNextPackets(rawPacketVec);
 	fileReaderDev.close();
 
-	int validCounter = 0;
-
+	int validCounter = 0;
+
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+	{
+		//Check if match using static local variable is leaking?
+		//if (bpfStringFilter.matchPacketWithFilter(*iter) && IPcapDevice::matchPacketWithFilter(bpfStringFilter, *iter) && IPcapDevice::matchPacketWithFilter(filterAsString, *iter))
+		if (bpfStringFilter.matchPacketWithFilter(*iter) && IPcapDevice::matchPacketWithFilter(bpfStringFilter, *iter))
+		{
+			++validCounter;
+			Packet packet(*iter);
+			EthLayer* ethLayer = packet.getLayerOfType<EthLayer>();
+			PTF_ASSERT(ethLayer->getDestMac() == macAddr, "BPFStringFilter test: dest MAC different than expected, it's: '%s'", ethLayer->getDestMac().toString().c_str());
+		}
+	}
+
+	PTF_ASSERT(validCounter == 5, "BPFStringFilter test: Captured: %d packets. Expected: %d packets", validCounter, 5);
+
+	//------------------
+	//Test BpfFilterProgram and program invalidation
+	//------------------
+
+	BpfFilterProgram program;
+	PTF_ASSERT(!program.isCompiled(), "Empty program is compiled");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT(!badFilter.compile(program), "Invalid filter was compiled into a program");
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT(!program.isCompiled(), "Program is compiled after an invalid filter");
+	PTF_ASSERT(bpfStringFilter.compile(program), "Cannot compile BPFStringFilter into a program");
+	PTF_ASSERT(program.getFilterString() == filterAsString, "Program filter string is '%s', expected '%s'", program.getFilterString().c_str(), filterAsString.c_str());
+	PTF_ASSERT(program.getLinkType() == LINKTYPE_ETHERNET, "Program link type isn't Ethernet");
+
+	validCounter = 0;
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+	{
+		if (program.matchPacket(*iter))
+			++validCounter;
+	}
+
+	PTF_ASSERT(validCounter == 5, "BpfFilterProgram test: Matched: %d packets. Expected: %d packets", validCounter, 5);
+
+	MacAddressFilter macFilter(macAddr, DST);
+	MacAddressFilter otherMacFilter(MacAddress("00:00:00:00:00:02"), SRC);
+	NotFilter notOtherMacFilter(&otherMacFilter);
+	AndFilter andFilter;
+	andFilter.addFilter(&macFilter);
+	andFilter.addFilter(&notOtherMacFilter);
+
+	uint32_t version = andFilter.getVersion();
+	validCounter = 0;
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+	{
+		if (andFilter.matchPacketWithFilter(*iter))
+			++validCounter;
+	}
+
+	PTF_ASSERT(validCounter == 5, "AndFilter test: Matched: %d packets. Expected: %d packets", validCounter, 5);
+	PTF_ASSERT(andFilter.getVersion() == version, "Matching packets changed the filter version");
+
+	// changing a filter inside the AndFilter must recompile it
+	macFilter.setMacAddress(MacAddress("00:00:00:00:00:01"));
+	PTF_ASSERT(andFilter.getVersion() != version, "Changing an inner filter didn't change the AndFilter version");
+	validCounter = 0;
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+	{
+		if (andFilter.matchPacketWithFilter(*iter))
+			++validCounter;
+	}
+
+	PTF_ASSERT(validCounter == 0, "AndFilter test after change: Matched: %d packets. Expected: %d packets", validCounter, 0);
+
+	// changing a filter inside the NotFilter must recompile the AndFilter too
+	macFilter.setMacAddress(macAddr);
+	otherMacFilter.setDirection(SRC_OR_DST);
+	otherMacFilter.setMacAddress(macAddr);
+	validCounter = 0;
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+	{
+		if (andFilter.matchPacketWithFilter(*iter))
+			++validCounter;
+	}
+
+	PTF_ASSERT(validCounter == 0, "AndFilter test after NotFilter change: Matched: %d packets. Expected: %d packets", validCounter, 0);
+
+	// the frozen program isn't affected by changes of the filter it was compiled from
+	validCounter = 0;
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+	{
+		if (program.matchPacket(*iter))
+			++validCounter;
+	}
+
+	PTF_ASSERT(validCounter == 5, "BpfFilterProgram test after filter change: Matched: %d packets. Expected: %d packets", validCounter, 5);
+
+	rawPacketVec.clear();
+}
+
+PTF_TEST_CASE(TestBpfJit)
+{
+	if (!BpfJitProgram::isSupported())
+	{
+		PTF_SKIP_TEST("BPF JIT isn't supported on this platform");
+	}
+
+	const char* files[] = { EXAMPLE_PCAP_PATH, EXAMPLE_PCAP_VLAN, EXAMPLE_PCAP_GRE, EXAMPLE_PCAP_IGMP, EXAMPLE_PCAP_DNS };
+	const char* filters[] = {
+		"tcp",
+		"udp port 53",
+		"vlan and ip",
+		"ip[2:2] > 100 and tcp[tcpflags] & tcp-syn != 0",
+		"tcp[((tcp[12] & 0xf0) >> 2):4] = 0x47455420",
+		"ip host 10.0.0.1 or (net 212.199.0.0/16 and not port 80)",
+		"len >= 200 and (ether[0] & 1 = 0)",
+		"igmp or proto gre",
+		"ip[6:2] & 0x1fff = 0 and udp[8:2] / 3 > 100"
+	};
+
+	for (size_t fileIndex = 0; fileIndex < sizeof(files) / sizeof(files[0]); fileIndex++)
+	{
+		PcapFileReaderDevice fileReaderDev(files[fileIndex]);
+		PTF_ASSERT(fileReaderDev.open(), "Cannot open file '%s'", files[fileIndex]);
+		RawPacketVector rawPacketVec;
+		fileReaderDev.getNextPackets(rawPacketVec);
+		fileReaderDev.close();
+
+		for (size_t filterIndex = 0; filterIndex < sizeof(filters) / sizeof(filters[0]); filterIndex++)
+		{
+			LinkLayerType linkType = rawPacketVec.front()->getLinkLayerType();
+
+			BpfFilterProgram jitProgram;
+			PTF_ASSERT(jitProgram.compile(filters[filterIndex], linkType), "Cannot compile filter '%s'", filters[filterIndex]);
+			PTF_ASSERT(jitProgram.isJitCompiled(), "Filter '%s' wasn't translated into native code", filters[filterIndex]);
+
+			BpfFilterProgram::setJitEnabled(false);
+			BpfFilterProgram interpreterProgram;
+			bool compiled = interpreterProgram.compile(filters[filterIndex], linkType);
+			BpfFilterProgram::setJitEnabled(true);
+			PTF_ASSERT(compiled, "Cannot compile filter '%s' for the interpreter", filters[filterIndex]);
+			PTF_ASSERT(!interpreterProgram.isJitCompiled(), "Filter '%s' was translated into native code while the JIT is disabled", filters[filterIndex]);
+
+			int matched = 0;
+			for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+			{
+				bool jitResult = jitProgram.matchPacket(*iter);
+				PTF_ASSERT(jitResult == interpreterProgram.matchPacket(*iter),
+					"JIT and interpreter disagree on filter '%s' for a packet in '%s'", filters[filterIndex], files[fileIndex]);
+				if (jitResult)
+					matched++;
+
+				// truncated packets must fail the bounds checks the same way
+				int truncatedLen = (*iter)->getRawDataLen() / 2;
+				PTF_ASSERT(jitProgram.matchPacket((*iter)->getRawData(), truncatedLen, (*iter)->getRawDataLen()) ==
+						interpreterProgram.matchPacket((*iter)->getRawData(), truncatedLen, (*iter)->getRawDataLen()),
+					"JIT and interpreter disagree on filter '%s' for a truncated packet in '%s'", filters[filterIndex], files[fileIndex]);
+			}
+
+			PTF_PRINT_VERBOSE("Filter '%s' matched %d packets in '%s'", filters[filterIndex], matched, files[fileIndex]);
+		}
+	}
+}
+
+PTF_TEST_CASE(TestNativeFilter)
+{
+	PortFilter portFilter(80, SRC_OR_DST);
+	ProtoFilter tcpFilter(TCP);
+	NotFilter notPortFilter(&portFilter);
+	AndFilter tcpNotPortFilter;
+	tcpNotPortFilter.addFilter(&tcpFilter);
+	tcpNotPortFilter.addFilter(&notPortFilter);
+	IPFilter netFilter("212.199.0.0", DST, 16);
+	TcpFlagsFilter synAckFilter(TcpFlagsFilter::tcpSyn | TcpFlagsFilter::tcpAck, TcpFlagsFilter::MatchAll);
+	TcpFlagsFilter finOrRstFilter(TcpFlagsFilter::tcpFin | TcpFlagsFilter::tcpRst, TcpFlagsFilter::MatchOneAtLeast);
+	UdpLengthFilter udpLengthFilter(100, GREATER_THAN);
+	IPv4IDFilter ipIdFilter(1000, LESS_THAN);
+	OrFilter lengthOrIdFilter;
+	lengthOrIdFilter.addFilter(&udpLengthFilter);
+	lengthOrIdFilter.addFilter(&ipIdFilter);
+	PortRangeFilter portRangeFilter(1000, 2000, SRC);
+	MacAddressFilter broadcastFilter(MacAddress("ff:ff:ff:ff:ff:ff"), DST);
+	EtherTypeFilter arpFilter(PCPP_ETHERTYPE_ARP);
+	ProtoFilter udpFilter(UDP);
+	ProtoFilter ipv6Filter(IPv6);
+	ProtoFilter icmpFilter(ICMP);
+	IPv4TotalLengthFilter totalLengthFilter(60, LESS_OR_EQUAL);
+	TcpWindowSizeFilter windowSizeFilter(1000, GREATER_OR_EQUAL);
+	AndFilter udpNotIPv6Filter;
+	NotFilter notIPv6Filter(&ipv6Filter);
+	udpNotIPv6Filter.addFilter(&notIPv6Filter);
+	udpNotIPv6Filter.addFilter(&udpFilter);
+
+	GeneralFilter* filters[] = { &portFilter, &tcpNotPortFilter, &netFilter, &synAckFilter, &finOrRstFilter, &lengthOrIdFilter,
+		&portRangeFilter, &broadcastFilter, &arpFilter, &udpFilter, &ipv6Filter, &icmpFilter, &totalLengthFilter, &windowSizeFilter,
+		&udpNotIPv6Filter };
+
+	// these files don't contain VLAN tags, IP fragments or SCTP, so the native filters must match exactly what BPF matches
+	const char* files[] = { EXAMPLE_PCAP_PATH, EXAMPLE_PCAP_DNS };
+
+	for (size_t fileIndex = 0; fileIndex < sizeof(files) / sizeof(files[0]); fileIndex++)
+	{
+		PcapFileReaderDevice fileReaderDev(files[fileIndex]);
+		PTF_ASSERT(fileReaderDev.open(), "Cannot open file '%s'", files[fileIndex]);
+		RawPacketVector rawPacketVec;
+		fileReaderDev.getNextPackets(rawPacketVec);
+		fileReaderDev.close();
+
+		for (size_t filterIndex = 0; filterIndex < sizeof(filters) / sizeof(filters[0]); filterIndex++)
+		{
+			std::string filterAsString;
+			filters[filterIndex]->parseToString(filterAsString);
+
+			NativeFilterProgram nativeFilter;
+			PTF_ASSERT(nativeFilter.compile(*filters[filterIndex]), "Cannot compile filter '%s' natively", filterAsString.c_str());
+			PTF_ASSERT(nativeFilter.getNumOfPredicates() > 0, "Filter '%s' was compiled without predicates", filterAsString.c_str());
+
+			int matched = 0;
+			for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+			{
+				bool nativeResult = nativeFilter.matchPacket(*iter);
+				PTF_ASSERT(nativeResult == filters[filterIndex]->matchPacketWithFilter(*iter),
+					"Native filter and BPF disagree on filter '%s' for a packet in '%s'", filterAsString.c_str(), files[fileIndex]);
+				if (nativeResult)
+					matched++;
+			}
+
+			PTF_PRINT_VERBOSE("Filter '%s' matched %d packets in '%s'", filterAsString.c_str(), matched, files[fileIndex]);
+		}
+	}
+
+	// VLAN tags
+	PcapFileReaderDevice vlanFileReaderDev(EXAMPLE_PCAP_VLAN);
+	PTF_ASSERT(vlanFileReaderDev.open(), "Cannot open file '%s'", EXAMPLE_PCAP_VLAN);
+	RawPacketVector vlanPacketVec;
+	vlanFileReaderDev.getNextPackets(vlanPacketVec);
+	vlanFileReaderDev.close();
+
+	VlanFilter vlanFilter(118);
+	NativeFilterProgram vlanNativeFilter;
+	PTF_ASSERT(vlanNativeFilter.compile(vlanFilter), "Cannot compile VLAN filter natively");
+	int vlanMatched = 0;
+	for (RawPacketVector::VectorIterator iter = vlanPacketVec.begin(); iter != vlanPacketVec.end(); iter++)
+	{
+		if (vlanNativeFilter.matchPacket(*iter))
+			vlanMatched++;
+	}
+	PTF_ASSERT(vlanMatched == 12, "VLAN filter matched %d packets, expected 12", vlanMatched);
+
+	// filters which match all packets don't need predicates, and filters which need libpcap can't be compiled
+	AndFilter emptyFilter;
+	NativeFilterProgram emptyNativeFilter;
+	PTF_ASSERT(emptyNativeFilter.compile(emptyFilter), "Cannot compile an empty filter natively");
+	PTF_ASSERT(emptyNativeFilter.getNumOfPredicates() == 0, "Empty filter was compiled into %d predicates", (int)emptyNativeFilter.getNumOfPredicates());
+	PTF_ASSERT(emptyNativeFilter.matchPacket(vlanPacketVec.front()), "Empty filter doesn't match all packets");
+
+	BPFStringFilter bpfStringFilter("tcp");
+	OrFilter orBpfStringFilter;
+	orBpfStringFilter.addFilter(&portFilter);
+	orBpfStringFilter.addFilter(&bpfStringFilter);
+	NativeFilterProgram bpfNativeFilter;
+	PTF_ASSERT(!bpfNativeFilter.compile(orBpfStringFilter), "A filter containing a BPF string was compiled natively");
+	PTF_ASSERT(!bpfNativeFilter.isCompiled(), "Program isn't empty after a failed compilation");
+	PTF_ASSERT(!bpfNativeFilter.matchPacket(vlanPacketVec.front()), "An empty program matched a packet");
+}
+
+PTF_TEST_CASE(TestMultiFilter)
+{
+	PcapFileReaderDevice fileReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(fileReaderDev.open(), "Cannot open file '%s'", EXAMPLE_PCAP_PATH);
+	RawPacketVector rawPacketVec;
+	fileReaderDev.getNextPackets(rawPacketVec);
+	fileReaderDev.close();
+
+	// many filters which test the same fields for different values, as a filter per tenant would
+	std::vector<GeneralFilter*> filters;
+	for (uint16_t port = 1; port <= 100; port++)
+		filters.push_back(new PortFilter(port * 10, SRC_OR_DST));
+	for (int subnet = 0; subnet < 50; subnet++)
+	{
+		std::ostringstream network;
+		network << "212.199." << subnet * 5 << ".0";
+		filters.push_back(new IPFilter(network.str(), SRC, 24));
+	}
+	filters.push_back(new IPFilter("212.199.0.0", DST, 16));
+	filters.push_back(new ProtoFilter(TCP));
+	filters.push_back(new ProtoFilter(UDP));
+	filters.push_back(new EtherTypeFilter(PCPP_ETHERTYPE_ARP));
+	filters.push_back(new TcpFlagsFilter(TcpFlagsFilter::tcpSyn | TcpFlagsFilter::tcpAck, TcpFlagsFilter::MatchAll));
+	filters.push_back(new PortRangeFilter(1000, 2000, SRC));
+	filters.push_back(new MacAddressFilter(MacAddress("ff:ff:ff:ff:ff:ff"), DST));
+	filters.push_back(new IPv4TotalLengthFilter(60, LESS_OR_EQUAL));
+	// a filter equal to an earlier one shares its program
+	filters.push_back(new PortFilter(80, SRC_OR_DST));
+	// a filter with a BPF string is matched with BPF
+	filters.push_back(new BPFStringFilter("tcp and len > 100"));
+
+	MultiFilterProgram multiFilter;
+	std::vector<NativeFilterProgram*> nativeFilters;
+	for (size_t i = 0; i < filters.size(); i++)
+	{
+		PTF_ASSERT(multiFilter.addFilter(*filters[i]) == (int)i, "Filter %d got a wrong ID", (int)i);
+		NativeFilterProgram* nativeFilter = new NativeFilterProgram();
+		nativeFilter->compile(*filters[i]);
+		nativeFilters.push_back(nativeFilter);
+	}
+
+	PTF_ASSERT(multiFilter.getNumOfFilters() == filters.size(), "Program has %d filters, expected %d", (int)multiFilter.getNumOfFilters(), (int)filters.size());
+	PTF_ASSERT(multiFilter.getNumOfBpfFilters() == 1, "Program has %d BPF filters, expected 1", (int)multiFilter.getNumOfBpfFilters());
+	PTF_ASSERT(multiFilter.getNumOfPrograms() == filters.size() - 2, "Program has %d native programs, expected %d", (int)multiFilter.getNumOfPrograms(), (int)filters.size() - 2);
+	PTF_PRINT_VERBOSE("%d filters compiled into %d distinct predicates", (int)multiFilter.getNumOfFilters(), (int)multiFilter.getNumOfPredicates());
+
+	MultiFilterMatches matches;
+	std::vector<int> matchedIds;
+	size_t totalMatched = 0;
 	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
 	{
-		//Check if match using static local variable is leaking?
-		//if (bpfStringFilter.matchPacketWithFilter(*iter) && IPcapDevice::matchPacketWithFilter(bpfStringFilter, *iter) && IPcapDevice::matchPacketWithFilter(filterAsString, *iter))
-		if (bpfStringFilter.matchPacketWithFilter(*iter) && IPcapDevice::matchPacketWithFilter(bpfStringFilter, *iter))
+		size_t numOfMatched = multiFilter.matchPacket(*iter, matches);
+		PTF_ASSERT(numOfMatched == matches.getNumOfMatched(), "Returned number of matched filters differs from the result");
+		matches.getMatchedIds(matchedIds);
+		PTF_ASSERT(matchedIds.size() == numOfMatched, "Got %d matched IDs, expected %d", (int)matchedIds.size(), (int)numOfMatched);
+		totalMatched += numOfMatched;
+
+		for (size_t i = 0; i < filters.size(); i++)
 		{
-			++validCounter;
-			Packet packet(*iter);
-			EthLayer* ethLayer = packet.getLayerOfType<EthLayer>();
-			PTF_ASSERT(ethLayer->getDestMac() == macAddr, "BPFStringFilter test: dest MAC different than expected, it's: '%s'", ethLayer->getDestMac().toString().c_str());
+			bool expected = (nativeFilters[i]->isCompiled() ? nativeFilters[i]->matchPacket(*iter) : filters[i]->matchPacketWithFilter(*iter));
+			PTF_ASSERT(matches.isMatched((int)i) == expected, "Filter %d: multi-filter result differs from matching the filter alone", (int)i);
 		}
 	}
 
-	PTF_ASSERT(validCounter == 5, "BPFStringFilter test: Captured: %d packets. Expected: %d packets", validCounter, 5);
+	PTF_ASSERT(totalMatched > 0, "No packet matched any filter");
+	PTF_ASSERT(!matches.isMatched(-1) && !matches.isMatched((int)filters.size()), "Invalid filter IDs are matched");
 
-	rawPacketVec.clear();
+	// a filter which can't be compiled isn't added
+	BPFStringFilter invalidFilter("invalid filter");
+	PTF_ASSERT(multiFilter.addFilter(invalidFilter) == -1, "An invalid filter was added");
+	PTF_ASSERT(multiFilter.getNumOfFilters() == filters.size(), "An invalid filter was counted");
+
+	multiFilter.clear();
+	PTF_ASSERT(multiFilter.getNumOfFilters() == 0 && multiFilter.getNumOfPredicates() == 0, "Program isn't empty after clear()");
+	PTF_ASSERT(multiFilter.matchPacket(rawPacketVec.front(), matches) == 0, "An empty program matched a packet");
+
+	for (size_t i = 0; i < filters.size(); i++)
+	{
+		delete filters[i];
+		delete nativeFilters[i];
+	}
+}
+
+PTF_TEST_CASE(TestFilterProfiling)
+{
+	PcapFileReaderDevice fileReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(fileReaderDev.open(), "Cannot open file '%s'", EXAMPLE_PCAP_PATH);
+	RawPacketVector rawPacketVec;
+	fileReaderDev.getNextPackets(rawPacketVec);
+	fileReaderDev.close();
+	uint64_t numOfPackets = (uint64_t)rawPacketVec.size();
+
+	ProtoFilter tcpFilter(TCP);
+	PortFilter portFilter(80, SRC_OR_DST);
+	IPFilter netFilter("212.199.0.0", DST, 16);
+	OrFilter portOrNetFilter;
+	portOrNetFilter.addFilter(&portFilter);
+	portOrNetFilter.addFilter(&netFilter);
+	AndFilter filter;
+	filter.addFilter(&tcpFilter);
+	filter.addFilter(&portOrNetFilter);
+
+	// native filter: the first predicate is tested on every packet, and with a sample rate of 1 all tests are measured
+	NativeFilterProgram nativeFilter;
+	PTF_ASSERT(nativeFilter.compile(filter), "Cannot compile filter natively");
+	NativeFilterProfile profile(1);
+	uint64_t numOfMatched = 0;
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+	{
+		bool result = nativeFilter.matchPacket(*iter, profile);
+		PTF_ASSERT(result == nativeFilter.matchPacket(*iter), "Profiled and non-profiled native filters disagree");
+		if (result)
+			numOfMatched++;
+	}
+
+	PTF_ASSERT(profile.getNumOfPackets() == numOfPackets, "Profile counted %d packets, expected %d", (int)profile.getNumOfPackets(), (int)numOfPackets);
+	PTF_ASSERT(profile.getNumOfMatchedPackets() == numOfMatched, "Profile counted %d matched packets, expected %d", (int)profile.getNumOfMatchedPackets(), (int)numOfMatched);
+	PTF_ASSERT(profile.getNumOfPredicates() == nativeFilter.getNumOfPredicates(), "Profile has %d predicates, expected %d", (int)profile.getNumOfPredicates(), (int)nativeFilter.getNumOfPredicates());
+	PTF_ASSERT(profile.getPredicateStats(0).evaluated == numOfPackets, "First predicate wasn't tested on all packets");
+	for (size_t i = 0; i < profile.getNumOfPredicates(); i++)
+	{
+		const FilterNodeStats& stats = profile.getPredicateStats(i);
+		PTF_ASSERT(stats.matched <= stats.evaluated, "Predicate %d matched more packets than it was tested on", (int)i);
+		PTF_ASSERT(stats.sampled == stats.evaluated, "Not all tests of predicate %d were measured", (int)i);
+		PTF_PRINT_VERBOSE("Predicate %d: tested %d, matched %d, %.1f cycles", (int)i, (int)stats.evaluated, (int)stats.matched, stats.getAverageCycles());
+	}
+
+	// reordering the program by the profile doesn't change the result
+	PTF_ASSERT(nativeFilter.optimize(profile), "Cannot optimize the native filter by its profile");
+	NativeFilterProfile otherProfile;
+	PTF_ASSERT(!nativeFilter.optimize(otherProfile), "Native filter was optimized by an unused profile");
+	profile.reset();
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+		nativeFilter.matchPacket(*iter, (profile.getNumOfPackets() <= otherProfile.getNumOfPackets() ? profile : otherProfile));
+	PTF_ASSERT(profile.merge(otherProfile), "Cannot merge profiles of the same program");
+	PTF_ASSERT(profile.getNumOfPackets() == numOfPackets, "Merged profile counted %d packets, expected %d", (int)profile.getNumOfPackets(), (int)numOfPackets);
+	PTF_ASSERT(profile.getNumOfMatchedPackets() == numOfMatched, "Optimized native filter matched %d packets, expected %d", (int)profile.getNumOfMatchedPackets(), (int)numOfMatched);
+
+	// BPF: the nodes are numbered in pre-order and each is evaluated only if the result of its parent depends on it
+	BpfFilterProfile bpfProfile(1);
+	PTF_ASSERT(bpfProfile.compile(filter), "Cannot compile filter profile");
+	PTF_ASSERT(bpfProfile.getNumOfNodes() == 5, "Filter profile has %d nodes, expected 5", (int)bpfProfile.getNumOfNodes());
+	PTF_ASSERT(bpfProfile.getNodeParent(0) == -1 && bpfProfile.getNodeParent(1) == 0 && bpfProfile.getNodeParent(2) == 0 &&
+			bpfProfile.getNodeParent(3) == 2 && bpfProfile.getNodeParent(4) == 2, "Wrong node parents");
+	PTF_ASSERT(bpfProfile.getNodeFilterString(1) == "tcp", "Node 1 filter is '%s', expected 'tcp'", bpfProfile.getNodeFilterString(1).c_str());
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+		PTF_ASSERT(bpfProfile.matchPacket(*iter) == filter.matchPacketWithFilter(*iter), "Filter profile and BPF disagree");
+
+	PTF_ASSERT(bpfProfile.getNodeStats(0).evaluated == numOfPackets, "Root node wasn't evaluated on all packets");
+	PTF_ASSERT(bpfProfile.getNodeStats(0).matched == numOfMatched, "Root node matched %d packets, expected %d", (int)bpfProfile.getNodeStats(0).matched, (int)numOfMatched);
+	PTF_ASSERT(bpfProfile.getNodeStats(1).evaluated == numOfPackets, "First child of the and node wasn't evaluated on all packets");
+	PTF_ASSERT(bpfProfile.getNodeStats(2).evaluated == bpfProfile.getNodeStats(1).matched, "Second child of the and node was evaluated on packets the first didn't match");
+	PTF_ASSERT(bpfProfile.getNodeStats(3).evaluated == bpfProfile.getNodeStats(2).evaluated, "First child of the or node wasn't evaluated with its parent");
+	PTF_ASSERT(bpfProfile.getNodeStats(4).evaluated == bpfProfile.getNodeStats(3).evaluated - bpfProfile.getNodeStats(3).matched, "Second child of the or node was evaluated on packets the first matched");
+	PTF_ASSERT(bpfProfile.getNodeStats(0).sampled == numOfPackets, "Not all evaluations of the root were measured");
+
+	bpfProfile.resetStats();
+	PTF_ASSERT(bpfProfile.getNodeStats(0).evaluated == 0, "Filter profile counters weren't reset");
+
+	// a node which can't be compiled fails the whole profile
+	BPFStringFilter invalidFilter("invalid filter");
+	OrFilter orInvalidFilter;
+	orInvalidFilter.addFilter(&tcpFilter);
+	orInvalidFilter.addFilter(&invalidFilter);
+	PTF_ASSERT(!bpfProfile.compile(orInvalidFilter), "A filter containing an invalid filter was profiled");
+	PTF_ASSERT(bpfProfile.getNumOfNodes() == 0, "Filter profile isn't empty after a failed compilation");
+	PTF_ASSERT(!bpfProfile.matchPacket(rawPacketVec.front()), "An empty filter profile matched a packet");
 }
 
 PTF_TEST_CASE(TestPcapFiltersOffline)
@@ -2233,6 +5703,137 @@ PTF_TEST_CASE(TestPcapFiltersOffline)
 	rawPacketVec.clear();
 }
 
+PTF_TEST_CASE(TestFilterFlowRules)
+{
+	std::vector<FilterFlowRule> rules;
+
+	// merging rules
+	FilterFlowRule tcpRule;
+	tcpRule.ipProtocol = PACKETPP_IPPROTO_TCP;
+	tcpRule.ipProtocolMask = 0xff;
+	FilterFlowRule udpRule;
+	udpRule.ipProtocol = PACKETPP_IPPROTO_UDP;
+	udpRule.ipProtocolMask = 0xff;
+	FilterFlowRule mergedRule;
+	PTF_ASSERT_TRUE(mergedRule.isMatchAll());
+	PTF_ASSERT_TRUE(mergedRule.mergeWith(tcpRule));
+	PTF_ASSERT_FALSE(mergedRule.isMatchAll());
+	PTF_ASSERT_FALSE(mergedRule.mergeWith(udpRule));
+	PTF_ASSERT_EQUAL(mergedRule.ipProtocol, PACKETPP_IPPROTO_TCP, u8);
+
+	// IPv4 addresses and subnets
+	IPFilter ipFilter("10.0.0.1", SRC_OR_DST, 24);
+	PTF_ASSERT_TRUE(ipFilter.toFlowRules(rules));
+	PTF_ASSERT_EQUAL(rules.size(), 2, size);
+	PTF_ASSERT_EQUAL(rules[0].etherType, PCPP_ETHERTYPE_IP, u16);
+	PTF_ASSERT_EQUAL(rules[0].etherTypeMask, 0xffff, u16);
+	PTF_ASSERT_EQUAL(rules[0].srcIPv4Address, IPv4Address(std::string("10.0.0.0")).toInt(), u32);
+	PTF_ASSERT_EQUAL(rules[0].srcIPv4Mask, IPv4Address(std::string("255.255.255.0")).toInt(), u32);
+	PTF_ASSERT_EQUAL(rules[0].dstIPv4Mask, 0, u32);
+	PTF_ASSERT_EQUAL(rules[1].dstIPv4Address, IPv4Address(std::string("10.0.0.0")).toInt(), u32);
+	PTF_ASSERT_EQUAL(rules[1].srcIPv4Mask, 0, u32);
+
+	IPFilter ipMaskFilter("192.168.1.17", DST, "255.255.0.0");
+	PTF_ASSERT_TRUE(ipMaskFilter.toFlowRules(rules));
+	PTF_ASSERT_EQUAL(rules.size(), 1, size);
+	PTF_ASSERT_EQUAL(rules[0].dstIPv4Address, IPv4Address(std::string("192.168.0.0")).toInt(), u32);
+	PTF_ASSERT_EQUAL(rules[0].dstIPv4Mask, IPv4Address(std::string("255.255.0.0")).toInt(), u32);
+
+	IPFilter ipv6Filter("2001:db8::1", SRC);
+	PTF_ASSERT_FALSE(ipv6Filter.toFlowRules(rules));
+	PTF_ASSERT_EQUAL(rules.size(), 0, size);
+
+	// ports match TCP, UDP and SCTP
+	PortFilter portFilter(80, DST);
+	PTF_ASSERT_TRUE(portFilter.toFlowRules(rules));
+	PTF_ASSERT_EQUAL(rules.size(), 3, size);
+	for (size_t i = 0; i < rules.size(); i++)
+	{
+		PTF_ASSERT_EQUAL(rules[i].dstPort, 80, u16);
+		PTF_ASSERT_EQUAL(rules[i].dstPortMask, 0xffff, u16);
+		PTF_ASSERT_EQUAL(rules[i].srcPortMask, 0, u16);
+		PTF_ASSERT_EQUAL(rules[i].ipProtocolMask, 0xff, u8);
+	}
+	PTF_ASSERT_EQUAL(rules[0].ipProtocol, PACKETPP_IPPROTO_TCP, u8);
+	PTF_ASSERT_EQUAL(rules[1].ipProtocol, PACKETPP_IPPROTO_UDP, u8);
+	PTF_ASSERT_EQUAL(rules[2].ipProtocol, PACKETPP_IPPROTO_SCTP, u8);
+
+	// protocols
+	ProtoFilter icmpFilter(ICMP);
+	PTF_ASSERT_TRUE(icmpFilter.toFlowRules(rules));
+	PTF_ASSERT_EQUAL(rules.size(), 1, size);
+	PTF_ASSERT_EQUAL(rules[0].etherType, PCPP_ETHERTYPE_IP, u16);
+	PTF_ASSERT_EQUAL(rules[0].ipProtocol, PACKETPP_IPPROTO_ICMP, u8);
+	ProtoFilter ethFilter(Ethernet);
+	PTF_ASSERT_TRUE(ethFilter.toFlowRules(rules));
+	PTF_ASSERT_EQUAL(rules.size(), 1, size);
+	PTF_ASSERT_TRUE(rules[0].isMatchAll());
+	ProtoFilter vlanFilter(VLAN);
+	PTF_ASSERT_FALSE(vlanFilter.toFlowRules(rules));
+
+	// and: the cross product of the inner rules, without the ones which contradict each other
+	IPFilter srcIpFilter("1.1.1.1", SRC);
+	PortFilter httpsFilter(443, SRC_OR_DST);
+	ProtoFilter tcpFilter(TCP);
+	AndFilter andFilter;
+	andFilter.addFilter(&srcIpFilter);
+	andFilter.addFilter(&httpsFilter);
+	andFilter.addFilter(&tcpFilter);
+	PTF_ASSERT_TRUE(andFilter.toFlowRules(rules));
+	PTF_ASSERT_EQUAL(rules.size(), 2, size);
+	for (size_t i = 0; i < rules.size(); i++)
+	{
+		PTF_ASSERT_EQUAL(rules[i].etherType, PCPP_ETHERTYPE_IP, u16);
+		PTF_ASSERT_EQUAL(rules[i].ipProtocol, PACKETPP_IPPROTO_TCP, u8);
+		PTF_ASSERT_EQUAL(rules[i].srcIPv4Address, IPv4Address(std::string("1.1.1.1")).toInt(), u32);
+	}
+	PTF_ASSERT_EQUAL(rules[0].srcPort, 443, u16);
+	PTF_ASSERT_EQUAL(rules[0].dstPortMask, 0, u16);
+	PTF_ASSERT_EQUAL(rules[1].dstPort, 443, u16);
+	PTF_ASSERT_EQUAL(rules[1].srcPortMask, 0, u16);
+
+	ProtoFilter ipv6ProtoFilter(IPv6);
+	AndFilter contradictingFilter;
+	contradictingFilter.addFilter(&icmpFilter);
+	contradictingFilter.addFilter(&ipv6ProtoFilter);
+	PTF_ASSERT_TRUE(contradictingFilter.toFlowRules(rules));
+	PTF_ASSERT_EQUAL(rules.size(), 0, size);
+
+	// or: the concatenation of the inner rules
+	EtherTypeFilter arpFilter(PCPP_ETHERTYPE_ARP);
+	ProtoFilter udpFilter(UDP);
+	OrFilter orFilter;
+	orFilter.addFilter(&arpFilter);
+	orFilter.addFilter(&udpFilter);
+	PTF_ASSERT_TRUE(orFilter.toFlowRules(rules));
+	PTF_ASSERT_EQUAL(rules.size(), 2, size);
+	PTF_ASSERT_EQUAL(rules[0].etherType, PCPP_ETHERTYPE_ARP, u16);
+	PTF_ASSERT_EQUAL(rules[0].ipProtocolMask, 0, u8);
+	PTF_ASSERT_EQUAL(rules[1].etherTypeMask, 0, u16);
+	PTF_ASSERT_EQUAL(rules[1].ipProtocol, PACKETPP_IPPROTO_UDP, u8);
+
+	// filters which can't be translated
+	NotFilter notFilter(&udpFilter);
+	PTF_ASSERT_FALSE(notFilter.toFlowRules(rules));
+	andFilter.addFilter(&notFilter);
+	PTF_ASSERT_FALSE(andFilter.toFlowRules(rules));
+	PTF_ASSERT_EQUAL(rules.size(), 0, size);
+	IPv4IDFilter ipIdFilter(1234, EQUALS);
+	PTF_ASSERT_FALSE(ipIdFilter.toFlowRules(rules));
+
+	// too many rules
+	OrFilter largeOrFilter;
+	std::vector<PortFilter*> portFilters;
+	for (int i = 0; i < 11; i++)
+	{
+		portFilters.push_back(new PortFilter(1000 + i, SRC_OR_DST));
+		largeOrFilter.addFilter(portFilters.back());
+	}
+	PTF_ASSERT_FALSE(largeOrFilter.toFlowRules(rules));
+	for (size_t i = 0; i < portFilters.size(); i++)
+		delete portFilters[i];
+}
+
 PTF_TEST_CASE(TestSendPacket)
 {
 	PcapLiveDevice* liveDev = NULL;
@@ -2314,6 +5915,57 @@ PTF_TEST_CASE(TestSendPackets)
     fileReaderDev.close();
 }
 
+PTF_TEST_CASE(TestSendPacketsTxBuffer)
+{
+	PcapLiveDevice* liveDev = NULL;
+	IPv4Address ipToSearch(PcapGlobalArgs.ipToSendReceivePackets.c_str());
+	liveDev = PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(ipToSearch);
+	PTF_ASSERT(liveDev != NULL, "Device used in this test %s doesn't exist", PcapGlobalArgs.ipToSendReceivePackets.c_str());
+
+	// a long flush timeout so only a full buffer or an explicit flush send the buffered packets
+	PcapLiveDevice::DeviceConfiguration config(PcapLiveDevice::Promiscuous, 0, 0, PcapLiveDevice::PCPP_INOUT, 10000000);
+	PTF_ASSERT(liveDev->open(config), "Cannot open live device");
+
+	PcapFileReaderDevice fileReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(fileReaderDev.open(), "Cannot open file reader device");
+	RawPacketVector rawPackets;
+	PTF_ASSERT(fileReaderDev.getNextPackets(rawPackets, PCPP_LIVE_DEVICE_TX_BUFFER_SIZE + 10) == PCPP_LIVE_DEVICE_TX_BUFFER_SIZE + 10, "Cannot read packets from file");
+	fileReaderDev.close();
+
+	PTF_ASSERT_EQUAL(liveDev->flushTxBuffer(), 0, int);
+
+	// buffered packets wait in the buffer until it's flushed
+	for (int i = 0; i < 10; i++)
+		PTF_ASSERT_TRUE(liveDev->sendPacket(*rawPackets.at(i), true));
+	PTF_ASSERT_EQUAL(liveDev->getNumOfBufferedTxPackets(), 10, int);
+	PTF_ASSERT_EQUAL(liveDev->flushTxBuffer(true), 0, int);
+	PTF_ASSERT_EQUAL(liveDev->getNumOfBufferedTxPackets(), 10, int);
+	PTF_ASSERT_EQUAL(liveDev->flushTxBuffer(), 10, int);
+	PTF_ASSERT_EQUAL(liveDev->getNumOfBufferedTxPackets(), 0, int);
+
+	// a full buffer is sent as one batch
+	PTF_ASSERT_EQUAL(liveDev->sendPackets(rawPackets, true), PCPP_LIVE_DEVICE_TX_BUFFER_SIZE + 10, int);
+	PTF_ASSERT_EQUAL(liveDev->getNumOfBufferedTxPackets(), 10, int);
+
+	// a send without the buffer flushes it first
+	PTF_ASSERT_TRUE(liveDev->sendPacket(*rawPackets.front()));
+	PTF_ASSERT_EQUAL(liveDev->getNumOfBufferedTxPackets(), 0, int);
+	PTF_ASSERT_EQUAL(liveDev->sendPackets(rawPackets), PCPP_LIVE_DEVICE_TX_BUFFER_SIZE + 10, int);
+
+	// invalid packets are neither sent nor buffered
+	LoggerPP::getInstance().supressErrors();
+	uint8_t emptyPacket[1];
+	PTF_ASSERT_FALSE(liveDev->sendPacket(emptyPacket, 0, true));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL(liveDev->getNumOfBufferedTxPackets(), 0, int);
+
+	// closing the device sends the packets left in the buffer
+	PTF_ASSERT_TRUE(liveDev->sendPacket(*rawPackets.front(), true));
+	PTF_ASSERT_EQUAL(liveDev->getNumOfBufferedTxPackets(), 1, int);
+	liveDev->close();
+	PTF_ASSERT_EQUAL(liveDev->getNumOfBufferedTxPackets(), 0, int);
+}
+
 PTF_TEST_CASE(TestRemoteCapture)
 {
 #ifdef WIN32
@@ -3335,30 +6987,537 @@ PTF_TEST_CASE(TestDpdkDevice)
 	PTF_PRINT_VERBOSE("UDP packets: %d", packetData.UdpCount);
 	PTF_PRINT_VERBOSE("HTTP packets: %d", packetData.HttpCount);
 
-	DpdkDevice::DpdkDeviceStats stats;
-	dev->getStatistics(stats);
-	PTF_PRINT_VERBOSE("Packets captured according to stats: %lu", stats.aggregatedRxStats.packets);
-	PTF_PRINT_VERBOSE("Bytes captured according to stats: %lu", stats.aggregatedRxStats.bytes);
-	PTF_PRINT_VERBOSE("Packets dropped according to stats: %lu", stats.rxPacketsDropeedByHW);
-	PTF_PRINT_VERBOSE("Erroneous packets according to stats: %lu", stats.rxErroneousPackets);
-	for (int i = 0; i < DPDK_MAX_RX_QUEUES; i++)
+	DpdkDevice::DpdkDeviceStats stats;
+	dev->getStatistics(stats);
+	PTF_PRINT_VERBOSE("Packets captured according to stats: %lu", stats.aggregatedRxStats.packets);
+	PTF_PRINT_VERBOSE("Bytes captured according to stats: %lu", stats.aggregatedRxStats.bytes);
+	PTF_PRINT_VERBOSE("Packets dropped according to stats: %lu", stats.rxPacketsDropeedByHW);
+	PTF_PRINT_VERBOSE("Erroneous packets according to stats: %lu", stats.rxErroneousPackets);
+	for (int i = 0; i < DPDK_MAX_RX_QUEUES; i++)
+	{
+		PTF_PRINT_VERBOSE("Packets captured on RX queue #%d according to stats: %lu", i, stats.rxStats[i].packets);
+		PTF_PRINT_VERBOSE("Bytes captured on RX queue #%d according to stats: %lu", i, stats.rxStats[i].bytes);
+
+	}
+	PTF_ASSERT_AND_RUN_COMMAND(packetData.PacketCount > 0, dev->close(), "No packets were captured");
+	PTF_ASSERT_AND_RUN_COMMAND(packetData.ThreadId != -1, dev->close(), "Couldn't retrieve thread ID");
+
+	int statsVsPacketCount = stats.aggregatedRxStats.packets > (uint64_t)packetData.PacketCount ? stats.aggregatedRxStats.packets-(uint64_t)packetData.PacketCount : (uint64_t)packetData.PacketCount-stats.aggregatedRxStats.packets;
+	PTF_ASSERT_AND_RUN_COMMAND(statsVsPacketCount <= 20, dev->close(),
+			"Stats received packet count (%lu) is different than calculated packet count (%d)",
+			stats.aggregatedRxStats.packets,
+			packetData.PacketCount);
+	dev->close();
+	dev->close();
+
+
+
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
+PTF_TEST_CASE(TestDpdkDeviceFilters)
+{
+#ifdef USE_DPDK
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+
+	ProtoFilter udpFilter(UDP);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT(dev->setFilter(udpFilter) == false, "Succeed setting a filter while device is closed");
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT(dev->open() == true, "Cannot open DPDK device");
+	PTF_ASSERT_AND_RUN_COMMAND(dev->isFilterCurrentlySet() == false, dev->close(), "Filter is set although none was set yet");
+
+	// a filter which can be translated into flow rules, offloaded to the NIC if its PMD supports rte_flow and applied in software otherwise
+	PTF_ASSERT_AND_RUN_COMMAND(dev->setFilter(udpFilter) == true, dev->close(), "Couldn't set UDP filter");
+	PTF_ASSERT_AND_RUN_COMMAND(dev->isFilterCurrentlySet() == true, dev->close(), "Filter isn't set");
+	PTF_PRINT_VERBOSE("UDP filter offloaded: %d", (int)dev->isFilterOffloaded());
+
+	DpdkPacketData packetData;
+	PTF_ASSERT_AND_RUN_COMMAND(dev->startCaptureSingleThread(dpdkPacketsArrive, &packetData), dev->close(), "Could not start capturing on DpdkDevice");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(dev->clearFilter() == false, dev->close(), "Managed to clear the filter while capturing");
+	LoggerPP::getInstance().enableErrors();
+	PCAP_SLEEP(10);
+	dev->stopCapture();
+	PTF_ASSERT_AND_RUN_COMMAND(packetData.TcpCount == 0, dev->close(), "UDP filter captured %d TCP packets", packetData.TcpCount);
+	PTF_ASSERT_AND_RUN_COMMAND(packetData.ArpCount == 0, dev->close(), "UDP filter captured %d ARP packets", packetData.ArpCount);
+
+	// a BPF string is always applied in software
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(dev->setFilter("invalid filter") == false, dev->close(), "Managed to set an invalid filter");
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(dev->setFilter("tcp") == true, dev->close(), "Couldn't set TCP filter");
+	PTF_ASSERT_AND_RUN_COMMAND(dev->isFilterOffloaded() == false, dev->close(), "BPF string filter was offloaded");
+	packetData.clear();
+	PTF_ASSERT_AND_RUN_COMMAND(dev->startCaptureSingleThread(dpdkPacketsArrive, &packetData), dev->close(), "Could not start capturing on DpdkDevice");
+	PCAP_SLEEP(10);
+	dev->stopCapture();
+	PTF_ASSERT_AND_RUN_COMMAND(packetData.UdpCount == 0, dev->close(), "TCP filter captured %d UDP packets", packetData.UdpCount);
+	PTF_ASSERT_AND_RUN_COMMAND(packetData.TcpCount == packetData.PacketCount, dev->close(), "TCP filter captured non-TCP packets");
+
+	PTF_ASSERT_AND_RUN_COMMAND(dev->clearFilter() == true, dev->close(), "Couldn't clear the filter");
+	PTF_ASSERT_AND_RUN_COMMAND(dev->isFilterCurrentlySet() == false, dev->close(), "Filter is still set after it was cleared");
+	dev->close();
+
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
+PTF_TEST_CASE(TestDpdkDeviceFlowRules)
+{
+#ifdef USE_DPDK
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+
+	DpdkFlowRule tcpRule;
+	PTF_ASSERT_TRUE(tcpRule.setProtocol(TCP));
+	tcpRule.action = DpdkFlowRule::FlowActionDrop;
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT(dev->addFlowRule(tcpRule) == -1, "Added a flow rule while device is closed");
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT(dev->open() == true, "Cannot open DPDK device");
+
+	// invalid rules
+	LoggerPP::getInstance().supressErrors();
+	DpdkFlowRule portRule;
+	portRule.setDstPortRange(1000, 2000);
+	PTF_ASSERT_AND_RUN_COMMAND(dev->addFlowRule(portRule) == -1, dev->close(), "Added a flow rule matching ports without a protocol");
+	PTF_ASSERT_AND_RUN_COMMAND(portRule.setProtocol(HTTP) == false, dev->close(), "Set a protocol flow rules can't match");
+	portRule.setProtocol(UDP);
+	portRule.queueId = dev->getNumOfOpenedRxQueues();
+	PTF_ASSERT_AND_RUN_COMMAND(dev->addFlowRule(portRule) == -1, dev->close(), "Added a flow rule to an RX queue which isn't opened");
+	portRule.queueId = 0;
+	portRule.setDstPortRange(2000, 1000);
+	PTF_ASSERT_AND_RUN_COMMAND(dev->addFlowRule(portRule) == -1, dev->close(), "Added a flow rule with an invalid port range");
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(dev->getNumOfFlowRules() == 0, dev->close(), "Invalid flow rules were added");
+
+	// the PMD may not support rte_flow or these rules
+	LoggerPP::getInstance().supressErrors();
+	int tcpRuleId = dev->addFlowRule(tcpRule);
+	LoggerPP::getInstance().enableErrors();
+	if (tcpRuleId < 0)
+	{
+		dev->close();
+		PTF_SKIP_TEST("Flow rules aren't supported by the device");
+	}
+
+	PTF_ASSERT_AND_RUN_COMMAND(dev->getNumOfFlowRules() == 1, dev->close(), "Flow rule wasn't added");
+
+	// a filter isn't offloaded while flow rules exist
+	ProtoFilter udpFilter(UDP);
+	PTF_ASSERT_AND_RUN_COMMAND(dev->setFilter(udpFilter) == true, dev->close(), "Couldn't set UDP filter");
+	PTF_ASSERT_AND_RUN_COMMAND(dev->isFilterOffloaded() == false, dev->close(), "Filter was offloaded while flow rules exist");
+	PTF_ASSERT_AND_RUN_COMMAND(dev->clearFilter() == true, dev->close(), "Couldn't clear the filter");
+
+	DpdkPacketData packetData;
+	PTF_ASSERT_AND_RUN_COMMAND(dev->startCaptureSingleThread(dpdkPacketsArrive, &packetData), dev->close(), "Could not start capturing on DpdkDevice");
+	PCAP_SLEEP(10);
+	dev->stopCapture();
+	PTF_ASSERT_AND_RUN_COMMAND(packetData.TcpCount == 0, dev->close(), "TCP drop rule let %d TCP packets through", packetData.TcpCount);
+
+	PTF_ASSERT_AND_RUN_COMMAND(dev->removeFlowRule(tcpRuleId) == true, dev->close(), "Couldn't remove flow rule");
+	PTF_ASSERT_AND_RUN_COMMAND(dev->removeFlowRule(tcpRuleId) == false, dev->close(), "Removed a flow rule twice");
+	PTF_ASSERT_AND_RUN_COMMAND(dev->getNumOfFlowRules() == 0, dev->close(), "Flow rule wasn't removed");
+
+	// a range which isn't aligned is split into several NIC rules, all removed together
+	portRule.setDstPortRange(1000, 2000);
+	portRule.setMark = true;
+	portRule.mark = 5;
+	int portRuleId = dev->addFlowRule(portRule);
+	PTF_PRINT_VERBOSE("UDP port range flow rule supported: %d", (int)(portRuleId >= 0));
+	dev->close();
+	PTF_ASSERT(dev->getNumOfFlowRules() == 0, "Flow rules weren't removed when the device was closed");
+
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
+PTF_TEST_CASE(TestDpdkDeviceOffloads)
+{
+#ifdef USE_DPDK
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+
+	uint64_t supportedOffloads = dev->getSupportedOffloads();
+	PTF_PRINT_VERBOSE("Supported offloads: 0x%X", (uint32_t)supportedOffloads);
+	PTF_ASSERT(dev->isDeviceSupportOffloads(0) == true, "Empty offloads mask isn't supported");
+	PTF_ASSERT(dev->isDeviceSupportOffloads(supportedOffloads) == true, "Supported offloads aren't supported");
+
+	uint64_t allOffloads = DpdkDevice::OFFLOAD_RX_IPV4_CKSUM | DpdkDevice::OFFLOAD_RX_TCP_CKSUM | DpdkDevice::OFFLOAD_RX_UDP_CKSUM |
+			DpdkDevice::OFFLOAD_RX_VLAN_STRIP | DpdkDevice::OFFLOAD_RX_TIMESTAMP | DpdkDevice::OFFLOAD_RX_TCP_LRO |
+			DpdkDevice::OFFLOAD_TX_IPV4_CKSUM | DpdkDevice::OFFLOAD_TX_TCP_CKSUM | DpdkDevice::OFFLOAD_TX_UDP_CKSUM |
+			DpdkDevice::OFFLOAD_TX_VLAN_INSERT | DpdkDevice::OFFLOAD_TX_TCP_TSO;
+	if ((supportedOffloads & allOffloads) != allOffloads)
+	{
+		DpdkDevice::DpdkDeviceConfiguration unsupportedConfig;
+		unsupportedConfig.offloads = allOffloads;
+		LoggerPP::getInstance().supressErrors();
+		PTF_ASSERT_AND_RUN_COMMAND(dev->openMultiQueues(1, 1, unsupportedConfig) == false, dev->close(), "Opened device with unsupported offloads");
+		LoggerPP::getInstance().enableErrors();
+	}
+
+	DpdkDevice::DpdkDeviceConfiguration config;
+	config.offloads = supportedOffloads & (DpdkDevice::OFFLOAD_TX_IPV4_CKSUM | DpdkDevice::OFFLOAD_TX_TCP_CKSUM | DpdkDevice::OFFLOAD_TX_UDP_CKSUM);
+	PTF_ASSERT(dev->openMultiQueues(1, 1, config) == true, "Cannot open DPDK device with offloads 0x%X", (uint32_t)config.offloads);
+	PTF_ASSERT_AND_RUN_COMMAND(dev->getEnabledOffloads() == config.offloads, dev->close(), "Enabled offloads 0x%X differ from configured 0x%X", (uint32_t)dev->getEnabledOffloads(), (uint32_t)config.offloads);
+
+	// requesting the offloads of a TCP packet doesn't depend on the NIC
+	PcapFileReaderDevice reader(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_AND_RUN_COMMAND(reader.open() == true, dev->close(), "Cannot open file '%s'", EXAMPLE_PCAP_PATH);
+	RawPacket rawPacket;
+	bool tcpPacketFound = false;
+	while (!tcpPacketFound && reader.getNextPacket(rawPacket))
+	{
+		Packet packet(&rawPacket);
+		tcpPacketFound = packet.isPacketOfType(TCP) && packet.isPacketOfType(IPv4);
+	}
+	reader.close();
+	PTF_ASSERT_AND_RUN_COMMAND(tcpPacketFound == true, dev->close(), "No TCP packet in file");
+
+	MBufRawPacket mBufRawPacket;
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.initFromRawPacket(&rawPacket, dev) == true, dev->close(), "Cannot initialize MBufRawPacket");
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.getRxIPChecksumStatus() == MBufRawPacket::RxChecksumUnknown, dev->close(), "Packet which wasn't received has IP checksum status");
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.setTxChecksumOffload() == true, dev->close(), "Couldn't request checksum offloads");
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.getOffloadFlags() != 0, dev->close(), "Checksum offloads weren't set in mbuf");
+	Packet offloadedPacket(&mBufRawPacket);
+	PTF_ASSERT_AND_RUN_COMMAND(offloadedPacket.getLayerOfType<IPv4Layer>()->getIPv4Header()->headerChecksum == 0, dev->close(), "IPv4 checksum field wasn't zeroed");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.setTxTcpSegmentation(0) == false, dev->close(), "Requested TSO with segment size 0");
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.setTxVlanInsert(100) == true, dev->close(), "Couldn't request VLAN insertion");
+	mBufRawPacket.clearTxOffloads();
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.getOffloadFlags() == 0, dev->close(), "TX offloads weren't cleared");
+
+	if (config.offloads == (DpdkDevice::OFFLOAD_TX_IPV4_CKSUM | DpdkDevice::OFFLOAD_TX_TCP_CKSUM | DpdkDevice::OFFLOAD_TX_UDP_CKSUM))
+	{
+		PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.setTxChecksumOffload() == true, dev->close(), "Couldn't request checksum offloads");
+		PTF_ASSERT_AND_RUN_COMMAND(dev->sendPacket(mBufRawPacket, 0) == true, dev->close(), "Couldn't send packet with checksum offloads");
+	}
+
+	dev->close();
+	PTF_ASSERT(dev->getEnabledOffloads() == 0, "Closed device has enabled offloads");
+
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
+PTF_TEST_CASE(TestDpdkMBufRawPacketSegments)
+{
+#ifdef USE_DPDK
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+
+	DpdkDevice::DpdkDeviceConfiguration config;
+	config.offloads = dev->getSupportedOffloads() & DpdkDevice::OFFLOAD_TX_MULTI_SEGS;
+	PTF_ASSERT(dev->openMultiQueues(1, 1, config) == true, "Cannot open DPDK device");
+
+	PcapFileReaderDevice reader(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_AND_RUN_COMMAND(reader.open() == true, dev->close(), "Cannot open file '%s'", EXAMPLE_PCAP_PATH);
+	RawPacket rawPacket;
+	PTF_ASSERT_AND_RUN_COMMAND(reader.getNextPacket(rawPacket) == true, dev->close(), "Cannot read packet from file");
+	reader.close();
+
+	// a jumbo frame doesn't fit in one mbuf of the default size
+	const int jumboLen = 9000;
+	uint8_t* jumboData = new uint8_t[jumboLen];
+	for (int i = 0; i < jumboLen; i++)
+		jumboData[i] = (uint8_t)i;
+	memcpy(jumboData, rawPacket.getRawData(), rawPacket.getRawDataLen());
+	RawPacket jumboRawPacket(jumboData, jumboLen, rawPacket.getPacketTimeStamp(), true);
+
+	MBufRawPacket jumboMBuf;
+	PTF_ASSERT_AND_RUN_COMMAND(jumboMBuf.initFromRawPacket(&jumboRawPacket, dev) == true, dev->close(), "Cannot initialize MBufRawPacket from jumbo frame");
+	PTF_ASSERT_AND_RUN_COMMAND(jumboMBuf.isMultiSegment() == true, dev->close(), "Jumbo frame isn't in a chained mbuf");
+	PTF_ASSERT_AND_RUN_COMMAND(jumboMBuf.getPacketLength() == (size_t)jumboLen, dev->close(), "Wrong packet length %d", (int)jumboMBuf.getPacketLength());
+	PTF_ASSERT_AND_RUN_COMMAND(jumboMBuf.getFrameLength() == jumboLen, dev->close(), "Wrong frame length %d", jumboMBuf.getFrameLength());
+	PTF_ASSERT_AND_RUN_COMMAND(jumboMBuf.getRawDataLen() < jumboLen, dev->close(), "Raw data covers more than the first segment");
+
+	size_t offset = 0;
+	size_t segmentLen = 0;
+	for (size_t i = 0; i < jumboMBuf.getNumOfSegments(); i++)
+	{
+		const uint8_t* segmentData = jumboMBuf.getSegmentData(i, segmentLen);
+		PTF_ASSERT_AND_RUN_COMMAND(segmentData != NULL, dev->close(), "Segment %d is NULL", (int)i);
+		PTF_ASSERT_AND_RUN_COMMAND(memcmp(segmentData, jumboData + offset, segmentLen) == 0, dev->close(), "Segment %d data is different", (int)i);
+		offset += segmentLen;
+	}
+	PTF_ASSERT_AND_RUN_COMMAND(offset == (size_t)jumboLen, dev->close(), "Segments length %d is different from packet length", (int)offset);
+	PTF_ASSERT_AND_RUN_COMMAND(jumboMBuf.getSegmentData(jumboMBuf.getNumOfSegments(), segmentLen) == NULL, dev->close(), "Got data of a segment out of range");
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(jumboMBuf.removeData(0, 10) == false, dev->close(), "Removed data from a chained mbuf");
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT_AND_RUN_COMMAND(jumboMBuf.linearize() == true, dev->close(), "Couldn't linearize jumbo frame");
+	PTF_ASSERT_AND_RUN_COMMAND(jumboMBuf.isLinearizedCopy() == true, dev->close(), "Jumbo frame was merged into one mbuf");
+	PTF_ASSERT_AND_RUN_COMMAND(jumboMBuf.getRawDataLen() == jumboLen, dev->close(), "Linearized raw data length %d is wrong", jumboMBuf.getRawDataLen());
+	PTF_ASSERT_AND_RUN_COMMAND(memcmp(jumboMBuf.getRawData(), jumboData, jumboLen) == 0, dev->close(), "Linearized data is different");
+
+	if (config.offloads != 0)
+		PTF_ASSERT_AND_RUN_COMMAND(dev->sendPacket(jumboMBuf, 0) == true, dev->close(), "Couldn't send chained mbuf");
+
+	// prepend a header segment to a packet which fits in one mbuf
+	MBufRawPacket mBufRawPacket;
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.initFromRawPacket(&rawPacket, dev) == true, dev->close(), "Cannot initialize MBufRawPacket");
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.getNumOfSegments() == 1, dev->close(), "Packet has %d segments", (int)mBufRawPacket.getNumOfSegments());
+	uint8_t header[50];
+	memset(header, 0xab, sizeof(header));
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.prependHeaderSegment(header, sizeof(header)) == true, dev->close(), "Couldn't prepend header segment");
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.getNumOfSegments() == 2, dev->close(), "Packet has %d segments after prepending header", (int)mBufRawPacket.getNumOfSegments());
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.getRawDataLen() == (int)sizeof(header), dev->close(), "Raw data doesn't cover only the header segment");
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.getPacketLength() == sizeof(header) + rawPacket.getRawDataLen(), dev->close(), "Wrong packet length after prepending header");
+
+	// the header segment has room for the whole packet so the segments are merged
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.linearize() == true, dev->close(), "Couldn't linearize packet");
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.isLinearizedCopy() == false, dev->close(), "Packet was copied instead of merged");
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket.getNumOfSegments() == 1, dev->close(), "Packet has %d segments after linearize", (int)mBufRawPacket.getNumOfSegments());
+	PTF_ASSERT_AND_RUN_COMMAND(memcmp(mBufRawPacket.getRawData(), header, sizeof(header)) == 0, dev->close(), "Header data is different");
+	PTF_ASSERT_AND_RUN_COMMAND(memcmp(mBufRawPacket.getRawData() + sizeof(header), rawPacket.getRawData(), rawPacket.getRawDataLen()) == 0, dev->close(), "Packet data is different");
+
+	dev->close();
+
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
+PTF_TEST_CASE(TestDpdkDeviceRxBurstStats)
+{
+#ifdef USE_DPDK
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+
+	PTF_ASSERT(dev->openMultiQueues(1, 1) == true, "Cannot open DPDK device");
+
+	std::map<std::string, uint64_t> xstats;
+	PTF_ASSERT_AND_RUN_COMMAND(dev->getExtendedStatistics(xstats) == true, dev->close(), "Cannot get extended statistics");
+	PTF_PRINT_VERBOSE("Device has %d extended statistics", (int)xstats.size());
+	dev->clearExtendedStatistics();
+
+	PTF_ASSERT_AND_RUN_COMMAND(dev->isRxBurstStatsEnabled() == false, dev->close(), "Burst statistics are enabled by default");
+	PTF_ASSERT_AND_RUN_COMMAND(dev->setRxBurstStatsEnabled(true) == true, dev->close(), "Cannot enable burst statistics");
+	dev->clearRxBurstStats();
+
+	const int numOfPolls = 20;
+	MBufRawPacketVector rawPacketVec;
+	int numOfPackets = 0;
+	for (int i = 0; i < numOfPolls; i++)
+		numOfPackets += dev->receivePackets(rawPacketVec, 0);
+
+	DpdkDevice::RxBurstStats burstStats;
+	PTF_ASSERT_AND_RUN_COMMAND(dev->getRxBurstStats(0, burstStats) == true, dev->close(), "Cannot get burst statistics");
+	PTF_ASSERT_AND_RUN_COMMAND(burstStats.polls == (uint64_t)numOfPolls, dev->close(), "Expected %d polls, got %d", numOfPolls, (int)burstStats.polls);
+	PTF_ASSERT_AND_RUN_COMMAND(burstStats.packets >= (uint64_t)numOfPackets, dev->close(), "Expected at least %d packets, got %d", numOfPackets, (int)burstStats.packets);
+	PTF_ASSERT_AND_RUN_COMMAND(burstStats.emptyPolls == burstStats.burstSizeHistogram[0], dev->close(), "Empty polls differ from the first histogram bucket");
+	PTF_ASSERT_AND_RUN_COMMAND(burstStats.emptyPollRatio >= 0 && burstStats.emptyPollRatio <= 1, dev->close(), "Empty poll ratio %f is invalid", burstStats.emptyPollRatio);
+	PTF_ASSERT_AND_RUN_COMMAND(burstStats.tscHz > 0, dev->close(), "TSC frequency is 0");
+	uint64_t histogramPolls = 0;
+	for (int i = 0; i < PCPP_DPDK_BURST_SIZE_HISTOGRAM_BUCKETS; i++)
+		histogramPolls += burstStats.burstSizeHistogram[i];
+	PTF_ASSERT_AND_RUN_COMMAND(histogramPolls == burstStats.polls, dev->close(), "Burst size histogram has %d polls, expected %d", (int)histogramPolls, (int)burstStats.polls);
+	uint64_t histogramBursts = 0;
+	for (int i = 0; i < PCPP_DPDK_BURST_CYCLES_HISTOGRAM_BUCKETS; i++)
+		histogramBursts += burstStats.burstCyclesHistogram[i];
+	PTF_ASSERT_AND_RUN_COMMAND(histogramBursts == burstStats.measuredBursts, dev->close(), "Burst cycles histogram has %d bursts, expected %d", (int)histogramBursts, (int)burstStats.measuredBursts);
+	PTF_ASSERT_AND_RUN_COMMAND(dev->getRxBurstStats(DPDK_MAX_RX_QUEUES, burstStats) == false, dev->close(), "Got burst statistics of a queue out of range");
+
+	// polls aren't counted while burst statistics are disabled
+	PTF_ASSERT_AND_RUN_COMMAND(dev->setRxBurstStatsEnabled(false) == true, dev->close(), "Cannot disable burst statistics");
+	dev->receivePackets(rawPacketVec, 0);
+	PTF_ASSERT_AND_RUN_COMMAND(dev->getRxBurstStats(0, burstStats) == true, dev->close(), "Cannot get burst statistics");
+	PTF_ASSERT_AND_RUN_COMMAND(burstStats.polls == (uint64_t)numOfPolls, dev->close(), "Poll was counted while burst statistics are disabled");
+
+	dev->clearRxBurstStats();
+	PTF_ASSERT_AND_RUN_COMMAND(dev->getRxBurstStats(0, burstStats) == true, dev->close(), "Cannot get burst statistics");
+	PTF_ASSERT_AND_RUN_COMMAND(burstStats.polls == 0 && burstStats.packets == 0, dev->close(), "Burst statistics weren't cleared");
+
+	dev->close();
+
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
+PTF_TEST_CASE(TestDpdkAdaptivePolling)
+{
+#ifdef USE_DPDK
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+
+	PTF_ASSERT(dev->openMultiQueues(1, 1) == true, "Cannot open DPDK device");
+
+	// the poller escalates by the number of consecutive empty polls, the device isn't polled so no packets arrive
+	DpdkAdaptivePollingConfig config(4, 8, 0, 0, 0);
+	DpdkAdaptivePoller poller(dev, 0, config);
+	for (int i = 0; i < 3; i++)
+		poller.onPoll(0);
+	PTF_ASSERT_AND_RUN_COMMAND(poller.getIdleState() == DpdkIdleStateBusy, dev->close(), "Poller left busy polling before the threshold");
+	poller.onPoll(0);
+	PTF_ASSERT_AND_RUN_COMMAND(poller.getIdleState() == DpdkIdleStatePause, dev->close(), "Poller didn't pause after the threshold");
+	poller.onPoll(10);
+	PTF_ASSERT_AND_RUN_COMMAND(poller.getIdleState() == DpdkIdleStateBusy, dev->close(), "Poller didn't return to busy polling when traffic arrived");
+
+	DpdkAdaptivePollingStats pollingStats;
+	poller.getStats(pollingStats);
+	PTF_ASSERT_AND_RUN_COMMAND(pollingStats.polls == 5, dev->close(), "Expected 5 polls, got %d", (int)pollingStats.polls);
+	PTF_ASSERT_AND_RUN_COMMAND(pollingStats.emptyPolls == 4, dev->close(), "Expected 4 empty polls, got %d", (int)pollingStats.emptyPolls);
+	PTF_ASSERT_AND_RUN_COMMAND(pollingStats.pauses == 1, dev->close(), "Expected 1 pause, got %d", (int)pollingStats.pauses);
+	PTF_ASSERT_AND_RUN_COMMAND(pollingStats.busyReturns == 1, dev->close(), "Expected 1 return to busy polling, got %d", (int)pollingStats.busyReturns);
+	poller.clearStats();
+	poller.getStats(pollingStats);
+	PTF_ASSERT_AND_RUN_COMMAND(pollingStats.polls == 0 && pollingStats.idleState == DpdkIdleStateBusy, dev->close(), "Poller statistics weren't cleared");
+
+	// the device was opened without RX interrupts, so the interrupt step falls back to pausing
+	DpdkAdaptivePoller interruptPoller(dev, 0, DpdkAdaptivePollingConfig(1, 8, 0, 0, 1));
+	interruptPoller.onPoll(0);
+	interruptPoller.getStats(pollingStats);
+	PTF_ASSERT_AND_RUN_COMMAND(pollingStats.idleState == DpdkIdleStatePause, dev->close(), "Poller didn't fall back to pausing");
+	PTF_ASSERT_AND_RUN_COMMAND(pollingStats.interruptWaits == 0, dev->close(), "Poller slept on interrupts which aren't enabled");
+
+	// capture threads with adaptive polling
+	PTF_ASSERT_AND_RUN_COMMAND(dev->getCaptureAdaptivePollingStats(0, pollingStats) == false, dev->close(), "Got adaptive polling stats before capturing");
+	PTF_ASSERT_AND_RUN_COMMAND(dev->setCaptureAdaptivePolling(true) == true, dev->close(), "Cannot enable adaptive polling of capture threads");
+	DpdkPacketData packetData;
+	PTF_ASSERT_AND_RUN_COMMAND(dev->startCaptureSingleThread(dpdkPacketsArrive, &packetData), dev->close(), "Could not start capturing on DpdkDevice");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(dev->setCaptureAdaptivePolling(false) == false, dev->stopCapture(); dev->close(), "Changed adaptive polling while capturing");
+	LoggerPP::getInstance().enableErrors();
+	PCAP_SLEEP(2);
+	dev->stopCapture();
+	PTF_ASSERT_AND_RUN_COMMAND(dev->getCaptureAdaptivePollingStats(0, pollingStats) == true, dev->close(), "Cannot get adaptive polling stats of capture thread");
+	PTF_ASSERT_AND_RUN_COMMAND(pollingStats.polls > 0, dev->close(), "Capture thread poller wasn't called");
+	PTF_PRINT_VERBOSE("Capture thread: %d polls, %d empty, %d pauses, %d monitor waits, %d interrupt waits, idle state %d", (int)pollingStats.polls,
+			(int)pollingStats.emptyPolls, (int)pollingStats.pauses, (int)pollingStats.monitorWaits, (int)pollingStats.interruptWaits, (int)pollingStats.idleState);
+	PTF_ASSERT_AND_RUN_COMMAND(dev->setCaptureAdaptivePolling(false) == true, dev->close(), "Cannot disable adaptive polling of capture threads");
+
+	dev->close();
+
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
+#ifdef USE_DPDK
+bool countForwardedPacket(MBufRawPacket& packet, void* userCookie)
+{
+	int* packetCount = (int*)userCookie;
+	(*packetCount)++;
+	return packet.getRawDataLen() > 0;
+}
+#endif
+
+PTF_TEST_CASE(TestDpdkForwarder)
+{
+#ifdef USE_DPDK
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+
+	// packets are received on the device and sent back on it with the MAC addresses swapped
+	DpdkForwarder forwarder(dev, 0, dev, 0);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT(forwarder.forwardBurst() == 0, "Forwarded packets from a device which isn't opened");
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT(dev->openMultiQueues(1, 1) == true, "Cannot open DPDK device");
+
+	DpdkForwarder badQueueForwarder(dev, 0, dev, 1);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(badQueueForwarder.forwardBurst() == 0, dev->close(), "Forwarded packets to a TX queue which isn't opened");
+	LoggerPP::getInstance().enableErrors();
+
+	forwarder.setRewrite(DpdkForwardRewriteSwapMac | DpdkForwardRewritePopVlan);
+	PTF_ASSERT_AND_RUN_COMMAND(forwarder.getRewrite() == (DpdkForwardRewriteSwapMac | DpdkForwardRewritePopVlan), dev->close(), "Wrong rewrite flags");
+	int callbackPacketCount = 0;
+	forwarder.setForwardCallback(countForwardedPacket, &callbackPacketCount);
+
+	uint64_t numOfPacketsReceived = 0;
+	for (int i = 0; i < 3; i++)
 	{
-		PTF_PRINT_VERBOSE("Packets captured on RX queue #%d according to stats: %lu", i, stats.rxStats[i].packets);
-		PTF_PRINT_VERBOSE("Bytes captured on RX queue #%d according to stats: %lu", i, stats.rxStats[i].bytes);
-
-	}
-	PTF_ASSERT_AND_RUN_COMMAND(packetData.PacketCount > 0, dev->close(), "No packets were captured");
-	PTF_ASSERT_AND_RUN_COMMAND(packetData.ThreadId != -1, dev->close(), "Couldn't retrieve thread ID");
+		PCAP_SLEEP(1);
+		numOfPacketsReceived += forwarder.forwardBurst();
+	}
+
+	DpdkForwarderStats forwarderStats;
+	forwarder.getStats(forwarderStats);
+	PTF_PRINT_VERBOSE("Forwarder: %d received, %d sent, %d dropped on TX", (int)forwarderStats.rxPackets, (int)forwarderStats.txPackets,
+			(int)forwarderStats.txDrops);
+	PTF_ASSERT_AND_RUN_COMMAND(forwarderStats.rxPackets == numOfPacketsReceived, dev->close(), "Received packet count doesn't match the returned counts");
+	PTF_ASSERT_AND_RUN_COMMAND(forwarderStats.rewriteDrops == 0, dev->close(), "Packets dropped by the rewrites");
+	PTF_ASSERT_AND_RUN_COMMAND((uint64_t)callbackPacketCount == forwarderStats.rxPackets, dev->close(), "Callback wasn't called for every packet");
+	PTF_ASSERT_AND_RUN_COMMAND(forwarderStats.rxPackets == forwarderStats.txPackets + forwarderStats.txDrops + forwarderStats.callbackDrops,
+			dev->close(), "Forwarded packets aren't accounted for");
+	forwarder.clearStats();
+	forwarder.getStats(forwarderStats);
+	PTF_ASSERT_AND_RUN_COMMAND(forwarderStats.rxPackets == 0 && forwarderStats.txPackets == 0, dev->close(), "Forwarder statistics weren't cleared");
+
+	// the RX queue can't be forwarded from while the device captures from it
+	DpdkPacketData packetData;
+	PTF_ASSERT_AND_RUN_COMMAND(dev->startCaptureSingleThread(dpdkPacketsArrive, &packetData), dev->close(), "Could not start capturing on DpdkDevice");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(forwarder.forwardBurst() == 0, dev->stopCapture(); dev->close(), "Forwarded packets while capturing");
+	LoggerPP::getInstance().enableErrors();
+	dev->stopCapture();
 
-	int statsVsPacketCount = stats.aggregatedRxStats.packets > (uint64_t)packetData.PacketCount ? stats.aggregatedRxStats.packets-(uint64_t)packetData.PacketCount : (uint64_t)packetData.PacketCount-stats.aggregatedRxStats.packets;
-	PTF_ASSERT_AND_RUN_COMMAND(statsVsPacketCount <= 20, dev->close(),
-			"Stats received packet count (%lu) is different than calculated packet count (%d)",
-			stats.aggregatedRxStats.packets,
-			packetData.PacketCount);
-	dev->close();
 	dev->close();
 
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
+PTF_TEST_CASE(TestDpdkMBufPools)
+{
+#ifdef USE_DPDK
+	DpdkDeviceList& devList = DpdkDeviceList::getInstance();
+	DpdkDevice* dev = devList.getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
 
+	// DPDK was initialized by the previous tests with the default pool configuration
+	const DpdkMBufPoolConfig& poolConfig = DpdkDeviceList::getMBufPoolConfig();
+	PTF_ASSERT(poolConfig.poolSize == 16383, "Wrong pool size in pool config: %d", (int)poolConfig.poolSize);
+	PTF_ASSERT(poolConfig.sharedPool == false, "Pools are shared by default");
+
+	DpdkMBufPoolInfo poolInfo;
+	dev->getMBufPoolInfo(poolInfo);
+	PTF_ASSERT(poolInfo.size == 16383, "Wrong pool size: %d", (int)poolInfo.size);
+	PTF_ASSERT(poolInfo.cacheSize == poolConfig.cacheSize, "Wrong pool cache size: %d", (int)poolInfo.cacheSize);
+	PTF_ASSERT(poolInfo.dataRoomSize > 0, "Pool data room is 0");
+	PTF_ASSERT(poolInfo.numOfDevices == 1, "Pool which isn't shared has %d devices", (int)poolInfo.numOfDevices);
+	PTF_ASSERT(dev->isMBufPoolShared() == false, "Device pool is shared");
+	PTF_ASSERT(poolInfo.freeMbufs + poolInfo.mbufsInUse == poolInfo.size, "Free and used mbufs don't add up to the pool size");
+	PTF_ASSERT(poolInfo.cachedMbufs <= poolInfo.freeMbufs, "More cached mbufs than free mbufs");
+
+	// an mbuf taken from the pool is counted as used
+	uint32_t mbufsInUse = poolInfo.mbufsInUse;
+	MBufRawPacket* mBufRawPacket = new MBufRawPacket();
+	PTF_ASSERT(mBufRawPacket->init(dev) == true, "Couldn't init MBufRawPacket");
+	dev->getMBufPoolInfo(poolInfo);
+	PTF_ASSERT_AND_RUN_COMMAND(poolInfo.mbufsInUse == mbufsInUse + 1, delete mBufRawPacket, "mbuf in use wasn't counted");
+	delete mBufRawPacket;
+	dev->getMBufPoolInfo(poolInfo);
+	PTF_ASSERT(poolInfo.mbufsInUse == mbufsInUse, "Freed mbuf is still counted as used");
+
+	// each device has its own pool
+	std::vector<DpdkMBufPoolInfo> poolsInfo;
+	devList.getMBufPoolsInfo(poolsInfo);
+	PTF_ASSERT(poolsInfo.size() == devList.getDpdkDeviceList().size(), "Expected a pool per device, got %d pools for %d devices",
+			(int)poolsInfo.size(), (int)devList.getDpdkDeviceList().size());
+	for (std::vector<DpdkMBufPoolInfo>::iterator iter = poolsInfo.begin(); iter != poolsInfo.end(); iter++)
+	{
+		PTF_PRINT_VERBOSE("Pool '%s': socket %d, size %d, cache %d, data room %d, %d free, %d in use, %d cached", iter->name.c_str(),
+				iter->socketId, (int)iter->size, (int)iter->cacheSize, (int)iter->dataRoomSize, (int)iter->freeMbufs, (int)iter->mbufsInUse,
+				(int)iter->cachedMbufs);
+		PTF_ASSERT(iter->numOfDevices == 1, "Pool '%s' has %d devices", iter->name.c_str(), (int)iter->numOfDevices);
+	}
 
 #else
 	PTF_SKIP_TEST("DPDK not configured");
@@ -3802,6 +7961,131 @@ PTF_TEST_CASE(TestDpdkDeviceWorkerThreads)
 
 
 
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
+PTF_TEST_CASE(TestDpdkPipeline)
+{
+#ifdef USE_DPDK
+	LoggerPP::getInstance().supressErrors();
+	DpdkDeviceList& devList = DpdkDeviceList::getInstance();
+	LoggerPP::getInstance().enableErrors();
+
+	if(devList.getDpdkDeviceList().size() == 0)
+	{
+		CoreMask coreMask = 0;
+		for (int i = 0; i < getNumOfCores(); i++)
+			coreMask |= SystemCores::IdToSystemCore[i].Mask;
+
+		PTF_ASSERT(DpdkDeviceList::initDpdk(coreMask, 16383) == true, "Couldn't initialize DPDK with core mask %X", coreMask);
+		PTF_ASSERT(devList.getDpdkDeviceList().size() > 0, "No DPDK devices");
+	}
+	PTF_ASSERT(devList.getDpdkDeviceList().size() > 0, "No DPDK devices");
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+	PTF_ASSERT(dev->open() == true, "Cannot open DPDK device");
+
+	// ring sanity
+	DpdkPipeline pipeline;
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(pipeline.createRing("pcpp_test_ring_empty", 0) == NULL, dev->close(), "Created a ring of size 0");
+	LoggerPP::getInstance().enableErrors();
+	DpdkPacketRing* testRing = pipeline.createRing("pcpp_test_ring", 4);
+	PTF_ASSERT_AND_RUN_COMMAND(testRing != NULL, dev->close(), "Couldn't create ring");
+	PTF_ASSERT_AND_RUN_COMMAND(testRing->getCapacity() >= 4, dev->close(), "Ring capacity %d is smaller than requested", (int)testRing->getCapacity());
+
+	PcapFileReaderDevice reader(EXAMPLE2_PCAP_PATH);
+	PTF_ASSERT_AND_RUN_COMMAND(reader.open() == true, dev->close(), "Cannot open file '%s'", EXAMPLE2_PCAP_PATH);
+	uint32_t numOfTestPackets = testRing->getCapacity() + 2;
+	MBufRawPacket* testPackets[16] = {};
+	RawPacket rawPacket;
+	for (uint32_t i = 0; i < numOfTestPackets; i++)
+	{
+		PTF_ASSERT_AND_RUN_COMMAND(reader.getNextPacket(rawPacket) == true, dev->close(), "Cannot read packet #%d from file", (int)i);
+		testPackets[i] = new MBufRawPacket();
+		PTF_ASSERT_AND_RUN_COMMAND(testPackets[i]->initFromRawPacket(&rawPacket, dev) == true, dev->close(), "Cannot initialize MBufRawPacket #%d", (int)i);
+	}
+	reader.close();
+
+	uint32_t numOfEnqueued = testRing->enqueueBurst(testPackets, numOfTestPackets);
+	PTF_ASSERT_AND_RUN_COMMAND(numOfEnqueued == testRing->getCapacity(), dev->close(), "Enqueued %d packets to a ring of capacity %d", (int)numOfEnqueued, (int)testRing->getCapacity());
+	PTF_ASSERT_AND_RUN_COMMAND(testRing->getFreeCount() == 0, dev->close(), "Full ring has free space");
+	PTF_ASSERT_AND_RUN_COMMAND(testPackets[0]->getMBuf() == NULL, dev->close(), "Enqueued packet is still attached to its mbuf");
+	PTF_ASSERT_AND_RUN_COMMAND(testPackets[numOfEnqueued]->getMBuf() != NULL, dev->close(), "Packet which wasn't enqueued was detached from its mbuf");
+
+	MBufRawPacket* dequeuedPackets[16] = {};
+	uint32_t numOfDequeued = testRing->dequeueBurst(dequeuedPackets, 16);
+	PTF_ASSERT_AND_RUN_COMMAND(numOfDequeued == numOfEnqueued, dev->close(), "Dequeued %d packets out of %d", (int)numOfDequeued, (int)numOfEnqueued);
+	PTF_ASSERT_AND_RUN_COMMAND(testRing->getCount() == 0, dev->close(), "Ring isn't empty");
+	PTF_ASSERT_AND_RUN_COMMAND(dequeuedPackets[0]->getRawDataLen() > 0, dev->close(), "Dequeued packet is empty");
+	for (int i = 0; i < 16; i++)
+	{
+		delete testPackets[i];
+		delete dequeuedPackets[i];
+	}
+
+	// RX -> classify -> count pipeline
+	int numOfWorkerCores = 0;
+	for (int i = 0; i < getNumOfCores(); i++)
+	{
+		if (!(SystemCores::IdToSystemCore[i] == devList.getDpdkMasterCore()))
+			numOfWorkerCores++;
+	}
+
+	if (numOfWorkerCores < 3)
+	{
+		dev->close();
+		PTF_SKIP_TEST("Not enough cores for a pipeline of 3 stages");
+	}
+
+	DpdkPacketRing* classifyRing = pipeline.createRing("pcpp_test_classify_ring", 1024);
+	DpdkPacketRing* countRing = pipeline.createRing("pcpp_test_count_ring", 1024);
+	PTF_ASSERT_AND_RUN_COMMAND(classifyRing != NULL && countRing != NULL, dev->close(), "Couldn't create rings");
+
+	DpdkTestPipelineStage rxStage("rx", UnknownProtocol);
+	DpdkTestPipelineStage classifyStage("classify", UDP);
+	DpdkTestPipelineStage countStage("count", UnknownProtocol);
+	PTF_ASSERT_AND_RUN_COMMAND(rxStage.setInput(dev, 0) == true, dev->close(), "Couldn't set RX stage input");
+	rxStage.setOutputIndex(rxStage.addOutput(classifyRing));
+	PTF_ASSERT_AND_RUN_COMMAND(classifyStage.setInput(classifyRing) == true, dev->close(), "Couldn't set classify stage input");
+	classifyStage.setOutputIndex(classifyStage.addOutput(countRing, DpdkPipelineStage::BackPressureDrop));
+	PTF_ASSERT_AND_RUN_COMMAND(countStage.setInput(countRing) == true, dev->close(), "Couldn't set count stage input");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(countStage.addOutput((DpdkPacketRing*)NULL) == -1, dev->close(), "Added a NULL output");
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT_AND_RUN_COMMAND(pipeline.addStage(&rxStage) == true, dev->close(), "Couldn't add RX stage");
+	PTF_ASSERT_AND_RUN_COMMAND(pipeline.addStage(&classifyStage) == true, dev->close(), "Couldn't add classify stage");
+	PTF_ASSERT_AND_RUN_COMMAND(pipeline.addStage(&countStage) == true, dev->close(), "Couldn't add count stage");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(pipeline.addStage(&countStage) == false, dev->close(), "Added the same stage twice");
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT_AND_RUN_COMMAND(pipeline.start(dev) == true, dev->close(), "Couldn't start the pipeline");
+	PTF_ASSERT_AND_RUN_COMMAND(pipeline.isRunning() == true, dev->close(), "Pipeline isn't running");
+	PCAP_SLEEP(10);
+	pipeline.stop();
+	PTF_ASSERT_AND_RUN_COMMAND(pipeline.isRunning() == false, dev->close(), "Pipeline is still running");
+
+	DpdkPipelineStage::DpdkPipelineStageStats rxStats, classifyStats, countStats;
+	rxStage.getStats(rxStats);
+	classifyStage.getStats(classifyStats);
+	countStage.getStats(countStats);
+	PTF_PRINT_VERBOSE("RX stage: in %d, forwarded %d, output drops %d, back-pressure waits %d", (int)rxStats.packetsIn, (int)rxStats.packetsForwarded, (int)rxStats.outputDrops, (int)rxStats.backPressureWaits);
+	PTF_PRINT_VERBOSE("Classify stage: in %d, forwarded %d, dropped %d, output drops %d", (int)classifyStats.packetsIn, (int)classifyStats.packetsForwarded, (int)classifyStats.packetsDropped, (int)classifyStats.outputDrops);
+	PTF_PRINT_VERBOSE("Count stage: in %d, dropped %d", (int)countStats.packetsIn, (int)countStats.packetsDropped);
+
+	PTF_ASSERT_AND_RUN_COMMAND(rxStats.packetsIn > 0, dev->close(), "No packets were received by the pipeline");
+	PTF_ASSERT_AND_RUN_COMMAND(rxStats.packetsIn == rxStats.packetsForwarded + rxStats.outputDrops, dev->close(), "RX stage lost packets");
+	PTF_ASSERT_AND_RUN_COMMAND(classifyStats.packetsIn == classifyStats.packetsForwarded + classifyStats.packetsDropped + classifyStats.outputDrops, dev->close(), "Classify stage lost packets");
+	PTF_ASSERT_AND_RUN_COMMAND(classifyStats.packetsForwarded == (uint64_t)classifyStage.getPacketCount() - classifyStats.outputDrops, dev->close(), "Classify stage forwarded non-UDP packets");
+	PTF_ASSERT_AND_RUN_COMMAND(countStats.packetsIn + countRing->getCount() == classifyStats.packetsForwarded, dev->close(), "Count stage didn't get all UDP packets");
+	PTF_ASSERT_AND_RUN_COMMAND(countStats.packetsDropped == countStats.packetsIn, dev->close(), "Stage without outputs forwarded packets");
+
+	dev->close();
+
 #else
 	PTF_SKIP_TEST("DPDK not configured");
 #endif
@@ -4150,6 +8434,52 @@ PTF_TEST_CASE(TestKniDeviceSendReceive)
 				PTF_PRINT_VERBOSE("KNI have captured %u packets (blocking mode) on device " KNI_TEST_NAME, counter, KNI::DEVICE1);
 			} break;
 		}
+
+		// Polling
+		counter = 0;
+		PTF_ASSERT(device->startCapture(KniRequestsCallbacksMock::onPacketsCallback, &counter),
+			"KNI failed to start capturing thread on device " KNI_TEST_NAME, KNI::DEVICE1);
+		LoggerPP::getInstance().supressErrors();
+		PTF_ASSERT(device->pollPackets(KniRequestsCallbacksMock::onPacketsCallback, &counter) == 0,
+			"Managed to poll packets on KNI device while capturing");
+		LoggerPP::getInstance().enableErrors();
+		device->stopCapture();
+		LoggerPP::getInstance().supressErrors();
+		PTF_ASSERT(device->pollPackets(NULL, NULL) == 0, "Managed to poll packets on KNI device with NULL callback");
+		LoggerPP::getInstance().enableErrors();
+		// the file was read to its end, so the last packet read is sent again
+		for (int i = 0; i < 10; ++i)
+		{
+			RawPacket* newRawPacket = new RawPacket(rawPacket);
+			rawPacketVec.pushBack(newRawPacket);
+		}
+		LoggerPP::getInstance().supressErrors();
+		rsdevice.sendPackets(rawPacketVec);
+		LoggerPP::getInstance().enableErrors();
+		rawPacketVec.clear();
+		uint32_t polled = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			PCAP_SLEEP(1); // Give some time to receive packets
+			polled += device->pollPackets(KniRequestsCallbacksMock::onPacketsCallback, &counter);
+		}
+		PTF_ASSERT(polled == counter, "KNI polled %u packets but callback counted %u", polled, counter);
+		PTF_PRINT_VERBOSE("KNI have polled %u packets on device " KNI_TEST_NAME, counter, KNI::DEVICE1);
+		counter = 0;
+	}
+
+	{ // Request handler thread of the device list
+		PTF_ASSERT(!kniDeviceList.isRequestHandlerThreadRunning(), "KNI device list request thread is running before start");
+		PTF_ASSERT(kniDeviceList.startRequestHandlerThread(0, 100000000, 0),
+			"KNI device list can't start request handler thread");
+		LoggerPP::getInstance().supressErrors();
+		PTF_ASSERT(!kniDeviceList.startRequestHandlerThread(0, 100000000),
+			"Managed to start second request handler thread on KNI device list");
+		LoggerPP::getInstance().enableErrors();
+		PTF_ASSERT(kniDeviceList.isRequestHandlerThreadRunning(), "KNI device list request thread isn't running");
+		PCAP_SLEEP(1);
+		kniDeviceList.stopRequestHandlerThread();
+		PTF_ASSERT(!kniDeviceList.isRequestHandlerThreadRunning(), "KNI device list request thread is running after stop");
 	}
 
 	LoggerPP::getInstance().supressErrors();
@@ -4662,7 +8992,7 @@ RawPacket tcpReassemblyAddRetransmissions(RawPacket rawPacket, int beginning, in
 	return *(packet.getRawPacket());
 }
 
-bool tcpReassemblyTest(std::vector<RawPacket>& packetStream, TcpReassemblyMultipleConnStats& results, bool monitorOpenCloseConns, bool closeConnsManually)
+bool tcpReassemblyTest(std::vector<RawPacket>& packetStream, TcpReassemblyMultipleConnStats& results, bool monitorOpenCloseConns, bool closeConnsManually, bool useRawPackets = false)
 {
 	TcpReassembly* tcpReassembly = NULL;
 
@@ -4671,10 +9001,17 @@ bool tcpReassemblyTest(std::vector<RawPacket>& packetStream, TcpReassemblyMultip
 	else
 		tcpReassembly = new TcpReassembly(tcpReassemblyMsgReadyCallback, &results);
 
-	for (std::vector<RawPacket>::iterator iter = packetStream.begin(); iter != packetStream.end(); iter++)
+	if (useRawPackets)
 	{
-		Packet packet(&(*iter));
-		tcpReassembly->reassemblePacket(packet);
+		tcpReassembly->reassemblePackets(&packetStream[0], packetStream.size());
+	}
+	else
+	{
+		for (std::vector<RawPacket>::iterator iter = packetStream.begin(); iter != packetStream.end(); iter++)
+		{
+			Packet packet(&(*iter));
+			tcpReassembly->reassemblePacket(packet);
+		}
 	}
 
 	//for(TcpReassemblyMultipleConnStats::Stats::iterator iter = results.stats.begin(); iter != results.stats.end(); iter++)
@@ -4716,12 +9053,12 @@ PTF_TEST_CASE(TestTcpReassemblySanity)
 	PTF_ASSERT(stats.begin()->second.connectionsStarted == true, "Connections wasn't opened");
 	PTF_ASSERT(stats.begin()->second.connectionsEnded == false, "Connection was ended with FIN or RST");
 	PTF_ASSERT(stats.begin()->second.connectionsEndedManually == true, "Connection wasn't ended manually");
-	PTF_ASSERT(stats.begin()->second.connData.srcIP != NULL, "Source IP is NULL");
-	PTF_ASSERT(stats.begin()->second.connData.dstIP != NULL, "Source IP is NULL");
+	PTF_ASSERT(stats.begin()->second.connData.srcIP.isValid(), "Source IP is invalid");
+	PTF_ASSERT(stats.begin()->second.connData.dstIP.isValid(), "Source IP is invalid");
 	IPv4Address expectedSrcIP(std::string("10.0.0.1"));
 	IPv4Address expectedDstIP(std::string("81.218.72.15"));
-	PTF_ASSERT(stats.begin()->second.connData.srcIP->equals(&expectedSrcIP), "Source IP isn't 10.0.0.1");
-	PTF_ASSERT(stats.begin()->second.connData.dstIP->equals(&expectedDstIP), "Source IP isn't 81.218.72.15");
+	PTF_ASSERT(stats.begin()->second.connData.srcIP == IPAddressValue(expectedSrcIP), "Source IP isn't 10.0.0.1");
+	PTF_ASSERT(stats.begin()->second.connData.dstIP == IPAddressValue(expectedDstIP), "Source IP isn't 81.218.72.15");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_sec == 1491516383, "Bad start time seconds, expected 1491516383");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_usec == 915793, "Bad start time microseconds, expected 915793");
 	PTF_ASSERT(stats.begin()->second.connData.endTime.tv_sec == 0, "Bad end time seconds, expected 0");
@@ -5155,12 +9492,12 @@ PTF_TEST_CASE(TestTcpReassemblyIPv6)
 	PTF_ASSERT(stats.begin()->second.connectionsStarted == true, "Connections wasn't opened");
 	PTF_ASSERT(stats.begin()->second.connectionsEnded == false, "Connection was ended with FIN or RST");
 	PTF_ASSERT(stats.begin()->second.connectionsEndedManually == true, "Connection wasn't ended manually");
-	PTF_ASSERT(stats.begin()->second.connData.srcIP != NULL, "Source IP is NULL");
-	PTF_ASSERT(stats.begin()->second.connData.dstIP != NULL, "Source IP is NULL");
+	PTF_ASSERT(stats.begin()->second.connData.srcIP.isValid(), "Source IP is invalid");
+	PTF_ASSERT(stats.begin()->second.connData.dstIP.isValid(), "Source IP is invalid");
 	IPv6Address expectedSrcIP(std::string("2001:618:400::5199:cc70"));
 	IPv6Address expectedDstIP(std::string("2001:618:1:8000::5"));
-	PTF_ASSERT(stats.begin()->second.connData.srcIP->equals(&expectedSrcIP), "Source IP isn't 2001:618:400::5199:cc70");
-	PTF_ASSERT(stats.begin()->second.connData.dstIP->equals(&expectedDstIP), "Source IP isn't 2001:618:1:8000::5");
+	PTF_ASSERT(stats.begin()->second.connData.srcIP == IPAddressValue(expectedSrcIP), "Source IP isn't 2001:618:400::5199:cc70");
+	PTF_ASSERT(stats.begin()->second.connData.dstIP == IPAddressValue(expectedDstIP), "Source IP isn't 2001:618:1:8000::5");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_sec == 1147551796, "Bad start time seconds, expected 1147551796");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_usec == 702602, "Bad start time microseconds, expected 702602");
 	PTF_ASSERT(stats.begin()->second.connData.endTime.tv_sec == 0, "Bad end time seconds, expected 0");
@@ -5199,10 +9536,10 @@ PTF_TEST_CASE(TestTcpReassemblyIPv6MultConns)
 	PTF_ASSERT(iter->second.connectionsStarted == true, "Conn #1: Connection wasn't opened");
 	PTF_ASSERT(iter->second.connectionsEnded == false, "Conn #1: Connection ended with FIN or RST");
 	PTF_ASSERT(iter->second.connectionsEndedManually == true, "Conn #1: Connections wasn't ended manually");
-	PTF_ASSERT(iter->second.connData.srcIP != NULL, "Conn #1: Source IP is NULL");
-	PTF_ASSERT(iter->second.connData.dstIP != NULL, "Conn #1: Source IP is NULL");
-	PTF_ASSERT(iter->second.connData.srcIP->equals(&expectedSrcIP), "Conn #1: Source IP isn't 2001:618:400::5199:cc70");
-	PTF_ASSERT(iter->second.connData.dstIP->equals(&expectedDstIP1), "Conn #1: Source IP isn't 2001:618:1:8000::5");
+	PTF_ASSERT(iter->second.connData.srcIP.isValid(), "Conn #1: Source IP is invalid");
+	PTF_ASSERT(iter->second.connData.dstIP.isValid(), "Conn #1: Source IP is invalid");
+	PTF_ASSERT(iter->second.connData.srcIP == IPAddressValue(expectedSrcIP), "Conn #1: Source IP isn't 2001:618:400::5199:cc70");
+	PTF_ASSERT(iter->second.connData.dstIP == IPAddressValue(expectedDstIP1), "Conn #1: Source IP isn't 2001:618:1:8000::5");
 	PTF_ASSERT(iter->second.connData.srcPort == 35995, "Conn #1: source port isn't 35995");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_sec == 1147551795, "Bad start time seconds, expected 1147551795");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_usec == 526632, "Bad start time microseconds, expected 526632");
@@ -5219,10 +9556,10 @@ PTF_TEST_CASE(TestTcpReassemblyIPv6MultConns)
 	PTF_ASSERT(iter->second.connectionsStarted == true, "Conn #2: Connection wasn't opened");
 	PTF_ASSERT(iter->second.connectionsEnded == false, "Conn #2: Connection ended with FIN or RST");
 	PTF_ASSERT(iter->second.connectionsEndedManually == true, "Conn #2: Connections wasn't ended manually");
-	PTF_ASSERT(iter->second.connData.srcIP != NULL, "Conn #2: Source IP is NULL");
-	PTF_ASSERT(iter->second.connData.dstIP != NULL, "Conn #2: Source IP is NULL");
-	PTF_ASSERT(iter->second.connData.srcIP->equals(&expectedSrcIP), "Conn #2: Source IP isn't 2001:618:400::5199:cc70");
-	PTF_ASSERT(iter->second.connData.dstIP->equals(&expectedDstIP1), "Conn #2: Source IP isn't 2001:618:1:8000::5");
+	PTF_ASSERT(iter->second.connData.srcIP.isValid(), "Conn #2: Source IP is invalid");
+	PTF_ASSERT(iter->second.connData.dstIP.isValid(), "Conn #2: Source IP is invalid");
+	PTF_ASSERT(iter->second.connData.srcIP == IPAddressValue(expectedSrcIP), "Conn #2: Source IP isn't 2001:618:400::5199:cc70");
+	PTF_ASSERT(iter->second.connData.dstIP == IPAddressValue(expectedDstIP1), "Conn #2: Source IP isn't 2001:618:1:8000::5");
 	PTF_ASSERT(iter->second.connData.srcPort == 35999, "Conn #2: source port isn't 35999");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_sec == 1147551795, "Bad start time seconds, expected 1147551795");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_usec == 526632, "Bad start time microseconds, expected 526632");
@@ -5237,10 +9574,10 @@ PTF_TEST_CASE(TestTcpReassemblyIPv6MultConns)
 	PTF_ASSERT(iter->second.connectionsStarted == true, "Conn #3: Connection wasn't opened");
 	PTF_ASSERT(iter->second.connectionsEnded == false, "Conn #3: Connection ended with FIN or RST");
 	PTF_ASSERT(iter->second.connectionsEndedManually == true, "Conn #3: Connections wasn't ended manually");
-	PTF_ASSERT(iter->second.connData.srcIP != NULL, "Conn #3: Source IP is NULL");
-	PTF_ASSERT(iter->second.connData.dstIP != NULL, "Conn #3: Source IP is NULL");
-	PTF_ASSERT(iter->second.connData.srcIP->equals(&expectedSrcIP), "Conn #3: Source IP isn't 2001:618:400::5199:cc70");
-	PTF_ASSERT(iter->second.connData.dstIP->equals(&expectedDstIP2), "Conn #3: Source IP isn't 2001:638:902:1:202:b3ff:feee:5dc2");
+	PTF_ASSERT(iter->second.connData.srcIP.isValid(), "Conn #3: Source IP is invalid");
+	PTF_ASSERT(iter->second.connData.dstIP.isValid(), "Conn #3: Source IP is invalid");
+	PTF_ASSERT(iter->second.connData.srcIP == IPAddressValue(expectedSrcIP), "Conn #3: Source IP isn't 2001:618:400::5199:cc70");
+	PTF_ASSERT(iter->second.connData.dstIP == IPAddressValue(expectedDstIP2), "Conn #3: Source IP isn't 2001:638:902:1:202:b3ff:feee:5dc2");
 	PTF_ASSERT(iter->second.connData.srcPort == 40426, "Conn #3: source port isn't 40426");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_sec == 1147551795, "Bad start time seconds, expected 1147551795");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_usec == 526632, "Bad start time microseconds, expected 526632");
@@ -5257,10 +9594,10 @@ PTF_TEST_CASE(TestTcpReassemblyIPv6MultConns)
 	PTF_ASSERT(iter->second.connectionsStarted == true, "Conn #4: Connection wasn't opened");
 	PTF_ASSERT(iter->second.connectionsEnded == false, "Conn #4: Connection ended with FIN or RST");
 	PTF_ASSERT(iter->second.connectionsEndedManually == true, "Conn #4: Connections wasn't ended manually");
-	PTF_ASSERT(iter->second.connData.srcIP != NULL, "Conn #4: Source IP is NULL");
-	PTF_ASSERT(iter->second.connData.dstIP != NULL, "Conn #4: Source IP is NULL");
-	PTF_ASSERT(iter->second.connData.srcIP->equals(&expectedSrcIP), "Conn #4: Source IP isn't 2001:618:400::5199:cc70");
-	PTF_ASSERT(iter->second.connData.dstIP->equals(&expectedDstIP1), "Conn #4: Source IP isn't 2001:618:1:8000::5");
+	PTF_ASSERT(iter->second.connData.srcIP.isValid(), "Conn #4: Source IP is invalid");
+	PTF_ASSERT(iter->second.connData.dstIP.isValid(), "Conn #4: Source IP is invalid");
+	PTF_ASSERT(iter->second.connData.srcIP == IPAddressValue(expectedSrcIP), "Conn #4: Source IP isn't 2001:618:400::5199:cc70");
+	PTF_ASSERT(iter->second.connData.dstIP == IPAddressValue(expectedDstIP1), "Conn #4: Source IP isn't 2001:618:1:8000::5");
 	PTF_ASSERT(iter->second.connData.srcPort == 35997, "Conn #4: source port isn't 35997");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_sec == 1147551795, "Bad start time seconds, expected 1147551795");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_usec == 526632, "Bad start time microseconds, expected 526632");
@@ -5301,12 +9638,12 @@ PTF_TEST_CASE(TestTcpReassemblyIPv6_OOO)
 	PTF_ASSERT(stats.begin()->second.connectionsStarted == true, "Connections wasn't opened");
 	PTF_ASSERT(stats.begin()->second.connectionsEnded == false, "Connection was ended with FIN or RST");
 	PTF_ASSERT(stats.begin()->second.connectionsEndedManually == true, "Connection wasn't ended manually");
-	PTF_ASSERT(stats.begin()->second.connData.srcIP != NULL, "Source IP is NULL");
-	PTF_ASSERT(stats.begin()->second.connData.dstIP != NULL, "Source IP is NULL");
+	PTF_ASSERT(stats.begin()->second.connData.srcIP.isValid(), "Source IP is invalid");
+	PTF_ASSERT(stats.begin()->second.connData.dstIP.isValid(), "Source IP is invalid");
 	IPv6Address expectedSrcIP(std::string("2001:618:400::5199:cc70"));
 	IPv6Address expectedDstIP(std::string("2001:618:1:8000::5"));
-	PTF_ASSERT(stats.begin()->second.connData.srcIP->equals(&expectedSrcIP), "Source IP isn't 2001:618:400::5199:cc70");
-	PTF_ASSERT(stats.begin()->second.connData.dstIP->equals(&expectedDstIP), "Source IP isn't 2001:618:1:8000::5");
+	PTF_ASSERT(stats.begin()->second.connData.srcIP == IPAddressValue(expectedSrcIP), "Source IP isn't 2001:618:400::5199:cc70");
+	PTF_ASSERT(stats.begin()->second.connData.dstIP == IPAddressValue(expectedDstIP), "Source IP isn't 2001:618:1:8000::5");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_sec == 1147551796, "Bad start time seconds, expected 1147551796");
 	PTF_ASSERT(stats.begin()->second.connData.startTime.tv_usec == 702602, "Bad start time microseconds, expected 702602");
 	PTF_ASSERT(stats.begin()->second.connData.endTime.tv_sec == 0, "Bad end time seconds, expected 0");
@@ -5354,7 +9691,10 @@ PTF_TEST_CASE(TestTcpReassemblyCleanup)
 	PTF_ASSERT_EQUAL(tcpReassembly.isConnectionOpen(iterConn2->second), 0, int);
 	PTF_ASSERT_EQUAL(tcpReassembly.isConnectionOpen(iterConn3->second), 0, int);
 
-	PCAP_SLEEP(2);
+	// the cleanup time is measured by packet timestamps, so move the last packet 2 seconds forward
+	timeval lastPacketTime = lastPacket.getPacketTimeStamp();
+	lastPacketTime.tv_sec += 2;
+	lastPacket.setPacketTimeStamp(lastPacketTime);
 
 	tcpReassembly.reassemblePacket(&lastPacket); // automatic cleanup of 1 item
 	PTF_ASSERT_EQUAL(tcpReassembly.getConnectionInformation().size(), 2, size);
@@ -5378,6 +9718,68 @@ PTF_TEST_CASE(TestTcpReassemblyCleanup)
 }
 
 
+PTF_TEST_CASE(TestTcpReassemblyRawPackets)
+{
+	const char* pcapFiles[] = {
+		"PcapExamples/one_tcp_stream.pcap",
+		"PcapExamples/one_http_stream_fin.pcap",
+		"PcapExamples/one_http_stream_fin2.pcap",
+		"PcapExamples/one_http_stream_rst.pcap",
+		"PcapExamples/three_http_streams.pcap",
+		"PcapExamples/one_ipv6_http_stream.pcap",
+		"PcapExamples/four_ipv6_http_streams.pcap"
+	};
+	const int numOfFiles = sizeof(pcapFiles) / sizeof(pcapFiles[0]);
+
+	// reassembling the raw packets gives the same results as reassembling parsed packets, including the flow keys
+	for (int i = 0; i <= numOfFiles; i++)
+	{
+		std::string errMsg;
+		std::vector<RawPacket> packetStream;
+		const char* fileName = pcapFiles[i < numOfFiles ? i : 2];
+		PTF_ASSERT(tcpReassemblyReadPcapIntoPacketVec(fileName, packetStream, errMsg) == true, "Error reading pcap file: %s", errMsg.c_str());
+		if (i == numOfFiles)
+		{
+			// a packet whose IPv4 total length is larger than the captured data
+			Packet malPacket(&packetStream.at(8));
+			IPv4Layer* ipLayer = malPacket.getLayerOfType<IPv4Layer>();
+			PTF_ASSERT(ipLayer != NULL, "Cannot find the IPv4 layer of the packet");
+			ipLayer->getIPv4Header()->totalLength = htons(ntohs(ipLayer->getIPv4Header()->totalLength) + 40);
+		}
+
+		TcpReassemblyMultipleConnStats parsedResults;
+		TcpReassemblyMultipleConnStats rawResults;
+		tcpReassemblyTest(packetStream, parsedResults, true, true);
+		tcpReassemblyTest(packetStream, rawResults, true, true, true);
+
+		PTF_ASSERT(rawResults.stats.size() == parsedResults.stats.size(), "%s: num of connections is %d, expected %d", fileName, (int)rawResults.stats.size(), (int)parsedResults.stats.size());
+		PTF_ASSERT(rawResults.flowKeysList == parsedResults.flowKeysList, "%s: flow keys are different", fileName);
+		for (TcpReassemblyMultipleConnStats::Stats::iterator iter = parsedResults.stats.begin(); iter != parsedResults.stats.end(); iter++)
+		{
+			TcpReassemblyMultipleConnStats::Stats::iterator rawIter = rawResults.stats.find(iter->first);
+			PTF_ASSERT(rawIter != rawResults.stats.end(), "%s: connection 0x%X wasn't found", fileName, iter->first);
+			TcpReassemblyStats& expected = iter->second;
+			TcpReassemblyStats& actual = rawIter->second;
+			PTF_ASSERT(actual.reassembledData == expected.reassembledData, "%s: reassembled data of connection 0x%X is different", fileName, iter->first);
+			PTF_ASSERT_EQUAL(actual.numOfDataPackets, expected.numOfDataPackets, int);
+			PTF_ASSERT_EQUAL(actual.numOfMessagesFromSide[0], expected.numOfMessagesFromSide[0], int);
+			PTF_ASSERT_EQUAL(actual.numOfMessagesFromSide[1], expected.numOfMessagesFromSide[1], int);
+			PTF_ASSERT_EQUAL(actual.connectionsStarted, expected.connectionsStarted, int);
+			PTF_ASSERT_EQUAL(actual.connectionsEnded, expected.connectionsEnded, int);
+			PTF_ASSERT_EQUAL(actual.connectionsEndedManually, expected.connectionsEndedManually, int);
+			PTF_ASSERT_TRUE(actual.connData.srcIP == expected.connData.srcIP);
+			PTF_ASSERT_TRUE(actual.connData.dstIP == expected.connData.dstIP);
+			PTF_ASSERT_EQUAL(actual.connData.srcPort, expected.connData.srcPort, u16);
+			PTF_ASSERT_EQUAL(actual.connData.dstPort, expected.connData.dstPort, u16);
+			PTF_ASSERT_EQUAL(actual.connData.startTime.tv_sec, expected.connData.startTime.tv_sec, int);
+			PTF_ASSERT_EQUAL(actual.connData.startTime.tv_usec, expected.connData.startTime.tv_usec, int);
+			PTF_ASSERT_EQUAL(actual.connData.endTime.tv_sec, expected.connData.endTime.tv_sec, int);
+			PTF_ASSERT_EQUAL(actual.connData.endTime.tv_usec, expected.connData.endTime.tv_usec, int);
+		}
+	}
+}
+
+
 void savePacketToFile(RawPacket& packet, std::string fileName)
 {
 	PcapFileWriterDevice writerDev(fileName.c_str());
@@ -6461,6 +10863,29 @@ PTF_TEST_CASE(TestRawSockets)
 		PTF_ASSERT(parsedPacket.isPacketOfType(protocol) == true, "Received packet is not of type 0x%X", protocol);
 	}
 
+#ifdef LINUX
+	// receive a batch of packets with a single system call
+	RawPacketVector batchVec;
+	int batchCount = 0;
+	for (int i = 0; i < 10 && batchCount == 0; i++)
+		batchCount = rawSock.receivePacketBatch(batchVec, 32, true, 5);
+	PTF_ASSERT(batchCount > 0 && batchCount <= 32, "Didn't receive a batch of packets, result was %d", batchCount);
+	PTF_ASSERT_EQUAL((int)batchVec.size(), batchCount, int);
+	for (RawPacketVector::VectorIterator iter = batchVec.begin(); iter != batchVec.end(); iter++)
+	{
+		Packet parsedPacket(*iter);
+		PTF_ASSERT(parsedPacket.isPacketOfType(protocol) == true, "Received packet is not of type 0x%X", protocol);
+		PTF_ASSERT_TRUE((*iter)->getPacketTimeStampNs().tv_sec > 0);
+	}
+#else
+	{
+		RawPacketVector batchVec;
+		LoggerPP::getInstance().supressErrors();
+		PTF_ASSERT_EQUAL(rawSock.receivePacketBatch(batchVec), -1, int);
+		LoggerPP::getInstance().enableErrors();
+	}
+#endif
+
 	// receive with timeout
 	RawSocketDevice::RecvPacketResult res = RawSocketDevice::RecvSuccess;
 	for (int i = 0; i < 30; i++)
@@ -6489,6 +10914,7 @@ PTF_TEST_CASE(TestRawSockets)
 	LoggerPP::getInstance().supressErrors();
 	PTF_ASSERT(rawSock.receivePacket(tempPacket, true, 10) == RawSocketDevice::RecvError, "Managed to receive packet while device is closed");
 	PTF_ASSERT(rawSock.sendPacket(packetVec.at(0)) == false, "Managed to send packet while device is closed");
+	PTF_ASSERT_EQUAL(rawSock.receivePacketBatch(packetVec), -1, int);
 	LoggerPP::getInstance().enableErrors();
 
 	PTF_ASSERT(rawSock.open() == true, "Couldn't reopen raw socket");
@@ -6540,6 +10966,302 @@ PTF_TEST_CASE(TestRawSockets)
 
 }
 
+struct PacketMmapCaptureCookie
+{
+	int packetCount[2];
+	int nonTcpCount;
+	int blockCount;
+};
+
+static void packetMmapPacketsArrive(RawPacket* packets, uint32_t numOfPackets, uint8_t threadId, PacketMmapDevice* device, void* userCookie)
+{
+	PacketMmapCaptureCookie* cookie = (PacketMmapCaptureCookie*)userCookie;
+	// each ring is read by its own thread, so each thread updates only its own counter
+	cookie->packetCount[threadId] += numOfPackets;
+	if (threadId == 0)
+		cookie->blockCount++;
+
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		Packet parsedPacket(&packets[i]);
+		if (!parsedPacket.isPacketOfType(TCP))
+			__sync_fetch_and_add(&cookie->nonTcpCount, 1);
+	}
+}
+
+PTF_TEST_CASE(TestPacketMmapDevice)
+{
+#ifdef LINUX
+	PcapLiveDevice* liveDev = PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(PcapGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT(liveDev != NULL, "Device used in this test %s doesn't exist", PcapGlobalArgs.ipToSendReceivePackets.c_str());
+
+	LoggerPP::getInstance().supressErrors();
+	PacketMmapDevice invalidDev("no_such_interface");
+	PTF_ASSERT_FALSE(invalidDev.open());
+	PacketMmapDevice invalidConfigDev(liveDev->getName(), PacketMmapDevice::DeviceConfiguration(1, 1000));
+	PTF_ASSERT_FALSE(invalidConfigDev.open());
+	LoggerPP::getInstance().enableErrors();
+
+	// two rings in a fanout group, each read by its own thread
+	PacketMmapDevice::DeviceConfiguration config(2, 1 << 20, 8);
+	PacketMmapDevice mmapDev(liveDev->getName(), config);
+	PTF_ASSERT(mmapDev.open(), "Cannot open packet mmap device on '%s'", liveDev->getName());
+	PTF_ASSERT_EQUAL(mmapDev.getNumOfOpenedRxRings(), 2, u8);
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(mmapDev.setFilter("invalid filter"));
+	PTF_ASSERT_FALSE(mmapDev.startCapture(NULL, NULL));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_FALSE(mmapDev.isFilterCurrentlySet());
+
+	PacketMmapCaptureCookie cookie;
+	memset(&cookie, 0, sizeof(cookie));
+	PTF_ASSERT_TRUE(mmapDev.startCapture(packetMmapPacketsArrive, &cookie));
+	PTF_ASSERT_TRUE(mmapDev.captureActive());
+	sendURLRequest("www.ebay.com");
+	PCAP_SLEEP(2);
+	mmapDev.stopCapture();
+	PTF_ASSERT_FALSE(mmapDev.captureActive());
+	int totalPacketCount = cookie.packetCount[0] + cookie.packetCount[1];
+	PTF_ASSERT(totalPacketCount > 0, "No packets were captured");
+	PacketMmapDevice::PacketMmapStats stats;
+	mmapDev.getStatistics(stats);
+	PTF_ASSERT_TRUE(stats.recv >= (uint64_t)totalPacketCount);
+
+	// the filter is applied by the kernel, so only TCP packets reach the rings
+	PTF_ASSERT_TRUE(mmapDev.setFilter("tcp"));
+	PTF_ASSERT_TRUE(mmapDev.isFilterCurrentlySet());
+	memset(&cookie, 0, sizeof(cookie));
+	PTF_ASSERT_TRUE(mmapDev.startCapture(packetMmapPacketsArrive, &cookie));
+	sendURLRequest("www.ebay.com");
+	PCAP_SLEEP(2);
+	mmapDev.stopCapture();
+	PTF_ASSERT(cookie.packetCount[0] + cookie.packetCount[1] > 0, "No TCP packets were captured");
+	PTF_ASSERT_EQUAL(cookie.nonTcpCount, 0, int);
+	PTF_ASSERT_TRUE(mmapDev.clearFilter());
+	PTF_ASSERT_FALSE(mmapDev.isFilterCurrentlySet());
+
+	// blocks can be read on the calling thread as well
+	sendURLRequest("www.ebay.com");
+	int numOfPacketsReceived = 0;
+	for (int i = 0; i < 20; i++)
+	{
+		for (uint8_t ringId = 0; ringId < mmapDev.getNumOfOpenedRxRings(); ringId++)
+		{
+			int res = mmapDev.receiveBlock(ringId, packetMmapPacketsArrive, &cookie, 50);
+			PTF_ASSERT_TRUE(res >= 0);
+			numOfPacketsReceived += res;
+		}
+	}
+	PTF_ASSERT(numOfPacketsReceived > 0, "No packets were received");
+
+	mmapDev.close();
+	PTF_ASSERT_FALSE(mmapDev.isOpened());
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(mmapDev.receiveBlock(0, packetMmapPacketsArrive, &cookie, 0), -1, int);
+	PTF_ASSERT_FALSE(mmapDev.startCapture(packetMmapPacketsArrive, &cookie));
+	LoggerPP::getInstance().enableErrors();
+#else
+	PTF_SKIP_TEST("PacketMmapDevice is supported on Linux only");
+#endif
+}
+
+
+static void xdpPacketsArrive(RawPacket* packets, uint32_t numOfPackets, uint8_t threadId, XdpDevice* device, void* userCookie)
+{
+	int* packetCount = (int*)userCookie;
+	__sync_fetch_and_add(packetCount, (int)numOfPackets);
+}
+
+
+
+PTF_TEST_CASE(TestXdpDevice)
+{
+#ifdef LINUX
+	LoggerPP::getInstance().supressErrors();
+	XdpDevice invalidDev("no_such_interface");
+	PTF_ASSERT_FALSE(invalidDev.open());
+	XdpDevice invalidConfigDev("lo", XdpDevice::XdpDeviceConfiguration(1, 100));
+	PTF_ASSERT_FALSE(invalidConfigDev.open());
+	LoggerPP::getInstance().enableErrors();
+
+	// packets sent on the loopback interface come back to its RX queue, where the XDP program redirects them to the device
+	XdpDevice::XdpDeviceConfiguration config(1, 256, 4096, XdpDevice::AttachGeneric, XdpDevice::BindCopy);
+	XdpDevice xdpDev("lo", config);
+	PTF_ASSERT(xdpDev.open(), "Cannot open XDP device on the loopback interface");
+	PTF_ASSERT_EQUAL(xdpDev.getNumOfOpenedQueues(), 1, u8);
+	PTF_ASSERT_FALSE(xdpDev.isDriverMode());
+	PTF_ASSERT_FALSE(xdpDev.isZeroCopy());
+
+	LoggerPP::getInstance().supressErrors();
+	XdpDevice secondDev("lo", config);
+	PTF_ASSERT_FALSE(secondDev.open());
+	RawPacket rxPackets[16];
+	PTF_ASSERT_EQUAL(xdpDev.receivePackets(rxPackets, 16, 1), 0, u16);
+	PTF_ASSERT_FALSE(xdpDev.startCapture(xdpPacketsArrive, NULL, 0x3));
+	LoggerPP::getInstance().enableErrors();
+
+	PcapFileReaderDevice reader(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(reader.open(), "Cannot open file '%s'", EXAMPLE_PCAP_PATH);
+	RawPacketVector packetVec;
+	PTF_ASSERT_EQUAL(reader.getNextPackets(packetVec, 100), 100, int);
+	reader.close();
+
+	// other traffic on the loopback interface may be received as well, so the sent packets are looked for in order among the received ones
+	RawPacket txPackets[10];
+	int numOfPacketsMatched = 0;
+	for (int burst = 0; burst < 10; burst++)
+	{
+		for (int i = 0; i < 10; i++)
+			txPackets[i] = *packetVec.at(burst * 10 + i);
+		PTF_ASSERT_EQUAL(xdpDev.sendPackets(txPackets, 10), 10, u16);
+
+		for (int attempt = 0; attempt < 100 && numOfPacketsMatched < (burst + 1) * 10; attempt++)
+		{
+			uint16_t numOfPacketsReceived = xdpDev.receivePackets(rxPackets, 16, 0);
+			for (uint16_t i = 0; i < numOfPacketsReceived && numOfPacketsMatched < (burst + 1) * 10; i++)
+			{
+				RawPacket* expected = packetVec.at(numOfPacketsMatched);
+				if (rxPackets[i].getRawDataLen() == expected->getRawDataLen() &&
+						memcmp(rxPackets[i].getRawData(), expected->getRawData(), expected->getRawDataLen()) == 0)
+					numOfPacketsMatched++;
+			}
+			if (numOfPacketsReceived == 0)
+				usleep(1000);
+		}
+	}
+	PTF_ASSERT_EQUAL(numOfPacketsMatched, 100, int);
+
+	XdpDevice::XdpStats stats;
+	xdpDev.getStatistics(stats);
+	PTF_ASSERT_TRUE(stats.txPackets == 100);
+	PTF_ASSERT_TRUE(stats.rxPackets >= 100);
+
+	// capture on a thread pinned to core 0
+	int capturedPacketCount = 0;
+	PTF_ASSERT_TRUE(xdpDev.startCapture(xdpPacketsArrive, &capturedPacketCount, 0x1));
+	PTF_ASSERT_TRUE(xdpDev.captureActive());
+	PTF_ASSERT_EQUAL(xdpDev.sendPackets(packetVec), 100, u16);
+	for (int attempt = 0; attempt < 200 && capturedPacketCount < 100; attempt++)
+		usleep(10000);
+	xdpDev.stopCapture();
+	PTF_ASSERT_FALSE(xdpDev.captureActive());
+	PTF_ASSERT(capturedPacketCount >= 100, "Captured only %d packets", capturedPacketCount);
+
+	xdpDev.getStatistics(stats);
+	PTF_ASSERT_TRUE(stats.txPackets == 200);
+
+	xdpDev.close();
+	PTF_ASSERT_FALSE(xdpDev.isOpened());
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(xdpDev.sendPackets(txPackets, 10), 0, u16);
+	LoggerPP::getInstance().enableErrors();
+#else
+	PTF_SKIP_TEST("XdpDevice is supported on Linux only");
+#endif
+}
+
+
+struct BsdBpfCaptureCookie
+{
+	int packetCount;
+	int nonTcpCount;
+	int batchCount;
+	uint32_t maxBatchSize;
+};
+
+static void bsdBpfPacketsArrive(RawPacket* packets, uint32_t numOfPackets, BsdBpfDevice* device, void* userCookie)
+{
+	BsdBpfCaptureCookie* cookie = (BsdBpfCaptureCookie*)userCookie;
+	cookie->packetCount += numOfPackets;
+	cookie->batchCount++;
+	if (numOfPackets > cookie->maxBatchSize)
+		cookie->maxBatchSize = numOfPackets;
+
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		Packet parsedPacket(&packets[i]);
+		if (!parsedPacket.isPacketOfType(TCP))
+			cookie->nonTcpCount++;
+	}
+}
+
+PTF_TEST_CASE(TestBsdBpfDevice)
+{
+#if defined(MAC_OS_X) || defined(FREEBSD)
+	PcapLiveDevice* liveDev = PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(PcapGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT(liveDev != NULL, "Device used in this test %s doesn't exist", PcapGlobalArgs.ipToSendReceivePackets.c_str());
+
+	LoggerPP::getInstance().supressErrors();
+	BsdBpfDevice invalidDev("no_such_interface");
+	PTF_ASSERT_FALSE(invalidDev.open());
+	BsdBpfDevice invalidConfigDev(liveDev->getName(), BsdBpfDevice::DeviceConfiguration(1 << 20, false, 0));
+	PTF_ASSERT_FALSE(invalidConfigDev.open());
+	LoggerPP::getInstance().enableErrors();
+
+	BsdBpfDevice bpfDev(liveDev->getName(), BsdBpfDevice::DeviceConfiguration(1 << 20));
+	PTF_ASSERT(bpfDev.open(), "Cannot open BPF device on '%s'", liveDev->getName());
+	PTF_ASSERT_TRUE(bpfDev.getBufferSize() > 0);
+	PTF_ASSERT_TRUE(bpfDev.getBufferSize() <= (uint32_t)(1 << 20));
+	PTF_ASSERT_EQUAL(bpfDev.getLinkType(), LINKTYPE_ETHERNET, enum);
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(bpfDev.setFilter("invalid filter"));
+	PTF_ASSERT_FALSE(bpfDev.startCapture(NULL, NULL));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_FALSE(bpfDev.isFilterCurrentlySet());
+
+	BsdBpfCaptureCookie cookie;
+	memset(&cookie, 0, sizeof(cookie));
+	PTF_ASSERT_TRUE(bpfDev.startCapture(bsdBpfPacketsArrive, &cookie));
+	PTF_ASSERT_TRUE(bpfDev.captureActive());
+	sendURLRequest("www.ebay.com");
+	PCAP_SLEEP(2);
+	bpfDev.stopCapture();
+	PTF_ASSERT_FALSE(bpfDev.captureActive());
+	PTF_ASSERT(cookie.packetCount > 0, "No packets were captured");
+	BsdBpfDevice::BsdBpfStats stats;
+	bpfDev.getStatistics(stats);
+	PTF_ASSERT_TRUE(stats.packetsDelivered == (uint64_t)cookie.packetCount);
+	PTF_ASSERT_TRUE(stats.reads == (uint64_t)cookie.batchCount);
+	PTF_ASSERT_TRUE(stats.recv >= (uint64_t)cookie.packetCount);
+
+	// the filter is applied by the kernel, so only TCP packets reach the buffer
+	PTF_ASSERT_TRUE(bpfDev.setFilter("tcp"));
+	PTF_ASSERT_TRUE(bpfDev.isFilterCurrentlySet());
+	memset(&cookie, 0, sizeof(cookie));
+	PTF_ASSERT_TRUE(bpfDev.startCapture(bsdBpfPacketsArrive, &cookie));
+	sendURLRequest("www.ebay.com");
+	PCAP_SLEEP(2);
+	bpfDev.stopCapture();
+	PTF_ASSERT(cookie.packetCount > 0, "No TCP packets were captured");
+	PTF_ASSERT_EQUAL(cookie.nonTcpCount, 0, int);
+	PTF_ASSERT_TRUE(bpfDev.clearFilter());
+	PTF_ASSERT_FALSE(bpfDev.isFilterCurrentlySet());
+
+	// buffers can be read on the calling thread as well
+	sendURLRequest("www.ebay.com");
+	int numOfPacketsReceived = 0;
+	for (int i = 0; i < 20; i++)
+	{
+		int res = bpfDev.receiveBatch(bsdBpfPacketsArrive, &cookie);
+		PTF_ASSERT_TRUE(res >= 0);
+		numOfPacketsReceived += res;
+	}
+	PTF_ASSERT(numOfPacketsReceived > 0, "No packets were received");
+
+	bpfDev.close();
+	PTF_ASSERT_FALSE(bpfDev.isOpened());
+	PTF_ASSERT_EQUAL(bpfDev.getBufferSize(), 0, u32);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(bpfDev.receiveBatch(bsdBpfPacketsArrive, &cookie), -1, int);
+	PTF_ASSERT_FALSE(bpfDev.startCapture(bsdBpfPacketsArrive, &cookie));
+	LoggerPP::getInstance().enableErrors();
+#else
+	PTF_SKIP_TEST("BsdBpfDevice is supported on macOS and FreeBSD only");
+#endif
+}
+
 
 
 
@@ -6703,6 +11425,10 @@ int main(int argc, char* argv[])
 	//LoggerPP::getInstance().setErrorString(errString, 1000);
 	PcapGlobalArgs.errString = errString;
 
+	// when the library is built with latency tracing its histograms are allocated the first time a packet is received or parsed, which
+	// would be reported as a leak of the first test
+	LatencyTracer::registerCurrentThread();
+
 	PTF_START_RUNNING_TESTS(userTags, configTags);
 
 	PcapLiveDeviceList::getInstance();
@@ -6713,22 +11439,58 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestPcapSllFileReadWrite, "no_network;pcap");
 	PTF_RUN_TEST(TestPcapRawIPFileReadWrite, "no_network;pcap");
 	PTF_RUN_TEST(TestPcapFileAppend, "no_network;pcap");
+	PTF_RUN_TEST(TestPcapFileNanoPrecision, "no_network;pcap");
+	PTF_RUN_TEST(TestBufferedPcapFileWriter, "no_network;pcap;buffered_writer");
+	PTF_RUN_TEST(TestRotatingFileWriter, "no_network;pcap;rotating_writer");
+	PTF_RUN_TEST(TestMmapPcapFileReader, "no_network;pcap;mmap");
+	PTF_RUN_TEST(TestBufferedPcapFileReader, "no_network;pcap;buffered_reader");
+	PTF_RUN_TEST(TestBufferedPcapFileFollow, "no_network;pcap;buffered_reader");
+	PTF_RUN_TEST(TestPrefetchingFileReader, "no_network;pcap;prefetch");
+	PTF_RUN_TEST(TestMergingReaderDevice, "no_network;pcap;merge");
+	PTF_RUN_TEST(TestPacketReplayer, "no_network;pcap;replay");
+	PTF_RUN_TEST(TestMultiInterfacePcapNgWriter, "no_network;pcap;pcapng;multi_interface");
+	PTF_RUN_TEST(TestMultiFileWriter, "no_network;pcap;multi_file_writer");
+	PTF_RUN_TEST(TestStreamSink, "no_network;pcap;stream_sink");
+	PTF_RUN_TEST(TestPacketQueueDevice, "no_network;packet_queue");
+	PTF_RUN_TEST(TestSharedMemoryRingDevice, "no_network;shared_ring");
+	PTF_RUN_TEST(TestFlightRecorderDevice, "no_network;pcap;flight_recorder");
+	PTF_RUN_TEST(TestDeviceMetrics, "no_network;pcap;metrics");
+	PTF_RUN_TEST(TestBenchmarkHarness, "no_network;pcap;benchmark");
+	PTF_RUN_TEST(TestFilterMatchingPerf, "no_network;perf;perf_filter;skip_mem_leak_check");
+	PTF_RUN_TEST(TestPcapFileIndex, "no_network;pcap;pcap_index");
+	PTF_RUN_TEST(TestPcapFlowIndex, "no_network;pcap;pcap_index;flow_index");
+	PTF_RUN_TEST(TestFileReaderSeek, "no_network;pcap;pcap_index");
+	PTF_RUN_TEST(TestPcapFileSummary, "no_network;pcap;pcap_summary");
+	PTF_RUN_TEST(TestPacketTableWriter, "no_network;pcap;arrow");
+	PTF_RUN_TEST(TestPacketSampler, "no_network;pcap;sampling");
+	PTF_RUN_TEST(TestPcapAutoTuner, "no_network;pcap;auto_tuning");
+	PTF_RUN_TEST(TestRemoteCaptureTransport, "no_network;remote_capture");
 	PTF_RUN_TEST(TestPcapNgFileReadWrite, "no_network;pcap;pcapng");
 	PTF_RUN_TEST(TestPcapNgFileReadWriteAdv, "no_network;pcap;pcapng");
+	PTF_RUN_TEST(TestPcapNgFileZeroCopyRead, "no_network;pcap;pcapng");
 	PTF_RUN_TEST(TestPcapLiveDeviceList, "no_network;live_device;skip_mem_leak_check");
 	PTF_RUN_TEST(TestPcapLiveDeviceListSearch, "live_device");
 	PTF_RUN_TEST(TestPcapLiveDevice, "live_device");
 	PTF_RUN_TEST(TestPcapLiveDeviceNoNetworking, "no_network;live_device");
 	PTF_RUN_TEST(TestPcapLiveDeviceStatsMode, "live_device");
 	PTF_RUN_TEST(TestPcapLiveDeviceBlockingMode, "live_device");
+	PTF_RUN_TEST(TestPcapLiveDeviceBurstMode, "live_device");
+	PTF_RUN_TEST(TestDeviceReactor, "live_device;reactor");
+	PTF_RUN_TEST(TestPcapLiveDeviceMultiThread, "live_device");
 	PTF_RUN_TEST(TestPcapLiveDeviceSpecialCfg, "live_device");
 	PTF_RUN_TEST(TestWinPcapLiveDevice, "live_device;winpcap");
 	PTF_RUN_TEST(TestPcapLiveDeviceByInvalidIp, "no_network;live_device");
 	PTF_RUN_TEST(TestPcapFiltersLive, "filters");
 	PTF_RUN_TEST(TestPcapFilters_General_BPFStr, "no_network;filters;skip_mem_leak_check");
+	PTF_RUN_TEST(TestBpfJit, "no_network;filters;skip_mem_leak_check");
+	PTF_RUN_TEST(TestNativeFilter, "no_network;filters;skip_mem_leak_check");
+	PTF_RUN_TEST(TestMultiFilter, "no_network;filters;skip_mem_leak_check");
+	PTF_RUN_TEST(TestFilterProfiling, "no_network;filters;skip_mem_leak_check");
 	PTF_RUN_TEST(TestPcapFiltersOffline, "no_network;filters");
+	PTF_RUN_TEST(TestFilterFlowRules, "no_network;filters;flow_rules");
 	PTF_RUN_TEST(TestSendPacket, "send");
 	PTF_RUN_TEST(TestSendPackets, "send");
+	PTF_RUN_TEST(TestSendPacketsTxBuffer, "send");
 	PTF_RUN_TEST(TestRemoteCapture, "remote_capture;winpcap");
 	PTF_RUN_TEST(TestHttpRequestParsing, "no_network;http");
 	PTF_RUN_TEST(TestHttpResponseParsing, "no_network;http");
@@ -6742,12 +11504,21 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestPfRingFilters, "pf_ring");
 	PTF_RUN_TEST(TestDnsParsing, "no_network;dns");
 	PTF_RUN_TEST(TestDpdkDevice, "dpdk");
+	PTF_RUN_TEST(TestDpdkDeviceFilters, "dpdk;filters");
+	PTF_RUN_TEST(TestDpdkDeviceFlowRules, "dpdk;filters");
+	PTF_RUN_TEST(TestDpdkDeviceOffloads, "dpdk");
+	PTF_RUN_TEST(TestDpdkMBufRawPacketSegments, "dpdk");
+	PTF_RUN_TEST(TestDpdkDeviceRxBurstStats, "dpdk");
+	PTF_RUN_TEST(TestDpdkAdaptivePolling, "dpdk");
+	PTF_RUN_TEST(TestDpdkForwarder, "dpdk");
+	PTF_RUN_TEST(TestDpdkMBufPools, "dpdk");
 	PTF_RUN_TEST(TestDpdkMultiThread, "dpdk");
 	PTF_RUN_TEST(TestDpdkDeviceSendPackets, "dpdk");
 	PTF_RUN_TEST(TestKniDevice, "dpdk;kni");
 	PTF_RUN_TEST(TestKniDeviceSendReceive, "dpdk;kni");
 	PTF_RUN_TEST(TestDpdkMbufRawPacket, "dpdk");
 	PTF_RUN_TEST(TestDpdkDeviceWorkerThreads, "dpdk");
+	PTF_RUN_TEST(TestDpdkPipeline, "dpdk");
 	PTF_RUN_TEST(TestGetMacAddress, "mac");
 	PTF_RUN_TEST(TestTcpReassemblySanity, "no_network;tcp_reassembly");
 	PTF_RUN_TEST(TestTcpReassemblyRetran, "no_network;tcp_reassembly");
@@ -6760,6 +11531,7 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestTcpReassemblyIPv6MultConns, "no_network;tcp_reassembly");
 	PTF_RUN_TEST(TestTcpReassemblyIPv6_OOO, "no_network;tcp_reassembly");
 	PTF_RUN_TEST(TestTcpReassemblyCleanup, "no_network;tcp_reassembly");
+	PTF_RUN_TEST(TestTcpReassemblyRawPackets, "no_network;tcp_reassembly");
 	PTF_RUN_TEST(TestIPFragmentationSanity, "no_network;ip_frag");
 	PTF_RUN_TEST(TestIPFragOutOfOrder, "no_network;ip_frag");
 	PTF_RUN_TEST(TestIPFragPartialData, "no_network;ip_frag");
@@ -6767,6 +11539,9 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestIPFragMapOverflow, "no_network;ip_frag");
 	PTF_RUN_TEST(TestIPFragRemove, "no_network;ip_frag");
 	PTF_RUN_TEST(TestRawSockets, "raw_sockets");
+	PTF_RUN_TEST(TestPacketMmapDevice, "live_device;packet_mmap");
+	PTF_RUN_TEST(TestXdpDevice, "live_device;xdp");
+	PTF_RUN_TEST(TestBsdBpfDevice, "live_device;bsd_bpf");
 
 	PTF_END_RUNNING_TESTS;
 }
@@ -5,6 +5,17 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 void __ptfSplitString(const std::string& input, std::vector<std::string>& result)
 {
@@ -139,6 +150,25 @@ bool __ptfCheckTags(std::string tagSet, std::string tagSetToCompareWith, bool em
         return; \
     }
 
+#define PTF_ASSERT_MAX_ALLOCATIONS(statement, maxAllocations) \
+    { \
+        MemPlumberAllocationScope __ptfAllocScope; \
+        statement; \
+        uint64_t __ptfAllocCount = __ptfAllocScope.getAllocationCount(); \
+        if (__ptfAllocCount > (uint64_t)(maxAllocations)) { \
+            printf("%-30s: FAILED (line: %d). allocation budget exceeded: %s made %d allocations (%d[bytes]), budget is %d\n", __FUNCTION__, __LINE__, #statement, (int)__ptfAllocCount, (int)__ptfAllocScope.getAllocationSize(), (int)(maxAllocations)); \
+            ptfResult = 0; \
+            return; \
+        } \
+    }
+
+#define PTF_ASSERT_MAX_ALLOCATIONS_IN_SCOPE(scope, maxAllocations) \
+    if ((scope).getAllocationCount() > (uint64_t)(maxAllocations)) { \
+		printf("%-30s: FAILED (line: %d). allocation budget exceeded: %d allocations (%d[bytes]) since %s was created, budget is %d\n", __FUNCTION__, __LINE__, (int)(scope).getAllocationCount(), (int)(scope).getAllocationSize(), #scope, (int)(maxAllocations)); \
+		ptfResult = 0; \
+        return; \
+    }
+
 #define PTF_TRY(exp, assertFailedFormat, ...) \
 	if (!(exp)) \
 	{ \
@@ -158,6 +188,10 @@ bool __ptfCheckTags(std::string tagSet, std::string tagSetToCompareWith, bool em
     { \
         printf("%-30s: SKIPPED (tags don't match)\n", #TestName ""); \
     } \
+    else if (userTagsToRun == "" && __ptfCheckTags(TestName##_tags, "perf", false)) \
+    { \
+        printf("%-30s: SKIPPED (performance tests run only when selected by tags)\n", #TestName ""); \
+    } \
     else \
     { \
         bool runMemLeakCheck = !__ptfCheckTags("skip_mem_leak_check", configTagsToRun, false) && !__ptfCheckTags(TestName##_tags, "skip_mem_leak_check", false); \
@@ -215,4 +249,141 @@ bool verboseMode = false;
 		} \
 } while(0)
 
+
+/*
+ * Performance tests
+ * =================
+ * A performance test is a regular test case tagged "perf" (and "skip_mem_leak_check", since MemPlumber slows down allocations) which
+ * asserts that workloads didn't get slower with PTF_ASSERT_PERF. A workload is a function which does a fixed amount of work, such as
+ * parsing a set of packets. Its time is expressed as a ratio against a reference loop of integer arithmetic, branches and memory reads
+ * measured right before it, so the ratio stays about the same on faster or slower machines and under frequency scaling, and a baseline
+ * ratio recorded on one machine can be checked on another.
+ * Each assertion runs the workload PTF_PERF_WARMUP_REPETITIONS times to warm up the caches and then PTF_PERF_REPETITIONS times, each
+ * repetition next to a run of the reference loop. A regression is reported only if it's statistically significant: when the whole 95%
+ * confidence interval of the median ratio is above the baseline plus PTF_PERF_TOLERANCE, so noisy runs don't fail.
+ * Performance tests are skipped unless tests are selected by tags (for example "-t perf"), so they don't slow down or destabilize the
+ * regular runs. Every assertion prints its measured ratio, which is what a baseline should be set to when a workload changes
+ */
+
+#ifndef PTF_PERF_REPETITIONS
+#define PTF_PERF_REPETITIONS 21
+#endif
+
+#ifndef PTF_PERF_WARMUP_REPETITIONS
+#define PTF_PERF_WARMUP_REPETITIONS 3
+#endif
+
+#ifndef PTF_PERF_TOLERANCE
+#define PTF_PERF_TOLERANCE 0.15
+#endif
+
+typedef void (*PtfPerfWorkload)(void* cookie);
+
+struct PtfPerfResult
+{
+    double medianRatio;
+    double lowRatio;
+    double highRatio;
+    double medianNs;
+    double referenceNs;
+};
+
+double __ptfNowNs()
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+#endif
+}
+
+volatile uint32_t __ptfPerfSink = 0;
+
+double __ptfRunReferenceLoop()
+{
+    // 64KB of pseudo-random data, which fits in L2 on every machine the tests run on
+    static uint32_t data[16384];
+    static bool dataInitialized = false;
+    if (!dataInitialized)
+    {
+        uint32_t seed = 12345;
+        for (int i = 0; i < 16384; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            data[i] = seed;
+        }
+        dataInitialized = true;
+    }
+
+    double start = __ptfNowNs();
+    uint32_t hash = 0;
+    uint32_t index = 0;
+    for (int i = 0; i < 1000000; i++)
+    {
+        uint32_t value = data[index];
+        hash = (hash ^ value) * 16777619;
+        if (value & 1)
+            hash += value >> 3;
+        index = (index + (hash & 0xff) + 1) & 16383;
+    }
+    __ptfPerfSink = hash;
+    return __ptfNowNs() - start;
+}
+
+void __ptfMeasurePerfWorkload(PtfPerfWorkload workload, void* cookie, PtfPerfResult& result)
+{
+    for (int i = 0; i < PTF_PERF_WARMUP_REPETITIONS; i++)
+    {
+        __ptfRunReferenceLoop();
+        workload(cookie);
+    }
+
+    std::vector<double> ratios, workloadNs, referenceNs;
+    for (int i = 0; i < PTF_PERF_REPETITIONS; i++)
+    {
+        double reference = __ptfRunReferenceLoop();
+        double start = __ptfNowNs();
+        workload(cookie);
+        double elapsed = __ptfNowNs() - start;
+        ratios.push_back(elapsed / reference);
+        workloadNs.push_back(elapsed);
+        referenceNs.push_back(reference);
+    }
+
+    std::sort(ratios.begin(), ratios.end());
+    std::sort(workloadNs.begin(), workloadNs.end());
+    std::sort(referenceNs.begin(), referenceNs.end());
+
+    // the 95% confidence interval of the median is between these order statistics (normal approximation of the binomial distribution)
+    int n = (int)ratios.size();
+    int low = (int)floor(n / 2.0 - 0.98 * sqrt((double)n));
+    int high = (int)ceil(n / 2.0 + 0.98 * sqrt((double)n));
+    result.medianRatio = ratios[n / 2];
+    result.lowRatio = ratios[std::max(low, 0)];
+    result.highRatio = ratios[std::min(high, n - 1)];
+    result.medianNs = workloadNs[n / 2];
+    result.referenceNs = referenceNs[n / 2];
+}
+
+#define PTF_ASSERT_PERF(workloadName, workload, cookie, baselineRatio) \
+    { \
+        PtfPerfResult __ptfPerfResult; \
+        __ptfMeasurePerfWorkload(workload, cookie, __ptfPerfResult); \
+        double __ptfPerfLimit = (baselineRatio) * (1.0 + PTF_PERF_TOLERANCE); \
+        printf("%-30s: PERF %-20s ratio %.3f [%.3f - %.3f] baseline %.3f (%.0f[ns], reference %.0f[ns])%s\n", __FUNCTION__, workloadName, \
+                __ptfPerfResult.medianRatio, __ptfPerfResult.lowRatio, __ptfPerfResult.highRatio, (double)(baselineRatio), \
+                __ptfPerfResult.medianNs, __ptfPerfResult.referenceNs, \
+                (__ptfPerfResult.highRatio < (baselineRatio) * (1.0 - PTF_PERF_TOLERANCE) ? " faster than baseline" : "")); \
+        if (__ptfPerfResult.lowRatio > __ptfPerfLimit) { \
+            printf("%-30s: FAILED (line: %d). performance regression: %s ratio %.3f is above the baseline %.3f by more than %d%%\n", __FUNCTION__, __LINE__, workloadName, __ptfPerfResult.medianRatio, (double)(baselineRatio), (int)(PTF_PERF_TOLERANCE * 100)); \
+            ptfResult = 0; \
+            return; \
+        } \
+    }
+
 #endif // PCPP_TEST_FRAMEWORK
\ No newline at end of file
@@ -16,7 +16,7 @@ function HELP {
    echo "  1) Without any switches. In this case the script will guide you through using wizards"
    echo "  2) With switches, as described below"
    echo ""
-   echo -e "Basic usage: $SCRIPT [-h] [--pf-ring] [--pf-ring-home] [--dpdk] [--dpdk-home] [--use-immediate-mode] [--set-direction-enabled] [--install-dir] [--libpcap-include-dir] [--libpcap-lib-dir]"\\n
+   echo -e "Basic usage: $SCRIPT [-h] [--pf-ring] [--pf-ring-home] [--dpdk] [--dpdk-home] [--use-immediate-mode] [--set-direction-enabled] [--enable-latency-tracing] [--itt-home] [--install-dir] [--libpcap-include-dir] [--libpcap-lib-dir]"\\n
    echo "The following switches are recognized:"
    echo "--default                --Setup PcapPlusPlus for Linux without PF_RING or DPDK. In this case you must not set --pf-ring or --dpdk"
    echo ""
@@ -30,6 +30,12 @@ function HELP {
    echo ""
    echo "--set-direction-enabled  --Set direction for capturing incoming or outgoing packets (supported on libpcap>=0.9.1)"
    echo ""
+   echo "--enable-latency-tracing --Compile in the per-stage latency tracing points (device RX, parsing, TCP reassembly callbacks and"
+   echo "                           device TX). See LatencyTracer.h"
+   echo ""
+   echo "--itt-home               --Sets the home directory of Intel ITT (the ittnotify headers and library, for example from a VTune"
+   echo "                           installation) to annotate the example applications' --benchmark mode for VTune. See BenchmarkHarness.h"
+   echo ""
    echo "--install-dir            --Installation directory. Default is /usr/local"
    echo ""
    echo "--libpcap-include-dir    --libpcap header files directory. This parameter is optional and if omitted PcapPlusPlus will look for"
@@ -59,6 +65,8 @@ COMPILE_WITH_DPDK=0
 DPDK_HOME=""
 HAS_PCAP_IMMEDIATE_MODE=0
 HAS_SET_DIRECTION_ENABLED=0
+ENABLE_LATENCY_TRACING=0
+ITT_HOME=""
 
 # initializing libpcap include/lib dirs to an empty string 
 LIBPCAP_INLCUDE_DIR=""
@@ -122,7 +130,7 @@ if [ $NUMARGS -eq 0 ]; then
 else
 
    # these are all the possible switches
-   OPTS=`getopt -o h --long default,pf-ring,pf-ring-home:,dpdk,dpdk-home:,help,use-immediate-mode,set-direction-enabled,install-dir:,libpcap-include-dir:,libpcap-lib-dir: -- "$@"`
+   OPTS=`getopt -o h --long default,pf-ring,pf-ring-home:,dpdk,dpdk-home:,help,use-immediate-mode,set-direction-enabled,enable-latency-tracing,itt-home:,install-dir:,libpcap-include-dir:,libpcap-lib-dir: -- "$@"`
 
    # if user put an illegal switch - print HELP and exit
    if [ $? -ne 0 ]; then
@@ -176,6 +184,20 @@ else
          HAS_SET_DIRECTION_ENABLED=1
          shift ;;
 
+       # compile in the latency tracing points
+       --enable-latency-tracing)
+         ENABLE_LATENCY_TRACING=1
+         shift ;;
+
+       # itt-home switch - set ITT_HOME and make sure it's a valid dir, otherwise exit
+       --itt-home)
+         ITT_HOME=$2
+         if [ ! -d "$ITT_HOME" ]; then
+            echo "ITT home directory '$ITT_HOME' not found. Exiting..."
+            exit 1
+         fi
+         shift 2 ;;
+
        # non-default libpcap include dir
        --libpcap-include-dir)
          LIBPCAP_INLCUDE_DIR=$2
@@ -318,6 +340,20 @@ fi
 if (( $HAS_SET_DIRECTION_ENABLED > 0 )) ; then 
    echo -e "HAS_SET_DIRECTION_ENABLED := 1\n\n" >> $PCAPPLUSPLUS_MK
 fi
+
+if (( $ENABLE_LATENCY_TRACING > 0 )) ; then
+   echo -e "PCAPPP_BUILD_FLAGS += -DPCPP_ENABLE_LATENCY_TRACING\n\n" >> $PCAPPLUSPLUS_MK
+fi
+
+# Intel ITT annotations of the benchmark harness
+if [ -n "$ITT_HOME" ]; then
+   echo -e "# Intel ITT" >> $PCAPPLUSPLUS_MK
+   echo -e "ITT_HOME := $ITT_HOME" >> $PCAPPLUSPLUS_MK
+   echo -e "PCAPPP_BUILD_FLAGS += -DPCPP_ENABLE_ITT" >> $PCAPPLUSPLUS_MK
+   echo -e "PCAPPP_INCLUDES += -I\$(ITT_HOME)/include" >> $PCAPPLUSPLUS_MK
+   echo -e "PCAPPP_LIBS_DIR += -L\$(ITT_HOME)/lib64" >> $PCAPPLUSPLUS_MK
+   echo -e "PCAPPP_LIBS += -littnotify -ldl\n" >> $PCAPPLUSPLUS_MK
+fi
 # non-default libpcap include dir
 if [ -n "$LIBPCAP_INLCUDE_DIR" ]; then
    echo -e "# non-default libpcap include dir" >> $PCAPPLUSPLUS_MK